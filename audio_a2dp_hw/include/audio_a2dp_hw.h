@@ -86,6 +86,10 @@ typedef enum {
   A2DP_CTRL_SET_OUTPUT_AUDIO_CONFIG,
   A2DP_CTRL_CMD_OFFLOAD_START,
   A2DP_CTRL_GET_PRESENTATION_POSITION,
+  // Replies with the output buffer size the stack sized its audio data ring
+  // for, as a uint32_t: see audio_a2dp_hw_stream_compute_encoder_buffer_size.
+  // Zero if there is no current codec.
+  A2DP_CTRL_GET_OUTPUT_BUFFER_SIZE,
 } tA2DP_CTRL_CMD;
 
 typedef enum {
@@ -148,6 +152,24 @@ size_t audio_a2dp_hw_stream_compute_buffer_size(
     btav_a2dp_codec_bits_per_sample_t codec_bits_per_sample,
     btav_a2dp_codec_channel_mode_t codec_channel_mode);
 
+// Computes the Audio A2DP HAL output buffer size for an encoder draining the
+// output stream every |encoder_interval_ms| milliseconds.
+// |codec_sample_rate|, |codec_bits_per_sample| and |codec_channel_mode| are
+// as for |audio_a2dp_hw_stream_compute_buffer_size|.
+//
+// The time period is the shortest whole number of encoder intervals lasting
+// 20ms or more, instead of the conservative 20ms: each AudioFlinger mixer
+// write then covers whole reads of the encoder, and the FastMixer is still
+// avoided.
+//
+// Returns the computed buffer size. If |encoder_interval_ms| is zero, the
+// return value is the one of |audio_a2dp_hw_stream_compute_buffer_size|.
+size_t audio_a2dp_hw_stream_compute_encoder_buffer_size(
+    btav_a2dp_codec_sample_rate_t codec_sample_rate,
+    btav_a2dp_codec_bits_per_sample_t codec_bits_per_sample,
+    btav_a2dp_codec_channel_mode_t codec_channel_mode,
+    uint64_t encoder_interval_ms);
+
 // Returns whether the delay reporting property is set.
 bool delay_reporting_enabled();
 
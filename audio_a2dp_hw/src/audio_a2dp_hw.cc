@@ -31,6 +31,7 @@
 #include <inttypes.h>
 #include <stdint.h>
 #include <sys/errno.h>
+#include <sys/poll.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/time.h>
@@ -46,6 +47,7 @@
 #include "osi/include/hash_map_utils.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
+#include "osi/include/shm_ring.h"
 #include "osi/include/socket_utils/sockets.h"
 
 #include "audio_a2dp_hw.h"
@@ -58,6 +60,7 @@
 #define USEC_PER_SEC 1000000L
 #define SOCK_SEND_TIMEOUT_MS 2000 /* Timeout for sending */
 #define SOCK_RECV_TIMEOUT_MS 5000 /* Timeout for receiving */
+#define RING_OFFER_TIMEOUT_MS 100 /* Timeout for the audio ring offer */
 #define SEC_TO_MS 1000
 #define SEC_TO_NS 1000000000
 #define MS_TO_NS 1000000
@@ -122,6 +125,8 @@ struct a2dp_stream_common {
   std::recursive_mutex* mutex;  // See note below on mutex acquisition order.
   int ctrl_fd;
   int audio_fd;
+  shm_ring_t* audio_ring;    // Audio data ring offered by the stack, if any
+  shm_ring_t* writing_ring;  // Ring used by the write in progress, if any
   size_t buffer_sz;
   struct a2dp_config cfg;
   a2dp_state_t state;
@@ -342,6 +347,51 @@ static int skt_disconnect(int fd) {
   return 0;
 }
 
+/* The stack offers a shared memory ring for the audio data as soon as the
+ * data socket is connected. Returns NULL if there was no valid offer, the
+ * audio data then goes through the socket. */
+static shm_ring_t* skt_recv_ring(int fd) {
+  struct pollfd pfd;
+  pfd.fd = fd;
+  pfd.events = POLLIN;
+
+  int ret;
+  OSI_NO_INTR(ret = poll(&pfd, 1, RING_OFFER_TIMEOUT_MS));
+  if (ret <= 0) {
+    INFO("no audio ring offered, using the socket");
+    return NULL;
+  }
+
+  char offer;
+  struct iovec iov;
+  iov.iov_base = &offer;
+  iov.iov_len = sizeof(offer);
+
+  char control_buf[CMSG_SPACE(sizeof(int))];
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control_buf;
+  msg.msg_controllen = sizeof(control_buf);
+
+  ssize_t n;
+  OSI_NO_INTR(n = recvmsg(fd, &msg, MSG_DONTWAIT | MSG_CMSG_CLOEXEC));
+  struct cmsghdr* header = CMSG_FIRSTHDR(&msg);
+  if (n != sizeof(offer) || header == NULL ||
+      header->cmsg_level != SOL_SOCKET || header->cmsg_type != SCM_RIGHTS ||
+      header->cmsg_len != CMSG_LEN(sizeof(int))) {
+    ERROR("invalid audio ring offer");
+    return NULL;
+  }
+
+  int ring_fd = *(int*)CMSG_DATA(header);
+  shm_ring_t* ring = shm_ring_attach(ring_fd);
+  close(ring_fd);
+  INFO("audio ring %s", ring ? "attached" : "rejected");
+  return ring;
+}
+
 /*****************************************************************************
  *
  *  AUDIO CONTROL PATH
@@ -523,6 +573,22 @@ static int a2dp_read_input_audio_config(struct a2dp_stream_common* common) {
   return 0;
 }
 
+// Returns the output buffer size the stack sized its audio data ring for, or
+// zero if the stack has none or doesn't know the command.
+static uint32_t a2dp_read_output_buffer_size(
+    struct a2dp_stream_common* common) {
+  uint32_t buffer_sz = 0;
+
+  if (a2dp_command(common, A2DP_CTRL_GET_OUTPUT_BUFFER_SIZE) < 0) {
+    INFO("no a2dp output buffer size from the stack");
+    return 0;
+  }
+  if (a2dp_ctrl_receive(common, &buffer_sz, sizeof(buffer_sz)) < 0) return 0;
+
+  INFO("got output buffer size %" PRIu32, buffer_sz);
+  return buffer_sz;
+}
+
 static int a2dp_read_output_audio_config(
     struct a2dp_stream_common* common, btav_a2dp_codec_config_t* codec_config,
     btav_a2dp_codec_config_t* codec_capability, bool update_stream_config) {
@@ -633,6 +699,10 @@ static int a2dp_read_output_audio_config(
     common->buffer_sz = audio_a2dp_hw_stream_compute_buffer_size(
         codec_config->sample_rate, codec_config->bits_per_sample,
         codec_config->channel_mode);
+    // Prefer the size the stack adapted to its encoder, if it has one. It
+    // is computed the same way, with the encoder interval as time period.
+    uint32_t stack_buffer_sz = a2dp_read_output_buffer_size(common);
+    if (stack_buffer_sz != 0) common->buffer_sz = stack_buffer_sz;
     if (common->cfg.is_stereo_to_mono) {
       // We need to fetch twice as much data from the Audio framework
       common->buffer_sz *= 2;
@@ -818,6 +888,8 @@ static void a2dp_stream_common_init(struct a2dp_stream_common* common) {
 
   common->ctrl_fd = AUDIO_SKT_DISCONNECTED;
   common->audio_fd = AUDIO_SKT_DISCONNECTED;
+  common->audio_ring = NULL;
+  common->writing_ring = NULL;
   common->state = AUDIO_A2DP_STATE_STOPPED;
 
   /* manages max capacity of socket pipe */
@@ -831,6 +903,19 @@ static void a2dp_stream_common_destroy(struct a2dp_stream_common* common) {
   common->mutex = NULL;
 }
 
+static void disconnect_audio_datapath(struct a2dp_stream_common* common) {
+  if (common->audio_ring != NULL) {
+    shm_ring_close(common->audio_ring);
+    // A write in progress frees its ring when it returns
+    if (common->audio_ring != common->writing_ring)
+      shm_ring_free(common->audio_ring);
+    common->audio_ring = NULL;
+  }
+
+  skt_disconnect(common->audio_fd);
+  common->audio_fd = AUDIO_SKT_DISCONNECTED;
+}
+
 static int start_audio_datapath(struct a2dp_stream_common* common) {
   INFO("state %d", common->state);
 
@@ -853,6 +938,7 @@ static int start_audio_datapath(struct a2dp_stream_common* common) {
       ERROR("Audiopath start failed - error opening data socket");
       goto error;
     }
+    common->audio_ring = skt_recv_ring(common->audio_fd);
   }
   common->state = (a2dp_state_t)AUDIO_A2DP_STATE_STARTED;
 
@@ -884,8 +970,7 @@ static int stop_audio_datapath(struct a2dp_stream_common* common) {
   common->state = (a2dp_state_t)AUDIO_A2DP_STATE_STOPPED;
 
   /* disconnect audio path */
-  skt_disconnect(common->audio_fd);
-  common->audio_fd = AUDIO_SKT_DISCONNECTED;
+  disconnect_audio_datapath(common);
 
   return 0;
 }
@@ -904,9 +989,7 @@ static int suspend_audio_datapath(struct a2dp_stream_common* common,
     common->state = AUDIO_A2DP_STATE_SUSPENDED;
 
   /* disconnect audio path */
-  skt_disconnect(common->audio_fd);
-
-  common->audio_fd = AUDIO_SKT_DISCONNECTED;
+  disconnect_audio_datapath(common);
 
   return 0;
 }
@@ -922,6 +1005,7 @@ static ssize_t out_write(struct audio_stream_out* stream, const void* buffer,
   struct a2dp_stream_out* out = (struct a2dp_stream_out*)stream;
   int sent = -1;
   size_t write_bytes = bytes;
+  shm_ring_t* ring;
 
   DEBUG("write %zu bytes (fd %d)", bytes, out->common.audio_fd);
 
@@ -956,13 +1040,25 @@ static ssize_t out_write(struct audio_stream_out* stream, const void* buffer,
           out->common.audio_fd);
   }
 
+  ring = out->common.audio_ring;
+  out->common.writing_ring = ring;
   lock.unlock();
-  sent = skt_write(out->common.audio_fd, buffer, write_bytes);
+  if (ring != NULL) {
+    sent = shm_ring_write(ring, buffer, write_bytes, SOCK_SEND_TIMEOUT_MS);
+    if (sent != (int)write_bytes) {
+      WARN("ring write failed, wrote %d bytes", sent);
+      sent = -1;
+    }
+  } else {
+    sent = skt_write(out->common.audio_fd, buffer, write_bytes);
+  }
   lock.lock();
+  out->common.writing_ring = NULL;
+  // The data path was disconnected while writing
+  if (ring != NULL && ring != out->common.audio_ring) shm_ring_free(ring);
 
   if (sent == -1) {
-    skt_disconnect(out->common.audio_fd);
-    out->common.audio_fd = AUDIO_SKT_DISCONNECTED;
+    disconnect_audio_datapath(&out->common);
     if ((out->common.state != AUDIO_A2DP_STATE_SUSPENDED) &&
         (out->common.state != AUDIO_A2DP_STATE_STOPPING)) {
       out->common.state = AUDIO_A2DP_STATE_STOPPED;
@@ -1017,107 +1113,6 @@ static size_t out_get_buffer_size(const struct audio_stream* stream) {
   return period_size;
 }
 
-size_t audio_a2dp_hw_stream_compute_buffer_size(
-    btav_a2dp_codec_sample_rate_t codec_sample_rate,
-    btav_a2dp_codec_bits_per_sample_t codec_bits_per_sample,
-    btav_a2dp_codec_channel_mode_t codec_channel_mode) {
-  size_t buffer_sz = AUDIO_STREAM_OUTPUT_BUFFER_SZ;  // Default value
-  const uint64_t time_period_ms = 20;                // Conservative 20ms
-  uint32_t sample_rate;
-  uint32_t bits_per_sample;
-  uint32_t number_of_channels;
-
-  // Check the codec config sample rate
-  switch (codec_sample_rate) {
-    case BTAV_A2DP_CODEC_SAMPLE_RATE_44100:
-      sample_rate = 44100;
-      break;
-    case BTAV_A2DP_CODEC_SAMPLE_RATE_48000:
-      sample_rate = 48000;
-      break;
-    case BTAV_A2DP_CODEC_SAMPLE_RATE_88200:
-      sample_rate = 88200;
-      break;
-    case BTAV_A2DP_CODEC_SAMPLE_RATE_96000:
-      sample_rate = 96000;
-      break;
-    case BTAV_A2DP_CODEC_SAMPLE_RATE_176400:
-      sample_rate = 176400;
-      break;
-    case BTAV_A2DP_CODEC_SAMPLE_RATE_192000:
-      sample_rate = 192000;
-      break;
-    case BTAV_A2DP_CODEC_SAMPLE_RATE_NONE:
-    default:
-      ERROR("Invalid sample rate: 0x%x", codec_sample_rate);
-      return buffer_sz;
-  }
-
-  // Check the codec config bits per sample
-  switch (codec_bits_per_sample) {
-    case BTAV_A2DP_CODEC_BITS_PER_SAMPLE_16:
-      bits_per_sample = 16;
-      break;
-    case BTAV_A2DP_CODEC_BITS_PER_SAMPLE_24:
-      bits_per_sample = 24;
-      break;
-    case BTAV_A2DP_CODEC_BITS_PER_SAMPLE_32:
-      bits_per_sample = 32;
-      break;
-    case BTAV_A2DP_CODEC_BITS_PER_SAMPLE_NONE:
-    default:
-      ERROR("Invalid bits per sample: 0x%x", codec_bits_per_sample);
-      return buffer_sz;
-  }
-
-  // Check the codec config channel mode
-  switch (codec_channel_mode) {
-    case BTAV_A2DP_CODEC_CHANNEL_MODE_MONO:
-      number_of_channels = 1;
-      break;
-    case BTAV_A2DP_CODEC_CHANNEL_MODE_STEREO:
-    case BTAV_A2DP_CODEC_CHANNEL_MODE_DUAL_CHANNEL:
-      number_of_channels = 2;
-      break;
-    case BTAV_A2DP_CODEC_CHANNEL_MODE_NONE:
-    default:
-      ERROR("Invalid channel mode: 0x%x", codec_channel_mode);
-      return buffer_sz;
-  }
-
-  //
-  // The buffer size is computed by using the following formula:
-  //
-  // AUDIO_STREAM_OUTPUT_BUFFER_SIZE =
-  //    (TIME_PERIOD_MS * AUDIO_STREAM_OUTPUT_BUFFER_PERIODS *
-  //     SAMPLE_RATE_HZ * NUMBER_OF_CHANNELS * (BITS_PER_SAMPLE / 8)) / 1000
-  //
-  // AUDIO_STREAM_OUTPUT_BUFFER_PERIODS controls how the socket buffer is
-  // divided for AudioFlinger data delivery. The AudioFlinger mixer delivers
-  // data in chunks of
-  // (AUDIO_STREAM_OUTPUT_BUFFER_SIZE / AUDIO_STREAM_OUTPUT_BUFFER_PERIODS) .
-  // If the number of periods is 2, the socket buffer represents "double
-  // buffering" of the AudioFlinger mixer buffer.
-  //
-  // Furthermore, the AudioFlinger expects the buffer size to be a multiple
-  // of 16 frames.
-  const size_t divisor = (AUDIO_STREAM_OUTPUT_BUFFER_PERIODS * 16 *
-                          number_of_channels * bits_per_sample) /
-                         8;
-
-  buffer_sz = (time_period_ms * AUDIO_STREAM_OUTPUT_BUFFER_PERIODS *
-               sample_rate * number_of_channels * (bits_per_sample / 8)) /
-              1000;
-
-  // Adjust the buffer size so it can be divided by the divisor
-  const size_t remainder = buffer_sz % divisor;
-  if (remainder != 0) {
-    buffer_sz += divisor - remainder;
-  }
-
-  return buffer_sz;
-}
-
 static uint32_t out_get_channels(const struct audio_stream* stream) {
   struct a2dp_stream_out* out = (struct a2dp_stream_out*)stream;
 
@@ -1525,8 +1520,7 @@ static ssize_t in_read(struct audio_stream_in* stream, void* buffer,
   read = skt_read(in->common.audio_fd, buffer, bytes);
   lock.lock();
   if (read == -1) {
-    skt_disconnect(in->common.audio_fd);
-    in->common.audio_fd = AUDIO_SKT_DISCONNECTED;
+    disconnect_audio_datapath(&in->common);
     if ((in->common.state != AUDIO_A2DP_STATE_SUSPENDED) &&
         (in->common.state != AUDIO_A2DP_STATE_STOPPING)) {
       in->common.state = AUDIO_A2DP_STATE_STOPPED;
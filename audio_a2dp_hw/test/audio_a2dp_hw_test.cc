@@ -145,3 +145,43 @@ TEST_F(AudioA2dpHwTest, test_compute_buffer_size) {
     }
   }
 }
+
+TEST_F(AudioA2dpHwTest, test_compute_encoder_buffer_size) {
+  // No encoder interval: the conservative 20ms period
+  EXPECT_EQ(audio_a2dp_hw_stream_compute_encoder_buffer_size(
+                BTAV_A2DP_CODEC_SAMPLE_RATE_44100,
+                BTAV_A2DP_CODEC_BITS_PER_SAMPLE_16,
+                BTAV_A2DP_CODEC_CHANNEL_MODE_STEREO, 0),
+            audio_a2dp_hw_stream_compute_buffer_size(
+                BTAV_A2DP_CODEC_SAMPLE_RATE_44100,
+                BTAV_A2DP_CODEC_BITS_PER_SAMPLE_16,
+                BTAV_A2DP_CODEC_CHANNEL_MODE_STEREO));
+
+  // 1 interval of 20ms: 2 periods of 960 frames of 4 bytes
+  EXPECT_EQ(audio_a2dp_hw_stream_compute_encoder_buffer_size(
+                BTAV_A2DP_CODEC_SAMPLE_RATE_48000,
+                BTAV_A2DP_CODEC_BITS_PER_SAMPLE_16,
+                BTAV_A2DP_CODEC_CHANNEL_MODE_STEREO, 20),
+            static_cast<size_t>(2 * 960 * 4));
+
+  // 2 intervals of 14ms: 2 periods of 1344 frames of 4 bytes
+  EXPECT_EQ(audio_a2dp_hw_stream_compute_encoder_buffer_size(
+                BTAV_A2DP_CODEC_SAMPLE_RATE_48000,
+                BTAV_A2DP_CODEC_BITS_PER_SAMPLE_16,
+                BTAV_A2DP_CODEC_CHANNEL_MODE_STEREO, 14),
+            static_cast<size_t>(2 * 1344 * 4));
+
+  // 1 interval of 23ms: 1014.3 frames rounded up to 1024 frames of 6 bytes
+  EXPECT_EQ(audio_a2dp_hw_stream_compute_encoder_buffer_size(
+                BTAV_A2DP_CODEC_SAMPLE_RATE_44100,
+                BTAV_A2DP_CODEC_BITS_PER_SAMPLE_24,
+                BTAV_A2DP_CODEC_CHANNEL_MODE_STEREO, 23),
+            static_cast<size_t>(2 * 1024 * 6));
+
+  // Invalid input
+  EXPECT_EQ(audio_a2dp_hw_stream_compute_encoder_buffer_size(
+                BTAV_A2DP_CODEC_SAMPLE_RATE_NONE,
+                BTAV_A2DP_CODEC_BITS_PER_SAMPLE_16,
+                BTAV_A2DP_CODEC_CHANNEL_MODE_STEREO, 20),
+            static_cast<size_t>(AUDIO_STREAM_OUTPUT_BUFFER_SZ));
+}
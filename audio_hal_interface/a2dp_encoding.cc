@@ -450,6 +450,37 @@ bool setup_codec() {
   return active_hal_interface->UpdateAudioConfig(audio_config);
 }
 
+// Move the session of an offloaded stream the controller could not start to
+// the software encoding datapath. The audio framework reopens its stream on the
+// new session, while the AVDTP stream stays started.
+bool fallback_to_software_encoding() {
+  if (!is_hal_2_0_offloading() || software_hal_interface == nullptr) {
+    return false;
+  }
+  PcmParameters pcm_config{};
+  if (!a2dp_get_selected_hal_pcm_config(&pcm_config)) {
+    LOG(ERROR) << __func__ << ": Failed to get PcmConfiguration";
+    return false;
+  }
+  AudioConfiguration audio_config{};
+  audio_config.pcmConfig(pcm_config);
+
+  // The pending start and the delay report are shared by both transports,
+  // the start is over for the offloading session
+  static_cast<A2dpTransport*>(active_hal_interface->GetTransportInstance())
+      ->ResetPendingCmd();
+  LOG(WARNING) << __func__ << ": Switching BluetoothAudio HAL to Software";
+  end_session();
+
+  active_hal_interface = software_hal_interface;
+  if (!active_hal_interface->UpdateAudioConfig(audio_config)) {
+    LOG(ERROR) << __func__ << ": Failed to update the audio config";
+    return false;
+  }
+  active_hal_interface->StartSession();
+  return true;
+}
+
 void start_session() {
   if (!is_hal_2_0_enabled()) {
     LOG(ERROR) << __func__ << ": BluetoothAudio HAL is not enabled";
@@ -535,6 +566,11 @@ void set_remote_delay(uint16_t delay_report) {
       ->SetRemoteDelay(delay_report);
 }
 
+void debug_dump(int fd) {
+  if (!is_hal_2_0_enabled() || is_hal_2_0_offloading()) return;
+  active_hal_interface->DebugDump(fd);
+}
+
 }  // namespace a2dp
 }  // namespace audio
 }  // namespace bluetooth
@@ -43,6 +43,11 @@ void cleanup();
 // Set up the codec into BluetoothAudio HAL
 bool setup_codec();
 
+// Move the session of an offloaded stream to the software encoding datapath,
+// when the controller could not start the offload. The session stays there
+// until the codec is set up again. Returns false if the session wasn't moved.
+bool fallback_to_software_encoding();
+
 // Send command to the BluetoothAudio HAL: StartSession, EndSession,
 // StreamStarted, StreamSuspended
 void start_session();
@@ -56,6 +61,9 @@ size_t read(uint8_t* p_buf, uint32_t len);
 // Update A2DP delay report to BluetoothAudio HAL
 void set_remote_delay(uint16_t delay_report);
 
+// Dump the statistics of the reads from the FMQ of BluetoothAudio HAL
+void debug_dump(int fd);
+
 }  // namespace a2dp
 }  // namespace audio
 }  // namespace bluetooth
@@ -22,15 +22,22 @@
 #include <android/hardware/bluetooth/audio/2.0/IBluetoothAudioProvidersFactory.h>
 #include <android/hidl/manager/1.2/IServiceManager.h>
 #include <base/logging.h>
+#include <fmq/EventFlag.h>
 #include <hidl/MQDescriptor.h>
 #include <hidl/ServiceManagement.h>
+#include <stdio.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <future>
+#include <thread>
 
 #include "osi/include/log.h"
 
 namespace bluetooth {
 namespace audio {
 
+using ::android::hardware::EventFlag;
 using ::android::hardware::hidl_vec;
 using ::android::hardware::Return;
 using ::android::hardware::Void;
@@ -42,10 +49,58 @@ using DataMQ = ::android::hardware::MessageQueue<
     uint8_t, ::android::hardware::kSynchronizedReadWrite>;
 
 static constexpr int kDefaultDataReadTimeoutMs = 10;      // 10 ms
-static constexpr int kDefaultDataReadPollIntervalMs = 1;  // non-blocking poll
+static constexpr int kDefaultDataWriteTimeoutMs = 10;     // 10 ms
+// The longest wait on the event flag before the fmq is checked again, as the
+// other end may move data without waking the flag up
+static constexpr int kDefaultDataReadPollIntervalMs = 1;
 static constexpr char kFullyQualifiedInterfaceName[] =
     "android.hardware.bluetooth.audio@2.0::IBluetoothAudioProvidersFactory";
 
+struct BluetoothAudioClientInterface::DataPath {
+  explicit DataPath(std::unique_ptr<DataMQ> mq) : data_mq(std::move(mq)) {
+    std::atomic<uint32_t>* event_flag_word = data_mq->getEventFlagWord();
+    if (event_flag_word != nullptr &&
+        EventFlag::createEventFlag(event_flag_word, &event_flag) !=
+            ::android::OK) {
+      LOG(WARNING) << __func__ << ": no event flag, polling the data path";
+      event_flag = nullptr;
+    }
+  }
+
+  ~DataPath() {
+    if (event_flag != nullptr) EventFlag::deleteEventFlag(&event_flag);
+  }
+
+  // Waits up to |timeout|, and no longer than the poll interval, for the
+  // |bits| to be woken up
+  void Wait(uint32_t bits, std::chrono::nanoseconds timeout) {
+    timeout = std::min<std::chrono::nanoseconds>(
+        timeout, std::chrono::milliseconds(kDefaultDataReadPollIntervalMs));
+    if (timeout.count() <= 0) return;
+    if (event_flag == nullptr) {
+      std::this_thread::sleep_for(timeout);
+      return;
+    }
+    uint32_t event_flag_state = 0;
+    event_flag->wait(bits, &event_flag_state, timeout.count(),
+                     true /* retry */);
+  }
+
+  void Wake(uint32_t bits) {
+    if (event_flag != nullptr) event_flag->wake(bits);
+  }
+
+  // Ends the reads and writes in progress
+  void Close() {
+    closed = true;
+    Wake(DataMQ::FMQ_NOT_EMPTY | DataMQ::FMQ_NOT_FULL);
+  }
+
+  std::unique_ptr<DataMQ> data_mq;
+  EventFlag* event_flag = nullptr;
+  std::atomic<bool> closed{false};
+};
+
 std::ostream& operator<<(std::ostream& os, const BluetoothAudioCtrlAck& ack) {
   switch (ack) {
     case BluetoothAudioCtrlAck::SUCCESS_FINISHED:
@@ -189,7 +244,7 @@ class BluetoothAudioDeathRecipient
 
 BluetoothAudioClientInterface::BluetoothAudioClientInterface(IBluetoothTransportInstance* sink,
                                                              bluetooth::common::MessageLoopThread* message_loop)
-    : sink_(sink), provider_(nullptr), session_started_(false), mDataMQ(nullptr),
+    : sink_(sink), provider_(nullptr), session_started_(false),
       death_recipient_(new BluetoothAudioDeathRecipient(this, message_loop)) {
   if (IsSupported()) {
     FetchAudioProvider();
@@ -391,7 +446,8 @@ int BluetoothAudioClientInterface::StartSession() {
   }
 
   if (tempDataMQ && tempDataMQ->isValid()) {
-    mDataMQ = std::move(tempDataMQ);
+    std::atomic_store(&data_path_,
+                      std::make_shared<DataPath>(std::move(tempDataMQ)));
   } else if (sink_->GetSessionType() ==
                  SessionType::A2DP_HARDWARE_OFFLOAD_DATAPATH &&
              session_status == BluetoothAudioStatus::SUCCESS) {
@@ -399,13 +455,15 @@ int BluetoothAudioClientInterface::StartSession() {
     session_started_ = true;
     return 0;
   }
-  if (mDataMQ && mDataMQ->isValid()) {
+  std::shared_ptr<DataPath> data_path = std::atomic_load(&data_path_);
+  if (data_path && data_path->data_mq->isValid()) {
     sink_->ResetPresentationPosition();
     session_started_ = true;
     return 0;
   } else {
-    ALOGE_IF(!mDataMQ, "Failed to obtain audio data path");
-    ALOGE_IF(mDataMQ && !mDataMQ->isValid(), "Audio data path is invalid");
+    ALOGE_IF(!data_path, "Failed to obtain audio data path");
+    ALOGE_IF(data_path && !data_path->data_mq->isValid(),
+             "Audio data path is invalid");
     session_started_ = false;
     return -EIO;
   }
@@ -457,7 +515,9 @@ int BluetoothAudioClientInterface::EndSession() {
     LOG(ERROR) << __func__ << ": BluetoothAudioHal nullptr";
     return -EINVAL;
   }
-  mDataMQ = nullptr;
+  std::shared_ptr<DataPath> data_path =
+      std::atomic_exchange(&data_path_, std::shared_ptr<DataPath>());
+  if (data_path) data_path->Close();
   auto hidl_retval = provider_->endSession();
   if (!hidl_retval.isOk()) {
     LOG(ERROR) << __func__ << ": BluetoothAudioHal failure: " << hidl_retval.description();
@@ -474,54 +534,136 @@ size_t BluetoothAudioClientInterface::ReadAudioData(uint8_t* p_buf,
   }
   if (p_buf == nullptr || len == 0) return 0;
 
-  std::lock_guard<std::mutex> guard(internal_mutex_);
+  std::shared_ptr<DataPath> data_path = std::atomic_load(&data_path_);
 
+  auto start = std::chrono::steady_clock::now();
+  auto deadline = start + std::chrono::milliseconds(kDefaultDataReadTimeoutMs);
   size_t total_read = 0;
-  int timeout_ms = kDefaultDataReadTimeoutMs;
-  do {
-    if (mDataMQ == nullptr || !mDataMQ->isValid()) break;
-
-    size_t avail_to_read = mDataMQ->availableToRead();
+  bool waited = false;
+  while (data_path != nullptr && !data_path->closed && total_read < len) {
+    size_t avail_to_read = data_path->data_mq->availableToRead();
     if (avail_to_read) {
       if (avail_to_read > len - total_read) {
         avail_to_read = len - total_read;
       }
-      if (mDataMQ->read(p_buf + total_read, avail_to_read) == 0) {
+      if (!data_path->data_mq->read(p_buf + total_read, avail_to_read)) {
         LOG(WARNING) << __func__ << ": len=" << len
                      << " total_read=" << total_read << " failed";
         break;
       }
       total_read += avail_to_read;
-    } else if (timeout_ms >= kDefaultDataReadPollIntervalMs) {
-      std::this_thread::sleep_for(
-          std::chrono::milliseconds(kDefaultDataReadPollIntervalMs));
-      timeout_ms -= kDefaultDataReadPollIntervalMs;
+      data_path->Wake(DataMQ::FMQ_NOT_FULL);
       continue;
-    } else {
+    }
+    auto now = std::chrono::steady_clock::now();
+    if (now >= deadline) {
       LOG(WARNING) << __func__ << ": " << (len - total_read) << "/" << len
-                   << " no data " << (kDefaultDataReadTimeoutMs - timeout_ms)
-                   << " ms";
+                   << " no data " << kDefaultDataReadTimeoutMs << " ms";
       break;
     }
-  } while (total_read < len);
+    data_path->Wait(DataMQ::FMQ_NOT_EMPTY, deadline - now);
+    waited = true;
+  }
 
-  if (timeout_ms <
-          (kDefaultDataReadTimeoutMs - kDefaultDataReadPollIntervalMs) &&
-      timeout_ms >= kDefaultDataReadPollIntervalMs) {
+  auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+  if (waited && total_read < len) {
     VLOG(1) << __func__ << ": underflow " << len << " -> " << total_read
-            << " read " << (kDefaultDataReadTimeoutMs - timeout_ms) << " ms";
+            << " read " << elapsed_ms << " ms";
   } else {
     VLOG(2) << __func__ << ": " << len << " -> " << total_read << " read";
   }
 
+  if (data_path != nullptr) {
+    static constexpr int64_t kLatencyBoundsMs[kReadLatencyBuckets - 1] = {
+        1, 2, 5, 10};
+    int latency_bucket = 0;
+    while (latency_bucket < kReadLatencyBuckets - 1 &&
+           elapsed_ms >= kLatencyBoundsMs[latency_bucket]) {
+      latency_bucket++;
+    }
+    read_stats_.reads++;
+    read_stats_.latency_histogram[latency_bucket]++;
+    if (total_read < len) {
+      read_stats_.underflows++;
+      read_stats_.underflow_bytes += len - total_read;
+      read_stats_.underflow_histogram[total_read * kUnderflowBuckets / len]++;
+    }
+  }
+
   sink_->LogBytesRead(total_read);
   return total_read;
 }
 
 size_t BluetoothAudioClientInterface::WriteAudioData(uint8_t* p_buf,
                                                      uint32_t len) {
-  // Not implemented!
-  return 0;
+  if (provider_ == nullptr) {
+    LOG(ERROR) << __func__ << ": BluetoothAudioHal nullptr";
+    return 0;
+  }
+  if (p_buf == nullptr || len == 0) return 0;
+
+  std::shared_ptr<DataPath> data_path = std::atomic_load(&data_path_);
+
+  auto deadline = std::chrono::steady_clock::now() +
+                  std::chrono::milliseconds(kDefaultDataWriteTimeoutMs);
+  size_t total_written = 0;
+  while (data_path != nullptr && !data_path->closed && total_written < len) {
+    size_t avail_to_write = data_path->data_mq->availableToWrite();
+    if (avail_to_write) {
+      if (avail_to_write > len - total_written) {
+        avail_to_write = len - total_written;
+      }
+      if (!data_path->data_mq->write(p_buf + total_written, avail_to_write)) {
+        LOG(WARNING) << __func__ << ": len=" << len
+                     << " total_written=" << total_written << " failed";
+        break;
+      }
+      total_written += avail_to_write;
+      data_path->Wake(DataMQ::FMQ_NOT_EMPTY);
+      continue;
+    }
+    auto now = std::chrono::steady_clock::now();
+    if (now >= deadline) {
+      LOG(WARNING) << __func__ << ": " << (len - total_written) << "/" << len
+                   << " no space " << kDefaultDataWriteTimeoutMs << " ms";
+      break;
+    }
+    data_path->Wait(DataMQ::FMQ_NOT_FULL, deadline - now);
+  }
+
+  VLOG(2) << __func__ << ": " << len << " -> " << total_written << " written";
+  return total_written;
+}
+
+void BluetoothAudioClientInterface::DebugDump(int fd) const {
+  static const char* const kLatencyBucketNames[kReadLatencyBuckets] = {
+      "<1", "<2", "<5", "<10", ">=10"};
+  static const char* const kUnderflowBucketNames[kUnderflowBuckets] = {
+      "<25", "<50", "<75", "<100"};
+
+  dprintf(fd,
+          "  Data path                                               : %s\n",
+          std::atomic_load(&data_path_) == nullptr ? "none" : "open");
+  dprintf(fd,
+          "  Counts (reads/underflows)                               : %zu / "
+          "%zu\n",
+          read_stats_.reads, read_stats_.underflows);
+  dprintf(fd,
+          "  Bytes (underflow)                                       : %llu\n",
+          (unsigned long long)read_stats_.underflow_bytes);
+  dprintf(fd, "  Read latency in ms                                      :");
+  for (int i = 0; i < kReadLatencyBuckets; i++) {
+    dprintf(fd, " %s:%zu", kLatencyBucketNames[i],
+            read_stats_.latency_histogram[i]);
+  }
+  dprintf(fd, "\n  Underflow read in %% of request                         :");
+  for (int i = 0; i < kUnderflowBuckets; i++) {
+    dprintf(fd, " %s:%zu", kUnderflowBucketNames[i],
+            read_stats_.underflow_histogram[i]);
+  }
+  dprintf(fd, "\n");
 }
 
 void BluetoothAudioClientInterface::RenewAudioProviderAndSession() {
@@ -17,6 +17,7 @@
 #pragma once
 
 #include <time.h>
+#include <memory>
 #include <mutex>
 #include <vector>
 
@@ -159,6 +160,9 @@ class BluetoothAudioClientInterface {
   // Renew the connection and usually is used when HIDL restarted
   void RenewAudioProviderAndSession();
 
+  // Dump the latency and underflow histograms of the reads through fmq
+  void DebugDump(int fd) const;
+
   static constexpr PcmParameters kInvalidPcmConfiguration = {
       .sampleRate = SampleRate::RATE_UNKNOWN,
       .channelMode = ChannelMode::UNKNOWN,
@@ -176,9 +180,26 @@ class BluetoothAudioClientInterface {
   android::sp<IBluetoothAudioProvider> provider_;
   std::vector<AudioCapabilities> capabilities_;
   bool session_started_;
-  std::unique_ptr<::android::hardware::MessageQueue<
-      uint8_t, ::android::hardware::kSynchronizedReadWrite>>
-      mDataMQ;
+  // The fmq of the session along with its event flag. The data path is read
+  // without |internal_mutex_|: readers and writers hold a reference of their
+  // own, so that EndSession() only drops it and wakes them up.
+  struct DataPath;
+  std::shared_ptr<DataPath> data_path_;
+
+  // Histograms of the reads through fmq, only updated by the reading thread
+  static constexpr int kReadLatencyBuckets = 5;
+  static constexpr int kUnderflowBuckets = 4;
+  struct ReadStats {
+    size_t reads = 0;
+    size_t underflows = 0;
+    uint64_t underflow_bytes = 0;
+    // Time spent in a read, in ms: < 1, < 2, < 5, < 10, >= 10
+    size_t latency_histogram[kReadLatencyBuckets] = {};
+    // What an underflowing read got, in % of the request: < 25, < 50, < 75,
+    // < 100
+    size_t underflow_histogram[kUnderflowBuckets] = {};
+  };
+  ReadStats read_stats_;
   android::sp<BluetoothAudioDeathRecipient> death_recipient_;
 };
 
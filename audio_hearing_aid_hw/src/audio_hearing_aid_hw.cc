@@ -25,6 +25,7 @@
 #include <inttypes.h>
 #include <stdint.h>
 #include <sys/errno.h>
+#include <sys/poll.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/time.h>
@@ -40,6 +41,7 @@
 #include "osi/include/hash_map_utils.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
+#include "osi/include/shm_ring.h"
 #include "osi/include/socket_utils/sockets.h"
 
 #include "audio_hearing_aid_hw.h"
@@ -52,6 +54,7 @@
 #define USEC_PER_SEC 1000000L
 #define SOCK_SEND_TIMEOUT_MS 2000 /* Timeout for sending */
 #define SOCK_RECV_TIMEOUT_MS 5000 /* Timeout for receiving */
+#define RING_OFFER_TIMEOUT_MS 100 /* Timeout for the audio ring offer */
 
 // set WRITE_POLL_MS to 0 for blocking sockets, nonzero for polled non-blocking
 // sockets
@@ -109,6 +112,8 @@ struct ha_stream_common {
   std::recursive_mutex* mutex;  // See note below on mutex acquisition order.
   int ctrl_fd;
   int audio_fd;
+  shm_ring_t* audio_ring;    // Audio data ring offered by the stack, if any
+  shm_ring_t* writing_ring;  // Ring used by the write in progress, if any
   size_t buffer_sz;
   struct ha_config cfg;
   ha_state_t state;
@@ -326,6 +331,51 @@ static int skt_disconnect(int fd) {
   return 0;
 }
 
+/* The stack offers a shared memory ring for the audio data as soon as the
+ * data socket is connected. Returns NULL if there was no valid offer, the
+ * audio data then goes through the socket. */
+static shm_ring_t* skt_recv_ring(int fd) {
+  struct pollfd pfd;
+  pfd.fd = fd;
+  pfd.events = POLLIN;
+
+  int ret;
+  OSI_NO_INTR(ret = poll(&pfd, 1, RING_OFFER_TIMEOUT_MS));
+  if (ret <= 0) {
+    INFO("no audio ring offered, using the socket");
+    return NULL;
+  }
+
+  char offer;
+  struct iovec iov;
+  iov.iov_base = &offer;
+  iov.iov_len = sizeof(offer);
+
+  char control_buf[CMSG_SPACE(sizeof(int))];
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control_buf;
+  msg.msg_controllen = sizeof(control_buf);
+
+  ssize_t n;
+  OSI_NO_INTR(n = recvmsg(fd, &msg, MSG_DONTWAIT | MSG_CMSG_CLOEXEC));
+  struct cmsghdr* header = CMSG_FIRSTHDR(&msg);
+  if (n != sizeof(offer) || header == NULL ||
+      header->cmsg_level != SOL_SOCKET || header->cmsg_type != SCM_RIGHTS ||
+      header->cmsg_len != CMSG_LEN(sizeof(int))) {
+    ERROR("invalid audio ring offer");
+    return NULL;
+  }
+
+  int ring_fd = *(int*)CMSG_DATA(header);
+  shm_ring_t* ring = shm_ring_attach(ring_fd);
+  close(ring_fd);
+  INFO("audio ring %s", ring ? "attached" : "rejected");
+  return ring;
+}
+
 /*****************************************************************************
  *
  *  AUDIO CONTROL PATH
@@ -776,6 +826,8 @@ static void ha_stream_common_init(struct ha_stream_common* common) {
 
   common->ctrl_fd = AUDIO_SKT_DISCONNECTED;
   common->audio_fd = AUDIO_SKT_DISCONNECTED;
+  common->audio_ring = NULL;
+  common->writing_ring = NULL;
   common->state = AUDIO_HA_STATE_STOPPED;
 
   /* manages max capacity of socket pipe */
@@ -789,6 +841,19 @@ static void ha_stream_common_destroy(struct ha_stream_common* common) {
   common->mutex = NULL;
 }
 
+static void disconnect_audio_datapath(struct ha_stream_common* common) {
+  if (common->audio_ring != NULL) {
+    shm_ring_close(common->audio_ring);
+    // A write in progress frees its ring when it returns
+    if (common->audio_ring != common->writing_ring)
+      shm_ring_free(common->audio_ring);
+    common->audio_ring = NULL;
+  }
+
+  skt_disconnect(common->audio_fd);
+  common->audio_fd = AUDIO_SKT_DISCONNECTED;
+}
+
 static int start_audio_datapath(struct ha_stream_common* common) {
   INFO("state %d", common->state);
 
@@ -811,6 +876,7 @@ static int start_audio_datapath(struct ha_stream_common* common) {
       ERROR("Audiopath start failed - error opening data socket");
       goto error;
     }
+    common->audio_ring = skt_recv_ring(common->audio_fd);
   }
   common->state = (ha_state_t)AUDIO_HA_STATE_STARTED;
   return 0;
@@ -838,8 +904,7 @@ static int stop_audio_datapath(struct ha_stream_common* common) {
   common->state = (ha_state_t)AUDIO_HA_STATE_STOPPED;
 
   /* disconnect audio path */
-  skt_disconnect(common->audio_fd);
-  common->audio_fd = AUDIO_SKT_DISCONNECTED;
+  disconnect_audio_datapath(common);
 
   return 0;
 }
@@ -858,9 +923,7 @@ static int suspend_audio_datapath(struct ha_stream_common* common,
     common->state = AUDIO_HA_STATE_SUSPENDED;
 
   /* disconnect audio path */
-  skt_disconnect(common->audio_fd);
-
-  common->audio_fd = AUDIO_SKT_DISCONNECTED;
+  disconnect_audio_datapath(common);
 
   return 0;
 }
@@ -876,6 +939,7 @@ static ssize_t out_write(struct audio_stream_out* stream, const void* buffer,
   struct ha_stream_out* out = (struct ha_stream_out*)stream;
   int sent = -1;
   size_t write_bytes = bytes;
+  shm_ring_t* ring;
 
   DEBUG("write %zu bytes (fd %d)", bytes, out->common.audio_fd);
 
@@ -910,13 +974,25 @@ static ssize_t out_write(struct audio_stream_out* stream, const void* buffer,
           out->common.audio_fd);
   }
 
+  ring = out->common.audio_ring;
+  out->common.writing_ring = ring;
   lock.unlock();
-  sent = skt_write(out->common.audio_fd, buffer, write_bytes);
+  if (ring != NULL) {
+    sent = shm_ring_write(ring, buffer, write_bytes, SOCK_SEND_TIMEOUT_MS);
+    if (sent != (int)write_bytes) {
+      WARN("ring write failed, wrote %d bytes", sent);
+      sent = -1;
+    }
+  } else {
+    sent = skt_write(out->common.audio_fd, buffer, write_bytes);
+  }
   lock.lock();
+  out->common.writing_ring = NULL;
+  // The data path was disconnected while writing
+  if (ring != NULL && ring != out->common.audio_ring) shm_ring_free(ring);
 
   if (sent == -1) {
-    skt_disconnect(out->common.audio_fd);
-    out->common.audio_fd = AUDIO_SKT_DISCONNECTED;
+    disconnect_audio_datapath(&out->common);
     if ((out->common.state != AUDIO_HA_STATE_SUSPENDED) &&
         (out->common.state != AUDIO_HA_STATE_STOPPING)) {
       out->common.state = AUDIO_HA_STATE_STOPPED;
@@ -1463,8 +1539,7 @@ static ssize_t in_read(struct audio_stream_in* stream, void* buffer,
   read = skt_read(in->common.audio_fd, buffer, bytes);
   lock.lock();
   if (read == -1) {
-    skt_disconnect(in->common.audio_fd);
-    in->common.audio_fd = AUDIO_SKT_DISCONNECTED;
+    disconnect_audio_datapath(&in->common);
     if ((in->common.state != AUDIO_HA_STATE_SUSPENDED) &&
         (in->common.state != AUDIO_HA_STATE_STOPPING)) {
       in->common.state = AUDIO_HA_STATE_STOPPED;
@@ -33,17 +33,65 @@
  *  Constants
  ****************************************************************************/
 
+/* Number of AT command tables whose names are indexed */
+#define BTA_AG_AT_MAX_TRIES 4
+
+/*****************************************************************************
+ *  Local data
+ ****************************************************************************/
+
+/* Name index of each AT command table, built the first time it is used */
+static struct {
+  const tBTA_AG_AT_CMD* p_at_tbl;
+  AtNameTrie trie;
+} bta_ag_at_tries[BTA_AG_AT_MAX_TRIES];
+
+/******************************************************************************
+ *
+ * Function         bta_ag_at_trie
+ *
+ * Description      Return the name index of AT command table p_at_tbl,
+ *                  building it if it is the first time the table is used.
+ *
+ *
+ * Returns          The index, or nullptr if the table cannot be indexed and
+ *                  must be scanned.
+ *
+ *****************************************************************************/
+static const AtNameTrie* bta_ag_at_trie(const tBTA_AG_AT_CMD* p_at_tbl) {
+  int xx;
+
+  for (xx = 0; xx < BTA_AG_AT_MAX_TRIES; xx++) {
+    if (bta_ag_at_tries[xx].p_at_tbl == p_at_tbl) {
+      return &bta_ag_at_tries[xx].trie;
+    }
+    if (bta_ag_at_tries[xx].p_at_tbl == nullptr) break;
+  }
+  if (xx == BTA_AG_AT_MAX_TRIES) return nullptr;
+
+  /* table names are uppercase; received commands may not be */
+  AtNameTrie trie(true);
+  for (int idx = 0; p_at_tbl[idx].p_cmd[0] != 0; idx++) {
+    if (!trie.Add(p_at_tbl[idx].p_cmd, idx)) return nullptr;
+  }
+  bta_ag_at_tries[xx].trie = trie;
+  bta_ag_at_tries[xx].p_at_tbl = p_at_tbl;
+  return &bta_ag_at_tries[xx].trie;
+}
+
 /******************************************************************************
  *
  * Function         bta_ag_at_init
  *
- * Description      Initialize the AT command parser control block.
+ * Description      Initialize the AT command parser control block for the
+ *                  command table p_at_tbl it was given.
  *
  *
  * Returns          void
  *
  *****************************************************************************/
 void bta_ag_at_init(tBTA_AG_AT_CB* p_cb) {
+  p_cb->p_at_trie = bta_ag_at_trie(p_cb->p_at_tbl);
   p_cb->p_cmd_buf = nullptr;
   p_cb->cmd_pos = 0;
 }
@@ -65,6 +113,41 @@ void bta_ag_at_reinit(tBTA_AG_AT_CB* p_cb) {
   p_cb->cmd_pos = 0;
 }
 
+/******************************************************************************
+ *
+ * Function         bta_ag_at_find
+ *
+ * Description      Find the entry of the AT command table matching the
+ *                  command p_cmd, which ends at p_end.
+ *
+ *
+ * Returns          Index of the entry, or of the end-of-table marker if no
+ *                  command matches.
+ *
+ *****************************************************************************/
+static uint16_t bta_ag_at_find(tBTA_AG_AT_CB* p_cb, const char* p_cmd,
+                               const char* p_end) {
+  uint16_t idx;
+
+  if (p_cb->p_at_trie != nullptr) {
+    size_t name_len;
+    int match = p_cb->p_at_trie->Match(p_cmd, p_end - p_cmd, &name_len);
+    if (match != AtNameTrie::kNoMatch) return match;
+
+    for (idx = 0; p_cb->p_at_tbl[idx].p_cmd[0] != 0; idx++)
+      ;
+    return idx;
+  }
+
+  /* loop through at command table looking for match */
+  for (idx = 0; p_cb->p_at_tbl[idx].p_cmd[0] != 0; idx++) {
+    if (!utl_strucmp(p_cb->p_at_tbl[idx].p_cmd, p_cmd)) {
+      break;
+    }
+  }
+  return idx;
+}
+
 /******************************************************************************
  *
  * Function         bta_ag_process_at
@@ -77,22 +160,18 @@ void bta_ag_at_reinit(tBTA_AG_AT_CB* p_cb) {
  * Returns          void
  *
  *****************************************************************************/
-void bta_ag_process_at(tBTA_AG_AT_CB* p_cb, char* p_end) {
+static void bta_ag_process_at(tBTA_AG_AT_CB* p_cb, char* p_cmd, char* p_end) {
   uint16_t idx;
   uint8_t arg_type;
   char* p_arg;
   int16_t int_arg = 0;
-  /* loop through at command table looking for match */
-  for (idx = 0; p_cb->p_at_tbl[idx].p_cmd[0] != 0; idx++) {
-    if (!utl_strucmp(p_cb->p_at_tbl[idx].p_cmd, p_cb->p_cmd_buf)) {
-      break;
-    }
-  }
+
+  idx = bta_ag_at_find(p_cb, p_cmd, p_end);
 
   /* if there is a match; verify argument type */
   if (p_cb->p_at_tbl[idx].p_cmd[0] != 0) {
     /* start of argument is p + strlen matching command */
-    p_arg = p_cb->p_cmd_buf + strlen(p_cb->p_at_tbl[idx].p_cmd);
+    p_arg = p_cmd + strlen(p_cb->p_at_tbl[idx].p_cmd);
     if (p_arg > p_end) {
       (*p_cb->p_err_cback)((tBTA_AG_SCB*)p_cb->p_user, false, nullptr);
       android_errorWriteLog(0x534e4554, "112860487");
@@ -154,65 +233,142 @@ void bta_ag_process_at(tBTA_AG_AT_CB* p_cb, char* p_end) {
   }
   /* else no match call error callback */
   else {
-    (*p_cb->p_err_cback)((tBTA_AG_SCB*)p_cb->p_user, true, p_cb->p_cmd_buf);
+    (*p_cb->p_err_cback)((tBTA_AG_SCB*)p_cb->p_user, true, p_cmd);
   }
 }
 
 /******************************************************************************
  *
- * Function         bta_ag_at_parse
+ * Function         bta_ag_process_line
  *
- * Description      Parse AT commands.  This function will take the input
- *                  character string and parse it for AT commands according to
- *                  the AT command table passed in the control block.
+ * Description      Process the command line p_line, which ends at p_end, if
+ *                  it is an AT command.
  *
  *
  * Returns          void
  *
  *****************************************************************************/
-void bta_ag_at_parse(tBTA_AG_AT_CB* p_cb, char* p_buf, uint16_t len) {
-  int i = 0;
-  char* p_save;
+static void bta_ag_process_line(tBTA_AG_AT_CB* p_cb, char* p_line,
+                                char* p_end) {
+  if ((p_end - p_line > 2) && (p_line[0] == 'A' || p_line[0] == 'a') &&
+      (p_line[1] == 'T' || p_line[1] == 't')) {
+    bta_ag_process_at(p_cb, p_line + 2, p_end);
+  }
+}
 
+/******************************************************************************
+ *
+ * Function         bta_ag_at_save
+ *
+ * Description      Copy the len characters at p to the command buffer.
+ *
+ *
+ * Returns          void
+ *
+ *****************************************************************************/
+static void bta_ag_at_save(tBTA_AG_AT_CB* p_cb, const char* p, uint16_t len) {
   if (p_cb->p_cmd_buf == nullptr) {
     p_cb->p_cmd_buf = (char*)osi_malloc(p_cb->cmd_max_len);
-    p_cb->cmd_pos = 0;
   }
+  memcpy(p_cb->p_cmd_buf, p, len);
+  p_cb->cmd_pos = len;
+}
 
-  for (i = 0; i < len;) {
-    while (p_cb->cmd_pos < p_cb->cmd_max_len - 1 && i < len) {
-      /* Skip null characters between AT commands. */
-      if ((p_cb->cmd_pos == 0) && (p_buf[i] == 0)) {
-        i++;
-        continue;
-      }
+/******************************************************************************
+ *
+ * Function         bta_ag_at_parse_split
+ *
+ * Description      Continue the command that the previous buffer ended in
+ *                  with the characters from p to p_stop.
+ *
+ *
+ * Returns          The first character following the command.
+ *
+ *****************************************************************************/
+static char* bta_ag_at_parse_split(tBTA_AG_AT_CB* p_cb, char* p,
+                                   char* p_stop) {
+  while (p < p_stop) {
+    /* too long for the command buffer; drop it */
+    if (p_cb->cmd_pos >= p_cb->cmd_max_len - 1) {
+      p_cb->cmd_pos = 0;
+      break;
+    }
 
-      p_cb->p_cmd_buf[p_cb->cmd_pos] = p_buf[i++];
-      if (p_cb->p_cmd_buf[p_cb->cmd_pos] == '\r' ||
-          p_cb->p_cmd_buf[p_cb->cmd_pos] == '\n') {
-        p_cb->p_cmd_buf[p_cb->cmd_pos] = 0;
-        if ((p_cb->cmd_pos > 2) &&
-            (p_cb->p_cmd_buf[0] == 'A' || p_cb->p_cmd_buf[0] == 'a') &&
-            (p_cb->p_cmd_buf[1] == 'T' || p_cb->p_cmd_buf[1] == 't')) {
-          p_save = p_cb->p_cmd_buf;
-          char* p_end = p_cb->p_cmd_buf + p_cb->cmd_pos;
-          p_cb->p_cmd_buf += 2;
-          bta_ag_process_at(p_cb, p_end);
-          p_cb->p_cmd_buf = p_save;
-        }
+    p_cb->p_cmd_buf[p_cb->cmd_pos] = *p++;
+    if (p_cb->p_cmd_buf[p_cb->cmd_pos] == '\r' ||
+        p_cb->p_cmd_buf[p_cb->cmd_pos] == '\n') {
+      p_cb->p_cmd_buf[p_cb->cmd_pos] = 0;
+      bta_ag_process_line(p_cb, p_cb->p_cmd_buf,
+                          p_cb->p_cmd_buf + p_cb->cmd_pos);
+      p_cb->cmd_pos = 0;
+      break;
+    } else if (p_cb->p_cmd_buf[p_cb->cmd_pos] == 0x1A ||
+               p_cb->p_cmd_buf[p_cb->cmd_pos] == 0x1B) {
+      p_cb->p_cmd_buf[++p_cb->cmd_pos] = 0;
+      (*p_cb->p_err_cback)((tBTA_AG_SCB*)p_cb->p_user, true, p_cb->p_cmd_buf);
+      p_cb->cmd_pos = 0;
+      break;
+    } else {
+      ++p_cb->cmd_pos;
+    }
+  }
+  return p;
+}
 
-        p_cb->cmd_pos = 0;
+/******************************************************************************
+ *
+ * Function         bta_ag_at_parse
+ *
+ * Description      Parse AT commands.  This function will take the input
+ *                  character string and parse it for AT commands according to
+ *                  the AT command table passed in the control block.  The
+ *                  commands are terminated in place in p_buf; only a command
+ *                  that continues in the next buffer is copied.
+ *
+ *
+ * Returns          void
+ *
+ *****************************************************************************/
+void bta_ag_at_parse(tBTA_AG_AT_CB* p_cb, char* p_buf, uint16_t len) {
+  char* p = p_buf;
+  char* p_stop = p_buf + len;
+  uint16_t max_len = p_cb->cmd_max_len - 1;
 
-      } else if (p_cb->p_cmd_buf[p_cb->cmd_pos] == 0x1A ||
-                 p_cb->p_cmd_buf[p_cb->cmd_pos] == 0x1B) {
-        p_cb->p_cmd_buf[++p_cb->cmd_pos] = 0;
-        (*p_cb->p_err_cback)((tBTA_AG_SCB*)p_cb->p_user, true, p_cb->p_cmd_buf);
-        p_cb->cmd_pos = 0;
+  while (p < p_stop) {
+    if (p_cb->cmd_pos != 0) {
+      p = bta_ag_at_parse_split(p_cb, p, p_stop);
+      continue;
+    }
+
+    /* Skip null characters between AT commands. */
+    if (*p == 0) {
+      p++;
+      continue;
+    }
+
+    uint16_t scan_len =
+        (p_stop - p < max_len) ? (uint16_t)(p_stop - p) : max_len;
+    char* p_term = (char*)AtFindTerminator(p, scan_len);
+    if (p_term == p + scan_len) {
+      if (scan_len == max_len) {
+        /* too long for the command buffer; drop it */
+        p += scan_len;
       } else {
-        ++p_cb->cmd_pos;
+        /* the command continues in the next buffer */
+        bta_ag_at_save(p_cb, p, scan_len);
+        p = p_stop;
       }
+    } else if (*p_term == '\r' || *p_term == '\n') {
+      *p_term = 0;
+      bta_ag_process_line(p_cb, p, p_term);
+      p = p_term + 1;
+    } else {
+      /* aborted by <ctrl-z> or <esc>, reported with the aborting character */
+      bta_ag_at_save(p_cb, p, p_term - p + 1);
+      p_cb->p_cmd_buf[p_cb->cmd_pos] = 0;
+      (*p_cb->p_err_cback)((tBTA_AG_SCB*)p_cb->p_user, true, p_cb->p_cmd_buf);
+      p_cb->cmd_pos = 0;
+      p = p_term + 1;
     }
-
-    if (i < len) p_cb->cmd_pos = 0;
   }
 }
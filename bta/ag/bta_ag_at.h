@@ -24,6 +24,8 @@
 #ifndef BTA_AG_AT_H
 #define BTA_AG_AT_H
 
+#include "bta_at_lexer.h"
+
 /*****************************************************************************
  *  Constants
  ****************************************************************************/
@@ -66,11 +68,12 @@ typedef void(tBTA_AG_AT_ERR_CBACK)(tBTA_AG_SCB* p_user, bool unknown,
 /* AT command parsing control block */
 typedef struct {
   const tBTA_AG_AT_CMD* p_at_tbl;    /* AT command table */
+  const AtNameTrie* p_at_trie;       /* index of the p_at_tbl names */
   tBTA_AG_AT_CMD_CBACK* p_cmd_cback; /* command callback */
   tBTA_AG_AT_ERR_CBACK* p_err_cback; /* error callback */
   void* p_user;                      /* user-defined data */
-  char* p_cmd_buf;                   /* temp parsing buffer */
-  uint16_t cmd_pos;                  /* position in temp buffer */
+  char* p_cmd_buf;                   /* command split across buffers */
+  uint16_t cmd_pos;                  /* length of the split command */
   uint16_t cmd_max_len;              /* length of temp buffer to allocate */
   uint8_t state;                     /* parsing state */
 } tBTA_AG_AT_CB;
@@ -83,7 +86,8 @@ typedef struct {
  *
  * Function         bta_ag_at_init
  *
- * Description      Initialize the AT command parser control block.
+ * Description      Initialize the AT command parser control block for the
+ *                  command table p_at_tbl it was given.
  *
  *
  * Returns          void
@@ -111,7 +115,9 @@ extern void bta_ag_at_reinit(tBTA_AG_AT_CB* p_cb);
  *
  * Description      Parse AT commands.  This function will take the input
  *                  character string and parse it for AT commands according to
- *                  the AT command table passed in the control block.
+ *                  the AT command table passed in the control block.  The
+ *                  commands are terminated in place in p_buf; only a command
+ *                  that continues in the next buffer is copied.
  *
  *
  * Returns          void
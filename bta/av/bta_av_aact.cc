@@ -337,6 +337,86 @@ static void bta_av_st_rc_timer(tBTA_AV_SCB* p_scb,
   }
 }
 
+/*******************************************************************************
+ *
+ * Function         bta_av_sep_cache_load
+ *
+ * Description      Load the SEPs of the peer, and their capabilities, found
+ *                  by the last stream discovery, from the SEP cache.
+ *
+ * Returns          The number of SEPs, or 0 if the peer has no SEP cache.
+ *
+ ******************************************************************************/
+static uint8_t bta_av_sep_cache_load(tBTA_AV_SCB* p_scb) {
+  std::vector<uint8_t> buf(BTA_AV_SEP_CACHE_MAX_LEN);
+  size_t len = buf.size();
+
+  if (!btif_config_get_bin(p_scb->PeerAddress().ToString(),
+                           BTA_AV_SEP_CACHE_CONFIG_KEY, buf.data(), &len)) {
+    return 0;
+  }
+
+  uint8_t num_seps = bta_av_sep_cache_decode(buf.data(), len, p_scb->sep_info,
+                                             p_scb->p_sep_caps);
+  if (num_seps == 0) {
+    APPL_TRACE_WARNING("%s: peer %s invalid SEP cache", __func__,
+                       p_scb->PeerAddress().ToString().c_str());
+    memset(p_scb->p_sep_caps, 0, BTA_AV_NUM_SEPS * sizeof(tBTA_AV_SEP_CAPS));
+  }
+  return num_seps;
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_av_sep_cache_store
+ *
+ * Description      Store the SEPs of the peer, and the capabilities found
+ *                  for them, in the SEP cache.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void bta_av_sep_cache_store(tBTA_AV_SCB* p_scb) {
+  std::vector<uint8_t> buf(BTA_AV_SEP_CACHE_MAX_LEN);
+  bool has_caps = false;
+
+  /* only the discoveries we initiated get the capabilities of the SEPs */
+  for (uint8_t i = 0; i < p_scb->num_seps; i++) {
+    if (p_scb->p_sep_caps[i].valid) has_caps = true;
+  }
+  if (!has_caps) return;
+
+  uint16_t len =
+      bta_av_sep_cache_encode(p_scb->sep_info, p_scb->p_sep_caps,
+                              p_scb->num_seps, buf.data(), buf.size());
+  if (len == 0) return;
+
+  if (btif_config_set_bin(p_scb->PeerAddress().ToString(),
+                          BTA_AV_SEP_CACHE_CONFIG_KEY, buf.data(), len)) {
+    btif_config_save();
+  } else {
+    APPL_TRACE_WARNING("%s: Failed to store peer SEP cache for %s", __func__,
+                       p_scb->PeerAddress().ToString().c_str());
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_av_sep_cache_remove
+ *
+ * Description      Remove the SEP cache of the peer, once it was found out
+ *                  of date.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void bta_av_sep_cache_remove(tBTA_AV_SCB* p_scb) {
+  if (btif_config_remove(p_scb->PeerAddress().ToString(),
+                         BTA_AV_SEP_CACHE_CONFIG_KEY)) {
+    btif_config_save();
+  }
+}
+
 /*******************************************************************************
  *
  * Function         bta_av_next_getcap
@@ -365,6 +445,26 @@ static bool bta_av_next_getcap(tBTA_AV_SCB* p_scb, tBTA_AV_DATA* p_data) {
         (p_scb->sep_info[i].media_type == p_scb->media_type)) {
       p_scb->sep_info_idx = i;
 
+      /* the capabilities of the stream may be in the SEP cache */
+      if (p_scb->sep_cache_used && p_scb->p_sep_caps[i].valid) {
+        const tBTA_AV_SEP_CAPS* p_caps = &p_scb->p_sep_caps[i];
+        tAVDT_CTRL avdt_ctrl;
+
+        p_scb->peer_cap.Reset();
+        p_scb->peer_cap.num_codec = p_caps->num_codec;
+        p_scb->peer_cap.num_protect = p_caps->num_protect;
+        p_scb->peer_cap.psc_mask = p_caps->psc_mask;
+        memcpy(p_scb->peer_cap.codec_info, p_caps->codec_info,
+               AVDT_CODEC_SIZE);
+        memcpy(p_scb->peer_cap.protect_info, p_caps->protect_info,
+               AVDT_PROTECT_SIZE);
+        memset(&avdt_ctrl, 0, sizeof(avdt_ctrl));
+        bta_av_proc_stream_evt(0, p_scb->PeerAddress(), AVDT_GETCAP_CFM_EVT,
+                               &avdt_ctrl, p_scb->hdi);
+        sent_cmd = true;
+        break;
+      }
+
       /* we got a stream; get its capabilities */
       bool get_all_cap = (p_scb->AvdtpVersion() >= AVDT_VERSION_1_3) &&
                          (A2DP_GetAvdtpVersion() >= AVDT_VERSION_1_3);
@@ -524,6 +624,12 @@ void bta_av_sink_data_cback(uint8_t handle, BT_HDR* p_pkt, uint32_t time_stamp,
     return;
   }
   p_pkt->event = BTA_AV_SINK_MEDIA_DATA_EVT;
+  /* The media header is consumed: keep the timestamp just before the payload,
+   * see BTA_AvGetSinkMediaTimestamp() */
+  if (p_pkt->offset >= sizeof(time_stamp)) {
+    memcpy((uint8_t*)(p_pkt + 1) + p_pkt->offset - sizeof(time_stamp),
+           &time_stamp, sizeof(time_stamp));
+  }
   p_scb->seps[p_scb->sep_idx].p_app_sink_data_cback(
       p_scb->PeerAddress(), BTA_AV_SINK_MEDIA_DATA_EVT, (tBTA_AV_MEDIA*)p_pkt);
   /* Free the buffer: a copy of the packet has been delivered */
@@ -1248,6 +1354,13 @@ void bta_av_str_opened(tBTA_AV_SCB* p_scb, tBTA_AV_DATA* p_data) {
   p_scb->l2c_bufs = 0;
   p_scb->p_cos->open(p_scb->hndl, p_scb->PeerAddress(), p_scb->stream_mtu);
 
+  /* the SEPs found by the stream discovery are good for the next time */
+  if (p_scb->p_sep_caps != NULL) {
+    if (!p_scb->sep_cache_used) bta_av_sep_cache_store(p_scb);
+    osi_free_and_reset((void**)&p_scb->p_sep_caps);
+  }
+  p_scb->sep_cache_used = false;
+
   {
     /* TODO check if other audio channel is open.
      * If yes, check if reconfig is needed
@@ -1652,6 +1765,17 @@ void bta_av_open_failed(tBTA_AV_SCB* p_scb, tBTA_AV_DATA* p_data) {
 
   APPL_TRACE_ERROR("%s: peer_addr=%s", __func__,
                    p_scb->PeerAddress().ToString().c_str());
+
+  /* the SEP cache is out of date: do the stream discovery instead */
+  if (p_scb->sep_cache_used) {
+    APPL_TRACE_WARNING("%s: peer %s removing the SEP cache", __func__,
+                       p_scb->PeerAddress().ToString().c_str());
+    bta_av_sep_cache_remove(p_scb);
+    bta_av_set_scb_sst_opening(p_scb);
+    bta_av_discover_req(p_scb, p_data);
+    return;
+  }
+
   p_scb->open_status = BTA_AV_FAIL_STREAM;
   bta_av_cco_close(p_scb, p_data);
 
@@ -1719,6 +1843,18 @@ void bta_av_getcap_results(tBTA_AV_SCB* p_scb, tBTA_AV_DATA* p_data) {
   memcpy(cfg.codec_info, p_scb->peer_cap.codec_info, AVDT_CODEC_SIZE);
   memcpy(cfg.protect_info, p_scb->peer_cap.protect_info, AVDT_PROTECT_SIZE);
 
+  /* keep the capabilities for the SEP cache */
+  if (!p_scb->sep_cache_used && p_scb->p_sep_caps != NULL) {
+    tBTA_AV_SEP_CAPS* p_caps = &p_scb->p_sep_caps[p_scb->sep_info_idx];
+    p_caps->valid = true;
+    p_caps->num_codec = p_scb->peer_cap.num_codec;
+    p_caps->num_protect = p_scb->peer_cap.num_protect;
+    p_caps->psc_mask = p_scb->peer_cap.psc_mask;
+    memcpy(p_caps->codec_info, p_scb->peer_cap.codec_info, AVDT_CODEC_SIZE);
+    memcpy(p_caps->protect_info, p_scb->peer_cap.protect_info,
+           AVDT_PROTECT_SIZE);
+  }
+
   APPL_TRACE_DEBUG("%s: peer %s bta_handle:0x%x num_codec:%d psc_mask=0x%x",
                    __func__, p_scb->PeerAddress().ToString().c_str(),
                    p_scb->hndl, p_scb->peer_cap.num_codec, p_scb->cfg.psc_mask);
@@ -1823,6 +1959,31 @@ void bta_av_setconfig_rej(tBTA_AV_SCB* p_scb, tBTA_AV_DATA* p_data) {
  *
  ******************************************************************************/
 void bta_av_discover_req(tBTA_AV_SCB* p_scb, UNUSED_ATTR tBTA_AV_DATA* p_data) {
+  if (p_scb->p_sep_caps == NULL) {
+    p_scb->p_sep_caps = (tBTA_AV_SEP_CAPS*)osi_calloc(
+        BTA_AV_NUM_SEPS * sizeof(tBTA_AV_SEP_CAPS));
+  } else {
+    memset(p_scb->p_sep_caps, 0, BTA_AV_NUM_SEPS * sizeof(tBTA_AV_SEP_CAPS));
+  }
+  p_scb->sep_cache_used = false;
+
+  /* when we initiate the connection, use the SEPs found the last time */
+  if (p_scb->state == BTA_AV_OPENING_SST) {
+    uint8_t num_seps = bta_av_sep_cache_load(p_scb);
+    if (num_seps > 0) {
+      tAVDT_CTRL avdt_ctrl;
+
+      APPL_TRACE_DEBUG("%s: peer %s using %d cached SEPs", __func__,
+                       p_scb->PeerAddress().ToString().c_str(), num_seps);
+      p_scb->sep_cache_used = true;
+      memset(&avdt_ctrl, 0, sizeof(avdt_ctrl));
+      avdt_ctrl.discover_cfm.num_seps = num_seps;
+      bta_av_proc_stream_evt(0, p_scb->PeerAddress(), AVDT_DISCOVER_CFM_EVT,
+                             &avdt_ctrl, p_scb->hdi);
+      return;
+    }
+  }
+
   /* send avdtp discover request */
 
   AVDT_DiscoverReq(p_scb->PeerAddress(), p_scb->hdi, p_scb->sep_info,
@@ -2196,6 +2357,7 @@ void bta_av_data_path(tBTA_AV_SCB* p_scb, UNUSED_ATTR tBTA_AV_DATA* p_data) {
         memcpy(packet2, data_begin, fragment_len);
         p_buf2->len += fragment_len;
         extra_fragments.push_back(p_buf2);
+        p_scb->mtu_fragment_copies++;
         p_buf->len -= fragment_len;
       }
 
@@ -276,6 +276,16 @@ void BTA_AvOffloadStartRsp(tBTA_AV_HNDL hndl, tBTA_AV_STATUS status) {
   bta_sys_sendmsg(p_buf);
 }
 
+uint32_t BTA_AvGetSinkMediaTimestamp(const BT_HDR* p_pkt) {
+  uint32_t time_stamp = 0;
+  if (p_pkt->offset >= sizeof(time_stamp)) {
+    memcpy(&time_stamp,
+           (const uint8_t*)(p_pkt + 1) + p_pkt->offset - sizeof(time_stamp),
+           sizeof(time_stamp));
+  }
+  return time_stamp;
+}
+
 /*******************************************************************************
  *
  * Function         BTA_AvStop
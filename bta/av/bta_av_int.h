@@ -127,6 +127,13 @@ enum {
 /* maximum number of SEPS in stream discovery results */
 #define BTA_AV_NUM_SEPS 32
 
+/* btif_config key of the peer SEPs and capabilities found the last time */
+#define BTA_AV_SEP_CACHE_CONFIG_KEY "AvdtpSepCache"
+
+/* maximum size of the encoded SEP cache */
+#define BTA_AV_SEP_CACHE_MAX_LEN \
+  (2 + BTA_AV_NUM_SEPS * (10 + AVDT_CODEC_SIZE + AVDT_PROTECT_SIZE))
+
 /* initialization value for AVRC handle */
 #define BTA_AV_RC_HANDLE_NONE 0xFF
 
@@ -454,6 +461,16 @@ typedef union {
 #define BTA_AV_COLL_API_CALLED \
   0x02 /* API open was called while incoming timer is running */
 
+/* the capabilities of a peer SEP, as kept in the SEP cache */
+typedef struct {
+  bool valid;          /* true if the capabilities were received */
+  uint8_t num_codec;   /* Number of media codec information elements */
+  uint8_t num_protect; /* Number of content protection information elements */
+  uint16_t psc_mask;   /* Protocol service capabilities mask */
+  uint8_t codec_info[AVDT_CODEC_SIZE];     /* Codec capabilities array */
+  uint8_t protect_info[AVDT_PROTECT_SIZE]; /* Content protection capabilities */
+} tBTA_AV_SEP_CAPS;
+
 /* type for AV stream control block */
 // TODO: This should be renamed and changed to a proper class
 struct tBTA_AV_SCB final {
@@ -466,6 +483,7 @@ struct tBTA_AV_SCB final {
   list_t* a2dp_list; /* used for audio channels only */
   tBTA_AV_Q_INFO q_info;
   tAVDT_SEP_INFO sep_info[BTA_AV_NUM_SEPS]; /* stream discovery results */
+  tBTA_AV_SEP_CAPS* p_sep_caps;             /* capabilities of sep_info[] */
   AvdtpSepConfig cfg;                       /* local SEP configuration */
   alarm_t* avrc_ct_timer;                   /* delay timer for AVRC CT */
   uint16_t l2c_cid;                         /* L2CAP channel ID */
@@ -492,6 +510,7 @@ struct tBTA_AV_SCB final {
   uint8_t num_recfg;          /* number of reconfigure sent */
   uint8_t role;
   uint8_t l2c_bufs;  /* the number of buffers queued to L2CAP */
+  uint32_t mtu_fragment_copies; /* media fragments copied to fit the MTU */
   uint8_t rc_handle; /* connected AVRCP handle */
   bool use_rc;       /* true if AVRCP is allowed */
   bool started;      /* true if stream started */
@@ -514,6 +533,8 @@ struct tBTA_AV_SCB final {
   uint16_t uuid_int; /*intended UUID of Initiator to connect to */
   bool offload_start_pending;
   bool offload_started;
+  bool sep_cache_used; /* true if sep_info[] is from the SEP cache, and not
+                          from a stream discovery */
 
   /**
    * Called to setup the state when connected to a peer.
@@ -684,6 +705,7 @@ extern bool bta_av_is_scb_incoming(tBTA_AV_SCB* p_scb);
 extern void bta_av_set_scb_sst_init(tBTA_AV_SCB* p_scb);
 extern bool bta_av_is_scb_init(tBTA_AV_SCB* p_scb);
 extern void bta_av_set_scb_sst_incoming(tBTA_AV_SCB* p_scb);
+extern void bta_av_set_scb_sst_opening(tBTA_AV_SCB* p_scb);
 extern tBTA_AV_LCB* bta_av_find_lcb(const RawAddress& addr, uint8_t op);
 extern const char* bta_av_sst_code(uint8_t state);
 extern void bta_av_free_scb(tBTA_AV_SCB* p_scb);
@@ -785,4 +807,13 @@ extern void bta_av_offload_req(tBTA_AV_SCB* p_scb, tBTA_AV_DATA* p_data);
 extern void bta_av_offload_rsp(tBTA_AV_SCB* p_scb, tBTA_AV_DATA* p_data);
 extern void bta_av_vendor_offload_stop(void);
 
+/* SEP cache functions */
+extern uint16_t bta_av_sep_cache_encode(const tAVDT_SEP_INFO* p_sep_info,
+                                        const tBTA_AV_SEP_CAPS* p_sep_caps,
+                                        uint8_t num_seps, uint8_t* p_buf,
+                                        uint16_t buf_len);
+extern uint8_t bta_av_sep_cache_decode(const uint8_t* p_buf, uint16_t len,
+                                       tAVDT_SEP_INFO* p_sep_info,
+                                       tBTA_AV_SEP_CAPS* p_sep_caps);
+
 #endif /* BTA_AV_INT_H */
@@ -393,6 +393,7 @@ void bta_av_free_scb(tBTA_AV_SCB* p_scb) {
   CHECK(p_scb == bta_av_cb.p_scb[scb_index]);
   bta_av_cb.p_scb[scb_index] = nullptr;
   alarm_free(p_scb->avrc_ct_timer);
+  osi_free(p_scb->p_sep_caps);
   // TODO: After tBTA_AV_SCB is changed to a proper class, the entry
   // here should be de-allocated by C++ 'delete' statement.
   osi_free(p_scb);
@@ -1543,6 +1544,8 @@ void bta_debug_av_dump(int fd) {
     dprintf(fd, "    Application ID: %d\n", p_scb->app_id);
     dprintf(fd, "    Role: 0x%x\n", p_scb->role);
     dprintf(fd, "    Queued L2CAP buffers: %d\n", p_scb->l2c_bufs);
+    dprintf(fd, "    Media fragments copied to fit the MTU: %u\n",
+            p_scb->mtu_fragment_copies);
     dprintf(fd, "    AVRCP allowed: %s\n", p_scb->use_rc ? "true" : "false");
     dprintf(fd, "    Stream started: %s\n", p_scb->started ? "true" : "false");
     dprintf(fd, "    Stream call-out started: %d\n", p_scb->co_started);
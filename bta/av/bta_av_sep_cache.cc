@@ -0,0 +1,187 @@
+/******************************************************************************
+ *
+ *  Copyright 2020 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This module contains the encoding of the SEP cache: the stream endpoints
+ *  of a peer, and their capabilities, as found by the last stream discovery.
+ *  The SEP cache is kept in the device configuration, so the next connection
+ *  to the peer can skip the AVDTP Discover and Get (All) Capabilities
+ *  procedures.
+ *
+ ******************************************************************************/
+
+#include <string.h>
+
+#include "bt_types.h"
+#include "bta_av_int.h"
+
+/*****************************************************************************
+ *  Constants
+ ****************************************************************************/
+
+/* version of the SEP cache encoding */
+#define BTA_AV_SEP_CACHE_VERSION 1
+
+/* flags of an encoded SEP */
+#define BTA_AV_SEP_CACHE_FLAG_CAPS 0x01 /* the SEP capabilities follow */
+
+/*******************************************************************************
+ *
+ * Function         bta_av_sep_cache_protect_len
+ *
+ * Description      Get the length of the content protection elements of
+ *                  |p_caps|.
+ *
+ * Returns          The length, or 0 if the elements are not valid.
+ *
+ ******************************************************************************/
+static uint16_t bta_av_sep_cache_protect_len(const tBTA_AV_SEP_CAPS* p_caps) {
+  uint16_t len = 0;
+
+  for (uint8_t i = 0; i < p_caps->num_protect; i++) {
+    if (len >= AVDT_PROTECT_SIZE) return 0;
+    len += 1 + p_caps->protect_info[len];
+  }
+  if (len > AVDT_PROTECT_SIZE) return 0;
+  return len;
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_av_sep_cache_encode
+ *
+ * Description      Encode the |num_seps| SEPs of |p_sep_info|, and their
+ *                  capabilities in |p_sep_caps|, into |p_buf|.
+ *
+ * Returns          The length of the encoded data, or 0 if it does not fit
+ *                  in the |buf_len| bytes of |p_buf|.
+ *
+ ******************************************************************************/
+uint16_t bta_av_sep_cache_encode(const tAVDT_SEP_INFO* p_sep_info,
+                                 const tBTA_AV_SEP_CAPS* p_sep_caps,
+                                 uint8_t num_seps, uint8_t* p_buf,
+                                 uint16_t buf_len) {
+  uint8_t* p = p_buf;
+  uint8_t* p_end = p_buf + buf_len;
+
+  if (num_seps > BTA_AV_NUM_SEPS || buf_len < 2) return 0;
+  UINT8_TO_STREAM(p, BTA_AV_SEP_CACHE_VERSION);
+  UINT8_TO_STREAM(p, num_seps);
+
+  for (uint8_t i = 0; i < num_seps; i++) {
+    const tBTA_AV_SEP_CAPS* p_caps = &p_sep_caps[i];
+    uint8_t codec_len = 0;
+    uint16_t protect_len = 0;
+
+    if (p_caps->valid) {
+      codec_len = p_caps->codec_info[0] + 1;
+      if (codec_len > AVDT_CODEC_SIZE) return 0;
+      protect_len = bta_av_sep_cache_protect_len(p_caps);
+      if (p_caps->num_protect != 0 && protect_len == 0) return 0;
+    }
+    if (p_end - p < 4 + (p_caps->valid ? 6 + codec_len + protect_len : 0)) {
+      return 0;
+    }
+
+    UINT8_TO_STREAM(p, p_sep_info[i].seid);
+    UINT8_TO_STREAM(p, p_sep_info[i].media_type);
+    UINT8_TO_STREAM(p, p_sep_info[i].tsep);
+    UINT8_TO_STREAM(p, p_caps->valid ? BTA_AV_SEP_CACHE_FLAG_CAPS : 0);
+    if (!p_caps->valid) continue;
+
+    UINT8_TO_STREAM(p, p_caps->num_codec);
+    UINT8_TO_STREAM(p, p_caps->num_protect);
+    UINT16_TO_STREAM(p, p_caps->psc_mask);
+    UINT8_TO_STREAM(p, codec_len);
+    ARRAY_TO_STREAM(p, p_caps->codec_info, codec_len);
+    UINT8_TO_STREAM(p, protect_len);
+    ARRAY_TO_STREAM(p, p_caps->protect_info, protect_len);
+  }
+
+  return (uint16_t)(p - p_buf);
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_av_sep_cache_decode
+ *
+ * Description      Decode the SEPs encoded in the |len| bytes of |p_buf| into
+ *                  |p_sep_info|, and their capabilities into |p_sep_caps|.
+ *                  Both arrays must have BTA_AV_NUM_SEPS elements.
+ *
+ * Returns          The number of SEPs, or 0 if the data is not valid.
+ *
+ ******************************************************************************/
+uint8_t bta_av_sep_cache_decode(const uint8_t* p_buf, uint16_t len,
+                                tAVDT_SEP_INFO* p_sep_info,
+                                tBTA_AV_SEP_CAPS* p_sep_caps) {
+  const uint8_t* p = p_buf;
+  const uint8_t* p_end = p_buf + len;
+  uint8_t version, num_seps;
+
+  if (len < 2) return 0;
+  STREAM_TO_UINT8(version, p);
+  STREAM_TO_UINT8(num_seps, p);
+  if (version != BTA_AV_SEP_CACHE_VERSION || num_seps == 0 ||
+      num_seps > BTA_AV_NUM_SEPS) {
+    return 0;
+  }
+
+  memset(p_sep_caps, 0, num_seps * sizeof(tBTA_AV_SEP_CAPS));
+  for (uint8_t i = 0; i < num_seps; i++) {
+    tAVDT_SEP_INFO* p_info = &p_sep_info[i];
+    tBTA_AV_SEP_CAPS* p_caps = &p_sep_caps[i];
+    uint8_t flags, codec_len, protect_len;
+
+    if (p_end - p < 4) return 0;
+    p_info->in_use = false;
+    STREAM_TO_UINT8(p_info->seid, p);
+    STREAM_TO_UINT8(p_info->media_type, p);
+    STREAM_TO_UINT8(p_info->tsep, p);
+    STREAM_TO_UINT8(flags, p);
+    if (p_info->seid < 0x01 || p_info->seid > 0x3E ||
+        p_info->tsep > AVDT_TSEP_SNK) {
+      return 0;
+    }
+    if (!(flags & BTA_AV_SEP_CACHE_FLAG_CAPS)) continue;
+
+    if (p_end - p < 5) return 0;
+    STREAM_TO_UINT8(p_caps->num_codec, p);
+    STREAM_TO_UINT8(p_caps->num_protect, p);
+    STREAM_TO_UINT16(p_caps->psc_mask, p);
+    STREAM_TO_UINT8(codec_len, p);
+    if (codec_len == 0 || codec_len > AVDT_CODEC_SIZE ||
+        p_end - p < codec_len + 1) {
+      return 0;
+    }
+    STREAM_TO_ARRAY(p_caps->codec_info, p, codec_len);
+    STREAM_TO_UINT8(protect_len, p);
+    if (protect_len > AVDT_PROTECT_SIZE || p_end - p < protect_len) return 0;
+    STREAM_TO_ARRAY(p_caps->protect_info, p, protect_len);
+
+    /* the elements must be the ones the lengths were computed from */
+    if (codec_len != p_caps->codec_info[0] + 1 ||
+        protect_len != bta_av_sep_cache_protect_len(p_caps)) {
+      return 0;
+    }
+    p_caps->valid = true;
+  }
+
+  return (p == p_end) ? num_seps : 0;
+}
@@ -26,6 +26,7 @@
 #include "bt_target.h"
 #include "bta_av_co.h"
 #include "bta_av_int.h"
+#include "common/table_state_machine.h"
 
 /*****************************************************************************
  * Constants and types
@@ -38,7 +39,8 @@ enum {
   BTA_AV_OPENING_SST,
   BTA_AV_OPEN_SST,
   BTA_AV_RCFG_SST,
-  BTA_AV_CLOSING_SST
+  BTA_AV_CLOSING_SST,
+  BTA_AV_NUM_SST
 };
 
 /* state machine action enumeration list */
@@ -99,13 +101,20 @@ enum {
 #define BTA_AV_SIGNORE BTA_AV_NUM_SACTIONS
 
 /* state table information */
-/* #define BTA_AV_SACTION_COL           0       position of actions */
-#define BTA_AV_SACTIONS 2    /* number of actions */
-#define BTA_AV_SNEXT_STATE 2 /* position of next state */
-#define BTA_AV_NUM_COLS 3    /* number of columns in state tables */
+#define BTA_AV_SACTIONS 2 /* number of actions */
+#define BTA_AV_NUM_SEVTS \
+  (BTA_AV_API_OFFLOAD_START_RSP_EVT - BTA_AV_FIRST_SSM_EVT + 1)
+
+/* type for state tables, checked at compile time */
+using tBTA_AV_SST_TBL =
+    bluetooth::common::TransitionTable<BTA_AV_NUM_SST, BTA_AV_NUM_SEVTS,
+                                       BTA_AV_NUM_SACTIONS, BTA_AV_SACTIONS>;
+static_assert(tBTA_AV_SST_TBL::kIgnore == BTA_AV_SIGNORE,
+              "BTA_AV_SIGNORE must end the actions of a transition");
 
 /* state table for init state */
-static const uint8_t bta_av_sst_init[][BTA_AV_NUM_COLS] = {
+static constexpr tBTA_AV_SST_TBL::StateTable bta_av_sst_init =
+    tBTA_AV_SST_TBL::MakeStateTable({
     /* Event                     Action 1               Action 2 Next state */
     /* API_OPEN_EVT */ {BTA_AV_DO_DISC, BTA_AV_SIGNORE, BTA_AV_OPENING_SST},
     /* API_CLOSE_EVT */ {BTA_AV_CLEANUP, BTA_AV_SIGNORE, BTA_AV_INIT_SST},
@@ -149,10 +158,11 @@ static const uint8_t bta_av_sst_init[][BTA_AV_NUM_COLS] = {
     /* API_OFFLOAD_START_EVT */
     {BTA_AV_OFFLOAD_REQ, BTA_AV_SIGNORE, BTA_AV_INIT_SST},
     /* API_OFFLOAD_START_RSP_EVT */
-    {BTA_AV_OFFLOAD_RSP, BTA_AV_SIGNORE, BTA_AV_INIT_SST}};
+    {BTA_AV_OFFLOAD_RSP, BTA_AV_SIGNORE, BTA_AV_INIT_SST}});
 
 /* state table for incoming state */
-static const uint8_t bta_av_sst_incoming[][BTA_AV_NUM_COLS] = {
+static constexpr tBTA_AV_SST_TBL::StateTable bta_av_sst_incoming =
+    tBTA_AV_SST_TBL::MakeStateTable({
     /* Event                     Action 1               Action 2 Next state */
     /* API_OPEN_EVT */ {BTA_AV_OPEN_AT_INC, BTA_AV_SIGNORE,
                         BTA_AV_INCOMING_SST},
@@ -218,10 +228,11 @@ static const uint8_t bta_av_sst_incoming[][BTA_AV_NUM_COLS] = {
     /* API_OFFLOAD_START_EVT */
     {BTA_AV_OFFLOAD_REQ, BTA_AV_SIGNORE, BTA_AV_INCOMING_SST},
     /* API_OFFLOAD_START_RSP_EVT */
-    {BTA_AV_OFFLOAD_RSP, BTA_AV_SIGNORE, BTA_AV_INCOMING_SST}};
+    {BTA_AV_OFFLOAD_RSP, BTA_AV_SIGNORE, BTA_AV_INCOMING_SST}});
 
 /* state table for opening state */
-static const uint8_t bta_av_sst_opening[][BTA_AV_NUM_COLS] = {
+static constexpr tBTA_AV_SST_TBL::StateTable bta_av_sst_opening =
+    tBTA_AV_SST_TBL::MakeStateTable({
     /* Event                     Action 1               Action 2 Next state */
     /* API_OPEN_EVT */ {BTA_AV_SIGNORE, BTA_AV_SIGNORE, BTA_AV_OPENING_SST},
     /* API_CLOSE_EVT */ {BTA_AV_DO_CLOSE, BTA_AV_SIGNORE, BTA_AV_CLOSING_SST},
@@ -284,10 +295,11 @@ static const uint8_t bta_av_sst_opening[][BTA_AV_NUM_COLS] = {
     /* API_OFFLOAD_START_EVT */
     {BTA_AV_OFFLOAD_REQ, BTA_AV_SIGNORE, BTA_AV_OPENING_SST},
     /* API_OFFLOAD_START_RSP_EVT */
-    {BTA_AV_OFFLOAD_RSP, BTA_AV_SIGNORE, BTA_AV_OPENING_SST}};
+    {BTA_AV_OFFLOAD_RSP, BTA_AV_SIGNORE, BTA_AV_OPENING_SST}});
 
 /* state table for open state */
-static const uint8_t bta_av_sst_open[][BTA_AV_NUM_COLS] = {
+static constexpr tBTA_AV_SST_TBL::StateTable bta_av_sst_open =
+    tBTA_AV_SST_TBL::MakeStateTable({
     /* Event                     Action 1               Action 2 Next state */
     /* API_OPEN_EVT */ {BTA_AV_SIGNORE, BTA_AV_SIGNORE, BTA_AV_OPEN_SST},
     /* API_CLOSE_EVT */ {BTA_AV_DO_CLOSE, BTA_AV_SIGNORE, BTA_AV_CLOSING_SST},
@@ -339,10 +351,11 @@ static const uint8_t bta_av_sst_open[][BTA_AV_NUM_COLS] = {
     /* API_OFFLOAD_START_EVT */
     {BTA_AV_OFFLOAD_REQ, BTA_AV_SIGNORE, BTA_AV_OPEN_SST},
     /* API_OFFLOAD_START_RSP_EVT */
-    {BTA_AV_OFFLOAD_RSP, BTA_AV_SIGNORE, BTA_AV_OPEN_SST}};
+    {BTA_AV_OFFLOAD_RSP, BTA_AV_SIGNORE, BTA_AV_OPEN_SST}});
 
 /* state table for reconfig state */
-static const uint8_t bta_av_sst_rcfg[][BTA_AV_NUM_COLS] = {
+static constexpr tBTA_AV_SST_TBL::StateTable bta_av_sst_rcfg =
+    tBTA_AV_SST_TBL::MakeStateTable({
     /* Event                     Action 1               Action 2 Next state */
     /* API_OPEN_EVT */ {BTA_AV_SIGNORE, BTA_AV_SIGNORE, BTA_AV_RCFG_SST},
     /* API_CLOSE_EVT */
@@ -394,10 +407,11 @@ static const uint8_t bta_av_sst_rcfg[][BTA_AV_NUM_COLS] = {
     /* API_OFFLOAD_START_EVT */
     {BTA_AV_OFFLOAD_REQ, BTA_AV_SIGNORE, BTA_AV_RCFG_SST},
     /* API_OFFLOAD_START_RSP_EVT */
-    {BTA_AV_OFFLOAD_RSP, BTA_AV_SIGNORE, BTA_AV_RCFG_SST}};
+    {BTA_AV_OFFLOAD_RSP, BTA_AV_SIGNORE, BTA_AV_RCFG_SST}});
 
 /* state table for closing state */
-static const uint8_t bta_av_sst_closing[][BTA_AV_NUM_COLS] = {
+static constexpr tBTA_AV_SST_TBL::StateTable bta_av_sst_closing =
+    tBTA_AV_SST_TBL::MakeStateTable({
     /* Event                     Action 1               Action 2 Next state */
     /* API_OPEN_EVT */ {BTA_AV_SIGNORE, BTA_AV_SIGNORE, BTA_AV_CLOSING_SST},
     /* API_CLOSE_EVT */
@@ -457,15 +471,13 @@ static const uint8_t bta_av_sst_closing[][BTA_AV_NUM_COLS] = {
     /* API_OFFLOAD_START_EVT */
     {BTA_AV_OFFLOAD_REQ, BTA_AV_SIGNORE, BTA_AV_CLOSING_SST},
     /* API_OFFLOAD_START_RSP_EVT */
-    {BTA_AV_OFFLOAD_RSP, BTA_AV_SIGNORE, BTA_AV_CLOSING_SST}};
-
-/* type for state table */
-typedef const uint8_t (*tBTA_AV_SST_TBL)[BTA_AV_NUM_COLS];
+    {BTA_AV_OFFLOAD_RSP, BTA_AV_SIGNORE, BTA_AV_CLOSING_SST}});
 
 /* state table */
-static const tBTA_AV_SST_TBL bta_av_sst_tbl[] = {
+static constexpr tBTA_AV_SST_TBL bta_av_sst_tbl({
     bta_av_sst_init, bta_av_sst_incoming, bta_av_sst_opening,
-    bta_av_sst_open, bta_av_sst_rcfg,     bta_av_sst_closing};
+    bta_av_sst_open, bta_av_sst_rcfg, bta_av_sst_closing});
+static_assert(bta_av_sst_tbl.IsValid(), "bad AV stream state table");
 
 
 /*******************************************************************************
@@ -486,12 +498,12 @@ void bta_av_ssm_execute(tBTA_AV_SCB* p_scb, uint16_t event,
     return;
   }
 
-  /* look up the state table for the current state */
-  tBTA_AV_SST_TBL state_table = bta_av_sst_tbl[p_scb->state];
+  /* look up the transition for the event in the current state */
+  const tBTA_AV_SST_TBL::Transition& transition =
+      bta_av_sst_tbl.Lookup(p_scb->state, event - BTA_AV_FIRST_SSM_EVT);
 
   /* set next state */
-  auto new_state =
-      state_table[event - BTA_AV_FIRST_SSM_EVT][BTA_AV_SNEXT_STATE];
+  auto new_state = transition.next_state;
   if (p_scb->state != new_state) {
     APPL_TRACE_WARNING(
         "%s: peer %s AV event(0x%x)=0x%x(%s) state=%d(%s) -> %d(%s) p_scb=%p",
@@ -505,8 +517,7 @@ void bta_av_ssm_execute(tBTA_AV_SCB* p_scb, uint16_t event,
         bta_av_evt_code(event), p_scb->state, bta_av_sst_code(p_scb->state),
         p_scb);
   }
-  event -= BTA_AV_FIRST_SSM_EVT;
-  p_scb->state = state_table[event][BTA_AV_SNEXT_STATE];
+  p_scb->state = new_state;
 
   APPL_TRACE_VERBOSE("%s: peer %s AV next state=%d(%s) p_scb=%p(0x%x)",
                      __func__, p_scb->PeerAddress().ToString().c_str(),
@@ -514,13 +525,7 @@ void bta_av_ssm_execute(tBTA_AV_SCB* p_scb, uint16_t event,
                      p_scb->hndl);
 
   /* execute action functions */
-  for (int i = 0; i < BTA_AV_SACTIONS; i++) {
-    uint8_t action = state_table[event][i];
-    if (action != BTA_AV_SIGNORE) {
-      (*p_scb->p_act_tbl[action])(p_scb, p_data);
-    } else
-      break;
-  }
+  tBTA_AV_SST_TBL::RunActions(transition, p_scb->p_act_tbl, p_scb, p_data);
 }
 
 /*******************************************************************************
@@ -625,6 +630,22 @@ void bta_av_set_scb_sst_incoming(tBTA_AV_SCB* p_scb) {
   }
 }
 
+/*******************************************************************************
+ *
+ * Function         bta_av_set_scb_sst_opening
+ *
+ * Description      Set SST state to opening.
+ *                  Use this function to change SST outside of state machine.
+ *
+ * Returns          None
+ *
+ ******************************************************************************/
+void bta_av_set_scb_sst_opening(tBTA_AV_SCB* p_scb) {
+  if (p_scb) {
+    p_scb->state = BTA_AV_OPENING_SST;
+  }
+}
+
 /*****************************************************************************
  *  Debug Functions
  ****************************************************************************/
@@ -0,0 +1,158 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "bta/ag/bta_ag_at.h"
+#include "bta/include/utl.h"
+#include "bta/sys/bta_at_lexer.h"
+#include "stack/include/btm_api.h"
+
+using ::benchmark::State;
+
+/* utl.cc links against the device class functions of the stack */
+uint8_t* BTM_ReadDeviceClass(void) { return nullptr; }
+tBTM_STATUS BTM_SetDeviceClass(DEV_CLASS dev_class) { return BTM_SUCCESS; }
+
+namespace {
+
+/* The names of the HFP command table, in its order */
+const tBTA_AG_AT_CMD bench_at_tbl[] = {
+    {"A", 0, BTA_AG_AT_NONE, BTA_AG_AT_STR, 0, 0},
+    {"D", 1, BTA_AG_AT_NONE | BTA_AG_AT_FREE, BTA_AG_AT_STR, 0, 0},
+    {"+VGS", 2, BTA_AG_AT_SET, BTA_AG_AT_INT, 0, 15},
+    {"+VGM", 3, BTA_AG_AT_SET, BTA_AG_AT_INT, 0, 15},
+    {"+CCWA", 4, BTA_AG_AT_SET, BTA_AG_AT_INT, 0, 1},
+    {"+CHLD", 5, BTA_AG_AT_SET | BTA_AG_AT_TEST, BTA_AG_AT_STR, 0, 4},
+    {"+CHUP", 6, BTA_AG_AT_NONE, BTA_AG_AT_STR, 0, 0},
+    {"+CIND", 7, BTA_AG_AT_READ | BTA_AG_AT_TEST, BTA_AG_AT_STR, 0, 0},
+    {"+CLIP", 8, BTA_AG_AT_SET, BTA_AG_AT_INT, 0, 1},
+    {"+CMER", 9, BTA_AG_AT_SET, BTA_AG_AT_STR, 0, 0},
+    {"+VTS", 10, BTA_AG_AT_SET, BTA_AG_AT_STR, 0, 0},
+    {"+BINP", 11, BTA_AG_AT_SET, BTA_AG_AT_INT, 1, 1},
+    {"+BLDN", 12, BTA_AG_AT_NONE, BTA_AG_AT_STR, 0, 0},
+    {"+BVRA", 13, BTA_AG_AT_SET, BTA_AG_AT_INT, 0, 1},
+    {"+BRSF", 14, BTA_AG_AT_SET, BTA_AG_AT_INT, 0, 0x7fff},
+    {"+NREC", 15, BTA_AG_AT_SET, BTA_AG_AT_INT, 0, 0},
+    {"+CNUM", 16, BTA_AG_AT_NONE, BTA_AG_AT_STR, 0, 0},
+    {"+BTRH", 17, BTA_AG_AT_READ | BTA_AG_AT_SET, BTA_AG_AT_INT, 0, 2},
+    {"+CLCC", 18, BTA_AG_AT_NONE, BTA_AG_AT_STR, 0, 0},
+    {"+COPS", 19, BTA_AG_AT_READ | BTA_AG_AT_SET, BTA_AG_AT_STR, 0, 0},
+    {"+CMEE", 20, BTA_AG_AT_SET, BTA_AG_AT_INT, 0, 1},
+    {"+BIA", 21, BTA_AG_AT_SET, BTA_AG_AT_STR, 0, 20},
+    {"+CBC", 22, BTA_AG_AT_SET, BTA_AG_AT_INT, 0, 100},
+    {"+BCC", 23, BTA_AG_AT_NONE, BTA_AG_AT_STR, 0, 0},
+    {"+BCS", 24, BTA_AG_AT_SET, BTA_AG_AT_INT, 0, 0x7fff},
+    {"+BIND", 25, BTA_AG_AT_SET | BTA_AG_AT_READ | BTA_AG_AT_TEST,
+     BTA_AG_AT_STR, 0, 0},
+    {"+BIEV", 26, BTA_AG_AT_SET, BTA_AG_AT_STR, 0, 0},
+    {"+BAC", 27, BTA_AG_AT_SET, BTA_AG_AT_STR, 0, 0},
+    {"", 0, 0, 0, 0, 0}};
+
+/* What a car kit sends from the service level connection to an answered
+ * call, in the fragments RFCOMM hands them over in */
+const char* const kSlcAndCallSetup[] = {
+    "AT+BRSF=959\r",
+    "AT+BAC=1,2\r",
+    "AT+CIND=?\r",
+    "AT+CIND?\r",
+    "AT+CMER=3,0,0,1\r",
+    "AT+CHLD=?\r",
+    "AT+BIND=1,2\r",
+    "AT+BIND=?\r",
+    "AT+BIND?\r",
+    "AT+CMEE=1\r",
+    "AT+CCWA=1\r",
+    "AT+CLIP=1\r",
+    "AT+NREC=0\r",
+    "AT+VGS=9\rAT+VGM=9\r",
+    "AT+BIA=0,0,0,1,1,1,0\r",
+    "AT+COPS=3,0\rAT+CO",
+    "PS?\r",
+    "AT+CLCC\r",
+    "AT+BCS=2\r",
+    "ATA\r",
+};
+
+void CmdCback(tBTA_AG_SCB* p_user, uint16_t command_id, uint8_t arg_type,
+              char* p_arg, char* p_end, int16_t int_arg) {
+  benchmark::DoNotOptimize(command_id);
+}
+
+void ErrCback(tBTA_AG_SCB* p_user, bool unknown, const char* p_arg) {}
+
+void BM_ParseSlcAndCallSetup(State& state) {
+  tBTA_AG_AT_CB at_cb;
+  memset(&at_cb, 0, sizeof(at_cb));
+  at_cb.p_at_tbl = bench_at_tbl;
+  at_cb.p_cmd_cback = CmdCback;
+  at_cb.p_err_cback = ErrCback;
+  at_cb.cmd_max_len = 512;
+  bta_ag_at_init(&at_cb);
+
+  std::vector<std::string> fragments(std::begin(kSlcAndCallSetup),
+                                     std::end(kSlcAndCallSetup));
+  std::vector<char> buf;
+  for (auto _ : state) {
+    for (const std::string& fragment : fragments) {
+      /* the parser terminates the commands in the buffer it is given */
+      buf.assign(fragment.begin(), fragment.end());
+      bta_ag_at_parse(&at_cb, buf.data(), buf.size());
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * fragments.size());
+  bta_ag_at_reinit(&at_cb);
+}
+BENCHMARK(BM_ParseSlcAndCallSetup);
+
+/* The command lookup of the parser, against the table scan it replaces */
+const char* const kCommands[] = {"+BRSF=959", "+BAC=1,2", "+CIND=?",
+                                 "+CMER=3,0,0,1", "+BIND=?", "+BCS=2", "A"};
+
+void BM_LookupTrie(State& state) {
+  AtNameTrie trie(true);
+  for (int idx = 0; bench_at_tbl[idx].p_cmd[0] != 0; idx++) {
+    trie.Add(bench_at_tbl[idx].p_cmd, idx);
+  }
+  for (auto _ : state) {
+    for (const char* p_cmd : kCommands) {
+      size_t name_len;
+      benchmark::DoNotOptimize(trie.Match(p_cmd, strlen(p_cmd), &name_len));
+    }
+  }
+}
+BENCHMARK(BM_LookupTrie);
+
+void BM_LookupScan(State& state) {
+  for (auto _ : state) {
+    for (const char* p_cmd : kCommands) {
+      int idx;
+      for (idx = 0; bench_at_tbl[idx].p_cmd[0] != 0; idx++) {
+        if (!utl_strucmp(bench_at_tbl[idx].p_cmd, p_cmd)) break;
+      }
+      benchmark::DoNotOptimize(idx);
+    }
+  }
+}
+BENCHMARK(BM_LookupScan);
+
+}  // namespace
+
+BENCHMARK_MAIN();
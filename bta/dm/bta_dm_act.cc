@@ -28,6 +28,7 @@
 #include <base/bind.h>
 #include <base/callback.h>
 #include <base/logging.h>
+#include <inttypes.h>
 #include <string.h>
 
 #include "bt_common.h"
@@ -42,6 +43,7 @@
 #include "btm_api.h"
 #include "btm_int.h"
 #include "btu.h"
+#include "common/time_util.h"
 #include "device/include/interop.h"
 #include "gap_api.h" /* For GAP_BleReadPeerPrefConnParams */
 #include "l2c_api.h"
@@ -49,6 +51,7 @@
 #include "osi/include/osi.h"
 #include "sdp_api.h"
 #include "stack/gatt/connection_manager.h"
+#include "stack_config.h"
 #include "stack/include/gatt_api.h"
 #include "utl.h"
 
@@ -107,6 +110,7 @@ static void bta_dm_bond_cancel_complete_cback(tBTM_STATUS result);
 static bool bta_dm_read_remote_device_name(const RawAddress& bd_addr,
                                            tBT_TRANSPORT transport);
 static void bta_dm_discover_device(const RawAddress& remote_bd_addr);
+static void bta_dm_log_disc_timings(void);
 
 static void bta_dm_sys_hw_cback(tBTA_SYS_HW_EVT status);
 static void bta_dm_disable_search_and_disc(void);
@@ -117,6 +121,7 @@ static void bta_dm_ble_id_key_cback(uint8_t key_type,
                                     tBTM_BLE_LOCAL_KEYS* p_key);
 static void bta_dm_gattc_register(void);
 static void btm_dm_start_gatt_discovery(const RawAddress& bd_addr);
+static bool bta_dm_parallel_gatt_discovery(const RawAddress& bd_addr);
 static void bta_dm_cancel_gatt_discovery(const RawAddress& bd_addr);
 static void bta_dm_gattc_callback(tBTA_GATTC_EVT event, tBTA_GATTC* p_data);
 extern tBTA_DM_CONTRL_STATE bta_dm_pm_obtain_controller_state(void);
@@ -1092,6 +1097,14 @@ void bta_dm_discover(tBTA_DM_MSG* p_data) {
 
   bta_dm_search_cb.name_discover_done = false;
   bta_dm_search_cb.uuid = p_data->discover.uuid;
+
+  bta_dm_search_cb.gatt_disc_parallel = false;
+  osi_free_and_reset((void**)&bta_dm_search_cb.p_pending_disc_result);
+  bta_dm_search_cb.disc_start_ms = bluetooth::common::time_get_os_boottime_ms();
+  bta_dm_search_cb.sdp_start_ms = 0;
+  bta_dm_search_cb.sdp_done_ms = 0;
+  bta_dm_search_cb.gatt_start_ms = 0;
+  bta_dm_search_cb.gatt_done_ms = 0;
   bta_dm_discover_device(p_data->discover.bd_addr);
 }
 
@@ -1220,8 +1233,10 @@ static bool bta_dm_read_remote_device_name(const RawAddress& bd_addr,
   bta_dm_search_cb.peer_bdaddr = bd_addr;
   bta_dm_search_cb.peer_name[0] = 0;
 
-  btm_status = BTM_ReadRemoteDeviceName(bta_dm_search_cb.peer_bdaddr,
-                                        bta_dm_remname_cback, transport);
+  /* the names of the devices found are not waited for by the user */
+  btm_status = BTM_ReadRemoteDeviceNameWithPriority(
+      bta_dm_search_cb.peer_bdaddr, bta_dm_remname_cback, transport,
+      BTM_RMT_NAME_PRIORITY_BACKGROUND);
 
   if (btm_status == BTM_CMD_STARTED) {
     APPL_TRACE_DEBUG("%s: BTM_ReadRemoteDeviceName is started", __func__);
@@ -1562,6 +1577,7 @@ void bta_dm_search_cmpl(tBTA_DM_MSG* p_data) {
   APPL_TRACE_EVENT("%s", __func__);
 
   osi_free_and_reset((void**)&bta_dm_search_cb.p_srvc_uuid);
+  osi_free_and_reset((void**)&bta_dm_search_cb.p_pending_disc_result);
 
   if (p_data->hdr.layer_specific == BTA_DM_API_DI_DISCOVER_EVT)
     bta_dm_di_disc_cmpl(p_data);
@@ -1569,6 +1585,35 @@ void bta_dm_search_cmpl(tBTA_DM_MSG* p_data) {
     bta_dm_search_cb.p_search_cback(BTA_DM_DISC_CMPL_EVT, NULL);
 }
 
+/*******************************************************************************
+ *
+ * Function         bta_dm_log_disc_timings
+ *
+ * Description      Logs how long each phase of the device discovery took
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void bta_dm_log_disc_timings(void) {
+  uint64_t now = bluetooth::common::time_get_os_boottime_ms();
+  uint64_t services_start_ms = bta_dm_search_cb.sdp_start_ms;
+  if (services_start_ms == 0 ||
+      (bta_dm_search_cb.gatt_start_ms != 0 &&
+       bta_dm_search_cb.gatt_start_ms < services_start_ms))
+    services_start_ms = bta_dm_search_cb.gatt_start_ms;
+  if (services_start_ms == 0) services_start_ms = now;
+
+  LOG_INFO(LOG_TAG,
+           "%s: %s total %" PRIu64 " ms, name %" PRIu64 " ms, SDP %" PRIu64
+           " ms, GATT %" PRIu64 " ms%s",
+           __func__, bta_dm_search_cb.peer_bdaddr.ToString().c_str(),
+           now - bta_dm_search_cb.disc_start_ms,
+           services_start_ms - bta_dm_search_cb.disc_start_ms,
+           bta_dm_search_cb.sdp_done_ms - bta_dm_search_cb.sdp_start_ms,
+           bta_dm_search_cb.gatt_done_ms - bta_dm_search_cb.gatt_start_ms,
+           bta_dm_search_cb.gatt_disc_parallel ? " (parallel)" : "");
+}
+
 /*******************************************************************************
  *
  * Function         bta_dm_disc_result
@@ -1582,6 +1627,30 @@ void bta_dm_search_cmpl(tBTA_DM_MSG* p_data) {
 void bta_dm_disc_result(tBTA_DM_MSG* p_data) {
   APPL_TRACE_EVENT("%s", __func__);
 
+  if (bta_dm_search_cb.sdp_start_ms != 0 && bta_dm_search_cb.sdp_done_ms == 0)
+    bta_dm_search_cb.sdp_done_ms = bluetooth::common::time_get_os_boottime_ms();
+
+  /* don't hold the SDP result for an LE connection that may never come */
+  if (bta_dm_search_cb.gatt_disc_parallel &&
+      bta_dm_search_cb.gatt_disc_active &&
+      !BTM_IsAclConnectionUp(bta_dm_search_cb.peer_bdaddr, BT_TRANSPORT_LE)) {
+    bta_dm_cancel_gatt_discovery(bta_dm_search_cb.peer_bdaddr);
+  }
+
+  /* the SDP result of a dual-mode device is reported once its GATT discovery
+   * is done too */
+  if (bta_dm_search_cb.gatt_disc_parallel &&
+      bta_dm_search_cb.gatt_disc_active) {
+    osi_free(bta_dm_search_cb.p_pending_disc_result);
+    bta_dm_search_cb.p_pending_disc_result =
+        (tBTA_DM_MSG*)osi_malloc(sizeof(tBTA_DM_MSG));
+    memcpy(bta_dm_search_cb.p_pending_disc_result, p_data,
+           sizeof(tBTA_DM_MSG));
+    return;
+  }
+
+  bta_dm_log_disc_timings();
+
   /* if any BR/EDR service discovery has been done, report the event */
   if ((bta_dm_search_cb.services &
        ((BTA_ALL_SERVICE_MASK | BTA_USER_SERVICE_MASK) &
@@ -1786,7 +1855,9 @@ static void bta_dm_find_services(const RawAddress& bd_addr) {
       if (bta_dm_search_cb.services == BTA_ALL_SERVICE_MASK) {
         LOG_INFO(LOG_TAG, "%s services_to_search=%08x", __func__,
                  bta_dm_search_cb.services_to_search);
-        if (bta_dm_search_cb.services_to_search & BTA_RES_SERVICE_MASK) {
+        /* in parallel mode, the L2CAP search covers the PnP record too */
+        if ((bta_dm_search_cb.services_to_search & BTA_RES_SERVICE_MASK) &&
+            !stack_config_get_interface()->get_parallel_service_discovery()) {
           uuid = Uuid::From16Bit(bta_service_id_to_uuid_lkup_tbl[0]);
           bta_dm_search_cb.services_to_search &= ~BTA_RES_SERVICE_MASK;
         } else {
@@ -1838,6 +1909,9 @@ static void bta_dm_find_services(const RawAddress& bd_addr) {
 
       bta_dm_search_cb.p_sdp_db->raw_size = MAX_DISC_RAW_DATA_BUF;
 
+      /* Service discovery is how the services of a peer get refreshed */
+      bta_dm_search_cb.p_sdp_db->skip_cache = true;
+
       if (!SDP_ServiceSearchAttributeRequest(bd_addr, bta_dm_search_cb.p_sdp_db,
                                              &bta_dm_sdp_callback)) {
         /*
@@ -2020,6 +2094,17 @@ static void bta_dm_discover_device(const RawAddress& remote_bd_addr) {
         }
       } else {
         bta_dm_search_cb.sdp_results = false;
+        bta_dm_search_cb.sdp_start_ms =
+            bluetooth::common::time_get_os_boottime_ms();
+        if (bta_dm_parallel_gatt_discovery(remote_bd_addr)) {
+          /* the raw data buffer is the SDP search's */
+          bta_dm_search_cb.p_ble_rawdata = NULL;
+          bta_dm_search_cb.ble_raw_size = 0;
+          bta_dm_search_cb.ble_raw_used = 0;
+          bta_dm_search_cb.gatt_disc_parallel = true;
+          bta_dm_search_cb.gatt_start_ms = bta_dm_search_cb.sdp_start_ms;
+          btm_dm_start_gatt_discovery(bta_dm_search_cb.peer_bdaddr);
+        }
         bta_dm_find_services(bta_dm_search_cb.peer_bdaddr);
         return;
       }
@@ -2089,6 +2174,8 @@ static void bta_dm_inq_results_cb(tBTM_INQ_RESULTS* p_inq, uint8_t* p_eir,
   /* application will parse EIR to find out remote device name */
   result.inq_res.p_eir = p_eir;
   result.inq_res.eir_len = eir_len;
+  result.inq_res.eir_info = p_inq->eir_info;
+  result.inq_res.changed = p_inq->changed;
 
   p_inq_info = BTM_InqDbRead(p_inq->remote_bd_addr);
   if (p_inq_info != NULL) {
@@ -2165,9 +2252,9 @@ static void bta_dm_service_search_remname_cback(const RawAddress& bd_addr,
     bta_dm_remname_cback(&rem_name);
   } else {
     /* get name of device */
-    btm_status =
-        BTM_ReadRemoteDeviceName(bta_dm_search_cb.peer_bdaddr,
-                                 bta_dm_remname_cback, BT_TRANSPORT_BR_EDR);
+    btm_status = BTM_ReadRemoteDeviceNameWithPriority(
+        bta_dm_search_cb.peer_bdaddr, bta_dm_remname_cback,
+        BT_TRANSPORT_BR_EDR, BTM_RMT_NAME_PRIORITY_BACKGROUND);
     if (btm_status == BTM_BUSY) {
       /* wait for next chance(notification of remote name discovery done) */
       APPL_TRACE_DEBUG("%s: BTM_ReadRemoteDeviceName is busy", __func__);
@@ -3734,6 +3821,8 @@ static void bta_dm_observe_results_cb(tBTM_INQ_RESULTS* p_inq, uint8_t* p_eir,
   /* application will parse EIR to find out remote device name */
   result.inq_res.p_eir = p_eir;
   result.inq_res.eir_len = eir_len;
+  result.inq_res.eir_info = p_inq->eir_info;
+  result.inq_res.changed = p_inq->changed;
 
   p_inq_info = BTM_InqDbRead(p_inq->remote_bd_addr);
   if (p_inq_info != NULL) {
@@ -4173,8 +4262,10 @@ static void bta_dm_gatt_disc_result(tBTA_GATT_ID service_id) {
    * just copy the GATTID in raw data field and send it across.
    */
 
-  if (bta_dm_search_cb.ble_raw_used + sizeof(tBTA_GATT_ID) <
-      bta_dm_search_cb.ble_raw_size) {
+  if (bta_dm_search_cb.gatt_disc_parallel) {
+    /* no raw data, the buffer is used by the SDP search */
+  } else if (bta_dm_search_cb.ble_raw_used + sizeof(tBTA_GATT_ID) <
+             bta_dm_search_cb.ble_raw_size) {
     APPL_TRACE_DEBUG(
         "ADDING BLE SERVICE uuid=%s, ble_ptr = 0x%x, ble_raw_used = 0x%x",
         service_id.uuid.ToString().c_str(), bta_dm_search_cb.p_ble_rawdata,
@@ -4228,10 +4319,31 @@ static void bta_dm_gatt_disc_complete(uint16_t conn_id, tGATT_STATUS status) {
 
   if (status == GATT_SUCCESS && bta_dm_search_cb.uuid_to_search > 0) {
     btm_dm_start_disc_gatt_services(conn_id);
+  } else if (bta_dm_search_cb.gatt_disc_parallel) {
+    /* the services were reported one by one, the SDP search reports the
+     * discovery result */
+    bta_dm_search_cb.uuid_to_search = 0;
+    bta_dm_search_cb.gatt_done_ms =
+        bluetooth::common::time_get_os_boottime_ms();
+    bta_dm_search_cb.gatt_disc_active = false;
+
+    if (conn_id != GATT_INVALID_CONN_ID) {
+      bta_sys_start_timer(bta_dm_search_cb.gatt_close_timer,
+                          BTA_DM_GATT_CLOSE_DELAY_TOUT,
+                          BTA_DM_DISC_CLOSE_TOUT_EVT, 0);
+      bta_dm_search_cb.pending_close_bda = bta_dm_search_cb.peer_bdaddr;
+    }
+
+    if (bta_dm_search_cb.p_pending_disc_result) {
+      bta_sys_sendmsg(bta_dm_search_cb.p_pending_disc_result);
+      bta_dm_search_cb.p_pending_disc_result = NULL;
+    }
   } else {
     tBTA_DM_MSG* p_msg = (tBTA_DM_MSG*)osi_malloc(sizeof(tBTA_DM_MSG));
 
     bta_dm_search_cb.uuid_to_search = 0;
+    bta_dm_search_cb.gatt_done_ms =
+        bluetooth::common::time_get_os_boottime_ms();
 
     /* no more services to be discovered */
     p_msg->hdr.event = BTA_DM_DISCOVERY_RESULT_EVT;
@@ -4322,6 +4434,34 @@ void btm_dm_start_gatt_discovery(const RawAddress& bd_addr) {
   }
 }
 
+/*******************************************************************************
+ *
+ * Function         bta_dm_parallel_gatt_discovery
+ *
+ * Description      Tells if the GATT services of |bd_addr| are to be discovered
+ *                  over LE while its SDP search runs. That is the case for a
+ *                  dual-mode device whose services are all searched, when
+ *                  ParallelServiceDiscovery is set.
+ *
+ * Returns          true to start the GATT discovery alongside SDP
+ *
+ ******************************************************************************/
+static bool bta_dm_parallel_gatt_discovery(const RawAddress& bd_addr) {
+  if (!stack_config_get_interface()->get_parallel_service_discovery())
+    return false;
+
+  if (bta_dm_search_cb.state != BTA_DM_DISCOVER_ACTIVE ||
+      bta_dm_search_cb.services != BTA_ALL_SERVICE_MASK ||
+      bta_dm_search_cb.num_uuid != 0 || bta_dm_search_cb.gatt_disc_active ||
+      bta_dm_search_cb.client_if == BTA_GATTS_INVALID_IF)
+    return false;
+
+  tBT_DEVICE_TYPE dev_type;
+  tBLE_ADDR_TYPE addr_type;
+  BTM_ReadDevInfo(bd_addr, &dev_type, &addr_type);
+  return dev_type == BT_DEVICE_TYPE_DUMO;
+}
+
 /*******************************************************************************
  *
  * Function         bta_dm_cancel_gatt_discovery
@@ -227,6 +227,7 @@ typedef struct {
 #endif
   tBTA_DM_PM_ACTION pm_mode_attempted;
   tBTA_DM_PM_ACTION pm_mode_failed;
+  tBTA_DM_PM_REQ pm_pending_req; /* coalesced mode request, 0 if none */
   bool remove_dev_pending;
   uint16_t conn_handle;
   tBT_TRANSPORT transport;
@@ -371,6 +372,17 @@ typedef struct {
   alarm_t* gatt_close_timer; /* GATT channel close delay timer */
   RawAddress pending_close_bda; /* pending GATT channel remote device address */
 
+  /* GATT discovery of a dual-mode device running alongside its SDP search */
+  bool gatt_disc_parallel;
+  /* SDP result held until the parallel GATT discovery completes */
+  tBTA_DM_MSG* p_pending_disc_result;
+
+  /* discovery phase timestamps, in ms since boot, 0 if not reached */
+  uint64_t disc_start_ms;
+  uint64_t sdp_start_ms;
+  uint64_t sdp_done_ms;
+  uint64_t gatt_start_ms;
+  uint64_t gatt_done_ms;
 } tBTA_DM_SEARCH_CB;
 
 /* DI control block */
@@ -27,6 +27,7 @@
 #include <base/logging.h>
 #include <string.h>
 
+#include <algorithm>
 #include <mutex>
 
 #include "bt_common.h"
@@ -57,6 +58,8 @@ static void bta_dm_pm_set_sniff_policy(tBTA_DM_PEER_DEVICE* p_dev,
                                        bool bDisable);
 static void bta_dm_pm_stop_timer_by_index(tBTA_PM_TIMER* p_timer,
                                           uint8_t timer_idx);
+static void bta_dm_pm_queue_set_mode(tBTA_DM_PEER_DEVICE* p_dev,
+                                     tBTA_DM_PM_REQ pm_req);
 
 #if (BTM_SSR_INCLUDED == TRUE)
 #if (BTA_HH_INCLUDED == TRUE)
@@ -472,7 +475,7 @@ static void bta_dm_pm_cback(tBTA_SYS_CONN_STATUS status, uint8_t id,
   }
 #endif
 
-  bta_dm_pm_set_mode(peer_addr, BTA_DM_PM_NO_ACTION, pm_req);
+  if (p_dev) bta_dm_pm_queue_set_mode(p_dev, pm_req);
 
   /* perform the HID link workaround if needed
   ** 1. If SCO up/down event is received OR
@@ -493,6 +496,41 @@ static void bta_dm_pm_cback(tBTA_SYS_CONN_STATUS status, uint8_t id,
   }
 }
 
+/** Runs the mode request queued by bta_dm_pm_queue_set_mode() */
+static void bta_dm_pm_pending_set_mode(const RawAddress& peer_addr) {
+  tBTA_DM_PEER_DEVICE* p_dev = bta_dm_find_peer_device(peer_addr);
+  if (p_dev == NULL || p_dev->pm_pending_req == 0) return;
+
+  tBTA_DM_PM_REQ pm_req = p_dev->pm_pending_req;
+  p_dev->pm_pending_req = 0;
+  bta_dm_pm_set_mode(peer_addr, BTA_DM_PM_NO_ACTION, pm_req);
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_dm_pm_queue_set_mode
+ *
+ * Description      Queues a mode request for the device. The requests made
+ *                  by several profiles in a row, such as when they connect
+ *                  together, are coalesced into a single one.
+ *
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void bta_dm_pm_queue_set_mode(tBTA_DM_PEER_DEVICE* p_dev,
+                                     tBTA_DM_PM_REQ pm_req) {
+  if (p_dev->pm_pending_req != 0) {
+    /* a restart covers the new requests of all the services */
+    p_dev->pm_pending_req = std::min(p_dev->pm_pending_req, pm_req);
+    return;
+  }
+
+  p_dev->pm_pending_req = pm_req;
+  do_in_main_thread(FROM_HERE, base::Bind(bta_dm_pm_pending_set_mode,
+                                          p_dev->peer_bdaddr));
+}
+
 /*******************************************************************************
  *
  * Function         bta_dm_pm_set_mode
@@ -593,6 +631,10 @@ static void bta_dm_pm_set_mode(const RawAddress& peer_addr,
       }
     }
   }
+  /* wait for the end of the bursts of traffic of the link */
+  if ((pm_action & BTA_DM_PM_SNIFF) && (timeout_ms > 0))
+    timeout_ms = BTM_PmGetIdleTimeout(peer_addr, timeout_ms);
+
   /* if need to start a timer */
   if ((pm_req != BTA_DM_PM_EXECUTE) && (timeout_ms > 0)) {
     for (i = 0; i < BTA_DM_NUM_PM_TIMER; i++) {
@@ -725,6 +767,7 @@ static bool bta_dm_pm_sniff(tBTA_DM_PEER_DEVICE* p_peer_dev, uint8_t index) {
     /* if the current mode is not sniff, issue the sniff command.
      * If sniff, but SSR is not used in this link, still issue the command */
     memcpy(&pwr_md, &p_bta_dm_pm_md[index], sizeof(tBTM_PM_PWR_MD));
+    BTM_PmAdaptSniffMode(p_peer_dev->peer_bdaddr, &pwr_md);
     if (p_peer_dev->info & BTA_DM_DI_INT_SNIFF) {
       pwr_md.mode |= BTM_PM_MD_FORCE;
     }
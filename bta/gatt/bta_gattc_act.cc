@@ -213,7 +213,7 @@ void bta_gattc_deregister(tBTA_GATTC_RCB* p_clreg) {
   }
 
   /* remove bg connection associated with this rcb */
-  for (uint8_t i = 0; i < BTM_GetWhiteListSize(); i++) {
+  for (uint8_t i = 0; i < BTA_GATTC_KNOWN_SR_MAX; i++) {
     if (!bta_gattc_cb.bg_track[i].in_use) continue;
 
     if (bta_gattc_cb.bg_track[i].cif_mask & (1 << (p_clreg->client_if - 1))) {
@@ -403,7 +403,8 @@ void bta_gattc_init_bk_conn(tBTA_GATTC_API_OPEN* p_data,
   if (!p_clcb) return;
 
   tBTA_GATTC_DATA gattc_data;
-  gattc_data.hdr.layer_specific = p_clcb->bta_conn_id = conn_id;
+  bta_gattc_clcb_set_conn_id(p_clcb, conn_id);
+  gattc_data.hdr.layer_specific = conn_id;
 
   /* open connection */
   bta_gattc_sm_execute(p_clcb, BTA_GATTC_INT_CONN_EVT, &gattc_data);
@@ -463,7 +464,7 @@ void bta_gattc_conn(tBTA_GATTC_CLCB* p_clcb, tBTA_GATTC_DATA* p_data) {
 
   if (p_data != NULL) {
     VLOG(1) << __func__ << ": conn_id=" << loghex(p_data->hdr.layer_specific);
-    p_clcb->bta_conn_id = p_data->int_conn.hdr.layer_specific;
+    bta_gattc_clcb_set_conn_id(p_clcb, p_data->int_conn.hdr.layer_specific);
 
     GATT_GetConnectionInfor(p_data->hdr.layer_specific, &gatt_if, p_clcb->bda,
                             &p_clcb->transport);
@@ -490,6 +491,12 @@ void bta_gattc_conn(tBTA_GATTC_CLCB* p_clcb, tBTA_GATTC_DATA* p_data) {
       p_clcb->state = BTA_GATTC_DISCOVER_ST;
   }
 
+  else if (p_clcb->p_srcb->verify_db_hash) {
+    /* database kept from the previous connection, check its Database Hash */
+    p_clcb->p_srcb->state = BTA_GATTC_SERV_DISC;
+    bta_gattc_start_discover(p_clcb, NULL);
+  }
+
   else {
     /* a pending service handle change indication */
     if (p_clcb->p_srcb->srvc_hdl_chg) {
@@ -617,6 +624,16 @@ void bta_gattc_restart_discover(tBTA_GATTC_CLCB* p_clcb,
 void bta_gattc_cfg_mtu(tBTA_GATTC_CLCB* p_clcb, tBTA_GATTC_DATA* p_data) {
   if (!bta_gattc_enqueue(p_clcb, p_data)) return;
 
+  /* the MTU can only be exchanged once per connection, the discovery may
+   * have done it already */
+  if (p_clcb->p_srcb->mtu_exchanged) {
+    tGATT_CL_COMPLETE cmpl;
+    cmpl.mtu = p_clcb->p_srcb->mtu;
+    bta_gattc_cmpl_sendmsg(p_clcb->bta_conn_id, GATTC_OPTYPE_CONFIG,
+                           GATT_SUCCESS, &cmpl);
+    return;
+  }
+
   tGATT_STATUS status =
       GATTC_ConfigureMTU(p_clcb->bta_conn_id, p_data->api_mtu.mtu);
 
@@ -656,9 +673,7 @@ void bta_gattc_start_discover(tBTA_GATTC_CLCB* p_clcb,
       /* set all srcb related clcb into discovery ST */
       bta_gattc_set_discover_st(p_clcb->p_srcb);
 
-      bta_gattc_init_cache(p_clcb->p_srcb);
-      p_clcb->status = bta_gattc_discover_pri_service(
-          p_clcb->bta_conn_id, p_clcb->p_srcb, GATT_DISC_SRVC_ALL);
+      p_clcb->status = bta_gattc_start_disc_procedure(p_clcb);
       if (p_clcb->status != GATT_SUCCESS) {
         LOG(ERROR) << "discovery on server failed";
         bta_gattc_reset_discover_st(p_clcb->p_srcb, p_clcb->status);
@@ -687,12 +702,14 @@ void bta_gattc_disc_cmpl(tBTA_GATTC_CLCB* p_clcb,
   if (p_clcb->transport == BTA_TRANSPORT_LE)
     L2CA_EnableUpdateBleConnParams(p_clcb->p_srcb->server_bda, true);
   p_clcb->p_srcb->state = BTA_GATTC_SERV_IDLE;
+  p_clcb->p_srcb->disc_stage = BTA_GATTC_DISC_STAGE_NONE;
   p_clcb->disc_active = false;
 
   if (p_clcb->status != GATT_SUCCESS) {
     /* clean up cache */
     if (p_clcb->p_srcb) {
       p_clcb->p_srcb->gatt_database.Clear();
+      p_clcb->p_srcb->database_hash.clear();
     }
 
     /* used to reset cache in application */
@@ -900,8 +917,10 @@ void bta_gattc_cfg_mtu_cmpl(tBTA_GATTC_CLCB* p_clcb,
 
   osi_free_and_reset((void**)&p_clcb->p_q_cmd);
 
-  if (p_data->p_cmpl && p_data->status == GATT_SUCCESS)
+  if (p_data->p_cmpl && p_data->status == GATT_SUCCESS) {
     p_clcb->p_srcb->mtu = p_data->p_cmpl->mtu;
+    p_clcb->p_srcb->mtu_exchanged = true;
+  }
 
   /* configure MTU complete, callback */
   p_clcb->status = p_data->status;
@@ -974,8 +993,15 @@ void bta_gattc_op_cmpl(tBTA_GATTC_CLCB* p_clcb, tBTA_GATTC_DATA* p_data) {
 }
 
 /** operation completed */
-void bta_gattc_ignore_op_cmpl(UNUSED_ATTR tBTA_GATTC_CLCB* p_clcb,
+void bta_gattc_ignore_op_cmpl(tBTA_GATTC_CLCB* p_clcb,
                               tBTA_GATTC_DATA* p_data) {
+  /* MTU exchange or Database Hash read issued by the discovery itself */
+  if (p_clcb->disc_active &&
+      p_clcb->p_srcb->disc_stage != BTA_GATTC_DISC_STAGE_NONE) {
+    bta_gattc_disc_stage_cmpl(p_clcb, &p_data->op_cmpl);
+    return;
+  }
+
   /* receive op complete when discovery is started, ignore the response,
       and wait for discovery finish and resent */
   VLOG(1) << __func__ << ": op = " << +p_data->hdr.layer_specific;
@@ -1093,6 +1119,9 @@ static void bta_gattc_enc_cmpl_cback(tGATT_IF gattc_if, const RawAddress& bda) {
 void bta_gattc_process_api_refresh(const RawAddress& remote_bda) {
   tBTA_GATTC_SERV* p_srvc_cb = bta_gattc_find_srvr_cache(remote_bda);
   if (p_srvc_cb) {
+    /* an explicit refresh is a full discovery, whatever the Database Hash */
+    p_srvc_cb->database_hash.clear();
+
     /* try to find a CLCB */
     if (p_srvc_cb->connected && p_srvc_cb->num_clcb != 0) {
       bool found = false;
@@ -1263,7 +1292,7 @@ void bta_gattc_process_indicate(uint16_t conn_id, tGATTC_OPTYPE op,
         return;
       }
 
-      p_clcb->bta_conn_id = conn_id;
+      bta_gattc_clcb_set_conn_id(p_clcb, conn_id);
       p_clcb->transport = transport;
 
       bta_gattc_sm_execute(p_clcb, BTA_GATTC_INT_CONN_EVT, NULL);
@@ -45,6 +45,7 @@
 #include "osi/include/osi.h"
 #include "sdp_api.h"
 #include "sdpdefs.h"
+#include "stored_database.h"
 #include "utl.h"
 
 using base::StringPrintf;
@@ -56,6 +57,7 @@ using gatt::Descriptor;
 using gatt::IncludedService;
 using gatt::Service;
 using gatt::StoredAttribute;
+using gatt::StoredDatabase;
 
 static void bta_gattc_cache_write(const RawAddress& server_bda,
                                   const std::vector<StoredAttribute>& attr);
@@ -71,7 +73,6 @@ static void bta_gattc_explore_srvc_finished(uint16_t conn_id,
 #define BTA_GATT_SDP_DB_SIZE 4096
 
 #define GATT_CACHE_PREFIX "/data/misc/bluetooth/gatt_cache_"
-#define GATT_CACHE_VERSION 5
 
 static void bta_gattc_generate_cache_file_name(char* buffer, size_t buffer_len,
                                                const RawAddress& bda) {
@@ -119,16 +120,6 @@ void bta_gattc_init_cache(tBTA_GATTC_SERV* p_srvc_cb) {
   p_srvc_cb->pending_discovery.Clear();
 }
 
-const Service* bta_gattc_find_matching_service(
-    const std::list<Service>& services, uint16_t handle) {
-  for (const Service& service : services) {
-    if (handle >= service.handle && handle <= service.end_handle)
-      return &service;
-  }
-
-  return nullptr;
-}
-
 /** Start primary service discovery */
 tGATT_STATUS bta_gattc_discover_pri_service(uint16_t conn_id,
                                             tBTA_GATTC_SERV* p_server_cb,
@@ -144,6 +135,113 @@ tGATT_STATUS bta_gattc_discover_pri_service(uint16_t conn_id,
   return bta_gattc_sdp_service_disc(conn_id, p_server_cb);
 }
 
+/** Ask for the largest MTU before anything else, so that the discovery
+ * responses carry as many attributes as the server can fit in a PDU */
+static bool bta_gattc_disc_exchange_mtu(tBTA_GATTC_CLCB* p_clcb) {
+  tGATT_STATUS status =
+      GATTC_ConfigureMTU(p_clcb->bta_conn_id, GATT_MAX_MTU_SIZE);
+  if (status != GATT_SUCCESS && status != GATT_CMD_STARTED) {
+    LOG(WARNING) << __func__ << ": status=" << loghex(status);
+    return false;
+  }
+
+  p_clcb->p_srcb->disc_stage = BTA_GATTC_DISC_STAGE_MTU;
+  return true;
+}
+
+/** Read the Database Hash of the server, to find out if the database we hold
+ * is still the one of the server */
+static bool bta_gattc_disc_read_db_hash(tBTA_GATTC_CLCB* p_clcb) {
+  tGATT_READ_PARAM param;
+  memset(&param, 0, sizeof(tGATT_READ_PARAM));
+  param.char_type.s_handle = 0x0001;
+  param.char_type.e_handle = 0xFFFF;
+  param.char_type.auth_req = GATT_AUTH_REQ_NONE;
+  param.char_type.uuid = Uuid::From16Bit(GATT_UUID_DATABASE_HASH);
+
+  tGATT_STATUS status =
+      GATTC_Read(p_clcb->bta_conn_id, GATT_READ_BY_TYPE, &param);
+  if (status != GATT_SUCCESS && status != GATT_CMD_STARTED) {
+    LOG(WARNING) << __func__ << ": status=" << loghex(status);
+    return false;
+  }
+
+  p_clcb->p_srcb->disc_stage = BTA_GATTC_DISC_STAGE_HASH;
+  return true;
+}
+
+/** Start exploring the services from scratch */
+static tGATT_STATUS bta_gattc_disc_explore(tBTA_GATTC_CLCB* p_clcb) {
+  bta_gattc_init_cache(p_clcb->p_srcb);
+  return bta_gattc_discover_pri_service(p_clcb->bta_conn_id, p_clcb->p_srcb,
+                                        GATT_DISC_SRVC_ALL);
+}
+
+/** Start a discovery on the server of |p_clcb|. Over LE, the MTU is exchanged
+ * first if it wasn't yet on this connection, then the Database Hash is read,
+ * and the services are only explored if the hash doesn't match the one of the
+ * database we hold. */
+tGATT_STATUS bta_gattc_start_disc_procedure(tBTA_GATTC_CLCB* p_clcb) {
+  tBTA_GATTC_SERV* p_srcb = p_clcb->p_srcb;
+  p_srcb->disc_stage = BTA_GATTC_DISC_STAGE_NONE;
+  p_srcb->verify_db_hash = false;
+
+  if (p_clcb->transport == BTA_TRANSPORT_LE) {
+    if (!p_srcb->mtu_exchanged && bta_gattc_disc_exchange_mtu(p_clcb))
+      return GATT_SUCCESS;
+    if (bta_gattc_disc_read_db_hash(p_clcb)) return GATT_SUCCESS;
+  }
+
+  return bta_gattc_disc_explore(p_clcb);
+}
+
+/** The MTU exchange or the Database Hash read of a discovery completed */
+void bta_gattc_disc_stage_cmpl(tBTA_GATTC_CLCB* p_clcb,
+                               tBTA_GATTC_OP_CMPL* p_data) {
+  tBTA_GATTC_SERV* p_srcb = p_clcb->p_srcb;
+  uint8_t stage = p_srcb->disc_stage;
+  p_srcb->disc_stage = BTA_GATTC_DISC_STAGE_NONE;
+
+  /* discovery cancelled meanwhile */
+  if (p_clcb->status != GATT_SUCCESS) {
+    bta_gattc_sm_execute(p_clcb, BTA_GATTC_DISCOVER_CMPL_EVT, NULL);
+    return;
+  }
+
+  if (stage == BTA_GATTC_DISC_STAGE_MTU) {
+    /* a rejected exchange isn't attempted again either */
+    p_srcb->mtu_exchanged = true;
+    if (p_data->status == GATT_SUCCESS && p_data->p_cmpl)
+      p_srcb->mtu = p_data->p_cmpl->mtu;
+    VLOG(1) << __func__ << ": mtu=" << +p_srcb->mtu;
+
+    if (bta_gattc_disc_read_db_hash(p_clcb)) return;
+  } else if (stage == BTA_GATTC_DISC_STAGE_HASH) {
+    const tGATT_VALUE* p_value =
+        p_data->p_cmpl ? &p_data->p_cmpl->att_value : NULL;
+    if (p_data->status == GATT_SUCCESS && p_value &&
+        p_value->len == BTA_GATTC_DATABASE_HASH_LEN) {
+      std::vector<uint8_t> hash(p_value->value,
+                                p_value->value + BTA_GATTC_DATABASE_HASH_LEN);
+      if (hash == p_srcb->database_hash && !p_srcb->gatt_database.IsEmpty()) {
+        LOG(INFO) << __func__ << ": Database Hash unchanged, keeping database";
+        bta_gattc_reset_discover_st(p_srcb, GATT_SUCCESS);
+        return;
+      }
+      p_srcb->database_hash = std::move(hash);
+    } else {
+      /* no hash on the server */
+      p_srcb->database_hash.clear();
+    }
+  }
+
+  tGATT_STATUS status = bta_gattc_disc_explore(p_clcb);
+  if (status != GATT_SUCCESS) {
+    LOG(ERROR) << "discovery on server failed";
+    bta_gattc_reset_discover_st(p_srcb, status);
+  }
+}
+
 /** start exploring next service, or finish discovery if no more services left
  */
 static void bta_gattc_explore_next_service(uint16_t conn_id,
@@ -437,31 +535,23 @@ const std::list<Service>* bta_gattc_get_services(uint16_t conn_id) {
 
 const Service* bta_gattc_get_service_for_handle_srcb(tBTA_GATTC_SERV* p_srcb,
                                                      uint16_t handle) {
-  const std::list<Service>* services = bta_gattc_get_services_srcb(p_srcb);
-  if (services == NULL) return NULL;
-  return bta_gattc_find_matching_service(*services, handle);
+  if (!p_srcb) return NULL;
+  return p_srcb->gatt_database.FindServiceForHandle(handle);
 }
 
 const Service* bta_gattc_get_service_for_handle(uint16_t conn_id,
                                                 uint16_t handle) {
-  const std::list<Service>* services = bta_gattc_get_services(conn_id);
-  if (services == NULL) return NULL;
+  tBTA_GATTC_CLCB* p_clcb = bta_gattc_find_clcb_by_conn_id(conn_id);
 
-  return bta_gattc_find_matching_service(*services, handle);
+  if (p_clcb == NULL) return NULL;
+
+  return bta_gattc_get_service_for_handle_srcb(p_clcb->p_srcb, handle);
 }
 
 const Characteristic* bta_gattc_get_characteristic_srcb(tBTA_GATTC_SERV* p_srcb,
                                                         uint16_t handle) {
-  const Service* service =
-      bta_gattc_get_service_for_handle_srcb(p_srcb, handle);
-
-  if (!service) return NULL;
-
-  for (const Characteristic& charac : service->characteristics) {
-    if (handle == charac.value_handle) return &charac;
-  }
-
-  return NULL;
+  if (!p_srcb) return NULL;
+  return p_srcb->gatt_database.FindCharacteristic(handle);
 }
 
 const Characteristic* bta_gattc_get_characteristic(uint16_t conn_id,
@@ -476,20 +566,8 @@ const Characteristic* bta_gattc_get_characteristic(uint16_t conn_id,
 
 const Descriptor* bta_gattc_get_descriptor_srcb(tBTA_GATTC_SERV* p_srcb,
                                                 uint16_t handle) {
-  const Service* service =
-      bta_gattc_get_service_for_handle_srcb(p_srcb, handle);
-
-  if (!service) {
-    return NULL;
-  }
-
-  for (const Characteristic& charac : service->characteristics) {
-    for (const Descriptor& desc : charac.descriptors) {
-      if (handle == desc.handle) return &desc;
-    }
-  }
-
-  return NULL;
+  if (!p_srcb) return NULL;
+  return p_srcb->gatt_database.FindDescriptor(handle);
 }
 
 const Descriptor* bta_gattc_get_descriptor(uint16_t conn_id, uint16_t handle) {
@@ -503,18 +581,8 @@ const Descriptor* bta_gattc_get_descriptor(uint16_t conn_id, uint16_t handle) {
 
 const Characteristic* bta_gattc_get_owning_characteristic_srcb(
     tBTA_GATTC_SERV* p_srcb, uint16_t handle) {
-  const Service* service =
-      bta_gattc_get_service_for_handle_srcb(p_srcb, handle);
-
-  if (!service) return NULL;
-
-  for (const Characteristic& charac : service->characteristics) {
-    for (const Descriptor& desc : charac.descriptors) {
-      if (handle == desc.handle) return &charac;
-    }
-  }
-
-  return NULL;
+  if (!p_srcb) return NULL;
+  return p_srcb->gatt_database.FindOwningCharacteristic(handle);
 }
 
 const Characteristic* bta_gattc_get_owning_characteristic(uint16_t conn_id,
@@ -712,46 +780,12 @@ bool bta_gattc_cache_load(tBTA_GATTC_SERV* p_srcb) {
   char fname[255] = {0};
   bta_gattc_generate_cache_file_name(fname, sizeof(fname), p_srcb->server_bda);
 
-  FILE* fd = fopen(fname, "rb");
-  if (!fd) {
-    LOG(ERROR) << __func__ << ": can't open GATT cache file " << fname
-               << " for reading, error: " << strerror(errno);
-    return false;
-  }
+  // The attributes are read in place from the mapped file
+  std::unique_ptr<StoredDatabase> stored = StoredDatabase::Open(fname);
+  if (!stored) return false;
 
-  uint16_t cache_ver = 0;
   bool success = false;
-  uint16_t num_attr = 0;
-
-  if (fread(&cache_ver, sizeof(uint16_t), 1, fd) != 1) {
-    LOG(ERROR) << __func__ << ": can't read GATT cache version from: " << fname;
-    goto done;
-  }
-
-  if (cache_ver != GATT_CACHE_VERSION) {
-    LOG(ERROR) << __func__ << ": wrong GATT cache version: " << fname;
-    goto done;
-  }
-
-  if (fread(&num_attr, sizeof(uint16_t), 1, fd) != 1) {
-    LOG(ERROR) << __func__
-               << ": can't read number of GATT attributes: " << fname;
-    goto done;
-  }
-
-  {
-    std::vector<StoredAttribute> attr(num_attr);
-
-    if (fread(attr.data(), sizeof(StoredAttribute), num_attr, fd) != num_attr) {
-      LOG(ERROR) << __func__ << "s: can't read GATT attributes: " << fname;
-      goto done;
-    }
-
-    p_srcb->gatt_database = gatt::Database::Deserialize(attr, &success);
-  }
-
-done:
-  fclose(fd);
+  p_srcb->gatt_database = stored->ToDatabase(&success);
   return success;
 }
 
@@ -772,35 +806,7 @@ static void bta_gattc_cache_write(const RawAddress& server_bda,
   char fname[255] = {0};
   bta_gattc_generate_cache_file_name(fname, sizeof(fname), server_bda);
 
-  FILE* fd = fopen(fname, "wb");
-  if (!fd) {
-    LOG(ERROR) << __func__
-               << ": can't open GATT cache file for writing: " << fname;
-    return;
-  }
-
-  uint16_t cache_ver = GATT_CACHE_VERSION;
-  if (fwrite(&cache_ver, sizeof(uint16_t), 1, fd) != 1) {
-    LOG(ERROR) << __func__ << ": can't write GATT cache version: " << fname;
-    fclose(fd);
-    return;
-  }
-
-  uint16_t num_attr = attr.size();
-  if (fwrite(&num_attr, sizeof(uint16_t), 1, fd) != 1) {
-    LOG(ERROR) << __func__
-               << ": can't write GATT cache attribute count: " << fname;
-    fclose(fd);
-    return;
-  }
-
-  if (fwrite(attr.data(), sizeof(StoredAttribute), num_attr, fd) != num_attr) {
-    LOG(ERROR) << __func__ << ": can't write GATT cache attributes: " << fname;
-    fclose(fd);
-    return;
-  }
-
-  fclose(fd);
+  StoredDatabase::Write(fname, attr);
 }
 
 /*******************************************************************************
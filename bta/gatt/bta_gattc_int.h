@@ -31,6 +31,9 @@
 #include "database_builder.h"
 #include "osi/include/fixed_queue.h"
 
+#include <deque>
+#include <unordered_map>
+
 #include "bt_common.h"
 
 #include <base/logging.h>
@@ -65,6 +68,7 @@ enum {
 typedef uint16_t tBTA_GATTC_INT_EVT;
 
 #define BTA_GATTC_SERVICE_CHANGED_LEN 4
+#define BTA_GATTC_DATABASE_HASH_LEN 16
 
 /* max client application GATTC can support */
 #ifndef BTA_GATTC_CL_MAX
@@ -217,6 +221,20 @@ typedef struct {
   uint16_t attr_index;  /* cahce NV saving/loading attribute index */
 
   uint16_t mtu;
+  bool mtu_exchanged; /* MTU exchange done on this connection */
+
+/* steps of a discovery before the services are explored */
+#define BTA_GATTC_DISC_STAGE_NONE 0
+#define BTA_GATTC_DISC_STAGE_MTU 1
+#define BTA_GATTC_DISC_STAGE_HASH 2
+
+  uint8_t disc_stage;
+
+  /* Database Hash of the server when |gatt_database| was discovered, empty if
+   * the server has none. A database with a hash is kept after the
+   * disconnection, and only checked against the hash on the next one. */
+  std::vector<uint8_t> database_hash;
+  bool verify_db_hash; /* kept database not checked against the hash yet */
 } tBTA_GATTC_SERV;
 
 #ifndef BTA_GATTC_NOTIF_REG_MAX
@@ -297,7 +315,15 @@ typedef struct {
   tBTA_GATTC_RCB cl_rcb[BTA_GATTC_CL_MAX];
 
   tBTA_GATTC_CLCB clcb[BTA_GATTC_CLCB_MAX];
-  tBTA_GATTC_SERV known_server[BTA_GATTC_KNOWN_SR_MAX];
+  /* known servers, added as devices are met up to the white list size. A
+   * deque never moves its entries, which the CLCBs point to */
+  std::deque<tBTA_GATTC_SERV> known_server;
+
+  /* index of the clcb entries in use by connection ID, and of the
+   * known_server entries in use by address, for the per operation and per
+   * notification lookups */
+  std::unordered_map<uint16_t, uint8_t> clcb_by_conn_id;
+  std::unordered_map<RawAddress, uint8_t> srcb_by_bda;
 } tBTA_GATTC_CB;
 
 /*****************************************************************************
@@ -384,6 +410,8 @@ extern tBTA_GATTC_CLCB* bta_gattc_find_clcb_by_cif(uint8_t client_if,
                                                    const RawAddress& remote_bda,
                                                    tBTA_TRANSPORT transport);
 extern tBTA_GATTC_CLCB* bta_gattc_find_clcb_by_conn_id(uint16_t conn_id);
+extern void bta_gattc_clcb_set_conn_id(tBTA_GATTC_CLCB* p_clcb,
+                                       uint16_t conn_id);
 extern tBTA_GATTC_CLCB* bta_gattc_clcb_alloc(tGATT_IF client_if,
                                              const RawAddress& remote_bda,
                                              tBTA_TRANSPORT transport);
@@ -424,6 +452,9 @@ extern void bta_gattc_disc_cmpl_cback(uint16_t conn_id,
 extern tGATT_STATUS bta_gattc_discover_pri_service(uint16_t conn_id,
                                                    tBTA_GATTC_SERV* p_server_cb,
                                                    uint8_t disc_type);
+extern tGATT_STATUS bta_gattc_start_disc_procedure(tBTA_GATTC_CLCB* p_clcb);
+extern void bta_gattc_disc_stage_cmpl(tBTA_GATTC_CLCB* p_clcb,
+                                      tBTA_GATTC_OP_CMPL* p_data);
 extern void bta_gattc_search_service(tBTA_GATTC_CLCB* p_clcb,
                                      bluetooth::Uuid* p_uuid);
 extern const std::list<gatt::Service>* bta_gattc_get_services(uint16_t conn_id);
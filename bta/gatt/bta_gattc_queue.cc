@@ -16,11 +16,12 @@
 
 #include "bta_gatt_queue.h"
 
-#include <list>
+#include <deque>
 #include <unordered_map>
-#include <unordered_set>
+#include <utility>
 
 using gatt_operation = BtaGattQueue::gatt_operation;
+using gatt_conn_queue = BtaGattQueue::gatt_conn_queue;
 
 constexpr uint8_t GATT_READ_CHAR = 1;
 constexpr uint8_t GATT_READ_DESC = 2;
@@ -28,33 +29,30 @@ constexpr uint8_t GATT_WRITE_CHAR = 3;
 constexpr uint8_t GATT_WRITE_DESC = 4;
 
 struct gatt_read_op_data {
-  GATT_READ_OP_CB cb;
-  void* cb_data;
+  /* callbacks of the queued reads served by one ATT read, in queue order */
+  std::vector<std::pair<GATT_READ_OP_CB, void*>> cbs;
 };
 
-std::unordered_map<uint16_t, std::list<gatt_operation>>
-    BtaGattQueue::gatt_op_queue;
-std::unordered_set<uint16_t> BtaGattQueue::gatt_op_queue_executing;
+std::unordered_map<uint16_t, gatt_conn_queue> BtaGattQueue::gatt_op_queue;
 
 void BtaGattQueue::mark_as_not_executing(uint16_t conn_id) {
-  gatt_op_queue_executing.erase(conn_id);
+  auto map_ptr = gatt_op_queue.find(conn_id);
+  if (map_ptr != gatt_op_queue.end()) map_ptr->second.executing = false;
 }
 
 void BtaGattQueue::gatt_read_op_finished(uint16_t conn_id, tGATT_STATUS status,
                                          uint16_t handle, uint16_t len,
                                          uint8_t* value, void* data) {
   gatt_read_op_data* tmp = (gatt_read_op_data*)data;
-  GATT_READ_OP_CB tmp_cb = tmp->cb;
-  void* tmp_cb_data = tmp->cb_data;
+  std::vector<std::pair<GATT_READ_OP_CB, void*>> cbs = std::move(tmp->cbs);
 
-  osi_free(data);
+  delete tmp;
 
   mark_as_not_executing(conn_id);
   gatt_execute_next_op(conn_id);
 
-  if (tmp_cb) {
-    tmp_cb(conn_id, status, handle, len, value, tmp_cb_data);
-    return;
+  for (const auto& cb : cbs) {
+    if (cb.first) cb.first(conn_id, status, handle, len, value, cb.second);
   }
 }
 
@@ -88,40 +86,54 @@ void BtaGattQueue::gatt_execute_next_op(uint16_t conn_id) {
   }
 
   auto map_ptr = gatt_op_queue.find(conn_id);
-  if (map_ptr == gatt_op_queue.end() || map_ptr->second.empty()) {
+  if (map_ptr == gatt_op_queue.end() || map_ptr->second.ops.empty()) {
     APPL_TRACE_DEBUG("%s: no more operations queued for conn_id %d", __func__,
                      conn_id);
     return;
   }
 
-  if (gatt_op_queue_executing.count(conn_id)) {
+  gatt_conn_queue& queue = map_ptr->second;
+  if (queue.executing) {
     APPL_TRACE_DEBUG("%s: can't enqueue next op, already executing", __func__);
     return;
   }
 
-  gatt_op_queue_executing.insert(conn_id);
+  queue.executing = true;
 
-  std::list<gatt_operation>& gatt_ops = map_ptr->second;
+  std::deque<gatt_operation>& gatt_ops = queue.ops;
 
   gatt_operation& op = gatt_ops.front();
 
-  if (op.type == GATT_READ_CHAR) {
-    gatt_read_op_data* data =
-        (gatt_read_op_data*)osi_malloc(sizeof(gatt_read_op_data));
-    data->cb = op.read_cb;
-    data->cb_data = op.read_cb_data;
-    BTA_GATTC_ReadCharacteristic(conn_id, op.handle, GATT_AUTH_REQ_NONE,
-                                 gatt_read_op_finished, data);
-
-  } else if (op.type == GATT_READ_DESC) {
-    gatt_read_op_data* data =
-        (gatt_read_op_data*)osi_malloc(sizeof(gatt_read_op_data));
-    data->cb = op.read_cb;
-    data->cb_data = op.read_cb_data;
-    BTA_GATTC_ReadCharDescr(conn_id, op.handle, GATT_AUTH_REQ_NONE,
-                            gatt_read_op_finished, data);
-
-  } else if (op.type == GATT_WRITE_CHAR) {
+  if (op.type == GATT_READ_CHAR || op.type == GATT_READ_DESC) {
+    uint8_t type = op.type;
+    uint16_t handle = op.handle;
+
+    /* The reads of the same attribute queued right behind this one were all
+     * requested before the ATT read is sent, so they take its value too. */
+    gatt_read_op_data* data = new gatt_read_op_data;
+    while (!gatt_ops.empty() && gatt_ops.front().type == type &&
+           gatt_ops.front().handle == handle) {
+      data->cbs.emplace_back(gatt_ops.front().read_cb,
+                             gatt_ops.front().read_cb_data);
+      gatt_ops.pop_front();
+    }
+
+    if (data->cbs.size() > 1) {
+      APPL_TRACE_DEBUG("%s: %zu reads of handle 0x%04x in one", __func__,
+                       data->cbs.size(), handle);
+    }
+
+    if (type == GATT_READ_CHAR) {
+      BTA_GATTC_ReadCharacteristic(conn_id, handle, GATT_AUTH_REQ_NONE,
+                                   gatt_read_op_finished, data);
+    } else {
+      BTA_GATTC_ReadCharDescr(conn_id, handle, GATT_AUTH_REQ_NONE,
+                              gatt_read_op_finished, data);
+    }
+    return;
+  }
+
+  if (op.type == GATT_WRITE_CHAR) {
     gatt_write_op_data* data =
         (gatt_write_op_data*)osi_malloc(sizeof(gatt_write_op_data));
     data->cb = op.write_cb;
@@ -142,26 +154,23 @@ void BtaGattQueue::gatt_execute_next_op(uint16_t conn_id) {
   gatt_ops.pop_front();
 }
 
-void BtaGattQueue::Clean(uint16_t conn_id) {
-  gatt_op_queue.erase(conn_id);
-  gatt_op_queue_executing.erase(conn_id);
-}
+void BtaGattQueue::Clean(uint16_t conn_id) { gatt_op_queue.erase(conn_id); }
 
 void BtaGattQueue::ReadCharacteristic(uint16_t conn_id, uint16_t handle,
                                       GATT_READ_OP_CB cb, void* cb_data) {
-  gatt_op_queue[conn_id].push_back({.type = GATT_READ_CHAR,
-                                    .handle = handle,
-                                    .read_cb = cb,
-                                    .read_cb_data = cb_data});
+  gatt_op_queue[conn_id].ops.push_back({.type = GATT_READ_CHAR,
+                                        .handle = handle,
+                                        .read_cb = cb,
+                                        .read_cb_data = cb_data});
   gatt_execute_next_op(conn_id);
 }
 
 void BtaGattQueue::ReadDescriptor(uint16_t conn_id, uint16_t handle,
                                   GATT_READ_OP_CB cb, void* cb_data) {
-  gatt_op_queue[conn_id].push_back({.type = GATT_READ_DESC,
-                                    .handle = handle,
-                                    .read_cb = cb,
-                                    .read_cb_data = cb_data});
+  gatt_op_queue[conn_id].ops.push_back({.type = GATT_READ_DESC,
+                                        .handle = handle,
+                                        .read_cb = cb,
+                                        .read_cb_data = cb_data});
   gatt_execute_next_op(conn_id);
 }
 
@@ -169,12 +178,12 @@ void BtaGattQueue::WriteCharacteristic(uint16_t conn_id, uint16_t handle,
                                        std::vector<uint8_t> value,
                                        tGATT_WRITE_TYPE write_type,
                                        GATT_WRITE_OP_CB cb, void* cb_data) {
-  gatt_op_queue[conn_id].push_back({.type = GATT_WRITE_CHAR,
-                                    .handle = handle,
-                                    .write_cb = cb,
-                                    .write_cb_data = cb_data,
-                                    .write_type = write_type,
-                                    .value = std::move(value)});
+  gatt_op_queue[conn_id].ops.push_back({.type = GATT_WRITE_CHAR,
+                                        .handle = handle,
+                                        .write_cb = cb,
+                                        .write_cb_data = cb_data,
+                                        .write_type = write_type,
+                                        .value = std::move(value)});
   gatt_execute_next_op(conn_id);
 }
 
@@ -182,11 +191,11 @@ void BtaGattQueue::WriteDescriptor(uint16_t conn_id, uint16_t handle,
                                    std::vector<uint8_t> value,
                                    tGATT_WRITE_TYPE write_type,
                                    GATT_WRITE_OP_CB cb, void* cb_data) {
-  gatt_op_queue[conn_id].push_back({.type = GATT_WRITE_DESC,
-                                    .handle = handle,
-                                    .write_cb = cb,
-                                    .write_cb_data = cb_data,
-                                    .write_type = write_type,
-                                    .value = std::move(value)});
+  gatt_op_queue[conn_id].ops.push_back({.type = GATT_WRITE_DESC,
+                                        .handle = handle,
+                                        .write_cb = cb,
+                                        .write_cb_data = cb_data,
+                                        .write_type = write_type,
+                                        .value = std::move(value)});
   gatt_execute_next_op(conn_id);
 }
@@ -102,13 +102,30 @@ tBTA_GATTC_CLCB* bta_gattc_find_clcb_by_cif(uint8_t client_if,
  *
  ******************************************************************************/
 tBTA_GATTC_CLCB* bta_gattc_find_clcb_by_conn_id(uint16_t conn_id) {
-  tBTA_GATTC_CLCB* p_clcb = &bta_gattc_cb.clcb[0];
-  uint8_t i;
+  auto it = bta_gattc_cb.clcb_by_conn_id.find(conn_id);
+  if (it == bta_gattc_cb.clcb_by_conn_id.end()) return NULL;
+  return &bta_gattc_cb.clcb[it->second];
+}
 
-  for (i = 0; i < BTA_GATTC_CLCB_MAX; i++, p_clcb++) {
-    if (p_clcb->in_use && p_clcb->bta_conn_id == conn_id) return p_clcb;
-  }
-  return NULL;
+/*******************************************************************************
+ *
+ * Function         bta_gattc_clcb_set_conn_id
+ *
+ * Description      set the connection ID of a clcb in use, and index the clcb
+ *                  by it
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void bta_gattc_clcb_set_conn_id(tBTA_GATTC_CLCB* p_clcb, uint16_t conn_id) {
+  auto& index = bta_gattc_cb.clcb_by_conn_id;
+  uint8_t i_clcb = p_clcb - &bta_gattc_cb.clcb[0];
+
+  auto it = index.find(p_clcb->bta_conn_id);
+  if (it != index.end() && it->second == i_clcb) index.erase(it);
+
+  p_clcb->bta_conn_id = conn_id;
+  index[conn_id] = i_clcb;
 }
 
 /*******************************************************************************
@@ -202,11 +219,21 @@ void bta_gattc_clcb_dealloc(tBTA_GATTC_CLCB* p_clcb) {
     p_srcb->connected = false;
     p_srcb->state = BTA_GATTC_SERV_IDLE;
     p_srcb->mtu = 0;
-
-    // clear reallocating
-    p_srcb->gatt_database.Clear();
+    p_srcb->mtu_exchanged = false;
+
+    // A database with a Database Hash is kept, the next connection only reads
+    // the hash to validate it instead of exploring the services again
+    if (p_srcb->database_hash.empty())
+      p_srcb->gatt_database.Clear();
+    else
+      p_srcb->verify_db_hash = true;
   }
 
+  auto& index = bta_gattc_cb.clcb_by_conn_id;
+  auto it = index.find(p_clcb->bta_conn_id);
+  if (it != index.end() && &bta_gattc_cb.clcb[it->second] == p_clcb)
+    index.erase(it);
+
   osi_free_and_reset((void**)&p_clcb->p_q_cmd);
   memset(p_clcb, 0, sizeof(tBTA_GATTC_CLCB));
 }
@@ -221,13 +248,11 @@ void bta_gattc_clcb_dealloc(tBTA_GATTC_CLCB* p_clcb) {
  *
  ******************************************************************************/
 tBTA_GATTC_SERV* bta_gattc_find_srcb(const RawAddress& bda) {
-  tBTA_GATTC_SERV* p_srcb = &bta_gattc_cb.known_server[0];
-  uint8_t i;
-
-  for (i = 0; i < BTM_GetWhiteListSize(); i++, p_srcb++) {
-    if (p_srcb->in_use && p_srcb->server_bda == bda) return p_srcb;
-  }
-  return NULL;
+  auto it = bta_gattc_cb.srcb_by_bda.find(bda);
+  if (it == bta_gattc_cb.srcb_by_bda.end() ||
+      it->second >= bta_gattc_cb.known_server.size())
+    return NULL;
+  return &bta_gattc_cb.known_server[it->second];
 }
 
 /*******************************************************************************
@@ -240,11 +265,8 @@ tBTA_GATTC_SERV* bta_gattc_find_srcb(const RawAddress& bda) {
  *
  ******************************************************************************/
 tBTA_GATTC_SERV* bta_gattc_find_srvr_cache(const RawAddress& bda) {
-  tBTA_GATTC_SERV* p_srcb = &bta_gattc_cb.known_server[0];
-  uint8_t i;
-
-  for (i = 0; i < BTM_GetWhiteListSize(); i++, p_srcb++) {
-    if (p_srcb->server_bda == bda) return p_srcb;
+  for (tBTA_GATTC_SERV& srcb : bta_gattc_cb.known_server) {
+    if (srcb.server_bda == bda) return &srcb;
   }
   return NULL;
 }
@@ -275,26 +297,43 @@ tBTA_GATTC_SERV* bta_gattc_find_scb_by_cid(uint16_t conn_id) {
  *
  ******************************************************************************/
 tBTA_GATTC_SERV* bta_gattc_srcb_alloc(const RawAddress& bda) {
-  tBTA_GATTC_SERV *p_tcb = &bta_gattc_cb.known_server[0], *p_recycle = NULL;
-  bool found = false;
-  uint8_t i;
-
-  for (i = 0; i < BTM_GetWhiteListSize(); i++, p_tcb++) {
-    if (!p_tcb->in_use) {
-      found = true;
+  std::deque<tBTA_GATTC_SERV>& known_server = bta_gattc_cb.known_server;
+  size_t max_srcb = BTM_GetWhiteListSize();
+  if (max_srcb > BTA_GATTC_KNOWN_SR_MAX) max_srcb = BTA_GATTC_KNOWN_SR_MAX;
+
+  tBTA_GATTC_SERV* p_tcb = NULL;
+  uint8_t i_srcb = 0, i_recycle = 0;
+  bool recycle = false;
+
+  for (size_t i = 0; i < known_server.size(); i++) {
+    if (!known_server[i].in_use) {
+      p_tcb = &known_server[i];
+      i_srcb = i;
       break;
-    } else if (!p_tcb->connected) {
-      p_recycle = p_tcb;
+    } else if (!known_server[i].connected) {
+      recycle = true;
+      i_recycle = i;
     }
   }
 
-  /* if not found, try to recycle one known device */
-  if (!found && !p_recycle)
-    p_tcb = NULL;
-  else if (!found && p_recycle)
-    p_tcb = p_recycle;
+  /* then add an entry, and once there are as many as the white list can
+   * take, try to recycle one known device */
+  if (p_tcb == NULL && known_server.size() < max_srcb) {
+    i_srcb = known_server.size();
+    known_server.emplace_back();
+    p_tcb = &known_server.back();
+  } else if (p_tcb == NULL && recycle) {
+    i_srcb = i_recycle;
+    p_tcb = &known_server[i_recycle];
+  }
 
   if (p_tcb != NULL) {
+    if (p_tcb->in_use) {
+      auto it = bta_gattc_cb.srcb_by_bda.find(p_tcb->server_bda);
+      if (it != bta_gattc_cb.srcb_by_bda.end() && it->second == i_srcb)
+        bta_gattc_cb.srcb_by_bda.erase(it);
+    }
+
     // clear reallocating
     p_tcb->gatt_database.Clear();
     p_tcb->pending_discovery.Clear();
@@ -302,6 +341,7 @@ tBTA_GATTC_SERV* bta_gattc_srcb_alloc(const RawAddress& bda) {
 
     p_tcb->in_use = true;
     p_tcb->server_bda = bda;
+    bta_gattc_cb.srcb_by_bda[bda] = i_srcb;
   }
   return p_tcb;
 }
@@ -409,7 +449,7 @@ bool bta_gattc_mark_bg_conn(tGATT_IF client_if,
   uint8_t i = 0;
   tBTA_GATTC_CIF_MASK* p_cif_mask;
 
-  for (i = 0; i < BTM_GetWhiteListSize(); i++, p_bg_tck++) {
+  for (i = 0; i < BTA_GATTC_KNOWN_SR_MAX; i++, p_bg_tck++) {
     if (p_bg_tck->in_use && ((p_bg_tck->remote_bda == remote_bda_ptr) ||
                              (p_bg_tck->remote_bda.IsEmpty()))) {
       p_cif_mask = &p_bg_tck->cif_mask;
@@ -437,7 +477,7 @@ bool bta_gattc_mark_bg_conn(tGATT_IF client_if,
   } else /* adding a new device mask */
   {
     for (i = 0, p_bg_tck = &bta_gattc_cb.bg_track[0];
-         i < BTM_GetWhiteListSize(); i++, p_bg_tck++) {
+         i < BTA_GATTC_KNOWN_SR_MAX; i++, p_bg_tck++) {
       if (!p_bg_tck->in_use) {
         p_bg_tck->in_use = true;
         p_bg_tck->remote_bda = remote_bda_ptr;
@@ -468,7 +508,7 @@ bool bta_gattc_check_bg_conn(tGATT_IF client_if, const RawAddress& remote_bda,
   uint8_t i = 0;
   bool is_bg_conn = false;
 
-  for (i = 0; i < BTM_GetWhiteListSize() && !is_bg_conn; i++, p_bg_tck++) {
+  for (i = 0; i < BTA_GATTC_KNOWN_SR_MAX && !is_bg_conn; i++, p_bg_tck++) {
     if (p_bg_tck->in_use && (p_bg_tck->remote_bda == remote_bda ||
                              p_bg_tck->remote_bda.IsEmpty())) {
       if (((p_bg_tck->cif_mask & (1 << (client_if - 1))) != 0) &&
@@ -280,6 +280,62 @@ void BTA_GATTS_SendRsp(uint16_t conn_id, uint32_t trans_id, tGATT_STATUS status,
   bta_sys_sendmsg(p_buf);
 }
 
+static void bta_gatts_set_cached_value_impl(tGATT_IF server_if,
+                                            uint16_t attr_id,
+                                            std::vector<uint8_t> value) {
+  tGATT_STATUS status =
+      GATTS_SetCachedValue(server_if, attr_id, value.data(), value.size());
+  if (status != GATT_SUCCESS) {
+    LOG(ERROR) << __func__ << ": attr_id=" << loghex(attr_id)
+               << ", status=" << loghex(status);
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         BTA_GATTS_SetCachedValue
+ *
+ * Description      This function is called to have the stack answer the
+ *                  reads of a characteristic or descriptor with |value|.
+ *
+ * Parameters       server_if - server interface owning the attribute.
+ *                  attr_id - attribute ID.
+ *                  value - the attribute value.
+ *
+ * Returns          None
+ *
+ ******************************************************************************/
+void BTA_GATTS_SetCachedValue(tGATT_IF server_if, uint16_t attr_id,
+                              std::vector<uint8_t> value) {
+  do_in_main_thread(FROM_HERE,
+                    base::Bind(&bta_gatts_set_cached_value_impl, server_if,
+                               attr_id, std::move(value)));
+}
+
+static void bta_gatts_invalidate_cached_value_impl(tGATT_IF server_if,
+                                                   uint16_t attr_id) {
+  GATTS_InvalidateCachedValue(server_if, attr_id);
+}
+
+/*******************************************************************************
+ *
+ * Function         BTA_GATTS_InvalidateCachedValue
+ *
+ * Description      This function is called to send the reads of an attribute
+ *                  to the application again.
+ *
+ * Parameters       server_if - server interface owning the attribute.
+ *                  attr_id - attribute ID.
+ *
+ * Returns          None
+ *
+ ******************************************************************************/
+void BTA_GATTS_InvalidateCachedValue(tGATT_IF server_if, uint16_t attr_id) {
+  do_in_main_thread(FROM_HERE,
+                    base::Bind(&bta_gatts_invalidate_cached_value_impl,
+                               server_if, attr_id));
+}
+
 /*******************************************************************************
  *
  * Function         BTA_GATTS_Open
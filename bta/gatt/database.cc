@@ -21,6 +21,8 @@
 #include "stack/include/gattdefs.h"
 
 #include <base/logging.h>
+#include <algorithm>
+#include <iterator>
 #include <list>
 #include <memory>
 #include <sstream>
@@ -49,6 +51,98 @@ Service* FindService(std::list<Service>& services, uint16_t handle) {
   return nullptr;
 }
 
+Database::Database(const Database& other) : services(other.services) {
+  BuildIndex();
+}
+
+Database& Database::operator=(const Database& other) {
+  if (this != &other) {
+    services = other.services;
+    BuildIndex();
+  }
+  return *this;
+}
+
+void Database::BuildIndex() {
+  services_by_handle.clear();
+  characteristics_by_value_handle.clear();
+  descriptors_by_handle.clear();
+
+  for (const Service& service : services) {
+    services_by_handle.push_back(&service);
+    for (const Characteristic& charac : service.characteristics) {
+      characteristics_by_value_handle.push_back({charac.value_handle, &charac});
+      for (const Descriptor& desc : charac.descriptors) {
+        descriptors_by_handle.push_back({desc.handle, &desc, &charac});
+      }
+    }
+  }
+
+  // Services are kept sorted by the builder, characteristics and descriptors
+  // are sorted within each service. Sort anyway, the database might have been
+  // deserialized from a file. Stable, so that the first of duplicated handles
+  // is found, as with a walk of the tree.
+  std::stable_sort(services_by_handle.begin(), services_by_handle.end(),
+                   [](const Service* a, const Service* b) {
+                     return a->handle < b->handle;
+                   });
+  std::stable_sort(characteristics_by_value_handle.begin(),
+                   characteristics_by_value_handle.end(),
+                   [](const CharacteristicIndex& a,
+                      const CharacteristicIndex& b) {
+                     return a.value_handle < b.value_handle;
+                   });
+  std::stable_sort(
+      descriptors_by_handle.begin(), descriptors_by_handle.end(),
+      [](const DescriptorIndex& a, const DescriptorIndex& b) {
+        return a.handle < b.handle;
+      });
+}
+
+const Service* Database::FindServiceForHandle(uint16_t handle) const {
+  // last service starting at or before |handle|
+  auto it = std::upper_bound(
+      services_by_handle.begin(), services_by_handle.end(), handle,
+      [](uint16_t h, const Service* s) { return h < s->handle; });
+  if (it == services_by_handle.begin()) return nullptr;
+  const Service* service = *std::prev(it);
+  if (!HandleInRange(*service, handle)) return nullptr;
+  return service;
+}
+
+const Characteristic* Database::FindCharacteristic(
+    uint16_t value_handle) const {
+  auto it = std::lower_bound(characteristics_by_value_handle.begin(),
+                             characteristics_by_value_handle.end(),
+                             value_handle,
+                             [](const CharacteristicIndex& c, uint16_t h) {
+                               return c.value_handle < h;
+                             });
+  if (it == characteristics_by_value_handle.end() ||
+      it->value_handle != value_handle)
+    return nullptr;
+  return it->characteristic;
+}
+
+const Descriptor* Database::FindDescriptor(uint16_t handle) const {
+  auto it = std::lower_bound(
+      descriptors_by_handle.begin(), descriptors_by_handle.end(), handle,
+      [](const DescriptorIndex& d, uint16_t h) { return d.handle < h; });
+  if (it == descriptors_by_handle.end() || it->handle != handle)
+    return nullptr;
+  return it->descriptor;
+}
+
+const Characteristic* Database::FindOwningCharacteristic(
+    uint16_t handle) const {
+  auto it = std::lower_bound(
+      descriptors_by_handle.begin(), descriptors_by_handle.end(), handle,
+      [](const DescriptorIndex& d, uint16_t h) { return d.handle < h; });
+  if (it == descriptors_by_handle.end() || it->handle != handle)
+    return nullptr;
+  return it->owner;
+}
+
 std::string Database::ToString() const {
   std::stringstream tmp;
 
@@ -120,11 +214,17 @@ std::vector<StoredAttribute> Database::Serialize() const {
 
 Database Database::Deserialize(const std::vector<StoredAttribute>& nv_attr,
                                bool* success) {
+  return Deserialize(nv_attr.data(), nv_attr.size(), success);
+}
+
+Database Database::Deserialize(const StoredAttribute* nv_attr, size_t count,
+                               bool* success) {
   // clear reallocating
   Database result;
-  auto it = nv_attr.cbegin();
+  const StoredAttribute* it = nv_attr;
+  const StoredAttribute* end = nv_attr + count;
 
-  for (; it != nv_attr.cend(); ++it) {
+  for (; it != end; ++it) {
     const auto& attr = *it;
     if (attr.type != PRIMARY_SERVICE && attr.type != SECONDARY_SERVICE) break;
     result.services.emplace_back(Service{
@@ -136,7 +236,7 @@ Database Database::Deserialize(const std::vector<StoredAttribute>& nv_attr,
   }
 
   auto current_service_it = result.services.begin();
-  for (; it != nv_attr.cend(); it++) {
+  for (; it != end; it++) {
     const auto& attr = *it;
 
     // go to the service this attribute belongs to; attributes are stored in
@@ -150,6 +250,7 @@ Database Database::Deserialize(const std::vector<StoredAttribute>& nv_attr,
         !HandleInRange(*current_service_it, attr.handle)) {
       LOG(ERROR) << "Can't find service for attribute with handle: "
                  << loghex(attr.handle);
+      result.BuildIndex();
       *success = false;
       return result;
     }
@@ -159,6 +260,7 @@ Database Database::Deserialize(const std::vector<StoredAttribute>& nv_attr,
           FindService(result.services, attr.value.included_service.handle);
       if (!included_service) {
         LOG(ERROR) << __func__ << ": Non-existing included service!";
+        result.BuildIndex();
         *success = false;
         return result;
       }
@@ -177,10 +279,17 @@ Database Database::Deserialize(const std::vector<StoredAttribute>& nv_attr,
       });
 
     } else {
+      if (current_service_it->characteristics.empty()) {
+        LOG(ERROR) << __func__ << ": Descriptor outside of characteristic!";
+        result.BuildIndex();
+        *success = false;
+        return result;
+      }
       current_service_it->characteristics.back().descriptors.emplace_back(
           Descriptor{.handle = attr.handle, .uuid = attr.type});
     }
   }
+  result.BuildIndex();
   *success = true;
   return result;
 }
@@ -97,12 +97,24 @@ class DatabaseBuilder;
 
 class Database {
  public:
+  Database() = default;
+  /* Copies rebuild the handle index, it points into |services| */
+  Database(const Database& other);
+  Database& operator=(const Database& other);
+  Database(Database&& other) = default;
+  Database& operator=(Database&& other) = default;
+
   /* Return true if there are no services in this database. */
   bool IsEmpty() const { return services.empty(); }
 
   /* Clear the GATT database. This method forces relocation to ensure no extra
    * space is used unnecesarly */
-  void Clear() { std::list<Service>().swap(services); }
+  void Clear() {
+    std::list<Service>().swap(services);
+    std::vector<const Service*>().swap(services_by_handle);
+    std::vector<CharacteristicIndex>().swap(characteristics_by_value_handle);
+    std::vector<DescriptorIndex>().swap(descriptors_by_handle);
+  }
 
   /* Return list of services available in this database */
   const std::list<Service>& Services() const { return services; }
@@ -114,10 +126,49 @@ class Database {
   static Database Deserialize(const std::vector<gatt::StoredAttribute>& nv_attr,
                               bool* success);
 
+  /* Same as above, for |count| attributes stored at |nv_attr|, i.e. read in
+   * place from a mapped cache file. */
+  static Database Deserialize(const gatt::StoredAttribute* nv_attr,
+                              size_t count, bool* success);
+
+  /* Handle lookups, done with a binary search over flat arrays sorted by
+   * handle. They return nullptr if nothing matches. */
+
+  /* Return the service whose handle range contains |handle| */
+  const Service* FindServiceForHandle(uint16_t handle) const;
+
+  /* Return the characteristic with value handle |value_handle| */
+  const Characteristic* FindCharacteristic(uint16_t value_handle) const;
+
+  /* Return the descriptor with |handle| */
+  const Descriptor* FindDescriptor(uint16_t handle) const;
+
+  /* Return the characteristic owning the descriptor with |handle| */
+  const Characteristic* FindOwningCharacteristic(uint16_t handle) const;
+
   friend class DatabaseBuilder;
 
  private:
+  struct CharacteristicIndex {
+    uint16_t value_handle;
+    const Characteristic* characteristic;
+  };
+
+  struct DescriptorIndex {
+    uint16_t handle;
+    const Descriptor* descriptor;
+    const Characteristic* owner;
+  };
+
+  /* Rebuild the handle index from |services|. Called once the database is
+   * complete, it must not be modified afterwards. */
+  void BuildIndex();
+
   std::list<Service> services;
+
+  std::vector<const Service*> services_by_handle;
+  std::vector<CharacteristicIndex> characteristics_by_value_handle;
+  std::vector<DescriptorIndex> descriptors_by_handle;
 };
 
 /* Find a service that should contain handle. Helper method for internal use
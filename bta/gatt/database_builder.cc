@@ -183,8 +183,9 @@ std::pair<uint16_t, uint16_t> DatabaseBuilder::NextDescriptorRangeToExplore() {
 bool DatabaseBuilder::InProgress() const { return !database.services.empty(); }
 
 Database DatabaseBuilder::Build() {
-  Database tmp = database;
+  Database tmp = std::move(database);
   database.Clear();
+  tmp.BuildIndex();
   return tmp;
 }
 
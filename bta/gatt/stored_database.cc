@@ -0,0 +1,301 @@
+/******************************************************************************
+ *
+ *  Copyright 2020 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include "stored_database.h"
+#include "stack/include/gattdefs.h"
+
+#include <base/logging.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <numeric>
+
+using bluetooth::Uuid;
+
+namespace gatt {
+
+namespace {
+const Uuid PRIMARY_SERVICE = Uuid::From16Bit(GATT_UUID_PRI_SERVICE);
+const Uuid SECONDARY_SERVICE = Uuid::From16Bit(GATT_UUID_SEC_SERVICE);
+const Uuid INCLUDE = Uuid::From16Bit(GATT_UUID_INCLUDE_SERVICE);
+const Uuid CHARACTERISTIC = Uuid::From16Bit(GATT_UUID_CHAR_DECLARE);
+
+/* "GDB\0" */
+constexpr uint32_t MAGIC = 0x00424447;
+
+struct StoredDatabaseHeader {
+  uint32_t magic;
+  uint16_t version;
+  /* sizeof(StoredAttribute) of the writer, so that files written with another
+   * layout are rejected */
+  uint16_t attribute_size;
+  uint32_t count;
+  uint32_t reserved;
+  uint64_t hash;
+};
+
+static_assert(sizeof(StoredDatabaseHeader) % alignof(StoredAttribute) == 0,
+              "attributes must be aligned after the header");
+static_assert(sizeof(StoredAttribute) % alignof(uint16_t) == 0,
+              "handle index must be aligned after the attributes");
+
+size_t FileSize(size_t count) {
+  return sizeof(StoredDatabaseHeader) +
+         count * (sizeof(StoredAttribute) + sizeof(uint16_t));
+}
+
+/* FNV-1a */
+constexpr uint64_t HASH_OFFSET = 0xcbf29ce484222325ULL;
+constexpr uint64_t HASH_PRIME = 0x100000001b3ULL;
+
+void HashBytes(uint64_t* hash, const uint8_t* data, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    *hash = (*hash ^ data[i]) * HASH_PRIME;
+  }
+}
+
+void HashUint16(uint64_t* hash, uint16_t value) {
+  uint8_t data[2] = {static_cast<uint8_t>(value),
+                     static_cast<uint8_t>(value >> 8)};
+  HashBytes(hash, data, sizeof(data));
+}
+
+void HashUuid(uint64_t* hash, const Uuid& uuid) {
+  HashBytes(hash, uuid.To128BitBE().data(), Uuid::kNumBytes128);
+}
+
+bool IsService(const StoredAttribute& attr) {
+  return attr.type == PRIMARY_SERVICE || attr.type == SECONDARY_SERVICE;
+}
+
+/* Descriptors are stored with their type only, any other attribute is a
+ * declaration */
+bool IsDescriptor(const StoredAttribute& attr) {
+  return !IsService(attr) && attr.type != INCLUDE &&
+         attr.type != CHARACTERISTIC;
+}
+}  // namespace
+
+StoredDatabase::StoredDatabase(void* map, size_t map_size)
+    : map(map), map_size(map_size) {}
+
+StoredDatabase::~StoredDatabase() { munmap(map, map_size); }
+
+uint64_t StoredDatabase::Hash(const StoredAttribute* attr, size_t count) {
+  // Only the fields used by each attribute type are hashed: padding and the
+  // unused part of the value union are not initialized.
+  uint64_t hash = HASH_OFFSET;
+  for (const StoredAttribute* it = attr; it != attr + count; it++) {
+    HashUint16(&hash, it->handle);
+    HashUuid(&hash, it->type);
+    if (IsService(*it)) {
+      HashUuid(&hash, it->value.service.uuid);
+      HashUint16(&hash, it->value.service.end_handle);
+    } else if (it->type == INCLUDE) {
+      HashUint16(&hash, it->value.included_service.handle);
+      HashUint16(&hash, it->value.included_service.end_handle);
+      HashUuid(&hash, it->value.included_service.uuid);
+    } else if (it->type == CHARACTERISTIC) {
+      HashBytes(&hash, &it->value.characteristic.properties, 1);
+      HashUint16(&hash, it->value.characteristic.value_handle);
+      HashUuid(&hash, it->value.characteristic.uuid);
+    }
+  }
+  return hash;
+}
+
+std::unique_ptr<StoredDatabase> StoredDatabase::Open(const std::string& path) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    LOG(ERROR) << __func__ << ": can't open GATT cache file " << path
+               << " for reading, error: " << strerror(errno);
+    return nullptr;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 ||
+      static_cast<size_t>(st.st_size) < sizeof(StoredDatabaseHeader)) {
+    LOG(ERROR) << __func__ << ": GATT cache file too short: " << path;
+    close(fd);
+    return nullptr;
+  }
+
+  size_t map_size = st.st_size;
+  void* map = mmap(nullptr, map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    LOG(ERROR) << __func__ << ": can't map GATT cache file " << path
+               << ", error: " << strerror(errno);
+    return nullptr;
+  }
+  std::unique_ptr<StoredDatabase> db(new StoredDatabase(map, map_size));
+
+  const auto* header = static_cast<const StoredDatabaseHeader*>(map);
+  if (header->magic != MAGIC || header->version != VERSION ||
+      header->attribute_size != sizeof(StoredAttribute)) {
+    LOG(ERROR) << __func__ << ": wrong GATT cache version: " << path;
+    return nullptr;
+  }
+  if (header->count > HANDLE_MAX || map_size != FileSize(header->count)) {
+    LOG(ERROR) << __func__ << ": wrong GATT cache size: " << path;
+    return nullptr;
+  }
+
+  db->count = header->count;
+  db->attr = reinterpret_cast<const StoredAttribute*>(header + 1);
+  db->by_handle = reinterpret_cast<const uint16_t*>(db->attr + db->count);
+  db->hash = header->hash;
+
+  // Find() relies on the index being sorted and in range
+  for (size_t i = 0; i < db->count; i++) {
+    if (db->by_handle[i] >= db->count ||
+        (i > 0 && db->attr[db->by_handle[i - 1]].handle >=
+                      db->attr[db->by_handle[i]].handle)) {
+      LOG(ERROR) << __func__ << ": corrupted GATT cache index: " << path;
+      return nullptr;
+    }
+  }
+  if (Hash(db->attr, db->count) != db->hash) {
+    LOG(ERROR) << __func__ << ": GATT cache hash mismatch: " << path;
+    return nullptr;
+  }
+
+  return db;
+}
+
+bool StoredDatabase::Write(const std::string& path,
+                           const std::vector<StoredAttribute>& attr) {
+  std::vector<uint16_t> by_handle(attr.size());
+  std::iota(by_handle.begin(), by_handle.end(), 0);
+  std::sort(by_handle.begin(), by_handle.end(), [&](uint16_t a, uint16_t b) {
+    return attr[a].handle < attr[b].handle;
+  });
+  for (size_t i = 1; i < by_handle.size(); i++) {
+    if (attr[by_handle[i - 1]].handle == attr[by_handle[i]].handle) {
+      LOG(ERROR) << __func__ << ": duplicate GATT attribute handle "
+                 << attr[by_handle[i]].handle;
+      return false;
+    }
+  }
+
+  StoredDatabaseHeader header = {
+      .magic = MAGIC,
+      .version = VERSION,
+      .attribute_size = sizeof(StoredAttribute),
+      .count = static_cast<uint32_t>(attr.size()),
+      .reserved = 0,
+      .hash = Hash(attr.data(), attr.size()),
+  };
+  std::vector<uint8_t> contents(FileSize(attr.size()));
+  uint8_t* p = contents.data();
+  memcpy(p, &header, sizeof(header));
+  p += sizeof(header);
+  memcpy(p, attr.data(), attr.size() * sizeof(StoredAttribute));
+  p += attr.size() * sizeof(StoredAttribute);
+  memcpy(p, by_handle.data(), by_handle.size() * sizeof(uint16_t));
+
+  FILE* fd = fopen(path.c_str(), "wb");
+  if (!fd) {
+    LOG(ERROR) << __func__
+               << ": can't open GATT cache file for writing: " << path;
+    return false;
+  }
+  bool success =
+      fwrite(contents.data(), 1, contents.size(), fd) == contents.size();
+  if (!success) {
+    LOG(ERROR) << __func__ << ": can't write GATT cache: " << path;
+  }
+  fclose(fd);
+  return success;
+}
+
+size_t StoredDatabase::LowerBound(uint16_t handle) const {
+  const uint16_t* it = std::lower_bound(
+      by_handle, by_handle + count, handle,
+      [this](uint16_t index, uint16_t h) { return attr[index].handle < h; });
+  return it - by_handle;
+}
+
+const StoredAttribute* StoredDatabase::Find(uint16_t handle) const {
+  size_t pos = LowerBound(handle);
+  if (pos == count || AttributeAt(pos).handle != handle) return nullptr;
+  return &AttributeAt(pos);
+}
+
+const StoredAttribute* StoredDatabase::FindServiceForHandle(
+    uint16_t handle) const {
+  // Walk back from the last attribute at or before |handle| to the service
+  // declaration, at most across one service
+  size_t pos = LowerBound(handle);
+  if (pos == count || AttributeAt(pos).handle != handle) {
+    if (pos == 0) return nullptr;
+    pos--;
+  }
+  while (!IsService(AttributeAt(pos))) {
+    if (pos == 0) return nullptr;
+    pos--;
+  }
+  const StoredAttribute& service = AttributeAt(pos);
+  if (handle > service.value.service.end_handle) return nullptr;
+  return &service;
+}
+
+const StoredAttribute* StoredDatabase::FindCharacteristic(
+    uint16_t value_handle) const {
+  // The value has no attribute of its own, it comes right after the
+  // declaration
+  size_t pos = LowerBound(value_handle);
+  if (pos == 0) return nullptr;
+  const StoredAttribute& declaration = AttributeAt(pos - 1);
+  if (declaration.type != CHARACTERISTIC ||
+      declaration.value.characteristic.value_handle != value_handle)
+    return nullptr;
+  return &declaration;
+}
+
+const StoredAttribute* StoredDatabase::FindOwningCharacteristic(
+    uint16_t handle) const {
+  size_t pos = LowerBound(handle);
+  if (pos == count || AttributeAt(pos).handle != handle ||
+      !IsDescriptor(AttributeAt(pos)))
+    return nullptr;
+  while (pos > 0 && IsDescriptor(AttributeAt(pos - 1))) pos--;
+  if (pos == 0 || AttributeAt(pos - 1).type != CHARACTERISTIC) return nullptr;
+  return &AttributeAt(pos - 1);
+}
+
+std::vector<const StoredAttribute*> StoredDatabase::Descriptors(
+    const StoredAttribute* declaration) const {
+  std::vector<const StoredAttribute*> descriptors;
+  for (size_t pos = LowerBound(declaration->handle) + 1;
+       pos < count && IsDescriptor(AttributeAt(pos)); pos++) {
+    descriptors.push_back(&AttributeAt(pos));
+  }
+  return descriptors;
+}
+
+Database StoredDatabase::ToDatabase(bool* success) const {
+  return Database::Deserialize(attr, count, success);
+}
+
+}  // namespace gatt
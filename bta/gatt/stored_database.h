@@ -0,0 +1,109 @@
+/******************************************************************************
+ *
+ *  Copyright 2020 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gatt/database.h"
+
+namespace gatt {
+
+/* Read-only view of a GATT cache file, mapped in memory.
+ *
+ * The file holds a header, the attributes in the order produced by
+ * Database::Serialize(), and the indices of those attributes sorted by handle.
+ * It contains no pointers, so it is used in place wherever it is mapped:
+ * single attributes are looked up by handle without building a Database. */
+class StoredDatabase {
+ public:
+  /* Version of the file format, bumped whenever the layout changes */
+  static constexpr uint16_t VERSION = 6;
+
+  ~StoredDatabase();
+
+  /* Map and validate the cache file at |path|. Returns nullptr if the file
+   * can't be read, was written by another version, or is corrupted. */
+  static std::unique_ptr<StoredDatabase> Open(const std::string& path);
+
+  /* Write |attr|, as returned by Database::Serialize(), to |path|. Returns
+   * true on success. */
+  static bool Write(const std::string& path,
+                    const std::vector<StoredAttribute>& attr);
+
+  /* Hash of the attributes, independent of the in-memory layout. Two
+   * databases with the same services, characteristics and descriptors have
+   * the same hash. */
+  static uint64_t Hash(const StoredAttribute* attr, size_t count);
+
+  /* Hash stored in the file header, checked against the attributes on Open */
+  uint64_t Hash() const { return hash; }
+
+  size_t Size() const { return count; }
+
+  /* Return the attribute with |handle|, or nullptr if there is none. The
+   * pointer is valid as long as this object. */
+  const StoredAttribute* Find(uint16_t handle) const;
+
+  /* Lookups of Database, done in place on the attributes sorted by handle.
+   * Services and characteristics are returned as their declaration, and
+   * nothing about them is parsed before it is asked for. They return nullptr
+   * if nothing matches. */
+
+  /* Return the declaration of the service whose handle range contains
+   * |handle| */
+  const StoredAttribute* FindServiceForHandle(uint16_t handle) const;
+
+  /* Return the declaration of the characteristic with value handle
+   * |value_handle| */
+  const StoredAttribute* FindCharacteristic(uint16_t value_handle) const;
+
+  /* Return the declaration of the characteristic owning the descriptor with
+   * |handle| */
+  const StoredAttribute* FindOwningCharacteristic(uint16_t handle) const;
+
+  /* Return the descriptors of the characteristic declared by |declaration|,
+   * in handle order */
+  std::vector<const StoredAttribute*> Descriptors(
+      const StoredAttribute* declaration) const;
+
+  /* Build the Database described by the file. */
+  Database ToDatabase(bool* success) const;
+
+ private:
+  StoredDatabase(void* map, size_t map_size);
+
+  /* Position in |by_handle| of the first attribute with a handle not lower
+   * than |handle| */
+  size_t LowerBound(uint16_t handle) const;
+
+  const StoredAttribute& AttributeAt(size_t position) const {
+    return attr[by_handle[position]];
+  }
+
+  void* map;
+  size_t map_size;
+  const StoredAttribute* attr = nullptr;
+  const uint16_t* by_handle = nullptr;
+  size_t count = 0;
+  uint64_t hash = 0;
+};
+
+}  // namespace gatt
@@ -21,6 +21,7 @@
 #include "bta_gatt_api.h"
 #include "bta_gatt_queue.h"
 #include "btm_int.h"
+#include "common/time_util.h"
 #include "device/include/controller.h"
 #include "embdrv/g722/g722_enc_dec.h"
 #include "gap_api.h"
@@ -79,6 +80,15 @@ constexpr uint8_t OTHER_SIDE_IS_STREAMING = 0x01;
 // connnection intervals.
 constexpr uint16_t ADD_RENDER_DELAY_INTERVALS = 4;
 
+// Audio older than this number of data intervals is too late to be played in
+// sync with the other side, and is dropped rather than sent.
+constexpr uint16_t MAX_PACKET_AGE_INTERVALS = 2;
+
+// Audio is handed to L2CAP only while it holds fewer packets than this, so
+// that the rest waits here, where it can still be dropped by age, instead of
+// bloating the L2CAP queue while the peer is out of credits.
+constexpr uint16_t MAX_L2CAP_QUEUED_PACKETS = 1;
+
 namespace {
 
 // clang-format off
@@ -255,6 +265,11 @@ class HearingAidImpl : public HearingAid {
     VLOG(2) << __func__
             << ", default_data_interval_ms=" << default_data_interval_ms;
 
+    max_packet_age_ms = (uint16_t)osi_property_get_int32(
+        "persist.bluetooth.hearingaid.max_packet_age_ms",
+        (int32_t)(MAX_PACKET_AGE_INTERVALS * default_data_interval_ms));
+    VLOG(2) << __func__ << ", max_packet_age_ms=" << max_packet_age_ms;
+
     overwrite_min_ce_len = (uint16_t)osi_property_get_int32(
         "persist.bluetooth.hearingaidmincelen", 0);
     if (overwrite_min_ce_len) {
@@ -1032,6 +1047,7 @@ class HearingAidImpl : public HearingAid {
         LOG(INFO) << __func__ << ": send Stop cmd, device=" << device.address;
         device.playback_started = false;
         device.command_acked = false;
+        ClearAudioQueue(&device);
         BtaGattQueue::WriteCharacteristic(device.conn_id,
                                           device.audio_control_point_handle,
                                           stop, GATT_WRITE, nullptr, nullptr);
@@ -1163,9 +1179,13 @@ class HearingAidImpl : public HearingAid {
       return;
     }
 
-    std::vector<uint16_t> chan_left;
-    std::vector<uint16_t> chan_right;
+    // G.722 produces one byte per pair of samples
+    std::vector<uint8_t> encoded_data_left;
+    std::vector<uint8_t> encoded_data_right;
     if (left == nullptr || right == nullptr) {
+      // A single side gets the downmix of both channels
+      std::vector<int16_t> chan_mono;
+      chan_mono.reserve(num_samples);
       for (int i = 0; i < num_samples; i++) {
         const uint8_t* sample = data.data() + i * 4;
 
@@ -1174,76 +1194,29 @@ class HearingAidImpl : public HearingAid {
         sample += 2;
         int16_t right = (int16_t)((*(sample + 1) << 8) + *sample) >> 1;
 
-        uint16_t mono_data = (int16_t)(((uint32_t)left + (uint32_t)right) >> 1);
-        chan_left.push_back(mono_data);
-        chan_right.push_back(mono_data);
-      }
-    } else {
-      for (int i = 0; i < num_samples; i++) {
-        const uint8_t* sample = data.data() + i * 4;
-
-        uint16_t left = (int16_t)((*(sample + 1) << 8) + *sample) >> 1;
-        chan_left.push_back(left);
-
-        sample += 2;
-        uint16_t right = (int16_t)((*(sample + 1) << 8) + *sample) >> 1;
-        chan_right.push_back(right);
+        int16_t mono_data = (int16_t)(((uint32_t)left + (uint32_t)right) >> 1);
+        chan_mono.push_back(mono_data);
       }
-    }
-
-    // TODO: monural, binarual check
 
-    // divide encoded data into packets, add header, send.
-
-    // TODO: make those buffers static and global to prevent constant
-    // reallocations
-    // TODO: this should basically fit the encoded data, tune the size later
-    std::vector<uint8_t> encoded_data_left;
-    if (left) {
-      // TODO: instead of a magic number, we need to figure out the correct
-      // buffer size
-      encoded_data_left.resize(4000);
+      HearingDevice* device = left ? left : right;
+      std::vector<uint8_t>& encoded_data =
+          left ? encoded_data_left : encoded_data_right;
+      encoded_data.resize(num_samples / 2);
       int encoded_size =
-          g722_encode(encoder_state_left, encoded_data_left.data(),
-                      (const int16_t*)chan_left.data(), chan_left.size());
+          g722_encode(left ? encoder_state_left : encoder_state_right,
+                      encoded_data.data(), chan_mono.data(), chan_mono.size());
+      encoded_data.resize(encoded_size);
+    } else {
+      // Both encoders read the interleaved PCM of the audio HAL directly, in
+      // one pass. The samples are halved, as in the mono downmix.
+      encoded_data_left.resize(num_samples / 2);
+      encoded_data_right.resize(num_samples / 2);
+      int encoded_size = g722_encode_stereo(
+          encoder_state_left, encoder_state_right, encoded_data_left.data(),
+          encoded_data_right.data(), (const int16_t*)data.data(), num_samples,
+          1);
       encoded_data_left.resize(encoded_size);
-
-      uint16_t cid = GAP_ConnGetL2CAPCid(left->gap_handle);
-      uint16_t packets_to_flush = L2CA_FlushChannel(cid, L2CAP_FLUSH_CHANS_GET);
-      if (packets_to_flush) {
-        VLOG(2) << left->address << " skipping " << packets_to_flush
-                << " packets";
-        left->audio_stats.packet_flush_count += packets_to_flush;
-        left->audio_stats.frame_flush_count++;
-        hearingDevices.StartRssiLog();
-      }
-      // flush all packets stuck in queue
-      L2CA_FlushChannel(cid, 0xffff);
-      check_and_do_rssi_read(left);
-    }
-
-    std::vector<uint8_t> encoded_data_right;
-    if (right) {
-      // TODO: instead of a magic number, we need to figure out the correct
-      // buffer size
-      encoded_data_right.resize(4000);
-      int encoded_size =
-          g722_encode(encoder_state_right, encoded_data_right.data(),
-                      (const int16_t*)chan_right.data(), chan_right.size());
       encoded_data_right.resize(encoded_size);
-
-      uint16_t cid = GAP_ConnGetL2CAPCid(right->gap_handle);
-      uint16_t packets_to_flush = L2CA_FlushChannel(cid, L2CAP_FLUSH_CHANS_GET);
-      if (packets_to_flush) {
-        VLOG(2) << right->address << " skipping " << packets_to_flush
-                << " packets";
-        right->audio_stats.packet_flush_count += packets_to_flush;
-        right->audio_stats.frame_flush_count++;
-        hearingDevices.StartRssiLog();
-      }
-      // flush all packets stuck in queue
-      L2CA_FlushChannel(cid, 0xffff);
-      check_and_do_rssi_read(right);
     }
 
     size_t encoded_data_size =
@@ -1252,23 +1225,36 @@ class HearingAidImpl : public HearingAid {
     uint16_t packet_size =
         CalcCompressedAudioPacketSize(codec_in_use, default_data_interval_ms);
 
+    uint64_t now_ms = bluetooth::common::time_get_os_boottime_ms();
     for (size_t i = 0; i < encoded_data_size; i += packet_size) {
       if (left) {
         left->audio_stats.packet_send_count++;
-        SendAudio(encoded_data_left.data() + i, packet_size, left);
+        EnqueueAudio(encoded_data_left.data() + i, packet_size, left, now_ms);
       }
       if (right) {
         right->audio_stats.packet_send_count++;
-        SendAudio(encoded_data_right.data() + i, packet_size, right);
+        EnqueueAudio(encoded_data_right.data() + i, packet_size, right,
+                     now_ms);
       }
       seq_counter++;
     }
     if (left) left->audio_stats.frame_send_count++;
     if (right) right->audio_stats.frame_send_count++;
+
+    // Both sides are served in the same pass, so that the packets with the
+    // same sequence number go out on the same round of connection events.
+    if (left) {
+      ScheduleAudio(left);
+      check_and_do_rssi_read(left);
+    }
+    if (right) {
+      ScheduleAudio(right);
+      check_and_do_rssi_read(right);
+    }
   }
 
-  void SendAudio(uint8_t* encoded_data, uint16_t packet_size,
-                 HearingDevice* hearingAid) {
+  void EnqueueAudio(const uint8_t* encoded_data, uint16_t packet_size,
+                    HearingDevice* hearingAid, uint64_t now_ms) {
     if (!hearingAid->playback_started || !hearingAid->command_acked) {
       VLOG(2) << __func__
               << ": Playback stalled, device=" << hearingAid->address
@@ -1277,19 +1263,94 @@ class HearingAidImpl : public HearingAid {
       return;
     }
 
-    BT_HDR* audio_packet = malloc_l2cap_buf(packet_size + 1);
+    AudioPacket packet;
+    packet.data.reserve(packet_size + 1);
+    packet.data.push_back(seq_counter);
+    packet.data.insert(packet.data.end(), encoded_data,
+                       encoded_data + packet_size);
+    packet.encoded_ms = now_ms;
+    hearingAid->audio_queue.push_back(std::move(packet));
+  }
+
+  // Accounts for the packets that left the L2CAP queue of |device| since the
+  // last call, and returns the number of packets still in it.
+  uint16_t UpdateL2capQueue(HearingDevice* device, uint16_t cid,
+                            uint64_t now_ms) {
+    uint16_t queued = L2CA_FlushChannel(cid, L2CAP_FLUSH_CHANS_GET);
+    while (device->l2cap_queue_encoded_ms.size() > queued) {
+      device->audio_stats.AddLatency(now_ms -
+                                     device->l2cap_queue_encoded_ms.front());
+      device->l2cap_queue_encoded_ms.pop_front();
+    }
+    return queued;
+  }
+
+  // Hands the queued audio of |device| to L2CAP as fast as the link drains it.
+  // Besides each audio tick, this runs whenever L2CAP reports progress: the
+  // credits returned by the peer and the completed transmissions both arrive
+  // on its connection events, so the next packet is ready for the next event
+  // instead of waiting a whole data interval. Audio older than
+  // max_packet_age_ms is dropped, wherever it waits.
+  void ScheduleAudio(HearingDevice* device) {
+    if (!device->gap_handle) return;
+
+    uint64_t now_ms = bluetooth::common::time_get_os_boottime_ms();
+    uint16_t cid = GAP_ConnGetL2CAPCid(device->gap_handle);
+    uint16_t queued = UpdateL2capQueue(device, cid, now_ms);
+
+    if (queued && (device->l2cap_queue_encoded_ms.empty() ||
+                   now_ms - device->l2cap_queue_encoded_ms.front() >
+                       max_packet_age_ms)) {
+      VLOG(2) << device->address << " skipping " << queued << " packets";
+      device->audio_stats.packet_flush_count += queued;
+      device->audio_stats.frame_flush_count++;
+      hearingDevices.StartRssiLog();
+      // flush all packets stuck in queue
+      L2CA_FlushChannel(cid, 0xffff);
+      device->l2cap_queue_encoded_ms.clear();
+      queued = 0;
+    }
+
+    while (!device->audio_queue.empty() &&
+           now_ms - device->audio_queue.front().encoded_ms >
+               max_packet_age_ms) {
+      device->audio_stats.packet_stale_count++;
+      device->audio_queue.pop_front();
+    }
+
+    while (!device->congested && queued < MAX_L2CAP_QUEUED_PACKETS &&
+           !device->audio_queue.empty()) {
+      AudioPacket& packet = device->audio_queue.front();
+      if (SendAudio(packet.data, device)) {
+        device->l2cap_queue_encoded_ms.push_back(packet.encoded_ms);
+      }
+      device->audio_queue.pop_front();
+      queued = UpdateL2capQueue(device, cid, now_ms);
+    }
+  }
+
+  void ClearAudioQueue(HearingDevice* device) {
+    device->audio_queue.clear();
+    device->l2cap_queue_encoded_ms.clear();
+    device->congested = false;
+  }
+
+  bool SendAudio(const std::vector<uint8_t>& packet,
+                 HearingDevice* hearingAid) {
+    BT_HDR* audio_packet = malloc_l2cap_buf(packet.size());
     uint8_t* p = get_l2cap_sdu_start_ptr(audio_packet);
-    *p = seq_counter;
-    p++;
-    memcpy(p, encoded_data, packet_size);
+    memcpy(p, packet.data(), packet.size());
 
-    DVLOG(2) << hearingAid->address << " : " << base::HexEncode(p, packet_size);
+    DVLOG(2) << hearingAid->address << " : "
+             << base::HexEncode(p + 1, packet.size() - 1);
 
     uint16_t result = GAP_ConnWriteData(hearingAid->gap_handle, audio_packet);
 
     if (result != BT_PASS) {
       LOG(ERROR) << " Error sending data: " << loghex(result);
+      return false;
     }
+    return true;
   }
 
   void GapCallback(uint16_t gap_handle, uint16_t event, tGAP_CB_DATA* data) {
@@ -1318,6 +1379,7 @@ class HearingAidImpl : public HearingAid {
         hearingDevice->gap_handle = 0;
         hearingDevice->playback_started = false;
         hearingDevice->command_acked = false;
+        ClearAudioQueue(hearingDevice);
         break;
       case GAP_EVT_CONN_DATA_AVAIL: {
         DVLOG(2) << "GAP_EVT_CONN_DATA_AVAIL";
@@ -1352,19 +1414,17 @@ class HearingAidImpl : public HearingAid {
 
       case GAP_EVT_TX_EMPTY:
         DVLOG(2) << "GAP_EVT_TX_EMPTY";
+        ScheduleAudio(hearingDevice);
         break;
       case GAP_EVT_CONN_CONGESTED:
         DVLOG(2) << "GAP_EVT_CONN_CONGESTED";
-
-        // TODO: make it into function
-        HearingAidAudioSource::Stop();
-        // TODO: kill the encoder only if all hearing aids are down.
-        // g722_encode_release(encoder_state);
-        // encoder_state_left = nulllptr;
-        // encoder_state_right = nulllptr;
+        // The audio waits here until the peer catches up, and ages out
+        hearingDevice->congested = true;
         break;
       case GAP_EVT_CONN_UNCONGESTED:
         DVLOG(2) << "GAP_EVT_CONN_UNCONGESTED";
+        hearingDevice->congested = false;
+        ScheduleAudio(hearingDevice);
         break;
 
       case GAP_EVT_LE_COC_CREDITS: {
@@ -1372,6 +1432,7 @@ class HearingAidImpl : public HearingAid {
         DVLOG(2) << "GAP_EVT_LE_COC_CREDITS, for device: "
                  << hearingDevice->address << " added" << tmp.credits_received
                  << " credit_count: " << tmp.credit_count;
+        ScheduleAudio(hearingDevice);
         break;
       }
     }
@@ -1432,7 +1493,17 @@ class HearingAidImpl : public HearingAid {
           << device.audio_stats.packet_flush_count
           << "\n    Frame counts (enqueued/flushed)                         : "
           << device.audio_stats.frame_send_count << " / "
-          << device.audio_stats.frame_flush_count << std::endl;
+          << device.audio_stats.frame_flush_count
+          << "\n    Packets dropped as stale / max latency (ms)             : "
+          << device.audio_stats.packet_stale_count << " / "
+          << device.audio_stats.latency_max_ms << "\n    Packet latency (ms):";
+      for (size_t i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+        stream << " " << (i == LATENCY_HISTOGRAM_BUCKETS - 1 ? ">=" : "<")
+               << (i + (i != LATENCY_HISTOGRAM_BUCKETS - 1)) *
+                      LATENCY_HISTOGRAM_BUCKET_MS
+               << ": " << device.audio_stats.latency_histogram[i];
+      }
+      stream << std::endl;
 
       DumpRssi(fd, device);
     }
@@ -1547,6 +1618,7 @@ class HearingAidImpl : public HearingAid {
               << ", playback_started=" << hearingDevice->playback_started;
     hearingDevice->playback_started = false;
     hearingDevice->command_acked = false;
+    ClearAudioQueue(hearingDevice);
   }
 
   void DoDisconnectAudioStop() {
@@ -1591,6 +1663,7 @@ class HearingAidImpl : public HearingAid {
   uint8_t codec_in_use;
 
   uint16_t default_data_interval_ms;
+  uint16_t max_packet_age_ms;
 
   HearingDevices hearingDevices;
 
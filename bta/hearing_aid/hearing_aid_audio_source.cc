@@ -65,14 +65,16 @@ void send_audio_data() {
       (num_channels * sample_rate * data_interval_ms * (bit_rate / 8)) / 1000;
 
   uint16_t event;
-  uint8_t p_buf[bytes_per_tick];
+  // Read in place, the encoders of both sides work on this buffer
+  std::vector<uint8_t> data(bytes_per_tick);
 
   uint32_t bytes_read;
   if (bluetooth::audio::hearing_aid::is_hal_2_0_enabled()) {
-    bytes_read = bluetooth::audio::hearing_aid::read(p_buf, bytes_per_tick);
+    bytes_read =
+        bluetooth::audio::hearing_aid::read(data.data(), bytes_per_tick);
   } else {
     bytes_read = UIPC_Read(*uipc_hearing_aid, UIPC_CH_ID_AV_AUDIO, &event,
-                           p_buf, bytes_per_tick);
+                           data.data(), bytes_per_tick);
   }
 
   VLOG(2) << "bytes_read: " << bytes_read;
@@ -83,7 +85,7 @@ void send_audio_data() {
         bluetooth::common::time_get_os_boottime_us();
   }
 
-  std::vector<uint8_t> data(p_buf, p_buf + bytes_read);
+  data.resize(bytes_read);
 
   if (localAudioReceiver != nullptr) {
     localAudioReceiver->OnAudioDataReady(data);
@@ -102,7 +104,7 @@ void start_audio_ticks() {
     LOG(FATAL) << " Unsupported data interval: " << data_interval_ms;
   }
 
-  wakelock_acquire();
+  wakelock_acquire_for(WAKELOCK_REASON_HEARING_AID);
   audio_timer.SchedulePeriodic(
       get_main_thread()->GetWeakPtr(), FROM_HERE, base::Bind(&send_audio_data),
       base::TimeDelta::FromMilliseconds(data_interval_ms));
@@ -112,7 +114,7 @@ void start_audio_ticks() {
 void stop_audio_ticks() {
   LOG(INFO) << __func__ << ": stopped";
   audio_timer.CancelAndWait();
-  wakelock_release();
+  wakelock_release_for(WAKELOCK_REASON_HEARING_AID);
 }
 
 void hearing_aid_data_cb(tUIPC_CH_ID, tUIPC_EVENT event) {
@@ -23,6 +23,7 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "bta_at_lexer.h"
 #include "bta_hf_client_api.h"
 #include "bta_hf_client_int.h"
 #include "osi/include/log.h"
@@ -833,15 +834,12 @@ static char* bta_hf_client_parse_uint32(
     tBTA_HF_CLIENT_CB* client_cb, char* buffer,
     void (*handler_callback)(tBTA_HF_CLIENT_CB*, uint32_t)) {
   uint32_t value;
-  int res;
-  int offset;
-
-  res = sscanf(buffer, "%u%n", &value, &offset);
-  if (res < 1) {
+  char* end = (char*)AtParseUint32(buffer, &value);
+  if (end == NULL) {
     return NULL;
   }
 
-  buffer += offset;
+  buffer = end;
 
   AT_CHECK_RN(buffer);
 
@@ -1487,25 +1485,73 @@ static char* bta_hf_client_process_unknown(tBTA_HF_CLIENT_CB* client_cb,
  */
 typedef char* (*tBTA_HF_CLIENT_PARSER_CALLBACK)(tBTA_HF_CLIENT_CB*, char*);
 
-static const tBTA_HF_CLIENT_PARSER_CALLBACK bta_hf_client_parser_cb[] = {
-    bta_hf_client_parse_ok,          bta_hf_client_parse_error,
-    bta_hf_client_parse_ring,        bta_hf_client_parse_brsf,
-    bta_hf_client_parse_cind,        bta_hf_client_parse_ciev,
-    bta_hf_client_parse_chld,        bta_hf_client_parse_bcs,
-    bta_hf_client_parse_bsir,        bta_hf_client_parse_cmeerror,
-    bta_hf_client_parse_vgm,         bta_hf_client_parse_vgme,
-    bta_hf_client_parse_vgs,         bta_hf_client_parse_vgse,
-    bta_hf_client_parse_bvra,        bta_hf_client_parse_clip,
-    bta_hf_client_parse_ccwa,        bta_hf_client_parse_cops,
-    bta_hf_client_parse_binp,        bta_hf_client_parse_clcc,
-    bta_hf_client_parse_cnum,        bta_hf_client_parse_btrh,
-    bta_hf_client_parse_busy,        bta_hf_client_parse_delayed,
-    bta_hf_client_parse_no_carrier,  bta_hf_client_parse_no_answer,
-    bta_hf_client_parse_blacklisted, bta_hf_client_process_unknown};
+/* event name, following <cr><lf>, and its parser */
+typedef struct {
+  const char* event;
+  tBTA_HF_CLIENT_PARSER_CALLBACK parser;
+} tBTA_HF_CLIENT_PARSER;
+
+static const tBTA_HF_CLIENT_PARSER bta_hf_client_parser[] = {
+    {"OK", bta_hf_client_parse_ok},
+    {"ERROR", bta_hf_client_parse_error},
+    {"RING", bta_hf_client_parse_ring},
+    {"+BRSF:", bta_hf_client_parse_brsf},
+    {"+CIND:", bta_hf_client_parse_cind},
+    {"+CIEV:", bta_hf_client_parse_ciev},
+    {"+CHLD:", bta_hf_client_parse_chld},
+    {"+BCS:", bta_hf_client_parse_bcs},
+    {"+BSIR:", bta_hf_client_parse_bsir},
+    {"+CME ERROR:", bta_hf_client_parse_cmeerror},
+    {"+VGM:", bta_hf_client_parse_vgm},
+    {"+VGM=", bta_hf_client_parse_vgme},
+    {"+VGS:", bta_hf_client_parse_vgs},
+    {"+VGS=", bta_hf_client_parse_vgse},
+    {"+BVRA:", bta_hf_client_parse_bvra},
+    {"+CLIP:", bta_hf_client_parse_clip},
+    {"+CCWA:", bta_hf_client_parse_ccwa},
+    {"+COPS:", bta_hf_client_parse_cops},
+    {"+BINP:", bta_hf_client_parse_binp},
+    {"+CLCC:", bta_hf_client_parse_clcc},
+    {"+CNUM:", bta_hf_client_parse_cnum},
+    {"+BTRH:", bta_hf_client_parse_btrh},
+    {"BUSY", bta_hf_client_parse_busy},
+    {"DELAYED", bta_hf_client_parse_delayed},
+    {"NO CARRIER", bta_hf_client_parse_no_carrier},
+    {"NO ANSWER", bta_hf_client_parse_no_answer},
+    {"BLACKLISTED", bta_hf_client_parse_blacklisted}};
 
 /* calculate supported event list length */
-static const uint16_t bta_hf_client_parser_cb_count =
-    sizeof(bta_hf_client_parser_cb) / sizeof(bta_hf_client_parser_cb[0]);
+static const uint16_t bta_hf_client_parser_count =
+    sizeof(bta_hf_client_parser) / sizeof(bta_hf_client_parser[0]);
+
+/* find the parser of the event at buf, the unknown event parser if none */
+static tBTA_HF_CLIENT_PARSER_CALLBACK bta_hf_client_find_parser(
+    const char* buf, size_t len) {
+  static const AtNameTrie trie = [] {
+    AtNameTrie events;
+    for (int i = 0; i < bta_hf_client_parser_count; i++) {
+      events.Add(bta_hf_client_parser[i].event, i);
+    }
+    return events;
+  }();
+
+  if (len < 2 || buf[0] != '\r' || buf[1] != '\n') {
+    return bta_hf_client_process_unknown;
+  }
+
+  size_t event_len;
+  int i = trie.Match(buf + 2, len - 2, &event_len);
+  if (i == AtNameTrie::kNoMatch) {
+    return bta_hf_client_process_unknown;
+  }
+  return bta_hf_client_parser[i].parser;
+}
+
+/* the name of the idx-th event the parser knows of, nullptr past the last */
+const char* bta_hf_client_at_event_name(size_t idx) {
+  if (idx >= bta_hf_client_parser_count) return nullptr;
+  return bta_hf_client_parser[idx].event;
+}
 
 #ifdef BTA_HF_CLIENT_AT_DUMP
 static void bta_hf_client_dump_at(tBTA_HF_CLIENT_CB* client_cb) {
@@ -1545,23 +1591,18 @@ static void bta_hf_client_at_parse_start(tBTA_HF_CLIENT_CB* client_cb) {
 #endif
 
   while (*buf != '\0') {
-    int i;
-    char* tmp = NULL;
-
-    for (i = 0; i < bta_hf_client_parser_cb_count; i++) {
-      tmp = bta_hf_client_parser_cb[i](client_cb, buf);
-      if (tmp == NULL) {
-        APPL_TRACE_ERROR("HFPCient: AT event/reply parsing failed, skipping");
-        tmp = bta_hf_client_skip_unknown(client_cb, buf);
-        break;
-      }
+    char* end = client_cb->at_cb.buf + client_cb->at_cb.offset;
+    size_t len = buf < end ? end - buf : 0;
+    char* tmp = bta_hf_client_find_parser(buf, len)(client_cb, buf);
 
-      /* matched or unknown skipped, if unknown failed tmp is NULL so
-         this is also handled */
-      if (tmp != buf) {
-        buf = tmp;
-        break;
-      }
+    /* not the event its name looked like */
+    if (tmp == buf) {
+      tmp = bta_hf_client_process_unknown(client_cb, buf);
+    }
+
+    if (tmp == NULL) {
+      APPL_TRACE_ERROR("HFPCient: AT event/reply parsing failed, skipping");
+      tmp = bta_hf_client_skip_unknown(client_cb, buf);
     }
 
     /* could not skip unknown (received garbage?)... disconnect */
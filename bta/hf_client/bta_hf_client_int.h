@@ -262,6 +262,7 @@ extern void bta_hf_client_cback_sco(tBTA_HF_CLIENT_CB* client_cb,
 /* AT command functions */
 extern void bta_hf_client_at_parse(tBTA_HF_CLIENT_CB* client_cb, char* buf,
                                    unsigned int len);
+extern const char* bta_hf_client_at_event_name(size_t idx);
 extern void bta_hf_client_send_at_brsf(tBTA_HF_CLIENT_CB* client_cb,
                                        tBTA_HF_CLIENT_FEAT features);
 extern void bta_hf_client_send_at_bac(tBTA_HF_CLIENT_CB* client_cb);
@@ -187,10 +187,41 @@ typedef struct {
 #define BTA_HH_LE_RPT_MAX 20
 #endif
 
+#define BTA_HH_LE_RPT_ID_MAX 256
+
+/* maps the value handle of a report characteristic to its report entry, so
+ * that notifications don't need a GATT cache lookup */
+typedef struct {
+  uint16_t handle;
+  uint8_t rpt_idx; /* index in tBTA_HH_LE_HID_SRVC.report */
+} tBTA_HH_LE_RPT_HANDLE;
+
+/* input report latency histogram, from the reception of the HCI packet to
+ * the write to uhid: bucket i counts latencies below (125 << i) us, the last
+ * bucket counts the rest */
+#define BTA_HH_LE_LATENCY_BUCKETS 8
+#define BTA_HH_LE_LATENCY_MIN_US 125
+
+typedef struct {
+  uint32_t bucket[BTA_HH_LE_LATENCY_BUCKETS];
+  uint32_t count;
+  uint64_t total_us;
+  uint64_t max_us;
+} tBTA_HH_LE_LATENCY;
+
 typedef struct {
   bool in_use;
   uint8_t srvc_inst_id;
   tBTA_HH_LE_RPT report[BTA_HH_LE_RPT_MAX];
+  tBTA_HH_LE_RPT_HANDLE rpt_handle[BTA_HH_LE_RPT_MAX];
+  uint8_t num_rpt_handle;
+
+  /* report ID index of the report entries in protocol mode |rpt_index_mode|:
+   * index + 1 of the entry of each report type and ID, 0 when there is none.
+   * Rebuilt by the first lookup after a report entry changed. */
+  uint8_t rpt_index[BTA_HH_RPTT_FEATURE][BTA_HH_LE_RPT_ID_MAX];
+  bool rpt_index_valid;
+  tBTA_HH_PROTO_MODE rpt_index_mode;
 
   uint16_t proto_mode_handle;
   uint8_t control_point_handle;
@@ -257,6 +288,7 @@ typedef struct {
 #define BTA_HH_LE_SCPS_NOTIFY_SPT 0x01
 #define BTA_HH_LE_SCPS_NOTIFY_ENB 0x02
   uint8_t scps_notify; /* scan refresh supported/notification enabled */
+  tBTA_HH_LE_LATENCY rpt_latency;
 #endif
 
   bool security_pending;
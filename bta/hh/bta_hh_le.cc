@@ -35,6 +35,8 @@
 #include "btm_api.h"
 #include "btm_ble_api.h"
 #include "btm_int.h"
+#include "btu.h"
+#include "common/time_util.h"
 #include "device/include/interop.h"
 #include "osi/include/log.h"
 #include "srvc_api.h"
@@ -362,42 +364,80 @@ tBTA_HH_LE_RPT* bta_hh_le_find_report_entry(
   return NULL;
 }
 
+/*******************************************************************************
+ *
+ * Function         bta_hh_le_rpt_in_mode
+ *
+ * Description      check whether a report entry is used in a protocol mode
+ *
+ ******************************************************************************/
+static bool bta_hh_le_rpt_in_mode(const tBTA_HH_LE_RPT* p_rpt, uint8_t mode) {
+  /* battery report w/o condition */
+  if (p_rpt->uuid == GATT_UUID_BATTERY_LEVEL) return true;
+
+  if (mode == BTA_HH_PROTO_RPT_MODE && p_rpt->uuid == GATT_UUID_HID_REPORT)
+    return true;
+
+  return mode == BTA_HH_PROTO_BOOT_MODE &&
+         (p_rpt->uuid >= GATT_UUID_HID_BT_KB_INPUT &&
+          p_rpt->uuid <= GATT_UUID_HID_BT_MOUSE_INPUT);
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_hh_le_build_rpt_index
+ *
+ * Description      build the report ID index of the report entries for a
+ *                  protocol mode. The first matching entry wins, as with a
+ *                  search of the report list.
+ *
+ ******************************************************************************/
+static void bta_hh_le_build_rpt_index(tBTA_HH_LE_HID_SRVC* p_srvc,
+                                      uint8_t mode) {
+  memset(p_srvc->rpt_index, 0, sizeof(p_srvc->rpt_index));
+
+  const tBTA_HH_LE_RPT* p_rpt = &p_srvc->report[0];
+  for (uint8_t i = 0; i < BTA_HH_LE_RPT_MAX; i++, p_rpt++) {
+    if (!p_rpt->in_use || p_rpt->rpt_type == BTA_HH_RPTT_RESRV ||
+        p_rpt->rpt_type > BTA_HH_RPTT_FEATURE ||
+        !bta_hh_le_rpt_in_mode(p_rpt, mode))
+      continue;
+
+    uint8_t* p_idx = &p_srvc->rpt_index[p_rpt->rpt_type - 1][p_rpt->rpt_id];
+    if (*p_idx == 0) *p_idx = i + 1;
+  }
+
+  p_srvc->rpt_index_mode = mode;
+  p_srvc->rpt_index_valid = true;
+}
+
 /*******************************************************************************
  *
  * Function         bta_hh_le_find_rpt_by_idtype
  *
  * Description      find a report entry by report ID and protocol mode
  *
- * Returns          void
+ * Returns          the report entry, or NULL if there is none.
  *
  ******************************************************************************/
-tBTA_HH_LE_RPT* bta_hh_le_find_rpt_by_idtype(tBTA_HH_LE_RPT* p_head,
+tBTA_HH_LE_RPT* bta_hh_le_find_rpt_by_idtype(tBTA_HH_DEV_CB* p_cb,
                                              uint8_t mode,
                                              tBTA_HH_RPT_TYPE r_type,
                                              uint8_t rpt_id) {
-  tBTA_HH_LE_RPT* p_rpt = p_head;
-  uint8_t i;
+  tBTA_HH_LE_HID_SRVC* p_srvc = &p_cb->hid_srvc;
 
 #if (BTA_HH_DEBUG == TRUE)
   APPL_TRACE_DEBUG("bta_hh_le_find_rpt_by_idtype: r_type: %d rpt_id: %d",
                    r_type, rpt_id);
 #endif
 
-  for (i = 0; i < BTA_HH_LE_RPT_MAX; i++, p_rpt++) {
-    if (p_rpt->in_use && p_rpt->rpt_id == rpt_id && r_type == p_rpt->rpt_type) {
-      /* return battery report w/o condition */
-      if (p_rpt->uuid == GATT_UUID_BATTERY_LEVEL) return p_rpt;
+  if (r_type == BTA_HH_RPTT_RESRV || r_type > BTA_HH_RPTT_FEATURE) return NULL;
 
-      if (mode == BTA_HH_PROTO_RPT_MODE && p_rpt->uuid == GATT_UUID_HID_REPORT)
-        return p_rpt;
+  if (!p_srvc->rpt_index_valid || p_srvc->rpt_index_mode != mode)
+    bta_hh_le_build_rpt_index(p_srvc, mode);
 
-      if (mode == BTA_HH_PROTO_BOOT_MODE &&
-          (p_rpt->uuid >= GATT_UUID_HID_BT_KB_INPUT &&
-           p_rpt->uuid <= GATT_UUID_HID_BT_MOUSE_INPUT))
-        return p_rpt;
-    }
-  }
-  return NULL;
+  uint8_t idx = p_srvc->rpt_index[r_type - 1][rpt_id];
+  return idx == 0 ? NULL : &p_srvc->report[idx - 1];
 }
 
 /*******************************************************************************
@@ -428,6 +468,7 @@ tBTA_HH_LE_RPT* bta_hh_le_find_alloc_report_entry(tBTA_HH_DEV_CB* p_cb,
         (p_rpt->uuid == rpt_uuid && p_rpt->srvc_inst_id == srvc_inst_id &&
          p_rpt->char_inst_id == inst_id)) {
       if (!p_rpt->in_use) {
+        p_cb->hid_srvc.rpt_index_valid = false;
         p_rpt->in_use = true;
         p_rpt->index = i;
         p_rpt->srvc_inst_id = srvc_inst_id;
@@ -456,6 +497,63 @@ tBTA_HH_LE_RPT* bta_hh_le_find_alloc_report_entry(tBTA_HH_DEV_CB* p_cb,
   return NULL;
 }
 
+/*******************************************************************************
+ *
+ * Function         bta_hh_le_map_rpt_handle
+ *
+ * Description      add the value handle of a report characteristic to the
+ *                  handle map used by notifications.
+ *
+ ******************************************************************************/
+static void bta_hh_le_map_rpt_handle(tBTA_HH_DEV_CB* p_cb, uint16_t handle,
+                                     tBTA_HH_LE_RPT* p_rpt) {
+  tBTA_HH_LE_HID_SRVC* p_srvc = &p_cb->hid_srvc;
+  tBTA_HH_LE_RPT_HANDLE* p_map = &p_srvc->rpt_handle[0];
+  uint8_t i;
+
+  for (i = 0; i < p_srvc->num_rpt_handle; i++, p_map++) {
+    if (p_map->handle == handle) break;
+  }
+  if (i == BTA_HH_LE_RPT_MAX) return;
+  if (i == p_srvc->num_rpt_handle) p_srvc->num_rpt_handle++;
+
+  p_map->handle = handle;
+  p_map->rpt_idx = p_rpt->index;
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_hh_le_find_rpt_by_handle
+ *
+ * Description      find the report entry of a characteristic value handle in
+ *                  the handle map, and the application ID of the report.
+ *
+ * Returns          the report entry, or NULL if the handle isn't mapped.
+ *
+ ******************************************************************************/
+static tBTA_HH_LE_RPT* bta_hh_le_find_rpt_by_handle(tBTA_HH_DEV_CB* p_cb,
+                                                    uint16_t handle,
+                                                    uint8_t* p_app_id) {
+  tBTA_HH_LE_HID_SRVC* p_srvc = &p_cb->hid_srvc;
+  const tBTA_HH_LE_RPT_HANDLE* p_map = &p_srvc->rpt_handle[0];
+
+  for (uint8_t i = 0; i < p_srvc->num_rpt_handle; i++, p_map++) {
+    if (p_map->handle == handle) {
+      tBTA_HH_LE_RPT* p_rpt = &p_srvc->report[p_map->rpt_idx];
+      if (!p_rpt->in_use) return NULL;
+
+      if (p_rpt->uuid == GATT_UUID_HID_BT_MOUSE_INPUT)
+        *p_app_id = BTA_HH_APP_ID_MI;
+      else if (p_rpt->uuid == GATT_UUID_HID_BT_KB_INPUT)
+        *p_app_id = BTA_HH_APP_ID_KB;
+      else
+        *p_app_id = p_cb->app_id;
+      return p_rpt;
+    }
+  }
+  return NULL;
+}
+
 static const gatt::Descriptor* find_descriptor_by_short_uuid(
     uint16_t conn_id, uint16_t char_handle, uint16_t short_uuid) {
   const gatt::Characteristic* p_char =
@@ -466,8 +564,9 @@ static const gatt::Descriptor* find_descriptor_by_short_uuid(
     return NULL;
   }
 
+  const Uuid uuid = Uuid::From16Bit(short_uuid);
   for (const gatt::Descriptor& desc : p_char->descriptors) {
-    if (desc.uuid == Uuid::From16Bit(short_uuid)) return &desc;
+    if (desc.uuid == uuid) return &desc;
   }
 
   return NULL;
@@ -522,6 +621,7 @@ void bta_hh_le_save_report_ref(tBTA_HH_DEV_CB* p_dev_cb, tBTA_HH_LE_RPT* p_rpt,
 
     if (p_rpt->rpt_type > BTA_HH_RPTT_FEATURE) /* invalid report type */
       p_rpt->rpt_type = BTA_HH_RPTT_RESRV;
+    p_dev_cb->hid_srvc.rpt_index_valid = false;
 
 #if (BTA_HH_DEBUG == TRUE)
     APPL_TRACE_DEBUG("%s: report ID: %d", __func__, p_rpt->rpt_id);
@@ -1152,6 +1252,7 @@ void bta_hh_gatt_open(tBTA_HH_DEV_CB* p_cb, tBTA_HH_DATA* p_buf) {
     p_cb->is_le_device = true;
     p_cb->in_use = true;
     p_cb->conn_id = p_data->conn_id;
+    memset(&p_cb->rpt_latency, 0, sizeof(p_cb->rpt_latency));
 
     bta_hh_cb.le_cb_index[BTA_HH_GET_LE_CB_IDX(p_cb->hid_handle)] = p_cb->index;
 
@@ -1434,6 +1535,7 @@ static void bta_hh_le_search_hid_chars(tBTA_HH_DEV_CB* p_dev_cb,
 
         if (p_rpt->rpt_type != BTA_HH_RPTT_INPUT) break;
 
+        bta_hh_le_map_rpt_handle(p_dev_cb, charac.value_handle, p_rpt);
         bta_hh_le_read_char_descriptor(p_dev_cb, charac.value_handle,
                                        GATT_UUID_RPT_REF_DESCR,
                                        read_report_ref_desc_cb, p_dev_cb);
@@ -1443,10 +1545,15 @@ static void bta_hh_le_search_hid_chars(tBTA_HH_DEV_CB* p_dev_cb,
       case GATT_UUID_HID_BT_KB_OUTPUT:
       case GATT_UUID_HID_BT_MOUSE_INPUT:
       case GATT_UUID_HID_BT_KB_INPUT:
-        if (bta_hh_le_find_alloc_report_entry(p_dev_cb, service->handle, uuid16,
-                                              charac.value_handle) == NULL)
+        p_rpt = bta_hh_le_find_alloc_report_entry(
+            p_dev_cb, service->handle, uuid16, charac.value_handle);
+        if (p_rpt == NULL) {
           APPL_TRACE_ERROR("%s: Add report entry failed !!!", __func__);
+          break;
+        }
 
+        if (p_rpt->rpt_type == BTA_HH_RPTT_INPUT)
+          bta_hh_le_map_rpt_handle(p_dev_cb, charac.value_handle, p_rpt);
         break;
 
       default:
@@ -1541,38 +1648,53 @@ void bta_hh_le_srvc_search_cmpl(tBTA_GATTC_SEARCH_CMPL* p_data) {
 
 /*******************************************************************************
  *
- * Function         bta_hh_le_input_rpt_notify
+ * Function         bta_hh_le_record_latency
  *
- * Description      process the notificaton event, most likely for input report.
+ * Description      add the time elapsed since the reception of the HCI packet
+ *                  carrying an input report to the latency histogram.
  *
- * Parameters:
+ ******************************************************************************/
+static void bta_hh_le_record_latency(tBTA_HH_DEV_CB* p_dev_cb) {
+  uint64_t rx_timestamp_us = btu_get_rx_timestamp_us();
+  if (rx_timestamp_us == 0) return;
+
+  uint64_t latency_us =
+      bluetooth::common::time_get_os_boottime_us() - rx_timestamp_us;
+  tBTA_HH_LE_LATENCY* p_latency = &p_dev_cb->rpt_latency;
+  uint8_t i = 0;
+
+  while (i < BTA_HH_LE_LATENCY_BUCKETS - 1 &&
+         latency_us >= ((uint64_t)BTA_HH_LE_LATENCY_MIN_US << i))
+    i++;
+  p_latency->bucket[i]++;
+  p_latency->count++;
+  p_latency->total_us += latency_us;
+  if (latency_us > p_latency->max_us) p_latency->max_us = latency_us;
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_hh_le_lookup_rpt
+ *
+ * Description      find the report entry of a notification through the GATT
+ *                  cache, and add it to the handle map.
  *
  ******************************************************************************/
-void bta_hh_le_input_rpt_notify(tBTA_GATTC_NOTIFY* p_data) {
-  tBTA_HH_DEV_CB* p_dev_cb = bta_hh_le_find_dev_cb_by_conn_id(p_data->conn_id);
-  uint8_t app_id;
-  uint8_t* p_buf;
+static tBTA_HH_LE_RPT* bta_hh_le_lookup_rpt(tBTA_HH_DEV_CB* p_dev_cb,
+                                            uint16_t handle,
+                                            uint8_t* p_app_id) {
   tBTA_HH_LE_RPT* p_rpt;
 
-  if (p_dev_cb == NULL) {
-    APPL_TRACE_ERROR(
-        "%s: notification received from Unknown device, conn_id: 0x%04x",
-        __func__, p_data->conn_id);
-    return;
-  }
-
   const gatt::Characteristic* p_char =
-      BTA_GATTC_GetCharacteristic(p_dev_cb->conn_id, p_data->handle);
+      BTA_GATTC_GetCharacteristic(p_dev_cb->conn_id, handle);
   if (p_char == NULL) {
     APPL_TRACE_ERROR(
         "%s: notification received for Unknown Characteristic, conn_id: "
         "0x%04x, handle: 0x%04x",
-        __func__, p_dev_cb->conn_id, p_data->handle);
-    return;
+        __func__, p_dev_cb->conn_id, handle);
+    return NULL;
   }
 
-  app_id = p_dev_cb->app_id;
-
   const gatt::Service* p_svc =
       BTA_GATTC_GetOwningService(p_dev_cb->conn_id, p_char->value_handle);
 
@@ -1583,19 +1705,49 @@ void bta_hh_le_input_rpt_notify(tBTA_GATTC_NOTIFY* p_data) {
         "%s: notification received for Unknown Report, uuid: %s, handle: "
         "0x%04x",
         __func__, p_char->uuid.ToString().c_str(), p_char->value_handle);
+    return NULL;
+  }
+
+  bta_hh_le_map_rpt_handle(p_dev_cb, handle, p_rpt);
+  return bta_hh_le_find_rpt_by_handle(p_dev_cb, handle, p_app_id);
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_hh_le_input_rpt_notify
+ *
+ * Description      process the notificaton event, most likely for input report.
+ *                  The report is written to uhid from the GATT callback, the
+ *                  report entry is found through the handle map.
+ *
+ * Parameters:
+ *
+ ******************************************************************************/
+void bta_hh_le_input_rpt_notify(tBTA_GATTC_NOTIFY* p_data) {
+  tBTA_HH_DEV_CB* p_dev_cb = bta_hh_le_find_dev_cb_by_conn_id(p_data->conn_id);
+  uint8_t app_id;
+  uint8_t* p_buf;
+  tBTA_HH_LE_RPT* p_rpt;
+  uint8_t rpt_buf[GATT_MAX_ATTR_LEN + 1];
+
+  if (p_dev_cb == NULL) {
+    APPL_TRACE_ERROR(
+        "%s: notification received from Unknown device, conn_id: 0x%04x",
+        __func__, p_data->conn_id);
     return;
   }
 
-  if (p_char->uuid == Uuid::From16Bit(GATT_UUID_HID_BT_MOUSE_INPUT))
-    app_id = BTA_HH_APP_ID_MI;
-  else if (p_char->uuid == Uuid::From16Bit(GATT_UUID_HID_BT_KB_INPUT))
-    app_id = BTA_HH_APP_ID_KB;
+  p_rpt = bta_hh_le_find_rpt_by_handle(p_dev_cb, p_data->handle, &app_id);
+  if (p_rpt == NULL) {
+    p_rpt = bta_hh_le_lookup_rpt(p_dev_cb, p_data->handle, &app_id);
+    if (p_rpt == NULL) return;
+  }
 
   APPL_TRACE_DEBUG("Notification received on report ID: %d", p_rpt->rpt_id);
 
   /* need to append report ID to the head of data */
   if (p_rpt->rpt_id != 0) {
-    p_buf = (uint8_t*)osi_malloc(p_data->len + 1);
+    p_buf = rpt_buf;
 
     p_buf[0] = p_rpt->rpt_id;
     memcpy(&p_buf[1], p_data->value, p_data->len);
@@ -1608,7 +1760,7 @@ void bta_hh_le_input_rpt_notify(tBTA_GATTC_NOTIFY* p_data) {
                  p_dev_cb->mode, 0, /* no sub class*/
                  p_dev_cb->dscp_info.ctry_code, p_dev_cb->addr, app_id);
 
-  if (p_buf != p_data->value) osi_free(p_buf);
+  bta_hh_le_record_latency(p_dev_cb);
 }
 
 /*******************************************************************************
@@ -1791,8 +1943,8 @@ static void read_report_cb(uint16_t conn_id, tGATT_STATUS status,
  ******************************************************************************/
 void bta_hh_le_get_rpt(tBTA_HH_DEV_CB* p_cb, tBTA_HH_RPT_TYPE r_type,
                        uint8_t rpt_id) {
-  tBTA_HH_LE_RPT* p_rpt = bta_hh_le_find_rpt_by_idtype(
-      p_cb->hid_srvc.report, p_cb->mode, r_type, rpt_id);
+  tBTA_HH_LE_RPT* p_rpt =
+      bta_hh_le_find_rpt_by_idtype(p_cb, p_cb->mode, r_type, rpt_id);
 
   if (p_rpt == NULL) {
     APPL_TRACE_ERROR("%s: no matching report", __func__);
@@ -1855,8 +2007,7 @@ void bta_hh_le_write_rpt(tBTA_HH_DEV_CB* p_cb, tBTA_HH_RPT_TYPE r_type,
   STREAM_TO_UINT8(rpt_id, vec_start);
   vector<uint8_t> value(vec_start, vec_start + p_buf->len - 1);
 
-  p_rpt = bta_hh_le_find_rpt_by_idtype(p_cb->hid_srvc.report, p_cb->mode,
-                                       r_type, rpt_id);
+  p_rpt = bta_hh_le_find_rpt_by_idtype(p_cb, p_cb->mode, r_type, rpt_id);
   if (p_rpt == NULL) {
     APPL_TRACE_ERROR("%s: no matching report", __func__);
     osi_free(p_buf);
@@ -2141,8 +2292,8 @@ void bta_hh_le_hid_read_rpt_clt_cfg(const RawAddress& bd_addr, uint8_t rpt_id) {
 
   p_cb = &bta_hh_cb.kdev[index];
 
-  p_rpt = bta_hh_le_find_rpt_by_idtype(p_cb->hid_srvc.report, p_cb->mode,
-                                       BTA_HH_RPTT_INPUT, rpt_id);
+  p_rpt = bta_hh_le_find_rpt_by_idtype(p_cb, p_cb->mode, BTA_HH_RPTT_INPUT,
+                                       rpt_id);
 
   if (p_rpt == NULL) {
     APPL_TRACE_ERROR("%s: no matching report", __func__);
@@ -2188,6 +2339,7 @@ static void bta_hh_process_cache_rpt(tBTA_HH_DEV_CB* p_cb,
       } else {
         p_rpt->rpt_type = p_rpt_cache->rpt_type;
         p_rpt->rpt_id = p_rpt_cache->rpt_id;
+        p_cb->hid_srvc.rpt_index_valid = false;
 
         if (p_rpt->uuid == GATT_UUID_HID_BT_KB_INPUT ||
             p_rpt->uuid == GATT_UUID_HID_BT_MOUSE_INPUT ||
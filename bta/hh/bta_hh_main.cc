@@ -26,6 +26,7 @@
 
 #if (BTA_HH_INCLUDED == TRUE)
 
+#include <stdio.h>
 #include <string.h>
 
 #include "bt_common.h"
@@ -420,6 +421,45 @@ bool bta_hh_hdl_event(BT_HDR* p_msg) {
   return (true);
 }
 
+/*******************************************************************************
+ *
+ * Function         bta_debug_hh_dump
+ *
+ * Description      Dump the input report statistics of the connected LE HID
+ *                  devices to |fd|.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void bta_debug_hh_dump(int fd) {
+#if (BTA_HH_LE_INCLUDED == TRUE)
+  dprintf(fd, "\nBTA HH LE Input Reports:\n");
+  for (int i = 0; i < BTA_HH_MAX_DEVICE; i++) {
+    const tBTA_HH_DEV_CB& cb = bta_hh_cb.kdev[i];
+    if (!cb.in_use || !cb.is_le_device) continue;
+
+    const tBTA_HH_LE_LATENCY& latency = cb.rpt_latency;
+    dprintf(fd, "  Device: %s handle: %d mapped reports: %d\n",
+            cb.addr.ToString().c_str(), cb.hid_handle,
+            cb.hid_srvc.num_rpt_handle);
+    dprintf(fd, "    Reports: %u average latency: %llu us max: %llu us\n",
+            latency.count,
+            (unsigned long long)(latency.count == 0
+                                     ? 0
+                                     : latency.total_us / latency.count),
+            (unsigned long long)latency.max_us);
+    dprintf(fd, "    Latency histogram (us):");
+    for (int b = 0; b < BTA_HH_LE_LATENCY_BUCKETS - 1; b++) {
+      dprintf(fd, " <%d: %u", BTA_HH_LE_LATENCY_MIN_US << b,
+              latency.bucket[b]);
+    }
+    dprintf(fd, " >=%d: %u\n",
+            BTA_HH_LE_LATENCY_MIN_US << (BTA_HH_LE_LATENCY_BUCKETS - 2),
+            latency.bucket[BTA_HH_LE_LATENCY_BUCKETS - 1]);
+  }
+#endif
+}
+
 /*****************************************************************************
  *  Debug Functions
  ****************************************************************************/
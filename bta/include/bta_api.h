@@ -727,6 +727,8 @@ typedef struct {
   uint16_t ble_periodic_adv_int;
   tBT_DEVICE_TYPE device_type;
   uint8_t flag;
+  tBTM_EIR_INFO eir_info;   /* decoded fields of |p_eir| */
+  tBTM_INQ_CHANGED changed; /* changes since the device was last reported */
 } tBTA_DM_INQ_RES;
 
 /* Structure associated with BTA_DM_INQ_CMPL_EVT */
@@ -721,6 +721,16 @@ void BTA_AvOffloadStartRsp(tBTA_AV_HNDL hndl, tBTA_AV_STATUS status);
  */
 int BTA_AvObtainPeerChannelIndex(const RawAddress& peer_address);
 
+/**
+ * Obtain the RTP timestamp of a media packet delivered with
+ * BTA_AV_SINK_MEDIA_DATA_EVT. It is stored in the headroom of the packet,
+ * just before the media payload.
+ *
+ * @param p_pkt the media packet
+ * @return the RTP timestamp of the packet
+ */
+uint32_t BTA_AvGetSinkMediaTimestamp(const BT_HDR* p_pkt);
+
 /**
  * Dump debug-related information for the BTA AV module.
  *
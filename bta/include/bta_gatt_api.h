@@ -911,6 +911,41 @@ extern void BTA_GATTS_HandleValueIndication(uint16_t conn_id, uint16_t attr_id,
 extern void BTA_GATTS_SendRsp(uint16_t conn_id, uint32_t trans_id,
                               tGATT_STATUS status, tGATTS_RSP* p_msg);
 
+/*******************************************************************************
+ *
+ * Function         BTA_GATTS_SetCachedValue
+ *
+ * Description      This function is called to have the stack answer the
+ *                  reads of a characteristic or descriptor with |value|,
+ *                  instead of sending read requests to the application. It
+ *                  is called again whenever the value changes.
+ *
+ * Parameters       server_if - server interface owning the attribute.
+ *                  attr_id - attribute ID.
+ *                  value - the attribute value.
+ *
+ * Returns          None
+ *
+ ******************************************************************************/
+extern void BTA_GATTS_SetCachedValue(tGATT_IF server_if, uint16_t attr_id,
+                                     std::vector<uint8_t> value);
+
+/*******************************************************************************
+ *
+ * Function         BTA_GATTS_InvalidateCachedValue
+ *
+ * Description      This function is called to send the reads of an attribute
+ *                  to the application again.
+ *
+ * Parameters       server_if - server interface owning the attribute.
+ *                  attr_id - attribute ID.
+ *
+ * Returns          None
+ *
+ ******************************************************************************/
+extern void BTA_GATTS_InvalidateCachedValue(tGATT_IF server_if,
+                                            uint16_t attr_id);
+
 /*******************************************************************************
  *
  * Function         BTA_GATTS_Open
@@ -16,9 +16,8 @@
 
 #include <vector>
 
-#include <list>
+#include <deque>
 #include <unordered_map>
-#include <unordered_set>
 #include "bta_gatt_api.h"
 
 /* BTA GATTC implementation does not allow for multiple commands queuing. So one
@@ -29,6 +28,9 @@
  * Methods below can be used as replacement to BTA_GATTC_* in BTA app. They do
  * queue the commands if another command is currently being executed.
  *
+ * Reads of the same attribute queued one after the other are served by a
+ * single ATT read, and each callback gets the value.
+ *
  * If you decide to use those methods in your app, make sure to not mix it with
  * existing BTA_GATTC_* API.
  */
@@ -62,6 +64,12 @@ class BtaGattQueue {
     std::vector<uint8_t> value;
   };
 
+  /* Holds the operations of one connection */
+  struct gatt_conn_queue {
+    std::deque<gatt_operation> ops;
+    bool executing = false;
+  };
+
  private:
   static void mark_as_not_executing(uint16_t conn_id);
   static void gatt_execute_next_op(uint16_t conn_id);
@@ -71,8 +79,7 @@ class BtaGattQueue {
   static void gatt_write_op_finished(uint16_t conn_id, tGATT_STATUS status,
                                      uint16_t handle, void* data);
 
-  // maps connection id to operations waiting for execution
-  static std::unordered_map<uint16_t, std::list<gatt_operation>> gatt_op_queue;
-  // contain connection ids that currently execute operations
-  static std::unordered_set<uint16_t> gatt_op_queue_executing;
+  // maps connection id to operations waiting for execution, and whether one
+  // is currently executing
+  static std::unordered_map<uint16_t, gatt_conn_queue> gatt_op_queue;
 };
\ No newline at end of file
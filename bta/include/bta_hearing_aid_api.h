@@ -20,7 +20,9 @@
 
 #include <base/callback_forward.h>
 #include <hardware/bt_hearing_aid.h>
+#include <algorithm>
 #include <deque>
+#include <iterator>
 #include <vector>
 
 constexpr uint16_t HEARINGAID_MAX_NUM_UUIDS = 1;
@@ -67,11 +69,21 @@ struct rssi_log {
   std::vector<int8_t> rssi;
 };
 
+// Width and number of the buckets of the audio latency histogram in DumpSys.
+// The last bucket holds every packet later than the others.
+constexpr uint64_t LATENCY_HISTOGRAM_BUCKET_MS = 10;
+constexpr size_t LATENCY_HISTOGRAM_BUCKETS = 8;
+
 struct AudioStats {
   size_t packet_flush_count;
   size_t packet_send_count;
   size_t frame_flush_count;
   size_t frame_send_count;
+  /* packets dropped before leaving the host because they were too old */
+  size_t packet_stale_count;
+  /* time from encoding to leaving the L2CAP queue, per packet */
+  size_t latency_histogram[LATENCY_HISTOGRAM_BUCKETS];
+  uint64_t latency_max_ms;
   std::deque<rssi_log> rssi_history;
 
   AudioStats() { Reset(); }
@@ -81,9 +93,26 @@ struct AudioStats {
     packet_send_count = 0;
     frame_flush_count = 0;
     frame_send_count = 0;
+    packet_stale_count = 0;
+    std::fill(std::begin(latency_histogram), std::end(latency_histogram), 0);
+    latency_max_ms = 0;
+  }
+
+  void AddLatency(uint64_t latency_ms) {
+    size_t bucket = std::min<uint64_t>(latency_ms / LATENCY_HISTOGRAM_BUCKET_MS,
+                                       LATENCY_HISTOGRAM_BUCKETS - 1);
+    latency_histogram[bucket]++;
+    latency_max_ms = std::max(latency_max_ms, latency_ms);
   }
 };
 
+/* An encoded audio packet, sequence number included, waiting to be handed to
+ * L2CAP */
+struct AudioPacket {
+  std::vector<uint8_t> data;
+  uint64_t encoded_ms;
+};
+
 /** Possible states for the Connection Update status */
 typedef enum {
   NONE,      // Not Connected
@@ -148,6 +177,15 @@ struct HearingDevice {
   int read_rssi_count;
   int num_intervals_since_last_rssi_read;
 
+  /* Packets encoded but not yet handed to L2CAP. They are released when the
+     link has room for them, and dropped once too old to be played. */
+  std::deque<AudioPacket> audio_queue;
+  /* Encoding time of the packets handed to L2CAP. The L2CAP queue is FIFO, so
+     only the last ones, as many as L2CAP still holds, are not sent yet. */
+  std::deque<uint64_t> l2cap_queue_encoded_ms;
+  /* Set between GAP_EVT_CONN_CONGESTED and GAP_EVT_CONN_UNCONGESTED */
+  bool congested;
+
   HearingDevice(const RawAddress& address, uint8_t capabilities,
                 uint16_t codecs, uint16_t audio_control_point_handle,
                 uint16_t audio_status_handle, uint16_t audio_status_ccc_handle,
@@ -175,7 +213,8 @@ struct HearingDevice {
         codecs(codecs),
         playback_started(false),
         command_acked(false),
-        read_rssi_count(0) {}
+        read_rssi_count(0),
+        congested(false) {}
 
   HearingDevice(const RawAddress& address, bool first_connection)
       : address(address),
@@ -197,7 +236,8 @@ struct HearingDevice {
         codecs(0),
         playback_started(false),
         command_acked(false),
-        read_rssi_count(0) {}
+        read_rssi_count(0),
+        congested(false) {}
 
   HearingDevice() : HearingDevice(RawAddress::kEmpty, false) {}
 
@@ -1179,12 +1179,11 @@ void bta_jv_l2cap_write(uint32_t handle, uint32_t req_id, BT_HDR* msg,
   // TODO: this was set only for non-fixed channel packets. Is that needed ?
   msg->event = BT_EVT_TO_BTU_SP_DATA;
 
-  if (evt_data.cong) {
-    osi_free(msg);
-  } else {
-    if (GAP_ConnWriteData(handle, msg) == BT_PASS)
-      evt_data.status = BTA_JV_SUCCESS;
-  }
+  /* GAP keeps the SDU on its tx queue while the channel is congested, so a
+   * writer that has several SDUs in flight does not lose the ones that were
+   * posted before it learned about the congestion. */
+  if (GAP_ConnWriteData(handle, msg) == BT_PASS)
+    evt_data.status = BTA_JV_SUCCESS;
 
   tBTA_JV bta_jv;
   bta_jv.l2c_write = evt_data;
@@ -1221,10 +1220,11 @@ void bta_jv_l2cap_write_fixed(uint16_t channel, const RawAddress& addr,
  ******************************************************************************/
 static int bta_jv_port_data_co_cback(uint16_t port_handle, uint8_t* buf,
                                      uint16_t len, int type) {
-  tBTA_JV_RFC_CB* p_cb = bta_jv_rfc_port_to_cb(port_handle);
+  /* the port handle indexes the port control blocks directly, the data path
+   * doesn't need the RFCOMM control block */
   tBTA_JV_PCB* p_pcb = bta_jv_rfc_port_to_pcb(port_handle);
-  VLOG(2) << __func__ << ": p_cb=" << p_cb << ", p_pcb=" << p_pcb
-          << ", len=" << len << ", type=" << type;
+  VLOG(2) << __func__ << ": p_pcb=" << p_pcb << ", len=" << len
+          << ", type=" << type;
   if (p_pcb != NULL) {
     switch (type) {
       case DATA_CO_CALLBACK_TYPE_INCOMING:
@@ -1233,6 +1233,9 @@ static int bta_jv_port_data_co_cback(uint16_t port_handle, uint8_t* buf,
         return bta_co_rfc_data_outgoing_size(p_pcb->rfcomm_slot_id, (int*)buf);
       case DATA_CO_CALLBACK_TYPE_OUTGOING:
         return bta_co_rfc_data_outgoing(p_pcb->rfcomm_slot_id, buf, len);
+      case DATA_CO_CALLBACK_TYPE_OUTGOING_BUFFERS:
+        return bta_co_rfc_data_outgoing_buffers(p_pcb->rfcomm_slot_id,
+                                                (BT_HDR**)buf, len);
       default:
         LOG(ERROR) << __func__ << ": unknown callout type=" << type;
         break;
@@ -2125,6 +2128,7 @@ static void fcchan_data_cbk(uint16_t chan, const RawAddress& bd_addr,
   }
   if (!t) {
     // no socket -> drop it
+    osi_free(p_buf);
     return;
   }
 
@@ -2134,7 +2138,11 @@ static void fcchan_data_cbk(uint16_t chan, const RawAddress& bd_addr,
   evt_data.le_data_ind.handle = t->id;
   evt_data.le_data_ind.p_buf = p_buf;
 
-  if (sock_cback) sock_cback(BTA_JV_L2CAP_DATA_IND_EVT, &evt_data, sock_id);
+  // the socket callback takes ownership of the buffer
+  if (sock_cback)
+    sock_cback(BTA_JV_L2CAP_DATA_IND_EVT, &evt_data, sock_id);
+  else
+    osi_free(p_buf);
 }
 
 /** makes an le l2cap client connection */
@@ -441,6 +441,30 @@ tBTA_JV_STATUS BTA_JvL2capRead(uint32_t handle, uint32_t req_id,
   return BTA_JV_SUCCESS;
 }
 
+/*******************************************************************************
+ *
+ * Function         BTA_JvL2capReadBuf
+ *
+ * Description      This function takes the next received SDU of an L2CAP
+ *                  connection off its receive queue, without copying it.
+ *                  The caller owns the returned buffer and must free it.
+ *
+ * Returns          BTA_JV_SUCCESS, if an SDU is in *pp_buf.
+ *                  BTA_JV_FAILURE, if there is none or on error.
+ *
+ ******************************************************************************/
+tBTA_JV_STATUS BTA_JvL2capReadBuf(uint32_t handle, BT_HDR** pp_buf) {
+  VLOG(2) << __func__ << ": handle=" << handle;
+
+  if (handle >= BTA_JV_MAX_L2C_CONN || !bta_jv_cb.l2c_cb[handle].p_cback)
+    return BTA_JV_FAILURE;
+
+  if (GAP_ConnBTRead((uint16_t)handle, pp_buf) != BT_PASS)
+    return BTA_JV_FAILURE;
+
+  return BTA_JV_SUCCESS;
+}
+
 /*******************************************************************************
  *
  * Function         BTA_JvL2capReady
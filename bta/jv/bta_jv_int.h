@@ -84,6 +84,10 @@ typedef struct {
 #define BTA_JV_RFC_HDL_TO_SIDX(r) (((r)&0xFF00) >> 8)
 #define BTA_JV_RFC_H_S_TO_HDL(h, s) ((h) | ((s) << 8))
 
+/* The rfc_cb index plus one is held in the bits below BTA_JV_RFCOMM_MASK */
+static_assert(BTA_JV_MAX_RFC_CONN < BTA_JV_RFCOMM_MASK,
+              "RFCOMM JV handles can't tell an rfc_cb index that large");
+
 /* port control block */
 typedef struct {
   uint32_t handle;      /* the rfcomm session handle at jv */
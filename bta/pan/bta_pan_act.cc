@@ -198,6 +198,11 @@ static void bta_pan_data_buf_ind_cback(uint16_t handle, const RawAddress& src,
   ((tBTA_PAN_DATA_PARAMS*)p_new_buf)->forward = forward;
 
   fixed_queue_enqueue(p_scb->data_queue, p_new_buf);
+
+  /* The pending event will pass this buffer along with the queued ones */
+  if (p_scb->rx_data_pending) return;
+  p_scb->rx_data_pending = true;
+
   BT_HDR* p_event = (BT_HDR*)osi_malloc(sizeof(BT_HDR));
   p_event->layer_specific = handle;
   p_event->event = BTA_PAN_RX_FROM_BNEP_READY_EVT;
@@ -598,6 +603,7 @@ void bta_pan_rx_path(tBTA_PAN_SCB* p_scb, UNUSED_ATTR tBTA_PAN_DATA* p_data) {
  *
  ******************************************************************************/
 void bta_pan_tx_path(tBTA_PAN_SCB* p_scb, UNUSED_ATTR tBTA_PAN_DATA* p_data) {
+  p_scb->rx_data_pending = false;
   bta_pan_pm_conn_busy(p_scb);
   /* call application callout function for tx path */
   bta_pan_co_tx_path(p_scb->handle, p_scb->app_id);
@@ -127,6 +127,7 @@ typedef struct {
   tBTA_PAN_ROLE local_role; /* local role */
   tBTA_PAN_ROLE peer_role;  /* peer role */
   uint8_t app_id;           /* application id for the connection */
+  bool rx_data_pending;     /* A BNEP data event is waiting to be handled */
 
 } tBTA_PAN_SCB;
 
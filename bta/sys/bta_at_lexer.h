@@ -0,0 +1,143 @@
+/******************************************************************************
+ *
+ *  Copyright 2020 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  Lexing helpers shared by the AT command interpreter of the audio gateway
+ *  and the AT response parser of the hands-free client. They work on the
+ *  received buffers in place: nothing is copied or allocated.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Index of the names of an AT command or result code table, filled once from
+ * the table. Looking a received name up walks one node per character of the
+ * name instead of comparing it with every entry of the table.
+ */
+class AtNameTrie {
+ public:
+  static constexpr int kNoMatch = -1;
+  static constexpr size_t kMaxNodes = 255;
+
+  explicit AtNameTrie(bool ignore_case = false)
+      : count_(1), ignore_case_(ignore_case) {
+    nodes_[0] = {0, 0, 0, kNoMatch};
+  }
+
+  /**
+   * Add |name| for the table entry |value|. Returns false when the trie is
+   * full; the names added before are still found.
+   */
+  bool Add(const char* name, int value) {
+    uint8_t node = 0;
+    for (; *name != 0; name++) {
+      char c = Fold(*name);
+      uint8_t child = nodes_[node].child;
+      while (child != 0 && nodes_[child].c != c) child = nodes_[child].sibling;
+      if (child == 0) {
+        if (count_ > kMaxNodes) return false;
+        child = count_++;
+        nodes_[child] = {c, 0, nodes_[node].child, kNoMatch};
+        nodes_[node].child = child;
+      }
+      node = child;
+    }
+    if (node == 0) return false;
+    /* The first entry of a name is the one that is matched */
+    if (nodes_[node].value == kNoMatch) nodes_[node].value = value;
+    return true;
+  }
+
+  /**
+   * Find the longest name starting the |len| characters at |p|. Returns the
+   * value the name was added with and sets |*p_name_len| to its length, or
+   * returns kNoMatch. A table scan with utl_strucmp or strncmp returns the
+   * first name in table order instead; the two only agree when no name of
+   * the table is a prefix of another, which bta_ag_at_test checks for the
+   * AG and HF client tables.
+   */
+  int Match(const char* p, size_t len, size_t* p_name_len) const {
+    int value = kNoMatch;
+    uint8_t node = 0;
+    for (size_t i = 0; i < len; i++) {
+      char c = Fold(p[i]);
+      uint8_t child = nodes_[node].child;
+      while (child != 0 && nodes_[child].c != c) child = nodes_[child].sibling;
+      if (child == 0) break;
+      node = child;
+      if (nodes_[node].value != kNoMatch) {
+        value = nodes_[node].value;
+        *p_name_len = i + 1;
+      }
+    }
+    return value;
+  }
+
+ private:
+  struct Node {
+    char c;
+    uint8_t child;   /* first child, 0 if none */
+    uint8_t sibling; /* next child of the same parent, 0 if none */
+    int16_t value;
+  };
+
+  char Fold(char c) const {
+    return (ignore_case_ && c >= 'a' && c <= 'z') ? c - 0x20 : c;
+  }
+
+  /* nodes_[0] is the root, the empty name */
+  Node nodes_[kMaxNodes + 1];
+  uint16_t count_;
+  bool ignore_case_;
+};
+
+/**
+ * Return the first line terminator of the |len| characters at |p|: a <cr>,
+ * a <lf>, or the <ctrl-z> and <esc> that abort a command. Returns |p| + |len|
+ * if there is none.
+ */
+inline const char* AtFindTerminator(const char* p, size_t len) {
+  const char* p_stop = p + len;
+  for (; p < p_stop; p++) {
+    if (*p == '\r' || *p == '\n' || *p == 0x1A || *p == 0x1B) break;
+  }
+  return p;
+}
+
+/**
+ * Parse the unsigned decimal number at |p|, after any spaces. Returns the
+ * character following it, or nullptr if there is no number or it does not
+ * fit |*p_value|.
+ */
+inline const char* AtParseUint32(const char* p, uint32_t* p_value) {
+  while (*p == ' ') p++;
+  if (*p < '0' || *p > '9') return nullptr;
+
+  uint64_t value = 0;
+  for (; *p >= '0' && *p <= '9'; p++) {
+    value = value * 10 + (*p - '0');
+    if (value > UINT32_MAX) return nullptr;
+  }
+  *p_value = static_cast<uint32_t>(value);
+  return p;
+}
@@ -226,6 +226,7 @@ extern void bta_sys_sendmsg_delayed(void* p_msg, const base::TimeDelta& delay);
 extern void bta_sys_start_timer(alarm_t* alarm, uint64_t interval_ms,
                                 uint16_t event, uint16_t layer_specific);
 extern void bta_sys_disable(tBTA_SYS_HW_MODULE module);
+extern void bta_sys_debug_dump(int fd);
 
 extern void bta_sys_hw_register(tBTA_SYS_HW_MODULE module,
                                 tBTA_SYS_HW_CBACK* cback);
@@ -78,6 +78,8 @@ typedef struct {
   /* VS event handler */
   tBTA_SYS_VS_EVT_HDLR* p_vs_evt_hdlr;
 
+  uint64_t init_time_ms;          /* when bta_sys_init() was called */
+  uint64_t msg_count[BTA_ID_MAX]; /* messages handled by each subsystem */
 } tBTA_SYS_CB;
 
 /*****************************************************************************
@@ -28,12 +28,21 @@
 #include <base/logging.h>
 #include <string.h>
 
+#include <mutex>
+
 #include "bt_common.h"
+#include "bta/av/bta_av_int.h"
+#include "bta/dm/bta_dm_int.h"
+#include "bta/gatt/bta_gattc_int.h"
+#include "bta/gatt/bta_gatts_int.h"
+#include "bta/hh/bta_hh_int.h"
+#include "bta/jv/bta_jv_int.h"
 #include "bta_api.h"
 #include "bta_sys.h"
 #include "bta_sys_int.h"
 #include "btm_api.h"
 #include "btu.h"
+#include "common/time_util.h"
 #include "osi/include/alarm.h"
 #include "osi/include/fixed_queue.h"
 #include "osi/include/log.h"
@@ -54,6 +63,21 @@ uint8_t btif_trace_level = BT_TRACE_LEVEL_WARNING;
 
 static const tBTA_SYS_REG bta_sys_hw_reg = {bta_sys_sm_execute, NULL};
 
+/* number of messages bta_sys_sendmsg() queues without an allocation */
+#define BTA_SYS_MSG_QUEUE_SIZE 128
+
+/* messages sent by bta_sys_sendmsg(), in order. Each one is handled by a
+ * posted bta_sys_msg_queue_dispatch(); the closure is bound once and shared
+ * by all the posts, so sending a message does not allocate one. */
+static struct {
+  std::mutex lock;
+  BT_HDR* p_msgs[BTA_SYS_MSG_QUEUE_SIZE];
+  size_t front;
+  size_t size;
+  size_t max_size;    /* highest number of queued messages */
+  uint64_t overflows; /* messages posted with their own closure */
+} bta_sys_msg_queue;
+
 /* type for action functions */
 typedef void (*tBTA_SYS_ACTION)(tBTA_SYS_HW_MSG* p_data);
 
@@ -173,6 +197,7 @@ const tBTA_SYS_ST_TBL bta_sys_st_tbl[] = {
  ******************************************************************************/
 void bta_sys_init(void) {
   memset(&bta_sys_cb, 0, sizeof(tBTA_SYS_CB));
+  bta_sys_cb.init_time_ms = bluetooth::common::time_get_os_boottime_ms();
 
   appl_trace_level = APPL_INITIAL_TRACE_LEVEL;
 
@@ -457,6 +482,7 @@ void bta_sys_event(BT_HDR* p_msg) {
 
   /* verify id and call subsystem event handler */
   if ((id < BTA_ID_MAX) && (bta_sys_cb.reg[id] != NULL)) {
+    bta_sys_cb.msg_count[id]++;
     freebuf = (*bta_sys_cb.reg[id]->evt_hdlr)(p_msg);
   } else {
     APPL_TRACE_WARNING("%s: Received unregistered event id %d", __func__, id);
@@ -509,6 +535,30 @@ void bta_sys_deregister(uint8_t id) { bta_sys_cb.is_reg[id] = false; }
  ******************************************************************************/
 bool bta_sys_is_register(uint8_t id) { return bta_sys_cb.is_reg[id]; }
 
+/*******************************************************************************
+ *
+ * Function         bta_sys_msg_queue_dispatch
+ *
+ * Description      Handle the oldest message sent by bta_sys_sendmsg().
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void bta_sys_msg_queue_dispatch(void) {
+  BT_HDR* p_msg;
+
+  {
+    std::lock_guard<std::mutex> lock(bta_sys_msg_queue.lock);
+    CHECK(bta_sys_msg_queue.size > 0);
+    p_msg = bta_sys_msg_queue.p_msgs[bta_sys_msg_queue.front];
+    bta_sys_msg_queue.front =
+        (bta_sys_msg_queue.front + 1) % BTA_SYS_MSG_QUEUE_SIZE;
+    bta_sys_msg_queue.size--;
+  }
+
+  bta_sys_event(p_msg);
+}
+
 /*******************************************************************************
  *
  * Function         bta_sys_sendmsg
@@ -517,6 +567,11 @@ bool bta_sys_is_register(uint8_t id) { return bta_sys_cb.is_reg[id]; }
  *                  optimize sending of messages to BTA.  It is called by BTA
  *                  API functions and call-in functions.
  *
+ *                  The message is queued, and a shared closure is posted to
+ *                  handle it, so the messages keep their order with the
+ *                  other tasks of the main thread. The message is posted
+ *                  with a closure of its own when the queue is full.
+ *
  *                  TODO (apanicke): Add location object as parameter for easier
  *                  future debugging when doing alarm refactor
  *
@@ -525,6 +580,31 @@ bool bta_sys_is_register(uint8_t id) { return bta_sys_cb.is_reg[id]; }
  *
  ******************************************************************************/
 void bta_sys_sendmsg(void* p_msg) {
+  static const base::RepeatingClosure dispatch =
+      base::BindRepeating(&bta_sys_msg_queue_dispatch);
+
+  {
+    std::lock_guard<std::mutex> lock(bta_sys_msg_queue.lock);
+    if (bta_sys_msg_queue.size < BTA_SYS_MSG_QUEUE_SIZE) {
+      size_t back = (bta_sys_msg_queue.front + bta_sys_msg_queue.size) %
+                    BTA_SYS_MSG_QUEUE_SIZE;
+      bta_sys_msg_queue.p_msgs[back] = static_cast<BT_HDR*>(p_msg);
+      bta_sys_msg_queue.size++;
+      if (bta_sys_msg_queue.size > bta_sys_msg_queue.max_size) {
+        bta_sys_msg_queue.max_size = bta_sys_msg_queue.size;
+      }
+
+      /* post while holding the lock, so the message is still the last one
+       * if the post fails */
+      if (do_in_main_thread(FROM_HERE, dispatch) != BT_STATUS_SUCCESS) {
+        bta_sys_msg_queue.size--;
+        LOG(ERROR) << __func__ << ": do_in_main_thread failed";
+      }
+      return;
+    }
+    bta_sys_msg_queue.overflows++;
+  }
+
   if (do_in_main_thread(
           FROM_HERE, base::Bind(&bta_sys_event, static_cast<BT_HDR*>(p_msg))) !=
       BT_STATUS_SUCCESS) {
@@ -616,3 +696,122 @@ void bta_sys_set_trace_level(uint8_t level) { appl_trace_level = level; }
  *
  ******************************************************************************/
 uint16_t bta_sys_get_sys_features(void) { return bta_sys_cb.sys_features; }
+
+/*******************************************************************************
+ *
+ * Function         bta_sys_id_text
+ *
+ * Description      Get the name of a BTA subsystem.
+ *
+ * Returns          The name
+ *
+ ******************************************************************************/
+static const char* bta_sys_id_text(uint8_t id) {
+  switch (id) {
+    case BTA_ID_SYS:
+      return "SYS";
+    case BTA_ID_DM_SEARCH:
+      return "DM_SEARCH";
+    case BTA_ID_AG:
+      return "AG";
+    case BTA_ID_PAN:
+      return "PAN";
+    case BTA_ID_AV:
+      return "AV";
+    case BTA_ID_HD:
+      return "HD";
+    case BTA_ID_HH:
+      return "HH";
+    case BTA_ID_HS:
+      return "HS";
+    case BTA_ID_MCE:
+      return "MCE";
+    case BTA_ID_GATTC:
+      return "GATTC";
+    case BTA_ID_GATTS:
+      return "GATTS";
+    case BTA_ID_SDP:
+      return "SDP";
+    default:
+      return "UNKNOWN";
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_sys_footprint_dump
+ *
+ * Description      Dump the memory taken by the control blocks of the BTA
+ *                  subsystems, and by the known GATT servers, which are added
+ *                  as devices are met.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void bta_sys_footprint_dump(int fd) {
+  const struct {
+    const char* name;
+    size_t size;
+  } blocks[] = {
+      {"bta_sys_cb", sizeof(bta_sys_cb)},
+      {"bta_dm_cb", sizeof(bta_dm_cb)},
+      {"bta_dm_search_cb", sizeof(bta_dm_search_cb)},
+      {"bta_gattc_cb", sizeof(bta_gattc_cb)},
+      {"bta_gatts_cb", sizeof(bta_gatts_cb)},
+      {"bta_jv_cb", sizeof(bta_jv_cb)},
+      {"bta_av_cb", sizeof(bta_av_cb)},
+#if (BTA_HH_INCLUDED == TRUE)
+      {"bta_hh_cb", sizeof(bta_hh_cb)},
+#endif
+  };
+
+  dprintf(fd, "\nBTA Control Blocks:\n");
+  size_t total = 0;
+  for (const auto& block : blocks) {
+    dprintf(fd, "  %-18s %7zu bytes\n", block.name, block.size);
+    total += block.size;
+  }
+
+  size_t known_servers = bta_gattc_cb.known_server.size();
+  size_t known_servers_size = known_servers * sizeof(tBTA_GATTC_SERV);
+  dprintf(fd, "  %-18s %7zu bytes for %zu of at most %d devices\n",
+          "GATT known servers", known_servers_size, known_servers,
+          BTA_GATTC_KNOWN_SR_MAX);
+  total += known_servers_size;
+  dprintf(fd, "  %-18s %7zu bytes\n", "total", total);
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_sys_debug_dump
+ *
+ * Description      Dump the number and rate of the messages handled by each
+ *                  BTA subsystem, and the state of the message queue, to
+ *                  |fd|.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void bta_sys_debug_dump(int fd) {
+  uint64_t elapsed_ms =
+      bluetooth::common::time_get_os_boottime_ms() - bta_sys_cb.init_time_ms;
+
+  dprintf(fd, "\nBTA System Messages:\n");
+  {
+    std::lock_guard<std::mutex> lock(bta_sys_msg_queue.lock);
+    dprintf(fd, "  Queued: %zu max: %zu of %d overflows: %llu\n",
+            bta_sys_msg_queue.size, bta_sys_msg_queue.max_size,
+            BTA_SYS_MSG_QUEUE_SIZE,
+            (unsigned long long)bta_sys_msg_queue.overflows);
+  }
+  for (int id = 0; id < BTA_ID_MAX; id++) {
+    uint64_t count = bta_sys_cb.msg_count[id];
+    if (count == 0) continue;
+    dprintf(fd, "  %s (%d): %llu messages, %llu per second\n",
+            bta_sys_id_text(id), id, (unsigned long long)count,
+            (unsigned long long)(elapsed_ms == 0 ? 0
+                                                 : count * 1000 / elapsed_ms));
+  }
+
+  bta_sys_footprint_dump(fd);
+}
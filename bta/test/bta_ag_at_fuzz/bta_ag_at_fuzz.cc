@@ -0,0 +1,88 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "bta/ag/bta_ag_at.h"
+#include "bta/sys/bta_at_lexer.h"
+#include "stack/include/btm_api.h"
+
+/* utl.cc links against the device class functions of the stack */
+uint8_t* BTM_ReadDeviceClass(void) { return nullptr; }
+tBTM_STATUS BTM_SetDeviceClass(DEV_CLASS dev_class) { return BTM_SUCCESS; }
+
+namespace {
+
+/* The names and argument capabilities of the HFP command table */
+const tBTA_AG_AT_CMD fuzz_at_tbl[] = {
+    {"A", 0, BTA_AG_AT_NONE, BTA_AG_AT_STR, 0, 0},
+    {"D", 1, BTA_AG_AT_NONE | BTA_AG_AT_FREE, BTA_AG_AT_STR, 0, 0},
+    {"+VGS", 2, BTA_AG_AT_SET, BTA_AG_AT_INT, 0, 15},
+    {"+CHLD", 3, BTA_AG_AT_SET | BTA_AG_AT_TEST, BTA_AG_AT_STR, 0, 4},
+    {"+CIND", 4, BTA_AG_AT_READ | BTA_AG_AT_TEST, BTA_AG_AT_STR, 0, 0},
+    {"+CMER", 5, BTA_AG_AT_SET, BTA_AG_AT_STR, 0, 0},
+    {"+BRSF", 6, BTA_AG_AT_SET, BTA_AG_AT_INT, 0, 0x7fff},
+    {"+BTRH", 7, BTA_AG_AT_READ | BTA_AG_AT_SET, BTA_AG_AT_INT, 0, 2},
+    {"+BIA", 8, BTA_AG_AT_SET, BTA_AG_AT_STR, 0, 20},
+    {"+BIND", 9, BTA_AG_AT_SET | BTA_AG_AT_READ | BTA_AG_AT_TEST,
+     BTA_AG_AT_STR, 0, 0},
+    {"", 0, 0, 0, 0, 0}};
+
+/* Touch all of the argument, up to p_end, as bta_ag_at_hfp_cback does */
+void CmdCback(tBTA_AG_SCB* p_user, uint16_t command_id, uint8_t arg_type,
+              char* p_arg, char* p_end, int16_t int_arg) {
+  volatile size_t len = strlen(p_arg);
+  for (char* p = p_arg; p < p_end; p++) len += *p;
+}
+
+void ErrCback(tBTA_AG_SCB* p_user, bool unknown, const char* p_arg) {
+  if (p_arg != nullptr) {
+    volatile size_t len = strlen(p_arg);
+  }
+}
+
+}  // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  if (size < 1) return 0;
+
+  tBTA_AG_AT_CB at_cb;
+  memset(&at_cb, 0, sizeof(at_cb));
+  at_cb.p_at_tbl = fuzz_at_tbl;
+  at_cb.p_cmd_cback = CmdCback;
+  at_cb.p_err_cback = ErrCback;
+  /* a short command buffer gets the long command handling exercised too */
+  at_cb.cmd_max_len = 16 + data[0] % 64;
+  bta_ag_at_init(&at_cb);
+
+  /* The rest of the input is received in buffers of the sizes that the bytes
+   * at its start give, like the fragments RFCOMM hands over */
+  size_t pos = 1;
+  while (pos < size) {
+    size_t len = 1 + data[pos] % 32;
+    pos++;
+    if (len > size - pos) len = size - pos;
+    std::vector<char> buf(data + pos, data + pos + len);
+    bta_ag_at_parse(&at_cb, buf.data(), buf.size());
+    pos += len;
+  }
+
+  bta_ag_at_reinit(&at_cb);
+  return 0;
+}
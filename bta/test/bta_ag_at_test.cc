@@ -0,0 +1,221 @@
+/******************************************************************************
+ *
+ *  Copyright 2020 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "bta/ag/bta_ag_at.h"
+#include "bta/ag/bta_ag_int.h"
+#include "bta/hf_client/bta_hf_client_int.h"
+#include "bta/sys/bta_at_lexer.h"
+
+namespace {
+
+enum { CMD_A, CMD_D, CMD_VGS, CMD_CIND, CMD_BIA };
+
+const tBTA_AG_AT_CMD test_at_tbl[] = {
+    {"A", CMD_A, BTA_AG_AT_NONE, BTA_AG_AT_STR, 0, 0},
+    {"D", CMD_D, BTA_AG_AT_NONE | BTA_AG_AT_FREE, BTA_AG_AT_STR, 0, 0},
+    {"+VGS", CMD_VGS, BTA_AG_AT_SET, BTA_AG_AT_INT, 0, 15},
+    {"+CIND", CMD_CIND, BTA_AG_AT_READ | BTA_AG_AT_TEST, BTA_AG_AT_STR, 0, 0},
+    {"+BIA", CMD_BIA, BTA_AG_AT_SET, BTA_AG_AT_STR, 0, 20},
+    {"", 0, 0, 0, 0, 0}};
+
+struct Command {
+  uint16_t command_id;
+  uint8_t arg_type;
+  std::string arg;
+  int16_t int_arg;
+};
+
+std::vector<Command> g_commands;
+std::vector<std::string> g_errors;
+
+void CmdCback(tBTA_AG_SCB* p_user, uint16_t command_id, uint8_t arg_type,
+              char* p_arg, char* p_end, int16_t int_arg) {
+  g_commands.push_back({command_id, arg_type, p_arg, int_arg});
+}
+
+void ErrCback(tBTA_AG_SCB* p_user, bool unknown, const char* p_arg) {
+  g_errors.push_back(unknown ? std::string("unknown:") + (p_arg ? p_arg : "")
+                             : std::string("error"));
+}
+
+class BtaAgAtTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    g_commands.clear();
+    g_errors.clear();
+    memset(&at_cb_, 0, sizeof(at_cb_));
+    at_cb_.p_at_tbl = test_at_tbl;
+    at_cb_.p_cmd_cback = CmdCback;
+    at_cb_.p_err_cback = ErrCback;
+    at_cb_.cmd_max_len = 32;
+    bta_ag_at_init(&at_cb_);
+  }
+
+  void TearDown() override { bta_ag_at_reinit(&at_cb_); }
+
+  void Parse(const std::string& data) {
+    std::vector<char> buf(data.begin(), data.end());
+    bta_ag_at_parse(&at_cb_, buf.data(), buf.size());
+  }
+
+  tBTA_AG_AT_CB at_cb_;
+};
+
+TEST(AtNameTrieTest, longest_prefix_is_matched) {
+  AtNameTrie trie;
+  ASSERT_TRUE(trie.Add("+VGM:", 0));
+  ASSERT_TRUE(trie.Add("+VGM=", 1));
+  ASSERT_TRUE(trie.Add("+CME ERROR:", 2));
+  ASSERT_TRUE(trie.Add("+C", 3));
+
+  size_t len = 0;
+  EXPECT_EQ(trie.Match("+VGM=5\r\n", 8, &len), 1);
+  EXPECT_EQ(len, 5u);
+  EXPECT_EQ(trie.Match("+CME ERROR: 3", 13, &len), 2);
+  EXPECT_EQ(len, 11u);
+  EXPECT_EQ(trie.Match("+CIND", 5, &len), 3);
+  EXPECT_EQ(len, 2u);
+  EXPECT_EQ(trie.Match("+VGM", 4, &len), AtNameTrie::kNoMatch);
+  EXPECT_EQ(trie.Match("+vgm=", 5, &len), AtNameTrie::kNoMatch);
+}
+
+TEST(AtNameTrieTest, case_is_ignored) {
+  AtNameTrie trie(true);
+  ASSERT_TRUE(trie.Add("+BRSF", 7));
+
+  size_t len = 0;
+  EXPECT_EQ(trie.Match("+bRsF=1", 7, &len), 7);
+  EXPECT_EQ(len, 5u);
+}
+
+TEST(AtNameTrieTest, full_trie_is_reported) {
+  AtNameTrie trie;
+  std::string name(AtNameTrie::kMaxNodes + 1, 'x');
+  EXPECT_FALSE(trie.Add(name.c_str(), 0));
+  EXPECT_FALSE(trie.Add("", 0));
+}
+
+// The trie finds the longest name, the table scans it replaced found the
+// first one. They agree as long as no name is a prefix of another.
+static void ExpectNoNameIsAPrefix(const std::vector<std::string>& names) {
+  for (size_t i = 0; i < names.size(); i++) {
+    for (size_t j = 0; j < names.size(); j++) {
+      if (i == j) continue;
+      EXPECT_NE(names[j].compare(0, names[i].size(), names[i]), 0)
+          << names[i] << " is a prefix of " << names[j];
+    }
+  }
+}
+
+TEST(AtNameTrieTest, ag_command_names_are_not_prefixes) {
+  for (int profile = 0; profile < BTA_AG_NUM_IDX; profile++) {
+    std::vector<std::string> names;
+    for (const tBTA_AG_AT_CMD* p_cmd = bta_ag_at_tbl[profile];
+         p_cmd->p_cmd[0] != 0; p_cmd++) {
+      names.push_back(p_cmd->p_cmd);
+    }
+    ASSERT_FALSE(names.empty());
+    ExpectNoNameIsAPrefix(names);
+  }
+}
+
+TEST(AtNameTrieTest, hf_client_event_names_are_not_prefixes) {
+  std::vector<std::string> names;
+  for (size_t i = 0; bta_hf_client_at_event_name(i) != nullptr; i++) {
+    names.push_back(bta_hf_client_at_event_name(i));
+  }
+  ASSERT_FALSE(names.empty());
+  ExpectNoNameIsAPrefix(names);
+}
+
+TEST(AtParseUint32Test, parses_numbers) {
+  uint32_t value = 0;
+  const char* p = "  4294967295\r\n";
+  EXPECT_EQ(AtParseUint32(p, &value), p + 12);
+  EXPECT_EQ(value, 4294967295u);
+
+  EXPECT_EQ(AtParseUint32("4294967296", &value), nullptr);
+  EXPECT_EQ(AtParseUint32("\r\n", &value), nullptr);
+  EXPECT_EQ(AtParseUint32("-1", &value), nullptr);
+}
+
+TEST_F(BtaAgAtTest, commands_in_one_buffer) {
+  Parse("AT+VGS=7\rATD5551234;\r\nat+cind=?\rATA\r");
+
+  ASSERT_EQ(g_commands.size(), 4u);
+  EXPECT_EQ(g_commands[0].command_id, CMD_VGS);
+  EXPECT_EQ(g_commands[0].arg_type, BTA_AG_AT_SET);
+  EXPECT_EQ(g_commands[0].int_arg, 7);
+  EXPECT_EQ(g_commands[1].command_id, CMD_D);
+  EXPECT_EQ(g_commands[1].arg_type, BTA_AG_AT_FREE);
+  EXPECT_EQ(g_commands[1].arg, "5551234;");
+  EXPECT_EQ(g_commands[2].command_id, CMD_CIND);
+  EXPECT_EQ(g_commands[2].arg_type, BTA_AG_AT_TEST);
+  EXPECT_EQ(g_commands[3].command_id, CMD_A);
+  EXPECT_TRUE(g_errors.empty());
+  EXPECT_EQ(at_cb_.p_cmd_buf, nullptr);
+}
+
+TEST_F(BtaAgAtTest, command_split_across_buffers) {
+  Parse("AT+B");
+  Parse("IA=1,0");
+  EXPECT_TRUE(g_commands.empty());
+  Parse(",1\rAT+VGS=1");
+  Parse("6\r");
+
+  ASSERT_EQ(g_commands.size(), 1u);
+  EXPECT_EQ(g_commands[0].command_id, CMD_BIA);
+  EXPECT_EQ(g_commands[0].arg, "1,0,1");
+  ASSERT_EQ(g_errors.size(), 1u);
+  EXPECT_EQ(g_errors[0], "error");
+}
+
+TEST_F(BtaAgAtTest, errors) {
+  Parse("AT+XYZ=1\rAT+CIND=1\rAT+VGS\x1a");
+
+  EXPECT_TRUE(g_commands.empty());
+  ASSERT_EQ(g_errors.size(), 3u);
+  EXPECT_EQ(g_errors[0], "unknown:+XYZ=1");
+  EXPECT_EQ(g_errors[1], "error");
+  EXPECT_EQ(g_errors[2], "unknown:AT+VGS\x1a");
+}
+
+TEST_F(BtaAgAtTest, too_long_commands_are_dropped) {
+  Parse(std::string("AT+BIA=") + std::string(40, '1') + "\rAT+VGS=3\r");
+
+  ASSERT_EQ(g_commands.size(), 1u);
+  EXPECT_EQ(g_commands[0].command_id, CMD_VGS);
+  EXPECT_EQ(g_commands[0].int_arg, 3);
+}
+
+TEST_F(BtaAgAtTest, nulls_and_empty_lines_are_skipped) {
+  const char data[] = "\0\0\r\nAT\r\n\0AT+VGS=2\n";
+  Parse(std::string(data, sizeof(data) - 1));
+
+  ASSERT_EQ(g_commands.size(), 1u);
+  EXPECT_EQ(g_commands[0].int_arg, 2);
+  EXPECT_TRUE(g_errors.empty());
+}
+
+}  // namespace
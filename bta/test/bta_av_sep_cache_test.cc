@@ -0,0 +1,160 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <vector>
+
+#include "bta/av/bta_av_int.h"
+
+namespace {
+
+// The SBC capabilities of a sink
+const uint8_t kCodecInfoSbc[] = {6, 0, 0, 0xff, 0xff, 2, 250};
+
+// SCMS-T content protection
+const uint8_t kProtectInfoScmsT[] = {2, 0x02, 0x00};
+
+class BtaAvSepCacheTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    memset(sep_info_, 0, sizeof(sep_info_));
+    memset(sep_caps_, 0, sizeof(sep_caps_));
+
+    sep_info_[0].in_use = true;
+    sep_info_[0].seid = 1;
+    sep_info_[0].media_type = AVDT_MEDIA_TYPE_AUDIO;
+    sep_info_[0].tsep = AVDT_TSEP_SNK;
+    sep_caps_[0].valid = true;
+    sep_caps_[0].num_codec = 1;
+    sep_caps_[0].num_protect = 1;
+    sep_caps_[0].psc_mask = AVDT_PSC_TRANS | AVDT_PSC_DELAY_RPT;
+    memcpy(sep_caps_[0].codec_info, kCodecInfoSbc, sizeof(kCodecInfoSbc));
+    memcpy(sep_caps_[0].protect_info, kProtectInfoScmsT,
+           sizeof(kProtectInfoScmsT));
+
+    // A SEP whose capabilities were not asked for
+    sep_info_[1].seid = 0x3e;
+    sep_info_[1].media_type = AVDT_MEDIA_TYPE_AUDIO;
+    sep_info_[1].tsep = AVDT_TSEP_SRC;
+  }
+
+  std::vector<uint8_t> Encode(uint8_t num_seps) {
+    std::vector<uint8_t> buf(BTA_AV_SEP_CACHE_MAX_LEN);
+    uint16_t len = bta_av_sep_cache_encode(sep_info_, sep_caps_, num_seps,
+                                           buf.data(), buf.size());
+    buf.resize(len);
+    return buf;
+  }
+
+  uint8_t Decode(const std::vector<uint8_t>& buf) {
+    return bta_av_sep_cache_decode(buf.data(), buf.size(), sep_info_out_,
+                                   sep_caps_out_);
+  }
+
+  tAVDT_SEP_INFO sep_info_[BTA_AV_NUM_SEPS];
+  tBTA_AV_SEP_CAPS sep_caps_[BTA_AV_NUM_SEPS];
+  tAVDT_SEP_INFO sep_info_out_[BTA_AV_NUM_SEPS];
+  tBTA_AV_SEP_CAPS sep_caps_out_[BTA_AV_NUM_SEPS];
+};
+
+TEST_F(BtaAvSepCacheTest, round_trip) {
+  std::vector<uint8_t> buf = Encode(2);
+  ASSERT_EQ(Decode(buf), 2);
+
+  for (int i = 0; i < 2; i++) {
+    EXPECT_FALSE(sep_info_out_[i].in_use);
+    EXPECT_EQ(sep_info_out_[i].seid, sep_info_[i].seid);
+    EXPECT_EQ(sep_info_out_[i].media_type, sep_info_[i].media_type);
+    EXPECT_EQ(sep_info_out_[i].tsep, sep_info_[i].tsep);
+  }
+
+  EXPECT_TRUE(sep_caps_out_[0].valid);
+  EXPECT_EQ(sep_caps_out_[0].num_codec, 1);
+  EXPECT_EQ(sep_caps_out_[0].num_protect, 1);
+  EXPECT_EQ(sep_caps_out_[0].psc_mask, sep_caps_[0].psc_mask);
+  EXPECT_EQ(memcmp(sep_caps_out_[0].codec_info, sep_caps_[0].codec_info,
+                   AVDT_CODEC_SIZE),
+            0);
+  EXPECT_EQ(memcmp(sep_caps_out_[0].protect_info, sep_caps_[0].protect_info,
+                   AVDT_PROTECT_SIZE),
+            0);
+  EXPECT_FALSE(sep_caps_out_[1].valid);
+}
+
+TEST_F(BtaAvSepCacheTest, encode_buffer_too_small) {
+  std::vector<uint8_t> buf = Encode(2);
+  ASSERT_FALSE(buf.empty());
+
+  std::vector<uint8_t> small(buf.size() - 1);
+  EXPECT_EQ(bta_av_sep_cache_encode(sep_info_, sep_caps_, 2, small.data(),
+                                    small.size()),
+            0);
+}
+
+TEST_F(BtaAvSepCacheTest, decode_rejects_truncated_data) {
+  std::vector<uint8_t> buf = Encode(2);
+  for (size_t len = 0; len < buf.size(); len++) {
+    std::vector<uint8_t> truncated(buf.begin(), buf.begin() + len);
+    EXPECT_EQ(Decode(truncated), 0) << "len=" << len;
+  }
+
+  buf.push_back(0);
+  EXPECT_EQ(Decode(buf), 0);
+}
+
+TEST_F(BtaAvSepCacheTest, decode_rejects_invalid_data) {
+  const std::vector<uint8_t> buf = Encode(2);
+  std::vector<uint8_t> bad;
+
+  // Version
+  bad = buf;
+  bad[0] = 2;
+  EXPECT_EQ(Decode(bad), 0);
+
+  // Number of SEPs
+  bad = buf;
+  bad[1] = BTA_AV_NUM_SEPS + 1;
+  EXPECT_EQ(Decode(bad), 0);
+
+  // SEID
+  bad = buf;
+  bad[2] = 0;
+  EXPECT_EQ(Decode(bad), 0);
+  bad[2] = 0x3f;
+  EXPECT_EQ(Decode(bad), 0);
+
+  // SEP type
+  bad = buf;
+  bad[4] = 2;
+  EXPECT_EQ(Decode(bad), 0);
+
+  // Codec capabilities length, and length of the codec element
+  bad = buf;
+  bad[10] = AVDT_CODEC_SIZE + 1;
+  EXPECT_EQ(Decode(bad), 0);
+  bad = buf;
+  bad[11] = kCodecInfoSbc[0] + 1;
+  EXPECT_EQ(Decode(bad), 0);
+
+  // Length of the content protection element
+  bad = buf;
+  bad[11 + sizeof(kCodecInfoSbc) + 1] = kProtectInfoScmsT[0] + 1;
+  EXPECT_EQ(Decode(bad), 0);
+}
+
+}  // namespace
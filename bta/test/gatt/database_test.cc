@@ -84,6 +84,53 @@ TEST(GattDatabaseTest, serialize_deserialize_binary_test) {
   EXPECT_EQ(serialized[4].type, SERVICE_1_CHAR_1_DESC_1_UUID);
 }
 
+/* This test makes sure that handle lookups find the same attributes as a walk
+ * of the service tree, also in copies and deserialized databases */
+TEST(GattDatabaseTest, handle_lookup_test) {
+  DatabaseBuilder builder;
+  builder.AddService(0x0001, 0x000f, SERVICE_1_UUID, true);
+  builder.AddService(0x0020, 0x002f, SERVICE_2_UUID, true);
+  builder.AddCharacteristic(0x0003, 0x0004, SERVICE_1_CHAR_1_UUID, 0x02);
+  builder.AddDescriptor(0x0005, SERVICE_1_CHAR_1_DESC_1_UUID);
+  builder.AddCharacteristic(0x0022, 0x0023, SERVICE_1_CHAR_1_UUID, 0x10);
+  builder.AddDescriptor(0x0024, SERVICE_1_CHAR_1_DESC_1_UUID);
+  builder.AddDescriptor(0x0025, SERVICE_1_CHAR_1_DESC_1_UUID);
+  Database built = builder.Build();
+
+  bool success = false;
+  Database copy = built;
+  Database deserialized = Database::Deserialize(built.Serialize(), &success);
+  ASSERT_TRUE(success);
+
+  for (const Database* db : {&built, &copy, &deserialized}) {
+    const Service& service_1 = db->Services().front();
+    const Service& service_2 = db->Services().back();
+    const Characteristic& char_2 = service_2.characteristics[0];
+
+    EXPECT_EQ(db->FindServiceForHandle(0x0001), &service_1);
+    EXPECT_EQ(db->FindServiceForHandle(0x000f), &service_1);
+    EXPECT_EQ(db->FindServiceForHandle(0x0010), nullptr);
+    EXPECT_EQ(db->FindServiceForHandle(0x0025), &service_2);
+    EXPECT_EQ(db->FindServiceForHandle(0x0030), nullptr);
+
+    EXPECT_EQ(db->FindCharacteristic(0x0004),
+              &service_1.characteristics[0]);
+    EXPECT_EQ(db->FindCharacteristic(0x0023), &char_2);
+    EXPECT_EQ(db->FindCharacteristic(0x0022), nullptr);
+
+    EXPECT_EQ(db->FindDescriptor(0x0005),
+              &service_1.characteristics[0].descriptors[0]);
+    EXPECT_EQ(db->FindDescriptor(0x0025), &char_2.descriptors[1]);
+    EXPECT_EQ(db->FindDescriptor(0x0023), nullptr);
+    EXPECT_EQ(db->FindOwningCharacteristic(0x0024), &char_2);
+    EXPECT_EQ(db->FindOwningCharacteristic(0x0026), nullptr);
+  }
+
+  built.Clear();
+  EXPECT_EQ(built.FindServiceForHandle(0x0001), nullptr);
+  EXPECT_EQ(built.FindCharacteristic(0x0004), nullptr);
+}
+
 /* This test makes sure that Service represented in StoredAttribute have proper
  * binary format. */
 TEST(GattCacheTest, stored_attribute_to_binary_service_test) {
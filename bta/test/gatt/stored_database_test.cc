@@ -0,0 +1,192 @@
+/******************************************************************************
+ *
+ *  Copyright 2020 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <stdio.h>
+#include <filesystem>
+
+#include "gatt/database_builder.h"
+#include "gatt/stored_database.h"
+#include "stack/include/gattdefs.h"
+
+using bluetooth::Uuid;
+
+namespace gatt {
+
+namespace {
+const Uuid CHARACTERISTIC = Uuid::From16Bit(GATT_UUID_CHAR_DECLARE);
+
+Uuid SERVICE_1_UUID = Uuid::FromString("1800");
+Uuid SERVICE_2_UUID = Uuid::FromString("1801");
+Uuid SERVICE_1_CHAR_1_UUID = Uuid::FromString("2a00");
+Uuid SERVICE_1_CHAR_1_DESC_1_UUID = Uuid::FromString("2902");
+Uuid SERVICE_1_CHAR_2_UUID = Uuid::FromString("2a01");
+Uuid SERVICE_1_CHAR_2_DESC_1_UUID = Uuid::FromString("2901");
+Uuid SERVICE_1_CHAR_2_DESC_2_UUID = Uuid::FromString("2902");
+Uuid SERVICE_2_CHAR_1_UUID = Uuid::FromString("2a05");
+
+const std::string kCacheFile =
+    std::filesystem::temp_directory_path() / "gatt_stored_database_test";
+
+Database BuildDatabase() {
+  DatabaseBuilder builder;
+  builder.AddService(0x0001, 0x000f, SERVICE_1_UUID, true);
+  builder.AddService(0x0010, 0x001f, SERVICE_2_UUID, false);
+  builder.AddIncludedService(0x0002, SERVICE_2_UUID, 0x0010, 0x001f);
+  builder.AddCharacteristic(0x0003, 0x0004, SERVICE_1_CHAR_1_UUID, 0x02);
+  builder.AddDescriptor(0x0005, SERVICE_1_CHAR_1_DESC_1_UUID);
+  builder.AddCharacteristic(0x0006, 0x0007, SERVICE_1_CHAR_2_UUID, 0x10);
+  builder.AddDescriptor(0x0008, SERVICE_1_CHAR_2_DESC_1_UUID);
+  builder.AddDescriptor(0x0009, SERVICE_1_CHAR_2_DESC_2_UUID);
+  builder.AddCharacteristic(0x0011, 0x0012, SERVICE_2_CHAR_1_UUID, 0x02);
+  return builder.Build();
+}
+
+class StoredDatabaseTest : public ::testing::Test {
+ protected:
+  void TearDown() override { std::filesystem::remove(kCacheFile); }
+};
+}  // namespace
+
+/* This test makes sure that a written database is loaded back unchanged, and
+ * that attributes can be looked up in the mapped file by handle */
+TEST_F(StoredDatabaseTest, write_open_test) {
+  Database db = BuildDatabase();
+  std::vector<StoredAttribute> serialized = db.Serialize();
+  ASSERT_TRUE(StoredDatabase::Write(kCacheFile, serialized));
+
+  std::unique_ptr<StoredDatabase> stored = StoredDatabase::Open(kCacheFile);
+  ASSERT_NE(stored, nullptr);
+  EXPECT_EQ(stored->Size(), serialized.size());
+  EXPECT_EQ(stored->Hash(),
+            StoredDatabase::Hash(serialized.data(), serialized.size()));
+
+  const StoredAttribute* attr = stored->Find(0x0003);
+  ASSERT_NE(attr, nullptr);
+  EXPECT_EQ(attr->type, CHARACTERISTIC);
+  EXPECT_EQ(attr->value.characteristic.value_handle, 0x0004);
+  EXPECT_EQ(attr->value.characteristic.uuid, SERVICE_1_CHAR_1_UUID);
+  ASSERT_NE(stored->Find(0x0010), nullptr);
+  EXPECT_EQ(stored->Find(0x0005)->type, SERVICE_1_CHAR_1_DESC_1_UUID);
+  EXPECT_EQ(stored->Find(0x0004), nullptr);
+  EXPECT_EQ(stored->Find(0x0020), nullptr);
+
+  bool success = false;
+  Database loaded = stored->ToDatabase(&success);
+  EXPECT_TRUE(success);
+  EXPECT_EQ(loaded.ToString(), db.ToString());
+}
+
+/* This test makes sure that the lookups done in the mapped file find the same
+ * attributes as the ones of the database, for every handle */
+TEST_F(StoredDatabaseTest, lookup_test) {
+  Database db = BuildDatabase();
+  ASSERT_TRUE(StoredDatabase::Write(kCacheFile, db.Serialize()));
+  std::unique_ptr<StoredDatabase> stored = StoredDatabase::Open(kCacheFile);
+  ASSERT_NE(stored, nullptr);
+
+  for (uint16_t handle = 0x0000; handle <= 0x0021; handle++) {
+    SCOPED_TRACE(handle);
+
+    const Service* service = db.FindServiceForHandle(handle);
+    const StoredAttribute* stored_service =
+        stored->FindServiceForHandle(handle);
+    ASSERT_EQ(service == nullptr, stored_service == nullptr);
+    if (service) {
+      EXPECT_EQ(stored_service->handle, service->handle);
+      EXPECT_EQ(stored_service->value.service.uuid, service->uuid);
+      EXPECT_EQ(stored_service->value.service.end_handle,
+                service->end_handle);
+    }
+
+    const Characteristic* charac = db.FindCharacteristic(handle);
+    const StoredAttribute* stored_charac = stored->FindCharacteristic(handle);
+    ASSERT_EQ(charac == nullptr, stored_charac == nullptr);
+    if (charac) {
+      EXPECT_EQ(stored_charac->handle, charac->declaration_handle);
+      EXPECT_EQ(stored_charac->value.characteristic.uuid, charac->uuid);
+      EXPECT_EQ(stored_charac->value.characteristic.properties,
+                charac->properties);
+
+      std::vector<const StoredAttribute*> descriptors =
+          stored->Descriptors(stored_charac);
+      ASSERT_EQ(descriptors.size(), charac->descriptors.size());
+      for (size_t i = 0; i < descriptors.size(); i++) {
+        EXPECT_EQ(descriptors[i]->handle, charac->descriptors[i].handle);
+        EXPECT_EQ(descriptors[i]->type, charac->descriptors[i].uuid);
+      }
+    }
+
+    const Characteristic* owner = db.FindOwningCharacteristic(handle);
+    const StoredAttribute* stored_owner =
+        stored->FindOwningCharacteristic(handle);
+    ASSERT_EQ(owner == nullptr, stored_owner == nullptr);
+    if (owner) EXPECT_EQ(stored_owner->handle, owner->declaration_handle);
+  }
+}
+
+/* This test makes sure that the hash covers the content of the attributes */
+TEST_F(StoredDatabaseTest, hash_test) {
+  std::vector<StoredAttribute> serialized = BuildDatabase().Serialize();
+  uint64_t hash = StoredDatabase::Hash(serialized.data(), serialized.size());
+
+  std::vector<StoredAttribute> changed = serialized;
+  changed[3].value.characteristic.properties = 0x0a;
+  EXPECT_NE(StoredDatabase::Hash(changed.data(), changed.size()), hash);
+
+  changed = serialized;
+  changed.pop_back();
+  EXPECT_NE(StoredDatabase::Hash(changed.data(), changed.size()), hash);
+}
+
+/* This test makes sure that truncated, corrupted, and old format files are
+ * rejected */
+TEST_F(StoredDatabaseTest, reject_invalid_file_test) {
+  EXPECT_EQ(StoredDatabase::Open(kCacheFile), nullptr);
+
+  std::vector<StoredAttribute> serialized = BuildDatabase().Serialize();
+  ASSERT_TRUE(StoredDatabase::Write(kCacheFile, serialized));
+  std::uintmax_t size = std::filesystem::file_size(kCacheFile);
+
+  // Change the end handle of the first service
+  StoredAttribute attr = serialized[0];
+  attr.value.service.end_handle = 0x000e;
+  FILE* fp = fopen(kCacheFile.c_str(), "r+b");
+  ASSERT_NE(fp, nullptr);
+  fseek(fp, size - serialized.size() * (sizeof(StoredAttribute) + 2),
+        SEEK_SET);
+  fwrite(&attr, sizeof(attr), 1, fp);
+  fclose(fp);
+  EXPECT_EQ(StoredDatabase::Open(kCacheFile), nullptr);
+
+  ASSERT_TRUE(StoredDatabase::Write(kCacheFile, serialized));
+  std::filesystem::resize_file(kCacheFile, size - 1);
+  EXPECT_EQ(StoredDatabase::Open(kCacheFile), nullptr);
+
+  // Version 5 files start with the version and the number of attributes
+  fp = fopen(kCacheFile.c_str(), "wb");
+  ASSERT_NE(fp, nullptr);
+  uint16_t header[2] = {5, static_cast<uint16_t>(serialized.size())};
+  fwrite(header, sizeof(header), 1, fp);
+  fwrite(serialized.data(), sizeof(StoredAttribute), serialized.size(), fp);
+  fclose(fp);
+  EXPECT_EQ(StoredDatabase::Open(kCacheFile), nullptr);
+}
+
+}  // namespace gatt
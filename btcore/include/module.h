@@ -58,6 +58,10 @@ void module_shut_down(const module_t* module);
 // If not initialized, does nothing.
 void module_clean_up(const module_t* module);
 
+// Dumps how long the modules took to start up and to shut down to the given
+// file descriptor |fd|.
+void module_dump(int fd);
+
 // Temporary callbacked wrapper for module start up, so real modules can be
 // spliced into the current janky startup sequence. Runs on a separate thread,
 // which terminates when the module start up has finished. When module startup
@@ -20,13 +20,17 @@
 
 #include <base/logging.h>
 #include <dlfcn.h>
+#include <inttypes.h>
 #include <string.h>
 
+#include <algorithm>
 #include <mutex>
 #include <unordered_map>
+#include <vector>
 
 #include "btcore/include/module.h"
 #include "common/message_loop_thread.h"
+#include "common/time_util.h"
 #include "osi/include/allocator.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
@@ -41,6 +45,15 @@ typedef enum {
 
 static std::unordered_map<const module_t*, module_state_t> metadata;
 
+typedef struct {
+  uint64_t start_up_begin_us;
+  uint64_t start_up_duration_us;
+  uint64_t shut_down_duration_us;
+} module_timing_t;
+
+// Guarded by |metadata_mutex|
+static std::unordered_map<const module_t*, module_timing_t> timings;
+
 // TODO(jamuraa): remove this lock after the startup sequence is clean
 static std::mutex metadata_mutex;
 
@@ -51,7 +64,9 @@ static void set_module_state(const module_t* module, module_state_t state);
 void module_management_start(void) {}
 
 void module_management_stop(void) {
+  std::lock_guard<std::mutex> lock(metadata_mutex);
   metadata.clear();
+  timings.clear();
 }
 
 const module_t* get_module(const char* name) {
@@ -85,12 +100,22 @@ bool module_start_up(const module_t* module) {
         module->init == NULL);
 
   LOG_INFO(LOG_TAG, "%s Starting module \"%s\"", __func__, module->name);
+  uint64_t begin_us = bluetooth::common::time_get_os_boottime_us();
   if (!call_lifecycle_function(module->start_up)) {
     LOG_ERROR(LOG_TAG, "%s Failed to start up module \"%s\"", __func__,
               module->name);
     return false;
   }
-  LOG_INFO(LOG_TAG, "%s Started module \"%s\"", __func__, module->name);
+  uint64_t duration_us =
+      bluetooth::common::time_get_os_boottime_us() - begin_us;
+  LOG_INFO(LOG_TAG, "%s Started module \"%s\" in %" PRIu64 " us", __func__,
+           module->name, duration_us);
+
+  {
+    std::lock_guard<std::mutex> lock(metadata_mutex);
+    timings[module].start_up_begin_us = begin_us;
+    timings[module].start_up_duration_us = duration_us;
+  }
 
   set_module_state(module, MODULE_STATE_STARTED);
   return true;
@@ -105,13 +130,22 @@ void module_shut_down(const module_t* module) {
   if (state < MODULE_STATE_STARTED) return;
 
   LOG_INFO(LOG_TAG, "%s Shutting down module \"%s\"", __func__, module->name);
+  uint64_t begin_us = bluetooth::common::time_get_os_boottime_us();
   if (!call_lifecycle_function(module->shut_down)) {
     LOG_ERROR(LOG_TAG,
               "%s Failed to shutdown module \"%s\". Continuing anyway.",
               __func__, module->name);
   }
-  LOG_INFO(LOG_TAG, "%s Shutdown of module \"%s\" completed", __func__,
-           module->name);
+  uint64_t duration_us =
+      bluetooth::common::time_get_os_boottime_us() - begin_us;
+  LOG_INFO(LOG_TAG,
+           "%s Shutdown of module \"%s\" completed in %" PRIu64 " us",
+           __func__, module->name, duration_us);
+
+  {
+    std::lock_guard<std::mutex> lock(metadata_mutex);
+    timings[module].shut_down_duration_us = duration_us;
+  }
 
   set_module_state(module, MODULE_STATE_INITIALIZED);
 }
@@ -135,6 +169,32 @@ void module_clean_up(const module_t* module) {
   set_module_state(module, MODULE_STATE_NONE);
 }
 
+void module_dump(int fd) {
+  std::vector<std::pair<const module_t*, module_timing_t>> sorted_timings;
+  {
+    std::lock_guard<std::mutex> lock(metadata_mutex);
+    sorted_timings.assign(timings.begin(), timings.end());
+  }
+  std::sort(sorted_timings.begin(), sorted_timings.end(),
+            [](const auto& a, const auto& b) {
+              return a.second.start_up_begin_us < b.second.start_up_begin_us;
+            });
+
+  // Modules start one after the other, so the whole sequence is the critical
+  // path
+  uint64_t total_start_up_us = 0;
+  dprintf(fd, "\nModule lifecycle timings:\n");
+  for (const auto& timing : sorted_timings) {
+    dprintf(fd,
+            "  %-32s start up %" PRIu64 " us, last shut down %" PRIu64
+            " us\n",
+            timing.first->name, timing.second.start_up_duration_us,
+            timing.second.shut_down_duration_us);
+    total_start_up_us += timing.second.start_up_duration_us;
+  }
+  dprintf(fd, "  Total start up %" PRIu64 " us\n", total_start_up_us);
+}
+
 static bool call_lifecycle_function(module_lifecycle_fn function) {
   // A NULL lifecycle function means it isn't needed, so assume success
   if (!function) return true;
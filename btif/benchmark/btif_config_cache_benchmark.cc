@@ -0,0 +1,173 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <base/logging.h>
+#include <benchmark/benchmark.h>
+#include <stdio.h>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "btif/include/btif_config_cache.h"
+#include "osi/include/config.h"
+
+using ::benchmark::State;
+
+namespace {
+
+const std::filesystem::path kConfigFile =
+    std::filesystem::temp_directory_path() / "btif_config_cache_bench.conf";
+constexpr size_t kCapacity = 100;
+
+// Keys read for every bonded device by btif_storage_load_bonded_devices
+const char* const kBondedDeviceKeys[] = {
+    "LinkKey",  "LinkKeyType", "PinLength", "DevType",
+    "AddrType", "Name",        "DevClass",  "Service",
+};
+
+std::string device_address(int index) {
+  char address[18];
+  snprintf(address, sizeof(address), "aa:bb:cc:%02x:%02x:%02x",
+           (index >> 16) & 0xff, (index >> 8) & 0xff, index & 0xff);
+  return address;
+}
+
+// Writes a config file holding the local sections and |num_devices| bonded
+// devices with about as many keys as a dual mode device has.
+void write_config(int num_devices) {
+  std::string contents =
+      "[Info]\n"
+      "FileSource = Empty\n"
+      "TimeCreated = 2020-01-01 00:00:00\n"
+      "\n"
+      "[Adapter]\n"
+      "Address = 01:02:03:04:05:06\n"
+      "Name = Benchmark\n"
+      "ScanMode = 0\n"
+      "DiscoveryTimeout = 120\n";
+  for (int i = 0; i < num_devices; i++) {
+    contents += "\n[" + device_address(i) + "]\n";
+    contents += "Name = Device " + std::to_string(i) + "\n";
+    contents +=
+        "DevClass = 2360324\n"
+        "DevType = 3\n"
+        "AddrType = 0\n"
+        "Timestamp = 1577836800\n"
+        "Manufacturer = 15\n"
+        "LmpVer = 9\n"
+        "LmpSubVer = 8720\n"
+        "Service = 0000110b-0000-1000-8000-00805f9b34fb "
+        "0000110e-0000-1000-8000-00805f9b34fb\n"
+        "LinkKeyType = 5\n"
+        "PinLength = 0\n"
+        "LinkKey = 0123456789abcdef0123456789abcdef\n"
+        "LE_KEY_PENC = 0123456789abcdef0123456789abcdef0123456789abcdef\n"
+        "LE_KEY_PID = 0123456789abcdef0123456789abcdef00aabbccddeeff\n"
+        "LE_KEY_LENC = 0123456789abcdef0123456789abcdef00000000\n";
+  }
+  FILE* fp = fopen(kConfigFile.c_str(), "wt");
+  CHECK(fp != nullptr);
+  CHECK_EQ(fwrite(contents.data(), 1, contents.size(), fp), contents.size());
+  fclose(fp);
+}
+
+std::unique_ptr<config_t> load_config() {
+  std::unique_ptr<config_t> config = config_new(kConfigFile.c_str());
+  CHECK(config != nullptr);
+  return config;
+}
+
+}  // namespace
+
+class BM_BtifConfigCache : public ::benchmark::Fixture {
+ protected:
+  void SetUp(State& st) override {
+    ::benchmark::Fixture::SetUp(st);
+    write_config(st.range(0));
+  }
+
+  void TearDown(State& st) override {
+    std::filesystem::remove(kConfigFile);
+    ::benchmark::Fixture::TearDown(st);
+  }
+};
+
+// Parses the config file and hands it to the cache, as btif_config_init does
+// on every stack start.
+BENCHMARK_DEFINE_F(BM_BtifConfigCache, load)(State& state) {
+  for (auto _ : state) {
+    BtifConfigCache cache(kCapacity);
+    cache.Init(load_config());
+    ::benchmark::DoNotOptimize(cache.HasPersistentSection("Adapter"));
+  }
+}
+
+BENCHMARK_REGISTER_F(BM_BtifConfigCache, load)->Arg(50)->Arg(500);
+
+// Reads the bonding information of every device, the way
+// btif_storage_load_bonded_devices does after the config is loaded.
+BENCHMARK_DEFINE_F(BM_BtifConfigCache, load_bonded_devices)(State& state) {
+  BtifConfigCache cache(kCapacity);
+  cache.Init(load_config());
+  std::vector<std::string> devices;
+  for (const section_t& section : cache.GetPersistentSections()) {
+    if (RawAddress::IsValidAddress(section.name)) {
+      devices.push_back(section.name);
+    }
+  }
+  CHECK_EQ(devices.size(), static_cast<size_t>(state.range(0)));
+
+  for (auto _ : state) {
+    for (const std::string& device : devices) {
+      for (const char* key : kBondedDeviceKeys) {
+        ::benchmark::DoNotOptimize(cache.GetString(device, key));
+      }
+    }
+  }
+  state.counters["lookups"] =
+      devices.size() * (sizeof(kBondedDeviceKeys) / sizeof(char*));
+}
+
+BENCHMARK_REGISTER_F(BM_BtifConfigCache, load_bonded_devices)
+    ->Arg(50)
+    ->Arg(500);
+
+// Updates a key of the most recently bonded device, as happens on each
+// connection.
+BENCHMARK_DEFINE_F(BM_BtifConfigCache, set_timestamp)(State& state) {
+  BtifConfigCache cache(kCapacity);
+  cache.Init(load_config());
+  const std::string device = device_address(state.range(0) - 1);
+  int timestamp = 0;
+  for (auto _ : state) {
+    cache.SetInt(device, "Timestamp", timestamp++);
+  }
+  CHECK_EQ(*cache.GetInt(device, "Timestamp"), timestamp - 1);
+}
+
+BENCHMARK_REGISTER_F(BM_BtifConfigCache, set_timestamp)->Arg(50)->Arg(500);
+
+int main(int argc, char** argv) {
+  // Disable LOG() output from libchrome
+  logging::LoggingSettings log_settings;
+  log_settings.logging_dest = logging::LoggingDestination::LOG_NONE;
+  CHECK(logging::InitLogging(log_settings)) << "Failed to set up logging";
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  ::benchmark::RunSpecifiedBenchmarks();
+}
@@ -23,6 +23,7 @@
  *
  ******************************************************************************/
 
+#include <memory>
 #include <mutex>
 
 #include <base/bind.h>
@@ -38,6 +39,7 @@
 #include "bta_av_co.h"
 #include "bta_sys.h"
 
+#include "btif_a2dp_source.h"
 #include "btif_av.h"
 #include "btif_av_co.h"
 #include "btif_util.h"
@@ -685,6 +687,23 @@ class BtaAvCo {
 
   bool ContentProtectEnabled() const { return content_protect_enabled_; }
 
+  /**
+   * Publish a new snapshot of the state the audio data path reads, after a
+   * change of the active peer or of its Content Protection. It must be called
+   * with |codec_lock_| held.
+   */
+  void UpdateSourceDataPathState();
+
+  // The state of the active peer read for each media packet. A snapshot is
+  // never modified once published: it is replaced as a whole with
+  // std::atomic_store(), so that the data path reads it with
+  // std::atomic_load() instead of waiting on |codec_lock_| while the codecs
+  // are negotiated or reconfigured.
+  struct SourceDataPathState {
+    bool content_protect_active;  // True if the packets carry the CP header
+    uint8_t content_protect_flag;  // Content Protect flag
+  };
+
   std::recursive_mutex codec_lock_;  // Protect access to the codec state
   std::vector<btav_a2dp_codec_config_t> codec_priorities_;  // Configured
   BtaAvCoPeer peers_[BTA_AV_NUM_STRS];     // Connected peer information
@@ -692,6 +711,7 @@ class BtaAvCo {
   uint8_t codec_config_[AVDT_CODEC_SIZE];  // Current codec configuration
   const bool content_protect_enabled_;     // True if Content Protect is enabled
   uint8_t content_protect_flag_;           // Content Protect flag
+  std::shared_ptr<const SourceDataPathState> source_data_path_state_;
 };
 
 // SCMS-T protect info
@@ -779,6 +799,18 @@ void BtaAvCo::Reset() {
     BtaAvCoPeer* p_peer = &peers_[i];
     p_peer->Reset(BTA_AV_CO_AUDIO_INDEX_TO_HANDLE(i));
   }
+
+  UpdateSourceDataPathState();
+}
+
+void BtaAvCo::UpdateSourceDataPathState() {
+  auto state = std::make_shared<SourceDataPathState>();
+  state->content_protect_active = ContentProtectEnabled() &&
+                                  (active_peer_ != nullptr) &&
+                                  active_peer_->ContentProtectActive();
+  state->content_protect_flag = ContentProtectFlag();
+  std::atomic_store(&source_data_path_state_,
+                    std::shared_ptr<const SourceDataPathState>(state));
 }
 
 bool BtaAvCo::IsSupportedCodec(btav_a2dp_codec_index_t codec_index) {
@@ -1300,9 +1332,11 @@ void BtaAvCo::ProcessOpen(tBTA_AV_HNDL bta_av_handle,
   p_peer->opened = true;
   p_peer->mtu = mtu;
 
+  std::lock_guard<std::recursive_mutex> lock(codec_lock_);
   // The first connected peer becomes the active peer
   if (active_peer_ == nullptr) {
     active_peer_ = p_peer;
+    UpdateSourceDataPathState();
   }
 }
 
@@ -1320,9 +1354,11 @@ void BtaAvCo::ProcessClose(tBTA_AV_HNDL bta_av_handle,
         __func__, bta_av_handle, peer_address.ToString().c_str());
     return;
   }
+  std::lock_guard<std::recursive_mutex> lock(codec_lock_);
   // Reset the active peer
   if (active_peer_ == p_peer) {
     active_peer_ = nullptr;
+    UpdateSourceDataPathState();
   }
   // Mark the peer closed and clean the peer info
   p_peer->Init(codec_priorities_);
@@ -1382,12 +1418,13 @@ BT_HDR* BtaAvCo::GetNextSourceDataPacket(const uint8_t* p_codec_info,
                      A2DP_GetCodecType(p_codec_info));
   }
 
-  if (ContentProtectEnabled() && (active_peer_ != nullptr) &&
-      active_peer_->ContentProtectActive()) {
+  std::shared_ptr<const SourceDataPathState> state =
+      std::atomic_load(&source_data_path_state_);
+  if (state->content_protect_active) {
     p_buf->len++;
     p_buf->offset--;
     uint8_t* p = (uint8_t*)(p_buf + 1) + p_buf->offset;
-    *p = ContentProtectFlag();
+    *p = state->content_protect_flag;
   }
 
   return p_buf;
@@ -1397,6 +1434,7 @@ void BtaAvCo::DataPacketWasDropped(tBTA_AV_HNDL bta_av_handle,
                                    const RawAddress& peer_address) {
   APPL_TRACE_ERROR("%s: peer %s dropped audio packet on handle 0x%x", __func__,
                    peer_address.ToString().c_str(), bta_av_handle);
+  btif_a2dp_source_on_congestion();
 }
 
 void BtaAvCo::ProcessAudioDelay(tBTA_AV_HNDL bta_av_handle,
@@ -1432,6 +1470,7 @@ bool BtaAvCo::SetActivePeer(const RawAddress& peer_address) {
     // Reset the active peer;
     active_peer_ = nullptr;
     memset(codec_config_, 0, sizeof(codec_config_));
+    UpdateSourceDataPathState();
     return true;
   }
 
@@ -1443,6 +1482,7 @@ bool BtaAvCo::SetActivePeer(const RawAddress& peer_address) {
 
   active_peer_ = p_peer;
   memcpy(codec_config_, active_peer_->codec_config, AVDT_CODEC_SIZE);
+  UpdateSourceDataPathState();
   LOG(INFO) << __func__ << ": codec = " << A2DP_CodecInfoString(codec_config_);
   // report the selected codec configuration of this new active peer.
   ReportSourceCodecState(active_peer_);
@@ -2007,6 +2047,7 @@ void BtaAvCo::SaveNewCodecConfig(BtaAvCoPeer* p_peer,
     bool cp_active = BtaAvCo::AudioProtectHasScmst(num_protect, p_protect_info);
     p_peer->SetContentProtectActive(cp_active);
   }
+  UpdateSourceDataPathState();
 }
 
 bool BtaAvCo::SetCodecOtaConfig(BtaAvCoPeer* p_peer,
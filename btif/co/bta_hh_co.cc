@@ -21,11 +21,11 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <linux/uhid.h>
-#include <pthread.h>
+#include <sched.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
-#include <sys/poll.h>
 #include <unistd.h>
 
 #include "bta_api.h"
@@ -34,6 +34,9 @@
 #include "btif_hh.h"
 #include "btif_util.h"
 #include "osi/include/osi.h"
+#include "osi/include/properties.h"
+#include "osi/include/reactor.h"
+#include "osi/include/thread.h"
 
 const char* dev_path = "/dev/uhid";
 
@@ -46,6 +49,17 @@ static tBTA_HH_RPT_CACHE_ENTRY sReportCache[BTA_HH_NV_LOAD_MAX];
 #define THREAD_NORMAL_PRIORITY 0
 #define BT_HH_THREAD "bt_hh_thread"
 
+/* Size of the type and size fields of a UHID_INPUT2 event */
+#define UHID_INPUT2_HDR_SIZE offsetof(struct uhid_event, u.input2.data)
+
+/* CPU the uhid I/O thread is pinned to, not pinned if unset or negative */
+#define BTIF_HH_IO_CPU_PROPERTY "persist.bluetooth.hh.io_cpu"
+/* SCHED_FIFO priority of the uhid I/O thread, SCHED_OTHER if unset or 0 */
+#define BTIF_HH_IO_RT_PRIORITY_PROPERTY "persist.bluetooth.hh.io_rt_priority"
+
+/* Thread reading the uhid events of all the HID devices */
+static thread_t* hh_io_thread = NULL;
+
 void uhid_set_non_blocking(int fd) {
   int opts = fcntl(fd, F_GETFL);
   if (opts < 0)
@@ -195,86 +209,140 @@ static int uhid_read_event(btif_hh_device_t* p_dev) {
 
 /*******************************************************************************
  *
- * Function create_thread
+ * Function btif_hh_io_thread_setup
  *
- * Description creat a select loop
+ * Description set the scheduling policy and the CPU affinity of the uhid I/O
+ *             thread, from the system properties
  *
- * Returns pthread_t
+ * Returns void
  *
  ******************************************************************************/
-static inline pthread_t create_thread(void* (*start_routine)(void*),
-                                      void* arg) {
-  APPL_TRACE_DEBUG("create_thread: entered");
-  pthread_attr_t thread_attr;
-
-  pthread_attr_init(&thread_attr);
-  pthread_attr_setdetachstate(&thread_attr, PTHREAD_CREATE_JOINABLE);
-  pthread_t thread_id = -1;
-  if (pthread_create(&thread_id, &thread_attr, start_routine, arg) != 0) {
-    APPL_TRACE_ERROR("pthread_create : %s", strerror(errno));
-    return -1;
+static void btif_hh_io_thread_setup(UNUSED_ATTR void* context) {
+  // This thread is created by bt_main_thread with RT priority. Lower the thread
+  // priority here unless an RT priority is configured.
+  int32_t rt_priority =
+      osi_property_get_int32(BTIF_HH_IO_RT_PRIORITY_PROPERTY, 0);
+  struct sched_param sched_params;
+  sched_params.sched_priority =
+      rt_priority > 0 ? rt_priority : THREAD_NORMAL_PRIORITY;
+  if (sched_setscheduler(gettid(), rt_priority > 0 ? SCHED_FIFO : SCHED_OTHER,
+                         &sched_params)) {
+    APPL_TRACE_ERROR("%s: Failed to set thread priority to %d: %s", __func__,
+                     rt_priority, strerror(errno));
+  }
+
+  int32_t cpu = osi_property_get_int32(BTIF_HH_IO_CPU_PROPERTY, -1);
+  if (cpu < 0) return;
+
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  CPU_SET(cpu, &cpu_set);
+  if (sched_setaffinity(gettid(), sizeof(cpu_set), &cpu_set)) {
+    APPL_TRACE_ERROR("%s: Failed to pin thread to CPU %d: %s", __func__, cpu,
+                     strerror(errno));
   }
-  APPL_TRACE_DEBUG("create_thread: thread created successfully");
-  return thread_id;
 }
 
 /*******************************************************************************
  *
- * Function btif_hh_poll_event_thread
+ * Function btif_hh_get_io_reactor
  *
- * Description the polling thread which polls for event from UHID driver
+ * Description get the reactor of the uhid I/O thread, which serves the uhid
+ *             devices of all the connected HID devices. The thread is started
+ *             by the first call.
  *
- * Returns void
+ * Returns reactor_t*, NULL if the thread can't be started
  *
  ******************************************************************************/
-static void* btif_hh_poll_event_thread(void* arg) {
-  btif_hh_device_t* p_dev = (btif_hh_device_t*)arg;
-  APPL_TRACE_DEBUG("%s: Thread created fd = %d", __func__, p_dev->fd);
-  struct pollfd pfds[1];
+static reactor_t* btif_hh_get_io_reactor(void) {
+  if (hh_io_thread == NULL) {
+    hh_io_thread = thread_new(BT_HH_THREAD);
+    if (hh_io_thread == NULL) {
+      APPL_TRACE_ERROR("%s: Failed to start the uhid I/O thread", __func__);
+      return NULL;
+    }
+    thread_post(hh_io_thread, btif_hh_io_thread_setup, NULL);
+  }
+  return thread_get_reactor(hh_io_thread);
+}
 
-  // This thread is created by bt_main_thread with RT priority. Lower the thread
-  // priority here since the tasks in this thread is not timing critical.
-  struct sched_param sched_params;
-  sched_params.sched_priority = THREAD_NORMAL_PRIORITY;
-  if (sched_setscheduler(gettid(), SCHED_OTHER, &sched_params)) {
-    APPL_TRACE_ERROR("%s: Failed to set thread priority to normal", __func__);
-    p_dev->hh_poll_thread_id = -1;
-    return 0;
+/*******************************************************************************
+ *
+ * Function btif_hh_uhid_read_ready
+ *
+ * Description called on the uhid I/O thread when the uhid device of a HID
+ *             device has an event to read
+ *
+ * Returns void
+ *
+ ******************************************************************************/
+static void btif_hh_uhid_read_ready(void* context) {
+  btif_hh_device_t* p_dev = (btif_hh_device_t*)context;
+
+  APPL_TRACE_DEBUG("%s: POLLIN", __func__);
+  if (uhid_read_event(p_dev) != 0) {
+    // Stop reading from this device, the registration is released when the
+    // device is closed.
+    reactor_change_registration(p_dev->uhid_reactor_object, NULL, NULL);
   }
-  pthread_setname_np(pthread_self(), BT_HH_THREAD);
+}
 
-  pfds[0].fd = p_dev->fd;
-  pfds[0].events = POLLIN;
+/*******************************************************************************
+ *
+ * Function btif_hh_start_uhid_polling
+ *
+ * Description start reading the events of the uhid device of |p_dev| on the
+ *             uhid I/O thread
+ *
+ * Returns void
+ *
+ ******************************************************************************/
+static void btif_hh_start_uhid_polling(btif_hh_device_t* p_dev) {
+  btif_hh_stop_uhid_polling(p_dev);
+
+  reactor_t* reactor = btif_hh_get_io_reactor();
+  if (reactor == NULL) return;
 
   // Set the uhid fd as non-blocking to ensure we never block the BTU thread
   uhid_set_non_blocking(p_dev->fd);
 
-  while (p_dev->hh_keep_polling) {
-    int ret;
-    OSI_NO_INTR(ret = poll(pfds, 1, 50));
-    if (ret < 0) {
-      APPL_TRACE_ERROR("%s: Cannot poll for fds: %s\n", __func__,
-                       strerror(errno));
-      break;
-    }
-    if (pfds[0].revents & POLLIN) {
-      APPL_TRACE_DEBUG("%s: POLLIN", __func__);
-      ret = uhid_read_event(p_dev);
-      if (ret != 0) break;
-    }
-  }
-
-  p_dev->hh_poll_thread_id = -1;
-  return 0;
+  p_dev->uhid_reactor_object = reactor_register(
+      reactor, p_dev->fd, p_dev, btif_hh_uhid_read_ready, NULL);
+  APPL_TRACE_DEBUG("%s: fd = %d", __func__, p_dev->fd);
 }
 
-static inline void btif_hh_close_poll_thread(btif_hh_device_t* p_dev) {
+/*******************************************************************************
+ *
+ * Function btif_hh_stop_uhid_polling
+ *
+ * Description stop reading the events of the uhid device of |p_dev|. When
+ *             this returns, the uhid I/O thread doesn't access |p_dev| anymore
+ *             and the uhid device can be closed.
+ *
+ * Returns void
+ *
+ ******************************************************************************/
+void btif_hh_stop_uhid_polling(btif_hh_device_t* p_dev) {
   APPL_TRACE_DEBUG("%s", __func__);
-  p_dev->hh_keep_polling = 0;
-  if (p_dev->hh_poll_thread_id > 0)
-    pthread_join(p_dev->hh_poll_thread_id, NULL);
+  if (p_dev->uhid_reactor_object == NULL) return;
 
-  return;
+  reactor_unregister(p_dev->uhid_reactor_object);
+  p_dev->uhid_reactor_object = NULL;
+}
+
+/*******************************************************************************
+ *
+ * Function btif_hh_free_io_thread
+ *
+ * Description stop the uhid I/O thread. The uhid devices must have been
+ *             unregistered with btif_hh_stop_uhid_polling() first.
+ *
+ * Returns void
+ *
+ ******************************************************************************/
+void btif_hh_free_io_thread(void) {
+  thread_free(hh_io_thread);
+  hh_io_thread = NULL;
 }
 
 void bta_hh_co_destroy(int fd) {
@@ -289,17 +357,34 @@ void bta_hh_co_destroy(int fd) {
 int bta_hh_co_write(int fd, uint8_t* rpt, uint16_t len) {
   APPL_TRACE_VERBOSE("%s: UHID write %d", __func__, len);
 
-  struct uhid_event ev;
-  memset(&ev, 0, sizeof(ev));
-  ev.type = UHID_INPUT;
-  ev.u.input.size = len;
-  if (len > sizeof(ev.u.input.data)) {
+  if (len > UHID_DATA_MAX) {
     APPL_TRACE_WARNING("%s: Report size greater than allowed size", __func__);
     return -1;
   }
-  memcpy(ev.u.input.data, rpt, len);
 
-  return uhid_write(fd, &ev);
+  // uhid handles one event per write() and a writev() is split into one
+  // write() per iovec, so the event must be contiguous. UHID_INPUT2 only needs
+  // the type, the size and the report instead of a full struct uhid_event.
+  uint8_t buf[UHID_INPUT2_HDR_SIZE + UHID_DATA_MAX];
+  struct uhid_event* ev = (struct uhid_event*)buf;
+  ev->type = UHID_INPUT2;
+  ev->u.input2.size = len;
+  memcpy(ev->u.input2.data, rpt, len);
+
+  ssize_t size = UHID_INPUT2_HDR_SIZE + len;
+  ssize_t ret;
+  OSI_NO_INTR(ret = write(fd, buf, size));
+  if (ret < 0) {
+    int rtn = -errno;
+    APPL_TRACE_ERROR("%s: Cannot write to uhid:%s", __func__, strerror(errno));
+    return rtn;
+  } else if (ret != size) {
+    APPL_TRACE_ERROR("%s: Wrong size written to uhid: %zd != %zd", __func__,
+                     ret, size);
+    return -EFAULT;
+  }
+
+  return 0;
 }
 
 /*******************************************************************************
@@ -343,9 +428,7 @@ void bta_hh_co_open(uint8_t dev_handle, uint8_t sub_class,
           APPL_TRACE_DEBUG("%s: uhid fd = %d", __func__, p_dev->fd);
       }
 
-      p_dev->hh_keep_polling = 1;
-      p_dev->hh_poll_thread_id =
-          create_thread(btif_hh_poll_event_thread, p_dev);
+      btif_hh_start_uhid_polling(p_dev);
       break;
     }
     p_dev = NULL;
@@ -371,9 +454,7 @@ void bta_hh_co_open(uint8_t dev_handle, uint8_t sub_class,
           return;
         } else {
           APPL_TRACE_DEBUG("%s: uhid fd = %d", __func__, p_dev->fd);
-          p_dev->hh_keep_polling = 1;
-          p_dev->hh_poll_thread_id =
-              create_thread(btif_hh_poll_event_thread, p_dev);
+          btif_hh_start_uhid_polling(p_dev);
         }
 
         break;
@@ -428,7 +509,7 @@ void bta_hh_co_close(uint8_t dev_handle, uint8_t app_id) {
           "%s: Found an existing device with the same handle "
           "dev_status = %d, dev_handle =%d",
           __func__, p_dev->dev_status, p_dev->dev_handle);
-      btif_hh_close_poll_thread(p_dev);
+      btif_hh_stop_uhid_polling(p_dev);
       break;
     }
   }
@@ -171,10 +171,12 @@ void bta_pan_co_tx_path(uint16_t handle, uint8_t app_id) {
     return;
   }
 
+  bool wrote = false;
   do {
     /* read next data buffer from pan */
     p_buf = bta_pan_ci_readbuf(handle, src, dst, &protocol, &ext, &forward);
     if (p_buf) {
+      wrote = true;
       BTIF_TRACE_DEBUG(
           "%s, calling btapp_tap_send, "
           "p_buf->len:%d, offset:%d",
@@ -191,6 +193,8 @@ void bta_pan_co_tx_path(uint16_t handle, uint8_t app_id) {
     }
 
   } while (p_buf != NULL);
+
+  if (wrote) btpan_cb.stats.tap_write_batches++;
 }
 
 /*******************************************************************************
@@ -92,8 +92,11 @@ tA2DP_CHANNEL_COUNT btif_a2dp_sink_get_channel_count(void);
 tA2DP_BITS_PER_SAMPLE btif_a2dp_sink_get_bits_per_sample(void);
 
 // Update the decoder for the A2DP Sink module.
-// |p_codec_info| contains the new codec information.
-void btif_a2dp_sink_update_decoder(const uint8_t* p_codec_info);
+// |p_codec_info| contains the new codec information of |peer_address|. It is
+// used right away if |peer_address| is the peer of the current session, or if
+// there is no session, and otherwise when the session of |peer_address| starts.
+void btif_a2dp_sink_update_decoder(const RawAddress& peer_address,
+                                   const uint8_t* p_codec_info);
 
 // Process 'idle' request from the BTIF state machine during initialization.
 void btif_a2dp_sink_on_idle(void);
@@ -117,8 +120,8 @@ bool btif_a2dp_sink_on_start(void);
 void btif_a2dp_sink_set_rx_flush(bool enable);
 
 // Enqueue a buffer to the A2DP Sink queue. If the queue has reached its
-// maximum size |MAX_INPUT_A2DP_FRAME_QUEUE_SZ|, the oldest buffer is
-// removed from the queue.
+// maximum size |MAX_INPUT_A2DP_FRAME_QUEUE_SZ|, or holds twice the audio
+// targeted by the jitter buffer, the oldest buffer is removed from the queue.
 // |p_buf| is the buffer to enqueue.
 // Returns the number of buffers in the Sink queue after the enqueing.
 uint8_t btif_a2dp_sink_enqueue_buf(BT_HDR* p_buf);
@@ -23,6 +23,7 @@
 #include <stdbool.h>
 #include <future>
 
+#include "a2dp_abr.h"
 #include "bta_av_api.h"
 
 // Initialize the A2DP Source module.
@@ -77,6 +78,10 @@ bool btif_a2dp_source_media_task_is_shutting_down(void);
 // Return true if the A2DP Source module is streaming.
 bool btif_a2dp_source_is_streaming(void);
 
+// Returns the interval (in milliseconds) the encoder of the current codec
+// reads its input audio data at, or 0 if no codec is set up.
+uint64_t btif_a2dp_source_get_encoder_interval_ms(void);
+
 // Process a request to start the A2DP audio encoding task.
 void btif_a2dp_source_start_audio_req(void);
 
@@ -121,6 +126,24 @@ void btif_a2dp_source_set_tx_flush(bool enable);
 // Returns the next A2DP buffer to send if available, otherwise NULL.
 BT_HDR* btif_a2dp_source_audio_readbuf(void);
 
+// Feed the Bluetooth Quality Report |link_quality| of the ACL link |handle|
+// to the adaptive bitrate of the encoder. Reports of other links than the one
+// of the streaming peer are ignored.
+void btif_a2dp_source_on_link_quality(
+    uint16_t handle, const tA2DP_ABR_LINK_QUALITY& link_quality);
+
+// Report media packets dropped because L2CAP doesn't keep up with them.
+void btif_a2dp_source_on_congestion(void);
+
+// Record that the controller started the hardware offload of the stream.
+void btif_a2dp_source_on_offload_started(void);
+
+// Move a started stream the controller could not offload to the software
+// encoding, without stopping the AVDTP stream.
+// Returns true if the stream falls back to the software encoding, otherwise
+// false.
+bool btif_a2dp_source_fallback_to_software(void);
+
 // Dump debug-related information for the A2DP Source module.
 // |fd| is the file descriptor to use for writing the ASCII formatted
 // information.
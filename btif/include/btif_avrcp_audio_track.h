@@ -49,7 +49,8 @@ void BtifAvrcpAudioTrackStart(void* handle);
 void BtifAvrcpAudioTrackPause(void* handle);
 
 /**
- * Sets audio track gain.
+ * Sets audio track gain, from 0 to 1. The gain is applied to the samples
+ * written after it, as they are converted to float.
  */
 void BtifAvrcpSetAudioTrackGain(void* handle, float gain);
 
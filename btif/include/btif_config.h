@@ -36,6 +36,7 @@ static const std::string BT_CONFIG_KEY_SDP_DI_HW_VERSION =
     "SdpDiHardwareVersion";
 static const std::string BT_CONFIG_KEY_SDP_DI_VENDOR_ID_SRC =
     "SdpDiVendorIdSource";
+static const std::string BT_CONFIG_KEY_SDP_DISC_CACHE = "SdpDiscoveryCache";
 
 static const std::string BT_CONFIG_KEY_REMOTE_VER_MFCT = "Manufacturer";
 static const std::string BT_CONFIG_KEY_REMOTE_VER_VER = "LmpVer";
@@ -66,6 +67,10 @@ size_t btif_config_get_bin_length(const std::string& section,
 
 const std::list<section_t>& btif_config_sections();
 
+// Fetches the stored encrypted keys from the keystore in one round trip, so
+// reading them with btif_config_get_bin() does not need one each.
+void btif_config_prefetch_encrypted_keys(void);
+
 void btif_config_save(void);
 void btif_config_flush(void);
 bool btif_config_clear(void);
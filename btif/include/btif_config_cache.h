@@ -16,10 +16,12 @@
 
 #pragma once
 
+#include <list>
 #include <map>
+#include <unordered_map>
 #include <unordered_set>
 
-#include "common/lru.h"
+#include "common/flat_lru.h"
 #include "osi/include/config.h"
 #include "osi/include/log.h"
 #include "raw_address.h"
@@ -55,6 +57,23 @@ class BtifConfigCache {
                               const std::string& key);
 
  private:
-  bluetooth::common::LruCache<std::string, section_t> unpaired_devices_cache_;
+  // Hash index over |paired_devices_list_|. The lists keep the order used to
+  // serialize the config file, the index gives constant time lookup of a
+  // section and of the entries in it. std::list iterators stay valid until
+  // the element they point to is erased.
+  struct PersistentSectionIndex {
+    std::list<section_t>::iterator section;
+    std::unordered_map<std::string, std::list<entry_t>::iterator> entries;
+  };
+
+  void IndexPersistentSection(std::list<section_t>::iterator section);
+  PersistentSectionIndex* FindPersistentSection(
+      const std::string& section_name);
+  void ErasePersistentSection(const std::string& section_name);
+
+  bluetooth::common::FlatLruCache<std::string, section_t>
+      unpaired_devices_cache_;
   config_t paired_devices_list_;
+  std::unordered_map<std::string, PersistentSectionIndex>
+      paired_devices_index_;
 };
@@ -18,6 +18,7 @@
 
 #pragma once
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #define BTSNOOZ_CURRENT_VERSION 0x02
@@ -37,8 +38,27 @@ typedef struct btsnooz_header_t {
   uint8_t type;
 } __attribute__((__packed__)) btsnooz_header_t;
 
+// Selects the packets written by btif_debug_btsnoop_export(). A packet has to
+// pass every enabled condition.
+typedef struct btsnoop_mem_filter_t {
+  // Only ACL packets of this connection handle
+  bool match_handle;
+  uint16_t handle;
+  // Only the first ACL fragments of L2CAP packets to this destination CID
+  bool match_cid;
+  uint16_t cid;
+  // Only packets captured within this window, in microseconds since the
+  // epoch. 0 leaves that end of the window open.
+  uint64_t start_timestamp_us;
+  uint64_t end_timestamp_us;
+} btsnoop_mem_filter_t;
+
 // Initializes btsnoop memory logging and registers
 void btif_debug_btsnoop_init(void);
 
 // Writes btsnoop data base64 encoded to fd
 void btif_debug_btsnoop_dump(int fd);
+
+// Writes the btsnoop data selected by |filter| to fd, in the same format as
+// btif_debug_btsnoop_dump(). Packets keep being captured meanwhile.
+void btif_debug_btsnoop_export(int fd, const btsnoop_mem_filter_t* filter);
@@ -0,0 +1,39 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <functional>
+
+// Heavy profile state, such as media worker threads, is constructed on first
+// use instead of during stack bring-up. The profiles register it when they are
+// initialized and construct it through btif_deferred_init_construct(), which
+// records what each construction cost so that dumpsys can report what
+// bring-up no longer pays for.
+
+// Registers |name| as deferred until its first use. |name| must outlive the
+// stack.
+void btif_deferred_init_register(const char* name);
+
+// Runs |construct| and records its duration and the growth of the resident
+// set size as the construction cost of |name|.
+void btif_deferred_init_construct(const char* name,
+                                  const std::function<void()>& construct);
+
+// Marks |name| as not constructed, after its state was torn down.
+void btif_deferred_init_release(const char* name);
+
+void btif_deferred_init_dump(int fd);
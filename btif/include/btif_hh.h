@@ -26,6 +26,7 @@
 #include "bta_hh_api.h"
 #include "btu.h"
 #include "osi/include/fixed_queue.h"
+#include "osi/include/reactor.h"
 
 /*******************************************************************************
  *  Constants & Macros
@@ -65,8 +66,7 @@ typedef struct {
   uint8_t app_id;
   int fd;
   bool ready_for_data;
-  pthread_t hh_poll_thread_id;
-  uint8_t hh_keep_polling;
+  reactor_object_t* uhid_reactor_object;
   alarm_t* vup_timer;
   fixed_queue_t* get_rpt_id_queue;
   uint8_t get_rpt_snt;
@@ -113,5 +113,7 @@ extern void btif_hh_getreport(btif_hh_device_t* p_dev,
                               bthh_report_type_t r_type, uint8_t reportId,
                               uint16_t bufferSize);
 extern void btif_hh_service_registration(bool enable);
+extern void btif_hh_stop_uhid_polling(btif_hh_device_t* p_dev);
+extern void btif_hh_free_io_thread(void);
 
 #endif
@@ -33,4 +33,12 @@ btpan_interface_t* btif_pan_interface();
 void btif_pan_init();
 void btif_pan_cleanup();
 
+/**
+ * Dump debug-related information for the BTIF PAN module.
+ *
+ * @param fd the file descriptor to use for writing the ASCII formatted
+ * information
+ */
+void btif_debug_pan_dump(int fd);
+
 #endif
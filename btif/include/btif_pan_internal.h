@@ -71,6 +71,18 @@ typedef struct {
   RawAddress eth_addr;
 } btpan_conn_t;
 
+// Traffic through the TAP interface, reported by btif_debug_pan_dump()
+typedef struct {
+  uint64_t tap_read_frames;    // Frames read from the TAP interface
+  uint64_t tap_read_bytes;
+  uint32_t tap_read_batches;   // Wakeups that read at least one frame
+  uint32_t tap_read_dropped;   // Frames dropped because BNEP was congested
+  uint64_t tap_write_frames;   // Frames written to the TAP interface
+  uint64_t tap_write_bytes;
+  uint32_t tap_write_batches;  // Wakeups that wrote at least one frame
+  uint32_t tap_write_errors;
+} btpan_stats_t;
+
 typedef struct {
   int btl_if_handle;
   int btl_if_handle_panu;
@@ -79,8 +91,7 @@ typedef struct {
   int open_count;
   int flow;  // 1: outbound data flow on; 0: outbound data flow off
   btpan_conn_t conns[MAX_PAN_CONNS];
-  int congest_packet_size;
-  unsigned char congest_packet[1600];  // max ethernet packet size
+  btpan_stats_t stats;
 } btpan_cb_t;
 
 /*******************************************************************************
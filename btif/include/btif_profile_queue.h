@@ -36,6 +36,14 @@ bt_status_t btif_queue_connect(uint16_t uuid, const RawAddress* bda,
 void btif_queue_cleanup(uint16_t uuid);
 void btif_queue_advance();
 
+/**
+ * Complete the connection request in progress for |uuid| to |bda|, and
+ * dispatch the next pending ones. Profiles that run concurrently with others
+ * to the same peer must use this instead of btif_queue_advance(), which
+ * completes the oldest request in progress.
+ */
+void btif_queue_advance_by_uuid(uint16_t uuid, const RawAddress* bda);
+
 /**
  * Dispatch the next pending connect request.
  * NOTE: Must be called on the JNI thread.
@@ -0,0 +1,79 @@
+/*
+ *  Copyright 2020 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <hardware/bluetooth.h>
+
+#include <memory>
+#include <vector>
+
+// Bump allocator for upcall data that is released all at once, like the
+// parameters of a batch of events crossing to the JNI thread or the property
+// arrays built from them. The chunks are kept across Reset(), so a steady
+// stream of upcalls doesn't allocate. Not thread safe.
+class BtifPropertyArena {
+ public:
+  static constexpr size_t kDefaultChunkSize = 4096;
+
+  explicit BtifPropertyArena(size_t chunk_size = kDefaultChunkSize);
+
+  // Returns |size| bytes aligned for any type, valid until Reset()
+  void* Alloc(size_t size);
+  void* Copy(const void* data, size_t size);
+
+  // Copies |num_properties| properties and their values
+  bt_property_t* CopyProperties(int num_properties,
+                                const bt_property_t* properties);
+
+  // Releases all the blocks at once
+  void Reset();
+
+  size_t BytesInUse() const { return bytes_in_use_; }
+  size_t ChunkCount() const { return chunks_.size(); }
+
+ private:
+  struct Chunk {
+    std::unique_ptr<uint8_t[]> data;
+    size_t size;
+  };
+
+  size_t chunk_size_;
+  std::vector<Chunk> chunks_;
+  size_t current_chunk_ = 0;
+  size_t offset_ = 0;
+  size_t bytes_in_use_ = 0;
+};
+
+// Builds a bt_property_t array whose values are copied into an arena, so the
+// sources of the values don't need to outlive the array
+class BtifPropertyBuilder {
+ public:
+  BtifPropertyBuilder(BtifPropertyArena* arena, int max_properties);
+
+  // Adds a property with a copy of the |len| bytes at |value|. Returns false
+  // if the builder is full.
+  bool Add(bt_property_type_t type, const void* value, int len);
+
+  bt_property_t* properties() const { return properties_; }
+  int size() const { return num_properties_; }
+
+ private:
+  BtifPropertyArena* arena_;
+  bt_property_t* properties_;
+  int max_properties_;
+  int num_properties_ = 0;
+};
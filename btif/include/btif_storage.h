@@ -274,6 +274,60 @@ bt_status_t btif_storage_get_remote_addr_type(const RawAddress* remote_bd_addr,
 bt_status_t btif_storage_set_remote_addr_type(const RawAddress* remote_bd_addr,
                                               uint8_t addr_type);
 
+/*******************************************************************************
+ *
+ * Function         btif_storage_stage_scanned_device
+ *
+ * Description      BTIF storage API - Stages the device type and address type
+ *                  of a device seen in an advertising report, in place of
+ *                  writing them to NVRAM for every report. Staged properties
+ *                  are written when they change, in a batch every
+ *                  BTIF_STORAGE_SCAN_STAGING_FLUSH_MS, and before they are
+ *                  read.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btif_storage_stage_scanned_device(const RawAddress& remote_bd_addr,
+                                       bt_device_type_t dev_type,
+                                       uint8_t addr_type);
+
+/*******************************************************************************
+ *
+ * Function         btif_storage_flush_scanned_device
+ *
+ * Description      BTIF storage API - Writes the staged properties of one
+ *                  scanned device to NVRAM, ahead of a bonding or connection
+ *                  that reads them
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btif_storage_flush_scanned_device(const RawAddress& remote_bd_addr);
+
+/*******************************************************************************
+ *
+ * Function         btif_storage_flush_scanned_devices
+ *
+ * Description      BTIF storage API - Writes the properties staged since the
+ *                  last flush to NVRAM
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btif_storage_flush_scanned_devices(void);
+
+/*******************************************************************************
+ *
+ * Function         btif_storage_scanned_devices_dump
+ *
+ * Description      Dumps the counters of the scanned device staging to |fd|
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btif_storage_scanned_devices_dump(int fd);
+
 /*******************************************************************************
  * Function         btif_storage_load_hidd
  *
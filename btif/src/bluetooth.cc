@@ -49,6 +49,9 @@
 #include "bt_utils.h"
 #include "bta/include/bta_hearing_aid_api.h"
 #include "bta/include/bta_hf_client_api.h"
+#include "bta/include/bta_hh_api.h"
+#include "bta/sys/bta_sys.h"
+#include "btcore/include/module.h"
 #include "btif/avrcp/avrcp_service.h"
 #include "btif_a2dp.h"
 #include "btif_api.h"
@@ -58,27 +61,46 @@
 #include "btif_debug.h"
 #include "btif_debug_btsnoop.h"
 #include "btif_debug_conn.h"
+#include "btif_deferred_init.h"
 #include "btif_hf.h"
+#include "btif_pan.h"
+#include "btif_sock_rfc.h"
 #include "btif_keystore.h"
 #include "btif_storage.h"
 #include "btsnoop.h"
 #include "btsnoop_mem.h"
 #include "common/address_obfuscator.h"
+#include "common/message_loop_thread.h"
 #include "common/metric_id_allocator.h"
 #include "common/metrics.h"
+#include "common/thread_scheduling.h"
+#include "common/trace.h"
 #include "device/include/interop.h"
+#include "hci/include/hci_layer.h"
+#include "hci/include/hci_replay.h"
 #include "main/shim/dumpsys.h"
 #include "main/shim/shim.h"
 #include "osi/include/alarm.h"
 #include "osi/include/allocation_tracker.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
+#include "osi/include/properties.h"
 #include "osi/include/wakelock.h"
 #include "stack/gatt/connection_manager.h"
+#include "stack/include/btm_api.h"
+#include "stack/include/btm_ble_api.h"
+#include "stack/include/btm_iso_api.h"
+#include "stack/include/btu.h"
+#include "stack/include/l2c_api.h"
+#include "stack/include/port_api.h"
+#include "stack/include/smp_api.h"
 #include "stack_manager.h"
 
 using bluetooth::hearing_aid::HearingAidInterface;
 
+/* Samples one in that many octets allocated by the stack, 0 to not sample */
+#define HEAP_SAMPLING_INTERVAL_PROPERTY "persist.bluetooth.heap_sampling_bytes"
+
 /*******************************************************************************
  *  Static variables
  ******************************************************************************/
@@ -157,6 +179,11 @@ static int init(bt_callbacks_t* callbacks, bool start_restricted,
 #ifdef BLUEDROID_DEBUG
   allocation_tracker_init();
 #endif
+  int32_t heap_sampling_interval =
+      osi_property_get_int32(HEAP_SAMPLING_INTERVAL_PROPERTY, 0);
+  if (heap_sampling_interval > 0) {
+    allocation_tracker_set_sampling_interval(heap_sampling_interval);
+  }
 
   bt_hal_cbacks = callbacks;
   restricted_mode = start_restricted;
@@ -335,16 +362,39 @@ static void dump(int fd, const char** arguments) {
   btif_debug_a2dp_dump(fd);
   btif_debug_av_dump(fd);
   bta_debug_av_dump(fd);
+  bta_debug_hh_dump(fd);
+  bta_sys_debug_dump(fd);
+  btif_debug_pan_dump(fd);
   stack_debug_avdtp_api_dump(fd);
+  stack_debug_l2cap_api_dump(fd);
+  stack_debug_rfcomm_api_dump(fd);
+  stack_debug_smp_api_dump(fd);
+  stack_debug_btm_ble_dump(fd);
+  stack_debug_btm_pm_dump(fd);
+  stack_debug_btm_rmt_name_dump(fd);
+  stack_debug_btm_iso_dump(fd);
+  stack_debug_btu_hcif_dump(fd);
+  hci_layer_debug_dump(fd);
+  hci_replay_debug_dump(fd);
+  stack_debug_btu_budget_dump(fd);
+  stack_debug_btu_footprint_dump(fd);
+  btsock_rfc_debug_dump(fd);
   bluetooth::avrcp::AvrcpService::DebugDump(fd);
   btif_debug_config_dump(fd);
+  btif_storage_scanned_devices_dump(fd);
   BTA_HfClientDumpStatistics(fd);
   wakelock_debug_dump(fd);
   osi_allocator_debug_dump(fd);
   alarm_debug_dump(fd);
+  bluetooth::common::TraceDebugDump(
+      fd, osi_property_get_bool("persist.bluetooth.trace.dump_spans", false));
+  bluetooth::common::MessageLoopThread::DebugDump(fd);
+  bluetooth::common::ThreadSchedulingDebugDump(fd);
   HearingAid::DebugDump(fd);
   connection_manager::dump(fd);
   bluetooth::bqr::DebugDump(fd);
+  module_dump(fd);
+  btif_deferred_init_dump(fd);
   if (bluetooth::shim::is_gd_shim_enabled()) {
     bluetooth::shim::Dump(fd);
   } else {
@@ -166,11 +166,22 @@ void btif_a2dp_on_offload_started(const RawAddress& peer_addr,
   if (btif_av_is_a2dp_offload_running()) {
     if (ack != BTA_AV_SUCCESS && btif_av_stream_started_ready()) {
       // Offload request will return with failure from btif_av sm if
-      // suspend is triggered for remote start. Disconnect only if SoC
-      // returned failure for offload VSC
+      // suspend is triggered for remote start. Fall back to the software
+      // encoding only if SoC returned failure for offload VSC, and disconnect
+      // if that isn't possible either. The audio HAL restarts the stream on
+      // the software session, no ack is due for the offload one.
+      if (btif_a2dp_source_fallback_to_software()) {
+        LOG_WARN(LOG_TAG,
+                 "%s: peer %s offload start failed, streaming with the "
+                 "software encoder",
+                 __func__, peer_addr.ToString().c_str());
+        return;
+      }
       LOG_ERROR(LOG_TAG, "%s: peer %s offload start failed", __func__,
                 peer_addr.ToString().c_str());
       btif_av_src_disconnect_sink(peer_addr);
+    } else if (ack == A2DP_CTRL_ACK_SUCCESS) {
+      btif_a2dp_source_on_offload_started();
     }
   }
   if (bluetooth::audio::a2dp::is_hal_2_0_enabled()) {
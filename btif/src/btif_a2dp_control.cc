@@ -284,6 +284,30 @@ static void btif_a2dp_recv_ctrl_data(void) {
       btif_av_stream_start_offload();
       break;
 
+    case A2DP_CTRL_GET_OUTPUT_BUFFER_SIZE: {
+      uint32_t buffer_size = 0;
+
+      A2dpCodecConfig* current_codec = bta_av_get_a2dp_current_codec();
+      if (current_codec != nullptr) {
+        btav_a2dp_codec_config_t codec_config =
+            current_codec->getCodecConfig();
+        buffer_size = audio_a2dp_hw_stream_compute_encoder_buffer_size(
+            codec_config.sample_rate, codec_config.bits_per_sample,
+            codec_config.channel_mode,
+            btif_a2dp_source_get_encoder_interval_ms());
+      }
+      // The audio data ring of the next stream holds the same: the HAL
+      // writes it no faster than the encoder drains it.
+      UIPC_Ioctl(*a2dp_uipc, UIPC_CH_ID_AV_AUDIO, UIPC_SET_RING_CAPACITY,
+                 (void*)(intptr_t)buffer_size);
+
+      btif_a2dp_command_ack(A2DP_CTRL_ACK_SUCCESS);
+      UIPC_Send(*a2dp_uipc, UIPC_CH_ID_AV_CTRL, 0,
+                reinterpret_cast<const uint8_t*>(&buffer_size),
+                sizeof(buffer_size));
+      break;
+    }
+
     case A2DP_CTRL_GET_PRESENTATION_POSITION: {
       btif_a2dp_command_ack(A2DP_CTRL_ACK_SUCCESS);
 
@@ -19,11 +19,14 @@
 
 #define LOG_TAG "bt_btif_a2dp_sink"
 
+#include <algorithm>
 #include <atomic>
 #include <cstdio>
 #include <cstring>
+#include <map>
 #include <mutex>
 #include <string>
+#include <vector>
 
 #include <base/bind.h>
 
@@ -33,11 +36,14 @@
 #include "btif_av.h"
 #include "btif_av_co.h"
 #include "btif_avrcp_audio_track.h"
+#include "btif_deferred_init.h"
 #include "btif_util.h"
 #include "common/message_loop_thread.h"
+#include "common/time_util.h"
 #include "osi/include/fixed_queue.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
+#include "osi/include/ringbuffer.h"
 
 using bluetooth::common::MessageLoopThread;
 using LockGuard = std::lock_guard<std::mutex>;
@@ -49,8 +55,25 @@ using LockGuard = std::lock_guard<std::mutex>;
 
 #define BTIF_SINK_MEDIA_TIME_TICK_MS 20
 
-/* In case of A2DP Sink, we will delay start by 5 AVDTP Packets */
-#define MAX_A2DP_DELAYED_START_FRAME_COUNT 5
+/* Bounds of the decode period, which follows the target buffer depth */
+#define BTIF_SINK_MIN_TICK_MS 10
+#define BTIF_SINK_MAX_TICK_MS 40
+
+/* The decode period is only changed by at least this much */
+#define BTIF_SINK_TICK_HYSTERESIS_MS 5
+
+/* Bounds of the target depth of the jitter buffer */
+#define BTIF_SINK_MIN_BUFFER_MS 60
+#define BTIF_SINK_MAX_BUFFER_MS 500
+
+/* The target depth is this many times the estimated jitter above the minimum */
+#define BTIF_SINK_JITTER_MULTIPLIER 4
+
+/* Decoded audio kept ahead of the audio track, in decode periods */
+#define BTIF_SINK_DECODE_AHEAD_TICKS 2
+
+/* Capacity of the ring of decoded audio */
+#define BTIF_SINK_PCM_RING_MS 200
 
 enum {
   BTIF_A2DP_SINK_STATE_OFF,
@@ -71,6 +94,7 @@ enum {
 
 typedef struct {
   BT_HDR hdr;
+  RawAddress peer_address;
   uint8_t codec_info[AVDT_CODEC_SIZE];
 } tBTIF_MEDIA_SINK_DECODER_UPDATE;
 
@@ -79,6 +103,130 @@ typedef struct {
   btif_a2dp_sink_focus_state_t focus_state;
 } tBTIF_MEDIA_SINK_FOCUS_UPDATE;
 
+// Adaptive jitter buffer of the received audio. The interarrival jitter is
+// estimated from the arrival times and the RTP timestamps of the packets, as
+// in RFC 3550, and the buffer depth targets a multiple of it.
+class BtifA2dpSinkJitterBuffer {
+ public:
+  BtifA2dpSinkJitterBuffer() {
+    Reset();
+    ResetStats();
+  }
+
+  // Resets the per stream state
+  void Reset() {
+    last_arrival_us = 0;
+    last_timestamp = 0;
+    jitter_us = 0;
+    packet_duration_us = 0;
+    buffering = true;
+    playout_start_us = 0;
+    frames_played = 0;
+  }
+
+  // Resets the per stream state, but keeps the estimates of the stream, so
+  // that it buffers to the right depth from its first packet when it plays
+  // again
+  void Restart() {
+    int64_t saved_jitter_us = jitter_us;
+    int64_t saved_packet_duration_us = packet_duration_us;
+    Reset();
+    jitter_us = saved_jitter_us;
+    packet_duration_us = saved_packet_duration_us;
+  }
+
+  void ResetStats() {
+    total_packets = 0;
+    overrun_count = 0;
+    underrun_count = 0;
+    pcm_overflow_count = 0;
+    max_jitter_us = 0;
+    total_latency_us = 0;
+    latency_samples = 0;
+    max_latency_us = 0;
+  }
+
+  // Updates the estimates with a packet of RTP timestamp |timestamp| that
+  // arrived at |arrival_us|.
+  void OnPacket(uint32_t timestamp, uint64_t arrival_us, uint32_t sample_rate) {
+    total_packets++;
+    if (last_arrival_us != 0 && sample_rate != 0) {
+      uint32_t delta_timestamp = timestamp - last_timestamp;
+      int64_t media_us = (int64_t)delta_timestamp * 1000000 / sample_rate;
+      // Skip discontinuities, e.g. when the source restarts its timestamps
+      if (delta_timestamp != 0 && media_us <= BTIF_SINK_MAX_BUFFER_MS * 1000) {
+        int64_t transit_delta_us =
+            (int64_t)(arrival_us - last_arrival_us) - media_us;
+        if (transit_delta_us < 0) transit_delta_us = -transit_delta_us;
+        jitter_us += (transit_delta_us - jitter_us) / 16;
+        if ((uint64_t)jitter_us > max_jitter_us) max_jitter_us = jitter_us;
+        packet_duration_us = (packet_duration_us == 0)
+                                 ? media_us
+                                 : packet_duration_us +
+                                       (media_us - packet_duration_us) / 8;
+      }
+    }
+    last_arrival_us = arrival_us;
+    last_timestamp = timestamp;
+  }
+
+  uint64_t TargetDepthUs() const {
+    uint64_t target_us = BTIF_SINK_MIN_BUFFER_MS * 1000 +
+                         BTIF_SINK_JITTER_MULTIPLIER * jitter_us;
+    return std::min<uint64_t>(target_us, BTIF_SINK_MAX_BUFFER_MS * 1000);
+  }
+
+  void OnLatencySample(uint64_t latency_us) {
+    total_latency_us += latency_us;
+    latency_samples++;
+    if (latency_us > max_latency_us) max_latency_us = latency_us;
+  }
+
+  // Arrival time (in us) and RTP timestamp of the last packet
+  uint64_t last_arrival_us;
+  uint32_t last_timestamp;
+
+  // Interarrival jitter estimate (in us)
+  int64_t jitter_us;
+
+  // Average media duration of a packet (in us)
+  int64_t packet_duration_us;
+
+  // True while waiting for the target depth before playing
+  bool buffering;
+
+  // Start of the playout (in us) and audio frames written since then
+  uint64_t playout_start_us;
+  uint64_t frames_played;
+
+  // Counter for received packets
+  size_t total_packets;
+
+  // Counter for packets dropped because the buffer was too deep
+  size_t overrun_count;
+
+  // Counter for playout interruptions because the buffer ran dry
+  size_t underrun_count;
+
+  // Counter for decoded audio dropped because the ring was full
+  size_t pcm_overflow_count;
+
+  // Max. interarrival jitter (in us)
+  uint64_t max_jitter_us;
+
+  // Accumulated, number of and max. buffered audio at playout (in us)
+  uint64_t total_latency_us;
+  size_t latency_samples;
+  uint64_t max_latency_us;
+};
+
+// Stream of a connected peer, while another peer is active: its codec
+// configuration and its jitter buffer, kept to switch back to it quickly.
+struct BtifA2dpSinkStream {
+  uint8_t codec_info[AVDT_CODEC_SIZE] = {};
+  BtifA2dpSinkJitterBuffer jitter_buffer;
+};
+
 /* BTIF A2DP Sink control block */
 class BtifA2dpSinkControlBlock {
  public:
@@ -87,11 +235,15 @@ class BtifA2dpSinkControlBlock {
         rx_audio_queue(nullptr),
         rx_flush(false),
         decode_alarm(nullptr),
+        decode_period_ms(BTIF_SINK_MEDIA_TIME_TICK_MS),
+        pcm_ring(nullptr),
         sample_rate(0),
         channel_count(0),
         rx_focus_state(BTIF_A2DP_SINK_FOCUS_NOT_GRANTED),
         audio_track(nullptr),
-        decoder_interface(nullptr) {}
+        decoder_interface(nullptr),
+        active_peer(RawAddress::kEmpty),
+        decoder_peer(RawAddress::kEmpty) {}
 
   void Reset() {
     if (audio_track != nullptr) {
@@ -103,23 +255,39 @@ class BtifA2dpSinkControlBlock {
     rx_audio_queue = nullptr;
     alarm_free(decode_alarm);
     decode_alarm = nullptr;
+    decode_period_ms = BTIF_SINK_MEDIA_TIME_TICK_MS;
+    ringbuffer_free(pcm_ring);
+    pcm_ring = nullptr;
+    pcm_buf.clear();
+    jitter_buffer.Reset();
+    jitter_buffer.ResetStats();
     rx_flush = false;
     rx_focus_state = BTIF_A2DP_SINK_FOCUS_NOT_GRANTED;
     sample_rate = 0;
     channel_count = 0;
     decoder_interface = nullptr;
+    active_peer = RawAddress::kEmpty;
+    decoder_peer = RawAddress::kEmpty;
+    streams.clear();
   }
 
   MessageLoopThread worker_thread;
   fixed_queue_t* rx_audio_queue;
   bool rx_flush; /* discards any incoming data when true */
   alarm_t* decode_alarm;
+  uint64_t decode_period_ms;
+  ringbuffer_t* pcm_ring; /* decoded audio waiting for the audio track */
+  std::vector<uint8_t> pcm_buf; /* decoded audio written to the audio track */
+  BtifA2dpSinkJitterBuffer jitter_buffer;
   tA2DP_SAMPLE_RATE sample_rate;
   tA2DP_BITS_PER_SAMPLE bits_per_sample;
   tA2DP_CHANNEL_COUNT channel_count;
   btif_a2dp_sink_focus_state_t rx_focus_state; /* audio focus state */
   void* audio_track;
   const tA2DP_DECODER_INTERFACE* decoder_interface;
+  RawAddress active_peer;  /* peer of the session, whose audio is played */
+  RawAddress decoder_peer; /* peer the decoder is configured for */
+  std::map<RawAddress, BtifA2dpSinkStream> streams;
 };
 
 // Mutex for below data structures.
@@ -127,13 +295,19 @@ static std::mutex g_mutex;
 
 static BtifA2dpSinkControlBlock btif_a2dp_sink_cb("bt_a2dp_sink_worker_thread");
 
+// Serializes the first use start up of the worker thread
+static std::mutex g_worker_thread_mutex;
+
+static constexpr char kA2dpSinkMediaTask[] = "A2DP Sink media task";
+
 static std::atomic<int> btif_a2dp_sink_state{BTIF_A2DP_SINK_STATE_OFF};
 
-static void btif_a2dp_sink_init_delayed();
+static bool btif_a2dp_sink_do_in_thread(const base::Location& from_here,
+                                        base::OnceClosure task);
 static void btif_a2dp_sink_startup_delayed();
 static void btif_a2dp_sink_start_session_delayed(
-    std::promise<void> peer_ready_promise);
-static void btif_a2dp_sink_end_session_delayed();
+    const RawAddress& peer_address, std::promise<void> peer_ready_promise);
+static void btif_a2dp_sink_end_session_delayed(const RawAddress& peer_address);
 static void btif_a2dp_sink_shutdown_delayed();
 static void btif_a2dp_sink_cleanup_delayed();
 static void btif_a2dp_sink_command_ready(BT_HDR* p_msg);
@@ -146,6 +320,9 @@ static void btif_a2dp_sink_audio_rx_flush_req();
 static void btif_a2dp_sink_handle_inc_media(BT_HDR* p_msg);
 static void btif_a2dp_sink_decoder_update_event(
     tBTIF_MEDIA_SINK_DECODER_UPDATE* p_buf);
+static void btif_a2dp_sink_configure_decoder(const RawAddress& peer_address,
+                                             const uint8_t* p_codec_info);
+static void btif_a2dp_sink_set_active_stream(const RawAddress& peer_address);
 static void btif_a2dp_sink_clear_track_event();
 static void btif_a2dp_sink_set_focus_state_event(
     btif_a2dp_sink_focus_state_t state);
@@ -153,6 +330,7 @@ static void btif_a2dp_sink_audio_rx_flush_event();
 static void btif_a2dp_sink_clear_track_event_req();
 static void btif_a2dp_sink_on_start_event();
 static void btif_a2dp_sink_on_suspend_event();
+static void btif_a2dp_sink_flush_buffers();
 
 UNUSED_ATTR static const char* dump_media_event(uint16_t event) {
   switch (event) {
@@ -178,36 +356,36 @@ bool btif_a2dp_sink_init() {
   }
 
   btif_a2dp_sink_cb.Reset();
-  btif_a2dp_sink_state = BTIF_A2DP_SINK_STATE_STARTING_UP;
-
-  /* Start A2DP Sink media task */
-  btif_a2dp_sink_cb.worker_thread.StartUp();
-  if (!btif_a2dp_sink_cb.worker_thread.IsRunning()) {
-    LOG_ERROR(LOG_TAG, "%s: unable to start up media thread", __func__);
-    btif_a2dp_sink_state = BTIF_A2DP_SINK_STATE_OFF;
-    return false;
-  }
-
   btif_a2dp_sink_cb.rx_audio_queue = fixed_queue_new(SIZE_MAX);
 
-  /* Schedule the rest of the operations */
-  if (!btif_a2dp_sink_cb.worker_thread.EnableRealTimeScheduling()) {
-    LOG(FATAL) << __func__
-               << ": Failed to increase A2DP decoder thread priority";
-  }
-  btif_a2dp_sink_cb.worker_thread.DoInThread(
-      FROM_HERE, base::BindOnce(btif_a2dp_sink_init_delayed));
+  /* The A2DP Sink media task is started when a task is first posted to it */
+  btif_deferred_init_register(kA2dpSinkMediaTask);
+  btif_a2dp_sink_state = BTIF_A2DP_SINK_STATE_RUNNING;
   return true;
 }
 
-static void btif_a2dp_sink_init_delayed() {
-  LOG_INFO(LOG_TAG, "%s", __func__);
-  btif_a2dp_sink_state = BTIF_A2DP_SINK_STATE_RUNNING;
+static bool btif_a2dp_sink_do_in_thread(const base::Location& from_here,
+                                        base::OnceClosure task) {
+  {
+    std::lock_guard<std::mutex> lock(g_worker_thread_mutex);
+    if (!btif_a2dp_sink_cb.worker_thread.IsRunning()) {
+      btif_deferred_init_construct(kA2dpSinkMediaTask, [] {
+        btif_a2dp_sink_cb.worker_thread.StartUp();
+        if (btif_a2dp_sink_cb.worker_thread.IsRunning() &&
+            !btif_a2dp_sink_cb.worker_thread.EnableRealTimeScheduling()) {
+          LOG(FATAL) << __func__
+                     << ": Failed to increase A2DP decoder thread priority";
+        }
+      });
+    }
+  }
+  return btif_a2dp_sink_cb.worker_thread.DoInThread(from_here,
+                                                    std::move(task));
 }
 
 bool btif_a2dp_sink_startup() {
   LOG_INFO(LOG_TAG, "%s", __func__);
-  btif_a2dp_sink_cb.worker_thread.DoInThread(
+  btif_a2dp_sink_do_in_thread(
       FROM_HERE, base::BindOnce(btif_a2dp_sink_startup_delayed));
   return true;
 }
@@ -221,9 +399,10 @@ static void btif_a2dp_sink_startup_delayed() {
 bool btif_a2dp_sink_start_session(const RawAddress& peer_address,
                                   std::promise<void> peer_ready_promise) {
   LOG(INFO) << __func__ << ": peer_address=" << peer_address;
-  if (btif_a2dp_sink_cb.worker_thread.DoInThread(
-          FROM_HERE, base::BindOnce(btif_a2dp_sink_start_session_delayed,
-                                    std::move(peer_ready_promise)))) {
+  if (btif_a2dp_sink_do_in_thread(
+          FROM_HERE,
+          base::BindOnce(btif_a2dp_sink_start_session_delayed, peer_address,
+                         std::move(peer_ready_promise)))) {
     return true;
   } else {
     // cannot set promise but triggers crash
@@ -234,11 +413,11 @@ bool btif_a2dp_sink_start_session(const RawAddress& peer_address,
 }
 
 static void btif_a2dp_sink_start_session_delayed(
-    std::promise<void> peer_ready_promise) {
-  LOG(INFO) << __func__;
+    const RawAddress& peer_address, std::promise<void> peer_ready_promise) {
+  LOG(INFO) << __func__ << ": peer_address=" << peer_address;
   LockGuard lock(g_mutex);
+  btif_a2dp_sink_set_active_stream(peer_address);
   peer_ready_promise.set_value();
-  // Nothing to do
 }
 
 bool btif_a2dp_sink_restart_session(const RawAddress& old_peer_address,
@@ -272,20 +451,27 @@ bool btif_a2dp_sink_restart_session(const RawAddress& old_peer_address,
 bool btif_a2dp_sink_end_session(const RawAddress& peer_address) {
   LOG_INFO(LOG_TAG, "%s: peer_address=%s", __func__,
            peer_address.ToString().c_str());
-  btif_a2dp_sink_cb.worker_thread.DoInThread(
-      FROM_HERE, base::BindOnce(btif_a2dp_sink_end_session_delayed));
+  btif_a2dp_sink_do_in_thread(
+      FROM_HERE,
+      base::BindOnce(btif_a2dp_sink_end_session_delayed, peer_address));
   return true;
 }
 
-static void btif_a2dp_sink_end_session_delayed() {
-  LOG_INFO(LOG_TAG, "%s", __func__);
+static void btif_a2dp_sink_end_session_delayed(const RawAddress& peer_address) {
+  LOG(INFO) << __func__ << ": peer_address=" << peer_address;
   LockGuard lock(g_mutex);
-  // Nothing to do
+  if (btif_a2dp_sink_cb.active_peer != peer_address) return;
+
+  // Keep the decoder and the audio track, the next session likely reuses them
+  btif_a2dp_sink_cb.streams[peer_address].jitter_buffer =
+      btif_a2dp_sink_cb.jitter_buffer;
+  btif_a2dp_sink_cb.active_peer = RawAddress::kEmpty;
 }
 
 void btif_a2dp_sink_shutdown() {
   LOG_INFO(LOG_TAG, "%s", __func__);
-  btif_a2dp_sink_cb.worker_thread.DoInThread(
+  if (!btif_a2dp_sink_cb.worker_thread.IsRunning()) return;
+  btif_a2dp_sink_do_in_thread(
       FROM_HERE, base::BindOnce(btif_a2dp_sink_shutdown_delayed));
 }
 
@@ -319,10 +505,17 @@ void btif_a2dp_sink_cleanup() {
   // Stop the timer
   alarm_free(decode_alarm);
 
+  // The media task is only started by its first use
+  if (!btif_a2dp_sink_cb.worker_thread.IsRunning()) {
+    btif_a2dp_sink_cleanup_delayed();
+    return;
+  }
+
   // Exit the thread
   btif_a2dp_sink_cb.worker_thread.DoInThread(
       FROM_HERE, base::BindOnce(btif_a2dp_sink_cleanup_delayed));
   btif_a2dp_sink_cb.worker_thread.ShutDown();
+  btif_deferred_init_release(kA2dpSinkMediaTask);
 }
 
 static void btif_a2dp_sink_cleanup_delayed() {
@@ -331,6 +524,11 @@ static void btif_a2dp_sink_cleanup_delayed() {
 
   fixed_queue_free(btif_a2dp_sink_cb.rx_audio_queue, nullptr);
   btif_a2dp_sink_cb.rx_audio_queue = nullptr;
+  ringbuffer_free(btif_a2dp_sink_cb.pcm_ring);
+  btif_a2dp_sink_cb.pcm_ring = nullptr;
+  btif_a2dp_sink_cb.active_peer = RawAddress::kEmpty;
+  btif_a2dp_sink_cb.decoder_peer = RawAddress::kEmpty;
+  btif_a2dp_sink_cb.streams.clear();
   btif_a2dp_sink_state = BTIF_A2DP_SINK_STATE_OFF;
 }
 
@@ -385,8 +583,9 @@ static void btif_a2dp_sink_command_ready(BT_HDR* p_msg) {
   LOG_VERBOSE(LOG_TAG, "%s: %s DONE", __func__, dump_media_event(p_msg->event));
 }
 
-void btif_a2dp_sink_update_decoder(const uint8_t* p_codec_info) {
-  LOG_INFO(LOG_TAG, "%s", __func__);
+void btif_a2dp_sink_update_decoder(const RawAddress& peer_address,
+                                   const uint8_t* p_codec_info) {
+  LOG(INFO) << __func__ << ": peer_address=" << peer_address;
   tBTIF_MEDIA_SINK_DECODER_UPDATE* p_buf =
       reinterpret_cast<tBTIF_MEDIA_SINK_DECODER_UPDATE*>(
           osi_malloc(sizeof(tBTIF_MEDIA_SINK_DECODER_UPDATE)));
@@ -395,10 +594,11 @@ void btif_a2dp_sink_update_decoder(const uint8_t* p_codec_info) {
                    p_codec_info[1], p_codec_info[2], p_codec_info[3],
                    p_codec_info[4], p_codec_info[5], p_codec_info[6]);
 
+  p_buf->peer_address = peer_address;
   memcpy(p_buf->codec_info, p_codec_info, AVDT_CODEC_SIZE);
   p_buf->hdr.event = BTIF_MEDIA_SINK_DECODER_UPDATE;
 
-  btif_a2dp_sink_cb.worker_thread.DoInThread(
+  btif_a2dp_sink_do_in_thread(
       FROM_HERE, base::BindOnce(btif_a2dp_sink_command_ready, (BT_HDR*)p_buf));
 }
 
@@ -406,7 +606,7 @@ void btif_a2dp_sink_on_idle() {
   LOG_INFO(LOG_TAG, "%s", __func__);
   BT_HDR* p_buf = reinterpret_cast<BT_HDR*>(osi_malloc(sizeof(BT_HDR)));
   p_buf->event = BTIF_MEDIA_SINK_SUSPEND;
-  btif_a2dp_sink_cb.worker_thread.DoInThread(
+  btif_a2dp_sink_do_in_thread(
       FROM_HERE, base::BindOnce(btif_a2dp_sink_command_ready, p_buf));
 
   if (btif_a2dp_sink_state == BTIF_A2DP_SINK_STATE_OFF) return;
@@ -418,7 +618,7 @@ void btif_a2dp_sink_on_stopped(UNUSED_ATTR tBTA_AV_SUSPEND* p_av_suspend) {
   LOG_INFO(LOG_TAG, "%s", __func__);
   BT_HDR* p_buf = reinterpret_cast<BT_HDR*>(osi_malloc(sizeof(BT_HDR)));
   p_buf->event = BTIF_MEDIA_SINK_SUSPEND;
-  btif_a2dp_sink_cb.worker_thread.DoInThread(
+  btif_a2dp_sink_do_in_thread(
       FROM_HERE, base::BindOnce(btif_a2dp_sink_command_ready, p_buf));
 
   if (btif_a2dp_sink_state == BTIF_A2DP_SINK_STATE_OFF) return;
@@ -429,7 +629,7 @@ void btif_a2dp_sink_on_suspended(UNUSED_ATTR tBTA_AV_SUSPEND* p_av_suspend) {
   LOG_INFO(LOG_TAG, "%s", __func__);
   BT_HDR* p_buf = reinterpret_cast<BT_HDR*>(osi_malloc(sizeof(BT_HDR)));
   p_buf->event = BTIF_MEDIA_SINK_SUSPEND;
-  btif_a2dp_sink_cb.worker_thread.DoInThread(
+  btif_a2dp_sink_do_in_thread(
       FROM_HERE, base::BindOnce(btif_a2dp_sink_command_ready, p_buf));
 
   if (btif_a2dp_sink_state == BTIF_A2DP_SINK_STATE_OFF) return;
@@ -441,7 +641,7 @@ bool btif_a2dp_sink_on_start() {
 
   BT_HDR* p_buf = reinterpret_cast<BT_HDR*>(osi_malloc(sizeof(BT_HDR)));
   p_buf->event = BTIF_MEDIA_SINK_START;
-  btif_a2dp_sink_cb.worker_thread.DoInThread(
+  btif_a2dp_sink_do_in_thread(
       FROM_HERE, base::BindOnce(btif_a2dp_sink_command_ready, p_buf));
 
   return true;
@@ -474,7 +674,7 @@ static void btif_a2dp_sink_audio_handle_stop_decoding() {
 
 static void btif_decode_alarm_cb(UNUSED_ATTR void* context) {
   LockGuard lock(g_mutex);
-  btif_a2dp_sink_cb.worker_thread.DoInThread(
+  btif_a2dp_sink_do_in_thread(
       FROM_HERE, base::BindOnce(btif_a2dp_sink_avk_handle_timer));
 }
 
@@ -504,15 +704,120 @@ static void btif_a2dp_sink_audio_handle_start_decoding() {
     LOG_ERROR(LOG_TAG, "%s: unable to allocate decode alarm", __func__);
     return;
   }
-  alarm_set(btif_a2dp_sink_cb.decode_alarm, BTIF_SINK_MEDIA_TIME_TICK_MS,
+  alarm_set(btif_a2dp_sink_cb.decode_alarm, btif_a2dp_sink_cb.decode_period_ms,
             btif_decode_alarm_cb, nullptr);
 }
 
+// Must be called while locked.
+static size_t btif_a2dp_sink_bytes_per_frame() {
+  return btif_a2dp_sink_cb.channel_count * btif_a2dp_sink_cb.bits_per_sample /
+         8;
+}
+
+// Returns the duration of the received audio, decoded or not (in us).
+// Must be called while locked.
+static uint64_t btif_a2dp_sink_buffered_us() {
+  uint64_t packet_duration_us =
+      btif_a2dp_sink_cb.jitter_buffer.packet_duration_us;
+  if (packet_duration_us == 0)
+    packet_duration_us = BTIF_SINK_MEDIA_TIME_TICK_MS * 1000;
+  uint64_t buffered_us =
+      fixed_queue_length(btif_a2dp_sink_cb.rx_audio_queue) * packet_duration_us;
+
+  size_t bytes_per_sec =
+      btif_a2dp_sink_cb.sample_rate * btif_a2dp_sink_bytes_per_frame();
+  if (btif_a2dp_sink_cb.pcm_ring != nullptr && bytes_per_sec != 0) {
+    buffered_us += (uint64_t)ringbuffer_size(btif_a2dp_sink_cb.pcm_ring) *
+                   1000000 / bytes_per_sec;
+  }
+  return buffered_us;
+}
+
+// Called by the decoder while locked.
 static void btif_a2dp_sink_on_decode_complete(uint8_t* data, uint32_t len) {
+  if (btif_a2dp_sink_cb.pcm_ring == nullptr) return;
+
+  if (ringbuffer_insert(btif_a2dp_sink_cb.pcm_ring, data, len) < len) {
+    btif_a2dp_sink_cb.jitter_buffer.pcm_overflow_count++;
+  }
+}
+
+// Decodes received packets until the decoded audio covers the next decode
+// periods. Must be called while locked.
+static void btif_a2dp_sink_decode_ahead() {
+  size_t ahead_bytes = btif_a2dp_sink_cb.sample_rate *
+                       btif_a2dp_sink_bytes_per_frame() / 1000 *
+                       btif_a2dp_sink_cb.decode_period_ms *
+                       BTIF_SINK_DECODE_AHEAD_TICKS;
+
+  while (ringbuffer_size(btif_a2dp_sink_cb.pcm_ring) < ahead_bytes) {
+    BT_HDR* p_msg =
+        (BT_HDR*)fixed_queue_try_dequeue(btif_a2dp_sink_cb.rx_audio_queue);
+    if (p_msg == NULL) break;
+    APPL_TRACE_DEBUG("%s: number of packets in queue %zu", __func__,
+                     fixed_queue_length(btif_a2dp_sink_cb.rx_audio_queue));
+
+    btif_a2dp_sink_handle_inc_media(p_msg);
+    osi_free(p_msg);
+  }
+}
+
+// Writes the decoded audio due since the start of the playout to the audio
+// track. Returns false if there wasn't enough of it. Must be called while
+// locked.
+static bool btif_a2dp_sink_feed_audio_track(uint64_t now_us) {
+  BtifA2dpSinkJitterBuffer& jitter_buffer = btif_a2dp_sink_cb.jitter_buffer;
+  size_t bytes_per_frame = btif_a2dp_sink_bytes_per_frame();
+
+  uint64_t frames_due = (now_us - jitter_buffer.playout_start_us) *
+                            btif_a2dp_sink_cb.sample_rate / 1000000 -
+                        jitter_buffer.frames_played;
+  size_t bytes_due = std::min<uint64_t>(frames_due * bytes_per_frame,
+                                        btif_a2dp_sink_cb.pcm_buf.size());
+  bytes_due -= bytes_due % bytes_per_frame;
+
+  size_t len = ringbuffer_pop(btif_a2dp_sink_cb.pcm_ring,
+                              btif_a2dp_sink_cb.pcm_buf.data(), bytes_due);
+  len -= len % bytes_per_frame;
 #ifndef OS_GENERIC
-  BtifAvrcpAudioTrackWriteData(btif_a2dp_sink_cb.audio_track,
-                               reinterpret_cast<void*>(data), len);
+  if (len > 0) {
+    BtifAvrcpAudioTrackWriteData(btif_a2dp_sink_cb.audio_track,
+                                 btif_a2dp_sink_cb.pcm_buf.data(), len);
+  }
 #endif
+  jitter_buffer.frames_played += len / bytes_per_frame;
+  return len == bytes_due;
+}
+
+// Follows the target buffer depth with the decode period: a deep buffer
+// is decoded in larger, less frequent batches. Must be called while locked.
+static void btif_a2dp_sink_update_decode_period() {
+  uint64_t period_ms =
+      btif_a2dp_sink_cb.jitter_buffer.TargetDepthUs() / 1000 / 4;
+  period_ms = std::max<uint64_t>(period_ms, BTIF_SINK_MIN_TICK_MS);
+  period_ms = std::min<uint64_t>(period_ms, BTIF_SINK_MAX_TICK_MS);
+
+  uint64_t current_ms = btif_a2dp_sink_cb.decode_period_ms;
+  uint64_t delta_ms = (period_ms > current_ms) ? period_ms - current_ms
+                                               : current_ms - period_ms;
+  if (delta_ms < BTIF_SINK_TICK_HYSTERESIS_MS) return;
+
+  APPL_TRACE_DEBUG("%s: decode period %llu -> %llu ms", __func__,
+                   (unsigned long long)current_ms,
+                   (unsigned long long)period_ms);
+  btif_a2dp_sink_cb.decode_period_ms = period_ms;
+  alarm_set(btif_a2dp_sink_cb.decode_alarm, period_ms, btif_decode_alarm_cb,
+            nullptr);
+}
+
+// Must be called while locked.
+static void btif_a2dp_sink_flush_buffers() {
+  fixed_queue_flush(btif_a2dp_sink_cb.rx_audio_queue, osi_free);
+  if (btif_a2dp_sink_cb.pcm_ring != nullptr) {
+    ringbuffer_delete(btif_a2dp_sink_cb.pcm_ring,
+                      ringbuffer_size(btif_a2dp_sink_cb.pcm_ring));
+  }
+  btif_a2dp_sink_cb.jitter_buffer.Reset();
 }
 
 // Must be called while locked.
@@ -532,12 +837,6 @@ static void btif_a2dp_sink_handle_inc_media(BT_HDR* p_msg) {
 static void btif_a2dp_sink_avk_handle_timer() {
   LockGuard lock(g_mutex);
 
-  BT_HDR* p_msg;
-  if (fixed_queue_is_empty(btif_a2dp_sink_cb.rx_audio_queue)) {
-    APPL_TRACE_DEBUG("%s: empty queue", __func__);
-    return;
-  }
-
   /* Don't do anything in case of focus not granted */
   if (btif_a2dp_sink_cb.rx_focus_state == BTIF_A2DP_SINK_FOCUS_NOT_GRANTED) {
     APPL_TRACE_DEBUG("%s: skipping frames since focus is not present",
@@ -546,23 +845,42 @@ static void btif_a2dp_sink_avk_handle_timer() {
   }
   /* Play only in BTIF_A2DP_SINK_FOCUS_GRANTED case */
   if (btif_a2dp_sink_cb.rx_flush) {
-    fixed_queue_flush(btif_a2dp_sink_cb.rx_audio_queue, osi_free);
+    btif_a2dp_sink_flush_buffers();
+    return;
+  }
+  if (btif_a2dp_sink_cb.pcm_ring == nullptr ||
+      btif_a2dp_sink_bytes_per_frame() == 0) {
+    APPL_TRACE_DEBUG("%s: decoder not configured", __func__);
     return;
   }
 
-  APPL_TRACE_DEBUG("%s: process frames begin", __func__);
-  while (true) {
-    p_msg = (BT_HDR*)fixed_queue_try_dequeue(btif_a2dp_sink_cb.rx_audio_queue);
-    if (p_msg == NULL) {
-      break;
+  BtifA2dpSinkJitterBuffer& jitter_buffer = btif_a2dp_sink_cb.jitter_buffer;
+  uint64_t now_us = bluetooth::common::time_get_os_boottime_us();
+  uint64_t buffered_us = btif_a2dp_sink_buffered_us();
+  if (jitter_buffer.buffering) {
+    if (buffered_us < jitter_buffer.TargetDepthUs()) {
+      APPL_TRACE_DEBUG("%s: buffering %llu us", __func__,
+                       (unsigned long long)buffered_us);
+      return;
     }
-    APPL_TRACE_DEBUG("%s: number of packets in queue %zu", __func__,
-                     fixed_queue_length(btif_a2dp_sink_cb.rx_audio_queue));
+    /* Start with one decode period of audio */
+    jitter_buffer.buffering = false;
+    jitter_buffer.playout_start_us =
+        now_us - btif_a2dp_sink_cb.decode_period_ms * 1000;
+    jitter_buffer.frames_played = 0;
+  }
+  jitter_buffer.OnLatencySample(buffered_us);
 
-    /* Queue packet has less frames */
-    btif_a2dp_sink_handle_inc_media(p_msg);
-    osi_free(p_msg);
+  APPL_TRACE_DEBUG("%s: process frames begin", __func__);
+  btif_a2dp_sink_decode_ahead();
+  if (!btif_a2dp_sink_feed_audio_track(now_us)) {
+    /* Ran dry: buffer up to the target depth again */
+    APPL_TRACE_WARNING("%s: underrun, %zu packets in queue", __func__,
+                       fixed_queue_length(btif_a2dp_sink_cb.rx_audio_queue));
+    jitter_buffer.underrun_count++;
+    jitter_buffer.buffering = true;
   }
+  btif_a2dp_sink_update_decode_period();
   APPL_TRACE_DEBUG("%s: process frames end", __func__);
 }
 
@@ -577,8 +895,8 @@ void btif_a2dp_sink_set_rx_flush(bool enable) {
 static void btif_a2dp_sink_audio_rx_flush_event() {
   LOG_INFO(LOG_TAG, "%s", __func__);
   LockGuard lock(g_mutex);
-  // Flush all received encoded audio buffers
-  fixed_queue_flush(btif_a2dp_sink_cb.rx_audio_queue, osi_free);
+  // Flush all received audio buffers
+  btif_a2dp_sink_flush_buffers();
 }
 
 static void btif_a2dp_sink_decoder_update_event(
@@ -590,33 +908,67 @@ static void btif_a2dp_sink_decoder_update_event(
                    p_buf->codec_info[3], p_buf->codec_info[4],
                    p_buf->codec_info[5], p_buf->codec_info[6]);
 
-  int sample_rate = A2DP_GetTrackSampleRate(p_buf->codec_info);
+  BtifA2dpSinkStream& stream = btif_a2dp_sink_cb.streams[p_buf->peer_address];
+  memcpy(stream.codec_info, p_buf->codec_info, AVDT_CODEC_SIZE);
+
+  // Another peer connecting must not reconfigure the decoder of the stream
+  // being played: its configuration is used when its session starts.
+  if (!btif_a2dp_sink_cb.active_peer.IsEmpty() &&
+      btif_a2dp_sink_cb.active_peer != p_buf->peer_address) {
+    LOG(INFO) << __func__ << ": keeping the codec configuration of "
+              << p_buf->peer_address << " until it is active";
+    return;
+  }
+  btif_a2dp_sink_configure_decoder(p_buf->peer_address, p_buf->codec_info);
+}
+
+// Configures the decoder and the audio track for |p_codec_info|, the codec
+// configuration of |peer_address|. The audio track is kept when the format of
+// the decoded audio does not change, so that switching between peers
+// streaming the same format doesn't wait for a new track. Must be called while
+// locked.
+static void btif_a2dp_sink_configure_decoder(const RawAddress& peer_address,
+                                             const uint8_t* p_codec_info) {
+  int sample_rate = A2DP_GetTrackSampleRate(p_codec_info);
   if (sample_rate == -1) {
     LOG_ERROR(LOG_TAG, "%s: cannot get the track frequency", __func__);
     return;
   }
-  int bits_per_sample = A2DP_GetTrackBitsPerSample(p_buf->codec_info);
+  int bits_per_sample = A2DP_GetTrackBitsPerSample(p_codec_info);
   if (bits_per_sample == -1) {
     LOG_ERROR(LOG_TAG, "%s: cannot get the bits per sample", __func__);
     return;
   }
-  int channel_count = A2DP_GetTrackChannelCount(p_buf->codec_info);
+  int channel_count = A2DP_GetTrackChannelCount(p_codec_info);
   if (channel_count == -1) {
     LOG_ERROR(LOG_TAG, "%s: cannot get the channel count", __func__);
     return;
   }
-  int channel_type = A2DP_GetSinkTrackChannelType(p_buf->codec_info);
+  int channel_type = A2DP_GetSinkTrackChannelType(p_codec_info);
   if (channel_type == -1) {
     LOG_ERROR(LOG_TAG, "%s: cannot get the Sink channel type", __func__);
     return;
   }
+  bool same_format = (btif_a2dp_sink_cb.audio_track != nullptr) &&
+                     (btif_a2dp_sink_cb.sample_rate ==
+                      static_cast<tA2DP_SAMPLE_RATE>(sample_rate)) &&
+                     (btif_a2dp_sink_cb.bits_per_sample == bits_per_sample) &&
+                     (btif_a2dp_sink_cb.channel_count == channel_count);
   btif_a2dp_sink_cb.sample_rate = sample_rate;
   btif_a2dp_sink_cb.bits_per_sample = bits_per_sample;
   btif_a2dp_sink_cb.channel_count = channel_count;
 
+  size_t pcm_ring_size = sample_rate * btif_a2dp_sink_bytes_per_frame() / 1000 *
+                         BTIF_SINK_PCM_RING_MS;
+  ringbuffer_free(btif_a2dp_sink_cb.pcm_ring);
+  btif_a2dp_sink_cb.pcm_ring = ringbuffer_init(pcm_ring_size);
+  btif_a2dp_sink_cb.pcm_buf.resize(pcm_ring_size);
+  btif_a2dp_sink_cb.jitter_buffer.Restart();
+
   btif_a2dp_sink_cb.rx_flush = false;
   APPL_TRACE_DEBUG("%s: reset to Sink role", __func__);
 
+  btif_a2dp_sink_cb.decoder_peer = RawAddress::kEmpty;
   btif_a2dp_sink_cb.decoder_interface = bta_av_co_get_decoder_interface();
   if (btif_a2dp_sink_cb.decoder_interface == nullptr) {
     LOG_ERROR(LOG_TAG, "%s: cannot stream audio: no source decoder interface",
@@ -631,9 +983,21 @@ static void btif_a2dp_sink_decoder_update_event(
   }
 
   if (btif_a2dp_sink_cb.decoder_interface->decoder_configure != nullptr) {
-    btif_a2dp_sink_cb.decoder_interface->decoder_configure(p_buf->codec_info);
+    btif_a2dp_sink_cb.decoder_interface->decoder_configure(p_codec_info);
+  }
+  btif_a2dp_sink_cb.decoder_peer = peer_address;
+
+  if (same_format) {
+    APPL_TRACE_DEBUG("%s: reuse audio track", __func__);
+    return;
   }
 
+#ifndef OS_GENERIC
+  if (btif_a2dp_sink_cb.audio_track != nullptr) {
+    BtifAvrcpAudioTrackStop(btif_a2dp_sink_cb.audio_track);
+    BtifAvrcpAudioTrackDelete(btif_a2dp_sink_cb.audio_track);
+  }
+#endif
   APPL_TRACE_DEBUG("%s: create audio track", __func__);
   btif_a2dp_sink_cb.audio_track =
 #ifndef OS_GENERIC
@@ -645,6 +1009,47 @@ static void btif_a2dp_sink_decoder_update_event(
     LOG_ERROR(LOG_TAG, "%s: track creation failed", __func__);
     return;
   }
+#ifndef OS_GENERIC
+  // The new track replaces one that was playing
+  if (btif_a2dp_sink_cb.decode_alarm != nullptr) {
+    BtifAvrcpAudioTrackStart(btif_a2dp_sink_cb.audio_track);
+  }
+#endif
+}
+
+// Switches the sink to the stream of |peer_address|: the audio of the previous
+// peer is dropped, its jitter buffer is kept for when it is active again, and
+// the decoder is configured from the codec configuration of the new peer
+// received when it connected. Must be called while locked.
+static void btif_a2dp_sink_set_active_stream(const RawAddress& peer_address) {
+  if (btif_a2dp_sink_cb.active_peer == peer_address) return;
+
+  RawAddress old_peer_address = btif_a2dp_sink_cb.active_peer;
+  btif_a2dp_sink_cb.active_peer = peer_address;
+  // Nothing to switch from if the decoder was configured for this peer before
+  // its session started
+  if (old_peer_address.IsEmpty() &&
+      btif_a2dp_sink_cb.decoder_peer == peer_address)
+    return;
+
+  LOG(INFO) << __func__ << ": " << old_peer_address << " -> " << peer_address;
+  if (!old_peer_address.IsEmpty()) {
+    btif_a2dp_sink_cb.streams[old_peer_address].jitter_buffer =
+        btif_a2dp_sink_cb.jitter_buffer;
+  }
+  btif_a2dp_sink_flush_buffers();
+
+  auto stream = btif_a2dp_sink_cb.streams.find(peer_address);
+  if (stream == btif_a2dp_sink_cb.streams.end()) {
+    // Configured by the first decoder update of the peer
+    btif_a2dp_sink_cb.jitter_buffer = BtifA2dpSinkJitterBuffer();
+    return;
+  }
+  btif_a2dp_sink_cb.jitter_buffer = stream->second.jitter_buffer;
+  btif_a2dp_sink_cb.jitter_buffer.Restart();
+  if (btif_a2dp_sink_cb.decoder_peer != peer_address) {
+    btif_a2dp_sink_configure_decoder(peer_address, stream->second.codec_info);
+  }
 }
 
 uint8_t btif_a2dp_sink_enqueue_buf(BT_HDR* p_pkt) {
@@ -652,11 +1057,18 @@ uint8_t btif_a2dp_sink_enqueue_buf(BT_HDR* p_pkt) {
   if (btif_a2dp_sink_cb.rx_flush) /* Flush enabled, do not enqueue */
     return fixed_queue_length(btif_a2dp_sink_cb.rx_audio_queue);
 
-  if (fixed_queue_length(btif_a2dp_sink_cb.rx_audio_queue) ==
-      MAX_INPUT_A2DP_FRAME_QUEUE_SZ) {
-    uint8_t ret = fixed_queue_length(btif_a2dp_sink_cb.rx_audio_queue);
+  BtifA2dpSinkJitterBuffer& jitter_buffer = btif_a2dp_sink_cb.jitter_buffer;
+  jitter_buffer.OnPacket(BTA_AvGetSinkMediaTimestamp(p_pkt),
+                         bluetooth::common::time_get_os_boottime_us(),
+                         btif_a2dp_sink_cb.sample_rate);
+
+  /* Drop the oldest packet when the queue is full or the buffer is
+   * much deeper than needed, e.g. after the source clock drifted */
+  if ((fixed_queue_length(btif_a2dp_sink_cb.rx_audio_queue) ==
+       MAX_INPUT_A2DP_FRAME_QUEUE_SZ) ||
+      (btif_a2dp_sink_buffered_us() > 2 * jitter_buffer.TargetDepthUs())) {
+    jitter_buffer.overrun_count++;
     osi_free(fixed_queue_try_dequeue(btif_a2dp_sink_cb.rx_audio_queue));
-    return ret;
   }
 
   BTIF_TRACE_VERBOSE("%s +", __func__);
@@ -667,8 +1079,8 @@ uint8_t btif_a2dp_sink_enqueue_buf(BT_HDR* p_pkt) {
   p_msg->offset = 0;
   memcpy(p_msg->data, p_pkt->data + p_pkt->offset, p_pkt->len);
   fixed_queue_enqueue(btif_a2dp_sink_cb.rx_audio_queue, p_msg);
-  if (fixed_queue_length(btif_a2dp_sink_cb.rx_audio_queue) ==
-      MAX_A2DP_DELAYED_START_FRAME_COUNT) {
+  if ((btif_a2dp_sink_cb.decode_alarm == nullptr) &&
+      (btif_a2dp_sink_buffered_us() >= jitter_buffer.TargetDepthUs())) {
     BTIF_TRACE_DEBUG("%s: Initiate decoding", __func__);
     btif_a2dp_sink_audio_handle_start_decoding();
   }
@@ -685,12 +1097,77 @@ void btif_a2dp_sink_audio_rx_flush_req() {
 
   BT_HDR* p_buf = reinterpret_cast<BT_HDR*>(osi_malloc(sizeof(BT_HDR)));
   p_buf->event = BTIF_MEDIA_SINK_AUDIO_RX_FLUSH;
-  btif_a2dp_sink_cb.worker_thread.DoInThread(
+  btif_a2dp_sink_do_in_thread(
       FROM_HERE, base::BindOnce(btif_a2dp_sink_command_ready, p_buf));
 }
 
-void btif_a2dp_sink_debug_dump(UNUSED_ATTR int fd) {
-  // Nothing to do
+void btif_a2dp_sink_debug_dump(int fd) {
+  LockGuard lock(g_mutex);
+  const BtifA2dpSinkJitterBuffer& jitter_buffer =
+      btif_a2dp_sink_cb.jitter_buffer;
+
+  dprintf(fd, "\nA2DP Sink State: %s\n",
+          (btif_a2dp_sink_cb.decode_alarm == nullptr)
+              ? "stopped"
+              : (jitter_buffer.buffering ? "buffering" : "playing"));
+  dprintf(fd, "  Jitter buffer:\n");
+  dprintf(fd,
+          "  Depth / target in ms                                    : %llu / "
+          "%llu\n",
+          (unsigned long long)btif_a2dp_sink_buffered_us() / 1000,
+          (unsigned long long)jitter_buffer.TargetDepthUs() / 1000);
+  dprintf(fd,
+          "  Jitter (current/max) in ms                              : %llu / "
+          "%llu\n",
+          (unsigned long long)jitter_buffer.jitter_us / 1000,
+          (unsigned long long)jitter_buffer.max_jitter_us / 1000);
+  dprintf(fd,
+          "  Latency (average/max) in ms                             : %llu / "
+          "%llu\n",
+          (jitter_buffer.latency_samples > 0)
+              ? (unsigned long long)(jitter_buffer.total_latency_us /
+                                     jitter_buffer.latency_samples / 1000)
+              : 0,
+          (unsigned long long)jitter_buffer.max_latency_us / 1000);
+  dprintf(fd,
+          "  Decode period in ms                                     : %llu\n",
+          (unsigned long long)btif_a2dp_sink_cb.decode_period_ms);
+  dprintf(fd,
+          "  Counts (packets/overruns/underruns/decoded overflows)   : %zu / "
+          "%zu / %zu / %zu\n",
+          jitter_buffer.total_packets, jitter_buffer.overrun_count,
+          jitter_buffer.underrun_count, jitter_buffer.pcm_overflow_count);
+
+  for (const auto& entry : btif_a2dp_sink_cb.streams) {
+    const RawAddress& peer_address = entry.first;
+    bool active = (peer_address == btif_a2dp_sink_cb.active_peer);
+    // The jitter buffer of the active stream is the one in use
+    const BtifA2dpSinkJitterBuffer& stream_jitter_buffer =
+        active ? jitter_buffer : entry.second.jitter_buffer;
+    dprintf(fd, "  Stream of %s (%s)%s:\n", peer_address.ToString().c_str(),
+            A2DP_CodecName(entry.second.codec_info), active ? " active" : "");
+    dprintf(fd,
+            "    Jitter (current/max) in ms                            : %llu "
+            "/ %llu\n",
+            (unsigned long long)stream_jitter_buffer.jitter_us / 1000,
+            (unsigned long long)stream_jitter_buffer.max_jitter_us / 1000);
+    dprintf(fd,
+            "    Latency (average/max) in ms                           : %llu "
+            "/ %llu\n",
+            (stream_jitter_buffer.latency_samples > 0)
+                ? (unsigned long long)(stream_jitter_buffer.total_latency_us /
+                                       stream_jitter_buffer.latency_samples /
+                                       1000)
+                : 0,
+            (unsigned long long)stream_jitter_buffer.max_latency_us / 1000);
+    dprintf(fd,
+            "    Counts (packets/overruns/underruns/decoded overflows) : %zu / "
+            "%zu / %zu / %zu\n",
+            stream_jitter_buffer.total_packets,
+            stream_jitter_buffer.overrun_count,
+            stream_jitter_buffer.underrun_count,
+            stream_jitter_buffer.pcm_overflow_count);
+  }
 }
 
 void btif_a2dp_sink_set_focus_state_req(btif_a2dp_sink_focus_state_t state) {
@@ -700,7 +1177,7 @@ void btif_a2dp_sink_set_focus_state_req(btif_a2dp_sink_focus_state_t state) {
           osi_malloc(sizeof(tBTIF_MEDIA_SINK_FOCUS_UPDATE)));
   p_buf->focus_state = state;
   p_buf->hdr.event = BTIF_MEDIA_SINK_SET_FOCUS_STATE;
-  btif_a2dp_sink_cb.worker_thread.DoInThread(
+  btif_a2dp_sink_do_in_thread(
       FROM_HERE, base::BindOnce(btif_a2dp_sink_command_ready, (BT_HDR*)p_buf));
 }
 
@@ -712,7 +1189,7 @@ static void btif_a2dp_sink_set_focus_state_event(
   APPL_TRACE_DEBUG("%s: setting focus state to %d", __func__, state);
   btif_a2dp_sink_cb.rx_focus_state = state;
   if (btif_a2dp_sink_cb.rx_focus_state == BTIF_A2DP_SINK_FOCUS_NOT_GRANTED) {
-    fixed_queue_flush(btif_a2dp_sink_cb.rx_audio_queue, osi_free);
+    btif_a2dp_sink_flush_buffers();
     btif_a2dp_sink_cb.rx_flush = true;
   } else if (btif_a2dp_sink_cb.rx_focus_state == BTIF_A2DP_SINK_FOCUS_GRANTED) {
     btif_a2dp_sink_cb.rx_flush = false;
@@ -733,7 +1210,7 @@ static void btif_a2dp_sink_clear_track_event_req() {
   BT_HDR* p_buf = reinterpret_cast<BT_HDR*>(osi_malloc(sizeof(BT_HDR)));
 
   p_buf->event = BTIF_MEDIA_SINK_CLEAR_TRACK;
-  btif_a2dp_sink_cb.worker_thread.DoInThread(
+  btif_a2dp_sink_do_in_thread(
       FROM_HERE, base::BindOnce(btif_a2dp_sink_command_ready, p_buf));
 }
 
@@ -28,6 +28,8 @@
 #include <limits.h>
 #include <string.h>
 #include <algorithm>
+#include <atomic>
+#include <mutex>
 
 #include "audio_a2dp_hw/include/audio_a2dp_hw.h"
 #include "audio_hal_interface/a2dp_encoding.h"
@@ -39,14 +41,17 @@
 #include "btif_a2dp_source.h"
 #include "btif_av.h"
 #include "btif_av_co.h"
+#include "btif_deferred_init.h"
 #include "btif_util.h"
 #include "common/message_loop_thread.h"
 #include "common/metrics.h"
 #include "common/repeating_timer.h"
 #include "common/time_util.h"
+#include "common/trace.h"
 #include "osi/include/fixed_queue.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
+#include "osi/include/properties.h"
 #include "osi/include/wakelock.h"
 #include "uipc.h"
 
@@ -63,6 +68,23 @@ extern std::unique_ptr<tUIPC_STATE> a2dp_uipc;
  */
 #define MAX_OUTPUT_A2DP_FRAME_QUEUE_SZ (MAX_PCM_FRAME_NUM_PER_TICK * 2)
 
+/**
+ * In pipelined mode the media timer only paces the transmission, and the
+ * encoder is driven by the link: it runs when the tx queue is drained, and
+ * on a tick only if the link took what was encoded before. Packets are
+ * encoded at most this many packets ahead of the link; while the link is
+ * congested the PCM data is left in the audio HAL buffer instead of being
+ * encoded and then dropped from an overflowing queue.
+ */
+#define A2DP_SOURCE_PIPELINED_PROPERTY "persist.bluetooth.a2dp_pipelined"
+#define A2DP_PIPELINE_MAX_QUEUED_PACKETS 2
+/* Past this many ticks the encoder runs anyway, and the queue overflow
+ * handling sheds the stale packets, so that the audio HAL is never blocked
+ * for long by a stalled link. */
+#define A2DP_PIPELINE_MAX_DEFERRED_TICKS 5
+/* Collects the latency of the tasks of the media thread, for dumpsys */
+#define A2DP_SOURCE_TASK_STATS_PROPERTY "persist.bluetooth.task_stats"
+
 class SchedulingStats {
  public:
   SchedulingStats() { Reset(); }
@@ -110,6 +132,73 @@ class SchedulingStats {
   uint64_t total_scheduling_time_us;
 };
 
+// CPU time spent by one encoder in |send_frames|, measured on the encoder
+// thread so that time spent waiting for the audio HAL isn't counted
+class EncoderCpuStats {
+ public:
+  EncoderCpuStats() { Reset(); }
+  void Reset() {
+    total_encodes = 0;
+    total_cpu_us = 0;
+    max_cpu_us = 0;
+    overrun_count = 0;
+  }
+
+  // Counter for encoder calls
+  size_t total_encodes;
+
+  // Accumulated CPU time (in us)
+  uint64_t total_cpu_us;
+
+  // Max. CPU time of a single call (in us)
+  uint64_t max_cpu_us;
+
+  // Counter for calls that took longer than the encoder interval
+  size_t overrun_count;
+};
+
+// Usage of the software encoding and the hardware offload data paths, and of
+// the transitions between them
+class DataPathStats {
+ public:
+  DataPathStats() { Reset(); }
+  void Reset() {
+    software_streaming_us = 0;
+    offload_streaming_us = 0;
+    offload_start_us = 0;
+    offload_sessions = 0;
+    offload_fallbacks = 0;
+    fallback_start_us = 0;
+    last_fallback_gap_us = 0;
+    in_place_codec_updates = 0;
+    restarted_codec_updates = 0;
+  }
+
+  // Accumulated streaming time (in us) on each data path
+  uint64_t software_streaming_us;
+  uint64_t offload_streaming_us;
+
+  // Start of the current offloaded stream (in us), 0 when not offloading
+  uint64_t offload_start_us;
+
+  // Counter for offloaded streams
+  size_t offload_sessions;
+
+  // Counter for offloads that failed and fell back to the software encoding
+  size_t offload_fallbacks;
+
+  // Time of the pending fallback (in us), 0 once software audio flows
+  uint64_t fallback_start_us;
+
+  // Time from the last fallback to the first software packet (in us)
+  uint64_t last_fallback_gap_us;
+
+  // Counters for codec updates applied to the running encoder, and for the
+  // ones that restarted the session
+  size_t in_place_codec_updates;
+  size_t restarted_codec_updates;
+};
+
 class BtifMediaStats {
  public:
   BtifMediaStats() { Reset(); }
@@ -130,9 +219,12 @@ class BtifMediaStats {
     tx_queue_max_dropped_messages = 0;
     tx_queue_dropouts = 0;
     tx_queue_last_dropouts_us = 0;
+    tx_queue_deferred_encodes = 0;
+    tx_queue_refill_encodes = 0;
     media_read_total_underflow_bytes = 0;
     media_read_total_underflow_count = 0;
     media_read_last_underflow_us = 0;
+    for (auto& cpu_stats : encoder_cpu_stats) cpu_stats.Reset();
     codec_index = -1;
   }
 
@@ -159,10 +251,18 @@ class BtifMediaStats {
   size_t tx_queue_dropouts;
   uint64_t tx_queue_last_dropouts_us;
 
+  // Pipelined mode: ticks without encoding because the link was behind, and
+  // encodings started by the link draining the queue
+  size_t tx_queue_deferred_encodes;
+  size_t tx_queue_refill_encodes;
+
   size_t media_read_total_underflow_bytes;
   size_t media_read_total_underflow_count;
   uint64_t media_read_last_underflow_us;
 
+  // Indexed by the codec index of the encoder
+  EncoderCpuStats encoder_cpu_stats[BTAV_A2DP_CODEC_INDEX_SOURCE_MAX];
+
   int codec_index = -1;
 };
 
@@ -180,6 +280,9 @@ class BtifA2dpSource {
         tx_flush(false),
         encoder_interface(nullptr),
         encoder_interval_ms(0),
+        pipelined(false),
+        deferred_ticks(0),
+        refill_pending(false),
         state_(kStateOff) {}
 
   void Reset() {
@@ -187,11 +290,16 @@ class BtifA2dpSource {
     tx_audio_queue = nullptr;
     tx_flush = false;
     media_alarm.CancelAndWait();
-    wakelock_release();
+    wakelock_release_for(WAKELOCK_REASON_A2DP_SOURCE);
     encoder_interface = nullptr;
     encoder_interval_ms = 0;
+    pipelined = false;
+    deferred_ticks = 0;
+    refill_pending = false;
+    abr.Reset();
     stats.Reset();
     accumulated_stats.Reset();
+    data_path_stats.Reset();
     state_ = kStateOff;
   }
 
@@ -216,8 +324,14 @@ class BtifA2dpSource {
   RepeatingTimer media_alarm;
   const tA2DP_ENCODER_INTERFACE* encoder_interface;
   uint64_t encoder_interval_ms; /* Local copy of the encoder interval */
+  bool pipelined; /* Encoding is driven by the link, see above */
+  uint32_t deferred_ticks; /* Consecutive ticks without encoding */
+  /* A refill was posted by the reader of |tx_audio_queue| */
+  std::atomic<bool> refill_pending;
+  A2dpAbr abr; /* Adaptive bitrate of the encoders that support it */
   BtifMediaStats stats;
   BtifMediaStats accumulated_stats;
+  DataPathStats data_path_stats;
 
  private:
   BtifA2dpSource::RunState state_;
@@ -225,9 +339,14 @@ class BtifA2dpSource {
 
 static bluetooth::common::MessageLoopThread btif_a2dp_source_thread(
     "bt_a2dp_source_worker_thread");
+// Serializes the first use start up of |btif_a2dp_source_thread|
+static std::mutex btif_a2dp_source_thread_mutex;
 static BtifA2dpSource btif_a2dp_source_cb;
 
-static void btif_a2dp_source_init_delayed(void);
+static constexpr char kA2dpSourceMediaTask[] = "A2DP Source media task";
+
+static bool btif_a2dp_source_do_in_thread(const base::Location& from_here,
+                                          base::OnceClosure task);
 static void btif_a2dp_source_startup_delayed(void);
 static void btif_a2dp_source_start_session_delayed(
     const RawAddress& peer_address, std::promise<void> start_session_promise);
@@ -252,6 +371,13 @@ static void btif_a2dp_source_audio_feeding_update_event(
     const btav_a2dp_codec_config_t& codec_audio_config);
 static bool btif_a2dp_source_audio_tx_flush_req(void);
 static void btif_a2dp_source_audio_handle_timer(void);
+static void btif_a2dp_source_audio_refill_event(void);
+static void btif_a2dp_source_encode(uint64_t timestamp_us);
+static void btif_a2dp_source_update_bitrate(uint64_t timestamp_us);
+static void btif_a2dp_source_link_quality_event(
+    tA2DP_ABR_LINK_QUALITY link_quality);
+static void btif_a2dp_source_congestion_event(void);
+static void btif_a2dp_source_offload_stopped(void);
 static uint32_t btif_a2dp_source_read_callback(uint8_t* p_buf, uint32_t len);
 static bool btif_a2dp_source_enqueue_callback(BT_HDR* p_buf, size_t frames_n,
                                               uint32_t bytes_read);
@@ -286,6 +412,14 @@ void btif_a2dp_source_accumulate_scheduling_stats(SchedulingStats* src,
   dst->total_scheduling_time_us += src->total_scheduling_time_us;
 }
 
+void btif_a2dp_source_accumulate_encoder_cpu_stats(EncoderCpuStats* src,
+                                                   EncoderCpuStats* dst) {
+  dst->total_encodes += src->total_encodes;
+  dst->total_cpu_us += src->total_cpu_us;
+  dst->max_cpu_us = std::max(dst->max_cpu_us, src->max_cpu_us);
+  dst->overrun_count += src->overrun_count;
+}
+
 void btif_a2dp_source_accumulate_stats(BtifMediaStats* src,
                                        BtifMediaStats* dst) {
   dst->tx_queue_total_frames += src->tx_queue_total_frames;
@@ -303,6 +437,8 @@ void btif_a2dp_source_accumulate_stats(BtifMediaStats* src,
       dst->tx_queue_max_dropped_messages, src->tx_queue_max_dropped_messages);
   dst->tx_queue_dropouts += src->tx_queue_dropouts;
   dst->tx_queue_last_dropouts_us = src->tx_queue_last_dropouts_us;
+  dst->tx_queue_deferred_encodes += src->tx_queue_deferred_encodes;
+  dst->tx_queue_refill_encodes += src->tx_queue_refill_encodes;
   dst->media_read_total_underflow_bytes +=
       src->media_read_total_underflow_bytes;
   dst->media_read_total_underflow_count +=
@@ -313,22 +449,35 @@ void btif_a2dp_source_accumulate_stats(BtifMediaStats* src,
                                                &dst->tx_queue_enqueue_stats);
   btif_a2dp_source_accumulate_scheduling_stats(&src->tx_queue_dequeue_stats,
                                                &dst->tx_queue_dequeue_stats);
+  for (int i = 0; i < BTAV_A2DP_CODEC_INDEX_SOURCE_MAX; i++) {
+    btif_a2dp_source_accumulate_encoder_cpu_stats(
+        &src->encoder_cpu_stats[i], &dst->encoder_cpu_stats[i]);
+  }
   src->Reset();
 }
 
 bool btif_a2dp_source_init(void) {
   LOG_INFO(LOG_TAG, "%s", __func__);
 
-  // Start A2DP Source media task
-  btif_a2dp_source_thread.StartUp();
-  btif_a2dp_source_thread.DoInThread(
-      FROM_HERE, base::Bind(&btif_a2dp_source_init_delayed));
+  // The A2DP Source media task is started when a task is first posted to it
+  btif_deferred_init_register(kA2dpSourceMediaTask);
   return true;
 }
 
-static void btif_a2dp_source_init_delayed(void) {
-  LOG_INFO(LOG_TAG, "%s", __func__);
-  // Nothing to do
+static bool btif_a2dp_source_do_in_thread(const base::Location& from_here,
+                                          base::OnceClosure task) {
+  {
+    std::lock_guard<std::mutex> lock(btif_a2dp_source_thread_mutex);
+    if (!btif_a2dp_source_thread.IsRunning()) {
+      btif_deferred_init_construct(kA2dpSourceMediaTask, [] {
+        btif_a2dp_source_thread.StartUp();
+        if (osi_property_get_bool(A2DP_SOURCE_TASK_STATS_PROPERTY, false)) {
+          btif_a2dp_source_thread.EnableTaskStats(true);
+        }
+      });
+    }
+  }
+  return btif_a2dp_source_thread.DoInThread(from_here, std::move(task));
 }
 
 bool btif_a2dp_source_startup(void) {
@@ -343,9 +492,11 @@ bool btif_a2dp_source_startup(void) {
   btif_a2dp_source_cb.Reset();
   btif_a2dp_source_cb.SetState(BtifA2dpSource::kStateStartingUp);
   btif_a2dp_source_cb.tx_audio_queue = fixed_queue_new(SIZE_MAX);
+  btif_a2dp_source_cb.pipelined =
+      osi_property_get_bool(A2DP_SOURCE_PIPELINED_PROPERTY, false);
 
   // Schedule the rest of the operations
-  btif_a2dp_source_thread.DoInThread(
+  btif_a2dp_source_do_in_thread(
       FROM_HERE, base::Bind(&btif_a2dp_source_startup_delayed));
 
   return true;
@@ -374,7 +525,7 @@ bool btif_a2dp_source_start_session(const RawAddress& peer_address,
   LOG(INFO) << __func__ << ": peer_address=" << peer_address
             << " state=" << btif_a2dp_source_cb.StateStr();
   btif_a2dp_source_setup_codec(peer_address);
-  if (btif_a2dp_source_thread.DoInThread(
+  if (btif_a2dp_source_do_in_thread(
           FROM_HERE,
           base::BindOnce(&btif_a2dp_source_start_session_delayed, peer_address,
                          std::move(peer_ready_promise)))) {
@@ -448,7 +599,7 @@ bool btif_a2dp_source_end_session(const RawAddress& peer_address) {
   LOG_INFO(LOG_TAG, "%s: peer_address=%s state=%s", __func__,
            peer_address.ToString().c_str(),
            btif_a2dp_source_cb.StateStr().c_str());
-  btif_a2dp_source_thread.DoInThread(
+  btif_a2dp_source_do_in_thread(
       FROM_HERE,
       base::Bind(&btif_a2dp_source_end_session_delayed, peer_address));
   return true;
@@ -490,7 +641,7 @@ void btif_a2dp_source_shutdown(void) {
   /* Make sure no channels are restarted while shutting down */
   btif_a2dp_source_cb.SetState(BtifA2dpSource::kStateShuttingDown);
 
-  btif_a2dp_source_thread.DoInThread(
+  btif_a2dp_source_do_in_thread(
       FROM_HERE, base::Bind(&btif_a2dp_source_shutdown_delayed));
 }
 
@@ -500,7 +651,7 @@ static void btif_a2dp_source_shutdown_delayed(void) {
 
   // Stop the timer
   btif_a2dp_source_cb.media_alarm.CancelAndWait();
-  wakelock_release();
+  wakelock_release_for(WAKELOCK_REASON_A2DP_SOURCE);
 
   if (bluetooth::audio::a2dp::is_hal_2_0_enabled()) {
     bluetooth::audio::a2dp::cleanup();
@@ -523,11 +674,15 @@ void btif_a2dp_source_cleanup(void) {
   // Make sure the source is shutdown
   btif_a2dp_source_shutdown();
 
+  // The media task is only started by its first use
+  if (!btif_a2dp_source_thread.IsRunning()) return;
+
   btif_a2dp_source_thread.DoInThread(
       FROM_HERE, base::Bind(&btif_a2dp_source_cleanup_delayed));
 
   // Exit the thread
   btif_a2dp_source_thread.ShutDown();
+  btif_deferred_init_release(kA2dpSourceMediaTask);
 }
 
 static void btif_a2dp_source_cleanup_delayed(void) {
@@ -548,6 +703,10 @@ bool btif_a2dp_source_is_streaming(void) {
   return btif_a2dp_source_cb.media_alarm.IsScheduled();
 }
 
+uint64_t btif_a2dp_source_get_encoder_interval_ms(void) {
+  return btif_a2dp_source_cb.encoder_interval_ms;
+}
+
 static void btif_a2dp_source_setup_codec(const RawAddress& peer_address) {
   LOG_INFO(LOG_TAG, "%s: peer_address=%s state=%s", __func__,
            peer_address.ToString().c_str(),
@@ -558,7 +717,7 @@ static void btif_a2dp_source_setup_codec(const RawAddress& peer_address) {
   CHECK(CHAR_BIT == 8);
 
   btif_a2dp_source_audio_tx_flush_req();
-  btif_a2dp_source_thread.DoInThread(
+  btif_a2dp_source_do_in_thread(
       FROM_HERE,
       base::Bind(&btif_a2dp_source_setup_codec_delayed, peer_address));
 }
@@ -608,7 +767,7 @@ void btif_a2dp_source_start_audio_req(void) {
   LOG_INFO(LOG_TAG, "%s: state=%s", __func__,
            btif_a2dp_source_cb.StateStr().c_str());
 
-  btif_a2dp_source_thread.DoInThread(
+  btif_a2dp_source_do_in_thread(
       FROM_HERE, base::Bind(&btif_a2dp_source_audio_tx_start_event));
 }
 
@@ -616,7 +775,7 @@ void btif_a2dp_source_stop_audio_req(void) {
   LOG_INFO(LOG_TAG, "%s: state=%s", __func__,
            btif_a2dp_source_cb.StateStr().c_str());
 
-  btif_a2dp_source_thread.DoInThread(
+  btif_a2dp_source_do_in_thread(
       FROM_HERE, base::Bind(&btif_a2dp_source_audio_tx_stop_event));
 }
 
@@ -627,7 +786,7 @@ void btif_a2dp_source_encoder_user_config_update_req(
   LOG(INFO) << __func__ << ": peer_address=" << peer_address
             << " state=" << btif_a2dp_source_cb.StateStr() << " "
             << codec_user_preferences.size() << " codec_preference(s)";
-  if (!btif_a2dp_source_thread.DoInThread(
+  if (!btif_a2dp_source_do_in_thread(
           FROM_HERE,
           base::BindOnce(&btif_a2dp_source_encoder_user_config_update_event,
                          peer_address, codec_user_preferences,
@@ -645,6 +804,46 @@ static void btif_a2dp_source_encoder_user_config_update_event(
     std::promise<void> peer_ready_promise) {
   bool restart_output = false;
   bool success = false;
+  bool is_active_peer =
+      !peer_address.IsEmpty() && peer_address == btif_av_source_active_peer();
+
+  // Encoder parameters are applied to the running stream, without a gap
+  A2dpCodecConfig* current_codec =
+      bta_av_get_a2dp_peer_current_codec(peer_address);
+  if (is_active_peer && current_codec != nullptr &&
+      !codec_user_preferences.empty() &&
+      A2DP_IsCodecUserConfigInPlace(current_codec->getCodecConfig(),
+                                    codec_user_preferences.front(),
+                                    btif_av_is_a2dp_offload_enabled())) {
+    const btav_a2dp_codec_config_t& codec_user_config =
+        codec_user_preferences.front();
+    success = bta_av_co_set_codec_user_config(peer_address, codec_user_config,
+                                              &restart_output);
+    LOG(INFO) << __func__ << ": peer_address=" << peer_address
+              << " state=" << btif_a2dp_source_cb.StateStr()
+              << " codec_preference={" << codec_user_config.ToString()
+              << "} updated in place success=" << (success ? "true" : "false")
+              << " restart_output=" << (restart_output ? "true" : "false");
+    if (success && !restart_output) {
+      btif_a2dp_source_cb.data_path_stats.in_place_codec_updates++;
+      peer_ready_promise.set_value();
+      return;
+    }
+    if (success) {
+      // The peer is reconfigured anyway, BTA_AV_RECONFIG_EVT starts the new
+      // session
+      btif_a2dp_source_end_session_delayed(peer_address);
+      btif_a2dp_source_cb.data_path_stats.restarted_codec_updates++;
+      peer_ready_promise.set_value();
+      return;
+    }
+  }
+
+  // Restart the session if the codec for the active peer is updated
+  if (is_active_peer) {
+    btif_a2dp_source_end_session_delayed(peer_address);
+    btif_a2dp_source_cb.data_path_stats.restarted_codec_updates++;
+  }
   for (auto codec_user_config : codec_user_preferences) {
     success = bta_av_co_set_codec_user_config(peer_address, codec_user_config,
                                               &restart_output);
@@ -666,7 +865,7 @@ static void btif_a2dp_source_encoder_user_config_update_event(
   if (!success) {
     LOG(ERROR) << __func__ << ": cannot update codec user configuration(s)";
   }
-  if (!peer_address.IsEmpty() && peer_address == btif_av_source_active_peer()) {
+  if (is_active_peer) {
     // No more actions needed with remote, and if succeed, user had changed the
     // config like the bits per sample only. Let's resume the session now.
     btif_a2dp_source_start_session(peer_address, std::move(peer_ready_promise));
@@ -680,7 +879,7 @@ void btif_a2dp_source_feeding_update_req(
     const btav_a2dp_codec_config_t& codec_audio_config) {
   LOG_INFO(LOG_TAG, "%s: state=%s", __func__,
            btif_a2dp_source_cb.StateStr().c_str());
-  btif_a2dp_source_thread.DoInThread(
+  btif_a2dp_source_do_in_thread(
       FROM_HERE, base::Bind(&btif_a2dp_source_audio_feeding_update_event,
                             codec_audio_config));
 }
@@ -724,6 +923,7 @@ void btif_a2dp_source_on_stopped(tBTA_AV_SUSPEND* p_av_suspend) {
       }
     }
   } else if (btif_av_is_a2dp_offload_running()) {
+    btif_a2dp_source_offload_stopped();
     bluetooth::audio::a2dp::ack_stream_suspended(A2DP_CTRL_ACK_SUCCESS);
     return;
   }
@@ -760,6 +960,7 @@ void btif_a2dp_source_on_suspended(tBTA_AV_SUSPEND* p_av_suspend) {
       }
     }
   } else if (btif_av_is_a2dp_offload_running()) {
+    btif_a2dp_source_offload_stopped();
     bluetooth::audio::a2dp::ack_stream_suspended(A2DP_CTRL_ACK_SUCCESS);
     return;
   }
@@ -799,8 +1000,17 @@ static void btif_a2dp_source_audio_tx_start_event(void) {
 
   /* audio engine starting, reset tx suspended flag */
   btif_a2dp_source_cb.tx_flush = false;
+  btif_a2dp_source_cb.deferred_ticks = 0;
+  btif_a2dp_source_cb.refill_pending = false;
+
+  /* each stream starts at the full bit rate */
+  btif_a2dp_source_cb.abr.Reset();
+  if (btif_a2dp_source_cb.encoder_interface->set_bitrate_percent != nullptr) {
+    btif_a2dp_source_cb.encoder_interface->set_bitrate_percent(
+        btif_a2dp_source_cb.abr.GetBitratePercent());
+  }
 
-  wakelock_acquire();
+  wakelock_acquire_for(WAKELOCK_REASON_A2DP_SOURCE);
   btif_a2dp_source_cb.media_alarm.SchedulePeriodic(
       btif_a2dp_source_thread.GetWeakPtr(), FROM_HERE,
       base::Bind(&btif_a2dp_source_audio_handle_timer),
@@ -834,6 +1044,13 @@ static void btif_a2dp_source_audio_tx_stop_event(void) {
 
   btif_a2dp_source_cb.stats.session_end_us =
       bluetooth::common::time_get_os_boottime_us();
+  if (btif_a2dp_source_cb.stats.session_start_us != 0 &&
+      btif_a2dp_source_cb.stats.session_end_us >
+          btif_a2dp_source_cb.stats.session_start_us) {
+    btif_a2dp_source_cb.data_path_stats.software_streaming_us +=
+        btif_a2dp_source_cb.stats.session_end_us -
+        btif_a2dp_source_cb.stats.session_start_us;
+  }
   btif_a2dp_source_update_metrics();
   btif_a2dp_source_accumulate_stats(&btif_a2dp_source_cb.stats,
                                     &btif_a2dp_source_cb.accumulated_stats);
@@ -852,7 +1069,7 @@ static void btif_a2dp_source_audio_tx_stop_event(void) {
 
   /* Stop the timer first */
   btif_a2dp_source_cb.media_alarm.CancelAndWait();
-  wakelock_release();
+  wakelock_release_for(WAKELOCK_REASON_A2DP_SOURCE);
 
   if (bluetooth::audio::a2dp::is_hal_2_0_enabled()) {
     bluetooth::audio::a2dp::ack_stream_suspended(A2DP_CTRL_ACK_SUCCESS);
@@ -885,6 +1102,10 @@ static void btif_a2dp_source_audio_tx_stop_event(void) {
 
 static void btif_a2dp_source_audio_handle_timer(void) {
   if (btif_av_is_a2dp_offload_running()) return;
+  // The spans are numbered by media timer tick
+  BT_TRACE_SCOPE(
+      "btif_a2dp_source_audio_handle_timer",
+      btif_a2dp_source_cb.stats.tx_queue_enqueue_stats.total_updates);
 
   uint64_t timestamp_us = bluetooth::common::time_get_os_boottime_us();
   log_tstamps_us("A2DP Source tx timer", timestamp_us);
@@ -895,6 +1116,32 @@ static void btif_a2dp_source_audio_handle_timer(void) {
     return;
   }
   CHECK(btif_a2dp_source_cb.encoder_interface != nullptr);
+  if (btif_a2dp_source_cb.pipelined) {
+    // Send what was encoded ahead first, so that the transmission doesn't
+    // wait for the encoder
+    bta_av_ci_src_data_ready(BTA_AV_CHNL_AUDIO);
+    if (fixed_queue_length(btif_a2dp_source_cb.tx_audio_queue) >=
+            A2DP_PIPELINE_MAX_QUEUED_PACKETS &&
+        btif_a2dp_source_cb.deferred_ticks < A2DP_PIPELINE_MAX_DEFERRED_TICKS) {
+      // The link is behind: the encoder catches up on the elapsed time once
+      // it drains the queue
+      btif_a2dp_source_cb.deferred_ticks++;
+      btif_a2dp_source_cb.stats.tx_queue_deferred_encodes++;
+    } else {
+      btif_a2dp_source_encode(timestamp_us);
+    }
+  } else {
+    btif_a2dp_source_encode(timestamp_us);
+    bta_av_ci_src_data_ready(BTA_AV_CHNL_AUDIO);
+  }
+  update_scheduling_stats(&btif_a2dp_source_cb.stats.tx_queue_enqueue_stats,
+                          timestamp_us,
+                          btif_a2dp_source_cb.encoder_interval_ms * 1000);
+}
+
+// Encodes the PCM data due by |timestamp_us| into |tx_audio_queue|
+static void btif_a2dp_source_encode(uint64_t timestamp_us) {
+  btif_a2dp_source_cb.deferred_ticks = 0;
   size_t transmit_queue_length =
       fixed_queue_length(btif_a2dp_source_cb.tx_audio_queue);
 #ifndef OS_GENERIC
@@ -905,11 +1152,111 @@ static void btif_a2dp_source_audio_handle_timer(void) {
     btif_a2dp_source_cb.encoder_interface->set_transmit_queue_length(
         transmit_queue_length);
   }
+  btif_a2dp_source_cb.abr.OnTransmitQueueLength(transmit_queue_length);
+  btif_a2dp_source_update_bitrate(timestamp_us);
+  uint64_t cpu_start_us = bluetooth::common::time_get_thread_cputime_us();
   btif_a2dp_source_cb.encoder_interface->send_frames(timestamp_us);
-  bta_av_ci_src_data_ready(BTA_AV_CHNL_AUDIO);
-  update_scheduling_stats(&btif_a2dp_source_cb.stats.tx_queue_enqueue_stats,
-                          timestamp_us,
-                          btif_a2dp_source_cb.encoder_interval_ms * 1000);
+  uint64_t cpu_us =
+      bluetooth::common::time_get_thread_cputime_us() - cpu_start_us;
+
+  int codec_index = btif_a2dp_source_cb.stats.codec_index;
+  if (codec_index < 0 || codec_index >= BTAV_A2DP_CODEC_INDEX_SOURCE_MAX)
+    return;
+  EncoderCpuStats* cpu_stats =
+      &btif_a2dp_source_cb.stats.encoder_cpu_stats[codec_index];
+  cpu_stats->total_encodes++;
+  cpu_stats->total_cpu_us += cpu_us;
+  cpu_stats->max_cpu_us = std::max(cpu_stats->max_cpu_us, cpu_us);
+  if (cpu_us > btif_a2dp_source_cb.encoder_interval_ms * 1000)
+    cpu_stats->overrun_count++;
+}
+
+// Moves the encoder to the bit rate the link supports
+static void btif_a2dp_source_update_bitrate(uint64_t timestamp_us) {
+  const tA2DP_ENCODER_INTERFACE* encoder_interface =
+      btif_a2dp_source_cb.encoder_interface;
+  if (encoder_interface->set_bitrate_percent == nullptr) return;
+  if (!btif_a2dp_source_cb.abr.Update(timestamp_us / 1000)) return;
+
+  uint8_t bitrate_percent = btif_a2dp_source_cb.abr.GetBitratePercent();
+  LOG_INFO(LOG_TAG, "%s: encoding at %u%% of the bit rate", __func__,
+           bitrate_percent);
+  encoder_interface->set_bitrate_percent(bitrate_percent);
+}
+
+void btif_a2dp_source_on_link_quality(
+    uint16_t handle, const tA2DP_ABR_LINK_QUALITY& link_quality) {
+  if (!btif_a2dp_source_is_streaming()) return;
+  if (handle != BTM_GetHCIConnHandle(btif_av_source_active_peer(),
+                                     BT_TRANSPORT_BR_EDR)) {
+    return;
+  }
+  btif_a2dp_source_thread.DoInThread(
+      FROM_HERE,
+      base::BindOnce(&btif_a2dp_source_link_quality_event, link_quality));
+}
+
+static void btif_a2dp_source_link_quality_event(
+    tA2DP_ABR_LINK_QUALITY link_quality) {
+  btif_a2dp_source_cb.abr.OnLinkQuality(link_quality);
+}
+
+void btif_a2dp_source_on_congestion(void) {
+  if (!btif_a2dp_source_is_streaming()) return;
+  btif_a2dp_source_thread.DoInThread(
+      FROM_HERE, base::BindOnce(&btif_a2dp_source_congestion_event));
+}
+
+static void btif_a2dp_source_congestion_event(void) {
+  btif_a2dp_source_cb.abr.OnCongestion();
+}
+
+void btif_a2dp_source_on_offload_started(void) {
+  DataPathStats* data_path_stats = &btif_a2dp_source_cb.data_path_stats;
+  data_path_stats->offload_sessions++;
+  data_path_stats->offload_start_us =
+      bluetooth::common::time_get_os_boottime_us();
+}
+
+static void btif_a2dp_source_offload_stopped(void) {
+  DataPathStats* data_path_stats = &btif_a2dp_source_cb.data_path_stats;
+  if (data_path_stats->offload_start_us == 0) return;
+  data_path_stats->offload_streaming_us +=
+      bluetooth::common::time_get_os_boottime_us() -
+      data_path_stats->offload_start_us;
+  data_path_stats->offload_start_us = 0;
+}
+
+bool btif_a2dp_source_fallback_to_software(void) {
+  LOG_INFO(LOG_TAG, "%s: state=%s", __func__,
+           btif_a2dp_source_cb.StateStr().c_str());
+  if (btif_a2dp_source_cb.State() != BtifA2dpSource::kStateRunning ||
+      !bluetooth::audio::a2dp::is_hal_2_0_enabled()) {
+    return false;
+  }
+  // The encoder was set up with the codec, only the audio HAL session moves
+  if (!bluetooth::audio::a2dp::fallback_to_software_encoding()) return false;
+
+  DataPathStats* data_path_stats = &btif_a2dp_source_cb.data_path_stats;
+  data_path_stats->offload_fallbacks++;
+  data_path_stats->fallback_start_us =
+      bluetooth::common::time_get_os_boottime_us();
+  btif_a2dp_source_start_audio_req();
+  return true;
+}
+
+// Pipelined mode: the link drained |tx_audio_queue|, encode what is due
+// without waiting for the next tick
+static void btif_a2dp_source_audio_refill_event(void) {
+  btif_a2dp_source_cb.refill_pending = false;
+  if (btif_av_is_a2dp_offload_running()) return;
+  if (!btif_a2dp_source_cb.media_alarm.IsScheduled()) return;
+
+  CHECK(btif_a2dp_source_cb.encoder_interface != nullptr);
+  btif_a2dp_source_cb.stats.tx_queue_refill_encodes++;
+  btif_a2dp_source_encode(bluetooth::common::time_get_os_boottime_us());
+  if (!fixed_queue_is_empty(btif_a2dp_source_cb.tx_audio_queue))
+    bta_av_ci_src_data_ready(BTA_AV_CHNL_AUDIO);
 }
 
 static uint32_t btif_a2dp_source_read_callback(uint8_t* p_buf, uint32_t len) {
@@ -962,6 +1309,13 @@ static bool btif_a2dp_source_enqueue_callback(BT_HDR* p_buf, size_t frames_n,
     return false;
   }
 
+  DataPathStats* data_path_stats = &btif_a2dp_source_cb.data_path_stats;
+  if (data_path_stats->fallback_start_us != 0 && bytes_read > 0) {
+    data_path_stats->last_fallback_gap_us =
+        now_us - data_path_stats->fallback_start_us;
+    data_path_stats->fallback_start_us = 0;
+  }
+
   // Check for TX queue overflow
   // TODO: Using frames_n here is probably wrong: should be "+ 1" instead.
   if (fixed_queue_length(btif_a2dp_source_cb.tx_audio_queue) + frames_n >
@@ -972,6 +1326,7 @@ static bool btif_a2dp_source_enqueue_callback(BT_HDR* p_buf, size_t frames_n,
              (uint32_t)frames_n, MAX_OUTPUT_A2DP_FRAME_QUEUE_SZ);
     // Keep track of drop-outs
     btif_a2dp_source_cb.stats.tx_queue_dropouts++;
+    btif_a2dp_source_cb.abr.OnCongestion();
     btif_a2dp_source_cb.stats.tx_queue_last_dropouts_us = now_us;
 
     // Flush all queued buffers
@@ -1057,7 +1412,7 @@ static bool btif_a2dp_source_audio_tx_flush_req(void) {
   LOG_INFO(LOG_TAG, "%s: state=%s", __func__,
            btif_a2dp_source_cb.StateStr().c_str());
 
-  btif_a2dp_source_thread.DoInThread(
+  btif_a2dp_source_do_in_thread(
       FROM_HERE, base::Bind(&btif_a2dp_source_audio_tx_flush_event));
   return true;
 }
@@ -1074,6 +1429,25 @@ BT_HDR* btif_a2dp_source_audio_readbuf(void) {
     update_scheduling_stats(&btif_a2dp_source_cb.stats.tx_queue_dequeue_stats,
                             now_us,
                             btif_a2dp_source_cb.encoder_interval_ms * 1000);
+    // The packets queued behind this one were encoded while it waited, one
+    // per encoder interval
+    uint64_t queueing_time_us =
+        fixed_queue_length(btif_a2dp_source_cb.tx_audio_queue) *
+        btif_a2dp_source_cb.encoder_interval_ms * 1000;
+    btif_a2dp_source_cb.stats.tx_queue_total_queueing_time_us +=
+        queueing_time_us;
+    btif_a2dp_source_cb.stats.tx_queue_max_queueing_time_us =
+        std::max(btif_a2dp_source_cb.stats.tx_queue_max_queueing_time_us,
+                 queueing_time_us);
+  }
+
+  // Called when the link can take more data: in pipelined mode, refill the
+  // queue as soon as it is drained
+  if (btif_a2dp_source_cb.pipelined &&
+      fixed_queue_is_empty(btif_a2dp_source_cb.tx_audio_queue) &&
+      !btif_a2dp_source_cb.refill_pending.exchange(true)) {
+    btif_a2dp_source_do_in_thread(
+        FROM_HERE, base::Bind(&btif_a2dp_source_audio_refill_event));
   }
 
   return p_buf;
@@ -1183,6 +1557,16 @@ void btif_a2dp_source_debug_dump(int fd) {
           "  Counts (max dropped)                                    : %zu\n",
           accumulated_stats->tx_queue_max_dropped_messages);
 
+  dprintf(fd,
+          "  Pipelined encoding                                      : %s\n",
+          btif_a2dp_source_cb.pipelined ? "true" : "false");
+
+  dprintf(fd,
+          "  Counts (deferred/refill encodes)                        : %zu / "
+          "%zu\n",
+          accumulated_stats->tx_queue_deferred_encodes,
+          accumulated_stats->tx_queue_refill_encodes);
+
   dprintf(
       fd,
       "  Last update time ago in ms (flushed/dropped)            : %llu / "
@@ -1215,6 +1599,10 @@ void btif_a2dp_source_debug_dump(int fd) {
                     1000
               : 0);
 
+  if (bluetooth::audio::a2dp::is_hal_2_0_enabled()) {
+    bluetooth::audio::a2dp::debug_dump(fd);
+  }
+
   //
   // TxQueue enqueue stats
   //
@@ -1290,6 +1678,78 @@ void btif_a2dp_source_debug_dump(int fd) {
       (unsigned long long)dequeue_stats->max_premature_scheduling_delta_us /
           1000,
       (unsigned long long)ave_time_us / 1000);
+
+  //
+  // Encoder CPU time stats
+  //
+  for (int i = 0; i < BTAV_A2DP_CODEC_INDEX_SOURCE_MAX; i++) {
+    EncoderCpuStats* cpu_stats = &accumulated_stats->encoder_cpu_stats[i];
+    if (cpu_stats->total_encodes == 0) continue;
+    dprintf(fd, "  Encoder %s:\n",
+            A2DP_CodecIndexStr(static_cast<btav_a2dp_codec_index_t>(i)));
+    dprintf(fd,
+            "    Counts (encodes/overruns)                             : %zu / "
+            "%zu\n",
+            cpu_stats->total_encodes, cpu_stats->overrun_count);
+    dprintf(fd,
+            "    CPU time in us (total/max/ave)                        : "
+            "%llu / %llu / %llu\n",
+            (unsigned long long)cpu_stats->total_cpu_us,
+            (unsigned long long)cpu_stats->max_cpu_us,
+            (unsigned long long)(cpu_stats->total_cpu_us /
+                                 cpu_stats->total_encodes));
+  }
+
+  btif_a2dp_source_cb.abr.DebugDump(fd);
+
+  //
+  // Software encoding against hardware offload
+  //
+  DataPathStats* data_path_stats = &btif_a2dp_source_cb.data_path_stats;
+  uint64_t offload_streaming_us = data_path_stats->offload_streaming_us;
+  if (data_path_stats->offload_start_us != 0) {
+    offload_streaming_us += now_us - data_path_stats->offload_start_us;
+  }
+  uint64_t software_cpu_us = 0;
+  for (const auto& cpu_stats : accumulated_stats->encoder_cpu_stats) {
+    software_cpu_us += cpu_stats.total_cpu_us;
+  }
+  ave_time_us = 0;
+  if (dequeue_stats->total_updates != 0) {
+    ave_time_us = accumulated_stats->tx_queue_total_queueing_time_us /
+                  dequeue_stats->total_updates;
+  }
+  dprintf(fd, "  Data path:\n");
+  dprintf(fd,
+          "    Streaming time in ms (software/offload)               : %llu / "
+          "%llu\n",
+          (unsigned long long)data_path_stats->software_streaming_us / 1000,
+          (unsigned long long)offload_streaming_us / 1000);
+  // The controller encodes offloaded streams, the host doesn't queue them
+  dprintf(fd,
+          "    Host CPU in us per streaming s (software/offload)     : %llu / "
+          "0\n",
+          (data_path_stats->software_streaming_us >= 1000000)
+              ? (unsigned long long)(software_cpu_us /
+                                     (data_path_stats->software_streaming_us /
+                                      1000000))
+              : 0);
+  dprintf(fd,
+          "    Host queueing latency in ms (software ave/max/offload): %llu / "
+          "%llu / 0\n",
+          (unsigned long long)ave_time_us / 1000,
+          (unsigned long long)accumulated_stats->tx_queue_max_queueing_time_us /
+              1000);
+  dprintf(fd,
+          "    Offloaded streams (total/fallbacks/last gap in ms)    : %zu / "
+          "%zu / %llu\n",
+          data_path_stats->offload_sessions, data_path_stats->offload_fallbacks,
+          (unsigned long long)data_path_stats->last_fallback_gap_us / 1000);
+  dprintf(fd,
+          "    Codec updates (in place/restarted)                    : %zu / "
+          "%zu\n",
+          data_path_stats->in_place_codec_updates,
+          data_path_stats->restarted_codec_updates);
 }
 
 static void btif_a2dp_source_update_metrics(void) {
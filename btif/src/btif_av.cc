@@ -507,11 +507,8 @@ class BtifAvSource {
       const RawAddress& peer_address,
       const std::vector<btav_a2dp_codec_config_t>& codec_preferences,
       std::promise<void> peer_ready_promise) {
-    // Restart the session if the codec for the active peer is updated
-    if (!peer_address.IsEmpty() && active_peer_ == peer_address) {
-      btif_a2dp_source_end_session(active_peer_);
-    }
-
+    // The A2DP Source thread restarts the session of the active peer, unless
+    // the update applies to the running encoder
     btif_a2dp_source_encoder_user_config_update_req(
         peer_address, codec_preferences, std::move(peer_ready_promise));
   }
@@ -1472,7 +1469,8 @@ bool BtifAvStateMachine::StateIdle::ProcessEvent(uint32_t event, void* p_data) {
             "peers",
             __PRETTY_FUNCTION__, peer_.PeerAddress().ToString().c_str());
         if (peer_.SelfInitiatedConnection()) {
-          btif_queue_advance();
+          btif_queue_advance_by_uuid(peer_.LocalUuidServiceClass(),
+                                     &peer_.PeerAddress());
         }
         break;
       }
@@ -1595,7 +1593,8 @@ bool BtifAvStateMachine::StateIdle::ProcessEvent(uint32_t event, void* p_data) {
           BTA_AvOpenRc(peer_.BtaHandle());
         }
       }
-      btif_queue_advance();
+      btif_queue_advance_by_uuid(peer_.LocalUuidServiceClass(),
+                                 &peer_.PeerAddress());
     } break;
 
     case BTA_AV_REMOTE_CMD_EVT:
@@ -1678,7 +1677,8 @@ bool BtifAvStateMachine::StateOpening::ProcessEvent(uint32_t event,
                                    BTAV_CONNECTION_STATE_DISCONNECTED);
       peer_.StateMachine().TransitionTo(BtifAvStateMachine::kStateIdle);
       if (peer_.SelfInitiatedConnection()) {
-        btif_queue_advance();
+        btif_queue_advance_by_uuid(peer_.LocalUuidServiceClass(),
+                                   &peer_.PeerAddress());
       }
       break;
     case BTA_AV_REJECT_EVT:
@@ -1690,7 +1690,8 @@ bool BtifAvStateMachine::StateOpening::ProcessEvent(uint32_t event,
                                    BTAV_CONNECTION_STATE_DISCONNECTED);
       peer_.StateMachine().TransitionTo(BtifAvStateMachine::kStateIdle);
       if (peer_.SelfInitiatedConnection()) {
-        btif_queue_advance();
+        btif_queue_advance_by_uuid(peer_.LocalUuidServiceClass(),
+                                   &peer_.PeerAddress());
       }
       break;
 
@@ -1744,7 +1745,8 @@ bool BtifAvStateMachine::StateOpening::ProcessEvent(uint32_t event,
         BTA_AvOpenRc(peer_.BtaHandle());
       }
       if (peer_.SelfInitiatedConnection()) {
-        btif_queue_advance();
+        btif_queue_advance_by_uuid(peer_.LocalUuidServiceClass(),
+                                   &peer_.PeerAddress());
       }
     } break;
 
@@ -1766,7 +1768,8 @@ bool BtifAvStateMachine::StateOpening::ProcessEvent(uint32_t event,
           "ignore Connect request",
           __PRETTY_FUNCTION__, peer_.PeerAddress().ToString().c_str(),
           BtifAvEvent::EventName(event).c_str());
-      btif_queue_advance();
+      btif_queue_advance_by_uuid(peer_.LocalUuidServiceClass(),
+                                 &peer_.PeerAddress());
     } break;
 
     case BTA_AV_PENDING_EVT: {
@@ -1793,7 +1796,8 @@ bool BtifAvStateMachine::StateOpening::ProcessEvent(uint32_t event,
                                    BTAV_CONNECTION_STATE_DISCONNECTED);
       peer_.StateMachine().TransitionTo(BtifAvStateMachine::kStateIdle);
       if (peer_.SelfInitiatedConnection()) {
-        btif_queue_advance();
+        btif_queue_advance_by_uuid(peer_.LocalUuidServiceClass(),
+                                   &peer_.PeerAddress());
       }
       break;
 
@@ -1803,7 +1807,8 @@ bool BtifAvStateMachine::StateOpening::ProcessEvent(uint32_t event,
                                    BTAV_CONNECTION_STATE_DISCONNECTED);
       peer_.StateMachine().TransitionTo(BtifAvStateMachine::kStateIdle);
       if (peer_.SelfInitiatedConnection()) {
-        btif_queue_advance();
+        btif_queue_advance_by_uuid(peer_.LocalUuidServiceClass(),
+                                   &peer_.PeerAddress());
       }
       break;
 
@@ -2014,7 +2019,8 @@ bool BtifAvStateMachine::StateOpened::ProcessEvent(uint32_t event,
                          __PRETTY_FUNCTION__,
                          peer_.PeerAddress().ToString().c_str(),
                          BtifAvEvent::EventName(event).c_str());
-      btif_queue_advance();
+      btif_queue_advance_by_uuid(peer_.LocalUuidServiceClass(),
+                                 &peer_.PeerAddress());
     } break;
 
     case BTIF_AV_OFFLOAD_START_REQ_EVT:
@@ -2715,7 +2721,8 @@ static void bta_av_sink_media_callback(const RawAddress& peer_address,
       btif_av_sink_config_req_t config_req;
 
       // Update the codec info of the A2DP Sink decoder
-      btif_a2dp_sink_update_decoder((uint8_t*)(p_data->avk_config.codec_info));
+      btif_a2dp_sink_update_decoder(peer_address,
+                                    (uint8_t*)(p_data->avk_config.codec_info));
 
       config_req.sample_rate =
           A2DP_GetTrackSampleRate(p_data->avk_config.codec_info);
@@ -2785,7 +2792,7 @@ static bt_status_t connect_int(RawAddress* peer_address, uint16_t uuid) {
       peer = btif_av_sink.FindOrCreatePeer(*peer_address, kBtaHandleUnknown);
     }
     if (peer == nullptr) {
-      btif_queue_advance();
+      btif_queue_advance_by_uuid(uuid, peer_address);
       return;
     }
     peer->StateMachine().ProcessEvent(BTIF_AV_CONNECT_REQ_EVT, nullptr);
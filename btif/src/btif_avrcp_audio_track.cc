@@ -20,9 +20,11 @@
 #include "btif_avrcp_audio_track.h"
 
 #include <aaudio/AAudio.h>
+#include <algorithm>
 #include <base/logging.h>
 #include <utils/StrongPointer.h>
 
+#include "a2dp_pcm_convert.h"
 #include "bt_target.h"
 #include "osi/include/log.h"
 
@@ -34,6 +36,7 @@ typedef struct {
   int channelCount;
   float* buffer;
   size_t bufferLength;
+  float gain;
 } BtifAvrcpAudioTrack;
 
 #if (DUMP_PCM_DATA == TRUE)
@@ -67,6 +70,7 @@ void* BtifAvrcpAudioTrackCreate(int trackFreq, int bitsPerSample,
   trackHolder->bufferLength =
       trackHolder->channelCount * AAudioStream_getBufferSizeInFrames(stream);
   trackHolder->buffer = new float[trackHolder->bufferLength]();
+  trackHolder->gain = 1.0f;
 
 #if (DUMP_PCM_DATA == TRUE)
   outputPcmSampleFile = fopen(outputFilename, "ab");
@@ -107,7 +111,7 @@ void BtifAvrcpAudioTrackDelete(void* handle) {
   if (trackHolder != NULL && trackHolder->stream != NULL) {
     LOG_VERBOSE(LOG_TAG, "%s Track.cpp: btStartTrack", __func__);
     AAudioStream_close(trackHolder->stream);
-    delete trackHolder->buffer;
+    delete[] trackHolder->buffer;
     delete trackHolder;
   }
 
@@ -137,60 +141,38 @@ void BtifAvrcpSetAudioTrackGain(void* handle, float gain) {
     LOG_DEBUG(LOG_TAG, "%s handle is null.", __func__);
     return;
   }
-  // Does nothing right now
+  BtifAvrcpAudioTrack* trackHolder = static_cast<BtifAvrcpAudioTrack*>(handle);
+  // Applied by the conversion to float of the samples written next
+  trackHolder->gain = std::min(std::max(gain, 0.0f), 1.0f);
 }
 
-constexpr float kScaleQ15ToFloat = 1.0f / 32768.0f;
-constexpr float kScaleQ23ToFloat = 1.0f / 8388608.0f;
-constexpr float kScaleQ31ToFloat = 1.0f / 2147483648.0f;
-
 static size_t sampleSizeFor(BtifAvrcpAudioTrack* trackHolder) {
   return trackHolder->bitsPerSample / 8;
 }
 
-static size_t transcodeQ15ToFloat(uint8_t* buffer, size_t length,
-                                  BtifAvrcpAudioTrack* trackHolder) {
-  size_t sampleSize = sampleSizeFor(trackHolder);
-  size_t i = 0;
-  for (; i <= length / sampleSize; i++) {
-    trackHolder->buffer[i] = ((int16_t*)buffer)[i] * kScaleQ15ToFloat;
-  }
-  return i * sampleSize;
-}
-
-static size_t transcodeQ23ToFloat(uint8_t* buffer, size_t length,
-                                  BtifAvrcpAudioTrack* trackHolder) {
-  size_t sampleSize = sampleSizeFor(trackHolder);
-  size_t i = 0;
-  for (; i <= length / sampleSize; i++) {
-    size_t offset = i * sampleSize;
-    int32_t sample = *((int32_t*)(buffer + offset - 1)) & 0x00FFFFFF;
-    trackHolder->buffer[i] = sample * kScaleQ23ToFloat;
-  }
-  return i * sampleSize;
-}
-
-static size_t transcodeQ31ToFloat(uint8_t* buffer, size_t length,
-                                  BtifAvrcpAudioTrack* trackHolder) {
-  size_t sampleSize = sampleSizeFor(trackHolder);
-  size_t i = 0;
-  for (; i <= length / sampleSize; i++) {
-    trackHolder->buffer[i] = ((int32_t*)buffer)[i] * kScaleQ31ToFloat;
-  }
-  return i * sampleSize;
-}
-
+// Converts up to a buffer of samples from |buffer| to float, with the gain
+// of the track. Returns the number of bytes of |buffer| converted.
 static size_t transcodeToPcmFloat(uint8_t* buffer, size_t length,
                                   BtifAvrcpAudioTrack* trackHolder) {
+  size_t sampleSize = sampleSizeFor(trackHolder);
+  size_t samples = std::min(length / sampleSize, trackHolder->bufferLength);
   switch (trackHolder->bitsPerSample) {
     case 16:
-      return transcodeQ15ToFloat(buffer, length, trackHolder);
+      a2dp_pcm_16_to_float(buffer, trackHolder->buffer, samples,
+                           trackHolder->gain);
+      break;
     case 24:
-      return transcodeQ23ToFloat(buffer, length, trackHolder);
+      a2dp_pcm_24_to_float(buffer, trackHolder->buffer, samples,
+                           trackHolder->gain);
+      break;
     case 32:
-      return transcodeQ31ToFloat(buffer, length, trackHolder);
+      a2dp_pcm_32_to_float(buffer, trackHolder->buffer, samples,
+                           trackHolder->gain);
+      break;
+    default:
+      return 0;
   }
-  return -1;
+  return samples * sampleSize;
 }
 
 constexpr int64_t kTimeoutNanos = 100 * 1000 * 1000;  // 100 ms
@@ -207,20 +189,20 @@ int BtifAvrcpAudioTrackWriteData(void* handle, void* audioBuffer,
   }
 #endif
 
-  size_t sampleSize = sampleSizeFor(trackHolder);
+  size_t frameSize = sampleSizeFor(trackHolder) * trackHolder->channelCount;
   int transcodedCount = 0;
-  do {
-    transcodedCount +=
+  while (transcodedCount < bufferLength) {
+    size_t count =
         transcodeToPcmFloat(((uint8_t*)audioBuffer) + transcodedCount,
                             bufferLength - transcodedCount, trackHolder);
+    if (count == 0) break;
+    transcodedCount += count;
 
-    retval = AAudioStream_write(
-        trackHolder->stream, trackHolder->buffer,
-        transcodedCount / (sampleSize * trackHolder->channelCount),
-        kTimeoutNanos);
+    retval = AAudioStream_write(trackHolder->stream, trackHolder->buffer,
+                                count / frameSize, kTimeoutNanos);
     LOG_VERBOSE(LOG_TAG, "%s Track.cpp: btWriteData len = %d ret = %d",
                 __func__, bufferLength, retval);
-  } while (transcodedCount < bufferLength);
+  }
 
   return transcodedCount;
 }
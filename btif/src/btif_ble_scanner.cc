@@ -25,6 +25,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <array>
+#include <memory>
 #include <unordered_set>
 #include "device/include/controller.h"
 
@@ -42,6 +44,7 @@
 #include "btif_gatt_util.h"
 #include "btif_storage.h"
 #include "osi/include/log.h"
+#include "osi/include/properties.h"
 #include "stack/include/btu.h"
 #include "vendor_api.h"
 
@@ -65,30 +68,116 @@ extern const btgatt_callbacks_t* bt_gatt_callbacks;
 
 namespace {
 
+/* The last addresses seen by the scan, the oldest are forgotten first. An open
+ * addressing table indexes the ring buffer holding them, so that neither
+ * lookups nor updates allocate */
+class RemoteAddressCache {
+ public:
+  RemoteAddressCache() { Clear(); }
+
+  bool Find(const RawAddress& address) const {
+    return slots_[FindSlot(address)] != kEmpty;
+  }
+
+  void Add(const RawAddress& address) {
+    if (Find(address)) return;
+    if (size_ == kMaxSize) {
+      // Forget the oldest address
+      Erase(FindSlot(ring_[head_]));
+      head_ = (head_ + 1) % kMaxSize;
+      size_--;
+    }
+    uint16_t entry = (head_ + size_) % kMaxSize;
+    ring_[entry] = address;
+    slots_[FindSlot(address)] = entry;
+    size_++;
+  }
+
+  void Clear() {
+    slots_.fill(kEmpty);
+    head_ = 0;
+    size_ = 0;
+  }
+
+ private:
+  static constexpr size_t kMaxSize = 1024;
+  // Twice the entries, keeps the probe sequences short
+  static constexpr size_t kSlotBits = 11;
+  static constexpr size_t kSlots = 1 << kSlotBits;
+  static constexpr uint16_t kEmpty = 0xffff;
+
+  static size_t Hash(const RawAddress& address) {
+    uint64_t value = 0;
+    memcpy(&value, address.address, sizeof(address.address));
+    return (value * 0x9e3779b97f4a7c15ULL) >> (64 - kSlotBits);
+  }
+
+  // The slot of |address|, or the empty slot where it would go
+  size_t FindSlot(const RawAddress& address) const {
+    size_t slot = Hash(address);
+    while (slots_[slot] != kEmpty && ring_[slots_[slot]] != address) {
+      slot = (slot + 1) % kSlots;
+    }
+    return slot;
+  }
+
+  // Empties |slot|, moving back the entries of the probe sequences crossing it
+  void Erase(size_t slot) {
+    size_t next = slot;
+    while (true) {
+      next = (next + 1) % kSlots;
+      if (slots_[next] == kEmpty) break;
+      size_t home = Hash(ring_[slots_[next]]);
+      // The entry stays if its home is cyclically within (slot, next]
+      bool stays = slot <= next ? (slot < home && home <= next)
+                                : (slot < home || home <= next);
+      if (stays) continue;
+      slots_[slot] = slots_[next];
+      slot = next;
+    }
+    slots_[slot] = kEmpty;
+  }
+
+  std::array<RawAddress, kMaxSize> ring_;
+  std::array<uint16_t, kSlots> slots_;
+  uint16_t head_;
+  uint16_t size_;
+};
+
 // all access to this variable should be done on the jni thread
-std::set<RawAddress> remote_bdaddr_cache;
-std::queue<RawAddress> remote_bdaddr_cache_ordered;
-const size_t remote_bdaddr_cache_max_size = 1024;
-
-void btif_address_cache_add(const RawAddress& p_bda, uint8_t addr_type) {
-  // Remove the oldest entries
-  while (remote_bdaddr_cache.size() >= remote_bdaddr_cache_max_size) {
-    const RawAddress& raw_address = remote_bdaddr_cache_ordered.front();
-    remote_bdaddr_cache.erase(raw_address);
-    remote_bdaddr_cache_ordered.pop();
-  }
-  remote_bdaddr_cache.insert(p_bda);
-  remote_bdaddr_cache_ordered.push(p_bda);
-}
+RemoteAddressCache remote_bdaddr_cache;
+
+/* Scan results are delivered to the JNI thread in batches, gathered over at
+ * most BTIF_SCAN_BATCH_WINDOW_MS or BTIF_SCAN_BATCH_MAX_RESULTS results. A
+ * window of 0 delivers every result on its own. */
+#define BTIF_SCAN_BATCH_WINDOW_PROPERTY "persist.bluetooth.scan_batch.window_ms"
+#define BTIF_SCAN_BATCH_MAX_RESULTS_PROPERTY \
+  "persist.bluetooth.scan_batch.max_results"
+#define BTIF_SCAN_BATCH_WINDOW_MS 20
+#define BTIF_SCAN_BATCH_MAX_RESULTS 64
+// Room reserved for the advertising data of each result of a batch, longer
+// extended advertising data grows the buffer
+#define BTIF_SCAN_BATCH_DATA_PER_RESULT 62
+
+struct ScanResultBatch {
+  explicit ScanResultBatch(size_t max_results) {
+    results.reserve(max_results);
+    device_types.reserve(max_results);
+    data.reserve(max_results * BTIF_SCAN_BATCH_DATA_PER_RESULT);
+  }
 
-bool btif_address_cache_find(const RawAddress& p_bda) {
-  return (remote_bdaddr_cache.find(p_bda) != remote_bdaddr_cache.end());
-}
+  std::vector<btgatt_scan_result_t> results;
+  std::vector<tBT_DEVICE_TYPE> device_types;
+  // The advertising data of all results, one after the other
+  std::vector<uint8_t> data;
+};
 
-void btif_address_cache_init(void) {
-  remote_bdaddr_cache.clear();
-  remote_bdaddr_cache_ordered = {};
-}
+// all access to these variables should be done on the main thread
+std::unique_ptr<ScanResultBatch> scan_result_batch;
+// Tells the window timer of a batch delivered early from the current one
+uint64_t scan_result_batch_generation = 0;
+uint32_t scan_result_batch_window_ms = BTIF_SCAN_BATCH_WINDOW_MS;
+size_t scan_result_batch_max_results = BTIF_SCAN_BATCH_MAX_RESULTS;
 
 void bta_batch_scan_threshold_cb(tBTM_BLE_REF_VALUE ref_value) {
   SCAN_CBACK_IN_JNI(batchscan_threshold_cb, ref_value);
@@ -101,28 +190,32 @@ void bta_batch_scan_reports_cb(int client_id, tBTA_STATUS status,
                     num_records, std::move(data));
 }
 
-void bta_scan_results_cb_impl(RawAddress bd_addr, tBT_DEVICE_TYPE device_type,
-                              int8_t rssi, uint8_t addr_type,
-                              uint16_t ble_evt_type, uint8_t ble_primary_phy,
-                              uint8_t ble_secondary_phy,
-                              uint8_t ble_advertising_sid, int8_t ble_tx_power,
-                              uint16_t ble_periodic_adv_int,
-                              vector<uint8_t> value) {
-  uint8_t remote_name_len;
-  bt_device_type_t dev_type;
-  bt_property_t properties;
-
-  const uint8_t* p_eir_remote_name = AdvertiseDataParser::GetFieldByType(
-      value, BTM_EIR_COMPLETE_LOCAL_NAME_TYPE, &remote_name_len);
-
-  if (p_eir_remote_name == NULL) {
-    p_eir_remote_name = AdvertiseDataParser::GetFieldByType(
-        value, BT_EIR_SHORTENED_LOCAL_NAME_TYPE, &remote_name_len);
+/* Updates what is known of the device from its scan result. Returns false if
+ * the result is to be dropped. */
+bool btif_scan_result_update_device(const RawAddress& bd_addr,
+                                    tBT_DEVICE_TYPE device_type,
+                                    uint8_t addr_type, const uint8_t* data,
+                                    size_t data_len) {
+  uint8_t remote_name_len = 0;
+
+  /* The complete name is preferred over the shortened one */
+  const uint8_t* p_eir_remote_name = NULL;
+  for (const auto& field : AdvertiseDataParser::Fields(data, data_len)) {
+    if (field.type == BTM_EIR_COMPLETE_LOCAL_NAME_TYPE) {
+      p_eir_remote_name = field.data;
+      remote_name_len = field.length;
+      break;
+    }
+    if (field.type == BT_EIR_SHORTENED_LOCAL_NAME_TYPE &&
+        p_eir_remote_name == NULL) {
+      p_eir_remote_name = field.data;
+      remote_name_len = field.length;
+    }
   }
 
   if ((addr_type != BLE_ADDR_RANDOM) || (p_eir_remote_name)) {
-    if (!btif_address_cache_find(bd_addr)) {
-      btif_address_cache_add(bd_addr, addr_type);
+    if (!remote_bdaddr_cache.Find(bd_addr)) {
+      remote_bdaddr_cache.Add(bd_addr);
 
       if (p_eir_remote_name) {
         if (remote_name_len > BD_NAME_LEN + 1 ||
@@ -131,7 +224,7 @@ void bta_scan_results_cb_impl(RawAddress bd_addr, tBT_DEVICE_TYPE device_type,
           LOG_INFO(LOG_TAG,
                    "%s dropping invalid packet - device name too long: %d",
                    __func__, remote_name_len);
-          return;
+          return false;
         }
 
         bt_bdname_t bdname;
@@ -146,17 +239,107 @@ void bta_scan_results_cb_impl(RawAddress bd_addr, tBT_DEVICE_TYPE device_type,
     }
   }
 
-  dev_type = (bt_device_type_t)device_type;
-  BTIF_STORAGE_FILL_PROPERTY(&properties, BT_PROPERTY_TYPE_OF_DEVICE,
-                             sizeof(dev_type), &dev_type);
-  btif_storage_set_remote_device_property(&(bd_addr), &properties);
+  btif_storage_stage_scanned_device(bd_addr, (bt_device_type_t)device_type,
+                                    addr_type);
+  return true;
+}
+
+void bta_scan_results_cb_impl(RawAddress bd_addr, tBT_DEVICE_TYPE device_type,
+                              int8_t rssi, uint8_t addr_type,
+                              uint16_t ble_evt_type, uint8_t ble_primary_phy,
+                              uint8_t ble_secondary_phy,
+                              uint8_t ble_advertising_sid, int8_t ble_tx_power,
+                              uint16_t ble_periodic_adv_int,
+                              vector<uint8_t> value) {
+  if (!btif_scan_result_update_device(bd_addr, device_type, addr_type,
+                                      value.data(), value.size())) {
+    return;
+  }
 
-  btif_storage_set_remote_addr_type(&bd_addr, addr_type);
   HAL_CBACK(bt_gatt_callbacks, scanner->scan_result_cb, ble_evt_type, addr_type,
             &bd_addr, ble_primary_phy, ble_secondary_phy, ble_advertising_sid,
             ble_tx_power, rssi, ble_periodic_adv_int, std::move(value));
 }
 
+void bta_scan_results_batch_cb_impl(ScanResultBatch* batch) {
+  // Drop the results rejected on the way, keeping the order of the others
+  size_t num_results = 0;
+  for (size_t i = 0; i < batch->results.size(); i++) {
+    const btgatt_scan_result_t& result = batch->results[i];
+    if (!btif_scan_result_update_device(
+            result.bda, batch->device_types[i], result.addr_type,
+            batch->data.data() + result.data_offset, result.data_len)) {
+      continue;
+    }
+    batch->results[num_results++] = result;
+  }
+
+  if (bt_gatt_callbacks && bt_gatt_callbacks->scanner->scan_results_batch_cb) {
+    HAL_CBACK(bt_gatt_callbacks, scanner->scan_results_batch_cb,
+              batch->results.data(), num_results, batch->data.data(),
+              batch->data.size());
+    return;
+  }
+
+  for (size_t i = 0; i < num_results; i++) {
+    btgatt_scan_result_t& result = batch->results[i];
+    const uint8_t* data = batch->data.data() + result.data_offset;
+    HAL_CBACK(bt_gatt_callbacks, scanner->scan_result_cb, result.event_type,
+              result.addr_type, &result.bda, result.primary_phy,
+              result.secondary_phy, result.advertising_sid, result.tx_power,
+              result.rssi, result.periodic_adv_int,
+              vector<uint8_t>(data, data + result.data_len));
+  }
+}
+
+void btif_scan_result_batch_deliver() {
+  if (!scan_result_batch) return;
+  scan_result_batch_generation++;
+  do_in_jni_thread(Bind(bta_scan_results_batch_cb_impl,
+                        Owned(scan_result_batch.release())));
+}
+
+void btif_scan_result_batch_window_expired(uint64_t generation) {
+  if (generation != scan_result_batch_generation) return;
+  btif_scan_result_batch_deliver();
+}
+
+void btif_scan_result_batch_add(const tBTA_DM_INQ_RES* r) {
+  if (!scan_result_batch) {
+    scan_result_batch =
+        std::make_unique<ScanResultBatch>(scan_result_batch_max_results);
+    do_in_main_thread_delayed(
+        FROM_HERE,
+        Bind(btif_scan_result_batch_window_expired,
+             scan_result_batch_generation),
+        base::TimeDelta::FromMilliseconds(scan_result_batch_window_ms));
+  }
+
+  ScanResultBatch* batch = scan_result_batch.get();
+  uint16_t data_len = r->p_eir ? r->eir_len : 0;
+  btgatt_scan_result_t result;
+  result.event_type = r->ble_evt_type;
+  result.addr_type = r->ble_addr_type;
+  result.bda = r->bd_addr;
+  result.primary_phy = r->ble_primary_phy;
+  result.secondary_phy = r->ble_secondary_phy;
+  result.advertising_sid = r->ble_advertising_sid;
+  result.tx_power = r->ble_tx_power;
+  result.rssi = r->rssi;
+  result.periodic_adv_int = r->ble_periodic_adv_int;
+  result.data_offset = static_cast<uint32_t>(batch->data.size());
+  result.data_len = data_len;
+  batch->results.push_back(result);
+  batch->device_types.push_back(r->device_type);
+  if (data_len) {
+    batch->data.insert(batch->data.end(), r->p_eir, r->p_eir + data_len);
+  }
+
+  if (batch->results.size() >= scan_result_batch_max_results) {
+    btif_scan_result_batch_deliver();
+  }
+}
+
 void bta_scan_results_cb(tBTA_DM_SEARCH_EVT event, tBTA_DM_SEARCH* p_data) {
   uint8_t len;
 
@@ -171,18 +354,25 @@ void bta_scan_results_cb(tBTA_DM_SEARCH_EVT event, tBTA_DM_SEARCH* p_data) {
     return;
   }
 
-  vector<uint8_t> value;
-  if (p_data->inq_res.p_eir) {
-    value.insert(value.begin(), p_data->inq_res.p_eir,
-                 p_data->inq_res.p_eir + p_data->inq_res.eir_len);
-
-    if (AdvertiseDataParser::GetFieldByType(
-            value, BTM_EIR_COMPLETE_LOCAL_NAME_TYPE, &len)) {
-      p_data->inq_res.remt_name_not_required = true;
-    }
+  if (p_data->inq_res.p_eir &&
+      AdvertiseDataParser::GetFieldByType(
+          p_data->inq_res.p_eir, p_data->inq_res.eir_len,
+          BTM_EIR_COMPLETE_LOCAL_NAME_TYPE, &len)) {
+    p_data->inq_res.remt_name_not_required = true;
   }
 
   tBTA_DM_INQ_RES* r = &p_data->inq_res;
+  if (scan_result_batch_window_ms != 0) {
+    btif_scan_result_batch_add(r);
+    return;
+  }
+
+  vector<uint8_t> value;
+  if (r->p_eir) {
+    /* The only copy of the data, handed over to the JNI thread */
+    value.assign(r->p_eir, r->p_eir + r->eir_len);
+  }
+
   do_in_jni_thread(Bind(bta_scan_results_cb_impl, r->bd_addr, r->device_type,
                         r->rssi, r->ble_addr_type, r->ble_evt_type,
                         r->ble_primary_phy, r->ble_secondary_phy,
@@ -190,6 +380,20 @@ void bta_scan_results_cb(tBTA_DM_SEARCH_EVT event, tBTA_DM_SEARCH* p_data) {
                         r->ble_periodic_adv_int, std::move(value)));
 }
 
+/* Starts or stops the observation, on the main thread */
+void btif_scan_observe(bool start, uint32_t window_ms, size_t max_results) {
+  if (!start) {
+    BTA_DmBleObserve(false, 0, nullptr);
+    // Nothing is added once the observation stops
+    btif_scan_result_batch_deliver();
+    return;
+  }
+
+  scan_result_batch_window_ms = window_ms;
+  scan_result_batch_max_results = max_results;
+  BTA_DmBleObserve(true, 0, bta_scan_results_cb);
+}
+
 void bta_track_adv_event_cb(tBTM_BLE_TRACK_ADV_DATA* p_track_adv_data) {
   btgatt_track_adv_info_t* btif_scan_track_cb = new btgatt_track_adv_info_t;
 
@@ -225,13 +429,23 @@ class BleScannerInterfaceImpl : public BleScannerInterface {
         [](bool start) {
           if (!start) {
             do_in_main_thread(FROM_HERE,
-                              Bind(&BTA_DmBleObserve, false, 0, nullptr));
+                              Bind(&btif_scan_observe, false, 0, 0));
+            btif_storage_flush_scanned_devices();
             return;
           }
 
-          btif_address_cache_init();
-          do_in_main_thread(
-              FROM_HERE, Bind(&BTA_DmBleObserve, true, 0, bta_scan_results_cb));
+          remote_bdaddr_cache.Clear();
+          int32_t window_ms = osi_property_get_int32(
+              BTIF_SCAN_BATCH_WINDOW_PROPERTY, BTIF_SCAN_BATCH_WINDOW_MS);
+          int32_t max_results =
+              osi_property_get_int32(BTIF_SCAN_BATCH_MAX_RESULTS_PROPERTY,
+                                     BTIF_SCAN_BATCH_MAX_RESULTS);
+          if (window_ms < 0) window_ms = 0;
+          if (max_results < 1) max_results = 1;
+          do_in_main_thread(FROM_HERE,
+                            Bind(&btif_scan_observe, true,
+                                 static_cast<uint32_t>(window_ms),
+                                 static_cast<size_t>(max_results)));
         },
         start));
   }
@@ -21,6 +21,7 @@
 #include <stdio.h>
 #include <sys/stat.h>
 
+#include "btif_a2dp_source.h"
 #include "btif_bqr.h"
 #include "btif_dm.h"
 #include "common/leaky_bonded_queue.h"
@@ -408,6 +409,19 @@ void AddLinkQualityEventToQueue(uint8_t length, uint8_t* p_link_quality_event) {
     LOG(WARNING) << __func__ << ": failed to log BQR event to statsd, error "
                  << ret;
   }
+
+  const BqrLinkQualityEvent& link_quality_event =
+      p_bqr_event->bqr_link_quality_event_;
+  tA2DP_ABR_LINK_QUALITY link_quality = {
+      .rssi = link_quality_event.rssi,
+      .retransmission_count = link_quality_event.retransmission_count,
+      .no_rx_count = link_quality_event.no_rx_count,
+      .nak_count = link_quality_event.nak_count,
+      .flow_off_count = link_quality_event.flow_off_count,
+  };
+  btif_a2dp_source_on_link_quality(link_quality_event.connection_handle,
+                                   link_quality);
+
   kpBqrEventQueue->Enqueue(p_bqr_event.release());
 }
 
@@ -34,6 +34,7 @@
 #include <sstream>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include <btif_keystore.h>
 #include "bt_types.h"
@@ -42,6 +43,7 @@
 #include "btif_common.h"
 #include "btif_config_cache.h"
 #include "btif_config_transcode.h"
+#include "btif_storage.h"
 #include "btif_util.h"
 #include "common/address_obfuscator.h"
 #include "common/metric_id_allocator.h"
@@ -62,6 +64,7 @@
 #define INFO_SECTION "Info"
 #define FILE_TIMESTAMP "TimeCreated"
 #define FILE_SOURCE "FileSource"
+#define JOURNAL_GENERATION "JournalGeneration"
 #define TIME_STRING_LENGTH sizeof("YYYY-MM-DD HH:MM:SS")
 #define DISABLED "disabled"
 static const char* TIME_STRING_FORMAT = "%Y-%m-%d %H:%M:%S";
@@ -79,16 +82,27 @@ using bluetooth::common::MetricIdAllocator;
 static const char* CONFIG_FILE_PATH = "bt_config.conf";
 static const char* CONFIG_BACKUP_PATH = "bt_config.bak";
 static const char* CONFIG_LEGACY_FILE_PATH = "bt_config.xml";
+static const char* CONFIG_JOURNAL_PATH = "bt_config.journal";
 #else   // !defined(OS_GENERIC)
 static const char* CONFIG_FILE_PATH = "/data/misc/bluedroid/bt_config.conf";
 static const char* CONFIG_BACKUP_PATH = "/data/misc/bluedroid/bt_config.bak";
 static const char* CONFIG_LEGACY_FILE_PATH =
     "/data/misc/bluedroid/bt_config.xml";
+static const char* CONFIG_JOURNAL_PATH =
+    "/data/misc/bluedroid/bt_config.journal";
 #endif  // defined(OS_GENERIC)
 static const uint64_t CONFIG_SETTLE_PERIOD_MS = 3000;
+// The save may wait this much longer, to share a wakeup with another alarm.
+static const uint64_t CONFIG_SETTLE_SLACK_MS = 2000;
+// Once the journal grows past this size, the next save rewrites the config
+// file and starts a new journal.
+static const size_t CONFIG_JOURNAL_MAX_SIZE = 32 * 1024;
 
 static void timer_config_save_cb(void* data);
 static void btif_config_write(uint16_t event, char* p_param);
+static bool btif_config_journal_write(void);
+static void btif_config_full_write(void);
+static bool btif_config_use_journal(void);
 static bool is_factory_reset(void);
 static void delete_config_files(void);
 static std::unique_ptr<config_t> btif_config_open(const char* filename);
@@ -150,6 +164,8 @@ static BluetoothKeystoreInterface* get_bluetooth_keystore_interface() {
 bool btif_get_device_type(const RawAddress& bda, int* p_device_type) {
   if (p_device_type == NULL) return false;
 
+  btif_storage_flush_scanned_device(bda);
+
   std::string addrstr = bda.ToString();
   const char* bd_addr_str = addrstr.c_str();
 
@@ -163,6 +179,8 @@ bool btif_get_device_type(const RawAddress& bda, int* p_device_type) {
 bool btif_get_address_type(const RawAddress& bda, int* p_addr_type) {
   if (p_addr_type == NULL) return false;
 
+  btif_storage_flush_scanned_device(bda);
+
   std::string addrstr = bda.ToString();
   const char* bd_addr_str = addrstr.c_str();
 
@@ -267,6 +285,11 @@ static void init_metric_id_allocator() {
 static std::recursive_mutex config_lock;  // protects operations on |config|.
 static alarm_t* config_timer;
 
+// Persistent sections as stored on disk, in the config file plus its journal.
+// Saves only append the difference to it to the journal. NULL when the next
+// save has to rewrite the config file.
+static std::unique_ptr<config_t> persisted_config;
+
 // limited btif config cache capacity
 static BtifConfigCache btif_config_cache(TEMPORARY_SECTION_CAPACITY);
 
@@ -284,6 +307,16 @@ static future_t* init(void) {
     config = btif_config_open(CONFIG_FILE_PATH);
     btif_config_source = ORIGINAL;
   }
+  persisted_config.reset();
+  if (config && btif_config_use_journal()) {
+    // The journal only applies on top of the file it was started for, never
+    // on top of the backup.
+    const std::string* generation =
+        config_get_string(*config, INFO_SECTION, JOURNAL_GENERATION, nullptr);
+    if (generation &&
+        config_journal_replay(CONFIG_JOURNAL_PATH, *generation, config.get()))
+      persisted_config = config_new_clone(*config);
+  }
   if (!config) {
     LOG_WARN(LOG_TAG, "%s unable to load config file: %s; using backup.",
              __func__, CONFIG_FILE_PATH);
@@ -357,6 +390,7 @@ static future_t* init(void) {
 error:
   alarm_free(config_timer);
   config.reset();
+  persisted_config.reset();
   btif_config_cache.Clear();
   config_timer = NULL;
   btif_config_source = NOT_LOADED;
@@ -391,6 +425,7 @@ static future_t* clean_up(void) {
   get_bluetooth_keystore_interface()->clear_map();
   MetricIdAllocator::GetInstance().Close();
   btif_config_cache.Clear();
+  persisted_config.reset();
   return future_new_immediate(FUTURE_SUCCESS);
 }
 
@@ -478,6 +513,14 @@ static bool btif_in_encrypt_key_name_list(std::string key) {
                    key) != (encrypt_key_name_list + ENCRYPT_KEY_NAME_LIST_SIZE);
 }
 
+// Returns the value of the hex digit |c|, or -1 if it is not one.
+static int hex_digit_value(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
 bool btif_config_get_bin(const std::string& section, const std::string& key,
                          uint8_t* value, size_t* length) {
   CHECK(value != NULL);
@@ -511,15 +554,15 @@ bool btif_config_get_bin(const std::string& section, const std::string& key,
     return false;
   }
 
+  const char* ptr = value_str->c_str();
   for (size_t i = 0; i < value_len; ++i)
-    if (!isxdigit(value_str->c_str()[i])) {
+    if (hex_digit_value(ptr[i]) < 0) {
       LOG(WARNING) << ": value is not hex digit";
       return false;
     }
 
-  const char* ptr = value_str->c_str();
   for (*length = 0; *ptr; ptr += 2, *length += 1) {
-    sscanf(ptr, "%02hhx", &value[*length]);
+    value[*length] = (hex_digit_value(ptr[0]) << 4) | hex_digit_value(ptr[1]);
   }
 
   if (btif_is_niap_mode()) {
@@ -588,6 +631,25 @@ const std::list<section_t>& btif_config_sections() {
   return btif_config_cache.GetPersistentSections();
 }
 
+void btif_config_prefetch_encrypted_keys(void) {
+  std::vector<std::string> prefixes;
+  {
+    std::unique_lock<std::recursive_mutex> lock(config_lock);
+    for (const section_t& section :
+         btif_config_cache.GetPersistentSections()) {
+      for (const entry_t& entry : section.entries) {
+        if (entry.value == ENCRYPTED_STR &&
+            btif_in_encrypt_key_name_list(entry.key)) {
+          prefixes.push_back(section.name + "-" + entry.key);
+        }
+      }
+    }
+  }
+  if (prefixes.empty()) return;
+
+  get_bluetooth_keystore_interface()->prefetch_keys(prefixes);
+}
+
 bool btif_config_remove(const std::string& section, const std::string& key) {
   if (is_niap_mode() && btif_in_encrypt_key_name_list(key)) {
     get_bluetooth_keystore_interface()->set_encrypt_key_or_remove_key(
@@ -600,7 +662,8 @@ bool btif_config_remove(const std::string& section, const std::string& key) {
 void btif_config_save(void) {
   CHECK(config_timer != NULL);
 
-  alarm_set(config_timer, CONFIG_SETTLE_PERIOD_MS, timer_config_save_cb, NULL);
+  alarm_set_with_slack(config_timer, CONFIG_SETTLE_PERIOD_MS,
+                       CONFIG_SETTLE_SLACK_MS, timer_config_save_cb, NULL);
 }
 
 void btif_config_flush(void) {
@@ -620,6 +683,8 @@ bool btif_config_clear(void) {
   btif_config_cache.Clear();
   bool ret = storage_config_get_interface()->config_save(
       btif_config_cache.PersistentSectionCopy(), CONFIG_FILE_PATH);
+  remove(CONFIG_JOURNAL_PATH);
+  persisted_config.reset();
   btif_config_source = RESET;
 
   return ret;
@@ -637,13 +702,62 @@ static void btif_config_write(UNUSED_ATTR uint16_t event,
   CHECK(config_timer != NULL);
 
   std::unique_lock<std::recursive_mutex> lock(config_lock);
+  if (!btif_config_journal_write()) btif_config_full_write();
+}
+
+// Appends the changes since the last write to the journal. Returns false if
+// the config file has to be rewritten instead.
+static bool btif_config_journal_write(void) {
+  if (!persisted_config || !btif_config_use_journal()) return false;
+
+  config_t config = btif_config_cache.PersistentSectionCopy();
+  size_t journal_size = 0;
+  if (!config_journal_append(CONFIG_JOURNAL_PATH, *persisted_config, config,
+                             &journal_size) ||
+      journal_size > CONFIG_JOURNAL_MAX_SIZE)
+    return false;
+
+  *persisted_config = std::move(config);
+  return true;
+}
+
+// Rewrites the config file, keeping the previous one as backup, and starts a
+// new journal on top of it.
+static void btif_config_full_write(void) {
+  const bool use_journal = btif_config_use_journal();
+  std::string generation;
+  if (use_journal) {
+    // A new generation makes sure the old journal is never replayed on top of
+    // the new file, even if starting the new journal fails below.
+    auto previous =
+        btif_config_cache.GetString(INFO_SECTION, JOURNAL_GENERATION);
+    uint64_t next =
+        previous ? strtoull(previous->c_str(), nullptr, 10) + 1 : 1;
+    generation = std::to_string(next);
+    btif_config_cache.SetString(INFO_SECTION, JOURNAL_GENERATION, generation);
+  }
+
+  persisted_config.reset();
+  config_t config = btif_config_cache.PersistentSectionCopy();
   rename(CONFIG_FILE_PATH, CONFIG_BACKUP_PATH);
-  storage_config_get_interface()->config_save(
-      btif_config_cache.PersistentSectionCopy(), CONFIG_FILE_PATH);
+  bool saved =
+      storage_config_get_interface()->config_save(config, CONFIG_FILE_PATH);
   if (btif_is_niap_mode()) {
     get_bluetooth_keystore_interface()->set_encrypt_key_or_remove_key(
         CONFIG_FILE_PREFIX, CONFIG_FILE_HASH);
   }
+
+  if (!use_journal) {
+    remove(CONFIG_JOURNAL_PATH);
+  } else if (saved && config_journal_reset(CONFIG_JOURNAL_PATH, generation)) {
+    persisted_config = std::make_unique<config_t>(std::move(config));
+  }
+}
+
+// The journal is only used with the legacy storage. In NIAP mode the checksum
+// covers the config file alone, so every save rewrites it.
+static bool btif_config_use_journal(void) {
+  return !bluetooth::shim::is_gd_stack_started_up() && !btif_is_niap_mode();
 }
 
 void btif_debug_config_dump(int fd) {
@@ -691,5 +805,6 @@ static bool is_factory_reset(void) {
 static void delete_config_files(void) {
   remove(CONFIG_FILE_PATH);
   remove(CONFIG_BACKUP_PATH);
+  remove(CONFIG_JOURNAL_PATH);
   osi_property_set("persist.bluetooth.factoryreset", "false");
 }
@@ -14,6 +14,7 @@
  *  limitations under the License.
  */
 
+#include <iterator>
 #include <limits>
 
 #include "btif_config_cache.h"
@@ -65,6 +66,7 @@ BtifConfigCache::~BtifConfigCache() { Clear(); }
 
 void BtifConfigCache::Clear() {
   unpaired_devices_cache_.Clear();
+  paired_devices_index_.clear();
   paired_devices_list_.sections.clear();
 }
 
@@ -72,11 +74,49 @@ void BtifConfigCache::Init(std::unique_ptr<config_t> source) {
   // get the config persistent data from btif_config file
   paired_devices_list_ = std::move(*source);
   source.reset();
+  paired_devices_index_.clear();
+  paired_devices_index_.reserve(paired_devices_list_.sections.size());
+  for (auto it = paired_devices_list_.sections.begin();
+       it != paired_devices_list_.sections.end(); it++) {
+    IndexPersistentSection(it);
+  }
+}
+
+void BtifConfigCache::IndexPersistentSection(
+    std::list<section_t>::iterator section) {
+  // keep the first section with a given name, as config_t::Find does
+  auto result = paired_devices_index_.emplace(section->name,
+                                              PersistentSectionIndex{section});
+  if (!result.second) {
+    return;
+  }
+  auto& entries = result.first->second.entries;
+  entries.reserve(section->entries.size());
+  for (auto it = section->entries.begin(); it != section->entries.end(); it++) {
+    entries.emplace(it->key, it);
+  }
+}
+
+BtifConfigCache::PersistentSectionIndex* BtifConfigCache::FindPersistentSection(
+    const std::string& section_name) {
+  auto it = paired_devices_index_.find(section_name);
+  if (it == paired_devices_index_.end()) {
+    return nullptr;
+  }
+  return &it->second;
+}
+
+void BtifConfigCache::ErasePersistentSection(const std::string& section_name) {
+  auto it = paired_devices_index_.find(section_name);
+  if (it == paired_devices_index_.end()) {
+    return;
+  }
+  paired_devices_list_.sections.erase(it->second.section);
+  paired_devices_index_.erase(it);
 }
 
 bool BtifConfigCache::HasPersistentSection(const std::string& section_name) {
-  return paired_devices_list_.Find(section_name) !=
-         paired_devices_list_.sections.end();
+  return paired_devices_index_.count(section_name) != 0;
 }
 
 bool BtifConfigCache::HasUnpairedSection(const std::string& section_name) {
@@ -89,9 +129,9 @@ bool BtifConfigCache::HasSection(const std::string& section_name) {
 
 bool BtifConfigCache::HasKey(const std::string& section_name,
                              const std::string& key) {
-  auto section_iter = paired_devices_list_.Find(section_name);
-  if (section_iter != paired_devices_list_.sections.end()) {
-    return section_iter->Has(key);
+  PersistentSectionIndex* paired = FindPersistentSection(section_name);
+  if (paired != nullptr) {
+    return paired->entries.count(key) != 0;
   }
   section_t* section = unpaired_devices_cache_.Find(section_name);
   if (section == nullptr) {
@@ -105,6 +145,7 @@ void BtifConfigCache::RemovePersistentSectionsWithKey(const std::string& key) {
   for (auto it = paired_devices_list_.sections.begin();
        it != paired_devices_list_.sections.end();) {
     if (it->Has(key)) {
+      paired_devices_index_.erase(it->name);
       it = paired_devices_list_.sections.erase(it);
       continue;
     }
@@ -127,21 +168,23 @@ bool BtifConfigCache::RemoveKey(const std::string& section_name,
     }
     return true;
   } else {
-    auto section_iter = paired_devices_list_.Find(section_name);
-    if (section_iter == paired_devices_list_.sections.end()) {
+    PersistentSectionIndex* paired = FindPersistentSection(section_name);
+    if (paired == nullptr) {
       return false;
     }
-    auto entry_iter = section_iter->Find(key);
-    if (entry_iter == section_iter->entries.end()) {
+    auto entry_index = paired->entries.find(key);
+    if (entry_index == paired->entries.end()) {
       return false;
     }
-    section_iter->entries.erase(entry_iter);
+    auto section_iter = paired->section;
+    section_iter->entries.erase(entry_index->second);
+    paired->entries.erase(entry_index);
     if (section_iter->entries.empty()) {
-      paired_devices_list_.sections.erase(section_iter);
+      ErasePersistentSection(section_name);
     } else if (!has_link_key_in_section(*section_iter)) {
       // if no link key in section after removal, move it to unpaired section
       auto moved_section = std::move(*section_iter);
-      paired_devices_list_.sections.erase(section_iter);
+      ErasePersistentSection(section_name);
       unpaired_devices_cache_.Put(section_name, std::move(moved_section));
     }
     return true;
@@ -172,60 +215,66 @@ void BtifConfigCache::SetString(std::string section_name, std::string key,
     LOG(FATAL) << "Empty key not allowed";
     return;
   }
-  if (!paired_devices_list_.Has(section_name)) {
+  PersistentSectionIndex* paired = FindPersistentSection(section_name);
+  if (paired == nullptr) {
     // section is not in paired_device_list, handle it in unpaired devices cache
-    section_t section = {};
-    bool in_unpaired_cache = true;
-    if (!unpaired_devices_cache_.Get(section_name, &section)) {
+    section_t* cached = unpaired_devices_cache_.Find(section_name);
+    bool to_paired =
+        is_local_section_info(section_name) ||
+        (is_link_key(key) && RawAddress::IsValidAddress(section_name));
+    if (cached == nullptr) {
       // it's a new unpaired section, add it to unpaired devices cache
+      section_t section = {};
       section.name = section_name;
-      in_unpaired_cache = false;
+      section.Set(std::move(key), std::move(value));
+      if (to_paired) {
+        paired_devices_list_.sections.emplace_back(std::move(section));
+        IndexPersistentSection(std::prev(paired_devices_list_.sections.end()));
+      } else {
+        unpaired_devices_cache_.Put(section_name, std::move(section));
+      }
+      return;
     }
     // set key to value and replace existing key if already exist
-    section.Set(key, value);
-
-    if (is_local_section_info(section_name) ||
-        (is_link_key(key) && RawAddress::IsValidAddress(section_name))) {
-      // remove this section that has the LinkKey from unpaired devices cache.
-      if (in_unpaired_cache) {
-        unpaired_devices_cache_.Remove(section_name);
-      }
+    cached->Set(std::move(key), std::move(value));
+    if (to_paired) {
       // when a unpaired section got the LinkKey, move this section to the
-      // paired devices list
-      paired_devices_list_.sections.emplace_back(std::move(section));
-    } else {
-      // update to the unpaired devices cache
-      unpaired_devices_cache_.Put(section_name, section);
+      // paired devices list and remove it from unpaired devices cache.
+      paired_devices_list_.sections.emplace_back(std::move(*cached));
+      unpaired_devices_cache_.Remove(section_name);
+      IndexPersistentSection(std::prev(paired_devices_list_.sections.end()));
     }
   } else {
     // already have section in paired device list, add key-value entry.
-    auto section_found = paired_devices_list_.Find(section_name);
-    if (section_found == paired_devices_list_.sections.end()) {
-      LOG(WARNING) << __func__ << " , section_found not found!";
+    auto entry_index = paired->entries.find(key);
+    if (entry_index != paired->entries.end()) {
+      entry_index->second->value = std::move(value);
       return;
     }
-    section_found->Set(key, value);
+    auto& entries = paired->section->entries;
+    entries.emplace_back(entry_t{key, std::move(value)});
+    paired->entries.emplace(std::move(key), std::prev(entries.end()));
   }
 }
 
 std::optional<std::string> BtifConfigCache::GetString(
     const std::string& section_name, const std::string& key) {
   // Check paired sections first
-  auto section_iter = paired_devices_list_.Find(section_name);
-  if (section_iter != paired_devices_list_.sections.end()) {
-    auto entry_iter = section_iter->Find(key);
-    if (entry_iter == section_iter->entries.end()) {
+  PersistentSectionIndex* paired = FindPersistentSection(section_name);
+  if (paired != nullptr) {
+    auto entry_index = paired->entries.find(key);
+    if (entry_index == paired->entries.end()) {
       return std::nullopt;
     }
-    return entry_iter->value;
+    return entry_index->second->value;
   }
   // Check unpaired sections later
-  section_t section = {};
-  if (!unpaired_devices_cache_.Get(section_name, &section)) {
+  section_t* section = unpaired_devices_cache_.Find(section_name);
+  if (section == nullptr) {
     return std::nullopt;
   }
-  auto entry_iter = section.Find(key);
-  if (entry_iter == section.entries.end()) {
+  auto entry_iter = section->Find(key);
+  if (entry_iter == section->entries.end()) {
     return std::nullopt;
   }
   return entry_iter->value;
@@ -16,17 +16,21 @@
  *
  ******************************************************************************/
 
-#include <mutex>
+#include <atomic>
+#include <memory>
+#include <new>
+#include <vector>
 
 #include <base/logging.h>
 #include <resolv.h>
+#include <string.h>
 #include <zlib.h>
 
 #include "btif/include/btif_debug.h"
 #include "btif/include/btif_debug_btsnoop.h"
 #include "hci/include/btsnoop_mem.h"
 #include "internal_include/bt_target.h"
-#include "osi/include/ringbuffer.h"
+#include "osi/include/properties.h"
 
 #define REDUCE_HCI_TYPE_TO_SIGNIFICANT_BITS(type) ((type) >> 8)
 
@@ -35,57 +39,151 @@
 static const size_t BTSNOOP_MEM_BUFFER_SIZE = (256 * 1024);
 #endif
 
+// Overrides BTSNOOP_MEM_BUFFER_SIZE, in bytes
+#define BTSNOOP_MEM_SIZE_PROPERTY "persist.bluetooth.btsnoopmemsize"
+// "headers" only keeps the first HEADER_RECORD_DATA_SIZE bytes of each
+// packet, enough for the HCI and L2CAP headers, which fits several times as
+// many packets in the same memory.
+#define BTSNOOP_MEM_MODE_PROPERTY "persist.bluetooth.btsnoopmemmode"
+#define BTSNOOP_MEM_MODE_HEADERS "headers"
+
+// Packet bytes kept per record, longer packets are truncated
+static const size_t FULL_RECORD_DATA_SIZE = 48;
+static const size_t HEADER_RECORD_DATA_SIZE = 8;
+
 // Block size for copying buffers (for compression/encoding etc.)
 static const size_t BLOCK_SIZE = 16384;
 
 // Maximum line length in bugreport (should be multiple of 4 for base64 output)
 static const uint8_t MAX_LINE_LENGTH = 128;
 
-static std::mutex buffer_mutex;
-static ringbuffer_t* buffer = NULL;
-static uint64_t last_timestamp_ms = 0;
+static const size_t HCI_ACL_HEADER_SIZE = 4;
+static const size_t L2CAP_HEADER_SIZE = 4;
+static const size_t L2CAP_CID_OFFSET = (HCI_ACL_HEADER_SIZE + 2);
+static const uint16_t L2CAP_SIGNALING_CID = 0x0001;
+
+// The memory log is a ring of fixed size records. A producer claims the next
+// record with a single atomic increment and overwrites whatever it held, so
+// capture never waits for another producer or for a dump. Each slot is a
+// seqlock: |sequence| is odd while the slot is being written and
+// 2 * (index + 1) once it holds record |index|, which lets a dump skip the
+// records overwritten while it reads them.
+typedef struct {
+  std::atomic<uint64_t> sequence;
+  uint64_t timestamp_us;
+  uint16_t packet_length;
+  uint8_t type;
+  uint8_t included_length;
+  // Followed by |record_data_size| bytes of packet data
+} record_slot_t;
+
+// A consistent copy of one record, taken by a dump
+typedef struct {
+  uint64_t timestamp_us;
+  uint16_t packet_length;
+  uint8_t type;
+  uint8_t included_length;
+  uint8_t data[FULL_RECORD_DATA_SIZE];
+} record_t;
+
+static std::unique_ptr<uint64_t[]> slots;
+static size_t slot_size = 0;
+static size_t slot_count = 0;
+static size_t record_data_size = 0;
+static std::atomic<uint64_t> next_record{0};
 
 static size_t btsnoop_calculate_packet_length(uint16_t type,
                                               const uint8_t* data,
                                               size_t length);
 
+static record_slot_t* get_slot(uint64_t index) {
+  uint8_t* base = reinterpret_cast<uint8_t*>(slots.get());
+  return reinterpret_cast<record_slot_t*>(base +
+                                          (index % slot_count) * slot_size);
+}
+
+static uint8_t* get_slot_data(record_slot_t* slot) {
+  return reinterpret_cast<uint8_t*>(slot) + sizeof(record_slot_t);
+}
+
 static void btsnoop_cb(const uint16_t type, const uint8_t* data,
                        const size_t length, const uint64_t timestamp_us) {
-  btsnooz_header_t header;
+  if (slot_count == 0) return;
 
   size_t included_length = btsnoop_calculate_packet_length(type, data, length);
   if (included_length == 0) return;
+  if (included_length > record_data_size) included_length = record_data_size;
 
-  std::lock_guard<std::mutex> lock(buffer_mutex);
+  uint64_t index = next_record.fetch_add(1, std::memory_order_relaxed);
+  record_slot_t* slot = get_slot(index);
+  slot->sequence.store(2 * index + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
 
-  // Make room in the ring buffer
+  slot->timestamp_us = timestamp_us;
+  slot->packet_length = length + 1;  // +1 for type byte
+  slot->type = REDUCE_HCI_TYPE_TO_SIGNIFICANT_BITS(type);
+  slot->included_length = included_length;
+  memcpy(get_slot_data(slot), data, included_length);
 
-  while (ringbuffer_available(buffer) <
-         (included_length + sizeof(btsnooz_header_t))) {
-    ringbuffer_pop(buffer, (uint8_t*)&header, sizeof(btsnooz_header_t));
-    ringbuffer_delete(buffer, header.length - 1);
-  }
+  slot->sequence.store(2 * index + 2, std::memory_order_release);
+}
 
-  // Insert data
-  header.type = REDUCE_HCI_TYPE_TO_SIGNIFICANT_BITS(type);
-  header.length = included_length + 1;  // +1 for type byte
-  header.packet_length = length + 1;    // +1 for type byte.
-  header.delta_time_ms =
-      last_timestamp_ms ? timestamp_us - last_timestamp_ms : 0;
-  last_timestamp_ms = timestamp_us;
+// Copies record |index| into |record|. Returns false if the record is being
+// written, or has already been overwritten by a newer one.
+static bool btsnoop_read_record(uint64_t index, record_t* record) {
+  record_slot_t* slot = get_slot(index);
+  uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+  if (sequence != 2 * index + 2) return false;
+
+  record->timestamp_us = slot->timestamp_us;
+  record->packet_length = slot->packet_length;
+  record->type = slot->type;
+  record->included_length = slot->included_length;
+  memcpy(record->data, get_slot_data(slot), record->included_length);
+
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return slot->sequence.load(std::memory_order_relaxed) == sequence;
+}
 
-  ringbuffer_insert(buffer, (uint8_t*)&header, sizeof(btsnooz_header_t));
-  ringbuffer_insert(buffer, data, included_length);
+static bool btsnoop_record_matches(const btsnoop_mem_filter_t* filter,
+                                   const record_t& record) {
+  if (filter == nullptr) return true;
+
+  if (filter->start_timestamp_us != 0 &&
+      record.timestamp_us < filter->start_timestamp_us)
+    return false;
+  if (filter->end_timestamp_us != 0 &&
+      record.timestamp_us > filter->end_timestamp_us)
+    return false;
+  if (!filter->match_handle && !filter->match_cid) return true;
+
+  if ((record.type != REDUCE_HCI_TYPE_TO_SIGNIFICANT_BITS(
+                          BT_EVT_TO_LM_HCI_ACL) &&
+       record.type != REDUCE_HCI_TYPE_TO_SIGNIFICANT_BITS(
+                          BT_EVT_TO_BTU_HCI_ACL)) ||
+      record.included_length < HCI_ACL_HEADER_SIZE)
+    return false;
+
+  uint16_t handle_and_flags = record.data[0] | (record.data[1] << 8);
+  if (filter->match_handle && (handle_and_flags & 0x0fff) != filter->handle)
+    return false;
+
+  if (filter->match_cid) {
+    // Only the first fragment of an L2CAP packet carries its header
+    const uint8_t CONTINUING_FRAGMENT = 0x1;
+    if (((handle_and_flags >> 12) & 0x3) == CONTINUING_FRAGMENT ||
+        record.included_length < L2CAP_CID_OFFSET + 2)
+      return false;
+    uint16_t cid = record.data[L2CAP_CID_OFFSET] |
+                   (record.data[L2CAP_CID_OFFSET + 1] << 8);
+    if (cid != filter->cid) return false;
+  }
+  return true;
 }
 
 static size_t btsnoop_calculate_packet_length(uint16_t type,
                                               const uint8_t* data,
                                               size_t length) {
-  static const size_t HCI_ACL_HEADER_SIZE = 4;
-  static const size_t L2CAP_HEADER_SIZE = 4;
-  static const size_t L2CAP_CID_OFFSET = (HCI_ACL_HEADER_SIZE + 2);
-  static const uint16_t L2CAP_SIGNALING_CID = 0x0001;
-
   // Maximum amount of ACL data to log.
   // Enough for an RFCOMM frame up to the frame check;
   // not enough for a HID report or audio data.
@@ -130,101 +228,187 @@ static size_t btsnoop_calculate_packet_length(uint16_t type,
   }
 }
 
-static bool btsnoop_compress(ringbuffer_t* rb_dst, ringbuffer_t* rb_src) {
-  CHECK(rb_dst != NULL);
-  CHECK(rb_src != NULL);
-
-  z_stream zs;
-  zs.zalloc = Z_NULL;
-  zs.zfree = Z_NULL;
-  zs.opaque = Z_NULL;
+// Deflates what it is given and writes it to |fd| base64 encoded, in lines of
+// MAX_LINE_LENGTH characters, so that a dump only ever holds a few blocks.
+class BtsnoozWriter {
+ public:
+  explicit BtsnoozWriter(int fd) : fd_(fd) {
+    zs_.zalloc = Z_NULL;
+    zs_.zfree = Z_NULL;
+    zs_.opaque = Z_NULL;
+  }
 
-  if (deflateInit(&zs, Z_DEFAULT_COMPRESSION) != Z_OK) return false;
+  ~BtsnoozWriter() {
+    if (initialized_) deflateEnd(&zs_);
+  }
 
-  bool rc = true;
-  uint8_t block_src[BLOCK_SIZE];
-  uint8_t block_dst[BLOCK_SIZE];
+  bool Init() {
+    initialized_ = deflateInit(&zs_, Z_DEFAULT_COMPRESSION) == Z_OK;
+    return initialized_;
+  }
 
-  const size_t num_blocks =
-      (ringbuffer_size(rb_src) + BLOCK_SIZE - 1) / BLOCK_SIZE;
-  for (size_t i = 0; i < num_blocks; ++i) {
-    zs.avail_in =
-        ringbuffer_peek(rb_src, i * BLOCK_SIZE, block_src, BLOCK_SIZE);
-    zs.next_in = block_src;
+  // Writes |data| as is, ahead of the compressed data
+  void WriteUncompressed(const uint8_t* data, size_t length) {
+    Encode(data, length);
+  }
 
+  bool Compress(const uint8_t* data, size_t length, bool finish) {
+    uint8_t block[BLOCK_SIZE];
+    zs_.next_in = const_cast<uint8_t*>(data);
+    zs_.avail_in = length;
     do {
-      zs.avail_out = BLOCK_SIZE;
-      zs.next_out = block_dst;
+      zs_.avail_out = BLOCK_SIZE;
+      zs_.next_out = block;
+      if (deflate(&zs_, finish ? Z_FINISH : Z_NO_FLUSH) == Z_STREAM_ERROR)
+        return false;
+      Encode(block, BLOCK_SIZE - zs_.avail_out);
+    } while (zs_.avail_out == 0);
+    return true;
+  }
 
-      int err = deflate(&zs, (i == num_blocks - 1) ? Z_FINISH : Z_NO_FLUSH);
-      if (err == Z_STREAM_ERROR) {
-        rc = false;
-        break;
-      }
+  // Writes out the last partial line
+  void Finish() {
+    if (!pending_.empty()) WriteLine(pending_.data(), pending_.size());
+    pending_.clear();
+  }
+
+ private:
+  // Input bytes that make up one full line of base64
+  static const size_t LINE_INPUT_SIZE = MAX_LINE_LENGTH / 4 * 3;
 
-      const size_t length = BLOCK_SIZE - zs.avail_out;
-      ringbuffer_insert(rb_dst, block_dst, length);
-    } while (zs.avail_out == 0);
+  void Encode(const uint8_t* data, size_t length) {
+    pending_.insert(pending_.end(), data, data + length);
+    size_t offset = 0;
+    while (pending_.size() - offset >= LINE_INPUT_SIZE) {
+      WriteLine(&pending_[offset], LINE_INPUT_SIZE);
+      offset += LINE_INPUT_SIZE;
+    }
+    pending_.erase(pending_.begin(), pending_.begin() + offset);
+  }
+
+  void WriteLine(const uint8_t* data, size_t length) {
+    char line[MAX_LINE_LENGTH + 1];
+    b64_ntop(data, length, line, sizeof(line));
+    dprintf(fd_, "%s%s", lines_written_ ? "\n" : "", line);
+    lines_written_ = true;
   }
 
-  deflateEnd(&zs);
-  return rc;
+  int fd_;
+  z_stream zs_;
+  bool initialized_ = false;
+  std::vector<uint8_t> pending_;
+  bool lines_written_ = false;
+};
+
+// Appends the btsnooz form of |record| to |out|
+static void btsnoop_append_record(const record_t& record,
+                                  uint64_t previous_timestamp_us,
+                                  std::vector<uint8_t>* out) {
+  btsnooz_header_t header;
+  header.type = record.type;
+  header.length = record.included_length + 1;  // +1 for type byte
+  header.packet_length = record.packet_length;
+  uint64_t delta_us = 0;
+  if (previous_timestamp_us != 0 &&
+      record.timestamp_us > previous_timestamp_us)
+    delta_us = record.timestamp_us - previous_timestamp_us;
+  header.delta_time_ms = delta_us > UINT32_MAX ? UINT32_MAX : delta_us;
+
+  const uint8_t* header_bytes = reinterpret_cast<const uint8_t*>(&header);
+  out->insert(out->end(), header_bytes, header_bytes + sizeof(header));
+  out->insert(out->end(), record.data, record.data + record.included_length);
 }
 
 void btif_debug_btsnoop_init(void) {
-  if (buffer == NULL) buffer = ringbuffer_init(BTSNOOP_MEM_BUFFER_SIZE);
+  if (slots == nullptr) {
+    char mode[PROPERTY_VALUE_MAX] = {0};
+    osi_property_get(BTSNOOP_MEM_MODE_PROPERTY, mode, "");
+    record_data_size = strcmp(mode, BTSNOOP_MEM_MODE_HEADERS) == 0
+                           ? HEADER_RECORD_DATA_SIZE
+                           : FULL_RECORD_DATA_SIZE;
+    slot_size = sizeof(record_slot_t) +
+                (record_data_size + sizeof(uint64_t) - 1) /
+                    sizeof(uint64_t) * sizeof(uint64_t);
+
+    int32_t buffer_size = osi_property_get_int32(BTSNOOP_MEM_SIZE_PROPERTY,
+                                                 BTSNOOP_MEM_BUFFER_SIZE);
+    if (buffer_size < static_cast<int32_t>(slot_size))
+      buffer_size = BTSNOOP_MEM_BUFFER_SIZE;
+    size_t count = buffer_size / slot_size;
+
+    slots.reset(new uint64_t[count * slot_size / sizeof(uint64_t)]);
+    slot_count = count;
+    for (uint64_t i = 0; i < slot_count; i++) {
+      // Sequence 0 never matches a record, the slot reads as empty
+      new (&get_slot(i)->sequence) std::atomic<uint64_t>(0);
+    }
+  }
   btsnoop_mem_set_callback(btsnoop_cb);
 }
 
-void btif_debug_btsnoop_dump(int fd) {
-  ringbuffer_t* ringbuffer = ringbuffer_init(BTSNOOP_MEM_BUFFER_SIZE);
-  if (ringbuffer == NULL) {
-    dprintf(fd, "%s Unable to allocate memory for compression", __func__);
-    return;
+void btif_debug_btsnoop_export(int fd, const btsnoop_mem_filter_t* filter) {
+  if (slot_count == 0) return;
+
+  uint64_t end = next_record.load(std::memory_order_relaxed);
+  uint64_t begin = end > slot_count ? end - slot_count : 0;
+
+  // The preamble holds the timestamp of the last record. Find that record
+  // first and keep a copy, so that it is still there when the stream ends.
+  record_t last_record;
+  uint64_t last_index = end;
+  for (uint64_t index = end; index > begin; index--) {
+    if (btsnoop_read_record(index - 1, &last_record) &&
+        btsnoop_record_matches(filter, last_record)) {
+      last_index = index - 1;
+      break;
+    }
   }
-
-  // Prepend preamble
+  bool found = last_index != end;
 
   btsnooz_preamble_t preamble;
   preamble.version = BTSNOOZ_CURRENT_VERSION;
-  preamble.last_timestamp_ms = last_timestamp_ms;
-  ringbuffer_insert(ringbuffer, (uint8_t*)&preamble,
-                    sizeof(btsnooz_preamble_t));
+  preamble.last_timestamp_ms = found ? last_record.timestamp_us : 0;
 
-  // Compress data
-
-  uint8_t b64_in[3] = {0};
-  char b64_out[5] = {0};
+  BtsnoozWriter writer(fd);
+  if (!writer.Init()) {
+    dprintf(fd, "%s Unable to initialize compression", __func__);
+    return;
+  }
 
-  size_t line_length = 0;
+  dprintf(fd, "--- BEGIN:BTSNOOP_LOG_SUMMARY (%zu records in) ---\n",
+          static_cast<size_t>(end - begin));
+  writer.WriteUncompressed(reinterpret_cast<const uint8_t*>(&preamble),
+                           sizeof(preamble));
 
-  bool rc;
-  {
-    std::lock_guard<std::mutex> lock(buffer_mutex);
-    dprintf(fd, "--- BEGIN:BTSNOOP_LOG_SUMMARY (%zu bytes in) ---\n",
-            ringbuffer_size(buffer));
-    rc = btsnoop_compress(ringbuffer, buffer);
+  // Capture keeps going while the records are streamed out, it may overwrite
+  // the oldest ones before they are read.
+  std::vector<uint8_t> block;
+  block.reserve(BLOCK_SIZE);
+  uint64_t previous_timestamp_us = 0;
+  bool rc = true;
+  record_t record;
+  for (uint64_t index = begin; rc && found && index < last_index; index++) {
+    if (!btsnoop_read_record(index, &record) ||
+        !btsnoop_record_matches(filter, record))
+      continue;
+    btsnoop_append_record(record, previous_timestamp_us, &block);
+    previous_timestamp_us = record.timestamp_us;
+    if (block.size() >=
+        BLOCK_SIZE - sizeof(btsnooz_header_t) - sizeof(record.data)) {
+      rc = writer.Compress(block.data(), block.size(), false);
+      block.clear();
+    }
   }
+  if (found) btsnoop_append_record(last_record, previous_timestamp_us, &block);
+  if (rc) rc = writer.Compress(block.data(), block.size(), true);
 
   if (!rc) {
     dprintf(fd, "%s Log compression failed", __func__);
-    goto error;
-  }
-
-  // Base64 encode & output
-
-  while (ringbuffer_size(ringbuffer) > 0) {
-    size_t read = ringbuffer_pop(ringbuffer, b64_in, 3);
-    if (line_length >= MAX_LINE_LENGTH) {
-      dprintf(fd, "\n");
-      line_length = 0;
-    }
-    line_length += b64_ntop(b64_in, read, b64_out, 5);
-    dprintf(fd, "%s", b64_out);
+    return;
   }
 
+  writer.Finish();
   dprintf(fd, "\n--- END:BTSNOOP_LOG_SUMMARY ---\n");
-
-error:
-  ringbuffer_free(ringbuffer);
 }
+
+void btif_debug_btsnoop_dump(int fd) { btif_debug_btsnoop_export(fd, nullptr); }
@@ -0,0 +1,112 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "btif/include/btif_deferred_init.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "common/time_util.h"
+
+namespace {
+
+struct DeferredComponent {
+  bool constructed = false;
+  uint32_t constructions = 0;
+  uint64_t construct_duration_us = 0;
+  int64_t construct_rss_bytes = 0;
+};
+
+std::mutex deferred_mutex;
+std::map<std::string, DeferredComponent> deferred_components;
+
+// Returns the resident set size of the process, 0 when unavailable
+int64_t get_rss_bytes() {
+  FILE* statm = fopen("/proc/self/statm", "r");
+  if (statm == nullptr) return 0;
+  long size_pages = 0;
+  long resident_pages = 0;
+  int fields = fscanf(statm, "%ld %ld", &size_pages, &resident_pages);
+  fclose(statm);
+  if (fields != 2) return 0;
+  return static_cast<int64_t>(resident_pages) * sysconf(_SC_PAGESIZE);
+}
+
+}  // namespace
+
+void btif_deferred_init_register(const char* name) {
+  std::lock_guard<std::mutex> lock(deferred_mutex);
+  deferred_components[name];
+}
+
+void btif_deferred_init_construct(const char* name,
+                                  const std::function<void()>& construct) {
+  int64_t rss_before = get_rss_bytes();
+  uint64_t start_us = bluetooth::common::time_get_os_boottime_us();
+  construct();
+  uint64_t duration_us =
+      bluetooth::common::time_get_os_boottime_us() - start_us;
+  int64_t rss_growth = get_rss_bytes() - rss_before;
+
+  std::lock_guard<std::mutex> lock(deferred_mutex);
+  DeferredComponent& component = deferred_components[name];
+  component.constructed = true;
+  component.constructions++;
+  component.construct_duration_us = duration_us;
+  component.construct_rss_bytes = rss_growth > 0 ? rss_growth : 0;
+}
+
+void btif_deferred_init_release(const char* name) {
+  std::lock_guard<std::mutex> lock(deferred_mutex);
+  auto component = deferred_components.find(name);
+  if (component != deferred_components.end()) {
+    component->second.constructed = false;
+  }
+}
+
+void btif_deferred_init_dump(int fd) {
+  std::lock_guard<std::mutex> lock(deferred_mutex);
+  // Components constructed at least once tell what bring-up would have paid,
+  // the others were never needed at all
+  uint64_t saved_us = 0;
+  int64_t saved_rss_bytes = 0;
+  size_t never_constructed = 0;
+  dprintf(fd, "\nDeferred profile initialization:\n");
+  for (const auto& entry : deferred_components) {
+    const DeferredComponent& component = entry.second;
+    if (component.constructions == 0) {
+      dprintf(fd, "  %-32s not constructed\n", entry.first.c_str());
+      never_constructed++;
+      continue;
+    }
+    dprintf(fd,
+            "  %-32s %s, constructed %u times, last construction %" PRIu64
+            " us, RSS +%" PRId64 " KiB\n",
+            entry.first.c_str(), component.constructed ? "active" : "released",
+            component.constructions, component.construct_duration_us,
+            component.construct_rss_bytes / 1024);
+    saved_us += component.construct_duration_us;
+    saved_rss_bytes += component.construct_rss_bytes;
+  }
+  dprintf(fd,
+          "  Start up saved %" PRIu64 " us, RSS %" PRId64
+          " KiB, %zu components never constructed\n",
+          saved_us, saved_rss_bytes / 1024, never_constructed);
+}
@@ -39,7 +39,9 @@
 #include <time.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <mutex>
+#include <vector>
 
 #include <bluetooth/uuid.h>
 #include <hardware/bluetooth.h>
@@ -56,6 +58,7 @@
 #include "btif_hd.h"
 #include "btif_hf.h"
 #include "btif_hh.h"
+#include "btif_property_arena.h"
 #include "btif_sdp.h"
 #include "btif_storage.h"
 #include "btif_util.h"
@@ -211,12 +214,36 @@ static size_t btif_num_bond_events = 0;
 static size_t btif_events_start_index = 0;
 static size_t btif_events_end_index = 0;
 
+/* Search results arrive in bursts during discovery. They cross to btif
+ * context in batches: the parameters of the queued events are copied into an
+ * arena, and one task executes them all. Two arenas take turns, one is filled
+ * while the events of the other are executed. */
+typedef struct {
+  uint16_t event;
+  char* p_param;
+} tBTIF_DM_SEARCH_BATCH_EVT;
+
+static struct {
+  std::mutex mutex;
+  std::vector<tBTIF_DM_SEARCH_BATCH_EVT> events;
+  BtifPropertyArena arenas[2];
+  int filling_arena = 0;
+  bool posted = false;
+  size_t total_events = 0;
+  size_t total_batches = 0;
+  size_t max_batch_size = 0;
+} search_batch;
+
+/* Property values of the search result being reported, in btif context */
+static BtifPropertyArena search_property_arena;
+
 /******************************************************************************
  *  Static functions
  *****************************************************************************/
 static btif_dm_pairing_cb_t pairing_cb;
 static btif_dm_oob_cb_t oob_cb;
 static void btif_dm_generic_evt(uint16_t event, char* p_param);
+static void btif_dm_search_devices_evt(uint16_t event, char* p_param);
 static void btif_dm_cb_create_bond(const RawAddress& bd_addr,
                                    tBTA_TRANSPORT transport);
 static void btif_dm_cb_hid_remote_name(tBTM_REMOTE_DEV_NAME* p_remote_name);
@@ -352,13 +379,22 @@ static bool check_eir_remote_name(tBTA_DM_SEARCH* p_search_data,
 
   /* Check EIR for remote name and services */
   if (p_search_data->inq_res.p_eir) {
-    p_eir_remote_name = AdvertiseDataParser::GetFieldByType(
-        p_search_data->inq_res.p_eir, p_search_data->inq_res.eir_len,
-        BTM_EIR_COMPLETE_LOCAL_NAME_TYPE, &remote_name_len);
-    if (!p_eir_remote_name) {
+    const tBTM_EIR_INFO& eir_info = p_search_data->inq_res.eir_info;
+    if (eir_info.len != 0) {
+      /* The EIR was already decoded by the stack */
+      if (eir_info.name_offset != 0) {
+        p_eir_remote_name = p_search_data->inq_res.p_eir + eir_info.name_offset;
+        remote_name_len = eir_info.name_len;
+      }
+    } else {
       p_eir_remote_name = AdvertiseDataParser::GetFieldByType(
           p_search_data->inq_res.p_eir, p_search_data->inq_res.eir_len,
-          BTM_EIR_SHORTENED_LOCAL_NAME_TYPE, &remote_name_len);
+          BTM_EIR_COMPLETE_LOCAL_NAME_TYPE, &remote_name_len);
+      if (!p_eir_remote_name) {
+        p_eir_remote_name = AdvertiseDataParser::GetFieldByType(
+            p_search_data->inq_res.p_eir, p_search_data->inq_res.eir_len,
+            BTM_EIR_SHORTENED_LOCAL_NAME_TYPE, &remote_name_len);
+      }
     }
 
     if (p_eir_remote_name) {
@@ -678,6 +714,8 @@ static void btif_dm_cb_create_bond(const RawAddress& bd_addr,
   int addr_type;
   std::string addrstr = bd_addr.ToString();
   const char* bdstr = addrstr.c_str();
+  /* The types are read straight from the config below */
+  btif_storage_flush_scanned_device(bd_addr);
   if (transport == BT_TRANSPORT_LE) {
     if (!btif_config_get_int(bdstr, "DevType", &device_type)) {
       btif_config_set_int(bdstr, "DevType", BT_DEVICE_TYPE_BLE);
@@ -1273,58 +1311,80 @@ static void btif_dm_search_devices_evt(uint16_t event, char* p_param) {
       /* inquiry result */
       bt_bdname_t bdname;
       uint8_t remote_name_len;
-      tBTA_SERVICE_MASK services = 0;
 
       p_search_data = (tBTA_DM_SEARCH*)p_param;
       RawAddress& bdaddr = p_search_data->inq_res.bd_addr;
+      /* A repeated result of a device only carries what changed */
+      tBTM_INQ_CHANGED changed = p_search_data->inq_res.changed;
+      bool report_all = changed == 0 || (changed & BTM_INQ_CHANGED_NEW);
 
-      BTIF_TRACE_DEBUG("%s() %s device_type = 0x%x\n", __func__,
+      BTIF_TRACE_DEBUG("%s() %s device_type = 0x%x changed = 0x%x", __func__,
                        bdaddr.ToString().c_str(),
-                       p_search_data->inq_res.device_type);
+                       p_search_data->inq_res.device_type, changed);
       bdname.name[0] = 0;
 
-      if (!check_eir_remote_name(p_search_data, bdname.name, &remote_name_len))
-        check_cached_remote_name(p_search_data, bdname.name, &remote_name_len);
-
-      /* Check EIR for remote name and services */
-      if (p_search_data->inq_res.p_eir) {
-        BTA_GetEirService(p_search_data->inq_res.p_eir,
-                          p_search_data->inq_res.eir_len, &services);
-        BTIF_TRACE_DEBUG("%s()EIR BTA services = %08X", __func__,
-                         (uint32_t)services);
-        /* TODO:  Get the service list and check to see which uuids we got and
-         * send it back to the client. */
+      if (report_all || (changed & BTM_INQ_CHANGED_NAME)) {
+        if (!check_eir_remote_name(p_search_data, bdname.name,
+                                   &remote_name_len) &&
+            report_all)
+          check_cached_remote_name(p_search_data, bdname.name,
+                                   &remote_name_len);
+      }
+
+      /* TODO:  Get the service list and check to see which uuids we got and
+       * send it back to the client. */
+
+      if (!report_all && bdname.name[0] == 0 &&
+          (changed & BTM_INQ_CHANGED_RSSI) == 0) {
+        /* nothing but the address to report */
+        break;
+      }
+
+      /* The property values are copied, the arena is released with the
+       * next result */
+      search_property_arena.Reset();
+
+      if (!report_all) {
+        BtifPropertyBuilder properties(&search_property_arena, 3);
+        properties.Add(BT_PROPERTY_BDADDR, &bdaddr, sizeof(bdaddr));
+        if (bdname.name[0]) {
+          properties.Add(BT_PROPERTY_BDNAME, &bdname,
+                         strlen((char*)bdname.name));
+        }
+        if (changed & BTM_INQ_CHANGED_RSSI) {
+          properties.Add(BT_PROPERTY_REMOTE_RSSI,
+                         &(p_search_data->inq_res.rssi), sizeof(int8_t));
+        }
+
+        bt_status_t status = btif_storage_add_remote_device(
+            &bdaddr, properties.size(), properties.properties());
+        ASSERTC(status == BT_STATUS_SUCCESS,
+                "failed to save remote device (inquiry)", status);
+        HAL_CBACK(bt_hal_cbacks, device_found_cb, properties.size(),
+                  properties.properties());
+        break;
       }
 
       {
-        bt_property_t properties[5];
+        BtifPropertyBuilder properties(&search_property_arena, 5);
         bt_device_type_t dev_type;
-        uint32_t num_properties = 0;
         bt_status_t status;
         int addr_type = 0;
 
-        memset(properties, 0, sizeof(properties));
         /* RawAddress */
-        BTIF_STORAGE_FILL_PROPERTY(&properties[num_properties],
-                                   BT_PROPERTY_BDADDR, sizeof(bdaddr), &bdaddr);
-        num_properties++;
+        properties.Add(BT_PROPERTY_BDADDR, &bdaddr, sizeof(bdaddr));
         /* BD_NAME */
         /* Don't send BDNAME if it is empty */
         if (bdname.name[0]) {
-          BTIF_STORAGE_FILL_PROPERTY(&properties[num_properties],
-                                     BT_PROPERTY_BDNAME,
-                                     strlen((char*)bdname.name), &bdname);
-          num_properties++;
+          properties.Add(BT_PROPERTY_BDNAME, &bdname,
+                         strlen((char*)bdname.name));
         }
 
         /* DEV_CLASS */
         uint32_t cod = devclass2uint(p_search_data->inq_res.dev_class);
         BTIF_TRACE_DEBUG("%s cod is 0x%06x", __func__, cod);
         if (cod != 0) {
-          BTIF_STORAGE_FILL_PROPERTY(&properties[num_properties],
-                                     BT_PROPERTY_CLASS_OF_DEVICE, sizeof(cod),
-                                     &cod);
-          num_properties++;
+          properties.Add(BT_PROPERTY_CLASS_OF_DEVICE, &cod, sizeof(cod));
         }
 
         /* DEV_TYPE */
@@ -1344,25 +1404,21 @@ static void btif_dm_search_devices_evt(uint16_t event, char* p_param) {
 
         if (p_search_data->inq_res.device_type == BT_DEVICE_TYPE_BLE)
           addr_type = p_search_data->inq_res.ble_addr_type;
-        BTIF_STORAGE_FILL_PROPERTY(&properties[num_properties],
-                                   BT_PROPERTY_TYPE_OF_DEVICE, sizeof(dev_type),
-                                   &dev_type);
-        num_properties++;
+        properties.Add(BT_PROPERTY_TYPE_OF_DEVICE, &dev_type, sizeof(dev_type));
         /* RSSI */
-        BTIF_STORAGE_FILL_PROPERTY(&properties[num_properties],
-                                   BT_PROPERTY_REMOTE_RSSI, sizeof(int8_t),
-                                   &(p_search_data->inq_res.rssi));
-        num_properties++;
+        properties.Add(BT_PROPERTY_REMOTE_RSSI, &(p_search_data->inq_res.rssi),
+                       sizeof(int8_t));
 
-        status =
-            btif_storage_add_remote_device(&bdaddr, num_properties, properties);
+        status = btif_storage_add_remote_device(&bdaddr, properties.size(),
+                                                properties.properties());
         ASSERTC(status == BT_STATUS_SUCCESS,
                 "failed to save remote device (inquiry)", status);
         status = btif_storage_set_remote_addr_type(&bdaddr, addr_type);
         ASSERTC(status == BT_STATUS_SUCCESS,
                 "failed to save remote addr type (inquiry)", status);
         /* Callback to notify upper layer of device */
-        HAL_CBACK(bt_hal_cbacks, device_found_cb, num_properties, properties);
+        HAL_CBACK(bt_hal_cbacks, device_found_cb, properties.size(),
+                  properties.properties());
       }
     } break;
 
@@ -1887,7 +1943,8 @@ static void btif_dm_upstreams_evt(uint16_t event, char* p_param) {
       if (cmn_vsc_cb.filter_support == 1)
         local_le_features.max_adv_filter_supported = cmn_vsc_cb.max_filter;
       else
-        local_le_features.max_adv_filter_supported = 0;
+        local_le_features.max_adv_filter_supported =
+            BTM_BleHostFilterMaxFilters();
       local_le_features.max_adv_instance = cmn_vsc_cb.adv_inst_max;
       local_le_features.max_irk_list_size = cmn_vsc_cb.max_irk_list_sz;
       local_le_features.rpa_offload_supported = cmn_vsc_cb.rpa_offloading;
@@ -2031,6 +2088,73 @@ void bte_dm_evt(tBTA_DM_SEC_EVT event, tBTA_DM_SEC* p_data) {
   ASSERTC(status == BT_STATUS_SUCCESS, "context transfer failed", status);
 }
 
+/*******************************************************************************
+ *
+ * Function         btif_dm_deliver_search_batch
+ *
+ * Description      Executes the search devices events queued since the last
+ *                  batch, in btif context
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void btif_dm_deliver_search_batch(void) {
+  std::vector<tBTIF_DM_SEARCH_BATCH_EVT> events;
+  BtifPropertyArena* arena;
+  {
+    std::lock_guard<std::mutex> lock(search_batch.mutex);
+    events.swap(search_batch.events);
+    arena = &search_batch.arenas[search_batch.filling_arena];
+    search_batch.filling_arena ^= 1;
+    search_batch.posted = false;
+  }
+
+  for (const auto& evt : events) {
+    btif_dm_search_devices_evt(evt.event, evt.p_param);
+  }
+  /* The producers fill the other arena until the next batch */
+  arena->Reset();
+  events.clear();
+  std::lock_guard<std::mutex> lock(search_batch.mutex);
+  if (search_batch.events.empty()) search_batch.events.swap(events);
+}
+
+/*******************************************************************************
+ *
+ * Function         btif_dm_queue_search_event
+ *
+ * Description      Copies a search devices event into the pending batch, and
+ *                  posts the batch to btif context unless it is already
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void btif_dm_queue_search_event(uint16_t event, char* p_params,
+                                       int param_len,
+                                       tBTIF_COPY_CBACK* p_copy_cback) {
+  std::lock_guard<std::mutex> lock(search_batch.mutex);
+  char* p_param = nullptr;
+  if (p_params != nullptr) {
+    p_param = (char*)search_batch.arenas[search_batch.filling_arena].Alloc(
+        param_len);
+    if (p_copy_cback) {
+      p_copy_cback(event, p_param, p_params);
+    } else {
+      memcpy(p_param, p_params, param_len);
+    }
+  }
+  search_batch.events.push_back({event, p_param});
+  search_batch.total_events++;
+  search_batch.max_batch_size =
+      std::max(search_batch.max_batch_size, search_batch.events.size());
+  if (search_batch.posted) return;
+
+  search_batch.posted =
+      do_in_jni_thread(FROM_HERE, base::Bind(&btif_dm_deliver_search_batch)) ==
+      BT_STATUS_SUCCESS;
+  if (search_batch.posted) search_batch.total_batches++;
+}
+
 /*******************************************************************************
  *
  * Function         bte_search_devices_evt
@@ -2066,8 +2190,8 @@ static void bte_search_devices_evt(tBTA_DM_SEARCH_EVT event,
     p_data->inq_res.remt_name_not_required =
         check_eir_remote_name(p_data, NULL, NULL);
 
-  btif_transfer_context(
-      btif_dm_search_devices_evt, (uint16_t)event, (char*)p_data, param_len,
+  btif_dm_queue_search_event(
+      (uint16_t)event, (char*)p_data, param_len,
       (param_len > sizeof(tBTA_DM_SEARCH)) ? search_devices_copy_cb : NULL);
 }
 
@@ -3318,6 +3442,14 @@ static void btif_stats_add_bond_event(const RawAddress& bd_addr,
 }
 
 void btif_debug_bond_event_dump(int fd) {
+  {
+    std::lock_guard<std::mutex> lock(search_batch.mutex);
+    dprintf(fd,
+            "\nSearch Result Batches: events:%zu batches:%zu max batch:%zu\n",
+            search_batch.total_events, search_batch.total_batches,
+            search_batch.max_batch_size);
+  }
+
   std::unique_lock<std::mutex> lock(bond_event_lock);
   dprintf(fd, "\nBond Events: \n");
   dprintf(fd, "  Total Number of events: %zu\n", btif_num_bond_events);
@@ -33,6 +33,7 @@
 #include <hardware/bluetooth.h>
 #include <stdlib.h>
 #include <string.h>
+#include <mutex>
 #include "device/include/controller.h"
 
 #include "btif_common.h"
@@ -47,6 +48,7 @@
 #include "btif_gatt.h"
 #include "btif_gatt_util.h"
 #include "btif_storage.h"
+#include "osi/include/allocator.h"
 #include "osi/include/log.h"
 #include "stack/include/btu.h"
 #include "vendor_api.h"
@@ -115,25 +117,6 @@ void btif_gattc_upstreams_evt(uint16_t event, char* p_param) {
       break;
     }
 
-    case BTA_GATTC_NOTIF_EVT: {
-      btgatt_notify_params_t data;
-
-      data.bda = p_data->notify.bda;
-      memcpy(data.value, p_data->notify.value, p_data->notify.len);
-
-      data.handle = p_data->notify.handle;
-      data.is_notify = p_data->notify.is_notify;
-      data.len = p_data->notify.len;
-
-      HAL_CBACK(bt_gatt_callbacks, client->notify_cb, p_data->notify.conn_id,
-                data);
-
-      if (!p_data->notify.is_notify)
-        BTA_GATTC_SendIndConfirm(p_data->notify.conn_id, p_data->notify.handle);
-
-      break;
-    }
-
     case BTA_GATTC_OPEN_EVT: {
       DVLOG(1) << "BTA_GATTC_OPEN_EVT " << p_data->open.remote_bda;
       HAL_CBACK(bt_gatt_callbacks, client->open_cb, p_data->open.conn_id,
@@ -200,7 +183,98 @@ void btif_gattc_upstreams_evt(uint16_t event, char* p_param) {
   }
 }
 
+/* Notifications are the hot path of sensor and HID streaming. They don't go
+ * through btif_transfer_context, which copies the whole tBTA_GATTC: the HAL
+ * parameters are built once, in a pooled block, from the bta event. The
+ * notifications received before the JNI thread gets to them are delivered by
+ * one task, in order. */
+constexpr size_t kMaxPooledNotifications = 32;
+
+struct PendingNotification {
+  uint16_t conn_id;
+  btgatt_notify_params_t* params;
+};
+
+struct {
+  std::mutex mutex;
+  std::vector<btgatt_notify_params_t*> pool;
+  std::vector<PendingNotification> pending;
+  // Swapped with |pending| by the delivery task, keeps its capacity
+  std::vector<PendingNotification> delivering;
+  bool delivery_posted = false;
+} notification_queue;
+
+btgatt_notify_params_t* btif_gattc_notification_get() {
+  {
+    std::lock_guard<std::mutex> lock(notification_queue.mutex);
+    if (!notification_queue.pool.empty()) {
+      btgatt_notify_params_t* params = notification_queue.pool.back();
+      notification_queue.pool.pop_back();
+      return params;
+    }
+  }
+  return (btgatt_notify_params_t*)osi_malloc(sizeof(btgatt_notify_params_t));
+}
+
+/* Must be called with |notification_queue.mutex| held */
+void btif_gattc_notification_put_locked(btgatt_notify_params_t* params) {
+  if (notification_queue.pool.size() < kMaxPooledNotifications) {
+    notification_queue.pool.push_back(params);
+  } else {
+    osi_free(params);
+  }
+}
+
+void btif_gattc_deliver_notifications() {
+  std::vector<PendingNotification>& batch = notification_queue.delivering;
+  {
+    std::lock_guard<std::mutex> lock(notification_queue.mutex);
+    batch.swap(notification_queue.pending);
+    notification_queue.delivery_posted = false;
+  }
+
+  for (const PendingNotification& notification : batch) {
+    HAL_CBACK(bt_gatt_callbacks, client->notify_cb, notification.conn_id,
+              *notification.params);
+    if (!notification.params->is_notify)
+      BTA_GATTC_SendIndConfirm(notification.conn_id,
+                               notification.params->handle);
+  }
+
+  std::lock_guard<std::mutex> lock(notification_queue.mutex);
+  for (const PendingNotification& notification : batch)
+    btif_gattc_notification_put_locked(notification.params);
+  batch.clear();
+}
+
+void btif_gattc_queue_notification(const tBTA_GATTC_NOTIFY& notify) {
+  btgatt_notify_params_t* params = btif_gattc_notification_get();
+  params->bda = notify.bda;
+  memcpy(params->value, notify.value, notify.len);
+  params->handle = notify.handle;
+  params->is_notify = notify.is_notify;
+  params->len = notify.len;
+
+  bool post;
+  {
+    std::lock_guard<std::mutex> lock(notification_queue.mutex);
+    notification_queue.pending.push_back({notify.conn_id, params});
+    post = !notification_queue.delivery_posted;
+    notification_queue.delivery_posted = true;
+  }
+  if (!post) return;
+
+  bt_status_t status =
+      do_in_jni_thread(FROM_HERE, base::Bind(btif_gattc_deliver_notifications));
+  ASSERTC(status == BT_STATUS_SUCCESS, "Context transfer failed!", status);
+}
+
 void bta_gattc_cback(tBTA_GATTC_EVT event, tBTA_GATTC* p_data) {
+  if (event == BTA_GATTC_NOTIF_EVT) {
+    btif_gattc_queue_notification(p_data->notify);
+    return;
+  }
+
   bt_status_t status =
       btif_transfer_context(btif_gattc_upstreams_evt, (uint16_t)event,
                             (char*)p_data, sizeof(tBTA_GATTC), NULL);
@@ -581,6 +655,7 @@ bt_status_t btif_gattc_read_phy(
 int btif_gattc_get_device_type(const RawAddress& bd_addr) {
   int device_type = 0;
 
+  btif_storage_flush_scanned_device(bd_addr);
   if (btif_config_get_int(bd_addr.ToString().c_str(), "DevType", &device_type))
     return device_type;
   return 0;
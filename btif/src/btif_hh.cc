@@ -488,8 +488,7 @@ void btif_hh_remove_device(RawAddress bd_addr) {
     BTIF_TRACE_WARNING("%s: device_num = 0", __func__);
   }
 
-  p_dev->hh_keep_polling = 0;
-  p_dev->hh_poll_thread_id = -1;
+  btif_hh_stop_uhid_polling(p_dev);
   BTIF_TRACE_DEBUG("%s: uhid fd = %d", __func__, p_dev->fd);
   if (p_dev->fd >= 0) {
     bta_hh_co_destroy(p_dev->fd);
@@ -1652,14 +1651,14 @@ static void cleanup(void) {
     p_dev = &btif_hh_cb.devices[i];
     if (p_dev->dev_status != BTHH_CONN_STATE_UNKNOWN && p_dev->fd >= 0) {
       BTIF_TRACE_DEBUG("%s: Closing uhid fd = %d", __func__, p_dev->fd);
+      btif_hh_stop_uhid_polling(p_dev);
       if (p_dev->fd >= 0) {
         bta_hh_co_destroy(p_dev->fd);
         p_dev->fd = -1;
       }
-      p_dev->hh_keep_polling = 0;
-      p_dev->hh_poll_thread_id = -1;
     }
   }
+  btif_hh_free_io_thread();
 
 }
 
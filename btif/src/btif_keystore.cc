@@ -24,6 +24,9 @@
 #include <base/logging.h>
 #include <hardware/bluetooth.h>
 #include <map>
+#include <mutex>
+#include <string>
+#include <vector>
 
 using base::Bind;
 using base::Unretained;
@@ -35,16 +38,33 @@ namespace bluetooth_keystore {
 class BluetoothKeystoreInterfaceImpl;
 std::unique_ptr<BluetoothKeystoreInterface> bluetoothKeystoreInstance;
 
+// Overwrites the characters of a secret before it is released.
+static void secure_erase(std::string* value) {
+  volatile char* p = &(*value)[0];
+  for (size_t i = 0; i < value->size(); i++) p[i] = 0;
+  value->clear();
+}
+
+static void secure_erase(std::map<std::string, std::string>* keys) {
+  for (auto& key : *keys) secure_erase(&key.second);
+  keys->clear();
+}
+
 class BluetoothKeystoreInterfaceImpl
     : public bluetooth::bluetooth_keystore::BluetoothKeystoreInterface,
       public bluetooth::bluetooth_keystore::BluetoothKeystoreCallbacks {
-  ~BluetoothKeystoreInterfaceImpl() override = default;
+  ~BluetoothKeystoreInterfaceImpl() override {
+    secure_erase(&key_map);
+    secure_erase(&pending_keys);
+  }
 
   void init(BluetoothKeystoreCallbacks* callbacks) override {
     VLOG(2) << __func__;
     this->callbacks = callbacks;
   }
 
+  // The keys set while a write is pending are written by the same
+  // round trip.
   void set_encrypt_key_or_remove_key(std::string prefix,
                                      std::string decryptedString) override {
     VLOG(2) << __func__ << " prefix: " << prefix;
@@ -54,13 +74,19 @@ class BluetoothKeystoreInterfaceImpl
       return;
     }
 
+    std::lock_guard<std::mutex> lock(key_mutex);
     // Save the value into a map.
+    secure_erase(&key_map[prefix]);
     key_map[prefix] = decryptedString;
-
-    do_in_jni_thread(
-        base::Bind(&bluetooth::bluetooth_keystore::BluetoothKeystoreCallbacks::
-                       set_encrypt_key_or_remove_key,
-                   base::Unretained(callbacks), prefix, decryptedString));
+    secure_erase(&pending_keys[prefix]);
+    pending_keys[prefix] = decryptedString;
+    secure_erase(&decryptedString);
+
+    if (!write_pending) {
+      write_pending = true;
+      do_in_jni_thread(Bind(&BluetoothKeystoreInterfaceImpl::write_keys,
+                            Unretained(this)));
+    }
   }
 
   std::string get_key(std::string prefix) override {
@@ -71,31 +97,79 @@ class BluetoothKeystoreInterfaceImpl
       return "";
     }
 
-    std::string decryptedString;
-    // try to find the key.
-    std::map<std::string, std::string>::iterator iter = key_map.find(prefix);
-    if (iter == key_map.end()) {
-      decryptedString = callbacks->get_key(prefix);
-      // Save the value into a map.
-      key_map[prefix] = decryptedString;
-      VLOG(2) << __func__ << ": get key from bluetoothkeystore.";
-    } else {
-      decryptedString = iter->second;
+    {
+      // try to find the key.
+      std::lock_guard<std::mutex> lock(key_mutex);
+      auto iter = key_map.find(prefix);
+      if (iter != key_map.end()) return iter->second;
     }
-    return decryptedString;
+
+    std::string decryptedString = callbacks->get_key(prefix);
+    VLOG(2) << __func__ << ": get key from bluetoothkeystore.";
+
+    // Save the value into a map, unless it was set in the meantime.
+    std::lock_guard<std::mutex> lock(key_mutex);
+    auto result = key_map.emplace(prefix, decryptedString);
+    if (!result.second) secure_erase(&decryptedString);
+    return result.first->second;
+  }
+
+  void prefetch_keys(const std::vector<std::string>& prefixes) override {
+    if (!callbacks) {
+      LOG(WARNING) << __func__ << " callback isn't ready";
+      return;
+    }
+
+    std::vector<std::string> missing;
+    {
+      std::lock_guard<std::mutex> lock(key_mutex);
+      for (const std::string& prefix : prefixes) {
+        if (key_map.find(prefix) == key_map.end()) missing.push_back(prefix);
+      }
+    }
+    if (missing.empty()) return;
+
+    VLOG(2) << __func__ << ": get " << missing.size()
+            << " keys from bluetoothkeystore.";
+    std::map<std::string, std::string> keys = callbacks->get_keys(missing);
+
+    std::lock_guard<std::mutex> lock(key_mutex);
+    for (auto& key : keys) {
+      if (key_map.find(key.first) == key_map.end()) {
+        key_map[key.first] = key.second;
+      }
+    }
+    secure_erase(&keys);
   }
 
   void clear_map() override {
     VLOG(2) << __func__;
 
-    std::map<std::string, std::string> empty_map;
-    key_map.swap(empty_map);
-    key_map.clear();
+    std::lock_guard<std::mutex> lock(key_mutex);
+    secure_erase(&key_map);
   }
 
  private:
+  // Writes the keys set since the last write, in one round trip. Runs on the
+  // JNI thread.
+  void write_keys() {
+    std::map<std::string, std::string> keys;
+    {
+      std::lock_guard<std::mutex> lock(key_mutex);
+      keys.swap(pending_keys);
+      write_pending = false;
+    }
+
+    VLOG(2) << __func__ << ": " << keys.size() << " keys";
+    callbacks->set_encrypt_keys_or_remove_keys(keys);
+    secure_erase(&keys);
+  }
+
   BluetoothKeystoreCallbacks* callbacks = nullptr;
+  std::mutex key_mutex;  // protects the members below
   std::map<std::string, std::string> key_map;
+  std::map<std::string, std::string> pending_keys;
+  bool write_pending = false;
 };
 
 BluetoothKeystoreInterface* getBluetoothKeystoreInterface() {
@@ -42,10 +42,10 @@
 #include <stdio.h>
 #include <string.h>
 #include <sys/ioctl.h>
-#include <sys/poll.h>
 #include <sys/prctl.h>
 #include <sys/select.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
@@ -56,6 +56,7 @@
 #include "bta_api.h"
 #include "bta_pan_api.h"
 #include "btif_common.h"
+#include "btif_pan.h"
 #include "btif_pan_internal.h"
 #include "btif_sock_thread.h"
 #include "btif_sock_util.h"
@@ -88,8 +89,6 @@
                        __func__, #s, __LINE__)                           \
   } while (0)
 
-#define MIN(x, y) (((x) < (y)) ? (x) : (y))
-
 btpan_cb_t btpan_cb;
 
 static bool jni_initialized;
@@ -417,19 +416,30 @@ int btpan_tap_send(int tap_fd, const RawAddress& src, const RawAddress& dst,
     eth_hdr.h_dest = dst;
     eth_hdr.h_src = src;
     eth_hdr.h_proto = htons(proto);
-    char packet[TAP_MAX_PKT_WRITE_LEN + sizeof(tETH_HDR)];
-    memcpy(packet, &eth_hdr, sizeof(tETH_HDR));
     if (len > TAP_MAX_PKT_WRITE_LEN) {
       LOG_ERROR(LOG_TAG, "btpan_tap_send eth packet size:%d is exceeded limit!",
                 len);
+      btpan_cb.stats.tap_write_errors++;
       return -1;
     }
-    memcpy(packet + sizeof(tETH_HDR), buf, len);
 
-    /* Send data to network interface */
+    /* Send data to network interface. The TAP driver takes one frame per
+     * write, so the header and the payload are gathered rather than copied
+     * together. */
+    struct iovec iov[2];
+    iov[0].iov_base = &eth_hdr;
+    iov[0].iov_len = sizeof(tETH_HDR);
+    iov[1].iov_base = (void*)buf;
+    iov[1].iov_len = len;
     ssize_t ret;
-    OSI_NO_INTR(ret = write(tap_fd, packet, len + sizeof(tETH_HDR)));
+    OSI_NO_INTR(ret = writev(tap_fd, iov, 2));
     BTIF_TRACE_DEBUG("ret:%d", ret);
+    if (ret < 0) {
+      btpan_cb.stats.tap_write_errors++;
+    } else {
+      btpan_cb.stats.tap_write_frames++;
+      btpan_cb.stats.tap_write_bytes += ret;
+    }
     return (int)ret;
   }
   return -1;
@@ -665,15 +675,13 @@ static void bta_pan_callback(tBTA_PAN_EVT event, tBTA_PAN* p_data) {
                         sizeof(tBTA_PAN), NULL);
 }
 
-#define IS_EXCEPTION(e) ((e) & (POLLHUP | POLLRDHUP | POLLERR | POLLNVAL))
 static void btu_exec_tap_fd_read(int fd) {
-  struct pollfd ufd;
-
   if (fd == INVALID_FD || fd != btpan_cb.tap_fd) return;
 
   // Don't occupy BTU context too long, avoid buffer overruns and
   // give other profiles a chance to run by limiting the amount of memory
   // PAN can use.
+  int frames = 0;
   for (int i = 0; i < PAN_BUF_MAX && btif_is_enabled() && btpan_cb.flow; i++) {
     BT_HDR* buffer = (BT_HDR*)osi_malloc(PAN_BUF_SIZE);
     buffer->offset = PAN_MINIMUM_OFFSET;
@@ -681,38 +689,36 @@ static void btu_exec_tap_fd_read(int fd) {
 
     uint8_t* packet = (uint8_t*)buffer + sizeof(BT_HDR) + buffer->offset;
 
-    // If we don't have an undelivered packet left over, pull one from the TAP
-    // driver.
-    // We save it in the congest_packet right away in case we can't deliver it
-    // in this
-    // attempt.
-    if (!btpan_cb.congest_packet_size) {
-      ssize_t ret;
-      OSI_NO_INTR(ret = read(fd, btpan_cb.congest_packet,
-                             sizeof(btpan_cb.congest_packet)));
-      switch (ret) {
-        case -1:
-          BTIF_TRACE_ERROR("%s unable to read from driver: %s", __func__,
-                           strerror(errno));
-          osi_free(buffer);
-          // add fd back to monitor thread to try it again later
-          btsock_thread_add_fd(pan_pth, fd, 0, SOCK_THREAD_FD_RD, 0);
-          return;
-        case 0:
-          BTIF_TRACE_WARNING("%s end of file reached.", __func__);
-          osi_free(buffer);
-          // add fd back to monitor thread to process the exception
-          btsock_thread_add_fd(pan_pth, fd, 0, SOCK_THREAD_FD_RD, 0);
-          return;
-        default:
-          btpan_cb.congest_packet_size = ret;
-          break;
-      }
+    // Read the next frame straight into the buffer handed to BNEP. The TAP fd
+    // is non-blocking, so the loop ends once the driver has no frame left.
+    ssize_t ret;
+    OSI_NO_INTR(ret = read(fd, packet, buffer->len));
+    if (ret == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      osi_free(buffer);
+      break;
+    }
+    switch (ret) {
+      case -1:
+        BTIF_TRACE_ERROR("%s unable to read from driver: %s", __func__,
+                         strerror(errno));
+        osi_free(buffer);
+        // add fd back to monitor thread to try it again later
+        btsock_thread_add_fd(pan_pth, fd, 0, SOCK_THREAD_FD_RD, 0);
+        return;
+      case 0:
+        BTIF_TRACE_WARNING("%s end of file reached.", __func__);
+        osi_free(buffer);
+        // add fd back to monitor thread to process the exception
+        btsock_thread_add_fd(pan_pth, fd, 0, SOCK_THREAD_FD_RD, 0);
+        return;
+      default:
+        buffer->len = ret;
+        break;
     }
 
-    memcpy(packet, btpan_cb.congest_packet,
-           MIN(btpan_cb.congest_packet_size, buffer->len));
-    buffer->len = MIN(btpan_cb.congest_packet_size, buffer->len);
+    frames++;
+    btpan_cb.stats.tap_read_frames++;
+    btpan_cb.stats.tap_read_bytes += buffer->len;
 
     if (buffer->len > sizeof(tETH_HDR) && should_forward((tETH_HDR*)packet)) {
       // Extract the ethernet header from the buffer since the PAN_WriteBuf
@@ -725,25 +731,20 @@ static void btu_exec_tap_fd_read(int fd) {
       // Skip the ethernet header.
       buffer->len -= sizeof(tETH_HDR);
       buffer->offset += sizeof(tETH_HDR);
-      if (forward_bnep(&hdr, buffer) != FORWARD_CONGEST)
-        btpan_cb.congest_packet_size = 0;
+      // The transmit queue of BNEP only fills up while L2CAP is congested,
+      // after the flow was turned off, and BNEP drops the frames it queues
+      // past that point the same way.
+      if (forward_bnep(&hdr, buffer) == FORWARD_CONGEST)
+        btpan_cb.stats.tap_read_dropped++;
     } else {
       BTIF_TRACE_WARNING("%s dropping packet of length %d", __func__,
                          buffer->len);
-      btpan_cb.congest_packet_size = 0;
       osi_free(buffer);
     }
-
-    // Bail out of the loop if reading from the TAP fd would block.
-    ufd.fd = fd;
-    ufd.events = POLLIN;
-    ufd.revents = 0;
-
-    int ret;
-    OSI_NO_INTR(ret = poll(&ufd, 1, 0));
-    if (ret <= 0 || IS_EXCEPTION(ufd.revents)) break;
   }
 
+  if (frames != 0) btpan_cb.stats.tap_read_batches++;
+
   if (btpan_cb.flow) {
     // add fd back to monitor thread when the flow is on
     btsock_thread_add_fd(pan_pth, fd, 0, SOCK_THREAD_FD_RD, 0);
@@ -776,3 +777,22 @@ static void btpan_tap_fd_signaled(int fd, int type, int flags,
     do_in_main_thread(FROM_HERE, base::Bind(btu_exec_tap_fd_read, fd));
   }
 }
+
+void btif_debug_pan_dump(int fd) {
+  const btpan_stats_t& stats = btpan_cb.stats;
+
+  dprintf(fd, "\nPAN:\n");
+  dprintf(fd, "  TAP interface: %s, flow %s\n",
+          btpan_cb.tap_fd != INVALID_FD ? "open" : "closed",
+          btpan_cb.flow ? "on" : "off");
+  dprintf(fd,
+          "  Read: %llu frames %llu bytes in %u batches, %u dropped on "
+          "congestion\n",
+          (unsigned long long)stats.tap_read_frames,
+          (unsigned long long)stats.tap_read_bytes, stats.tap_read_batches,
+          stats.tap_read_dropped);
+  dprintf(fd, "  Written: %llu frames %llu bytes in %u batches, %u errors\n",
+          (unsigned long long)stats.tap_write_frames,
+          (unsigned long long)stats.tap_write_bytes, stats.tap_write_batches,
+          stats.tap_write_errors);
+}
@@ -37,6 +37,8 @@
 
 #include "bt_common.h"
 #include "btif_common.h"
+#include "common/time_util.h"
+#include "sdpdefs.h"
 #include "stack_manager.h"
 
 /*******************************************************************************
@@ -48,7 +50,12 @@ class ConnectNode {
  public:
   ConnectNode(const RawAddress& address, uint16_t uuid,
               btif_connect_cb_t connect_cb)
-      : address_(address), uuid_(uuid), busy_(false), connect_cb_(connect_cb) {}
+      : address_(address),
+        uuid_(uuid),
+        busy_(false),
+        connect_cb_(connect_cb),
+        queued_ms_(bluetooth::common::time_get_os_boottime_ms()),
+        started_ms_(0) {}
 
   std::string ToString() const {
     return base::StringPrintf("address=%s UUID=%04X busy=%s",
@@ -58,6 +65,7 @@ class ConnectNode {
 
   const RawAddress& address() const { return address_; }
   uint16_t uuid() const { return uuid_; }
+  bool busy() const { return busy_; }
 
   /**
    * Initiate the connection.
@@ -69,14 +77,53 @@ class ConnectNode {
   bt_status_t connect() {
     if (busy_) return BT_STATUS_SUCCESS;
     busy_ = true;
+    started_ms_ = bluetooth::common::time_get_os_boottime_ms();
     return connect_cb_(&address_, uuid_);
   }
 
+  /**
+   * Timing trace of the request: how long it waited in the queue, and how
+   * long the profile took to connect once started.
+   */
+  std::string TimingToString() const {
+    uint64_t now_ms = bluetooth::common::time_get_os_boottime_ms();
+    if (!busy_) {
+      return base::StringPrintf("never started, queued for %llu ms",
+                                (unsigned long long)(now_ms - queued_ms_));
+    }
+    return base::StringPrintf("queued for %llu ms, connect took %llu ms",
+                              (unsigned long long)(started_ms_ - queued_ms_),
+                              (unsigned long long)(now_ms - started_ms_));
+  }
+
  private:
   RawAddress address_;
   uint16_t uuid_;
   bool busy_;
   btif_connect_cb_t connect_cb_;
+  uint64_t queued_ms_;
+  uint64_t started_ms_;
+};
+
+// Profiles whose connection procedures are independent of each other once the
+// ACL is up: they use different L2CAP channels and separate state machines,
+// and report their completion with btif_queue_advance_by_uuid(). Requests to
+// the same peer for profiles of different groups run concurrently; everything
+// else is serialized.
+typedef struct {
+  uint16_t uuid;
+  uint8_t group;
+} tBTIF_QUEUE_PROFILE;
+
+enum : uint8_t {
+  BTIF_QUEUE_GROUP_AVDTP,
+  BTIF_QUEUE_GROUP_HFP_AG,
+};
+
+static const tBTIF_QUEUE_PROFILE btif_queue_concurrent_profiles[] = {
+    {UUID_SERVCLASS_AUDIO_SOURCE, BTIF_QUEUE_GROUP_AVDTP},
+    {UUID_SERVCLASS_AUDIO_SINK, BTIF_QUEUE_GROUP_AVDTP},
+    {UUID_SERVCLASS_AG_HANDSFREE, BTIF_QUEUE_GROUP_HFP_AG},
 };
 
 /*******************************************************************************
@@ -91,6 +138,22 @@ static const size_t MAX_REASONABLE_REQUESTS = 20;
  *  Queue helper functions
  ******************************************************************************/
 
+static const tBTIF_QUEUE_PROFILE* queue_int_find_profile(uint16_t uuid) {
+  for (const auto& profile : btif_queue_concurrent_profiles) {
+    if (profile.uuid == uuid) return &profile;
+  }
+  return nullptr;
+}
+
+// Whether the connection procedures of |a| and |b| can run at the same time
+static bool queue_int_independent(const ConnectNode& a, const ConnectNode& b) {
+  if (a.address() != b.address()) return false;
+  const tBTIF_QUEUE_PROFILE* profile_a = queue_int_find_profile(a.uuid());
+  const tBTIF_QUEUE_PROFILE* profile_b = queue_int_find_profile(b.uuid());
+  if (profile_a == nullptr || profile_b == nullptr) return false;
+  return profile_a->group != profile_b->group;
+}
+
 static void queue_int_add(uint16_t uuid, const RawAddress& bda,
                           btif_connect_cb_t connect_cb) {
   // Sanity check to make sure we're not leaking connection requests
@@ -112,13 +175,46 @@ static void queue_int_add(uint16_t uuid, const RawAddress& bda,
   btif_queue_connect_next();
 }
 
+static void queue_int_remove(std::list<ConnectNode>::iterator it) {
+  LOG_INFO(LOG_TAG, "%s: removing connection request: %s, %s", __func__,
+           it->ToString().c_str(), it->TimingToString().c_str());
+  connect_queue.erase(it);
+}
+
 static void queue_int_advance() {
   if (connect_queue.empty()) return;
 
-  const ConnectNode& head = connect_queue.front();
-  LOG_INFO(LOG_TAG, "%s: removing connection request: %s", __func__,
-           head.ToString().c_str());
-  connect_queue.pop_front();
+  // The oldest request in progress completed, or the head when none started
+  auto it = connect_queue.begin();
+  for (auto busy = connect_queue.begin(); busy != connect_queue.end(); busy++) {
+    if (busy->busy()) {
+      it = busy;
+      break;
+    }
+  }
+  queue_int_remove(it);
+
+  btif_queue_connect_next();
+}
+
+static void queue_int_advance_by_uuid(uint16_t uuid, const RawAddress& bda) {
+  auto match = connect_queue.end();
+  for (auto it = connect_queue.begin(); it != connect_queue.end(); it++) {
+    if (!it->busy() || it->uuid() != uuid) continue;
+    if (it->address() == bda) {
+      match = it;
+      break;
+    }
+    // A profile may report the completion for another address than the one
+    // of its request, e.g. after a connection collision
+    if (match == connect_queue.end()) match = it;
+  }
+  if (match == connect_queue.end()) {
+    LOG_WARN(LOG_TAG, "%s: no connection request in progress for UUID=%04X %s",
+             __func__, uuid, bda.ToString().c_str());
+    return;
+  }
+  queue_int_remove(match);
 
   btif_queue_connect_next();
 }
@@ -182,6 +278,21 @@ void btif_queue_advance() {
   do_in_jni_thread(FROM_HERE, base::Bind(&queue_int_advance));
 }
 
+/*******************************************************************************
+ *
+ * Function         btif_queue_advance_by_uuid
+ *
+ * Description      Complete the connection request in progress for a UUID and
+ *                  peer, and advance to the next scheduled connections.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btif_queue_advance_by_uuid(uint16_t uuid, const RawAddress* bda) {
+  do_in_jni_thread(FROM_HERE,
+                   base::Bind(&queue_int_advance_by_uuid, uuid, *bda));
+}
+
 bt_status_t btif_queue_connect_next(void) {
   // The call must be on the JNI thread, otherwise the access to connect_queue
   // is not thread-safe.
@@ -191,18 +302,41 @@ bt_status_t btif_queue_connect_next(void) {
   if (!stack_manager_get_interface()->get_stack_is_running())
     return BT_STATUS_FAIL;
 
-  ConnectNode& head = connect_queue.front();
-
-  LOG_INFO(LOG_TAG, "%s: executing connection request: %s", __func__,
-           head.ToString().c_str());
-  bt_status_t b_status = head.connect();
-  if (b_status != BT_STATUS_SUCCESS) {
-    LOG_INFO(LOG_TAG,
-             "%s: connect %s failed, advance to next scheduled connection.",
-             __func__, head.ToString().c_str());
-    btif_queue_advance();
+  // Start, in order, every request that is independent of all the requests
+  // in progress and of the earlier ones still waiting, so that a request never
+  // overtakes one it depends on.
+  for (auto it = connect_queue.begin(); it != connect_queue.end(); it++) {
+    if (it->busy()) continue;
+
+    bool can_start = true;
+    bool earlier = true;
+    for (auto other = connect_queue.begin(); other != connect_queue.end();
+         other++) {
+      if (other == it) {
+        earlier = false;
+        continue;
+      }
+      if (!earlier && !other->busy()) continue;
+      if (!queue_int_independent(*other, *it)) {
+        can_start = false;
+        break;
+      }
+    }
+    if (!can_start) continue;
+
+    LOG_INFO(LOG_TAG, "%s: executing connection request: %s", __func__,
+             it->ToString().c_str());
+    bt_status_t b_status = it->connect();
+    if (b_status != BT_STATUS_SUCCESS) {
+      LOG_INFO(LOG_TAG,
+               "%s: connect %s failed, advance to next scheduled connection.",
+               __func__, it->ToString().c_str());
+      // Advancing executes the next requests again
+      btif_queue_advance_by_uuid(it->uuid(), &it->address());
+      return b_status;
+    }
   }
-  return b_status;
+  return BT_STATUS_SUCCESS;
 }
 
 /*******************************************************************************
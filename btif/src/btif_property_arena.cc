@@ -0,0 +1,103 @@
+/*
+ *  Copyright 2020 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "btif_property_arena.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <cstddef>
+
+namespace {
+
+constexpr size_t kAlignment = alignof(std::max_align_t);
+
+// Chunks beyond that are freed by Reset(), after a burst much larger than
+// usual
+constexpr size_t kMaxRetainedChunks = 4;
+
+size_t align_up(size_t size) {
+  return (size + kAlignment - 1) & ~(kAlignment - 1);
+}
+
+}  // namespace
+
+BtifPropertyArena::BtifPropertyArena(size_t chunk_size)
+    : chunk_size_(align_up(chunk_size)) {}
+
+void* BtifPropertyArena::Alloc(size_t size) {
+  size = align_up(std::max<size_t>(size, 1));
+  while (current_chunk_ < chunks_.size() &&
+         offset_ + size > chunks_[current_chunk_].size) {
+    current_chunk_++;
+    offset_ = 0;
+  }
+  if (current_chunk_ == chunks_.size()) {
+    size_t chunk_size = std::max(chunk_size_, size);
+    chunks_.push_back({std::make_unique<uint8_t[]>(chunk_size), chunk_size});
+    offset_ = 0;
+  }
+
+  void* block = chunks_[current_chunk_].data.get() + offset_;
+  offset_ += size;
+  bytes_in_use_ += size;
+  return block;
+}
+
+void* BtifPropertyArena::Copy(const void* data, size_t size) {
+  void* block = Alloc(size);
+  if (data != nullptr && size > 0) memcpy(block, data, size);
+  return block;
+}
+
+bt_property_t* BtifPropertyArena::CopyProperties(
+    int num_properties, const bt_property_t* properties) {
+  if (num_properties <= 0) return nullptr;
+  bt_property_t* copy = static_cast<bt_property_t*>(
+      Alloc(sizeof(bt_property_t) * num_properties));
+  for (int i = 0; i < num_properties; i++) {
+    copy[i].type = properties[i].type;
+    copy[i].len = properties[i].len;
+    copy[i].val = properties[i].len > 0
+                      ? Copy(properties[i].val, properties[i].len)
+                      : nullptr;
+  }
+  return copy;
+}
+
+void BtifPropertyArena::Reset() {
+  if (chunks_.size() > kMaxRetainedChunks) chunks_.resize(kMaxRetainedChunks);
+  current_chunk_ = 0;
+  offset_ = 0;
+  bytes_in_use_ = 0;
+}
+
+BtifPropertyBuilder::BtifPropertyBuilder(BtifPropertyArena* arena,
+                                         int max_properties)
+    : arena_(arena),
+      properties_(static_cast<bt_property_t*>(
+          arena->Alloc(sizeof(bt_property_t) * max_properties))),
+      max_properties_(max_properties) {}
+
+bool BtifPropertyBuilder::Add(bt_property_type_t type, const void* value,
+                              int len) {
+  if (num_properties_ == max_properties_) return false;
+  bt_property_t* property = &properties_[num_properties_++];
+  property->type = type;
+  property->len = len;
+  property->val = len > 0 ? arena_->Copy(value, len) : nullptr;
+  return true;
+}
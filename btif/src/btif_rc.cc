@@ -31,6 +31,7 @@
 #include <time.h>
 #include <unistd.h>
 
+#include <atomic>
 #include <mutex>
 
 #include <hardware/bluetooth.h>
@@ -88,6 +89,8 @@
 #define MAX_TRANSACTIONS_PER_SESSION 16
 #define PLAY_STATUS_PLAYING 1
 #define BTIF_RC_NUM_CONN BT_RC_NUM_APP
+/* Element attribute arrays kept for the track changes of the controller */
+#define BTIF_RC_ATTR_POOL_SIZE 2
 
 #define CHECK_RC_CONNECTED(p_dev)                                          \
   do {                                                                     \
@@ -167,6 +170,23 @@ typedef struct {
   btrc_player_app_ext_attr_t ext_attrs[AVRC_MAX_APP_ATTR_SIZE];
 } btif_rc_player_app_settings_t;
 
+typedef struct {
+  uint8_t lbl;
+  btif_rc_timer_context_t txn_timer_context;
+  alarm_t* txn_timer;
+} rc_transaction_t;
+
+/* The transaction labels of a device. Bit n of in_use is set while label n
+ * is; labels are taken and given back with atomic operations on it, from the
+ * JNI and the BTIF threads. */
+typedef struct {
+  std::atomic<uint16_t> in_use;
+  rc_transaction_t transaction[MAX_TRANSACTIONS_PER_SESSION];
+} rc_transaction_set_t;
+
+static_assert(MAX_TRANSACTIONS_PER_SESSION <= 16,
+              "in_use has a bit per transaction label");
+
 /* TODO : Merge btif_rc_reg_notifications_t and btif_rc_cmd_ctxt_t to a single
  * struct */
 typedef struct {
@@ -195,19 +215,6 @@ typedef struct {
   btif_rc_device_cb_t rc_multi_cb[BTIF_RC_NUM_CONN];
 } rc_cb_t;
 
-typedef struct {
-  bool in_use;
-  uint8_t lbl;
-  uint8_t handle;
-  btif_rc_timer_context_t txn_timer_context;
-  alarm_t* txn_timer;
-} rc_transaction_t;
-
-typedef struct {
-  std::recursive_mutex lbllock;
-  rc_transaction_t transaction[MAX_TRANSACTIONS_PER_SESSION];
-} rc_device_t;
-
 typedef struct {
   uint8_t label;
   RawAddress rc_addr;
@@ -215,7 +222,16 @@ typedef struct {
 
 typedef struct { uint8_t handle; } btif_rc_handle_t;
 
-rc_device_t device;
+/* Transaction labels of the devices of btif_rc_cb.rc_multi_cb, kept apart
+ * from them as the devices are cleared with memset */
+static rc_transaction_set_t btif_rc_txn[BTIF_RC_NUM_CONN];
+
+/* Element attribute arrays, allocated on first use. Bit n of in_use is set
+ * while attrs[n] is with the JNI thread. */
+static struct {
+  std::atomic<uint8_t> in_use;
+  btrc_element_attr_val_t* attrs[BTIF_RC_ATTR_POOL_SIZE];
+} btif_rc_attr_pool;
 
 static void sleep_ms(uint64_t timeout_ms);
 
@@ -259,10 +275,13 @@ static void send_metamsg_rsp(btif_rc_device_cb_t* p_dev, int index,
                              tAVRC_RESPONSE* pmetamsg_resp);
 static void register_volumechange(uint8_t label, btif_rc_device_cb_t* p_dev);
 static void lbl_init();
-static void init_all_transactions();
-static bt_status_t get_transaction(rc_transaction_t** ptransaction);
-static void release_transaction(uint8_t label);
-static rc_transaction_t* get_transaction_by_lbl(uint8_t label);
+static void init_all_transactions(btif_rc_device_cb_t* p_dev);
+static void cleanup_all_transactions(btif_rc_device_cb_t* p_dev);
+static bt_status_t get_transaction(btif_rc_device_cb_t* p_dev,
+                                   rc_transaction_t** ptransaction);
+static void release_transaction(btif_rc_device_cb_t* p_dev, uint8_t label);
+static rc_transaction_t* get_transaction_by_lbl(btif_rc_device_cb_t* p_dev,
+                                                uint8_t label);
 static void handle_rc_metamsg_rsp(tBTA_AV_META_MSG* pmeta_msg,
                                   btif_rc_device_cb_t* p_dev);
 
@@ -596,16 +615,16 @@ void handle_rc_features(btif_rc_device_cb_t* p_dev) {
     rc_transaction_t* p_transaction = NULL;
     bt_status_t status = BT_STATUS_NOT_READY;
     if (MAX_LABEL == p_dev->rc_vol_label) {
-      status = get_transaction(&p_transaction);
+      status = get_transaction(p_dev, &p_transaction);
     } else {
-      p_transaction = get_transaction_by_lbl(p_dev->rc_vol_label);
+      p_transaction = get_transaction_by_lbl(p_dev, p_dev->rc_vol_label);
       if (NULL != p_transaction) {
         BTIF_TRACE_DEBUG(
             "%s: register_volumechange already in progress for label: %d",
             __func__, p_dev->rc_vol_label);
         return;
       }
-      status = get_transaction(&p_transaction);
+      status = get_transaction(p_dev, &p_transaction);
     }
     if (BT_STATUS_SUCCESS == status && NULL != p_transaction) {
       p_dev->rc_vol_label = p_transaction->lbl;
@@ -767,10 +786,8 @@ void handle_rc_disconnect(tBTA_AV_RC_CLOSE* p_rc_close) {
 
     p_dev->rc_addr = RawAddress::kEmpty;
   }
-  if (get_num_connected_devices() == 0) {
-    BTIF_TRACE_DEBUG("%s: Closing all handles", __func__);
-    init_all_transactions();
-  }
+  /* The labels of the device are free again */
+  init_all_transactions(p_dev);
 
   p_dev->rc_addr = RawAddress::kEmpty;
 }
@@ -865,7 +882,7 @@ void handle_rc_passthrough_rsp(tBTA_AV_REMOTE_RSP* p_remote_rsp) {
   BTIF_TRACE_DEBUG("%s: rc_id: %d state: %s", __func__, p_remote_rsp->rc_id,
                    status);
 
-  release_transaction(p_remote_rsp->label);
+  release_transaction(p_dev, p_remote_rsp->label);
   if (bt_rc_ctrl_callbacks != NULL) {
     do_in_jni_thread(
         FROM_HERE,
@@ -912,7 +929,7 @@ void handle_rc_vendorunique_rsp(tBTA_AV_REMOTE_RSP* p_remote_rsp) {
     BTIF_TRACE_DEBUG("%s: vendor_id: %d status: %s", __func__, vendor_id,
                      status);
 
-    release_transaction(p_remote_rsp->label);
+    release_transaction(p_dev, p_remote_rsp->label);
     do_in_jni_thread(FROM_HERE,
                      base::Bind(bt_rc_ctrl_callbacks->groupnavigation_rsp_cb,
                                 vendor_id, key_state));
@@ -971,7 +988,7 @@ void handle_rc_metamsg_cmd(tBTA_AV_META_MSG* pmeta_msg) {
   if (pmeta_msg->code >= AVRC_RSP_NOT_IMPL) {
     {
       rc_transaction_t* transaction = NULL;
-      transaction = get_transaction_by_lbl(pmeta_msg->label);
+      transaction = get_transaction_by_lbl(p_dev, pmeta_msg->label);
       if (transaction != NULL) {
         handle_rc_metamsg_rsp(pmeta_msg, p_dev);
       } else {
@@ -2633,7 +2650,8 @@ static bt_status_t set_volume(uint8_t volume) {
     }
 
     rc_transaction_t* p_transaction = NULL;
-    bt_status_t tran_status = get_transaction(&p_transaction);
+    bt_status_t tran_status =
+        get_transaction(&btif_rc_cb.rc_multi_cb[idx], &p_transaction);
 
     if (tran_status != BT_STATUS_SUCCESS || !p_transaction) {
       osi_free_and_reset((void**)&p_msg);
@@ -2679,7 +2697,7 @@ static void register_volumechange(uint8_t lbl, btif_rc_device_cb_t* p_dev) {
 
   BldResp = AVRC_BldCommand(&avrc_cmd, &p_msg);
   if (AVRC_STS_NO_ERROR == BldResp && p_msg) {
-    p_transaction = get_transaction_by_lbl(lbl);
+    p_transaction = get_transaction_by_lbl(p_dev, lbl);
     if (p_transaction != NULL) {
       BTA_AvMetaCmd(p_dev->rc_handle, p_transaction->lbl, AVRC_CMD_NOTIF,
                     p_msg);
@@ -2727,10 +2745,10 @@ static void handle_rc_metamsg_rsp(tBTA_AV_META_MSG* pmeta_msg,
       if (AVRC_PDU_REGISTER_NOTIFICATION == avrc_response.rsp.pdu &&
           AVRC_EVT_VOLUME_CHANGE == avrc_response.reg_notif.event_id &&
           p_dev->rc_vol_label == pmeta_msg->label) {
+        release_transaction(p_dev, p_dev->rc_vol_label);
         p_dev->rc_vol_label = MAX_LABEL;
-        release_transaction(p_dev->rc_vol_label);
       } else if (AVRC_PDU_SET_ABSOLUTE_VOLUME == avrc_response.rsp.pdu) {
-        release_transaction(pmeta_msg->label);
+        release_transaction(p_dev, pmeta_msg->label);
       }
       return;
     }
@@ -2771,7 +2789,7 @@ static void handle_rc_metamsg_rsp(tBTA_AV_META_MSG* pmeta_msg,
     register_volumechange(p_dev->rc_vol_label, p_dev);
   } else if (AVRC_PDU_SET_ABSOLUTE_VOLUME == avrc_response.rsp.pdu) {
     /* free up the label here */
-    release_transaction(pmeta_msg->label);
+    release_transaction(p_dev, pmeta_msg->label);
   }
 
   BTIF_TRACE_EVENT("%s: Passing received metamsg response to app. pdu: %s",
@@ -2935,7 +2953,7 @@ static void btif_rc_status_cmd_timeout_handler(UNUSED_ATTR uint16_t event,
       handle_get_playstatus_response(&meta_msg, &avrc_response.get_play_status);
       break;
   }
-  release_transaction(p_context->rc_status_cmd.label);
+  release_transaction(p_dev, p_context->rc_status_cmd.label);
 }
 
 /***************************************************************************
@@ -2983,7 +3001,7 @@ static void btif_rc_control_cmd_timeout_handler(UNUSED_ATTR uint16_t event,
       handle_set_app_attr_val_response(&meta_msg, &avrc_response.set_app_val);
       break;
   }
-  release_transaction(p_context->rc_control_cmd.label);
+  release_transaction(p_dev, p_context->rc_control_cmd.label);
 }
 
 /***************************************************************************
@@ -3016,7 +3034,7 @@ static void btif_rc_control_cmd_timer_timeout(void* data) {
 static void register_for_event_notification(btif_rc_supported_event_t* p_event,
                                             btif_rc_device_cb_t* p_dev) {
   rc_transaction_t* p_transaction = NULL;
-  bt_status_t status = get_transaction(&p_transaction);
+  bt_status_t status = get_transaction(p_dev, &p_transaction);
   if (status != BT_STATUS_SUCCESS) {
     BTIF_TRACE_ERROR("%s: no more transaction labels: %d", __func__, status);
     return;
@@ -3031,7 +3049,7 @@ static void register_for_event_notification(btif_rc_supported_event_t* p_event,
   if (status != BT_STATUS_SUCCESS) {
     BTIF_TRACE_ERROR("%s: Error in Notification registration: %d", __func__,
                      status);
-    release_transaction(p_transaction->lbl);
+    release_transaction(p_dev, p_transaction->lbl);
     return;
   }
 
@@ -3078,7 +3096,7 @@ bt_status_t build_and_send_vendor_cmd(tAVRC_COMMAND* avrc_cmd,
                                       tBTA_AV_CODE cmd_code,
                                       btif_rc_device_cb_t* p_dev) {
   rc_transaction_t* p_transaction = NULL;
-  bt_status_t tran_status = get_transaction(&p_transaction);
+  bt_status_t tran_status = get_transaction(p_dev, &p_transaction);
   if (BT_STATUS_SUCCESS != tran_status) return BT_STATUS_FAIL;
 
   BT_HDR* p_msg = NULL;
@@ -3098,6 +3116,7 @@ bt_status_t build_and_send_vendor_cmd(tAVRC_COMMAND* avrc_cmd,
   } else {
     BTIF_TRACE_ERROR("%s: failed to build command. status: 0x%02x", __func__,
                      status);
+    release_transaction(p_dev, p_transaction->lbl);
   }
   osi_free(p_msg);
   return (bt_status_t)status;
@@ -3126,7 +3145,7 @@ static bt_status_t build_and_send_browsing_cmd(tAVRC_COMMAND* avrc_cmd,
   }
 
   rc_transaction_t* p_transaction = NULL;
-  bt_status_t tran_status = get_transaction(&p_transaction);
+  bt_status_t tran_status = get_transaction(p_dev, &p_transaction);
 
   if (tran_status != BT_STATUS_SUCCESS || p_transaction == NULL) {
     osi_free(p_msg);
@@ -3853,6 +3872,54 @@ static void handle_set_app_attr_val_response(tBTA_AV_META_MSG* pmeta_msg,
                               p_dev->rc_addr, accepted));
 }
 
+/***************************************************************************
+ *
+ * Function         alloc_element_attrs
+ *
+ * Description      Gets an array for the |num_attrs| element attributes of a
+ *                  track change. Up to BTRC_MAX_ELEM_ATTR_SIZE attributes fit
+ *                  the arrays of btif_rc_attr_pool, which are allocated once
+ *                  and reused: an attribute is 64KB. The array is given back
+ *                  with free_element_attrs.
+ * Returns          The array, not cleared
+ *
+ **************************************************************************/
+static btrc_element_attr_val_t* alloc_element_attrs(uint8_t num_attrs) {
+  if (num_attrs <= BTRC_MAX_ELEM_ATTR_SIZE) {
+    uint8_t in_use = btif_rc_attr_pool.in_use.load();
+    for (int i = 0; i < BTIF_RC_ATTR_POOL_SIZE; i++) {
+      if (in_use & (1 << i)) continue;
+      if (!(btif_rc_attr_pool.in_use.fetch_or(1 << i) & (1 << i))) {
+        if (btif_rc_attr_pool.attrs[i] == NULL) {
+          btif_rc_attr_pool.attrs[i] = (btrc_element_attr_val_t*)osi_malloc(
+              BTRC_MAX_ELEM_ATTR_SIZE * sizeof(btrc_element_attr_val_t));
+        }
+        return btif_rc_attr_pool.attrs[i];
+      }
+    }
+  }
+  return (btrc_element_attr_val_t*)osi_malloc(
+      num_attrs * sizeof(btrc_element_attr_val_t));
+}
+
+/***************************************************************************
+ *
+ * Function         free_element_attrs
+ *
+ * Description      Gives back an array of alloc_element_attrs
+ * Returns          None
+ *
+ **************************************************************************/
+static void free_element_attrs(btrc_element_attr_val_t* p_attr) {
+  for (int i = 0; i < BTIF_RC_ATTR_POOL_SIZE; i++) {
+    if (p_attr == btif_rc_attr_pool.attrs[i]) {
+      btif_rc_attr_pool.in_use.fetch_and(~(1 << i));
+      return;
+    }
+  }
+  osi_free(p_attr);
+}
+
 /***************************************************************************
  *
  * Function         handle_get_metadata_attr_response
@@ -3867,30 +3934,30 @@ static void handle_get_metadata_attr_response(tBTA_AV_META_MSG* pmeta_msg,
   btif_rc_device_cb_t* p_dev =
       btif_rc_get_device_by_handle(pmeta_msg->rc_handle);
 
-  if (p_rsp->status == AVRC_STS_NO_ERROR) {
-    size_t buf_size = p_rsp->num_attrs * sizeof(btrc_element_attr_val_t);
-    btrc_element_attr_val_t* p_attr =
-        (btrc_element_attr_val_t*)osi_calloc(buf_size);
-
-    if (p_dev == NULL) {
-      BTIF_TRACE_ERROR("%s: p_dev NULL", __func__);
-      return;
-    }
+  if (p_dev == NULL) {
+    BTIF_TRACE_ERROR("%s: p_dev NULL", __func__);
+    return;
+  }
 
+  if (p_rsp->status == AVRC_STS_NO_ERROR) {
+    btrc_element_attr_val_t* p_attr = alloc_element_attrs(p_rsp->num_attrs);
 
     for (int i = 0; i < p_rsp->num_attrs; i++) {
       p_attr[i].attr_id = p_rsp->p_attrs[i].attr_id;
-      /* Todo. Legth limit check to include null */
+      /* text is not cleared: a string is at most 0xFFFF long, and leaves room
+       * for its null */
+      p_attr[i].text[0] = 0;
       if (p_rsp->p_attrs[i].name.str_len && p_rsp->p_attrs[i].name.p_str) {
         memcpy(p_attr[i].text, p_rsp->p_attrs[i].name.p_str,
                p_rsp->p_attrs[i].name.str_len);
+        p_attr[i].text[p_rsp->p_attrs[i].name.str_len] = 0;
         osi_free_and_reset((void**)&p_rsp->p_attrs[i].name.p_str);
       }
     }
     do_in_jni_thread(FROM_HERE,
                      base::Bind(bt_rc_ctrl_callbacks->track_changed_cb,
                                 p_dev->rc_addr, p_rsp->num_attrs, p_attr));
-    do_in_jni_thread(FROM_HERE, base::Bind(osi_free, p_attr));
+    do_in_jni_thread(FROM_HERE, base::Bind(free_element_attrs, p_attr));
   } else if (p_rsp->status == BTIF_RC_STS_TIMEOUT) {
     /* Retry for timeout case, this covers error handling
      * for continuation failure also.
@@ -3990,8 +4057,17 @@ static void handle_get_folder_items_response(tBTA_AV_META_MSG* pmeta_msg,
      * be passed onto JNI via HAL_CBACK
      */
     uint8_t item_count = p_rsp->item_count;
+    /* The items and the attributes of their media are in one block */
+    size_t attr_count = 0;
+    for (uint8_t i = 0; i < item_count; i++) {
+      if (p_rsp->p_item_list[i].item_type == AVRC_ITEM_MEDIA)
+        attr_count += p_rsp->p_item_list[i].u.media.attr_count;
+    }
     btrc_folder_items_t* btrc_items = (btrc_folder_items_t*)osi_malloc(
-        sizeof(btrc_folder_items_t) * item_count);
+        sizeof(btrc_folder_items_t) * item_count +
+        sizeof(btrc_element_attr_val_t) * attr_count);
+    btrc_element_attr_val_t* p_attrs =
+        (btrc_element_attr_val_t*)(btrc_items + item_count);
     for (uint8_t i = 0; i < item_count; i++) {
       const tAVRC_ITEM* avrc_item = &(p_rsp->p_item_list[i]);
       btrc_folder_items_t* btrc_item = &(btrc_items[i]);
@@ -4000,10 +4076,10 @@ static void handle_get_folder_items_response(tBTA_AV_META_MSG* pmeta_msg,
       switch (avrc_item->item_type) {
         case AVRC_ITEM_MEDIA:
           BTIF_TRACE_DEBUG("%s setting type to %d", __func__, BTRC_ITEM_MEDIA);
-          /* Allocate Space for Attributes */
+          /* Attributes follow the items */
           btrc_item->media.num_attrs = avrc_item->u.media.attr_count;
-          btrc_item->media.p_attrs = (btrc_element_attr_val_t*)osi_malloc(
-              btrc_item->media.num_attrs * sizeof(btrc_element_attr_val_t));
+          btrc_item->media.p_attrs = p_attrs;
+          p_attrs += btrc_item->media.num_attrs;
           get_folder_item_type_media(avrc_item, btrc_item);
           break;
 
@@ -4056,25 +4132,12 @@ static void handle_get_folder_items_response(tBTA_AV_META_MSG* pmeta_msg,
  * Function         cleanup_btrc_folder_items
  *
  * Description      Frees the memory that was allocated for a list of folder
- *                  items.
+ *                  items. The attributes of the media items are in the same
+ *                  block.
  * Returns          None
  **************************************************************************/
 static void cleanup_btrc_folder_items(btrc_folder_items_t* btrc_items,
                                       uint8_t item_count) {
-  for (uint8_t i = 0; i < item_count; i++) {
-    btrc_folder_items_t* btrc_item = &(btrc_items[i]);
-    switch (btrc_item->item_type) {
-      case BTRC_ITEM_MEDIA:
-        osi_free(btrc_item->media.p_attrs);
-        break;
-      case BTRC_ITEM_PLAYER:
-      case BTRC_ITEM_FOLDER:
-        /*Nothing to free*/
-        break;
-      default:
-        BTIF_TRACE_WARNING("%s free unspecified type", __func__);
-    }
-  }
   osi_free(btrc_items);
 }
 
@@ -4113,9 +4176,10 @@ void get_folder_item_type_media(const tAVRC_ITEM* avrc_item,
   /* Copy the name */
   BTIF_TRACE_DEBUG("%s max len %d str len %d", __func__, BTRC_MAX_ATTR_STR_LEN,
                    avrc_item_media->name.str_len);
-  memset(btrc_item_media->name, 0, BTRC_MAX_ATTR_STR_LEN * sizeof(uint8_t));
+  /* A string is at most 0xFFFF long: the null always fits */
   memcpy(btrc_item_media->name, avrc_item_media->name.p_str,
          sizeof(uint8_t) * (avrc_item_media->name.str_len));
+  btrc_item_media->name[avrc_item_media->name.str_len] = 0;
 
   /* Extract each attribute */
   for (int i = 0; i < avrc_item_media->attr_count; i++) {
@@ -4156,9 +4220,9 @@ void get_folder_item_type_media(const tAVRC_ITEM* avrc_item,
         btrc_attr_pair->attr_id = BTRC_MEDIA_ATTR_ID_INVALID;
     }
 
-    memset(btrc_attr_pair->text, 0, BTRC_MAX_ATTR_STR_LEN * sizeof(uint8_t));
     memcpy(btrc_attr_pair->text, avrc_attr_pair->name.p_str,
            avrc_attr_pair->name.str_len);
+    btrc_attr_pair->text[avrc_attr_pair->name.str_len] = 0;
   }
 }
 
@@ -4307,10 +4371,10 @@ static void handle_set_browsed_player_response(tBTA_AV_META_MSG* pmeta_msg,
  * Returns          None
  *
  **************************************************************************/
-static void clear_cmd_timeout(uint8_t label) {
+static void clear_cmd_timeout(btif_rc_device_cb_t* p_dev, uint8_t label) {
   rc_transaction_t* p_txn;
 
-  p_txn = get_transaction_by_lbl(label);
+  p_txn = get_transaction_by_lbl(p_dev, label);
   if (p_txn == NULL) {
     BTIF_TRACE_ERROR("%s: Error in transaction label lookup", __func__);
     return;
@@ -4333,6 +4397,8 @@ static void handle_avk_rc_metamsg_rsp(tBTA_AV_META_MSG* pmeta_msg) {
   uint8_t scratch_buf[512] = {0};  // this variable is unused
   uint16_t buf_len;
   tAVRC_STS status;
+  btif_rc_device_cb_t* p_dev =
+      btif_rc_get_device_by_handle(pmeta_msg->rc_handle);
 
   BTIF_TRACE_DEBUG("%s: opcode: %d rsp_code: %d  ", __func__,
                    pmeta_msg->p_msg->hdr.opcode, pmeta_msg->code);
@@ -4351,7 +4417,7 @@ static void handle_avk_rc_metamsg_rsp(tBTA_AV_META_MSG* pmeta_msg) {
         handle_notification_response(pmeta_msg, &avrc_response.reg_notif);
         if (pmeta_msg->code == AVRC_RSP_INTERIM) {
           /* Don't free the transaction Id */
-          clear_cmd_timeout(pmeta_msg->label);
+          clear_cmd_timeout(p_dev, pmeta_msg->label);
           return;
         }
         break;
@@ -4426,7 +4492,7 @@ static void handle_avk_rc_metamsg_rsp(tBTA_AV_META_MSG* pmeta_msg) {
     return;
   }
   BTIF_TRACE_DEBUG("XX __func__ release transaction %d", pmeta_msg->label);
-  release_transaction(pmeta_msg->label);
+  release_transaction(p_dev, pmeta_msg->label);
 }
 
 /***************************************************************************
@@ -4502,6 +4568,7 @@ static void cleanup() {
 
   for (int idx = 0; idx < BTIF_RC_NUM_CONN; idx++) {
     alarm_free(btif_rc_cb.rc_multi_cb[idx].rc_play_status_timer);
+    cleanup_all_transactions(&btif_rc_cb.rc_multi_cb[idx]);
     memset(&btif_rc_cb.rc_multi_cb[idx], 0,
            sizeof(btif_rc_cb.rc_multi_cb[idx]));
   }
@@ -4527,11 +4594,20 @@ static void cleanup_ctrl() {
 
   for (int idx = 0; idx < BTIF_RC_NUM_CONN; idx++) {
     alarm_free(btif_rc_cb.rc_multi_cb[idx].rc_play_status_timer);
+    cleanup_all_transactions(&btif_rc_cb.rc_multi_cb[idx]);
     memset(&btif_rc_cb.rc_multi_cb[idx], 0,
            sizeof(btif_rc_cb.rc_multi_cb[idx]));
   }
 
   memset(&btif_rc_cb.rc_multi_cb, 0, sizeof(btif_rc_cb.rc_multi_cb));
+
+  /* An array still with a track change callback goes back to the pool */
+  for (int i = 0; i < BTIF_RC_ATTR_POOL_SIZE; i++) {
+    if (!(btif_rc_attr_pool.in_use.fetch_or(1 << i) & (1 << i))) {
+      osi_free_and_reset((void**)&btif_rc_attr_pool.attrs[i]);
+      btif_rc_attr_pool.in_use.fetch_and(~(1 << i));
+    }
+  }
   BTIF_TRACE_EVENT("%s: completed", __func__);
 }
 
@@ -5235,7 +5311,7 @@ static bt_status_t send_groupnavigation_cmd(const RawAddress& bd_addr,
   CHECK_RC_CONNECTED(p_dev);
 
   if (p_dev->rc_features & BTA_AV_FEAT_RCTG) {
-    bt_status_t tran_status = get_transaction(&p_transaction);
+    bt_status_t tran_status = get_transaction(p_dev, &p_transaction);
     if ((BT_STATUS_SUCCESS == tran_status) && (NULL != p_transaction)) {
       uint8_t buffer[AVRC_PASS_THRU_GROUP_LEN] = {0};
       uint8_t* start = buffer;
@@ -5281,7 +5357,7 @@ static bt_status_t send_passthrough_cmd(const RawAddress& bd_addr,
   BTIF_TRACE_DEBUG("%s: key-code: %d, key-state: %d", __func__, key_code,
                    key_state);
   if (p_dev->rc_features & BTA_AV_FEAT_RCTG) {
-    bt_status_t tran_status = get_transaction(&p_transaction);
+    bt_status_t tran_status = get_transaction(p_dev, &p_transaction);
     if (BT_STATUS_SUCCESS == tran_status && NULL != p_transaction) {
       BTA_AvRemoteCmd(p_dev->rc_handle, p_transaction->lbl,
                       (tBTA_AV_RC)key_code, (tBTA_AV_STATE)key_state);
@@ -5373,48 +5449,63 @@ const btrc_ctrl_interface_t* btif_rc_ctrl_get_interface(void) {
 }
 
 /*******************************************************************************
- *      Function         initialize_transaction
+ *      Function         get_transaction_set
  *
- *      Description    Initializes fields of the transaction structure
+ *      Description    Returns the transaction labels of the device
  *
- *      Returns          void
+ *      Returns         rc_transaction_set_t*
  ******************************************************************************/
-static void initialize_transaction(int lbl) {
-  std::unique_lock<std::recursive_mutex> lock(device.lbllock);
-  if (lbl < MAX_TRANSACTIONS_PER_SESSION) {
-    if (alarm_is_scheduled(device.transaction[lbl].txn_timer)) {
-      clear_cmd_timeout(lbl);
-    }
-    device.transaction[lbl].lbl = lbl;
-    device.transaction[lbl].in_use = false;
-    device.transaction[lbl].handle = 0;
-  }
+static rc_transaction_set_t* get_transaction_set(btif_rc_device_cb_t* p_dev) {
+  return &btif_rc_txn[p_dev - btif_rc_cb.rc_multi_cb];
 }
 
 /*******************************************************************************
  *      Function         lbl_init
  *
- *      Description    Initializes label structures and mutexes.
+ *      Description    Initializes the label structures of all the devices.
  *
  *      Returns         void
  ******************************************************************************/
 void lbl_init() {
-  memset(&device.transaction, 0, sizeof(device.transaction));
-  init_all_transactions();
+  for (int idx = 0; idx < BTIF_RC_NUM_CONN; idx++) {
+    rc_transaction_set_t* p_txn = &btif_rc_txn[idx];
+    p_txn->in_use = 0;
+    for (uint8_t lbl = 0; lbl < MAX_TRANSACTIONS_PER_SESSION; lbl++) {
+      p_txn->transaction[lbl].lbl = lbl;
+    }
+  }
 }
 
 /*******************************************************************************
  *
  * Function         init_all_transactions
  *
- * Description    Initializes all transactions
+ * Description    Releases all the transactions of the device
  *
  * Returns          void
  ******************************************************************************/
-void init_all_transactions() {
-  uint8_t txn_indx = 0;
-  for (txn_indx = 0; txn_indx < MAX_TRANSACTIONS_PER_SESSION; txn_indx++) {
-    initialize_transaction(txn_indx);
+void init_all_transactions(btif_rc_device_cb_t* p_dev) {
+  if (p_dev == NULL) return;
+  for (uint8_t lbl = 0; lbl < MAX_TRANSACTIONS_PER_SESSION; lbl++) {
+    release_transaction(p_dev, lbl);
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         cleanup_all_transactions
+ *
+ * Description    Releases all the transactions of the device and frees their
+ *                timers
+ *
+ * Returns          void
+ ******************************************************************************/
+static void cleanup_all_transactions(btif_rc_device_cb_t* p_dev) {
+  init_all_transactions(p_dev);
+  rc_transaction_set_t* p_txn = get_transaction_set(p_dev);
+  for (uint8_t lbl = 0; lbl < MAX_TRANSACTIONS_PER_SESSION; lbl++) {
+    alarm_free(p_txn->transaction[lbl].txn_timer);
+    p_txn->transaction[lbl].txn_timer = NULL;
   }
 }
 
@@ -5427,46 +5518,45 @@ void init_all_transactions() {
  *
  * Returns          bt_status_t
  ******************************************************************************/
-rc_transaction_t* get_transaction_by_lbl(uint8_t lbl) {
-  rc_transaction_t* transaction = NULL;
-  std::unique_lock<std::recursive_mutex> lock(device.lbllock);
-
+rc_transaction_t* get_transaction_by_lbl(btif_rc_device_cb_t* p_dev,
+                                         uint8_t lbl) {
   /* Determine if this is a valid label */
-  if (lbl < MAX_TRANSACTIONS_PER_SESSION) {
-    if (!device.transaction[lbl].in_use) {
-      transaction = NULL;
-    } else {
-      transaction = &(device.transaction[lbl]);
-      BTIF_TRACE_DEBUG("%s: Got transaction.label: %d", __func__, lbl);
-    }
-  }
+  if (p_dev == NULL || lbl >= MAX_TRANSACTIONS_PER_SESSION) return NULL;
+  rc_transaction_set_t* p_txn = get_transaction_set(p_dev);
+  if (!(p_txn->in_use.load() & (1 << lbl))) return NULL;
 
-  return transaction;
+  BTIF_TRACE_DEBUG("%s: Got transaction.label: %d", __func__, lbl);
+  return &p_txn->transaction[lbl];
 }
 
 /*******************************************************************************
  *
  * Function         get_transaction
  *
- * Description    Obtains the transaction details.
+ * Description    Obtains a free transaction label of the device: the lowest
+ *                one not in use.
  *
  * Returns          bt_status_t
  ******************************************************************************/
 
-static bt_status_t get_transaction(rc_transaction_t** ptransaction) {
-  std::unique_lock<std::recursive_mutex> lock(device.lbllock);
-
-  // Check for unused transactions
-  for (uint8_t i = 0; i < MAX_TRANSACTIONS_PER_SESSION; i++) {
-    if (!device.transaction[i].in_use) {
-      BTIF_TRACE_DEBUG("%s: Got transaction.label: %d", __func__,
-                       device.transaction[i].lbl);
-      device.transaction[i].in_use = true;
-      *ptransaction = &(device.transaction[i]);
-      return BT_STATUS_SUCCESS;
-    }
-  }
-  return BT_STATUS_NOMEM;
+static bt_status_t get_transaction(btif_rc_device_cb_t* p_dev,
+                                   rc_transaction_t** ptransaction) {
+  if (p_dev == NULL) return BT_STATUS_FAIL;
+
+  constexpr uint16_t all_labels = (1 << MAX_TRANSACTIONS_PER_SESSION) - 1;
+  rc_transaction_set_t* p_txn = get_transaction_set(p_dev);
+  uint16_t in_use = p_txn->in_use.load();
+  uint16_t taken;
+  do {
+    uint16_t free_labels = ~in_use & all_labels;
+    if (free_labels == 0) return BT_STATUS_NOMEM;
+    taken = free_labels & -free_labels;
+  } while (!p_txn->in_use.compare_exchange_weak(in_use, in_use | taken));
+
+  uint8_t lbl = __builtin_ctz(taken);
+  BTIF_TRACE_DEBUG("%s: Got transaction.label: %d", __func__, lbl);
+  *ptransaction = &p_txn->transaction[lbl];
+  return BT_STATUS_SUCCESS;
 }
 
 /*******************************************************************************
@@ -5477,14 +5567,16 @@ static bt_status_t get_transaction(rc_transaction_t** ptransaction) {
  *
  * Returns          bt_status_t
  ******************************************************************************/
-void release_transaction(uint8_t lbl) {
+void release_transaction(btif_rc_device_cb_t* p_dev, uint8_t lbl) {
   BTIF_TRACE_DEBUG("%s %d", __func__, lbl);
-  rc_transaction_t* transaction = get_transaction_by_lbl(lbl);
+  rc_transaction_t* transaction = get_transaction_by_lbl(p_dev, lbl);
 
   /* If the transaction is in use... */
   if (transaction != NULL) {
     BTIF_TRACE_DEBUG("%s: lbl: %d", __func__, lbl);
-    initialize_transaction(lbl);
+    /* The timer is stopped before the label can be handed out again */
+    if (transaction->txn_timer != NULL) alarm_cancel(transaction->txn_timer);
+    get_transaction_set(p_dev)->in_use.fetch_and(~(1 << lbl));
   }
 }
 
@@ -24,14 +24,15 @@
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <unistd.h>
-#include <vector>
 
 #include <mutex>
+#include <unordered_map>
 
 #include <frameworks/base/core/proto/android/bluetooth/enums.pb.h>
 #include <hardware/bt_sock.h>
 
 #include "osi/include/allocator.h"
+#include "osi/include/list.h"
 
 #include "bt_common.h"
 #include "bt_target.h"
@@ -55,11 +56,13 @@
 #include "port_api.h"
 #include "sdp_api.h"
 
-struct packet {
-  struct packet *next, *prev;
-  uint32_t len;
-  uint8_t* data;
-};
+/* Number of SDUs passed to or taken from the app socket per system call */
+#define L2CAP_SOCK_MAX_BATCH 8
+
+/* Number of SDUs read from the app that may wait for BTA at a time. L2CAP
+ * holds them until the peer grants credits and reports congestion on its own,
+ * which stops reading from the app altogether. */
+#define L2CAP_SOCK_TX_WINDOW 8
 
 typedef struct l2cap_socket {
   struct l2cap_socket* prev;  // link to prev list item
@@ -75,8 +78,8 @@ typedef struct l2cap_socket {
   int app_fd;                 // fd from app's side
 
   unsigned bytes_buffered;
-  struct packet* first_packet;  // fist packet to be delivered to app
-  struct packet* last_packet;   // last packet to be delivered to app
+  list_t* rx_queue;    // SDUs (BT_HDR) to be delivered to app, in order
+  unsigned tx_queued;  // SDUs read from app, not yet confirmed by BTA
 
   unsigned fixed_chan : 1;        // fixed channel (or psm?)
   unsigned server : 1;            // is a server? (or connecting?)
@@ -97,6 +100,8 @@ static void btsock_l2cap_server_listen(l2cap_socket* sock);
 static std::mutex state_lock;
 
 l2cap_socket* socks = NULL;
+/* the sockets of |socks| by id, for the lookups of the data path */
+static std::unordered_map<uint32_t, l2cap_socket*> socks_by_id;
 static uint32_t last_sock_id = 0;
 static uid_set_t* uid_set = NULL;
 static int pth = -1;
@@ -104,97 +109,21 @@ static int pth = -1;
 static void btsock_l2cap_cbk(tBTA_JV_EVT event, tBTA_JV* p_data,
                              uint32_t l2cap_socket_id);
 
-/* TODO: Consider to remove this buffer, as we have a buffer in l2cap as well,
- * and we risk
- *       a buffer overflow with this implementation if the socket data is not
- * read from
- *       JAVA for a while. In such a case we should use flow control to tell the
- * sender to
- *       back off.
- *       BUT remember we need to avoid blocking the BTA task execution - hence
- * we cannot
- *       directly write to the socket.
- *       we should be able to change to store the data pointer here, and just
- * wait
- *       confirming the l2cap_ind until we have more space in the buffer. */
-
-/* returns false if none - caller must free "data" memory when done with it */
-static char packet_get_head_l(l2cap_socket* sock, uint8_t** data,
-                              uint32_t* len) {
-  struct packet* p = sock->first_packet;
-
-  if (!p) return false;
-
-  if (data) *data = sock->first_packet->data;
-  if (len) *len = sock->first_packet->len;
-  sock->first_packet = p->next;
-  if (sock->first_packet)
-    sock->first_packet->prev = NULL;
-  else
-    sock->last_packet = NULL;
-
-  if (len) sock->bytes_buffered -= *len;
+/* TODO: Consider flow control to tell the sender to back off instead of
+ * dropping the connection when the app does not read its data for a while.
+ * BUT remember we need to avoid blocking the BTA task execution - hence we
+ * cannot directly write to the socket. */
 
-  osi_free(p);
-
-  return true;
-}
-
-static struct packet* packet_alloc(const uint8_t* data, uint32_t len) {
-  struct packet* p = (struct packet*)osi_calloc(sizeof(*p));
-  uint8_t* buf = (uint8_t*)osi_malloc(len);
-
-  p->data = buf;
-  p->len = len;
-  memcpy(p->data, data, len);
-  return p;
-}
-
-/* makes a copy of the data, returns true on success */
-static char packet_put_head_l(l2cap_socket* sock, const void* data,
-                              uint32_t len) {
-  struct packet* p = packet_alloc((const uint8_t*)data, len);
-
-  /*
-   * We do not check size limits here since this is used to undo "getting" a
-   * packet that the user read incompletely. That is to say the packet was
-   * already in the queue. We do check thos elimits in packet_put_tail_l() since
-   * that function is used to put new data into the queue.
-   */
-
-  if (!p) return false;
-
-  p->prev = NULL;
-  p->next = sock->first_packet;
-  sock->first_packet = p;
-  if (p->next)
-    p->next->prev = p;
-  else
-    sock->last_packet = p;
-
-  sock->bytes_buffered += len;
-
-  return true;
-}
-
-/* makes a copy of the data, returns true on success */
-static char packet_put_tail_l(l2cap_socket* sock, const void* data,
-                              uint32_t len) {
+/* takes ownership of |p_buf|, returns true on success */
+static bool rx_queue_put_tail_l(l2cap_socket* sock, BT_HDR* p_buf) {
   if (sock->bytes_buffered >= L2CAP_MAX_RX_BUFFER) {
     LOG(ERROR) << __func__ << ": buffer overflow";
+    osi_free(p_buf);
     return false;
   }
 
-  struct packet* p = packet_alloc((const uint8_t*)data, len);
-  p->next = NULL;
-  p->prev = sock->last_packet;
-  sock->last_packet = p;
-  if (p->prev)
-    p->prev->next = p;
-  else
-    sock->first_packet = p;
-
-  sock->bytes_buffered += len;
+  list_append(sock->rx_queue, p_buf);
+  sock->bytes_buffered += p_buf->len;
 
   return true;
 }
@@ -206,15 +135,11 @@ static char is_inited(void) {
 
 /* only call with std::mutex taken */
 static l2cap_socket* btsock_l2cap_find_by_id_l(uint32_t id) {
-  l2cap_socket* sock = socks;
-
-  while (sock && sock->id != id) sock = sock->next;
-
-  return sock;
+  auto it = socks_by_id.find(id);
+  return it == socks_by_id.end() ? NULL : it->second;
 }
 
 static void btsock_l2cap_free_l(l2cap_socket* sock) {
-  uint8_t* buf;
   l2cap_socket* t = socks;
 
   while (t && t != sock) t = t->next;
@@ -230,6 +155,7 @@ static void btsock_l2cap_free_l(l2cap_socket* sock) {
       sock->server ? android::bluetooth::SOCKET_ROLE_LISTEN
                    : android::bluetooth::SOCKET_ROLE_CONNECTION);
 
+  socks_by_id.erase(sock->id);
   if (sock->next) sock->next->prev = sock->prev;
 
   if (sock->prev)
@@ -245,7 +171,7 @@ static void btsock_l2cap_free_l(l2cap_socket* sock) {
     LOG(ERROR) << "SOCK_LIST: free(id = " << sock->id << ") - NO app_fd!";
   }
 
-  while (packet_get_head_l(sock, &buf, NULL)) osi_free(buf);
+  list_free(sock->rx_queue);
 
   // lower-level close() should be idempotent... so let's call it and see...
   if (sock->is_le_coc) {
@@ -320,8 +246,7 @@ static l2cap_socket* btsock_l2cap_alloc_l(const char* name,
   if (name) strncpy(sock->name, name, sizeof(sock->name) - 1);
   if (addr) sock->addr = *addr;
 
-  sock->first_packet = NULL;
-  sock->last_packet = NULL;
+  sock->rx_queue = list_new(osi_free);
 
   sock->tx_mtu = L2CAP_LE_MIN_MTU;
 
@@ -334,18 +259,8 @@ static l2cap_socket* btsock_l2cap_alloc_l(const char* name,
   socks = sock;
   /* paranoia cap on: verify no ID duplicates due to overflow and fix as needed
    */
-  while (1) {
-    l2cap_socket* t;
-    t = socks->next;
-    while (t && t->id != sock->id) {
-      t = t->next;
-    }
-    if (!t && sock->id) /* non-zeor handle is unique -> we're done */
-      break;
-    /* if we're here, we found a duplicate */
-    if (!++sock->id) /* no zero IDs allowed */
-      sock->id++;
-  }
+  while (!sock->id || socks_by_id.count(sock->id)) sock->id++;
+  socks_by_id[sock->id] = sock;
   last_sock_id = sock->id;
   DVLOG(2) << __func__ << " SOCK_LIST: alloc id:" << sock->id;
   return sock;
@@ -360,6 +275,7 @@ bt_status_t btsock_l2cap_init(int handle, uid_set_t* set) {
   std::unique_lock<std::mutex> lock(state_lock);
   pth = handle;
   socks = NULL;
+  socks_by_id.clear();
   uid_set = set;
   return BT_STATUS_SUCCESS;
 }
@@ -675,7 +591,7 @@ static void on_l2cap_outgoing_congest(tBTA_JV_L2CAP_CONG* p, uint32_t id) {
 
   sock->outgoing_congest = p->cong ? 1 : 0;
   // mointer the fd for any outgoing data
-  if (!sock->outgoing_congest) {
+  if (!sock->outgoing_congest && sock->tx_queued < L2CAP_SOCK_TX_WINDOW) {
     DVLOG(2) << __func__ << ": adding fd to btsock_thread...";
     btsock_thread_add_fd(pth, sock->our_fd, BTSOCK_L2CAP, SOCK_THREAD_FD_RD,
                          sock->id);
@@ -688,7 +604,8 @@ static void on_l2cap_write_done(uint16_t len, uint32_t id) {
   if (!sock) return;
 
   int app_uid = sock->app_uid;
-  if (!sock->outgoing_congest) {
+  if (sock->tx_queued) sock->tx_queued--;
+  if (!sock->outgoing_congest && sock->tx_queued < L2CAP_SOCK_TX_WINDOW) {
     // monitor the fd for any outgoing data
     DVLOG(2) << __func__ << ": adding fd to btsock_thread...";
     btsock_thread_add_fd(pth, sock->our_fd, BTSOCK_L2CAP, SOCK_THREAD_FD_RD,
@@ -715,10 +632,10 @@ static void on_l2cap_data_ind(tBTA_JV* evt, uint32_t id) {
 
     tBTA_JV_LE_DATA_IND* p_le_data_ind = &evt->le_data_ind;
     BT_HDR* p_buf = p_le_data_ind->p_buf;
-    uint8_t* data = (uint8_t*)(p_buf + 1) + p_buf->offset;
+    uint16_t len = p_buf->len;
 
-    if (packet_put_tail_l(sock, data, p_buf->len)) {
-      bytes_read = p_buf->len;
+    if (rx_queue_put_tail_l(sock, p_buf)) {
+      bytes_read = len;
       btsock_thread_add_fd(pth, sock->our_fd, BTSOCK_L2CAP, SOCK_THREAD_FD_WR,
                            sock->id);
     } else {  // connection must be dropped
@@ -730,25 +647,24 @@ static void on_l2cap_data_ind(tBTA_JV* evt, uint32_t id) {
     }
 
   } else {
-    uint32_t count;
-
-    if (BTA_JvL2capReady(sock->handle, &count) == BTA_JV_SUCCESS) {
-      std::vector<uint8_t> buffer(count);
-      if (BTA_JvL2capRead(sock->handle, sock->id, buffer.data(), count) ==
-          BTA_JV_SUCCESS) {
-        if (packet_put_tail_l(sock, buffer.data(), count)) {
-          bytes_read = count;
-          btsock_thread_add_fd(pth, sock->our_fd, BTSOCK_L2CAP,
-                               SOCK_THREAD_FD_WR, sock->id);
-        } else {  // connection must be dropped
-          DVLOG(2) << __func__
-                   << ": unable to push data to socket - closing channel";
-          BTA_JvL2capClose(sock->handle);
-          btsock_l2cap_free_l(sock);
-          return;
-        }
+    BT_HDR* p_buf;
+
+    /* Queue the SDUs as they came in, so each one stays a single message on
+     * the app socket */
+    while (BTA_JvL2capReadBuf(sock->handle, &p_buf) == BTA_JV_SUCCESS) {
+      uint16_t len = p_buf->len;
+      if (!rx_queue_put_tail_l(sock, p_buf)) {  // connection must be dropped
+        DVLOG(2) << __func__
+                 << ": unable to push data to socket - closing channel";
+        BTA_JvL2capClose(sock->handle);
+        btsock_l2cap_free_l(sock);
+        return;
       }
+      bytes_read += len;
     }
+    if (bytes_read)
+      btsock_thread_add_fd(pth, sock->our_fd, BTSOCK_L2CAP, SOCK_THREAD_FD_WR,
+                           sock->id);
   }
 
   sock->rx_bytes += bytes_read;
@@ -969,26 +885,42 @@ bt_status_t btsock_l2cap_connect(const RawAddress* bd_addr, int channel,
  * (for example: unrecoverable error or no data)
  */
 static bool flush_incoming_que_on_wr_signal_l(l2cap_socket* sock) {
-  uint8_t* buf;
-  uint32_t len;
-
-  while (packet_get_head_l(sock, &buf, &len)) {
-    ssize_t sent;
-    OSI_NO_INTR(sent = send(sock->our_fd, buf, len, MSG_DONTWAIT));
-    int saved_errno = errno;
-
-    if (sent == (signed)len)
-      osi_free(buf);
-    else if (sent >= 0) {
-      packet_put_head_l(sock, buf + sent, len - sent);
-      osi_free(buf);
-      if (!sent) /* special case if other end not keeping up */
+  struct mmsghdr msgs[L2CAP_SOCK_MAX_BATCH];
+  struct iovec iovs[L2CAP_SOCK_MAX_BATCH];
+
+  while (!list_is_empty(sock->rx_queue)) {
+    /* Hand the queued SDUs to the socket as they are, one message each */
+    unsigned count = 0;
+    for (const list_node_t* node = list_begin(sock->rx_queue);
+         node != list_end(sock->rx_queue) && count < L2CAP_SOCK_MAX_BATCH;
+         node = list_next(node), count++) {
+      BT_HDR* p_buf = (BT_HDR*)list_node(node);
+      iovs[count].iov_base = (uint8_t*)(p_buf + 1) + p_buf->offset;
+      iovs[count].iov_len = p_buf->len;
+      memset(&msgs[count], 0, sizeof(msgs[count]));
+      msgs[count].msg_hdr.msg_iov = &iovs[count];
+      msgs[count].msg_hdr.msg_iovlen = 1;
+    }
+
+    int sent;
+    OSI_NO_INTR(sent = sendmmsg(sock->our_fd, msgs, count, MSG_DONTWAIT));
+    if (sent < 0) return errno == EWOULDBLOCK || errno == EAGAIN;
+
+    for (int i = 0; i < sent; i++) {
+      BT_HDR* p_buf = (BT_HDR*)list_front(sock->rx_queue);
+      if (msgs[i].msg_len < p_buf->len) {
+        /* keep the rest at the head of the queue until the user reads more */
+        p_buf->offset += msgs[i].msg_len;
+        p_buf->len -= msgs[i].msg_len;
+        sock->bytes_buffered -= msgs[i].msg_len;
         return true;
-    } else {
-      packet_put_head_l(sock, buf, len);
-      osi_free(buf);
-      return saved_errno == EWOULDBLOCK || saved_errno == EAGAIN;
+      }
+      sock->bytes_buffered -= p_buf->len;
+      list_remove(sock->rx_queue, p_buf);
     }
+
+    /* special case if other end not keeping up */
+    if (sent < (int)count) return true;
   }
 
   return false;
@@ -1007,6 +939,66 @@ inline uint8_t* get_l2cap_sdu_start_ptr(BT_HDR* msg) {
   return (uint8_t*)(msg) + BT_HDR_SIZE + msg->offset;
 }
 
+/* Reads up to a batch of SDUs from the app, as many as the tx window has
+ * room for, and passes them to BTA. */
+static void read_app_sdus_l(l2cap_socket* sock) {
+  if (sock->tx_queued >= L2CAP_SOCK_TX_WINDOW) return;
+
+  BT_HDR* buffers[L2CAP_SOCK_MAX_BATCH];
+  struct mmsghdr msgs[L2CAP_SOCK_MAX_BATCH];
+  struct iovec iovs[L2CAP_SOCK_MAX_BATCH];
+
+  unsigned count = std::min(L2CAP_SOCK_TX_WINDOW - sock->tx_queued,
+                            (unsigned)L2CAP_SOCK_MAX_BATCH);
+  for (unsigned i = 0; i < count; i++) {
+    /* BluetoothSocket.write(...) guarantees that any packet send to this
+       socket is broken into pieces no bigger than MTU bytes (as requested
+       by BT spec). */
+    buffers[i] = malloc_l2cap_buf(sock->tx_mtu);
+    iovs[i].iov_base = get_l2cap_sdu_start_ptr(buffers[i]);
+    iovs[i].iov_len = sock->tx_mtu;
+    memset(&msgs[i], 0, sizeof(msgs[i]));
+    msgs[i].msg_hdr.msg_iov = &iovs[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  /* The socket is created with SOCK_SEQPACKET, hence each message is one
+   * SDU. */
+  int received;
+  OSI_NO_INTR(received = recvmmsg(sock->our_fd, msgs, count,
+                                  MSG_NOSIGNAL | MSG_DONTWAIT, NULL));
+  if (received < 0) received = 0;
+
+  int i = 0;
+  for (; i < received; i++) {
+    /* An empty message is the end of the stream */
+    if (msgs[i].msg_len == 0) break;
+
+    if (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) {
+      /* This can't happen thanks to check in BluetoothSocket.java but leave
+       * this in case this socket is ever used anywhere else*/
+      LOG(ERROR) << "recv more than MTU. Data will be lost";
+    }
+
+    BT_HDR* buffer = buffers[i];
+    buffer->len = msgs[i].msg_len;
+    DVLOG(2) << __func__ << ": bytes received from socket: " << buffer->len;
+
+    sock->tx_queued++;
+    if (sock->fixed_chan) {
+      // will take care of freeing buffer
+      BTA_JvL2capWriteFixed(sock->channel, sock->addr, PTR_TO_UINT(buffer),
+                            btsock_l2cap_cbk, buffer, sock->id);
+    } else {
+      // will take care of freeing buffer, no write event if it fails here
+      if (BTA_JvL2capWrite(sock->handle, PTR_TO_UINT(buffer), buffer,
+                           sock->id) != BTA_JV_SUCCESS)
+        sock->tx_queued--;
+    }
+  }
+  for (; i < (int)count; i++) osi_free(buffers[i]);
+}
+
 void btsock_l2cap_signaled(int fd, int flags, uint32_t user_id) {
   char drop_it = false;
 
@@ -1022,42 +1014,13 @@ void btsock_l2cap_signaled(int fd, int flags, uint32_t user_id) {
       int size = 0;
       bool ioctl_success = ioctl(sock->our_fd, FIONREAD, &size) == 0;
       if (!(flags & SOCK_THREAD_FD_EXCEPTION) || (ioctl_success && size)) {
-        /* FIONREAD return number of bytes that are immediately available for
-           reading, might be bigger than awaiting packet.
-
-           BluetoothSocket.write(...) guarantees that any packet send to this
-           socket is broken into pieces no bigger than MTU bytes (as requested
-           by BT spec). */
-        size = std::min(size, (int)sock->tx_mtu);
-
-        BT_HDR* buffer = malloc_l2cap_buf(size);
-        /* The socket is created with SOCK_SEQPACKET, hence we read one message
-         * at the time. */
-        ssize_t count;
-        OSI_NO_INTR(count = recv(fd, get_l2cap_sdu_start_ptr(buffer), size,
-                                 MSG_NOSIGNAL | MSG_DONTWAIT | MSG_TRUNC));
-        if (count > sock->tx_mtu) {
-          /* This can't happen thanks to check in BluetoothSocket.java but leave
-           * this in case this socket is ever used anywhere else*/
-          LOG(ERROR) << "recv more than MTU. Data will be lost: " << count;
-          count = sock->tx_mtu;
-        }
-
-        /* When multiple packets smaller than MTU are flushed to the socket, the
-           size of the single packet read could be smaller than the ioctl
-           reported total size of awaiting packets. Hence, we adjust the buffer
-           length. */
-        buffer->len = count;
-        DVLOG(2) << __func__ << ": bytes received from socket: " << count;
-
-        if (sock->fixed_chan) {
-          // will take care of freeing buffer
-          BTA_JvL2capWriteFixed(sock->channel, sock->addr, PTR_TO_UINT(buffer),
-                                btsock_l2cap_cbk, buffer, user_id);
-        } else {
-          // will take care of freeing buffer
-          BTA_JvL2capWrite(sock->handle, PTR_TO_UINT(buffer), buffer, user_id);
-        }
+        read_app_sdus_l(sock);
+        /* Keep reading while the window has room; otherwise
+         * on_l2cap_write_done() or the end of the congestion resumes it. */
+        if (!(flags & SOCK_THREAD_FD_EXCEPTION) && !sock->outgoing_congest &&
+            sock->tx_queued < L2CAP_SOCK_TX_WINDOW)
+          btsock_thread_add_fd(pth, sock->our_fd, BTSOCK_L2CAP,
+                               SOCK_THREAD_FD_RD, sock->id);
       }
     } else
       drop_it = true;
@@ -18,14 +18,18 @@
 
 #define LOG_TAG "bt_btif_sock_rfcomm"
 
+#include <alloca.h>
 #include <base/logging.h>
 #include <errno.h>
 #include <features.h>
+#include <inttypes.h>
 #include <pthread.h>
+#include <stdio.h>
 #include <string.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include <mutex>
@@ -66,8 +70,16 @@ using bluetooth::Uuid;
 // Maximum number of RFCOMM channels (1-30 inclusive).
 #define MAX_RFC_CHANNEL 30
 
+// Maximum number of sockets, listening or connected. Each socket uses an
+// RFCOMM port, so that a gateway serving many clients is only bound by the
+// MAX_RFC_PORTS the stack is built with.
+#define MAX_RFC_SLOTS MAX_RFC_PORTS
+
 // Maximum number of devices we can have an RFCOMM connection with.
-#define MAX_RFC_SESSION 7
+#define MAX_RFC_SESSION BTA_JV_MAX_RFC_SR_SESSION
+
+// Maximum number of queued buffers written to the app with one sendmsg.
+#define RFC_SOCK_MAX_IOV 16
 
 typedef struct {
   int outgoing_congest : 1;
@@ -99,13 +111,15 @@ typedef struct {
   int rfc_port_handle;
   int role;
   list_t* incoming_queue;
+  // Bytes held in incoming_queue, charged to the buffer budget
+  size_t incoming_bytes;
   // Cumulative number of bytes transmitted on this socket
   int64_t tx_bytes;
   // Cumulative number of bytes received on this socket
   int64_t rx_bytes;
 } rfc_slot_t;
 
-static rfc_slot_t rfc_slots[MAX_RFC_CHANNEL];
+static rfc_slot_t rfc_slots[MAX_RFC_SLOTS];
 static uint32_t rfc_slot_id;
 static volatile int pth = -1;  // poll thread handle
 static std::recursive_mutex slot_lock;
@@ -153,17 +167,42 @@ void btsock_rfc_cleanup(void) {
   }
 }
 
+void btsock_rfc_debug_dump(int fd) {
+  std::unique_lock<std::recursive_mutex> lock(slot_lock);
+  dprintf(fd, "\nRFCOMM Sockets:\n");
+  for (size_t i = 0; i < ARRAY_SIZE(rfc_slots); ++i) {
+    const rfc_slot_t* slot = &rfc_slots[i];
+    if (!slot->id || !slot->f.connected) continue;
+    dprintf(fd,
+            "  id: %u peer: %s scn: %d uid: %d tx: %" PRId64 " rx: %" PRId64
+            " bytes, %zu bytes in %zu buffers not read by the app\n",
+            slot->id, slot->addr.ToString().c_str(), slot->scn, slot->app_uid,
+            slot->tx_bytes, slot->rx_bytes, slot->incoming_bytes,
+            list_length(slot->incoming_queue));
+  }
+}
+
 static rfc_slot_t* find_free_slot(void) {
   for (size_t i = 0; i < ARRAY_SIZE(rfc_slots); ++i)
     if (rfc_slots[i].fd == INVALID_FD) return &rfc_slots[i];
   return NULL;
 }
 
+// The slot ids are picked so that id % MAX_RFC_SLOTS is the index of the
+// slot: the data path finds its slot without a scan of the table.
+static uint32_t next_rfc_slot_id(const rfc_slot_t* slot) {
+  uint32_t index = slot - rfc_slots;
+  // Wrap early enough for the id to stay non-zero
+  if (rfc_slot_id > UINT32_MAX - 2 * MAX_RFC_SLOTS) rfc_slot_id = 0;
+  uint32_t id = rfc_slot_id + 1;
+  return id + (index + MAX_RFC_SLOTS - id % MAX_RFC_SLOTS) % MAX_RFC_SLOTS;
+}
+
 static rfc_slot_t* find_rfc_slot_by_id(uint32_t id) {
   CHECK(id != 0);
 
-  for (size_t i = 0; i < ARRAY_SIZE(rfc_slots); ++i)
-    if (rfc_slots[i].id == id) return &rfc_slots[i];
+  rfc_slot_t* slot = &rfc_slots[id % MAX_RFC_SLOTS];
+  if (slot->id == id) return slot;
 
   LOG_ERROR(LOG_TAG, "%s unable to find RFCOMM slot id: %u", __func__, id);
   return NULL;
@@ -214,8 +253,7 @@ static rfc_slot_t* alloc_rfc_slot(const RawAddress* addr, const char* name,
     return NULL;
   }
 
-  // Increment slot id and make sure we don't use id=0.
-  if (++rfc_slot_id == 0) rfc_slot_id = 1;
+  rfc_slot_id = next_rfc_slot_id(slot);
 
   slot->fd = fds[0];
   slot->app_fd = fds[1];
@@ -447,6 +485,8 @@ static void cleanup_rfc_slot(rfc_slot_t* slot) {
 
   free_rfc_slot_scn(slot);
   list_clear(slot->incoming_queue);
+  btu_budget_release(BTU_BUDGET_SOCK_RX, slot->incoming_bytes);
+  slot->incoming_bytes = 0;
 
   slot->rfc_port_handle = 0;
   memset(&slot->f, 0, sizeof(slot->f));
@@ -818,10 +858,59 @@ static sent_status_t send_data_to_app(int fd, BT_HDR* p_buf) {
   return SENT_PARTIAL;
 }
 
+// Sends as much of the queued data of |slot| to the app as a single sendmsg
+// takes, and frees the buffers sent whole.
+static sent_status_t send_queue_to_app(rfc_slot_t* slot) {
+  int fd = slot->fd;
+  list_t* queue = slot->incoming_queue;
+  struct iovec iov[RFC_SOCK_MAX_IOV];
+  int iovcnt = 0;
+  size_t total = 0;
+  for (const list_node_t* node = list_begin(queue);
+       node != list_end(queue) && iovcnt < RFC_SOCK_MAX_IOV;
+       node = list_next(node)) {
+    BT_HDR* p_buf = (BT_HDR*)list_node(node);
+    iov[iovcnt].iov_base = p_buf->data + p_buf->offset;
+    iov[iovcnt].iov_len = p_buf->len;
+    total += p_buf->len;
+    iovcnt++;
+  }
+
+  ssize_t sent = 0;
+  if (total != 0) {
+    struct msghdr msg = {};
+    msg.msg_iov = iov;
+    msg.msg_iovlen = iovcnt;
+    OSI_NO_INTR(sent = sendmsg(fd, &msg, MSG_DONTWAIT));
+
+    if (sent == -1) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) return SENT_NONE;
+      LOG_ERROR(LOG_TAG, "%s error writing RFCOMM data back to app: %s",
+                __func__, strerror(errno));
+      return SENT_FAILED;
+    }
+
+    if (sent == 0) return SENT_FAILED;
+  }
+
+  slot->incoming_bytes -= sent;
+  btu_budget_release(BTU_BUDGET_SOCK_RX, sent);
+  for (int i = 0; i < iovcnt; i++) {
+    BT_HDR* p_buf = (BT_HDR*)list_front(queue);
+    if ((size_t)sent < p_buf->len) {
+      p_buf->offset += sent;
+      p_buf->len -= sent;
+      return SENT_PARTIAL;
+    }
+    sent -= p_buf->len;
+    list_remove(queue, p_buf);
+  }
+  return SENT_ALL;
+}
+
 static bool flush_incoming_que_on_wr_signal(rfc_slot_t* slot) {
   while (!list_is_empty(slot->incoming_queue)) {
-    BT_HDR* p_buf = (BT_HDR*)list_front(slot->incoming_queue);
-    switch (send_data_to_app(slot->fd, p_buf)) {
+    switch (send_queue_to_app(slot)) {
       case SENT_NONE:
       case SENT_PARTIAL:
         // monitor the fd to get callback when app is ready to receive data
@@ -830,11 +919,9 @@ static bool flush_incoming_que_on_wr_signal(rfc_slot_t* slot) {
         return true;
 
       case SENT_ALL:
-        list_remove(slot->incoming_queue, p_buf);
         break;
 
       case SENT_FAILED:
-        list_remove(slot->incoming_queue, p_buf);
         return false;
     }
   }
@@ -907,6 +994,8 @@ int bta_co_rfc_data_incoming(uint32_t id, BT_HDR* p_buf) {
       case SENT_NONE:
       case SENT_PARTIAL:
         list_append(slot->incoming_queue, p_buf);
+        slot->incoming_bytes += p_buf->len;
+        btu_budget_charge(BTU_BUDGET_SOCK_RX, p_buf->len);
         btsock_thread_add_fd(pth, slot->fd, BTSOCK_RFCOMM, SOCK_THREAD_FD_WR,
                              slot->id);
         break;
@@ -923,6 +1012,8 @@ int bta_co_rfc_data_incoming(uint32_t id, BT_HDR* p_buf) {
     }
   } else {
     list_append(slot->incoming_queue, p_buf);
+    slot->incoming_bytes += p_buf->len;
+    btu_budget_charge(BTU_BUDGET_SOCK_RX, p_buf->len);
   }
 
   slot->rx_bytes += bytes_rx;
@@ -965,3 +1056,30 @@ int bta_co_rfc_data_outgoing(uint32_t id, uint8_t* buf, uint16_t size) {
 
   return true;
 }
+
+int bta_co_rfc_data_outgoing_buffers(uint32_t id, BT_HDR** p_bufs,
+                                     uint16_t num_bufs) {
+  std::unique_lock<std::recursive_mutex> lock(slot_lock);
+  rfc_slot_t* slot = find_rfc_slot_by_id(id);
+  if (!slot) return false;
+
+  struct iovec* iov = (struct iovec*)alloca(num_bufs * sizeof(*iov));
+  size_t size = 0;
+  for (uint16_t i = 0; i < num_bufs; i++) {
+    iov[i].iov_base = p_bufs[i]->data + p_bufs[i]->offset;
+    iov[i].iov_len = p_bufs[i]->len;
+    size += p_bufs[i]->len;
+  }
+
+  ssize_t received;
+  OSI_NO_INTR(received = readv(slot->fd, iov, num_bufs));
+
+  if (received < 0 || (size_t)received != size) {
+    LOG_ERROR(LOG_TAG, "%s error receiving RFCOMM data from app: %s", __func__,
+              strerror(errno));
+    cleanup_rfc_slot(slot);
+    return false;
+  }
+
+  return true;
+}
@@ -38,8 +38,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/poll.h>
-#include <sys/select.h>
+#include <sys/epoll.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <sys/un.h>
@@ -48,6 +47,7 @@
 
 #include <mutex>
 #include <string>
+#include <unordered_map>
 
 #include "bta_api.h"
 #include "btif_common.h"
@@ -65,28 +65,36 @@
 
 #define MAX_THREAD 8
 #define MAX_POLL 64
-#define POLL_EXCEPTION_EVENTS (POLLHUP | POLLRDHUP | POLLERR | POLLNVAL)
+#define POLL_EXCEPTION_EVENTS (EPOLLHUP | EPOLLRDHUP | EPOLLERR)
 #define IS_EXCEPTION(e) ((e)&POLL_EXCEPTION_EVENTS)
-#define IS_READ(e) ((e)&POLLIN)
-#define IS_WRITE(e) ((e)&POLLOUT)
+#define IS_READ(e) ((e)&EPOLLIN)
+#define IS_WRITE(e) ((e)&EPOLLOUT)
+/* epoll event data of the cmd fd, data fds use POLL_EVENT_DATA */
+#define CMD_EVENT_DATA UINT64_MAX
+#define POLL_EVENT_DATA(fd, seq) ((uint64_t)(seq) << 32 | (uint32_t)(fd))
 /*cmd executes in socket poll thread */
 #define CMD_WAKEUP 1
 #define CMD_EXIT 2
-#define CMD_ADD_FD 3
 #define CMD_REMOVE_FD 4
 #define CMD_USER_PRIVATE 5
 
 typedef struct {
-  struct pollfd pfd;
+  int fd;
+  // tells events of this registration from those of an earlier registration of
+  // the same fd number
+  uint32_t seq;
   uint32_t user_id;
   int type;
   int flags;
 } poll_slot_t;
 typedef struct {
   int cmd_fdr, cmd_fdw;
-  int poll_count;
-  poll_slot_t ps[MAX_POLL];
-  int psi[MAX_POLL];  // index of poll slot
+  int epoll_fd;
+  // registered fds, by fd. They are registered from any thread, so the slots
+  // are guarded by |poll_lock|
+  std::unordered_map<int, poll_slot_t> ps;
+  uint32_t next_seq;
+  std::mutex poll_lock;
   pthread_t thread_id;
   btsock_signaled_cb callback;
   btsock_cmd_cb cmd_callback;
@@ -97,8 +105,7 @@ static thread_slot_t ts[MAX_THREAD];
 static void* sock_poll_thread(void* arg);
 static inline void close_cmd_fd(int h);
 
-static inline void add_poll(int h, int fd, int type, int flags,
-                            uint32_t user_id);
+static bool add_poll(int h, int fd, int type, int flags, uint32_t user_id);
 
 static std::recursive_mutex thread_slot_lock;
 
@@ -145,6 +152,14 @@ static int alloc_thread_slot() {
 static void free_thread_slot(int h) {
   if (0 <= h && h < MAX_THREAD) {
     close_cmd_fd(h);
+    if (ts[h].epoll_fd != -1) {
+      close(ts[h].epoll_fd);
+      ts[h].epoll_fd = -1;
+    }
+    {
+      std::lock_guard<std::mutex> lock(ts[h].poll_lock);
+      ts[h].ps.clear();
+    }
     ts[h].used = 0;
   } else
     APPL_TRACE_ERROR("invalid thread handle:%d", h);
@@ -157,9 +172,10 @@ int btsock_thread_init() {
     int h;
     for (h = 0; h < MAX_THREAD; h++) {
       ts[h].cmd_fdr = ts[h].cmd_fdw = -1;
+      ts[h].epoll_fd = -1;
       ts[h].used = 0;
       ts[h].thread_id = -1;
-      ts[h].poll_count = 0;
+      ts[h].next_seq = 0;
       ts[h].callback = NULL;
       ts[h].cmd_callback = NULL;
     }
@@ -198,8 +214,14 @@ static inline void init_cmd_fd(int h) {
   }
   APPL_TRACE_DEBUG("h:%d, cmd_fdr:%d, cmd_fdw:%d", h, ts[h].cmd_fdr,
                    ts[h].cmd_fdw);
-  // add the cmd fd for read & write
-  add_poll(h, ts[h].cmd_fdr, 0, SOCK_THREAD_FD_RD, 0);
+  // the cmd fd stays registered for read, level-triggered, until the thread
+  // exits
+  struct epoll_event event = {};
+  event.events = EPOLLIN;
+  event.data.u64 = CMD_EVENT_DATA;
+  if (epoll_ctl(ts[h].epoll_fd, EPOLL_CTL_ADD, ts[h].cmd_fdr, &event) == -1) {
+    APPL_TRACE_ERROR("epoll_ctl failed for cmd fd: %s", strerror(errno));
+  }
 }
 static inline void close_cmd_fd(int h) {
   if (ts[h].cmd_fdr != -1) {
@@ -228,24 +250,11 @@ int btsock_thread_add_fd(int h, int fd, int type, int flags, uint32_t user_id) {
         "cmd socket is not created. socket thread may not initialized");
     return false;
   }
-  if (flags & SOCK_THREAD_ADD_FD_SYNC) {
-    // must executed in socket poll thread
-    if (ts[h].thread_id == pthread_self()) {
-      // cleanup one-time flags
-      flags &= ~SOCK_THREAD_ADD_FD_SYNC;
-      add_poll(h, fd, type, flags, user_id);
-      return true;
-    }
-    APPL_TRACE_DEBUG(
-        "THREAD_ADD_FD_SYNC is not called in poll thread, fallback to async");
-  }
-  sock_cmd_t cmd = {CMD_ADD_FD, fd, type, flags, user_id};
+  // fds are registered with epoll directly from any thread, so every add is
+  // immediate: cleanup one-time flags
+  flags &= ~SOCK_THREAD_ADD_FD_SYNC;
   APPL_TRACE_DEBUG("adding fd:%d, flags:0x%x", fd, flags);
-
-  ssize_t ret;
-  OSI_NO_INTR(ret = send(ts[h].cmd_fdw, &cmd, sizeof(cmd), 0));
-
-  return ret == sizeof(cmd);
+  return add_poll(h, fd, type, flags, user_id);
 }
 
 bool btsock_thread_remove_fd_and_close(int thread_handle, int fd) {
@@ -340,28 +349,55 @@ int btsock_thread_exit(int h) {
   return false;
 }
 static void init_poll(int h) {
-  int i;
-  ts[h].poll_count = 0;
   ts[h].thread_id = -1;
   ts[h].callback = NULL;
   ts[h].cmd_callback = NULL;
-  for (i = 0; i < MAX_POLL; i++) {
-    ts[h].ps[i].pfd.fd = -1;
-    ts[h].psi[i] = -1;
+  {
+    std::lock_guard<std::mutex> lock(ts[h].poll_lock);
+    ts[h].ps.clear();
+  }
+  asrt(ts[h].epoll_fd == -1);
+  ts[h].epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  if (ts[h].epoll_fd == -1) {
+    APPL_TRACE_ERROR("epoll_create1 failed: %s", strerror(errno));
+    return;
   }
   init_cmd_fd(h);
 }
-static inline unsigned int flags2pevents(int flags) {
-  unsigned int pevents = 0;
-  if (flags & SOCK_THREAD_FD_WR) pevents |= POLLOUT;
-  if (flags & SOCK_THREAD_FD_RD) pevents |= POLLIN;
+// Data fds are registered one-shot: once signaled, a fd is disarmed until its
+// remaining or newly added flags re-arm it, which matches the contract of
+// btsock_thread_add_fd. Re-arming reports readiness that is already pending.
+static inline uint32_t flags2pevents(int flags) {
+  uint32_t pevents = EPOLLONESHOT;
+  if (flags & SOCK_THREAD_FD_WR) pevents |= EPOLLOUT;
+  if (flags & SOCK_THREAD_FD_RD) pevents |= EPOLLIN;
   pevents |= POLL_EXCEPTION_EVENTS;
   return pevents;
 }
 
+// Register |ps| with epoll, or update its registration. Called with
+// |poll_lock| held.
+static bool arm_poll(int h, poll_slot_t* ps, bool is_new) {
+  struct epoll_event event = {};
+  event.events = flags2pevents(ps->flags);
+  event.data.u64 = POLL_EVENT_DATA(ps->fd, ps->seq);
+  int ret = epoll_ctl(ts[h].epoll_fd, is_new ? EPOLL_CTL_ADD : EPOLL_CTL_MOD,
+                      ps->fd, &event);
+  // a fd closed without being removed leaves the epoll set on its own, and its
+  // number may have been reused since
+  if (ret == -1 && !is_new && errno == ENOENT)
+    ret = epoll_ctl(ts[h].epoll_fd, EPOLL_CTL_ADD, ps->fd, &event);
+  if (ret == -1) {
+    APPL_TRACE_ERROR("epoll_ctl failed for fd:%d, err:%s", ps->fd,
+                     strerror(errno));
+    return false;
+  }
+  return true;
+}
+
 static inline void set_poll(poll_slot_t* ps, int fd, int type, int flags,
                             uint32_t user_id) {
-  ps->pfd.fd = fd;
+  ps->fd = fd;
   ps->user_id = user_id;
   if (ps->type != 0 && ps->type != type)
     APPL_TRACE_ERROR(
@@ -369,44 +405,41 @@ static inline void set_poll(poll_slot_t* ps, int fd, int type, int flags,
         ps->type, type);
   ps->type = type;
   ps->flags = flags;
-  ps->pfd.events = flags2pevents(flags);
-  ps->pfd.revents = 0;
 }
-static inline void add_poll(int h, int fd, int type, int flags,
-                            uint32_t user_id) {
+static bool add_poll(int h, int fd, int type, int flags, uint32_t user_id) {
   asrt(fd != -1);
-  int i;
-  int empty = -1;
-  poll_slot_t* ps = ts[h].ps;
-
-  for (i = 0; i < MAX_POLL; i++) {
-    if (ps[i].pfd.fd == fd) {
-      asrt(ts[h].poll_count < MAX_POLL);
-
-      set_poll(&ps[i], fd, type, flags | ps[i].flags, user_id);
-      return;
-    } else if (empty < 0 && ps[i].pfd.fd == -1)
-      empty = i;
-  }
-  if (empty >= 0) {
-    asrt(ts[h].poll_count < MAX_POLL);
-    set_poll(&ps[empty], fd, type, flags, user_id);
-    ++ts[h].poll_count;
-    return;
+  std::lock_guard<std::mutex> lock(ts[h].poll_lock);
+  auto it = ts[h].ps.find(fd);
+  if (it != ts[h].ps.end()) {
+    poll_slot_t* ps = &it->second;
+    set_poll(ps, fd, type, flags | ps->flags, user_id);
+    return arm_poll(h, ps, false);
   }
-  APPL_TRACE_ERROR("exceeded max poll slot:%d!", MAX_POLL);
+  if (ts[h].ps.size() >= MAX_POLL) {
+    APPL_TRACE_ERROR("exceeded max poll slot:%d!", MAX_POLL);
+    return false;
+  }
+  poll_slot_t* ps = &ts[h].ps[fd];
+  ps->type = 0;
+  ps->seq = ts[h].next_seq++;
+  set_poll(ps, fd, type, flags, user_id);
+  if (!arm_poll(h, ps, true)) {
+    ts[h].ps.erase(fd);
+    return false;
+  }
+  return true;
 }
+// Called with |poll_lock| held. |ps| is freed if all its flags are removed.
 static inline void remove_poll(int h, poll_slot_t* ps, int flags) {
   if (flags == ps->flags) {
     // all monitored events signaled. To remove it, just clear the slot
-    --ts[h].poll_count;
-    memset(ps, 0, sizeof(*ps));
-    ps->pfd.fd = -1;
+    epoll_ctl(ts[h].epoll_fd, EPOLL_CTL_DEL, ps->fd, NULL);
+    ts[h].ps.erase(ps->fd);
   } else {
     // one read or one write monitor event signaled, removed the accordding bit
     ps->flags &= ~flags;
-    // update the poll events mask
-    ps->pfd.events = flags2pevents(ps->flags);
+    // update the poll events mask, and re-arm the fd
+    arm_poll(h, ps, false);
   }
 }
 static int process_cmd_sock(int h) {
@@ -422,19 +455,14 @@ static int process_cmd_sock(int h) {
   }
   APPL_TRACE_DEBUG("cmd.id:%d", cmd.id);
   switch (cmd.id) {
-    case CMD_ADD_FD:
-      add_poll(h, cmd.fd, cmd.type, cmd.flags, cmd.user_id);
-      break;
-    case CMD_REMOVE_FD:
-      for (int i = 1; i < MAX_POLL; ++i) {
-        poll_slot_t* poll_slot = &ts[h].ps[i];
-        if (poll_slot->pfd.fd == cmd.fd) {
-          remove_poll(h, poll_slot, poll_slot->flags);
-          break;
-        }
-      }
+    case CMD_REMOVE_FD: {
+      std::unique_lock<std::mutex> lock(ts[h].poll_lock);
+      auto it = ts[h].ps.find(cmd.fd);
+      if (it != ts[h].ps.end()) remove_poll(h, &it->second, it->second.flags);
+      lock.unlock();
       close(cmd.fd);
       break;
+    }
     case CMD_WAKEUP:
       break;
     case CMD_USER_PRIVATE:
@@ -451,101 +479,75 @@ static int process_cmd_sock(int h) {
   return true;
 }
 
-static void print_events(short events) {
+static void print_events(uint32_t events) {
   std::string flags("");
-  if ((events)&POLLIN) flags += " POLLIN";
-  if ((events)&POLLPRI) flags += " POLLPRI";
-  if ((events)&POLLOUT) flags += " POLLOUT";
-  if ((events)&POLLERR) flags += " POLLERR";
-  if ((events)&POLLHUP) flags += " POLLHUP ";
-  if ((events)&POLLNVAL) flags += " POLLNVAL";
-  if ((events)&POLLRDHUP) flags += " POLLRDHUP";
+  if ((events)&EPOLLIN) flags += " EPOLLIN";
+  if ((events)&EPOLLPRI) flags += " EPOLLPRI";
+  if ((events)&EPOLLOUT) flags += " EPOLLOUT";
+  if ((events)&EPOLLERR) flags += " EPOLLERR";
+  if ((events)&EPOLLHUP) flags += " EPOLLHUP ";
+  if ((events)&EPOLLRDHUP) flags += " EPOLLRDHUP";
   APPL_TRACE_DEBUG("print poll event:%x = %s", (events), flags.c_str());
 }
 
-static void process_data_sock(int h, struct pollfd* pfds, int count) {
-  asrt(count <= ts[h].poll_count);
-  int i;
-  for (i = 1; i < ts[h].poll_count; i++) {
-    if (pfds[i].revents) {
-      int ps_i = ts[h].psi[i];
-      asrt(pfds[i].fd == ts[h].ps[ps_i].pfd.fd);
-      uint32_t user_id = ts[h].ps[ps_i].user_id;
-      int type = ts[h].ps[ps_i].type;
-      int flags = 0;
-      print_events(pfds[i].revents);
-      if (IS_READ(pfds[i].revents)) {
-        flags |= SOCK_THREAD_FD_RD;
-      }
-      if (IS_WRITE(pfds[i].revents)) {
-        flags |= SOCK_THREAD_FD_WR;
-      }
-      if (IS_EXCEPTION(pfds[i].revents)) {
-        flags |= SOCK_THREAD_FD_EXCEPTION;
-        // remove the whole slot not flags
-        remove_poll(h, &ts[h].ps[ps_i], ts[h].ps[ps_i].flags);
-      } else if (flags)
-        remove_poll(h, &ts[h].ps[ps_i],
-                    flags);  // remove the monitor flags that already processed
-      if (flags) ts[h].callback(pfds[i].fd, type, flags, user_id);
-    }
+static void process_data_sock(int h, const struct epoll_event* event) {
+  int fd = (int)(uint32_t)event->data.u64;
+  uint32_t seq = event->data.u64 >> 32;
+
+  std::unique_lock<std::mutex> lock(ts[h].poll_lock);
+  auto it = ts[h].ps.find(fd);
+  // the fd was removed earlier in this batch, possibly registered again since
+  if (it == ts[h].ps.end() || it->second.seq != seq) return;
+
+  poll_slot_t* ps = &it->second;
+  uint32_t user_id = ps->user_id;
+  int type = ps->type;
+  int flags = 0;
+  print_events(event->events);
+  if (IS_READ(event->events)) {
+    flags |= SOCK_THREAD_FD_RD;
   }
-}
-
-static void prepare_poll_fds(int h, struct pollfd* pfds) {
-  int count = 0;
-  int ps_i = 0;
-  int pfd_i = 0;
-  asrt(ts[h].poll_count <= MAX_POLL);
-  memset(pfds, 0, sizeof(pfds[0]) * ts[h].poll_count);
-  while (count < ts[h].poll_count) {
-    if (ps_i >= MAX_POLL) {
-      APPL_TRACE_ERROR(
-          "exceed max poll range, ps_i:%d, MAX_POLL:%d, count:%d, "
-          "ts[h].poll_count:%d",
-          ps_i, MAX_POLL, count, ts[h].poll_count);
-      return;
-    }
-    if (ts[h].ps[ps_i].pfd.fd >= 0) {
-      pfds[pfd_i] = ts[h].ps[ps_i].pfd;
-      ts[h].psi[pfd_i] = ps_i;
-      count++;
-      pfd_i++;
-    }
-    ps_i++;
+  if (IS_WRITE(event->events)) {
+    flags |= SOCK_THREAD_FD_WR;
+  }
+  if (IS_EXCEPTION(event->events)) {
+    flags |= SOCK_THREAD_FD_EXCEPTION;
+    // remove the whole slot not flags
+    remove_poll(h, ps, ps->flags);
+  } else if (flags) {
+    // remove the monitor flags that already processed
+    remove_poll(h, ps, flags);
   }
+  lock.unlock();
+
+  if (flags) ts[h].callback(fd, type, flags, user_id);
 }
+
 static void* sock_poll_thread(void* arg) {
-  struct pollfd pfds[MAX_POLL];
-  memset(pfds, 0, sizeof(pfds));
+  struct epoll_event events[MAX_POLL];
   int h = (intptr_t)arg;
   for (;;) {
-    prepare_poll_fds(h, pfds);
     int ret;
-    OSI_NO_INTR(ret = poll(pfds, ts[h].poll_count, -1));
+    OSI_NO_INTR(ret = epoll_wait(ts[h].epoll_fd, events, MAX_POLL, -1));
     if (ret == -1) {
-      APPL_TRACE_ERROR("poll ret -1, exit the thread, errno:%d, err:%s", errno,
-                       strerror(errno));
+      APPL_TRACE_ERROR("epoll_wait ret -1, exit the thread, errno:%d, err:%s",
+                       errno, strerror(errno));
       break;
     }
-    if (ret != 0) {
-      int need_process_data_fd = true;
-      if (pfds[0].revents)  // cmd fd always is the first one
-      {
-        asrt(pfds[0].fd == ts[h].cmd_fdr);
-        if (!process_cmd_sock(h)) {
-          APPL_TRACE_DEBUG("h:%d, process_cmd_sock return false, exit...", h);
-          break;
-        }
-        if (ret == 1)
-          need_process_data_fd = false;
-        else
-          ret--;  // exclude the cmd fd
+    // the cmd fd is processed first, so that removed fds are not signaled
+    bool exiting = false;
+    for (int i = 0; i < ret; i++) {
+      if (events[i].data.u64 == CMD_EVENT_DATA && !process_cmd_sock(h)) {
+        APPL_TRACE_DEBUG("h:%d, process_cmd_sock return false, exit...", h);
+        exiting = true;
+        break;
       }
-      if (need_process_data_fd) process_data_sock(h, pfds, ret);
-    } else {
-      APPL_TRACE_DEBUG("no data, select ret: %d", ret)
-    };
+    }
+    if (exiting) break;
+    for (int i = 0; i < ret; i++) {
+      if (events[i].data.u64 != CMD_EVENT_DATA)
+        process_data_sock(h, &events[i]);
+    }
   }
   APPL_TRACE_DEBUG("socket poll thread exiting, h:%d", h);
   return 0;
@@ -35,11 +35,17 @@
 #include <alloca.h>
 #include <base/logging.h>
 #include <ctype.h>
+#include <inttypes.h>
 #include <log/log.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
 #include "bt_common.h"
 #include "bta_hd_api.h"
 #include "bta_hearing_aid_api.h"
@@ -49,6 +55,7 @@
 #include "btif_hd.h"
 #include "btif_hh.h"
 #include "btif_util.h"
+#include "common/time_util.h"
 #include "device/include/controller.h"
 #include "osi/include/allocator.h"
 #include "osi/include/compat.h"
@@ -86,6 +93,11 @@ using bluetooth::Uuid;
 /* This is a local property to add a device found */
 #define BT_PROPERTY_REMOTE_DEVICE_TIMESTAMP 0xFF
 
+/* Scanned devices staged at most; a full table is flushed and emptied */
+#define BTIF_STORAGE_SCAN_STAGING_MAX_DEVICES 512
+/* Period of the batched writes of the properties staged for scanned devices */
+#define BTIF_STORAGE_SCAN_STAGING_FLUSH_MS (30 * 1000)
+
 // TODO: This macro should be converted to a function
 #define BTIF_STORAGE_GET_ADAPTER_PROP(s, t, v, l, p) \
   do {                                               \
@@ -160,6 +172,37 @@ typedef struct {
   RawAddress devices[BTM_SEC_MAX_DEVICE_RECORDS];
 } btif_bonded_devices_t;
 
+/* LE keys of a bonded device, in the order they are added to BTA */
+#define BTIF_STORAGE_NUM_LE_KEYS 6
+static const struct {
+  uint8_t key_type;
+  size_t key_len;
+  const char* name;
+} btif_storage_le_keys[BTIF_STORAGE_NUM_LE_KEYS] = {
+    {BTIF_DM_LE_KEY_PENC, sizeof(tBTM_LE_PENC_KEYS), "LE_KEY_PENC"},
+    {BTIF_DM_LE_KEY_PID, sizeof(tBTM_LE_PID_KEYS), "LE_KEY_PID"},
+    {BTIF_DM_LE_KEY_LID, sizeof(tBTM_LE_PID_KEYS), "LE_KEY_LID"},
+    {BTIF_DM_LE_KEY_PCSRK, sizeof(tBTM_LE_PCSRK_KEYS), "LE_KEY_PCSRK"},
+    {BTIF_DM_LE_KEY_LENC, sizeof(tBTM_LE_LENC_KEYS), "LE_KEY_LENC"},
+    {BTIF_DM_LE_KEY_LCSRK, sizeof(tBTM_LE_LCSRK_KEYS), "LE_KEY_LCSRK"},
+};
+
+/* Bonding information of a device, read from its config section in a single
+ * pass by btif_in_read_bonded_device() */
+typedef struct {
+  RawAddress bd_addr;
+  bool has_link_key; /* LinkKey and LinkKeyType are stored */
+  LinkKey link_key;
+  int link_key_type;
+  int pin_length;
+  int cod;      /* 0 if not stored */
+  int dev_type; /* 0 if not stored */
+  bool is_le;   /* the LE keys and the address type were read */
+  int addr_type;
+  bool le_key_found[BTIF_STORAGE_NUM_LE_KEYS];
+  tBTA_LE_KEY_VALUE le_keys[BTIF_STORAGE_NUM_LE_KEYS];
+} btif_bonded_device_t;
+
 /*******************************************************************************
  *  External functions
  ******************************************************************************/
@@ -433,20 +476,151 @@ static bt_status_t btif_in_fetch_bonded_device(const std::string& bdstr) {
 
 /*******************************************************************************
  *
- * Function         btif_in_fetch_bonded_devices
+ * Function         btif_in_read_bonded_device
  *
- * Description      Internal helper function to fetch the bonded devices
- *                  from NVRAM
+ * Description      Internal helper function to read the bonding information
+ *                  of the device of config section |name|, decoding each
+ *                  stored key once.
  *
- * Returns          BT_STATUS_SUCCESS if successful, BT_STATUS_FAIL otherwise
+ * Returns          void
  *
  ******************************************************************************/
-static bt_status_t btif_in_fetch_bonded_devices(
-    btif_bonded_devices_t* p_bonded_devices, int add) {
-  memset(p_bonded_devices, 0, sizeof(btif_bonded_devices_t));
+static void btif_in_read_bonded_device(const std::string& name,
+                                       btif_bonded_device_t* p_dev) {
+  RawAddress::FromString(name, p_dev->bd_addr);
+
+  size_t size = p_dev->link_key.size();
+  if (btif_config_get_bin(name, "LinkKey", p_dev->link_key.data(), &size) &&
+      btif_config_get_int(name, "LinkKeyType", &p_dev->link_key_type)) {
+    p_dev->has_link_key = true;
+    btif_config_get_int(name, "DevClass", &p_dev->cod);
+    btif_config_get_int(name, "PinLength", &p_dev->pin_length);
+  }
 
-  bool bt_linkkey_file_found = false;
-  int device_type;
+  bool has_ble_keys = btif_has_ble_keys(name);
+  bool has_dev_type = btif_config_get_int(name, "DevType", &p_dev->dev_type);
+  p_dev->is_le = has_dev_type &&
+                 ((p_dev->dev_type & BT_DEVICE_TYPE_BLE) == BT_DEVICE_TYPE_BLE ||
+                  has_ble_keys);
+  if (!p_dev->is_le) {
+    /* the LTK is still checked by remove_devices_with_sample_ltk() */
+    if (has_ble_keys) {
+      size = btif_storage_le_keys[0].key_len;
+      p_dev->le_key_found[0] = btif_config_get_bin(
+          name, btif_storage_le_keys[0].name, (uint8_t*)&p_dev->le_keys[0],
+          &size);
+    }
+    return;
+  }
+
+  BTIF_TRACE_DEBUG("%s Found a LE device: %s", __func__, name.c_str());
+  if (btif_storage_get_remote_addr_type(&p_dev->bd_addr, &p_dev->addr_type) !=
+      BT_STATUS_SUCCESS) {
+    p_dev->addr_type = BLE_ADDR_PUBLIC;
+    btif_storage_set_remote_addr_type(&p_dev->bd_addr, BLE_ADDR_PUBLIC);
+  }
+
+  for (int i = 0; i < BTIF_STORAGE_NUM_LE_KEYS; i++) {
+    size = btif_storage_le_keys[i].key_len;
+    p_dev->le_key_found[i] =
+        btif_config_get_bin(name, btif_storage_le_keys[i].name,
+                            (uint8_t*)&p_dev->le_keys[i], &size);
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         btif_in_add_bonded_address
+ *
+ * Description      Internal helper function to add |bd_addr| to
+ *                  |p_bonded_devices|.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void btif_in_add_bonded_address(btif_bonded_devices_t* p_bonded_devices,
+                                       const RawAddress& bd_addr) {
+  if (p_bonded_devices->num_devices >= BTM_SEC_MAX_DEVICE_RECORDS) {
+    LOG(WARNING) << __func__ << ": too many bonded devices, dropping "
+                 << bd_addr;
+    return;
+  }
+  p_bonded_devices->devices[p_bonded_devices->num_devices++] = bd_addr;
+}
+
+/*******************************************************************************
+ *
+ * Function         btif_in_add_bonded_device
+ *
+ * Description      Internal helper function to add the bonded device |dev|
+ *                  to |p_bonded_devices|, and to BTA if |add| is set.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void btif_in_add_bonded_device(const btif_bonded_device_t& dev,
+                                      int add,
+                                      btif_bonded_devices_t* p_bonded_devices) {
+  bool key_found = false;
+
+  if (dev.has_link_key) {
+    if (add) {
+      DEV_CLASS dev_class = {0, 0, 0};
+      uint2devclass((uint32_t)dev.cod, dev_class);
+      BTA_DmAddDevice(dev.bd_addr, dev_class, dev.link_key, 0, 0,
+                      (uint8_t)dev.link_key_type, 0, dev.pin_length);
+
+      if (dev.dev_type == BT_DEVICE_TYPE_DUMO) {
+        btif_gatts_add_bonded_dev_from_nv(dev.bd_addr);
+      }
+    }
+    btif_in_add_bonded_address(p_bonded_devices, dev.bd_addr);
+  }
+
+  if (dev.is_le) {
+    bool device_added = false;
+
+    for (int i = 0; i < BTIF_STORAGE_NUM_LE_KEYS; i++) {
+      if (!dev.le_key_found[i]) continue;
+      key_found = true;
+      if (!add) continue;
+
+      if (!device_added) {
+        BTA_DmAddBleDevice(dev.bd_addr, dev.addr_type, BT_DEVICE_TYPE_BLE);
+        device_added = true;
+      }
+      BTIF_TRACE_DEBUG("%s() Adding key type %d for %s", __func__,
+                       btif_storage_le_keys[i].key_type,
+                       dev.bd_addr.ToString().c_str());
+      tBTA_LE_KEY_VALUE key = dev.le_keys[i];
+      BTA_DmAddBleKey(dev.bd_addr, &key, btif_storage_le_keys[i].key_type);
+    }
+
+    // Fill in the bonded devices
+    if (device_added) {
+      btif_in_add_bonded_address(p_bonded_devices, dev.bd_addr);
+      btif_gatts_add_bonded_dev_from_nv(dev.bd_addr);
+    }
+  }
+
+  if (!dev.has_link_key && !key_found) {
+    BTIF_TRACE_DEBUG("Remote device:%s, no link key or ble key found",
+                     dev.bd_addr.ToString().c_str());
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         btif_in_read_bonded_devices
+ *
+ * Description      Internal helper function to read the bonding information
+ *                  of all the devices, in a single pass over the config.
+ *
+ * Returns          The devices, in config order
+ *
+ ******************************************************************************/
+static std::vector<btif_bonded_device_t> btif_in_read_bonded_devices(void) {
+  std::vector<btif_bonded_device_t> devices;
 
   // TODO: this code is not thread safe, it can corrupt config content.
   // b/67595284
@@ -455,38 +629,28 @@ static bt_status_t btif_in_fetch_bonded_devices(
     if (!RawAddress::IsValidAddress(name)) continue;
 
     BTIF_TRACE_DEBUG("Remote device:%s", name.c_str());
-    LinkKey link_key;
-    size_t size = sizeof(link_key);
-    if (btif_config_get_bin(name, "LinkKey", link_key.data(), &size)) {
-      int linkkey_type;
-      if (btif_config_get_int(name, "LinkKeyType", &linkkey_type)) {
-        RawAddress bd_addr;
-        RawAddress::FromString(name, bd_addr);
-        if (add) {
-          DEV_CLASS dev_class = {0, 0, 0};
-          int cod;
-          int pin_length = 0;
-          if (btif_config_get_int(name, "DevClass", &cod))
-            uint2devclass((uint32_t)cod, dev_class);
-          btif_config_get_int(name, "PinLength", &pin_length);
-          BTA_DmAddDevice(bd_addr, dev_class, link_key, 0, 0,
-                          (uint8_t)linkkey_type, 0, pin_length);
-
-          if (btif_config_get_int(name, "DevType", &device_type) &&
-              (device_type == BT_DEVICE_TYPE_DUMO)) {
-            btif_gatts_add_bonded_dev_from_nv(bd_addr);
-          }
-        }
-        bt_linkkey_file_found = true;
-        p_bonded_devices->devices[p_bonded_devices->num_devices++] = bd_addr;
-      } else {
-        bt_linkkey_file_found = false;
-      }
-    }
-    if (!btif_in_fetch_bonded_ble_device(name, add, p_bonded_devices) && !bt_linkkey_file_found) {
-      BTIF_TRACE_DEBUG("Remote device:%s, no link key or ble key found",
-                       name.c_str());
-    }
+    devices.emplace_back();
+    btif_in_read_bonded_device(name, &devices.back());
+  }
+  return devices;
+}
+
+/*******************************************************************************
+ *
+ * Function         btif_in_fetch_bonded_devices
+ *
+ * Description      Internal helper function to fetch the bonded devices
+ *                  from NVRAM
+ *
+ * Returns          BT_STATUS_SUCCESS if successful, BT_STATUS_FAIL otherwise
+ *
+ ******************************************************************************/
+static bt_status_t btif_in_fetch_bonded_devices(
+    btif_bonded_devices_t* p_bonded_devices, int add) {
+  memset(p_bonded_devices, 0, sizeof(btif_bonded_devices_t));
+
+  for (const btif_bonded_device_t& dev : btif_in_read_bonded_devices()) {
+    btif_in_add_bonded_device(dev, add, p_bonded_devices);
   }
   return BT_STATUS_SUCCESS;
 }
@@ -744,6 +908,9 @@ bt_status_t btif_storage_set_adapter_property(bt_property_t* property) {
  ******************************************************************************/
 bt_status_t btif_storage_get_remote_device_property(
     const RawAddress* remote_bd_addr, bt_property_t* property) {
+  if (remote_bd_addr && property->type == BT_PROPERTY_TYPE_OF_DEVICE) {
+    btif_storage_flush_scanned_device(*remote_bd_addr);
+  }
   return cfg2prop(remote_bd_addr, property) ? BT_STATUS_SUCCESS
                                             : BT_STATUS_FAIL;
 }
@@ -871,36 +1038,25 @@ bt_status_t btif_storage_remove_bonded_device(
  * We still allow such devices to bond in order to give the user a chance to
  * update firmware.
  */
-static void remove_devices_with_sample_ltk() {
-  std::vector<RawAddress> bad_ltk;
-  for (const section_t& section : btif_config_sections()) {
-    const std::string& name = section.name;
-    if (!RawAddress::IsValidAddress(name)) {
-      continue;
-    }
-
-    RawAddress bd_addr;
-    RawAddress::FromString(name, bd_addr);
+static void remove_devices_with_sample_ltk(
+    std::vector<btif_bonded_device_t>* p_devices) {
+  auto is_bad_ltk = [](const btif_bonded_device_t& dev) {
+    return dev.le_key_found[0] && is_sample_ltk(dev.le_keys[0].penc_key.ltk);
+  };
 
-    tBTA_LE_KEY_VALUE key;
-    memset(&key, 0, sizeof(key));
-
-    if (btif_storage_get_ble_bonding_key(
-            &bd_addr, BTIF_DM_LE_KEY_PENC, (uint8_t*)&key,
-            sizeof(tBTM_LE_PENC_KEYS)) == BT_STATUS_SUCCESS) {
-      if (is_sample_ltk(key.penc_key.ltk)) {
-        bad_ltk.push_back(bd_addr);
-      }
-    }
-  }
+  for (btif_bonded_device_t& dev : *p_devices) {
+    if (!is_bad_ltk(dev)) continue;
 
-  for (RawAddress address : bad_ltk) {
     android_errorWriteLog(0x534e4554, "128437297");
     LOG(ERROR) << __func__
-               << ": removing bond to device using test TLK: " << address;
+               << ": removing bond to device using test TLK: " << dev.bd_addr;
 
-    btif_storage_remove_bonded_device(&address);
+    btif_storage_remove_bonded_device(&dev.bd_addr);
   }
+
+  p_devices->erase(
+      std::remove_if(p_devices->begin(), p_devices->end(), is_bad_ltk),
+      p_devices->end());
 }
 
 /*******************************************************************************
@@ -930,9 +1086,15 @@ bt_status_t btif_storage_load_bonded_devices(void) {
   Uuid remote_uuids[BT_MAX_NUM_UUIDS];
   bt_status_t status;
 
-  remove_devices_with_sample_ltk();
+  /* read every bonded device once, and add the ones left to BTA */
+  btif_config_prefetch_encrypted_keys();
+  std::vector<btif_bonded_device_t> devices = btif_in_read_bonded_devices();
+  remove_devices_with_sample_ltk(&devices);
 
-  btif_in_fetch_bonded_devices(&bonded_devices, 1);
+  memset(&bonded_devices, 0, sizeof(bonded_devices));
+  for (const btif_bonded_device_t& dev : devices) {
+    btif_in_add_bonded_device(dev, 1, &bonded_devices);
+  }
 
   /* Now send the adapter_properties_cb with all adapter_properties */
   {
@@ -1303,6 +1465,100 @@ bt_status_t btif_storage_set_remote_addr_type(const RawAddress* remote_bd_addr,
   return ret ? BT_STATUS_SUCCESS : BT_STATUS_FAIL;
 }
 
+/* Properties of a device seen while scanning, as last reported */
+typedef struct {
+  bt_device_type_t dev_type;
+  uint8_t addr_type;
+  /* Changed since last written to NVRAM */
+  bool dirty;
+} btif_storage_scanned_device_t;
+
+static std::mutex scan_staging_lock;
+static std::unordered_map<RawAddress, btif_storage_scanned_device_t>
+    scan_staging;
+static uint64_t scan_staging_last_flush_ms;
+static uint64_t scan_staging_reports;
+static uint64_t scan_staging_writes;
+static uint64_t scan_staging_suppressed;
+
+/* Must be called with scan_staging_lock held */
+static void btif_storage_write_scanned_device(
+    const RawAddress& remote_bd_addr, btif_storage_scanned_device_t* device) {
+  btif_config_set_int(remote_bd_addr.ToString(),
+                      BTIF_STORAGE_PATH_REMOTE_DEVTYPE, device->dev_type);
+  btif_storage_set_remote_addr_type(&remote_bd_addr, device->addr_type);
+  device->dirty = false;
+  scan_staging_writes++;
+}
+
+/* Must be called with scan_staging_lock held */
+static void btif_storage_flush_scanned_devices_locked(uint64_t now_ms) {
+  for (auto& entry : scan_staging) {
+    if (entry.second.dirty) {
+      btif_storage_write_scanned_device(entry.first, &entry.second);
+    }
+  }
+  scan_staging_last_flush_ms = now_ms;
+}
+
+void btif_storage_stage_scanned_device(const RawAddress& remote_bd_addr,
+                                       bt_device_type_t dev_type,
+                                       uint8_t addr_type) {
+  std::lock_guard<std::mutex> lock(scan_staging_lock);
+  uint64_t now_ms = bluetooth::common::time_get_os_boottime_ms();
+  scan_staging_reports++;
+
+  auto it = scan_staging.find(remote_bd_addr);
+  if (it != scan_staging.end() && it->second.dev_type == dev_type &&
+      it->second.addr_type == addr_type) {
+    scan_staging_suppressed++;
+  } else if (it != scan_staging.end()) {
+    /* A change is written right away */
+    it->second.dev_type = dev_type;
+    it->second.addr_type = addr_type;
+    btif_storage_write_scanned_device(remote_bd_addr, &it->second);
+  } else {
+    if (scan_staging.size() >= BTIF_STORAGE_SCAN_STAGING_MAX_DEVICES) {
+      btif_storage_flush_scanned_devices_locked(now_ms);
+      scan_staging.clear();
+    }
+    scan_staging[remote_bd_addr] = {dev_type, addr_type, true};
+  }
+
+  if (now_ms - scan_staging_last_flush_ms >=
+      BTIF_STORAGE_SCAN_STAGING_FLUSH_MS) {
+    btif_storage_flush_scanned_devices_locked(now_ms);
+  }
+}
+
+void btif_storage_flush_scanned_device(const RawAddress& remote_bd_addr) {
+  std::lock_guard<std::mutex> lock(scan_staging_lock);
+  auto it = scan_staging.find(remote_bd_addr);
+  if (it == scan_staging.end()) return;
+  /* Written even if not dirty: NVRAM may have dropped an unpaired device */
+  btif_storage_write_scanned_device(remote_bd_addr, &it->second);
+}
+
+void btif_storage_flush_scanned_devices(void) {
+  std::lock_guard<std::mutex> lock(scan_staging_lock);
+  btif_storage_flush_scanned_devices_locked(
+      bluetooth::common::time_get_os_boottime_ms());
+}
+
+void btif_storage_scanned_devices_dump(int fd) {
+  std::lock_guard<std::mutex> lock(scan_staging_lock);
+  size_t dirty = 0;
+  for (const auto& entry : scan_staging) {
+    if (entry.second.dirty) dirty++;
+  }
+  dprintf(fd, "\nScanned device property staging:\n");
+  dprintf(fd, "  Devices staged / not written yet: %zu / %zu\n",
+          scan_staging.size(), dirty);
+  dprintf(fd, "  Reports: %" PRIu64 "\n", scan_staging_reports);
+  dprintf(fd, "  Device writes: %" PRIu64 "\n", scan_staging_writes);
+  dprintf(fd, "  Writes suppressed: %" PRIu64 "\n", scan_staging_suppressed);
+}
+
 bool btif_has_ble_keys(const std::string& bdstr) {
   return btif_config_exist(bdstr, "LE_KEY_PENC");
 }
@@ -1319,6 +1575,7 @@ bool btif_has_ble_keys(const std::string& bdstr) {
  ******************************************************************************/
 bt_status_t btif_storage_get_remote_addr_type(const RawAddress* remote_bd_addr,
                                               int* addr_type) {
+  btif_storage_flush_scanned_device(*remote_bd_addr);
   int ret =
       btif_config_get_int(remote_bd_addr->ToString(), "AddrType", addr_type);
   return ret ? BT_STATUS_SUCCESS : BT_STATUS_FAIL;
@@ -23,6 +23,9 @@
 #include <base/callback.h>
 #include <base/location.h>
 
+#include <utility>
+#include <vector>
+
 #include "stack_manager.h"
 #include "types/raw_address.h"
 
@@ -263,3 +266,54 @@ TEST_F(BtifProfileQueueTest, test_cleanup_both_reverse_order) {
   btif_queue_connect_next();
   EXPECT_EQ(sResult, NOT_SET);
 }
+
+static const uint16_t kAudioSourceUuid = 0x110A;
+static const uint16_t kAudioSinkUuid = 0x110B;
+static const uint16_t kHandsfreeAgUuid = 0x111F;
+static std::vector<std::pair<RawAddress, uint16_t>> sConnects;
+
+static bt_status_t test_connect_cb_record(RawAddress* bda, uint16_t uuid) {
+  sConnects.emplace_back(*bda, uuid);
+  return BT_STATUS_SUCCESS;
+}
+
+TEST_F(BtifProfileQueueTest, test_independent_profiles_connect_concurrently) {
+  sConnects.clear();
+  btif_queue_connect(kAudioSourceUuid, &kTestAddr1, test_connect_cb_record);
+  btif_queue_connect(kHandsfreeAgUuid, &kTestAddr1, test_connect_cb_record);
+  ASSERT_EQ(sConnects.size(), 2u);
+  EXPECT_EQ(sConnects[0].second, kAudioSourceUuid);
+  EXPECT_EQ(sConnects[1].second, kHandsfreeAgUuid);
+  // The completion of HFP neither restarts nor completes A2DP
+  btif_queue_advance_by_uuid(kHandsfreeAgUuid, &kTestAddr1);
+  EXPECT_EQ(sConnects.size(), 2u);
+  btif_queue_connect(kHandsfreeAgUuid, &kTestAddr1, test_connect_cb_record);
+  EXPECT_EQ(sConnects.size(), 3u);
+}
+
+TEST_F(BtifProfileQueueTest, test_dependent_profiles_stay_serialized) {
+  sConnects.clear();
+  // Both A2DP roles use the same AVDTP signaling channel
+  btif_queue_connect(kAudioSourceUuid, &kTestAddr1, test_connect_cb_record);
+  btif_queue_connect(kAudioSinkUuid, &kTestAddr1, test_connect_cb_record);
+  // The same profiles to another peer are serialized
+  btif_queue_connect(kHandsfreeAgUuid, &kTestAddr2, test_connect_cb_record);
+  EXPECT_EQ(sConnects.size(), 1u);
+  btif_queue_advance_by_uuid(kAudioSourceUuid, &kTestAddr1);
+  ASSERT_EQ(sConnects.size(), 2u);
+  EXPECT_EQ(sConnects[1].second, kAudioSinkUuid);
+  btif_queue_advance_by_uuid(kAudioSinkUuid, &kTestAddr1);
+  ASSERT_EQ(sConnects.size(), 3u);
+  EXPECT_EQ(sConnects[2].first, kTestAddr2);
+}
+
+TEST_F(BtifProfileQueueTest, test_independent_profile_does_not_overtake) {
+  sConnects.clear();
+  btif_queue_connect(kTestUuid1, &kTestAddr1, test_connect_cb_record);
+  btif_queue_connect(kAudioSourceUuid, &kTestAddr1, test_connect_cb_record);
+  btif_queue_connect(kHandsfreeAgUuid, &kTestAddr1, test_connect_cb_record);
+  EXPECT_EQ(sConnects.size(), 1u);
+  // Once the unknown profile completes, A2DP and HFP start together
+  btif_queue_advance();
+  EXPECT_EQ(sConnects.size(), 3u);
+}
@@ -0,0 +1,95 @@
+/*
+ *  Copyright 2020 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "btif/include/btif_property_arena.h"
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstring>
+
+namespace {
+
+TEST(BtifPropertyArenaTest, blocks_are_aligned_and_distinct) {
+  BtifPropertyArena arena(256);
+  uint8_t* first = static_cast<uint8_t*>(arena.Alloc(3));
+  uint8_t* second = static_cast<uint8_t*>(arena.Alloc(5));
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(first) % alignof(std::max_align_t),
+            0u);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(second) % alignof(std::max_align_t),
+            0u);
+  EXPECT_GE(second - first, 3);
+  EXPECT_EQ(arena.ChunkCount(), 1u);
+}
+
+TEST(BtifPropertyArenaTest, reset_reuses_the_chunks) {
+  BtifPropertyArena arena(256);
+  void* first = arena.Alloc(200);
+  arena.Alloc(200);
+  EXPECT_EQ(arena.ChunkCount(), 2u);
+
+  arena.Reset();
+  EXPECT_EQ(arena.BytesInUse(), 0u);
+  EXPECT_EQ(arena.Alloc(200), first);
+  arena.Alloc(200);
+  EXPECT_EQ(arena.ChunkCount(), 2u);
+}
+
+TEST(BtifPropertyArenaTest, large_blocks_get_their_own_chunk) {
+  BtifPropertyArena arena(64);
+  uint8_t* block = static_cast<uint8_t*>(arena.Alloc(1000));
+  memset(block, 0xaa, 1000);
+  EXPECT_EQ(arena.ChunkCount(), 1u);
+  EXPECT_GE(arena.BytesInUse(), 1000u);
+}
+
+TEST(BtifPropertyArenaTest, copy_properties_is_deep) {
+  BtifPropertyArena arena;
+  bt_bdname_t name = {};
+  strcpy(reinterpret_cast<char*>(name.name), "headset");
+  int8_t rssi = -40;
+  bt_property_t properties[] = {
+      {BT_PROPERTY_BDNAME, static_cast<int>(strlen("headset")), &name},
+      {BT_PROPERTY_REMOTE_RSSI, sizeof(rssi), &rssi},
+  };
+
+  bt_property_t* copy = arena.CopyProperties(2, properties);
+  name.name[0] = 'x';
+  rssi = 0;
+  ASSERT_NE(copy, nullptr);
+  EXPECT_EQ(copy[0].type, BT_PROPERTY_BDNAME);
+  EXPECT_EQ(memcmp(copy[0].val, "headset", copy[0].len), 0);
+  EXPECT_EQ(copy[1].type, BT_PROPERTY_REMOTE_RSSI);
+  EXPECT_EQ(*static_cast<int8_t*>(copy[1].val), -40);
+  EXPECT_EQ(arena.CopyProperties(0, properties), nullptr);
+}
+
+TEST(BtifPropertyArenaTest, builder_copies_values) {
+  BtifPropertyArena arena;
+  BtifPropertyBuilder builder(&arena, 2);
+  uint32_t cod = 0x240404;
+  EXPECT_TRUE(builder.Add(BT_PROPERTY_CLASS_OF_DEVICE, &cod, sizeof(cod)));
+  cod = 0;
+  EXPECT_TRUE(builder.Add(BT_PROPERTY_BDNAME, "abc", 3));
+  EXPECT_FALSE(builder.Add(BT_PROPERTY_REMOTE_RSSI, "", 0));
+
+  ASSERT_EQ(builder.size(), 2);
+  EXPECT_EQ(*static_cast<uint32_t*>(builder.properties()[0].val), 0x240404u);
+  EXPECT_EQ(builder.properties()[1].len, 3);
+  EXPECT_EQ(memcmp(builder.properties()[1].val, "abc", 3), 0);
+}
+
+}  // namespace
@@ -17,6 +17,9 @@
  ******************************************************************************/
 
 #include <gtest/gtest.h>
+#include <stdio.h>
+
+#include <string>
 
 #include "btif/include/btif_storage.h"
 #include "btif/include/btif_util.h"
@@ -48,3 +51,47 @@ TEST(BtifStorageTest, test_uuid_split_partial) {
   size_t num_uuids = btif_split_uuids_string(s1, uuids, 1);
   EXPECT_EQ(num_uuids, 1u);
 }
+
+static std::string scanned_devices_dump() {
+  FILE* file = tmpfile();
+  btif_storage_scanned_devices_dump(fileno(file));
+  std::string dump;
+  char buffer[256];
+  rewind(file);
+  size_t size;
+  while ((size = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    dump.append(buffer, size);
+  }
+  fclose(file);
+  return dump;
+}
+
+TEST(BtifStorageTest, test_scanned_device_staging) {
+  RawAddress address;
+  RawAddress::FromString("11:22:33:44:55:66", address);
+
+  // Repeated reports of the same properties are not written again
+  btif_storage_stage_scanned_device(address, BT_DEVICE_DEVTYPE_BLE,
+                                    BLE_ADDR_RANDOM);
+  btif_storage_stage_scanned_device(address, BT_DEVICE_DEVTYPE_BLE,
+                                    BLE_ADDR_RANDOM);
+  btif_storage_stage_scanned_device(address, BT_DEVICE_DEVTYPE_BLE,
+                                    BLE_ADDR_RANDOM);
+  EXPECT_NE(scanned_devices_dump().find("Writes suppressed: 2"),
+            std::string::npos);
+
+  // Staged properties are written before they are read
+  int addr_type = -1;
+  EXPECT_EQ(btif_storage_get_remote_addr_type(&address, &addr_type),
+            BT_STATUS_SUCCESS);
+  EXPECT_EQ(addr_type, BLE_ADDR_RANDOM);
+
+  // A change is written right away
+  btif_storage_stage_scanned_device(address, BT_DEVICE_DEVTYPE_DUAL,
+                                    BLE_ADDR_PUBLIC);
+  EXPECT_EQ(btif_storage_get_remote_addr_type(&address, &addr_type),
+            BT_STATUS_SUCCESS);
+  EXPECT_EQ(addr_type, BLE_ADDR_PUBLIC);
+  EXPECT_NE(scanned_devices_dump().find("Writes suppressed: 2"),
+            std::string::npos);
+}
@@ -0,0 +1,108 @@
+/******************************************************************************
+ *
+ *  Copyright 2020 Google, Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional>
+
+#include "raw_address.h"
+
+namespace bluetooth {
+
+namespace common {
+
+/**
+ * Fixed-size memo of a value computed for a device, for the devices seen the
+ * most recently
+ *
+ * Each address maps to a single slot, which holds the last address put in it,
+ * so a lookup is one hash and one compare and a put never allocates. This is
+ * not thread safe: the owner serializes the calls with its own lock.
+ *
+ * @tparam V value, copied in and out of the memo
+ * @tparam kSize number of slots, a power of 2
+ */
+template <typename V, size_t kSize>
+class AddressMemo {
+  static_assert(kSize > 1 && (kSize & (kSize - 1)) == 0,
+                "the size of the memo must be a power of 2");
+
+ public:
+  /**
+   * Get the value memoized for |address|
+   *
+   * @return true if |value| was set
+   */
+  bool Get(const RawAddress& address, V* value) const {
+    const Slot& slot = slots_[SlotOf(address)];
+    if (!slot.valid || slot.address != address) {
+      return false;
+    }
+    *value = slot.value;
+    return true;
+  }
+
+  /**
+   * Memoize |value| for |address|, in place of the device held in its slot
+   */
+  void Put(const RawAddress& address, const V& value) {
+    Slot& slot = slots_[SlotOf(address)];
+    slot.address = address;
+    slot.value = value;
+    slot.valid = true;
+  }
+
+  /**
+   * Forget the value of |address|, if it is memoized
+   */
+  void Invalidate(const RawAddress& address) {
+    Slot& slot = slots_[SlotOf(address)];
+    if (slot.address == address) {
+      slot.valid = false;
+    }
+  }
+
+  /**
+   * Forget all the values
+   */
+  void Clear() {
+    for (Slot& slot : slots_) {
+      slot.valid = false;
+    }
+  }
+
+ private:
+  struct Slot {
+    RawAddress address;
+    V value{};
+    bool valid = false;
+  };
+
+  static size_t SlotOf(const RawAddress& address) {
+    // the hash of an address is the address itself, so spread it first
+    uint64_t hash = std::hash<RawAddress>{}(address);
+    return ((hash * 0x9E3779B97F4A7C15ULL) >> 32) & (kSize - 1);
+  }
+
+  std::array<Slot, kSize> slots_;
+};
+
+}  // namespace common
+}  // namespace bluetooth
@@ -36,6 +36,7 @@ bool AddressObfuscator::IsSaltValid(const Octet32& salt_256bit) {
 void AddressObfuscator::Initialize(const Octet32& salt_256bit) {
   std::lock_guard<std::recursive_mutex> lock(instance_mutex_);
   salt_256bit_ = salt_256bit;
+  obfuscated_memo_.Clear();
 }
 
 bool AddressObfuscator::IsInitialized() {
@@ -46,12 +47,19 @@ bool AddressObfuscator::IsInitialized() {
 std::string AddressObfuscator::Obfuscate(const RawAddress& address) {
   std::lock_guard<std::recursive_mutex> lock(instance_mutex_);
   CHECK(IsInitialized());
+  Octet32 memoized;
+  if (obfuscated_memo_.Get(address, &memoized)) {
+    return std::string(reinterpret_cast<const char*>(memoized.data()),
+                       memoized.size());
+  }
   std::array<uint8_t, EVP_MAX_MD_SIZE> result = {};
   unsigned int out_len = 0;
   CHECK(::HMAC(EVP_sha256(), salt_256bit_.data(), salt_256bit_.size(),
                address.address, address.kLength, result.data(),
                &out_len) != nullptr);
   CHECK_EQ(out_len, static_cast<unsigned int>(kOctet32Length));
+  std::copy_n(result.begin(), kOctet32Length, memoized.begin());
+  obfuscated_memo_.Put(address, memoized);
   return std::string(reinterpret_cast<const char*>(result.data()), out_len);
 }
 
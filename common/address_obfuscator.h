@@ -22,6 +22,7 @@
 #include <mutex>
 #include <string>
 
+#include "address_memo.h"
 #include "raw_address.h"
 
 namespace bluetooth {
@@ -69,6 +70,9 @@ class AddressObfuscator {
  private:
   AddressObfuscator() : salt_256bit_({0}) {}
   Octet32 salt_256bit_;
+  // Addresses obfuscated with the current salt, as the same devices are
+  // logged over and over
+  AddressMemo<Octet32, 16> obfuscated_memo_;
   std::recursive_mutex instance_mutex_;
 };
 
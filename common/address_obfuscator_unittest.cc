@@ -117,4 +117,17 @@ TEST(AddressObfuscatorTest, test_obfuscate_address_key2_max_address) {
       AddressObfuscator::GetInstance()->Obfuscate(kTestData2_3);
   EXPECT_EQ(result.size(), AddressObfuscator::kOctet32Length);
   EXPECT_EQ(result, kTestResult2_3);
-}
\ No newline at end of file
+}
+
+TEST(AddressObfuscatorTest, test_obfuscate_address_after_salt_change) {
+  AddressObfuscator::GetInstance()->Initialize(kTestKey2);
+  EXPECT_EQ(AddressObfuscator::GetInstance()->Obfuscate(kTestData2_1),
+            kTestResult2_1);
+  EXPECT_EQ(AddressObfuscator::GetInstance()->Obfuscate(kTestData2_1),
+            kTestResult2_1);
+  AddressObfuscator::GetInstance()->Initialize(kTestKey1);
+  EXPECT_NE(AddressObfuscator::GetInstance()->Obfuscate(kTestData2_1),
+            kTestResult2_1);
+  EXPECT_EQ(AddressObfuscator::GetInstance()->Obfuscate(kTestData1),
+            kTestResult1);
+}
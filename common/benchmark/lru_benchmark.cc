@@ -0,0 +1,107 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <string>
+
+#include "common/flat_lru.h"
+#include "common/lru.h"
+
+using ::benchmark::State;
+using bluetooth::common::FlatLruCache;
+using bluetooth::common::LruCache;
+using bluetooth::common::StripedLruCache;
+
+// Twice as many keys as the caches hold, so that half of the puts evict
+static constexpr int kCapacity = 1024;
+static constexpr int kKeys = 2 * kCapacity;
+
+template <typename Cache>
+static void PutGet(State& state, Cache& cache) {
+  int key = 0;
+  int value = 0;
+  for (auto _ : state) {
+    cache.Put(key, key);
+    benchmark::DoNotOptimize(cache.Get((key * 7) % kKeys, &value));
+    key = (key + 1) % kKeys;
+  }
+}
+
+static void BM_LruCachePutGet(State& state) {
+  LruCache<int, int> cache(kCapacity, "benchmark");
+  PutGet(state, cache);
+}
+BENCHMARK(BM_LruCachePutGet);
+
+static void BM_FlatLruCachePutGet(State& state) {
+  FlatLruCache<int, int> cache(kCapacity, "benchmark");
+  PutGet(state, cache);
+}
+BENCHMARK(BM_FlatLruCachePutGet);
+
+static void BM_LruCacheStringKeys(State& state) {
+  LruCache<std::string, int> cache(kCapacity, "benchmark");
+  int i = 0;
+  for (auto _ : state) {
+    cache.Put("00:11:22:33:" + std::to_string(i % kKeys), i);
+    i++;
+  }
+}
+BENCHMARK(BM_LruCacheStringKeys);
+
+static void BM_FlatLruCacheStringKeys(State& state) {
+  FlatLruCache<std::string, int> cache(kCapacity, "benchmark");
+  int i = 0;
+  for (auto _ : state) {
+    cache.Put("00:11:22:33:" + std::to_string(i % kKeys), i);
+    i++;
+  }
+}
+BENCHMARK(BM_FlatLruCacheStringKeys);
+
+// Shared by the threads of the contended benchmarks
+static LruCache<int, int> g_lru_cache(kCapacity, "benchmark");
+static FlatLruCache<int, int> g_flat_lru_cache(kCapacity, "benchmark");
+static StripedLruCache<int, int> g_striped_lru_cache(kCapacity, 16,
+                                                     "benchmark");
+
+template <typename Cache>
+static void ContendedPutGet(State& state, Cache& cache) {
+  int key = 0;
+  int value = 0;
+  for (auto _ : state) {
+    cache.Put(key % kKeys, key);
+    benchmark::DoNotOptimize(cache.Get((key * 7) % kKeys, &value));
+    key++;
+  }
+}
+
+static void BM_LruCacheContended(State& state) {
+  ContendedPutGet(state, g_lru_cache);
+}
+BENCHMARK(BM_LruCacheContended)->ThreadRange(1, 8);
+
+static void BM_FlatLruCacheContended(State& state) {
+  ContendedPutGet(state, g_flat_lru_cache);
+}
+BENCHMARK(BM_FlatLruCacheContended)->ThreadRange(1, 8);
+
+static void BM_StripedLruCacheContended(State& state) {
+  ContendedPutGet(state, g_striped_lru_cache);
+}
+BENCHMARK(BM_StripedLruCacheContended)->ThreadRange(1, 8);
+
+BENCHMARK_MAIN();
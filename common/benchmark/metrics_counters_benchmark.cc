@@ -0,0 +1,69 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <mutex>
+
+#include "common/metrics.h"
+#include "common/metrics_counters.h"
+
+using ::benchmark::State;
+using bluetooth::common::BluetoothMetricsLogger;
+using bluetooth::common::MetricsCounter;
+using bluetooth::common::MetricsHistogram;
+
+static MetricsCounter g_counter;
+static MetricsHistogram<8> g_histogram({1, 2, 5, 10, 20, 50, 100});
+
+// The cost of a counter guarded by a lock, for comparison
+static std::mutex g_locked_counter_mutex;
+static int64_t g_locked_counter = 0;
+
+static void BM_MetricsCounterAdd(State& state) {
+  for (auto _ : state) g_counter.Add();
+}
+BENCHMARK(BM_MetricsCounterAdd)->ThreadRange(1, 8);
+
+static void BM_LockedCounterAdd(State& state) {
+  for (auto _ : state) {
+    std::lock_guard<std::mutex> lock(g_locked_counter_mutex);
+    g_locked_counter++;
+  }
+}
+BENCHMARK(BM_LockedCounterAdd)->ThreadRange(1, 8);
+
+static void BM_MetricsHistogramRecord(State& state) {
+  int64_t value = 0;
+  for (auto _ : state) g_histogram.Record(value++ & 127);
+}
+BENCHMARK(BM_MetricsHistogramRecord)->ThreadRange(1, 8);
+
+static void BM_MetricsHistogramTake(State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(g_histogram.Take());
+  }
+}
+BENCHMARK(BM_MetricsHistogramTake);
+
+static void BM_LogWakeEvent(State& state) {
+  for (auto _ : state) {
+    BluetoothMetricsLogger::GetInstance()->LogWakeEvent(
+        bluetooth::common::WAKE_EVENT_ACQUIRED, "", "", 0);
+  }
+}
+BENCHMARK(BM_LogWakeEvent)->ThreadRange(1, 8);
+
+BENCHMARK_MAIN();
@@ -19,12 +19,19 @@
 #include <base/run_loop.h>
 #include <base/threading/thread.h>
 #include <benchmark/benchmark.h>
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
 #include <future>
 #include <memory>
+#include <mutex>
 #include <thread>
+#include <utility>
+#include <vector>
 
 #include "common/message_loop_thread.h"
 #include "osi/include/fixed_queue.h"
+#include "osi/include/mpmc_queue.h"
 #include "osi/include/thread.h"
 
 using ::benchmark::State;
@@ -320,6 +327,101 @@ BENCHMARK_F(BM_OsiReactorThread, sequential_execution_using_reactor)
   }
 };
 
+BENCHMARK_F(BM_OsiReactorThread, batch_enque_dequeue_using_thread_post_batch)
+(State& state) {
+  constexpr int kBatchSize = 64;
+  std::vector<void*> contexts(kBatchSize, bt_msg_queue_);
+  for (auto _ : state) {
+    g_counter = 0;
+    g_counter_promise = std::make_unique<std::promise<void>>();
+    std::future<void> counter_future = g_counter_promise->get_future();
+    for (int i = 0; i < NUM_MESSAGES_TO_SEND; i += kBatchSize) {
+      int count = std::min(kBatchSize, NUM_MESSAGES_TO_SEND - i);
+      for (int j = 0; j < count; j++) {
+        fixed_queue_enqueue(bt_msg_queue_, (void*)&g_counter);
+      }
+      thread_post_batch(thread_, pthread_callback_batch, contexts.data(),
+                        count);
+    }
+    counter_future.wait();
+  }
+};
+
+// A bare pthread running the posted functions off a locked deque, as the
+// baseline for the cost of the osi thread and its reactor
+class BM_PosixThread : public BM_ThreadPerformance {
+ public:
+  static void* RunPThread(void* context) {
+    auto test = static_cast<BM_PosixThread*>(context);
+    std::unique_lock<std::mutex> lock(test->mutex_);
+    while (true) {
+      test->cv_.wait(lock,
+                     [test] { return test->stop_ || !test->work_.empty(); });
+      if (test->work_.empty()) return nullptr;
+      auto work = test->work_.front();
+      test->work_.pop_front();
+      lock.unlock();
+      work.first(work.second);
+      lock.lock();
+    }
+  }
+
+  void Post(thread_fn func, void* context) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      work_.emplace_back(func, context);
+    }
+    cv_.notify_one();
+  }
+
+ protected:
+  void SetUp(State& st) override {
+    BM_ThreadPerformance::SetUp(st);
+    stop_ = false;
+    pthread_create(&thread_, nullptr, &BM_PosixThread::RunPThread, this);
+  }
+
+  void TearDown(State& st) override {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    cv_.notify_one();
+    pthread_join(thread_, nullptr);
+    BM_ThreadPerformance::TearDown(st);
+  }
+
+  pthread_t thread_ = -1;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<std::pair<thread_fn, void*>> work_;
+  bool stop_ = false;
+};
+
+BENCHMARK_F(BM_PosixThread, batch_enque_dequeue)(State& state) {
+  for (auto _ : state) {
+    g_counter = 0;
+    g_counter_promise = std::make_unique<std::promise<void>>();
+    std::future<void> counter_future = g_counter_promise->get_future();
+    for (int i = 0; i < NUM_MESSAGES_TO_SEND; i++) {
+      fixed_queue_enqueue(bt_msg_queue_, (void*)&g_counter);
+      Post(pthread_callback_batch, bt_msg_queue_);
+    }
+    counter_future.wait();
+  }
+};
+
+BENCHMARK_F(BM_PosixThread, sequential_execution)(State& state) {
+  for (auto _ : state) {
+    for (int i = 0; i < NUM_MESSAGES_TO_SEND; i++) {
+      g_counter_promise = std::make_unique<std::promise<void>>();
+      std::future<void> counter_future = g_counter_promise->get_future();
+      Post(callback_sequential, nullptr);
+      counter_future.wait();
+    }
+  }
+};
+
 class BM_MessageLooopThread : public BM_ThreadPerformance {
  protected:
   void SetUp(State& st) override {
@@ -370,6 +472,43 @@ BENCHMARK_F(BM_MessageLooopThread, sequential_execution)(State& state) {
   }
 };
 
+// The same as BM_MessageLooopThread, with the task statistics collected
+class BM_MessageLooopThreadWithTaskStats : public BM_MessageLooopThread {
+ protected:
+  void SetUp(State& st) override {
+    BM_MessageLooopThread::SetUp(st);
+    message_loop_thread_->EnableTaskStats(true);
+  }
+};
+
+BENCHMARK_F(BM_MessageLooopThreadWithTaskStats, batch_enque_dequeue)
+(State& state) {
+  for (auto _ : state) {
+    g_counter = 0;
+    g_counter_promise = std::make_unique<std::promise<void>>();
+    std::future<void> counter_future = g_counter_promise->get_future();
+    for (int i = 0; i < NUM_MESSAGES_TO_SEND; i++) {
+      fixed_queue_enqueue(bt_msg_queue_, (void*)&g_counter);
+      message_loop_thread_->DoInThread(
+          FROM_HERE, base::BindOnce(&callback_batch, bt_msg_queue_, nullptr));
+    }
+    counter_future.wait();
+  }
+};
+
+BENCHMARK_F(BM_MessageLooopThreadWithTaskStats, sequential_execution)
+(State& state) {
+  for (auto _ : state) {
+    for (int i = 0; i < NUM_MESSAGES_TO_SEND; i++) {
+      g_counter_promise = std::make_unique<std::promise<void>>();
+      std::future<void> counter_future = g_counter_promise->get_future();
+      message_loop_thread_->DoInThread(
+          FROM_HERE, base::BindOnce(&callback_sequential, nullptr));
+      counter_future.wait();
+    }
+  }
+};
+
 class BM_LibChromeThread : public BM_ThreadPerformance {
  protected:
   void SetUp(State& st) override {
@@ -419,6 +558,38 @@ BENCHMARK_F(BM_LibChromeThread, sequential_execution)(State& state) {
   }
 };
 
+// Hand off NUM_MESSAGES_TO_SEND elements to a consumer thread blocked in
+// dequeue, through a bounded queue as used by the audio data paths
+#define HANDOFF_QUEUE_CAPACITY 128
+
+BENCHMARK_F(BM_ThreadPerformance, fixed_queue_handoff)(State& state) {
+  fixed_queue_t* queue = fixed_queue_new(HANDOFF_QUEUE_CAPACITY);
+  for (auto _ : state) {
+    std::thread consumer([queue]() {
+      for (int i = 0; i < NUM_MESSAGES_TO_SEND; i++) fixed_queue_dequeue(queue);
+    });
+    for (int i = 0; i < NUM_MESSAGES_TO_SEND; i++) {
+      fixed_queue_enqueue(queue, (void*)&g_counter);
+    }
+    consumer.join();
+  }
+  fixed_queue_free(queue, nullptr);
+};
+
+BENCHMARK_F(BM_ThreadPerformance, mpmc_queue_handoff)(State& state) {
+  mpmc_queue_t* queue = mpmc_queue_new(HANDOFF_QUEUE_CAPACITY);
+  for (auto _ : state) {
+    std::thread consumer([queue]() {
+      for (int i = 0; i < NUM_MESSAGES_TO_SEND; i++) mpmc_queue_dequeue(queue);
+    });
+    for (int i = 0; i < NUM_MESSAGES_TO_SEND; i++) {
+      mpmc_queue_enqueue(queue, (void*)&g_counter);
+    }
+    consumer.join();
+  }
+  mpmc_queue_free(queue, nullptr);
+};
+
 int main(int argc, char** argv) {
   // Disable LOG() output from libchrome
   logging::LoggingSettings log_settings;
@@ -0,0 +1,415 @@
+/******************************************************************************
+ *
+ *  Copyright 2020 Google, Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <base/logging.h>
+
+namespace bluetooth {
+
+namespace common {
+
+/**
+ * LRU cache with the interface of LruCache, without an allocation per entry
+ *
+ * The entries live in slabs of fixed size, linked in LRU order by index, and
+ * are found through an open addressing table of indices with linear probing.
+ * Slabs are allocated as the cache fills up and kept until it is destroyed,
+ * and the table only grows until it fits the capacity, so a cache that has
+ * been full once no longer allocates. Keys and values must be default
+ * constructible; a removed entry is reset to a default constructed one.
+ */
+template <typename K, typename V, typename Hash = std::hash<K>>
+class FlatLruCache {
+ public:
+  using Node = std::pair<K, V>;
+  /**
+   * Constructor of the cache
+   *
+   * @param capacity maximum size of the cache
+   * @param log_tag, keyword to put at the head of log.
+   */
+  FlatLruCache(const size_t& capacity, const std::string& log_tag)
+      : capacity_(capacity),
+        slab_size_(std::min(capacity, kMaxSlabSize)),
+        table_(kMinTableSize, kNone) {
+    if (capacity_ == 0 || capacity_ >= kNone) {
+      // don't allow invalid capacity
+      LOG(FATAL) << log_tag << " unable to have " << capacity_
+                 << " LRU Cache capacity";
+    }
+  }
+
+  // delete copy constructor
+  FlatLruCache(FlatLruCache const&) = delete;
+  FlatLruCache& operator=(FlatLruCache const&) = delete;
+
+  /**
+   * Clear the cache, keeping the memory of the entries
+   */
+  void Clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    while (head_ != kNone) {
+      uint32_t index = head_;
+      Unlink(index);
+      ReleaseSlot(index);
+    }
+    std::fill(table_.begin(), table_.end(), kNone);
+    size_ = 0;
+  }
+
+  /**
+   * Same as Get, but return a pointer to the accessed element
+   *
+   * @param key
+   * @return pointer to the underlying value to allow in-place modification
+   * nullptr when not found, will be invalidated when the key is evicted
+   */
+  V* Find(const K& key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return FindLocked(key);
+  }
+
+  /**
+   * Get the value of a key, and move the key to the head of cache, if there is
+   * one
+   *
+   * @param key
+   * @param value, output parameter of value of the key
+   * @return true if the cache has the key
+   */
+  bool Get(const K& key, V* value) {
+    CHECK(value != nullptr);
+    std::lock_guard<std::mutex> lock(mutex_);
+    V* value_ptr = FindLocked(key);
+    if (value_ptr == nullptr) {
+      return false;
+    }
+    *value = *value_ptr;
+    return true;
+  }
+
+  /**
+   * Check if the cache has the input key, move the key to the head
+   * if there is one
+   *
+   * @param key
+   * @return true if the cache has the key
+   */
+  bool HasKey(const K& key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return FindLocked(key) != nullptr;
+  }
+
+  /**
+   * Put a key-value pair to the head of cache
+   *
+   * @param key
+   * @param value
+   * @return evicted node if tail value is popped, std::nullopt if no value
+   * is popped. std::optional can be treated as a boolean as well
+   */
+  std::optional<Node> Put(const K& key, V value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t hash = hasher_(key);
+    size_t pos = Lookup(key, hash);
+    if (pos != kNotFound) {
+      uint32_t index = table_[pos];
+      Unlink(index);
+      LinkFront(index);
+      At(index).value = std::move(value);
+      return std::nullopt;
+    }
+
+    // reuse the tail when full
+    std::optional<Node> ret = std::nullopt;
+    uint32_t index;
+    if (size_ == capacity_) {
+      index = tail_;
+      Slot& tail = At(index);
+      Erase(Lookup(tail.key, tail.hash));
+      Unlink(index);
+      ret.emplace(std::move(tail.key), std::move(tail.value));
+      size_--;
+    } else {
+      index = AllocateSlot();
+    }
+
+    // the table is kept at most half full
+    if ((size_ + 1) * 2 > table_.size()) {
+      Rehash(table_.size() * 2, table_bits_ + 1);
+    }
+    Slot& slot = At(index);
+    slot.key = key;
+    slot.value = std::move(value);
+    slot.hash = hash;
+    LinkFront(index);
+    Insert(index);
+    size_++;
+    return ret;
+  }
+
+  /**
+   * Delete a key from cache
+   *
+   * @param key
+   * @return true if deleted successfully
+   */
+  bool Remove(const K& key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t pos = Lookup(key, hasher_(key));
+    if (pos == kNotFound) {
+      return false;
+    }
+    uint32_t index = table_[pos];
+    Erase(pos);
+    Unlink(index);
+    ReleaseSlot(index);
+    size_--;
+    return true;
+  }
+
+  /**
+   * Return size of the cache
+   *
+   * @return size of the cache
+   */
+  int Size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return size_;
+  }
+
+ private:
+  static constexpr uint32_t kNone = UINT32_MAX;
+  static constexpr size_t kNotFound = SIZE_MAX;
+  static constexpr size_t kMaxSlabSize = 64;
+  static constexpr size_t kMinTableSize = 8;
+
+  struct Slot {
+    K key;
+    V value;
+    size_t hash;
+    // neighbours in LRU order when used, next free slot otherwise
+    uint32_t prev;
+    uint32_t next;
+  };
+
+  Slot& At(uint32_t index) const {
+    return slabs_[index / slab_size_][index % slab_size_];
+  }
+
+  // Fibonacci hashing, so that the identity hash of integers spreads over the
+  // table too
+  size_t Home(size_t hash) const {
+    return (static_cast<uint64_t>(hash) * 0x9E3779B97F4A7C15ULL) >>
+           (64 - table_bits_);
+  }
+
+  size_t Next(size_t pos) const { return (pos + 1) & (table_.size() - 1); }
+
+  // Returns the position of |key| in the table, or kNotFound
+  size_t Lookup(const K& key, size_t hash) const {
+    for (size_t pos = Home(hash);; pos = Next(pos)) {
+      uint32_t index = table_[pos];
+      if (index == kNone) return kNotFound;
+      const Slot& slot = At(index);
+      if (slot.hash == hash && slot.key == key) return pos;
+    }
+  }
+
+  V* FindLocked(const K& key) {
+    size_t pos = Lookup(key, hasher_(key));
+    if (pos == kNotFound) {
+      return nullptr;
+    }
+    uint32_t index = table_[pos];
+    Unlink(index);
+    LinkFront(index);
+    return &At(index).value;
+  }
+
+  void Insert(uint32_t index) {
+    size_t pos = Home(At(index).hash);
+    while (table_[pos] != kNone) pos = Next(pos);
+    table_[pos] = index;
+  }
+
+  // Empties the table at |pos|, moving back the entries probed past it so
+  // that no tombstone is needed
+  void Erase(size_t pos) {
+    size_t hole = pos;
+    for (size_t next = Next(pos); table_[next] != kNone; next = Next(next)) {
+      size_t home = Home(At(table_[next]).hash);
+      size_t mask = table_.size() - 1;
+      if (((next - home) & mask) >= ((next - hole) & mask)) {
+        table_[hole] = table_[next];
+        hole = next;
+      }
+    }
+    table_[hole] = kNone;
+  }
+
+  void Rehash(size_t table_size, size_t table_bits) {
+    table_.assign(table_size, kNone);
+    table_bits_ = table_bits;
+    for (uint32_t index = head_; index != kNone; index = At(index).next) {
+      Insert(index);
+    }
+  }
+
+  void LinkFront(uint32_t index) {
+    Slot& slot = At(index);
+    slot.prev = kNone;
+    slot.next = head_;
+    if (head_ != kNone) At(head_).prev = index;
+    head_ = index;
+    if (tail_ == kNone) tail_ = index;
+  }
+
+  void Unlink(uint32_t index) {
+    Slot& slot = At(index);
+    if (slot.prev != kNone) {
+      At(slot.prev).next = slot.next;
+    } else {
+      head_ = slot.next;
+    }
+    if (slot.next != kNone) {
+      At(slot.next).prev = slot.prev;
+    } else {
+      tail_ = slot.prev;
+    }
+  }
+
+  uint32_t AllocateSlot() {
+    if (free_ != kNone) {
+      uint32_t index = free_;
+      free_ = At(index).next;
+      return index;
+    }
+    if (allocated_ % slab_size_ == 0) {
+      slabs_.emplace_back(new Slot[slab_size_]);
+    }
+    return allocated_++;
+  }
+
+  void ReleaseSlot(uint32_t index) {
+    Slot& slot = At(index);
+    slot.key = K();
+    slot.value = V();
+    slot.next = free_;
+    free_ = index;
+  }
+
+  const size_t capacity_;
+  const size_t slab_size_;
+  Hash hasher_;
+  std::vector<std::unique_ptr<Slot[]>> slabs_;
+  uint32_t allocated_ = 0;
+  uint32_t free_ = kNone;
+  uint32_t head_ = kNone;
+  uint32_t tail_ = kNone;
+  size_t size_ = 0;
+  std::vector<uint32_t> table_;
+  size_t table_bits_ = 3;
+  mutable std::mutex mutex_;
+};
+
+/**
+ * FlatLruCache split into stripes of their own lock, for caches used from
+ * several threads at once
+ *
+ * A key always goes to the same stripe, picked by its hash, and the stripes
+ * evict independently: an entry is evicted once it is the least recently used
+ * of its stripe, not of the whole cache. Find is not offered, as the value can
+ * be evicted by another thread as soon as the lock of its stripe is released.
+ */
+template <typename K, typename V, typename Hash = std::hash<K>>
+class StripedLruCache {
+ public:
+  using Node = std::pair<K, V>;
+  /**
+   * Constructor of the cache
+   *
+   * @param capacity maximum size of the cache, split evenly between stripes
+   * @param num_stripes number of stripes
+   * @param log_tag, keyword to put at the head of log.
+   */
+  StripedLruCache(const size_t& capacity, const size_t& num_stripes,
+                  const std::string& log_tag) {
+    if (num_stripes == 0 || capacity < num_stripes) {
+      LOG(FATAL) << log_tag << " unable to split " << capacity
+                 << " LRU Cache capacity in " << num_stripes << " stripes";
+    }
+    for (size_t i = 0; i < num_stripes; i++) {
+      stripes_.emplace_back(std::make_unique<FlatLruCache<K, V, Hash>>(
+          (capacity + num_stripes - 1) / num_stripes, log_tag));
+    }
+  }
+
+  // delete copy constructor
+  StripedLruCache(StripedLruCache const&) = delete;
+  StripedLruCache& operator=(StripedLruCache const&) = delete;
+
+  void Clear() {
+    for (auto& stripe : stripes_) stripe->Clear();
+  }
+
+  bool Get(const K& key, V* value) { return StripeOf(key).Get(key, value); }
+
+  bool HasKey(const K& key) { return StripeOf(key).HasKey(key); }
+
+  /**
+   * @return node evicted from the stripe of |key|, std::nullopt if none
+   */
+  std::optional<Node> Put(const K& key, V value) {
+    return StripeOf(key).Put(key, std::move(value));
+  }
+
+  bool Remove(const K& key) { return StripeOf(key).Remove(key); }
+
+  int Size() const {
+    int size = 0;
+    for (const auto& stripe : stripes_) size += stripe->Size();
+    return size;
+  }
+
+ private:
+  FlatLruCache<K, V, Hash>& StripeOf(const K& key) {
+    // mixed with another multiplier than the one of the stripes, so that the
+    // keys of a stripe still spread over its table
+    uint64_t mixed =
+        static_cast<uint64_t>(hasher_(key)) * 0xC2B2AE3D27D4EB4FULL;
+    return *stripes_[(mixed >> 32) % stripes_.size()];
+  }
+
+  Hash hasher_;
+  std::vector<std::unique_ptr<FlatLruCache<K, V, Hash>>> stripes_;
+};
+
+}  // namespace common
+}  // namespace bluetooth
@@ -0,0 +1,138 @@
+/******************************************************************************
+ *
+ *  Copyright 2020 Google, Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/flat_lru.h"
+
+namespace testing {
+
+using bluetooth::common::FlatLruCache;
+using bluetooth::common::StripedLruCache;
+
+TEST(BluetoothFlatLruCacheTest, FlatLruCacheMainTest) {
+  int value = 0;
+  FlatLruCache<int, int> cache(3, "testing");  // capacity = 3;
+  EXPECT_FALSE(cache.Put(1, 10));
+  EXPECT_FALSE(cache.Put(2, 20));
+  EXPECT_FALSE(cache.Put(3, 30));
+  EXPECT_EQ(cache.Size(), 3);
+
+  // 1 is the least recently used
+  EXPECT_THAT(cache.Put(4, 40), Optional(Pair(1, 10)));
+  EXPECT_FALSE(cache.Get(1, &value));
+
+  // 2 is used again, so 3 goes next
+  EXPECT_TRUE(cache.Get(2, &value));
+  EXPECT_EQ(value, 20);
+  EXPECT_THAT(cache.Put(5, 50), Optional(Pair(3, 30)));
+
+  // updating a key does not evict
+  EXPECT_FALSE(cache.Put(4, 400));
+  EXPECT_TRUE(cache.Get(4, &value));
+  EXPECT_EQ(value, 400);
+  EXPECT_EQ(cache.Size(), 3);
+
+  EXPECT_TRUE(cache.Remove(2));
+  EXPECT_FALSE(cache.Remove(2));
+  EXPECT_FALSE(cache.Put(6, 60));
+  // 5, 4, 6 should be in cache
+  EXPECT_THAT(cache.Put(7, 70), Optional(Pair(5, 50)));
+}
+
+TEST(BluetoothFlatLruCacheTest, FlatLruCacheFindTest) {
+  FlatLruCache<std::string, std::string> cache(2, "testing");
+  cache.Put("a", "1");
+  std::string* value = cache.Find("a");
+  ASSERT_NE(value, nullptr);
+  *value = "2";
+  std::string copy;
+  EXPECT_TRUE(cache.Get("a", &copy));
+  EXPECT_EQ(copy, "2");
+  EXPECT_EQ(cache.Find("b"), nullptr);
+}
+
+TEST(BluetoothFlatLruCacheTest, FlatLruCacheClearTest) {
+  FlatLruCache<int, int> cache(10, "testing");
+  for (int key = 0; key < 10; key++) cache.Put(key, key);
+  cache.Clear();
+  EXPECT_EQ(cache.Size(), 0);
+  for (int key = 0; key < 10; key++) {
+    EXPECT_FALSE(cache.HasKey(key));
+    EXPECT_FALSE(cache.Put(key, key));
+  }
+  EXPECT_EQ(cache.Size(), 10);
+}
+
+// Removals in the middle of probe sequences must keep the others reachable
+TEST(BluetoothFlatLruCacheTest, FlatLruCacheChurnTest) {
+  const int capacity = 1000;
+  FlatLruCache<int, int> cache(capacity, "testing");
+  for (int round = 0; round < 10; round++) {
+    for (int key = 0; key < capacity; key++) {
+      cache.Put(round * capacity + key, key);
+    }
+    for (int key = 0; key < capacity; key += 3) {
+      EXPECT_TRUE(cache.Remove(round * capacity + key));
+    }
+    for (int key = 0; key < capacity; key++) {
+      EXPECT_EQ(cache.HasKey(round * capacity + key), key % 3 != 0);
+    }
+    EXPECT_EQ(cache.Size(), capacity - (capacity + 2) / 3);
+  }
+}
+
+TEST(BluetoothFlatLruCacheTest, StripedLruCacheTest) {
+  StripedLruCache<int, int> cache(64, 4, "testing");
+  for (int key = 0; key < 64; key++) cache.Put(key, key);
+  EXPECT_LE(cache.Size(), 64);
+  int value = 0;
+  EXPECT_TRUE(cache.Get(63, &value));
+  EXPECT_EQ(value, 63);
+  EXPECT_TRUE(cache.Remove(63));
+  EXPECT_FALSE(cache.HasKey(63));
+  cache.Clear();
+  EXPECT_EQ(cache.Size(), 0);
+}
+
+TEST(BluetoothFlatLruCacheTest, StripedLruMultiThreadPressureTest) {
+  StripedLruCache<int, int> cache(1000, 8, "testing");
+  auto pointer = &cache;
+  std::vector<std::thread> workers;
+  for (int worker = 0; worker < 8; worker++) {
+    workers.push_back(std::thread([worker, pointer]() {
+      for (int i = 0; i < 1000; i++) {
+        int key = worker * 1000 + i;
+        pointer->Put(key, key);
+        int value = 0;
+        if (pointer->Get(key, &value)) EXPECT_EQ(value, key);
+        pointer->Remove(key);
+      }
+    }));
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  EXPECT_EQ(cache.Size(), 0);
+}
+
+}  // namespace testing
@@ -16,18 +16,184 @@
 
 #include "message_loop_thread.h"
 
+#include <inttypes.h>
+#include <stdio.h>
 #include <sys/syscall.h>
 #include <unistd.h>
+#include <algorithm>
+#include <map>
+#include <mutex>
 #include <thread>
+#include <utility>
+#include <vector>
 
 #include <base/strings/stringprintf.h>
 
+#include "common/metrics_counters.h"
+#include "common/thread_scheduling.h"
+#include "common/time_util.h"
+
 namespace bluetooth {
 
 namespace common {
 
 static constexpr int kRealTimeFifoSchedulingPriority = 1;
 
+// Bucket bounds of the task delay and run time histograms, in microseconds
+static constexpr size_t kTaskHistogramBuckets = 8;
+using TaskHistogram = MetricsHistogram<kTaskHistogramBuckets>;
+static const TaskHistogram::Bounds kTaskHistogramBoundsUs = {
+    100, 500, 1000, 5000, 10000, 50000, 100000};
+
+// Number of posting locations dumped per thread, those with the most run time
+static constexpr size_t kMaxDumpedTaskLocations = 10;
+
+constexpr std::chrono::milliseconds
+    MessageLoopThread::kDefaultSlowTaskThreshold;
+
+struct MessageLoopTaskStats {
+  struct LocationStats {
+    std::string location;
+    uint64_t count = 0;
+    uint64_t total_run_us = 0;
+    uint64_t max_run_us = 0;
+    uint64_t max_delay_us = 0;
+  };
+
+  MessageLoopTaskStats(const std::string& thread_name,
+                       std::chrono::milliseconds slow_task_threshold)
+      : thread_name(thread_name),
+        slow_task_threshold_us(
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                slow_task_threshold)
+                .count()),
+        delay_us(kTaskHistogramBoundsUs),
+        run_us(kTaskHistogramBoundsUs) {}
+
+  void OnPosted() {
+    int64_t now_pending = pending.fetch_add(1, std::memory_order_relaxed) + 1;
+    int64_t most_pending = max_pending.load(std::memory_order_relaxed);
+    while (now_pending > most_pending &&
+           !max_pending.compare_exchange_weak(most_pending, now_pending,
+                                              std::memory_order_relaxed)) {
+    }
+  }
+
+  // Called on the thread itself, after each task ran
+  void OnRun(const base::Location& from_here, uint64_t task_delay_us,
+             uint64_t task_run_us) {
+    delay_us.Record(task_delay_us);
+    run_us.Record(task_run_us);
+    {
+      std::lock_guard<std::mutex> lock(locations_mutex);
+      LocationStats& stats =
+          locations[std::make_pair(from_here.file_name(),
+                                   from_here.line_number())];
+      if (stats.count == 0) stats.location = from_here.ToString();
+      stats.count++;
+      stats.total_run_us += task_run_us;
+      stats.max_run_us = std::max(stats.max_run_us, task_run_us);
+      stats.max_delay_us = std::max(stats.max_delay_us, task_delay_us);
+    }
+    if (task_run_us >= slow_task_threshold_us) {
+      LOG(WARNING) << __func__ << ": slow task on " << thread_name << " from "
+                   << from_here.ToString() << " ran for "
+                   << task_run_us / 1000 << " ms, after waiting "
+                   << task_delay_us / 1000 << " ms";
+    }
+  }
+
+  void Dump(int fd) {
+    dprintf(fd, "  Task statistics of %s:\n", thread_name.c_str());
+    dprintf(fd, "    Tasks pending now / at most: %" PRId64 " / %" PRId64 "\n",
+            pending.load(std::memory_order_relaxed),
+            max_pending.load(std::memory_order_relaxed));
+    DumpHistogram(fd, "Delay before running (us):", delay_us.GetSnapshot());
+    DumpHistogram(fd, "Run time (us):            ", run_us.GetSnapshot());
+
+    std::vector<LocationStats> sorted;
+    {
+      std::lock_guard<std::mutex> lock(locations_mutex);
+      for (const auto& entry : locations) sorted.push_back(entry.second);
+    }
+    std::sort(sorted.begin(), sorted.end(),
+              [](const LocationStats& a, const LocationStats& b) {
+                return a.total_run_us > b.total_run_us;
+              });
+    if (sorted.size() > kMaxDumpedTaskLocations) {
+      sorted.resize(kMaxDumpedTaskLocations);
+    }
+    dprintf(fd,
+            "    Posting locations with the most run time (count, total ms, "
+            "avg us, max us, max delay us):\n");
+    for (const LocationStats& stats : sorted) {
+      dprintf(fd,
+              "      %s %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64
+              " %" PRIu64 "\n",
+              stats.location.c_str(), stats.count, stats.total_run_us / 1000,
+              stats.total_run_us / stats.count, stats.max_run_us,
+              stats.max_delay_us);
+    }
+  }
+
+  static void DumpHistogram(int fd, const char* label,
+                            const TaskHistogram::Snapshot& snapshot) {
+    dprintf(fd, "    %s", label);
+    for (size_t i = 0; i < kTaskHistogramBuckets; i++) {
+      if (i < kTaskHistogramBuckets - 1) {
+        dprintf(fd, " <%" PRId64 ": %" PRId64, kTaskHistogramBoundsUs[i],
+                snapshot.counts[i]);
+      } else {
+        dprintf(fd, " >=%" PRId64 ": %" PRId64, kTaskHistogramBoundsUs[i - 1],
+                snapshot.counts[i]);
+      }
+    }
+    dprintf(fd, "\n");
+  }
+
+  const std::string thread_name;
+  const uint64_t slow_task_threshold_us;
+  std::atomic<int64_t> pending{0};
+  std::atomic<int64_t> max_pending{0};
+  TaskHistogram delay_us;
+  TaskHistogram run_us;
+  std::mutex locations_mutex;
+  std::map<std::pair<const char*, int>, LocationStats> locations;
+};
+
+// The task statistics being collected, of all threads. Never freed, as static
+// threads may be destroyed after it otherwise.
+static std::mutex& task_stats_registry_mutex() {
+  static std::mutex* mutex = new std::mutex();
+  return *mutex;
+}
+
+static std::vector<std::shared_ptr<MessageLoopTaskStats>>&
+task_stats_registry() {
+  static auto* registry =
+      new std::vector<std::shared_ptr<MessageLoopTaskStats>>();
+  return *registry;
+}
+
+static void task_stats_unregister(
+    const std::shared_ptr<MessageLoopTaskStats>& stats) {
+  std::lock_guard<std::mutex> lock(task_stats_registry_mutex());
+  auto& registry = task_stats_registry();
+  registry.erase(std::remove(registry.begin(), registry.end(), stats),
+                 registry.end());
+}
+
+static void run_task_with_stats(std::shared_ptr<MessageLoopTaskStats> stats,
+                                const base::Location& from_here,
+                                uint64_t due_us, base::OnceClosure task) {
+  uint64_t start_us = time_get_os_boottime_us();
+  stats->pending.fetch_sub(1, std::memory_order_relaxed);
+  std::move(task).Run();
+  uint64_t end_us = time_get_os_boottime_us();
+  stats->OnRun(from_here, start_us > due_us ? start_us - due_us : 0,
+               end_us - start_us);
+}
+
 MessageLoopThread::MessageLoopThread(const std::string& thread_name)
     : thread_name_(thread_name),
       message_loop_(nullptr),
@@ -38,7 +204,10 @@ MessageLoopThread::MessageLoopThread(const std::string& thread_name)
       weak_ptr_factory_(this),
       shutting_down_(false) {}
 
-MessageLoopThread::~MessageLoopThread() { ShutDown(); }
+MessageLoopThread::~MessageLoopThread() {
+  ShutDown();
+  if (task_stats_ != nullptr) task_stats_unregister(task_stats_);
+}
 
 void MessageLoopThread::StartUp() {
   std::promise<void> start_up_promise;
@@ -70,11 +239,20 @@ bool MessageLoopThread::DoInThreadDelayed(const base::Location& from_here,
                << ", from " << from_here.ToString();
     return false;
   }
+  if (task_stats_ != nullptr) {
+    uint64_t due_us = time_get_os_boottime_us() + delay.InMicroseconds();
+    task = base::BindOnce(&run_task_with_stats, task_stats_, from_here, due_us,
+                          std::move(task));
+    task_stats_->OnPosted();
+  }
   if (!message_loop_->task_runner()->PostDelayedTask(from_here, std::move(task),
                                                      delay)) {
     LOG(ERROR) << __func__
                << ": failed to post task to message loop for thread " << *this
                << ", from " << from_here.ToString();
+    if (task_stats_ != nullptr) {
+      task_stats_->pending.fetch_sub(1, std::memory_order_relaxed);
+    }
     return false;
   }
   return true;
@@ -151,6 +329,10 @@ bool MessageLoopThread::EnableRealTimeScheduling() {
     LOG(ERROR) << __func__ << ": thread " << *this << " is not running";
     return false;
   }
+  // A configured profile takes precedence over the default real-time policy
+  if (HasThreadSchedulingProfile(thread_name_)) {
+    return ApplyThreadSchedulingProfile(thread_name_, linux_tid_);
+  }
   struct sched_param rt_params = {.sched_priority =
                                       kRealTimeFifoSchedulingPriority};
   int rc = sched_setscheduler(linux_tid_, SCHED_FIFO, &rt_params);
@@ -164,6 +346,31 @@ bool MessageLoopThread::EnableRealTimeScheduling() {
   return true;
 }
 
+void MessageLoopThread::EnableTaskStats(
+    bool enable, std::chrono::milliseconds slow_task_threshold) {
+  std::lock_guard<std::recursive_mutex> api_lock(api_mutex_);
+  if (task_stats_ != nullptr) {
+    task_stats_unregister(task_stats_);
+    task_stats_ = nullptr;
+  }
+  if (!enable) return;
+  task_stats_ = std::make_shared<MessageLoopTaskStats>(thread_name_,
+                                                       slow_task_threshold);
+  std::lock_guard<std::mutex> lock(task_stats_registry_mutex());
+  task_stats_registry().push_back(task_stats_);
+}
+
+void MessageLoopThread::DebugDump(int fd) {
+  std::vector<std::shared_ptr<MessageLoopTaskStats>> registry;
+  {
+    std::lock_guard<std::mutex> lock(task_stats_registry_mutex());
+    registry = task_stats_registry();
+  }
+  if (registry.empty()) return;
+  dprintf(fd, "\nMessage loop threads:\n");
+  for (const auto& stats : registry) stats->Dump(fd);
+}
+
 base::WeakPtr<MessageLoopThread> MessageLoopThread::GetWeakPtr() {
   std::lock_guard<std::recursive_mutex> api_lock(api_mutex_);
   return weak_ptr_factory_.GetWeakPtr();
@@ -179,6 +386,7 @@ void MessageLoopThread::Run(std::promise<void> start_up_promise) {
     run_loop_ = new base::RunLoop();
     thread_id_ = base::PlatformThread::CurrentId();
     linux_tid_ = static_cast<pid_t>(syscall(SYS_gettid));
+    ApplyThreadSchedulingProfile(thread_name_, linux_tid_);
     start_up_promise.set_value();
   }
 
@@ -193,6 +401,10 @@ void MessageLoopThread::Run(std::promise<void> start_up_promise) {
     message_loop_ = nullptr;
     delete run_loop_;
     run_loop_ = nullptr;
+    // The delayed tasks still pending were dropped with the message loop
+    if (task_stats_ != nullptr) {
+      task_stats_->pending.store(0, std::memory_order_relaxed);
+    }
     LOG(INFO) << __func__ << ": message loop finished for thread "
               << thread_name_;
   }
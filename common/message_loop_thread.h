@@ -17,6 +17,7 @@
 #pragma once
 
 #include <unistd.h>
+#include <chrono>
 #include <future>
 #include <memory>
 #include <string>
@@ -32,6 +33,8 @@ namespace bluetooth {
 
 namespace common {
 
+struct MessageLoopTaskStats;
+
 /**
  * An interface to various thread related functionality
  */
@@ -135,6 +138,32 @@ class MessageLoopThread final {
    */
   base::MessageLoop* message_loop() const;
 
+  /**
+   * Tasks running longer than this are logged when task statistics are enabled
+   */
+  static constexpr std::chrono::milliseconds kDefaultSlowTaskThreshold =
+      std::chrono::milliseconds(100);
+
+  /**
+   * Start or stop collecting statistics of the tasks posted through
+   * DoInThread(): how long they wait before running and how long they run,
+   * per posting location, and the most tasks pending at once. Tasks posted
+   * while this is disabled are not accounted for.
+   *
+   * @param enable true to collect task statistics, false to discard them
+   * @param slow_task_threshold tasks running at least this long are logged
+   */
+  void EnableTaskStats(
+      bool enable,
+      std::chrono::milliseconds slow_task_threshold = kDefaultSlowTaskThreshold);
+
+  /**
+   * Dump the task statistics of every thread collecting them
+   *
+   * @param fd file descriptor to write to
+   */
+  static void DebugDump(int fd);
+
  private:
   /**
    * Static method to run the thread
@@ -197,6 +226,8 @@ class MessageLoopThread final {
   pid_t linux_tid_;
   base::WeakPtrFactory<MessageLoopThread> weak_ptr_factory_;
   bool shutting_down_;
+  // Shared with the tasks in flight, which may outlive this thread
+  std::shared_ptr<MessageLoopTaskStats> task_stats_;
 
   DISALLOW_COPY_AND_ASSIGN(MessageLoopThread);
 };
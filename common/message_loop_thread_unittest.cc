@@ -328,3 +328,59 @@ TEST_F(MessageLoopThreadTest, shut_down_start_up_multi_thread) {
   auto thread = std::thread(&MessageLoopThread::StartUp, &message_loop_thread);
   thread.join();
 }
+
+static std::string DumpTaskStats() {
+  FILE* file = tmpfile();
+  MessageLoopThread::DebugDump(fileno(file));
+  std::string dump;
+  char buffer[1024];
+  rewind(file);
+  size_t size;
+  while ((size = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    dump.append(buffer, size);
+  }
+  fclose(file);
+  return dump;
+}
+
+// Verify the tasks of a thread with task statistics are accounted for
+TEST_F(MessageLoopThreadTest, task_stats_count_tasks_by_location) {
+  std::string name = "stats_thread";
+  MessageLoopThread message_loop_thread(name);
+  message_loop_thread.StartUp();
+  message_loop_thread.EnableTaskStats(true, std::chrono::milliseconds(1));
+  for (int i = 0; i < 3; i++) {
+    std::promise<std::string> name_promise;
+    std::future<std::string> name_future = name_promise.get_future();
+    message_loop_thread.DoInThread(
+        FROM_HERE,
+        base::BindOnce(&MessageLoopThreadTest::SleepAndGetName,
+                       base::Unretained(this), std::move(name_promise), 2));
+    ASSERT_EQ(name_future.get(), name);
+  }
+  message_loop_thread.ShutDown();
+
+  std::string dump = DumpTaskStats();
+  ASSERT_NE(dump.find("Task statistics of " + name), std::string::npos);
+  ASSERT_NE(dump.find("message_loop_thread_unittest.cc"), std::string::npos);
+  // The three tasks were posted from the same place, and each ran for at least
+  // 2 ms
+  std::string location_prefix = "message_loop_thread_unittest.cc:";
+  size_t location = dump.find(location_prefix);
+  size_t count = dump.find(' ', location + location_prefix.size());
+  ASSERT_EQ(dump.compare(count, 3, " 3 "), 0) << dump;
+  ASSERT_EQ(dump.find(location_prefix, count), std::string::npos);
+}
+
+// Verify only the threads with task statistics enabled are dumped
+TEST_F(MessageLoopThreadTest, task_stats_disabled) {
+  std::string name = "no_stats_thread";
+  MessageLoopThread message_loop_thread(name);
+  message_loop_thread.StartUp();
+  ASSERT_EQ(DumpTaskStats().find(name), std::string::npos);
+  message_loop_thread.EnableTaskStats(true);
+  ASSERT_NE(DumpTaskStats().find(name), std::string::npos);
+  message_loop_thread.EnableTaskStats(false);
+  ASSERT_EQ(DumpTaskStats().find(name), std::string::npos);
+  message_loop_thread.ShutDown();
+}
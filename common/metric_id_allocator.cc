@@ -94,6 +94,7 @@ bool MetricIdAllocator::Close() {
   }
   paired_device_cache_.Clear();
   temporary_device_cache_.Clear();
+  id_memo_.Clear();
   id_set_.clear();
   initialized_ = false;
   return true;
@@ -115,10 +116,12 @@ int MetricIdAllocator::AllocateId(const RawAddress& mac_address) {
   std::lock_guard<std::mutex> lock(id_allocator_mutex_);
   int id = 0;
   // if already have an id, return it
-  if (paired_device_cache_.Get(mac_address, &id)) {
+  if (id_memo_.Get(mac_address, &id)) {
     return id;
   }
-  if (temporary_device_cache_.Get(mac_address, &id)) {
+  if (paired_device_cache_.Get(mac_address, &id) ||
+      temporary_device_cache_.Get(mac_address, &id)) {
+    id_memo_.Put(mac_address, id);
     return id;
   }
 
@@ -134,8 +137,10 @@ int MetricIdAllocator::AllocateId(const RawAddress& mac_address) {
   id_set_.insert(id);
   auto evicted = temporary_device_cache_.Put(mac_address, id);
   if (evicted) {
+    id_memo_.Invalidate(evicted->first);
     this->id_set_.erase(evicted->second);
   }
+  id_memo_.Put(mac_address, id);
 
   if (next_id_ > kMaxId) {
     next_id_ = kMinId;
@@ -197,6 +202,7 @@ bool MetricIdAllocator::IsValidId(const int id) {
 
 void MetricIdAllocator::ForgetDevicePostprocess(const RawAddress& mac_address,
                                                 const int id) {
+  id_memo_.Invalidate(mac_address);
   id_set_.erase(id);
   forget_device_callback_(mac_address, id);
 }
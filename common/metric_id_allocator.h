@@ -24,7 +24,8 @@
 #include <unordered_set>
 #include "raw_address.h"
 
-#include "lru.h"
+#include "address_memo.h"
+#include "flat_lru.h"
 
 namespace bluetooth {
 
@@ -119,8 +120,12 @@ class MetricIdAllocator {
   static const std::string LOGGING_TAG;
   mutable std::mutex id_allocator_mutex_;
 
-  LruCache<RawAddress, int> paired_device_cache_;
-  LruCache<RawAddress, int> temporary_device_cache_;
+  FlatLruCache<RawAddress, int> paired_device_cache_;
+  FlatLruCache<RawAddress, int> temporary_device_cache_;
+  // Ids of the devices looked up the most recently, in either cache. A hit
+  // does not refresh the device in its cache, but a device only stays in the
+  // memo while few others are looked up, far fewer than the caches hold.
+  AddressMemo<int, 16> id_memo_;
   std::unordered_set<int> id_set_;
 
   int next_id_{kMinId};
@@ -127,6 +127,26 @@ TEST(BluetoothMetricIdAllocatorTest, MetricIdAllocatorAllocateExistingTest) {
   EXPECT_TRUE(allocator.Close());
 }
 
+TEST(BluetoothMetricIdAllocatorTest, MetricIdAllocatorForgetMemoizedTest) {
+  auto& allocator = MetricIdAllocator::GetInstance();
+  std::unordered_map<RawAddress, int> paired_device_map;
+  MetricIdAllocator::Callback callback = [](const RawAddress&, const int) {
+    return true;
+  };
+  EXPECT_TRUE(allocator.Init(paired_device_map, callback, callback));
+
+  RawAddress address({0, 0, 0, 0, 0, 1});
+  int id = allocator.AllocateId(address);
+  EXPECT_EQ(allocator.AllocateId(address), id);
+  EXPECT_TRUE(allocator.SaveDevice(address));
+  EXPECT_EQ(allocator.AllocateId(address), id);
+
+  // the id of a forgotten device is not handed out from memory again
+  allocator.ForgetDevice(address);
+  EXPECT_NE(allocator.AllocateId(address), id);
+  EXPECT_TRUE(allocator.Close());
+}
+
 TEST(BluetoothMetricIdAllocatorTest, MetricIdAllocatorMainTest1) {
   auto& allocator = MetricIdAllocator::GetInstance();
   std::unordered_map<RawAddress, int> paired_device_map;
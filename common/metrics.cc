@@ -25,6 +25,8 @@
 #include <cstring>
 #include <memory>
 #include <mutex>
+#include <string>
+#include <vector>
 
 #include <base/base64.h>
 #include <base/logging.h>
@@ -39,6 +41,7 @@
 #include "leaky_bonded_queue.h"
 #include "metric_id_allocator.h"
 #include "metrics.h"
+#include "metrics_counters.h"
 #include "time_util.h"
 
 namespace bluetooth {
@@ -61,6 +64,7 @@ using bluetooth::metrics::BluetoothMetricsProto::HeadsetProfileType_ARRAYSIZE;
 using bluetooth::metrics::BluetoothMetricsProto::HeadsetProfileType_IsValid;
 using bluetooth::metrics::BluetoothMetricsProto::HeadsetProfileType_MAX;
 using bluetooth::metrics::BluetoothMetricsProto::HeadsetProfileType_MIN;
+using bluetooth::metrics::BluetoothMetricsProto::L2capChannelStats;
 using bluetooth::metrics::BluetoothMetricsProto::PairEvent;
 using bluetooth::metrics::BluetoothMetricsProto::ScanEvent;
 using bluetooth::metrics::BluetoothMetricsProto::ScanEvent_ScanEventType;
@@ -254,16 +258,31 @@ static A2dpSourceCodec get_a2dp_source_codec(int64_t codec_index) {
   }
 }
 
+/*
+ * A wake event, kept as is until the log is built. Wake locks are taken on the
+ * data path, where building the proto of each event would cost an allocation.
+ */
+struct WakeEventRecord {
+  wake_event_type_t type;
+  std::string requestor;
+  std::string name;
+  uint64_t timestamp_ms;
+};
+
 struct BluetoothMetricsLogger::impl {
   impl(size_t max_bluetooth_session, size_t max_pair_event,
-       size_t max_wake_event, size_t max_scan_event)
-      : bt_session_queue_(
+       size_t max_wake_event, size_t max_scan_event,
+       size_t max_l2cap_channel_stats)
+      : wake_events_(max_wake_event),
+        wake_event_head_(0),
+        wake_event_count_(0),
+        bt_session_queue_(
             new LeakyBondedQueue<BluetoothSession>(max_bluetooth_session)),
         pair_event_queue_(new LeakyBondedQueue<PairEvent>(max_pair_event)),
-        wake_event_queue_(new LeakyBondedQueue<WakeEvent>(max_wake_event)),
-        scan_event_queue_(new LeakyBondedQueue<ScanEvent>(max_scan_event)) {
+        scan_event_queue_(new LeakyBondedQueue<ScanEvent>(max_scan_event)),
+        l2cap_channel_stats_queue_(
+            new LeakyBondedQueue<L2capChannelStats>(max_l2cap_channel_stats)) {
     bluetooth_log_ = BluetoothLog::default_instance().New();
-    headset_profile_connection_counts_.fill(0);
     bluetooth_session_ = nullptr;
     bluetooth_session_start_time_ms_ = 0;
     a2dp_session_metrics_ = A2dpSessionMetrics();
@@ -271,10 +290,21 @@ struct BluetoothMetricsLogger::impl {
 
   /* Bluetooth log lock protected */
   BluetoothLog* bluetooth_log_;
-  std::array<int, HeadsetProfileType_ARRAYSIZE>
-      headset_profile_connection_counts_;
   std::recursive_mutex bluetooth_log_lock_;
   /* End Bluetooth log lock protected */
+  /* Updated without a lock, folded into the Bluetooth log by Build() */
+  MetricsCounter num_bluetooth_session_;
+  MetricsCounter num_pair_event_;
+  MetricsCounter num_wake_event_;
+  MetricsCounter num_scan_event_;
+  std::array<MetricsCounter, HeadsetProfileType_ARRAYSIZE>
+      headset_profile_connection_counts_;
+  /* Wake event lock protected, the oldest events are overwritten when full */
+  std::vector<WakeEventRecord> wake_events_;
+  size_t wake_event_head_;
+  size_t wake_event_count_;
+  std::mutex wake_event_lock_;
+  /* End wake event lock protected */
   /* Bluetooth session lock protected */
   BluetoothSession* bluetooth_session_;
   uint64_t bluetooth_session_start_time_ms_;
@@ -283,13 +313,15 @@ struct BluetoothMetricsLogger::impl {
   /* End bluetooth session lock protected */
   std::unique_ptr<LeakyBondedQueue<BluetoothSession>> bt_session_queue_;
   std::unique_ptr<LeakyBondedQueue<PairEvent>> pair_event_queue_;
-  std::unique_ptr<LeakyBondedQueue<WakeEvent>> wake_event_queue_;
   std::unique_ptr<LeakyBondedQueue<ScanEvent>> scan_event_queue_;
+  std::unique_ptr<LeakyBondedQueue<L2capChannelStats>>
+      l2cap_channel_stats_queue_;
 };
 
 BluetoothMetricsLogger::BluetoothMetricsLogger()
     : pimpl_(new impl(kMaxNumBluetoothSession, kMaxNumPairEvent,
-                      kMaxNumWakeEvent, kMaxNumScanEvent)) {}
+                      kMaxNumWakeEvent, kMaxNumScanEvent,
+                      kMaxNumL2capChannelStats)) {}
 
 void BluetoothMetricsLogger::LogPairEvent(uint32_t disconnect_reason,
                                           uint64_t timestamp_ms,
@@ -302,28 +334,31 @@ void BluetoothMetricsLogger::LogPairEvent(uint32_t disconnect_reason,
   event->set_disconnect_reason(disconnect_reason);
   event->set_event_time_millis(timestamp_ms);
   pimpl_->pair_event_queue_->Enqueue(event);
-  {
-    std::lock_guard<std::recursive_mutex> lock(pimpl_->bluetooth_log_lock_);
-    pimpl_->bluetooth_log_->set_num_pair_event(
-        pimpl_->bluetooth_log_->num_pair_event() + 1);
-  }
+  pimpl_->num_pair_event_.Add();
 }
 
 void BluetoothMetricsLogger::LogWakeEvent(wake_event_type_t type,
                                           const std::string& requestor,
                                           const std::string& name,
                                           uint64_t timestamp_ms) {
-  WakeEvent* event = new WakeEvent();
-  event->set_wake_event_type(get_wake_event_type(type));
-  event->set_requestor(requestor);
-  event->set_name(name);
-  event->set_event_time_millis(timestamp_ms);
-  pimpl_->wake_event_queue_->Enqueue(event);
-  {
-    std::lock_guard<std::recursive_mutex> lock(pimpl_->bluetooth_log_lock_);
-    pimpl_->bluetooth_log_->set_num_wake_event(
-        pimpl_->bluetooth_log_->num_wake_event() + 1);
+  pimpl_->num_wake_event_.Add();
+  std::lock_guard<std::mutex> lock(pimpl_->wake_event_lock_);
+  std::vector<WakeEventRecord>& events = pimpl_->wake_events_;
+  if (events.empty()) return;
+  size_t tail = (pimpl_->wake_event_head_ + pimpl_->wake_event_count_) %
+                events.size();
+  if (pimpl_->wake_event_count_ == events.size()) {
+    pimpl_->wake_event_head_ = (pimpl_->wake_event_head_ + 1) % events.size();
+  } else {
+    pimpl_->wake_event_count_++;
   }
+  // The strings are assigned in place, reusing the storage of the event they
+  // overwrite
+  WakeEventRecord& record = events[tail];
+  record.type = type;
+  record.requestor = requestor;
+  record.name = name;
+  record.timestamp_ms = timestamp_ms;
 }
 
 void BluetoothMetricsLogger::LogScanEvent(bool start,
@@ -341,11 +376,7 @@ void BluetoothMetricsLogger::LogScanEvent(bool start,
   event->set_number_results(results);
   event->set_event_time_millis(timestamp_ms);
   pimpl_->scan_event_queue_->Enqueue(event);
-  {
-    std::lock_guard<std::recursive_mutex> lock(pimpl_->bluetooth_log_lock_);
-    pimpl_->bluetooth_log_->set_num_scan_event(
-        pimpl_->bluetooth_log_->num_scan_event() + 1);
-  }
+  pimpl_->num_scan_event_.Add();
 }
 
 void BluetoothMetricsLogger::LogBluetoothSessionStart(
@@ -381,11 +412,7 @@ void BluetoothMetricsLogger::LogBluetoothSessionEnd(
   pimpl_->bt_session_queue_->Enqueue(pimpl_->bluetooth_session_);
   pimpl_->bluetooth_session_ = nullptr;
   pimpl_->a2dp_session_metrics_ = A2dpSessionMetrics();
-  {
-    std::lock_guard<std::recursive_mutex> log_lock(pimpl_->bluetooth_log_lock_);
-    pimpl_->bluetooth_log_->set_num_bluetooth_session(
-        pimpl_->bluetooth_log_->num_bluetooth_session() + 1);
-  }
+  pimpl_->num_bluetooth_session_.Add();
 }
 
 void BluetoothMetricsLogger::LogBluetoothSessionDeviceInfo(
@@ -437,22 +464,40 @@ void BluetoothMetricsLogger::LogA2dpSession(
 
 void BluetoothMetricsLogger::LogHeadsetProfileRfcConnection(
     tBTA_SERVICE_ID service_id) {
-  std::lock_guard<std::recursive_mutex> lock(pimpl_->bluetooth_log_lock_);
   switch (service_id) {
     case BTA_HSP_SERVICE_ID:
-      pimpl_->headset_profile_connection_counts_[HeadsetProfileType::HSP]++;
+      pimpl_->headset_profile_connection_counts_[HeadsetProfileType::HSP]
+          .Add();
       break;
     case BTA_HFP_SERVICE_ID:
-      pimpl_->headset_profile_connection_counts_[HeadsetProfileType::HFP]++;
+      pimpl_->headset_profile_connection_counts_[HeadsetProfileType::HFP]
+          .Add();
       break;
     default:
       pimpl_->headset_profile_connection_counts_
-          [HeadsetProfileType::HEADSET_PROFILE_UNKNOWN]++;
+          [HeadsetProfileType::HEADSET_PROFILE_UNKNOWN]
+              .Add();
       break;
   }
   return;
 }
 
+void BluetoothMetricsLogger::LogL2capChannelStats(
+    const L2capChannelMetrics& l2cap_channel_metrics) {
+  L2capChannelStats* stats = new L2capChannelStats();
+  stats->set_psm(l2cap_channel_metrics.psm);
+  stats->set_is_le(l2cap_channel_metrics.is_le);
+  stats->set_duration_millis(l2cap_channel_metrics.duration_ms);
+  stats->set_tx_bytes(l2cap_channel_metrics.tx_bytes);
+  stats->set_tx_packets(l2cap_channel_metrics.tx_packets);
+  stats->set_rx_bytes(l2cap_channel_metrics.rx_bytes);
+  stats->set_rx_packets(l2cap_channel_metrics.rx_packets);
+  stats->set_congestion_count(l2cap_channel_metrics.congestion_count);
+  stats->set_max_queue_delay_millis(l2cap_channel_metrics.max_queue_delay_ms);
+  stats->set_p99_queue_delay_millis(l2cap_channel_metrics.p99_queue_delay_ms);
+  pimpl_->l2cap_channel_stats_queue_->Enqueue(stats);
+}
+
 void BluetoothMetricsLogger::WriteString(std::string* serialized) {
   std::lock_guard<std::recursive_mutex> lock(pimpl_->bluetooth_log_lock_);
   LOG(INFO) << __func__ << ": building metrics";
@@ -519,20 +564,43 @@ void BluetoothMetricsLogger::Build() {
     bluetooth_log->mutable_scan_event()->AddAllocated(
         pimpl_->scan_event_queue_->Dequeue());
   }
-  while (!pimpl_->wake_event_queue_->Empty() &&
-         static_cast<size_t>(bluetooth_log->wake_event_size()) <=
-             pimpl_->wake_event_queue_->Capacity()) {
-    bluetooth_log->mutable_wake_event()->AddAllocated(
-        pimpl_->wake_event_queue_->Dequeue());
+  {
+    std::lock_guard<std::mutex> wake_lock(pimpl_->wake_event_lock_);
+    std::vector<WakeEventRecord>& events = pimpl_->wake_events_;
+    while (pimpl_->wake_event_count_ > 0 &&
+           static_cast<size_t>(bluetooth_log->wake_event_size()) <=
+               events.size()) {
+      const WakeEventRecord& record = events[pimpl_->wake_event_head_];
+      WakeEvent* event = bluetooth_log->add_wake_event();
+      event->set_wake_event_type(get_wake_event_type(record.type));
+      event->set_requestor(record.requestor);
+      event->set_name(record.name);
+      event->set_event_time_millis(record.timestamp_ms);
+      pimpl_->wake_event_head_ = (pimpl_->wake_event_head_ + 1) % events.size();
+      pimpl_->wake_event_count_--;
+    }
   }
-  while (!pimpl_->bt_session_queue_->Empty() &&
-         static_cast<size_t>(bluetooth_log->wake_event_size()) <=
-             pimpl_->wake_event_queue_->Capacity()) {
-    bluetooth_log->mutable_wake_event()->AddAllocated(
-        pimpl_->wake_event_queue_->Dequeue());
+  // The counts are only set when there is something to count
+  int64_t count = pimpl_->num_bluetooth_session_.Take();
+  if (count > 0) {
+    bluetooth_log->set_num_bluetooth_session(
+        bluetooth_log->num_bluetooth_session() + count);
+  }
+  count = pimpl_->num_pair_event_.Take();
+  if (count > 0) {
+    bluetooth_log->set_num_pair_event(bluetooth_log->num_pair_event() + count);
+  }
+  count = pimpl_->num_wake_event_.Take();
+  if (count > 0) {
+    bluetooth_log->set_num_wake_event(bluetooth_log->num_wake_event() + count);
+  }
+  count = pimpl_->num_scan_event_.Take();
+  if (count > 0) {
+    bluetooth_log->set_num_scan_event(bluetooth_log->num_scan_event() + count);
   }
   for (size_t i = 0; i < HeadsetProfileType_ARRAYSIZE; ++i) {
-    int num_times_connected = pimpl_->headset_profile_connection_counts_[i];
+    int num_times_connected =
+        pimpl_->headset_profile_connection_counts_[i].Take();
     if (HeadsetProfileType_IsValid(i) && num_times_connected > 0) {
       HeadsetProfileConnectionStats* headset_profile_connection_stats =
           bluetooth_log->add_headset_profile_connection_stats();
@@ -543,7 +611,12 @@ void BluetoothMetricsLogger::Build() {
           num_times_connected);
     }
   }
-  pimpl_->headset_profile_connection_counts_.fill(0);
+  while (!pimpl_->l2cap_channel_stats_queue_->Empty() &&
+         static_cast<size_t>(bluetooth_log->l2cap_channel_stats_size()) <=
+             pimpl_->l2cap_channel_stats_queue_->Capacity()) {
+    bluetooth_log->mutable_l2cap_channel_stats()->AddAllocated(
+        pimpl_->l2cap_channel_stats_queue_->Dequeue());
+  }
 }
 
 void BluetoothMetricsLogger::ResetSession() {
@@ -566,8 +639,20 @@ void BluetoothMetricsLogger::Reset() {
   ResetLog();
   pimpl_->bt_session_queue_->Clear();
   pimpl_->pair_event_queue_->Clear();
-  pimpl_->wake_event_queue_->Clear();
+  {
+    std::lock_guard<std::mutex> lock(pimpl_->wake_event_lock_);
+    pimpl_->wake_event_head_ = 0;
+    pimpl_->wake_event_count_ = 0;
+  }
+  pimpl_->num_bluetooth_session_.Take();
+  pimpl_->num_pair_event_.Take();
+  pimpl_->num_wake_event_.Take();
+  pimpl_->num_scan_event_.Take();
+  for (MetricsCounter& count : pimpl_->headset_profile_connection_counts_) {
+    count.Take();
+  }
   pimpl_->scan_event_queue_->Clear();
+  pimpl_->l2cap_channel_stats_queue_->Clear();
 }
 
 void LogLinkLayerConnectionEvent(const RawAddress* address,
@@ -113,6 +113,30 @@ class A2dpSessionMetrics {
   bool is_a2dp_offload = false;
 };
 
+/* Statistics of an L2CAP channel, logged when the channel is released
+ *
+ *    psm : PSM of the channel.
+ *    is_le : true if the channel is on an LE link.
+ *    duration_ms : time the channel was open (in milliseconds).
+ *    tx_bytes, tx_packets : payload bytes and SDUs sent to the peer.
+ *    rx_bytes, rx_packets : payload bytes and PDUs received from the peer.
+ *    congestion_count : number of times the channel became congested.
+ *    max_queue_delay_ms : longest time an SDU waited in the transmit queue.
+ *    p99_queue_delay_ms : upper bound of the 99th percentile of that time.
+ */
+struct L2capChannelMetrics {
+  uint16_t psm = 0;
+  bool is_le = false;
+  int64_t duration_ms = 0;
+  int64_t tx_bytes = 0;
+  int32_t tx_packets = 0;
+  int64_t rx_bytes = 0;
+  int32_t rx_packets = 0;
+  int32_t congestion_count = 0;
+  int32_t max_queue_delay_ms = 0;
+  int32_t p99_queue_delay_ms = 0;
+};
+
 class BluetoothMetricsLogger {
  public:
   static BluetoothMetricsLogger* GetInstance() {
@@ -223,6 +247,13 @@ class BluetoothMetricsLogger {
    */
   void LogHeadsetProfileRfcConnection(tBTA_SERVICE_ID service_id);
 
+  /**
+   * Log the statistics of a released L2CAP channel
+   *
+   * @param l2cap_channel_metrics statistics of the channel
+   */
+  void LogL2capChannelStats(const L2capChannelMetrics& l2cap_channel_metrics);
+
   /*
    * Writes the metrics, in base64 protobuf format, into the descriptor FD,
    * metrics events are always cleared after dump
@@ -244,6 +275,7 @@ class BluetoothMetricsLogger {
   static const size_t kMaxNumPairEvent = 50;
   static const size_t kMaxNumWakeEvent = 1000;
   static const size_t kMaxNumScanEvent = 50;
+  static const size_t kMaxNumL2capChannelStats = 50;
 
  private:
   BluetoothMetricsLogger();
@@ -0,0 +1,33 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "common/metrics_counters.h"
+
+namespace bluetooth {
+
+namespace common {
+
+size_t metrics_shard_index() {
+  // Threads are spread over the shards in the order of their first update
+  static std::atomic<size_t> next_shard{0};
+  thread_local size_t shard =
+      next_shard.fetch_add(1, std::memory_order_relaxed) % kMetricsShards;
+  return shard;
+}
+
+}  // namespace common
+
+}  // namespace bluetooth
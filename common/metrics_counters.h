@@ -0,0 +1,195 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace bluetooth {
+
+namespace common {
+
+/*
+ * Number of shards of each counter and histogram. A thread always updates the
+ * same shard, picked on its first update, so that threads updating the same
+ * metric rarely share a cache line.
+ */
+constexpr size_t kMetricsShards = 8;
+
+/*
+ * Returns the shard of the calling thread, in [0, kMetricsShards)
+ */
+size_t metrics_shard_index();
+
+/*
+ * A counter that any thread can update without a lock or an allocation.
+ * Updates are relaxed: they are all accounted for, but a read racing with
+ * them may see only some of them.
+ */
+class MetricsCounter {
+ public:
+  MetricsCounter() = default;
+  MetricsCounter(const MetricsCounter&) = delete;
+  MetricsCounter& operator=(const MetricsCounter&) = delete;
+
+  void Add(int64_t value = 1) {
+    shards_[metrics_shard_index()].value.fetch_add(value,
+                                                   std::memory_order_relaxed);
+  }
+
+  /*
+   * Returns the sum of all updates so far
+   */
+  int64_t Value() const {
+    int64_t value = 0;
+    for (const Shard& shard : shards_) {
+      value += shard.value.load(std::memory_order_relaxed);
+    }
+    return value;
+  }
+
+  /*
+   * Returns the sum of the updates since the last call, and starts over.
+   * An update racing with this call is returned by this call or the next.
+   */
+  int64_t Take() {
+    int64_t value = 0;
+    for (Shard& shard : shards_) {
+      value += shard.value.exchange(0, std::memory_order_relaxed);
+    }
+    return value;
+  }
+
+ private:
+  struct alignas(64) Shard {
+    std::atomic<int64_t> value{0};
+  };
+  std::array<Shard, kMetricsShards> shards_;
+};
+
+/*
+ * Counts of a MetricsHistogram at some point, which can be merged with other
+ * snapshots of histograms of the same buckets.
+ */
+template <size_t kBuckets>
+struct MetricsHistogramSnapshot {
+  std::array<int64_t, kBuckets> counts{};
+  int64_t sum = 0;
+
+  int64_t Count() const {
+    int64_t count = 0;
+    for (int64_t bucket_count : counts) count += bucket_count;
+    return count;
+  }
+
+  void Merge(const MetricsHistogramSnapshot& other) {
+    for (size_t i = 0; i < kBuckets; i++) counts[i] += other.counts[i];
+    sum += other.sum;
+  }
+
+  /*
+   * Returns the index of the bucket holding the |percent| percentile, or
+   * kBuckets if the snapshot is empty
+   */
+  size_t PercentileBucket(int percent) const {
+    int64_t count = Count();
+    if (count == 0) return kBuckets;
+    int64_t target = (count * percent + 99) / 100;
+    int64_t seen = 0;
+    for (size_t i = 0; i < kBuckets; i++) {
+      seen += counts[i];
+      if (seen >= target) return i;
+    }
+    return kBuckets - 1;
+  }
+};
+
+/*
+ * A histogram of fixed buckets that any thread can update without a lock or
+ * an allocation. Bucket i counts the values below bounds[i] and not counted
+ * by bucket i - 1; the last bucket counts the values from the last bound up.
+ */
+template <size_t kBuckets>
+class MetricsHistogram {
+  static_assert(kBuckets >= 2, "a histogram needs at least two buckets");
+
+ public:
+  using Bounds = std::array<int64_t, kBuckets - 1>;
+  using Snapshot = MetricsHistogramSnapshot<kBuckets>;
+
+  /*
+   * |bounds| must be sorted in increasing order
+   */
+  explicit MetricsHistogram(const Bounds& bounds) : bounds_(bounds) {}
+  MetricsHistogram(const MetricsHistogram&) = delete;
+  MetricsHistogram& operator=(const MetricsHistogram&) = delete;
+
+  const Bounds& GetBounds() const { return bounds_; }
+
+  void Record(int64_t value) {
+    size_t bucket = std::upper_bound(bounds_.begin(), bounds_.end(), value) -
+                    bounds_.begin();
+    Shard& shard = shards_[metrics_shard_index()];
+    shard.counts[bucket].fetch_add(1, std::memory_order_relaxed);
+    shard.sum.fetch_add(value, std::memory_order_relaxed);
+  }
+
+  /*
+   * Returns the counts of all values recorded so far
+   */
+  Snapshot GetSnapshot() const {
+    Snapshot snapshot;
+    for (const Shard& shard : shards_) {
+      for (size_t i = 0; i < kBuckets; i++) {
+        snapshot.counts[i] += shard.counts[i].load(std::memory_order_relaxed);
+      }
+      snapshot.sum += shard.sum.load(std::memory_order_relaxed);
+    }
+    return snapshot;
+  }
+
+  /*
+   * Returns the counts of the values recorded since the last call, and starts
+   * over
+   */
+  Snapshot Take() {
+    Snapshot snapshot;
+    for (Shard& shard : shards_) {
+      for (size_t i = 0; i < kBuckets; i++) {
+        snapshot.counts[i] +=
+            shard.counts[i].exchange(0, std::memory_order_relaxed);
+      }
+      snapshot.sum += shard.sum.exchange(0, std::memory_order_relaxed);
+    }
+    return snapshot;
+  }
+
+ private:
+  struct alignas(64) Shard {
+    std::array<std::atomic<int64_t>, kBuckets> counts{};
+    std::atomic<int64_t> sum{0};
+  };
+  const Bounds bounds_;
+  std::array<Shard, kMetricsShards> shards_;
+};
+
+}  // namespace common
+
+}  // namespace bluetooth
@@ -0,0 +1,130 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+#include "common/metrics_counters.h"
+
+namespace testing {
+
+using bluetooth::common::MetricsCounter;
+using bluetooth::common::MetricsHistogram;
+
+using Histogram = MetricsHistogram<4>;
+
+TEST(MetricsCounterTest, add_and_take) {
+  MetricsCounter counter;
+  EXPECT_EQ(counter.Value(), 0);
+  counter.Add();
+  counter.Add(41);
+  EXPECT_EQ(counter.Value(), 42);
+  EXPECT_EQ(counter.Take(), 42);
+  EXPECT_EQ(counter.Value(), 0);
+  counter.Add(-2);
+  EXPECT_EQ(counter.Take(), -2);
+}
+
+TEST(MetricsCounterTest, no_update_is_lost_across_threads) {
+  MetricsCounter counter;
+  constexpr int kThreads = 12;
+  constexpr int kAdds = 10000;
+  int64_t taken = 0;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kThreads; i++) {
+    threads.emplace_back([&counter]() {
+      for (int j = 0; j < kAdds; j++) counter.Add();
+    });
+  }
+  // Taking while the threads update neither loses nor repeats an update
+  for (int i = 0; i < 100; i++) taken += counter.Take();
+  for (auto& thread : threads) thread.join();
+  taken += counter.Take();
+  EXPECT_EQ(taken, kThreads * kAdds);
+}
+
+TEST(MetricsHistogramTest, values_fall_in_their_bucket) {
+  Histogram histogram({10, 20, 40});
+  for (int64_t value : {-5, 0, 9, 10, 19, 20, 39, 40, 1000}) {
+    histogram.Record(value);
+  }
+  Histogram::Snapshot snapshot = histogram.GetSnapshot();
+  EXPECT_EQ(snapshot.counts[0], 3);
+  EXPECT_EQ(snapshot.counts[1], 2);
+  EXPECT_EQ(snapshot.counts[2], 2);
+  EXPECT_EQ(snapshot.counts[3], 2);
+  EXPECT_EQ(snapshot.Count(), 9);
+  EXPECT_EQ(snapshot.sum, 1132);
+}
+
+TEST(MetricsHistogramTest, take_starts_over) {
+  Histogram histogram({10, 20, 40});
+  histogram.Record(15);
+  EXPECT_EQ(histogram.Take().counts[1], 1);
+  EXPECT_EQ(histogram.GetSnapshot().Count(), 0);
+  EXPECT_EQ(histogram.Take().sum, 0);
+}
+
+TEST(MetricsHistogramTest, snapshots_merge) {
+  Histogram a({10, 20, 40});
+  Histogram b({10, 20, 40});
+  a.Record(5);
+  a.Record(25);
+  b.Record(25);
+  b.Record(50);
+  Histogram::Snapshot snapshot = a.GetSnapshot();
+  snapshot.Merge(b.GetSnapshot());
+  EXPECT_EQ(snapshot.counts[0], 1);
+  EXPECT_EQ(snapshot.counts[1], 0);
+  EXPECT_EQ(snapshot.counts[2], 2);
+  EXPECT_EQ(snapshot.counts[3], 1);
+  EXPECT_EQ(snapshot.sum, 105);
+}
+
+TEST(MetricsHistogramTest, percentile_bucket) {
+  Histogram histogram({10, 20, 40});
+  EXPECT_EQ(histogram.GetSnapshot().PercentileBucket(50), 4u);
+  for (int i = 0; i < 98; i++) histogram.Record(5);
+  histogram.Record(30);
+  histogram.Record(100);
+  Histogram::Snapshot snapshot = histogram.GetSnapshot();
+  EXPECT_EQ(snapshot.PercentileBucket(50), 0u);
+  EXPECT_EQ(snapshot.PercentileBucket(99), 2u);
+  EXPECT_EQ(snapshot.PercentileBucket(100), 3u);
+}
+
+TEST(MetricsHistogramTest, no_record_is_lost_across_threads) {
+  Histogram histogram({10, 20, 40});
+  constexpr int kThreads = 12;
+  constexpr int kRecords = 10000;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kThreads; i++) {
+    threads.emplace_back([&histogram, i]() {
+      for (int j = 0; j < kRecords; j++) histogram.Record(i * 5);
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  Histogram::Snapshot snapshot = histogram.GetSnapshot();
+  EXPECT_EQ(snapshot.Count(), kThreads * kRecords);
+  EXPECT_EQ(snapshot.counts[0], 2 * kRecords);
+  EXPECT_EQ(snapshot.counts[1], 2 * kRecords);
+  EXPECT_EQ(snapshot.counts[2], 4 * kRecords);
+  EXPECT_EQ(snapshot.counts[3], 4 * kRecords);
+}
+
+}  // namespace testing
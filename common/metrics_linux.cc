@@ -72,6 +72,9 @@ void BluetoothMetricsLogger::LogA2dpSession(
 void BluetoothMetricsLogger::LogHeadsetProfileRfcConnection(
     tBTA_SERVICE_ID service_id) {}
 
+void BluetoothMetricsLogger::LogL2capChannelStats(
+    const L2capChannelMetrics& l2cap_channel_metrics) {}
+
 void BluetoothMetricsLogger::WriteString(std::string* serialized) {}
 
 void BluetoothMetricsLogger::WriteBase64String(std::string* serialized) {}
@@ -37,6 +37,7 @@ namespace testing {
 
 using bluetooth::common::A2dpSessionMetrics;
 using bluetooth::common::BluetoothMetricsLogger;
+using bluetooth::common::L2capChannelMetrics;
 using bluetooth::metrics::BluetoothMetricsProto::A2DPSession;
 using bluetooth::metrics::BluetoothMetricsProto::A2dpSourceCodec;
 using bluetooth::metrics::BluetoothMetricsProto::BluetoothLog;
@@ -49,6 +50,7 @@ using bluetooth::metrics::BluetoothMetricsProto::DeviceInfo;
 using bluetooth::metrics::BluetoothMetricsProto::DeviceInfo_DeviceType;
 using bluetooth::metrics::BluetoothMetricsProto::HeadsetProfileConnectionStats;
 using bluetooth::metrics::BluetoothMetricsProto::HeadsetProfileType;
+using bluetooth::metrics::BluetoothMetricsProto::L2capChannelStats;
 using bluetooth::metrics::BluetoothMetricsProto::PairEvent;
 using bluetooth::metrics::BluetoothMetricsProto::RFCommSession;
 using bluetooth::metrics::BluetoothMetricsProto::ScanEvent;
@@ -1005,4 +1007,47 @@ TEST_F(BluetoothMetricsLoggerTest, LogHeadsetProfileRfcConnectionErrorTest) {
   EXPECT_EQ(metrics->headset_profile_connection_stats_size(), 0);
   delete metrics;
 }
+
+TEST_F(BluetoothMetricsLoggerTest, LogL2capChannelStatsTest) {
+  L2capChannelMetrics l2cap_channel_metrics;
+  l2cap_channel_metrics.psm = 0x0019;
+  l2cap_channel_metrics.duration_ms = 10000;
+  l2cap_channel_metrics.tx_bytes = 123456;
+  l2cap_channel_metrics.tx_packets = 200;
+  l2cap_channel_metrics.rx_bytes = 1000;
+  l2cap_channel_metrics.rx_packets = 10;
+  l2cap_channel_metrics.congestion_count = 3;
+  l2cap_channel_metrics.max_queue_delay_ms = 90;
+  l2cap_channel_metrics.p99_queue_delay_ms = 63;
+  BluetoothMetricsLogger::GetInstance()->LogL2capChannelStats(
+      l2cap_channel_metrics);
+  l2cap_channel_metrics.psm = 0x0080;
+  l2cap_channel_metrics.is_le = true;
+  BluetoothMetricsLogger::GetInstance()->LogL2capChannelStats(
+      l2cap_channel_metrics);
+  std::string msg_str;
+  BluetoothMetricsLogger::GetInstance()->WriteString(&msg_str);
+  BluetoothLog* metrics = BluetoothLog::default_instance().New();
+  metrics->ParseFromString(msg_str);
+  ASSERT_EQ(metrics->l2cap_channel_stats_size(), 2);
+  const L2capChannelStats& stats = metrics->l2cap_channel_stats(0);
+  EXPECT_EQ(stats.psm(), 0x0019);
+  EXPECT_FALSE(stats.is_le());
+  EXPECT_EQ(stats.duration_millis(), 10000);
+  EXPECT_EQ(stats.tx_bytes(), 123456);
+  EXPECT_EQ(stats.tx_packets(), 200);
+  EXPECT_EQ(stats.rx_bytes(), 1000);
+  EXPECT_EQ(stats.rx_packets(), 10);
+  EXPECT_EQ(stats.congestion_count(), 3);
+  EXPECT_EQ(stats.max_queue_delay_millis(), 90);
+  EXPECT_EQ(stats.p99_queue_delay_millis(), 63);
+  EXPECT_EQ(metrics->l2cap_channel_stats(1).psm(), 0x0080);
+  EXPECT_TRUE(metrics->l2cap_channel_stats(1).is_le());
+  // Verify that dump after clean up result in an empty list
+  msg_str.clear();
+  BluetoothMetricsLogger::GetInstance()->WriteString(&msg_str);
+  metrics->ParseFromString(msg_str);
+  EXPECT_EQ(metrics->l2cap_channel_stats_size(), 0);
+  delete metrics;
+}
 }  // namespace testing
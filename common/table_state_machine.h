@@ -0,0 +1,210 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace bluetooth {
+
+namespace common {
+
+/**
+ * Transition table of a state machine, built at compile time.
+ *
+ * The table has a row for each event in each state: the actions to run for
+ * the event, and the state to move to. States, events and actions are small
+ * integers, so the table is a constant array of bytes, and its shape and
+ * content can be checked with static_assert.
+ *
+ * @tparam kNumStates the number of states
+ * @tparam kNumEvents the number of events
+ * @tparam kNumActions the number of actions
+ * @tparam kMaxActions the maximum number of actions run by a transition
+ */
+template <size_t kNumStates, size_t kNumEvents, size_t kNumActions,
+          size_t kMaxActions>
+class TransitionTable {
+  static_assert(kNumStates > 0 && kNumStates <= UINT8_MAX,
+                "states must fit in a byte");
+  static_assert(kNumActions < UINT8_MAX, "actions must fit in a byte");
+
+ public:
+  /**
+   * The action that is not run. It ends the actions of a transition.
+   */
+  static constexpr uint8_t kIgnore = kNumActions;
+
+  /**
+   * A row of the table.
+   */
+  struct Transition {
+    uint8_t actions[kMaxActions];
+    uint8_t next_state;
+  };
+
+  /**
+   * The rows of a state, indexed by event.
+   */
+  using StateTable = std::array<Transition, kNumEvents>;
+
+  /**
+   * Build the rows of a state. A table with a missing or extra row does not
+   * compile.
+   *
+   * @param rows the rows, one per event, in event order
+   * @return the rows of the state
+   */
+  template <size_t N>
+  static constexpr StateTable MakeStateTable(const Transition (&rows)[N]) {
+    static_assert(N == kNumEvents, "a state needs one row per event");
+    StateTable table = {};
+    for (size_t i = 0; i < N; i++) table[i] = rows[i];
+    return table;
+  }
+
+  /**
+   * Constructor.
+   *
+   * @param tables the rows of each state, in state order
+   */
+  constexpr explicit TransitionTable(
+      const std::array<StateTable, kNumStates>& tables)
+      : tables_(tables) {}
+
+  /**
+   * Check that every next state and every action of the table exists.
+   *
+   * @return true if the table is valid, otherwise false
+   */
+  constexpr bool IsValid() const {
+    for (const StateTable& table : tables_) {
+      for (const Transition& transition : table) {
+        if (transition.next_state >= kNumStates) return false;
+        for (uint8_t action : transition.actions) {
+          if (action > kIgnore) return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  /**
+   * Look up the transition for an event.
+   *
+   * @param state the current state
+   * @param event the event, from 0
+   * @return the transition
+   */
+  constexpr const Transition& Lookup(uint8_t state, size_t event) const {
+    return tables_[state][event];
+  }
+
+  /**
+   * Run the actions of a transition, in order, until the first kIgnore.
+   *
+   * @param transition the transition
+   * @param actions the action functions, indexed by action
+   * @param args the arguments of the action functions
+   */
+  template <typename Action, typename... Args>
+  static void RunActions(const Transition& transition, const Action* actions,
+                         Args&&... args) {
+    for (uint8_t action : transition.actions) {
+      if (action == kIgnore) break;
+      actions[action](args...);
+    }
+  }
+
+  /**
+   * Process an event: move to the next state, then run the actions. An
+   * action that processes another event runs it to completion before the
+   * next action runs.
+   *
+   * @param p_state the current state, updated with the next state
+   * @param event the event, from 0
+   * @param actions the action functions, indexed by action
+   * @param args the arguments of the action functions
+   */
+  template <typename Action, typename... Args>
+  void Execute(uint8_t* p_state, size_t event, const Action* actions,
+               Args&&... args) const {
+    const Transition& transition = Lookup(*p_state, event);
+    *p_state = transition.next_state;
+    RunActions(transition, actions, args...);
+  }
+
+ private:
+  std::array<StateTable, kNumStates> tables_;
+};
+
+/**
+ * Fixed capacity FIFO of events, kept by value.
+ *
+ * A state machine runs an event to completion before the next one when its
+ * actions push the events they raise here, and the caller pops them once
+ * the current event is done, without an allocation per event.
+ *
+ * @tparam T the event type
+ * @tparam kCapacity the maximum number of events
+ */
+template <typename T, size_t kCapacity>
+class InlineEventQueue {
+  static_assert(kCapacity > 0, "the queue needs a capacity");
+
+ public:
+  /**
+   * Add an event at the back of the queue.
+   *
+   * @param event the event
+   * @return true if the event was added, false if the queue is full
+   */
+  bool Push(const T& event) {
+    if (size_ == kCapacity) return false;
+    events_[(front_ + size_) % kCapacity] = event;
+    size_++;
+    return true;
+  }
+
+  /**
+   * Remove the event at the front of the queue.
+   *
+   * @param p_event the event, if there is one
+   * @return true if an event was removed, false if the queue is empty
+   */
+  bool Pop(T* p_event) {
+    if (size_ == 0) return false;
+    *p_event = events_[front_];
+    front_ = (front_ + 1) % kCapacity;
+    size_--;
+    return true;
+  }
+
+  bool IsEmpty() const { return size_ == 0; }
+
+  size_t Size() const { return size_; }
+
+ private:
+  std::array<T, kCapacity> events_ = {};
+  size_t front_ = 0;
+  size_t size_ = 0;
+};
+
+}  // namespace common
+
+}  // namespace bluetooth
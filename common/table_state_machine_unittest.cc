@@ -0,0 +1,197 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "common/table_state_machine.h"
+
+using bluetooth::common::InlineEventQueue;
+using bluetooth::common::TransitionTable;
+
+namespace {
+
+enum { kStateIdle, kStateOpen, kStateStarted, kNumStates };
+
+enum { kEventOpen, kEventStart, kEventStop, kEventClose, kNumEvents };
+
+enum { kActionOpen, kActionStart, kActionStop, kActionClose, kNumActions };
+
+using Table = TransitionTable<kNumStates, kNumEvents, kNumActions, 2>;
+
+constexpr uint8_t kIgnore = Table::kIgnore;
+
+constexpr Table::StateTable kIdle = Table::MakeStateTable({
+    /* kEventOpen */ {kActionOpen, kIgnore, kStateOpen},
+    /* kEventStart */ {kIgnore, kIgnore, kStateIdle},
+    /* kEventStop */ {kIgnore, kIgnore, kStateIdle},
+    /* kEventClose */ {kIgnore, kIgnore, kStateIdle},
+});
+
+constexpr Table::StateTable kOpen = Table::MakeStateTable({
+    /* kEventOpen */ {kIgnore, kIgnore, kStateOpen},
+    /* kEventStart */ {kActionStart, kIgnore, kStateStarted},
+    /* kEventStop */ {kIgnore, kIgnore, kStateOpen},
+    /* kEventClose */ {kActionClose, kIgnore, kStateIdle},
+});
+
+constexpr Table::StateTable kStarted = Table::MakeStateTable({
+    /* kEventOpen */ {kIgnore, kIgnore, kStateStarted},
+    /* kEventStart */ {kIgnore, kIgnore, kStateStarted},
+    /* kEventStop */ {kActionStop, kIgnore, kStateOpen},
+    /* kEventClose */ {kActionStop, kActionClose, kStateIdle},
+});
+
+constexpr Table kTable({kIdle, kOpen, kStarted});
+static_assert(kTable.IsValid(), "the test table is not valid");
+
+constexpr Table::StateTable kBadNextState = Table::MakeStateTable({
+    {kIgnore, kIgnore, kStateIdle},
+    {kIgnore, kIgnore, kNumStates},
+    {kIgnore, kIgnore, kStateIdle},
+    {kIgnore, kIgnore, kStateIdle},
+});
+static_assert(!Table({kIdle, kOpen, kBadNextState}).IsValid(),
+              "a next state out of range is not caught");
+
+constexpr Table::StateTable kBadAction = Table::MakeStateTable({
+    {kIgnore, kIgnore, kStateIdle},
+    {kIgnore, kIgnore, kStateIdle},
+    {kActionStop, kIgnore + 1, kStateIdle},
+    {kIgnore, kIgnore, kStateIdle},
+});
+static_assert(!Table({kBadAction, kOpen, kStarted}).IsValid(),
+              "an action out of range is not caught");
+
+struct Context {
+  uint8_t state = kStateIdle;
+  std::vector<std::pair<int, uint8_t>> calls;  // action, state when run
+};
+
+template <int kAction>
+void Record(Context* context, int* p_data) {
+  context->calls.emplace_back(kAction, context->state);
+  (*p_data)++;
+}
+
+using Action = void (*)(Context*, int*);
+
+const Action kActions[] = {Record<kActionOpen>, Record<kActionStart>,
+                           Record<kActionStop>, Record<kActionClose>};
+
+// The open action processes a nested start event
+void OpenAndStart(Context* context, int* p_data) {
+  Record<kActionOpen>(context, p_data);
+  kTable.Execute(&context->state, kEventStart, kActions, context, p_data);
+}
+
+}  // namespace
+
+TEST(TableStateMachineTest, test_transitions) {
+  Context context;
+  int data = 0;
+
+  kTable.Execute(&context.state, kEventStart, kActions, &context, &data);
+  EXPECT_EQ(context.state, kStateIdle);
+  EXPECT_TRUE(context.calls.empty());
+
+  kTable.Execute(&context.state, kEventOpen, kActions, &context, &data);
+  EXPECT_EQ(context.state, kStateOpen);
+  kTable.Execute(&context.state, kEventStart, kActions, &context, &data);
+  EXPECT_EQ(context.state, kStateStarted);
+  kTable.Execute(&context.state, kEventClose, kActions, &context, &data);
+  EXPECT_EQ(context.state, kStateIdle);
+
+  // The next state is set before the actions run
+  std::vector<std::pair<int, uint8_t>> expected = {
+      {kActionOpen, kStateOpen},
+      {kActionStart, kStateStarted},
+      {kActionStop, kStateIdle},
+      {kActionClose, kStateIdle}};
+  EXPECT_EQ(context.calls, expected);
+  EXPECT_EQ(data, 4);
+}
+
+TEST(TableStateMachineTest, test_lookup) {
+  const Table::Transition& transition =
+      kTable.Lookup(kStateStarted, kEventClose);
+  EXPECT_EQ(transition.actions[0], kActionStop);
+  EXPECT_EQ(transition.actions[1], kActionClose);
+  EXPECT_EQ(transition.next_state, kStateIdle);
+
+  Context context;
+  int data = 0;
+  Table::RunActions(transition, kActions, &context, &data);
+  EXPECT_EQ(context.state, kStateIdle);
+  EXPECT_EQ(data, 2);
+}
+
+TEST(TableStateMachineTest, test_nested_event) {
+  const Action actions[] = {OpenAndStart, Record<kActionStart>,
+                            Record<kActionStop>, Record<kActionClose>};
+  Context context;
+  int data = 0;
+
+  kTable.Execute(&context.state, kEventOpen, actions, &context, &data);
+  EXPECT_EQ(context.state, kStateStarted);
+  std::vector<std::pair<int, uint8_t>> expected = {
+      {kActionOpen, kStateOpen}, {kActionStart, kStateStarted}};
+  EXPECT_EQ(context.calls, expected);
+}
+
+TEST(TableStateMachineTest, test_inline_event_queue) {
+  InlineEventQueue<int, 3> queue;
+  int event = -1;
+
+  EXPECT_TRUE(queue.IsEmpty());
+  EXPECT_FALSE(queue.Pop(&event));
+  EXPECT_EQ(event, -1);
+
+  EXPECT_TRUE(queue.Push(kEventOpen));
+  EXPECT_TRUE(queue.Push(kEventStart));
+  EXPECT_TRUE(queue.Push(kEventStop));
+  EXPECT_FALSE(queue.Push(kEventClose));
+  EXPECT_EQ(queue.Size(), 3u);
+
+  EXPECT_TRUE(queue.Pop(&event));
+  EXPECT_EQ(event, kEventOpen);
+  EXPECT_TRUE(queue.Push(kEventClose));
+
+  for (int expected : {kEventStart, kEventStop, kEventClose}) {
+    EXPECT_TRUE(queue.Pop(&event));
+    EXPECT_EQ(event, expected);
+  }
+  EXPECT_TRUE(queue.IsEmpty());
+}
+
+TEST(TableStateMachineTest, test_run_to_completion) {
+  InlineEventQueue<int, 4> queue;
+  Context context;
+  int data = 0;
+
+  queue.Push(kEventOpen);
+  queue.Push(kEventStart);
+  queue.Push(kEventStop);
+  queue.Push(kEventClose);
+
+  int event;
+  while (queue.Pop(&event)) {
+    kTable.Execute(&context.state, event, kActions, &context, &data);
+  }
+  EXPECT_EQ(context.state, kStateIdle);
+  EXPECT_EQ(data, 4);
+}
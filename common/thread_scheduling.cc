@@ -0,0 +1,239 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "common/thread_scheduling.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include <base/logging.h>
+#include <base/strings/string_split.h>
+
+namespace bluetooth {
+
+namespace common {
+
+namespace {
+
+constexpr int kMaxCpus = 64;
+
+// What was last applied to a thread of a given name
+struct AppliedProfile {
+  pid_t linux_tid;
+  bool success;
+};
+
+std::mutex& profiles_mutex() {
+  static std::mutex mutex;
+  return mutex;
+}
+
+std::map<std::string, ThreadSchedulingProfile>& profiles() {
+  static std::map<std::string, ThreadSchedulingProfile> profiles;
+  return profiles;
+}
+
+std::map<std::string, AppliedProfile>& applied_profiles() {
+  static std::map<std::string, AppliedProfile> applied;
+  return applied;
+}
+
+bool ParseInt(const std::string& text, int min, int max, int* value) {
+  if (text.empty()) return false;
+  char* end;
+  long parsed = strtol(text.c_str(), &end, 10);
+  if (*end != '\0' || parsed < min || parsed > max) return false;
+  *value = parsed;
+  return true;
+}
+
+bool ParseCpus(const std::string& text, uint64_t* cpu_mask) {
+  uint64_t mask = 0;
+  for (const std::string& range : base::SplitString(
+           text, ",", base::TRIM_WHITESPACE, base::SPLIT_WANT_ALL)) {
+    std::vector<std::string> bounds = base::SplitString(
+        range, "-", base::TRIM_WHITESPACE, base::SPLIT_WANT_ALL);
+    int first, last;
+    if (bounds.empty() || bounds.size() > 2 ||
+        !ParseInt(bounds[0], 0, kMaxCpus - 1, &first))
+      return false;
+    last = first;
+    if (bounds.size() == 2 && !ParseInt(bounds[1], first, kMaxCpus - 1, &last))
+      return false;
+    for (int cpu = first; cpu <= last; cpu++) mask |= uint64_t{1} << cpu;
+  }
+  *cpu_mask = mask;
+  return mask != 0;
+}
+
+const char* PolicyName(int policy) {
+  switch (policy) {
+    case SCHED_FIFO:
+      return "fifo";
+    case SCHED_RR:
+      return "rr";
+    default:
+      return "other";
+  }
+}
+
+}  // namespace
+
+bool ParseThreadSchedulingProfile(const std::string& text,
+                                  ThreadSchedulingProfile* profile) {
+  std::vector<std::string> fields = base::SplitString(
+      text, ":", base::TRIM_WHITESPACE, base::SPLIT_WANT_ALL);
+  if (fields.empty() || fields.size() > 3) return false;
+
+  ThreadSchedulingProfile parsed = {SCHED_OTHER, 0, 0};
+  if (fields[0] == "fifo") {
+    parsed.policy = SCHED_FIFO;
+  } else if (fields[0] == "rr") {
+    parsed.policy = SCHED_RR;
+  } else if (fields[0] != "other") {
+    return false;
+  }
+
+  if (parsed.policy == SCHED_OTHER) {
+    if (fields.size() > 1 && !ParseInt(fields[1], -20, 19, &parsed.priority))
+      return false;
+  } else {
+    // A real-time policy needs a priority
+    parsed.priority = 1;
+    if (fields.size() > 1 && !ParseInt(fields[1], 1, 99, &parsed.priority))
+      return false;
+  }
+
+  if (fields.size() > 2 && !ParseCpus(fields[2], &parsed.cpu_mask))
+    return false;
+
+  *profile = parsed;
+  return true;
+}
+
+void SetThreadSchedulingProfile(const std::string& thread_name,
+                                const ThreadSchedulingProfile& profile) {
+  std::lock_guard<std::mutex> lock(profiles_mutex());
+  profiles()[thread_name] = profile;
+}
+
+void ClearThreadSchedulingProfiles() {
+  std::lock_guard<std::mutex> lock(profiles_mutex());
+  profiles().clear();
+  applied_profiles().clear();
+}
+
+bool HasThreadSchedulingProfile(const std::string& thread_name) {
+  std::lock_guard<std::mutex> lock(profiles_mutex());
+  return profiles().count(thread_name) != 0;
+}
+
+bool ApplyThreadSchedulingProfile(const std::string& thread_name,
+                                  pid_t linux_tid) {
+  ThreadSchedulingProfile profile;
+  {
+    std::lock_guard<std::mutex> lock(profiles_mutex());
+    auto iter = profiles().find(thread_name);
+    if (iter == profiles().end()) return false;
+    profile = iter->second;
+  }
+
+  bool success = true;
+  struct sched_param param = {};
+  if (profile.policy != SCHED_OTHER) param.sched_priority = profile.priority;
+  if (sched_setscheduler(linux_tid, profile.policy, &param) != 0) {
+    LOG(ERROR) << __func__ << ": unable to set policy "
+               << PolicyName(profile.policy) << " for " << thread_name << "("
+               << linux_tid << "): " << strerror(errno);
+    success = false;
+  }
+
+  if (profile.policy == SCHED_OTHER &&
+      setpriority(PRIO_PROCESS, linux_tid, profile.priority) != 0) {
+    LOG(ERROR) << __func__ << ": unable to set nice " << profile.priority
+               << " for " << thread_name << "(" << linux_tid
+               << "): " << strerror(errno);
+    success = false;
+  }
+
+  if (profile.cpu_mask != 0) {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    for (int cpu = 0; cpu < kMaxCpus; cpu++) {
+      if (profile.cpu_mask & (uint64_t{1} << cpu)) CPU_SET(cpu, &cpus);
+    }
+    if (sched_setaffinity(linux_tid, sizeof(cpus), &cpus) != 0) {
+      LOG(ERROR) << __func__ << ": unable to set the CPU affinity of "
+                 << thread_name << "(" << linux_tid
+                 << "): " << strerror(errno);
+      success = false;
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(profiles_mutex());
+  applied_profiles()[thread_name] = {linux_tid, success};
+  return success;
+}
+
+void ThreadSchedulingDebugDump(int fd) {
+  std::lock_guard<std::mutex> lock(profiles_mutex());
+  if (profiles().empty()) return;
+
+  dprintf(fd, "\nThread scheduling profiles:\n");
+  for (const auto& entry : profiles()) {
+    const ThreadSchedulingProfile& profile = entry.second;
+    dprintf(fd, "  %-32s %s:%d cpus:0x%" PRIx64, entry.first.c_str(),
+            PolicyName(profile.policy), profile.priority, profile.cpu_mask);
+
+    auto applied = applied_profiles().find(entry.first);
+    if (applied == applied_profiles().end()) {
+      dprintf(fd, " not applied\n");
+      continue;
+    }
+
+    // What the kernel has now, the thread may have changed it since
+    pid_t tid = applied->second.linux_tid;
+    int policy = sched_getscheduler(tid);
+    struct sched_param param = {};
+    sched_getparam(tid, &param);
+    errno = 0;
+    int nice = getpriority(PRIO_PROCESS, tid);
+    cpu_set_t cpus;
+    uint64_t cpu_mask = 0;
+    if (sched_getaffinity(tid, sizeof(cpus), &cpus) == 0) {
+      for (int cpu = 0; cpu < kMaxCpus; cpu++) {
+        if (CPU_ISSET(cpu, &cpus)) cpu_mask |= uint64_t{1} << cpu;
+      }
+    }
+    dprintf(fd, " applied to %d%s, now %s:%d cpus:0x%" PRIx64 "\n", tid,
+            applied->second.success ? "" : " with errors",
+            policy < 0 ? "gone" : PolicyName(policy),
+            policy == SCHED_OTHER ? nice : param.sched_priority, cpu_mask);
+  }
+}
+
+}  // namespace common
+
+}  // namespace bluetooth
@@ -0,0 +1,77 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <sys/types.h>
+
+#include <cstdint>
+#include <string>
+
+namespace bluetooth {
+
+namespace common {
+
+/*
+ * The scheduling of a stack thread, picked by thread name. The profiles come
+ * from the ThreadScheduling.<thread name> entries of bt_stack.conf, and are
+ * applied when the thread starts, in place of the thread's own defaults.
+ */
+struct ThreadSchedulingProfile {
+  int policy;         // SCHED_OTHER, SCHED_FIFO or SCHED_RR
+  int priority;       // nice value for SCHED_OTHER, real-time priority else
+  uint64_t cpu_mask;  // allowed CPUs, 0 leaves the affinity alone
+};
+
+/*
+ * Parses "<policy>[:<priority>[:<cpus>]]", where policy is "other", "fifo"
+ * or "rr" and cpus is a list of CPU numbers and ranges such as "4-7,9".
+ * Returns false if |text| is malformed.
+ */
+bool ParseThreadSchedulingProfile(const std::string& text,
+                                  ThreadSchedulingProfile* profile);
+
+/*
+ * Sets the profile of the threads named |thread_name|
+ */
+void SetThreadSchedulingProfile(const std::string& thread_name,
+                                const ThreadSchedulingProfile& profile);
+
+/*
+ * Forgets all the profiles and what was applied
+ */
+void ClearThreadSchedulingProfiles();
+
+/*
+ * Returns true if threads named |thread_name| have a profile
+ */
+bool HasThreadSchedulingProfile(const std::string& thread_name);
+
+/*
+ * Applies the profile of |thread_name| to the thread |linux_tid|. Returns
+ * false if there is no profile or if the kernel refused part of it.
+ */
+bool ApplyThreadSchedulingProfile(const std::string& thread_name,
+                                  pid_t linux_tid);
+
+/*
+ * Dumps the profiles, and what was applied to which thread
+ */
+void ThreadSchedulingDebugDump(int fd);
+
+}  // namespace common
+
+}  // namespace bluetooth
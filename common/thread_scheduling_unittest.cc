@@ -0,0 +1,102 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "common/thread_scheduling.h"
+
+using bluetooth::common::ApplyThreadSchedulingProfile;
+using bluetooth::common::ClearThreadSchedulingProfiles;
+using bluetooth::common::HasThreadSchedulingProfile;
+using bluetooth::common::ParseThreadSchedulingProfile;
+using bluetooth::common::SetThreadSchedulingProfile;
+using bluetooth::common::ThreadSchedulingProfile;
+
+class ThreadSchedulingTest : public ::testing::Test {
+ protected:
+  void TearDown() override { ClearThreadSchedulingProfiles(); }
+};
+
+TEST_F(ThreadSchedulingTest, parse_real_time_profile) {
+  ThreadSchedulingProfile profile;
+  ASSERT_TRUE(ParseThreadSchedulingProfile("fifo:2:4-7,9", &profile));
+  EXPECT_EQ(SCHED_FIFO, profile.policy);
+  EXPECT_EQ(2, profile.priority);
+  EXPECT_EQ(0x2f0u, profile.cpu_mask);
+
+  ASSERT_TRUE(ParseThreadSchedulingProfile("rr", &profile));
+  EXPECT_EQ(SCHED_RR, profile.policy);
+  EXPECT_EQ(1, profile.priority);
+  EXPECT_EQ(0u, profile.cpu_mask);
+}
+
+TEST_F(ThreadSchedulingTest, parse_other_profile) {
+  ThreadSchedulingProfile profile;
+  ASSERT_TRUE(ParseThreadSchedulingProfile("other:-4", &profile));
+  EXPECT_EQ(SCHED_OTHER, profile.policy);
+  EXPECT_EQ(-4, profile.priority);
+  EXPECT_EQ(0u, profile.cpu_mask);
+}
+
+TEST_F(ThreadSchedulingTest, parse_rejects_malformed_profiles) {
+  ThreadSchedulingProfile profile;
+  EXPECT_FALSE(ParseThreadSchedulingProfile("", &profile));
+  EXPECT_FALSE(ParseThreadSchedulingProfile("batch", &profile));
+  EXPECT_FALSE(ParseThreadSchedulingProfile("fifo:0", &profile));
+  EXPECT_FALSE(ParseThreadSchedulingProfile("fifo:100", &profile));
+  EXPECT_FALSE(ParseThreadSchedulingProfile("other:20", &profile));
+  EXPECT_FALSE(ParseThreadSchedulingProfile("fifo:1:7-4", &profile));
+  EXPECT_FALSE(ParseThreadSchedulingProfile("fifo:1:64", &profile));
+  EXPECT_FALSE(ParseThreadSchedulingProfile("fifo:1:", &profile));
+  EXPECT_FALSE(ParseThreadSchedulingProfile("fifo:1:2:3", &profile));
+}
+
+TEST_F(ThreadSchedulingTest, apply_needs_a_profile) {
+  pid_t linux_tid = static_cast<pid_t>(syscall(SYS_gettid));
+  EXPECT_FALSE(HasThreadSchedulingProfile("test_thread"));
+  EXPECT_FALSE(ApplyThreadSchedulingProfile("test_thread", linux_tid));
+}
+
+TEST_F(ThreadSchedulingTest, apply_affinity) {
+  // A thread of its own, as the nice value raised below can't be restored
+  std::thread thread([] {
+    pid_t linux_tid = static_cast<pid_t>(syscall(SYS_gettid));
+    cpu_set_t cpus;
+    ASSERT_EQ(0, sched_getaffinity(linux_tid, sizeof(cpus), &cpus));
+    int cpu = 0;
+    while (cpu < 64 && !CPU_ISSET(cpu, &cpus)) cpu++;
+    ASSERT_LT(cpu, 64);
+
+    // Raising the nice value of a thread needs no privilege
+    SetThreadSchedulingProfile("test_thread",
+                               {SCHED_OTHER, 1, uint64_t{1} << cpu});
+    EXPECT_TRUE(HasThreadSchedulingProfile("test_thread"));
+    EXPECT_TRUE(ApplyThreadSchedulingProfile("test_thread", linux_tid));
+
+    ASSERT_EQ(0, sched_getaffinity(linux_tid, sizeof(cpus), &cpus));
+    EXPECT_EQ(1, CPU_COUNT(&cpus));
+    EXPECT_TRUE(CPU_ISSET(cpu, &cpus));
+    EXPECT_EQ(1, getpriority(PRIO_PROCESS, linux_tid));
+  });
+  thread.join();
+}
@@ -33,6 +33,9 @@ uint64_t time_get_os_boottime_us();
 // Get the current wall clock time in microseconds.
 uint64_t time_gettimeofday_us();
 
+// Get the CPU time consumed by the calling thread in microseconds.
+uint64_t time_get_thread_cputime_us();
+
 }  // namespace common
 
 }  // namespace bluetooth
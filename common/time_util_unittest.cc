@@ -144,3 +144,24 @@ TEST(TimeTest, test_time_gettimeofday_us_increases_lower_bound) {
   ASSERT_TRUE((t2 - t1) >= TEST_TIME_SLEEP_US);
   ASSERT_TRUE((t2 - t1) < TEST_TIME_DELTA_UPPER_BOUND_MS * 1000);
 }
+
+//
+// Test that the return value of bluetooth::common::time_get_thread_cputime_us()
+// only counts the time the thread is running.
+//
+TEST(TimeTest, test_time_get_thread_cputime_us_excludes_sleep) {
+  static const uint64_t TEST_TIME_SLEEP_US = 100 * 1000;
+  struct timespec delay = {};
+
+  delay.tv_sec = TEST_TIME_SLEEP_US / (1000 * 1000);
+  delay.tv_nsec = 1000 * (TEST_TIME_SLEEP_US % (1000 * 1000));
+
+  // Take two timestamps with sleep in-between
+  uint64_t t1 = bluetooth::common::time_get_thread_cputime_us();
+  int err = nanosleep(&delay, &delay);
+  uint64_t t2 = bluetooth::common::time_get_thread_cputime_us();
+
+  ASSERT_EQ(err, 0);
+  ASSERT_GE(t2, t1);
+  ASSERT_TRUE((t2 - t1) < TEST_TIME_SLEEP_US);
+}
@@ -0,0 +1,201 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "common/trace.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <array>
+
+namespace bluetooth {
+
+namespace common {
+
+namespace {
+
+// Spans kept per thread, the oldest are overwritten
+constexpr size_t kTraceRingSize = 1024;
+// Threads that can record spans at the same time. The spans of any other
+// thread are only accounted for in the statistics of their tracepoint.
+constexpr size_t kMaxTraceRings = 16;
+
+struct TraceSpan {
+  std::atomic<const TracePoint*> trace_point{nullptr};
+  std::atomic<uint64_t> begin_us{0};
+  std::atomic<uint64_t> duration_us{0};
+  std::atomic<uint64_t> id{0};
+  std::atomic<int> tid{0};
+  // Number of the span in its ring plus one, 0 while it is written
+  std::atomic<uint64_t> seq{0};
+};
+
+// Written by its thread only, read by the dump, which checks the sequence
+// number of each span to skip those rewritten while being read
+struct TraceRing {
+  std::atomic<bool> in_use{true};
+  std::atomic<uint64_t> head{0};
+  std::array<TraceSpan, kTraceRingSize> spans;
+
+  void Write(const TracePoint* trace_point, uint64_t begin_us,
+             uint64_t duration_us, uint64_t id, int tid) {
+    uint64_t n = head.load(std::memory_order_relaxed);
+    TraceSpan& span = spans[n % kTraceRingSize];
+    span.seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    span.trace_point.store(trace_point, std::memory_order_relaxed);
+    span.begin_us.store(begin_us, std::memory_order_relaxed);
+    span.duration_us.store(duration_us, std::memory_order_relaxed);
+    span.id.store(id, std::memory_order_relaxed);
+    span.tid.store(tid, std::memory_order_relaxed);
+    span.seq.store(n + 1, std::memory_order_release);
+    head.store(n + 1, std::memory_order_release);
+  }
+};
+
+std::atomic<TracePoint*> trace_points{nullptr};
+std::array<std::atomic<TraceRing*>, kMaxTraceRings> trace_rings{};
+
+// Takes a ring released by an exited thread, or allocates a new one. Rings are
+// never freed.
+TraceRing* acquire_trace_ring() {
+  for (auto& slot : trace_rings) {
+    TraceRing* ring = slot.load(std::memory_order_acquire);
+    if (ring == nullptr) {
+      TraceRing* new_ring = new TraceRing();
+      if (slot.compare_exchange_strong(ring, new_ring,
+                                       std::memory_order_acq_rel)) {
+        return new_ring;
+      }
+      delete new_ring;
+    }
+    bool in_use = false;
+    if (ring->in_use.compare_exchange_strong(in_use, true,
+                                             std::memory_order_acq_rel)) {
+      return ring;
+    }
+  }
+  return nullptr;
+}
+
+struct ThreadTrace {
+  TraceRing* ring = acquire_trace_ring();
+  int tid = static_cast<int>(syscall(SYS_gettid));
+
+  ~ThreadTrace() {
+    if (ring) ring->in_use.store(false, std::memory_order_release);
+  }
+};
+
+}  // namespace
+
+TracePoint::TracePoint(const char* name)
+    : name_(name), next_(trace_points.load(std::memory_order_relaxed)) {
+  while (!trace_points.compare_exchange_weak(next_, this,
+                                             std::memory_order_release,
+                                             std::memory_order_relaxed)) {
+  }
+}
+
+void TracePoint::Record(uint64_t begin_us, uint64_t duration_us, uint64_t id) {
+  count_.fetch_add(1, std::memory_order_relaxed);
+  total_us_.fetch_add(duration_us, std::memory_order_relaxed);
+  uint64_t max_us = max_us_.load(std::memory_order_relaxed);
+  while (duration_us > max_us &&
+         !max_us_.compare_exchange_weak(max_us, duration_us,
+                                        std::memory_order_relaxed)) {
+  }
+
+  thread_local ThreadTrace thread_trace;
+  if (thread_trace.ring) {
+    thread_trace.ring->Write(this, begin_us, duration_us, id,
+                             thread_trace.tid);
+  }
+}
+
+void TraceDebugDump(int fd, bool with_spans) {
+  dprintf(fd, "\nHot path tracepoints:\n");
+  dprintf(fd, "  %-32s %10s %12s %10s %10s\n", "Name", "Count", "Total (ms)",
+          "Avg (us)", "Max (us)");
+  for (TracePoint* trace_point = trace_points.load(std::memory_order_acquire);
+       trace_point != nullptr; trace_point = trace_point->next_) {
+    uint64_t count = trace_point->count_.load(std::memory_order_relaxed);
+    uint64_t total_us = trace_point->total_us_.load(std::memory_order_relaxed);
+    dprintf(fd, "  %-32s %10" PRIu64 " %12" PRIu64 " %10" PRIu64 " %10" PRIu64
+            "\n",
+            trace_point->name(), count, total_us / 1000,
+            count ? total_us / count : 0,
+            trace_point->max_us_.load(std::memory_order_relaxed));
+  }
+
+  if (!with_spans) return;
+
+  dprintf(fd, "  Spans, in the JSON trace event format:\n");
+  dprintf(fd, "{\"traceEvents\":[\n");
+  const char* separator = "";
+  int pid = getpid();
+  for (auto& slot : trace_rings) {
+    TraceRing* ring = slot.load(std::memory_order_acquire);
+    if (ring == nullptr) continue;
+    uint64_t head = ring->head.load(std::memory_order_acquire);
+    uint64_t n = head > kTraceRingSize ? head - kTraceRingSize : 0;
+    for (; n < head; n++) {
+      const TraceSpan& span = ring->spans[n % kTraceRingSize];
+      uint64_t seq = span.seq.load(std::memory_order_acquire);
+      const TracePoint* trace_point =
+          span.trace_point.load(std::memory_order_relaxed);
+      uint64_t begin_us = span.begin_us.load(std::memory_order_relaxed);
+      uint64_t duration_us = span.duration_us.load(std::memory_order_relaxed);
+      uint64_t id = span.id.load(std::memory_order_relaxed);
+      int tid = span.tid.load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (seq != n + 1 || span.seq.load(std::memory_order_relaxed) != seq ||
+          trace_point == nullptr) {
+        continue;
+      }
+      dprintf(fd,
+              "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,"
+              "\"ts\":%" PRIu64 ",\"dur\":%" PRIu64
+              ",\"args\":{\"id\":\"0x%" PRIx64 "\"}}",
+              separator, trace_point->name(), pid, tid, begin_us, duration_us,
+              id);
+      separator = ",\n";
+    }
+  }
+  dprintf(fd, "\n]}\n");
+}
+
+void TraceReset() {
+  for (TracePoint* trace_point = trace_points.load(std::memory_order_acquire);
+       trace_point != nullptr; trace_point = trace_point->next_) {
+    trace_point->count_.store(0, std::memory_order_relaxed);
+    trace_point->total_us_.store(0, std::memory_order_relaxed);
+    trace_point->max_us_.store(0, std::memory_order_relaxed);
+  }
+  for (auto& slot : trace_rings) {
+    TraceRing* ring = slot.load(std::memory_order_acquire);
+    if (ring == nullptr) continue;
+    for (TraceSpan& span : ring->spans) {
+      span.seq.store(0, std::memory_order_relaxed);
+    }
+  }
+}
+
+}  // namespace common
+
+}  // namespace bluetooth
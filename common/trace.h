@@ -0,0 +1,122 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "common/time_util.h"
+
+/*
+ * Tracing of the hot paths of the stack.
+ *
+ * A tracepoint times the scope it is placed in:
+ *
+ *   void l2c_rcv_acl_data(BT_HDR* p_msg) {
+ *     BT_TRACE_SCOPE("l2c_rcv_acl_data", p_msg);
+ *     ...
+ *
+ * The second argument identifies what the scope works on, usually the packet
+ * buffer, so that one packet can be followed across the layers it goes
+ * through. The scopes a packet goes through on one thread nest.
+ *
+ * Each thread records its spans in its own ring buffer, without a lock, and
+ * every tracepoint keeps a count and the total and longest time of its spans.
+ * TraceDebugDump() writes both to dumpsys, the spans in the JSON trace event
+ * format that Perfetto and systrace load.
+ *
+ * Building with BT_TRACE_ENABLED set to 0 compiles the tracepoints out.
+ */
+#ifndef BT_TRACE_ENABLED
+#define BT_TRACE_ENABLED 1
+#endif
+
+namespace bluetooth {
+
+namespace common {
+
+/* A static tracepoint. Tracepoints live as long as the process. */
+class TracePoint {
+ public:
+  explicit TracePoint(const char* name);
+  TracePoint(const TracePoint&) = delete;
+  TracePoint& operator=(const TracePoint&) = delete;
+
+  /* Records a span of |duration_us| from |begin_us|, working on |id| */
+  void Record(uint64_t begin_us, uint64_t duration_us, uint64_t id);
+
+  const char* name() const { return name_; }
+
+ private:
+  friend void TraceDebugDump(int fd, bool with_spans);
+  friend void TraceReset();
+
+  const char* const name_;
+  std::atomic<uint64_t> count_{0};
+  std::atomic<uint64_t> total_us_{0};
+  std::atomic<uint64_t> max_us_{0};
+  TracePoint* next_;
+};
+
+/* Records a span of |trace_point| for its lifetime */
+class TraceScope {
+ public:
+  TraceScope(TracePoint* trace_point, uint64_t id)
+      : trace_point_(trace_point),
+        id_(id),
+        begin_us_(time_get_os_boottime_us()) {}
+  ~TraceScope() {
+    trace_point_->Record(begin_us_, time_get_os_boottime_us() - begin_us_,
+                         id_);
+  }
+  TraceScope(const TraceScope&) = delete;
+  TraceScope& operator=(const TraceScope&) = delete;
+
+ private:
+  TracePoint* const trace_point_;
+  const uint64_t id_;
+  const uint64_t begin_us_;
+};
+
+/*
+ * Writes the statistics of all tracepoints into |fd|, followed by the spans
+ * still held by the ring buffers if |with_spans| is true
+ */
+void TraceDebugDump(int fd, bool with_spans);
+
+/* Discards all spans and statistics, for tests */
+void TraceReset();
+
+}  // namespace common
+
+}  // namespace bluetooth
+
+#define BT_TRACE_CONCAT_(a, b) a##b
+#define BT_TRACE_CONCAT(a, b) BT_TRACE_CONCAT_(a, b)
+
+#if BT_TRACE_ENABLED
+#define BT_TRACE_SCOPE(name, id)                                       \
+  static ::bluetooth::common::TracePoint BT_TRACE_CONCAT(              \
+      bt_trace_point_, __LINE__)(name);                                \
+  ::bluetooth::common::TraceScope BT_TRACE_CONCAT(bt_trace_scope_,     \
+                                                  __LINE__)(           \
+      &BT_TRACE_CONCAT(bt_trace_point_, __LINE__), (uint64_t)(uintptr_t)(id))
+#else
+#define BT_TRACE_SCOPE(name, id) \
+  do {                           \
+  } while (0)
+#endif
@@ -0,0 +1,133 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/trace.h"
+
+namespace {
+
+using bluetooth::common::TraceDebugDump;
+using bluetooth::common::TraceReset;
+
+std::string Dump(bool with_spans) {
+  FILE* file = tmpfile();
+  TraceDebugDump(fileno(file), with_spans);
+  std::string output;
+  char buffer[4096];
+  rewind(file);
+  size_t read;
+  while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    output.append(buffer, read);
+  }
+  fclose(file);
+  return output;
+}
+
+size_t Count(const std::string& text, const std::string& pattern) {
+  size_t count = 0;
+  for (size_t pos = text.find(pattern); pos != std::string::npos;
+       pos = text.find(pattern, pos + 1)) {
+    count++;
+  }
+  return count;
+}
+
+void Inner(uint64_t id) { BT_TRACE_SCOPE("trace_test_inner", id); }
+
+void Outer(uint64_t id) {
+  BT_TRACE_SCOPE("trace_test_outer", id);
+  Inner(id);
+  usleep(1000);
+}
+
+class TraceTest : public ::testing::Test {
+ protected:
+  void SetUp() override { TraceReset(); }
+};
+
+TEST_F(TraceTest, statistics_count_each_span) {
+  for (int i = 0; i < 3; i++) Outer(i);
+
+  std::string dump = Dump(false);
+  EXPECT_NE(dump.find("trace_test_outer"), std::string::npos);
+  EXPECT_NE(dump.find("trace_test_inner"), std::string::npos);
+  EXPECT_EQ(dump.find("traceEvents"), std::string::npos);
+
+  size_t line = dump.find("trace_test_outer");
+  unsigned long long count, total_ms, avg_us, max_us;
+  ASSERT_EQ(sscanf(dump.c_str() + line, "trace_test_outer %llu %llu %llu %llu",
+                   &count, &total_ms, &avg_us, &max_us),
+            4);
+  EXPECT_EQ(count, 3u);
+  EXPECT_GE(avg_us, 1000u);
+  EXPECT_GE(max_us, avg_us);
+}
+
+TEST_F(TraceTest, spans_nest_and_carry_their_id) {
+  Outer(0xabc);
+
+  std::string dump = Dump(true);
+  EXPECT_EQ(Count(dump, "\"name\":\"trace_test_outer\""), 1u);
+  EXPECT_EQ(Count(dump, "\"name\":\"trace_test_inner\""), 1u);
+  EXPECT_EQ(Count(dump, "\"id\":\"0xabc\""), 2u);
+
+  // The inner span is recorded first, as it ends first, and lies within the
+  // outer one
+  unsigned long long inner_ts, inner_dur, outer_ts, outer_dur;
+  size_t inner = dump.find("\"name\":\"trace_test_inner\"");
+  size_t outer = dump.find("\"name\":\"trace_test_outer\"");
+  ASSERT_LT(inner, outer);
+  ASSERT_EQ(sscanf(dump.c_str() + dump.find("\"ts\":", inner),
+                   "\"ts\":%llu,\"dur\":%llu", &inner_ts, &inner_dur),
+            2);
+  ASSERT_EQ(sscanf(dump.c_str() + dump.find("\"ts\":", outer),
+                   "\"ts\":%llu,\"dur\":%llu", &outer_ts, &outer_dur),
+            2);
+  EXPECT_GE(inner_ts, outer_ts);
+  EXPECT_LE(inner_ts + inner_dur, outer_ts + outer_dur);
+}
+
+TEST_F(TraceTest, rings_keep_the_latest_spans_of_each_thread) {
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; i++) {
+    threads.emplace_back([]() {
+      for (int j = 0; j < 5000; j++) Inner(j);
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  std::string dump = Dump(true);
+  size_t spans = Count(dump, "\"name\":\"trace_test_inner\"");
+  EXPECT_GE(spans, 1024u);
+  EXPECT_LE(spans, 4u * 1024);
+  // The last span of each thread is kept, the first overwritten
+  EXPECT_GE(Count(dump, "\"id\":\"0x1387\""), 1u);
+  EXPECT_EQ(Count(dump, "\"id\":\"0x0\""), 0u);
+
+  size_t line = dump.find("trace_test_inner");
+  unsigned long long count;
+  ASSERT_EQ(sscanf(dump.c_str() + line, "trace_test_inner %llu", &count), 1);
+  EXPECT_EQ(count, 4u * 5000);
+}
+
+}  // namespace
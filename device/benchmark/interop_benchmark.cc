@@ -0,0 +1,57 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include "device/include/interop.h"
+
+using ::benchmark::State;
+
+namespace {
+
+// Adds |num_entries| dynamic entries, as many devices as a user may have
+// paired with over time
+void add_dynamic_entries(int num_entries) {
+  interop_database_clear();
+  for (int i = 0; i < num_entries; i++) {
+    RawAddress address = {{0xaa, 0xbb, (uint8_t)(i >> 8), (uint8_t)i, 0, 0}};
+    interop_database_add(INTEROP_DYNAMIC_ROLE_SWITCH, &address, 4);
+  }
+}
+
+// Only misses are measured: they are the common case, and a match is logged
+void BM_InteropMatchAddrMiss(State& state) {
+  add_dynamic_entries(state.range(0));
+  RawAddress address;
+  RawAddress::FromString("00:11:22:33:44:55", address);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        interop_match_addr(INTEROP_DYNAMIC_ROLE_SWITCH, &address));
+  }
+}
+BENCHMARK(BM_InteropMatchAddrMiss)->Arg(0)->Arg(100);
+
+void BM_InteropMatchNameMiss(State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        interop_match_name(INTEROP_DISABLE_AUTO_PAIRING, "Pixel Buds"));
+  }
+}
+BENCHMARK(BM_InteropMatchNameMiss);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -90,198 +90,299 @@ static bool ble_supported;
 static bool simple_pairing_supported;
 static bool secure_connections_supported;
 
-#define AWAIT_COMMAND(command) \
-  static_cast<BT_HDR*>(        \
-      future_await(local_hci->transmit_command_futured(command)))
+// Set once the capabilities above were read from a controller with
+// |capabilities_version|. They do not change until the controller firmware
+// does, so the next start up only reads the volatile state.
+static bool capabilities_cached;
+static bt_version_t capabilities_version;
+
+#define SEND_COMMAND(command) local_hci->transmit_command_futured(command)
+
+#define AWAIT_COMMAND(command) static_cast<BT_HDR*>(future_await(command))
+
+static bool is_same_version(const bt_version_t& a, const bt_version_t& b) {
+  return a.hci_version == b.hci_version && a.hci_revision == b.hci_revision &&
+         a.lmp_version == b.lmp_version && a.manufacturer == b.manufacturer &&
+         a.lmp_subversion == b.lmp_subversion;
+}
+
+// Reads the classic capabilities that are needed before the host features
+// are written
+static void read_classic_capabilities(void) {
+  future_t* supported_commands_future =
+      SEND_COMMAND(packet_factory->make_read_local_supported_commands());
+  future_t* buffer_size_future =
+      SEND_COMMAND(packet_factory->make_read_buffer_size());
+  future_t* features_future =
+      SEND_COMMAND(packet_factory->make_read_local_extended_features(0));
+
+  BT_HDR* response = AWAIT_COMMAND(supported_commands_future);
+  packet_parser->parse_read_local_supported_commands_response(
+      response, supported_commands, HCI_SUPPORTED_COMMANDS_ARRAY_SIZE);
+#if (BTM_SCO_ENHANCED_SYNC_ENABLED == FALSE)
+  supported_commands[29] &= ~0x08;
+#endif
+
+  response = AWAIT_COMMAND(buffer_size_future);
+  packet_parser->parse_read_buffer_size_response(
+      response, &acl_data_size_classic, &acl_buffer_count_classic);
+
+  // Read page 0 of the controller features
+  uint8_t page_number = 0;
+  response = AWAIT_COMMAND(features_future);
+  packet_parser->parse_read_local_extended_features_response(
+      response, &page_number, &last_features_classic_page_index,
+      features_classic, MAX_FEATURES_CLASSIC_PAGE_COUNT);
+  CHECK(page_number == 0);
+}
+
+// Reads the remaining feature pages, which reflect what the host wrote based
+// on page 0
+static void read_extended_feature_pages(void) {
+  // Pages share an opcode, so they are read one at a time
+  uint8_t page_number = 1;
+  while (page_number <= last_features_classic_page_index &&
+         page_number < MAX_FEATURES_CLASSIC_PAGE_COUNT) {
+    BT_HDR* response = AWAIT_COMMAND(SEND_COMMAND(
+        packet_factory->make_read_local_extended_features(page_number)));
+    packet_parser->parse_read_local_extended_features_response(
+        response, &page_number, &last_features_classic_page_index,
+        features_classic, MAX_FEATURES_CLASSIC_PAGE_COUNT);
+
+    page_number++;
+  }
+}
+
+static void read_ble_capabilities(void) {
+  future_t* white_list_size_future =
+      SEND_COMMAND(packet_factory->make_ble_read_white_list_size());
+  future_t* buffer_size_future =
+      SEND_COMMAND(packet_factory->make_ble_read_buffer_size());
+  future_t* supported_states_future =
+      SEND_COMMAND(packet_factory->make_ble_read_supported_states());
+  future_t* features_future =
+      SEND_COMMAND(packet_factory->make_ble_read_local_supported_features());
+
+  BT_HDR* response = AWAIT_COMMAND(white_list_size_future);
+  packet_parser->parse_ble_read_white_list_size_response(response,
+                                                         &ble_white_list_size);
+
+  response = AWAIT_COMMAND(buffer_size_future);
+  packet_parser->parse_ble_read_buffer_size_response(
+      response, &acl_data_size_ble, &acl_buffer_count_ble);
+
+  // Response of 0 indicates ble has the same buffer size as classic
+  if (acl_data_size_ble == 0) acl_data_size_ble = acl_data_size_classic;
+
+  response = AWAIT_COMMAND(supported_states_future);
+  packet_parser->parse_ble_read_supported_states_response(
+      response, ble_supported_states, sizeof(ble_supported_states));
+
+  response = AWAIT_COMMAND(features_future);
+  packet_parser->parse_ble_read_local_supported_features_response(
+      response, &features_ble);
+
+  // The remaining reads depend on the ble supported features
+  future_t* resolving_list_size_future = NULL;
+  if (HCI_LE_ENHANCED_PRIVACY_SUPPORTED(features_ble.as_array)) {
+    resolving_list_size_future =
+        SEND_COMMAND(packet_factory->make_ble_read_resolving_list_size());
+  }
+
+  future_t* maximum_data_length_future = NULL;
+  future_t* suggested_default_data_length_future = NULL;
+  if (HCI_LE_DATA_LEN_EXT_SUPPORTED(features_ble.as_array)) {
+    maximum_data_length_future =
+        SEND_COMMAND(packet_factory->make_ble_read_maximum_data_length());
+    suggested_default_data_length_future = SEND_COMMAND(
+        packet_factory->make_ble_read_suggested_default_data_length());
+  }
+
+  future_t* maximum_advertising_data_length_future = NULL;
+  future_t* number_of_advertising_sets_future = NULL;
+  if (HCI_LE_EXTENDED_ADVERTISING_SUPPORTED(features_ble.as_array)) {
+    maximum_advertising_data_length_future = SEND_COMMAND(
+        packet_factory->make_ble_read_maximum_advertising_data_length());
+    number_of_advertising_sets_future = SEND_COMMAND(
+        packet_factory->make_ble_read_number_of_supported_advertising_sets());
+  }
+
+  if (resolving_list_size_future != NULL) {
+    response = AWAIT_COMMAND(resolving_list_size_future);
+    packet_parser->parse_ble_read_resolving_list_size_response(
+        response, &ble_resolving_list_max_size);
+  }
+
+  if (maximum_data_length_future != NULL) {
+    response = AWAIT_COMMAND(maximum_data_length_future);
+    packet_parser->parse_ble_read_maximum_data_length_response(
+        response, &ble_supported_max_tx_octets, &ble_supported_max_tx_time,
+        &ble_supported_max_rx_octets, &ble_supported_max_rx_time);
+
+    response = AWAIT_COMMAND(suggested_default_data_length_future);
+    packet_parser->parse_ble_read_suggested_default_data_length_response(
+        response, &ble_suggested_default_data_length);
+  }
+
+  if (maximum_advertising_data_length_future != NULL) {
+    response = AWAIT_COMMAND(maximum_advertising_data_length_future);
+    packet_parser->parse_ble_read_maximum_advertising_data_length(
+        response, &ble_maxium_advertising_data_length);
+
+    response = AWAIT_COMMAND(number_of_advertising_sets_future);
+    packet_parser->parse_ble_read_number_of_supported_advertising_sets(
+        response, &ble_number_of_supported_advertising_sets);
+  } else {
+    /* If LE Excended Advertising is not supported, use the default value */
+    ble_maxium_advertising_data_length = 31;
+  }
+}
+
+static void read_local_supported_codecs(void) {
+  if (HCI_READ_LOCAL_CODECS_SUPPORTED(supported_commands)) {
+    BT_HDR* response = AWAIT_COMMAND(
+        SEND_COMMAND(packet_factory->make_read_local_supported_codecs()));
+    packet_parser->parse_read_local_supported_codecs_response(
+        response, &number_of_local_supported_codecs, local_supported_codecs);
+  }
+}
 
 // Module lifecycle functions
 
+// Independent commands are sent together and only awaited when their result
+// is needed, so the controller can process them as its command credits allow.
 static future_t* start_up(void) {
   BT_HDR* response;
 
   // Send the initial reset command
-  response = AWAIT_COMMAND(packet_factory->make_reset());
+  response = AWAIT_COMMAND(SEND_COMMAND(packet_factory->make_reset()));
   packet_parser->parse_generic_command_complete(response);
 
-  // Request the classic buffer size next
-  response = AWAIT_COMMAND(packet_factory->make_read_buffer_size());
-  packet_parser->parse_read_buffer_size_response(
-      response, &acl_data_size_classic, &acl_buffer_count_classic);
-
-  // Tell the controller about our buffer sizes and buffer counts next
+  // Tell the controller about our buffer sizes and buffer counts, while
+  // reading the local version info, including information such as
+  // manufacturer and supported HCI version, and the bluetooth address
   // TODO(zachoverflow): factor this out. eww l2cap contamination. And why just
   // a hardcoded 10?
-  response = AWAIT_COMMAND(packet_factory->make_host_buffer_size(
-      L2CAP_MTU_SIZE, SCO_HOST_BUFFER_SIZE, L2CAP_HOST_FC_ACL_BUFS, 10));
-
+  future_t* host_buffer_size_future =
+      SEND_COMMAND(packet_factory->make_host_buffer_size(
+          L2CAP_MTU_SIZE, SCO_HOST_BUFFER_SIZE, L2CAP_HOST_FC_ACL_BUFS, 10));
+  future_t* version_future =
+      SEND_COMMAND(packet_factory->make_read_local_version_info());
+  future_t* address_future = SEND_COMMAND(packet_factory->make_read_bd_addr());
+
+  response = AWAIT_COMMAND(host_buffer_size_future);
   packet_parser->parse_generic_command_complete(response);
 
-  // Read the local version info off the controller next, including
-  // information such as manufacturer and supported HCI version
-  response = AWAIT_COMMAND(packet_factory->make_read_local_version_info());
+  response = AWAIT_COMMAND(version_future);
   packet_parser->parse_read_local_version_info_response(response, &bt_version);
 
-  // Read the bluetooth address off the controller next
-  response = AWAIT_COMMAND(packet_factory->make_read_bd_addr());
+  response = AWAIT_COMMAND(address_future);
   packet_parser->parse_read_bd_addr_response(response, &address);
 
-  // Request the controller's supported commands next
-  response =
-      AWAIT_COMMAND(packet_factory->make_read_local_supported_commands());
-  packet_parser->parse_read_local_supported_commands_response(
-      response, supported_commands, HCI_SUPPORTED_COMMANDS_ARRAY_SIZE);
-#if (BTM_SCO_ENHANCED_SYNC_ENABLED == FALSE)
-  supported_commands[29] &= ~0x08;
-#endif
-
-  // Read page 0 of the controller features next
-  uint8_t page_number = 0;
-  response = AWAIT_COMMAND(
-      packet_factory->make_read_local_extended_features(page_number));
-  packet_parser->parse_read_local_extended_features_response(
-      response, &page_number, &last_features_classic_page_index,
-      features_classic, MAX_FEATURES_CLASSIC_PAGE_COUNT);
-
-  CHECK(page_number == 0);
-  page_number++;
+  bool use_cached_capabilities =
+      capabilities_cached && is_same_version(capabilities_version, bt_version);
+  if (use_cached_capabilities) {
+    LOG(INFO) << __func__ << ": using the cached controller capabilities";
+  } else {
+    capabilities_cached = false;
+    read_classic_capabilities();
+  }
 
   // Inform the controller what page 0 features we support, based on what
   // it told us it supports. We need to do this first before we request the
   // next page, because the controller's response for page 1 may be
   // dependent on what we configure from page 0
+  future_t* simple_pairing_future = NULL;
   simple_pairing_supported =
       HCI_SIMPLE_PAIRING_SUPPORTED(features_classic[0].as_array);
   if (simple_pairing_supported) {
-    response = AWAIT_COMMAND(
+    simple_pairing_future = SEND_COMMAND(
         packet_factory->make_write_simple_pairing_mode(HCI_SP_MODE_ENABLED));
-    packet_parser->parse_generic_command_complete(response);
   }
 
+  future_t* le_host_support_future = NULL;
   if (HCI_LE_SPT_SUPPORTED(features_classic[0].as_array)) {
     uint8_t simultaneous_le_host =
         HCI_SIMUL_LE_BREDR_SUPPORTED(features_classic[0].as_array)
             ? BTM_BLE_SIMULTANEOUS_HOST
             : 0;
-    response = AWAIT_COMMAND(packet_factory->make_ble_write_host_support(
-        BTM_BLE_HOST_SUPPORT, simultaneous_le_host));
-
-    packet_parser->parse_generic_command_complete(response);
+    le_host_support_future =
+        SEND_COMMAND(packet_factory->make_ble_write_host_support(
+            BTM_BLE_HOST_SUPPORT, simultaneous_le_host));
 
     // If we modified the BT_HOST_SUPPORT, we will need ext. feat. page 1
     if (last_features_classic_page_index < 1)
       last_features_classic_page_index = 1;
   }
 
-  // Done telling the controller about what page 0 features we support
-  // Request the remaining feature pages
-  while (page_number <= last_features_classic_page_index &&
-         page_number < MAX_FEATURES_CLASSIC_PAGE_COUNT) {
-    response = AWAIT_COMMAND(
-        packet_factory->make_read_local_extended_features(page_number));
-    packet_parser->parse_read_local_extended_features_response(
-        response, &page_number, &last_features_classic_page_index,
-        features_classic, MAX_FEATURES_CLASSIC_PAGE_COUNT);
+  if (simple_pairing_future != NULL) {
+    response = AWAIT_COMMAND(simple_pairing_future);
+    packet_parser->parse_generic_command_complete(response);
+  }
 
-    page_number++;
+  if (le_host_support_future != NULL) {
+    response = AWAIT_COMMAND(le_host_support_future);
+    packet_parser->parse_generic_command_complete(response);
   }
 
+  // Done telling the controller about what page 0 features we support
+  // Request the remaining feature pages. The host writes above are the same
+  // for the same page 0, so the cached pages still hold.
+  if (!use_cached_capabilities) read_extended_feature_pages();
+
 #if (SC_MODE_INCLUDED == TRUE)
   secure_connections_supported =
       HCI_SC_CTRLR_SUPPORTED(features_classic[2].as_array);
+  future_t* secure_connections_future = NULL;
   if (secure_connections_supported) {
-    response = AWAIT_COMMAND(
-        packet_factory->make_write_secure_connections_host_support(
+    secure_connections_future =
+        SEND_COMMAND(packet_factory->make_write_secure_connections_host_support(
             HCI_SC_MODE_ENABLED));
-    packet_parser->parse_generic_command_complete(response);
   }
 #endif
 
   ble_supported = last_features_classic_page_index >= 1 &&
                   HCI_LE_HOST_SUPPORTED(features_classic[1].as_array);
+  if (ble_supported && !use_cached_capabilities) read_ble_capabilities();
+  if (!use_cached_capabilities) read_local_supported_codecs();
+
+  // Set the event masks last
+  future_t* ble_event_mask_future = NULL;
   if (ble_supported) {
-    // Request the ble white list size next
-    response = AWAIT_COMMAND(packet_factory->make_ble_read_white_list_size());
-    packet_parser->parse_ble_read_white_list_size_response(
-        response, &ble_white_list_size);
-
-    // Request the ble buffer size next
-    response = AWAIT_COMMAND(packet_factory->make_ble_read_buffer_size());
-    packet_parser->parse_ble_read_buffer_size_response(
-        response, &acl_data_size_ble, &acl_buffer_count_ble);
-
-    // Response of 0 indicates ble has the same buffer size as classic
-    if (acl_data_size_ble == 0) acl_data_size_ble = acl_data_size_classic;
-
-    // Request the ble supported states next
-    response = AWAIT_COMMAND(packet_factory->make_ble_read_supported_states());
-    packet_parser->parse_ble_read_supported_states_response(
-        response, ble_supported_states, sizeof(ble_supported_states));
-
-    // Request the ble supported features next
-    response =
-        AWAIT_COMMAND(packet_factory->make_ble_read_local_supported_features());
-    packet_parser->parse_ble_read_local_supported_features_response(
-        response, &features_ble);
-
-    if (HCI_LE_ENHANCED_PRIVACY_SUPPORTED(features_ble.as_array)) {
-      response =
-          AWAIT_COMMAND(packet_factory->make_ble_read_resolving_list_size());
-      packet_parser->parse_ble_read_resolving_list_size_response(
-          response, &ble_resolving_list_max_size);
-    }
-
-    if (HCI_LE_DATA_LEN_EXT_SUPPORTED(features_ble.as_array)) {
-      response =
-          AWAIT_COMMAND(packet_factory->make_ble_read_maximum_data_length());
-      packet_parser->parse_ble_read_maximum_data_length_response(
-          response, &ble_supported_max_tx_octets, &ble_supported_max_tx_time,
-          &ble_supported_max_rx_octets, &ble_supported_max_rx_time);
-
-      response = AWAIT_COMMAND(
-          packet_factory->make_ble_read_suggested_default_data_length());
-      packet_parser->parse_ble_read_suggested_default_data_length_response(
-          response, &ble_suggested_default_data_length);
-    }
-
-    if (HCI_LE_EXTENDED_ADVERTISING_SUPPORTED(features_ble.as_array)) {
-      response = AWAIT_COMMAND(
-          packet_factory->make_ble_read_maximum_advertising_data_length());
-      packet_parser->parse_ble_read_maximum_advertising_data_length(
-          response, &ble_maxium_advertising_data_length);
-
-      response = AWAIT_COMMAND(
-          packet_factory->make_ble_read_number_of_supported_advertising_sets());
-      packet_parser->parse_ble_read_number_of_supported_advertising_sets(
-          response, &ble_number_of_supported_advertising_sets);
-    } else {
-      /* If LE Excended Advertising is not supported, use the default value */
-      ble_maxium_advertising_data_length = 31;
-    }
-
-    // Set the ble event mask next
-    response =
-        AWAIT_COMMAND(packet_factory->make_ble_set_event_mask(&BLE_EVENT_MASK));
-    packet_parser->parse_generic_command_complete(response);
+    ble_event_mask_future =
+        SEND_COMMAND(packet_factory->make_ble_set_event_mask(&BLE_EVENT_MASK));
   }
 
+  future_t* event_mask_future = NULL;
   if (simple_pairing_supported) {
-    response =
-        AWAIT_COMMAND(packet_factory->make_set_event_mask(&CLASSIC_EVENT_MASK));
+    event_mask_future =
+        SEND_COMMAND(packet_factory->make_set_event_mask(&CLASSIC_EVENT_MASK));
+  }
+
+#if (SC_MODE_INCLUDED == TRUE)
+  if (secure_connections_future != NULL) {
+    response = AWAIT_COMMAND(secure_connections_future);
     packet_parser->parse_generic_command_complete(response);
   }
+#endif
 
-  // read local supported codecs
-  if (HCI_READ_LOCAL_CODECS_SUPPORTED(supported_commands)) {
-    response =
-        AWAIT_COMMAND(packet_factory->make_read_local_supported_codecs());
-    packet_parser->parse_read_local_supported_codecs_response(
-        response, &number_of_local_supported_codecs, local_supported_codecs);
+  if (ble_event_mask_future != NULL) {
+    response = AWAIT_COMMAND(ble_event_mask_future);
+    packet_parser->parse_generic_command_complete(response);
+  }
+
+  if (event_mask_future != NULL) {
+    response = AWAIT_COMMAND(event_mask_future);
+    packet_parser->parse_generic_command_complete(response);
   }
 
   if (!HCI_READ_ENCR_KEY_SIZE_SUPPORTED(supported_commands)) {
     LOG(FATAL) << " Controller must support Read Encryption Key Size command";
   }
 
+  capabilities_cached = true;
+  capabilities_version = bt_version;
+
   readable = true;
   return future_new_immediate(FUTURE_SUCCESS);
 }
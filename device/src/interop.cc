@@ -19,28 +19,55 @@
 #define LOG_TAG "bt_device_interop"
 
 #include <base/logging.h>
-#include <string.h>  // For memcmp
+#include <string.h>
+
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include "btcore/include/module.h"
 #include "device/include/interop.h"
 #include "device/include/interop_database.h"
-#include "osi/include/allocator.h"
-#include "osi/include/list.h"
 #include "osi/include/log.h"
 
 #define CASE_RETURN_STR(const) \
   case const:                  \
     return #const;
 
-static list_t* interop_list = NULL;
+// A node of the name trie. The children of a node are chained through
+// |next_sibling|; |terminal| is set if an entry ends at the node.
+typedef struct {
+  char c;
+  bool terminal;
+  int32_t first_child;
+  int32_t next_sibling;
+} interop_name_node_t;
+
+// The fixed and the dynamic entries, indexed when first needed. An address
+// entry is keyed by its feature, length and prefix, so a lookup hashes the
+// address once for each prefix length present. Each feature with name entries
+// has its own trie, which a lookup walks along the name.
+typedef struct {
+  std::unordered_set<uint64_t> addr_prefixes;
+  uint32_t addr_lengths;  // Bit n is set when an entry has length n
+  std::vector<interop_name_node_t> name_nodes;
+  std::unordered_map<uint16_t, int32_t> name_roots;
+} interop_index_t;
+
+static std::mutex interop_mutex;
+static interop_index_t* interop_index = NULL;
 
 static const char* interop_feature_string_(const interop_feature_t feature);
-static void interop_free_entry_(void* data);
 static void interop_lazy_init_(void);
-static bool interop_match_fixed_(const interop_feature_t feature,
-                                 const RawAddress* addr);
-static bool interop_match_dynamic_(const interop_feature_t feature,
-                                   const RawAddress* addr);
+static void interop_index_add_addr_(uint16_t feature, const RawAddress* addr,
+                                    size_t length);
+static void interop_index_add_name_(uint16_t feature, const char* name,
+                                    size_t length);
+static bool interop_match_addr_(const interop_feature_t feature,
+                                const RawAddress* addr);
+static bool interop_match_name_(const interop_feature_t feature,
+                                const char* name);
 
 // Interface functions
 
@@ -48,8 +75,7 @@ bool interop_match_addr(const interop_feature_t feature,
                         const RawAddress* addr) {
   CHECK(addr);
 
-  if (interop_match_fixed_(feature, addr) ||
-      interop_match_dynamic_(feature, addr)) {
+  if (interop_match_addr_(feature, addr)) {
     LOG_INFO(LOG_TAG, "%s() Device %s is a match for interop workaround %s.",
              __func__, addr->ToString().c_str(),
              interop_feature_string_(feature));
@@ -62,17 +88,10 @@ bool interop_match_addr(const interop_feature_t feature,
 bool interop_match_name(const interop_feature_t feature, const char* name) {
   CHECK(name);
 
-  const size_t db_size =
-      sizeof(interop_name_database) / sizeof(interop_name_entry_t);
-  for (size_t i = 0; i != db_size; ++i) {
-    if (feature == interop_name_database[i].feature &&
-        strlen(name) >= interop_name_database[i].length &&
-        strncmp(name, interop_name_database[i].name,
-                interop_name_database[i].length) == 0) {
-      LOG_INFO(LOG_TAG, "%s() Device %s is a match for interop workaround %s.",
+  if (interop_match_name_(feature, name)) {
+    LOG_INFO(LOG_TAG, "%s() Device %s is a match for interop workaround %s.",
              __func__, name, interop_feature_string_(feature));
-      return true;
-    }
+    return true;
   }
 
   return false;
@@ -84,25 +103,23 @@ void interop_database_add(uint16_t feature, const RawAddress* addr,
   CHECK(length > 0);
   CHECK(length < RawAddress::kLength);
 
-  interop_addr_entry_t* entry = static_cast<interop_addr_entry_t*>(
-      osi_calloc(sizeof(interop_addr_entry_t)));
-  memcpy(&entry->addr, addr, length);
-  entry->feature = static_cast<interop_feature_t>(feature);
-  entry->length = length;
-
+  std::lock_guard<std::mutex> lock(interop_mutex);
   interop_lazy_init_();
-  list_append(interop_list, entry);
+  interop_index_add_addr_(feature, addr, length);
 }
 
 void interop_database_clear() {
-  if (interop_list) list_clear(interop_list);
+  // The dynamic entries are merged with the fixed ones, so the index is built
+  // again from the fixed entries only
+  std::lock_guard<std::mutex> lock(interop_mutex);
+  delete interop_index;
+  interop_index = NULL;
 }
 
 // Module life-cycle functions
 
 static future_t* interop_clean_up(void) {
-  list_free(interop_list);
-  interop_list = NULL;
+  interop_database_clear();
   return future_new_immediate(FUTURE_SUCCESS);
 }
 
@@ -139,49 +156,101 @@ static const char* interop_feature_string_(const interop_feature_t feature) {
   return "UNKNOWN";
 }
 
-static void interop_free_entry_(void* data) {
-  interop_addr_entry_t* entry = (interop_addr_entry_t*)data;
-  osi_free(entry);
+// Returns the key of the first |length| bytes of |addr| for |feature|
+static uint64_t interop_addr_key_(uint16_t feature, const RawAddress* addr,
+                                  size_t length) {
+  uint64_t key = (uint64_t)feature << 48 | (uint64_t)length << 40;
+  for (size_t i = 0; i != length; ++i) {
+    key |= (uint64_t)addr->address[i] << (32 - 8 * i);
+  }
+  return key;
 }
 
-static void interop_lazy_init_(void) {
-  if (interop_list == NULL) {
-    interop_list = list_new(interop_free_entry_);
-  }
+static void interop_index_add_addr_(uint16_t feature, const RawAddress* addr,
+                                    size_t length) {
+  CHECK(length > 0 && length < RawAddress::kLength);
+  interop_index->addr_prefixes.insert(interop_addr_key_(feature, addr, length));
+  interop_index->addr_lengths |= 1 << length;
 }
 
-static bool interop_match_dynamic_(const interop_feature_t feature,
-                                   const RawAddress* addr) {
-  if (interop_list == NULL || list_length(interop_list) == 0) return false;
+static int32_t interop_name_child_(int32_t node, char c) {
+  const std::vector<interop_name_node_t>& nodes = interop_index->name_nodes;
+  int32_t child = nodes[node].first_child;
+  while (child != -1 && nodes[child].c != c) child = nodes[child].next_sibling;
+  return child;
+}
 
-  const list_node_t* node = list_begin(interop_list);
-  while (node != list_end(interop_list)) {
-    interop_addr_entry_t* entry =
-        static_cast<interop_addr_entry_t*>(list_node(node));
-    CHECK(entry);
+static int32_t interop_name_new_node_(char c) {
+  interop_index->name_nodes.push_back({c, false, -1, -1});
+  return interop_index->name_nodes.size() - 1;
+}
 
-    if (feature == entry->feature &&
-        memcmp(addr, &entry->addr, entry->length) == 0)
-      return true;
+static void interop_index_add_name_(uint16_t feature, const char* name,
+                                    size_t length) {
+  auto root = interop_index->name_roots.find(feature);
+  if (root == interop_index->name_roots.end()) {
+    root = interop_index->name_roots
+               .emplace(feature, interop_name_new_node_('\0'))
+               .first;
+  }
 
-    node = list_next(node);
+  int32_t node = root->second;
+  for (size_t i = 0; i != length; ++i) {
+    int32_t child = interop_name_child_(node, name[i]);
+    if (child == -1) {
+      child = interop_name_new_node_(name[i]);
+      std::vector<interop_name_node_t>& nodes = interop_index->name_nodes;
+      nodes[child].next_sibling = nodes[node].first_child;
+      nodes[node].first_child = child;
+    }
+    node = child;
   }
-  return false;
+  interop_index->name_nodes[node].terminal = true;
 }
 
-static bool interop_match_fixed_(const interop_feature_t feature,
-                                 const RawAddress* addr) {
-  CHECK(addr);
+static void interop_lazy_init_(void) {
+  if (interop_index != NULL) return;
+
+  interop_index = new interop_index_t();
+  interop_index->addr_lengths = 0;
+  for (const interop_addr_entry_t& entry : interop_addr_database) {
+    interop_index_add_addr_(entry.feature, &entry.addr, entry.length);
+  }
+  for (const interop_name_entry_t& entry : interop_name_database) {
+    interop_index_add_name_(entry.feature, entry.name, entry.length);
+  }
+}
+
+static bool interop_match_addr_(const interop_feature_t feature,
+                                const RawAddress* addr) {
+  std::lock_guard<std::mutex> lock(interop_mutex);
+  interop_lazy_init_();
 
-  const size_t db_size =
-      sizeof(interop_addr_database) / sizeof(interop_addr_entry_t);
-  for (size_t i = 0; i != db_size; ++i) {
-    if (feature == interop_addr_database[i].feature &&
-        memcmp(addr, &interop_addr_database[i].addr,
-               interop_addr_database[i].length) == 0) {
+  for (size_t length = 1; length != RawAddress::kLength; ++length) {
+    if ((interop_index->addr_lengths & (1 << length)) &&
+        interop_index->addr_prefixes.count(
+            interop_addr_key_(feature, addr, length)) != 0) {
       return true;
     }
   }
 
   return false;
 }
+
+static bool interop_match_name_(const interop_feature_t feature,
+                                const char* name) {
+  std::lock_guard<std::mutex> lock(interop_mutex);
+  interop_lazy_init_();
+
+  auto root = interop_index->name_roots.find(feature);
+  if (root == interop_index->name_roots.end()) return false;
+
+  // Any entry ending on the way is a prefix of |name|
+  int32_t node = root->second;
+  for (const char* p = name;; ++p) {
+    if (interop_index->name_nodes[node].terminal) return true;
+    if (*p == '\0') return false;
+    node = interop_name_child_(node, *p);
+    if (node == -1) return false;
+  }
+}
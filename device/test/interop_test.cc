@@ -80,3 +80,47 @@ TEST(InteropTest, test_name_miss) {
   EXPECT_FALSE(interop_match_name(INTEROP_DISABLE_AUTO_PAIRING, "audi"));
   EXPECT_FALSE(interop_match_name(INTEROP_AUTO_RETRY_PAIRING, "BMW M3"));
 }
+
+TEST(InteropTest, test_dynamic_prefix_length) {
+  RawAddress test_address;
+  RawAddress::FromString("11:22:33:44:55:66", test_address);
+  interop_database_add(INTEROP_DISABLE_SNIFF, &test_address, 5);
+  EXPECT_TRUE(interop_match_addr(INTEROP_DISABLE_SNIFF, &test_address));
+
+  // Only the first five bytes are compared
+  RawAddress::FromString("11:22:33:44:55:00", test_address);
+  EXPECT_TRUE(interop_match_addr(INTEROP_DISABLE_SNIFF, &test_address));
+  RawAddress::FromString("11:22:33:44:00:66", test_address);
+  EXPECT_FALSE(interop_match_addr(INTEROP_DISABLE_SNIFF, &test_address));
+
+  interop_database_clear();
+  RawAddress::FromString("11:22:33:44:55:66", test_address);
+  EXPECT_FALSE(interop_match_addr(INTEROP_DISABLE_SNIFF, &test_address));
+}
+
+TEST(InteropTest, test_clear_keeps_fixed) {
+  RawAddress test_address;
+  RawAddress::FromString("38:2c:4a:e6:67:89", test_address);
+  interop_database_add(INTEROP_DISABLE_LE_SECURE_CONNECTIONS, &test_address, 3);
+  interop_database_clear();
+  EXPECT_TRUE(
+      interop_match_addr(INTEROP_DISABLE_LE_SECURE_CONNECTIONS, &test_address));
+  RawAddress::FromString("38:2c:4a:59:67:89", test_address);
+  EXPECT_FALSE(
+      interop_match_addr(INTEROP_DISABLE_LE_SECURE_CONNECTIONS, &test_address));
+}
+
+TEST(InteropTest, test_name_prefixes) {
+  EXPECT_TRUE(interop_match_name(INTEROP_GATTC_NO_SERVICE_CHANGED_IND,
+                                 "Pixel C Keyboard"));
+  EXPECT_FALSE(
+      interop_match_name(INTEROP_GATTC_NO_SERVICE_CHANGED_IND, "Pixel C"));
+  EXPECT_TRUE(
+      interop_match_name(INTEROP_HID_HOST_LIMIT_SNIFF_INTERVAL, "Joy-Con (L)"));
+  EXPECT_FALSE(
+      interop_match_name(INTEROP_HID_HOST_LIMIT_SNIFF_INTERVAL, "Joy"));
+  // "CAR" and "Car" share no node past the first letter
+  EXPECT_TRUE(interop_match_name(INTEROP_DISABLE_AUTO_PAIRING, "CAR M_MEDIA"));
+  EXPECT_FALSE(interop_match_name(INTEROP_DISABLE_AUTO_PAIRING, "CAr"));
+  EXPECT_FALSE(interop_match_name(INTEROP_DISABLE_AUTO_PAIRING, ""));
+}
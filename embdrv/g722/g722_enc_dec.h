@@ -136,6 +136,14 @@ extern "C" {
 g722_encode_state_t *g722_encode_init(g722_encode_state_t *s, unsigned int rate, int options);
 int g722_encode_release(g722_encode_state_t *s);
 int g722_encode(g722_encode_state_t *s, uint8_t g722_data[], const int16_t amp[], int len);
+/* Encodes len frames of interleaved stereo PCM in one pass, the left channel
+   with the left state into left_data and the right one with the right state
+   into right_data. The samples are shifted right by shift bits first. The
+   output is the same as g722_encode on each channel. Returns the number of
+   bytes written to each of left_data and right_data. */
+int g722_encode_stereo(g722_encode_state_t *left, g722_encode_state_t *right,
+                       uint8_t left_data[], uint8_t right_data[],
+                       const int16_t amp[], int len, int shift);
 
 g722_decode_state_t *g722_decode_init(g722_decode_state_t *s, unsigned int rate, int options);
 int g722_decode_release(g722_decode_state_t *s);
@@ -268,8 +268,162 @@ static int16_t ihp[3] = {0, 3, 2};
 static int16_t wh[3] = {0, -214, 798};
 static int16_t rh2[4] = {2, 1, 2, 1};
 
-int g722_encode(g722_encode_state_t *s, uint8_t g722_data[],
-                       const int16_t amp[], int len)
+/* Input sample pairs filtered per pass of the transmit QMF */
+#define QMF_BLOCK_PAIRS (80)
+#define QMF_TAPS        (24)
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define G722_QMF_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define G722_QMF_NEON
+#endif
+
+#if defined(G722_QMF_SSE2) || defined(G722_QMF_NEON)
+/* qmf_coeffs laid out against the signal history, even taps interleaved with
+   the reversed odd taps, for the sum and for the difference of the filters.
+   The 16x16 bit products and their sums fit in 32 bits, so the result is
+   exactly the one of the scalar filter. */
+static const int16_t qmf_coeffs_low[QMF_TAPS] =
+{
+       3,  -11,  -11,   53,   12, -156,   32,  362, -210, -805,  951, 3876,
+    3876,  951, -805, -210,  362,   32, -156,   12,   53,  -11,  -11,    3,
+};
+static const int16_t qmf_coeffs_high[QMF_TAPS] =
+{
+      -3,  -11,   11,   53,  -12, -156,  -32,  362,  210, -805, -951, 3876,
+   -3876,  951,  805, -210, -362,   32,  156,   12,  -53,  -11,   11,    3,
+};
+#endif
+
+/* Applies the transmit QMF to the 24 samples of history ending with the
+   latest pair, and returns the low and high band samples */
+static __inline void qmf_analysis(const int16_t x[], int *xlow, int *xhigh)
+{
+#if defined(G722_QMF_SSE2)
+    __m128i low = _mm_madd_epi16(_mm_loadu_si128((const __m128i *) x),
+                                 _mm_loadu_si128((const __m128i *) qmf_coeffs_low));
+    __m128i high = _mm_madd_epi16(_mm_loadu_si128((const __m128i *) x),
+                                  _mm_loadu_si128((const __m128i *) qmf_coeffs_high));
+    for (int i = 8;  i < QMF_TAPS;  i += 8)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *) (x + i));
+        low = _mm_add_epi32(low, _mm_madd_epi16(v, _mm_loadu_si128((const __m128i *) (qmf_coeffs_low + i))));
+        high = _mm_add_epi32(high, _mm_madd_epi16(v, _mm_loadu_si128((const __m128i *) (qmf_coeffs_high + i))));
+    }
+    /* Horizontal sums, low band in the first lane, high band in the second */
+    __m128i sums = _mm_add_epi32(_mm_unpacklo_epi32(low, high), _mm_unpackhi_epi32(low, high));
+    sums = _mm_add_epi32(sums, _mm_shuffle_epi32(sums, 0x4E));
+    /* See the shift of the scalar filter below */
+    *xlow = _mm_cvtsi128_si32(sums) >> 14;
+    *xhigh = _mm_cvtsi128_si32(_mm_shuffle_epi32(sums, 0x55)) >> 14;
+#elif defined(G722_QMF_NEON)
+    int32x4_t low = vdupq_n_s32(0);
+    int32x4_t high = vdupq_n_s32(0);
+    for (int i = 0;  i < QMF_TAPS;  i += 8)
+    {
+        int16x8_t v = vld1q_s16(x + i);
+        int16x8_t cl = vld1q_s16(qmf_coeffs_low + i);
+        int16x8_t ch = vld1q_s16(qmf_coeffs_high + i);
+        low = vmlal_s16(low, vget_low_s16(v), vget_low_s16(cl));
+        low = vmlal_s16(low, vget_high_s16(v), vget_high_s16(cl));
+        high = vmlal_s16(high, vget_low_s16(v), vget_low_s16(ch));
+        high = vmlal_s16(high, vget_high_s16(v), vget_high_s16(ch));
+    }
+    int32x2_t sums = vpadd_s32(vadd_s32(vget_low_s32(low), vget_high_s32(low)),
+                               vadd_s32(vget_low_s32(high), vget_high_s32(high)));
+    /* See the shift of the scalar filter below */
+    *xlow = vget_lane_s32(sums, 0) >> 14;
+    *xhigh = vget_lane_s32(sums, 1) >> 14;
+#else
+    /* Even and odd tap accumulators */
+    int sumeven;
+    int sumodd;
+    int i;
+
+    /* Discard every other QMF output */
+    sumeven = 0;
+    sumodd = 0;
+    for (i = 0;  i < 12;  i++)
+    {
+        sumodd += x[2*i]*qmf_coeffs[i];
+        sumeven += x[2*i + 1]*qmf_coeffs[11 - i];
+    }
+    /* We shift by 12 to allow for the QMF filters (DC gain = 4096), plus 1
+       to allow for us summing two filters, plus 1 to allow for the 15 bit
+       input to the G.722 algorithm. */
+    *xlow = (sumeven + sumodd) >> 14;
+    *xhigh = (sumeven - sumodd) >> 14;
+#endif
+
+#ifdef RUN_LIKE_REFERENCE_G722
+    /* The following lines are only used to verify bit-exactness
+     * with reference implementation of G.722. Higher precision
+     * is achieved without limiting the values.
+     */
+    *xlow = limitValues(*xlow);
+    *xhigh = limitValues(*xhigh);
+#endif
+}
+/*- End of function --------------------------------------------------------*/
+
+/* Returns the first index i in [1, 29] with wd < (q6[i]*det) >> 12, or 30
+   if there is none */
+static __inline int quantl(int wd, int det)
+{
+#if defined(G722_QMF_SSE2) || defined(G722_QMF_NEON)
+    /* The thresholds grow with i, as q6 does and det is positive, so the
+       index follows from the number of thresholds above wd. q6[0], q6[30]
+       and q6[31] are 0, never above wd. det fits 16 bits. */
+    int above;
+#if defined(G722_QMF_SSE2)
+    const __m128i vdet = _mm_set1_epi16((int16_t) det);
+    const __m128i vwd = _mm_set1_epi32(wd);
+    __m128i count = _mm_setzero_si128();
+
+    for (int i = 0;  i < 32;  i += 8)
+    {
+        __m128i q = _mm_loadu_si128((const __m128i *) (q6 + i));
+        __m128i lo = _mm_mullo_epi16(q, vdet);
+        __m128i hi = _mm_mulhi_epi16(q, vdet);
+        __m128i t0 = _mm_srai_epi32(_mm_unpacklo_epi16(lo, hi), 12);
+        __m128i t1 = _mm_srai_epi32(_mm_unpackhi_epi16(lo, hi), 12);
+        count = _mm_sub_epi32(count, _mm_cmpgt_epi32(t0, vwd));
+        count = _mm_sub_epi32(count, _mm_cmpgt_epi32(t1, vwd));
+    }
+    count = _mm_add_epi32(count, _mm_shuffle_epi32(count, 0x4E));
+    count = _mm_add_epi32(count, _mm_shuffle_epi32(count, 0xB1));
+    above = _mm_cvtsi128_si32(count);
+#else
+    const int16x4_t vdet = vdup_n_s16((int16_t) det);
+    const int32x4_t vwd = vdupq_n_s32(wd);
+    int32x4_t count = vdupq_n_s32(0);
+
+    for (int i = 0;  i < 32;  i += 4)
+    {
+        int32x4_t t = vshrq_n_s32(vmull_s16(vld1_s16(q6 + i), vdet), 12);
+        count = vsubq_s32(count, vreinterpretq_s32_u32(vcgtq_s32(t, vwd)));
+    }
+    int32x2_t sums = vadd_s32(vget_low_s32(count), vget_high_s32(count));
+    above = vget_lane_s32(vpadd_s32(sums, sums), 0);
+#endif
+    return 30 - above;
+#else
+    int i;
+
+    for (i = 1;  i < 30;  i++)
+    {
+        if (wd < ((q6[i]*det) >> 12))
+            break;
+    }
+    return i;
+#endif
+}
+/*- End of function --------------------------------------------------------*/
+
+/* Runs the ADPCM of both bands, and returns the code of the sample pair */
+static __inline int encode_sample(g722_encode_state_t *s, int xlow, int xhigh)
 {
     int dlow;
     int dhigh;
@@ -284,155 +438,211 @@ int g722_encode(g722_encode_state_t *s, uint8_t g722_data[],
     int eh;
     int mih;
     int i;
-    int j;
-    /* Low and high band PCM from the QMF */
-    int xlow;
-    int xhigh;
-    int g722_bytes;
-    /* Even and odd tap accumulators */
-    int sumeven;
-    int sumodd;
     int ihigh;
     int ilow;
     int code;
 
+    /* Block 1L, SUBTRA */
+    el = saturate(xlow - s->band[0].s);
+
+    /* Block 1L, QUANTL */
+    wd = (el >= 0)  ?  el  :  -(el + 1);
+    i = quantl(wd, s->band[0].det);
+    ilow = (el < 0)  ?  iln[i]  :  ilp[i];
+
+    /* Block 2L, INVQAL */
+    ril = ilow >> 2;
+    wd2 = qm4[ril];
+    dlow = (s->band[0].det*wd2) >> 15;
+
+    /* Block 3L, LOGSCL */
+    il4 = rl42[ril];
+    wd = (s->band[0].nb*127) >> 7;
+    s->band[0].nb = wd + wl[il4];
+    if (s->band[0].nb < 0)
+        s->band[0].nb = 0;
+    else if (s->band[0].nb > 18432)
+        s->band[0].nb = 18432;
+
+    /* Block 3L, SCALEL */
+    wd1 = (s->band[0].nb >> 6) & 31;
+    wd2 = 8 - (s->band[0].nb >> 11);
+    wd3 = (wd2 < 0)  ?  (ilb[wd1] << -wd2)  :  (ilb[wd1] >> wd2);
+    s->band[0].det = wd3 << 2;
+
+    block4(&s->band[0], dlow);
+    {
+	int nb;
+
+        /* Block 1H, SUBTRA */
+        eh = saturate(xhigh - s->band[1].s);
+
+        /* Block 1H, QUANTH */
+        wd = (eh >= 0)  ?  eh  :  -(eh + 1);
+        wd1 = (564*s->band[1].det) >> 12;
+        mih = (wd >= wd1)  ?  2  :  1;
+        ihigh = (eh < 0)  ?  ihn[mih]  :  ihp[mih];
+
+        /* Block 2H, INVQAH */
+        wd2 = qm2[ihigh];
+        dhigh = (s->band[1].det*wd2) >> 15;
+
+        /* Block 3H, LOGSCH */
+        ih2 = rh2[ihigh];
+        wd = (s->band[1].nb*127) >> 7;
+
+        nb = wd + wh[ih2];
+        if (nb < 0)
+            nb = 0;
+        else if (nb > 22528)
+            nb = 22528;
+	s->band[1].nb = nb;
+
+        /* Block 3H, SCALEH */
+        wd1 = (s->band[1].nb >> 6) & 31;
+        wd2 = 10 - (s->band[1].nb >> 11);
+        wd3 = (wd2 < 0)  ?  (ilb[wd1] << -wd2)  :  (ilb[wd1] >> wd2);
+        s->band[1].det = wd3 << 2;
+
+        block4(&s->band[1], dhigh);
+#if   BITS_PER_SAMPLE == 8
+        code = ((ihigh << 6) | ilow);
+#elif BITS_PER_SAMPLE == 7
+        code = ((ihigh << 6) | ilow) >> 1;
+#elif BITS_PER_SAMPLE == 6
+        code = ((ihigh << 6) | ilow) >> 2;
+#endif
+    }
+    return code;
+}
+/*- End of function --------------------------------------------------------*/
+
+static __inline int output_code(g722_encode_state_t *s, uint8_t g722_data[], int g722_bytes, int code)
+{
+#if PACKED_OUTPUT == 1
+    /* Pack the code bits */
+    s->out_buffer |= (code << s->out_bits);
+    s->out_bits += s->bits_per_sample;
+    if (s->out_bits >= 8)
+    {
+        g722_data[g722_bytes++] = (uint8_t) (s->out_buffer & 0xFF);
+        s->out_bits -= 8;
+        s->out_buffer >>= 8;
+    }
+#else
+    g722_data[g722_bytes++] = (uint8_t) code;
+#endif
+    return g722_bytes;
+}
+/*- End of function --------------------------------------------------------*/
+
+/* The QMF runs on a line of 16 bit samples: the history kept in the state,
+   followed by a block of new samples. This avoids shuffling the history down
+   for every pair. */
+static __inline void qmf_line_load(const g722_encode_state_t *s, int16_t line[])
+{
+    int i;
+
+    for (i = 0;  i < QMF_TAPS;  i++)
+        line[i] = (int16_t) s->x[i];
+}
+/*- End of function --------------------------------------------------------*/
+
+static __inline void qmf_line_store(g722_encode_state_t *s, const int16_t line[], int pairs)
+{
+    int i;
+
+    for (i = 0;  i < QMF_TAPS;  i++)
+        s->x[i] = line[2*pairs + i];
+}
+/*- End of function --------------------------------------------------------*/
+
+int g722_encode(g722_encode_state_t *s, uint8_t g722_data[],
+                       const int16_t amp[], int len)
+{
+    int xlow;
+    int xhigh;
+    int g722_bytes;
+    int i;
+    int j;
+    int pairs;
+    int16_t line[QMF_TAPS + 2*QMF_BLOCK_PAIRS];
+
     g722_bytes = 0;
-    xhigh = 0;
-    for (j = 0;  j < len;  )
+    if (s->itu_test_mode)
     {
-        if (s->itu_test_mode)
+        for (j = 0;  j < len;  j++)
         {
             xlow =
-            xhigh = amp[j++] >> 1;
+            xhigh = amp[j] >> 1;
+            g722_bytes = output_code(s, g722_data, g722_bytes, encode_sample(s, xlow, xhigh));
         }
-        else
-        {
-            {
-                /* Apply the transmit QMF */
-                /* Shuffle the buffer down */
-                for (i = 0;  i < 22;  i++)
-                    s->x[i] = s->x[i + 2];
-                //TODO: if len is odd, then this can be a buffer overrun
-                s->x[22] = amp[j++];
-                s->x[23] = amp[j++];
-    
-                /* Discard every other QMF output */
-                sumeven = 0;
-                sumodd = 0;
-                for (i = 0;  i < 12;  i++)
-                {
-                    sumodd += s->x[2*i]*qmf_coeffs[i];
-                    sumeven += s->x[2*i + 1]*qmf_coeffs[11 - i];
-                }
-                /* We shift by 12 to allow for the QMF filters (DC gain = 4096), plus 1
-                   to allow for us summing two filters, plus 1 to allow for the 15 bit
-                   input to the G.722 algorithm. */
-                xlow = (sumeven + sumodd) >> 14;
-                xhigh = (sumeven - sumodd) >> 14;
+        return g722_bytes;
+    }
 
-#ifdef RUN_LIKE_REFERENCE_G722
-                /* The following lines are only used to verify bit-exactness
-                 * with reference implementation of G.722. Higher precision
-                 * is achieved without limiting the values.
-                 */
-                xlow = limitValues(xlow);
-                xhigh = limitValues(xhigh);
-#endif
-            }
+    /* A trailing odd sample is ignored, the QMF takes samples in pairs */
+    for (j = 0;  j + 1 < len;  j += 2*pairs)
+    {
+        pairs = (len - j)/2;
+        if (pairs > QMF_BLOCK_PAIRS)
+            pairs = QMF_BLOCK_PAIRS;
+
+        qmf_line_load(s, line);
+        memcpy(line + QMF_TAPS, amp + j, 2*pairs*sizeof(int16_t));
+        for (i = 0;  i < pairs;  i++)
+        {
+            qmf_analysis(line + 2*i + 2, &xlow, &xhigh);
+            g722_bytes = output_code(s, g722_data, g722_bytes, encode_sample(s, xlow, xhigh));
         }
-        /* Block 1L, SUBTRA */
-        el = saturate(xlow - s->band[0].s);
+        qmf_line_store(s, line, pairs);
+    }
+    return g722_bytes;
+}
+/*- End of function --------------------------------------------------------*/
 
-        /* Block 1L, QUANTL */
-        wd = (el >= 0)  ?  el  :  -(el + 1);
+int g722_encode_stereo(g722_encode_state_t *left, g722_encode_state_t *right,
+                       uint8_t left_data[], uint8_t right_data[],
+                       const int16_t amp[], int len, int shift)
+{
+    int xlow;
+    int xhigh;
+    int left_bytes;
+    int right_bytes;
+    int i;
+    int j;
+    int pairs;
+    int16_t left_line[QMF_TAPS + 2*QMF_BLOCK_PAIRS];
+    int16_t right_line[QMF_TAPS + 2*QMF_BLOCK_PAIRS];
 
-        for (i = 1;  i < 30;  i++)
+    left_bytes = 0;
+    right_bytes = 0;
+    for (j = 0;  j + 1 < len;  j += 2*pairs)
+    {
+        pairs = (len - j)/2;
+        if (pairs > QMF_BLOCK_PAIRS)
+            pairs = QMF_BLOCK_PAIRS;
+
+        /* Deinterleave straight into the QMF lines */
+        qmf_line_load(left, left_line);
+        qmf_line_load(right, right_line);
+        for (i = 0;  i < 2*pairs;  i++)
         {
-            wd1 = (q6[i]*s->band[0].det) >> 12;
-            if (wd < wd1)
-                break;
+            left_line[QMF_TAPS + i] = amp[2*(j + i)] >> shift;
+            right_line[QMF_TAPS + i] = amp[2*(j + i) + 1] >> shift;
         }
-        ilow = (el < 0)  ?  iln[i]  :  ilp[i];
-
-        /* Block 2L, INVQAL */
-        ril = ilow >> 2;
-        wd2 = qm4[ril];
-        dlow = (s->band[0].det*wd2) >> 15;
-
-        /* Block 3L, LOGSCL */
-        il4 = rl42[ril];
-        wd = (s->band[0].nb*127) >> 7;
-        s->band[0].nb = wd + wl[il4];
-        if (s->band[0].nb < 0)
-            s->band[0].nb = 0;
-        else if (s->band[0].nb > 18432)
-            s->band[0].nb = 18432;
-
-        /* Block 3L, SCALEL */
-        wd1 = (s->band[0].nb >> 6) & 31;
-        wd2 = 8 - (s->band[0].nb >> 11);
-        wd3 = (wd2 < 0)  ?  (ilb[wd1] << -wd2)  :  (ilb[wd1] >> wd2);
-        s->band[0].det = wd3 << 2;
 
-        block4(&s->band[0], dlow);
+        /* Both encoders advance together, their ADPCM chains are independent */
+        for (i = 0;  i < pairs;  i++)
         {
-	    int nb;
-
-            /* Block 1H, SUBTRA */
-            eh = saturate(xhigh - s->band[1].s);
-
-            /* Block 1H, QUANTH */
-            wd = (eh >= 0)  ?  eh  :  -(eh + 1);
-            wd1 = (564*s->band[1].det) >> 12;
-            mih = (wd >= wd1)  ?  2  :  1;
-            ihigh = (eh < 0)  ?  ihn[mih]  :  ihp[mih];
-
-            /* Block 2H, INVQAH */
-            wd2 = qm2[ihigh];
-            dhigh = (s->band[1].det*wd2) >> 15;
-
-            /* Block 3H, LOGSCH */
-            ih2 = rh2[ihigh];
-            wd = (s->band[1].nb*127) >> 7;
-
-            nb = wd + wh[ih2];
-            if (nb < 0)
-                nb = 0;
-            else if (nb > 22528)
-                nb = 22528;
-	    s->band[1].nb = nb;
-
-            /* Block 3H, SCALEH */
-            wd1 = (s->band[1].nb >> 6) & 31;
-            wd2 = 10 - (s->band[1].nb >> 11);
-            wd3 = (wd2 < 0)  ?  (ilb[wd1] << -wd2)  :  (ilb[wd1] >> wd2);
-            s->band[1].det = wd3 << 2;
-
-            block4(&s->band[1], dhigh);
-#if   BITS_PER_SAMPLE == 8
-            code = ((ihigh << 6) | ilow);
-#elif BITS_PER_SAMPLE == 7
-            code = ((ihigh << 6) | ilow) >> 1;
-#elif BITS_PER_SAMPLE == 6
-            code = ((ihigh << 6) | ilow) >> 2;
-#endif
+            qmf_analysis(left_line + 2*i + 2, &xlow, &xhigh);
+            left_bytes = output_code(left, left_data, left_bytes, encode_sample(left, xlow, xhigh));
+            qmf_analysis(right_line + 2*i + 2, &xlow, &xhigh);
+            right_bytes = output_code(right, right_data, right_bytes, encode_sample(right, xlow, xhigh));
         }
-
-#if PACKED_OUTPUT == 1
-            /* Pack the code bits */
-            s->out_buffer |= (code << s->out_bits);
-            s->out_bits += s->bits_per_sample;
-            if (s->out_bits >= 8)
-            {
-                g722_data[g722_bytes++] = (uint8_t) (s->out_buffer & 0xFF);
-                s->out_bits -= 8;
-                s->out_buffer >>= 8;
-            }
-#else
-            g722_data[g722_bytes++] = (uint8_t) code;
-#endif
+        qmf_line_store(left, left_line, pairs);
+        qmf_line_store(right, right_line, pairs);
     }
-    return g722_bytes;
+    return left_bytes;
 }
 /*- End of function --------------------------------------------------------*/
 /*- End of file ------------------------------------------------------------*/
@@ -0,0 +1,240 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+// G.722 streams produced by the scalar encoder from the input of
+// g722_encode_test.cc. The stereo streams are the mono encoding of each
+// channel, shifted right by one bit.
+// Do not regenerate these from the current encoder: they catch changes to
+// its output.
+
+const uint8_t kG722Golden64k[] = {
+    0x92, 0x20, 0x84, 0x20, 0x84, 0x20, 0x87, 0x0a, 0xad, 0x04, 0x31, 0xb5,
+    0x12, 0xb1, 0x93, 0x09, 0xa8, 0x24, 0x86, 0xa5, 0x10, 0xa3, 0x29, 0x2c,
+    0x78, 0x07, 0x2a, 0xb8, 0x21, 0x9b, 0x1f, 0x6b, 0xb7, 0x2d, 0x22, 0xae,
+    0xa6, 0x06, 0x5a, 0xd4, 0x26, 0xa9, 0x89, 0xa0, 0x6f, 0x46, 0x84, 0x2a,
+    0x0d, 0xac, 0xbe, 0x26, 0x20, 0xca, 0x2f, 0xa2, 0xa6, 0xbc, 0x6b, 0x22,
+    0x46, 0x84, 0x24, 0x65, 0xc7, 0xb9, 0x91, 0x58, 0x95, 0x86, 0xa0, 0xa4,
+    0x0c, 0x84, 0x19, 0x12, 0xba, 0xc4, 0xb5, 0x06, 0xf7, 0x31, 0x60, 0xac,
+    0xa2, 0x91, 0xc6, 0xd9, 0x61, 0x98, 0x44, 0xd4, 0xf0, 0x60, 0xb0, 0x45,
+    0xf8, 0xa4, 0x20, 0x06, 0xd0, 0xf4, 0x60, 0xb6, 0x45, 0x7a, 0xe8, 0x21,
+    0x06, 0xd2, 0xff, 0x60, 0xbc, 0x46, 0xfd, 0xad, 0x21, 0x06, 0x55, 0xda,
+    0x62, 0x9e, 0x46, 0xfe, 0xf5, 0x21, 0x05, 0xd6, 0xd4, 0x63, 0x98, 0x46,
+    0xdf, 0xfc, 0x22, 0x05, 0x57, 0xd2, 0x64, 0x93, 0x46, 0xd9, 0x9d, 0x23,
+    0x05, 0xd4, 0x56, 0xad, 0x20, 0x09, 0x7b, 0xf8, 0x61, 0xbb, 0x4b, 0xf2,
+    0xf2, 0x21, 0x07, 0x74, 0xd6, 0x62, 0xbd, 0x4a, 0xf4, 0x97, 0xcf, 0xf0,
+    0x7b, 0x5b, 0x74, 0xfa, 0xda, 0xfa, 0xfd, 0xdd, 0xfc, 0xfc, 0xdf, 0xfd,
+    0x7d, 0x7e, 0xfc, 0xfc, 0xfe, 0xfc, 0xfd, 0xfd, 0xff, 0x7f, 0xfb, 0x7f,
+    0x3b, 0xfc, 0x7d, 0x3f, 0x3e, 0x7c, 0x7b, 0x7b, 0xfc, 0x7d, 0xde, 0x1f,
+    0x3f, 0x3f, 0xfd, 0x7d, 0x5f, 0x5c, 0x5f, 0x7f, 0xbf, 0xba, 0xf5, 0x5a,
+    0xf8, 0xdf, 0xff, 0xfa, 0x3b, 0xdd, 0xf4, 0x5e, 0xbe, 0xba, 0x79, 0x1d,
+    0x5a, 0x5c, 0xbd, 0xdb, 0xdf, 0xf1, 0x3e, 0xde, 0x78, 0xb7, 0x9b, 0xf8,
+    0xde, 0x9a, 0x2a, 0xc9, 0xe0, 0x84, 0x84, 0xa0, 0xbc, 0x84, 0xa0, 0xbb,
+    0x84, 0xa0, 0xb8, 0x84, 0xa0, 0xb8, 0x84, 0xa0, 0xb8, 0xc4, 0xe0, 0xb8,
+    0xc4, 0xe0, 0xb8, 0x84, 0xe0, 0xf7, 0x84, 0xe0, 0xf8, 0xc4, 0xa0, 0xb8,
+    0xc4, 0xe1, 0xf8, 0xc4, 0xe1, 0xb8, 0xc4, 0xa2, 0xb8, 0x45, 0xe2, 0xf8,
+    0xc5, 0xe3, 0xb8, 0x86, 0xe4, 0xfc, 0xc6, 0xe3, 0xb8, 0xc7, 0xe4, 0xb9,
+    0xc7, 0xe4, 0xbf, 0xc7, 0xe3, 0xb7, 0xc9, 0xe5, 0xb6, 0x48, 0xe5, 0xbd,
+    0xc6, 0xa5, 0xfc, 0xc7, 0xe7, 0xb8, 0x4b, 0xe6, 0xb6, 0x8a, 0x65, 0xbe,
+    0x0b, 0x8f, 0x0b, 0x67, 0xd3, 0xaf, 0x5f, 0x67, 0xec, 0x5d, 0x54, 0x0d,
+    0xda, 0xd1, 0xdd, 0x97, 0x72, 0xfd, 0x30, 0x5c, 0x7a, 0xd6, 0x9e, 0xd5,
+    0xdf, 0x3b, 0xf8, 0x6b, 0xb7, 0x2e, 0x1e, 0x9b, 0x7a, 0x9b, 0x3e, 0xd1,
+    0x5d, 0x54, 0x9e, 0x1f, 0xfe, 0xda, 0x79, 0xd8, 0xf9, 0xf7, 0x29, 0x5a,
+    0x9f, 0x59, 0x34, 0xbb, 0xd2, 0x1a, 0xdb, 0xf8, 0x54, 0x3c, 0xbc, 0x5e,
+    0xdd, 0xd4, 0x5c, 0x30, 0xfa, 0xb6, 0x6b, 0x57, 0xd6, 0x95, 0x19, 0xd0,
+    0xcb, 0x7e, 0xf6, 0x3b, 0x7b, 0x9f, 0xf9, 0x76, 0x6a, 0x7d, 0xf3, 0x74,
+    0xec, 0xf0, 0xf1, 0x6d, 0x6d, 0x6f, 0x75, 0xf6, 0xf9, 0xfa, 0xfe, 0x5f,
+    0x7f, 0x5f, 0x7e, 0xdb, 0xdb, 0xd9, 0xd7, 0x56, 0x54, 0x55, 0xd3, 0x55,
+    0xd9, 0xde, 0xde, 0x5f, 0x7b, 0xfc, 0xfb, 0xff, 0x79, 0xf7, 0xf7, 0x75,
+    0xf4, 0xf0, 0xf0, 0x6f, 0xb2, 0x30, 0xf5, 0xf9, 0xfb, 0xfe, 0x7c, 0xfd,
+    0xfc, 0xfc, 0xdf, 0xde, 0xda, 0x59, 0xd6, 0xd6, 0xd5, 0x94, 0xd3, 0x54,
+    0x15, 0x9e, 0x5f, 0xbf, 0xfe, 0xdf, 0xfc, 0x7d, 0xf9, 0xf8, 0xf4, 0xf1,
+};
+
+const uint8_t kG722Golden56k[] = {
+    0x92, 0x20, 0x84, 0x20, 0x84, 0x20, 0x87, 0x0a, 0xad, 0x04, 0x31, 0xb5,
+    0x12, 0xb1, 0x93, 0x09, 0xa8, 0x24, 0x86, 0xa5, 0x10, 0xa3, 0x29, 0x2c,
+    0x78, 0x07, 0x2a, 0xb8, 0x21, 0x9b, 0x1f, 0x6b, 0xb7, 0x2d, 0x22, 0xae,
+    0xa6, 0x06, 0x5a, 0xd4, 0x26, 0xa9, 0x89, 0xa0, 0x6f, 0x46, 0x84, 0x2a,
+    0x0d, 0xac, 0xbe, 0x26, 0x20, 0xca, 0x2f, 0xa2, 0xa6, 0xbc, 0x6b, 0x22,
+    0x46, 0x84, 0x24, 0x65, 0xc7, 0xb9, 0x91, 0x58, 0x95, 0x86, 0xa0, 0xa4,
+    0x0c, 0x84, 0x19, 0x12, 0xba, 0xc4, 0xb5, 0x06, 0xf7, 0x31, 0x60, 0xac,
+    0xa2, 0x91, 0xc6, 0xd9, 0x61, 0x98, 0x44, 0xd4, 0xf0, 0x60, 0xb0, 0x45,
+    0xf8, 0xa4, 0x20, 0x06, 0xd0, 0xf4, 0x60, 0xb6, 0x45, 0x7a, 0xe8, 0x21,
+    0x06, 0xd2, 0xff, 0x60, 0xbc, 0x46, 0xfd, 0xad, 0x21, 0x06, 0x55, 0xda,
+    0x62, 0x9e, 0x46, 0xfe, 0xf5, 0x21, 0x05, 0xd6, 0xd4, 0x63, 0x98, 0x46,
+    0xdf, 0xfc, 0x22, 0x05, 0x57, 0xd2, 0x64, 0x93, 0x46, 0xd9, 0x9d, 0x23,
+    0x05, 0xd4, 0x56, 0xad, 0x20, 0x09, 0x7b, 0xf8, 0x61, 0xbb, 0x4b, 0xf2,
+    0xf2, 0x21, 0x07, 0x74, 0xd6, 0x62, 0xbd, 0x4a, 0xf4, 0x97, 0xcf, 0xf0,
+    0x7b, 0x5b, 0x74, 0xfa, 0xda, 0xfa, 0xfd, 0xdd, 0xfc, 0xfc, 0xdf, 0xfd,
+    0x7d, 0x7e, 0xfc, 0xfc, 0xfe, 0xfc, 0xfd, 0xfd, 0xff, 0x7f, 0xfb, 0x7f,
+    0x3b, 0xfc, 0x7d, 0x3f, 0x3e, 0x7c, 0x7b, 0x7b, 0xfc, 0x7d, 0xde, 0x1f,
+    0x3f, 0x3f, 0xfd, 0x7d, 0x5f, 0x5c, 0x5f, 0x7f, 0xbf, 0xba, 0xf5, 0x5a,
+    0xf8, 0xdf, 0xff, 0xfa, 0x3b, 0xdd, 0xf4, 0x5e, 0xbe, 0xba, 0x79, 0x1d,
+    0x5a, 0x5c, 0xbd, 0xdb, 0xdf, 0xf1, 0x3e, 0xde, 0x78, 0xb7, 0x9b, 0xf8,
+    0xde, 0x9a, 0x2a, 0xc9, 0xe0, 0x84, 0x84, 0xa0, 0xbc, 0x84, 0xa0, 0xbb,
+    0x84, 0xa0, 0xb8, 0x84, 0xa0, 0xb8, 0x84, 0xa0, 0xb8, 0xc4, 0xe0, 0xb8,
+    0xc4, 0xe0, 0xb8, 0x84, 0xe0, 0xf7, 0x84, 0xe0, 0xf8, 0xc4, 0xa0, 0xb8,
+    0xc4, 0xe1, 0xf8, 0xc4, 0xe1, 0xb8, 0xc4, 0xa2, 0xb8, 0x45, 0xe2, 0xf8,
+    0xc5, 0xe3, 0xb8, 0x86, 0xe4, 0xfc, 0xc6, 0xe3, 0xb8, 0xc7, 0xe4, 0xb9,
+    0xc7, 0xe4, 0xbf, 0xc7, 0xe3, 0xb7, 0xc9, 0xe5, 0xb6, 0x48, 0xe5, 0xbd,
+    0xc6, 0xa5, 0xfc, 0xc7, 0xe7, 0xb8, 0x4b, 0xe6, 0xb6, 0x8a, 0x65, 0xbe,
+    0x0b, 0x8f, 0x0b, 0x67, 0xd3, 0xaf, 0x5f, 0x67, 0xec, 0x5d, 0x54, 0x0d,
+    0xda, 0xd1, 0xdd, 0x97, 0x72, 0xfd, 0x30, 0x5c, 0x7a, 0xd6, 0x9e, 0xd5,
+    0xdf, 0x3b, 0xf8, 0x6b, 0xb7, 0x2e, 0x1e, 0x9b, 0x7a, 0x9b, 0x3e, 0xd1,
+    0x5d, 0x54, 0x9e, 0x1f, 0xfe, 0xda, 0x79, 0xd8, 0xf9, 0xf7, 0x29, 0x5a,
+    0x9f, 0x59, 0x34, 0xbb, 0xd2, 0x1a, 0xdb, 0xf8, 0x54, 0x3c, 0xbc, 0x5e,
+    0xdd, 0xd4, 0x5c, 0x30, 0xfa, 0xb6, 0x6b, 0x57, 0xd6, 0x95, 0x19, 0xd0,
+    0xcb, 0x7e, 0xf6, 0x3b, 0x7b, 0x9f, 0xf9, 0x76, 0x6a, 0x7d, 0xf3, 0x74,
+    0xec, 0xf0, 0xf1, 0x6d, 0x6d, 0x6f, 0x75, 0xf6, 0xf9, 0xfa, 0xfe, 0x5f,
+    0x7f, 0x5f, 0x7e, 0xdb, 0xdb, 0xd9, 0xd7, 0x56, 0x54, 0x55, 0xd3, 0x55,
+    0xd9, 0xde, 0xde, 0x5f, 0x7b, 0xfc, 0xfb, 0xff, 0x79, 0xf7, 0xf7, 0x75,
+    0xf4, 0xf0, 0xf0, 0x6f, 0xb2, 0x30, 0xf5, 0xf9, 0xfb, 0xfe, 0x7c, 0xfd,
+    0xfc, 0xfc, 0xdf, 0xde, 0xda, 0x59, 0xd6, 0xd6, 0xd5, 0x94, 0xd3, 0x54,
+    0x15, 0x9e, 0x5f, 0xbf, 0xfe, 0xdf, 0xfc, 0x7d, 0xf9, 0xf8, 0xf4, 0xf1,
+};
+
+const uint8_t kG722Golden48k[] = {
+    0x92, 0x20, 0x84, 0x20, 0x84, 0x20, 0x87, 0x0a, 0xad, 0x04, 0x31, 0xb5,
+    0x12, 0xb1, 0x93, 0x09, 0xa8, 0x24, 0x86, 0xa5, 0x10, 0xa3, 0x29, 0x2c,
+    0x78, 0x07, 0x2a, 0xb8, 0x21, 0x9b, 0x1f, 0x6b, 0xb7, 0x2d, 0x22, 0xae,
+    0xa6, 0x06, 0x5a, 0xd4, 0x26, 0xa9, 0x89, 0xa0, 0x6f, 0x46, 0x84, 0x2a,
+    0x0d, 0xac, 0xbe, 0x26, 0x20, 0xca, 0x2f, 0xa2, 0xa6, 0xbc, 0x6b, 0x22,
+    0x46, 0x84, 0x24, 0x65, 0xc7, 0xb9, 0x91, 0x58, 0x95, 0x86, 0xa0, 0xa4,
+    0x0c, 0x84, 0x19, 0x12, 0xba, 0xc4, 0xb5, 0x06, 0xf7, 0x31, 0x60, 0xac,
+    0xa2, 0x91, 0xc6, 0xd9, 0x61, 0x98, 0x44, 0xd4, 0xf0, 0x60, 0xb0, 0x45,
+    0xf8, 0xa4, 0x20, 0x06, 0xd0, 0xf4, 0x60, 0xb6, 0x45, 0x7a, 0xe8, 0x21,
+    0x06, 0xd2, 0xff, 0x60, 0xbc, 0x46, 0xfd, 0xad, 0x21, 0x06, 0x55, 0xda,
+    0x62, 0x9e, 0x46, 0xfe, 0xf5, 0x21, 0x05, 0xd6, 0xd4, 0x63, 0x98, 0x46,
+    0xdf, 0xfc, 0x22, 0x05, 0x57, 0xd2, 0x64, 0x93, 0x46, 0xd9, 0x9d, 0x23,
+    0x05, 0xd4, 0x56, 0xad, 0x20, 0x09, 0x7b, 0xf8, 0x61, 0xbb, 0x4b, 0xf2,
+    0xf2, 0x21, 0x07, 0x74, 0xd6, 0x62, 0xbd, 0x4a, 0xf4, 0x97, 0xcf, 0xf0,
+    0x7b, 0x5b, 0x74, 0xfa, 0xda, 0xfa, 0xfd, 0xdd, 0xfc, 0xfc, 0xdf, 0xfd,
+    0x7d, 0x7e, 0xfc, 0xfc, 0xfe, 0xfc, 0xfd, 0xfd, 0xff, 0x7f, 0xfb, 0x7f,
+    0x3b, 0xfc, 0x7d, 0x3f, 0x3e, 0x7c, 0x7b, 0x7b, 0xfc, 0x7d, 0xde, 0x1f,
+    0x3f, 0x3f, 0xfd, 0x7d, 0x5f, 0x5c, 0x5f, 0x7f, 0xbf, 0xba, 0xf5, 0x5a,
+    0xf8, 0xdf, 0xff, 0xfa, 0x3b, 0xdd, 0xf4, 0x5e, 0xbe, 0xba, 0x79, 0x1d,
+    0x5a, 0x5c, 0xbd, 0xdb, 0xdf, 0xf1, 0x3e, 0xde, 0x78, 0xb7, 0x9b, 0xf8,
+    0xde, 0x9a, 0x2a, 0xc9, 0xe0, 0x84, 0x84, 0xa0, 0xbc, 0x84, 0xa0, 0xbb,
+    0x84, 0xa0, 0xb8, 0x84, 0xa0, 0xb8, 0x84, 0xa0, 0xb8, 0xc4, 0xe0, 0xb8,
+    0xc4, 0xe0, 0xb8, 0x84, 0xe0, 0xf7, 0x84, 0xe0, 0xf8, 0xc4, 0xa0, 0xb8,
+    0xc4, 0xe1, 0xf8, 0xc4, 0xe1, 0xb8, 0xc4, 0xa2, 0xb8, 0x45, 0xe2, 0xf8,
+    0xc5, 0xe3, 0xb8, 0x86, 0xe4, 0xfc, 0xc6, 0xe3, 0xb8, 0xc7, 0xe4, 0xb9,
+    0xc7, 0xe4, 0xbf, 0xc7, 0xe3, 0xb7, 0xc9, 0xe5, 0xb6, 0x48, 0xe5, 0xbd,
+    0xc6, 0xa5, 0xfc, 0xc7, 0xe7, 0xb8, 0x4b, 0xe6, 0xb6, 0x8a, 0x65, 0xbe,
+    0x0b, 0x8f, 0x0b, 0x67, 0xd3, 0xaf, 0x5f, 0x67, 0xec, 0x5d, 0x54, 0x0d,
+    0xda, 0xd1, 0xdd, 0x97, 0x72, 0xfd, 0x30, 0x5c, 0x7a, 0xd6, 0x9e, 0xd5,
+    0xdf, 0x3b, 0xf8, 0x6b, 0xb7, 0x2e, 0x1e, 0x9b, 0x7a, 0x9b, 0x3e, 0xd1,
+    0x5d, 0x54, 0x9e, 0x1f, 0xfe, 0xda, 0x79, 0xd8, 0xf9, 0xf7, 0x29, 0x5a,
+    0x9f, 0x59, 0x34, 0xbb, 0xd2, 0x1a, 0xdb, 0xf8, 0x54, 0x3c, 0xbc, 0x5e,
+    0xdd, 0xd4, 0x5c, 0x30, 0xfa, 0xb6, 0x6b, 0x57, 0xd6, 0x95, 0x19, 0xd0,
+    0xcb, 0x7e, 0xf6, 0x3b, 0x7b, 0x9f, 0xf9, 0x76, 0x6a, 0x7d, 0xf3, 0x74,
+    0xec, 0xf0, 0xf1, 0x6d, 0x6d, 0x6f, 0x75, 0xf6, 0xf9, 0xfa, 0xfe, 0x5f,
+    0x7f, 0x5f, 0x7e, 0xdb, 0xdb, 0xd9, 0xd7, 0x56, 0x54, 0x55, 0xd3, 0x55,
+    0xd9, 0xde, 0xde, 0x5f, 0x7b, 0xfc, 0xfb, 0xff, 0x79, 0xf7, 0xf7, 0x75,
+    0xf4, 0xf0, 0xf0, 0x6f, 0xb2, 0x30, 0xf5, 0xf9, 0xfb, 0xfe, 0x7c, 0xfd,
+    0xfc, 0xfc, 0xdf, 0xde, 0xda, 0x59, 0xd6, 0xd6, 0xd5, 0x94, 0xd3, 0x54,
+    0x15, 0x9e, 0x5f, 0xbf, 0xfe, 0xdf, 0xfc, 0x7d, 0xf9, 0xf8, 0xf4, 0xf1,
+};
+
+const uint8_t kG722GoldenStereoLeft[] = {
+    0x98, 0x20, 0x84, 0x20, 0x84, 0x20, 0x8e, 0x08, 0xad, 0x05, 0x37, 0xb8,
+    0x18, 0xb5, 0x98, 0x0f, 0xb0, 0x2b, 0x8d, 0xad, 0x17, 0xeb, 0x31, 0x34,
+    0x7b, 0x0e, 0x30, 0xbb, 0x27, 0x9e, 0x3f, 0x72, 0xbb, 0x33, 0x27, 0xb6,
+    0xae, 0x4c, 0x5f, 0xd8, 0x2d, 0xb0, 0x90, 0xa4, 0xf6, 0x4c, 0x87, 0x74,
+    0x13, 0xb2, 0xbe, 0x6d, 0x62, 0x93, 0x35, 0xaa, 0xaf, 0x9f, 0x73, 0x68,
+    0x4c, 0x87, 0x6f, 0x6d, 0xd0, 0xb7, 0xd7, 0x5c, 0x9b, 0x8c, 0xa4, 0xeb,
+    0x15, 0xca, 0x1a, 0x17, 0xba, 0xc7, 0xfb, 0x0c, 0xf8, 0x76, 0xe3, 0xb0,
+    0xea, 0x96, 0xcd, 0xdd, 0x67, 0x9e, 0x48, 0x58, 0xf6, 0x64, 0xb5, 0xcb,
+    0xfb, 0xed, 0x25, 0x0c, 0xd6, 0xf9, 0x65, 0xb9, 0x4b, 0x7c, 0xf0, 0x26,
+    0x0c, 0xda, 0xfd, 0x66, 0xbd, 0x4c, 0x7b, 0xf4, 0x26, 0x0c, 0xd9, 0xdf,
+    0x68, 0x9f, 0x4c, 0xff, 0xf6, 0x27, 0x0b, 0xda, 0xdc, 0x6a, 0x9e, 0x4c,
+    0xdf, 0xf9, 0x28, 0x0b, 0xd9, 0xd8, 0x6c, 0x9c, 0x4c, 0xdd, 0xfc, 0x29,
+    0x0a, 0xd8, 0x5b, 0xb4, 0x24, 0x10, 0x7c, 0xf7, 0x68, 0xbd, 0xd2, 0xf7,
+    0xf8, 0x26, 0x0d, 0x79, 0xdf, 0x68, 0xbf, 0x50, 0xf8, 0xdc, 0xd6, 0xf5,
+    0x7c, 0x5e, 0x79, 0xfc, 0xdd, 0xfb, 0xff, 0xfe, 0xfc, 0xfd, 0xfe, 0xfd,
+    0x7d, 0x7f, 0xfd, 0xfd, 0xff, 0xfc, 0xfd, 0xfd, 0xff, 0x7f, 0xfc, 0x7f,
+    0x3c, 0xfd, 0x7d, 0x3f, 0x3f, 0x7c, 0xfc, 0x7c, 0xfd, 0x7f, 0xdf, 0x3f,
+    0x3d, 0x3f, 0xfd, 0x7d, 0x5f, 0x5f, 0x7f, 0x7e, 0xbf, 0xfa, 0x78, 0x5c,
+    0xba, 0xfe, 0xff, 0xfa, 0x3d, 0xde, 0xf6, 0x5e, 0xff, 0xba, 0xfa, 0x5e,
+    0x5e, 0x5e, 0xbd, 0xdd, 0xfe, 0xf4, 0x3e, 0xdf, 0x78, 0xb9, 0x9c, 0xb8,
+    0xdf, 0x9c, 0x2c, 0x8b, 0xe0, 0x84, 0x84, 0xa0, 0x9e, 0x86, 0xa1, 0x9c,
+    0x85, 0xa2, 0xbd, 0x85, 0xa2, 0xbc, 0xc6, 0xe2, 0xba, 0xc6, 0xe3, 0xba,
+    0xc7, 0xe4, 0xbd, 0xc7, 0xe5, 0xfc, 0x87, 0xe5, 0xfa, 0x88, 0xe5, 0xf7,
+    0xc9, 0xa5, 0xfa, 0xc9, 0xe6, 0xba, 0xc9, 0xe7, 0xb9, 0xca, 0xe8, 0xfc,
+    0x89, 0xe8, 0xfb, 0x8b, 0xe8, 0xfc, 0xcb, 0xa9, 0xfa, 0xcc, 0xa9, 0xb8,
+    0x4c, 0xe9, 0xb9, 0x4c, 0xea, 0xb9, 0xcc, 0xeb, 0xb9, 0xcd, 0x6c, 0xbc,
+    0xcc, 0xeb, 0xf8, 0x8e, 0xec, 0xfa, 0xcf, 0xad, 0xff, 0xce, 0xec, 0xbf,
+    0x52, 0x9a, 0x15, 0x6e, 0x19, 0xb7, 0x7b, 0xf0, 0xf6, 0x5c, 0xdd, 0x15,
+    0x5b, 0x57, 0xde, 0x9a, 0x78, 0x9d, 0x35, 0xde, 0x7b, 0x58, 0xfc, 0xd9,
+    0x9f, 0x3c, 0xfc, 0x6f, 0xb7, 0x30, 0x1f, 0x9a, 0x79, 0xdd, 0x5f, 0x92,
+    0x1a, 0x56, 0x9d, 0x7e, 0x7c, 0x5a, 0xfb, 0xdb, 0x7b, 0xfa, 0x6a, 0x5f,
+    0xfe, 0x59, 0x36, 0xb9, 0xd4, 0x58, 0x5a, 0x7a, 0x56, 0x3f, 0xbd, 0x5f,
+    0xdb, 0x94, 0x5b, 0x32, 0xf7, 0xb5, 0x6d, 0x19, 0xd6, 0x95, 0x57, 0xd1,
+    0x4d, 0x5e, 0x74, 0x3c, 0x78, 0xbf, 0xbb, 0x76, 0x6a, 0x38, 0xf5, 0x75,
+    0xed, 0xef, 0xf1, 0xef, 0x6e, 0x70, 0x77, 0x79, 0xf9, 0xfc, 0xff, 0xff,
+    0x7d, 0x7f, 0x5e, 0xdc, 0x5a, 0xd8, 0xd6, 0xd6, 0x55, 0x55, 0xd5, 0x55,
+    0xda, 0xde, 0xff, 0x7e, 0x7e, 0xff, 0xfd, 0xfb, 0xfa, 0xf8, 0x76, 0x73,
+    0xf3, 0xf4, 0xf3, 0x72, 0xb1, 0x32, 0xf7, 0xfb, 0xdf, 0xfc, 0xfb, 0xfc,
+    0xfd, 0xfe, 0x7f, 0xdb, 0xd9, 0xd9, 0xd8, 0x95, 0xd5, 0x55, 0xd6, 0xd4,
+    0x15, 0x9f, 0xfd, 0xfd, 0xdf, 0xfd, 0xfc, 0xfb, 0xfd, 0xf8, 0xf4, 0xf2,
+};
+
+const uint8_t kG722GoldenStereoRight[] = {
+    0x98, 0x28, 0x84, 0x20, 0x04, 0x20, 0xa0, 0x04, 0xab, 0xbc, 0x0b, 0x8e,
+    0x36, 0xa6, 0xae, 0xb1, 0xcc, 0xa8, 0x30, 0x6b, 0x9d, 0x2d, 0x10, 0xa7,
+    0x15, 0x8f, 0x8d, 0x34, 0xb6, 0x5c, 0x93, 0x17, 0x94, 0xe8, 0x0a, 0x38,
+    0x30, 0x18, 0x4e, 0xba, 0xaa, 0x1b, 0x14, 0xfa, 0xd1, 0x1d, 0x4d, 0x4b,
+    0x49, 0x73, 0x29, 0x96, 0xb9, 0xd4, 0xe7, 0xe8, 0x33, 0x4c, 0x8a, 0xe9,
+    0x1e, 0x98, 0x36, 0x94, 0x50, 0x8d, 0xba, 0xc9, 0x1c, 0x10, 0xca, 0x3f,
+    0x7a, 0xa8, 0xef, 0x30, 0xbc, 0xd1, 0x96, 0xee, 0x54, 0xb4, 0x1d, 0x90,
+    0x15, 0x99, 0xcd, 0xff, 0x67, 0x9d, 0x48, 0xda, 0xf7, 0x64, 0xb8, 0x4b,
+    0x77, 0xee, 0x25, 0x0c, 0xd7, 0xf8, 0x66, 0xbb, 0x4b, 0xf8, 0xf1, 0x26,
+    0x0c, 0xd9, 0xfb, 0x67, 0xbd, 0x4c, 0xfa, 0xf5, 0x26, 0x0b, 0xd9, 0xde,
+    0x68, 0xbf, 0x4b, 0xfc, 0xf7, 0x27, 0x0b, 0x5b, 0xdb, 0x6a, 0x9e, 0x4c,
+    0xff, 0xfa, 0x28, 0x0b, 0xd9, 0xd8, 0x6b, 0x9c, 0x4b, 0xff, 0x9f, 0x2a,
+    0x0b, 0x57, 0x5c, 0xf4, 0x24, 0x0f, 0x7c, 0x7a, 0x67, 0xbb, 0x52, 0xf5,
+    0xf7, 0x27, 0x0d, 0x7a, 0xfe, 0x68, 0xbc, 0x4f, 0xf7, 0x99, 0xda, 0xf4,
+    0xfd, 0xde, 0xf8, 0xdf, 0xdf, 0xfc, 0xfe, 0xfe, 0x7c, 0x7d, 0x7f, 0xfd,
+    0xfd, 0xff, 0xfd, 0xfd, 0x7f, 0x7d, 0xfd, 0xfe, 0xfd, 0x7c, 0xff, 0x7f,
+    0x7c, 0x7d, 0xdf, 0x7c, 0x7e, 0x7d, 0x7d, 0xbf, 0xbf, 0x7d, 0xfd, 0x7c,
+    0xbc, 0xfb, 0xfc, 0xbb, 0xfb, 0xbd, 0xbf, 0x7c, 0x5f, 0xf7, 0xde, 0xfe,
+    0xfa, 0x5f, 0x5f, 0xbc, 0xbb, 0xfd, 0x78, 0x7b, 0xfa, 0xdb, 0xf6, 0xda,
+    0x1f, 0x7c, 0xdd, 0x3e, 0xdf, 0x78, 0x5a, 0xbb, 0xd8, 0x5d, 0xbc, 0xf8,
+    0x1e, 0xb5, 0x2f, 0x8a, 0xe0, 0x84, 0x84, 0xa2, 0x9a, 0x86, 0xa1, 0x96,
+    0x86, 0xa1, 0x98, 0x86, 0xa1, 0x99, 0x86, 0xe2, 0x99, 0xc7, 0xe2, 0xd9,
+    0xc8, 0xa3, 0xdc, 0x88, 0xe4, 0x9b, 0xc8, 0xe4, 0xdd, 0xc8, 0xe4, 0x9e,
+    0xc8, 0xa5, 0xde, 0xc9, 0xe5, 0x9e, 0xca, 0xe6, 0x9e, 0xcb, 0xe7, 0xdf,
+    0xcb, 0xa8, 0xdd, 0x8c, 0xe7, 0xbd, 0x4c, 0xe8, 0xbe, 0x4b, 0xe9, 0x9e,
+    0xcc, 0xe8, 0xbd, 0xcc, 0xe8, 0xfc, 0xcb, 0xaa, 0xfe, 0xcd, 0xaa, 0xbc,
+    0x4e, 0xeb, 0xba, 0x4e, 0xeb, 0xbb, 0xcf, 0xec, 0x9f, 0xcd, 0x6b, 0xbc,
+    0x12, 0x98, 0x13, 0xee, 0xd6, 0xf7, 0x5c, 0x77, 0x78, 0x9a, 0x7c, 0x58,
+    0xbb, 0x17, 0xda, 0xfd, 0x37, 0xfa, 0x9f, 0xdc, 0x1f, 0xff, 0xdd, 0x5e,
+    0x58, 0x7d, 0xf3, 0xfc, 0xf1, 0x7f, 0xfa, 0x1a, 0x3a, 0x97, 0x58, 0xda,
+    0xd9, 0xd5, 0x3e, 0x74, 0xec, 0xd6, 0x7e, 0xbc, 0x3a, 0x59, 0x5c, 0x9d,
+    0x37, 0xbd, 0xd2, 0xd6, 0x3e, 0x56, 0x5e, 0xba, 0x39, 0xeb, 0xd8, 0xd0,
+    0x5b, 0x1f, 0xb9, 0xdd, 0x12, 0xed, 0xeb, 0xf6, 0xdb, 0x13, 0xdc, 0xf3,
+    0xbb, 0x7d, 0x53, 0xbe, 0x18, 0x51, 0x54, 0xd9, 0xda, 0x58, 0xb3, 0x71,
+    0x6e, 0x70, 0x6d, 0xee, 0x6e, 0xf0, 0xf3, 0xf5, 0x77, 0x7b, 0xfc, 0x7d,
+    0x7f, 0xfe, 0xde, 0xdd, 0x5c, 0xda, 0x58, 0x56, 0xd6, 0xd5, 0xd5, 0x55,
+    0xd8, 0x5b, 0x5e, 0xdf, 0xfd, 0xfd, 0xfc, 0x7b, 0xfb, 0x78, 0xf7, 0xf6,
+    0xf4, 0xf3, 0xf3, 0x72, 0xb2, 0x31, 0xf5, 0xf8, 0xfa, 0xfb, 0xfd, 0xfc,
+    0xfc, 0xfb, 0x5e, 0xde, 0xdb, 0xdc, 0xd7, 0x98, 0xd5, 0x56, 0xd5, 0xd3,
+    0x19, 0x9b, 0xff, 0xdd, 0xdf, 0xfd, 0xfe, 0xff, 0xfd, 0xf8, 0xf5, 0xf4,
+};
@@ -0,0 +1,157 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+#include "g722_enc_dec.h"
+#include "g722_encode_golden.h"
+
+namespace {
+
+// Each segment is one 10 ms hearing aid frame at 16 kHz
+constexpr int kSamplesPerSegment = 160;
+constexpr int kSegments = 6;
+constexpr int kSamples = kSamplesPerSegment * kSegments;
+// The encoder is called with these lengths in turn, so that samples are
+// carried over in the QMF history both within and across its blocks
+constexpr int kChunkSizes[] = {160, 2, 30, 128, 320};
+
+// Cycles through full scale noise, a ramp, quiet noise, a full scale square
+// wave, mid level noise and a mid level triangle wave, one segment each. The
+// noise is a fixed LCG, so that the input is the same with any C library.
+std::vector<int16_t> MakePcm(uint32_t seed) {
+  std::vector<int16_t> pcm(kSamples);
+  uint32_t state = seed;
+  for (int i = 0; i < kSamples; i++) {
+    switch (i / kSamplesPerSegment) {
+      case 0:
+        state = state * 1664525u + 1013904223u;
+        pcm[i] = (int16_t)(state >> 16);
+        break;
+      case 1:
+        pcm[i] = (int16_t)(i * 7217);
+        break;
+      case 2:
+        state = state * 1664525u + 1013904223u;
+        pcm[i] = (int16_t)(state >> 16) >> 7;
+        break;
+      case 3:
+        pcm[i] = ((i / 3) & 1) ? 32767 : -32768;
+        break;
+      case 4:
+        state = state * 1664525u + 1013904223u;
+        pcm[i] = (int16_t)(state >> 16) >> 3;
+        break;
+      default:
+        pcm[i] = (std::abs(i % 74 - 37) - 18) * 211;
+        break;
+    }
+  }
+  return pcm;
+}
+
+std::vector<uint8_t> EncodeMono(int rate, const std::vector<int16_t>& pcm) {
+  g722_encode_state_t* state = g722_encode_init(nullptr, rate, G722_PACKED);
+  std::vector<uint8_t> stream(pcm.size());
+  int length = 0;
+  size_t offset = 0;
+  for (int c = 0; offset < pcm.size(); c++) {
+    int chunk = kChunkSizes[c % (sizeof(kChunkSizes) / sizeof(int))];
+    if (chunk > (int)(pcm.size() - offset)) chunk = pcm.size() - offset;
+    length += g722_encode(state, stream.data() + length, pcm.data() + offset,
+                          chunk);
+    offset += chunk;
+  }
+  g722_encode_release(state);
+  stream.resize(length);
+  return stream;
+}
+
+void EncodeStereo(int rate, const std::vector<int16_t>& left_pcm,
+                  const std::vector<int16_t>& right_pcm, int shift,
+                  std::vector<uint8_t>* p_left, std::vector<uint8_t>* p_right) {
+  std::vector<int16_t> pcm;
+  for (size_t i = 0; i < left_pcm.size(); i++) {
+    pcm.push_back(left_pcm[i]);
+    pcm.push_back(right_pcm[i]);
+  }
+
+  g722_encode_state_t* left = g722_encode_init(nullptr, rate, G722_PACKED);
+  g722_encode_state_t* right = g722_encode_init(nullptr, rate, G722_PACKED);
+  p_left->resize(left_pcm.size());
+  p_right->resize(right_pcm.size());
+  int length = 0;
+  size_t frames = 0;
+  for (int c = 0; frames < left_pcm.size(); c++) {
+    int chunk = kChunkSizes[c % (sizeof(kChunkSizes) / sizeof(int))];
+    if (chunk > (int)(left_pcm.size() - frames))
+      chunk = left_pcm.size() - frames;
+    length += g722_encode_stereo(left, right, p_left->data() + length,
+                                 p_right->data() + length,
+                                 pcm.data() + 2 * frames, chunk, shift);
+    frames += chunk;
+  }
+  g722_encode_release(left);
+  g722_encode_release(right);
+  p_left->resize(length);
+  p_right->resize(length);
+}
+
+std::vector<uint8_t> Golden(const uint8_t* data, size_t size) {
+  return std::vector<uint8_t>(data, data + size);
+}
+
+}  // namespace
+
+// The reference streams come from the scalar encoder, before the SSE2 and
+// NEON QMF and stereo encoding were added: both must encode the same bits.
+TEST(G722EncodeTest, mono_64k_matches_reference) {
+  EXPECT_EQ(Golden(kG722Golden64k, sizeof(kG722Golden64k)),
+            EncodeMono(64000, MakePcm(1)));
+}
+
+TEST(G722EncodeTest, mono_56k_matches_reference) {
+  EXPECT_EQ(Golden(kG722Golden56k, sizeof(kG722Golden56k)),
+            EncodeMono(56000, MakePcm(1)));
+}
+
+TEST(G722EncodeTest, mono_48k_matches_reference) {
+  EXPECT_EQ(Golden(kG722Golden48k, sizeof(kG722Golden48k)),
+            EncodeMono(48000, MakePcm(1)));
+}
+
+// The left and right references are the mono encoding of each channel, after
+// the shift applied by the hearing aid
+TEST(G722EncodeTest, stereo_matches_reference_per_channel) {
+  std::vector<uint8_t> left;
+  std::vector<uint8_t> right;
+  EncodeStereo(64000, MakePcm(1), MakePcm(2), 1, &left, &right);
+  EXPECT_EQ(Golden(kG722GoldenStereoLeft, sizeof(kG722GoldenStereoLeft)),
+            left);
+  EXPECT_EQ(Golden(kG722GoldenStereoRight, sizeof(kG722GoldenStereoRight)),
+            right);
+}
+
+TEST(G722EncodeTest, stereo_without_shift_matches_mono) {
+  std::vector<uint8_t> left;
+  std::vector<uint8_t> right;
+  EncodeStereo(48000, MakePcm(1), MakePcm(2), 0, &left, &right);
+  EXPECT_EQ(EncodeMono(48000, MakePcm(1)), left);
+  EXPECT_EQ(EncodeMono(48000, MakePcm(2)), right);
+}
@@ -79,6 +79,17 @@ Declarations of codec functions, data types, and macros.
 
 #define OI_SBC_SYNCWORD 0x9c
 #define OI_SBC_ENHANCED_SYNCWORD 0x9d
+#define OI_SBC_MSBC_SYNCWORD 0xad
+
+/**@name mSBC, the wideband speech codec of the Hands-Free Profile: 16 kHz
+ * mono, 15 blocks of 8 subbands, loudness allocation and a fixed bitpool. The
+ * header has no parameters, its two bytes are reserved. */
+/**@{*/
+#define SBC_MSBC_BLOCKS 15
+#define SBC_MSBC_BITPOOL 26
+#define SBC_MSBC_FRAME_LEN 57
+#define SBC_MSBC_SAMPLES_PER_FRAME (SBC_MSBC_BLOCKS * 8)
+/**@}*/
 
 /**@name Sampling frequencies */
 /**@{*/
@@ -238,8 +249,20 @@ typedef struct {
   uint8_t restrictSubbands;
   uint8_t enhancedEnabled;
   uint8_t bufferedBlocks;
+  /* Boolean, set by OI_CODEC_SBC_DecoderSetBackend() */
+  uint8_t simdEnabled;
+  /* Boolean, set by OI_CODEC_mSBC_DecoderReset() */
+  uint8_t mSbcEnabled;
 } OI_CODEC_SBC_DECODER_CONTEXT;
 
+/** Implementation of the dequantization and of the 8-subband synthesis
+ * window, see OI_CODEC_SBC_DecoderSetBackend(). */
+typedef enum {
+  OI_CODEC_SBC_BACKEND_AUTO, /**< SIMD if supported by the CPU, C otherwise */
+  OI_CODEC_SBC_BACKEND_C,    /**< Portable C implementation */
+  OI_CODEC_SBC_BACKEND_SIMD  /**< NEON or AVX2 implementation */
+} OI_CODEC_SBC_BACKEND;
+
 typedef struct {
   uint32_t data[CODEC_DATA_WORDS(1, SBC_CODEC_FAST_FILTER_BUFFERS)];
 } OI_CODEC_SBC_CODEC_DATA_MONO;
@@ -275,6 +298,16 @@ OI_STATUS OI_CODEC_SBC_DecoderReset(OI_CODEC_SBC_DECODER_CONTEXT* context,
                                     uint8_t maxChannels, uint8_t pcmStride,
                                     OI_BOOL enhanced);
 
+/**
+ * This function resets the decoder for an mSBC stream. Only frames with the
+ * mSBC syncword are decoded afterwards, using the fixed mSBC parameters.
+ *
+ * @param context   Pointer to the decoder context structure to be reset.
+ */
+OI_STATUS OI_CODEC_mSBC_DecoderReset(OI_CODEC_SBC_DECODER_CONTEXT* context,
+                                     uint32_t* decoderData,
+                                     uint32_t decoderDataBytes);
+
 /**
  * This function restricts the kind of SBC frames that the Decoder will
  * process.  Its use is optional.  If used, it must be called after
@@ -297,6 +330,24 @@ OI_STATUS OI_CODEC_SBC_DecoderReset(OI_CODEC_SBC_DECODER_CONTEXT* context,
 OI_STATUS OI_CODEC_SBC_DecoderLimit(OI_CODEC_SBC_DECODER_CONTEXT* context,
                                     OI_BOOL enhanced, uint8_t subbands);
 
+/**
+ * This function selects the implementation used for the dequantization and
+ * the 8-subband synthesis window. Its use is optional. If used, it must be
+ * called after calling OI_CODEC_SBC_DecoderReset(), which selects
+ * OI_CODEC_SBC_BACKEND_AUTO. All backends produce bit-identical PCM.
+ *
+ * @param context   Pointer to the decoder context structure.
+ *
+ * @param backend   One of OI_CODEC_SBC_BACKEND_AUTO, OI_CODEC_SBC_BACKEND_C,
+ *                  OI_CODEC_SBC_BACKEND_SIMD.
+ *
+ * @return          OI_STATUS_NOT_IMPLEMENTED if OI_CODEC_SBC_BACKEND_SIMD is
+ *                  requested and not supported by the CPU. The selected
+ *                  backend is left unchanged in this case.
+ */
+OI_STATUS OI_CODEC_SBC_DecoderSetBackend(OI_CODEC_SBC_DECODER_CONTEXT* context,
+                                        OI_CODEC_SBC_BACKEND backend);
+
 /**
  * This function sets the decoder parameters for a raw decode where the decoder
  * parameters are not available in the sbc data stream.
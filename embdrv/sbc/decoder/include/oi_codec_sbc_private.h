@@ -201,6 +201,13 @@ PRIVATE void analyze8_enhanced_generated(
     OI_UINT strideShift, int32_t subband[8]);
 #endif
 
+/* SIMD backend, see synthesis-simd.c */
+PRIVATE OI_BOOL OI_SBC_SimdSupported(void);
+PRIVATE void OI_SBC_DequantFrame_simd(OI_CODEC_SBC_COMMON_CONTEXT* common);
+PRIVATE void SynthWindow80_simd(int16_t* pcm,
+                                SBC_BUFFER_T const* RESTRICT buffer,
+                                OI_UINT strideShift);
+
 /* Decoder functions */
 
 INLINE void OI_SBC_ReadHeader(OI_CODEC_SBC_COMMON_CONTEXT* common,
@@ -211,6 +218,9 @@ PRIVATE void OI_SBC_ReadSamples(OI_CODEC_SBC_DECODER_CONTEXT* common,
                                 OI_BITSTREAM* ob);
 PRIVATE void OI_SBC_ReadSamplesJoint(OI_CODEC_SBC_DECODER_CONTEXT* common,
                                      OI_BITSTREAM* global_bs);
+PRIVATE void OI_SBC_ReadRawSamples(OI_CODEC_SBC_DECODER_CONTEXT* context,
+                                   OI_BITSTREAM* global_bs);
+PRIVATE void OI_SBC_JointStereo(OI_CODEC_SBC_COMMON_CONTEXT* common);
 PRIVATE void OI_SBC_SynthFrame(OI_CODEC_SBC_DECODER_CONTEXT* context,
                                int16_t* pcm, OI_UINT start_block,
                                OI_UINT nrof_blocks);
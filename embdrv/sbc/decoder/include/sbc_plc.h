@@ -0,0 +1,84 @@
+/******************************************************************************
+ *
+ *  Copyright 2020 Google, Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/*******************************************************************************
+ *
+ *  Packet loss concealment for speech decoded from SCO links: mSBC frames
+ *  that fail to decode, or CVSD packets reported as erroneous by the
+ *  controller.
+ *
+ *  A lost frame is replaced by repeating the last pitch period of the
+ *  signal, found by matching the most recent samples against the history.
+ *  The repetition fades out after 10 ms of consecutive losses, and is
+ *  cross-faded into the next good frame.
+ *
+ ******************************************************************************/
+
+#ifndef SBC_PLC_H
+#define SBC_PLC_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Longest pitch period (15 ms) and pattern (1.5 ms) at 16 kHz */
+#define SBC_PLC_MAX_PERIOD 240
+#define SBC_PLC_MAX_TEMPLATE 24
+#define SBC_PLC_MAX_HISTORY (SBC_PLC_MAX_PERIOD + SBC_PLC_MAX_TEMPLATE)
+/* Cross-fade (1 ms) at 16 kHz */
+#define SBC_PLC_MAX_OVERLAP 16
+
+typedef struct {
+  /* Last samples output, the most recent at the end */
+  int16_t history[SBC_PLC_MAX_HISTORY];
+  /* Pitch period repeated during the current loss */
+  int16_t cycle[SBC_PLC_MAX_PERIOD];
+  /* Continuation of the concealment, cross-faded into the next good frame */
+  int16_t tail[SBC_PLC_MAX_OVERLAP];
+  uint16_t history_len;
+  uint16_t min_period;
+  uint16_t max_period;
+  uint16_t template_len;
+  uint16_t overlap_len;
+  uint16_t fade_start;
+  uint16_t fade_len;
+  /* State of the current loss */
+  uint16_t period;
+  uint16_t phase;
+  uint32_t concealed;
+} SBC_PLC_STATE;
+
+/* Resets |plc| for a signal sampled at |sample_rate| Hz, 8000 or 16000 */
+void sbc_plc_init(SBC_PLC_STATE* plc, uint32_t sample_rate);
+
+/* Passes a correctly received frame of |samples| samples from |in| to |out|,
+ * cross-fading it with the concealment when it ends a loss. |in| and |out|
+ * may be the same buffer. */
+void sbc_plc_good_frame(SBC_PLC_STATE* plc, const int16_t* in, int16_t* out,
+                        uint16_t samples);
+
+/* Writes |samples| samples of concealment for a lost frame to |out| */
+void sbc_plc_bad_frame(SBC_PLC_STATE* plc, int16_t* out, uint16_t samples);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SBC_PLC_H */
@@ -73,6 +73,7 @@ INLINE OI_STATUS internal_DecoderReset(OI_CODEC_SBC_DECODER_CONTEXT* context,
   context->common.codecInfo = OI_Codec_Copyright;
   context->common.maxBitneed = 0;
   context->limitFrameFormat = FALSE;
+  context->simdEnabled = OI_SBC_SimdSupported();
   OI_SBC_ExpandFrameFields(&context->common.frameInfo);
 
   /*PLATFORM_DECODER_RESET(context);*/
@@ -90,7 +91,16 @@ INLINE void OI_SBC_ReadHeader(OI_CODEC_SBC_COMMON_CONTEXT* common,
   OI_CODEC_SBC_FRAME_INFO* frame = &common->frameInfo;
   uint8_t d1;
 
-  OI_ASSERT(data[0] == OI_SBC_SYNCWORD || data[0] == OI_SBC_ENHANCED_SYNCWORD);
+  OI_ASSERT(data[0] == OI_SBC_SYNCWORD || data[0] == OI_SBC_ENHANCED_SYNCWORD ||
+            data[0] == OI_SBC_MSBC_SYNCWORD);
+
+  if (data[0] == OI_SBC_MSBC_SYNCWORD) {
+    /* The parameters were set by OI_CODEC_mSBC_DecoderReset(), data[1] and
+     * data[2] are reserved */
+    frame->bitpool = SBC_MSBC_BITPOOL;
+    frame->crc = data[3];
+    return;
+  }
 
   /* Avoid filling out all these strucutures if we already remember the values
    * from last time. Just in case we get a stream corresponding to data[1] ==
@@ -185,6 +195,13 @@ PRIVATE void OI_SBC_ReadSamples(OI_CODEC_SBC_DECODER_CONTEXT* context,
   OI_UINT bitPtr = global_bs->bitPtr;
   const OI_UINT iter_count =
       common->frameInfo.nrof_channels * common->frameInfo.nrof_subbands;
+
+  if (context->simdEnabled) {
+    OI_SBC_ReadRawSamples(context, global_bs);
+    OI_SBC_DequantFrame_simd(common);
+    return;
+  }
+
   do {
     OI_UINT n;
     for (n = 0; n < iter_count; ++n) {
@@ -203,6 +220,57 @@ PRIVATE void OI_SBC_ReadSamples(OI_CODEC_SBC_DECODER_CONTEXT* context,
   } while (--nrof_blocks);
 }
 
+/**
+ * Read quantized subband samples from the input bitstream without expanding
+ * them, so that the whole frame can be dequantized at once.
+ */
+PRIVATE void OI_SBC_ReadRawSamples(OI_CODEC_SBC_DECODER_CONTEXT* context,
+                                   OI_BITSTREAM* global_bs) {
+  OI_CODEC_SBC_COMMON_CONTEXT* common = &context->common;
+  OI_UINT nrof_blocks = common->frameInfo.nrof_blocks;
+  int32_t* RESTRICT s = common->subdata;
+  const uint8_t* ptr = global_bs->ptr.r;
+  uint32_t value = global_bs->value;
+  OI_UINT bitPtr = global_bs->bitPtr;
+  const OI_UINT iter_count =
+      common->frameInfo.nrof_channels * common->frameInfo.nrof_subbands;
+  do {
+    OI_UINT n;
+    for (n = 0; n < iter_count; ++n) {
+      uint32_t raw = 0;
+      OI_UINT bits = common->bits.uint8[n];
+      if (bits) {
+        OI_BITSTREAM_READUINT(raw, bits, ptr, value, bitPtr);
+      }
+      *s++ = (int32_t)raw;
+    }
+  } while (--nrof_blocks);
+}
+
+/** Convert the dequantized mid/side subbands of a joint stereo frame back to
+ * left/right. */
+PRIVATE void OI_SBC_JointStereo(OI_CODEC_SBC_COMMON_CONTEXT* common) {
+  OI_UINT nrof_subbands = common->frameInfo.nrof_subbands;
+  OI_UINT bl = common->frameInfo.nrof_blocks;
+  int32_t* RESTRICT s = common->subdata;
+  uint8_t jmask = common->frameInfo.join << (8 - nrof_subbands);
+
+  do {
+    uint8_t joint = jmask;
+    OI_UINT sb;
+    for (sb = 0; sb < nrof_subbands; sb++) {
+      if (joint & 0x80) {
+        int32_t mid = s[sb];
+        int32_t side = s[nrof_subbands + sb];
+        s[sb] = mid + side;
+        s[nrof_subbands + sb] = mid - side;
+      }
+      joint <<= 1;
+    }
+    s += 2 * nrof_subbands;
+  } while (--bl);
+}
+
 /**
 @}
 */
@@ -56,6 +56,18 @@ PRIVATE OI_STATUS FindSyncword(OI_CODEC_SBC_DECODER_CONTEXT* context,
     return OI_CODEC_SBC_NOT_ENOUGH_HEADER_DATA;
   }
 
+  if (context->mSbcEnabled) {
+    while (*frameBytes && (**frameData != OI_SBC_MSBC_SYNCWORD)) {
+      (*frameBytes)--;
+      (*frameData)++;
+    }
+    if (*frameBytes) {
+      context->common.frameInfo.enhanced = FALSE;
+      return OI_OK;
+    }
+    return OI_CODEC_SBC_NO_SYNCWORD;
+  }
+
 #ifdef SBC_ENHANCED
   if (context->limitFrameFormat && context->enhancedEnabled) {
     /* If the context is restricted, only search for specified SYNCWORD */
@@ -240,6 +252,46 @@ OI_STATUS OI_CODEC_SBC_DecoderReset(OI_CODEC_SBC_DECODER_CONTEXT* context,
                                maxChannels, pcmStride, enhanced);
 }
 
+OI_STATUS OI_CODEC_mSBC_DecoderReset(OI_CODEC_SBC_DECODER_CONTEXT* context,
+                                     uint32_t* decoderData,
+                                     uint32_t decoderDataBytes) {
+  OI_STATUS status = internal_DecoderReset(context, decoderData,
+                                           decoderDataBytes, 1, 1, FALSE);
+  if (!OI_SUCCESS(status)) {
+    return status;
+  }
+  context->mSbcEnabled = TRUE;
+  context->common.frameInfo.enhanced = FALSE;
+  context->common.frameInfo.freqIndex = SBC_FREQ_16000;
+  context->common.frameInfo.mode = SBC_MONO;
+  context->common.frameInfo.subbands = SBC_SUBBANDS_8;
+  context->common.frameInfo.alloc = SBC_LOUDNESS;
+  context->common.frameInfo.bitpool = SBC_MSBC_BITPOOL;
+  OI_SBC_ExpandFrameFields(&context->common.frameInfo);
+  /* 15 blocks cannot be expressed in a classic SBC header */
+  context->common.frameInfo.nrof_blocks = SBC_MSBC_BLOCKS;
+  return OI_OK;
+}
+
+OI_STATUS OI_CODEC_SBC_DecoderSetBackend(OI_CODEC_SBC_DECODER_CONTEXT* context,
+                                        OI_CODEC_SBC_BACKEND backend) {
+  switch (backend) {
+    case OI_CODEC_SBC_BACKEND_AUTO:
+      context->simdEnabled = OI_SBC_SimdSupported();
+      return OI_OK;
+    case OI_CODEC_SBC_BACKEND_C:
+      context->simdEnabled = FALSE;
+      return OI_OK;
+    case OI_CODEC_SBC_BACKEND_SIMD:
+      if (!OI_SBC_SimdSupported()) {
+        return OI_STATUS_NOT_IMPLEMENTED;
+      }
+      context->simdEnabled = TRUE;
+      return OI_OK;
+  }
+  return OI_STATUS_INVALID_PARAMETERS;
+}
+
 OI_STATUS OI_CODEC_SBC_DecodeFrame(OI_CODEC_SBC_DECODER_CONTEXT* context,
                                    const OI_BYTE** frameData,
                                    uint32_t* frameBytes, int16_t* pcmData,
@@ -469,6 +521,14 @@ PRIVATE void OI_SBC_ReadSamplesJoint(OI_CODEC_SBC_DECODER_CONTEXT* context,
                                      OI_BITSTREAM* global_bs) {
   OI_CODEC_SBC_COMMON_CONTEXT* common = &context->common;
   OI_UINT nrof_subbands = common->frameInfo.nrof_subbands;
+
+  if (context->simdEnabled) {
+    OI_SBC_ReadRawSamples(context, global_bs);
+    OI_SBC_DequantFrame_simd(common);
+    OI_SBC_JointStereo(common);
+    return;
+  }
+
 #ifdef SPECIALIZE_READ_SAMPLES_JOINT
   OI_ASSERT((nrof_subbands >> 3u) <= 1u);
   SpecializedReadSamples[nrof_subbands >> 3](context, global_bs);
@@ -0,0 +1,141 @@
+/******************************************************************************
+ *
+ *  Copyright 2020 Google, Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include "sbc_plc.h"
+
+#include <string.h>
+
+void sbc_plc_init(SBC_PLC_STATE* plc, uint32_t sample_rate) {
+  /* Durations below are given at 8 kHz */
+  uint16_t scale = (sample_rate >= 16000) ? 2 : 1;
+
+  memset(plc, 0, sizeof(*plc));
+  plc->min_period = 20 * scale;   /* 2.5 ms, 400 Hz */
+  plc->max_period = 120 * scale;  /* 15 ms, 66 Hz */
+  plc->template_len = 12 * scale; /* 1.5 ms */
+  plc->overlap_len = 8 * scale;   /* 1 ms */
+  plc->fade_start = 80 * scale;   /* 10 ms */
+  plc->fade_len = 320 * scale;    /* 40 ms */
+  plc->history_len = plc->max_period + plc->template_len;
+}
+
+static void append_history(SBC_PLC_STATE* plc, const int16_t* samples,
+                           uint16_t count) {
+  uint16_t len = plc->history_len;
+
+  if (count >= len) {
+    memcpy(plc->history, samples + count - len, len * sizeof(int16_t));
+    return;
+  }
+  memmove(plc->history, plc->history + count,
+          (len - count) * sizeof(int16_t));
+  memcpy(plc->history + len - count, samples, count * sizeof(int16_t));
+}
+
+/* Returns the pitch period whose previous occurrence of the most recent
+ * samples matches them best, by normalized cross-correlation */
+static uint16_t find_period(const SBC_PLC_STATE* plc) {
+  const int16_t* pattern =
+      plc->history + plc->history_len - plc->template_len;
+  uint16_t best_period = plc->max_period;
+  double best_score = 0;
+  uint16_t period;
+  uint16_t i;
+
+  for (period = plc->min_period; period <= plc->max_period; period++) {
+    const int16_t* candidate = pattern - period;
+    int64_t correlation = 0;
+    int64_t energy = 0;
+    double score;
+
+    for (i = 0; i < plc->template_len; i++) {
+      correlation += (int32_t)pattern[i] * candidate[i];
+      energy += (int32_t)candidate[i] * candidate[i];
+    }
+    if (correlation <= 0) continue;
+    /* The square of correlation / sqrt(energy), cheaper and same order */
+    score = (double)correlation * (double)correlation / (double)energy;
+    if (score > best_score) {
+      best_score = score;
+      best_period = period;
+    }
+  }
+  return best_period;
+}
+
+static int16_t attenuate(const SBC_PLC_STATE* plc, int16_t sample,
+                         uint32_t concealed) {
+  uint32_t fade_end = (uint32_t)plc->fade_start + plc->fade_len;
+
+  if (concealed < plc->fade_start) return sample;
+  if (concealed >= fade_end) return 0;
+  return (int16_t)((int32_t)sample * (int32_t)(fade_end - concealed) /
+                   plc->fade_len);
+}
+
+void sbc_plc_bad_frame(SBC_PLC_STATE* plc, int16_t* out, uint16_t samples) {
+  uint16_t phase;
+  uint32_t concealed;
+  uint16_t i;
+
+  if (plc->period == 0) {
+    /* First lost frame: the concealment repeats the last pitch period */
+    plc->period = find_period(plc);
+    memcpy(plc->cycle, plc->history + plc->history_len - plc->period,
+           plc->period * sizeof(int16_t));
+    plc->phase = 0;
+    plc->concealed = 0;
+  }
+
+  for (i = 0; i < samples; i++) {
+    out[i] = attenuate(plc, plc->cycle[plc->phase], plc->concealed);
+    plc->concealed++;
+    if (++plc->phase == plc->period) plc->phase = 0;
+  }
+
+  /* The samples that would follow, to fade into the next good frame */
+  phase = plc->phase;
+  concealed = plc->concealed;
+  for (i = 0; i < plc->overlap_len; i++) {
+    plc->tail[i] = attenuate(plc, plc->cycle[phase], concealed++);
+    if (++phase == plc->period) phase = 0;
+  }
+
+  append_history(plc, out, samples);
+}
+
+void sbc_plc_good_frame(SBC_PLC_STATE* plc, const int16_t* in, int16_t* out,
+                        uint16_t samples) {
+  uint16_t overlap = plc->overlap_len;
+  uint16_t i = 0;
+
+  if (plc->period != 0) {
+    /* End of a loss: cross-fade from the concealment to the signal */
+    for (; i < overlap && i < samples; i++) {
+      out[i] = (int16_t)(((int32_t)plc->tail[i] * (overlap - i) +
+                          (int32_t)in[i] * i) /
+                         overlap);
+    }
+    plc->period = 0;
+  }
+  if (out != in) {
+    memcpy(out + i, in + i, (samples - i) * sizeof(int16_t));
+  }
+
+  append_history(plc, out, samples);
+}
@@ -0,0 +1,338 @@
+/******************************************************************************
+ *
+ *  Copyright 2020 Google, Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/*******************************************************************************
+  $Revision: #1 $
+ ******************************************************************************/
+
+/** @file
+
+NEON and AVX2 implementations of the dequantization and of the 8-subband
+synthesis window, selected with OI_CODEC_SBC_DecoderSetBackend().
+
+Both are bit-exact with OI_SBC_Dequant() and SynthWindow80_generated(): the
+same 32-bit products, shifts and wrapping sums are computed, one output sample
+or one subband sample per lane.
+
+@ingroup codec_internal
+*/
+
+/**
+@addtogroup codec_internal
+@{
+*/
+
+#include "oi_codec_sbc_private.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define OI_SBC_SIMD_AVX2
+#define SIMD_TARGET __attribute__((target("avx2")))
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define OI_SBC_SIMD_NEON
+#if !defined(__aarch64__)
+#include <sys/auxv.h>
+#ifndef HWCAP_NEON
+#define HWCAP_NEON (1 << 12)
+#endif
+#endif
+#endif
+
+/* Must match dequant.c */
+#ifndef SBC_DEQUANT_LONG_SCALED_OFFSET
+#define SBC_DEQUANT_LONG_SCALED_OFFSET 1555931970
+#endif
+
+extern const uint32_t dequant_long_scaled[17];
+
+PRIVATE void SynthWindow80_generated(int16_t* pcm,
+                                     SBC_BUFFER_T const* RESTRICT buffer,
+                                     OI_UINT strideShift);
+
+#if defined(OI_SBC_SIMD_AVX2) || defined(OI_SBC_SIMD_NEON)
+
+/*
+ * SynthWindow80_generated() as 10 vectors of 8 lanes, lane j producing
+ * pcm[j]. For each of the 5 taps m, the even vector multiplies the samples
+ * buffer[16m + {4, 5, 6, 7, 8, 7, 6, 5}] and the odd vector the samples
+ * buffer[16m + {12, 11, 10, 9, 8, 9, 10, 11}]. Shifts are to the left when
+ * positive and to the right when negative.
+ */
+static const int16_t synth80_coef[10][8] = {
+    {0, -3263, -10385, -16457, 10445, 16913, 11167, 9293},
+    {8235, 29293, 24995, 19083, 0, -8443, -10337, -6087},
+    {-23167, -5229, -309, -23641, -5297, 3687, 1917, 1247},
+    {26479, 30835, 9161, -29015, 0, -301, -30605, -2893},
+    {-17397, -27021, -23063, -12889, 22299, 15447, 8317, 23671},
+    {9399, 31633, 27561, 6145, 0, 10255, 9553, 18055},
+    {17397, 17319, 2309, 24211, 10603, -18233, 22117, 11537},
+    {26479, 26663, 12705, 23469, 0, 9405, 16383, 1747},
+    {23167, 4555, 6239, 21223, 9539, 1499, 7543, 685},
+    {8235, 12419, 9251, 26913, 0, 26189, 8603, 8721},
+};
+
+static const int32_t synth80_shift[10][8] = {
+    {0, -5, -6, -6, -4, -5, -4, -3},
+    {-3, -5, -5, -5, 0, -7, -4, -2},
+    {-3, 0, 4, -2, 1, 1, 2, 3},
+    {-2, -3, -3, -4, 0, 5, -1, 3},
+    {1, 1, 1, 2, 2, 2, 3, 2},
+    {3, 1, 1, 3, 0, 2, 2, 1},
+    {1, 1, 3, -1, 0, -3, -4, -1},
+    {-2, -2, -1, -2, 0, -1, -2, 1},
+    {-3, -1, -3, -8, -4, -1, -3, 1},
+    {-3, -4, -4, -6, 0, -7, -6, -7},
+};
+
+#endif
+
+#if defined(OI_SBC_SIMD_AVX2)
+
+SIMD_TARGET static __m256i synth80_term(__m128i samples, OI_UINT v) {
+  __m256i x = _mm256_cvtepi16_epi32(samples);
+  __m256i c = _mm256_cvtepi16_epi32(
+      _mm_loadu_si128((const __m128i*)synth80_coef[v]));
+  __m256i shift = _mm256_loadu_si256((const __m256i*)synth80_shift[v]);
+  __m256i left = _mm256_max_epi32(shift, _mm256_setzero_si256());
+  __m256i right = _mm256_sub_epi32(left, shift);
+  __m256i prod = _mm256_mullo_epi32(x, c);
+  return _mm256_srav_epi32(_mm256_sllv_epi32(prod, left), right);
+}
+
+#define REVERSE4(x) _mm_shufflelo_epi16(x, _MM_SHUFFLE(0, 1, 2, 3))
+#define LOAD4(p) _mm_loadl_epi64((const __m128i*)(p))
+
+SIMD_TARGET static void SynthWindow80_avx2(int16_t* pcm,
+                                           SBC_BUFFER_T const* RESTRICT buffer,
+                                           OI_UINT strideShift) {
+  __m256i acc = _mm256_setzero_si256();
+  __m128i out;
+  OI_UINT m;
+
+  for (m = 0; m < 5; m++) {
+    SBC_BUFFER_T const* p = buffer + 16 * m;
+    __m128i a = _mm_unpacklo_epi64(LOAD4(p + 4), REVERSE4(LOAD4(p + 5)));
+    __m128i b = _mm_unpacklo_epi64(REVERSE4(LOAD4(p + 9)), LOAD4(p + 8));
+    acc = _mm256_add_epi32(acc, synth80_term(a, 2 * m));
+    acc = _mm256_add_epi32(acc, synth80_term(b, 2 * m + 1));
+  }
+
+  /* Division by 32768 rounding toward zero, then CLIP_INT16 */
+  acc = _mm256_add_epi32(acc, _mm256_and_si256(_mm256_srai_epi32(acc, 31),
+                                               _mm256_set1_epi32(32767)));
+  acc = _mm256_srai_epi32(acc, 15);
+  out = _mm_packs_epi32(_mm256_castsi256_si128(acc),
+                        _mm256_extracti128_si256(acc, 1));
+
+  if (strideShift == 0) {
+    _mm_storeu_si128((__m128i*)pcm, out);
+  } else {
+    int16_t tmp[8];
+    OI_UINT i;
+    _mm_storeu_si128((__m128i*)tmp, out);
+    for (i = 0; i < 8; i++) {
+      pcm[i << strideShift] = tmp[i];
+    }
+  }
+}
+
+#undef REVERSE4
+#undef LOAD4
+
+SIMD_TARGET static void DequantFrame_avx2(OI_CODEC_SBC_COMMON_CONTEXT* common,
+                                          const uint32_t* mult,
+                                          const int32_t* keep,
+                                          const int32_t* shift) {
+  OI_UINT nrof_blocks = common->frameInfo.nrof_blocks;
+  OI_UINT count =
+      common->frameInfo.nrof_channels * common->frameInfo.nrof_subbands;
+  const __m128i one = _mm_set1_epi32(1);
+  const __m128i offset = _mm_set1_epi32(SBC_DEQUANT_LONG_SCALED_OFFSET);
+  OI_UINT n;
+
+  for (n = 0; n < count; n += 4) {
+    __m128i m = _mm_loadu_si128((const __m128i*)(mult + n));
+    __m128i k = _mm_loadu_si128((const __m128i*)(keep + n));
+    __m128i sh = _mm_loadu_si128((const __m128i*)(shift + n));
+    int32_t* s = common->subdata + n;
+    OI_UINT blk;
+
+    for (blk = 0; blk < nrof_blocks; blk++, s += count) {
+      __m128i d = _mm_loadu_si128((const __m128i*)s);
+      d = _mm_or_si128(_mm_slli_epi32(d, 1), one);
+      d = _mm_sub_epi32(_mm_mullo_epi32(d, m), offset);
+      d = _mm_and_si128(_mm_srav_epi32(d, sh), k);
+      _mm_storeu_si128((__m128i*)s, d);
+    }
+  }
+}
+
+static OI_BOOL cpu_has_simd(void) {
+  return __builtin_cpu_supports("avx2") ? TRUE : FALSE;
+}
+
+#elif defined(OI_SBC_SIMD_NEON)
+
+static int32x4_t synth80_term(int16x4_t samples, const int16_t* coef,
+                              const int32_t* shift) {
+  return vshlq_s32(vmull_s16(samples, vld1_s16(coef)), vld1q_s32(shift));
+}
+
+static void SynthWindow80_neon(int16_t* pcm,
+                               SBC_BUFFER_T const* RESTRICT buffer,
+                               OI_UINT strideShift) {
+  int32x4_t lo = vdupq_n_s32(0);
+  int32x4_t hi = vdupq_n_s32(0);
+  int16x8_t out;
+  OI_UINT m;
+
+  for (m = 0; m < 5; m++) {
+    SBC_BUFFER_T const* p = buffer + 16 * m;
+    int16x4_t a_lo = vld1_s16(p + 4);
+    int16x4_t a_hi = vrev64_s16(vld1_s16(p + 5));
+    int16x4_t b_lo = vrev64_s16(vld1_s16(p + 9));
+    int16x4_t b_hi = vld1_s16(p + 8);
+    OI_UINT a = 2 * m;
+    OI_UINT b = 2 * m + 1;
+
+    lo = vaddq_s32(lo, synth80_term(a_lo, synth80_coef[a], synth80_shift[a]));
+    hi = vaddq_s32(hi, synth80_term(a_hi, synth80_coef[a] + 4,
+                                    synth80_shift[a] + 4));
+    lo = vaddq_s32(lo, synth80_term(b_lo, synth80_coef[b], synth80_shift[b]));
+    hi = vaddq_s32(hi, synth80_term(b_hi, synth80_coef[b] + 4,
+                                    synth80_shift[b] + 4));
+  }
+
+  /* Division by 32768 rounding toward zero, then CLIP_INT16 */
+  lo = vaddq_s32(lo, vandq_s32(vshrq_n_s32(lo, 31), vdupq_n_s32(32767)));
+  hi = vaddq_s32(hi, vandq_s32(vshrq_n_s32(hi, 31), vdupq_n_s32(32767)));
+  out = vcombine_s16(vqshrn_n_s32(lo, 15), vqshrn_n_s32(hi, 15));
+
+  if (strideShift == 0) {
+    vst1q_s16(pcm, out);
+  } else {
+    int16_t tmp[8];
+    OI_UINT i;
+    vst1q_s16(tmp, out);
+    for (i = 0; i < 8; i++) {
+      pcm[i << strideShift] = tmp[i];
+    }
+  }
+}
+
+static void DequantFrame_neon(OI_CODEC_SBC_COMMON_CONTEXT* common,
+                              const uint32_t* mult, const int32_t* keep,
+                              const int32_t* shift) {
+  OI_UINT nrof_blocks = common->frameInfo.nrof_blocks;
+  OI_UINT count =
+      common->frameInfo.nrof_channels * common->frameInfo.nrof_subbands;
+  const uint32x4_t offset = vdupq_n_u32(SBC_DEQUANT_LONG_SCALED_OFFSET);
+  OI_UINT n;
+
+  for (n = 0; n < count; n += 4) {
+    uint32x4_t m = vld1q_u32(mult + n);
+    int32x4_t k = vld1q_s32(keep + n);
+    int32x4_t sh = vnegq_s32(vld1q_s32(shift + n));
+    int32_t* s = common->subdata + n;
+    OI_UINT blk;
+
+    for (blk = 0; blk < nrof_blocks; blk++, s += count) {
+      uint32x4_t d = vreinterpretq_u32_s32(vld1q_s32(s));
+      int32x4_t result;
+      d = vorrq_u32(vshlq_n_u32(d, 1), vdupq_n_u32(1));
+      d = vsubq_u32(vmulq_u32(d, m), offset);
+      result = vshlq_s32(vreinterpretq_s32_u32(d), sh);
+      vst1q_s32(s, vandq_s32(result, k));
+    }
+  }
+}
+
+static OI_BOOL cpu_has_simd(void) {
+#if defined(__aarch64__)
+  /* NEON is mandatory on ARMv8-A */
+  return TRUE;
+#else
+  return (getauxval(AT_HWCAP) & HWCAP_NEON) ? TRUE : FALSE;
+#endif
+}
+
+#endif
+
+PRIVATE OI_BOOL OI_SBC_SimdSupported(void) {
+#if defined(OI_SBC_SIMD_AVX2) || defined(OI_SBC_SIMD_NEON)
+  return cpu_has_simd();
+#else
+  return FALSE;
+#endif
+}
+
+/** Dequantize in place the raw samples of a frame read by
+ * OI_SBC_ReadRawSamples(). */
+PRIVATE void OI_SBC_DequantFrame_simd(OI_CODEC_SBC_COMMON_CONTEXT* common) {
+  OI_UINT count =
+      common->frameInfo.nrof_channels * common->frameInfo.nrof_subbands;
+  uint32_t mult[SBC_MAX_CHANNELS * SBC_MAX_BANDS];
+  int32_t keep[SBC_MAX_CHANNELS * SBC_MAX_BANDS];
+  int32_t shift[SBC_MAX_CHANNELS * SBC_MAX_BANDS];
+  OI_UINT n;
+
+  /* Bit allocation and scale factors are constant over the frame */
+  for (n = 0; n < count; n++) {
+    OI_UINT bits = common->bits.uint8[n];
+    OI_ASSERT(common->scale_factor[n] <= 15);
+    OI_ASSERT(bits <= 16);
+    mult[n] = (bits <= 1) ? 0 : dequant_long_scaled[bits];
+    keep[n] = (bits <= 1) ? 0 : -1;
+    shift[n] = 15 - common->scale_factor[n];
+  }
+
+#if defined(OI_SBC_SIMD_AVX2)
+  DequantFrame_avx2(common, mult, keep, shift);
+#elif defined(OI_SBC_SIMD_NEON)
+  DequantFrame_neon(common, mult, keep, shift);
+#else
+  {
+    OI_UINT nrof_blocks = common->frameInfo.nrof_blocks;
+    int32_t* s = common->subdata;
+    do {
+      for (n = 0; n < count; n++, s++) {
+        uint32_t d = ((uint32_t)*s * 2 + 1) * mult[n];
+        *s = ((int32_t)(d - SBC_DEQUANT_LONG_SCALED_OFFSET) >> shift[n]) &
+             keep[n];
+      }
+    } while (--nrof_blocks);
+  }
+#endif
+}
+
+PRIVATE void SynthWindow80_simd(int16_t* pcm,
+                                SBC_BUFFER_T const* RESTRICT buffer,
+                                OI_UINT strideShift) {
+#if defined(OI_SBC_SIMD_AVX2)
+  SynthWindow80_avx2(pcm, buffer, strideShift);
+#elif defined(OI_SBC_SIMD_NEON)
+  SynthWindow80_neon(pcm, buffer, strideShift);
+#else
+  SynthWindow80_generated(pcm, buffer, strideShift);
+#endif
+}
+
+/**
+@}
+*/
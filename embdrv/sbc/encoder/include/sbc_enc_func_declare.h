@@ -35,6 +35,24 @@ extern const int32_t gas32CoeffFor4SBs[];
 extern const int32_t gas32CoeffFor8SBs[];
 #endif
 
+#if (SBC_SIMD_OPT == TRUE)
+/* Window coefficients laid out per output sample: s32DCTY[i] is the sum over
+ * j of gas16WindowLanesN[j * 2N + i] * s16X[ChOffset + j * 2N + i] */
+extern const int16_t gas16WindowLanes4[];
+extern const int16_t gas16WindowLanes8[];
+
+typedef struct {
+  void (*Window4)(const int16_t* ps16X, int32_t* ps32DCTY);
+  void (*Window8)(const int16_t* ps16X, int32_t* ps32DCTY);
+  /* Returns the number of bits taken by the bitslice |s32BitSlice| */
+  int32_t (*CountSlices)(const int16_t* ps16BitNeed, int32_t s32NumOfBitNeed,
+                         int32_t s32BitSlice);
+} SBC_SIMD_FUNCS;
+
+/* Set by SbcAnalysisInit, SBC_NULL when the C implementation must be used */
+extern const SBC_SIMD_FUNCS* psSbcSimdFuncs;
+#endif
+
 /* Global functions*/
 
 extern void sbc_enc_bit_alloc_mono(SBC_ENC_PARAMS* CodecParams);
@@ -48,6 +66,10 @@ extern void SbcAnalysisFilter8(SBC_ENC_PARAMS* strEncParams, int16_t* input);
 extern void SBC_FastIDCT8(int32_t* pInVect, int32_t* pOutVect);
 extern void SBC_FastIDCT4(int32_t* x0, int32_t* pOutVect);
 
+#if (SBC_SIMD_OPT == TRUE)
+extern const SBC_SIMD_FUNCS* sbc_enc_get_simd_funcs(void);
+#endif
+
 extern uint32_t EncPacking(SBC_ENC_PARAMS* strEncParams, uint8_t* output);
 extern void EncQuantizer(SBC_ENC_PARAMS*);
 #if (SBC_DSP_OPT == TRUE)
@@ -65,6 +65,13 @@
 
 #define SBC_NULL 0
 
+/* mSBC, the wideband speech codec of the Hands-Free Profile: 16 kHz mono, 15
+ * blocks of 8 subbands, loudness allocation and a fixed bitpool */
+#define SBC_MSBC_BLOCKS 15
+#define SBC_MSBC_BITPOOL 26
+#define SBC_MSBC_FRAME_LEN 57
+#define SBC_MSBC_SAMPLES_PER_FRAME (SBC_MSBC_BLOCKS * SUB_BANDS_8)
+
 #ifndef SBC_MAX_NUM_FRAME
 #define SBC_MAX_NUM_FRAME 1
 #endif
@@ -138,6 +145,20 @@
 #define SBC_FAST_DCT TRUE
 #endif /*SBC_FAST_DCT */
 
+/* Set SBC_SIMD_OPT to TRUE to use the NEON or SSE2 implementation of the
+ * windowing and of the bit allocation when the CPU supports it. The output is
+ * bit-exact with the C implementation. It only applies to the 16 bit
+ * multiplication in the window accumulation of the SBC_IPAQ_OPT flavour.
+ */
+#ifndef SBC_SIMD_OPT
+#if ((SBC_ARM_ASM_OPT == FALSE) && (SBC_IPAQ_OPT == TRUE) && \
+     (SBC_IS_64_MULT_IN_WINDOW_ACCU == FALSE))
+#define SBC_SIMD_OPT TRUE
+#else
+#define SBC_SIMD_OPT FALSE
+#endif
+#endif /*SBC_SIMD_OPT */
+
 /* In case we do not use joint stereo mode the flag save some RAM and ROM in
  * case it is set to FALSE */
 #ifndef SBC_JOINT_STE_INCLUDED
@@ -185,6 +206,8 @@ typedef struct SBC_ENC_PARAMS_TAG {
 
   uint16_t FrameHeader;
 
+  int16_t mSBCEnabled; /* TRUE to encode mSBC frames, the other parameters
+                          are then set by SBC_Encoder_Init */
 } SBC_ENC_PARAMS;
 
 #ifdef __cplusplus
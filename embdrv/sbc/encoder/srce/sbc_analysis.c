@@ -197,6 +197,68 @@
 #define WIND_8_SUBBANDS_8_2 (int16_t)0x12CF /* 40 = 0x12CF6C75 */
 #endif
 
+#if (SBC_SIMD_OPT == TRUE)
+/* Same coefficients as WINDOW_PARTIAL_4 and WINDOW_PARTIAL_8, one row per
+ * tap so that all the outputs of a block can be accumulated in parallel */
+const int16_t gas16WindowLanes4[5 * 8] = {
+    0, WIND_4_SUBBANDS_1_0, WIND_4_SUBBANDS_2_0, WIND_4_SUBBANDS_3_0,
+    WIND_4_SUBBANDS_4_0, WIND_4_SUBBANDS_3_4, WIND_4_SUBBANDS_2_4,
+    WIND_4_SUBBANDS_1_4,
+
+    WIND_4_SUBBANDS_0_1, WIND_4_SUBBANDS_1_1, WIND_4_SUBBANDS_2_1,
+    WIND_4_SUBBANDS_3_1, WIND_4_SUBBANDS_4_1, WIND_4_SUBBANDS_3_3,
+    WIND_4_SUBBANDS_2_3, WIND_4_SUBBANDS_1_3,
+
+    WIND_4_SUBBANDS_0_2, WIND_4_SUBBANDS_1_2, WIND_4_SUBBANDS_2_2,
+    WIND_4_SUBBANDS_3_2, WIND_4_SUBBANDS_4_2, WIND_4_SUBBANDS_3_2,
+    WIND_4_SUBBANDS_2_2, WIND_4_SUBBANDS_1_2,
+
+    -WIND_4_SUBBANDS_0_2, WIND_4_SUBBANDS_1_3, WIND_4_SUBBANDS_2_3,
+    WIND_4_SUBBANDS_3_3, WIND_4_SUBBANDS_4_1, WIND_4_SUBBANDS_3_1,
+    WIND_4_SUBBANDS_2_1, WIND_4_SUBBANDS_1_1,
+
+    -WIND_4_SUBBANDS_0_1, WIND_4_SUBBANDS_1_4, WIND_4_SUBBANDS_2_4,
+    WIND_4_SUBBANDS_3_4, WIND_4_SUBBANDS_4_0, WIND_4_SUBBANDS_3_0,
+    WIND_4_SUBBANDS_2_0, WIND_4_SUBBANDS_1_0,
+};
+
+const int16_t gas16WindowLanes8[5 * 16] = {
+    0, WIND_8_SUBBANDS_1_0, WIND_8_SUBBANDS_2_0, WIND_8_SUBBANDS_3_0,
+    WIND_8_SUBBANDS_4_0, WIND_8_SUBBANDS_5_0, WIND_8_SUBBANDS_6_0,
+    WIND_8_SUBBANDS_7_0, WIND_8_SUBBANDS_8_0, WIND_8_SUBBANDS_7_4,
+    WIND_8_SUBBANDS_6_4, WIND_8_SUBBANDS_5_4, WIND_8_SUBBANDS_4_4,
+    WIND_8_SUBBANDS_3_4, WIND_8_SUBBANDS_2_4, WIND_8_SUBBANDS_1_4,
+
+    WIND_8_SUBBANDS_0_1, WIND_8_SUBBANDS_1_1, WIND_8_SUBBANDS_2_1,
+    WIND_8_SUBBANDS_3_1, WIND_8_SUBBANDS_4_1, WIND_8_SUBBANDS_5_1,
+    WIND_8_SUBBANDS_6_1, WIND_8_SUBBANDS_7_1, WIND_8_SUBBANDS_8_1,
+    WIND_8_SUBBANDS_7_3, WIND_8_SUBBANDS_6_3, WIND_8_SUBBANDS_5_3,
+    WIND_8_SUBBANDS_4_3, WIND_8_SUBBANDS_3_3, WIND_8_SUBBANDS_2_3,
+    WIND_8_SUBBANDS_1_3,
+
+    WIND_8_SUBBANDS_0_2, WIND_8_SUBBANDS_1_2, WIND_8_SUBBANDS_2_2,
+    WIND_8_SUBBANDS_3_2, WIND_8_SUBBANDS_4_2, WIND_8_SUBBANDS_5_2,
+    WIND_8_SUBBANDS_6_2, WIND_8_SUBBANDS_7_2, WIND_8_SUBBANDS_8_2,
+    WIND_8_SUBBANDS_7_2, WIND_8_SUBBANDS_6_2, WIND_8_SUBBANDS_5_2,
+    WIND_8_SUBBANDS_4_2, WIND_8_SUBBANDS_3_2, WIND_8_SUBBANDS_2_2,
+    WIND_8_SUBBANDS_1_2,
+
+    -WIND_8_SUBBANDS_0_2, WIND_8_SUBBANDS_1_3, WIND_8_SUBBANDS_2_3,
+    WIND_8_SUBBANDS_3_3, WIND_8_SUBBANDS_4_3, WIND_8_SUBBANDS_5_3,
+    WIND_8_SUBBANDS_6_3, WIND_8_SUBBANDS_7_3, WIND_8_SUBBANDS_8_1,
+    WIND_8_SUBBANDS_7_1, WIND_8_SUBBANDS_6_1, WIND_8_SUBBANDS_5_1,
+    WIND_8_SUBBANDS_4_1, WIND_8_SUBBANDS_3_1, WIND_8_SUBBANDS_2_1,
+    WIND_8_SUBBANDS_1_1,
+
+    -WIND_8_SUBBANDS_0_1, WIND_8_SUBBANDS_1_4, WIND_8_SUBBANDS_2_4,
+    WIND_8_SUBBANDS_3_4, WIND_8_SUBBANDS_4_4, WIND_8_SUBBANDS_5_4,
+    WIND_8_SUBBANDS_6_4, WIND_8_SUBBANDS_7_4, WIND_8_SUBBANDS_8_0,
+    WIND_8_SUBBANDS_7_0, WIND_8_SUBBANDS_6_0, WIND_8_SUBBANDS_5_0,
+    WIND_8_SUBBANDS_4_0, WIND_8_SUBBANDS_3_0, WIND_8_SUBBANDS_2_0,
+    WIND_8_SUBBANDS_1_0,
+};
+#endif
+
 #if (SBC_USE_ARM_PRAGMA == TRUE)
 #pragma arm section zidata = "sbc_s32_analysis_section"
 #endif
@@ -1187,6 +1249,9 @@ static int16_t* s16X =
 
 static int16_t ShiftCounter = 0;
 extern int16_t EncMaxShiftCounter;
+#if (SBC_SIMD_OPT == TRUE)
+const SBC_SIMD_FUNCS* psSbcSimdFuncs = SBC_NULL;
+#endif
 /****************************************************************************
 * SbcAnalysisFilter - performs Analysis of the input audio stream
 *
@@ -1257,7 +1322,12 @@ void SbcAnalysisFilter4(SBC_ENC_PARAMS* pstrEncParams, int16_t* input) {
     for (s32Ch = 0; s32Ch < s32NumOfChannels; s32Ch++) {
       ChOffset = s32Ch * Offset2 + Offset;
 
-      WINDOW_PARTIAL_4
+#if (SBC_SIMD_OPT == TRUE)
+      if (psSbcSimdFuncs != SBC_NULL)
+        psSbcSimdFuncs->Window4(s16X + ChOffset, s32DCTY);
+      else
+#endif
+        WINDOW_PARTIAL_4
 
       SBC_FastIDCT4(s32DCTY, ps32SbBuf);
 
@@ -1370,7 +1440,12 @@ void SbcAnalysisFilter8(SBC_ENC_PARAMS* pstrEncParams, int16_t* input) {
     for (s32Ch = 0; s32Ch < s32NumOfChannels; s32Ch++) {
       ChOffset = s32Ch * Offset2 + Offset;
 
-      WINDOW_PARTIAL_8
+#if (SBC_SIMD_OPT == TRUE)
+      if (psSbcSimdFuncs != SBC_NULL)
+        psSbcSimdFuncs->Window8(s16X + ChOffset, s32DCTY);
+      else
+#endif
+        WINDOW_PARTIAL_8
 
       SBC_FastIDCT8(s32DCTY, ps32SbBuf);
 
@@ -1397,4 +1472,7 @@ void SbcAnalysisFilter8(SBC_ENC_PARAMS* pstrEncParams, int16_t* input) {
 void SbcAnalysisInit(void) {
   memset(s16X, 0, ENC_VX_BUFFER_SIZE * sizeof(int16_t));
   ShiftCounter = 0;
+#if (SBC_SIMD_OPT == TRUE)
+  psSbcSimdFuncs = sbc_enc_get_simd_funcs();
+#endif
 }
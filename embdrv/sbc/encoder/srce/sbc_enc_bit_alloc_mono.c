@@ -112,6 +112,13 @@ void sbc_enc_bit_alloc_mono(SBC_ENC_PARAMS* pstrCodecParams) {
       s32BitCount -= s32SliceCount;
       s32SliceCount = 0;
 
+#if (SBC_SIMD_OPT == TRUE)
+      if (psSbcSimdFuncs != SBC_NULL) {
+        s32SliceCount = psSbcSimdFuncs->CountSlices(
+            ps16GenBufPtr, s32NumOfSubBands, s32BitSlice);
+        continue;
+      }
+#endif
       for (s32Sb = 0; s32Sb < s32NumOfSubBands; s32Sb++) {
         if ((((*ps16GenBufPtr - s32BitSlice) < 16) &&
              (*ps16GenBufPtr - s32BitSlice) >= 1)) {
@@ -104,6 +104,13 @@ void sbc_enc_bit_alloc_ste(SBC_ENC_PARAMS* pstrCodecParams) {
     s32SliceCount = 0;
     ps16GenBufPtr = ps16BitNeed;
 
+#if (SBC_SIMD_OPT == TRUE)
+    if (psSbcSimdFuncs != SBC_NULL) {
+      s32SliceCount = psSbcSimdFuncs->CountSlices(
+          ps16BitNeed, 2 * s32NumOfSubBands, s32BitSlice);
+      continue;
+    }
+#endif
     for (s32Sb = 0; s32Sb < 2 * s32NumOfSubBands; s32Sb++) {
       if ((*ps16GenBufPtr >= s32BitSlice + 1) &&
           (*ps16GenBufPtr < s32BitSlice + 16)) {
@@ -0,0 +1,243 @@
+/******************************************************************************
+ *
+ *  Copyright 2020 Google, Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  NEON and SSE2 implementations of the analysis windowing and of the
+ *  bitslice counting of the bit allocation. The results are bit-exact with
+ *  the C implementation: all products are 16x16 bits and are accumulated
+ *  modulo 2^32, as done by WINDOW_PARTIAL_4 and WINDOW_PARTIAL_8.
+ *
+ ******************************************************************************/
+
+#include "sbc_enc_func_declare.h"
+#include "sbc_encoder.h"
+
+#if (SBC_SIMD_OPT == TRUE)
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define SBC_SIMD_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SBC_SIMD_NEON
+#if !defined(__aarch64__)
+#include <sys/auxv.h>
+#ifndef HWCAP_NEON
+#define HWCAP_NEON (1 << 12)
+#endif
+#endif
+#endif
+
+#if defined(SBC_SIMD_SSE2)
+
+/* Accumulates the 16x16 bits products of 8 samples into 2 vectors of 4 */
+#define SBC_SSE2_MAC_8(s16X, s16C, acc_lo, acc_hi)              \
+  {                                                             \
+    __m128i lo = _mm_mullo_epi16(s16X, s16C);                   \
+    __m128i hi = _mm_mulhi_epi16(s16X, s16C);                   \
+    acc_lo = _mm_add_epi32(acc_lo, _mm_unpacklo_epi16(lo, hi)); \
+    acc_hi = _mm_add_epi32(acc_hi, _mm_unpackhi_epi16(lo, hi)); \
+  }
+
+static void SbcWindow4_SSE2(const int16_t* ps16X, int32_t* ps32DCTY) {
+  __m128i acc0 = _mm_setzero_si128();
+  __m128i acc1 = _mm_setzero_si128();
+  int32_t s32Tap;
+
+  for (s32Tap = 0; s32Tap < 5; s32Tap++) {
+    __m128i x = _mm_loadu_si128((const __m128i*)(ps16X + s32Tap * 8));
+    __m128i c =
+        _mm_loadu_si128((const __m128i*)(gas16WindowLanes4 + s32Tap * 8));
+    SBC_SSE2_MAC_8(x, c, acc0, acc1);
+  }
+
+  _mm_storeu_si128((__m128i*)(ps32DCTY + 0), acc0);
+  _mm_storeu_si128((__m128i*)(ps32DCTY + 4), acc1);
+}
+
+static void SbcWindow8_SSE2(const int16_t* ps16X, int32_t* ps32DCTY) {
+  __m128i acc0 = _mm_setzero_si128();
+  __m128i acc1 = _mm_setzero_si128();
+  __m128i acc2 = _mm_setzero_si128();
+  __m128i acc3 = _mm_setzero_si128();
+  int32_t s32Tap;
+
+  for (s32Tap = 0; s32Tap < 5; s32Tap++) {
+    const int16_t* ps16C = gas16WindowLanes8 + s32Tap * 16;
+    __m128i x0 = _mm_loadu_si128((const __m128i*)(ps16X + s32Tap * 16));
+    __m128i x1 = _mm_loadu_si128((const __m128i*)(ps16X + s32Tap * 16 + 8));
+    __m128i c0 = _mm_loadu_si128((const __m128i*)ps16C);
+    __m128i c1 = _mm_loadu_si128((const __m128i*)(ps16C + 8));
+    SBC_SSE2_MAC_8(x0, c0, acc0, acc1);
+    SBC_SSE2_MAC_8(x1, c1, acc2, acc3);
+  }
+
+  _mm_storeu_si128((__m128i*)(ps32DCTY + 0), acc0);
+  _mm_storeu_si128((__m128i*)(ps32DCTY + 4), acc1);
+  _mm_storeu_si128((__m128i*)(ps32DCTY + 8), acc2);
+  _mm_storeu_si128((__m128i*)(ps32DCTY + 12), acc3);
+}
+
+static int32_t SbcCountSlices_SSE2(const int16_t* ps16BitNeed,
+                                   int32_t s32NumOfBitNeed,
+                                   int32_t s32BitSlice) {
+  const __m128i lower = _mm_set1_epi16((int16_t)s32BitSlice);
+  const __m128i upper = _mm_set1_epi16((int16_t)(s32BitSlice + 16));
+  const __m128i first = _mm_set1_epi16((int16_t)(s32BitSlice + 1));
+  __m128i count = _mm_setzero_si128();
+  int32_t s32SliceCount;
+  int32_t s32Sb;
+
+  /* Masks are -1 for each bitneed in ]bitslice, bitslice + 16[ plus -1 more
+   * for a bitneed of bitslice + 1 */
+  for (s32Sb = 0; s32Sb + 8 <= s32NumOfBitNeed; s32Sb += 8) {
+    __m128i v = _mm_loadu_si128((const __m128i*)(ps16BitNeed + s32Sb));
+    __m128i in = _mm_and_si128(_mm_cmpgt_epi16(v, lower),
+                               _mm_cmplt_epi16(v, upper));
+    count = _mm_sub_epi16(count, in);
+    count = _mm_sub_epi16(count, _mm_cmpeq_epi16(v, first));
+  }
+
+  count = _mm_madd_epi16(count, _mm_set1_epi16(1));
+  count = _mm_add_epi32(count, _mm_shuffle_epi32(count, 0x4E));
+  count = _mm_add_epi32(count, _mm_shuffle_epi32(count, 0xB1));
+  s32SliceCount = _mm_cvtsi128_si32(count);
+
+  for (; s32Sb < s32NumOfBitNeed; s32Sb++) {
+    int32_t s32Diff = ps16BitNeed[s32Sb] - s32BitSlice;
+    if ((s32Diff >= 1) && (s32Diff < 16))
+      s32SliceCount += (s32Diff == 1) ? 2 : 1;
+  }
+  return s32SliceCount;
+}
+
+static const SBC_SIMD_FUNCS sbc_simd_funcs = {
+    SbcWindow4_SSE2, SbcWindow8_SSE2, SbcCountSlices_SSE2,
+};
+
+static int sbc_cpu_has_simd(void) {
+#if defined(__x86_64__)
+  /* SSE2 is part of the x86-64 baseline */
+  return TRUE;
+#else
+  return __builtin_cpu_supports("sse2");
+#endif
+}
+
+#elif defined(SBC_SIMD_NEON)
+
+static void SbcWindow4_NEON(const int16_t* ps16X, int32_t* ps32DCTY) {
+  int16x8_t x = vld1q_s16(ps16X);
+  int16x8_t c = vld1q_s16(gas16WindowLanes4);
+  int32x4_t acc0 = vmull_s16(vget_low_s16(x), vget_low_s16(c));
+  int32x4_t acc1 = vmull_s16(vget_high_s16(x), vget_high_s16(c));
+  int32_t s32Tap;
+
+  for (s32Tap = 1; s32Tap < 5; s32Tap++) {
+    x = vld1q_s16(ps16X + s32Tap * 8);
+    c = vld1q_s16(gas16WindowLanes4 + s32Tap * 8);
+    acc0 = vmlal_s16(acc0, vget_low_s16(x), vget_low_s16(c));
+    acc1 = vmlal_s16(acc1, vget_high_s16(x), vget_high_s16(c));
+  }
+
+  vst1q_s32(ps32DCTY + 0, acc0);
+  vst1q_s32(ps32DCTY + 4, acc1);
+}
+
+static void SbcWindow8_NEON(const int16_t* ps16X, int32_t* ps32DCTY) {
+  int16x8_t x0 = vld1q_s16(ps16X);
+  int16x8_t x1 = vld1q_s16(ps16X + 8);
+  int16x8_t c0 = vld1q_s16(gas16WindowLanes8);
+  int16x8_t c1 = vld1q_s16(gas16WindowLanes8 + 8);
+  int32x4_t acc0 = vmull_s16(vget_low_s16(x0), vget_low_s16(c0));
+  int32x4_t acc1 = vmull_s16(vget_high_s16(x0), vget_high_s16(c0));
+  int32x4_t acc2 = vmull_s16(vget_low_s16(x1), vget_low_s16(c1));
+  int32x4_t acc3 = vmull_s16(vget_high_s16(x1), vget_high_s16(c1));
+  int32_t s32Tap;
+
+  for (s32Tap = 1; s32Tap < 5; s32Tap++) {
+    const int16_t* ps16C = gas16WindowLanes8 + s32Tap * 16;
+    x0 = vld1q_s16(ps16X + s32Tap * 16);
+    x1 = vld1q_s16(ps16X + s32Tap * 16 + 8);
+    c0 = vld1q_s16(ps16C);
+    c1 = vld1q_s16(ps16C + 8);
+    acc0 = vmlal_s16(acc0, vget_low_s16(x0), vget_low_s16(c0));
+    acc1 = vmlal_s16(acc1, vget_high_s16(x0), vget_high_s16(c0));
+    acc2 = vmlal_s16(acc2, vget_low_s16(x1), vget_low_s16(c1));
+    acc3 = vmlal_s16(acc3, vget_high_s16(x1), vget_high_s16(c1));
+  }
+
+  vst1q_s32(ps32DCTY + 0, acc0);
+  vst1q_s32(ps32DCTY + 4, acc1);
+  vst1q_s32(ps32DCTY + 8, acc2);
+  vst1q_s32(ps32DCTY + 12, acc3);
+}
+
+static int32_t SbcCountSlices_NEON(const int16_t* ps16BitNeed,
+                                   int32_t s32NumOfBitNeed,
+                                   int32_t s32BitSlice) {
+  const int16x4_t lower = vdup_n_s16((int16_t)s32BitSlice);
+  const int16x4_t upper = vdup_n_s16((int16_t)(s32BitSlice + 16));
+  const int16x4_t first = vdup_n_s16((int16_t)(s32BitSlice + 1));
+  int16x4_t count = vdup_n_s16(0);
+  int32_t s32Sb;
+
+  /* Masks are -1 for each bitneed in ]bitslice, bitslice + 16[ plus -1 more
+   * for a bitneed of bitslice + 1. The number of bitneed is a multiple of 4 */
+  for (s32Sb = 0; s32Sb < s32NumOfBitNeed; s32Sb += 4) {
+    int16x4_t v = vld1_s16(ps16BitNeed + s32Sb);
+    uint16x4_t in = vand_u16(vcgt_s16(v, lower), vclt_s16(v, upper));
+    count = vsub_s16(count, vreinterpret_s16_u16(in));
+    count = vsub_s16(count, vreinterpret_s16_u16(vceq_s16(v, first)));
+  }
+
+  {
+    int32x2_t sum = vpaddl_s16(count);
+    return vget_lane_s32(vpadd_s32(sum, sum), 0);
+  }
+}
+
+static const SBC_SIMD_FUNCS sbc_simd_funcs = {
+    SbcWindow4_NEON, SbcWindow8_NEON, SbcCountSlices_NEON,
+};
+
+static int sbc_cpu_has_simd(void) {
+#if defined(__aarch64__)
+  /* NEON is mandatory on ARMv8-A */
+  return TRUE;
+#else
+  return (getauxval(AT_HWCAP) & HWCAP_NEON) != 0;
+#endif
+}
+
+#endif
+
+/****************************************************************************
+* sbc_enc_get_simd_funcs - returns the SIMD implementation usable on this CPU
+*
+* RETURNS : SBC_NULL if the encoder must use the C implementation
+*/
+const SBC_SIMD_FUNCS* sbc_enc_get_simd_funcs(void) {
+#if defined(SBC_SIMD_SSE2) || defined(SBC_SIMD_NEON)
+  if (sbc_cpu_has_simd()) return &sbc_simd_funcs;
+#endif
+  return SBC_NULL;
+}
+
+#endif /* SBC_SIMD_OPT */
@@ -167,6 +167,14 @@ void SBC_Encoder_Init(SBC_ENC_PARAMS* pstrEncParams) {
   int16_t s16FrameLen;      /*to store frame length*/
   uint16_t HeaderParams;
 
+  if (pstrEncParams->mSBCEnabled) {
+    pstrEncParams->s16SamplingFreq = SBC_sf16000;
+    pstrEncParams->s16ChannelMode = SBC_MONO;
+    pstrEncParams->s16NumOfSubBands = SUB_BANDS_8;
+    pstrEncParams->s16NumOfBlocks = SBC_MSBC_BLOCKS;
+    pstrEncParams->s16AllocationMethod = SBC_LOUDNESS;
+  }
+
   /* Required number of channels */
   if (pstrEncParams->s16ChannelMode == SBC_MONO)
     pstrEncParams->s16NumOfChannels = 1;
@@ -227,6 +235,8 @@ void SBC_Encoder_Init(SBC_ENC_PARAMS* pstrEncParams) {
             : s16Bitpool;
   }
 
+  if (pstrEncParams->mSBCEnabled) pstrEncParams->s16BitPool = SBC_MSBC_BITPOOL;
+
   if (pstrEncParams->s16BitPool < 0) pstrEncParams->s16BitPool = 0;
   /* sampling freq */
   HeaderParams = ((pstrEncParams->s16SamplingFreq & 3) << 6);
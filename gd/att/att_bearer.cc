@@ -0,0 +1,379 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "att/att_bearer.h"
+
+#include <algorithm>
+
+#include "att/attribute_database.h"
+#include "common/bind.h"
+#include "os/log.h"
+#include "packet/raw_builder.h"
+
+namespace bluetooth {
+namespace att {
+
+namespace {
+// Commands, which are not answered, have bit 6 of their opcode set
+constexpr uint8_t kCommandFlag = 0x40;
+// Opcode and handle
+constexpr size_t kNotificationHeaderSize = 3;
+// Handle and length of each value of a multiple notification
+constexpr size_t kMultipleNotificationEntryHeaderSize = 4;
+
+AttPduView InvalidPdu() {
+  return AttPduView::Create(packet::PacketView<packet::kLittleEndian>(std::make_shared<std::vector<uint8_t>>()));
+}
+}  // namespace
+
+AttBearer::AttBearer(UpperQueueUpEnd* queue_end, os::Handler* handler, bool enhanced, uint16_t mtu)
+    : queue_end_(queue_end), handler_(handler), enhanced_(enhanced), local_mtu_(std::min(mtu, kMaxMtu)),
+      mtu_(enhanced ? local_mtu_ : kDefaultMtu), request_alarm_(handler), indication_alarm_(handler),
+      enqueue_buffer_(queue_end) {
+  ASSERT(queue_end_ != nullptr);
+  ASSERT(handler_ != nullptr);
+  queue_end_->RegisterDequeue(handler_, common::Bind(&AttBearer::on_incoming_packet, common::Unretained(this)));
+}
+
+AttBearer::~AttBearer() {
+  request_alarm_.Cancel();
+  indication_alarm_.Cancel();
+  enqueue_buffer_.Clear();
+  queue_end_->UnregisterDequeue();
+  abort_pending();
+}
+
+void AttBearer::SetRequestCallback(RequestCallback callback) {
+  request_callback_ = std::move(callback);
+}
+
+void AttBearer::SetValueCallback(ValueCallback callback) {
+  value_callback_ = std::move(callback);
+}
+
+void AttBearer::SetTimeoutCallback(common::OnceClosure callback) {
+  timeout_callback_ = std::move(callback);
+}
+
+uint16_t AttBearer::GetMtu() const {
+  return mtu_;
+}
+
+bool AttBearer::IsEnhanced() const {
+  return enhanced_;
+}
+
+size_t AttBearer::GetPendingRequestCount() const {
+  return pending_requests_.size();
+}
+
+void AttBearer::ExchangeMtu() {
+  if (enhanced_) {
+    return;
+  }
+  SendRequest(ExchangeMtuRequestBuilder::Create(local_mtu_),
+              common::BindOnce(&AttBearer::on_exchange_mtu_response, common::Unretained(this)));
+}
+
+void AttBearer::SendRequest(std::unique_ptr<AttPduBuilder> request, ResponseCallback callback) {
+  if (timed_out_) {
+    std::move(callback).Run(InvalidPdu());
+    return;
+  }
+  pending_requests_.push({std::move(request), std::move(callback)});
+  if (!request_in_flight_) {
+    send_next_request();
+  }
+}
+
+void AttBearer::SendCommand(std::unique_ptr<AttPduBuilder> command) {
+  send(std::move(command));
+}
+
+void AttBearer::SendResponse(std::unique_ptr<AttPduBuilder> response) {
+  send(std::move(response));
+}
+
+void AttBearer::SendError(Opcode request_opcode, uint16_t handle, AttErrorCode error_code) {
+  send(ErrorResponseBuilder::Create(request_opcode, handle, error_code));
+}
+
+void AttBearer::SendNotification(uint16_t handle, const std::vector<uint8_t>& value) {
+  send(HandleValueNotificationBuilder::Create(
+      handle, std::make_unique<packet::RawBuilder>(truncate(value, kNotificationHeaderSize))));
+}
+
+void AttBearer::SendNotifications(const std::vector<std::pair<uint16_t, std::vector<uint8_t>>>& values) {
+  if (!enhanced_) {
+    for (const auto& value : values) {
+      SendNotification(value.first, value.second);
+    }
+    return;
+  }
+
+  // A multiple notification carries at least two values, so a batch of one is sent as a notification
+  size_t batch_begin = 0;
+  size_t batch_size = 1;  // Opcode
+  auto payload = std::make_unique<packet::RawBuilder>();
+  auto flush = [&](size_t batch_end) {
+    if (batch_end - batch_begin == 1) {
+      SendNotification(values[batch_begin].first, values[batch_begin].second);
+    } else if (batch_end - batch_begin > 1) {
+      send(MultipleHandleValueNotificationBuilder::Create(std::move(payload)));
+    }
+    payload = std::make_unique<packet::RawBuilder>();
+    batch_begin = batch_end;
+    batch_size = 1;
+  };
+  for (size_t i = 0; i < values.size(); i++) {
+    const auto& value = values[i].second;
+    size_t entry_size = kMultipleNotificationEntryHeaderSize + value.size();
+    if (batch_size + entry_size > mtu_) {
+      flush(i);
+    }
+    if (batch_size + entry_size > mtu_) {
+      // Too long to share a PDU, so it is sent alone, truncated
+      SendNotification(values[i].first, value);
+      batch_begin = i + 1;
+      continue;
+    }
+    payload->AddOctets2(values[i].first);
+    payload->AddOctets2(value.size());
+    payload->AddOctets(value);
+    batch_size += entry_size;
+  }
+  flush(values.size());
+}
+
+void AttBearer::SendIndication(uint16_t handle, const std::vector<uint8_t>& value, ConfirmationCallback callback) {
+  if (timed_out_) {
+    std::move(callback).Run(false);
+    return;
+  }
+  auto pdu = HandleValueIndicationBuilder::Create(
+      handle, std::make_unique<packet::RawBuilder>(truncate(value, kNotificationHeaderSize)));
+  pending_indications_.push({std::move(pdu), std::move(callback)});
+  if (!indication_in_flight_) {
+    send_next_indication();
+  }
+}
+
+void AttBearer::send(std::unique_ptr<AttPduBuilder> pdu) {
+  if (timed_out_) {
+    return;
+  }
+  enqueue_buffer_.Enqueue(std::move(pdu), handler_);
+}
+
+void AttBearer::send_next_request() {
+  if (pending_requests_.empty()) {
+    return;
+  }
+  request_in_flight_ = true;
+  send(std::move(pending_requests_.front().pdu));
+  request_alarm_.Schedule(common::BindOnce(&AttBearer::on_timeout, common::Unretained(this)), kTransactionTimeout);
+}
+
+void AttBearer::send_next_indication() {
+  if (pending_indications_.empty()) {
+    return;
+  }
+  indication_in_flight_ = true;
+  send(std::move(pending_indications_.front().pdu));
+  indication_alarm_.Schedule(common::BindOnce(&AttBearer::on_timeout, common::Unretained(this)),
+                             kTransactionTimeout);
+}
+
+void AttBearer::on_incoming_packet() {
+  auto packet = queue_end_->TryDequeue();
+  AttPduView pdu = AttPduView::Create(*packet);
+  if (!pdu.IsValid()) {
+    LOG_WARN("Invalid ATT PDU received");
+    return;
+  }
+  if (timed_out_) {
+    return;
+  }
+  switch (pdu.GetOpcode()) {
+    case Opcode::ERROR_RESPONSE:
+    case Opcode::EXCHANGE_MTU_RESPONSE:
+    case Opcode::FIND_INFORMATION_RESPONSE:
+    case Opcode::FIND_BY_TYPE_VALUE_RESPONSE:
+    case Opcode::READ_BY_TYPE_RESPONSE:
+    case Opcode::READ_RESPONSE:
+    case Opcode::READ_BLOB_RESPONSE:
+    case Opcode::READ_MULTIPLE_RESPONSE:
+    case Opcode::READ_BY_GROUP_TYPE_RESPONSE:
+    case Opcode::WRITE_RESPONSE:
+    case Opcode::PREPARE_WRITE_RESPONSE:
+    case Opcode::EXECUTE_WRITE_RESPONSE:
+    case Opcode::READ_MULTIPLE_VARIABLE_RESPONSE:
+      on_response(pdu);
+      return;
+    case Opcode::HANDLE_VALUE_CONFIRMATION:
+      on_confirmation();
+      return;
+    case Opcode::EXCHANGE_MTU_REQUEST:
+      on_exchange_mtu_request(pdu);
+      return;
+    case Opcode::HANDLE_VALUE_NOTIFICATION: {
+      HandleValueNotificationView notification = HandleValueNotificationView::Create(pdu);
+      if (!notification.IsValid()) {
+        LOG_WARN("Invalid notification received");
+        return;
+      }
+      if (!value_callback_.is_null()) {
+        value_callback_.Run(notification.GetAttributeHandle(), notification.GetPayload());
+      }
+      return;
+    }
+    case Opcode::HANDLE_VALUE_INDICATION: {
+      HandleValueIndicationView indication = HandleValueIndicationView::Create(pdu);
+      if (!indication.IsValid()) {
+        LOG_WARN("Invalid indication received");
+        return;
+      }
+      if (!value_callback_.is_null()) {
+        value_callback_.Run(indication.GetAttributeHandle(), indication.GetPayload());
+      }
+      send(HandleValueConfirmationBuilder::Create());
+      return;
+    }
+    case Opcode::MULTIPLE_HANDLE_VALUE_NOTIFICATION:
+      on_multiple_notification(pdu);
+      return;
+    default:
+      if (!request_callback_.is_null()) {
+        request_callback_.Run(this, pdu);
+      } else if (!(static_cast<uint8_t>(pdu.GetOpcode()) & kCommandFlag)) {
+        SendError(pdu.GetOpcode(), kInvalidHandle, AttErrorCode::REQUEST_NOT_SUPPORTED);
+      }
+      return;
+  }
+}
+
+void AttBearer::on_response(AttPduView pdu) {
+  if (!request_in_flight_) {
+    LOG_WARN("Unexpected response: no pending request");
+    return;
+  }
+  request_alarm_.Cancel();
+  auto callback = std::move(pending_requests_.front().callback);
+  pending_requests_.pop();
+  request_in_flight_ = false;
+  // The next request goes out before this response is handled, to keep the bearer busy
+  send_next_request();
+  std::move(callback).Run(pdu);
+}
+
+void AttBearer::on_confirmation() {
+  if (!indication_in_flight_) {
+    LOG_WARN("Unexpected confirmation: no pending indication");
+    return;
+  }
+  indication_alarm_.Cancel();
+  auto callback = std::move(pending_indications_.front().callback);
+  pending_indications_.pop();
+  indication_in_flight_ = false;
+  send_next_indication();
+  std::move(callback).Run(true);
+}
+
+void AttBearer::on_exchange_mtu_request(AttPduView pdu) {
+  ExchangeMtuRequestView request = ExchangeMtuRequestView::Create(pdu);
+  if (!request.IsValid()) {
+    SendError(Opcode::EXCHANGE_MTU_REQUEST, kInvalidHandle, AttErrorCode::INVALID_PDU);
+    return;
+  }
+  if (enhanced_) {
+    // The MTU of an EATT bearer is the one of its channel
+    SendError(Opcode::EXCHANGE_MTU_REQUEST, kInvalidHandle, AttErrorCode::REQUEST_NOT_SUPPORTED);
+    return;
+  }
+  send(ExchangeMtuResponseBuilder::Create(local_mtu_));
+  mtu_ = std::max(kDefaultMtu, std::min(request.GetMtu(), local_mtu_));
+}
+
+void AttBearer::on_exchange_mtu_response(AttPduView pdu) {
+  ExchangeMtuResponseView response = ExchangeMtuResponseView::Create(pdu);
+  if (!response.IsValid()) {
+    LOG_WARN("MTU exchange failed");
+    return;
+  }
+  mtu_ = std::max(kDefaultMtu, std::min(response.GetMtu(), local_mtu_));
+}
+
+void AttBearer::on_multiple_notification(AttPduView pdu) {
+  MultipleHandleValueNotificationView notification = MultipleHandleValueNotificationView::Create(pdu);
+  if (!notification.IsValid()) {
+    LOG_WARN("Invalid multiple notification received");
+    return;
+  }
+  Value payload = notification.GetPayload();
+  size_t offset = 0;
+  while (payload.size() - offset >= kMultipleNotificationEntryHeaderSize) {
+    auto it = payload.begin() + offset;
+    uint16_t handle = it.extract<uint16_t>();
+    uint16_t length = it.extract<uint16_t>();
+    offset += kMultipleNotificationEntryHeaderSize;
+    if (payload.size() - offset < length) {
+      LOG_WARN("Truncated multiple notification received");
+      return;
+    }
+    if (!value_callback_.is_null()) {
+      value_callback_.Run(handle, payload.GetLittleEndianSubview(offset, offset + length));
+    }
+    offset += length;
+  }
+}
+
+void AttBearer::on_timeout() {
+  LOG_WARN("ATT transaction timed out");
+  timed_out_ = true;
+  request_alarm_.Cancel();
+  indication_alarm_.Cancel();
+  enqueue_buffer_.Clear();
+  abort_pending();
+  if (!timeout_callback_.is_null()) {
+    std::move(timeout_callback_).Run();
+  }
+}
+
+void AttBearer::abort_pending() {
+  request_in_flight_ = false;
+  indication_in_flight_ = false;
+  while (!pending_requests_.empty()) {
+    auto callback = std::move(pending_requests_.front().callback);
+    pending_requests_.pop();
+    std::move(callback).Run(InvalidPdu());
+  }
+  while (!pending_indications_.empty()) {
+    auto callback = std::move(pending_indications_.front().callback);
+    pending_indications_.pop();
+    std::move(callback).Run(false);
+  }
+}
+
+std::vector<uint8_t> AttBearer::truncate(const std::vector<uint8_t>& value, size_t header_size) const {
+  size_t max_size = mtu_ - header_size;
+  if (value.size() <= max_size) {
+    return value;
+  }
+  return std::vector<uint8_t>(value.begin(), value.begin() + max_size);
+}
+
+}  // namespace att
+}  // namespace bluetooth
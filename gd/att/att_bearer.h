@@ -0,0 +1,133 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include "att/att_packets.h"
+#include "common/bidi_queue.h"
+#include "common/callback.h"
+#include "os/alarm.h"
+#include "os/handler.h"
+#include "os/queue.h"
+#include "packet/base_packet_builder.h"
+#include "packet/packet_view.h"
+
+namespace bluetooth {
+namespace att {
+
+// One ATT bearer: the LE fixed channel, or an Enhanced ATT (EATT) credit based channel. It enforces the transaction
+// rules of ATT, so that the users can queue requests and indications back to back: only one request and one
+// indication are outstanding at a time, the next one is sent as soon as the previous one is answered. The MTU exchange
+// and the confirmation of indications are handled here. All the methods must be called on |handler|.
+class AttBearer {
+ public:
+  using UpperQueueUpEnd = common::BidiQueueEnd<packet::BasePacketBuilder, packet::PacketView<packet::kLittleEndian>>;
+  using Value = packet::PacketView<packet::kLittleEndian>;
+
+  // Called with the response to a request, which may be an ErrorResponse, or with an invalid view if the bearer timed
+  // out or was destroyed before the response came
+  using ResponseCallback = common::OnceCallback<void(AttPduView)>;
+  // Called with the requests and commands of the peer client, that the callee must respond to with SendResponse or
+  // SendError
+  using RequestCallback = common::Callback<void(AttBearer*, AttPduView)>;
+  // Called with a notified or indicated value. |value| is a view of the received PDU, that is not copied.
+  using ValueCallback = common::Callback<void(uint16_t handle, Value value)>;
+  // Called once an indication is confirmed, or with false if it never will be
+  using ConfirmationCallback = common::OnceCallback<void(bool confirmed)>;
+
+  static constexpr uint16_t kDefaultMtu = 23;
+  static constexpr uint16_t kMaxMtu = 517;
+  static constexpr std::chrono::seconds kTransactionTimeout = std::chrono::seconds(30);
+
+  // |enhanced| bearers are EATT bearers, for which |mtu| is the MTU of the channel; it is the MTU to ask for in an
+  // exchange otherwise. Only enhanced bearers carry multiple values in a notification.
+  AttBearer(UpperQueueUpEnd* queue_end, os::Handler* handler, bool enhanced, uint16_t mtu);
+  ~AttBearer();
+
+  void SetRequestCallback(RequestCallback callback);
+  void SetValueCallback(ValueCallback callback);
+  // Called once a transaction timed out, after which the bearer sends and delivers nothing, and must be closed
+  void SetTimeoutCallback(common::OnceClosure callback);
+
+  uint16_t GetMtu() const;
+  bool IsEnhanced() const;
+  // Number of requests sent or waiting to be sent, so that requests can be spread over the least busy bearers
+  size_t GetPendingRequestCount() const;
+
+  // Asks the server for a larger MTU. Does nothing on enhanced bearers.
+  void ExchangeMtu();
+
+  // Sends |request| once the requests sent before it are answered
+  void SendRequest(std::unique_ptr<AttPduBuilder> request, ResponseCallback callback);
+  void SendCommand(std::unique_ptr<AttPduBuilder> command);
+  void SendResponse(std::unique_ptr<AttPduBuilder> response);
+  void SendError(Opcode request_opcode, uint16_t handle, AttErrorCode error_code);
+
+  // The values are truncated to fit the MTU
+  void SendNotification(uint16_t handle, const std::vector<uint8_t>& value);
+  // Sends the values in as few PDUs as the MTU allows, on enhanced bearers, one notification each otherwise
+  void SendNotifications(const std::vector<std::pair<uint16_t, std::vector<uint8_t>>>& values);
+  void SendIndication(uint16_t handle, const std::vector<uint8_t>& value, ConfirmationCallback callback);
+
+ private:
+  struct PendingRequest {
+    std::unique_ptr<AttPduBuilder> pdu;
+    ResponseCallback callback;
+  };
+  struct PendingIndication {
+    std::unique_ptr<AttPduBuilder> pdu;
+    ConfirmationCallback callback;
+  };
+
+  void send(std::unique_ptr<AttPduBuilder> pdu);
+  void send_next_request();
+  void send_next_indication();
+  void on_incoming_packet();
+  void on_response(AttPduView pdu);
+  void on_confirmation();
+  void on_exchange_mtu_request(AttPduView pdu);
+  void on_exchange_mtu_response(AttPduView pdu);
+  void on_multiple_notification(AttPduView pdu);
+  void on_timeout();
+  void abort_pending();
+  std::vector<uint8_t> truncate(const std::vector<uint8_t>& value, size_t header_size) const;
+
+  UpperQueueUpEnd* queue_end_;
+  os::Handler* handler_;
+  const bool enhanced_;
+  const uint16_t local_mtu_;
+  uint16_t mtu_;
+  bool timed_out_ = false;
+  RequestCallback request_callback_;
+  ValueCallback value_callback_;
+  common::OnceClosure timeout_callback_;
+  std::queue<PendingRequest> pending_requests_;
+  bool request_in_flight_ = false;
+  std::queue<PendingIndication> pending_indications_;
+  bool indication_in_flight_ = false;
+  os::Alarm request_alarm_;
+  os::Alarm indication_alarm_;
+  os::EnqueueBuffer<packet::BasePacketBuilder> enqueue_buffer_;
+};
+
+}  // namespace att
+}  // namespace bluetooth
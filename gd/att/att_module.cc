@@ -17,11 +17,15 @@
 #define LOG_TAG "att"
 
 #include <memory>
+#include <unordered_map>
+
 #include "module.h"
 #include "os/handler.h"
 #include "os/log.h"
 
+#include "att/att_bearer.h"
 #include "att/att_module.h"
+#include "att/gatt_server.h"
 #include "l2cap/classic/l2cap_classic_module.h"
 #include "l2cap/le/l2cap_le_module.h"
 
@@ -30,32 +34,68 @@ namespace att {
 
 const ModuleFactory AttModule::Factory = ModuleFactory([]() { return new AttModule(); });
 
-namespace {
-void OnAttRegistrationCompleteLe(l2cap::le::FixedChannelManager::RegistrationResult result,
-                                 std::unique_ptr<l2cap::le::FixedChannelService> le_smp_service) {
-  LOG_INFO("ATT channel registration complete");
-}
-
-void OnAttConnectionOpenLe(std::unique_ptr<l2cap::le::FixedChannel> channel) {
-  LOG_INFO("ATT conneciton opened");
-}
-}  // namespace
-
 struct AttModule::impl {
   impl(os::Handler* att_handler, l2cap::le::L2capLeModule* l2cap_le_module,
        l2cap::classic::L2capClassicModule* l2cap_classic_module)
       : att_handler_(att_handler), l2cap_le_module_(l2cap_le_module), l2cap_classic_module_(l2cap_classic_module) {
-    // TODO: move that into a ATT manager, or other proper place
-    std::unique_ptr<bluetooth::l2cap::le::FixedChannelManager> l2cap_manager_le_(
-        l2cap_le_module_->GetFixedChannelManager());
+    l2cap_manager_le_ = l2cap_le_module_->GetFixedChannelManager();
     l2cap_manager_le_->RegisterService(bluetooth::l2cap::kLeAttributeCid, {},
-                                       common::BindOnce(&OnAttRegistrationCompleteLe),
-                                       common::Bind(&OnAttConnectionOpenLe), att_handler_);
+                                       common::BindOnce(&impl::on_registration_complete, common::Unretained(this)),
+                                       common::Bind(&impl::on_connection_open, common::Unretained(this)), att_handler_);
+  }
+
+  ~impl() {
+    for (auto& connection : connections_) {
+      connection.second->client_.RemoveBearer(connection.second->bearer_.get());
+    }
+  }
+
+  // The bearer is destroyed before the client and the channel it uses
+  struct Connection {
+    std::unique_ptr<l2cap::le::FixedChannel> channel_;
+    GattClient client_;
+    std::unique_ptr<AttBearer> bearer_;
+  };
+
+  void on_registration_complete(l2cap::le::FixedChannelManager::RegistrationResult result,
+                                std::unique_ptr<l2cap::le::FixedChannelService> service) {
+    LOG_INFO("ATT channel registration complete");
+    l2cap_service_le_ = std::move(service);
+  }
+
+  void on_connection_open(std::unique_ptr<l2cap::le::FixedChannel> channel) {
+    LOG_INFO("ATT connection opened");
+    hci::AddressWithType device = channel->GetDevice();
+    channel->RegisterOnCloseCallback(att_handler_,
+                                     common::BindOnce(&impl::on_connection_close, common::Unretained(this), device));
+    auto connection = std::make_unique<Connection>();
+    connection->bearer_ =
+        std::make_unique<AttBearer>(channel->GetQueueUpEnd(), att_handler_, false, AttBearer::kMaxMtu);
+    connection->channel_ = std::move(channel);
+    gatt_server_.AddBearer(connection->bearer_.get());
+    connection->client_.AddBearer(connection->bearer_.get());
+    connection->bearer_->ExchangeMtu();
+    connections_[device] = std::move(connection);
+  }
+
+  void on_connection_close(hci::AddressWithType device, hci::ErrorCode error_code) {
+    LOG_INFO("ATT connection closed");
+    auto connection = connections_.find(device);
+    if (connection == connections_.end()) {
+      return;
+    }
+    connection->second->client_.RemoveBearer(connection->second->bearer_.get());
+    connections_.erase(connection);
   }
 
   os::Handler* att_handler_;
   l2cap::le::L2capLeModule* l2cap_le_module_;
   l2cap::classic::L2capClassicModule* l2cap_classic_module_;
+  std::unique_ptr<l2cap::le::FixedChannelManager> l2cap_manager_le_;
+  std::unique_ptr<l2cap::le::FixedChannelService> l2cap_service_le_;
+  AttributeDatabase database_;
+  GattServer gatt_server_{&database_};
+  std::unordered_map<hci::AddressWithType, std::unique_ptr<Connection>> connections_;
 };
 
 void AttModule::ListDependencies(ModuleList* list) {
@@ -76,10 +116,24 @@ std::string AttModule::ToString() const {
   return "Att Module";
 }
 
-// std::unique_ptr<AttManager> AttModule::GetAttManager() {
-//   return std::unique_ptr<AttManager>(
-//       new AttManager(pimpl_->att_handler_, &pimpl_->att_manager_impl));
-// }
+AttributeDatabase* AttModule::GetAttributeDatabase() {
+  return &pimpl_->database_;
+}
+
+GattClient* AttModule::GetGattClient(const hci::AddressWithType& device) {
+  auto connection = pimpl_->connections_.find(device);
+  return connection == pimpl_->connections_.end() ? nullptr : &connection->second->client_;
+}
+
+void AttModule::SendNotifications(const hci::AddressWithType& device,
+                                  const std::vector<std::pair<uint16_t, std::vector<uint8_t>>>& values) {
+  auto connection = pimpl_->connections_.find(device);
+  if (connection == pimpl_->connections_.end()) {
+    LOG_WARN("No ATT connection to notify");
+    return;
+  }
+  connection->second->bearer_->SendNotifications(values);
+}
 
 }  // namespace att
 }  // namespace bluetooth
\ No newline at end of file
@@ -16,7 +16,12 @@
 #pragma once
 
 #include <memory>
+#include <utility>
+#include <vector>
 
+#include "att/attribute_database.h"
+#include "att/gatt_client.h"
+#include "hci/address_with_type.h"
 #include "module.h"
 
 namespace bluetooth {
@@ -29,6 +34,16 @@ class AttModule : public bluetooth::Module {
 
   static const ModuleFactory Factory;
 
+  // The database served to all the connections. Must be used on the module handler.
+  AttributeDatabase* GetAttributeDatabase();
+
+  // Returns the client of the connection to |device|, nullptr if there is none. Must be used on the module handler.
+  GattClient* GetGattClient(const hci::AddressWithType& device);
+
+  // Notifies |device| of the values, in as few PDUs as its bearer allows. Must be called on the module handler.
+  void SendNotifications(const hci::AddressWithType& device,
+                         const std::vector<std::pair<uint16_t, std::vector<uint8_t>>>& values);
+
  protected:
   void ListDependencies(ModuleList* list) override;
 
@@ -0,0 +1,74 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "att/attribute_database.h"
+
+#include "os/log.h"
+
+namespace bluetooth {
+namespace att {
+
+uint16_t AttributeDatabase::AddService(const Uuid& uuid, bool primary) {
+  auto type = Uuid::From16Bit(primary ? kPrimaryServiceUuid : kSecondaryServiceUuid);
+  // the previous service ends before this one
+  last_service_handle_ = kInvalidHandle;
+  uint16_t handle = Add(type, kPermissionRead, uuid.ToBytes());
+  last_service_handle_ = handle;
+  return handle;
+}
+
+uint16_t AttributeDatabase::AddCharacteristic(const Uuid& uuid, uint8_t properties, uint8_t permissions,
+                                              std::vector<uint8_t> value) {
+  ASSERT_LOG(last_service_handle_ != kInvalidHandle, "A characteristic must belong to a service");
+  uint16_t value_handle = GetLastHandle() + 2;
+  std::vector<uint8_t> declaration = {properties, static_cast<uint8_t>(value_handle & 0xff),
+                                      static_cast<uint8_t>(value_handle >> 8)};
+  auto uuid_bytes = uuid.ToBytes();
+  declaration.insert(declaration.end(), uuid_bytes.begin(), uuid_bytes.end());
+  Add(Uuid::From16Bit(kCharacteristicUuid), kPermissionRead, std::move(declaration));
+  Add(uuid, permissions, std::move(value));
+  if (properties & (kPropertyNotify | kPropertyIndicate)) {
+    AddDescriptor(Uuid::From16Bit(kClientCharacteristicConfigurationUuid), kPermissionRead | kPermissionWrite,
+                  {0x00, 0x00});
+  }
+  return value_handle;
+}
+
+uint16_t AttributeDatabase::AddDescriptor(const Uuid& uuid, uint8_t permissions, std::vector<uint8_t> value) {
+  ASSERT_LOG(last_service_handle_ != kInvalidHandle, "A descriptor must belong to a service");
+  return Add(uuid, permissions, std::move(value));
+}
+
+bool AttributeDatabase::SetValue(uint16_t handle, std::vector<uint8_t> value) {
+  if (handle == kInvalidHandle || handle > attributes_.size()) {
+    return false;
+  }
+  attributes_[handle - 1].value = std::move(value);
+  return true;
+}
+
+uint16_t AttributeDatabase::Add(const Uuid& type, uint8_t permissions, std::vector<uint8_t> value) {
+  ASSERT_LOG(attributes_.size() < kMaxHandle, "No handle left");
+  uint16_t handle = attributes_.size() + 1;
+  attributes_.push_back({handle, type, permissions, std::move(value), handle});
+  if (last_service_handle_ != kInvalidHandle) {
+    attributes_[last_service_handle_ - 1].end_group_handle = handle;
+  }
+  return handle;
+}
+
+}  // namespace att
+}  // namespace bluetooth
@@ -0,0 +1,97 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "att/uuid.h"
+
+namespace bluetooth {
+namespace att {
+
+constexpr uint16_t kInvalidHandle = 0x0000;
+constexpr uint16_t kMaxHandle = 0xffff;
+
+constexpr uint16_t kPrimaryServiceUuid = 0x2800;
+constexpr uint16_t kSecondaryServiceUuid = 0x2801;
+constexpr uint16_t kCharacteristicUuid = 0x2803;
+constexpr uint16_t kClientCharacteristicConfigurationUuid = 0x2902;
+
+// Characteristic properties, Core spec Vol 3 Part G 3.3.1.1
+enum CharacteristicProperties : uint8_t {
+  kPropertyRead = 0x02,
+  kPropertyWriteWithoutResponse = 0x04,
+  kPropertyWrite = 0x08,
+  kPropertyNotify = 0x10,
+  kPropertyIndicate = 0x20,
+};
+
+enum AttributePermissions : uint8_t {
+  kPermissionRead = 0x01,
+  kPermissionWrite = 0x02,
+};
+
+struct Attribute {
+  uint16_t handle;
+  Uuid type;
+  uint8_t permissions;
+  std::vector<uint8_t> value;
+  // Last handle of the service, for service declarations
+  uint16_t end_group_handle;
+};
+
+// Local GATT database. Handles are given out in order from 1 as attributes are added, so an attribute is found by
+// indexing with its handle, and a range of handles is a contiguous range of attributes.
+class AttributeDatabase {
+ public:
+  AttributeDatabase() = default;
+
+  // Adds the declaration of a service, and returns its handle. The characteristics added next belong to it.
+  uint16_t AddService(const Uuid& uuid, bool primary);
+
+  // Adds the declaration and the value of a characteristic to the last service, and returns the handle of the value.
+  // A Client Characteristic Configuration descriptor is added if the characteristic can be notified or indicated.
+  uint16_t AddCharacteristic(const Uuid& uuid, uint8_t properties, uint8_t permissions, std::vector<uint8_t> value);
+
+  // Adds a descriptor to the last characteristic, and returns its handle
+  uint16_t AddDescriptor(const Uuid& uuid, uint8_t permissions, std::vector<uint8_t> value);
+
+  // Returns nullptr if there is no attribute at |handle|
+  const Attribute* Get(uint16_t handle) const {
+    if (handle == kInvalidHandle || handle > attributes_.size()) {
+      return nullptr;
+    }
+    return &attributes_[handle - 1];
+  }
+
+  // Sets the value of the attribute at |handle|. Returns false if there is none.
+  bool SetValue(uint16_t handle, std::vector<uint8_t> value);
+
+  // Returns the handle of the last attribute, kInvalidHandle if the database is empty
+  uint16_t GetLastHandle() const {
+    return attributes_.size();
+  }
+
+ private:
+  uint16_t Add(const Uuid& type, uint8_t permissions, std::vector<uint8_t> value);
+
+  std::vector<Attribute> attributes_;
+  uint16_t last_service_handle_ = kInvalidHandle;
+};
+
+}  // namespace att
+}  // namespace bluetooth
@@ -0,0 +1,87 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "att/attribute_database.h"
+
+#include <gtest/gtest.h>
+
+namespace bluetooth {
+namespace att {
+namespace {
+
+TEST(AttUuidTest, short_and_long_forms_are_equal) {
+  std::vector<uint8_t> long_form = {0xfb, 0x34, 0x9b, 0x5f, 0x80, 0x00, 0x00, 0x80,
+                                    0x00, 0x10, 0x00, 0x00, 0x0d, 0x18, 0x00, 0x00};
+  Uuid uuid;
+  ASSERT_TRUE(Uuid::FromBytes(long_form, &uuid));
+  EXPECT_EQ(uuid, Uuid::From16Bit(0x180d));
+  EXPECT_TRUE(uuid.Is16Bit());
+  EXPECT_EQ(uuid.As16Bit(), 0x180d);
+  EXPECT_EQ(uuid.ToBytes(), std::vector<uint8_t>({0x0d, 0x18}));
+
+  long_form[0] = 0x00;
+  ASSERT_TRUE(Uuid::FromBytes(long_form, &uuid));
+  EXPECT_FALSE(uuid.Is16Bit());
+  EXPECT_EQ(uuid.ToBytes(), long_form);
+  EXPECT_FALSE(Uuid::FromBytes({0x01, 0x02, 0x03}, &uuid));
+}
+
+TEST(AttributeDatabaseTest, handles_are_given_in_order) {
+  AttributeDatabase database;
+  EXPECT_EQ(database.GetLastHandle(), kInvalidHandle);
+  EXPECT_EQ(database.Get(1), nullptr);
+
+  uint16_t service = database.AddService(Uuid::From16Bit(0x180d), true);
+  uint16_t value = database.AddCharacteristic(Uuid::From16Bit(0x2a37), kPropertyNotify, 0, {0x00, 0x48});
+  EXPECT_EQ(service, 1);
+  EXPECT_EQ(value, 3);
+  // The declaration, the value and the Client Characteristic Configuration
+  EXPECT_EQ(database.GetLastHandle(), 4);
+
+  const Attribute* declaration = database.Get(2);
+  ASSERT_NE(declaration, nullptr);
+  EXPECT_EQ(declaration->type, Uuid::From16Bit(kCharacteristicUuid));
+  EXPECT_EQ(declaration->value, std::vector<uint8_t>({kPropertyNotify, 0x03, 0x00, 0x37, 0x2a}));
+  EXPECT_EQ(database.Get(value)->value, std::vector<uint8_t>({0x00, 0x48}));
+  EXPECT_EQ(database.Get(4)->type, Uuid::From16Bit(kClientCharacteristicConfigurationUuid));
+  EXPECT_EQ(database.Get(5), nullptr);
+}
+
+TEST(AttributeDatabaseTest, services_end_before_the_next) {
+  AttributeDatabase database;
+  uint16_t first = database.AddService(Uuid::From16Bit(0x1800), true);
+  database.AddCharacteristic(Uuid::From16Bit(0x2a00), kPropertyRead, kPermissionRead, {'g', 'd'});
+  uint16_t second = database.AddService(Uuid::From16Bit(0x180f), true);
+  uint16_t level = database.AddCharacteristic(Uuid::From16Bit(0x2a19), kPropertyRead, kPermissionRead, {100});
+
+  EXPECT_EQ(database.Get(first)->end_group_handle, second - 1);
+  EXPECT_EQ(database.Get(second)->end_group_handle, level);
+  EXPECT_EQ(database.Get(second)->value, std::vector<uint8_t>({0x0f, 0x18}));
+}
+
+TEST(AttributeDatabaseTest, set_value) {
+  AttributeDatabase database;
+  database.AddService(Uuid::From16Bit(0x180f), true);
+  uint16_t level = database.AddCharacteristic(Uuid::From16Bit(0x2a19), kPropertyRead, kPermissionRead, {100});
+  EXPECT_TRUE(database.SetValue(level, {42}));
+  EXPECT_EQ(database.Get(level)->value, std::vector<uint8_t>({42}));
+  EXPECT_FALSE(database.SetValue(level + 1, {42}));
+  EXPECT_FALSE(database.SetValue(kInvalidHandle, {42}));
+}
+
+}  // namespace
+}  // namespace att
+}  // namespace bluetooth
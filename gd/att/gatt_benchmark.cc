@@ -0,0 +1,193 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "benchmark/benchmark.h"
+
+#include <future>
+#include <memory>
+#include <vector>
+
+#include "att/att_bearer.h"
+#include "att/attribute_database.h"
+#include "att/gatt_client.h"
+#include "att/gatt_server.h"
+#include "common/bind.h"
+#include "common/testing/wired_pair_of_bidi_queues.h"
+#include "os/handler.h"
+#include "os/thread.h"
+
+using ::benchmark::State;
+
+namespace bluetooth {
+namespace att {
+namespace {
+
+using common::testing::WiredPairOfL2capQueues;
+
+constexpr size_t kNotificationsPerRound = 64;
+// The size of a heart rate or a HID report
+constexpr size_t kNotifiedValueSize = 8;
+constexpr uint16_t kEnhancedMtu = 247;
+constexpr int kCharacteristicsPerService = 4;
+
+// A server and a client connected by bearers over wired queues, both served by the same handler as on a device
+class BM_Gatt : public ::benchmark::Fixture {
+ protected:
+  void SetUp(State& st) override {
+    ::benchmark::Fixture::SetUp(st);
+    thread_ = new os::Thread("gatt_thread", os::Thread::Priority::NORMAL);
+    handler_ = new os::Handler(thread_);
+    database_ = std::make_unique<AttributeDatabase>();
+    server_ = std::make_unique<GattServer>(database_.get());
+    client_ = std::make_unique<GattClient>();
+  }
+
+  void TearDown(State& st) override {
+    RunOnHandler([this]() {
+      for (auto& bearer : client_bearers_) {
+        client_->RemoveBearer(bearer.get());
+      }
+      client_bearers_.clear();
+      server_bearers_.clear();
+    });
+    links_.clear();
+    handler_->Clear();
+    client_.reset();
+    server_.reset();
+    database_.reset();
+    delete handler_;
+    delete thread_;
+    ::benchmark::Fixture::TearDown(st);
+  }
+
+  template <typename F>
+  void RunOnHandler(F f) {
+    std::promise<void> promise;
+    auto future = promise.get_future();
+    handler_->Post([&f, &promise]() {
+      f();
+      promise.set_value();
+    });
+    future.wait();
+  }
+
+  void AddLink(bool enhanced) {
+    links_.push_back(std::make_unique<WiredPairOfL2capQueues>(handler_));
+    auto* link = links_.back().get();
+    uint16_t mtu = enhanced ? kEnhancedMtu : AttBearer::kDefaultMtu;
+    RunOnHandler([this, link, enhanced, mtu]() {
+      server_bearers_.push_back(std::make_unique<AttBearer>(link->GetQueueAUpEnd(), handler_, enhanced, mtu));
+      server_->AddBearer(server_bearers_.back().get());
+      client_bearers_.push_back(std::make_unique<AttBearer>(link->GetQueueBUpEnd(), handler_, enhanced, mtu));
+      client_->AddBearer(client_bearers_.back().get());
+    });
+  }
+
+  os::Thread* thread_ = nullptr;
+  os::Handler* handler_ = nullptr;
+  std::unique_ptr<AttributeDatabase> database_;
+  std::unique_ptr<GattServer> server_;
+  std::unique_ptr<GattClient> client_;
+  std::vector<std::unique_ptr<WiredPairOfL2capQueues>> links_;
+  std::vector<std::unique_ptr<AttBearer>> server_bearers_;
+  std::vector<std::unique_ptr<AttBearer>> client_bearers_;
+};
+
+// Each round notifies a burst of small values, and waits for the client to receive all of them. The values share
+// PDUs on an enhanced bearer (range 0 is 1), and go one per PDU otherwise.
+BENCHMARK_DEFINE_F(BM_Gatt, notification_throughput)(State& state) {
+  AddLink(state.range(0) != 0);
+  std::vector<std::pair<uint16_t, std::vector<uint8_t>>> values;
+  for (size_t i = 0; i < kNotificationsPerRound; i++) {
+    values.emplace_back(i + 1, std::vector<uint8_t>(kNotifiedValueSize, i));
+  }
+  size_t received = 0;
+  std::promise<void>* round_promise = nullptr;
+  RunOnHandler([&]() {
+    client_->SetValueCallback(common::Bind(
+        [](size_t* received, std::promise<void>** round_promise, uint16_t handle, AttBearer::Value value) {
+          if (++*received == kNotificationsPerRound) {
+            (*round_promise)->set_value();
+          }
+        },
+        &received, &round_promise));
+  });
+
+  for (auto _ : state) {
+    std::promise<void> promise;
+    auto future = promise.get_future();
+    round_promise = &promise;
+    received = 0;
+    handler_->Post([this, &values]() { server_bearers_[0]->SendNotifications(values); });
+    future.wait();
+  }
+  state.SetItemsProcessed(state.iterations() * kNotificationsPerRound);
+}
+
+BENCHMARK_REGISTER_F(BM_Gatt, notification_throughput)->Arg(0)->Arg(1)->UseRealTime();
+
+// Discovers the services of a database of range(0) services, and then the characteristics of all of them at once,
+// over range(1) bearers
+BENCHMARK_DEFINE_F(BM_Gatt, discovery)(State& state) {
+  for (int i = 0; i < state.range(0); i++) {
+    database_->AddService(Uuid::From16Bit(0x1800 + i), true);
+    for (int j = 0; j < kCharacteristicsPerService; j++) {
+      database_->AddCharacteristic(Uuid::From16Bit(0x2a00 + j), kPropertyRead, kPermissionRead, {0x00});
+    }
+  }
+  AddLink(false);
+  for (int i = 1; i < state.range(1); i++) {
+    AddLink(true);
+  }
+
+  for (auto _ : state) {
+    std::promise<void> promise;
+    auto future = promise.get_future();
+    handler_->Post([this, &promise]() {
+      client_->DiscoverPrimaryServices(common::BindOnce(
+          [](GattClient* client, std::promise<void>* promise, AttErrorCode error,
+             std::vector<GattClient::Service> services) {
+            auto remaining = std::make_shared<size_t>(services.size());
+            for (const auto& service : services) {
+              client->DiscoverCharacteristics(
+                  service.handle, service.end_group_handle,
+                  common::BindOnce(
+                      [](std::shared_ptr<size_t> remaining, std::promise<void>* promise, AttErrorCode error,
+                         std::vector<GattClient::Characteristic> characteristics) {
+                        if (--*remaining == 0) {
+                          promise->set_value();
+                        }
+                      },
+                      remaining, promise));
+            }
+          },
+          client_.get(), &promise));
+    });
+    future.wait();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK_REGISTER_F(BM_Gatt, discovery)
+    ->Args({16, 1})
+    ->Args({16, 4})
+    ->Args({64, 1})
+    ->Args({64, 4})
+    ->UseRealTime();
+
+}  // namespace
+}  // namespace att
+}  // namespace bluetooth
@@ -0,0 +1,248 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "att/gatt_client.h"
+
+#include <algorithm>
+
+#include "att/attribute_database.h"
+#include "common/bind.h"
+#include "os/log.h"
+#include "packet/iterator.h"
+#include "packet/raw_builder.h"
+
+namespace bluetooth {
+namespace att {
+
+namespace {
+// Handle and end group handle of a service, before its UUID
+constexpr size_t kServiceEntryHeaderSize = 4;
+// Handle, properties and value handle of a characteristic, before its UUID
+constexpr size_t kCharacteristicEntryHeaderSize = 5;
+
+// Returns the error of |pdu| if it is not the |expected| response
+AttErrorCode GetError(AttPduView pdu, Opcode expected) {
+  if (!pdu.IsValid()) {
+    return AttErrorCode::UNLIKELY_ERROR;
+  }
+  if (pdu.GetOpcode() == Opcode::ERROR_RESPONSE) {
+    ErrorResponseView error = ErrorResponseView::Create(pdu);
+    if (!error.IsValid() || error.GetErrorCode() == AttErrorCode::SUCCESS) {
+      return AttErrorCode::UNLIKELY_ERROR;
+    }
+    return error.GetErrorCode();
+  }
+  return pdu.GetOpcode() == expected ? AttErrorCode::SUCCESS : AttErrorCode::UNLIKELY_ERROR;
+}
+
+bool ExtractUuid(packet::Iterator<packet::kLittleEndian>* it, size_t size, Uuid* uuid) {
+  if (size != Uuid::kNumBytes16 && size != Uuid::kNumBytes128) {
+    return false;
+  }
+  uint8_t bytes[Uuid::kNumBytes128];
+  for (size_t i = 0; i < size; i++) {
+    bytes[i] = **it;
+    ++*it;
+  }
+  return Uuid::FromBytes(bytes, size, uuid);
+}
+
+AttBearer::Value EmptyValue() {
+  return AttBearer::Value(std::make_shared<std::vector<uint8_t>>());
+}
+}  // namespace
+
+void GattClient::AddBearer(AttBearer* bearer) {
+  bearers_.push_back(bearer);
+  if (!value_callback_.is_null()) {
+    bearer->SetValueCallback(value_callback_);
+  }
+}
+
+void GattClient::RemoveBearer(AttBearer* bearer) {
+  bearers_.erase(std::remove(bearers_.begin(), bearers_.end(), bearer), bearers_.end());
+}
+
+void GattClient::SetValueCallback(AttBearer::ValueCallback callback) {
+  value_callback_ = std::move(callback);
+  for (auto* bearer : bearers_) {
+    bearer->SetValueCallback(value_callback_);
+  }
+}
+
+void GattClient::DiscoverPrimaryServices(ServicesCallback callback) {
+  auto discovery = std::make_unique<ServiceDiscovery>();
+  discovery->callback = std::move(callback);
+  discover_services_from(1, std::move(discovery));
+}
+
+void GattClient::DiscoverCharacteristics(uint16_t starting_handle, uint16_t ending_handle,
+                                         CharacteristicsCallback callback) {
+  auto discovery = std::make_unique<CharacteristicDiscovery>();
+  discovery->ending_handle = ending_handle;
+  discovery->callback = std::move(callback);
+  discover_characteristics_from(starting_handle, std::move(discovery));
+}
+
+void GattClient::Read(uint16_t handle, ReadCallback callback) {
+  send_request(ReadRequestBuilder::Create(handle),
+               common::BindOnce(&GattClient::on_read, common::Unretained(this), std::move(callback)));
+}
+
+void GattClient::Write(uint16_t handle, const std::vector<uint8_t>& value, WriteCallback callback) {
+  send_request(WriteRequestBuilder::Create(handle, std::make_unique<packet::RawBuilder>(value)),
+               common::BindOnce(&GattClient::on_write, common::Unretained(this), std::move(callback)));
+}
+
+void GattClient::WriteWithoutResponse(uint16_t handle, const std::vector<uint8_t>& value) {
+  AttBearer* bearer = pick_bearer();
+  if (bearer == nullptr) {
+    LOG_WARN("No bearer to write on");
+    return;
+  }
+  bearer->SendCommand(WriteCommandBuilder::Create(handle, std::make_unique<packet::RawBuilder>(value)));
+}
+
+AttBearer* GattClient::pick_bearer() const {
+  auto bearer = std::min_element(bearers_.begin(), bearers_.end(), [](AttBearer* a, AttBearer* b) {
+    return a->GetPendingRequestCount() < b->GetPendingRequestCount();
+  });
+  return bearer == bearers_.end() ? nullptr : *bearer;
+}
+
+void GattClient::send_request(std::unique_ptr<AttPduBuilder> request, AttBearer::ResponseCallback callback) {
+  AttBearer* bearer = pick_bearer();
+  if (bearer == nullptr) {
+    LOG_WARN("No bearer to send a request on");
+    std::move(callback).Run(AttPduView::Create(EmptyValue()));
+    return;
+  }
+  bearer->SendRequest(std::move(request), std::move(callback));
+}
+
+void GattClient::discover_services_from(uint16_t starting_handle, std::unique_ptr<ServiceDiscovery> discovery) {
+  send_request(
+      ReadByGroupTypeRequestBuilder::Create(starting_handle, kMaxHandle,
+                                            Uuid::From16Bit(kPrimaryServiceUuid).ToBytes()),
+      common::BindOnce(&GattClient::on_services, common::Unretained(this), std::move(discovery)));
+}
+
+void GattClient::on_services(std::unique_ptr<ServiceDiscovery> discovery, AttPduView pdu) {
+  AttErrorCode error = GetError(pdu, Opcode::READ_BY_GROUP_TYPE_RESPONSE);
+  if (error == AttErrorCode::ATTRIBUTE_NOT_FOUND) {
+    // There is no service past the last one found
+    std::move(discovery->callback).Run(AttErrorCode::SUCCESS, std::move(discovery->services));
+    return;
+  }
+  ReadByGroupTypeResponseView response = ReadByGroupTypeResponseView::Create(pdu);
+  if (error == AttErrorCode::SUCCESS && (!response.IsValid() || response.GetLength() <= kServiceEntryHeaderSize)) {
+    error = AttErrorCode::UNLIKELY_ERROR;
+  }
+  if (error != AttErrorCode::SUCCESS) {
+    std::move(discovery->callback).Run(error, std::move(discovery->services));
+    return;
+  }
+
+  size_t entry_size = response.GetLength();
+  AttBearer::Value payload = response.GetPayload();
+  uint16_t last_handle = kInvalidHandle;
+  for (size_t offset = 0; offset + entry_size <= payload.size(); offset += entry_size) {
+    auto it = payload.begin() + offset;
+    Service service;
+    service.handle = it.extract<uint16_t>();
+    service.end_group_handle = it.extract<uint16_t>();
+    if (!ExtractUuid(&it, entry_size - kServiceEntryHeaderSize, &service.uuid) ||
+        service.end_group_handle < service.handle || service.handle <= last_handle) {
+      std::move(discovery->callback).Run(AttErrorCode::UNLIKELY_ERROR, std::move(discovery->services));
+      return;
+    }
+    last_handle = service.end_group_handle;
+    discovery->services.push_back(service);
+  }
+  if (last_handle == kInvalidHandle || last_handle == kMaxHandle) {
+    std::move(discovery->callback).Run(AttErrorCode::SUCCESS, std::move(discovery->services));
+    return;
+  }
+  discover_services_from(last_handle + 1, std::move(discovery));
+}
+
+void GattClient::discover_characteristics_from(uint16_t starting_handle,
+                                               std::unique_ptr<CharacteristicDiscovery> discovery) {
+  uint16_t ending_handle = discovery->ending_handle;
+  send_request(
+      ReadByTypeRequestBuilder::Create(starting_handle, ending_handle, Uuid::From16Bit(kCharacteristicUuid).ToBytes()),
+      common::BindOnce(&GattClient::on_characteristics, common::Unretained(this), std::move(discovery)));
+}
+
+void GattClient::on_characteristics(std::unique_ptr<CharacteristicDiscovery> discovery, AttPduView pdu) {
+  AttErrorCode error = GetError(pdu, Opcode::READ_BY_TYPE_RESPONSE);
+  if (error == AttErrorCode::ATTRIBUTE_NOT_FOUND) {
+    std::move(discovery->callback).Run(AttErrorCode::SUCCESS, std::move(discovery->characteristics));
+    return;
+  }
+  ReadByTypeResponseView response = ReadByTypeResponseView::Create(pdu);
+  if (error == AttErrorCode::SUCCESS &&
+      (!response.IsValid() || response.GetLength() <= kCharacteristicEntryHeaderSize)) {
+    error = AttErrorCode::UNLIKELY_ERROR;
+  }
+  if (error != AttErrorCode::SUCCESS) {
+    std::move(discovery->callback).Run(error, std::move(discovery->characteristics));
+    return;
+  }
+
+  size_t entry_size = response.GetLength();
+  AttBearer::Value payload = response.GetPayload();
+  uint16_t last_handle = kInvalidHandle;
+  for (size_t offset = 0; offset + entry_size <= payload.size(); offset += entry_size) {
+    auto it = payload.begin() + offset;
+    Characteristic characteristic;
+    characteristic.declaration_handle = it.extract<uint16_t>();
+    characteristic.properties = it.extract<uint8_t>();
+    characteristic.value_handle = it.extract<uint16_t>();
+    if (!ExtractUuid(&it, entry_size - kCharacteristicEntryHeaderSize, &characteristic.uuid) ||
+        characteristic.declaration_handle <= last_handle) {
+      std::move(discovery->callback).Run(AttErrorCode::UNLIKELY_ERROR, std::move(discovery->characteristics));
+      return;
+    }
+    last_handle = characteristic.declaration_handle;
+    discovery->characteristics.push_back(characteristic);
+  }
+  if (last_handle == kInvalidHandle || last_handle >= discovery->ending_handle) {
+    std::move(discovery->callback).Run(AttErrorCode::SUCCESS, std::move(discovery->characteristics));
+    return;
+  }
+  discover_characteristics_from(last_handle + 1, std::move(discovery));
+}
+
+void GattClient::on_read(ReadCallback callback, AttPduView pdu) {
+  AttErrorCode error = GetError(pdu, Opcode::READ_RESPONSE);
+  ReadResponseView response = ReadResponseView::Create(pdu);
+  if (error == AttErrorCode::SUCCESS && !response.IsValid()) {
+    error = AttErrorCode::UNLIKELY_ERROR;
+  }
+  if (error != AttErrorCode::SUCCESS) {
+    std::move(callback).Run(error, EmptyValue());
+    return;
+  }
+  std::move(callback).Run(AttErrorCode::SUCCESS, response.GetPayload());
+}
+
+void GattClient::on_write(WriteCallback callback, AttPduView pdu) {
+  std::move(callback).Run(GetError(pdu, Opcode::WRITE_RESPONSE));
+}
+
+}  // namespace att
+}  // namespace bluetooth
@@ -0,0 +1,98 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "att/att_bearer.h"
+#include "att/att_packets.h"
+#include "att/uuid.h"
+#include "common/callback.h"
+
+namespace bluetooth {
+namespace att {
+
+// GATT client of one connection. Its procedures are spread over the bearers of the connection: each request goes to
+// the bearer with the fewest requests pending, so that with EATT several requests are in flight at once. It must be
+// used on the handler of the bearers.
+class GattClient {
+ public:
+  struct Service {
+    uint16_t handle;
+    uint16_t end_group_handle;
+    Uuid uuid;
+  };
+
+  struct Characteristic {
+    uint16_t declaration_handle;
+    uint8_t properties;
+    uint16_t value_handle;
+    Uuid uuid;
+  };
+
+  // The error codes are the ones of the server, or UNLIKELY_ERROR if the procedure could not complete locally
+  using ServicesCallback = common::OnceCallback<void(AttErrorCode, std::vector<Service>)>;
+  using CharacteristicsCallback = common::OnceCallback<void(AttErrorCode, std::vector<Characteristic>)>;
+  // |value| is a view of the received PDU, that is not copied, and is empty on error
+  using ReadCallback = common::OnceCallback<void(AttErrorCode, AttBearer::Value value)>;
+  using WriteCallback = common::OnceCallback<void(AttErrorCode)>;
+
+  GattClient() = default;
+
+  // Uses |bearer| for the next requests. It must be removed before it is destroyed.
+  void AddBearer(AttBearer* bearer);
+  void RemoveBearer(AttBearer* bearer);
+
+  // Called with the values notified and indicated on any bearer
+  void SetValueCallback(AttBearer::ValueCallback callback);
+
+  void DiscoverPrimaryServices(ServicesCallback callback);
+  void DiscoverCharacteristics(uint16_t starting_handle, uint16_t ending_handle, CharacteristicsCallback callback);
+  void Read(uint16_t handle, ReadCallback callback);
+  void Write(uint16_t handle, const std::vector<uint8_t>& value, WriteCallback callback);
+  void WriteWithoutResponse(uint16_t handle, const std::vector<uint8_t>& value);
+
+ private:
+  struct ServiceDiscovery {
+    std::vector<Service> services;
+    ServicesCallback callback;
+  };
+
+  struct CharacteristicDiscovery {
+    uint16_t ending_handle;
+    std::vector<Characteristic> characteristics;
+    CharacteristicsCallback callback;
+  };
+
+  // Returns the least busy bearer, nullptr if there is none
+  AttBearer* pick_bearer() const;
+  void send_request(std::unique_ptr<AttPduBuilder> request, AttBearer::ResponseCallback callback);
+
+  void discover_services_from(uint16_t starting_handle, std::unique_ptr<ServiceDiscovery> discovery);
+  void on_services(std::unique_ptr<ServiceDiscovery> discovery, AttPduView pdu);
+  void discover_characteristics_from(uint16_t starting_handle, std::unique_ptr<CharacteristicDiscovery> discovery);
+  void on_characteristics(std::unique_ptr<CharacteristicDiscovery> discovery, AttPduView pdu);
+  void on_read(ReadCallback callback, AttPduView pdu);
+  void on_write(WriteCallback callback, AttPduView pdu);
+
+  std::vector<AttBearer*> bearers_;
+  AttBearer::ValueCallback value_callback_;
+};
+
+}  // namespace att
+}  // namespace bluetooth
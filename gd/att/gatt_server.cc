@@ -0,0 +1,318 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "att/gatt_server.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "common/bind.h"
+#include "os/log.h"
+#include "packet/raw_builder.h"
+
+namespace bluetooth {
+namespace att {
+
+namespace {
+constexpr size_t kMaxValueSize = 512;
+// The length of a ReadByType or ReadByGroupType entry is 8 bits
+constexpr size_t kMaxEntrySize = 255;
+
+bool IsValidRange(uint16_t starting_handle, uint16_t ending_handle) {
+  return starting_handle != kInvalidHandle && starting_handle <= ending_handle;
+}
+
+std::vector<uint8_t> Prefix(const std::vector<uint8_t>& value, size_t max_size) {
+  return std::vector<uint8_t>(value.begin(), value.begin() + std::min(value.size(), max_size));
+}
+}  // namespace
+
+GattServer::GattServer(AttributeDatabase* database) : database_(database) {
+  ASSERT(database_ != nullptr);
+}
+
+void GattServer::SetWriteCallback(WriteCallback callback) {
+  write_callback_ = std::move(callback);
+}
+
+void GattServer::AddBearer(AttBearer* bearer) {
+  bearer->SetRequestCallback(common::Bind(&GattServer::OnRequest, common::Unretained(this)));
+}
+
+void GattServer::OnRequest(AttBearer* bearer, AttPduView request) {
+  switch (request.GetOpcode()) {
+    case Opcode::FIND_INFORMATION_REQUEST:
+      on_find_information(bearer, request);
+      return;
+    case Opcode::READ_BY_TYPE_REQUEST:
+      on_read_by_type(bearer, request);
+      return;
+    case Opcode::READ_REQUEST:
+      on_read(bearer, request);
+      return;
+    case Opcode::READ_BLOB_REQUEST:
+      on_read_blob(bearer, request);
+      return;
+    case Opcode::READ_BY_GROUP_TYPE_REQUEST:
+      on_read_by_group_type(bearer, request);
+      return;
+    case Opcode::WRITE_REQUEST:
+      on_write(bearer, request, true);
+      return;
+    case Opcode::WRITE_COMMAND:
+      on_write(bearer, request, false);
+      return;
+    case Opcode::SIGNED_WRITE_COMMAND:
+      // Commands are never answered
+      return;
+    default:
+      bearer->SendError(request.GetOpcode(), kInvalidHandle, AttErrorCode::REQUEST_NOT_SUPPORTED);
+      return;
+  }
+}
+
+void GattServer::on_find_information(AttBearer* bearer, AttPduView pdu) {
+  FindInformationRequestView request = FindInformationRequestView::Create(pdu);
+  if (!request.IsValid()) {
+    bearer->SendError(Opcode::FIND_INFORMATION_REQUEST, kInvalidHandle, AttErrorCode::INVALID_PDU);
+    return;
+  }
+  uint16_t starting_handle = request.GetStartingHandle();
+  uint16_t ending_handle = std::min(request.GetEndingHandle(), database_->GetLastHandle());
+  if (!IsValidRange(starting_handle, request.GetEndingHandle())) {
+    bearer->SendError(Opcode::FIND_INFORMATION_REQUEST, starting_handle, AttErrorCode::INVALID_HANDLE);
+    return;
+  }
+
+  // All the types of a response have the same size, the one of the first
+  auto payload = std::make_unique<packet::RawBuilder>();
+  size_t size = 2;  // Opcode and format
+  size_t uuid_size = 0;
+  for (uint32_t handle = starting_handle; handle <= ending_handle; handle++) {
+    const Attribute* attribute = database_->Get(handle);
+    size_t type_size = attribute->type.GetShortestSize();
+    if (uuid_size == 0) {
+      uuid_size = type_size;
+    }
+    if (type_size != uuid_size || size + sizeof(uint16_t) + type_size > bearer->GetMtu()) {
+      break;
+    }
+    payload->AddOctets2(handle);
+    payload->AddOctets(attribute->type.ToBytes());
+    size += sizeof(uint16_t) + type_size;
+  }
+  if (uuid_size == 0) {
+    bearer->SendError(Opcode::FIND_INFORMATION_REQUEST, starting_handle, AttErrorCode::ATTRIBUTE_NOT_FOUND);
+    return;
+  }
+  auto format = uuid_size == Uuid::kNumBytes16 ? InformationFormat::UUID_16_BIT : InformationFormat::UUID_128_BIT;
+  bearer->SendResponse(FindInformationResponseBuilder::Create(format, std::move(payload)));
+}
+
+void GattServer::on_read_by_type(AttBearer* bearer, AttPduView pdu) {
+  ReadByTypeRequestView request = ReadByTypeRequestView::Create(pdu);
+  Uuid type;
+  if (!request.IsValid() || !Uuid::FromBytes(request.GetAttributeType(), &type)) {
+    bearer->SendError(Opcode::READ_BY_TYPE_REQUEST, kInvalidHandle, AttErrorCode::INVALID_PDU);
+    return;
+  }
+  uint16_t starting_handle = request.GetStartingHandle();
+  uint16_t ending_handle = std::min(request.GetEndingHandle(), database_->GetLastHandle());
+  if (!IsValidRange(starting_handle, request.GetEndingHandle())) {
+    bearer->SendError(Opcode::READ_BY_TYPE_REQUEST, starting_handle, AttErrorCode::INVALID_HANDLE);
+    return;
+  }
+
+  // All the values of a response have the same length, the one of the first
+  auto payload = std::make_unique<packet::RawBuilder>();
+  size_t size = 2;  // Opcode and length
+  size_t value_size = 0;
+  size_t count = 0;
+  for (uint32_t handle = starting_handle; handle <= ending_handle; handle++) {
+    const Attribute* attribute = database_->Get(handle);
+    if (attribute->type != type) {
+      continue;
+    }
+    if (!(attribute->permissions & kPermissionRead)) {
+      if (count == 0) {
+        bearer->SendError(Opcode::READ_BY_TYPE_REQUEST, handle, AttErrorCode::READ_NOT_PERMITTED);
+        return;
+      }
+      break;
+    }
+    if (count == 0) {
+      value_size = std::min({attribute->value.size(), bearer->GetMtu() - size - sizeof(uint16_t),
+                             kMaxEntrySize - sizeof(uint16_t)});
+    } else if (attribute->value.size() != value_size || size + sizeof(uint16_t) + value_size > bearer->GetMtu()) {
+      break;
+    }
+    payload->AddOctets2(handle);
+    payload->AddOctets(Prefix(attribute->value, value_size));
+    size += sizeof(uint16_t) + value_size;
+    count++;
+  }
+  if (count == 0) {
+    bearer->SendError(Opcode::READ_BY_TYPE_REQUEST, starting_handle, AttErrorCode::ATTRIBUTE_NOT_FOUND);
+    return;
+  }
+  bearer->SendResponse(ReadByTypeResponseBuilder::Create(sizeof(uint16_t) + value_size, std::move(payload)));
+}
+
+void GattServer::on_read(AttBearer* bearer, AttPduView pdu) {
+  ReadRequestView request = ReadRequestView::Create(pdu);
+  if (!request.IsValid()) {
+    bearer->SendError(Opcode::READ_REQUEST, kInvalidHandle, AttErrorCode::INVALID_PDU);
+    return;
+  }
+  uint16_t handle = request.GetAttributeHandle();
+  const Attribute* attribute = database_->Get(handle);
+  if (attribute == nullptr) {
+    bearer->SendError(Opcode::READ_REQUEST, handle, AttErrorCode::INVALID_HANDLE);
+    return;
+  }
+  if (!(attribute->permissions & kPermissionRead)) {
+    bearer->SendError(Opcode::READ_REQUEST, handle, AttErrorCode::READ_NOT_PERMITTED);
+    return;
+  }
+  auto value = Prefix(attribute->value, bearer->GetMtu() - 1);
+  bearer->SendResponse(ReadResponseBuilder::Create(std::make_unique<packet::RawBuilder>(std::move(value))));
+}
+
+void GattServer::on_read_blob(AttBearer* bearer, AttPduView pdu) {
+  ReadBlobRequestView request = ReadBlobRequestView::Create(pdu);
+  if (!request.IsValid()) {
+    bearer->SendError(Opcode::READ_BLOB_REQUEST, kInvalidHandle, AttErrorCode::INVALID_PDU);
+    return;
+  }
+  uint16_t handle = request.GetAttributeHandle();
+  const Attribute* attribute = database_->Get(handle);
+  if (attribute == nullptr) {
+    bearer->SendError(Opcode::READ_BLOB_REQUEST, handle, AttErrorCode::INVALID_HANDLE);
+    return;
+  }
+  if (!(attribute->permissions & kPermissionRead)) {
+    bearer->SendError(Opcode::READ_BLOB_REQUEST, handle, AttErrorCode::READ_NOT_PERMITTED);
+    return;
+  }
+  size_t offset = request.GetValueOffset();
+  if (offset > attribute->value.size()) {
+    bearer->SendError(Opcode::READ_BLOB_REQUEST, handle, AttErrorCode::INVALID_OFFSET);
+    return;
+  }
+  size_t size = std::min(attribute->value.size() - offset, static_cast<size_t>(bearer->GetMtu() - 1));
+  std::vector<uint8_t> value(attribute->value.begin() + offset, attribute->value.begin() + offset + size);
+  bearer->SendResponse(ReadBlobResponseBuilder::Create(std::make_unique<packet::RawBuilder>(std::move(value))));
+}
+
+void GattServer::on_read_by_group_type(AttBearer* bearer, AttPduView pdu) {
+  ReadByGroupTypeRequestView request = ReadByGroupTypeRequestView::Create(pdu);
+  Uuid type;
+  if (!request.IsValid() || !Uuid::FromBytes(request.GetAttributeGroupType(), &type)) {
+    bearer->SendError(Opcode::READ_BY_GROUP_TYPE_REQUEST, kInvalidHandle, AttErrorCode::INVALID_PDU);
+    return;
+  }
+  uint16_t starting_handle = request.GetStartingHandle();
+  uint16_t ending_handle = std::min(request.GetEndingHandle(), database_->GetLastHandle());
+  if (!IsValidRange(starting_handle, request.GetEndingHandle())) {
+    bearer->SendError(Opcode::READ_BY_GROUP_TYPE_REQUEST, starting_handle, AttErrorCode::INVALID_HANDLE);
+    return;
+  }
+  if (type != Uuid::From16Bit(kPrimaryServiceUuid) && type != Uuid::From16Bit(kSecondaryServiceUuid)) {
+    bearer->SendError(Opcode::READ_BY_GROUP_TYPE_REQUEST, starting_handle, AttErrorCode::UNSUPPORTED_GROUP_TYPE);
+    return;
+  }
+
+  // Each entry holds the handle of the declaration, the handle ending its group, and its value
+  constexpr size_t kEntryHeaderSize = 2 * sizeof(uint16_t);
+  auto payload = std::make_unique<packet::RawBuilder>();
+  size_t size = 2;  // Opcode and length
+  size_t value_size = 0;
+  size_t count = 0;
+  for (uint32_t handle = starting_handle; handle <= ending_handle; handle++) {
+    const Attribute* attribute = database_->Get(handle);
+    if (attribute->type != type) {
+      continue;
+    }
+    if (count == 0) {
+      value_size = std::min({attribute->value.size(), bearer->GetMtu() - size - kEntryHeaderSize,
+                             kMaxEntrySize - kEntryHeaderSize});
+    } else if (attribute->value.size() != value_size || size + kEntryHeaderSize + value_size > bearer->GetMtu()) {
+      break;
+    }
+    payload->AddOctets2(handle);
+    payload->AddOctets2(attribute->end_group_handle);
+    payload->AddOctets(Prefix(attribute->value, value_size));
+    size += kEntryHeaderSize + value_size;
+    count++;
+    // The attributes of the group can't be group declarations
+    handle = attribute->end_group_handle;
+  }
+  if (count == 0) {
+    bearer->SendError(Opcode::READ_BY_GROUP_TYPE_REQUEST, starting_handle, AttErrorCode::ATTRIBUTE_NOT_FOUND);
+    return;
+  }
+  bearer->SendResponse(ReadByGroupTypeResponseBuilder::Create(kEntryHeaderSize + value_size, std::move(payload)));
+}
+
+void GattServer::on_write(AttBearer* bearer, AttPduView pdu, bool with_response) {
+  uint16_t handle;
+  AttBearer::Value value = pdu.GetPayload();
+  if (with_response) {
+    WriteRequestView request = WriteRequestView::Create(pdu);
+    if (!request.IsValid()) {
+      bearer->SendError(Opcode::WRITE_REQUEST, kInvalidHandle, AttErrorCode::INVALID_PDU);
+      return;
+    }
+    handle = request.GetAttributeHandle();
+    value = request.GetPayload();
+  } else {
+    WriteCommandView command = WriteCommandView::Create(pdu);
+    if (!command.IsValid()) {
+      return;
+    }
+    handle = command.GetAttributeHandle();
+    value = command.GetPayload();
+  }
+
+  AttErrorCode error = AttErrorCode::SUCCESS;
+  const Attribute* attribute = database_->Get(handle);
+  if (attribute == nullptr) {
+    error = AttErrorCode::INVALID_HANDLE;
+  } else if (!(attribute->permissions & kPermissionWrite)) {
+    error = AttErrorCode::WRITE_NOT_PERMITTED;
+  } else if (value.size() > kMaxValueSize) {
+    error = AttErrorCode::INVALID_ATTRIBUTE_VALUE_LENGTH;
+  }
+  if (error != AttErrorCode::SUCCESS) {
+    if (with_response) {
+      bearer->SendError(Opcode::WRITE_REQUEST, handle, error);
+    }
+    return;
+  }
+
+  std::vector<uint8_t> bytes(value.size());
+  value.CopyTo(bytes.data());
+  database_->SetValue(handle, std::move(bytes));
+  if (with_response) {
+    bearer->SendResponse(WriteResponseBuilder::Create());
+  }
+  if (!write_callback_.is_null()) {
+    write_callback_.Run(handle, value);
+  }
+}
+
+}  // namespace att
+}  // namespace bluetooth
@@ -0,0 +1,58 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <cstdint>
+
+#include "att/att_bearer.h"
+#include "att/att_packets.h"
+#include "att/attribute_database.h"
+#include "common/callback.h"
+
+namespace bluetooth {
+namespace att {
+
+// Answers the requests of the peer clients from the local attribute database. A single server serves all the bearers
+// of all the connections; it must be used on the handler of the bearers.
+class GattServer {
+ public:
+  // Called once the value at |handle| was written by a client. |value| is a view of the received PDU, that is not
+  // copied.
+  using WriteCallback = common::Callback<void(uint16_t handle, AttBearer::Value value)>;
+
+  explicit GattServer(AttributeDatabase* database);
+
+  void SetWriteCallback(WriteCallback callback);
+
+  // Serves the requests received on |bearer|, until it is destroyed
+  void AddBearer(AttBearer* bearer);
+
+  void OnRequest(AttBearer* bearer, AttPduView request);
+
+ private:
+  void on_find_information(AttBearer* bearer, AttPduView request);
+  void on_read_by_type(AttBearer* bearer, AttPduView request);
+  void on_read(AttBearer* bearer, AttPduView request);
+  void on_read_blob(AttBearer* bearer, AttPduView request);
+  void on_read_by_group_type(AttBearer* bearer, AttPduView request);
+  void on_write(AttBearer* bearer, AttPduView request, bool with_response);
+
+  AttributeDatabase* database_;
+  WriteCallback write_callback_;
+};
+
+}  // namespace att
+}  // namespace bluetooth
@@ -0,0 +1,364 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <future>
+#include <memory>
+#include <vector>
+
+#include "att/att_bearer.h"
+#include "att/attribute_database.h"
+#include "att/gatt_client.h"
+#include "att/gatt_server.h"
+#include "common/bind.h"
+#include "common/testing/wired_pair_of_bidi_queues.h"
+#include "os/handler.h"
+#include "os/thread.h"
+#include "packet/bit_inserter.h"
+
+namespace bluetooth {
+namespace att {
+namespace {
+
+using common::testing::WiredPairOfL2capQueues;
+
+constexpr std::chrono::seconds kTimeout = std::chrono::seconds(2);
+
+std::vector<uint8_t> ToVector(AttBearer::Value value) {
+  std::vector<uint8_t> bytes(value.size());
+  value.CopyTo(bytes.data());
+  return bytes;
+}
+
+class GattTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    thread_ = new os::Thread("test_thread", os::Thread::Priority::NORMAL);
+    handler_ = new os::Handler(thread_);
+
+    database_.AddService(Uuid::From16Bit(0x1800), true);
+    name_handle_ = database_.AddCharacteristic(Uuid::From16Bit(0x2a00), kPropertyRead, kPermissionRead, {'g', 'd'});
+    database_.AddService(Uuid::From16Bit(0x180f), true);
+    level_handle_ = database_.AddCharacteristic(Uuid::From16Bit(0x2a19), kPropertyRead | kPropertyNotify,
+                                                kPermissionRead, {100});
+    // A 128 bit UUID, that can't share a response with the 16 bit ones
+    Uuid::FromBytes(std::vector<uint8_t>(16, 0x42), &custom_uuid_);
+    database_.AddService(custom_uuid_, true);
+    control_handle_ = database_.AddCharacteristic(Uuid::From16Bit(0x2a9f), kPropertyWrite, kPermissionWrite, {});
+    server_ = std::make_unique<GattServer>(&database_);
+  }
+
+  void TearDown() override {
+    RunOnHandler([this]() {
+      for (auto& bearer : client_bearers_) {
+        client_.RemoveBearer(bearer.get());
+      }
+      client_bearers_.clear();
+      server_bearers_.clear();
+    });
+    links_.clear();
+    handler_->Clear();
+    delete handler_;
+    delete thread_;
+  }
+
+  template <typename F>
+  void RunOnHandler(F f) {
+    std::promise<void> promise;
+    auto future = promise.get_future();
+    handler_->Post([&f, &promise]() {
+      f();
+      promise.set_value();
+    });
+    future.wait();
+  }
+
+  // Connects a bearer of the client to a bearer of the server
+  void AddLink(bool enhanced, uint16_t mtu) {
+    links_.push_back(std::make_unique<WiredPairOfL2capQueues>(handler_));
+    auto* link = links_.back().get();
+    RunOnHandler([this, link, enhanced, mtu]() {
+      server_bearers_.push_back(std::make_unique<AttBearer>(link->GetQueueAUpEnd(), handler_, enhanced, mtu));
+      server_->AddBearer(server_bearers_.back().get());
+      client_bearers_.push_back(std::make_unique<AttBearer>(link->GetQueueBUpEnd(), handler_, enhanced, mtu));
+      client_.AddBearer(client_bearers_.back().get());
+    });
+  }
+
+  os::Thread* thread_;
+  os::Handler* handler_;
+  AttributeDatabase database_;
+  std::unique_ptr<GattServer> server_;
+  GattClient client_;
+  std::vector<std::unique_ptr<WiredPairOfL2capQueues>> links_;
+  std::vector<std::unique_ptr<AttBearer>> server_bearers_;
+  std::vector<std::unique_ptr<AttBearer>> client_bearers_;
+  uint16_t name_handle_;
+  uint16_t level_handle_;
+  uint16_t control_handle_;
+  Uuid custom_uuid_;
+};
+
+TEST_F(GattTest, discover_primary_services) {
+  AddLink(false, AttBearer::kDefaultMtu);
+  std::promise<std::vector<GattClient::Service>> promise;
+  auto future = promise.get_future();
+  RunOnHandler([this, &promise]() {
+    client_.DiscoverPrimaryServices(
+        common::BindOnce([](std::promise<std::vector<GattClient::Service>>* promise, AttErrorCode error,
+                            std::vector<GattClient::Service> services) {
+          EXPECT_EQ(error, AttErrorCode::SUCCESS);
+          promise->set_value(std::move(services));
+        }, &promise));
+  });
+  ASSERT_EQ(future.wait_for(kTimeout), std::future_status::ready);
+  auto services = future.get();
+  ASSERT_EQ(services.size(), 3u);
+  EXPECT_EQ(services[0].uuid, Uuid::From16Bit(0x1800));
+  EXPECT_EQ(services[0].handle, 1);
+  EXPECT_EQ(services[0].end_group_handle, name_handle_);
+  EXPECT_EQ(services[1].uuid, Uuid::From16Bit(0x180f));
+  // The battery level is followed by its Client Characteristic Configuration
+  EXPECT_EQ(services[1].end_group_handle, level_handle_ + 1);
+  EXPECT_EQ(services[2].uuid, custom_uuid_);
+  EXPECT_EQ(services[2].end_group_handle, database_.GetLastHandle());
+}
+
+TEST_F(GattTest, discover_characteristics) {
+  AddLink(false, AttBearer::kDefaultMtu);
+  std::promise<std::vector<GattClient::Characteristic>> promise;
+  auto future = promise.get_future();
+  RunOnHandler([this, &promise]() {
+    client_.DiscoverCharacteristics(
+        1, kMaxHandle,
+        common::BindOnce([](std::promise<std::vector<GattClient::Characteristic>>* promise, AttErrorCode error,
+                            std::vector<GattClient::Characteristic> characteristics) {
+          EXPECT_EQ(error, AttErrorCode::SUCCESS);
+          promise->set_value(std::move(characteristics));
+        }, &promise));
+  });
+  ASSERT_EQ(future.wait_for(kTimeout), std::future_status::ready);
+  auto characteristics = future.get();
+  ASSERT_EQ(characteristics.size(), 3u);
+  EXPECT_EQ(characteristics[0].value_handle, name_handle_);
+  EXPECT_EQ(characteristics[0].uuid, Uuid::From16Bit(0x2a00));
+  EXPECT_EQ(characteristics[1].value_handle, level_handle_);
+  EXPECT_EQ(characteristics[1].properties, kPropertyRead | kPropertyNotify);
+  EXPECT_EQ(characteristics[2].value_handle, control_handle_);
+}
+
+TEST_F(GattTest, read_and_write) {
+  AddLink(false, AttBearer::kDefaultMtu);
+  std::vector<uint8_t> written;
+  server_->SetWriteCallback(common::Bind(
+      [](std::vector<uint8_t>* written, uint16_t handle, AttBearer::Value value) { *written = ToVector(value); },
+      &written));
+
+  std::promise<std::vector<uint8_t>> read_promise;
+  auto read_future = read_promise.get_future();
+  std::promise<AttErrorCode> write_promise;
+  auto write_future = write_promise.get_future();
+  std::promise<AttErrorCode> denied_promise;
+  auto denied_future = denied_promise.get_future();
+  RunOnHandler([&]() {
+    client_.Read(name_handle_, common::BindOnce(
+                                   [](std::promise<std::vector<uint8_t>>* promise, AttErrorCode error,
+                                      AttBearer::Value value) {
+                                     EXPECT_EQ(error, AttErrorCode::SUCCESS);
+                                     promise->set_value(ToVector(value));
+                                   },
+                                   &read_promise));
+    client_.Write(control_handle_, {0x01, 0x02},
+                  common::BindOnce([](std::promise<AttErrorCode>* promise,
+                                      AttErrorCode error) { promise->set_value(error); },
+                                   &write_promise));
+    client_.Write(name_handle_, {0x01},
+                  common::BindOnce([](std::promise<AttErrorCode>* promise,
+                                      AttErrorCode error) { promise->set_value(error); },
+                                   &denied_promise));
+  });
+  ASSERT_EQ(read_future.wait_for(kTimeout), std::future_status::ready);
+  EXPECT_EQ(read_future.get(), std::vector<uint8_t>({'g', 'd'}));
+  ASSERT_EQ(write_future.wait_for(kTimeout), std::future_status::ready);
+  EXPECT_EQ(write_future.get(), AttErrorCode::SUCCESS);
+  ASSERT_EQ(denied_future.wait_for(kTimeout), std::future_status::ready);
+  EXPECT_EQ(denied_future.get(), AttErrorCode::WRITE_NOT_PERMITTED);
+  RunOnHandler([&]() {
+    EXPECT_EQ(written, std::vector<uint8_t>({0x01, 0x02}));
+    EXPECT_EQ(database_.Get(control_handle_)->value, std::vector<uint8_t>({0x01, 0x02}));
+  });
+}
+
+TEST_F(GattTest, requests_are_spread_over_bearers) {
+  AddLink(false, AttBearer::kDefaultMtu);
+  AddLink(true, 64);
+  std::promise<void> promise;
+  auto future = promise.get_future();
+  int remaining = 4;
+  RunOnHandler([&]() {
+    for (int i = 0; i < 4; i++) {
+      client_.Read(level_handle_, common::BindOnce(
+                                      [](int* remaining, std::promise<void>* promise, AttErrorCode error,
+                                         AttBearer::Value value) {
+                                        EXPECT_EQ(error, AttErrorCode::SUCCESS);
+                                        if (--*remaining == 0) promise->set_value();
+                                      },
+                                      &remaining, &promise));
+    }
+    EXPECT_EQ(client_bearers_[0]->GetPendingRequestCount(), 2u);
+    EXPECT_EQ(client_bearers_[1]->GetPendingRequestCount(), 2u);
+  });
+  ASSERT_EQ(future.wait_for(kTimeout), std::future_status::ready);
+}
+
+TEST_F(GattTest, mtu_exchange) {
+  AddLink(false, 100);
+  std::promise<void> promise;
+  auto future = promise.get_future();
+  RunOnHandler([&]() {
+    client_bearers_[0]->ExchangeMtu();
+    // Queued after the exchange, so answered after it
+    client_.Read(name_handle_,
+                 common::BindOnce([](std::promise<void>* promise, AttErrorCode error,
+                                     AttBearer::Value value) { promise->set_value(); },
+                                  &promise));
+  });
+  ASSERT_EQ(future.wait_for(kTimeout), std::future_status::ready);
+  RunOnHandler([this]() {
+    EXPECT_EQ(client_bearers_[0]->GetMtu(), 100);
+    EXPECT_EQ(server_bearers_[0]->GetMtu(), 100);
+  });
+}
+
+TEST_F(GattTest, indications_are_confirmed_in_order) {
+  AddLink(false, AttBearer::kDefaultMtu);
+  std::vector<uint8_t> indicated;
+  std::vector<int> confirmed;
+  std::promise<void> promise;
+  auto future = promise.get_future();
+  RunOnHandler([&]() {
+    client_.SetValueCallback(common::Bind(
+        [](std::vector<uint8_t>* indicated, uint16_t handle, AttBearer::Value value) {
+          indicated->push_back(value[0]);
+        },
+        &indicated));
+    for (int i = 0; i < 3; i++) {
+      server_bearers_[0]->SendIndication(
+          level_handle_, {static_cast<uint8_t>(i)},
+          common::BindOnce(
+              [](std::vector<int>* confirmed, std::promise<void>* promise, int i, bool success) {
+                EXPECT_TRUE(success);
+                confirmed->push_back(i);
+                if (confirmed->size() == 3) promise->set_value();
+              },
+              &confirmed, &promise, i));
+    }
+  });
+  ASSERT_EQ(future.wait_for(kTimeout), std::future_status::ready);
+  RunOnHandler([&]() {
+    EXPECT_EQ(indicated, std::vector<uint8_t>({0, 1, 2}));
+    EXPECT_EQ(confirmed, std::vector<int>({0, 1, 2}));
+  });
+}
+
+// A bearer whose lower end is read by the test, to look at the PDUs it sends
+class AttBearerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    thread_ = new os::Thread("test_thread", os::Thread::Priority::NORMAL);
+    handler_ = new os::Handler(thread_);
+    queue_ = std::make_unique<common::BidiQueue<AttBearer::Value, packet::BasePacketBuilder>>(10);
+    queue_->GetDownEnd()->RegisterDequeue(handler_,
+                                          common::Bind(&AttBearerTest::on_sent, common::Unretained(this)));
+  }
+
+  void TearDown() override {
+    std::promise<void> promise;
+    auto future = promise.get_future();
+    handler_->Post([this, &promise]() {
+      bearer_.reset();
+      queue_->GetDownEnd()->UnregisterDequeue();
+      promise.set_value();
+    });
+    future.wait();
+    handler_->Clear();
+    queue_.reset();
+    delete handler_;
+    delete thread_;
+  }
+
+  void on_sent() {
+    auto builder = queue_->GetDownEnd()->TryDequeue();
+    std::vector<uint8_t> bytes;
+    packet::BitInserter inserter(bytes);
+    builder->Serialize(inserter);
+    std::lock_guard<std::mutex> lock(mutex_);
+    sent_.push_back(bytes);
+    if (sent_.size() == expected_) {
+      promise_.set_value();
+    }
+  }
+
+  std::vector<std::vector<uint8_t>> Send(bool enhanced, uint16_t mtu, size_t expected,
+                                         std::vector<std::pair<uint16_t, std::vector<uint8_t>>> values) {
+    expected_ = expected;
+    auto future = promise_.get_future();
+    handler_->Post([this, enhanced, mtu, values]() {
+      bearer_ = std::make_unique<AttBearer>(queue_->GetUpEnd(), handler_, enhanced, mtu);
+      bearer_->SendNotifications(values);
+    });
+    EXPECT_EQ(future.wait_for(kTimeout), std::future_status::ready);
+    std::lock_guard<std::mutex> lock(mutex_);
+    return sent_;
+  }
+
+  os::Thread* thread_;
+  os::Handler* handler_;
+  std::unique_ptr<common::BidiQueue<AttBearer::Value, packet::BasePacketBuilder>> queue_;
+  std::unique_ptr<AttBearer> bearer_;
+  std::mutex mutex_;
+  std::vector<std::vector<uint8_t>> sent_;
+  size_t expected_ = 0;
+  std::promise<void> promise_;
+};
+
+TEST_F(AttBearerTest, notifications_are_batched_on_enhanced_bearers) {
+  // 1 + 3 * (4 + 4) octets fit in an MTU of 25, the fourth value goes alone
+  auto sent = Send(true, 25, 2, {{1, {1, 1, 1, 1}}, {2, {2, 2, 2, 2}}, {3, {3, 3, 3, 3}}, {4, {4, 4, 4, 4}}});
+  ASSERT_EQ(sent.size(), 2u);
+  EXPECT_EQ(sent[0],
+            std::vector<uint8_t>({0x23, 1, 0, 4, 0, 1, 1, 1, 1, 2, 0, 4, 0, 2, 2, 2, 2, 3, 0, 4, 0, 3, 3, 3, 3}));
+  EXPECT_EQ(sent[1], std::vector<uint8_t>({0x1b, 4, 0, 4, 4, 4, 4}));
+}
+
+TEST_F(AttBearerTest, notifications_are_not_batched_on_unenhanced_bearers) {
+  auto sent = Send(false, AttBearer::kDefaultMtu, 2, {{1, {1}}, {2, {2}}});
+  ASSERT_EQ(sent.size(), 2u);
+  EXPECT_EQ(sent[0], std::vector<uint8_t>({0x1b, 1, 0, 1}));
+  EXPECT_EQ(sent[1], std::vector<uint8_t>({0x1b, 2, 0, 2}));
+}
+
+TEST_F(AttBearerTest, long_values_are_truncated) {
+  auto sent = Send(true, 25, 1, {{1, std::vector<uint8_t>(30, 0xaa)}});
+  ASSERT_EQ(sent.size(), 1u);
+  EXPECT_EQ(sent[0].size(), 25u);
+  EXPECT_EQ(sent[0][0], 0x1b);
+}
+
+}  // namespace
+}  // namespace att
+}  // namespace bluetooth
@@ -0,0 +1,102 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace bluetooth {
+namespace att {
+
+// UUID of an attribute type, held as its 128 bit value in the byte order of the air (little endian), so that the
+// 16 bit form of a UUID built on the Bluetooth Base UUID compares equal to its 128 bit form.
+class Uuid {
+ public:
+  static constexpr size_t kNumBytes16 = 2;
+  static constexpr size_t kNumBytes128 = 16;
+
+  Uuid() = default;
+
+  static Uuid From16Bit(uint16_t uuid16) {
+    Uuid uuid;
+    uuid.bytes_ = kBaseUuid;
+    uuid.bytes_[kShortOffset] = uuid16 & 0xff;
+    uuid.bytes_[kShortOffset + 1] = uuid16 >> 8;
+    return uuid;
+  }
+
+  // Parses the 2 or 16 bytes of a UUID as sent on air. Returns false on any other length.
+  static bool FromBytes(const uint8_t* bytes, size_t length, Uuid* uuid) {
+    if (length == kNumBytes16) {
+      *uuid = From16Bit(bytes[0] | bytes[1] << 8);
+      return true;
+    }
+    if (length == kNumBytes128) {
+      std::copy(bytes, bytes + kNumBytes128, uuid->bytes_.begin());
+      return true;
+    }
+    return false;
+  }
+
+  static bool FromBytes(const std::vector<uint8_t>& bytes, Uuid* uuid) {
+    return FromBytes(bytes.data(), bytes.size(), uuid);
+  }
+
+  bool Is16Bit() const {
+    for (size_t i = 0; i < kNumBytes128; i++) {
+      if (i != kShortOffset && i != kShortOffset + 1 && bytes_[i] != kBaseUuid[i]) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  uint16_t As16Bit() const {
+    return bytes_[kShortOffset] | bytes_[kShortOffset + 1] << 8;
+  }
+
+  // Returns the shortest form of the UUID, as sent on air
+  std::vector<uint8_t> ToBytes() const {
+    if (Is16Bit()) {
+      return {bytes_[kShortOffset], bytes_[kShortOffset + 1]};
+    }
+    return std::vector<uint8_t>(bytes_.begin(), bytes_.end());
+  }
+
+  size_t GetShortestSize() const {
+    return Is16Bit() ? kNumBytes16 : kNumBytes128;
+  }
+
+  bool operator==(const Uuid& rhs) const {
+    return bytes_ == rhs.bytes_;
+  }
+  bool operator!=(const Uuid& rhs) const {
+    return !(*this == rhs);
+  }
+
+ private:
+  // 00000000-0000-1000-8000-00805F9B34FB
+  static constexpr std::array<uint8_t, kNumBytes128> kBaseUuid = {0xfb, 0x34, 0x9b, 0x5f, 0x80, 0x00, 0x00, 0x80,
+                                                                  0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+  static constexpr size_t kShortOffset = 12;
+
+  std::array<uint8_t, kNumBytes128> bytes_{};
+};
+
+}  // namespace att
+}  // namespace bluetooth
@@ -20,6 +20,7 @@
 #include <condition_variable>
 #include <mutex>
 #include <queue>
+#include <vector>
 
 namespace bluetooth {
 namespace common {
@@ -35,6 +36,19 @@ class BlockingQueue {
     }
   };
 
+  // Pushes |data| unless the queue already holds |capacity| elements. Returns true if |data| was pushed
+  bool try_push(T data, size_t capacity) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (queue_.size() >= capacity) {
+      return false;
+    }
+    queue_.push(std::move(data));
+    if (queue_.size() == 1) {
+      not_empty_.notify_all();
+    }
+    return true;
+  };
+
   T take() {
     std::unique_lock<std::mutex> lock(mutex_);
     while (queue_.empty()) {
@@ -45,6 +59,18 @@ class BlockingQueue {
     return data;
   };
 
+  // Takes every element in the queue under one lock, in order, without blocking
+  std::vector<T> take_all() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    std::vector<T> data;
+    data.reserve(queue_.size());
+    while (!queue_.empty()) {
+      data.push_back(std::move(queue_.front()));
+      queue_.pop();
+    }
+    return data;
+  };
+
   // Returns true if take() will not block within a time period
   bool wait_to_take(std::chrono::milliseconds time) {
     std::unique_lock<std::mutex> lock(mutex_);
@@ -61,6 +87,11 @@ class BlockingQueue {
     return queue_.empty();
   };
 
+  size_t size() const {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return queue_.size();
+  };
+
   void clear() {
     std::unique_lock<std::mutex> lock(mutex_);
     std::queue<T> empty;
@@ -78,6 +78,30 @@ TEST_F(BlockingQueueTest, clear_queue) {
   EXPECT_TRUE(queue_.empty());
 }
 
+TEST_F(BlockingQueueTest, try_push_bounded) {
+  EXPECT_TRUE(queue_.try_push(1, 2));
+  EXPECT_TRUE(queue_.try_push(2, 2));
+  EXPECT_FALSE(queue_.try_push(3, 2));
+  EXPECT_EQ(queue_.size(), 2u);
+  EXPECT_EQ(queue_.take(), 1);
+  EXPECT_TRUE(queue_.try_push(3, 2));
+  EXPECT_EQ(queue_.take(), 2);
+  EXPECT_EQ(queue_.take(), 3);
+}
+
+TEST_F(BlockingQueueTest, take_all) {
+  EXPECT_TRUE(queue_.take_all().empty());
+  for (int data = 0; data < 10; data++) {
+    queue_.push(data);
+  }
+  std::vector<int> all = queue_.take_all();
+  EXPECT_EQ(all.size(), 10u);
+  for (int data = 0; data < 10; data++) {
+    EXPECT_EQ(all[data], data);
+  }
+  EXPECT_TRUE(queue_.empty());
+}
+
 TEST_F(BlockingQueueTest, wait_for_non_empty) {
   int data = 1;
   std::thread waiter_thread([this, data] { EXPECT_EQ(queue_.take(), data); });
@@ -0,0 +1,175 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "common/callback.h"
+
+namespace bluetooth {
+namespace common {
+
+// A move-only closure that runs once, like OnceClosure, but that stores its callable inline instead of in a heap
+// allocated BindState. Callables up to kInlineSize bytes that can be moved without throwing, like a lambda capturing
+// |this| and a PacketView, are posted without any allocation; larger ones fall back to the heap.
+//
+// OnceClosure and Closure convert implicitly and only take the size of a pointer, so existing BindOnce() and Bind()
+// callers keep working.
+class InlineOnceClosure {
+ public:
+  static constexpr size_t kInlineSize = 56;
+
+  InlineOnceClosure() = default;
+
+  InlineOnceClosure(OnceClosure closure) : InlineOnceClosure(RunOnceClosure{std::move(closure)}) {}
+
+  InlineOnceClosure(const Closure& closure) : InlineOnceClosure(OnceClosure(closure)) {}
+
+  template <typename Functor, typename F = std::decay_t<Functor>,
+            typename = std::enable_if_t<!std::is_same<F, InlineOnceClosure>::value>,
+            typename = decltype(std::declval<F&>()())>
+  InlineOnceClosure(Functor&& functor) {
+    if constexpr (kStoredInline<F>) {
+      new (storage_) F(std::forward<Functor>(functor));
+      ops_ = &kInlineOps<F>;
+    } else {
+      *reinterpret_cast<F**>(storage_) = new F(std::forward<Functor>(functor));
+      ops_ = &kHeapOps<F>;
+    }
+  }
+
+  InlineOnceClosure(InlineOnceClosure&& other) noexcept {
+    MoveFrom(std::move(other));
+  }
+
+  InlineOnceClosure& operator=(InlineOnceClosure&& other) noexcept {
+    if (this != &other) {
+      Reset();
+      MoveFrom(std::move(other));
+    }
+    return *this;
+  }
+
+  InlineOnceClosure(const InlineOnceClosure&) = delete;
+  InlineOnceClosure& operator=(const InlineOnceClosure&) = delete;
+
+  ~InlineOnceClosure() {
+    Reset();
+  }
+
+  bool is_null() const {
+    return ops_ == nullptr;
+  }
+
+  explicit operator bool() const {
+    return !is_null();
+  }
+
+  // Runs the callable and releases it, the closure is then null
+  void Run() && {
+    const Ops* ops = ops_;
+    ops_ = nullptr;
+    ops->run_and_destroy(storage_);
+  }
+
+  void Reset() {
+    if (ops_ != nullptr) {
+      ops_->destroy(storage_);
+      ops_ = nullptr;
+    }
+  }
+
+ private:
+  struct RunOnceClosure {
+    OnceClosure closure;
+    void operator()() {
+      std::move(closure).Run();
+    }
+  };
+
+  struct Ops {
+    void (*run_and_destroy)(void* storage);
+    // Moves the callable of |from| to the empty storage |to|, and leaves |from| empty
+    void (*move)(void* from, void* to);
+    void (*destroy)(void* storage);
+  };
+
+  template <typename F>
+  static constexpr bool kStoredInline = sizeof(F) <= kInlineSize && alignof(F) <= alignof(std::max_align_t) &&
+                                        std::is_nothrow_move_constructible<F>::value;
+
+  template <typename F>
+  static void InlineRunAndDestroy(void* storage) {
+    F* f = static_cast<F*>(storage);
+    // Run from a local copy so the callable may release the closure holding it
+    F functor(std::move(*f));
+    f->~F();
+    functor();
+  }
+
+  template <typename F>
+  static void InlineMove(void* from, void* to) {
+    F* f = static_cast<F*>(from);
+    new (to) F(std::move(*f));
+    f->~F();
+  }
+
+  template <typename F>
+  static void InlineDestroy(void* storage) {
+    static_cast<F*>(storage)->~F();
+  }
+
+  template <typename F>
+  static void HeapRunAndDestroy(void* storage) {
+    F* f = *static_cast<F**>(storage);
+    (*f)();
+    delete f;
+  }
+
+  template <typename F>
+  static void HeapMove(void* from, void* to) {
+    *static_cast<F**>(to) = *static_cast<F**>(from);
+  }
+
+  template <typename F>
+  static void HeapDestroy(void* storage) {
+    delete *static_cast<F**>(storage);
+  }
+
+  template <typename F>
+  static constexpr Ops kInlineOps = {&InlineRunAndDestroy<F>, &InlineMove<F>, &InlineDestroy<F>};
+
+  template <typename F>
+  static constexpr Ops kHeapOps = {&HeapRunAndDestroy<F>, &HeapMove<F>, &HeapDestroy<F>};
+
+  void MoveFrom(InlineOnceClosure&& other) {
+    ops_ = other.ops_;
+    if (ops_ != nullptr) {
+      ops_->move(other.storage_, storage_);
+      other.ops_ = nullptr;
+    }
+  }
+
+  alignas(std::max_align_t) unsigned char storage_[kInlineSize];
+  const Ops* ops_ = nullptr;
+};
+
+}  // namespace common
+}  // namespace bluetooth
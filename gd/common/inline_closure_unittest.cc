@@ -0,0 +1,107 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "common/inline_closure.h"
+
+#include <array>
+#include <memory>
+
+#include <gtest/gtest.h>
+
+#include "common/bind.h"
+
+namespace bluetooth {
+namespace common {
+namespace {
+
+void add(int* sum, int value) {
+  *sum += value;
+}
+
+TEST(InlineOnceClosureTest, default_is_null) {
+  InlineOnceClosure closure;
+  EXPECT_TRUE(closure.is_null());
+  EXPECT_FALSE(closure);
+}
+
+TEST(InlineOnceClosureTest, run_lambda) {
+  int sum = 0;
+  InlineOnceClosure closure([&sum]() { sum++; });
+  EXPECT_FALSE(closure.is_null());
+  std::move(closure).Run();
+  EXPECT_EQ(sum, 1);
+  EXPECT_TRUE(closure.is_null());
+}
+
+TEST(InlineOnceClosureTest, run_move_only_lambda) {
+  int sum = 0;
+  auto value = std::make_unique<int>(5);
+  InlineOnceClosure closure([&sum, value = std::move(value)]() { sum += *value; });
+  std::move(closure).Run();
+  EXPECT_EQ(sum, 5);
+}
+
+TEST(InlineOnceClosureTest, run_large_lambda) {
+  int sum = 0;
+  std::array<int, 32> values{};
+  values[31] = 7;
+  static_assert(sizeof(values) > InlineOnceClosure::kInlineSize, "The lambda must not fit inline");
+  InlineOnceClosure closure([&sum, values]() { sum += values[31]; });
+  InlineOnceClosure moved(std::move(closure));
+  EXPECT_TRUE(closure.is_null());
+  std::move(moved).Run();
+  EXPECT_EQ(sum, 7);
+}
+
+TEST(InlineOnceClosureTest, run_once_closure) {
+  int sum = 0;
+  InlineOnceClosure closure(BindOnce(&add, Unretained(&sum), 2));
+  std::move(closure).Run();
+  EXPECT_EQ(sum, 2);
+}
+
+TEST(InlineOnceClosureTest, run_closure) {
+  int sum = 0;
+  Closure repeating = Bind(&add, Unretained(&sum), 3);
+  InlineOnceClosure closure(repeating);
+  std::move(closure).Run();
+  repeating.Run();
+  EXPECT_EQ(sum, 6);
+}
+
+TEST(InlineOnceClosureTest, move_assign_releases_previous_callable) {
+  auto first = std::make_shared<int>(0);
+  int sum = 0;
+  InlineOnceClosure closure([first]() {});
+  EXPECT_EQ(first.use_count(), 2);
+  closure = InlineOnceClosure([&sum]() { sum++; });
+  EXPECT_EQ(first.use_count(), 1);
+  std::move(closure).Run();
+  EXPECT_EQ(sum, 1);
+}
+
+TEST(InlineOnceClosureTest, reset_releases_callable) {
+  auto value = std::make_shared<int>(0);
+  InlineOnceClosure closure([value]() {});
+  EXPECT_EQ(value.use_count(), 2);
+  closure.Reset();
+  EXPECT_TRUE(closure.is_null());
+  EXPECT_EQ(value.use_count(), 1);
+}
+
+}  // namespace
+}  // namespace common
+}  // namespace bluetooth
@@ -0,0 +1,211 @@
+/******************************************************************************
+ *
+ *  Copyright 2020 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This file contains the AES-128 block encryption backends: x86 AES-NI,
+ *  ARMv8 Crypto Extensions, and the portable table based implementation.
+ *
+ *  The hardware backends expand the key on the fly, one round key per round,
+ *  so that every block can use its own key without storing a key schedule.
+ *
+ ******************************************************************************/
+
+#include "crypto_toolbox/aes_hw.h"
+#include "crypto_toolbox/aes.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define AES_HW_X86
+#include <wmmintrin.h>
+#elif defined(__aarch64__) &&                                                  \
+    (defined(__ARM_FEATURE_AES) || defined(__ARM_FEATURE_CRYPTO))
+#define AES_HW_ARM
+#include <arm_neon.h>
+#include <sys/auxv.h>
+#ifndef HWCAP_AES
+#define HWCAP_AES (1 << 3)
+#endif
+#endif
+
+namespace bluetooth {
+namespace crypto_toolbox {
+
+namespace {
+
+/* Number of blocks processed together by the hardware backends */
+constexpr size_t AES_HW_LANES = 4;
+
+typedef void (*aes_blocks_fn)(const uint8_t* keys, const uint8_t* in,
+                              uint8_t* out, size_t count);
+
+void aes_128_encrypt_blocks_sw(const uint8_t* keys, const uint8_t* in,
+                               uint8_t* out, size_t count) {
+  aes_context ctx;
+  for (size_t i = 0; i < count; i++) {
+    aes_set_key(keys + i * N_BLOCK, N_BLOCK, &ctx);
+    aes_encrypt(in + i * N_BLOCK, out + i * N_BLOCK, &ctx);
+  }
+}
+
+#if defined(AES_HW_X86)
+
+#define AES_NI_TARGET __attribute__((target("aes,sse2")))
+
+/* Derives the next round key from |key| and the output of aeskeygenassist */
+AES_NI_TARGET inline __m128i aes_ni_next_key(__m128i key, __m128i assist) {
+  assist = _mm_shuffle_epi32(assist, _MM_SHUFFLE(3, 3, 3, 3));
+  key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+  key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+  key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+  return _mm_xor_si128(key, assist);
+}
+
+/* The round constant of aeskeygenassist must be an immediate */
+#define AES_NI_ROUND(rcon, op)                                                 \
+  for (size_t j = 0; j < n; j++) {                                             \
+    k[j] = aes_ni_next_key(k[j], _mm_aeskeygenassist_si128(k[j], rcon));       \
+    s[j] = op(s[j], k[j]);                                                     \
+  }
+
+AES_NI_TARGET void aes_128_encrypt_blocks_ni(const uint8_t* keys,
+                                             const uint8_t* in, uint8_t* out,
+                                             size_t count) {
+  __m128i k[AES_HW_LANES];
+  __m128i s[AES_HW_LANES];
+  for (size_t i = 0; i < count; i += AES_HW_LANES) {
+    size_t n = count - i < AES_HW_LANES ? count - i : AES_HW_LANES;
+    for (size_t j = 0; j < n; j++) {
+      k[j] = _mm_loadu_si128((const __m128i*)(keys + (i + j) * N_BLOCK));
+      s[j] = _mm_xor_si128(
+          _mm_loadu_si128((const __m128i*)(in + (i + j) * N_BLOCK)), k[j]);
+    }
+    AES_NI_ROUND(0x01, _mm_aesenc_si128);
+    AES_NI_ROUND(0x02, _mm_aesenc_si128);
+    AES_NI_ROUND(0x04, _mm_aesenc_si128);
+    AES_NI_ROUND(0x08, _mm_aesenc_si128);
+    AES_NI_ROUND(0x10, _mm_aesenc_si128);
+    AES_NI_ROUND(0x20, _mm_aesenc_si128);
+    AES_NI_ROUND(0x40, _mm_aesenc_si128);
+    AES_NI_ROUND(0x80, _mm_aesenc_si128);
+    AES_NI_ROUND(0x1b, _mm_aesenc_si128);
+    AES_NI_ROUND(0x36, _mm_aesenclast_si128);
+    for (size_t j = 0; j < n; j++) {
+      _mm_storeu_si128((__m128i*)(out + (i + j) * N_BLOCK), s[j]);
+    }
+  }
+}
+
+#undef AES_NI_ROUND
+
+aes_blocks_fn aes_128_select_backend(const char** name) {
+  if (__builtin_cpu_supports("aes")) {
+    *name = "aes-ni";
+    return aes_128_encrypt_blocks_ni;
+  }
+  *name = "table";
+  return aes_128_encrypt_blocks_sw;
+}
+
+#elif defined(AES_HW_ARM)
+
+const uint8_t aes_rcon[10] = {0x01, 0x02, 0x04, 0x08, 0x10,
+                              0x20, 0x40, 0x80, 0x1b, 0x36};
+
+/* Derives the next round key from |key| and the round constant |rcon| */
+inline uint8x16_t aes_ce_next_key(uint8x16_t key, uint8_t rcon) {
+  /* With the last word of the key in every column, ShiftRows leaves the state
+   * unchanged and AESE with a zero round key only applies SubBytes */
+  uint32_t w = vgetq_lane_u32(vreinterpretq_u32_u8(key), 3);
+  uint8x16_t sub = vaeseq_u8(vreinterpretq_u8_u32(vdupq_n_u32(w)),
+                             vdupq_n_u8(0));
+  w = vgetq_lane_u32(vreinterpretq_u32_u8(sub), 0);
+  w = ((w >> 8) | (w << 24)) ^ rcon; /* RotWord */
+
+  uint8x16_t zero = vdupq_n_u8(0);
+  key = veorq_u8(key, vextq_u8(zero, key, 12));
+  key = veorq_u8(key, vextq_u8(zero, key, 12));
+  key = veorq_u8(key, vextq_u8(zero, key, 12));
+  return veorq_u8(key, vreinterpretq_u8_u32(vdupq_n_u32(w)));
+}
+
+void aes_128_encrypt_blocks_ce(const uint8_t* keys, const uint8_t* in,
+                               uint8_t* out, size_t count) {
+  uint8x16_t k[AES_HW_LANES];
+  uint8x16_t s[AES_HW_LANES];
+  for (size_t i = 0; i < count; i += AES_HW_LANES) {
+    size_t n = count - i < AES_HW_LANES ? count - i : AES_HW_LANES;
+    for (size_t j = 0; j < n; j++) {
+      k[j] = vld1q_u8(keys + (i + j) * N_BLOCK);
+      s[j] = vld1q_u8(in + (i + j) * N_BLOCK);
+    }
+    /* AESE adds the round key before SubBytes and ShiftRows, so the last
+     * round key is added separately */
+    for (size_t round = 0; round < 9; round++) {
+      for (size_t j = 0; j < n; j++) {
+        s[j] = vaesmcq_u8(vaeseq_u8(s[j], k[j]));
+        k[j] = aes_ce_next_key(k[j], aes_rcon[round]);
+      }
+    }
+    for (size_t j = 0; j < n; j++) {
+      s[j] = vaeseq_u8(s[j], k[j]);
+      k[j] = aes_ce_next_key(k[j], aes_rcon[9]);
+      vst1q_u8(out + (i + j) * N_BLOCK, veorq_u8(s[j], k[j]));
+    }
+  }
+}
+
+aes_blocks_fn aes_128_select_backend(const char** name) {
+  if (getauxval(AT_HWCAP) & HWCAP_AES) {
+    *name = "armv8-ce";
+    return aes_128_encrypt_blocks_ce;
+  }
+  *name = "table";
+  return aes_128_encrypt_blocks_sw;
+}
+
+#else
+
+aes_blocks_fn aes_128_select_backend(const char** name) {
+  *name = "table";
+  return aes_128_encrypt_blocks_sw;
+}
+
+#endif
+
+struct AesBackend {
+  AesBackend() { encrypt_blocks = aes_128_select_backend(&name); }
+  aes_blocks_fn encrypt_blocks;
+  const char* name;
+};
+
+const AesBackend& aes_128_backend() {
+  static const AesBackend backend;
+  return backend;
+}
+
+}  // namespace
+
+void aes_128_encrypt_blocks(const uint8_t* keys, const uint8_t* in,
+                            uint8_t* out, size_t count) {
+  aes_128_backend().encrypt_blocks(keys, in, out, count);
+}
+
+const char* aes_128_backend_name() { return aes_128_backend().name; }
+
+}  // namespace crypto_toolbox
+}  // namespace bluetooth
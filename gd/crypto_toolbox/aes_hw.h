@@ -0,0 +1,42 @@
+/******************************************************************************
+ *
+ *  Copyright 2020 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace bluetooth {
+namespace crypto_toolbox {
+
+/* Encrypts |count| independent blocks with AES-128: block |i| of |in| is
+ * encrypted with key |i| of |keys| into block |i| of |out|. Each argument
+ * points to |count| consecutive 16 byte blocks in FIPS-197 byte order, like
+ * aes_encrypt(). |in| and |out| may be the same buffer.
+ *
+ * The AES instructions of the CPU are used when available, and the table
+ * based aes_encrypt() otherwise. Blocks are processed several at a time so
+ * that the rounds of independent blocks overlap in the CPU pipeline. */
+void aes_128_encrypt_blocks(const uint8_t* keys, const uint8_t* in,
+                            uint8_t* out, size_t count);
+
+/* Returns the name of the backend used by aes_128_encrypt_blocks() */
+const char* aes_128_backend_name();
+
+}  // namespace crypto_toolbox
+}  // namespace bluetooth
@@ -29,6 +29,7 @@ Octet16 c1(const Octet16& k, const Octet16& r, const uint8_t* pres, const uint8_
 Octet16 s1(const Octet16& k, const Octet16& r1, const Octet16& r2);
 
 extern Octet16 aes_128(const Octet16& key, const Octet16& message);
+extern void aes_128_multi(const Octet16* keys, const Octet16* messages, Octet16* outputs, size_t count);
 extern Octet16 aes_cmac(const Octet16& key, const uint8_t* message, uint16_t length);
 extern Octet16 f4(uint8_t* u, uint8_t* v, const Octet16& x, uint8_t z);
 extern void f5(uint8_t* w, const Octet16& n1, const Octet16& n2, uint8_t* a1, uint8_t* a2, Octet16* mac_key,
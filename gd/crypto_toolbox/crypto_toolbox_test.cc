@@ -19,6 +19,7 @@
 #include <gtest/gtest.h>
 
 #include "crypto_toolbox/aes.h"
+#include "crypto_toolbox/aes_hw.h"
 #include "crypto_toolbox/crypto_toolbox.h"
 
 #include <vector>
@@ -351,5 +352,67 @@ TEST(CryptoToolboxTest, bt_spec_example_d_12_test) {
   EXPECT_EQ(expected_ltk, ltk);
 }
 
+// FIPS-197 Appendix C.1
+TEST(CryptoToolboxTest, aes_128_encrypt_blocks_fips_197_test) {
+  uint8_t k[] = {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f};
+
+  uint8_t m[] = {0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff};
+
+  uint8_t expected[] = {0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30, 0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a};
+
+  uint8_t output[16];
+  aes_128_encrypt_blocks(k, m, output, 1);
+  EXPECT_TRUE(memcmp(output, expected, OCTET16_LEN) == 0) << "backend " << aes_128_backend_name();
+}
+
+// Every block of a multi block call uses its own key, whatever the number of
+// blocks, and matches the table based implementation
+TEST(CryptoToolboxTest, aes_128_encrypt_blocks_test) {
+  constexpr size_t count = 13;
+  std::vector<uint8_t> keys(count * OCTET16_LEN);
+  std::vector<uint8_t> in(count * OCTET16_LEN);
+  for (size_t i = 0; i < keys.size(); i++) {
+    keys[i] = i * 7 + 3;
+    in[i] = i * 13 + 5;
+  }
+
+  for (size_t n = 0; n <= count; n++) {
+    std::vector<uint8_t> out(count * OCTET16_LEN, 0);
+    aes_128_encrypt_blocks(keys.data(), in.data(), out.data(), n);
+    for (size_t i = 0; i < count; i++) {
+      uint8_t expected[OCTET16_LEN] = {0};
+      if (i < n) {
+        aes_context ctx;
+        aes_set_key(&keys[i * OCTET16_LEN], OCTET16_LEN, &ctx);
+        aes_encrypt(&in[i * OCTET16_LEN], expected, &ctx);
+      }
+      EXPECT_TRUE(memcmp(&out[i * OCTET16_LEN], expected, OCTET16_LEN) == 0) << "block " << i << " of " << n;
+    }
+  }
+}
+
+// aes_128_multi() gives the same results as as many aes_128() calls
+TEST(CryptoToolboxTest, aes_128_multi_test) {
+  constexpr size_t count = 37;
+  std::vector<Octet16> keys(count);
+  std::vector<Octet16> messages(count);
+  for (size_t i = 0; i < count; i++) {
+    for (size_t j = 0; j < OCTET16_LEN; j++) {
+      keys[i][j] = i * 31 + j;
+      messages[i][j] = i ^ (j * 17);
+    }
+  }
+
+  std::vector<Octet16> outputs(count);
+  aes_128_multi(keys.data(), messages.data(), outputs.data(), count);
+  for (size_t i = 0; i < count; i++) {
+    EXPECT_EQ(outputs[i], aes_128(keys[i], messages[i])) << "block " << i;
+  }
+
+  // In place
+  aes_128_multi(keys.data(), messages.data(), messages.data(), count);
+  EXPECT_EQ(outputs, messages);
+}
+
 }  // namespace crypto_toolbox
 }  // namespace bluetooth
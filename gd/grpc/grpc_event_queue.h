@@ -18,9 +18,11 @@
 
 #include <grpc++/grpc++.h>
 
+#include <algorithm>
 #include <atomic>
 #include <chrono>
 #include <utility>
+#include <vector>
 
 #include "common/blocking_queue.h"
 #include "facade/common.pb.h"
@@ -32,11 +34,19 @@ namespace grpc {
 template <typename T>
 class GrpcEventQueue {
  public:
+  /**
+   * Default bound on the events waiting to be streamed. Events arriving while the queue is full are dropped and
+   * counted, so a flood of events can't make the DUT run out of memory while the client falls behind.
+   */
+  static constexpr size_t kDefaultMaxPendingEvents = 4096;
+
   /**
    * Create a GrpcEventQueue that can be used to shuffle event from one thread to another
    * @param log_name
+   * @param max_pending_events maximum number of events waiting to be streamed
    */
-  explicit GrpcEventQueue(std::string log_name) : log_name_(std::move(log_name)){};
+  explicit GrpcEventQueue(std::string log_name, size_t max_pending_events = kDefaultMaxPendingEvents)
+      : log_name_(std::move(log_name)), max_pending_events_(max_pending_events){};
 
   /**
    * Run the event loop and blocks until client cancels the stream request
@@ -50,17 +60,71 @@ class GrpcEventQueue {
   ::grpc::Status RunLoop(::grpc::ServerContext* context, ::grpc::ServerWriter<T>* writer) {
     using namespace std::chrono_literals;
     LOG_INFO("%s: Entering Loop", log_name_.c_str());
-    pending_events_.clear();
-    running_ = true;
+    StartLoop();
     while (!context->IsCancelled()) {
       // Wait for 500 ms so that cancellation can be caught in amortized 250 ms latency
-      if (pending_events_.wait_to_take(500ms)) {
-        LOG_DEBUG("%s: Got event after queue", log_name_.c_str());
-        writer->Write(pending_events_.take());
+      if (!pending_events_.wait_to_take(500ms)) {
+        continue;
+      }
+      // Stream everything pending at once; all but the last write are only buffered, so a burst of events goes out
+      // in as few transport writes as possible
+      std::vector<T> events = pending_events_.take_all();
+      LOG_DEBUG("%s: Got %zu events after queue", log_name_.c_str(), events.size());
+      for (size_t i = 0; i < events.size(); i++) {
+        ::grpc::WriteOptions options;
+        if (i + 1 < events.size()) {
+          options.set_buffer_hint();
+        }
+        if (!writer->Write(events[i], options)) {
+          LOG_WARN("%s: Stream closed, %zu events not delivered", log_name_.c_str(), events.size() - i);
+          break;
+        }
       }
     }
-    running_ = false;
-    LOG_INFO("%s: Exited Loop", log_name_.c_str());
+    StopLoop();
+    return ::grpc::Status::OK;
+  }
+
+  /**
+   * Same as RunLoop, but streams the pending events in batches, up to |max_batch_size| events per message. This
+   * saves the per-message cost of gRPC for high rate events.
+   *
+   * @tparam Batch message type with a repeated field of T named events
+   * @param context client context
+   * @param writer output writer
+   * @param max_batch_size maximum number of events per message
+   * @return gRPC status
+   */
+  template <typename Batch>
+  ::grpc::Status RunBatchLoop(
+      ::grpc::ServerContext* context, ::grpc::ServerWriter<Batch>* writer, size_t max_batch_size) {
+    using namespace std::chrono_literals;
+    ASSERT(max_batch_size > 0);
+    LOG_INFO("%s: Entering batch Loop", log_name_.c_str());
+    StartLoop();
+    while (!context->IsCancelled()) {
+      if (!pending_events_.wait_to_take(500ms)) {
+        continue;
+      }
+      std::vector<T> events = pending_events_.take_all();
+      LOG_DEBUG("%s: Got %zu events after queue", log_name_.c_str(), events.size());
+      for (size_t start = 0; start < events.size(); start += max_batch_size) {
+        size_t end = std::min(events.size(), start + max_batch_size);
+        Batch batch;
+        for (size_t i = start; i < end; i++) {
+          *batch.add_events() = std::move(events[i]);
+        }
+        ::grpc::WriteOptions options;
+        if (end < events.size()) {
+          options.set_buffer_hint();
+        }
+        if (!writer->Write(batch, options)) {
+          LOG_WARN("%s: Stream closed, %zu events not delivered", log_name_.c_str(), events.size() - start);
+          break;
+        }
+      }
+    }
+    StopLoop();
     return ::grpc::Status::OK;
   }
 
@@ -74,12 +138,39 @@ class GrpcEventQueue {
       return;
     }
     LOG_DEBUG("%s: Got event before queue", log_name_.c_str());
-    pending_events_.push(std::move(event));
+    if (!pending_events_.try_push(std::move(event), max_pending_events_)) {
+      if (dropped_events_++ == 0) {
+        LOG_WARN("%s: Queue full with %zu events, dropping events", log_name_.c_str(), max_pending_events_);
+      }
+    }
+  }
+
+  /**
+   * @return the number of events dropped because the queue was full, since the current or last loop started
+   */
+  size_t GetDroppedEventCount() const {
+    return dropped_events_;
   }
 
  private:
+  void StartLoop() {
+    pending_events_.clear();
+    dropped_events_ = 0;
+    running_ = true;
+  }
+
+  void StopLoop() {
+    running_ = false;
+    if (dropped_events_ > 0) {
+      LOG_WARN("%s: Dropped %zu events", log_name_.c_str(), dropped_events_.load());
+    }
+    LOG_INFO("%s: Exited Loop", log_name_.c_str());
+  }
+
   std::string log_name_;
+  size_t max_pending_events_;
   std::atomic<bool> running_ = false;
+  std::atomic<size_t> dropped_events_ = 0;
   common::BlockingQueue<T> pending_events_;
 };
 
@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <utility>
 #include <vector>
 
 #include "module.h"
@@ -83,6 +84,14 @@ class HciHal : public ::bluetooth::Module {
   // Packets must be processed in order.
   virtual void sendAclData(HciPacket data) = 0;
 
+  // Send several HCI ACL data packets to the Bluetooth controller, in order. Transports that can write several
+  // packets at once override this, by default each packet is sent with sendAclData().
+  virtual void sendAclDataBatch(std::vector<HciPacket> packets) {
+    for (auto& packet : packets) {
+      sendAclData(std::move(packet));
+    }
+  }
+
   // Send an SCO data packet (as specified in the Bluetooth Specification
   // V4.2, Vol 2, Part 5, Section 5.4.3) to the Bluetooth controller.
   // Packets must be processed in order.
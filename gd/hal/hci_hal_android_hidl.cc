@@ -74,6 +74,8 @@ class InternalHciCallbacks : public IBluetoothHciCallbacks {
     return Void();
   }
 
+  // The HIDL buffer belongs to the transaction and is released when the callback returns, so it is copied once, into
+  // the vector which is moved all the way into the storage of the PacketView built by the HCI layer.
   Return<void> hciEventReceived(const hidl_vec<uint8_t>& event) {
     std::vector<uint8_t> received_hci_packet(event.begin(), event.end());
     btsnoop_logger_->capture(received_hci_packet, SnoopLogger::Direction::INCOMING,
@@ -114,6 +116,14 @@ class InternalHciCallbacks : public IBluetoothHciCallbacks {
 
 const std::string SnoopLogger::DefaultFilePath = "/data/misc/bluetooth/logs/btsnoop_hci.log";
 const bool SnoopLogger::AlwaysFlush = false;
+// Keep disk I/O off the HIDL callback thread, and rotate the log like the legacy stack does
+const SnoopLogger::AsyncOptions SnoopLogger::DefaultAsyncOptions = {
+    .enabled = true,
+    .ring_size = 1024,
+    .max_file_size = 0,
+    .max_packets_per_file = 0xffff,
+    .compress_rotated_files = false,
+};
 
 class HciHalHidl : public HciHal {
  public:
@@ -127,17 +137,34 @@ class HciHalHidl : public HciHal {
 
   void sendHciCommand(HciPacket command) override {
     btsnoop_logger_->capture(command, SnoopLogger::Direction::OUTGOING, SnoopLogger::PacketType::CMD);
-    bt_hci_->sendHciCommand(command);
+    hidl_vec<uint8_t> data;
+    data.setToExternal(command.data(), command.size());
+    bt_hci_->sendHciCommand(data);
   }
 
   void sendAclData(HciPacket packet) override {
     btsnoop_logger_->capture(packet, SnoopLogger::Direction::OUTGOING, SnoopLogger::PacketType::ACL);
-    bt_hci_->sendAclData(packet);
+    // The HAL copies the data into its transaction, no need for an intermediate copy
+    hidl_vec<uint8_t> data;
+    data.setToExternal(packet.data(), packet.size());
+    bt_hci_->sendAclData(data);
+  }
+
+  void sendAclDataBatch(std::vector<HciPacket> packets) override {
+    // IBluetoothHci 1.0 has no batch call, only the snoop log is written once for the batch
+    btsnoop_logger_->capture(packets, SnoopLogger::Direction::OUTGOING, SnoopLogger::PacketType::ACL);
+    for (auto& packet : packets) {
+      hidl_vec<uint8_t> data;
+      data.setToExternal(packet.data(), packet.size());
+      bt_hci_->sendAclData(data);
+    }
   }
 
   void sendScoData(HciPacket packet) override {
     btsnoop_logger_->capture(packet, SnoopLogger::Direction::OUTGOING, SnoopLogger::PacketType::SCO);
-    bt_hci_->sendScoData(packet);
+    hidl_vec<uint8_t> data;
+    data.setToExternal(packet.data(), packet.size());
+    bt_hci_->sendScoData(data);
   }
 
  protected:
@@ -20,6 +20,7 @@
 #include <netdb.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #include <chrono>
 #include <csignal>
@@ -39,6 +40,8 @@ constexpr uint8_t kH4Acl = 0x02;
 constexpr uint8_t kH4Sco = 0x03;
 constexpr uint8_t kH4Event = 0x04;
 
+constexpr size_t kMaxPacketsPerWrite = 16;
+
 constexpr uint8_t kH4HeaderSize = 1;
 constexpr uint8_t kHciAclHeaderSize = 4;
 constexpr uint8_t kHciScoHeaderSize = 3;
@@ -89,6 +92,7 @@ namespace hal {
 
 const std::string SnoopLogger::DefaultFilePath = "/tmp/btsnoop_hci.log";
 const bool SnoopLogger::AlwaysFlush = true;
+const SnoopLogger::AsyncOptions SnoopLogger::DefaultAsyncOptions = {};
 
 class HciHalHostRootcanal : public HciHal {
  public:
@@ -116,28 +120,31 @@ class HciHalHostRootcanal : public HciHal {
   void sendHciCommand(HciPacket command) override {
     std::lock_guard<std::mutex> lock(api_mutex_);
     ASSERT(sock_fd_ != INVALID_FD);
-    std::vector<uint8_t> packet = std::move(command);
-    btsnoop_logger_->capture(packet, SnoopLogger::Direction::OUTGOING, SnoopLogger::PacketType::CMD);
-    packet.insert(packet.cbegin(), kH4Command);
-    write_to_rootcanal_fd(packet);
+    btsnoop_logger_->capture(command, SnoopLogger::Direction::OUTGOING, SnoopLogger::PacketType::CMD);
+    write_to_rootcanal_fd(kH4Command, std::move(command));
   }
 
   void sendAclData(HciPacket data) override {
     std::lock_guard<std::mutex> lock(api_mutex_);
     ASSERT(sock_fd_ != INVALID_FD);
-    std::vector<uint8_t> packet = std::move(data);
-    btsnoop_logger_->capture(packet, SnoopLogger::Direction::OUTGOING, SnoopLogger::PacketType::ACL);
-    packet.insert(packet.cbegin(), kH4Acl);
-    write_to_rootcanal_fd(packet);
+    btsnoop_logger_->capture(data, SnoopLogger::Direction::OUTGOING, SnoopLogger::PacketType::ACL);
+    write_to_rootcanal_fd(kH4Acl, std::move(data));
+  }
+
+  void sendAclDataBatch(std::vector<HciPacket> packets) override {
+    std::lock_guard<std::mutex> lock(api_mutex_);
+    ASSERT(sock_fd_ != INVALID_FD);
+    btsnoop_logger_->capture(packets, SnoopLogger::Direction::OUTGOING, SnoopLogger::PacketType::ACL);
+    for (auto& packet : packets) {
+      write_to_rootcanal_fd(kH4Acl, std::move(packet));
+    }
   }
 
   void sendScoData(HciPacket data) override {
     std::lock_guard<std::mutex> lock(api_mutex_);
     ASSERT(sock_fd_ != INVALID_FD);
-    std::vector<uint8_t> packet = std::move(data);
-    btsnoop_logger_->capture(packet, SnoopLogger::Direction::OUTGOING, SnoopLogger::PacketType::SCO);
-    packet.insert(packet.cbegin(), kH4Sco);
-    write_to_rootcanal_fd(packet);
+    btsnoop_logger_->capture(data, SnoopLogger::Direction::OUTGOING, SnoopLogger::PacketType::SCO);
+    write_to_rootcanal_fd(kH4Sco, std::move(data));
   }
 
  protected:
@@ -188,12 +195,17 @@ class HciHalHostRootcanal : public HciHal {
   bluetooth::os::Thread hci_incoming_thread_ =
       bluetooth::os::Thread("hci_incoming_thread", bluetooth::os::Thread::Priority::NORMAL);
   bluetooth::os::Reactor::Reactable* reactable_ = nullptr;
-  std::queue<std::vector<uint8_t>> hci_outgoing_queue_;
+  // The H4 type byte goes out with its packet in the same writev(), it is never copied in front of the packet
+  struct OutgoingPacket {
+    uint8_t type;
+    HciPacket packet;
+  };
+  std::queue<OutgoingPacket> hci_outgoing_queue_;
   SnoopLogger* btsnoop_logger_ = nullptr;
 
-  void write_to_rootcanal_fd(HciPacket packet) {
+  void write_to_rootcanal_fd(uint8_t type, HciPacket packet) {
     // TODO: replace this with new queue when it's ready
-    hci_outgoing_queue_.emplace(packet);
+    hci_outgoing_queue_.push(OutgoingPacket{type, std::move(packet)});
     if (hci_outgoing_queue_.size() == 1) {
       hci_incoming_thread_.GetReactor()->ModifyRegistration(
           reactable_, common::Bind(&HciHalHostRootcanal::incoming_packet_received, common::Unretained(this)),
@@ -201,14 +213,53 @@ class HciHalHostRootcanal : public HciHal {
     }
   }
 
+  // Writes all of the queued packets, up to kMaxPacketsPerWrite, with a single writev()
   void send_packet_ready() {
     std::lock_guard<std::mutex> lock(this->api_mutex_);
-    auto packet_to_send = this->hci_outgoing_queue_.front();
-    auto bytes_written = write(this->sock_fd_, (void*)packet_to_send.data(), packet_to_send.size());
-    this->hci_outgoing_queue_.pop();
+    struct iovec iov[2 * kMaxPacketsPerWrite];
+    size_t num_packets = 0;
+    size_t total_size = 0;
+    std::queue<OutgoingPacket> written;
+    while (!hci_outgoing_queue_.empty() && num_packets < kMaxPacketsPerWrite) {
+      written.push(std::move(hci_outgoing_queue_.front()));
+      hci_outgoing_queue_.pop();
+      OutgoingPacket& outgoing = written.back();
+      iov[2 * num_packets].iov_base = &outgoing.type;
+      iov[2 * num_packets].iov_len = sizeof(outgoing.type);
+      iov[2 * num_packets + 1].iov_base = outgoing.packet.data();
+      iov[2 * num_packets + 1].iov_len = outgoing.packet.size();
+      total_size += sizeof(outgoing.type) + outgoing.packet.size();
+      num_packets++;
+    }
+
+    ssize_t bytes_written;
+    RUN_NO_INTR(bytes_written = writev(this->sock_fd_, iov, 2 * num_packets));
     if (bytes_written == -1) {
       abort();
     }
+    // The socket is blocking, finish a short write before handing the socket back to the reactor
+    size_t done = bytes_written;
+    for (size_t i = 0; i < 2 * num_packets && done < total_size; i++) {
+      if (done >= iov[i].iov_len) {
+        done -= iov[i].iov_len;
+        total_size -= iov[i].iov_len;
+        continue;
+      }
+      const uint8_t* remaining = static_cast<const uint8_t*>(iov[i].iov_base) + done;
+      size_t remaining_size = iov[i].iov_len - done;
+      total_size -= iov[i].iov_len;
+      done = 0;
+      while (remaining_size > 0) {
+        ssize_t result;
+        RUN_NO_INTR(result = write(this->sock_fd_, remaining, remaining_size));
+        if (result == -1) {
+          abort();
+        }
+        remaining += result;
+        remaining_size -= result;
+      }
+    }
+
     if (hci_outgoing_queue_.empty()) {
       this->hci_incoming_thread_.GetReactor()->ModifyRegistration(
           this->reactable_, common::Bind(&HciHalHostRootcanal::incoming_packet_received, common::Unretained(this)),
@@ -258,7 +309,7 @@ class HciHalHostRootcanal : public HciHal {
           LOG_INFO("Dropping an event after processing");
           return;
         }
-        incoming_packet_callback_->hciEventReceived(receivedHciPacket);
+        incoming_packet_callback_->hciEventReceived(std::move(receivedHciPacket));
       }
     }
 
@@ -284,7 +335,7 @@ class HciHalHostRootcanal : public HciHal {
           LOG_INFO("Dropping an ACL packet after processing");
           return;
         }
-        incoming_packet_callback_->aclDataReceived(receivedHciPacket);
+        incoming_packet_callback_->aclDataReceived(std::move(receivedHciPacket));
       }
     }
 
@@ -308,7 +359,7 @@ class HciHalHostRootcanal : public HciHal {
           LOG_INFO("Dropping a SCO packet after processing");
           return;
         }
-        incoming_packet_callback_->scoDataReceived(receivedHciPacket);
+        incoming_packet_callback_->scoDataReceived(std::move(receivedHciPacket));
       }
     }
     memset(buf, 0, kBufSize);
@@ -18,8 +18,16 @@
 
 #include <arpa/inet.h>
 #include <netinet/in.h>
+#include <zlib.h>
+#include <algorithm>
 #include <bitset>
+#include <cerrno>
 #include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
 
 #include "os/log.h"
 
@@ -65,32 +73,64 @@ constexpr btsnoop_file_header_t BTSNOOP_FILE_HEADER = {
     .identification_pattern = {'b', 't', 's', 'n', 'o', 'o', 'p', 0x00},
     .version_number = BTSNOOP_VERSION_NUMBER,
     .datalink_type = BTSNOOP_DATALINK_TYPE};
-}  // namespace
 
-SnoopLogger::SnoopLogger() {
+// The async writer hands the file at most this much data per write
+constexpr size_t kWriteBufferSize = 64 * 1024;
+// The async writer wakes up at least this often, or when the ring is half full
+constexpr std::chrono::milliseconds kWriterInterval = std::chrono::milliseconds(100);
+
+uint64_t get_timestamp_us() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+void open_btsnoop_file(std::ofstream* btsnoop_ostream, const std::string& path) {
   bool file_exists;
   {
-    std::ifstream btsnoop_istream(file_path);
+    std::ifstream btsnoop_istream(path);
     file_exists = btsnoop_istream.is_open();
   }
-  btsnoop_ostream_.open(file_path, std::ios::binary | std::ios::app | std::ios::out);
+  btsnoop_ostream->open(path, std::ios::binary | std::ios::app | std::ios::out);
   if (!file_exists) {
     LOG_INFO("Creating new BTSNOOP");
-    btsnoop_ostream_.write(reinterpret_cast<const char*>(&BTSNOOP_FILE_HEADER), sizeof(btsnoop_file_header_t));
+    btsnoop_ostream->write(reinterpret_cast<const char*>(&BTSNOOP_FILE_HEADER), sizeof(btsnoop_file_header_t));
   } else {
     LOG_INFO("Appending to old BTSNOOP");
   }
 }
 
-void SnoopLogger::SetFilePath(const std::string& filename) {
-  file_path = filename;
+// Gzips |source| into |destination| and removes |source|
+void compress_file(const std::string& source, const std::string& destination) {
+  std::ifstream source_istream(source, std::ios::binary);
+  gzFile destination_file = gzopen(destination.c_str(), "wb");
+  if (!source_istream.is_open() || destination_file == nullptr) {
+    LOG_ERROR("Unable to compress %s into %s", source.c_str(), destination.c_str());
+    if (destination_file != nullptr) {
+      gzclose(destination_file);
+    }
+    return;
+  }
+  std::vector<char> buffer(kWriteBufferSize);
+  bool success = true;
+  while (success && source_istream) {
+    source_istream.read(buffer.data(), buffer.size());
+    int count = source_istream.gcount();
+    success = count == 0 || gzwrite(destination_file, buffer.data(), count) == count;
+  }
+  success = gzclose(destination_file) == Z_OK && success;
+  if (!success) {
+    LOG_ERROR("Failed to compress %s into %s", source.c_str(), destination.c_str());
+    std::remove(destination.c_str());
+    return;
+  }
+  std::remove(source.c_str());
 }
 
-void SnoopLogger::capture(const HciPacket& packet, Direction direction, PacketType type) {
-  uint64_t timestamp_us =
-      std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch())
-          .count();
-  std::lock_guard<std::mutex> lock(file_mutex_);
+btsnoop_packet_header_t make_packet_header(const HciPacket& packet, SnoopLogger::Direction direction,
+                                           SnoopLogger::PacketType type, uint64_t timestamp_us,
+                                           uint32_t dropped_packets) {
+  using Direction = SnoopLogger::Direction;
+  using PacketType = SnoopLogger::PacketType;
   std::bitset<32> flags = 0;
   switch (type) {
     case PacketType::CMD:
@@ -111,26 +151,284 @@ void SnoopLogger::capture(const HciPacket& packet, Direction direction, PacketTy
       break;
   }
   uint32_t length = packet.size() + /* type byte */ 1;
-  btsnoop_packet_header_t header = {.length_original = htonl(length),
-                                    .length_captured = htonl(length),
-                                    .flags = htonl(static_cast<uint32_t>(flags.to_ulong())),
-                                    .dropped_packets = 0,
-                                    .timestamp = htonll(timestamp_us + BTSNOOP_EPOCH_DELTA),
-                                    .type = static_cast<uint8_t>(type)};
+  return {.length_original = htonl(length),
+          .length_captured = htonl(length),
+          .flags = htonl(static_cast<uint32_t>(flags.to_ulong())),
+          .dropped_packets = htonl(dropped_packets),
+          .timestamp = htonll(timestamp_us + BTSNOOP_EPOCH_DELTA),
+          .type = static_cast<uint8_t>(type)};
+}
+}  // namespace
+
+// Bounded multi producer, single consumer ring of packet records. Each cell carries a sequence number, a producer
+// claims the cell at the enqueue position with a CAS, and publishes it by advancing the sequence. The writer thread
+// frees cells in order, so a producer finding its cell still in use knows that the ring is full and drops the packet.
+class SnoopLogger::AsyncWriter {
+ public:
+  AsyncWriter(std::ofstream* btsnoop_ostream, const std::string& path, const AsyncOptions& options)
+      : btsnoop_ostream_(btsnoop_ostream), path_(path), options_(options) {
+    size_t ring_size = 2;
+    while (ring_size < options_.ring_size) {
+      ring_size <<= 1;
+    }
+    mask_ = ring_size - 1;
+    cells_ = std::make_unique<Cell[]>(ring_size);
+    for (size_t i = 0; i < ring_size; i++) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    write_buffer_.reserve(kWriteBufferSize);
+    std::ifstream btsnoop_istream(path_, std::ios::binary | std::ios::ate);
+    if (btsnoop_istream.is_open()) {
+      file_size_ = btsnoop_istream.tellg();
+    }
+  }
+
+  ~AsyncWriter() {
+    Stop();
+  }
+
+  void Start() {
+    stopping_ = false;
+    writer_thread_ = std::thread(&AsyncWriter::run, this);
+  }
+
+  // Writes out what is left in the ring before returning
+  void Stop() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    writer_wakeup_.notify_one();
+    if (writer_thread_.joinable()) {
+      writer_thread_.join();
+    }
+    if (compression_thread_.joinable()) {
+      compression_thread_.join();
+    }
+  }
+
+  // Can be called from several threads at once, never blocks
+  void Enqueue(const HciPacket& packet, Direction direction, PacketType type, uint64_t timestamp_us) {
+    size_t position = enqueue_position_.load(std::memory_order_relaxed);
+    Cell* cell;
+    while (true) {
+      cell = &cells_[position & mask_];
+      size_t sequence = cell->sequence.load(std::memory_order_acquire);
+      auto difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+      if (difference == 0) {
+        if (enqueue_position_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (difference < 0) {
+        dropped_packets_.fetch_add(1, std::memory_order_relaxed);
+        return;
+      } else {
+        position = enqueue_position_.load(std::memory_order_relaxed);
+      }
+    }
+    cell->header = make_packet_header(packet, direction, type, timestamp_us,
+                                      static_cast<uint32_t>(dropped_packets_.load(std::memory_order_relaxed)));
+    cell->data.assign(packet.begin(), packet.end());
+    cell->sequence.store(position + 1, std::memory_order_release);
+    if (position - dequeue_position_.load(std::memory_order_relaxed) == (mask_ + 1) / 2) {
+      writer_wakeup_.notify_one();
+    }
+  }
+
+  Statistics GetStatistics() const {
+    Statistics statistics;
+    statistics.written_packets = written_packets_.load(std::memory_order_relaxed);
+    statistics.dropped_packets = dropped_packets_.load(std::memory_order_relaxed);
+    statistics.rotated_files = rotated_files_.load(std::memory_order_relaxed);
+    return statistics;
+  }
+
+ private:
+  struct Cell {
+    std::atomic<size_t> sequence;
+    btsnoop_packet_header_t header;
+    HciPacket data;
+  };
+
+  void run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+      writer_wakeup_.wait_for(lock, kWriterInterval);
+      lock.unlock();
+      drain();
+      lock.lock();
+    }
+    lock.unlock();
+    drain();
+  }
+
+  void drain() {
+    while (true) {
+      size_t position = dequeue_position_.load(std::memory_order_relaxed);
+      Cell& cell = cells_[position & mask_];
+      if (cell.sequence.load(std::memory_order_acquire) != position + 1) {
+        break;
+      }
+      size_t record_size = sizeof(btsnoop_packet_header_t) + cell.data.size();
+      if (should_rotate(record_size)) {
+        rotate();
+      }
+      auto header = reinterpret_cast<const char*>(&cell.header);
+      write_buffer_.insert(write_buffer_.end(), header, header + sizeof(btsnoop_packet_header_t));
+      write_buffer_.insert(write_buffer_.end(), cell.data.begin(), cell.data.end());
+      cell.sequence.store(position + mask_ + 1, std::memory_order_release);
+      dequeue_position_.store(position + 1, std::memory_order_relaxed);
+      file_size_ += record_size;
+      packets_in_file_++;
+      written_packets_.fetch_add(1, std::memory_order_relaxed);
+      if (write_buffer_.size() >= kWriteBufferSize) {
+        flush_write_buffer();
+      }
+    }
+    flush_write_buffer();
+    btsnoop_ostream_->flush();
+  }
+
+  void flush_write_buffer() {
+    if (write_buffer_.empty()) {
+      return;
+    }
+    btsnoop_ostream_->write(write_buffer_.data(), write_buffer_.size());
+    write_buffer_.clear();
+  }
+
+  bool should_rotate(size_t record_size) const {
+    if (file_size_ <= sizeof(btsnoop_file_header_t)) {
+      return false;
+    }
+    return (options_.max_packets_per_file != 0 && packets_in_file_ >= options_.max_packets_per_file) ||
+           (options_.max_file_size != 0 && file_size_ + record_size > options_.max_file_size);
+  }
+
+  void rotate() {
+    flush_write_buffer();
+    btsnoop_ostream_->close();
+    // The previous rotated log must be compressed before it is replaced
+    if (compression_thread_.joinable()) {
+      compression_thread_.join();
+    }
+    std::string last_path = path_ + ".last";
+    if (std::rename(path_.c_str(), last_path.c_str()) != 0) {
+      LOG_ERROR("Unable to rotate %s: %s", path_.c_str(), strerror(errno));
+    } else if (options_.compress_rotated_files) {
+      compression_thread_ = std::thread(compress_file, last_path, last_path + ".gz");
+    }
+    open_btsnoop_file(btsnoop_ostream_, path_);
+    file_size_ = sizeof(btsnoop_file_header_t);
+    packets_in_file_ = 0;
+    rotated_files_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  std::ofstream* btsnoop_ostream_;
+  const std::string path_;
+  const AsyncOptions options_;
+  size_t mask_;
+  std::unique_ptr<Cell[]> cells_;
+  std::atomic<size_t> enqueue_position_{0};
+  std::atomic<size_t> dequeue_position_{0};
+  std::atomic<uint64_t> written_packets_{0};
+  std::atomic<uint64_t> dropped_packets_{0};
+  std::atomic<uint64_t> rotated_files_{0};
+
+  // Only used by the writer thread
+  std::vector<char> write_buffer_;
+  size_t file_size_ = 0;
+  size_t packets_in_file_ = 0;
+
+  std::mutex mutex_;
+  std::condition_variable writer_wakeup_;
+  bool stopping_ = false;
+  std::thread writer_thread_;
+  std::thread compression_thread_;
+};
+
+SnoopLogger::SnoopLogger() {
+  open_btsnoop_file(&btsnoop_ostream_, file_path);
+  if (async_options.enabled) {
+    async_writer_ = std::make_unique<AsyncWriter>(&btsnoop_ostream_, file_path, async_options);
+  }
+}
+
+SnoopLogger::~SnoopLogger() = default;
+
+void SnoopLogger::SetFilePath(const std::string& filename) {
+  file_path = filename;
+}
+
+void SnoopLogger::SetAsyncOptions(const AsyncOptions& options) {
+  async_options = options;
+}
+
+void SnoopLogger::capture(const HciPacket& packet, Direction direction, PacketType type) {
+  uint64_t timestamp_us = get_timestamp_us();
+  if (async_writer_ != nullptr) {
+    async_writer_->Enqueue(packet, direction, type, timestamp_us);
+    return;
+  }
+  std::lock_guard<std::mutex> lock(file_mutex_);
+  write_packet(packet, direction, type, timestamp_us);
+  if (AlwaysFlush) btsnoop_ostream_.flush();
+}
+
+void SnoopLogger::capture(const std::vector<HciPacket>& packets, Direction direction, PacketType type) {
+  uint64_t timestamp_us = get_timestamp_us();
+  if (async_writer_ != nullptr) {
+    for (const auto& packet : packets) {
+      async_writer_->Enqueue(packet, direction, type, timestamp_us);
+    }
+    return;
+  }
+  std::lock_guard<std::mutex> lock(file_mutex_);
+  for (const auto& packet : packets) {
+    write_packet(packet, direction, type, timestamp_us);
+  }
+  if (AlwaysFlush) btsnoop_ostream_.flush();
+}
+
+SnoopLogger::Statistics SnoopLogger::GetStatistics() const {
+  if (async_writer_ != nullptr) {
+    return async_writer_->GetStatistics();
+  }
+  Statistics statistics;
+  statistics.written_packets = written_packets_.load(std::memory_order_relaxed);
+  return statistics;
+}
+
+void SnoopLogger::write_packet(const HciPacket& packet, Direction direction, PacketType type, uint64_t timestamp_us) {
+  btsnoop_packet_header_t header = make_packet_header(packet, direction, type, timestamp_us, 0);
   btsnoop_ostream_.write(reinterpret_cast<const char*>(&header), sizeof(btsnoop_packet_header_t));
   btsnoop_ostream_.write(reinterpret_cast<const char*>(packet.data()), packet.size());
-  if (AlwaysFlush) btsnoop_ostream_.flush();
+  written_packets_.fetch_add(1, std::memory_order_relaxed);
 }
 
 void SnoopLogger::ListDependencies(ModuleList* list) {
   // We have no dependencies
 }
 
-void SnoopLogger::Start() {}
+void SnoopLogger::Start() {
+  if (async_writer_ != nullptr) {
+    async_writer_->Start();
+  }
+}
 
-void SnoopLogger::Stop() {}
+void SnoopLogger::Stop() {
+  if (async_writer_ != nullptr) {
+    async_writer_->Stop();
+    auto statistics = async_writer_->GetStatistics();
+    LOG_INFO("Wrote %llu packets, dropped %llu, rotated %llu files",
+             static_cast<unsigned long long>(statistics.written_packets),
+             static_cast<unsigned long long>(statistics.dropped_packets),
+             static_cast<unsigned long long>(statistics.rotated_files));
+  }
+}
 
 std::string SnoopLogger::file_path = SnoopLogger::DefaultFilePath;
+SnoopLogger::AsyncOptions SnoopLogger::async_options = SnoopLogger::DefaultAsyncOptions;
 
 const ModuleFactory SnoopLogger::Factory = ModuleFactory([]() {
   return new SnoopLogger();
@@ -16,8 +16,10 @@
 
 #pragma once
 
+#include <atomic>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <mutex>
 #include <string>
 
@@ -38,6 +40,30 @@ class SnoopLogger : public ::bluetooth::Module {
   // Flag to allow flush into persistent memory on every packet captured. This is enabled on host for debugging.
   static const bool AlwaysFlush;
 
+  // In async mode capture() only copies the packet into a lock free ring, and a writer thread does the file I/O.
+  // Packets that find the ring full are dropped and counted, instead of blocking the caller.
+  struct AsyncOptions {
+    bool enabled = false;
+    // Number of packets the ring holds, rounded up to a power of two
+    size_t ring_size = 1024;
+    // The writer moves the log to <file>.last once it would grow past either limit, 0 disables the limit
+    size_t max_file_size = 0;
+    size_t max_packets_per_file = 0;
+    // Gzip the rotated log to <file>.last.gz in the background
+    bool compress_rotated_files = false;
+  };
+  // Each transport using SnoopLogger should define its own DefaultAsyncOptions
+  static const AsyncOptions DefaultAsyncOptions;
+  // Set before module is started, like the file path
+  static void SetAsyncOptions(const AsyncOptions& options);
+
+  struct Statistics {
+    uint64_t written_packets = 0;
+    uint64_t dropped_packets = 0;
+    uint64_t rotated_files = 0;
+  };
+  Statistics GetStatistics() const;
+
   enum class PacketType {
     CMD = 1,
     ACL = 2,
@@ -52,16 +78,28 @@ class SnoopLogger : public ::bluetooth::Module {
 
   void capture(const HciPacket& packet, Direction direction, PacketType type);
 
+  // Captures |packets| in order, taking the file lock and flushing only once for the whole batch
+  void capture(const std::vector<HciPacket>& packets, Direction direction, PacketType type);
+
  protected:
   void ListDependencies(ModuleList* list) override;
   void Start() override;
   void Stop() override;
 
  private:
+  class AsyncWriter;
+
   SnoopLogger();
+  ~SnoopLogger() override;
+  // Must be called with file_mutex_ held
+  void write_packet(const HciPacket& packet, Direction direction, PacketType type, uint64_t timestamp_us);
   static std::string file_path;
+  static AsyncOptions async_options;
   std::ofstream btsnoop_ostream_;
   std::mutex file_mutex_;
+  std::atomic<uint64_t> written_packets_{0};
+  // Owns btsnoop_ostream_ once started, only set in async mode
+  std::unique_ptr<AsyncWriter> async_writer_;
 };
 
 }  // namespace hal
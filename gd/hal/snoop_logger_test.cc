@@ -0,0 +1,182 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hal/snoop_logger.h"
+
+#include <arpa/inet.h>
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <zlib.h>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#include "module.h"
+
+namespace bluetooth {
+namespace hal {
+namespace {
+
+constexpr size_t kFileHeaderSize = 16;
+constexpr size_t kPacketHeaderSize = 25;
+
+// Returns the first payload byte of each record of a btsnoop log
+std::vector<uint8_t> GetRecords(const std::vector<uint8_t>& log) {
+  std::vector<uint8_t> records;
+  EXPECT_GE(log.size(), kFileHeaderSize);
+  size_t offset = kFileHeaderSize;
+  while (offset + kPacketHeaderSize <= log.size()) {
+    uint32_t length;
+    memcpy(&length, &log[offset], sizeof(length));
+    // The length includes the type byte, which ends the record header
+    length = ntohl(length) - 1;
+    EXPECT_LE(offset + kPacketHeaderSize + length, log.size());
+    records.push_back(log[offset + kPacketHeaderSize]);
+    offset += kPacketHeaderSize + length;
+  }
+  EXPECT_EQ(offset, log.size());
+  return records;
+}
+
+std::vector<uint8_t> ReadFile(const std::string& path) {
+  std::ifstream istream(path, std::ios::binary);
+  EXPECT_TRUE(istream.is_open()) << path;
+  return std::vector<uint8_t>(std::istreambuf_iterator<char>(istream), std::istreambuf_iterator<char>());
+}
+
+std::vector<uint8_t> ReadCompressedFile(const std::string& path) {
+  std::vector<uint8_t> log;
+  gzFile file = gzopen(path.c_str(), "rb");
+  EXPECT_NE(file, nullptr) << path;
+  if (file == nullptr) {
+    return log;
+  }
+  uint8_t buffer[256];
+  int count;
+  while ((count = gzread(file, buffer, sizeof(buffer))) > 0) {
+    log.insert(log.end(), buffer, buffer + count);
+  }
+  gzclose(file);
+  return log;
+}
+
+class SnoopLoggerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    file_path_ = ::testing::TempDir() + "snoop_logger_test_" + std::to_string(getpid()) + ".log";
+    RemoveFiles();
+    SnoopLogger::SetFilePath(file_path_);
+  }
+
+  void TearDown() override {
+    RemoveFiles();
+    SnoopLogger::SetAsyncOptions(SnoopLogger::DefaultAsyncOptions);
+    SnoopLogger::SetFilePath(SnoopLogger::DefaultFilePath);
+  }
+
+  void RemoveFiles() {
+    std::remove(file_path_.c_str());
+    std::remove((file_path_ + ".last").c_str());
+    std::remove((file_path_ + ".last.gz").c_str());
+  }
+
+  SnoopLogger* StartLogger() {
+    return registry_.Start<SnoopLogger>(&registry_.GetTestThread());
+  }
+
+  // Captures single byte ACL packets holding 0, 1, ... |count| - 1
+  void CapturePackets(SnoopLogger* snoop_logger, int count) {
+    for (int i = 0; i < count; i++) {
+      snoop_logger->capture(HciPacket{static_cast<uint8_t>(i)}, SnoopLogger::Direction::OUTGOING,
+                            SnoopLogger::PacketType::ACL);
+    }
+  }
+
+  std::string file_path_;
+  TestModuleRegistry registry_;
+};
+
+TEST_F(SnoopLoggerTest, sync_capture_writes_every_packet) {
+  SnoopLogger::SetAsyncOptions(SnoopLogger::AsyncOptions{});
+  auto snoop_logger = StartLogger();
+  CapturePackets(snoop_logger, 3);
+  snoop_logger->capture(std::vector<HciPacket>{{3}, {4}}, SnoopLogger::Direction::INCOMING,
+                        SnoopLogger::PacketType::ACL);
+  EXPECT_EQ(snoop_logger->GetStatistics().written_packets, 5u);
+  registry_.StopAll();
+  EXPECT_EQ(GetRecords(ReadFile(file_path_)), (std::vector<uint8_t>{0, 1, 2, 3, 4}));
+}
+
+TEST_F(SnoopLoggerTest, async_capture_writes_packets_in_order) {
+  SnoopLogger::AsyncOptions options;
+  options.enabled = true;
+  options.ring_size = 256;
+  SnoopLogger::SetAsyncOptions(options);
+  auto snoop_logger = StartLogger();
+  CapturePackets(snoop_logger, 100);
+  registry_.StopAll();
+  std::vector<uint8_t> expected_records;
+  for (int i = 0; i < 100; i++) {
+    expected_records.push_back(i);
+  }
+  EXPECT_EQ(GetRecords(ReadFile(file_path_)), expected_records);
+}
+
+TEST_F(SnoopLoggerTest, async_capture_drops_packets_when_the_ring_is_full) {
+  SnoopLogger::AsyncOptions options;
+  options.enabled = true;
+  options.ring_size = 2;
+  SnoopLogger::SetAsyncOptions(options);
+  auto snoop_logger = StartLogger();
+  CapturePackets(snoop_logger, 1000);
+  auto dropped_packets = snoop_logger->GetStatistics().dropped_packets;
+  registry_.StopAll();
+  auto records = GetRecords(ReadFile(file_path_));
+  EXPECT_FALSE(records.empty());
+  EXPECT_EQ(records.size() + dropped_packets, 1000u);
+}
+
+TEST_F(SnoopLoggerTest, async_writer_rotates_by_packet_count) {
+  SnoopLogger::AsyncOptions options;
+  options.enabled = true;
+  options.max_packets_per_file = 2;
+  SnoopLogger::SetAsyncOptions(options);
+  auto snoop_logger = StartLogger();
+  CapturePackets(snoop_logger, 5);
+  registry_.StopAll();
+  EXPECT_EQ(GetRecords(ReadFile(file_path_ + ".last")), (std::vector<uint8_t>{2, 3}));
+  EXPECT_EQ(GetRecords(ReadFile(file_path_)), (std::vector<uint8_t>{4}));
+}
+
+TEST_F(SnoopLoggerTest, async_writer_compresses_rotated_file) {
+  SnoopLogger::AsyncOptions options;
+  options.enabled = true;
+  options.max_file_size = kFileHeaderSize + 2 * (kPacketHeaderSize + 1);
+  options.compress_rotated_files = true;
+  SnoopLogger::SetAsyncOptions(options);
+  auto snoop_logger = StartLogger();
+  CapturePackets(snoop_logger, 3);
+  registry_.StopAll();
+  EXPECT_FALSE(std::ifstream(file_path_ + ".last").is_open());
+  EXPECT_EQ(GetRecords(ReadCompressedFile(file_path_ + ".last.gz")), (std::vector<uint8_t>{0, 1}));
+  EXPECT_EQ(GetRecords(ReadFile(file_path_)), (std::vector<uint8_t>{2}));
+}
+
+}  // namespace
+}  // namespace hal
+}  // namespace bluetooth
@@ -33,7 +33,8 @@ class AclFragmenter {
   AclFragmenter(size_t mtu, std::unique_ptr<packet::BasePacketBuilder> input);
   virtual ~AclFragmenter() = default;
 
-  std::vector<std::unique_ptr<packet::RawBuilder>> GetFragments();
+  // Serializes the packet once. The fragments share the serialized bytes, each one only serializes its own slice.
+  std::vector<std::unique_ptr<packet::BasePacketBuilder>> GetFragments();
 
  private:
   size_t mtu_;
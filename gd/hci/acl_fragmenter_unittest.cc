@@ -0,0 +1,83 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hci/acl_fragmenter.h"
+
+#include <gtest/gtest.h>
+#include <memory>
+
+#include "packet/bit_inserter.h"
+#include "packet/raw_builder.h"
+
+using bluetooth::packet::BitInserter;
+using bluetooth::packet::RawBuilder;
+using std::vector;
+
+namespace bluetooth {
+namespace hci {
+namespace {
+
+vector<uint8_t> CountingBytes(size_t size) {
+  vector<uint8_t> bytes;
+  for (size_t i = 0; i < size; i++) {
+    bytes.push_back(static_cast<uint8_t>(i));
+  }
+  return bytes;
+}
+
+TEST(AclFragmenterTest, fragmentsCoverThePacket) {
+  const size_t mtu = 27;
+  vector<uint8_t> packet = CountingBytes(100);
+  auto fragments = AclFragmenter(mtu, std::make_unique<RawBuilder>(packet)).GetFragments();
+  ASSERT_EQ(fragments.size(), 4u);
+
+  vector<uint8_t> reassembled;
+  BitInserter it(reassembled);
+  for (size_t i = 0; i < fragments.size(); i++) {
+    ASSERT_EQ(fragments[i]->size(), i + 1 < fragments.size() ? mtu : packet.size() % mtu);
+    fragments[i]->Serialize(it);
+  }
+  ASSERT_EQ(packet, reassembled);
+}
+
+TEST(AclFragmenterTest, exactMultipleOfMtu) {
+  const size_t mtu = 10;
+  vector<uint8_t> packet = CountingBytes(30);
+  auto fragments = AclFragmenter(mtu, std::make_unique<RawBuilder>(packet)).GetFragments();
+  ASSERT_EQ(fragments.size(), 3u);
+  for (const auto& fragment : fragments) {
+    ASSERT_EQ(fragment->size(), mtu);
+  }
+}
+
+TEST(AclFragmenterTest, fragmentsOutliveTheFragmenter) {
+  vector<uint8_t> packet = CountingBytes(20);
+  std::vector<std::unique_ptr<packet::BasePacketBuilder>> fragments;
+  {
+    AclFragmenter fragmenter(15, std::make_unique<RawBuilder>(packet));
+    fragments = fragmenter.GetFragments();
+  }
+  vector<uint8_t> reassembled;
+  BitInserter it(reassembled);
+  for (const auto& fragment : fragments) {
+    fragment->Serialize(it);
+  }
+  ASSERT_EQ(packet, reassembled);
+}
+
+}  // namespace
+}  // namespace hci
+}  // namespace bluetooth
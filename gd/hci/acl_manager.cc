@@ -23,6 +23,7 @@
 
 #include "acl_fragmenter.h"
 #include "acl_manager.h"
+#include "acl_scheduler.h"
 #include "common/bidi_queue.h"
 #include "hci/controller.h"
 #include "hci/hci_layer.h"
@@ -61,10 +62,11 @@ uint16_t GetL2capPduSize(AclPacketView packet) {
 }  // namespace
 
 struct AclManager::acl_connection {
-  acl_connection(AddressWithType address_with_type, os::Handler* handler)
-      : address_with_type_(address_with_type), handler_(handler) {}
+  acl_connection(AddressWithType address_with_type, bool is_le, os::Handler* handler)
+      : address_with_type_(address_with_type), is_le_(is_le), handler_(handler) {}
   friend AclConnection;
   AddressWithType address_with_type_;
+  bool is_le_;
   os::Handler* handler_;
   std::unique_ptr<AclConnection::Queue> queue_ = std::make_unique<AclConnection::Queue>(10);
   bool is_disconnected_ = false;
@@ -78,8 +80,6 @@ struct AclManager::acl_connection {
   os::Handler* on_connection_update_complete_callback_handler_ = nullptr;
   // Round-robin: Track if dequeue is registered for this connection
   bool is_registered_ = false;
-  // Credits: Track the number of packets which have been sent to the controller
-  uint16_t number_of_sent_packets_ = 0;
   PacketViewForRecombination recombination_stage_{std::make_shared<std::vector<uint8_t>>()};
   int remaining_sdu_continuation_packet_size_ = 0;
   bool enqueue_registered_ = false;
@@ -157,9 +157,12 @@ struct AclManager::impl {
     hci_layer_ = acl_manager_.GetDependency<HciLayer>();
     handler_ = acl_manager_.GetHandler();
     controller_ = acl_manager_.GetDependency<Controller>();
-    max_acl_packet_credits_ = controller_->GetControllerNumAclPacketBuffers();
-    acl_packet_credits_ = max_acl_packet_credits_;
-    acl_buffer_length_ = controller_->GetControllerAclPacketLength();
+    // LE links share the classic buffers when the controller has no LE buffers
+    LeBufferSize le_buffer_size = controller_->GetControllerLeBufferSize();
+    scheduler_ = std::make_unique<AclScheduler>(controller_->GetControllerNumAclPacketBuffers(),
+                                                le_buffer_size.total_num_le_packets_);
+    hci_mtu_ = controller_->GetControllerAclPacketLength();
+    le_hci_mtu_ = le_buffer_size.total_num_le_packets_ != 0 ? le_buffer_size.le_data_packet_length_ : hci_mtu_;
     controller_->RegisterCompletedAclPacketsCallback(
         common::Bind(&impl::incoming_acl_credits, common::Unretained(this)), handler_);
 
@@ -213,7 +216,6 @@ struct AclManager::impl {
     hci_layer_->RegisterEventHandler(EventCode::LINK_SUPERVISION_TIMEOUT_CHANGED,
                                      Bind(&impl::on_link_supervision_timeout_changed, common::Unretained(this)),
                                      handler_);
-    hci_mtu_ = controller_->GetControllerAclPacketLength();
   }
 
   void Stop() {
@@ -226,6 +228,7 @@ struct AclManager::impl {
     hci_queue_end_->UnregisterDequeue();
     unregister_all_connections();
     acl_connections_.clear();
+    fragments_to_send_.clear();
     hci_queue_end_ = nullptr;
     handler_ = nullptr;
     hci_layer_ = nullptr;
@@ -241,35 +244,66 @@ struct AclManager::impl {
       LOG_INFO("Dropping %hx received credits to disconnected connection 0x%0hx", credits, handle);
       return;
     }
-    connection_pair->second.number_of_sent_packets_ -= credits;
-    acl_packet_credits_ += credits;
-    ASSERT(acl_packet_credits_ <= max_acl_packet_credits_);
+    scheduler_->OnPacketsCompleted(handle, credits);
     start_round_robin();
   }
 
-  // Round-robin scheduler
+  // Round-robin scheduler: offers the links that have credits to send a packet, in the order of the AclScheduler.
+  // When none of them has a packet, waits for the first one to get a packet, and starts over.
   void start_round_robin() {
-    if (acl_packet_credits_ == 0) {
-      return;
-    }
     if (!fragments_to_send_.empty()) {
-      send_next_fragment();
+      if (scheduler_->GetCredits(fragments_handle_) > 0) {
+        send_next_fragment();
+      }
       return;
     }
-    for (auto connection_pair = acl_connections_.begin(); connection_pair != acl_connections_.end();
-         connection_pair = std::next(connection_pair)) {
-      if (connection_pair->second.is_registered_) {
-        continue;
+    unregister_all_connections();
+    auto send_order = scheduler_->GetSendOrder();
+    for (uint16_t handle : send_order) {
+      auto packet = acl_connections_.find(handle)->second.queue_->GetDownEnd()->TryDequeue();
+      if (packet != nullptr) {
+        buffer_packet(handle, std::move(packet));
+        return;
       }
+    }
+    for (uint16_t handle : send_order) {
+      auto connection_pair = acl_connections_.find(handle);
       connection_pair->second.is_registered_ = true;
       connection_pair->second.queue_->GetDownEnd()->RegisterDequeue(
-          handler_, common::Bind(&impl::handle_dequeue_from_upper, common::Unretained(this), connection_pair));
+          handler_, common::Bind(&impl::handle_dequeue_from_upper, common::Unretained(this)));
     }
   }
 
-  void handle_dequeue_from_upper(std::map<uint16_t, acl_connection>::iterator connection_pair) {
-    current_connection_pair_ = connection_pair;
-    buffer_packet();
+  void handle_dequeue_from_upper() {
+    start_round_robin();
+  }
+
+  void add_connection_to_scheduler(uint16_t handle, bool is_le) {
+    scheduler_->AddConnection(handle, is_le);
+    // Offer the new link a turn, unless a packet is being sent: the round robin starts over after it
+    if (fragments_to_send_.empty()) {
+      start_round_robin();
+    }
+  }
+
+  void set_priority(uint16_t handle, AclPriority priority) {
+    auto connection = acl_connections_.find(handle);
+    if (connection == acl_connections_.end() || connection->second.is_disconnected_) {
+      LOG_INFO("Dropping priority of unknown or disconnected connection 0x%04hx", handle);
+      return;
+    }
+    scheduler_->SetPriority(handle, priority);
+  }
+
+  void set_priority_by_address(Address address, AclPriority priority) {
+    for (const auto& connection : acl_connections_) {
+      if (!connection.second.is_le_ && !connection.second.is_disconnected_ &&
+          connection.second.address_with_type_.GetAddress() == address) {
+        scheduler_->SetPriority(connection.first, priority);
+        return;
+      }
+    }
+    LOG_INFO("No classic connection to %s", address.ToString().c_str());
   }
 
   void unregister_all_connections() {
@@ -282,20 +316,17 @@ struct AclManager::impl {
     }
   }
 
-  void buffer_packet() {
-    unregister_all_connections();
+  void buffer_packet(uint16_t handle, std::unique_ptr<BasePacketBuilder> packet) {
     BroadcastFlag broadcast_flag = BroadcastFlag::POINT_TO_POINT;
     //   Wrap packet and enqueue it
-    uint16_t handle = current_connection_pair_->first;
-
-    auto packet = current_connection_pair_->second.queue_->GetDownEnd()->TryDequeue();
-    ASSERT(packet != nullptr);
+    auto& connection = acl_connections_.find(handle)->second;
+    size_t mtu = connection.is_le_ ? le_hci_mtu_ : hci_mtu_;
 
-    if (packet->size() <= hci_mtu_) {
+    if (packet->size() <= mtu) {
       fragments_to_send_.push_front(AclPacketBuilder::Create(handle, PacketBoundaryFlag::FIRST_AUTOMATICALLY_FLUSHABLE,
                                                              broadcast_flag, std::move(packet)));
     } else {
-      auto fragments = AclFragmenter(hci_mtu_, std::move(packet)).GetFragments();
+      auto fragments = AclFragmenter(mtu, std::move(packet)).GetFragments();
       PacketBoundaryFlag packet_boundary_flag = PacketBoundaryFlag::FIRST_AUTOMATICALLY_FLUSHABLE;
       for (size_t i = 0; i < fragments.size(); i++) {
         fragments_to_send_.push_back(
@@ -305,26 +336,38 @@ struct AclManager::impl {
     }
     ASSERT(fragments_to_send_.size() > 0);
 
-    current_connection_pair_->second.number_of_sent_packets_ += fragments_to_send_.size();
+    fragments_handle_ = handle;
+    scheduler_->OnPacketScheduled(handle);
     send_next_fragment();
   }
 
   void send_next_fragment() {
+    if (hci_enqueue_registered_) {
+      return;
+    }
+    hci_enqueue_registered_ = true;
     hci_queue_end_->RegisterEnqueue(handler_,
                                     common::Bind(&impl::handle_enqueue_next_fragment, common::Unretained(this)));
   }
 
-  std::unique_ptr<AclPacketBuilder> handle_enqueue_next_fragment() {
-    ASSERT(acl_packet_credits_ > 0);
-    if (acl_packet_credits_ == 1 || fragments_to_send_.size() == 1) {
+  void stop_sending_fragments() {
+    if (hci_enqueue_registered_) {
+      hci_enqueue_registered_ = false;
       hci_queue_end_->UnregisterEnqueue();
+    }
+  }
+
+  std::unique_ptr<AclPacketBuilder> handle_enqueue_next_fragment() {
+    ASSERT(fragments_to_send_.size() > 0);
+    ASSERT(scheduler_->GetCredits(fragments_handle_) > 0);
+    if (scheduler_->GetCredits(fragments_handle_) == 1 || fragments_to_send_.size() == 1) {
+      stop_sending_fragments();
       if (fragments_to_send_.size() == 1) {
-        handler_->Post(common::BindOnce(&impl::start_round_robin, common::Unretained(this)));
+        handler_->Post([this]() { start_round_robin(); });
       }
     }
-    ASSERT(fragments_to_send_.size() > 0);
     auto raw_pointer = fragments_to_send_.front().release();
-    acl_packet_credits_ -= 1;
+    scheduler_->OnFragmentSent(fragments_handle_);
     fragments_to_send_.pop_front();
     return std::unique_ptr<AclPacketBuilder>(raw_pointer);
   }
@@ -407,10 +450,8 @@ struct AclManager::impl {
     uint16_t handle = connection_complete.GetConnectionHandle();
     ASSERT(acl_connections_.count(handle) == 0);
     acl_connections_.emplace(std::piecewise_construct, std::forward_as_tuple(handle),
-                             std::forward_as_tuple(address_with_type, handler_));
-    if (acl_connections_.size() == 1 && fragments_to_send_.size() == 0) {
-      start_round_robin();
-    }
+                             std::forward_as_tuple(address_with_type, true, handler_));
+    add_connection_to_scheduler(handle, true);
     auto role = connection_complete.GetRole();
     std::unique_ptr<AclConnection> connection_proxy(
         new AclConnection(&acl_manager_, handle, address, peer_address_type, role));
@@ -441,10 +482,8 @@ struct AclManager::impl {
     uint16_t handle = connection_complete.GetConnectionHandle();
     ASSERT(acl_connections_.count(handle) == 0);
     acl_connections_.emplace(std::piecewise_construct, std::forward_as_tuple(handle),
-                             std::forward_as_tuple(reporting_address_with_type, handler_));
-    if (acl_connections_.size() == 1 && fragments_to_send_.size() == 0) {
-      start_round_robin();
-    }
+                             std::forward_as_tuple(reporting_address_with_type, true, handler_));
+    add_connection_to_scheduler(handle, true);
     auto role = connection_complete.GetRole();
     std::unique_ptr<AclConnection> connection_proxy(
         new AclConnection(&acl_manager_, handle, address, peer_address_type, role));
@@ -468,10 +507,8 @@ struct AclManager::impl {
     ASSERT(acl_connections_.count(handle) == 0);
     acl_connections_.emplace(
         std::piecewise_construct, std::forward_as_tuple(handle),
-        std::forward_as_tuple(AddressWithType{address, AddressType::PUBLIC_DEVICE_ADDRESS}, handler_));
-    if (acl_connections_.size() == 1 && fragments_to_send_.size() == 0) {
-      start_round_robin();
-    }
+        std::forward_as_tuple(AddressWithType{address, AddressType::PUBLIC_DEVICE_ADDRESS}, false, handler_));
+    add_connection_to_scheduler(handle, false);
     std::unique_ptr<AclConnection> connection_proxy(new AclConnection(&acl_manager_, handle, address));
     client_handler_->Post(common::BindOnce(&ConnectionCallbacks::OnConnectSuccess,
                                            common::Unretained(client_callbacks_), std::move(connection_proxy)));
@@ -502,9 +539,13 @@ struct AclManager::impl {
       acl_connection.is_disconnected_ = true;
       acl_connection.disconnect_reason_ = disconnection_complete.GetReason();
       acl_connection.call_disconnect_callback();
-      // Reclaim outstanding packets
-      acl_packet_credits_ += acl_connection.number_of_sent_packets_;
-      acl_connection.number_of_sent_packets_ = 0;
+      // Reclaim outstanding packets, and drop the rest of a packet being fragmented
+      scheduler_->RemoveConnection(handle);
+      if (!fragments_to_send_.empty() && fragments_handle_ == handle) {
+        stop_sending_fragments();
+        fragments_to_send_.clear();
+        handler_->Post([this]() { start_round_robin(); });
+      }
     } else {
       std::string error_code = ErrorCodeText(status);
       LOG_ERROR("Received disconnection complete with error code %s, handle 0x%02hx", error_code.c_str(), handle);
@@ -1877,6 +1918,10 @@ struct AclManager::impl {
     return true;
   }
 
+  void SetPriority(uint16_t handle, AclPriority priority) {
+    handler_->Post(BindOnce(&impl::set_priority, common::Unretained(this), handle, priority));
+  }
+
   void Finish(uint16_t handle) {
     auto& connection = check_and_get_connection(handle);
     ASSERT_LOG(connection.is_disconnected_, "Finish must be invoked after disconnection (handle 0x%04hx)", handle);
@@ -1889,12 +1934,12 @@ struct AclManager::impl {
   static constexpr uint16_t kMaximumCeLength = 0x0C00;
 
   Controller* controller_ = nullptr;
-  uint16_t max_acl_packet_credits_ = 0;
-  uint16_t acl_packet_credits_ = 0;
-  uint16_t acl_buffer_length_ = 0;
+  std::unique_ptr<AclScheduler> scheduler_;
 
   std::list<std::unique_ptr<AclPacketBuilder>> fragments_to_send_;
-  std::map<uint16_t, acl_connection>::iterator current_connection_pair_;
+  // The connection the fragments belong to
+  uint16_t fragments_handle_ = 0;
+  bool hci_enqueue_registered_ = false;
 
   HciLayer* hci_layer_ = nullptr;
   os::Handler* handler_ = nullptr;
@@ -1913,6 +1958,7 @@ struct AclManager::impl {
   common::Callback<bool(Address, ClassOfDevice)> should_accept_connection_;
   std::queue<std::pair<Address, std::unique_ptr<CreateConnectionBuilder>>> pending_outgoing_connections_;
   size_t hci_mtu_{0};
+  size_t le_hci_mtu_{0};
 };
 
 AclConnection::QueueUpEnd* AclConnection::GetAclQueueEnd() const {
@@ -2067,6 +2113,10 @@ void AclConnection::Finish() {
   return manager_->pimpl_->Finish(handle_);
 }
 
+void AclConnection::SetPriority(AclPriority priority) {
+  return manager_->pimpl_->SetPriority(handle_, priority);
+}
+
 AclManager::AclManager() : pimpl_(std::make_unique<impl>(*this)) {}
 
 void AclManager::RegisterCallbacks(ConnectionCallbacks* callbacks, os::Handler* handler) {
@@ -2114,6 +2164,11 @@ void AclManager::SwitchRole(Address address, Role role) {
   GetHandler()->Post(BindOnce(&impl::switch_role, common::Unretained(pimpl_.get()), address, role));
 }
 
+void AclManager::SetAclPriority(Address address, AclPriority priority) {
+  GetHandler()->Post(
+      BindOnce(&impl::set_priority_by_address, common::Unretained(pimpl_.get()), address, priority));
+}
+
 void AclManager::ReadDefaultLinkPolicySettings() {
   GetHandler()->Post(BindOnce(&impl::read_default_link_policy_settings, common::Unretained(pimpl_.get())));
 }
@@ -20,6 +20,7 @@
 
 #include "common/bidi_queue.h"
 #include "common/callback.h"
+#include "hci/acl_scheduler.h"
 #include "hci/address.h"
 #include "hci/address_with_type.h"
 #include "hci/hci_layer.h"
@@ -155,6 +156,9 @@ class AclConnection {
   // Ask AclManager to clean me up. Must invoke after on_disconnect is called
   virtual void Finish();
 
+  // High priority links, like A2DP streams, send more packets per turn of the ACL round robin
+  virtual void SetPriority(AclPriority priority);
+
   // TODO: API to change link settings ... ?
 
  private:
@@ -236,6 +240,9 @@ class AclManager : public Module {
 
   virtual void MasterLinkKey(KeyFlag key_flag);
   virtual void SwitchRole(Address address, Role role);
+
+  // Sets the priority of the classic link to |address|, for callers which don't own its AclConnection
+  virtual void SetAclPriority(Address address, AclPriority priority);
   virtual void ReadDefaultLinkPolicySettings();
   virtual void WriteDefaultLinkPolicySettings(uint16_t default_link_policy_settings);
 
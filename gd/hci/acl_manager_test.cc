@@ -87,12 +87,22 @@ class TestController : public Controller {
     return le_local_supported_features_;
   }
 
+  LeBufferSize GetControllerLeBufferSize() const override {
+    LeBufferSize le_buffer_size;
+    le_buffer_size.le_data_packet_length_ = le_acl_buffer_length_;
+    le_buffer_size.total_num_le_packets_ = total_le_acl_buffers_;
+    return le_buffer_size;
+  }
+
   void CompletePackets(uint16_t handle, uint16_t packets) {
     acl_cb_handler_->Post(common::BindOnce(acl_cb_, handle, packets));
   }
 
   uint16_t acl_buffer_length_ = 1024;
   uint16_t total_acl_buffers_ = 2;
+  // No LE buffers: LE links share the ACL buffers
+  uint16_t le_acl_buffer_length_ = 0;
+  uint8_t total_le_acl_buffers_ = 0;
   uint64_t le_local_supported_features_ = 0;
   common::Callback<void(uint16_t /* handle */, uint16_t /* packets */)> acl_cb_;
   os::Handler* acl_cb_handler_ = nullptr;
@@ -0,0 +1,110 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hci/acl_scheduler.h"
+
+#include "os/log.h"
+
+namespace bluetooth {
+namespace hci {
+
+AclScheduler::AclScheduler(uint16_t classic_credits, uint16_t le_credits)
+    : classic_pool_{classic_credits, classic_credits}, le_pool_{le_credits, le_credits}, has_le_pool_(le_credits != 0) {}
+
+void AclScheduler::AddConnection(uint16_t handle, bool is_le) {
+  ASSERT(links_.count(handle) == 0);
+  Link link;
+  link.pool = (is_le && has_le_pool_) ? &le_pool_ : &classic_pool_;
+  links_.emplace(handle, link);
+}
+
+void AclScheduler::RemoveConnection(uint16_t handle) {
+  auto link = links_.find(handle);
+  ASSERT(link != links_.end());
+  link->second.pool->credits += link->second.sent;
+  ASSERT(link->second.pool->credits <= link->second.pool->max_credits);
+  links_.erase(link);
+}
+
+void AclScheduler::SetPriority(uint16_t handle, AclPriority priority) {
+  auto link = links_.find(handle);
+  ASSERT(link != links_.end());
+  link->second.priority = priority;
+}
+
+uint16_t AclScheduler::GetCredits(uint16_t handle) const {
+  auto link = links_.find(handle);
+  ASSERT(link != links_.end());
+  return link->second.pool->credits;
+}
+
+std::vector<uint16_t> AclScheduler::GetSendOrder() const {
+  std::vector<uint16_t> order;
+  order.reserve(links_.size());
+  // The link whose turn isn't over goes first, then the links after it
+  auto start = links_.upper_bound(turn_handle_);
+  auto turn_link = links_.find(turn_handle_);
+  if (turn_link != links_.end() && turn_packets_ < GetWeight(turn_link->second)) {
+    start = turn_link;
+  }
+  auto link = start;
+  for (size_t i = 0; i < links_.size(); i++) {
+    if (link == links_.end()) {
+      link = links_.begin();
+    }
+    if (link->second.pool->credits > 0) {
+      order.push_back(link->first);
+    }
+    link++;
+  }
+  return order;
+}
+
+void AclScheduler::OnPacketScheduled(uint16_t handle) {
+  if (handle == turn_handle_) {
+    turn_packets_++;
+  } else {
+    turn_handle_ = handle;
+    turn_packets_ = 1;
+  }
+}
+
+void AclScheduler::OnFragmentSent(uint16_t handle) {
+  auto link = links_.find(handle);
+  ASSERT(link != links_.end());
+  ASSERT(link->second.pool->credits > 0);
+  link->second.pool->credits--;
+  link->second.sent++;
+}
+
+bool AclScheduler::OnPacketsCompleted(uint16_t handle, uint16_t packets) {
+  auto link = links_.find(handle);
+  if (link == links_.end()) {
+    return false;
+  }
+  ASSERT_LOG(packets <= link->second.sent, "handle 0x%04hx completed %hu packets, only %hu were sent", handle, packets,
+             link->second.sent);
+  link->second.sent -= packets;
+  link->second.pool->credits += packets;
+  return true;
+}
+
+uint16_t AclScheduler::GetWeight(const Link& link) const {
+  return link.priority == AclPriority::HIGH ? kHighPriorityWeight : 1;
+}
+
+}  // namespace hci
+}  // namespace bluetooth
@@ -0,0 +1,91 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+namespace bluetooth {
+namespace hci {
+
+enum class AclPriority { NORMAL, HIGH };
+
+// Decides which ACL connection sends the next packet to the controller, and keeps track of the controller buffers.
+//
+// Classic and LE links draw from separate credit pools when the controller has LE buffers, otherwise LE links share
+// the classic pool. Links are served in turns, like the round robin of the legacy l2c_link: a link may send up to its
+// weight in packets per turn, and the next turn goes to the link after it, so that a busy or high priority link never
+// starves the others.
+class AclScheduler {
+ public:
+  // The weight of high priority links, L2CAP_HIGH_PRI_RR_WEIGHT in the legacy stack
+  static constexpr uint16_t kHighPriorityWeight = 2;
+
+  // |le_credits| is 0 when the controller has no LE buffers
+  AclScheduler(uint16_t classic_credits, uint16_t le_credits);
+
+  void AddConnection(uint16_t handle, bool is_le);
+
+  // Returns the credits of the packets still in the controller to their pool
+  void RemoveConnection(uint16_t handle);
+
+  void SetPriority(uint16_t handle, AclPriority priority);
+
+  // Returns the number of packets |handle| can send now
+  uint16_t GetCredits(uint16_t handle) const;
+
+  // Returns the handles of the links which have credits, in the order they should be offered to send a packet
+  std::vector<uint16_t> GetSendOrder() const;
+
+  // Starts or continues the turn of |handle| for one packet of the upper layer, fragmented or not
+  void OnPacketScheduled(uint16_t handle);
+
+  // Takes one credit of |handle|, for each fragment sent to the controller
+  void OnFragmentSent(uint16_t handle);
+
+  // Returns the credits of |packets| to the pool of |handle|. Returns false if |handle| is unknown.
+  bool OnPacketsCompleted(uint16_t handle, uint16_t packets);
+
+ private:
+  struct Pool {
+    uint16_t credits;
+    uint16_t max_credits;
+  };
+
+  struct Link {
+    Pool* pool;
+    AclPriority priority = AclPriority::NORMAL;
+    // Packets sent to the controller that have not been completed yet
+    uint16_t sent = 0;
+  };
+
+  uint16_t GetWeight(const Link& link) const;
+
+  Pool classic_pool_;
+  Pool le_pool_;
+  bool has_le_pool_;
+  std::map<uint16_t, Link> links_;
+  // The link the current turn belongs to, and the packets it scheduled since
+  uint16_t turn_handle_ = kNoHandle;
+  uint16_t turn_packets_ = 0;
+
+  static constexpr uint16_t kNoHandle = 0xffff;
+};
+
+}  // namespace hci
+}  // namespace bluetooth
@@ -0,0 +1,104 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hci/acl_scheduler.h"
+
+#include <gtest/gtest.h>
+
+using std::vector;
+
+namespace bluetooth {
+namespace hci {
+namespace {
+
+constexpr uint16_t kClassicHandle1 = 0x01;
+constexpr uint16_t kClassicHandle2 = 0x02;
+constexpr uint16_t kLeHandle = 0x40;
+
+// Schedules one single fragment packet of the first link in the send order, and returns its handle
+uint16_t SendNext(AclScheduler* scheduler) {
+  auto order = scheduler->GetSendOrder();
+  EXPECT_FALSE(order.empty());
+  scheduler->OnPacketScheduled(order.front());
+  scheduler->OnFragmentSent(order.front());
+  return order.front();
+}
+
+TEST(AclSchedulerTest, round_robin) {
+  AclScheduler scheduler(10, 0);
+  scheduler.AddConnection(kClassicHandle1, false);
+  scheduler.AddConnection(kClassicHandle2, false);
+  EXPECT_EQ(SendNext(&scheduler), kClassicHandle1);
+  EXPECT_EQ(SendNext(&scheduler), kClassicHandle2);
+  EXPECT_EQ(SendNext(&scheduler), kClassicHandle1);
+  EXPECT_EQ(scheduler.GetSendOrder(), (vector<uint16_t>{kClassicHandle2, kClassicHandle1}));
+}
+
+TEST(AclSchedulerTest, high_priority_link_sends_more_per_turn) {
+  AclScheduler scheduler(10, 0);
+  scheduler.AddConnection(kClassicHandle1, false);
+  scheduler.AddConnection(kClassicHandle2, false);
+  scheduler.SetPriority(kClassicHandle2, AclPriority::HIGH);
+  vector<uint16_t> sent;
+  for (int i = 0; i < 6; i++) {
+    sent.push_back(SendNext(&scheduler));
+  }
+  EXPECT_EQ(sent, (vector<uint16_t>{kClassicHandle1, kClassicHandle2, kClassicHandle2, kClassicHandle1,
+                                    kClassicHandle2, kClassicHandle2}));
+}
+
+TEST(AclSchedulerTest, le_shares_classic_credits_without_le_buffers) {
+  AclScheduler scheduler(2, 0);
+  scheduler.AddConnection(kClassicHandle1, false);
+  scheduler.AddConnection(kLeHandle, true);
+  SendNext(&scheduler);
+  SendNext(&scheduler);
+  EXPECT_EQ(scheduler.GetCredits(kLeHandle), 0);
+  EXPECT_TRUE(scheduler.GetSendOrder().empty());
+  EXPECT_TRUE(scheduler.OnPacketsCompleted(kLeHandle, 1));
+  EXPECT_EQ(scheduler.GetCredits(kClassicHandle1), 1);
+}
+
+TEST(AclSchedulerTest, separate_le_credits) {
+  AclScheduler scheduler(1, 1);
+  scheduler.AddConnection(kClassicHandle1, false);
+  scheduler.AddConnection(kLeHandle, true);
+  EXPECT_EQ(SendNext(&scheduler), kClassicHandle1);
+  // The classic pool is empty, the LE link still has its own credit
+  EXPECT_EQ(scheduler.GetSendOrder(), (vector<uint16_t>{kLeHandle}));
+  EXPECT_EQ(SendNext(&scheduler), kLeHandle);
+  EXPECT_TRUE(scheduler.GetSendOrder().empty());
+  EXPECT_TRUE(scheduler.OnPacketsCompleted(kClassicHandle1, 1));
+  EXPECT_EQ(scheduler.GetSendOrder(), (vector<uint16_t>{kClassicHandle1}));
+}
+
+TEST(AclSchedulerTest, remove_connection_reclaims_credits) {
+  AclScheduler scheduler(2, 0);
+  scheduler.AddConnection(kClassicHandle1, false);
+  scheduler.AddConnection(kClassicHandle2, false);
+  scheduler.OnPacketScheduled(kClassicHandle1);
+  scheduler.OnFragmentSent(kClassicHandle1);
+  scheduler.OnFragmentSent(kClassicHandle1);
+  EXPECT_EQ(scheduler.GetCredits(kClassicHandle2), 0);
+  scheduler.RemoveConnection(kClassicHandle1);
+  EXPECT_EQ(scheduler.GetCredits(kClassicHandle2), 2);
+  EXPECT_FALSE(scheduler.OnPacketsCompleted(kClassicHandle1, 2));
+  EXPECT_EQ(scheduler.GetSendOrder(), (vector<uint16_t>{kClassicHandle2}));
+}
+
+}  // namespace
+}  // namespace hci
+}  // namespace bluetooth
@@ -16,8 +16,11 @@
 
 #include "hci/controller.h"
 
+#include <atomic>
 #include <future>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <utility>
 
 #include "common/bind.h"
@@ -35,6 +38,39 @@ using common::OnceCallback;
 using common::OnceClosure;
 using os::Handler;
 
+namespace {
+
+// What the controller reports about itself, which only changes together with its firmware
+struct ControllerCapabilities {
+  LocalVersionInformation local_version_information_;
+  std::array<uint8_t, 64> local_supported_commands_;
+  uint64_t local_supported_features_;
+  uint8_t maximum_page_number_;
+  std::vector<uint64_t> extended_lmp_features_array_;
+  uint16_t acl_buffer_length_ = 0;
+  uint16_t acl_buffers_ = 0;
+  uint8_t sco_buffer_length_ = 0;
+  uint16_t sco_buffers_ = 0;
+  LeBufferSize le_buffer_size_;
+  uint64_t le_local_supported_features_;
+  uint64_t le_supported_states_;
+  LeMaximumDataLength le_maximum_data_length_;
+  uint16_t le_maximum_advertising_data_length_;
+  uint8_t le_number_supported_advertising_sets_;
+  VendorCapabilities vendor_capabilities_;
+};
+
+// Kept across restarts of the stack, so that only the volatile state is read again from the same controller
+std::mutex cached_capabilities_mutex;
+std::optional<ControllerCapabilities> cached_capabilities;
+
+bool is_same_firmware(const LocalVersionInformation& a, const LocalVersionInformation& b) {
+  return a.hci_version_ == b.hci_version_ && a.hci_revision_ == b.hci_revision_ && a.lmp_version_ == b.lmp_version_ &&
+         a.manufacturer_name_ == b.manufacturer_name_ && a.lmp_subversion_ == b.lmp_subversion_;
+}
+
+}  // namespace
+
 struct Controller::impl {
   impl(Controller& module) : module_(module) {}
 
@@ -44,79 +80,49 @@ struct Controller::impl {
                                Bind(&Controller::impl::NumberOfCompletedPackets, common::Unretained(this)),
                                module_.GetHandler());
 
+    // The volatile state is read on every start, together with the version that identifies the firmware
     set_event_mask(kDefaultEventMask);
-    hci_->EnqueueCommand(ReadLocalNameBuilder::Create(),
-                         BindOnce(&Controller::impl::read_local_name_complete_handler, common::Unretained(this)),
-                         module_.GetHandler());
-    hci_->EnqueueCommand(
-        ReadLocalVersionInformationBuilder::Create(),
-        BindOnce(&Controller::impl::read_local_version_information_complete_handler, common::Unretained(this)),
-        module_.GetHandler());
-    hci_->EnqueueCommand(
-        ReadLocalSupportedCommandsBuilder::Create(),
-        BindOnce(&Controller::impl::read_local_supported_commands_complete_handler, common::Unretained(this)),
-        module_.GetHandler());
-    hci_->EnqueueCommand(
-        ReadLocalSupportedFeaturesBuilder::Create(),
-        BindOnce(&Controller::impl::read_local_supported_features_complete_handler, common::Unretained(this)),
-        module_.GetHandler());
-
-    // Wait for all extended features read
-    std::promise<void> features_promise;
-    auto features_future = features_promise.get_future();
-    hci_->EnqueueCommand(ReadLocalExtendedFeaturesBuilder::Create(0x00),
-                         BindOnce(&Controller::impl::read_local_extended_features_complete_handler,
-                                  common::Unretained(this), std::move(features_promise)),
-                         module_.GetHandler());
-    features_future.wait();
-
-    hci_->EnqueueCommand(ReadBufferSizeBuilder::Create(),
-                         BindOnce(&Controller::impl::read_buffer_size_complete_handler, common::Unretained(this)),
-                         module_.GetHandler());
-
-    hci_->EnqueueCommand(LeReadBufferSizeBuilder::Create(),
-                         BindOnce(&Controller::impl::le_read_buffer_size_handler, common::Unretained(this)),
-                         module_.GetHandler());
-
-    hci_->EnqueueCommand(
-        LeReadLocalSupportedFeaturesBuilder::Create(),
-        BindOnce(&Controller::impl::le_read_local_supported_features_handler, common::Unretained(this)),
-        module_.GetHandler());
-
-    hci_->EnqueueCommand(LeReadSupportedStatesBuilder::Create(),
-                         BindOnce(&Controller::impl::le_read_supported_states_handler, common::Unretained(this)),
-                         module_.GetHandler());
+    enqueue_read(ReadLocalNameBuilder::Create(), &Controller::impl::read_local_name_complete_handler);
+    enqueue_read(ReadLocalVersionInformationBuilder::Create(),
+                 &Controller::impl::read_local_version_information_complete_handler);
+    enqueue_read(ReadBdAddrBuilder::Create(), &Controller::impl::read_controller_mac_address_handler);
+    wait_for_reads();
+
+    if (load_cached_capabilities()) {
+      LOG_INFO("Using the cached capabilities of the controller");
+      return;
+    }
 
+    // All of these are in flight together, HciLayer sends them as fast as the controller takes commands
+    enqueue_read(ReadLocalSupportedCommandsBuilder::Create(),
+                 &Controller::impl::read_local_supported_commands_complete_handler);
+    enqueue_read(ReadLocalSupportedFeaturesBuilder::Create(),
+                 &Controller::impl::read_local_supported_features_complete_handler);
+    enqueue_read(ReadLocalExtendedFeaturesBuilder::Create(0x00),
+                 &Controller::impl::read_local_extended_features_complete_handler);
+    enqueue_read(ReadBufferSizeBuilder::Create(), &Controller::impl::read_buffer_size_complete_handler);
+    enqueue_read(LeReadBufferSizeBuilder::Create(), &Controller::impl::le_read_buffer_size_handler);
+    enqueue_read(LeReadLocalSupportedFeaturesBuilder::Create(),
+                 &Controller::impl::le_read_local_supported_features_handler);
+    enqueue_read(LeReadSupportedStatesBuilder::Create(), &Controller::impl::le_read_supported_states_handler);
+    enqueue_read(LeGetVendorCapabilitiesBuilder::Create(), &Controller::impl::le_get_vendor_capabilities_handler);
+    wait_for_reads();
+
+    // These depend on the supported commands
     if (is_supported(OpCode::LE_READ_MAXIMUM_DATA_LENGTH)) {
-      hci_->EnqueueCommand(LeReadMaximumDataLengthBuilder::Create(),
-                           BindOnce(&Controller::impl::le_read_maximum_data_length_handler, common::Unretained(this)),
-                           module_.GetHandler());
+      enqueue_read(LeReadMaximumDataLengthBuilder::Create(), &Controller::impl::le_read_maximum_data_length_handler);
     }
     if (is_supported(OpCode::LE_READ_MAXIMUM_ADVERTISING_DATA_LENGTH)) {
-      hci_->EnqueueCommand(
-          LeReadMaximumAdvertisingDataLengthBuilder::Create(),
-          BindOnce(&Controller::impl::le_read_maximum_advertising_data_length_handler, common::Unretained(this)),
-          module_.GetHandler());
+      enqueue_read(LeReadMaximumAdvertisingDataLengthBuilder::Create(),
+                   &Controller::impl::le_read_maximum_advertising_data_length_handler);
     }
     if (is_supported(OpCode::LE_READ_NUMBER_OF_SUPPORTED_ADVERTISING_SETS)) {
-      hci_->EnqueueCommand(
-          LeReadNumberOfSupportedAdvertisingSetsBuilder::Create(),
-          BindOnce(&Controller::impl::le_read_number_of_supported_advertising_sets_handler, common::Unretained(this)),
-          module_.GetHandler());
+      enqueue_read(LeReadNumberOfSupportedAdvertisingSetsBuilder::Create(),
+                   &Controller::impl::le_read_number_of_supported_advertising_sets_handler);
     }
+    wait_for_reads();
 
-    hci_->EnqueueCommand(LeGetVendorCapabilitiesBuilder::Create(),
-                         BindOnce(&Controller::impl::le_get_vendor_capabilities_handler, common::Unretained(this)),
-                         module_.GetHandler());
-
-    // We only need to synchronize the last read. Make BD_ADDR to be the last one.
-    std::promise<void> promise;
-    auto future = promise.get_future();
-    hci_->EnqueueCommand(
-        ReadBdAddrBuilder::Create(),
-        BindOnce(&Controller::impl::read_controller_mac_address_handler, common::Unretained(this), std::move(promise)),
-        module_.GetHandler());
-    future.wait();
+    store_cached_capabilities();
   }
 
   void Stop() {
@@ -124,6 +130,50 @@ struct Controller::impl {
     hci_ = nullptr;
   }
 
+  using ReadCompleteHandler = void (Controller::impl::*)(CommandCompleteView);
+
+  void enqueue_read(std::unique_ptr<CommandPacketBuilder> command, ReadCompleteHandler handler) {
+    pending_reads_++;
+    hci_->EnqueueCommand(std::move(command),
+                         BindOnce(&Controller::impl::on_read_complete, common::Unretained(this), handler),
+                         module_.GetHandler());
+  }
+
+  void on_read_complete(ReadCompleteHandler handler, CommandCompleteView view) {
+    (this->*handler)(std::move(view));
+    read_done();
+  }
+
+  void read_done() {
+    if (--pending_reads_ == 0) {
+      reads_promise_.set_value();
+    }
+  }
+
+  // Waits for the reads enqueued so far, including the ones their handlers enqueued
+  void wait_for_reads() {
+    auto future = reads_promise_.get_future();
+    read_done();
+    future.wait();
+    reads_promise_ = std::promise<void>();
+    pending_reads_ = 1;
+  }
+
+  bool load_cached_capabilities() {
+    std::lock_guard<std::mutex> lock(cached_capabilities_mutex);
+    if (!cached_capabilities.has_value() || !is_same_firmware(cached_capabilities->local_version_information_,
+                                                              capabilities_.local_version_information_)) {
+      return false;
+    }
+    capabilities_ = *cached_capabilities;
+    return true;
+  }
+
+  void store_cached_capabilities() {
+    std::lock_guard<std::mutex> lock(cached_capabilities_mutex);
+    cached_capabilities = capabilities_;
+  }
+
   void NumberOfCompletedPackets(EventPacketView event) {
     ASSERT(acl_credits_handler_ != nullptr);
     auto complete_view = NumberOfCompletedPacketsView::Create(event);
@@ -160,7 +210,7 @@ struct Controller::impl {
     ErrorCode status = complete_view.GetStatus();
     ASSERT_LOG(status == ErrorCode::SUCCESS, "Status 0x%02hhx, %s", status, ErrorCodeText(status).c_str());
 
-    local_version_information_ = complete_view.GetLocalVersionInformation();
+    capabilities_.local_version_information_ = complete_view.GetLocalVersionInformation();
   }
 
   void read_local_supported_commands_complete_handler(CommandCompleteView view) {
@@ -168,7 +218,7 @@ struct Controller::impl {
     ASSERT(complete_view.IsValid());
     ErrorCode status = complete_view.GetStatus();
     ASSERT_LOG(status == ErrorCode::SUCCESS, "Status 0x%02hhx, %s", status, ErrorCodeText(status).c_str());
-    local_supported_commands_ = complete_view.GetSupportedCommands();
+    capabilities_.local_supported_commands_ = complete_view.GetSupportedCommands();
   }
 
   void read_local_supported_features_complete_handler(CommandCompleteView view) {
@@ -176,27 +226,23 @@ struct Controller::impl {
     ASSERT(complete_view.IsValid());
     ErrorCode status = complete_view.GetStatus();
     ASSERT_LOG(status == ErrorCode::SUCCESS, "Status 0x%02hhx, %s", status, ErrorCodeText(status).c_str());
-    local_supported_features_ = complete_view.GetLmpFeatures();
+    capabilities_.local_supported_features_ = complete_view.GetLmpFeatures();
   }
 
-  void read_local_extended_features_complete_handler(std::promise<void> promise, CommandCompleteView view) {
+  void read_local_extended_features_complete_handler(CommandCompleteView view) {
     auto complete_view = ReadLocalExtendedFeaturesCompleteView::Create(view);
     ASSERT(complete_view.IsValid());
     ErrorCode status = complete_view.GetStatus();
     ASSERT_LOG(status == ErrorCode::SUCCESS, "Status 0x%02hhx, %s", status, ErrorCodeText(status).c_str());
     uint8_t page_number = complete_view.GetPageNumber();
-    maximum_page_number_ = complete_view.GetMaximumPageNumber();
-    extended_lmp_features_array_.push_back(complete_view.GetExtendedLmpFeatures());
+    capabilities_.maximum_page_number_ = complete_view.GetMaximumPageNumber();
+    capabilities_.extended_lmp_features_array_.push_back(complete_view.GetExtendedLmpFeatures());
 
-    // Query all extended features
-    if (page_number < maximum_page_number_) {
+    // Query all extended features, one page at a time as they share an opcode
+    if (page_number < capabilities_.maximum_page_number_) {
       page_number++;
-      hci_->EnqueueCommand(ReadLocalExtendedFeaturesBuilder::Create(page_number),
-                           BindOnce(&Controller::impl::read_local_extended_features_complete_handler,
-                                    common::Unretained(this), std::move(promise)),
-                           module_.GetHandler());
-    } else {
-      promise.set_value();
+      enqueue_read(ReadLocalExtendedFeaturesBuilder::Create(page_number),
+                   &Controller::impl::read_local_extended_features_complete_handler);
     }
   }
 
@@ -205,20 +251,19 @@ struct Controller::impl {
     ASSERT(complete_view.IsValid());
     ErrorCode status = complete_view.GetStatus();
     ASSERT_LOG(status == ErrorCode::SUCCESS, "Status 0x%02hhx, %s", status, ErrorCodeText(status).c_str());
-    acl_buffer_length_ = complete_view.GetAclDataPacketLength();
-    acl_buffers_ = complete_view.GetTotalNumAclDataPackets();
+    capabilities_.acl_buffer_length_ = complete_view.GetAclDataPacketLength();
+    capabilities_.acl_buffers_ = complete_view.GetTotalNumAclDataPackets();
 
-    sco_buffer_length_ = complete_view.GetSynchronousDataPacketLength();
-    sco_buffers_ = complete_view.GetTotalNumSynchronousDataPackets();
+    capabilities_.sco_buffer_length_ = complete_view.GetSynchronousDataPacketLength();
+    capabilities_.sco_buffers_ = complete_view.GetTotalNumSynchronousDataPackets();
   }
 
-  void read_controller_mac_address_handler(std::promise<void> promise, CommandCompleteView view) {
+  void read_controller_mac_address_handler(CommandCompleteView view) {
     auto complete_view = ReadBdAddrCompleteView::Create(view);
     ASSERT(complete_view.IsValid());
     ErrorCode status = complete_view.GetStatus();
     ASSERT_LOG(status == ErrorCode::SUCCESS, "Status 0x%02hhx, %s", status, ErrorCodeText(status).c_str());
     mac_address_ = complete_view.GetBdAddr();
-    promise.set_value();
   }
 
   void le_read_buffer_size_handler(CommandCompleteView view) {
@@ -226,7 +271,7 @@ struct Controller::impl {
     ASSERT(complete_view.IsValid());
     ErrorCode status = complete_view.GetStatus();
     ASSERT_LOG(status == ErrorCode::SUCCESS, "Status 0x%02hhx, %s", status, ErrorCodeText(status).c_str());
-    le_buffer_size_ = complete_view.GetLeBufferSize();
+    capabilities_.le_buffer_size_ = complete_view.GetLeBufferSize();
   }
 
   void le_read_local_supported_features_handler(CommandCompleteView view) {
@@ -234,7 +279,7 @@ struct Controller::impl {
     ASSERT(complete_view.IsValid());
     ErrorCode status = complete_view.GetStatus();
     ASSERT_LOG(status == ErrorCode::SUCCESS, "Status 0x%02hhx, %s", status, ErrorCodeText(status).c_str());
-    le_local_supported_features_ = complete_view.GetLeFeatures();
+    capabilities_.le_local_supported_features_ = complete_view.GetLeFeatures();
   }
 
   void le_read_supported_states_handler(CommandCompleteView view) {
@@ -242,7 +287,7 @@ struct Controller::impl {
     ASSERT(complete_view.IsValid());
     ErrorCode status = complete_view.GetStatus();
     ASSERT_LOG(status == ErrorCode::SUCCESS, "Status 0x%02hhx, %s", status, ErrorCodeText(status).c_str());
-    le_supported_states_ = complete_view.GetLeStates();
+    capabilities_.le_supported_states_ = complete_view.GetLeStates();
   }
 
   void le_read_maximum_data_length_handler(CommandCompleteView view) {
@@ -250,7 +295,7 @@ struct Controller::impl {
     ASSERT(complete_view.IsValid());
     ErrorCode status = complete_view.GetStatus();
     ASSERT_LOG(status == ErrorCode::SUCCESS, "Status 0x%02hhx, %s", status, ErrorCodeText(status).c_str());
-    le_maximum_data_length_ = complete_view.GetLeMaximumDataLength();
+    capabilities_.le_maximum_data_length_ = complete_view.GetLeMaximumDataLength();
   }
 
   void le_read_maximum_advertising_data_length_handler(CommandCompleteView view) {
@@ -258,7 +303,7 @@ struct Controller::impl {
     ASSERT(complete_view.IsValid());
     ErrorCode status = complete_view.GetStatus();
     ASSERT_LOG(status == ErrorCode::SUCCESS, "Status 0x%02hhx, %s", status, ErrorCodeText(status).c_str());
-    le_maximum_advertising_data_length_ = complete_view.GetMaximumAdvertisingDataLength();
+    capabilities_.le_maximum_advertising_data_length_ = complete_view.GetMaximumAdvertisingDataLength();
   }
 
   void le_read_number_of_supported_advertising_sets_handler(CommandCompleteView view) {
@@ -266,44 +311,45 @@ struct Controller::impl {
     ASSERT(complete_view.IsValid());
     ErrorCode status = complete_view.GetStatus();
     ASSERT_LOG(status == ErrorCode::SUCCESS, "Status 0x%02hhx, %s", status, ErrorCodeText(status).c_str());
-    le_number_supported_advertising_sets_ = complete_view.GetNumberSupportedAdvertisingSets();
+    capabilities_.le_number_supported_advertising_sets_ = complete_view.GetNumberSupportedAdvertisingSets();
   }
 
   void le_get_vendor_capabilities_handler(CommandCompleteView view) {
     auto complete_view = LeGetVendorCapabilitiesCompleteView::Create(view);
-
-    vendor_capabilities_.is_supported_ = 0x00;
-    vendor_capabilities_.max_advt_instances_ = 0x00;
-    vendor_capabilities_.offloaded_resolution_of_private_address_ = 0x00;
-    vendor_capabilities_.total_scan_results_storage_ = 0x00;
-    vendor_capabilities_.max_irk_list_sz_ = 0x00;
-    vendor_capabilities_.filtering_support_ = 0x00;
-    vendor_capabilities_.max_filter_ = 0x00;
-    vendor_capabilities_.activity_energy_info_support_ = 0x00;
-    vendor_capabilities_.version_supported_ = 0x00;
-    vendor_capabilities_.version_supported_ = 0x00;
-    vendor_capabilities_.total_num_of_advt_tracked_ = 0x00;
-    vendor_capabilities_.extended_scan_support_ = 0x00;
-    vendor_capabilities_.debug_logging_supported_ = 0x00;
-    vendor_capabilities_.le_address_generation_offloading_support_ = 0x00;
-    vendor_capabilities_.a2dp_source_offload_capability_mask_ = 0x00;
-    vendor_capabilities_.bluetooth_quality_report_support_ = 0x00;
+    auto& vendor_capabilities = capabilities_.vendor_capabilities_;
+
+    vendor_capabilities.is_supported_ = 0x00;
+    vendor_capabilities.max_advt_instances_ = 0x00;
+    vendor_capabilities.offloaded_resolution_of_private_address_ = 0x00;
+    vendor_capabilities.total_scan_results_storage_ = 0x00;
+    vendor_capabilities.max_irk_list_sz_ = 0x00;
+    vendor_capabilities.filtering_support_ = 0x00;
+    vendor_capabilities.max_filter_ = 0x00;
+    vendor_capabilities.activity_energy_info_support_ = 0x00;
+    vendor_capabilities.version_supported_ = 0x00;
+    vendor_capabilities.version_supported_ = 0x00;
+    vendor_capabilities.total_num_of_advt_tracked_ = 0x00;
+    vendor_capabilities.extended_scan_support_ = 0x00;
+    vendor_capabilities.debug_logging_supported_ = 0x00;
+    vendor_capabilities.le_address_generation_offloading_support_ = 0x00;
+    vendor_capabilities.a2dp_source_offload_capability_mask_ = 0x00;
+    vendor_capabilities.bluetooth_quality_report_support_ = 0x00;
 
     if (complete_view.IsValid()) {
-      vendor_capabilities_.is_supported_ = 0x01;
+      vendor_capabilities.is_supported_ = 0x01;
 
       // v0.55
       BaseVendorCapabilities base_vendor_capabilities = complete_view.GetBaseVendorCapabilities();
-      vendor_capabilities_.max_advt_instances_ = base_vendor_capabilities.max_advt_instances_;
-      vendor_capabilities_.offloaded_resolution_of_private_address_ =
+      vendor_capabilities.max_advt_instances_ = base_vendor_capabilities.max_advt_instances_;
+      vendor_capabilities.offloaded_resolution_of_private_address_ =
           base_vendor_capabilities.offloaded_resolution_of_private_address_;
-      vendor_capabilities_.total_scan_results_storage_ = base_vendor_capabilities.total_scan_results_storage_;
-      vendor_capabilities_.max_irk_list_sz_ = base_vendor_capabilities.max_irk_list_sz_;
-      vendor_capabilities_.filtering_support_ = base_vendor_capabilities.filtering_support_;
-      vendor_capabilities_.max_filter_ = base_vendor_capabilities.max_filter_;
-      vendor_capabilities_.activity_energy_info_support_ = base_vendor_capabilities.activity_energy_info_support_;
+      vendor_capabilities.total_scan_results_storage_ = base_vendor_capabilities.total_scan_results_storage_;
+      vendor_capabilities.max_irk_list_sz_ = base_vendor_capabilities.max_irk_list_sz_;
+      vendor_capabilities.filtering_support_ = base_vendor_capabilities.filtering_support_;
+      vendor_capabilities.max_filter_ = base_vendor_capabilities.max_filter_;
+      vendor_capabilities.activity_energy_info_support_ = base_vendor_capabilities.activity_energy_info_support_;
       if (complete_view.GetPayload().size() == 0) {
-        vendor_capabilities_.version_supported_ = 55;
+        vendor_capabilities.version_supported_ = 55;
         return;
       }
 
@@ -313,11 +359,11 @@ struct Controller::impl {
         LOG_ERROR("invalid data for hci requirements v0.95");
         return;
       }
-      vendor_capabilities_.version_supported_ = v95.GetVersionSupported();
-      vendor_capabilities_.total_num_of_advt_tracked_ = v95.GetTotalNumOfAdvtTracked();
-      vendor_capabilities_.extended_scan_support_ = v95.GetExtendedScanSupport();
-      vendor_capabilities_.debug_logging_supported_ = v95.GetDebugLoggingSupported();
-      if (vendor_capabilities_.version_supported_ <= 95 || complete_view.GetPayload().size() == 0) {
+      vendor_capabilities.version_supported_ = v95.GetVersionSupported();
+      vendor_capabilities.total_num_of_advt_tracked_ = v95.GetTotalNumOfAdvtTracked();
+      vendor_capabilities.extended_scan_support_ = v95.GetExtendedScanSupport();
+      vendor_capabilities.debug_logging_supported_ = v95.GetDebugLoggingSupported();
+      if (vendor_capabilities.version_supported_ <= 95 || complete_view.GetPayload().size() == 0) {
         return;
       }
 
@@ -327,8 +373,8 @@ struct Controller::impl {
         LOG_ERROR("invalid data for hci requirements v0.96");
         return;
       }
-      vendor_capabilities_.le_address_generation_offloading_support_ = v96.GetLeAddressGenerationOffloadingSupport();
-      if (vendor_capabilities_.version_supported_ <= 96 || complete_view.GetPayload().size() == 0) {
+      vendor_capabilities.le_address_generation_offloading_support_ = v96.GetLeAddressGenerationOffloadingSupport();
+      if (vendor_capabilities.version_supported_ <= 96 || complete_view.GetPayload().size() == 0) {
         return;
       }
 
@@ -338,8 +384,8 @@ struct Controller::impl {
         LOG_ERROR("invalid data for hci requirements v0.98");
         return;
       }
-      vendor_capabilities_.a2dp_source_offload_capability_mask_ = v98.GetA2dpSourceOffloadCapabilityMask();
-      vendor_capabilities_.bluetooth_quality_report_support_ = v98.GetBluetoothQualityReportSupport();
+      vendor_capabilities.a2dp_source_offload_capability_mask_ = v98.GetA2dpSourceOffloadCapabilityMask();
+      vendor_capabilities.bluetooth_quality_report_support_ = v98.GetBluetoothQualityReportSupport();
     }
   }
 
@@ -410,7 +456,7 @@ struct Controller::impl {
     uint16_t index = (uint16_t)OpCodeIndex::name;                              \
     uint16_t byte_index = index / 10;                                          \
     uint16_t bit_index = index % 10;                                           \
-    bool supported = local_supported_commands_[byte_index] & (1 << bit_index); \
+    bool supported = capabilities_.local_supported_commands_[byte_index] & (1 << bit_index); \
     if (!supported) {                                                          \
       LOG_WARN("unsupported command opcode: 0x%04x", (uint16_t)OpCode::name);  \
     }                                                                          \
@@ -635,26 +681,26 @@ struct Controller::impl {
       OP_CODE_MAPPING(LE_GENERATE_DHKEY_COMMAND)
       // vendor specific
       case OpCode::LE_GET_VENDOR_CAPABILITIES:
-        return vendor_capabilities_.is_supported_ == 0x01;
+        return capabilities_.vendor_capabilities_.is_supported_ == 0x01;
       case OpCode::LE_MULTI_ADVT:
-        return vendor_capabilities_.max_advt_instances_ != 0x00;
+        return capabilities_.vendor_capabilities_.max_advt_instances_ != 0x00;
       case OpCode::LE_BATCH_SCAN:
-        return vendor_capabilities_.total_scan_results_storage_ != 0x00;
+        return capabilities_.vendor_capabilities_.total_scan_results_storage_ != 0x00;
       case OpCode::LE_ADV_FILTER:
-        return vendor_capabilities_.filtering_support_ == 0x01;
+        return capabilities_.vendor_capabilities_.filtering_support_ == 0x01;
       case OpCode::LE_TRACK_ADV:
-        return vendor_capabilities_.total_num_of_advt_tracked_ > 0;
+        return capabilities_.vendor_capabilities_.total_num_of_advt_tracked_ > 0;
       case OpCode::LE_ENERGY_INFO:
-        return vendor_capabilities_.activity_energy_info_support_ == 0x01;
+        return capabilities_.vendor_capabilities_.activity_energy_info_support_ == 0x01;
       case OpCode::LE_EXTENDED_SCAN_PARAMS:
-        return vendor_capabilities_.extended_scan_support_ == 0x01;
+        return capabilities_.vendor_capabilities_.extended_scan_support_ == 0x01;
       case OpCode::CONTROLLER_DEBUG_INFO:
-        return vendor_capabilities_.debug_logging_supported_ == 0x01;
+        return capabilities_.vendor_capabilities_.debug_logging_supported_ == 0x01;
       case OpCode::CONTROLLER_A2DP_OPCODE:
-        return vendor_capabilities_.a2dp_source_offload_capability_mask_ != 0x00;
+        return capabilities_.vendor_capabilities_.a2dp_source_offload_capability_mask_ != 0x00;
       case OpCode::CONTROLLER_BQR:
-        return vendor_capabilities_.bluetooth_quality_report_support_ == 0x01;
-      // undefined in local_supported_commands_
+        return capabilities_.vendor_capabilities_.bluetooth_quality_report_support_ == 0x01;
+      // undefined in capabilities_.local_supported_commands_
       case OpCode::CREATE_NEW_UNIT_KEY:
       case OpCode::READ_LOCAL_SUPPORTED_COMMANDS:
         return true;
@@ -671,24 +717,12 @@ struct Controller::impl {
 
   Callback<void(uint16_t, uint16_t)> acl_credits_callback_;
   Handler* acl_credits_handler_ = nullptr;
-  LocalVersionInformation local_version_information_;
-  std::array<uint8_t, 64> local_supported_commands_;
-  uint64_t local_supported_features_;
-  uint8_t maximum_page_number_;
-  std::vector<uint64_t> extended_lmp_features_array_;
-  uint16_t acl_buffer_length_ = 0;
-  uint16_t acl_buffers_ = 0;
-  uint8_t sco_buffer_length_ = 0;
-  uint16_t sco_buffers_ = 0;
+  ControllerCapabilities capabilities_;
   Address mac_address_;
   std::string local_name_;
-  LeBufferSize le_buffer_size_;
-  uint64_t le_local_supported_features_;
-  uint64_t le_supported_states_;
-  LeMaximumDataLength le_maximum_data_length_;
-  uint16_t le_maximum_advertising_data_length_;
-  uint8_t le_number_supported_advertising_sets_;
-  VendorCapabilities vendor_capabilities_;
+  // Reads in flight, plus one until Start() waits for them
+  std::atomic<int> pending_reads_{1};
+  std::promise<void> reads_promise_;
 };  // namespace hci
 
 Controller::Controller() : impl_(std::make_unique<impl>(*this)) {}
@@ -705,42 +739,42 @@ std::string Controller::GetControllerLocalName() const {
 }
 
 LocalVersionInformation Controller::GetControllerLocalVersionInformation() const {
-  return impl_->local_version_information_;
+  return impl_->capabilities_.local_version_information_;
 }
 
 std::array<uint8_t, 64> Controller::GetControllerLocalSupportedCommands() const {
-  return impl_->local_supported_commands_;
+  return impl_->capabilities_.local_supported_commands_;
 }
 
 uint8_t Controller::GetControllerLocalExtendedFeaturesMaxPageNumber() const {
-  return impl_->maximum_page_number_;
+  return impl_->capabilities_.maximum_page_number_;
 }
 
 uint64_t Controller::GetControllerLocalSupportedFeatures() const {
-  return impl_->local_supported_features_;
+  return impl_->capabilities_.local_supported_features_;
 }
 
 uint64_t Controller::GetControllerLocalExtendedFeatures(uint8_t page_number) const {
-  if (page_number <= impl_->maximum_page_number_) {
-    return impl_->extended_lmp_features_array_[page_number];
+  if (page_number <= impl_->capabilities_.maximum_page_number_) {
+    return impl_->capabilities_.extended_lmp_features_array_[page_number];
   }
   return 0x00;
 }
 
 uint16_t Controller::GetControllerAclPacketLength() const {
-  return impl_->acl_buffer_length_;
+  return impl_->capabilities_.acl_buffer_length_;
 }
 
 uint16_t Controller::GetControllerNumAclPacketBuffers() const {
-  return impl_->acl_buffers_;
+  return impl_->capabilities_.acl_buffers_;
 }
 
 uint8_t Controller::GetControllerScoPacketLength() const {
-  return impl_->sco_buffer_length_;
+  return impl_->capabilities_.sco_buffer_length_;
 }
 
 uint16_t Controller::GetControllerNumScoPacketBuffers() const {
-  return impl_->sco_buffers_;
+  return impl_->capabilities_.sco_buffers_;
 }
 
 Address Controller::GetControllerMacAddress() const {
@@ -818,37 +852,42 @@ void Controller::LeSetEventMask(uint64_t le_event_mask) {
 }
 
 LeBufferSize Controller::GetControllerLeBufferSize() const {
-  return impl_->le_buffer_size_;
+  return impl_->capabilities_.le_buffer_size_;
 }
 
 uint64_t Controller::GetControllerLeLocalSupportedFeatures() const {
-  return impl_->le_local_supported_features_;
+  return impl_->capabilities_.le_local_supported_features_;
 }
 
 uint64_t Controller::GetControllerLeSupportedStates() const {
-  return impl_->le_supported_states_;
+  return impl_->capabilities_.le_supported_states_;
 }
 
 LeMaximumDataLength Controller::GetControllerLeMaximumDataLength() const {
-  return impl_->le_maximum_data_length_;
+  return impl_->capabilities_.le_maximum_data_length_;
 }
 
 uint16_t Controller::GetControllerLeMaximumAdvertisingDataLength() const {
-  return impl_->le_maximum_advertising_data_length_;
+  return impl_->capabilities_.le_maximum_advertising_data_length_;
 }
 
 uint8_t Controller::GetControllerLeNumberOfSupportedAdverisingSets() const {
-  return impl_->le_number_supported_advertising_sets_;
+  return impl_->capabilities_.le_number_supported_advertising_sets_;
 }
 
 VendorCapabilities Controller::GetControllerVendorCapabilities() const {
-  return impl_->vendor_capabilities_;
+  return impl_->capabilities_.vendor_capabilities_;
 }
 
 bool Controller::IsSupported(bluetooth::hci::OpCode op_code) const {
   return impl_->is_supported(op_code);
 }
 
+void Controller::ClearCachedCapabilities() {
+  std::lock_guard<std::mutex> lock(cached_capabilities_mutex);
+  cached_capabilities.reset();
+}
+
 const ModuleFactory Controller::Factory = ModuleFactory([]() { return new Controller(); });
 
 void Controller::ListDependencies(ModuleList* list) {
@@ -102,6 +102,10 @@ class Controller : public Module {
 
   virtual bool IsSupported(OpCode op_code) const;
 
+  // The capabilities are cached across restarts while the controller reports the same version. Clearing them makes
+  // the next start read them from the controller again.
+  static void ClearCachedCapabilities();
+
   static const ModuleFactory Factory;
 
   static constexpr uint64_t kDefaultEventMask = 0x3dbfffffffffffff;
@@ -72,6 +72,10 @@ class TestHciLayer : public HciLayer {
     auto packet_view = GetPacketView(std::move(command_builder));
     CommandPacketView command = CommandPacketView::Create(packet_view);
     ASSERT(command.IsValid());
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      received_commands_[command.GetOpCode()]++;
+    }
 
     uint8_t num_packets = 1;
     std::unique_ptr<packet::BasePacketBuilder> event_builder;
@@ -244,6 +248,11 @@ class TestHciLayer : public HciLayer {
     return command;
   }
 
+  int GetReceivedCommandCount(OpCode op_code) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return received_commands_[op_code];
+  }
+
   void ListDependencies(ModuleList* list) override {}
   void Start() override {}
   void Stop() override {}
@@ -258,6 +267,7 @@ class TestHciLayer : public HciLayer {
   common::Callback<void(EventPacketView)> number_of_completed_packets_callback_;
   os::Handler* client_handler_;
   std::queue<CommandPacketView> command_queue_;
+  std::map<OpCode, int> received_commands_;
   mutable std::mutex mutex_;
   std::condition_variable not_empty_;
 };
@@ -265,6 +275,7 @@ class TestHciLayer : public HciLayer {
 class ControllerTest : public ::testing::Test {
  protected:
   void SetUp() override {
+    Controller::ClearCachedCapabilities();
     test_hci_layer_ = new TestHciLayer;
     fake_registry_.InjectTestModule(&HciLayer::Factory, test_hci_layer_);
     client_handler_ = fake_registry_.GetTestModuleHandler(&HciLayer::Factory);
@@ -434,6 +445,25 @@ TEST_F(ControllerTest, feature_spec_version_098_test) {
   EXPECT_TRUE(controller_->IsSupported(OpCode::CONTROLLER_A2DP_OPCODE));
 }
 
+TEST_F(ControllerTest, restart_reads_only_volatile_state) {
+  TestModuleRegistry restart_registry;
+  auto restart_hci_layer = new TestHciLayer;
+  restart_registry.InjectTestModule(&HciLayer::Factory, restart_hci_layer);
+  auto restarted_controller = restart_registry.Start<Controller>(&restart_registry.GetTestThread());
+
+  EXPECT_EQ(restart_hci_layer->GetReceivedCommandCount(OpCode::READ_LOCAL_VERSION_INFORMATION), 1);
+  EXPECT_EQ(restart_hci_layer->GetReceivedCommandCount(OpCode::READ_BD_ADDR), 1);
+  EXPECT_EQ(restart_hci_layer->GetReceivedCommandCount(OpCode::READ_LOCAL_SUPPORTED_COMMANDS), 0);
+  EXPECT_EQ(restart_hci_layer->GetReceivedCommandCount(OpCode::READ_BUFFER_SIZE), 0);
+  EXPECT_EQ(restart_hci_layer->GetReceivedCommandCount(OpCode::LE_GET_VENDOR_CAPABILITIES), 0);
+  EXPECT_EQ(restarted_controller->GetControllerLocalSupportedCommands(),
+            controller_->GetControllerLocalSupportedCommands());
+  EXPECT_EQ(restarted_controller->GetControllerLocalExtendedFeatures(2), 0x012345678abcdf1);
+  EXPECT_EQ(restarted_controller->GetControllerAclPacketLength(), test_hci_layer_->acl_data_packet_length);
+  EXPECT_TRUE(restarted_controller->IsSupported(OpCode::LE_MULTI_ADVT));
+  restart_registry.StopAll();
+}
+
 std::promise<void> credits1_set;
 std::promise<void> credits2_set;
 
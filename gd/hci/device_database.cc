@@ -17,6 +17,7 @@
  ******************************************************************************/
 #include "hci/device_database.h"
 
+#include <algorithm>
 #include <memory>
 #include <utility>
 
@@ -27,6 +28,88 @@
 
 using namespace bluetooth::hci;
 
+namespace {
+
+constexpr uint8_t kMagic[] = {'B', 'D', 'D', 'B'};
+constexpr uint8_t kVersion = 1;
+constexpr size_t kMaxNameLength = 248;
+
+void append_address(std::vector<uint8_t>& data, const Address& address) {
+  data.insert(data.end(), address.address, address.address + Address::kLength);
+}
+
+void append_device(std::vector<uint8_t>& data, Device& device) {
+  data.push_back(static_cast<uint8_t>(device.GetDeviceType()));
+  append_address(data, device.GetAddress());
+  data.push_back(device.IsBonded() ? 1 : 0);
+  ClassOfDevice class_of_device = device.GetClassOfDevice();
+  data.insert(data.end(), class_of_device.cod, class_of_device.cod + ClassOfDevice::kLength);
+  std::string name = device.GetName();
+  if (name.size() > kMaxNameLength) {
+    name.resize(kMaxNameLength);
+  }
+  data.push_back(static_cast<uint8_t>(name.size()));
+  data.insert(data.end(), name.begin(), name.end());
+}
+
+void append_le_device(std::vector<uint8_t>& data, LeDevice& device) {
+  append_address(data, device.GetPublicAddress());
+  data.push_back(device.GetIrk());
+}
+
+// Reads the fields of a record in order, and remembers a read past the end
+class RecordReader {
+ public:
+  explicit RecordReader(const std::vector<uint8_t>& data) : data_(data) {}
+
+  bool Read(uint8_t* to, size_t length) {
+    if (!valid_ || data_.size() - offset_ < length) {
+      valid_ = false;
+      return false;
+    }
+    std::copy(data_.begin() + offset_, data_.begin() + offset_ + length, to);
+    offset_ += length;
+    return true;
+  }
+
+  uint8_t ReadByte() {
+    uint8_t value = 0;
+    Read(&value, 1);
+    return value;
+  }
+
+  bool IsValid() const {
+    return valid_;
+  }
+
+  bool IsAtEnd() const {
+    return offset_ == data_.size();
+  }
+
+ private:
+  const std::vector<uint8_t>& data_;
+  size_t offset_ = 0;
+  bool valid_ = true;
+};
+
+}  // namespace
+
+DeviceDatabase::AddressKey DeviceDatabase::GetAddressKey(const Address& address) {
+  AddressKey key = 0;
+  for (size_t i = 0; i < Address::kLength; i++) {
+    key |= static_cast<AddressKey>(address.address[i]) << (8 * i);
+  }
+  return key;
+}
+
+std::shared_ptr<const DeviceDatabase::DeviceMaps> DeviceDatabase::GetDeviceMaps() const {
+  return std::atomic_load(&device_maps_);
+}
+
+void DeviceDatabase::PublishDeviceMaps(std::shared_ptr<const DeviceMaps> device_maps) {
+  std::atomic_store(&device_maps_, std::move(device_maps));
+}
+
 std::shared_ptr<ClassicDevice> DeviceDatabase::CreateClassicDevice(Address address) {
   ClassicDevice device(address);
   const std::string uuid = device.GetUuid();
@@ -55,72 +138,60 @@ std::shared_ptr<DualDevice> DeviceDatabase::CreateDualDevice(Address address) {
 }
 
 bool DeviceDatabase::RemoveDevice(const std::shared_ptr<Device>& device) {
-  const DeviceType type = device->GetDeviceType();
-  bool success;
-  switch (type) {
-    case CLASSIC:
-      success = false;
-      {
-        std::lock_guard<std::mutex> lock(device_map_mutex_);
-        auto classic_it = classic_device_map_.find(device->GetUuid());
+  const std::string uuid = device->GetUuid();
+  bool success = false;
+  {
+    std::lock_guard<std::mutex> lock(device_map_mutex_);
+    auto device_maps = std::make_shared<DeviceMaps>(*GetDeviceMaps());
+    auto classic_it = device_maps->classic_device_map.find(uuid);
+    auto le_it = device_maps->le_device_map.find(uuid);
+    auto dual_it = device_maps->dual_device_map.find(uuid);
+    switch (device->GetDeviceType()) {
+      case CLASSIC:
         // If we have a record with the same key
-        if (classic_it != classic_device_map_.end()) {
-          classic_device_map_.erase(device->GetUuid());
+        if (classic_it != device_maps->classic_device_map.end()) {
+          device_maps->classic_address_map.erase(GetAddressKey(classic_it->second->GetAddress()));
+          device_maps->classic_device_map.erase(classic_it);
           success = true;
         }
-      }
-      if (success) {
-        ASSERT_LOG(WriteToDisk(), "Failed to write data to disk!");
-      } else {
-        LOG_WARN("Device not in database!");
-      }
-      return success;
-    case LE:
-      success = false;
-      {
-        std::lock_guard<std::mutex> lock(device_map_mutex_);
-        auto le_it = le_device_map_.find(device->GetUuid());
-        // If we have a record with the same key
-        if (le_it != le_device_map_.end()) {
-          le_device_map_.erase(device->GetUuid());
+        break;
+      case LE:
+        if (le_it != device_maps->le_device_map.end()) {
+          device_maps->le_address_map.erase(GetAddressKey(le_it->second->GetAddress()));
+          device_maps->le_device_map.erase(le_it);
           success = true;
         }
-      }
-      if (success) {
-        ASSERT_LOG(WriteToDisk(), "Failed to write data to disk!");
-      } else {
-        LOG_WARN("Device not in database!");
-      }
-      return success;
-    case DUAL:
-      std::shared_ptr<DualDevice> dual_device = nullptr;
-      {
-        std::lock_guard<std::mutex> lock(device_map_mutex_);
-        auto dual_it = dual_device_map_.find(device->GetUuid());
-        if (dual_it != dual_device_map_.end()) {
-          dual_device = GetDualDevice(device->GetUuid());
-        }
-      }
-      success = false;
-      if (dual_device != nullptr) {
-        if (RemoveDevice(dual_device->GetClassicDevice()) && RemoveDevice(dual_device->GetLeDevice())) {
-          dual_device_map_.erase(device->GetUuid());
+        break;
+      case DUAL:
+        // Removing a DUAL device, or either of its halves, removes all three records
+        if (dual_it != device_maps->dual_device_map.end() && classic_it != device_maps->classic_device_map.end() &&
+            le_it != device_maps->le_device_map.end()) {
+          device_maps->dual_address_map.erase(GetAddressKey(dual_it->second->GetAddress()));
+          device_maps->classic_address_map.erase(GetAddressKey(classic_it->second->GetAddress()));
+          device_maps->le_address_map.erase(GetAddressKey(le_it->second->GetAddress()));
+          device_maps->dual_device_map.erase(dual_it);
+          device_maps->classic_device_map.erase(classic_it);
+          device_maps->le_device_map.erase(le_it);
           success = true;
         }
-      }
-      if (success) {
-        ASSERT_LOG(WriteToDisk(), "Failed to write data to disk!");
-      } else {
-        LOG_WARN("Device not in database!");
-      }
-      return success;
+        break;
+    }
+    if (success) {
+      PublishDeviceMaps(std::move(device_maps));
+    }
+  }
+  if (success) {
+    ASSERT_LOG(WriteToDisk(), "Failed to write data to disk!");
+  } else {
+    LOG_WARN("Device not in database!");
   }
+  return success;
 }
 
 std::shared_ptr<ClassicDevice> DeviceDatabase::GetClassicDevice(const std::string& uuid) {
-  std::lock_guard<std::mutex> lock(device_map_mutex_);
-  auto it = classic_device_map_.find(uuid);
-  if (it != classic_device_map_.end()) {
+  auto device_maps = GetDeviceMaps();
+  auto it = device_maps->classic_device_map.find(uuid);
+  if (it != device_maps->classic_device_map.end()) {
     return it->second;
   }
   LOG_WARN("Device '%s' not found!", uuid.c_str());
@@ -128,9 +199,9 @@ std::shared_ptr<ClassicDevice> DeviceDatabase::GetClassicDevice(const std::strin
 }
 
 std::shared_ptr<LeDevice> DeviceDatabase::GetLeDevice(const std::string& uuid) {
-  std::lock_guard<std::mutex> lock(device_map_mutex_);
-  auto it = le_device_map_.find(uuid);
-  if (it != le_device_map_.end()) {
+  auto device_maps = GetDeviceMaps();
+  auto it = device_maps->le_device_map.find(uuid);
+  if (it != device_maps->le_device_map.end()) {
     return it->second;
   }
   LOG_WARN("Device '%s' not found!", uuid.c_str());
@@ -138,42 +209,136 @@ std::shared_ptr<LeDevice> DeviceDatabase::GetLeDevice(const std::string& uuid) {
 }
 
 std::shared_ptr<DualDevice> DeviceDatabase::GetDualDevice(const std::string& uuid) {
-  std::lock_guard<std::mutex> lock(device_map_mutex_);
-  auto it = dual_device_map_.find(uuid);
-  if (it != dual_device_map_.end()) {
+  auto device_maps = GetDeviceMaps();
+  auto it = device_maps->dual_device_map.find(uuid);
+  if (it != device_maps->dual_device_map.end()) {
     return it->second;
   }
   LOG_WARN("Device '%s' not found!", uuid.c_str());
   return std::shared_ptr<DualDevice>();
 }
 
+std::shared_ptr<ClassicDevice> DeviceDatabase::GetClassicDevice(const Address& address) {
+  auto device_maps = GetDeviceMaps();
+  auto it = device_maps->classic_address_map.find(GetAddressKey(address));
+  if (it != device_maps->classic_address_map.end()) {
+    return it->second;
+  }
+  return std::shared_ptr<ClassicDevice>();
+}
+
+std::shared_ptr<LeDevice> DeviceDatabase::GetLeDevice(const Address& address) {
+  auto device_maps = GetDeviceMaps();
+  auto it = device_maps->le_address_map.find(GetAddressKey(address));
+  if (it != device_maps->le_address_map.end()) {
+    return it->second;
+  }
+  return std::shared_ptr<LeDevice>();
+}
+
+std::shared_ptr<DualDevice> DeviceDatabase::GetDualDevice(const Address& address) {
+  auto device_maps = GetDeviceMaps();
+  auto it = device_maps->dual_address_map.find(GetAddressKey(address));
+  if (it != device_maps->dual_address_map.end()) {
+    return it->second;
+  }
+  return std::shared_ptr<DualDevice>();
+}
+
+std::vector<std::shared_ptr<Device>> DeviceDatabase::GetClassicDevices() {
+  auto device_maps = GetDeviceMaps();
+  std::vector<std::shared_ptr<Device>> devices;
+  devices.reserve(device_maps->classic_device_map.size());
+  for (const auto& entry : device_maps->classic_device_map) {
+    devices.push_back(entry.second);
+  }
+  return devices;
+}
+
+std::vector<std::shared_ptr<Device>> DeviceDatabase::GetLeDevices() {
+  auto device_maps = GetDeviceMaps();
+  std::vector<std::shared_ptr<Device>> devices;
+  devices.reserve(device_maps->le_device_map.size());
+  for (const auto& entry : device_maps->le_device_map) {
+    devices.push_back(entry.second);
+  }
+  return devices;
+}
+
 bool DeviceDatabase::UpdateDeviceAddress(const std::shared_ptr<Device>& device, Address new_address) {
-  // Hold onto device
-  const DeviceType type = device->GetDeviceType();
-  if (type == CLASSIC) {
-    auto classic_device = GetClassicDevice(device->GetUuid());
-    // This gets rid of the shared_ptr in the map
-    ASSERT_LOG(RemoveDevice(device), "Failed to remove the device!");
-    classic_device->SetAddress(new_address);
-    // Move the value located at the pointer
-    return AddDeviceToMap(std::move(*(classic_device.get())));
-  } else if (type == LE) {
-    auto le_device = GetLeDevice(device->GetUuid());
-    // This gets rid of the shared_ptr in the map
-    ASSERT_LOG(RemoveDevice(device), "Failed to remove the device!");
-    le_device->SetAddress(new_address);
-    // Move the value located at the pointer
-    return AddDeviceToMap(std::move(*(le_device.get())));
-  } else if (type == DUAL) {
-    auto dual_device = GetDualDevice(device->GetUuid());
-    // This gets rid of the shared_ptr in the map
-    ASSERT_LOG(RemoveDevice(device), "Failed to remove the device!");
-    dual_device->SetAddress(new_address);
-    // Move the value located at the pointer
-    return AddDeviceToMap(std::move(*(dual_device.get())));
-  }
-  LOG_ALWAYS_FATAL("Someone added a device type but didn't account for it here.");
-  return false;
+  // The records keep pointing to the same devices, only their keys change
+  const std::string uuid = device->GetUuid();
+  bool success = false;
+  {
+    std::lock_guard<std::mutex> lock(device_map_mutex_);
+    auto device_maps = std::make_shared<DeviceMaps>(*GetDeviceMaps());
+    auto classic_it = device_maps->classic_device_map.find(uuid);
+    auto le_it = device_maps->le_device_map.find(uuid);
+    auto dual_it = device_maps->dual_device_map.find(uuid);
+    std::shared_ptr<ClassicDevice> classic_device;
+    std::shared_ptr<LeDevice> le_device;
+    std::shared_ptr<DualDevice> dual_device;
+    const DeviceType type = device->GetDeviceType();
+    if ((type == CLASSIC || type == DUAL) && classic_it != device_maps->classic_device_map.end()) {
+      classic_device = classic_it->second;
+    }
+    if ((type == LE || type == DUAL) && le_it != device_maps->le_device_map.end()) {
+      le_device = le_it->second;
+    }
+    if (type == DUAL && dual_it != device_maps->dual_device_map.end()) {
+      dual_device = dual_it->second;
+    }
+    bool found = type == CLASSIC ? classic_device != nullptr
+                                 : type == LE ? le_device != nullptr
+                                              : dual_device != nullptr && classic_device && le_device;
+    ASSERT_LOG(found, "Failed to find the device!");
+
+    if (classic_device) {
+      device_maps->classic_address_map.erase(GetAddressKey(classic_device->GetAddress()));
+      device_maps->classic_device_map.erase(classic_it);
+    }
+    if (le_device) {
+      device_maps->le_address_map.erase(GetAddressKey(le_device->GetAddress()));
+      device_maps->le_device_map.erase(le_it);
+    }
+    if (dual_device) {
+      device_maps->dual_address_map.erase(GetAddressKey(dual_device->GetAddress()));
+      device_maps->dual_device_map.erase(dual_it);
+    }
+
+    // The uuid is derived from the address, so a free address means free keys
+    const AddressKey key = GetAddressKey(new_address);
+    success = !(classic_device && device_maps->classic_address_map.count(key)) &&
+              !(le_device && device_maps->le_address_map.count(key)) &&
+              !(dual_device && device_maps->dual_address_map.count(key));
+    if (success) {
+      if (dual_device) {
+        // Also updates the CLASSIC and LE halves
+        dual_device->SetAddress(new_address);
+      } else {
+        device->SetAddress(new_address);
+      }
+      if (classic_device) {
+        device_maps->classic_device_map[classic_device->GetUuid()] = classic_device;
+        device_maps->classic_address_map[key] = classic_device;
+      }
+      if (le_device) {
+        device_maps->le_device_map[le_device->GetUuid()] = le_device;
+        device_maps->le_address_map[key] = le_device;
+      }
+      if (dual_device) {
+        device_maps->dual_device_map[dual_device->GetUuid()] = dual_device;
+        device_maps->dual_address_map[key] = dual_device;
+      }
+      PublishDeviceMaps(std::move(device_maps));
+    }
+  }
+  if (success) {
+    ASSERT_LOG(WriteToDisk(), "Failed to write data to disk!");
+  } else {
+    LOG_WARN("Another device already has the address %s", new_address.ToString().c_str());
+  }
+  return success;
 }
 
 bool DeviceDatabase::AddDeviceToMap(ClassicDevice&& device) {
@@ -181,17 +346,12 @@ bool DeviceDatabase::AddDeviceToMap(ClassicDevice&& device) {
   bool success = false;
   {
     std::lock_guard<std::mutex> lock(device_map_mutex_);
-    auto it = classic_device_map_.find(device.GetUuid());
-    // If we have a record with the same key
-    if (it != classic_device_map_.end()) {
-      // We don't want to insert and overwrite
-      return false;
-    }
+    auto device_maps = std::make_shared<DeviceMaps>(*GetDeviceMaps());
     std::shared_ptr<ClassicDevice> device_ptr = std::make_shared<ClassicDevice>(std::move(device));
-    // returning the boolean value of insert success
-    if (classic_device_map_
-            .insert(std::pair<std::string, std::shared_ptr<ClassicDevice>>(device_ptr->GetUuid(), device_ptr))
-            .second) {
+    // We don't want to insert and overwrite a record with the same key
+    if (device_maps->classic_device_map.emplace(uuid, device_ptr).second) {
+      device_maps->classic_address_map[GetAddressKey(device_ptr->GetAddress())] = device_ptr;
+      PublishDeviceMaps(std::move(device_maps));
       success = true;
     }
   }
@@ -208,16 +368,12 @@ bool DeviceDatabase::AddDeviceToMap(LeDevice&& device) {
   bool success = false;
   {
     std::lock_guard<std::mutex> lock(device_map_mutex_);
-    auto it = le_device_map_.find(device.GetUuid());
-    // If we have a record with the same key
-    if (it != le_device_map_.end()) {
-      // We don't want to insert and overwrite
-      return false;
-    }
+    auto device_maps = std::make_shared<DeviceMaps>(*GetDeviceMaps());
     std::shared_ptr<LeDevice> device_ptr = std::make_shared<LeDevice>(std::move(device));
-    // returning the boolean value of insert success
-    if (le_device_map_.insert(std::pair<std::string, std::shared_ptr<LeDevice>>(device_ptr->GetUuid(), device_ptr))
-            .second) {
+    // We don't want to insert and overwrite a record with the same key
+    if (device_maps->le_device_map.emplace(uuid, device_ptr).second) {
+      device_maps->le_address_map[GetAddressKey(device_ptr->GetAddress())] = device_ptr;
+      PublishDeviceMaps(std::move(device_maps));
       success = true;
     }
   }
@@ -234,16 +390,12 @@ bool DeviceDatabase::AddDeviceToMap(DualDevice&& device) {
   bool success = false;
   {
     std::lock_guard<std::mutex> lock(device_map_mutex_);
-    auto it = dual_device_map_.find(device.GetUuid());
-    // If we have a record with the same key
-    if (it != dual_device_map_.end()) {
-      // We don't want to insert and overwrite
-      return false;
-    }
+    auto device_maps = std::make_shared<DeviceMaps>(*GetDeviceMaps());
     std::shared_ptr<DualDevice> device_ptr = std::make_shared<DualDevice>(std::move(device));
-    // returning the boolean value of insert success
-    if (dual_device_map_.insert(std::pair<std::string, std::shared_ptr<DualDevice>>(device_ptr->GetUuid(), device_ptr))
-            .second) {
+    // We don't want to insert and overwrite a record with the same key
+    if (device_maps->dual_device_map.emplace(uuid, device_ptr).second) {
+      device_maps->dual_address_map[GetAddressKey(device_ptr->GetAddress())] = device_ptr;
+      PublishDeviceMaps(std::move(device_maps));
       success = true;
     }
   }
@@ -255,6 +407,111 @@ bool DeviceDatabase::AddDeviceToMap(DualDevice&& device) {
   return success;
 }
 
+std::vector<uint8_t> DeviceDatabase::Serialize() {
+  auto device_maps = GetDeviceMaps();
+  size_t count = device_maps->dual_device_map.size();
+  for (const auto& entry : device_maps->classic_device_map) {
+    count += entry.second->GetDeviceType() == CLASSIC ? 1 : 0;
+  }
+  for (const auto& entry : device_maps->le_device_map) {
+    count += entry.second->GetDeviceType() == LE ? 1 : 0;
+  }
+  ASSERT_LOG(count <= UINT16_MAX, "Too many devices to serialize: %zu", count);
+
+  std::vector<uint8_t> data(std::begin(kMagic), std::end(kMagic));
+  data.push_back(kVersion);
+  data.push_back(static_cast<uint8_t>(count));
+  data.push_back(static_cast<uint8_t>(count >> 8));
+  for (const auto& entry : device_maps->classic_device_map) {
+    if (entry.second->GetDeviceType() == CLASSIC) {
+      append_device(data, *entry.second);
+    }
+  }
+  for (const auto& entry : device_maps->le_device_map) {
+    if (entry.second->GetDeviceType() == LE) {
+      append_device(data, *entry.second);
+      append_le_device(data, *entry.second);
+    }
+  }
+  for (const auto& entry : device_maps->dual_device_map) {
+    append_device(data, *entry.second);
+    append_le_device(data, *std::static_pointer_cast<LeDevice>(entry.second->GetLeDevice()));
+  }
+  return data;
+}
+
+bool DeviceDatabase::Deserialize(const std::vector<uint8_t>& data) {
+  RecordReader reader(data);
+  uint8_t magic[sizeof(kMagic)];
+  if (!reader.Read(magic, sizeof(magic)) || !std::equal(std::begin(kMagic), std::end(kMagic), magic) ||
+      reader.ReadByte() != kVersion) {
+    LOG_WARN("Unknown device database format");
+    return false;
+  }
+  size_t count = reader.ReadByte();
+  count |= reader.ReadByte() << 8;
+
+  auto device_maps = std::make_shared<DeviceMaps>();
+  for (size_t i = 0; i < count && reader.IsValid(); i++) {
+    uint8_t type = reader.ReadByte();
+    Address address;
+    reader.Read(address.address, Address::kLength);
+    bool is_bonded = reader.ReadByte() != 0;
+    ClassOfDevice class_of_device;
+    reader.Read(class_of_device.cod, ClassOfDevice::kLength);
+    std::string name(reader.ReadByte(), '\0');
+    reader.Read(reinterpret_cast<uint8_t*>(&name[0]), name.size());
+    Address public_address;
+    uint8_t irk = 0;
+    if (type == LE || type == DUAL) {
+      reader.Read(public_address.address, Address::kLength);
+      irk = reader.ReadByte();
+    }
+    if (!reader.IsValid() || type > LE) {
+      break;
+    }
+
+    auto set_metadata = [&](Device& device) {
+      device.SetIsBonded(is_bonded);
+      device.SetClassOfDevice(class_of_device);
+      device.SetName(name);
+    };
+    std::shared_ptr<ClassicDevice> classic;
+    std::shared_ptr<LeDevice> le;
+    if (type == CLASSIC || type == DUAL) {
+      classic = std::shared_ptr<ClassicDevice>(new ClassicDevice(address));
+      set_metadata(*classic);
+      device_maps->classic_device_map[classic->GetUuid()] = classic;
+      device_maps->classic_address_map[GetAddressKey(address)] = classic;
+    }
+    if (type == LE || type == DUAL) {
+      le = std::shared_ptr<LeDevice>(new LeDevice(address));
+      set_metadata(*le);
+      le->SetPublicAddress(public_address);
+      le->SetIrk(irk);
+      device_maps->le_device_map[le->GetUuid()] = le;
+      device_maps->le_address_map[GetAddressKey(address)] = le;
+    }
+    if (type == DUAL) {
+      auto dual = std::shared_ptr<DualDevice>(new DualDevice(address, classic, le));
+      set_metadata(*dual);
+      device_maps->dual_device_map[dual->GetUuid()] = dual;
+      device_maps->dual_address_map[GetAddressKey(address)] = dual;
+    }
+  }
+  if (!reader.IsValid() || !reader.IsAtEnd() ||
+      device_maps->classic_address_map.size() + device_maps->le_address_map.size() -
+              device_maps->dual_address_map.size() !=
+          count) {
+    LOG_WARN("Malformed device database");
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(device_map_mutex_);
+  PublishDeviceMaps(std::move(device_maps));
+  return true;
+}
+
 bool DeviceDatabase::WriteToDisk() {
   // TODO(optedoblivion): Implement
   // TODO(optedoblivion): FIX ME!
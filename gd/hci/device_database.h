@@ -17,8 +17,12 @@
  ******************************************************************************/
 #pragma once
 
+#include <cstdint>
 #include <map>
+#include <memory>
 #include <mutex>
+#include <unordered_map>
+#include <vector>
 
 #include "hci/classic_device.h"
 #include "hci/device.h"
@@ -34,10 +38,14 @@ namespace bluetooth::hci {
  * <p>If a device is stored here it is actively being used by the stack.
  *
  * <p>This database is not meant for scan results.
+ *
+ * <p>Lookups are read-copy-update: readers use the current immutable snapshot of the maps without taking a lock, while
+ * writers serialize on a mutex, copy the snapshot, modify the copy and publish it. Devices are few and rarely added,
+ * but are looked up for every event.
  */
 class DeviceDatabase {
  public:
-  DeviceDatabase() : classic_device_map_(), le_device_map_(), dual_device_map_() {
+  DeviceDatabase() : device_maps_(std::make_shared<DeviceMaps>()) {
     if (!ReadFromDisk()) {
       LOG_WARN("First boot or missing data!");
     }
@@ -91,6 +99,30 @@ class DeviceDatabase {
    */
   std::shared_ptr<DualDevice> GetDualDevice(const std::string& uuid);
 
+  /**
+   * Fetches a Classic Device by its current address, without formatting a uuid.
+   *
+   * @param address the address of the device
+   * @return a weak reference to the matching Device or empty shared_ptr (nullptr)
+   */
+  std::shared_ptr<ClassicDevice> GetClassicDevice(const Address& address);
+
+  /**
+   * Fetches a Le Device by its current address, without formatting a uuid.
+   *
+   * @param address the address of the device
+   * @return a weak reference to the matching Device or empty shared_ptr (nullptr)
+   */
+  std::shared_ptr<LeDevice> GetLeDevice(const Address& address);
+
+  /**
+   * Fetches a Dual Device by its current address, without formatting a uuid.
+   *
+   * @param address the address of the device
+   * @return a weak reference to the matching Device or empty shared_ptr (nullptr)
+   */
+  std::shared_ptr<DualDevice> GetDualDevice(const Address& address);
+
   /**
    * Removes a device from the internal database.
    *
@@ -132,11 +164,49 @@ class DeviceDatabase {
    */
   std::vector<std::shared_ptr<Device>> GetLeDevices();
 
+  /**
+   * Encodes all of the devices in the compact binary format that is persisted.
+   *
+   * <p>The format is a header of the magic "BDDB", a version byte and a little endian uint16_t device count, followed
+   * by one record per device: type, address, bonded flag, class of device, name length and name. LE and DUAL
+   * records end with the LE public address and IRK. The CLASSIC and LE halves of a DUAL device are not stored
+   * separately.
+   *
+   * @return the encoded devices
+   */
+  std::vector<uint8_t> Serialize();
+
+  /**
+   * Replaces all of the devices with the ones encoded by Serialize().
+   *
+   * @param data the encoded devices
+   * @return <code>true</code> if |data| was well formed, the database is unchanged otherwise
+   */
+  bool Deserialize(const std::vector<uint8_t>& data);
+
  private:
+  // Address packed in the low 48 bits, so that lookups hash and compare a single integer
+  using AddressKey = uint64_t;
+
+  // An immutable snapshot of the maps, which are only modified in a copy
+  struct DeviceMaps {
+    std::map<std::string, std::shared_ptr<ClassicDevice>> classic_device_map;
+    std::map<std::string, std::shared_ptr<LeDevice>> le_device_map;
+    std::map<std::string, std::shared_ptr<DualDevice>> dual_device_map;
+    std::unordered_map<AddressKey, std::shared_ptr<ClassicDevice>> classic_address_map;
+    std::unordered_map<AddressKey, std::shared_ptr<LeDevice>> le_address_map;
+    std::unordered_map<AddressKey, std::shared_ptr<DualDevice>> dual_address_map;
+  };
+
+  // Serializes the writers
   std::mutex device_map_mutex_;
-  std::map<std::string, std::shared_ptr<ClassicDevice>> classic_device_map_;
-  std::map<std::string, std::shared_ptr<LeDevice>> le_device_map_;
-  std::map<std::string, std::shared_ptr<DualDevice>> dual_device_map_;
+  // Loaded and replaced with std::atomic_load and std::atomic_store
+  std::shared_ptr<const DeviceMaps> device_maps_;
+
+  static AddressKey GetAddressKey(const Address& address);
+  std::shared_ptr<const DeviceMaps> GetDeviceMaps() const;
+  // Must hold device_map_mutex_
+  void PublishDeviceMaps(std::shared_ptr<const DeviceMaps> device_maps);
 
   bool AddDeviceToMap(ClassicDevice&& device);
   bool AddDeviceToMap(LeDevice&& device);
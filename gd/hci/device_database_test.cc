@@ -130,5 +130,68 @@ TEST_F(DeviceDatabaseTest, address_modification_check) {
   ASSERT_TRUE(device_database_.RemoveDevice(gotten_modified_device));
   ASSERT_FALSE(device_database_.GetClassicDevice("01:01:01:01:01:01"));
 }
+TEST_F(DeviceDatabaseTest, get_device_by_address) {
+  auto classic_device = device_database_.CreateClassicDevice(address);
+  ASSERT_EQ(classic_device, device_database_.GetClassicDevice(address));
+  ASSERT_FALSE(device_database_.GetLeDevice(address));
+  ASSERT_FALSE(device_database_.GetClassicDevice(Address({0x01, 0x01, 0x01, 0x01, 0x01, 0x01})));
+}
+
+TEST_F(DeviceDatabaseTest, address_index_follows_address_modification) {
+  Address new_address({0x01, 0x01, 0x01, 0x01, 0x01, 0x01});
+  auto dual_device = device_database_.CreateDualDevice(address);
+  ASSERT_TRUE(device_database_.UpdateDeviceAddress(dual_device, new_address));
+  ASSERT_FALSE(device_database_.GetDualDevice(address));
+  ASSERT_FALSE(device_database_.GetClassicDevice(address));
+  ASSERT_EQ(dual_device, device_database_.GetDualDevice(new_address));
+  ASSERT_EQ(dual_device->GetClassicDevice(), device_database_.GetClassicDevice(new_address));
+  ASSERT_EQ(dual_device->GetLeDevice(), device_database_.GetLeDevice("01:01:01:01:01:01"));
+}
+
+TEST_F(DeviceDatabaseTest, address_modification_to_taken_address_fails) {
+  Address other_address({0x01, 0x01, 0x01, 0x01, 0x01, 0x01});
+  auto classic_device = device_database_.CreateClassicDevice(address);
+  device_database_.CreateClassicDevice(other_address);
+  ASSERT_FALSE(device_database_.UpdateDeviceAddress(classic_device, other_address));
+  ASSERT_EQ(address, classic_device->GetAddress());
+  ASSERT_EQ(classic_device, device_database_.GetClassicDevice(address));
+}
+
+TEST_F(DeviceDatabaseTest, remove_dual_device) {
+  auto dual_device = device_database_.CreateDualDevice(address);
+  ASSERT_TRUE(device_database_.RemoveDevice(dual_device));
+  ASSERT_FALSE(device_database_.GetDualDevice(address));
+  ASSERT_FALSE(device_database_.GetClassicDevice(address));
+  ASSERT_FALSE(device_database_.GetLeDevice(address));
+}
+
+TEST_F(DeviceDatabaseTest, serialize_and_deserialize) {
+  device_database_.CreateClassicDevice(address);
+  auto le_device = device_database_.CreateLeDevice(Address({0x01, 0x01, 0x01, 0x01, 0x01, 0x01}));
+  le_device->SetIrk(0x42);
+  device_database_.CreateDualDevice(Address({0x02, 0x02, 0x02, 0x02, 0x02, 0x02}));
+  auto data = device_database_.Serialize();
+
+  DeviceDatabase restored_database;
+  ASSERT_TRUE(restored_database.Deserialize(data));
+  ASSERT_EQ(CLASSIC, restored_database.GetClassicDevice(address)->GetDeviceType());
+  auto restored_le_device = restored_database.GetLeDevice(Address({0x01, 0x01, 0x01, 0x01, 0x01, 0x01}));
+  ASSERT_TRUE(restored_le_device);
+  ASSERT_EQ(0x42, restored_le_device->GetIrk());
+  auto restored_dual_device = restored_database.GetDualDevice(Address({0x02, 0x02, 0x02, 0x02, 0x02, 0x02}));
+  ASSERT_TRUE(restored_dual_device);
+  ASSERT_EQ(restored_dual_device->GetClassicDevice(),
+            restored_database.GetClassicDevice(Address({0x02, 0x02, 0x02, 0x02, 0x02, 0x02})));
+  ASSERT_EQ(data, restored_database.Serialize());
+}
+
+TEST_F(DeviceDatabaseTest, deserialize_truncated_data_fails) {
+  device_database_.CreateClassicDevice(address);
+  auto data = device_database_.Serialize();
+  data.pop_back();
+  DeviceDatabase restored_database;
+  ASSERT_FALSE(restored_database.Deserialize(data));
+  ASSERT_FALSE(restored_database.GetClassicDevice(address));
+}
 }  // namespace
 }  // namespace bluetooth::hci
@@ -16,7 +16,12 @@
 
 #include "hci/facade/acl_manager_facade.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <future>
+#include <list>
 #include <memory>
 #include <mutex>
 
@@ -38,6 +43,9 @@ namespace bluetooth {
 namespace hci {
 namespace facade {
 
+// Maximum number of ACL packets streamed per FetchAclDataBatch message
+constexpr size_t kMaxAclDataBatchSize = 64;
+
 class AclManagerFacadeService : public AclManagerFacade::Service,
                                 public ::bluetooth::hci::ConnectionCallbacks,
                                 public ::bluetooth::hci::ConnectionManagementCallbacks,
@@ -138,6 +146,110 @@ class AclManagerFacadeService : public AclManagerFacade::Service,
     return pending_acl_data_.RunLoop(context, writer);
   }
 
+  ::grpc::Status FetchAclDataBatch(::grpc::ServerContext* context, const ::google::protobuf::Empty* request,
+                                   ::grpc::ServerWriter<AclDataBatch>* writer) override {
+    return pending_acl_data_.RunBatchLoop(context, writer, kMaxAclDataBatchSize);
+  }
+
+  // Sends |packet_count| packets of |payload_size| bytes generated in the DUT, as fast as the ACL queue takes them,
+  // and reports the rates without any per packet gRPC call. Packets received during the measurement are counted too.
+  ::grpc::Status MeasureAclThroughput(::grpc::ServerContext* context, const AclThroughputRequest* request,
+                                      AclThroughputReport* response) override {
+    if (request->packet_count() == 0 || request->payload_size() == 0 || request->payload_size() > 0xffff) {
+      return ::grpc::Status(::grpc::StatusCode::INVALID_ARGUMENT, "Invalid packet count or payload size");
+    }
+    auto measurement = std::make_shared<AclThroughputMeasurement>();
+    measurement->payload.resize(request->payload_size());
+    for (size_t i = 0; i < measurement->payload.size(); i++) {
+      measurement->payload[i] = static_cast<uint8_t>(i);
+    }
+    measurement->remaining = request->packet_count();
+    auto future = measurement->done.get_future();
+
+    uint64_t rx_packets = rx_acl_packets_;
+    uint64_t rx_bytes = rx_acl_bytes_;
+    size_t dropped = pending_acl_data_.GetDroppedEventCount();
+    auto start = std::chrono::steady_clock::now();
+    {
+      std::unique_lock<std::mutex> lock(acl_connections_mutex_);
+      auto connection = acl_connections_.find(request->handle());
+      if (connection == acl_connections_.end()) {
+        LOG_ERROR("Invalid handle");
+        return ::grpc::Status(::grpc::StatusCode::INVALID_ARGUMENT, "Invalid handle");
+      }
+      measurement->connection = connection->second;
+    }
+    facade_handler_->Post(
+        common::BindOnce(&AclManagerFacadeService::start_measurement, common::Unretained(this), measurement));
+
+    // The measurement ends when the last packet is queued, the connection drops, or the client goes away
+    while (future.wait_for(kMeasurementPollPeriod) != std::future_status::ready) {
+      if (context->IsCancelled()) {
+        facade_handler_->Post(common::BindOnce(&AclManagerFacadeService::stop_measurement, common::Unretained(this),
+                                               measurement, false));
+        future.wait();
+        return ::grpc::Status(::grpc::StatusCode::CANCELLED, "Measurement cancelled");
+      }
+    }
+    auto duration = std::chrono::steady_clock::now() - start;
+    if (measurement->disconnected) {
+      return ::grpc::Status(::grpc::StatusCode::UNAVAILABLE, "Disconnected during the measurement");
+    }
+
+    response->set_packets_sent(request->packet_count());
+    response->set_bytes_sent(static_cast<uint64_t>(request->packet_count()) * request->payload_size());
+    response->set_packets_received(rx_acl_packets_ - rx_packets);
+    response->set_bytes_received(rx_acl_bytes_ - rx_bytes);
+    response->set_duration_us(std::chrono::duration_cast<std::chrono::microseconds>(duration).count());
+    response->set_events_dropped(pending_acl_data_.GetDroppedEventCount() - dropped);
+    return ::grpc::Status::OK;
+  }
+
+  static constexpr std::chrono::milliseconds kMeasurementPollPeriod{100};
+
+  // Owned by the RPC and by the enqueue callback. Only changed on facade_handler_ once started.
+  struct AclThroughputMeasurement {
+    std::shared_ptr<AclConnection> connection;
+    std::vector<uint8_t> payload;
+    uint32_t remaining;
+    bool finished = false;
+    bool disconnected = false;
+    std::promise<void> done;
+  };
+
+  void start_measurement(std::shared_ptr<AclThroughputMeasurement> measurement) {
+    if (measurement->finished) {
+      return;
+    }
+    measurements_.push_back(measurement);
+    measurement->connection->GetAclQueueEnd()->RegisterEnqueue(
+        facade_handler_, common::Bind(&AclManagerFacadeService::enqueue_measurement_packet, common::Unretained(this),
+                                      measurement));
+  }
+
+  // Unregisters the enqueue callback of |measurement| and wakes up its RPC, unless it was stopped already
+  void stop_measurement(std::shared_ptr<AclThroughputMeasurement> measurement, bool disconnected) {
+    if (measurement->finished) {
+      return;
+    }
+    measurement->finished = true;
+    measurement->disconnected = disconnected;
+    auto it = std::find(measurements_.begin(), measurements_.end(), measurement);
+    if (it != measurements_.end()) {
+      measurements_.erase(it);
+      measurement->connection->GetAclQueueEnd()->UnregisterEnqueue();
+    }
+    measurement->done.set_value();
+  }
+
+  std::unique_ptr<BasePacketBuilder> enqueue_measurement_packet(std::shared_ptr<AclThroughputMeasurement> measurement) {
+    auto packet = std::make_unique<RawBuilder>(measurement->payload);
+    if (--measurement->remaining == 0) {
+      stop_measurement(measurement, false);
+    }
+    return packet;
+  }
+
   static inline uint16_t to_handle(uint32_t current_request) {
     return (current_request + 0x10) % 0xe00;
   }
@@ -151,6 +263,8 @@ class AclManagerFacadeService : public AclManagerFacade::Service,
 
   void on_incoming_acl(std::shared_ptr<AclConnection> connection, uint16_t handle) {
     auto packet = connection->GetAclQueueEnd()->TryDequeue();
+    rx_acl_packets_++;
+    rx_acl_bytes_ += packet->size();
     AclData acl_data;
     acl_data.set_handle(handle);
     acl_data.set_payload(std::string(packet->begin(), packet->end()));
@@ -158,6 +272,15 @@ class AclManagerFacadeService : public AclManagerFacade::Service,
   }
 
   void on_disconnect(std::shared_ptr<AclConnection> connection, uint32_t entry, ErrorCode code) {
+    std::vector<std::shared_ptr<AclThroughputMeasurement>> stopped;
+    for (auto& measurement : measurements_) {
+      if (measurement->connection == connection) {
+        stopped.push_back(measurement);
+      }
+    }
+    for (auto& measurement : stopped) {
+      stop_measurement(measurement, true);
+    }
     connection->GetAclQueueEnd()->UnregisterDequeue();
     connection->Finish();
     std::unique_ptr<BasePacketBuilder> builder =
@@ -299,6 +422,10 @@ class AclManagerFacadeService : public AclManagerFacade::Service,
   mutable std::mutex acl_connections_mutex_;
   std::map<uint16_t, std::shared_ptr<AclConnection>> acl_connections_;
   ::bluetooth::grpc::GrpcEventQueue<AclData> pending_acl_data_{"FetchAclData"};
+  std::atomic<uint64_t> rx_acl_packets_{0};
+  std::atomic<uint64_t> rx_acl_bytes_{0};
+  // Measurements running on a connection, only accessed on facade_handler_
+  std::list<std::shared_ptr<AclThroughputMeasurement>> measurements_;
   std::vector<std::unique_ptr<::bluetooth::grpc::GrpcEventQueue<ConnectionEvent>>> per_connection_events_;
   uint32_t current_connection_request_{0};
 };
@@ -16,6 +16,12 @@
 
 #include "hci/hci_layer.h"
 
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <limits>
+#include <list>
+
 #include "common/bind.h"
 #include "common/callback.h"
 #include "os/alarm.h"
@@ -34,6 +40,7 @@ using bluetooth::hci::CommandPacketBuilder;
 using bluetooth::hci::CommandStatusView;
 using bluetooth::hci::EventPacketView;
 using bluetooth::hci::LeMetaEventView;
+using bluetooth::hci::OpCode;
 using bluetooth::os::Handler;
 
 class EventHandler {
@@ -71,6 +78,10 @@ class CommandQueueEntry {
   OnceCallback<void(CommandStatusView)> on_status;
   OnceCallback<void(CommandCompleteView)> on_complete;
   Handler* caller_handler;
+  // Serialized when the command reaches the head of the queue
+  std::shared_ptr<std::vector<uint8_t>> bytes;
+  OpCode op_code{OpCode::NONE};
+  std::chrono::steady_clock::time_point sent_time;
 };
 }  // namespace
 
@@ -199,9 +210,21 @@ struct HciLayer::impl : public hal::HciHalCallbacks {
 
   void drop(EventPacketView) {}
 
+  // Drains everything the ACL manager has queued, so the HAL can hand the packets to the transport together
   void dequeue_and_send_acl() {
-    auto packet = acl_queue_.GetDownEnd()->TryDequeue();
-    send_acl(std::move(packet));
+    std::vector<hal::HciPacket> packets;
+    for (auto& packet : acl_queue_.GetDownEnd()->TryDequeueBatch(std::numeric_limits<size_t>::max())) {
+      std::vector<uint8_t> bytes;
+      bytes.reserve(packet->size());
+      BitInserter bi(bytes);
+      packet->Serialize(bi);
+      packets.push_back(std::move(bytes));
+    }
+    if (packets.size() == 1) {
+      hal_->sendAclData(std::move(packets.front()));
+    } else if (!packets.empty()) {
+      hal_->sendAclDataBatch(std::move(packets));
+    }
   }
 
   void Stop() {
@@ -217,21 +240,16 @@ struct HciLayer::impl : public hal::HciHalCallbacks {
     incoming_acl_packet_buffer_.Clear();
     delete hci_timeout_alarm_;
     command_queue_.clear();
+    in_flight_commands_.clear();
     hal_ = nullptr;
   }
 
-  void send_acl(std::unique_ptr<hci::BasePacketBuilder> packet) {
-    std::vector<uint8_t> bytes;
-    BitInserter bi(bytes);
-    packet->Serialize(bi);
-    hal_->sendAclData(bytes);
-  }
-
   void send_sco(std::unique_ptr<hci::BasePacketBuilder> packet) {
     std::vector<uint8_t> bytes;
+    bytes.reserve(packet->size());
     BitInserter bi(bytes);
     packet->Serialize(bi);
-    hal_->sendScoData(bytes);
+    hal_->sendScoData(std::move(bytes));
   }
 
   void command_status_callback(EventPacketView event) {
@@ -243,19 +261,14 @@ struct HciLayer::impl : public hal::HciHalCallbacks {
       send_next_command();
       return;
     }
-    ASSERT_LOG(!command_queue_.empty(), "Unexpected status event with OpCode 0x%02hx (%s)", op_code,
+    auto command = find_in_flight_command(op_code);
+    ASSERT_LOG(command != in_flight_commands_.end(), "Unexpected status event with OpCode 0x%02hx (%s)", op_code,
                OpCodeText(op_code).c_str());
-    ASSERT_LOG(waiting_command_ == op_code, "Waiting for 0x%02hx (%s), got 0x%02hx (%s)", waiting_command_,
-               OpCodeText(waiting_command_).c_str(), op_code, OpCodeText(op_code).c_str());
-    ASSERT_LOG(command_queue_.front().waiting_for_status_,
-               "Waiting for command complete 0x%02hx (%s), got command status for 0x%02hx (%s)", waiting_command_,
-               OpCodeText(waiting_command_).c_str(), op_code, OpCodeText(op_code).c_str());
-    auto caller_handler = command_queue_.front().caller_handler;
-    caller_handler->Post(BindOnce(std::move(command_queue_.front().on_status), std::move(status_view)));
-    command_queue_.pop_front();
-    waiting_command_ = OpCode::NONE;
-    hci_timeout_alarm_->Cancel();
-    send_next_command();
+    ASSERT_LOG(command->waiting_for_status_,
+               "Waiting for command complete 0x%02hx (%s), got command status for 0x%02hx (%s)", command->op_code,
+               OpCodeText(command->op_code).c_str(), op_code, OpCodeText(op_code).c_str());
+    command->caller_handler->Post(BindOnce(std::move(command->on_status), std::move(status_view)));
+    on_command_done(command);
   }
 
   void command_complete_callback(EventPacketView event) {
@@ -267,18 +280,34 @@ struct HciLayer::impl : public hal::HciHalCallbacks {
       send_next_command();
       return;
     }
-    ASSERT_LOG(command_queue_.size() > 0, "Unexpected command complete with OpCode 0x%02hx (%s)", op_code,
+    auto command = find_in_flight_command(op_code);
+    ASSERT_LOG(command != in_flight_commands_.end(), "Unexpected command complete with OpCode 0x%02hx (%s)", op_code,
                OpCodeText(op_code).c_str());
-    ASSERT_LOG(waiting_command_ == op_code, "Waiting for 0x%02hx (%s), got 0x%02hx (%s)", waiting_command_,
-               OpCodeText(waiting_command_).c_str(), op_code, OpCodeText(op_code).c_str());
-    ASSERT_LOG(!command_queue_.front().waiting_for_status_,
-               "Waiting for command status 0x%02hx (%s), got command complete for 0x%02hx (%s)", waiting_command_,
-               OpCodeText(waiting_command_).c_str(), op_code, OpCodeText(op_code).c_str());
-    auto caller_handler = command_queue_.front().caller_handler;
-    caller_handler->Post(BindOnce(std::move(command_queue_.front().on_complete), complete_view));
-    command_queue_.pop_front();
-    waiting_command_ = OpCode::NONE;
-    hci_timeout_alarm_->Cancel();
+    ASSERT_LOG(!command->waiting_for_status_,
+               "Waiting for command status 0x%02hx (%s), got command complete for 0x%02hx (%s)", command->op_code,
+               OpCodeText(command->op_code).c_str(), op_code, OpCodeText(op_code).c_str());
+    command->caller_handler->Post(BindOnce(std::move(command->on_complete), complete_view));
+    on_command_done(command);
+  }
+
+  std::list<CommandQueueEntry>::iterator find_in_flight_command(OpCode op_code) {
+    return std::find_if(in_flight_commands_.begin(), in_flight_commands_.end(),
+                        [op_code](const CommandQueueEntry& command) { return command.op_code == op_code; });
+  }
+
+  void on_command_done(std::list<CommandQueueEntry>::iterator command) {
+    auto round_trip = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() -
+                                                                            command->sent_time);
+    auto& timing = command_timings_[command->op_code];
+    timing.count++;
+    timing.total_us += round_trip.count();
+    timing.max_us = std::max<uint64_t>(timing.max_us, round_trip.count());
+
+    bool was_oldest = command == in_flight_commands_.begin();
+    in_flight_commands_.erase(command);
+    if (was_oldest) {
+      schedule_timeout_for_oldest_command();
+    }
     send_next_command();
   }
 
@@ -289,15 +318,19 @@ struct HciLayer::impl : public hal::HciHalCallbacks {
     ASSERT_LOG(subevent_handlers_.find(subevent_code) != subevent_handlers_.end(),
                "Unhandled le event of type 0x%02hhx (%s)", subevent_code, SubeventCodeText(subevent_code).c_str());
     auto& registered_handler = subevent_handlers_[subevent_code].subevent_handler;
-    subevent_handlers_[subevent_code].handler->Post(BindOnce(registered_handler, meta_event_view));
+    subevent_handlers_[subevent_code].handler->Post(
+        [registered_handler, meta_event_view = std::move(meta_event_view)]() mutable {
+          registered_handler.Run(std::move(meta_event_view));
+        });
   }
 
   void hciEventReceived(hal::HciPacket event_bytes) override {
-    auto packet = packet::PacketView<packet::kLittleEndian>(std::make_shared<std::vector<uint8_t>>(event_bytes));
+    auto packet =
+        packet::PacketView<packet::kLittleEndian>(std::make_shared<std::vector<uint8_t>>(std::move(event_bytes)));
     EventPacketView event = EventPacketView::Create(packet);
     ASSERT(event.IsValid());
     module_.GetHandler()->Post(
-        BindOnce(&HciLayer::impl::hci_event_received_handler, common::Unretained(this), std::move(event)));
+        [this, event = std::move(event)]() mutable { hci_event_received_handler(std::move(event)); });
   }
 
   void hci_event_received_handler(EventPacketView event) {
@@ -305,7 +338,8 @@ struct HciLayer::impl : public hal::HciHalCallbacks {
     ASSERT_LOG(event_handlers_.find(event_code) != event_handlers_.end(), "Unhandled event of type 0x%02hhx (%s)",
                event_code, EventCodeText(event_code).c_str());
     auto& registered_handler = event_handlers_[event_code].event_handler;
-    event_handlers_[event_code].handler->Post(BindOnce(registered_handler, std::move(event)));
+    event_handlers_[event_code].handler->Post(
+        [registered_handler, event = std::move(event)]() mutable { registered_handler.Run(std::move(event)); });
   }
 
   void aclDataReceived(hal::HciPacket data_bytes) override {
@@ -316,7 +350,8 @@ struct HciLayer::impl : public hal::HciHalCallbacks {
   }
 
   void scoDataReceived(hal::HciPacket data_bytes) override {
-    auto packet = packet::PacketView<packet::kLittleEndian>(std::make_shared<std::vector<uint8_t>>(data_bytes));
+    auto packet =
+        packet::PacketView<packet::kLittleEndian>(std::make_shared<std::vector<uint8_t>>(std::move(data_bytes)));
     ScoPacketView sco = ScoPacketView::Create(packet);
   }
 
@@ -347,26 +382,66 @@ struct HciLayer::impl : public hal::HciHalCallbacks {
     send_next_command();
   }
 
+  // Sends queued commands in order while the controller has room for them. A command waits while another one with
+  // the same opcode is in flight, so that every Command Status or Command Complete matches a single command.
   void send_next_command() {
-    if (command_credits_ == 0) {
-      return;
+    while (command_credits_ > 0 && !command_queue_.empty()) {
+      auto& command = command_queue_.front();
+      if (command.bytes == nullptr) {
+        command.bytes = std::make_shared<std::vector<uint8_t>>();
+        command.bytes->reserve(command.command->size());
+        BitInserter bi(*command.bytes);
+        command.command->Serialize(bi);
+        auto cmd_view = CommandPacketView::Create(command.bytes);
+        ASSERT(cmd_view.IsValid());
+        command.op_code = cmd_view.GetOpCode();
+      }
+      if (!can_send(command.op_code)) {
+        return;
+      }
+      hal_->sendHciCommand(*command.bytes);
+      command.sent_time = std::chrono::steady_clock::now();
+      command_credits_--;
+      bool was_idle = in_flight_commands_.empty();
+      in_flight_commands_.splice(in_flight_commands_.end(), command_queue_, command_queue_.begin());
+      if (was_idle) {
+        schedule_timeout_for_oldest_command();
+      }
     }
-    if (waiting_command_ != OpCode::NONE) {
-      return;
+  }
+
+  bool can_send(OpCode op_code) const {
+    // Nothing goes out with a reset, it would be discarded by the controller
+    if (op_code == OpCode::RESET) {
+      return in_flight_commands_.empty();
+    }
+    if (!in_flight_commands_.empty() && in_flight_commands_.front().op_code == OpCode::RESET) {
+      return false;
     }
-    if (command_queue_.size() == 0) {
+    return std::none_of(in_flight_commands_.begin(), in_flight_commands_.end(),
+                        [op_code](const CommandQueueEntry& command) { return command.op_code == op_code; });
+  }
+
+  void schedule_timeout_for_oldest_command() {
+    hci_timeout_alarm_->Cancel();
+    if (in_flight_commands_.empty()) {
       return;
     }
-    std::shared_ptr<std::vector<uint8_t>> bytes = std::make_shared<std::vector<uint8_t>>();
-    BitInserter bi(*bytes);
-    command_queue_.front().command->Serialize(bi);
-    hal_->sendHciCommand(*bytes);
-    auto cmd_view = CommandPacketView::Create(bytes);
-    ASSERT(cmd_view.IsValid());
-    OpCode op_code = cmd_view.GetOpCode();
-    waiting_command_ = op_code;
-    command_credits_ = 0;  // Only allow one outstanding command
-    hci_timeout_alarm_->Schedule(BindOnce(&on_hci_timeout, op_code), kHciTimeoutMs);
+    const auto& oldest = in_flight_commands_.front();
+    auto waited = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() -
+                                                                        oldest.sent_time);
+    hci_timeout_alarm_->Schedule(BindOnce(&on_hci_timeout, oldest.op_code),
+                                 std::max(kHciTimeoutMs - waited, std::chrono::milliseconds(0)));
+  }
+
+  void Dump(int fd) {
+    dprintf(fd, "HCI command credits:%hhu queued:%zu in flight:%zu\n", command_credits_, command_queue_.size(),
+            in_flight_commands_.size());
+    for (const auto& [op_code, timing] : command_timings_) {
+      dprintf(fd, "  %s (0x%04hx) sent:%" PRIu64 " average round trip:%" PRIu64 "us max:%" PRIu64 "us\n",
+              OpCodeText(op_code).c_str(), static_cast<uint16_t>(op_code), timing.count, timing.total_us / timing.count,
+              timing.max_us);
+    }
   }
 
   BidiQueueEnd<AclPacketBuilder, AclPacketView>* GetAclQueueEnd() {
@@ -433,10 +508,18 @@ struct HciLayer::impl : public hal::HciHalCallbacks {
 
   // Command Handling
   std::list<CommandQueueEntry> command_queue_;
+  // Sent and waiting for their Command Status or Command Complete, oldest first
+  std::list<CommandQueueEntry> in_flight_commands_;
+
+  struct CommandTiming {
+    uint64_t count = 0;
+    uint64_t total_us = 0;
+    uint64_t max_us = 0;
+  };
+  std::map<OpCode, CommandTiming> command_timings_;
 
   std::map<EventCode, EventHandler> event_handlers_;
   std::map<SubeventCode, SubeventHandler> subevent_handlers_;
-  OpCode waiting_command_{OpCode::NONE};
   uint8_t command_credits_{1};  // Send reset first
   Alarm* hci_timeout_alarm_{nullptr};
 
@@ -461,6 +544,10 @@ void HciLayer::EnqueueCommand(std::unique_ptr<CommandPacketBuilder> command,
   impl_->EnqueueCommand(std::move(command), std::move(on_status), handler);
 }
 
+void HciLayer::Dump(int fd) {
+  impl_->Dump(fd);
+}
+
 common::BidiQueueEnd<AclPacketBuilder, AclPacketView>* HciLayer::GetAclQueueEnd() {
   return impl_->GetAclQueueEnd();
 }
@@ -49,6 +49,9 @@ class HciLayer : public Module {
 
   virtual common::BidiQueueEnd<AclPacketBuilder, AclPacketView>* GetAclQueueEnd();
 
+  // Prints the command queue and the round trip times of each opcode sent so far
+  void Dump(int fd);
+
   virtual void RegisterEventHandler(EventCode event_code, common::Callback<void(EventPacketView)> event_handler,
                                     os::Handler* handler);
 
@@ -502,6 +502,93 @@ TEST_F(HciTest, creditsTest) {
              .IsValid());
 }
 
+TEST_F(HciTest, pipelinedCommandsCompleteOutOfOrder) {
+  // Let the controller take three commands at once
+  uint8_t num_packets = 3;
+  hal->callbacks->hciEventReceived(GetPacketBytes(NoCommandCompleteBuilder::Create(num_packets)));
+  // The event is handed to the command complete handler on the same handler
+  ASSERT_TRUE(fake_registry_.SynchronizeModuleHandler(&HciLayer::Factory, kTimeout));
+  ASSERT_TRUE(fake_registry_.SynchronizeModuleHandler(&HciLayer::Factory, kTimeout));
+
+  auto command_future = hal->GetSentCommandFuture();
+  upper->SendHciCommandExpectingComplete(ReadLocalVersionInformationBuilder::Create());
+  upper->SendHciCommandExpectingComplete(ReadLocalSupportedCommandsBuilder::Create());
+  upper->SendHciCommandExpectingComplete(ReadLocalSupportedFeaturesBuilder::Create());
+  ASSERT_EQ(command_future.wait_for(kTimeout), std::future_status::ready);
+  ASSERT_TRUE(fake_registry_.SynchronizeModuleHandler(&HciLayer::Factory, kTimeout));
+
+  // All three are sent without waiting for a response
+  ASSERT_EQ(3, hal->GetNumSentCommands());
+  ASSERT_TRUE(ReadLocalVersionInformationView::Create(hal->GetSentCommand()).IsValid());
+  ASSERT_TRUE(ReadLocalSupportedCommandsView::Create(hal->GetSentCommand()).IsValid());
+  ASSERT_TRUE(ReadLocalSupportedFeaturesView::Create(hal->GetSentCommand()).IsValid());
+
+  // The last one completes first
+  auto event_future = upper->GetReceivedEventFuture();
+  ErrorCode error_code = ErrorCode::SUCCESS;
+  uint64_t lmp_features = 0x012345678abcdef;
+  hal->callbacks->hciEventReceived(
+      GetPacketBytes(ReadLocalSupportedFeaturesCompleteBuilder::Create(num_packets, error_code, lmp_features)));
+  ASSERT_EQ(event_future.wait_for(kTimeout), std::future_status::ready);
+  auto event = CommandCompleteView::Create(EventPacketView::Create(upper->GetReceivedEvent()));
+  ASSERT_TRUE(ReadLocalSupportedFeaturesCompleteView::Create(event).IsValid());
+
+  event_future = upper->GetReceivedEventFuture();
+  LocalVersionInformation local_version_information;
+  local_version_information.hci_version_ = HciVersion::V_5_0;
+  local_version_information.hci_revision_ = 0x1234;
+  local_version_information.lmp_version_ = LmpVersion::V_4_2;
+  local_version_information.manufacturer_name_ = 0xBAD;
+  local_version_information.lmp_subversion_ = 0x5678;
+  hal->callbacks->hciEventReceived(GetPacketBytes(
+      ReadLocalVersionInformationCompleteBuilder::Create(num_packets, error_code, local_version_information)));
+  ASSERT_EQ(event_future.wait_for(kTimeout), std::future_status::ready);
+  event = CommandCompleteView::Create(EventPacketView::Create(upper->GetReceivedEvent()));
+  ASSERT_TRUE(ReadLocalVersionInformationCompleteView::Create(event).IsValid());
+
+  event_future = upper->GetReceivedEventFuture();
+  std::array<uint8_t, 64> supported_commands{};
+  hal->callbacks->hciEventReceived(
+      GetPacketBytes(ReadLocalSupportedCommandsCompleteBuilder::Create(num_packets, error_code, supported_commands)));
+  ASSERT_EQ(event_future.wait_for(kTimeout), std::future_status::ready);
+  event = CommandCompleteView::Create(EventPacketView::Create(upper->GetReceivedEvent()));
+  ASSERT_TRUE(ReadLocalSupportedCommandsCompleteView::Create(event).IsValid());
+}
+
+TEST_F(HciTest, commandWaitsForInFlightCommandWithSameOpCode) {
+  uint8_t num_packets = 2;
+  hal->callbacks->hciEventReceived(GetPacketBytes(NoCommandCompleteBuilder::Create(num_packets)));
+  ASSERT_TRUE(fake_registry_.SynchronizeModuleHandler(&HciLayer::Factory, kTimeout));
+  ASSERT_TRUE(fake_registry_.SynchronizeModuleHandler(&HciLayer::Factory, kTimeout));
+
+  auto command_future = hal->GetSentCommandFuture();
+  upper->SendHciCommandExpectingComplete(ReadLocalVersionInformationBuilder::Create());
+  upper->SendHciCommandExpectingComplete(ReadLocalVersionInformationBuilder::Create());
+  ASSERT_EQ(command_future.wait_for(kTimeout), std::future_status::ready);
+  ASSERT_TRUE(fake_registry_.SynchronizeModuleHandler(&HciLayer::Factory, kTimeout));
+
+  // The second one would not be told apart from the first one by its Command Complete
+  ASSERT_EQ(1, hal->GetNumSentCommands());
+  ASSERT_TRUE(ReadLocalVersionInformationView::Create(hal->GetSentCommand()).IsValid());
+
+  command_future = hal->GetSentCommandFuture();
+  auto event_future = upper->GetReceivedEventFuture();
+  LocalVersionInformation local_version_information;
+  local_version_information.hci_version_ = HciVersion::V_5_0;
+  local_version_information.hci_revision_ = 0x1234;
+  local_version_information.lmp_version_ = LmpVersion::V_4_2;
+  local_version_information.manufacturer_name_ = 0xBAD;
+  local_version_information.lmp_subversion_ = 0x5678;
+  hal->callbacks->hciEventReceived(GetPacketBytes(ReadLocalVersionInformationCompleteBuilder::Create(
+      num_packets, ErrorCode::SUCCESS, local_version_information)));
+  ASSERT_EQ(event_future.wait_for(kTimeout), std::future_status::ready);
+  upper->GetReceivedEvent();
+
+  ASSERT_EQ(command_future.wait_for(kTimeout), std::future_status::ready);
+  ASSERT_EQ(1, hal->GetNumSentCommands());
+  ASSERT_TRUE(ReadLocalVersionInformationView::Create(hal->GetSentCommand()).IsValid());
+}
+
 TEST_F(HciTest, leSecurityInterfaceTest) {
   // Send LeRand to the controller
   auto command_future = hal->GetSentCommandFuture();
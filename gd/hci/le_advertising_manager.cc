@@ -13,6 +13,10 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
 #include <memory>
 #include <mutex>
 
@@ -36,12 +40,43 @@ enum class AdvertisingApiType {
   LE_5_0 = 3,
 };
 
+// Largest data in one LE Set Extended Advertising Data or Scan Response Data command
+constexpr size_t kLeMaximumFragmentLength = 251;
+// Largest data in one LE Set Periodic Advertising Data command
+constexpr size_t kLePeriodicMaximumFragmentLength = 252;
+
 struct Advertiser {
   os::Handler* handler;
   common::Callback<void(Address, AddressType)> scan_callback;
   common::Callback<void(ErrorCode, uint8_t, uint8_t)> set_terminated_callback;
+
+  // The commands starting the set are enqueued back to back, and counted down as they complete
+  std::chrono::steady_clock::time_point start_time;
+  size_t pending_start_commands = 0;
+  ErrorCode start_status = ErrorCode::SUCCESS;
+
+  bool has_periodic_data = false;
+  std::vector<uint8_t> periodic_data;
 };
 
+static std::vector<uint8_t> SerializeGapData(const std::vector<GapData>& gap_data) {
+  std::vector<uint8_t> data;
+  for (const GapData& item : gap_data) {
+    data.push_back(static_cast<uint8_t>(item.data_.size() + 1));
+    data.push_back(static_cast<uint8_t>(item.data_type_));
+    data.insert(data.end(), item.data_.begin(), item.data_.end());
+  }
+  return data;
+}
+
+static Operation GetFragmentOperation(size_t offset, size_t length, size_t total_length) {
+  bool last = offset + length == total_length;
+  if (offset == 0) {
+    return last ? Operation::COMPLETE_ADVERTISEMENT : Operation::FIRST_FRAGMENT;
+  }
+  return last ? Operation::LAST_FRAGMENT : Operation::INTERMEDIATE_FRAGMENT;
+}
+
 ExtendedAdvertisingConfig::ExtendedAdvertisingConfig(const AdvertisingConfig& config) : AdvertisingConfig(config) {
   switch (config.event_type) {
     case AdvertisingEventType::ADV_IND:
@@ -71,7 +106,6 @@ ExtendedAdvertisingConfig::ExtendedAdvertisingConfig(const AdvertisingConfig& co
   } else if (config.address_type == AddressType::RANDOM_DEVICE_ADDRESS) {
     own_address_type = OwnAddressType::RANDOM_DEVICE_ADDRESS;
   }
-  // TODO(b/149221472): Support fragmentation
   operation = Operation::COMPLETE_ADVERTISEMENT;
 }
 
@@ -163,46 +197,39 @@ struct LeAdvertisingManager::impl {
     advertising_sets_[id].handler = handler;
     switch (advertising_api_type_) {
       case (AdvertisingApiType::LE_4_0):
-        le_advertising_interface_->EnqueueCommand(
-            hci::LeSetAdvertisingParametersBuilder::Create(
-                config.interval_min, config.interval_max, config.event_type, config.address_type,
-                config.peer_address_type, config.peer_address, config.channel_map, config.filter_policy),
-            common::BindOnce(impl::check_status<LeSetAdvertisingParametersCompleteView>), module_handler_);
-        le_advertising_interface_->EnqueueCommand(hci::LeSetRandomAddressBuilder::Create(config.random_address),
-                                                  common::BindOnce(impl::check_status<LeSetRandomAddressCompleteView>),
-                                                  module_handler_);
+        start_batch(id);
+        enqueue_start_command<LeSetAdvertisingParametersCompleteView>(
+            id, hci::LeSetAdvertisingParametersBuilder::Create(
+                    config.interval_min, config.interval_max, config.event_type, config.address_type,
+                    config.peer_address_type, config.peer_address, config.channel_map, config.filter_policy));
+        enqueue_start_command<LeSetRandomAddressCompleteView>(
+            id, hci::LeSetRandomAddressBuilder::Create(config.random_address));
         if (!config.scan_response.empty()) {
-          le_advertising_interface_->EnqueueCommand(
-              hci::LeSetScanResponseDataBuilder::Create(config.scan_response),
-              common::BindOnce(impl::check_status<LeSetScanResponseDataCompleteView>), module_handler_);
+          enqueue_start_command<LeSetScanResponseDataCompleteView>(
+              id, hci::LeSetScanResponseDataBuilder::Create(config.scan_response));
         }
-        le_advertising_interface_->EnqueueCommand(
-            hci::LeSetAdvertisingDataBuilder::Create(config.advertisement),
-            common::BindOnce(impl::check_status<LeSetAdvertisingDataCompleteView>), module_handler_);
-        le_advertising_interface_->EnqueueCommand(
-            hci::LeSetAdvertisingEnableBuilder::Create(Enable::ENABLED),
-            common::BindOnce(impl::check_status<LeSetAdvertisingEnableCompleteView>), module_handler_);
+        enqueue_start_command<LeSetAdvertisingDataCompleteView>(
+            id, hci::LeSetAdvertisingDataBuilder::Create(config.advertisement));
+        enqueue_start_command<LeSetAdvertisingEnableCompleteView>(
+            id, hci::LeSetAdvertisingEnableBuilder::Create(Enable::ENABLED));
         break;
       case (AdvertisingApiType::ANDROID_HCI):
-        le_advertising_interface_->EnqueueCommand(
-            hci::LeMultiAdvtParamBuilder::Create(config.interval_min, config.interval_max, config.event_type,
-                                                 config.address_type, config.peer_address_type, config.peer_address,
-                                                 config.channel_map, config.filter_policy, id, config.tx_power),
-            common::BindOnce(impl::check_status<LeMultiAdvtCompleteView>), module_handler_);
-        le_advertising_interface_->EnqueueCommand(hci::LeMultiAdvtSetDataBuilder::Create(config.advertisement, id),
-                                                  common::BindOnce(impl::check_status<LeMultiAdvtCompleteView>),
-                                                  module_handler_);
+        start_batch(id);
+        enqueue_start_command<LeMultiAdvtCompleteView>(
+            id, hci::LeMultiAdvtParamBuilder::Create(config.interval_min, config.interval_max, config.event_type,
+                                                     config.address_type, config.peer_address_type,
+                                                     config.peer_address, config.channel_map, config.filter_policy,
+                                                     id, config.tx_power));
+        enqueue_start_command<LeMultiAdvtCompleteView>(
+            id, hci::LeMultiAdvtSetDataBuilder::Create(config.advertisement, id));
         if (!config.scan_response.empty()) {
-          le_advertising_interface_->EnqueueCommand(
-              hci::LeMultiAdvtSetScanRespBuilder::Create(config.scan_response, id),
-              common::BindOnce(impl::check_status<LeMultiAdvtCompleteView>), module_handler_);
+          enqueue_start_command<LeMultiAdvtCompleteView>(
+              id, hci::LeMultiAdvtSetScanRespBuilder::Create(config.scan_response, id));
         }
-        le_advertising_interface_->EnqueueCommand(
-            hci::LeMultiAdvtSetRandomAddrBuilder::Create(config.random_address, id),
-            common::BindOnce(impl::check_status<LeMultiAdvtCompleteView>), module_handler_);
-        le_advertising_interface_->EnqueueCommand(hci::LeMultiAdvtSetEnableBuilder::Create(Enable::ENABLED, id),
-                                                  common::BindOnce(impl::check_status<LeMultiAdvtCompleteView>),
-                                                  module_handler_);
+        enqueue_start_command<LeMultiAdvtCompleteView>(
+            id, hci::LeMultiAdvtSetRandomAddrBuilder::Create(config.random_address, id));
+        enqueue_start_command<LeMultiAdvtCompleteView>(
+            id, hci::LeMultiAdvtSetEnableBuilder::Create(Enable::ENABLED, id));
         break;
       case (AdvertisingApiType::LE_5_0): {
         ExtendedAdvertisingConfig new_config = config;
@@ -221,6 +248,7 @@ struct LeAdvertisingManager::impl {
       return;
     }
 
+    start_batch(id);
     if (config.legacy_pdus) {
       LegacyAdvertisingProperties legacy_properties = LegacyAdvertisingProperties::ADV_IND;
       if (config.connectable && config.directed) {
@@ -237,40 +265,32 @@ struct LeAdvertisingManager::impl {
         legacy_properties = LegacyAdvertisingProperties::ADV_NONCONN_IND;
       }
 
-      le_advertising_interface_->EnqueueCommand(
-          LeSetExtendedAdvertisingLegacyParametersBuilder::Create(
-              id, legacy_properties, config.interval_min, config.interval_max, config.channel_map,
-              config.own_address_type, config.peer_address_type, config.peer_address, config.filter_policy,
-              config.tx_power, config.sid, config.enable_scan_request_notifications),
-          common::BindOnce(impl::check_status<LeSetExtendedAdvertisingParametersCompleteView>), module_handler_);
+      enqueue_start_command<LeSetExtendedAdvertisingParametersCompleteView>(
+          id, LeSetExtendedAdvertisingLegacyParametersBuilder::Create(
+                  id, legacy_properties, config.interval_min, config.interval_max, config.channel_map,
+                  config.own_address_type, config.peer_address_type, config.peer_address, config.filter_policy,
+                  config.tx_power, config.sid, config.enable_scan_request_notifications));
     } else {
       uint8_t legacy_properties = (config.connectable ? 0x1 : 0x00) | (config.scannable ? 0x2 : 0x00) |
                                   (config.directed ? 0x4 : 0x00) | (config.high_duty_directed_connectable ? 0x8 : 0x00);
       uint8_t extended_properties = (config.anonymous ? 0x20 : 0x00) | (config.include_tx_power ? 0x40 : 0x00);
 
-      le_advertising_interface_->EnqueueCommand(
-          hci::LeSetExtendedAdvertisingParametersBuilder::Create(
-              id, legacy_properties, extended_properties, config.interval_min, config.interval_max, config.channel_map,
-              config.own_address_type, config.peer_address_type, config.peer_address, config.filter_policy,
-              config.tx_power, (config.use_le_coded_phy ? PrimaryPhyType::LE_CODED : PrimaryPhyType::LE_1M),
-              config.secondary_max_skip, config.secondary_advertising_phy, config.sid,
-              config.enable_scan_request_notifications),
-          common::BindOnce(impl::check_status<LeSetExtendedAdvertisingParametersCompleteView>), module_handler_);
+      enqueue_start_command<LeSetExtendedAdvertisingParametersCompleteView>(
+          id, hci::LeSetExtendedAdvertisingParametersBuilder::Create(
+                  id, legacy_properties, extended_properties, config.interval_min, config.interval_max,
+                  config.channel_map, config.own_address_type, config.peer_address_type, config.peer_address,
+                  config.filter_policy, config.tx_power,
+                  (config.use_le_coded_phy ? PrimaryPhyType::LE_CODED : PrimaryPhyType::LE_1M),
+                  config.secondary_max_skip, config.secondary_advertising_phy, config.sid,
+                  config.enable_scan_request_notifications));
     }
 
-    le_advertising_interface_->EnqueueCommand(
-        hci::LeSetExtendedAdvertisingRandomAddressBuilder::Create(id, config.random_address),
-        common::BindOnce(impl::check_status<LeSetExtendedAdvertisingRandomAddressCompleteView>), module_handler_);
+    enqueue_start_command<LeSetExtendedAdvertisingRandomAddressCompleteView>(
+        id, hci::LeSetExtendedAdvertisingRandomAddressBuilder::Create(id, config.random_address));
     if (!config.scan_response.empty()) {
-      le_advertising_interface_->EnqueueCommand(
-          hci::LeSetExtendedAdvertisingScanResponseBuilder::Create(id, config.operation, config.fragment_preference,
-                                                                   config.scan_response),
-          common::BindOnce(impl::check_status<LeSetExtendedAdvertisingScanResponseCompleteView>), module_handler_);
+      enqueue_extended_data(id, config, true);
     }
-    le_advertising_interface_->EnqueueCommand(
-        hci::LeSetExtendedAdvertisingDataBuilder::Create(id, config.operation, config.fragment_preference,
-                                                         config.advertisement),
-        common::BindOnce(impl::check_status<LeSetExtendedAdvertisingDataCompleteView>), module_handler_);
+    enqueue_extended_data(id, config, false);
 
     EnabledSet curr_set;
     curr_set.advertising_handle_ = id;
@@ -279,15 +299,162 @@ struct LeAdvertisingManager::impl {
     std::vector<EnabledSet> enabled_sets = {curr_set};
 
     enabled_sets_[id] = curr_set;
-    le_advertising_interface_->EnqueueCommand(
-        hci::LeSetExtendedAdvertisingEnableBuilder::Create(Enable::ENABLED, enabled_sets),
-        common::BindOnce(impl::check_status<LeSetExtendedAdvertisingEnableCompleteView>), module_handler_);
+    enqueue_start_command<LeSetExtendedAdvertisingEnableCompleteView>(
+        id, hci::LeSetExtendedAdvertisingEnableBuilder::Create(Enable::ENABLED, enabled_sets));
 
     advertising_sets_[id].scan_callback = scan_callback;
     advertising_sets_[id].set_terminated_callback = set_terminated_callback;
     advertising_sets_[id].handler = handler;
   }
 
+  // Data that does not fit in one command is sent in fragments, which the HCI layer keeps in order
+  void enqueue_extended_data(AdvertiserId id, const ExtendedAdvertisingConfig& config, bool scan_response) {
+    std::vector<uint8_t> data = SerializeGapData(scan_response ? config.scan_response : config.advertisement);
+    if (data.size() <= kLeMaximumFragmentLength) {
+      if (scan_response) {
+        enqueue_start_command<LeSetExtendedAdvertisingScanResponseCompleteView>(
+            id, hci::LeSetExtendedAdvertisingScanResponseBuilder::Create(id, config.operation,
+                                                                         config.fragment_preference,
+                                                                         config.scan_response));
+      } else {
+        enqueue_start_command<LeSetExtendedAdvertisingDataCompleteView>(
+            id, hci::LeSetExtendedAdvertisingDataBuilder::Create(id, config.operation, config.fragment_preference,
+                                                                 config.advertisement));
+      }
+      return;
+    }
+    for (size_t offset = 0; offset < data.size(); offset += kLeMaximumFragmentLength) {
+      size_t length = std::min(kLeMaximumFragmentLength, data.size() - offset);
+      std::vector<uint8_t> fragment(data.begin() + offset, data.begin() + offset + length);
+      Operation operation = GetFragmentOperation(offset, length, data.size());
+      if (scan_response) {
+        enqueue_start_command<LeSetExtendedAdvertisingScanResponseCompleteView>(
+            id, hci::LeSetExtendedAdvertisingScanResponseRawBuilder::Create(id, operation, config.fragment_preference,
+                                                                            fragment));
+      } else {
+        enqueue_start_command<LeSetExtendedAdvertisingDataCompleteView>(
+            id, hci::LeSetExtendedAdvertisingDataRawBuilder::Create(id, operation, config.fragment_preference,
+                                                                    fragment));
+      }
+    }
+  }
+
+  void start_batch(AdvertiserId id) {
+    Advertiser& advertiser = advertising_sets_[id];
+    advertiser.start_time = std::chrono::steady_clock::now();
+    advertiser.pending_start_commands = 0;
+    advertiser.start_status = ErrorCode::SUCCESS;
+  }
+
+  // The commands of a set are not serialized here: the HCI layer sends them as the controller returns command
+  // credits, and the set is started once the last one completes.
+  template <class View>
+  void enqueue_start_command(AdvertiserId id, std::unique_ptr<LeAdvertisingCommandBuilder> command) {
+    advertising_sets_[id].pending_start_commands++;
+    le_advertising_interface_->EnqueueCommand(
+        std::move(command),
+        common::BindOnce(&impl::on_start_command_complete<View>, common::Unretained(this), id), module_handler_);
+  }
+
+  template <class View>
+  void on_start_command_complete(AdvertiserId id, CommandCompleteView view) {
+    ASSERT(view.IsValid());
+    auto status_view = View::Create(view);
+    ASSERT(status_view.IsValid());
+    auto advertiser = advertising_sets_.find(id);
+    if (advertiser == advertising_sets_.end() || advertiser->second.pending_start_commands == 0) {
+      // Removed before it was started
+      return;
+    }
+    if (status_view.GetStatus() != ErrorCode::SUCCESS && advertiser->second.start_status == ErrorCode::SUCCESS) {
+      LOG_INFO("%s returned status %s", OpCodeText(view.GetCommandOpCode()).c_str(),
+               ErrorCodeText(status_view.GetStatus()).c_str());
+      advertiser->second.start_status = status_view.GetStatus();
+    }
+    if (--advertiser->second.pending_start_commands > 0) {
+      return;
+    }
+
+    auto latency = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() -
+                                                                         advertiser->second.start_time);
+    std::unique_lock lock(stats_mutex_);
+    if (advertiser->second.start_status != ErrorCode::SUCCESS) {
+      LOG_WARN("Advertising set %d failed to start: %s", id, ErrorCodeText(advertiser->second.start_status).c_str());
+      start_stats_.failed++;
+      return;
+    }
+    LOG_DEBUG("Advertising set %d started in %" PRId64 "us", id, static_cast<int64_t>(latency.count()));
+    start_stats_.count++;
+    start_stats_.total_us += latency.count();
+    start_stats_.max_us = std::max(start_stats_.max_us, static_cast<uint64_t>(latency.count()));
+  }
+
+  void set_periodic_parameters(AdvertiserId id, PeriodicAdvertisingParameters parameters) {
+    if (!check_periodic_advertiser(id)) {
+      return;
+    }
+    le_advertising_interface_->EnqueueCommand(
+        hci::LeSetPeriodicAdvertisingParamBuilder::Create(id, parameters.interval_min, parameters.interval_max,
+                                                          parameters.include_tx_power ? 1 : 0),
+        common::BindOnce(impl::check_status<LeSetPeriodicAdvertisingParamCompleteView>), module_handler_);
+  }
+
+  void set_periodic_data(AdvertiserId id, std::vector<GapData> gap_data) {
+    if (!check_periodic_advertiser(id)) {
+      return;
+    }
+    Advertiser& advertiser = advertising_sets_[id];
+    std::vector<uint8_t> data = SerializeGapData(gap_data);
+    if (advertiser.has_periodic_data && data == advertiser.periodic_data) {
+      LOG_DEBUG("Periodic advertising data of set %d is unchanged", id);
+      return;
+    }
+    // The controller has no partial update, so a changed payload is sent whole
+    size_t offset = 0;
+    do {
+      size_t length = std::min(kLePeriodicMaximumFragmentLength, data.size() - offset);
+      std::vector<uint8_t> fragment(data.begin() + offset, data.begin() + offset + length);
+      le_advertising_interface_->EnqueueCommand(
+          hci::LeSetPeriodicAdvertisingDataBuilder::Create(id, GetFragmentOperation(offset, length, data.size()),
+                                                           fragment),
+          common::BindOnce(impl::check_status<LeSetPeriodicAdvertisingDataCompleteView>), module_handler_);
+      offset += length;
+    } while (offset < data.size());
+    advertiser.has_periodic_data = true;
+    advertiser.periodic_data = std::move(data);
+  }
+
+  void enable_periodic_advertising(AdvertiserId id, bool enable) {
+    if (!check_periodic_advertiser(id)) {
+      return;
+    }
+    le_advertising_interface_->EnqueueCommand(
+        hci::LeSetPeriodicAdvertisingEnableBuilder::Create(id, enable ? Enable::ENABLED : Enable::DISABLED),
+        common::BindOnce(impl::check_status<LeSetPeriodicAdvertisingEnableCompleteView>), module_handler_);
+  }
+
+  bool check_periodic_advertiser(AdvertiserId id) {
+    if (advertising_api_type_ != AdvertisingApiType::LE_5_0) {
+      LOG_INFO("Periodic advertising needs extended advertising");
+      return false;
+    }
+    if (advertising_sets_.find(id) == advertising_sets_.end()) {
+      LOG_INFO("Unknown advertising set %u", id);
+      return false;
+    }
+    return true;
+  }
+
+  void Dump(int fd) {
+    std::unique_lock lock(stats_mutex_);
+    dprintf(fd, "LE advertising sets started:%" PRIu64 " failed:%" PRIu64, start_stats_.count, start_stats_.failed);
+    if (start_stats_.count > 0) {
+      dprintf(fd, " average start latency:%" PRIu64 "us max:%" PRIu64 "us", start_stats_.total_us / start_stats_.count,
+              start_stats_.max_us);
+    }
+    dprintf(fd, "\n");
+  }
+
   void stop_advertising(AdvertiserId advertising_set) {
     if (advertising_sets_.find(advertising_set) == advertising_sets_.end()) {
       LOG_INFO("Unknown advertising set %u", advertising_set);
@@ -333,6 +500,15 @@ struct LeAdvertisingManager::impl {
   size_t num_instances_;
   std::vector<hci::EnabledSet> enabled_sets_;
 
+  struct StartStats {
+    uint64_t count = 0;
+    uint64_t failed = 0;
+    uint64_t total_us = 0;
+    uint64_t max_us = 0;
+  };
+  std::mutex stats_mutex_;
+  StartStats start_stats_;
+
   AdvertisingApiType advertising_api_type_{0};
 
   template <class View>
@@ -435,5 +611,27 @@ void LeAdvertisingManager::RemoveAdvertiser(AdvertiserId id) {
   GetHandler()->Post(common::BindOnce(&impl::remove_advertiser, common::Unretained(pimpl_.get()), id));
 }
 
+void LeAdvertisingManager::SetPeriodicParameters(AdvertiserId id, const PeriodicAdvertisingParameters& parameters) {
+  if (parameters.interval_min > parameters.interval_max) {
+    LOG_INFO("Periodic advertising interval: min (%hu) > max (%hu)", parameters.interval_min, parameters.interval_max);
+    return;
+  }
+  GetHandler()->Post(
+      common::BindOnce(&impl::set_periodic_parameters, common::Unretained(pimpl_.get()), id, parameters));
+}
+
+void LeAdvertisingManager::SetPeriodicData(AdvertiserId id, const std::vector<GapData>& data) {
+  GetHandler()->Post(common::BindOnce(&impl::set_periodic_data, common::Unretained(pimpl_.get()), id, data));
+}
+
+void LeAdvertisingManager::EnablePeriodicAdvertising(AdvertiserId id, bool enable) {
+  GetHandler()->Post(
+      common::BindOnce(&impl::enable_periodic_advertising, common::Unretained(pimpl_.get()), id, enable));
+}
+
+void LeAdvertisingManager::Dump(int fd) {
+  pimpl_->Dump(fd);
+}
+
 }  // namespace hci
 }  // namespace bluetooth
@@ -54,12 +54,19 @@ class ExtendedAdvertisingConfig : public AdvertisingConfig {
   uint8_t sid = 0x00;
   Enable enable_scan_request_notifications = Enable::DISABLED;
   OwnAddressType own_address_type;
-  Operation operation;  // TODO(b/149221472): Support fragmentation
+  Operation operation;  // Data longer than one command is always fragmented by the host
   FragmentPreference fragment_preference = FragmentPreference::CONTROLLER_SHOULD_NOT;
   ExtendedAdvertisingConfig() = default;
   ExtendedAdvertisingConfig(const AdvertisingConfig& config);
 };
 
+class PeriodicAdvertisingParameters {
+ public:
+  uint16_t interval_min;  // 0x0006 to 0xFFFF (7.5 ms to 82s)
+  uint16_t interval_max;  // 0x0006 to 0xFFFF (7.5 ms to 82s)
+  bool include_tx_power = false;
+};
+
 using AdvertiserId = int32_t;
 
 class LeAdvertisingManager : public bluetooth::Module {
@@ -80,6 +87,17 @@ class LeAdvertisingManager : public bluetooth::Module {
 
   void RemoveAdvertiser(AdvertiserId id);
 
+  // Periodic advertising of an extended advertiser, only when the controller supports extended advertising
+  void SetPeriodicParameters(AdvertiserId id, const PeriodicAdvertisingParameters& parameters);
+
+  // Nothing is sent to the controller if |data| is what the advertiser already has
+  void SetPeriodicData(AdvertiserId id, const std::vector<GapData>& data);
+
+  void EnablePeriodicAdvertising(AdvertiserId id, bool enable);
+
+  // Prints how many advertising sets were started and how long their commands took to complete
+  void Dump(int fd);
+
   static const ModuleFactory Factory;
 
  protected:
@@ -422,6 +422,91 @@ TEST_F(LeExtendedAdvertisingManagerTest, create_advertiser_test) {
   ASSERT_EQ(std::future_status::ready, result);
   test_hci_layer_->IncomingEvent(LeSetExtendedAdvertisingEnableCompleteBuilder::Create(uint8_t{1}, ErrorCode::SUCCESS));
 }
+
+TEST_F(LeExtendedAdvertisingManagerTest, create_advertiser_fragmented_data_test) {
+  ExtendedAdvertisingConfig advertising_config{};
+  advertising_config.event_type = AdvertisingEventType::ADV_NONCONN_IND;
+  advertising_config.address_type = AddressType::PUBLIC_DEVICE_ADDRESS;
+  std::vector<GapData> gap_data{};
+  GapData data_item{};
+  data_item.data_type_ = GapDataType::MANUFACTURER_SPECIFIC_DATA;
+  data_item.data_ = std::vector<uint8_t>(198, 0x42);
+  gap_data.push_back(data_item);
+  gap_data.push_back(data_item);
+  advertising_config.advertisement = gap_data;
+  advertising_config.channel_map = 1;
+
+  auto last_command_future = test_hci_layer_->GetCommandFuture(OpCode::LE_SET_EXTENDED_ADVERTISING_ENABLE);
+  auto id = le_advertising_manager_->ExtendedCreateAdvertiser(advertising_config, scan_callback,
+                                                              set_terminated_callback, client_handler_);
+  ASSERT_NE(LeAdvertisingManager::kInvalidId, id);
+  auto result = last_command_future.wait_for(std::chrono::duration(std::chrono::milliseconds(100)));
+  ASSERT_EQ(std::future_status::ready, result);
+  // 400 bytes of data take two commands, all sent before the first completes
+  ASSERT_EQ(5u, last_command_future.get());
+
+  test_hci_layer_->GetCommandPacket(OpCode::LE_SET_EXTENDED_ADVERTISING_PARAMETERS);
+  test_hci_layer_->GetCommandPacket(OpCode::LE_SET_EXTENDED_ADVERTISING_RANDOM_ADDRESS);
+  std::vector<Operation> operations = {Operation::FIRST_FRAGMENT, Operation::LAST_FRAGMENT};
+  std::vector<size_t> lengths = {251, 149};
+  for (size_t i = 0; i < operations.size(); i++) {
+    auto packet = test_hci_layer_->GetCommandPacket(OpCode::LE_SET_EXTENDED_ADVERTISING_DATA);
+    auto data_packet = LeSetExtendedAdvertisingDataRawView::Create(LeAdvertisingCommandView::Create(packet));
+    ASSERT_TRUE(data_packet.IsValid());
+    EXPECT_EQ(operations[i], data_packet.GetOperation());
+    EXPECT_EQ(lengths[i], data_packet.GetAdvertisingData().size());
+  }
+  test_hci_layer_->GetCommandPacket(OpCode::LE_SET_EXTENDED_ADVERTISING_ENABLE);
+}
+
+TEST_F(LeExtendedAdvertisingManagerTest, unchanged_periodic_data_test) {
+  ExtendedAdvertisingConfig advertising_config{};
+  advertising_config.event_type = AdvertisingEventType::ADV_NONCONN_IND;
+  advertising_config.address_type = AddressType::PUBLIC_DEVICE_ADDRESS;
+  advertising_config.channel_map = 1;
+
+  auto last_command_future = test_hci_layer_->GetCommandFuture(OpCode::LE_SET_EXTENDED_ADVERTISING_ENABLE);
+  auto id = le_advertising_manager_->ExtendedCreateAdvertiser(advertising_config, scan_callback,
+                                                              set_terminated_callback, client_handler_);
+  ASSERT_NE(LeAdvertisingManager::kInvalidId, id);
+  auto result = last_command_future.wait_for(std::chrono::duration(std::chrono::milliseconds(100)));
+  ASSERT_EQ(std::future_status::ready, result);
+  std::vector<OpCode> adv_opcodes = {
+      OpCode::LE_SET_EXTENDED_ADVERTISING_PARAMETERS,
+      OpCode::LE_SET_EXTENDED_ADVERTISING_RANDOM_ADDRESS,
+      OpCode::LE_SET_EXTENDED_ADVERTISING_DATA,
+      OpCode::LE_SET_EXTENDED_ADVERTISING_ENABLE,
+  };
+  ASSERT_EQ(adv_opcodes.size(), last_command_future.get());
+  for (size_t i = 0; i < adv_opcodes.size(); i++) {
+    test_hci_layer_->GetCommandPacket(adv_opcodes[i]);
+  }
+
+  std::vector<GapData> gap_data{};
+  GapData data_item{};
+  data_item.data_type_ = GapDataType::COMPLETE_LOCAL_NAME;
+  data_item.data_ = {'r', 'a', 'n', 'd', 'o', 'm', ' ', 'd', 'e', 'v', 'i', 'c', 'e'};
+  gap_data.push_back(data_item);
+
+  auto data_future = test_hci_layer_->GetCommandFuture(OpCode::LE_SET_PERIODIC_ADVERTISING_DATA);
+  le_advertising_manager_->SetPeriodicData(id, gap_data);
+  ASSERT_EQ(std::future_status::ready, data_future.wait_for(std::chrono::milliseconds(100)));
+  ASSERT_EQ(1u, data_future.get());
+  test_hci_layer_->GetCommandPacket(OpCode::LE_SET_PERIODIC_ADVERTISING_DATA);
+
+  // The same data again is not sent, new data is
+  le_advertising_manager_->SetPeriodicData(id, gap_data);
+  gap_data[0].data_.push_back('!');
+  data_future = test_hci_layer_->GetCommandFuture(OpCode::LE_SET_PERIODIC_ADVERTISING_DATA);
+  le_advertising_manager_->SetPeriodicData(id, gap_data);
+  ASSERT_EQ(std::future_status::ready, data_future.wait_for(std::chrono::milliseconds(100)));
+  ASSERT_EQ(1u, data_future.get());
+  auto packet = test_hci_layer_->GetCommandPacket(OpCode::LE_SET_PERIODIC_ADVERTISING_DATA);
+  auto data_packet = LeSetPeriodicAdvertisingDataView::Create(LeAdvertisingCommandView::Create(packet));
+  ASSERT_TRUE(data_packet.IsValid());
+  EXPECT_EQ(Operation::COMPLETE_ADVERTISEMENT, data_packet.GetOperation());
+  EXPECT_EQ(16u, data_packet.GetScanResponseData().size());
+}
 }  // namespace
 }  // namespace hci
 }  // namespace bluetooth
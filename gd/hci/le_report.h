@@ -83,4 +83,64 @@ class ExtendedLeReport : public DirectedLeReport {
   bool complete_;
   bool truncated_;
 };
+
+// A report decoded by LeScanningManager into a batch that is reused from one HCI event to the next, so decoding it
+// makes no allocation. The advertising data is kept in its raw length, type, value form and points into the batch:
+// like the report itself, it is only valid during the callback it is passed to.
+struct LeAdvertisement {
+  LeReport::ReportType report_type_{LeReport::ReportType::ADVERTISING_EVENT};
+  // Legacy reports only
+  AdvertisingEventType advertising_event_type_{};
+  Address address_{};
+  // An AddressType for legacy reports, a DirectAdvertisingAddressType otherwise
+  uint8_t address_type_{};
+  int8_t rssi_{};
+  // Directed and extended reports only
+  uint8_t direct_address_type_{};
+  Address direct_address_{};
+  // Extended reports only. Fragments are reassembled, so a report is either complete or truncated.
+  bool connectable_{};
+  bool scannable_{};
+  bool directed_{};
+  bool scan_response_{};
+  bool truncated_{};
+  uint8_t advertising_sid_{};
+  int8_t tx_power_{};
+  PrimaryPhyType primary_phy_{PrimaryPhyType::LE_1M};
+  SecondaryPhyType secondary_phy_{SecondaryPhyType::NO_PACKETS};
+  uint16_t periodic_advertising_interval_{};
+
+  const uint8_t* data_{nullptr};
+  size_t data_length_{0};
+};
+
+// The reports decoded from one HCI event, which the callback may not keep
+class LeAdvertisementSpan {
+ public:
+  LeAdvertisementSpan(const LeAdvertisement* reports, size_t size) : reports_(reports), size_(size) {}
+
+  const LeAdvertisement* begin() const {
+    return reports_;
+  }
+
+  const LeAdvertisement* end() const {
+    return reports_ + size_;
+  }
+
+  const LeAdvertisement& operator[](size_t index) const {
+    return reports_[index];
+  }
+
+  size_t size() const {
+    return size_;
+  }
+
+  bool empty() const {
+    return size_ == 0;
+  }
+
+ private:
+  const LeAdvertisement* reports_;
+  size_t size_;
+};
 }  // namespace bluetooth::hci
\ No newline at end of file
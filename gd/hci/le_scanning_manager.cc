@@ -13,9 +13,13 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#include <algorithm>
+#include <deque>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <set>
+#include <unordered_set>
 
 #include "hci/controller.h"
 #include "hci/hci_layer.h"
@@ -32,8 +36,179 @@ namespace hci {
 constexpr uint16_t kDefaultLeScanWindow = 4800;
 constexpr uint16_t kDefaultLeScanInterval = 4800;
 
+// The most advertising data an extended report can be reassembled to
+constexpr size_t kMaxExtendedAdvertisingDataLength = 1650;
+// The most advertisers an extended report may be reassembled for at once
+constexpr size_t kMaxPendingFragmentedReports = 16;
+// The most reports the duplicate filter remembers, the oldest is forgotten first
+constexpr size_t kMaxDuplicateFilterEntries = 256;
+// The most batches kept for reuse once the client is done with them
+constexpr size_t kMaxFreeBatches = 4;
+
 const ModuleFactory LeScanningManager::Factory = ModuleFactory([]() { return new LeScanningManager(); });
 
+namespace {
+
+void SerializeGapData(const std::vector<GapData>& gap_data, std::vector<uint8_t>* data) {
+  for (const GapData& item : gap_data) {
+    data->push_back(static_cast<uint8_t>(item.data_.size() + 1));
+    data->push_back(static_cast<uint8_t>(item.data_type_));
+    data->insert(data->end(), item.data_.begin(), item.data_.end());
+  }
+}
+
+std::vector<GapData> ParseGapData(const uint8_t* data, size_t length) {
+  std::vector<GapData> gap_data;
+  size_t offset = 0;
+  while (offset + 1 < length && data[offset] != 0 && offset + 1 + data[offset] <= length) {
+    GapData item;
+    item.data_type_ = static_cast<GapDataType>(data[offset + 1]);
+    item.data_.assign(data + offset + 2, data + offset + 1 + data[offset]);
+    gap_data.push_back(std::move(item));
+    offset += 1 + data[offset];
+  }
+  return gap_data;
+}
+
+}  // namespace
+
+// The reports decoded from one HCI event. Their advertising data is appended to one buffer, and the buffers keep their
+// capacity when the batch is reused, so decoding a batch only allocates while it grows.
+class LeAdvertisementBatch {
+ public:
+  void Clear() {
+    reports_.clear();
+    data_offsets_.clear();
+    data_.clear();
+  }
+
+  // Adds a report, whose advertising data is then appended with AppendData() or AppendGapData() before the next one
+  LeAdvertisement& Add() {
+    data_offsets_.push_back(data_.size());
+    reports_.emplace_back();
+    return reports_.back();
+  }
+
+  void AppendData(const uint8_t* data, size_t length) {
+    data_.insert(data_.end(), data, data + length);
+  }
+
+  void AppendGapData(const std::vector<GapData>& gap_data) {
+    SerializeGapData(gap_data, &data_);
+  }
+
+  // Removes the last report added, with its data
+  void RemoveLast() {
+    data_.resize(data_offsets_.back());
+    data_offsets_.pop_back();
+    reports_.pop_back();
+  }
+
+  const LeAdvertisement& Last() const {
+    return reports_.back();
+  }
+
+  // The data of the last report added, which may still grow
+  const uint8_t* LastData(size_t* length) const {
+    *length = data_.size() - data_offsets_.back();
+    return data_.data() + data_offsets_.back();
+  }
+
+  bool IsEmpty() const {
+    return reports_.empty();
+  }
+
+  // Points the reports to their data, which may not grow any more
+  LeAdvertisementSpan Finish() {
+    for (size_t i = 0; i < reports_.size(); i++) {
+      size_t end = i + 1 < reports_.size() ? data_offsets_[i + 1] : data_.size();
+      reports_[i].data_ = data_.data() + data_offsets_[i];
+      reports_[i].data_length_ = end - data_offsets_[i];
+    }
+    return LeAdvertisementSpan(reports_.data(), reports_.size());
+  }
+
+ private:
+  std::vector<LeAdvertisement> reports_;
+  std::vector<size_t> data_offsets_;
+  std::vector<uint8_t> data_;
+};
+
+// Batches go to the client handler and come back once the callback returns, so the pool is shared with the closures
+// that deliver them and outlives the module if they are still pending.
+class LeAdvertisementBatchPool {
+ public:
+  std::unique_ptr<LeAdvertisementBatch> Acquire() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (free_batches_.empty()) {
+      return std::make_unique<LeAdvertisementBatch>();
+    }
+    std::unique_ptr<LeAdvertisementBatch> batch = std::move(free_batches_.back());
+    free_batches_.pop_back();
+    return batch;
+  }
+
+  void Release(std::unique_ptr<LeAdvertisementBatch> batch) {
+    batch->Clear();
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (free_batches_.size() < kMaxFreeBatches) {
+      free_batches_.push_back(std::move(batch));
+    }
+  }
+
+ private:
+  std::mutex mutex_;
+  std::vector<std::unique_ptr<LeAdvertisementBatch>> free_batches_;
+};
+
+void LeScanningManagerCallbacks::OnAdvertisingReports(LeAdvertisementSpan reports) {
+  std::vector<std::shared_ptr<LeReport>> param;
+  param.reserve(reports.size());
+  for (const LeAdvertisement& report : reports) {
+    switch (report.report_type_) {
+      case LeReport::ReportType::ADVERTISING_EVENT: {
+        LeAdvertisingReport advertising_report;
+        advertising_report.event_type_ = report.advertising_event_type_;
+        advertising_report.address_type_ = static_cast<AddressType>(report.address_type_);
+        advertising_report.address_ = report.address_;
+        advertising_report.advertising_data_ = ParseGapData(report.data_, report.data_length_);
+        advertising_report.rssi_ = report.rssi_;
+        param.push_back(std::make_shared<LeReport>(advertising_report));
+      } break;
+      case LeReport::ReportType::DIRECTED_ADVERTISING_EVENT: {
+        LeDirectedAdvertisingReport directed_report;
+        directed_report.address_type_ = static_cast<DirectAdvertisingAddressType>(report.address_type_);
+        directed_report.address_ = report.address_;
+        directed_report.direct_address_type_ = static_cast<DirectAddressType>(report.direct_address_type_);
+        directed_report.direct_address_ = report.direct_address_;
+        directed_report.rssi_ = report.rssi_;
+        param.push_back(std::make_shared<DirectedLeReport>(directed_report));
+      } break;
+      case LeReport::ReportType::EXTENDED_ADVERTISING_EVENT: {
+        LeExtendedAdvertisingReport extended_report;
+        extended_report.connectable_ = report.connectable_;
+        extended_report.scannable_ = report.scannable_;
+        extended_report.directed_ = report.directed_;
+        extended_report.scan_response_ = report.scan_response_;
+        extended_report.data_status_ = report.truncated_ ? DataStatus::TRUNCATED : DataStatus::COMPLETE;
+        extended_report.address_type_ = static_cast<DirectAdvertisingAddressType>(report.address_type_);
+        extended_report.address_ = report.address_;
+        extended_report.primary_phy_ = report.primary_phy_;
+        extended_report.secondary_phy_ = report.secondary_phy_;
+        extended_report.advertising_sid_ = report.advertising_sid_;
+        extended_report.tx_power_ = report.tx_power_;
+        extended_report.rssi_ = report.rssi_;
+        extended_report.periodic_advertising_interval_ = report.periodic_advertising_interval_;
+        extended_report.direct_address_type_ = static_cast<DirectAdvertisingAddressType>(report.direct_address_type_);
+        extended_report.direct_address_ = report.direct_address_;
+        extended_report.advertising_data_ = ParseGapData(report.data_, report.data_length_);
+        param.push_back(std::make_shared<ExtendedLeReport>(extended_report));
+      } break;
+    }
+  }
+  on_advertisements(std::move(param));
+}
+
 enum class ScanApiType {
   LE_4_0 = 1,
   ANDROID_HCI = 2,
@@ -62,16 +237,13 @@ struct LeScanningManager::impl {
   void handle_scan_results(LeMetaEventView event) {
     switch (event.GetSubeventCode()) {
       case hci::SubeventCode::ADVERTISING_REPORT:
-        handle_advertising_report<LeAdvertisingReportView, LeAdvertisingReport, LeReport>(
-            LeAdvertisingReportView::Create(event));
+        handle_advertising_report(LeAdvertisingReportView::Create(event));
         break;
       case hci::SubeventCode::DIRECTED_ADVERTISING_REPORT:
-        handle_advertising_report<LeDirectedAdvertisingReportView, LeDirectedAdvertisingReport, DirectedLeReport>(
-            LeDirectedAdvertisingReportView::Create(event));
+        handle_advertising_report(LeDirectedAdvertisingReportView::Create(event));
         break;
       case hci::SubeventCode::EXTENDED_ADVERTISING_REPORT:
-        handle_advertising_report<LeExtendedAdvertisingReportView, LeExtendedAdvertisingReport, ExtendedLeReport>(
-            LeExtendedAdvertisingReportView::Create(event));
+        handle_advertising_report(LeExtendedAdvertisingReportView::Create(event));
         break;
       case hci::SubeventCode::SCAN_TIMEOUT:
         if (registered_callback_ != nullptr) {
@@ -85,7 +257,7 @@ struct LeScanningManager::impl {
     }
   }
 
-  template <class EventType, class ReportStructType, class ReportType>
+  template <class EventType>
   void handle_advertising_report(EventType event_view) {
     if (registered_callback_ == nullptr) {
       LOG_INFO("Dropping advertising event (no registered handler)");
@@ -95,25 +267,136 @@ struct LeScanningManager::impl {
       LOG_INFO("Dropping invalid advertising event");
       return;
     }
-    std::vector<ReportStructType> report_vector = event_view.GetAdvertisingReports();
+    auto report_vector = event_view.GetAdvertisingReports();
     if (report_vector.empty()) {
       LOG_INFO("Zero results in advertising event");
       return;
     }
-    std::vector<std::shared_ptr<LeReport>> param;
-    param.reserve(report_vector.size());
-    for (const ReportStructType& report : report_vector) {
-      param.push_back(std::shared_ptr<LeReport>(static_cast<LeReport*>(new ReportType(report))));
+    std::unique_ptr<LeAdvertisementBatch> batch = batch_pool_->Acquire();
+    for (const auto& report : report_vector) {
+      if (decode_report(report, batch.get()) && filter_duplicates_ && is_duplicate(batch.get())) {
+        batch->RemoveLast();
+      }
+    }
+    if (batch->IsEmpty()) {
+      batch_pool_->Release(std::move(batch));
+      return;
+    }
+    registered_callback_->Handler()->Post(
+        [pool = batch_pool_, callbacks = registered_callback_, batch = std::move(batch)]() mutable {
+          callbacks->OnAdvertisingReports(batch->Finish());
+          pool->Release(std::move(batch));
+        });
+  }
+
+  // Each decode_report() adds the report to |batch| and returns true, unless it is a fragment that is not complete yet
+  bool decode_report(const LeAdvertisingReport& report, LeAdvertisementBatch* batch) {
+    LeAdvertisement& advertisement = batch->Add();
+    advertisement.report_type_ = LeReport::ReportType::ADVERTISING_EVENT;
+    advertisement.advertising_event_type_ = report.event_type_;
+    advertisement.address_ = report.address_;
+    advertisement.address_type_ = static_cast<uint8_t>(report.address_type_);
+    advertisement.rssi_ = report.rssi_;
+    batch->AppendGapData(report.advertising_data_);
+    return true;
+  }
+
+  bool decode_report(const LeDirectedAdvertisingReport& report, LeAdvertisementBatch* batch) {
+    LeAdvertisement& advertisement = batch->Add();
+    advertisement.report_type_ = LeReport::ReportType::DIRECTED_ADVERTISING_EVENT;
+    advertisement.address_ = report.address_;
+    advertisement.address_type_ = static_cast<uint8_t>(report.address_type_);
+    advertisement.rssi_ = report.rssi_;
+    advertisement.direct_address_type_ = static_cast<uint8_t>(report.direct_address_type_);
+    advertisement.direct_address_ = report.direct_address_;
+    return true;
+  }
+
+  // The controller splits extended advertising data that does not fit in one event over several reports from the same
+  // advertiser and set, all but the last one marked as continuing. Their data is kept until the last one arrives.
+  bool decode_report(const LeExtendedAdvertisingReport& report, LeAdvertisementBatch* batch) {
+    auto key = std::make_pair(report.address_, static_cast<uint8_t>(report.advertising_sid_));
+    auto pending = pending_fragments_.find(key);
+    if (report.data_status_ == DataStatus::CONTINUING) {
+      if (pending == pending_fragments_.end()) {
+        if (pending_fragments_.size() >= kMaxPendingFragmentedReports) {
+          LOG_INFO("Dropping fragmented advertising report (too many pending)");
+          return false;
+        }
+        pending = pending_fragments_.emplace(key, std::vector<uint8_t>()).first;
+      }
+      SerializeGapData(report.advertising_data_, &pending->second);
+      if (pending->second.size() <= kMaxExtendedAdvertisingDataLength) {
+        return false;
+      }
+    }
+
+    LeAdvertisement& advertisement = batch->Add();
+    advertisement.report_type_ = LeReport::ReportType::EXTENDED_ADVERTISING_EVENT;
+    advertisement.address_ = report.address_;
+    advertisement.address_type_ = static_cast<uint8_t>(report.address_type_);
+    advertisement.rssi_ = report.rssi_;
+    advertisement.direct_address_type_ = static_cast<uint8_t>(report.direct_address_type_);
+    advertisement.direct_address_ = report.direct_address_;
+    advertisement.connectable_ = report.connectable_;
+    advertisement.scannable_ = report.scannable_;
+    advertisement.directed_ = report.directed_;
+    advertisement.scan_response_ = report.scan_response_;
+    advertisement.advertising_sid_ = report.advertising_sid_;
+    advertisement.tx_power_ = report.tx_power_;
+    advertisement.primary_phy_ = report.primary_phy_;
+    advertisement.secondary_phy_ = report.secondary_phy_;
+    advertisement.periodic_advertising_interval_ = report.periodic_advertising_interval_;
+    if (pending == pending_fragments_.end()) {
+      advertisement.truncated_ = report.data_status_ == DataStatus::TRUNCATED;
+      batch->AppendGapData(report.advertising_data_);
+      return true;
+    }
+
+    // The data grew past the limit, or this is the last fragment
+    if (report.data_status_ != DataStatus::CONTINUING) {
+      SerializeGapData(report.advertising_data_, &pending->second);
+    }
+    size_t length = std::min(pending->second.size(), kMaxExtendedAdvertisingDataLength);
+    advertisement.truncated_ =
+        report.data_status_ != DataStatus::COMPLETE || pending->second.size() > kMaxExtendedAdvertisingDataLength;
+    batch->AppendData(pending->second.data(), length);
+    pending_fragments_.erase(pending);
+    return true;
+  }
+
+  // Returns true if the last report of |batch| was delivered before, and remembers it otherwise
+  bool is_duplicate(const LeAdvertisementBatch* batch) {
+    size_t length;
+    const uint8_t* data = batch->LastData(&length);
+    uint64_t hash = kFnvOffsetBasis;
+    auto add = [&hash](uint8_t byte) { hash = (hash ^ byte) * kFnvPrime; };
+    const LeAdvertisement& report = batch->Last();
+    for (uint8_t byte : report.address_.address) {
+      add(byte);
+    }
+    add(report.address_type_);
+    add(static_cast<uint8_t>(report.report_type_));
+    add(report.scan_response_);
+    for (size_t i = 0; i < length; i++) {
+      add(data[i]);
     }
-    registered_callback_->Handler()->Post(common::BindOnce(&LeScanningManagerCallbacks::on_advertisements,
-                                                           common::Unretained(registered_callback_), param));
+    if (!duplicate_filter_.insert(hash).second) {
+      return true;
+    }
+    duplicate_filter_order_.push_back(hash);
+    if (duplicate_filter_order_.size() > kMaxDuplicateFilterEntries) {
+      duplicate_filter_.erase(duplicate_filter_order_.front());
+      duplicate_filter_order_.pop_front();
+    }
+    return false;
   }
 
   void configure_scan() {
     std::vector<PhyScanParameters> parameter_vector;
     PhyScanParameters phy_scan_parameters;
-    phy_scan_parameters.le_scan_window_ = kDefaultLeScanWindow;
-    phy_scan_parameters.le_scan_interval_ = kDefaultLeScanInterval;
+    phy_scan_parameters.le_scan_window_ = scan_window_;
+    phy_scan_parameters.le_scan_interval_ = scan_interval_;
     phy_scan_parameters.le_scan_type_ = LeScanType::ACTIVE;
     parameter_vector.push_back(phy_scan_parameters);
     uint8_t phys_in_use = 1;
@@ -140,19 +423,41 @@ struct LeScanningManager::impl {
     }
   }
 
-  void start_scan(LeScanningManagerCallbacks* le_scanning_manager_callbacks) {
+  // The controller could filter duplicates too, but it may then drop the reports of an advertiser whose data changed,
+  // and it would see the fragments rather than the reassembled reports
+  void start_scan(LeScanningManagerCallbacks* le_scanning_manager_callbacks, bool filter_duplicates) {
     registered_callback_ = le_scanning_manager_callbacks;
+    filter_duplicates_ = filter_duplicates;
+    duplicate_filter_.clear();
+    duplicate_filter_order_.clear();
+    pending_fragments_.clear();
+    enable_scan(Enable::ENABLED);
+  }
+
+  // The parameters can't be changed while scanning, so a scan in progress is disabled around the change
+  void set_scan_parameters(uint16_t scan_interval, uint16_t scan_window) {
+    scan_interval_ = scan_interval;
+    scan_window_ = scan_window;
+    interval_ms_ = scan_interval;
+    window_ms_ = scan_window;
+    bool scanning = registered_callback_ != nullptr;
+    if (scanning) enable_scan(Enable::DISABLED);
+    configure_scan();
+    if (scanning) enable_scan(Enable::ENABLED);
+  }
+
+  void enable_scan(Enable enable) {
     switch (api_type_) {
       case ScanApiType::LE_5_0:
         le_scanning_interface_->EnqueueCommand(
-            hci::LeSetExtendedScanEnableBuilder::Create(Enable::ENABLED,
-                                                        FilterDuplicates::DISABLED /* filter duplicates */, 0, 0),
+            hci::LeSetExtendedScanEnableBuilder::Create(enable, FilterDuplicates::DISABLED /* filter duplicates */, 0,
+                                                        0),
             common::BindOnce(impl::check_status), module_handler_);
         break;
       case ScanApiType::ANDROID_HCI:
       case ScanApiType::LE_4_0:
         le_scanning_interface_->EnqueueCommand(
-            hci::LeSetScanEnableBuilder::Create(Enable::ENABLED, Enable::DISABLED /* filter duplicates */),
+            hci::LeSetScanEnableBuilder::Create(enable, Enable::DISABLED /* filter duplicates */),
             common::BindOnce(impl::check_status), module_handler_);
         break;
     }
@@ -163,27 +468,21 @@ struct LeScanningManager::impl {
       return;
     }
     registered_callback_->Handler()->Post(std::move(on_stopped));
-    switch (api_type_) {
-      case ScanApiType::LE_5_0:
-        le_scanning_interface_->EnqueueCommand(
-            hci::LeSetExtendedScanEnableBuilder::Create(Enable::DISABLED,
-                                                        FilterDuplicates::DISABLED /* filter duplicates */, 0, 0),
-            common::BindOnce(impl::check_status), module_handler_);
-        registered_callback_ = nullptr;
-        break;
-      case ScanApiType::ANDROID_HCI:
-      case ScanApiType::LE_4_0:
-        le_scanning_interface_->EnqueueCommand(
-            hci::LeSetScanEnableBuilder::Create(Enable::DISABLED, Enable::DISABLED /* filter duplicates */),
-            common::BindOnce(impl::check_status), module_handler_);
-        registered_callback_ = nullptr;
-        break;
-    }
+    enable_scan(Enable::DISABLED);
+    registered_callback_ = nullptr;
   }
 
+  static constexpr uint64_t kFnvOffsetBasis = 0xcbf29ce484222325;
+  static constexpr uint64_t kFnvPrime = 0x100000001b3;
+
   ScanApiType api_type_;
 
   LeScanningManagerCallbacks* registered_callback_;
+  std::shared_ptr<LeAdvertisementBatchPool> batch_pool_ = std::make_shared<LeAdvertisementBatchPool>();
+  std::map<std::pair<Address, uint8_t>, std::vector<uint8_t>> pending_fragments_;
+  bool filter_duplicates_{false};
+  std::unordered_set<uint64_t> duplicate_filter_;
+  std::deque<uint64_t> duplicate_filter_order_;
   Module* module_;
   os::Handler* module_handler_;
   hci::HciLayer* hci_layer_;
@@ -192,6 +491,8 @@ struct LeScanningManager::impl {
 
   uint32_t interval_ms_{1000};
   uint16_t window_ms_{1000};
+  uint16_t scan_interval_{kDefaultLeScanInterval};
+  uint16_t scan_window_{kDefaultLeScanWindow};
   AddressType own_address_type_{AddressType::PUBLIC_DEVICE_ADDRESS};
   LeSetScanningFilterPolicy filter_policy_{LeSetScanningFilterPolicy::ACCEPT_ALL};
 
@@ -249,13 +550,18 @@ std::string LeScanningManager::ToString() const {
   return "Le Scanning Manager";
 }
 
-void LeScanningManager::StartScan(LeScanningManagerCallbacks* callbacks) {
-  GetHandler()->Post(common::Bind(&impl::start_scan, common::Unretained(pimpl_.get()), callbacks));
+void LeScanningManager::StartScan(LeScanningManagerCallbacks* callbacks, bool filter_duplicates) {
+  GetHandler()->Post(common::Bind(&impl::start_scan, common::Unretained(pimpl_.get()), callbacks, filter_duplicates));
 }
 
 void LeScanningManager::StopScan(common::Callback<void()> on_stopped) {
   GetHandler()->Post(common::Bind(&impl::stop_scan, common::Unretained(pimpl_.get()), on_stopped));
 }
 
+void LeScanningManager::SetScanParameters(uint16_t scan_interval, uint16_t scan_window) {
+  GetHandler()->Post(
+      common::BindOnce(&impl::set_scan_parameters, common::Unretained(pimpl_.get()), scan_interval, scan_window));
+}
+
 }  // namespace hci
 }  // namespace bluetooth
@@ -28,7 +28,10 @@ namespace hci {
 class LeScanningManagerCallbacks {
  public:
   virtual ~LeScanningManagerCallbacks() = default;
-  virtual void on_advertisements(std::vector<std::shared_ptr<LeReport>>) = 0;
+  // Receives the reports of one HCI event without copying them. The default implementation converts them to LeReport
+  // objects for on_advertisements(), so clients that keep the reports can stay on that interface.
+  virtual void OnAdvertisingReports(LeAdvertisementSpan reports);
+  virtual void on_advertisements(std::vector<std::shared_ptr<LeReport>>) {}
   virtual void on_timeout() = 0;
   virtual os::Handler* Handler() = 0;
 };
@@ -37,10 +40,15 @@ class LeScanningManager : public bluetooth::Module {
  public:
   LeScanningManager();
 
-  void StartScan(LeScanningManagerCallbacks* callbacks);
+  // With |filter_duplicates|, a report is dropped if one with the same address and data was delivered since the scan
+  // started.
+  void StartScan(LeScanningManagerCallbacks* callbacks, bool filter_duplicates = false);
 
   void StopScan(common::Callback<void()> on_stopped);
 
+  // Sets the scan duty cycle, in 0.625 ms units. A scan in progress is restarted with it.
+  void SetScanParameters(uint16_t scan_interval, uint16_t scan_window);
+
   static const ModuleFactory Factory;
 
  protected:
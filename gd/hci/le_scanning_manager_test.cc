@@ -187,6 +187,7 @@ class LeScanningManagerTest : public ::testing::Test {
     client_handler_ = fake_registry_.GetTestModuleHandler(&HciLayer::Factory);
     ASSERT_NE(client_handler_, nullptr);
     mock_callbacks_.handler_ = client_handler_;
+    recording_callbacks_.handler_ = client_handler_;
     std::future<void> config_future = test_hci_layer_->GetCommandFuture();
     fake_registry_.Start<LeScanningManager>(&thread_);
     le_scanning_manager =
@@ -223,6 +224,31 @@ class LeScanningManagerTest : public ::testing::Test {
     os::Handler* handler_{nullptr};
   } mock_callbacks_;
 
+  struct RecordedReport {
+    Address address;
+    std::vector<uint8_t> data;
+    bool truncated;
+  };
+
+  // Copies the reports, which may not be kept past the callback, one vector per batch
+  class RecordingLeScanningManagerCallbacks : public LeScanningManagerCallbacks {
+   public:
+    void OnAdvertisingReports(LeAdvertisementSpan reports) override {
+      std::vector<RecordedReport> batch;
+      for (const LeAdvertisement& report : reports) {
+        batch.push_back({report.address_, std::vector<uint8_t>(report.data_, report.data_ + report.data_length_),
+                         report.truncated_});
+      }
+      batches_.push_back(std::move(batch));
+    }
+    void on_timeout() override {}
+    os::Handler* Handler() override {
+      return handler_;
+    }
+    os::Handler* handler_{nullptr};
+    std::vector<std::vector<RecordedReport>> batches_;
+  } recording_callbacks_;
+
   OpCode param_opcode_{OpCode::LE_SET_ADVERTISING_PARAMETERS};
 };
 
@@ -338,6 +364,105 @@ TEST_F(LeExtendedScanningManagerTest, start_scan_test) {
   test_hci_layer_->IncomingLeMetaEvent(LeExtendedAdvertisingReportBuilder::Create({report}));
 }
 
+GapData MakeGapData(GapDataType data_type, std::vector<uint8_t> data) {
+  GapData gap_data;
+  gap_data.data_type_ = data_type;
+  gap_data.data_ = std::move(data);
+  return gap_data;
+}
+
+TEST_F(LeScanningManagerTest, batched_reports_test) {
+  auto next_command_future = test_hci_layer_->GetCommandFuture();
+  le_scanning_manager->StartScan(&recording_callbacks_);
+
+  auto result = next_command_future.wait_for(std::chrono::duration(std::chrono::milliseconds(100)));
+  ASSERT_EQ(std::future_status::ready, result);
+  test_hci_layer_->IncomingEvent(LeSetScanEnableCompleteBuilder::Create(uint8_t{1}, ErrorCode::SUCCESS));
+
+  LeAdvertisingReport first{};
+  first.event_type_ = AdvertisingEventType::ADV_IND;
+  Address::FromString("12:34:56:78:9a:bc", first.address_);
+  first.advertising_data_ = {MakeGapData(GapDataType::FLAGS, {0x34}),
+                             MakeGapData(GapDataType::COMPLETE_LOCAL_NAME, {'a', 'b'})};
+  LeAdvertisingReport second{};
+  second.event_type_ = AdvertisingEventType::ADV_NONCONN_IND;
+  Address::FromString("12:34:56:78:9a:bd", second.address_);
+
+  test_hci_layer_->IncomingLeMetaEvent(LeAdvertisingReportBuilder::Create({first, second}));
+  ASSERT_TRUE(fake_registry_.SynchronizeModuleHandler(&HciLayer::Factory, std::chrono::milliseconds(100)));
+
+  // Both reports come in one call, with the advertising data in its raw form
+  ASSERT_EQ(recording_callbacks_.batches_.size(), 1u);
+  const std::vector<RecordedReport>& batch = recording_callbacks_.batches_[0];
+  ASSERT_EQ(batch.size(), 2u);
+  EXPECT_EQ(batch[0].address, first.address_);
+  EXPECT_EQ(batch[0].data, std::vector<uint8_t>({0x02, 0x01, 0x34, 0x03, 0x09, 'a', 'b'}));
+  EXPECT_EQ(batch[1].address, second.address_);
+  EXPECT_TRUE(batch[1].data.empty());
+}
+
+TEST_F(LeScanningManagerTest, duplicate_filter_test) {
+  auto next_command_future = test_hci_layer_->GetCommandFuture();
+  le_scanning_manager->StartScan(&recording_callbacks_, true /* filter_duplicates */);
+
+  auto result = next_command_future.wait_for(std::chrono::duration(std::chrono::milliseconds(100)));
+  ASSERT_EQ(std::future_status::ready, result);
+  test_hci_layer_->IncomingEvent(LeSetScanEnableCompleteBuilder::Create(uint8_t{1}, ErrorCode::SUCCESS));
+
+  LeAdvertisingReport report{};
+  report.event_type_ = AdvertisingEventType::ADV_IND;
+  Address::FromString("12:34:56:78:9a:bc", report.address_);
+  report.advertising_data_ = {MakeGapData(GapDataType::FLAGS, {0x34})};
+  LeAdvertisingReport changed = report;
+  changed.advertising_data_ = {MakeGapData(GapDataType::FLAGS, {0x35})};
+
+  test_hci_layer_->IncomingLeMetaEvent(LeAdvertisingReportBuilder::Create({report}));
+  test_hci_layer_->IncomingLeMetaEvent(LeAdvertisingReportBuilder::Create({report, changed}));
+  test_hci_layer_->IncomingLeMetaEvent(LeAdvertisingReportBuilder::Create({changed}));
+  ASSERT_TRUE(fake_registry_.SynchronizeModuleHandler(&HciLayer::Factory, std::chrono::milliseconds(100)));
+
+  // Only the report whose data changed gets through, and an event left with no report is not delivered
+  ASSERT_EQ(recording_callbacks_.batches_.size(), 2u);
+  ASSERT_EQ(recording_callbacks_.batches_[1].size(), 1u);
+  EXPECT_EQ(recording_callbacks_.batches_[1][0].data, std::vector<uint8_t>({0x02, 0x01, 0x35}));
+}
+
+TEST_F(LeExtendedScanningManagerTest, fragment_reassembly_test) {
+  auto next_command_future = test_hci_layer_->GetCommandFuture();
+  le_scanning_manager->StartScan(&recording_callbacks_);
+
+  auto result = next_command_future.wait_for(std::chrono::duration(std::chrono::milliseconds(100)));
+  ASSERT_EQ(std::future_status::ready, result);
+  auto packet = test_hci_layer_->GetCommandPacket(OpCode::LE_SET_EXTENDED_SCAN_ENABLE);
+
+  test_hci_layer_->IncomingEvent(LeSetScanEnableCompleteBuilder::Create(uint8_t{1}, ErrorCode::SUCCESS));
+
+  LeExtendedAdvertisingReport first{};
+  first.connectable_ = 1;
+  first.data_status_ = DataStatus::CONTINUING;
+  first.advertising_sid_ = 3;
+  Address::FromString("12:34:56:78:9a:bc", first.address_);
+  first.advertising_data_ = {MakeGapData(GapDataType::FLAGS, {0x34})};
+  // Another set of the same advertiser, which is not fragmented
+  LeExtendedAdvertisingReport other = first;
+  other.data_status_ = DataStatus::COMPLETE;
+  other.advertising_sid_ = 4;
+  LeExtendedAdvertisingReport last = first;
+  last.data_status_ = DataStatus::COMPLETE;
+  last.advertising_data_ = {MakeGapData(GapDataType::COMPLETE_LOCAL_NAME, {'a', 'b'})};
+
+  test_hci_layer_->IncomingLeMetaEvent(LeExtendedAdvertisingReportBuilder::Create({first, other}));
+  test_hci_layer_->IncomingLeMetaEvent(LeExtendedAdvertisingReportBuilder::Create({last}));
+  ASSERT_TRUE(fake_registry_.SynchronizeModuleHandler(&HciLayer::Factory, std::chrono::milliseconds(100)));
+
+  ASSERT_EQ(recording_callbacks_.batches_.size(), 2u);
+  ASSERT_EQ(recording_callbacks_.batches_[0].size(), 1u);
+  EXPECT_EQ(recording_callbacks_.batches_[0][0].data, std::vector<uint8_t>({0x02, 0x01, 0x34}));
+  ASSERT_EQ(recording_callbacks_.batches_[1].size(), 1u);
+  EXPECT_EQ(recording_callbacks_.batches_[1][0].data, std::vector<uint8_t>({0x02, 0x01, 0x34, 0x03, 0x09, 'a', 'b'}));
+  EXPECT_FALSE(recording_callbacks_.batches_[1][0].truncated);
+}
+
 }  // namespace
 }  // namespace hci
 }  // namespace bluetooth
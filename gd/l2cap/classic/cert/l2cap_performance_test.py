@@ -0,0 +1,211 @@
+#
+#   Copyright 2020 - The Android Open Source Project
+#
+#   Licensed under the Apache License, Version 2.0 (the "License");
+#   you may not use this file except in compliance with the License.
+#   You may obtain a copy of the License at
+#
+#       http://www.apache.org/licenses/LICENSE-2.0
+#
+#   Unless required by applicable law or agreed to in writing, software
+#   distributed under the License is distributed on an "AS IS" BASIS,
+#   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#   See the License for the specific language governing permissions and
+#   limitations under the License.
+
+import json
+import logging
+import os
+import struct
+import threading
+import time
+
+from acts import context
+from mobly import asserts
+
+from cert.event_asserts import EventAsserts
+from cert.event_callback_stream import EventCallbackStream
+from google.protobuf import empty_pb2 as empty_proto
+from l2cap.classic import facade_pb2 as l2cap_facade_pb2
+# Imported as a module, so that the test runner does not also find L2capTest
+# here
+from l2cap.classic.cert import l2cap_test
+from bluetooth_packets_python3 import l2cap_packets
+
+METRICS_FILE_NAME = 'l2cap_performance_metrics.json'
+
+# Header of the payloads generated by SendDynamicChannelPacketBurst: sequence
+# number and CLOCK_MONOTONIC send time in nanoseconds
+BURST_HEADER = struct.Struct('<IQ')
+
+# Basic frame header: length and channel id
+BASIC_FRAME_HEADER_SIZE = 4
+# Enhanced control field of ERTM I-frames and S-frames
+ERTM_CONTROL_SIZE = 2
+
+BURST_TIMEOUT_SECONDS = 60
+
+
+class L2capPerformanceTest(l2cap_test.L2capTest):
+    """
+    Sustained throughput and latency of L2CAP dynamic channels, from the stack
+    under test to the cert stack over rootcanal.
+
+    The stack under test generates the traffic itself with
+    SendDynamicChannelPacketBurst, so there is no gRPC call per packet on the
+    sending side. The cert stack streams the received ACL data back in batches
+    with FetchAclDataBatch. Latency is measured from the send time embedded in
+    each payload to the moment the cert test sees the packet, on the same
+    monotonic clock since both stacks run on this host. It includes the
+    streaming delay of the cert side, so it is an upper bound of the stack
+    latency.
+
+    Each run appends one JSON object per line to l2cap_performance_metrics.json
+    in the test output directory.
+    """
+
+    def get_existing_test_names(self):
+        # Only the performance scenarios, not the functional tests of L2capTest
+        return [
+            name for name in super().get_existing_test_names()
+            if name.startswith('test_performance_')
+        ]
+
+    def _record_metrics(self, metrics):
+        logging.info("L2CAP performance: %s" % json.dumps(metrics))
+        metrics_path = os.path.join(
+            context.get_current_context().get_full_output_path(),
+            METRICS_FILE_NAME)
+        with open(metrics_path, 'a') as metrics_file:
+            metrics_file.write(json.dumps(metrics) + '\n')
+
+    @staticmethod
+    def _percentile(sorted_values, percent):
+        if not sorted_values:
+            return None
+        index = min(
+            len(sorted_values) - 1,
+            int(round(percent / 100.0 * (len(sorted_values) - 1))))
+        return sorted_values[index]
+
+    def _run_burst(self, scenario, scid, psm, payload_size, packet_count,
+                   ertm):
+        """
+        Send |packet_count| packets of |payload_size| bytes from the stack
+        under test on the dynamic channel of |psm|, and record the rate and
+        latency seen by the cert stack.
+        """
+        received = {}
+        first_arrival = None
+        last_arrival = None
+        all_received = threading.Event()
+        header_size = BASIC_FRAME_HEADER_SIZE + (ERTM_CONTROL_SIZE
+                                                 if ertm else 0)
+
+        def on_batch(batch):
+            nonlocal first_arrival, last_arrival
+            arrival_ns = time.monotonic_ns()
+            for acl_data in batch.events:
+                payload = acl_data.payload
+                if len(payload) < header_size + BURST_HEADER.size:
+                    continue
+                if struct.unpack_from('<H', payload, 2)[0] != scid:
+                    continue
+                if ertm:
+                    control = struct.unpack_from('<H', payload,
+                                                 BASIC_FRAME_HEADER_SIZE)[0]
+                    if control & 0x1:
+                        # S-frame
+                        continue
+                    tx_seq = (control >> 1) & 0x3f
+                    self._acknowledge_i_frame(scid, (tx_seq + 1) % 64)
+                sequence, sent_ns = BURST_HEADER.unpack_from(
+                    payload, header_size)
+                if sequence in received:
+                    continue
+                received[sequence] = arrival_ns - sent_ns
+                if first_arrival is None:
+                    first_arrival = arrival_ns
+                last_arrival = arrival_ns
+            if len(received) >= packet_count:
+                all_received.set()
+
+        with EventCallbackStream(
+                self.cert_device.hci_acl_manager.FetchAclDataBatch(
+                    empty_proto.Empty())) as cert_acl_batch_stream:
+            cert_acl_batch_stream.register_callback(on_batch)
+            report = self.device_under_test.l2cap.SendDynamicChannelPacketBurst(
+                l2cap_facade_pb2.DynamicChannelPacketBurst(
+                    psm=psm,
+                    payload_size=payload_size,
+                    packet_count=packet_count))
+            all_received.wait(BURST_TIMEOUT_SECONDS)
+
+        latencies_ms = sorted(
+            latency_ns / 1e6 for latency_ns in received.values())
+        receive_seconds = ((last_arrival - first_arrival) /
+                           1e9) if len(received) > 1 else None
+        metrics = {
+            'scenario': scenario,
+            'payload_size': payload_size,
+            'packets_sent': report.packets_sent,
+            'packets_received': len(received),
+            'dut_enqueue_duration_us': report.duration_us,
+            'throughput_bytes_per_second':
+            (len(received) - 1) * payload_size / receive_seconds
+            if receive_seconds else None,
+            'latency_ms_p50': self._percentile(latencies_ms, 50),
+            'latency_ms_p90': self._percentile(latencies_ms, 90),
+            'latency_ms_p99': self._percentile(latencies_ms, 99),
+            'latency_ms_max': latencies_ms[-1] if latencies_ms else None,
+        }
+        self._record_metrics(metrics)
+        asserts.assert_equal(
+            len(received), packet_count,
+            "%s: only %d of %d packets received" % (scenario, len(received),
+                                                    packet_count))
+
+    def _acknowledge_i_frame(self, scid, req_seq):
+        s_frame = l2cap_packets.EnhancedSupervisoryFrameBuilder(
+            self.scid_to_dcid[scid],
+            l2cap_packets.SupervisoryFunction.RECEIVER_READY,
+            l2cap_packets.Poll.NOT_SET, l2cap_packets.Final.NOT_SET, req_seq)
+        self.cert_send_b_frame(s_frame)
+
+    def _open_performance_channel(self, scid, psm, mode):
+        cert_acl_handle = self._setup_link_from_cert()
+        with EventCallbackStream(
+                self.cert_device.hci_acl_manager.FetchAclData(
+                    empty_proto.Empty())) as cert_acl_data_stream:
+            cert_acl_data_stream.register_callback(self._handle_control_packet)
+            if mode == l2cap_facade_pb2.RetransmissionFlowControlMode.ERTM:
+                self.on_connection_response = self._on_connection_response_use_ertm
+            self._open_channel(cert_acl_data_stream, 1, cert_acl_handle, scid,
+                               psm, mode)
+            cert_acl_data_asserts = EventAsserts(cert_acl_data_stream)
+            # FIXME: Order shouldn't matter here
+            cert_acl_data_asserts.assert_event_occurs(
+                self.is_correct_configuration_response)
+            cert_acl_data_asserts.assert_event_occurs(
+                self.is_correct_configuration_request)
+
+    def test_performance_basic_mode_small_packets(self):
+        scid = 0x41
+        psm = 0x33
+        self._open_performance_channel(
+            scid, psm, l2cap_facade_pb2.RetransmissionFlowControlMode.BASIC)
+        self._run_burst('basic_mode_small_packets', scid, psm, 64, 2000, False)
+
+    def test_performance_basic_mode_large_packets(self):
+        scid = 0x41
+        psm = 0x33
+        self._open_performance_channel(
+            scid, psm, l2cap_facade_pb2.RetransmissionFlowControlMode.BASIC)
+        self._run_burst('basic_mode_large_packets', scid, psm, 600, 1000, False)
+
+    def test_performance_ertm_large_packets(self):
+        scid = 0x41
+        psm = 0x33
+        self._open_performance_channel(
+            scid, psm, l2cap_facade_pb2.RetransmissionFlowControlMode.ERTM)
+        self._run_burst('ertm_large_packets', scid, psm, 600, 1000, True)
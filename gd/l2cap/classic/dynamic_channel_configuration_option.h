@@ -41,6 +41,22 @@ struct DynamicChannelConfigurationOption {
    * Maximum SDU size that the L2CAP Channel user is able to process.
    */
   Mtu incoming_mtu = kDefaultClassicMtu;
+
+  enum class LatencyClass {
+    BULK,
+    LOW_LATENCY,
+  };
+  /**
+   * How the link scheduler serves the outgoing packets of this channel. LOW_LATENCY channels, like AVDTP media, are
+   * served before BULK channels. Only applies to links using the weighted round robin scheduler.
+   */
+  LatencyClass latency_class = LatencyClass::BULK;
+
+  /**
+   * Number of packets this channel may send in a row, before the link scheduler serves another channel of the same
+   * latency class. Only applies to links using the weighted round robin scheduler.
+   */
+  uint8_t scheduling_weight = 1;
 };
 
 }  // namespace classic
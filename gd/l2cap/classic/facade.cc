@@ -14,8 +14,10 @@
  * limitations under the License.
  */
 
+#include <chrono>
 #include <condition_variable>
 #include <cstdint>
+#include <future>
 #include <unordered_map>
 
 #include "common/bidi_queue.h"
@@ -39,6 +41,9 @@ namespace bluetooth {
 namespace l2cap {
 namespace classic {
 
+// Sequence number and timestamp at the start of each SendDynamicChannelPacketBurst payload
+constexpr uint32_t kBurstHeaderSize = 4 + 8;
+
 class L2capClassicModuleFacadeService : public L2capClassicModuleFacade::Service {
  public:
   L2capClassicModuleFacadeService(L2capClassicModule* l2cap_layer, os::Handler* facade_handler)
@@ -94,6 +99,32 @@ class L2capClassicModuleFacadeService : public L2capClassicModuleFacade::Service
     return ::grpc::Status::OK;
   }
 
+  ::grpc::Status SendDynamicChannelPacketBurst(::grpc::ServerContext* context, const DynamicChannelPacketBurst* request,
+                                               DynamicChannelPacketBurstReport* response) override {
+    if (request->packet_count() == 0 || request->payload_size() < kBurstHeaderSize) {
+      return ::grpc::Status(::grpc::StatusCode::INVALID_ARGUMENT, "Invalid packet count or payload size");
+    }
+    std::promise<void> done;
+    auto future = done.get_future();
+    auto start = std::chrono::steady_clock::now();
+    {
+      std::unique_lock<std::mutex> lock(channel_map_mutex_);
+      if (dynamic_channel_helper_map_.find(request->psm()) == dynamic_channel_helper_map_.end()) {
+        return ::grpc::Status(::grpc::StatusCode::FAILED_PRECONDITION, "Psm not registered");
+      }
+      if (!dynamic_channel_helper_map_[request->psm()]->SendBurst(
+              request->payload_size(), request->packet_count(), std::move(done))) {
+        return ::grpc::Status(::grpc::StatusCode::FAILED_PRECONDITION, "Channel not open");
+      }
+    }
+    future.wait();
+    auto duration = std::chrono::steady_clock::now() - start;
+    response->set_packets_sent(request->packet_count());
+    response->set_bytes_sent(static_cast<uint64_t>(request->packet_count()) * request->payload_size());
+    response->set_duration_us(std::chrono::duration_cast<std::chrono::microseconds>(duration).count());
+    return ::grpc::Status::OK;
+  }
+
   ::grpc::Status OpenChannel(::grpc::ServerContext* context,
                              const ::bluetooth::l2cap::classic::OpenChannelRequest* request,
                              ::google::protobuf::Empty* response) override {
@@ -376,6 +407,39 @@ class L2capClassicModuleFacadeService : public L2capClassicModuleFacade::Service
       return packet_one;
     };
 
+    // Queue |packet_count| generated packets, as fast as the channel takes them. |done| is set once the last one was
+    // taken.
+    bool SendBurst(uint32_t payload_size, uint32_t packet_count, std::promise<void> done) {
+      if (channel_ == nullptr) {
+        std::unique_lock<std::mutex> lock(channel_open_cv_mutex_);
+        if (!channel_open_cv_.wait_for(lock, std::chrono::seconds(1), [this] { return channel_ != nullptr; })) {
+          LOG_WARN("Channel is not open");
+          return false;
+        }
+      }
+      burst_filler_.assign(payload_size - kBurstHeaderSize, 0xa5);
+      burst_sequence_ = 0;
+      burst_remaining_ = packet_count;
+      burst_done_ = std::move(done);
+      channel_->GetQueueUpEnd()->RegisterEnqueue(
+          handler_, common::Bind(&L2capDynamicChannelHelper::enqueue_burst_callback, common::Unretained(this)));
+      return true;
+    }
+
+    std::unique_ptr<packet::BasePacketBuilder> enqueue_burst_callback() {
+      auto packet = std::make_unique<packet::RawBuilder>(kBurstHeaderSize + burst_filler_.size());
+      packet->AddOctets4(burst_sequence_++);
+      packet->AddOctets8(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                             std::chrono::steady_clock::now().time_since_epoch())
+                             .count());
+      packet->AddOctets(burst_filler_);
+      if (--burst_remaining_ == 0) {
+        channel_->GetQueueUpEnd()->UnregisterEnqueue();
+        burst_done_.set_value();
+      }
+      return packet;
+    }
+
     L2capClassicModuleFacadeService* facade_service_;
     L2capClassicModule* l2cap_layer_;
     os::Handler* handler_;
@@ -385,6 +449,10 @@ class L2capClassicModuleFacadeService : public L2capClassicModuleFacade::Service
     Psm psm_;
     std::condition_variable channel_open_cv_;
     std::mutex channel_open_cv_mutex_;
+    std::vector<uint8_t> burst_filler_;
+    uint32_t burst_sequence_ = 0;
+    uint32_t burst_remaining_ = 0;
+    std::promise<void> burst_done_;
   };
 
   L2capClassicModule* l2cap_layer_;
@@ -54,6 +54,9 @@ struct ChannelConfigurationState {
   RetransmissionAndFlowControlModeOption retransmission_and_flow_control_mode_;
   RetransmissionAndFlowControlConfigurationOption local_retransmission_and_flow_control_;
   RetransmissionAndFlowControlConfigurationOption remote_retransmission_and_flow_control_;
+  // Extended Window Size option in each direction, 0 if it was not sent
+  uint16_t local_extended_window_size_ = 0;
+  uint16_t remote_extended_window_size_ = 0;
   FcsType fcs_type_ = FcsType::DEFAULT;
 };
 }  // namespace internal
@@ -34,7 +34,8 @@ Link::Link(os::Handler* l2cap_handler, std::unique_ptr<hci::AclConnection> acl_c
            DynamicChannelServiceManagerImpl* dynamic_service_manager,
            FixedChannelServiceManagerImpl* fixed_service_manager)
     : l2cap_handler_(l2cap_handler), acl_connection_(std::move(acl_connection)),
-      data_pipeline_manager_(l2cap_handler, this, acl_connection_->GetAclQueueEnd()),
+      data_pipeline_manager_(l2cap_handler, this, acl_connection_->GetAclQueueEnd(),
+                             parameter_provider->GetClassicLinkSchedulerType()),
       parameter_provider_(parameter_provider), dynamic_service_manager_(dynamic_service_manager),
       fixed_service_manager_(fixed_service_manager),
       signalling_manager_(l2cap_handler_, this, &data_pipeline_manager_, dynamic_service_manager_,
@@ -237,6 +238,14 @@ bool Link::GetRemoteSupportsFcs() const {
   return remote_supports_fcs_;
 }
 
+void Link::SetRemoteSupportsExtendedWindowSize(bool supported) {
+  remote_supports_extended_window_size_ = supported;
+}
+
+bool Link::GetRemoteSupportsExtendedWindowSize() const {
+  return remote_supports_extended_window_size_;
+}
+
 void Link::AddChannelPendingingAuthentication(PendingAuthenticateDynamicChannelConnection pending_channel) {
   pending_channel_list_.push_back(std::move(pending_channel));
 }
@@ -128,6 +128,8 @@ class Link : public l2cap::internal::ILink, public hci::ConnectionManagementCall
   virtual bool GetRemoteSupportsErtm() const;
   virtual void SetRemoteSupportsFcs(bool supported);
   virtual bool GetRemoteSupportsFcs() const;
+  virtual void SetRemoteSupportsExtendedWindowSize(bool supported);
+  virtual bool GetRemoteSupportsExtendedWindowSize() const;
 
   virtual std::string ToString() {
     return GetDevice().ToString();
@@ -176,6 +178,7 @@ class Link : public l2cap::internal::ILink, public hci::ConnectionManagementCall
   Mtu remote_connectionless_mtu_ = kMinimumClassicMtu;
   bool remote_supports_ertm_ = false;
   bool remote_supports_fcs_ = false;
+  bool remote_supports_extended_window_size_ = false;
   hci::EncryptionEnabled encryption_enabled_ = hci::EncryptionEnabled::OFF;
   std::list<Link::PendingAuthenticateDynamicChannelConnection> pending_channel_list_;
   DISALLOW_COPY_AND_ASSIGN(Link);
@@ -31,6 +31,8 @@ namespace l2cap {
 namespace classic {
 namespace internal {
 static constexpr auto kTimeout = std::chrono::seconds(3);
+// Our ERTM receive window when the remote supports Extended Window Size
+static constexpr uint16_t kExtendedTxWindowSize = 256;
 
 ClassicSignallingManager::ClassicSignallingManager(os::Handler* handler, Link* link,
                                                    l2cap::internal::DataPipelineManager* data_pipeline_manager,
@@ -153,6 +155,8 @@ void ClassicSignallingManager::OnConnectionRequest(SignalId signal_id, Psm psm,
   auto& configuration_state = channel_configuration_[new_channel->GetCid()];
   auto* service = dynamic_service_manager_->GetService(psm);
   auto initial_config = service->GetConfigOption();
+  data_pipeline_manager_->SetChannelSchedulingOption(new_channel->GetCid(), initial_config.latency_class,
+                                                     initial_config.scheduling_weight);
 
   auto mtu_configuration = std::make_unique<MtuConfigurationOption>();
   mtu_configuration->mtu_ = initial_config.incoming_mtu;
@@ -191,6 +195,12 @@ void ClassicSignallingManager::OnConnectionRequest(SignalId signal_id, Psm psm,
   if (initial_config.channel_mode != DynamicChannelConfigurationOption::RetransmissionAndFlowControlMode::L2CAP_BASIC) {
     config.emplace_back(std::move(retransmission_flow_control_configuration));
     config.emplace_back(std::move(fcs_option));
+    if (link_->GetRemoteSupportsExtendedWindowSize()) {
+      auto extended_window_size_option = std::make_unique<ExtendedWindowSizeOption>();
+      extended_window_size_option->max_window_size_ = kExtendedTxWindowSize;
+      configuration_state.local_extended_window_size_ = kExtendedTxWindowSize;
+      config.emplace_back(std::move(extended_window_size_option));
+    }
   }
   SendConfigurationRequest(remote_cid, std::move(config));
 }
@@ -233,6 +243,8 @@ void ClassicSignallingManager::OnConnectionResponse(SignalId signal_id, Cid remo
 
   auto& configuration_state = channel_configuration_[new_channel->GetCid()];
   auto initial_config = link_->GetConfigurationForInitialConfiguration(new_channel->GetCid());
+  data_pipeline_manager_->SetChannelSchedulingOption(new_channel->GetCid(), initial_config.latency_class,
+                                                     initial_config.scheduling_weight);
 
   auto mtu_configuration = std::make_unique<MtuConfigurationOption>();
   mtu_configuration->mtu_ = initial_config.incoming_mtu;
@@ -271,6 +283,12 @@ void ClassicSignallingManager::OnConnectionResponse(SignalId signal_id, Cid remo
   if (initial_config.channel_mode != DynamicChannelConfigurationOption::RetransmissionAndFlowControlMode::L2CAP_BASIC) {
     config.emplace_back(std::move(retransmission_flow_control_configuration));
     config.emplace_back(std::move(fcs_option));
+    if (link_->GetRemoteSupportsExtendedWindowSize()) {
+      auto extended_window_size_option = std::make_unique<ExtendedWindowSizeOption>();
+      extended_window_size_option->max_window_size_ = kExtendedTxWindowSize;
+      configuration_state.local_extended_window_size_ = kExtendedTxWindowSize;
+      config.emplace_back(std::move(extended_window_size_option));
+    }
   }
   SendConfigurationRequest(remote_cid, std::move(config));
 }
@@ -313,6 +331,11 @@ void ClassicSignallingManager::OnConfigurationRequest(SignalId signal_id, Cid ci
         configuration_state.fcs_type_ = FrameCheckSequenceOption::Specialize(option.get())->fcs_type_;
         break;
       }
+      case ConfigurationOptionType::EXTENDED_WINDOW_SIZE: {
+        configuration_state.remote_extended_window_size_ =
+            ExtendedWindowSizeOption::Specialize(option.get())->max_window_size_;
+        break;
+      }
       default:
         LOG_WARN("Received some unsupported configuration option: %d", static_cast<int>(option->type_));
         auto response =
@@ -394,6 +417,11 @@ void ClassicSignallingManager::OnConfigurationResponse(SignalId signal_id, Cid c
         configuration_state.fcs_type_ = FrameCheckSequenceOption::Specialize(option.get())->fcs_type_;
         break;
       }
+      case ConfigurationOptionType::EXTENDED_WINDOW_SIZE: {
+        configuration_state.local_extended_window_size_ =
+            ExtendedWindowSizeOption::Specialize(option.get())->max_window_size_;
+        break;
+      }
       default:
         LOG_WARN("Received some unsupported configuration option: %d", static_cast<int>(option->type_));
         return;
@@ -485,7 +513,7 @@ void ClassicSignallingManager::OnInformationRequest(SignalId signal_id, Informat
     case InformationRequestInfoType::EXTENDED_FEATURES_SUPPORTED: {
       // TODO: implement this response
       auto response = InformationResponseExtendedFeaturesBuilder::Create(
-          signal_id.Value(), InformationRequestResult::SUCCESS, 0, 0, 0, 1, 0, 1, 0, 0, 0, 0);
+          signal_id.Value(), InformationRequestResult::SUCCESS, 0, 0, 0, 1, 0, 1, 0, 0, 1, 0);
       enqueue_buffer_->Enqueue(std::move(response), handler_);
       break;
     }
@@ -526,6 +554,7 @@ void ClassicSignallingManager::OnInformationResponse(SignalId signal_id, const I
       }
       link_->SetRemoteSupportsErtm((view.GetEnhancedRetransmissionMode()));
       link_->SetRemoteSupportsFcs(view.GetFcsOption());
+      link_->SetRemoteSupportsExtendedWindowSize(view.GetExtendedWindowSize());
       // We don't care about other parameters
       break;
     }
@@ -52,6 +52,7 @@ class BasicModeDataController : public DataController {
 
   void EnableFcs(bool enabled) override {}
   void SetRetransmissionAndFlowControlOptions(const RetransmissionAndFlowControlConfigurationOption& option) override {}
+  void EnableExtendedWindowSize(uint16_t local_tx_window, uint16_t remote_tx_window) override {}
 
  private:
   Cid cid_;
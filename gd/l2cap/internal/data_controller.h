@@ -46,6 +46,10 @@ class DataController {
   // This only applies to some modes (ERTM).
   virtual void SetRetransmissionAndFlowControlOptions(
       const RetransmissionAndFlowControlConfigurationOption& option) = 0;
+
+  // Use the extended control field and the extended window sizes, when either side configured Extended Window Size.
+  // This only applies to some modes (ERTM).
+  virtual void EnableExtendedWindowSize(uint16_t local_tx_window, uint16_t remote_tx_window) = 0;
 };
 
 }  // namespace internal
@@ -34,6 +34,7 @@ class MockDataController : public DataController {
   MOCK_METHOD(void, EnableFcs, (bool), (override));
   MOCK_METHOD(void, SetRetransmissionAndFlowControlOptions, (const RetransmissionAndFlowControlConfigurationOption&),
               (override));
+  MOCK_METHOD(void, EnableExtendedWindowSize, (uint16_t, uint16_t), (override));
 };
 
 }  // namespace testing
@@ -35,6 +35,7 @@ void DataPipelineManager::AttachChannel(Cid cid, std::shared_ptr<ChannelImpl> ch
 
 void DataPipelineManager::DetachChannel(Cid cid) {
   ASSERT(sender_map_.find(cid) != sender_map_.end());
+  scheduler_->OnChannelDetached(cid);
   sender_map_.erase(cid);
 }
 
@@ -53,6 +54,22 @@ void DataPipelineManager::UpdateClassicConfiguration(Cid cid, classic::internal:
   sender_map_.find(cid)->second.UpdateClassicConfiguration(config);
 }
 
+void DataPipelineManager::SetChannelSchedulingOption(Cid cid, Scheduler::LatencyClass latency_class, uint8_t weight) {
+  scheduler_->SetChannelSchedulingOption(cid, latency_class, weight);
+}
+
+std::unique_ptr<Scheduler> DataPipelineManager::create_scheduler(SchedulerType scheduler_type,
+                                                                 LowerQueueUpEnd* link_queue_up_end) {
+  switch (scheduler_type) {
+    case SchedulerType::FIFO:
+      return std::make_unique<Fifo>(this, link_queue_up_end, handler_);
+    case SchedulerType::WEIGHTED_ROUND_ROBIN:
+      return std::make_unique<WeightedRoundRobin>(this, link_queue_up_end, handler_);
+  }
+  LOG_ALWAYS_FATAL("Unknown scheduler type %d", static_cast<int>(scheduler_type));
+  return nullptr;
+}
+
 }  // namespace internal
 }  // namespace l2cap
 }  // namespace bluetooth
@@ -28,6 +28,7 @@
 #include "l2cap/internal/receiver.h"
 #include "l2cap/internal/scheduler.h"
 #include "l2cap/internal/scheduler_fifo.h"
+#include "l2cap/internal/scheduler_weighted_round_robin.h"
 #include "l2cap/l2cap_packets.h"
 #include "l2cap/mtu.h"
 #include "os/handler.h"
@@ -43,7 +44,7 @@ class ILink;
 
 /**
  * Manages data pipeline from channel queue end to link queue end, per link.
- * Contains a Scheduler and Receiver per link.
+ * Contains a Scheduler and Receiver per link. The link selects the type of its Scheduler.
  * Contains a Sender and its corresponding DataController per attached channel.
  */
 class DataPipelineManager {
@@ -55,8 +56,9 @@ class DataPipelineManager {
   using LowerDequeue = UpperEnqueue;
   using LowerQueueUpEnd = common::BidiQueueEnd<LowerEnqueue, LowerDequeue>;
 
-  DataPipelineManager(os::Handler* handler, ILink* link, LowerQueueUpEnd* link_queue_up_end)
-      : handler_(handler), link_(link), scheduler_(std::make_unique<Fifo>(this, link_queue_up_end, handler)),
+  DataPipelineManager(os::Handler* handler, ILink* link, LowerQueueUpEnd* link_queue_up_end,
+                      SchedulerType scheduler_type = SchedulerType::FIFO)
+      : handler_(handler), link_(link), scheduler_(create_scheduler(scheduler_type, link_queue_up_end)),
         receiver_(link_queue_up_end, handler, this) {}
 
   using ChannelMode = Sender::ChannelMode;
@@ -66,9 +68,12 @@ class DataPipelineManager {
   virtual DataController* GetDataController(Cid cid);
   virtual void OnPacketSent(Cid cid);
   virtual void UpdateClassicConfiguration(Cid cid, classic::internal::ChannelConfigurationState config);
+  virtual void SetChannelSchedulingOption(Cid cid, Scheduler::LatencyClass latency_class, uint8_t weight);
   virtual ~DataPipelineManager() = default;
 
  private:
+  std::unique_ptr<Scheduler> create_scheduler(SchedulerType scheduler_type, LowerQueueUpEnd* link_queue_up_end);
+
   os::Handler* handler_;
   ILink* link_;
   std::unique_ptr<Scheduler> scheduler_;
@@ -125,6 +125,15 @@ size_t DynamicChannelAllocator::NumberOfChannels() const {
   return channels_.size();
 }
 
+std::vector<Cid> DynamicChannelAllocator::GetChannelCids() const {
+  std::vector<Cid> cids;
+  cids.reserve(channels_.size());
+  for (auto& channel : channels_) {
+    cids.push_back(channel.first);
+  }
+  return cids;
+}
+
 void DynamicChannelAllocator::OnAclDisconnected(hci::ErrorCode reason) {
   for (auto& elem : channels_) {
     elem.second->OnClosed(reason);
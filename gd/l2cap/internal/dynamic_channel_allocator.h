@@ -18,6 +18,7 @@
 
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include "hci/acl_manager.h"
 #include "l2cap/cid.h"
@@ -65,6 +66,9 @@ class DynamicChannelAllocator {
   // Returns number of open, but not reserved channels
   size_t NumberOfChannels() const;
 
+  // Returns the cids of the open, but not reserved channels
+  std::vector<Cid> GetChannelCids() const;
+
   void OnAclDisconnected(hci::ErrorCode hci_status);
 
  private:
@@ -16,7 +16,7 @@
 
 #include "l2cap/internal/enhanced_retransmission_mode_channel_data_controller.h"
 
-#include <map>
+#include <algorithm>
 #include <queue>
 #include <vector>
 
@@ -38,13 +38,17 @@ ErtmController::~ErtmController() = default;
 
 struct ErtmController::impl {
   impl(ErtmController* controller, os::Handler* handler)
-      : controller_(controller), handler_(handler), retrans_timer_(handler), monitor_timer_(handler) {}
+      : controller_(controller), handler_(handler), retrans_timer_(handler), monitor_timer_(handler) {
+    allocate_unacked_frames();
+  }
 
   ErtmController* controller_;
   os::Handler* handler_;
 
-  // We don't support extended window
-  static constexpr uint8_t kMaxTxWin = 64;
+  // Sequence numbers are modulo 64, or modulo 16384 with the extended control field
+  static constexpr uint16_t kMaxTxWin = 64;
+  static constexpr uint16_t kMaxExtendedTxWin = 16384;
+  uint16_t max_tx_win_ = kMaxTxWin;
 
   // We don't support sending SREJ
   static constexpr bool kSendSrej = false;
@@ -66,23 +70,30 @@ struct ErtmController::impl {
 
   // Variables and Timers (@see 8.6.5.3)
 
-  uint8_t tx_seq_ = 0;
-  uint8_t next_tx_seq_ = 0;
-  uint8_t expected_ack_seq_ = 0;
-  uint8_t req_seq_ = 0;
-  uint8_t expected_tx_seq_ = 0;
-  uint8_t buffer_seq_ = 0;
+  uint16_t tx_seq_ = 0;
+  uint16_t next_tx_seq_ = 0;
+  uint16_t expected_ack_seq_ = 0;
+  uint16_t req_seq_ = 0;
+  uint16_t expected_tx_seq_ = 0;
+  uint16_t buffer_seq_ = 0;
 
   bool remote_busy_ = false;
   bool local_busy_ = false;
   int unacked_frames_ = 0;
-  // TODO: Instead of having a map, we may consider about a better data structure
-  // Map from TxSeq to (SAR, SDU size for START packet, information payload)
-  std::map<uint8_t, std::tuple<SegmentationAndReassembly, uint16_t, std::shared_ptr<packet::RawBuilder>>> unacked_list_;
+  // An I-frame sent but not acknowledged yet. Retransmissions share its information payload.
+  struct UnackedFrame {
+    SegmentationAndReassembly sar = SegmentationAndReassembly::UNSEGMENTED;
+    // Only for START packet
+    uint16_t sdu_size = 0;
+    std::shared_ptr<packet::RawBuilder> payload;
+    int retry_count = 0;
+  };
+  // Ring of remote TxWindow frames in TxSeq order. The frame with TxSeq ExpectedAckSeq is at unacked_frames_head_.
+  std::vector<UnackedFrame> unacked_frames_ring_;
+  size_t unacked_frames_head_ = 0;
   // Stores (SAR, SDU size for START packet, information payload)
   std::queue<std::tuple<SegmentationAndReassembly, uint16_t, std::unique_ptr<packet::RawBuilder>>> pending_frames_;
   int retry_count_ = 0;
-  std::map<uint8_t /* tx_seq, */, int /* count */> retry_i_frames_;
   bool rnr_sent_ = false;
   bool rej_actioned_ = false;
   bool srej_actioned_ = false;
@@ -124,7 +135,7 @@ struct ErtmController::impl {
     }
   }
 
-  void recv_req_seq_and_f_bit(uint8_t req_seq, Final f) {
+  void recv_req_seq_and_f_bit(uint16_t req_seq, Final f) {
     if (tx_state_ == TxState::XMIT) {
       process_req_seq(req_seq);
     } else if (f == Final::POLL_RESPONSE) {
@@ -169,7 +180,7 @@ struct ErtmController::impl {
     }
   }
 
-  void recv_i_frame(Final f, uint8_t tx_seq, uint8_t req_seq, SegmentationAndReassembly sar, uint16_t sdu_size,
+  void recv_i_frame(Final f, uint16_t tx_seq, uint16_t req_seq, SegmentationAndReassembly sar, uint16_t sdu_size,
                     const packet::PacketView<true>& payload) {
     if (rx_state_ == RxState::RECV) {
       if (f == Final::NOT_SET && with_expected_tx_seq(tx_seq) && with_valid_req_seq(req_seq) && with_valid_f_bit(f) &&
@@ -207,10 +218,10 @@ struct ErtmController::impl {
       } else if (with_valid_req_seq(req_seq) && not_with_expected_tx_seq(tx_seq) && with_valid_f_bit(f) &&
                  local_busy()) {
         pass_to_tx(req_seq, f);
-      } else if ((with_invalid_tx_seq(tx_seq) && controller_->local_tx_window_ > kMaxTxWin / 2) ||
+      } else if ((with_invalid_tx_seq(tx_seq) && controller_->local_tx_window_ > max_tx_win_ / 2) ||
                  with_invalid_req_seq(req_seq)) {
         CloseChannel();
-      } else if (with_invalid_tx_seq(tx_seq) && controller_->local_tx_window_ <= kMaxTxWin / 2) {
+      } else if (with_invalid_tx_seq(tx_seq) && controller_->local_tx_window_ <= max_tx_win_ / 2) {
         // We decided to ignore
       }
     } else if (rx_state_ == RxState::REJ_SENT) {
@@ -241,7 +252,7 @@ struct ErtmController::impl {
     }
   }
 
-  void recv_rr(uint8_t req_seq, Poll p = Poll::NOT_SET, Final f = Final::NOT_SET) {
+  void recv_rr(uint16_t req_seq, Poll p = Poll::NOT_SET, Final f = Final::NOT_SET) {
     if (rx_state_ == RxState::RECV) {
       if (p == Poll::NOT_SET && f == Final::NOT_SET && with_valid_req_seq_rr(req_seq) && with_valid_f_bit(f)) {
         pass_to_tx(req_seq, f);
@@ -297,7 +308,7 @@ struct ErtmController::impl {
     }
   }
 
-  void recv_rej(uint8_t req_seq, Poll p = Poll::NOT_SET, Final f = Final::NOT_SET) {
+  void recv_rej(uint16_t req_seq, Poll p = Poll::NOT_SET, Final f = Final::NOT_SET) {
     if (rx_state_ == RxState::RECV) {
       if (f == Final::NOT_SET && with_valid_req_seq_retrans(req_seq) &&
           retry_i_frames_less_than_max_transmit(req_seq) && with_valid_f_bit(f)) {
@@ -353,7 +364,7 @@ struct ErtmController::impl {
     }
   }
 
-  void recv_rnr(uint8_t req_seq, Poll p = Poll::NOT_SET, Final f = Final::NOT_SET) {
+  void recv_rnr(uint16_t req_seq, Poll p = Poll::NOT_SET, Final f = Final::NOT_SET) {
     if (rx_state_ == RxState::RECV) {
       if (p == Poll::NOT_SET && with_valid_req_seq(req_seq) && with_valid_f_bit(f)) {
         remote_busy_ = true;
@@ -384,7 +395,7 @@ struct ErtmController::impl {
     }
   }
 
-  void recv_srej(uint8_t req_seq, Poll p = Poll::NOT_SET, Final f = Final::NOT_SET) {
+  void recv_srej(uint16_t req_seq, Poll p = Poll::NOT_SET, Final f = Final::NOT_SET) {
     if (rx_state_ == RxState::RECV) {
       if (p == Poll::NOT_SET && f == Final::NOT_SET && with_valid_req_seq_retrans(req_seq) &&
           retry_i_frames_less_than_max_transmit(req_seq) && with_valid_f_bit(f)) {
@@ -478,61 +489,64 @@ struct ErtmController::impl {
     return rnr_sent_;
   }
 
-  bool retry_i_frames_less_than_max_transmit(uint8_t req_seq) {
-    return retry_i_frames_[req_seq] < controller_->local_max_transmit_;
+  bool retry_i_frames_less_than_max_transmit(uint16_t req_seq) {
+    auto* frame = get_unacked_frame(req_seq);
+    return frame == nullptr || frame->retry_count < controller_->local_max_transmit_;
   }
 
   bool retry_count_less_than_max_transmit() {
     return retry_count_ < controller_->local_max_transmit_;
   }
 
-  bool with_expected_tx_seq(uint8_t tx_seq) {
+  bool with_expected_tx_seq(uint16_t tx_seq) {
     return tx_seq == expected_tx_seq_;
   }
 
-  bool with_valid_req_seq(uint8_t req_seq) {
-    return expected_ack_seq_ <= req_seq && req_seq <= next_tx_seq_;
+  bool with_valid_req_seq(uint16_t req_seq) {
+    return seq_offset(expected_ack_seq_, req_seq) <= seq_offset(expected_ack_seq_, next_tx_seq_);
   }
 
-  bool with_valid_req_seq_retrans(uint8_t req_seq) {
-    return expected_ack_seq_ <= req_seq && req_seq <= next_tx_seq_;
+  bool with_valid_req_seq_retrans(uint16_t req_seq) {
+    return seq_offset(expected_ack_seq_, req_seq) < seq_offset(expected_ack_seq_, next_tx_seq_);
   }
 
   bool with_valid_f_bit(Final f) {
     return f == Final::NOT_SET ^ tx_state_ == TxState::WAIT_F;
   }
 
-  bool with_unexpected_tx_seq(uint8_t tx_seq) {
-    return tx_seq > expected_tx_seq_ && tx_seq <= expected_tx_seq_ + controller_->local_tx_window_;
+  bool with_unexpected_tx_seq(uint16_t tx_seq) {
+    auto offset = seq_offset(expected_tx_seq_, tx_seq);
+    return offset > 0 && offset <= controller_->local_tx_window_;
   }
 
-  bool with_duplicate_tx_seq(uint8_t tx_seq) {
-    return tx_seq < expected_tx_seq_ && tx_seq >= expected_tx_seq_ - controller_->local_tx_window_;
+  bool with_duplicate_tx_seq(uint16_t tx_seq) {
+    auto offset = seq_offset(tx_seq, expected_tx_seq_);
+    return offset > 0 && offset <= controller_->local_tx_window_;
   }
 
-  bool with_invalid_tx_seq(uint8_t tx_seq) {
-    return tx_seq < expected_tx_seq_ - controller_->local_tx_window_ ||
-           tx_seq > expected_tx_seq_ + controller_->local_tx_window_;
+  bool with_invalid_tx_seq(uint16_t tx_seq) {
+    return !with_expected_tx_seq(tx_seq) && !with_unexpected_tx_seq(tx_seq) && !with_duplicate_tx_seq(tx_seq);
   }
 
-  bool with_invalid_req_seq(uint8_t req_seq) {
-    return req_seq < expected_ack_seq_ || req_seq > next_tx_seq_;
+  bool with_invalid_req_seq(uint16_t req_seq) {
+    return !with_valid_req_seq(req_seq);
   }
 
-  bool with_invalid_req_seq_retrans(uint8_t req_seq) {
-    return req_seq < expected_ack_seq_ || req_seq >= next_tx_seq_;
+  bool with_invalid_req_seq_retrans(uint16_t req_seq) {
+    return !with_valid_req_seq_retrans(req_seq);
   }
 
-  bool not_with_expected_tx_seq(uint8_t tx_seq) {
+  bool not_with_expected_tx_seq(uint16_t tx_seq) {
     return !with_invalid_tx_seq(tx_seq) && !with_expected_tx_seq(tx_seq);
   }
 
-  bool with_valid_req_seq_rr(uint8_t req_seq) {
-    return expected_ack_seq_ < req_seq && req_seq <= next_tx_seq_;
+  bool with_valid_req_seq_rr(uint16_t req_seq) {
+    // An RR acknowledging no new frame is still valid, it may be a response to a poll or a repeated ack
+    return with_valid_req_seq(req_seq);
   }
 
-  bool with_invalid_req_seq_rr(uint8_t req_seq) {
-    return req_seq <= expected_ack_seq_ || req_seq > next_tx_seq_;
+  bool with_invalid_req_seq_rr(uint16_t req_seq) {
+    return !with_valid_req_seq_rr(req_seq);
   }
 
   bool with_expected_tx_seq_srej() {
@@ -562,10 +576,28 @@ struct ErtmController::impl {
 
   // Actions (@see 8.6.5.6)
 
-  void _send_i_frame(SegmentationAndReassembly sar, std::unique_ptr<CopyablePacketBuilder> segment, uint8_t req_seq,
-                     uint8_t tx_seq, uint16_t sdu_size = 0, Final f = Final::NOT_SET) {
+  void _send_i_frame(SegmentationAndReassembly sar, std::unique_ptr<CopyablePacketBuilder> segment, uint16_t req_seq,
+                     uint16_t tx_seq, uint16_t sdu_size = 0, Final f = Final::NOT_SET) {
     std::unique_ptr<packet::BasePacketBuilder> builder;
-    if (sar == SegmentationAndReassembly::START) {
+    if (controller_->extended_control_) {
+      if (sar == SegmentationAndReassembly::START) {
+        if (controller_->fcs_enabled_) {
+          builder = ExtendedInformationStartFrameWithFcsBuilder::Create(controller_->remote_cid_, f, req_seq, tx_seq,
+                                                                        sdu_size, std::move(segment));
+        } else {
+          builder = ExtendedInformationStartFrameBuilder::Create(controller_->remote_cid_, f, req_seq, tx_seq, sdu_size,
+                                                                 std::move(segment));
+        }
+      } else {
+        if (controller_->fcs_enabled_) {
+          builder = ExtendedInformationFrameWithFcsBuilder::Create(controller_->remote_cid_, f, req_seq, sar, tx_seq,
+                                                                   std::move(segment));
+        } else {
+          builder = ExtendedInformationFrameBuilder::Create(controller_->remote_cid_, f, req_seq, sar, tx_seq,
+                                                            std::move(segment));
+        }
+      }
+    } else if (sar == SegmentationAndReassembly::START) {
       if (controller_->fcs_enabled_) {
         builder = EnhancedInformationStartFrameWithFcsBuilder::Create(controller_->remote_cid_, tx_seq, f, req_seq,
                                                                       sdu_size, std::move(segment));
@@ -587,17 +619,19 @@ struct ErtmController::impl {
 
   void send_data(SegmentationAndReassembly sar, uint16_t sdu_size, std::unique_ptr<packet::RawBuilder> segment,
                  Final f = Final::NOT_SET) {
-    std::shared_ptr<packet::RawBuilder> shared_segment(segment.release());
-    unacked_list_.emplace(std::piecewise_construct, std::forward_as_tuple(next_tx_seq_),
-                          std::forward_as_tuple(sar, sdu_size, shared_segment));
+    ASSERT(static_cast<size_t>(unacked_frames_) < unacked_frames_ring_.size());
+    auto& frame = unacked_frames_ring_[(unacked_frames_head_ + unacked_frames_) % unacked_frames_ring_.size()];
+    frame.sar = sar;
+    frame.sdu_size = sdu_size;
+    frame.payload = std::move(segment);
+    frame.retry_count = 1;
 
     std::unique_ptr<CopyablePacketBuilder> copyable_packet_builder =
-        std::make_unique<CopyablePacketBuilder>(std::get<2>(unacked_list_.find(next_tx_seq_)->second));
+        std::make_unique<CopyablePacketBuilder>(frame.payload);
     _send_i_frame(sar, std::move(copyable_packet_builder), buffer_seq_, next_tx_seq_, sdu_size, f);
     unacked_frames_++;
     frames_sent_++;
-    retry_i_frames_[next_tx_seq_] = 1;
-    next_tx_seq_ = (next_tx_seq_ + 1) % kMaxTxWin;
+    next_tx_seq_ = (next_tx_seq_ + 1) % max_tx_win_;
     start_retrans_timer();
   }
 
@@ -605,20 +639,29 @@ struct ErtmController::impl {
     pending_frames_.emplace(std::make_tuple(sar, sdu_size, std::move(data)));
   }
 
-  void process_req_seq(uint8_t req_seq) {
-    for (int i = expected_ack_seq_; i < req_seq; i++) {
-      unacked_list_.erase(i);
-      retry_i_frames_[i] = 0;
+  void process_req_seq(uint16_t req_seq) {
+    // Only the acknowledged frames are visited, and their slots are reused for the next frames
+    auto acked_frames = std::min<int>(seq_offset(expected_ack_seq_, req_seq), unacked_frames_);
+    for (int i = 0; i < acked_frames; i++) {
+      unacked_frames_ring_[unacked_frames_head_] = {};
+      unacked_frames_head_ = (unacked_frames_head_ + 1) % unacked_frames_ring_.size();
     }
-    unacked_frames_ -= ((req_seq - expected_ack_seq_) + kMaxTxWin) % kMaxTxWin;
+    unacked_frames_ -= acked_frames;
+    expected_ack_seq_ = req_seq;
     if (unacked_frames_ == 0) {
       stop_retrans_timer();
     }
   }
 
-  void _send_s_frame(SupervisoryFunction s, uint8_t req_seq, Poll p, Final f) {
+  void _send_s_frame(SupervisoryFunction s, uint16_t req_seq, Poll p, Final f) {
     std::unique_ptr<packet::BasePacketBuilder> builder;
-    if (controller_->fcs_enabled_) {
+    if (controller_->extended_control_) {
+      if (controller_->fcs_enabled_) {
+        builder = ExtendedSupervisoryFrameWithFcsBuilder::Create(controller_->remote_cid_, f, req_seq, s, p);
+      } else {
+        builder = ExtendedSupervisoryFrameBuilder::Create(controller_->remote_cid_, f, req_seq, s, p);
+      }
+    } else if (controller_->fcs_enabled_) {
       builder = EnhancedSupervisoryFrameWithFcsBuilder::Create(controller_->remote_cid_, s, p, f, req_seq);
     } else {
       builder = EnhancedSupervisoryFrameBuilder::Create(controller_->remote_cid_, s, p, f, req_seq);
@@ -674,16 +717,16 @@ struct ErtmController::impl {
   }
 
   void start_retrans_timer() {
-    retrans_timer_.Schedule(common::BindOnce(&impl::retrans_timer_expires, common::Unretained(this)),
+    retrans_timer_.Schedule([this]() { retrans_timer_expires(); },
                             std::chrono::milliseconds(controller_->local_retransmit_timeout_ms_));
   }
 
   void start_monitor_timer() {
-    monitor_timer_.Schedule(common::BindOnce(&impl::monitor_timer_expires, common::Unretained(this)),
+    monitor_timer_.Schedule([this]() { monitor_timer_expires(); },
                             std::chrono::milliseconds(controller_->local_monitor_timeout_ms_));
   }
 
-  void pass_to_tx(uint8_t req_seq, Final f) {
+  void pass_to_tx(uint16_t req_seq, Final f) {
     recv_req_seq_and_f_bit(req_seq, f);
   }
 
@@ -693,11 +736,11 @@ struct ErtmController::impl {
 
   void data_indication(SegmentationAndReassembly sar, uint16_t sdu_size, const packet::PacketView<true>& segment) {
     controller_->stage_for_reassembly(sar, sdu_size, segment);
-    buffer_seq_ = (buffer_seq_ + 1) % kMaxTxWin;
+    buffer_seq_ = (buffer_seq_ + 1) % max_tx_win_;
   }
 
   void increment_expected_tx_seq() {
-    expected_tx_seq_ = (expected_tx_seq_ + 1) % kMaxTxWin;
+    expected_tx_seq_ = (expected_tx_seq_ + 1) % max_tx_win_;
   }
 
   void stop_retrans_timer() {
@@ -734,39 +777,38 @@ struct ErtmController::impl {
     return tx_state_ == TxState::WAIT_F;
   }
 
-  void retransmit_i_frames(uint8_t req_seq, Poll p = Poll::NOT_SET) {
-    uint8_t i = req_seq;
+  void retransmit_i_frames(uint16_t req_seq, Poll p = Poll::NOT_SET) {
+    uint16_t i = req_seq;
     Final f = (p == Poll::NOT_SET ? Final::NOT_SET : Final::POLL_RESPONSE);
-    while (unacked_list_.find(i) != unacked_list_.end()) {
-      if (retry_i_frames_[i] == controller_->local_max_transmit_) {
+    for (auto* frame = get_unacked_frame(i); frame != nullptr; frame = get_unacked_frame(i)) {
+      if (frame->retry_count == controller_->local_max_transmit_) {
         CloseChannel();
         return;
       }
       std::unique_ptr<CopyablePacketBuilder> copyable_packet_builder =
-          std::make_unique<CopyablePacketBuilder>(std::get<2>(unacked_list_.find(i)->second));
-      _send_i_frame(std::get<0>(unacked_list_.find(i)->second), std::move(copyable_packet_builder), buffer_seq_, i,
-                    std::get<1>(unacked_list_.find(i)->second), f);
-      retry_i_frames_[i]++;
+          std::make_unique<CopyablePacketBuilder>(frame->payload);
+      _send_i_frame(frame->sar, std::move(copyable_packet_builder), buffer_seq_, i, frame->sdu_size, f);
+      frame->retry_count++;
       frames_sent_++;
       f = Final::NOT_SET;
-      i++;
+      i = (i + 1) % max_tx_win_;
     }
     if (i != req_seq) {
       start_retrans_timer();
     }
   }
 
-  void retransmit_requested_i_frame(uint8_t req_seq, Poll p) {
+  void retransmit_requested_i_frame(uint16_t req_seq, Poll p) {
     Final f = p == Poll::POLL ? Final::POLL_RESPONSE : Final::NOT_SET;
-    if (unacked_list_.find(req_seq) == unacked_list_.end()) {
+    auto* frame = get_unacked_frame(req_seq);
+    if (frame == nullptr) {
       LOG_ERROR("Received invalid SREJ");
       return;
     }
     std::unique_ptr<CopyablePacketBuilder> copyable_packet_builder =
-        std::make_unique<CopyablePacketBuilder>(std::get<2>(unacked_list_.find(req_seq)->second));
-    _send_i_frame(std::get<0>(unacked_list_.find(req_seq)->second), std::move(copyable_packet_builder), buffer_seq_,
-                  req_seq, std::get<1>(unacked_list_.find(req_seq)->second), f);
-    retry_i_frames_[req_seq]++;
+        std::make_unique<CopyablePacketBuilder>(frame->payload);
+    _send_i_frame(frame->sar, std::move(copyable_packet_builder), buffer_seq_, req_seq, frame->sdu_size, f);
+    frame->retry_count++;
     start_retrans_timer();
   }
 
@@ -793,6 +835,34 @@ struct ErtmController::impl {
   void data_indication_srej() {
     // We don't support sending SREJ
   }
+
+  // Unacked frames
+
+  // Number of frames from sequence number |from| to |to|
+  int seq_offset(uint16_t from, uint16_t to) {
+    return (to + max_tx_win_ - from) % max_tx_win_;
+  }
+
+  UnackedFrame* get_unacked_frame(uint16_t tx_seq) {
+    auto offset = seq_offset(expected_ack_seq_, tx_seq);
+    if (offset >= unacked_frames_) {
+      return nullptr;
+    }
+    return &unacked_frames_ring_[(unacked_frames_head_ + offset) % unacked_frames_ring_.size()];
+  }
+
+  // The remote TxWindow bounds the unacked frames, so their slots are allocated once per channel configuration
+  void allocate_unacked_frames() {
+    ASSERT(unacked_frames_ == 0);
+    unacked_frames_ring_.assign(std::max<uint16_t>(controller_->remote_tx_window_, 1), {});
+    unacked_frames_head_ = 0;
+  }
+
+  void enable_extended_control() {
+    ASSERT(unacked_frames_ == 0);
+    max_tx_win_ = kMaxExtendedTxWin;
+    allocate_unacked_frames();
+  }
 };
 
 // Segmentation is handled here
@@ -821,29 +891,22 @@ void ErtmController::OnPdu(packet::PacketView<true> pdu) {
   }
 }
 
-void ErtmController::on_pdu_no_fcs(const packet::PacketView<true>& pdu) {
-  auto basic_frame_view = BasicFrameView::Create(pdu);
-  if (!basic_frame_view.IsValid()) {
-    return;
-  }
-  auto standard_frame_view = StandardFrameView::Create(basic_frame_view);
-  if (!standard_frame_view.IsValid()) {
-    LOG_WARN("Received invalid frame");
-    return;
-  }
+template <typename InformationFrameView, typename InformationStartFrameView, typename SupervisoryFrameView,
+          typename StandardFrameViewType>
+void ErtmController::on_standard_frame(const StandardFrameViewType& standard_frame_view) {
   auto type = standard_frame_view.GetFrameType();
   if (type == FrameType::I_FRAME) {
-    auto i_frame_view = EnhancedInformationFrameView::Create(standard_frame_view);
+    auto i_frame_view = InformationFrameView::Create(standard_frame_view);
     if (!i_frame_view.IsValid()) {
       LOG_WARN("Received invalid frame");
       return;
     }
     Final f = i_frame_view.GetF();
-    uint8_t tx_seq = i_frame_view.GetTxSeq();
-    uint8_t req_seq = i_frame_view.GetReqSeq();
+    uint16_t tx_seq = i_frame_view.GetTxSeq();
+    uint16_t req_seq = i_frame_view.GetReqSeq();
     auto sar = i_frame_view.GetSar();
     if (sar == SegmentationAndReassembly::START) {
-      auto i_frame_start_view = EnhancedInformationStartFrameView::Create(i_frame_view);
+      auto i_frame_start_view = InformationStartFrameView::Create(i_frame_view);
       if (!i_frame_start_view.IsValid()) {
         LOG_WARN("Received invalid I-Frame START");
         return;
@@ -854,7 +917,7 @@ void ErtmController::on_pdu_no_fcs(const packet::PacketView<true>& pdu) {
       pimpl_->recv_i_frame(f, tx_seq, req_seq, sar, 0, i_frame_view.GetPayload());
     }
   } else if (type == FrameType::S_FRAME) {
-    auto s_frame_view = EnhancedSupervisoryFrameView::Create(standard_frame_view);
+    auto s_frame_view = SupervisoryFrameView::Create(standard_frame_view);
     if (!s_frame_view.IsValid()) {
       LOG_WARN("Received invalid frame");
       return;
@@ -881,6 +944,25 @@ void ErtmController::on_pdu_no_fcs(const packet::PacketView<true>& pdu) {
   }
 }
 
+void ErtmController::on_pdu_no_fcs(const packet::PacketView<true>& pdu) {
+  auto basic_frame_view = BasicFrameView::Create(pdu);
+  if (!basic_frame_view.IsValid()) {
+    return;
+  }
+  auto standard_frame_view = StandardFrameView::Create(basic_frame_view);
+  if (!standard_frame_view.IsValid()) {
+    LOG_WARN("Received invalid frame");
+    return;
+  }
+  if (extended_control_) {
+    on_standard_frame<ExtendedInformationFrameView, ExtendedInformationStartFrameView, ExtendedSupervisoryFrameView>(
+        standard_frame_view);
+  } else {
+    on_standard_frame<EnhancedInformationFrameView, EnhancedInformationStartFrameView, EnhancedSupervisoryFrameView>(
+        standard_frame_view);
+  }
+}
+
 void ErtmController::on_pdu_fcs(const packet::PacketView<true>& pdu) {
   auto basic_frame_view = BasicFrameWithFcsView::Create(pdu);
   if (!basic_frame_view.IsValid()) {
@@ -891,53 +973,12 @@ void ErtmController::on_pdu_fcs(const packet::PacketView<true>& pdu) {
     LOG_WARN("Received invalid frame");
     return;
   }
-  auto type = standard_frame_view.GetFrameType();
-  if (type == FrameType::I_FRAME) {
-    auto i_frame_view = EnhancedInformationFrameWithFcsView::Create(standard_frame_view);
-    if (!i_frame_view.IsValid()) {
-      LOG_WARN("Received invalid frame");
-      return;
-    }
-    Final f = i_frame_view.GetF();
-    uint8_t tx_seq = i_frame_view.GetTxSeq();
-    uint8_t req_seq = i_frame_view.GetReqSeq();
-    auto sar = i_frame_view.GetSar();
-    if (sar == SegmentationAndReassembly::START) {
-      auto i_frame_start_view = EnhancedInformationStartFrameWithFcsView::Create(i_frame_view);
-      if (!i_frame_start_view.IsValid()) {
-        LOG_WARN("Received invalid I-Frame START");
-        return;
-      }
-      pimpl_->recv_i_frame(f, tx_seq, req_seq, sar, i_frame_start_view.GetL2capSduLength(),
-                           i_frame_start_view.GetPayload());
-    } else {
-      pimpl_->recv_i_frame(f, tx_seq, req_seq, sar, 0, i_frame_view.GetPayload());
-    }
-  } else if (type == FrameType::S_FRAME) {
-    auto s_frame_view = EnhancedSupervisoryFrameWithFcsView::Create(standard_frame_view);
-    if (!s_frame_view.IsValid()) {
-      LOG_WARN("Received invalid frame");
-      return;
-    }
-    auto req_seq = s_frame_view.GetReqSeq();
-    auto f = s_frame_view.GetF();
-    auto p = s_frame_view.GetP();
-    switch (s_frame_view.GetS()) {
-      case SupervisoryFunction::RECEIVER_READY:
-        pimpl_->recv_rr(req_seq, p, f);
-        break;
-      case SupervisoryFunction::RECEIVER_NOT_READY:
-        pimpl_->recv_rnr(req_seq, p, f);
-        break;
-      case SupervisoryFunction::REJECT:
-        pimpl_->recv_rej(req_seq, p, f);
-        break;
-      case SupervisoryFunction::SELECT_REJECT:
-        pimpl_->recv_srej(req_seq, p, f);
-        break;
-    }
+  if (extended_control_) {
+    on_standard_frame<ExtendedInformationFrameWithFcsView, ExtendedInformationStartFrameWithFcsView,
+                      ExtendedSupervisoryFrameWithFcsView>(standard_frame_view);
   } else {
-    LOG_WARN("Received invalid frame");
+    on_standard_frame<EnhancedInformationFrameWithFcsView, EnhancedInformationStartFrameWithFcsView,
+                      EnhancedSupervisoryFrameWithFcsView>(standard_frame_view);
   }
 }
 
@@ -1015,6 +1056,16 @@ void ErtmController::SetRetransmissionAndFlowControlOptions(
   local_max_transmit_ = option.max_transmit_;
   local_retransmit_timeout_ms_ = option.retransmission_time_out_;
   local_monitor_timeout_ms_ = option.monitor_time_out_;
+  pimpl_->allocate_unacked_frames();
+}
+
+void ErtmController::EnableExtendedWindowSize(uint16_t local_tx_window, uint16_t remote_tx_window) {
+  extended_control_ = true;
+  local_tx_window_ = local_tx_window;
+  remote_tx_window_ = remote_tx_window;
+  size_each_packet_ =
+      (remote_mps_ - 4 /* basic L2CAP header */ - 2 /* SDU length */ - 4 /* Extended control */ - 2 /* FCS */);
+  pimpl_->enable_extended_control();
 }
 
 void ErtmController::close_channel() {
@@ -52,6 +52,7 @@ class ErtmController : public DataController {
   std::unique_ptr<packet::BasePacketBuilder> GetNextPacket() override;
   void EnableFcs(bool enabled) override;
   void SetRetransmissionAndFlowControlOptions(const RetransmissionAndFlowControlConfigurationOption& option) override;
+  void EnableExtendedWindowSize(uint16_t local_tx_window, uint16_t remote_tx_window) override;
 
  private:
   ILink* link_;
@@ -64,6 +65,8 @@ class ErtmController : public DataController {
 
   // Configuration options
   bool fcs_enabled_ = false;
+  // Use the extended control field, with 14 bit TxSeq and ReqSeq
+  bool extended_control_ = false;
   uint16_t local_tx_window_ = 10;
   uint16_t local_max_transmit_ = 20;
   uint16_t local_retransmit_timeout_ms_ = 2000;
@@ -73,7 +76,7 @@ class ErtmController : public DataController {
   uint16_t remote_mps_ = 1010;
 
   uint16_t size_each_packet_ =
-      (remote_mps_ - 4 /* basic L2CAP header */ - 2 /* SDU length */ - 2 /* Extended control */ - 2 /* FCS */);
+      (remote_mps_ - 4 /* basic L2CAP header */ - 2 /* SDU length */ - 2 /* Enhanced control */ - 2 /* FCS */);
 
   class PacketViewForReassembly : public packet::PacketView<kLittleEndian> {
    public:
@@ -107,6 +110,9 @@ class ErtmController : public DataController {
 
   void on_pdu_no_fcs(const packet::PacketView<true>& pdu);
   void on_pdu_fcs(const packet::PacketView<true>& pdu);
+  template <typename InformationFrameView, typename InformationStartFrameView, typename SupervisoryFrameView,
+            typename StandardFrameViewType>
+  void on_standard_frame(const StandardFrameViewType& standard_frame_view);
 
   struct impl;
   std::unique_ptr<impl> pimpl_;
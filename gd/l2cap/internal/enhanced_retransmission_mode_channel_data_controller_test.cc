@@ -204,6 +204,62 @@ TEST_F(ErtmDataControllerTest, receive_packet_with_fcs) {
   EXPECT_EQ(data, "abcd");
 }
 
+TEST_F(ErtmDataControllerTest, retransmit_unacked_frames_after_reject) {
+  common::BidiQueue<Scheduler::UpperEnqueue, Scheduler::UpperDequeue> channel_queue{10};
+  testing::MockScheduler scheduler;
+  testing::MockILink link;
+  ErtmController controller{&link, 1, 1, channel_queue.GetDownEnd(), queue_handler_, &scheduler};
+  EXPECT_CALL(scheduler, OnPacketsReady(1, 1)).Times(4);
+  controller.OnSdu(CreateSdu({'a'}));
+  controller.OnSdu(CreateSdu({'b'}));
+  controller.OnSdu(CreateSdu({'c'}));
+  for (int i = 0; i < 3; i++) {
+    EXPECT_NE(controller.GetNextPacket(), nullptr);
+  }
+  // The first two frames are acknowledged, so only the third one is sent again
+  auto rr = EnhancedSupervisoryFrameBuilder::Create(1, SupervisoryFunction::RECEIVER_READY, Poll::NOT_SET,
+                                                    Final::NOT_SET, 2);
+  controller.OnPdu(GetPacketView(std::move(rr)));
+  auto rej =
+      EnhancedSupervisoryFrameBuilder::Create(1, SupervisoryFunction::REJECT, Poll::NOT_SET, Final::NOT_SET, 2);
+  controller.OnPdu(GetPacketView(std::move(rej)));
+  auto view = GetPacketView(controller.GetNextPacket());
+  auto i_frame_view = EnhancedInformationFrameView::Create(StandardFrameView::Create(BasicFrameView::Create(view)));
+  EXPECT_TRUE(i_frame_view.IsValid());
+  EXPECT_EQ(i_frame_view.GetTxSeq(), 2);
+  auto payload = i_frame_view.GetPayload();
+  EXPECT_EQ(std::string(payload.begin(), payload.end()), "c");
+}
+
+TEST_F(ErtmDataControllerTest, transmit_and_receive_extended_control) {
+  common::BidiQueue<Scheduler::UpperEnqueue, Scheduler::UpperDequeue> channel_queue{10};
+  testing::MockScheduler scheduler;
+  testing::MockILink link;
+  ErtmController controller{&link, 1, 1, channel_queue.GetDownEnd(), queue_handler_, &scheduler};
+  controller.EnableExtendedWindowSize(256, 256);
+  EXPECT_CALL(scheduler, OnPacketsReady(1, 1)).Times(2);
+  controller.OnSdu(CreateSdu({'a', 'b', 'c', 'd'}));
+  auto view = GetPacketView(controller.GetNextPacket());
+  auto i_frame_view = ExtendedInformationFrameView::Create(StandardFrameView::Create(BasicFrameView::Create(view)));
+  EXPECT_TRUE(i_frame_view.IsValid());
+  auto payload = i_frame_view.GetPayload();
+  EXPECT_EQ(std::string(payload.begin(), payload.end()), "abcd");
+  EXPECT_EQ(i_frame_view.GetTxSeq(), 0);
+
+  auto builder = ExtendedInformationFrameBuilder::Create(1, Final::NOT_SET, 1, SegmentationAndReassembly::UNSEGMENTED,
+                                                         0, CreateSdu({'e', 'f'}));
+  controller.OnPdu(GetPacketView(std::move(builder)));
+  sync_handler(queue_handler_);
+  auto received = channel_queue.GetUpEnd()->TryDequeue();
+  EXPECT_NE(received, nullptr);
+  EXPECT_EQ(std::string(received->begin(), received->end()), "ef");
+  // The received frame is acknowledged with an extended S-frame
+  auto ack_view = GetPacketView(controller.GetNextPacket());
+  auto s_frame_view = ExtendedSupervisoryFrameView::Create(StandardFrameView::Create(BasicFrameView::Create(ack_view)));
+  EXPECT_TRUE(s_frame_view.IsValid());
+  EXPECT_EQ(s_frame_view.GetReqSeq(), 1);
+}
+
 }  // namespace
 }  // namespace internal
 }  // namespace l2cap
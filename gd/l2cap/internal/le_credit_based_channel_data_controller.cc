@@ -16,20 +16,48 @@
 
 #include "l2cap/internal/le_credit_based_channel_data_controller.h"
 
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+
 #include "l2cap/l2cap_packets.h"
 #include "l2cap/le/internal/link.h"
-#include "packet/fragmenting_inserter.h"
-#include "packet/raw_builder.h"
+#include "packet/bit_inserter.h"
 
 namespace bluetooth {
 namespace l2cap {
 namespace internal {
+namespace {
+
+// The information payload of a K-frame, as a slice of the serialized SDU
+class SduSegmentBuilder : public packet::BasePacketBuilder {
+ public:
+  SduSegmentBuilder(std::shared_ptr<const std::vector<uint8_t>> sdu, size_t begin, size_t end)
+      : sdu_(std::move(sdu)), begin_(begin), end_(end) {}
+
+  size_t size() const override {
+    return end_ - begin_;
+  }
+
+  void Serialize(packet::BitInserter& it) const override {
+    for (size_t i = begin_; i < end_; i++) {
+      it.insert_byte((*sdu_)[i]);
+    }
+  }
+
+ private:
+  std::shared_ptr<const std::vector<uint8_t>> sdu_;
+  size_t begin_;
+  size_t end_;
+};
+
+}  // namespace
 
 LeCreditBasedDataController::LeCreditBasedDataController(ILink* link, Cid cid, Cid remote_cid,
                                                          UpperQueueDownEnd* channel_queue_end, os::Handler* handler,
                                                          Scheduler* scheduler)
     : cid_(cid), remote_cid_(remote_cid), enqueue_buffer_(channel_queue_end), handler_(handler), scheduler_(scheduler),
-      link_(link) {}
+      link_(link), credit_return_alarm_(handler) {}
 
 void LeCreditBasedDataController::OnSdu(std::unique_ptr<packet::BasePacketBuilder> sdu) {
   auto sdu_size = sdu->size();
@@ -40,28 +68,25 @@ void LeCreditBasedDataController::OnSdu(std::unique_ptr<packet::BasePacketBuilde
   if (sdu_size > mtu_) {
     LOG_WARN("Received sdu_size %d > mtu %d", static_cast<int>(sdu_size), mtu_);
   }
-  std::vector<std::unique_ptr<packet::RawBuilder>> segments;
-  // TODO: We don't need to waste 2 bytes for continuation segment.
-  packet::FragmentingInserter fragmenting_inserter(mps_ - 2, std::back_insert_iterator(segments));
-  sdu->Serialize(fragmenting_inserter);
-  fragmenting_inserter.finalize();
-  std::unique_ptr<BasicFrameBuilder> builder;
-  builder = FirstLeInformationFrameBuilder::Create(remote_cid_, sdu_size, std::move(segments[0]));
-  pdu_queue_.emplace(std::move(builder));
-  for (auto i = 1; i < segments.size(); i++) {
-    builder = BasicFrameBuilder::Create(remote_cid_, std::move(segments[i]));
-    pdu_queue_.emplace(std::move(builder));
-  }
-  if (credits_ >= segments.size()) {
-    scheduler_->OnPacketsReady(cid_, segments.size());
-    credits_ -= segments.size();
-  } else if (credits_ > 0) {
-    scheduler_->OnPacketsReady(cid_, credits_);
-    pending_frames_count_ += (segments.size() - credits_);
-    credits_ = 0;
-  } else {
-    pending_frames_count_ += segments.size();
+  // Serialize the SDU once, the K-frames only reference their segment of it
+  auto bytes = std::make_shared<std::vector<uint8_t>>();
+  bytes->reserve(sdu_size);
+  packet::BitInserter it(*bytes);
+  sdu->Serialize(it);
+  // Only the first K-frame carries the SDU length
+  size_t first_segment_end = std::min<size_t>(mps_ - 2, bytes->size());
+  pdu_queue_.emplace(FirstLeInformationFrameBuilder::Create(
+      remote_cid_, sdu_size, std::make_unique<SduSegmentBuilder>(bytes, 0, first_segment_end)));
+  uint16_t k_frames = 1;
+  for (size_t begin = first_segment_end; begin < bytes->size(); begin += mps_) {
+    size_t end = std::min<size_t>(begin + mps_, bytes->size());
+    pdu_queue_.emplace(BasicFrameBuilder::Create(remote_cid_, std::make_unique<SduSegmentBuilder>(bytes, begin, end)));
+    k_frames++;
   }
+  statistics_.sdus_sent++;
+  statistics_.bytes_sent += sdu_size;
+  pending_frames_count_ += k_frames;
+  send_pending_frames();
 }
 
 void LeCreditBasedDataController::OnPdu(packet::PacketView<true> pdu) {
@@ -89,7 +114,10 @@ void LeCreditBasedDataController::OnPdu(packet::PacketView<true> pdu) {
     remaining_sdu_continuation_packet_size_ -= payload.size();
     reassembly_stage_.AppendPacketView(payload);
   }
+  statistics_.k_frames_received++;
   if (remaining_sdu_continuation_packet_size_ == 0) {
+    statistics_.sdus_received++;
+    statistics_.bytes_received += reassembly_stage_.size();
     enqueue_buffer_.Enqueue(std::make_unique<PacketView<kLittleEndian>>(reassembly_stage_), handler_);
   } else if (remaining_sdu_continuation_packet_size_ < 0 || reassembly_stage_.size() > mtu_) {
     LOG_WARN("Received larger SDU size than expected");
@@ -98,12 +126,13 @@ void LeCreditBasedDataController::OnPdu(packet::PacketView<true> pdu) {
     link_->SendDisconnectionRequest(cid_, remote_cid_);
   }
   // TODO: Improve the logic by sending credit only after user dequeued the SDU
-  link_->SendLeCredit(cid_, 1);
+  on_k_frame_consumed();
 }
 
 std::unique_ptr<packet::BasePacketBuilder> LeCreditBasedDataController::GetNextPacket() {
   auto next = std::move(pdu_queue_.front());
   pdu_queue_.pop();
+  statistics_.k_frames_sent++;
   return next;
 }
 
@@ -119,16 +148,82 @@ void LeCreditBasedDataController::OnCredit(uint16_t credits) {
   int total_credits = credits_ + credits;
   if (total_credits > 0xffff) {
     link_->SendDisconnectionRequest(cid_, remote_cid_);
+    return;
   }
   credits_ = total_credits;
-  if (pending_frames_count_ > 0 && credits_ >= pending_frames_count_) {
-    scheduler_->OnPacketsReady(cid_, pending_frames_count_);
-    credits_ -= pending_frames_count_;
-  } else if (pending_frames_count_ > 0) {
-    scheduler_->OnPacketsReady(cid_, credits_);
-    pending_frames_count_ -= credits_;
-    credits_ = 0;
+  statistics_.credits_received += credits;
+  send_pending_frames();
+}
+
+void LeCreditBasedDataController::SetReceiveCredits(uint16_t credits) {
+  // Return credits once a quarter of them is consumed, so that the remote keeps most of its credits during a burst
+  credit_return_threshold_ = std::max(credits / 4, 1);
+}
+
+const LeCreditBasedDataController::Statistics& LeCreditBasedDataController::GetStatistics() const {
+  return statistics_;
+}
+
+void LeCreditBasedDataController::Dump(int fd) const {
+  using std::chrono::duration_cast;
+  using std::chrono::milliseconds;
+  auto now = std::chrono::steady_clock::now();
+  uint64_t elapsed_ms = std::max<int64_t>(duration_cast<milliseconds>(now - creation_time_).count(), 1);
+  auto stall_time = statistics_.credit_stall_time;
+  if (credit_stalled_) {
+    stall_time += duration_cast<milliseconds>(now - credit_stall_start_);
+  }
+  dprintf(fd, "  cid:0x%04x remote_cid:0x%04x mtu:%d mps:%d credits:%d waiting_k_frames:%d\n", cid_, remote_cid_,
+          mtu_, mps_, credits_, pending_frames_count_);
+  dprintf(fd, "    sent sdus:%" PRIu64 " bytes:%" PRIu64 " k_frames:%" PRIu64 " throughput:%" PRIu64 " bytes/s\n",
+          statistics_.sdus_sent, statistics_.bytes_sent, statistics_.k_frames_sent,
+          statistics_.bytes_sent * 1000 / elapsed_ms);
+  dprintf(fd, "    received sdus:%" PRIu64 " bytes:%" PRIu64 " k_frames:%" PRIu64 " throughput:%" PRIu64 " bytes/s\n",
+          statistics_.sdus_received, statistics_.bytes_received, statistics_.k_frames_received,
+          statistics_.bytes_received * 1000 / elapsed_ms);
+  dprintf(fd,
+          "    credits received:%" PRIu64 " returned:%" PRIu64 " in %" PRIu64 " packets, stalls:%" PRIu64
+          " stall_time_ms:%" PRId64 "\n",
+          statistics_.credits_received, statistics_.credits_returned, statistics_.credit_packets_sent,
+          statistics_.credit_stalls, static_cast<int64_t>(stall_time.count()));
+}
+
+void LeCreditBasedDataController::send_pending_frames() {
+  uint16_t ready_frames = std::min(credits_, pending_frames_count_);
+  if (ready_frames > 0) {
+    scheduler_->OnPacketsReady(cid_, ready_frames);
+    credits_ -= ready_frames;
+    pending_frames_count_ -= ready_frames;
+  }
+  auto now = std::chrono::steady_clock::now();
+  if (pending_frames_count_ > 0 && !credit_stalled_) {
+    credit_stalled_ = true;
+    credit_stall_start_ = now;
+    statistics_.credit_stalls++;
+  } else if (pending_frames_count_ == 0 && credit_stalled_) {
+    credit_stalled_ = false;
+    statistics_.credit_stall_time += std::chrono::duration_cast<std::chrono::milliseconds>(now - credit_stall_start_);
+  }
+}
+
+void LeCreditBasedDataController::on_k_frame_consumed() {
+  credits_to_return_++;
+  if (credits_to_return_ >= credit_return_threshold_) {
+    return_credits();
+  } else if (credits_to_return_ == 1) {
+    credit_return_alarm_.Schedule([this]() { return_credits(); }, kCreditReturnTimeout);
+  }
+}
+
+void LeCreditBasedDataController::return_credits() {
+  credit_return_alarm_.Cancel();
+  if (credits_to_return_ == 0) {
+    return;
   }
+  link_->SendLeCredit(cid_, credits_to_return_);
+  statistics_.credits_returned += credits_to_return_;
+  statistics_.credit_packets_sent++;
+  credits_to_return_ = 0;
 }
 
 }  // namespace internal
@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <chrono>
 #include <memory>
 #include <unordered_map>
 #include <utility>
@@ -28,6 +29,7 @@
 #include "l2cap/internal/scheduler.h"
 #include "l2cap/l2cap_packets.h"
 #include "l2cap/mtu.h"
+#include "os/alarm.h"
 #include "os/handler.h"
 #include "os/queue.h"
 #include "packet/base_packet_builder.h"
@@ -39,6 +41,24 @@ namespace internal {
 
 class LeCreditBasedDataController : public DataController {
  public:
+  // Consumed K-frames are credited back to the remote after this long at the latest
+  static constexpr std::chrono::milliseconds kCreditReturnTimeout = std::chrono::milliseconds(50);
+
+  struct Statistics {
+    uint64_t sdus_sent = 0;
+    uint64_t bytes_sent = 0;
+    uint64_t k_frames_sent = 0;
+    uint64_t sdus_received = 0;
+    uint64_t bytes_received = 0;
+    uint64_t k_frames_received = 0;
+    uint64_t credits_received = 0;
+    uint64_t credits_returned = 0;
+    uint64_t credit_packets_sent = 0;
+    // Times K-frames were waiting for credits, and how long they waited in total
+    uint64_t credit_stalls = 0;
+    std::chrono::milliseconds credit_stall_time{0};
+  };
+
   using UpperEnqueue = packet::PacketView<packet::kLittleEndian>;
   using UpperDequeue = packet::BasePacketBuilder;
   using UpperQueueDownEnd = common::BidiQueueEnd<UpperEnqueue, UpperDequeue>;
@@ -51,12 +71,18 @@ class LeCreditBasedDataController : public DataController {
 
   void EnableFcs(bool enabled) override {}
   void SetRetransmissionAndFlowControlOptions(const RetransmissionAndFlowControlConfigurationOption& option) override {}
+  void EnableExtendedWindowSize(uint16_t local_tx_window, uint16_t remote_tx_window) override {}
 
   // TODO: Set MTU and MPS from signalling channel
   void SetMtu(Mtu mtu);
   void SetMps(uint16_t mps);
   // TODO: Handle credits
   void OnCredit(uint16_t credits);
+  // Credits given to the remote when the channel is created, the K-frames it can send before we return credits
+  void SetReceiveCredits(uint16_t credits);
+
+  const Statistics& GetStatistics() const;
+  void Dump(int fd) const;
 
  private:
   Cid cid_;
@@ -70,6 +96,14 @@ class LeCreditBasedDataController : public DataController {
   uint16_t mps_ = 251;
   uint16_t credits_ = 0;
   uint16_t pending_frames_count_ = 0;
+  // Credits are returned together once this many K-frames are consumed, or when credit_return_alarm_ fires
+  uint16_t credit_return_threshold_ = 1;
+  uint16_t credits_to_return_ = 0;
+  os::Alarm credit_return_alarm_;
+  Statistics statistics_;
+  std::chrono::steady_clock::time_point creation_time_ = std::chrono::steady_clock::now();
+  bool credit_stalled_ = false;
+  std::chrono::steady_clock::time_point credit_stall_start_;
 
   class PacketViewForReassembly : public packet::PacketView<kLittleEndian> {
    public:
@@ -80,6 +114,10 @@ class LeCreditBasedDataController : public DataController {
   };
   PacketViewForReassembly reassembly_stage_{std::make_shared<std::vector<uint8_t>>()};
   uint16_t remaining_sdu_continuation_packet_size_ = 0;
+
+  void send_pending_frames();
+  void on_k_frame_consumed();
+  void return_credits();
 };
 
 }  // namespace internal
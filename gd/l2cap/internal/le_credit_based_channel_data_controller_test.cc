@@ -28,6 +28,8 @@ namespace l2cap {
 namespace internal {
 namespace {
 
+using ::testing::_;
+
 std::unique_ptr<packet::BasePacketBuilder> CreateSdu(std::vector<uint8_t> payload) {
   auto raw_builder = std::make_unique<packet::RawBuilder>();
   raw_builder->AddOctets(payload);
@@ -181,6 +183,54 @@ TEST_F(LeCreditBasedDataControllerTest, receive_segmented_with_wrong_sdu_length)
   EXPECT_EQ(payload, nullptr);
 }
 
+TEST_F(LeCreditBasedDataControllerTest, transmit_waits_for_credits) {
+  common::BidiQueue<Scheduler::UpperEnqueue, Scheduler::UpperDequeue> channel_queue{10};
+  testing::MockScheduler scheduler;
+  testing::MockILink link;
+  LeCreditBasedDataController controller{&link, 0x41, 0x41, channel_queue.GetDownEnd(), queue_handler_, &scheduler};
+  controller.SetMps(4);
+  EXPECT_CALL(scheduler, OnPacketsReady(_, _)).Times(0);
+  controller.OnSdu(CreateSdu({'a', 'b', 'c', 'd'}));
+  EXPECT_EQ(controller.GetStatistics().credit_stalls, 1u);
+  ::testing::Mock::VerifyAndClearExpectations(&scheduler);
+  EXPECT_CALL(scheduler, OnPacketsReady(0x41, 1)).Times(2);
+  controller.OnCredit(1);
+  controller.OnCredit(1);
+  EXPECT_EQ(controller.GetStatistics().credits_received, 2u);
+  EXPECT_EQ(controller.GetStatistics().bytes_sent, 4u);
+}
+
+TEST_F(LeCreditBasedDataControllerTest, credits_are_returned_in_batches) {
+  common::BidiQueue<Scheduler::UpperEnqueue, Scheduler::UpperDequeue> channel_queue{10};
+  testing::MockScheduler scheduler;
+  testing::MockILink link;
+  LeCreditBasedDataController controller{&link, 0x41, 0x41, channel_queue.GetDownEnd(), queue_handler_, &scheduler};
+  controller.SetReceiveCredits(8);
+  EXPECT_CALL(link, SendLeCredit(0x41, 2));
+  for (int i = 0; i < 2; i++) {
+    auto builder = FirstLeInformationFrameBuilder::Create(0x41, 1, CreateSdu({'a'}));
+    controller.OnPdu(GetPacketView(std::move(builder)));
+  }
+  sync_handler(queue_handler_);
+  EXPECT_EQ(controller.GetStatistics().sdus_received, 2u);
+  EXPECT_EQ(controller.GetStatistics().credits_returned, 2u);
+  EXPECT_EQ(controller.GetStatistics().credit_packets_sent, 1u);
+}
+
+TEST_F(LeCreditBasedDataControllerTest, credits_below_threshold_are_returned_after_timeout) {
+  common::BidiQueue<Scheduler::UpperEnqueue, Scheduler::UpperDequeue> channel_queue{10};
+  testing::MockScheduler scheduler;
+  testing::MockILink link;
+  LeCreditBasedDataController controller{&link, 0x41, 0x41, channel_queue.GetDownEnd(), queue_handler_, &scheduler};
+  controller.SetReceiveCredits(8);
+  std::promise<void> promise;
+  auto future = promise.get_future();
+  EXPECT_CALL(link, SendLeCredit(0x41, 1)).WillOnce([&promise](Cid, uint16_t) { promise.set_value(); });
+  auto builder = FirstLeInformationFrameBuilder::Create(0x41, 1, CreateSdu({'a'}));
+  controller.OnPdu(GetPacketView(std::move(builder)));
+  EXPECT_EQ(future.wait_for(std::chrono::seconds(1)), std::future_status::ready);
+}
+
 }  // namespace
 }  // namespace internal
 }  // namespace l2cap
@@ -18,6 +18,8 @@
 
 #include <chrono>
 
+#include "l2cap/internal/scheduler.h"
+
 namespace bluetooth {
 namespace l2cap {
 namespace internal {
@@ -33,6 +35,9 @@ class ParameterProvider {
   virtual std::chrono::milliseconds GetClassicLinkIdleDisconnectTimeout() {
     return std::chrono::seconds(20);
   }
+  virtual SchedulerType GetClassicLinkSchedulerType() {
+    return SchedulerType::WEIGHTED_ROUND_ROBIN;
+  }
   virtual std::chrono::milliseconds GetLeLinkIdleDisconnectTimeout() {
     return std::chrono::seconds(20);
   }
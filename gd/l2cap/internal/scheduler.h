@@ -32,6 +32,15 @@ namespace bluetooth {
 namespace l2cap {
 namespace internal {
 
+/**
+ * The scheduling policies a link can use: FIFO serves the channels in the order they had packets ready,
+ * WEIGHTED_ROUND_ROBIN serves them by latency class and weight.
+ */
+enum class SchedulerType {
+  FIFO,
+  WEIGHTED_ROUND_ROBIN,
+};
+
 /**
  * Handle the scheduling of packets through the l2cap stack.
  * For each attached channel, dequeue its outgoing packets and enqueue it to the given LinkQueueUpEnd, according to some
@@ -54,6 +63,20 @@ class Scheduler {
    */
   virtual void OnPacketsReady(Cid cid, int number_packets) {}
 
+  using LatencyClass = classic::DynamicChannelConfigurationOption::LatencyClass;
+
+  /**
+   * Set how the packets of a channel are scheduled against the other channels of the link. Schedulers without a
+   * notion of priority ignore it.
+   */
+  virtual void SetChannelSchedulingOption(Cid cid, LatencyClass latency_class, uint8_t weight) {}
+
+  /**
+   * Callback from the data pipeline manager to indicate that the channel is detached, and that its pending packets
+   * can't be dequeued anymore
+   */
+  virtual void OnChannelDetached(Cid cid) {}
+
   virtual ~Scheduler() = default;
 };
 
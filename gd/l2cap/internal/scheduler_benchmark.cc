@@ -0,0 +1,204 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "benchmark/benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <future>
+#include <vector>
+
+#include "l2cap/internal/data_controller.h"
+#include "l2cap/internal/data_pipeline_manager.h"
+#include "l2cap/internal/scheduler_fifo.h"
+#include "l2cap/internal/scheduler_weighted_round_robin.h"
+#include "os/handler.h"
+#include "os/thread.h"
+
+using ::benchmark::State;
+
+namespace bluetooth {
+namespace l2cap {
+namespace internal {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr Cid kBulkCid = 0x40;
+constexpr Cid kLowLatencyCid = 0x41;
+// Bulk packets made ready together with each low latency packet, like a file transfer next to an audio stream
+constexpr int kBulkPacketsPerRound = 32;
+
+// A packet that remembers its channel and when it was made ready, instead of being serialized
+class TimestampedPacket : public packet::BasePacketBuilder {
+ public:
+  TimestampedPacket(Cid cid, Clock::time_point ready_time) : cid_(cid), ready_time_(ready_time) {}
+  size_t size() const override {
+    return 0;
+  }
+  void Serialize(packet::BitInserter&) const override {}
+
+  Cid cid_;
+  Clock::time_point ready_time_;
+};
+
+class TimestampedDataController : public DataController {
+ public:
+  explicit TimestampedDataController(Cid cid) : cid_(cid) {}
+
+  void OnSdu(std::unique_ptr<packet::BasePacketBuilder> sdu) override {}
+  void OnPdu(packet::PacketView<true> pdu) override {}
+  void EnableFcs(bool enabled) override {}
+  void SetRetransmissionAndFlowControlOptions(const RetransmissionAndFlowControlConfigurationOption& option) override {
+  }
+  void EnableExtendedWindowSize(uint16_t local_tx_window, uint16_t remote_tx_window) override {}
+
+  void AddReadyPackets(int number_packets) {
+    auto now = Clock::now();
+    for (int i = 0; i < number_packets; i++) {
+      ready_times_.push_back(now);
+    }
+  }
+
+  std::unique_ptr<packet::BasePacketBuilder> GetNextPacket() override {
+    auto packet = std::make_unique<TimestampedPacket>(cid_, ready_times_.front());
+    ready_times_.pop_front();
+    return packet;
+  }
+
+ private:
+  Cid cid_;
+  std::deque<Clock::time_point> ready_times_;
+};
+
+class TimestampedDataPipelineManager : public DataPipelineManager {
+ public:
+  TimestampedDataPipelineManager(os::Handler* handler, LowerQueueUpEnd* link_queue_up_end)
+      : DataPipelineManager(handler, nullptr, link_queue_up_end) {}
+
+  DataController* GetDataController(Cid cid) override {
+    return cid == kBulkCid ? &bulk_controller_ : &low_latency_controller_;
+  }
+  void OnPacketSent(Cid cid) override {}
+
+  TimestampedDataController bulk_controller_{kBulkCid};
+  TimestampedDataController low_latency_controller_{kLowLatencyCid};
+};
+
+class BM_L2capScheduler : public ::benchmark::Fixture {
+ protected:
+  void SetUp(State& st) override {
+    ::benchmark::Fixture::SetUp(st);
+    low_latency_delays_us_.clear();
+    scheduler_thread_ = new os::Thread("scheduler_thread", os::Thread::Priority::NORMAL);
+    scheduler_handler_ = new os::Handler(scheduler_thread_);
+    controller_thread_ = new os::Thread("controller_thread", os::Thread::Priority::NORMAL);
+    controller_handler_ = new os::Handler(controller_thread_);
+    // The controller only buffers a few packets, so that the scheduler decides the order of the others
+    link_queue_ = new common::BidiQueue<Scheduler::LowerDequeue, Scheduler::LowerEnqueue>(4);
+    data_pipeline_manager_ = new TimestampedDataPipelineManager(scheduler_handler_, link_queue_->GetUpEnd());
+    if (st.range(0) == static_cast<int>(SchedulerType::WEIGHTED_ROUND_ROBIN)) {
+      auto scheduler =
+          std::make_unique<WeightedRoundRobin>(data_pipeline_manager_, link_queue_->GetUpEnd(), scheduler_handler_);
+      scheduler->SetChannelSchedulingOption(kLowLatencyCid, Scheduler::LatencyClass::LOW_LATENCY, 1);
+      scheduler_ = std::move(scheduler);
+    } else {
+      scheduler_ = std::make_unique<Fifo>(data_pipeline_manager_, link_queue_->GetUpEnd(), scheduler_handler_);
+    }
+  }
+
+  void TearDown(State& st) override {
+    scheduler_handler_->Post([this]() { scheduler_.reset(); });
+    std::promise<void> promise;
+    auto future = promise.get_future();
+    scheduler_handler_->Post([&promise]() { promise.set_value(); });
+    future.wait();
+    scheduler_handler_->Clear();
+    controller_handler_->Clear();
+    delete data_pipeline_manager_;
+    delete link_queue_;
+    delete scheduler_handler_;
+    delete scheduler_thread_;
+    delete controller_handler_;
+    delete controller_thread_;
+    ::benchmark::Fixture::TearDown(st);
+  }
+
+  // Runs on the controller thread
+  void on_link_packet() {
+    auto packet = link_queue_->GetDownEnd()->TryDequeue();
+    auto* timestamped_packet = static_cast<TimestampedPacket*>(packet.get());
+    if (timestamped_packet->cid_ == kLowLatencyCid) {
+      low_latency_delays_us_.push_back(
+          std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - timestamped_packet->ready_time_)
+              .count());
+    }
+    if (--remaining_packets_ == 0) {
+      round_promise_->set_value();
+    }
+  }
+
+  os::Thread* scheduler_thread_ = nullptr;
+  os::Handler* scheduler_handler_ = nullptr;
+  os::Thread* controller_thread_ = nullptr;
+  os::Handler* controller_handler_ = nullptr;
+  common::BidiQueue<Scheduler::LowerDequeue, Scheduler::LowerEnqueue>* link_queue_ = nullptr;
+  TimestampedDataPipelineManager* data_pipeline_manager_ = nullptr;
+  std::unique_ptr<Scheduler> scheduler_;
+  int remaining_packets_ = 0;
+  std::promise<void>* round_promise_ = nullptr;
+  std::vector<double> low_latency_delays_us_;
+};
+
+// Each round makes the bulk channel and then the low latency channel ready, and waits for the controller to receive
+// all of their packets. Reports the delay between a low latency packet being ready and reaching the controller.
+BENCHMARK_DEFINE_F(BM_L2capScheduler, mixed_bulk_and_low_latency)(State& state) {
+  link_queue_->GetDownEnd()->RegisterDequeue(
+      controller_handler_, common::Bind(&BM_L2capScheduler::on_link_packet, common::Unretained(this)));
+  for (auto _ : state) {
+    std::promise<void> promise;
+    auto future = promise.get_future();
+    round_promise_ = &promise;
+    remaining_packets_ = kBulkPacketsPerRound + 1;
+    scheduler_handler_->Post([this]() {
+      data_pipeline_manager_->bulk_controller_.AddReadyPackets(kBulkPacketsPerRound);
+      scheduler_->OnPacketsReady(kBulkCid, kBulkPacketsPerRound);
+      data_pipeline_manager_->low_latency_controller_.AddReadyPackets(1);
+      scheduler_->OnPacketsReady(kLowLatencyCid, 1);
+    });
+    future.wait();
+  }
+  link_queue_->GetDownEnd()->UnregisterDequeue();
+
+  std::sort(low_latency_delays_us_.begin(), low_latency_delays_us_.end());
+  if (!low_latency_delays_us_.empty()) {
+    state.counters["low_latency_p50_us"] = low_latency_delays_us_[low_latency_delays_us_.size() / 2];
+    state.counters["low_latency_p99_us"] = low_latency_delays_us_[low_latency_delays_us_.size() * 99 / 100];
+  }
+  state.SetItemsProcessed(state.iterations() * (kBulkPacketsPerRound + 1));
+}
+
+BENCHMARK_REGISTER_F(BM_L2capScheduler, mixed_bulk_and_low_latency)
+    ->Arg(static_cast<int>(SchedulerType::FIFO))
+    ->Arg(static_cast<int>(SchedulerType::WEIGHTED_ROUND_ROBIN))
+    ->Iterations(1000)
+    ->UseRealTime();
+
+}  // namespace
+}  // namespace internal
+}  // namespace l2cap
+}  // namespace bluetooth
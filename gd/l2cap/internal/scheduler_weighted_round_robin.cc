@@ -0,0 +1,123 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "l2cap/internal/scheduler_weighted_round_robin.h"
+
+#include "l2cap/internal/data_pipeline_manager.h"
+#include "os/log.h"
+
+namespace bluetooth {
+namespace l2cap {
+namespace internal {
+
+WeightedRoundRobin::WeightedRoundRobin(DataPipelineManager* data_pipeline_manager, LowerQueueUpEnd* link_queue_up_end,
+                                       os::Handler* handler)
+    : data_pipeline_manager_(data_pipeline_manager), link_queue_up_end_(link_queue_up_end), handler_(handler) {
+  ASSERT(link_queue_up_end_ != nullptr && handler_ != nullptr);
+}
+
+WeightedRoundRobin::~WeightedRoundRobin() {
+  if (link_queue_enqueue_registered_) {
+    link_queue_up_end_->UnregisterEnqueue();
+  }
+}
+
+void WeightedRoundRobin::OnPacketsReady(Cid cid, int number_packets) {
+  if (number_packets == 0) {
+    return;
+  }
+  auto& channel = channels_[cid];
+  if (channel.pending_packets == 0) {
+    get_active_channels(channel.latency_class).push_back(cid);
+  }
+  channel.pending_packets += number_packets;
+  try_register_link_queue_enqueue();
+}
+
+void WeightedRoundRobin::SetChannelSchedulingOption(Cid cid, LatencyClass latency_class, uint8_t weight) {
+  auto& channel = channels_[cid];
+  if (channel.pending_packets > 0 && channel.latency_class != latency_class) {
+    get_active_channels(channel.latency_class).remove(cid);
+    get_active_channels(latency_class).push_back(cid);
+    channel.sent_in_turn = 0;
+  }
+  channel.latency_class = latency_class;
+  channel.weight = weight == 0 ? 1 : weight;
+}
+
+void WeightedRoundRobin::OnChannelDetached(Cid cid) {
+  auto channel = channels_.find(cid);
+  if (channel == channels_.end()) {
+    return;
+  }
+  if (channel->second.pending_packets > 0) {
+    get_active_channels(channel->second.latency_class).remove(cid);
+  }
+  channels_.erase(channel);
+  if (low_latency_channels_.empty() && bulk_channels_.empty() && link_queue_enqueue_registered_) {
+    link_queue_up_end_->UnregisterEnqueue();
+    link_queue_enqueue_registered_ = false;
+  }
+}
+
+std::list<Cid>& WeightedRoundRobin::get_active_channels(LatencyClass latency_class) {
+  return latency_class == LatencyClass::LOW_LATENCY ? low_latency_channels_ : bulk_channels_;
+}
+
+std::unique_ptr<WeightedRoundRobin::UpperDequeue> WeightedRoundRobin::link_queue_enqueue_callback() {
+  ASSERT(!low_latency_channels_.empty() || !bulk_channels_.empty());
+  std::list<Cid>* active_channels = &bulk_channels_;
+  if (!low_latency_channels_.empty() && (bulk_channels_.empty() || low_latency_burst_ < kLowLatencyBurst)) {
+    active_channels = &low_latency_channels_;
+    low_latency_burst_ = bulk_channels_.empty() ? 0 : low_latency_burst_ + 1;
+  } else {
+    low_latency_burst_ = 0;
+  }
+
+  auto channel_id = active_channels->front();
+  auto& channel = channels_[channel_id];
+  channel.pending_packets--;
+  channel.sent_in_turn++;
+  if (channel.pending_packets == 0) {
+    active_channels->pop_front();
+    channel.sent_in_turn = 0;
+  } else if (channel.sent_in_turn >= channel.weight) {
+    // End of the turn, the channel goes after the other channels of its class
+    active_channels->splice(active_channels->end(), *active_channels, active_channels->begin());
+    channel.sent_in_turn = 0;
+  }
+  auto packet = data_pipeline_manager_->GetDataController(channel_id)->GetNextPacket();
+
+  data_pipeline_manager_->OnPacketSent(channel_id);
+  if (low_latency_channels_.empty() && bulk_channels_.empty()) {
+    link_queue_up_end_->UnregisterEnqueue();
+    link_queue_enqueue_registered_ = false;
+  }
+  return packet;
+}
+
+void WeightedRoundRobin::try_register_link_queue_enqueue() {
+  if (link_queue_enqueue_registered_) {
+    return;
+  }
+  link_queue_up_end_->RegisterEnqueue(
+      handler_, common::Bind(&WeightedRoundRobin::link_queue_enqueue_callback, common::Unretained(this)));
+  link_queue_enqueue_registered_ = true;
+}
+
+}  // namespace internal
+}  // namespace l2cap
+}  // namespace bluetooth
@@ -0,0 +1,76 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <list>
+#include <unordered_map>
+
+#include "common/bidi_queue.h"
+#include "common/bind.h"
+#include "l2cap/cid.h"
+#include "l2cap/internal/scheduler.h"
+#include "os/handler.h"
+
+namespace bluetooth {
+namespace l2cap {
+namespace internal {
+class DataPipelineManager;
+
+/**
+ * Serves the LOW_LATENCY channels before the BULK channels, and the channels of the same latency class in turns of up
+ * to their weight in packets. To avoid starving bulk transfers, a bulk packet goes out after every kLowLatencyBurst
+ * low latency packets.
+ */
+class WeightedRoundRobin : public Scheduler {
+ public:
+  static constexpr int kLowLatencyBurst = 4;
+
+  WeightedRoundRobin(DataPipelineManager* data_pipeline_manager, LowerQueueUpEnd* link_queue_up_end,
+                     os::Handler* handler);
+  ~WeightedRoundRobin() override;
+  void OnPacketsReady(Cid cid, int number_packets) override;
+  void SetChannelSchedulingOption(Cid cid, LatencyClass latency_class, uint8_t weight) override;
+  void OnChannelDetached(Cid cid) override;
+
+ private:
+  struct ChannelState {
+    LatencyClass latency_class = LatencyClass::BULK;
+    uint8_t weight = 1;
+    int pending_packets = 0;
+    // Packets sent in the current turn of the channel
+    int sent_in_turn = 0;
+  };
+
+  DataPipelineManager* data_pipeline_manager_;
+  LowerQueueUpEnd* link_queue_up_end_;
+  os::Handler* handler_;
+  std::unordered_map<Cid, ChannelState> channels_;
+  // The channels with pending packets, in the order they are served
+  std::list<Cid> low_latency_channels_;
+  std::list<Cid> bulk_channels_;
+  // Low latency packets sent since the last bulk packet
+  int low_latency_burst_ = 0;
+  bool link_queue_enqueue_registered_ = false;
+
+  std::list<Cid>& get_active_channels(LatencyClass latency_class);
+  void try_register_link_queue_enqueue();
+  std::unique_ptr<LowerEnqueue> link_queue_enqueue_callback();
+};
+
+}  // namespace internal
+}  // namespace l2cap
+}  // namespace bluetooth
@@ -0,0 +1,169 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "l2cap/internal/scheduler_weighted_round_robin.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <future>
+
+#include "l2cap/internal/data_controller_mock.h"
+#include "l2cap/internal/data_pipeline_manager_mock.h"
+#include "os/handler.h"
+#include "os/queue.h"
+#include "os/thread.h"
+#include "packet/raw_builder.h"
+
+namespace bluetooth {
+namespace l2cap {
+namespace internal {
+namespace {
+
+using ::testing::_;
+using ::testing::Return;
+
+using LatencyClass = Scheduler::LatencyClass;
+
+constexpr Cid kBulkCid = 0x40;
+constexpr Cid kOtherBulkCid = 0x41;
+constexpr Cid kLowLatencyCid = 0x42;
+
+PacketView<kLittleEndian> GetPacketView(std::unique_ptr<packet::BasePacketBuilder> packet) {
+  auto bytes = std::make_shared<std::vector<uint8_t>>();
+  BitInserter i(*bytes);
+  bytes->reserve(packet->size());
+  packet->Serialize(i);
+  return packet::PacketView<packet::kLittleEndian>(bytes);
+}
+
+void sync_handler(os::Handler* handler) {
+  std::promise<void> promise;
+  auto future = promise.get_future();
+  handler->Post(common::BindOnce(&std::promise<void>::set_value, common::Unretained(&promise)));
+  auto status = future.wait_for(std::chrono::milliseconds(300));
+  EXPECT_EQ(status, std::future_status::ready);
+}
+
+// Sends empty basic frames on its channel
+class MyDataController : public testing::MockDataController {
+ public:
+  explicit MyDataController(Cid cid) : cid_(cid) {}
+
+  std::unique_ptr<BasePacketBuilder> GetNextPacket() override {
+    return BasicFrameBuilder::Create(cid_, std::make_unique<packet::RawBuilder>());
+  }
+
+ private:
+  Cid cid_;
+};
+
+class L2capSchedulerWeightedRoundRobinTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    thread_ = new os::Thread("test_thread", os::Thread::Priority::NORMAL);
+    queue_handler_ = new os::Handler(thread_);
+    mock_data_pipeline_manager_ = new testing::MockDataPipelineManager(queue_handler_, link_queue_.GetUpEnd());
+    scheduler_ = new WeightedRoundRobin(mock_data_pipeline_manager_, link_queue_.GetUpEnd(), queue_handler_);
+    ON_CALL(*mock_data_pipeline_manager_, GetDataController(kBulkCid)).WillByDefault(Return(&bulk_controller_));
+    ON_CALL(*mock_data_pipeline_manager_, GetDataController(kOtherBulkCid))
+        .WillByDefault(Return(&other_bulk_controller_));
+    ON_CALL(*mock_data_pipeline_manager_, GetDataController(kLowLatencyCid))
+        .WillByDefault(Return(&low_latency_controller_));
+    EXPECT_CALL(*mock_data_pipeline_manager_, GetDataController(_)).Times(::testing::AnyNumber());
+    EXPECT_CALL(*mock_data_pipeline_manager_, OnPacketSent(_)).Times(::testing::AnyNumber());
+  }
+
+  void TearDown() override {
+    delete scheduler_;
+    delete mock_data_pipeline_manager_;
+    queue_handler_->Clear();
+    delete queue_handler_;
+    delete thread_;
+  }
+
+  // Runs |ready| on the scheduler thread, so that all of its packets are ready before the first one is sent
+  void RunOnSchedulerThread(std::function<void()> ready) {
+    queue_handler_->Post(std::move(ready));
+    sync_handler(queue_handler_);
+  }
+
+  // The scheduler sends one packet each time the link queue can take one, wait for |count| of them
+  std::vector<Cid> GetSentChannels(size_t count) {
+    std::vector<Cid> channels;
+    for (int attempt = 0; channels.size() < count && attempt < 100; attempt++) {
+      sync_handler(queue_handler_);
+      for (auto packet = link_queue_.GetDownEnd()->TryDequeue(); packet != nullptr;
+           packet = link_queue_.GetDownEnd()->TryDequeue()) {
+        auto basic_frame_view = BasicFrameView::Create(GetPacketView(std::move(packet)));
+        EXPECT_TRUE(basic_frame_view.IsValid());
+        channels.push_back(basic_frame_view.GetChannelId());
+      }
+    }
+    return channels;
+  }
+
+  os::Thread* thread_ = nullptr;
+  os::Handler* queue_handler_ = nullptr;
+  common::BidiQueue<Scheduler::LowerDequeue, Scheduler::LowerEnqueue> link_queue_{10};
+  testing::MockDataPipelineManager* mock_data_pipeline_manager_ = nullptr;
+  MyDataController bulk_controller_{kBulkCid};
+  MyDataController other_bulk_controller_{kOtherBulkCid};
+  MyDataController low_latency_controller_{kLowLatencyCid};
+  WeightedRoundRobin* scheduler_ = nullptr;
+};
+
+TEST_F(L2capSchedulerWeightedRoundRobinTest, low_latency_channel_goes_first) {
+  RunOnSchedulerThread([this]() {
+    scheduler_->SetChannelSchedulingOption(kLowLatencyCid, LatencyClass::LOW_LATENCY, 1);
+    scheduler_->OnPacketsReady(kBulkCid, 3);
+    scheduler_->OnPacketsReady(kLowLatencyCid, 2);
+  });
+  EXPECT_EQ(GetSentChannels(5), (std::vector<Cid>{kLowLatencyCid, kLowLatencyCid, kBulkCid, kBulkCid, kBulkCid}));
+}
+
+TEST_F(L2capSchedulerWeightedRoundRobinTest, channels_send_their_weight_per_turn) {
+  RunOnSchedulerThread([this]() {
+    scheduler_->SetChannelSchedulingOption(kBulkCid, LatencyClass::BULK, 2);
+    scheduler_->OnPacketsReady(kBulkCid, 4);
+    scheduler_->OnPacketsReady(kOtherBulkCid, 4);
+  });
+  EXPECT_EQ(GetSentChannels(8), (std::vector<Cid>{kBulkCid, kBulkCid, kOtherBulkCid, kBulkCid, kBulkCid, kOtherBulkCid,
+                                                 kOtherBulkCid, kOtherBulkCid}));
+}
+
+TEST_F(L2capSchedulerWeightedRoundRobinTest, bulk_channel_is_not_starved) {
+  RunOnSchedulerThread([this]() {
+    scheduler_->SetChannelSchedulingOption(kLowLatencyCid, LatencyClass::LOW_LATENCY, 1);
+    scheduler_->OnPacketsReady(kLowLatencyCid, 6);
+    scheduler_->OnPacketsReady(kBulkCid, 2);
+  });
+  EXPECT_EQ(GetSentChannels(8), (std::vector<Cid>{kLowLatencyCid, kLowLatencyCid, kLowLatencyCid, kLowLatencyCid,
+                                                 kBulkCid, kLowLatencyCid, kLowLatencyCid, kBulkCid}));
+}
+
+TEST_F(L2capSchedulerWeightedRoundRobinTest, detached_channel_is_dropped) {
+  RunOnSchedulerThread([this]() {
+    scheduler_->OnPacketsReady(kBulkCid, 2);
+    scheduler_->OnPacketsReady(kOtherBulkCid, 2);
+    scheduler_->OnChannelDetached(kBulkCid);
+  });
+  EXPECT_EQ(GetSentChannels(2), (std::vector<Cid>{kOtherBulkCid, kOtherBulkCid}));
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace l2cap
+}  // namespace bluetooth
@@ -105,6 +105,16 @@ void Sender::UpdateClassicConfiguration(classic::internal::ChannelConfigurationS
     option.tx_window_size_ = config.remote_retransmission_and_flow_control_.tx_window_size_;
     data_controller_->SetRetransmissionAndFlowControlOptions(option);
     data_controller_->EnableFcs(config.fcs_type_ == FcsType::DEFAULT);
+    // Extended Window Size sent by either side replaces the TxWindow of that side, and enables the extended control
+    // field in both directions
+    if (config.local_extended_window_size_ != 0 || config.remote_extended_window_size_ != 0) {
+      uint16_t local_tx_window = config.local_extended_window_size_ != 0
+                                     ? config.local_extended_window_size_
+                                     : config.local_retransmission_and_flow_control_.tx_window_size_;
+      uint16_t remote_tx_window = config.remote_extended_window_size_ != 0 ? config.remote_extended_window_size_
+                                                                            : option.tx_window_size_;
+      data_controller_->EnableExtendedWindowSize(local_tx_window, remote_tx_window);
+    }
     return;
   }
 }
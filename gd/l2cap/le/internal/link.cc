@@ -15,10 +15,12 @@
  */
 
 #include <chrono>
+#include <cstdio>
 #include <memory>
 
 #include "hci/acl_manager.h"
 #include "l2cap/internal/dynamic_channel_impl.h"
+#include "l2cap/internal/le_credit_based_channel_data_controller.h"
 #include "l2cap/internal/parameter_provider.h"
 #include "l2cap/le/dynamic_channel_manager.h"
 #include "l2cap/le/internal/fixed_channel_impl.h"
@@ -182,6 +184,15 @@ void Link::SendLeCredit(Cid local_cid, uint16_t credit) {
   signalling_manager_.SendCredit(local_cid, credit);
 }
 
+void Link::Dump(int fd) {
+  dprintf(fd, " link:%s dynamic channels:%zu\n", ToString().c_str(), dynamic_channel_allocator_.NumberOfChannels());
+  for (auto cid : dynamic_channel_allocator_.GetChannelCids()) {
+    auto* data_controller =
+        static_cast<l2cap::internal::LeCreditBasedDataController*>(data_pipeline_manager_.GetDataController(cid));
+    data_controller->Dump(fd);
+  }
+}
+
 void Link::on_connection_update_complete(SignalId signal_id, hci::ErrorCode error_code) {
   ConnectionParameterUpdateResponseResult result = (error_code == hci::ErrorCode::SUCCESS)
                                                        ? ConnectionParameterUpdateResponseResult::ACCEPTED
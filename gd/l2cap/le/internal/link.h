@@ -118,6 +118,9 @@ class Link : public l2cap::internal::ILink {
 
   void SendLeCredit(Cid local_cid, uint16_t credit) override;
 
+  // Dumps the statistics of the credit based channels
+  virtual void Dump(int fd);
+
  private:
   os::Handler* l2cap_handler_;
   l2cap::internal::FixedChannelAllocator<FixedChannelImpl, Link> fixed_channel_allocator_{this, l2cap_handler_};
@@ -13,6 +13,7 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#include <cstdio>
 #include <memory>
 #include <unordered_map>
 
@@ -93,6 +94,13 @@ void LinkManager::ConnectDynamicChannelServices(
   link->SendConnectionRequest(psm, std::move(pending_dynamic_channel_connection));
 }
 
+void LinkManager::Dump(int fd) {
+  dprintf(fd, "L2cap Le links:%zu\n", links_.size());
+  for (auto& link : links_) {
+    link.second.Dump(fd);
+  }
+}
+
 Link* LinkManager::GetLink(hci::AddressWithType address_with_type) {
   if (links_.find(address_with_type) == links_.end()) {
     return nullptr;
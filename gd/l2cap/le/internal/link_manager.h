@@ -72,6 +72,8 @@ class LinkManager : public hci::LeConnectionCallbacks {
   void ConnectDynamicChannelServices(hci::AddressWithType device,
                                      Link::PendingDynamicChannelConnection pending_dynamic_channel_connection, Psm psm);
 
+  void Dump(int fd);
+
  private:
   // Dependencies
   os::Handler* l2cap_handler_;
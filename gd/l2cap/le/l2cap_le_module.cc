@@ -72,6 +72,10 @@ std::unique_ptr<FixedChannelManager> L2capLeModule::GetFixedChannelManager() {
                                                                       &pimpl_->link_manager_, pimpl_->l2cap_handler_));
 }
 
+void L2capLeModule::Dump(int fd) {
+  pimpl_->link_manager_.Dump(fd);
+}
+
 }  // namespace le
 }  // namespace l2cap
 }  // namespace bluetooth
@@ -34,6 +34,12 @@ class L2capLeModule : public bluetooth::Module {
    */
   virtual std::unique_ptr<FixedChannelManager> GetFixedChannelManager();
 
+  /**
+   * Dump the links and the throughput and credit statistics of their credit based channels to |fd|. Must be called
+   * on the module thread.
+   */
+  virtual void Dump(int fd);
+
   static const ModuleFactory Factory;
 
  protected:
@@ -16,6 +16,9 @@
 
 #include "module.h"
 
+#include <algorithm>
+#include <cstdio>
+
 using ::bluetooth::os::Handler;
 using ::bluetooth::os::Thread;
 
@@ -50,18 +53,25 @@ Module* Module::GetDependency(const ModuleFactory* module) const {
 }
 
 Module* ModuleRegistry::Get(const ModuleFactory* module) const {
+  std::lock_guard<std::mutex> lock(mutex_);
   auto instance = started_modules_.find(module);
   ASSERT(instance != started_modules_.end());
   return instance->second;
 }
 
 bool ModuleRegistry::IsStarted(const ModuleFactory* module) const {
+  std::lock_guard<std::mutex> lock(mutex_);
   return started_modules_.find(module) != started_modules_.end();
 }
 
 void ModuleRegistry::Start(ModuleList* modules, Thread* thread) {
+  reset_start_time();
+  if (max_parallel_starts_ > 1) {
+    start_in_parallel(modules, thread);
+    return;
+  }
   for (auto it = modules->list_.begin(); it != modules->list_.end(); it++) {
-    Start(*it, thread);
+    start_sequentially(*it, thread);
   }
 }
 
@@ -71,21 +81,148 @@ void ModuleRegistry::set_registry_and_handler(Module* instance, Thread* thread)
 }
 
 Module* ModuleRegistry::Start(const ModuleFactory* module, Thread* thread) {
-  auto started_instance = started_modules_.find(module);
-  if (started_instance != started_modules_.end()) {
-    return started_instance->second;
+  reset_start_time();
+  if (max_parallel_starts_ > 1) {
+    ModuleList modules;
+    modules.list_.push_back(module);
+    start_in_parallel(&modules, thread);
+    return Get(module);
+  }
+  return start_sequentially(module, thread);
+}
+
+Module* ModuleRegistry::start_sequentially(const ModuleFactory* module, Thread* thread) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto started_instance = started_modules_.find(module);
+    if (started_instance != started_modules_.end()) {
+      return started_instance->second;
+    }
   }
 
   Module* instance = module->ctor_();
   set_registry_and_handler(instance, thread);
 
   instance->ListDependencies(&instance->dependencies_);
-  Start(&instance->dependencies_, thread);
+  for (auto dependency : instance->dependencies_.list_) {
+    start_sequentially(dependency, thread);
+  }
+
+  start_module(module, instance);
+  return instance;
+}
+
+void ModuleRegistry::start_in_parallel(ModuleList* modules, Thread* thread) {
+  struct PendingModule {
+    Module* instance = nullptr;
+    // Dependencies that have not started yet
+    size_t waiting_for = 0;
+    std::vector<const ModuleFactory*> dependents;
+  };
+  std::map<const ModuleFactory*, PendingModule> pending;
+
+  // Construct every module that is not started yet, to learn the whole dependency graph before starting any
+  std::vector<const ModuleFactory*> to_construct(modules->list_.begin(), modules->list_.end());
+  while (!to_construct.empty()) {
+    auto module = to_construct.back();
+    to_construct.pop_back();
+    if (IsStarted(module) || pending.count(module) != 0) {
+      continue;
+    }
+    Module* instance = module->ctor_();
+    set_registry_and_handler(instance, thread);
+    instance->ListDependencies(&instance->dependencies_);
+    pending[module].instance = instance;
+    to_construct.insert(to_construct.end(), instance->dependencies_.list_.begin(),
+                        instance->dependencies_.list_.end());
+  }
+  if (pending.empty()) {
+    return;
+  }
+  for (auto& entry : pending) {
+    for (auto dependency : entry.second.instance->dependencies_.list_) {
+      auto pending_dependency = pending.find(dependency);
+      if (pending_dependency != pending.end()) {
+        entry.second.waiting_for++;
+        pending_dependency->second.dependents.push_back(entry.first);
+      }
+    }
+  }
+
+  std::vector<Thread*> start_threads;
+  std::vector<Handler*> start_handlers;
+  for (size_t i = 0; i < std::min(max_parallel_starts_, pending.size()); i++) {
+    start_threads.push_back(new Thread("module_start_" + std::to_string(i), Thread::Priority::NORMAL));
+    start_handlers.push_back(new Handler(start_threads.back()));
+  }
+
+  // |scheduler_mutex| guards the counts of |pending| and the variables below
+  std::mutex scheduler_mutex;
+  size_t remaining = pending.size();
+  size_t next_handler = 0;
+  std::promise<void> promise;
+  auto future = promise.get_future();
+  std::function<void(const ModuleFactory*)> post_start = [&](const ModuleFactory* module) {
+    start_handlers[next_handler++ % start_handlers.size()]->Post([&, module]() {
+      start_module(module, pending.at(module).instance);
+      bool all_started;
+      {
+        std::lock_guard<std::mutex> lock(scheduler_mutex);
+        for (auto dependent : pending.at(module).dependents) {
+          if (--pending.at(dependent).waiting_for == 0) {
+            post_start(dependent);
+          }
+        }
+        all_started = --remaining == 0;
+      }
+      if (all_started) {
+        promise.set_value();
+      }
+    });
+  };
+  {
+    std::lock_guard<std::mutex> lock(scheduler_mutex);
+    for (auto& entry : pending) {
+      if (entry.second.waiting_for == 0) {
+        post_start(entry.first);
+      }
+    }
+  }
+  future.wait();
+
+  for (size_t i = 0; i < start_handlers.size(); i++) {
+    start_handlers[i]->Clear();
+    start_handlers[i]->WaitUntilStopped(kModuleStopTimeout);
+    delete start_handlers[i];
+    delete start_threads[i];
+  }
+}
 
+void ModuleRegistry::start_module(const ModuleFactory* module, Module* instance) {
+  auto begin = std::chrono::steady_clock::now();
   instance->Start();
+  auto end = std::chrono::steady_clock::now();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto& timing = timings_[module];
+  timing.name = instance->ToString();
+  timing.dependencies = instance->dependencies_.list_;
+  timing.start_offset = std::chrono::duration_cast<std::chrono::microseconds>(begin - start_time_);
+  timing.start_duration = std::chrono::duration_cast<std::chrono::microseconds>(end - begin);
   start_order_.push_back(module);
   started_modules_[module] = instance;
-  return instance;
+}
+
+void ModuleRegistry::reset_start_time() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (started_modules_.empty()) {
+    start_time_ = std::chrono::steady_clock::now();
+  }
+}
+
+void ModuleRegistry::SetMaxParallelStarts(size_t max_parallel_starts) {
+  ASSERT(max_parallel_starts > 0);
+  max_parallel_starts_ = max_parallel_starts;
 }
 
 void ModuleRegistry::StopAll() {
@@ -94,13 +231,17 @@ void ModuleRegistry::StopAll() {
     auto instance = started_modules_.find(*it);
     ASSERT(instance != started_modules_.end());
 
+    auto begin = std::chrono::steady_clock::now();
     // Clear the handler before stopping the module to allow it to shut down gracefully.
     instance->second->handler_->Clear();
     instance->second->handler_->WaitUntilStopped(kModuleStopTimeout);
     instance->second->Stop();
+    auto end = std::chrono::steady_clock::now();
 
     delete instance->second->handler_;
     delete instance->second;
+    std::lock_guard<std::mutex> lock(mutex_);
+    timings_[*it].stop_duration = std::chrono::duration_cast<std::chrono::microseconds>(end - begin);
     started_modules_.erase(instance);
   }
 
@@ -108,7 +249,77 @@ void ModuleRegistry::StopAll() {
   start_order_.clear();
 }
 
+std::vector<const ModuleFactory*> ModuleRegistry::get_start_critical_path(std::chrono::microseconds* duration) const {
+  // Time from the first module starting to the end of the start of each module, had it only waited for its
+  // dependencies
+  std::map<const ModuleFactory*, std::chrono::microseconds> finish_times;
+  std::map<const ModuleFactory*, const ModuleFactory*> slowest_dependency;
+  std::function<std::chrono::microseconds(const ModuleFactory*)> get_finish_time = [&](const ModuleFactory* module) {
+    auto finish_time = finish_times.find(module);
+    if (finish_time != finish_times.end()) {
+      return finish_time->second;
+    }
+    auto timing = timings_.find(module);
+    if (timing == timings_.end()) {
+      return std::chrono::microseconds(0);
+    }
+    std::chrono::microseconds ready_time(0);
+    for (auto dependency : timing->second.dependencies) {
+      auto dependency_finish_time = get_finish_time(dependency);
+      if (dependency_finish_time > ready_time) {
+        ready_time = dependency_finish_time;
+        slowest_dependency[module] = dependency;
+      }
+    }
+    finish_times[module] = ready_time + timing->second.start_duration;
+    return finish_times[module];
+  };
+
+  const ModuleFactory* last = nullptr;
+  *duration = std::chrono::microseconds(0);
+  for (const auto& timing : timings_) {
+    auto finish_time = get_finish_time(timing.first);
+    if (last == nullptr || finish_time > *duration) {
+      last = timing.first;
+      *duration = finish_time;
+    }
+  }
+
+  std::vector<const ModuleFactory*> path;
+  for (auto module = last; module != nullptr;) {
+    path.push_back(module);
+    auto dependency = slowest_dependency.find(module);
+    module = dependency == slowest_dependency.end() ? nullptr : dependency->second;
+  }
+  std::reverse(path.begin(), path.end());
+  return path;
+}
+
+void ModuleRegistry::DumpTimings(int fd) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<std::pair<const ModuleFactory*, ModuleTiming>> timings(timings_.begin(), timings_.end());
+  std::sort(timings.begin(), timings.end(),
+            [](const auto& a, const auto& b) { return a.second.start_offset < b.second.start_offset; });
+
+  dprintf(fd, "Module timings (max parallel starts %zu):\n", max_parallel_starts_);
+  for (const auto& timing : timings) {
+    dprintf(fd, "  %-32s start at +%lld us took %lld us, last stop took %lld us\n", timing.second.name.c_str(),
+            static_cast<long long>(timing.second.start_offset.count()),
+            static_cast<long long>(timing.second.start_duration.count()),
+            static_cast<long long>(timing.second.stop_duration.count()));
+  }
+
+  std::chrono::microseconds duration;
+  auto path = get_start_critical_path(&duration);
+  dprintf(fd, "  Start critical path %lld us:", static_cast<long long>(duration.count()));
+  for (auto module : path) {
+    dprintf(fd, " %s%s", module == path.front() ? "" : "-> ", timings_.at(module).name.c_str());
+  }
+  dprintf(fd, "\n");
+}
+
 os::Handler* ModuleRegistry::GetModuleHandler(const ModuleFactory* module) const {
+  std::lock_guard<std::mutex> lock(mutex_);
   auto started_instance = started_modules_.find(module);
   if (started_instance != started_modules_.end()) {
     return started_instance->second->GetHandler();
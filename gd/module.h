@@ -16,9 +16,11 @@
 
 #pragma once
 
+#include <chrono>
 #include <functional>
 #include <future>
 #include <map>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -120,7 +122,24 @@ class ModuleRegistry {
   // Stop all running modules in reverse order of start
   void StopAll();
 
+  // With more than one, the modules whose dependencies have all started are started at the same time, on up to
+  // |max_parallel_starts| start threads. Their handlers still run on the thread given to Start(). The default of one
+  // starts the modules one at a time on the calling thread.
+  void SetMaxParallelStarts(size_t max_parallel_starts);
+
+  // Writes how long each module took to start and to stop, and the chain of dependencies that took longest to start
+  void DumpTimings(int fd) const;
+
  protected:
+  struct ModuleTiming {
+    std::string name;
+    std::vector<const ModuleFactory*> dependencies;
+    // Since the first module of the registry started to start
+    std::chrono::microseconds start_offset{0};
+    std::chrono::microseconds start_duration{0};
+    std::chrono::microseconds stop_duration{0};
+  };
+
   Module* Get(const ModuleFactory* module) const;
 
   void set_registry_and_handler(Module* instance, ::bluetooth::os::Thread* thread) const;
@@ -129,6 +148,22 @@ class ModuleRegistry {
 
   std::map<const ModuleFactory*, Module*> started_modules_;
   std::vector<const ModuleFactory*> start_order_;
+
+ private:
+  Module* start_sequentially(const ModuleFactory* module, ::bluetooth::os::Thread* thread);
+  void start_in_parallel(ModuleList* modules, ::bluetooth::os::Thread* thread);
+  // Calls Start() of |instance|, whose dependencies have all started
+  void start_module(const ModuleFactory* module, Module* instance);
+  void reset_start_time();
+  // The modules of the longest chain of dependencies to start, from the first one to start
+  std::vector<const ModuleFactory*> get_start_critical_path(std::chrono::microseconds* duration) const;
+
+  // Guards the state above against modules starting in parallel
+  mutable std::mutex mutex_;
+  size_t max_parallel_starts_ = 1;
+  std::chrono::steady_clock::time_point start_time_;
+  // Kept after StopAll(), so that the stop durations can be reported when the modules start again
+  std::map<const ModuleFactory*, ModuleTiming> timings_;
 };
 
 class TestModuleRegistry : public ModuleRegistry {
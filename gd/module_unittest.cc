@@ -16,6 +16,11 @@
 
 #include "module.h"
 
+#include <unistd.h>
+#include <atomic>
+#include <cstdio>
+#include <thread>
+
 #include "gtest/gtest.h"
 
 using ::bluetooth::os::Thread;
@@ -145,6 +150,77 @@ const ModuleFactory TestModuleTwoDependencies::Factory = ModuleFactory([]() {
   return new TestModuleTwoDependencies();
 });
 
+std::atomic<bool> fast_module_started{false};
+std::atomic<bool> slow_module_saw_fast_module{false};
+
+class TestModuleFast : public Module {
+ public:
+  static const ModuleFactory Factory;
+
+ protected:
+  void ListDependencies(ModuleList* list) override {}
+
+  void Start() override {
+    fast_module_started = true;
+  }
+
+  void Stop() override {}
+
+  std::string ToString() const override {
+    return "TestModuleFast";
+  }
+};
+
+const ModuleFactory TestModuleFast::Factory = ModuleFactory([]() { return new TestModuleFast(); });
+
+// Takes 20ms to start, unless TestModuleFast starts meanwhile
+class TestModuleSlow : public Module {
+ public:
+  static const ModuleFactory Factory;
+
+ protected:
+  void ListDependencies(ModuleList* list) override {}
+
+  void Start() override {
+    for (int i = 0; i < 20 && !fast_module_started; i++) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    slow_module_saw_fast_module = fast_module_started.load();
+  }
+
+  void Stop() override {}
+
+  std::string ToString() const override {
+    return "TestModuleSlow";
+  }
+};
+
+const ModuleFactory TestModuleSlow::Factory = ModuleFactory([]() { return new TestModuleSlow(); });
+
+class TestModuleJoin : public Module {
+ public:
+  static const ModuleFactory Factory;
+
+ protected:
+  void ListDependencies(ModuleList* list) override {
+    list->add<TestModuleSlow>();
+    list->add<TestModuleFast>();
+  }
+
+  void Start() override {
+    EXPECT_TRUE(GetModuleRegistry()->IsStarted<TestModuleSlow>());
+    EXPECT_TRUE(GetModuleRegistry()->IsStarted<TestModuleFast>());
+  }
+
+  void Stop() override {}
+
+  std::string ToString() const override {
+    return "TestModuleJoin";
+  }
+};
+
+const ModuleFactory TestModuleJoin::Factory = ModuleFactory([]() { return new TestModuleJoin(); });
+
 TEST_F(ModuleTest, no_dependency) {
   ModuleList list;
   list.add<TestModuleNoDependency>();
@@ -199,5 +275,48 @@ TEST_F(ModuleTest, two_dependencies) {
   EXPECT_FALSE(registry_->IsStarted<TestModuleTwoDependencies>());
 }
 
+TEST_F(ModuleTest, parallel_start_of_independent_modules) {
+  fast_module_started = false;
+  registry_->SetMaxParallelStarts(2);
+  ModuleList list;
+  list.add<TestModuleJoin>();
+  list.add<TestModuleTwoDependencies>();
+  registry_->Start(&list, thread_);
+
+  EXPECT_TRUE(slow_module_saw_fast_module);
+  EXPECT_TRUE(registry_->IsStarted<TestModuleJoin>());
+  EXPECT_TRUE(registry_->IsStarted<TestModuleTwoDependencies>());
+  EXPECT_TRUE(registry_->IsStarted<TestModuleNoDependency>());
+
+  registry_->StopAll();
+
+  EXPECT_FALSE(registry_->IsStarted<TestModuleJoin>());
+  EXPECT_FALSE(registry_->IsStarted<TestModuleSlow>());
+  EXPECT_FALSE(registry_->IsStarted<TestModuleTwoDependencies>());
+}
+
+TEST_F(ModuleTest, dump_timings_reports_critical_path) {
+  fast_module_started = false;
+  ModuleList list;
+  list.add<TestModuleJoin>();
+  registry_->Start(&list, thread_);
+  registry_->StopAll();
+
+  FILE* file = tmpfile();
+  ASSERT_NE(file, nullptr);
+  registry_->DumpTimings(fileno(file));
+  rewind(file);
+  std::string dump;
+  char buffer[256];
+  while (fgets(buffer, sizeof(buffer), file) != nullptr) {
+    dump += buffer;
+  }
+  fclose(file);
+
+  EXPECT_NE(dump.find("TestModuleFast"), std::string::npos);
+  EXPECT_NE(dump.find("Start critical path"), std::string::npos);
+  EXPECT_NE(dump.find("TestModuleSlow -> TestModuleJoin"), std::string::npos) << dump;
+}
+
 }  // namespace
 }  // namespace bluetooth
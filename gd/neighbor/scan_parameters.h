@@ -33,7 +33,7 @@ inline double ScanWindowTimeMs(ScanWindow window) {
   return kTimeTickMs * window;
 }
 
-using ScanParameters = struct {
+struct ScanParameters {
   ScanInterval interval;
   ScanWindow window;
 };
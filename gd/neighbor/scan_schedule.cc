@@ -0,0 +1,142 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "neighbor/scan_schedule.h"
+
+#include <algorithm>
+
+namespace bluetooth {
+namespace neighbor {
+
+namespace {
+
+struct WorkloadLimits {
+  Workload workload;
+  ScanSchedule schedule;
+};
+
+// The specification defaults for the page and inquiry scans, and a continuous LE scan
+constexpr ScanSchedule kDefaultSchedule = {
+    .page_scan = {.interval = 0x0800, .window = 0x0012},  // 1.28 s, 11.25 ms
+    .page_scan_interlaced = false,
+    .inquiry_scan = {.interval = 0x1000, .window = 0x0012},  // 2.56 s, 11.25 ms
+    .inquiry_scan_interlaced = false,
+    .le_scan = {.interval = 0x12c0, .window = 0x12c0},  // 3 s, 3 s
+};
+
+// While a link takes most of the slots, the controller skips many scan windows. An interlaced scan covers both halves
+// of the train in each window it keeps, so remote pages and inquiries still get through.
+constexpr WorkloadLimits kWorkloadLimits[] = {
+    // The audio needs most of the slots, leave it 90% of the LE scan time
+    {Workload::A2DP_STREAMING,
+     {
+         .page_scan = {.interval = 0x0800, .window = 0x0012},
+         .page_scan_interlaced = true,
+         .inquiry_scan = {.interval = 0x1000, .window = 0x0012},
+         .inquiry_scan_interlaced = true,
+         .le_scan = {.interval = 0x12c0, .window = 0x01e0},  // 3 s, 300 ms
+     }},
+    // Reports are small but latency sensitive
+    {Workload::HID,
+     {
+         .page_scan = {.interval = 0x0800, .window = 0x0012},
+         .page_scan_interlaced = true,
+         .inquiry_scan = {.interval = 0x1000, .window = 0x0012},
+         .inquiry_scan_interlaced = true,
+         .le_scan = {.interval = 0x12c0, .window = 0x03c0},  // 3 s, 600 ms
+     }},
+    // Let the pages and the LE initiator win against our own scans
+    {Workload::CONNECTING,
+     {
+         .page_scan = {.interval = 0x1000, .window = 0x0012},
+         .page_scan_interlaced = true,
+         .inquiry_scan = {.interval = 0x1000, .window = 0x0012},
+         .inquiry_scan_interlaced = true,
+         .le_scan = {.interval = 0x12c0, .window = 0x05a0},  // 3 s, 900 ms
+     }},
+};
+
+// Applies |limit| to |current|: the shortest window, the longest interval, and interlaced if either is
+void Cap(ScanParameters* current, bool* current_interlaced, ScanParameters limit, bool limit_interlaced) {
+  current->interval = std::max(current->interval, limit.interval);
+  current->window = std::min(current->window, limit.window);
+  *current_interlaced = *current_interlaced || limit_interlaced;
+}
+
+std::chrono::milliseconds BusyTime(ScanParameters params, bool interlaced, std::chrono::milliseconds elapsed) {
+  return std::chrono::milliseconds(static_cast<int64_t>(elapsed.count() * ScanDutyCycle(params, interlaced)));
+}
+
+}  // namespace
+
+std::string WorkloadsText(Workloads workloads) {
+  if (workloads == 0) return "idle";
+  std::string text;
+  auto add = [&](Workload workload, const char* name) {
+    if ((workloads & WorkloadBit(workload)) == 0) return;
+    if (!text.empty()) text += "|";
+    text += name;
+  };
+  add(Workload::A2DP_STREAMING, "A2DP_STREAMING");
+  add(Workload::HID, "HID");
+  add(Workload::CONNECTING, "CONNECTING");
+  add(Workload::LE_SCAN, "LE_SCAN");
+  return text;
+}
+
+bool ScanSchedule::operator==(const ScanSchedule& rhs) const {
+  return page_scan.interval == rhs.page_scan.interval && page_scan.window == rhs.page_scan.window &&
+         page_scan_interlaced == rhs.page_scan_interlaced && inquiry_scan.interval == rhs.inquiry_scan.interval &&
+         inquiry_scan.window == rhs.inquiry_scan.window && inquiry_scan_interlaced == rhs.inquiry_scan_interlaced &&
+         le_scan.interval == rhs.le_scan.interval && le_scan.window == rhs.le_scan.window;
+}
+
+ScanSchedule ComputeScanSchedule(Workloads workloads) {
+  ScanSchedule schedule = kDefaultSchedule;
+  for (const auto& limits : kWorkloadLimits) {
+    if ((workloads & WorkloadBit(limits.workload)) == 0) continue;
+    Cap(&schedule.page_scan, &schedule.page_scan_interlaced, limits.schedule.page_scan,
+        limits.schedule.page_scan_interlaced);
+    Cap(&schedule.inquiry_scan, &schedule.inquiry_scan_interlaced, limits.schedule.inquiry_scan,
+        limits.schedule.inquiry_scan_interlaced);
+    bool le_interlaced = false;
+    Cap(&schedule.le_scan, &le_interlaced, limits.schedule.le_scan, false);
+  }
+  return schedule;
+}
+
+double ScanDutyCycle(ScanParameters params, bool interlaced) {
+  if (params.interval == 0) return 0;
+  // An interlaced scan runs a second window right after the first one, when it fits in the interval
+  int windows = (interlaced && 2 * params.window <= params.interval) ? 2 : 1;
+  return std::min(1.0, static_cast<double>(windows * params.window) / params.interval);
+}
+
+void AccumulateRadioTime(const ScanSchedule& schedule, bool page_scan_enabled, bool inquiry_scan_enabled,
+                         bool le_scan_enabled, std::chrono::milliseconds elapsed, RadioTime* radio_time) {
+  if (page_scan_enabled) {
+    radio_time->page_scan += BusyTime(schedule.page_scan, schedule.page_scan_interlaced, elapsed);
+  }
+  if (inquiry_scan_enabled) {
+    radio_time->inquiry_scan += BusyTime(schedule.inquiry_scan, schedule.inquiry_scan_interlaced, elapsed);
+  }
+  if (le_scan_enabled) {
+    radio_time->le_scan += BusyTime(schedule.le_scan, false, elapsed);
+  }
+}
+
+}  // namespace neighbor
+}  // namespace bluetooth
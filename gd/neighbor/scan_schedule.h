@@ -0,0 +1,76 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "neighbor/scan_parameters.h"
+
+namespace bluetooth {
+namespace neighbor {
+
+// The activities that compete with the scans for the radio
+enum class Workload : uint8_t {
+  A2DP_STREAMING = 1 << 0,
+  HID = 1 << 1,
+  CONNECTING = 1 << 2,  // Paging or LE connection attempts in progress
+  LE_SCAN = 1 << 3,     // A client is scanning; only counted for the radio time
+};
+
+using Workloads = uint8_t;  // Bitmask of Workload
+
+inline Workloads WorkloadBit(Workload workload) {
+  return static_cast<Workloads>(workload);
+}
+
+std::string WorkloadsText(Workloads workloads);
+
+// Duty cycles of the page scan, inquiry scan and LE scan. The LE scan parameters are in the same 0.625 ms units.
+struct ScanSchedule {
+  ScanParameters page_scan;
+  bool page_scan_interlaced;
+  ScanParameters inquiry_scan;
+  bool inquiry_scan_interlaced;
+  ScanParameters le_scan;
+
+  bool operator==(const ScanSchedule& rhs) const;
+  bool operator!=(const ScanSchedule& rhs) const {
+    return !(*this == rhs);
+  }
+};
+
+// Picks the duty cycles for |workloads|. Each active workload limits each scan to a window and an interval of its own;
+// with several of them, a scan gets the shortest window and the longest interval, and is interlaced if any of them
+// asks for it. The same workloads always give the same schedule.
+ScanSchedule ComputeScanSchedule(Workloads workloads);
+
+// Fraction of the time a scan with |params| keeps the radio busy
+double ScanDutyCycle(ScanParameters params, bool interlaced);
+
+struct RadioTime {
+  std::chrono::milliseconds page_scan{0};
+  std::chrono::milliseconds inquiry_scan{0};
+  std::chrono::milliseconds le_scan{0};
+};
+
+// Adds to |radio_time| the time the enabled scans of |schedule| kept the radio busy over |elapsed|
+void AccumulateRadioTime(const ScanSchedule& schedule, bool page_scan_enabled, bool inquiry_scan_enabled,
+                         bool le_scan_enabled, std::chrono::milliseconds elapsed, RadioTime* radio_time);
+
+}  // namespace neighbor
+}  // namespace bluetooth
@@ -0,0 +1,108 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "neighbor/scan_schedule.h"
+
+#include <gtest/gtest.h>
+
+using namespace std::chrono_literals;
+
+namespace bluetooth {
+namespace neighbor {
+namespace {
+
+TEST(ScanScheduleTest, idle_uses_defaults) {
+  ScanSchedule schedule = ComputeScanSchedule(0);
+  EXPECT_EQ(schedule.page_scan.interval, 0x0800);
+  EXPECT_EQ(schedule.page_scan.window, 0x0012);
+  EXPECT_FALSE(schedule.page_scan_interlaced);
+  EXPECT_EQ(schedule.inquiry_scan.interval, 0x1000);
+  EXPECT_EQ(schedule.inquiry_scan.window, 0x0012);
+  EXPECT_FALSE(schedule.inquiry_scan_interlaced);
+  EXPECT_EQ(schedule.le_scan.interval, schedule.le_scan.window);
+}
+
+TEST(ScanScheduleTest, le_scan_alone_keeps_defaults) {
+  EXPECT_EQ(ComputeScanSchedule(WorkloadBit(Workload::LE_SCAN)), ComputeScanSchedule(0));
+}
+
+TEST(ScanScheduleTest, streaming_interlaces_and_reduces_le_scan) {
+  ScanSchedule idle = ComputeScanSchedule(0);
+  ScanSchedule streaming = ComputeScanSchedule(WorkloadBit(Workload::A2DP_STREAMING));
+  EXPECT_TRUE(streaming.page_scan_interlaced);
+  EXPECT_TRUE(streaming.inquiry_scan_interlaced);
+  EXPECT_LE(streaming.page_scan.window, idle.page_scan.window);
+  EXPECT_LT(ScanDutyCycle(streaming.le_scan, false), 0.11);
+  EXPECT_LT(ScanDutyCycle(streaming.le_scan, false), ScanDutyCycle(idle.le_scan, false));
+}
+
+TEST(ScanScheduleTest, combined_workloads_take_the_tightest_limits) {
+  ScanSchedule streaming = ComputeScanSchedule(WorkloadBit(Workload::A2DP_STREAMING));
+  ScanSchedule connecting = ComputeScanSchedule(WorkloadBit(Workload::CONNECTING));
+  ScanSchedule both =
+      ComputeScanSchedule(WorkloadBit(Workload::A2DP_STREAMING) | WorkloadBit(Workload::CONNECTING));
+
+  EXPECT_EQ(both.page_scan.interval, std::max(streaming.page_scan.interval, connecting.page_scan.interval));
+  EXPECT_EQ(both.le_scan.window, std::min(streaming.le_scan.window, connecting.le_scan.window));
+  EXPECT_TRUE(both.page_scan_interlaced);
+  EXPECT_LE(ScanDutyCycle(both.le_scan, false), ScanDutyCycle(streaming.le_scan, false));
+  EXPECT_LE(ScanDutyCycle(both.le_scan, false), ScanDutyCycle(connecting.le_scan, false));
+}
+
+TEST(ScanScheduleTest, schedule_is_deterministic) {
+  for (Workloads workloads = 0; workloads < 16; workloads++) {
+    EXPECT_EQ(ComputeScanSchedule(workloads), ComputeScanSchedule(workloads)) << WorkloadsText(workloads);
+  }
+}
+
+TEST(ScanScheduleTest, duty_cycle) {
+  EXPECT_DOUBLE_EQ(ScanDutyCycle({.interval = 0x0800, .window = 0x0200}, false), 0.25);
+  EXPECT_DOUBLE_EQ(ScanDutyCycle({.interval = 0x0800, .window = 0x0200}, true), 0.5);
+  // The second window doesn't fit
+  EXPECT_DOUBLE_EQ(ScanDutyCycle({.interval = 0x0800, .window = 0x0600}, true), 0.75);
+  EXPECT_DOUBLE_EQ(ScanDutyCycle({.interval = 0x0800, .window = 0x0800}, false), 1.0);
+  EXPECT_DOUBLE_EQ(ScanDutyCycle({.interval = 0, .window = 0}, false), 0);
+}
+
+TEST(ScanScheduleTest, radio_time_counts_enabled_scans) {
+  ScanSchedule schedule = {
+      .page_scan = {.interval = 0x0800, .window = 0x0200},
+      .page_scan_interlaced = true,
+      .inquiry_scan = {.interval = 0x1000, .window = 0x0400},
+      .inquiry_scan_interlaced = false,
+      .le_scan = {.interval = 0x0100, .window = 0x0010},
+  };
+  RadioTime radio_time;
+  AccumulateRadioTime(schedule, true, false, true, 1000ms, &radio_time);
+  EXPECT_EQ(radio_time.page_scan, 500ms);
+  EXPECT_EQ(radio_time.inquiry_scan, 0ms);
+  EXPECT_EQ(radio_time.le_scan, 62ms);
+
+  AccumulateRadioTime(schedule, true, true, false, 2000ms, &radio_time);
+  EXPECT_EQ(radio_time.page_scan, 1500ms);
+  EXPECT_EQ(radio_time.inquiry_scan, 500ms);
+  EXPECT_EQ(radio_time.le_scan, 62ms);
+}
+
+TEST(ScanScheduleTest, workloads_text) {
+  EXPECT_EQ(WorkloadsText(0), "idle");
+  EXPECT_EQ(WorkloadsText(WorkloadBit(Workload::A2DP_STREAMING) | WorkloadBit(Workload::LE_SCAN)),
+            "A2DP_STREAMING|LE_SCAN");
+}
+
+}  // namespace
+}  // namespace neighbor
+}  // namespace bluetooth
@@ -0,0 +1,236 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#define LOG_TAG "bt_gd_neigh"
+
+#include "neighbor/scan_scheduler.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+
+#include "common/bind.h"
+#include "hci/le_scanning_manager.h"
+#include "module.h"
+#include "neighbor/inquiry.h"
+#include "neighbor/page.h"
+#include "neighbor/scan.h"
+#include "os/handler.h"
+#include "os/log.h"
+
+namespace bluetooth {
+namespace neighbor {
+
+struct ScanSchedulerModule::impl {
+  impl(ScanSchedulerModule& module);
+
+  void Start();
+  void Stop();
+
+  void SetWorkloadActive(Workload workload, bool active);
+
+  ScanSchedule GetSchedule() const;
+  RadioTime GetRadioTime() const;
+  void Dump(int fd) const;
+
+ private:
+  void Apply(const ScanSchedule& schedule, bool force);
+  // Must be called with |mutex_| held
+  RadioTime RadioTimeUntil(std::chrono::steady_clock::time_point now) const;
+
+  ScanSchedulerModule& module_;
+
+  PageModule* page_module_;
+  InquiryModule* inquiry_module_;
+  ScanModule* scan_module_;
+  hci::LeScanningManager* le_scanning_manager_;
+
+  // Guards the state read by Dump() and the getters, which may run on other threads
+  mutable std::mutex mutex_;
+  Workloads workloads_{0};
+  ScanSchedule schedule_;
+  uint32_t schedule_changes_{0};
+
+  // The radio time is accounted up to |last_update_|, with the scans that were enabled at that time
+  RadioTime radio_time_;
+  std::chrono::steady_clock::time_point last_update_;
+  bool page_scan_enabled_{false};
+  bool inquiry_scan_enabled_{false};
+};
+
+const ModuleFactory neighbor::ScanSchedulerModule::Factory =
+    ModuleFactory([]() { return new neighbor::ScanSchedulerModule(); });
+
+neighbor::ScanSchedulerModule::impl::impl(neighbor::ScanSchedulerModule& module)
+    : module_(module), schedule_(ComputeScanSchedule(0)) {}
+
+void neighbor::ScanSchedulerModule::impl::Start() {
+  page_module_ = module_.GetDependency<PageModule>();
+  inquiry_module_ = module_.GetDependency<InquiryModule>();
+  scan_module_ = module_.GetDependency<ScanModule>();
+  le_scanning_manager_ = module_.GetDependency<hci::LeScanningManager>();
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  last_update_ = std::chrono::steady_clock::now();
+  page_scan_enabled_ = scan_module_->IsPageEnabled();
+  inquiry_scan_enabled_ = scan_module_->IsInquiryEnabled();
+  Apply(schedule_, true);
+}
+
+void neighbor::ScanSchedulerModule::impl::Stop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  RadioTime radio_time = RadioTimeUntil(std::chrono::steady_clock::now());
+  LOG_DEBUG("Radio time page scan:%lldms inquiry scan:%lldms le scan:%lldms",
+            static_cast<long long>(radio_time.page_scan.count()),
+            static_cast<long long>(radio_time.inquiry_scan.count()), static_cast<long long>(radio_time.le_scan.count()));
+}
+
+void neighbor::ScanSchedulerModule::impl::SetWorkloadActive(Workload workload, bool active) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto now = std::chrono::steady_clock::now();
+  radio_time_ = RadioTimeUntil(now);
+  last_update_ = now;
+  page_scan_enabled_ = scan_module_->IsPageEnabled();
+  inquiry_scan_enabled_ = scan_module_->IsInquiryEnabled();
+
+  Workloads workloads = active ? (workloads_ | WorkloadBit(workload)) : (workloads_ & ~WorkloadBit(workload));
+  if (workloads == workloads_) return;
+  workloads_ = workloads;
+
+  ScanSchedule schedule = ComputeScanSchedule(workloads_);
+  LOG_DEBUG("Workloads:%s", WorkloadsText(workloads_).c_str());
+  if (schedule == schedule_) return;
+  Apply(schedule, false);
+}
+
+void neighbor::ScanSchedulerModule::impl::Apply(const ScanSchedule& schedule, bool force) {
+  if (force || schedule.page_scan.interval != schedule_.page_scan.interval ||
+      schedule.page_scan.window != schedule_.page_scan.window) {
+    page_module_->SetScanActivity(schedule.page_scan);
+  }
+  if (force || schedule.page_scan_interlaced != schedule_.page_scan_interlaced) {
+    if (schedule.page_scan_interlaced) {
+      page_module_->SetInterlacedScan();
+    } else {
+      page_module_->SetStandardScan();
+    }
+  }
+
+  if (force || schedule.inquiry_scan.interval != schedule_.inquiry_scan.interval ||
+      schedule.inquiry_scan.window != schedule_.inquiry_scan.window) {
+    inquiry_module_->SetScanActivity(schedule.inquiry_scan);
+  }
+  if (force || schedule.inquiry_scan_interlaced != schedule_.inquiry_scan_interlaced) {
+    if (schedule.inquiry_scan_interlaced) {
+      inquiry_module_->SetInterlacedScan();
+    } else {
+      inquiry_module_->SetStandardScan();
+    }
+  }
+
+  if (force || schedule.le_scan.interval != schedule_.le_scan.interval ||
+      schedule.le_scan.window != schedule_.le_scan.window) {
+    le_scanning_manager_->SetScanParameters(schedule.le_scan.interval, schedule.le_scan.window);
+  }
+
+  if (!force) schedule_changes_++;
+  schedule_ = schedule;
+  LOG_INFO("Scan schedule for %s page:0x%x/0x%x%s inquiry:0x%x/0x%x%s le:0x%x/0x%x", WorkloadsText(workloads_).c_str(),
+           schedule_.page_scan.interval, schedule_.page_scan.window, schedule_.page_scan_interlaced ? " interlaced" : "",
+           schedule_.inquiry_scan.interval, schedule_.inquiry_scan.window,
+           schedule_.inquiry_scan_interlaced ? " interlaced" : "", schedule_.le_scan.interval, schedule_.le_scan.window);
+}
+
+RadioTime neighbor::ScanSchedulerModule::impl::RadioTimeUntil(std::chrono::steady_clock::time_point now) const {
+  RadioTime radio_time = radio_time_;
+  auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - last_update_);
+  AccumulateRadioTime(schedule_, page_scan_enabled_, inquiry_scan_enabled_,
+                      (workloads_ & WorkloadBit(Workload::LE_SCAN)) != 0, elapsed, &radio_time);
+  return radio_time;
+}
+
+ScanSchedule neighbor::ScanSchedulerModule::impl::GetSchedule() const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return schedule_;
+}
+
+RadioTime neighbor::ScanSchedulerModule::impl::GetRadioTime() const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return RadioTimeUntil(std::chrono::steady_clock::now());
+}
+
+void neighbor::ScanSchedulerModule::impl::Dump(int fd) const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  RadioTime radio_time = RadioTimeUntil(std::chrono::steady_clock::now());
+  dprintf(fd, "Scan scheduler workloads:%s schedule changes:%" PRIu32 "\n", WorkloadsText(workloads_).c_str(),
+          schedule_changes_);
+  dprintf(fd, "  page scan:0x%x/0x%x%s inquiry scan:0x%x/0x%x%s le scan:0x%x/0x%x\n", schedule_.page_scan.interval,
+          schedule_.page_scan.window, schedule_.page_scan_interlaced ? " interlaced" : "", schedule_.inquiry_scan.interval,
+          schedule_.inquiry_scan.window, schedule_.inquiry_scan_interlaced ? " interlaced" : "",
+          schedule_.le_scan.interval, schedule_.le_scan.window);
+  dprintf(fd, "  radio time page scan:%lldms inquiry scan:%lldms le scan:%lldms\n",
+          static_cast<long long>(radio_time.page_scan.count()),
+          static_cast<long long>(radio_time.inquiry_scan.count()), static_cast<long long>(radio_time.le_scan.count()));
+}
+
+/**
+ * General API here
+ */
+neighbor::ScanSchedulerModule::ScanSchedulerModule() : pimpl_(std::make_unique<impl>(*this)) {}
+
+neighbor::ScanSchedulerModule::~ScanSchedulerModule() {
+  pimpl_.reset();
+}
+
+void neighbor::ScanSchedulerModule::SetWorkloadActive(Workload workload, bool active) {
+  GetHandler()->Post(
+      common::BindOnce(&impl::SetWorkloadActive, common::Unretained(pimpl_.get()), workload, active));
+}
+
+ScanSchedule neighbor::ScanSchedulerModule::GetSchedule() const {
+  return pimpl_->GetSchedule();
+}
+
+RadioTime neighbor::ScanSchedulerModule::GetRadioTime() const {
+  return pimpl_->GetRadioTime();
+}
+
+void neighbor::ScanSchedulerModule::Dump(int fd) const {
+  pimpl_->Dump(fd);
+}
+
+/**
+ * Module methods here
+ */
+void neighbor::ScanSchedulerModule::ListDependencies(ModuleList* list) {
+  list->add<PageModule>();
+  list->add<InquiryModule>();
+  list->add<ScanModule>();
+  list->add<hci::LeScanningManager>();
+}
+
+void neighbor::ScanSchedulerModule::Start() {
+  pimpl_->Start();
+}
+
+void neighbor::ScanSchedulerModule::Stop() {
+  pimpl_->Stop();
+}
+
+}  // namespace neighbor
+}  // namespace bluetooth
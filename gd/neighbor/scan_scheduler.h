@@ -0,0 +1,57 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <memory>
+
+#include "module.h"
+#include "neighbor/scan_schedule.h"
+
+namespace bluetooth {
+namespace neighbor {
+
+// Arbitrates the radio between the page scan, the inquiry scan and the LE scan. The profiles report the workloads
+// they run, and the module applies the duty cycles ComputeScanSchedule() picks for them, instead of each client
+// writing raw scan parameters. It also keeps an estimate of the radio time spent in each scan.
+class ScanSchedulerModule : public bluetooth::Module {
+ public:
+  // Marks |workload| as running or not. Can be called from any thread.
+  void SetWorkloadActive(Workload workload, bool active);
+
+  ScanSchedule GetSchedule() const;
+  RadioTime GetRadioTime() const;
+
+  void Dump(int fd) const;
+
+  static const ModuleFactory Factory;
+
+  ScanSchedulerModule();
+  ~ScanSchedulerModule();
+
+ protected:
+  void ListDependencies(ModuleList* list) override;
+  void Start() override;
+  void Stop() override;
+
+ private:
+  struct impl;
+  std::unique_ptr<impl> pimpl_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScanSchedulerModule);
+};
+
+}  // namespace neighbor
+}  // namespace bluetooth
@@ -21,37 +21,38 @@
 #include <mutex>
 
 #include "common/callback.h"
+#include "common/inline_closure.h"
 #include "os/handler.h"
+#include "os/linux_generic/timer_multiplexer.h"
 #include "os/thread.h"
 #include "os/utils.h"
 
 namespace bluetooth {
 namespace os {
 
-// A single-shot alarm for reactor-based thread, implemented by Linux timerfd.
-// When it's constructed, it will register a reactable on the specified thread; when it's destroyed, it will unregister
-// itself from the thread.
+// A single-shot alarm for reactor-based thread, implemented as an entry of the thread's TimerMultiplexer,
+// so that all the alarms of a thread share a single timerfd. When it's destroyed, it disarms itself.
 class Alarm {
  public:
-  // Create and register a single-shot alarm on a given handler
+  // Create a single-shot alarm on a given handler
   explicit Alarm(Handler* handler);
 
-  // Unregister this alarm from the thread and release resource
+  // Disarm this alarm
   ~Alarm();
 
   DISALLOW_COPY_AND_ASSIGN(Alarm);
 
   // Schedule the alarm with given delay
-  void Schedule(OnceClosure task, std::chrono::milliseconds delay);
+  void Schedule(common::InlineOnceClosure task, std::chrono::milliseconds delay);
 
   // Cancel the alarm. No-op if it's not armed.
   void Cancel();
 
  private:
-  OnceClosure task_;
+  common::InlineOnceClosure task_;
   Handler* handler_;
-  int fd_ = 0;
-  Reactor::Reactable* token_;
+  TimerMultiplexer* timers_;
+  TimerMultiplexer::Entry timer_;
   mutable std::mutex mutex_;
   void on_fire();
 };
@@ -16,7 +16,9 @@
 
 #include <chrono>
 #include <future>
+#include <memory>
 #include <unordered_map>
+#include <vector>
 
 #include "benchmark/benchmark.h"
 
@@ -51,6 +53,7 @@ class BM_ReactableAlarm : public ::benchmark::Fixture {
   void TearDown(State& st) override {
     alarm_ = nullptr;
     repeating_alarm_ = nullptr;
+    handler_->Clear();
     handler_ = nullptr;
     thread_->Stop();
     thread_ = nullptr;
@@ -72,6 +75,13 @@ class BM_ReactableAlarm : public ::benchmark::Fixture {
     promise_.set_value();
   }
 
+  void CountFire() {
+    task_counter_++;
+    if (task_counter_ >= scheduled_tasks_) {
+      promise_.set_value();
+    }
+  }
+
   int64_t scheduled_tasks_;
   int64_t task_length_;
   int64_t task_interval_;
@@ -139,3 +149,35 @@ BENCHMARK_REGISTER_F(BM_ReactableAlarm, periodic_accuracy)
     ->Args({2000, 15, 20})
     ->Iterations(1)
     ->UseRealTime();
+
+// Many alarms live on one thread at once, each with its own deadline, as with the per-connection timers of the stack
+BENCHMARK_DEFINE_F(BM_ReactableAlarm, many_alarms)(State& state) {
+  scheduled_tasks_ = state.range(0);
+  std::vector<std::unique_ptr<Alarm>> alarms;
+  for (int64_t i = 0; i < scheduled_tasks_; i++) {
+    alarms.push_back(std::make_unique<Alarm>(handler_.get()));
+  }
+  for (auto _ : state) {
+    task_counter_ = 0;
+    promise_ = std::promise<void>();
+    auto start_time_point = std::chrono::steady_clock::now();
+    for (int64_t i = 0; i < scheduled_tasks_; i++) {
+      // Spread over 10ms, in reverse order of their deadlines
+      alarms[i]->Schedule(
+          Bind(&BM_ReactableAlarm_many_alarms_Benchmark::CountFire, bluetooth::common::Unretained(this)),
+          std::chrono::milliseconds(10 - i * 10 / scheduled_tasks_));
+    }
+    promise_.get_future().get();
+    auto end_time_point = std::chrono::steady_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end_time_point - start_time_point);
+    state.SetIterationTime(static_cast<double>(duration.count()) * 1e-9);
+  }
+  alarms.clear();
+};
+
+BENCHMARK_REGISTER_F(BM_ReactableAlarm, many_alarms)
+    ->Arg(10)
+    ->Arg(100)
+    ->Arg(1000)
+    ->Iterations(10)
+    ->UseManualTime();
@@ -0,0 +1,215 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "os/fake_timer/fake_timerfd.h"
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <atomic>
+#include <cerrno>
+#include <map>
+#include <mutex>
+
+#include "os/utils.h"
+
+namespace bluetooth {
+namespace os {
+namespace fake_timer {
+
+namespace {
+
+struct FakeTimer {
+  // 0 when disarmed
+  uint64_t deadline_ms = 0;
+  uint64_t interval_ms = 0;
+};
+
+std::atomic_bool enabled_{false};
+std::mutex mutex_;
+// Ordered by file descriptor, so that timers with the same deadline always fire in the same order
+std::map<int, FakeTimer> timers_;
+uint64_t clock_ms_ = 0;
+
+uint64_t timespec_to_ms(const struct timespec& time) {
+  return time.tv_sec * 1000 + time.tv_nsec / 1000000;
+}
+
+struct timespec ms_to_timespec(uint64_t ms) {
+  struct timespec time;
+  time.tv_sec = ms / 1000;
+  time.tv_nsec = (ms % 1000) * 1000000;
+  return time;
+}
+
+// Discards the expirations that were not read yet, like timerfd_settime() does
+void drain(int fd) {
+  uint64_t value;
+  ssize_t bytes_read;
+  RUN_NO_INTR(bytes_read = read(fd, &value, sizeof(value)));
+}
+
+// Returns the timer with the earliest deadline, or timers_.end() when none is armed. Must be called with the lock held
+std::map<int, FakeTimer>::iterator next_timer() {
+  auto next = timers_.end();
+  for (auto it = timers_.begin(); it != timers_.end(); it++) {
+    if (it->second.deadline_ms == 0) {
+      continue;
+    }
+    if (next == timers_.end() || it->second.deadline_ms < next->second.deadline_ms) {
+      next = it;
+    }
+  }
+  return next;
+}
+
+}  // namespace
+
+void set_fake_timers_enabled(bool enabled) {
+  enabled_ = enabled;
+}
+
+bool fake_timers_enabled() {
+  return enabled_;
+}
+
+int fake_timerfd_create(int clockid, int flags) {
+  // Always non blocking, so that re-arming can discard the pending expirations. Alarms only read when notified.
+  int fd = eventfd(0, EFD_NONBLOCK | ((flags & TFD_CLOEXEC) ? EFD_CLOEXEC : 0));
+  if (fd == -1) {
+    return -1;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  timers_[fd] = FakeTimer();
+  return fd;
+}
+
+int fake_timerfd_settime(int fd, int flags, const struct itimerspec* new_value, struct itimerspec* old_value) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto timer = timers_.find(fd);
+  if (timer == timers_.end()) {
+    errno = EBADF;
+    return -1;
+  }
+  if (old_value != nullptr) {
+    uint64_t remaining_ms = timer->second.deadline_ms == 0 ? 0 : timer->second.deadline_ms - clock_ms_;
+    old_value->it_value = ms_to_timespec(remaining_ms);
+    old_value->it_interval = ms_to_timespec(timer->second.interval_ms);
+  }
+  drain(fd);
+  uint64_t value_ms = timespec_to_ms(new_value->it_value);
+  if (value_ms == 0 && (new_value->it_value.tv_sec != 0 || new_value->it_value.tv_nsec != 0)) {
+    // Less than a millisecond still arms the timer
+    value_ms = 1;
+  }
+  timer->second.interval_ms = timespec_to_ms(new_value->it_interval);
+  if (value_ms == 0) {
+    timer->second.deadline_ms = 0;
+  } else if (flags & TFD_TIMER_ABSTIME) {
+    timer->second.deadline_ms = std::max(value_ms, clock_ms_ + 1);
+  } else {
+    timer->second.deadline_ms = clock_ms_ + value_ms;
+  }
+  return 0;
+}
+
+int fake_timerfd_close(int fd) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    timers_.erase(fd);
+  }
+  int close_status;
+  RUN_NO_INTR(close_status = close(fd));
+  return close_status;
+}
+
+bool is_fake_timerfd(int fd) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return timers_.count(fd) != 0;
+}
+
+uint64_t fake_timerfd_get_clock() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return clock_ms_;
+}
+
+void fake_timerfd_advance(uint64_t ms) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  uint64_t target_ms = clock_ms_ + ms;
+  // Fire one expiration at a time, in deadline order, so that the clock is right when each of them fires
+  for (auto timer = next_timer(); timer != timers_.end() && timer->second.deadline_ms <= target_ms;
+       timer = next_timer()) {
+    clock_ms_ = timer->second.deadline_ms;
+    uint64_t expirations = 1;
+    ssize_t bytes_written;
+    RUN_NO_INTR(bytes_written = write(timer->first, &expirations, sizeof(expirations)));
+    if (timer->second.interval_ms == 0) {
+      timer->second.deadline_ms = 0;
+    } else {
+      timer->second.deadline_ms += timer->second.interval_ms;
+    }
+  }
+  clock_ms_ = target_ms;
+}
+
+bool fake_timerfd_advance_to_next() {
+  uint64_t delay_ms;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto timer = next_timer();
+    if (timer == timers_.end()) {
+      return false;
+    }
+    delay_ms = timer->second.deadline_ms - clock_ms_;
+  }
+  fake_timerfd_advance(delay_ms);
+  return true;
+}
+
+void fake_timerfd_reset() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto& timer : timers_) {
+    timer.second = FakeTimer();
+    drain(timer.first);
+  }
+  clock_ms_ = 0;
+}
+
+int alarm_timerfd_create(int clockid, int flags) {
+  if (fake_timers_enabled()) {
+    return fake_timerfd_create(clockid, flags);
+  }
+  return timerfd_create(clockid, flags);
+}
+
+int alarm_timerfd_settime(int fd, int flags, const struct itimerspec* new_value, struct itimerspec* old_value) {
+  if (is_fake_timerfd(fd)) {
+    return fake_timerfd_settime(fd, flags, new_value, old_value);
+  }
+  return timerfd_settime(fd, flags, new_value, old_value);
+}
+
+int alarm_timerfd_close(int fd) {
+  if (is_fake_timerfd(fd)) {
+    return fake_timerfd_close(fd);
+  }
+  int close_status;
+  RUN_NO_INTR(close_status = close(fd));
+  return close_status;
+}
+
+}  // namespace fake_timer
+}  // namespace os
+}  // namespace bluetooth
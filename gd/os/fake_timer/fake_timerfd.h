@@ -0,0 +1,58 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <sys/timerfd.h>
+#include <cstdint>
+
+namespace bluetooth {
+namespace os {
+namespace fake_timer {
+
+// Timers on a virtual clock for host tests, with the timerfd API. A fake timer is an eventfd: it becomes readable,
+// with the number of expirations as its value, only when the test advances the clock past its deadline. Tests use it
+// to run hours of alarms in milliseconds, and get the same expirations each time.
+
+// Whether the alarms created from now on use fake timers
+void set_fake_timers_enabled(bool enabled);
+bool fake_timers_enabled();
+
+int fake_timerfd_create(int clockid, int flags);
+int fake_timerfd_settime(int fd, int flags, const struct itimerspec* new_value, struct itimerspec* old_value);
+int fake_timerfd_close(int fd);
+bool is_fake_timerfd(int fd);
+
+// Current time of the virtual clock, in milliseconds
+uint64_t fake_timerfd_get_clock();
+
+// Moves the virtual clock forward by |ms|, and fires the timers that expire on the way
+void fake_timerfd_advance(uint64_t ms);
+
+// Moves the virtual clock to the next deadline and fires the timers due then. Returns false when no timer is armed.
+bool fake_timerfd_advance_to_next();
+
+// Disarms every fake timer and rewinds the virtual clock
+void fake_timerfd_reset();
+
+// The timerfd calls of the alarms: fake timers when enabled, or for fake timer file descriptors
+int alarm_timerfd_create(int clockid, int flags);
+int alarm_timerfd_settime(int fd, int flags, const struct itimerspec* new_value, struct itimerspec* old_value);
+int alarm_timerfd_close(int fd);
+
+}  // namespace fake_timer
+}  // namespace os
+}  // namespace bluetooth
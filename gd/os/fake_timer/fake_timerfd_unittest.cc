@@ -0,0 +1,162 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "os/fake_timer/fake_timerfd.h"
+
+#include <unistd.h>
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "os/alarm.h"
+#include "os/repeating_alarm.h"
+
+namespace bluetooth {
+namespace os {
+namespace fake_timer {
+namespace {
+
+itimerspec ms_to_itimerspec(uint64_t value_ms, uint64_t interval_ms = 0) {
+  itimerspec timer_itimerspec{};
+  timer_itimerspec.it_value.tv_sec = value_ms / 1000;
+  timer_itimerspec.it_value.tv_nsec = value_ms % 1000 * 1000000;
+  timer_itimerspec.it_interval.tv_sec = interval_ms / 1000;
+  timer_itimerspec.it_interval.tv_nsec = interval_ms % 1000 * 1000000;
+  return timer_itimerspec;
+}
+
+// Returns the number of expirations since the last read, 0 when there were none
+uint64_t read_expirations(int fd) {
+  uint64_t expirations = 0;
+  if (read(fd, &expirations, sizeof(expirations)) != sizeof(expirations)) {
+    return 0;
+  }
+  return expirations;
+}
+
+class FakeTimerfdTest : public ::testing::Test {
+ protected:
+  void TearDown() override {
+    set_fake_timers_enabled(false);
+    fake_timerfd_reset();
+  }
+};
+
+TEST_F(FakeTimerfdTest, expires_only_when_the_clock_moves_past_the_deadline) {
+  int fd = fake_timerfd_create(CLOCK_BOOTTIME, 0);
+  ASSERT_NE(fd, -1);
+  auto timer_itimerspec = ms_to_itimerspec(3600 * 1000);
+  ASSERT_EQ(fake_timerfd_settime(fd, 0, &timer_itimerspec, nullptr), 0);
+  fake_timerfd_advance(3600 * 1000 - 1);
+  EXPECT_EQ(read_expirations(fd), 0u);
+  fake_timerfd_advance(1);
+  EXPECT_EQ(read_expirations(fd), 1u);
+  fake_timerfd_advance(3600 * 1000);
+  EXPECT_EQ(read_expirations(fd), 0u);
+  EXPECT_EQ(fake_timerfd_close(fd), 0);
+}
+
+TEST_F(FakeTimerfdTest, periodic_timer_counts_expirations) {
+  int fd = fake_timerfd_create(CLOCK_BOOTTIME, 0);
+  auto timer_itimerspec = ms_to_itimerspec(10, 10);
+  ASSERT_EQ(fake_timerfd_settime(fd, 0, &timer_itimerspec, nullptr), 0);
+  fake_timerfd_advance(105);
+  EXPECT_EQ(read_expirations(fd), 10u);
+  itimerspec old_itimerspec;
+  auto disarm_itimerspec = ms_to_itimerspec(0);
+  ASSERT_EQ(fake_timerfd_settime(fd, 0, &disarm_itimerspec, &old_itimerspec), 0);
+  EXPECT_EQ(old_itimerspec.it_value.tv_nsec, 5 * 1000000);
+  fake_timerfd_advance(100);
+  EXPECT_EQ(read_expirations(fd), 0u);
+  fake_timerfd_close(fd);
+}
+
+TEST_F(FakeTimerfdTest, advance_to_next_fires_the_earliest_timer) {
+  int first = fake_timerfd_create(CLOCK_BOOTTIME, 0);
+  int second = fake_timerfd_create(CLOCK_BOOTTIME, 0);
+  auto later_itimerspec = ms_to_itimerspec(500);
+  auto earlier_itimerspec = ms_to_itimerspec(200);
+  fake_timerfd_settime(first, 0, &later_itimerspec, nullptr);
+  fake_timerfd_settime(second, 0, &earlier_itimerspec, nullptr);
+
+  ASSERT_TRUE(fake_timerfd_advance_to_next());
+  EXPECT_EQ(fake_timerfd_get_clock(), 200u);
+  EXPECT_EQ(read_expirations(first), 0u);
+  EXPECT_EQ(read_expirations(second), 1u);
+  ASSERT_TRUE(fake_timerfd_advance_to_next());
+  EXPECT_EQ(fake_timerfd_get_clock(), 500u);
+  EXPECT_EQ(read_expirations(first), 1u);
+  EXPECT_FALSE(fake_timerfd_advance_to_next());
+  fake_timerfd_close(first);
+  fake_timerfd_close(second);
+}
+
+// Records the virtual time of each tick of a repeating alarm
+class TickRecorder {
+ public:
+  void on_tick() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ticks_.push_back(fake_timerfd_get_clock());
+    ticked_.notify_all();
+  }
+
+  std::vector<uint64_t> wait_for_ticks(size_t count) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    ticked_.wait_for(lock, std::chrono::seconds(1), [this, count]() { return ticks_.size() >= count; });
+    return ticks_;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable ticked_;
+  std::vector<uint64_t> ticks_;
+};
+
+TEST_F(FakeTimerfdTest, alarms_use_fake_timers_when_enabled) {
+  set_fake_timers_enabled(true);
+  Thread thread("test_thread", Thread::Priority::NORMAL);
+  Handler handler(&thread);
+  {
+    Alarm alarm(&handler);
+    RepeatingAlarm repeating_alarm(&handler);
+    std::promise<void> promise;
+    auto future = promise.get_future();
+    alarm.Schedule(common::BindOnce(&std::promise<void>::set_value, common::Unretained(&promise)),
+                   std::chrono::hours(24));
+    TickRecorder recorder;
+    repeating_alarm.Schedule(common::Bind(&TickRecorder::on_tick, common::Unretained(&recorder)),
+                             std::chrono::hours(1));
+    EXPECT_EQ(future.wait_for(std::chrono::milliseconds(10)), std::future_status::timeout);
+
+    // A day of alarms, an hour at a time
+    for (size_t hour = 1; hour <= 24; hour++) {
+      fake_timerfd_advance(3600 * 1000);
+      auto ticks = recorder.wait_for_ticks(hour);
+      ASSERT_EQ(ticks.size(), hour);
+      EXPECT_EQ(ticks.back(), hour * 3600 * 1000);
+    }
+    EXPECT_EQ(future.wait_for(std::chrono::seconds(1)), std::future_status::ready);
+    repeating_alarm.Cancel();
+  }
+  handler.Clear();
+}
+
+}  // namespace
+}  // namespace fake_timer
+}  // namespace os
+}  // namespace bluetooth
@@ -16,12 +16,14 @@
 
 #pragma once
 
+#include <atomic>
 #include <functional>
 #include <memory>
 #include <mutex>
-#include <queue>
 
 #include "common/callback.h"
+#include "common/inline_closure.h"
+#include "os/linux_generic/mpsc_queue.h"
 #include "os/thread.h"
 #include "os/utils.h"
 
@@ -30,7 +32,9 @@ namespace os {
 
 // A message-queue style handler for reactor-based thread to handle incoming events from different threads. When it's
 // constructed, it will register a reactable on the specified thread; when it's destroyed, it will unregister itself
-// from the thread.
+// from the thread. Posting never takes a lock: tasks go through a lock-free queue, and the thread is only woken up when
+// the queue gets its first task. Each wakeup then runs a batch of tasks. A task may clear its own handler, but must not
+// destroy it.
 class Handler {
  public:
   // Create and register a handler on given thread
@@ -41,8 +45,9 @@ class Handler {
 
   DISALLOW_COPY_AND_ASSIGN(Handler);
 
-  // Enqueue a closure to the queue of this handler
-  void Post(OnceClosure closure);
+  // Enqueue a closure to the queue of this handler. A lambda is stored inline without being bound into a OnceClosure
+  // first, so posting one that fits in common::InlineOnceClosure::kInlineSize makes no allocation for the closure.
+  void Post(common::InlineOnceClosure closure);
 
   // Remove all pending events from the queue of this handler
   void Clear();
@@ -58,14 +63,23 @@ class Handler {
   friend class RepeatingAlarm;
 
  private:
+  // Shared with the batch of tasks being run, which checks it after each task: another thread may clear and destroy
+  // the handler while a task runs
+  struct State {
+    // Serializes the consumer side of |tasks_| between the handler thread and Clear()
+    std::mutex mutex;
+    std::atomic<bool> cleared{false};
+  };
   inline bool was_cleared() const {
-    return tasks_ == nullptr;
+    return state_->cleared.load(std::memory_order_acquire);
   };
-  std::queue<OnceClosure>* tasks_;
+  MpscQueue<common::InlineOnceClosure> tasks_;
+  // Number of tasks posted and not run yet. The eventfd is only written when it goes up from zero.
+  std::atomic<size_t> pending_tasks_;
+  std::shared_ptr<State> state_;
   Thread* thread_;
   int fd_;
   Reactor::Reactable* reactable_;
-  mutable std::mutex mutex_;
   void handle_next_event();
 };
 
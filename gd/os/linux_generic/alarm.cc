@@ -16,67 +16,36 @@
 
 #include "os/alarm.h"
 
-#include <sys/timerfd.h>
-#include <cstring>
-#include <unistd.h>
-
 #include "common/bind.h"
-#include "os/log.h"
-#include "os/utils.h"
-
-#ifdef OS_ANDROID
-#define ALARM_CLOCK CLOCK_BOOTTIME_ALARM
-#else
-#define ALARM_CLOCK CLOCK_BOOTTIME
-#endif
 
 namespace bluetooth {
 namespace os {
 
-Alarm::Alarm(Handler* handler) : handler_(handler), fd_(timerfd_create(ALARM_CLOCK, 0)) {
-  ASSERT_LOG(fd_ != -1, "cannot create timerfd: %s", strerror(errno));
-
-  token_ = handler_->thread_->GetReactor()->Register(fd_, common::Bind(&Alarm::on_fire, common::Unretained(this)),
-                                                     Closure());
-}
+Alarm::Alarm(Handler* handler)
+    : handler_(handler),
+      timers_(handler_->thread_->GetTimerMultiplexer()),
+      timer_(common::Bind(&Alarm::on_fire, common::Unretained(this))) {}
 
 Alarm::~Alarm() {
-  handler_->thread_->GetReactor()->Unregister(token_);
-
-  int close_status;
-  RUN_NO_INTR(close_status = close(fd_));
-  ASSERT(close_status != -1);
+  timers_->Disarm(&timer_);
 }
 
-void Alarm::Schedule(OnceClosure task, std::chrono::milliseconds delay) {
+void Alarm::Schedule(common::InlineOnceClosure task, std::chrono::milliseconds delay) {
   std::lock_guard<std::mutex> lock(mutex_);
-  long delay_ms = delay.count();
-  itimerspec timer_itimerspec{
-    {/* interval for periodic timer */},
-    {delay_ms / 1000, delay_ms % 1000 * 1000000}
-  };
-  int result = timerfd_settime(fd_, 0, &timer_itimerspec, nullptr);
-  ASSERT(result == 0);
-
   task_ = std::move(task);
+  timers_->Arm(&timer_, delay.count(), 0);
 }
 
 void Alarm::Cancel() {
   std::lock_guard<std::mutex> lock(mutex_);
-  itimerspec disarm_itimerspec{/* disarm timer */};
-  int result = timerfd_settime(fd_, 0, &disarm_itimerspec, nullptr);
-  ASSERT(result == 0);
+  timers_->Disarm(&timer_);
 }
 
 void Alarm::on_fire() {
   std::unique_lock<std::mutex> lock(mutex_);
   auto task = std::move(task_);
-  uint64_t times_invoked;
-  auto bytes_read = read(fd_, &times_invoked, sizeof(uint64_t));
   lock.unlock();
   std::move(task).Run();
-  ASSERT(bytes_read == static_cast<ssize_t>(sizeof(uint64_t)));
-  ASSERT(times_invoked == static_cast<uint64_t>(1));
 }
 
 }  // namespace os
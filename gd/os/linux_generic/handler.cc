@@ -32,9 +32,15 @@
 
 namespace bluetooth {
 namespace os {
+namespace {
+
+// Tasks run per wakeup of the reactor, so that a busy handler doesn't starve the other reactables of its thread
+constexpr size_t kMaxTasksPerWakeup = 32;
+
+}  // namespace
 
 Handler::Handler(Thread* thread)
-    : tasks_(new std::queue<OnceClosure>()), thread_(thread), fd_(eventfd(0, EFD_SEMAPHORE | EFD_NONBLOCK)) {
+    : pending_tasks_(0), state_(std::make_shared<State>()), thread_(thread), fd_(eventfd(0, EFD_SEMAPHORE | EFD_NONBLOCK)) {
   ASSERT(fd_ != -1);
   reactable_ = thread_->GetReactor()->Register(fd_, common::Bind(&Handler::handle_next_event, common::Unretained(this)),
                                                common::Closure());
@@ -42,7 +48,7 @@ Handler::Handler(Thread* thread)
 
 Handler::~Handler() {
   {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::lock_guard<std::mutex> lock(state_->mutex);
     ASSERT_LOG(was_cleared(), "Handlers must be cleared before they are destroyed");
   }
 
@@ -51,27 +57,30 @@ Handler::~Handler() {
   ASSERT(close_status != -1);
 }
 
-void Handler::Post(OnceClosure closure) {
-  {
-    std::lock_guard<std::mutex> lock(mutex_);
-    if (was_cleared()) {
-      return;
-    }
-    tasks_->emplace(std::move(closure));
+void Handler::Post(common::InlineOnceClosure closure) {
+  if (was_cleared()) {
+    return;
+  }
+  // A task posted while Clear() runs is released when the handler is destroyed
+  tasks_.Push(std::move(closure));
+
+  // The eventfd is already signaled if there were pending tasks
+  if (pending_tasks_.fetch_add(1, std::memory_order_acq_rel) == 0) {
+    uint64_t val = 1;
+    auto write_result = eventfd_write(fd_, val);
+    ASSERT(write_result != -1);
   }
-  uint64_t val = 1;
-  auto write_result = eventfd_write(fd_, val);
-  ASSERT(write_result != -1);
 }
 
 void Handler::Clear() {
-  std::queue<OnceClosure>* tmp = nullptr;
   {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::lock_guard<std::mutex> lock(state_->mutex);
     ASSERT_LOG(!was_cleared(), "Handlers must only be cleared once");
-    std::swap(tasks_, tmp);
+    state_->cleared.store(true, std::memory_order_release);
+    common::InlineOnceClosure closure;
+    while (tasks_.TryPop(&closure)) {
+    }
   }
-  delete tmp;
 
   uint64_t val;
   while (eventfd_read(fd_, &val) == 0) {
@@ -87,21 +96,42 @@ void Handler::WaitUntilStopped(std::chrono::milliseconds timeout) {
 }
 
 void Handler::handle_next_event() {
-  common::OnceClosure closure;
-  {
-    std::lock_guard<std::mutex> lock(mutex_);
-    uint64_t val = 0;
-    auto read_result = eventfd_read(fd_, &val);
-
-    if (was_cleared()) {
-      return;
+  // Outlives the handler if it is destroyed while a task runs, after which the batch must not touch the handler
+  std::shared_ptr<State> state = state_;
+  uint64_t val = 0;
+  auto read_result = eventfd_read(fd_, &val);
+  if (was_cleared()) {
+    return;
+  }
+  ASSERT_LOG(read_result != -1, "eventfd read error %d %s", errno, strerror(errno));
+
+  size_t executed = 0;
+  while (executed < kMaxTasksPerWakeup) {
+    common::InlineOnceClosure closure;
+    {
+      std::lock_guard<std::mutex> lock(state->mutex);
+      // A task, or another thread, may have cleared the handler
+      if (state->cleared.load(std::memory_order_acquire)) {
+        return;
+      }
+      // Stops early if a producer hasn't linked its task yet, it is run on the next wakeup
+      if (!tasks_.TryPop(&closure)) {
+        break;
+      }
     }
-    ASSERT_LOG(read_result != -1, "eventfd read error %d %s", errno, strerror(errno));
+    executed++;
+    std::move(closure).Run();
+  }
 
-    closure = std::move(tasks_->front());
-    tasks_->pop();
+  std::lock_guard<std::mutex> lock(state->mutex);
+  if (state->cleared.load(std::memory_order_acquire)) {
+    return;
+  }
+  // Tasks are left, either posted while this batch ran or beyond its budget: wake up again
+  if (pending_tasks_.fetch_sub(executed, std::memory_order_acq_rel) != executed) {
+    auto write_result = eventfd_write(fd_, 1);
+    ASSERT(write_result != -1);
   }
-  std::move(closure).Run();
 }
 
 }  // namespace os
@@ -19,6 +19,7 @@
 #include <sys/eventfd.h>
 #include <future>
 #include <thread>
+#include <vector>
 
 #include "common/bind.h"
 #include "common/callback.h"
@@ -84,6 +85,46 @@ TEST_F(HandlerTest, post_task_cleared) {
   ASSERT_EQ(val, 1);
 }
 
+TEST_F(HandlerTest, post_tasks_from_multiple_threads) {
+  constexpr int kNumThreads = 4;
+  constexpr int kTasksPerThread = 1000;
+  int last_task[kNumThreads];
+  int num_tasks = 0;
+  bool in_order = true;
+  std::promise<void> all_tasks_ran;
+  auto future = all_tasks_ran.get_future();
+  for (int i = 0; i < kNumThreads; i++) {
+    last_task[i] = -1;
+  }
+
+  std::vector<std::thread> producers;
+  for (int i = 0; i < kNumThreads; i++) {
+    producers.emplace_back([&, i]() {
+      for (int task = 0; task < kTasksPerThread; task++) {
+        handler_->Post(common::BindOnce(
+            [](int* last_task, int task, int* num_tasks, bool* in_order, std::promise<void>* all_tasks_ran) {
+              // Tasks posted by the same thread run in order
+              if (*last_task != task - 1) {
+                *in_order = false;
+              }
+              *last_task = task;
+              if (++*num_tasks == kNumThreads * kTasksPerThread) {
+                all_tasks_ran->set_value();
+              }
+            },
+            common::Unretained(&last_task[i]), task, common::Unretained(&num_tasks), common::Unretained(&in_order),
+            common::Unretained(&all_tasks_ran)));
+      }
+    });
+  }
+  for (auto& producer : producers) {
+    producer.join();
+  }
+  future.wait();
+  ASSERT_TRUE(in_order);
+  handler_->Clear();
+}
+
 void check_int(std::unique_ptr<int> number, std::shared_ptr<int> to_change) {
   *to_change = *number;
 }
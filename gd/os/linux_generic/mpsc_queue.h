@@ -0,0 +1,81 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <utility>
+
+#include "os/utils.h"
+
+namespace bluetooth {
+namespace os {
+
+// An unbounded lock-free queue with multiple producers and a single consumer. Every item lives in a node that links to
+// the next one, so Push() only takes one atomic exchange and never waits for other producers or for the consumer.
+// The queue always holds one node whose item was already popped (or is empty), so that the consumer never touches
+// the nodes producers are linking.
+template <typename T>
+class MpscQueue {
+ public:
+  MpscQueue() : head_(new Node()), tail_(head_) {}
+
+  ~MpscQueue() {
+    T item;
+    while (TryPop(&item)) {
+    }
+    delete head_;
+  }
+
+  DISALLOW_COPY_AND_ASSIGN(MpscQueue);
+
+  // Can be called from any thread
+  void Push(T item) {
+    Node* node = new Node(std::move(item));
+    Node* prev = tail_.exchange(node, std::memory_order_acq_rel);
+    // Until this store, the consumer sees the queue end at |prev|
+    prev->next.store(node, std::memory_order_release);
+  }
+
+  // Must only be called by one thread at a time. Returns false if the queue is empty, or if the next item is still
+  // being linked by Push().
+  bool TryPop(T* item) {
+    Node* next = head_->next.load(std::memory_order_acquire);
+    if (next == nullptr) {
+      return false;
+    }
+    *item = std::move(next->item);
+    delete head_;
+    head_ = next;
+    return true;
+  }
+
+ private:
+  struct Node {
+    Node() = default;
+    explicit Node(T item) : item(std::move(item)) {}
+
+    std::atomic<Node*> next{nullptr};
+    T item;
+  };
+
+  // Only accessed by the consumer
+  Node* head_;
+  std::atomic<Node*> tail_;
+};
+
+}  // namespace os
+}  // namespace bluetooth
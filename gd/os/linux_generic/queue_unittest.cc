@@ -721,6 +721,38 @@ TEST_F(QueueTest, pass_smart_pointer_and_unregister) {
   future.wait();
 }
 
+TEST_F(QueueTest, try_dequeue_batch) {
+  Queue<std::string> queue(kQueueSize);
+  int enqueued = 0;
+  std::promise<void> promise;
+  auto future = promise.get_future();
+  // Fill the queue, and tell once the last item is in it
+  queue.RegisterEnqueue(enqueue_handler_, common::Bind(
+                                              [](Queue<std::string>* queue, Handler* handler, int* enqueued,
+                                                 std::promise<void>* promise) {
+                                                if (++*enqueued == kQueueSize) {
+                                                  queue->UnregisterEnqueue();
+                                                  handler->Post(common::BindOnce(&std::promise<void>::set_value,
+                                                                                 common::Unretained(promise)));
+                                                }
+                                                return std::make_unique<std::string>(std::to_string(*enqueued - 1));
+                                              },
+                                              common::Unretained(&queue), common::Unretained(enqueue_handler_),
+                                              common::Unretained(&enqueued), common::Unretained(&promise)));
+  future.wait();
+
+  auto batch = queue.TryDequeueBatch(kHalfOfQueueSize);
+  ASSERT_EQ(batch.size(), static_cast<size_t>(kHalfOfQueueSize));
+  for (int i = 0; i < kHalfOfQueueSize; i++) {
+    EXPECT_EQ(*batch[i], std::to_string(i));
+  }
+  batch = queue.TryDequeueBatch(kDoubleOfQueueSize);
+  ASSERT_EQ(batch.size(), static_cast<size_t>(kQueueSize - kHalfOfQueueSize));
+  EXPECT_EQ(*batch.front(), std::to_string(kHalfOfQueueSize));
+  EXPECT_TRUE(queue.TryDequeueBatch(kQueueSize).empty());
+  EXPECT_EQ(queue.TryDequeue(), nullptr);
+}
+
 // Create all threads for death tests in the function that dies
 class QueueDeathTest : public ::testing::Test {
  public:
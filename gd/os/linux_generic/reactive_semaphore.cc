@@ -43,8 +43,8 @@ void ReactiveSemaphore::Decrease() {
   ASSERT_LOG(read_result != -1, "decrease failed: %s", strerror(errno));
 }
 
-void ReactiveSemaphore::Increase() {
-  uint64_t val = 1;
+void ReactiveSemaphore::Increase(unsigned int count) {
+  uint64_t val = count;
   auto write_result = eventfd_write(fd_, val);
   ASSERT_LOG(write_result != -1, "increase failed: %s", strerror(errno));
 }
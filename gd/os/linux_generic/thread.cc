@@ -22,6 +22,7 @@
 #include <cerrno>
 #include <cstring>
 
+#include "os/linux_generic/timer_multiplexer.h"
 #include "os/log.h"
 
 namespace bluetooth {
@@ -29,6 +30,11 @@ namespace os {
 
 namespace {
 constexpr int kRealTimeFifoSchedulingPriority = 1;
+Thread::SchedulingHook scheduling_hook = nullptr;
+}  // namespace
+
+void Thread::SetSchedulingHook(SchedulingHook hook) {
+  scheduling_hook = hook;
 }
 
 Thread::Thread(const std::string& name, const Priority priority)
@@ -37,9 +43,11 @@ Thread::Thread(const std::string& name, const Priority priority)
       running_thread_(&Thread::run, this, priority) {}
 
 void Thread::run(Priority priority) {
-  if (priority == Priority::REAL_TIME) {
+  auto linux_tid = static_cast<pid_t>(syscall(SYS_gettid));
+  // A configured profile, applied by the hook, replaces the default scheduling of the priority
+  bool scheduled = scheduling_hook != nullptr && scheduling_hook(name_, linux_tid);
+  if (!scheduled && priority == Priority::REAL_TIME) {
     struct sched_param rt_params = {.sched_priority = kRealTimeFifoSchedulingPriority};
-    auto linux_tid = static_cast<pid_t>(syscall(SYS_gettid));
     int rc;
     RUN_NO_INTR(rc = sched_setscheduler(linux_tid, SCHED_FIFO, &rt_params));
     if (rc != 0) {
@@ -73,6 +81,14 @@ Reactor* Thread::GetReactor() const {
   return &reactor_;
 }
 
+TimerMultiplexer* Thread::GetTimerMultiplexer() {
+  std::lock_guard<std::mutex> lock(timer_multiplexer_mutex_);
+  if (timer_multiplexer_ == nullptr) {
+    timer_multiplexer_ = std::make_unique<TimerMultiplexer>(&reactor_);
+  }
+  return timer_multiplexer_.get();
+}
+
 std::string Thread::GetThreadName() const {
   return name_;
 }
@@ -17,6 +17,8 @@
 #include "os/thread.h"
 
 #include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 
 #include "common/bind.h"
 #include "gtest/gtest.h"
@@ -95,6 +97,27 @@ TEST_F(ThreadTest, same_thread) {
   reactor->Unregister(reactable);
 }
 
+std::string hooked_thread_name;
+pid_t hooked_linux_tid = -1;
+
+bool TestSchedulingHook(const std::string& name, pid_t linux_tid) {
+  hooked_thread_name = name;
+  hooked_linux_tid = linux_tid;
+  return true;
+}
+
+TEST(ThreadSchedulingHookTest, hook_runs_on_new_thread) {
+  Thread::SetSchedulingHook(TestSchedulingHook);
+  Thread* thread = new Thread("hooked", Thread::Priority::REAL_TIME);
+  // The thread is stopped after it ran the hook
+  thread->Stop();
+  Thread::SetSchedulingHook(nullptr);
+  delete thread;
+  EXPECT_EQ(hooked_thread_name, "hooked");
+  EXPECT_NE(hooked_linux_tid, -1);
+  EXPECT_NE(hooked_linux_tid, static_cast<pid_t>(syscall(SYS_gettid)));
+}
+
 }  // namespace
 }  // namespace os
 }  // namespace bluetooth
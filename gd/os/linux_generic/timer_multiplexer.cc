@@ -0,0 +1,214 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "os/linux_generic/timer_multiplexer.h"
+
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+#include "common/bind.h"
+#include "os/fake_timer/fake_timerfd.h"
+#include "os/log.h"
+
+#ifdef OS_ANDROID
+#define ALARM_CLOCK CLOCK_BOOTTIME_ALARM
+#else
+#define ALARM_CLOCK CLOCK_BOOTTIME
+#endif
+
+namespace bluetooth {
+namespace os {
+
+namespace {
+constexpr uint64_t kNanosecondsPerMillisecond = 1000000;
+constexpr uint64_t kNanosecondsPerSecond = 1000000000;
+}  // namespace
+
+TimerMultiplexer::TimerMultiplexer(Reactor* reactor)
+    : reactor_(reactor), fd_(fake_timer::alarm_timerfd_create(ALARM_CLOCK, TFD_NONBLOCK)) {
+  ASSERT_LOG(fd_ != -1, "cannot create timerfd: %s", strerror(errno));
+  fake_ = fake_timer::is_fake_timerfd(fd_);
+  token_ = reactor_->Register(fd_, common::Bind(&TimerMultiplexer::on_fire, common::Unretained(this)), Closure());
+}
+
+TimerMultiplexer::~TimerMultiplexer() {
+  ASSERT_LOG(heap_.empty(), "%zu timers are still armed", heap_.size());
+  reactor_->Unregister(token_);
+  int close_status = fake_timer::alarm_timerfd_close(fd_);
+  ASSERT(close_status != -1);
+}
+
+void TimerMultiplexer::Arm(Entry* entry, uint64_t delay_ms, uint64_t period_ms) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (entry->heap_index_ != Entry::kNotArmed) {
+    remove(entry);
+  }
+  entry->deadline_ns_ = now_ns() + delay_ms * kNanosecondsPerMillisecond;
+  entry->period_ns_ = period_ms * kNanosecondsPerMillisecond;
+  entry->sequence_ = next_sequence_++;
+  push(entry);
+  update_timerfd();
+}
+
+void TimerMultiplexer::Disarm(Entry* entry) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (entry->heap_index_ == Entry::kNotArmed) {
+    return;
+  }
+  remove(entry);
+  update_timerfd();
+}
+
+size_t TimerMultiplexer::GetArmedCount() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return heap_.size();
+}
+
+uint64_t TimerMultiplexer::now_ns() const {
+  if (fake_) {
+    return fake_timer::fake_timerfd_get_clock() * kNanosecondsPerMillisecond;
+  }
+  struct timespec now;
+  clock_gettime(CLOCK_BOOTTIME, &now);
+  return now.tv_sec * kNanosecondsPerSecond + now.tv_nsec;
+}
+
+bool TimerMultiplexer::comes_before(const Entry* a, const Entry* b) const {
+  if (a->deadline_ns_ != b->deadline_ns_) {
+    return a->deadline_ns_ < b->deadline_ns_;
+  }
+  return a->sequence_ < b->sequence_;
+}
+
+void TimerMultiplexer::swap_entries(size_t a, size_t b) {
+  std::swap(heap_[a], heap_[b]);
+  heap_[a]->heap_index_ = a;
+  heap_[b]->heap_index_ = b;
+}
+
+void TimerMultiplexer::sift_up(size_t index) {
+  while (index > 0) {
+    size_t parent = (index - 1) / 2;
+    if (!comes_before(heap_[index], heap_[parent])) {
+      return;
+    }
+    swap_entries(index, parent);
+    index = parent;
+  }
+}
+
+void TimerMultiplexer::sift_down(size_t index) {
+  while (true) {
+    size_t first = index;
+    size_t left = 2 * index + 1;
+    size_t right = left + 1;
+    if (left < heap_.size() && comes_before(heap_[left], heap_[first])) {
+      first = left;
+    }
+    if (right < heap_.size() && comes_before(heap_[right], heap_[first])) {
+      first = right;
+    }
+    if (first == index) {
+      return;
+    }
+    swap_entries(index, first);
+    index = first;
+  }
+}
+
+void TimerMultiplexer::push(Entry* entry) {
+  entry->heap_index_ = heap_.size();
+  heap_.push_back(entry);
+  sift_up(entry->heap_index_);
+}
+
+void TimerMultiplexer::remove(Entry* entry) {
+  size_t index = entry->heap_index_;
+  size_t last = heap_.size() - 1;
+  if (index != last) {
+    swap_entries(index, last);
+  }
+  heap_.pop_back();
+  entry->heap_index_ = Entry::kNotArmed;
+  if (index != last) {
+    // The entry moved into the hole may belong above or below it
+    Entry* moved = heap_[index];
+    sift_up(index);
+    sift_down(moved->heap_index_);
+  }
+}
+
+void TimerMultiplexer::update_timerfd() {
+  if (heap_.empty() ? !timerfd_armed_ : timerfd_armed_ && heap_[0]->deadline_ns_ == armed_deadline_ns_) {
+    return;
+  }
+  int result;
+  if (heap_.empty()) {
+    itimerspec disarm_itimerspec{/* disarm timer */};
+    result = fake_timer::alarm_timerfd_settime(fd_, 0, &disarm_itimerspec, nullptr);
+  } else {
+    // Absolute, so that the deadline doesn't drift with the time it took to get here. A deadline in the past expires
+    // right away.
+    itimerspec timer_itimerspec{
+        {/* interval for periodic timer */},
+        {static_cast<time_t>(heap_[0]->deadline_ns_ / kNanosecondsPerSecond),
+         static_cast<long>(heap_[0]->deadline_ns_ % kNanosecondsPerSecond)}};
+    result = fake_timer::alarm_timerfd_settime(fd_, TFD_TIMER_ABSTIME, &timer_itimerspec, nullptr);
+    armed_deadline_ns_ = heap_[0]->deadline_ns_;
+  }
+  ASSERT(result == 0);
+  timerfd_armed_ = !heap_.empty();
+}
+
+void TimerMultiplexer::on_fire() {
+  uint64_t times_invoked;
+  ssize_t bytes_read;
+  RUN_NO_INTR(bytes_read = read(fd_, &times_invoked, sizeof(uint64_t)));
+  // Re-arming from another thread since the timerfd became readable discards the expiration
+  ASSERT(bytes_read == static_cast<ssize_t>(sizeof(uint64_t)) || errno == EAGAIN);
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  timerfd_armed_ = false;
+  // Only what is due now: a periodic entry slower than its period must not keep the reactor from its other reactables
+  uint64_t now = now_ns();
+  while (!heap_.empty() && heap_[0]->deadline_ns_ <= now) {
+    Entry* entry = heap_[0];
+    remove(entry);
+    if (entry->period_ns_ != 0) {
+      uint64_t missed_periods = (now - entry->deadline_ns_) / entry->period_ns_;
+      entry->deadline_ns_ += (missed_periods + 1) * entry->period_ns_;
+      entry->sequence_ = next_sequence_++;
+      push(entry);
+    }
+    if (heap_.empty() || heap_[0]->deadline_ns_ > now) {
+      // Before the callback runs, so that no expiration is lost while it does
+      update_timerfd();
+    }
+    // A copy, as the callback may re-arm or destroy its entry
+    Closure on_fire = entry->on_fire_;
+    lock.unlock();
+    on_fire.Run();
+    lock.lock();
+  }
+  update_timerfd();
+}
+
+}  // namespace os
+}  // namespace bluetooth
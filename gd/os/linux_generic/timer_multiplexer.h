@@ -0,0 +1,99 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "common/callback.h"
+#include "os/reactor.h"
+#include "os/utils.h"
+
+namespace bluetooth {
+namespace os {
+
+// All the alarms of a thread on a single timerfd. The logical timers are kept in a min-heap on their deadlines, and the
+// timerfd is only re-armed when the earliest deadline changes, so that a thread with a thousand alarms still polls one
+// file descriptor, and scheduling an alarm that doesn't expire first costs no system call.
+class TimerMultiplexer {
+ public:
+  // A logical timer. It is owned by its user, and must be disarmed before it is destroyed.
+  class Entry {
+   public:
+    // |on_fire| runs on the thread of the reactor each time the entry expires
+    explicit Entry(Closure on_fire) : on_fire_(std::move(on_fire)) {}
+
+    DISALLOW_COPY_AND_ASSIGN(Entry);
+
+   private:
+    friend class TimerMultiplexer;
+    static constexpr size_t kNotArmed = SIZE_MAX;
+
+    Closure on_fire_;
+    uint64_t deadline_ns_ = 0;
+    uint64_t period_ns_ = 0;
+    // Entries with the same deadline expire in the order they were armed
+    uint64_t sequence_ = 0;
+    size_t heap_index_ = kNotArmed;
+  };
+
+  // Creates the timerfd and registers it on |reactor|. The timerfd is a fake timer if fake timers are enabled now.
+  explicit TimerMultiplexer(Reactor* reactor);
+
+  // Unregisters the timerfd and closes it. All the entries must be disarmed, and the reactor stopped or running this.
+  ~TimerMultiplexer();
+
+  DISALLOW_COPY_AND_ASSIGN(TimerMultiplexer);
+
+  // Arms |entry| to expire after |delay_ms|, then every |period_ms| if it's not 0. Re-arming an armed entry replaces
+  // its deadline. A periodic entry that falls behind skips the periods it missed rather than expiring in a burst.
+  void Arm(Entry* entry, uint64_t delay_ms, uint64_t period_ms);
+
+  // Disarms |entry|. No-op if it's not armed.
+  void Disarm(Entry* entry);
+
+  // Returns the number of armed entries
+  size_t GetArmedCount() const;
+
+ private:
+  uint64_t now_ns() const;
+  void push(Entry* entry);
+  void remove(Entry* entry);
+  void sift_up(size_t index);
+  void sift_down(size_t index);
+  void swap_entries(size_t a, size_t b);
+  bool comes_before(const Entry* a, const Entry* b) const;
+  // Arms the timerfd for the earliest deadline, if it isn't already. Must be called with the lock held
+  void update_timerfd();
+  void on_fire();
+
+  Reactor* reactor_;
+  int fd_;
+  bool fake_;
+  Reactor::Reactable* token_;
+  mutable std::mutex mutex_;
+  std::vector<Entry*> heap_;
+  uint64_t next_sequence_ = 0;
+  bool timerfd_armed_ = false;
+  uint64_t armed_deadline_ns_ = 0;
+};
+
+}  // namespace os
+}  // namespace bluetooth
@@ -0,0 +1,163 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "os/linux_generic/timer_multiplexer.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "common/bind.h"
+#include "gtest/gtest.h"
+#include "os/fake_timer/fake_timerfd.h"
+#include "os/thread.h"
+
+namespace bluetooth {
+namespace os {
+namespace {
+
+using fake_timer::fake_timerfd_advance;
+using fake_timer::fake_timerfd_get_clock;
+
+// Records which entry fired, and when on the virtual clock
+class FireRecorder {
+ public:
+  void on_fire(int id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    fired_.push_back(id);
+    times_.push_back(fake_timerfd_get_clock());
+    cv_.notify_all();
+  }
+
+  std::vector<int> wait_for_fired(size_t count) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait_for(lock, std::chrono::seconds(1), [this, count]() { return fired_.size() >= count; });
+    return fired_;
+  }
+
+  std::vector<uint64_t> times() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return times_;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::vector<int> fired_;
+  std::vector<uint64_t> times_;
+};
+
+class TimerMultiplexerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    fake_timer::set_fake_timers_enabled(true);
+    thread_ = std::make_unique<Thread>("test_thread", Thread::Priority::NORMAL);
+    timers_ = std::make_unique<TimerMultiplexer>(thread_->GetReactor());
+  }
+
+  void TearDown() override {
+    thread_->Stop();
+    for (auto& entry : entries_) {
+      timers_->Disarm(entry.get());
+    }
+    timers_ = nullptr;
+    thread_ = nullptr;
+    fake_timer::set_fake_timers_enabled(false);
+    fake_timer::fake_timerfd_reset();
+  }
+
+  TimerMultiplexer::Entry* NewEntry(int id) {
+    entries_.push_back(std::make_unique<TimerMultiplexer::Entry>(
+        common::Bind(&FireRecorder::on_fire, common::Unretained(&recorder_), id)));
+    return entries_.back().get();
+  }
+
+  FireRecorder recorder_;
+  std::unique_ptr<Thread> thread_;
+  std::unique_ptr<TimerMultiplexer> timers_;
+  std::vector<std::unique_ptr<TimerMultiplexer::Entry>> entries_;
+};
+
+TEST_F(TimerMultiplexerTest, fire_in_deadline_order) {
+  timers_->Arm(NewEntry(3), 30, 0);
+  timers_->Arm(NewEntry(1), 10, 0);
+  timers_->Arm(NewEntry(2), 20, 0);
+  // Same deadline as the first one, armed later
+  timers_->Arm(NewEntry(4), 10, 0);
+  EXPECT_EQ(timers_->GetArmedCount(), 4u);
+
+  fake_timerfd_advance(30);
+  EXPECT_EQ(recorder_.wait_for_fired(4), std::vector<int>({1, 4, 2, 3}));
+  EXPECT_EQ(timers_->GetArmedCount(), 0u);
+}
+
+TEST_F(TimerMultiplexerTest, disarm_and_rearm) {
+  auto first = NewEntry(1);
+  auto second = NewEntry(2);
+  timers_->Arm(first, 10, 0);
+  timers_->Arm(second, 20, 0);
+  timers_->Disarm(first);
+  timers_->Disarm(first);
+  // Re-arming replaces the deadline
+  timers_->Arm(second, 50, 0);
+  EXPECT_EQ(timers_->GetArmedCount(), 1u);
+
+  fake_timerfd_advance(40);
+  EXPECT_EQ(recorder_.wait_for_fired(0), std::vector<int>());
+  // Earlier than the armed deadline
+  timers_->Arm(NewEntry(3), 5, 0);
+  fake_timerfd_advance(5);
+  EXPECT_EQ(recorder_.wait_for_fired(1), std::vector<int>({3}));
+  fake_timerfd_advance(5);
+  EXPECT_EQ(recorder_.wait_for_fired(2), std::vector<int>({3, 2}));
+}
+
+TEST_F(TimerMultiplexerTest, periodic_skips_the_missed_periods) {
+  timers_->Arm(NewEntry(1), 10, 10);
+  fake_timerfd_advance(35);
+  EXPECT_EQ(recorder_.wait_for_fired(1).size(), 1u);
+  fake_timerfd_advance(5);
+  EXPECT_EQ(recorder_.wait_for_fired(2).size(), 2u);
+  fake_timerfd_advance(10);
+  EXPECT_EQ(recorder_.wait_for_fired(3).size(), 3u);
+  EXPECT_EQ(recorder_.times(), std::vector<uint64_t>({35, 40, 50}));
+  EXPECT_EQ(timers_->GetArmedCount(), 1u);
+}
+
+TEST_F(TimerMultiplexerTest, many_entries) {
+  constexpr int kEntries = 1000;
+  std::vector<int> expected;
+  for (int id = kEntries - 1; id >= 0; id--) {
+    timers_->Arm(NewEntry(id), id + 1, 0);
+  }
+  for (int id = 0; id < kEntries; id++) {
+    expected.push_back(id);
+  }
+  // Disarming from the middle of the heap keeps the order of the others
+  for (int id = 1; id < kEntries; id += 100) {
+    timers_->Disarm(entries_[kEntries - 1 - id].get());
+    expected.erase(std::find(expected.begin(), expected.end(), id));
+  }
+  fake_timerfd_advance(kEntries);
+  EXPECT_EQ(recorder_.wait_for_fired(expected.size()), expected);
+}
+
+}  // namespace
+}  // namespace os
+}  // namespace bluetooth
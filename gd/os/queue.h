@@ -17,9 +17,11 @@
 #pragma once
 
 #include <unistd.h>
+#include <algorithm>
 #include <functional>
 #include <mutex>
 #include <queue>
+#include <vector>
 
 #include "common/bind.h"
 #include "common/callback.h"
@@ -51,6 +53,18 @@ class IQueueDequeue {
   virtual void RegisterDequeue(Handler* handler, DequeueCallback callback) = 0;
   virtual void UnregisterDequeue() = 0;
   virtual std::unique_ptr<T> TryDequeue() = 0;
+  // Dequeues up to |max_count| items at once, in order. Returns an empty vector when there is nothing to dequeue.
+  virtual std::vector<std::unique_ptr<T>> TryDequeueBatch(size_t max_count) {
+    std::vector<std::unique_ptr<T>> batch;
+    while (batch.size() < max_count) {
+      auto data = TryDequeue();
+      if (data == nullptr) {
+        break;
+      }
+      batch.push_back(std::move(data));
+    }
+    return batch;
+  }
 };
 
 template <typename T>
@@ -79,6 +93,10 @@ class Queue : public IQueueEnqueue<T>, public IQueueDequeue<T> {
   // Try to dequeue an item from this queue. Return nullptr when there is nothing in the queue.
   std::unique_ptr<T> TryDequeue() override;
 
+  // Try to dequeue up to |max_count| items from this queue, under a single lock. The enqueue end is woken up once for
+  // all of them rather than once per item.
+  std::vector<std::unique_ptr<T>> TryDequeueBatch(size_t max_count) override;
+
  private:
   void EnqueueCallbackInternal(EnqueueCallback callback);
   // An internal queue that holds at most |capacity| pieces of data
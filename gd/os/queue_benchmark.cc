@@ -38,6 +38,8 @@ class BM_QueuePerformance : public ::benchmark::Fixture {
   }
 
   void TearDown(State& st) override {
+    enqueue_handler_->Clear();
+    dequeue_handler_->Clear();
     delete enqueue_handler_;
     delete enqueue_thread_;
     delete dequeue_handler_;
@@ -203,5 +205,39 @@ BENCHMARK_REGISTER_F(BM_QueuePerformance, send_10000_packet_vary_by_packet_size)
     ->Iterations(100)
     ->UseRealTime();
 
+// Same as send_packet_vary_by_packet_num, with each end of the queue on its own thread
+BENCHMARK_DEFINE_F(BM_QueuePerformance, send_packet_across_threads_vary_by_packet_num)(State& state) {
+  for (auto _ : state) {
+    int64_t num_data_to_send_ = state.range(0);
+    Queue<std::string> queue(num_data_to_send_);
+
+    // register dequeue
+    std::promise<void> dequeue_promise;
+    auto dequeue_future = dequeue_promise.get_future();
+    TestDequeueEnd test_dequeue_end(num_data_to_send_, &queue, dequeue_handler_, &dequeue_promise);
+    test_dequeue_end.RegisterDequeue();
+
+    // Push data to enqueue end buffer and register enqueue
+    std::promise<void> enqueue_promise;
+    TestEnqueueEnd test_enqueue_end(num_data_to_send_, &queue, enqueue_handler_, &enqueue_promise);
+    for (int i = 0; i < num_data_to_send_; i++) {
+      std::string data = std::to_string(1);
+      test_enqueue_end.push(std::move(data));
+    }
+    dequeue_future.wait();
+  }
+
+  state.SetBytesProcessed(static_cast<int_fast64_t>(state.iterations()) * state.range(0));
+};
+
+BENCHMARK_REGISTER_F(BM_QueuePerformance, send_packet_across_threads_vary_by_packet_num)
+    ->Arg(10)
+    ->Arg(100)
+    ->Arg(1000)
+    ->Arg(10000)
+    ->Arg(100000)
+    ->Iterations(100)
+    ->UseRealTime();
+
 }  // namespace os
 }  // namespace bluetooth
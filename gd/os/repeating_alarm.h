@@ -22,21 +22,21 @@
 
 #include "common/callback.h"
 #include "os/handler.h"
+#include "os/linux_generic/timer_multiplexer.h"
 #include "os/thread.h"
 #include "os/utils.h"
 
 namespace bluetooth {
 namespace os {
 
-// A repeating alarm for reactor-based thread, implemented by Linux timerfd.
-// When it's constructed, it will register a reactable on the specified thread; when it's destroyed, it will unregister
-// itself from the thread.
+// A repeating alarm for reactor-based thread, implemented as an entry of the thread's TimerMultiplexer,
+// so that all the alarms of a thread share a single timerfd. When it's destroyed, it disarms itself.
 class RepeatingAlarm {
  public:
-  // Create and register a repeating alarm on a given handler
+  // Create a repeating alarm on a given handler
   explicit RepeatingAlarm(Handler* handler);
 
-  // Unregister this alarm from the thread and release resource
+  // Disarm this alarm
   ~RepeatingAlarm();
 
   DISALLOW_COPY_AND_ASSIGN(RepeatingAlarm);
@@ -50,8 +50,8 @@ class RepeatingAlarm {
  private:
   Closure task_;
   Handler* handler_;
-  int fd_ = 0;
-  Reactor::Reactable* token_;
+  TimerMultiplexer* timers_;
+  TimerMultiplexer::Entry timer_;
   mutable std::mutex mutex_;
   void on_fire();
 };
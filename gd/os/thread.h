@@ -16,6 +16,9 @@
 
 #pragma once
 
+#include <sys/types.h>
+
+#include <memory>
 #include <mutex>
 #include <string>
 #include <thread>
@@ -26,6 +29,8 @@
 namespace bluetooth {
 namespace os {
 
+class TimerMultiplexer;
+
 // Reactor-based looper thread implementation. The thread runs immediately after it is constructed, and stops after
 // Stop() is invoked. To assign task to this thread, user needs to register a reactable object to the underlying
 // reactor.
@@ -63,11 +68,24 @@ class Thread {
   // Return the pointer of underlying reactor. The ownership is NOT transferred.
   Reactor* GetReactor() const;
 
+  // Return the timer multiplexer running the alarms of this thread, created with the first alarm. The ownership is NOT
+  // transferred.
+  TimerMultiplexer* GetTimerMultiplexer();
+
+  // Called by each new thread with its name and Linux thread id before it runs its reactor. When the hook returns
+  // true it has set the scheduling of the thread, and the thread skips the default one of its priority. Set it before
+  // creating threads.
+  using SchedulingHook = bool (*)(const std::string& name, pid_t linux_tid);
+  static void SetSchedulingHook(SchedulingHook hook);
+
  private:
   void run(Priority priority);
   mutable std::mutex mutex_;
   const std::string name_;
   mutable Reactor reactor_;
+  std::mutex timer_multiplexer_mutex_;
+  // Destroyed before the reactor it is registered on
+  std::unique_ptr<TimerMultiplexer> timer_multiplexer_;
   std::thread running_thread_;
 };
 
@@ -17,6 +17,7 @@
 #include <future>
 #include <memory>
 #include <thread>
+#include <vector>
 
 #include "benchmark/benchmark.h"
 
@@ -65,6 +66,7 @@ class BM_ReactorThread : public BM_ThreadPerformance {
     handler_ = std::make_unique<Handler>(thread_.get());
   }
   void TearDown(State& st) override {
+    handler_->Clear();
     handler_ = nullptr;
     thread_->Stop();
     thread_ = nullptr;
@@ -96,6 +98,39 @@ BENCHMARK_REGISTER_F(BM_ReactorThread, batch_enque_dequeue)
     ->Iterations(1)
     ->UseRealTime();
 
+// Several threads posting to the same handler at once, range(0) messages in total over range(1) threads
+BENCHMARK_DEFINE_F(BM_ReactorThread, batch_enque_dequeue_multiple_producers)(State& state) {
+  for (auto _ : state) {
+    num_messages_to_send_ = state.range(0);
+    int64_t num_producers = state.range(1);
+    counter_ = 0;
+    counter_promise_ = std::promise<void>();
+    std::future<void> counter_future = counter_promise_.get_future();
+    std::vector<std::thread> producers;
+    for (int64_t p = 0; p < num_producers; p++) {
+      producers.emplace_back([this, num_producers]() {
+        for (int i = 0; i < num_messages_to_send_ / num_producers; i++) {
+          handler_->Post(BindOnce(&BM_ReactorThread_batch_enque_dequeue_multiple_producers_Benchmark::callback_batch,
+                                  bluetooth::common::Unretained(this)));
+        }
+      });
+    }
+    for (auto& producer : producers) {
+      producer.join();
+    }
+    counter_future.wait();
+  }
+};
+
+BENCHMARK_REGISTER_F(BM_ReactorThread, batch_enque_dequeue_multiple_producers)
+    ->Args({10000, 1})
+    ->Args({10000, 2})
+    ->Args({10000, 4})
+    ->Args({100000, 4})
+    ->Args({100000, 8})
+    ->Iterations(1)
+    ->UseRealTime();
+
 BENCHMARK_DEFINE_F(BM_ReactorThread, sequential_execution)(State& state) {
   for (auto _ : state) {
     num_messages_to_send_ = state.range(0);
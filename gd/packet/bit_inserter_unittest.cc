@@ -78,5 +78,24 @@ TEST(BitInserterTest, observerTest) {
   ASSERT_EQ(result.size(), copy.size());
 }
 
+TEST(BitInserterTest, insertBytes) {
+  std::vector<uint8_t> bytes;
+  BitInserter it(bytes);
+  std::vector<uint8_t> copy;
+  it.RegisterObserver(ByteObserver([&copy](uint8_t byte) { copy.push_back(byte); }, []() { return 0; }));
+
+  const uint8_t payload[] = {0x01, 0x23, 0x45};
+  it.insert_bytes(payload, sizeof(payload));
+  // With pending bits, the bytes are shifted in after them
+  it.insert_bits(0b1, 1);
+  it.insert_bytes(payload, 2);
+  it.insert_bits(0b0101010, 7);
+  std::vector<uint8_t> result = {0x01, 0x23, 0x45, 0x03, 0x46, 0b01010100};
+
+  ASSERT_EQ(result, bytes);
+  ASSERT_EQ(result, copy);
+  it.UnregisterObserver();
+}
+
 }  // namespace packet
 }  // namespace bluetooth
@@ -81,6 +81,11 @@ class EndianInserter {
   void insert_vector(const std::vector<FixedWidthIntegerType>& vec, BitInserter& it) const {
     static_assert(std::is_pod<FixedWidthIntegerType>::value,
                   "EndianInserter::insert requires a vector with elements of a fixed-size.");
+    // Little-endian elements, and bytes, are inserted in the order they are in memory
+    if constexpr (little_endian || sizeof(FixedWidthIntegerType) == 1) {
+      it.insert_bytes(reinterpret_cast<const uint8_t*>(vec.data()), vec.size() * sizeof(FixedWidthIntegerType));
+      return;
+    }
     for (const auto& element : vec) {
       insert(element, it);
     }
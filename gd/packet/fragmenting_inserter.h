@@ -33,6 +33,9 @@ class FragmentingInserter : public BitInserter {
 
   void insert_bits(uint8_t byte, size_t num_bits) override;
 
+  // The bytes go to the fragments, a byte at a time
+  void insert_bytes(const uint8_t* bytes, size_t length) override;
+
   void finalize();
 
  protected:
@@ -171,5 +171,24 @@ TEST_P(FragmentingTest, mtuFragmentTest) {
 
 INSTANTIATE_TEST_CASE_P(chopomatic, FragmentingTest, ::testing::Range<size_t>(1, kPacketSize + 1));
 
+TEST(FragmentingInserterTest, insertBytes) {
+  std::vector<uint8_t> payload = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+  std::vector<std::unique_ptr<RawBuilder>> fragments;
+
+  FragmentingInserter it(4, std::back_insert_iterator(fragments));
+  it.insert_bytes(payload.data(), payload.size());
+  it.finalize();
+
+  ASSERT_EQ(3, fragments.size());
+  std::vector<uint8_t> bytes;
+  BitInserter bit_inserter(bytes);
+  for (const auto& fragment : fragments) {
+    fragment->Serialize(bit_inserter);
+  }
+  ASSERT_EQ(payload, bytes);
+  ASSERT_EQ(4, fragments[0]->size());
+  ASSERT_EQ(2, fragments[2]->size());
+}
+
 }  // namespace packet
 }  // namespace bluetooth
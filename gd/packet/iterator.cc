@@ -23,13 +23,23 @@ namespace packet {
 
 template <bool little_endian>
 Iterator<little_endian>::Iterator(std::forward_list<View> data, size_t offset) {
-  data_ = data;
+  data_ = std::make_shared<const std::forward_list<View>>(std::move(data));
+  contiguous_ = nullptr;
   index_ = offset;
   begin_ = 0;
   end_ = 0;
-  for (auto& view : data) {
+  size_t fragments = 0;
+  for (const auto& view : *data_) {
+    if (view.size() == 0) {
+      continue;
+    }
+    fragments++;
+    contiguous_ = view.data();
     end_ += view.size();
   }
+  if (fragments > 1) {
+    contiguous_ = nullptr;
+  }
 }
 
 template <bool little_endian>
@@ -95,6 +105,7 @@ Iterator<little_endian>& Iterator<little_endian>::operator--() {
 template <bool little_endian>
 Iterator<little_endian>& Iterator<little_endian>::operator=(const Iterator<little_endian>& itr) {
   this->data_ = itr.data_;
+  this->contiguous_ = itr.contiguous_;
   this->begin_ = itr.begin_;
   this->end_ = itr.end_;
   this->index_ = itr.index_;
@@ -134,9 +145,12 @@ bool Iterator<little_endian>::operator>=(const Iterator<little_endian>& itr) con
 template <bool little_endian>
 uint8_t Iterator<little_endian>::operator*() const {
   ASSERT_LOG(index_ < end_ && !(begin_ > index_), "Index %zu out of bounds: [%zu,%zu)", index_, begin_, end_);
-  size_t index = index_;
+  if (contiguous_ != nullptr) {
+    return contiguous_[index_];
+  }
 
-  for (auto view : data_) {
+  size_t index = index_;
+  for (const auto& view : *data_) {
     if (index < view.size()) {
       return view[index];
     }
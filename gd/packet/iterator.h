@@ -17,6 +17,7 @@
 #pragma once
 
 #include <cstdint>
+#include <cstring>
 #include <forward_list>
 #include <memory>
 
@@ -70,15 +71,33 @@ class Iterator : public std::iterator<std::random_access_iterator_tag, uint8_t>
     FixedWidthPODType extracted_value;
     uint8_t* value_ptr = (uint8_t*)&extracted_value;
 
+    // Load the value directly when it is all in bounds of a single fragment
+    if (contiguous_ != nullptr && index_ >= begin_ && index_ + sizeof(FixedWidthPODType) <= end_) {
+      const uint8_t* source = contiguous_ + index_;
+      if (little_endian) {
+        std::memcpy(value_ptr, source, sizeof(FixedWidthPODType));
+      } else {
+        for (size_t i = 0; i < sizeof(FixedWidthPODType); i++) {
+          value_ptr[sizeof(FixedWidthPODType) - i - 1] = source[i];
+        }
+      }
+      index_ += sizeof(FixedWidthPODType);
+      return extracted_value;
+    }
+
     for (size_t i = 0; i < sizeof(FixedWidthPODType); i++) {
       size_t index = (little_endian ? i : sizeof(FixedWidthPODType) - i - 1);
-      value_ptr[index] = *((*this)++);
+      value_ptr[index] = **this;
+      ++(*this);
     }
     return extracted_value;
   }
 
  private:
-  std::forward_list<View> data_;
+  // Shared by the copies of the iterator, so that copying it doesn't copy the fragment list
+  std::shared_ptr<const std::forward_list<View>> data_;
+  // Set when the data is in a single fragment, the byte at index_ is then contiguous_[index_]
+  const uint8_t* contiguous_;
   size_t index_;
   size_t begin_;
   size_t end_;
@@ -68,6 +68,14 @@ size_t PacketView<little_endian>::size() const {
   return length_;
 }
 
+template <bool little_endian>
+void PacketView<little_endian>::CopyTo(uint8_t* destination) const {
+  for (const auto& fragment : fragments_) {
+    std::copy(fragment.data(), fragment.data() + fragment.size(), destination);
+    destination += fragment.size();
+  }
+}
+
 template <bool little_endian>
 std::forward_list<View> PacketView<little_endian>::GetSubviewList(size_t begin, size_t end) const {
   ASSERT(begin <= end);
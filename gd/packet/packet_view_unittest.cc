@@ -542,6 +542,17 @@ TEST_F(PacketViewMultiViewTest, arrayOperatorTest) {
   ASSERT_DEATH(multi_view[single_view.size()], "");
 }
 
+TEST_F(PacketViewMultiViewTest, extractTest) {
+  auto single_itr = single_view.begin();
+  auto multi_itr = multi_view.begin();
+  // The values span the fragment boundaries of multi_view
+  ASSERT_EQ(single_itr.extract<uint16_t>(), multi_itr.extract<uint16_t>());
+  ASSERT_EQ(single_itr.extract<uint32_t>(), multi_itr.extract<uint32_t>());
+  ASSERT_EQ(single_itr.extract<uint64_t>(), multi_itr.extract<uint64_t>());
+  ASSERT_EQ(single_itr.extract<uint64_t>(), multi_itr.extract<uint64_t>());
+  ASSERT_EQ(single_itr.NumBytesRemaining(), multi_itr.NumBytesRemaining());
+}
+
 TEST_F(PacketViewMultiViewAppendTest, sizeTestAppend) {
   ASSERT_EQ(single_view.size(), multi_view.size());
 }
@@ -123,6 +123,7 @@ bool generate_cpp_headers_one_file(const Declarations& decls, const std::filesys
   out_file << "#include <stdint.h>\n";
   out_file << "#include <string>\n";
   out_file << "#include <functional>\n";
+  out_file << "#include <optional>\n";
   out_file << "\n\n";
   out_file << "#include \"os/log.h\"\n";
   out_file << "#include \"packet/base_packet_builder.h\"\n";
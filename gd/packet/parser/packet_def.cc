@@ -59,6 +59,7 @@ void PacketDef::GenParserDefinition(std::ostream& s) const {
     GenParserFieldGetter(s, field);
     s << "\n";
   }
+  GenParserStaticOffsets(s);
   GenValidator(s);
   s << "\n";
 
@@ -81,6 +82,7 @@ void PacketDef::GenParserDefinition(std::ostream& s) const {
       s << "\n";
     }
   }
+  GenParserOffsetCache(s);
   s << "};\n";
 }
 
@@ -130,9 +132,63 @@ void PacketDef::GenParserFieldGetter(std::ostream& s, const PacketField* field)
                  << "no method exists to determine field location from begin() or end().\n";
   }
 
+  // The dynamic part of the offset is computed once and cached in the view, see GenParserOffsetCache().
+  if (!field->GetGetterFunctionName().empty() && !start_field_offset.empty() && start_field_offset.has_dynamic()) {
+    start_field_offset =
+        Size(start_field_offset.bits(), util::UnderscoreToCamelCase(field->GetName()) + "DynamicOffset_()");
+  }
+
   field->GenGetter(s, start_field_offset, end_field_offset);
 }
 
+void PacketDef::GenParserStaticOffsets(std::ostream& s) const {
+  // Byte offsets from begin() of the fields that are at the same place in every packet.
+  for (const auto& field : fields_) {
+    if (field->GetGetterFunctionName().empty()) {
+      continue;
+    }
+    auto offset = GetOffsetForField(field->GetName(), false);
+    if (offset.empty() || offset.has_dynamic() || offset.bits() % 8 != 0) {
+      continue;
+    }
+    s << "static constexpr size_t k" << util::UnderscoreToCamelCase(field->GetName()) << "Offset = ";
+    s << offset.bits() / 8 << ";";
+  }
+}
+
+std::vector<const PacketField*> PacketDef::GetFieldsWithDynamicOffset() const {
+  std::vector<const PacketField*> dynamic_fields;
+  for (const auto& field : fields_) {
+    if (field->GetGetterFunctionName().empty()) {
+      continue;
+    }
+    auto offset = GetOffsetForField(field->GetName(), false);
+    if (!offset.empty() && offset.has_dynamic()) {
+      dynamic_fields.push_back(field);
+    }
+  }
+  return dynamic_fields;
+}
+
+void PacketDef::GenParserOffsetCache(std::ostream& s) const {
+  const auto dynamic_fields = GetFieldsWithDynamicOffset();
+  if (dynamic_fields.empty()) {
+    return;
+  }
+
+  // IsValid_() fills the cache, the getters fill it themselves for views validated through a parent.
+  s << " private:\n";
+  for (const auto& field : dynamic_fields) {
+    auto offset = GetOffsetForField(field->GetName(), false);
+    const auto& cache_name = field->GetName() + "_dynamic_offset_";
+    s << "size_t " << util::UnderscoreToCamelCase(field->GetName()) << "DynamicOffset_() const {";
+    s << "if (!" << cache_name << ".has_value()) { " << cache_name << " = " << offset.dynamic_string() << "; }";
+    s << "return *" << cache_name << ";";
+    s << "}";
+    s << "mutable std::optional<size_t> " << cache_name << ";\n";
+  }
+}
+
 TypeDef::Type PacketDef::GetDefinitionType() const {
   return TypeDef::Type::PACKET;
 }
@@ -276,6 +332,11 @@ void PacketDef::GenValidator(std::ostream& s) const {
     s << "\n";
   }
 
+  // The field offsets are known to be in bounds now
+  for (const auto& field : GetFieldsWithDynamicOffset()) {
+    s << util::UnderscoreToCamelCase(field->GetName()) << "DynamicOffset_();";
+  }
+
   s << "return true;";
   s << "}\n";
   if (parent_ == nullptr) {
@@ -344,6 +405,7 @@ void PacketDef::GenBuilderDefinitionPybind11(std::ostream& s) const {
   }
   s << ".def(\"Serialize\", [](" << name_ << "Builder& builder){";
   s << "std::vector<uint8_t> bytes;";
+  s << "bytes.reserve(builder.size());";
   s << "BitInserter bi(bytes);";
   s << "builder.Serialize(bi);";
   s << "return bytes;})";
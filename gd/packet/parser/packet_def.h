@@ -37,6 +37,13 @@ class PacketDef : public ParentDef {
 
   void GenParserFieldGetter(std::ostream& s, const PacketField* field) const;
 
+  void GenParserStaticOffsets(std::ostream& s) const;
+
+  void GenParserOffsetCache(std::ostream& s) const;
+
+  // Fields with an offset from begin() that depends on the packet contents, in declaration order.
+  std::vector<const PacketField*> GetFieldsWithDynamicOffset() const;
+
   void GenValidator(std::ostream& s) const;
 
   TypeDef::Type GetDefinitionType() const;
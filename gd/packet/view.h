@@ -27,6 +27,9 @@ namespace packet {
 class View {
  public:
   View(std::shared_ptr<const std::vector<uint8_t>> data, size_t begin, size_t end);
+  // Views |size| bytes of a buffer that is not a vector, like one lent by the legacy stack. The buffer is released by
+  // the deleter of |data| once the last view of it is gone.
+  View(std::shared_ptr<const uint8_t> data, size_t size);
   View(const View& view, size_t begin, size_t end);
   View(const View& view) = default;
   virtual ~View() = default;
@@ -35,8 +38,12 @@ class View {
 
   size_t size() const;
 
+  // Pointer to the first byte of the view
+  const uint8_t* data() const;
+
  private:
-  std::shared_ptr<const std::vector<uint8_t>> data_;
+  // Points to the first byte of the buffer, and shares the ownership of the vector for views of one
+  std::shared_ptr<const uint8_t> data_;
   size_t begin_;
   size_t end_;
 };
@@ -0,0 +1,35 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "packet/view_builder.h"
+
+#include <utility>
+
+namespace bluetooth {
+namespace packet {
+
+ViewBuilder::ViewBuilder(View view) : view_(std::move(view)) {}
+
+size_t ViewBuilder::size() const {
+  return view_.size();
+}
+
+void ViewBuilder::Serialize(BitInserter& it) const {
+  it.insert_bytes(view_.data(), view_.size());
+}
+
+}  // namespace packet
+}  // namespace bluetooth
@@ -0,0 +1,78 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "packet/view_builder.h"
+
+#include <gtest/gtest.h>
+#include <memory>
+#include <vector>
+
+#include "packet/packet_view.h"
+
+namespace bluetooth {
+namespace packet {
+
+TEST(ViewBuilderTest, serializeVectorViewTest) {
+  auto data = std::make_shared<const std::vector<uint8_t>>(std::vector<uint8_t>{0x00, 0x01, 0x02, 0x03, 0x04});
+  ViewBuilder builder(View(data, 1, 4));
+  ASSERT_EQ(3u, builder.size());
+
+  std::vector<uint8_t> packet;
+  BitInserter it(packet);
+  builder.Serialize(it);
+  ASSERT_EQ(std::vector<uint8_t>({0x01, 0x02, 0x03}), packet);
+}
+
+TEST(ViewBuilderTest, externalBufferTest) {
+  uint8_t* buffer = new uint8_t[4]{0x10, 0x11, 0x12, 0x13};
+  bool released = false;
+  std::shared_ptr<const uint8_t> data(buffer + 1, [buffer, &released](const uint8_t*) {
+    delete[] buffer;
+    released = true;
+  });
+
+  auto builder = std::make_unique<ViewBuilder>(View(data, 3));
+  {
+    PacketView<kLittleEndian> packet_view({View(data, 3)});
+    data.reset();
+    ASSERT_EQ(3u, packet_view.size());
+    ASSERT_EQ(0x13, packet_view[2]);
+  }
+
+  ASSERT_EQ(3u, builder->size());
+  std::vector<uint8_t> packet;
+  BitInserter it(packet);
+  builder->Serialize(it);
+  ASSERT_EQ(std::vector<uint8_t>({0x11, 0x12, 0x13}), packet);
+
+  // The buffer is released with the last builder or view of it
+  ASSERT_FALSE(released);
+  builder.reset();
+  ASSERT_TRUE(released);
+}
+
+TEST(ViewBuilderTest, copyToTest) {
+  auto first = std::make_shared<const std::vector<uint8_t>>(std::vector<uint8_t>{0x00, 0x01, 0x02});
+  auto second = std::make_shared<const std::vector<uint8_t>>(std::vector<uint8_t>{0x03, 0x04});
+  PacketView<kLittleEndian> packet_view({View(first, 0, 3), View(second, 0, 2)});
+
+  std::vector<uint8_t> copy(packet_view.size());
+  packet_view.CopyTo(copy.data());
+  ASSERT_EQ(std::vector<uint8_t>({0x00, 0x01, 0x02, 0x03, 0x04}), copy);
+}
+
+}  // namespace packet
+}  // namespace bluetooth
@@ -24,21 +24,20 @@
 **********************************************************************************************************************/
 #include <chrono>
 #include <cstdlib>
+#include <mutex>
 
 #include "security/ecc/p_256_ecc_pp.h"
 
 namespace {
 
-static bool srand_initiated = false;
+// Key pairs are generated on the pairing threads and on the EcdhWorkerPool workers
+static std::once_flag srand_initiated;
 
 template <size_t SIZE>
 static std::array<uint8_t, SIZE> GenerateRandom() {
-  if (!srand_initiated) {
-    srand_initiated = true;
-    // TODO:  We need a proper  random number generator here.
-    // use current time as seed for random generator
-    std::srand(std::time(nullptr));
-  }
+  // TODO:  We need a proper  random number generator here.
+  // use current time as seed for random generator
+  std::call_once(srand_initiated, [] { std::srand(std::time(nullptr)); });
 
   std::array<uint8_t, SIZE> r;
   for (size_t i = 0; i < SIZE; i++) r[i] = std::rand();
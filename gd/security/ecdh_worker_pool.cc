@@ -0,0 +1,113 @@
+/******************************************************************************
+ *
+ *  Copyright 2020 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include "security/ecdh_worker_pool.h"
+
+#include <memory>
+
+namespace bluetooth {
+namespace security {
+
+EcdhWorkerPool::EcdhWorkerPool(size_t num_workers, size_t num_key_pairs) : num_key_pairs_(num_key_pairs) {
+  for (size_t i = 0; i < num_workers; i++) {
+    workers_.emplace_back(&EcdhWorkerPool::WorkerMain, this);
+  }
+}
+
+EcdhWorkerPool::~EcdhWorkerPool() {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  worker_blocker_.notify_all();
+  for (auto& worker : workers_) worker.join();
+}
+
+EcdhWorkerPool& EcdhWorkerPool::Get() {
+  static EcdhWorkerPool pool(kDefaultWorkers, kDefaultKeyPairs);
+  return pool;
+}
+
+EcdhKeyPair EcdhWorkerPool::TakeKeyPair() {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!key_pairs_.empty()) {
+      EcdhKeyPair key_pair = std::move(key_pairs_.front());
+      key_pairs_.pop_front();
+      lock.unlock();
+      // Have a worker make up for it
+      worker_blocker_.notify_one();
+      return key_pair;
+    }
+  }
+  return GenerateECDHKeyPair();
+}
+
+std::shared_future<std::array<uint8_t, 32>> EcdhWorkerPool::ComputeDHKeyAsync(
+    const std::array<uint8_t, 32>& my_private_key, const EcdhPublicKey& remote_public_key) {
+  auto task = std::make_shared<std::packaged_task<std::array<uint8_t, 32>()>>(
+      [my_private_key, remote_public_key] { return ComputeDHKey(my_private_key, remote_public_key); });
+  std::shared_future<std::array<uint8_t, 32>> dhkey = task->get_future().share();
+
+  if (workers_.empty()) {
+    (*task)();
+    return dhkey;
+  }
+
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    tasks_.push([task] { (*task)(); });
+  }
+  worker_blocker_.notify_one();
+  return dhkey;
+}
+
+size_t EcdhWorkerPool::GetKeyPairCount() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return key_pairs_.size();
+}
+
+void EcdhWorkerPool::WorkerMain() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    worker_blocker_.wait(lock, [this] {
+      return stopping_ || !tasks_.empty() || key_pairs_.size() + key_pairs_in_progress_ < num_key_pairs_;
+    });
+    if (stopping_) return;
+
+    // A pairing is waiting for the task, while the key pairs are only kept ahead of time
+    if (!tasks_.empty()) {
+      std::function<void()> task = std::move(tasks_.front());
+      tasks_.pop();
+      lock.unlock();
+      task();
+      lock.lock();
+      continue;
+    }
+
+    key_pairs_in_progress_++;
+    lock.unlock();
+    EcdhKeyPair key_pair = GenerateECDHKeyPair();
+    lock.lock();
+    key_pairs_in_progress_--;
+    key_pairs_.push_back(std::move(key_pair));
+  }
+}
+
+}  // namespace security
+}  // namespace bluetooth
@@ -0,0 +1,88 @@
+/******************************************************************************
+ *
+ *  Copyright 2020 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "security/ecdh_keys.h"
+
+namespace bluetooth {
+namespace security {
+
+using EcdhKeyPair = std::pair<std::array<uint8_t, 32> /* private key */, EcdhPublicKey>;
+
+/* EcdhWorkerPool runs the P-256 computations of LE Secure Connections pairing on worker threads shared by all the
+ * pairing handlers, so that many devices can pair at once without each pairing thread doing its own point
+ * multiplications inline.
+ *
+ * When they have nothing else to do, the workers keep a few key pairs ready, so that a pairing starting its public
+ * key exchange doesn't wait for one to be generated. Each key pair is handed out once, and never reused for another
+ * pairing. Diffie-Hellman key computations are queued ahead of key pair generation, as a pairing is waiting for them.
+ */
+class EcdhWorkerPool {
+ public:
+  static constexpr size_t kDefaultWorkers = 2;
+  static constexpr size_t kDefaultKeyPairs = 4;
+
+  EcdhWorkerPool(size_t num_workers, size_t num_key_pairs);
+  ~EcdhWorkerPool();
+
+  EcdhWorkerPool(const EcdhWorkerPool&) = delete;
+  EcdhWorkerPool& operator=(const EcdhWorkerPool&) = delete;
+
+  /* The pool used by the pairing handlers */
+  static EcdhWorkerPool& Get();
+
+  /* Returns a key pair that was never handed out before. It is taken from the precomputed ones when there is one, and
+   * generated by the caller otherwise. Can be called from any thread. */
+  EcdhKeyPair TakeKeyPair();
+
+  /* Queues the computation of the Diffie-Hellman key on a worker. Can be called from any thread. */
+  std::shared_future<std::array<uint8_t, 32>> ComputeDHKeyAsync(const std::array<uint8_t, 32>& my_private_key,
+                                                                 const EcdhPublicKey& remote_public_key);
+
+  /* Number of key pairs ready to be handed out */
+  size_t GetKeyPairCount();
+
+ private:
+  void WorkerMain();
+
+  const size_t num_key_pairs_;
+
+  std::mutex mutex_;
+  std::condition_variable worker_blocker_;
+  std::queue<std::function<void()>> tasks_;
+  std::deque<EcdhKeyPair> key_pairs_;
+  /* Key pairs being generated by the workers, counted against |num_key_pairs_| */
+  size_t key_pairs_in_progress_ = 0;
+  bool stopping_ = false;
+
+  std::vector<std::thread> workers_;
+};
+
+}  // namespace security
+}  // namespace bluetooth
@@ -18,6 +18,8 @@
 
 #pragma once
 
+#include <array>
+#include <chrono>
 #include <optional>
 #include <variant>
 
@@ -47,6 +49,8 @@ using DistributedKeys =
 struct PairingResult {
   hci::AddressWithType connection_address;
   DistributedKeys distributed_keys;
+  /* Time spent in each phase, indexed by PairingHandlerLe::PAIRING_PHASE */
+  std::array<std::chrono::milliseconds, 4> phase_durations{};
 };
 
 using PairingResultOrFailure = std::variant<PairingResult, PairingFailure>;
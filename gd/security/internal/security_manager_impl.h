@@ -142,11 +142,12 @@ class SecurityManagerImpl : public channel::ISecurityManagerChannelListener, pub
                               hci::AuthenticationRequirements authentication_requirements);
   void OnL2capRegistrationCompleteLe(l2cap::le::FixedChannelManager::RegistrationResult result,
                                      std::unique_ptr<l2cap::le::FixedChannelService> le_smp_service);
-  void OnSmpCommandLe();
+  void OnSmpCommandLe(hci::AddressWithType address);
   void OnConnectionOpenLe(std::unique_ptr<l2cap::le::FixedChannel> channel);
   void OnConnectionClosedLe(hci::AddressWithType address, hci::ErrorCode error_code);
-  void OnConnectionFailureLe(bluetooth::l2cap::le::FixedChannelManager::ConnectionResult result);
-  void OnPairingFinished(bluetooth::security::PairingResultOrFailure pairing_result);
+  void OnConnectionFailureLe(hci::AddressWithType address,
+                             bluetooth::l2cap::le::FixedChannelManager::ConnectionResult result);
+  void OnPairingFinished(hci::AddressWithType address, bluetooth::security::PairingResultOrFailure pairing_result);
   void OnHciLeEvent(hci::LeMetaEventView event);
 
   os::Handler* security_handler_ __attribute__((unused));
@@ -158,13 +159,17 @@ class SecurityManagerImpl : public channel::ISecurityManagerChannelListener, pub
   SecurityRecordDatabase security_database_;
   std::unordered_map<hci::Address, std::shared_ptr<pairing::PairingHandler>> pairing_handler_map_;
 
-  struct {
-    hci::AddressWithType address_;
+  // Each LE pairing runs on its own PairingHandlerLe thread, so pairings with different devices proceed at once.
+  // Only accessed from the security handler.
+  struct PendingLePairing {
     std::unique_ptr<l2cap::le::FixedChannel> channel_;
-    uint8_t connection_handle_;
+    uint16_t connection_handle_;
     std::unique_ptr<PairingHandlerLe> handler_;
     std::unique_ptr<os::EnqueueBuffer<packet::BasePacketBuilder>> enqueue_buffer_;
-  } pending_le_pairing_;
+  };
+  std::unordered_map<hci::AddressWithType, PendingLePairing> pending_le_pairings_;
+
+  PairingHandlerLe* FindLePairingHandler(const hci::AddressWithType& address);
 };
 }  // namespace internal
 }  // namespace security
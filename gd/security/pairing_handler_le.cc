@@ -21,8 +21,39 @@
 namespace bluetooth {
 namespace security {
 
+namespace {
+const char* PairingPhaseText(PairingHandlerLe::PAIRING_PHASE phase) {
+  switch (phase) {
+    case PairingHandlerLe::ACCEPT_PROMPT:
+      return "accept prompt";
+    case PairingHandlerLe::PHASE1:
+      return "phase 1";
+    case PairingHandlerLe::PHASE2:
+      return "phase 2";
+    case PairingHandlerLe::PHASE3:
+      return "phase 3";
+  }
+  return "unknown phase";
+}
+}  // namespace
+
+void PairingHandlerLe::EnterPhase(PAIRING_PHASE next) {
+  if (next == phase) return;
+  EndPhase();
+  phase = next;
+  phase_start_ = std::chrono::steady_clock::now();
+}
+
+void PairingHandlerLe::EndPhase() {
+  auto duration =
+      std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - phase_start_);
+  phase_durations_[phase] += duration;
+  LOG_INFO("Pairing %s took %lld ms", PairingPhaseText(phase), static_cast<long long>(duration.count()));
+}
+
 void PairingHandlerLe::PairingMain(InitialInformations i) {
   LOG_INFO("Pairing Started");
+  phase_start_ = std::chrono::steady_clock::now();
 
   if (i.remotely_initiated) {
     LOG_INFO("Was remotely initiated, presenting user with the accept prompt");
@@ -44,6 +75,7 @@ void PairingHandlerLe::PairingMain(InitialInformations i) {
   }
 
   /************************************************ PHASE 1 *********************************************************/
+  EnterPhase(PHASE1);
   Phase1ResultOrFailure phase_1_result = ExchangePairingFeature(i);
   if (std::holds_alternative<PairingFailure>(phase_1_result)) {
     LOG_WARN("Pairing failed in phase 1");
@@ -57,6 +89,7 @@ void PairingHandlerLe::PairingMain(InitialInformations i) {
   auto [pairing_request, pairing_response] = std::get<Phase1Result>(phase_1_result);
 
   /************************************************ PHASE 2 *********************************************************/
+  EnterPhase(PHASE2);
   bool isSecureConnections = pairing_request.GetAuthReq() & pairing_response.GetAuthReq() & AuthReqMaskSc;
   if (isSecureConnections) {
     // 2.3.5.6 LE Secure Connections pairing phase 2
@@ -82,7 +115,8 @@ void PairingHandlerLe::PairingMain(InitialInformations i) {
     }
     auto [PKa, PKb, dhkey] = std::get<KeyExchangeResult>(key_exchange_result);
 
-    // Public key exchange finished, Diffie-Hellman key computed.
+    // Public key exchange finished. The Diffie-Hellman key is computed by the worker pool while we go through stage 1,
+    // which doesn't need it.
 
     Stage1ResultOrFailure stage1result = DoSecureConnectionsStage1(i, PKa, PKb, pairing_request, pairing_response);
     if (std::holds_alternative<PairingFailure>(stage1result)) {
@@ -90,8 +124,8 @@ void PairingHandlerLe::PairingMain(InitialInformations i) {
       return;
     }
 
-    Stage2ResultOrFailure stage_2_result = DoSecureConnectionsStage2(i, PKa, PKb, pairing_request, pairing_response,
-                                                                     std::get<Stage1Result>(stage1result), dhkey);
+    Stage2ResultOrFailure stage_2_result = DoSecureConnectionsStage2(
+        i, PKa, PKb, pairing_request, pairing_response, std::get<Stage1Result>(stage1result), dhkey.get());
     if (std::holds_alternative<PairingFailure>(stage_2_result)) {
       i.OnPairingFinished(std::get<PairingFailure>(stage_2_result));
       return;
@@ -129,6 +163,7 @@ void PairingHandlerLe::PairingMain(InitialInformations i) {
   }
 
   /************************************************ PHASE 3 *********************************************************/
+  EnterPhase(PHASE3);
   LOG_INFO("Waiting for encryption changed");
   auto encryption_change_result = WaitEncryptionChanged();
   if (std::holds_alternative<PairingFailure>(encryption_change_result)) {
@@ -163,9 +198,11 @@ void PairingHandlerLe::PairingMain(InitialInformations i) {
 
   // bool bonding = pairing_request.GetAuthReq() & pairing_response.GetAuthReq() & AuthReqMaskBondingFlag;
 
+  EndPhase();
   i.OnPairingFinished(PairingResult{
       .connection_address = i.remote_connection_address,
       .distributed_keys = std::get<DistributedKeys>(keyExchangeStatus),
+      .phase_durations = phase_durations_,
   });
 
   LOG_INFO("Pairing finished successfully.");
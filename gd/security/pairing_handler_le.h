@@ -21,6 +21,7 @@
 #include <array>
 #include <chrono>
 #include <condition_variable>
+#include <future>
 #include <mutex>
 #include <optional>
 #include <queue>
@@ -33,6 +34,7 @@
 #include "hci/le_security_interface.h"
 #include "packet/packet_view.h"
 #include "security/ecdh_keys.h"
+#include "security/ecdh_worker_pool.h"
 #include "security/initial_informations.h"
 #include "security/pairing_failure.h"
 #include "security/smp_packets.h"
@@ -85,8 +87,8 @@ constexpr int SMP_TIMEOUT = 30;
 using CommandViewOrFailure = std::variant<CommandView, PairingFailure>;
 using Phase1Result = std::pair<PairingRequestView /* pairning_request*/, PairingResponseView /* pairing_response */>;
 using Phase1ResultOrFailure = std::variant<PairingFailure, Phase1Result>;
-using KeyExchangeResult =
-    std::tuple<EcdhPublicKey /* PKa */, EcdhPublicKey /* PKb */, std::array<uint8_t, 32> /*dhkey*/>;
+using KeyExchangeResult = std::tuple<EcdhPublicKey /* PKa */, EcdhPublicKey /* PKb */,
+                                     std::shared_future<std::array<uint8_t, 32>> /*dhkey*/>;
 using Stage1Result = std::tuple<Octet16, Octet16, Octet16, Octet16>;
 using Stage1ResultOrFailure = std::variant<PairingFailure, Stage1Result>;
 using Stage2ResultOrFailure = std::variant<PairingFailure, Octet16 /* LTK */>;
@@ -101,7 +103,8 @@ using StkOrFailure = std::variant<PairingFailure, Octet16 /* STK */>;
  *
  * Each PairingHandlerLe have a thread executing |PairingMain| method. Thread is
  * blocked when waiting for UI/L2CAP/HCI interactions, and moves through all the
- * phases.
+ * phases. The P-256 computations run on the EcdhWorkerPool shared by all the
+ * handlers, so several devices can pair at once.
  */
 class PairingHandlerLe {
  public:
@@ -179,7 +182,7 @@ class PairingHandlerLe {
      the private key. */
   static MyOobData GenerateOobData() {
     MyOobData data;
-    std::tie(data.private_key, data.public_key) = GenerateECDHKeyPair();
+    std::tie(data.private_key, data.public_key) = EcdhWorkerPool::Get().TakeKeyPair();
 
     data.r = GenerateRandom<16>();
     data.c = crypto_toolbox::f4(data.public_key.x.data(), data.public_key.x.data(), data.r, 0);
@@ -485,7 +488,21 @@ class PairingHandlerLe {
     thread_.join();
   }
 
+  /* Time spent in each phase so far, indexed by PAIRING_PHASE. Only valid once the pairing is finished. */
+  const std::array<std::chrono::milliseconds, 4>& GetPhaseDurations() const {
+    return phase_durations_;
+  }
+
  private:
+  /* Moves the pairing to |next| phase, recording the time spent in the current one */
+  void EnterPhase(PAIRING_PHASE next);
+
+  /* Records the time spent in the current phase, as the pairing is finished */
+  void EndPhase();
+
+  std::chrono::steady_clock::time_point phase_start_;
+  std::array<std::chrono::milliseconds, 4> phase_durations_{};
+
   std::condition_variable pairing_thread_blocker_;
 
   std::mutex queue_guard;
@@ -23,9 +23,9 @@ namespace security {
 
 std::variant<PairingFailure, KeyExchangeResult> PairingHandlerLe::ExchangePublicKeys(const InitialInformations& i,
                                                                                      OobDataFlag remote_have_oob_data) {
-  // Generate ECDH, or use one that was used for OOB data
+  // Take a fresh ECDH key pair, or use the one that was used for OOB data
   const auto [private_key, public_key] = (remote_have_oob_data == OobDataFlag::NOT_PRESENT || !i.my_oob_data)
-                                             ? GenerateECDHKeyPair()
+                                             ? EcdhWorkerPool::Get().TakeKeyPair()
                                              : std::make_pair(i.my_oob_data->private_key, i.my_oob_data->public_key);
 
   LOG_INFO("Public key exchange start");
@@ -73,7 +73,8 @@ std::variant<PairingFailure, KeyExchangeResult> PairingHandlerLe::ExchangePublic
 
   LOG_INFO("Public key exchange finish");
 
-  std::array<uint8_t, 32> dhkey = ComputeDHKey(private_key, remote_public_key);
+  std::shared_future<std::array<uint8_t, 32>> dhkey =
+      EcdhWorkerPool::Get().ComputeDHKeyAsync(private_key, remote_public_key);
 
   const EcdhPublicKey& PKa = IAmMaster(i) ? public_key : remote_public_key;
   const EcdhPublicKey& PKb = IAmMaster(i) ? remote_public_key : public_key;
@@ -0,0 +1,104 @@
+/******************************************************************************
+ *
+ *  Copyright 2020 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <chrono>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "security/ecdh_keys.h"
+#include "security/ecdh_worker_pool.h"
+
+using namespace std::chrono_literals;
+
+namespace bluetooth {
+namespace security {
+
+namespace {
+void WaitForKeyPairs(EcdhWorkerPool& pool, size_t count) {
+  for (int i = 0; i < 500 && pool.GetKeyPairCount() < count; i++) std::this_thread::sleep_for(10ms);
+}
+}  // namespace
+
+TEST(EcdhWorkerPoolTest, precomputes_key_pairs) {
+  EcdhWorkerPool pool(2, 3);
+  WaitForKeyPairs(pool, 3);
+  ASSERT_EQ(pool.GetKeyPairCount(), 3u);
+
+  auto [private_key, public_key] = pool.TakeKeyPair();
+  EXPECT_TRUE(ValidateECDHPoint(public_key));
+
+  // The workers make up for the key pair that was taken
+  WaitForKeyPairs(pool, 3);
+  EXPECT_EQ(pool.GetKeyPairCount(), 3u);
+}
+
+TEST(EcdhWorkerPoolTest, key_pairs_are_handed_out_once) {
+  EcdhWorkerPool pool(2, 2);
+  std::set<std::array<uint8_t, 32>> private_keys;
+  for (int i = 0; i < 8; i++) {
+    auto [private_key, public_key] = pool.TakeKeyPair();
+    EXPECT_TRUE(ValidateECDHPoint(public_key));
+    EXPECT_TRUE(private_keys.insert(private_key).second);
+  }
+}
+
+TEST(EcdhWorkerPoolTest, computes_dhkey_on_worker) {
+  EcdhWorkerPool pool(2, 0);
+  auto [private_key_a, public_key_a] = pool.TakeKeyPair();
+  auto [private_key_b, public_key_b] = pool.TakeKeyPair();
+
+  auto dhkey_a = pool.ComputeDHKeyAsync(private_key_a, public_key_b);
+  auto dhkey_b = pool.ComputeDHKeyAsync(private_key_b, public_key_a);
+  EXPECT_EQ(dhkey_a.get(), dhkey_b.get());
+  EXPECT_EQ(dhkey_a.get(), ComputeDHKey(private_key_a, public_key_b));
+}
+
+TEST(EcdhWorkerPoolTest, without_workers_runs_inline) {
+  EcdhWorkerPool pool(0, 4);
+  EXPECT_EQ(pool.GetKeyPairCount(), 0u);
+  auto [private_key_a, public_key_a] = pool.TakeKeyPair();
+  auto [private_key_b, public_key_b] = pool.TakeKeyPair();
+
+  auto dhkey = pool.ComputeDHKeyAsync(private_key_a, public_key_b);
+  ASSERT_EQ(dhkey.wait_for(0s), std::future_status::ready);
+  EXPECT_EQ(dhkey.get(), ComputeDHKey(private_key_b, public_key_a));
+}
+
+TEST(EcdhWorkerPoolTest, concurrent_pairings) {
+  EcdhWorkerPool pool(2, 4);
+  std::vector<std::thread> pairings;
+  std::array<bool, 8> matched{};
+  for (size_t i = 0; i < matched.size(); i++) {
+    pairings.emplace_back([&pool, &matched, i] {
+      auto [private_key_a, public_key_a] = pool.TakeKeyPair();
+      auto [private_key_b, public_key_b] = pool.TakeKeyPair();
+      auto dhkey_a = pool.ComputeDHKeyAsync(private_key_a, public_key_b);
+      auto dhkey_b = pool.ComputeDHKeyAsync(private_key_b, public_key_a);
+      matched[i] = dhkey_a.get() == dhkey_b.get();
+    });
+  }
+  for (auto& pairing : pairings) pairing.join();
+  for (size_t i = 0; i < matched.size(); i++) EXPECT_TRUE(matched[i]) << "pairing " << i;
+}
+
+}  // namespace security
+}  // namespace bluetooth
@@ -29,13 +29,14 @@
 #include "hci/hci_packets.h"
 #include "l2cap/classic/dynamic_channel_manager.h"
 #include "l2cap/classic/l2cap_classic_module.h"
+#include "l2cap/le/l2cap_le_module.h"
 #include "l2cap/psm.h"
 #include "l2cap/security_policy.h"
 #include "module.h"
 #include "os/handler.h"
 #include "os/log.h"
+#include "packet/base_packet_builder.h"
 #include "packet/packet_view.h"
-#include "packet/raw_builder.h"
 #include "shim/dumpsys.h"
 #include "shim/l2cap.h"
 
@@ -66,14 +67,6 @@ using UnregisterServiceDone = std::function<void()>;
 using ServiceConnectionOpen =
     std::function<void(ConnectionCompleteCallback, std::unique_ptr<l2cap::classic::DynamicChannel>)>;
 
-std::unique_ptr<packet::RawBuilder> MakeUniquePacket(const uint8_t* data, size_t len) {
-  packet::RawBuilder builder;
-  std::vector<uint8_t> bytes(data, data + len);
-  auto payload = std::make_unique<packet::RawBuilder>();
-  payload->AddOctets(bytes);
-  return payload;
-}
-
 }  // namespace
 
 class ConnectionInterface {
@@ -99,9 +92,8 @@ class ConnectionInterface {
       LOG_WARN("Got read ready from gd l2cap but no packet is ready");
       return;
     }
-    std::vector<const uint8_t> data(packet->begin(), packet->end());
     ASSERT(on_data_ready_callback_ != nullptr);
-    on_data_ready_callback_(cid_, data);
+    on_data_ready_callback_(cid_, *packet);
   }
 
   void SetReadDataReadyCallback(ReadDataReadyCallback on_data_ready) {
@@ -120,7 +112,7 @@ class ConnectionInterface {
     return data;
   }
 
-  void Write(std::unique_ptr<packet::RawBuilder> packet) {
+  void Write(std::unique_ptr<packet::BasePacketBuilder> packet) {
     LOG_DEBUG("Writing packet cid:%hd size:%zd", cid_, packet->size());
     write_queue_.push(std::move(packet));
     if (!enqueue_registered_) {
@@ -173,7 +165,7 @@ class ConnectionInterface {
 
   ConnectionClosed on_closed_{};
 
-  std::queue<std::unique_ptr<packet::PacketBuilder<hci::kLittleEndian>>> write_queue_;
+  std::queue<std::unique_ptr<packet::BasePacketBuilder>> write_queue_;
 
   bool enqueue_registered_{false};
   bool dequeue_registered_{false};
@@ -189,7 +181,7 @@ class ConnectionInterfaceManager {
   void SetReadDataReadyCallback(ConnectionInterfaceDescriptor cid, ReadDataReadyCallback on_data_ready);
   void SetConnectionClosedCallback(ConnectionInterfaceDescriptor cid, ConnectionClosedCallback on_closed);
 
-  bool Write(ConnectionInterfaceDescriptor cid, std::unique_ptr<packet::RawBuilder> packet);
+  bool Write(ConnectionInterfaceDescriptor cid, std::unique_ptr<packet::BasePacketBuilder> packet);
 
   size_t NumberOfActiveConnections() const {
     return cid_to_interface_map_.size();
@@ -297,7 +289,8 @@ void ConnectionInterfaceManager::SetConnectionClosedCallback(ConnectionInterface
   return cid_to_interface_map_[cid]->SetConnectionClosedCallback(on_closed);
 }
 
-bool ConnectionInterfaceManager::Write(ConnectionInterfaceDescriptor cid, std::unique_ptr<packet::RawBuilder> packet) {
+bool ConnectionInterfaceManager::Write(ConnectionInterfaceDescriptor cid,
+                                       std::unique_ptr<packet::BasePacketBuilder> packet) {
   if (!ConnectionExists(cid)) {
     return false;
   }
@@ -446,7 +439,7 @@ struct L2cap::impl {
   void SetReadDataReadyCallback(ConnectionInterfaceDescriptor cid, ReadDataReadyCallback on_data_ready);
   void SetConnectionClosedCallback(ConnectionInterfaceDescriptor cid, ConnectionClosedCallback on_closed);
 
-  void Write(ConnectionInterfaceDescriptor cid, std::unique_ptr<packet::RawBuilder> packet);
+  void Write(ConnectionInterfaceDescriptor cid, std::unique_ptr<packet::BasePacketBuilder> packet);
 
   void SendLoopbackResponse(std::function<void()> function);
 
@@ -626,7 +619,7 @@ void L2cap::impl::SetConnectionClosedCallback(ConnectionInterfaceDescriptor cid,
   connection_interface_manager_.SetConnectionClosedCallback(cid, std::move(on_closed));
 }
 
-void L2cap::impl::Write(ConnectionInterfaceDescriptor cid, std::unique_ptr<packet::RawBuilder> packet) {
+void L2cap::impl::Write(ConnectionInterfaceDescriptor cid, std::unique_ptr<packet::BasePacketBuilder> packet) {
   connection_interface_manager_.Write(cid, std::move(packet));
 }
 
@@ -680,9 +673,8 @@ void L2cap::SetConnectionClosedCallback(uint16_t raw_cid, ConnectionClosedCallba
                                   std::move(on_closed)));
 }
 
-void L2cap::Write(uint16_t raw_cid, const uint8_t* data, size_t len) {
+void L2cap::Write(uint16_t raw_cid, std::unique_ptr<packet::BasePacketBuilder> packet) {
   ConnectionInterfaceDescriptor cid(raw_cid);
-  auto packet = MakeUniquePacket(data, len);
   GetHandler()->Post(common::BindOnce(&L2cap::impl::Write, common::Unretained(pimpl_.get()), cid, std::move(packet)));
 }
 
@@ -696,12 +688,15 @@ void L2cap::SendLoopbackResponse(std::function<void()> function) {
 void L2cap::ListDependencies(ModuleList* list) {
   list->add<shim::Dumpsys>();
   list->add<l2cap::classic::L2capClassicModule>();
+  list->add<l2cap::le::L2capLeModule>();
 }
 
 void L2cap::Start() {
   pimpl_ = std::make_unique<impl>(*this, GetDependency<l2cap::classic::L2capClassicModule>());
-  GetDependency<shim::Dumpsys>()->RegisterDumpsysFunction(static_cast<void*>(this),
-                                                          [this](int fd) { pimpl_->Dump(fd); });
+  GetDependency<shim::Dumpsys>()->RegisterDumpsysFunction(static_cast<void*>(this), [this](int fd) {
+    pimpl_->Dump(fd);
+    GetDependency<l2cap::le::L2capLeModule>()->Dump(fd);
+  });
 }
 
 void L2cap::Stop() {
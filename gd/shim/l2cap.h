@@ -22,6 +22,8 @@
 #include <string>
 
 #include "module.h"
+#include "packet/base_packet_builder.h"
+#include "packet/packet_view.h"
 
 namespace bluetooth {
 namespace shim {
@@ -29,7 +31,9 @@ namespace shim {
 using ConnectionClosedCallback = std::function<void(uint16_t cid, int error_code)>;
 using ConnectionCompleteCallback =
     std::function<void(std::string string_address, uint16_t psm, uint16_t cid, bool is_connected)>;
-using ReadDataReadyCallback = std::function<void(uint16_t cid, std::vector<const uint8_t> data)>;
+// The packet is lent for the duration of the call, a client that keeps the data copies it
+using ReadDataReadyCallback =
+    std::function<void(uint16_t cid, const packet::PacketView<packet::kLittleEndian>& packet)>;
 
 using RegisterServicePromise = std::promise<uint16_t>;
 using UnregisterServicePromise = std::promise<void>;
@@ -48,7 +52,8 @@ class L2cap : public bluetooth::Module {
   void SetReadDataReadyCallback(uint16_t cid, ReadDataReadyCallback on_data_ready);
   void SetConnectionClosedCallback(uint16_t cid, ConnectionClosedCallback on_closed);
 
-  void Write(uint16_t cid, const uint8_t* data, size_t len);
+  // Takes over |packet|, which may wrap a buffer of the caller in a packet::ViewBuilder rather than copy it
+  void Write(uint16_t cid, std::unique_ptr<packet::BasePacketBuilder> packet);
 
   void SendLoopbackResponse(std::function<void()>);
 
@@ -32,6 +32,7 @@
 #include "neighbor/name_db.h"
 #include "neighbor/page.h"
 #include "neighbor/scan.h"
+#include "neighbor/scan_scheduler.h"
 #include "os/log.h"
 #include "os/thread.h"
 #include "security/security_module.h"
@@ -66,6 +67,7 @@ struct bluetooth::shim::Stack::impl {
     modules.add<::bluetooth::neighbor::NameDbModule>();
     modules.add<::bluetooth::neighbor::PageModule>();
     modules.add<::bluetooth::neighbor::ScanModule>();
+    modules.add<::bluetooth::neighbor::ScanSchedulerModule>();
     modules.add<::bluetooth::security::SecurityModule>();
     modules.add<::bluetooth::storage::LegacyModule>();
     modules.add<::bluetooth::shim::Dumpsys>();
@@ -73,6 +75,17 @@ struct bluetooth::shim::Stack::impl {
 
     stack_thread_ = new Thread("gd_stack_thread", Thread::Priority::NORMAL);
     stack_manager_.StartUp(&modules, stack_thread_);
+    auto dumpsys = stack_manager_.GetInstance<::bluetooth::shim::Dumpsys>();
+    dumpsys->RegisterDumpsysFunction(static_cast<void*>(&stack_manager_),
+                                     [this](int fd) { stack_manager_.Dump(fd); });
+    auto hci_layer = stack_manager_.GetInstance<::bluetooth::hci::HciLayer>();
+    dumpsys->RegisterDumpsysFunction(static_cast<void*>(hci_layer), [hci_layer](int fd) { hci_layer->Dump(fd); });
+    auto advertising_manager = stack_manager_.GetInstance<::bluetooth::hci::LeAdvertisingManager>();
+    dumpsys->RegisterDumpsysFunction(static_cast<void*>(advertising_manager),
+                                     [advertising_manager](int fd) { advertising_manager->Dump(fd); });
+    auto scan_scheduler = stack_manager_.GetInstance<::bluetooth::neighbor::ScanSchedulerModule>();
+    dumpsys->RegisterDumpsysFunction(static_cast<void*>(scan_scheduler),
+                                     [scan_scheduler](int fd) { scan_scheduler->Dump(fd); });
     // TODO(cmanton) Gd stack has spun up another thread with no
     // ability to ascertain the completion
     is_running_ = true;
@@ -85,6 +98,13 @@ struct bluetooth::shim::Stack::impl {
       return;
     }
 
+    auto dumpsys = stack_manager_.GetInstance<::bluetooth::shim::Dumpsys>();
+    dumpsys->UnregisterDumpsysFunction(
+        static_cast<void*>(stack_manager_.GetInstance<::bluetooth::neighbor::ScanSchedulerModule>()));
+    dumpsys->UnregisterDumpsysFunction(
+        static_cast<void*>(stack_manager_.GetInstance<::bluetooth::hci::LeAdvertisingManager>()));
+    dumpsys->UnregisterDumpsysFunction(static_cast<void*>(stack_manager_.GetInstance<::bluetooth::hci::HciLayer>()));
+    dumpsys->UnregisterDumpsysFunction(static_cast<void*>(&stack_manager_));
     stack_manager_.ShutDown();
     delete stack_thread_;
     is_running_ = false;
@@ -71,4 +71,8 @@ void StackManager::handle_shut_down(std::promise<void> promise) {
   promise.set_value();
 }
 
+void StackManager::Dump(int fd) const {
+  registry_.DumpTimings(fd);
+}
+
 }  // namespace bluetooth
@@ -27,6 +27,9 @@ class StackManager {
   void StartUp(ModuleList *modules, os::Thread* stack_thread);
   void ShutDown();
 
+  // Writes the start and stop timings of the modules
+  void Dump(int fd) const;
+
   template <class T>
   T* GetInstance() const {
     return static_cast<T*>(registry_.Get(&T::Factory));
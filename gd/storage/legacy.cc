@@ -16,7 +16,12 @@
 #define LOG_TAG "bt_storage"
 
 #include "storage/legacy.h"
+
+#include <map>
+#include <mutex>
+
 #include "storage/legacy_osi_config.h"
+#include "storage/property_store.h"
 
 namespace bluetooth {
 namespace storage {
@@ -50,6 +55,15 @@ struct LegacyModule::impl {
         common::BindOnce(std::move(callback), filename, legacy::osi::config::checksum_save(checksum, filename)));
   }
 
+  PropertyStore* get_property_store(const std::string& filename) {
+    std::lock_guard<std::mutex> lock(property_stores_mutex_);
+    auto& property_store = property_stores_[filename];
+    if (!property_store) {
+      property_store = std::make_unique<PropertyStore>(filename, handler_);
+    }
+    return property_store.get();
+  }
+
   void Start();
   void Stop();
 
@@ -58,6 +72,8 @@ struct LegacyModule::impl {
  private:
   const LegacyModule& module_;
   os::Handler* handler_;
+  std::mutex property_stores_mutex_;
+  std::map<std::string, std::unique_ptr<PropertyStore>> property_stores_;
 };
 
 const ModuleFactory storage::LegacyModule::Factory = ModuleFactory([]() { return new storage::LegacyModule(); });
@@ -68,7 +84,11 @@ void storage::LegacyModule::impl::Start() {
   handler_ = module_.GetHandler();
 }
 
-void storage::LegacyModule::impl::Stop() {}
+void storage::LegacyModule::impl::Stop() {
+  // Saves the pending writes
+  std::lock_guard<std::mutex> lock(property_stores_mutex_);
+  property_stores_.clear();
+}
 
 void storage::LegacyModule::ConfigRead(const std::string filename, LegacyReadConfigCallback callback,
                                        os::Handler* handler) {
@@ -94,6 +114,10 @@ void storage::LegacyModule::ChecksumWrite(const std::string filename, const std:
                                       checksum, std::move(callback), handler));
 }
 
+PropertyStore* storage::LegacyModule::GetPropertyStore(const std::string& filename) {
+  return pimpl_->get_property_store(filename);
+}
+
 /**
  * General API here
  */
@@ -27,6 +27,7 @@
 #include "hci/hci_packets.h"
 #include "module.h"
 #include "storage/legacy_osi_config.h"
+#include "storage/property_store.h"
 
 namespace bluetooth {
 namespace storage {
@@ -45,6 +46,10 @@ class LegacyModule : public bluetooth::Module {
   void ChecksumWrite(const std::string filename, const std::string checksum, LegacyWriteChecksumCallback callback,
                      os::Handler* handler);
 
+  // Returns the typed store of |filename|, loaded on the first call. It saves its writes in batches and is flushed when
+  // the module stops.
+  PropertyStore* GetPropertyStore(const std::string& filename);
+
   static const ModuleFactory Factory;
 
   LegacyModule();
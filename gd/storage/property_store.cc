@@ -0,0 +1,600 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "storage/property_store.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include "os/log.h"
+
+namespace bluetooth {
+namespace storage {
+
+namespace {
+
+constexpr char kSnapshotMagic[] = {'B', 'T', 'P', 'S'};
+constexpr uint8_t kSnapshotVersion = 1;
+
+// Identifies the content of the config file that a snapshot was taken from
+struct FileStamp {
+  uint64_t size = 0;
+  uint64_t modification_time_ns = 0;
+};
+
+std::optional<FileStamp> get_file_stamp(const std::string& filename) {
+  struct stat file_stat;
+  if (stat(filename.c_str(), &file_stat) != 0) {
+    return std::nullopt;
+  }
+  FileStamp stamp;
+  stamp.size = file_stat.st_size;
+  stamp.modification_time_ns =
+      static_cast<uint64_t>(file_stat.st_mtim.tv_sec) * 1000000000 + static_cast<uint64_t>(file_stat.st_mtim.tv_nsec);
+  return stamp;
+}
+
+class SnapshotWriter {
+ public:
+  void Write(const void* data, size_t length) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    data_.insert(data_.end(), bytes, bytes + length);
+  }
+
+  template <typename T>
+  void Write(T value) {
+    static_assert(std::is_integral<T>::value, "Only integers are written by value");
+    Write(&value, sizeof(value));
+  }
+
+  void Write(const std::string& text) {
+    Write(static_cast<uint32_t>(text.size()));
+    Write(text.data(), text.size());
+  }
+
+  const std::vector<uint8_t>& GetData() const {
+    return data_;
+  }
+
+ private:
+  std::vector<uint8_t> data_;
+};
+
+// Reads in order from a snapshot, and remembers a read past the end
+class SnapshotReader {
+ public:
+  explicit SnapshotReader(const std::vector<uint8_t>& data) : data_(data) {}
+
+  bool Read(void* to, size_t length) {
+    if (!valid_ || data_.size() - offset_ < length) {
+      valid_ = false;
+      return false;
+    }
+    memcpy(to, data_.data() + offset_, length);
+    offset_ += length;
+    return true;
+  }
+
+  template <typename T>
+  T Read() {
+    static_assert(std::is_integral<T>::value, "Only integers are read by value");
+    T value = 0;
+    Read(&value, sizeof(value));
+    return value;
+  }
+
+  std::string ReadString() {
+    uint32_t length = Read<uint32_t>();
+    if (!valid_ || data_.size() - offset_ < length) {
+      valid_ = false;
+      return std::string();
+    }
+    std::string text(reinterpret_cast<const char*>(data_.data() + offset_), length);
+    offset_ += length;
+    return text;
+  }
+
+  bool IsValid() const {
+    return valid_;
+  }
+
+  bool IsAtEnd() const {
+    return offset_ == data_.size();
+  }
+
+ private:
+  const std::vector<uint8_t>& data_;
+  size_t offset_ = 0;
+  bool valid_ = true;
+};
+
+int hex_digit_value(char digit) {
+  if (digit >= '0' && digit <= '9') return digit - '0';
+  if (digit >= 'a' && digit <= 'f') return digit - 'a' + 10;
+  if (digit >= 'A' && digit <= 'F') return digit - 'A' + 10;
+  return -1;
+}
+
+std::string to_hex(const std::vector<uint8_t>& bin) {
+  static constexpr char kHexDigits[] = "0123456789abcdef";
+  std::string text;
+  text.reserve(bin.size() * 2);
+  for (uint8_t byte : bin) {
+    text.push_back(kHexDigits[byte >> 4]);
+    text.push_back(kHexDigits[byte & 0x0f]);
+  }
+  return text;
+}
+
+}  // namespace
+
+constexpr std::chrono::milliseconds PropertyStore::kSaveDelay;
+
+PropertyStore::PropertyStore(std::string filename, os::Handler* handler)
+    : filename_(std::move(filename)), save_alarm_(handler) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  load();
+}
+
+PropertyStore::~PropertyStore() {
+  save_alarm_.Cancel();
+  Flush();
+}
+
+std::string PropertyStore::GetSnapshotPath(const std::string& filename) {
+  return filename + ".snapshot";
+}
+
+bool PropertyStore::IsLoadedFromSnapshot() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return loaded_from_snapshot_;
+}
+
+bool PropertyStore::HasSection(const std::string& section) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return section_index_.find(section) != section_index_.end();
+}
+
+bool PropertyStore::HasKey(const std::string& section, const std::string& key) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return find_value(section, key) != nullptr;
+}
+
+std::optional<std::string> PropertyStore::GetString(const std::string& section, const std::string& key) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const Value* value = find_value(section, key);
+  if (value == nullptr) {
+    return std::nullopt;
+  }
+  return value->text;
+}
+
+std::optional<int> PropertyStore::GetInt(const std::string& section, const std::string& key) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const Value* value = find_value(section, key);
+  if (value == nullptr) {
+    return std::nullopt;
+  }
+  parse_value(*value, ValueType::INT);
+  if (!value->parsed_valid) {
+    return std::nullopt;
+  }
+  return static_cast<int>(static_cast<int64_t>(value->integer));
+}
+
+std::optional<uint64_t> PropertyStore::GetUint64(const std::string& section, const std::string& key) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const Value* value = find_value(section, key);
+  if (value == nullptr) {
+    return std::nullopt;
+  }
+  parse_value(*value, ValueType::UINT64);
+  if (!value->parsed_valid) {
+    return std::nullopt;
+  }
+  return value->integer;
+}
+
+std::optional<bool> PropertyStore::GetBool(const std::string& section, const std::string& key) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const Value* value = find_value(section, key);
+  if (value == nullptr) {
+    return std::nullopt;
+  }
+  parse_value(*value, ValueType::BOOL);
+  if (!value->parsed_valid) {
+    return std::nullopt;
+  }
+  return value->integer != 0;
+}
+
+std::optional<std::vector<uint8_t>> PropertyStore::GetBin(const std::string& section, const std::string& key) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const Value* value = find_value(section, key);
+  if (value == nullptr) {
+    return std::nullopt;
+  }
+  parse_value(*value, ValueType::BIN);
+  if (!value->parsed_valid) {
+    return std::nullopt;
+  }
+  return value->bin;
+}
+
+void PropertyStore::SetString(const std::string& section, const std::string& key, const std::string& value) {
+  Value new_value;
+  // Same as config_set_string, the file format can't hold a newline in a value
+  new_value.text = value.substr(0, value.find('\n'));
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (set_value(section, key, std::move(new_value))) {
+    schedule_save();
+  }
+}
+
+void PropertyStore::SetInt(const std::string& section, const std::string& key, int value) {
+  Value new_value;
+  new_value.text = std::to_string(value);
+  new_value.parsed_type = ValueType::INT;
+  new_value.integer = static_cast<uint64_t>(static_cast<int64_t>(value));
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (set_value(section, key, std::move(new_value))) {
+    schedule_save();
+  }
+}
+
+void PropertyStore::SetUint64(const std::string& section, const std::string& key, uint64_t value) {
+  Value new_value;
+  new_value.text = std::to_string(value);
+  new_value.parsed_type = ValueType::UINT64;
+  new_value.integer = value;
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (set_value(section, key, std::move(new_value))) {
+    schedule_save();
+  }
+}
+
+void PropertyStore::SetBool(const std::string& section, const std::string& key, bool value) {
+  Value new_value;
+  new_value.text = value ? "true" : "false";
+  new_value.parsed_type = ValueType::BOOL;
+  new_value.integer = value ? 1 : 0;
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (set_value(section, key, std::move(new_value))) {
+    schedule_save();
+  }
+}
+
+void PropertyStore::SetBin(const std::string& section, const std::string& key, const std::vector<uint8_t>& value) {
+  Value new_value;
+  new_value.text = to_hex(value);
+  new_value.parsed_type = ValueType::BIN;
+  new_value.bin = value;
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (set_value(section, key, std::move(new_value))) {
+    schedule_save();
+  }
+}
+
+bool PropertyStore::RemoveKey(const std::string& section, const std::string& key) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto section_it = section_index_.find(section);
+  if (section_it == section_index_.end()) {
+    return false;
+  }
+  Section& found_section = *section_it->second;
+  auto entry_it = found_section.entry_index.find(key);
+  if (entry_it == found_section.entry_index.end()) {
+    return false;
+  }
+  found_section.entries.erase(entry_it->second);
+  found_section.entry_index.erase(entry_it);
+  // Same as config_remove_key, a section without keys is not saved
+  if (found_section.entries.empty()) {
+    sections_.erase(section_it->second);
+    section_index_.erase(section_it);
+  }
+  schedule_save();
+  return true;
+}
+
+bool PropertyStore::RemoveSection(const std::string& section) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto section_it = section_index_.find(section);
+  if (section_it == section_index_.end()) {
+    return false;
+  }
+  sections_.erase(section_it->second);
+  section_index_.erase(section_it);
+  schedule_save();
+  return true;
+}
+
+bool PropertyStore::Flush() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!dirty_) {
+    return true;
+  }
+  save_alarm_.Cancel();
+  std::unique_ptr<config_t> config = ToConfig();
+  if (!legacy::osi::config::config_save(*config, filename_)) {
+    LOG_ERROR("Unable to save %s", filename_.c_str());
+    return false;
+  }
+  dirty_ = false;
+  // The config file is the source of truth, a failed snapshot only makes the next load parse it
+  if (!save_snapshot()) {
+    LOG_WARN("Unable to save the snapshot of %s", filename_.c_str());
+    unlink(GetSnapshotPath(filename_).c_str());
+    return false;
+  }
+  return true;
+}
+
+std::unique_ptr<config_t> PropertyStore::ToConfig() const {
+  auto config = legacy::osi::config::config_new_empty();
+  for (const Section& section : sections_) {
+    section_t config_section{.name = section.name};
+    for (const Entry& entry : section.entries) {
+      config_section.entries.emplace_back(entry_t{.key = entry.key, .value = entry.value.text});
+    }
+    config->sections.push_back(std::move(config_section));
+  }
+  return config;
+}
+
+const PropertyStore::Value* PropertyStore::find_value(const std::string& section, const std::string& key) const {
+  auto section_it = section_index_.find(section);
+  if (section_it == section_index_.end()) {
+    return nullptr;
+  }
+  const Section& found_section = *section_it->second;
+  auto entry_it = found_section.entry_index.find(key);
+  if (entry_it == found_section.entry_index.end()) {
+    return nullptr;
+  }
+  return &entry_it->second->value;
+}
+
+void PropertyStore::parse_value(const Value& value, ValueType type) {
+  if (value.parsed_type == type) {
+    return;
+  }
+  value.parsed_type = type;
+  value.parsed_valid = false;
+  value.integer = 0;
+  value.bin.clear();
+  char* end = nullptr;
+  switch (type) {
+    case ValueType::STRING:
+      value.parsed_valid = true;
+      break;
+    case ValueType::INT: {
+      // Same as config_get_int
+      int integer = strtol(value.text.c_str(), &end, 0);
+      value.integer = static_cast<uint64_t>(static_cast<int64_t>(integer));
+      value.parsed_valid = *end == '\0';
+      break;
+    }
+      break;
+    case ValueType::UINT64:
+      // Same as config_get_uint64
+      value.integer = strtoull(value.text.c_str(), &end, 0);
+      value.parsed_valid = *end == '\0';
+      break;
+    case ValueType::BOOL:
+      // Same as config_get_bool
+      value.parsed_valid = value.text == "true" || value.text == "false";
+      value.integer = value.text == "true" ? 1 : 0;
+      break;
+    case ValueType::BIN:
+      if (value.text.size() % 2 != 0) {
+        break;
+      }
+      value.bin.reserve(value.text.size() / 2);
+      for (size_t i = 0; i < value.text.size(); i += 2) {
+        int high = hex_digit_value(value.text[i]);
+        int low = hex_digit_value(value.text[i + 1]);
+        if (high < 0 || low < 0) {
+          value.bin.clear();
+          return;
+        }
+        value.bin.push_back(static_cast<uint8_t>(high << 4 | low));
+      }
+      value.parsed_valid = true;
+      break;
+  }
+}
+
+bool PropertyStore::set_value(const std::string& section, const std::string& key, Value value) {
+  auto section_it = section_index_.find(section);
+  if (section_it == section_index_.end()) {
+    sections_.emplace_back(Section{.name = section});
+    section_it = section_index_.emplace(section, std::prev(sections_.end())).first;
+  }
+  Section& found_section = *section_it->second;
+  auto entry_it = found_section.entry_index.find(key);
+  if (entry_it != found_section.entry_index.end()) {
+    if (entry_it->second->value.text == value.text) {
+      return false;
+    }
+    entry_it->second->value = std::move(value);
+  } else {
+    found_section.entries.emplace_back(Entry{.key = key, .value = std::move(value)});
+    found_section.entry_index.emplace(key, std::prev(found_section.entries.end()));
+  }
+  return true;
+}
+
+void PropertyStore::clear() {
+  sections_.clear();
+  section_index_.clear();
+}
+
+void PropertyStore::load() {
+  clear();
+  loaded_from_snapshot_ = load_snapshot();
+  if (loaded_from_snapshot_) {
+    return;
+  }
+  clear();
+  std::unique_ptr<config_t> config = legacy::osi::config::config_new(filename_.c_str());
+  if (config) {
+    load_config(*config);
+  }
+}
+
+void PropertyStore::load_config(const config_t& config) {
+  for (const section_t& section : config.sections) {
+    for (const entry_t& entry : section.entries) {
+      Value value;
+      value.text = entry.value;
+      set_value(section.name, entry.key, std::move(value));
+    }
+  }
+}
+
+bool PropertyStore::load_snapshot() {
+  auto stamp = get_file_stamp(filename_);
+  if (!stamp) {
+    return false;
+  }
+  std::ifstream snapshot_file(GetSnapshotPath(filename_), std::ios::binary);
+  if (!snapshot_file.is_open()) {
+    return false;
+  }
+  std::vector<uint8_t> data((std::istreambuf_iterator<char>(snapshot_file)), std::istreambuf_iterator<char>());
+  SnapshotReader reader(data);
+  char magic[sizeof(kSnapshotMagic)];
+  if (!reader.Read(magic, sizeof(magic)) || memcmp(magic, kSnapshotMagic, sizeof(magic)) != 0 ||
+      reader.Read<uint8_t>() != kSnapshotVersion) {
+    LOG_WARN("Unknown snapshot format for %s", filename_.c_str());
+    return false;
+  }
+  uint64_t size = reader.Read<uint64_t>();
+  uint64_t modification_time_ns = reader.Read<uint64_t>();
+  if (size != stamp->size || modification_time_ns != stamp->modification_time_ns) {
+    LOG_INFO("Snapshot of %s is out of date", filename_.c_str());
+    return false;
+  }
+
+  uint32_t section_count = reader.Read<uint32_t>();
+  for (uint32_t i = 0; i < section_count && reader.IsValid(); i++) {
+    std::string section_name = reader.ReadString();
+    uint32_t entry_count = reader.Read<uint32_t>();
+    for (uint32_t j = 0; j < entry_count && reader.IsValid(); j++) {
+      std::string key = reader.ReadString();
+      Value value;
+      value.text = reader.ReadString();
+      value.parsed_type = static_cast<ValueType>(reader.Read<uint8_t>());
+      value.parsed_valid = reader.Read<uint8_t>() != 0;
+      switch (value.parsed_type) {
+        case ValueType::STRING:
+          break;
+        case ValueType::INT:
+        case ValueType::UINT64:
+        case ValueType::BOOL:
+          value.integer = reader.Read<uint64_t>();
+          break;
+        case ValueType::BIN: {
+          std::string bin = reader.ReadString();
+          value.bin.assign(bin.begin(), bin.end());
+          break;
+        }
+        default:
+          LOG_WARN("Unknown value type in the snapshot of %s", filename_.c_str());
+          return false;
+      }
+      set_value(section_name, key, std::move(value));
+    }
+  }
+  if (!reader.IsValid() || !reader.IsAtEnd()) {
+    LOG_WARN("Malformed snapshot of %s", filename_.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool PropertyStore::save_snapshot() const {
+  auto stamp = get_file_stamp(filename_);
+  if (!stamp) {
+    return false;
+  }
+  SnapshotWriter writer;
+  writer.Write(kSnapshotMagic, sizeof(kSnapshotMagic));
+  writer.Write(kSnapshotVersion);
+  writer.Write(stamp->size);
+  writer.Write(stamp->modification_time_ns);
+  writer.Write(static_cast<uint32_t>(sections_.size()));
+  for (const Section& section : sections_) {
+    writer.Write(section.name);
+    writer.Write(static_cast<uint32_t>(section.entries.size()));
+    for (const Entry& entry : section.entries) {
+      const Value& value = entry.value;
+      writer.Write(entry.key);
+      writer.Write(value.text);
+      writer.Write(static_cast<uint8_t>(value.parsed_type));
+      writer.Write(static_cast<uint8_t>(value.parsed_valid ? 1 : 0));
+      switch (value.parsed_type) {
+        case ValueType::STRING:
+          break;
+        case ValueType::INT:
+        case ValueType::UINT64:
+        case ValueType::BOOL:
+          writer.Write(value.integer);
+          break;
+        case ValueType::BIN:
+          writer.Write(std::string(value.bin.begin(), value.bin.end()));
+          break;
+      }
+    }
+  }
+
+  // Same as config_save, write a temporary file and rename it so that a crash never leaves a partial snapshot
+  const std::string snapshot_path = GetSnapshotPath(filename_);
+  const std::string temp_path = snapshot_path + ".new";
+  FILE* fp = fopen(temp_path.c_str(), "wb");
+  if (fp == nullptr) {
+    LOG_ERROR("Unable to write %s: %s", temp_path.c_str(), strerror(errno));
+    return false;
+  }
+  const auto& data = writer.GetData();
+  bool written = fwrite(data.data(), 1, data.size(), fp) == data.size() && fflush(fp) == 0 && fsync(fileno(fp)) == 0;
+  written &= fclose(fp) == 0;
+  if (!written || rename(temp_path.c_str(), snapshot_path.c_str()) != 0) {
+    LOG_ERROR("Unable to save %s: %s", snapshot_path.c_str(), strerror(errno));
+    unlink(temp_path.c_str());
+    return false;
+  }
+  return true;
+}
+
+void PropertyStore::schedule_save() {
+  // The writes until the save are saved with the first one
+  if (dirty_) {
+    return;
+  }
+  dirty_ = true;
+  save_alarm_.Schedule([this]() { Flush(); }, kSaveDelay);
+}
+
+}  // namespace storage
+}  // namespace bluetooth
@@ -0,0 +1,131 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "os/alarm.h"
+#include "os/handler.h"
+#include "storage/legacy_osi_config.h"
+
+namespace bluetooth {
+namespace storage {
+
+// A typed in-memory copy of a config file, for read-mostly properties such as link keys and LTKs.
+//
+// Each value keeps its text form, written back to the config file, next to its typed form. A value is parsed at most
+// once: when it is first read with a type, and never when it was set with that type or restored from the binary
+// snapshot. The first write after a save schedules the next one kSaveDelay later, which saves all of the writes until
+// then to both the config file and the binary snapshot next to it. When the snapshot matches the config file, loading
+// it skips the text parsing altogether.
+//
+// All methods are thread safe.
+class PropertyStore {
+ public:
+  static constexpr std::chrono::milliseconds kSaveDelay = std::chrono::milliseconds(3000);
+
+  // Loads |filename|, or its snapshot when it is up to date. Saves are scheduled on |handler|.
+  PropertyStore(std::string filename, os::Handler* handler);
+  ~PropertyStore();
+
+  // Returns the path of the binary snapshot of |filename|
+  static std::string GetSnapshotPath(const std::string& filename);
+
+  // Whether the last load used the binary snapshot
+  bool IsLoadedFromSnapshot() const;
+
+  bool HasSection(const std::string& section) const;
+  bool HasKey(const std::string& section, const std::string& key) const;
+
+  std::optional<std::string> GetString(const std::string& section, const std::string& key) const;
+  std::optional<int> GetInt(const std::string& section, const std::string& key) const;
+  std::optional<uint64_t> GetUint64(const std::string& section, const std::string& key) const;
+  std::optional<bool> GetBool(const std::string& section, const std::string& key) const;
+  // Binary values are stored as hex strings in the config file
+  std::optional<std::vector<uint8_t>> GetBin(const std::string& section, const std::string& key) const;
+
+  void SetString(const std::string& section, const std::string& key, const std::string& value);
+  void SetInt(const std::string& section, const std::string& key, int value);
+  void SetUint64(const std::string& section, const std::string& key, uint64_t value);
+  void SetBool(const std::string& section, const std::string& key, bool value);
+  void SetBin(const std::string& section, const std::string& key, const std::vector<uint8_t>& value);
+
+  bool RemoveKey(const std::string& section, const std::string& key);
+  bool RemoveSection(const std::string& section);
+
+  // Saves the pending writes now, returns false if either file could not be written
+  bool Flush();
+
+  // Returns a copy in the config_t form, in file order
+  std::unique_ptr<config_t> ToConfig() const;
+
+ private:
+  enum class ValueType : uint8_t { STRING, INT, UINT64, BOOL, BIN };
+
+  struct Value {
+    std::string text;
+    // The type |text| was last parsed as, or set with
+    mutable ValueType parsed_type = ValueType::STRING;
+    // Whether |text| is valid for |parsed_type|
+    mutable bool parsed_valid = true;
+    // The INT, UINT64 and BOOL forms
+    mutable uint64_t integer = 0;
+    mutable std::vector<uint8_t> bin;
+  };
+
+  struct Entry {
+    std::string key;
+    Value value;
+  };
+
+  struct Section {
+    std::string name;
+    std::list<Entry> entries;
+    std::unordered_map<std::string, std::list<Entry>::iterator> entry_index;
+  };
+
+  const Value* find_value(const std::string& section, const std::string& key) const;
+  // Parses |value| as |type| unless it already was
+  static void parse_value(const Value& value, ValueType type);
+  // Returns whether the text of the value changed
+  bool set_value(const std::string& section, const std::string& key, Value value);
+  void clear();
+  void load();
+  void load_config(const config_t& config);
+  bool load_snapshot();
+  bool save_snapshot() const;
+  void schedule_save();
+
+  const std::string filename_;
+  mutable std::mutex mutex_;
+  // Sections in file order, with an index by name
+  std::list<Section> sections_;
+  std::unordered_map<std::string, std::list<Section>::iterator> section_index_;
+  bool loaded_from_snapshot_ = false;
+  bool dirty_ = false;
+  os::Alarm save_alarm_;
+};
+
+}  // namespace storage
+}  // namespace bluetooth
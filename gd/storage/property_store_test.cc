@@ -0,0 +1,157 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "storage/property_store.h"
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+
+#include "os/handler.h"
+#include "os/thread.h"
+
+namespace bluetooth {
+namespace storage {
+namespace {
+
+constexpr char kConfigContent[] =
+    "[Adapter]\n"
+    "Address = 01:02:03:04:05:06\n"
+    "DiscoveryTimeout = 120\n"
+    "[aa:bb:cc:dd:ee:ff]\n"
+    "LinkKey = 00112233445566778899AABBCCDDEEFF\n"
+    "DevType = 0x1\n"
+    "Bonded = true\n"
+    "HiSyncId = 18446744073709551615\n";
+
+class PropertyStoreTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    thread_ = new os::Thread("test_thread", os::Thread::Priority::NORMAL);
+    handler_ = new os::Handler(thread_);
+    filename_ = ::testing::TempDir() + "property_store_test_" + std::to_string(getpid()) + ".conf";
+    RemoveFiles();
+    WriteConfig(kConfigContent);
+  }
+
+  void TearDown() override {
+    RemoveFiles();
+    handler_->Clear();
+    delete handler_;
+    delete thread_;
+  }
+
+  void WriteConfig(const std::string& content) {
+    std::ofstream config_file(filename_, std::ios::trunc);
+    config_file << content;
+  }
+
+  void RemoveFiles() {
+    std::remove(filename_.c_str());
+    std::remove(PropertyStore::GetSnapshotPath(filename_).c_str());
+  }
+
+  std::unique_ptr<PropertyStore> OpenStore() {
+    return std::make_unique<PropertyStore>(filename_, handler_);
+  }
+
+  os::Thread* thread_ = nullptr;
+  os::Handler* handler_ = nullptr;
+  std::string filename_;
+};
+
+TEST_F(PropertyStoreTest, typed_reads_of_config_file) {
+  auto store = OpenStore();
+  EXPECT_FALSE(store->IsLoadedFromSnapshot());
+  EXPECT_TRUE(store->HasSection("Adapter"));
+  EXPECT_EQ(store->GetString("Adapter", "Address"), "01:02:03:04:05:06");
+  EXPECT_EQ(store->GetInt("Adapter", "DiscoveryTimeout"), 120);
+  EXPECT_EQ(store->GetInt("aa:bb:cc:dd:ee:ff", "DevType"), 1);
+  EXPECT_EQ(store->GetBool("aa:bb:cc:dd:ee:ff", "Bonded"), true);
+  EXPECT_EQ(store->GetUint64("aa:bb:cc:dd:ee:ff", "HiSyncId"), UINT64_MAX);
+  EXPECT_EQ(store->GetBin("aa:bb:cc:dd:ee:ff", "LinkKey"),
+            (std::vector<uint8_t>{0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd,
+                                  0xee, 0xff}));
+}
+
+TEST_F(PropertyStoreTest, reads_of_the_wrong_type_fail) {
+  auto store = OpenStore();
+  EXPECT_FALSE(store->GetInt("Adapter", "Address"));
+  EXPECT_FALSE(store->GetBool("Adapter", "DiscoveryTimeout"));
+  EXPECT_FALSE(store->GetBin("Adapter", "Address"));
+  EXPECT_FALSE(store->GetInt("Adapter", "Missing"));
+  // A failed read doesn't prevent reading the value as another type
+  EXPECT_EQ(store->GetString("Adapter", "Address"), "01:02:03:04:05:06");
+}
+
+TEST_F(PropertyStoreTest, flush_writes_config_file_and_snapshot) {
+  auto store = OpenStore();
+  store->SetBin("11:22:33:44:55:66", "LE_KEY_PENC", {0xde, 0xad, 0xbe, 0xef});
+  store->SetInt("Adapter", "DiscoveryTimeout", 60);
+  store->SetBool("11:22:33:44:55:66", "Bonded", false);
+  EXPECT_TRUE(store->RemoveKey("aa:bb:cc:dd:ee:ff", "DevType"));
+  EXPECT_TRUE(store->Flush());
+
+  auto config = legacy::osi::config::config_new(filename_.c_str());
+  ASSERT_NE(config, nullptr);
+  EXPECT_EQ(*legacy::osi::config::config_get_string(*config, "11:22:33:44:55:66", "LE_KEY_PENC", nullptr),
+            "deadbeef");
+  EXPECT_EQ(legacy::osi::config::config_get_int(*config, "Adapter", "DiscoveryTimeout", 0), 60);
+  EXPECT_FALSE(legacy::osi::config::config_has_key(*config, "aa:bb:cc:dd:ee:ff", "DevType"));
+
+  auto reloaded_store = OpenStore();
+  EXPECT_TRUE(reloaded_store->IsLoadedFromSnapshot());
+  EXPECT_EQ(reloaded_store->GetBin("11:22:33:44:55:66", "LE_KEY_PENC"), (std::vector<uint8_t>{0xde, 0xad, 0xbe, 0xef}));
+  EXPECT_EQ(reloaded_store->GetInt("Adapter", "DiscoveryTimeout"), 60);
+  EXPECT_EQ(reloaded_store->GetBool("11:22:33:44:55:66", "Bonded"), false);
+  EXPECT_FALSE(reloaded_store->HasKey("aa:bb:cc:dd:ee:ff", "DevType"));
+  EXPECT_EQ(reloaded_store->GetString("aa:bb:cc:dd:ee:ff", "LinkKey"), "00112233445566778899AABBCCDDEEFF");
+}
+
+TEST_F(PropertyStoreTest, outdated_snapshot_is_ignored) {
+  {
+    auto store = OpenStore();
+    store->SetInt("Adapter", "DiscoveryTimeout", 60);
+    EXPECT_TRUE(store->Flush());
+  }
+  WriteConfig("[Adapter]\nDiscoveryTimeout = 30\n");
+  auto store = OpenStore();
+  EXPECT_FALSE(store->IsLoadedFromSnapshot());
+  EXPECT_EQ(store->GetInt("Adapter", "DiscoveryTimeout"), 30);
+  EXPECT_FALSE(store->HasSection("aa:bb:cc:dd:ee:ff"));
+}
+
+TEST_F(PropertyStoreTest, destruction_saves_pending_writes) {
+  OpenStore()->SetString("Adapter", "Name", "name");
+  auto store = OpenStore();
+  EXPECT_EQ(store->GetString("Adapter", "Name"), "name");
+}
+
+TEST_F(PropertyStoreTest, removing_last_key_removes_section) {
+  auto store = OpenStore();
+  store->SetInt("11:22:33:44:55:66", "DevType", 2);
+  EXPECT_TRUE(store->RemoveKey("11:22:33:44:55:66", "DevType"));
+  EXPECT_FALSE(store->HasSection("11:22:33:44:55:66"));
+  EXPECT_FALSE(store->RemoveSection("11:22:33:44:55:66"));
+  EXPECT_TRUE(store->RemoveSection("aa:bb:cc:dd:ee:ff"));
+  EXPECT_FALSE(store->HasKey("aa:bb:cc:dd:ee:ff", "LinkKey"));
+}
+
+}  // namespace
+}  // namespace storage
+}  // namespace bluetooth
@@ -0,0 +1,217 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <base/logging.h>
+#include <benchmark/benchmark.h>
+#include <string.h>
+#include <vector>
+
+#include "device/include/controller.h"
+#include "hci/include/buffer_allocator.h"
+#include "hci/include/hci_internals.h"
+#include "hci/include/packet_fragmenter.h"
+#include "osi/include/allocator.h"
+#include "stack/include/bt_types.h"
+#include "stack/include/hcidefs.h"
+#include "stack/include/l2cdefs.h"
+
+using ::benchmark::State;
+
+namespace {
+
+constexpr uint16_t kHandle = 0x0042;
+constexpr uint16_t kCid = 0x0040;
+// Typical controller buffer sizes
+constexpr uint16_t kAclDataSizeClassic = 1021;
+constexpr uint16_t kAclDataSizeBle = 251;
+
+uint16_t get_acl_data_size_classic() { return kAclDataSizeClassic; }
+uint16_t get_acl_data_size_ble() { return kAclDataSizeBle; }
+
+controller_t fake_controller;
+
+const allocator_t* buffer_allocator;
+
+int g_reassembled_count = 0;
+int g_fragmented_count = 0;
+
+void on_fragmented(BT_HDR* packet, bool send_transmit_finished) {
+  g_fragmented_count++;
+  if (send_transmit_finished) buffer_allocator->free(packet);
+}
+
+void on_reassembled(BT_HDR* packet) {
+  g_reassembled_count++;
+  buffer_allocator->free(packet);
+}
+
+void on_transmit_finished(BT_HDR* packet, bool all_fragments_sent) {
+  buffer_allocator->free(packet);
+}
+
+const packet_fragmenter_t* fragmenter;
+
+void on_reassembled_chain(acl_packet_chain_t* chain) {
+  g_reassembled_count++;
+  fragmenter->free_chain(chain);
+}
+
+const packet_fragmenter_callbacks_t flat_callbacks = {
+    .fragmented = on_fragmented,
+    .reassembled = on_reassembled,
+    .transmit_finished = on_transmit_finished,
+};
+
+const packet_fragmenter_callbacks_t chain_callbacks = {
+    .fragmented = on_fragmented,
+    .reassembled = on_reassembled,
+    .transmit_finished = on_transmit_finished,
+    .reassembled_chain = on_reassembled_chain,
+};
+
+// Splits an L2CAP PDU carrying |payload_size| bytes into the ACL packets a
+// controller with |kAclDataSizeClassic| buffers would deliver.
+std::vector<std::vector<uint8_t>> MakeIncomingFragments(size_t payload_size) {
+  std::vector<uint8_t> pdu(L2CAP_PKT_OVERHEAD + payload_size);
+  uint8_t* p = pdu.data();
+  UINT16_TO_STREAM(p, payload_size);
+  UINT16_TO_STREAM(p, kCid);
+  for (size_t i = 0; i < payload_size; i++) *p++ = i;
+
+  std::vector<std::vector<uint8_t>> fragments;
+  for (size_t offset = 0; offset < pdu.size();
+       offset += kAclDataSizeClassic) {
+    size_t length = std::min<size_t>(kAclDataSizeClassic, pdu.size() - offset);
+    std::vector<uint8_t> fragment(HCI_ACL_PREAMBLE_SIZE + length);
+    uint8_t* f = fragment.data();
+    uint16_t pb_flag = offset == 0 ? L2CAP_PKT_START : L2CAP_PKT_CONTINUE;
+    UINT16_TO_STREAM(f, kHandle | (pb_flag << L2CAP_PKT_TYPE_SHIFT));
+    UINT16_TO_STREAM(f, length);
+    memcpy(f, pdu.data() + offset, length);
+    fragments.push_back(std::move(fragment));
+  }
+  return fragments;
+}
+
+BT_HDR* MakePacket(const std::vector<uint8_t>& bytes, uint16_t event) {
+  BT_HDR* packet =
+      static_cast<BT_HDR*>(buffer_allocator->alloc(sizeof(BT_HDR) +
+                                                   bytes.size()));
+  packet->event = event;
+  packet->len = bytes.size();
+  packet->offset = 0;
+  packet->layer_specific = 0;
+  memcpy(packet->data, bytes.data(), bytes.size());
+  return packet;
+}
+
+}  // namespace
+
+// Needed for linkage
+const controller_t* controller_get_interface() { return &fake_controller; }
+
+class BM_PacketFragmenter : public ::benchmark::Fixture {
+ protected:
+  void SetUp(State& st) override {
+    ::benchmark::Fixture::SetUp(st);
+    fake_controller.get_acl_data_size_classic = get_acl_data_size_classic;
+    fake_controller.get_acl_data_size_ble = get_acl_data_size_ble;
+    buffer_allocator = buffer_allocator_get_interface();
+    fragmenter = packet_fragmenter_get_test_interface(&fake_controller,
+                                                      buffer_allocator);
+    g_reassembled_count = 0;
+    g_fragmented_count = 0;
+  }
+
+  void TearDown(State& st) override {
+    fragmenter->cleanup();
+    ::benchmark::Fixture::TearDown(st);
+  }
+
+  void RunReassembly(State& state) {
+    auto fragments = MakeIncomingFragments(state.range(0));
+    for (auto _ : state) {
+      for (const auto& fragment : fragments) {
+        fragmenter->reassemble_and_dispatch(
+            MakePacket(fragment, MSG_HC_TO_STACK_HCI_ACL));
+      }
+    }
+    CHECK_EQ(g_reassembled_count, static_cast<int>(state.iterations()));
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+  }
+};
+
+BENCHMARK_DEFINE_F(BM_PacketFragmenter, reassemble_flat)(State& state) {
+  fragmenter->init(&flat_callbacks);
+  RunReassembly(state);
+}
+
+BENCHMARK_REGISTER_F(BM_PacketFragmenter, reassemble_flat)
+    ->Arg(64)
+    ->Arg(672)
+    ->Arg(1017)
+    ->Arg(2 * kAclDataSizeClassic)
+    ->Arg(3 * kAclDataSizeClassic);
+
+BENCHMARK_DEFINE_F(BM_PacketFragmenter, reassemble_chain)(State& state) {
+  fragmenter->init(&chain_callbacks);
+  RunReassembly(state);
+}
+
+BENCHMARK_REGISTER_F(BM_PacketFragmenter, reassemble_chain)
+    ->Arg(64)
+    ->Arg(672)
+    ->Arg(1017)
+    ->Arg(2 * kAclDataSizeClassic)
+    ->Arg(3 * kAclDataSizeClassic);
+
+BENCHMARK_DEFINE_F(BM_PacketFragmenter, fragment)(State& state) {
+  fragmenter->init(&flat_callbacks);
+  std::vector<uint8_t> outgoing(HCI_ACL_PREAMBLE_SIZE + L2CAP_PKT_OVERHEAD +
+                                state.range(0));
+  uint8_t* p = outgoing.data();
+  UINT16_TO_STREAM(p, kHandle);
+  UINT16_TO_STREAM(p, outgoing.size() - HCI_ACL_PREAMBLE_SIZE);
+  UINT16_TO_STREAM(p, state.range(0));
+  UINT16_TO_STREAM(p, kCid);
+
+  for (auto _ : state) {
+    fragmenter->fragment_and_dispatch(
+        MakePacket(outgoing, MSG_STACK_TO_HC_HCI_ACL |
+                                 LOCAL_BR_EDR_CONTROLLER_ID));
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+  state.counters["fragments"] = ::benchmark::Counter(
+      g_fragmented_count, ::benchmark::Counter::kAvgIterations);
+}
+
+BENCHMARK_REGISTER_F(BM_PacketFragmenter, fragment)
+    ->Arg(64)
+    ->Arg(672)
+    ->Arg(2 * kAclDataSizeClassic)
+    ->Arg(3 * kAclDataSizeClassic);
+
+int main(int argc, char** argv) {
+  // Disable LOG() output from libchrome
+  logging::LoggingSettings log_settings;
+  log_settings.logging_dest = logging::LoggingDestination::LOG_NONE;
+  CHECK(logging::InitLogging(log_settings)) << "Failed to set up logging";
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  ::benchmark::RunSpecifiedBenchmarks();
+}
@@ -101,3 +101,7 @@ void post_to_main_message_loop(const base::Location& from_here, BT_HDR* p_msg);
 
 void hci_layer_cleanup_interface();
 bool hci_is_root_inflammation_event_received();
+
+// Dump the commands waiting for a credit, and the queue wait and round trip
+// time of the commands sent, per opcode
+void hci_layer_debug_dump(int fd);
@@ -0,0 +1,54 @@
+/******************************************************************************
+ *
+ *  Copyright 2020 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+
+#include "bt_types.h"
+
+// Emulated controller replaying a full (unfiltered) btsnoop log, so that a
+// recorded workload can be run through the stack on a workstation.
+//
+// The events and data the controller sent in the log are fed to the HCI layer
+// in their recorded order. Each is fed once the host has sent at least as many
+// commands as it had before it in the log, so that a Connection Complete comes
+// after the Create Connection, or after a stall timeout if the host diverged.
+// The commands the host sends get the recorded Command Complete or Command
+// Status of their opcode, in order, and a bare success once the log has none
+// left. The data the host sends is acknowledged right away with Number Of
+// Completed Packets; the recorded ones are dropped.
+
+// Loads the log at |path| and starts feeding it. If |paced|, the packets are
+// fed no earlier than their recorded time since the first one, otherwise as
+// fast as the host takes them. Returns false if the log can't be read.
+bool hci_replay_open(const char* path, bool paced);
+
+// Stops the replay, even if the log has not been fed entirely.
+void hci_replay_close(void);
+
+// Takes the place of the controller transport. Does not take ownership of
+// |packet|.
+void hci_replay_transmit(BT_HDR* packet);
+
+// Returns true once all the packets of the log were fed.
+bool hci_replay_is_done(void);
+
+// Dump the progress of the replay, the latency of the reactions of the host,
+// and the CPU time of each thread of the stack during the replay
+void hci_replay_debug_dump(int fd);
@@ -21,9 +21,25 @@
 #include "bt_types.h"
 #include "hci_layer.h"
 #include "osi/include/allocator.h"
+#include "osi/include/list.h"
+
+// A reassembled ACL packet kept as the list of received fragments instead of
+// being copied into a single buffer. Each fragment's valid data is
+// |len| bytes at |data + offset|; concatenated in order they form the same
+// bytes a flat reassembled packet would contain. The first fragment carries
+// the ACL header, with its length rewritten to the full ACL payload length,
+// followed by the L2CAP header. Continuation fragments have their ACL header
+// skipped through |offset|.
+typedef struct {
+  uint16_t handle;
+  uint16_t event;    // |event| of the first fragment
+  uint32_t len;      // Total length over all fragments
+  list_t* fragments; // of BT_HDR*, owned by the chain
+} acl_packet_chain_t;
 
 typedef void (*transmit_finished_cb)(BT_HDR* packet, bool all_fragments_sent);
 typedef void (*packet_reassembled_cb)(BT_HDR* packet);
+typedef void (*packet_chain_reassembled_cb)(acl_packet_chain_t* chain);
 typedef void (*packet_fragmented_cb)(BT_HDR* packet,
                                      bool send_transmit_finished);
 
@@ -37,6 +53,12 @@ typedef struct {
   // Called when the fragmenter finishes sending all requested fragments,
   // but the packet has not been entirely sent.
   transmit_finished_cb transmit_finished;
+
+  // Optional. If set, ACL packets spanning several fragments are handed over
+  // as a chain of the received fragments instead of being copied into one
+  // buffer through |reassembled|, and are not limited to
+  // BT_DEFAULT_BUFFER_SIZE. Ownership of the chain passes to the callee.
+  packet_chain_reassembled_cb reassembled_chain;
 } packet_fragmenter_callbacks_t;
 
 typedef struct packet_fragmenter_t {
@@ -55,6 +77,14 @@ typedef struct packet_fragmenter_t {
   // callback is called
   // with the reassembled data.
   void (*reassemble_and_dispatch)(BT_HDR* packet);
+
+  // Copies |chain| into a single buffer from the buffer allocator and frees
+  // the chain. Returns NULL if the packet does not fit in a buffer, in which
+  // case the chain is freed as well.
+  BT_HDR* (*flatten_chain)(acl_packet_chain_t* chain);
+
+  // Frees |chain| and all of its fragments.
+  void (*free_chain)(acl_packet_chain_t* chain);
 } packet_fragmenter_t;
 
 const packet_fragmenter_t* packet_fragmenter_get_interface();
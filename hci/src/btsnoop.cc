@@ -31,13 +31,19 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/prctl.h>
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <sys/uio.h>
 #include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <mutex>
+#include <thread>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include "bt_types.h"
 #include "common/time_util.h"
@@ -90,12 +96,149 @@ static const size_t RFC_EVENT_OFFSET = 9;
 // a filtered packet.
 static const uint32_t L2C_HEADER_SIZE = 9;
 
+// Capacity of each capture ring. Must be a power of two.
+static const size_t CAPTURE_RING_SIZE = 256 * 1024;
+
+// The writer thread flushes at least this often, and immediately once a ring
+// is half full.
+static const std::chrono::milliseconds WRITER_FLUSH_INTERVAL(20);
+
+// Size of the buffer the writer thread accumulates records in before handing
+// them to write() and btsnoop_net in one go.
+static const size_t WRITER_BATCH_SIZE = 64 * 1024;
+
+static const char* WRITER_THREAD_NAME = "bt_snoop_writer";
+
+// Only accessed from start_up/shut_down and the writer thread.
 static int logfile_fd = INVALID_FD;
 static std::mutex btsnoop_mutex;
 
 static int32_t packets_per_file;
 static int32_t packet_counter;
 
+typedef struct {
+  uint32_t length_original;
+  uint32_t length_captured;
+  uint32_t flags;
+  uint32_t dropped_packets;
+  uint64_t timestamp;
+  uint8_t type;
+} __attribute__((__packed__)) btsnoop_header_t;
+
+// Prefix of every record queued in a CaptureRing. It is followed by
+// |length| bytes: a btsnoop_header_t and the (possibly truncated) packet.
+typedef struct {
+  uint32_t length;
+  uint64_t timestamp_us;
+} capture_record_t;
+
+// Byte ring buffer carrying captured packets to the writer thread, which is
+// its only consumer. Producers serialize on a spinlock, which is uncontended
+// in practice since each direction has its own ring: outgoing packets are
+// captured on the HCI thread and incoming packets on the HAL receive thread.
+class CaptureRing {
+ public:
+  // Allocates the buffer on first use and empties the ring. Must be called
+  // with the producer lock held and the writer thread stopped.
+  void Reset() {
+    if (buffer_.empty()) buffer_.resize(CAPTURE_RING_SIZE);
+    head_ = 0;
+    tail_ = 0;
+  }
+
+  void LockProducer() {
+    while (producer_lock_.test_and_set(std::memory_order_acquire))
+      std::this_thread::yield();
+  }
+
+  void UnlockProducer() { producer_lock_.clear(std::memory_order_release); }
+
+  // Producer side, must hold the producer lock. Returns false if the record
+  // does not fit.
+  bool Push(uint64_t timestamp_us, const btsnoop_header_t& header,
+            const uint8_t* packet, size_t packet_length) {
+    capture_record_t record = {
+        static_cast<uint32_t>(sizeof(header) + packet_length), timestamp_us};
+    size_t total = sizeof(record) + record.length;
+
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    uint64_t tail = tail_.load(std::memory_order_acquire);
+    if (buffer_.size() - (head - tail) < total) return false;
+
+    CopyIn(head, &record, sizeof(record));
+    CopyIn(head + sizeof(record), &header, sizeof(header));
+    CopyIn(head + sizeof(record) + sizeof(header), packet, packet_length);
+    head_.store(head + total, std::memory_order_release);
+    return true;
+  }
+
+  // Producer side. Returns true once the ring is worth flushing early.
+  bool IsHalfFull() const {
+    return (head_.load(std::memory_order_relaxed) -
+            tail_.load(std::memory_order_relaxed)) > buffer_.size() / 2;
+  }
+
+  // Consumer side. Returns false if the ring is empty.
+  bool PeekTimestamp(uint64_t* timestamp_us) const {
+    uint64_t tail = tail_.load(std::memory_order_relaxed);
+    if (head_.load(std::memory_order_acquire) == tail) return false;
+
+    capture_record_t record;
+    CopyOut(tail, &record, sizeof(record));
+    *timestamp_us = record.timestamp_us;
+    return true;
+  }
+
+  // Consumer side, ring must not be empty. Appends the header and packet of
+  // the oldest record to |out|.
+  void Pop(std::vector<uint8_t>* out) {
+    uint64_t tail = tail_.load(std::memory_order_relaxed);
+    capture_record_t record;
+    CopyOut(tail, &record, sizeof(record));
+
+    size_t offset = out->size();
+    out->resize(offset + record.length);
+    CopyOut(tail + sizeof(record), out->data() + offset, record.length);
+    tail_.store(tail + sizeof(record) + record.length,
+                std::memory_order_release);
+  }
+
+ private:
+  void CopyIn(uint64_t position, const void* data, size_t length) {
+    size_t offset = position & (buffer_.size() - 1);
+    size_t first = std::min(length, buffer_.size() - offset);
+    memcpy(&buffer_[offset], data, first);
+    memcpy(&buffer_[0], static_cast<const uint8_t*>(data) + first,
+           length - first);
+  }
+
+  void CopyOut(uint64_t position, void* data, size_t length) const {
+    size_t offset = position & (buffer_.size() - 1);
+    size_t first = std::min(length, buffer_.size() - offset);
+    memcpy(data, &buffer_[offset], first);
+    memcpy(static_cast<uint8_t*>(data) + first, &buffer_[0], length - first);
+  }
+
+  std::vector<uint8_t> buffer_;
+  std::atomic<uint64_t> head_{0};
+  std::atomic<uint64_t> tail_{0};
+  std::atomic_flag producer_lock_ = ATOMIC_FLAG_INIT;
+};
+
+static_assert((CAPTURE_RING_SIZE & (CAPTURE_RING_SIZE - 1)) == 0,
+              "CAPTURE_RING_SIZE must be a power of two");
+
+// Indexed by the |is_received| argument of capture().
+static CaptureRing capture_rings[2];
+static bool capture_active;  // Guarded by the ring producer locks
+static std::atomic<uint32_t> dropped_packets;
+
+static std::thread writer_thread;
+static std::mutex writer_mutex;
+static std::condition_variable writer_cv;
+static bool writer_stop;   // Guarded by |writer_mutex|
+static bool writer_flush;  // Guarded by |writer_mutex|
+
 // Channel tracking variables for filtering.
 
 // Keeps track of L2CAP channels that need to be filtered out of the snoop
@@ -169,8 +312,11 @@ static void delete_btsnoop_files(bool filtered);
 static std::string get_btsnoop_log_path(bool filtered);
 static std::string get_btsnoop_last_log_path(std::string log_path);
 static void open_next_snoop_file();
-static void btsnoop_write_packet(packet_type_t type, uint8_t* packet,
-                                 bool is_received, uint64_t timestamp_us);
+static void btsnoop_queue_packet(CaptureRing* ring, packet_type_t type,
+                                 uint8_t* packet, bool is_received,
+                                 uint64_t timestamp_us);
+static void start_writer();
+static void stop_writer();
 
 // Module lifecycle functions
 
@@ -216,6 +362,7 @@ static future_t* start_up() {
     packets_per_file = osi_property_get_int32(BTSNOOP_MAX_PACKETS_PROPERTY,
                                               DEFAULT_BTSNOOP_SIZE);
     btsnoop_net_open();
+    start_writer();
   }
 
   return NULL;
@@ -224,6 +371,8 @@ static future_t* start_up() {
 static future_t* shut_down(void) {
   std::lock_guard<std::mutex> lock(btsnoop_mutex);
 
+  stop_writer();
+
   if (is_btsnoop_enabled) {
     if (is_btsnoop_filtered) {
       delete_btsnoop_files(false);
@@ -255,8 +404,6 @@ EXPORT_SYMBOL extern const module_t btsnoop_module = {
 static void capture(const BT_HDR* buffer, bool is_received) {
   uint8_t* p = const_cast<uint8_t*>(buffer->data + buffer->offset);
 
-  std::lock_guard<std::mutex> lock(btsnoop_mutex);
-
   struct timespec ts_now = {};
   clock_gettime(CLOCK_REALTIME, &ts_now);
   uint64_t timestamp_us =
@@ -264,24 +411,38 @@ static void capture(const BT_HDR* buffer, bool is_received) {
 
   btsnoop_mem_capture(buffer, timestamp_us);
 
-  if (logfile_fd == INVALID_FD) return;
+  CaptureRing* ring = &capture_rings[is_received];
+  ring->LockProducer();
+  if (!capture_active) {
+    ring->UnlockProducer();
+    return;
+  }
 
   switch (buffer->event & MSG_EVT_MASK) {
     case MSG_HC_TO_STACK_HCI_EVT:
-      btsnoop_write_packet(kEventPacket, p, false, timestamp_us);
+      btsnoop_queue_packet(ring, kEventPacket, p, false, timestamp_us);
       break;
     case MSG_HC_TO_STACK_HCI_ACL:
     case MSG_STACK_TO_HC_HCI_ACL:
-      btsnoop_write_packet(kAclPacket, p, is_received, timestamp_us);
+      btsnoop_queue_packet(ring, kAclPacket, p, is_received, timestamp_us);
       break;
     case MSG_HC_TO_STACK_HCI_SCO:
     case MSG_STACK_TO_HC_HCI_SCO:
-      btsnoop_write_packet(kScoPacket, p, is_received, timestamp_us);
+      btsnoop_queue_packet(ring, kScoPacket, p, is_received, timestamp_us);
       break;
     case MSG_STACK_TO_HC_HCI_CMD:
-      btsnoop_write_packet(kCommandPacket, p, true, timestamp_us);
+      btsnoop_queue_packet(ring, kCommandPacket, p, true, timestamp_us);
       break;
   }
+
+  bool flush = ring->IsHalfFull();
+  ring->UnlockProducer();
+
+  if (flush) {
+    std::lock_guard<std::mutex> lock(writer_mutex);
+    writer_flush = true;
+    writer_cv.notify_one();
+  }
 }
 
 static void whitelist_l2c_channel(uint16_t conn_handle, uint16_t local_cid,
@@ -383,15 +544,6 @@ static void open_next_snoop_file() {
   write(logfile_fd, "btsnoop\0\0\0\0\1\0\0\x3\xea", 16);
 }
 
-typedef struct {
-  uint32_t length_original;
-  uint32_t length_captured;
-  uint32_t flags;
-  uint32_t dropped_packets;
-  uint64_t timestamp;
-  uint8_t type;
-} __attribute__((__packed__)) btsnoop_header_t;
-
 static uint64_t htonll(uint64_t ll) {
   const uint32_t l = 1;
   if (*(reinterpret_cast<const uint8_t*>(&l)) == 1)
@@ -427,8 +579,9 @@ static bool should_filter_log(bool is_received, uint8_t* packet) {
   return false;
 }
 
-static void btsnoop_write_packet(packet_type_t type, uint8_t* packet,
-                                 bool is_received, uint64_t timestamp_us) {
+static void btsnoop_queue_packet(CaptureRing* ring, packet_type_t type,
+                                 uint8_t* packet, bool is_received,
+                                 uint64_t timestamp_us) {
   uint32_t length_he = 0;
   uint32_t flags = 0;
 
@@ -463,21 +616,112 @@ static void btsnoop_write_packet(packet_type_t type, uint8_t* packet,
       blacklisted ? htonl(L2C_HEADER_SIZE) : header.length_original;
   if (blacklisted) length_he = L2C_HEADER_SIZE;
   header.flags = htonl(flags);
-  header.dropped_packets = 0;
+  header.dropped_packets =
+      htonl(dropped_packets.load(std::memory_order_relaxed));
   header.timestamp = htonll(timestamp_us + BTSNOOP_EPOCH_DELTA);
   header.type = type;
 
-  btsnoop_net_write(&header, sizeof(btsnoop_header_t));
-  btsnoop_net_write(packet, length_he - 1);
+  if (!ring->Push(timestamp_us, header, packet, length_he - 1))
+    dropped_packets.fetch_add(1, std::memory_order_relaxed);
+}
 
-  if (logfile_fd != INVALID_FD) {
-    packet_counter++;
-    if (packet_counter > packets_per_file) {
-      open_next_snoop_file();
+// Writer thread
+
+static void flush_batch(std::vector<uint8_t>* batch) {
+  if (batch->empty()) return;
+
+  btsnoop_net_write(batch->data(), batch->size());
+  if (logfile_fd != INVALID_FD)
+    TEMP_FAILURE_RETRY(write(logfile_fd, batch->data(), batch->size()));
+
+  batch->clear();
+}
+
+// Moves every queued record to the log, oldest first across both rings.
+static void drain_capture_rings(std::vector<uint8_t>* batch) {
+  for (;;) {
+    CaptureRing* oldest = nullptr;
+    uint64_t oldest_timestamp_us = 0;
+    for (CaptureRing& ring : capture_rings) {
+      uint64_t timestamp_us;
+      if (ring.PeekTimestamp(&timestamp_us) &&
+          (oldest == nullptr || timestamp_us < oldest_timestamp_us)) {
+        oldest = &ring;
+        oldest_timestamp_us = timestamp_us;
+      }
+    }
+    if (oldest == nullptr) break;
+
+    if (logfile_fd != INVALID_FD) {
+      packet_counter++;
+      if (packet_counter > packets_per_file) {
+        flush_batch(batch);
+        open_next_snoop_file();
+      }
     }
 
-    iovec iov[] = {{&header, sizeof(btsnoop_header_t)},
-                   {reinterpret_cast<void*>(packet), length_he - 1}};
-    TEMP_FAILURE_RETRY(writev(logfile_fd, iov, 2));
+    oldest->Pop(batch);
+    if (batch->size() >= WRITER_BATCH_SIZE) flush_batch(batch);
   }
+
+  flush_batch(batch);
+}
+
+static void writer_loop() {
+  prctl(PR_SET_NAME, (unsigned long)WRITER_THREAD_NAME, 0, 0, 0);
+
+  std::vector<uint8_t> batch;
+  batch.reserve(WRITER_BATCH_SIZE + CAPTURE_RING_SIZE / 2);
+
+  bool stop = false;
+  while (!stop) {
+    {
+      std::unique_lock<std::mutex> lock(writer_mutex);
+      writer_cv.wait_for(lock, WRITER_FLUSH_INTERVAL,
+                         [] { return writer_stop || writer_flush; });
+      writer_flush = false;
+      stop = writer_stop;
+    }
+
+    drain_capture_rings(&batch);
+  }
+}
+
+static void start_writer() {
+  dropped_packets = 0;
+  writer_stop = false;
+  writer_flush = false;
+  for (CaptureRing& ring : capture_rings) {
+    ring.LockProducer();
+    ring.Reset();
+    ring.UnlockProducer();
+  }
+
+  writer_thread = std::thread(writer_loop);
+
+  for (CaptureRing& ring : capture_rings) ring.LockProducer();
+  capture_active = true;
+  for (CaptureRing& ring : capture_rings) ring.UnlockProducer();
+}
+
+static void stop_writer() {
+  if (!writer_thread.joinable()) return;
+
+  // Once both producer locks have been held with capture disabled, no
+  // capture() can be writing to the rings any more.
+  for (CaptureRing& ring : capture_rings) ring.LockProducer();
+  capture_active = false;
+  for (CaptureRing& ring : capture_rings) ring.UnlockProducer();
+
+  {
+    std::lock_guard<std::mutex> lock(writer_mutex);
+    writer_stop = true;
+    writer_cv.notify_one();
+  }
+  writer_thread.join();
+
+  uint32_t dropped = dropped_packets.load();
+  if (dropped != 0)
+    LOG(WARNING) << __func__ << ": dropped " << dropped
+                 << " packets on capture ring overflow";
 }
@@ -27,12 +27,17 @@
 #include <base/threading/thread.h>
 #include <frameworks/base/core/proto/android/bluetooth/hci/enums.pb.h>
 
+#include <inttypes.h>
 #include <signal.h>
+#include <stdio.h>
 #include <string.h>
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <chrono>
+#include <deque>
+#include <map>
 #include <mutex>
 
 #include "btcore/include/module.h"
@@ -68,7 +73,7 @@ extern void hci_log_firmware_debug_packet(int fd, BT_HDR* packet);
 
 static int hci_firmware_log_fd = INVALID_FD;
 
-typedef struct {
+typedef struct waiting_command_t {
   uint16_t opcode;
   future_t* complete_future;
   command_complete_cb complete_callback;
@@ -76,8 +81,31 @@ typedef struct {
   void* context;
   BT_HDR* command;
   std::chrono::time_point<std::chrono::steady_clock> timestamp;
+  std::chrono::time_point<std::chrono::steady_clock> enqueue_timestamp;
+  // Queued commands collapsed into this one, answered along with it
+  struct waiting_command_t* followers;
+  struct waiting_command_t* next_follower;
 } waiting_command_t;
 
+// Priority classes of the commands waiting for a credit. Replies to requests
+// of the controller and link teardown go first, link metric polls last.
+typedef enum {
+  COMMAND_PRIORITY_HIGH,
+  COMMAND_PRIORITY_NORMAL,
+  COMMAND_PRIORITY_LOW,
+  COMMAND_PRIORITY_MAX
+} command_priority_t;
+
+typedef struct {
+  size_t sent;
+  size_t collapsed;
+  size_t responses;
+  uint64_t total_queue_wait_us;
+  uint64_t max_queue_wait_us;
+  uint64_t total_round_trip_us;
+  uint64_t max_round_trip_us;
+} command_stats_t;
+
 // Using a define here, because it can be stringified for the property lookup
 // Default timeout should be less than BLE_START_TIMEOUT and
 // having less than 3 sec would hold the wakelock for init
@@ -91,6 +119,9 @@ static const uint32_t COMMAND_TIMEOUT_RESTART_MS = 5000;
 static const uint32_t ROOT_INFLAMMED_RESTART_MS = 5000;
 static const int HCI_UNKNOWN_COMMAND_TIMED_OUT = 0x00ffffff;
 static const int HCI_STARTUP_TIMED_OUT = 0x00eeeeee;
+// A queued command waiting longer than this goes before the higher priority
+// ones, so that a burst of them can't starve it
+static const uint32_t COMMAND_PRIORITY_AGING_MS = 200;
 
 // Our interface
 static bool interface_created;
@@ -109,7 +140,11 @@ static alarm_t* startup_timer;
 // Outbound-related
 static int command_credits = 1;
 static std::mutex command_credits_mutex;
-static std::queue<base::Closure> command_queue;
+static std::deque<waiting_command_t*> command_queue[COMMAND_PRIORITY_MAX];
+
+// Per opcode statistics, for dumpsys
+static std::mutex command_stats_mutex;
+static std::map<command_opcode_t, command_stats_t> command_stats;
 
 // Inbound-related
 static alarm_t* command_response_timer;
@@ -134,6 +169,8 @@ static void event_finish_startup(void* context);
 static void startup_timer_expired(void* context);
 
 static void enqueue_command(waiting_command_t* wait_entry);
+static waiting_command_t* dequeue_command();
+static void free_waiting_command(waiting_command_t* wait_entry);
 static void event_command_ready(waiting_command_t* wait_entry);
 static void enqueue_packet(void* packet);
 static void event_packet_ready(void* packet);
@@ -143,13 +180,15 @@ static void update_command_response_timer(void);
 
 static void transmit_fragment(BT_HDR* packet, bool send_transmit_finished);
 static void dispatch_reassembled(BT_HDR* packet);
+static void dispatch_reassembled_chain(acl_packet_chain_t* chain);
 static void fragmenter_transmit_finished(BT_HDR* packet,
                                          bool all_fragments_sent);
 static bool filter_bqr_event(int16_t bqr_parameter_length,
                              uint8_t* p_bqr_event);
 
 static const packet_fragmenter_callbacks_t packet_fragmenter_callbacks = {
-    transmit_fragment, dispatch_reassembled, fragmenter_transmit_finished};
+    transmit_fragment, dispatch_reassembled, fragmenter_transmit_finished,
+    dispatch_reassembled_chain};
 
 void initialization_complete() {
   hci_thread.DoInThread(FROM_HERE, base::Bind(&event_finish_startup, nullptr));
@@ -286,6 +325,16 @@ static future_t* hci_module_shut_down() {
     commands_pending_response = NULL;
   }
 
+  {
+    std::lock_guard<std::mutex> command_credits_lock(command_credits_mutex);
+    for (auto& queue : command_queue) {
+      for (waiting_command_t* wait_entry : queue) {
+        free_waiting_command(wait_entry);
+      }
+      queue.clear();
+    }
+  }
+
   packet_fragmenter->cleanup();
 
   if (hci_firmware_log_fd != INVALID_FD) {
@@ -390,23 +439,171 @@ static void startup_timer_expired(UNUSED_ATTR void* context) {
 }
 
 // Command/packet transmitting functions
+static command_priority_t get_command_priority(command_opcode_t opcode) {
+  switch (opcode) {
+    case HCI_DISCONNECT:
+    case HCI_ACCEPT_CONNECTION_REQUEST:
+    case HCI_REJECT_CONNECTION_REQUEST:
+    case HCI_LINK_KEY_REQUEST_REPLY:
+    case HCI_LINK_KEY_REQUEST_NEG_REPLY:
+    case HCI_SET_CONN_ENCRYPTION:
+    case HCI_ACCEPT_ESCO_CONNECTION:
+    case HCI_REJECT_ESCO_CONNECTION:
+    case HCI_BLE_START_ENC:
+    case HCI_BLE_LTK_REQ_REPLY:
+    case HCI_BLE_LTK_REQ_NEG_REPLY:
+    case HCI_BLE_RC_PARAM_REQ_REPLY:
+    case HCI_BLE_RC_PARAM_REQ_NEG_REPLY:
+      return COMMAND_PRIORITY_HIGH;
+    case HCI_READ_RSSI:
+    case HCI_GET_LINK_QUALITY:
+    case HCI_READ_FAILED_CONTACT_COUNTER:
+    case HCI_READ_TRANSMIT_POWER_LEVEL:
+    case HCI_READ_AUTOMATIC_FLUSH_TIMEOUT:
+      return COMMAND_PRIORITY_LOW;
+    default:
+      return COMMAND_PRIORITY_NORMAL;
+  }
+}
+
+// Reads without side effects: a queued one with the same parameters answers
+// for both
+static bool is_command_shareable(command_opcode_t opcode) {
+  return get_command_priority(opcode) == COMMAND_PRIORITY_LOW;
+}
+
+// Commands that only set a state: a queued one right behind the same opcode
+// makes it moot. Only the last command of the queue is superseded, so that
+// the commands that were put between the two still see the first one.
+static bool is_command_superseding(command_opcode_t opcode) {
+  switch (opcode) {
+    case HCI_WRITE_SCAN_ENABLE:
+    case HCI_BLE_WRITE_SCAN_PARAMS:
+    case HCI_BLE_WRITE_SCAN_ENABLE:
+    case HCI_LE_SET_EXTENDED_SCAN_PARAMETERS:
+    case HCI_LE_SET_EXTENDED_SCAN_ENABLE:
+      return true;
+    default:
+      return false;
+  }
+}
+
+static void add_follower(waiting_command_t* wait_entry,
+                         waiting_command_t* follower) {
+  waiting_command_t** tail = &wait_entry->followers;
+  while (*tail != nullptr) tail = &(*tail)->next_follower;
+  // The followers of |follower| were queued before it
+  *tail = follower->followers;
+  while (*tail != nullptr) tail = &(*tail)->next_follower;
+  follower->followers = nullptr;
+  follower->next_follower = nullptr;
+  *tail = follower;
+
+  std::lock_guard<std::mutex> lock(command_stats_mutex);
+  command_stats[follower->opcode].collapsed++;
+}
+
+static bool is_same_command(const waiting_command_t* a,
+                            const waiting_command_t* b) {
+  return a->command->len == b->command->len &&
+         memcmp(a->command->data + a->command->offset,
+                b->command->data + b->command->offset, a->command->len) == 0;
+}
+
+// Puts |wait_entry| in the queue of its priority. Returns true if it was merged
+// with a command already there. Must be called with |command_credits_mutex|
+// held.
+static bool queue_command(waiting_command_t* wait_entry) {
+  std::deque<waiting_command_t*>& queue =
+      command_queue[get_command_priority(wait_entry->opcode)];
+  // Those waiting on a future want a response of their own
+  if (wait_entry->complete_future != nullptr) {
+    queue.push_back(wait_entry);
+    return false;
+  }
+
+  if (is_command_shareable(wait_entry->opcode)) {
+    for (waiting_command_t* queued : queue) {
+      if (queued->opcode == wait_entry->opcode &&
+          queued->complete_future == nullptr &&
+          is_same_command(queued, wait_entry)) {
+        add_follower(queued, wait_entry);
+        return true;
+      }
+    }
+  } else if (is_command_superseding(wait_entry->opcode) && !queue.empty() &&
+             queue.back()->opcode == wait_entry->opcode &&
+             queue.back()->complete_future == nullptr) {
+    waiting_command_t* superseded = queue.back();
+    queue.pop_back();
+    add_follower(wait_entry, superseded);
+    queue.push_back(wait_entry);
+    return true;
+  }
+
+  queue.push_back(wait_entry);
+  return false;
+}
+
 static void enqueue_command(waiting_command_t* wait_entry) {
-  base::Closure callback = base::Bind(&event_command_ready, wait_entry);
+  wait_entry->enqueue_timestamp = std::chrono::steady_clock::now();
 
   std::lock_guard<std::mutex> command_credits_lock(command_credits_mutex);
   if (command_credits > 0) {
-    if (!hci_thread.DoInThread(FROM_HERE, std::move(callback))) {
+    if (!hci_thread.DoInThread(FROM_HERE,
+                               base::Bind(&event_command_ready, wait_entry))) {
       // HCI Layer was shut down or not running
-      buffer_allocator->free(wait_entry->command);
-      osi_free(wait_entry);
+      free_waiting_command(wait_entry);
       return;
     }
     command_credits--;
   } else {
-    command_queue.push(std::move(callback));
+    queue_command(wait_entry);
   }
 }
 
+// Takes the next command to send off the queue: the highest priority one,
+// unless a command has waited for more than COMMAND_PRIORITY_AGING_MS. Must be
+// called with |command_credits_mutex| held.
+static waiting_command_t* dequeue_command() {
+  auto aged = std::chrono::steady_clock::now() -
+              std::chrono::milliseconds(COMMAND_PRIORITY_AGING_MS);
+  int next = -1;
+  for (int i = 0; i < COMMAND_PRIORITY_MAX; i++) {
+    if (command_queue[i].empty()) continue;
+    if (next < 0) next = i;
+    if (command_queue[i].front()->enqueue_timestamp < aged &&
+        command_queue[i].front()->enqueue_timestamp <
+            command_queue[next].front()->enqueue_timestamp) {
+      next = i;
+    }
+  }
+  if (next < 0) return nullptr;
+
+  waiting_command_t* wait_entry = command_queue[next].front();
+  command_queue[next].pop_front();
+  return wait_entry;
+}
+
+static void free_waiting_command(waiting_command_t* wait_entry) {
+  waiting_command_t* follower = wait_entry->followers;
+  while (follower != nullptr) {
+    waiting_command_t* next = follower->next_follower;
+    buffer_allocator->free(follower->command);
+    osi_free(follower);
+    follower = next;
+  }
+  buffer_allocator->free(wait_entry->command);
+  osi_free(wait_entry);
+}
+
+static uint64_t elapsed_us(
+    std::chrono::time_point<std::chrono::steady_clock> since) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now() - since)
+      .count();
+}
+
 static void event_command_ready(waiting_command_t* wait_entry) {
   {
     /// Move it to the list of commands awaiting response
@@ -415,6 +612,14 @@ static void event_command_ready(waiting_command_t* wait_entry) {
     wait_entry->timestamp = std::chrono::steady_clock::now();
     list_append(commands_pending_response, wait_entry);
   }
+  {
+    uint64_t queue_wait_us = elapsed_us(wait_entry->enqueue_timestamp);
+    std::lock_guard<std::mutex> lock(command_stats_mutex);
+    command_stats_t& stats = command_stats[wait_entry->opcode];
+    stats.sent++;
+    stats.total_queue_wait_us += queue_wait_us;
+    stats.max_queue_wait_us = std::max(stats.max_queue_wait_us, queue_wait_us);
+  }
   // Send it off
   packet_fragmenter->fragment_and_dispatch(wait_entry->command);
 
@@ -579,11 +784,14 @@ void process_command_credits(int credits) {
   // Subtract commands in flight.
   command_credits = credits - get_num_waiting_commands();
 
-  while (command_credits > 0 && !command_queue.empty()) {
-    if (!hci_thread.DoInThread(FROM_HERE, std::move(command_queue.front()))) {
+  while (command_credits > 0) {
+    waiting_command_t* wait_entry = dequeue_command();
+    if (wait_entry == nullptr) break;
+    if (!hci_thread.DoInThread(FROM_HERE,
+                               base::Bind(&event_command_ready, wait_entry))) {
       LOG(ERROR) << __func__ << ": failed to enqueue command";
+      free_waiting_command(wait_entry);
     }
-    command_queue.pop();
     command_credits--;
   }
 }
@@ -631,6 +839,42 @@ void handle_root_inflammation_event() {
   }
 }
 
+// Answers the commands collapsed into |wait_entry| with the command complete
+// or status |packet| it got, and frees them
+static void answer_followers(waiting_command_t* wait_entry, BT_HDR* packet,
+                             uint8_t event_code, uint8_t status) {
+  waiting_command_t* follower = wait_entry->followers;
+  wait_entry->followers = nullptr;
+  while (follower != nullptr) {
+    waiting_command_t* next = follower->next_follower;
+    if (event_code == HCI_COMMAND_COMPLETE_EVT) {
+      // The callback owns the packet, so it gets a copy of its own
+      if (follower->complete_callback) {
+        size_t size = BT_HDR_SIZE + packet->offset + packet->len;
+        BT_HDR* copy = static_cast<BT_HDR*>(buffer_allocator->alloc(size));
+        memcpy(copy, packet, size);
+        follower->complete_callback(copy, follower->context);
+      }
+      buffer_allocator->free(follower->command);
+    } else if (follower->status_callback) {
+      follower->status_callback(status, follower->command, follower->context);
+    } else {
+      buffer_allocator->free(follower->command);
+    }
+    osi_free(follower);
+    follower = next;
+  }
+}
+
+static void record_command_response(waiting_command_t* wait_entry) {
+  uint64_t round_trip_us = elapsed_us(wait_entry->timestamp);
+  std::lock_guard<std::mutex> lock(command_stats_mutex);
+  command_stats_t& stats = command_stats[wait_entry->opcode];
+  stats.responses++;
+  stats.total_round_trip_us += round_trip_us;
+  stats.max_round_trip_us = std::max(stats.max_round_trip_us, round_trip_us);
+}
+
 // Returns true if the event was intercepted and should not proceed to
 // higher layers. Also inspects an incoming event for interesting
 // information, like how many commands are now able to be sent.
@@ -662,6 +906,8 @@ static bool filter_incoming_event(BT_HDR* packet) {
       }
     } else {
       update_command_response_timer();
+      record_command_response(wait_entry);
+      answer_followers(wait_entry, packet, event_code, HCI_SUCCESS);
       if (wait_entry->complete_callback) {
         wait_entry->complete_callback(packet, wait_entry->context);
       } else if (wait_entry->complete_future) {
@@ -692,6 +938,8 @@ static bool filter_incoming_event(BT_HDR* packet) {
           __func__, opcode);
     } else {
       update_command_response_timer();
+      record_command_response(wait_entry);
+      answer_followers(wait_entry, packet, event_code, status);
       if (wait_entry->status_callback)
         wait_entry->status_callback(status, wait_entry->command,
                                     wait_entry->context);
@@ -752,6 +1000,16 @@ static void dispatch_reassembled(BT_HDR* packet) {
   send_data_upwards.Run(FROM_HERE, packet);
 }
 
+// Callback for the fragmenter to dispatch up a packet reassembled as a chain
+// of fragments. The upper layers only take contiguous buffers, so the chain
+// is flattened here, once all of its fragments have arrived.
+static void dispatch_reassembled_chain(acl_packet_chain_t* chain) {
+  BT_HDR* packet = packet_fragmenter->flatten_chain(chain);
+  if (packet == NULL) return;
+
+  dispatch_reassembled(packet);
+}
+
 // Misc internal functions
 
 static waiting_command_t* get_waiting_command(command_opcode_t opcode) {
@@ -906,3 +1164,30 @@ const hci_t* hci_layer_get_test_interface(
   init_layer_interface();
   return &interface;
 }
+
+void hci_layer_debug_dump(int fd) {
+  dprintf(fd, "\nHCI Command Queue:\n");
+  {
+    std::lock_guard<std::mutex> command_credits_lock(command_credits_mutex);
+    dprintf(fd, "  credits: %d, queued: high %zu, normal %zu, low %zu\n",
+            command_credits, command_queue[COMMAND_PRIORITY_HIGH].size(),
+            command_queue[COMMAND_PRIORITY_NORMAL].size(),
+            command_queue[COMMAND_PRIORITY_LOW].size());
+  }
+
+  std::lock_guard<std::mutex> lock(command_stats_mutex);
+  if (command_stats.empty()) return;
+  dprintf(fd,
+          "  opcode    sent  collapsed  avg/max wait (us)  "
+          "avg/max round trip (us)\n");
+  for (const auto& entry : command_stats) {
+    const command_stats_t& stats = entry.second;
+    dprintf(fd, "  0x%04x  %6zu  %9zu  %8" PRIu64 "/%-8" PRIu64 "  %10" PRIu64
+            "/%-10" PRIu64 "\n",
+            entry.first, stats.sent, stats.collapsed,
+            stats.sent ? stats.total_queue_wait_us / stats.sent : 0,
+            stats.max_queue_wait_us,
+            stats.responses ? stats.total_round_trip_us / stats.responses : 0,
+            stats.max_round_trip_us);
+  }
+}
@@ -83,8 +83,9 @@ class BluetoothHciCallbacks : public V1_1::IBluetoothHciCallbacks {
     packet->len = data.size();
     packet->layer_specific = 0;
     packet->event = event;
-    // TODO(eisenbach): Avoid copy here; if BT_HDR->data can be ensured to
-    // be the only way the data is accessed, a pointer could be passed here...
+    // |data| points into the HwBinder transaction, which is gone once the
+    // callback returns, so this is the one copy a received packet takes: the
+    // BT_HDR comes from the pool behind osi_malloc() and is handed up as is.
     memcpy(packet->data, data.data(), data.size());
     return packet;
   }
@@ -179,6 +180,7 @@ void hci_close() {
 }
 
 void hci_transmit(BT_HDR* packet) {
+  // The HAL copies the payload into its transaction, reference it in place
   HciPacket data;
   data.setToExternal(packet->data + packet->offset, packet->len);
 
@@ -36,10 +36,12 @@
 #include "buffer_allocator.h"
 #include "hci_internals.h"
 #include "hci_layer.h"
+#include "hci_replay.h"
 #include "osi/include/compat.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
 #include "osi/include/properties.h"
+#include "stack_config.h"
 
 using base::Thread;
 
@@ -100,68 +102,103 @@ extern void sco_data_received(BT_HDR* packet);
 static int bt_vendor_fd = -1;
 static int hci_interface;
 static int rfkill_en;
+// The controller is emulated from a btsnoop log instead of an HCI device
+static bool replaying;
 static int wait_hcidev(void);
 static int rfkill(int block);
 
 int reader_thread_ctrl_fd = -1;
 Thread* reader_thread = NULL;
 
+/* Packets read from the HCI socket per system call */
+#define HCI_RX_BATCH 16
+#define HCI_RX_BUF_SIZE 2000
+
+static void dispatch_packet(const allocator_t* buffer_allocator,
+                            const uint8_t* buf, size_t len, bool truncated) {
+  if (truncated)
+    LOG(FATAL) << "This packet filled buffer, if it have continuation we "
+                  "don't know how to merge it, increase buffer size!";
+  if (len == 0) return;
+
+  uint8_t type = buf[0];
+
+  BT_HDR* packet =
+      reinterpret_cast<BT_HDR*>(buffer_allocator->alloc(len - 1 + BT_HDR_SIZE));
+  packet->offset = 0;
+  packet->layer_specific = 0;
+  packet->len = len - 1;
+  memcpy(packet->data, buf + 1, len - 1);
+
+  switch (type) {
+    case HCI_PACKET_TYPE_COMMAND:
+      packet->event = MSG_HC_TO_STACK_HCI_EVT;
+      hci_event_received(FROM_HERE, packet);
+      break;
+    case HCI_PACKET_TYPE_ACL_DATA:
+      packet->event = MSG_HC_TO_STACK_HCI_ACL;
+      acl_event_received(packet);
+      break;
+    case HCI_PACKET_TYPE_SCO_DATA:
+      packet->event = MSG_HC_TO_STACK_HCI_SCO;
+      sco_data_received(packet);
+      break;
+    case HCI_PACKET_TYPE_EVENT:
+      packet->event = MSG_HC_TO_STACK_HCI_EVT;
+      hci_event_received(FROM_HERE, packet);
+      break;
+    default:
+      LOG(FATAL) << "Unexpected event type: " << +type;
+      break;
+  }
+}
+
 void monitor_socket(int ctrl_fd, int fd) {
   const allocator_t* buffer_allocator = buffer_allocator_get_interface();
-  const size_t buf_size = 2000;
-  uint8_t buf[buf_size];
-  ssize_t len = read(fd, buf, buf_size);
-
-  while (len > 0) {
-    if (len == buf_size)
-      LOG(FATAL) << "This packet filled buffer, if it have continuation we "
-                    "don't know how to merge it, increase buffer size!";
-
-    uint8_t type = buf[0];
-
-    size_t packet_size = buf_size + BT_HDR_SIZE;
-    BT_HDR* packet =
-        reinterpret_cast<BT_HDR*>(buffer_allocator->alloc(packet_size));
-    packet->offset = 0;
-    packet->layer_specific = 0;
-    packet->len = len - 1;
-    memcpy(packet->data, buf + 1, len - 1);
-
-    switch (type) {
-      case HCI_PACKET_TYPE_COMMAND:
-        packet->event = MSG_HC_TO_STACK_HCI_EVT;
-        hci_event_received(FROM_HERE, packet);
-        break;
-      case HCI_PACKET_TYPE_ACL_DATA:
-        packet->event = MSG_HC_TO_STACK_HCI_ACL;
-        acl_event_received(packet);
-        break;
-      case HCI_PACKET_TYPE_SCO_DATA:
-        packet->event = MSG_HC_TO_STACK_HCI_SCO;
-        sco_data_received(packet);
-        break;
-      case HCI_PACKET_TYPE_EVENT:
-        packet->event = MSG_HC_TO_STACK_HCI_EVT;
-        hci_event_received(FROM_HERE, packet);
-        break;
-      default:
-        LOG(FATAL) << "Unexpected event type: " << +type;
-        break;
-    }
+  /* The user channel keeps the packet boundaries: each message is a packet.
+   * Everything that queued up in the socket is read with one recvmmsg per
+   * batch, in order. Only the reader thread uses the buffers. */
+  static uint8_t bufs[HCI_RX_BATCH][HCI_RX_BUF_SIZE];
+  struct iovec iovs[HCI_RX_BATCH];
+  struct mmsghdr msgs[HCI_RX_BATCH];
+
+  memset(msgs, 0, sizeof(msgs));
+  for (int i = 0; i < HCI_RX_BATCH; i++) {
+    iovs[i].iov_base = bufs[i];
+    iovs[i].iov_len = HCI_RX_BUF_SIZE;
+    msgs[i].msg_hdr.msg_iov = &iovs[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+  }
 
-    fd_set fds;
-    FD_ZERO(&fds);
-    FD_SET(ctrl_fd, &fds);
-    FD_SET(fd, &fds);
-    int res = select(std::max(fd, ctrl_fd) + 1, &fds, NULL, NULL, NULL);
-    if (res <= 0) LOG(INFO) << "Nothing more to read";
+  while (true) {
+    struct pollfd fds[2] = {{ctrl_fd, POLLIN, 0}, {fd, POLLIN, 0}};
+    int res;
+    OSI_NO_INTR(res = poll(fds, 2, -1));
+    if (res < 0) {
+      PLOG(ERROR) << "poll failed";
+      return;
+    }
 
-    if (FD_ISSET(ctrl_fd, &fds)) {
+    if (fds[0].revents) {
       LOG(INFO) << "exitting";
       return;
     }
 
-    len = read(fd, buf, buf_size);
+    int n;
+    do {
+      OSI_NO_INTR(n = recvmmsg(fd, msgs, HCI_RX_BATCH, MSG_DONTWAIT, NULL));
+      if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+      if (n <= 0) {
+        if (n < 0) PLOG(ERROR) << "recvmmsg failed";
+        LOG(INFO) << "Nothing more to read";
+        return;
+      }
+
+      for (int i = 0; i < n; i++) {
+        dispatch_packet(buffer_allocator, bufs[i], msgs[i].msg_len,
+                        msgs[i].msg_hdr.msg_flags & MSG_TRUNC);
+      }
+    } while (n == HCI_RX_BATCH);
   }
 }
 
@@ -169,6 +206,18 @@ void monitor_socket(int ctrl_fd, int fd) {
 void hci_initialize() {
   LOG(INFO) << __func__;
 
+  const std::string* replay_log =
+      stack_config_get_interface()->get_hci_replay_snoop_log();
+  if (replay_log != nullptr) {
+    replaying = hci_replay_open(
+        replay_log->c_str(),
+        stack_config_get_interface()->get_hci_replay_paced());
+    CHECK(replaying) << "Unable to replay " << *replay_log;
+    LOG(INFO) << "Replaying " << *replay_log;
+    initialization_complete();
+    return;
+  }
+
   char prop_value[PROPERTY_VALUE_MAX];
   osi_property_get("bluetooth.interface", prop_value, "0");
 
@@ -224,6 +273,12 @@ void hci_initialize() {
 void hci_close() {
   LOG(INFO) << __func__;
 
+  if (replaying) {
+    hci_replay_close();
+    replaying = false;
+    return;
+  }
+
   if (bt_vendor_fd != -1) {
     close(bt_vendor_fd);
     bt_vendor_fd = -1;
@@ -247,6 +302,11 @@ void hci_close() {
 void hci_transmit(BT_HDR* packet) {
   uint8_t type = 0;
 
+  if (replaying) {
+    hci_replay_transmit(packet);
+    return;
+  }
+
   CHECK(bt_vendor_fd != -1);
 
   uint16_t event = packet->event & MSG_EVT_MASK;
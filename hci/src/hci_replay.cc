@@ -0,0 +1,550 @@
+/******************************************************************************
+ *
+ *  Copyright 2020 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#define LOG_TAG "bt_hci_replay"
+
+#include "hci_replay.h"
+
+#include <arpa/inet.h>
+#include <base/location.h>
+#include <base/logging.h>
+#include <dirent.h>
+#include <endian.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/prctl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bt_hci_bdroid.h"
+#include "buffer_allocator.h"
+#include "common/time_util.h"
+#include "hcidefs.h"
+#include "hcimsgs.h"
+#include "osi/include/log.h"
+
+extern void hci_event_received(const base::Location& from_here, BT_HDR* packet);
+extern void acl_event_received(BT_HDR* packet);
+extern void sco_data_received(BT_HDR* packet);
+extern void iso_data_received(BT_HDR* packet);
+
+typedef enum {
+  kCommandPacket = 1,
+  kAclPacket = 2,
+  kScoPacket = 3,
+  kEventPacket = 4,
+  kIsoPacket = 5
+} packet_type_t;
+
+typedef struct {
+  uint8_t identification_pattern[8];
+  uint32_t version_number;
+  uint32_t datalink_type;
+} __attribute__((__packed__)) btsnoop_file_header_t;
+
+// The H4 packet type is the first byte of the record data
+typedef struct {
+  uint32_t length_original;
+  uint32_t length_captured;
+  uint32_t flags;
+  uint32_t dropped_packets;
+  uint64_t timestamp;
+} __attribute__((__packed__)) btsnoop_record_header_t;
+
+// A packet sent by the controller in the log
+typedef struct {
+  uint64_t timestamp_us;
+  uint8_t type;
+  std::vector<uint8_t> data;
+  // Commands the host had sent before it in the log
+  size_t commands_before;
+  // The host sent a packet right after it in the log
+  bool has_reaction;
+} replay_record_t;
+
+// Epoch in microseconds since 01/01/0000.
+static const uint64_t BTSNOOP_EPOCH_DELTA = 0x00dcddb30f2f8000ULL;
+// Datalink Type code for HCI UART (H4)
+static const uint32_t BTSNOOP_DATALINK_H4 = 1002;
+// Record flag set on the packets received by the host
+static const uint32_t BTSNOOP_FLAG_RECEIVED = 0x01;
+
+// A packet waits this long for the commands it follows in the log before it is
+// fed anyway
+static const std::chrono::milliseconds REPLAY_STALL_TIMEOUT(500);
+
+// Handles reported per Number Of Completed Packets event
+static const size_t REPLAY_NOCP_MAX_HANDLES = 16;
+
+static const char* REPLAY_THREAD_NAME = "bt_hci_replay";
+
+// Upper bounds, in ms, of the buckets of the reaction latency histogram; the
+// last bucket is unbounded
+static const uint64_t REACTION_BUCKETS_MS[] = {1, 5, 20, 100};
+static const size_t REACTION_BUCKET_COUNT =
+    sizeof(REACTION_BUCKETS_MS) / sizeof(REACTION_BUCKETS_MS[0]) + 1;
+
+typedef struct {
+  size_t fed[kIsoPacket + 1];
+  size_t stalls;
+  size_t recorded_responses;
+  size_t bare_responses;
+  size_t completed_packets;
+  size_t skipped_records;
+  // Time from feeding a packet the host reacted to in the log, to the next
+  // packet the host sent
+  size_t reactions;
+  uint64_t total_reaction_us;
+  uint64_t max_reaction_us;
+  size_t reaction_buckets[REACTION_BUCKET_COUNT];
+  uint64_t start_us;
+  uint64_t end_us;
+  // CPU time of each thread, by name, at the start and then over the replay
+  std::map<std::string, uint64_t> thread_cpu_us;
+} replay_stats_t;
+
+static std::mutex replay_mutex;
+static std::condition_variable replay_cv;
+static std::thread replay_thread;
+static bool replay_running;
+static bool replay_done;
+static bool replay_paced;
+static std::string replay_path;
+
+// Only accessed from the replay thread once it is started
+static std::vector<replay_record_t> replay_records;
+static std::map<uint16_t, std::deque<std::vector<uint8_t>>> replay_responses;
+
+// Guarded by |replay_mutex|. What the host sent, for the replay thread to
+// answer.
+static std::deque<uint16_t> pending_commands;
+static std::map<uint16_t, uint16_t> pending_completed_packets;
+static size_t commands_received;
+static bool awaiting_reaction;
+static uint64_t last_fed_us;
+static replay_stats_t stats;
+
+// Returns the opcode a Command Complete or Command Status answers, or
+// HCI_COMMAND_NONE for the other events
+static uint16_t get_response_opcode(const std::vector<uint8_t>& event) {
+  const uint8_t* p = event.data();
+  if (event[0] == HCI_COMMAND_COMPLETE_EVT && event.size() >= 5) {
+    p += 3;
+  } else if (event[0] == HCI_COMMAND_STATUS_EVT && event.size() >= 6) {
+    p += 4;
+  } else {
+    return HCI_COMMAND_NONE;
+  }
+  uint16_t opcode;
+  STREAM_TO_UINT16(opcode, p);
+  return opcode;
+}
+
+static bool load_log(const char* path) {
+  FILE* file = fopen(path, "rb");
+  if (file == nullptr) {
+    LOG_ERROR(LOG_TAG, "%s unable to open %s: %s", __func__, path,
+              strerror(errno));
+    return false;
+  }
+
+  btsnoop_file_header_t file_header;
+  if (fread(&file_header, sizeof(file_header), 1, file) != 1 ||
+      memcmp(file_header.identification_pattern, "btsnoop", 8) != 0 ||
+      ntohl(file_header.datalink_type) != BTSNOOP_DATALINK_H4) {
+    LOG_ERROR(LOG_TAG, "%s %s is not an H4 btsnoop log", __func__, path);
+    fclose(file);
+    return false;
+  }
+
+  size_t commands_before = 0;
+  bool last_was_received = false;
+  btsnoop_record_header_t header;
+  while (fread(&header, sizeof(header), 1, file) == 1) {
+    uint32_t length = ntohl(header.length_captured);
+    std::vector<uint8_t> data(length);
+    if (length == 0 || fread(data.data(), length, 1, file) != 1) break;
+    // Filtered logs cut the payload of the data packets
+    if (length != ntohl(header.length_original) || length < 2) {
+      stats.skipped_records++;
+      continue;
+    }
+
+    uint8_t type = data[0];
+    data.erase(data.begin());
+    if (!(ntohl(header.flags) & BTSNOOP_FLAG_RECEIVED)) {
+      if (last_was_received) replay_records.back().has_reaction = true;
+      last_was_received = false;
+      if (type == kCommandPacket) commands_before++;
+      continue;
+    }
+
+    last_was_received = false;
+    if (type == kEventPacket) {
+      // The completed packets are reported for what the host sends now
+      if (data[0] == HCI_NUM_COMPL_DATA_PKTS_EVT) continue;
+      uint16_t opcode = get_response_opcode(data);
+      if (opcode != HCI_COMMAND_NONE) {
+        replay_responses[opcode].push_back(std::move(data));
+        continue;
+      }
+    } else if (type != kAclPacket && type != kScoPacket && type != kIsoPacket) {
+      stats.skipped_records++;
+      continue;
+    }
+    uint64_t timestamp_us = be64toh(header.timestamp) - BTSNOOP_EPOCH_DELTA;
+    replay_records.push_back(
+        {timestamp_us, type, std::move(data), commands_before, false});
+    last_was_received = true;
+  }
+  fclose(file);
+
+  LOG_INFO(LOG_TAG,
+           "%s %s: %zu packets to feed, responses for %zu opcodes, %zu records "
+           "skipped",
+           __func__, path, replay_records.size(), replay_responses.size(),
+           stats.skipped_records);
+  return true;
+}
+
+// Reads the user and system time of each thread of the process, by name
+static std::map<std::string, uint64_t> read_thread_cpu_us() {
+  std::map<std::string, uint64_t> cpu_us;
+  DIR* dir = opendir("/proc/self/task");
+  if (dir == nullptr) return cpu_us;
+
+  long ticks_per_s = sysconf(_SC_CLK_TCK);
+  while (struct dirent* entry = readdir(dir)) {
+    if (entry->d_name[0] == '.') continue;
+    std::string path =
+        std::string("/proc/self/task/") + entry->d_name + "/stat";
+    FILE* file = fopen(path.c_str(), "r");
+    if (file == nullptr) continue;
+    char buf[512];
+    size_t length = fread(buf, 1, sizeof(buf) - 1, file);
+    fclose(file);
+    buf[length] = '\0';
+
+    // "tid (name) state ..." where the name may hold spaces and parentheses
+    char* name_start = strchr(buf, '(');
+    char* name_end = strrchr(buf, ')');
+    if (name_start == nullptr || name_end == nullptr || name_end < name_start)
+      continue;
+    unsigned long utime, stime;
+    if (sscanf(name_end + 1,
+               " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &utime,
+               &stime) != 2)
+      continue;
+    cpu_us[std::string(name_start + 1, name_end)] +=
+        (utime + stime) * 1000000 / ticks_per_s;
+  }
+  closedir(dir);
+  return cpu_us;
+}
+
+static BT_HDR* make_packet(uint16_t event, const std::vector<uint8_t>& data) {
+  BT_HDR* packet = static_cast<BT_HDR*>(
+      buffer_allocator_get_interface()->alloc(BT_HDR_SIZE + data.size()));
+  packet->event = event;
+  packet->offset = 0;
+  packet->layer_specific = 0;
+  packet->len = data.size();
+  memcpy(packet->data, data.data(), data.size());
+  return packet;
+}
+
+// Must be called with |replay_mutex| held. Hands |packet| to the HCI layer
+// without it, so that the host can send packets meanwhile.
+static void feed(uint8_t type, BT_HDR* packet,
+                 std::unique_lock<std::mutex>* lock) {
+  lock->unlock();
+  switch (type) {
+    case kEventPacket:
+      hci_event_received(FROM_HERE, packet);
+      break;
+    case kAclPacket:
+      acl_event_received(packet);
+      break;
+    case kScoPacket:
+      sco_data_received(packet);
+      break;
+    case kIsoPacket:
+      iso_data_received(packet);
+      break;
+  }
+  lock->lock();
+}
+
+// Answers the oldest command the host sent. Must be called with |replay_mutex|
+// held.
+static void answer_command(std::unique_lock<std::mutex>* lock) {
+  uint16_t opcode = pending_commands.front();
+  pending_commands.pop_front();
+
+  std::vector<uint8_t> response;
+  auto responses = replay_responses.find(opcode);
+  if (responses != replay_responses.end() && !responses->second.empty()) {
+    response = std::move(responses->second.front());
+    responses->second.pop_front();
+    stats.recorded_responses++;
+  } else {
+    response = {HCI_COMMAND_COMPLETE_EVT, 4, 1, (uint8_t)opcode,
+                (uint8_t)(opcode >> 8), HCI_SUCCESS};
+    stats.bare_responses++;
+  }
+  feed(kEventPacket, make_packet(MSG_HC_TO_STACK_HCI_EVT, response), lock);
+}
+
+// Reports the data packets the host sent as completed. Must be called with
+// |replay_mutex| held.
+static void complete_packets(std::unique_lock<std::mutex>* lock) {
+  std::vector<uint8_t> event = {HCI_NUM_COMPL_DATA_PKTS_EVT, 1, 0};
+  while (!pending_completed_packets.empty() &&
+         event[2] < REPLAY_NOCP_MAX_HANDLES) {
+    auto completed = pending_completed_packets.begin();
+    event.push_back(completed->first);
+    event.push_back(completed->first >> 8);
+    event.push_back(completed->second);
+    event.push_back(completed->second >> 8);
+    event[2]++;
+    stats.completed_packets += completed->second;
+    pending_completed_packets.erase(completed);
+  }
+  event[1] = event.size() - 2;
+  feed(kEventPacket, make_packet(MSG_HC_TO_STACK_HCI_EVT, event), lock);
+}
+
+static uint16_t get_packet_event(uint8_t type) {
+  switch (type) {
+    case kAclPacket:
+      return MSG_HC_TO_STACK_HCI_ACL;
+    case kScoPacket:
+      return MSG_HC_TO_STACK_HCI_SCO;
+    case kIsoPacket:
+      return MSG_HC_TO_STACK_HCI_ISO;
+    default:
+      return MSG_HC_TO_STACK_HCI_EVT;
+  }
+}
+
+static void finish_replay() {
+  stats.end_us = bluetooth::common::time_get_os_boottime_us();
+  std::map<std::string, uint64_t> cpu_us = read_thread_cpu_us();
+  for (auto& thread : cpu_us) {
+    auto start = stats.thread_cpu_us.find(thread.first);
+    if (start != stats.thread_cpu_us.end()) thread.second -= start->second;
+  }
+  stats.thread_cpu_us = std::move(cpu_us);
+  replay_done = true;
+
+  LOG_INFO(LOG_TAG, "%s fed %zu packets in %" PRIu64 " ms, %zu stalls",
+           __func__, replay_records.size(),
+           (stats.end_us - stats.start_us) / 1000, stats.stalls);
+}
+
+static void replay_loop() {
+  prctl(PR_SET_NAME, (unsigned long)REPLAY_THREAD_NAME, 0, 0, 0);
+
+  std::unique_lock<std::mutex> lock(replay_mutex);
+  stats.start_us = bluetooth::common::time_get_os_boottime_us();
+  stats.thread_cpu_us = read_thread_cpu_us();
+
+  size_t next = 0;
+  auto waiting_since = std::chrono::steady_clock::now();
+  std::chrono::steady_clock::time_point stream_start;
+  while (replay_running) {
+    // Answer what the host sent first, as a controller would
+    if (!pending_commands.empty()) {
+      answer_command(&lock);
+      continue;
+    }
+    if (!pending_completed_packets.empty()) {
+      complete_packets(&lock);
+      continue;
+    }
+
+    if (next == replay_records.size()) {
+      if (!replay_done) finish_replay();
+      replay_cv.wait(lock);
+      continue;
+    }
+
+    const replay_record_t& record = replay_records[next];
+    auto now = std::chrono::steady_clock::now();
+    bool ready = commands_received >= record.commands_before;
+    if (!ready && now >= waiting_since + REPLAY_STALL_TIMEOUT) {
+      stats.stalls++;
+      ready = true;
+    }
+    auto due = now;
+    if (replay_paced && next != 0) {
+      due = stream_start +
+            std::chrono::microseconds(record.timestamp_us -
+                                      replay_records[0].timestamp_us);
+    }
+
+    if (!ready) {
+      replay_cv.wait_until(lock, waiting_since + REPLAY_STALL_TIMEOUT);
+      continue;
+    }
+    if (now < due) {
+      replay_cv.wait_until(lock, due);
+      continue;
+    }
+
+    if (next == 0) stream_start = now;
+    next++;
+    stats.fed[record.type]++;
+    awaiting_reaction = record.has_reaction;
+    last_fed_us = bluetooth::common::time_get_os_boottime_us();
+    feed(record.type, make_packet(get_packet_event(record.type), record.data),
+         &lock);
+    waiting_since = std::chrono::steady_clock::now();
+  }
+}
+
+bool hci_replay_open(const char* path, bool paced) {
+  std::lock_guard<std::mutex> lock(replay_mutex);
+  CHECK(!replay_running);
+
+  replay_records.clear();
+  replay_responses.clear();
+  pending_commands.clear();
+  pending_completed_packets.clear();
+  commands_received = 0;
+  awaiting_reaction = false;
+  stats = {};
+  if (!load_log(path)) return false;
+
+  replay_path = path;
+  replay_paced = paced;
+  replay_done = false;
+  replay_running = true;
+  replay_thread = std::thread(replay_loop);
+  return true;
+}
+
+void hci_replay_close(void) {
+  {
+    std::lock_guard<std::mutex> lock(replay_mutex);
+    if (!replay_running) return;
+    replay_running = false;
+  }
+  replay_cv.notify_one();
+  replay_thread.join();
+}
+
+void hci_replay_transmit(BT_HDR* packet) {
+  uint8_t* stream = packet->data + packet->offset;
+  std::lock_guard<std::mutex> lock(replay_mutex);
+
+  if (awaiting_reaction) {
+    uint64_t reaction_us =
+        bluetooth::common::time_get_os_boottime_us() - last_fed_us;
+    awaiting_reaction = false;
+    stats.reactions++;
+    stats.total_reaction_us += reaction_us;
+    stats.max_reaction_us = std::max(stats.max_reaction_us, reaction_us);
+    size_t bucket = 0;
+    while (bucket < REACTION_BUCKET_COUNT - 1 &&
+           reaction_us >= REACTION_BUCKETS_MS[bucket] * 1000) {
+      bucket++;
+    }
+    stats.reaction_buckets[bucket]++;
+  }
+
+  switch (packet->event & MSG_EVT_MASK) {
+    case MSG_STACK_TO_HC_HCI_CMD: {
+      uint16_t opcode;
+      STREAM_TO_UINT16(opcode, stream);
+      pending_commands.push_back(opcode);
+      commands_received++;
+      break;
+    }
+    case MSG_STACK_TO_HC_HCI_ACL: {
+      uint16_t handle;
+      STREAM_TO_UINT16(handle, stream);
+      pending_completed_packets[HCID_GET_HANDLE(handle)]++;
+      break;
+    }
+    default:
+      // SCO and ISO data is not flow controlled by the host
+      return;
+  }
+  replay_cv.notify_one();
+}
+
+bool hci_replay_is_done(void) {
+  std::lock_guard<std::mutex> lock(replay_mutex);
+  return replay_done;
+}
+
+void hci_replay_debug_dump(int fd) {
+  std::lock_guard<std::mutex> lock(replay_mutex);
+  if (!replay_running) return;
+
+  dprintf(fd, "\nHCI Replay:\n");
+  dprintf(fd, "  log: %s, %s\n", replay_path.c_str(),
+          replay_paced ? "paced" : "as fast as possible");
+  dprintf(fd,
+          "  fed: %zu events, %zu ACL, %zu SCO, %zu ISO of %zu packets, %zu "
+          "stalls\n",
+          stats.fed[kEventPacket], stats.fed[kAclPacket],
+          stats.fed[kScoPacket], stats.fed[kIsoPacket], replay_records.size(),
+          stats.stalls);
+  dprintf(fd,
+          "  answered: %zu commands from the log, %zu with a bare success, "
+          "%zu data packets\n",
+          stats.recorded_responses, stats.bare_responses,
+          stats.completed_packets);
+  if (stats.reactions != 0) {
+    dprintf(fd, "  reactions: %zu, avg %" PRIu64 " us, max %" PRIu64 " us\n",
+            stats.reactions, stats.total_reaction_us / stats.reactions,
+            stats.max_reaction_us);
+    for (size_t i = 0; i < REACTION_BUCKET_COUNT; i++) {
+      if (i < REACTION_BUCKET_COUNT - 1) {
+        dprintf(fd, "    < %3" PRIu64 " ms: %zu\n", REACTION_BUCKETS_MS[i],
+                stats.reaction_buckets[i]);
+      } else {
+        dprintf(fd, "    >=%3" PRIu64 " ms: %zu\n", REACTION_BUCKETS_MS[i - 1],
+                stats.reaction_buckets[i]);
+      }
+    }
+  }
+
+  if (!replay_done) return;
+  uint64_t duration_us = stats.end_us - stats.start_us;
+  dprintf(fd, "  replay time: %" PRIu64 " ms\n", duration_us / 1000);
+  for (const auto& thread : stats.thread_cpu_us) {
+    if (thread.second == 0) continue;
+    dprintf(fd, "    %-20s %" PRIu64 " ms CPU (%" PRIu64 "%%)\n",
+            thread.first.c_str(), thread.second / 1000,
+            duration_us ? thread.second * 100 / duration_us : 0);
+  }
+}
@@ -53,11 +53,26 @@ static const packet_fragmenter_callbacks_t* callbacks;
 
 static std::unordered_map<uint16_t /* handle */, BT_HDR*> partial_packets;
 
+// Packets being reassembled as fragment chains, used instead of
+// |partial_packets| when the reassembled_chain callback is set.
+typedef struct {
+  acl_packet_chain_t* chain;
+  uint32_t expected_len;
+} partial_chain_t;
+static std::unordered_map<uint16_t /* handle */, partial_chain_t>
+    partial_chains;
+
+static void free_chain(acl_packet_chain_t* chain);
+
 static void init(const packet_fragmenter_callbacks_t* result_callbacks) {
   callbacks = result_callbacks;
 }
 
-static void cleanup() { partial_packets.clear(); }
+static void cleanup() {
+  partial_packets.clear();
+  for (auto& entry : partial_chains) free_chain(entry.second.chain);
+  partial_chains.clear();
+}
 
 static void fragment_and_dispatch(BT_HDR* packet) {
   CHECK(packet != NULL);
@@ -121,6 +136,75 @@ static bool check_uint16_overflow(uint16_t a, uint16_t b) {
   return (UINT16_MAX - a) < b;
 }
 
+static void free_fragment(void* fragment) { buffer_allocator->free(fragment); }
+
+static void free_chain(acl_packet_chain_t* chain) {
+  if (chain == NULL) return;
+  list_free(chain->fragments);
+  osi_free(chain);
+}
+
+static BT_HDR* flatten_chain(acl_packet_chain_t* chain) {
+  CHECK(chain != NULL);
+
+  if (chain->len + sizeof(BT_HDR) > BT_DEFAULT_BUFFER_SIZE) {
+    LOG_WARN(LOG_TAG, "%s packet of %u bytes too large to flatten. Dropping.",
+             __func__, chain->len);
+    free_chain(chain);
+    return NULL;
+  }
+
+  BT_HDR* packet = (BT_HDR*)buffer_allocator->alloc(chain->len + sizeof(BT_HDR));
+  packet->event = chain->event;
+  packet->len = chain->len;
+  packet->offset = 0;
+  packet->layer_specific = 0;
+
+  uint8_t* p = packet->data;
+  for (const list_node_t* node = list_begin(chain->fragments);
+       node != list_end(chain->fragments); node = list_next(node)) {
+    const BT_HDR* fragment = (const BT_HDR*)list_node(node);
+    memcpy(p, fragment->data + fragment->offset, fragment->len);
+    p += fragment->len;
+  }
+
+  free_chain(chain);
+  return packet;
+}
+
+// Appends continuation |packet| to the chain being reassembled for |handle|.
+static void append_to_chain(uint16_t handle, BT_HDR* packet) {
+  auto map_iter = partial_chains.find(handle);
+  if (map_iter == partial_chains.end()) {
+    LOG_WARN(LOG_TAG, "%s got continuation for unknown packet. Dropping it.",
+             __func__);
+    buffer_allocator->free(packet);
+    return;
+  }
+  partial_chain_t& partial = map_iter->second;
+
+  packet->offset = HCI_ACL_PREAMBLE_SIZE;
+  packet->len -= HCI_ACL_PREAMBLE_SIZE;
+
+  uint32_t remaining = partial.expected_len - partial.chain->len;
+  if (packet->len > remaining) {
+    LOG_WARN(LOG_TAG,
+             "%s got packet which would exceed expected length of %u. "
+             "Truncating.",
+             __func__, partial.expected_len);
+    packet->len = remaining;
+  }
+
+  list_append(partial.chain->fragments, packet);
+  partial.chain->len += packet->len;
+
+  if (partial.chain->len == partial.expected_len) {
+    acl_packet_chain_t* chain = partial.chain;
+    partial_chains.erase(map_iter);
+    callbacks->reassembled_chain(chain);
+  }
+}
+
 static void reassemble_and_dispatch(BT_HDR* packet) {
   if ((packet->event & MSG_EVT_MASK) == MSG_HC_TO_STACK_HCI_ACL) {
     uint8_t* stream = packet->data;
@@ -163,6 +247,18 @@ static void reassemble_and_dispatch(BT_HDR* packet) {
         buffer_allocator->free(hdl);
       }
 
+      auto chain_iter = partial_chains.find(handle);
+      if (chain_iter != partial_chains.end()) {
+        LOG_WARN(LOG_TAG,
+                 "%s found unfinished chain for handle with start packet. "
+                 "Dropping old.",
+                 __func__);
+
+        acl_packet_chain_t* chain = chain_iter->second.chain;
+        partial_chains.erase(chain_iter);
+        free_chain(chain);
+      }
+
       if (acl_length < L2CAP_HEADER_PDU_LEN_SIZE) {
         LOG_WARN(LOG_TAG, "%s L2CAP packet too small (%d < %d). Dropping it.",
                  __func__, packet->len, L2CAP_HEADER_PDU_LEN_SIZE);
@@ -173,11 +269,14 @@ static void reassemble_and_dispatch(BT_HDR* packet) {
       uint16_t full_length =
           l2cap_length + L2CAP_HEADER_SIZE + HCI_ACL_PREAMBLE_SIZE;
 
-      // Check for buffer overflow and that the full packet size + BT_HDR size
-      // is less than the max buffer size
+      // Check for buffer overflow and, unless the packet is handed over as a
+      // chain, that the full packet size + BT_HDR size is less than the max
+      // buffer size
+      bool use_chain = callbacks->reassembled_chain != NULL;
       if (check_uint16_overflow(l2cap_length,
                                 (L2CAP_HEADER_SIZE + HCI_ACL_PREAMBLE_SIZE)) ||
-          ((full_length + sizeof(BT_HDR)) > BT_DEFAULT_BUFFER_SIZE)) {
+          (!use_chain &&
+           (full_length + sizeof(BT_HDR)) > BT_DEFAULT_BUFFER_SIZE)) {
         LOG_ERROR(LOG_TAG, "%s Dropping L2CAP packet with invalid length (%d).",
                   __func__, l2cap_length);
         buffer_allocator->free(packet);
@@ -194,6 +293,25 @@ static void reassemble_and_dispatch(BT_HDR* packet) {
         return;
       }
 
+      if (use_chain) {
+        // Update the ACL data size to indicate the full expected length
+        stream = packet->data;
+        STREAM_SKIP_UINT16(stream);  // skip the handle
+        UINT16_TO_STREAM(stream, full_length - HCI_ACL_PREAMBLE_SIZE);
+
+        acl_packet_chain_t* chain =
+            (acl_packet_chain_t*)osi_calloc(sizeof(acl_packet_chain_t));
+        chain->handle = handle;
+        chain->event = packet->event;
+        chain->fragments = list_new(free_fragment);
+        packet->offset = 0;
+        list_append(chain->fragments, packet);
+        chain->len = packet->len;
+
+        partial_chains[handle] = {chain, full_length};
+        return;
+      }
+
       BT_HDR* partial_packet =
           (BT_HDR*)buffer_allocator->alloc(full_length + sizeof(BT_HDR));
       partial_packet->event = packet->event;
@@ -211,6 +329,8 @@ static void reassemble_and_dispatch(BT_HDR* packet) {
 
       // Free the old packet buffer, since we don't need it anymore
       buffer_allocator->free(packet);
+    } else if (callbacks->reassembled_chain != NULL) {
+      append_to_chain(handle, packet);
     } else {
       auto map_iter = partial_packets.find(handle);
       if (map_iter == partial_packets.end()) {
@@ -253,10 +373,9 @@ static void reassemble_and_dispatch(BT_HDR* packet) {
   }
 }
 
-static const packet_fragmenter_t interface = {init, cleanup,
-
-                                              fragment_and_dispatch,
-                                              reassemble_and_dispatch};
+static const packet_fragmenter_t interface = {
+    init,          cleanup,    fragment_and_dispatch, reassemble_and_dispatch,
+    flatten_chain, free_chain};
 
 const packet_fragmenter_t* packet_fragmenter_get_interface() {
   controller = controller_get_interface();
@@ -62,6 +62,12 @@ class HciLayerTest : public AllocationTestHarness {
   }
 
   void TearDown() override {
+    for (auto& queue : command_queue) {
+      for (waiting_command_t* wait_entry : queue) {
+        free_waiting_command(wait_entry);
+      }
+      queue.clear();
+    }
     list_free(commands_pending_response);
     AllocationTestHarness::TearDown();
   }
@@ -74,6 +80,31 @@ class HciLayerTest : public AllocationTestHarness {
     return static_cast<uint8_t*>(packet->data);
   }
 
+  waiting_command_t* AllocateWaitingCommand(command_opcode_t opcode,
+                                            uint8_t param) const {
+    BT_HDR* command = AllocatePacket(4, MSG_STACK_TO_HC_HCI_CMD);
+    auto p = GetPayloadPointer(command);
+    UINT16_TO_STREAM(p, opcode);
+    UINT8_TO_STREAM(p, 1);  // length
+    UINT8_TO_STREAM(p, param);
+
+    waiting_command_t* wait_entry =
+        static_cast<waiting_command_t*>(osi_calloc(sizeof(waiting_command_t)));
+    wait_entry->opcode = opcode;
+    wait_entry->command = command;
+    wait_entry->complete_callback = CountCompletes;
+    wait_entry->context = wait_entry;
+    wait_entry->enqueue_timestamp = std::chrono::steady_clock::now();
+    return wait_entry;
+  }
+
+  static void CountCompletes(BT_HDR* response, void* context) {
+    completes_++;
+    osi_free(response);
+  }
+
+  static int completes_;
+
  private:
   BT_HDR* AllocatePacket(size_t packet_length, uint16_t event) const {
     BT_HDR* packet =
@@ -81,11 +112,13 @@ class HciLayerTest : public AllocationTestHarness {
     packet->offset = 0;
     packet->len = packet_length;
     packet->layer_specific = 0;
-    packet->event = MSG_HC_TO_STACK_HCI_EVT;
+    packet->event = event;
     return packet;
   }
 };
 
+int HciLayerTest::completes_ = 0;
+
 TEST_F(HciLayerTest, FilterIncomingEvent) {
   {
     BT_HDR* packet = AllocateHciEventPacket(3);
@@ -122,3 +155,85 @@ TEST_F(HciLayerTest, FilterIncomingEvent) {
     CHECK(filter_incoming_event(packet));
   }
 }
+
+TEST_F(HciLayerTest, CommandsAreDequeuedByPriority) {
+  waiting_command_t* read_rssi = AllocateWaitingCommand(HCI_READ_RSSI, 0);
+  waiting_command_t* scan_enable =
+      AllocateWaitingCommand(HCI_BLE_WRITE_SCAN_ENABLE, 1);
+  waiting_command_t* disconnect = AllocateWaitingCommand(HCI_DISCONNECT, 0);
+  queue_command(read_rssi);
+  queue_command(scan_enable);
+  queue_command(disconnect);
+
+  for (waiting_command_t* wait_entry : {disconnect, scan_enable, read_rssi}) {
+    waiting_command_t* next = dequeue_command();
+    CHECK(next == wait_entry);
+    free_waiting_command(next);
+  }
+  CHECK(dequeue_command() == nullptr);
+}
+
+TEST_F(HciLayerTest, AgedCommandIsDequeuedFirst) {
+  waiting_command_t* read_rssi = AllocateWaitingCommand(HCI_READ_RSSI, 0);
+  read_rssi->enqueue_timestamp -=
+      std::chrono::milliseconds(COMMAND_PRIORITY_AGING_MS + 1);
+  waiting_command_t* disconnect = AllocateWaitingCommand(HCI_DISCONNECT, 0);
+  queue_command(read_rssi);
+  queue_command(disconnect);
+
+  waiting_command_t* next = dequeue_command();
+  CHECK(next == read_rssi);
+  free_waiting_command(next);
+}
+
+TEST_F(HciLayerTest, SupersededCommandIsCollapsed) {
+  waiting_command_t* scan_enable =
+      AllocateWaitingCommand(HCI_BLE_WRITE_SCAN_ENABLE, 1);
+  waiting_command_t* scan_disable =
+      AllocateWaitingCommand(HCI_BLE_WRITE_SCAN_ENABLE, 0);
+  CHECK(!queue_command(scan_enable));
+  CHECK(queue_command(scan_disable));
+
+  waiting_command_t* next = dequeue_command();
+  CHECK(next == scan_disable);
+  CHECK(next->followers == scan_enable);
+  CHECK(dequeue_command() == nullptr);
+  free_waiting_command(next);
+}
+
+TEST_F(HciLayerTest, CommandIsNotCollapsedAcrossOthers) {
+  queue_command(AllocateWaitingCommand(HCI_BLE_WRITE_SCAN_ENABLE, 0));
+  queue_command(AllocateWaitingCommand(HCI_BLE_WRITE_SCAN_PARAMS, 0));
+  CHECK(!queue_command(AllocateWaitingCommand(HCI_BLE_WRITE_SCAN_ENABLE, 1)));
+  CHECK(command_queue[COMMAND_PRIORITY_NORMAL].size() == 3);
+}
+
+TEST_F(HciLayerTest, SameReadIsShared) {
+  queue_command(AllocateWaitingCommand(HCI_READ_RSSI, 1));
+  CHECK(!queue_command(AllocateWaitingCommand(HCI_READ_RSSI, 2)));
+  CHECK(queue_command(AllocateWaitingCommand(HCI_READ_RSSI, 1)));
+  CHECK(command_queue[COMMAND_PRIORITY_LOW].size() == 2);
+}
+
+TEST_F(HciLayerTest, FollowersGetTheCommandComplete) {
+  waiting_command_t* read_rssi = AllocateWaitingCommand(HCI_READ_RSSI, 1);
+  queue_command(read_rssi);
+  queue_command(AllocateWaitingCommand(HCI_READ_RSSI, 1));
+  queue_command(AllocateWaitingCommand(HCI_READ_RSSI, 1));
+  CHECK(dequeue_command() == read_rssi);
+  list_append(commands_pending_response, read_rssi);
+
+  BT_HDR* packet = AllocateHciEventPacket(7);
+  auto p = GetPayloadPointer(packet);
+  *p++ = HCI_COMMAND_COMPLETE_EVT;
+  *p++ = 0x05;  // length
+  *p++ = 0x01;  // credits
+  UINT16_TO_STREAM(p, HCI_READ_RSSI);
+  *p++ = 0x00;  // status
+  *p++ = 0x00;
+
+  completes_ = 0;
+  CHECK(filter_incoming_event(packet));
+  CHECK(completes_ == 3);
+  CHECK(list_is_empty(commands_pending_response));
+}
@@ -0,0 +1,215 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <arpa/inet.h>
+#include <base/location.h>
+#include <endian.h>
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bt_hci_bdroid.h"
+#include "buffer_allocator.h"
+#include "hci_replay.h"
+#include "stack/include/hcidefs.h"
+
+namespace {
+
+constexpr std::chrono::seconds kTimeout(2);
+
+std::mutex received_mutex;
+std::condition_variable received_cv;
+// The packets fed to the HCI layer, with their event
+std::vector<std::pair<uint16_t, std::vector<uint8_t>>> received;
+
+void Receive(BT_HDR* packet) {
+  {
+    std::lock_guard<std::mutex> lock(received_mutex);
+    received.emplace_back(
+        packet->event, std::vector<uint8_t>(packet->data + packet->offset,
+                                            packet->data + packet->offset +
+                                                packet->len));
+  }
+  buffer_allocator_get_interface()->free(packet);
+  received_cv.notify_all();
+}
+
+}  // namespace
+
+void hci_event_received(const base::Location& from_here, BT_HDR* packet) {
+  Receive(packet);
+}
+void acl_event_received(BT_HDR* packet) { Receive(packet); }
+void sco_data_received(BT_HDR* packet) { Receive(packet); }
+void iso_data_received(BT_HDR* packet) { Receive(packet); }
+
+namespace {
+
+constexpr uint8_t kCommandPacket = 1;
+constexpr uint8_t kAclPacket = 2;
+constexpr uint8_t kEventPacket = 4;
+constexpr uint64_t kBtsnoopEpochDelta = 0x00dcddb30f2f8000ULL;
+
+class HciReplayTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    path_ = ::testing::TempDir() + "hci_replay_test.log";
+    log_ = fopen(path_.c_str(), "wb");
+    ASSERT_NE(log_, nullptr);
+    const uint8_t header[] = {'b', 't', 's', 'n', 'o', 'o', 'p', 0,
+                              0,   0,   0,   1,   0,   0,   0x03, 0xea};
+    fwrite(header, sizeof(header), 1, log_);
+    received.clear();
+  }
+
+  void TearDown() override {
+    hci_replay_close();
+    if (log_ != nullptr) fclose(log_);
+    remove(path_.c_str());
+  }
+
+  void Record(bool received_by_host, uint8_t type,
+              const std::vector<uint8_t>& data, uint64_t timestamp_us = 0) {
+    uint32_t length = htonl(data.size() + 1);
+    uint32_t flags = htonl(received_by_host ? 1 : 0);
+    uint32_t dropped = 0;
+    uint64_t timestamp = htobe64(timestamp_us + kBtsnoopEpochDelta);
+    fwrite(&length, sizeof(length), 1, log_);
+    fwrite(&length, sizeof(length), 1, log_);
+    fwrite(&flags, sizeof(flags), 1, log_);
+    fwrite(&dropped, sizeof(dropped), 1, log_);
+    fwrite(&timestamp, sizeof(timestamp), 1, log_);
+    fwrite(&type, 1, 1, log_);
+    fwrite(data.data(), data.size(), 1, log_);
+  }
+
+  bool Open() {
+    fclose(log_);
+    log_ = nullptr;
+    return hci_replay_open(path_.c_str(), false);
+  }
+
+  void Transmit(uint16_t event, const std::vector<uint8_t>& data) {
+    std::vector<uint8_t> buffer(sizeof(BT_HDR) + data.size());
+    BT_HDR* packet = reinterpret_cast<BT_HDR*>(buffer.data());
+    packet->event = event;
+    packet->offset = 0;
+    packet->len = data.size();
+    memcpy(packet->data, data.data(), data.size());
+    hci_replay_transmit(packet);
+  }
+
+  bool WaitForPackets(size_t count) {
+    std::unique_lock<std::mutex> lock(received_mutex);
+    return received_cv.wait_for(lock, kTimeout,
+                                [count] { return received.size() >= count; });
+  }
+
+  std::string path_;
+  FILE* log_ = nullptr;
+};
+
+const std::vector<uint8_t> kReset = {0x03, 0x0c, 0x00};
+// Carries a return parameter of its own, to tell it from a bare success
+const std::vector<uint8_t> kResetComplete = {
+    HCI_COMMAND_COMPLETE_EVT, 0x05, 0x01, 0x03, 0x0c, 0x00, 0x42};
+const std::vector<uint8_t> kAdvertisingReport = {HCI_BLE_EVENT, 0x02, 0x02,
+                                                 0x00};
+
+TEST_F(HciReplayTest, commands_get_the_recorded_response_first) {
+  Record(false, kCommandPacket, kReset);
+  Record(true, kEventPacket, kResetComplete);
+  Record(true, kEventPacket, kAdvertisingReport);
+  Record(true, kEventPacket, {HCI_NUM_COMPL_DATA_PKTS_EVT, 0x05, 0x01, 0x01,
+                              0x00, 0x01, 0x00});
+  ASSERT_TRUE(Open());
+
+  // The report follows the reset in the log, so it waits for it
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  {
+    std::lock_guard<std::mutex> lock(received_mutex);
+    EXPECT_TRUE(received.empty());
+  }
+  Transmit(MSG_STACK_TO_HC_HCI_CMD, kReset);
+  ASSERT_TRUE(WaitForPackets(2));
+
+  std::lock_guard<std::mutex> lock(received_mutex);
+  ASSERT_EQ(received.size(), 2u);
+  EXPECT_EQ(received[0].first, MSG_HC_TO_STACK_HCI_EVT);
+  EXPECT_EQ(received[0].second, kResetComplete);
+  EXPECT_EQ(received[1].second, kAdvertisingReport);
+}
+
+TEST_F(HciReplayTest, unrecorded_commands_get_a_bare_success) {
+  ASSERT_TRUE(Open());
+  Transmit(MSG_STACK_TO_HC_HCI_CMD, {0x34, 0x12, 0x00});
+  ASSERT_TRUE(WaitForPackets(1));
+
+  std::lock_guard<std::mutex> lock(received_mutex);
+  EXPECT_EQ(received[0].second,
+            std::vector<uint8_t>(
+                {HCI_COMMAND_COMPLETE_EVT, 0x04, 0x01, 0x34, 0x12, 0x00}));
+}
+
+TEST_F(HciReplayTest, sent_data_is_completed) {
+  ASSERT_TRUE(Open());
+  Transmit(MSG_STACK_TO_HC_HCI_ACL, {0x42, 0x20, 0x01, 0x00, 0xff});
+  Transmit(MSG_STACK_TO_HC_HCI_ACL, {0x42, 0x10, 0x01, 0x00, 0xff});
+
+  size_t completed = 0;
+  while (completed < 2) {
+    ASSERT_TRUE(WaitForPackets(1));
+    std::lock_guard<std::mutex> lock(received_mutex);
+    for (const auto& packet : received) {
+      const std::vector<uint8_t>& event = packet.second;
+      ASSERT_EQ(event[0], HCI_NUM_COMPL_DATA_PKTS_EVT);
+      ASSERT_EQ(event[2], 1);
+      EXPECT_EQ(event[3] | event[4] << 8, 0x0042);
+      completed += event[5] | event[6] << 8;
+    }
+    received.clear();
+  }
+  EXPECT_EQ(completed, 2u);
+}
+
+TEST_F(HciReplayTest, packets_are_fed_after_a_stall) {
+  Record(false, kCommandPacket, kReset);
+  Record(true, kAclPacket, {0x42, 0x20, 0x01, 0x00, 0xff});
+  ASSERT_TRUE(Open());
+
+  ASSERT_TRUE(WaitForPackets(1));
+  std::lock_guard<std::mutex> lock(received_mutex);
+  EXPECT_EQ(received[0].first, MSG_HC_TO_STACK_HCI_ACL);
+}
+
+TEST_F(HciReplayTest, other_files_are_rejected) {
+  fwrite("not a log", 9, 1, log_);
+  fclose(log_);
+  log_ = nullptr;
+  FILE* file = fopen(path_.c_str(), "r+b");
+  fwrite("btsnap", 6, 1, file);
+  fclose(file);
+  EXPECT_FALSE(hci_replay_open(path_.c_str(), false));
+}
+
+}  // namespace
@@ -78,6 +78,10 @@ struct TestMutables {
   struct {
     int access_count_{0};
   } transmit_finished;
+  struct {
+    int access_count_{0};
+    std::queue<acl_packet_chain_t*> queue;
+  } reassembled_chain;
 };
 
 TestMutables test_state_;
@@ -96,12 +100,24 @@ void OnTransmitFinished(BT_HDR* packet, bool all_fragments_sent) {
   test_state_.transmit_finished.access_count_++;
 }
 
+void OnReassembledChain(acl_packet_chain_t* chain) {
+  test_state_.reassembled_chain.access_count_++;
+  test_state_.reassembled_chain.queue.push(chain);
+}
+
 packet_fragmenter_callbacks_t result_callbacks = {
     .fragmented = OnFragmented,
     .reassembled = OnReassembled,
     .transmit_finished = OnTransmitFinished,
 };
 
+packet_fragmenter_callbacks_t chain_result_callbacks = {
+    .fragmented = OnFragmented,
+    .reassembled = OnReassembled,
+    .transmit_finished = OnTransmitFinished,
+    .reassembled_chain = OnReassembledChain,
+};
+
 AclPacketHeader* AclHeader(BT_HDR* packet) {
   return (AclPacketHeader*)packet->data;
 }
@@ -141,6 +157,10 @@ class HciPacketFragmenterTest : public AllocationTestHarness {
     while (!test_state_.reassembled.queue.empty()) {
       test_state_.reassembled.queue.pop();
     }
+    while (!test_state_.reassembled_chain.queue.empty()) {
+      free_chain(test_state_.reassembled_chain.queue.front());
+      test_state_.reassembled_chain.queue.pop();
+    }
     packet_fragmenter_->cleanup();
     AllocationTestHarness::TearDown();
   }
@@ -419,3 +439,74 @@ TEST_F(HciPacketFragmenterTest, TwoPacket_HugeBogusSecond) {
   CHECK(partial_packets.size() == 0);
   CHECK(test_state_.reassembled.access_count_ == 1);
 }
+
+TEST_F(HciPacketFragmenterTest, Chain_SplitTwo) {
+  packet_fragmenter_->init(&chain_result_callbacks);
+
+  const size_t packet_size = 512;
+  const std::vector<uint8_t> data = CreateData(packet_size);
+  const std::vector<uint8_t> part1(data.cbegin(),
+                                   data.cbegin() + packet_size / 2);
+  reassemble_and_dispatch(AllocateL2capPacket(data.size(), part1));
+
+  CHECK(partial_chains.size() == 1);
+  CHECK(partial_packets.size() == 0);
+
+  const std::vector<uint8_t> part2(data.cbegin() + packet_size / 2,
+                                   data.cend());
+  reassemble_and_dispatch(AllocateL2capPacket(part2));
+
+  CHECK(partial_chains.size() == 0);
+  CHECK(test_state_.reassembled.access_count_ == 0);
+  CHECK(test_state_.reassembled_chain.access_count_ == 1);
+
+  acl_packet_chain_t* chain = test_state_.reassembled_chain.queue.front();
+  test_state_.reassembled_chain.queue.pop();
+  CHECK(chain->handle == kHandle);
+  CHECK(list_length(chain->fragments) == 2);
+  CHECK(chain->len == sizeof(AclL2capPacketHeader) + packet_size);
+
+  BT_HDR* packet = flatten_chain(chain);
+  CHECK(packet != nullptr);
+  CHECK(packet->len == sizeof(AclL2capPacketHeader) + packet_size);
+  CHECK(AclHeader(packet)->GetLength() ==
+        sizeof(L2capPacketHeader) + packet_size);
+  CHECK(VerifyData(Data(packet), packet_size));
+  osi_free(packet);
+}
+
+TEST_F(HciPacketFragmenterTest, Chain_LargerThanBuffer) {
+  packet_fragmenter_->init(&chain_result_callbacks);
+
+  const size_t packet_size = 3 * BT_DEFAULT_BUFFER_SIZE;
+  const size_t stride = 1000;
+  const std::vector<uint8_t> data = CreateData(packet_size);
+  const std::vector<uint8_t> first_part(data.cbegin(), data.cbegin() + stride);
+  reassemble_and_dispatch(AllocateL2capPacket(data.size(), first_part));
+
+  for (size_t i = stride; i < packet_size; i += stride) {
+    const std::vector<uint8_t> part(
+        data.cbegin() + i, data.cbegin() + std::min(i + stride, packet_size));
+    reassemble_and_dispatch(AllocateL2capPacket(part));
+  }
+
+  CHECK(partial_chains.size() == 0);
+  CHECK(test_state_.reassembled_chain.access_count_ == 1);
+
+  acl_packet_chain_t* chain = test_state_.reassembled_chain.queue.front();
+  test_state_.reassembled_chain.queue.pop();
+  CHECK(chain->len == sizeof(AclL2capPacketHeader) + packet_size);
+
+  std::vector<uint8_t> reassembled;
+  for (const list_node_t* node = list_begin(chain->fragments);
+       node != list_end(chain->fragments); node = list_next(node)) {
+    const BT_HDR* fragment = (const BT_HDR*)list_node(node);
+    reassembled.insert(reassembled.end(), fragment->data + fragment->offset,
+                       fragment->data + fragment->offset + fragment->len);
+  }
+  CHECK(VerifyData(reassembled.data() + sizeof(AclL2capPacketHeader),
+                   packet_size));
+
+  // Too large for a single buffer, legacy consumers cannot take it.
+  CHECK(flatten_chain(chain) == nullptr);
+}
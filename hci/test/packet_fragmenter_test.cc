@@ -302,6 +302,7 @@ class PacketFragmenterTest : public AllocationTestHarness {
     callbacks.fragmented = fragmented_callback;
     callbacks.reassembled = reassembled_callback;
     callbacks.transmit_finished = transmit_finished_callback;
+    callbacks.reassembled_chain = NULL;
     controller.get_acl_data_size_classic = get_acl_data_size_classic;
     controller.get_acl_data_size_ble = get_acl_data_size_ble;
 
@@ -43,11 +43,37 @@ typedef void (*scan_result_callback)(uint16_t event_type, uint8_t addr_type,
                                      int8_t rssi, uint16_t periodic_adv_int,
                                      std::vector<uint8_t> adv_data);
 
+/** One scan result of a batch, its advertising data is in the batch buffer */
+typedef struct {
+  uint16_t event_type;
+  uint8_t addr_type;
+  RawAddress bda;
+  uint8_t primary_phy;
+  uint8_t secondary_phy;
+  uint8_t advertising_sid;
+  int8_t tx_power;
+  int8_t rssi;
+  uint16_t periodic_adv_int;
+  /* Position of the advertising data in the batch buffer */
+  uint32_t data_offset;
+  uint16_t data_len;
+} btgatt_scan_result_t;
+
+/** Callback for the scan results gathered over a batching window. |results|
+ *  and |data| are only valid for the duration of the call. */
+typedef void (*scan_results_batch_callback)(const btgatt_scan_result_t* results,
+                                            size_t num_results,
+                                            const uint8_t* data,
+                                            size_t data_len);
+
 typedef struct {
   scan_result_callback scan_result_cb;
   batchscan_reports_callback batchscan_reports_cb;
   batchscan_threshold_callback batchscan_threshold_cb;
   track_adv_event_callback track_adv_event_cb;
+  /* Optional, the results are delivered one by one through scan_result_cb
+   * when it is not set */
+  scan_results_batch_callback scan_results_batch_cb;
 } btgatt_scanner_callbacks_t;
 
 class BleScannerInterface {
@@ -177,6 +177,16 @@ typedef struct {
       const RawAddress& bd_addr,
       base::Callback<void(uint8_t tx_phy, uint8_t rx_phy, uint8_t status)> cb);
 
+  /** Have the stack answer the reads of a characteristic or descriptor with
+   * |value|, at any offset, instead of calling request_read_*_cb. Called
+   * again whenever the value changes; a write from a client drops it. */
+  bt_status_t (*set_cached_value)(int server_if, int attribute_handle,
+                                  std::vector<uint8_t> value);
+
+  /** Send the reads of an attribute cached by set_cached_value to the
+   * application again */
+  bt_status_t (*invalidate_cached_value)(int server_if, int attribute_handle);
+
 } btgatt_server_interface_t;
 
 __END_DECLS
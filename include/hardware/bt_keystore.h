@@ -14,6 +14,10 @@
  * limitations under the License.
  */
 
+#include <map>
+#include <string>
+#include <vector>
+
 namespace bluetooth {
 namespace bluetooth_keystore {
 
@@ -27,6 +31,30 @@ class BluetoothKeystoreCallbacks {
 
   /** Callback for get key. */
   virtual std::string get_key(std::string prefix) = 0;
+
+  /**
+   * Callback for encrypting or removing several keys in one round trip. A key
+   * with an empty string is removed. The default makes one call per key.
+   */
+  virtual void set_encrypt_keys_or_remove_keys(
+      const std::map<std::string, std::string>& keys) {
+    for (const auto& key : keys) {
+      set_encrypt_key_or_remove_key(key.first, key.second);
+    }
+  }
+
+  /**
+   * Callback for getting several keys in one round trip. The default makes
+   * one call per key.
+   */
+  virtual std::map<std::string, std::string> get_keys(
+      const std::vector<std::string>& prefixes) {
+    std::map<std::string, std::string> keys;
+    for (const std::string& prefix : prefixes) {
+      keys[prefix] = get_key(prefix);
+    }
+    return keys;
+  }
 };
 
 class BluetoothKeystoreInterface {
@@ -43,6 +71,12 @@ class BluetoothKeystoreInterface {
   /** Interface for get key. */
   virtual std::string get_key(std::string prefix) = 0;
 
+  /**
+   * Interface for getting several keys, fetching the ones not cached yet in
+   * one round trip.
+   */
+  virtual void prefetch_keys(const std::vector<std::string>& prefixes) = 0;
+
   /** Interface for clear map. */
   virtual void clear_map() = 0;
 };
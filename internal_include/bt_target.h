@@ -310,9 +310,30 @@
 #define BTM_SCO_DATA_SIZE_MAX 240
 #endif
 
-/* The size in bytes of the BTM inquiry database. */
+/* The maximum number of entries in the BTM inquiry database. Entries are
+ * allocated as devices are found. */
 #ifndef BTM_INQ_DB_SIZE
-#define BTM_INQ_DB_SIZE 40
+#define BTM_INQ_DB_SIZE 256
+#endif
+
+/* The RSSI change, in dBm, for a repeated inquiry response of a device whose
+ * EIR is unchanged to be reported again. */
+#ifndef BTM_INQ_RSSI_UPDATE_DELTA
+#define BTM_INQ_RSSI_UPDATE_DELTA 5
+#endif
+
+/* The number of remote names kept by BTM, and for how long. */
+#ifndef BTM_RMT_NAME_CACHE_SIZE
+#define BTM_RMT_NAME_CACHE_SIZE 32
+#endif
+#ifndef BTM_RMT_NAME_CACHE_TTL_MS
+#define BTM_RMT_NAME_CACHE_TTL_MS (30 * 60 * 1000)
+#endif
+
+/* The number of devices whose remote name requests can wait for the one in
+ * progress. */
+#ifndef BTM_RMT_NAME_QUEUE_SIZE
+#define BTM_RMT_NAME_QUEUE_SIZE 8
 #endif
 
 /* The default scan mode */
@@ -590,6 +611,12 @@
 #define L2CAP_ROUND_ROBIN_CHANNEL_SERVICE TRUE
 #endif
 
+/* Collect per channel queue delay and traffic statistics, reported in the
+ * dumpsys output and the metrics */
+#ifndef L2CAP_CHANNEL_STATS
+#define L2CAP_CHANNEL_STATS TRUE
+#endif
+
 /* used for monitoring eL2CAP data flow */
 #ifndef L2CAP_ERTM_STATS
 #define L2CAP_ERTM_STATS FALSE
@@ -702,6 +729,12 @@
 #define SMP_MAX_ENC_KEY_SIZE 16
 #endif
 
+/* Number of local LE Secure Connections key pairs generated ahead of pairing.
+ * Must be at least 1. */
+#ifndef SMP_KEY_POOL_SIZE
+#define SMP_KEY_POOL_SIZE 2
+#endif
+
 /* minimum link timeout after SMP pairing is done, leave room for key exchange
    and racing condition for the following service connection.
    Prefer greater than 0 second, and no less than default inactivity link idle
@@ -795,7 +828,9 @@
  *
  *****************************************************************************/
 
-/* The maximum number of ports supported. */
+/* The maximum number of ports supported. A port is used by each RFCOMM
+ * server and by each connection, so multi-client SPP gateways may raise it,
+ * up to 127 as the BTA JV handles hold a port index in 7 bits. */
 #ifndef MAX_RFC_PORTS
 #define MAX_RFC_PORTS 30
 #endif
@@ -837,6 +872,12 @@
 #define PORT_RX_BUF_CRITICAL_WM 15
 #endif
 
+/* The maximum number of credits the receive window of a port grows to when data
+ * is delivered to the user through a callback. */
+#ifndef PORT_RX_CREDIT_MAX
+#define PORT_RX_CREDIT_MAX 32
+#endif
+
 /* The port transmit queue high watermark level, in bytes. */
 #ifndef PORT_TX_HIGH_WM
 #define PORT_TX_HIGH_WM (BTA_RFC_MTU_SIZE * PORT_TX_BUF_HIGH_WM)
@@ -33,6 +33,11 @@ typedef struct {
   bool (*get_pts_crosskey_sdp_disable)(void);
   const std::string* (*get_pts_smp_options)(void);
   int (*get_pts_smp_failure_case)(void);
+  int (*get_ble_adv_duplicate_filter_ms)(void);
+  bool (*get_parallel_service_discovery)(void);
+  int (*get_buffer_budget_bytes)(void);
+  const std::string* (*get_hci_replay_snoop_log)(void);
+  bool (*get_hci_replay_paced)(void);
   config_t* (*get_all)(void);
 } stack_config_t;
 
@@ -42,9 +42,11 @@
 #include "bta_api.h"
 #include "btcore/include/module.h"
 #include "bte.h"
+#include "btm_iso_api.h"
 #include "btif_common.h"
 #include "btsnoop.h"
 #include "btu.h"
+#include "common/time_util.h"
 #include "device/include/interop.h"
 #include "hci_layer.h"
 #include "hcimsgs.h"
@@ -83,7 +85,7 @@ static const hci_t* hci;
 /*******************************************************************************
  *  Externs
  ******************************************************************************/
-extern void btu_hci_msg_process(BT_HDR* p_msg);
+extern void btu_hci_msg_process_at(BT_HDR* p_msg, uint64_t rx_timestamp_us);
 
 /*******************************************************************************
  *  Static functions
@@ -93,13 +95,23 @@ extern void btu_hci_msg_process(BT_HDR* p_msg);
  *
  * Function         post_to_hci_message_loop
  *
- * Description      Post an HCI event to the main thread
+ * Description      Post an HCI event to the main thread, with the time it
+ *                  was received. ISO data goes to the ISO shard instead.
  *
  * Returns          None
  *
  *****************************************************************************/
 void post_to_main_message_loop(const base::Location& from_here, BT_HDR* p_msg) {
-  if (do_in_main_thread(from_here, base::Bind(&btu_hci_msg_process, p_msg)) !=
+  uint64_t rx_timestamp_us = bluetooth::common::time_get_os_boottime_us();
+  if ((p_msg->event & BT_EVT_MASK) == BT_EVT_TO_BTU_HCI_ISO) {
+    /* The ISO data path stays off the main thread */
+    do_in_shard_thread(
+        BTU_SHARD_ISO, from_here,
+        base::BindOnce(&btm_iso_data_received, p_msg, rx_timestamp_us));
+    return;
+  }
+  if (do_in_main_thread(from_here, base::Bind(&btu_hci_msg_process_at, p_msg,
+                                              rx_timestamp_us)) !=
       BT_STATUS_SUCCESS) {
     LOG(ERROR) << __func__ << ": do_in_main_thread failed from "
                << from_here.ToString();
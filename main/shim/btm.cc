@@ -39,6 +39,7 @@
 #include "neighbor/inquiry.h"
 #include "neighbor/name.h"
 #include "neighbor/page.h"
+#include "neighbor/scan_scheduler.h"
 #include "security/security_module.h"
 #include "shim/controller.h"
 
@@ -601,6 +602,8 @@ void bluetooth::shim::Btm::StartActiveScanning() {
 
 void bluetooth::shim::Btm::StopActiveScanning() {
   bluetooth::shim::GetScanning()->StopScan(base::Bind([]() {}));
+  bluetooth::shim::GetScanScheduler()->SetWorkloadActive(
+      neighbor::Workload::LE_SCAN, false);
 }
 
 void bluetooth::shim::Btm::SetScanningTimer(uint64_t duration_ms,
@@ -780,6 +783,8 @@ bluetooth::hci::BtmScanningCallbacks btm_scanning_callbacks;
 
 void bluetooth::shim::Btm::StartScanning(bool use_active_scanning) {
   bluetooth::shim::GetScanning()->StartScan(&btm_scanning_callbacks);
+  bluetooth::shim::GetScanScheduler()->SetWorkloadActive(
+      neighbor::Workload::LE_SCAN, true);
 }
 
 size_t bluetooth::shim::Btm::GetNumberOfAdvertisingInstances() const {
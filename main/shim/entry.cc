@@ -18,6 +18,7 @@
 #include "osi/include/future.h"
 #include "osi/include/log.h"
 
+#include "hci/acl_manager.h"
 #include "hci/controller.h"
 #include "hci/hci_layer.h"
 #include "hci/le_advertising_manager.h"
@@ -28,6 +29,7 @@
 #include "neighbor/inquiry.h"
 #include "neighbor/name.h"
 #include "neighbor/page.h"
+#include "neighbor/scan_scheduler.h"
 #include "os/handler.h"
 #include "security/security_module.h"
 #include "shim/dumpsys.h"
@@ -55,6 +57,12 @@ bluetooth::os::Handler* bluetooth::shim::GetGdShimHandler() {
   return bluetooth::shim::GetDumpsys()->GetGdShimHandler();
 }
 
+bluetooth::hci::AclManager* bluetooth::shim::GetAclManager() {
+  return GetGabeldorscheStack()
+      ->GetStackManager()
+      ->GetInstance<bluetooth::hci::AclManager>();
+}
+
 bluetooth::hci::LeAdvertisingManager* bluetooth::shim::GetAdvertising() {
   return GetGabeldorscheStack()
       ->GetStackManager()
@@ -123,6 +131,12 @@ bluetooth::hci::LeScanningManager* bluetooth::shim::GetScanning() {
       ->GetInstance<bluetooth::hci::LeScanningManager>();
 }
 
+bluetooth::neighbor::ScanSchedulerModule* bluetooth::shim::GetScanScheduler() {
+  return GetGabeldorscheStack()
+      ->GetStackManager()
+      ->GetInstance<bluetooth::neighbor::ScanSchedulerModule>();
+}
+
 bluetooth::security::SecurityModule* bluetooth::shim::GetSecurityModule() {
   return GetGabeldorscheStack()
       ->GetStackManager()
@@ -42,8 +42,10 @@ class DiscoverabilityModule;
 class InquiryModule;
 class NameModule;
 class PageModule;
+class ScanSchedulerModule;
 }
 namespace hci {
+class AclManager;
 class Controller;
 class HciLayer;
 class LeAdvertisingManager;
@@ -64,6 +66,7 @@ future_t* StopGabeldorscheStack();
 /* This returns a handler that might be used in shim to receive callbacks from
  * within the stack. */
 os::Handler* GetGdShimHandler();
+hci::AclManager* GetAclManager();
 hci::LeAdvertisingManager* GetAdvertising();
 bluetooth::hci::Controller* GetController();
 neighbor::DiscoverabilityModule* GetDiscoverability();
@@ -75,6 +78,7 @@ L2cap* GetL2cap();
 neighbor::NameModule* GetName();
 neighbor::PageModule* GetPage();
 hci::LeScanningManager* GetScanning();
+neighbor::ScanSchedulerModule* GetScanScheduler();
 bluetooth::security::SecurityModule* GetSecurityModule();
 storage::LegacyModule* GetStorage();
 
@@ -17,10 +17,13 @@
 #define LOG_TAG "bt_shim_l2cap"
 
 #include "main/shim/l2c_api.h"
+#include "main/shim/entry.h"
 #include "main/shim/l2cap.h"
 #include "main/shim/shim.h"
 #include "osi/include/log.h"
 
+#include "hci/acl_manager.h"
+
 static bluetooth::shim::legacy::L2cap shim_l2cap;
 
 /**
@@ -213,8 +216,15 @@ bool bluetooth::shim::L2CA_SetIdleTimeoutByBdAddr(const RawAddress& bd_addr,
 
 bool bluetooth::shim::L2CA_SetAclPriority(const RawAddress& bd_addr,
                                           uint8_t priority) {
-  LOG_INFO(LOG_TAG, "UNIMPLEMENTED %s", __func__);
-  return false;
+  if (priority != L2CAP_PRIORITY_NORMAL && priority != L2CAP_PRIORITY_HIGH) {
+    LOG_WARN(LOG_TAG, "%s invalid priority %hhu", __func__, priority);
+    return false;
+  }
+  bluetooth::shim::GetAclManager()->SetAclPriority(
+      bluetooth::hci::Address(bd_addr.address),
+      priority == L2CAP_PRIORITY_HIGH ? bluetooth::hci::AclPriority::HIGH
+                                      : bluetooth::hci::AclPriority::NORMAL);
+  return true;
 }
 
 bool bluetooth::shim::L2CA_SetFlushTimeout(const RawAddress& bd_addr,
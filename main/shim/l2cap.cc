@@ -16,6 +16,8 @@
 #define LOG_TAG "bt_shim_l2cap"
 
 #include <cstdint>
+#include <cstring>
+#include <memory>
 
 #include "main/shim/dumpsys.h"
 #include "main/shim/entry.h"
@@ -24,6 +26,9 @@
 #include "osi/include/allocator.h"
 #include "osi/include/log.h"
 
+#include "packet/packet_view.h"
+#include "packet/view.h"
+#include "packet/view_builder.h"
 #include "shim/l2cap.h"
 
 namespace {
@@ -302,24 +307,37 @@ void bluetooth::shim::legacy::L2cap::OnRemoteInitiatedConnectionCreated(
 
 bool bluetooth::shim::legacy::L2cap::Write(uint16_t cid, BT_HDR* bt_hdr) {
   CHECK(bt_hdr != nullptr);
-  const uint8_t* data = bt_hdr->data + bt_hdr->offset;
   size_t len = bt_hdr->len;
   if (!ConnectionExists(cid) || len == 0) {
+    // Like L2CA_DataWrite, the buffer is taken over even if it is not sent
+    osi_free(bt_hdr);
     return false;
   }
   LOG_DEBUG(LOG_TAG, "Writing data cid:%hd len:%zd", cid, len);
-  bluetooth::shim::GetL2cap()->Write(cid, data, len);
+  // The payload is sent from |bt_hdr| itself: the gd packet takes it over and
+  // frees it once the last view of it is gone, on the gd thread.
+  std::shared_ptr<const uint8_t> payload(
+      bt_hdr->data + bt_hdr->offset,
+      [bt_hdr](const uint8_t*) { osi_free(bt_hdr); });
+  bluetooth::shim::GetL2cap()->Write(
+      cid, std::make_unique<bluetooth::packet::ViewBuilder>(
+               bluetooth::packet::View(std::move(payload), len)));
   return true;
 }
 
 void bluetooth::shim::legacy::L2cap::SetDownstreamCallbacks(uint16_t cid) {
+  // The legacy stack takes over the BT_HDR it receives and needs the data
+  // right after the header, so the packet lent by gd is copied once.
   bluetooth::shim::GetL2cap()->SetReadDataReadyCallback(
-      cid, [this](uint16_t cid, std::vector<const uint8_t> data) {
-        LOG_DEBUG(LOG_TAG, "OnDataReady cid:%hd len:%zd", cid, data.size());
+      cid, [this](uint16_t cid,
+                  const bluetooth::packet::PacketView<
+                      bluetooth::packet::kLittleEndian>& packet) {
+        LOG_DEBUG(LOG_TAG, "OnDataReady cid:%hd len:%zd", cid, packet.size());
         BT_HDR* bt_hdr =
-            static_cast<BT_HDR*>(osi_calloc(data.size() + kBtHdrSize));
-        std::copy(data.begin(), data.end(), bt_hdr->data);
-        bt_hdr->len = data.size();
+            static_cast<BT_HDR*>(osi_malloc(packet.size() + kBtHdrSize));
+        memset(bt_hdr, 0, kBtHdrSize);
+        packet.CopyTo(bt_hdr->data);
+        bt_hdr->len = packet.size();
         classic_.Callbacks(CidToPsm(cid))->pL2CA_DataInd_Cb(cid, bt_hdr);
       });
 
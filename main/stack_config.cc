@@ -22,8 +22,13 @@
 
 #include <base/logging.h>
 
+#include <algorithm>
+
+#include "common/thread_scheduling.h"
+#include "os/thread.h"
 #include "osi/include/future.h"
 #include "osi/include/log.h"
+#include "osi/include/wakelock.h"
 
 namespace {
 const char* TRACE_CONFIG_ENABLED_KEY = "TraceConf";
@@ -33,10 +38,46 @@ const char* PTS_LE_CONN_UPDATED_DISABLED = "PTS_DisableConnUpdates";
 const char* PTS_DISABLE_SDP_LE_PAIR = "PTS_DisableSDPOnLEPair";
 const char* PTS_SMP_PAIRING_OPTIONS_KEY = "PTS_SmpOptions";
 const char* PTS_SMP_FAILURE_CASE_KEY = "PTS_SmpFailureCase";
+const char* BLE_ADV_DUPLICATE_FILTER_MS_KEY = "BleAdvDuplicateFilterMs";
+const char* PARALLEL_SERVICE_DISCOVERY_KEY = "ParallelServiceDiscovery";
+const char* BUFFER_BUDGET_BYTES_KEY = "BufferBudgetBytes";
+const int BUFFER_BUDGET_BYTES_DEFAULT = 1024 * 1024;
+const char* HCI_REPLAY_SNOOP_LOG_KEY = "HciReplaySnoopLog";
+const char* HCI_REPLAY_PACED_KEY = "HciReplayPaced";
+const char* THREAD_SCHEDULING_SECTION = "ThreadScheduling";
+const char* WAKELOCK_RELEASE_HOLDOFF_MS_KEY = "WakelockReleaseHoldoffMs";
 
 static std::unique_ptr<config_t> config;
 }  // namespace
 
+// Registers the scheduling profiles of the ThreadScheduling section, keyed
+// by thread name, for both the legacy and the gd threads started from now on.
+static void load_thread_scheduling_profiles(const config_t& config) {
+  bluetooth::common::ClearThreadSchedulingProfiles();
+  auto section = config.sections.begin();
+  for (; section != config.sections.end(); ++section) {
+    if (section->name == THREAD_SCHEDULING_SECTION) break;
+  }
+  if (section == config.sections.end()) return;
+
+  for (const entry_t& entry : section->entries) {
+    bluetooth::common::ThreadSchedulingProfile profile;
+    if (!bluetooth::common::ParseThreadSchedulingProfile(entry.value,
+                                                         &profile)) {
+      LOG_ERROR(LOG_TAG, "%s invalid scheduling profile %s=%s", __func__,
+                entry.key.c_str(), entry.value.c_str());
+      continue;
+    }
+    bluetooth::common::SetThreadSchedulingProfile(entry.key, profile);
+  }
+
+  bluetooth::os::Thread::SetSchedulingHook(
+      [](const std::string& name, pid_t linux_tid) {
+        return bluetooth::common::ApplyThreadSchedulingProfile(name,
+                                                               linux_tid);
+      });
+}
+
 // Module lifecycle functions
 
 static future_t* init() {
@@ -56,6 +97,11 @@ static future_t* init() {
     config = config_new_empty();
   }
 
+  load_thread_scheduling_profiles(*config);
+  wakelock_set_release_holdoff_ms(std::max(
+      0, config_get_int(*config, CONFIG_DEFAULT_SECTION,
+                        WAKELOCK_RELEASE_HOLDOFF_MS_KEY, 0)));
+
   return future_new_immediate(FUTURE_SUCCESS);
 }
 
@@ -108,12 +154,40 @@ static int get_pts_smp_failure_case(void) {
                         PTS_SMP_FAILURE_CASE_KEY, 0);
 }
 
+static int get_ble_adv_duplicate_filter_ms(void) {
+  return config_get_int(*config, CONFIG_DEFAULT_SECTION,
+                        BLE_ADV_DUPLICATE_FILTER_MS_KEY, 0);
+}
+
+static bool get_parallel_service_discovery(void) {
+  return config_get_bool(*config, CONFIG_DEFAULT_SECTION,
+                         PARALLEL_SERVICE_DISCOVERY_KEY, false);
+}
+
+static int get_buffer_budget_bytes(void) {
+  return config_get_int(*config, CONFIG_DEFAULT_SECTION,
+                        BUFFER_BUDGET_BYTES_KEY, BUFFER_BUDGET_BYTES_DEFAULT);
+}
+
+static const std::string* get_hci_replay_snoop_log(void) {
+  return config_get_string(*config, CONFIG_DEFAULT_SECTION,
+                           HCI_REPLAY_SNOOP_LOG_KEY, NULL);
+}
+
+static bool get_hci_replay_paced(void) {
+  return config_get_bool(*config, CONFIG_DEFAULT_SECTION, HCI_REPLAY_PACED_KEY,
+                         false);
+}
+
 static config_t* get_all(void) { return config.get(); }
 
 const stack_config_t interface = {
-    get_trace_config_enabled,     get_pts_avrcp_test,
-    get_pts_secure_only_mode,     get_pts_conn_updates_disabled,
-    get_pts_crosskey_sdp_disable, get_pts_smp_options,
-    get_pts_smp_failure_case,     get_all};
+    get_trace_config_enabled,       get_pts_avrcp_test,
+    get_pts_secure_only_mode,       get_pts_conn_updates_disabled,
+    get_pts_crosskey_sdp_disable,   get_pts_smp_options,
+    get_pts_smp_failure_case,       get_ble_adv_duplicate_filter_ms,
+    get_parallel_service_discovery, get_buffer_budget_bytes,
+    get_hci_replay_snoop_log,       get_hci_replay_paced,
+    get_all};
 
 const stack_config_t* stack_config_get_interface(void) { return &interface; }
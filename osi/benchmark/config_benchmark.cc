@@ -0,0 +1,119 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <base/files/file_util.h>
+#include <base/logging.h>
+#include <base/strings/stringprintf.h>
+#include <benchmark/benchmark.h>
+#include <openssl/sha.h>
+#include <filesystem>
+#include <string>
+
+#include "osi/include/config.h"
+
+using ::benchmark::State;
+
+namespace {
+
+// About the size of bt_config.conf on a phone that has been paired with a few
+// thousand devices over its life
+constexpr size_t kConfigSize = 1024 * 1024;
+
+// One paired device, with the keys btif stores for a dual mode device
+std::string DeviceSection(int i) {
+  std::string hex_key(32, '0' + i % 10);
+  std::string section = base::StringPrintf(
+      "[%02x:%02x:%02x:%02x:%02x:%02x]\n", i >> 8 & 0xff, i & 0xff, 0x11, 0x22,
+      0x33, 0x44);
+  section += "Timestamp = " + std::to_string(1500000000 + i) + "\n";
+  section += "Name = Device " + std::to_string(i) + "\n";
+  section += "DevClass = 2360344\nDevType = 3\nAddrType = 0\n";
+  section += "Manufacturer = 15\nLmpVer = 9\nLmpSubVer = 8711\n";
+  section +=
+      "Service = 0000110a-0000-1000-8000-00805f9b34fb "
+      "0000110b-0000-1000-8000-00805f9b34fb "
+      "0000110e-0000-1000-8000-00805f9b34fb "
+      "0000111e-0000-1000-8000-00805f9b34fb\n";
+  section += "LinkKeyType = 5\nPinLength = 0\nLinkKey = " + hex_key + "\n";
+  section += "LE_KEY_PENC = " + hex_key + hex_key + "\n";
+  section += "LE_KEY_PID = " + hex_key + hex_key + "\n";
+  section += "LE_KEY_LENC = " + hex_key + "\n\n";
+  return section;
+}
+
+class BM_Config : public ::benchmark::Fixture {
+ protected:
+  void SetUp(State& st) override {
+    ::benchmark::Fixture::SetUp(st);
+    std::string contents =
+        "[Info]\nFileSource = Empty\nTimeCreated = 2020-05-05 12:00:00\n\n"
+        "[Adapter]\nAddress = 00:11:22:33:44:55\nLE_LOCAL_KEY_IRK = "
+        "00112233445566778899aabbccddeeff\nDiscoveryTimeout = 120\n\n";
+    for (int i = 0; contents.size() < kConfigSize; i++) {
+      contents += DeviceSection(i);
+    }
+    CHECK(base::WriteFile(base::FilePath(path_.string()), contents.data(),
+                          contents.size()) == (int)contents.size());
+  }
+
+  void TearDown(State& st) override {
+    std::filesystem::remove(path_);
+    ::benchmark::Fixture::TearDown(st);
+  }
+
+  const std::filesystem::path path_ =
+      std::filesystem::temp_directory_path() / "config_benchmark.conf";
+};
+
+BENCHMARK_DEFINE_F(BM_Config, config_new)(State& state) {
+  for (auto _ : state) {
+    auto config = config_new(path_.c_str());
+    CHECK(config != nullptr);
+  }
+  state.SetBytesProcessed(state.iterations() * kConfigSize);
+}
+
+// Parsing and checksumming in one pass over the file
+BENCHMARK_DEFINE_F(BM_Config, config_new_with_checksum)(State& state) {
+  for (auto _ : state) {
+    std::string checksum;
+    auto config = config_new_with_checksum(path_.c_str(), &checksum);
+    CHECK(config != nullptr);
+    benchmark::DoNotOptimize(checksum);
+  }
+  state.SetBytesProcessed(state.iterations() * kConfigSize);
+}
+
+// Parsing, then reading the file again to checksum it
+BENCHMARK_DEFINE_F(BM_Config, config_new_then_checksum)(State& state) {
+  for (auto _ : state) {
+    auto config = config_new(path_.c_str());
+    CHECK(config != nullptr);
+    std::string contents;
+    CHECK(base::ReadFileToString(base::FilePath(path_.string()), &contents));
+    uint8_t digest[SHA256_DIGEST_LENGTH];
+    SHA256(reinterpret_cast<const uint8_t*>(contents.data()), contents.size(),
+           digest);
+    benchmark::DoNotOptimize(digest);
+  }
+  state.SetBytesProcessed(state.iterations() * kConfigSize);
+}
+
+BENCHMARK_REGISTER_F(BM_Config, config_new);
+BENCHMARK_REGISTER_F(BM_Config, config_new_with_checksum);
+BENCHMARK_REGISTER_F(BM_Config, config_new_then_checksum);
+
+}  // namespace
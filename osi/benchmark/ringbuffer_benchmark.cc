@@ -0,0 +1,180 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <base/logging.h>
+#include <benchmark/benchmark.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "osi/include/ringbuffer.h"
+#include "osi/include/spsc_ringbuffer.h"
+
+using ::benchmark::State;
+
+namespace {
+
+// Large enough for a few media packets, as in the audio paths
+constexpr size_t kRingSize = 16 * 1024;
+
+// Each benchmark streams chunks of state.range(0) bytes from the benchmark
+// thread to a consumer thread, which drains the ring until told to stop.
+// The producer spins while the ring is full, so the time includes waiting
+// for the consumer.
+
+// The way ringbuffer_t is shared between threads today: one lock around
+// every call.
+class MutexRingbuffer {
+ public:
+  MutexRingbuffer() : rb_(ringbuffer_init(kRingSize)) {}
+  ~MutexRingbuffer() { ringbuffer_free(rb_); }
+
+  size_t Insert(const uint8_t* p, size_t length) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return ringbuffer_insert(rb_, p, length);
+  }
+
+  size_t Pop(uint8_t* p, size_t length) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return ringbuffer_pop(rb_, p, length);
+  }
+
+  size_t Size() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return ringbuffer_size(rb_);
+  }
+
+ private:
+  std::mutex mutex_;
+  ringbuffer_t* rb_;
+};
+
+class SpscRingbuffer {
+ public:
+  SpscRingbuffer() : rb_(spsc_ringbuffer_init(kRingSize)) {}
+  ~SpscRingbuffer() { spsc_ringbuffer_free(rb_); }
+
+  size_t Insert(const uint8_t* p, size_t length) {
+    return spsc_ringbuffer_insert(rb_, p, length);
+  }
+
+  size_t Pop(uint8_t* p, size_t length) {
+    return spsc_ringbuffer_pop(rb_, p, length);
+  }
+
+  size_t Size() { return spsc_ringbuffer_size(rb_); }
+
+  spsc_ringbuffer_t* get() { return rb_; }
+
+ private:
+  spsc_ringbuffer_t* rb_;
+};
+
+template <typename Ring>
+void RunStream(State& state, Ring* ring) {
+  std::atomic<bool> stop(false);
+  const size_t chunk_size = state.range(0);
+
+  std::thread consumer([ring, chunk_size, &stop]() {
+    std::vector<uint8_t> chunk(chunk_size);
+    while (!stop.load(std::memory_order_relaxed) || ring->Size() > 0) {
+      if (ring->Pop(chunk.data(), chunk.size()) == 0) std::this_thread::yield();
+    }
+  });
+
+  std::vector<uint8_t> chunk(chunk_size, 0x5A);
+  for (auto _ : state) {
+    size_t done = 0;
+    while (done < chunk.size()) {
+      done += ring->Insert(chunk.data() + done, chunk.size() - done);
+    }
+  }
+
+  stop.store(true);
+  consumer.join();
+  state.SetBytesProcessed(state.iterations() * chunk_size);
+}
+
+void BM_MutexRingbuffer(State& state) {
+  MutexRingbuffer ring;
+  RunStream(state, &ring);
+}
+
+void BM_SpscRingbuffer(State& state) {
+  SpscRingbuffer ring;
+  RunStream(state, &ring);
+}
+
+// Both sides work in place in the ring, without the intermediate copies
+void BM_SpscRingbufferInPlace(State& state) {
+  spsc_ringbuffer_t* rb = spsc_ringbuffer_init(kRingSize);
+  std::atomic<bool> stop(false);
+  const size_t chunk_size = state.range(0);
+
+  std::thread consumer([rb, &stop]() {
+    uint64_t checksum = 0;
+    while (!stop.load(std::memory_order_relaxed) ||
+           spsc_ringbuffer_size(rb) > 0) {
+      const uint8_t* data;
+      size_t length = spsc_ringbuffer_read_peek(rb, &data);
+      if (length == 0) {
+        std::this_thread::yield();
+        continue;
+      }
+      checksum += data[0];
+      spsc_ringbuffer_read_commit(rb, length);
+    }
+    ::benchmark::DoNotOptimize(checksum);
+  });
+
+  for (auto _ : state) {
+    size_t done = 0;
+    while (done < chunk_size) {
+      uint8_t* space;
+      size_t length =
+          std::min(spsc_ringbuffer_write_reserve(rb, &space), chunk_size - done);
+      memset(space, 0x5A, length);
+      spsc_ringbuffer_write_commit(rb, length);
+      done += length;
+    }
+  }
+
+  stop.store(true);
+  consumer.join();
+  spsc_ringbuffer_free(rb);
+  state.SetBytesProcessed(state.iterations() * chunk_size);
+}
+
+}  // namespace
+
+BENCHMARK(BM_MutexRingbuffer)->Arg(16)->Arg(128)->Arg(672)->Arg(4096);
+BENCHMARK(BM_SpscRingbuffer)->Arg(16)->Arg(128)->Arg(672)->Arg(4096);
+BENCHMARK(BM_SpscRingbufferInPlace)->Arg(16)->Arg(128)->Arg(672)->Arg(4096);
+
+int main(int argc, char** argv) {
+  // Disable LOG() output from libchrome
+  logging::LoggingSettings log_settings;
+  log_settings.logging_dest = logging::LoggingDestination::LOG_NONE;
+  CHECK(logging::InitLogging(log_settings)) << "Failed to set up logging";
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  ::benchmark::RunSpecifiedBenchmarks();
+}
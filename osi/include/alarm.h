@@ -79,6 +79,20 @@ void alarm_set(alarm_t* alarm, uint64_t interval_ms, alarm_callback_t cb,
 void alarm_set_on_mloop(alarm_t* alarm, uint64_t interval_ms,
                         alarm_callback_t cb, void* data);
 
+// Sets an |alarm| that may expire up to |slack_ms| after its deadline. This
+// function is same as |alarm_set| otherwise. The alarm doesn't wake the
+// system up before its deadline plus |slack_ms|, but it expires along with
+// any other alarm that does after its deadline, so that non-critical timers
+// share wakeups. Latency-critical alarms should use |alarm_set|.
+void alarm_set_with_slack(alarm_t* alarm, uint64_t interval_ms,
+                          uint64_t slack_ms, alarm_callback_t cb, void* data);
+
+// Same as |alarm_set_with_slack|, except that the |cb| callback is scheduled
+// for execution in the context of the main message loop.
+void alarm_set_on_mloop_with_slack(alarm_t* alarm, uint64_t interval_ms,
+                                   uint64_t slack_ms, alarm_callback_t cb,
+                                   void* data);
+
 // This function cancels the |alarm| if it was previously set.
 // When this call returns, the caller has a guarantee that the
 // callback is not in progress and will not be called if it
@@ -38,6 +38,10 @@ void allocation_tracker_reset(void);
 // unallocated memory.
 size_t allocation_tracker_expect_no_allocations(void);
 
+// Returns the number of allocations the tracker has been notified of. It
+// counts nothing until the tracker is initialized.
+size_t allocation_tracker_alloc_count(void);
+
 // Notify the tracker of a new allocation belonging to |allocator_id|.
 // If |ptr| is NULL, this function does nothing. |requested_size| is the
 // size of the allocation without any canaries. The caller must allocate
@@ -57,3 +61,26 @@ void* allocation_tracker_notify_free(allocator_id_t allocator_id, void* ptr);
 // Get the full size for an allocation, taking into account the size of
 // canaries.
 size_t allocation_tracker_resize_for_canary(size_t size);
+
+// Sampling heap profiler, cheap enough to be left on in production. About one
+// in |interval| bytes allocated through osi_malloc and friends is sampled,
+// along with the return address of its caller and the name of the thread,
+// which stands for the subsystem, that allocated it. Allocations of at least
+// |interval| bytes are always sampled. The estimated allocated and live bytes
+// of each call site and subsystem are dumped by |osi_allocator_debug_dump|.
+//
+// Sets the sampling interval in bytes and clears the samples taken so far. An
+// |interval| of 0, the default, stops the sampling.
+void allocation_tracker_set_sampling_interval(size_t interval);
+
+// Notify the sampler of an allocation of |size| bytes at |ptr|, requested by
+// the code at |caller|. If |ptr| is NULL, this function does nothing.
+void allocation_tracker_sample_alloc(void* ptr, size_t size,
+                                     const void* caller);
+
+// Notify the sampler of the allocation at |ptr| being freed. If |ptr| is NULL,
+// or was not sampled, this function does nothing.
+void allocation_tracker_sample_free(void* ptr);
+
+// Returns the number of sampled allocations that are not freed yet.
+size_t allocation_tracker_sampled_count(void);
@@ -54,6 +54,12 @@ std::unique_ptr<config_t> config_new_empty(void);
 // file on the filesystem.
 std::unique_ptr<config_t> config_new(const char* filename);
 
+// Loads the specified file like |config_new| and, in the same pass over the
+// file, computes the hex encoded SHA-256 digest of its contents into
+// |checksum|. |filename| and |checksum| must not be NULL.
+std::unique_ptr<config_t> config_new_with_checksum(const char* filename,
+                                                   std::string* checksum);
+
 // Read the checksum from the |filename|
 std::string checksum_read(const char* filename);
 
@@ -142,6 +148,31 @@ bool config_remove_key(config_t* config, const std::string& section,
 // be lost. Neither |config| nor |filename| may be NULL.
 bool config_save(const config_t& config, const std::string& filename);
 
+// Creates an empty journal |filename| for the config file whose journal
+// generation is |generation|, replacing any existing journal. The file is
+// written and synced like |config_save| does. Returns true on success.
+// |filename| may not be empty.
+bool config_journal_reset(const std::string& filename,
+                          const std::string& generation);
+
+// Appends the changes that turn |old_config| into |new_config| to the journal
+// |filename| as one transaction, and syncs the journal's data to disk. Nothing
+// is written if the configs are equal. If |journal_size| is not NULL, it is
+// set to the size of the journal in bytes. Returns false if the journal does
+// not exist or could not be written, in which case the caller should fall
+// back to |config_save|. |filename| may not be empty.
+bool config_journal_append(const std::string& filename,
+                           const config_t& old_config,
+                           const config_t& new_config, size_t* journal_size);
+
+// Applies the committed transactions of the journal |filename| to |config|,
+// if the journal was started for |generation|. A trailing transaction that is
+// incomplete, e.g. because of a crash while it was appended, is dropped.
+// Returns false if there is no journal for |generation|. |filename| may not
+// be empty and |config| may not be NULL.
+bool config_journal_replay(const std::string& filename,
+                           const std::string& generation, config_t* config);
+
 // Saves the encrypted |checksum| of config file to a given |filename| Note
 // that this could be a destructive operation: if |filename| already exists,
 // it will be overwritten.
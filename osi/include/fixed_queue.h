@@ -65,6 +65,14 @@ size_t fixed_queue_capacity(fixed_queue_t* queue);
 // may be NULL.
 void fixed_queue_enqueue(fixed_queue_t* queue, void* data);
 
+// Enqueues the |count| elements of |data| into the |queue|, in order. The
+// elements that fit are appended together and the dequeue side is signalled
+// once for them, so a consumer wakes up once per batch rather than once per
+// element. The caller is blocked while the queue is full. Neither |queue| nor
+// any element of |data| may be NULL.
+void fixed_queue_enqueue_batch(fixed_queue_t* queue, void* const* data,
+                               size_t count);
+
 // Dequeues the next element from |queue|. If the queue is currently empty,
 // this function will block the caller until an item is enqueued. This
 // function will never return NULL. |queue| may not be NULL.
@@ -122,9 +130,11 @@ int fixed_queue_get_enqueue_fd(const fixed_queue_t* queue);
 int fixed_queue_get_dequeue_fd(const fixed_queue_t* queue);
 
 // Registers |queue| with |reactor| for dequeue operations. When there is an
-// element in the queue, ready_cb will be called. The |context| parameter is
-// passed, untouched, to the callback routine. Neither |queue|, nor |reactor|,
-// nor |read_cb| may be NULL. |context| may be NULL.
+// element in the queue, ready_cb will be called. As long as the queue isn't
+// empty, ready_cb may be called several times in a row for one wakeup of
+// |reactor|, so it is expected to dequeue an element on each call. The
+// |context| parameter is passed, untouched, to the callback routine. Neither
+// |queue|, nor |reactor|, nor |read_cb| may be NULL. |context| may be NULL.
 void fixed_queue_register_dequeue(fixed_queue_t* queue, reactor_t* reactor,
                                   fixed_queue_cb ready_cb, void* context);
 
@@ -0,0 +1,81 @@
+/******************************************************************************
+ *
+ *  Copyright 2020 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// A bounded queue of pointers with the enqueue/dequeue API of |fixed_queue_t|,
+// for hand-offs between threads where the queue is on the hot path. Any
+// number of threads may enqueue and dequeue concurrently.
+//
+// Elements are kept in a ring of slots claimed with atomic operations, so
+// the non-blocking calls never take a lock or enter the kernel. The blocking
+// calls only sleep, on a futex, when the queue is empty or full.
+//
+// Unlike |fixed_queue_t|, there is no peek, no removal of a given element and
+// no file descriptor to register with a reactor: a queue that needs those
+// stays a |fixed_queue_t|.
+
+typedef struct mpmc_queue_t mpmc_queue_t;
+
+typedef void (*mpmc_queue_free_cb)(void* data);
+
+// Creates a new queue holding at least |capacity| elements; the capacity is
+// rounded up to a power of two. Returns NULL if |capacity| is zero or too
+// large. The caller must free the returned queue with |mpmc_queue_free|.
+mpmc_queue_t* mpmc_queue_new(size_t capacity);
+
+// Frees a queue and, if |free_cb| is not NULL, calls it on each element left
+// in the queue. Freeing a queue that has waiters blocked on it results in
+// undefined behaviour.
+void mpmc_queue_free(mpmc_queue_t* queue, mpmc_queue_free_cb free_cb);
+
+// Removes all elements of |queue| and, if |free_cb| is not NULL, calls it on
+// each of them. |queue| may be NULL.
+void mpmc_queue_flush(mpmc_queue_t* queue, mpmc_queue_free_cb free_cb);
+
+// Returns true if |queue| is empty or NULL. The answer may be stale by the
+// time it is returned if other threads use the queue.
+bool mpmc_queue_is_empty(mpmc_queue_t* queue);
+
+// Returns the number of elements in |queue|, or 0 if |queue| is NULL. The
+// answer may be stale by the time it is returned if other threads use the
+// queue.
+size_t mpmc_queue_length(mpmc_queue_t* queue);
+
+// Returns the maximum number of elements |queue| may hold. |queue| may not
+// be NULL.
+size_t mpmc_queue_capacity(mpmc_queue_t* queue);
+
+// Enqueues |data| into |queue|, blocking while the queue is full. Neither
+// |queue| nor |data| may be NULL.
+void mpmc_queue_enqueue(mpmc_queue_t* queue, void* data);
+
+// Dequeues the next element of |queue|, blocking while the queue is empty.
+// |queue| may not be NULL.
+void* mpmc_queue_dequeue(mpmc_queue_t* queue);
+
+// Enqueues |data| into |queue| if it is not full. Returns true on success,
+// false otherwise. Neither |queue| nor |data| may be NULL.
+bool mpmc_queue_try_enqueue(mpmc_queue_t* queue, void* data);
+
+// Dequeues the next element of |queue| if there is one. Returns NULL if the
+// queue is empty or |queue| is NULL.
+void* mpmc_queue_try_dequeue(mpmc_queue_t* queue);
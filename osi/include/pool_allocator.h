@@ -0,0 +1,52 @@
+/******************************************************************************
+ *
+ *  Copyright 2020 Google, Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Size-class pool allocator backing |osi_malloc| and |osi_calloc| for the
+// common BT_HDR buffer sizes (see BT_SMALL_BUFFER_SIZE and
+// BT_DEFAULT_BUFFER_SIZE in bt_target.h).
+//
+// Blocks are carved from a single arena reserved on first use. Each thread
+// keeps a small free list per size class and refills it from (or spills it
+// to) a shared depot in batches, so the common alloc/free pair does not take
+// any lock. Requests that do not fit a size class, or arrive when a class is
+// exhausted, are not served and the caller is expected to fall back to libc.
+//
+// All functions are thread safe.
+
+// Returns a block of at least |size| bytes, or NULL if |size| is not served
+// by any size class or the matching class has no free block left. The
+// contents of the block are undefined.
+void* pool_allocator_alloc(size_t size);
+
+// Returns |ptr| to its pool if it was handed out by |pool_allocator_alloc|
+// and returns true. Returns false and does nothing otherwise, including
+// when |ptr| is NULL.
+bool pool_allocator_free(void* ptr);
+
+// Returns the usable size of the size class |ptr| belongs to, or 0 if |ptr|
+// is not owned by the pool allocator.
+size_t pool_allocator_block_size(const void* ptr);
+
+// Dump per size class hit/miss counters and occupancy to the |fd| file
+// descriptor. The |fd| must be valid.
+void pool_allocator_debug_dump(int fd);
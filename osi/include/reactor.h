@@ -20,6 +20,7 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdlib.h>
 
 #include "osi/include/osi.h"
 
@@ -81,6 +82,17 @@ bool reactor_change_registration(reactor_object_t* object,
                                  void (*read_ready)(void* context),
                                  void (*write_ready)(void* context));
 
+// Lets the reactor call |read_ready| for |object| up to |max_batch| times per
+// wakeup. After each call |read_pending| is asked, with the registered context,
+// whether more input is available; if it is, |read_ready| is called again
+// without going back to epoll. |read_pending| is meant for sources that can
+// tell without a system call, e.g. from the length of a queue. A NULL
+// |read_pending| or a |max_batch| of 1 restores one call per wakeup, which is
+// the default. |object| may not be NULL.
+void reactor_set_read_batch(reactor_object_t* object,
+                            bool (*read_pending)(void* context),
+                            size_t max_batch);
+
 // Unregisters a previously registered file descriptor with its reactor. |obj|
 // may not be NULL. |obj| is invalid after calling this function so the caller
 // must drop all references to it.
@@ -44,6 +44,10 @@ bool semaphore_try_wait(semaphore_t* semaphore);
 // Increments the value of |semaphore|. |semaphore| may not be NULL.
 void semaphore_post(semaphore_t* semaphore);
 
+// Increments the value of |semaphore| by |count| at once, waking up to |count|
+// waiters. |semaphore| may not be NULL.
+void semaphore_post_count(semaphore_t* semaphore, unsigned int count);
+
 // Returns a file descriptor representing this semaphore. The caller may
 // only perform one operation on the file descriptor: select(2). If |select|
 // indicates the fd is readable, the caller may call |semaphore_wait|
@@ -0,0 +1,105 @@
+/******************************************************************************
+ *
+ *  Copyright 2020 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+// A single producer, single consumer byte ring in shared memory, used to pass
+// a stream between two processes without a syscall per transfer. The ring is
+// created by one side and its file descriptor handed to the other, usually
+// over a unix socket with SCM_RIGHTS; either side may be the writer.
+//
+// Transfers are lock-free: each side only advances its own position. A side
+// that has to wait sleeps on a futex in the shared mapping, and the peer only
+// makes the wake-up syscall when somebody is actually waiting. The mapping is
+// sealed against resizing, and the positions published by the peer are
+// checked on every access, so a misbehaving peer can't make the other side
+// read or write outside the ring.
+//
+// Each end must be used by a single thread at a time. |shm_ring_close| may be
+// called from any thread.
+
+struct shm_ring_t;
+typedef struct shm_ring_t shm_ring_t;
+
+// Creates a ring holding up to |capacity| bytes. The ring is backed by an
+// anonymous shared memory file whose descriptor is returned by
+// |shm_ring_get_fd|. Returns NULL on failure. The returned ring must be freed
+// with |shm_ring_free|. |capacity| must be greater than zero.
+shm_ring_t* shm_ring_new(size_t capacity);
+
+// Maps the ring created by a peer from its file descriptor |fd|. The
+// descriptor isn't kept and may be closed by the caller on return. Returns
+// NULL if |fd| doesn't hold a valid ring. The returned ring must be freed with
+// |shm_ring_free|.
+shm_ring_t* shm_ring_attach(int fd);
+
+// Unmaps the ring. The other side keeps its own mapping and should be told
+// with |shm_ring_close| first. This function accepts NULL as an argument, in
+// which case it behaves like a no-op.
+void shm_ring_free(shm_ring_t* ring);
+
+// Returns the file descriptor to pass to the peer for |shm_ring_attach|, or
+// INVALID_FD if |ring| was attached rather than created. The descriptor is
+// owned by the ring. |ring| may not be NULL.
+int shm_ring_get_fd(const shm_ring_t* ring);
+
+// Returns the number of bytes the ring can hold. |ring| may not be NULL.
+size_t shm_ring_capacity(const shm_ring_t* ring);
+
+// Returns the number of bytes written and not read yet. |ring| may not be
+// NULL.
+size_t shm_ring_bytes_available(const shm_ring_t* ring);
+
+// Copies |len| bytes from |buf| into the ring, waiting up to |timeout_ms| in
+// total for the reader to make room; a |timeout_ms| of zero doesn't wait.
+// Returns the number of bytes written, which is less than |len| on timeout.
+// Returns -1 if nothing was written because the ring was closed (errno is
+// EPIPE) or corrupted by the peer (errno is EPROTO). Neither |ring| nor |buf|
+// may be NULL.
+ssize_t shm_ring_write(shm_ring_t* ring, const void* buf, size_t len,
+                       int timeout_ms);
+
+// Copies up to |len| bytes from the ring into |buf|, waiting up to
+// |timeout_ms| in total for the writer to fill it; a |timeout_ms| of zero
+// doesn't wait. Returns the number of bytes read, which is less than |len| on
+// timeout. Data written before the ring was closed is still returned; -1 is
+// returned once the ring is closed and empty (errno is EPIPE), or if it was
+// corrupted by the peer (errno is EPROTO). Neither |ring| nor |buf| may be
+// NULL.
+ssize_t shm_ring_read(shm_ring_t* ring, void* buf, size_t len, int timeout_ms);
+
+// Drops all the bytes written and not read yet. Must only be called by the
+// reader. |ring| may not be NULL.
+void shm_ring_flush(shm_ring_t* ring);
+
+// Marks the ring closed for both sides and wakes up a waiting peer. Further
+// writes fail; reads return what is left in the ring, then fail. |ring| may
+// not be NULL.
+void shm_ring_close(shm_ring_t* ring);
+
+// Returns true if either side closed the ring. |ring| may not be NULL.
+bool shm_ring_is_closed(const shm_ring_t* ring);
+
+// Returns true once the peer mapped the ring with |shm_ring_attach|. Lets the
+// creator tell a peer that uses the ring from one that ignored the offer.
+// |ring| may not be NULL.
+bool shm_ring_is_attached(const shm_ring_t* ring);
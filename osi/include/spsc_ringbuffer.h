@@ -0,0 +1,89 @@
+/******************************************************************************
+ *
+ *  Copyright 2020 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// A single producer, single consumer byte ring for passing a stream between
+// two threads of the same process without a lock. Unlike |ringbuffer_t|, one
+// thread may insert while another one pops or deletes: each side only moves
+// its own position, and the positions live on separate cache lines. Only one
+// thread may produce, and only one may consume, at a time. To pass a stream
+// to another process, see |shm_ring_t|.
+//
+// Besides copying, each side can work in place in the ring: the producer
+// reserves writable space, fills it and commits it; the consumer peeks at the
+// readable data and commits what it used. Space and data are exposed as one
+// contiguous segment at a time, so a transfer that wraps around the end of
+// the ring takes two rounds.
+
+typedef struct spsc_ringbuffer_t spsc_ringbuffer_t;
+
+// Creates a ring holding up to |size| bytes. Returns NULL if |size| is zero
+// or too large. The returned ring must be freed with |spsc_ringbuffer_free|.
+spsc_ringbuffer_t* spsc_ringbuffer_init(size_t size);
+
+// Frees the ring. Neither side may use it any more. Safe to call with NULL.
+void spsc_ringbuffer_free(spsc_ringbuffer_t* rb);
+
+// Returns the number of bytes the producer can insert. The consumer may free
+// more space at any time. |rb| may not be NULL.
+size_t spsc_ringbuffer_available(const spsc_ringbuffer_t* rb);
+
+// Returns the number of bytes the consumer can pop. The producer may insert
+// more at any time. |rb| may not be NULL.
+size_t spsc_ringbuffer_size(const spsc_ringbuffer_t* rb);
+
+// Producer side. Copies up to |length| bytes from |p| into the ring. Returns
+// the number of bytes inserted, less than |length| if the ring is full.
+// Neither |rb| nor |p| may be NULL.
+size_t spsc_ringbuffer_insert(spsc_ringbuffer_t* rb, const uint8_t* p,
+                              size_t length);
+
+// Producer side. Sets |*p| to the start of the contiguous space that can be
+// written in place, and returns its length, zero if the ring is full. The
+// bytes are passed to the consumer by |spsc_ringbuffer_write_commit|.
+// Neither |rb| nor |p| may be NULL.
+size_t spsc_ringbuffer_write_reserve(spsc_ringbuffer_t* rb, uint8_t** p);
+
+// Producer side. Passes the first |length| bytes of the space returned by
+// |spsc_ringbuffer_write_reserve| to the consumer. |length| may not exceed
+// the length of that space. |rb| may not be NULL.
+void spsc_ringbuffer_write_commit(spsc_ringbuffer_t* rb, size_t length);
+
+// Consumer side. Copies up to |length| bytes from the ring into |p| and
+// removes them. Returns the number of bytes popped, less than |length| if
+// there is less data. Neither |rb| nor |p| may be NULL.
+size_t spsc_ringbuffer_pop(spsc_ringbuffer_t* rb, uint8_t* p, size_t length);
+
+// Consumer side. Removes up to |length| bytes from the ring. Returns the
+// number of bytes removed. |rb| may not be NULL.
+size_t spsc_ringbuffer_delete(spsc_ringbuffer_t* rb, size_t length);
+
+// Consumer side. Sets |*p| to the start of the contiguous data that can be
+// read in place, and returns its length, zero if the ring is empty. The data
+// stays in the ring until |spsc_ringbuffer_read_commit|. Neither |rb| nor |p|
+// may be NULL.
+size_t spsc_ringbuffer_read_peek(spsc_ringbuffer_t* rb, const uint8_t** p);
+
+// Consumer side. Removes the first |length| bytes of the data returned by
+// |spsc_ringbuffer_read_peek|, giving their space back to the producer.
+// |length| may not exceed the length of that data. |rb| may not be NULL.
+void spsc_ringbuffer_read_commit(spsc_ringbuffer_t* rb, size_t length);
@@ -55,6 +55,14 @@ void thread_join(thread_t* thread);
 // Return true on success, otherwise false.
 bool thread_post(thread_t* thread, thread_fn func, void* context);
 
+// Call |func| on |thread| once with each of the |count| elements of |contexts|,
+// in order. The calls are queued together, so that |thread| is woken up once
+// for the batch rather than once per call. This function blocks while the
+// work queue of |thread| is full. Neither |thread| nor |func| may be NULL.
+// Return true on success, otherwise false.
+bool thread_post_batch(thread_t* thread, thread_fn func, void* const* contexts,
+                       size_t count);
+
 // Requests |thread| to stop. Only |thread_free| and |thread_name| may be called
 // after calling |thread_stop|. This function is guaranteed to not block.
 // |thread| may not be NULL.
@@ -0,0 +1,103 @@
+/******************************************************************************
+ *
+ *  Copyright 2020 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+// A hierarchical timer wheel with millisecond resolution. Adding and removing
+// an entry takes constant time; entries are moved to finer levels as their
+// deadline approaches and expire in batches. The wheel does not keep time on
+// its own: callers pass the current time to |timer_wheel_expire|.
+//
+// The wheel is not thread-safe; callers provide their own locking.
+
+struct timer_wheel_t;
+typedef struct timer_wheel_t timer_wheel_t;
+
+// An entry is embedded in the object it schedules, so the wheel never
+// allocates. It must be zero-initialized before first use and must not be
+// freed or moved while it is pending. The fields are private to the wheel.
+typedef struct timer_wheel_entry_t {
+  struct timer_wheel_entry_t* next;
+  struct timer_wheel_entry_t* prev;
+  void* data;
+  uint64_t deadline_ms;
+  uint64_t sequence;
+  uint8_t level;
+  uint8_t slot;
+  bool pending;
+} timer_wheel_entry_t;
+
+// Callback prototype used for |timer_wheel_expire| and |timer_wheel_foreach|.
+// |data| is the value passed to |timer_wheel_add| for the entry, |context| is
+// a user defined value. The return value is only used by
+// |timer_wheel_foreach|: true to continue iterating, false to stop.
+typedef bool (*timer_wheel_cb)(void* data, void* context);
+
+// Returns a new, empty timer wheel. The returned wheel must be freed with
+// |timer_wheel_free|.
+timer_wheel_t* timer_wheel_new(void);
+
+// Frees the wheel. Pending entries are dropped without being expired. This
+// function accepts NULL as an argument, in which case it behaves like a no-op.
+void timer_wheel_free(timer_wheel_t* wheel);
+
+// Returns the number of pending entries in |wheel|. |wheel| may not be NULL.
+size_t timer_wheel_length(const timer_wheel_t* wheel);
+
+// Returns true if |wheel| has no pending entries. |wheel| may not be NULL.
+bool timer_wheel_is_empty(const timer_wheel_t* wheel);
+
+// Schedules |entry| to expire at |deadline_ms|, carrying |data|. If |entry|
+// is already pending it is rescheduled. A deadline in the past expires on the
+// next call to |timer_wheel_expire|. Entries with the same deadline expire in
+// the order they were added. Neither |wheel| nor |entry| may be NULL.
+void timer_wheel_add(timer_wheel_t* wheel, timer_wheel_entry_t* entry,
+                     uint64_t deadline_ms, void* data);
+
+// Removes |entry| from |wheel|. Does nothing if |entry| is not pending.
+// Neither |wheel| nor |entry| may be NULL.
+void timer_wheel_remove(timer_wheel_t* wheel, timer_wheel_entry_t* entry);
+
+// Returns true if |entry| is scheduled on a wheel. |entry| may not be NULL.
+bool timer_wheel_entry_is_pending(const timer_wheel_entry_t* entry);
+
+// Stores the earliest deadline of all pending entries in |deadline_ms| and
+// returns true, or returns false if |wheel| is empty. The deadline may be in
+// the past. Neither |wheel| nor |deadline_ms| may be NULL.
+bool timer_wheel_next_deadline(const timer_wheel_t* wheel,
+                               uint64_t* deadline_ms);
+
+// Removes every entry whose deadline is at or before |now_ms| and calls
+// |callback| for each of them, ordered by deadline. Each entry is removed just
+// before its callback runs, so |callback| may add or remove entries, including
+// the expired one; removing an entry that is due but not yet reported skips
+// its callback. Entries added from |callback| expire on a later call, even if
+// already due. |now_ms| must not go backwards between calls. Returns the
+// number of expired entries. Neither |wheel| nor |callback| may be NULL.
+size_t timer_wheel_expire(timer_wheel_t* wheel, uint64_t now_ms,
+                          timer_wheel_cb callback, void* context);
+
+// Iterates over all pending entries, in no particular order, until
+// |callback| returns false. The wheel must not be modified from |callback|.
+// Neither |wheel| nor |callback| may be NULL.
+void timer_wheel_foreach(const timer_wheel_t* wheel, timer_wheel_cb callback,
+                         void* context);
@@ -20,6 +20,18 @@
 
 #include <hardware/bluetooth.h>
 #include <stdbool.h>
+#include <stdint.h>
+
+// The subsystems holding the Bluetooth wakelock. Each one has its own
+// reference count, so that one can't release the holds of another, and its
+// own statistics.
+typedef enum {
+  WAKELOCK_REASON_OTHER,
+  WAKELOCK_REASON_ALARM,
+  WAKELOCK_REASON_A2DP_SOURCE,
+  WAKELOCK_REASON_HEARING_AID,
+  WAKELOCK_REASON_MAX,
+} wakelock_reason_t;
 
 // Set the Bluetooth OS callouts to |callouts|.
 // This function should be called when native kernel wakelocks are not used
@@ -37,6 +49,23 @@ bool wakelock_acquire(void);
 // Return true on success, otherwise false.
 bool wakelock_release(void);
 
+// Acquire the Bluetooth wakelock for |reason|. The holds nest: the wakelock is
+// held until each of them is released.
+// The function is thread safe.
+// Return true on success, otherwise false.
+bool wakelock_acquire_for(wakelock_reason_t reason);
+
+// Release a hold of |reason| on the Bluetooth wakelock. A release without a
+// matching acquire is only counted.
+// The function is thread safe.
+// Return true on success, otherwise false.
+bool wakelock_release_for(wakelock_reason_t reason);
+
+// Keep the wakelock for |holdoff_ms| after its last hold is released, so that
+// a burst of short holds only acquires and releases it once. 0, the default,
+// releases the wakelock right away.
+void wakelock_set_release_holdoff_ms(uint64_t holdoff_ms);
+
 // Cleanup the wakelock internal state.
 // This function should be called by the OSI module cleanup during
 // graceful shutdown.
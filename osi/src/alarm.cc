@@ -40,11 +40,11 @@
 
 #include "osi/include/allocator.h"
 #include "osi/include/fixed_queue.h"
-#include "osi/include/list.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
 #include "osi/include/semaphore.h"
 #include "osi/include/thread.h"
+#include "osi/include/timer_wheel.h"
 #include "osi/include/wakelock.h"
 #include "stack/include/btu.h"
 
@@ -69,6 +69,7 @@ typedef struct {
   size_t canceled_count;
   size_t rescheduled_count;
   size_t total_updates;
+  size_t batched_count;  // Expired in its slack, before its own wakeup
   uint64_t last_update_ms;
   stat_t overdue_scheduling;
   stat_t premature_scheduling;
@@ -97,11 +98,14 @@ struct alarm_t {
   uint64_t deadline_ms;
   uint64_t prev_deadline_ms;  // Previous deadline - used for accounting of
                               // periodic timers
+  uint64_t slack_ms;  // How late past |deadline_ms| the alarm may expire
   bool is_periodic;
   fixed_queue_t* queue;  // The processing queue to add this alarm to
   alarm_callback_t callback;
   void* data;
   alarm_stats_t stats;
+  timer_wheel_entry_t wheel_entry;   // Position on |alarms| while pending
+  timer_wheel_entry_t wakeup_entry;  // Position on |wakeups| while pending
 
   bool for_msg_loop;  // True, if the alarm should be processed on message loop
   CancelableClosureInStruct closure;  // posted to message loop for processing
@@ -116,12 +120,22 @@ static const clockid_t CLOCK_ID = CLOCK_BOOTTIME;
 
 // This mutex ensures that the |alarm_set|, |alarm_cancel|, and alarm callback
 // functions execute serially and not concurrently. As a result, this mutex
-// also protects the |alarms| list.
+// also protects the |alarms| wheel.
 static std::mutex alarms_mutex;
-static list_t* alarms;
+static timer_wheel_t* alarms;
+// The pending alarms by the time they must have expired: their deadline plus
+// their slack. The timers are armed for the earliest one, and each time they
+// fire every alarm past its deadline expires, so that alarms with slack
+// expire in batches with the others.
+static timer_wheel_t* wakeups;
 static timer_t timer;
 static timer_t wakeup_timer;
 static bool timer_set;
+// Deadline the posix timers are armed for. It may belong to an alarm that has
+// been canceled or rescheduled since; |callback_dispatch| re-arms the timers
+// when they fire with nothing due.
+static bool root_alarm_armed;
+static uint64_t root_alarm_deadline_ms;
 
 // All alarm callbacks are dispatched from |dispatcher_thread|
 static thread_t* dispatcher_thread;
@@ -136,8 +150,9 @@ static alarm_t* alarm_new_internal(const char* name, bool is_periodic);
 static bool lazy_initialize(void);
 static uint64_t now_ms(void);
 static void alarm_set_internal(alarm_t* alarm, uint64_t period_ms,
-                               alarm_callback_t cb, void* data,
-                               fixed_queue_t* queue, bool for_msg_loop);
+                               uint64_t slack_ms, alarm_callback_t cb,
+                               void* data, fixed_queue_t* queue,
+                               bool for_msg_loop);
 static void alarm_cancel_internal(alarm_t* alarm);
 static void remove_pending_alarm(alarm_t* alarm);
 static void schedule_next_instance(alarm_t* alarm);
@@ -145,9 +160,10 @@ static void reschedule_root_alarm(void);
 static void alarm_queue_ready(fixed_queue_t* queue, void* context);
 static void timer_callback(void* data);
 static void callback_dispatch(void* context);
+static bool dispatch_expired_alarm(void* data, void* context);
 static bool timer_create_internal(const clockid_t clock_id, timer_t* timer);
 static void update_scheduling_stats(alarm_stats_t* stats, uint64_t now_ms,
-                                    uint64_t deadline_ms);
+                                    uint64_t deadline_ms, uint64_t slack_ms);
 // Registers |queue| for processing alarm callbacks on |thread|.
 // |queue| may not be NULL. |thread| may not be NULL.
 static void alarm_register_processing_queue(fixed_queue_t* queue,
@@ -212,19 +228,32 @@ uint64_t alarm_get_remaining_ms(const alarm_t* alarm) {
 
 void alarm_set(alarm_t* alarm, uint64_t interval_ms, alarm_callback_t cb,
                void* data) {
-  alarm_set_internal(alarm, interval_ms, cb, data, default_callback_queue,
+  alarm_set_internal(alarm, interval_ms, 0, cb, data, default_callback_queue,
                      false);
 }
 
 void alarm_set_on_mloop(alarm_t* alarm, uint64_t interval_ms,
                         alarm_callback_t cb, void* data) {
-  alarm_set_internal(alarm, interval_ms, cb, data, NULL, true);
+  alarm_set_internal(alarm, interval_ms, 0, cb, data, NULL, true);
+}
+
+void alarm_set_with_slack(alarm_t* alarm, uint64_t interval_ms,
+                          uint64_t slack_ms, alarm_callback_t cb, void* data) {
+  alarm_set_internal(alarm, interval_ms, slack_ms, cb, data,
+                     default_callback_queue, false);
+}
+
+void alarm_set_on_mloop_with_slack(alarm_t* alarm, uint64_t interval_ms,
+                                   uint64_t slack_ms, alarm_callback_t cb,
+                                   void* data) {
+  alarm_set_internal(alarm, interval_ms, slack_ms, cb, data, NULL, true);
 }
 
 // Runs in exclusion with alarm_cancel and timer_callback.
 static void alarm_set_internal(alarm_t* alarm, uint64_t period_ms,
-                               alarm_callback_t cb, void* data,
-                               fixed_queue_t* queue, bool for_msg_loop) {
+                               uint64_t slack_ms, alarm_callback_t cb,
+                               void* data, fixed_queue_t* queue,
+                               bool for_msg_loop) {
   CHECK(alarms != NULL);
   CHECK(alarm != NULL);
   CHECK(cb != NULL);
@@ -233,6 +262,7 @@ static void alarm_set_internal(alarm_t* alarm, uint64_t period_ms,
 
   alarm->creation_time_ms = now_ms();
   alarm->period_ms = period_ms;
+  alarm->slack_ms = slack_ms;
   alarm->queue = queue;
   alarm->callback = cb;
   alarm->data = data;
@@ -260,19 +290,20 @@ void alarm_cancel(alarm_t* alarm) {
 // Internal implementation of canceling an alarm.
 // The caller must hold the |alarms_mutex|
 static void alarm_cancel_internal(alarm_t* alarm) {
-  bool needs_reschedule =
-      (!list_is_empty(alarms) && list_front(alarms) == alarm);
-
   remove_pending_alarm(alarm);
 
   alarm->deadline_ms = 0;
   alarm->prev_deadline_ms = 0;
+  alarm->slack_ms = 0;
   alarm->callback = NULL;
   alarm->data = NULL;
   alarm->stats.canceled_count++;
   alarm->queue = NULL;
 
-  if (needs_reschedule) reschedule_root_alarm();
+  // If other alarms are pending the timers stay armed; firing early for a
+  // canceled alarm is cheaper than re-arming them on every cancel.
+  if (root_alarm_armed && timer_wheel_is_empty(alarms))
+    reschedule_root_alarm();
 }
 
 bool alarm_is_scheduled(const alarm_t* alarm) {
@@ -301,8 +332,11 @@ void alarm_cleanup(void) {
   semaphore_free(alarm_expired);
   alarm_expired = NULL;
 
-  list_free(alarms);
+  timer_wheel_free(wakeups);
+  wakeups = NULL;
+  timer_wheel_free(alarms);
   alarms = NULL;
+  root_alarm_armed = false;
 }
 
 static bool lazy_initialize(void) {
@@ -315,9 +349,10 @@ static bool lazy_initialize(void) {
 
   std::lock_guard<std::mutex> lock(alarms_mutex);
 
-  alarms = list_new(NULL);
-  if (!alarms) {
-    LOG_ERROR(LOG_TAG, "%s unable to allocate alarm list.", __func__);
+  alarms = timer_wheel_new();
+  wakeups = timer_wheel_new();
+  if (!alarms || !wakeups) {
+    LOG_ERROR(LOG_TAG, "%s unable to allocate alarm wheel.", __func__);
     goto error;
   }
 
@@ -382,7 +417,9 @@ error:
 
   if (timer_initialized) timer_delete(timer);
 
-  list_free(alarms);
+  timer_wheel_free(wakeups);
+  wakeups = NULL;
+  timer_wheel_free(alarms);
   alarms = NULL;
 
   return false;
@@ -401,10 +438,11 @@ static uint64_t now_ms(void) {
   return (ts.tv_sec * 1000LL) + (ts.tv_nsec / 1000000LL);
 }
 
-// Remove alarm from internal alarm list and the processing queue
+// Remove alarm from internal alarm wheel and the processing queue
 // The caller must hold the |alarms_mutex|
 static void remove_pending_alarm(alarm_t* alarm) {
-  list_remove(alarms, alarm);
+  timer_wheel_remove(alarms, &alarm->wheel_entry);
+  timer_wheel_remove(wakeups, &alarm->wakeup_entry);
 
   if (alarm->for_msg_loop) {
     alarm->closure.i.Cancel();
@@ -419,10 +457,6 @@ static void remove_pending_alarm(alarm_t* alarm) {
 
 // Must be called with |alarms_mutex| held
 static void schedule_next_instance(alarm_t* alarm) {
-  // If the alarm is currently set and it's at the start of the list,
-  // we'll need to re-schedule since we've adjusted the earliest deadline.
-  bool needs_reschedule =
-      (!list_is_empty(alarms) && list_front(alarms) == alarm);
   if (alarm->callback) remove_pending_alarm(alarm);
 
   // Calculate the next deadline for this alarm
@@ -433,26 +467,12 @@ static void schedule_next_instance(alarm_t* alarm) {
         ((just_now_ms - alarm->creation_time_ms) % alarm->period_ms);
   alarm->deadline_ms = just_now_ms + (alarm->period_ms - ms_into_period);
 
-  // Add it into the timer list sorted by deadline (earliest deadline first).
-  if (list_is_empty(alarms) ||
-      ((alarm_t*)list_front(alarms))->deadline_ms > alarm->deadline_ms) {
-    list_prepend(alarms, alarm);
-  } else {
-    for (list_node_t* node = list_begin(alarms); node != list_end(alarms);
-         node = list_next(node)) {
-      list_node_t* next = list_next(node);
-      if (next == list_end(alarms) ||
-          ((alarm_t*)list_node(next))->deadline_ms > alarm->deadline_ms) {
-        list_insert_after(alarms, node, alarm);
-        break;
-      }
-    }
-  }
+  timer_wheel_add(alarms, &alarm->wheel_entry, alarm->deadline_ms, alarm);
+  uint64_t wakeup_ms = alarm->deadline_ms + alarm->slack_ms;
+  timer_wheel_add(wakeups, &alarm->wakeup_entry, wakeup_ms, alarm);
 
-  // If the new alarm has the earliest deadline, we need to re-evaluate our
-  // schedule.
-  if (needs_reschedule ||
-      (!list_is_empty(alarms) && list_front(alarms) == alarm)) {
+  // The timers only need to be re-armed if the new wakeup is the earliest.
+  if (!root_alarm_armed || wakeup_ms < root_alarm_deadline_ms) {
     reschedule_root_alarm();
   }
 }
@@ -462,27 +482,27 @@ static void reschedule_root_alarm(void) {
   CHECK(alarms != NULL);
 
   const bool timer_was_set = timer_set;
-  alarm_t* next;
+  uint64_t next_deadline_ms = 0;
   int64_t next_expiration;
 
   // If used in a zeroed state, disarms the timer.
   struct itimerspec timer_time;
   memset(&timer_time, 0, sizeof(timer_time));
 
-  if (list_is_empty(alarms)) goto done;
+  root_alarm_armed = false;
+  if (!timer_wheel_next_deadline(wakeups, &next_deadline_ms)) goto done;
 
-  next = static_cast<alarm_t*>(list_front(alarms));
-  next_expiration = next->deadline_ms - now_ms();
+  next_expiration = next_deadline_ms - now_ms();
   if (next_expiration < TIMER_INTERVAL_FOR_WAKELOCK_IN_MS) {
     if (!timer_set) {
-      if (!wakelock_acquire()) {
+      if (!wakelock_acquire_for(WAKELOCK_REASON_ALARM)) {
         LOG_ERROR(LOG_TAG, "%s unable to acquire wake lock", __func__);
         goto done;
       }
     }
 
-    timer_time.it_value.tv_sec = (next->deadline_ms / 1000);
-    timer_time.it_value.tv_nsec = (next->deadline_ms % 1000) * 1000000LL;
+    timer_time.it_value.tv_sec = (next_deadline_ms / 1000);
+    timer_time.it_value.tv_nsec = (next_deadline_ms % 1000) * 1000000LL;
 
     // It is entirely unsafe to call timer_settime(2) with a zeroed timerspec
     // for timers with *_ALARM clock IDs. Although the man page states that the
@@ -507,18 +527,20 @@ static void reschedule_root_alarm(void) {
     struct itimerspec wakeup_time;
     memset(&wakeup_time, 0, sizeof(wakeup_time));
 
-    wakeup_time.it_value.tv_sec = (next->deadline_ms / 1000);
-    wakeup_time.it_value.tv_nsec = (next->deadline_ms % 1000) * 1000000LL;
+    wakeup_time.it_value.tv_sec = (next_deadline_ms / 1000);
+    wakeup_time.it_value.tv_nsec = (next_deadline_ms % 1000) * 1000000LL;
     if (timer_settime(wakeup_timer, TIMER_ABSTIME, &wakeup_time, NULL) == -1)
       LOG_ERROR(LOG_TAG, "%s unable to set wakeup timer: %s", __func__,
                 strerror(errno));
   }
+  root_alarm_armed = true;
+  root_alarm_deadline_ms = next_deadline_ms;
 
 done:
   timer_set =
       timer_time.it_value.tv_sec != 0 || timer_time.it_value.tv_nsec != 0;
   if (timer_was_set && !timer_set) {
-    wakelock_release();
+    wakelock_release_for(WAKELOCK_REASON_ALARM);
   }
 
   if (timer_settime(timer, TIMER_ABSTIME, &timer_time, NULL) == -1)
@@ -532,8 +554,7 @@ done:
   // milliseconds) and the timer expired normally before we called
   // |timer_gettime|. Worst case, |alarm_expired| is signaled twice for that
   // alarm. Nothing bad should happen in that case though since the callback
-  // dispatch function checks to make sure the timer at the head of the list
-  // actually expired.
+  // dispatch function only handles alarms that actually expired.
   if (timer_set) {
     struct itimerspec time_to_expire;
     timer_gettime(timer, &time_to_expire);
@@ -575,6 +596,7 @@ static void alarm_ready_generic(alarm_t* alarm,
   alarm_callback_t callback = alarm->callback;
   void* data = alarm->data;
   uint64_t deadline_ms = alarm->deadline_ms;
+  uint64_t slack_ms = alarm->slack_ms;
   if (alarm->is_periodic) {
     // The periodic alarm has been rescheduled and alarm->deadline has been
     // updated, hence we need to use the previous deadline.
@@ -593,7 +615,7 @@ static void alarm_ready_generic(alarm_t* alarm,
   lock.unlock();
 
   // Update the statistics
-  update_scheduling_stats(&alarm->stats, now_ms(), deadline_ms);
+  update_scheduling_stats(&alarm->stats, now_ms(), deadline_ms, slack_ms);
 
   // NOTE: Do NOT access "alarm" after the callback, as a safety precaution
   // in case the callback itself deleted the alarm.
@@ -620,52 +642,50 @@ static void timer_callback(UNUSED_ATTR void* ptr) {
 
 // Function running on |dispatcher_thread| that performs the following:
 //   (1) Receives a signal using |alarm_exired| that the alarm has expired
-//   (2) Dispatches the alarm callback for processing by the corresponding
-// thread for that alarm.
+//   (2) Dispatches the callbacks of all expired alarms for processing by the
+// corresponding thread for each alarm.
 static void callback_dispatch(UNUSED_ATTR void* context) {
   while (true) {
     semaphore_wait(alarm_expired);
     if (!dispatcher_thread_active) break;
 
     std::lock_guard<std::mutex> lock(alarms_mutex);
-    alarm_t* alarm;
-
-    // Take into account that the alarm may get cancelled before we get to it.
-    // We're done here if there are no alarms or the alarm at the front is in
-    // the future. Exit right away since there's nothing left to do.
-    if (list_is_empty(alarms) ||
-        (alarm = static_cast<alarm_t*>(list_front(alarms)))->deadline_ms >
-            now_ms()) {
-      reschedule_root_alarm();
-      continue;
-    }
-
-    list_remove(alarms, alarm);
 
-    if (alarm->is_periodic) {
-      alarm->prev_deadline_ms = alarm->deadline_ms;
-      schedule_next_instance(alarm);
-      alarm->stats.rescheduled_count++;
-    }
+    // Take into account that alarms may get cancelled or rescheduled before we
+    // get to them, in which case nothing expires and the timers are re-armed.
+    timer_wheel_expire(alarms, now_ms(), dispatch_expired_alarm, NULL);
     reschedule_root_alarm();
+  }
 
-    // Enqueue the alarm for processing
-    if (alarm->for_msg_loop) {
-      if (!get_main_message_loop()) {
-        LOG_ERROR(LOG_TAG, "%s: message loop already NULL. Alarm: %s", __func__,
-                  alarm->stats.name);
-        continue;
-      }
+  LOG_DEBUG(LOG_TAG, "%s Callback thread exited", __func__);
+}
 
-      alarm->closure.i.Reset(Bind(alarm_ready_mloop, alarm));
-      get_main_message_loop()->task_runner()->PostTask(
-          FROM_HERE, alarm->closure.i.callback());
-    } else {
-      fixed_queue_enqueue(alarm->queue, alarm);
-    }
+// Enqueues an expired alarm for processing.
+// NOTE: must be called with |alarms_mutex| held
+static bool dispatch_expired_alarm(void* data, UNUSED_ATTR void* context) {
+  alarm_t* alarm = static_cast<alarm_t*>(data);
+  timer_wheel_remove(wakeups, &alarm->wakeup_entry);
+
+  if (alarm->is_periodic) {
+    alarm->prev_deadline_ms = alarm->deadline_ms;
+    schedule_next_instance(alarm);
+    alarm->stats.rescheduled_count++;
   }
 
-  LOG_DEBUG(LOG_TAG, "%s Callback thread exited", __func__);
+  if (alarm->for_msg_loop) {
+    if (!get_main_message_loop()) {
+      LOG_ERROR(LOG_TAG, "%s: message loop already NULL. Alarm: %s", __func__,
+                alarm->stats.name);
+      return true;
+    }
+
+    alarm->closure.i.Reset(Bind(alarm_ready_mloop, alarm));
+    get_main_message_loop()->task_runner()->PostTask(
+        FROM_HERE, alarm->closure.i.callback());
+  } else {
+    fixed_queue_enqueue(alarm->queue, alarm);
+  }
+  return true;
 }
 
 static bool timer_create_internal(const clockid_t clock_id, timer_t* timer) {
@@ -704,14 +724,17 @@ static bool timer_create_internal(const clockid_t clock_id, timer_t* timer) {
 }
 
 static void update_scheduling_stats(alarm_stats_t* stats, uint64_t now_ms,
-                                    uint64_t deadline_ms) {
+                                    uint64_t deadline_ms, uint64_t slack_ms) {
   stats->total_updates++;
   stats->last_update_ms = now_ms;
 
-  if (deadline_ms < now_ms) {
+  if (deadline_ms + slack_ms < now_ms) {
     // Overdue scheduling
-    uint64_t delta_ms = now_ms - deadline_ms;
+    uint64_t delta_ms = now_ms - (deadline_ms + slack_ms);
     update_stat(&stats->overdue_scheduling, delta_ms);
+  } else if (deadline_ms < now_ms) {
+    // Within the slack: the alarm expired along with an earlier wakeup
+    if (now_ms < deadline_ms + slack_ms) stats->batched_count++;
   } else if (deadline_ms > now_ms) {
     // Premature scheduling
     uint64_t delta_ms = deadline_ms - now_ms;
@@ -728,6 +751,50 @@ static void dump_stat(int fd, stat_t* stat, const char* description) {
           (unsigned long long)average_time_ms);
 }
 
+typedef struct {
+  int fd;
+  uint64_t just_now_ms;
+} dump_context_t;
+
+static bool dump_alarm(void* data, void* context) {
+  alarm_t* alarm = static_cast<alarm_t*>(data);
+  const dump_context_t* dump_context = static_cast<dump_context_t*>(context);
+  int fd = dump_context->fd;
+  uint64_t just_now_ms = dump_context->just_now_ms;
+  alarm_stats_t* stats = &alarm->stats;
+
+  dprintf(fd, "  Alarm : %s (%s)\n", stats->name,
+          (alarm->is_periodic) ? "PERIODIC" : "SINGLE");
+
+  dprintf(fd, "%-51s: %zu / %zu / %zu / %zu\n",
+          "    Action counts (sched/resched/exec/cancel)",
+          stats->scheduled_count, stats->rescheduled_count,
+          stats->total_updates, stats->canceled_count);
+
+  dprintf(fd, "%-51s: %zu / %zu\n", "    Deviation counts (overdue/premature)",
+          stats->overdue_scheduling.count, stats->premature_scheduling.count);
+
+  if (alarm->slack_ms != 0) {
+    dprintf(fd, "%-51s: %llu / %zu\n", "    Slack in ms / batched expirations",
+            (unsigned long long)alarm->slack_ms, stats->batched_count);
+  }
+
+  dprintf(fd, "%-51s: %llu / %llu / %lld\n",
+          "    Time in ms (since creation/interval/remaining)",
+          (unsigned long long)(just_now_ms - alarm->creation_time_ms),
+          (unsigned long long)alarm->period_ms,
+          (long long)(alarm->deadline_ms - just_now_ms));
+
+  dump_stat(fd, &stats->overdue_scheduling,
+            "    Overdue scheduling time in ms (total/max/avg)");
+
+  dump_stat(fd, &stats->premature_scheduling,
+            "    Premature scheduling time in ms (total/max/avg)");
+
+  dprintf(fd, "\n");
+  return true;
+}
+
 void alarm_debug_dump(int fd) {
   dprintf(fd, "\nBluetooth Alarms Statistics:\n");
 
@@ -738,40 +805,10 @@ void alarm_debug_dump(int fd) {
     return;
   }
 
-  uint64_t just_now_ms = now_ms();
+  dump_context_t dump_context = {fd, now_ms()};
 
-  dprintf(fd, "  Total Alarms: %zu\n\n", list_length(alarms));
+  dprintf(fd, "  Total Alarms: %zu\n\n", timer_wheel_length(alarms));
 
   // Dump info for each alarm
-  for (list_node_t* node = list_begin(alarms); node != list_end(alarms);
-       node = list_next(node)) {
-    alarm_t* alarm = (alarm_t*)list_node(node);
-    alarm_stats_t* stats = &alarm->stats;
-
-    dprintf(fd, "  Alarm : %s (%s)\n", stats->name,
-            (alarm->is_periodic) ? "PERIODIC" : "SINGLE");
-
-    dprintf(fd, "%-51s: %zu / %zu / %zu / %zu\n",
-            "    Action counts (sched/resched/exec/cancel)",
-            stats->scheduled_count, stats->rescheduled_count,
-            stats->total_updates, stats->canceled_count);
-
-    dprintf(fd, "%-51s: %zu / %zu\n",
-            "    Deviation counts (overdue/premature)",
-            stats->overdue_scheduling.count, stats->premature_scheduling.count);
-
-    dprintf(fd, "%-51s: %llu / %llu / %lld\n",
-            "    Time in ms (since creation/interval/remaining)",
-            (unsigned long long)(just_now_ms - alarm->creation_time_ms),
-            (unsigned long long)alarm->period_ms,
-            (long long)(alarm->deadline_ms - just_now_ms));
-
-    dump_stat(fd, &stats->overdue_scheduling,
-              "    Overdue scheduling time in ms (total/max/avg)");
-
-    dump_stat(fd, &stats->premature_scheduling,
-              "    Premature scheduling time in ms (total/max/avg)");
-
-    dprintf(fd, "\n");
-  }
+  timer_wheel_foreach(alarms, dump_alarm, &dump_context);
 }
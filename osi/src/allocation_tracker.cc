@@ -21,14 +21,21 @@
 #include "osi/include/allocation_tracker.h"
 
 #include <base/logging.h>
+#include <dlfcn.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/prctl.h>
+#include <algorithm>
+#include <atomic>
 #include <mutex>
+#include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "osi/include/allocator.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
+#include "osi/include/pool_allocator.h"
 
 typedef struct {
   uint8_t allocator_id;
@@ -97,6 +104,11 @@ size_t allocation_tracker_expect_no_allocations(void) {
   return unfreed_memory_size;
 }
 
+size_t allocation_tracker_alloc_count(void) {
+  std::unique_lock<std::mutex> lock(tracker_lock);
+  return alloc_counter;
+}
+
 void* allocation_tracker_notify_alloc(uint8_t allocator_id, void* ptr,
                                       size_t requested_size) {
   char* return_ptr;
@@ -174,6 +186,248 @@ size_t allocation_tracker_resize_for_canary(size_t size) {
   return (!enabled) ? size : size + (2 * canary_size);
 }
 
+// Heap sampling. The fast path of an allocation is a thread local countdown of
+// the bytes left until the next sample, and the one of a free is a lock free
+// lookup in the open addressed table of the live sampled allocations.
+namespace {
+
+constexpr size_t kSampleSlots = 4096;  // A power of two
+constexpr size_t kMaxSampleProbes = 16;
+// Marks a slot whose allocation was freed while others were probed past it
+constexpr uintptr_t kFreedSlot = 1;
+// Allocations of up to 16 octets, up to 32 octets, ..., over 64 KiB
+constexpr size_t kSizeBuckets = 14;
+constexpr size_t kMaxDumpedSites = 20;
+
+struct sample_stats_t {
+  size_t samples;
+  size_t allocated_octets;  // Estimated from the samples
+  size_t live_samples;
+  size_t live_octets;  // Estimated from the samples
+};
+
+struct subsystem_stats_t {
+  sample_stats_t stats;
+  size_t size_buckets[kSizeBuckets];
+};
+
+struct sample_slot_t {
+  std::atomic<uintptr_t> ptr;
+  // Set before |ptr| is published, and only used under |sampler_lock|
+  size_t weight;
+  sample_stats_t* site;
+  subsystem_stats_t* subsystem;
+};
+
+std::atomic<size_t> sampling_interval(0);
+std::atomic<size_t> live_samples(0);
+std::mutex sampler_lock;
+sample_slot_t sample_slots[kSampleSlots];
+std::unordered_map<const void*, sample_stats_t> sampled_sites;
+std::unordered_map<std::string, subsystem_stats_t> sampled_subsystems;
+size_t dropped_samples = 0;
+
+thread_local size_t countdown_interval = 0;
+thread_local int64_t bytes_until_sample = 0;
+thread_local uint32_t sample_rand_state = 0;
+
+// Returns a distance in [interval / 2, 3 * interval / 2), so that periodic
+// allocation patterns don't alias with the sampling.
+int64_t next_sample_distance(size_t interval) {
+  if (sample_rand_state == 0) {
+    sample_rand_state =
+        static_cast<uint32_t>(reinterpret_cast<uintptr_t>(&sample_rand_state));
+    sample_rand_state |= 1;
+  }
+  // xorshift32
+  sample_rand_state ^= sample_rand_state << 13;
+  sample_rand_state ^= sample_rand_state >> 17;
+  sample_rand_state ^= sample_rand_state << 5;
+  return interval / 2 + sample_rand_state % interval;
+}
+
+size_t sample_slot_index(uintptr_t ptr) {
+  return ((ptr >> 4) * 2654435761u) & (kSampleSlots - 1);
+}
+
+size_t size_bucket(size_t size) {
+  size_t bucket = 0;
+  for (size_t limit = 16; size > limit && bucket < kSizeBuckets - 1;
+       limit <<= 1)
+    bucket++;
+  return bucket;
+}
+
+void record_sample(void* ptr, size_t size, const void* caller,
+                   size_t interval) {
+  char name[17] = {};
+  if (prctl(PR_GET_NAME, (unsigned long)name) == -1) strcpy(name, "unknown");
+  // A sample stands for the |interval| octets allocated since the last one,
+  // except for the allocations that are always sampled
+  size_t weight = std::max(size, interval);
+
+  std::lock_guard<std::mutex> lock(sampler_lock);
+  if (sampling_interval.load(std::memory_order_relaxed) != interval) return;
+
+  sample_stats_t* site = &sampled_sites[caller];
+  subsystem_stats_t* subsystem = &sampled_subsystems[name];
+  site->samples++;
+  site->allocated_octets += weight;
+  subsystem->stats.samples++;
+  subsystem->stats.allocated_octets += weight;
+  subsystem->size_buckets[size_bucket(size)]++;
+
+  uintptr_t key = reinterpret_cast<uintptr_t>(ptr);
+  size_t index = sample_slot_index(key);
+  for (size_t i = 0; i < kMaxSampleProbes; i++) {
+    sample_slot_t& slot = sample_slots[(index + i) & (kSampleSlots - 1)];
+    uintptr_t value = slot.ptr.load(std::memory_order_relaxed);
+    if (value != 0 && value != kFreedSlot) continue;
+
+    slot.weight = weight;
+    slot.site = site;
+    slot.subsystem = subsystem;
+    site->live_samples++;
+    site->live_octets += weight;
+    subsystem->stats.live_samples++;
+    subsystem->stats.live_octets += weight;
+    slot.ptr.store(key, std::memory_order_release);
+    live_samples.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  // Only the allocation is accounted for, not its lifetime
+  dropped_samples++;
+}
+
+bool has_more_octets(const sample_stats_t& a, const sample_stats_t& b) {
+  if (a.live_octets != b.live_octets) return a.live_octets > b.live_octets;
+  return a.allocated_octets > b.allocated_octets;
+}
+
+void sampling_debug_dump(int fd) {
+  std::unique_lock<std::mutex> lock(sampler_lock);
+  size_t interval = sampling_interval.load(std::memory_order_relaxed);
+  if (interval == 0) {
+    dprintf(fd, "  Heap sampling disabled\n");
+    return;
+  }
+
+  dprintf(fd,
+          "  Heap sampling one in %zu octets, live/dropped samples : %zu / "
+          "%zu\n",
+          interval, live_samples.load(std::memory_order_relaxed),
+          dropped_samples);
+
+  std::vector<std::pair<std::string, subsystem_stats_t>> subsystems(
+      sampled_subsystems.begin(), sampled_subsystems.end());
+  std::vector<std::pair<const void*, sample_stats_t>> sites(
+      sampled_sites.begin(), sampled_sites.end());
+  lock.unlock();
+
+  std::sort(subsystems.begin(), subsystems.end(),
+            [](const auto& a, const auto& b) {
+              return has_more_octets(a.second.stats, b.second.stats);
+            });
+  std::sort(sites.begin(), sites.end(), [](const auto& a, const auto& b) {
+    return has_more_octets(a.second, b.second);
+  });
+
+  dprintf(fd, "  Estimated allocated/live octets by thread:\n");
+  for (const auto& entry : subsystems) {
+    const subsystem_stats_t& subsystem = entry.second;
+    dprintf(fd, "    %-16s : %zu / %zu, samples by size:", entry.first.c_str(),
+            subsystem.stats.allocated_octets, subsystem.stats.live_octets);
+    for (size_t i = 0; i < kSizeBuckets; i++) {
+      if (subsystem.size_buckets[i] == 0) continue;
+      if (i == kSizeBuckets - 1) {
+        dprintf(fd, " >%zu:%zu", (size_t)16 << (i - 1),
+                subsystem.size_buckets[i]);
+      } else {
+        dprintf(fd, " <=%zu:%zu", (size_t)16 << i, subsystem.size_buckets[i]);
+      }
+    }
+    dprintf(fd, "\n");
+  }
+
+  dprintf(fd, "  Top call sites by estimated live/allocated octets:\n");
+  for (size_t i = 0; i < sites.size() && i < kMaxDumpedSites; i++) {
+    const void* caller = sites[i].first;
+    const sample_stats_t& site = sites[i].second;
+    Dl_info info = {};
+    const char* module = "?";
+    uintptr_t offset = reinterpret_cast<uintptr_t>(caller);
+    if (dladdr(caller, &info) != 0 && info.dli_fname != nullptr) {
+      module = strrchr(info.dli_fname, '/');
+      module = module != nullptr ? module + 1 : info.dli_fname;
+      offset -= reinterpret_cast<uintptr_t>(info.dli_fbase);
+    }
+    dprintf(fd, "    %s+0x%zx %s : %zu / %zu in %zu samples\n", module,
+            (size_t)offset, info.dli_sname != nullptr ? info.dli_sname : "",
+            site.live_octets, site.allocated_octets, site.samples);
+  }
+}
+
+}  // namespace
+
+void allocation_tracker_set_sampling_interval(size_t interval) {
+  std::lock_guard<std::mutex> lock(sampler_lock);
+  sampling_interval.store(interval, std::memory_order_relaxed);
+  for (auto& slot : sample_slots) slot.ptr.store(0, std::memory_order_relaxed);
+  sampled_sites.clear();
+  sampled_subsystems.clear();
+  dropped_samples = 0;
+  live_samples.store(0, std::memory_order_relaxed);
+}
+
+void allocation_tracker_sample_alloc(void* ptr, size_t size,
+                                     const void* caller) {
+  size_t interval = sampling_interval.load(std::memory_order_relaxed);
+  if (interval == 0 || !ptr) return;
+
+  if (countdown_interval != interval) {
+    countdown_interval = interval;
+    bytes_until_sample = next_sample_distance(interval);
+  }
+  bytes_until_sample -= size;
+  if (bytes_until_sample > 0 && size < interval) return;
+
+  bytes_until_sample = next_sample_distance(interval);
+  record_sample(ptr, size, caller, interval);
+}
+
+void allocation_tracker_sample_free(void* ptr) {
+  if (!ptr || live_samples.load(std::memory_order_relaxed) == 0) return;
+
+  uintptr_t key = reinterpret_cast<uintptr_t>(ptr);
+  size_t index = sample_slot_index(key);
+  for (size_t i = 0; i < kMaxSampleProbes; i++) {
+    sample_slot_t& slot = sample_slots[(index + i) & (kSampleSlots - 1)];
+    uintptr_t value = slot.ptr.load(std::memory_order_acquire);
+    if (value == 0) return;  // No allocation was probed past this slot
+    if (value != key) continue;
+
+    std::lock_guard<std::mutex> lock(sampler_lock);
+    if (slot.ptr.load(std::memory_order_relaxed) != key) return;
+    slot.site->live_samples--;
+    slot.site->live_octets -= slot.weight;
+    slot.subsystem->stats.live_samples--;
+    slot.subsystem->stats.live_octets -= slot.weight;
+    // The slot is the end of the probe sequences going through it when the
+    // next one is empty
+    const sample_slot_t& next =
+        sample_slots[(index + i + 1) & (kSampleSlots - 1)];
+    slot.ptr.store(next.ptr.load(std::memory_order_relaxed) == 0 ? 0
+                                                                 : kFreedSlot,
+                   std::memory_order_release);
+    live_samples.fetch_sub(1, std::memory_order_relaxed);
+    return;
+  }
+}
+
+size_t allocation_tracker_sampled_count(void) {
+  return live_samples.load(std::memory_order_relaxed);
+}
+
 void osi_allocator_debug_dump(int fd) {
   dprintf(fd, "\nBluetooth Memory Allocation Statistics:\n");
 
@@ -184,4 +438,9 @@ void osi_allocator_debug_dump(int fd) {
   dprintf(fd, "  Total allocated/free/used octets : %zu / %zu / %zu\n",
           alloc_total_size, free_total_size,
           alloc_total_size - free_total_size);
+  lock.unlock();
+
+  sampling_debug_dump(fd);
+
+  pool_allocator_debug_dump(fd);
 }
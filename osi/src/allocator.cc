@@ -21,18 +21,34 @@
 
 #include "osi/include/allocation_tracker.h"
 #include "osi/include/allocator.h"
+#include "osi/include/pool_allocator.h"
 
 static const allocator_id_t alloc_allocator_id = 42;
 
+// Returns |real_size| bytes from the size-class pools when possible, falling
+// back to libc otherwise.
+static void* allocate(size_t real_size, bool zeroed) {
+  void* ptr = pool_allocator_alloc(real_size);
+  if (ptr != NULL) {
+    if (zeroed) memset(ptr, 0, real_size);
+    return ptr;
+  }
+
+  ptr = zeroed ? calloc(1, real_size) : malloc(real_size);
+  CHECK(ptr);
+  return ptr;
+}
+
 char* osi_strdup(const char* str) {
   size_t size = strlen(str) + 1;  // + 1 for the null terminator
   size_t real_size = allocation_tracker_resize_for_canary(size);
-  void* ptr = malloc(real_size);
-  CHECK(ptr);
+  void* ptr = allocate(real_size, false);
 
   char* new_string = static_cast<char*>(
       allocation_tracker_notify_alloc(alloc_allocator_id, ptr, size));
   if (!new_string) return NULL;
+  allocation_tracker_sample_alloc(new_string, size,
+                                  __builtin_return_address(0));
 
   memcpy(new_string, str, size);
   return new_string;
@@ -43,12 +59,13 @@ char* osi_strndup(const char* str, size_t len) {
   if (len < size) size = len;
 
   size_t real_size = allocation_tracker_resize_for_canary(size + 1);
-  void* ptr = malloc(real_size);
-  CHECK(ptr);
+  void* ptr = allocate(real_size, false);
 
   char* new_string = static_cast<char*>(
       allocation_tracker_notify_alloc(alloc_allocator_id, ptr, size + 1));
   if (!new_string) return NULL;
+  allocation_tracker_sample_alloc(new_string, size + 1,
+                                  __builtin_return_address(0));
 
   memcpy(new_string, str, size);
   new_string[size] = '\0';
@@ -57,20 +74,24 @@ char* osi_strndup(const char* str, size_t len) {
 
 void* osi_malloc(size_t size) {
   size_t real_size = allocation_tracker_resize_for_canary(size);
-  void* ptr = malloc(real_size);
-  CHECK(ptr);
-  return allocation_tracker_notify_alloc(alloc_allocator_id, ptr, size);
+  void* ptr = allocate(real_size, false);
+  ptr = allocation_tracker_notify_alloc(alloc_allocator_id, ptr, size);
+  allocation_tracker_sample_alloc(ptr, size, __builtin_return_address(0));
+  return ptr;
 }
 
 void* osi_calloc(size_t size) {
   size_t real_size = allocation_tracker_resize_for_canary(size);
-  void* ptr = calloc(1, real_size);
-  CHECK(ptr);
-  return allocation_tracker_notify_alloc(alloc_allocator_id, ptr, size);
+  void* ptr = allocate(real_size, true);
+  ptr = allocation_tracker_notify_alloc(alloc_allocator_id, ptr, size);
+  allocation_tracker_sample_alloc(ptr, size, __builtin_return_address(0));
+  return ptr;
 }
 
 void osi_free(void* ptr) {
-  free(allocation_tracker_notify_free(alloc_allocator_id, ptr));
+  allocation_tracker_sample_free(ptr);
+  void* real_ptr = allocation_tracker_notify_free(alloc_allocator_id, ptr);
+  if (!pool_allocator_free(real_ptr)) free(real_ptr);
 }
 
 void osi_free_and_reset(void** p_ptr) {
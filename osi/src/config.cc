@@ -25,19 +25,25 @@
 #include <fcntl.h>
 #include <libgen.h>
 #include <log/log.h>
+#include <openssl/sha.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
 #include <sstream>
 #include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "osi/include/osi.h"
 
 void section_t::Set(std::string key, std::string value) {
   for (entry_t& entry : entries) {
     if (entry.key == key) {
-      entry.value = value;
+      entry.value = std::move(value);
       return;
     }
   }
@@ -66,7 +72,13 @@ bool config_t::Has(const std::string& key) {
   return Find(key) != sections.end();
 }
 
-static bool config_parse(FILE* fp, config_t* config);
+static bool config_parse(const char* data, size_t size, config_t* config,
+                         SHA256_CTX* checksum);
+static std::unique_ptr<config_t> config_load(const char* filename,
+                                             std::string* checksum);
+static void section_set_string(section_t* section, const std::string& key,
+                               const std::string& value);
+static bool file_save(const std::string& contents, const std::string& filename);
 
 template <typename T,
           class = typename std::enable_if<std::is_same<
@@ -97,21 +109,15 @@ std::unique_ptr<config_t> config_new_empty(void) {
 std::unique_ptr<config_t> config_new(const char* filename) {
   CHECK(filename != nullptr);
 
-  std::unique_ptr<config_t> config = config_new_empty();
-
-  FILE* fp = fopen(filename, "rt");
-  if (!fp) {
-    LOG(ERROR) << __func__ << ": unable to open file '" << filename
-               << "': " << strerror(errno);
-    return nullptr;
-  }
+  return config_load(filename, nullptr);
+}
 
-  if (!config_parse(fp, config.get())) {
-    config.reset();
-  }
+std::unique_ptr<config_t> config_new_with_checksum(const char* filename,
+                                                   std::string* checksum) {
+  CHECK(filename != nullptr);
+  CHECK(checksum != nullptr);
 
-  fclose(fp);
-  return config;
+  return config_load(filename, checksum);
 }
 
 std::string checksum_read(const char* filename) {
@@ -223,14 +229,7 @@ void config_set_string(config_t* config, const std::string& section,
     value_no_newline = value;
   }
 
-  for (entry_t& entry : sec->entries) {
-    if (entry.key == key) {
-      entry.value = value_no_newline;
-      return;
-    }
-  }
-
-  sec->entries.emplace_back(entry_t{.key = key, .value = value_no_newline});
+  section_set_string(&*sec, key, value_no_newline);
 }
 
 bool config_remove_section(config_t* config, const std::string& section) {
@@ -379,19 +378,24 @@ bool checksum_save(const std::string& checksum, const std::string& filename) {
   CHECK(!checksum.empty()) << __func__ << ": checksum cannot be empty";
   CHECK(!filename.empty()) << __func__ << ": filename cannot be empty";
 
-  // Steps to ensure content of config checksum file gets to disk:
+  return file_save(checksum, filename);
+}
+
+static bool file_save(const std::string& contents,
+                      const std::string& filename) {
+  // Steps to ensure |contents| gets to disk:
   //
   // 1) Open and write to temp file (e.g.
   // bt_config.conf.encrypted-checksum.new). 2) Sync the temp file to disk with
-  // fsync(). 3) Rename temp file to actual config checksum file (e.g.
+  // fsync(). 3) Rename temp file to actual file (e.g.
   // bt_config.conf.encrypted-checksum).
   //    This ensures atomic update.
-  // 4) Sync directory that has the conf file with fsync().
+  // 4) Sync directory that has the file with fsync().
   //    This ensures directory entries are up-to-date.
   FILE* fp = nullptr;
   int dir_fd = -1;
 
-  // Build temp config checksum file based on config checksum file (e.g.
+  // Build temp file name based on the file name (e.g.
   // bt_config.conf.encrypted-checksum.new).
   const std::string temp_filename = filename + ".new";
   base::FilePath path(temp_filename);
@@ -411,8 +415,8 @@ bool checksum_save(const std::string& checksum, const std::string& filename) {
     goto error2;
   }
 
-  if (base::WriteFile(path, checksum.data(), checksum.size()) !=
-      (int)checksum.size()) {
+  if (base::WriteFile(path, contents.data(), contents.size()) !=
+      (int)contents.size()) {
     LOG(ERROR) << __func__ << ": unable to write file '" << filename.c_str();
     goto error2;
   }
@@ -476,54 +480,379 @@ error2:
   return false;
 }
 
-static char* trim(char* str) {
-  while (isspace(*str)) ++str;
+// Journal records, one per line, with every string length-prefixed:
+//   S <section> <key> <value>  sets a key
+//   K <section> <key>          removes a key
+//   D <section>                removes a section
+//   C                          commits the records written since the last C
+// The first line is a header naming the generation of the config file the
+// journal applies to.
+static const char JOURNAL_HEADER[] = "# bt_config journal ";
+
+static void journal_put_string(std::ostringstream& out,
+                               const std::string& str) {
+  out << ' ' << str.size() << ':' << str;
+}
+
+static bool journal_get_string(const std::string& data, size_t* pos,
+                               std::string* str) {
+  if (*pos >= data.size() || data[*pos] != ' ') return false;
+  ++*pos;
+
+  size_t length = 0;
+  size_t digits = 0;
+  while (*pos < data.size() && isdigit(data[*pos]) && digits < 8) {
+    length = length * 10 + (data[*pos] - '0');
+    ++*pos;
+    ++digits;
+  }
+  if (digits == 0 || *pos >= data.size() || data[*pos] != ':') return false;
+  ++*pos;
+
+  if (data.size() - *pos < length) return false;
+  str->assign(data, *pos, length);
+  *pos += length;
+  return true;
+}
+
+bool config_journal_reset(const std::string& filename,
+                          const std::string& generation) {
+  CHECK(!filename.empty());
+
+  return file_save(JOURNAL_HEADER + generation + "\n", filename);
+}
+
+bool config_journal_append(const std::string& filename,
+                           const config_t& old_config,
+                           const config_t& new_config, size_t* journal_size) {
+  CHECK(!filename.empty());
+
+  std::unordered_map<std::string, const section_t*> old_sections;
+  for (const section_t& section : old_config.sections)
+    old_sections[section.name] = &section;
+
+  std::ostringstream records;
+  for (const section_t& section : new_config.sections) {
+    std::unordered_map<std::string, const std::string*> old_entries;
+    auto old_section = old_sections.find(section.name);
+    if (old_section != old_sections.end()) {
+      for (const entry_t& entry : old_section->second->entries)
+        old_entries[entry.key] = &entry.value;
+      old_sections.erase(old_section);
+    }
+
+    for (const entry_t& entry : section.entries) {
+      auto old_entry = old_entries.find(entry.key);
+      if (old_entry != old_entries.end()) {
+        bool unchanged = *old_entry->second == entry.value;
+        old_entries.erase(old_entry);
+        if (unchanged) continue;
+      }
+      records << 'S';
+      journal_put_string(records, section.name);
+      journal_put_string(records, entry.key);
+      journal_put_string(records, entry.value);
+      records << '\n';
+    }
+
+    for (const auto& old_entry : old_entries) {
+      records << 'K';
+      journal_put_string(records, section.name);
+      journal_put_string(records, old_entry.first);
+      records << '\n';
+    }
+  }
+
+  for (const auto& old_section : old_sections) {
+    records << 'D';
+    journal_put_string(records, old_section.first);
+    records << '\n';
+  }
 
-  if (!*str) return str;
+  int fd = open(filename.c_str(), O_WRONLY | O_APPEND | O_CLOEXEC);
+  if (fd == -1) {
+    LOG(ERROR) << __func__ << ": unable to open journal '" << filename
+               << "': " << strerror(errno);
+    return false;
+  }
+
+  bool ret = true;
+  const std::string transaction = records.str();
+  if (!transaction.empty()) {
+    const std::string data = transaction + "C\n";
+    size_t written = 0;
+    while (written < data.size()) {
+      ssize_t rc;
+      OSI_NO_INTR(
+          rc = write(fd, data.data() + written, data.size() - written));
+      if (rc == -1) {
+        LOG(ERROR) << __func__ << ": unable to write journal '" << filename
+                   << "': " << strerror(errno);
+        ret = false;
+        break;
+      }
+      written += rc;
+    }
+
+    // Only the data needs to reach the disk, the journal file already exists.
+    if (ret && fdatasync(fd) == -1) {
+      LOG(ERROR) << __func__ << ": unable to sync journal '" << filename
+                 << "': " << strerror(errno);
+      ret = false;
+    }
+  }
 
-  char* end_str = str + strlen(str) - 1;
-  while (end_str > str && isspace(*end_str)) --end_str;
+  struct stat st;
+  if (ret && journal_size) {
+    if (fstat(fd, &st) == -1) {
+      LOG(ERROR) << __func__ << ": unable to stat journal '" << filename
+                 << "': " << strerror(errno);
+      ret = false;
+    } else {
+      *journal_size = st.st_size;
+    }
+  }
 
-  end_str[1] = '\0';
-  return str;
+  close(fd);
+  return ret;
 }
 
-static bool config_parse(FILE* fp, config_t* config) {
-  CHECK(fp != nullptr);
+bool config_journal_replay(const std::string& filename,
+                           const std::string& generation, config_t* config) {
+  CHECK(!filename.empty());
   CHECK(config != nullptr);
 
-  int line_num = 0;
-  char line[1024];
-  char section[1024];
-  strcpy(section, CONFIG_DEFAULT_SECTION);
+  std::string data;
+  if (!base::ReadFileToString(base::FilePath(filename), &data)) return false;
+
+  const std::string header = JOURNAL_HEADER + generation + "\n";
+  if (data.compare(0, header.size(), header) != 0) {
+    LOG(INFO) << __func__ << ": journal '" << filename
+              << "' does not apply to config generation " << generation;
+    return false;
+  }
+
+  struct record_t {
+    char type;
+    std::string section;
+    std::string key;
+    std::string value;
+  };
+  std::vector<record_t> pending;
+  size_t transactions = 0;
+
+  size_t pos = header.size();
+  while (pos < data.size()) {
+    record_t record = {data[pos++]};
+    bool valid;
+    switch (record.type) {
+      case 'S':
+        valid = journal_get_string(data, &pos, &record.section) &&
+                journal_get_string(data, &pos, &record.key) &&
+                journal_get_string(data, &pos, &record.value);
+        break;
+      case 'K':
+        valid = journal_get_string(data, &pos, &record.section) &&
+                journal_get_string(data, &pos, &record.key);
+        break;
+      case 'D':
+        valid = journal_get_string(data, &pos, &record.section);
+        break;
+      case 'C':
+        valid = true;
+        break;
+      default:
+        valid = false;
+        break;
+    }
+    if (!valid || pos >= data.size() || data[pos] != '\n') {
+      // Most likely a transaction torn by a crash while it was appended.
+      LOG(WARNING) << __func__ << ": dropping journal '" << filename
+                   << "' from offset " << pos;
+      break;
+    }
+    ++pos;
+
+    if (record.type != 'C') {
+      pending.push_back(std::move(record));
+      continue;
+    }
+
+    for (const record_t& change : pending) {
+      if (change.type == 'S')
+        config_set_string(config, change.section, change.key, change.value);
+      else if (change.type == 'K')
+        config_remove_key(config, change.section, change.key);
+      else
+        config_remove_section(config, change.section);
+    }
+    pending.clear();
+    ++transactions;
+  }
+
+  LOG(INFO) << __func__ << ": replayed " << transactions
+            << " transaction(s) from '" << filename << "'";
+  return true;
+}
+
+static std::unique_ptr<config_t> config_load(const char* filename,
+                                             std::string* checksum) {
+  int fd;
+  OSI_NO_INTR(fd = open(filename, O_RDONLY | O_CLOEXEC));
+  if (fd == -1) {
+    LOG(ERROR) << __func__ << ": unable to open file '" << filename
+               << "': " << strerror(errno);
+    return nullptr;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) == -1) {
+    LOG(ERROR) << __func__ << ": unable to stat file '" << filename
+               << "': " << strerror(errno);
+    close(fd);
+    return nullptr;
+  }
 
-  while (fgets(line, sizeof(line), fp)) {
-    char* line_ptr = trim(line);
+  // The file is only read once, front to back, so map it rather than copy it
+  // through a line buffer. An empty file cannot be mapped.
+  const size_t size = st.st_size;
+  void* data = nullptr;
+  if (size > 0) {
+    data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      LOG(ERROR) << __func__ << ": unable to map file '" << filename
+                 << "': " << strerror(errno);
+      close(fd);
+      return nullptr;
+    }
+    madvise(data, size, MADV_SEQUENTIAL);
+  }
+  close(fd);
+
+  SHA256_CTX sha256;
+  if (checksum) SHA256_Init(&sha256);
+
+  std::unique_ptr<config_t> config = config_new_empty();
+  if (!config_parse(static_cast<const char*>(data), size, config.get(),
+                    checksum ? &sha256 : nullptr)) {
+    config.reset();
+  } else if (checksum) {
+    uint8_t digest[SHA256_DIGEST_LENGTH];
+    SHA256_Final(digest, &sha256);
+    static const char kHex[] = "0123456789abcdef";
+    checksum->clear();
+    checksum->reserve(2 * sizeof(digest));
+    for (uint8_t byte : digest) {
+      checksum->push_back(kHex[byte >> 4]);
+      checksum->push_back(kHex[byte & 0x0f]);
+    }
+  }
+
+  if (data) munmap(data, size);
+  return config;
+}
+
+// Narrows [*begin, *end) to exclude leading and trailing whitespace.
+static void trim(const char** begin, const char** end) {
+  while (*begin < *end && isspace(**begin)) ++*begin;
+  while (*end > *begin && isspace((*end)[-1])) --*end;
+}
+
+// The checksum is fed the bytes the parser has gone past in blocks of this
+// size, while they are still in the cache.
+static const size_t CHECKSUM_BLOCK_SIZE = 64 * 1024;
+
+// Tokenizes |data| in place: lines, section names, keys and values are ranges
+// of |data|, and only keys and values are copied, into the config itself.
+static bool config_parse(const char* data, size_t size, config_t* config,
+                         SHA256_CTX* checksum) {
+  CHECK(config != nullptr);
+
+  int line_num = 0;
+  const char* const data_end = data + size;
+  const char* hashed = data;
+  std::string section = CONFIG_DEFAULT_SECTION;
+
+  // Index of the sections seen so far, so that each line does not walk the
+  // whole section list the way config_set_string does.
+  std::unordered_map<std::string, std::list<section_t>::iterator> sections;
+  for (auto it = config->sections.begin(); it != config->sections.end(); ++it)
+    sections.emplace(it->name, it);
+  auto current = config->sections.end();
+
+  const char* line = data;
+  while (line < data_end) {
+    const char* next =
+        static_cast<const char*>(memchr(line, '\n', data_end - line));
+    next = next ? next + 1 : data_end;
     ++line_num;
 
+    if (checksum && next - hashed >= (ptrdiff_t)CHECKSUM_BLOCK_SIZE) {
+      SHA256_Update(checksum, hashed, next - hashed);
+      hashed = next;
+    }
+
+    // Like a C string, a line ends at the first NUL.
+    const char* line_end =
+        static_cast<const char*>(memchr(line, '\0', next - line));
+    if (!line_end) line_end = next;
+    trim(&line, &line_end);
+
     // Skip blank and comment lines.
-    if (*line_ptr == '\0' || *line_ptr == '#') continue;
+    if (line == line_end || *line == '#') {
+      line = next;
+      continue;
+    }
 
-    if (*line_ptr == '[') {
-      size_t len = strlen(line_ptr);
-      if (line_ptr[len - 1] != ']') {
+    if (*line == '[') {
+      if (line_end - line < 2 || line_end[-1] != ']') {
         VLOG(1) << __func__ << ": unterminated section name on line "
                 << line_num;
         return false;
       }
-      strncpy(section, line_ptr + 1, len - 2);  // NOLINT (len < 1024)
-      section[len - 2] = '\0';
+      section.assign(line + 1, line_end - 1);
+      current = config->sections.end();
     } else {
-      char* split = strchr(line_ptr, '=');
+      const char* split =
+          static_cast<const char*>(memchr(line, '=', line_end - line));
       if (!split) {
         VLOG(1) << __func__ << ": no key/value separator found on line "
                 << line_num;
         return false;
       }
 
-      *split = '\0';
-      config_set_string(config, section, trim(line_ptr), trim(split + 1));
+      // Sections are only created once they hold a key
+      if (current == config->sections.end()) {
+        auto it = sections.find(section);
+        if (it == sections.end()) {
+          config->sections.emplace_back(section_t{.name = section});
+          it = sections.emplace(section, std::prev(config->sections.end()))
+                   .first;
+        }
+        current = it->second;
+      }
+
+      const char* key_end = split;
+      const char* value = split + 1;
+      trim(&line, &key_end);
+      trim(&value, &line_end);
+      current->Set(std::string(line, key_end), std::string(value, line_end));
     }
+    line = next;
   }
+
+  if (checksum) SHA256_Update(checksum, hashed, data_end - hashed);
   return true;
 }
+
+static void section_set_string(section_t* section, const std::string& key,
+                               const std::string& value) {
+  for (entry_t& entry : section->entries) {
+    if (entry.key == key) {
+      entry.value = value;
+      return;
+    }
+  }
+
+  section->entries.emplace_back(entry_t{.key = key, .value = value});
+}
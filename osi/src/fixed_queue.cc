@@ -41,6 +41,11 @@ typedef struct fixed_queue_t {
 } fixed_queue_t;
 
 static void internal_dequeue_ready(void* context);
+static bool internal_dequeue_pending(void* context);
+
+// Max number of |dequeue_ready| callbacks issued back to back per reactor
+// wakeup, so that one busy queue can't starve the other objects of a reactor.
+static const size_t DEQUEUE_BATCH_SIZE = 16;
 
 fixed_queue_t* fixed_queue_new(size_t capacity) {
   fixed_queue_t* ret =
@@ -127,6 +132,32 @@ void fixed_queue_enqueue(fixed_queue_t* queue, void* data) {
   semaphore_post(queue->dequeue_sem);
 }
 
+void fixed_queue_enqueue_batch(fixed_queue_t* queue, void* const* data,
+                               size_t count) {
+  CHECK(queue != NULL);
+  CHECK(data != NULL || count == 0);
+
+  size_t done = 0;
+  while (done < count) {
+    // Block for the first free slot only, then take whatever else is free
+    semaphore_wait(queue->enqueue_sem);
+    size_t slots = 1;
+    while (done + slots < count && semaphore_try_wait(queue->enqueue_sem))
+      slots++;
+
+    {
+      std::lock_guard<std::mutex> lock(*queue->mutex);
+      for (size_t i = done; i < done + slots; i++) {
+        CHECK(data[i] != NULL);
+        list_append(queue->list, data[i]);
+      }
+    }
+
+    semaphore_post_count(queue->dequeue_sem, slots);
+    done += slots;
+  }
+}
+
 void* fixed_queue_dequeue(fixed_queue_t* queue) {
   CHECK(queue != NULL);
 
@@ -243,6 +274,8 @@ void fixed_queue_register_dequeue(fixed_queue_t* queue, reactor_t* reactor,
   queue->dequeue_object =
       reactor_register(reactor, fixed_queue_get_dequeue_fd(queue), queue,
                        internal_dequeue_ready, NULL);
+  reactor_set_read_batch(queue->dequeue_object, internal_dequeue_pending,
+                         DEQUEUE_BATCH_SIZE);
 }
 
 void fixed_queue_unregister_dequeue(fixed_queue_t* queue) {
@@ -260,3 +293,9 @@ static void internal_dequeue_ready(void* context) {
   fixed_queue_t* queue = static_cast<fixed_queue_t*>(context);
   queue->dequeue_ready(queue, queue->dequeue_context);
 }
+
+static bool internal_dequeue_pending(void* context) {
+  CHECK(context != NULL);
+
+  return !fixed_queue_is_empty(static_cast<fixed_queue_t*>(context));
+}
@@ -0,0 +1,234 @@
+/******************************************************************************
+ *
+ *  Copyright 2020 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <base/logging.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <stdint.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <atomic>
+
+#include "osi/include/allocator.h"
+#include "osi/include/mpmc_queue.h"
+
+#define MPMC_QUEUE_MAX_CAPACITY ((size_t)1 << 20)
+
+// Each slot carries a sequence number telling which lap of the ring it is
+// ready for. A slot at position |pos| can be filled when its sequence is
+// |pos|, and emptied when it is |pos + 1|; emptying it sets the sequence to
+// |pos + size|, for the next lap. The enqueue and dequeue positions are free
+// running and claimed with compare-and-swap.
+typedef struct {
+  std::atomic<size_t> sequence;
+  void* data;
+} mpmc_slot_t;
+
+// A thread that has to wait reads the wake-up counter of its side, counts
+// itself as a waiter, checks the queue once more and sleeps on the counter.
+// The other side bumps the counter and wakes a sleeper after each change
+// when it sees a waiter. Both sides order their change and their check with
+// a full fence, so either the waiter sees the change or the other side sees
+// the waiter.
+struct mpmc_queue_t {
+  mpmc_slot_t* slots;
+  size_t mask;
+
+  alignas(64) std::atomic<size_t> enqueue_pos;
+
+  alignas(64) std::atomic<size_t> dequeue_pos;
+
+  alignas(64) std::atomic<uint32_t> dequeue_waiters;
+  std::atomic<uint32_t> dequeue_wake;
+  std::atomic<uint32_t> enqueue_waiters;
+  std::atomic<uint32_t> enqueue_wake;
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free,
+              "futex words must be plain 32-bit integers");
+
+static void mpmc_queue_wake(std::atomic<uint32_t>* waiters,
+                            std::atomic<uint32_t>* wake);
+static void mpmc_queue_wait(std::atomic<uint32_t>* waiters,
+                            std::atomic<uint32_t>* wake, uint32_t seq);
+
+mpmc_queue_t* mpmc_queue_new(size_t capacity) {
+  if (capacity == 0 || capacity > MPMC_QUEUE_MAX_CAPACITY) return NULL;
+
+  size_t size = 1;
+  while (size < capacity) size <<= 1;
+
+  mpmc_queue_t* queue =
+      static_cast<mpmc_queue_t*>(osi_calloc(sizeof(mpmc_queue_t)));
+  queue->slots =
+      static_cast<mpmc_slot_t*>(osi_calloc(size * sizeof(mpmc_slot_t)));
+  queue->mask = size - 1;
+  for (size_t i = 0; i < size; i++)
+    queue->slots[i].sequence.store(i, std::memory_order_relaxed);
+  return queue;
+}
+
+void mpmc_queue_free(mpmc_queue_t* queue, mpmc_queue_free_cb free_cb) {
+  if (!queue) return;
+
+  mpmc_queue_flush(queue, free_cb);
+  osi_free(queue->slots);
+  osi_free(queue);
+}
+
+void mpmc_queue_flush(mpmc_queue_t* queue, mpmc_queue_free_cb free_cb) {
+  if (!queue) return;
+
+  void* data;
+  while ((data = mpmc_queue_try_dequeue(queue)) != NULL) {
+    if (free_cb) free_cb(data);
+  }
+}
+
+bool mpmc_queue_is_empty(mpmc_queue_t* queue) {
+  return mpmc_queue_length(queue) == 0;
+}
+
+size_t mpmc_queue_length(mpmc_queue_t* queue) {
+  if (!queue) return 0;
+
+  // Read the dequeue position first, so the difference is never negative
+  size_t dequeue_pos = queue->dequeue_pos.load(std::memory_order_acquire);
+  size_t enqueue_pos = queue->enqueue_pos.load(std::memory_order_acquire);
+  size_t length = enqueue_pos - dequeue_pos;
+  return (length > queue->mask + 1) ? queue->mask + 1 : length;
+}
+
+size_t mpmc_queue_capacity(mpmc_queue_t* queue) {
+  CHECK(queue != NULL);
+
+  return queue->mask + 1;
+}
+
+bool mpmc_queue_try_enqueue(mpmc_queue_t* queue, void* data) {
+  CHECK(queue != NULL);
+  CHECK(data != NULL);
+
+  mpmc_slot_t* slot;
+  size_t pos = queue->enqueue_pos.load(std::memory_order_relaxed);
+  for (;;) {
+    slot = &queue->slots[pos & queue->mask];
+    size_t sequence = slot->sequence.load(std::memory_order_acquire);
+    intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+    if (diff == 0) {
+      if (queue->enqueue_pos.compare_exchange_weak(pos, pos + 1,
+                                                   std::memory_order_relaxed))
+        break;
+    } else if (diff < 0) {
+      // The slot still holds the element of the previous lap
+      return false;
+    } else {
+      pos = queue->enqueue_pos.load(std::memory_order_relaxed);
+    }
+  }
+
+  slot->data = data;
+  slot->sequence.store(pos + 1, std::memory_order_release);
+
+  mpmc_queue_wake(&queue->dequeue_waiters, &queue->dequeue_wake);
+  return true;
+}
+
+void* mpmc_queue_try_dequeue(mpmc_queue_t* queue) {
+  if (!queue) return NULL;
+
+  mpmc_slot_t* slot;
+  size_t pos = queue->dequeue_pos.load(std::memory_order_relaxed);
+  for (;;) {
+    slot = &queue->slots[pos & queue->mask];
+    size_t sequence = slot->sequence.load(std::memory_order_acquire);
+    intptr_t diff = (intptr_t)sequence - (intptr_t)(pos + 1);
+    if (diff == 0) {
+      if (queue->dequeue_pos.compare_exchange_weak(pos, pos + 1,
+                                                   std::memory_order_relaxed))
+        break;
+    } else if (diff < 0) {
+      return NULL;
+    } else {
+      pos = queue->dequeue_pos.load(std::memory_order_relaxed);
+    }
+  }
+
+  void* data = slot->data;
+  slot->sequence.store(pos + queue->mask + 1, std::memory_order_release);
+
+  mpmc_queue_wake(&queue->enqueue_waiters, &queue->enqueue_wake);
+  return data;
+}
+
+void mpmc_queue_enqueue(mpmc_queue_t* queue, void* data) {
+  CHECK(queue != NULL);
+  CHECK(data != NULL);
+
+  while (!mpmc_queue_try_enqueue(queue, data)) {
+    uint32_t seq = queue->enqueue_wake.load();
+    queue->enqueue_waiters.fetch_add(1);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (mpmc_queue_try_enqueue(queue, data)) {
+      queue->enqueue_waiters.fetch_sub(1);
+      return;
+    }
+    mpmc_queue_wait(&queue->enqueue_waiters, &queue->enqueue_wake, seq);
+  }
+}
+
+void* mpmc_queue_dequeue(mpmc_queue_t* queue) {
+  CHECK(queue != NULL);
+
+  for (;;) {
+    void* data = mpmc_queue_try_dequeue(queue);
+    if (data) return data;
+
+    uint32_t seq = queue->dequeue_wake.load();
+    queue->dequeue_waiters.fetch_add(1);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    data = mpmc_queue_try_dequeue(queue);
+    if (data) {
+      queue->dequeue_waiters.fetch_sub(1);
+      return data;
+    }
+    mpmc_queue_wait(&queue->dequeue_waiters, &queue->dequeue_wake, seq);
+  }
+}
+
+// Wakes one thread sleeping on |wake| if there may be one. Called after each
+// change of the queue, so it must stay cheap when nobody waits.
+static void mpmc_queue_wake(std::atomic<uint32_t>* waiters,
+                            std::atomic<uint32_t>* wake) {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (waiters->load(std::memory_order_relaxed) == 0) return;
+
+  wake->fetch_add(1);
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(wake), FUTEX_WAKE_PRIVATE, 1,
+          NULL, NULL, 0);
+}
+
+// Sleeps on |wake| unless it moved away from |seq|, then stops counting the
+// caller as a waiter.
+static void mpmc_queue_wait(std::atomic<uint32_t>* waiters,
+                            std::atomic<uint32_t>* wake, uint32_t seq) {
+  // Returns early with EAGAIN when the counter already moved, or EINTR
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(wake), FUTEX_WAIT_PRIVATE,
+          seq, NULL, NULL, 0);
+  waiters->fetch_sub(1);
+}
@@ -0,0 +1,291 @@
+/******************************************************************************
+ *
+ *  Copyright 2020 Google, Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#define LOG_TAG "bt_osi_pool_allocator"
+
+#include "osi/include/pool_allocator.h"
+
+#include <base/logging.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <atomic>
+#include <mutex>
+
+#include "internal_include/bt_target.h"
+#include "osi/include/log.h"
+
+namespace {
+
+// Room for the allocation tracker canaries on both sides of a buffer.
+constexpr size_t kCanaryHeadroom = 16;
+constexpr size_t kBlockAlignment = 16;
+
+constexpr size_t align_block(size_t size) {
+  return (size + kBlockAlignment - 1) & ~(kBlockAlignment - 1);
+}
+
+struct size_class_config_t {
+  size_t block_size;
+  size_t block_count;
+};
+
+// Ordered by increasing block size.
+constexpr size_class_config_t kSizeClasses[] = {
+    // AVCT/AVRC command buffers.
+    {align_block(AVRC_CMD_BUF_SIZE + kCanaryHeadroom), 64},
+    // HCI, L2CAP, RFCOMM and AVDTP command buffers.
+    {align_block(BT_SMALL_BUFFER_SIZE + kCanaryHeadroom), 256},
+    // ACL, L2CAP, RFCOMM, SDP, BNEP and GATT data buffers.
+    {align_block(BT_DEFAULT_BUFFER_SIZE + kCanaryHeadroom), 512},
+};
+constexpr size_t kNumSizeClasses =
+    sizeof(kSizeClasses) / sizeof(kSizeClasses[0]);
+
+// Per-thread cache limits. A thread refills |kBatchSize| blocks at a time
+// from the depot and spills |kBatchSize| blocks back once it holds more than
+// |kMaxCachedBlocks|.
+constexpr size_t kBatchSize = 16;
+constexpr size_t kMaxCachedBlocks = 2 * kBatchSize;
+
+struct free_block_t {
+  free_block_t* next;
+};
+
+struct size_class_t {
+  uint8_t* start;
+  uint8_t* end;
+  size_t block_size;
+
+  // Shared depot, guarded by |lock|.
+  std::mutex lock;
+  free_block_t* depot;
+  size_t depot_count;
+  uint8_t* bump;  // Next never-used block in [start, end)
+
+  std::atomic<uint64_t> hits;
+  std::atomic<uint64_t> misses;
+  std::atomic<uint64_t> refills;
+  std::atomic<int64_t> in_use;
+};
+
+size_class_t size_classes[kNumSizeClasses];
+std::atomic<uint8_t*> arena_start(nullptr);
+std::atomic<uint8_t*> arena_end(nullptr);
+std::once_flag arena_once;
+
+void arena_init() {
+  size_t total = 0;
+  for (const auto& config : kSizeClasses)
+    total += config.block_size * config.block_count;
+
+  // Reserve the arena up front; pages only become resident once a block is
+  // first handed out.
+  void* arena = mmap(nullptr, total, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (arena == MAP_FAILED) {
+    LOG_ERROR(LOG_TAG, "%s unable to reserve %zu bytes, pool disabled",
+              __func__, total);
+    return;
+  }
+
+  uint8_t* cursor = static_cast<uint8_t*>(arena);
+  for (size_t i = 0; i < kNumSizeClasses; i++) {
+    size_class_t& sc = size_classes[i];
+    sc.block_size = kSizeClasses[i].block_size;
+    sc.start = cursor;
+    sc.end = cursor + sc.block_size * kSizeClasses[i].block_count;
+    sc.bump = sc.start;
+    sc.depot = nullptr;
+    sc.depot_count = 0;
+    cursor = sc.end;
+  }
+
+  arena_end.store(cursor, std::memory_order_release);
+  arena_start.store(static_cast<uint8_t*>(arena), std::memory_order_release);
+}
+
+// Takes up to |kBatchSize| blocks from the depot of |sc|, carving new ones
+// from the untouched part of the class if the depot runs dry. Returns the
+// number of blocks linked onto |*head|.
+size_t depot_take(size_class_t& sc, free_block_t** head) {
+  std::lock_guard<std::mutex> lock(sc.lock);
+  size_t taken = 0;
+  while (taken < kBatchSize && sc.depot != nullptr) {
+    free_block_t* block = sc.depot;
+    sc.depot = block->next;
+    block->next = *head;
+    *head = block;
+    taken++;
+  }
+  sc.depot_count -= taken;
+
+  while (taken < kBatchSize && sc.bump < sc.end) {
+    free_block_t* block = reinterpret_cast<free_block_t*>(sc.bump);
+    sc.bump += sc.block_size;
+    block->next = *head;
+    *head = block;
+    taken++;
+  }
+
+  sc.refills.fetch_add(1, std::memory_order_relaxed);
+  return taken;
+}
+
+void depot_give(size_class_t& sc, free_block_t* first, free_block_t* last,
+                size_t count) {
+  std::lock_guard<std::mutex> lock(sc.lock);
+  last->next = sc.depot;
+  sc.depot = first;
+  sc.depot_count += count;
+}
+
+class ThreadCache {
+ public:
+  ~ThreadCache() {
+    // Hand everything back so blocks cached by exiting threads stay usable.
+    for (size_t i = 0; i < kNumSizeClasses; i++) {
+      if (heads_[i] == nullptr) continue;
+      free_block_t* last = heads_[i];
+      while (last->next != nullptr) last = last->next;
+      depot_give(size_classes[i], heads_[i], last, counts_[i]);
+      heads_[i] = nullptr;
+      counts_[i] = 0;
+    }
+  }
+
+  void* Alloc(size_t index) {
+    if (heads_[index] == nullptr) {
+      counts_[index] = depot_take(size_classes[index], &heads_[index]);
+      if (heads_[index] == nullptr) return nullptr;
+    }
+
+    free_block_t* block = heads_[index];
+    heads_[index] = block->next;
+    counts_[index]--;
+    return block;
+  }
+
+  void Free(size_t index, void* ptr) {
+    free_block_t* block = static_cast<free_block_t*>(ptr);
+    block->next = heads_[index];
+    heads_[index] = block;
+    counts_[index]++;
+
+    if (counts_[index] <= kMaxCachedBlocks) return;
+
+    // Spill the most recently freed batch, keeping the rest warm locally.
+    free_block_t* first = heads_[index];
+    free_block_t* last = first;
+    for (size_t i = 1; i < kBatchSize; i++) last = last->next;
+    heads_[index] = last->next;
+    counts_[index] -= kBatchSize;
+    depot_give(size_classes[index], first, last, kBatchSize);
+  }
+
+ private:
+  free_block_t* heads_[kNumSizeClasses] = {};
+  size_t counts_[kNumSizeClasses] = {};
+};
+
+thread_local ThreadCache thread_cache;
+
+// Returns the index of the size class owning |ptr|, or -1.
+int owning_class(const void* ptr) {
+  const uint8_t* p = static_cast<const uint8_t*>(ptr);
+  const uint8_t* start = arena_start.load(std::memory_order_acquire);
+  if (start == nullptr || p < start ||
+      p >= arena_end.load(std::memory_order_relaxed))
+    return -1;
+
+  for (size_t i = 0; i < kNumSizeClasses; i++) {
+    if (p < size_classes[i].end) return i;
+  }
+  return -1;
+}
+
+}  // namespace
+
+void* pool_allocator_alloc(size_t size) {
+  size_t index = 0;
+  while (index < kNumSizeClasses && kSizeClasses[index].block_size < size)
+    index++;
+  if (index == kNumSizeClasses) return nullptr;
+
+  std::call_once(arena_once, arena_init);
+  if (arena_start.load(std::memory_order_acquire) == nullptr) return nullptr;
+
+  size_class_t& sc = size_classes[index];
+  void* ptr = thread_cache.Alloc(index);
+  if (ptr == nullptr) {
+    sc.misses.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+  }
+
+  sc.hits.fetch_add(1, std::memory_order_relaxed);
+  sc.in_use.fetch_add(1, std::memory_order_relaxed);
+  return ptr;
+}
+
+bool pool_allocator_free(void* ptr) {
+  int index = owning_class(ptr);
+  if (index < 0) return false;
+
+  size_class_t& sc = size_classes[index];
+  CHECK((static_cast<uint8_t*>(ptr) - sc.start) % sc.block_size == 0);
+
+  sc.in_use.fetch_sub(1, std::memory_order_relaxed);
+  thread_cache.Free(index, ptr);
+  return true;
+}
+
+size_t pool_allocator_block_size(const void* ptr) {
+  int index = owning_class(ptr);
+  return (index < 0) ? 0 : size_classes[index].block_size;
+}
+
+void pool_allocator_debug_dump(int fd) {
+  dprintf(fd, "\nBluetooth Pool Allocator Statistics:\n");
+
+  if (arena_start.load(std::memory_order_acquire) == nullptr) {
+    dprintf(fd, "  Not initialized\n");
+    return;
+  }
+
+  for (size_t i = 0; i < kNumSizeClasses; i++) {
+    size_class_t& sc = size_classes[i];
+    size_t carved;
+    size_t depot_count;
+    {
+      std::lock_guard<std::mutex> lock(sc.lock);
+      carved = (sc.bump - sc.start) / sc.block_size;
+      depot_count = sc.depot_count;
+    }
+
+    dprintf(fd, "  Size class %zu bytes (capacity %zu blocks)\n",
+            sc.block_size, kSizeClasses[i].block_count);
+    dprintf(fd,
+            "    Hits/misses/refills         : %" PRIu64 " / %" PRIu64
+            " / %" PRIu64 "\n",
+            sc.hits.load(std::memory_order_relaxed),
+            sc.misses.load(std::memory_order_relaxed),
+            sc.refills.load(std::memory_order_relaxed));
+    dprintf(fd, "    In use/carved/in depot      : %" PRId64 " / %zu / %zu\n",
+            sc.in_use.load(std::memory_order_relaxed), carved, depot_count);
+  }
+}
@@ -59,9 +59,14 @@ struct reactor_object_t {
                                        // descriptor becomes readable.
   void (*write_ready)(void* context);  // function to call when the file
                                        // descriptor becomes writeable.
+
+  bool (*read_pending)(void* context);  // whether more input is available
+                                        // without waiting for the fd.
+  size_t read_batch;  // max number of |read_ready| calls per wakeup.
 };
 
 static reactor_status_t run_reactor(reactor_t* reactor, int iterations);
+static bool object_invalidated(reactor_t* reactor, reactor_object_t* object);
 
 static const size_t MAX_EVENTS = 64;
 static const eventfd_t EVENT_REACTOR_STOP = 1;
@@ -150,6 +155,7 @@ reactor_object_t* reactor_register(reactor_t* reactor, int fd, void* context,
   object->context = context;
   object->read_ready = read_ready;
   object->write_ready = write_ready;
+  object->read_batch = 1;
   object->mutex = new std::mutex;
 
   struct epoll_event event;
@@ -194,6 +200,16 @@ bool reactor_change_registration(reactor_object_t* object,
   return true;
 }
 
+void reactor_set_read_batch(reactor_object_t* object,
+                            bool (*read_pending)(void* context),
+                            size_t max_batch) {
+  CHECK(object != NULL);
+
+  std::lock_guard<std::mutex> lock(*object->mutex);
+  object->read_pending = read_pending;
+  object->read_batch = (read_pending && max_batch > 1) ? max_batch : 1;
+}
+
 void reactor_unregister(reactor_object_t* obj) {
   CHECK(obj != NULL);
 
@@ -278,8 +294,19 @@ static reactor_status_t run_reactor(reactor_t* reactor, int iterations) {
 
         reactor->object_removed = false;
         if (events[j].events & (EPOLLIN | EPOLLHUP | EPOLLRDHUP | EPOLLERR) &&
-            object->read_ready)
+            object->read_ready) {
           object->read_ready(object->context);
+
+          // In batched mode, keep serving input that is already available
+          // for as long as the object isn't unregistered in the meantime.
+          for (size_t n = 1; n < object->read_batch; ++n) {
+            if (reactor->object_removed ||
+                !object->read_pending(object->context) ||
+                object_invalidated(reactor, object))
+              break;
+            object->read_ready(object->context);
+          }
+        }
         if (!reactor->object_removed && events[j].events & EPOLLOUT &&
             object->write_ready)
           object->write_ready(object->context);
@@ -295,3 +322,11 @@ static reactor_status_t run_reactor(reactor_t* reactor, int iterations) {
   reactor->is_running = false;
   return REACTOR_STATUS_DONE;
 }
+
+// Returns true if |object| got unregistered from a thread other than the
+// reactor thread since the current batch of events was fetched.
+// |reactor| may not be NULL.
+static bool object_invalidated(reactor_t* reactor, reactor_object_t* object) {
+  std::lock_guard<std::mutex> lock(*reactor->list_mutex);
+  return list_contains(reactor->invalidation_list, object);
+}
@@ -18,6 +18,8 @@
 
 #include <base/logging.h>
 #include <stdlib.h>
+#include <string.h>
+#include <algorithm>
 
 #include "osi/include/allocator.h"
 #include "osi/include/ringbuffer.h"
@@ -62,10 +64,13 @@ size_t ringbuffer_insert(ringbuffer_t* rb, const uint8_t* p, size_t length) {
 
   if (length > ringbuffer_available(rb)) length = ringbuffer_available(rb);
 
-  for (size_t i = 0; i != length; ++i) {
-    *rb->tail++ = *p++;
-    if (rb->tail >= (rb->base + rb->total)) rb->tail = rb->base;
-  }
+  // Up to the end of the buffer, then the rest from its start
+  const size_t first =
+      std::min(length, (size_t)(rb->base + rb->total - rb->tail));
+  memcpy(rb->tail, p, first);
+  memcpy(rb->base, p + first, length - first);
+  rb->tail += length;
+  if (rb->tail >= (rb->base + rb->total)) rb->tail -= rb->total;
 
   rb->available -= length;
   return length;
@@ -95,10 +100,10 @@ size_t ringbuffer_peek(const ringbuffer_t* rb, off_t offset, uint8_t* p,
                                    ? ringbuffer_size(rb) - offset
                                    : length;
 
-  for (size_t copied = 0; copied < bytes_to_copy; ++copied) {
-    *p++ = *b++;
-    if (b >= (rb->base + rb->total)) b = rb->base;
-  }
+  const size_t first =
+      std::min(bytes_to_copy, (size_t)(rb->base + rb->total - b));
+  memcpy(p, b, first);
+  memcpy(p + first, rb->base, bytes_to_copy - first);
 
   return bytes_to_copy;
 }
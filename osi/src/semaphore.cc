@@ -24,6 +24,7 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <malloc.h>
+#include <poll.h>
 #include <string.h>
 #include <sys/eventfd.h>
 #include <unistd.h>
@@ -36,13 +37,19 @@
 #define EFD_SEMAPHORE (1 << 0)
 #endif
 
+#if !defined(EFD_NONBLOCK)
+#define EFD_NONBLOCK O_NONBLOCK
+#endif
+
+// The eventfd is non-blocking so that |semaphore_try_wait| is a single read.
+// |semaphore_wait| polls for the fd to become readable instead.
 struct semaphore_t {
   int fd;
 };
 
 semaphore_t* semaphore_new(unsigned int value) {
   semaphore_t* ret = static_cast<semaphore_t*>(osi_malloc(sizeof(semaphore_t)));
-  ret->fd = eventfd(value, EFD_SEMAPHORE);
+  ret->fd = eventfd(value, EFD_SEMAPHORE | EFD_NONBLOCK);
   if (ret->fd == INVALID_FD) {
     LOG_ERROR(LOG_TAG, "%s unable to allocate semaphore: %s", __func__,
               strerror(errno));
@@ -64,35 +71,30 @@ void semaphore_wait(semaphore_t* semaphore) {
   CHECK(semaphore->fd != INVALID_FD);
 
   eventfd_t value;
-  if (eventfd_read(semaphore->fd, &value) == -1)
-    LOG_ERROR(LOG_TAG, "%s unable to wait on semaphore: %s", __func__,
-              strerror(errno));
+  while (eventfd_read(semaphore->fd, &value) == -1) {
+    if (errno != EAGAIN) {
+      LOG_ERROR(LOG_TAG, "%s unable to wait on semaphore: %s", __func__,
+                strerror(errno));
+      return;
+    }
+
+    struct pollfd pfd = {semaphore->fd, POLLIN, 0};
+    int ret;
+    OSI_NO_INTR(ret = poll(&pfd, 1, -1));
+    if (ret == -1) {
+      LOG_ERROR(LOG_TAG, "%s unable to poll semaphore: %s", __func__,
+                strerror(errno));
+      return;
+    }
+  }
 }
 
 bool semaphore_try_wait(semaphore_t* semaphore) {
   CHECK(semaphore != NULL);
   CHECK(semaphore->fd != INVALID_FD);
 
-  int flags = fcntl(semaphore->fd, F_GETFL);
-  if (flags == -1) {
-    LOG_ERROR(LOG_TAG, "%s unable to get flags for semaphore fd: %s", __func__,
-              strerror(errno));
-    return false;
-  }
-  if (fcntl(semaphore->fd, F_SETFL, flags | O_NONBLOCK) == -1) {
-    LOG_ERROR(LOG_TAG, "%s unable to set O_NONBLOCK for semaphore fd: %s",
-              __func__, strerror(errno));
-    return false;
-  }
-
-  bool rc = true;
   eventfd_t value;
-  if (eventfd_read(semaphore->fd, &value) == -1) rc = false;
-
-  if (fcntl(semaphore->fd, F_SETFL, flags) == -1)
-    LOG_ERROR(LOG_TAG, "%s unable to restore flags for semaphore fd: %s",
-              __func__, strerror(errno));
-  return rc;
+  return eventfd_read(semaphore->fd, &value) != -1;
 }
 
 void semaphore_post(semaphore_t* semaphore) {
@@ -104,6 +106,16 @@ void semaphore_post(semaphore_t* semaphore) {
               strerror(errno));
 }
 
+void semaphore_post_count(semaphore_t* semaphore, unsigned int count) {
+  CHECK(semaphore != NULL);
+  CHECK(semaphore->fd != INVALID_FD);
+
+  if (count == 0) return;
+  if (eventfd_write(semaphore->fd, count) == -1)
+    LOG_ERROR(LOG_TAG, "%s unable to post to semaphore: %s", __func__,
+              strerror(errno));
+}
+
 int semaphore_get_fd(const semaphore_t* semaphore) {
   CHECK(semaphore != NULL);
   CHECK(semaphore->fd != INVALID_FD);
@@ -0,0 +1,396 @@
+/******************************************************************************
+ *
+ *  Copyright 2020 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#define LOG_TAG "bt_osi_shm_ring"
+
+#include <base/logging.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <linux/memfd.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+
+#include "osi/include/allocator.h"
+#include "osi/include/log.h"
+#include "osi/include/osi.h"
+#include "osi/include/shm_ring.h"
+
+// "SHMR"
+#define SHM_RING_MAGIC 0x524d4853
+// Bumped whenever the layout of the shared header changes
+#define SHM_RING_VERSION 1
+#define SHM_RING_MAX_CAPACITY (1U << 30)
+#define SHM_RING_SEALS (F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL)
+
+#define NS_PER_MS 1000000LL
+#define NS_PER_SEC 1000000000LL
+
+// Shared by both processes. Each side only moves its own position. The
+// positions are free running; the data is |size| bytes, a power of two, of
+// which at most |capacity| are used.
+//
+// A side that has to wait reads its wake-up counter, raises its waiting flag,
+// checks the peer position once more and sleeps on the counter. After moving
+// its position, the peer clears the flag and bumps the counter, so a wake-up
+// can't be lost between the check and the sleep.
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t capacity;
+  uint32_t size;
+  std::atomic<uint32_t> closed;
+  std::atomic<uint32_t> attached;
+
+  // Touched by the writer on every write, by the reader only to wait
+  alignas(64) std::atomic<uint32_t> write_pos;
+  std::atomic<uint32_t> reader_waiting;
+  std::atomic<uint32_t> reader_wake;
+
+  // Touched by the reader on every read, by the writer only to wait
+  alignas(64) std::atomic<uint32_t> read_pos;
+  std::atomic<uint32_t> writer_waiting;
+  std::atomic<uint32_t> writer_wake;
+} shm_ring_header_t;
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free,
+              "futex words must be plain 32-bit integers");
+static_assert(sizeof(shm_ring_header_t) % 64 == 0,
+              "data must start on its own cache line");
+
+struct shm_ring_t {
+  shm_ring_header_t* header;
+  uint8_t* data;
+  size_t map_size;
+  // Copies of the header fields validated when the ring was mapped, so that
+  // the peer can't change them afterwards
+  uint32_t capacity;
+  uint32_t mask;
+  int fd;
+};
+
+static shm_ring_t* shm_ring_map(int fd, size_t map_size) {
+  void* map =
+      mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (map == MAP_FAILED) {
+    LOG_ERROR(LOG_TAG, "%s unable to map ring: %s", __func__,
+              strerror(errno));
+    return NULL;
+  }
+
+  shm_ring_t* ring = static_cast<shm_ring_t*>(osi_calloc(sizeof(shm_ring_t)));
+  ring->header = static_cast<shm_ring_header_t*>(map);
+  ring->data = static_cast<uint8_t*>(map) + sizeof(shm_ring_header_t);
+  ring->map_size = map_size;
+  ring->fd = INVALID_FD;
+  return ring;
+}
+
+shm_ring_t* shm_ring_new(size_t capacity) {
+  CHECK(capacity > 0);
+
+  if (capacity > SHM_RING_MAX_CAPACITY) {
+    LOG_ERROR(LOG_TAG, "%s capacity too large: %zu", __func__, capacity);
+    return NULL;
+  }
+  uint32_t size = 1;
+  while (size < capacity) size <<= 1;
+  size_t map_size = sizeof(shm_ring_header_t) + size;
+
+  int fd = syscall(__NR_memfd_create, "bt_shm_ring",
+                   MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  if (fd == INVALID_FD) {
+    LOG_ERROR(LOG_TAG, "%s unable to create shared memory: %s", __func__,
+              strerror(errno));
+    return NULL;
+  }
+  if (ftruncate(fd, map_size) != 0 || fcntl(fd, F_ADD_SEALS, SHM_RING_SEALS)) {
+    LOG_ERROR(LOG_TAG, "%s unable to size shared memory: %s", __func__,
+              strerror(errno));
+    close(fd);
+    return NULL;
+  }
+
+  shm_ring_t* ring = shm_ring_map(fd, map_size);
+  if (!ring) {
+    close(fd);
+    return NULL;
+  }
+  // The file is zero filled: positions, flags and counters start at zero
+  ring->header->magic = SHM_RING_MAGIC;
+  ring->header->version = SHM_RING_VERSION;
+  ring->header->capacity = capacity;
+  ring->header->size = size;
+  ring->capacity = capacity;
+  ring->mask = size - 1;
+  ring->fd = fd;
+  return ring;
+}
+
+shm_ring_t* shm_ring_attach(int fd) {
+  struct stat st;
+  if (fstat(fd, &st) != 0 ||
+      static_cast<size_t>(st.st_size) <= sizeof(shm_ring_header_t)) {
+    LOG_ERROR(LOG_TAG, "%s not a ring: fd %d", __func__, fd);
+    return NULL;
+  }
+  // Without the seals the creator could shrink the file under our mapping
+  int seals = fcntl(fd, F_GET_SEALS);
+  if (seals == -1 || (seals & SHM_RING_SEALS) != SHM_RING_SEALS) {
+    LOG_ERROR(LOG_TAG, "%s ring is not sealed: fd %d", __func__, fd);
+    return NULL;
+  }
+
+  size_t map_size = st.st_size;
+  shm_ring_t* ring = shm_ring_map(fd, map_size);
+  if (!ring) return NULL;
+
+  const shm_ring_header_t* header = ring->header;
+  uint32_t size = header->size;
+  uint32_t capacity = header->capacity;
+  if (header->magic != SHM_RING_MAGIC || header->version != SHM_RING_VERSION ||
+      size == 0 || (size & (size - 1)) != 0 || capacity == 0 ||
+      capacity > size || map_size != sizeof(shm_ring_header_t) + size) {
+    LOG_ERROR(LOG_TAG, "%s invalid ring header: fd %d", __func__, fd);
+    shm_ring_free(ring);
+    return NULL;
+  }
+  ring->capacity = capacity;
+  ring->mask = size - 1;
+  ring->header->attached.store(1);
+  return ring;
+}
+
+void shm_ring_free(shm_ring_t* ring) {
+  if (!ring) return;
+
+  munmap(ring->header, ring->map_size);
+  if (ring->fd != INVALID_FD) close(ring->fd);
+  osi_free(ring);
+}
+
+int shm_ring_get_fd(const shm_ring_t* ring) {
+  CHECK(ring != NULL);
+  return ring->fd;
+}
+
+size_t shm_ring_capacity(const shm_ring_t* ring) {
+  CHECK(ring != NULL);
+  return ring->capacity;
+}
+
+// Returns the number of bytes in the ring, or -1 if the positions published
+// by the peer are inconsistent.
+static int64_t shm_ring_used(const shm_ring_t* ring, uint32_t write_pos,
+                             uint32_t read_pos) {
+  uint32_t used = write_pos - read_pos;
+  if (used > ring->capacity) {
+    LOG_ERROR(LOG_TAG, "%s corrupted ring: write %u read %u", __func__,
+              write_pos, read_pos);
+    return -1;
+  }
+  return used;
+}
+
+size_t shm_ring_bytes_available(const shm_ring_t* ring) {
+  CHECK(ring != NULL);
+
+  int64_t used = shm_ring_used(ring, ring->header->write_pos.load(),
+                               ring->header->read_pos.load());
+  return used < 0 ? 0 : used;
+}
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * NS_PER_SEC + ts.tv_nsec;
+}
+
+static void shm_ring_wake(std::atomic<uint32_t>* wake) {
+  wake->fetch_add(1);
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(wake), FUTEX_WAKE, INT_MAX,
+          NULL, NULL, 0);
+}
+
+// Sleeps until |peer_pos| moves away from |seen_pos|, the ring is closed or
+// |deadline_ns| is reached. Returns false on timeout.
+static bool shm_ring_wait(shm_ring_t* ring, std::atomic<uint32_t>* peer_pos,
+                          uint32_t seen_pos, std::atomic<uint32_t>* waiting,
+                          std::atomic<uint32_t>* wake, uint64_t deadline_ns) {
+  uint32_t seq = wake->load();
+  waiting->store(1);
+  if (peer_pos->load() != seen_pos || ring->header->closed.load()) {
+    waiting->store(0);
+    return true;
+  }
+
+  uint64_t now = now_ns();
+  if (now >= deadline_ns) {
+    waiting->store(0);
+    return false;
+  }
+  uint64_t remaining = deadline_ns - now;
+  struct timespec timeout;
+  timeout.tv_sec = remaining / NS_PER_SEC;
+  timeout.tv_nsec = remaining % NS_PER_SEC;
+
+  // Returns early with EAGAIN when the counter already moved, or EINTR
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(wake), FUTEX_WAIT, seq,
+          &timeout, NULL, 0);
+  waiting->store(0);
+  return true;
+}
+
+ssize_t shm_ring_write(shm_ring_t* ring, const void* buf, size_t len,
+                       int timeout_ms) {
+  CHECK(ring != NULL);
+  CHECK(buf != NULL);
+
+  shm_ring_header_t* header = ring->header;
+  const uint8_t* src = static_cast<const uint8_t*>(buf);
+  uint64_t deadline_ns = 0;
+  size_t written = 0;
+
+  while (written < len) {
+    if (header->closed.load()) {
+      if (written) break;
+      errno = EPIPE;
+      return -1;
+    }
+
+    uint32_t write_pos = header->write_pos.load(std::memory_order_relaxed);
+    uint32_t read_pos = header->read_pos.load(std::memory_order_acquire);
+    int64_t used = shm_ring_used(ring, write_pos, read_pos);
+    if (used < 0) {
+      if (written) break;
+      errno = EPROTO;
+      return -1;
+    }
+
+    size_t room = ring->capacity - used;
+    if (room == 0) {
+      if (timeout_ms <= 0) break;
+      if (!deadline_ns) deadline_ns = now_ns() + timeout_ms * NS_PER_MS;
+      if (!shm_ring_wait(ring, &header->read_pos, read_pos,
+                         &header->writer_waiting, &header->writer_wake,
+                         deadline_ns))
+        break;
+      continue;
+    }
+
+    size_t n = std::min(room, len - written);
+    size_t offset = write_pos & ring->mask;
+    size_t first = std::min(n, ring->mask + 1 - offset);
+    memcpy(ring->data + offset, src + written, first);
+    memcpy(ring->data, src + written + first, n - first);
+    header->write_pos.store(write_pos + n);
+    written += n;
+
+    if (header->reader_waiting.exchange(0)) shm_ring_wake(&header->reader_wake);
+  }
+
+  return written;
+}
+
+ssize_t shm_ring_read(shm_ring_t* ring, void* buf, size_t len,
+                      int timeout_ms) {
+  CHECK(ring != NULL);
+  CHECK(buf != NULL);
+
+  shm_ring_header_t* header = ring->header;
+  uint8_t* dst = static_cast<uint8_t*>(buf);
+  uint64_t deadline_ns = 0;
+  size_t read = 0;
+
+  while (read < len) {
+    uint32_t read_pos = header->read_pos.load(std::memory_order_relaxed);
+    uint32_t write_pos = header->write_pos.load(std::memory_order_acquire);
+    int64_t used = shm_ring_used(ring, write_pos, read_pos);
+    if (used < 0) {
+      if (read) break;
+      errno = EPROTO;
+      return -1;
+    }
+
+    if (used == 0) {
+      if (header->closed.load()) {
+        // Anything written before the close was published with it
+        if (header->write_pos.load() != write_pos) continue;
+        if (read) break;
+        errno = EPIPE;
+        return -1;
+      }
+      if (timeout_ms <= 0) break;
+      if (!deadline_ns) deadline_ns = now_ns() + timeout_ms * NS_PER_MS;
+      if (!shm_ring_wait(ring, &header->write_pos, write_pos,
+                         &header->reader_waiting, &header->reader_wake,
+                         deadline_ns))
+        break;
+      continue;
+    }
+
+    size_t n = std::min(static_cast<size_t>(used), len - read);
+    size_t offset = read_pos & ring->mask;
+    size_t first = std::min(n, ring->mask + 1 - offset);
+    memcpy(dst + read, ring->data + offset, first);
+    memcpy(dst + read + first, ring->data, n - first);
+    header->read_pos.store(read_pos + n);
+    read += n;
+
+    if (header->writer_waiting.exchange(0)) shm_ring_wake(&header->writer_wake);
+  }
+
+  return read;
+}
+
+void shm_ring_flush(shm_ring_t* ring) {
+  CHECK(ring != NULL);
+
+  shm_ring_header_t* header = ring->header;
+  uint32_t read_pos = header->read_pos.load(std::memory_order_relaxed);
+  uint32_t write_pos = header->write_pos.load(std::memory_order_acquire);
+  if (shm_ring_used(ring, write_pos, read_pos) <= 0) return;
+
+  header->read_pos.store(write_pos);
+  if (header->writer_waiting.exchange(0)) shm_ring_wake(&header->writer_wake);
+}
+
+void shm_ring_close(shm_ring_t* ring) {
+  CHECK(ring != NULL);
+
+  ring->header->closed.store(1);
+  shm_ring_wake(&ring->header->reader_wake);
+  shm_ring_wake(&ring->header->writer_wake);
+}
+
+bool shm_ring_is_closed(const shm_ring_t* ring) {
+  CHECK(ring != NULL);
+  return ring->header->closed.load();
+}
+
+bool shm_ring_is_attached(const shm_ring_t* ring) {
+  CHECK(ring != NULL);
+  return ring->header->attached.load();
+}
@@ -0,0 +1,156 @@
+/******************************************************************************
+ *
+ *  Copyright 2020 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <base/logging.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+
+#include "osi/include/allocator.h"
+#include "osi/include/spsc_ringbuffer.h"
+
+#define SPSC_RINGBUFFER_MAX_SIZE ((size_t)1 << 30)
+
+// The positions are free running; the data is |size| bytes, a power of two,
+// of which at most |capacity| are used. Each side reads the position of the
+// other side with acquire, and publishes its own with release once it is
+// done with the data, so the bytes are visible before the position that
+// covers them.
+struct spsc_ringbuffer_t {
+  uint8_t* data;
+  size_t capacity;
+  size_t mask;
+
+  // Written by the producer only
+  alignas(64) std::atomic<size_t> write_pos;
+
+  // Written by the consumer only
+  alignas(64) std::atomic<size_t> read_pos;
+};
+
+spsc_ringbuffer_t* spsc_ringbuffer_init(size_t size) {
+  if (size == 0 || size > SPSC_RINGBUFFER_MAX_SIZE) return NULL;
+
+  size_t data_size = 1;
+  while (data_size < size) data_size <<= 1;
+
+  spsc_ringbuffer_t* rb =
+      static_cast<spsc_ringbuffer_t*>(osi_calloc(sizeof(spsc_ringbuffer_t)));
+  rb->data = static_cast<uint8_t*>(osi_malloc(data_size));
+  rb->capacity = size;
+  rb->mask = data_size - 1;
+  rb->write_pos.store(0, std::memory_order_relaxed);
+  rb->read_pos.store(0, std::memory_order_relaxed);
+  return rb;
+}
+
+void spsc_ringbuffer_free(spsc_ringbuffer_t* rb) {
+  if (rb != NULL) osi_free(rb->data);
+  osi_free(rb);
+}
+
+size_t spsc_ringbuffer_available(const spsc_ringbuffer_t* rb) {
+  CHECK(rb);
+  return rb->capacity - (rb->write_pos.load(std::memory_order_relaxed) -
+                         rb->read_pos.load(std::memory_order_acquire));
+}
+
+size_t spsc_ringbuffer_size(const spsc_ringbuffer_t* rb) {
+  CHECK(rb);
+  return rb->write_pos.load(std::memory_order_acquire) -
+         rb->read_pos.load(std::memory_order_relaxed);
+}
+
+size_t spsc_ringbuffer_write_reserve(spsc_ringbuffer_t* rb, uint8_t** p) {
+  CHECK(rb);
+  CHECK(p);
+
+  size_t write_pos = rb->write_pos.load(std::memory_order_relaxed);
+  size_t offset = write_pos & rb->mask;
+  *p = rb->data + offset;
+  return std::min(spsc_ringbuffer_available(rb), rb->mask + 1 - offset);
+}
+
+void spsc_ringbuffer_write_commit(spsc_ringbuffer_t* rb, size_t length) {
+  CHECK(rb);
+  CHECK(length <= spsc_ringbuffer_available(rb));
+
+  rb->write_pos.store(rb->write_pos.load(std::memory_order_relaxed) + length,
+                      std::memory_order_release);
+}
+
+size_t spsc_ringbuffer_insert(spsc_ringbuffer_t* rb, const uint8_t* p,
+                              size_t length) {
+  CHECK(rb);
+  CHECK(p);
+
+  size_t write_pos = rb->write_pos.load(std::memory_order_relaxed);
+  length = std::min(length, spsc_ringbuffer_available(rb));
+
+  // Up to the end of the data, then the rest from its start
+  size_t offset = write_pos & rb->mask;
+  size_t first = std::min(length, rb->mask + 1 - offset);
+  memcpy(rb->data + offset, p, first);
+  memcpy(rb->data, p + first, length - first);
+
+  rb->write_pos.store(write_pos + length, std::memory_order_release);
+  return length;
+}
+
+size_t spsc_ringbuffer_read_peek(spsc_ringbuffer_t* rb, const uint8_t** p) {
+  CHECK(rb);
+  CHECK(p);
+
+  size_t read_pos = rb->read_pos.load(std::memory_order_relaxed);
+  size_t offset = read_pos & rb->mask;
+  *p = rb->data + offset;
+  return std::min(spsc_ringbuffer_size(rb), rb->mask + 1 - offset);
+}
+
+void spsc_ringbuffer_read_commit(spsc_ringbuffer_t* rb, size_t length) {
+  CHECK(rb);
+  CHECK(length <= spsc_ringbuffer_size(rb));
+
+  rb->read_pos.store(rb->read_pos.load(std::memory_order_relaxed) + length,
+                     std::memory_order_release);
+}
+
+size_t spsc_ringbuffer_pop(spsc_ringbuffer_t* rb, uint8_t* p, size_t length) {
+  CHECK(rb);
+  CHECK(p);
+
+  size_t read_pos = rb->read_pos.load(std::memory_order_relaxed);
+  length = std::min(length, spsc_ringbuffer_size(rb));
+
+  size_t offset = read_pos & rb->mask;
+  size_t first = std::min(length, rb->mask + 1 - offset);
+  memcpy(p, rb->data + offset, first);
+  memcpy(p + first, rb->data, length - first);
+
+  rb->read_pos.store(read_pos + length, std::memory_order_release);
+  return length;
+}
+
+size_t spsc_ringbuffer_delete(spsc_ringbuffer_t* rb, size_t length) {
+  CHECK(rb);
+
+  length = std::min(length, spsc_ringbuffer_size(rb));
+  rb->read_pos.store(rb->read_pos.load(std::memory_order_relaxed) + length,
+                     std::memory_order_release);
+  return length;
+}
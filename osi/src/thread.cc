@@ -20,7 +20,9 @@
 
 #include "osi/include/thread.h"
 
+#include <algorithm>
 #include <atomic>
+#include <mutex>
 
 #include <base/logging.h>
 #include <errno.h>
@@ -39,6 +41,12 @@
 #include "osi/include/reactor.h"
 #include "osi/include/semaphore.h"
 
+typedef struct work_item_t {
+  thread_fn func;
+  void* context;
+  struct work_item_t* next;
+} work_item_t;
+
 struct thread_t {
   std::atomic_bool is_joined{false};
   pthread_t pthread;
@@ -46,6 +54,13 @@ struct thread_t {
   char name[THREAD_NAME_MAX + 1];
   reactor_t* reactor;
   fixed_queue_t* work_queue;
+  // Work items are taken from a slab sized after the work queue, which holds
+  // all of them unless posters are blocked on a full queue; the rest come
+  // from the heap.
+  std::mutex* work_pool_mutex;
+  work_item_t* work_pool;
+  size_t work_pool_size;
+  work_item_t* free_work_items;
 };
 
 struct start_arg {
@@ -54,16 +69,26 @@ struct start_arg {
   int error;
 };
 
-typedef struct {
-  thread_fn func;
-  void* context;
-} work_item_t;
-
 static void* run_thread(void* start_arg);
+static void work_pool_init(thread_t* thread, size_t work_queue_capacity);
+static void work_pool_free(thread_t* thread);
+static work_item_t* work_item_new(thread_t* thread, thread_fn func,
+                                  void* context);
+static void work_item_free(thread_t* thread, work_item_t* item);
+static void work_queue_flush(thread_t* thread);
 static void work_queue_read_cb(void* context);
+static bool work_queue_pending(void* context);
 
 static const size_t DEFAULT_WORK_QUEUE_CAPACITY = 128;
 
+// Max number of work items run per reactor wakeup before the other objects
+// registered with the thread's reactor get a turn.
+static const size_t WORK_QUEUE_BATCH_SIZE = 16;
+
+// Max number of work items in the slab of a thread, for the threads with a
+// very large work queue.
+static const size_t WORK_POOL_MAX_SIZE = 256;
+
 thread_t* thread_new_sized(const char* name, size_t work_queue_capacity) {
   CHECK(name != NULL);
   CHECK(work_queue_capacity != 0);
@@ -76,6 +101,8 @@ thread_t* thread_new_sized(const char* name, size_t work_queue_capacity) {
   ret->work_queue = fixed_queue_new(work_queue_capacity);
   if (!ret->work_queue) goto error;
 
+  work_pool_init(ret, work_queue_capacity);
+
   // Start is on the stack, but we use a semaphore, so it's safe
   struct start_arg start;
   start.start_sem = semaphore_new(0);
@@ -94,7 +121,8 @@ thread_t* thread_new_sized(const char* name, size_t work_queue_capacity) {
 
 error:;
   if (ret) {
-    fixed_queue_free(ret->work_queue, osi_free);
+    fixed_queue_free(ret->work_queue, NULL);
+    work_pool_free(ret);
     reactor_free(ret->reactor);
   }
   osi_free(ret);
@@ -111,7 +139,9 @@ void thread_free(thread_t* thread) {
   thread_stop(thread);
   thread_join(thread);
 
-  fixed_queue_free(thread->work_queue, osi_free);
+  work_queue_flush(thread);
+  fixed_queue_free(thread->work_queue, NULL);
+  work_pool_free(thread);
   reactor_free(thread->reactor);
   osi_free(thread);
 }
@@ -133,13 +163,33 @@ bool thread_post(thread_t* thread, thread_fn func, void* context) {
 
   // Queue item is freed either when the queue itself is destroyed
   // or when the item is removed from the queue for dispatch.
-  work_item_t* item = (work_item_t*)osi_malloc(sizeof(work_item_t));
-  item->func = func;
-  item->context = context;
+  work_item_t* item = work_item_new(thread, func, context);
   fixed_queue_enqueue(thread->work_queue, item);
   return true;
 }
 
+bool thread_post_batch(thread_t* thread, thread_fn func, void* const* contexts,
+                       size_t count) {
+  CHECK(thread != NULL);
+  CHECK(func != NULL);
+  CHECK(contexts != NULL || count == 0);
+
+  if (count == 0) return true;
+
+  // Items are handed over a queue capacity at most at a time, so that a long
+  // batch does not drain the slab.
+  size_t chunk = std::min(count, thread->work_pool_size);
+  void** items = static_cast<void**>(osi_malloc(chunk * sizeof(void*)));
+  for (size_t done = 0; done < count; done += chunk) {
+    size_t n = std::min(chunk, count - done);
+    for (size_t i = 0; i < n; i++)
+      items[i] = work_item_new(thread, func, contexts[done + i]);
+    fixed_queue_enqueue_batch(thread->work_queue, items, n);
+  }
+  osi_free(items);
+  return true;
+}
+
 void thread_stop(thread_t* thread) {
   CHECK(thread != NULL);
   reactor_stop(thread->reactor);
@@ -214,10 +264,12 @@ static void* run_thread(void* start_arg) {
   semaphore_post(start->start_sem);
 
   int fd = fixed_queue_get_dequeue_fd(thread->work_queue);
-  void* context = thread->work_queue;
+  void* context = thread;
 
   reactor_object_t* work_queue_object =
       reactor_register(thread->reactor, fd, context, work_queue_read_cb, NULL);
+  reactor_set_read_batch(work_queue_object, work_queue_pending,
+                         WORK_QUEUE_BATCH_SIZE);
   reactor_start(thread->reactor);
   reactor_unregister(work_queue_object);
 
@@ -229,7 +281,7 @@ static void* run_thread(void* start_arg) {
       static_cast<work_item_t*>(fixed_queue_try_dequeue(thread->work_queue));
   while (item && count <= fixed_queue_capacity(thread->work_queue)) {
     item->func(item->context);
-    osi_free(item);
+    work_item_free(thread, item);
     item =
         static_cast<work_item_t*>(fixed_queue_try_dequeue(thread->work_queue));
     ++count;
@@ -246,8 +298,75 @@ static void* run_thread(void* start_arg) {
 static void work_queue_read_cb(void* context) {
   CHECK(context != NULL);
 
-  fixed_queue_t* queue = (fixed_queue_t*)context;
-  work_item_t* item = static_cast<work_item_t*>(fixed_queue_dequeue(queue));
+  thread_t* thread = (thread_t*)context;
+  work_item_t* item =
+      static_cast<work_item_t*>(fixed_queue_dequeue(thread->work_queue));
   item->func(item->context);
-  osi_free(item);
+  work_item_free(thread, item);
+}
+
+static bool work_queue_pending(void* context) {
+  CHECK(context != NULL);
+
+  return !fixed_queue_is_empty(((thread_t*)context)->work_queue);
+}
+
+static void work_pool_init(thread_t* thread, size_t work_queue_capacity) {
+  // One more than the queue holds, for the item being run
+  size_t size = std::min(work_queue_capacity, WORK_POOL_MAX_SIZE - 1) + 1;
+
+  thread->work_pool_mutex = new std::mutex;
+  thread->work_pool =
+      static_cast<work_item_t*>(osi_calloc(size * sizeof(work_item_t)));
+  thread->work_pool_size = size;
+  thread->free_work_items = NULL;
+  for (size_t i = size; i > 0; i--) {
+    thread->work_pool[i - 1].next = thread->free_work_items;
+    thread->free_work_items = &thread->work_pool[i - 1];
+  }
+}
+
+static void work_pool_free(thread_t* thread) {
+  delete thread->work_pool_mutex;
+  thread->work_pool_mutex = NULL;
+  osi_free(thread->work_pool);
+  thread->work_pool = NULL;
+  thread->free_work_items = NULL;
+}
+
+static work_item_t* work_item_new(thread_t* thread, thread_fn func,
+                                  void* context) {
+  work_item_t* item;
+  {
+    std::lock_guard<std::mutex> lock(*thread->work_pool_mutex);
+    item = thread->free_work_items;
+    if (item) thread->free_work_items = item->next;
+  }
+  if (!item) item = static_cast<work_item_t*>(osi_malloc(sizeof(work_item_t)));
+
+  item->func = func;
+  item->context = context;
+  item->next = NULL;
+  return item;
+}
+
+static void work_item_free(thread_t* thread, work_item_t* item) {
+  if (item < thread->work_pool ||
+      item >= thread->work_pool + thread->work_pool_size) {
+    osi_free(item);
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(*thread->work_pool_mutex);
+  item->next = thread->free_work_items;
+  thread->free_work_items = item;
+}
+
+// Releases the items left in the work queue of a joined thread, without
+// running them.
+static void work_queue_flush(thread_t* thread) {
+  work_item_t* item;
+  while ((item = static_cast<work_item_t*>(
+              fixed_queue_try_dequeue(thread->work_queue))) != NULL)
+    work_item_free(thread, item);
 }
@@ -0,0 +1,368 @@
+/******************************************************************************
+ *
+ *  Copyright 2020 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <base/logging.h>
+#include <stdlib.h>
+
+#include "osi/include/allocator.h"
+#include "osi/include/timer_wheel.h"
+
+// Level L has 64 slots of 64^L ms each. An entry is placed on the lowest
+// level whose span covers its distance from the current tick, in the slot
+// selected by the matching bits of its absolute deadline. A slot of level
+// L > 0 is cascaded, i.e. its entries are placed again, once the current
+// tick reaches the start of that slot; a slot of level 0 holds entries that
+// all share the same deadline. Seven levels cover 2^42 ms, farther deadlines
+// are parked on the last slot of the top level and placed again when it is
+// cascaded.
+#define LEVEL_BITS 6
+#define SLOTS_PER_LEVEL (1 << LEVEL_BITS)
+#define SLOT_MASK (SLOTS_PER_LEVEL - 1)
+#define NUM_LEVELS 7
+#define WHEEL_SPAN_MS (1ULL << (LEVEL_BITS * NUM_LEVELS))
+
+// Pseudo levels of entries that are not on a wheel slot
+#define LEVEL_DUE NUM_LEVELS
+#define LEVEL_EXPIRING (NUM_LEVELS + 1)
+
+typedef struct {
+  timer_wheel_entry_t* head;
+  timer_wheel_entry_t* tail;
+} slot_t;
+
+struct timer_wheel_t {
+  // Next tick to be processed. All entries due before it have expired or are
+  // on |due|.
+  uint64_t time_ms;
+  uint64_t next_sequence;
+  size_t length;
+  // Entries added with a deadline before |time_ms|, sorted by deadline
+  slot_t due;
+  // Entries removed by the |timer_wheel_expire| call in progress
+  slot_t expiring;
+  slot_t slots[NUM_LEVELS][SLOTS_PER_LEVEL];
+  // Bit N of |occupied[L]| is set when slots[L][N] is not empty
+  uint64_t occupied[NUM_LEVELS];
+};
+
+static slot_t* slot_of(timer_wheel_t* wheel, const timer_wheel_entry_t* entry);
+static void slot_insert_after(slot_t* slot, timer_wheel_entry_t* prev,
+                              timer_wheel_entry_t* entry);
+static void slot_unlink(slot_t* slot, timer_wheel_entry_t* entry);
+static void place(timer_wheel_t* wheel, timer_wheel_entry_t* entry);
+static void unlink_entry(timer_wheel_t* wheel, timer_wheel_entry_t* entry);
+static void cascade(timer_wheel_t* wheel, uint64_t tick);
+static uint64_t next_tick(const timer_wheel_t* wheel, int level);
+
+timer_wheel_t* timer_wheel_new(void) {
+  return static_cast<timer_wheel_t*>(osi_calloc(sizeof(timer_wheel_t)));
+}
+
+void timer_wheel_free(timer_wheel_t* wheel) {
+  if (!wheel) return;
+
+  // Leave no entry pointing into freed memory
+  const slot_t* lists[] = {&wheel->due, &wheel->expiring};
+  for (const slot_t* list : lists) {
+    for (timer_wheel_entry_t* entry = list->head; entry; entry = entry->next)
+      entry->pending = false;
+  }
+  for (int level = 0; level < NUM_LEVELS; level++) {
+    for (int slot = 0; slot < SLOTS_PER_LEVEL; slot++) {
+      for (timer_wheel_entry_t* entry = wheel->slots[level][slot].head; entry;
+           entry = entry->next)
+        entry->pending = false;
+    }
+  }
+  osi_free(wheel);
+}
+
+size_t timer_wheel_length(const timer_wheel_t* wheel) {
+  CHECK(wheel != NULL);
+  return wheel->length;
+}
+
+bool timer_wheel_is_empty(const timer_wheel_t* wheel) {
+  CHECK(wheel != NULL);
+  return wheel->length == 0;
+}
+
+void timer_wheel_add(timer_wheel_t* wheel, timer_wheel_entry_t* entry,
+                     uint64_t deadline_ms, void* data) {
+  CHECK(wheel != NULL);
+  CHECK(entry != NULL);
+
+  if (entry->pending) {
+    unlink_entry(wheel, entry);
+    wheel->length--;
+  }
+
+  entry->data = data;
+  entry->deadline_ms = deadline_ms;
+  entry->sequence = wheel->next_sequence++;
+  entry->pending = true;
+  wheel->length++;
+  place(wheel, entry);
+}
+
+void timer_wheel_remove(timer_wheel_t* wheel, timer_wheel_entry_t* entry) {
+  CHECK(wheel != NULL);
+  CHECK(entry != NULL);
+
+  if (!entry->pending) return;
+
+  unlink_entry(wheel, entry);
+  entry->pending = false;
+  wheel->length--;
+}
+
+bool timer_wheel_entry_is_pending(const timer_wheel_entry_t* entry) {
+  CHECK(entry != NULL);
+  return entry->pending;
+}
+
+bool timer_wheel_next_deadline(const timer_wheel_t* wheel,
+                               uint64_t* deadline_ms) {
+  CHECK(wheel != NULL);
+  CHECK(deadline_ms != NULL);
+
+  if (wheel->length == 0) return false;
+
+  uint64_t earliest = UINT64_MAX;
+  if (wheel->expiring.head) earliest = wheel->expiring.head->deadline_ms;
+  if (wheel->due.head && wheel->due.head->deadline_ms < earliest)
+    earliest = wheel->due.head->deadline_ms;
+
+  // All entries of a level 0 slot are due at the tick of that slot
+  if (wheel->occupied[0]) {
+    uint64_t tick = next_tick(wheel, 0);
+    if (tick < earliest) earliest = tick;
+  }
+
+  // On the other levels the nearest occupied slot holds the earliest entry of
+  // the level, except for parked entries which may be anywhere on the top
+  // level.
+  for (int level = 1; level < NUM_LEVELS; level++) {
+    if (!wheel->occupied[level]) continue;
+
+    int first_slot = (next_tick(wheel, level) >> (LEVEL_BITS * level)) &
+                     SLOT_MASK;
+    int slot_count = (level == NUM_LEVELS - 1) ? SLOTS_PER_LEVEL : 1;
+    for (int i = 0; i < slot_count; i++) {
+      int slot = (first_slot + i) & SLOT_MASK;
+      for (const timer_wheel_entry_t* entry = wheel->slots[level][slot].head;
+           entry; entry = entry->next) {
+        if (entry->deadline_ms < earliest) earliest = entry->deadline_ms;
+      }
+    }
+  }
+
+  *deadline_ms = earliest;
+  return true;
+}
+
+size_t timer_wheel_expire(timer_wheel_t* wheel, uint64_t now_ms,
+                          timer_wheel_cb callback, void* context) {
+  CHECK(wheel != NULL);
+  CHECK(callback != NULL);
+  CHECK(wheel->expiring.head == NULL);
+
+  slot_t* expiring = &wheel->expiring;
+
+  // Overdue entries come first, they are already sorted.
+  for (timer_wheel_entry_t* entry = wheel->due.head; entry;
+       entry = entry->next)
+    entry->level = LEVEL_EXPIRING;
+  *expiring = wheel->due;
+  wheel->due = slot_t{NULL, NULL};
+
+  while (wheel->time_ms <= now_ms) {
+    // Jump straight to the next tick at which a slot has to be processed.
+    uint64_t tick = now_ms + 1;
+    for (int level = 0; level < NUM_LEVELS; level++) {
+      if (!wheel->occupied[level]) continue;
+      uint64_t level_tick = next_tick(wheel, level);
+      if (level_tick < tick) tick = level_tick;
+    }
+    wheel->time_ms = tick;
+    if (tick > now_ms) break;
+
+    cascade(wheel, tick);
+
+    int slot = tick & SLOT_MASK;
+    slot_t* due_now = &wheel->slots[0][slot];
+    if (due_now->head) {
+      for (timer_wheel_entry_t* entry = due_now->head; entry;
+           entry = entry->next)
+        entry->level = LEVEL_EXPIRING;
+      if (expiring->tail) {
+        expiring->tail->next = due_now->head;
+        due_now->head->prev = expiring->tail;
+      } else {
+        expiring->head = due_now->head;
+      }
+      expiring->tail = due_now->tail;
+      *due_now = slot_t{NULL, NULL};
+      wheel->occupied[0] &= ~(1ULL << slot);
+    }
+    wheel->time_ms = tick + 1;
+  }
+
+  // Entries are taken off one at a time, so callbacks may still remove or
+  // reschedule entries of this batch that have not been reported yet.
+  size_t count = 0;
+  timer_wheel_entry_t* entry;
+  while ((entry = expiring->head) != NULL) {
+    slot_unlink(expiring, entry);
+    entry->pending = false;
+    wheel->length--;
+    count++;
+    callback(entry->data, context);
+  }
+  return count;
+}
+
+void timer_wheel_foreach(const timer_wheel_t* wheel, timer_wheel_cb callback,
+                         void* context) {
+  CHECK(wheel != NULL);
+  CHECK(callback != NULL);
+
+  const slot_t* lists[] = {&wheel->expiring, &wheel->due};
+  for (const slot_t* list : lists) {
+    for (const timer_wheel_entry_t* entry = list->head; entry;
+         entry = entry->next) {
+      if (!callback(entry->data, context)) return;
+    }
+  }
+  for (int level = 0; level < NUM_LEVELS; level++) {
+    for (int slot = 0; slot < SLOTS_PER_LEVEL; slot++) {
+      for (const timer_wheel_entry_t* entry = wheel->slots[level][slot].head;
+           entry; entry = entry->next) {
+        if (!callback(entry->data, context)) return;
+      }
+    }
+  }
+}
+
+static slot_t* slot_of(timer_wheel_t* wheel, const timer_wheel_entry_t* entry) {
+  if (entry->level == LEVEL_DUE) return &wheel->due;
+  if (entry->level == LEVEL_EXPIRING) return &wheel->expiring;
+  return &wheel->slots[entry->level][entry->slot];
+}
+
+// Inserts |entry| after |prev|, or at the head of |slot| if |prev| is NULL.
+static void slot_insert_after(slot_t* slot, timer_wheel_entry_t* prev,
+                              timer_wheel_entry_t* entry) {
+  entry->prev = prev;
+  entry->next = prev ? prev->next : slot->head;
+  if (entry->next)
+    entry->next->prev = entry;
+  else
+    slot->tail = entry;
+  if (prev)
+    prev->next = entry;
+  else
+    slot->head = entry;
+}
+
+static void slot_unlink(slot_t* slot, timer_wheel_entry_t* entry) {
+  if (entry->prev)
+    entry->prev->next = entry->next;
+  else
+    slot->head = entry->next;
+  if (entry->next)
+    entry->next->prev = entry->prev;
+  else
+    slot->tail = entry->prev;
+  entry->next = NULL;
+  entry->prev = NULL;
+}
+
+static void place(timer_wheel_t* wheel, timer_wheel_entry_t* entry) {
+  if (entry->deadline_ms < wheel->time_ms) {
+    // Keep |due| sorted by deadline; deadlines are mostly added in order.
+    timer_wheel_entry_t* prev = wheel->due.tail;
+    while (prev && prev->deadline_ms > entry->deadline_ms) prev = prev->prev;
+    entry->level = LEVEL_DUE;
+    slot_insert_after(&wheel->due, prev, entry);
+    return;
+  }
+
+  uint64_t delta = entry->deadline_ms - wheel->time_ms;
+  uint64_t deadline_ms = entry->deadline_ms;
+  int level = 0;
+  while (level < NUM_LEVELS - 1 &&
+         delta >= (1ULL << (LEVEL_BITS * (level + 1))))
+    level++;
+  if (delta >= WHEEL_SPAN_MS) deadline_ms = wheel->time_ms + WHEEL_SPAN_MS - 1;
+
+  int slot = (deadline_ms >> (LEVEL_BITS * level)) & SLOT_MASK;
+  slot_t* list = &wheel->slots[level][slot];
+  timer_wheel_entry_t* prev = list->tail;
+  if (level == 0) {
+    // Entries sharing a deadline expire in the order they were added, even
+    // when some of them were cascaded from a coarser level.
+    while (prev && prev->sequence > entry->sequence) prev = prev->prev;
+  }
+  entry->level = level;
+  entry->slot = slot;
+  slot_insert_after(list, prev, entry);
+  wheel->occupied[level] |= 1ULL << slot;
+}
+
+static void unlink_entry(timer_wheel_t* wheel, timer_wheel_entry_t* entry) {
+  slot_t* list = slot_of(wheel, entry);
+  slot_unlink(list, entry);
+  if (entry->level < NUM_LEVELS && list->head == NULL)
+    wheel->occupied[entry->level] &= ~(1ULL << entry->slot);
+}
+
+// Places again the entries of every coarse slot that starts at |tick|. Must
+// be called with |wheel->time_ms| set to |tick|.
+static void cascade(timer_wheel_t* wheel, uint64_t tick) {
+  for (int level = NUM_LEVELS - 1; level > 0; level--) {
+    int shift = LEVEL_BITS * level;
+    if (tick & ((1ULL << shift) - 1)) continue;
+
+    int slot = (tick >> shift) & SLOT_MASK;
+    if (!(wheel->occupied[level] & (1ULL << slot))) continue;
+
+    timer_wheel_entry_t* entry = wheel->slots[level][slot].head;
+    wheel->slots[level][slot] = slot_t{NULL, NULL};
+    wheel->occupied[level] &= ~(1ULL << slot);
+    while (entry) {
+      timer_wheel_entry_t* next = entry->next;
+      entry->next = NULL;
+      entry->prev = NULL;
+      place(wheel, entry);
+      entry = next;
+    }
+  }
+}
+
+// Returns the first tick, at or after |wheel->time_ms|, at which an occupied
+// slot of |level| has to be processed. |level| must have an occupied slot.
+static uint64_t next_tick(const timer_wheel_t* wheel, int level) {
+  int shift = LEVEL_BITS * level;
+  uint64_t block = (wheel->time_ms + (1ULL << shift) - 1) >> shift;
+  int first_slot = block & SLOT_MASK;
+  uint64_t occupied = wheel->occupied[level];
+  uint64_t rotated =
+      (occupied >> first_slot) | (occupied << ((64 - first_slot) & 63));
+  return (block + __builtin_ctzll(rotated)) << shift;
+}
@@ -24,6 +24,7 @@
 #include <inttypes.h>
 #include <limits.h>
 #include <pthread.h>
+#include <signal.h>
 #include <string.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -78,6 +79,35 @@ typedef struct {
 
 static wakelock_stats_t wakelock_stats;
 
+// The holds of a subsystem on the wakelock
+typedef struct {
+  size_t holds;
+  size_t acquired_count;
+  size_t unbalanced_releases;
+  uint64_t total_held_ms;
+  uint64_t last_acquired_timestamp_ms;
+} wakelock_reason_stats_t;
+
+static const char* const WAKELOCK_REASON_NAMES[WAKELOCK_REASON_MAX] = {
+    "other", "alarm", "a2dp_source", "hearing_aid"};
+
+static wakelock_reason_stats_t reason_stats[WAKELOCK_REASON_MAX];
+
+// The sum of the holds of all the reasons
+static size_t total_holds;
+// Whether the OS wakelock is held, possibly without holds during the
+// hold-off after the last release
+static bool os_lock_held;
+static uint64_t release_holdoff_ms;
+static uint64_t release_deadline_ms;
+static timer_t holdoff_timer;
+static bool holdoff_timer_created;
+// Acquires and releases served without going to the OS
+static size_t coalesced_acquires;
+
+// This mutex serializes the holds, and the OS calls that they make.
+static std::mutex lock_mutex;
+
 // This mutex ensures that the functions that update and dump the statistics
 // are executed serially.
 static std::mutex stats_mutex;
@@ -89,8 +119,11 @@ static bt_status_t wakelock_release_native(void);
 static void wakelock_initialize(void);
 static void wakelock_initialize_native(void);
 static void reset_wakelock_stats(void);
-static void update_wakelock_acquired_stats(bt_status_t acquired_status);
-static void update_wakelock_released_stats(bt_status_t released_status);
+static void update_wakelock_acquired_stats(bt_status_t acquired_status,
+                                           wakelock_reason_t reason);
+static void update_wakelock_released_stats(bt_status_t released_status,
+                                           wakelock_reason_t reason);
+static uint64_t now_ms(void);
 
 void wakelock_set_os_callouts(bt_os_callouts_t* callouts) {
   wakelock_os_callouts = callouts;
@@ -100,8 +133,11 @@ void wakelock_set_os_callouts(bt_os_callouts_t* callouts) {
 }
 
 bool wakelock_acquire(void) {
-  pthread_once(&initialized, wakelock_initialize);
+  return wakelock_acquire_for(WAKELOCK_REASON_OTHER);
+}
 
+// NOTE: must be called with |lock_mutex| held
+static bool os_wakelock_acquire(wakelock_reason_t reason) {
   bt_status_t status = BT_STATUS_FAIL;
 
   if (is_native)
@@ -109,12 +145,32 @@ bool wakelock_acquire(void) {
   else
     status = wakelock_acquire_callout();
 
-  update_wakelock_acquired_stats(status);
+  update_wakelock_acquired_stats(status, reason);
 
   if (status != BT_STATUS_SUCCESS)
     LOG_ERROR(LOG_TAG, "%s unable to acquire wake lock: %d", __func__, status);
 
-  return (status == BT_STATUS_SUCCESS);
+  os_lock_held = (status == BT_STATUS_SUCCESS);
+  return os_lock_held;
+}
+
+bool wakelock_acquire_for(wakelock_reason_t reason) {
+  CHECK(reason < WAKELOCK_REASON_MAX);
+  pthread_once(&initialized, wakelock_initialize);
+
+  std::lock_guard<std::mutex> lock(lock_mutex);
+  if (!os_lock_held) {
+    if (!os_wakelock_acquire(reason)) return false;
+  } else if (total_holds == 0) {
+    // Still held in the hold-off of the last release
+    coalesced_acquires++;
+  }
+
+  wakelock_reason_stats_t& stats = reason_stats[reason];
+  if (stats.holds++ == 0) stats.last_acquired_timestamp_ms = now_ms();
+  stats.acquired_count++;
+  total_holds++;
+  return true;
 }
 
 static bt_status_t wakelock_acquire_callout(void) {
@@ -148,8 +204,11 @@ static bt_status_t wakelock_acquire_native(void) {
 }
 
 bool wakelock_release(void) {
-  pthread_once(&initialized, wakelock_initialize);
+  return wakelock_release_for(WAKELOCK_REASON_OTHER);
+}
 
+// NOTE: must be called with |lock_mutex| held
+static bool os_wakelock_release(wakelock_reason_t reason) {
   bt_status_t status = BT_STATUS_FAIL;
 
   if (is_native)
@@ -157,11 +216,72 @@ bool wakelock_release(void) {
   else
     status = wakelock_release_callout();
 
-  update_wakelock_released_stats(status);
+  update_wakelock_released_stats(status, reason);
 
+  os_lock_held = false;
   return (status == BT_STATUS_SUCCESS);
 }
 
+static void holdoff_timer_expired(union sigval) {
+  std::lock_guard<std::mutex> lock(lock_mutex);
+  // A later release may have pushed the deadline back and re-armed the timer
+  if (!os_lock_held || total_holds != 0 || now_ms() < release_deadline_ms)
+    return;
+  os_wakelock_release(WAKELOCK_REASON_MAX);
+}
+
+// NOTE: must be called with |lock_mutex| held
+static bool arm_holdoff_timer(void) {
+  if (!holdoff_timer_created) {
+    struct sigevent sigevent;
+    memset(&sigevent, 0, sizeof(sigevent));
+    sigevent.sigev_notify = SIGEV_THREAD;
+    sigevent.sigev_notify_function = holdoff_timer_expired;
+    if (timer_create(CLOCK_ID, &sigevent, &holdoff_timer) == -1) {
+      LOG_ERROR(LOG_TAG, "%s unable to create hold-off timer: %s", __func__,
+                strerror(errno));
+      return false;
+    }
+    holdoff_timer_created = true;
+  }
+
+  release_deadline_ms = now_ms() + release_holdoff_ms;
+  struct itimerspec holdoff;
+  memset(&holdoff, 0, sizeof(holdoff));
+  holdoff.it_value.tv_sec = release_holdoff_ms / 1000;
+  holdoff.it_value.tv_nsec = (release_holdoff_ms % 1000) * 1000000LL;
+  if (timer_settime(holdoff_timer, 0, &holdoff, NULL) == -1) {
+    LOG_ERROR(LOG_TAG, "%s unable to set hold-off timer: %s", __func__,
+              strerror(errno));
+    return false;
+  }
+  return true;
+}
+
+bool wakelock_release_for(wakelock_reason_t reason) {
+  CHECK(reason < WAKELOCK_REASON_MAX);
+  pthread_once(&initialized, wakelock_initialize);
+
+  std::lock_guard<std::mutex> lock(lock_mutex);
+  wakelock_reason_stats_t& stats = reason_stats[reason];
+  if (stats.holds == 0) {
+    stats.unbalanced_releases++;
+    return false;
+  }
+
+  if (--stats.holds == 0)
+    stats.total_held_ms += now_ms() - stats.last_acquired_timestamp_ms;
+  if (--total_holds != 0 || !os_lock_held) return true;
+
+  if (release_holdoff_ms != 0 && arm_holdoff_timer()) return true;
+  return os_wakelock_release(reason);
+}
+
+void wakelock_set_release_holdoff_ms(uint64_t holdoff_ms) {
+  std::lock_guard<std::mutex> lock(lock_mutex);
+  release_holdoff_ms = holdoff_ms;
+}
+
 static bt_status_t wakelock_release_callout(void) {
   return static_cast<bt_status_t>(
       wakelock_os_callouts->release_wake_lock(WAKE_LOCK_ID));
@@ -213,9 +333,19 @@ static void wakelock_initialize_native(void) {
 }
 
 void wakelock_cleanup(void) {
-  if (wakelock_stats.is_acquired) {
-    LOG_ERROR(LOG_TAG, "%s releasing wake lock as part of cleanup", __func__);
-    wakelock_release();
+  {
+    std::lock_guard<std::mutex> lock(lock_mutex);
+    if (holdoff_timer_created) {
+      timer_delete(holdoff_timer);
+      holdoff_timer_created = false;
+    }
+    if (total_holds != 0) {
+      LOG_ERROR(LOG_TAG, "%s releasing wake lock as part of cleanup", __func__);
+    }
+    if (os_lock_held) os_wakelock_release(WAKELOCK_REASON_MAX);
+    total_holds = 0;
+    coalesced_acquires = 0;
+    memset(reason_stats, 0, sizeof(reason_stats));
   }
   wake_lock_path.clear();
   wake_unlock_path.clear();
@@ -263,10 +393,11 @@ static void reset_wakelock_stats(void) {
 //
 // This function should be called every time when the wakelock is acquired.
 // |acquired_status| is the status code that was return when the wakelock was
-// acquired.
+// acquired, on behalf of |reason|.
 // This function is thread-safe.
 //
-static void update_wakelock_acquired_stats(bt_status_t acquired_status) {
+static void update_wakelock_acquired_stats(bt_status_t acquired_status,
+                                           wakelock_reason_t reason) {
   const uint64_t just_now_ms = now_ms();
 
   std::lock_guard<std::mutex> lock(stats_mutex);
@@ -285,7 +416,8 @@ static void update_wakelock_acquired_stats(bt_status_t acquired_status) {
   wakelock_stats.last_acquired_timestamp_ms = just_now_ms;
 
   BluetoothMetricsLogger::GetInstance()->LogWakeEvent(
-      bluetooth::common::WAKE_EVENT_ACQUIRED, "", "", just_now_ms);
+      bluetooth::common::WAKE_EVENT_ACQUIRED, WAKELOCK_REASON_NAMES[reason],
+      "", just_now_ms);
 }
 
 //
@@ -293,10 +425,12 @@ static void update_wakelock_acquired_stats(bt_status_t acquired_status) {
 //
 // This function should be called every time when the wakelock is released.
 // |released_status| is the status code that was return when the wakelock was
-// released.
+// released, on behalf of |reason|. WAKELOCK_REASON_MAX stands for the
+// hold-off timer and the cleanup.
 // This function is thread-safe.
 //
-static void update_wakelock_released_stats(bt_status_t released_status) {
+static void update_wakelock_released_stats(bt_status_t released_status,
+                                           wakelock_reason_t reason) {
   const uint64_t just_now_ms = now_ms();
 
   std::lock_guard<std::mutex> lock(stats_mutex);
@@ -327,10 +461,12 @@ static void update_wakelock_released_stats(bt_status_t released_status) {
   wakelock_stats.total_acquired_interval_ms += delta_ms;
 
   BluetoothMetricsLogger::GetInstance()->LogWakeEvent(
-      bluetooth::common::WAKE_EVENT_RELEASED, "", "", just_now_ms);
+      bluetooth::common::WAKE_EVENT_RELEASED,
+      reason < WAKELOCK_REASON_MAX ? WAKELOCK_REASON_NAMES[reason] : "", "",
+      just_now_ms);
 }
 
-void wakelock_debug_dump(int fd) {
+static void wakelock_stats_debug_dump(int fd) {
   const uint64_t just_now_ms = now_ms();
 
   std::lock_guard<std::mutex> lock(stats_mutex);
@@ -376,3 +512,30 @@ void wakelock_debug_dump(int fd) {
           (unsigned long long)(just_now_ms -
                                wakelock_stats.last_reset_timestamp_ms));
 }
+
+static void wakelock_reasons_debug_dump(int fd) {
+  const uint64_t just_now_ms = now_ms();
+
+  std::lock_guard<std::mutex> lock(lock_mutex);
+
+  dprintf(fd, "  Release hold-off (ms)          : %llu\n",
+          (unsigned long long)release_holdoff_ms);
+  dprintf(fd, "  Coalesced acquire count        : %zu\n", coalesced_acquires);
+  dprintf(fd, "  Holds by reason       : held / acquired / unbalanced / "
+              "held time (ms)\n");
+  for (int i = 0; i < WAKELOCK_REASON_MAX; i++) {
+    const wakelock_reason_stats_t& stats = reason_stats[i];
+    uint64_t held_ms = stats.total_held_ms;
+    if (stats.holds != 0)
+      held_ms += just_now_ms - stats.last_acquired_timestamp_ms;
+    dprintf(fd, "    %-19s: %zu / %zu / %zu / %llu\n", WAKELOCK_REASON_NAMES[i],
+            stats.holds, stats.acquired_count, stats.unbalanced_releases,
+            (unsigned long long)held_ms);
+  }
+}
+
+void wakelock_debug_dump(int fd) {
+  // The holds are dumped apart: |lock_mutex| is taken before |stats_mutex|
+  wakelock_stats_debug_dump(fd);
+  wakelock_reasons_debug_dump(fd);
+}
@@ -251,6 +251,43 @@ TEST_F(AlarmTest, test_set_long_long) {
   alarm_free(alarm[1]);
 }
 
+TEST_F(AlarmTest, test_set_with_slack_expires_by_its_limit) {
+  alarm_t* alarm = alarm_new("alarm_test.test_set_with_slack_expires_by_limit");
+
+  alarm_set_with_slack(alarm, 10, 200, cb, NULL);
+
+  // Nothing else wakes the system, so the alarm waits for its slack
+  msleep(10 + EPSILON_MS);
+  EXPECT_EQ(cb_counter, 0);
+
+  semaphore_wait(semaphore);
+  EXPECT_EQ(cb_counter, 1);
+  EXPECT_FALSE(WakeLockHeld());
+
+  alarm_free(alarm);
+}
+
+TEST_F(AlarmTest, test_set_with_slack_batches_with_other_alarms) {
+  alarm_t* lazy = alarm_new("alarm_test.test_set_with_slack_batches.lazy");
+  alarm_t* exact = alarm_new("alarm_test.test_set_with_slack_batches.exact");
+
+  alarm_set_with_slack(lazy, 10, 10000, cb, NULL);
+  alarm_set(exact, 100, cb, NULL);
+
+  msleep(10 + EPSILON_MS);
+  EXPECT_EQ(cb_counter, 0);
+
+  // Both expire when the exact alarm wakes the system up
+  msleep(100);
+  EXPECT_EQ(cb_counter, 2);
+  semaphore_wait(semaphore);
+  semaphore_wait(semaphore);
+  EXPECT_FALSE(WakeLockHeld());
+
+  alarm_free(lazy);
+  alarm_free(exact);
+}
+
 TEST_F(AlarmTest, test_is_scheduled) {
   alarm_t* alarm = alarm_new("alarm_test.test_is_scheduled");
 
@@ -17,8 +17,11 @@
  ******************************************************************************/
 
 #include <gtest/gtest.h>
+#include <stdio.h>
+#include <string>
 
 #include "osi/include/allocation_tracker.h"
+#include "osi/include/allocator.h"
 
 void allocation_tracker_uninit(void);
 
@@ -62,3 +65,88 @@ TEST(AllocationTrackerTest, test_canaries_on) {
 
   free(dummy_allocation);
 }
+
+static void* fake_pointer(uintptr_t address) {
+  return reinterpret_cast<void*>(address);
+}
+
+TEST(AllocationTrackerTest, test_sampling_off_records_nothing) {
+  allocation_tracker_set_sampling_interval(0);
+
+  allocation_tracker_sample_alloc(fake_pointer(0x1000), 1 << 20, nullptr);
+  EXPECT_EQ(0U, allocation_tracker_sampled_count());
+}
+
+TEST(AllocationTrackerTest, test_sampling_every_octet) {
+  allocation_tracker_set_sampling_interval(1);
+
+  for (uintptr_t address = 0x1000; address < 0x1030; address += 0x10)
+    allocation_tracker_sample_alloc(fake_pointer(address), 4, nullptr);
+  EXPECT_EQ(3U, allocation_tracker_sampled_count());
+
+  allocation_tracker_sample_free(fake_pointer(0x1010));
+  allocation_tracker_sample_free(fake_pointer(0x2000));  // never sampled
+  allocation_tracker_sample_free(nullptr);
+  EXPECT_EQ(2U, allocation_tracker_sampled_count());
+
+  allocation_tracker_set_sampling_interval(0);
+  EXPECT_EQ(0U, allocation_tracker_sampled_count());
+}
+
+TEST(AllocationTrackerTest, test_sampling_large_allocations) {
+  allocation_tracker_set_sampling_interval(1 << 20);
+
+  allocation_tracker_sample_alloc(fake_pointer(0x1000), 1 << 20, nullptr);
+  allocation_tracker_sample_alloc(fake_pointer(0x2000), 1 << 20, nullptr);
+  EXPECT_EQ(2U, allocation_tracker_sampled_count());
+
+  allocation_tracker_set_sampling_interval(0);
+}
+
+TEST(AllocationTrackerTest, test_sampling_colliding_allocations) {
+  allocation_tracker_set_sampling_interval(1);
+
+  // All of them hash to the same slot of the table of the live samples, which
+  // only probes 16 slots
+  const uintptr_t stride = 4096 << 4;
+  for (uintptr_t i = 1; i <= 20; i++)
+    allocation_tracker_sample_alloc(fake_pointer(i * stride), 4, nullptr);
+  EXPECT_EQ(16U, allocation_tracker_sampled_count());
+
+  // Freeing the first ones must not hide the ones probed past them
+  allocation_tracker_sample_free(fake_pointer(1 * stride));
+  allocation_tracker_sample_free(fake_pointer(2 * stride));
+  allocation_tracker_sample_free(fake_pointer(16 * stride));
+  allocation_tracker_sample_free(fake_pointer(17 * stride));  // dropped
+  EXPECT_EQ(13U, allocation_tracker_sampled_count());
+  for (uintptr_t i = 3; i <= 15; i++)
+    allocation_tracker_sample_free(fake_pointer(i * stride));
+  EXPECT_EQ(0U, allocation_tracker_sampled_count());
+
+  allocation_tracker_set_sampling_interval(0);
+}
+
+TEST(AllocationTrackerTest, test_sampling_dump) {
+  allocation_tracker_set_sampling_interval(1);
+
+  void* ptr = osi_malloc(24);
+  EXPECT_EQ(1U, allocation_tracker_sampled_count());
+
+  FILE* file = tmpfile();
+  ASSERT_NE(nullptr, file);
+  osi_allocator_debug_dump(fileno(file));
+  std::string dump;
+  char buffer[256];
+  rewind(file);
+  while (fgets(buffer, sizeof(buffer), file) != nullptr) dump += buffer;
+  fclose(file);
+
+  EXPECT_NE(std::string::npos,
+            dump.find("live/dropped samples : 1 / 0"));
+  EXPECT_NE(std::string::npos, dump.find("<=32:1"));
+  EXPECT_NE(std::string::npos, dump.find(": 24 / 24 in 1 samples"));
+
+  osi_free(ptr);
+  EXPECT_EQ(0U, allocation_tracker_sampled_count());
+  allocation_tracker_set_sampling_interval(0);
+}
@@ -17,7 +17,9 @@
 #include "osi/include/config.h"
 
 #include <base/files/file_util.h>
+#include <base/strings/stringprintf.h>
 #include <gtest/gtest.h>
+#include <openssl/sha.h>
 
 #include <filesystem>
 
@@ -275,3 +277,107 @@ TEST_F(ConfigTest, checksum_save) {
 
   EXPECT_TRUE(std::filesystem::remove(filename));
 }
+
+TEST_F(ConfigTest, config_journal_replay) {
+  auto filename = std::filesystem::temp_directory_path() / "test.journal";
+  std::unique_ptr<config_t> saved = config_new(CONFIG_FILE);
+  std::unique_ptr<config_t> config = config_new_clone(*saved);
+  EXPECT_TRUE(config_journal_reset(filename, "1"));
+
+  config_set_int(config.get(), "DID", "version", 0x2222);
+  config_remove_key(config.get(), "DID", "productId");
+  config_remove_section(config.get(), CONFIG_DEFAULT_SECTION);
+  config_set_string(config.get(), "NewSection", "name", "with spaces\tand tab");
+  size_t journal_size = 0;
+  EXPECT_TRUE(config_journal_append(filename, *saved, *config, &journal_size));
+  EXPECT_GT(journal_size, 0u);
+
+  // Nothing is appended when there are no changes
+  size_t unchanged_size = 0;
+  EXPECT_TRUE(
+      config_journal_append(filename, *config, *config, &unchanged_size));
+  EXPECT_EQ(unchanged_size, journal_size);
+
+  std::unique_ptr<config_t> replayed = config_new(CONFIG_FILE);
+  EXPECT_TRUE(config_journal_replay(filename, "1", replayed.get()));
+  EXPECT_EQ(config_get_int(*replayed, "DID", "version", 0), 0x2222);
+  EXPECT_FALSE(config_has_key(*replayed, "DID", "productId"));
+  EXPECT_TRUE(config_has_key(*replayed, "DID", "recordNumber"));
+  EXPECT_FALSE(config_has_section(*replayed, CONFIG_DEFAULT_SECTION));
+  EXPECT_EQ(*config_get_string(*replayed, "NewSection", "name", nullptr),
+            "with spaces\tand tab");
+
+  // A journal started for another generation of the config is ignored
+  std::unique_ptr<config_t> other = config_new(CONFIG_FILE);
+  EXPECT_FALSE(config_journal_replay(filename, "2", other.get()));
+  EXPECT_EQ(config_get_int(*other, "DID", "version", 0), 0x1436);
+
+  EXPECT_TRUE(std::filesystem::remove(filename));
+}
+
+TEST_F(ConfigTest, config_journal_replay_torn_transaction) {
+  auto filename = std::filesystem::temp_directory_path() / "test.journal";
+  std::unique_ptr<config_t> saved = config_new(CONFIG_FILE);
+  std::unique_ptr<config_t> config = config_new_clone(*saved);
+  EXPECT_TRUE(config_journal_reset(filename, "1"));
+
+  config_set_int(config.get(), "DID", "version", 0x2222);
+  size_t committed_size = 0;
+  EXPECT_TRUE(
+      config_journal_append(filename, *saved, *config, &committed_size));
+  std::unique_ptr<config_t> next = config_new_clone(*config);
+  config_set_int(next.get(), "DID", "version", 0x3333);
+  config_set_int(next.get(), "DID", "recordNumber", 2);
+  size_t journal_size = 0;
+  EXPECT_TRUE(config_journal_append(filename, *config, *next, &journal_size));
+
+  // Cut the second transaction short
+  std::filesystem::resize_file(filename, journal_size - 3);
+
+  std::unique_ptr<config_t> replayed = config_new(CONFIG_FILE);
+  EXPECT_TRUE(config_journal_replay(filename, "1", replayed.get()));
+  EXPECT_EQ(config_get_int(*replayed, "DID", "version", 0), 0x2222);
+  EXPECT_EQ(config_get_int(*replayed, "DID", "recordNumber", 0), 1);
+
+  EXPECT_TRUE(std::filesystem::remove(filename));
+}
+
+TEST_F(ConfigTest, config_journal_append_missing) {
+  auto filename = std::filesystem::temp_directory_path() / "missing.journal";
+  std::unique_ptr<config_t> config = config_new(CONFIG_FILE);
+  EXPECT_FALSE(config_journal_append(filename, *config, *config, nullptr));
+}
+
+TEST_F(ConfigTest, config_new_with_checksum) {
+  std::string checksum;
+  std::unique_ptr<config_t> config =
+      config_new_with_checksum(CONFIG_FILE, &checksum);
+  ASSERT_NE(config, nullptr);
+  EXPECT_EQ(config_get_int(*config, "DID", "version", 0), 0x1436);
+
+  std::string contents;
+  ASSERT_TRUE(base::ReadFileToString(base::FilePath(CONFIG_FILE), &contents));
+  uint8_t digest[SHA256_DIGEST_LENGTH];
+  SHA256(reinterpret_cast<const uint8_t*>(contents.data()), contents.size(),
+         digest);
+  std::string expected;
+  for (uint8_t byte : digest) expected += base::StringPrintf("%02x", byte);
+  EXPECT_EQ(checksum, expected);
+}
+
+TEST_F(ConfigTest, config_new_long_lines_and_no_final_newline) {
+  auto filename = std::filesystem::temp_directory_path() / "long_lines.conf";
+  const std::string long_value(4096, 'a');
+  const std::string contents =
+      "[Adapter]\nName = " + long_value + "\n\n[Last]\nkey=value";
+  ASSERT_EQ(base::WriteFile(base::FilePath(filename.string()),
+                            contents.data(), contents.size()),
+            (int)contents.size());
+
+  std::unique_ptr<config_t> config = config_new(filename.c_str());
+  ASSERT_NE(config, nullptr);
+  EXPECT_EQ(*config_get_string(*config, "Adapter", "Name", nullptr),
+            long_value);
+  EXPECT_EQ(*config_get_string(*config, "Last", "key", nullptr), "value");
+  EXPECT_TRUE(std::filesystem::remove(filename));
+}
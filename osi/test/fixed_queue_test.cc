@@ -1,6 +1,7 @@
 #include <gtest/gtest.h>
 
 #include <climits>
+#include <vector>
 
 #include "AllocationTestHarness.h"
 
@@ -230,6 +231,26 @@ TEST_F(FixedQueueTest, test_fixed_queue_enqueue_dequeue) {
   fixed_queue_free(queue, NULL);
 }
 
+TEST_F(FixedQueueTest, test_fixed_queue_enqueue_batch) {
+  fixed_queue_t* queue = fixed_queue_new(TEST_QUEUE_SIZE);
+  ASSERT_TRUE(queue != NULL);
+
+  void* data[] = {(void*)DUMMY_DATA_STRING1, (void*)DUMMY_DATA_STRING2,
+                  (void*)DUMMY_DATA_STRING3};
+  fixed_queue_enqueue_batch(queue, data, 3);
+  EXPECT_EQ((size_t)3, fixed_queue_length(queue));
+  for (void* element : data) EXPECT_EQ(element, fixed_queue_dequeue(queue));
+  EXPECT_EQ(NULL, fixed_queue_try_dequeue(queue));
+
+  // The batch fills the queue exactly, so that no enqueue fits after it
+  std::vector<void*> full(TEST_QUEUE_SIZE, (void*)DUMMY_DATA_STRING);
+  fixed_queue_enqueue_batch(queue, full.data(), full.size());
+  EXPECT_FALSE(fixed_queue_try_enqueue(queue, (void*)DUMMY_DATA_STRING));
+  fixed_queue_flush(queue, NULL);
+
+  fixed_queue_free(queue, NULL);
+}
+
 TEST_F(FixedQueueTest, test_fixed_queue_try_peek_first_last) {
   fixed_queue_t* queue = fixed_queue_new(TEST_QUEUE_SIZE);
   ASSERT_TRUE(queue != NULL);
@@ -102,6 +102,36 @@ TEST_F(ListTest, test_list_clear) {
   list_free(list);
 }
 
+TEST_F(ListTest, test_list_reuse_removed_nodes) {
+  int x[100];
+  list_t* list = list_new(NULL);
+
+  // Grow past the number of spare nodes kept, then cycle as a queue
+  for (size_t i = 0; i < ARRAY_SIZE(x); ++i) list_append(list, &x[i]);
+  list_clear(list);
+  for (int round = 0; round < 3; ++round) {
+    for (size_t i = 0; i < ARRAY_SIZE(x); ++i) {
+      list_append(list, &x[i]);
+      if (i % 2) list_remove(list, list_front(list));
+    }
+    EXPECT_EQ(list_length(list), ARRAY_SIZE(x) / 2);
+    EXPECT_EQ(list_front(list), &x[ARRAY_SIZE(x) / 2]);
+    EXPECT_EQ(list_back(list), &x[ARRAY_SIZE(x) - 1]);
+    list_clear(list);
+  }
+
+  list_prepend(list, &x[1]);
+  list_insert_after(list, list_back_node(list), &x[2]);
+  list_prepend(list, &x[0]);
+  int i = 0;
+  for (const list_node_t *node = list_begin(list); node != list_end(list);
+       node = list_next(node), ++i)
+    EXPECT_EQ(list_node(node), &x[i]);
+  EXPECT_EQ(i, 3);
+
+  list_free(list);
+}
+
 TEST_F(ListTest, test_list_append_multiple) {
   int x[] = {1, 2, 3, 4, 5};
   list_t* list = list_new(NULL);
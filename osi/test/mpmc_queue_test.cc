@@ -0,0 +1,94 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "AllocationTestHarness.h"
+
+#include "osi/include/allocator.h"
+#include "osi/include/mpmc_queue.h"
+#include "osi/include/osi.h"
+
+static int test_queue_entry_free_counter = 0;
+
+static void test_queue_entry_free_cb(void* data) {
+  test_queue_entry_free_counter++;
+  osi_free(data);
+}
+
+class MpmcQueueTest : public AllocationTestHarness {};
+
+TEST_F(MpmcQueueTest, test_new_free_simple) {
+  mpmc_queue_t* queue = mpmc_queue_new(10);
+  ASSERT_TRUE(queue != NULL);
+  EXPECT_EQ((size_t)16, mpmc_queue_capacity(queue));
+  EXPECT_TRUE(mpmc_queue_is_empty(queue));
+  EXPECT_EQ((size_t)0, mpmc_queue_length(queue));
+  mpmc_queue_free(queue, NULL);
+
+  EXPECT_TRUE(mpmc_queue_new(0) == NULL);
+  mpmc_queue_free(NULL, NULL);
+  EXPECT_TRUE(mpmc_queue_is_empty(NULL));
+  EXPECT_TRUE(mpmc_queue_try_dequeue(NULL) == NULL);
+}
+
+TEST_F(MpmcQueueTest, test_fifo_and_full) {
+  int x[] = {1, 2, 3, 4, 5};
+  mpmc_queue_t* queue = mpmc_queue_new(4);
+
+  for (int i = 0; i < 4; i++) EXPECT_TRUE(mpmc_queue_try_enqueue(queue, &x[i]));
+  EXPECT_FALSE(mpmc_queue_try_enqueue(queue, &x[4]));
+  EXPECT_EQ((size_t)4, mpmc_queue_length(queue));
+
+  EXPECT_EQ(&x[0], mpmc_queue_try_dequeue(queue));
+  EXPECT_TRUE(mpmc_queue_try_enqueue(queue, &x[4]));
+  for (int i = 1; i < 5; i++) EXPECT_EQ(&x[i], mpmc_queue_dequeue(queue));
+  EXPECT_TRUE(mpmc_queue_try_dequeue(queue) == NULL);
+  EXPECT_TRUE(mpmc_queue_is_empty(queue));
+
+  mpmc_queue_free(queue, NULL);
+}
+
+TEST_F(MpmcQueueTest, test_flush_free) {
+  mpmc_queue_t* queue = mpmc_queue_new(8);
+  test_queue_entry_free_counter = 0;
+
+  for (int i = 0; i < 3; i++) mpmc_queue_enqueue(queue, osi_malloc(1));
+  mpmc_queue_flush(queue, test_queue_entry_free_cb);
+  EXPECT_EQ(3, test_queue_entry_free_counter);
+  EXPECT_TRUE(mpmc_queue_is_empty(queue));
+
+  for (int i = 0; i < 2; i++) mpmc_queue_enqueue(queue, osi_malloc(1));
+  mpmc_queue_free(queue, test_queue_entry_free_cb);
+  EXPECT_EQ(5, test_queue_entry_free_counter);
+}
+
+TEST_F(MpmcQueueTest, test_blocking_producers_consumers) {
+  const int kThreads = 3;
+  const int kPerThread = 20000;
+  mpmc_queue_t* queue = mpmc_queue_new(4);
+  std::vector<int> values(kThreads * kPerThread);
+  std::atomic<long> sum(0);
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; t++) {
+    threads.emplace_back([&, t]() {
+      for (int i = 0; i < kPerThread; i++) {
+        int index = t * kPerThread + i;
+        values[index] = index;
+        mpmc_queue_enqueue(queue, &values[index]);
+      }
+    });
+    threads.emplace_back([&]() {
+      for (int i = 0; i < kPerThread; i++)
+        sum += *static_cast<int*>(mpmc_queue_dequeue(queue));
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  long n = kThreads * kPerThread;
+  EXPECT_EQ(n * (n - 1) / 2, sum.load());
+  EXPECT_TRUE(mpmc_queue_is_empty(queue));
+  mpmc_queue_free(queue, NULL);
+}
@@ -0,0 +1,97 @@
+/******************************************************************************
+ *
+ *  Copyright 2020 Google, Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+#include "AllocationTestHarness.h"
+
+#include "internal_include/bt_target.h"
+#include "osi/include/allocator.h"
+#include "osi/include/pool_allocator.h"
+
+class PoolAllocatorTest : public AllocationTestHarness {};
+
+TEST_F(PoolAllocatorTest, test_alloc_free_reuse) {
+  void* ptr = pool_allocator_alloc(BT_DEFAULT_BUFFER_SIZE);
+  ASSERT_TRUE(ptr != NULL);
+  EXPECT_GE(pool_allocator_block_size(ptr), (size_t)BT_DEFAULT_BUFFER_SIZE);
+
+  EXPECT_TRUE(pool_allocator_free(ptr));
+
+  // The most recently freed block is handed out first.
+  void* again = pool_allocator_alloc(BT_DEFAULT_BUFFER_SIZE);
+  EXPECT_EQ(ptr, again);
+  EXPECT_TRUE(pool_allocator_free(again));
+}
+
+TEST_F(PoolAllocatorTest, test_smallest_fitting_class) {
+  void* small = pool_allocator_alloc(BT_SMALL_BUFFER_SIZE);
+  void* large = pool_allocator_alloc(BT_DEFAULT_BUFFER_SIZE);
+  ASSERT_TRUE(small != NULL);
+  ASSERT_TRUE(large != NULL);
+
+  EXPECT_LT(pool_allocator_block_size(small), pool_allocator_block_size(large));
+
+  EXPECT_TRUE(pool_allocator_free(small));
+  EXPECT_TRUE(pool_allocator_free(large));
+}
+
+TEST_F(PoolAllocatorTest, test_oversized_not_served) {
+  EXPECT_EQ(NULL, pool_allocator_alloc(L2CAP_FCR_ERTM_BUF_SIZE));
+}
+
+TEST_F(PoolAllocatorTest, test_foreign_pointer_not_owned) {
+  void* ptr = malloc(BT_DEFAULT_BUFFER_SIZE);
+  EXPECT_FALSE(pool_allocator_free(ptr));
+  EXPECT_EQ((size_t)0, pool_allocator_block_size(ptr));
+  free(ptr);
+
+  EXPECT_FALSE(pool_allocator_free(NULL));
+}
+
+TEST_F(PoolAllocatorTest, test_osi_calloc_zeroes_reused_block) {
+  uint8_t* ptr = static_cast<uint8_t*>(osi_malloc(BT_DEFAULT_BUFFER_SIZE));
+  memset(ptr, 0xAA, BT_DEFAULT_BUFFER_SIZE);
+  osi_free(ptr);
+
+  ptr = static_cast<uint8_t*>(osi_calloc(BT_DEFAULT_BUFFER_SIZE));
+  for (size_t i = 0; i < BT_DEFAULT_BUFFER_SIZE; i++) {
+    ASSERT_EQ(0, ptr[i]) << "at offset " << i;
+  }
+  osi_free(ptr);
+}
+
+TEST_F(PoolAllocatorTest, test_cross_thread_free) {
+  const size_t kCount = 100;
+  std::vector<void*> buffers;
+  for (size_t i = 0; i < kCount; i++)
+    buffers.push_back(osi_malloc(BT_DEFAULT_BUFFER_SIZE));
+
+  std::thread freeing_thread([&buffers]() {
+    for (void* ptr : buffers) osi_free(ptr);
+  });
+  freeing_thread.join();
+
+  // Blocks spilled by the exiting thread must be reusable from here.
+  for (size_t i = 0; i < kCount; i++)
+    buffers[i] = osi_malloc(BT_DEFAULT_BUFFER_SIZE);
+  for (void* ptr : buffers) osi_free(ptr);
+}
@@ -111,3 +111,46 @@ TEST_F(ReactorTest, reactor_unregister_from_separate_thread) {
   close(fd);
   reactor_free(reactor);
 }
+
+typedef struct {
+  int read_count;
+  int pending_count;
+} batch_arg_t;
+
+static void batch_read_cb(void* context) {
+  ((batch_arg_t*)context)->read_count++;
+}
+
+static bool batch_pending_cb(void* context) {
+  batch_arg_t* arg = (batch_arg_t*)context;
+  return arg->read_count < arg->pending_count;
+}
+
+TEST_F(ReactorTest, reactor_read_batch) {
+  reactor_t* reactor = reactor_new();
+
+  int fd = eventfd(1, 0);
+  batch_arg_t arg = {0, 5};
+  reactor_object_t* object =
+      reactor_register(reactor, fd, &arg, batch_read_cb, NULL);
+
+  // Without batching there is one callback per wakeup
+  reactor_run_once(reactor);
+  EXPECT_EQ(arg.read_count, 1);
+
+  // Callbacks continue while input is pending...
+  arg.read_count = 0;
+  reactor_set_read_batch(object, batch_pending_cb, 8);
+  reactor_run_once(reactor);
+  EXPECT_EQ(arg.read_count, 5);
+
+  // ...but no more than the batch size per wakeup
+  arg.read_count = 0;
+  arg.pending_count = 20;
+  reactor_run_once(reactor);
+  EXPECT_EQ(arg.read_count, 8);
+
+  reactor_unregister(object);
+  close(fd);
+  reactor_free(reactor);
+}
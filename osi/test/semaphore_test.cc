@@ -70,6 +70,15 @@ TEST_F(SemaphoreTest, test_wait_after_post) {
   semaphore_free(semaphore);
 }
 
+TEST_F(SemaphoreTest, test_post_count) {
+  semaphore_t* semaphore = semaphore_new(0);
+  ASSERT_TRUE(semaphore != NULL);
+  semaphore_post_count(semaphore, 3);
+  for (int i = 0; i < 3; i++) EXPECT_TRUE(semaphore_try_wait(semaphore));
+  EXPECT_FALSE(semaphore_try_wait(semaphore));
+  semaphore_free(semaphore);
+}
+
 TEST_F(SemaphoreTest, test_ensure_wait) {
   semaphore_t* semaphore = semaphore_new(0);
   ASSERT_TRUE(semaphore != NULL);
@@ -0,0 +1,204 @@
+#include <gtest/gtest.h>
+
+#include <errno.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <thread>
+
+#include "osi/include/osi.h"
+#include "osi/include/shm_ring.h"
+
+static void fill(uint8_t* buf, size_t len, uint8_t seed) {
+  for (size_t i = 0; i < len; i++) buf[i] = (uint8_t)(seed + i);
+}
+
+TEST(ShmRingTest, test_new_attach) {
+  shm_ring_t* writer = shm_ring_new(100);
+  ASSERT_TRUE(writer != NULL);
+  EXPECT_NE(INVALID_FD, shm_ring_get_fd(writer));
+  EXPECT_EQ((size_t)100, shm_ring_capacity(writer));
+  EXPECT_FALSE(shm_ring_is_attached(writer));
+
+  shm_ring_t* reader = shm_ring_attach(shm_ring_get_fd(writer));
+  ASSERT_TRUE(reader != NULL);
+  EXPECT_EQ(INVALID_FD, shm_ring_get_fd(reader));
+  EXPECT_EQ((size_t)100, shm_ring_capacity(reader));
+  EXPECT_EQ((size_t)0, shm_ring_bytes_available(reader));
+  EXPECT_FALSE(shm_ring_is_closed(reader));
+  EXPECT_TRUE(shm_ring_is_attached(writer));
+
+  shm_ring_free(reader);
+  shm_ring_free(writer);
+  shm_ring_free(NULL);
+}
+
+TEST(ShmRingTest, test_attach_invalid) {
+  int fds[2];
+  ASSERT_EQ(0, pipe(fds));
+  EXPECT_TRUE(shm_ring_attach(fds[0]) == NULL);
+  close(fds[0]);
+  close(fds[1]);
+}
+
+TEST(ShmRingTest, test_write_read_wrap) {
+  shm_ring_t* writer = shm_ring_new(100);
+  shm_ring_t* reader = shm_ring_attach(shm_ring_get_fd(writer));
+  ASSERT_TRUE(reader != NULL);
+
+  // Positions wrap around the 128 byte buffer several times
+  uint8_t in[70];
+  uint8_t out[70];
+  for (int i = 0; i < 10; i++) {
+    fill(in, sizeof(in), i);
+    EXPECT_EQ((ssize_t)sizeof(in), shm_ring_write(writer, in, sizeof(in), 0));
+    EXPECT_EQ(sizeof(in), shm_ring_bytes_available(reader));
+    memset(out, 0, sizeof(out));
+    EXPECT_EQ((ssize_t)sizeof(out), shm_ring_read(reader, out, sizeof(out), 0));
+    EXPECT_EQ(0, memcmp(in, out, sizeof(in)));
+  }
+
+  shm_ring_free(reader);
+  shm_ring_free(writer);
+}
+
+TEST(ShmRingTest, test_full_and_empty) {
+  shm_ring_t* writer = shm_ring_new(100);
+  shm_ring_t* reader = shm_ring_attach(shm_ring_get_fd(writer));
+  ASSERT_TRUE(reader != NULL);
+
+  uint8_t buf[150];
+  fill(buf, sizeof(buf), 0);
+  // Only the capacity is used, not the whole power of two buffer
+  EXPECT_EQ(100, shm_ring_write(writer, buf, sizeof(buf), 0));
+  EXPECT_EQ(0, shm_ring_write(writer, buf, sizeof(buf), 10));
+
+  uint8_t out[150];
+  EXPECT_EQ(100, shm_ring_read(reader, out, sizeof(out), 10));
+  EXPECT_EQ(0, memcmp(buf, out, 100));
+  EXPECT_EQ(0, shm_ring_read(reader, out, sizeof(out), 0));
+
+  shm_ring_free(reader);
+  shm_ring_free(writer);
+}
+
+TEST(ShmRingTest, test_flush) {
+  shm_ring_t* writer = shm_ring_new(64);
+  shm_ring_t* reader = shm_ring_attach(shm_ring_get_fd(writer));
+  ASSERT_TRUE(reader != NULL);
+
+  uint8_t buf[40] = {0};
+  EXPECT_EQ(40, shm_ring_write(writer, buf, sizeof(buf), 0));
+  shm_ring_flush(reader);
+  EXPECT_EQ((size_t)0, shm_ring_bytes_available(reader));
+  EXPECT_EQ(0, shm_ring_read(reader, buf, sizeof(buf), 0));
+  EXPECT_EQ(40, shm_ring_write(writer, buf, sizeof(buf), 0));
+
+  shm_ring_free(reader);
+  shm_ring_free(writer);
+}
+
+TEST(ShmRingTest, test_close) {
+  shm_ring_t* writer = shm_ring_new(64);
+  shm_ring_t* reader = shm_ring_attach(shm_ring_get_fd(writer));
+  ASSERT_TRUE(reader != NULL);
+
+  uint8_t buf[16] = {0};
+  EXPECT_EQ(16, shm_ring_write(writer, buf, sizeof(buf), 0));
+  shm_ring_close(reader);
+  EXPECT_TRUE(shm_ring_is_closed(writer));
+
+  errno = 0;
+  EXPECT_EQ(-1, shm_ring_write(writer, buf, sizeof(buf), 0));
+  EXPECT_EQ(EPIPE, errno);
+
+  // Data written before the close is still delivered
+  EXPECT_EQ(16, shm_ring_read(reader, buf, sizeof(buf), 100));
+  errno = 0;
+  EXPECT_EQ(-1, shm_ring_read(reader, buf, sizeof(buf), 100));
+  EXPECT_EQ(EPIPE, errno);
+
+  shm_ring_free(reader);
+  shm_ring_free(writer);
+}
+
+TEST(ShmRingTest, test_close_wakes_reader) {
+  shm_ring_t* writer = shm_ring_new(64);
+  shm_ring_t* reader = shm_ring_attach(shm_ring_get_fd(writer));
+  ASSERT_TRUE(reader != NULL);
+
+  std::thread closer([writer]() {
+    usleep(10000);
+    shm_ring_close(writer);
+  });
+  uint8_t buf[16];
+  // Returns well before the timeout
+  EXPECT_EQ(-1, shm_ring_read(reader, buf, sizeof(buf), 100000));
+  closer.join();
+
+  shm_ring_free(reader);
+  shm_ring_free(writer);
+}
+
+TEST(ShmRingTest, test_blocking_transfer) {
+  shm_ring_t* writer = shm_ring_new(1000);
+  shm_ring_t* reader = shm_ring_attach(shm_ring_get_fd(writer));
+  ASSERT_TRUE(reader != NULL);
+
+  // Both sides block on each other: the transfer is larger than the ring
+  const size_t total = 100000;
+  std::thread producer([writer, total]() {
+    uint8_t buf[333];
+    for (size_t sent = 0; sent < total;) {
+      size_t len = std::min(sizeof(buf), total - sent);
+      fill(buf, len, (uint8_t)sent);
+      ASSERT_EQ((ssize_t)len, shm_ring_write(writer, buf, len, 1000));
+      sent += len;
+    }
+  });
+
+  uint8_t buf[500];
+  uint8_t expected[500];
+  for (size_t received = 0; received < total;) {
+    size_t len = std::min(sizeof(buf), total - received);
+    ASSERT_EQ((ssize_t)len, shm_ring_read(reader, buf, len, 1000));
+    fill(expected, len, (uint8_t)received);
+    ASSERT_EQ(0, memcmp(expected, buf, len));
+    received += len;
+  }
+  producer.join();
+
+  shm_ring_free(reader);
+  shm_ring_free(writer);
+}
+
+TEST(ShmRingTest, test_across_processes) {
+  shm_ring_t* reader = shm_ring_new(256);
+  ASSERT_TRUE(reader != NULL);
+
+  pid_t pid = fork();
+  ASSERT_NE(-1, pid);
+  if (pid == 0) {
+    shm_ring_t* writer = shm_ring_attach(shm_ring_get_fd(reader));
+    uint8_t buf[100];
+    bool success = writer != NULL;
+    for (int i = 0; success && i < 100; i++) {
+      fill(buf, sizeof(buf), i);
+      success = shm_ring_write(writer, buf, sizeof(buf), 1000) == 100;
+    }
+    _exit(success ? 0 : 1);
+  }
+
+  uint8_t buf[100];
+  uint8_t expected[100];
+  for (int i = 0; i < 100; i++) {
+    ASSERT_EQ(100, shm_ring_read(reader, buf, sizeof(buf), 1000));
+    fill(expected, sizeof(expected), i);
+    ASSERT_EQ(0, memcmp(expected, buf, sizeof(buf)));
+  }
+
+  int status = 0;
+  ASSERT_EQ(pid, waitpid(pid, &status, 0));
+  EXPECT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(0, WEXITSTATUS(status));
+  shm_ring_free(reader);
+}
@@ -0,0 +1,153 @@
+#include <gtest/gtest.h>
+
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#include "osi/include/osi.h"
+#include "osi/include/spsc_ringbuffer.h"
+
+static void fill(uint8_t* buf, size_t len, uint8_t seed) {
+  for (size_t i = 0; i < len; i++) buf[i] = (uint8_t)(seed + i);
+}
+
+TEST(SpscRingbufferTest, test_new_simple) {
+  spsc_ringbuffer_t* rb = spsc_ringbuffer_init(100);
+  ASSERT_TRUE(rb != NULL);
+  EXPECT_EQ((size_t)100, spsc_ringbuffer_available(rb));
+  EXPECT_EQ((size_t)0, spsc_ringbuffer_size(rb));
+  spsc_ringbuffer_free(rb);
+
+  EXPECT_TRUE(spsc_ringbuffer_init(0) == NULL);
+  spsc_ringbuffer_free(NULL);
+}
+
+TEST(SpscRingbufferTest, test_insert_pop_full) {
+  spsc_ringbuffer_t* rb = spsc_ringbuffer_init(5);
+
+  uint8_t aa[] = {0xAA, 0xAA, 0xAA, 0xAA, 0xAA, 0xAA, 0xAA};
+  EXPECT_EQ((size_t)5, spsc_ringbuffer_insert(rb, aa, 7));
+  EXPECT_EQ((size_t)0, spsc_ringbuffer_available(rb));
+  EXPECT_EQ((size_t)0, spsc_ringbuffer_insert(rb, aa, 1));
+
+  uint8_t out[7] = {0};
+  EXPECT_EQ((size_t)5, spsc_ringbuffer_pop(rb, out, 7));
+  EXPECT_EQ(0, memcmp(aa, out, 5));
+  EXPECT_EQ((size_t)0, spsc_ringbuffer_size(rb));
+  EXPECT_EQ((size_t)0, spsc_ringbuffer_pop(rb, out, 1));
+
+  spsc_ringbuffer_free(rb);
+}
+
+TEST(SpscRingbufferTest, test_wraparound) {
+  spsc_ringbuffer_t* rb = spsc_ringbuffer_init(16);
+
+  uint8_t in[12];
+  uint8_t out[12];
+  for (int round = 0; round < 10; round++) {
+    fill(in, sizeof(in), round);
+    ASSERT_EQ(sizeof(in), spsc_ringbuffer_insert(rb, in, sizeof(in)));
+    ASSERT_EQ(sizeof(out), spsc_ringbuffer_pop(rb, out, sizeof(out)));
+    EXPECT_EQ(0, memcmp(in, out, sizeof(in)));
+  }
+
+  spsc_ringbuffer_free(rb);
+}
+
+TEST(SpscRingbufferTest, test_delete) {
+  spsc_ringbuffer_t* rb = spsc_ringbuffer_init(16);
+
+  uint8_t in[10];
+  fill(in, sizeof(in), 0);
+  spsc_ringbuffer_insert(rb, in, sizeof(in));
+  EXPECT_EQ((size_t)4, spsc_ringbuffer_delete(rb, 4));
+  EXPECT_EQ((size_t)6, spsc_ringbuffer_size(rb));
+
+  uint8_t out[6];
+  EXPECT_EQ((size_t)6, spsc_ringbuffer_pop(rb, out, sizeof(out)));
+  EXPECT_EQ(0, memcmp(in + 4, out, sizeof(out)));
+  EXPECT_EQ((size_t)0, spsc_ringbuffer_delete(rb, 1));
+
+  spsc_ringbuffer_free(rb);
+}
+
+TEST(SpscRingbufferTest, test_reserve_peek_commit) {
+  spsc_ringbuffer_t* rb = spsc_ringbuffer_init(16);
+
+  // Move both positions to 12, so the space wraps after 4 bytes
+  uint8_t in[12];
+  fill(in, sizeof(in), 0);
+  spsc_ringbuffer_insert(rb, in, sizeof(in));
+  spsc_ringbuffer_delete(rb, sizeof(in));
+
+  uint8_t* space;
+  EXPECT_EQ((size_t)4, spsc_ringbuffer_write_reserve(rb, &space));
+  fill(space, 4, 0x10);
+  spsc_ringbuffer_write_commit(rb, 4);
+
+  EXPECT_EQ((size_t)12, spsc_ringbuffer_write_reserve(rb, &space));
+  fill(space, 3, 0x14);
+  spsc_ringbuffer_write_commit(rb, 3);
+  EXPECT_EQ((size_t)7, spsc_ringbuffer_size(rb));
+
+  const uint8_t* data;
+  uint8_t expected[7];
+  fill(expected, sizeof(expected), 0x10);
+  EXPECT_EQ((size_t)4, spsc_ringbuffer_read_peek(rb, &data));
+  EXPECT_EQ(0, memcmp(expected, data, 4));
+  spsc_ringbuffer_read_commit(rb, 2);
+
+  EXPECT_EQ((size_t)2, spsc_ringbuffer_read_peek(rb, &data));
+  EXPECT_EQ(0, memcmp(expected + 2, data, 2));
+  spsc_ringbuffer_read_commit(rb, 2);
+
+  EXPECT_EQ((size_t)3, spsc_ringbuffer_read_peek(rb, &data));
+  EXPECT_EQ(0, memcmp(expected + 4, data, 3));
+  spsc_ringbuffer_read_commit(rb, 3);
+
+  EXPECT_EQ((size_t)0, spsc_ringbuffer_read_peek(rb, &data));
+  EXPECT_EQ((size_t)16, spsc_ringbuffer_available(rb));
+
+  spsc_ringbuffer_free(rb);
+}
+
+TEST(SpscRingbufferTest, test_two_threads) {
+  spsc_ringbuffer_t* rb = spsc_ringbuffer_init(1000);
+  const size_t total = 1 << 20;
+
+  std::thread producer([rb, total]() {
+    uint8_t chunk[333];
+    size_t sent = 0;
+    while (sent < total) {
+      size_t len = std::min(sizeof(chunk), total - sent);
+      fill(chunk, len, (uint8_t)sent);
+      size_t done = 0;
+      while (done < len) {
+        done += spsc_ringbuffer_insert(rb, chunk + done, len - done);
+        if (done < len) std::this_thread::yield();
+      }
+      sent += len;
+    }
+  });
+
+  std::vector<uint8_t> received;
+  received.reserve(total);
+  while (received.size() < total) {
+    const uint8_t* data;
+    size_t len = spsc_ringbuffer_read_peek(rb, &data);
+    if (len == 0) {
+      std::this_thread::yield();
+      continue;
+    }
+    received.insert(received.end(), data, data + len);
+    spsc_ringbuffer_read_commit(rb, len);
+  }
+  producer.join();
+
+  for (size_t i = 0; i < total; i++) {
+    ASSERT_EQ((uint8_t)i, received[i]) << "at " << i;
+  }
+  EXPECT_EQ((size_t)0, spsc_ringbuffer_size(rb));
+
+  spsc_ringbuffer_free(rb);
+}
@@ -4,6 +4,8 @@
 
 #include <sys/select.h>
 
+#include <vector>
+
 #include "osi/include/osi.h"
 #include "osi/include/reactor.h"
 #include "osi/include/thread.h"
@@ -55,3 +57,29 @@ TEST_F(ThreadTest, test_thread_is_not_self) {
   EXPECT_FALSE(thread_is_self(thread));
   thread_free(thread);
 }
+
+static std::vector<size_t> run_order;
+
+static void record_order_fn(void* context) {
+  run_order.push_back(*(size_t*)context);
+}
+
+// Longer than the work queue, and than the work items a thread keeps
+TEST_F(ThreadTest, test_post_batch_in_order) {
+  thread_t* thread = thread_new_sized("test_thread", 8);
+  std::vector<size_t> values(1000);
+  std::vector<void*> contexts;
+  for (size_t i = 0; i < values.size(); i++) {
+    values[i] = i;
+    contexts.push_back(&values[i]);
+  }
+  run_order.clear();
+
+  thread_post(thread, record_order_fn, &values[0]);
+  EXPECT_TRUE(thread_post_batch(thread, record_order_fn, contexts.data() + 1,
+                                contexts.size() - 1));
+  EXPECT_TRUE(thread_post_batch(thread, record_order_fn, NULL, 0));
+  thread_free(thread);
+
+  EXPECT_EQ(run_order, values);
+}
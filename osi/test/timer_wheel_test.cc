@@ -0,0 +1,277 @@
+#include <gtest/gtest.h>
+
+#include <stdlib.h>
+#include <algorithm>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "osi/include/osi.h"
+#include "osi/include/timer_wheel.h"
+
+namespace {
+
+struct TestTimer {
+  timer_wheel_entry_t entry;
+  int id;
+};
+
+static bool record_cb(void* data, void* context) {
+  std::vector<int>* expired = static_cast<std::vector<int>*>(context);
+  expired->push_back(static_cast<TestTimer*>(data)->id);
+  return true;
+}
+
+}  // namespace
+
+TEST(TimerWheelTest, test_new_free_simple) {
+  timer_wheel_t* wheel = timer_wheel_new();
+  ASSERT_TRUE(wheel != NULL);
+  EXPECT_TRUE(timer_wheel_is_empty(wheel));
+  EXPECT_EQ(timer_wheel_length(wheel), 0u);
+  uint64_t deadline_ms;
+  EXPECT_FALSE(timer_wheel_next_deadline(wheel, &deadline_ms));
+  timer_wheel_free(wheel);
+}
+
+TEST(TimerWheelTest, test_free_null) { timer_wheel_free(NULL); }
+
+TEST(TimerWheelTest, test_add_remove) {
+  timer_wheel_t* wheel = timer_wheel_new();
+  TestTimer timer = {};
+
+  timer_wheel_add(wheel, &timer.entry, 1000, &timer);
+  EXPECT_TRUE(timer_wheel_entry_is_pending(&timer.entry));
+  EXPECT_EQ(timer_wheel_length(wheel), 1u);
+
+  timer_wheel_remove(wheel, &timer.entry);
+  EXPECT_FALSE(timer_wheel_entry_is_pending(&timer.entry));
+  EXPECT_TRUE(timer_wheel_is_empty(wheel));
+
+  // Removing again is a no-op
+  timer_wheel_remove(wheel, &timer.entry);
+  EXPECT_TRUE(timer_wheel_is_empty(wheel));
+
+  std::vector<int> expired;
+  EXPECT_EQ(timer_wheel_expire(wheel, 2000, record_cb, &expired), 0u);
+  EXPECT_TRUE(expired.empty());
+
+  timer_wheel_free(wheel);
+}
+
+TEST(TimerWheelTest, test_reschedule) {
+  timer_wheel_t* wheel = timer_wheel_new();
+  TestTimer timer = {{}, 1};
+
+  timer_wheel_add(wheel, &timer.entry, 100, &timer);
+  timer_wheel_add(wheel, &timer.entry, 300, &timer);
+  EXPECT_EQ(timer_wheel_length(wheel), 1u);
+
+  uint64_t deadline_ms;
+  ASSERT_TRUE(timer_wheel_next_deadline(wheel, &deadline_ms));
+  EXPECT_EQ(deadline_ms, 300u);
+
+  std::vector<int> expired;
+  EXPECT_EQ(timer_wheel_expire(wheel, 299, record_cb, &expired), 0u);
+  EXPECT_EQ(timer_wheel_expire(wheel, 300, record_cb, &expired), 1u);
+  EXPECT_EQ(expired, std::vector<int>({1}));
+  EXPECT_FALSE(timer_wheel_entry_is_pending(&timer.entry));
+
+  timer_wheel_free(wheel);
+}
+
+TEST(TimerWheelTest, test_expire_in_deadline_order) {
+  timer_wheel_t* wheel = timer_wheel_new();
+  const uint64_t deadlines[] = {5000000, 70, 4096, 1, 262144, 65, 4095, 64};
+  TestTimer timers[8];
+  for (int i = 0; i < 8; i++) {
+    timers[i] = TestTimer{{}, i};
+    timer_wheel_add(wheel, &timers[i].entry, deadlines[i], &timers[i]);
+  }
+
+  std::vector<int> expired;
+  EXPECT_EQ(timer_wheel_expire(wheel, 10000000, record_cb, &expired), 8u);
+  EXPECT_EQ(expired, std::vector<int>({3, 7, 5, 1, 6, 2, 4, 0}));
+  EXPECT_TRUE(timer_wheel_is_empty(wheel));
+
+  timer_wheel_free(wheel);
+}
+
+// Timers sharing a deadline are reported in the order they were added, even
+// when the earlier ones had to be cascaded from coarser levels.
+TEST(TimerWheelTest, test_same_deadline_in_add_order) {
+  timer_wheel_t* wheel = timer_wheel_new();
+  TestTimer timers[3] = {{{}, 0}, {{}, 1}, {{}, 2}};
+  std::vector<int> expired;
+
+  // The first timer starts on level 1, the others go straight to level 0.
+  timer_wheel_add(wheel, &timers[0].entry, 100, &timers[0]);
+  timer_wheel_expire(wheel, 40, record_cb, &expired);
+  timer_wheel_add(wheel, &timers[1].entry, 100, &timers[1]);
+  timer_wheel_add(wheel, &timers[2].entry, 100, &timers[2]);
+  EXPECT_TRUE(expired.empty());
+
+  EXPECT_EQ(timer_wheel_expire(wheel, 100, record_cb, &expired), 3u);
+  EXPECT_EQ(expired, std::vector<int>({0, 1, 2}));
+
+  timer_wheel_free(wheel);
+}
+
+TEST(TimerWheelTest, test_past_deadline_expires_next) {
+  timer_wheel_t* wheel = timer_wheel_new();
+  TestTimer timers[2] = {{{}, 0}, {{}, 1}};
+  std::vector<int> expired;
+
+  timer_wheel_expire(wheel, 1000, record_cb, &expired);
+  timer_wheel_add(wheel, &timers[0].entry, 1000, &timers[0]);
+  timer_wheel_add(wheel, &timers[1].entry, 10, &timers[1]);
+
+  uint64_t deadline_ms;
+  ASSERT_TRUE(timer_wheel_next_deadline(wheel, &deadline_ms));
+  EXPECT_EQ(deadline_ms, 10u);
+
+  EXPECT_EQ(timer_wheel_expire(wheel, 1000, record_cb, &expired), 2u);
+  EXPECT_EQ(expired, std::vector<int>({1, 0}));
+
+  timer_wheel_free(wheel);
+}
+
+TEST(TimerWheelTest, test_far_deadline) {
+  timer_wheel_t* wheel = timer_wheel_new();
+  TestTimer timers[2] = {{{}, 0}, {{}, 1}};
+  const uint64_t kFar = 1ULL << 50;
+
+  timer_wheel_add(wheel, &timers[0].entry, kFar, &timers[0]);
+  timer_wheel_add(wheel, &timers[1].entry, kFar - 1, &timers[1]);
+
+  uint64_t deadline_ms;
+  ASSERT_TRUE(timer_wheel_next_deadline(wheel, &deadline_ms));
+  EXPECT_EQ(deadline_ms, kFar - 1);
+
+  std::vector<int> expired;
+  EXPECT_EQ(timer_wheel_expire(wheel, kFar - 2, record_cb, &expired), 0u);
+  EXPECT_EQ(timer_wheel_expire(wheel, kFar, record_cb, &expired), 2u);
+  EXPECT_EQ(expired, std::vector<int>({1, 0}));
+
+  timer_wheel_free(wheel);
+}
+
+namespace {
+
+struct RescheduleContext {
+  timer_wheel_t* wheel;
+  TestTimer* other;
+  int count;
+};
+
+static bool reschedule_cb(void* data, void* context) {
+  RescheduleContext* ctx = static_cast<RescheduleContext*>(context);
+  TestTimer* timer = static_cast<TestTimer*>(data);
+  ctx->count++;
+  // Re-arm self and cancel the other timer of the same batch
+  timer_wheel_add(ctx->wheel, &timer->entry, 500, timer);
+  timer_wheel_remove(ctx->wheel, &ctx->other->entry);
+  return true;
+}
+
+}  // namespace
+
+TEST(TimerWheelTest, test_modify_from_callback) {
+  timer_wheel_t* wheel = timer_wheel_new();
+  TestTimer timers[2] = {{{}, 0}, {{}, 1}};
+  RescheduleContext ctx = {wheel, &timers[1], 0};
+
+  timer_wheel_add(wheel, &timers[0].entry, 100, &timers[0]);
+  timer_wheel_add(wheel, &timers[1].entry, 100, &timers[1]);
+
+  EXPECT_EQ(timer_wheel_expire(wheel, 100, reschedule_cb, &ctx), 1u);
+  EXPECT_EQ(ctx.count, 1);
+  EXPECT_TRUE(timer_wheel_entry_is_pending(&timers[0].entry));
+  EXPECT_FALSE(timer_wheel_entry_is_pending(&timers[1].entry));
+  EXPECT_EQ(timer_wheel_length(wheel), 1u);
+
+  uint64_t deadline_ms;
+  ASSERT_TRUE(timer_wheel_next_deadline(wheel, &deadline_ms));
+  EXPECT_EQ(deadline_ms, 500u);
+
+  timer_wheel_free(wheel);
+}
+
+TEST(TimerWheelTest, test_foreach) {
+  timer_wheel_t* wheel = timer_wheel_new();
+  TestTimer timers[3] = {{{}, 0}, {{}, 1}, {{}, 2}};
+  timer_wheel_add(wheel, &timers[0].entry, 10, &timers[0]);
+  timer_wheel_add(wheel, &timers[1].entry, 100000, &timers[1]);
+  timer_wheel_add(wheel, &timers[2].entry, 1000, &timers[2]);
+
+  std::vector<int> visited;
+  timer_wheel_foreach(wheel, record_cb, &visited);
+  std::sort(visited.begin(), visited.end());
+  EXPECT_EQ(visited, std::vector<int>({0, 1, 2}));
+
+  timer_wheel_free(wheel);
+  EXPECT_FALSE(timer_wheel_entry_is_pending(&timers[0].entry));
+}
+
+// Compares the wheel against a sorted reference while timers are added,
+// rescheduled and removed at random with deadlines spanning several levels.
+TEST(TimerWheelTest, test_random_against_reference) {
+  const int kTimers = 200;
+  timer_wheel_t* wheel = timer_wheel_new();
+  TestTimer timers[kTimers];
+  std::map<int, std::pair<uint64_t, uint64_t>> reference;  // id -> order
+  uint64_t order = 0;
+  uint64_t now_ms = 123456;
+  for (int i = 0; i < kTimers; i++) timers[i] = TestTimer{{}, i};
+
+  srand(42);
+  for (int round = 0; round < 2000; round++) {
+    for (int n = 0; n < 5; n++) {
+      int id = rand() % kTimers;
+      if (rand() % 4 == 0) {
+        timer_wheel_remove(wheel, &timers[id].entry);
+        reference.erase(id);
+      } else {
+        const uint64_t spans[] = {64, 4096, 262144, 16777216};
+        uint64_t deadline_ms = now_ms + rand() % spans[rand() % 4];
+        timer_wheel_add(wheel, &timers[id].entry, deadline_ms, &timers[id]);
+        reference[id] = std::make_pair(deadline_ms, order++);
+      }
+    }
+    ASSERT_EQ(timer_wheel_length(wheel), reference.size());
+
+    uint64_t deadline_ms = 0;
+    if (reference.empty()) {
+      EXPECT_FALSE(timer_wheel_next_deadline(wheel, &deadline_ms));
+    } else {
+      uint64_t earliest = UINT64_MAX;
+      for (const auto& it : reference)
+        earliest = std::min(earliest, it.second.first);
+      ASSERT_TRUE(timer_wheel_next_deadline(wheel, &deadline_ms));
+      ASSERT_EQ(deadline_ms, earliest);
+    }
+
+    // Jump ahead to the next deadline or further
+    if (rand() % 2 && !reference.empty()) {
+      now_ms = deadline_ms;
+    } else {
+      now_ms += rand() % 10000;
+    }
+
+    std::map<std::pair<uint64_t, uint64_t>, int> by_order;
+    for (const auto& it : reference) {
+      if (it.second.first <= now_ms) by_order[it.second] = it.first;
+    }
+    std::vector<int> expected;
+    for (const auto& it : by_order) {
+      expected.push_back(it.second);
+      reference.erase(it.second);
+    }
+
+    std::vector<int> expired;
+    timer_wheel_expire(wheel, now_ms, record_cb, &expired);
+    ASSERT_EQ(expired, expected) << "round " << round;
+  }
+
+  timer_wheel_free(wheel);
+}
@@ -24,14 +24,21 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 
+#include <atomic>
+#include <chrono>
+#include <thread>
+
 #include "osi/include/wakelock.h"
 
 #include "AllocationTestHarness.h"
 
-static bool is_wake_lock_acquired = false;
+// Released from the hold-off timer thread too
+static std::atomic<bool> is_wake_lock_acquired(false);
+static std::atomic<int> wake_lock_acquired_count(0);
 
 static int acquire_wake_lock_cb(const char* lock_name) {
   is_wake_lock_acquired = true;
+  wake_lock_acquired_count++;
   return BT_STATUS_SUCCESS;
 }
 
@@ -70,7 +77,9 @@ class WakelockTest : public AllocationTestHarness {
   }
 
   void TearDown() override {
+    wakelock_set_release_holdoff_ms(0);
     is_wake_lock_acquired = false;
+    wake_lock_acquired_count = 0;
     wakelock_cleanup();
     wakelock_set_os_callouts(NULL);
 
@@ -155,3 +164,54 @@ TEST_F(WakelockTest, test_set_paths) {
     ASSERT_FALSE(IsFileWakeLockAcquired());
   }
 }
+
+TEST_F(WakelockTest, test_nested_holds) {
+  wakelock_set_os_callouts(&bt_wakelock_callouts);
+
+  ASSERT_TRUE(wakelock_acquire_for(WAKELOCK_REASON_ALARM));
+  ASSERT_TRUE(wakelock_acquire_for(WAKELOCK_REASON_A2DP_SOURCE));
+  ASSERT_TRUE(wakelock_acquire_for(WAKELOCK_REASON_A2DP_SOURCE));
+  EXPECT_EQ(1, wake_lock_acquired_count);
+
+  EXPECT_TRUE(wakelock_release_for(WAKELOCK_REASON_ALARM));
+  EXPECT_TRUE(is_wake_lock_acquired);
+  EXPECT_TRUE(wakelock_release_for(WAKELOCK_REASON_A2DP_SOURCE));
+  EXPECT_TRUE(is_wake_lock_acquired);
+  EXPECT_TRUE(wakelock_release_for(WAKELOCK_REASON_A2DP_SOURCE));
+  EXPECT_FALSE(is_wake_lock_acquired);
+}
+
+TEST_F(WakelockTest, test_unbalanced_release_keeps_other_holds) {
+  wakelock_set_os_callouts(&bt_wakelock_callouts);
+
+  ASSERT_TRUE(wakelock_acquire_for(WAKELOCK_REASON_ALARM));
+  EXPECT_FALSE(wakelock_release_for(WAKELOCK_REASON_HEARING_AID));
+  EXPECT_FALSE(wakelock_release());
+  EXPECT_TRUE(is_wake_lock_acquired);
+
+  EXPECT_TRUE(wakelock_release_for(WAKELOCK_REASON_ALARM));
+  EXPECT_FALSE(is_wake_lock_acquired);
+}
+
+TEST_F(WakelockTest, test_release_holdoff) {
+  wakelock_set_os_callouts(&bt_wakelock_callouts);
+  wakelock_set_release_holdoff_ms(50);
+
+  // A burst of holds acquires the wakelock once
+  for (size_t i = 0; i < 100; i++) {
+    ASSERT_TRUE(wakelock_acquire_for(WAKELOCK_REASON_ALARM));
+    ASSERT_TRUE(wakelock_release_for(WAKELOCK_REASON_ALARM));
+    ASSERT_TRUE(is_wake_lock_acquired);
+  }
+  EXPECT_EQ(1, wake_lock_acquired_count);
+
+  // And releases it once the hold-off is over
+  for (int i = 0; i < 100 && is_wake_lock_acquired; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_FALSE(is_wake_lock_acquired);
+
+  ASSERT_TRUE(wakelock_acquire_for(WAKELOCK_REASON_ALARM));
+  EXPECT_EQ(2, wake_lock_acquired_count);
+  EXPECT_TRUE(wakelock_release_for(WAKELOCK_REASON_ALARM));
+}
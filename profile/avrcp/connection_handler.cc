@@ -18,6 +18,7 @@
 
 #include <base/bind.h>
 #include <base/logging.h>
+#include <string.h>
 #include <map>
 
 #include "avrc_defs.h"
@@ -521,7 +522,8 @@ void ConnectionHandler::SdpCb(RawAddress bdaddr, SdpCallback cb,
 void ConnectionHandler::SendMessage(
     uint8_t handle, uint8_t label, bool browse,
     std::unique_ptr<::bluetooth::PacketBuilder> message) {
-  std::shared_ptr<::bluetooth::Packet> packet = VectorPacket::Make();
+  auto vector_packet = VectorPacket::Make();
+  std::shared_ptr<::bluetooth::Packet> packet = vector_packet;
   message->Serialize(packet);
 
   uint8_t ctype = AVRC_RSP_ACCEPT;
@@ -532,7 +534,11 @@ void ConnectionHandler::SendMessage(
 
   DLOG(INFO) << "SendMessage to handle=" << loghex(handle);
 
-  BT_HDR* pkt = (BT_HDR*)osi_malloc(BT_DEFAULT_BUFFER_SIZE);
+  // Size the buffer for the message and the AVCTP and L2CAP headers, so that
+  // small responses come from a small pool and large ones are never truncated.
+  // The AVRC layer sends its last fragment from this buffer.
+  BT_HDR* pkt =
+      (BT_HDR*)osi_malloc(BT_HDR_SIZE + AVCT_MSG_OFFSET + packet->size());
 
   pkt->offset = AVCT_MSG_OFFSET;
   // TODO (apanicke): Update this constant. Currently this is a unique event
@@ -554,10 +560,8 @@ void ConnectionHandler::SendMessage(
   }
 
   pkt->len = packet->size();
-  uint8_t* p_data = (uint8_t*)(pkt + 1) + pkt->offset;
-  for (auto it = packet->begin(); it != packet->end(); it++) {
-    *p_data++ = *it;
-  }
+  memcpy((uint8_t*)(pkt + 1) + pkt->offset, vector_packet->GetData().data(),
+         pkt->len);
 
   avrc_->MsgReq(handle, label, ctype, pkt);
 }
@@ -65,6 +65,8 @@ base::WeakPtr<Device> Device::Get() {
 void Device::SetBrowseMtu(uint16_t browse_mtu) {
   DEVICE_LOG(INFO) << __PRETTY_FUNCTION__ << ": browse_mtu = " << browse_mtu;
   browse_mtu_ = browse_mtu;
+  // The cached browsing responses were sized for the previous MTU
+  response_cache_.Clear();
 }
 
 bool Device::IsActive() const {
@@ -152,8 +154,12 @@ void Device::VendorPacketHandler(uint8_t label,
         auto response = RejectBuilder::MakeBuilder(pkt->GetCommandPdu(), Status::INVALID_PARAMETER);
         send_message(label, false, std::move(response));
       }
+
+      auto cache_key = ResponseCache::MakeKey(*get_element_attributes_request_pkt);
+      if (send_cached_message(label, false, ResponseCache::ELEMENT_ATTRIBUTES, cache_key)) break;
+
       media_interface_->GetSongInfo(base::Bind(&Device::GetElementAttributesResponse, weak_ptr_factory_.GetWeakPtr(),
-                                               label, get_element_attributes_request_pkt));
+                                               label, get_element_attributes_request_pkt, cache_key));
     } break;
 
     case CommandPdu::GET_PLAY_STATUS: {
@@ -586,7 +592,7 @@ void Device::GetPlayStatusResponse(uint8_t label, PlayStatus status) {
 
 void Device::GetElementAttributesResponse(
     uint8_t label, std::shared_ptr<GetElementAttributesRequest> pkt,
-    SongInfo info) {
+    std::string cache_key, SongInfo info) {
   DEVICE_VLOG(2) << __func__;
 
   auto get_element_attributes_pkt = pkt;
@@ -609,7 +615,8 @@ void Device::GetElementAttributesResponse(
     }
   }
 
-  send_message(label, false, std::move(response));
+  send_and_cache_message(label, false, ResponseCache::ELEMENT_ATTRIBUTES,
+                         std::move(cache_key), std::move(response));
 }
 
 void Device::MessageReceived(uint8_t label, std::shared_ptr<Packet> pkt) {
@@ -795,22 +802,33 @@ void Device::HandleGetFolderItems(uint8_t label,
   DEVICE_VLOG(2) << __func__ << ": scope=" << pkt->GetScope();
 
   switch (pkt->GetScope()) {
-    case Scope::MEDIA_PLAYER_LIST:
+    case Scope::MEDIA_PLAYER_LIST: {
+      auto cache_key = ResponseCache::MakeKey(*pkt);
+      if (send_cached_message(label, true, ResponseCache::PLAYER_LIST,
+                              cache_key))
+        break;
       media_interface_->GetMediaPlayerList(
           base::Bind(&Device::GetMediaPlayerListResponse,
-                     weak_ptr_factory_.GetWeakPtr(), label, pkt));
-      break;
-    case Scope::VFS:
+                     weak_ptr_factory_.GetWeakPtr(), label, pkt, cache_key));
+    } break;
+    case Scope::VFS: {
+      auto cache_key = ResponseCache::MakeKey(*pkt, VfsCacheContext());
+      if (send_cached_message(label, true, ResponseCache::VFS, cache_key))
+        break;
       media_interface_->GetFolderItems(
           curr_browsed_player_id_, CurrentFolder(),
           base::Bind(&Device::GetVFSListResponse,
-                     weak_ptr_factory_.GetWeakPtr(), label, pkt));
-      break;
-    case Scope::NOW_PLAYING:
+                     weak_ptr_factory_.GetWeakPtr(), label, pkt, cache_key));
+    } break;
+    case Scope::NOW_PLAYING: {
+      auto cache_key = ResponseCache::MakeKey(*pkt);
+      if (send_cached_message(label, true, ResponseCache::NOW_PLAYING,
+                              cache_key))
+        break;
       media_interface_->GetNowPlayingList(
           base::Bind(&Device::GetNowPlayingListResponse,
-                     weak_ptr_factory_.GetWeakPtr(), label, pkt));
-      break;
+                     weak_ptr_factory_.GetWeakPtr(), label, pkt, cache_key));
+    } break;
     default:
       DEVICE_LOG(ERROR) << __func__ << ": " << pkt->GetScope();
       auto response = GetFolderItemsResponseBuilder::MakePlayerListBuilder(Status::INVALID_PARAMETER, 0, browse_mtu_);
@@ -960,11 +978,18 @@ void Device::HandleGetItemAttributes(
 
   switch (pkt->GetScope()) {
     case Scope::NOW_PLAYING: {
+      auto cache_key = ResponseCache::MakeKey(*pkt);
+      if (send_cached_message(label, true, ResponseCache::NOW_PLAYING,
+                              cache_key))
+        break;
       media_interface_->GetNowPlayingList(
           base::Bind(&Device::GetItemAttributesNowPlayingResponse,
-                     weak_ptr_factory_.GetWeakPtr(), label, pkt));
+                     weak_ptr_factory_.GetWeakPtr(), label, pkt, cache_key));
     } break;
-    case Scope::VFS:
+    case Scope::VFS: {
+      auto cache_key = ResponseCache::MakeKey(*pkt, VfsCacheContext());
+      if (send_cached_message(label, true, ResponseCache::VFS, cache_key))
+        break;
       // TODO (apanicke): Check the vfs_ids_ here. If the item doesn't exist
       // then we can auto send the error without calling up. We do this check
       // later right now though in order to prevent race conditions with updates
@@ -972,8 +997,8 @@ void Device::HandleGetItemAttributes(
       media_interface_->GetFolderItems(
           curr_browsed_player_id_, CurrentFolder(),
           base::Bind(&Device::GetItemAttributesVFSResponse,
-                     weak_ptr_factory_.GetWeakPtr(), label, pkt));
-      break;
+                     weak_ptr_factory_.GetWeakPtr(), label, pkt, cache_key));
+    } break;
     default:
       DEVICE_LOG(ERROR) << "UNKNOWN SCOPE FOR HANDLE GET ITEM ATTRIBUTES";
       break;
@@ -982,7 +1007,8 @@ void Device::HandleGetItemAttributes(
 
 void Device::GetItemAttributesNowPlayingResponse(
     uint8_t label, std::shared_ptr<GetItemAttributesRequest> pkt,
-    std::string curr_media_id, std::vector<SongInfo> song_list) {
+    std::string cache_key, std::string curr_media_id,
+    std::vector<SongInfo> song_list) {
   DEVICE_VLOG(2) << __func__ << ": uid=" << loghex(pkt->GetUid());
   auto builder = GetItemAttributesResponseBuilder::MakeBuilder(Status::NO_ERROR,
                                                                browse_mtu_);
@@ -1023,12 +1049,13 @@ void Device::GetItemAttributesNowPlayingResponse(
     }
   }
 
-  send_message(label, true, std::move(builder));
+  send_and_cache_message(label, true, ResponseCache::NOW_PLAYING,
+                         std::move(cache_key), std::move(builder));
 }
 
 void Device::GetItemAttributesVFSResponse(
     uint8_t label, std::shared_ptr<GetItemAttributesRequest> pkt,
-    std::vector<ListItem> item_list) {
+    std::string cache_key, std::vector<ListItem> item_list) {
   DEVICE_VLOG(2) << __func__ << ": uid=" << loghex(pkt->GetUid());
 
   auto media_id = vfs_ids_.get_media_id(pkt->GetUid());
@@ -1083,18 +1110,21 @@ void Device::GetItemAttributesVFSResponse(
     }
   }
 
-  send_message(label, true, std::move(builder));
+  send_and_cache_message(label, true, ResponseCache::VFS,
+                         std::move(cache_key), std::move(builder));
 }
 
 void Device::GetMediaPlayerListResponse(
     uint8_t label, std::shared_ptr<GetFolderItemsRequest> pkt,
-    uint16_t curr_player, std::vector<MediaPlayerInfo> players) {
+    std::string cache_key, uint16_t curr_player,
+    std::vector<MediaPlayerInfo> players) {
   DEVICE_VLOG(2) << __func__;
 
   if (players.size() == 0) {
     auto no_items_rsp = GetFolderItemsResponseBuilder::MakePlayerListBuilder(
         Status::RANGE_OUT_OF_BOUNDS, 0x0000, browse_mtu_);
     send_message(label, true, std::move(no_items_rsp));
+    return;
   }
 
   auto builder = GetFolderItemsResponseBuilder::MakePlayerListBuilder(
@@ -1120,7 +1150,8 @@ void Device::GetMediaPlayerListResponse(
     builder->AddMediaPlayer(item);
   }
 
-  send_message(label, true, std::move(builder));
+  send_and_cache_message(label, true, ResponseCache::PLAYER_LIST,
+                         std::move(cache_key), std::move(builder));
 }
 
 std::set<AttributeEntry> filter_attributes_requested(
@@ -1137,6 +1168,7 @@ std::set<AttributeEntry> filter_attributes_requested(
 
 void Device::GetVFSListResponse(uint8_t label,
                                 std::shared_ptr<GetFolderItemsRequest> pkt,
+                                std::string cache_key,
                                 std::vector<ListItem> items) {
   DEVICE_VLOG(2) << __func__ << ": start_item=" << pkt->GetStartItem()
                  << " end_item=" << pkt->GetEndItem();
@@ -1190,12 +1222,14 @@ void Device::GetVFSListResponse(uint8_t label,
     }
   }
 
-  send_message(label, true, std::move(builder));
+  send_and_cache_message(label, true, ResponseCache::VFS,
+                         std::move(cache_key), std::move(builder));
 }
 
 void Device::GetNowPlayingListResponse(
     uint8_t label, std::shared_ptr<GetFolderItemsRequest> pkt,
-    std::string /* unused curr_song_id */, std::vector<SongInfo> song_list) {
+    std::string cache_key, std::string /* unused curr_song_id */,
+    std::vector<SongInfo> song_list) {
   DEVICE_VLOG(2) << __func__;
   auto builder = GetFolderItemsResponseBuilder::MakeNowPlayingBuilder(
       Status::NO_ERROR, 0x0000, browse_mtu_);
@@ -1225,7 +1259,8 @@ void Device::GetNowPlayingListResponse(
     if (!builder->AddSong(item)) break;
   }
 
-  send_message(label, true, std::move(builder));
+  send_and_cache_message(label, true, ResponseCache::NOW_PLAYING,
+                         std::move(cache_key), std::move(builder));
 }
 
 void Device::HandleSetBrowsedPlayer(
@@ -1276,6 +1311,25 @@ void Device::SetBrowsedPlayerResponse(
   send_message(label, true, std::move(response));
 }
 
+bool Device::send_cached_message(uint8_t label, bool browse,
+                                 ResponseCache::Kind kind,
+                                 const std::string& cache_key) {
+  auto message = response_cache_.Find(kind, cache_key);
+  if (message == nullptr) return false;
+
+  DEVICE_VLOG(2) << __func__ << ": kind=" << static_cast<int>(kind);
+  send_message(label, browse, std::move(message));
+  return true;
+}
+
+void Device::send_and_cache_message(
+    uint8_t label, bool browse, ResponseCache::Kind kind, std::string cache_key,
+    std::unique_ptr<::bluetooth::PacketBuilder> message) {
+  send_message(label, browse,
+               response_cache_.Insert(kind, std::move(cache_key),
+                                      std::move(message)));
+}
+
 void Device::SendMediaUpdate(bool metadata, bool play_status, bool queue) {
   bool is_silence = IsInSilenceMode();
 
@@ -1284,6 +1338,14 @@ void Device::SendMediaUpdate(bool metadata, bool play_status, bool queue) {
                  << " : play_status= " << play_status << " : queue=" << queue
                  << " ; is_silence=" << is_silence;
 
+  // The now playing responses hold the current song too, so a track change
+  // invalidates them as well as a queue change
+  if (metadata) {
+    response_cache_.Invalidate(ResponseCache::ELEMENT_ATTRIBUTES);
+    response_cache_.Invalidate(ResponseCache::NOW_PLAYING);
+  }
+  if (queue) response_cache_.Invalidate(ResponseCache::NOW_PLAYING);
+
   if (queue) {
     HandleNowPlayingUpdate();
   }
@@ -1303,6 +1365,13 @@ void Device::SendFolderUpdate(bool available_players, bool addressed_player,
   CHECK(media_interface_);
   DEVICE_VLOG(4) << __func__;
 
+  if (available_players) response_cache_.Invalidate(ResponseCache::PLAYER_LIST);
+  if (addressed_player) response_cache_.Clear();
+  if (uids) {
+    response_cache_.Invalidate(ResponseCache::VFS);
+    response_cache_.Invalidate(ResponseCache::NOW_PLAYING);
+  }
+
   if (available_players) {
     HandleAvailablePlayerUpdate();
   }
@@ -1459,6 +1528,7 @@ std::ostream& operator<<(std::ostream& out, const Device& d) {
   out << "Current Folder: \"" << d.CurrentFolder() << "\"\n";
   out << "MTU Sizes: CTRL=" << d.ctrl_mtu_ << " BROWSE=" << d.browse_mtu_
       << std::endl;
+  out << d.response_cache_;
   // TODO (apanicke): Add supported features as well as media keys
   return out;
 }
@@ -39,6 +39,7 @@
 #include "packet/avrcp/set_browsed_player.h"
 #include "packet/avrcp/vendor_packet.h"
 #include "profile/avrcp/media_id_map.h"
+#include "profile/avrcp/response_cache.h"
 #include "raw_address.h"
 
 namespace bluetooth {
@@ -176,7 +177,7 @@ class Device {
   // function.
   virtual void GetElementAttributesResponse(
       uint8_t label, std::shared_ptr<GetElementAttributesRequest> pkt,
-      SongInfo info);
+      std::string cache_key, SongInfo info);
 
   // AVAILABLE PLAYER CHANGED
   virtual void HandleAvailablePlayerUpdate();
@@ -193,13 +194,16 @@ class Device {
       uint8_t label, std::shared_ptr<GetFolderItemsRequest> request);
   virtual void GetMediaPlayerListResponse(
       uint8_t label, std::shared_ptr<GetFolderItemsRequest> pkt,
-      uint16_t curr_player, std::vector<MediaPlayerInfo> players);
+      std::string cache_key, uint16_t curr_player,
+      std::vector<MediaPlayerInfo> players);
   virtual void GetVFSListResponse(uint8_t label,
                                   std::shared_ptr<GetFolderItemsRequest> pkt,
+                                  std::string cache_key,
                                   std::vector<ListItem> items);
   virtual void GetNowPlayingListResponse(
       uint8_t label, std::shared_ptr<GetFolderItemsRequest> pkt,
-      std::string curr_song_id, std::vector<SongInfo> song_list);
+      std::string cache_key, std::string curr_song_id,
+      std::vector<SongInfo> song_list);
 
   // GET TOTAL NUMBER OF ITEMS
   virtual void HandleGetTotalNumberOfItems(
@@ -216,10 +220,11 @@ class Device {
       uint8_t label, std::shared_ptr<GetItemAttributesRequest> request);
   virtual void GetItemAttributesNowPlayingResponse(
       uint8_t label, std::shared_ptr<GetItemAttributesRequest> pkt,
-      std::string curr_media_id, std::vector<SongInfo> song_list);
+      std::string cache_key, std::string curr_media_id,
+      std::vector<SongInfo> song_list);
   virtual void GetItemAttributesVFSResponse(
       uint8_t label, std::shared_ptr<GetItemAttributesRequest> pkt,
-      std::vector<ListItem> item_list);
+      std::string cache_key, std::vector<ListItem> item_list);
 
   // SET BROWSED PLAYER
   virtual void HandleSetBrowsedPlayer(
@@ -282,6 +287,21 @@ class Device {
     active_labels_.erase(label);
     send_message_cb_.Run(label, browse, std::move(message));
   }
+
+  // Sends the response cached for |cache_key| if there is one.
+  bool send_cached_message(uint8_t label, bool browse, ResponseCache::Kind kind,
+                           const std::string& cache_key);
+
+  // Sends |message| and keeps a copy of it in the response cache.
+  void send_and_cache_message(
+      uint8_t label, bool browse, ResponseCache::Kind kind,
+      std::string cache_key,
+      std::unique_ptr<::bluetooth::PacketBuilder> message);
+
+  // The folder state the VFS responses depend on, part of their cache key.
+  std::string VfsCacheContext() const {
+    return std::to_string(curr_browsed_player_id_) + "/" + CurrentFolder();
+  }
   base::WeakPtrFactory<Device> weak_ptr_factory_;
 
   // TODO (apanicke): Initialize all the variables in the constructor.
@@ -318,6 +338,8 @@ class Device {
   SongInfo last_song_info_;
   PlayStatus last_play_status_;
 
+  ResponseCache response_cache_;
+
   base::CancelableClosure play_pos_update_cb_;
 
   MediaInterface* media_interface_ = nullptr;
@@ -0,0 +1,161 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <iostream>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "packet/base/packet.h"
+#include "packet/base/packet_builder.h"
+
+namespace bluetooth {
+namespace avrcp {
+
+// A helper class that keeps the responses built for browsing and metadata
+// requests, so that a request repeated by the remote device can be answered
+// without querying the Media Interface layer. The responses are stored
+// serialized and keyed by the request they answer. Each response has a kind,
+// the media it describes, so that it can be dropped when that media changes.
+class ResponseCache {
+ public:
+  enum Kind : uint8_t {
+    ELEMENT_ATTRIBUTES = 0,
+    PLAYER_LIST,
+    VFS,
+    NOW_PLAYING,
+    NUM_KINDS,
+  };
+
+  static constexpr size_t kMaxEntries = 16;
+
+  // Builds the cache key of |request|. |context| holds the device state the
+  // response depends on that isn't part of the request, like the folder.
+  static std::string MakeKey(const ::bluetooth::Packet& request,
+                             const std::string& context = "") {
+    std::string key = context;
+    key.push_back('\0');
+    for (auto it = request.begin(); it != request.end(); it++) {
+      key.push_back(*it);
+    }
+    return key;
+  }
+
+  // Returns a builder replaying the response cached for |key|, or nullptr if
+  // there is none.
+  std::unique_ptr<::bluetooth::PacketBuilder> Find(Kind kind,
+                                                   const std::string& key) {
+    for (auto it = entries_.begin(); it != entries_.end(); it++) {
+      if (it->kind == kind && it->key == key) {
+        hits_[kind]++;
+        // Keep the most recently used entries at the back
+        entries_.splice(entries_.end(), entries_, it);
+        return std::make_unique<CachedResponseBuilder>(it->payload);
+      }
+    }
+    misses_[kind]++;
+    return nullptr;
+  }
+
+  // Serializes |builder| into the cache under |key| and returns a builder
+  // replaying the same response.
+  std::unique_ptr<::bluetooth::PacketBuilder> Insert(
+      Kind kind, std::string key,
+      std::unique_ptr<::bluetooth::PacketBuilder> builder) {
+    auto packet = std::make_shared<SerializedPacket>();
+    builder->Serialize(packet);
+    auto payload = packet->data();
+
+    if (entries_.size() >= kMaxEntries) entries_.pop_front();
+    entries_.push_back(Entry{kind, std::move(key), payload});
+    return std::make_unique<CachedResponseBuilder>(payload);
+  }
+
+  // Drops the responses of the given kind.
+  void Invalidate(Kind kind) {
+    entries_.remove_if([kind](const Entry& e) { return e.kind == kind; });
+  }
+
+  void Clear() { entries_.clear(); }
+
+  size_t size() const { return entries_.size(); }
+
+  friend std::ostream& operator<<(std::ostream& out, const ResponseCache& c) {
+    static const char* kKindNames[NUM_KINDS] = {
+        "Element Attributes", "Media Player List", "VFS", "Now Playing"};
+    out << "Response Cache: " << c.entries_.size() << "/" << kMaxEntries
+        << " entries\n";
+    for (int kind = 0; kind < NUM_KINDS; kind++) {
+      uint32_t total = c.hits_[kind] + c.misses_[kind];
+      out << "  " << kKindNames[kind] << ": hits=" << c.hits_[kind]
+          << " misses=" << c.misses_[kind];
+      if (total != 0) out << " (" << (c.hits_[kind] * 100 / total) << "%)";
+      out << "\n";
+    }
+    return out;
+  }
+
+ private:
+  // The packet a response is serialized into
+  class SerializedPacket : public ::bluetooth::Packet {
+   public:
+    std::shared_ptr<const std::vector<uint8_t>> data() const { return data_; }
+
+    std::string ToString() const override { return "SerializedPacket"; }
+
+    bool IsValid() const override { return true; }
+
+   private:
+    std::pair<size_t, size_t> GetPayloadIndecies() const override {
+      return std::pair<size_t, size_t>(0, data_->size());
+    }
+  };
+
+  // Replays a serialized response
+  class CachedResponseBuilder : public ::bluetooth::PacketBuilder {
+   public:
+    explicit CachedResponseBuilder(
+        std::shared_ptr<const std::vector<uint8_t>> payload)
+        : payload_(std::move(payload)) {}
+
+    size_t size() const override { return payload_->size(); }
+
+    bool Serialize(const std::shared_ptr<::bluetooth::Packet>& pkt) override {
+      ReserveSpace(pkt, size());
+      for (uint8_t octet : *payload_) AddPayloadOctets1(pkt, octet);
+      return true;
+    }
+
+   private:
+    std::shared_ptr<const std::vector<uint8_t>> payload_;
+  };
+
+  struct Entry {
+    Kind kind;
+    std::string key;
+    std::shared_ptr<const std::vector<uint8_t>> payload;
+  };
+
+  std::list<Entry> entries_;
+  uint32_t hits_[NUM_KINDS] = {};
+  uint32_t misses_[NUM_KINDS] = {};
+};
+
+}  // namespace avrcp
+}  // namespace bluetooth
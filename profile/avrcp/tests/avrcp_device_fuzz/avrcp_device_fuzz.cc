@@ -55,7 +55,7 @@ bool get_pts_avrcp_test(void) { return false; }
 
 const stack_config_t interface = {
     nullptr, get_pts_avrcp_test, nullptr, nullptr, nullptr, nullptr, nullptr,
-    nullptr};
+    nullptr, nullptr, nullptr, nullptr, nullptr, nullptr};
 
 void Callback(uint8_t, bool, std::unique_ptr<::bluetooth::PacketBuilder>) {}
 
@@ -51,7 +51,7 @@ bool get_pts_avrcp_test(void) { return false; }
 
 const stack_config_t interface = {
     nullptr, get_pts_avrcp_test, nullptr, nullptr, nullptr, nullptr, nullptr,
-    nullptr};
+    nullptr, nullptr, nullptr, nullptr, nullptr, nullptr};
 
 // TODO (apanicke): All the tests below are just basic positive unit tests.
 // Add more tests to increase code coverage.
@@ -648,6 +648,40 @@ TEST_F(AvrcpDeviceTest, getElementAttributesMtuTest) {
       1, TestAvrcpPacket::Make(get_element_attributes_request_full));
 }
 
+TEST_F(AvrcpDeviceTest, getElementAttributesCacheTest) {
+  MockMediaInterface interface;
+  NiceMock<MockA2dpInterface> a2dp_interface;
+
+  test_device->RegisterInterfaces(&interface, &a2dp_interface, nullptr);
+
+  SongInfo info = {"test_id",
+                   {AttributeEntry(Attribute::TITLE, "Test Song")}};
+
+  // A repeated request is answered from the response cache
+  EXPECT_CALL(interface, GetSongInfo(_)).Times(1).WillOnce(InvokeCb<0>(info));
+  for (uint8_t label = 1; label <= 2; label++) {
+    auto compare_to = GetElementAttributesResponseBuilder::MakeBuilder(0xFFFF);
+    compare_to->AddAttributeEntry(Attribute::TITLE, "Test Song");
+    EXPECT_CALL(response_cb,
+                Call(label, false, matchPacket(std::move(compare_to))))
+        .Times(1);
+    SendMessage(label,
+                TestAvrcpPacket::Make(get_element_attributes_request_partial));
+  }
+  Mock::VerifyAndClearExpectations(&interface);
+
+  // A track change invalidates the cached response
+  test_device->SendMediaUpdate(true, false, false);
+
+  info.attributes = {AttributeEntry(Attribute::TITLE, "New Song")};
+  EXPECT_CALL(interface, GetSongInfo(_)).Times(1).WillOnce(InvokeCb<0>(info));
+  auto compare_to = GetElementAttributesResponseBuilder::MakeBuilder(0xFFFF);
+  compare_to->AddAttributeEntry(Attribute::TITLE, "New Song");
+  EXPECT_CALL(response_cb, Call(3, false, matchPacket(std::move(compare_to))))
+      .Times(1);
+  SendMessage(3, TestAvrcpPacket::Make(get_element_attributes_request_partial));
+}
+
 TEST_F(AvrcpDeviceTest, getTotalNumberOfItemsMediaPlayersTest) {
   MockMediaInterface interface;
   NiceMock<MockA2dpInterface> a2dp_interface;
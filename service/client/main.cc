@@ -15,6 +15,8 @@
 //
 
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <string>
 
 #include <base/at_exit.h>
@@ -39,6 +41,7 @@
 #include <android/bluetooth/IBluetoothLeScanner.h>
 #include <android/bluetooth/IBluetoothLowEnergy.h>
 #include <bluetooth/adapter_state.h>
+#include <bluetooth/event_ring.h>
 #include <bluetooth/low_energy_constants.h>
 #include <bluetooth/scan_filter.h>
 #include <bluetooth/scan_settings.h>
@@ -113,6 +116,10 @@ std::atomic_int gatt_client_id(0);
 // True if we should dump the scan record bytes for incoming scan results.
 std::atomic_bool dump_scan_record(false);
 
+// The ring carrying the scan results, once opened by start-le-scan.
+std::mutex scan_result_ring_lock;
+std::unique_ptr<bluetooth::EventRing> scan_result_ring;
+
 // True if the remote process has died and we should exit.
 std::atomic_bool should_exit(false);
 
@@ -326,6 +333,26 @@ class CLIBluetoothLeScannerCallback
 
   Status OnScanResult(
       const android::bluetooth::ScanResult& scan_result) override {
+    PrintScanResult(scan_result);
+    return Status::ok();
+  }
+
+  Status OnScanResultsAvailable() override {
+    std::lock_guard<std::mutex> lock(scan_result_ring_lock);
+    if (!scan_result_ring) return Status::ok();
+
+    scan_result_ring->Read(
+        [](uint16_t type, const uint8_t* data, uint16_t len) {
+          bluetooth::ScanResult scan_result;
+          if (type == bluetooth::EventRing::kTypeScanResult &&
+              bluetooth::DecodeScanResult(data, len, &scan_result))
+            PrintScanResult(scan_result);
+        });
+    return Status::ok();
+  }
+
+ private:
+  static void PrintScanResult(const bluetooth::ScanResult& scan_result) {
     BeginAsyncOut();
     cout << COLOR_BOLDWHITE "Scan result: " << COLOR_BOLDYELLOW "["
          << scan_result.device_address() << "] "
@@ -337,10 +364,8 @@ class CLIBluetoothLeScannerCallback
                               scan_result.scan_record().size());
     }
     EndAsyncOut();
-    return Status::ok();
   }
 
- private:
   DISALLOW_COPY_AND_ASSIGN(CLIBluetoothLeScannerCallback);
 };
 
@@ -905,6 +930,10 @@ void HandleUnregisterBLEScanner(IBluetooth* bt_iface,
 
   ble_scanner_iface->UnregisterScanner(ble_scanner_id.load());
   ble_scanner_id = 0;
+  {
+    std::lock_guard<std::mutex> lock(scan_result_ring_lock);
+    scan_result_ring.reset();
+  }
   PrintCommandStatus(true);
 }
 
@@ -936,6 +965,17 @@ void HandleStartLeScan(IBluetooth* bt_iface, const vector<string>& args) {
     return;
   }
 
+  {
+    // Scan results come through the ring when the daemon supports it
+    std::lock_guard<std::mutex> lock(scan_result_ring_lock);
+    android::base::unique_fd fd;
+    if (!scan_result_ring &&
+        ble_scanner_iface->OpenScanResultRing(ble_scanner_id.load(), &fd)
+            .isOk()) {
+      scan_result_ring = bluetooth::EventRing::Map(fd.release());
+    }
+  }
+
   bluetooth::ScanSettings settings;
   std::vector<android::bluetooth::ScanFilter> filters;
 
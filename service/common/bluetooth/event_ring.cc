@@ -0,0 +1,259 @@
+//
+//  Copyright 2020 The Android Open Source Project
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at:
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#include "bluetooth/event_ring.h"
+
+#include <linux/memfd.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <new>
+
+#include <base/logging.h>
+
+#include "raw_address.h"
+
+namespace bluetooth {
+
+namespace {
+
+constexpr uint32_t kMagic = 0x42544552;  // "BTER"
+constexpr uint16_t kTypePadding = 0xffff;
+constexpr size_t kRecordHeaderSize = 4;
+constexpr size_t kMinSize = 4096;
+
+uint32_t RecordSize(uint16_t len) {
+  return (kRecordHeaderSize + len + 3) & ~3u;
+}
+
+}  // namespace
+
+// The producer only writes |head| and the records, the consumer only writes
+// |tail|. Both are byte counts that wrap around, the records area spans
+// |size| bytes, a power of two.
+struct EventRing::Header {
+  uint32_t magic;
+  uint32_t size;
+  std::atomic<uint32_t> head;
+  std::atomic<uint32_t> tail;
+  // Set by the consumer before it waits for a doorbell
+  std::atomic<uint32_t> consumer_waiting;
+  std::atomic<uint32_t> dropped;
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free,
+              "the ring is shared between processes");
+
+namespace {
+
+constexpr size_t kRecordsOffset = 64;
+
+}  // namespace
+
+// static
+std::unique_ptr<EventRing> EventRing::Create(size_t size) {
+  static_assert(sizeof(Header) <= kRecordsOffset, "header too big");
+
+  size_t ring_size = kMinSize;
+  while (ring_size < size) ring_size <<= 1;
+
+  int fd = syscall(__NR_memfd_create, "bt_event_ring", MFD_CLOEXEC);
+  if (fd < 0) {
+    PLOG(ERROR) << __func__ << ": Failed to create the shared memory";
+    return nullptr;
+  }
+
+  size_t map_size = kRecordsOffset + ring_size;
+  if (ftruncate(fd, map_size) < 0) {
+    PLOG(ERROR) << __func__ << ": Failed to size the shared memory";
+    close(fd);
+    return nullptr;
+  }
+
+  void* base =
+      mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (base == MAP_FAILED) {
+    PLOG(ERROR) << __func__ << ": Failed to map the shared memory";
+    close(fd);
+    return nullptr;
+  }
+
+  Header* header = new (base) Header();
+  header->magic = kMagic;
+  header->size = ring_size;
+  header->consumer_waiting = 1;
+
+  return std::unique_ptr<EventRing>(new EventRing(fd, base, map_size));
+}
+
+// static
+std::unique_ptr<EventRing> EventRing::Map(int fd) {
+  struct stat st;
+  if (fstat(fd, &st) < 0 || st.st_size < (off_t)(kRecordsOffset + kMinSize)) {
+    LOG(ERROR) << __func__ << ": Not an event ring";
+    close(fd);
+    return nullptr;
+  }
+
+  size_t map_size = st.st_size;
+  void* base =
+      mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (base == MAP_FAILED) {
+    PLOG(ERROR) << __func__ << ": Failed to map the shared memory";
+    close(fd);
+    return nullptr;
+  }
+
+  const Header* header = static_cast<const Header*>(base);
+  uint32_t size = header->size;
+  if (header->magic != kMagic || (size & (size - 1)) != 0 ||
+      kRecordsOffset + size != map_size) {
+    LOG(ERROR) << __func__ << ": Not an event ring";
+    munmap(base, map_size);
+    close(fd);
+    return nullptr;
+  }
+
+  return std::unique_ptr<EventRing>(new EventRing(fd, base, map_size));
+}
+
+EventRing::EventRing(int fd, void* base, size_t map_size)
+    : fd_(fd),
+      base_(base),
+      map_size_(map_size),
+      header_(static_cast<Header*>(base)) {}
+
+EventRing::~EventRing() {
+  munmap(base_, map_size_);
+  close(fd_);
+}
+
+uint8_t* EventRing::records() const {
+  return static_cast<uint8_t*>(base_) + kRecordsOffset;
+}
+
+bool EventRing::Write(uint16_t type, const uint8_t* data, uint16_t len,
+                      bool* doorbell) {
+  CHECK(type != kTypePadding);
+  *doorbell = false;
+
+  const uint32_t size = header_->size;
+  uint32_t head = header_->head.load(std::memory_order_relaxed);
+  uint32_t tail = header_->tail.load(std::memory_order_acquire);
+  uint32_t used = head - tail;
+
+  // A record never wraps: what's left at the end of the area is skipped
+  uint32_t offset = head & (size - 1);
+  uint32_t contiguous = size - offset;
+  uint32_t needed = RecordSize(len);
+  uint32_t total = needed > contiguous ? contiguous + needed : needed;
+  // |used| past |size| means a corrupted tail: treat the ring as full
+  if (used > size || size - used < total) {
+    header_->dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  if (needed > contiguous) {
+    uint16_t padding[2] = {kTypePadding,
+                           (uint16_t)(contiguous - kRecordHeaderSize)};
+    memcpy(records() + offset, padding, sizeof(padding));
+    head += contiguous;
+    offset = 0;
+  }
+
+  uint16_t record_header[2] = {type, len};
+  memcpy(records() + offset, record_header, sizeof(record_header));
+  if (len) memcpy(records() + offset + kRecordHeaderSize, data, len);
+
+  header_->head.store(head + needed, std::memory_order_seq_cst);
+  *doorbell = header_->consumer_waiting.exchange(0, std::memory_order_seq_cst);
+  return true;
+}
+
+size_t EventRing::Read(const RecordCallback& callback) {
+  const uint32_t size = header_->size;
+  size_t count = 0;
+
+  for (;;) {
+    uint32_t tail = header_->tail.load(std::memory_order_relaxed);
+    uint32_t head = header_->head.load(std::memory_order_acquire);
+    if (head - tail > size) {
+      LOG(ERROR) << __func__ << ": Corrupted ring, dropping its records";
+      tail = head;
+    }
+
+    while (tail != head) {
+      uint32_t offset = tail & (size - 1);
+      uint16_t record_header[2];
+      memcpy(record_header, records() + offset, sizeof(record_header));
+      uint32_t record_size = RecordSize(record_header[1]);
+      if (record_size > size - offset || record_size > head - tail) {
+        LOG(ERROR) << __func__ << ": Corrupted record, dropping the ring";
+        tail = head;
+        break;
+      }
+
+      if (record_header[0] != kTypePadding) {
+        callback(record_header[0], records() + offset + kRecordHeaderSize,
+                 record_header[1]);
+        count++;
+      }
+      tail += record_size;
+    }
+    header_->tail.store(tail, std::memory_order_release);
+
+    // The producer rings the doorbell for the records written from now on,
+    // the ones written before are read here
+    header_->consumer_waiting.store(1, std::memory_order_seq_cst);
+    if (header_->head.load(std::memory_order_seq_cst) == tail) return count;
+    header_->consumer_waiting.store(0, std::memory_order_relaxed);
+  }
+}
+
+uint32_t EventRing::dropped() const {
+  return header_->dropped.load(std::memory_order_relaxed);
+}
+
+std::vector<uint8_t> EncodeScanResult(const ScanResult& result) {
+  const std::string& address = result.device_address();
+  const std::vector<uint8_t>& scan_record = result.scan_record();
+
+  std::vector<uint8_t> data;
+  data.reserve(2 + address.size() + scan_record.size());
+  data.push_back((uint8_t)(int8_t)result.rssi());
+  data.push_back(address.size());
+  data.insert(data.end(), address.begin(), address.end());
+  data.insert(data.end(), scan_record.begin(), scan_record.end());
+  return data;
+}
+
+bool DecodeScanResult(const uint8_t* data, uint16_t len, ScanResult* result) {
+  if (len < 2 || len < 2 + data[1]) return false;
+
+  int rssi = (int8_t)data[0];
+  std::string address(reinterpret_cast<const char*>(data + 2), data[1]);
+  if (!RawAddress::IsValidAddress(address)) return false;
+
+  std::vector<uint8_t> scan_record(data + 2 + data[1], data + len);
+  *result = ScanResult(address, scan_record, rssi);
+  return true;
+}
+
+}  // namespace bluetooth
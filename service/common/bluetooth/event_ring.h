@@ -0,0 +1,94 @@
+//
+//  Copyright 2020 The Android Open Source Project
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at:
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <base/macros.h>
+
+#include "bluetooth/scan_result.h"
+
+namespace bluetooth {
+
+// EventRing is a single producer, single consumer ring of records in shared
+// memory. It streams high rate events, such as scan results, from the daemon
+// to one client without an IPC transaction per event: the IPC only carries a
+// doorbell. The producer asks for a doorbell when it writes to a ring the
+// consumer drained, the consumer then reads everything written in the
+// meantime, so both ends work in batches under load.
+class EventRing {
+ public:
+  // Record types
+  static constexpr uint16_t kTypeScanResult = 1;
+
+  // Default size of the records area
+  static constexpr size_t kDefaultSize = 64 * 1024;
+
+  // Creates a ring of at least |size| bytes of records in a new shared memory
+  // region. Returns nullptr on failure.
+  static std::unique_ptr<EventRing> Create(size_t size);
+
+  // Maps the ring shared through |fd| and takes ownership of |fd|. Returns
+  // nullptr if |fd| doesn't hold a valid ring.
+  static std::unique_ptr<EventRing> Map(int fd);
+
+  ~EventRing();
+
+  // The file descriptor of the shared memory, to hand over to the consumer.
+  int fd() const { return fd_; }
+
+  // Appends a record, from the producer. Returns false, and counts the record
+  // as dropped, if it doesn't fit in the free space. On success, |*doorbell|
+  // tells whether the consumer must be woken up.
+  bool Write(uint16_t type, const uint8_t* data, uint16_t len, bool* doorbell);
+
+  using RecordCallback =
+      std::function<void(uint16_t type, const uint8_t* data, uint16_t len)>;
+
+  // Reads all the records written so far, from the consumer, and then waits
+  // for a doorbell. Returns the number of records read.
+  size_t Read(const RecordCallback& callback);
+
+  // The number of records the producer dropped because the ring was full.
+  uint32_t dropped() const;
+
+ private:
+  struct Header;
+
+  EventRing(int fd, void* base, size_t map_size);
+
+  uint8_t* records() const;
+
+  int fd_;
+  void* base_;
+  size_t map_size_;
+  Header* header_;
+
+  DISALLOW_COPY_AND_ASSIGN(EventRing);
+};
+
+// The payload of kTypeScanResult records.
+std::vector<uint8_t> EncodeScanResult(const ScanResult& result);
+// Returns false if |data| isn't a valid scan result record.
+bool DecodeScanResult(const uint8_t* data, uint16_t len, ScanResult* result);
+
+}  // namespace bluetooth
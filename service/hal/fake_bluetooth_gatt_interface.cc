@@ -139,6 +139,8 @@ btgatt_server_interface_t fake_btgatts_iface = {
     FakeSendResponse,
     nullptr,  // set_phy
     nullptr,  // read_phy
+    nullptr,  // set_cached_value
+    nullptr,  // invalidate_cached_value
 };
 
 }  // namespace
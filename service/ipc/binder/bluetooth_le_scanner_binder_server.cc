@@ -16,6 +16,8 @@
 
 #include "service/ipc/binder/bluetooth_le_scanner_binder_server.h"
 
+#include <unistd.h>
+
 #include <base/logging.h>
 
 #include "service/adapter.h"
@@ -53,12 +55,18 @@ Status BluetoothLeScannerBinderServer::RegisterScanner(
 Status BluetoothLeScannerBinderServer::UnregisterScanner(int scanner_id) {
   VLOG(2) << __func__;
   UnregisterInstanceBase(scanner_id);
+
+  std::lock_guard<std::mutex> lock(*maps_lock());
+  scan_result_rings_.erase(scanner_id);
   return Status::ok();
 }
 
 Status BluetoothLeScannerBinderServer::UnregisterAll() {
   VLOG(2) << __func__;
   UnregisterAllBase();
+
+  std::lock_guard<std::mutex> lock(*maps_lock());
+  scan_result_rings_.clear();
   return Status::ok();
 }
 
@@ -101,6 +109,29 @@ Status BluetoothLeScannerBinderServer::StopScan(int scanner_id,
   return Status::ok();
 }
 
+Status BluetoothLeScannerBinderServer::OpenScanResultRing(
+    int scanner_id, android::base::unique_fd* _aidl_return) {
+  VLOG(2) << __func__ << " scanner_id: " << scanner_id;
+  std::lock_guard<std::mutex> lock(*maps_lock());
+
+  if (!GetLEScanner(scanner_id)) {
+    LOG(ERROR) << "Unknown scanner_id: " << scanner_id;
+    return Status::fromExceptionCode(Status::EX_ILLEGAL_ARGUMENT);
+  }
+
+  std::unique_ptr<bluetooth::EventRing>& ring = scan_result_rings_[scanner_id];
+  if (!ring) {
+    ring = bluetooth::EventRing::Create(bluetooth::EventRing::kDefaultSize);
+    if (!ring) {
+      scan_result_rings_.erase(scanner_id);
+      return Status::fromExceptionCode(Status::EX_ILLEGAL_STATE);
+    }
+  }
+
+  _aidl_return->reset(dup(ring->fd()));
+  return Status::ok();
+}
+
 void BluetoothLeScannerBinderServer::OnScanResult(
     bluetooth::LowEnergyScanner* scanner, const bluetooth::ScanResult& result) {
   VLOG(2) << __func__;
@@ -113,7 +144,20 @@ void BluetoothLeScannerBinderServer::OnScanResult(
     return;
   }
 
-  cb->OnScanResult(result);
+  auto iter = scan_result_rings_.find(scanner_id);
+  if (iter == scan_result_rings_.end()) {
+    cb->OnScanResult(result);
+    return;
+  }
+
+  // A full ring drops the result: the client counts them in the ring
+  std::vector<uint8_t> data = bluetooth::EncodeScanResult(result);
+  bool doorbell;
+  if (iter->second->Write(bluetooth::EventRing::kTypeScanResult, data.data(),
+                          data.size(), &doorbell) &&
+      doorbell) {
+    cb->OnScanResultsAvailable();
+  }
 }
 
 android::sp<IBluetoothLeScannerCallback>
@@ -16,13 +16,16 @@
 
 #pragma once
 
+#include <map>
 #include <memory>
 
+#include <android-base/unique_fd.h>
 #include <base/macros.h>
 
 #include <android/bluetooth/IBluetoothLeScannerCallback.h>
 #include "android/bluetooth/BnBluetoothLeScanner.h"
 
+#include "service/common/bluetooth/event_ring.h"
 #include "service/common/bluetooth/low_energy_constants.h"
 #include "service/ipc/binder/interface_with_instances_base.h"
 #include "service/low_energy_scanner.h"
@@ -60,6 +63,8 @@ class BluetoothLeScannerBinderServer
                    const std::vector<android::bluetooth::ScanFilter>& filters,
                    bool* _aidl_return) override;
   Status StopScan(int scanner_id, bool* _aidl_return) override;
+  Status OpenScanResultRing(int scanner_id,
+                            android::base::unique_fd* _aidl_return) override;
 
   void OnScanResult(bluetooth::LowEnergyScanner* scanner,
                     const bluetooth::ScanResult& result) override;
@@ -80,6 +85,10 @@ class BluetoothLeScannerBinderServer
 
   bluetooth::Adapter* adapter_;  // weak
 
+  // The scanners that get their results through a shared memory ring,
+  // guarded by |maps_lock()|
+  std::map<int, std::unique_ptr<bluetooth::EventRing>> scan_result_rings_;
+
   DISALLOW_COPY_AND_ASSIGN(BluetoothLeScannerBinderServer);
 };
 
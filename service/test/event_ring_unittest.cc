@@ -0,0 +1,141 @@
+//
+//  Copyright 2020 The Android Open Source Project
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at:
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include "service/common/bluetooth/event_ring.h"
+
+namespace bluetooth {
+namespace {
+
+struct Record {
+  uint16_t type;
+  std::vector<uint8_t> data;
+};
+
+std::vector<Record> ReadAll(EventRing* ring) {
+  std::vector<Record> records;
+  ring->Read([&records](uint16_t type, const uint8_t* data, uint16_t len) {
+    records.push_back({type, std::vector<uint8_t>(data, data + len)});
+  });
+  return records;
+}
+
+TEST(EventRingTest, DoorbellOncePerBatch) {
+  auto ring = EventRing::Create(0);
+  ASSERT_NE(nullptr, ring);
+
+  const uint8_t data[] = {1, 2, 3};
+  bool doorbell;
+  EXPECT_TRUE(ring->Write(7, data, sizeof(data), &doorbell));
+  EXPECT_TRUE(doorbell);
+  EXPECT_TRUE(ring->Write(8, data, 1, &doorbell));
+  EXPECT_FALSE(doorbell);
+  EXPECT_TRUE(ring->Write(9, nullptr, 0, &doorbell));
+  EXPECT_FALSE(doorbell);
+
+  auto records = ReadAll(ring.get());
+  ASSERT_EQ(3u, records.size());
+  EXPECT_EQ(7, records[0].type);
+  EXPECT_EQ(std::vector<uint8_t>(data, data + 3), records[0].data);
+  EXPECT_EQ(8, records[1].type);
+  EXPECT_EQ(std::vector<uint8_t>(data, data + 1), records[1].data);
+  EXPECT_EQ(9, records[2].type);
+  EXPECT_TRUE(records[2].data.empty());
+
+  // The consumer drained the ring, the next write wakes it up
+  EXPECT_TRUE(ring->Write(7, data, sizeof(data), &doorbell));
+  EXPECT_TRUE(doorbell);
+}
+
+TEST(EventRingTest, WrapsAround) {
+  auto ring = EventRing::Create(0);
+  ASSERT_NE(nullptr, ring);
+
+  // Records that don't divide the ring size, so that some have to skip the
+  // end of the area
+  std::vector<uint8_t> data(301);
+  bool doorbell;
+  uint8_t next_write = 0, next_read = 0;
+  for (int batch = 0; batch < 50; batch++) {
+    for (int i = 0; i < 5; i++, next_write++) {
+      data[0] = next_write;
+      ASSERT_TRUE(ring->Write(EventRing::kTypeScanResult, data.data(),
+                              data.size(), &doorbell));
+    }
+    for (const Record& record : ReadAll(ring.get())) {
+      ASSERT_EQ(data.size(), record.data.size());
+      EXPECT_EQ(next_read++, record.data[0]);
+    }
+  }
+  EXPECT_EQ(next_write, next_read);
+  EXPECT_EQ(0u, ring->dropped());
+}
+
+TEST(EventRingTest, DropsWhenFull) {
+  auto ring = EventRing::Create(0);
+  ASSERT_NE(nullptr, ring);
+
+  std::vector<uint8_t> data(1000);
+  bool doorbell;
+  size_t written = 0;
+  while (ring->Write(1, data.data(), data.size(), &doorbell)) written++;
+  EXPECT_GT(written, 0u);
+  EXPECT_EQ(1u, ring->dropped());
+
+  EXPECT_EQ(written, ReadAll(ring.get()).size());
+  EXPECT_TRUE(ring->Write(1, data.data(), data.size(), &doorbell));
+}
+
+TEST(EventRingTest, SharedThroughFd) {
+  auto producer = EventRing::Create(EventRing::kDefaultSize);
+  ASSERT_NE(nullptr, producer);
+  auto consumer = EventRing::Map(dup(producer->fd()));
+  ASSERT_NE(nullptr, consumer);
+
+  const uint8_t data[] = {0xab, 0xcd};
+  bool doorbell;
+  EXPECT_TRUE(producer->Write(3, data, sizeof(data), &doorbell));
+  EXPECT_TRUE(doorbell);
+
+  auto records = ReadAll(consumer.get());
+  ASSERT_EQ(1u, records.size());
+  EXPECT_EQ(3, records[0].type);
+  EXPECT_EQ(std::vector<uint8_t>(data, data + 2), records[0].data);
+}
+
+TEST(EventRingTest, MapRejectsOtherFiles) {
+  EXPECT_EQ(nullptr, EventRing::Map(open("/dev/null", O_RDWR)));
+}
+
+TEST(EventRingTest, ScanResultRoundTrip) {
+  ScanResult result("01:02:03:04:05:06", {0x02, 0x01, 0x06}, -42);
+  std::vector<uint8_t> data = EncodeScanResult(result);
+
+  ScanResult decoded;
+  ASSERT_TRUE(DecodeScanResult(data.data(), data.size(), &decoded));
+  EXPECT_EQ(result, decoded);
+
+  EXPECT_FALSE(DecodeScanResult(data.data(), 10, &decoded));
+  data[1] = 3;
+  EXPECT_FALSE(DecodeScanResult(data.data(), data.size(), &decoded));
+}
+
+}  // namespace
+}  // namespace bluetooth
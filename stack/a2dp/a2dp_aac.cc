@@ -32,6 +32,7 @@
 #include <base/logging.h>
 #include "a2dp_aac_decoder.h"
 #include "a2dp_aac_encoder.h"
+#include "a2dp_codec_select.h"
 #include "bt_utils.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
@@ -118,7 +119,8 @@ static const tA2DP_ENCODER_INTERFACE a2dp_encoder_interface_aac = {
     a2dp_aac_feeding_flush,
     a2dp_aac_get_encoder_interval_ms,
     a2dp_aac_send_frames,
-    nullptr  // set_transmit_queue_length
+    nullptr,  // set_transmit_queue_length
+    a2dp_aac_set_bitrate_percent
 };
 
 static const tA2DP_DECODER_INTERFACE a2dp_decoder_interface_aac = {
@@ -826,6 +828,48 @@ bool A2dpCodecConfigAacSource::init() {
 
 bool A2dpCodecConfigAacSource::useRtpHeaderMarkerBit() const { return true; }
 
+// The AAC sample rates, from the most preferred one
+static const tA2DP_CODEC_FIELD_VALUE<btav_a2dp_codec_sample_rate_t>
+    a2dp_aac_sample_rates[] = {
+        {A2DP_AAC_SAMPLING_FREQ_96000, BTAV_A2DP_CODEC_SAMPLE_RATE_96000},
+        {A2DP_AAC_SAMPLING_FREQ_88200, BTAV_A2DP_CODEC_SAMPLE_RATE_88200},
+        {A2DP_AAC_SAMPLING_FREQ_48000, BTAV_A2DP_CODEC_SAMPLE_RATE_48000},
+        {A2DP_AAC_SAMPLING_FREQ_44100, BTAV_A2DP_CODEC_SAMPLE_RATE_44100},
+};
+
+// The AAC bits per sample, from the most preferred one. They are not sent
+// OTA: the capability bits are the btav_a2dp_codec_config_t values.
+static const tA2DP_CODEC_FIELD_VALUE<btav_a2dp_codec_bits_per_sample_t>
+    a2dp_aac_bits_per_samples[] = {
+        {BTAV_A2DP_CODEC_BITS_PER_SAMPLE_32,
+         BTAV_A2DP_CODEC_BITS_PER_SAMPLE_32},
+        {BTAV_A2DP_CODEC_BITS_PER_SAMPLE_24,
+         BTAV_A2DP_CODEC_BITS_PER_SAMPLE_24},
+        {BTAV_A2DP_CODEC_BITS_PER_SAMPLE_16,
+         BTAV_A2DP_CODEC_BITS_PER_SAMPLE_16},
+};
+
+// The AAC channel modes, from the most preferred one
+static const tA2DP_CODEC_FIELD_VALUE<btav_a2dp_codec_channel_mode_t>
+    a2dp_aac_channel_modes[] = {
+        {A2DP_AAC_CHANNEL_MODE_STEREO, BTAV_A2DP_CODEC_CHANNEL_MODE_STEREO},
+        {A2DP_AAC_CHANNEL_MODE_MONO, BTAV_A2DP_CODEC_CHANNEL_MODE_MONO},
+};
+
+//
+// Uses the sample rate |p_value|, if any.
+// The result is stored in |p_result| and |p_codec_config|.
+// Returns true if a selection was made, otherwise false.
+//
+static bool use_sample_rate(
+    const tA2DP_CODEC_FIELD_VALUE<btav_a2dp_codec_sample_rate_t>* p_value,
+    tA2DP_AAC_CIE* p_result, btav_a2dp_codec_config_t* p_codec_config) {
+  if (p_value == nullptr) return false;
+  p_result->sampleRate = p_value->ie_bit;
+  p_codec_config->sample_rate = p_value->btav_value;
+  return true;
+}
+
 //
 // Selects the best sample rate from |sampleRate|.
 // The result is stored in |p_result| and |p_codec_config|.
@@ -834,27 +878,9 @@ bool A2dpCodecConfigAacSource::useRtpHeaderMarkerBit() const { return true; }
 static bool select_best_sample_rate(uint16_t sampleRate,
                                     tA2DP_AAC_CIE* p_result,
                                     btav_a2dp_codec_config_t* p_codec_config) {
-  if (sampleRate & A2DP_AAC_SAMPLING_FREQ_96000) {
-    p_result->sampleRate = A2DP_AAC_SAMPLING_FREQ_96000;
-    p_codec_config->sample_rate = BTAV_A2DP_CODEC_SAMPLE_RATE_96000;
-    return true;
-  }
-  if (sampleRate & A2DP_AAC_SAMPLING_FREQ_88200) {
-    p_result->sampleRate = A2DP_AAC_SAMPLING_FREQ_88200;
-    p_codec_config->sample_rate = BTAV_A2DP_CODEC_SAMPLE_RATE_88200;
-    return true;
-  }
-  if (sampleRate & A2DP_AAC_SAMPLING_FREQ_48000) {
-    p_result->sampleRate = A2DP_AAC_SAMPLING_FREQ_48000;
-    p_codec_config->sample_rate = BTAV_A2DP_CODEC_SAMPLE_RATE_48000;
-    return true;
-  }
-  if (sampleRate & A2DP_AAC_SAMPLING_FREQ_44100) {
-    p_result->sampleRate = A2DP_AAC_SAMPLING_FREQ_44100;
-    p_codec_config->sample_rate = BTAV_A2DP_CODEC_SAMPLE_RATE_44100;
-    return true;
-  }
-  return false;
+  return use_sample_rate(
+      A2DP_SelectBestFieldValue(a2dp_aac_sample_rates, sampleRate), p_result,
+      p_codec_config);
 }
 
 //
@@ -866,43 +892,24 @@ static bool select_best_sample_rate(uint16_t sampleRate,
 static bool select_audio_sample_rate(
     const btav_a2dp_codec_config_t* p_codec_audio_config, uint16_t sampleRate,
     tA2DP_AAC_CIE* p_result, btav_a2dp_codec_config_t* p_codec_config) {
-  switch (p_codec_audio_config->sample_rate) {
-    case BTAV_A2DP_CODEC_SAMPLE_RATE_44100:
-      if (sampleRate & A2DP_AAC_SAMPLING_FREQ_44100) {
-        p_result->sampleRate = A2DP_AAC_SAMPLING_FREQ_44100;
-        p_codec_config->sample_rate = BTAV_A2DP_CODEC_SAMPLE_RATE_44100;
-        return true;
-      }
-      break;
-    case BTAV_A2DP_CODEC_SAMPLE_RATE_48000:
-      if (sampleRate & A2DP_AAC_SAMPLING_FREQ_48000) {
-        p_result->sampleRate = A2DP_AAC_SAMPLING_FREQ_48000;
-        p_codec_config->sample_rate = BTAV_A2DP_CODEC_SAMPLE_RATE_48000;
-        return true;
-      }
-      break;
-    case BTAV_A2DP_CODEC_SAMPLE_RATE_88200:
-      if (sampleRate & A2DP_AAC_SAMPLING_FREQ_88200) {
-        p_result->sampleRate = A2DP_AAC_SAMPLING_FREQ_88200;
-        p_codec_config->sample_rate = BTAV_A2DP_CODEC_SAMPLE_RATE_88200;
-        return true;
-      }
-      break;
-    case BTAV_A2DP_CODEC_SAMPLE_RATE_96000:
-      if (sampleRate & A2DP_AAC_SAMPLING_FREQ_96000) {
-        p_result->sampleRate = A2DP_AAC_SAMPLING_FREQ_96000;
-        p_codec_config->sample_rate = BTAV_A2DP_CODEC_SAMPLE_RATE_96000;
-        return true;
-      }
-      break;
-    case BTAV_A2DP_CODEC_SAMPLE_RATE_176400:
-    case BTAV_A2DP_CODEC_SAMPLE_RATE_192000:
-    case BTAV_A2DP_CODEC_SAMPLE_RATE_16000:
-    case BTAV_A2DP_CODEC_SAMPLE_RATE_24000:
-    case BTAV_A2DP_CODEC_SAMPLE_RATE_NONE:
-      break;
-  }
-  return false;
+  return use_sample_rate(
+      A2DP_SelectFieldValue(a2dp_aac_sample_rates, sampleRate,
+                            p_codec_audio_config->sample_rate),
+      p_result, p_codec_config);
+}
+
+//
+// Uses the bits per sample |p_value|, if any.
+// The result is stored in |p_result| and |p_codec_config|.
+// Returns true if a selection was made, otherwise false.
+//
+static bool use_bits_per_sample(
+    const tA2DP_CODEC_FIELD_VALUE<btav_a2dp_codec_bits_per_sample_t>* p_value,
+    tA2DP_AAC_CIE* p_result, btav_a2dp_codec_config_t* p_codec_config) {
+  if (p_value == nullptr) return false;
+  p_codec_config->bits_per_sample = p_value->btav_value;
+  p_result->bits_per_sample = p_value->btav_value;
+  return true;
 }
 
 //
@@ -914,22 +921,9 @@ static bool select_audio_sample_rate(
 static bool select_best_bits_per_sample(
     btav_a2dp_codec_bits_per_sample_t bits_per_sample, tA2DP_AAC_CIE* p_result,
     btav_a2dp_codec_config_t* p_codec_config) {
-  if (bits_per_sample & BTAV_A2DP_CODEC_BITS_PER_SAMPLE_32) {
-    p_codec_config->bits_per_sample = BTAV_A2DP_CODEC_BITS_PER_SAMPLE_32;
-    p_result->bits_per_sample = BTAV_A2DP_CODEC_BITS_PER_SAMPLE_32;
-    return true;
-  }
-  if (bits_per_sample & BTAV_A2DP_CODEC_BITS_PER_SAMPLE_24) {
-    p_codec_config->bits_per_sample = BTAV_A2DP_CODEC_BITS_PER_SAMPLE_24;
-    p_result->bits_per_sample = BTAV_A2DP_CODEC_BITS_PER_SAMPLE_24;
-    return true;
-  }
-  if (bits_per_sample & BTAV_A2DP_CODEC_BITS_PER_SAMPLE_16) {
-    p_codec_config->bits_per_sample = BTAV_A2DP_CODEC_BITS_PER_SAMPLE_16;
-    p_result->bits_per_sample = BTAV_A2DP_CODEC_BITS_PER_SAMPLE_16;
-    return true;
-  }
-  return false;
+  return use_bits_per_sample(
+      A2DP_SelectBestFieldValue(a2dp_aac_bits_per_samples, bits_per_sample),
+      p_result, p_codec_config);
 }
 
 //
@@ -942,32 +936,24 @@ static bool select_audio_bits_per_sample(
     const btav_a2dp_codec_config_t* p_codec_audio_config,
     btav_a2dp_codec_bits_per_sample_t bits_per_sample, tA2DP_AAC_CIE* p_result,
     btav_a2dp_codec_config_t* p_codec_config) {
-  switch (p_codec_audio_config->bits_per_sample) {
-    case BTAV_A2DP_CODEC_BITS_PER_SAMPLE_16:
-      if (bits_per_sample & BTAV_A2DP_CODEC_BITS_PER_SAMPLE_16) {
-        p_codec_config->bits_per_sample = BTAV_A2DP_CODEC_BITS_PER_SAMPLE_16;
-        p_result->bits_per_sample = BTAV_A2DP_CODEC_BITS_PER_SAMPLE_16;
-        return true;
-      }
-      break;
-    case BTAV_A2DP_CODEC_BITS_PER_SAMPLE_24:
-      if (bits_per_sample & BTAV_A2DP_CODEC_BITS_PER_SAMPLE_24) {
-        p_codec_config->bits_per_sample = BTAV_A2DP_CODEC_BITS_PER_SAMPLE_24;
-        p_result->bits_per_sample = BTAV_A2DP_CODEC_BITS_PER_SAMPLE_24;
-        return true;
-      }
-      break;
-    case BTAV_A2DP_CODEC_BITS_PER_SAMPLE_32:
-      if (bits_per_sample & BTAV_A2DP_CODEC_BITS_PER_SAMPLE_32) {
-        p_codec_config->bits_per_sample = BTAV_A2DP_CODEC_BITS_PER_SAMPLE_32;
-        p_result->bits_per_sample = BTAV_A2DP_CODEC_BITS_PER_SAMPLE_32;
-        return true;
-      }
-      break;
-    case BTAV_A2DP_CODEC_BITS_PER_SAMPLE_NONE:
-      break;
-  }
-  return false;
+  return use_bits_per_sample(
+      A2DP_SelectFieldValue(a2dp_aac_bits_per_samples, bits_per_sample,
+                            p_codec_audio_config->bits_per_sample),
+      p_result, p_codec_config);
+}
+
+//
+// Uses the channel mode |p_value|, if any.
+// The result is stored in |p_result| and |p_codec_config|.
+// Returns true if a selection was made, otherwise false.
+//
+static bool use_channel_mode(
+    const tA2DP_CODEC_FIELD_VALUE<btav_a2dp_codec_channel_mode_t>* p_value,
+    tA2DP_AAC_CIE* p_result, btav_a2dp_codec_config_t* p_codec_config) {
+  if (p_value == nullptr) return false;
+  p_result->channelMode = p_value->ie_bit;
+  p_codec_config->channel_mode = p_value->btav_value;
+  return true;
 }
 
 //
@@ -978,17 +964,9 @@ static bool select_audio_bits_per_sample(
 static bool select_best_channel_mode(uint8_t channelMode,
                                      tA2DP_AAC_CIE* p_result,
                                      btav_a2dp_codec_config_t* p_codec_config) {
-  if (channelMode & A2DP_AAC_CHANNEL_MODE_STEREO) {
-    p_result->channelMode = A2DP_AAC_CHANNEL_MODE_STEREO;
-    p_codec_config->channel_mode = BTAV_A2DP_CODEC_CHANNEL_MODE_STEREO;
-    return true;
-  }
-  if (channelMode & A2DP_AAC_CHANNEL_MODE_MONO) {
-    p_result->channelMode = A2DP_AAC_CHANNEL_MODE_MONO;
-    p_codec_config->channel_mode = BTAV_A2DP_CODEC_CHANNEL_MODE_MONO;
-    return true;
-  }
-  return false;
+  return use_channel_mode(
+      A2DP_SelectBestFieldValue(a2dp_aac_channel_modes, channelMode), p_result,
+      p_codec_config);
 }
 
 //
@@ -1000,27 +978,10 @@ static bool select_best_channel_mode(uint8_t channelMode,
 static bool select_audio_channel_mode(
     const btav_a2dp_codec_config_t* p_codec_audio_config, uint8_t channelMode,
     tA2DP_AAC_CIE* p_result, btav_a2dp_codec_config_t* p_codec_config) {
-  switch (p_codec_audio_config->channel_mode) {
-    case BTAV_A2DP_CODEC_CHANNEL_MODE_MONO:
-      if (channelMode & A2DP_AAC_CHANNEL_MODE_MONO) {
-        p_result->channelMode = A2DP_AAC_CHANNEL_MODE_MONO;
-        p_codec_config->channel_mode = BTAV_A2DP_CODEC_CHANNEL_MODE_MONO;
-        return true;
-      }
-      break;
-    case BTAV_A2DP_CODEC_CHANNEL_MODE_STEREO:
-      if (channelMode & A2DP_AAC_CHANNEL_MODE_STEREO) {
-        p_result->channelMode = A2DP_AAC_CHANNEL_MODE_STEREO;
-        p_codec_config->channel_mode = BTAV_A2DP_CODEC_CHANNEL_MODE_STEREO;
-        return true;
-      }
-      break;
-    case BTAV_A2DP_CODEC_CHANNEL_MODE_DUAL_CHANNEL:
-    case BTAV_A2DP_CODEC_CHANNEL_MODE_NONE:
-      break;
-  }
-
-  return false;
+  return use_channel_mode(
+      A2DP_SelectFieldValue(a2dp_aac_channel_modes, channelMode,
+                            p_codec_audio_config->channel_mode),
+      p_result, p_codec_config);
 }
 
 bool A2dpCodecConfigAacBase::setCodecConfig(const uint8_t* p_peer_codec_info,
@@ -1101,76 +1062,25 @@ bool A2dpCodecConfigAacBase::setCodecConfig(const uint8_t* p_peer_codec_info,
   //
   sampleRate = p_a2dp_aac_caps->sampleRate & peer_info_cie.sampleRate;
   codec_config_.sample_rate = BTAV_A2DP_CODEC_SAMPLE_RATE_NONE;
-  switch (codec_user_config_.sample_rate) {
-    case BTAV_A2DP_CODEC_SAMPLE_RATE_44100:
-      if (sampleRate & A2DP_AAC_SAMPLING_FREQ_44100) {
-        result_config_cie.sampleRate = A2DP_AAC_SAMPLING_FREQ_44100;
-        codec_capability_.sample_rate = codec_user_config_.sample_rate;
-        codec_config_.sample_rate = codec_user_config_.sample_rate;
-      }
-      break;
-    case BTAV_A2DP_CODEC_SAMPLE_RATE_48000:
-      if (sampleRate & A2DP_AAC_SAMPLING_FREQ_48000) {
-        result_config_cie.sampleRate = A2DP_AAC_SAMPLING_FREQ_48000;
-        codec_capability_.sample_rate = codec_user_config_.sample_rate;
-        codec_config_.sample_rate = codec_user_config_.sample_rate;
-      }
-      break;
-    case BTAV_A2DP_CODEC_SAMPLE_RATE_88200:
-      if (sampleRate & A2DP_AAC_SAMPLING_FREQ_88200) {
-        result_config_cie.sampleRate = A2DP_AAC_SAMPLING_FREQ_88200;
-        codec_capability_.sample_rate = codec_user_config_.sample_rate;
-        codec_config_.sample_rate = codec_user_config_.sample_rate;
-      }
-      break;
-    case BTAV_A2DP_CODEC_SAMPLE_RATE_96000:
-      if (sampleRate & A2DP_AAC_SAMPLING_FREQ_96000) {
-        result_config_cie.sampleRate = A2DP_AAC_SAMPLING_FREQ_96000;
-        codec_capability_.sample_rate = codec_user_config_.sample_rate;
-        codec_config_.sample_rate = codec_user_config_.sample_rate;
-      }
-      break;
-    case BTAV_A2DP_CODEC_SAMPLE_RATE_176400:
-    case BTAV_A2DP_CODEC_SAMPLE_RATE_192000:
-    case BTAV_A2DP_CODEC_SAMPLE_RATE_16000:
-    case BTAV_A2DP_CODEC_SAMPLE_RATE_24000:
-    case BTAV_A2DP_CODEC_SAMPLE_RATE_NONE:
-      codec_capability_.sample_rate = BTAV_A2DP_CODEC_SAMPLE_RATE_NONE;
-      codec_config_.sample_rate = BTAV_A2DP_CODEC_SAMPLE_RATE_NONE;
-      break;
+  if (!A2DP_FieldHasBtavValue(a2dp_aac_sample_rates,
+                              codec_user_config_.sample_rate)) {
+    codec_capability_.sample_rate = BTAV_A2DP_CODEC_SAMPLE_RATE_NONE;
+  } else if (select_audio_sample_rate(&codec_user_config_, sampleRate,
+                                      &result_config_cie, &codec_config_)) {
+    codec_capability_.sample_rate = codec_user_config_.sample_rate;
   }
 
   // Select the sample frequency if there is no user preference
   do {
     // Compute the selectable capability
-    if (sampleRate & A2DP_AAC_SAMPLING_FREQ_44100) {
-      codec_selectable_capability_.sample_rate |=
-          BTAV_A2DP_CODEC_SAMPLE_RATE_44100;
-    }
-    if (sampleRate & A2DP_AAC_SAMPLING_FREQ_48000) {
-      codec_selectable_capability_.sample_rate |=
-          BTAV_A2DP_CODEC_SAMPLE_RATE_48000;
-    }
-    if (sampleRate & A2DP_AAC_SAMPLING_FREQ_88200) {
-      codec_selectable_capability_.sample_rate |=
-          BTAV_A2DP_CODEC_SAMPLE_RATE_88200;
-    }
-    if (sampleRate & A2DP_AAC_SAMPLING_FREQ_96000) {
-      codec_selectable_capability_.sample_rate |=
-          BTAV_A2DP_CODEC_SAMPLE_RATE_96000;
-    }
+    codec_selectable_capability_.sample_rate |=
+        A2DP_FieldBtavValues(a2dp_aac_sample_rates, sampleRate);
 
     if (codec_config_.sample_rate != BTAV_A2DP_CODEC_SAMPLE_RATE_NONE) break;
 
     // Compute the common capability
-    if (sampleRate & A2DP_AAC_SAMPLING_FREQ_44100)
-      codec_capability_.sample_rate |= BTAV_A2DP_CODEC_SAMPLE_RATE_44100;
-    if (sampleRate & A2DP_AAC_SAMPLING_FREQ_48000)
-      codec_capability_.sample_rate |= BTAV_A2DP_CODEC_SAMPLE_RATE_48000;
-    if (sampleRate & A2DP_AAC_SAMPLING_FREQ_88200)
-      codec_capability_.sample_rate |= BTAV_A2DP_CODEC_SAMPLE_RATE_88200;
-    if (sampleRate & A2DP_AAC_SAMPLING_FREQ_96000)
-      codec_capability_.sample_rate |= BTAV_A2DP_CODEC_SAMPLE_RATE_96000;
+    codec_capability_.sample_rate |=
+        A2DP_FieldBtavValues(a2dp_aac_sample_rates, sampleRate);
 
     // No user preference - try the codec audio config
     if (select_audio_sample_rate(&codec_audio_config_, sampleRate,
@@ -1206,33 +1116,12 @@ bool A2dpCodecConfigAacBase::setCodecConfig(const uint8_t* p_peer_codec_info,
   // that is sent OTA.
   bits_per_sample = p_a2dp_aac_caps->bits_per_sample;
   codec_config_.bits_per_sample = BTAV_A2DP_CODEC_BITS_PER_SAMPLE_NONE;
-  switch (codec_user_config_.bits_per_sample) {
-    case BTAV_A2DP_CODEC_BITS_PER_SAMPLE_16:
-      if (bits_per_sample & BTAV_A2DP_CODEC_BITS_PER_SAMPLE_16) {
-        result_config_cie.bits_per_sample = codec_user_config_.bits_per_sample;
-        codec_capability_.bits_per_sample = codec_user_config_.bits_per_sample;
-        codec_config_.bits_per_sample = codec_user_config_.bits_per_sample;
-      }
-      break;
-    case BTAV_A2DP_CODEC_BITS_PER_SAMPLE_24:
-      if (bits_per_sample & BTAV_A2DP_CODEC_BITS_PER_SAMPLE_24) {
-        result_config_cie.bits_per_sample = codec_user_config_.bits_per_sample;
-        codec_capability_.bits_per_sample = codec_user_config_.bits_per_sample;
-        codec_config_.bits_per_sample = codec_user_config_.bits_per_sample;
-      }
-      break;
-    case BTAV_A2DP_CODEC_BITS_PER_SAMPLE_32:
-      if (bits_per_sample & BTAV_A2DP_CODEC_BITS_PER_SAMPLE_32) {
-        result_config_cie.bits_per_sample = codec_user_config_.bits_per_sample;
-        codec_capability_.bits_per_sample = codec_user_config_.bits_per_sample;
-        codec_config_.bits_per_sample = codec_user_config_.bits_per_sample;
-      }
-      break;
-    case BTAV_A2DP_CODEC_BITS_PER_SAMPLE_NONE:
-      result_config_cie.bits_per_sample = BTAV_A2DP_CODEC_BITS_PER_SAMPLE_NONE;
-      codec_capability_.bits_per_sample = BTAV_A2DP_CODEC_BITS_PER_SAMPLE_NONE;
-      codec_config_.bits_per_sample = BTAV_A2DP_CODEC_BITS_PER_SAMPLE_NONE;
-      break;
+  if (!A2DP_FieldHasBtavValue(a2dp_aac_bits_per_samples,
+                              codec_user_config_.bits_per_sample)) {
+    codec_capability_.bits_per_sample = BTAV_A2DP_CODEC_BITS_PER_SAMPLE_NONE;
+  } else if (select_audio_bits_per_sample(&codec_user_config_, bits_per_sample,
+                                          &result_config_cie, &codec_config_)) {
+    codec_capability_.bits_per_sample = codec_user_config_.bits_per_sample;
   }
 
   // Select the bits per sample if there is no user preference
@@ -1280,48 +1169,25 @@ bool A2dpCodecConfigAacBase::setCodecConfig(const uint8_t* p_peer_codec_info,
   //
   channelMode = p_a2dp_aac_caps->channelMode & peer_info_cie.channelMode;
   codec_config_.channel_mode = BTAV_A2DP_CODEC_CHANNEL_MODE_NONE;
-  switch (codec_user_config_.channel_mode) {
-    case BTAV_A2DP_CODEC_CHANNEL_MODE_MONO:
-      if (channelMode & A2DP_AAC_CHANNEL_MODE_MONO) {
-        result_config_cie.channelMode = A2DP_AAC_CHANNEL_MODE_MONO;
-        codec_capability_.channel_mode = codec_user_config_.channel_mode;
-        codec_config_.channel_mode = codec_user_config_.channel_mode;
-      }
-      break;
-    case BTAV_A2DP_CODEC_CHANNEL_MODE_STEREO:
-      if (channelMode & A2DP_AAC_CHANNEL_MODE_STEREO) {
-        result_config_cie.channelMode = A2DP_AAC_CHANNEL_MODE_STEREO;
-        codec_capability_.channel_mode = codec_user_config_.channel_mode;
-        codec_config_.channel_mode = codec_user_config_.channel_mode;
-      }
-      break;
-    case BTAV_A2DP_CODEC_CHANNEL_MODE_DUAL_CHANNEL:
-    case BTAV_A2DP_CODEC_CHANNEL_MODE_NONE:
-      codec_capability_.channel_mode = BTAV_A2DP_CODEC_CHANNEL_MODE_NONE;
-      codec_config_.channel_mode = BTAV_A2DP_CODEC_CHANNEL_MODE_NONE;
-      break;
+  if (!A2DP_FieldHasBtavValue(a2dp_aac_channel_modes,
+                              codec_user_config_.channel_mode)) {
+    codec_capability_.channel_mode = BTAV_A2DP_CODEC_CHANNEL_MODE_NONE;
+  } else if (select_audio_channel_mode(&codec_user_config_, channelMode,
+                                       &result_config_cie, &codec_config_)) {
+    codec_capability_.channel_mode = codec_user_config_.channel_mode;
   }
 
   // Select the channel mode if there is no user preference
   do {
     // Compute the selectable capability
-    if (channelMode & A2DP_AAC_CHANNEL_MODE_MONO) {
-      codec_selectable_capability_.channel_mode |=
-          BTAV_A2DP_CODEC_CHANNEL_MODE_MONO;
-    }
-    if (channelMode & A2DP_AAC_CHANNEL_MODE_STEREO) {
-      codec_selectable_capability_.channel_mode |=
-          BTAV_A2DP_CODEC_CHANNEL_MODE_STEREO;
-    }
+    codec_selectable_capability_.channel_mode |=
+        A2DP_FieldBtavValues(a2dp_aac_channel_modes, channelMode);
 
     if (codec_config_.channel_mode != BTAV_A2DP_CODEC_CHANNEL_MODE_NONE) break;
 
     // Compute the common capability
-    if (channelMode & A2DP_AAC_CHANNEL_MODE_MONO)
-      codec_capability_.channel_mode |= BTAV_A2DP_CODEC_CHANNEL_MODE_MONO;
-    if (channelMode & A2DP_AAC_CHANNEL_MODE_STEREO) {
-      codec_capability_.channel_mode |= BTAV_A2DP_CODEC_CHANNEL_MODE_STEREO;
-    }
+    codec_capability_.channel_mode |=
+        A2DP_FieldBtavValues(a2dp_aac_channel_modes, channelMode);
 
     // No user preference - try the codec audio config
     if (select_audio_channel_mode(&codec_audio_config_, channelMode,
@@ -1455,22 +1321,8 @@ bool A2dpCodecConfigAacBase::setPeerCodecCapabilities(
 
   // Compute the selectable capability - sample rate
   sampleRate = p_a2dp_aac_caps->sampleRate & peer_info_cie.sampleRate;
-  if (sampleRate & A2DP_AAC_SAMPLING_FREQ_44100) {
-    codec_selectable_capability_.sample_rate |=
-        BTAV_A2DP_CODEC_SAMPLE_RATE_44100;
-  }
-  if (sampleRate & A2DP_AAC_SAMPLING_FREQ_48000) {
-    codec_selectable_capability_.sample_rate |=
-        BTAV_A2DP_CODEC_SAMPLE_RATE_48000;
-  }
-  if (sampleRate & A2DP_AAC_SAMPLING_FREQ_88200) {
-    codec_selectable_capability_.sample_rate |=
-        BTAV_A2DP_CODEC_SAMPLE_RATE_88200;
-  }
-  if (sampleRate & A2DP_AAC_SAMPLING_FREQ_96000) {
-    codec_selectable_capability_.sample_rate |=
-        BTAV_A2DP_CODEC_SAMPLE_RATE_96000;
-  }
+  codec_selectable_capability_.sample_rate |=
+      A2DP_FieldBtavValues(a2dp_aac_sample_rates, sampleRate);
 
   // Compute the selectable capability - bits per sample
   codec_selectable_capability_.bits_per_sample =
@@ -1478,14 +1330,8 @@ bool A2dpCodecConfigAacBase::setPeerCodecCapabilities(
 
   // Compute the selectable capability - channel mode
   channelMode = p_a2dp_aac_caps->channelMode & peer_info_cie.channelMode;
-  if (channelMode & A2DP_AAC_CHANNEL_MODE_MONO) {
-    codec_selectable_capability_.channel_mode |=
-        BTAV_A2DP_CODEC_CHANNEL_MODE_MONO;
-  }
-  if (channelMode & A2DP_AAC_CHANNEL_MODE_STEREO) {
-    codec_selectable_capability_.channel_mode |=
-        BTAV_A2DP_CODEC_CHANNEL_MODE_STEREO;
-  }
+  codec_selectable_capability_.channel_mode |=
+      A2DP_FieldBtavValues(a2dp_aac_channel_modes, channelMode);
 
   // Compute the selectable capability - variable bitrate mode
   variableBitRateSupport = p_a2dp_aac_caps->variableBitRateSupport &
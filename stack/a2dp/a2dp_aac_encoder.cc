@@ -86,6 +86,9 @@ typedef struct {
 
   HANDLE_AACENCODER aac_handle;
   bool has_aac_handle;  // True if aac_handle is valid
+  int bit_rate;         // Bit rate of the codec config, within the MTU
+  int peak_bit_rate;    // Peak bit rate the MTU allows
+  uint8_t bitrate_percent;  // Share of |bit_rate| to encode at
 
   tA2DP_FEEDING_PARAMS feeding_params;
   tA2DP_AAC_ENCODER_PARAMS aac_encoder_params;
@@ -138,6 +141,7 @@ void a2dp_aac_encoder_init(const tA2DP_ENCODER_INIT_PEER_PARAMS* p_peer_params,
   a2dp_aac_encoder_cb.peer_supports_3mbps = p_peer_params->peer_supports_3mbps;
   a2dp_aac_encoder_cb.peer_mtu = p_peer_params->peer_mtu;
   a2dp_aac_encoder_cb.timestamp = 0;
+  a2dp_aac_encoder_cb.bitrate_percent = 100;
 
   a2dp_aac_encoder_cb.use_SCMS_T = false;  // TODO: should be a parameter
 #if (BTA_AV_CO_CP_SCMS_T == TRUE)
@@ -345,6 +349,12 @@ static void a2dp_aac_encoder_update(uint16_t peer_mtu,
               __func__);
     return;  // TODO: Return an error?
   }
+  a2dp_aac_encoder_cb.bit_rate = aac_param_value;
+  a2dp_aac_encoder_cb.peak_bit_rate = aac_peak_bit_rate;
+  // Keep the bit rate the link adaptation picked
+  aac_param_value = aac_param_value * a2dp_aac_encoder_cb.bitrate_percent / 100;
+  aac_peak_bit_rate =
+      aac_peak_bit_rate * a2dp_aac_encoder_cb.bitrate_percent / 100;
   aac_error = aacEncoder_SetParam(a2dp_aac_encoder_cb.aac_handle,
                                   AACENC_BITRATE, aac_param_value);
   if (aac_error != AACENC_OK) {
@@ -524,6 +534,39 @@ void a2dp_aac_feeding_flush(void) {
   a2dp_aac_encoder_cb.aac_feeding_state.counter = 0;
 }
 
+void a2dp_aac_set_bitrate_percent(uint8_t bitrate_percent) {
+  if (bitrate_percent == 0 || bitrate_percent > 100) return;
+  if (bitrate_percent == a2dp_aac_encoder_cb.bitrate_percent) return;
+  if (!a2dp_aac_encoder_cb.has_aac_handle || a2dp_aac_encoder_cb.bit_rate <= 0)
+    return;
+
+  // The encoder applies the new bit rates from the next frame on. In VBR
+  // mode, the peak bit rate bounds the frames.
+  int bit_rate = a2dp_aac_encoder_cb.bit_rate * bitrate_percent / 100;
+  int peak_bit_rate = a2dp_aac_encoder_cb.peak_bit_rate * bitrate_percent / 100;
+  AACENC_ERROR aac_error = aacEncoder_SetParam(
+      a2dp_aac_encoder_cb.aac_handle, AACENC_BITRATE, bit_rate);
+  if (aac_error != AACENC_OK) {
+    LOG_ERROR(LOG_TAG,
+              "%s: Cannot set AAC parameter AACENC_BITRATE to %d: "
+              "AAC error 0x%x",
+              __func__, bit_rate, aac_error);
+    return;
+  }
+  aac_error = aacEncoder_SetParam(a2dp_aac_encoder_cb.aac_handle,
+                                  AACENC_PEAK_BITRATE, peak_bit_rate);
+  if (aac_error != AACENC_OK) {
+    LOG_ERROR(LOG_TAG,
+              "%s: Cannot set AAC parameter AACENC_PEAK_BITRATE to %d: "
+              "AAC error 0x%x",
+              __func__, peak_bit_rate, aac_error);
+    return;
+  }
+  a2dp_aac_encoder_cb.bitrate_percent = bitrate_percent;
+  LOG_INFO(LOG_TAG, "%s: %u%% of the bit rate: %d bps, peak %d bps", __func__,
+           bitrate_percent, bit_rate, peak_bit_rate);
+}
+
 uint64_t a2dp_aac_get_encoder_interval_ms(void) {
   return a2dp_aac_encoder_interval_ms;
 }
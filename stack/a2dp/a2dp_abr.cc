@@ -0,0 +1,156 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "a2dp_abr.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+constexpr uint8_t A2dpAbr::kBitratePercents[];
+
+// More packets than that in the transmit queue: the link doesn't keep up
+static constexpr size_t kTransmitQueueStruggling = 4;
+// At most that many packets: the link drains the queue each tick
+static constexpr size_t kTransmitQueueHealthy = 1;
+
+// Link quality thresholds, for the counters of a report
+static constexpr int8_t kRssiStrugglingDbm = -80;
+static constexpr int8_t kRssiHealthyDbm = -70;
+static constexpr uint32_t kRetransmissionsStruggling = 30;
+static constexpr uint32_t kRetransmissionsHealthy = 5;
+static constexpr uint32_t kLostPacketsStruggling = 20;
+static constexpr uint32_t kLostPacketsHealthy = 2;
+
+void A2dpAbr::Reset() {
+  level_ = 0;
+  period_start_ms_ = 0;
+  healthy_since_ms_ = 0;
+  healthy_ = false;
+  max_transmit_queue_length_ = 0;
+  congestion_count_ = 0;
+  has_link_quality_ = false;
+  memset(&worst_link_quality_, 0, sizeof(worst_link_quality_));
+  total_step_downs_ = 0;
+  total_step_ups_ = 0;
+  total_link_quality_reports_ = 0;
+  total_congestions_ = 0;
+}
+
+void A2dpAbr::OnLinkQuality(const tA2DP_ABR_LINK_QUALITY& link_quality) {
+  total_link_quality_reports_++;
+  if (!has_link_quality_) {
+    worst_link_quality_ = link_quality;
+    has_link_quality_ = true;
+    return;
+  }
+  worst_link_quality_.rssi =
+      std::min(worst_link_quality_.rssi, link_quality.rssi);
+  worst_link_quality_.retransmission_count =
+      std::max(worst_link_quality_.retransmission_count,
+               link_quality.retransmission_count);
+  worst_link_quality_.no_rx_count =
+      std::max(worst_link_quality_.no_rx_count, link_quality.no_rx_count);
+  worst_link_quality_.nak_count =
+      std::max(worst_link_quality_.nak_count, link_quality.nak_count);
+  worst_link_quality_.flow_off_count =
+      std::max(worst_link_quality_.flow_off_count, link_quality.flow_off_count);
+}
+
+void A2dpAbr::OnTransmitQueueLength(size_t transmit_queue_length) {
+  max_transmit_queue_length_ =
+      std::max(max_transmit_queue_length_, transmit_queue_length);
+}
+
+void A2dpAbr::OnCongestion() {
+  congestion_count_++;
+  total_congestions_++;
+}
+
+A2dpAbr::LinkState A2dpAbr::EvaluatePeriod() const {
+  if (congestion_count_ > 0 ||
+      max_transmit_queue_length_ >= kTransmitQueueStruggling) {
+    return kLinkStruggling;
+  }
+  const tA2DP_ABR_LINK_QUALITY& lq = worst_link_quality_;
+  uint32_t lost_packets = lq.no_rx_count + lq.nak_count;
+  if (has_link_quality_ &&
+      (lq.rssi <= kRssiStrugglingDbm || lq.flow_off_count > 0 ||
+       lq.retransmission_count >= kRetransmissionsStruggling ||
+       lost_packets >= kLostPacketsStruggling)) {
+    return kLinkStruggling;
+  }
+  if (max_transmit_queue_length_ > kTransmitQueueHealthy) return kLinkFair;
+  // Without reports, the transmit queue tells enough
+  if (has_link_quality_ &&
+      (lq.rssi < kRssiHealthyDbm ||
+       lq.retransmission_count > kRetransmissionsHealthy ||
+       lost_packets > kLostPacketsHealthy)) {
+    return kLinkFair;
+  }
+  return kLinkHealthy;
+}
+
+bool A2dpAbr::Update(uint64_t now_ms) {
+  if (period_start_ms_ == 0) {
+    period_start_ms_ = now_ms;
+    return false;
+  }
+  if (now_ms - period_start_ms_ < kEvaluationIntervalMs) return false;
+
+  size_t previous_level = level_;
+  switch (EvaluatePeriod()) {
+    case kLinkStruggling:
+      healthy_ = false;
+      if (level_ + 1 < kNumLevels) {
+        level_++;
+        total_step_downs_++;
+      }
+      break;
+    case kLinkFair:
+      healthy_ = false;
+      break;
+    case kLinkHealthy:
+      if (!healthy_) {
+        healthy_ = true;
+        healthy_since_ms_ = period_start_ms_;
+      }
+      if (level_ > 0 && now_ms - healthy_since_ms_ >= kStepUpHoldMs) {
+        level_--;
+        total_step_ups_++;
+        // Each step up must be earned again
+        healthy_since_ms_ = now_ms;
+      }
+      break;
+  }
+
+  period_start_ms_ = now_ms;
+  max_transmit_queue_length_ = 0;
+  congestion_count_ = 0;
+  has_link_quality_ = false;
+  return level_ != previous_level;
+}
+
+void A2dpAbr::DebugDump(int fd) const {
+  dprintf(fd,
+          "  Adaptive bitrate (percent/steps down/steps up)          : %u / "
+          "%zu / %zu\n",
+          GetBitratePercent(), total_step_downs_, total_step_ups_);
+  dprintf(fd,
+          "  Adaptive bitrate inputs (quality reports/congestions)   : %zu / "
+          "%zu\n",
+          total_link_quality_reports_, total_congestions_);
+}
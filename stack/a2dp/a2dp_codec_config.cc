@@ -1505,3 +1505,34 @@ std::string A2DP_CodecInfoString(const uint8_t* p_codec_info) {
 
   return "Unsupported codec type: " + loghex(codec_type);
 }
+
+bool A2DP_IsCodecUserConfigInPlace(
+    const btav_a2dp_codec_config_t& current_config,
+    const btav_a2dp_codec_config_t& user_config, bool is_offloading) {
+  if (user_config.codec_type != current_config.codec_type) return false;
+
+  // The unset fields of the user config keep their current value
+  if (user_config.sample_rate != BTAV_A2DP_CODEC_SAMPLE_RATE_NONE &&
+      user_config.sample_rate != current_config.sample_rate) {
+    return false;
+  }
+  if (user_config.bits_per_sample != BTAV_A2DP_CODEC_BITS_PER_SAMPLE_NONE &&
+      user_config.bits_per_sample != current_config.bits_per_sample) {
+    return false;
+  }
+  if (user_config.channel_mode != BTAV_A2DP_CODEC_CHANNEL_MODE_NONE &&
+      user_config.channel_mode != current_config.channel_mode) {
+    return false;
+  }
+  if (user_config.codec_specific_2 != current_config.codec_specific_2 ||
+      user_config.codec_specific_3 != current_config.codec_specific_3 ||
+      user_config.codec_specific_4 != current_config.codec_specific_4) {
+    return false;
+  }
+  if (user_config.codec_specific_1 == current_config.codec_specific_1) {
+    return true;
+  }
+  // The LDAC quality mode only tunes the software encoder
+  return !is_offloading &&
+         user_config.codec_type == BTAV_A2DP_CODEC_INDEX_SOURCE_LDAC;
+}
@@ -0,0 +1,282 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * PCM conversions of the A2DP encoders feeding
+ */
+
+#include "a2dp_pcm_convert.h"
+
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define A2DP_PCM_SSE2
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#define A2DP_PCM_SSSE3
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define A2DP_PCM_NEON
+#endif
+
+// Every conversion makes the data larger, so it is done from the last sample
+// to the first: the converted samples only overwrite source samples that were
+// already converted. The vector loops load a whole block of source samples
+// before storing it, and the samples that do not fill a block are converted
+// first, by the scalar code.
+
+void a2dp_pcm_8_to_16(uint8_t* buf, size_t num_samples) {
+  size_t simd_samples = 0;
+#if defined(A2DP_PCM_SSE2) || defined(A2DP_PCM_NEON)
+  simd_samples = num_samples & ~(size_t)15;
+#endif
+
+  for (size_t i = num_samples; i > simd_samples; i--) {
+    // The unsigned sample, less 0x80, in the high byte of the signed one
+    int16_t sample = (int16_t)((buf[i - 1] ^ 0x80) << 8);
+    memcpy(buf + 2 * (i - 1), &sample, sizeof(sample));
+  }
+
+#if defined(A2DP_PCM_SSE2)
+  const __m128i sign = _mm_set1_epi8((char)0x80);
+  const __m128i zero = _mm_setzero_si128();
+  for (size_t i = simd_samples; i > 0; i -= 16) {
+    __m128i v = _mm_xor_si128(
+        _mm_loadu_si128((const __m128i*)(buf + i - 16)), sign);
+    _mm_storeu_si128((__m128i*)(buf + 2 * (i - 16)),
+                     _mm_unpacklo_epi8(zero, v));
+    _mm_storeu_si128((__m128i*)(buf + 2 * (i - 8)),
+                     _mm_unpackhi_epi8(zero, v));
+  }
+#elif defined(A2DP_PCM_NEON)
+  const uint8x16_t sign = vdupq_n_u8(0x80);
+  for (size_t i = simd_samples; i > 0; i -= 16) {
+    uint8x16_t v = veorq_u8(vld1q_u8(buf + i - 16), sign);
+    vst1q_u16((uint16_t*)(buf + 2 * (i - 16)), vshll_n_u8(vget_low_u8(v), 8));
+    vst1q_u16((uint16_t*)(buf + 2 * (i - 8)), vshll_n_u8(vget_high_u8(v), 8));
+  }
+#endif
+}
+
+void a2dp_pcm_24_to_32(uint8_t* buf, size_t num_samples) {
+  size_t simd_samples = 0;
+#if defined(A2DP_PCM_SSSE3)
+  // The 16 bytes loaded for 4 samples run over them by 4 bytes: the blocks
+  // are chosen so the last load still ends in the source data.
+  if (num_samples >= 2) simd_samples = (num_samples - 2) & ~(size_t)3;
+#elif defined(A2DP_PCM_NEON)
+  simd_samples = num_samples & ~(size_t)7;
+#endif
+
+  for (size_t i = num_samples; i > simd_samples; i--) {
+    const uint8_t* p = buf + 3 * (i - 1);
+    int32_t sample = (p[0] << 0) | (p[1] << 8) | (((int8_t)p[2]) << 16);
+    memcpy(buf + 4 * (i - 1), &sample, sizeof(sample));
+  }
+
+#if defined(A2DP_PCM_SSSE3)
+  // The 3 bytes of each sample in the 3 high bytes of its 32 bit lane, then
+  // shifted down, extending the sign.
+  const __m128i shuffle =
+      _mm_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+  for (size_t i = simd_samples; i > 0; i -= 4) {
+    __m128i v = _mm_loadu_si128((const __m128i*)(buf + 3 * (i - 4)));
+    _mm_storeu_si128((__m128i*)(buf + 4 * (i - 4)),
+                     _mm_srai_epi32(_mm_shuffle_epi8(v, shuffle), 8));
+  }
+#elif defined(A2DP_PCM_NEON)
+  for (size_t i = simd_samples; i > 0; i -= 8) {
+    uint8x8x3_t v = vld3_u8(buf + 3 * (i - 8));
+    uint16x8_t low = vorrq_u16(vmovl_u8(v.val[0]), vshll_n_u8(v.val[1], 8));
+    int16x8_t high = vmovl_s8(vreinterpret_s8_u8(v.val[2]));
+    int32x4_t s0 = vorrq_s32(
+        vshll_n_s16(vget_low_s16(high), 16),
+        vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(low))));
+    int32x4_t s1 = vorrq_s32(
+        vshll_n_s16(vget_high_s16(high), 16),
+        vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(low))));
+    vst1q_s32((int32_t*)(buf + 4 * (i - 8)), s0);
+    vst1q_s32((int32_t*)(buf + 4 * (i - 4)), s1);
+  }
+#endif
+}
+
+void a2dp_pcm_mono_to_stereo_16(int16_t* buf, size_t num_frames) {
+  size_t simd_frames = 0;
+#if defined(A2DP_PCM_SSE2) || defined(A2DP_PCM_NEON)
+  simd_frames = num_frames & ~(size_t)7;
+#endif
+
+  for (size_t i = num_frames; i > simd_frames; i--) {
+    int16_t sample = buf[i - 1];
+    buf[2 * (i - 1)] = sample;
+    buf[2 * (i - 1) + 1] = sample;
+  }
+
+#if defined(A2DP_PCM_SSE2)
+  for (size_t i = simd_frames; i > 0; i -= 8) {
+    __m128i v = _mm_loadu_si128((const __m128i*)(buf + i - 8));
+    _mm_storeu_si128((__m128i*)(buf + 2 * (i - 8)), _mm_unpacklo_epi16(v, v));
+    _mm_storeu_si128((__m128i*)(buf + 2 * (i - 4)), _mm_unpackhi_epi16(v, v));
+  }
+#elif defined(A2DP_PCM_NEON)
+  for (size_t i = simd_frames; i > 0; i -= 8) {
+    int16x8_t v = vld1q_s16(buf + i - 8);
+    int16x8x2_t stereo = {{v, v}};
+    vst2q_s16(buf + 2 * (i - 8), stereo);
+  }
+#endif
+}
+
+void a2dp_pcm_upsample_stereo_16(int16_t* buf, size_t num_frames,
+                                 uint32_t ratio) {
+  if (ratio < 2) return;
+
+  // A stereo frame is moved as one 32 bit word
+  uint8_t* frames = (uint8_t*)buf;
+  size_t simd_frames = 0;
+#if defined(A2DP_PCM_SSE2) || defined(A2DP_PCM_NEON)
+  if (ratio == 2) simd_frames = num_frames & ~(size_t)3;
+#endif
+
+  for (size_t i = num_frames; i > simd_frames; i--) {
+    uint32_t frame;
+    memcpy(&frame, frames + 4 * (i - 1), sizeof(frame));
+    uint8_t* p_dst = frames + 4 * ratio * (i - 1);
+    for (uint32_t r = 0; r < ratio; r++) {
+      memcpy(p_dst + 4 * r, &frame, sizeof(frame));
+    }
+  }
+
+#if defined(A2DP_PCM_SSE2)
+  for (size_t i = simd_frames; i > 0; i -= 4) {
+    __m128i v = _mm_loadu_si128((const __m128i*)(frames + 4 * (i - 4)));
+    _mm_storeu_si128((__m128i*)(frames + 8 * (i - 4)),
+                     _mm_unpacklo_epi32(v, v));
+    _mm_storeu_si128((__m128i*)(frames + 8 * (i - 2)),
+                     _mm_unpackhi_epi32(v, v));
+  }
+#elif defined(A2DP_PCM_NEON)
+  for (size_t i = simd_frames; i > 0; i -= 4) {
+    uint32x4_t v = vld1q_u32((const uint32_t*)(frames + 4 * (i - 4)));
+    uint32x4x2_t doubled = {{v, v}};
+    vst2q_u32((uint32_t*)(frames + 8 * (i - 4)), doubled);
+  }
+#endif
+}
+
+// The conversions to float multiply each sample by one factor, scale and gain
+// together, so that the vector and scalar code round the same way.
+
+void a2dp_pcm_16_to_float(const uint8_t* src, float* dst, size_t num_samples,
+                          float gain) {
+  const float factor = gain / 32768.0f;
+  size_t simd_samples = 0;
+#if defined(A2DP_PCM_SSE2)
+  simd_samples = num_samples & ~(size_t)7;
+  const __m128 f = _mm_set1_ps(factor);
+  for (size_t i = 0; i < simd_samples; i += 8) {
+    __m128i v = _mm_loadu_si128((const __m128i*)(src + 2 * i));
+    __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+    __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+    _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), f));
+    _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), f));
+  }
+#elif defined(A2DP_PCM_NEON)
+  simd_samples = num_samples & ~(size_t)7;
+  for (size_t i = 0; i < simd_samples; i += 8) {
+    int16x8_t v = vld1q_s16((const int16_t*)(src + 2 * i));
+    float32x4_t lo = vcvtq_f32_s32(vmovl_s16(vget_low_s16(v)));
+    float32x4_t hi = vcvtq_f32_s32(vmovl_s16(vget_high_s16(v)));
+    vst1q_f32(dst + i, vmulq_n_f32(lo, factor));
+    vst1q_f32(dst + i + 4, vmulq_n_f32(hi, factor));
+  }
+#endif
+
+  for (size_t i = simd_samples; i < num_samples; i++) {
+    int16_t sample;
+    memcpy(&sample, src + 2 * i, sizeof(sample));
+    dst[i] = sample * factor;
+  }
+}
+
+void a2dp_pcm_24_to_float(const uint8_t* src, float* dst, size_t num_samples,
+                          float gain) {
+  const float factor = gain / 8388608.0f;
+  size_t simd_samples = 0;
+#if defined(A2DP_PCM_SSSE3)
+  // As in a2dp_pcm_24_to_32(), the last load of 16 bytes must still end in
+  // the source data
+  if (num_samples >= 2) simd_samples = (num_samples - 2) & ~(size_t)3;
+  const __m128i shuffle =
+      _mm_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+  const __m128 f = _mm_set1_ps(factor);
+  for (size_t i = 0; i < simd_samples; i += 4) {
+    __m128i v = _mm_loadu_si128((const __m128i*)(src + 3 * i));
+    __m128i s = _mm_srai_epi32(_mm_shuffle_epi8(v, shuffle), 8);
+    _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(s), f));
+  }
+#elif defined(A2DP_PCM_NEON)
+  simd_samples = num_samples & ~(size_t)7;
+  for (size_t i = 0; i < simd_samples; i += 8) {
+    uint8x8x3_t v = vld3_u8(src + 3 * i);
+    uint16x8_t low = vorrq_u16(vmovl_u8(v.val[0]), vshll_n_u8(v.val[1], 8));
+    int16x8_t high = vmovl_s8(vreinterpret_s8_u8(v.val[2]));
+    int32x4_t s0 = vorrq_s32(
+        vshll_n_s16(vget_low_s16(high), 16),
+        vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(low))));
+    int32x4_t s1 = vorrq_s32(
+        vshll_n_s16(vget_high_s16(high), 16),
+        vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(low))));
+    vst1q_f32(dst + i, vmulq_n_f32(vcvtq_f32_s32(s0), factor));
+    vst1q_f32(dst + i + 4, vmulq_n_f32(vcvtq_f32_s32(s1), factor));
+  }
+#endif
+
+  for (size_t i = simd_samples; i < num_samples; i++) {
+    const uint8_t* p = src + 3 * i;
+    int32_t sample = (p[0] << 0) | (p[1] << 8) | (((int8_t)p[2]) << 16);
+    dst[i] = sample * factor;
+  }
+}
+
+void a2dp_pcm_32_to_float(const uint8_t* src, float* dst, size_t num_samples,
+                          float gain) {
+  const float factor = gain / 2147483648.0f;
+  size_t simd_samples = 0;
+#if defined(A2DP_PCM_SSE2)
+  simd_samples = num_samples & ~(size_t)3;
+  const __m128 f = _mm_set1_ps(factor);
+  for (size_t i = 0; i < simd_samples; i += 4) {
+    __m128i v = _mm_loadu_si128((const __m128i*)(src + 4 * i));
+    _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(v), f));
+  }
+#elif defined(A2DP_PCM_NEON)
+  simd_samples = num_samples & ~(size_t)3;
+  for (size_t i = 0; i < simd_samples; i += 4) {
+    int32x4_t v = vld1q_s32((const int32_t*)(src + 4 * i));
+    vst1q_f32(dst + i, vmulq_n_f32(vcvtq_f32_s32(v), factor));
+  }
+#endif
+
+  for (size_t i = simd_samples; i < num_samples; i++) {
+    int32_t sample;
+    memcpy(&sample, src + 4 * i, sizeof(sample));
+    dst[i] = sample * factor;
+  }
+}
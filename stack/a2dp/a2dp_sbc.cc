@@ -32,6 +32,7 @@
 #include <string.h>
 
 #include <base/logging.h>
+#include "a2dp_codec_select.h"
 #include "a2dp_sbc_decoder.h"
 #include "a2dp_sbc_encoder.h"
 #include "bt_utils.h"
@@ -100,7 +101,8 @@ static const tA2DP_ENCODER_INTERFACE a2dp_encoder_interface_sbc = {
     a2dp_sbc_feeding_flush,
     a2dp_sbc_get_encoder_interval_ms,
     a2dp_sbc_send_frames,
-    nullptr  // set_transmit_queue_length
+    nullptr,  // set_transmit_queue_length
+    a2dp_sbc_set_bitrate_percent
 };
 
 static const tA2DP_DECODER_INTERFACE a2dp_decoder_interface_sbc = {
@@ -917,6 +919,53 @@ bool A2dpCodecConfigSbcSource::init() {
 
 bool A2dpCodecConfigSbcSource::useRtpHeaderMarkerBit() const { return false; }
 
+// The SBC sample rates, from the most preferred one
+static const tA2DP_CODEC_FIELD_VALUE<btav_a2dp_codec_sample_rate_t>
+    a2dp_sbc_sample_rates[] = {
+        {A2DP_SBC_IE_SAMP_FREQ_48, BTAV_A2DP_CODEC_SAMPLE_RATE_48000},
+        {A2DP_SBC_IE_SAMP_FREQ_44, BTAV_A2DP_CODEC_SAMPLE_RATE_44100},
+};
+
+// The SBC channel modes, from the most preferred one
+static const tA2DP_CODEC_FIELD_VALUE<btav_a2dp_codec_channel_mode_t>
+    a2dp_sbc_channel_modes[] = {
+        {A2DP_SBC_IE_CH_MD_JOINT, BTAV_A2DP_CODEC_CHANNEL_MODE_STEREO},
+        {A2DP_SBC_IE_CH_MD_STEREO, BTAV_A2DP_CODEC_CHANNEL_MODE_STEREO},
+        {A2DP_SBC_IE_CH_MD_DUAL, BTAV_A2DP_CODEC_CHANNEL_MODE_DUAL_CHANNEL},
+        {A2DP_SBC_IE_CH_MD_MONO, BTAV_A2DP_CODEC_CHANNEL_MODE_MONO},
+};
+
+// The SBC block lengths, sub-bands and allocation methods, from the most
+// preferred one. They have no btav_a2dp_codec_config_t value.
+static const tA2DP_CODEC_FIELD_VALUE<uint8_t> a2dp_sbc_block_lens[] = {
+    {A2DP_SBC_IE_BLOCKS_16, 0},
+    {A2DP_SBC_IE_BLOCKS_12, 0},
+    {A2DP_SBC_IE_BLOCKS_8, 0},
+    {A2DP_SBC_IE_BLOCKS_4, 0},
+};
+static const tA2DP_CODEC_FIELD_VALUE<uint8_t> a2dp_sbc_num_subbands[] = {
+    {A2DP_SBC_IE_SUBBAND_8, 0},
+    {A2DP_SBC_IE_SUBBAND_4, 0},
+};
+static const tA2DP_CODEC_FIELD_VALUE<uint8_t> a2dp_sbc_alloc_methods[] = {
+    {A2DP_SBC_IE_ALLOC_MD_L, 0},
+    {A2DP_SBC_IE_ALLOC_MD_S, 0},
+};
+
+//
+// Uses the sample rate |p_value|, if any.
+// The result is stored in |p_result| and |p_codec_config|.
+// Returns true if a selection was made, otherwise false.
+//
+static bool use_sample_rate(
+    const tA2DP_CODEC_FIELD_VALUE<btav_a2dp_codec_sample_rate_t>* p_value,
+    tA2DP_SBC_CIE* p_result, btav_a2dp_codec_config_t* p_codec_config) {
+  if (p_value == nullptr) return false;
+  p_result->samp_freq = p_value->ie_bit;
+  p_codec_config->sample_rate = p_value->btav_value;
+  return true;
+}
+
 //
 // Selects the best sample rate from |samp_freq|.
 // The result is stored in |p_result| and |p_codec_config|.
@@ -924,17 +973,9 @@ bool A2dpCodecConfigSbcSource::useRtpHeaderMarkerBit() const { return false; }
 //
 static bool select_best_sample_rate(uint8_t samp_freq, tA2DP_SBC_CIE* p_result,
                                     btav_a2dp_codec_config_t* p_codec_config) {
-  if (samp_freq & A2DP_SBC_IE_SAMP_FREQ_48) {
-    p_result->samp_freq = A2DP_SBC_IE_SAMP_FREQ_48;
-    p_codec_config->sample_rate = BTAV_A2DP_CODEC_SAMPLE_RATE_48000;
-    return true;
-  }
-  if (samp_freq & A2DP_SBC_IE_SAMP_FREQ_44) {
-    p_result->samp_freq = A2DP_SBC_IE_SAMP_FREQ_44;
-    p_codec_config->sample_rate = BTAV_A2DP_CODEC_SAMPLE_RATE_44100;
-    return true;
-  }
-  return false;
+  return use_sample_rate(
+      A2DP_SelectBestFieldValue(a2dp_sbc_sample_rates, samp_freq), p_result,
+      p_codec_config);
 }
 
 //
@@ -946,32 +987,10 @@ static bool select_best_sample_rate(uint8_t samp_freq, tA2DP_SBC_CIE* p_result,
 static bool select_audio_sample_rate(
     const btav_a2dp_codec_config_t* p_codec_audio_config, uint8_t samp_freq,
     tA2DP_SBC_CIE* p_result, btav_a2dp_codec_config_t* p_codec_config) {
-  switch (p_codec_audio_config->sample_rate) {
-    case BTAV_A2DP_CODEC_SAMPLE_RATE_44100:
-      if (samp_freq & A2DP_SBC_IE_SAMP_FREQ_44) {
-        p_result->samp_freq = A2DP_SBC_IE_SAMP_FREQ_44;
-        p_codec_config->sample_rate = BTAV_A2DP_CODEC_SAMPLE_RATE_44100;
-        return true;
-      }
-      break;
-    case BTAV_A2DP_CODEC_SAMPLE_RATE_48000:
-      if (samp_freq & A2DP_SBC_IE_SAMP_FREQ_48) {
-        p_result->samp_freq = A2DP_SBC_IE_SAMP_FREQ_48;
-        p_codec_config->sample_rate = BTAV_A2DP_CODEC_SAMPLE_RATE_48000;
-        return true;
-      }
-      break;
-    case BTAV_A2DP_CODEC_SAMPLE_RATE_88200:
-    case BTAV_A2DP_CODEC_SAMPLE_RATE_96000:
-    case BTAV_A2DP_CODEC_SAMPLE_RATE_176400:
-    case BTAV_A2DP_CODEC_SAMPLE_RATE_192000:
-    case BTAV_A2DP_CODEC_SAMPLE_RATE_16000:
-    case BTAV_A2DP_CODEC_SAMPLE_RATE_24000:
-    case BTAV_A2DP_CODEC_SAMPLE_RATE_NONE:
-      break;
-  }
-
-  return false;
+  return use_sample_rate(
+      A2DP_SelectFieldValue(a2dp_sbc_sample_rates, samp_freq,
+                            p_codec_audio_config->sample_rate),
+      p_result, p_codec_config);
 }
 
 //
@@ -1005,6 +1024,20 @@ static bool select_audio_bits_per_sample(
   return false;
 }
 
+//
+// Uses the channel mode |p_value|, if any.
+// The result is stored in |p_result| and |p_codec_config|.
+// Returns true if a selection was made, otherwise false.
+//
+static bool use_channel_mode(
+    const tA2DP_CODEC_FIELD_VALUE<btav_a2dp_codec_channel_mode_t>* p_value,
+    tA2DP_SBC_CIE* p_result, btav_a2dp_codec_config_t* p_codec_config) {
+  if (p_value == nullptr) return false;
+  p_result->ch_mode = p_value->ie_bit;
+  p_codec_config->channel_mode = p_value->btav_value;
+  return true;
+}
+
 //
 // Selects the best channel mode from |ch_mode|.
 // The result is stored in |p_result| and |p_codec_config|.
@@ -1012,27 +1045,9 @@ static bool select_audio_bits_per_sample(
 //
 static bool select_best_channel_mode(uint8_t ch_mode, tA2DP_SBC_CIE* p_result,
                                      btav_a2dp_codec_config_t* p_codec_config) {
-  if (ch_mode & A2DP_SBC_IE_CH_MD_JOINT) {
-    p_result->ch_mode = A2DP_SBC_IE_CH_MD_JOINT;
-    p_codec_config->channel_mode = BTAV_A2DP_CODEC_CHANNEL_MODE_STEREO;
-    return true;
-  }
-  if (ch_mode & A2DP_SBC_IE_CH_MD_STEREO) {
-    p_result->ch_mode = A2DP_SBC_IE_CH_MD_STEREO;
-    p_codec_config->channel_mode = BTAV_A2DP_CODEC_CHANNEL_MODE_STEREO;
-    return true;
-  }
-  if (ch_mode & A2DP_SBC_IE_CH_MD_DUAL) {
-    p_result->ch_mode = A2DP_SBC_IE_CH_MD_DUAL;
-    p_codec_config->channel_mode = BTAV_A2DP_CODEC_CHANNEL_MODE_DUAL_CHANNEL;
-    return true;
-  }
-  if (ch_mode & A2DP_SBC_IE_CH_MD_MONO) {
-    p_result->ch_mode = A2DP_SBC_IE_CH_MD_MONO;
-    p_codec_config->channel_mode = BTAV_A2DP_CODEC_CHANNEL_MODE_MONO;
-    return true;
-  }
-  return false;
+  return use_channel_mode(
+      A2DP_SelectBestFieldValue(a2dp_sbc_channel_modes, ch_mode), p_result,
+      p_codec_config);
 }
 
 //
@@ -1044,39 +1059,10 @@ static bool select_best_channel_mode(uint8_t ch_mode, tA2DP_SBC_CIE* p_result,
 static bool select_audio_channel_mode(
     const btav_a2dp_codec_config_t* p_codec_audio_config, uint8_t ch_mode,
     tA2DP_SBC_CIE* p_result, btav_a2dp_codec_config_t* p_codec_config) {
-  switch (p_codec_audio_config->channel_mode) {
-    case BTAV_A2DP_CODEC_CHANNEL_MODE_MONO:
-      if (ch_mode & A2DP_SBC_IE_CH_MD_MONO) {
-        p_result->ch_mode = A2DP_SBC_IE_CH_MD_MONO;
-        p_codec_config->channel_mode = BTAV_A2DP_CODEC_CHANNEL_MODE_MONO;
-        return true;
-      }
-      break;
-    case BTAV_A2DP_CODEC_CHANNEL_MODE_STEREO:
-      if (ch_mode & A2DP_SBC_IE_CH_MD_JOINT) {
-        p_result->ch_mode = A2DP_SBC_IE_CH_MD_JOINT;
-        p_codec_config->channel_mode = BTAV_A2DP_CODEC_CHANNEL_MODE_STEREO;
-        return true;
-      }
-      if (ch_mode & A2DP_SBC_IE_CH_MD_STEREO) {
-        p_result->ch_mode = A2DP_SBC_IE_CH_MD_STEREO;
-        p_codec_config->channel_mode = BTAV_A2DP_CODEC_CHANNEL_MODE_STEREO;
-        return true;
-      }
-      break;
-    case BTAV_A2DP_CODEC_CHANNEL_MODE_DUAL_CHANNEL:
-      if (ch_mode & A2DP_SBC_IE_CH_MD_DUAL) {
-        p_result->ch_mode = A2DP_SBC_IE_CH_MD_DUAL;
-        p_codec_config->channel_mode =
-            BTAV_A2DP_CODEC_CHANNEL_MODE_DUAL_CHANNEL;
-        return true;
-      }
-      break;
-    case BTAV_A2DP_CODEC_CHANNEL_MODE_NONE:
-      break;
-  }
-
-  return false;
+  return use_channel_mode(
+      A2DP_SelectFieldValue(a2dp_sbc_channel_modes, ch_mode,
+                            p_codec_audio_config->channel_mode),
+      p_result, p_codec_config);
 }
 
 bool A2dpCodecConfigSbcBase::setCodecConfig(const uint8_t* p_peer_codec_info,
@@ -1090,6 +1076,7 @@ bool A2dpCodecConfigSbcBase::setCodecConfig(const uint8_t* p_peer_codec_info,
   uint8_t block_len;
   uint8_t num_subbands;
   uint8_t alloc_method;
+  const tA2DP_CODEC_FIELD_VALUE<uint8_t>* p_value;
   const tA2DP_SBC_CIE* p_a2dp_sbc_caps =
       (is_source_) ? &a2dp_sbc_source_caps : &a2dp_sbc_sink_caps;
 
@@ -1140,52 +1127,25 @@ bool A2dpCodecConfigSbcBase::setCodecConfig(const uint8_t* p_peer_codec_info,
   //
   samp_freq = p_a2dp_sbc_caps->samp_freq & peer_info_cie.samp_freq;
   codec_config_.sample_rate = BTAV_A2DP_CODEC_SAMPLE_RATE_NONE;
-  switch (codec_user_config_.sample_rate) {
-    case BTAV_A2DP_CODEC_SAMPLE_RATE_44100:
-      if (samp_freq & A2DP_SBC_IE_SAMP_FREQ_44) {
-        result_config_cie.samp_freq = A2DP_SBC_IE_SAMP_FREQ_44;
-        codec_capability_.sample_rate = codec_user_config_.sample_rate;
-        codec_config_.sample_rate = codec_user_config_.sample_rate;
-      }
-      break;
-    case BTAV_A2DP_CODEC_SAMPLE_RATE_48000:
-      if (samp_freq & A2DP_SBC_IE_SAMP_FREQ_48) {
-        result_config_cie.samp_freq = A2DP_SBC_IE_SAMP_FREQ_48;
-        codec_capability_.sample_rate = codec_user_config_.sample_rate;
-        codec_config_.sample_rate = codec_user_config_.sample_rate;
-      }
-      break;
-    case BTAV_A2DP_CODEC_SAMPLE_RATE_88200:
-    case BTAV_A2DP_CODEC_SAMPLE_RATE_96000:
-    case BTAV_A2DP_CODEC_SAMPLE_RATE_176400:
-    case BTAV_A2DP_CODEC_SAMPLE_RATE_192000:
-    case BTAV_A2DP_CODEC_SAMPLE_RATE_16000:
-    case BTAV_A2DP_CODEC_SAMPLE_RATE_24000:
-    case BTAV_A2DP_CODEC_SAMPLE_RATE_NONE:
-      codec_capability_.sample_rate = BTAV_A2DP_CODEC_SAMPLE_RATE_NONE;
-      codec_config_.sample_rate = BTAV_A2DP_CODEC_SAMPLE_RATE_NONE;
-      break;
+  if (!A2DP_FieldHasBtavValue(a2dp_sbc_sample_rates,
+                              codec_user_config_.sample_rate)) {
+    codec_capability_.sample_rate = BTAV_A2DP_CODEC_SAMPLE_RATE_NONE;
+  } else if (select_audio_sample_rate(&codec_user_config_, samp_freq,
+                                      &result_config_cie, &codec_config_)) {
+    codec_capability_.sample_rate = codec_user_config_.sample_rate;
   }
 
   // Select the sample frequency if there is no user preference
   do {
     // Compute the selectable capability
-    if (samp_freq & A2DP_SBC_IE_SAMP_FREQ_44) {
-      codec_selectable_capability_.sample_rate |=
-          BTAV_A2DP_CODEC_SAMPLE_RATE_44100;
-    }
-    if (samp_freq & A2DP_SBC_IE_SAMP_FREQ_48) {
-      codec_selectable_capability_.sample_rate |=
-          BTAV_A2DP_CODEC_SAMPLE_RATE_48000;
-    }
+    codec_selectable_capability_.sample_rate |=
+        A2DP_FieldBtavValues(a2dp_sbc_sample_rates, samp_freq);
 
     if (codec_config_.sample_rate != BTAV_A2DP_CODEC_SAMPLE_RATE_NONE) break;
 
     // Compute the common capability
-    if (samp_freq & A2DP_SBC_IE_SAMP_FREQ_44)
-      codec_capability_.sample_rate |= BTAV_A2DP_CODEC_SAMPLE_RATE_44100;
-    if (samp_freq & A2DP_SBC_IE_SAMP_FREQ_48)
-      codec_capability_.sample_rate |= BTAV_A2DP_CODEC_SAMPLE_RATE_48000;
+    codec_capability_.sample_rate |=
+        A2DP_FieldBtavValues(a2dp_sbc_sample_rates, samp_freq);
 
     // No user preference - try the codec audio config
     if (select_audio_sample_rate(&codec_audio_config_, samp_freq,
@@ -1273,71 +1233,25 @@ bool A2dpCodecConfigSbcBase::setCodecConfig(const uint8_t* p_peer_codec_info,
   //
   ch_mode = p_a2dp_sbc_caps->ch_mode & peer_info_cie.ch_mode;
   codec_config_.channel_mode = BTAV_A2DP_CODEC_CHANNEL_MODE_NONE;
-  switch (codec_user_config_.channel_mode) {
-    case BTAV_A2DP_CODEC_CHANNEL_MODE_MONO:
-      if (ch_mode & A2DP_SBC_IE_CH_MD_MONO) {
-        result_config_cie.ch_mode = A2DP_SBC_IE_CH_MD_MONO;
-        codec_capability_.channel_mode = codec_user_config_.channel_mode;
-        codec_config_.channel_mode = codec_user_config_.channel_mode;
-      }
-      break;
-    case BTAV_A2DP_CODEC_CHANNEL_MODE_STEREO:
-      if (ch_mode & A2DP_SBC_IE_CH_MD_JOINT) {
-        result_config_cie.ch_mode = A2DP_SBC_IE_CH_MD_JOINT;
-        codec_capability_.channel_mode = codec_user_config_.channel_mode;
-        codec_config_.channel_mode = codec_user_config_.channel_mode;
-        break;
-      }
-      if (ch_mode & A2DP_SBC_IE_CH_MD_STEREO) {
-        result_config_cie.ch_mode = A2DP_SBC_IE_CH_MD_STEREO;
-        codec_capability_.channel_mode = codec_user_config_.channel_mode;
-        codec_config_.channel_mode = codec_user_config_.channel_mode;
-        break;
-      }
-      break;
-    case BTAV_A2DP_CODEC_CHANNEL_MODE_DUAL_CHANNEL:
-      if (ch_mode & A2DP_SBC_IE_CH_MD_DUAL) {
-        result_config_cie.ch_mode = A2DP_SBC_IE_CH_MD_DUAL;
-        codec_capability_.channel_mode = codec_user_config_.channel_mode;
-        codec_config_.channel_mode = codec_user_config_.channel_mode;
-      }
-      break;
-    case BTAV_A2DP_CODEC_CHANNEL_MODE_NONE:
-      codec_capability_.channel_mode = BTAV_A2DP_CODEC_CHANNEL_MODE_NONE;
-      codec_config_.channel_mode = BTAV_A2DP_CODEC_CHANNEL_MODE_NONE;
-      break;
+  if (!A2DP_FieldHasBtavValue(a2dp_sbc_channel_modes,
+                              codec_user_config_.channel_mode)) {
+    codec_capability_.channel_mode = BTAV_A2DP_CODEC_CHANNEL_MODE_NONE;
+  } else if (select_audio_channel_mode(&codec_user_config_, ch_mode,
+                                       &result_config_cie, &codec_config_)) {
+    codec_capability_.channel_mode = codec_user_config_.channel_mode;
   }
 
   // Select the channel mode if there is no user preference
   do {
     // Compute the selectable capability
-    if (ch_mode & A2DP_SBC_IE_CH_MD_MONO) {
-      codec_selectable_capability_.channel_mode |=
-          BTAV_A2DP_CODEC_CHANNEL_MODE_MONO;
-    }
-    if (ch_mode & A2DP_SBC_IE_CH_MD_JOINT) {
-      codec_selectable_capability_.channel_mode |=
-          BTAV_A2DP_CODEC_CHANNEL_MODE_STEREO;
-    }
-    if (ch_mode & A2DP_SBC_IE_CH_MD_STEREO) {
-      codec_selectable_capability_.channel_mode |=
-          BTAV_A2DP_CODEC_CHANNEL_MODE_STEREO;
-    }
-    if (ch_mode & A2DP_SBC_IE_CH_MD_DUAL) {
-      codec_selectable_capability_.channel_mode |=
-          BTAV_A2DP_CODEC_CHANNEL_MODE_DUAL_CHANNEL;
-    }
+    codec_selectable_capability_.channel_mode |=
+        A2DP_FieldBtavValues(a2dp_sbc_channel_modes, ch_mode);
 
     if (codec_config_.channel_mode != BTAV_A2DP_CODEC_CHANNEL_MODE_NONE) break;
 
     // Compute the common capability
-    if (ch_mode & A2DP_SBC_IE_CH_MD_MONO)
-      codec_capability_.channel_mode |= BTAV_A2DP_CODEC_CHANNEL_MODE_MONO;
-    if (ch_mode & (A2DP_SBC_IE_CH_MD_JOINT | A2DP_SBC_IE_CH_MD_STEREO)) {
-      codec_capability_.channel_mode |= BTAV_A2DP_CODEC_CHANNEL_MODE_STEREO;
-    }
-    if (ch_mode & A2DP_SBC_IE_CH_MD_DUAL)
-      codec_capability_.channel_mode |= BTAV_A2DP_CODEC_CHANNEL_MODE_DUAL_CHANNEL;
+    codec_capability_.channel_mode |=
+        A2DP_FieldBtavValues(a2dp_sbc_channel_modes, ch_mode);
 
     // No user preference - use the codec audio config
     if (select_audio_channel_mode(&codec_audio_config_, ch_mode,
@@ -1369,14 +1283,9 @@ bool A2dpCodecConfigSbcBase::setCodecConfig(const uint8_t* p_peer_codec_info,
   // Select the block length
   //
   block_len = p_a2dp_sbc_caps->block_len & peer_info_cie.block_len;
-  if (block_len & A2DP_SBC_IE_BLOCKS_16) {
-    result_config_cie.block_len = A2DP_SBC_IE_BLOCKS_16;
-  } else if (block_len & A2DP_SBC_IE_BLOCKS_12) {
-    result_config_cie.block_len = A2DP_SBC_IE_BLOCKS_12;
-  } else if (block_len & A2DP_SBC_IE_BLOCKS_8) {
-    result_config_cie.block_len = A2DP_SBC_IE_BLOCKS_8;
-  } else if (block_len & A2DP_SBC_IE_BLOCKS_4) {
-    result_config_cie.block_len = A2DP_SBC_IE_BLOCKS_4;
+  p_value = A2DP_SelectBestFieldValue(a2dp_sbc_block_lens, block_len);
+  if (p_value != nullptr) {
+    result_config_cie.block_len = p_value->ie_bit;
   } else {
     LOG_ERROR(LOG_TAG,
               "%s: cannot match block length: local caps = 0x%x "
@@ -1389,10 +1298,9 @@ bool A2dpCodecConfigSbcBase::setCodecConfig(const uint8_t* p_peer_codec_info,
   // Select the number of sub-bands
   //
   num_subbands = p_a2dp_sbc_caps->num_subbands & peer_info_cie.num_subbands;
-  if (num_subbands & A2DP_SBC_IE_SUBBAND_8) {
-    result_config_cie.num_subbands = A2DP_SBC_IE_SUBBAND_8;
-  } else if (num_subbands & A2DP_SBC_IE_SUBBAND_4) {
-    result_config_cie.num_subbands = A2DP_SBC_IE_SUBBAND_4;
+  p_value = A2DP_SelectBestFieldValue(a2dp_sbc_num_subbands, num_subbands);
+  if (p_value != nullptr) {
+    result_config_cie.num_subbands = p_value->ie_bit;
   } else {
     LOG_ERROR(LOG_TAG,
               "%s: cannot match number of sub-bands: local caps = 0x%x "
@@ -1406,10 +1314,9 @@ bool A2dpCodecConfigSbcBase::setCodecConfig(const uint8_t* p_peer_codec_info,
   // Select the allocation method
   //
   alloc_method = p_a2dp_sbc_caps->alloc_method & peer_info_cie.alloc_method;
-  if (alloc_method & A2DP_SBC_IE_ALLOC_MD_L) {
-    result_config_cie.alloc_method = A2DP_SBC_IE_ALLOC_MD_L;
-  } else if (alloc_method & A2DP_SBC_IE_ALLOC_MD_S) {
-    result_config_cie.alloc_method = A2DP_SBC_IE_ALLOC_MD_S;
+  p_value = A2DP_SelectBestFieldValue(a2dp_sbc_alloc_methods, alloc_method);
+  if (p_value != nullptr) {
+    result_config_cie.alloc_method = p_value->ie_bit;
   } else {
     LOG_ERROR(LOG_TAG,
               "%s: cannot match allocation method: local caps = 0x%x "
@@ -1511,14 +1418,8 @@ bool A2dpCodecConfigSbcBase::setPeerCodecCapabilities(
 
   // Compute the selectable capability - sample rate
   samp_freq = p_a2dp_sbc_caps->samp_freq & peer_info_cie.samp_freq;
-  if (samp_freq & A2DP_SBC_IE_SAMP_FREQ_44) {
-    codec_selectable_capability_.sample_rate |=
-        BTAV_A2DP_CODEC_SAMPLE_RATE_44100;
-  }
-  if (samp_freq & A2DP_SBC_IE_SAMP_FREQ_48) {
-    codec_selectable_capability_.sample_rate |=
-        BTAV_A2DP_CODEC_SAMPLE_RATE_48000;
-  }
+  codec_selectable_capability_.sample_rate |=
+      A2DP_FieldBtavValues(a2dp_sbc_sample_rates, samp_freq);
 
   // Compute the selectable capability - bits per sample
   codec_selectable_capability_.bits_per_sample =
@@ -1526,22 +1427,8 @@ bool A2dpCodecConfigSbcBase::setPeerCodecCapabilities(
 
   // Compute the selectable capability - channel mode
   ch_mode = p_a2dp_sbc_caps->ch_mode & peer_info_cie.ch_mode;
-  if (ch_mode & A2DP_SBC_IE_CH_MD_MONO) {
-    codec_selectable_capability_.channel_mode |=
-        BTAV_A2DP_CODEC_CHANNEL_MODE_MONO;
-  }
-  if (ch_mode & A2DP_SBC_IE_CH_MD_JOINT) {
-    codec_selectable_capability_.channel_mode |=
-        BTAV_A2DP_CODEC_CHANNEL_MODE_STEREO;
-  }
-  if (ch_mode & A2DP_SBC_IE_CH_MD_STEREO) {
-    codec_selectable_capability_.channel_mode |=
-        BTAV_A2DP_CODEC_CHANNEL_MODE_STEREO;
-  }
-  if (ch_mode & A2DP_SBC_IE_CH_MD_DUAL) {
-    codec_selectable_capability_.channel_mode |=
-        BTAV_A2DP_CODEC_CHANNEL_MODE_DUAL_CHANNEL;
-  }
+  codec_selectable_capability_.channel_mode |=
+      A2DP_FieldBtavValues(a2dp_sbc_channel_modes, ch_mode);
 
   status = A2DP_BuildInfoSbc(AVDT_MEDIA_TYPE_AUDIO, &peer_info_cie,
                              ota_codec_peer_capability_);
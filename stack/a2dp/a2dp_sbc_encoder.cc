@@ -26,6 +26,7 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "a2dp_pcm_convert.h"
 #include "a2dp_sbc.h"
 #include "a2dp_sbc_up_sample.h"
 #include "bt_common.h"
@@ -124,6 +125,10 @@ typedef struct {
   bool peer_supports_3mbps; /* True if the peer device supports 3Mbps EDR */
   uint16_t peer_mtu;        /* MTU of the A2DP peer */
   uint32_t timestamp;       /* Timestamp for the A2DP frames */
+  uint16_t sampling_freq;   /* In Hz */
+  int min_bitpool;          /* Bitpool range of the codec config */
+  int max_bitpool;
+  uint8_t bitrate_percent;  /* Share of the source rate to encode at */
   SBC_ENC_PARAMS sbc_encoder_params;
   tA2DP_FEEDING_PARAMS feeding_params;
   tA2DP_SBC_FEEDING_STATE feeding_state;
@@ -144,6 +149,7 @@ static void a2dp_sbc_encode_frames(uint8_t nb_frame);
 static void a2dp_sbc_get_num_frame_iteration(uint8_t* num_of_iterations,
                                              uint8_t* num_of_frames,
                                              uint64_t timestamp_us);
+static void a2dp_sbc_encoder_apply_bitrate(void);
 static uint8_t calculate_max_frames_per_packet(void);
 static uint16_t a2dp_sbc_source_rate();
 static uint32_t a2dp_sbc_frame_length(void);
@@ -172,6 +178,7 @@ void a2dp_sbc_encoder_init(const tA2DP_ENCODER_INIT_PEER_PARAMS* p_peer_params,
   a2dp_sbc_encoder_cb.peer_supports_3mbps = p_peer_params->peer_supports_3mbps;
   a2dp_sbc_encoder_cb.peer_mtu = p_peer_params->peer_mtu;
   a2dp_sbc_encoder_cb.timestamp = 0;
+  a2dp_sbc_encoder_cb.bitrate_percent = 100;
 
   // NOTE: Ignore the restart_input / restart_output flags - this initization
   // happens when the connection is (re)started.
@@ -214,10 +221,6 @@ static void a2dp_sbc_encoder_update(uint16_t peer_mtu,
   SBC_ENC_PARAMS* p_encoder_params = &a2dp_sbc_encoder_cb.sbc_encoder_params;
   uint8_t codec_info[AVDT_CODEC_SIZE];
   uint16_t s16SamplingFreq;
-  int16_t s16BitPool = 0;
-  int16_t s16BitRate;
-  int16_t s16FrameLen;
-  uint8_t protect = 0;
   int min_bitpool;
   int max_bitpool;
 
@@ -291,12 +294,32 @@ static void a2dp_sbc_encoder_update(uint16_t peer_mtu,
   else
     s16SamplingFreq = 48000;
 
+  a2dp_sbc_encoder_cb.sampling_freq = s16SamplingFreq;
+  a2dp_sbc_encoder_cb.min_bitpool = min_bitpool;
+  a2dp_sbc_encoder_cb.max_bitpool = max_bitpool;
+  a2dp_sbc_encoder_apply_bitrate();
+}
+
+// Picks the bitpool for the target bit rate: the source rate, scaled by
+// |bitrate_percent|, within the bitpool range of the codec config. Then
+// resets the encoder for it.
+static void a2dp_sbc_encoder_apply_bitrate(void) {
+  SBC_ENC_PARAMS* p_encoder_params = &a2dp_sbc_encoder_cb.sbc_encoder_params;
+  uint16_t s16SamplingFreq = a2dp_sbc_encoder_cb.sampling_freq;
+  int16_t s16BitPool = 0;
+  int16_t s16BitRate;
+  int16_t s16FrameLen;
+  uint8_t protect = 0;
+  int min_bitpool = a2dp_sbc_encoder_cb.min_bitpool;
+  int max_bitpool = a2dp_sbc_encoder_cb.max_bitpool;
+
   // Set the initial target bit rate
-  p_encoder_params->u16BitRate = a2dp_sbc_source_rate();
+  p_encoder_params->u16BitRate =
+      a2dp_sbc_source_rate() * a2dp_sbc_encoder_cb.bitrate_percent / 100;
 
   LOG_DEBUG(LOG_TAG, "%s: MTU=%d, peer_mtu=%d min_bitpool=%d max_bitpool=%d",
-            __func__, a2dp_sbc_encoder_cb.TxAaMtuSize, peer_mtu, min_bitpool,
-            max_bitpool);
+            __func__, a2dp_sbc_encoder_cb.TxAaMtuSize,
+            a2dp_sbc_encoder_cb.peer_mtu, min_bitpool, max_bitpool);
   LOG_DEBUG(LOG_TAG,
             "%s: ChannelMode=%d, NumOfSubBands=%d, NumOfBlocks=%d, "
             "AllocationMethod=%d, BitRate=%d, SamplingFreq=%d BitPool=%d",
@@ -421,6 +444,19 @@ void a2dp_sbc_feeding_flush(void) {
   a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue = 0;
 }
 
+void a2dp_sbc_set_bitrate_percent(uint8_t bitrate_percent) {
+  if (bitrate_percent == 0 || bitrate_percent > 100) return;
+  if (bitrate_percent == a2dp_sbc_encoder_cb.bitrate_percent) return;
+  // Not configured yet
+  if (a2dp_sbc_encoder_cb.sampling_freq == 0) return;
+
+  a2dp_sbc_encoder_cb.bitrate_percent = bitrate_percent;
+  a2dp_sbc_encoder_apply_bitrate();
+  LOG_INFO(LOG_TAG, "%s: %u%% of the bit rate: %d kbps, bitpool %d", __func__,
+           bitrate_percent, a2dp_sbc_encoder_cb.sbc_encoder_params.u16BitRate,
+           a2dp_sbc_encoder_cb.sbc_encoder_params.s16BitPool);
+}
+
 uint64_t a2dp_sbc_get_encoder_interval_ms(void) {
   return A2DP_SBC_ENCODER_INTERVAL_MS;
 }
@@ -655,6 +691,7 @@ static bool a2dp_sbc_read_feeding(uint32_t* bytes_read) {
   int32_t fract_max;
   int32_t fract_threshold;
   uint32_t nb_byte_read;
+  uint32_t ratio;
 
   /* Get the SBC sampling rate */
   switch (p_encoder_params->s16SamplingFreq) {
@@ -738,37 +775,85 @@ static bool a2dp_sbc_read_feeding(uint32_t* bytes_read) {
   read_size *= (a2dp_sbc_encoder_cb.feeding_params.bits_per_sample / 8);
   a2dp_sbc_encoder_cb.stats.media_read_total_expected_read_bytes += read_size;
 
-  /* Read Data from UIPC channel */
-  nb_byte_read =
-      a2dp_sbc_encoder_cb.read_callback((uint8_t*)read_buffer, read_size);
-  a2dp_sbc_encoder_cb.stats.media_read_total_actual_read_bytes += nb_byte_read;
+  /*
+   * When the SBC sampling rate is a multiple of the feeding one, the PCM is
+   * read straight into the up-sampled buffer and converted there. This gives
+   * the same PCM as the up-sampling engine, which repeats each source frame
+   * as many times.
+   */
+  ratio = 0;
+  if ((a2dp_sbc_encoder_cb.feeding_params.sample_rate != 0) &&
+      (sbc_sampling % a2dp_sbc_encoder_cb.feeding_params.sample_rate == 0) &&
+      (a2dp_sbc_encoder_cb.feeding_params.channel_count <= 2) &&
+      (a2dp_sbc_encoder_cb.feeding_params.bits_per_sample == 8 ||
+       a2dp_sbc_encoder_cb.feeding_params.bits_per_sample == 16)) {
+    ratio = sbc_sampling / a2dp_sbc_encoder_cb.feeding_params.sample_rate;
+  }
+  /* The output PCM is stereo, 16 bit per sample */
+  dst_size_used = src_samples * ratio * SBC_MAX_NUM_OF_CHANNELS * 2;
+  if (ratio != 0 &&
+      dst_size_used <= sizeof(up_sampled_buffer) -
+                           a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue) {
+    uint8_t* p_pcm = (uint8_t*)up_sampled_buffer +
+                     a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue;
+
+    /* Read Data from UIPC channel */
+    nb_byte_read = a2dp_sbc_encoder_cb.read_callback(p_pcm, read_size);
+    a2dp_sbc_encoder_cb.stats.media_read_total_actual_read_bytes +=
+        nb_byte_read;
+
+    if (nb_byte_read < read_size) {
+      if (nb_byte_read == 0) return false;
 
-  if (nb_byte_read < read_size) {
-    if (nb_byte_read == 0) return false;
+      /* Fill the unfilled part of the read buffer with silence (0) */
+      memset(p_pcm + nb_byte_read, 0, read_size - nb_byte_read);
+    }
+    a2dp_sbc_encoder_cb.stats.media_read_total_actual_reads_count++;
 
-    /* Fill the unfilled part of the read buffer with silence (0) */
-    memset(((uint8_t*)read_buffer) + nb_byte_read, 0, read_size - nb_byte_read);
-    nb_byte_read = read_size;
-  }
-  a2dp_sbc_encoder_cb.stats.media_read_total_actual_reads_count++;
+    if (a2dp_sbc_encoder_cb.feeding_params.bits_per_sample == 8) {
+      a2dp_pcm_8_to_16(
+          p_pcm,
+          src_samples * a2dp_sbc_encoder_cb.feeding_params.channel_count);
+    }
+    if (a2dp_sbc_encoder_cb.feeding_params.channel_count == 1) {
+      a2dp_pcm_mono_to_stereo_16((int16_t*)p_pcm, src_samples);
+    }
+    a2dp_pcm_upsample_stereo_16((int16_t*)p_pcm, src_samples, ratio);
+  } else {
+    /* Read Data from UIPC channel */
+    nb_byte_read =
+        a2dp_sbc_encoder_cb.read_callback((uint8_t*)read_buffer, read_size);
+    a2dp_sbc_encoder_cb.stats.media_read_total_actual_read_bytes +=
+        nb_byte_read;
 
-  /* Initialize PCM up-sampling engine */
-  a2dp_sbc_init_up_sample(a2dp_sbc_encoder_cb.feeding_params.sample_rate,
-                          sbc_sampling,
-                          a2dp_sbc_encoder_cb.feeding_params.bits_per_sample,
-                          a2dp_sbc_encoder_cb.feeding_params.channel_count);
+    if (nb_byte_read < read_size) {
+      if (nb_byte_read == 0) return false;
 
-  /*
-   * Re-sample the read buffer.
-   * The output PCM buffer will be stereo, 16 bit per sample.
-   */
-  dst_size_used = a2dp_sbc_up_sample(
-      (uint8_t*)read_buffer,
-      (uint8_t*)up_sampled_buffer +
-          a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue,
-      nb_byte_read, sizeof(up_sampled_buffer) -
-                        a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue,
-      &src_size_used);
+      /* Fill the unfilled part of the read buffer with silence (0) */
+      memset(((uint8_t*)read_buffer) + nb_byte_read, 0,
+             read_size - nb_byte_read);
+      nb_byte_read = read_size;
+    }
+    a2dp_sbc_encoder_cb.stats.media_read_total_actual_reads_count++;
+
+    /* Initialize PCM up-sampling engine */
+    a2dp_sbc_init_up_sample(a2dp_sbc_encoder_cb.feeding_params.sample_rate,
+                            sbc_sampling,
+                            a2dp_sbc_encoder_cb.feeding_params.bits_per_sample,
+                            a2dp_sbc_encoder_cb.feeding_params.channel_count);
+
+    /*
+     * Re-sample the read buffer.
+     * The output PCM buffer will be stereo, 16 bit per sample.
+     */
+    dst_size_used = a2dp_sbc_up_sample(
+        (uint8_t*)read_buffer,
+        (uint8_t*)up_sampled_buffer +
+            a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue,
+        nb_byte_read, sizeof(up_sampled_buffer) -
+                          a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue,
+        &src_size_used);
+  }
 
   /* update the residue */
   a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue += dst_size_used;
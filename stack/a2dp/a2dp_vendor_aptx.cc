@@ -77,7 +77,8 @@ static const tA2DP_ENCODER_INTERFACE a2dp_encoder_interface_aptx = {
     a2dp_vendor_aptx_feeding_flush,
     a2dp_vendor_aptx_get_encoder_interval_ms,
     a2dp_vendor_aptx_send_frames,
-    nullptr  // set_transmit_queue_length
+    nullptr,  // set_transmit_queue_length
+    nullptr  // set_bitrate_percent
 };
 
 UNUSED_ATTR static tA2DP_STATUS A2DP_CodecInfoMatchesCapabilityAptx(
@@ -23,6 +23,7 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "a2dp_pcm_convert.h"
 #include "a2dp_vendor.h"
 #include "a2dp_vendor_aptx_hd.h"
 #include "bt_common.h"
@@ -110,7 +111,8 @@ static void aptx_hd_init_framing_params(
 static void aptx_hd_update_framing_params(
     tAPTX_HD_FRAMING_PARAMS* framing_params);
 static size_t aptx_hd_encode_24bit(tAPTX_HD_FRAMING_PARAMS* framing_params,
-                                   size_t* data_out_index, uint32_t* data32_in,
+                                   size_t* data_out_index,
+                                   const uint32_t* data32_in,
                                    uint8_t* data_out);
 
 bool A2DP_VendorLoadEncoderAptxHd(void) {
@@ -377,8 +379,9 @@ void a2dp_vendor_aptx_hd_send_frames(uint64_t timestamp_us) {
   //
   // Read the PCM data and encode it
   //
-  uint32_t
-      read_buffer32[A2DP_APTX_HD_MAX_PCM_BYTES_PER_READ / sizeof(uint32_t)];
+  // Room for the read AUDIO_FORMAT_PCM_24_BIT_PACKED data once expanded to
+  // AUDIO_FORMAT_PCM_8_24_BIT, 4 bytes for each 3 read.
+  uint32_t read_buffer32[A2DP_APTX_HD_MAX_PCM_BYTES_PER_READ / 3];
   uint32_t expected_read_bytes =
       framing_params->pcm_reads * framing_params->pcm_bytes_per_read;
   size_t encoded_ptr_index = 0;
@@ -406,9 +409,12 @@ void a2dp_vendor_aptx_hd_send_frames(uint64_t timestamp_us) {
   }
   a2dp_aptx_hd_encoder_cb.stats.media_read_total_actual_reads_count++;
 
+  a2dp_pcm_24_to_32((uint8_t*)read_buffer32, bytes_read / 3);
+
+  // Each read of pcm_bytes_per_read packed bytes is now pcm_bytes_per_read / 3
+  // samples.
   for (uint32_t reads = 0, offset = 0; reads < framing_params->pcm_reads;
-       reads++, offset +=
-                framing_params->pcm_bytes_per_read / sizeof(uint32_t)) {
+       reads++, offset += framing_params->pcm_bytes_per_read / 3) {
     pcm_bytes_encoded +=
         aptx_hd_encode_24bit(framing_params, &encoded_ptr_index,
                              read_buffer32 + offset, encoded_ptr);
@@ -439,10 +445,11 @@ void a2dp_vendor_aptx_hd_send_frames(uint64_t timestamp_us) {
 }
 
 static size_t aptx_hd_encode_24bit(tAPTX_HD_FRAMING_PARAMS* framing_params,
-                                   size_t* data_out_index, uint32_t* data32_in,
+                                   size_t* data_out_index,
+                                   const uint32_t* data32_in,
                                    uint8_t* data_out) {
   size_t pcm_bytes_encoded = 0;
-  const uint8_t* p = (const uint8_t*)(data32_in);
+  const uint32_t* p = data32_in;
 
   for (size_t aptx_hd_samples = 0;
        aptx_hd_samples < framing_params->pcm_bytes_per_read / 24;
@@ -451,13 +458,10 @@ static size_t aptx_hd_encode_24bit(tAPTX_HD_FRAMING_PARAMS* framing_params,
     uint32_t pcmR[4];
     uint32_t encoded_sample[2];
 
-    // Expand from AUDIO_FORMAT_PCM_24_BIT_PACKED data (3 bytes per sample)
-    // into AUDIO_FORMAT_PCM_8_24_BIT (4 bytes per sample).
+    // The samples were expanded to AUDIO_FORMAT_PCM_8_24_BIT on reading
     for (size_t i = 0; i < 4; i++) {
-      pcmL[i] = ((p[0] << 0) | (p[1] << 8) | (((int8_t)p[2]) << 16));
-      p += 3;
-      pcmR[i] = ((p[0] << 0) | (p[1] << 8) | (((int8_t)p[2]) << 16));
-      p += 3;
+      pcmL[i] = *p++;
+      pcmR[i] = *p++;
     }
 
     aptx_hd_encoder_encode_stereo_func(
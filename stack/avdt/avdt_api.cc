@@ -1313,6 +1313,8 @@ void stack_debug_avdtp_api_dump(int fd) {
       dprintf(fd, "      Current event: %d\n", scb.curr_evt);
       dprintf(fd, "      Congested: %s\n", scb.cong ? "true" : "false");
       dprintf(fd, "      Close response code: %d\n", scb.close_code);
+      dprintf(fd, "      Media packets: %u copied for headroom: %u\n",
+              scb.media_pkt_count, scb.media_pkt_copies);
     }
   }
 }
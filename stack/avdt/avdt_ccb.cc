@@ -476,8 +476,8 @@ AvdtpCcb* avdt_ccb_alloc_by_channel_index(const RawAddress& bd_addr,
 void AvdtpCcb::Allocate(const RawAddress& peer_address) {
   ResetCcb();
   peer_addr = peer_address;
-  cmd_q = fixed_queue_new(SIZE_MAX);
-  rsp_q = fixed_queue_new(SIZE_MAX);
+  cmd_q = list_new(NULL);
+  rsp_q = list_new(NULL);
   idle_ccb_timer = alarm_new("avdtp_ccb.idle_ccb_timer");
   ret_ccb_timer = alarm_new("avdtp_ccb.ret_ccb_timer");
   rsp_ccb_timer = alarm_new("avdtp_ccb.rsp_ccb_timer");
@@ -60,8 +60,7 @@ static void avdt_ccb_clear_ccb(AvdtpCcb* p_ccb) {
   osi_free_and_reset((void**)&p_ccb->p_rx_msg);
 
   /* clear out response queue */
-  while ((p_buf = (BT_HDR*)fixed_queue_try_dequeue(p_ccb->rsp_q)) != NULL)
-    osi_free(p_buf);
+  while ((p_buf = avdt_msg_dequeue(p_ccb->rsp_q)) != NULL) osi_free(p_buf);
 }
 
 /*******************************************************************************
@@ -655,7 +654,7 @@ void avdt_ccb_clear_cmds(AvdtpCcb* p_ccb, UNUSED_ATTR tAVDT_CCB_EVT* p_data) {
     avdt_ccb_cmd_fail(p_ccb, &avdt_ccb_evt);
 
     /* set up next message */
-    p_ccb->p_curr_cmd = (BT_HDR*)fixed_queue_try_dequeue(p_ccb->cmd_q);
+    p_ccb->p_curr_cmd = avdt_msg_dequeue(p_ccb->cmd_q);
 
   } while (p_ccb->p_curr_cmd != NULL);
 
@@ -805,7 +804,7 @@ void avdt_ccb_snd_cmd(AvdtpCcb* p_ccb, UNUSED_ATTR tAVDT_CCB_EVT* p_data) {
   */
   if ((!p_ccb->cong) && (p_ccb->p_curr_msg == NULL) &&
       (p_ccb->p_curr_cmd == NULL)) {
-    p_msg = (BT_HDR*)fixed_queue_try_dequeue(p_ccb->cmd_q);
+    p_msg = avdt_msg_dequeue(p_ccb->cmd_q);
     if (p_msg != NULL) {
       /* make a copy of buffer in p_curr_cmd */
       p_ccb->p_curr_cmd = (BT_HDR*)osi_malloc(AVDT_CMD_BUF_SIZE);
@@ -836,8 +835,8 @@ void avdt_ccb_snd_msg(AvdtpCcb* p_ccb, UNUSED_ATTR tAVDT_CCB_EVT* p_data) {
       avdt_msg_send(p_ccb, NULL);
     }
     /* do we have responses to send?  send them */
-    else if (!fixed_queue_is_empty(p_ccb->rsp_q)) {
-      while ((p_msg = (BT_HDR*)fixed_queue_try_dequeue(p_ccb->rsp_q)) != NULL) {
+    else {
+      while ((p_msg = avdt_msg_dequeue(p_ccb->rsp_q)) != NULL) {
         if (avdt_msg_send(p_ccb, p_msg)) {
           /* break out if congested */
           break;
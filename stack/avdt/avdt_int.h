@@ -31,7 +31,7 @@
 #include "btm_api.h"
 #include "l2c_api.h"
 #include "osi/include/alarm.h"
-#include "osi/include/fixed_queue.h"
+#include "osi/include/list.h"
 
 #ifndef AVDT_DEBUG
 #define AVDT_DEBUG FALSE
@@ -430,6 +430,8 @@ class AvdtpScb {
         curr_evt(0),
         cong(false),
         close_code(0),
+        media_pkt_count(0),
+        media_pkt_copies(0),
         scb_handle_(0) {}
 
   /**
@@ -479,6 +481,8 @@ class AvdtpScb {
     curr_evt = 0;
     cong = false;
     close_code = 0;
+    media_pkt_count = 0;
+    media_pkt_copies = 0;
     scb_handle_ = scb_handle;
   }
 
@@ -503,6 +507,8 @@ class AvdtpScb {
   uint8_t curr_evt;    // current event; set only by the state machine
   bool cong;           // True if the media transport channel is congested
   uint8_t close_code;  // Error code received in close response
+  uint32_t media_pkt_count;   // Media packets written by the application
+  uint32_t media_pkt_copies;  // Media packets copied for lack of headroom
 
  private:
   uint8_t scb_handle_;  // Unique handle for this AvdtpScb entry
@@ -575,10 +581,10 @@ class AvdtpCcb {
     alarm_free(rsp_ccb_timer);
     rsp_ccb_timer = nullptr;
 
-    fixed_queue_free(cmd_q, nullptr);
+    list_free(cmd_q);
     cmd_q = nullptr;
 
-    fixed_queue_free(rsp_q, nullptr);
+    list_free(rsp_q);
     rsp_q = nullptr;
 
     proc_cback = nullptr;
@@ -613,8 +619,8 @@ class AvdtpCcb {
   alarm_t* idle_ccb_timer;  // Idle CCB timer entry
   alarm_t* ret_ccb_timer;   // Ret CCB timer entry
   alarm_t* rsp_ccb_timer;   // Rsp CCB timer entry
-  fixed_queue_t* cmd_q;     // Queue for outgoing command messages
-  fixed_queue_t* rsp_q;     // Queue for outgoing response and reject messages
+  list_t* cmd_q;            // Queue for outgoing command messages
+  list_t* rsp_q;            // Queue for outgoing response and reject messages
   tAVDT_CTRL_CBACK* proc_cback;    // Procedure callback function
   tAVDT_CTRL_CBACK* p_conn_cback;  // Connection/disconnection callback function
   void* p_proc_data;               // Pointer to data storage for procedure
@@ -947,6 +953,7 @@ extern void avdt_msg_send_rej(AvdtpCcb* p_ccb, uint8_t sig_id,
 extern void avdt_msg_send_grej(AvdtpCcb* p_ccb, uint8_t sig_id,
                                tAVDT_MSG* p_params);
 extern void avdt_msg_ind(AvdtpCcb* p_ccb, BT_HDR* p_buf);
+extern BT_HDR* avdt_msg_dequeue(list_t* p_queue);
 
 /* adaption layer function declarations */
 extern void avdt_ad_init(void);
@@ -266,26 +266,29 @@ const uint8_t avdt_msg_rej_2_evt[] = {
  * Function         avdt_msg_bld_cfg
  *
  * Description      This function builds the configuration parameters contained
- *                  in a command or response message.
+ *                  in a command or response message.  Only the protocol
+ *                  service categories in psc_mask are built, so callers can
+ *                  filter them without copying the configuration.
  *
  *
  * Returns          void.
  *
  ******************************************************************************/
-static void avdt_msg_bld_cfg(uint8_t** p, AvdtpSepConfig* p_cfg) {
+static void avdt_msg_bld_cfg(uint8_t** p, const AvdtpSepConfig* p_cfg,
+                             uint16_t psc_mask) {
   uint8_t len;
 
   /* for now, just build media transport, codec, and content protection, and
    * multiplexing */
 
   /* media transport */
-  if (p_cfg->psc_mask & AVDT_PSC_TRANS) {
+  if (psc_mask & AVDT_PSC_TRANS) {
     *(*p)++ = AVDT_CAT_TRANS;
     *(*p)++ = 0; /* length */
   }
 
   /* reporting transport */
-  if (p_cfg->psc_mask & AVDT_PSC_REPORT) {
+  if (psc_mask & AVDT_PSC_REPORT) {
     *(*p)++ = AVDT_CAT_REPORT;
     *(*p)++ = 0; /* length */
   }
@@ -311,7 +314,7 @@ static void avdt_msg_bld_cfg(uint8_t** p, AvdtpSepConfig* p_cfg) {
   }
 
   /* delay report */
-  if (p_cfg->psc_mask & AVDT_PSC_DELAY_RPT) {
+  if (psc_mask & AVDT_PSC_DELAY_RPT) {
     *(*p)++ = AVDT_CAT_DELAY_RPT;
     *(*p)++ = 0; /* length */
   }
@@ -361,7 +364,8 @@ static void avdt_msg_bld_single(uint8_t** p, tAVDT_MSG* p_msg) {
 static void avdt_msg_bld_setconfig_cmd(uint8_t** p, tAVDT_MSG* p_msg) {
   AVDT_MSG_BLD_SEID(*p, p_msg->config_cmd.hdr.seid);
   AVDT_MSG_BLD_SEID(*p, p_msg->config_cmd.int_seid);
-  avdt_msg_bld_cfg(p, p_msg->config_cmd.p_cfg);
+  avdt_msg_bld_cfg(p, p_msg->config_cmd.p_cfg,
+                   p_msg->config_cmd.p_cfg->psc_mask);
 }
 
 /*******************************************************************************
@@ -380,7 +384,8 @@ static void avdt_msg_bld_reconfig_cmd(uint8_t** p, tAVDT_MSG* p_msg) {
 
   /* force psc mask zero to build only codec and security */
   p_msg->reconfig_cmd.p_cfg->psc_mask = 0;
-  avdt_msg_bld_cfg(p, p_msg->reconfig_cmd.p_cfg);
+  avdt_msg_bld_cfg(p, p_msg->reconfig_cmd.p_cfg,
+                   p_msg->reconfig_cmd.p_cfg->psc_mask);
 }
 
 /*******************************************************************************
@@ -468,12 +473,9 @@ static void avdt_msg_bld_discover_rsp(uint8_t** p, tAVDT_MSG* p_msg) {
  *
  ******************************************************************************/
 static void avdt_msg_bld_svccap(uint8_t** p, tAVDT_MSG* p_msg) {
-  AvdtpSepConfig cfg = *p_msg->svccap.p_cfg;
-
   // Include only the Basic Capability
-  cfg.psc_mask &= AVDT_LEG_PSC;
-
-  avdt_msg_bld_cfg(p, &cfg);
+  avdt_msg_bld_cfg(p, p_msg->svccap.p_cfg,
+                   p_msg->svccap.p_cfg->psc_mask & AVDT_LEG_PSC);
 }
 
 /*******************************************************************************
@@ -488,7 +490,7 @@ static void avdt_msg_bld_svccap(uint8_t** p, tAVDT_MSG* p_msg) {
  *
  ******************************************************************************/
 static void avdt_msg_bld_all_svccap(uint8_t** p, tAVDT_MSG* p_msg) {
-  avdt_msg_bld_cfg(p, p_msg->svccap.p_cfg);
+  avdt_msg_bld_cfg(p, p_msg->svccap.p_cfg, p_msg->svccap.p_cfg->psc_mask);
 }
 
 /*******************************************************************************
@@ -1318,6 +1320,27 @@ BT_HDR* avdt_msg_asmbl(AvdtpCcb* p_ccb, BT_HDR* p_buf) {
   return p_ret;
 }
 
+/*******************************************************************************
+ *
+ * Function         avdt_msg_dequeue
+ *
+ * Description      This function removes the first message from a command or
+ *                  response queue of a CCB.  The queues are only used from
+ *                  the stack thread, so they are plain lists and do not pay
+ *                  for the locking of a fixed queue on every message.
+ *
+ *
+ * Returns          The message, or NULL if the queue is empty.
+ *
+ ******************************************************************************/
+BT_HDR* avdt_msg_dequeue(list_t* p_queue) {
+  if (p_queue == NULL || list_is_empty(p_queue)) return NULL;
+
+  BT_HDR* p_buf = (BT_HDR*)list_front(p_queue);
+  list_remove(p_queue, p_buf);
+  return p_buf;
+}
+
 /*******************************************************************************
  *
  * Function         avdt_msg_send_cmd
@@ -1371,7 +1394,7 @@ void avdt_msg_send_cmd(AvdtpCcb* p_ccb, void* p_scb, uint8_t sig_id,
   p_ccb->label = (p_ccb->label + 1) % 16;
 
   /* queue message and trigger ccb to send it */
-  fixed_queue_enqueue(p_ccb->cmd_q, p_buf);
+  list_append(p_ccb->cmd_q, p_buf);
   avdt_ccb_event(p_ccb, AVDT_CCB_SENDMSG_EVT, NULL);
 }
 
@@ -1411,7 +1434,7 @@ void avdt_msg_send_rsp(AvdtpCcb* p_ccb, uint8_t sig_id, tAVDT_MSG* p_params) {
                      p_params->hdr.label);
 
   /* queue message and trigger ccb to send it */
-  fixed_queue_enqueue(p_ccb->rsp_q, p_buf);
+  list_append(p_ccb->rsp_q, p_buf);
   avdt_ccb_event(p_ccb, AVDT_CCB_SENDMSG_EVT, NULL);
 }
 
@@ -1462,7 +1485,7 @@ void avdt_msg_send_rej(AvdtpCcb* p_ccb, uint8_t sig_id, tAVDT_MSG* p_params) {
                      p_params->hdr.label);
 
   /* queue message and trigger ccb to send it */
-  fixed_queue_enqueue(p_ccb->rsp_q, p_buf);
+  list_append(p_ccb->rsp_q, p_buf);
   avdt_ccb_event(p_ccb, AVDT_CCB_SENDMSG_EVT, NULL);
 }
 
@@ -1500,7 +1523,7 @@ void avdt_msg_send_grej(AvdtpCcb* p_ccb, uint8_t sig_id, tAVDT_MSG* p_params) {
   AVDT_TRACE_DEBUG(__func__);
 
   /* queue message and trigger ccb to send it */
-  fixed_queue_enqueue(p_ccb->rsp_q, p_buf);
+  list_append(p_ccb->rsp_q, p_buf);
   avdt_ccb_event(p_ccb, AVDT_CCB_SENDMSG_EVT, NULL);
 }
 
@@ -975,6 +975,30 @@ void avdt_scb_hdl_write_req(AvdtpScb* p_scb, tAVDT_SCB_EVT* p_data) {
         A2DP_UsesRtpHeader(is_content_protection, p_scb->curr_cfg.codec_info);
   }
 
+  /* The headers are prepended in place, copy the packet if it doesn't have
+   * enough room for them */
+  p_scb->media_pkt_count++;
+  uint16_t min_offset = add_rtp_header
+                            ? AVDT_MEDIA_OFFSET
+                            : AVDT_MEDIA_OFFSET - AVDT_MEDIA_HDR_SIZE;
+  if (p_data->apiwrite.p_buf->offset < min_offset) {
+    BT_HDR* p_buf = p_data->apiwrite.p_buf;
+    BT_HDR* p_copy =
+        (BT_HDR*)osi_malloc(sizeof(BT_HDR) + AVDT_MEDIA_OFFSET + p_buf->len);
+    p_copy->event = p_buf->event;
+    p_copy->len = p_buf->len;
+    p_copy->offset = AVDT_MEDIA_OFFSET;
+    p_copy->layer_specific = p_buf->layer_specific;
+    memcpy((uint8_t*)(p_copy + 1) + p_copy->offset,
+           (uint8_t*)(p_buf + 1) + p_buf->offset, p_buf->len);
+    if (p_scb->media_pkt_copies++ == 0) {
+      AVDT_TRACE_WARNING("%s: media packet offset %d < %d, copying", __func__,
+                         p_buf->offset, min_offset);
+    }
+    osi_free(p_buf);
+    p_data->apiwrite.p_buf = p_copy;
+  }
+
   /* Build a media packet, and add an RTP header if required. */
   if (add_rtp_header) {
     ssrc = avdt_scb_gen_ssrc(p_scb);
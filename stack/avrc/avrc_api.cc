@@ -316,7 +316,8 @@ static uint16_t avrc_send_continue_frag(uint8_t handle, uint8_t label) {
   if (p_pkt->len > AVRC_MAX_CTRL_DATA_LEN) {
     int offset_len = MAX(AVCT_MSG_OFFSET, p_pkt->offset);
     p_pkt_old = p_fcb->p_fmsg;
-    p_pkt = (BT_HDR*)osi_calloc(AVRC_PACKET_LEN + offset_len + BT_HDR_SIZE);
+    /* Every field and payload octet of the fragment is written below */
+    p_pkt = (BT_HDR*)osi_malloc(AVRC_PACKET_LEN + offset_len + BT_HDR_SIZE);
     p_pkt->len = AVRC_MAX_CTRL_DATA_LEN;
     p_pkt->offset = AVCT_MSG_OFFSET;
     p_pkt->layer_specific = p_pkt_old->layer_specific;
@@ -1189,10 +1190,13 @@ uint16_t AVRC_MsgReq(uint8_t handle, uint8_t label, uint8_t ctype,
    * check for fragmentation only on the response */
   if ((cr == AVCT_RSP) && (chk_frag)) {
     if (p_pkt->len > AVRC_MAX_CTRL_DATA_LEN) {
-      int offset_len = MAX(AVCT_MSG_OFFSET, p_pkt->offset);
-      BT_HDR* p_pkt_new =
-          (BT_HDR*)osi_calloc(AVRC_PACKET_LEN + offset_len + BT_HDR_SIZE);
       if (p_start != NULL) {
+        /* The rest of the message stays in |p_pkt|: each continue fragment
+         * is copied out of it and the end fragment is sent from it in place,
+         * see avrc_prep_end_frag() */
+        int offset_len = MAX(AVCT_MSG_OFFSET, p_pkt->offset);
+        BT_HDR* p_pkt_new =
+            (BT_HDR*)osi_malloc(AVRC_PACKET_LEN + offset_len + BT_HDR_SIZE);
         p_fcb->frag_enabled = true;
         p_fcb->p_fmsg = p_pkt;
         p_fcb->frag_pdu = *p_start;
@@ -0,0 +1,402 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <base/logging.h>
+#include <benchmark/benchmark.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "a2dp_aac_constants.h"
+#include "a2dp_codec_api.h"
+#include "a2dp_vendor_ldac_constants.h"
+#include "avdt_api.h"
+#include "osi/include/allocation_tracker.h"
+#include "osi/include/allocator.h"
+
+using ::benchmark::Counter;
+using ::benchmark::State;
+
+// Drives the encoder of each A2DP Source codec the way the A2DP Source media
+// task does: one send_frames() call per encoder interval, reading the PCM of
+// a reference signal and dropping the packets after counting them.
+//
+// The time per iteration is the CPU the encoder takes for one media tick.
+// Besides it, each benchmark reports the encoded frames per second and the
+// osi allocations per media tick.
+//
+// Run with --golden_dir=<dir> to check the encoded packets are bit exact with
+// the ones stored in <dir>, before the benchmarks run; add --update_golden to
+// store the packets of this build instead.
+
+namespace {
+
+// A typical EDR peer
+const tA2DP_ENCODER_INIT_PEER_PARAMS kPeerParams = {true, true, 895};
+
+// Media ticks encoded for the bit exactness check
+constexpr int kGoldenTicks = 200;
+
+// Seconds of reference PCM, read in a loop
+constexpr int kPcmSeconds = 2;
+
+// Offsets in the codec capabilities built by A2DP_InitCodecConfig()
+constexpr size_t kSbcMaxBitpoolOffset = 6;
+constexpr size_t kAacBitRateOffset = 6;
+
+// LDAC quality modes are passed with this base in codec_specific_1
+constexpr int64_t kLdacQualityBase = 1000;
+
+struct CodecCase {
+  std::string name;
+  btav_a2dp_codec_index_t codec_index;
+  btav_a2dp_codec_sample_rate_t sample_rate;
+  // The SBC maximum bitpool, the AAC bit rate or the LDAC quality mode, as
+  // set by the peer or the user. 0 for the codec default.
+  int parameter;
+};
+
+std::vector<CodecCase> MakeCodecCases() {
+  const struct {
+    btav_a2dp_codec_sample_rate_t sample_rate;
+    const char* name;
+  } kRates[] = {
+      {BTAV_A2DP_CODEC_SAMPLE_RATE_44100, "44100"},
+      {BTAV_A2DP_CODEC_SAMPLE_RATE_48000, "48000"},
+      {BTAV_A2DP_CODEC_SAMPLE_RATE_88200, "88200"},
+      {BTAV_A2DP_CODEC_SAMPLE_RATE_96000, "96000"},
+  };
+  std::vector<CodecCase> cases;
+  for (const auto& rate : kRates) {
+    bool high_rate = rate.sample_rate > BTAV_A2DP_CODEC_SAMPLE_RATE_48000;
+    std::string name = std::string("/") + rate.name;
+    if (!high_rate) {
+      for (int bitpool : {35, 53}) {
+        cases.push_back({"SBC" + name + "/bitpool:" + std::to_string(bitpool),
+                         BTAV_A2DP_CODEC_INDEX_SOURCE_SBC, rate.sample_rate,
+                         bitpool});
+      }
+      for (int bit_rate : {128000, 320000}) {
+        cases.push_back({"AAC" + name + "/bitrate:" + std::to_string(bit_rate),
+                         BTAV_A2DP_CODEC_INDEX_SOURCE_AAC, rate.sample_rate,
+                         bit_rate});
+      }
+      cases.push_back({"aptX" + name, BTAV_A2DP_CODEC_INDEX_SOURCE_APTX,
+                       rate.sample_rate, 0});
+      cases.push_back({"aptX-HD" + name, BTAV_A2DP_CODEC_INDEX_SOURCE_APTX_HD,
+                       rate.sample_rate, 0});
+    }
+    const struct {
+      int quality;
+      const char* name;
+    } kLdacQualities[] = {
+        {A2DP_LDAC_QUALITY_HIGH, "990"},
+        {A2DP_LDAC_QUALITY_MID, "660"},
+        {A2DP_LDAC_QUALITY_LOW, "330"},
+    };
+    for (const auto& quality : kLdacQualities) {
+      cases.push_back({"LDAC" + name + "/kbps:" + quality.name,
+                       BTAV_A2DP_CODEC_INDEX_SOURCE_LDAC, rate.sample_rate,
+                       quality.quality});
+    }
+  }
+  return cases;
+}
+
+// The A2DP Source data path of one codec configuration
+class EncoderPath {
+ public:
+  ~EncoderPath() {
+    if (encoder_ != nullptr) encoder_->encoder_cleanup();
+    current_ = nullptr;
+  }
+
+  // Configures the codec of |codec_case| and initializes its encoder.
+  // Returns an error message, or an empty string on success.
+  std::string Init(const CodecCase& codec_case) {
+    codecs_.reset(new A2dpCodecs(std::vector<btav_a2dp_codec_config_t>()));
+    if (!codecs_->init()) return "no codec";
+
+    AvdtpSepConfig sep_config = {};
+    if (!A2DP_InitCodecConfig(codec_case.codec_index, &sep_config)) {
+      return "no codec capabilities";
+    }
+    // The local capabilities stand for the peer ones
+    uint8_t* peer_caps = sep_config.codec_info;
+    if (codec_case.codec_index == BTAV_A2DP_CODEC_INDEX_SOURCE_SBC) {
+      peer_caps[kSbcMaxBitpoolOffset] = codec_case.parameter;
+    } else if (codec_case.codec_index == BTAV_A2DP_CODEC_INDEX_SOURCE_AAC) {
+      uint32_t bit_rate = codec_case.parameter;
+      peer_caps[kAacBitRateOffset] =
+          (peer_caps[kAacBitRateOffset] & A2DP_AAC_VARIABLE_BIT_RATE_MASK) |
+          ((bit_rate & A2DP_AAC_BIT_RATE_MASK0) >> 16);
+      peer_caps[kAacBitRateOffset + 1] =
+          (bit_rate & A2DP_AAC_BIT_RATE_MASK1) >> 8;
+      peer_caps[kAacBitRateOffset + 2] = bit_rate & A2DP_AAC_BIT_RATE_MASK2;
+    }
+
+    uint8_t codec_info[AVDT_CODEC_SIZE];
+    if (!codecs_->setCodecConfig(peer_caps, true, codec_info, true)) {
+      return "codec not available";
+    }
+    codec_config_ = codecs_->getCurrentCodecConfig();
+
+    btav_a2dp_codec_config_t user_config = {};
+    user_config.codec_type = codec_case.codec_index;
+    user_config.codec_priority = codec_config_->codecPriority();
+    user_config.sample_rate = codec_case.sample_rate;
+    user_config.channel_mode = BTAV_A2DP_CODEC_CHANNEL_MODE_STEREO;
+    if (codec_case.codec_index == BTAV_A2DP_CODEC_INDEX_SOURCE_LDAC) {
+      user_config.codec_specific_1 = kLdacQualityBase + codec_case.parameter;
+    }
+    bool restart_input, restart_output, config_updated;
+    if (!codecs_->setCodecUserConfig(user_config, &kPeerParams, peer_caps,
+                                     codec_info, &restart_input,
+                                     &restart_output, &config_updated) ||
+        codecs_->getCurrentCodecConfig() != codec_config_ ||
+        codec_config_->getCodecConfig().sample_rate !=
+            codec_case.sample_rate) {
+      return "configuration not supported";
+    }
+
+    encoder_ = A2DP_GetEncoderInterface(codec_info);
+    if (encoder_ == nullptr) return "no encoder";
+
+    MakePcm(A2DP_GetTrackSampleRate(codec_info),
+            codec_config_->getAudioBitsPerSample(),
+            A2DP_GetTrackChannelCount(codec_info));
+
+    current_ = this;
+    encoder_->encoder_init(&kPeerParams, codec_config_, ReadPcm,
+                           EnqueuePacket);
+    encoder_->set_transmit_queue_length(0);
+    interval_us_ = encoder_->get_encoder_interval_ms() * 1000;
+    return "";
+  }
+
+  // Encodes one media tick
+  void Tick() {
+    timestamp_us_ += interval_us_;
+    encoder_->send_frames(timestamp_us_);
+  }
+
+  void set_capture(std::vector<uint8_t>* capture) { capture_ = capture; }
+  uint64_t frames() const { return frames_; }
+  uint64_t packets() const { return packets_; }
+  uint64_t encoded_bytes() const { return encoded_bytes_; }
+
+ private:
+  // A two tone signal, different on each channel, with some noise so that the
+  // encoders have something to do in every subband.
+  void MakePcm(int sample_rate, int bits_per_sample, int channel_count) {
+    size_t bytes_per_sample = bits_per_sample / 8;
+    size_t num_samples = sample_rate * channel_count * kPcmSeconds;
+    pcm_.resize(num_samples * bytes_per_sample);
+    uint32_t noise = 0x12345678;
+    for (size_t i = 0; i < num_samples; i++) {
+      int channel = i % channel_count;
+      double t = (double)(i / channel_count) / sample_rate;
+      double value = 0.45 * sin(2 * M_PI * (440.0 + 110.0 * channel) * t) +
+                     0.25 * sin(2 * M_PI * (5000.0 - 700.0 * channel) * t);
+      noise = noise * 1664525 + 1013904223;
+      int32_t sample = (int32_t)(value * INT32_MAX) + (int32_t)(noise >> 6) -
+                       (1 << 25);
+      // The most significant bytes of the sample, little endian
+      for (size_t b = 0; b < bytes_per_sample; b++) {
+        pcm_[i * bytes_per_sample + b] =
+            (uint8_t)(sample >> (8 * (4 - bytes_per_sample + b)));
+      }
+    }
+    pcm_offset_ = 0;
+  }
+
+  static uint32_t ReadPcm(uint8_t* p_buf, uint32_t len) {
+    EncoderPath* path = current_;
+    for (uint32_t copied = 0; copied < len;) {
+      size_t n = std::min<size_t>(len - copied,
+                                  path->pcm_.size() - path->pcm_offset_);
+      memcpy(p_buf + copied, path->pcm_.data() + path->pcm_offset_, n);
+      copied += n;
+      path->pcm_offset_ = (path->pcm_offset_ + n) % path->pcm_.size();
+    }
+    return len;
+  }
+
+  static bool EnqueuePacket(BT_HDR* p_buf, size_t frames_n,
+                            uint32_t num_bytes) {
+    EncoderPath* path = current_;
+    path->frames_ += frames_n;
+    path->packets_++;
+    path->encoded_bytes_ += p_buf->len;
+    if (path->capture_ != nullptr) {
+      const uint8_t* p_data = (const uint8_t*)(p_buf + 1) + p_buf->offset;
+      path->capture_->insert(path->capture_->end(), p_data,
+                             p_data + p_buf->len);
+    }
+    osi_free(p_buf);
+    return true;
+  }
+
+  // The encoder callbacks have no context
+  static EncoderPath* current_;
+
+  std::unique_ptr<A2dpCodecs> codecs_;
+  A2dpCodecConfig* codec_config_ = nullptr;
+  const tA2DP_ENCODER_INTERFACE* encoder_ = nullptr;
+  std::vector<uint8_t> pcm_;
+  size_t pcm_offset_ = 0;
+  uint64_t interval_us_ = 0;
+  uint64_t timestamp_us_ = 0;
+  std::vector<uint8_t>* capture_ = nullptr;
+  uint64_t frames_ = 0;
+  uint64_t packets_ = 0;
+  uint64_t encoded_bytes_ = 0;
+};
+
+EncoderPath* EncoderPath::current_ = nullptr;
+
+void BM_A2dpEncode(State& state, const CodecCase& codec_case) {
+  EncoderPath path;
+  std::string error = path.Init(codec_case);
+  if (!error.empty()) {
+    state.SkipWithError(error.c_str());
+    return;
+  }
+
+  size_t allocs = allocation_tracker_alloc_count();
+  for (auto _ : state) {
+    path.Tick();
+  }
+  allocs = allocation_tracker_alloc_count() - allocs;
+
+  state.counters["frames_per_sec"] = Counter(path.frames(), Counter::kIsRate);
+  state.counters["packets_per_tick"] =
+      Counter(path.packets(), Counter::kAvgIterations);
+  state.counters["allocs_per_tick"] =
+      Counter(allocs, Counter::kAvgIterations);
+  state.SetBytesProcessed(path.encoded_bytes());
+}
+
+// Returns false if the packets of a codec differ from the stored ones
+bool CheckGolden(const std::vector<CodecCase>& cases,
+                 const std::string& golden_dir, bool update) {
+  bool ok = true;
+  for (const CodecCase& codec_case : cases) {
+    std::vector<uint8_t> encoded;
+    {
+      EncoderPath path;
+      std::string error = path.Init(codec_case);
+      if (!error.empty()) {
+        printf("SKIP  %s: %s\n", codec_case.name.c_str(), error.c_str());
+        continue;
+      }
+      path.set_capture(&encoded);
+      for (int i = 0; i < kGoldenTicks; i++) path.Tick();
+    }
+
+    std::string file_name = codec_case.name;
+    for (char& c : file_name) {
+      if (c == '/' || c == ':') c = '_';
+    }
+    std::string path_name = golden_dir + "/" + file_name + ".bin";
+
+    if (update) {
+      FILE* fp = fopen(path_name.c_str(), "wb");
+      if (fp == nullptr ||
+          fwrite(encoded.data(), 1, encoded.size(), fp) != encoded.size()) {
+        printf("FAIL  %s: cannot write %s\n", codec_case.name.c_str(),
+               path_name.c_str());
+        ok = false;
+      } else {
+        printf("WROTE %s: %zu bytes\n", codec_case.name.c_str(),
+               encoded.size());
+      }
+      if (fp != nullptr) fclose(fp);
+      continue;
+    }
+
+    std::vector<uint8_t> golden;
+    FILE* fp = fopen(path_name.c_str(), "rb");
+    if (fp == nullptr) {
+      printf("FAIL  %s: no %s\n", codec_case.name.c_str(), path_name.c_str());
+      ok = false;
+      continue;
+    }
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0) {
+      golden.insert(golden.end(), buf, buf + n);
+    }
+    fclose(fp);
+
+    if (golden == encoded) {
+      printf("PASS  %s\n", codec_case.name.c_str());
+      continue;
+    }
+    size_t first_diff = 0;
+    while (first_diff < golden.size() && first_diff < encoded.size() &&
+           golden[first_diff] == encoded[first_diff]) {
+      first_diff++;
+    }
+    printf("FAIL  %s: %zu bytes instead of %zu, first difference at %zu\n",
+           codec_case.name.c_str(), encoded.size(), golden.size(), first_diff);
+    ok = false;
+  }
+  return ok;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::string golden_dir;
+  bool update_golden = false;
+  // Take out the options of this benchmark before the benchmark library
+  // parses the command line.
+  int out = 1;
+  for (int i = 1; i < argc; i++) {
+    if (strncmp(argv[i], "--golden_dir=", 13) == 0) {
+      golden_dir = argv[i] + 13;
+    } else if (strcmp(argv[i], "--update_golden") == 0) {
+      update_golden = true;
+    } else {
+      argv[out++] = argv[i];
+    }
+  }
+  argc = out;
+
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+
+  // Counts the osi allocations, for allocs_per_tick
+  allocation_tracker_init();
+
+  std::vector<CodecCase> cases = MakeCodecCases();
+  if (!golden_dir.empty() && !CheckGolden(cases, golden_dir, update_golden)) {
+    return 1;
+  }
+
+  for (const CodecCase& codec_case : cases) {
+    ::benchmark::RegisterBenchmark(
+        ("BM_A2dpEncode/" + codec_case.name).c_str(),
+        [codec_case](State& state) { BM_A2dpEncode(state, codec_case); });
+  }
+  ::benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
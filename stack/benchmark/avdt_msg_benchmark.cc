@@ -0,0 +1,257 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <base/logging.h>
+#include <benchmark/benchmark.h>
+#include <string.h>
+#include <vector>
+
+#include "avdt_int.h"
+#include "bt_trace.h"
+#include "osi/include/allocator.h"
+#include "osi/include/list.h"
+#include "stack/include/bt_types.h"
+
+using ::benchmark::State;
+
+// avdt_msg.cc is linked as is. The CCB and SCB state machines and the
+// adaptation layer it talks to are stubbed out below.
+
+AvdtpCb avdtp_cb;
+
+uint8_t appl_trace_level = BT_TRACE_LEVEL_WARNING;
+void LogMsg(uint32_t trace_set_mask, const char* fmt_str, ...) {}
+
+namespace {
+
+constexpr uint8_t kSeid = 1;
+constexpr uint8_t kIntSeid = 2;
+constexpr uint8_t kLabel = 5;
+constexpr uint16_t kPeerMtu = 672;
+
+// SBC 44.1 kHz joint stereo, 16 blocks, 8 subbands, loudness, bitpool 2-53
+const uint8_t kSbcCodecInfo[] = {0x00, 0x00, 0x21, 0x15, 0x02, 0x35};
+
+AvdtpScb scb;
+AvdtpTransportChannel sig_channel;
+
+int g_scb_event_count = 0;
+int g_ccb_event_count = 0;
+int g_write_count = 0;
+
+}  // namespace
+
+void avdt_ccb_event(AvdtpCcb* p_ccb, uint8_t event, tAVDT_CCB_EVT* p_data) {
+  g_ccb_event_count++;
+  // Mirrors avdt_ccb_snd_msg() so that queued responses reach the wire.
+  if (event == AVDT_CCB_SENDMSG_EVT) {
+    BT_HDR* p_msg;
+    while ((p_msg = avdt_msg_dequeue(p_ccb->rsp_q)) != NULL) {
+      avdt_msg_send(p_ccb, p_msg);
+    }
+  }
+}
+uint8_t avdt_ccb_to_idx(AvdtpCcb* p_ccb) { return 0; }
+void avdt_ccb_ret_ccb_timer_timeout(void* data) {}
+void avdt_ccb_rsp_ccb_timer_timeout(void* data) {}
+
+AvdtpScb* avdt_scb_by_hdl(uint8_t hdl) {
+  return (hdl == kSeid) ? &scb : nullptr;
+}
+uint8_t avdt_scb_to_hdl(AvdtpScb* p_scb) { return kSeid; }
+void avdt_scb_event(AvdtpScb* p_scb, uint8_t event, tAVDT_SCB_EVT* p_data) {
+  g_scb_event_count++;
+}
+
+AvdtpTransportChannel* avdt_ad_tc_tbl_by_type(uint8_t type, AvdtpCcb* p_ccb,
+                                              AvdtpScb* p_scb) {
+  return &sig_channel;
+}
+uint8_t avdt_ad_write_req(uint8_t type, AvdtpCcb* p_ccb, AvdtpScb* p_scb,
+                          BT_HDR* p_buf) {
+  g_write_count++;
+  osi_free(p_buf);
+  return AVDT_AD_SUCCESS;
+}
+
+namespace {
+
+// Appends the media transport, SBC codec and delay reporting capabilities.
+void AppendCapabilities(std::vector<uint8_t>* msg) {
+  msg->push_back(AVDT_CAT_TRANS);
+  msg->push_back(0);
+  msg->push_back(AVDT_CAT_CODEC);
+  msg->push_back(sizeof(kSbcCodecInfo));
+  msg->insert(msg->end(), kSbcCodecInfo,
+              kSbcCodecInfo + sizeof(kSbcCodecInfo));
+  msg->push_back(AVDT_CAT_DELAY_RPT);
+  msg->push_back(0);
+}
+
+std::vector<uint8_t> MakeSetConfigCmd() {
+  std::vector<uint8_t> msg = {
+      (uint8_t)((kLabel << 4) | (AVDT_PKT_TYPE_SINGLE << 2) |
+                AVDT_MSG_TYPE_CMD),
+      AVDT_SIG_SETCONFIG, (uint8_t)(kSeid << 2), (uint8_t)(kIntSeid << 2)};
+  AppendCapabilities(&msg);
+  return msg;
+}
+
+std::vector<uint8_t> MakeOpenCmd() {
+  return {(uint8_t)((kLabel << 4) | (AVDT_PKT_TYPE_SINGLE << 2) |
+                    AVDT_MSG_TYPE_CMD),
+          AVDT_SIG_OPEN, (uint8_t)(kSeid << 2)};
+}
+
+std::vector<uint8_t> MakeGetCapRsp() {
+  std::vector<uint8_t> msg = {
+      (uint8_t)((kLabel << 4) | (AVDT_PKT_TYPE_SINGLE << 2) |
+                AVDT_MSG_TYPE_RSP),
+      AVDT_SIG_GETCAP};
+  AppendCapabilities(&msg);
+  return msg;
+}
+
+BT_HDR* MakeBuffer(const std::vector<uint8_t>& bytes) {
+  BT_HDR* p_buf = (BT_HDR*)osi_malloc(BT_HDR_SIZE + L2CAP_MIN_OFFSET +
+                                      bytes.size());
+  p_buf->offset = L2CAP_MIN_OFFSET;
+  p_buf->len = bytes.size();
+  p_buf->layer_specific = 0;
+  memcpy((uint8_t*)(p_buf + 1) + p_buf->offset, bytes.data(), bytes.size());
+  return p_buf;
+}
+
+}  // namespace
+
+class BM_AvdtMsg : public ::benchmark::Fixture {
+ protected:
+  void SetUp(State& st) override {
+    ::benchmark::Fixture::SetUp(st);
+    g_scb_event_count = 0;
+    g_ccb_event_count = 0;
+    g_write_count = 0;
+    avdtp_cb.Reset();
+    // Only the queues of AvdtpCcb::Allocate() are needed, avdt_ccb.cc and
+    // its timers are not linked.
+    p_ccb_ = &avdtp_cb.ccb[0];
+    p_ccb_->cmd_q = list_new(NULL);
+    p_ccb_->rsp_q = list_new(NULL);
+    p_ccb_->allocated = true;
+    sig_channel.Reset();
+    sig_channel.peer_mtu = kPeerMtu;
+  }
+
+  void TearDown(State& st) override {
+    p_ccb_->ResetCcb();
+    ::benchmark::Fixture::TearDown(st);
+  }
+
+  AvdtpCcb* p_ccb_ = nullptr;
+};
+
+BENCHMARK_DEFINE_F(BM_AvdtMsg, ind_setconfig_cmd)(State& state) {
+  std::vector<uint8_t> msg = MakeSetConfigCmd();
+  for (auto _ : state) {
+    avdt_msg_ind(p_ccb_, MakeBuffer(msg));
+  }
+  CHECK_EQ(g_scb_event_count, static_cast<int>(state.iterations()));
+  state.SetBytesProcessed(state.iterations() * msg.size());
+}
+
+BENCHMARK_REGISTER_F(BM_AvdtMsg, ind_setconfig_cmd);
+
+// A command without configuration, the common case once streams are set up.
+BENCHMARK_DEFINE_F(BM_AvdtMsg, ind_open_cmd)(State& state) {
+  std::vector<uint8_t> msg = MakeOpenCmd();
+  for (auto _ : state) {
+    avdt_msg_ind(p_ccb_, MakeBuffer(msg));
+  }
+  CHECK_EQ(g_scb_event_count, static_cast<int>(state.iterations()));
+  state.SetBytesProcessed(state.iterations() * msg.size());
+}
+
+BENCHMARK_REGISTER_F(BM_AvdtMsg, ind_open_cmd);
+
+// The peer answers a Get Capabilities command that stays outstanding, so
+// every response is matched against the current command.
+BENCHMARK_DEFINE_F(BM_AvdtMsg, ind_getcap_rsp)(State& state) {
+  std::vector<uint8_t> msg = MakeGetCapRsp();
+  AvdtpSepConfig cfg;
+  p_ccb_->p_proc_data = &cfg;
+  p_ccb_->p_curr_cmd = (BT_HDR*)osi_malloc(AVDT_CMD_BUF_SIZE);
+  p_ccb_->p_curr_cmd->event = AVDT_SIG_GETCAP;
+  AVDT_BLD_LAYERSPEC(p_ccb_->p_curr_cmd->layer_specific, AVDT_MSG_TYPE_CMD,
+                     kLabel);
+  for (auto _ : state) {
+    avdt_msg_ind(p_ccb_, MakeBuffer(msg));
+  }
+  CHECK_EQ(g_ccb_event_count, static_cast<int>(2 * state.iterations()));
+  osi_free_and_reset((void**)&p_ccb_->p_curr_cmd);
+  state.SetBytesProcessed(state.iterations() * msg.size());
+}
+
+BENCHMARK_REGISTER_F(BM_AvdtMsg, ind_getcap_rsp);
+
+BENCHMARK_DEFINE_F(BM_AvdtMsg, send_getcap_rsp)(State& state) {
+  AvdtpSepConfig cfg;
+  cfg.psc_mask = AVDT_PSC_TRANS | AVDT_PSC_DELAY_RPT;
+  cfg.num_codec = 1;
+  cfg.codec_info[0] = sizeof(kSbcCodecInfo);
+  memcpy(&cfg.codec_info[1], kSbcCodecInfo, sizeof(kSbcCodecInfo));
+  tAVDT_MSG msg = {};
+  msg.svccap.p_cfg = &cfg;
+  for (auto _ : state) {
+    msg.hdr.label = kLabel;
+    avdt_msg_send_rsp(p_ccb_, AVDT_SIG_GETCAP, &msg);
+  }
+  CHECK_EQ(g_write_count, static_cast<int>(state.iterations()));
+}
+
+BENCHMARK_REGISTER_F(BM_AvdtMsg, send_getcap_rsp);
+
+// Commands are only built and queued: sending them starts the command timers
+// of avdt_ccb.cc, which is not linked.
+BENCHMARK_DEFINE_F(BM_AvdtMsg, send_setconfig_cmd)(State& state) {
+  AvdtpSepConfig cfg;
+  cfg.psc_mask = AVDT_PSC_TRANS | AVDT_PSC_DELAY_RPT;
+  cfg.num_codec = 1;
+  cfg.codec_info[0] = sizeof(kSbcCodecInfo);
+  memcpy(&cfg.codec_info[1], kSbcCodecInfo, sizeof(kSbcCodecInfo));
+  tAVDT_MSG msg = {};
+  msg.config_cmd.hdr.seid = kSeid;
+  msg.config_cmd.int_seid = kIntSeid;
+  msg.config_cmd.p_cfg = &cfg;
+  for (auto _ : state) {
+    avdt_msg_send_cmd(p_ccb_, &scb, AVDT_SIG_SETCONFIG, &msg);
+    osi_free(avdt_msg_dequeue(p_ccb_->cmd_q));
+  }
+  CHECK_EQ(g_ccb_event_count, static_cast<int>(state.iterations()));
+}
+
+BENCHMARK_REGISTER_F(BM_AvdtMsg, send_setconfig_cmd);
+
+int main(int argc, char** argv) {
+  // Disable LOG() output from libchrome
+  logging::LoggingSettings log_settings;
+  log_settings.logging_dest = logging::LoggingDestination::LOG_NONE;
+  CHECK(logging::InitLogging(log_settings)) << "Failed to set up logging";
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  ::benchmark::RunSpecifiedBenchmarks();
+}
@@ -0,0 +1,131 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <base/logging.h>
+#include <benchmark/benchmark.h>
+#include <string.h>
+
+#include "bt_target.h"
+#include "btm_int.h"
+#include "types/raw_address.h"
+
+using ::benchmark::State;
+
+// btm_acl_db_index.cc is linked as is. The linear scans of acl_db it replaced
+// are kept below as the baseline.
+
+tBTM_CB btm_cb;
+
+namespace {
+
+uint8_t LinearFindHandle(uint16_t hci_handle) {
+  tACL_CONN* p = &btm_cb.acl_db[0];
+  uint8_t xx;
+  for (xx = 0; xx < MAX_L2CAP_LINKS; xx++, p++) {
+    if (p->in_use && p->hci_handle == hci_handle) break;
+  }
+  return xx;
+}
+
+uint8_t LinearFindBda(const RawAddress& bda, tBT_TRANSPORT transport) {
+  tACL_CONN* p = &btm_cb.acl_db[0];
+  uint8_t xx;
+  for (xx = 0; xx < MAX_L2CAP_LINKS; xx++, p++) {
+    if (p->in_use && p->remote_addr == bda && p->transport == transport) break;
+  }
+  return xx;
+}
+
+RawAddress Address(int n) {
+  RawAddress bda;
+  memset(bda.address, 0x5a, sizeof(bda.address));
+  bda.address[5] = n;
+  return bda;
+}
+
+// Fills the first |links| entries of acl_db, alternating BR/EDR and LE, and
+// indexes them the way btm_acl_created() does
+void SetUpLinks(int links) {
+  memset(&btm_cb, 0, sizeof(btm_cb));
+  for (int xx = 0; xx < links; xx++) {
+    tACL_CONN* p = &btm_cb.acl_db[xx];
+    p->in_use = true;
+    p->hci_handle = 0x0040 + xx;
+    p->transport = (xx % 2) ? BT_TRANSPORT_LE : BT_TRANSPORT_BR_EDR;
+    p->remote_addr = Address(xx);
+    btm_acl_db_index_update(xx);
+  }
+}
+
+// Each iteration looks every link up once, as the receive path does for the
+// packets of all the links
+void BM_FindHandle(State& state, uint8_t (*find)(uint16_t)) {
+  int links = state.range(0);
+  SetUpLinks(links);
+  for (auto _ : state) {
+    for (int xx = 0; xx < links; xx++) {
+      benchmark::DoNotOptimize(find(0x0040 + xx));
+    }
+  }
+  CHECK_EQ(find(0x0040 + links - 1), links - 1);
+  state.SetItemsProcessed(state.iterations() * links);
+}
+
+void BM_FindBda(State& state,
+                uint8_t (*find)(const RawAddress&, tBT_TRANSPORT)) {
+  int links = state.range(0);
+  SetUpLinks(links);
+  RawAddress addresses[MAX_L2CAP_LINKS];
+  for (int xx = 0; xx < links; xx++) addresses[xx] = Address(xx);
+  for (auto _ : state) {
+    for (int xx = 0; xx < links; xx++) {
+      benchmark::DoNotOptimize(find(
+          addresses[xx], (xx % 2) ? BT_TRANSPORT_LE : BT_TRANSPORT_BR_EDR));
+    }
+  }
+  CHECK_EQ(find(addresses[0], BT_TRANSPORT_BR_EDR), 0);
+  state.SetItemsProcessed(state.iterations() * links);
+}
+
+void BM_LinearFindHandle(State& state) {
+  BM_FindHandle(state, LinearFindHandle);
+}
+void BM_IndexFindHandle(State& state) {
+  BM_FindHandle(state, btm_acl_db_index_find_handle);
+}
+void BM_LinearFindBda(State& state) { BM_FindBda(state, LinearFindBda); }
+void BM_IndexFindBda(State& state) {
+  BM_FindBda(state, btm_acl_db_index_find_bda);
+}
+
+}  // namespace
+
+BENCHMARK(BM_LinearFindHandle)->Arg(7)->Arg(MAX_L2CAP_LINKS);
+BENCHMARK(BM_IndexFindHandle)->Arg(7)->Arg(MAX_L2CAP_LINKS);
+BENCHMARK(BM_LinearFindBda)->Arg(7)->Arg(MAX_L2CAP_LINKS);
+BENCHMARK(BM_IndexFindBda)->Arg(7)->Arg(MAX_L2CAP_LINKS);
+
+int main(int argc, char** argv) {
+  // Disable LOG() output from libchrome
+  logging::LoggingSettings log_settings;
+  log_settings.logging_dest = logging::LoggingDestination::LOG_NONE;
+  CHECK(logging::InitLogging(log_settings)) << "Failed to set up logging";
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  ::benchmark::RunSpecifiedBenchmarks();
+}
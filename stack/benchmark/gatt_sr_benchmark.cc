@@ -0,0 +1,232 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <base/logging.h>
+#include <benchmark/benchmark.h>
+#include <string.h>
+#include <list>
+
+#include "osi/include/allocator.h"
+#include "stack/gatt/gatt_int.h"
+#include "stack/include/l2cdefs.h"
+#include "types/raw_address.h"
+
+using ::benchmark::State;
+using bluetooth::Uuid;
+
+// gatt_sr.cc, gatt_db.cc and gatt_utils.cc are linked as is. The ATT
+// protocol layer, BTM, L2CAP and SDP are stubbed out below.
+
+tGATT_CB gatt_cb;
+
+namespace {
+
+int g_rsp_count = 0;
+int g_error_rsp_count = 0;
+// Handle of the last attribute carried by the latest Read By Type response
+uint16_t g_last_handle = 0;
+
+}  // namespace
+
+namespace connection_manager {
+bool background_connect_remove(uint8_t app_id, const RawAddress& address) {
+  return false;
+}
+bool direct_connect_remove(uint8_t app_id, const RawAddress& address) {
+  return false;
+}
+}  // namespace connection_manager
+
+BT_HDR* attp_build_sr_msg(tGATT_TCB& tcb, uint8_t op_code,
+                          tGATT_SR_MSG* p_msg) {
+  // Only used for error responses on the paths benchmarked here
+  if (op_code == GATT_RSP_ERROR) g_error_rsp_count++;
+  return nullptr;
+}
+tGATT_STATUS attp_send_cl_msg(tGATT_TCB& tcb, tGATT_CLCB* p_clcb,
+                              uint8_t op_code, tGATT_CL_MSG* p_msg) {
+  return GATT_SUCCESS;
+}
+tGATT_STATUS attp_send_sr_msg(tGATT_TCB& tcb, BT_HDR* p_msg) {
+  g_rsp_count++;
+  uint8_t* p = (uint8_t*)(p_msg + 1) + p_msg->offset;
+  if (*p == GATT_RSP_READ_BY_TYPE) {
+    uint8_t entry_len = p[1];
+    p += p_msg->len - entry_len;
+    STREAM_TO_UINT16(g_last_handle, p);
+  }
+  osi_free(p_msg);
+  return GATT_SUCCESS;
+}
+uint8_t btm_ble_read_sec_key_size(const RawAddress& bd_addr) { return 16; }
+bool BTM_GetSecurityFlagsByTransport(const RawAddress& bd_addr,
+                                     uint8_t* p_sec_flags,
+                                     tBT_TRANSPORT transport) {
+  *p_sec_flags = 0;
+  return true;
+}
+void gatt_act_discovery(tGATT_CLCB* p_clcb) {}
+bool gatt_disconnect(tGATT_TCB* p_tcb) { return false; }
+tGATT_CH_STATE gatt_get_ch_state(tGATT_TCB* p_tcb) { return GATT_CH_OPEN; }
+void gatt_set_ch_state(tGATT_TCB* p_tcb, tGATT_CH_STATE ch_state) {}
+tGATT_STATUS GATTS_HandleValueIndication(uint16_t conn_id, uint16_t attr_handle,
+                                         uint16_t val_len, uint8_t* p_val) {
+  return GATT_SUCCESS;
+}
+void gatt_update_app_use_link_flag(tGATT_IF gatt_if, tGATT_TCB* p_tcb,
+                                   bool is_add, bool check_acl_link) {}
+base::MessageLoop* get_main_message_loop() { return nullptr; }
+void l2cble_set_fixed_channel_tx_data_length(const RawAddress& remote_bda,
+                                             uint16_t fix_cid,
+                                             uint16_t tx_mtu) {}
+bool SDP_AddAttribute(uint32_t handle, uint16_t attr_id, uint8_t attr_type,
+                      uint32_t attr_len, uint8_t* p_val) {
+  return false;
+}
+bool SDP_AddProtocolList(uint32_t handle, uint16_t num_elem,
+                         tSDP_PROTOCOL_ELEM* p_elem_list) {
+  return false;
+}
+bool SDP_AddServiceClassIdList(uint32_t handle, uint16_t num_services,
+                               uint16_t* p_service_uuids) {
+  return false;
+}
+bool SDP_AddUuidSequence(uint32_t handle, uint16_t attr_id, uint16_t num_uuids,
+                         uint16_t* p_uuids) {
+  return false;
+}
+uint32_t SDP_CreateRecord(void) { return 0; }
+
+namespace {
+
+constexpr tGATT_IF kGattIf = 1;
+constexpr uint16_t kServiceStartHandle = GATT_APP_START_HANDLE;
+const RawAddress kRemoteAddress({0x11, 0x22, 0x33, 0x44, 0x55, 0x66});
+const Uuid kServiceUuid = Uuid::From16Bit(0x180D);
+const Uuid kCharacteristicUuid = Uuid::From16Bit(0x2A37);
+
+}  // namespace
+
+// Registers one primary service holding |state.range(0)| readable
+// characteristics, and a connected LE link using the default ATT MTU.
+class BM_GattSr : public ::benchmark::Fixture {
+ protected:
+  void SetUp(State& st) override {
+    ::benchmark::Fixture::SetUp(st);
+    g_rsp_count = 0;
+    g_error_rsp_count = 0;
+
+    uint16_t num_chars = st.range(0);
+    uint16_t num_handles = 1 + 2 * num_chars;
+    gatts_init_service_db(db_, kServiceUuid, true, kServiceStartHandle,
+                          num_handles);
+    for (uint16_t i = 0; i < num_chars; i++) {
+      last_char_decl_handle_ = db_.next_handle;
+      gatts_add_characteristic(db_, GATT_PERM_READ, GATT_CHAR_PROP_BIT_READ,
+                               kCharacteristicUuid);
+    }
+
+    tGATT_SRV_LIST_ELEM elem = {};
+    elem.p_db = &db_;
+    elem.type = GATT_UUID_PRI_SERVICE;
+    elem.s_hdl = kServiceStartHandle;
+    elem.e_hdl = kServiceStartHandle + num_handles - 1;
+    elem.gatt_if = kGattIf;
+    elem.is_primary = true;
+    srv_list_info_.push_back(elem);
+    gatt_cb.srv_list_info = &srv_list_info_;
+    gatt_sr_update_handle_index();
+
+    p_tcb_ = &gatt_cb.tcb[0];
+    p_tcb_->in_use = true;
+    p_tcb_->tcb_idx = 0;
+    p_tcb_->peer_bda = kRemoteAddress;
+    p_tcb_->transport = BT_TRANSPORT_LE;
+    p_tcb_->att_lcid = L2CAP_ATT_CID;
+    p_tcb_->payload_size = GATT_DEF_BLE_MTU_SIZE;
+  }
+
+  void TearDown(State& st) override {
+    gatt_cb.srv_list_info = nullptr;
+    srv_list_info_.clear();
+    gatt_sr_update_handle_index();
+    db_.attr_list.clear();
+    p_tcb_->in_use = false;
+    ::benchmark::Fixture::TearDown(st);
+  }
+
+  tGATT_SVC_DB db_;
+  std::list<tGATT_SRV_LIST_ELEM> srv_list_info_;
+  tGATT_TCB* p_tcb_ = nullptr;
+  uint16_t last_char_decl_handle_ = 0;
+};
+
+// One complete characteristic discovery of the service, as a client runs it
+// after connecting: Read By Type requests for the characteristic declaration
+// are repeated from the last returned handle until the server answers with
+// Attribute Not Found.
+BENCHMARK_DEFINE_F(BM_GattSr, discover_characteristics)(State& state) {
+  int requests = 0;
+  for (auto _ : state) {
+    uint16_t s_hdl = kServiceStartHandle;
+    int errors = g_error_rsp_count;
+    while (g_error_rsp_count == errors) {
+      uint8_t req[6];
+      uint8_t* p = req;
+      UINT16_TO_STREAM(p, s_hdl);
+      UINT16_TO_STREAM(p, 0xFFFF);
+      UINT16_TO_STREAM(p, GATT_UUID_CHAR_DECLARE);
+      gatt_server_handle_client_req(*p_tcb_, GATT_REQ_READ_BY_TYPE,
+                                    sizeof(req), req);
+      s_hdl = g_last_handle + 1;
+      requests++;
+    }
+  }
+  CHECK_EQ(g_error_rsp_count, static_cast<int>(state.iterations()));
+  state.counters["requests"] =
+      ::benchmark::Counter(requests, ::benchmark::Counter::kAvgIterations);
+}
+
+BENCHMARK_REGISTER_F(BM_GattSr, discover_characteristics)
+    ->Arg(4)
+    ->Arg(16)
+    ->Arg(64);
+
+// Reads the last characteristic declaration of the service, so that the
+// whole attribute list is walked on every request.
+BENCHMARK_DEFINE_F(BM_GattSr, read_char_decl)(State& state) {
+  uint8_t req[2];
+  uint8_t* p = req;
+  UINT16_TO_STREAM(p, last_char_decl_handle_);
+  for (auto _ : state) {
+    gatt_server_handle_client_req(*p_tcb_, GATT_REQ_READ, sizeof(req), req);
+  }
+  CHECK_EQ(g_rsp_count, static_cast<int>(state.iterations()));
+}
+
+BENCHMARK_REGISTER_F(BM_GattSr, read_char_decl)->Arg(4)->Arg(16)->Arg(64);
+
+int main(int argc, char** argv) {
+  // Disable LOG() output from libchrome
+  logging::LoggingSettings log_settings;
+  log_settings.logging_dest = logging::LoggingDestination::LOG_NONE;
+  CHECK(logging::InitLogging(log_settings)) << "Failed to set up logging";
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  ::benchmark::RunSpecifiedBenchmarks();
+}
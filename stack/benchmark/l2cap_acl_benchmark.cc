@@ -0,0 +1,352 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <base/logging.h>
+#include <benchmark/benchmark.h>
+#include <string.h>
+#include <vector>
+
+#include "bt_trace.h"
+#include "btm_int.h"
+#include "device/include/controller.h"
+#include "hci/include/btsnoop.h"
+#include "hcimsgs.h"
+#include "l2c_int.h"
+#include "l2cdefs.h"
+#include "osi/include/allocator.h"
+#include "stack/include/bt_types.h"
+#include "stack/include/btm_api.h"
+
+using ::benchmark::State;
+
+// The L2CAP sources under test are linked as is. Everything they call in the
+// neighbouring layers (BTM, HCI, controller) is stubbed out below.
+
+uint8_t appl_trace_level = BT_TRACE_LEVEL_WARNING;
+void LogMsg(uint32_t trace_set_mask, const char* fmt_str, ...) {}
+
+tBTM_SEC_DEV_REC* btm_find_dev(const RawAddress& bd_addr) { return nullptr; }
+tBTM_INQ_INFO* BTM_InqDbRead(const RawAddress& p_bda) { return nullptr; }
+tBTM_STATUS BTM_SwitchRole(const RawAddress& remote_bd_addr, uint8_t new_role,
+                           tBTM_CMPL_CB* p_cb) {
+  return BTM_SUCCESS;
+}
+void BTM_ReadDevInfo(const RawAddress& remote_bda, tBT_DEVICE_TYPE* p_dev_type,
+                     tBLE_ADDR_TYPE* p_addr_type) {}
+void btm_acl_removed(const RawAddress& bda, tBT_TRANSPORT transport) {}
+tBTM_STATUS BTM_SetPowerMode(uint8_t pm_id, const RawAddress& remote_bda,
+                             const tBTM_PM_PWR_MD* p_mode) {
+  return BTM_SUCCESS;
+}
+uint16_t BTM_GetNumAclLinks(void) { return 1; }
+tBTM_STATUS btm_sec_disconnect(uint16_t handle, uint8_t reason) {
+  return BTM_SUCCESS;
+}
+void btm_remove_sco_links(const RawAddress& bda) {}
+uint8_t* BTM_ReadLocalFeatures(void) { return nullptr; }
+uint16_t btm_get_max_packet_size(const RawAddress& addr) { return 1021; }
+void btm_pm_policy_traffic(uint16_t hci_handle) {}
+void l2cble_tune_traffic(tL2C_LCB* p_lcb, uint16_t len, bool is_tx) {}
+tBTM_STATUS btm_sec_l2cap_access_req(const RawAddress& bd_addr, uint16_t psm,
+                                     uint16_t handle, CONNECTION_TYPE conn_type,
+                                     tBTM_SEC_CALLBACK* p_callback,
+                                     void* p_ref_data) {
+  return BTM_SUCCESS;
+}
+void BTM_VendorSpecificCommand(uint16_t opcode, uint8_t param_len,
+                               uint8_t* p_param_buf, tBTM_VSC_CMPL_CB* p_cb) {}
+void btm_acl_update_busy_level(tBTM_BLI_EVENT event) {}
+uint8_t btm_sec_clr_service_by_psm(uint16_t psm) { return 0; }
+bool btm_is_sco_active_by_bdaddr(const RawAddress& remote_bda) { return false; }
+bool btm_acl_notif_conn_collision(const RawAddress& bda) { return false; }
+void btm_sec_clr_temp_auth_service(const RawAddress& bda) {}
+void btm_sec_abort_access_req(const RawAddress& bd_addr) {}
+
+void l2c_link_timeout(tL2C_LCB* p_lcb) {}
+void l2c_link_sec_comp(const RawAddress* p_bda, tBT_TRANSPORT trasnport,
+                       void* p_ref_data, uint8_t status) {}
+void l2c_link_sec_comp2(const RawAddress& p_bda, tBT_TRANSPORT trasnport,
+                        void* p_ref_data, uint8_t status) {}
+bool l2c_link_hci_disc_comp(uint16_t handle, uint8_t reason) { return false; }
+void l2c_link_check_send_pkts(tL2C_LCB* p_lcb, tL2C_CCB* p_ccb,
+                              BT_HDR* p_buf) {
+  osi_free(p_buf);
+}
+void l2c_link_adjust_allocation(void) {}
+void l2c_link_adjust_chnl_allocation(void) {}
+void l2c_ble_link_adjust_allocation(void) {}
+void l2c_info_resp_timer_timeout(void* data) {}
+
+void L2CA_FreeLePSM(uint16_t psm) {}
+bool l2cble_create_conn(tL2C_LCB* p_lcb) { return false; }
+tL2CAP_LE_RESULT_CODE l2ble_sec_access_req(const RawAddress& bd_addr,
+                                           uint16_t psm, bool is_originator,
+                                           tL2CAP_SEC_CBACK* p_callback,
+                                           void* p_ref_data) {
+  return L2CAP_LE_RESULT_CONN_OK;
+}
+void l2cble_process_sig_cmd(tL2C_LCB* p_lcb, uint8_t* p, uint16_t pkt_len) {}
+void l2cble_send_peer_disc_req(tL2C_CCB* p_ccb) {}
+void l2cble_notify_le_connection(const RawAddress& bda) {}
+void l2cble_credit_based_conn_req(tL2C_CCB* p_ccb) {}
+void l2cble_credit_based_conn_res(tL2C_CCB* p_ccb, uint16_t result) {}
+void l2cble_send_flow_control_credit(tL2C_CCB* p_ccb, uint16_t credit_value) {}
+
+void btsnd_hcic_disconnect(uint16_t handle, uint8_t reason) {}
+void btsnd_hcic_create_conn(const RawAddress& dest, uint16_t packet_types,
+                            uint8_t page_scan_rep_mode, uint8_t page_scan_mode,
+                            uint16_t clock_offset, uint8_t allow_switch) {}
+void btsnd_hcic_write_auto_flush_tout(uint16_t handle, uint16_t timeout) {}
+
+namespace {
+
+void clear_l2cap_whitelist(uint16_t conn_handle, uint16_t local_cid,
+                           uint16_t remote_cid) {}
+
+btsnoop_t fake_btsnoop;
+
+}  // namespace
+
+const btsnoop_t* btsnoop_get_interface(void) {
+  fake_btsnoop.clear_l2cap_whitelist = clear_l2cap_whitelist;
+  return &fake_btsnoop;
+}
+
+namespace {
+
+constexpr uint16_t kHandle = 0x0042;
+constexpr uint16_t kPsm = 0x1001;
+const RawAddress kRemoteAddress({0x11, 0x22, 0x33, 0x44, 0x55, 0x66});
+
+uint16_t get_ble_default_data_packet_length() { return 27; }
+uint16_t get_acl_data_size_classic() { return 1021; }
+uint16_t get_acl_packet_size_classic() { return 1021 + HCI_DATA_PREAMBLE_SIZE; }
+
+controller_t fake_controller;
+
+int g_delivered_count = 0;
+
+void on_data_ind(uint16_t cid, BT_HDR* p_buf) {
+  g_delivered_count++;
+  osi_free(p_buf);
+}
+
+void on_fixed_conn(uint16_t cid, const RawAddress& bd_addr, bool connected,
+                   uint16_t reason, tBT_TRANSPORT transport) {}
+
+void on_fixed_data(uint16_t cid, const RawAddress& bd_addr, BT_HDR* p_buf) {
+  g_delivered_count++;
+  osi_free(p_buf);
+}
+
+tL2C_RCB rcb;
+
+// Builds a complete ACL packet, as handed over by the packet fragmenter, that
+// carries |payload| on |cid|.
+std::vector<uint8_t> MakeAclPacket(uint16_t cid,
+                                   const std::vector<uint8_t>& payload) {
+  std::vector<uint8_t> packet(HCI_DATA_PREAMBLE_SIZE + L2CAP_PKT_OVERHEAD +
+                              payload.size());
+  uint8_t* p = packet.data();
+  UINT16_TO_STREAM(p, kHandle | (L2CAP_PKT_START << L2CAP_PKT_TYPE_SHIFT));
+  UINT16_TO_STREAM(p, L2CAP_PKT_OVERHEAD + payload.size());
+  UINT16_TO_STREAM(p, payload.size());
+  UINT16_TO_STREAM(p, cid);
+  memcpy(p, payload.data(), payload.size());
+  return packet;
+}
+
+std::vector<uint8_t> MakeAclPacket(uint16_t cid, size_t payload_size) {
+  std::vector<uint8_t> payload(payload_size);
+  for (size_t i = 0; i < payload_size; i++) payload[i] = i;
+  return MakeAclPacket(cid, payload);
+}
+
+// Appends to |commands| a configuration response to |lcid| that carries every
+// option the stack knows of.
+void AppendConfigRsp(std::vector<uint8_t>* commands, uint8_t id,
+                     uint16_t lcid) {
+  uint8_t cmd[L2CAP_CMD_OVERHEAD + L2CAP_CONFIG_RSP_LEN + 64];
+  uint8_t* p = cmd;
+  UINT8_TO_STREAM(p, L2CAP_CMD_CONFIG_RSP);
+  UINT8_TO_STREAM(p, id);
+  UINT16_TO_STREAM(p, sizeof(cmd) - L2CAP_CMD_OVERHEAD);
+  UINT16_TO_STREAM(p, lcid);
+  UINT16_TO_STREAM(p, 0);
+  UINT16_TO_STREAM(p, L2CAP_CFG_OK);
+  UINT8_TO_STREAM(p, L2CAP_CFG_TYPE_MTU);
+  UINT8_TO_STREAM(p, 2);
+  UINT16_TO_STREAM(p, 1017);
+  UINT8_TO_STREAM(p, L2CAP_CFG_TYPE_FLUSH_TOUT);
+  UINT8_TO_STREAM(p, 2);
+  UINT16_TO_STREAM(p, 0xffff);
+  UINT8_TO_STREAM(p, L2CAP_CFG_TYPE_QOS);
+  UINT8_TO_STREAM(p, 22);
+  UINT8_TO_STREAM(p, 0);
+  UINT8_TO_STREAM(p, 1);
+  for (int i = 0; i < 5; i++) UINT32_TO_STREAM(p, 0);
+  UINT8_TO_STREAM(p, L2CAP_CFG_TYPE_FCR);
+  UINT8_TO_STREAM(p, 9);
+  UINT8_TO_STREAM(p, L2CAP_FCR_ERTM_MODE);
+  UINT8_TO_STREAM(p, 10);
+  UINT8_TO_STREAM(p, 20);
+  UINT16_TO_STREAM(p, 2000);
+  UINT16_TO_STREAM(p, 12000);
+  UINT16_TO_STREAM(p, 1010);
+  UINT8_TO_STREAM(p, L2CAP_CFG_TYPE_FCS);
+  UINT8_TO_STREAM(p, 1);
+  UINT8_TO_STREAM(p, 1);
+  UINT8_TO_STREAM(p, L2CAP_CFG_TYPE_EXT_FLOW);
+  UINT8_TO_STREAM(p, 16);
+  UINT8_TO_STREAM(p, 1);
+  UINT8_TO_STREAM(p, 1);
+  UINT16_TO_STREAM(p, 1010);
+  for (int i = 0; i < 3; i++) UINT32_TO_STREAM(p, 0xffffffff);
+  CHECK_EQ(p, cmd + sizeof(cmd));
+  commands->insert(commands->end(), cmd, p);
+}
+
+BT_HDR* MakeBuffer(const std::vector<uint8_t>& bytes) {
+  BT_HDR* p_buf =
+      static_cast<BT_HDR*>(osi_malloc(BT_HDR_SIZE + bytes.size()));
+  p_buf->event = BT_EVT_TO_BTU_HCI_ACL;
+  p_buf->len = bytes.size();
+  p_buf->offset = 0;
+  p_buf->layer_specific = 0;
+  memcpy(p_buf->data, bytes.data(), bytes.size());
+  return p_buf;
+}
+
+}  // namespace
+
+// Needed for linkage
+const controller_t* controller_get_interface() { return &fake_controller; }
+
+class BM_L2capAcl : public ::benchmark::Fixture {
+ protected:
+  void SetUp(State& st) override {
+    ::benchmark::Fixture::SetUp(st);
+    fake_controller.get_ble_default_data_packet_length =
+        get_ble_default_data_packet_length;
+    fake_controller.get_acl_data_size_classic = get_acl_data_size_classic;
+    fake_controller.get_acl_packet_size_classic = get_acl_packet_size_classic;
+    g_delivered_count = 0;
+
+    l2c_init();
+    p_lcb_ = l2cu_allocate_lcb(kRemoteAddress, false, BT_TRANSPORT_BR_EDR);
+    CHECK(p_lcb_ != nullptr);
+    l2cu_set_lcb_handle(p_lcb_, kHandle);
+    p_lcb_->link_state = LST_CONNECTED;
+
+    memset(&rcb, 0, sizeof(rcb));
+    rcb.in_use = true;
+    rcb.psm = kPsm;
+    rcb.api.pL2CA_DataInd_Cb = on_data_ind;
+    p_ccb_ = l2cu_allocate_ccb(p_lcb_, 0);
+    CHECK(p_ccb_ != nullptr);
+    p_ccb_->p_rcb = &rcb;
+    p_ccb_->chnl_state = CST_OPEN;
+
+    tL2CAP_FIXED_CHNL_REG* p_fixed = &l2cb.fixed_reg[L2CAP_ATT_CID -
+                                                  L2CAP_FIRST_FIXED_CHNL];
+    p_fixed->pL2CA_FixedConn_Cb = on_fixed_conn;
+    p_fixed->pL2CA_FixedData_Cb = on_fixed_data;
+    p_fixed->fixed_chnl_opts.mode = L2CAP_FCR_BASIC_MODE;
+  }
+
+  void TearDown(State& st) override {
+    l2cu_release_lcb(p_lcb_);
+    l2c_free();
+    ::benchmark::Fixture::TearDown(st);
+  }
+
+  void RunReceive(State& state, uint16_t cid) {
+    std::vector<uint8_t> packet = MakeAclPacket(cid, state.range(0));
+    for (auto _ : state) {
+      l2c_rcv_acl_data(MakeBuffer(packet));
+    }
+    CHECK_EQ(g_delivered_count, static_cast<int>(state.iterations()));
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+  }
+
+  tL2C_LCB* p_lcb_ = nullptr;
+  tL2C_CCB* p_ccb_ = nullptr;
+};
+
+BENCHMARK_DEFINE_F(BM_L2capAcl, dynamic_channel)(State& state) {
+  RunReceive(state, p_ccb_->local_cid);
+}
+
+BENCHMARK_REGISTER_F(BM_L2capAcl, dynamic_channel)
+    ->Arg(16)
+    ->Arg(64)
+    ->Arg(672)
+    ->Arg(1017);
+
+BENCHMARK_DEFINE_F(BM_L2capAcl, fixed_channel)(State& state) {
+  RunReceive(state, L2CAP_ATT_CID);
+}
+
+BENCHMARK_REGISTER_F(BM_L2capAcl, fixed_channel)->Arg(16)->Arg(64)->Arg(512);
+
+// Parses a signalling packet of range(0) configuration responses. Their ID is
+// not the one the channel waits for, so they are dropped once parsed.
+BENCHMARK_DEFINE_F(BM_L2capAcl, signalling_config_rsp)(State& state) {
+  p_ccb_->local_id = 1;
+  std::vector<uint8_t> commands;
+  for (int i = 0; i < state.range(0); i++) {
+    AppendConfigRsp(&commands, 2, p_ccb_->local_cid);
+  }
+  std::vector<uint8_t> packet = MakeAclPacket(L2CAP_SIGNALLING_CID, commands);
+  for (auto _ : state) {
+    l2c_rcv_acl_data(MakeBuffer(packet));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK_REGISTER_F(BM_L2capAcl, signalling_config_rsp)->Arg(1)->Arg(8);
+
+// Answers echo requests carrying range(0) bytes of data
+BENCHMARK_DEFINE_F(BM_L2capAcl, signalling_echo_req)(State& state) {
+  std::vector<uint8_t> packet = MakeAclPacket(
+      L2CAP_SIGNALLING_CID, L2CAP_CMD_OVERHEAD + state.range(0));
+  uint8_t* p = packet.data() + HCI_DATA_PREAMBLE_SIZE + L2CAP_PKT_OVERHEAD;
+  UINT8_TO_STREAM(p, L2CAP_CMD_ECHO_REQ);
+  uint8_t* p_id = p++;
+  UINT16_TO_STREAM(p, state.range(0));
+  uint8_t id = 0;
+  for (auto _ : state) {
+    // Repeated IDs are ignored, and so is 0
+    if (++id == 0) id = 1;
+    *p_id = id;
+    l2c_rcv_acl_data(MakeBuffer(packet));
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK_REGISTER_F(BM_L2capAcl, signalling_echo_req)->Arg(16)->Arg(256);
+
+int main(int argc, char** argv) {
+  // Disable LOG() output from libchrome
+  logging::LoggingSettings log_settings;
+  log_settings.logging_dest = logging::LoggingDestination::LOG_NONE;
+  CHECK(logging::InitLogging(log_settings)) << "Failed to set up logging";
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  ::benchmark::RunSpecifiedBenchmarks();
+}
@@ -0,0 +1,272 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <base/logging.h>
+#include <benchmark/benchmark.h>
+#include <string.h>
+#include <vector>
+
+#include "bt_trace.h"
+#include "btm_int.h"
+#include "device/include/controller.h"
+#include "hci/include/btsnoop.h"
+#include "hcimsgs.h"
+#include "l2c_int.h"
+#include "l2cdefs.h"
+#include "osi/include/allocator.h"
+#include "stack/include/bt_types.h"
+#include "stack/include/btm_api.h"
+
+using ::benchmark::State;
+
+// The L2CAP sources under test, including the link scheduler, are linked as
+// is. Everything they call in the neighbouring layers (BTM, HCI, controller)
+// is stubbed out below.
+
+uint8_t appl_trace_level = BT_TRACE_LEVEL_WARNING;
+void LogMsg(uint32_t trace_set_mask, const char* fmt_str, ...) {}
+
+tBTM_SEC_DEV_REC* btm_find_dev(const RawAddress& bd_addr) { return nullptr; }
+tBTM_INQ_INFO* BTM_InqDbRead(const RawAddress& p_bda) { return nullptr; }
+tBTM_STATUS BTM_SwitchRole(const RawAddress& remote_bd_addr, uint8_t new_role,
+                           tBTM_CMPL_CB* p_cb) {
+  return BTM_SUCCESS;
+}
+void BTM_ReadDevInfo(const RawAddress& remote_bda, tBT_DEVICE_TYPE* p_dev_type,
+                     tBLE_ADDR_TYPE* p_addr_type) {}
+void btm_acl_removed(const RawAddress& bda, tBT_TRANSPORT transport) {}
+tBTM_STATUS BTM_SetPowerMode(uint8_t pm_id, const RawAddress& remote_bda,
+                             const tBTM_PM_PWR_MD* p_mode) {
+  return BTM_SUCCESS;
+}
+uint16_t BTM_GetNumAclLinks(void) { return 1; }
+tBTM_STATUS btm_sec_disconnect(uint16_t handle, uint8_t reason) {
+  return BTM_SUCCESS;
+}
+void btm_remove_sco_links(const RawAddress& bda) {}
+uint8_t* BTM_ReadLocalFeatures(void) { return nullptr; }
+uint16_t btm_get_max_packet_size(const RawAddress& addr) { return 1021; }
+void btm_pm_policy_traffic(uint16_t hci_handle) {}
+void l2cble_tune_traffic(tL2C_LCB* p_lcb, uint16_t len, bool is_tx) {}
+tBTM_STATUS btm_sec_l2cap_access_req(const RawAddress& bd_addr, uint16_t psm,
+                                     uint16_t handle, CONNECTION_TYPE conn_type,
+                                     tBTM_SEC_CALLBACK* p_callback,
+                                     void* p_ref_data) {
+  return BTM_SUCCESS;
+}
+void BTM_VendorSpecificCommand(uint16_t opcode, uint8_t param_len,
+                               uint8_t* p_param_buf, tBTM_VSC_CMPL_CB* p_cb) {}
+void btm_acl_update_busy_level(tBTM_BLI_EVENT event) {}
+uint8_t btm_sec_clr_service_by_psm(uint16_t psm) { return 0; }
+bool btm_is_sco_active_by_bdaddr(const RawAddress& remote_bda) { return false; }
+bool btm_acl_notif_conn_collision(const RawAddress& bda) { return false; }
+void btm_sec_clr_temp_auth_service(const RawAddress& bda) {}
+void btm_sec_abort_access_req(const RawAddress& bd_addr) {}
+tBTM_CB btm_cb;
+void btm_acl_created(const RawAddress& bda, DEV_CLASS dc, BD_NAME bdn,
+                     uint16_t hci_handle, uint8_t link_role,
+                     tBT_TRANSPORT transport) {}
+void btm_sco_acl_removed(const RawAddress* bda) {}
+bool btm_dev_support_switch(const RawAddress& bd_addr) { return false; }
+void btm_ble_update_link_topology_mask(uint8_t role, bool increase) {}
+tBTM_STATUS BTM_ReadPowerMode(const RawAddress& remote_bda,
+                              tBTM_PM_MODE* p_mode) {
+  *p_mode = BTM_PM_MD_ACTIVE;
+  return BTM_SUCCESS;
+}
+tBTM_STATUS BTM_SetLinkSuperTout(const RawAddress& remote_bda,
+                                 uint16_t timeout) {
+  return BTM_SUCCESS;
+}
+
+// LE links without a quota of their own share the LE buffers in round-robin,
+// as l2c_ble_link_adjust_allocation does when there are more links than
+// buffers.
+void l2c_ble_link_adjust_allocation(void) {
+  l2cb.ble_round_robin_quota = l2cb.num_lm_ble_bufs;
+  for (int i = 0; i < MAX_L2CAP_LINKS; i++) {
+    tL2C_LCB* p_lcb = &l2cb.lcb_pool[i];
+    if (p_lcb->in_use && p_lcb->transport == BT_TRANSPORT_LE)
+      p_lcb->link_xmit_quota = 0;
+  }
+}
+
+void L2CA_FreeLePSM(uint16_t psm) {}
+bool l2cble_create_conn(tL2C_LCB* p_lcb) { return false; }
+tL2CAP_LE_RESULT_CODE l2ble_sec_access_req(const RawAddress& bd_addr,
+                                           uint16_t psm, bool is_originator,
+                                           tL2CAP_SEC_CBACK* p_callback,
+                                           void* p_ref_data) {
+  return L2CAP_LE_RESULT_CONN_OK;
+}
+void l2cble_process_sig_cmd(tL2C_LCB* p_lcb, uint8_t* p, uint16_t pkt_len) {}
+void l2cble_send_peer_disc_req(tL2C_CCB* p_ccb) {}
+void l2cble_notify_le_connection(const RawAddress& bda) {}
+void l2cble_credit_based_conn_req(tL2C_CCB* p_ccb) {}
+void l2cble_credit_based_conn_res(tL2C_CCB* p_ccb, uint16_t result) {}
+void l2cble_send_flow_control_credit(tL2C_CCB* p_ccb, uint16_t credit_value) {}
+
+void btsnd_hcic_disconnect(uint16_t handle, uint8_t reason) {}
+void btsnd_hcic_create_conn(const RawAddress& dest, uint16_t packet_types,
+                            uint8_t page_scan_rep_mode, uint8_t page_scan_mode,
+                            uint16_t clock_offset, uint8_t allow_switch) {}
+void btsnd_hcic_write_auto_flush_tout(uint16_t handle, uint16_t timeout) {}
+void btsnd_hcic_accept_conn(const RawAddress& bd_addr, uint8_t role) {}
+void btsnd_hcic_reject_conn(const RawAddress& bd_addr, uint8_t reason) {}
+
+namespace {
+
+void clear_l2cap_whitelist(uint16_t conn_handle, uint16_t local_cid,
+                           uint16_t remote_cid) {}
+
+btsnoop_t fake_btsnoop;
+
+}  // namespace
+
+const btsnoop_t* btsnoop_get_interface(void) {
+  fake_btsnoop.clear_l2cap_whitelist = clear_l2cap_whitelist;
+  return &fake_btsnoop;
+}
+
+namespace {
+
+constexpr uint16_t kFirstHandle = 0x0040;
+constexpr size_t kPacketSize = 256;
+constexpr size_t kQueuedPerLink = 2;
+
+uint16_t get_acl_data_size() { return 1021; }
+uint16_t get_acl_packet_size() { return 1021 + HCI_DATA_PREAMBLE_SIZE; }
+uint16_t get_ble_default_data_packet_length() { return 27; }
+
+controller_t fake_controller;
+
+int g_sent_count = 0;
+
+BT_HDR* MakeBuffer() {
+  BT_HDR* p_buf = static_cast<BT_HDR*>(osi_malloc(BT_HDR_SIZE + kPacketSize));
+  p_buf->len = kPacketSize;
+  p_buf->offset = 0;
+  p_buf->layer_specific = 0;
+  return p_buf;
+}
+
+}  // namespace
+
+// Needed for linkage
+const controller_t* controller_get_interface() { return &fake_controller; }
+
+void bte_main_hci_send(BT_HDR* p_msg, uint16_t event) {
+  g_sent_count++;
+  osi_free(p_msg);
+}
+
+// Connects |state.range(0)| BR/EDR, or LE if |state.range(2)| is set, ACL
+// links, all with data to send, to a controller that has |state.range(1)| ACL
+// buffers. BR/EDR links each get a quota of the buffers while LE links share
+// them in round-robin. Every iteration completes the outstanding packets of
+// all the links with a single Number Of Completed Packets event, as
+// controllers do under load.
+class BM_L2capNocp : public ::benchmark::Fixture {
+ protected:
+  void SetUp(State& st) override {
+    ::benchmark::Fixture::SetUp(st);
+    fake_controller.get_acl_data_size_classic = get_acl_data_size;
+    fake_controller.get_acl_packet_size_classic = get_acl_packet_size;
+    fake_controller.get_acl_data_size_ble = get_acl_data_size;
+    fake_controller.get_acl_packet_size_ble = get_acl_packet_size;
+    fake_controller.get_ble_default_data_packet_length =
+        get_ble_default_data_packet_length;
+    g_sent_count = 0;
+
+    l2c_init();
+    tBT_TRANSPORT transport =
+        st.range(2) ? BT_TRANSPORT_LE : BT_TRANSPORT_BR_EDR;
+    l2c_link_processs_num_bufs(st.range(1));
+    l2cb.num_lm_ble_bufs = l2cb.controller_le_xmit_window = st.range(1);
+    for (int i = 0; i < st.range(0); i++) {
+      RawAddress address(
+          {0x11, 0x22, 0x33, 0x44, 0x55, static_cast<uint8_t>(i)});
+      tL2C_LCB* p_lcb = l2cu_allocate_lcb(address, false, transport);
+      CHECK(p_lcb != nullptr);
+      l2cu_set_lcb_handle(p_lcb, kFirstHandle + i);
+      p_lcb->link_state = LST_CONNECTED;
+      links_.push_back(p_lcb);
+    }
+    TopUp();
+    for (tL2C_LCB* p_lcb : links_)
+      l2c_link_check_send_pkts(p_lcb, nullptr, nullptr);
+  }
+
+  void TearDown(State& st) override {
+    for (tL2C_LCB* p_lcb : links_) l2cu_release_lcb(p_lcb);
+    links_.clear();
+    l2c_free();
+    ::benchmark::Fixture::TearDown(st);
+  }
+
+  // Keeps |kQueuedPerLink| packets waiting on every link
+  void TopUp() {
+    for (tL2C_LCB* p_lcb : links_) {
+      while (list_length(p_lcb->link_xmit_data_q) < kQueuedPerLink)
+        list_append(p_lcb->link_xmit_data_q, MakeBuffer());
+    }
+  }
+
+  // Builds the event completing everything sent so far
+  uint8_t BuildNocp(uint8_t* event) {
+    uint8_t* p = event + 1;
+    uint8_t num_handles = 0;
+    for (tL2C_LCB* p_lcb : links_) {
+      if (p_lcb->sent_not_acked == 0) continue;
+      UINT16_TO_STREAM(p, p_lcb->handle);
+      UINT16_TO_STREAM(p, p_lcb->sent_not_acked);
+      num_handles++;
+    }
+    event[0] = num_handles;
+    return p - event;
+  }
+
+  std::vector<tL2C_LCB*> links_;
+};
+
+BENCHMARK_DEFINE_F(BM_L2capNocp, all_links_completed)(State& state) {
+  uint8_t event[1 + MAX_L2CAP_LINKS * 2 * sizeof(uint16_t)];
+  for (auto _ : state) {
+    TopUp();
+    uint8_t len = BuildNocp(event);
+    l2c_link_process_num_completed_pkts(event, len);
+  }
+  state.SetItemsProcessed(g_sent_count);
+}
+
+BENCHMARK_REGISTER_F(BM_L2capNocp, all_links_completed)
+    ->Args({7, 8, 0})
+    ->Args({7, 32, 0})
+    ->Args({MAX_L2CAP_LINKS, 32, 0})
+    ->Args({7, 4, 1})
+    ->Args({MAX_L2CAP_LINKS, 8, 1});
+
+int main(int argc, char** argv) {
+  // Disable LOG() output from libchrome
+  logging::LoggingSettings log_settings;
+  log_settings.logging_dest = logging::LoggingDestination::LOG_NONE;
+  CHECK(logging::InitLogging(log_settings)) << "Failed to set up logging";
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  ::benchmark::RunSpecifiedBenchmarks();
+}
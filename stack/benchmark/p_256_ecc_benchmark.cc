@@ -0,0 +1,113 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <base/logging.h>
+#include <benchmark/benchmark.h>
+#include <string.h>
+
+#include "stack/smp/p_256_ecc_pp.h"
+
+using ::benchmark::State;
+
+namespace {
+
+// Debug private key of the Core specification, Vol 3, Part H, 2.3.5.6.1
+const uint32_t kPrivateKey[KEY_LENGTH_DWORDS_P256] = {
+    0xcd3c1abd, 0x5899b8a6, 0xeb40b799, 0x4aff607b,
+    0xd2103f50, 0x74c9b3e3, 0xa3c55f38, 0x3f49f6d4};
+
+class BM_P256Ecc : public ::benchmark::Fixture {
+ protected:
+  void SetUp(State& st) override {
+    ::benchmark::Fixture::SetUp(st);
+    p_256_init_curve();
+    // A peer public key that isn't the base point
+    ECC_PointMult_Base(&peer_, kPrivateKey);
+    CHECK(ECC_ValidatePoint(peer_));
+  }
+
+  Point peer_;
+};
+
+}  // namespace
+
+// Public key generation with the legacy variable time multiplication
+BENCHMARK_DEFINE_F(BM_P256Ecc, base_mult_naf)(State& state) {
+  Point q;
+  for (auto _ : state) {
+    Point g = curve_p256.G;
+    uint32_t n[KEY_LENGTH_DWORDS_P256];
+    memcpy(n, kPrivateKey, sizeof(n));
+    ECC_PointMult_Bin_NAF(&q, &g, n);
+    ::benchmark::DoNotOptimize(q);
+  }
+}
+
+BENCHMARK_REGISTER_F(BM_P256Ecc, base_mult_naf);
+
+BENCHMARK_DEFINE_F(BM_P256Ecc, base_mult_comb)(State& state) {
+  Point q;
+  for (auto _ : state) {
+    ECC_PointMult_Base(&q, kPrivateKey);
+    ::benchmark::DoNotOptimize(q);
+  }
+}
+
+BENCHMARK_REGISTER_F(BM_P256Ecc, base_mult_comb);
+
+// DHKey computation
+BENCHMARK_DEFINE_F(BM_P256Ecc, dhkey_naf)(State& state) {
+  Point q;
+  for (auto _ : state) {
+    Point p = peer_;
+    uint32_t n[KEY_LENGTH_DWORDS_P256];
+    memcpy(n, kPrivateKey, sizeof(n));
+    ECC_PointMult_Bin_NAF(&q, &p, n);
+    ::benchmark::DoNotOptimize(q);
+  }
+}
+
+BENCHMARK_REGISTER_F(BM_P256Ecc, dhkey_naf);
+
+BENCHMARK_DEFINE_F(BM_P256Ecc, dhkey_window)(State& state) {
+  Point q;
+  for (auto _ : state) {
+    ECC_PointMult_CT(&q, &peer_, kPrivateKey);
+    ::benchmark::DoNotOptimize(q);
+  }
+}
+
+BENCHMARK_REGISTER_F(BM_P256Ecc, dhkey_window);
+
+BENCHMARK_DEFINE_F(BM_P256Ecc, validate_point)(State& state) {
+  for (auto _ : state) {
+    ::benchmark::DoNotOptimize(ECC_ValidatePoint(peer_));
+  }
+}
+
+BENCHMARK_REGISTER_F(BM_P256Ecc, validate_point);
+
+int main(int argc, char** argv) {
+  // Disable LOG() output from libchrome
+  logging::LoggingSettings log_settings;
+  log_settings.logging_dest = logging::LoggingDestination::LOG_NONE;
+  CHECK(logging::InitLogging(log_settings)) << "Failed to set up logging";
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  ::benchmark::RunSpecifiedBenchmarks();
+}
@@ -0,0 +1,192 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <base/logging.h>
+#include <benchmark/benchmark.h>
+#include <string.h>
+#include <vector>
+
+#include "bt_trace.h"
+#include "btm_int.h"
+#include "hci/include/btsnoop.h"
+#include "l2c_api.h"
+#include "osi/include/allocator.h"
+#include "port_api.h"
+#include "port_int.h"
+#include "rfc_int.h"
+#include "stack_rfcomm_test_utils.h"
+#include "stack_test_packet_utils.h"
+
+using ::benchmark::State;
+
+// The RFCOMM sources under test are linked as is. L2CAP and BTM are stubbed
+// out below; outgoing frames are dropped once they reach L2CA_DataWrite().
+
+uint8_t appl_trace_level = BT_TRACE_LEVEL_WARNING;
+void LogMsg(uint32_t trace_set_mask, const char* fmt_str, ...) {}
+
+namespace {
+
+tL2CAP_APPL_INFO l2cap_appl_info;
+uint64_t g_bytes_written = 0;
+
+void whitelist_rfc_dlci(uint16_t local_cid, uint8_t dlci) {}
+
+btsnoop_t fake_btsnoop;
+
+}  // namespace
+
+uint16_t L2CA_Register(uint16_t psm, tL2CAP_APPL_INFO* p_cb_info,
+                       bool enable_snoop, tL2CAP_ERTM_INFO* p_ertm_info) {
+  l2cap_appl_info = *p_cb_info;
+  return psm;
+}
+uint16_t L2CA_ConnectReq(uint16_t psm, const RawAddress& bd_addr) { return 0; }
+bool L2CA_ConnectRsp(const RawAddress& bd_addr, uint8_t id, uint16_t lcid,
+                     uint16_t result, uint16_t status) {
+  return true;
+}
+bool L2CA_DisconnectReq(uint16_t cid) { return true; }
+bool L2CA_DisconnectRsp(uint16_t cid) { return true; }
+bool L2CA_ConfigReq(uint16_t cid, tL2CAP_CFG_INFO* p_cfg) { return true; }
+bool L2CA_ConfigRsp(uint16_t cid, tL2CAP_CFG_INFO* p_cfg) { return true; }
+uint8_t L2CA_DataWrite(uint16_t cid, BT_HDR* p_data) {
+  g_bytes_written += p_data->len;
+  osi_free(p_data);
+  return L2CAP_DW_SUCCESS;
+}
+
+void btm_sec_abort_access_req(const RawAddress& bd_addr) {}
+tBTM_STATUS btm_sec_mx_access_request(const RawAddress& bd_addr, uint16_t psm,
+                                      bool is_originator, uint32_t mx_proto_id,
+                                      uint32_t mx_chan_id,
+                                      tBTM_SEC_CALLBACK* p_callback,
+                                      void* p_ref_data) {
+  return BTM_SUCCESS;
+}
+uint16_t btm_get_max_packet_size(const RawAddress& addr) {
+  return RFCOMM_DEFAULT_MTU;
+}
+
+const btsnoop_t* btsnoop_get_interface(void) {
+  fake_btsnoop.whitelist_rfc_dlci = whitelist_rfc_dlci;
+  return &fake_btsnoop;
+}
+
+namespace {
+
+constexpr uint16_t kLcid = 0x0041;
+constexpr uint16_t kAclHandle = 0x0042;
+constexpr uint8_t kScn = 3;
+const RawAddress kRemoteAddress({0x11, 0x22, 0x33, 0x44, 0x55, 0x66});
+
+}  // namespace
+
+// Puts a multiplexer and one data link connection straight into the opened
+// state, as they would be after the SABM/UA, PN and MSC exchanges. TS 07.10
+// flow control is used so that no credits need to be replenished.
+class BM_RfcommPort : public ::benchmark::Fixture {
+ protected:
+  void SetUp(State& st) override {
+    ::benchmark::Fixture::SetUp(st);
+    g_bytes_written = 0;
+    RFCOMM_Init();
+
+    tRFC_MCB* p_mcb = rfc_alloc_multiplexer_channel(kRemoteAddress, true);
+    CHECK(p_mcb != nullptr);
+    p_mcb->state = RFC_MX_STATE_CONNECTED;
+    p_mcb->lcid = kLcid;
+    p_mcb->peer_l2cap_mtu = L2CAP_MTU_SIZE;
+    p_mcb->peer_ready = true;
+    p_mcb->flow = PORT_FC_TS710;
+    rfc_save_lcid_mcb(p_mcb, kLcid);
+
+    dlci_ = bluetooth::rfcomm::GetDlci(true, kScn);
+    p_port_ = port_allocate_port(dlci_, kRemoteAddress);
+    CHECK(p_port_ != nullptr);
+    p_port_->rfc.p_mcb = p_mcb;
+    p_mcb->port_handles[dlci_] = p_port_->handle;
+    port_select_mtu(p_port_);
+    p_port_->peer_mtu = p_port_->mtu;
+    p_port_->state = PORT_STATE_OPENED;
+    p_port_->rfc.state = RFC_STATE_OPENED;
+    p_port_->port_ctrl = PORT_CTRL_REQ_SENT | PORT_CTRL_IND_RECEIVED;
+  }
+
+  void TearDown(State& st) override {
+    p_port_->rfc.state = RFC_STATE_CLOSED;
+    port_release_port(p_port_);
+    ::benchmark::Fixture::TearDown(st);
+  }
+
+  tPORT* p_port_ = nullptr;
+  uint8_t dlci_ = 0;
+};
+
+BENCHMARK_DEFINE_F(BM_RfcommPort, write_data)(State& state) {
+  std::vector<char> data(state.range(0), 'x');
+  for (auto _ : state) {
+    uint16_t written = 0;
+    PORT_WriteData(p_port_->handle, data.data(), data.size(), &written);
+    CHECK_EQ(written, data.size());
+  }
+  CHECK(fixed_queue_is_empty(p_port_->tx.queue));
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+  state.counters["frame_bytes"] = ::benchmark::Counter(
+      g_bytes_written, ::benchmark::Counter::kAvgIterations);
+}
+
+BENCHMARK_REGISTER_F(BM_RfcommPort, write_data)
+    ->Arg(16)
+    ->Arg(RFCOMM_DEFAULT_MTU)
+    ->Arg(990)
+    ->Arg(4096);
+
+// Each iteration delivers one UIH frame from the peer through the L2CAP data
+// indication callback and reads it back with PORT_ReadData(). Payloads stay
+// within RFCOMM_DEFAULT_MTU, the largest length CreateQuickDataPacket()
+// encodes correctly.
+BENCHMARK_DEFINE_F(BM_RfcommPort, read_data)(State& state) {
+  std::vector<uint8_t> payload(state.range(0), 'x');
+  std::vector<uint8_t> acl_packet = bluetooth::rfcomm::CreateQuickDataPacket(
+      dlci_, false, kLcid, kAclHandle, 0, payload);
+  std::vector<char> buffer(state.range(0));
+  for (auto _ : state) {
+    l2cap_appl_info.pL2CA_DataInd_Cb(
+        kLcid, bluetooth::AllocateWrappedIncomingL2capAclPacket(acl_packet));
+    uint16_t read = 0;
+    PORT_ReadData(p_port_->handle, buffer.data(), buffer.size(), &read);
+    CHECK_EQ(read, buffer.size());
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK_REGISTER_F(BM_RfcommPort, read_data)
+    ->Arg(16)
+    ->Arg(64)
+    ->Arg(RFCOMM_DEFAULT_MTU);
+
+int main(int argc, char** argv) {
+  // Disable LOG() output from libchrome
+  logging::LoggingSettings log_settings;
+  log_settings.logging_dest = logging::LoggingDestination::LOG_NONE;
+  CHECK(logging::InitLogging(log_settings)) << "Failed to set up logging";
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  ::benchmark::RunSpecifiedBenchmarks();
+}
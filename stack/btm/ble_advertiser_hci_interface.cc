@@ -650,6 +650,8 @@ class BleAdvertiserHciExtendedImpl : public BleAdvertiserHciInterface {
                command_complete);
   }
 
+  bool SupportsMultipleSetEnable() override { return true; }
+
   void SetPeriodicAdvertisingParameters(uint8_t handle,
                                         uint16_t periodic_adv_int_min,
                                         uint16_t periodic_adv_int_max,
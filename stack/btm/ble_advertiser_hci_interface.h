@@ -107,6 +107,9 @@ class BleAdvertiserHciInterface {
 
   // Some implementation don't behave well when handle value 0 is used.
   virtual bool QuirkAdvertiserZeroHandle() { return 0; }
+
+  // Whether Enable() takes more than one set per call.
+  virtual bool SupportsMultipleSetEnable() { return false; }
 };
 
 #endif  // BLE_ADVERTISER_HCI_INTERFACE_H
@@ -94,13 +94,10 @@ void btm_acl_init(void) {
  *
  ******************************************************************************/
 tACL_CONN* btm_bda_to_acl(const RawAddress& bda, tBT_TRANSPORT transport) {
-  tACL_CONN* p = &btm_cb.acl_db[0];
-  uint16_t xx;
-  for (xx = 0; xx < MAX_L2CAP_LINKS; xx++, p++) {
-    if ((p->in_use) && p->remote_addr == bda && p->transport == transport) {
-      BTM_TRACE_DEBUG("btm_bda_to_acl found");
-      return (p);
-    }
+  uint8_t xx = btm_acl_db_index_find_bda(bda, transport);
+  if (xx < MAX_L2CAP_LINKS) {
+    BTM_TRACE_DEBUG("btm_bda_to_acl found");
+    return &btm_cb.acl_db[xx];
   }
 
   /* If here, no BD Addr found */
@@ -118,17 +115,8 @@ tACL_CONN* btm_bda_to_acl(const RawAddress& bda, tBT_TRANSPORT transport) {
  *
  ******************************************************************************/
 uint8_t btm_handle_to_acl_index(uint16_t hci_handle) {
-  tACL_CONN* p = &btm_cb.acl_db[0];
-  uint8_t xx;
   BTM_TRACE_DEBUG("btm_handle_to_acl_index");
-  for (xx = 0; xx < MAX_L2CAP_LINKS; xx++, p++) {
-    if ((p->in_use) && (p->hci_handle == hci_handle)) {
-      break;
-    }
-  }
-
-  /* If here, no BD Addr found */
-  return (xx);
+  return btm_acl_db_index_find_handle(hci_handle);
 }
 
 #if (BLE_PRIVACY_SPT == TRUE)
@@ -204,6 +192,7 @@ void btm_acl_created(const RawAddress& bda, DEV_CLASS dc, BD_NAME bdn,
     p->hci_handle = hci_handle;
     p->link_role = link_role;
     p->transport = transport;
+    btm_acl_db_index_update(p - btm_cb.acl_db);
     VLOG(1) << "Duplicate btm_acl_created: RemBdAddr: " << bda;
     BTM_SetLinkPolicy(p->remote_addr, &btm_cb.btm_def_link_policy);
     return;
@@ -219,6 +208,7 @@ void btm_acl_created(const RawAddress& bda, DEV_CLASS dc, BD_NAME bdn,
       p->remote_addr = bda;
 
       p->transport = transport;
+      btm_acl_db_index_update(xx);
 #if (BLE_PRIVACY_SPT == TRUE)
       if (transport == BT_TRANSPORT_LE)
         btm_ble_refresh_local_resolvable_private_addr(
@@ -345,6 +335,7 @@ void btm_acl_removed(const RawAddress& bda, tBT_TRANSPORT transport) {
   p = btm_bda_to_acl(bda, transport);
   if (p != (tACL_CONN*)NULL) {
     p->in_use = false;
+    btm_acl_db_index_remove(p - btm_cb.acl_db);
 
     /* if the disconnected channel has a pending role switch, clear it now */
     btm_acl_report_role_change(HCI_ERR_NO_CONNECTION, &bda);
@@ -1345,15 +1336,7 @@ bool BTM_IsAclConnectionUp(const RawAddress& remote_bda,
  * Returns          uint16_t Number of active ACL links
  *
  ******************************************************************************/
-uint16_t BTM_GetNumAclLinks(void) {
-  uint16_t num_acl = 0;
-
-  for (uint16_t i = 0; i < MAX_L2CAP_LINKS; ++i) {
-    if (btm_cb.acl_db[i].in_use) ++num_acl;
-  }
-
-  return num_acl;
-}
+uint16_t BTM_GetNumAclLinks(void) { return btm_acl_db_index_count(); }
 
 /*******************************************************************************
  *
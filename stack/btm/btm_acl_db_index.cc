@@ -0,0 +1,158 @@
+/******************************************************************************
+ *
+ *  Copyright 2020 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This file contains the index of the ACL database: the lookup keys of the
+ *  acl_db entries in use, stored as arrays next to each other and hashed by
+ *  handle and by address, so that looking an entry up does not walk the
+ *  entries themselves.
+ *
+ ******************************************************************************/
+
+#include <string.h>
+
+#include "bt_target.h"
+#include "btm_int.h"
+
+static_assert(MAX_L2CAP_LINKS <= 32,
+              "tBTM_ACL_DB_INDEX buckets have a bit per ACL link");
+
+/* Remote address in the low 48 bits and transport above, so that both are
+ * compared at once */
+static uint64_t btm_acl_db_index_bda_key(const RawAddress& bda,
+                                         tBT_TRANSPORT transport) {
+  uint32_t low;
+  uint16_t high;
+  memcpy(&low, bda.address, sizeof(low));
+  memcpy(&high, bda.address + sizeof(low), sizeof(high));
+  return low | ((uint64_t)high << 32) | ((uint64_t)transport << 48);
+}
+
+/* Fibonacci hashing of |key| to one of the buckets */
+static uint8_t btm_acl_db_index_hash(uint32_t key) {
+  return (uint8_t)((key * 2654435761u) >> (32 - BTM_ACL_DB_INDEX_BUCKET_BITS));
+}
+
+static uint8_t btm_acl_db_index_bda_hash(uint64_t bda_key) {
+  return btm_acl_db_index_hash((uint32_t)bda_key ^ (uint32_t)(bda_key >> 32));
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_acl_db_index_update
+ *
+ * Description      Adds the acl_db entry |acl_idx|, now in use, to the index,
+ *                  or moves it to the buckets of its current keys.
+ *
+ ******************************************************************************/
+void btm_acl_db_index_update(uint8_t acl_idx) {
+  tBTM_ACL_DB_INDEX* p_index = &btm_cb.acl_db_index;
+  const tACL_CONN* p = &btm_cb.acl_db[acl_idx];
+  uint32_t bit = 1u << acl_idx;
+
+  btm_acl_db_index_remove(acl_idx);
+
+  p_index->hci_handle[acl_idx] = p->hci_handle;
+  p_index->bda_key[acl_idx] =
+      btm_acl_db_index_bda_key(p->remote_addr, p->transport);
+  p_index->handle_hash[acl_idx] = btm_acl_db_index_hash(p->hci_handle);
+  p_index->bda_hash[acl_idx] =
+      btm_acl_db_index_bda_hash(p_index->bda_key[acl_idx]);
+
+  p_index->handle_bucket[p_index->handle_hash[acl_idx]] |= bit;
+  p_index->bda_bucket[p_index->bda_hash[acl_idx]] |= bit;
+  p_index->in_use_mask |= bit;
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_acl_db_index_remove
+ *
+ * Description      Removes the acl_db entry |acl_idx|, no longer in use, from
+ *                  the index.
+ *
+ ******************************************************************************/
+void btm_acl_db_index_remove(uint8_t acl_idx) {
+  tBTM_ACL_DB_INDEX* p_index = &btm_cb.acl_db_index;
+  uint32_t bit = 1u << acl_idx;
+
+  if (!(p_index->in_use_mask & bit)) return;
+
+  p_index->handle_bucket[p_index->handle_hash[acl_idx]] &= ~bit;
+  p_index->bda_bucket[p_index->bda_hash[acl_idx]] &= ~bit;
+  p_index->in_use_mask &= ~bit;
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_acl_db_index_find_handle
+ *
+ * Description      Looks up the FIRST acl_db entry in use for |hci_handle|.
+ *
+ * Returns          index to the acl_db or MAX_L2CAP_LINKS.
+ *
+ ******************************************************************************/
+uint8_t btm_acl_db_index_find_handle(uint16_t hci_handle) {
+  const tBTM_ACL_DB_INDEX* p_index = &btm_cb.acl_db_index;
+  uint32_t candidates =
+      p_index->handle_bucket[btm_acl_db_index_hash(hci_handle)];
+
+  /* Lowest index first, as the entries were walked in order before */
+  while (candidates) {
+    uint8_t xx = __builtin_ctz(candidates);
+    if (p_index->hci_handle[xx] == hci_handle) return xx;
+    candidates &= candidates - 1;
+  }
+  return MAX_L2CAP_LINKS;
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_acl_db_index_find_bda
+ *
+ * Description      Looks up the FIRST acl_db entry in use for |bda| on
+ *                  |transport|.
+ *
+ * Returns          index to the acl_db or MAX_L2CAP_LINKS.
+ *
+ ******************************************************************************/
+uint8_t btm_acl_db_index_find_bda(const RawAddress& bda,
+                                  tBT_TRANSPORT transport) {
+  const tBTM_ACL_DB_INDEX* p_index = &btm_cb.acl_db_index;
+  uint64_t key = btm_acl_db_index_bda_key(bda, transport);
+  uint32_t candidates = p_index->bda_bucket[btm_acl_db_index_bda_hash(key)];
+
+  while (candidates) {
+    uint8_t xx = __builtin_ctz(candidates);
+    if (p_index->bda_key[xx] == key) return xx;
+    candidates &= candidates - 1;
+  }
+  return MAX_L2CAP_LINKS;
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_acl_db_index_count
+ *
+ * Returns          the number of acl_db entries in use.
+ *
+ ******************************************************************************/
+uint8_t btm_acl_db_index_count(void) {
+  return __builtin_popcount(btm_cb.acl_db_index.in_use_mask);
+}
@@ -1389,6 +1389,7 @@ void btm_sec_save_le_key(const RawAddress& bd_addr, tBTM_LE_KEY_TYPE key_type,
         p_rec->ble.identity_addr = p_keys->pid_key.identity_addr;
         p_rec->ble.identity_addr_type = p_keys->pid_key.identity_addr_type;
         p_rec->ble.key_type |= BTM_LE_KEY_PID;
+        btm_dev_invalidate_rpa_cache();
         BTM_TRACE_DEBUG(
             "%s: BTM_LE_KEY_PID key_type=0x%x save peer IRK, change bd_addr=%s "
             "to id_addr=%s id_addr_type=0x%x",
@@ -2540,3 +2541,18 @@ void btm_ble_set_keep_rfu_in_auth_req(bool keep_rfu) {
 }
 
 #endif /* BTM_BLE_CONFORMANCE_TESTING */
+
+/*******************************************************************************
+ *
+ * Function         stack_debug_btm_ble_dump
+ *
+ * Description      Dump the statistics of the syncs of the LE controller lists
+ *                  to |fd|.
+ *
+ ******************************************************************************/
+void stack_debug_btm_ble_dump(int fd) {
+  dprintf(fd, "\nBTM LE:\n");
+#if (BLE_PRIVACY_SPT == TRUE)
+  btm_ble_resolving_list_dump(fd);
+#endif
+}
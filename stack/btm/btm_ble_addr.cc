@@ -35,6 +35,10 @@
 #include "btm_ble_int.h"
 #include "stack/crypto_toolbox/crypto_toolbox.h"
 
+/* How late the private address refresh may fire, to share a wakeup with
+ * another alarm */
+#define BTM_BLE_RPA_REFRESH_SLACK_MS (30 * 1000)
+
 /* This function generates Resolvable Private Address (RPA) from Identity
  * Resolving Key |irk| and |random|*/
 RawAddress generate_rpa_from_irk_and_rand(const Octet16& irk,
@@ -76,8 +80,10 @@ void btm_gen_resolve_paddr_low(const RawAddress& address) {
 #if (BTM_BLE_CONFORMANCE_TESTING == TRUE)
   interval_ms = btm_cb.ble_ctr_cb.rpa_tout * 1000;
 #endif
-  alarm_set_on_mloop(p_cb->refresh_raddr_timer, interval_ms,
-                     btm_ble_refresh_raddr_timer_timeout, NULL);
+  /* The rotation interval is randomized anyway, a late refresh is harmless */
+  alarm_set_on_mloop_with_slack(p_cb->refresh_raddr_timer, interval_ms,
+                                BTM_BLE_RPA_REFRESH_SLACK_MS,
+                                btm_ble_refresh_raddr_timer_timeout, NULL);
 }
 
 /** This function generate a resolvable private address using local IRK */
@@ -219,46 +225,65 @@ bool btm_ble_addr_resolvable(const RawAddress& rpa,
   return false;
 }
 
-/** This function match the random address to the appointed device record,
- * starting from calculating IRK. If the record index exceeds the maximum record
- * number, matching failed and send a callback. */
-static bool btm_ble_match_random_bda(void* data, void* context) {
-  BTM_TRACE_EVENT("%s next iteration", __func__);
-  RawAddress* random_bda = (RawAddress*)context;
-
-  tBTM_SEC_DEV_REC* p_dev_rec = static_cast<tBTM_SEC_DEV_REC*>(data);
-
-  BTM_TRACE_DEBUG("sec_flags = %02x device_type = %d", p_dev_rec->sec_flags,
-                  p_dev_rec->device_type);
-
-  if (!(p_dev_rec->device_type & BT_DEVICE_TYPE_BLE) ||
-      !(p_dev_rec->ble.key_type & BTM_LE_KEY_PID))
-    return true;
-
-  if (rpa_matches_irk(*random_bda, p_dev_rec->ble.keys.irk)) {
-    BTM_TRACE_EVENT("match is found");
-    // if it was match, finish iteration, otherwise continue
-    return false;
+/* Number of IRKs tried against a random address with one aes_128_multi() */
+#define BTM_BLE_RESOLVE_BATCH 8
+
+/* Return the first of the |n| records in |batch| whose IRK generates |hash|
+ * from |prand|, or nullptr */
+static tBTM_SEC_DEV_REC* btm_ble_resolve_batch(tBTM_SEC_DEV_REC** batch,
+                                               size_t n, const Octet16& prand,
+                                               const uint8_t* hash) {
+  Octet16 irks[BTM_BLE_RESOLVE_BATCH];
+  Octet16 x[BTM_BLE_RESOLVE_BATCH];
+  for (size_t i = 0; i < n; i++) {
+    irks[i] = batch[i]->ble.keys.irk;
+    x[i] = prand;
   }
 
-  // not a match, continue iteration
-  return true;
+  crypto_toolbox::aes_128_multi(irks, x, x, n);
+  for (size_t i = 0; i < n; i++) {
+    if (memcmp(x[i].data(), hash, 3) == 0) return batch[i];
+  }
+  return nullptr;
 }
 
-/** This function is called to resolve a random address.
+/** This function is called to resolve a random address against the IRKs of
+ * all bonded devices in a single pass. The prand/hash split of |random_bda| is
+ * done once up front, and the candidate IRKs are tried in batches so that
+ * their AES-128 operations overlap.
  * Returns pointer to the security record of the device whom a random address is
  * matched to.
  */
 tBTM_SEC_DEV_REC* btm_ble_resolve_random_addr(const RawAddress& random_bda) {
   BTM_TRACE_EVENT("%s", __func__);
 
-  /* start to resolve random address */
-  /* check for next security record */
+  /* use the 3 MSB of bd address as prand, the 3 LSB as the hash to match */
+  Octet16 prand{random_bda.address[2], random_bda.address[1],
+                random_bda.address[0]};
+  uint8_t hash[3] = {random_bda.address[5], random_bda.address[4],
+                     random_bda.address[3]};
+
+  tBTM_SEC_DEV_REC* batch[BTM_BLE_RESOLVE_BATCH];
+  size_t n = 0;
 
-  list_node_t* n = list_foreach(btm_cb.sec_dev_rec, btm_ble_match_random_bda,
-                                (void*)&random_bda);
   tBTM_SEC_DEV_REC* p_dev_rec = nullptr;
-  if (n != nullptr) p_dev_rec = static_cast<tBTM_SEC_DEV_REC*>(list_node(n));
+  list_node_t* end = list_end(btm_cb.sec_dev_rec);
+  for (list_node_t* node = list_begin(btm_cb.sec_dev_rec);
+       node != end && p_dev_rec == nullptr; node = list_next(node)) {
+    tBTM_SEC_DEV_REC* p_rec = static_cast<tBTM_SEC_DEV_REC*>(list_node(node));
+
+    if (!(p_rec->device_type & BT_DEVICE_TYPE_BLE) ||
+        !(p_rec->ble.key_type & BTM_LE_KEY_PID))
+      continue;
+
+    batch[n++] = p_rec;
+    if (n == BTM_BLE_RESOLVE_BATCH) {
+      p_dev_rec = btm_ble_resolve_batch(batch, n, prand, hash);
+      n = 0;
+    }
+  }
+  if (p_dev_rec == nullptr && n > 0)
+    p_dev_rec = btm_ble_resolve_batch(batch, n, prand, hash);
 
   BTM_TRACE_EVENT("%s:  %sresolved", __func__,
                   (p_dev_rec == nullptr ? "not " : ""));
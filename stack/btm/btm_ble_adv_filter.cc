@@ -82,6 +82,11 @@ bool is_filtering_supported() {
   return cmn_ble_vsc_cb.filter_support != 0 && cmn_ble_vsc_cb.max_filter != 0;
 }
 
+/* The filters run on the host when the controller can't run them */
+static bool is_host_filtering() {
+  return !is_filtering_supported() && btm_ble_host_filter_is_on();
+}
+
 /*******************************************************************************
  *
  * Function         btm_ble_condtype_to_ocf
@@ -599,6 +604,15 @@ void BTM_LE_PF_uuid_filter(tBTM_BLE_SCAN_COND_OP action,
 void BTM_LE_PF_set(tBTM_BLE_PF_FILT_INDEX filt_index,
                    std::vector<ApcfCommand> commands,
                    tBTM_BLE_PF_CFG_CBACK cb) {
+  if (is_host_filtering()) {
+    if (!btm_ble_host_filter_add(filt_index, commands)) {
+      cb.Run(0, BTM_BLE_PF_ENABLE, 1 /* BTA_FAILURE */);
+      return;
+    }
+    cb.Run(0, 0, 0);
+    return;
+  }
+
   if (!is_filtering_supported()) {
     cb.Run(0, BTM_BLE_PF_ENABLE, 1 /* BTA_FAILURE */);
     return;
@@ -667,6 +681,12 @@ void BTM_LE_PF_set(tBTM_BLE_PF_FILT_INDEX filt_index,
  */
 void BTM_LE_PF_clear(tBTM_BLE_PF_FILT_INDEX filt_index,
                      tBTM_BLE_PF_CFG_CBACK cb) {
+  if (is_host_filtering()) {
+    btm_ble_host_filter_clear(filt_index);
+    cb.Run(0, BTM_BLE_SCAN_COND_CLEAR, 0);
+    return;
+  }
+
   if (!is_filtering_supported()) {
     cb.Run(0, BTM_BLE_PF_ENABLE, 1 /* BTA_FAILURE */);
     return;
@@ -744,6 +764,13 @@ void BTM_BleAdvFilterParamSetup(
                 BTM_BLE_ADV_FILT_FEAT_SELN_LEN + BTM_BLE_ADV_FILT_TRACK_NUM;
   uint8_t param[len], *p;
 
+  if (is_host_filtering()) {
+    uint8_t num_avail = btm_ble_host_filter_set_params(action, filt_index,
+                                                       p_filt_params.get());
+    cb.Run(num_avail, action, 0);
+    return;
+  }
+
   if (!is_filtering_supported()) {
     cb.Run(0, BTM_BLE_PF_ENABLE, 1 /* BTA_FAILURE */);
     return;
@@ -862,6 +889,12 @@ void enable_cmpl_cback(tBTM_BLE_PF_STATUS_CBACK p_stat_cback, uint8_t* p,
  ******************************************************************************/
 void BTM_BleEnableDisableFilterFeature(uint8_t enable,
                                        tBTM_BLE_PF_STATUS_CBACK p_stat_cback) {
+  if (is_host_filtering()) {
+    btm_ble_host_filter_enable(enable);
+    if (p_stat_cback) p_stat_cback.Run(enable, BTM_SUCCESS);
+    return;
+  }
+
   if (!is_filtering_supported()) {
     if (p_stat_cback) p_stat_cback.Run(BTM_BLE_PF_ENABLE, 1 /* BTA_FAILURE */);
     return;
@@ -19,9 +19,11 @@
 #include <stddef.h>
 #include <stdio.h>
 #include <string.h>
+#include <memory>
 #include <vector>
 #include "bt_target.h"
 
+#include "batch_scan_record_parser.h"
 #include "bt_types.h"
 #include "bt_utils.h"
 #include "btm_ble_api.h"
@@ -44,6 +46,12 @@ tBTM_BLE_ADV_TRACK_CB ble_advtrack_cb;
 #define BTM_BLE_BATCH_SCAN_ENB_DISB_LEN 2
 #define BTM_BLE_BATCH_SCAN_READ_RESULTS_LEN 2
 
+/* Records handed to the callback at once while the controller storage is
+ * read, at most 255 */
+#ifndef BTM_BLE_BATCH_SCAN_CHUNK_RECORDS
+#define BTM_BLE_BATCH_SCAN_CHUNK_RECORDS 100
+#endif
+
 namespace {
 
 bool can_do_batch_scan() {
@@ -245,10 +253,32 @@ void btm_ble_read_batchscan_reports(tBTM_BLE_BATCH_SCAN_MODE scan_mode,
   btu_hcif_send_cmd_with_cb(FROM_HERE, HCI_BLE_BATCH_SCAN, param, len, cb);
 }
 
-/* read reports. data is accumulated in |data_all|, number of records is
- * accumulated in |num_records_all| */
-void read_reports_cb(std::vector<uint8_t> data_all, uint8_t num_records_all,
-                     tBTM_BLE_SCAN_REP_CBACK cb, uint8_t* p, uint16_t len) {
+/* The records read so far and not yet handed to |cb| */
+struct BatchScanReportReader {
+  explicit BatchScanReportReader(tBTM_BLE_SCAN_REP_CBACK cb)
+      : cb(std::move(cb)) {}
+
+  tBTM_BLE_SCAN_REP_CBACK cb;
+  std::vector<uint8_t> data;
+  uint8_t num_records = 0;
+  bool delivered = false;
+  /* Room for a chunk, sized from the first records read */
+  size_t chunk_capacity = 0;
+
+  void Deliver(uint8_t status, uint8_t report_format) {
+    cb.Run(status, report_format, num_records, std::move(data));
+    delivered = true;
+    num_records = 0;
+    data = std::vector<uint8_t>();
+    data.reserve(chunk_capacity);
+  }
+};
+
+/* read reports. The records are handed to the callback of |reader| in chunks
+ * of BTM_BLE_BATCH_SCAN_CHUNK_RECORDS while the controller storage is read,
+ * the last of them once it is empty */
+void read_reports_cb(std::shared_ptr<BatchScanReportReader> reader, uint8_t* p,
+                     uint16_t len) {
   if (len < 2) {
     BTM_TRACE_ERROR("%s: wrong length", __func__);
     return;
@@ -273,18 +303,42 @@ void read_reports_cb(std::vector<uint8_t> data_all, uint8_t num_records_all,
                   num_records);
 
   if (num_records == 0) {
-    cb.Run(status, report_format, num_records_all, data_all);
+    /* Report an empty storage as well */
+    if (reader->num_records > 0 || !reader->delivered) {
+      reader->Deliver(status, report_format);
+    }
     return;
   }
 
   if (len > 4) {
-    data_all.insert(data_all.end(), p, p + len - 4);
-    num_records_all += num_records;
+    /* Keep the whole records only, the count can't be trusted further */
+    size_t records_len = 0;
+    uint8_t records = 0;
+    for (const auto& record :
+         BatchScanRecordParser::Records(report_format, p, len - 4)) {
+      records_len += record.length;
+      records++;
+    }
+    if (records != num_records) {
+      BTM_TRACE_WARNING("%s: %d records announced, %d found", __func__,
+                        num_records, records);
+    }
+
+    if (reader->chunk_capacity == 0 && records > 0) {
+      reader->chunk_capacity =
+          records_len / records * BTM_BLE_BATCH_SCAN_CHUNK_RECORDS;
+      reader->data.reserve(reader->chunk_capacity);
+    }
+
+    if (reader->num_records + records > BTM_BLE_BATCH_SCAN_CHUNK_RECORDS) {
+      reader->Deliver(status, report_format);
+    }
+    reader->data.insert(reader->data.end(), p, p + records_len);
+    reader->num_records += records;
 
     /* More records could be in the buffer and needs to be pulled out */
-    btm_ble_read_batchscan_reports(
-        report_format, base::Bind(&read_reports_cb, std::move(data_all),
-                                  num_records_all, std::move(cb)));
+    btm_ble_read_batchscan_reports(report_format,
+                                   base::Bind(&read_reports_cb, reader));
   }
 }
 
@@ -507,7 +561,9 @@ void BTM_BleReadScanReports(tBTM_BLE_BATCH_SCAN_MODE scan_mode,
   }
 
   btm_ble_read_batchscan_reports(
-      scan_mode, base::Bind(&read_reports_cb, std::vector<uint8_t>(), 0, cb));
+      scan_mode,
+      base::Bind(&read_reports_cb,
+                 std::make_shared<BatchScanReportReader>(std::move(cb))));
   return;
 }
 
@@ -325,7 +325,9 @@ bool BTM_SetLeConnectionModeToFast() {
   if ((p_cb->scan_int == BTM_BLE_SCAN_PARAM_UNDEF &&
        p_cb->scan_win == BTM_BLE_SCAN_PARAM_UNDEF) ||
       (p_cb->scan_int == BTM_BLE_SCAN_SLOW_INT_1 &&
-       p_cb->scan_win == BTM_BLE_SCAN_SLOW_WIN_1)) {
+       p_cb->scan_win == BTM_BLE_SCAN_SLOW_WIN_1) ||
+      (p_cb->scan_int == BTM_BLE_SCAN_MEDIUM_INT &&
+       p_cb->scan_win == BTM_BLE_SCAN_MEDIUM_WIN)) {
     p_cb->scan_int = BTM_BLE_SCAN_FAST_INT;
     p_cb->scan_win = BTM_BLE_SCAN_FAST_WIN;
     return true;
@@ -339,12 +341,26 @@ void BTM_SetLeConnectionModeToSlow() {
   if ((p_cb->scan_int == BTM_BLE_SCAN_PARAM_UNDEF &&
        p_cb->scan_win == BTM_BLE_SCAN_PARAM_UNDEF) ||
       (p_cb->scan_int == BTM_BLE_SCAN_FAST_INT &&
-       p_cb->scan_win == BTM_BLE_SCAN_FAST_WIN)) {
+       p_cb->scan_win == BTM_BLE_SCAN_FAST_WIN) ||
+      (p_cb->scan_int == BTM_BLE_SCAN_MEDIUM_INT &&
+       p_cb->scan_win == BTM_BLE_SCAN_MEDIUM_WIN)) {
     p_cb->scan_int = BTM_BLE_SCAN_SLOW_INT_1;
     p_cb->scan_win = BTM_BLE_SCAN_SLOW_WIN_1;
   }
 }
 
+void BTM_SetLeConnectionModeToMedium() {
+  VLOG(2) << __func__;
+  tBTM_BLE_CB* p_cb = &btm_cb.ble_ctr_cb;
+  if ((p_cb->scan_int == BTM_BLE_SCAN_PARAM_UNDEF &&
+       p_cb->scan_win == BTM_BLE_SCAN_PARAM_UNDEF) ||
+      (p_cb->scan_int == BTM_BLE_SCAN_SLOW_INT_1 &&
+       p_cb->scan_win == BTM_BLE_SCAN_SLOW_WIN_1)) {
+    p_cb->scan_int = BTM_BLE_SCAN_MEDIUM_INT;
+    p_cb->scan_win = BTM_BLE_SCAN_MEDIUM_WIN;
+  }
+}
+
 /** This function is to start auto connection procedure */
 bool btm_ble_start_auto_conn() {
   tBTM_BLE_CB* p_cb = &btm_cb.ble_ctr_cb;
@@ -41,3 +41,9 @@ extern bool BTM_SetLeConnectionModeToFast();
  * This does not send any requests to controller, instead it changes the
  * parameters that will be used after next add/remove request */
 extern void BTM_SetLeConnectionModeToSlow();
+
+/* Use medium scan window/interval for LE connection establishment, while
+ * devices that just disconnected are expected back. Does not override the
+ * fast parameters of a direct connection. Like the other modes, it takes
+ * effect after next add/remove request. */
+extern void BTM_SetLeConnectionModeToMedium();
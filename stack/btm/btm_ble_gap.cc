@@ -30,6 +30,7 @@
 #include <stddef.h>
 #include <stdio.h>
 #include <string.h>
+#include <array>
 #include <list>
 #include <vector>
 
@@ -50,6 +51,7 @@
 #include "l2c_int.h"
 #include "osi/include/log.h"
 #include "common/time_util.h"
+#include "stack_config.h"
 
 #include "main/shim/btm_api.h"
 #include "main/shim/shim.h"
@@ -105,6 +107,11 @@ class AdvertisingCache {
     return items.front().data;
   }
 
+  /* Returns true if data is waiting for device |addr_type, addr| */
+  bool Contains(uint8_t addr_type, const RawAddress& addr) {
+    return Find(addr_type, addr) != items.end();
+  }
+
   /* Clear data for device |addr_type, addr| */
   void Clear(uint8_t addr_type, const RawAddress& addr) {
     auto it = Find(addr_type, addr);
@@ -141,8 +148,102 @@ class AdvertisingCache {
  * on secondary channel */
 AdvertisingCache cache;
 
+/* Drops advertising reports that repeat the last report of an advertiser.
+ *
+ * Advertisers are identified by address and advertising SID, and reports by a
+ * hash of their event type and data; RSSI is ignored. Each advertiser hashes
+ * to one slot of a fixed table, so nothing is allocated and colliding
+ * advertisers at worst evict each other's entry, which only lets a duplicate
+ * through. A duplicate is reported again once |refresh_ms| have passed, so
+ * that listeners still see advertisers that are present. */
+class AdvertisingDuplicateFilter {
+ public:
+  /* Start over with |refresh_ms|; 0 disables the filter */
+  void Reset(uint32_t refresh_ms) {
+    this->refresh_ms = refresh_ms;
+    table.fill(Entry{});
+  }
+
+  /* Returns true if the report should be dropped. Otherwise it is recorded as
+   * the last report of the advertiser. */
+  bool IsDuplicate(uint8_t addr_type, const RawAddress& addr,
+                   uint8_t advertising_sid, uint16_t evt_type,
+                   const uint8_t* data, size_t data_len) {
+    if (refresh_ms == 0) return false;
+
+    uint64_t id = kHashOffset;
+    HashBytes(&id, &addr_type, sizeof(addr_type));
+    HashBytes(&id, addr.address, sizeof(addr.address));
+    HashBytes(&id, &advertising_sid, sizeof(advertising_sid));
+
+    uint64_t content = kHashOffset;
+    HashBytes(&content, reinterpret_cast<const uint8_t*>(&evt_type),
+              sizeof(evt_type));
+    HashBytes(&content, data, data_len);
+
+    uint64_t now_ms = bluetooth::common::time_get_os_boottime_ms();
+    Entry& entry = table[id % kTableSize];
+    if (entry.id == id && entry.content == content &&
+        now_ms - entry.reported_ms < refresh_ms)
+      return true;
+
+    entry = {id, content, now_ms};
+    return false;
+  }
+
+ private:
+  struct Entry {
+    uint64_t id;
+    uint64_t content;
+    uint64_t reported_ms;
+  };
+
+  /* FNV-1a */
+  static constexpr uint64_t kHashOffset = 0xcbf29ce484222325ULL;
+  static constexpr uint64_t kHashPrime = 0x100000001b3ULL;
+
+  static void HashBytes(uint64_t* hash, const uint8_t* data, size_t len) {
+    for (size_t i = 0; i < len; i++) *hash = (*hash ^ data[i]) * kHashPrime;
+  }
+
+  static constexpr size_t kTableSize = 512;
+  std::array<Entry, kTableSize> table{};
+  uint32_t refresh_ms = 0;
+};
+
+AdvertisingDuplicateFilter duplicate_filter;
+
+/* A complete advertising report, handed by value from the LE scan shard to the
+ * main thread */
+struct AdvertisingReport {
+  uint16_t evt_type;
+  uint8_t addr_type;
+  RawAddress bda;
+  uint8_t primary_phy;
+  uint8_t secondary_phy;
+  uint8_t advertising_sid;
+  int8_t tx_power;
+  int8_t rssi;
+  uint16_t periodic_adv_int;
+  std::vector<uint8_t> data;
+};
+
 }  // namespace
 
+/* |cache| and |duplicate_filter| are owned by the LE scan shard */
+static void btm_ble_reset_duplicate_filter() {
+  uint32_t refresh_ms =
+      stack_config_get_interface()->get_ble_adv_duplicate_filter_ms();
+  if (!btu_shard_is_threaded(BTU_SHARD_LE_SCAN)) {
+    duplicate_filter.Reset(refresh_ms);
+    return;
+  }
+  do_in_shard_thread(BTU_SHARD_LE_SCAN, FROM_HERE,
+                     base::BindOnce(&AdvertisingDuplicateFilter::Reset,
+                                    base::Unretained(&duplicate_filter),
+                                    refresh_ms));
+}
+
 #if (BLE_VND_INCLUDED == TRUE)
 static tBTM_BLE_CTRL_FEATURES_CBACK* p_ctrl_le_feature_rd_cmpl_cback = NULL;
 #endif
@@ -1297,6 +1398,9 @@ tBTM_STATUS btm_ble_start_inquiry(uint8_t mode, uint8_t duration) {
     return (BTM_BUSY);
   }
 
+  /* the inquiry may join an ongoing scan, report its advertisers again */
+  btm_ble_reset_duplicate_filter();
+
   if (!BTM_BLE_IS_SCAN_ACTIVE(p_ble_cb->scan_activity)) {
     btm_send_hci_set_scan_params(
         BTM_BLE_SCAN_MODE_ACTI, BTM_BLE_LOW_LATENCY_SCAN_INT,
@@ -1479,8 +1583,8 @@ static void btm_ble_update_adv_flag(uint8_t flag) {
  * Check ADV flag to make sure device is discoverable and match the search
  * condition
  */
-uint8_t btm_ble_is_discoverable(const RawAddress& bda,
-                                std::vector<uint8_t> const& adv_data) {
+uint8_t btm_ble_is_discoverable(const RawAddress& bda, const uint8_t* adv_data,
+                                size_t adv_len) {
   uint8_t flag = 0, rt = 0;
   uint8_t data_len;
   tBTM_INQ_PARMS* p_cond = &btm_cb.btm_inq_vars.inqparms;
@@ -1496,9 +1600,9 @@ uint8_t btm_ble_is_discoverable(const RawAddress& bda,
     return rt;
   }
 
-  if (!adv_data.empty()) {
+  if (adv_len != 0) {
     const uint8_t* p_flag = AdvertiseDataParser::GetFieldByType(
-        adv_data, BTM_BLE_AD_TYPE_FLAG, &data_len);
+        adv_data, adv_len, BTM_BLE_AD_TYPE_FLAG, &data_len);
     if (p_flag != NULL && data_len != 0) {
       flag = *p_flag;
 
@@ -1651,9 +1755,8 @@ void btm_ble_update_inq_result(tINQ_DB_ENT* p_i, uint8_t addr_type,
                                uint8_t primary_phy, uint8_t secondary_phy,
                                uint8_t advertising_sid, int8_t tx_power,
                                int8_t rssi, uint16_t periodic_adv_int,
-                               std::vector<uint8_t> const& data) {
+                               const uint8_t* data, size_t data_len) {
   tBTM_INQ_RESULTS* p_cur = &p_i->inq_info.results;
-  uint8_t len;
   tBTM_INQUIRY_VAR_ST* p_inq = &btm_cb.btm_inq_vars;
 
   /* Save the info */
@@ -1682,40 +1785,47 @@ void btm_ble_update_inq_result(tINQ_DB_ENT* p_i, uint8_t addr_type,
 
   p_i->inq_count = p_inq->inq_counter; /* Mark entry for current inquiry */
 
-  if (!data.empty()) {
-    const uint8_t* p_flag =
-        AdvertiseDataParser::GetFieldByType(data, BTM_BLE_AD_TYPE_FLAG, &len);
-    if (p_flag != NULL && len != 0) p_cur->flag = *p_flag;
-  }
-
-  if (!data.empty()) {
-    /* Check to see the BLE device has the Appearance UUID in the advertising
-     * data.  If it does
-     * then try to convert the appearance value to a class of device value
-     * Bluedroid can use.
-     * Otherwise fall back to trying to infer if it is a HID device based on the
-     * service class.
-     */
-    const uint8_t* p_uuid16 = AdvertiseDataParser::GetFieldByType(
-        data, BTM_BLE_AD_TYPE_APPEARANCE, &len);
-    if (p_uuid16 && len == 2) {
-      btm_ble_appearance_to_cod((uint16_t)p_uuid16[0] | (p_uuid16[1] << 8),
-                                p_cur->dev_class);
-    } else {
-      p_uuid16 = AdvertiseDataParser::GetFieldByType(
-          data, BTM_BLE_AD_TYPE_16SRV_CMPL, &len);
-      if (p_uuid16 != NULL) {
-        uint8_t i;
-        for (i = 0; i + 2 <= len; i = i + 2) {
-          /* if this BLE device support HID over LE, set HID Major in class of
-           * device */
-          if ((p_uuid16[i] | (p_uuid16[i + 1] << 8)) == UUID_SERVCLASS_LE_HID) {
-            p_cur->dev_class[0] = 0;
-            p_cur->dev_class[1] = BTM_COD_MAJOR_PERIPHERAL;
-            p_cur->dev_class[2] = 0;
-            break;
-          }
-        }
+  /* Pick the first flags, appearance and complete 16 bit UUID list fields in a
+   * single pass over the data */
+  AdvertiseDataParser::Field flags = {0, NULL, 0};
+  AdvertiseDataParser::Field appearance = {0, NULL, 0};
+  AdvertiseDataParser::Field uuid16 = {0, NULL, 0};
+  for (const auto& field : AdvertiseDataParser::Fields(data, data_len)) {
+    if (field.type == BTM_BLE_AD_TYPE_FLAG && flags.data == NULL) {
+      flags = field;
+    } else if (field.type == BTM_BLE_AD_TYPE_APPEARANCE &&
+               appearance.data == NULL) {
+      appearance = field;
+    } else if (field.type == BTM_BLE_AD_TYPE_16SRV_CMPL &&
+               uuid16.data == NULL) {
+      uuid16 = field;
+    }
+  }
+
+  if (flags.data != NULL && flags.length != 0) p_cur->flag = flags.data[0];
+
+  /* Check to see the BLE device has the Appearance UUID in the advertising
+   * data.  If it does
+   * then try to convert the appearance value to a class of device value
+   * Bluedroid can use.
+   * Otherwise fall back to trying to infer if it is a HID device based on the
+   * service class.
+   */
+  if (appearance.data != NULL && appearance.length == 2) {
+    btm_ble_appearance_to_cod(
+        (uint16_t)appearance.data[0] | (appearance.data[1] << 8),
+        p_cur->dev_class);
+  } else if (uuid16.data != NULL) {
+    const uint8_t* p_uuid = uuid16.data;
+    uint8_t i;
+    for (i = 0; i + 2 <= uuid16.length; i = i + 2) {
+      /* if this BLE device support HID over LE, set HID Major in class of
+       * device */
+      if ((p_uuid[i] | (p_uuid[i + 1] << 8)) == UUID_SERVCLASS_LE_HID) {
+        p_cur->dev_class[0] = 0;
+        p_cur->dev_class[1] = BTM_COD_MAJOR_PERIPHERAL;
+        p_cur->dev_class[2] = 0;
+        break;
       }
     }
   }
@@ -1745,16 +1855,16 @@ void btm_ble_update_inq_result(tINQ_DB_ENT* p_i, uint8_t addr_type,
  *
  ******************************************************************************/
 void btm_clear_all_pending_le_entry(void) {
-  uint16_t xx;
-  tINQ_DB_ENT* p_ent = btm_cb.btm_inq_vars.inq_db;
+  tINQ_DB_ENT* p_ent = btm_inq_db_next(NULL);
 
-  for (xx = 0; xx < BTM_INQ_DB_SIZE; xx++, p_ent++) {
+  while (p_ent) {
+    tINQ_DB_ENT* p_next = btm_inq_db_next(p_ent);
     /* mark all pending LE entry as unused if an LE only device has scan
      * response outstanding */
-    if ((p_ent->in_use) &&
-        (p_ent->inq_info.results.device_type == BT_DEVICE_TYPE_BLE) &&
+    if ((p_ent->inq_info.results.device_type == BT_DEVICE_TYPE_BLE) &&
         !p_ent->scan_rsp)
-      p_ent->in_use = false;
+      btm_inq_db_free(p_ent);
+    p_ent = p_next;
   }
 }
 
@@ -1784,11 +1894,303 @@ void btm_ble_process_adv_addr(RawAddress& bda, uint8_t* addr_type) {
 }
 
 /**
- * This function is called when extended advertising report event is received .
- * It updates the inquiry database. If the inquiry database is full, the oldest
- * entry is discarded.
+ * Puts together the data of an advertising report from its packets, and checks
+ * it. Returns false if the report is not complete yet, repeats the last report
+ * of its advertiser or is malformed. Otherwise |p_adv_data| points to the data,
+ * which stays valid until the cache entry of the device is cleared.
+ *
+ * Runs on the LE scan shard, which owns |cache| and |duplicate_filter|.
  */
-void btm_ble_process_ext_adv_pkt(uint8_t data_len, uint8_t* data) {
+static bool btm_ble_assemble_adv_data(uint16_t evt_type, uint8_t addr_type,
+                                      const RawAddress& bda,
+                                      uint8_t advertising_sid,
+                                      bool is_active_scan, uint8_t data_len,
+                                      uint8_t* data, const uint8_t** p_adv_data,
+                                      size_t* p_adv_len) {
+  bool is_scannable = ble_evt_type_is_scannable(evt_type);
+  bool is_scan_resp = ble_evt_type_is_scan_resp(evt_type);
+
+  bool is_start =
+      ble_evt_type_is_legacy(evt_type) && is_scannable && !is_scan_resp;
+
+  /* A report held in one complete packet is checked for duplicates before any
+   * work: one that is completed by a scan response or by chained packets is
+   * checked once it has been put together. */
+  bool is_single_packet = ble_evt_type_data_status(evt_type) != 0x01 &&
+                          !is_scan_resp &&
+                          !(is_active_scan && is_scannable) &&
+                          !cache.Contains(addr_type, bda);
+  if (is_single_packet &&
+      duplicate_filter.IsDuplicate(addr_type, bda, advertising_sid, evt_type,
+                                   data, data_len)) {
+    return false;
+  }
+
+  if (is_single_packet) {
+    /* Nothing to put together: the report is used in place */
+    *p_adv_data = data;
+    *p_adv_len = ble_evt_type_is_legacy(evt_type)
+                     ? AdvertiseDataParser::LengthWithoutTrailingZeros(
+                           data, data_len)
+                     : data_len;
+  } else {
+    std::vector<uint8_t> tmp;
+    if (data_len != 0) tmp.insert(tmp.begin(), data, data + data_len);
+
+    if (ble_evt_type_is_legacy(evt_type))
+      AdvertiseDataParser::RemoveTrailingZeros(tmp);
+
+    // We might have send scan request to this device before, but didn't get
+    // the response. In such case make sure data is put at start, not appended
+    // to already existing data.
+    std::vector<uint8_t> const& cached =
+        is_start ? cache.Set(addr_type, bda, std::move(tmp))
+                 : cache.Append(addr_type, bda, std::move(tmp));
+
+    bool data_complete = (ble_evt_type_data_status(evt_type) != 0x01);
+
+    if (!data_complete) {
+      // If we didn't receive whole adv data yet, don't report the device.
+      DVLOG(1) << "Data not complete yet, waiting for more " << bda;
+      return false;
+    }
+
+    if (is_active_scan && is_scannable && !is_scan_resp) {
+      // If we didn't receive scan response yet, don't report the device.
+      DVLOG(1) << " Waiting for scan response " << bda;
+      return false;
+    }
+
+    *p_adv_data = cached.data();
+    *p_adv_len = cached.size();
+  }
+
+  if (!AdvertiseDataParser::IsValid(*p_adv_data, *p_adv_len)) {
+    DVLOG(1) << __func__ << "Dropping bad advertisement packet: "
+             << base::HexEncode(*p_adv_data, *p_adv_len);
+    return false;
+  }
+
+  if (!is_single_packet &&
+      duplicate_filter.IsDuplicate(addr_type, bda, advertising_sid, evt_type,
+                                   *p_adv_data, *p_adv_len)) {
+    cache.Clear(addr_type, bda);
+    return false;
+  }
+
+  return true;
+}
+
+/**
+ * Updates the inquiry database with a complete advertising report, and hands
+ * it to the inquiry and observer callbacks. Runs on the main thread.
+ */
+static void btm_ble_report_adv_data(uint16_t evt_type, uint8_t addr_type,
+                                    const RawAddress& bda, uint8_t primary_phy,
+                                    uint8_t secondary_phy,
+                                    uint8_t advertising_sid, int8_t tx_power,
+                                    int8_t rssi, uint16_t periodic_adv_int,
+                                    const uint8_t* adv_data, size_t adv_len) {
+  tBTM_INQUIRY_VAR_ST* p_inq = &btm_cb.btm_inq_vars;
+  bool update = true;
+
+  /* Without APCF in the controller, the scan filters run here */
+  if (!btm_ble_host_filter_match(bda, rssi, adv_data, adv_len)) return;
+
+  tINQ_DB_ENT* p_i = btm_inq_db_find(bda);
+
+  /* Check if this address has already been processed for this inquiry */
+  if (btm_inq_find_bdaddr(bda)) {
+    /* never been report as an LE device */
+    if (p_i && (!(p_i->inq_info.results.device_type & BT_DEVICE_TYPE_BLE) ||
+                /* scan repsonse to be updated */
+                (!p_i->scan_rsp))) {
+      update = true;
+    } else if (BTM_BLE_IS_OBS_ACTIVE(btm_cb.ble_ctr_cb.scan_activity)) {
+      update = false;
+    } else {
+      /* if yes, skip it */
+      return; /* assumption: one result per event */
+    }
+  }
+  /* If existing entry, use that, else get  a new one (possibly reusing the
+   * oldest) */
+  if (p_i == NULL) {
+    p_i = btm_inq_db_new(bda);
+    if (p_i != NULL) {
+      p_inq->inq_cmpl_info.num_resp++;
+      p_i->time_of_resp = bluetooth::common::time_get_os_boottime_ms();
+    } else
+      return;
+  } else if (p_i->inq_count !=
+             p_inq->inq_counter) /* first time seen in this inquiry */
+  {
+    p_i->time_of_resp = bluetooth::common::time_get_os_boottime_ms();
+    p_inq->inq_cmpl_info.num_resp++;
+  }
+
+  /* update the LE device information in inquiry database */
+  btm_ble_update_inq_result(p_i, addr_type, bda, evt_type, primary_phy,
+                            secondary_phy, advertising_sid, tx_power, rssi,
+                            periodic_adv_int, adv_data, adv_len);
+
+  uint8_t result = btm_ble_is_discoverable(bda, adv_data, adv_len);
+  if (result == 0) {
+    LOG_WARN(LOG_TAG,
+             "%s device no longer discoverable, discarding advertising packet",
+             __func__);
+    return;
+  }
+
+  if (!update) result &= ~BTM_BLE_INQ_RESULT;
+  /* If the number of responses found and limited, issue a cancel inquiry */
+  if (p_inq->inqparms.max_resps &&
+      p_inq->inq_cmpl_info.num_resp == p_inq->inqparms.max_resps) {
+    /* new device */
+    if (p_i == NULL ||
+        /* assume a DUMO device, BR/EDR inquiry is always active */
+        (p_i &&
+         (p_i->inq_info.results.device_type & BT_DEVICE_TYPE_BLE) ==
+             BT_DEVICE_TYPE_BLE &&
+         p_i->scan_rsp)) {
+      BTM_TRACE_WARNING(
+          "INQ RES: Extra Response Received...cancelling inquiry..");
+
+      /* if is non-periodic inquiry active, cancel now */
+      if ((p_inq->inq_active & BTM_BR_INQ_ACTIVE_MASK) != 0 &&
+          (p_inq->inq_active & BTM_PERIODIC_INQUIRY_ACTIVE) == 0)
+        btsnd_hcic_inq_cancel();
+
+      btm_ble_stop_inquiry();
+
+      btm_acl_update_busy_level(BTM_BLI_INQ_DONE_EVT);
+    }
+  }
+
+  tBTM_INQ_RESULTS_CB* p_inq_results_cb = p_inq->p_inq_results_cb;
+  if (p_inq_results_cb && (result & BTM_BLE_INQ_RESULT)) {
+    (p_inq_results_cb)((tBTM_INQ_RESULTS*)&p_i->inq_info.results,
+                       const_cast<uint8_t*>(adv_data), adv_len);
+  }
+
+  tBTM_INQ_RESULTS_CB* p_obs_results_cb = btm_cb.ble_ctr_cb.p_obs_results_cb;
+  if (p_obs_results_cb && (result & BTM_BLE_OBS_RESULT)) {
+    (p_obs_results_cb)((tBTM_INQ_RESULTS*)&p_i->inq_info.results,
+                       const_cast<uint8_t*>(adv_data), adv_len);
+  }
+}
+
+/**
+ * This function is called after random address resolution is done, and proceed
+ * to process adv packet.
+ */
+void btm_ble_process_adv_pkt_cont(uint16_t evt_type, uint8_t addr_type,
+                                  const RawAddress& bda, uint8_t primary_phy,
+                                  uint8_t secondary_phy,
+                                  uint8_t advertising_sid, int8_t tx_power,
+                                  int8_t rssi, uint16_t periodic_adv_int,
+                                  uint8_t data_len, uint8_t* data) {
+  bool is_active_scan =
+      btm_cb.ble_ctr_cb.inq_var.scan_type == BTM_BLE_SCAN_MODE_ACTI;
+  const uint8_t* adv_data;
+  size_t adv_len;
+  if (!btm_ble_assemble_adv_data(evt_type, addr_type, bda, advertising_sid,
+                                 is_active_scan, data_len, data, &adv_data,
+                                 &adv_len)) {
+    return;
+  }
+
+  btm_ble_report_adv_data(evt_type, addr_type, bda, primary_phy, secondary_phy,
+                          advertising_sid, tx_power, rssi, periodic_adv_int,
+                          adv_data, adv_len);
+  cache.Clear(addr_type, bda);
+}
+
+/* Takes an advertising report put together on the LE scan shard thread */
+static void btm_ble_on_shard_adv_report(AdvertisingReport report) {
+  /* The scan may have stopped while the report was on its way */
+  if (!BTM_BLE_IS_SCAN_ACTIVE(btm_cb.ble_ctr_cb.scan_activity)) return;
+
+  if (report.addr_type != BLE_ADDR_ANONYMOUS) {
+    btm_ble_process_adv_addr(report.bda, &report.addr_type);
+  }
+
+  btm_ble_report_adv_data(report.evt_type, report.addr_type, report.bda,
+                          report.primary_phy, report.secondary_phy,
+                          report.advertising_sid, report.tx_power, report.rssi,
+                          report.periodic_adv_int, report.data.data(),
+                          report.data.size());
+}
+
+/**
+ * Processes one report of an advertising report event. With a thread of its
+ * own, the LE scan shard puts the report together under the address it was
+ * sent from, and the main thread resolves the address of the complete report.
+ */
+static void btm_ble_process_adv_report(
+    bool is_active_scan, uint16_t evt_type, uint8_t addr_type, RawAddress bda,
+    uint8_t primary_phy, uint8_t secondary_phy, uint8_t advertising_sid,
+    int8_t tx_power, int8_t rssi, uint16_t periodic_adv_int, uint8_t data_len,
+    uint8_t* data) {
+  if (!btu_shard_is_threaded(BTU_SHARD_LE_SCAN)) {
+    if (addr_type != BLE_ADDR_ANONYMOUS) {
+      btm_ble_process_adv_addr(bda, &addr_type);
+    }
+    btm_ble_process_adv_pkt_cont(evt_type, addr_type, bda, primary_phy,
+                                 secondary_phy, advertising_sid, tx_power, rssi,
+                                 periodic_adv_int, data_len, data);
+    return;
+  }
+
+  const uint8_t* adv_data;
+  size_t adv_len;
+  if (!btm_ble_assemble_adv_data(evt_type, addr_type, bda, advertising_sid,
+                                 is_active_scan, data_len, data, &adv_data,
+                                 &adv_len)) {
+    return;
+  }
+
+  AdvertisingReport report = {
+      evt_type,         addr_type,
+      bda,              primary_phy,
+      secondary_phy,    advertising_sid,
+      tx_power,         rssi,
+      periodic_adv_int, std::vector<uint8_t>(adv_data, adv_data + adv_len)};
+  cache.Clear(addr_type, bda);
+  do_in_main_thread(FROM_HERE, base::BindOnce(&btm_ble_on_shard_adv_report,
+                                              std::move(report)));
+}
+
+/* Parses an advertising report event copied for the LE scan shard thread */
+static void btm_ble_parse_adv_event(void (*parse)(bool, uint8_t, uint8_t*),
+                                    bool is_active_scan,
+                                    std::vector<uint8_t> event) {
+  parse(is_active_scan, event.size(), event.data());
+}
+
+/* Hands an advertising report event of |data_len| bytes to |parse|, on the LE
+ * scan shard */
+static void btm_ble_dispatch_adv_event(void (*parse)(bool, uint8_t, uint8_t*),
+                                       uint8_t data_len, uint8_t* data) {
+  /* Only process the results if the inquiry is still active */
+  if (!BTM_BLE_IS_SCAN_ACTIVE(btm_cb.ble_ctr_cb.scan_activity)) return;
+
+  /* The shard reads no state of the main thread: the scan type goes along */
+  bool is_active_scan =
+      btm_cb.ble_ctr_cb.inq_var.scan_type == BTM_BLE_SCAN_MODE_ACTI;
+  if (!btu_shard_is_threaded(BTU_SHARD_LE_SCAN)) {
+    parse(is_active_scan, data_len, data);
+    return;
+  }
+  do_in_shard_thread(
+      BTU_SHARD_LE_SCAN, FROM_HERE,
+      base::BindOnce(&btm_ble_parse_adv_event, parse, is_active_scan,
+                     std::vector<uint8_t>(data, data + data_len)));
+}
+
+/* Parses the reports of an LE Extended Advertising Report event */
+static void btm_ble_parse_ext_adv_pkt(bool is_active_scan, uint8_t data_len,
+                                      uint8_t* data) {
   RawAddress bda, direct_address;
   uint8_t* p = data;
   uint8_t addr_type, num_reports, pkt_data_len, primary_phy, secondary_phy,
@@ -1796,9 +2198,6 @@ void btm_ble_process_ext_adv_pkt(uint8_t data_len, uint8_t* data) {
   int8_t rssi, tx_power;
   uint16_t event_type, periodic_adv_int, direct_address_type;
 
-  /* Only process the results if the inquiry is still active */
-  if (!BTM_BLE_IS_SCAN_ACTIVE(btm_cb.ble_ctr_cb.scan_activity)) return;
-
   /* Extract the number of reports in this event. */
   STREAM_TO_UINT8(num_reports, p);
 
@@ -1837,30 +2236,21 @@ void btm_ble_process_ext_adv_pkt(uint8_t data_len, uint8_t* data) {
                       rssi);
     }
 
-    if (addr_type != BLE_ADDR_ANONYMOUS) {
-      btm_ble_process_adv_addr(bda, &addr_type);
-    }
-
-    btm_ble_process_adv_pkt_cont(event_type, addr_type, bda, primary_phy,
-                                 secondary_phy, advertising_sid, tx_power, rssi,
-                                 periodic_adv_int, pkt_data_len, pkt_data);
+    btm_ble_process_adv_report(is_active_scan, event_type, addr_type, bda,
+                               primary_phy, secondary_phy, advertising_sid,
+                               tx_power, rssi, periodic_adv_int, pkt_data_len,
+                               pkt_data);
   }
 }
 
-/**
- * This function is called when advertising report event is received. It updates
- * the inquiry database. If the inquiry database is full, the oldest entry is
- * discarded.
- */
-void btm_ble_process_adv_pkt(uint8_t data_len, uint8_t* data) {
+/* Parses the reports of an LE Advertising Report event */
+static void btm_ble_parse_adv_pkt(bool is_active_scan, uint8_t data_len,
+                                  uint8_t* data) {
   RawAddress bda;
   uint8_t* p = data;
   uint8_t legacy_evt_type, addr_type, num_reports, pkt_data_len;
   int8_t rssi;
 
-  /* Only process the results if the inquiry is still active */
-  if (!BTM_BLE_IS_SCAN_ACTIVE(btm_cb.ble_ctr_cb.scan_activity)) return;
-
   /* Extract the number of reports in this event. */
   STREAM_TO_UINT8(num_reports, p);
 
@@ -1891,8 +2281,6 @@ void btm_ble_process_adv_pkt(uint8_t data_len, uint8_t* data) {
                       pkt_data_len, rssi);
     }
 
-    btm_ble_process_adv_addr(bda, &addr_type);
-
     uint16_t event_type;
     event_type = 1 << BLE_EVT_LEGACY_BIT;
     if (legacy_evt_type == BTM_BLE_ADV_IND_EVT) {
@@ -1919,151 +2307,30 @@ void btm_ble_process_adv_pkt(uint8_t data_len, uint8_t* data) {
       return;
     }
 
-    btm_ble_process_adv_pkt_cont(
-        event_type, addr_type, bda, PHY_LE_1M, PHY_LE_NO_PACKET, NO_ADI_PRESENT,
-        TX_POWER_NOT_PRESENT, rssi, 0x00 /* no periodic adv */, pkt_data_len,
-        pkt_data);
+    btm_ble_process_adv_report(is_active_scan, event_type, addr_type, bda,
+                               PHY_LE_1M, PHY_LE_NO_PACKET, NO_ADI_PRESENT,
+                               TX_POWER_NOT_PRESENT, rssi,
+                               0x00 /* no periodic adv */, pkt_data_len,
+                               pkt_data);
   }
 }
 
 /**
- * This function is called after random address resolution is done, and proceed
- * to process adv packet.
+ * This function is called when extended advertising report event is received .
+ * It updates the inquiry database. If the inquiry database is full, the oldest
+ * entry is discarded.
  */
-void btm_ble_process_adv_pkt_cont(uint16_t evt_type, uint8_t addr_type,
-                                  const RawAddress& bda, uint8_t primary_phy,
-                                  uint8_t secondary_phy,
-                                  uint8_t advertising_sid, int8_t tx_power,
-                                  int8_t rssi, uint16_t periodic_adv_int,
-                                  uint8_t data_len, uint8_t* data) {
-  tBTM_INQUIRY_VAR_ST* p_inq = &btm_cb.btm_inq_vars;
-  bool update = true;
-
-  std::vector<uint8_t> tmp;
-  if (data_len != 0) tmp.insert(tmp.begin(), data, data + data_len);
-
-  bool is_scannable = ble_evt_type_is_scannable(evt_type);
-  bool is_scan_resp = ble_evt_type_is_scan_resp(evt_type);
-
-  bool is_start =
-      ble_evt_type_is_legacy(evt_type) && is_scannable && !is_scan_resp;
-
-  if (ble_evt_type_is_legacy(evt_type))
-    AdvertiseDataParser::RemoveTrailingZeros(tmp);
-
-  // We might have send scan request to this device before, but didn't get the
-  // response. In such case make sure data is put at start, not appended to
-  // already existing data.
-  std::vector<uint8_t> const& adv_data =
-      is_start ? cache.Set(addr_type, bda, std::move(tmp))
-               : cache.Append(addr_type, bda, std::move(tmp));
-
-  bool data_complete = (ble_evt_type_data_status(evt_type) != 0x01);
-
-  if (!data_complete) {
-    // If we didn't receive whole adv data yet, don't report the device.
-    DVLOG(1) << "Data not complete yet, waiting for more " << bda;
-    return;
-  }
-
-  bool is_active_scan =
-      btm_cb.ble_ctr_cb.inq_var.scan_type == BTM_BLE_SCAN_MODE_ACTI;
-  if (is_active_scan && is_scannable && !is_scan_resp) {
-    // If we didn't receive scan response yet, don't report the device.
-    DVLOG(1) << " Waiting for scan response " << bda;
-    return;
-  }
-
-  if (!AdvertiseDataParser::IsValid(adv_data)) {
-    DVLOG(1) << __func__ << "Dropping bad advertisement packet: "
-             << base::HexEncode(adv_data.data(), adv_data.size());
-    return;
-  }
-
-  tINQ_DB_ENT* p_i = btm_inq_db_find(bda);
-
-  /* Check if this address has already been processed for this inquiry */
-  if (btm_inq_find_bdaddr(bda)) {
-    /* never been report as an LE device */
-    if (p_i && (!(p_i->inq_info.results.device_type & BT_DEVICE_TYPE_BLE) ||
-                /* scan repsonse to be updated */
-                (!p_i->scan_rsp))) {
-      update = true;
-    } else if (BTM_BLE_IS_OBS_ACTIVE(btm_cb.ble_ctr_cb.scan_activity)) {
-      update = false;
-    } else {
-      /* if yes, skip it */
-      return; /* assumption: one result per event */
-    }
-  }
-  /* If existing entry, use that, else get  a new one (possibly reusing the
-   * oldest) */
-  if (p_i == NULL) {
-    p_i = btm_inq_db_new(bda);
-    if (p_i != NULL) {
-      p_inq->inq_cmpl_info.num_resp++;
-      p_i->time_of_resp = bluetooth::common::time_get_os_boottime_ms();
-    } else
-      return;
-  } else if (p_i->inq_count !=
-             p_inq->inq_counter) /* first time seen in this inquiry */
-  {
-    p_i->time_of_resp = bluetooth::common::time_get_os_boottime_ms();
-    p_inq->inq_cmpl_info.num_resp++;
-  }
-
-  /* update the LE device information in inquiry database */
-  btm_ble_update_inq_result(p_i, addr_type, bda, evt_type, primary_phy,
-                            secondary_phy, advertising_sid, tx_power, rssi,
-                            periodic_adv_int, adv_data);
-
-  uint8_t result = btm_ble_is_discoverable(bda, adv_data);
-  if (result == 0) {
-    cache.Clear(addr_type, bda);
-    LOG_WARN(LOG_TAG,
-             "%s device no longer discoverable, discarding advertising packet",
-             __func__);
-    return;
-  }
-
-  if (!update) result &= ~BTM_BLE_INQ_RESULT;
-  /* If the number of responses found and limited, issue a cancel inquiry */
-  if (p_inq->inqparms.max_resps &&
-      p_inq->inq_cmpl_info.num_resp == p_inq->inqparms.max_resps) {
-    /* new device */
-    if (p_i == NULL ||
-        /* assume a DUMO device, BR/EDR inquiry is always active */
-        (p_i &&
-         (p_i->inq_info.results.device_type & BT_DEVICE_TYPE_BLE) ==
-             BT_DEVICE_TYPE_BLE &&
-         p_i->scan_rsp)) {
-      BTM_TRACE_WARNING(
-          "INQ RES: Extra Response Received...cancelling inquiry..");
-
-      /* if is non-periodic inquiry active, cancel now */
-      if ((p_inq->inq_active & BTM_BR_INQ_ACTIVE_MASK) != 0 &&
-          (p_inq->inq_active & BTM_PERIODIC_INQUIRY_ACTIVE) == 0)
-        btsnd_hcic_inq_cancel();
-
-      btm_ble_stop_inquiry();
-
-      btm_acl_update_busy_level(BTM_BLI_INQ_DONE_EVT);
-    }
-  }
-
-  tBTM_INQ_RESULTS_CB* p_inq_results_cb = p_inq->p_inq_results_cb;
-  if (p_inq_results_cb && (result & BTM_BLE_INQ_RESULT)) {
-    (p_inq_results_cb)((tBTM_INQ_RESULTS*)&p_i->inq_info.results,
-                       const_cast<uint8_t*>(adv_data.data()), adv_data.size());
-  }
-
-  tBTM_INQ_RESULTS_CB* p_obs_results_cb = btm_cb.ble_ctr_cb.p_obs_results_cb;
-  if (p_obs_results_cb && (result & BTM_BLE_OBS_RESULT)) {
-    (p_obs_results_cb)((tBTM_INQ_RESULTS*)&p_i->inq_info.results,
-                       const_cast<uint8_t*>(adv_data.data()), adv_data.size());
-  }
+void btm_ble_process_ext_adv_pkt(uint8_t data_len, uint8_t* data) {
+  btm_ble_dispatch_adv_event(&btm_ble_parse_ext_adv_pkt, data_len, data);
+}
 
-  cache.Clear(addr_type, bda);
+/**
+ * This function is called when advertising report event is received. It updates
+ * the inquiry database. If the inquiry database is full, the oldest entry is
+ * discarded.
+ */
+void btm_ble_process_adv_pkt(uint8_t data_len, uint8_t* data) {
+  btm_ble_dispatch_adv_event(&btm_ble_parse_adv_pkt, data_len, data);
 }
 
 void btm_ble_process_phy_update_pkt(uint8_t len, uint8_t* data) {
@@ -2078,6 +2345,7 @@ void btm_ble_process_phy_update_pkt(uint8_t len, uint8_t* data) {
   STREAM_TO_UINT8(tx_phy, p);
   STREAM_TO_UINT8(rx_phy, p);
 
+  l2cble_process_phy_update_evt(handle, status, tx_phy, rx_phy);
   gatt_notify_phy_updated(status, handle, tx_phy, rx_phy);
 }
 
@@ -2092,6 +2360,10 @@ void btm_ble_process_phy_update_pkt(uint8_t len, uint8_t* data) {
  ******************************************************************************/
 tBTM_STATUS btm_ble_start_scan(void) {
   tBTM_BLE_INQ_CB* p_inq = &btm_cb.ble_ctr_cb.inq_var;
+
+  /* a new scan reports every advertiser at least once */
+  btm_ble_reset_duplicate_filter();
+
   /* start scan, disable duplicate filtering */
   btm_send_hci_scan_enable(BTM_BLE_SCAN_ENABLE, p_inq->scan_duplicate_filter);
 
@@ -2561,6 +2833,8 @@ void btm_ble_init(void) {
   p_cb->addr_mgnt_cb.refresh_raddr_timer =
       alarm_new("btm_ble_addr.refresh_raddr_timer");
 
+  btm_ble_host_filter_init();
+
 #if (BLE_VND_INCLUDED == FALSE)
   btm_ble_adv_filter_init();
 #endif
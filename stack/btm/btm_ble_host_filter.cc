@@ -0,0 +1,600 @@
+/******************************************************************************
+ *
+ *  Copyright 2020 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This file contains the host side scan filtering, standing in for the
+ *  Advertisement Packet Content Filter (APCF) of controllers without it.
+ *
+ *  The conditions of the filters are compiled into one program when they
+ *  change: the UUIDs and company IDs matched in full are looked up in hash
+ *  tables, the other conditions are checked one by one against patterns
+ *  packed in a single buffer. A report is parsed once, then every condition
+ *  of the program is decided, then every filter checks the conditions of the
+ *  features it selects.
+ *
+ *  Everything here runs on the main thread.
+ *
+ ******************************************************************************/
+
+#include <base/logging.h>
+#include <string.h>
+#include <algorithm>
+#include <bitset>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include "advertise_data_parser.h"
+#include "bt_types.h"
+#include "btm_ble_api.h"
+#include "btm_ble_int.h"
+#include "osi/include/properties.h"
+
+using bluetooth::Uuid;
+
+#define BTM_BLE_HOST_PF_PROPERTY "persist.bluetooth.host_scan_filter"
+
+/* Conditions of all filters together */
+#define BTM_BLE_HOST_PF_MAX_CONDITIONS 256
+
+/* AD types of the service solicitation UUID lists */
+#define BTM_BLE_AD_SOL_16BITS_UUID_TYPE 0x14
+#define BTM_BLE_AD_SOL_128BITS_UUID_TYPE 0x15
+#define BTM_BLE_AD_SOL_32BITS_UUID_TYPE 0x1F
+
+namespace {
+
+/* Filter as set up by the upper layer */
+struct HostFilter {
+  std::vector<ApcfCommand> commands;
+  bool has_params = false;
+  uint16_t feat_seln = 0;
+  uint16_t list_logic_type = 0;
+  uint8_t filt_logic_type = BTM_BLE_PF_LOGIC_OR;
+  int8_t rssi_high_thres = -128;
+};
+
+/* One condition of the program. The patterns are in |patterns| from
+ * |pattern_offset|, followed by as many bytes of mask. */
+struct Condition {
+  uint8_t type;
+  RawAddress address;
+  Uuid uuid;
+  /* For 16 and 32 bit UUIDs, the masked 32 bit values are compared */
+  uint32_t uuid32;
+  uint32_t uuid32_mask;
+  Uuid::UUID128Bit uuid_mask;
+  uint8_t uuid_len;
+  uint16_t company;
+  uint16_t company_mask;
+  uint32_t pattern_offset;
+  uint8_t pattern_len;
+};
+
+struct CompiledFilter {
+  uint8_t filt_index;
+  uint16_t feat_seln;
+  uint16_t list_logic_type;
+  uint8_t filt_logic_type;
+  int8_t rssi_high_thres;
+  /* The conditions of this filter, by feature */
+  std::vector<uint16_t> conditions[BTM_BLE_PF_TYPE_ALL];
+};
+
+/* The conditions a report matches, by number */
+using ConditionSet = std::bitset<BTM_BLE_HOST_PF_MAX_CONDITIONS>;
+
+struct Program {
+  std::vector<Condition> conditions;
+  std::vector<uint8_t> patterns;
+  std::vector<CompiledFilter> filters;
+
+  /* The conditions matching a UUID or a company ID in full */
+  std::unordered_map<Uuid, std::vector<uint16_t>> srvc_uuids;
+  std::unordered_map<Uuid, std::vector<uint16_t>> sol_uuids;
+  std::unordered_map<uint16_t, std::vector<uint16_t>> companies;
+  /* The conditions checked one by one */
+  std::vector<uint16_t> linear;
+};
+
+/* A report, split in the fields the conditions look at */
+struct ParsedReport {
+  std::vector<Uuid> srvc_uuids;
+  std::vector<Uuid> sol_uuids;
+  const uint8_t* name = nullptr;
+  uint8_t name_len = 0;
+  bool name_complete = false;
+  std::vector<AdvertiseDataParser::Field> manu_data;
+  std::vector<AdvertiseDataParser::Field> srvc_data;
+};
+
+bool host_filter_on = false;
+bool host_filter_enabled = false;
+std::map<uint8_t, HostFilter> host_filters;
+Program program;
+bool program_dirty = true;
+
+uint32_t add_pattern(const std::vector<uint8_t>& data,
+                     const std::vector<uint8_t>& mask, uint8_t len) {
+  uint32_t offset = program.patterns.size();
+  program.patterns.insert(program.patterns.end(), data.begin(),
+                          data.begin() + len);
+  for (uint8_t i = 0; i < len; i++) {
+    program.patterns.push_back(i < mask.size() ? mask[i] : 0xff);
+  }
+  return offset;
+}
+
+/* Adds the condition of |cmd|, cut to the lengths btm_ble_adv_filter.cc sends
+ * to the controller. Returns false if it can't be compiled. */
+bool compile_condition(const ApcfCommand& cmd, uint16_t* p_id) {
+  if (program.conditions.size() >= BTM_BLE_HOST_PF_MAX_CONDITIONS) {
+    LOG(ERROR) << __func__ << ": too many scan filter conditions";
+    return false;
+  }
+
+  Condition cond = {};
+  cond.type = cmd.type;
+  uint16_t id = program.conditions.size();
+  bool indexed = false;
+
+  switch (cmd.type) {
+    case BTM_BLE_PF_ADDR_FILTER:
+      cond.address = cmd.address;
+      break;
+
+    case BTM_BLE_PF_SRVC_DATA:
+      break;
+
+    case BTM_BLE_PF_SRVC_UUID:
+    case BTM_BLE_PF_SRVC_SOL_UUID: {
+      cond.uuid = cmd.uuid;
+      cond.uuid_len = cmd.uuid.GetShortestRepresentationSize();
+      bool full_mask = cmd.uuid_mask.IsEmpty();
+      if (cond.uuid_len == Uuid::kNumBytes16) {
+        uint16_t mask16 = full_mask ? 0xffff : cmd.uuid_mask.As16Bit();
+        cond.uuid32_mask = 0xffff0000 | mask16;
+        full_mask = mask16 == 0xffff;
+      } else if (cond.uuid_len == Uuid::kNumBytes32) {
+        cond.uuid32_mask = full_mask ? 0xffffffff : cmd.uuid_mask.As32Bit();
+        full_mask = cond.uuid32_mask == 0xffffffff;
+      } else {
+        cond.uuid_mask.fill(0xff);
+        if (!full_mask) {
+          cond.uuid_mask = cmd.uuid_mask.To128BitBE();
+          full_mask = std::all_of(cond.uuid_mask.begin(), cond.uuid_mask.end(),
+                                  [](uint8_t b) { return b == 0xff; });
+        }
+      }
+      if (cond.uuid_len != Uuid::kNumBytes128) {
+        cond.uuid32 = cmd.uuid.As32Bit() & cond.uuid32_mask;
+      }
+      if (full_mask) {
+        auto& index = cmd.type == BTM_BLE_PF_SRVC_UUID ? program.srvc_uuids
+                                                       : program.sol_uuids;
+        index[cmd.uuid].push_back(id);
+        indexed = true;
+      }
+      break;
+    }
+
+    case BTM_BLE_PF_LOCAL_NAME: {
+      uint8_t len = std::min(cmd.name.size(), (size_t)BTM_BLE_PF_STR_LEN_MAX);
+      cond.pattern_offset = add_pattern(cmd.name, {}, len);
+      cond.pattern_len = len;
+      break;
+    }
+
+    case BTM_BLE_PF_MANU_DATA: {
+      cond.company = cmd.company;
+      cond.company_mask = cmd.company_mask ? cmd.company_mask : 0xffff;
+      /* The data is only sent along with its mask */
+      if (!cmd.data.empty() && !cmd.data_mask.empty()) {
+        uint8_t len = std::min(cmd.data.size(),
+                               (size_t)(BTM_BLE_PF_STR_LEN_MAX - 2));
+        cond.pattern_offset = add_pattern(cmd.data, cmd.data_mask, len);
+        cond.pattern_len = len;
+      }
+      if (cond.company_mask == 0xffff) {
+        program.companies[cond.company].push_back(id);
+        indexed = true;
+      }
+      break;
+    }
+
+    case BTM_BLE_PF_SRVC_DATA_PATTERN: {
+      uint8_t len =
+          std::min(cmd.data.size(), (size_t)(BTM_BLE_PF_STR_LEN_MAX - 2));
+      cond.pattern_offset = add_pattern(cmd.data, cmd.data_mask, len);
+      cond.pattern_len = len;
+      break;
+    }
+
+    default:
+      LOG(ERROR) << __func__ << ": Unknown filter type: " << +cmd.type;
+      return false;
+  }
+
+  program.conditions.push_back(cond);
+  if (!indexed) program.linear.push_back(id);
+  *p_id = id;
+  return true;
+}
+
+void compile_program() {
+  program = Program();
+  for (const auto& entry : host_filters) {
+    const HostFilter& filter = entry.second;
+    if (!filter.has_params) continue;
+
+    CompiledFilter compiled;
+    compiled.filt_index = entry.first;
+    compiled.feat_seln = filter.feat_seln;
+    compiled.list_logic_type = filter.list_logic_type;
+    compiled.filt_logic_type = filter.filt_logic_type;
+    compiled.rssi_high_thres = filter.rssi_high_thres;
+    for (const ApcfCommand& cmd : filter.commands) {
+      uint16_t id;
+      if (compile_condition(cmd, &id)) {
+        compiled.conditions[cmd.type].push_back(id);
+      }
+    }
+    program.filters.push_back(std::move(compiled));
+  }
+  program_dirty = false;
+}
+
+void add_uuids(std::vector<Uuid>* uuids,
+               const AdvertiseDataParser::Field& field, size_t uuid_len) {
+  for (size_t i = 0; i + uuid_len <= field.length; i += uuid_len) {
+    const uint8_t* p = field.data + i;
+    if (uuid_len == Uuid::kNumBytes16) {
+      uuids->push_back(Uuid::From16Bit(p[0] | (p[1] << 8)));
+    } else if (uuid_len == Uuid::kNumBytes32) {
+      uuids->push_back(Uuid::From32Bit(p[0] | (p[1] << 8) | (p[2] << 16) |
+                                       ((uint32_t)p[3] << 24)));
+    } else {
+      uuids->push_back(Uuid::From128BitLE(p));
+    }
+  }
+}
+
+void parse_report(const uint8_t* data, size_t len, ParsedReport* report) {
+  for (const auto& field : AdvertiseDataParser::Fields(data, len)) {
+    switch (field.type) {
+      case BT_EIR_MORE_16BITS_UUID_TYPE:
+      case BT_EIR_COMPLETE_16BITS_UUID_TYPE:
+        add_uuids(&report->srvc_uuids, field, Uuid::kNumBytes16);
+        break;
+      case BT_EIR_MORE_32BITS_UUID_TYPE:
+      case BT_EIR_COMPLETE_32BITS_UUID_TYPE:
+        add_uuids(&report->srvc_uuids, field, Uuid::kNumBytes32);
+        break;
+      case BT_EIR_MORE_128BITS_UUID_TYPE:
+      case BT_EIR_COMPLETE_128BITS_UUID_TYPE:
+        add_uuids(&report->srvc_uuids, field, Uuid::kNumBytes128);
+        break;
+      case BTM_BLE_AD_SOL_16BITS_UUID_TYPE:
+        add_uuids(&report->sol_uuids, field, Uuid::kNumBytes16);
+        break;
+      case BTM_BLE_AD_SOL_32BITS_UUID_TYPE:
+        add_uuids(&report->sol_uuids, field, Uuid::kNumBytes32);
+        break;
+      case BTM_BLE_AD_SOL_128BITS_UUID_TYPE:
+        add_uuids(&report->sol_uuids, field, Uuid::kNumBytes128);
+        break;
+      case BT_EIR_COMPLETE_LOCAL_NAME_TYPE:
+        report->name = field.data;
+        report->name_len = field.length;
+        report->name_complete = true;
+        break;
+      case BT_EIR_SHORTENED_LOCAL_NAME_TYPE:
+        /* The complete name is preferred over the shortened one */
+        if (!report->name_complete) {
+          report->name = field.data;
+          report->name_len = field.length;
+        }
+        break;
+      case BT_EIR_MANUFACTURER_SPECIFIC_TYPE:
+        report->manu_data.push_back(field);
+        break;
+      case BT_EIR_SERVICE_DATA_16BITS_UUID_TYPE:
+      case BT_EIR_SERVICE_DATA_32BITS_UUID_TYPE:
+      case BT_EIR_SERVICE_DATA_128BITS_UUID_TYPE:
+        report->srvc_data.push_back(field);
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+bool pattern_matches(const Condition& cond, const uint8_t* data, size_t len) {
+  if (len < cond.pattern_len) return false;
+  const uint8_t* pattern = &program.patterns[cond.pattern_offset];
+  const uint8_t* mask = pattern + cond.pattern_len;
+  for (uint8_t i = 0; i < cond.pattern_len; i++) {
+    if ((data[i] & mask[i]) != (pattern[i] & mask[i])) return false;
+  }
+  return true;
+}
+
+bool uuid_matches(const Condition& cond, const Uuid& uuid) {
+  size_t uuid_len = uuid.GetShortestRepresentationSize();
+  if (cond.uuid_len == Uuid::kNumBytes128) {
+    if (uuid_len != Uuid::kNumBytes128) return false;
+    const Uuid::UUID128Bit& a = uuid.To128BitBE();
+    const Uuid::UUID128Bit& b = cond.uuid.To128BitBE();
+    for (size_t i = 0; i < Uuid::kNumBytes128; i++) {
+      if ((a[i] & cond.uuid_mask[i]) != (b[i] & cond.uuid_mask[i]))
+        return false;
+    }
+    return true;
+  }
+  if (uuid_len == Uuid::kNumBytes128) return false;
+  return (uuid.As32Bit() & cond.uuid32_mask) == cond.uuid32;
+}
+
+bool condition_matches(const Condition& cond, const RawAddress& bda,
+                       const ParsedReport& report) {
+  switch (cond.type) {
+    case BTM_BLE_PF_ADDR_FILTER:
+      return cond.address == bda;
+
+    case BTM_BLE_PF_SRVC_DATA:
+      return !report.srvc_data.empty();
+
+    case BTM_BLE_PF_SRVC_UUID:
+      for (const Uuid& uuid : report.srvc_uuids) {
+        if (uuid_matches(cond, uuid)) return true;
+      }
+      return false;
+
+    case BTM_BLE_PF_SRVC_SOL_UUID:
+      for (const Uuid& uuid : report.sol_uuids) {
+        if (uuid_matches(cond, uuid)) return true;
+      }
+      return false;
+
+    case BTM_BLE_PF_LOCAL_NAME: {
+      if (!report.name) return false;
+      const uint8_t* name = &program.patterns[cond.pattern_offset];
+      /* A shortened name matches the start of the name filtered on */
+      if (report.name_complete) {
+        return report.name_len == cond.pattern_len &&
+               memcmp(report.name, name, cond.pattern_len) == 0;
+      }
+      return report.name_len <= cond.pattern_len &&
+             memcmp(report.name, name, report.name_len) == 0;
+    }
+
+    case BTM_BLE_PF_MANU_DATA:
+      for (const auto& field : report.manu_data) {
+        if (field.length < 2) continue;
+        uint16_t company = field.data[0] | (field.data[1] << 8);
+        if ((company & cond.company_mask) !=
+            (cond.company & cond.company_mask)) {
+          continue;
+        }
+        if (pattern_matches(cond, field.data + 2, field.length - 2))
+          return true;
+      }
+      return false;
+
+    case BTM_BLE_PF_SRVC_DATA_PATTERN:
+      for (const auto& field : report.srvc_data) {
+        if (pattern_matches(cond, field.data, field.length)) return true;
+      }
+      return false;
+
+    default:
+      return false;
+  }
+}
+
+bool filter_matches(const CompiledFilter& filter, int8_t rssi,
+                    const ConditionSet& matched) {
+  if (rssi < filter.rssi_high_thres) return false;
+
+  bool any_feature = false;
+  for (uint8_t type = 0; type < BTM_BLE_PF_TYPE_ALL; type++) {
+    if (!(filter.feat_seln & (1 << type))) continue;
+    any_feature = true;
+
+    /* A selected feature without any condition matches nothing */
+    const std::vector<uint16_t>& conditions = filter.conditions[type];
+    bool feature_matches;
+    if (filter.list_logic_type & (1 << type)) {
+      feature_matches =
+          !conditions.empty() &&
+          std::all_of(conditions.begin(), conditions.end(),
+                      [&matched](uint16_t id) { return matched[id]; });
+    } else {
+      feature_matches =
+          std::any_of(conditions.begin(), conditions.end(),
+                      [&matched](uint16_t id) { return matched[id]; });
+    }
+
+    if (filter.filt_logic_type == BTM_BLE_PF_LOGIC_AND && !feature_matches)
+      return false;
+    if (filter.filt_logic_type != BTM_BLE_PF_LOGIC_AND && feature_matches)
+      return true;
+  }
+
+  /* A filter selecting no feature lets everything through */
+  return !any_feature || filter.filt_logic_type == BTM_BLE_PF_LOGIC_AND;
+}
+
+void mark_indexed(const std::unordered_map<Uuid, std::vector<uint16_t>>& index,
+                  const std::vector<Uuid>& uuids, ConditionSet* matched) {
+  if (index.empty()) return;
+  for (const Uuid& uuid : uuids) {
+    auto it = index.find(uuid);
+    if (it == index.end()) continue;
+    for (uint16_t id : it->second) matched->set(id);
+  }
+}
+
+}  // namespace
+
+/*******************************************************************************
+ *
+ * Function         btm_ble_host_filter_init
+ *
+ * Description      Drops all host side scan filters, and turns the host side
+ *                  filtering on if the system property asks for it.
+ *
+ ******************************************************************************/
+void btm_ble_host_filter_init(void) {
+  host_filter_on = osi_property_get_bool(BTM_BLE_HOST_PF_PROPERTY, false);
+  host_filter_enabled = false;
+  host_filters.clear();
+  program = Program();
+  program_dirty = true;
+}
+
+bool btm_ble_host_filter_is_on(void) { return host_filter_on; }
+
+uint8_t BTM_BleHostFilterMaxFilters(void) {
+  return host_filter_on ? BTM_BLE_HOST_PF_MAX_FILTERS : 0;
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_ble_host_filter_add
+ *
+ * Description      Adds the conditions of |commands| to the filter
+ *                  |filt_index|.
+ *
+ * Returns          false if |filt_index| is out of range.
+ *
+ ******************************************************************************/
+bool btm_ble_host_filter_add(tBTM_BLE_PF_FILT_INDEX filt_index,
+                             const std::vector<ApcfCommand>& commands) {
+  if (filt_index >= BTM_BLE_HOST_PF_MAX_FILTERS) return false;
+
+  HostFilter& filter = host_filters[filt_index];
+  for (const ApcfCommand& cmd : commands) {
+    /* If data is passed, both mask and data have to be the same length */
+    if (cmd.data.size() != cmd.data_mask.size() && cmd.data.size() != 0 &&
+        cmd.data_mask.size() != 0) {
+      LOG(ERROR) << __func__ << " data(" << cmd.data.size() << ") and mask("
+                 << cmd.data_mask.size() << ") are of different size";
+      continue;
+    }
+    filter.commands.push_back(cmd);
+  }
+  program_dirty = true;
+  return true;
+}
+
+/* Removes the conditions of the filter |filt_index|, keeping its parameters */
+void btm_ble_host_filter_clear(tBTM_BLE_PF_FILT_INDEX filt_index) {
+  auto it = host_filters.find(filt_index);
+  if (it == host_filters.end()) return;
+  it->second.commands.clear();
+  program_dirty = true;
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_ble_host_filter_set_params
+ *
+ * Description      Adds, deletes or clears the parameters of filters, as
+ *                  BTM_BleAdvFilterParamSetup does in the controller. Only the
+ *                  filters with parameters are run.
+ *
+ * Returns          The number of filters still available.
+ *
+ ******************************************************************************/
+uint8_t btm_ble_host_filter_set_params(
+    int action, tBTM_BLE_PF_FILT_INDEX filt_index,
+    const btgatt_filt_param_setup_t* p_filt_params) {
+  if (action == BTM_BLE_SCAN_COND_CLEAR) {
+    host_filters.clear();
+  } else if (action == BTM_BLE_SCAN_COND_DELETE) {
+    host_filters.erase(filt_index);
+  } else if (action == BTM_BLE_SCAN_COND_ADD && p_filt_params &&
+             filt_index < BTM_BLE_HOST_PF_MAX_FILTERS) {
+    HostFilter& filter = host_filters[filt_index];
+    filter.has_params = true;
+    filter.feat_seln = p_filt_params->feat_seln;
+    filter.list_logic_type = p_filt_params->list_logic_type;
+    filter.filt_logic_type = p_filt_params->filt_logic_type;
+    filter.rssi_high_thres = (int8_t)p_filt_params->rssi_high_thres;
+  }
+  program_dirty = true;
+
+  uint8_t in_use = std::count_if(
+      host_filters.begin(), host_filters.end(),
+      [](const std::pair<const uint8_t, HostFilter>& entry) {
+        return entry.second.has_params;
+      });
+  return BTM_BLE_HOST_PF_MAX_FILTERS - in_use;
+}
+
+/* Starts, or stops, holding back the advertising reports */
+void btm_ble_host_filter_enable(bool enable) { host_filter_enabled = enable; }
+
+/*******************************************************************************
+ *
+ * Function         btm_ble_host_filter_match
+ *
+ * Description      Runs the host side scan filters on a complete advertising
+ *                  report.
+ *
+ * Returns          true if the report is to be delivered: it matches one of
+ *                  the filters, or the host side filtering is not enabled.
+ *
+ ******************************************************************************/
+bool btm_ble_host_filter_match(const RawAddress& bda, int8_t rssi,
+                               const uint8_t* data, size_t len) {
+  if (!host_filter_on || !host_filter_enabled) return true;
+
+  if (program_dirty) compile_program();
+  if (program.filters.empty()) return false;
+
+  ParsedReport report;
+  parse_report(data, len, &report);
+
+  ConditionSet matched;
+  mark_indexed(program.srvc_uuids, report.srvc_uuids, &matched);
+  mark_indexed(program.sol_uuids, report.sol_uuids, &matched);
+  if (!program.companies.empty()) {
+    for (const auto& field : report.manu_data) {
+      if (field.length < 2) continue;
+      auto it = program.companies.find(field.data[0] | (field.data[1] << 8));
+      if (it == program.companies.end()) continue;
+      for (uint16_t id : it->second) {
+        const Condition& cond = program.conditions[id];
+        if (pattern_matches(cond, field.data + 2, field.length - 2))
+          matched.set(id);
+      }
+    }
+  }
+  for (uint16_t id : program.linear) {
+    if (condition_matches(program.conditions[id], bda, report))
+      matched.set(id);
+  }
+
+  for (const CompiledFilter& filter : program.filters) {
+    if (filter_matches(filter, rssi, matched)) return true;
+  }
+  return false;
+}
@@ -167,6 +167,7 @@ extern bool btm_ble_disable_resolving_list(uint8_t rl_mask, bool to_resume);
 extern void btm_ble_enable_resolving_list_for_platform(uint8_t rl_mask);
 extern void btm_ble_resolving_list_init(uint8_t max_irk_list_sz);
 extern void btm_ble_resolving_list_cleanup(void);
+extern void btm_ble_resolving_list_dump(int fd);
 #endif
 
 extern void btm_ble_adv_init(void);
@@ -176,6 +177,22 @@ extern void btm_ble_batchscan_init(void);
 extern void btm_ble_batchscan_cleanup(void);
 extern void btm_ble_adv_filter_init(void);
 extern void btm_ble_adv_filter_cleanup(void);
+
+/* Internal functions provided by btm_ble_host_filter.cc
+ *******************************************************
+*/
+extern void btm_ble_host_filter_init(void);
+extern bool btm_ble_host_filter_is_on(void);
+extern bool btm_ble_host_filter_add(tBTM_BLE_PF_FILT_INDEX filt_index,
+                                    const std::vector<ApcfCommand>& commands);
+extern void btm_ble_host_filter_clear(tBTM_BLE_PF_FILT_INDEX filt_index);
+extern uint8_t btm_ble_host_filter_set_params(
+    int action, tBTM_BLE_PF_FILT_INDEX filt_index,
+    const btgatt_filt_param_setup_t* p_filt_params);
+extern void btm_ble_host_filter_enable(bool enable);
+extern bool btm_ble_host_filter_match(const RawAddress& bda, int8_t rssi,
+                                      const uint8_t* data, size_t len);
+
 extern bool btm_ble_topology_check(tBTM_BLE_STATE_MASK request);
 extern bool btm_ble_clear_topology_mask(tBTM_BLE_STATE_MASK request_state);
 extern bool btm_ble_set_topology_mask(tBTM_BLE_STATE_MASK request_state);
@@ -61,7 +61,6 @@ struct AdvertisingInstance {
   uint8_t inst_id;
   bool in_use;
   uint8_t advertising_event_properties;
-  alarm_t* adv_raddr_timer;
   int8_t tx_power;
   uint16_t duration;  // 1 unit is 10ms
   uint8_t maxExtAdvEvents;
@@ -100,13 +99,9 @@ struct AdvertisingInstance {
         own_address(RawAddress::kEmpty),
         address_update_required(false),
         periodic_enabled(false),
-        enable_status(false) {
-    adv_raddr_timer = alarm_new_periodic("btm_ble.adv_raddr_timer");
-  }
+        enable_status(false) {}
 
   ~AdvertisingInstance() {
-    alarm_free(adv_raddr_timer);
-    adv_raddr_timer = nullptr;
     if (timeout_timer) {
       alarm_free(timeout_timer);
       timeout_timer = nullptr;
@@ -166,12 +161,16 @@ class BleAdvertisingManagerImpl
  public:
   BleAdvertisingManagerImpl(BleAdvertiserHciInterface* interface)
       : hci_interface(interface), weak_factory_(this) {
+    adv_raddr_timer = alarm_new_periodic("btm_ble.adv_raddr_timer");
     hci_interface->ReadInstanceCount(
         base::Bind(&BleAdvertisingManagerImpl::ReadInstanceCountCb,
                    weak_factory_.GetWeakPtr()));
   }
 
-  ~BleAdvertisingManagerImpl() override { adv_inst.clear(); }
+  ~BleAdvertisingManagerImpl() override {
+    adv_inst.clear();
+    alarm_free(adv_raddr_timer);
+  }
 
   void GetOwnAddress(uint8_t inst_id, GetAddressCallback cb) override {
     cb.Run(adv_inst[inst_id].own_address_type, adv_inst[inst_id].own_address);
@@ -238,6 +237,112 @@ class BleAdvertisingManagerImpl
         p_inst, std::move(configuredCb)));
   }
 
+  /* All sets with a random address share one rotation timer, so their
+   * addresses are updated together */
+  void StartRpaRotation() {
+    if (rpa_rotation_started) return;
+
+    rpa_rotation_started = true;
+    alarm_set_on_mloop(adv_raddr_timer,
+                       btm_get_next_private_addrress_interval_ms(),
+                       btm_ble_adv_raddr_timer_timeout, nullptr);
+  }
+
+  void StopRpaRotation() {
+    rpa_rotation_started = false;
+    alarm_cancel(adv_raddr_timer);
+  }
+
+  /* Gives a new RPA to all sets that use a random address. The connectable
+   * sets that advertise are disabled for the update all at once, instead of
+   * one set at a time. */
+  void RotateRpas() {
+    std::vector<uint8_t> inst_ids;
+    for (AdvertisingInstance& inst : adv_inst) {
+      if (!inst.in_use || inst.own_address_type != BLE_ADDR_RANDOM) continue;
+
+      // Same as in ConfigureRpa, sets with a timeout update their address
+      // when they stop
+      if (inst.IsEnabled() && inst.IsConnectable() &&
+          (inst.duration || inst.maxExtAdvEvents)) {
+        inst.address_update_required = true;
+        continue;
+      }
+      inst_ids.push_back(inst.inst_id);
+    }
+
+    if (inst_ids.empty()) return;
+    GenerateRpas(std::move(inst_ids), {});
+  }
+
+  void GenerateRpas(std::vector<uint8_t> inst_ids,
+                    std::vector<RawAddress> rpas) {
+    if (rpas.size() == inst_ids.size()) {
+      UpdateRpas(inst_ids, rpas);
+      return;
+    }
+
+    GenerateRpa(Bind(&BleAdvertisingManagerImpl::OnRpaGenerated,
+                     weak_factory_.GetWeakPtr(), std::move(inst_ids),
+                     std::move(rpas)));
+  }
+
+  void OnRpaGenerated(std::vector<uint8_t> inst_ids,
+                      std::vector<RawAddress> rpas, const RawAddress& bda) {
+    rpas.push_back(bda);
+    GenerateRpas(std::move(inst_ids), std::move(rpas));
+  }
+
+  void UpdateRpas(const std::vector<uint8_t>& inst_ids,
+                  const std::vector<RawAddress>& rpas) {
+    /* Connectable advertising set must be disabled when updating RPA */
+    std::vector<SetEnableData> restart;
+    for (uint8_t inst_id : inst_ids) {
+      AdvertisingInstance* p_inst = &adv_inst[inst_id];
+      if (!p_inst->in_use || !p_inst->IsEnabled() || !p_inst->IsConnectable())
+        continue;
+
+      p_inst->enable_status = false;
+      restart.emplace_back(SetEnableData{.handle = inst_id});
+    }
+    if (!restart.empty()) EnableSets(false, restart);
+
+    for (size_t i = 0; i < inst_ids.size(); i++) {
+      AdvertisingInstance* p_inst = &adv_inst[inst_ids[i]];
+      if (!p_inst->in_use) continue;
+
+      /* set it to controller */
+      GetHciInterface()->SetRandomAddress(
+          p_inst->inst_id, rpas[i],
+          Bind(
+              [](AdvertisingInstance* p_inst, RawAddress bda, uint8_t status) {
+                p_inst->own_address = bda;
+              },
+              p_inst, rpas[i]));
+    }
+
+    if (!restart.empty()) {
+      for (const SetEnableData& set : restart)
+        adv_inst[set.handle].enable_status = true;
+      EnableSets(true, restart);
+    }
+  }
+
+  /* Enables or disables |sets| with as few commands as the controller
+   * allows */
+  void EnableSets(bool enable, const std::vector<SetEnableData>& sets) {
+    if (GetHciInterface()->SupportsMultipleSetEnable()) {
+      GetHciInterface()->Enable(enable, sets, base::DoNothing());
+      return;
+    }
+
+    for (const SetEnableData& set : sets) {
+      GetHciInterface()->Enable(enable, set.handle, set.duration,
+                                set.max_extended_advertising_events,
+                                base::DoNothing());
+    }
+  }
+
   void RegisterAdvertiser(
       base::Callback<void(uint8_t /* inst_id */, uint8_t /* status */)> cb)
       override {
@@ -257,9 +362,8 @@ class BleAdvertisingManagerImpl
                const RawAddress& bda) {
               p_inst->own_address = bda;
 
-              alarm_set_on_mloop(p_inst->adv_raddr_timer,
-                                 btm_get_next_private_addrress_interval_ms(),
-                                 btm_ble_adv_raddr_timer_timeout, p_inst);
+              if (instance_weakptr.get())
+                instance_weakptr.get()->StartRpaRotation();
               cb.Run(p_inst->inst_id, BTM_BLE_MULTI_ADV_SUCCESS);
             },
             p_inst, cb));
@@ -868,10 +972,16 @@ class BleAdvertisingManagerImpl
                                                       base::DoNothing());
     }
 
-    alarm_cancel(p_inst->adv_raddr_timer);
     p_inst->in_use = false;
     GetHciInterface()->RemoveAdvertisingSet(inst_id, base::DoNothing());
     p_inst->address_update_required = false;
+
+    bool random_address_in_use = false;
+    for (const AdvertisingInstance& inst : adv_inst) {
+      if (inst.in_use && inst.own_address_type == BLE_ADDR_RANDOM)
+        random_address_in_use = true;
+    }
+    if (!random_address_in_use) StopRpaRotation();
   }
 
   void RecomputeTimeout(AdvertisingInstance* inst, TimeTicks now) {
@@ -913,8 +1023,7 @@ class BleAdvertisingManagerImpl
       sets.emplace_back(SetEnableData{.handle = inst.inst_id});
     }
 
-    if (!sets.empty())
-      GetHciInterface()->Enable(false, sets, base::DoNothing());
+    if (!sets.empty()) EnableSets(false, sets);
   }
 
   void Resume() override {
@@ -929,7 +1038,7 @@ class BleAdvertisingManagerImpl
       }
     }
 
-    if (!sets.empty()) GetHciInterface()->Enable(true, sets, base::DoNothing());
+    if (!sets.empty()) EnableSets(true, sets);
   }
 
   void OnAdvertisingSetTerminated(
@@ -990,10 +1099,8 @@ class BleAdvertisingManagerImpl
       if (p_inst->timeout_timer) {
         alarm_cancel(p_inst->timeout_timer);
       }
-      if (p_inst->adv_raddr_timer) {
-        alarm_cancel(p_inst->adv_raddr_timer);
-      }
     }
+    StopRpaRotation();
   }
 
  private:
@@ -1002,6 +1109,8 @@ class BleAdvertisingManagerImpl
   BleAdvertiserHciInterface* hci_interface = nullptr;
   std::vector<AdvertisingInstance> adv_inst;
   uint8_t inst_count;
+  alarm_t* adv_raddr_timer = nullptr;
+  bool rpa_rotation_started = false;
 
   // Member variables should appear before the WeakPtrFactory, to ensure
   // that any WeakPtrs are invalidated before its members
@@ -1011,7 +1120,7 @@ class BleAdvertisingManagerImpl
 
 void btm_ble_adv_raddr_timer_timeout(void* data) {
   BleAdvertisingManagerImpl* ptr = instance_weakptr.get();
-  if (ptr) ptr->ConfigureRpa((AdvertisingInstance*)data, base::DoNothing());
+  if (ptr) ptr->RotateRpas();
 }
 }  // namespace
 
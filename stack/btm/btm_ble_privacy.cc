@@ -21,7 +21,12 @@
  *  This file contains functions for BLE controller based privacy.
  *
  ******************************************************************************/
+#include <base/bind.h>
+#include <inttypes.h>
+#include <stdio.h>
 #include <string.h>
+#include <algorithm>
+#include <map>
 #include "bt_target.h"
 
 #if (BLE_PRIVACY_SPT == TRUE)
@@ -29,6 +34,7 @@
 #include "bt_types.h"
 #include "btm_int.h"
 #include "btu.h"
+#include "common/time_util.h"
 #include "device/include/controller.h"
 #include "hcimsgs.h"
 #include "vendor_hcidefs.h"
@@ -48,6 +54,45 @@
 #define BTM_BLE_META_READ_IRK_LEN 2
 #define BTM_BLE_META_ADD_WL_ATTR_LEN 9
 
+/* Delay before the changes of the resolving list are sent to the controller,
+ * for the changes made meanwhile, such as the keys of all bonded devices
+ * loaded at start up, to be sent within the same suspend window */
+#define BTM_BLE_RL_SYNC_DELAY_MS 10
+
+namespace {
+
+/* Change of the resolving list not sent to the controller yet. A device
+ * removed then added again has its old entry removed first, by the identity
+ * address it was added with. */
+struct ResolvingListChange {
+  bool remove;
+  uint8_t identity_addr_type;
+  RawAddress identity_addr;
+  bool add;
+};
+
+struct ResolvingListSyncStats {
+  uint64_t windows;
+  uint64_t changes;
+  uint64_t cancelled_changes;
+  uint64_t commands;
+  uint64_t max_commands;
+  uint64_t total_suspend_ms;
+  uint64_t max_suspend_ms;
+};
+
+/* Pending changes, by pseudo address */
+std::map<RawAddress, ResolvingListChange> rl_changes;
+bool rl_sync_scheduled = false;
+/* Start of the suspend window whose commands are still in progress, 0 if
+ * there is none */
+uint64_t rl_window_start_ms = 0;
+ResolvingListSyncStats rl_sync_stats = {};
+
+}  // namespace
+
+static void btm_ble_resolving_list_window_cmpl(void);
+
 /*******************************************************************************
  *         Functions implemented controller based privacy using Resolving List
  ******************************************************************************/
@@ -274,6 +319,7 @@ void btm_ble_add_resolving_list_entry_complete(uint8_t* p, uint16_t evt_len) {
     BTM_TRACE_DEBUG("no pending resolving list operation");
     return;
   }
+  btm_ble_resolving_list_window_cmpl();
 
   if (status == HCI_SUCCESS) {
     /* privacy 1.2 command complete does not have these extra byte */
@@ -314,6 +360,7 @@ void btm_ble_remove_resolving_list_entry_complete(uint8_t* p,
     BTM_TRACE_ERROR("%s no pending resolving list operation", __func__);
     return;
   }
+  btm_ble_resolving_list_window_cmpl();
 
   if (status == HCI_SUCCESS) {
     /* proprietary: spec does not have these extra bytes */
@@ -347,6 +394,7 @@ void btm_ble_read_resolving_list_entry_complete(uint8_t* p, uint16_t evt_len) {
     BTM_TRACE_ERROR("no pending resolving list operation");
     return;
   }
+  btm_ble_resolving_list_window_cmpl();
 
   if (status == HCI_SUCCESS) {
     /* proprietary spec has extra bytes */
@@ -403,35 +451,36 @@ void btm_ble_resolving_list_vsc_op_cmpl(tBTM_VSC_CMPL* p_params) {
  *
  * Description      This function to remove an IRK entry from the list
  *
- * Parameters       ble_addr_type: address type
- *                  ble_addr: LE adddress
+ * Parameters       pseudo_bda: pseudo address of the device
+ *                  identity_addr_type: address type of the entry
+ *                  identity_addr: identity address of the entry
  *
  * Returns          status
  *
  ******************************************************************************/
-tBTM_STATUS btm_ble_remove_resolving_list_entry(tBTM_SEC_DEV_REC* p_dev_rec) {
+static tBTM_STATUS btm_ble_remove_resolving_list_entry(
+    const RawAddress& pseudo_bda, uint8_t identity_addr_type,
+    const RawAddress& identity_addr) {
   /* if controller does not support RPA offloading or privacy 1.2, skip */
   if (controller_get_interface()->get_ble_resolving_list_max_size() == 0)
     return BTM_WRONG_MODE;
 
   if (controller_get_interface()->supports_ble_privacy()) {
-    btsnd_hcic_ble_rm_device_resolving_list(p_dev_rec->ble.identity_addr_type,
-                                            p_dev_rec->ble.identity_addr);
+    btsnd_hcic_ble_rm_device_resolving_list(identity_addr_type, identity_addr);
   } else {
     uint8_t param[20] = {0};
     uint8_t* p = param;
 
     UINT8_TO_STREAM(p, BTM_BLE_META_REMOVE_IRK_ENTRY);
-    UINT8_TO_STREAM(p, p_dev_rec->ble.identity_addr_type);
-    BDADDR_TO_STREAM(p, p_dev_rec->ble.identity_addr);
+    UINT8_TO_STREAM(p, identity_addr_type);
+    BDADDR_TO_STREAM(p, identity_addr);
 
     BTM_VendorSpecificCommand(HCI_VENDOR_BLE_RPA_VSC,
                               BTM_BLE_META_REMOVE_IRK_LEN, param,
                               btm_ble_resolving_list_vsc_op_cmpl);
   }
 
-  btm_ble_enq_resolving_list_pending(p_dev_rec->bd_addr,
-                                     BTM_BLE_META_REMOVE_IRK_ENTRY);
+  btm_ble_enq_resolving_list_pending(pseudo_bda, BTM_BLE_META_REMOVE_IRK_ENTRY);
   return BTM_CMD_STARTED;
 }
 
@@ -662,12 +711,226 @@ bool btm_ble_disable_resolving_list(uint8_t rl_mask, bool to_resume) {
   return true;
 }
 
+/*******************************************************************************
+ *
+ * Function         btm_ble_add_resolving_list_entry
+ *
+ * Description      This function sends the command adding the IRK entry of a
+ *                  device to the resolving list.
+ *
+ * Parameters       p_dev_rec: device security record
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void btm_ble_add_resolving_list_entry(tBTM_SEC_DEV_REC* p_dev_rec) {
+  if (controller_get_interface()->supports_ble_privacy()) {
+    const Octet16& peer_irk = p_dev_rec->ble.keys.irk;
+    const Octet16& local_irk = btm_cb.devcb.id_keys.irk;
+
+    BTM_TRACE_DEBUG("%s: adding device %s to controller resolving list",
+                    __func__, p_dev_rec->ble.identity_addr.ToString().c_str());
+
+    // use identical IRK for now
+    btsnd_hcic_ble_add_device_resolving_list(p_dev_rec->ble.identity_addr_type,
+                                             p_dev_rec->ble.identity_addr,
+                                             peer_irk, local_irk);
+
+    if (controller_get_interface()->supports_ble_set_privacy_mode()) {
+      BTM_TRACE_DEBUG("%s: adding device privacy mode", __func__);
+      btsnd_hcic_ble_set_privacy_mode(p_dev_rec->ble.identity_addr_type,
+                                      p_dev_rec->ble.identity_addr, 0x01);
+    }
+  } else {
+    uint8_t param[40] = {0};
+    uint8_t* p = param;
+
+    UINT8_TO_STREAM(p, BTM_BLE_META_ADD_IRK_ENTRY);
+    ARRAY_TO_STREAM(p, p_dev_rec->ble.keys.irk, OCTET16_LEN);
+    UINT8_TO_STREAM(p, p_dev_rec->ble.identity_addr_type);
+    BDADDR_TO_STREAM(p, p_dev_rec->ble.identity_addr);
+
+    BTM_VendorSpecificCommand(HCI_VENDOR_BLE_RPA_VSC, BTM_BLE_META_ADD_IRK_LEN,
+                              param, btm_ble_resolving_list_vsc_op_cmpl);
+  }
+
+  btm_ble_enq_resolving_list_pending(p_dev_rec->bd_addr,
+                                     BTM_BLE_META_ADD_IRK_ENTRY);
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_ble_resolving_list_pending_cmds
+ *
+ * Description      Number of resolving list commands waiting for their
+ *                  command complete in the resolving pending operation queue
+ *
+ ******************************************************************************/
+static uint8_t btm_ble_resolving_list_pending_cmds(void) {
+  tBTM_BLE_RESOLVE_Q* p_q = &btm_cb.ble_ctr_cb.resolving_list_pend_q;
+  uint8_t max_size =
+      controller_get_interface()->get_ble_resolving_list_max_size();
+
+  return (p_q->q_next + max_size - p_q->q_pending) % max_size;
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_ble_resolving_list_pending_adds
+ *
+ * Description      Number of devices to be added to the resolving list by
+ *                  the next sync
+ *
+ ******************************************************************************/
+static uint8_t btm_ble_resolving_list_pending_adds(void) {
+  uint8_t count = 0;
+  for (const auto& change : rl_changes) {
+    if (change.second.add) count++;
+  }
+  return count;
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_ble_resolving_list_window_cmpl
+ *
+ * Description      Called when a resolving list command completes, closes the
+ *                  suspend window once all its commands have completed.
+ *
+ ******************************************************************************/
+static void btm_ble_resolving_list_window_cmpl(void) {
+  if (rl_window_start_ms == 0 || btm_ble_resolving_list_pending_cmds() != 0)
+    return;
+
+  uint64_t duration_ms =
+      bluetooth::common::time_get_os_boottime_ms() - rl_window_start_ms;
+  rl_window_start_ms = 0;
+
+  rl_sync_stats.total_suspend_ms += duration_ms;
+  rl_sync_stats.max_suspend_ms =
+      std::max(rl_sync_stats.max_suspend_ms, duration_ms);
+  BTM_TRACE_DEBUG("%s: resolving list synced in %" PRIu64 " ms", __func__,
+                  duration_ms);
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_ble_resolving_list_sync
+ *
+ * Description      Sends the pending changes of the resolving list to the
+ *                  controller, suspending address resolution, scan,
+ *                  advertising and background connection once for all of
+ *                  them. Removals are sent first, to make room for the
+ *                  additions. Changes that do not fit in the resolving
+ *                  pending operation queue are left for another sync.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void btm_ble_resolving_list_sync(void);
+
+static void btm_ble_resolving_list_post_sync(void) {
+  rl_sync_scheduled = true;
+  do_in_main_thread_delayed(
+      FROM_HERE, base::BindOnce(&btm_ble_resolving_list_sync),
+      base::TimeDelta::FromMilliseconds(BTM_BLE_RL_SYNC_DELAY_MS));
+}
+
+static void btm_ble_resolving_list_sync(void) {
+  rl_sync_scheduled = false;
+
+  uint8_t max_size =
+      controller_get_interface()->get_ble_resolving_list_max_size();
+  if (max_size == 0 || rl_changes.empty()) {
+    rl_changes.clear();
+    return;
+  }
+
+  const uint8_t rl_state = btm_cb.ble_ctr_cb.rl_state;
+  if (rl_state && !btm_ble_disable_resolving_list(rl_state, false)) {
+    LOG(WARNING) << __func__ << ": unable to suspend resolving list activity";
+    btm_ble_resolving_list_post_sync();
+    return;
+  }
+
+  if (rl_window_start_ms == 0)
+    rl_window_start_ms = bluetooth::common::time_get_os_boottime_ms();
+  rl_sync_stats.windows++;
+
+  /* the queue is seen as empty when full, keep one slot free */
+  int room = max_size - 1 - btm_ble_resolving_list_pending_cmds();
+  uint64_t commands = 0;
+  bool added = false;
+
+  for (auto& change : rl_changes) {
+    if (room <= 0) break;
+    if (!change.second.remove) continue;
+    btm_ble_remove_resolving_list_entry(change.first,
+                                        change.second.identity_addr_type,
+                                        change.second.identity_addr);
+    change.second.remove = false;
+    commands++;
+    room--;
+  }
+
+  for (auto it = rl_changes.begin(); it != rl_changes.end();) {
+    ResolvingListChange& change = it->second;
+    if (change.add && !change.remove && room > 0) {
+      tBTM_SEC_DEV_REC* p_dev_rec = btm_find_dev(it->first);
+      if (p_dev_rec != NULL &&
+          (p_dev_rec->ble.in_controller_list & BTM_RESOLVING_LIST_BIT)) {
+        btm_ble_add_resolving_list_entry(p_dev_rec);
+        commands++;
+        room--;
+        added = true;
+      }
+      change.add = false;
+    }
+
+    if (!change.add && !change.remove)
+      it = rl_changes.erase(it);
+    else
+      ++it;
+  }
+
+  rl_sync_stats.commands += commands;
+  rl_sync_stats.max_commands = std::max(rl_sync_stats.max_commands, commands);
+  BTM_TRACE_DEBUG("%s: %" PRIu64 " commands sent, %zu changes left", __func__,
+                  commands, rl_changes.size());
+
+  /* if resolving list has been turned on, re-enable it */
+  if (rl_state)
+    btm_ble_enable_resolving_list(rl_state);
+  else if (added)
+    btm_ble_enable_resolving_list(BTM_BLE_RL_INIT);
+
+  /* nothing in flight, e.g. all additions were undone meanwhile */
+  btm_ble_resolving_list_window_cmpl();
+
+  if (!rl_changes.empty()) btm_ble_resolving_list_post_sync();
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_ble_resolving_list_schedule_sync
+ *
+ * Description      Makes sure the pending changes of the resolving list are
+ *                  sent to the controller shortly.
+ *
+ ******************************************************************************/
+static void btm_ble_resolving_list_schedule_sync(void) {
+  rl_sync_stats.changes++;
+  if (!rl_sync_scheduled) btm_ble_resolving_list_post_sync();
+}
+
 /*******************************************************************************
  *
  * Function         btm_ble_resolving_list_load_dev
  *
  * Description      This function adds a device which is using RPA into the
- *                  white list.
+ *                  white list. The controller is updated by the next sync of
+ *                  the resolving list, along with the other changes made
+ *                  until then.
  *
  * Parameters       pointer to device security record
  *
@@ -675,8 +938,6 @@ bool btm_ble_disable_resolving_list(uint8_t rl_mask, bool to_resume) {
  *
  ******************************************************************************/
 bool btm_ble_resolving_list_load_dev(tBTM_SEC_DEV_REC* p_dev_rec) {
-  const uint8_t rl_state = btm_cb.ble_ctr_cb.rl_state;
-
   if (controller_get_interface()->get_ble_resolving_list_max_size() == 0) {
     BTM_TRACE_DEBUG(
         "%s: Controller does not support RPA offloading or privacy 1.2",
@@ -712,59 +973,20 @@ bool btm_ble_resolving_list_load_dev(tBTM_SEC_DEV_REC* p_dev_rec) {
     return true;
   }
 
-  if (btm_cb.ble_ctr_cb.resolving_list_avail_size == 0) {
-    return false;
-  }
-
-  if (rl_state && !btm_ble_disable_resolving_list(rl_state, false)) {
+  if (btm_cb.ble_ctr_cb.resolving_list_avail_size <=
+      btm_ble_resolving_list_pending_adds()) {
     return false;
   }
 
   btm_ble_update_resolving_list(p_dev_rec->bd_addr, true);
-  if (controller_get_interface()->supports_ble_privacy()) {
-    const Octet16& peer_irk = p_dev_rec->ble.keys.irk;
-    const Octet16& local_irk = btm_cb.devcb.id_keys.irk;
-
-    if (p_dev_rec->ble.identity_addr.IsEmpty()) {
-      p_dev_rec->ble.identity_addr = p_dev_rec->bd_addr;
-      p_dev_rec->ble.identity_addr_type = p_dev_rec->ble.ble_addr_type;
-    }
-
-    BTM_TRACE_DEBUG("%s: adding device %s to controller resolving list",
-                    __func__, p_dev_rec->ble.identity_addr.ToString().c_str());
-
-    // use identical IRK for now
-    btsnd_hcic_ble_add_device_resolving_list(p_dev_rec->ble.identity_addr_type,
-                                             p_dev_rec->ble.identity_addr,
-                                             peer_irk, local_irk);
-
-    if (controller_get_interface()->supports_ble_set_privacy_mode()) {
-      BTM_TRACE_DEBUG("%s: adding device privacy mode", __func__);
-      btsnd_hcic_ble_set_privacy_mode(p_dev_rec->ble.identity_addr_type,
-                                      p_dev_rec->ble.identity_addr, 0x01);
-    }
-  } else {
-    uint8_t param[40] = {0};
-    uint8_t* p = param;
-
-    UINT8_TO_STREAM(p, BTM_BLE_META_ADD_IRK_ENTRY);
-    ARRAY_TO_STREAM(p, p_dev_rec->ble.keys.irk, OCTET16_LEN);
-    UINT8_TO_STREAM(p, p_dev_rec->ble.identity_addr_type);
-    BDADDR_TO_STREAM(p, p_dev_rec->ble.identity_addr);
-
-    BTM_VendorSpecificCommand(HCI_VENDOR_BLE_RPA_VSC, BTM_BLE_META_ADD_IRK_LEN,
-                              param, btm_ble_resolving_list_vsc_op_cmpl);
+  if (controller_get_interface()->supports_ble_privacy() &&
+      p_dev_rec->ble.identity_addr.IsEmpty()) {
+    p_dev_rec->ble.identity_addr = p_dev_rec->bd_addr;
+    p_dev_rec->ble.identity_addr_type = p_dev_rec->ble.ble_addr_type;
   }
 
-  btm_ble_enq_resolving_list_pending(p_dev_rec->bd_addr,
-                                     BTM_BLE_META_ADD_IRK_ENTRY);
-
-  /* if resolving list has been turned on, re-enable it */
-  if (rl_state)
-    btm_ble_enable_resolving_list(rl_state);
-  else
-    btm_ble_enable_resolving_list(BTM_BLE_RL_INIT);
-
+  rl_changes[p_dev_rec->bd_addr].add = true;
+  btm_ble_resolving_list_schedule_sync();
   return true;
 }
 
@@ -772,7 +994,10 @@ bool btm_ble_resolving_list_load_dev(tBTM_SEC_DEV_REC* p_dev_rec) {
  *
  * Function         btm_ble_resolving_list_remove_dev
  *
- * Description      This function removes the device from resolving list
+ * Description      This function removes the device from resolving list. The
+ *                  entry is removed from the controller by the next sync of
+ *                  the resolving list, unless it has not been added to it
+ *                  yet.
  *
  * Parameters
  *
@@ -780,24 +1005,30 @@ bool btm_ble_resolving_list_load_dev(tBTM_SEC_DEV_REC* p_dev_rec) {
  *
  ******************************************************************************/
 void btm_ble_resolving_list_remove_dev(tBTM_SEC_DEV_REC* p_dev_rec) {
-  uint8_t rl_mask = btm_cb.ble_ctr_cb.rl_state;
-
   BTM_TRACE_EVENT("%s", __func__);
-  if (rl_mask) {
-    if (!btm_ble_disable_resolving_list(rl_mask, false)) return;
-  }
 
   if ((p_dev_rec->ble.in_controller_list & BTM_RESOLVING_LIST_BIT) &&
       !btm_ble_brcm_find_resolving_pending_entry(
           p_dev_rec->bd_addr, BTM_BLE_META_REMOVE_IRK_ENTRY)) {
     btm_ble_update_resolving_list(p_dev_rec->bd_addr, false);
-    btm_ble_remove_resolving_list_entry(p_dev_rec);
+
+    auto it = rl_changes.find(p_dev_rec->bd_addr);
+    if (it != rl_changes.end() && it->second.add) {
+      /* not in the controller yet, or removed there first already */
+      it->second.add = false;
+      if (!it->second.remove) rl_changes.erase(it);
+      rl_sync_stats.cancelled_changes++;
+      return;
+    }
+
+    ResolvingListChange& change = rl_changes[p_dev_rec->bd_addr];
+    change.remove = true;
+    change.identity_addr_type = p_dev_rec->ble.identity_addr_type;
+    change.identity_addr = p_dev_rec->ble.identity_addr;
+    btm_ble_resolving_list_schedule_sync();
   } else {
     BTM_TRACE_DEBUG("Device not in resolving list");
   }
-
-  /* if resolving list has been turned on, re-enable it */
-  if (rl_mask) btm_ble_enable_resolving_list(rl_mask);
 }
 
 /*******************************************************************************
@@ -904,6 +1135,9 @@ void btm_ble_resolving_list_init(uint8_t max_irk_list_sz) {
     BTM_TRACE_DEBUG("%s max_irk_list_sz = %d", __func__, max_irk_list_sz);
   }
 
+  rl_changes.clear();
+  rl_window_start_ms = 0;
+
   controller_get_interface()->set_ble_resolving_list_max_size(max_irk_list_sz);
   btm_ble_clear_resolving_list();
   btm_cb.ble_ctr_cb.resolving_list_avail_size = max_irk_list_sz;
@@ -929,5 +1163,35 @@ void btm_ble_resolving_list_cleanup(void) {
   controller_get_interface()->set_ble_resolving_list_max_size(0);
 
   osi_free_and_reset((void**)&btm_cb.ble_ctr_cb.irk_list_mask);
+
+  rl_changes.clear();
+  rl_window_start_ms = 0;
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_ble_resolving_list_dump
+ *
+ * Description      Dump the statistics of the resolving list syncs to |fd|.
+ *
+ ******************************************************************************/
+void btm_ble_resolving_list_dump(int fd) {
+  const ResolvingListSyncStats& stats = rl_sync_stats;
+
+  dprintf(fd, "  Resolving list:\n");
+  dprintf(fd, "    Size: %d, available: %d, pending changes: %zu\n",
+          controller_get_interface()->get_ble_resolving_list_max_size(),
+          btm_cb.ble_ctr_cb.resolving_list_avail_size, rl_changes.size());
+  dprintf(fd,
+          "    Changes: %" PRIu64 ", cancelled before sync: %" PRIu64 "\n",
+          stats.changes, stats.cancelled_changes);
+  dprintf(fd,
+          "    Suspend windows: %" PRIu64 ", commands: %" PRIu64
+          ", most commands in a window: %" PRIu64 "\n",
+          stats.windows, stats.commands, stats.max_commands);
+  dprintf(fd,
+          "    Suspended for: %" PRIu64 " ms, longest window: %" PRIu64
+          " ms\n",
+          stats.total_suspend_ms, stats.max_suspend_ms);
 }
 #endif
@@ -27,11 +27,14 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <unordered_map>
+
 #include "bt_common.h"
 #include "bt_types.h"
 #include "btm_api.h"
 #include "btm_int.h"
 #include "btu.h"
+#include "common/lru.h"
 #include "device/include/controller.h"
 #include "hcidefs.h"
 #include "hcimsgs.h"
@@ -39,6 +42,65 @@
 #include "main/shim/btm_api.h"
 #include "main/shim/shim.h"
 
+namespace {
+
+constexpr size_t kRpaCacheSize = 32;
+
+/* Device records keyed by bd_addr and ble.pseudo_addr. Record addresses are
+ * assigned directly in many places, so an entry is only a hint and is checked
+ * against the record before being used. Entries are dropped when the record
+ * is freed. */
+std::unordered_map<RawAddress, tBTM_SEC_DEV_REC*> dev_rec_by_addr;
+
+/* Recently resolved RPAs. A nullptr value records an RPA that matched none of
+ * the known IRKs. Cleared whenever an IRK is added or removed. */
+bluetooth::common::LruCache<RawAddress, tBTM_SEC_DEV_REC*> rpa_cache(
+    kRpaCacheSize, "bt_btm_rpa_cache");
+
+bool dev_rec_has_address(const tBTM_SEC_DEV_REC* p_dev_rec,
+                         const RawAddress& bd_addr) {
+  return p_dev_rec->bd_addr == bd_addr || p_dev_rec->ble.pseudo_addr == bd_addr;
+}
+
+bool dev_rec_has_irk(const tBTM_SEC_DEV_REC* p_dev_rec) {
+  return (p_dev_rec->device_type & BT_DEVICE_TYPE_BLE) &&
+         (p_dev_rec->ble.key_type & BTM_LE_KEY_PID);
+}
+
+void dev_rec_index_remove(tBTM_SEC_DEV_REC* p_dev_rec) {
+  for (auto it = dev_rec_by_addr.begin(); it != dev_rec_by_addr.end();) {
+    if (it->second == p_dev_rec)
+      it = dev_rec_by_addr.erase(it);
+    else
+      it++;
+  }
+}
+
+/* Returns the record whose bd_addr or pseudo_addr is |bd_addr|, without
+ * attempting RPA resolution. */
+tBTM_SEC_DEV_REC* btm_find_dev_by_exact_addr(const RawAddress& bd_addr) {
+  auto it = dev_rec_by_addr.find(bd_addr);
+  if (it != dev_rec_by_addr.end()) {
+    if (dev_rec_has_address(it->second, bd_addr)) return it->second;
+    dev_rec_by_addr.erase(it);
+  }
+
+  list_node_t* end = list_end(btm_cb.sec_dev_rec);
+  for (list_node_t* node = list_begin(btm_cb.sec_dev_rec); node != end;
+       node = list_next(node)) {
+    tBTM_SEC_DEV_REC* p_dev_rec =
+        static_cast<tBTM_SEC_DEV_REC*>(list_node(node));
+    if (dev_rec_has_address(p_dev_rec, bd_addr)) {
+      dev_rec_by_addr[bd_addr] = p_dev_rec;
+      return p_dev_rec;
+    }
+  }
+
+  return NULL;
+}
+
+}  // namespace
+
 /*******************************************************************************
  *
  * Function         BTM_SecAddDevice
@@ -152,6 +214,8 @@ bool BTM_SecAddDevice(const RawAddress& bd_addr, DEV_CLASS dev_class,
 }
 
 void wipe_secrets_and_remove(tBTM_SEC_DEV_REC* p_dev_rec) {
+  dev_rec_index_remove(p_dev_rec);
+  btm_dev_invalidate_rpa_cache();
   p_dev_rec->link_key.fill(0);
   memset(&p_dev_rec->ble.keys, 0, sizeof(tBTM_SEC_BLE_KEYS));
   list_remove(btm_cb.sec_dev_rec, p_dev_rec);
@@ -343,36 +407,53 @@ tBTM_SEC_DEV_REC* btm_find_dev_by_handle(uint16_t handle) {
   return NULL;
 }
 
-bool is_address_equal(void* data, void* context) {
-  tBTM_SEC_DEV_REC* p_dev_rec = static_cast<tBTM_SEC_DEV_REC*>(data);
-  const RawAddress* bd_addr = ((RawAddress*)context);
-
-  if (p_dev_rec->bd_addr == *bd_addr) return false;
-  // If a LE random address is looking for device record
-  if (p_dev_rec->ble.pseudo_addr == *bd_addr) return false;
-
-  if (btm_ble_addr_resolvable(*bd_addr, p_dev_rec)) return false;
-  return true;
-}
-
 /*******************************************************************************
  *
  * Function         btm_find_dev
  *
  * Description      Look for the record in the device database for the record
- *                  with specified BD address
+ *                  with specified BD address. Records matching bd_addr or
+ *                  pseudo_addr exactly are preferred; otherwise a resolvable
+ *                  private address is resolved against the known IRKs.
  *
  * Returns          Pointer to the record or NULL
  *
  ******************************************************************************/
 tBTM_SEC_DEV_REC* btm_find_dev(const RawAddress& bd_addr) {
-  list_node_t* n =
-      list_foreach(btm_cb.sec_dev_rec, is_address_equal, (void*)&bd_addr);
-  if (n) return static_cast<tBTM_SEC_DEV_REC*>(list_node(n));
+  tBTM_SEC_DEV_REC* p_dev_rec = btm_find_dev_by_exact_addr(bd_addr);
+  if (p_dev_rec != NULL) return p_dev_rec;
+
+  if (!BTM_BLE_IS_RESOLVE_BDA(bd_addr)) return NULL;
+
+  tBTM_SEC_DEV_REC** p_cached = rpa_cache.Find(bd_addr);
+  if (p_cached != nullptr) {
+    p_dev_rec = *p_cached;
+    if (p_dev_rec == NULL) return NULL;
+    if (dev_rec_has_irk(p_dev_rec)) {
+      btm_ble_init_pseudo_addr(p_dev_rec, bd_addr);
+      return p_dev_rec;
+    }
+    rpa_cache.Remove(bd_addr);
+  }
 
-  return NULL;
+  p_dev_rec = btm_ble_resolve_random_addr(bd_addr);
+  if (p_dev_rec != NULL) btm_ble_init_pseudo_addr(p_dev_rec, bd_addr);
+  rpa_cache.Put(bd_addr, p_dev_rec);
+  return p_dev_rec;
 }
 
+/*******************************************************************************
+ *
+ * Function         btm_dev_invalidate_rpa_cache
+ *
+ * Description      Drop all cached RPA resolutions. Must be called whenever a
+ *                  peer IRK is stored or cleared, or a record is freed.
+ *
+ * Returns          none
+ *
+ ******************************************************************************/
+void btm_dev_invalidate_rpa_cache(void) { rpa_cache.Clear(); }
+
 /*******************************************************************************
  *
  * Function         btm_consolidate_dev
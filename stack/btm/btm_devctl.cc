@@ -216,6 +216,7 @@ static void reset_complete(void* result) {
   if (controller->supports_ble()) {
     btm_ble_white_list_init(controller->get_ble_white_list_size());
     l2c_link_processs_ble_num_bufs(controller->get_acl_buffer_count_ble());
+    SMP_RefillKeyPool();
   }
 
   BTM_SetPinType(btm_cb.cfg.pin_type, btm_cb.cfg.pin_code,
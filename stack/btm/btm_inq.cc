@@ -31,6 +31,12 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <algorithm>
+#include <list>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
 #include "common/time_util.h"
 #include "device/include/controller.h"
 #include "osi/include/osi.h"
@@ -41,6 +47,7 @@
 #include "btm_api.h"
 #include "btm_int.h"
 #include "btu.h"
+#include "eir_decoder.h"
 #include "hcidefs.h"
 #include "hcimsgs.h"
 #include "main/shim/btm_api.h"
@@ -56,6 +63,56 @@ using bluetooth::Uuid;
 #define BTM_INQ_DEBUG FALSE
 #endif
 
+namespace {
+
+/* Inquiry database entry and its bookkeeping. |ent| must stay the first
+ * member: entries are handed out as tINQ_DB_ENT pointers. */
+struct InqDbSlot {
+  tINQ_DB_ENT ent;
+  /* Value of inq_db_generation when the entry was allocated */
+  uint32_t generation;
+  /* Position in inq_db_slots, so that walking the database is not affected by
+   * entries moving in the LRU order */
+  size_t index;
+  std::list<InqDbSlot>::iterator lru;
+};
+
+static_assert(std::is_standard_layout<InqDbSlot>::value,
+              "entries are converted back to their slot");
+
+/* All entries, from least to most recently used. Entries are allocated as
+ * the database grows, up to BTM_INQ_DB_SIZE, and are then reused instead of
+ * freed, so pointers to them stay valid as with a fixed array. */
+std::list<InqDbSlot> inq_db_lru;
+
+/* The same entries in allocation order */
+std::vector<InqDbSlot*> inq_db_slots;
+
+/* Entries by address. A mapping may outlive the use of its entry, so it is
+ * checked on lookup. */
+std::unordered_map<RawAddress, InqDbSlot*> inq_db_by_addr;
+
+/* Incremented to clear the whole database at once: entries allocated in an
+ * earlier generation are not in use. */
+uint32_t inq_db_generation;
+
+InqDbSlot* inq_db_slot(tINQ_DB_ENT* p_ent) {
+  return reinterpret_cast<InqDbSlot*>(p_ent);
+}
+
+bool inq_db_slot_in_use(const InqDbSlot* p_slot) {
+  return p_slot->ent.in_use && p_slot->generation == inq_db_generation;
+}
+
+/* Free |p_slot| and move it to the front of the LRU order, to be reused
+ * first. */
+void inq_db_slot_release(InqDbSlot* p_slot) {
+  p_slot->ent.in_use = false;
+  inq_db_lru.splice(inq_db_lru.begin(), inq_db_lru, p_slot->lru);
+}
+
+}  // namespace
+
 /******************************************************************************/
 /*               L O C A L    D A T A    D E F I N I T I O N S                */
 /******************************************************************************/
@@ -122,6 +179,10 @@ void btm_clr_inq_result_flt(void);
 
 static uint8_t btm_convert_uuid_to_eir_service(uint16_t uuid16);
 void btm_set_eir_uuid(uint8_t* p_eir, tBTM_INQ_RESULTS* p_results);
+static void btm_set_eir_uuid_list(const EirDecoder::Result& eir,
+                                  tBTM_INQ_RESULTS* p_results);
+static tBTM_INQ_CHANGED btm_inq_result_changes(tINQ_DB_ENT* p_i,
+                                               const uint8_t* p_eir);
 static const uint8_t* btm_eir_get_uuid_list(uint8_t* p_eir, size_t eir_len,
                                             uint8_t uuid_size,
                                             uint8_t* p_num_uuid,
@@ -780,7 +841,9 @@ tBTM_STATUS BTM_StartInquiry(tBTM_INQ_PARMS* p_inqparms,
  *
  * Description      This function initiates a remote device HCI command to the
  *                  controller and calls the callback when the process has
- *                  completed.
+ *                  completed. A BR/EDR name received recently is given to
+ *                  the callback without paging the device, and a request
+ *                  made while another one is in progress waits for it.
  *
  * Input Params:    remote_bda      - device address of name to retrieve
  *                  p_cb            - callback function called when
@@ -791,7 +854,8 @@ tBTM_STATUS BTM_StartInquiry(tBTM_INQ_PARMS* p_inqparms,
  * Returns
  *                  BTM_CMD_STARTED is returned if the request was successfully
  *                                  sent to HCI.
- *                  BTM_BUSY if already in progress
+ *                  BTM_BUSY if already in progress and too many requests
+ *                           are waiting
  *                  BTM_UNKNOWN_ADDR if device address is bad
  *                  BTM_NO_RESOURCES if could not allocate resources to start
  *                                   the command
@@ -801,6 +865,24 @@ tBTM_STATUS BTM_StartInquiry(tBTM_INQ_PARMS* p_inqparms,
 tBTM_STATUS BTM_ReadRemoteDeviceName(const RawAddress& remote_bda,
                                      tBTM_CMPL_CB* p_cb,
                                      tBT_TRANSPORT transport) {
+  return BTM_ReadRemoteDeviceNameWithPriority(remote_bda, p_cb, transport,
+                                              BTM_RMT_NAME_PRIORITY_USER);
+}
+
+/*******************************************************************************
+ *
+ * Function         BTM_ReadRemoteDeviceNameWithPriority
+ *
+ * Description      This function is BTM_ReadRemoteDeviceName for a BR/EDR
+ *                  request that, if another one is in progress, waits for it
+ *                  behind the requests of a higher |priority|.
+ *
+ * Returns          See BTM_ReadRemoteDeviceName
+ *
+ ******************************************************************************/
+tBTM_STATUS BTM_ReadRemoteDeviceNameWithPriority(
+    const RawAddress& remote_bda, tBTM_CMPL_CB* p_cb, tBT_TRANSPORT transport,
+    tBTM_RMT_NAME_PRIORITY priority) {
   if (bluetooth::shim::is_gd_shim_enabled()) {
     return bluetooth::shim::BTM_ReadRemoteDeviceName(remote_bda, p_cb,
                                                      transport);
@@ -811,9 +893,12 @@ tBTM_STATUS BTM_ReadRemoteDeviceName(const RawAddress& remote_bda,
   if (transport == BT_TRANSPORT_LE) {
     return btm_ble_read_remote_name(remote_bda, p_cb);
   }
+
+  /*** Make sure the device is ready ***/
+  if (!BTM_IsDeviceUp()) return (BTM_WRONG_MODE);
+
   /* Use classic transport for BR/EDR and Dual Mode devices */
-  return btm_initiate_rem_name(remote_bda, BTM_RMT_NAME_EXT,
-                               BTM_EXT_RMT_NAME_TIMEOUT_MS, p_cb);
+  return btm_rmt_name_request(remote_bda, p_cb, priority);
 }
 
 /*******************************************************************************
@@ -841,6 +926,8 @@ tBTM_STATUS BTM_CancelRemoteDeviceName(void) {
 
   /* Make sure there is not already one in progress */
   if (p_inq->remname_active) {
+    /* the requests waiting for it fail with it */
+    btm_rmt_name_cancel();
     if (BTM_UseLeLink(p_inq->remname_bda)) {
       /* Cancel remote name request for LE device, and process remote name
        * callback. */
@@ -887,15 +974,10 @@ tBTM_INQ_INFO* BTM_InqDbRead(const RawAddress& p_bda) {
  *
  ******************************************************************************/
 tBTM_INQ_INFO* BTM_InqDbFirst(void) {
-  uint16_t xx;
-  tINQ_DB_ENT* p_ent = btm_cb.btm_inq_vars.inq_db;
-
-  for (xx = 0; xx < BTM_INQ_DB_SIZE; xx++, p_ent++) {
-    if (p_ent->in_use) return (&p_ent->inq_info);
-  }
+  tINQ_DB_ENT* p_ent = btm_inq_db_next(NULL);
+  if (!p_ent) return ((tBTM_INQ_INFO*)NULL);
 
-  /* If here, no used entry found */
-  return ((tBTM_INQ_INFO*)NULL);
+  return (&p_ent->inq_info);
 }
 
 /*******************************************************************************
@@ -910,20 +992,13 @@ tBTM_INQ_INFO* BTM_InqDbFirst(void) {
  *
  ******************************************************************************/
 tBTM_INQ_INFO* BTM_InqDbNext(tBTM_INQ_INFO* p_cur) {
-  tINQ_DB_ENT* p_ent;
-  uint16_t inx;
-
   if (p_cur) {
-    p_ent = (tINQ_DB_ENT*)((uint8_t*)p_cur - offsetof(tINQ_DB_ENT, inq_info));
-    inx = (uint16_t)((p_ent - btm_cb.btm_inq_vars.inq_db) + 1);
-
-    for (p_ent = &btm_cb.btm_inq_vars.inq_db[inx]; inx < BTM_INQ_DB_SIZE;
-         inx++, p_ent++) {
-      if (p_ent->in_use) return (&p_ent->inq_info);
-    }
+    tINQ_DB_ENT* p_ent =
+        (tINQ_DB_ENT*)((uint8_t*)p_cur - offsetof(tINQ_DB_ENT, inq_info));
+    p_ent = btm_inq_db_next(p_ent);
+    if (!p_ent) return ((tBTM_INQ_INFO*)NULL);
 
-    /* If here, more entries found */
-    return ((tBTM_INQ_INFO*)NULL);
+    return (&p_ent->inq_info);
   } else
     return (BTM_InqDbFirst());
 }
@@ -1048,10 +1123,16 @@ void btm_inq_db_reset(void) {
  *
  ******************************************************************************/
 void btm_inq_db_init(void) {
+  inq_db_by_addr.clear();
+  inq_db_slots.clear();
+  inq_db_lru.clear();
+  inq_db_generation = 0;
+
   alarm_free(btm_cb.btm_inq_vars.remote_name_timer);
   btm_cb.btm_inq_vars.remote_name_timer =
       alarm_new("btm_inq.remote_name_timer");
   btm_cb.btm_inq_vars.no_inc_ssp = BTM_NO_SSP_ON_INQUIRY;
+  btm_rmt_name_init();
 }
 
 /*******************************************************************************
@@ -1107,7 +1188,9 @@ void btm_inq_clear_ssp(void) {
  * Function         btm_clr_inq_db
  *
  * Description      This function is called to clear out a device or all devices
- *                  from the inquiry database.
+ *                  from the inquiry database. Clearing all devices starts a
+ *                  new generation of the database without touching the
+ *                  entries.
  *
  * Parameter        p_bda - (input) BD_ADDR ->  Address of device to clear
  *                                              (NULL clears all entries)
@@ -1116,21 +1199,15 @@ void btm_inq_clear_ssp(void) {
  *
  ******************************************************************************/
 void btm_clr_inq_db(const RawAddress* p_bda) {
-  tBTM_INQUIRY_VAR_ST* p_inq = &btm_cb.btm_inq_vars;
-  tINQ_DB_ENT* p_ent = p_inq->inq_db;
-  uint16_t xx;
-
 #if (BTM_INQ_DEBUG == TRUE)
   BTM_TRACE_DEBUG("btm_clr_inq_db: inq_active:0x%x state:%d",
                   btm_cb.btm_inq_vars.inq_active, btm_cb.btm_inq_vars.state);
 #endif
-  for (xx = 0; xx < BTM_INQ_DB_SIZE; xx++, p_ent++) {
-    if (p_ent->in_use) {
-      /* If this is the specified BD_ADDR or clearing all devices */
-      if (p_bda == NULL || (p_ent->inq_info.results.remote_bd_addr == *p_bda)) {
-        p_ent->in_use = false;
-      }
-    }
+  if (p_bda == NULL) {
+    inq_db_generation++;
+  } else {
+    tINQ_DB_ENT* p_ent = btm_inq_db_find(*p_bda);
+    if (p_ent) btm_inq_db_free(p_ent);
   }
 #if (BTM_INQ_DEBUG == TRUE)
   BTM_TRACE_DEBUG("inq_active:0x%x state:%d", btm_cb.btm_inq_vars.inq_active,
@@ -1201,57 +1278,103 @@ bool btm_inq_find_bdaddr(const RawAddress& p_bda) {
  *
  ******************************************************************************/
 tINQ_DB_ENT* btm_inq_db_find(const RawAddress& p_bda) {
-  uint16_t xx;
-  tINQ_DB_ENT* p_ent = btm_cb.btm_inq_vars.inq_db;
+  auto it = inq_db_by_addr.find(p_bda);
+  if (it == inq_db_by_addr.end()) return (NULL);
 
-  for (xx = 0; xx < BTM_INQ_DB_SIZE; xx++, p_ent++) {
-    if (p_ent->in_use && p_ent->inq_info.results.remote_bd_addr == p_bda)
-      return (p_ent);
+  InqDbSlot* p_slot = it->second;
+  if (!inq_db_slot_in_use(p_slot) ||
+      p_slot->ent.inq_info.results.remote_bd_addr != p_bda) {
+    /* cleared since it was indexed */
+    inq_db_by_addr.erase(it);
+    return (NULL);
   }
 
-  /* If here, not found */
-  return (NULL);
+  inq_db_lru.splice(inq_db_lru.end(), inq_db_lru, p_slot->lru);
+  return (&p_slot->ent);
 }
 
 /*******************************************************************************
  *
  * Function         btm_inq_db_new
  *
- * Description      This function looks through the inquiry database for an
- *                  unused entry. If no entry is free, it allocates the oldest
- *                  entry.
+ * Description      This function allocates an inquiry database entry for
+ *                  |p_bda|. Free entries are reused first; the database then
+ *                  grows up to BTM_INQ_DB_SIZE entries, after which the least
+ *                  recently used entry is evicted.
  *
  * Returns          pointer to entry
  *
  ******************************************************************************/
 tINQ_DB_ENT* btm_inq_db_new(const RawAddress& p_bda) {
-  uint16_t xx;
-  tINQ_DB_ENT* p_ent = btm_cb.btm_inq_vars.inq_db;
-  tINQ_DB_ENT* p_old = btm_cb.btm_inq_vars.inq_db;
-  uint64_t ot = UINT64_MAX;
+  tINQ_DB_ENT* p_dup = btm_inq_db_find(p_bda);
+  if (p_dup) btm_inq_db_free(p_dup);
+
+  /* free entries are kept at the front */
+  InqDbSlot* p_slot;
+  if (!inq_db_lru.empty() && (!inq_db_slot_in_use(&inq_db_lru.front()) ||
+                              inq_db_slots.size() >= BTM_INQ_DB_SIZE)) {
+    p_slot = &inq_db_lru.front();
+    auto it = inq_db_by_addr.find(p_slot->ent.inq_info.results.remote_bd_addr);
+    if (it != inq_db_by_addr.end() && it->second == p_slot)
+      inq_db_by_addr.erase(it);
+  } else {
+    p_slot = &inq_db_lru.emplace_front();
+    p_slot->lru = inq_db_lru.begin();
+    p_slot->index = inq_db_slots.size();
+    inq_db_slots.push_back(p_slot);
+  }
 
-  for (xx = 0; xx < BTM_INQ_DB_SIZE; xx++, p_ent++) {
-    if (!p_ent->in_use) {
-      memset(p_ent, 0, sizeof(tINQ_DB_ENT));
-      p_ent->inq_info.results.remote_bd_addr = p_bda;
-      p_ent->in_use = true;
+  memset(&p_slot->ent, 0, sizeof(tINQ_DB_ENT));
+  p_slot->ent.inq_info.results.remote_bd_addr = p_bda;
+  p_slot->ent.in_use = true;
+  p_slot->generation = inq_db_generation;
+  inq_db_lru.splice(inq_db_lru.end(), inq_db_lru, p_slot->lru);
+  inq_db_by_addr[p_bda] = p_slot;
 
-      return (p_ent);
-    }
+  return (&p_slot->ent);
+}
 
-    if (p_ent->time_of_resp < ot) {
-      p_old = p_ent;
-      ot = p_ent->time_of_resp;
-    }
-  }
+/*******************************************************************************
+ *
+ * Function         btm_inq_db_free
+ *
+ * Description      This function frees an inquiry database entry, so that it
+ *                  is reused before any entry in use is evicted.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btm_inq_db_free(tINQ_DB_ENT* p_ent) {
+  InqDbSlot* p_slot = inq_db_slot(p_ent);
 
-  /* If here, no free entry found. Return the oldest. */
+  auto it = inq_db_by_addr.find(p_ent->inq_info.results.remote_bd_addr);
+  if (it != inq_db_by_addr.end() && it->second == p_slot)
+    inq_db_by_addr.erase(it);
+  inq_db_slot_release(p_slot);
+}
 
-  memset(p_old, 0, sizeof(tINQ_DB_ENT));
-  p_old->inq_info.results.remote_bd_addr = p_bda;
-  p_old->in_use = true;
+/*******************************************************************************
+ *
+ * Function         btm_inq_db_next
+ *
+ * Description      This function returns the entry in use that follows
+ *                  |p_ent| in the inquiry database, or the first one if
+ *                  |p_ent| is NULL. The order does not change when entries
+ *                  are used, so the database can be walked while it is
+ *                  updated.
+ *
+ * Returns          pointer to entry, or NULL if no more found
+ *
+ ******************************************************************************/
+tINQ_DB_ENT* btm_inq_db_next(tINQ_DB_ENT* p_ent) {
+  size_t index = p_ent ? inq_db_slot(p_ent)->index + 1 : 0;
+
+  for (; index < inq_db_slots.size(); index++) {
+    if (inq_db_slot_in_use(inq_db_slots[index]))
+      return (&inq_db_slots[index]->ent);
+  }
 
-  return (p_old);
+  return (NULL);
 }
 
 /*******************************************************************************
@@ -1696,24 +1819,101 @@ void btm_process_inq_results(uint8_t* p, uint8_t hci_evt_len,
     }
 
     if (is_new || update) {
+      uint8_t eir_len = HCI_EXT_INQ_RESPONSE_LEN;
       if (inq_res_mode == BTM_INQ_RESULT_EXTENDED) {
+        /* decode the EIR once for BTM and for the callback */
+        EirDecoder::Result eir =
+            EirDecoder::Decode(p, HCI_EXT_INQ_RESPONSE_LEN);
         memset(p_cur->eir_uuid, 0,
                BTM_EIR_SERVICE_ARRAY_SIZE * (BTM_EIR_ARRAY_BITS / 8));
         /* set bit map of UUID list from received EIR */
-        btm_set_eir_uuid(p, p_cur);
+        btm_set_eir_uuid_list(eir, p_cur);
+
+        tBTM_EIR_INFO* p_info = &p_cur->eir_info;
+        if (eir.name.data != NULL) {
+          p_info->name_offset = eir.name.data - p;
+          p_info->name_len = eir.name.length;
+          p_info->name_complete = eir.name.complete;
+          /* spares a remote name request */
+          if (eir.name.complete)
+            btm_rmt_name_cache_add_eir(bda, eir.name.data, eir.name.length);
+        }
+        p_info->tx_power =
+            eir.has_tx_power ? eir.tx_power : (int8_t)TX_POWER_NOT_PRESENT;
+        p_info->len = eir.length;
+        p_info->hash = eir.hash;
+        eir_len = eir.length;
         p_eir_data = p;
       } else
         p_eir_data = NULL;
 
+      p_cur->changed = btm_inq_result_changes(p_i, p_eir_data);
+
       /* If a callback is registered, call it with the results */
-      if (p_inq_results_cb) {
-        (p_inq_results_cb)((tBTM_INQ_RESULTS*)p_cur, p_eir_data,
-                           HCI_EXT_INQ_RESPONSE_LEN);
+      if (p_cur->changed == 0) {
+        /* repeated response, nothing worth reporting again */
+      } else if (p_inq_results_cb) {
+        (p_inq_results_cb)((tBTM_INQ_RESULTS*)p_cur, p_eir_data, eir_len);
       } else {
         BTM_TRACE_DEBUG("No callback is registered");
       }
+      memset(&p_cur->eir_info, 0, sizeof(p_cur->eir_info));
+      p_cur->changed = 0;
+    }
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_inq_result_changes
+ *
+ * Description      This function is called with a BR/EDR inquiry result about
+ *                  to be reported, its EIR (if any) already decoded, to find
+ *                  what changed since the device was last reported in this
+ *                  inquiry. The result is then taken as reported.
+ *
+ * Parameters       p_i - the inquiry database entry of the device
+ *                  p_eir - the EIR of the result, NULL if none
+ *
+ * Returns          the changes, 0 if there is nothing new to report
+ *
+ ******************************************************************************/
+static tBTM_INQ_CHANGED btm_inq_result_changes(tINQ_DB_ENT* p_i,
+                                               const uint8_t* p_eir) {
+  tBTM_INQ_RESULTS* p_cur = &p_i->inq_info.results;
+  const tBTM_EIR_INFO* p_info = &p_cur->eir_info;
+  tBTM_INQ_CHANGED changed = 0;
+  uint32_t name_hash = 0;
+
+  if (p_eir != NULL && p_info->name_offset != 0)
+    name_hash = EirDecoder::Hash(p_eir + p_info->name_offset, p_info->name_len);
+
+  if (p_i->reported_inq_count != btm_cb.btm_inq_vars.inq_counter) {
+    changed = BTM_INQ_CHANGED_ALL;
+  } else {
+    if (p_eir != NULL && p_info->hash != p_i->reported_eir_hash) {
+      if (name_hash != p_i->reported_name_hash)
+        changed |= BTM_INQ_CHANGED_NAME;
+      if (memcmp(p_cur->eir_uuid, p_i->reported_eir_uuid,
+                 sizeof(p_i->reported_eir_uuid)) != 0)
+        changed |= BTM_INQ_CHANGED_SERVICES;
+      if (changed == 0) changed = BTM_INQ_CHANGED_EIR;
     }
+    if (abs(p_cur->rssi - p_i->reported_rssi) >= BTM_INQ_RSSI_UPDATE_DELTA)
+      changed |= BTM_INQ_CHANGED_RSSI;
+  }
+
+  if (changed == 0) return 0;
+
+  p_i->reported_inq_count = btm_cb.btm_inq_vars.inq_counter;
+  p_i->reported_rssi = p_cur->rssi;
+  if (p_eir != NULL) {
+    p_i->reported_eir_hash = p_info->hash;
+    p_i->reported_name_hash = name_hash;
+    memcpy(p_i->reported_eir_uuid, p_cur->eir_uuid,
+           sizeof(p_i->reported_eir_uuid));
   }
+  return changed;
 }
 
 /*******************************************************************************
@@ -1722,33 +1922,22 @@ void btm_process_inq_results(uint8_t* p, uint8_t hci_evt_len,
  *
  * Description      This function is called when inquiry complete is received
  *                  from the device to sort inquiry results based on rssi.
+ *                  Entries in use are walked from the strongest to the
+ *                  weakest signal.
  *
  * Returns          void
  *
  ******************************************************************************/
 void btm_sort_inq_result(void) {
-  uint8_t xx, yy, num_resp;
-  tINQ_DB_ENT* p_ent = btm_cb.btm_inq_vars.inq_db;
-  tINQ_DB_ENT* p_next = btm_cb.btm_inq_vars.inq_db + 1;
-  int size;
-  tINQ_DB_ENT* p_tmp = (tINQ_DB_ENT*)osi_malloc(sizeof(tINQ_DB_ENT));
-
-  num_resp = (btm_cb.btm_inq_vars.inq_cmpl_info.num_resp < BTM_INQ_DB_SIZE)
-                 ? btm_cb.btm_inq_vars.inq_cmpl_info.num_resp
-                 : BTM_INQ_DB_SIZE;
-
-  size = sizeof(tINQ_DB_ENT);
-  for (xx = 0; xx < num_resp - 1; xx++, p_ent++) {
-    for (yy = xx + 1, p_next = p_ent + 1; yy < num_resp; yy++, p_next++) {
-      if (p_ent->inq_info.results.rssi < p_next->inq_info.results.rssi) {
-        memcpy(p_tmp, p_next, size);
-        memcpy(p_next, p_ent, size);
-        memcpy(p_ent, p_tmp, size);
-      }
-    }
-  }
-
-  osi_free(p_tmp);
+  /* only the walking order changes: entries do not move */
+  std::stable_sort(inq_db_slots.begin(), inq_db_slots.end(),
+                   [](const InqDbSlot* a, const InqDbSlot* b) {
+                     if (!inq_db_slot_in_use(a) || !inq_db_slot_in_use(b))
+                       return inq_db_slot_in_use(a) && !inq_db_slot_in_use(b);
+                     return a->ent.inq_info.results.rssi >
+                            b->ent.inq_info.results.rssi;
+                   });
+  for (size_t i = 0; i < inq_db_slots.size(); i++) inq_db_slots[i]->index = i;
 }
 
 /*******************************************************************************
@@ -1975,10 +2164,12 @@ void btm_process_remote_name(const RawAddress* bda, BD_NAME bdn,
       rem_name.remote_bd_name[0] = 0;
     }
     /* Reset the remote BAD to zero and call callback if possible */
+    rem_name.bd_addr = p_inq->remname_bda;
     p_inq->remname_bda = RawAddress::kEmpty;
 
     p_inq->p_remname_cmpl_cb = NULL;
-    if (p_cb) (p_cb)(&rem_name);
+    /* the requests waiting for this one are answered, and the next started */
+    btm_rmt_name_complete(&rem_name, p_cb);
   }
 }
 
@@ -2434,48 +2625,58 @@ static uint16_t btm_convert_uuid_to_uuid16(const uint8_t* p_uuid,
  *
  ******************************************************************************/
 void btm_set_eir_uuid(uint8_t* p_eir, tBTM_INQ_RESULTS* p_results) {
+  btm_set_eir_uuid_list(EirDecoder::Decode(p_eir, HCI_EXT_INQ_RESPONSE_LEN),
+                        p_results);
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_set_eir_uuid_list
+ *
+ * Description      This function is called to store the UUID lists of a
+ *                  decoded EIR into inquiry result.
+ *
+ * Parameters       eir - the decoded EIR
+ *                  p_results - pointer of inquiry result
+ *
+ * Returns          None
+ *
+ ******************************************************************************/
+static void btm_set_eir_uuid_list(const EirDecoder::Result& eir,
+                                  tBTM_INQ_RESULTS* p_results) {
+  const EirDecoder::Data& uuids16 = eir.uuids[EirDecoder::k16BitUuids];
+  const EirDecoder::Data& uuids32 = eir.uuids[EirDecoder::k32BitUuids];
+  const EirDecoder::Data& uuids128 = eir.uuids[EirDecoder::k128BitUuids];
   const uint8_t* p_uuid_data;
   uint8_t num_uuid;
   uint16_t uuid16;
   uint8_t yy;
-  uint8_t type = BTM_EIR_MORE_16BITS_UUID_TYPE;
 
-  p_uuid_data = btm_eir_get_uuid_list(p_eir, HCI_EXT_INQ_RESPONSE_LEN,
-                                      Uuid::kNumBytes16, &num_uuid, &type);
-
-  if (type == BTM_EIR_COMPLETE_16BITS_UUID_TYPE) {
-    p_results->eir_complete_list = true;
-  } else {
-    p_results->eir_complete_list = false;
-  }
+  p_results->eir_complete_list = uuids16.data != NULL && uuids16.complete;
 
   BTM_TRACE_API("btm_set_eir_uuid eir_complete_list=0x%02X",
                 p_results->eir_complete_list);
 
-  if (p_uuid_data) {
-    for (yy = 0; yy < num_uuid; yy++) {
-      STREAM_TO_UINT16(uuid16, p_uuid_data);
-      BTM_AddEirService(p_results->eir_uuid, uuid16);
-    }
+  p_uuid_data = uuids16.data;
+  num_uuid = uuids16.length / Uuid::kNumBytes16;
+  for (yy = 0; yy < num_uuid; yy++) {
+    STREAM_TO_UINT16(uuid16, p_uuid_data);
+    BTM_AddEirService(p_results->eir_uuid, uuid16);
   }
 
-  p_uuid_data = btm_eir_get_uuid_list(p_eir, HCI_EXT_INQ_RESPONSE_LEN,
-                                      Uuid::kNumBytes32, &num_uuid, &type);
-  if (p_uuid_data) {
-    for (yy = 0; yy < num_uuid; yy++) {
-      uuid16 = btm_convert_uuid_to_uuid16(p_uuid_data, Uuid::kNumBytes32);
-      p_uuid_data += Uuid::kNumBytes32;
-      if (uuid16) BTM_AddEirService(p_results->eir_uuid, uuid16);
-    }
+  p_uuid_data = uuids32.data;
+  num_uuid = uuids32.length / Uuid::kNumBytes32;
+  for (yy = 0; yy < num_uuid; yy++) {
+    uuid16 = btm_convert_uuid_to_uuid16(p_uuid_data, Uuid::kNumBytes32);
+    p_uuid_data += Uuid::kNumBytes32;
+    if (uuid16) BTM_AddEirService(p_results->eir_uuid, uuid16);
   }
 
-  p_uuid_data = btm_eir_get_uuid_list(p_eir, HCI_EXT_INQ_RESPONSE_LEN,
-                                      Uuid::kNumBytes128, &num_uuid, &type);
-  if (p_uuid_data) {
-    for (yy = 0; yy < num_uuid; yy++) {
-      uuid16 = btm_convert_uuid_to_uuid16(p_uuid_data, Uuid::kNumBytes128);
-      p_uuid_data += Uuid::kNumBytes128;
-      if (uuid16) BTM_AddEirService(p_results->eir_uuid, uuid16);
-    }
+  p_uuid_data = uuids128.data;
+  num_uuid = uuids128.length / Uuid::kNumBytes128;
+  for (yy = 0; yy < num_uuid; yy++) {
+    uuid16 = btm_convert_uuid_to_uuid16(p_uuid_data, Uuid::kNumBytes128);
+    p_uuid_data += Uuid::kNumBytes128;
+    if (uuid16) BTM_AddEirService(p_results->eir_uuid, uuid16);
   }
 }
@@ -73,6 +73,8 @@ extern void btm_event_filter_complete(uint8_t* p);
 extern void btm_inq_stop_on_ssp(void);
 extern void btm_inq_clear_ssp(void);
 extern tINQ_DB_ENT* btm_inq_db_find(const RawAddress& p_bda);
+extern void btm_inq_db_free(tINQ_DB_ENT* p_ent);
+extern tINQ_DB_ENT* btm_inq_db_next(tINQ_DB_ENT* p_ent);
 extern bool btm_inq_find_bdaddr(const RawAddress& p_bda);
 
 /* Internal functions provided by btm_acl.cc
@@ -149,6 +151,57 @@ extern void btm_qos_setup_timeout(void* data);
 extern void btm_qos_setup_complete(uint8_t status, uint16_t handle,
                                    FLOW_SPEC* p_flow);
 
+/* Internal functions provided by btm_acl_db_index.cc
+ ***************************************************
+*/
+extern void btm_acl_db_index_update(uint8_t acl_idx);
+extern void btm_acl_db_index_remove(uint8_t acl_idx);
+extern uint8_t btm_acl_db_index_find_handle(uint16_t hci_handle);
+extern uint8_t btm_acl_db_index_find_bda(const RawAddress& bda,
+                                         tBT_TRANSPORT transport);
+extern uint8_t btm_acl_db_index_count(void);
+
+/* Internal functions provided by btm_sec_serv_index.cc
+ ******************************************************
+*/
+extern void btm_sec_serv_index_update(uint8_t srec_idx);
+extern void btm_sec_serv_index_remove(uint8_t srec_idx);
+extern uint8_t btm_sec_serv_index_find_psm(uint16_t psm, uint8_t skip_idx);
+extern uint8_t btm_sec_serv_index_find_mx(bool is_originator, uint16_t psm,
+                                          uint32_t mx_proto_id,
+                                          uint32_t mx_chan_id);
+
+/* Internal functions provided by btm_pm_policy.cc
+ *************************************************
+*/
+extern void btm_pm_traffic_record(tBTM_PM_TRAFFIC* p_traffic, uint64_t now_ms);
+extern uint64_t btm_pm_traffic_idle_timeout(const tBTM_PM_TRAFFIC* p_traffic,
+                                            uint64_t default_ms);
+extern uint16_t btm_pm_traffic_sniff_max(const tBTM_PM_TRAFFIC* p_traffic,
+                                         uint16_t min, uint16_t max);
+extern void btm_pm_policy_traffic(uint16_t hci_handle);
+extern void btm_pm_policy_mode_req(uint8_t link_ind);
+extern void btm_pm_policy_mode_cmd(uint8_t link_ind, tBTM_PM_MODE mode,
+                                   tBTM_PM_STATE state);
+extern void btm_pm_policy_mode_change(uint8_t link_ind, uint8_t mode);
+
+/* Internal functions provided by btm_rmt_name.cc
+ *************************************************
+*/
+extern void btm_rmt_name_init(void);
+extern void btm_rmt_name_cache_add(const RawAddress& bda, const uint8_t* p_name,
+                                   uint16_t length);
+extern void btm_rmt_name_cache_add_eir(const RawAddress& bda,
+                                       const uint8_t* p_name, uint16_t length);
+extern bool btm_rmt_name_cache_find(const RawAddress& bda,
+                                    tBTM_REMOTE_DEV_NAME* p_rem_name);
+extern tBTM_STATUS btm_rmt_name_request(const RawAddress& bda,
+                                        tBTM_CMPL_CB* p_cb,
+                                        tBTM_RMT_NAME_PRIORITY priority);
+extern void btm_rmt_name_cancel(void);
+extern void btm_rmt_name_complete(tBTM_REMOTE_DEV_NAME* p_rem_name,
+                                  tBTM_CMPL_CB* p_cb);
+
 /* Internal functions provided by btm_sco.cc
  *******************************************
 */
@@ -171,6 +224,14 @@ extern void btm_read_def_esco_mode(enh_esco_params_t* p_parms);
 extern uint16_t btm_find_scb_by_handle(uint16_t handle);
 extern void btm_sco_flush_sco_data(uint16_t sco_inx);
 
+/* Internal functions provided by btm_sco_hci.cc
+ **********************************************
+*/
+extern void btm_sco_hci_open(uint16_t sco_inx, bool wideband);
+extern void btm_sco_hci_close(uint16_t sco_inx);
+extern void btm_sco_hci_receive(uint16_t sco_inx, const uint8_t* p_data,
+                                uint8_t len, uint8_t pkt_status);
+
 /* Internal functions provided by btm_devctl.cc
  *********************************************
 */
@@ -207,6 +268,7 @@ extern void wipe_secrets_and_remove(tBTM_SEC_DEV_REC* p_dev_rec);
 extern tBTM_SEC_DEV_REC* btm_find_dev(const RawAddress& bd_addr);
 extern tBTM_SEC_DEV_REC* btm_find_or_alloc_dev(const RawAddress& bd_addr);
 extern tBTM_SEC_DEV_REC* btm_find_dev_by_handle(uint16_t handle);
+extern void btm_dev_invalidate_rpa_cache(void);
 extern tBTM_BOND_TYPE btm_get_bond_type_dev(const RawAddress& bd_addr);
 extern bool btm_set_bond_type_dev(const RawAddress& bd_addr,
                                   tBTM_BOND_TYPE bond_type);
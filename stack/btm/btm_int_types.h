@@ -221,6 +221,13 @@ typedef struct {
   tBTM_INQ_INFO inq_info;
   bool in_use;
   bool scan_rsp;
+  /* What was last given to the results callback, for the inquiry it was
+     given in; repeated responses that change none of it are not reported */
+  uint32_t reported_inq_count;
+  int8_t reported_rssi;
+  uint32_t reported_eir_hash;
+  uint32_t reported_name_hash;
+  uint32_t reported_eir_uuid[BTM_EIR_SERVICE_ARRAY_SIZE];
 } tINQ_DB_ENT;
 
 enum { INQ_NONE, INQ_GENERAL };
@@ -260,7 +267,6 @@ typedef struct {
   tINQ_BDADDR* p_bd_db;    /* Pointer to memory that holds bdaddrs */
   uint16_t num_bd_entries; /* Number of entries in database */
   uint16_t max_bd_entries; /* Maximum number of entries that can be stored */
-  tINQ_DB_ENT inq_db[BTM_INQ_DB_SIZE];
   tBTM_INQ_PARMS inqparms; /* Contains the parameters for the current inquiry */
   tBTM_INQUIRY_CMPL
       inq_cmpl_info; /* Status and number of responses from the last inquiry */
@@ -633,6 +639,27 @@ typedef struct {
   uint8_t link_ind;
 } tBTM_PM_SM_DATA;
 
+/* Buckets of the inter-packet gap histogram of a link: bucket 0 holds gaps
+ * under 1 ms and bucket n those in [2^(n-1), 2^n) ms, the last one those of
+ * about 32 s or more */
+#define BTM_PM_GAP_BUCKETS 17
+
+/* Traffic and mode change history of an ACL link, see btm_pm_policy.cc */
+typedef struct {
+  uint64_t last_traffic_ms; /* time of the latest packet, 0 before the first */
+  uint16_t gap_hist[BTM_PM_GAP_BUCKETS]; /* recent inter-packet gaps */
+  uint16_t gap_count; /* sum of gap_hist */
+  uint64_t sniff_since_ms; /* when the link entered sniff mode, 0 if not */
+  uint64_t wake_since_ms;  /* when the exit of sniff or park was requested */
+  uint32_t mode_reqs;      /* BTM_SetPowerMode() calls */
+  uint32_t mode_cmds;      /* mode change commands sent to the controller */
+  uint32_t sniff_count;    /* mode changes to sniff */
+  uint32_t short_sniff_count; /* sniff periods shorter than a second */
+  uint32_t wake_count;        /* exits of sniff or park requested by us */
+  uint64_t wake_total_ms;
+  uint64_t wake_max_ms;
+} tBTM_PM_TRAFFIC;
+
 typedef struct {
   tBTM_PM_PWR_MD req_mode[BTM_MAX_PM_RECORDS + 1]; /* the desired mode and
                                                       parameters of the
@@ -647,6 +674,7 @@ typedef struct {
 #endif
   tBTM_PM_STATE state; /* contains the current mode of the connection */
   bool chg_ind;        /* a request change indication */
+  tBTM_PM_TRAFFIC traffic;
 } tBTM_PM_MCB;
 
 #define BTM_PM_REC_NOT_USED 0
@@ -729,6 +757,44 @@ typedef void(tBTM_BT_QUALITY_REPORT_RECEIVER)(uint8_t len, uint8_t* p_stream);
 
 #define BTM_STATE_BUFFER_SIZE 5 /* size of state buffer */
 
+/* Lookup keys of the acl_db entries in use, kept apart from the entries so
+ * that the lookups by handle and by address done for most ACL events read a
+ * couple of cache lines only. The entries are also hashed by handle and by
+ * address, bit n of a bucket being set when acl_db[n] is in use and its key
+ * hashes to that bucket, so that a lookup compares a single key in general.
+ * Maintained by btm_acl_db_index.cc. */
+#define BTM_ACL_DB_INDEX_BUCKET_BITS 4
+#define BTM_ACL_DB_INDEX_BUCKETS (1 << BTM_ACL_DB_INDEX_BUCKET_BITS)
+
+typedef struct {
+  uint32_t in_use_mask; /* bit n is set when acl_db[n] is in use */
+  uint32_t handle_bucket[BTM_ACL_DB_INDEX_BUCKETS];
+  uint32_t bda_bucket[BTM_ACL_DB_INDEX_BUCKETS];
+  uint16_t hci_handle[MAX_L2CAP_LINKS];
+  uint64_t bda_key[MAX_L2CAP_LINKS]; /* remote address, then transport */
+  /* The buckets each entry is in, to take it out when it is removed */
+  uint8_t handle_hash[MAX_L2CAP_LINKS];
+  uint8_t bda_hash[MAX_L2CAP_LINKS];
+} tBTM_ACL_DB_INDEX;
+
+/* Index of the sec_serv_rec entries in use, hashed by PSM and by PSM plus
+ * multiplexer channel for the security lookups done on every connection.
+ * Bit n of a bucket is set when sec_serv_rec[n] is in use and its keys hash
+ * to that bucket. Maintained by btm_sec_serv_index.cc. */
+#define BTM_SEC_SERV_INDEX_BUCKET_BITS 4
+#define BTM_SEC_SERV_INDEX_BUCKETS (1 << BTM_SEC_SERV_INDEX_BUCKET_BITS)
+
+typedef struct {
+  uint32_t in_use_mask; /* bit n is set when sec_serv_rec[n] is indexed */
+  uint32_t psm_bucket[BTM_SEC_SERV_INDEX_BUCKETS];
+  uint32_t orig_mx_bucket[BTM_SEC_SERV_INDEX_BUCKETS];
+  uint32_t term_mx_bucket[BTM_SEC_SERV_INDEX_BUCKETS];
+  /* The buckets each record is in, to take it out when its keys change */
+  uint8_t psm_hash[BTM_SEC_MAX_SERVICE_RECORDS];
+  uint8_t orig_mx_hash[BTM_SEC_MAX_SERVICE_RECORDS];
+  uint8_t term_mx_hash[BTM_SEC_MAX_SERVICE_RECORDS];
+} tBTM_SEC_SERV_INDEX;
+
 typedef struct {
   tBTM_CFG cfg; /* Device configuration */
 
@@ -736,6 +802,7 @@ typedef struct {
   **      ACL Management
   ****************************************************/
   tACL_CONN acl_db[MAX_L2CAP_LINKS];
+  tBTM_ACL_DB_INDEX acl_db_index; /* lookup keys of acl_db */
   uint8_t btm_scn[BTM_MAX_SCN]; /* current SCNs: true if SCN is in use */
   uint16_t btm_def_link_policy;
   uint16_t btm_def_link_super_tout;
@@ -809,6 +876,7 @@ typedef struct {
   uint16_t disc_handle;             /* for legacy devices */
   uint8_t disc_reason;              /* for legacy devices */
   tBTM_SEC_SERV_REC sec_serv_rec[BTM_SEC_MAX_SERVICE_RECORDS];
+  tBTM_SEC_SERV_INDEX sec_serv_index; /* lookup buckets of sec_serv_rec */
   list_t* sec_dev_rec; /* list of tBTM_SEC_DEV_REC */
   tBTM_SEC_SERV_REC* p_out_serv;
   tBTM_MKEY_CALLBACK* mkey_cback;
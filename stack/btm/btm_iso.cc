@@ -0,0 +1,384 @@
+/******************************************************************************
+ *
+ *  Copyright 2020 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This file contains the LE isochronous data path: the reassembly of the
+ *  received SDUs on the ISO shard, and their queues.
+ *
+ *  Each queue is a single producer, single consumer ring of records made of
+ *  a tBTM_ISO_SDU and the SDU data. A record is written to the ring in one
+ *  insert, so the consumer never sees part of one.
+ *
+ ******************************************************************************/
+
+#define LOG_TAG "bt_btm_iso"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <unordered_map>
+#include <vector>
+
+#include <base/bind.h>
+#include <base/logging.h>
+
+#include "btm_iso_api.h"
+#include "btu.h"
+#include "common/time_util.h"
+#include "osi/include/allocator.h"
+#include "osi/include/spsc_ringbuffer.h"
+
+/* Fields of the HCI ISO data packets, Core 5.2 Vol 4 Part E 5.4.5 */
+#define ISO_HDR_SIZE 4
+#define ISO_TIME_STAMP_SIZE 4
+#define ISO_SDU_HDR_SIZE 4
+#define ISO_HANDLE_MASK 0x0fff
+#define ISO_PB_FLAG(x) (((x) >> 12) & 0x03)
+#define ISO_TS_FLAG 0x4000
+#define ISO_DATA_LOAD_LENGTH_MASK 0x3fff
+#define ISO_SDU_LENGTH_MASK 0x0fff
+#define ISO_PACKET_STATUS(x) (((x) >> 14) & 0x03)
+
+#define ISO_PB_FIRST_FRAGMENT 0x00
+#define ISO_PB_CONTINUATION_FRAGMENT 0x01
+#define ISO_PB_COMPLETE_SDU 0x02
+#define ISO_PB_LAST_FRAGMENT 0x03
+
+namespace {
+
+/* Upper bounds, in us, of the buckets of the latency histograms */
+constexpr uint64_t kLatencyBoundsUs[] = {1000, 2000, 5000, 10000, 20000};
+constexpr int kLatencyBuckets =
+    sizeof(kLatencyBoundsUs) / sizeof(kLatencyBoundsUs[0]) + 1;
+const char* const kLatencyBucketNames[kLatencyBuckets] = {
+    "<1", "<2", "<5", "<10", "<20", ">=20"};
+
+struct IsoStats {
+  std::atomic<size_t> sdus_queued{0};
+  std::atomic<size_t> sdus_read{0};
+  std::atomic<size_t> sdus_lost{0};
+  std::atomic<size_t> sdus_dropped{0};
+  std::atomic<size_t> packets_invalid{0};
+  std::atomic<size_t> packets_unrouted{0};
+  std::atomic<size_t> streams{0};
+  /* From the HCI layer to the queue, and to the consumer */
+  std::atomic<size_t> queue_latency[kLatencyBuckets];
+  std::atomic<size_t> read_latency[kLatencyBuckets];
+};
+
+IsoStats iso_stats;
+
+void iso_latency_add(std::atomic<size_t>* histogram,
+                     uint64_t rx_timestamp_us) {
+  if (rx_timestamp_us == 0) return;
+  uint64_t now_us = bluetooth::common::time_get_os_boottime_us();
+  uint64_t latency_us = now_us > rx_timestamp_us ? now_us - rx_timestamp_us : 0;
+  int bucket = 0;
+  while (bucket < kLatencyBuckets - 1 && latency_us >= kLatencyBoundsUs[bucket])
+    bucket++;
+  histogram[bucket]++;
+}
+
+}  // namespace
+
+struct tBTM_ISO_STREAM {
+  uint16_t handle;
+  uint16_t max_sdu_len;
+  size_t depth;
+  spsc_ringbuffer_t* ring;
+
+  /* Owned by the ISO shard: the record being reassembled, its tBTM_ISO_SDU
+   * first, and the sequence number expected next */
+  std::vector<uint8_t> record;
+  bool reassembling;
+  uint16_t sdu_len;
+  bool started;
+  uint16_t next_seq_num;
+};
+
+namespace {
+
+/* Owned by the ISO shard */
+std::unordered_map<uint16_t, tBTM_ISO_STREAM*> iso_streams;
+
+tBTM_ISO_SDU* iso_record_sdu(tBTM_ISO_STREAM* stream) {
+  return reinterpret_cast<tBTM_ISO_SDU*>(stream->record.data());
+}
+
+void iso_stream_add(tBTM_ISO_STREAM* stream) {
+  auto iter = iso_streams.find(stream->handle);
+  if (iter != iso_streams.end()) {
+    LOG(WARNING) << __func__ << ": replacing the stream of handle 0x"
+                 << std::hex << stream->handle;
+    spsc_ringbuffer_free(iter->second->ring);
+    delete iter->second;
+    iso_stats.streams--;
+  }
+  iso_streams[stream->handle] = stream;
+}
+
+void iso_stream_remove(tBTM_ISO_STREAM* stream) {
+  auto iter = iso_streams.find(stream->handle);
+  if (iter != iso_streams.end() && iter->second == stream) {
+    iso_streams.erase(iter);
+  }
+  spsc_ringbuffer_free(stream->ring);
+  delete stream;
+  iso_stats.streams--;
+}
+
+/* Queues the record of |sdu|, whose data is the one reassembled, or drops it
+ * if the queue is full */
+void iso_stream_queue(tBTM_ISO_STREAM* stream, const tBTM_ISO_SDU& sdu) {
+  *iso_record_sdu(stream) = sdu;
+  size_t record_len = sizeof(tBTM_ISO_SDU) + sdu.len;
+  if (spsc_ringbuffer_available(stream->ring) < record_len) {
+    iso_stats.sdus_dropped++;
+    return;
+  }
+  spsc_ringbuffer_insert(stream->ring, stream->record.data(), record_len);
+  iso_stats.sdus_queued++;
+  iso_latency_add(iso_stats.queue_latency, sdu.rx_timestamp_us);
+}
+
+/* Queues the SDU just reassembled in order of sequence number: a stale or
+ * duplicate SDU is dropped, and the SDUs missing before it are queued as
+ * lost, unless there are more than the queue holds. */
+void iso_stream_sdu_complete(tBTM_ISO_STREAM* stream) {
+  tBTM_ISO_SDU sdu = *iso_record_sdu(stream);
+  stream->reassembling = false;
+
+  if (!stream->started) {
+    stream->started = true;
+    stream->next_seq_num = sdu.seq_num;
+  }
+  uint16_t gap = sdu.seq_num - stream->next_seq_num;
+  if (gap >= 0x8000) {
+    iso_stats.sdus_dropped++;
+    return;
+  }
+  if (gap > stream->depth) {
+    iso_stats.sdus_lost += gap;
+  } else {
+    for (uint16_t i = 0; i < gap; i++) {
+      tBTM_ISO_SDU lost = {0, (uint16_t)(stream->next_seq_num + i),
+                           BTM_ISO_SDU_LOST, 0, sdu.rx_timestamp_us};
+      iso_stats.sdus_lost++;
+      iso_stream_queue(stream, lost);
+    }
+  }
+  stream->next_seq_num = sdu.seq_num + 1;
+  if (sdu.status == BTM_ISO_SDU_LOST) iso_stats.sdus_lost++;
+  iso_stream_queue(stream, sdu);
+}
+
+}  // namespace
+
+/*******************************************************************************
+ *
+ * Function         BTM_IsoStreamOpen
+ *
+ * Description      Creates the queue of |handle|, and hands it over to the ISO
+ *                  shard that fills it.
+ *
+ * Returns          the stream
+ *
+ ******************************************************************************/
+tBTM_ISO_STREAM* BTM_IsoStreamOpen(uint16_t handle, uint16_t max_sdu_len,
+                                   size_t depth) {
+  CHECK(depth != 0);
+  tBTM_ISO_STREAM* stream = new tBTM_ISO_STREAM();
+  stream->handle = handle & ISO_HANDLE_MASK;
+  stream->max_sdu_len = max_sdu_len & ISO_SDU_LENGTH_MASK;
+  stream->depth = depth;
+  stream->ring = spsc_ringbuffer_init(
+      depth * (sizeof(tBTM_ISO_SDU) + stream->max_sdu_len));
+  stream->record.resize(sizeof(tBTM_ISO_SDU) + stream->max_sdu_len);
+  stream->reassembling = false;
+  stream->sdu_len = 0;
+  stream->started = false;
+  stream->next_seq_num = 0;
+  iso_stats.streams++;
+
+  do_in_shard_thread(BTU_SHARD_ISO, FROM_HERE,
+                     base::BindOnce(&iso_stream_add, stream));
+  return stream;
+}
+
+void BTM_IsoStreamClose(tBTM_ISO_STREAM* stream) {
+  if (stream == nullptr) return;
+  do_in_shard_thread(BTU_SHARD_ISO, FROM_HERE,
+                     base::BindOnce(&iso_stream_remove, stream));
+}
+
+/*******************************************************************************
+ *
+ * Function         BTM_IsoStreamRead
+ *
+ * Description      Pops the oldest record of |stream|. Records are inserted
+ *                  whole, so there is a complete one as soon as there are more
+ *                  bytes than a tBTM_ISO_SDU.
+ *
+ * Returns          true if an SDU was read
+ *
+ ******************************************************************************/
+bool BTM_IsoStreamRead(tBTM_ISO_STREAM* stream, tBTM_ISO_SDU* p_sdu,
+                       uint8_t* p_buf, uint16_t buf_len) {
+  CHECK(stream);
+  CHECK(p_sdu);
+  if (spsc_ringbuffer_size(stream->ring) < sizeof(tBTM_ISO_SDU)) return false;
+
+  spsc_ringbuffer_pop(stream->ring, reinterpret_cast<uint8_t*>(p_sdu),
+                      sizeof(tBTM_ISO_SDU));
+  uint16_t copy_len = p_buf != nullptr ? std::min(p_sdu->len, buf_len) : 0;
+  if (copy_len != 0) spsc_ringbuffer_pop(stream->ring, p_buf, copy_len);
+  spsc_ringbuffer_delete(stream->ring, p_sdu->len - copy_len);
+  p_sdu->len = copy_len;
+
+  iso_stats.sdus_read++;
+  iso_latency_add(iso_stats.read_latency, p_sdu->rx_timestamp_us);
+  return true;
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_iso_data_received
+ *
+ * Description      Reassembles the SDU fragment carried by an HCI ISO data
+ *                  packet into the record of its stream.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btm_iso_data_received(BT_HDR* p_msg, uint64_t rx_timestamp_us) {
+  uint8_t* p = p_msg->data + p_msg->offset;
+  uint16_t len = p_msg->len;
+  uint16_t handle_flags, data_load_len;
+
+  if (len < ISO_HDR_SIZE) {
+    iso_stats.packets_invalid++;
+    osi_free(p_msg);
+    return;
+  }
+  STREAM_TO_UINT16(handle_flags, p);
+  STREAM_TO_UINT16(data_load_len, p);
+  data_load_len &= ISO_DATA_LOAD_LENGTH_MASK;
+  if (data_load_len > len - ISO_HDR_SIZE) {
+    iso_stats.packets_invalid++;
+    osi_free(p_msg);
+    return;
+  }
+
+  auto iter = iso_streams.find(handle_flags & ISO_HANDLE_MASK);
+  if (iter == iso_streams.end()) {
+    iso_stats.packets_unrouted++;
+    osi_free(p_msg);
+    return;
+  }
+  tBTM_ISO_STREAM* stream = iter->second;
+  tBTM_ISO_SDU* sdu = iso_record_sdu(stream);
+  uint8_t pb_flag = ISO_PB_FLAG(handle_flags);
+
+  if (pb_flag == ISO_PB_FIRST_FRAGMENT || pb_flag == ISO_PB_COMPLETE_SDU) {
+    uint16_t hdr_len =
+        ISO_SDU_HDR_SIZE + ((handle_flags & ISO_TS_FLAG) ? ISO_TIME_STAMP_SIZE
+                                                         : 0);
+    if (data_load_len < hdr_len) {
+      iso_stats.packets_invalid++;
+      osi_free(p_msg);
+      return;
+    }
+    /* A new SDU ends the one being reassembled, which is lost */
+    if (stream->reassembling) iso_stats.sdus_dropped++;
+
+    uint32_t time_stamp = 0;
+    uint16_t seq_num, sdu_len_status;
+    if (handle_flags & ISO_TS_FLAG) STREAM_TO_UINT32(time_stamp, p);
+    STREAM_TO_UINT16(seq_num, p);
+    STREAM_TO_UINT16(sdu_len_status, p);
+    data_load_len -= hdr_len;
+
+    sdu->time_stamp = time_stamp;
+    sdu->seq_num = seq_num;
+    sdu->status =
+        static_cast<tBTM_ISO_SDU_STATUS>(ISO_PACKET_STATUS(sdu_len_status));
+    sdu->len = 0;
+    stream->sdu_len = sdu_len_status & ISO_SDU_LENGTH_MASK;
+    stream->reassembling = true;
+    if (stream->sdu_len > stream->max_sdu_len) {
+      LOG(WARNING) << __func__ << ": SDU of " << stream->sdu_len
+                   << " bytes, more than " << stream->max_sdu_len;
+      stream->reassembling = false;
+      iso_stats.sdus_dropped++;
+    }
+  } else if (!stream->reassembling) {
+    /* The first fragment was dropped already */
+    osi_free(p_msg);
+    return;
+  }
+
+  if (stream->reassembling) {
+    if (sdu->len + data_load_len > stream->sdu_len) {
+      stream->reassembling = false;
+      iso_stats.packets_invalid++;
+    } else {
+      memcpy(stream->record.data() + sizeof(tBTM_ISO_SDU) + sdu->len, p,
+             data_load_len);
+      sdu->len += data_load_len;
+      sdu->rx_timestamp_us = rx_timestamp_us;
+      if (pb_flag == ISO_PB_COMPLETE_SDU || pb_flag == ISO_PB_LAST_FRAGMENT) {
+        iso_stream_sdu_complete(stream);
+      }
+    }
+  }
+  osi_free(p_msg);
+}
+
+/*******************************************************************************
+ *
+ * Function         stack_debug_btm_iso_dump
+ *
+ * Description      Dump the statistics of the ISO data path.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void stack_debug_btm_iso_dump(int fd) {
+  dprintf(fd, "\nISO Data Path:\n");
+  dprintf(fd, "  streams: %zu on the %s\n", iso_stats.streams.load(),
+          btu_shard_is_threaded(BTU_SHARD_ISO) ? "ISO thread" : "main thread");
+  dprintf(fd, "  SDUs queued: %zu read: %zu lost: %zu dropped: %zu\n",
+          iso_stats.sdus_queued.load(), iso_stats.sdus_read.load(),
+          iso_stats.sdus_lost.load(), iso_stats.sdus_dropped.load());
+  dprintf(fd, "  packets invalid: %zu without stream: %zu\n",
+          iso_stats.packets_invalid.load(), iso_stats.packets_unrouted.load());
+  dprintf(fd, "  latency in ms to the queue:   ");
+  for (int i = 0; i < kLatencyBuckets; i++) {
+    dprintf(fd, " %s:%zu", kLatencyBucketNames[i],
+            iso_stats.queue_latency[i].load());
+  }
+  dprintf(fd, "\n  latency in ms to the consumer:");
+  for (int i = 0; i < kLatencyBuckets; i++) {
+    dprintf(fd, " %s:%zu", kLatencyBucketNames[i],
+            iso_stats.read_latency[i].load());
+  }
+  dprintf(fd, "\n");
+}
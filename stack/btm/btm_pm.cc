@@ -173,6 +173,7 @@ tBTM_STATUS BTM_SetPowerMode(uint8_t pm_id, const RawAddress& remote_bda,
   if (acl_ind == MAX_L2CAP_LINKS) return (BTM_UNKNOWN_ADDR);
 
   p_cb = &(btm_cb.pm_mode_db[acl_ind]);
+  btm_pm_policy_mode_req(acl_ind);
 
   if (mode != BTM_PM_MD_ACTIVE) {
     /* check if the requested mode is supported */
@@ -657,6 +658,8 @@ static tBTM_STATUS btm_pm_snd_md_req(uint8_t pm_id, int link_ind,
     return (BTM_NO_RESOURCES);
   }
 
+  btm_pm_policy_mode_cmd(link_ind, md_res.mode,
+                         p_cb->state & ~BTM_PM_STORED_MASK);
   return BTM_CMD_STARTED;
 }
 
@@ -768,6 +771,7 @@ void btm_pm_proc_mode_change(uint8_t hci_status, uint16_t hci_handle,
   old_state = p_cb->state;
   p_cb->state = mode;
   p_cb->interval = interval;
+  btm_pm_policy_mode_change(xx, mode);
 
   BTM_TRACE_DEBUG("%s switched from %s to %s.", __func__,
                   mode_to_string(old_state), mode_to_string(p_cb->state));
@@ -0,0 +1,346 @@
+/******************************************************************************
+ *
+ *  Copyright 2020 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This file contains the traffic aware part of the power mode management of
+ *  the ACL links. The gaps between the packets of each link are kept in a
+ *  histogram of the recent traffic, from which the delay after the latest
+ *  packet to enter sniff mode and the sniff interval are picked:
+ *
+ *  - the idle timeout is the gap that BTM_PM_IDLE_PERCENTILE percent of the
+ *    gaps are shorter than, so that bursty traffic keeps the link active for
+ *    the whole burst instead of entering sniff mode between its packets;
+ *  - the sniff interval is lowered so that the link wakes up a few times in
+ *    the typical idle period of the link, for the first packet after it not
+ *    to wait for most of the period.
+ *
+ *  Both stay within the bounds given by the profiles.
+ *
+ ******************************************************************************/
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include <algorithm>
+
+#include "bt_target.h"
+#include "btm_api.h"
+#include "btm_int.h"
+#include "common/time_util.h"
+
+/* Gaps needed before the traffic of a link is used */
+#define BTM_PM_MIN_GAP_SAMPLES 16
+/* The histogram is halved when it holds that many gaps */
+#define BTM_PM_GAP_DECAY_COUNT 256
+/* Share of the gaps the idle timeout is longer than */
+#define BTM_PM_IDLE_PERCENTILE 90
+/* The idle timeout stays within this factor of the one of the profiles */
+#define BTM_PM_IDLE_ADAPT_RANGE 4
+/* Sniff anchor points in the typical idle period of a link */
+#define BTM_PM_SNIFF_WAKES_PER_IDLE 8
+/* Sniff periods shorter than this are counted as thrashing */
+#define BTM_PM_SHORT_SNIFF_MS 1000
+
+/* Totals over all the links, including the disconnected ones */
+static struct {
+  uint32_t mode_reqs;
+  uint32_t mode_cmds;
+  uint32_t sniff_count;
+  uint32_t short_sniff_count;
+  uint32_t wake_count;
+  uint64_t wake_total_ms;
+  uint64_t wake_max_ms;
+} btm_pm_policy_totals;
+
+static uint8_t btm_pm_gap_bucket(uint64_t gap_ms) {
+  uint8_t bucket = 0;
+  while (gap_ms != 0 && bucket < BTM_PM_GAP_BUCKETS - 1) {
+    gap_ms >>= 1;
+    bucket++;
+  }
+  return bucket;
+}
+
+/* Returns the first bucket at which |percent| of the gaps are accounted for */
+static uint8_t btm_pm_gap_percentile(const tBTM_PM_TRAFFIC* p_traffic,
+                                     uint8_t first_bucket, uint32_t count,
+                                     uint8_t percent) {
+  uint32_t target = (count * percent + 99) / 100;
+  uint32_t seen = 0;
+  uint8_t bucket;
+  for (bucket = first_bucket; bucket < BTM_PM_GAP_BUCKETS - 1; bucket++) {
+    seen += p_traffic->gap_hist[bucket];
+    if (seen >= target) break;
+  }
+  return bucket;
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_pm_traffic_record
+ *
+ * Description      Records a packet of the link of |p_traffic| at |now_ms|.
+ *
+ ******************************************************************************/
+void btm_pm_traffic_record(tBTM_PM_TRAFFIC* p_traffic, uint64_t now_ms) {
+  if (p_traffic->last_traffic_ms != 0) {
+    if (p_traffic->gap_count >= BTM_PM_GAP_DECAY_COUNT) {
+      /* forget the older traffic */
+      p_traffic->gap_count = 0;
+      for (uint16_t& count : p_traffic->gap_hist) {
+        count /= 2;
+        p_traffic->gap_count += count;
+      }
+    }
+    p_traffic->gap_hist[btm_pm_gap_bucket(now_ms -
+                                          p_traffic->last_traffic_ms)]++;
+    p_traffic->gap_count++;
+  }
+  p_traffic->last_traffic_ms = now_ms;
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_pm_traffic_idle_timeout
+ *
+ * Description      Picks the delay after the latest packet of the link of
+ *                  |p_traffic| to enter sniff mode, within
+ *                  BTM_PM_IDLE_ADAPT_RANGE of |default_ms|.
+ *
+ * Returns          the timeout in milliseconds, |default_ms| until enough
+ *                  traffic has been seen.
+ *
+ ******************************************************************************/
+uint64_t btm_pm_traffic_idle_timeout(const tBTM_PM_TRAFFIC* p_traffic,
+                                     uint64_t default_ms) {
+  if (p_traffic->gap_count < BTM_PM_MIN_GAP_SAMPLES) return default_ms;
+
+  uint8_t bucket = btm_pm_gap_percentile(p_traffic, 0, p_traffic->gap_count,
+                                         BTM_PM_IDLE_PERCENTILE);
+  /* the upper bound of the bucket */
+  uint64_t timeout_ms = (uint64_t)1 << bucket;
+  timeout_ms = std::max(timeout_ms, default_ms / BTM_PM_IDLE_ADAPT_RANGE);
+  return std::min(timeout_ms, default_ms * BTM_PM_IDLE_ADAPT_RANGE);
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_pm_traffic_sniff_max
+ *
+ * Description      Picks the maximum sniff interval of the link of
+ *                  |p_traffic|, in slots, between |min| and |max|.
+ *
+ * Returns          the interval, |max| until idle periods have been seen.
+ *
+ ******************************************************************************/
+uint16_t btm_pm_traffic_sniff_max(const tBTM_PM_TRAFFIC* p_traffic,
+                                  uint16_t min, uint16_t max) {
+  if (p_traffic->gap_count < BTM_PM_MIN_GAP_SAMPLES) return max;
+
+  /* The gaps past the idle timeout are the idle periods of the link */
+  uint8_t idle_bucket =
+      btm_pm_gap_percentile(p_traffic, 0, p_traffic->gap_count,
+                            BTM_PM_IDLE_PERCENTILE) +
+      1;
+  uint32_t idle_count = 0;
+  for (uint8_t bucket = idle_bucket; bucket < BTM_PM_GAP_BUCKETS; bucket++)
+    idle_count += p_traffic->gap_hist[bucket];
+  if (idle_count == 0) return max;
+
+  uint8_t bucket =
+      btm_pm_gap_percentile(p_traffic, idle_bucket, idle_count, 50);
+  /* the lower bound of the bucket of the median idle period, in slots */
+  uint64_t idle_slots = ((uint64_t)1 << (bucket - 1)) * 1000 / 625;
+  uint64_t slots = (idle_slots / BTM_PM_SNIFF_WAKES_PER_IDLE) & ~1;
+  if (slots >= max) return max;
+  return std::max<uint64_t>(slots, min);
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_pm_policy_traffic
+ *
+ * Description      Records a packet received from or sent to the controller
+ *                  on the BR/EDR link of |hci_handle|.
+ *
+ ******************************************************************************/
+void btm_pm_policy_traffic(uint16_t hci_handle) {
+  uint8_t xx = btm_handle_to_acl_index(hci_handle);
+  if (xx >= MAX_L2CAP_LINKS) return;
+
+  btm_pm_traffic_record(&btm_cb.pm_mode_db[xx].traffic,
+                        bluetooth::common::time_get_os_boottime_ms());
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_pm_policy_mode_req
+ *
+ * Description      Counts a BTM_SetPowerMode() call for the link |link_ind|.
+ *
+ ******************************************************************************/
+void btm_pm_policy_mode_req(uint8_t link_ind) {
+  btm_cb.pm_mode_db[link_ind].traffic.mode_reqs++;
+  btm_pm_policy_totals.mode_reqs++;
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_pm_policy_mode_cmd
+ *
+ * Description      Counts a command sent to change the link |link_ind| from
+ *                  |state| to |mode|.
+ *
+ ******************************************************************************/
+void btm_pm_policy_mode_cmd(uint8_t link_ind, tBTM_PM_MODE mode,
+                            tBTM_PM_STATE state) {
+  tBTM_PM_TRAFFIC* p_traffic = &btm_cb.pm_mode_db[link_ind].traffic;
+
+  p_traffic->mode_cmds++;
+  btm_pm_policy_totals.mode_cmds++;
+  if (mode == BTM_PM_MD_ACTIVE &&
+      (state == BTM_PM_ST_SNIFF || state == BTM_PM_ST_PARK)) {
+    p_traffic->wake_since_ms = bluetooth::common::time_get_os_boottime_ms();
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_pm_policy_mode_change
+ *
+ * Description      Accounts for the change of the link |link_ind| to |mode|.
+ *
+ ******************************************************************************/
+void btm_pm_policy_mode_change(uint8_t link_ind, uint8_t mode) {
+  tBTM_PM_TRAFFIC* p_traffic = &btm_cb.pm_mode_db[link_ind].traffic;
+  uint64_t now_ms = bluetooth::common::time_get_os_boottime_ms();
+
+  if (p_traffic->sniff_since_ms != 0 && mode != BTM_PM_MD_SNIFF) {
+    if (now_ms - p_traffic->sniff_since_ms < BTM_PM_SHORT_SNIFF_MS) {
+      p_traffic->short_sniff_count++;
+      btm_pm_policy_totals.short_sniff_count++;
+    }
+    p_traffic->sniff_since_ms = 0;
+  }
+
+  if (mode == BTM_PM_MD_SNIFF) {
+    p_traffic->sniff_count++;
+    btm_pm_policy_totals.sniff_count++;
+    p_traffic->sniff_since_ms = now_ms;
+  } else if (mode == BTM_PM_MD_ACTIVE && p_traffic->wake_since_ms != 0) {
+    uint64_t wake_ms = now_ms - p_traffic->wake_since_ms;
+    p_traffic->wake_count++;
+    p_traffic->wake_total_ms += wake_ms;
+    p_traffic->wake_max_ms = std::max(p_traffic->wake_max_ms, wake_ms);
+    btm_pm_policy_totals.wake_count++;
+    btm_pm_policy_totals.wake_total_ms += wake_ms;
+    btm_pm_policy_totals.wake_max_ms =
+        std::max(btm_pm_policy_totals.wake_max_ms, wake_ms);
+    p_traffic->wake_since_ms = 0;
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         BTM_PmGetIdleTimeout
+ *
+ * Description      Picks the delay after the latest packet to put the link to
+ *                  |bda| in sniff mode, from its traffic.
+ *
+ * Returns          the delay in milliseconds, within a factor of the profile
+ *                  delay |default_ms|.
+ *
+ ******************************************************************************/
+uint64_t BTM_PmGetIdleTimeout(const RawAddress& bda, uint64_t default_ms) {
+  tACL_CONN* p = btm_bda_to_acl(bda, BT_TRANSPORT_BR_EDR);
+  if (p == NULL) return default_ms;
+
+  return btm_pm_traffic_idle_timeout(
+      &btm_cb.pm_mode_db[p - btm_cb.acl_db].traffic, default_ms);
+}
+
+/*******************************************************************************
+ *
+ * Function         BTM_PmAdaptSniffMode
+ *
+ * Description      Lowers the maximum interval of the sniff mode |p_mode| of
+ *                  the link to |bda| to the idle periods of its traffic.
+ *
+ ******************************************************************************/
+void BTM_PmAdaptSniffMode(const RawAddress& bda, tBTM_PM_PWR_MD* p_mode) {
+  if ((p_mode->mode & ~BTM_PM_MD_FORCE) != BTM_PM_MD_SNIFF) return;
+
+  tACL_CONN* p = btm_bda_to_acl(bda, BT_TRANSPORT_BR_EDR);
+  if (p == NULL) return;
+
+  p_mode->max = btm_pm_traffic_sniff_max(
+      &btm_cb.pm_mode_db[p - btm_cb.acl_db].traffic, p_mode->min,
+      p_mode->max);
+}
+
+/*******************************************************************************
+ *
+ * Function         stack_debug_btm_pm_dump
+ *
+ * Description      Dump the power mode changes of the ACL links to |fd|.
+ *
+ ******************************************************************************/
+void stack_debug_btm_pm_dump(int fd) {
+  dprintf(fd, "\nBTM power mode:\n");
+  dprintf(fd,
+          "  Requests: %u, commands: %u, sniff entries: %u (shorter than "
+          "%d ms: %u)\n",
+          btm_pm_policy_totals.mode_reqs, btm_pm_policy_totals.mode_cmds,
+          btm_pm_policy_totals.sniff_count, BTM_PM_SHORT_SNIFF_MS,
+          btm_pm_policy_totals.short_sniff_count);
+  dprintf(fd,
+          "  Wakes: %u, latency avg %" PRIu64 " ms, max %" PRIu64 " ms\n",
+          btm_pm_policy_totals.wake_count,
+          btm_pm_policy_totals.wake_count
+              ? btm_pm_policy_totals.wake_total_ms /
+                    btm_pm_policy_totals.wake_count
+              : 0,
+          btm_pm_policy_totals.wake_max_ms);
+
+  for (uint8_t xx = 0; xx < MAX_L2CAP_LINKS; xx++) {
+    const tACL_CONN* p = &btm_cb.acl_db[xx];
+    if (!p->in_use || p->transport != BT_TRANSPORT_BR_EDR) continue;
+
+    const tBTM_PM_MCB* p_cb = &btm_cb.pm_mode_db[xx];
+    const tBTM_PM_TRAFFIC* p_traffic = &p_cb->traffic;
+    dprintf(fd, "  %s handle 0x%04x state %d interval %d:\n",
+            p->remote_addr.ToString().c_str(), p->hci_handle, p_cb->state,
+            p_cb->interval);
+    dprintf(fd,
+            "    requests: %u, commands: %u, sniff entries: %u (short: %u), "
+            "wakes: %u (avg %" PRIu64 " ms, max %" PRIu64 " ms)\n",
+            p_traffic->mode_reqs, p_traffic->mode_cmds, p_traffic->sniff_count,
+            p_traffic->short_sniff_count, p_traffic->wake_count,
+            p_traffic->wake_count
+                ? p_traffic->wake_total_ms / p_traffic->wake_count
+                : 0,
+            p_traffic->wake_max_ms);
+    if (p_traffic->gap_count < BTM_PM_MIN_GAP_SAMPLES) continue;
+    dprintf(fd, "    %u gaps, %d%% under %" PRIu64 " ms\n",
+            p_traffic->gap_count, BTM_PM_IDLE_PERCENTILE,
+            (uint64_t)1 << btm_pm_gap_percentile(p_traffic, 0,
+                                                 p_traffic->gap_count,
+                                                 BTM_PM_IDLE_PERCENTILE));
+  }
+}
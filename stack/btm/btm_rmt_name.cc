@@ -0,0 +1,409 @@
+/******************************************************************************
+ *
+ *  Copyright 2020 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This file contains the handling of the BR/EDR remote name requests made
+ *  through BTM_ReadRemoteDeviceName:
+ *
+ *  - the names received, from remote name requests or from the complete
+ *    local names of the EIRs, are kept for BTM_RMT_NAME_CACHE_TTL_MS in a
+ *    cache; a request for a name in it is answered without paging the device;
+ *  - a request for the device whose name is being requested is answered along
+ *    with the request in progress;
+ *  - other requests are queued behind the one in progress instead of failing
+ *    with BTM_BUSY, the user visible ones first.
+ *
+ *  The requests without a callback, made by the security manager, wait for
+ *  the remote name request complete event and are never answered from the
+ *  cache nor queued.
+ *
+ ******************************************************************************/
+
+#include <base/bind.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bt_target.h"
+#include "btm_api.h"
+#include "btm_int.h"
+#include "btu.h"
+#include "common/time_util.h"
+
+/* Callbacks waiting for the name of one device */
+#define BTM_RMT_NAME_MAX_WAITERS 4
+
+typedef struct {
+  bool in_use;
+  RawAddress bda;
+  uint64_t time_ms; /* when the name was received */
+  uint32_t use_seq; /* for the least recently used to be replaced */
+  uint16_t length;
+  BD_NAME name;
+} tBTM_RMT_NAME_CACHE_ENT;
+
+typedef struct {
+  bool in_use;
+  RawAddress bda;
+  tBTM_RMT_NAME_PRIORITY priority;
+  uint32_t seq; /* order of arrival within a priority */
+  uint8_t num_cb;
+  tBTM_CMPL_CB* p_cb[BTM_RMT_NAME_MAX_WAITERS];
+} tBTM_RMT_NAME_REQ;
+
+static struct {
+  tBTM_RMT_NAME_CACHE_ENT cache[BTM_RMT_NAME_CACHE_SIZE];
+  uint32_t use_seq;
+
+  /* The BR/EDR request in progress, if started here. Its first callback is
+     btm_cb.btm_inq_vars.p_remname_cmpl_cb, the others wait here. */
+  bool active;
+  uint64_t active_start_ms;
+  uint8_t active_num_cb;
+  tBTM_CMPL_CB* active_p_cb[BTM_RMT_NAME_MAX_WAITERS];
+  bool flush_on_complete; /* BTM_CancelRemoteDeviceName was called */
+
+  tBTM_RMT_NAME_REQ queue[BTM_RMT_NAME_QUEUE_SIZE];
+  uint32_t queue_seq;
+
+  /* Statistics, since start up */
+  uint32_t lookups;
+  uint32_t hits;
+  uint32_t eir_names;
+  uint32_t coalesced;
+  uint32_t queued;
+  uint32_t busy;
+  uint32_t rnr_count;
+  uint32_t rnr_failed;
+  uint64_t rnr_total_ms;
+  uint64_t rnr_max_ms;
+} btm_rmt_name_cb;
+
+static void btm_rmt_name_deliver(tBTM_CMPL_CB* p_cb,
+                                 tBTM_REMOTE_DEV_NAME rem_name) {
+  (*p_cb)(&rem_name);
+}
+
+static void btm_rmt_name_fail(const RawAddress& bda, tBTM_STATUS status,
+                              uint8_t num_cb, tBTM_CMPL_CB* const* p_cb) {
+  tBTM_REMOTE_DEV_NAME rem_name;
+  rem_name.status = status;
+  rem_name.bd_addr = bda;
+  rem_name.length = 0;
+  rem_name.remote_bd_name[0] = 0;
+  for (uint8_t xx = 0; xx < num_cb; xx++) (*p_cb[xx])(&rem_name);
+}
+
+static bool btm_rmt_name_add_cb(tBTM_CMPL_CB** p_cbs, uint8_t* p_num_cb,
+                                tBTM_CMPL_CB* p_cb) {
+  for (uint8_t xx = 0; xx < *p_num_cb; xx++) {
+    if (p_cbs[xx] == p_cb) return true;
+  }
+  if (*p_num_cb == BTM_RMT_NAME_MAX_WAITERS) return false;
+  p_cbs[(*p_num_cb)++] = p_cb;
+  return true;
+}
+
+/* Starts the request for |bda| with the callbacks |p_cb|, which must not be
+ * empty. Returns the status of btm_initiate_rem_name. */
+static tBTM_STATUS btm_rmt_name_start(const RawAddress& bda, uint8_t num_cb,
+                                      tBTM_CMPL_CB* const* p_cb) {
+  tBTM_STATUS status = btm_initiate_rem_name(
+      bda, BTM_RMT_NAME_EXT, BTM_EXT_RMT_NAME_TIMEOUT_MS, p_cb[0]);
+  if (status != BTM_CMD_STARTED) return status;
+
+  btm_rmt_name_cb.active = true;
+  btm_rmt_name_cb.active_start_ms =
+      bluetooth::common::time_get_os_boottime_ms();
+  btm_rmt_name_cb.active_num_cb = num_cb - 1;
+  for (uint8_t xx = 1; xx < num_cb; xx++)
+    btm_rmt_name_cb.active_p_cb[xx - 1] = p_cb[xx];
+  btm_rmt_name_cb.rnr_count++;
+  return status;
+}
+
+/* Returns the queued request to start next, NULL if there is none */
+static tBTM_RMT_NAME_REQ* btm_rmt_name_queue_next(void) {
+  tBTM_RMT_NAME_REQ* p_next = NULL;
+  for (tBTM_RMT_NAME_REQ& req : btm_rmt_name_cb.queue) {
+    if (!req.in_use) continue;
+    if (p_next == NULL || req.priority > p_next->priority ||
+        (req.priority == p_next->priority && req.seq < p_next->seq))
+      p_next = &req;
+  }
+  return p_next;
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_rmt_name_init
+ *
+ * Description      This function is called at startup to drop the requests
+ *                  of a previous run. The names stay in the cache.
+ *
+ ******************************************************************************/
+void btm_rmt_name_init(void) {
+  btm_rmt_name_cb.active = false;
+  btm_rmt_name_cb.active_num_cb = 0;
+  btm_rmt_name_cb.flush_on_complete = false;
+  for (tBTM_RMT_NAME_REQ& req : btm_rmt_name_cb.queue) req.in_use = false;
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_rmt_name_cache_add
+ *
+ * Description      This function stores the name of |bda|, replacing the
+ *                  least recently used name if the cache is full.
+ *
+ ******************************************************************************/
+void btm_rmt_name_cache_add(const RawAddress& bda, const uint8_t* p_name,
+                            uint16_t length) {
+  tBTM_RMT_NAME_CACHE_ENT* p_ent = NULL;
+  for (tBTM_RMT_NAME_CACHE_ENT& ent : btm_rmt_name_cb.cache) {
+    if (ent.in_use && ent.bda == bda) {
+      p_ent = &ent;
+      break;
+    }
+    if (p_ent == NULL || !ent.in_use ||
+        (p_ent->in_use && ent.use_seq < p_ent->use_seq))
+      p_ent = &ent;
+  }
+
+  if (length > BD_NAME_LEN) length = BD_NAME_LEN;
+  p_ent->in_use = true;
+  p_ent->bda = bda;
+  p_ent->time_ms = bluetooth::common::time_get_os_boottime_ms();
+  p_ent->use_seq = ++btm_rmt_name_cb.use_seq;
+  p_ent->length = length;
+  memcpy(p_ent->name, p_name, length);
+  p_ent->name[length] = 0;
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_rmt_name_cache_add_eir
+ *
+ * Description      This function stores the complete local name found in the
+ *                  EIR of an inquiry result of |bda|.
+ *
+ ******************************************************************************/
+void btm_rmt_name_cache_add_eir(const RawAddress& bda, const uint8_t* p_name,
+                                uint16_t length) {
+  btm_rmt_name_cb.eir_names++;
+  btm_rmt_name_cache_add(bda, p_name, length);
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_rmt_name_cache_find
+ *
+ * Description      This function looks for a name of |bda| received less than
+ *                  BTM_RMT_NAME_CACHE_TTL_MS ago.
+ *
+ * Returns          true if found, the name in |p_rem_name|
+ *
+ ******************************************************************************/
+bool btm_rmt_name_cache_find(const RawAddress& bda,
+                             tBTM_REMOTE_DEV_NAME* p_rem_name) {
+  uint64_t now_ms = bluetooth::common::time_get_os_boottime_ms();
+  for (tBTM_RMT_NAME_CACHE_ENT& ent : btm_rmt_name_cb.cache) {
+    if (!ent.in_use || ent.bda != bda) continue;
+    if (now_ms - ent.time_ms >= BTM_RMT_NAME_CACHE_TTL_MS) {
+      ent.in_use = false;
+      return false;
+    }
+    ent.use_seq = ++btm_rmt_name_cb.use_seq;
+    p_rem_name->status = BTM_SUCCESS;
+    p_rem_name->bd_addr = bda;
+    p_rem_name->length = ent.length;
+    memcpy(p_rem_name->remote_bd_name, ent.name, ent.length + 1);
+    return true;
+  }
+  return false;
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_rmt_name_request
+ *
+ * Description      This function is called for a BR/EDR remote name request
+ *                  of BTM_ReadRemoteDeviceName.
+ *
+ * Returns          BTM_CMD_STARTED if answered from the cache, joined with
+ *                                  the request in progress, queued or
+ *                                  started; |p_cb| is called later
+ *                  BTM_BUSY if another request is in progress and this one
+ *                           could not be queued
+ *                  the status of btm_initiate_rem_name otherwise
+ *
+ ******************************************************************************/
+tBTM_STATUS btm_rmt_name_request(const RawAddress& bda, tBTM_CMPL_CB* p_cb,
+                                 tBTM_RMT_NAME_PRIORITY priority) {
+  tBTM_INQUIRY_VAR_ST* p_inq = &btm_cb.btm_inq_vars;
+  tBTM_REMOTE_DEV_NAME rem_name;
+
+  if (p_cb != NULL) {
+    btm_rmt_name_cb.lookups++;
+    if (btm_rmt_name_cache_find(bda, &rem_name)) {
+      btm_rmt_name_cb.hits++;
+      /* the callers expect the callback after this returns */
+      do_in_main_thread(FROM_HERE,
+                        base::Bind(&btm_rmt_name_deliver, p_cb, rem_name));
+      return BTM_CMD_STARTED;
+    }
+  }
+
+  if (!p_inq->remname_active) {
+    tBTM_CMPL_CB* p_cbs[1] = {p_cb};
+    return btm_rmt_name_start(bda, 1, p_cbs);
+  }
+
+  if (btm_rmt_name_cb.active && p_inq->remname_bda == bda) {
+    if (p_cb == NULL || p_cb == p_inq->p_remname_cmpl_cb ||
+        btm_rmt_name_add_cb(btm_rmt_name_cb.active_p_cb,
+                            &btm_rmt_name_cb.active_num_cb, p_cb)) {
+      btm_rmt_name_cb.coalesced++;
+      return BTM_CMD_STARTED;
+    }
+  }
+
+  if (p_cb == NULL) {
+    btm_rmt_name_cb.busy++;
+    return BTM_BUSY;
+  }
+
+  tBTM_RMT_NAME_REQ* p_free = NULL;
+  for (tBTM_RMT_NAME_REQ& req : btm_rmt_name_cb.queue) {
+    if (req.in_use && req.bda == bda) {
+      if (!btm_rmt_name_add_cb(req.p_cb, &req.num_cb, p_cb)) break;
+      if (priority > req.priority) req.priority = priority;
+      btm_rmt_name_cb.coalesced++;
+      return BTM_CMD_STARTED;
+    }
+    if (!req.in_use && p_free == NULL) p_free = &req;
+  }
+
+  if (p_free == NULL) {
+    btm_rmt_name_cb.busy++;
+    return BTM_BUSY;
+  }
+
+  p_free->in_use = true;
+  p_free->bda = bda;
+  p_free->priority = priority;
+  p_free->seq = ++btm_rmt_name_cb.queue_seq;
+  p_free->num_cb = 1;
+  p_free->p_cb[0] = p_cb;
+  btm_rmt_name_cb.queued++;
+  return BTM_CMD_STARTED;
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_rmt_name_cancel
+ *
+ * Description      This function is called when the remote name request in
+ *                  progress is cancelled. The queued requests fail along with
+ *                  it.
+ *
+ ******************************************************************************/
+void btm_rmt_name_cancel(void) { btm_rmt_name_cb.flush_on_complete = true; }
+
+/*******************************************************************************
+ *
+ * Function         btm_rmt_name_complete
+ *
+ * Description      This function is called when the remote name request in
+ *                  progress completes, with the callback it was started with.
+ *                  The next queued request is started before the callbacks
+ *                  are called, so that the requests they make queue up behind
+ *                  those already waiting.
+ *
+ ******************************************************************************/
+void btm_rmt_name_complete(tBTM_REMOTE_DEV_NAME* p_rem_name,
+                           tBTM_CMPL_CB* p_cb) {
+  uint8_t num_cb = 0;
+  tBTM_CMPL_CB* p_cbs[BTM_RMT_NAME_MAX_WAITERS + 1];
+
+  if (p_cb) p_cbs[num_cb++] = p_cb;
+  if (btm_rmt_name_cb.active) {
+    uint64_t elapsed_ms = bluetooth::common::time_get_os_boottime_ms() -
+                          btm_rmt_name_cb.active_start_ms;
+    btm_rmt_name_cb.rnr_total_ms += elapsed_ms;
+    if (elapsed_ms > btm_rmt_name_cb.rnr_max_ms)
+      btm_rmt_name_cb.rnr_max_ms = elapsed_ms;
+    if (p_rem_name->status == BTM_SUCCESS)
+      btm_rmt_name_cache_add(p_rem_name->bd_addr, p_rem_name->remote_bd_name,
+                             p_rem_name->length);
+    else
+      btm_rmt_name_cb.rnr_failed++;
+
+    for (uint8_t xx = 0; xx < btm_rmt_name_cb.active_num_cb; xx++)
+      p_cbs[num_cb++] = btm_rmt_name_cb.active_p_cb[xx];
+    btm_rmt_name_cb.active = false;
+    btm_rmt_name_cb.active_num_cb = 0;
+  }
+
+  bool flush = btm_rmt_name_cb.flush_on_complete;
+  btm_rmt_name_cb.flush_on_complete = false;
+  tBTM_RMT_NAME_REQ* p_next;
+  while ((p_next = btm_rmt_name_queue_next()) != NULL) {
+    tBTM_RMT_NAME_REQ req = *p_next;
+    p_next->in_use = false;
+    tBTM_STATUS status = BTM_BAD_VALUE_RET;
+    if (!flush) status = btm_rmt_name_start(req.bda, req.num_cb, req.p_cb);
+    if (status == BTM_CMD_STARTED) break;
+    btm_rmt_name_fail(req.bda, status, req.num_cb, req.p_cb);
+  }
+
+  for (uint8_t xx = 0; xx < num_cb; xx++) (*p_cbs[xx])(p_rem_name);
+}
+
+/*******************************************************************************
+ *
+ * Function         stack_debug_btm_rmt_name_dump
+ *
+ * Description      Dump the statistics of the remote name requests to |fd|.
+ *
+ ******************************************************************************/
+void stack_debug_btm_rmt_name_dump(int fd) {
+  uint32_t cached = 0;
+  for (const tBTM_RMT_NAME_CACHE_ENT& ent : btm_rmt_name_cb.cache) {
+    if (ent.in_use) cached++;
+  }
+
+  dprintf(fd, "\nBTM remote names:\n");
+  dprintf(fd,
+          "  Cached: %u/%d, lookups: %u, hits: %u, names from EIR: %u\n",
+          cached, BTM_RMT_NAME_CACHE_SIZE, btm_rmt_name_cb.lookups,
+          btm_rmt_name_cb.hits, btm_rmt_name_cb.eir_names);
+  dprintf(fd, "  Coalesced: %u, queued: %u, busy: %u\n",
+          btm_rmt_name_cb.coalesced, btm_rmt_name_cb.queued,
+          btm_rmt_name_cb.busy);
+  dprintf(fd,
+          "  Requests: %u (failed: %u), total %" PRIu64 " ms, avg %" PRIu64
+          " ms, max %" PRIu64 " ms\n",
+          btm_rmt_name_cb.rnr_count, btm_rmt_name_cb.rnr_failed,
+          btm_rmt_name_cb.rnr_total_ms,
+          btm_rmt_name_cb.rnr_count
+              ? btm_rmt_name_cb.rnr_total_ms / btm_rmt_name_cb.rnr_count
+              : 0,
+          btm_rmt_name_cb.rnr_max_ms);
+}
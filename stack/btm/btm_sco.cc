@@ -39,6 +39,7 @@
 #include "hcidefs.h"
 #include "hcimsgs.h"
 #include "osi/include/osi.h"
+#include "osi/include/properties.h"
 
 /******************************************************************************/
 /*               L O C A L    D A T A    D E F I N I T I O N S                */
@@ -59,6 +60,7 @@
 /******************************************************************************/
 
 static uint16_t btm_sco_voice_settings_to_legacy(enh_esco_params_t* p_parms);
+static void btm_sco_set_data_path(enh_esco_params_t* p_setup);
 
 /*******************************************************************************
  *
@@ -70,7 +72,7 @@ static uint16_t btm_sco_voice_settings_to_legacy(enh_esco_params_t* p_parms);
  * Returns          void
  *
  ******************************************************************************/
-void btm_sco_flush_sco_data(UNUSED_ATTR uint16_t sco_inx) {}
+void btm_sco_flush_sco_data(uint16_t sco_inx) { btm_sco_hci_close(sco_inx); }
 
 /*******************************************************************************
  *
@@ -86,7 +88,37 @@ void btm_sco_init(void) {
   btm_cb.sco_cb.sco_disc_reason = BTM_INVALID_SCO_DISC_REASON;
   btm_cb.sco_cb.def_esco_parms = esco_parameters_for_codec(ESCO_CODEC_CVSD);
   btm_cb.sco_cb.def_esco_parms.max_latency_ms = 12;
-  btm_cb.sco_cb.sco_route = ESCO_DATA_PATH_PCM;
+  btm_cb.sco_cb.sco_route =
+      osi_property_get_bool("persist.bluetooth.sco_over_hci", false)
+          ? ESCO_DATA_PATH_HCI
+          : ESCO_DATA_PATH_PCM;
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_sco_set_data_path
+ *
+ * Description      Sets the saved SCO routing in the enhanced setup
+ *                  parameters. When mSBC goes over HCI, the host codes it and
+ *                  the controller carries transparent data.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void btm_sco_set_data_path(enh_esco_params_t* p_setup) {
+  p_setup->input_data_path = p_setup->output_data_path =
+      btm_cb.sco_cb.sco_route;
+
+  if (btm_cb.sco_cb.sco_route != ESCO_DATA_PATH_HCI ||
+      p_setup->transmit_coding_format.coding_format != ESCO_CODING_FORMAT_MSBC)
+    return;
+
+  p_setup->input_coding_format.coding_format = ESCO_CODING_FORMAT_TRANSPNT;
+  p_setup->output_coding_format.coding_format = ESCO_CODING_FORMAT_TRANSPNT;
+  p_setup->input_bandwidth = p_setup->output_bandwidth = TXRX_64KBITS_RATE;
+  p_setup->input_coded_data_size = p_setup->output_coded_data_size = 8;
+  p_setup->input_pcm_data_format = p_setup->output_pcm_data_format =
+      ESCO_PCM_DATA_FORMAT_NA;
 }
 
 /*******************************************************************************
@@ -165,8 +197,7 @@ static void btm_esco_conn_rsp(uint16_t sco_inx, uint8_t hci_status,
     if (controller_get_interface()
             ->supports_enhanced_setup_synchronous_connection()) {
       /* Use the saved SCO routing */
-      p_setup->input_data_path = p_setup->output_data_path =
-          btm_cb.sco_cb.sco_route;
+      btm_sco_set_data_path(p_setup);
 
       BTM_TRACE_DEBUG(
           "%s: txbw 0x%x, rxbw 0x%x, lat 0x%x, retrans 0x%02x, "
@@ -199,6 +230,25 @@ static void btm_esco_conn_rsp(uint16_t sco_inx, uint8_t hci_status,
  *
  ******************************************************************************/
 void btm_route_sco_data(BT_HDR* p_msg) {
+#if (BTM_MAX_SCO_LINKS > 0)
+  uint8_t* p = (uint8_t*)(p_msg + 1) + p_msg->offset;
+  uint16_t handle;
+  uint8_t len;
+
+  if (p_msg->len >= HCI_SCO_PREAMBLE_SIZE) {
+    STREAM_TO_UINT16(handle, p);
+    STREAM_TO_UINT8(len, p);
+    uint16_t sco_inx = btm_find_scb_by_handle(HCID_GET_HANDLE(handle));
+
+    if (len > p_msg->len - HCI_SCO_PREAMBLE_SIZE) {
+      BTM_TRACE_WARNING("%s: truncated packet, len %d", __func__, len);
+    } else if (sco_inx < BTM_MAX_SCO_LINKS &&
+               btm_cb.sco_cb.sco_route == ESCO_DATA_PATH_HCI) {
+      /* Packet_Status_Flag, 0 when correctly received */
+      btm_sco_hci_receive(sco_inx, p, len, (handle >> 12) & 0x03);
+    }
+  }
+#endif
   osi_free(p_msg);
 }
 
@@ -210,8 +260,8 @@ void btm_route_sco_data(BT_HDR* p_msg) {
  *                  data to be written p_buf needs to carry an offset of
  *                  HCI_SCO_PREAMBLE_SIZE bytes, and the data length can not
  *                  exceed BTM_SCO_DATA_SIZE_MAX bytes, whose default value is
- *                  set to 60 and is configurable. Data longer than the maximum
- *                  bytes will be truncated.
+ *                  set to 240 and is configurable. Data longer than the
+ *                  maximum bytes will be truncated. p_buf is always consumed.
  *
  * Returns          BTM_SUCCESS: data write is successful
  *                  BTM_ILLEGAL_VALUE: SCO data contains illegal offset value.
@@ -223,9 +273,49 @@ void btm_route_sco_data(BT_HDR* p_msg) {
  *
  *
  ******************************************************************************/
-tBTM_STATUS BTM_WriteScoData(UNUSED_ATTR uint16_t sco_inx,
-                             UNUSED_ATTR BT_HDR* p_buf) {
-  return (BTM_NO_RESOURCES);
+tBTM_STATUS BTM_WriteScoData(uint16_t sco_inx, BT_HDR* p_buf) {
+#if (BTM_MAX_SCO_LINKS > 0)
+  tSCO_CONN* p_ccb;
+  uint8_t* p;
+  tBTM_STATUS status = BTM_SUCCESS;
+
+  if (sco_inx >= BTM_MAX_SCO_LINKS ||
+      btm_cb.sco_cb.sco_route != ESCO_DATA_PATH_HCI ||
+      btm_cb.sco_cb.sco_db[sco_inx].state != SCO_ST_CONNECTED) {
+    BTM_TRACE_ERROR("%s: sco_inx %d not routed over HCI", __func__, sco_inx);
+    osi_free(p_buf);
+    return BTM_UNKNOWN_ADDR;
+  }
+
+  /* Ensure we have enough space in the buffer for the SCO and HCI headers */
+  if (p_buf->offset < HCI_SCO_PREAMBLE_SIZE) {
+    BTM_TRACE_ERROR("%s: cannot send buffer, offset %d", __func__,
+                    p_buf->offset);
+    osi_free(p_buf);
+    return BTM_ILLEGAL_VALUE;
+  }
+
+  p_ccb = &btm_cb.sco_cb.sco_db[sco_inx];
+
+  /* Step back to add the header */
+  p_buf->offset -= HCI_SCO_PREAMBLE_SIZE;
+  p = (uint8_t*)(p_buf + 1) + p_buf->offset;
+  UINT16_TO_STREAM(p, p_ccb->hci_handle);
+
+  /* Only send the first BTM_SCO_DATA_SIZE_MAX bytes */
+  if (p_buf->len > BTM_SCO_DATA_SIZE_MAX) {
+    p_buf->len = BTM_SCO_DATA_SIZE_MAX;
+    status = BTM_SCO_BAD_LENGTH;
+  }
+  UINT8_TO_STREAM(p, (uint8_t)p_buf->len);
+  p_buf->len += HCI_SCO_PREAMBLE_SIZE;
+
+  bte_main_hci_send(p_buf, BT_EVT_TO_LM_HCI_SCO | LOCAL_BR_EDR_CONTROLLER_ID);
+  return status;
+#else
+  osi_free(p_buf);
+  return BTM_NO_RESOURCES;
+#endif
 }
 
 #if (BTM_MAX_SCO_LINKS > 0)
@@ -311,8 +401,7 @@ static tBTM_STATUS btm_send_connect_request(uint16_t acl_handle,
     if (controller_get_interface()
             ->supports_enhanced_setup_synchronous_connection()) {
       /* Use the saved SCO routing */
-      p_setup->input_data_path = p_setup->output_data_path =
-          btm_cb.sco_cb.sco_route;
+      btm_sco_set_data_path(p_setup);
       LOG(INFO) << __func__ << std::hex << ": enhanced parameter list"
                 << " txbw=0x" << unsigned(p_setup->transmit_bandwidth)
                 << ", rxbw=0x" << unsigned(p_setup->receive_bandwidth)
@@ -839,6 +928,12 @@ void btm_sco_connected(uint8_t hci_status, const RawAddress* bda,
         if (p_esco_data) p->esco.data = *p_esco_data;
       }
 
+      if (btm_cb.sco_cb.sco_route == ESCO_DATA_PATH_HCI) {
+        bool wideband = p->esco.setup.transmit_coding_format.coding_format ==
+                        ESCO_CODING_FORMAT_MSBC;
+        btm_sco_hci_open(xx, wideband);
+      }
+
       (*p->p_conn_cb)(xx);
 
       return;
@@ -1186,8 +1281,7 @@ tBTM_STATUS BTM_ChangeEScoLinkParms(uint16_t sco_inx,
     if (controller_get_interface()
             ->supports_enhanced_setup_synchronous_connection()) {
       /* Use the saved SCO routing */
-      p_setup->input_data_path = p_setup->output_data_path =
-          btm_cb.sco_cb.sco_route;
+      btm_sco_set_data_path(p_setup);
 
       btsnd_hcic_enhanced_set_up_synchronous_connection(p_sco->hci_handle,
                                                         p_setup);
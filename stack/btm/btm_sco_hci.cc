@@ -0,0 +1,520 @@
+/******************************************************************************
+ *
+ *  Copyright 2020 Google, Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This file contains the software codec path of SCO links routed over HCI:
+ *  mSBC frames in H2 synchronization headers for wideband speech, or raw
+ *  CVSD-rate PCM for narrowband, with packet loss concealment, and the rings
+ *  exchanging PCM with the audio HAL.
+ *
+ *  The link clocks the audio: every received packet is decoded into the
+ *  speaker ring and answered by a packet of the same length built from the
+ *  microphone ring. Both rings are short and drop their oldest audio when
+ *  full, so a late reader cannot build up latency.
+ *
+ ******************************************************************************/
+
+#include <base/logging.h>
+#include <string.h>
+#include <algorithm>
+#include <mutex>
+
+#include "bt_common.h"
+#include "bt_target.h"
+#include "bt_types.h"
+#include "btm_api.h"
+#include "btm_int.h"
+#include "common/time_util.h"
+#include "embdrv/sbc/decoder/include/oi_codec_sbc.h"
+#include "embdrv/sbc/decoder/include/sbc_plc.h"
+#include "embdrv/sbc/encoder/include/sbc_encoder.h"
+#include "hcidefs.h"
+#include "osi/include/ringbuffer.h"
+
+/* Audio buffered towards, and from, the audio HAL */
+#ifndef BTM_SCO_HCI_RING_MS
+#define BTM_SCO_HCI_RING_MS 40
+#endif
+
+/* An mSBC frame in its H2 synchronization header, padded to an eSCO packet */
+#define BTM_MSBC_H2_HEADER_0 0x01
+#define BTM_MSBC_H2_HEADER_LEN 2
+#define BTM_MSBC_PKT_LEN 60
+
+/* Second H2 header byte for sequence numbers 0 to 3 */
+static const uint8_t btm_msbc_h2_header_1[] = {0x08, 0x38, 0xc8, 0xf8};
+
+typedef struct {
+  bool active;
+  uint16_t sco_inx;
+  bool wideband;
+  uint32_t bytes_per_ms;
+
+  /* Shared with the audio HAL, under btm_sco_hci_lock */
+  ringbuffer_t* rx_ring;
+  ringbuffer_t* tx_ring;
+  tBTM_SCO_HCI_STATS stats;
+  uint64_t start_ms;
+  uint64_t rx_latency_sum_ms;
+
+  SBC_PLC_STATE plc;
+
+  /* mSBC receive side: the frame being reassembled from the packets */
+  OI_CODEC_SBC_DECODER_CONTEXT decoder;
+  uint32_t decoder_data[CODEC_DATA_WORDS(1, SBC_CODEC_FAST_FILTER_BUFFERS)];
+  uint8_t rx_frame[BTM_MSBC_PKT_LEN];
+  uint8_t rx_frame_len;
+  bool rx_frame_damaged;
+  bool rx_seq_known;
+  uint8_t rx_seq;
+
+  /* mSBC send side: encoded bytes not sent yet */
+  SBC_ENC_PARAMS encoder;
+  uint8_t tx_pending[BTM_SCO_DATA_SIZE_MAX + BTM_MSBC_PKT_LEN];
+  uint16_t tx_pending_len;
+  uint8_t tx_seq;
+} tBTM_SCO_HCI_CB;
+
+static std::mutex btm_sco_hci_lock;
+static tBTM_SCO_HCI_CB btm_sco_hci_cb;
+
+/*******************************************************************************
+ *
+ * Function         btm_sco_hci_ring_write
+ *
+ * Description      Appends len bytes to the ring, deleting the oldest ones
+ *                  when it is full. Must be called with btm_sco_hci_lock held.
+ *
+ * Returns          number of bytes deleted
+ *
+ ******************************************************************************/
+static uint32_t btm_sco_hci_ring_write(ringbuffer_t* ring, const uint8_t* p,
+                                       size_t len) {
+  size_t size = ringbuffer_size(ring) + ringbuffer_available(ring);
+  uint32_t dropped = 0;
+
+  if (len > size) {
+    dropped += len - size;
+    p += len - size;
+    len = size;
+  }
+  if (len > ringbuffer_available(ring)) {
+    dropped += ringbuffer_delete(ring, len - ringbuffer_available(ring));
+  }
+  ringbuffer_insert(ring, p, len);
+  return dropped;
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_sco_hci_deliver
+ *
+ * Description      Queues decoded speech for the audio HAL, and updates the
+ *                  latency statistics. Must be called with btm_sco_hci_lock
+ *                  held.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void btm_sco_hci_deliver(const int16_t* pcm, uint16_t samples,
+                                bool concealed) {
+  tBTM_SCO_HCI_CB* p_cb = &btm_sco_hci_cb;
+
+  p_cb->stats.rx_frames++;
+  if (concealed) p_cb->stats.plc_frames++;
+  p_cb->stats.rx_overrun_bytes += btm_sco_hci_ring_write(
+      p_cb->rx_ring, (const uint8_t*)pcm, samples * sizeof(int16_t));
+
+  uint32_t latency_ms = ringbuffer_size(p_cb->rx_ring) / p_cb->bytes_per_ms;
+  p_cb->rx_latency_sum_ms += latency_ms;
+  if (latency_ms > p_cb->stats.rx_latency_max_ms)
+    p_cb->stats.rx_latency_max_ms = latency_ms;
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_msbc_find_h2_header
+ *
+ * Description      Looks for an H2 header followed by the mSBC syncword.
+ *
+ * Returns          offset of the header, or -1 if there is none
+ *
+ ******************************************************************************/
+static int btm_msbc_find_h2_header(const uint8_t* p, uint16_t len) {
+  for (int offset = 0; offset + BTM_MSBC_H2_HEADER_LEN < len; offset++) {
+    if (p[offset] != BTM_MSBC_H2_HEADER_0 ||
+        p[offset + BTM_MSBC_H2_HEADER_LEN] != OI_SBC_MSBC_SYNCWORD)
+      continue;
+    for (uint8_t seq = 0; seq < sizeof(btm_msbc_h2_header_1); seq++) {
+      if (p[offset + 1] == btm_msbc_h2_header_1[seq]) return offset;
+    }
+  }
+  return -1;
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_msbc_decode_frame
+ *
+ * Description      Decodes the reassembled packet, or conceals it when it is
+ *                  damaged. A packet that does not start with an H2 header is
+ *                  realigned on the next header found instead. Must be called
+ *                  with btm_sco_hci_lock held.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void btm_msbc_decode_frame(void) {
+  tBTM_SCO_HCI_CB* p_cb = &btm_sco_hci_cb;
+  int16_t pcm[SBC_MSBC_SAMPLES_PER_FRAME];
+  bool good = false;
+
+  int offset = btm_msbc_find_h2_header(p_cb->rx_frame, BTM_MSBC_PKT_LEN);
+  if (offset > 0) {
+    /* Keep the frame found, the bytes before it were from a lost one */
+    p_cb->stats.rx_sync_lost++;
+    p_cb->rx_frame_len = BTM_MSBC_PKT_LEN - offset;
+    memmove(p_cb->rx_frame, p_cb->rx_frame + offset, p_cb->rx_frame_len);
+    return;
+  }
+
+  if (offset < 0) {
+    if (!p_cb->rx_frame_damaged) p_cb->stats.rx_sync_lost++;
+    p_cb->rx_seq_known = false;
+  } else {
+    uint8_t seq = 0;
+    while (btm_msbc_h2_header_1[seq] != p_cb->rx_frame[1]) seq++;
+    if (p_cb->rx_seq_known && seq != p_cb->rx_seq)
+      p_cb->stats.rx_seq_errors++;
+    p_cb->rx_seq_known = true;
+    p_cb->rx_seq = (seq + 1) % sizeof(btm_msbc_h2_header_1);
+
+    if (!p_cb->rx_frame_damaged) {
+      const OI_BYTE* p_frame = p_cb->rx_frame + BTM_MSBC_H2_HEADER_LEN;
+      uint32_t frame_bytes = BTM_MSBC_PKT_LEN - BTM_MSBC_H2_HEADER_LEN;
+      uint32_t pcm_bytes = sizeof(pcm);
+      OI_STATUS status = OI_CODEC_SBC_DecodeFrame(
+          &p_cb->decoder, &p_frame, &frame_bytes, pcm, &pcm_bytes);
+      good = OI_SUCCESS(status) && pcm_bytes == sizeof(pcm);
+    }
+  }
+
+  if (good) {
+    sbc_plc_good_frame(&p_cb->plc, pcm, pcm, SBC_MSBC_SAMPLES_PER_FRAME);
+  } else {
+    sbc_plc_bad_frame(&p_cb->plc, pcm, SBC_MSBC_SAMPLES_PER_FRAME);
+  }
+  btm_sco_hci_deliver(pcm, SBC_MSBC_SAMPLES_PER_FRAME, !good);
+
+  p_cb->rx_frame_len = 0;
+  p_cb->rx_frame_damaged = false;
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_msbc_receive
+ *
+ * Description      Reassembles packets into mSBC frames, which need not be
+ *                  aligned on the packets.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void btm_msbc_receive(const uint8_t* p_data, uint8_t len,
+                             bool damaged) {
+  tBTM_SCO_HCI_CB* p_cb = &btm_sco_hci_cb;
+
+  while (len > 0) {
+    uint8_t n = std::min<uint8_t>(len, BTM_MSBC_PKT_LEN - p_cb->rx_frame_len);
+    memcpy(p_cb->rx_frame + p_cb->rx_frame_len, p_data, n);
+    p_cb->rx_frame_len += n;
+    p_cb->rx_frame_damaged |= damaged;
+    p_data += n;
+    len -= n;
+    if (p_cb->rx_frame_len == BTM_MSBC_PKT_LEN) btm_msbc_decode_frame();
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_cvsd_receive
+ *
+ * Description      Delivers the PCM of a CVSD packet, concealing it when it is
+ *                  damaged.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void btm_cvsd_receive(const uint8_t* p_data, uint8_t len,
+                             bool damaged) {
+  int16_t pcm[BTM_SCO_DATA_SIZE_MAX / 2];
+  uint16_t samples = std::min<uint16_t>(len, sizeof(pcm)) / 2;
+
+  if (damaged) {
+    sbc_plc_bad_frame(&btm_sco_hci_cb.plc, pcm, samples);
+  } else {
+    memcpy(pcm, p_data, samples * 2);
+    sbc_plc_good_frame(&btm_sco_hci_cb.plc, pcm, pcm, samples);
+  }
+  btm_sco_hci_deliver(pcm, samples, damaged);
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_sco_hci_read_mic
+ *
+ * Description      Reads len bytes of microphone PCM, padding with silence
+ *                  when the audio HAL is late. Must be called with
+ *                  btm_sco_hci_lock held.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void btm_sco_hci_read_mic(uint8_t* p, uint16_t len) {
+  tBTM_SCO_HCI_CB* p_cb = &btm_sco_hci_cb;
+
+  uint32_t latency_ms = ringbuffer_size(p_cb->tx_ring) / p_cb->bytes_per_ms;
+  if (latency_ms > p_cb->stats.tx_latency_max_ms)
+    p_cb->stats.tx_latency_max_ms = latency_ms;
+
+  size_t read = ringbuffer_pop(p_cb->tx_ring, p, len);
+  if (read < len) {
+    memset(p + read, 0, len - read);
+    p_cb->stats.tx_underruns++;
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_sco_hci_send
+ *
+ * Description      Sends a packet of len bytes of microphone audio, encoding
+ *                  as many mSBC frames as needed in wideband. Must be called
+ *                  with btm_sco_hci_lock held.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void btm_sco_hci_send(uint8_t len) {
+  tBTM_SCO_HCI_CB* p_cb = &btm_sco_hci_cb;
+
+  if (len == 0 || len > BTM_SCO_DATA_SIZE_MAX) return;
+
+  BT_HDR* p_buf =
+      (BT_HDR*)osi_malloc(BT_HDR_SIZE + HCI_SCO_PREAMBLE_SIZE + len);
+  p_buf->offset = HCI_SCO_PREAMBLE_SIZE;
+  p_buf->len = len;
+  uint8_t* p = (uint8_t*)(p_buf + 1) + p_buf->offset;
+
+  if (p_cb->wideband) {
+    while (p_cb->tx_pending_len < len) {
+      int16_t pcm[SBC_MSBC_SAMPLES_PER_FRAME];
+      uint8_t* p_pkt = p_cb->tx_pending + p_cb->tx_pending_len;
+
+      btm_sco_hci_read_mic((uint8_t*)pcm, sizeof(pcm));
+      p_pkt[0] = BTM_MSBC_H2_HEADER_0;
+      p_pkt[1] = btm_msbc_h2_header_1[p_cb->tx_seq];
+      p_cb->tx_seq = (p_cb->tx_seq + 1) % sizeof(btm_msbc_h2_header_1);
+      SBC_Encode(&p_cb->encoder, pcm, p_pkt + BTM_MSBC_H2_HEADER_LEN);
+      p_pkt[BTM_MSBC_PKT_LEN - 1] = 0;
+      p_cb->tx_pending_len += BTM_MSBC_PKT_LEN;
+    }
+    memcpy(p, p_cb->tx_pending, len);
+    p_cb->tx_pending_len -= len;
+    memmove(p_cb->tx_pending, p_cb->tx_pending + len, p_cb->tx_pending_len);
+  } else {
+    btm_sco_hci_read_mic(p, len);
+  }
+
+  p_cb->stats.tx_packets++;
+  BTM_WriteScoData(p_cb->sco_inx, p_buf);
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_sco_hci_open
+ *
+ * Description      Starts the codec path of a SCO link routed over HCI, in
+ *                  mSBC if wideband, CVSD otherwise. A single link can be
+ *                  routed over HCI at a time.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btm_sco_hci_open(uint16_t sco_inx, bool wideband) {
+  std::lock_guard<std::mutex> lock(btm_sco_hci_lock);
+  tBTM_SCO_HCI_CB* p_cb = &btm_sco_hci_cb;
+
+  if (p_cb->active) {
+    LOG(WARNING) << __func__ << ": replacing sco_inx " << p_cb->sco_inx;
+    ringbuffer_free(p_cb->rx_ring);
+    ringbuffer_free(p_cb->tx_ring);
+  }
+
+  memset(p_cb, 0, sizeof(*p_cb));
+  p_cb->active = true;
+  p_cb->sco_inx = sco_inx;
+  p_cb->wideband = wideband;
+  p_cb->stats.sample_rate = wideband ? 16000 : 8000;
+  p_cb->bytes_per_ms = p_cb->stats.sample_rate * sizeof(int16_t) / 1000;
+  p_cb->rx_ring = ringbuffer_init(BTM_SCO_HCI_RING_MS * p_cb->bytes_per_ms);
+  p_cb->tx_ring = ringbuffer_init(BTM_SCO_HCI_RING_MS * p_cb->bytes_per_ms);
+  p_cb->start_ms = bluetooth::common::time_get_os_boottime_ms();
+  sbc_plc_init(&p_cb->plc, p_cb->stats.sample_rate);
+
+  if (wideband) {
+    OI_CODEC_mSBC_DecoderReset(&p_cb->decoder, p_cb->decoder_data,
+                               sizeof(p_cb->decoder_data));
+    p_cb->encoder.mSBCEnabled = TRUE;
+    SBC_Encoder_Init(&p_cb->encoder);
+  }
+
+  LOG(INFO) << __func__ << ": sco_inx " << sco_inx << ", "
+            << (wideband ? "mSBC" : "CVSD");
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_sco_hci_close
+ *
+ * Description      Stops the codec path of the SCO link, if it is the one
+ *                  routed over HCI, and logs the statistics of the call.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btm_sco_hci_close(uint16_t sco_inx) {
+  std::lock_guard<std::mutex> lock(btm_sco_hci_lock);
+  tBTM_SCO_HCI_CB* p_cb = &btm_sco_hci_cb;
+
+  if (!p_cb->active || p_cb->sco_inx != sco_inx) return;
+
+  p_cb->active = false;
+  ringbuffer_free(p_cb->rx_ring);
+  ringbuffer_free(p_cb->tx_ring);
+  p_cb->rx_ring = NULL;
+  p_cb->tx_ring = NULL;
+
+  tBTM_SCO_HCI_STATS* p_stats = &p_cb->stats;
+  p_stats->duration_ms =
+      bluetooth::common::time_get_os_boottime_ms() - p_cb->start_ms;
+  if (p_stats->rx_frames > 0)
+    p_stats->rx_latency_avg_ms = p_cb->rx_latency_sum_ms / p_stats->rx_frames;
+
+  LOG(INFO) << __func__ << ": sco_inx " << sco_inx << ", "
+            << p_stats->duration_ms << " ms, rx " << p_stats->rx_packets
+            << " packets (" << p_stats->rx_erroneous << " damaged), "
+            << p_stats->rx_frames << " frames (" << p_stats->plc_frames
+            << " concealed), sync lost " << p_stats->rx_sync_lost
+            << ", seq errors " << p_stats->rx_seq_errors << ", overrun "
+            << p_stats->rx_overrun_bytes << " bytes, latency avg "
+            << p_stats->rx_latency_avg_ms << " max "
+            << p_stats->rx_latency_max_ms << " ms; tx " << p_stats->tx_packets
+            << " packets, " << p_stats->tx_underruns << " underruns, overrun "
+            << p_stats->tx_overrun_bytes << " bytes, latency max "
+            << p_stats->tx_latency_max_ms << " ms";
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_sco_hci_receive
+ *
+ * Description      Decodes a SCO packet received on the link routed over HCI,
+ *                  and answers it with a packet of the same length.
+ *                  pkt_status is the Packet_Status_Flag of the HCI header.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btm_sco_hci_receive(uint16_t sco_inx, const uint8_t* p_data, uint8_t len,
+                         uint8_t pkt_status) {
+  std::lock_guard<std::mutex> lock(btm_sco_hci_lock);
+  tBTM_SCO_HCI_CB* p_cb = &btm_sco_hci_cb;
+
+  if (!p_cb->active || p_cb->sco_inx != sco_inx) return;
+
+  bool damaged = pkt_status != 0;
+  p_cb->stats.rx_packets++;
+  if (damaged) p_cb->stats.rx_erroneous++;
+
+  if (p_cb->wideband) {
+    btm_msbc_receive(p_data, len, damaged);
+  } else {
+    btm_cvsd_receive(p_data, len, damaged);
+  }
+  btm_sco_hci_send(len);
+}
+
+/*******************************************************************************
+ *
+ * Function         BTM_ReadScoPcm
+ *
+ * Description      Called by the audio HAL to read speaker PCM.
+ *
+ * Returns          number of bytes read
+ *
+ ******************************************************************************/
+uint16_t BTM_ReadScoPcm(uint8_t* p_buf, uint16_t len) {
+  std::lock_guard<std::mutex> lock(btm_sco_hci_lock);
+
+  if (!btm_sco_hci_cb.active) return 0;
+  return ringbuffer_pop(btm_sco_hci_cb.rx_ring, p_buf, len);
+}
+
+/*******************************************************************************
+ *
+ * Function         BTM_WriteScoPcm
+ *
+ * Description      Called by the audio HAL to queue microphone PCM.
+ *
+ * Returns          number of bytes queued
+ *
+ ******************************************************************************/
+uint16_t BTM_WriteScoPcm(const uint8_t* p_buf, uint16_t len) {
+  std::lock_guard<std::mutex> lock(btm_sco_hci_lock);
+
+  if (!btm_sco_hci_cb.active) return 0;
+  btm_sco_hci_cb.stats.tx_overrun_bytes +=
+      btm_sco_hci_ring_write(btm_sco_hci_cb.tx_ring, p_buf, len);
+  return len;
+}
+
+/*******************************************************************************
+ *
+ * Function         BTM_ReadScoHciStats
+ *
+ * Description      Reads the statistics of the current, or last, call routed
+ *                  over HCI.
+ *
+ * Returns          true if a call is routed over HCI
+ *
+ ******************************************************************************/
+bool BTM_ReadScoHciStats(tBTM_SCO_HCI_STATS* p_stats) {
+  std::lock_guard<std::mutex> lock(btm_sco_hci_lock);
+  tBTM_SCO_HCI_CB* p_cb = &btm_sco_hci_cb;
+
+  *p_stats = p_cb->stats;
+  if (!p_cb->active) return false;
+
+  p_stats->duration_ms =
+      bluetooth::common::time_get_os_boottime_ms() - p_cb->start_ms;
+  if (p_stats->rx_frames > 0)
+    p_stats->rx_latency_avg_ms = p_cb->rx_latency_sum_ms / p_stats->rx_frames;
+  return true;
+}
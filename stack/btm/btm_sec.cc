@@ -582,6 +582,7 @@ static bool btm_sec_set_security_level(CONNECTION_TYPE conn_type,
   }
 
   p_srec->security_flags |= (uint16_t)(sec_level | BTM_SEC_IN_USE);
+  btm_sec_serv_index_update(index);
 
   BTM_TRACE_API(
       "BTM_SEC_REG[%d]: id %d, is_orig %d, psm 0x%04x, proto_id %d, chan_id %d",
@@ -626,6 +627,7 @@ uint8_t BTM_SecClrService(uint8_t service_id) {
         (!service_id || (service_id == p_srec->service_id))) {
       BTM_TRACE_API("BTM_SEC_CLR[%d]: id %d", i, service_id);
       p_srec->security_flags = 0;
+      btm_sec_serv_index_remove(i);
       num_freed++;
     }
   }
@@ -659,6 +661,7 @@ uint8_t btm_sec_clr_service_by_psm(uint16_t psm) {
     if ((p_srec->security_flags & BTM_SEC_IN_USE) && (p_srec->psm == psm)) {
       BTM_TRACE_API("BTM_SEC_CLR[%d]: id %d ", i, p_srec->service_id);
       p_srec->security_flags = 0;
+      btm_sec_serv_index_remove(i);
       num_freed++;
     }
   }
@@ -5104,8 +5107,7 @@ bool btm_sec_are_all_trusted(uint32_t p_mask[]) {
  ******************************************************************************/
 tBTM_SEC_SERV_REC* btm_sec_find_first_serv(CONNECTION_TYPE conn_type,
                                            uint16_t psm) {
-  tBTM_SEC_SERV_REC* p_serv_rec = &btm_cb.sec_serv_rec[0];
-  int i;
+  uint8_t xx;
   bool is_originator = conn_type;
 
   if (is_originator && btm_cb.p_out_serv && btm_cb.p_out_serv->psm == psm) {
@@ -5115,11 +5117,8 @@ tBTM_SEC_SERV_REC* btm_sec_find_first_serv(CONNECTION_TYPE conn_type,
   }
 
   /* otherwise, just find the first record with the specified PSM */
-  for (i = 0; i < BTM_SEC_MAX_SERVICE_RECORDS; i++, p_serv_rec++) {
-    if ((p_serv_rec->security_flags & BTM_SEC_IN_USE) &&
-        (p_serv_rec->psm == psm))
-      return (p_serv_rec);
-  }
+  xx = btm_sec_serv_index_find_psm(psm, BTM_SEC_MAX_SERVICE_RECORDS);
+  if (xx < BTM_SEC_MAX_SERVICE_RECORDS) return &btm_cb.sec_serv_rec[xx];
   return (NULL);
 }
 
@@ -5134,17 +5133,10 @@ tBTM_SEC_SERV_REC* btm_sec_find_first_serv(CONNECTION_TYPE conn_type,
  *
  ******************************************************************************/
 static tBTM_SEC_SERV_REC* btm_sec_find_next_serv(tBTM_SEC_SERV_REC* p_cur) {
-  tBTM_SEC_SERV_REC* p_serv_rec = &btm_cb.sec_serv_rec[0];
-  int i;
+  uint8_t xx = btm_sec_serv_index_find_psm(
+      p_cur->psm, (uint8_t)(p_cur - &btm_cb.sec_serv_rec[0]));
 
-  for (i = 0; i < BTM_SEC_MAX_SERVICE_RECORDS; i++, p_serv_rec++) {
-    if ((p_serv_rec->security_flags & BTM_SEC_IN_USE) &&
-        (p_serv_rec->psm == p_cur->psm)) {
-      if (p_cur != p_serv_rec) {
-        return (p_serv_rec);
-      }
-    }
-  }
+  if (xx < BTM_SEC_MAX_SERVICE_RECORDS) return &btm_cb.sec_serv_rec[xx];
   return (NULL);
 }
 
@@ -5163,8 +5155,7 @@ static tBTM_SEC_SERV_REC* btm_sec_find_mx_serv(uint8_t is_originator,
                                                uint32_t mx_proto_id,
                                                uint32_t mx_chan_id) {
   tBTM_SEC_SERV_REC* p_out_serv = btm_cb.p_out_serv;
-  tBTM_SEC_SERV_REC* p_serv_rec = &btm_cb.sec_serv_rec[0];
-  int i;
+  uint8_t xx;
 
   BTM_TRACE_DEBUG("%s()", __func__);
   if (is_originator && p_out_serv && p_out_serv->psm == psm &&
@@ -5175,15 +5166,9 @@ static tBTM_SEC_SERV_REC* btm_sec_find_mx_serv(uint8_t is_originator,
     return btm_cb.p_out_serv;
   }
 
-  /* otherwise, the old way */
-  for (i = 0; i < BTM_SEC_MAX_SERVICE_RECORDS; i++, p_serv_rec++) {
-    if ((p_serv_rec->security_flags & BTM_SEC_IN_USE) &&
-        (p_serv_rec->psm == psm) && (p_serv_rec->mx_proto_id == mx_proto_id) &&
-        ((is_originator && (p_serv_rec->orig_mx_chan_id == mx_chan_id)) ||
-         (!is_originator && (p_serv_rec->term_mx_chan_id == mx_chan_id)))) {
-      return (p_serv_rec);
-    }
-  }
+  /* otherwise, look the channel up in the index */
+  xx = btm_sec_serv_index_find_mx(is_originator, psm, mx_proto_id, mx_chan_id);
+  if (xx < BTM_SEC_MAX_SERVICE_RECORDS) return &btm_cb.sec_serv_rec[xx];
   return (NULL);
 }
 
@@ -5663,6 +5648,7 @@ void btm_sec_clear_ble_keys(tBTM_SEC_DEV_REC* p_dev_rec) {
   BTM_TRACE_DEBUG("%s() Clearing BLE Keys", __func__);
   p_dev_rec->ble.key_type = BTM_LE_KEY_NONE;
   memset(&p_dev_rec->ble.keys, 0, sizeof(tBTM_SEC_BLE_KEYS));
+  btm_dev_invalidate_rpa_cache();
 
 #if (BLE_PRIVACY_SPT == TRUE)
   btm_ble_resolving_list_remove_dev(p_dev_rec);
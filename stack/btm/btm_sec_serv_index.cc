@@ -0,0 +1,148 @@
+/******************************************************************************
+ *
+ *  Copyright 2020 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This file contains the index of the security service database: the
+ *  sec_serv_rec entries in use, hashed by PSM and by PSM plus multiplexer
+ *  channel, so that the service lookups done for every incoming and outgoing
+ *  connection do not walk all the records.
+ *
+ ******************************************************************************/
+
+#include "bt_target.h"
+#include "btm_int.h"
+
+static_assert(BTM_SEC_MAX_SERVICE_RECORDS <= 32,
+              "tBTM_SEC_SERV_INDEX buckets have a bit per service record");
+
+/* Fibonacci hashing of |key| to one of the buckets */
+static uint8_t btm_sec_serv_index_hash(uint32_t key) {
+  return (uint8_t)((key * 2654435761u) >>
+                   (32 - BTM_SEC_SERV_INDEX_BUCKET_BITS));
+}
+
+static uint8_t btm_sec_serv_index_mx_hash(uint16_t psm, uint32_t mx_proto_id,
+                                          uint32_t mx_chan_id) {
+  return btm_sec_serv_index_hash(psm ^ (mx_proto_id << 12) ^
+                                 (mx_chan_id << 16) ^ (mx_chan_id >> 16));
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_sec_serv_index_update
+ *
+ * Description      Adds the sec_serv_rec entry |srec_idx|, now in use, to the
+ *                  index, or moves it to the buckets of its current keys.
+ *
+ ******************************************************************************/
+void btm_sec_serv_index_update(uint8_t srec_idx) {
+  tBTM_SEC_SERV_INDEX* p_index = &btm_cb.sec_serv_index;
+  const tBTM_SEC_SERV_REC* p_srec = &btm_cb.sec_serv_rec[srec_idx];
+  uint32_t bit = 1u << srec_idx;
+
+  btm_sec_serv_index_remove(srec_idx);
+
+  p_index->psm_hash[srec_idx] = btm_sec_serv_index_hash(p_srec->psm);
+  p_index->orig_mx_hash[srec_idx] = btm_sec_serv_index_mx_hash(
+      p_srec->psm, p_srec->mx_proto_id, p_srec->orig_mx_chan_id);
+  p_index->term_mx_hash[srec_idx] = btm_sec_serv_index_mx_hash(
+      p_srec->psm, p_srec->mx_proto_id, p_srec->term_mx_chan_id);
+
+  p_index->psm_bucket[p_index->psm_hash[srec_idx]] |= bit;
+  p_index->orig_mx_bucket[p_index->orig_mx_hash[srec_idx]] |= bit;
+  p_index->term_mx_bucket[p_index->term_mx_hash[srec_idx]] |= bit;
+  p_index->in_use_mask |= bit;
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_sec_serv_index_remove
+ *
+ * Description      Removes the sec_serv_rec entry |srec_idx|, no longer in
+ *                  use, from the index.
+ *
+ ******************************************************************************/
+void btm_sec_serv_index_remove(uint8_t srec_idx) {
+  tBTM_SEC_SERV_INDEX* p_index = &btm_cb.sec_serv_index;
+  uint32_t bit = 1u << srec_idx;
+
+  if (!(p_index->in_use_mask & bit)) return;
+
+  p_index->psm_bucket[p_index->psm_hash[srec_idx]] &= ~bit;
+  p_index->orig_mx_bucket[p_index->orig_mx_hash[srec_idx]] &= ~bit;
+  p_index->term_mx_bucket[p_index->term_mx_hash[srec_idx]] &= ~bit;
+  p_index->in_use_mask &= ~bit;
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_sec_serv_index_find_psm
+ *
+ * Description      Looks up the FIRST sec_serv_rec entry in use for |psm|,
+ *                  other than |skip_idx|. Pass BTM_SEC_MAX_SERVICE_RECORDS
+ *                  as |skip_idx| to skip none.
+ *
+ * Returns          index to the sec_serv_rec or BTM_SEC_MAX_SERVICE_RECORDS.
+ *
+ ******************************************************************************/
+uint8_t btm_sec_serv_index_find_psm(uint16_t psm, uint8_t skip_idx) {
+  uint32_t candidates =
+      btm_cb.sec_serv_index.psm_bucket[btm_sec_serv_index_hash(psm)];
+
+  if (skip_idx < BTM_SEC_MAX_SERVICE_RECORDS) candidates &= ~(1u << skip_idx);
+
+  /* Lowest index first, as the records were walked in order before */
+  while (candidates) {
+    uint8_t xx = __builtin_ctz(candidates);
+    if (btm_cb.sec_serv_rec[xx].psm == psm) return xx;
+    candidates &= candidates - 1;
+  }
+  return BTM_SEC_MAX_SERVICE_RECORDS;
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_sec_serv_index_find_mx
+ *
+ * Description      Looks up the FIRST sec_serv_rec entry in use for |psm| and
+ *                  the multiplexer channel |mx_chan_id| of |mx_proto_id|, in
+ *                  the originator or the acceptor direction.
+ *
+ * Returns          index to the sec_serv_rec or BTM_SEC_MAX_SERVICE_RECORDS.
+ *
+ ******************************************************************************/
+uint8_t btm_sec_serv_index_find_mx(bool is_originator, uint16_t psm,
+                                   uint32_t mx_proto_id, uint32_t mx_chan_id) {
+  const tBTM_SEC_SERV_INDEX* p_index = &btm_cb.sec_serv_index;
+  uint8_t hash = btm_sec_serv_index_mx_hash(psm, mx_proto_id, mx_chan_id);
+  uint32_t candidates = is_originator ? p_index->orig_mx_bucket[hash]
+                                      : p_index->term_mx_bucket[hash];
+
+  while (candidates) {
+    uint8_t xx = __builtin_ctz(candidates);
+    const tBTM_SEC_SERV_REC* p_srec = &btm_cb.sec_serv_rec[xx];
+    uint32_t chan_id =
+        is_originator ? p_srec->orig_mx_chan_id : p_srec->term_mx_chan_id;
+    if (p_srec->psm == psm && p_srec->mx_proto_id == mx_proto_id &&
+        chan_id == mx_chan_id)
+      return xx;
+    candidates &= candidates - 1;
+  }
+  return BTM_SEC_MAX_SERVICE_RECORDS;
+}
@@ -0,0 +1,174 @@
+/******************************************************************************
+ *
+ *  Copyright 2020 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This file accounts for the data buffers held in the queues of the stack,
+ *  against a budget shared by the channels. The queues are filled and
+ *  drained from several threads, so the counts are atomic.
+ *
+ ******************************************************************************/
+
+#define LOG_TAG "bt_btu_budget"
+
+#include <stdio.h>
+
+#include <atomic>
+
+#include "btu.h"
+
+namespace {
+
+const char* const budget_queue_names[BTU_BUDGET_QUEUE_MAX] = {
+    "RFCOMM RX", "RFCOMM TX", "socket RX"};
+
+std::atomic<size_t> budget_limit{0};
+std::atomic<size_t> budget_channels{0};
+std::atomic<size_t> budget_total{0};
+std::atomic<size_t> budget_peak{0};
+std::atomic<size_t> budget_queued[BTU_BUDGET_QUEUE_MAX];
+
+/* Takes |len| off |count| without wrapping, in case a queue outlived the
+ * btu_budget_init() that reset the counts */
+void budget_sub(std::atomic<size_t>* count, size_t len) {
+  size_t old_count = count->load();
+  size_t new_count;
+  do {
+    new_count = old_count > len ? old_count - len : 0;
+  } while (!count->compare_exchange_weak(old_count, new_count));
+}
+
+}  // namespace
+
+/*******************************************************************************
+ *
+ * Function         btu_budget_init
+ *
+ * Description      Sets the budget, and resets the counts along with the
+ *                  control blocks of the stack.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btu_budget_init(size_t limit) {
+  budget_limit = limit;
+  budget_channels = 0;
+  budget_total = 0;
+  budget_peak = 0;
+  for (auto& queued : budget_queued) queued = 0;
+}
+
+void btu_budget_add_channel(void) { budget_channels++; }
+
+void btu_budget_remove_channel(void) { budget_sub(&budget_channels, 1); }
+
+/*******************************************************************************
+ *
+ * Function         btu_budget_charge
+ *
+ * Description      Counts |len| bytes into |queue|.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btu_budget_charge(tBTU_BUDGET_QUEUE queue, size_t len) {
+  if (len == 0) return;
+  budget_queued[queue] += len;
+  size_t total = budget_total += len;
+
+  size_t peak = budget_peak.load();
+  while (total > peak && !budget_peak.compare_exchange_weak(peak, total)) {
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         btu_budget_release
+ *
+ * Description      Counts |len| bytes out of |queue|.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btu_budget_release(tBTU_BUDGET_QUEUE queue, size_t len) {
+  if (len == 0) return;
+  budget_sub(&budget_queued[queue], len);
+  budget_sub(&budget_total, len);
+}
+
+/*******************************************************************************
+ *
+ * Function         btu_budget_channel_quota
+ *
+ * Description      The share of a channel is the budget split evenly between
+ *                  the channels, so it shrinks as channels are added.
+ *
+ * Returns          the share in bytes, 0 if there is no budget
+ *
+ ******************************************************************************/
+size_t btu_budget_channel_quota(void) {
+  size_t limit = budget_limit;
+  size_t channels = budget_channels;
+  return channels > 1 ? limit / channels : limit;
+}
+
+/*******************************************************************************
+ *
+ * Function         btu_budget_exceeded
+ *
+ * Description      Checks a channel holding |channel_len| bytes against its
+ *                  share, and against what is left of the whole budget.
+ *
+ * Returns          true if the channel should be flow controlled
+ *
+ ******************************************************************************/
+bool btu_budget_exceeded(size_t channel_len) {
+  if (budget_limit == 0 || channel_len == 0) return false;
+  return channel_len > btu_budget_channel_quota() || btu_budget_exhausted();
+}
+
+bool btu_budget_exhausted(void) {
+  size_t limit = budget_limit;
+  return limit != 0 && budget_total >= limit;
+}
+
+/*******************************************************************************
+ *
+ * Function         stack_debug_btu_budget_dump
+ *
+ * Description      Dump the bytes held in each kind of queue.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void stack_debug_btu_budget_dump(int fd) {
+  dprintf(fd, "\nBuffer Budget:\n");
+  if (budget_limit == 0) {
+    dprintf(fd, "  budget: none\n");
+  } else {
+    dprintf(fd, "  budget: %zu bytes, %zu per channel for %zu channels\n",
+            budget_limit.load(), btu_budget_channel_quota(),
+            budget_channels.load());
+  }
+  dprintf(fd, "  held: %zu bytes (peak %zu)\n", budget_total.load(),
+          budget_peak.load());
+  for (int i = 0; i < BTU_BUDGET_QUEUE_MAX; i++) {
+    dprintf(fd, "    %-10s %zu bytes\n", budget_queue_names[i],
+            budget_queued[i].load());
+  }
+}
@@ -40,6 +40,11 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <algorithm>
+#include <array>
+#include <mutex>
+#include <vector>
+
 #include "bt_common.h"
 #include "bt_types.h"
 #include "bt_utils.h"
@@ -48,6 +53,7 @@
 #include "btm_int.h"
 #include "btu.h"
 #include "common/metrics.h"
+#include "common/time_util.h"
 #include "device/include/controller.h"
 #include "hci_evt_length.h"
 #include "hci_layer.h"
@@ -55,6 +61,7 @@
 #include "l2c_int.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
+#include "stream_reader.h"
 
 using base::Location;
 
@@ -74,23 +81,23 @@ static void btu_hcif_extended_inquiry_result_evt(uint8_t* p,
 
 static void btu_hcif_connection_comp_evt(uint8_t* p, uint8_t evt_len);
 static void btu_hcif_connection_request_evt(uint8_t* p);
-static void btu_hcif_disconnection_comp_evt(uint8_t* p);
-static void btu_hcif_authentication_comp_evt(uint8_t* p);
-static void btu_hcif_rmt_name_request_comp_evt(uint8_t* p, uint16_t evt_len);
-static void btu_hcif_encryption_change_evt(uint8_t* p);
+static void btu_hcif_disconnection_comp_evt(uint8_t* p, uint8_t evt_len);
+static void btu_hcif_authentication_comp_evt(uint8_t* p, uint8_t evt_len);
+static void btu_hcif_rmt_name_request_comp_evt(uint8_t* p, uint8_t evt_len);
+static void btu_hcif_encryption_change_evt(uint8_t* p, uint8_t evt_len);
 static void btu_hcif_read_rmt_features_comp_evt(uint8_t* p);
 static void btu_hcif_read_rmt_ext_features_comp_evt(uint8_t* p,
                                                     uint8_t evt_len);
 static void btu_hcif_read_rmt_version_comp_evt(uint8_t* p);
-static void btu_hcif_qos_setup_comp_evt(uint8_t* p);
+static void btu_hcif_qos_setup_comp_evt(uint8_t* p, uint8_t evt_len);
 static void btu_hcif_command_complete_evt(BT_HDR* response, void* context);
 static void btu_hcif_command_status_evt(uint8_t status, BT_HDR* command,
                                         void* context);
 static void btu_hcif_hardware_error_evt(uint8_t* p);
 static void btu_hcif_flush_occured_evt(void);
-static void btu_hcif_role_change_evt(uint8_t* p);
+static void btu_hcif_role_change_evt(uint8_t* p, uint8_t evt_len);
 static void btu_hcif_num_compl_data_pkts_evt(uint8_t* p, uint8_t evt_len);
-static void btu_hcif_mode_change_evt(uint8_t* p);
+static void btu_hcif_mode_change_evt(uint8_t* p, uint8_t evt_len);
 static void btu_hcif_pin_code_request_evt(uint8_t* p);
 static void btu_hcif_link_key_request_evt(uint8_t* p);
 static void btu_hcif_link_key_notification_evt(uint8_t* p);
@@ -102,8 +109,8 @@ static void btu_hcif_conn_pkt_type_change_evt(void);
 static void btu_hcif_qos_violation_evt(uint8_t* p);
 static void btu_hcif_page_scan_mode_change_evt(void);
 static void btu_hcif_page_scan_rep_mode_chng_evt(void);
-static void btu_hcif_esco_connection_comp_evt(uint8_t* p);
-static void btu_hcif_esco_connection_chg_evt(uint8_t* p);
+static void btu_hcif_esco_connection_comp_evt(uint8_t* p, uint8_t evt_len);
+static void btu_hcif_esco_connection_chg_evt(uint8_t* p, uint8_t evt_len);
 
 /* Simple Pairing Events */
 static void btu_hcif_host_support_evt(uint8_t* p);
@@ -281,6 +288,223 @@ void btu_hcif_log_event_metrics(uint8_t evt_code, uint8_t* p_event) {
   }
 }
 
+/* Event handlers are called with the parameters following the event header
+ * and the parameter length of the event */
+typedef void (*tBTU_HCIF_EVT_HANDLER)(uint8_t* p, uint8_t hci_evt_len);
+
+typedef struct {
+  uint8_t evt_code;
+  tBTU_HCIF_EVT_HANDLER handler;
+} tBTU_HCIF_EVT_ENTRY;
+
+/* LE meta event handlers are called with the parameters following the
+ * subevent code, and the parameter length of the HCI event. The subevent
+ * parameters must be at least |min_len| long */
+typedef struct {
+  uint8_t sub_code;
+  uint8_t min_len;
+  tBTU_HCIF_EVT_HANDLER handler;
+} tBTU_HCIF_BLE_EVT_ENTRY;
+
+/* Processing time of the events with one code */
+typedef struct {
+  uint32_t count;
+  uint32_t malformed_count;
+  uint64_t total_us;
+  uint64_t max_us;
+} tBTU_HCIF_EVT_STATS;
+
+static void btu_hcif_ble_event(uint8_t* p, uint8_t hci_evt_len);
+
+static const tBTU_HCIF_EVT_ENTRY btu_hcif_evt_entries[] = {
+    {HCI_INQUIRY_COMP_EVT,
+     [](uint8_t* p, uint8_t) { btu_hcif_inquiry_comp_evt(p); }},
+    {HCI_INQUIRY_RESULT_EVT, btu_hcif_inquiry_result_evt},
+    {HCI_INQUIRY_RSSI_RESULT_EVT, btu_hcif_inquiry_rssi_result_evt},
+    {HCI_EXTENDED_INQUIRY_RESULT_EVT, btu_hcif_extended_inquiry_result_evt},
+    {HCI_CONNECTION_COMP_EVT, btu_hcif_connection_comp_evt},
+    {HCI_CONNECTION_REQUEST_EVT,
+     [](uint8_t* p, uint8_t) { btu_hcif_connection_request_evt(p); }},
+    {HCI_DISCONNECTION_COMP_EVT, btu_hcif_disconnection_comp_evt},
+    {HCI_AUTHENTICATION_COMP_EVT, btu_hcif_authentication_comp_evt},
+    {HCI_RMT_NAME_REQUEST_COMP_EVT, btu_hcif_rmt_name_request_comp_evt},
+    {HCI_ENCRYPTION_CHANGE_EVT, btu_hcif_encryption_change_evt},
+    {HCI_ENCRYPTION_KEY_REFRESH_COMP_EVT,
+     [](uint8_t* p, uint8_t) { btu_hcif_encryption_key_refresh_cmpl_evt(p); }},
+    {HCI_READ_RMT_FEATURES_COMP_EVT,
+     [](uint8_t* p, uint8_t) { btu_hcif_read_rmt_features_comp_evt(p); }},
+    {HCI_READ_RMT_EXT_FEATURES_COMP_EVT,
+     btu_hcif_read_rmt_ext_features_comp_evt},
+    {HCI_READ_RMT_VERSION_COMP_EVT,
+     [](uint8_t* p, uint8_t) { btu_hcif_read_rmt_version_comp_evt(p); }},
+    {HCI_QOS_SETUP_COMP_EVT, btu_hcif_qos_setup_comp_evt},
+    {HCI_COMMAND_COMPLETE_EVT,
+     [](uint8_t*, uint8_t) {
+       LOG_ERROR(LOG_TAG,
+                 "%s should not have received a command complete event. "
+                 "Someone didn't go through the hci transmit_command "
+                 "function.",
+                 __func__);
+     }},
+    {HCI_COMMAND_STATUS_EVT,
+     [](uint8_t*, uint8_t) {
+       LOG_ERROR(LOG_TAG,
+                 "%s should not have received a command status event. "
+                 "Someone didn't go through the hci transmit_command "
+                 "function.",
+                 __func__);
+     }},
+    {HCI_HARDWARE_ERROR_EVT,
+     [](uint8_t* p, uint8_t) { btu_hcif_hardware_error_evt(p); }},
+    {HCI_FLUSH_OCCURED_EVT,
+     [](uint8_t*, uint8_t) { btu_hcif_flush_occured_evt(); }},
+    {HCI_ROLE_CHANGE_EVT, btu_hcif_role_change_evt},
+    {HCI_NUM_COMPL_DATA_PKTS_EVT, btu_hcif_num_compl_data_pkts_evt},
+    {HCI_MODE_CHANGE_EVT, btu_hcif_mode_change_evt},
+    {HCI_PIN_CODE_REQUEST_EVT,
+     [](uint8_t* p, uint8_t) { btu_hcif_pin_code_request_evt(p); }},
+    {HCI_LINK_KEY_REQUEST_EVT,
+     [](uint8_t* p, uint8_t) { btu_hcif_link_key_request_evt(p); }},
+    {HCI_LINK_KEY_NOTIFICATION_EVT,
+     [](uint8_t* p, uint8_t) { btu_hcif_link_key_notification_evt(p); }},
+    {HCI_LOOPBACK_COMMAND_EVT,
+     [](uint8_t*, uint8_t) { btu_hcif_loopback_command_evt(); }},
+    {HCI_DATA_BUF_OVERFLOW_EVT,
+     [](uint8_t*, uint8_t) { btu_hcif_data_buf_overflow_evt(); }},
+    {HCI_MAX_SLOTS_CHANGED_EVT,
+     [](uint8_t*, uint8_t) { btu_hcif_max_slots_changed_evt(); }},
+    {HCI_READ_CLOCK_OFF_COMP_EVT,
+     [](uint8_t* p, uint8_t) { btu_hcif_read_clock_off_comp_evt(p); }},
+    {HCI_CONN_PKT_TYPE_CHANGE_EVT,
+     [](uint8_t*, uint8_t) { btu_hcif_conn_pkt_type_change_evt(); }},
+    {HCI_QOS_VIOLATION_EVT,
+     [](uint8_t* p, uint8_t) { btu_hcif_qos_violation_evt(p); }},
+    {HCI_PAGE_SCAN_MODE_CHANGE_EVT,
+     [](uint8_t*, uint8_t) { btu_hcif_page_scan_mode_change_evt(); }},
+    {HCI_PAGE_SCAN_REP_MODE_CHNG_EVT,
+     [](uint8_t*, uint8_t) { btu_hcif_page_scan_rep_mode_chng_evt(); }},
+    {HCI_ESCO_CONNECTION_COMP_EVT, btu_hcif_esco_connection_comp_evt},
+    {HCI_ESCO_CONNECTION_CHANGED_EVT, btu_hcif_esco_connection_chg_evt},
+#if (BTM_SSR_INCLUDED == TRUE)
+    {HCI_SNIFF_SUB_RATE_EVT,
+     [](uint8_t* p, uint8_t len) { btu_hcif_ssr_evt(p, len); }},
+#endif /* BTM_SSR_INCLUDED == TRUE */
+    {HCI_RMT_HOST_SUP_FEAT_NOTIFY_EVT,
+     [](uint8_t* p, uint8_t) { btu_hcif_host_support_evt(p); }},
+    {HCI_IO_CAPABILITY_REQUEST_EVT,
+     [](uint8_t* p, uint8_t) { btu_hcif_io_cap_request_evt(p); }},
+    {HCI_IO_CAPABILITY_RESPONSE_EVT,
+     [](uint8_t* p, uint8_t) { btu_hcif_io_cap_response_evt(p); }},
+    {HCI_USER_CONFIRMATION_REQUEST_EVT,
+     [](uint8_t* p, uint8_t) { btu_hcif_user_conf_request_evt(p); }},
+    {HCI_USER_PASSKEY_REQUEST_EVT,
+     [](uint8_t* p, uint8_t) { btu_hcif_user_passkey_request_evt(p); }},
+    {HCI_REMOTE_OOB_DATA_REQUEST_EVT,
+     [](uint8_t* p, uint8_t) { btu_hcif_rem_oob_request_evt(p); }},
+    {HCI_SIMPLE_PAIRING_COMPLETE_EVT,
+     [](uint8_t* p, uint8_t) { btu_hcif_simple_pair_complete_evt(p); }},
+    {HCI_USER_PASSKEY_NOTIFY_EVT,
+     [](uint8_t* p, uint8_t) { btu_hcif_user_passkey_notif_evt(p); }},
+    {HCI_KEYPRESS_NOTIFY_EVT,
+     [](uint8_t* p, uint8_t) { btu_hcif_keypress_notif_evt(p); }},
+#if (L2CAP_NON_FLUSHABLE_PB_INCLUDED == TRUE)
+    {HCI_ENHANCED_FLUSH_COMPLETE_EVT,
+     [](uint8_t*, uint8_t) { btu_hcif_enhanced_flush_complete_evt(); }},
+#endif
+    {HCI_BLE_EVENT, btu_hcif_ble_event},
+    {HCI_VENDOR_SPECIFIC_EVT, btm_vendor_specific_evt},
+};
+
+/* The minimum lengths exclude the subevent code */
+static const tBTU_HCIF_BLE_EVT_ENTRY btu_hcif_ble_evt_entries[] = {
+    /* result of inquiry */
+    {HCI_BLE_ADV_PKT_RPT_EVT, 1,
+     [](uint8_t* p, uint8_t len) { btm_ble_process_adv_pkt(len - 1, p); }},
+    {HCI_BLE_CONN_COMPLETE_EVT, 18,
+     [](uint8_t* p, uint8_t len) { btu_ble_ll_conn_complete_evt(p, len); }},
+    {HCI_BLE_LL_CONN_PARAM_UPD_EVT, 9,
+     [](uint8_t* p, uint8_t len) { btu_ble_ll_conn_param_upd_evt(p, len); }},
+    {HCI_BLE_READ_REMOTE_FEAT_CMPL_EVT, 11,
+     [](uint8_t* p, uint8_t) { btu_ble_read_remote_feat_evt(p); }},
+    /* received only at slave device */
+    {HCI_BLE_LTK_REQ_EVT, 12,
+     [](uint8_t* p, uint8_t) { btu_ble_proc_ltk_req(p); }},
+#if (BLE_PRIVACY_SPT == TRUE)
+    {HCI_BLE_ENHANCED_CONN_COMPLETE_EVT, 30,
+     [](uint8_t* p, uint8_t len) { btu_ble_proc_enhanced_conn_cmpl(p, len); }},
+#endif
+#if (BLE_LLT_INCLUDED == TRUE)
+    {HCI_BLE_RC_PARAM_REQ_EVT, 10,
+     [](uint8_t* p, uint8_t) { btu_ble_rc_param_req_evt(p); }},
+#endif
+    {HCI_BLE_DATA_LENGTH_CHANGE_EVT, 10,
+     [](uint8_t* p, uint8_t len) { btu_ble_data_length_change_evt(p, len); }},
+    {HCI_BLE_PHY_UPDATE_COMPLETE_EVT, 5,
+     [](uint8_t* p, uint8_t len) {
+       btm_ble_process_phy_update_pkt(len - 1, p);
+     }},
+    {HCI_LE_EXTENDED_ADVERTISING_REPORT_EVT, 1,
+     [](uint8_t* p, uint8_t len) { btm_ble_process_ext_adv_pkt(len, p); }},
+    {HCI_LE_ADVERTISING_SET_TERMINATED_EVT, 5,
+     [](uint8_t* p, uint8_t len) {
+       btm_le_on_advertising_set_terminated(p, len);
+     }},
+};
+
+static std::array<tBTU_HCIF_EVT_STATS, 256> btu_hcif_evt_stats;
+static std::array<tBTU_HCIF_EVT_STATS, 256> btu_hcif_ble_evt_stats;
+
+static void btu_hcif_update_evt_stats(tBTU_HCIF_EVT_STATS* stats,
+                                      uint64_t elapsed_us) {
+  stats->count++;
+  stats->total_us += elapsed_us;
+  stats->max_us = std::max(stats->max_us, elapsed_us);
+}
+
+/*******************************************************************************
+ *
+ * Function         btu_hcif_ble_event
+ *
+ * Description      Validate and route an LE meta event to the handler of its
+ *                  subevent.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void btu_hcif_ble_event(uint8_t* p, uint8_t hci_evt_len) {
+  static const std::array<const tBTU_HCIF_BLE_EVT_ENTRY*, 256> table = [] {
+    std::array<const tBTU_HCIF_BLE_EVT_ENTRY*, 256> t{};
+    for (const auto& entry : btu_hcif_ble_evt_entries) {
+      t[entry.sub_code] = &entry;
+    }
+    return t;
+  }();
+
+  uint8_t ble_sub_code;
+  STREAM_TO_UINT8(ble_sub_code, p);
+
+  HCI_TRACE_EVENT("BLE HCI(id=%d) event = 0x%02x)", HCI_BLE_EVENT,
+                  ble_sub_code);
+
+  const tBTU_HCIF_BLE_EVT_ENTRY* entry = table[ble_sub_code];
+  tBTU_HCIF_EVT_STATS* stats = &btu_hcif_ble_evt_stats[ble_sub_code];
+  if (entry == nullptr) {
+    stats->count++;
+    return;
+  }
+  if (hci_evt_len - 1 < entry->min_len) {
+    HCI_TRACE_WARNING("%s: subevt:0x%2X, malformed event of size %hhd",
+                      __func__, ble_sub_code, hci_evt_len);
+    stats->malformed_count++;
+    return;
+  }
+
+  uint64_t start_us = bluetooth::common::time_get_os_boottime_us();
+  entry->handler(p, hci_evt_len);
+  btu_hcif_update_evt_stats(
+      stats, bluetooth::common::time_get_os_boottime_us() - start_us);
+}
+
 /*******************************************************************************
  *
  * Function         btu_hcif_process_event
@@ -292,227 +516,58 @@ void btu_hcif_log_event_metrics(uint8_t evt_code, uint8_t* p_event) {
  *
  ******************************************************************************/
 void btu_hcif_process_event(UNUSED_ATTR uint8_t controller_id, BT_HDR* p_msg) {
+  static const std::array<tBTU_HCIF_EVT_HANDLER, 256> table = [] {
+    std::array<tBTU_HCIF_EVT_HANDLER, 256> t{};
+    for (const auto& entry : btu_hcif_evt_entries) {
+      t[entry.evt_code] = entry.handler;
+    }
+    return t;
+  }();
+
   uint8_t* p = (uint8_t*)(p_msg + 1) + p_msg->offset;
   uint8_t hci_evt_code, hci_evt_len;
-  uint8_t ble_sub_code;
-  STREAM_TO_UINT8(hci_evt_code, p);
-  STREAM_TO_UINT8(hci_evt_len, p);
+  StreamReader reader(p, p_msg->len);
+  if (!reader.Read(&hci_evt_code, &hci_evt_len)) {
+    HCI_TRACE_WARNING("%s: truncated event header", __func__);
+    return;
+  }
+  p += HCIE_PREAMBLE_SIZE;
 
-  // validate event size
-  if (hci_evt_len < hci_event_parameters_minimum_length[hci_evt_code]) {
+  tBTU_HCIF_EVT_STATS* stats = &btu_hcif_evt_stats[hci_evt_code];
+
+  // validate event size: the parameters must fit in the buffer, as the
+  // handlers only check them against the event parameter length
+  if (hci_evt_len < hci_event_parameters_minimum_length[hci_evt_code] ||
+      hci_evt_len > reader.Remaining()) {
     HCI_TRACE_WARNING("%s: evt:0x%2X, malformed event of size %hhd", __func__,
                       hci_evt_code, hci_evt_len);
+    stats->malformed_count++;
     return;
   }
 
+  uint64_t start_us = bluetooth::common::time_get_os_boottime_us();
   btu_hcif_log_event_metrics(hci_evt_code, p);
 
-  switch (hci_evt_code) {
-    case HCI_INQUIRY_COMP_EVT:
-      btu_hcif_inquiry_comp_evt(p);
-      break;
-    case HCI_INQUIRY_RESULT_EVT:
-      btu_hcif_inquiry_result_evt(p, hci_evt_len);
-      break;
-    case HCI_INQUIRY_RSSI_RESULT_EVT:
-      btu_hcif_inquiry_rssi_result_evt(p, hci_evt_len);
-      break;
-    case HCI_EXTENDED_INQUIRY_RESULT_EVT:
-      btu_hcif_extended_inquiry_result_evt(p, hci_evt_len);
-      break;
-    case HCI_CONNECTION_COMP_EVT:
-      btu_hcif_connection_comp_evt(p, hci_evt_len);
-      break;
-    case HCI_CONNECTION_REQUEST_EVT:
-      btu_hcif_connection_request_evt(p);
-      break;
-    case HCI_DISCONNECTION_COMP_EVT:
-      btu_hcif_disconnection_comp_evt(p);
-      break;
-    case HCI_AUTHENTICATION_COMP_EVT:
-      btu_hcif_authentication_comp_evt(p);
-      break;
-    case HCI_RMT_NAME_REQUEST_COMP_EVT:
-      btu_hcif_rmt_name_request_comp_evt(p, hci_evt_len);
-      break;
-    case HCI_ENCRYPTION_CHANGE_EVT:
-      btu_hcif_encryption_change_evt(p);
-      break;
-    case HCI_ENCRYPTION_KEY_REFRESH_COMP_EVT:
-      btu_hcif_encryption_key_refresh_cmpl_evt(p);
-      break;
-    case HCI_READ_RMT_FEATURES_COMP_EVT:
-      btu_hcif_read_rmt_features_comp_evt(p);
-      break;
-    case HCI_READ_RMT_EXT_FEATURES_COMP_EVT:
-      btu_hcif_read_rmt_ext_features_comp_evt(p, hci_evt_len);
-      break;
-    case HCI_READ_RMT_VERSION_COMP_EVT:
-      btu_hcif_read_rmt_version_comp_evt(p);
-      break;
-    case HCI_QOS_SETUP_COMP_EVT:
-      btu_hcif_qos_setup_comp_evt(p);
-      break;
-    case HCI_COMMAND_COMPLETE_EVT:
-      LOG_ERROR(LOG_TAG,
-                "%s should not have received a command complete event. "
-                "Someone didn't go through the hci transmit_command function.",
-                __func__);
-      break;
-    case HCI_COMMAND_STATUS_EVT:
-      LOG_ERROR(LOG_TAG,
-                "%s should not have received a command status event. "
-                "Someone didn't go through the hci transmit_command function.",
-                __func__);
-      break;
-    case HCI_HARDWARE_ERROR_EVT:
-      btu_hcif_hardware_error_evt(p);
-      break;
-    case HCI_FLUSH_OCCURED_EVT:
-      btu_hcif_flush_occured_evt();
-      break;
-    case HCI_ROLE_CHANGE_EVT:
-      btu_hcif_role_change_evt(p);
-      break;
-    case HCI_NUM_COMPL_DATA_PKTS_EVT:
-      btu_hcif_num_compl_data_pkts_evt(p, hci_evt_len);
-      break;
-    case HCI_MODE_CHANGE_EVT:
-      btu_hcif_mode_change_evt(p);
-      break;
-    case HCI_PIN_CODE_REQUEST_EVT:
-      btu_hcif_pin_code_request_evt(p);
-      break;
-    case HCI_LINK_KEY_REQUEST_EVT:
-      btu_hcif_link_key_request_evt(p);
-      break;
-    case HCI_LINK_KEY_NOTIFICATION_EVT:
-      btu_hcif_link_key_notification_evt(p);
-      break;
-    case HCI_LOOPBACK_COMMAND_EVT:
-      btu_hcif_loopback_command_evt();
-      break;
-    case HCI_DATA_BUF_OVERFLOW_EVT:
-      btu_hcif_data_buf_overflow_evt();
-      break;
-    case HCI_MAX_SLOTS_CHANGED_EVT:
-      btu_hcif_max_slots_changed_evt();
-      break;
-    case HCI_READ_CLOCK_OFF_COMP_EVT:
-      btu_hcif_read_clock_off_comp_evt(p);
-      break;
-    case HCI_CONN_PKT_TYPE_CHANGE_EVT:
-      btu_hcif_conn_pkt_type_change_evt();
-      break;
-    case HCI_QOS_VIOLATION_EVT:
-      btu_hcif_qos_violation_evt(p);
-      break;
-    case HCI_PAGE_SCAN_MODE_CHANGE_EVT:
-      btu_hcif_page_scan_mode_change_evt();
-      break;
-    case HCI_PAGE_SCAN_REP_MODE_CHNG_EVT:
-      btu_hcif_page_scan_rep_mode_chng_evt();
-      break;
-    case HCI_ESCO_CONNECTION_COMP_EVT:
-      btu_hcif_esco_connection_comp_evt(p);
-      break;
-    case HCI_ESCO_CONNECTION_CHANGED_EVT:
-      btu_hcif_esco_connection_chg_evt(p);
-      break;
-#if (BTM_SSR_INCLUDED == TRUE)
-    case HCI_SNIFF_SUB_RATE_EVT:
-      btu_hcif_ssr_evt(p, hci_evt_len);
-      break;
-#endif /* BTM_SSR_INCLUDED == TRUE */
-    case HCI_RMT_HOST_SUP_FEAT_NOTIFY_EVT:
-      btu_hcif_host_support_evt(p);
-      break;
-    case HCI_IO_CAPABILITY_REQUEST_EVT:
-      btu_hcif_io_cap_request_evt(p);
-      break;
-    case HCI_IO_CAPABILITY_RESPONSE_EVT:
-      btu_hcif_io_cap_response_evt(p);
-      break;
-    case HCI_USER_CONFIRMATION_REQUEST_EVT:
-      btu_hcif_user_conf_request_evt(p);
-      break;
-    case HCI_USER_PASSKEY_REQUEST_EVT:
-      btu_hcif_user_passkey_request_evt(p);
-      break;
-    case HCI_REMOTE_OOB_DATA_REQUEST_EVT:
-      btu_hcif_rem_oob_request_evt(p);
-      break;
-    case HCI_SIMPLE_PAIRING_COMPLETE_EVT:
-      btu_hcif_simple_pair_complete_evt(p);
-      break;
-    case HCI_USER_PASSKEY_NOTIFY_EVT:
-      btu_hcif_user_passkey_notif_evt(p);
-      break;
-    case HCI_KEYPRESS_NOTIFY_EVT:
-      btu_hcif_keypress_notif_evt(p);
-      break;
-#if (L2CAP_NON_FLUSHABLE_PB_INCLUDED == TRUE)
-    case HCI_ENHANCED_FLUSH_COMPLETE_EVT:
-      btu_hcif_enhanced_flush_complete_evt();
-      break;
-#endif
-
-    case HCI_BLE_EVENT: {
-      STREAM_TO_UINT8(ble_sub_code, p);
-
-      HCI_TRACE_EVENT("BLE HCI(id=%d) event = 0x%02x)", hci_evt_code,
-                      ble_sub_code);
-
-      uint8_t ble_evt_len = hci_evt_len - 1;
-      switch (ble_sub_code) {
-        case HCI_BLE_ADV_PKT_RPT_EVT: /* result of inquiry */
-          HCI_TRACE_EVENT("HCI_BLE_ADV_PKT_RPT_EVT");
-          btm_ble_process_adv_pkt(ble_evt_len, p);
-          break;
-        case HCI_BLE_CONN_COMPLETE_EVT:
-          btu_ble_ll_conn_complete_evt(p, hci_evt_len);
-          break;
-        case HCI_BLE_LL_CONN_PARAM_UPD_EVT:
-          btu_ble_ll_conn_param_upd_evt(p, hci_evt_len);
-          break;
-        case HCI_BLE_READ_REMOTE_FEAT_CMPL_EVT:
-          btu_ble_read_remote_feat_evt(p);
-          break;
-        case HCI_BLE_LTK_REQ_EVT: /* received only at slave device */
-          btu_ble_proc_ltk_req(p);
-          break;
-#if (BLE_PRIVACY_SPT == TRUE)
-        case HCI_BLE_ENHANCED_CONN_COMPLETE_EVT:
-          btu_ble_proc_enhanced_conn_cmpl(p, hci_evt_len);
-          break;
-#endif
-#if (BLE_LLT_INCLUDED == TRUE)
-        case HCI_BLE_RC_PARAM_REQ_EVT:
-          btu_ble_rc_param_req_evt(p);
-          break;
-#endif
-        case HCI_BLE_DATA_LENGTH_CHANGE_EVT:
-          btu_ble_data_length_change_evt(p, hci_evt_len);
-          break;
-
-        case HCI_BLE_PHY_UPDATE_COMPLETE_EVT:
-          btm_ble_process_phy_update_pkt(ble_evt_len, p);
-          break;
-
-        case HCI_LE_EXTENDED_ADVERTISING_REPORT_EVT:
-          btm_ble_process_ext_adv_pkt(hci_evt_len, p);
-          break;
-
-        case HCI_LE_ADVERTISING_SET_TERMINATED_EVT:
-          btm_le_on_advertising_set_terminated(p, hci_evt_len);
-          break;
-      }
-      break;
-    }
+  tBTU_HCIF_EVT_HANDLER handler = table[hci_evt_code];
+  if (handler != nullptr) handler(p, hci_evt_len);
+  btu_hcif_update_evt_stats(
+      stats, bluetooth::common::time_get_os_boottime_us() - start_us);
+}
 
-    case HCI_VENDOR_SPECIFIC_EVT:
-      btm_vendor_specific_evt(p, hci_evt_len);
-      break;
+static void btu_hcif_dump_evt_stats(
+    int fd, const char* prefix,
+    const std::array<tBTU_HCIF_EVT_STATS, 256>& evt_stats) {
+  for (size_t code = 0; code < evt_stats.size(); code++) {
+    const tBTU_HCIF_EVT_STATS& stats = evt_stats[code];
+    if (stats.count == 0 && stats.malformed_count == 0) continue;
+    dprintf(fd,
+            "  %s0x%02zx count:%u malformed:%u time in us total:%llu max:%llu "
+            "ave:%llu\n",
+            prefix, code, stats.count, stats.malformed_count,
+            (unsigned long long)stats.total_us,
+            (unsigned long long)stats.max_us,
+            (unsigned long long)(stats.count ? stats.total_us / stats.count
+                                             : 0));
   }
 }
 
@@ -799,14 +854,36 @@ struct cmd_with_cb_data {
   Location posted_from;
 };
 
-void cmd_with_cb_data_init(cmd_with_cb_data* cb_wrapper) {
-  new (&cb_wrapper->cb) hci_cmd_cb;
-  new (&cb_wrapper->posted_from) Location;
+/* Every command sent with a callback needs a context until its command
+ * complete or status, the contexts are recycled rather than allocated each
+ * time. Commands are sent and completed on different threads. */
+static constexpr size_t kCmdWithCbPoolSize = 16;
+static std::mutex cmd_with_cb_pool_mutex;
+static std::vector<cmd_with_cb_data*> cmd_with_cb_pool;
+static size_t cmd_with_cb_pool_hits = 0;
+static size_t cmd_with_cb_pool_misses = 0;
+
+static cmd_with_cb_data* cmd_with_cb_data_get() {
+  std::lock_guard<std::mutex> lock(cmd_with_cb_pool_mutex);
+  if (cmd_with_cb_pool.empty()) {
+    cmd_with_cb_pool_misses++;
+    return new cmd_with_cb_data();
+  }
+  cmd_with_cb_pool_hits++;
+  cmd_with_cb_data* cb_wrapper = cmd_with_cb_pool.back();
+  cmd_with_cb_pool.pop_back();
+  return cb_wrapper;
 }
 
-void cmd_with_cb_data_cleanup(cmd_with_cb_data* cb_wrapper) {
-  cb_wrapper->cb.~hci_cmd_cb();
-  cb_wrapper->posted_from.~Location();
+static void cmd_with_cb_data_put(cmd_with_cb_data* cb_wrapper) {
+  cb_wrapper->cb.Reset();
+  cb_wrapper->posted_from = Location();
+  std::lock_guard<std::mutex> lock(cmd_with_cb_pool_mutex);
+  if (cmd_with_cb_pool.size() >= kCmdWithCbPoolSize) {
+    delete cb_wrapper;
+    return;
+  }
+  cmd_with_cb_pool.push_back(cb_wrapper);
 }
 
 /**
@@ -887,8 +964,7 @@ static void btu_hcif_command_complete_evt_with_cb_on_task(BT_HDR* event,
   // 3 for command complete header: num_hci_pkt (1) + opcode (2)
   uint16_t param_len = static_cast<uint16_t>(event->len - 5);
   std::move(cb_wrapper->cb).Run(stream, param_len);
-  cmd_with_cb_data_cleanup(cb_wrapper);
-  osi_free(cb_wrapper);
+  cmd_with_cb_data_put(cb_wrapper);
 
   osi_free(event);
 }
@@ -918,8 +994,7 @@ static void btu_hcif_command_status_evt_with_cb_on_task(uint8_t status,
   HCI_TRACE_DEBUG("command status for: %s",
                   cb_wrapper->posted_from.ToString().c_str());
   std::move(cb_wrapper->cb).Run(&status, sizeof(uint16_t));
-  cmd_with_cb_data_cleanup(cb_wrapper);
-  osi_free(cb_wrapper);
+  cmd_with_cb_data_put(cb_wrapper);
 
   osi_free(event);
 }
@@ -958,10 +1033,7 @@ void btu_hcif_send_cmd_with_cb(const Location& posted_from, uint16_t opcode,
   btu_hcif_log_command_metrics(opcode, pp,
                                android::bluetooth::hci::STATUS_UNKNOWN, false);
 
-  cmd_with_cb_data* cb_wrapper =
-      (cmd_with_cb_data*)osi_malloc(sizeof(cmd_with_cb_data));
-
-  cmd_with_cb_data_init(cb_wrapper);
+  cmd_with_cb_data* cb_wrapper = cmd_with_cb_data_get();
   cb_wrapper->cb = std::move(cb);
   cb_wrapper->posted_from = posted_from;
 
@@ -970,6 +1042,27 @@ void btu_hcif_send_cmd_with_cb(const Location& posted_from, uint16_t opcode,
       btu_hcif_command_status_evt_with_cb, (void*)cb_wrapper);
 }
 
+/*******************************************************************************
+ *
+ * Function         stack_debug_btu_hcif_dump
+ *
+ * Description      Dump the processing time of the HCI events, and the use of
+ *                  the command callback contexts.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void stack_debug_btu_hcif_dump(int fd) {
+  dprintf(fd, "\nHCI Event Processing:\n");
+  btu_hcif_dump_evt_stats(fd, "evt:", btu_hcif_evt_stats);
+  btu_hcif_dump_evt_stats(fd, "le subevt:", btu_hcif_ble_evt_stats);
+
+  std::lock_guard<std::mutex> lock(cmd_with_cb_pool_mutex);
+  dprintf(fd, "  command callback contexts pooled:%zu hits:%zu misses:%zu\n",
+          cmd_with_cb_pool.size(), cmd_with_cb_pool_hits,
+          cmd_with_cb_pool_misses);
+}
+
 /*******************************************************************************
  *
  * Function         btu_hcif_inquiry_comp_evt
@@ -1048,18 +1141,13 @@ static void btu_hcif_connection_comp_evt(uint8_t* p, uint8_t evt_len) {
   uint8_t enc_mode;
   tBTM_ESCO_DATA esco_data;
 
-  if (evt_len < 11) {
+  StreamReader reader(p, evt_len);
+  if (!reader.Read(&status, &handle, &bda, &link_type, &enc_mode)) {
     android_errorWriteLog(0x534e4554, "141619686");
     HCI_TRACE_WARNING("%s: malformed event of size %hhd", __func__, evt_len);
     return;
   }
 
-  STREAM_TO_UINT8(status, p);
-  STREAM_TO_UINT16(handle, p);
-  STREAM_TO_BDADDR(bda, p);
-  STREAM_TO_UINT8(link_type, p);
-  STREAM_TO_UINT8(enc_mode, p);
-
   handle = HCID_GET_HANDLE(handle);
 
   if (status != HCI_SUCCESS) {
@@ -1117,14 +1205,13 @@ static void btu_hcif_connection_request_evt(uint8_t* p) {
  * Returns          void
  *
  ******************************************************************************/
-static void btu_hcif_disconnection_comp_evt(uint8_t* p) {
+static void btu_hcif_disconnection_comp_evt(uint8_t* p, uint8_t evt_len) {
   uint8_t status;
   uint16_t handle;
   uint8_t reason;
 
-  STREAM_TO_UINT8(status, p);
-  STREAM_TO_UINT16(handle, p);
-  STREAM_TO_UINT8(reason, p);
+  StreamReader reader(p, evt_len);
+  if (!reader.Read(&status, &handle, &reason)) return;
 
   handle = HCID_GET_HANDLE(handle);
 
@@ -1151,12 +1238,12 @@ static void btu_hcif_disconnection_comp_evt(uint8_t* p) {
  * Returns          void
  *
  ******************************************************************************/
-static void btu_hcif_authentication_comp_evt(uint8_t* p) {
+static void btu_hcif_authentication_comp_evt(uint8_t* p, uint8_t evt_len) {
   uint8_t status;
   uint16_t handle;
 
-  STREAM_TO_UINT8(status, p);
-  STREAM_TO_UINT16(handle, p);
+  StreamReader reader(p, evt_len);
+  if (!reader.Read(&status, &handle)) return;
 
   btm_sec_auth_complete(handle, status);
 }
@@ -1170,14 +1257,16 @@ static void btu_hcif_authentication_comp_evt(uint8_t* p) {
  * Returns          void
  *
  ******************************************************************************/
-static void btu_hcif_rmt_name_request_comp_evt(uint8_t* p, uint16_t evt_len) {
+static void btu_hcif_rmt_name_request_comp_evt(uint8_t* p, uint8_t evt_len) {
   uint8_t status;
   RawAddress bd_addr;
 
-  STREAM_TO_UINT8(status, p);
-  STREAM_TO_BDADDR(bd_addr, p);
+  StreamReader reader(p, evt_len);
+  if (!reader.Read(&status, &bd_addr)) return;
 
-  evt_len -= (1 + BD_ADDR_LEN);
+  /* The name follows */
+  p += evt_len - reader.Remaining();
+  evt_len = reader.Remaining();
 
   btm_process_remote_name(&bd_addr, p, evt_len, status);
 
@@ -1224,14 +1313,13 @@ static void read_encryption_key_size_complete_after_encryption_change(uint8_t st
  * Returns          void
  *
  ******************************************************************************/
-static void btu_hcif_encryption_change_evt(uint8_t* p) {
+static void btu_hcif_encryption_change_evt(uint8_t* p, uint8_t evt_len) {
   uint8_t status;
   uint16_t handle;
   uint8_t encr_enable;
 
-  STREAM_TO_UINT8(status, p);
-  STREAM_TO_UINT16(handle, p);
-  STREAM_TO_UINT8(encr_enable, p);
+  StreamReader reader(p, evt_len);
+  if (!reader.Read(&status, &handle, &encr_enable)) return;
 
   if (status != HCI_SUCCESS || encr_enable == 0 || BTM_IsBleConnection(handle)) {
     if (status == HCI_ERR_CONNECTION_TOUT) {
@@ -1270,16 +1358,16 @@ static void btu_hcif_read_rmt_features_comp_evt(uint8_t* p) {
  ******************************************************************************/
 static void btu_hcif_read_rmt_ext_features_comp_evt(uint8_t* p,
                                                     uint8_t evt_len) {
-  uint8_t* p_cur = p;
   uint8_t status;
   uint16_t handle;
 
-  STREAM_TO_UINT8(status, p_cur);
+  StreamReader reader(p, evt_len);
+  if (!reader.Read(&status)) return;
 
   if (status == HCI_SUCCESS)
     btm_read_remote_ext_features_complete(p, evt_len);
   else {
-    STREAM_TO_UINT16(handle, p_cur);
+    if (!reader.Read(&handle)) return;
     btm_read_remote_ext_features_failed(status, handle);
   }
 }
@@ -1306,19 +1394,16 @@ static void btu_hcif_read_rmt_version_comp_evt(uint8_t* p) {
  * Returns          void
  *
  ******************************************************************************/
-static void btu_hcif_qos_setup_comp_evt(uint8_t* p) {
+static void btu_hcif_qos_setup_comp_evt(uint8_t* p, uint8_t evt_len) {
   uint8_t status;
   uint16_t handle;
   FLOW_SPEC flow;
 
-  STREAM_TO_UINT8(status, p);
-  STREAM_TO_UINT16(handle, p);
-  STREAM_TO_UINT8(flow.qos_flags, p);
-  STREAM_TO_UINT8(flow.service_type, p);
-  STREAM_TO_UINT32(flow.token_rate, p);
-  STREAM_TO_UINT32(flow.peak_bandwidth, p);
-  STREAM_TO_UINT32(flow.latency, p);
-  STREAM_TO_UINT32(flow.delay_variation, p);
+  StreamReader reader(p, evt_len);
+  if (!reader.Read(&status, &handle, &flow.qos_flags, &flow.service_type,
+                   &flow.token_rate, &flow.peak_bandwidth, &flow.latency,
+                   &flow.delay_variation))
+    return;
 
   btm_qos_setup_complete(status, handle, &flow);
 }
@@ -1332,22 +1417,17 @@ static void btu_hcif_qos_setup_comp_evt(uint8_t* p) {
  * Returns          void
  *
  ******************************************************************************/
-static void btu_hcif_esco_connection_comp_evt(uint8_t* p) {
+static void btu_hcif_esco_connection_comp_evt(uint8_t* p, uint8_t evt_len) {
   tBTM_ESCO_DATA data;
   uint16_t handle;
   RawAddress bda;
   uint8_t status;
 
-  STREAM_TO_UINT8(status, p);
-  STREAM_TO_UINT16(handle, p);
-  STREAM_TO_BDADDR(bda, p);
-
-  STREAM_TO_UINT8(data.link_type, p);
-  STREAM_TO_UINT8(data.tx_interval, p);
-  STREAM_TO_UINT8(data.retrans_window, p);
-  STREAM_TO_UINT16(data.rx_pkt_len, p);
-  STREAM_TO_UINT16(data.tx_pkt_len, p);
-  STREAM_TO_UINT8(data.air_mode, p);
+  StreamReader reader(p, evt_len);
+  if (!reader.Read(&status, &handle, &bda, &data.link_type, &data.tx_interval,
+                   &data.retrans_window, &data.rx_pkt_len, &data.tx_pkt_len,
+                   &data.air_mode))
+    return;
 
   handle = HCID_GET_HANDLE(handle);
 
@@ -1364,7 +1444,7 @@ static void btu_hcif_esco_connection_comp_evt(uint8_t* p) {
  * Returns          void
  *
  ******************************************************************************/
-static void btu_hcif_esco_connection_chg_evt(uint8_t* p) {
+static void btu_hcif_esco_connection_chg_evt(uint8_t* p, uint8_t evt_len) {
   uint16_t handle;
   uint16_t tx_pkt_len;
   uint16_t rx_pkt_len;
@@ -1372,13 +1452,10 @@ static void btu_hcif_esco_connection_chg_evt(uint8_t* p) {
   uint8_t tx_interval;
   uint8_t retrans_window;
 
-  STREAM_TO_UINT8(status, p);
-  STREAM_TO_UINT16(handle, p);
-
-  STREAM_TO_UINT8(tx_interval, p);
-  STREAM_TO_UINT8(retrans_window, p);
-  STREAM_TO_UINT16(rx_pkt_len, p);
-  STREAM_TO_UINT16(tx_pkt_len, p);
+  StreamReader reader(p, evt_len);
+  if (!reader.Read(&status, &handle, &tx_interval, &retrans_window,
+                   &rx_pkt_len, &tx_pkt_len))
+    return;
 
   handle = HCID_GET_HANDLE(handle);
 
@@ -1738,14 +1815,13 @@ static void btu_hcif_flush_occured_evt(void) {}
  * Returns          void
  *
  ******************************************************************************/
-static void btu_hcif_role_change_evt(uint8_t* p) {
+static void btu_hcif_role_change_evt(uint8_t* p, uint8_t evt_len) {
   uint8_t status;
   RawAddress bda;
   uint8_t role;
 
-  STREAM_TO_UINT8(status, p);
-  STREAM_TO_BDADDR(bda, p);
-  STREAM_TO_UINT8(role, p);
+  StreamReader reader(p, evt_len);
+  if (!reader.Read(&status, &bda, &role)) return;
 
   btm_blacklist_role_change_device(bda, status);
   l2c_link_role_changed(&bda, role, status);
@@ -1778,17 +1854,14 @@ static void btu_hcif_num_compl_data_pkts_evt(uint8_t* p, uint8_t evt_len) {
  * Returns          void
  *
  ******************************************************************************/
-static void btu_hcif_mode_change_evt(uint8_t* p) {
+static void btu_hcif_mode_change_evt(uint8_t* p, uint8_t evt_len) {
   uint8_t status;
   uint16_t handle;
   uint8_t current_mode;
   uint16_t interval;
 
-  STREAM_TO_UINT8(status, p);
-
-  STREAM_TO_UINT16(handle, p);
-  STREAM_TO_UINT8(current_mode, p);
-  STREAM_TO_UINT16(interval, p);
+  StreamReader reader(p, evt_len);
+  if (!reader.Read(&status, &handle, &current_mode, &interval)) return;
   btm_sco_chk_pend_unpark(status, handle);
   btm_pm_proc_mode_change(status, handle, current_mode, interval);
 
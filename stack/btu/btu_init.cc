@@ -20,8 +20,10 @@
 
 #include <base/logging.h>
 #include <pthread.h>
+#include <stdio.h>
 #include <string.h>
 
+#include "avdt_int.h"
 #include "bt_target.h"
 #include "btm_int.h"
 #include "btu.h"
@@ -29,12 +31,15 @@
 #include "device/include/controller.h"
 #include "gatt_api.h"
 #include "gatt_int.h"
+#include "hidh_int.h"
 #include "l2c_int.h"
 #include "osi/include/alarm.h"
 #include "osi/include/fixed_queue.h"
 #include "osi/include/log.h"
 #include "sdpint.h"
 #include "smp_int.h"
+#include "stack/rfcomm/rfc_int.h"
+#include "stack_config.h"
 
 using bluetooth::common::MessageLoopThread;
 
@@ -54,6 +59,9 @@ void btu_task_shut_down(void* context);
  *
  *****************************************************************************/
 void btu_init_core() {
+  int budget = stack_config_get_interface()->get_buffer_budget_bytes();
+  btu_budget_init(budget > 0 ? budget : 0);
+
   /* Initialize the mandatory core stack components */
   btm_init();
 
@@ -86,9 +94,44 @@ void btu_free_core() {
 
   sdp_free();
 
+  SMP_Free();
+
   btm_free();
 }
 
+/*****************************************************************************
+ *
+ * Function         stack_debug_btu_footprint_dump
+ *
+ * Description      Dump the memory taken by the control block of each stack
+ *                  component. They are sized at build time by bt_target.h.
+ *
+ * Returns          void
+ *
+ *****************************************************************************/
+void stack_debug_btu_footprint_dump(int fd) {
+  const struct {
+    const char* name;
+    size_t size;
+  } blocks[] = {
+      {"btm_cb", sizeof(btm_cb)},     {"l2cb", sizeof(l2cb)},
+      {"sdp_cb", sizeof(sdp_cb)},     {"gatt_cb", sizeof(gatt_cb)},
+      {"smp_cb", sizeof(smp_cb)},     {"rfc_cb", sizeof(rfc_cb)},
+      {"avdtp_cb", sizeof(avdtp_cb)},
+#if (HID_HOST_INCLUDED == TRUE)
+      {"hh_cb", sizeof(hh_cb)},
+#endif
+  };
+
+  dprintf(fd, "\nStack Control Blocks:\n");
+  size_t total = 0;
+  for (const auto& block : blocks) {
+    dprintf(fd, "  %-10s %7zu bytes\n", block.name, block.size);
+    total += block.size;
+  }
+  dprintf(fd, "  %-10s %7zu bytes\n", "total", total);
+}
+
 /*****************************************************************************
  *
  * Function         BTU_StartUp
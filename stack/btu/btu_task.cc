@@ -28,8 +28,12 @@
 #include "bte.h"
 #include "btif/include/btif_common.h"
 #include "common/message_loop_thread.h"
+#include "common/trace.h"
+#include "main/shim/shim.h"
 #include "osi/include/osi.h"
+#include "osi/include/properties.h"
 #include "stack/btm/btm_int.h"
+#include "stack/include/btm_iso_api.h"
 #include "stack/include/btu.h"
 #include "stack/l2cap/l2c_int.h"
 
@@ -40,12 +44,39 @@
 
 using bluetooth::common::MessageLoopThread;
 
+/* Collects the latency of the tasks of the BTU thread, for dumpsys */
+#define BTU_TASK_STATS_PROPERTY "persist.bluetooth.task_stats"
+/* Moves the LE advertising report pipeline to a thread of its own */
+#define BTU_SHARD_LE_SCAN_PROPERTY "persist.bluetooth.shard.le_scan"
+/* Keeps the ISO data path on a thread of its own, on by default */
+#define BTU_SHARD_ISO_PROPERTY "persist.bluetooth.shard.iso"
+
 /* Define BTU storage area */
 uint8_t btu_trace_level = HCI_INITIAL_TRACE_LEVEL;
 
 static MessageLoopThread main_thread("bt_main_thread");
 
+struct tBTU_SHARD_INFO {
+  const char* thread_name;
+  const char* property;
+  bool default_threaded;
+};
+
+static const tBTU_SHARD_INFO btu_shard_info[BTU_SHARD_MAX] = {
+    {"bt_le_scan_thread", BTU_SHARD_LE_SCAN_PROPERTY, false},
+    {"bt_iso_thread", BTU_SHARD_ISO_PROPERTY, true},
+};
+
+/* Threads of the shards enabled at start up, nullptr for the others. Only
+ * changed while the main thread is not running. */
+static MessageLoopThread* btu_shard_threads[BTU_SHARD_MAX];
+
+/* Reception time of the HCI packet being processed, 0 if unknown */
+static uint64_t btu_rx_timestamp_us = 0;
+
 void btu_hci_msg_process(BT_HDR* p_msg) {
+  BT_TRACE_SCOPE("btu_hci_msg_process", p_msg);
+
   /* Determine the input message type. */
   switch (p_msg->event & BT_EVT_MASK) {
     case BT_EVT_TO_BTU_HCI_ACL:
@@ -72,8 +103,10 @@ void btu_hci_msg_process(BT_HDR* p_msg) {
       break;
 
     case BT_EVT_TO_BTU_HCI_ISO:
-      // TODO: implement handler
-      osi_free(p_msg);
+      /* ISO data is handed to the ISO shard before the main thread */
+      do_in_shard_thread(
+          BTU_SHARD_ISO, FROM_HERE,
+          base::BindOnce(&btm_iso_data_received, p_msg, btu_rx_timestamp_us));
       break;
 
     default:
@@ -82,6 +115,14 @@ void btu_hci_msg_process(BT_HDR* p_msg) {
   }
 }
 
+void btu_hci_msg_process_at(BT_HDR* p_msg, uint64_t rx_timestamp_us) {
+  btu_rx_timestamp_us = rx_timestamp_us;
+  btu_hci_msg_process(p_msg);
+  btu_rx_timestamp_us = 0;
+}
+
+uint64_t btu_get_rx_timestamp_us(void) { return btu_rx_timestamp_us; }
+
 bluetooth::common::MessageLoopThread* get_main_thread() { return &main_thread; }
 
 base::MessageLoop* get_main_message_loop() {
@@ -108,6 +149,55 @@ bt_status_t do_in_main_thread_delayed(const base::Location& from_here,
   return BT_STATUS_SUCCESS;
 }
 
+bool btu_shard_is_threaded(tBTU_SHARD shard) {
+  return btu_shard_threads[shard] != nullptr;
+}
+
+bt_status_t do_in_shard_thread(tBTU_SHARD shard,
+                               const base::Location& from_here,
+                               base::OnceClosure task) {
+  MessageLoopThread* thread = btu_shard_threads[shard];
+  if (thread == nullptr) return do_in_main_thread(from_here, std::move(task));
+  if (!thread->DoInThread(from_here, std::move(task))) {
+    LOG(ERROR) << __func__ << ": failed from " << from_here.ToString();
+    return BT_STATUS_FAIL;
+  }
+  return BT_STATUS_SUCCESS;
+}
+
+static void btu_shards_start_up() {
+  for (int i = 0; i < BTU_SHARD_MAX; i++) {
+    if (bluetooth::shim::is_gd_shim_enabled() ||
+        !osi_property_get_bool(btu_shard_info[i].property,
+                               btu_shard_info[i].default_threaded)) {
+      continue;
+    }
+    MessageLoopThread* thread =
+        new MessageLoopThread(btu_shard_info[i].thread_name);
+    thread->StartUp();
+    if (!thread->IsRunning()) {
+      LOG(ERROR) << __func__ << ": unable to start "
+                 << btu_shard_info[i].thread_name
+                 << ", its pipeline stays on the main thread";
+      delete thread;
+      continue;
+    }
+    if (osi_property_get_bool(BTU_TASK_STATS_PROPERTY, false)) {
+      thread->EnableTaskStats(true);
+    }
+    btu_shard_threads[i] = thread;
+  }
+}
+
+static void btu_shards_shut_down() {
+  for (int i = 0; i < BTU_SHARD_MAX; i++) {
+    if (btu_shard_threads[i] == nullptr) continue;
+    btu_shard_threads[i]->ShutDown();
+    delete btu_shard_threads[i];
+    btu_shard_threads[i] = nullptr;
+  }
+}
+
 void btu_task_start_up(UNUSED_ATTR void* context) {
   LOG(INFO) << "Bluetooth chip preload is complete";
 
@@ -128,6 +218,7 @@ void btu_task_start_up(UNUSED_ATTR void* context) {
    */
   module_init(get_module(BTE_LOGMSG_MODULE));
 
+  btu_shards_start_up();
   main_thread.StartUp();
   if (!main_thread.IsRunning()) {
     LOG(FATAL) << __func__ << ": unable to start btu message loop thread.";
@@ -135,6 +226,9 @@ void btu_task_start_up(UNUSED_ATTR void* context) {
   if (!main_thread.EnableRealTimeScheduling()) {
     LOG(FATAL) << __func__ << ": unable to enable real time scheduling";
   }
+  if (osi_property_get_bool(BTU_TASK_STATS_PROPERTY, false)) {
+    main_thread.EnableTaskStats(true);
+  }
   if (do_in_jni_thread(FROM_HERE, base::Bind(btif_init_ok, 0, nullptr)) !=
       BT_STATUS_SUCCESS) {
     LOG(FATAL) << __func__ << ": unable to continue starting Bluetooth";
@@ -144,6 +238,8 @@ void btu_task_start_up(UNUSED_ATTR void* context) {
 void btu_task_shut_down(UNUSED_ATTR void* context) {
   // Shutdown message loop on task completed
   main_thread.ShutDown();
+  // After the main thread, so that it never hands work to a stopped shard
+  btu_shards_shut_down();
 
   module_clean_up(get_module(BTE_LOGMSG_MODULE));
 
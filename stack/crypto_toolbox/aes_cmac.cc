@@ -23,6 +23,7 @@
  ******************************************************************************/
 
 #include "stack/crypto_toolbox/aes.h"
+#include "stack/crypto_toolbox/aes_hw.h"
 #include "stack/crypto_toolbox/crypto_toolbox.h"
 
 #include <base/logging.h>
@@ -58,23 +59,42 @@ static void xor_128(Octet16* a, const Octet16& b) {
 }
 }  // namespace
 
+/* Number of blocks byte reversed at once by aes_128_multi() */
+constexpr size_t AES_MULTI_CHUNK = 16;
+
 /* This function computes AES_128(key, message) */
 Octet16 aes_128(const Octet16& key, const Octet16& message) {
-  Octet16 key_reversed;
-  Octet16 message_reversed;
   Octet16 output;
-
-  std::reverse_copy(key.begin(), key.end(), key_reversed.begin());
-  std::reverse_copy(message.begin(), message.end(), message_reversed.begin());
-
-  aes_context ctx;
-  aes_set_key(key_reversed.data(), key_reversed.size(), &ctx);
-  aes_encrypt(message_reversed.data(), output.data(), &ctx);
-
-  std::reverse(output.begin(), output.end());
+  aes_128_multi(&key, &message, &output, 1);
   return output;
 }
 
+/* This function computes AES_128(keys[i], messages[i]) for |count| blocks.
+ * The toolbox uses little endian octets, AES big endian ones. */
+void aes_128_multi(const Octet16* keys, const Octet16* messages,
+                   Octet16* outputs, size_t count) {
+  Octet16 keys_reversed[AES_MULTI_CHUNK];
+  Octet16 blocks[AES_MULTI_CHUNK];
+
+  for (size_t i = 0; i < count; i += AES_MULTI_CHUNK) {
+    size_t n = std::min(count - i, AES_MULTI_CHUNK);
+    for (size_t j = 0; j < n; j++) {
+      std::reverse_copy(keys[i + j].begin(), keys[i + j].end(),
+                        keys_reversed[j].begin());
+      std::reverse_copy(messages[i + j].begin(), messages[i + j].end(),
+                        blocks[j].begin());
+    }
+
+    aes_128_encrypt_blocks(keys_reversed[0].data(), blocks[0].data(),
+                           blocks[0].data(), n);
+
+    for (size_t j = 0; j < n; j++) {
+      std::reverse_copy(blocks[j].begin(), blocks[j].end(),
+                        outputs[i + j].begin());
+    }
+  }
+}
+
 /** utility function to padding the given text to be a 128 bits data. The
  * parameter dest is input and output parameter, it must point to a
  * OCTET16_LEN memory space; where include length bytes valid data. */
@@ -21,6 +21,8 @@
 namespace crypto_toolbox {
 
 extern Octet16 aes_128(const Octet16& key, const Octet16& message);
+extern void aes_128_multi(const Octet16* keys, const Octet16* messages,
+                          Octet16* outputs, size_t count);
 extern Octet16 aes_cmac(const Octet16& key, const uint8_t* message,
                         uint16_t length);
 extern Octet16 f4(const uint8_t* u, const uint8_t* v, const Octet16& x,
@@ -183,13 +183,14 @@ BT_HDR* attp_build_read_by_type_value_cmd(uint16_t payload_size,
  *
  * Function         attp_build_read_multi_cmd
  *
- * Description      Build a read multiple request
+ * Description      Build a read multiple or read multiple variable length
+ *                  request
  *
  * Returns          None.
  *
  ******************************************************************************/
-BT_HDR* attp_build_read_multi_cmd(uint16_t payload_size, uint16_t num_handle,
-                                  uint16_t* p_handle) {
+BT_HDR* attp_build_read_multi_cmd(uint8_t op_code, uint16_t payload_size,
+                                  uint16_t num_handle, uint16_t* p_handle) {
   uint8_t *p, i = 0;
   BT_HDR* p_buf = (BT_HDR*)osi_malloc(sizeof(BT_HDR) + num_handle * 2 + 1 +
                                       L2CAP_MIN_OFFSET);
@@ -198,7 +199,7 @@ BT_HDR* attp_build_read_multi_cmd(uint16_t payload_size, uint16_t num_handle,
   p_buf->offset = L2CAP_MIN_OFFSET;
   p_buf->len = 1;
 
-  UINT8_TO_STREAM(p, GATT_REQ_READ_MULTI);
+  UINT8_TO_STREAM(p, op_code);
 
   for (i = 0; i < num_handle && p_buf->len + 2 <= payload_size; i++) {
     UINT16_TO_STREAM(p, *(p_handle + i));
@@ -401,6 +402,120 @@ tGATT_STATUS attp_send_sr_msg(tGATT_TCB& tcb, BT_HDR* p_msg) {
   return attp_send_msg_to_l2cap(tcb, p_msg);
 }
 
+/*******************************************************************************
+ *
+ * Function         attp_send_sr_notifications
+ *
+ * Description      This function builds handle value notifications and sends
+ *                  them to the client of |tcb| in one L2CAP pass. Each PDU is
+ *                  built straight from the caller's value, in a buffer sized
+ *                  to the PDU.
+ *
+ * Parameter        tcb: connection control block.
+ *                  p_notifs: notifications to send, all for |tcb|.
+ *                  num_notifs: number of notifications.
+ *                  p_num_sent: set to the number of notifications sent.
+ *
+ * Returns          GATT_SUCCESS if all notifications were sent, GATT_CONGESTED
+ *                  if the channel is congested; otherwise error code.
+ *
+ ******************************************************************************/
+tGATT_STATUS attp_send_sr_notifications(tGATT_TCB& tcb,
+                                        const tGATT_NOTIFICATION* p_notifs,
+                                        uint16_t num_notifs,
+                                        uint16_t* p_num_sent) {
+  std::vector<BT_HDR*> msgs(num_notifs);
+  for (uint16_t i = 0; i < num_notifs; i++) {
+    uint16_t len = p_notifs[i].len;
+    if (len > tcb.payload_size - GATT_HDR_SIZE) {
+      len = tcb.payload_size - GATT_HDR_SIZE;
+      LOG(WARNING) << StringPrintf(
+          "attribute value too long, to be truncated to %d", len);
+    }
+
+    BT_HDR* p_buf = (BT_HDR*)osi_malloc(sizeof(BT_HDR) + L2CAP_MIN_OFFSET +
+                                        GATT_HDR_SIZE + len);
+    uint8_t* p = (uint8_t*)(p_buf + 1) + L2CAP_MIN_OFFSET;
+    UINT8_TO_STREAM(p, GATT_HANDLE_VALUE_NOTIF);
+    UINT16_TO_STREAM(p, p_notifs[i].handle);
+    ARRAY_TO_STREAM(p, p_notifs[i].p_value, len);
+    p_buf->offset = L2CAP_MIN_OFFSET;
+    p_buf->len = GATT_HDR_SIZE + len;
+    msgs[i] = p_buf;
+  }
+
+  uint16_t l2cap_ret;
+  uint16_t num_handed = 0;
+  if (tcb.att_lcid == L2CAP_ATT_CID) {
+    l2cap_ret = L2CA_SendFixedChnlDataBatch(
+        L2CAP_ATT_CID, tcb.peer_bda, msgs.data(), num_notifs, &num_handed);
+  } else {
+    l2cap_ret = L2CAP_DW_SUCCESS;
+    while (num_handed < num_notifs && l2cap_ret == L2CAP_DW_SUCCESS) {
+      l2cap_ret = (uint16_t)L2CA_DataWrite(tcb.att_lcid, msgs[num_handed++]);
+    }
+  }
+
+  /* buffers L2CAP did not take are still ours */
+  for (uint16_t i = num_handed; i < num_notifs; i++) osi_free(msgs[i]);
+
+  /* on failure, the last buffer handed over was dropped by L2CAP */
+  *p_num_sent = num_handed;
+  if (l2cap_ret == L2CAP_DW_FAILED && num_handed > 0) (*p_num_sent)--;
+
+  if (l2cap_ret == L2CAP_DW_FAILED) {
+    LOG(ERROR) << __func__ << ": failed to write data to L2CAP";
+    return GATT_INTERNAL_ERROR;
+  } else if (l2cap_ret == L2CAP_DW_CONGESTED) {
+    VLOG(1) << StringPrintf("ATT congested, %d of %d notifications accepted",
+                            *p_num_sent, num_notifs);
+    return GATT_CONGESTED;
+  }
+  return GATT_SUCCESS;
+}
+
+/*******************************************************************************
+ *
+ * Function         attp_build_multi_notification
+ *
+ * Description      This function builds a Multiple Handle Value Notification
+ *                  carrying the values of |p_notifs|, in order.
+ *
+ * Parameter        tcb: connection control block.
+ *                  p_notifs: notifications to carry, all for |tcb|.
+ *                  num_notifs: number of notifications.
+ *
+ * Returns          the PDU, or NULL if the values do not fit in the MTU.
+ *
+ ******************************************************************************/
+BT_HDR* attp_build_multi_notification(tGATT_TCB& tcb,
+                                      const tGATT_NOTIFICATION* p_notifs,
+                                      uint16_t num_notifs) {
+  /* opcode, then a handle, length and value tuple per attribute */
+  uint32_t len = 1;
+  for (uint16_t i = 0; i < num_notifs; i++) {
+    len += 4 + p_notifs[i].len;
+    if (len > tcb.payload_size) {
+      LOG(ERROR) << StringPrintf(
+          "%s: %d values need more than the MTU of %d", __func__, num_notifs,
+          tcb.payload_size);
+      return NULL;
+    }
+  }
+
+  BT_HDR* p_buf = (BT_HDR*)osi_malloc(sizeof(BT_HDR) + L2CAP_MIN_OFFSET + len);
+  uint8_t* p = (uint8_t*)(p_buf + 1) + L2CAP_MIN_OFFSET;
+  UINT8_TO_STREAM(p, GATT_HANDLE_MULTI_VALUE_NOTIF);
+  for (uint16_t i = 0; i < num_notifs; i++) {
+    UINT16_TO_STREAM(p, p_notifs[i].handle);
+    UINT16_TO_STREAM(p, p_notifs[i].len);
+    ARRAY_TO_STREAM(p, p_notifs[i].p_value, p_notifs[i].len);
+  }
+  p_buf->offset = L2CAP_MIN_OFFSET;
+  p_buf->len = len;
+  return p_buf;
+}
+
 /*******************************************************************************
  *
  * Function         attp_cl_send_cmd
@@ -417,12 +532,16 @@ tGATT_STATUS attp_cl_send_cmd(tGATT_TCB& tcb, tGATT_CLCB* p_clcb,
                               uint8_t cmd_code, BT_HDR* p_cmd) {
   cmd_code &= ~GATT_AUTH_SIGN_MASK;
 
-  if (!tcb.cl_cmd_q.empty() && cmd_code != GATT_HANDLE_VALUE_CONF) {
+  /* Commands and confirmations expect no response, so they never wait behind
+   * an outstanding request. GATT allows one operation per connection at a
+   * time, so only requests of other clients are overtaken. */
+  if (!tcb.cl_cmd_q.empty() && cmd_code != GATT_HANDLE_VALUE_CONF &&
+      cmd_code != GATT_CMD_WRITE) {
     gatt_cmd_enq(tcb, p_clcb, true, cmd_code, p_cmd);
     return GATT_CMD_STARTED;
   }
 
-  /* no pending request or value confirmation */
+  /* no pending request, command or value confirmation */
   tGATT_STATUS att_ret = attp_send_msg_to_l2cap(tcb, p_cmd);
   if (att_ret != GATT_CONGESTED && att_ret != GATT_SUCCESS) {
     return GATT_INTERNAL_ERROR;
@@ -518,7 +637,8 @@ tGATT_STATUS attp_send_cl_msg(tGATT_TCB& tcb, tGATT_CLCB* p_clcb,
       break;
 
     case GATT_REQ_READ_MULTI:
-      p_cmd = attp_build_read_multi_cmd(tcb.payload_size,
+    case GATT_REQ_READ_MULTI_VAR:
+      p_cmd = attp_build_read_multi_cmd(op_code, tcb.payload_size,
                                         p_msg->read_multi.num_handles,
                                         p_msg->read_multi.handles);
       break;
@@ -22,16 +22,28 @@
 #include <base/callback.h>
 #include <base/location.h>
 #include <base/logging.h>
+#include <inttypes.h>
+#include <algorithm>
 #include <map>
 #include <memory>
 #include <set>
+#include <vector>
 
+#include "common/time_util.h"
 #include "internal_include/bt_trace.h"
 #include "osi/include/alarm.h"
 #include "stack/btm/btm_ble_bgconn.h"
 
 #define DIRECT_CONNECT_TIMEOUT (30 * 1000) /* 30 seconds */
 
+/* How long a background connection candidate keeps its white list slot
+ * without connecting, while others wait for one */
+#define BG_CONN_ROTATION_PERIOD (10 * 1000) /* 10 seconds */
+
+/* How long the background connection scan duty cycle stays raised after a
+ * device with a background connection disconnects */
+#define BG_CONN_RECONNECT_WINDOW (30 * 1000) /* 30 seconds */
+
 struct closure_data {
   base::OnceClosure user_task;
   base::Location posted_from;
@@ -58,24 +70,220 @@ using unique_alarm_ptr = std::unique_ptr<alarm_t, decltype(&alarm_free)>;
 
 namespace connection_manager {
 
+bool any_direct_connect_left();
+
 struct tAPPS_CONNECTING {
   // ids of clients doing background connection to given device
   std::set<tAPP_ID> doing_bg_conn;
 
   // Apps trying to do direct connection.
   std::map<tAPP_ID, unique_alarm_ptr> doing_direct_conn;
+
+  // Whether the device was given one of the white list slots
+  bool in_white_list = false;
+  // Time the device got its white list slot
+  uint64_t in_white_list_since_ms = 0;
+
+  bool connected = false;
+  // Time since when a connection to the device is wanted, 0 while connected
+  uint64_t waiting_since_ms = 0;
+  // Time the first direct connection attempt started, 0 if there is none
+  uint64_t direct_since_ms = 0;
+
+  // Place in the queue of the background connection candidates, the lowest
+  // comes first among the devices of equal priority
+  int64_t turn = 0;
+};
+
+struct tLATENCY_STATS {
+  uint64_t count = 0;
+  uint64_t total_ms = 0;
+  uint64_t max_ms = 0;
+
+  void Record(uint64_t latency_ms) {
+    count++;
+    total_ms += latency_ms;
+    max_ms = std::max(max_ms, latency_ms);
+  }
+};
+
+struct tBG_CONN_STATS {
+  // From adding or losing the connection to connecting
+  tLATENCY_STATS background;
+  // From the first direct connection attempt to connecting
+  tLATENCY_STATS direct;
+  uint64_t white_list_adds = 0;
+  uint64_t white_list_removes = 0;
+  uint64_t rotations = 0;
 };
 
 namespace {
 // Maps address to apps trying to connect to it
 std::map<RawAddress, tAPPS_CONNECTING> bgconn_dev;
 
+// Priority of the background connections of each app, 0 by default
+std::map<tAPP_ID, uint8_t> app_priority;
+
+// Next turn at the back, and at the front, of the candidates queue
+int64_t back_turn = 0;
+int64_t front_turn = 0;
+
+// Timer rotating the white list slots, and lowering the duty cycle at the end
+// of the reconnect window
+unique_alarm_ptr bg_conn_timer(nullptr, &alarm_free);
+bool bg_conn_timer_scheduled = false;
+uint64_t bg_conn_timer_scheduled_ms = 0;
+
+// End of the reconnect window, 0 if there is none
+uint64_t reconnect_window_end_ms = 0;
+
+tBG_CONN_STATS bg_conn_stats;
+
 bool anyone_connecting(
     const std::map<RawAddress, tAPPS_CONNECTING>::iterator it) {
   return (!it->second.doing_bg_conn.empty() ||
           !it->second.doing_direct_conn.empty());
 }
 
+uint8_t device_priority(const tAPPS_CONNECTING& dev) {
+  uint8_t priority = 0;
+  for (tAPP_ID app_id : dev.doing_bg_conn) {
+    auto it = app_priority.find(app_id);
+    if (it != app_priority.end()) priority = std::max(priority, it->second);
+  }
+  return priority;
+}
+
+/* Order of the devices for the white list slots: direct connections first,
+ * then background connections to disconnected devices, by priority and by
+ * turn */
+bool ranks_before(const std::pair<const RawAddress, tAPPS_CONNECTING>* a,
+                  const std::pair<const RawAddress, tAPPS_CONNECTING>* b) {
+  bool a_direct = !a->second.doing_direct_conn.empty();
+  bool b_direct = !b->second.doing_direct_conn.empty();
+  if (a_direct != b_direct) return a_direct;
+
+  if (a->second.connected != b->second.connected) return !a->second.connected;
+
+  uint8_t a_priority = device_priority(a->second);
+  uint8_t b_priority = device_priority(b->second);
+  if (a_priority != b_priority) return a_priority > b_priority;
+
+  return a->second.turn < b->second.turn;
+}
+
+void on_bg_conn_timer();
+
+void schedule_bg_conn_timer() {
+  if (bg_conn_timer_scheduled) return;
+
+  if (!bg_conn_timer) bg_conn_timer.reset(alarm_new("bg_conn_rotation"));
+  bg_conn_timer_scheduled = true;
+  bg_conn_timer_scheduled_ms = bluetooth::common::time_get_os_boottime_ms();
+  alarm_set_closure(FROM_HERE, bg_conn_timer.get(), BG_CONN_ROTATION_PERIOD,
+                    base::BindOnce(&on_bg_conn_timer));
+}
+
+/* Gives the white list slots to the best ranked devices. Devices are removed
+ * first, to make room for the added ones. Returns true if all devices fit in
+ * the white list. */
+bool update_white_list() {
+  std::vector<std::pair<const RawAddress, tAPPS_CONNECTING>*> ranked;
+  ranked.reserve(bgconn_dev.size());
+  for (auto& entry : bgconn_dev) ranked.push_back(&entry);
+  std::stable_sort(ranked.begin(), ranked.end(), ranks_before);
+
+  // Size 0 means the controller did not tell, let it refuse additions instead
+  size_t slots = BTM_GetWhiteListSize();
+  if (slots == 0 || slots > ranked.size()) slots = ranked.size();
+
+  for (size_t i = slots; i < ranked.size(); i++) {
+    tAPPS_CONNECTING& dev = ranked[i]->second;
+    if (!dev.in_white_list) continue;
+    BTM_WhiteListRemove(ranked[i]->first);
+    bg_conn_stats.white_list_removes++;
+    dev.in_white_list = false;
+  }
+
+  uint64_t now_ms = bluetooth::common::time_get_os_boottime_ms();
+  for (size_t i = 0; i < slots; i++) {
+    tAPPS_CONNECTING& dev = ranked[i]->second;
+    if (dev.in_white_list) continue;
+    if (!BTM_WhiteListAdd(ranked[i]->first)) {
+      slots = i;
+      break;
+    }
+    bg_conn_stats.white_list_adds++;
+    dev.in_white_list = true;
+    dev.in_white_list_since_ms = now_ms;
+  }
+
+  bool all_fit = slots == ranked.size();
+  if (!all_fit || reconnect_window_end_ms != 0) schedule_bg_conn_timer();
+  return all_fit;
+}
+
+/** Moves the devices that kept their white list slot for the whole rotation
+ * period without connecting to the back of the queue, so that devices
+ * waiting for a slot get one in turn. */
+void rotate_white_list() {
+  for (auto& entry : bgconn_dev) {
+    tAPPS_CONNECTING& dev = entry.second;
+    if (!dev.in_white_list || dev.connected ||
+        !dev.doing_direct_conn.empty() ||
+        dev.in_white_list_since_ms > bg_conn_timer_scheduled_ms)
+      continue;
+    dev.turn = back_turn++;
+  }
+  bg_conn_stats.rotations++;
+}
+
+/* Scan parameters for connecting once there are no direct connections left */
+void set_background_connection_mode() {
+  if (reconnect_window_end_ms != 0)
+    BTM_SetLeConnectionModeToMedium();
+  else
+    BTM_SetLeConnectionModeToSlow();
+}
+
+void on_bg_conn_timer() {
+  bg_conn_timer_scheduled = false;
+  uint64_t now_ms = bluetooth::common::time_get_os_boottime_ms();
+
+  if (reconnect_window_end_ms != 0 && now_ms >= reconnect_window_end_ms) {
+    reconnect_window_end_ms = 0;
+    if (!any_direct_connect_left()) BTM_SetLeConnectionModeToSlow();
+  }
+
+  bool waiting = std::any_of(
+      bgconn_dev.begin(), bgconn_dev.end(),
+      [](const auto& entry) { return !entry.second.in_white_list; });
+  if (waiting) rotate_white_list();
+
+  update_white_list();
+}
+
+/** Erases the device record, freeing its white list slot, and gives the slot
+ * to the next device waiting for one */
+void erase_device(std::map<RawAddress, tAPPS_CONNECTING>::iterator it) {
+  if (it->second.in_white_list) {
+    BTM_WhiteListRemove(it->first);
+    bg_conn_stats.white_list_removes++;
+  }
+  bgconn_dev.erase(it);
+}
+
+/** Creates the record of a device a connection is now wanted to */
+tAPPS_CONNECTING& find_or_add_device(const RawAddress& address) {
+  auto it = bgconn_dev.find(address);
+  if (it != bgconn_dev.end()) return it->second;
+
+  tAPPS_CONNECTING& dev = bgconn_dev[address];
+  dev.waiting_since_ms = bluetooth::common::time_get_os_boottime_ms();
+  dev.turn = back_turn++;
+  return dev;
+}
+
 }  // namespace
 
 /** background connection device from the list. Returns pointer to the device
@@ -87,31 +295,19 @@ std::set<tAPP_ID> get_apps_connecting_to(const RawAddress& address) {
 }
 
 /** Add a device from the background connection list.  Returns true if device
- * added to the list, or already in list, false otherwise */
+ * added to the list, or already in list, false otherwise. The device might
+ * have to wait for a white list slot, see update_white_list(). */
 bool background_connect_add(uint8_t app_id, const RawAddress& address) {
   auto it = bgconn_dev.find(address);
-  bool in_white_list = false;
-  if (it != bgconn_dev.end()) {
-    // device already in the whitelist, just add interested app to the list
-    if (it->second.doing_bg_conn.count(app_id)) {
-      LOG(INFO) << "App id=" << loghex(app_id)
-                << "already doing background connection to " << address;
-      return true;
-    }
-
-    // Already in white list ?
-    if (anyone_connecting(it)) {
-      in_white_list = true;
-    }
-  }
-
-  if (!in_white_list) {
-    // the device is not in the whitelist
-    if (!BTM_WhiteListAdd(address)) return false;
+  if (it != bgconn_dev.end() && it->second.doing_bg_conn.count(app_id)) {
+    LOG(INFO) << "App id=" << loghex(app_id)
+              << "already doing background connection to " << address;
+    return true;
   }
 
   // create endtry for address, and insert app_id.
-  bgconn_dev[address].doing_bg_conn.insert(app_id);
+  find_or_add_device(address).doing_bg_conn.insert(app_id);
+  update_white_list();
   return true;
 }
 
@@ -121,8 +317,8 @@ bool remove_unconditional(const RawAddress& address) {
   auto it = bgconn_dev.find(address);
   if (it == bgconn_dev.end()) return false;
 
-  BTM_WhiteListRemove(address);
-  bgconn_dev.erase(it);
+  erase_device(it);
+  update_white_list();
   return true;
 }
 
@@ -139,13 +335,25 @@ bool background_connect_remove(uint8_t app_id, const RawAddress& address) {
   if (anyone_connecting(it)) return true;
 
   // no more apps interested - remove from whitelist and delete record
-  BTM_WhiteListRemove(address);
-  bgconn_dev.erase(it);
+  erase_device(it);
+  update_white_list();
   return true;
 }
 
+/** Sets the priority of the background connections of |app_id|. Devices with
+ * a higher priority get the white list slots first. */
+void set_app_priority(tAPP_ID app_id, uint8_t priority) {
+  if (priority == 0)
+    app_priority.erase(app_id);
+  else
+    app_priority[app_id] = priority;
+  update_white_list();
+}
+
 /** deregister all related background connetion device. */
 void on_app_deregistered(uint8_t app_id) {
+  app_priority.erase(app_id);
+
   auto it = bgconn_dev.begin();
   auto end = bgconn_dev.end();
   /* update the BG conn device list */
@@ -159,26 +367,73 @@ void on_app_deregistered(uint8_t app_id) {
       continue;
     }
 
-    BTM_WhiteListRemove(it->first);
+    if (it->second.in_white_list) {
+      BTM_WhiteListRemove(it->first);
+      bg_conn_stats.white_list_removes++;
+    }
     it = bgconn_dev.erase(it);
   }
+  update_white_list();
 }
 
 void on_connection_complete(const RawAddress& address) {
   VLOG(2) << __func__;
   auto it = bgconn_dev.find(address);
+  if (it == bgconn_dev.end()) return;
+
+  tAPPS_CONNECTING& dev = it->second;
+  uint64_t now_ms = bluetooth::common::time_get_os_boottime_ms();
+  if (dev.direct_since_ms != 0) {
+    bg_conn_stats.direct.Record(now_ms - dev.direct_since_ms);
+    dev.direct_since_ms = 0;
+  } else if (dev.waiting_since_ms != 0 && !dev.doing_bg_conn.empty()) {
+    bg_conn_stats.background.Record(now_ms - dev.waiting_since_ms);
+  }
+  dev.connected = true;
+  dev.waiting_since_ms = 0;
 
   while (it != bgconn_dev.end() && !it->second.doing_direct_conn.empty()) {
     uint8_t app_id = it->second.doing_direct_conn.begin()->first;
     direct_connect_remove(app_id, address);
     it = bgconn_dev.find(address);
   }
+
+  // a connected device gives its slot to the ones waiting for one
+  update_white_list();
+}
+
+/** Called when the LE link to |address| goes down. A device with background
+ * connections is put first in the queue for the white list slots, and the
+ * scan duty cycle is raised for a while, as it is likely to come back soon. */
+void on_disconnection(const RawAddress& address) {
+  auto it = bgconn_dev.find(address);
+  if (it == bgconn_dev.end()) return;
+
+  tAPPS_CONNECTING& dev = it->second;
+  if (!dev.connected) return;
+
+  dev.connected = false;
+  dev.waiting_since_ms = bluetooth::common::time_get_os_boottime_ms();
+  dev.turn = --front_turn;
+
+  if (!dev.doing_bg_conn.empty()) {
+    reconnect_window_end_ms = dev.waiting_since_ms + BG_CONN_RECONNECT_WINDOW;
+    if (!any_direct_connect_left()) BTM_SetLeConnectionModeToMedium();
+  }
+  update_white_list();
 }
 
 /** Reset bg device list. If called after controller reset, set |after_reset| to
  * true, as there is no need to wipe controller white list in this case. */
 void reset(bool after_reset) {
   bgconn_dev.clear();
+  app_priority.clear();
+  bg_conn_timer.reset();
+  bg_conn_timer_scheduled = false;
+  reconnect_window_end_ms = 0;
+  back_turn = 0;
+  front_turn = 0;
+  bg_conn_stats = {};
   if (!after_reset) BTM_WhiteListClear();
 }
 
@@ -194,7 +449,6 @@ void wl_direct_connect_timeout_cb(uint8_t app_id, const RawAddress& address) {
  * added to the list, false otherwise */
 bool direct_connect_add(uint8_t app_id, const RawAddress& address) {
   auto it = bgconn_dev.find(address);
-  bool in_white_list = false;
 
   if (it != bgconn_dev.end()) {
     // app already trying to connect to this particular device
@@ -203,31 +457,36 @@ bool direct_connect_add(uint8_t app_id, const RawAddress& address) {
                 << " already in progress";
       return false;
     }
-
-    // are we already in the white list ?
-    if (anyone_connecting(it)) {
-      in_white_list = true;
-    }
   }
 
   bool params_changed = BTM_SetLeConnectionModeToFast();
 
-  if (!in_white_list) {
-    if (!BTM_WhiteListAdd(address)) {
-      // if we can't add to white list, turn parameters back to slow.
-      if (params_changed) BTM_SetLeConnectionModeToSlow();
-      return false;
-    }
+  tAPPS_CONNECTING& dev = find_or_add_device(address);
+  dev.doing_direct_conn.emplace(app_id, unique_alarm_ptr(nullptr, &alarm_free));
+
+  // direct connections come first, but there might be more of them than
+  // white list slots
+  if (!dev.in_white_list) update_white_list();
+  if (!dev.in_white_list) {
+    dev.doing_direct_conn.erase(app_id);
+    auto dev_it = bgconn_dev.find(address);
+    if (!anyone_connecting(dev_it)) bgconn_dev.erase(dev_it);
+
+    // if we can't add to white list, turn parameters back to slow.
+    if (params_changed) BTM_SetLeConnectionModeToSlow();
+    return false;
   }
 
+  if (dev.direct_since_ms == 0)
+    dev.direct_since_ms = bluetooth::common::time_get_os_boottime_ms();
+
   // Setup a timer
   alarm_t* timeout = alarm_new("wl_conn_params_30s");
   alarm_set_closure(
       FROM_HERE, timeout, DIRECT_CONNECT_TIMEOUT,
       base::BindOnce(&wl_direct_connect_timeout_cb, app_id, address));
 
-  bgconn_dev[address].doing_direct_conn.emplace(
-      app_id, unique_alarm_ptr(timeout, &alarm_free));
+  dev.doing_direct_conn.find(app_id)->second.reset(timeout);
   return true;
 }
 
@@ -250,22 +509,49 @@ bool direct_connect_remove(uint8_t app_id, const RawAddress& address) {
   // this will free the alarm
   it->second.doing_direct_conn.erase(app_it);
 
+  if (it->second.doing_direct_conn.empty()) it->second.direct_since_ms = 0;
+
   // if we removed last direct connection, lower the scan parameters used for
   // connecting
   if (!any_direct_connect_left()) {
-    BTM_SetLeConnectionModeToSlow();
+    set_background_connection_mode();
   }
 
-  if (anyone_connecting(it)) return true;
+  if (anyone_connecting(it)) {
+    update_white_list();
+    return true;
+  }
 
   // no more apps interested - remove from whitelist
-  BTM_WhiteListRemove(address);
-  bgconn_dev.erase(it);
+  erase_device(it);
+  update_white_list();
   return true;
 }
 
+void dump_latency(int fd, const char* name, const tLATENCY_STATS& stats) {
+  dprintf(fd,
+          "\t%s connections: %" PRIu64 ", average latency: %" PRIu64
+          " ms, max latency: %" PRIu64 " ms\n",
+          name, stats.count, stats.count ? stats.total_ms / stats.count : 0,
+          stats.max_ms);
+}
+
 void dump(int fd) {
   dprintf(fd, "\nconnection_manager state:\n");
+  dump_latency(fd, "background", bg_conn_stats.background);
+  dump_latency(fd, "direct", bg_conn_stats.direct);
+  dprintf(fd,
+          "\twhite list adds: %" PRIu64 ", removes: %" PRIu64
+          ", rotations: %" PRIu64 "\n",
+          bg_conn_stats.white_list_adds, bg_conn_stats.white_list_removes,
+          bg_conn_stats.rotations);
+  if (reconnect_window_end_ms != 0) {
+    dprintf(fd, "\treconnect window ends in %" PRIu64 " ms\n",
+            reconnect_window_end_ms -
+                std::min(reconnect_window_end_ms,
+                         bluetooth::common::time_get_os_boottime_ms()));
+  }
+
   if (bgconn_dev.empty()) {
     dprintf(fd, "\tno Low Energy connection attempts\n");
     return;
@@ -273,7 +559,9 @@ void dump(int fd) {
 
   dprintf(fd, "\tdevices attempting connection: %d", (int)bgconn_dev.size());
   for (const auto& entry : bgconn_dev) {
-    dprintf(fd, "\n\t * %s: ", entry.first.ToString().c_str());
+    dprintf(fd, "\n\t * %s: %s%s", entry.first.ToString().c_str(),
+            entry.second.in_white_list ? "in white list" : "waiting for slot",
+            entry.second.connected ? ", connected" : "");
 
     if (!entry.second.doing_direct_conn.empty()) {
       dprintf(fd, "\n\t\tapps doing direct connect: ");
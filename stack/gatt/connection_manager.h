@@ -46,6 +46,11 @@ extern void reset(bool after_reset);
 
 extern void on_app_deregistered(tAPP_ID app_id);
 extern void on_connection_complete(const RawAddress& address);
+extern void on_disconnection(const RawAddress& address);
+
+/* Devices with background connections from apps of higher priority are given
+ * the controller white list slots first, 0 is the default priority */
+extern void set_app_priority(tAPP_ID app_id, uint8_t priority);
 
 extern std::set<tAPP_ID> get_apps_connecting_to(const RawAddress& remote_bda);
 
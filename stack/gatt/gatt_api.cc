@@ -132,6 +132,8 @@ static void gatt_update_last_srv_info() {
   for (tGATT_SRV_LIST_ELEM& el : *gatt_cb.srv_list_info) {
     gatt_cb.last_service_handle = el.s_hdl;
   }
+
+  gatt_sr_update_handle_index();
 }
 
 /*******************************************************************************
@@ -502,6 +504,122 @@ tGATT_STATUS GATTS_HandleValueNotification(uint16_t conn_id,
   return cmd_sent;
 }
 
+/*******************************************************************************
+ *
+ * Function         GATTS_HandleValueNotifications
+ *
+ * Description      This function sends handle value notifications to one or
+ *                  more clients. Consecutive notifications for the same link
+ *                  are handed to L2CAP together.
+ *
+ * Parameter        p_notifs: notifications to send.
+ *                  num_notifs: number of notifications.
+ *                  p_num_sent: set to the number of notifications sent.
+ *
+ * Returns          GATT_SUCCESS if all notifications were sent, GATT_CONGESTED
+ *                  if a link is congested; otherwise error code.
+ *
+ ******************************************************************************/
+tGATT_STATUS GATTS_HandleValueNotifications(const tGATT_NOTIFICATION* p_notifs,
+                                            uint16_t num_notifs,
+                                            uint16_t* p_num_sent) {
+  VLOG(1) << __func__ << ": num_notifs=" << num_notifs;
+
+  *p_num_sent = 0;
+  bool congested = false;
+  while (*p_num_sent < num_notifs) {
+    const tGATT_NOTIFICATION* p_first = &p_notifs[*p_num_sent];
+    uint8_t tcb_idx = GATT_GET_TCB_IDX(p_first->conn_id);
+    tGATT_TCB* p_tcb = gatt_get_tcb_by_idx(tcb_idx);
+
+    /* take the notifications for this link, up to the first invalid one */
+    uint16_t count = 0;
+    tGATT_STATUS status = GATT_SUCCESS;
+    for (; *p_num_sent + count < num_notifs; count++) {
+      const tGATT_NOTIFICATION& notif = p_first[count];
+      if (GATT_GET_TCB_IDX(notif.conn_id) != tcb_idx) break;
+
+      if (gatt_get_regcb(GATT_GET_GATT_IF(notif.conn_id)) == NULL ||
+          p_tcb == NULL) {
+        LOG(ERROR) << __func__ << "Unknown  conn_id: " << notif.conn_id;
+        status = GATT_INVALID_CONN_ID;
+        break;
+      }
+      if (!GATT_HANDLE_IS_VALID(notif.handle)) {
+        status = GATT_ILLEGAL_PARAMETER;
+        break;
+      }
+    }
+
+    if (count > 0) {
+      /* notifications are sent in order: later ones, even for other links,
+       * wait until this link is no longer congested */
+      if (p_tcb->is_congested) return GATT_CONGESTED;
+
+      uint16_t sent;
+      tGATT_STATUS send_status =
+          attp_send_sr_notifications(*p_tcb, p_first, count, &sent);
+      *p_num_sent += sent;
+      if (send_status == GATT_CONGESTED) {
+        if (sent < count) return GATT_CONGESTED;
+        congested = true;
+      } else if (send_status != GATT_SUCCESS) {
+        return send_status;
+      }
+    }
+
+    if (status != GATT_SUCCESS) return status;
+  }
+
+  return congested ? GATT_CONGESTED : GATT_SUCCESS;
+}
+
+/*******************************************************************************
+ *
+ * Function         GATTS_HandleMultipleValueNotification
+ *
+ * Description      This function sends the values of several attributes to a
+ *                  client in one Multiple Handle Value Notification PDU.
+ *
+ * Parameter        p_notifs: notifications to send, all for the same
+ *                            connection.
+ *                  num_notifs: number of notifications, at least two.
+ *
+ * Returns          GATT_SUCCESS if sucessfully sent; otherwise error code.
+ *
+ ******************************************************************************/
+tGATT_STATUS GATTS_HandleMultipleValueNotification(
+    const tGATT_NOTIFICATION* p_notifs, uint16_t num_notifs) {
+  VLOG(1) << __func__ << ": num_notifs=" << num_notifs;
+
+  if (num_notifs < 2) return GATT_ILLEGAL_PARAMETER;
+
+  uint16_t conn_id = p_notifs[0].conn_id;
+  tGATT_REG* p_reg = gatt_get_regcb(GATT_GET_GATT_IF(conn_id));
+  tGATT_TCB* p_tcb = gatt_get_tcb_by_idx(GATT_GET_TCB_IDX(conn_id));
+  if ((p_reg == NULL) || (p_tcb == NULL)) {
+    LOG(ERROR) << __func__ << "Unknown  conn_id: " << conn_id;
+    return (tGATT_STATUS)GATT_INVALID_CONN_ID;
+  }
+
+  for (uint16_t i = 0; i < num_notifs; i++) {
+    if (p_notifs[i].conn_id != conn_id ||
+        !GATT_HANDLE_IS_VALID(p_notifs[i].handle)) {
+      return GATT_ILLEGAL_PARAMETER;
+    }
+  }
+
+  if (!(p_tcb->cl_sup_feat & GATT_CL_SUP_FEAT_MULTI_NOTIF)) {
+    VLOG(1) << __func__ << ": not supported by the client";
+    return GATT_REQ_NOT_SUPPORTED;
+  }
+
+  BT_HDR* p_buf = attp_build_multi_notification(*p_tcb, p_notifs, num_notifs);
+  if (p_buf == NULL) return GATT_NO_RESOURCES;
+
+  return attp_send_sr_msg(*p_tcb, p_buf);
+}
+
 /*******************************************************************************
  *
  * Function         GATTS_SendRsp
@@ -544,6 +662,94 @@ tGATT_STATUS GATTS_SendRsp(uint16_t conn_id, uint32_t trans_id,
   return cmd_sent;
 }
 
+/** Finds the characteristic value or descriptor |attr_handle| of a service
+ * of |gatt_if| whose value can be cached. */
+static tGATT_ATTR* gatts_find_cacheable_attr(tGATT_IF gatt_if,
+                                             uint16_t attr_handle) {
+  auto it = gatt_sr_find_i_rcb_by_handle(attr_handle);
+  if (it == gatt_cb.srv_list_info->end() || it->gatt_if != gatt_if)
+    return nullptr;
+
+  tGATT_ATTR* p_attr = find_attr_by_handle(it->p_db, attr_handle);
+  if (!p_attr) return nullptr;
+
+  if (p_attr->gatt_type != BTGATT_DB_CHARACTERISTIC &&
+      p_attr->gatt_type != BTGATT_DB_DESCRIPTOR)
+    return nullptr;
+
+  /* the client configuration is per client, the stack can't share it */
+  if (p_attr->uuid == Uuid::From16Bit(GATT_UUID_CHAR_CLIENT_CONFIG))
+    return nullptr;
+
+  return p_attr;
+}
+
+/*******************************************************************************
+ *
+ * Function         GATTS_SetCachedValue
+ *
+ * Description      This function sets the value of a characteristic or
+ *                  descriptor for the stack to answer its reads.
+ *
+ * Returns          GATT_SUCCESS if cached; otherwise error code.
+ *
+ ******************************************************************************/
+tGATT_STATUS GATTS_SetCachedValue(tGATT_IF gatt_if, uint16_t attr_handle,
+                                  const uint8_t* p_value, uint16_t len) {
+  if (len > GATT_MAX_ATTR_LEN || (len != 0 && p_value == nullptr))
+    return GATT_ILLEGAL_PARAMETER;
+
+  tGATT_ATTR* p_attr = gatts_find_cacheable_attr(gatt_if, attr_handle);
+  if (!p_attr) {
+    LOG(ERROR) << __func__ << ": attribute " << loghex(attr_handle)
+               << " of gatt_if=" << +gatt_if << " can't be cached";
+    return GATT_INVALID_HANDLE;
+  }
+
+  if (!p_attr->p_cache) p_attr->p_cache.reset(new tGATT_ATTR_CACHE());
+  p_attr->p_cache->value.assign(p_value, p_value + len);
+  p_attr->p_cache->valid = true;
+  return GATT_SUCCESS;
+}
+
+/*******************************************************************************
+ *
+ * Function         GATTS_InvalidateCachedValue
+ *
+ * Description      This function drops the value cached for an attribute.
+ *
+ * Returns          GATT_SUCCESS if successful; otherwise error code.
+ *
+ ******************************************************************************/
+tGATT_STATUS GATTS_InvalidateCachedValue(tGATT_IF gatt_if,
+                                         uint16_t attr_handle) {
+  if (!gatts_find_cacheable_attr(gatt_if, attr_handle))
+    return GATT_INVALID_HANDLE;
+
+  gatts_invalidate_cached_value(
+      gatt_sr_find_i_rcb_by_handle(attr_handle)->p_db, attr_handle);
+  return GATT_SUCCESS;
+}
+
+/*******************************************************************************
+ *
+ * Function         GATTS_GetCachedValueHits
+ *
+ * Description      This function gets how many reads of an attribute were
+ *                  answered from its cached value.
+ *
+ * Returns          GATT_SUCCESS if successful; otherwise error code.
+ *
+ ******************************************************************************/
+tGATT_STATUS GATTS_GetCachedValueHits(tGATT_IF gatt_if, uint16_t attr_handle,
+                                      uint32_t* p_hits) {
+  tGATT_ATTR* p_attr = gatts_find_cacheable_attr(gatt_if, attr_handle);
+  if (!p_attr) return GATT_INVALID_HANDLE;
+
+  *p_hits = p_attr->p_cache ? p_attr->p_cache->hit_count : 0;
+  return GATT_SUCCESS;
+}
+
 /******************************************************************************/
 /* GATT Profile Srvr Functions */
 /******************************************************************************/
@@ -717,7 +923,8 @@ tGATT_STATUS GATTC_Read(uint16_t conn_id, tGATT_READ_TYPE type,
       p_clcb->e_handle = p_read->service.e_handle;
       p_clcb->uuid = p_read->service.uuid;
       break;
-    case GATT_READ_MULTIPLE: {
+    case GATT_READ_MULTIPLE:
+    case GATT_READ_MULTIPLE_VAR_LEN: {
       p_clcb->s_handle = 0;
       /* copy multiple handles in CB */
       tGATT_READ_MULTI* p_read_multi =
@@ -182,6 +182,59 @@ void gatt_profile_clcb_dealloc(tGATT_PROFILE_CLCB* p_clcb) {
   memset(p_clcb, 0, sizeof(tGATT_PROFILE_CLCB));
 }
 
+/*******************************************************************************
+ *
+ * Function         gatt_cl_sup_feat_read
+ *
+ * Description      Read the Client Supported Features of the peer.
+ *
+ * Returns          GATT status of the read.
+ *
+ ******************************************************************************/
+static tGATT_STATUS gatt_cl_sup_feat_read(uint16_t conn_id,
+                                          tGATT_READ_REQ* p_req,
+                                          tGATTS_RSP* p_rsp) {
+  tGATT_TCB* p_tcb = gatt_get_tcb_by_idx(GATT_GET_TCB_IDX(conn_id));
+  if (p_tcb == NULL) return GATT_ERROR;
+
+  if (p_req->offset > 1) return GATT_INVALID_OFFSET;
+
+  p_rsp->attr_value.handle = p_req->handle;
+  p_rsp->attr_value.offset = p_req->offset;
+  p_rsp->attr_value.len = 1 - p_req->offset;
+  p_rsp->attr_value.value[0] = p_tcb->cl_sup_feat;
+  return GATT_SUCCESS;
+}
+
+/*******************************************************************************
+ *
+ * Function         gatt_cl_sup_feat_write
+ *
+ * Description      Write the Client Supported Features of the peer. Only the
+ *                  features this server supports are kept, and a feature the
+ *                  client enabled can't be disabled.
+ *
+ * Returns          GATT status of the write.
+ *
+ ******************************************************************************/
+static tGATT_STATUS gatt_cl_sup_feat_write(uint16_t conn_id,
+                                           tGATT_WRITE_REQ* p_req) {
+  tGATT_TCB* p_tcb = gatt_get_tcb_by_idx(GATT_GET_TCB_IDX(conn_id));
+  if (p_tcb == NULL) return GATT_ERROR;
+
+  if (p_req->is_prep) return GATT_REQ_NOT_SUPPORTED;
+  if (p_req->offset != 0) return GATT_INVALID_OFFSET;
+  if (p_req->len == 0) return GATT_INVALID_ATTR_LEN;
+
+  uint8_t cl_sup_feat = p_req->value[0] & GATT_CL_SUP_FEAT_MULTI_NOTIF;
+  if (p_tcb->cl_sup_feat & ~cl_sup_feat) return GATT_VALUE_NOT_ALLOWED;
+
+  VLOG(1) << __func__ << ": " << p_tcb->peer_bda
+          << " cl_sup_feat=" << loghex(cl_sup_feat);
+  p_tcb->cl_sup_feat = cl_sup_feat;
+  return GATT_SUCCESS;
+}
+
 /*******************************************************************************
  *
  * Function         gatt_request_cback
@@ -201,11 +254,26 @@ static void gatt_request_cback(uint16_t conn_id, uint32_t trans_id,
 
   switch (type) {
     case GATTS_REQ_TYPE_READ_CHARACTERISTIC:
+      if (p_data->read_req.handle == gatt_cb.handle_cl_sup_feat) {
+        status = gatt_cl_sup_feat_read(conn_id, &p_data->read_req, &rsp_msg);
+        break;
+      }
+      status = GATT_READ_NOT_PERMIT;
+      break;
+
     case GATTS_REQ_TYPE_READ_DESCRIPTOR:
       status = GATT_READ_NOT_PERMIT;
       break;
 
     case GATTS_REQ_TYPE_WRITE_CHARACTERISTIC:
+      if (p_data->write_req.handle == gatt_cb.handle_cl_sup_feat) {
+        status = gatt_cl_sup_feat_write(conn_id, &p_data->write_req);
+        ignore = !p_data->write_req.need_rsp;
+        break;
+      }
+      status = GATT_WRITE_NOT_PERMIT;
+      break;
+
     case GATTS_REQ_TYPE_WRITE_DESCRIPTOR:
       status = GATT_WRITE_NOT_PERMIT;
       break;
@@ -283,6 +351,7 @@ void gatt_profile_db_init(void) {
   Uuid service_uuid = Uuid::From16Bit(UUID_SERVCLASS_GATT_SERVER);
 
   Uuid char_uuid = Uuid::From16Bit(GATT_UUID_GATT_SRV_CHGD);
+  Uuid cl_sup_feat_uuid = Uuid::From16Bit(GATT_UUID_CLIENT_SUP_FEAT);
 
   btgatt_db_element_t service[] = {
       {
@@ -294,6 +363,12 @@ void gatt_profile_db_init(void) {
           .type = BTGATT_DB_CHARACTERISTIC,
           .properties = GATT_CHAR_PROP_BIT_INDICATE,
           .permissions = 0,
+      },
+      {
+          .uuid = cl_sup_feat_uuid,
+          .type = BTGATT_DB_CHARACTERISTIC,
+          .properties = GATT_CHAR_PROP_BIT_READ | GATT_CHAR_PROP_BIT_WRITE,
+          .permissions = GATT_PERM_READ | GATT_PERM_WRITE,
       }};
 
   GATTS_AddService(gatt_cb.gatt_if, service,
@@ -301,6 +376,7 @@ void gatt_profile_db_init(void) {
 
   service_handle = service[0].attribute_handle;
   gatt_cb.handle_of_h_r = service[1].attribute_handle;
+  gatt_cb.handle_cl_sup_feat = service[2].attribute_handle;
 
   VLOG(1) << __func__ << ": gatt_if=" << +gatt_cb.gatt_if;
 }
@@ -188,6 +188,11 @@ void gatt_act_read(tGATT_CLCB* p_clcb, uint16_t offset) {
       memcpy(&msg.read_multi, p_clcb->p_attr_buf, sizeof(tGATT_READ_MULTI));
       break;
 
+    case GATT_READ_MULTIPLE_VAR_LEN:
+      op_code = GATT_REQ_READ_MULTI_VAR;
+      memcpy(&msg.read_multi, p_clcb->p_attr_buf, sizeof(tGATT_READ_MULTI));
+      break;
+
     case GATT_READ_INC_SRV_UUID128:
       op_code = GATT_REQ_READ;
       msg.handle = p_clcb->s_handle;
@@ -685,6 +690,68 @@ void gatt_process_notification(tGATT_TCB& tcb, uint8_t op_code, uint16_t len,
   }
 }
 
+/*******************************************************************************
+ *
+ * Function         gatt_process_multi_notification
+ *
+ * Description      Handle the multiple handle value notification. Each value
+ *                  is passed to the registered clients as a notification.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void gatt_process_multi_notification(tGATT_TCB& tcb, uint16_t len,
+                                            uint8_t* p_data) {
+  uint8_t* p = p_data;
+  uint16_t remaining = len, handle, value_len;
+
+  VLOG(1) << __func__;
+
+  /* check every handle, length and value tuple before passing any value */
+  while (remaining > 0) {
+    if (remaining < 4) {
+      LOG(ERROR) << "illegal multiple notification PDU length, discard";
+      return;
+    }
+    STREAM_TO_UINT16(handle, p);
+    STREAM_TO_UINT16(value_len, p);
+    remaining -= 4;
+    if (value_len > remaining || value_len > GATT_MAX_ATTR_LEN) {
+      LOG(ERROR) << "illegal multiple notification value length, discard";
+      return;
+    }
+    p += value_len;
+    remaining -= value_len;
+  }
+
+  tGATT_STATUS encrypt_status = gatt_get_link_encrypt_status(tcb);
+  tGATT_CL_COMPLETE gatt_cl_complete;
+  tGATT_VALUE& value = gatt_cl_complete.att_value;
+  tGATT_REG* p_reg;
+  uint8_t i;
+
+  p = p_data;
+  remaining = len;
+  while (remaining > 0) {
+    memset(&value, 0, sizeof(value));
+    STREAM_TO_UINT16(value.handle, p);
+    STREAM_TO_UINT16(value.len, p);
+    memcpy(value.value, p, value.len);
+    p += value.len;
+    remaining -= 4 + value.len;
+
+    if (!GATT_HANDLE_IS_VALID(value.handle)) continue;
+
+    for (i = 0, p_reg = gatt_cb.cl_rcb; i < GATT_MAX_APPS; i++, p_reg++) {
+      if (p_reg->in_use && p_reg->app_cb.p_cmpl_cb) {
+        uint16_t conn_id = GATT_CREATE_CONN_ID(tcb.tcb_idx, p_reg->gatt_if);
+        (*p_reg->app_cb.p_cmpl_cb)(conn_id, GATTC_OPTYPE_NOTIFICATION,
+                                   encrypt_status, &gatt_cl_complete);
+      }
+    }
+  }
+}
+
 /*******************************************************************************
  *
  * Function         gatt_process_read_by_type_rsp
@@ -1088,6 +1155,18 @@ void gatt_client_handle_server_rsp(tGATT_TCB& tcb, uint8_t op_code,
     return;
   }
 
+  if (op_code == GATT_HANDLE_MULTI_VALUE_NOTIF) {
+    if (len >= tcb.payload_size) {
+      LOG(ERROR) << StringPrintf(
+          "%s: invalid notification pkt size: %d, PDU size: %d", __func__,
+          len + 1, tcb.payload_size);
+      return;
+    }
+
+    gatt_process_multi_notification(tcb, len, p_data);
+    return;
+  }
+
   uint8_t cmd_code = 0;
   tGATT_CLCB* p_clcb = gatt_cmd_dequeue(tcb, &cmd_code);
   uint8_t rsp_code = gatt_cmd_to_rsp_code(cmd_code);
@@ -1137,6 +1216,7 @@ void gatt_client_handle_server_rsp(tGATT_TCB& tcb, uint8_t op_code,
       case GATT_RSP_READ:
       case GATT_RSP_READ_BLOB:
       case GATT_RSP_READ_MULTI:
+      case GATT_RSP_READ_MULTI_VAR:
         gatt_process_read_rsp(tcb, p_clcb, op_code, len, p_data);
         break;
 
@@ -29,6 +29,7 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <algorithm>
 #include "btm_int.h"
 #include "gatt_int.h"
 #include "l2c_api.h"
@@ -142,6 +143,23 @@ static tGATT_STATUS gatts_check_attr_readability(const tGATT_ATTR& attr,
   return GATT_SUCCESS;
 }
 
+/** Reads the value of |attr| cached by the application, if any. Returns
+ * GATT_PENDING when the application has to be asked. */
+static tGATT_STATUS read_cached_attr_value(tGATT_ATTR& attr, uint16_t offset,
+                                           uint8_t** p_data, uint16_t mtu,
+                                           uint16_t* p_len) {
+  if (!attr.p_cache || !attr.p_cache->valid) return GATT_PENDING;
+
+  const std::vector<uint8_t>& value = attr.p_cache->value;
+  if (offset > value.size()) return GATT_INVALID_OFFSET;
+
+  *p_len = std::min<size_t>(value.size() - offset, mtu);
+  memcpy(*p_data, value.data() + offset, *p_len);
+  *p_data += *p_len;
+  attr.p_cache->hit_count++;
+  return GATT_SUCCESS;
+}
+
 /*******************************************************************************
  *
  * Function         read_attr_value
@@ -176,7 +194,7 @@ static tGATT_STATUS read_attr_value(tGATT_ATTR& attr16, uint16_t offset,
 
   if (!attr16.uuid.Is16Bit()) {
     /* characteristic description or characteristic value */
-    return GATT_PENDING;
+    return read_cached_attr_value(attr16, offset, p_data, mtu, p_len);
   }
 
   uint16_t uuid16 = attr16.uuid.As16Bit();
@@ -230,7 +248,17 @@ static tGATT_STATUS read_attr_value(tGATT_ATTR& attr16, uint16_t offset,
   }
 
   /* characteristic description or characteristic value (again) */
-  return GATT_PENDING;
+  return read_cached_attr_value(attr16, offset, p_data, mtu, p_len);
+}
+
+/** Returns the indices in |p_db| of the attributes of |type|, in handle
+ * order, or NULL if it has none. */
+static const std::vector<uint16_t>* find_attrs_by_type(tGATT_SVC_DB* p_db,
+                                                       const Uuid& type) {
+  if (!p_db) return nullptr;
+
+  auto it = p_db->type_index.find(type);
+  return it == p_db->type_index.end() ? nullptr : &it->second;
 }
 
 /*******************************************************************************
@@ -260,40 +288,47 @@ tGATT_STATUS gatts_db_read_attr_value_by_type(
   uint16_t len = 0;
   uint8_t* p = (uint8_t*)(p_rsp + 1) + p_rsp->len + L2CAP_MIN_OFFSET;
 
-  if (p_db) {
-    for (tGATT_ATTR& attr : p_db->attr_list) {
-      if (attr.handle >= s_handle && type == attr.uuid) {
-        if (*p_len <= 2) {
-          status = GATT_NO_RESOURCES;
-          break;
-        }
+  const std::vector<uint16_t>* indices = find_attrs_by_type(p_db, type);
+  if (indices) {
+    /* attributes get consecutive handles, see allocate_attr_in_db() */
+    uint16_t first_handle = p_db->attr_list.front().handle;
+    auto index = indices->begin();
+    if (s_handle > first_handle)
+      index = std::lower_bound(indices->begin(), indices->end(),
+                               s_handle - first_handle);
+
+    for (; index != indices->end(); ++index) {
+      tGATT_ATTR& attr = p_db->attr_list[*index];
+      if (*p_len <= 2) {
+        status = GATT_NO_RESOURCES;
+        break;
+      }
 
-        UINT16_TO_STREAM(p, attr.handle);
+      UINT16_TO_STREAM(p, attr.handle);
 
-        status = read_attr_value(attr, 0, &p, false, (uint16_t)(*p_len - 2),
-                                 &len, sec_flag, key_size);
+      status = read_attr_value(attr, 0, &p, false, (uint16_t)(*p_len - 2),
+                               &len, sec_flag, key_size);
 
-        if (status == GATT_PENDING) {
-          status = gatts_send_app_read_request(tcb, op_code, attr.handle, 0,
-                                               trans_id, attr.gatt_type);
+      if (status == GATT_PENDING) {
+        status = gatts_send_app_read_request(tcb, op_code, attr.handle, 0,
+                                             trans_id, attr.gatt_type);
 
-          /* one callback at a time */
-          break;
-        } else if (status == GATT_SUCCESS) {
-          if (p_rsp->offset == 0) p_rsp->offset = len + 2;
-
-          if (p_rsp->offset == len + 2) {
-            p_rsp->len += (len + 2);
-            *p_len -= (len + 2);
-          } else {
-            LOG(ERROR) << "format mismatch";
-            status = GATT_NO_RESOURCES;
-            break;
-          }
+        /* one callback at a time */
+        break;
+      } else if (status == GATT_SUCCESS) {
+        if (p_rsp->offset == 0) p_rsp->offset = len + 2;
+
+        if (p_rsp->offset == len + 2) {
+          p_rsp->len += (len + 2);
+          *p_len -= (len + 2);
         } else {
-          *p_cur_handle = attr.handle;
+          LOG(ERROR) << "format mismatch";
+          status = GATT_NO_RESOURCES;
           break;
         }
+      } else {
+        *p_cur_handle = attr.handle;
+        break;
       }
     }
   }
@@ -410,14 +445,28 @@ uint16_t gatts_add_char_descr(tGATT_SVC_DB& db, tGATT_PERM perm,
 /* Service Attribute Database Query Utility Functions */
 /******************************************************************************/
 tGATT_ATTR* find_attr_by_handle(tGATT_SVC_DB* p_db, uint16_t handle) {
-  if (!p_db) return nullptr;
+  if (!p_db || p_db->attr_list.empty()) return nullptr;
 
-  for (auto& attr : p_db->attr_list) {
-    if (attr.handle == handle) return &attr;
-    if (attr.handle > handle) return nullptr;
-  }
+  /* attributes get consecutive handles from the service declaration on, see
+   * allocate_attr_in_db() */
+  uint16_t first_handle = p_db->attr_list.front().handle;
+  if (handle < first_handle) return nullptr;
+
+  size_t index = handle - first_handle;
+  if (index >= p_db->attr_list.size()) return nullptr;
+
+  tGATT_ATTR& attr = p_db->attr_list[index];
+  return attr.handle == handle ? &attr : nullptr;
+}
+
+/** Drops the value cached for the attribute |handle|, if any, until the
+ * application sets it again. The hit count is kept. */
+void gatts_invalidate_cached_value(tGATT_SVC_DB* p_db, uint16_t handle) {
+  tGATT_ATTR* p_attr = find_attr_by_handle(p_db, handle);
+  if (!p_attr || !p_attr->p_cache) return;
 
-  return nullptr;
+  p_attr->p_cache->valid = false;
+  p_attr->p_cache->value.clear();
 }
 
 /*******************************************************************************
@@ -658,6 +707,7 @@ static tGATT_ATTR& allocate_attr_in_db(tGATT_SVC_DB& db, const Uuid& uuid,
                << ", next_handle = " << +db.next_handle;
   }
 
+  db.type_index[uuid].push_back(db.attr_list.size());
   db.attr_list.emplace_back();
   tGATT_ATTR& attr = db.attr_list.back();
   attr.handle = db.next_handle++;
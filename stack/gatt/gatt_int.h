@@ -29,6 +29,7 @@
 #include <base/strings/stringprintf.h>
 #include <string.h>
 #include <list>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
@@ -164,6 +165,16 @@ typedef union {
 #define GATT_ATTR_UUID_TYPE_32 2
 typedef uint8_t tGATT_ATTR_UUID_TYPE;
 
+/* Value of a characteristic or descriptor pushed by the application, so
+ * that the reads of the attribute are answered without an application round
+ * trip. See GATTS_SetCachedValue.
+*/
+typedef struct {
+  std::vector<uint8_t> value;
+  bool valid;         /* false once invalidated, until the next value */
+  uint32_t hit_count; /* reads answered from the cache */
+} tGATT_ATTR_CACHE;
+
 /* 16 bits UUID Attribute in server database
 */
 typedef struct {
@@ -172,12 +183,16 @@ typedef struct {
   uint16_t handle;
   bluetooth::Uuid uuid;
   bt_gatt_db_attribute_type_t gatt_type;
+  std::unique_ptr<tGATT_ATTR_CACHE> p_cache; /* NULL unless cached by app */
 } tGATT_ATTR;
 
 /* Service Database definition
 */
 typedef struct {
   std::vector<tGATT_ATTR> attr_list; /* pointer to the attributes */
+  /* indices in attr_list of the attributes of each type, in handle order, so
+   * that Read By Type requests only visit the attributes they return */
+  std::unordered_map<bluetooth::Uuid, std::vector<uint16_t>> type_index;
   uint16_t end_handle;       /* Last handle number           */
   uint16_t next_handle;      /* Next usable handle value     */
 } tGATT_SVC_DB;
@@ -292,6 +307,10 @@ typedef struct {
   std::queue<tGATT_CMD_Q> cl_cmd_q;
   alarm_t* ind_ack_timer; /* local app confirm to indication timer */
 
+  bool is_congested; /* ATT channel congested, as reported by L2CAP */
+
+  uint8_t cl_sup_feat; /* Client Supported Features written by the peer */
+
   bool in_use;
   uint8_t tcb_idx;
 } tGATT_TCB;
@@ -355,6 +374,8 @@ typedef struct {
 
 typedef struct {
   tGATT_TCB tcb[GATT_MAX_PHY_CHANNEL];
+  /* index of the tcb entries in use, by peer address and transport */
+  std::unordered_map<uint64_t, uint8_t> tcb_by_addr;
   fixed_queue_t* sign_op_queue;
 
   uint16_t next_handle;     /* next available handle */
@@ -363,6 +384,8 @@ typedef struct {
   tGATT_IF gatt_if;
   std::list<tGATT_HDL_LIST_ELEM>* hdl_list_info;
   std::list<tGATT_SRV_LIST_ELEM>* srv_list_info;
+  /* srv_list_info entries sorted by start handle, for handle lookups */
+  std::vector<std::list<tGATT_SRV_LIST_ELEM>::iterator> srv_handle_index;
 
   fixed_queue_t* srv_chg_clt_q; /* service change clients queue */
   tGATT_REG cl_rcb[GATT_MAX_APPS];
@@ -379,6 +402,7 @@ typedef struct {
   tGATT_PROFILE_CLCB profile_clcb[GATT_MAX_APPS];
   uint16_t
       handle_of_h_r; /* Handle of the handles reused characteristic value */
+  uint16_t handle_cl_sup_feat; /* Handle of the Client Supported Features */
 
   tGATT_APPL_INFO cb_info;
 
@@ -425,6 +449,12 @@ extern BT_HDR* attp_build_sr_msg(tGATT_TCB& tcb, uint8_t op_code,
                                  tGATT_SR_MSG* p_msg);
 extern tGATT_STATUS attp_send_sr_msg(tGATT_TCB& tcb, BT_HDR* p_msg);
 extern tGATT_STATUS attp_send_msg_to_l2cap(tGATT_TCB& tcb, BT_HDR* p_toL2CAP);
+extern tGATT_STATUS attp_send_sr_notifications(
+    tGATT_TCB& tcb, const tGATT_NOTIFICATION* p_notifs, uint16_t num_notifs,
+    uint16_t* p_num_sent);
+extern BT_HDR* attp_build_multi_notification(tGATT_TCB& tcb,
+                                             const tGATT_NOTIFICATION* p_notifs,
+                                             uint16_t num_notifs);
 
 /* utility functions */
 extern uint8_t* gatt_dbg_op_name(uint8_t op_code);
@@ -475,6 +505,7 @@ extern bool gatt_auto_connect_dev_remove(tGATT_IF gatt_if,
 /* server function */
 extern std::list<tGATT_SRV_LIST_ELEM>::iterator gatt_sr_find_i_rcb_by_handle(
     uint16_t handle);
+extern void gatt_sr_update_handle_index(void);
 extern tGATT_STATUS gatt_sr_process_app_rsp(tGATT_TCB& tcb, tGATT_IF gatt_if,
                                             uint32_t trans_id, uint8_t op_code,
                                             tGATT_STATUS status,
@@ -510,6 +541,7 @@ extern tGATT_TCB* gatt_find_tcb_by_cid(uint16_t lcid);
 extern tGATT_TCB* gatt_allocate_tcb_by_bdaddr(const RawAddress& bda,
                                               tBT_TRANSPORT transport);
 extern tGATT_TCB* gatt_get_tcb_by_idx(uint8_t tcb_idx);
+extern void gatt_tcb_index_remove(tGATT_TCB* p_tcb);
 extern tGATT_TCB* gatt_find_tcb_by_addr(const RawAddress& bda,
                                         tBT_TRANSPORT transport);
 extern bool gatt_send_ble_burst_data(const RawAddress& remote_bda,
@@ -573,5 +605,7 @@ extern tGATT_STATUS gatts_read_attr_perm_check(tGATT_SVC_DB* p_db, bool is_long,
                                                tGATT_SEC_FLAG sec_flag,
                                                uint8_t key_size);
 extern bluetooth::Uuid* gatts_get_service_uuid(tGATT_SVC_DB* p_db);
+extern tGATT_ATTR* find_attr_by_handle(tGATT_SVC_DB* p_db, uint16_t handle);
+extern void gatts_invalidate_cached_value(tGATT_SVC_DB* p_db, uint16_t handle);
 
 #endif
@@ -29,6 +29,7 @@
 #include "btif_storage.h"
 #include "btm_ble_int.h"
 #include "btm_int.h"
+#include "common/trace.h"
 #include "connection_manager.h"
 #include "device/include/interop.h"
 #include "gatt_int.h"
@@ -180,6 +181,8 @@ void gatt_free(void) {
   gatt_cb.hdl_list_info = nullptr;
   gatt_cb.srv_list_info->clear();
   gatt_cb.srv_list_info = nullptr;
+  gatt_cb.srv_handle_index.clear();
+  gatt_cb.tcb_by_addr.clear();
 }
 
 /*******************************************************************************
@@ -379,6 +382,7 @@ bool gatt_act_connect(tGATT_REG* p_reg, const RawAddress& bd_addr,
                     p_reg->gatt_if)) {
     LOG(ERROR) << "gatt_connect failed";
     fixed_queue_free(p_tcb->pending_ind_q, NULL);
+    gatt_tcb_index_remove(p_tcb);
     *p_tcb = tGATT_TCB();
     return false;
   }
@@ -418,6 +422,7 @@ static void gatt_le_connect_cback(uint16_t chan, const RawAddress& bd_addr,
 
   if (!connected) {
     gatt_cleanup_upon_disc(bd_addr, reason, transport);
+    connection_manager::on_disconnection(bd_addr);
     VLOG(1) << "ATT disconnected";
     return;
   }
@@ -462,6 +467,8 @@ static void gatt_channel_congestion(tGATT_TCB* p_tcb, bool congested) {
   tGATT_REG* p_reg = NULL;
   uint16_t conn_id;
 
+  if (p_tcb != NULL) p_tcb->is_congested = congested;
+
   /* if uncongested, check to see if there is any more pending data */
   if (p_tcb != NULL && !congested) {
     gatt_cl_send_next_cmd_inq(*p_tcb);
@@ -851,6 +858,7 @@ static void gatt_send_conn_cback(tGATT_TCB* p_tcb) {
  *
  ******************************************************************************/
 void gatt_data_process(tGATT_TCB& tcb, BT_HDR* p_buf) {
+  BT_TRACE_SCOPE("gatt_data_process", p_buf);
   uint8_t* p = (uint8_t*)(p_buf + 1) + p_buf->offset;
   uint8_t op_code, pseudo_op_code;
 
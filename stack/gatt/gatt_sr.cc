@@ -141,7 +141,8 @@ static bool process_read_multi_rsp(tGATT_SR_CMD* p_cmd, tGATT_STATUS status,
       p = (uint8_t*)(p_buf + 1) + p_buf->offset;
 
       /* First byte in the response is the opcode */
-      *p++ = GATT_RSP_READ_MULTI;
+      bool is_variable_len = (p_cmd->op_code == GATT_REQ_READ_MULTI_VAR);
+      *p++ = is_variable_len ? GATT_RSP_READ_MULTI_VAR : GATT_RSP_READ_MULTI;
       p_buf->len = 1;
 
       /* Now walk through the buffers puting the data into the response in order
@@ -162,6 +163,14 @@ static bool process_read_multi_rsp(tGATT_SR_CMD* p_cmd, tGATT_STATUS status,
         }
 
         if (p_rsp != NULL) {
+          /* the variable length response puts the length of each value in
+           * front of it; the last value may be truncated, not its length */
+          if (is_variable_len) {
+            if (p_buf->len + 2 > mtu) break;
+            UINT16_TO_STREAM(p, p_rsp->attr_value.len);
+            p_buf->len += 2;
+          }
+
           total_len = (p_buf->len + p_rsp->attr_value.len);
 
           if (total_len > mtu) {
@@ -236,7 +245,7 @@ tGATT_STATUS gatt_sr_process_app_rsp(tGATT_TCB& tcb, tGATT_IF gatt_if,
 
   gatt_sr_update_cback_cnt(tcb, gatt_if, false, false);
 
-  if (op_code == GATT_REQ_READ_MULTI) {
+  if (op_code == GATT_REQ_READ_MULTI || op_code == GATT_REQ_READ_MULTI_VAR) {
     /* If no error and still waiting, just return */
     if (!process_read_multi_rsp(&tcb.sr_cmd, status, p_msg, tcb.payload_size))
       return (GATT_SUCCESS);
@@ -344,8 +353,8 @@ void gatt_process_exec_write_req(tGATT_TCB& tcb, uint8_t op_code, uint16_t len,
  *
  * Function         gatt_process_read_multi_req
  *
- * Description      This function is called to process the read multiple request
- *                  from client.
+ * Description      This function is called to process the read multiple and
+ *                  read multiple variable length requests from client.
  *
  * Returns          void
  *
@@ -912,6 +921,10 @@ static void gatts_process_write_req(tGATT_TCB& tcb, tGATT_SRV_LIST_ELEM& el,
                                        sec_flag, key_size);
 
   if (status == GATT_SUCCESS) {
+    /* the application is about to change the value, don't serve the old one
+     * until it pushes the new one */
+    gatts_invalidate_cached_value(el.p_db, handle);
+
     trans_id = gatt_sr_enqueue_cmd(tcb, op_code, handle);
     if (trans_id != 0) {
       conn_id = GATT_CREATE_CONN_ID(tcb.tcb_idx, el.gatt_if);
@@ -1035,32 +1048,28 @@ void gatts_process_attribute_req(tGATT_TCB& tcb, uint8_t op_code, uint16_t len,
 #endif
 
   if (GATT_HANDLE_IS_VALID(handle)) {
-    for (auto& el : *gatt_cb.srv_list_info) {
-      if (el.s_hdl <= handle && el.e_hdl >= handle) {
-        for (const auto& attr : el.p_db->attr_list) {
-          if (attr.handle == handle) {
-            switch (op_code) {
-              case GATT_REQ_READ: /* read char/char descriptor value */
-              case GATT_REQ_READ_BLOB:
-                gatts_process_read_req(tcb, el, op_code, handle, len, p);
-                break;
-
-              case GATT_REQ_WRITE: /* write char/char descriptor value */
-              case GATT_CMD_WRITE:
-              case GATT_SIGN_CMD_WRITE:
-              case GATT_REQ_PREPARE_WRITE:
-                gatts_process_write_req(tcb, el, handle, op_code, len, p,
-                                        attr.gatt_type);
-                break;
-              default:
-                break;
-            }
-            status = GATT_SUCCESS;
-            break;
-          }
-        }
-        break;
+    auto it = gatt_sr_find_i_rcb_by_handle(handle);
+    tGATT_ATTR* p_attr = it != gatt_cb.srv_list_info->end()
+                             ? find_attr_by_handle(it->p_db, handle)
+                             : nullptr;
+    if (p_attr) {
+      switch (op_code) {
+        case GATT_REQ_READ: /* read char/char descriptor value */
+        case GATT_REQ_READ_BLOB:
+          gatts_process_read_req(tcb, *it, op_code, handle, len, p);
+          break;
+
+        case GATT_REQ_WRITE: /* write char/char descriptor value */
+        case GATT_CMD_WRITE:
+        case GATT_SIGN_CMD_WRITE:
+        case GATT_REQ_PREPARE_WRITE:
+          gatts_process_write_req(tcb, *it, handle, op_code, len, p,
+                                  p_attr->gatt_type);
+          break;
+        default:
+          break;
       }
+      status = GATT_SUCCESS;
     }
   }
 
@@ -1236,6 +1245,7 @@ void gatt_server_handle_client_req(tGATT_TCB& tcb, uint8_t op_code,
         break;
 
       case GATT_REQ_READ_MULTI:
+      case GATT_REQ_READ_MULTI_VAR:
         gatt_process_read_multi_req(tcb, op_code, len, p_data);
         break;
 
@@ -26,6 +26,8 @@
 #include "osi/include/osi.h"
 
 #include <string.h>
+#include <algorithm>
+#include <iterator>
 #include "bt_common.h"
 #include "stdio.h"
 
@@ -77,6 +79,11 @@ const char* const op_code_name[] = {"UNKNOWN",
                                     "Reserved",
                                     "ATT_HANDLE_VALUE_IND",
                                     "ATT_HANDLE_VALUE_CONF",
+                                    "Reserved",
+                                    "ATT_REQ_READ_MULTI_VAR",
+                                    "ATT_RSP_READ_MULTI_VAR",
+                                    "Reserved",
+                                    "ATT_HANDLE_MULTI_VALUE_NOTIF",
                                     "ATT_OP_CODE_MAX"};
 
 /*******************************************************************************
@@ -348,6 +355,13 @@ bool gatt_is_bda_connected(const RawAddress& bda) {
   return connected;
 }
 
+/* Key of a tcb in gatt_cb.tcb_by_addr */
+static uint64_t gatt_tcb_key(const RawAddress& bda, tBT_TRANSPORT transport) {
+  uint64_t key = transport;
+  for (uint8_t byte : bda.address) key = (key << 8) | byte;
+  return key;
+}
+
 /*******************************************************************************
  *
  * Function         gatt_find_i_tcb_by_addr
@@ -359,15 +373,25 @@ bool gatt_is_bda_connected(const RawAddress& bda) {
  ******************************************************************************/
 uint8_t gatt_find_i_tcb_by_addr(const RawAddress& bda,
                                 tBT_TRANSPORT transport) {
-  uint8_t i = 0;
+  auto it = gatt_cb.tcb_by_addr.find(gatt_tcb_key(bda, transport));
+  if (it == gatt_cb.tcb_by_addr.end()) return GATT_INDEX_INVALID;
+  return it->second;
+}
 
-  for (; i < GATT_MAX_PHY_CHANNEL; i++) {
-    if (gatt_cb.tcb[i].peer_bda == bda &&
-        gatt_cb.tcb[i].transport == transport) {
-      return i;
-    }
-  }
-  return GATT_INDEX_INVALID;
+/*******************************************************************************
+ *
+ * Function         gatt_tcb_index_remove
+ *
+ * Description      Removes a tcb about to be released from the address index.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void gatt_tcb_index_remove(tGATT_TCB* p_tcb) {
+  auto it =
+      gatt_cb.tcb_by_addr.find(gatt_tcb_key(p_tcb->peer_bda, p_tcb->transport));
+  if (it != gatt_cb.tcb_by_addr.end() && &gatt_cb.tcb[it->second] == p_tcb)
+    gatt_cb.tcb_by_addr.erase(it);
 }
 
 /*******************************************************************************
@@ -437,6 +461,7 @@ tGATT_TCB* gatt_allocate_tcb_by_bdaddr(const RawAddress& bda,
     p_tcb->tcb_idx = i;
     p_tcb->transport = transport;
     p_tcb->peer_bda = bda;
+    gatt_cb.tcb_by_addr[gatt_tcb_key(bda, transport)] = i;
     return p_tcb;
   }
 
@@ -662,15 +687,47 @@ void gatt_ind_ack_timeout(void* data) {
  ******************************************************************************/
 std::list<tGATT_SRV_LIST_ELEM>::iterator gatt_sr_find_i_rcb_by_handle(
     uint16_t handle) {
-  auto it = gatt_cb.srv_list_info->begin();
-
-  for (; it != gatt_cb.srv_list_info->end(); it++) {
-    if (it->s_hdl <= handle && it->e_hdl >= handle) {
-      return it;
-    }
+  const auto& index = gatt_cb.srv_handle_index;
+
+  /* last service starting at or before the handle */
+  auto it = std::upper_bound(
+      index.begin(), index.end(), handle,
+      [](uint16_t h, const std::list<tGATT_SRV_LIST_ELEM>::iterator& el) {
+        return h < el->s_hdl;
+      });
+  if (it != index.begin() && (*std::prev(it))->e_hdl >= handle) {
+    return *std::prev(it);
   }
 
-  return it;
+  return gatt_cb.srv_list_info->end();
+}
+
+/*******************************************************************************
+ *
+ * Function         gatt_sr_update_handle_index
+ *
+ * Description      Rebuild the handle index used by
+ *                  gatt_sr_find_i_rcb_by_handle. Must be called whenever
+ *                  services are added to or removed from
+ *                  gatt_cb.srv_list_info.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void gatt_sr_update_handle_index(void) {
+  auto& index = gatt_cb.srv_handle_index;
+  index.clear();
+  if (!gatt_cb.srv_list_info) return;
+
+  for (auto it = gatt_cb.srv_list_info->begin();
+       it != gatt_cb.srv_list_info->end(); it++) {
+    index.push_back(it);
+  }
+  std::stable_sort(index.begin(), index.end(),
+                   [](const std::list<tGATT_SRV_LIST_ELEM>::iterator& a,
+                      const std::list<tGATT_SRV_LIST_ELEM>::iterator& b) {
+                     return a->s_hdl < b->s_hdl;
+                   });
 }
 
 /*******************************************************************************
@@ -1283,6 +1340,7 @@ void gatt_cleanup_upon_disc(const RawAddress& bda, uint16_t reason,
     }
   }
 
+  gatt_tcb_index_remove(p_tcb);
   *p_tcb = tGATT_TCB();
   VLOG(1) << __func__ << ": exit";
 }
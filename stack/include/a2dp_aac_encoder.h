@@ -70,6 +70,10 @@ void a2dp_aac_feeding_reset(void);
 // Flush the feeding for the A2DP AAC encoder.
 void a2dp_aac_feeding_flush(void);
 
+// Set the share of the configured bit rate the A2DP AAC encoder uses, in
+// percent. The peak bit rate is scaled alike.
+void a2dp_aac_set_bitrate_percent(uint8_t bitrate_percent);
+
 // Get the A2DP AAC encoder interval (in milliseconds).
 uint64_t a2dp_aac_get_encoder_interval_ms(void);
 
@@ -0,0 +1,95 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// Adaptive bitrate control shared by the A2DP source encoders. The controller
+// watches the link: the Bluetooth Quality Reports of the controller, the depth
+// of the transmit queue and the L2CAP congestion, and picks the share of the
+// configured bitrate the encoder should use. It steps down as soon as the link
+// struggles, and back up only after the link stayed healthy for a while, so
+// the bitrate doesn't oscillate. LDAC keeps its own ABR library.
+//
+
+#ifndef A2DP_ABR_H
+#define A2DP_ABR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// The link quality counters of a Bluetooth Quality Report. The counters are
+// the ones since the previous report.
+typedef struct {
+  int8_t rssi;
+  uint32_t retransmission_count;
+  uint32_t no_rx_count;
+  uint32_t nak_count;
+  uint32_t flow_off_count;
+} tA2DP_ABR_LINK_QUALITY;
+
+class A2dpAbr {
+ public:
+  // The bitrate steps, in percent of the configured bitrate
+  static constexpr uint8_t kBitratePercents[] = {100, 85, 70, 55};
+  static constexpr size_t kNumLevels =
+      sizeof(kBitratePercents) / sizeof(kBitratePercents[0]);
+
+  // The link is judged over periods of |kEvaluationIntervalMs|
+  static constexpr uint64_t kEvaluationIntervalMs = 1000;
+  // The link must stay healthy that long before the bitrate goes back up
+  static constexpr uint64_t kStepUpHoldMs = 5000;
+
+  A2dpAbr() { Reset(); }
+
+  // Goes back to the full bitrate and forgets the link history
+  void Reset();
+
+  void OnLinkQuality(const tA2DP_ABR_LINK_QUALITY& link_quality);
+  void OnTransmitQueueLength(size_t transmit_queue_length);
+  // The transmit queue overflowed or L2CAP dropped media packets
+  void OnCongestion();
+
+  // Judges the link when a period ended at |now_ms|. Returns true when the
+  // bitrate percent changed.
+  bool Update(uint64_t now_ms);
+
+  uint8_t GetBitratePercent() const { return kBitratePercents[level_]; }
+
+  void DebugDump(int fd) const;
+
+ private:
+  enum LinkState { kLinkStruggling, kLinkFair, kLinkHealthy };
+
+  LinkState EvaluatePeriod() const;
+
+  size_t level_;
+  uint64_t period_start_ms_;
+  uint64_t healthy_since_ms_;
+  bool healthy_;
+
+  // What was seen during the current period
+  size_t max_transmit_queue_length_;
+  size_t congestion_count_;
+  bool has_link_quality_;
+  tA2DP_ABR_LINK_QUALITY worst_link_quality_;
+
+  // Over the whole session
+  size_t total_step_downs_;
+  size_t total_step_ups_;
+  size_t total_link_quality_reports_;
+  size_t total_congestions_;
+};
+
+#endif  // A2DP_ABR_H
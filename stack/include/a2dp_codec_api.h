@@ -538,6 +538,12 @@ typedef struct {
 
   // Set transmit queue length for the A2DP encoder.
   void (*set_transmit_queue_length)(size_t transmit_queue_length);
+
+  // Set the share of the configured bitrate the A2DP encoder should use, in
+  // percent. Lower values trade audio quality for airtime when the link
+  // struggles. Optional: encoders with a fixed bitrate or an adaptive bitrate
+  // of their own leave it unset.
+  void (*set_bitrate_percent)(uint8_t bitrate_percent);
 } tA2DP_ENCODER_INTERFACE;
 
 // Prototype for a callback to receive decoded audio data from a
@@ -732,6 +738,17 @@ bool A2DP_InitCodecConfig(btav_a2dp_codec_index_t codec_index,
 // Returns a string describing the codec information.
 std::string A2DP_CodecInfoString(const uint8_t* p_codec_info);
 
+// Checks whether the codec user config |user_config| can be applied to the
+// stream using |current_config| without reconfiguring the peer or restarting
+// the audio session: the over the air configuration and the PCM stay the
+// same, and only encoder parameters like the LDAC quality mode change.
+// |is_offloading| is true when the stream is encoded by the controller, which
+// can't take new encoder parameters on the fly.
+// Returns true if the config can be applied in place, otherwise false.
+bool A2DP_IsCodecUserConfigInPlace(
+    const btav_a2dp_codec_config_t& current_config,
+    const btav_a2dp_codec_config_t& user_config, bool is_offloading);
+
 // Add enum-based flag operators to the btav_a2dp_codec_config_t fields
 #ifndef DEFINE_ENUM_FLAG_OPERATORS
 // Use NOLINT to suppress missing parentheses warnings around bitmask.
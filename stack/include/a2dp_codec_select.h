@@ -0,0 +1,85 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// Tables for the negotiation of the A2DP codec configuration fields.
+//
+// Each codec lists the values a field of its Codec Information Element can
+// take, from the most to the least preferred one, each with the
+// btav_a2dp_codec_config_t value it stands for. Negotiating the field is then
+// intersecting the local and the peer bits of the field, and looking the
+// result up in the table, instead of testing the bits one by one.
+//
+
+#ifndef A2DP_CODEC_SELECT_H
+#define A2DP_CODEC_SELECT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+template <typename T>
+struct tA2DP_CODEC_FIELD_VALUE {
+  uint32_t ie_bit;  // The bit of the value in the Codec Information Element
+  T btav_value;     // The btav_a2dp_codec_config_t value it stands for
+};
+
+// Returns the btav_a2dp_codec_config_t values of the bits set in |ie_bits|.
+template <typename T, size_t N>
+inline T A2DP_FieldBtavValues(const tA2DP_CODEC_FIELD_VALUE<T> (&values)[N],
+                              uint32_t ie_bits) {
+  T btav_values = static_cast<T>(0);
+  for (const auto& value : values) {
+    if (ie_bits & value.ie_bit) btav_values |= value.btav_value;
+  }
+  return btav_values;
+}
+
+// Returns the most preferred value whose bit is set in |ie_bits|, or nullptr
+// if there is none.
+template <typename T, size_t N>
+inline const tA2DP_CODEC_FIELD_VALUE<T>* A2DP_SelectBestFieldValue(
+    const tA2DP_CODEC_FIELD_VALUE<T> (&values)[N], uint32_t ie_bits) {
+  for (const auto& value : values) {
+    if (ie_bits & value.ie_bit) return &value;
+  }
+  return nullptr;
+}
+
+// Returns the most preferred value standing for |btav_value| whose bit is set
+// in |ie_bits|, or nullptr if there is none.
+template <typename T, size_t N>
+inline const tA2DP_CODEC_FIELD_VALUE<T>* A2DP_SelectFieldValue(
+    const tA2DP_CODEC_FIELD_VALUE<T> (&values)[N], uint32_t ie_bits,
+    T btav_value) {
+  for (const auto& value : values) {
+    if ((ie_bits & value.ie_bit) && value.btav_value == btav_value) {
+      return &value;
+    }
+  }
+  return nullptr;
+}
+
+// Returns true if one of |values| stands for |btav_value|.
+template <typename T, size_t N>
+inline bool A2DP_FieldHasBtavValue(
+    const tA2DP_CODEC_FIELD_VALUE<T> (&values)[N], T btav_value) {
+  for (const auto& value : values) {
+    if (value.btav_value == btav_value) return true;
+  }
+  return false;
+}
+
+#endif  // A2DP_CODEC_SELECT_H
@@ -0,0 +1,68 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// PCM conversions of the A2DP encoders feeding: bit depth, channel count and
+// integer ratio resampling. Each one works in place on the feeding buffer
+// the PCM was read into, growing the data from its end, so the buffer must
+// have room for the converted data. The conversions of the decoded audio of
+// the sink to float write to a buffer of their own, applying the gain in the
+// same pass. The conversions use NEON or SSE2 when the CPU supports it; the
+// results are the same as the ones of the scalar code.
+//
+
+#ifndef A2DP_PCM_CONVERT_H
+#define A2DP_PCM_CONVERT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Converts |num_samples| unsigned 8-bit samples at the start of |buf| into
+// signed 16-bit samples. |buf| must hold 2 * |num_samples| bytes.
+void a2dp_pcm_8_to_16(uint8_t* buf, size_t num_samples);
+
+// Converts |num_samples| AUDIO_FORMAT_PCM_24_BIT_PACKED samples at the start
+// of |buf| into AUDIO_FORMAT_PCM_8_24_BIT samples: the 24 bits, sign extended
+// to 32 bits. |buf| must hold 4 * |num_samples| bytes.
+void a2dp_pcm_24_to_32(uint8_t* buf, size_t num_samples);
+
+// Duplicates each of the |num_frames| 16-bit mono samples at the start of
+// |buf| into a 16-bit stereo frame. |buf| must hold 2 * |num_frames| samples.
+void a2dp_pcm_mono_to_stereo_16(int16_t* buf, size_t num_frames);
+
+// Resamples the |num_frames| 16-bit stereo frames at the start of |buf| to
+// |ratio| times their sample rate, by repeating each frame |ratio| times.
+// This is what a2dp_sbc_up_sample() does when the ratio is an integer.
+// |buf| must hold |ratio| * |num_frames| frames.
+void a2dp_pcm_upsample_stereo_16(int16_t* buf, size_t num_frames,
+                                 uint32_t ratio);
+
+// Converts |num_samples| signed 16-bit samples from |src| into |dst|, as floats
+// in [-1, 1) multiplied by |gain|.
+void a2dp_pcm_16_to_float(const uint8_t* src, float* dst, size_t num_samples,
+                          float gain);
+
+// Converts |num_samples| AUDIO_FORMAT_PCM_24_BIT_PACKED samples from |src|
+// into |dst|, as floats in [-1, 1) multiplied by |gain|.
+void a2dp_pcm_24_to_float(const uint8_t* src, float* dst, size_t num_samples,
+                          float gain);
+
+// Converts |num_samples| signed 32-bit samples from |src| into |dst|, as floats
+// in [-1, 1) multiplied by |gain|.
+void a2dp_pcm_32_to_float(const uint8_t* src, float* dst, size_t num_samples,
+                          float gain);
+
+#endif  // A2DP_PCM_CONVERT_H
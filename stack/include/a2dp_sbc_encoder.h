@@ -52,6 +52,10 @@ void a2dp_sbc_feeding_reset(void);
 // Flush the feeding for the A2DP SBC encoder.
 void a2dp_sbc_feeding_flush(void);
 
+// Set the share of the source bit rate the A2DP SBC encoder uses, in percent.
+// The bitpool stays within the range of the codec config.
+void a2dp_sbc_set_bitrate_percent(uint8_t bitrate_percent);
+
 // Get the A2DP SBC encoder interval (in milliseconds).
 uint64_t a2dp_sbc_get_encoder_interval_ms(void);
 
@@ -18,6 +18,9 @@
 
 #pragma once
 
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
 #include <array>
 #include <vector>
 
@@ -29,12 +32,12 @@ static constexpr std::array<uint8_t, 18> trx_quirk{
 class AdvertiseDataParser {
   // Return true if the packet is malformed, but should be considered valid for
   // compatibility with already existing devices
-  static bool MalformedPacketQuirk(const std::vector<uint8_t>& ad,
+  static bool MalformedPacketQuirk(const uint8_t* ad, size_t ad_len,
                                    size_t position) {
-    auto data_start = ad.begin() + position;
+    const uint8_t* data_start = ad + position;
 
     // Traxxas - bad name length
-    if ((ad.size() - position) >= 18 &&
+    if ((ad_len - position) >= 18 &&
         std::equal(data_start, data_start + 3, trx_quirk.begin()) &&
         std::equal(data_start + 5, data_start + 11, trx_quirk.begin() + 5) &&
         std::equal(data_start + 12, data_start + 18, trx_quirk.begin() + 12)) {
@@ -45,10 +48,91 @@ class AdvertiseDataParser {
   }
 
  public:
-  static void RemoveTrailingZeros(std::vector<uint8_t>& ad) {
+  /* One AD structure, pointing inside the advertising data it was read from */
+  struct Field {
+    uint8_t type;
+    const uint8_t* data;
+    uint8_t length; /* length of |data|, the type is not included */
+  };
+
+  /**
+   * Non-owning view of the AD structures in advertising data, walked in a
+   * single pass with a range-based for loop. Iteration stops at zero padding
+   * and at the first structure that runs past the end of the data, like
+   * GetFieldByType. The data must outlive the view.
+   */
+  class FieldRange {
+   public:
+    class Iterator {
+     public:
+      Iterator(const uint8_t* ad, size_t ad_len, size_t position)
+          : ad_(ad), ad_len_(ad_len), position_(Check(ad, ad_len, position)) {}
+
+      Field operator*() const {
+        return Field{ad_[position_ + 1], ad_ + position_ + 2,
+                     static_cast<uint8_t>(ad_[position_] - 1)};
+      }
+
+      Iterator& operator++() {
+        position_ = Check(ad_, ad_len_, position_ + ad_[position_] + 1);
+        return *this;
+      }
+
+      bool operator==(const Iterator& other) const {
+        return position_ == other.position_;
+      }
+      bool operator!=(const Iterator& other) const {
+        return position_ != other.position_;
+      }
+
+     private:
+      // Return |position| if a whole AD structure starts there, the end of the
+      // data otherwise
+      static size_t Check(const uint8_t* ad, size_t ad_len, size_t position) {
+        if (position >= ad_len) return ad_len;
+
+        uint8_t len = ad[position];
+        if (len == 0 || position + len >= ad_len) return ad_len;
+
+        return position;
+      }
+
+      const uint8_t* ad_;
+      size_t ad_len_;
+      size_t position_;
+    };
+
+    FieldRange(const uint8_t* ad, size_t ad_len) : ad_(ad), ad_len_(ad_len) {}
+
+    Iterator begin() const { return Iterator(ad_, ad_len_, 0); }
+    Iterator end() const { return Iterator(ad_, ad_len_, ad_len_); }
+
+   private:
+    const uint8_t* ad_;
+    size_t ad_len_;
+  };
+
+  /**
+   * Return a view of the AD structures in the |ad| array of length |ad_len|
+   */
+  static FieldRange Fields(const uint8_t* ad, size_t ad_len) {
+    return FieldRange(ad, ad_len);
+  }
+
+  /**
+   * Return a view of the AD structures in |ad|
+   */
+  static FieldRange Fields(std::vector<uint8_t> const& ad) {
+    return FieldRange(ad.data(), ad.size());
+  }
+
+  /**
+   * Return the length of the |ad| array of length |ad_len| without the zero
+   * padding some devices send at the end of the data.
+   */
+  static size_t LengthWithoutTrailingZeros(const uint8_t* ad, size_t ad_len) {
     size_t position = 0;
 
-    size_t ad_len = ad.size();
     while (position != ad_len) {
       uint8_t len = ad[position];
 
@@ -57,26 +141,27 @@ class AdvertiseDataParser {
       // end of advertisement. If this is the case, cut the zero padding from
       // end of the packet. Otherwise i.e. gluing scan response to advertise
       // data will result in data with zero padding in the middle.
-      if (len == 0) {
-        ad.erase(ad.begin() + position, ad.end());
-        return;
-      }
+      if (len == 0) return position;
 
-      if (position + len >= ad_len) {
-        return;
-      }
+      if (position + len >= ad_len) return ad_len;
 
       position += len + 1;
     }
+
+    return ad_len;
+  }
+
+  static void RemoveTrailingZeros(std::vector<uint8_t>& ad) {
+    ad.resize(LengthWithoutTrailingZeros(ad.data(), ad.size()));
   }
 
   /**
-   * Return true if this |ad| represent properly formatted advertising data.
+   * Return true if the |ad| array of length |ad_len| represent properly
+   * formatted advertising data.
    */
-  static bool IsValid(const std::vector<uint8_t>& ad) {
+  static bool IsValid(const uint8_t* ad, size_t ad_len) {
     size_t position = 0;
 
-    size_t ad_len = ad.size();
     while (position != ad_len) {
       uint8_t len = ad[position];
 
@@ -93,7 +178,7 @@ class AdvertiseDataParser {
       // If the length of the current field would exceed the total data length,
       // then the data is badly formatted.
       if (position + len >= ad_len) {
-        if (MalformedPacketQuirk(ad, position)) return true;
+        if (MalformedPacketQuirk(ad, ad_len, position)) return true;
 
         return false;
       }
@@ -104,29 +189,24 @@ class AdvertiseDataParser {
     return true;
   }
 
+  /**
+   * Return true if this |ad| represent properly formatted advertising data.
+   */
+  static bool IsValid(const std::vector<uint8_t>& ad) {
+    return IsValid(ad.data(), ad.size());
+  }
+
   /**
    * This function returns a pointer inside the |ad| array of length |ad_len|
    * where a field of |type| is located, together with its length in |p_length|
    */
   static const uint8_t* GetFieldByType(const uint8_t* ad, size_t ad_len,
                                        uint8_t type, uint8_t* p_length) {
-    size_t position = 0;
-
-    while (position != ad_len) {
-      uint8_t len = ad[position];
-
-      if (len == 0) break;
-      if (position + len >= ad_len) break;
-
-      uint8_t adv_type = ad[position + 1];
-
-      if (adv_type == type) {
-        /* length doesn't include itself */
-        *p_length = len - 1; /* minus the length of type */
-        return ad + position + 2;
+    for (const Field& field : Fields(ad, ad_len)) {
+      if (field.type == type) {
+        *p_length = field.length;
+        return field.data;
       }
-
-      position += len + 1; /* skip the length of data */
     }
 
     *p_length = 0;
@@ -61,6 +61,11 @@
 /* The number of bytes needed by the protocol stack for the protocol headers
  * of a media packet.  This is the size of the media packet header, the
  * L2CAP packet header and HCI header.
+ *
+ * A media packet passed to AVDT_WriteReqOpt() must have at least this offset,
+ * or AVDT_MEDIA_OFFSET - AVDT_MEDIA_HDR_SIZE if no media packet header is
+ * added.  The headers are then prepended in place by every layer down to the
+ * HCI transport.  A packet with a smaller offset is copied to a new buffer.
 */
 #define AVDT_MEDIA_OFFSET 23
 
@@ -0,0 +1,158 @@
+/******************************************************************************
+ *
+ *  Copyright 2020 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+/**
+ * Parser of the records read from the batch scan storage of the controller.
+ *
+ * A truncated record is the address (6 bytes, least significant first), the
+ * address type, the TX power, the RSSI and a 2 bytes timestamp. A full record
+ * follows these with the length and bytes of the advertising data, then the
+ * length and bytes of the scan response.
+ */
+class BatchScanRecordParser {
+ public:
+  /* Report formats, as the batch scan modes they are read with */
+  static constexpr uint8_t kTruncated = 1;
+  static constexpr uint8_t kFull = 2;
+
+  static constexpr size_t kTruncatedRecordLength = 11;
+
+  /* One record, pointing inside the data it was read from */
+  struct Record {
+    const uint8_t* address;
+    uint8_t addr_type;
+    int8_t tx_power;
+    int8_t rssi;
+    uint16_t timestamp;
+    const uint8_t* adv_data;
+    uint8_t adv_data_len;
+    const uint8_t* scan_rsp;
+    uint8_t scan_rsp_len;
+    /* The whole record */
+    const uint8_t* data;
+    size_t length;
+  };
+
+  /**
+   * Non-owning view of the records in batch scan data, walked in a single
+   * pass with a range-based for loop. Iteration stops at the first record
+   * that runs past the end of the data. The data must outlive the view.
+   */
+  class RecordRange {
+   public:
+    class Iterator {
+     public:
+      Iterator(uint8_t format, const uint8_t* data, size_t len, size_t position)
+          : format_(format),
+            data_(data),
+            len_(len),
+            position_(position),
+            record_len_(RecordLength(format, data + position, len - position)) {
+        if (record_len_ == 0) position_ = len_;
+      }
+
+      Record operator*() const {
+        const uint8_t* p = data_ + position_;
+        Record record = {};
+        record.address = p;
+        record.addr_type = p[6];
+        record.tx_power = static_cast<int8_t>(p[7]);
+        record.rssi = static_cast<int8_t>(p[8]);
+        record.timestamp = p[9] | (p[10] << 8);
+        if (format_ == kFull) {
+          record.adv_data_len = p[kTruncatedRecordLength];
+          record.adv_data = p + kTruncatedRecordLength + 1;
+          record.scan_rsp_len = record.adv_data[record.adv_data_len];
+          record.scan_rsp = record.adv_data + record.adv_data_len + 1;
+        }
+        record.data = p;
+        record.length = record_len_;
+        return record;
+      }
+
+      Iterator& operator++() {
+        position_ += record_len_;
+        record_len_ =
+            RecordLength(format_, data_ + position_, len_ - position_);
+        if (record_len_ == 0) position_ = len_;
+        return *this;
+      }
+
+      bool operator==(const Iterator& other) const {
+        return position_ == other.position_;
+      }
+      bool operator!=(const Iterator& other) const {
+        return position_ != other.position_;
+      }
+
+     private:
+      uint8_t format_;
+      const uint8_t* data_;
+      size_t len_;
+      size_t position_;
+      size_t record_len_;
+    };
+
+    RecordRange(uint8_t format, const uint8_t* data, size_t len)
+        : format_(format), data_(data), len_(len) {}
+
+    Iterator begin() const { return Iterator(format_, data_, len_, 0); }
+    Iterator end() const { return Iterator(format_, data_, len_, len_); }
+
+   private:
+    uint8_t format_;
+    const uint8_t* data_;
+    size_t len_;
+  };
+
+  /**
+   * Return a view of the records of |format| in the |data| array of length
+   * |len|
+   */
+  static RecordRange Records(uint8_t format, const uint8_t* data, size_t len) {
+    return RecordRange(format, data, len);
+  }
+
+  static RecordRange Records(uint8_t format, const std::vector<uint8_t>& data) {
+    return RecordRange(format, data.data(), data.size());
+  }
+
+  /**
+   * Return the length of the record of |format| at the start of the |data|
+   * array of length |len|, 0 if there is no whole record there.
+   */
+  static size_t RecordLength(uint8_t format, const uint8_t* data, size_t len) {
+    if (len < kTruncatedRecordLength) return 0;
+    if (format == kTruncated) return kTruncatedRecordLength;
+    if (format != kFull) return 0;
+
+    size_t position = kTruncatedRecordLength;
+    /* The advertising data, then the scan response */
+    for (int i = 0; i < 2; i++) {
+      if (position >= len) return 0;
+      position += 1 + data[position];
+    }
+    return position <= len ? position : 0;
+  }
+};
@@ -477,7 +477,9 @@ extern tBTM_STATUS BTM_SetPageScanType(uint16_t scan_type);
  *
  * Description      This function initiates a remote device HCI command to the
  *                  controller and calls the callback when the process has
- *                  completed.
+ *                  completed. A BR/EDR name received recently is given to
+ *                  the callback without paging the device, and a request
+ *                  made while another one is in progress waits for it.
  *
  * Input Params:    remote_bda      - device address of name to retrieve
  *                  p_cb            - callback function called when
@@ -488,7 +490,8 @@ extern tBTM_STATUS BTM_SetPageScanType(uint16_t scan_type);
  * Returns
  *                  BTM_CMD_STARTED is returned if the request was successfully
  *                                  sent to HCI.
- *                  BTM_BUSY if already in progress
+ *                  BTM_BUSY if already in progress and too many requests
+ *                           are waiting
  *                  BTM_UNKNOWN_ADDR if device address is bad
  *                  BTM_NO_RESOURCES if resources could not be allocated to
  *                                   start the command
@@ -499,6 +502,20 @@ extern tBTM_STATUS BTM_ReadRemoteDeviceName(const RawAddress& remote_bda,
                                             tBTM_CMPL_CB* p_cb,
                                             tBT_TRANSPORT transport);
 
+/*******************************************************************************
+ *
+ * Function         BTM_ReadRemoteDeviceNameWithPriority
+ *
+ * Description      This function is BTM_ReadRemoteDeviceName for a BR/EDR
+ *                  request that, if another one is in progress, waits for it
+ *                  behind the requests of a higher |priority|.
+ *                  BTM_ReadRemoteDeviceName is BTM_RMT_NAME_PRIORITY_USER.
+ *
+ ******************************************************************************/
+extern tBTM_STATUS BTM_ReadRemoteDeviceNameWithPriority(
+    const RawAddress& remote_bda, tBTM_CMPL_CB* p_cb, tBT_TRANSPORT transport,
+    tBTM_RMT_NAME_PRIORITY priority);
+
 /*******************************************************************************
  *
  * Function         BTM_CancelRemoteDeviceName
@@ -946,6 +963,66 @@ extern void BTM_EScoConnRsp(uint16_t sco_inx, uint8_t hci_status,
  ******************************************************************************/
 extern uint8_t BTM_GetNumScoLinks(void);
 
+/*******************************************************************************
+ *
+ * Function         BTM_WriteScoData
+ *
+ * Description      This function write SCO data to a specified instance. The
+ *                  data to be written p_buf needs to carry an offset of
+ *                  HCI_SCO_PREAMBLE_SIZE bytes, and the data length can not
+ *                  exceed BTM_SCO_DATA_SIZE_MAX bytes. Data longer than the
+ *                  maximum bytes will be truncated. p_buf is always consumed.
+ *
+ * Returns          BTM_SUCCESS: data write is successful
+ *                  BTM_ILLEGAL_VALUE: SCO data contains illegal offset value.
+ *                  BTM_SCO_BAD_LENGTH: SCO data length exceeds the max SCO
+ *                                      packet size.
+ *                  BTM_UNKNOWN_ADDR: unknown SCO connection handle, or SCO is
+ *                                    not routed via HCI.
+ *
+ ******************************************************************************/
+extern tBTM_STATUS BTM_WriteScoData(uint16_t sco_inx, BT_HDR* p_buf);
+
+/*******************************************************************************
+ *
+ * Function         BTM_ReadScoPcm
+ *
+ * Description      Called by the audio HAL to read up to len bytes of 16 bits
+ *                  little endian mono PCM decoded from the SCO link routed
+ *                  over HCI, at the rate given by BTM_ReadScoHciStats.
+ *
+ * Returns          number of bytes read, 0 when no call is routed over HCI or
+ *                  no audio is buffered yet.
+ *
+ ******************************************************************************/
+extern uint16_t BTM_ReadScoPcm(uint8_t* p_buf, uint16_t len);
+
+/*******************************************************************************
+ *
+ * Function         BTM_WriteScoPcm
+ *
+ * Description      Called by the audio HAL to queue len bytes of microphone
+ *                  PCM, in the format of BTM_ReadScoPcm, to send on the SCO
+ *                  link routed over HCI. When the link is consumed slower than
+ *                  written, the oldest audio is dropped to bound the latency.
+ *
+ * Returns          number of bytes queued, 0 when no call is routed over HCI.
+ *
+ ******************************************************************************/
+extern uint16_t BTM_WriteScoPcm(const uint8_t* p_buf, uint16_t len);
+
+/*******************************************************************************
+ *
+ * Function         BTM_ReadScoHciStats
+ *
+ * Description      Reads the statistics of the current call routed over HCI,
+ *                  or of the last one when none is active.
+ *
+ * Returns          true if a call is routed over HCI
+ *
+ ******************************************************************************/
+extern bool BTM_ReadScoHciStats(tBTM_SCO_HCI_STATS* p_stats);
+
 /*****************************************************************************
  *  SECURITY MANAGEMENT FUNCTIONS
  ****************************************************************************/
@@ -1465,6 +1542,57 @@ extern tBTM_STATUS BTM_SetSsrParams(const RawAddress& remote_bda,
                                     uint16_t max_lat, uint16_t min_rmt_to,
                                     uint16_t min_loc_to);
 
+/*******************************************************************************
+ *
+ * Function         BTM_PmGetIdleTimeout
+ *
+ * Description      This returns the delay after the latest packet to put the
+ *                  ACL connection to |bda| in sniff mode, learned from the
+ *                  gaps between its packets.
+ *
+ * Input Param      bda        - device address of desired ACL connection
+ *                  default_ms - delay given by the profiles
+ *
+ * Returns          the delay in milliseconds, within a factor of |default_ms|
+ *
+ ******************************************************************************/
+extern uint64_t BTM_PmGetIdleTimeout(const RawAddress& bda,
+                                     uint64_t default_ms);
+
+/*******************************************************************************
+ *
+ * Function         BTM_PmAdaptSniffMode
+ *
+ * Description      This lowers the maximum interval of the sniff mode
+ *                  |p_mode| about to be requested for the ACL connection to
+ *                  |bda| so that the link wakes up several times during its
+ *                  usual idle periods. The interval stays within the bounds
+ *                  of |p_mode|.
+ *
+ ******************************************************************************/
+extern void BTM_PmAdaptSniffMode(const RawAddress& bda,
+                                 tBTM_PM_PWR_MD* p_mode);
+
+/*******************************************************************************
+ *
+ * Function         stack_debug_btm_pm_dump
+ *
+ * Description      Dump the power mode changes of the ACL connections and
+ *                  their wake latency to |fd|.
+ *
+ ******************************************************************************/
+extern void stack_debug_btm_pm_dump(int fd);
+
+/*******************************************************************************
+ *
+ * Function         stack_debug_btm_rmt_name_dump
+ *
+ * Description      Dump the hit rate of the remote name cache and the time
+ *                  spent in remote name requests to |fd|.
+ *
+ ******************************************************************************/
+extern void stack_debug_btm_rmt_name_dump(int fd);
+
 /*******************************************************************************
  *
  * Function         BTM_GetHCIConnHandle
@@ -615,6 +615,32 @@ constexpr uint8_t PHY_LE_CODED = 0x04;
 constexpr uint8_t NO_ADI_PRESENT = 0xFF;
 constexpr uint8_t TX_POWER_NOT_PRESENT = 0x7F;
 
+/* Fields of the EIR of a BR/EDR inquiry result, decoded once by BTM for the
+ * results callback. The name is not copied out of the EIR: it is found at
+ * |name_offset| in the EIR data given along with the result.
+*/
+typedef struct {
+  uint8_t name_offset; /* 0 if the EIR has no name */
+  uint8_t name_len;
+  bool name_complete;  /* complete or shortened local name */
+  int8_t tx_power;     /* TX_POWER_NOT_PRESENT if the EIR has none */
+  uint8_t len;         /* significant part of the EIR, 0 if not decoded */
+  uint32_t hash;
+} tBTM_EIR_INFO;
+
+/* What changed since the last time an inquiry result of a device was
+ * reported. 0 (or BTM_INQ_CHANGED_NEW) means the result is to be taken as a
+ * whole. */
+#define BTM_INQ_CHANGED_NEW 0x01
+#define BTM_INQ_CHANGED_NAME 0x02
+#define BTM_INQ_CHANGED_SERVICES 0x04
+#define BTM_INQ_CHANGED_RSSI 0x08
+#define BTM_INQ_CHANGED_EIR 0x10 /* any other field of the EIR */
+#define BTM_INQ_CHANGED_ALL                                                \
+  (BTM_INQ_CHANGED_NEW | BTM_INQ_CHANGED_NAME | BTM_INQ_CHANGED_SERVICES | \
+   BTM_INQ_CHANGED_RSSI | BTM_INQ_CHANGED_EIR)
+typedef uint8_t tBTM_INQ_CHANGED;
+
 /* These are the fields returned in each device's response to the inquiry.  It
  * is returned in the results callback if registered.
 */
@@ -638,6 +664,9 @@ typedef struct {
   int8_t ble_tx_power;
   uint16_t ble_periodic_adv_int;
   uint8_t flag;
+  /* Only valid for the duration of the results callback of a BR/EDR result */
+  tBTM_EIR_INFO eir_info;
+  tBTM_INQ_CHANGED changed;
 } tBTM_INQ_RESULTS;
 
 /* This is the inquiry response information held in its database by BTM, and
@@ -674,6 +703,11 @@ typedef struct {
   BD_NAME remote_bd_name;
 } tBTM_REMOTE_DEV_NAME;
 
+/* Order in which remote name requests waiting for the one in progress run */
+#define BTM_RMT_NAME_PRIORITY_BACKGROUND 0
+#define BTM_RMT_NAME_PRIORITY_USER 1 /* the user is waiting for the name */
+typedef uint8_t tBTM_RMT_NAME_PRIORITY;
+
 typedef struct {
   uint8_t pcm_intf_rate; /* PCM interface rate: 0: 128kbps, 1: 256 kbps;
                              2:512 bps; 3: 1024kbps; 4: 2048kbps */
@@ -1002,6 +1036,25 @@ typedef struct {
   uint8_t air_mode;
 } tBTM_ESCO_DATA;
 
+/* Returned by BTM_ReadScoHciStats() */
+typedef struct {
+  uint32_t sample_rate;        /* 8000 (CVSD) or 16000 (mSBC) */
+  uint32_t rx_packets;         /* SCO packets received */
+  uint32_t rx_erroneous;       /* packets flagged damaged by the controller */
+  uint32_t rx_frames;          /* mSBC frames or CVSD packets decoded */
+  uint32_t plc_frames;         /* of rx_frames, replaced by concealment */
+  uint32_t rx_sync_lost;       /* mSBC H2 header searches */
+  uint32_t rx_seq_errors;      /* mSBC H2 sequence number gaps */
+  uint32_t rx_overrun_bytes;   /* dropped because the audio HAL read late */
+  uint32_t tx_packets;         /* SCO packets sent */
+  uint32_t tx_underruns;       /* frames padded with silence */
+  uint32_t tx_overrun_bytes;   /* dropped because the audio HAL wrote early */
+  uint32_t rx_latency_avg_ms;  /* speaker audio buffered for the audio HAL */
+  uint32_t rx_latency_max_ms;
+  uint32_t tx_latency_max_ms;  /* microphone audio buffered for the link */
+  uint64_t duration_ms;
+} tBTM_SCO_HCI_STATS;
+
 typedef struct {
   uint16_t sco_inx;
   uint16_t rx_pkt_len;
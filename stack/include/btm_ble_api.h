@@ -711,6 +711,18 @@ extern void BTM_LE_PF_clear(tBTM_BLE_PF_FILT_INDEX filt_index,
 extern void BTM_BleEnableDisableFilterFeature(
     uint8_t enable, tBTM_BLE_PF_STATUS_CBACK p_stat_cback);
 
+/*******************************************************************************
+ *
+ * Function         BTM_BleHostFilterMaxFilters
+ *
+ * Description      Get the number of scan filters run by the host for a
+ *                  controller without APCF
+ *
+ * Returns          The number of filters, 0 if the host side filtering is off
+ *
+ ******************************************************************************/
+extern uint8_t BTM_BleHostFilterMaxFilters(void);
+
 /*******************************************************************************
  *
  * Function         BTM_BleGetEnergyInfo
@@ -779,4 +791,14 @@ extern void BTM_BleSetPhy(const RawAddress& bd_addr, uint8_t tx_phys,
 
 extern void btm_ble_multi_adv_cleanup(void);
 
+/*******************************************************************************
+ *
+ * Function         stack_debug_btm_ble_dump
+ *
+ * Description      Dump the statistics of the syncs of the LE controller lists
+ *                  to |fd|.
+ *
+ ******************************************************************************/
+extern void stack_debug_btm_ble_dump(int fd);
+
 #endif
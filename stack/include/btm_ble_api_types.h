@@ -159,6 +159,15 @@ typedef uint8_t tBTM_BLE_SFP;
 #define BTM_BLE_SCAN_SLOW_WIN_1 48 /* 30 ms = 48 *0.625 */
 #endif
 
+/* default scan paramter used while recently disconnected devices are expected
+ * to reconnect */
+#ifndef BTM_BLE_SCAN_MEDIUM_INT
+#define BTM_BLE_SCAN_MEDIUM_INT 512 /* 320 ms = 512 *0.625 */
+#endif
+#ifndef BTM_BLE_SCAN_MEDIUM_WIN
+#define BTM_BLE_SCAN_MEDIUM_WIN 48 /* 30 ms = 48 *0.625 */
+#endif
+
 /* default scan paramter used in reduced power cycle (background scanning) */
 #ifndef BTM_BLE_SCAN_SLOW_INT_2
 #define BTM_BLE_SCAN_SLOW_INT_2 4096 /* 2.56 s   = 4096 *0.625 */
@@ -419,6 +428,10 @@ typedef struct {
 #ifndef BTM_BLE_PF_STR_LEN_MAX
 #define BTM_BLE_PF_STR_LEN_MAX 29 /* match for first 29 bytes */
 #endif
+/* filters offered by the host side filtering, without APCF in the controller */
+#ifndef BTM_BLE_HOST_PF_MAX_FILTERS
+#define BTM_BLE_HOST_PF_MAX_FILTERS 16
+#endif
 
 typedef uint8_t tBTM_BLE_PF_COND_TYPE;
 
@@ -0,0 +1,105 @@
+/******************************************************************************
+ *
+ *  Copyright 2020 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This file contains the definitions of the LE isochronous (ISO) data path.
+ *
+ *  Received ISO data packets are reassembled into SDUs on the ISO shard of
+ *  BTU, never on the main thread, and queued in order of sequence number on
+ *  the stream of their CIS or BIS connection handle. Missing sequence numbers
+ *  are queued as lost SDUs, so that the consumer can conceal them. The
+ *  consumer, usually an audio thread, reads the queue without a lock.
+ *
+ ******************************************************************************/
+#ifndef BTM_ISO_API_H
+#define BTM_ISO_API_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bt_types.h"
+
+/* Status of an SDU, as the Packet_Status_Flag of the HCI ISO data packets */
+typedef enum : uint8_t {
+  BTM_ISO_SDU_VALID = 0,
+  BTM_ISO_SDU_POSSIBLY_INVALID = 1,
+  BTM_ISO_SDU_LOST = 2,
+} tBTM_ISO_SDU_STATUS;
+
+typedef struct {
+  /* Time_Stamp given by the controller, in us, 0 if there was none */
+  uint32_t time_stamp;
+  uint16_t seq_num;
+  tBTM_ISO_SDU_STATUS status;
+  /* Length of the SDU, 0 for a lost SDU */
+  uint16_t len;
+  /* Boottime, in us, at which the last fragment reached the host */
+  uint64_t rx_timestamp_us;
+} tBTM_ISO_SDU;
+
+typedef struct tBTM_ISO_STREAM tBTM_ISO_STREAM;
+
+/*******************************************************************************
+ *
+ * Function         BTM_IsoStreamOpen
+ *
+ * Description      Starts queueing the SDUs received for the CIS or BIS
+ *                  |handle|, up to |depth| SDUs of at most |max_sdu_len|
+ *                  bytes. Longer SDUs are dropped, as are the SDUs received
+ *                  while the queue is full.
+ *
+ * Returns          the stream to read the SDUs from
+ *
+ ******************************************************************************/
+extern tBTM_ISO_STREAM* BTM_IsoStreamOpen(uint16_t handle,
+                                          uint16_t max_sdu_len, size_t depth);
+
+/*******************************************************************************
+ *
+ * Function         BTM_IsoStreamClose
+ *
+ * Description      Stops queueing the SDUs of |stream| and frees it. The
+ *                  consumer must be done reading it.
+ *
+ ******************************************************************************/
+extern void BTM_IsoStreamClose(tBTM_ISO_STREAM* stream);
+
+/*******************************************************************************
+ *
+ * Function         BTM_IsoStreamRead
+ *
+ * Description      Takes the oldest SDU off |stream|, and copies up to
+ *                  |buf_len| bytes of it to |p_buf|; the rest is dropped.
+ *                  Only one thread may read a given stream at a time.
+ *
+ * Returns          true and fills |p_sdu|, with the |len| copied, if there
+ *                  was an SDU, false otherwise
+ *
+ ******************************************************************************/
+extern bool BTM_IsoStreamRead(tBTM_ISO_STREAM* stream, tBTM_ISO_SDU* p_sdu,
+                              uint8_t* p_buf, uint16_t buf_len);
+
+/* Handles an HCI ISO data packet received at |rx_timestamp_us|, on the ISO
+ * shard. Takes ownership of |p_msg|. */
+extern void btm_iso_data_received(BT_HDR* p_msg, uint64_t rx_timestamp_us);
+
+/* Dump the SDU counters and the latency histograms of the ISO data path */
+extern void stack_debug_btm_iso_dump(int fd);
+
+#endif
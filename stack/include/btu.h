@@ -48,12 +48,16 @@ void btu_hcif_send_cmd_with_cb(const base::Location& posted_from,
                                uint16_t opcode, uint8_t* params,
                                uint8_t params_len,
                                base::OnceCallback<void(uint8_t*, uint16_t)> cb);
+/* Dump the HCI event processing time and command context counters */
+void stack_debug_btu_hcif_dump(int fd);
 
 /* Functions provided by btu_init.cc
  ***********************************
 */
 void btu_init_core(void);
 void btu_free_core(void);
+/* Dump the memory taken by the control blocks of the stack */
+void stack_debug_btu_footprint_dump(int fd);
 
 /* Functions provided by btu_task.cc
  ***********************************
@@ -66,6 +70,66 @@ bt_status_t do_in_main_thread_delayed(const base::Location& from_here,
                                       base::OnceClosure task,
                                       const base::TimeDelta& delay);
 
+/* Pipelines of the stack that can run on a thread of their own instead of the
+ * main thread.
+ *
+ * The state of a pipeline is owned by its shard: it is only ever touched by
+ * tasks posted with do_in_shard_thread(), never locked. Anything the pipeline
+ * needs from the main thread is copied into the task that hands work over to
+ * it, and its results are handed back to the main thread by value with
+ * do_in_main_thread(). A shard without a thread of its own runs on the main
+ * thread, so that the pipeline behaves the same either way.
+ */
+typedef enum {
+  /* Reassembly and duplicate filtering of LE advertising reports */
+  BTU_SHARD_LE_SCAN,
+  /* Reassembly and queueing of the SDUs of the LE isochronous streams */
+  BTU_SHARD_ISO,
+  BTU_SHARD_MAX
+} tBTU_SHARD;
+
+/* Returns true if |shard| runs on a thread of its own */
+bool btu_shard_is_threaded(tBTU_SHARD shard);
+bt_status_t do_in_shard_thread(tBTU_SHARD shard,
+                               const base::Location& from_here,
+                               base::OnceClosure task);
+
+/* Returns the time, in boottime microseconds, at which the HCI packet being
+ * processed on the main thread was received from the HCI layer, or 0 when not
+ * processing an HCI packet */
+uint64_t btu_get_rx_timestamp_us(void);
+
+/* Functions provided by btu_buffer_budget.cc
+ ********************************************
+ *
+ * Budget on the data buffers held in the queues of the stack. Each queue
+ * charges the bytes it holds and releases them when they leave it. A channel
+ * holding more than its share of the budget, or any channel holding data once
+ * the whole budget is used, is to be flow controlled by its owner.
+ */
+typedef enum {
+  BTU_BUDGET_RFCOMM_RX, /* received data not read by the RFCOMM user */
+  BTU_BUDGET_RFCOMM_TX, /* data waiting for RFCOMM credits or flow */
+  BTU_BUDGET_SOCK_RX,   /* received data not read by the socket app */
+  BTU_BUDGET_QUEUE_MAX
+} tBTU_BUDGET_QUEUE;
+
+/* Sets the budget to |limit| bytes, 0 for no budget, and resets the counts */
+void btu_budget_init(size_t limit);
+/* Counts a channel in and out of the ones sharing the budget */
+void btu_budget_add_channel(void);
+void btu_budget_remove_channel(void);
+void btu_budget_charge(tBTU_BUDGET_QUEUE queue, size_t len);
+void btu_budget_release(tBTU_BUDGET_QUEUE queue, size_t len);
+/* Returns the share of the budget of one channel, 0 if there is no budget */
+size_t btu_budget_channel_quota(void);
+/* Returns true if a channel holding |channel_len| bytes is over budget */
+bool btu_budget_exceeded(size_t channel_len);
+/* Returns true if the whole budget is used */
+bool btu_budget_exhausted(void);
+/* Dump the bytes held in each kind of queue against the budget */
+void stack_debug_btu_budget_dump(int fd);
+
 void BTU_StartUp(void);
 void BTU_ShutDown(void);
 
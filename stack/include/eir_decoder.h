@@ -0,0 +1,141 @@
+/******************************************************************************
+ *
+ *  Copyright 2020 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "advertise_data_parser.h"
+
+/**
+ * Decoder of the fields of an Extended Inquiry Response reported by the
+ * inquiry: the local name, the TX power level and the lists of service UUIDs.
+ * They are all found in a single pass, with the same precedence as looking
+ * them up one by one with AdvertiseDataParser::GetFieldByType: the first
+ * complete field of a kind wins over the first shortened one.
+ */
+class EirDecoder {
+ public:
+  /* EIR data types */
+  static constexpr uint8_t kMore16BitUuids = 0x02;
+  static constexpr uint8_t kComplete16BitUuids = 0x03;
+  static constexpr uint8_t kMore32BitUuids = 0x04;
+  static constexpr uint8_t kComplete32BitUuids = 0x05;
+  static constexpr uint8_t kMore128BitUuids = 0x06;
+  static constexpr uint8_t kComplete128BitUuids = 0x07;
+  static constexpr uint8_t kShortenedName = 0x08;
+  static constexpr uint8_t kCompleteName = 0x09;
+  static constexpr uint8_t kTxPowerLevel = 0x0a;
+
+  /* Index of the UUID lists in Result::uuids */
+  static constexpr int k16BitUuids = 0;
+  static constexpr int k32BitUuids = 1;
+  static constexpr int k128BitUuids = 2;
+
+  /* A field, pointing inside the EIR it was decoded from */
+  struct Data {
+    const uint8_t* data;
+    uint8_t length;
+    bool complete; /* complete or shortened name, complete or partial list */
+  };
+
+  struct Result {
+    Data name;
+    Data uuids[3];
+    bool has_tx_power;
+    int8_t tx_power;
+    /* Length of the EIR without the zero padding at its end */
+    size_t length;
+    /* FNV-1a hash of these |length| bytes */
+    uint32_t hash;
+  };
+
+  /**
+   * Decode the |eir| array of length |eir_len|. A field the EIR does not have
+   * is left with a null |data|.
+   */
+  static Result Decode(const uint8_t* eir, size_t eir_len) {
+    Result result = {};
+    uint32_t hash = kFnvOffsetBasis;
+    for (const AdvertiseDataParser::Field& field :
+         AdvertiseDataParser::Fields(eir, eir_len)) {
+      switch (field.type) {
+        case kCompleteName:
+          Keep(&result.name, field, true);
+          break;
+        case kShortenedName:
+          Keep(&result.name, field, false);
+          break;
+        case kComplete16BitUuids:
+        case kMore16BitUuids:
+          Keep(&result.uuids[k16BitUuids], field,
+               field.type == kComplete16BitUuids);
+          break;
+        case kComplete32BitUuids:
+        case kMore32BitUuids:
+          Keep(&result.uuids[k32BitUuids], field,
+               field.type == kComplete32BitUuids);
+          break;
+        case kComplete128BitUuids:
+        case kMore128BitUuids:
+          Keep(&result.uuids[k128BitUuids], field,
+               field.type == kComplete128BitUuids);
+          break;
+        case kTxPowerLevel:
+          if (!result.has_tx_power && field.length >= 1) {
+            result.has_tx_power = true;
+            result.tx_power = static_cast<int8_t>(field.data[0]);
+          }
+          break;
+        default:
+          break;
+      }
+
+      /* the length and type bytes of the field, then its data */
+      const uint8_t* field_end = field.data + field.length;
+      for (const uint8_t* p = field.data - 2; p < field_end; p++) {
+        hash = (hash ^ *p) * kFnvPrime;
+      }
+      result.length = field_end - eir;
+    }
+    result.hash = hash;
+    return result;
+  }
+
+  /**
+   * FNV-1a hash of the |len| bytes of |data|, the one of Result::hash.
+   */
+  static uint32_t Hash(const uint8_t* data, size_t len) {
+    uint32_t hash = kFnvOffsetBasis;
+    for (size_t i = 0; i < len; i++) hash = (hash ^ data[i]) * kFnvPrime;
+    return hash;
+  }
+
+ private:
+  static constexpr uint32_t kFnvOffsetBasis = 2166136261u;
+  static constexpr uint32_t kFnvPrime = 16777619u;
+
+  static void Keep(Data* p_data, const AdvertiseDataParser::Field& field,
+                   bool complete) {
+    if (p_data->complete || (p_data->data != nullptr && !complete)) return;
+    p_data->data = field.data;
+    p_data->length = field.length;
+    p_data->complete = complete;
+  }
+};
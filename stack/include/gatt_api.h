@@ -44,6 +44,7 @@
 #define GATT_INSUF_ENCRYPTION 0x0f
 #define GATT_UNSUPPORT_GRP_TYPE 0x10
 #define GATT_INSUF_RESOURCE 0x11
+#define GATT_VALUE_NOT_ALLOWED 0x13
 
 #define GATT_ILLEGAL_PARAMETER 0x87
 #define GATT_NO_RESOURCES 0x80
@@ -105,10 +106,13 @@ typedef uint8_t tGATT_STATUS;
 #define GATT_HANDLE_VALUE_NOTIF 0x1B
 #define GATT_HANDLE_VALUE_IND 0x1D
 #define GATT_HANDLE_VALUE_CONF 0x1E
+#define GATT_REQ_READ_MULTI_VAR 0x20
+#define GATT_RSP_READ_MULTI_VAR 0x21
+#define GATT_HANDLE_MULTI_VALUE_NOTIF 0x23
 /* changed in V4.0 1101-0010 (signed write)  see write cmd above*/
 #define GATT_SIGN_CMD_WRITE 0xD2
-/* 0x1E = 30 + 1 = 31*/
-#define GATT_OP_CODE_MAX (GATT_HANDLE_VALUE_CONF + 1)
+/* 0x23 = 35 + 1 = 36*/
+#define GATT_OP_CODE_MAX (GATT_HANDLE_MULTI_VALUE_NOTIF + 1)
 
 #define GATT_HANDLE_IS_VALID(x) ((x) != 0)
 
@@ -328,6 +332,14 @@ typedef struct {
   uint8_t value[GATT_MAX_ATTR_LEN]; /* the actual attribute value */
 } tGATT_VALUE;
 
+/* Handle value notification, as sent by GATTS_HandleValueNotifications */
+typedef struct {
+  uint16_t conn_id;
+  uint16_t handle; /* attribute handle */
+  uint16_t len;    /* length of attribute value */
+  uint8_t* p_value;
+} tGATT_NOTIFICATION;
+
 /* Union of the event data which is used in the server respond API to carry the
  * server response information
 */
@@ -418,6 +430,7 @@ enum {
   GATT_READ_MULTIPLE,
   GATT_READ_CHAR_VALUE,
   GATT_READ_PARTIAL,
+  GATT_READ_MULTIPLE_VAR_LEN,
   GATT_READ_MAX
 };
 typedef uint8_t tGATT_READ_TYPE;
@@ -431,7 +444,7 @@ typedef struct {
   bluetooth::Uuid uuid;
 } tGATT_READ_BY_TYPE;
 
-/*   GATT_READ_MULTIPLE request data
+/*   GATT_READ_MULTIPLE and GATT_READ_MULTIPLE_VAR_LEN request data
 */
 #define GATT_MAX_READ_MULTI_HANDLES \
   10 /* Max attributes to read in one request */
@@ -772,6 +785,53 @@ extern tGATT_STATUS GATTS_HandleValueNotification(uint16_t conn_id,
                                                   uint16_t val_len,
                                                   uint8_t* p_val);
 
+/*******************************************************************************
+ *
+ * Function         GATTS_HandleValueNotifications
+ *
+ * Description      This function sends handle value notifications to one or
+ *                  more clients. Notifications for the same connection are
+ *                  handed to L2CAP together, in order, and stop at the first
+ *                  one that the link can't take because it is congested.
+ *
+ * Parameter        p_notifs: notifications to send.
+ *                  num_notifs: number of notifications.
+ *                  p_num_sent: set to the number of notifications sent. The
+ *                              remaining ones can be sent again once the
+ *                              congestion callback reports that the link is
+ *                              no longer congested.
+ *
+ * Returns          GATT_SUCCESS if all notifications were sent, GATT_CONGESTED
+ *                  if a link is congested; otherwise error code for the first
+ *                  notification not sent.
+ *
+ ******************************************************************************/
+extern tGATT_STATUS GATTS_HandleValueNotifications(
+    const tGATT_NOTIFICATION* p_notifs, uint16_t num_notifs,
+    uint16_t* p_num_sent);
+
+/*******************************************************************************
+ *
+ * Function         GATTS_HandleMultipleValueNotification
+ *
+ * Description      This function sends the values of several attributes to a
+ *                  client in one Multiple Handle Value Notification PDU. The
+ *                  client must have enabled it in its Client Supported
+ *                  Features; otherwise the values should be sent with
+ *                  GATTS_HandleValueNotifications.
+ *
+ * Parameter        p_notifs: notifications to send, all for the same
+ *                            connection.
+ *                  num_notifs: number of notifications, at least two.
+ *
+ * Returns          GATT_SUCCESS if sucessfully sent, GATT_REQ_NOT_SUPPORTED
+ *                  if the client does not support the PDU, GATT_NO_RESOURCES
+ *                  if the values do not fit in the MTU; otherwise error code.
+ *
+ ******************************************************************************/
+extern tGATT_STATUS GATTS_HandleMultipleValueNotification(
+    const tGATT_NOTIFICATION* p_notifs, uint16_t num_notifs);
+
 /*******************************************************************************
  *
  * Function         GATTS_SendRsp
@@ -789,6 +849,69 @@ extern tGATT_STATUS GATTS_HandleValueNotification(uint16_t conn_id,
 extern tGATT_STATUS GATTS_SendRsp(uint16_t conn_id, uint32_t trans_id,
                                   tGATT_STATUS status, tGATTS_RSP* p_msg);
 
+/*******************************************************************************
+ *
+ * Function         GATTS_SetCachedValue
+ *
+ * Description      This function sets the value of a characteristic or
+ *                  descriptor for the stack to answer the Read, Read Blob,
+ *                  Read Multiple and Read By Type requests of all clients,
+ *                  at any offset, without a read request to the
+ *                  application. The application calls it again whenever the
+ *                  value changes. The value is held until invalidated, or
+ *                  until a client writes the attribute. The permissions of
+ *                  the attribute are still checked by the stack.
+ *
+ * Parameter        gatt_if: application interface owning the service.
+ *                  attr_handle: handle of the characteristic value or
+ *                               descriptor.
+ *                  p_value: the value.
+ *                  len: length of the value, up to GATT_MAX_ATTR_LEN.
+ *
+ * Returns          GATT_SUCCESS if cached, GATT_INVALID_HANDLE if the
+ *                  attribute is not a characteristic value or a per client
+ *                  descriptor of a service of |gatt_if|; otherwise error code.
+ *
+ ******************************************************************************/
+extern tGATT_STATUS GATTS_SetCachedValue(tGATT_IF gatt_if,
+                                         uint16_t attr_handle,
+                                         const uint8_t* p_value, uint16_t len);
+
+/*******************************************************************************
+ *
+ * Function         GATTS_InvalidateCachedValue
+ *
+ * Description      This function drops the value cached by
+ *                  GATTS_SetCachedValue; the next reads of the attribute are
+ *                  sent to the application again.
+ *
+ * Parameter        gatt_if: application interface owning the service.
+ *                  attr_handle: handle of the attribute.
+ *
+ * Returns          GATT_SUCCESS if successful; otherwise error code.
+ *
+ ******************************************************************************/
+extern tGATT_STATUS GATTS_InvalidateCachedValue(tGATT_IF gatt_if,
+                                                uint16_t attr_handle);
+
+/*******************************************************************************
+ *
+ * Function         GATTS_GetCachedValueHits
+ *
+ * Description      This function gets how many reads of the attribute were
+ *                  answered from its cached value so far.
+ *
+ * Parameter        gatt_if: application interface owning the service.
+ *                  attr_handle: handle of the attribute.
+ *                  p_hits: output parameter for the count.
+ *
+ * Returns          GATT_SUCCESS if successful; otherwise error code.
+ *
+ ******************************************************************************/
+extern tGATT_STATUS GATTS_GetCachedValueHits(tGATT_IF gatt_if,
+                                             uint16_t attr_handle,
+                                             uint32_t* p_hits);
+
 /******************************************************************************/
 /* GATT Profile Client Functions */
 /******************************************************************************/
@@ -832,6 +832,30 @@ extern uint16_t L2CA_SendFixedChnlData(uint16_t fixed_cid,
                                        const RawAddress& rem_bda,
                                        BT_HDR* p_buf);
 
+/*******************************************************************************
+ *
+ *  Function        L2CA_SendFixedChnlDataBatch
+ *
+ *  Description     Write several buffers on a fixed channel, scheduling the
+ *                  link once for all of them.
+ *
+ *  Parameters:     Fixed CID
+ *                  BD Address of remote
+ *                  Array of pointers to buffers of type BT_HDR
+ *                  Number of buffers
+ *                  Number of buffers handed over to L2CAP, set on return.
+ *                  The remaining buffers stay owned by the caller.
+ *
+ * Return value     L2CAP_DW_SUCCESS, if all buffers accepted
+ *                  L2CAP_DW_CONGESTED, if the channel is congested
+ *                  L2CAP_DW_FAILED,  if error
+ *
+ ******************************************************************************/
+extern uint16_t L2CA_SendFixedChnlDataBatch(uint16_t fixed_cid,
+                                            const RawAddress& rem_bda,
+                                            BT_HDR** p_bufs, uint16_t num_bufs,
+                                            uint16_t* p_num_sent);
+
 /*******************************************************************************
  *
  *  Function        L2CA_RemoveFixedChnl
@@ -945,4 +969,16 @@ extern uint16_t L2CA_GetDisconnectReason(const RawAddress& remote_bda,
 extern void L2CA_AdjustConnectionIntervals(uint16_t* min_interval,
                                            uint16_t* max_interval,
                                            uint16_t floor_interval);
+
+/*******************************************************************************
+ *
+ * Function         stack_debug_l2cap_api_dump
+ *
+ * Description      Dump the transmit quotas and statistics of the connected
+ *                  ACL links, the tuning of the LE ones and the statistics of
+ *                  their channels to |fd|.
+ *
+ ******************************************************************************/
+extern void stack_debug_l2cap_api_dump(int fd);
+
 #endif /* L2C_API_H */
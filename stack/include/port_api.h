@@ -79,6 +79,9 @@ typedef int(tPORT_DATA_CALLBACK)(uint16_t port_handle, void* p_data,
 #define DATA_CO_CALLBACK_TYPE_INCOMING 1
 #define DATA_CO_CALLBACK_TYPE_OUTGOING_SIZE 2
 #define DATA_CO_CALLBACK_TYPE_OUTGOING 3
+/* |p_buf| is an array of |len| BT_HDR pointers with their offset and len set,
+ * to be filled with outgoing data at once */
+#define DATA_CO_CALLBACK_TYPE_OUTGOING_BUFFERS 4
 typedef int(tPORT_DATA_CO_CALLBACK)(uint16_t port_handle, uint8_t* p_buf,
                                     uint16_t len, int type);
 
@@ -422,4 +425,14 @@ extern uint8_t PORT_SetTraceLevel(uint8_t new_level);
  ******************************************************************************/
 extern const char* PORT_GetResultString(const uint8_t result_code);
 
+/*******************************************************************************
+ *
+ * Function         stack_debug_rfcomm_api_dump
+ *
+ * Description      Dump the flow control state and traffic counters of the
+ *                  open RFCOMM ports to |fd|.
+ *
+ ******************************************************************************/
+extern void stack_debug_rfcomm_api_dump(int fd);
+
 #endif /* PORT_API_H */
@@ -118,6 +118,7 @@ typedef struct {
   uint16_t num_attr_filters; /* Number of attribute filters  */
   uint16_t attr_filters[SDP_MAX_ATTR_FILTERS]; /* Attributes to filter */
   uint8_t* p_free_mem; /* Pointer to free memory       */
+  bool skip_cache; /* Query the peer even if its records are in the cache */
 #if (SDP_RAW_DATA_INCLUDED == TRUE)
   uint8_t*
       raw_data; /* Received record from server. allocated/released by client  */
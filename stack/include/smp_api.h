@@ -43,6 +43,30 @@
  ******************************************************************************/
 extern void SMP_Init(void);
 
+/*******************************************************************************
+ *
+ * Function         SMP_Free
+ *
+ * Description      This function releases the resources of the SMP unit.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+extern void SMP_Free(void);
+
+/*******************************************************************************
+ *
+ * Function         SMP_RefillKeyPool
+ *
+ * Description      This function starts filling the pool of precomputed local
+ *                  key pairs, e.g. once the controller is ready. It may be
+ *                  called from any thread.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+extern void SMP_RefillKeyPool(void);
+
 /*******************************************************************************
  *
  * Function         SMP_SetTraceLevel
@@ -209,4 +233,14 @@ extern bool smp_proc_ltk_request(const RawAddress& bda);
 // Proceed to send LTK, DIV and ER to master if bonding the devices.
 extern void smp_link_encrypted(const RawAddress& bda, uint8_t encr_enable);
 
+/*******************************************************************************
+ *
+ * Function         stack_debug_smp_api_dump
+ *
+ * Description      Dump the state of the pool of precomputed local key pairs
+ *                  to |fd|.
+ *
+ ******************************************************************************/
+extern void stack_debug_smp_api_dump(int fd);
+
 #endif /* SMP_API_H */
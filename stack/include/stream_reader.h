@@ -0,0 +1,189 @@
+/******************************************************************************
+ *
+ *  Copyright 2020 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <optional>
+#include <tuple>
+#include <utility>
+
+#include "bt_types.h"
+
+/**
+ * Encoding of a field of a PDU, as read by the STREAM_TO_* macros: integers
+ * are little endian, and addresses are in the reverse order of RawAddress.
+ */
+template <typename T>
+struct StreamField;
+
+template <>
+struct StreamField<uint8_t> {
+  static constexpr size_t kSize = 1;
+  static uint8_t Get(const uint8_t* p) { return p[0]; }
+};
+
+template <>
+struct StreamField<int8_t> {
+  static constexpr size_t kSize = 1;
+  static int8_t Get(const uint8_t* p) { return static_cast<int8_t>(p[0]); }
+};
+
+template <>
+struct StreamField<uint16_t> {
+  static constexpr size_t kSize = 2;
+  static uint16_t Get(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+  }
+};
+
+template <>
+struct StreamField<uint32_t> {
+  static constexpr size_t kSize = 4;
+  static uint32_t Get(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) |
+           (static_cast<uint32_t>(p[3]) << 24);
+  }
+};
+
+template <>
+struct StreamField<RawAddress> {
+  static constexpr size_t kSize = BD_ADDR_LEN;
+  static RawAddress Get(const uint8_t* p) {
+    RawAddress address;
+    for (size_t i = 0; i < BD_ADDR_LEN; i++) {
+      address.address[i] = p[BD_ADDR_LEN - 1 - i];
+    }
+    return address;
+  }
+};
+
+/**
+ * Layout of a run of fixed size fields, known at compile time. Its size is
+ * checked once for all fields, and every field is then read at a constant
+ * offset.
+ */
+template <typename... Fields>
+struct StreamLayout {
+  using Tuple = std::tuple<Fields...>;
+
+  static constexpr size_t kSize = (StreamField<Fields>::kSize + ... + 0);
+
+  /* Read the fields from |p|, which must have at least kSize bytes */
+  static Tuple Get(const uint8_t* p) {
+    return Get(p, std::index_sequence_for<Fields...>());
+  }
+
+ private:
+  static constexpr size_t Offset(size_t index) {
+    constexpr size_t sizes[] = {StreamField<Fields>::kSize..., 0};
+    size_t offset = 0;
+    for (size_t i = 0; i < index; i++) offset += sizes[i];
+    return offset;
+  }
+
+  template <size_t... I>
+  static Tuple Get(const uint8_t* p, std::index_sequence<I...>) {
+    return Tuple(StreamField<Fields>::Get(p + Offset(I))...);
+  }
+};
+
+/**
+ * Reader of the fields of a PDU of |length| bytes at |data|, to be used
+ * instead of the unchecked STREAM_TO_* macros. A read past the end fails and
+ * leaves the reader empty, so that all following reads fail too: a parser can
+ * read all the fields it needs and only check the result of the last read, or
+ * Ok().
+ */
+class StreamReader {
+ public:
+  StreamReader(const uint8_t* data, size_t length)
+      : p_(data), end_(data + length) {}
+
+  /* Number of bytes left to read */
+  size_t Remaining() const { return end_ - p_; }
+
+  /* Whether no read failed so far */
+  bool Ok() const { return ok_; }
+
+  /* The bytes left to read */
+  const uint8_t* Data() const { return p_; }
+
+  /**
+   * Read all the fields of |Layout| with a single length check. Returns
+   * nullopt if less than Layout::kSize bytes are left.
+   */
+  template <typename Layout>
+  std::optional<typename Layout::Tuple> Read() {
+    const uint8_t* p = Skip(Layout::kSize);
+    if (p == nullptr) return std::nullopt;
+    return Layout::Get(p);
+  }
+
+  /**
+   * Read one field into each of |values|, in order, with a single length
+   * check. Returns false, and leaves |values| unchanged, if they do not fit
+   * in the bytes left.
+   */
+  template <typename... T>
+  bool Read(T*... values) {
+    auto fields = Read<StreamLayout<T...>>();
+    if (!fields) return false;
+    std::tie(*values...) = *fields;
+    return true;
+  }
+
+  /**
+   * Skip |length| bytes. Returns a pointer to them, or nullptr if less than
+   * |length| bytes are left.
+   */
+  const uint8_t* Skip(size_t length) {
+    if (length > Remaining()) {
+      Fail();
+      return nullptr;
+    }
+    const uint8_t* p = p_;
+    p_ += length;
+    return p;
+  }
+
+  /**
+   * Split off a reader of the next |length| bytes, which this reader skips.
+   * If less than |length| bytes are left, both readers fail.
+   */
+  StreamReader Sub(size_t length) {
+    const uint8_t* p = Skip(length);
+    if (p == nullptr) return StreamReader();
+    return StreamReader(p, length);
+  }
+
+ private:
+  StreamReader() : p_(nullptr), end_(nullptr), ok_(false) {}
+
+  void Fail() {
+    p_ = end_;
+    ok_ = false;
+  }
+
+  const uint8_t* p_;
+  const uint8_t* end_;
+  bool ok_ = true;
+};
@@ -26,6 +26,7 @@
 
 #include <base/logging.h>
 #include <base/strings/stringprintf.h>
+#include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -34,6 +35,7 @@
 #include "bt_types.h"
 #include "btm_api.h"
 #include "btu.h"
+#include "common/time_util.h"
 #include "device/include/controller.h"
 #include "hcidefs.h"
 #include "hcimsgs.h"
@@ -1513,24 +1515,21 @@ bool L2CA_ConnectFixedChnl(uint16_t fixed_cid, const RawAddress& rem_bda,
 
 /*******************************************************************************
  *
- *  Function        L2CA_SendFixedChnlData
+ *  Function        l2c_find_fixed_ccb_for_data
  *
- *  Description     Write data on a fixed channel.
+ *  Description     Find the CCB to send data with on a fixed channel, creating
+ *                  it if needed.
  *
  *  Parameters:     Fixed CID
  *                  BD Address of remote
- *                  Pointer to buffer of type BT_HDR
+ *                  Pointer to the LCB of the link, set on success
  *
- * Return value     L2CAP_DW_SUCCESS, if data accepted
- *                  L2CAP_DW_FAILED,  if error
+ * Return value     Pointer to the CCB, or NULL if data can't be sent
  *
  ******************************************************************************/
-uint16_t L2CA_SendFixedChnlData(uint16_t fixed_cid, const RawAddress& rem_bda,
-                                BT_HDR* p_buf) {
-  if (bluetooth::shim::is_gd_shim_enabled()) {
-    return bluetooth::shim::L2CA_SendFixedChnlData(fixed_cid, rem_bda, p_buf);
-  }
-
+static tL2C_CCB* l2c_find_fixed_ccb_for_data(uint16_t fixed_cid,
+                                            const RawAddress& rem_bda,
+                                            tL2C_LCB** pp_lcb) {
   tL2C_LCB* p_lcb;
   tBT_TRANSPORT transport = BT_TRANSPORT_BR_EDR;
 
@@ -1547,16 +1546,14 @@ uint16_t L2CA_SendFixedChnlData(uint16_t fixed_cid, const RawAddress& rem_bda,
        NULL)) {
     L2CAP_TRACE_ERROR("L2CA_SendFixedChnlData()  Invalid CID: 0x%04x",
                       fixed_cid);
-    osi_free(p_buf);
-    return (L2CAP_DW_FAILED);
+    return NULL;
   }
 
   // Fail if BT is not yet up
   if (!BTM_IsDeviceUp()) {
     L2CAP_TRACE_WARNING("L2CA_SendFixedChnlData(0x%04x) - BTU not ready",
                         fixed_cid);
-    osi_free(p_buf);
-    return (L2CAP_DW_FAILED);
+    return NULL;
   }
 
   // We need to have a link up
@@ -1564,8 +1561,7 @@ uint16_t L2CA_SendFixedChnlData(uint16_t fixed_cid, const RawAddress& rem_bda,
   if (p_lcb == NULL || p_lcb->link_state == LST_DISCONNECTING) {
     /* if link is disconnecting, also report data sending failure */
     L2CAP_TRACE_WARNING("L2CA_SendFixedChnlData(0x%04x) - no LCB", fixed_cid);
-    osi_free(p_buf);
-    return (L2CAP_DW_FAILED);
+    return NULL;
   }
 
   tL2C_BLE_FIXED_CHNLS_MASK peer_channel_mask;
@@ -1580,13 +1576,9 @@ uint16_t L2CA_SendFixedChnlData(uint16_t fixed_cid, const RawAddress& rem_bda,
     L2CAP_TRACE_WARNING(
         "L2CA_SendFixedChnlData() - peer does not support fixed chnl: 0x%04x",
         fixed_cid);
-    osi_free(p_buf);
-    return (L2CAP_DW_FAILED);
+    return NULL;
   }
 
-  p_buf->event = 0;
-  p_buf->layer_specific = L2CAP_FLUSHABLE_CH_BASED;
-
   if (!p_lcb->p_fixed_ccbs[fixed_cid - L2CAP_FIRST_FIXED_CHNL]) {
     if (!l2cu_initialize_fixed_ccb(
             p_lcb, fixed_cid,
@@ -1594,26 +1586,127 @@ uint16_t L2CA_SendFixedChnlData(uint16_t fixed_cid, const RawAddress& rem_bda,
                  .fixed_chnl_opts)) {
       L2CAP_TRACE_WARNING("L2CA_SendFixedChnlData() - no CCB for chnl: 0x%4x",
                           fixed_cid);
-      osi_free(p_buf);
-      return (L2CAP_DW_FAILED);
+      return NULL;
     }
   }
 
+  *pp_lcb = p_lcb;
+  return p_lcb->p_fixed_ccbs[fixed_cid - L2CAP_FIRST_FIXED_CHNL];
+}
+
+/*******************************************************************************
+ *
+ *  Function        L2CA_SendFixedChnlData
+ *
+ *  Description     Write data on a fixed channel.
+ *
+ *  Parameters:     Fixed CID
+ *                  BD Address of remote
+ *                  Pointer to buffer of type BT_HDR
+ *
+ * Return value     L2CAP_DW_SUCCESS, if data accepted
+ *                  L2CAP_DW_FAILED,  if error
+ *
+ ******************************************************************************/
+uint16_t L2CA_SendFixedChnlData(uint16_t fixed_cid, const RawAddress& rem_bda,
+                                BT_HDR* p_buf) {
+  if (bluetooth::shim::is_gd_shim_enabled()) {
+    return bluetooth::shim::L2CA_SendFixedChnlData(fixed_cid, rem_bda, p_buf);
+  }
+
+  tL2C_LCB* p_lcb;
+  tL2C_CCB* p_ccb = l2c_find_fixed_ccb_for_data(fixed_cid, rem_bda, &p_lcb);
+  if (p_ccb == NULL) {
+    osi_free(p_buf);
+    return (L2CAP_DW_FAILED);
+  }
+
   // If already congested, do not accept any more packets
-  if (p_lcb->p_fixed_ccbs[fixed_cid - L2CAP_FIRST_FIXED_CHNL]->cong_sent) {
+  if (p_ccb->cong_sent) {
     L2CAP_TRACE_ERROR(
         "L2CAP - CID: 0x%04x cannot send, already congested \
             xmit_hold_q.count: %u buff_quota: %u",
-        fixed_cid, fixed_queue_length(
-                       p_lcb->p_fixed_ccbs[fixed_cid - L2CAP_FIRST_FIXED_CHNL]
-                           ->xmit_hold_q),
-        p_lcb->p_fixed_ccbs[fixed_cid - L2CAP_FIRST_FIXED_CHNL]->buff_quota);
+        fixed_cid, fixed_queue_length(p_ccb->xmit_hold_q), p_ccb->buff_quota);
     osi_free(p_buf);
     return (L2CAP_DW_FAILED);
   }
 
-  l2c_enqueue_peer_data(p_lcb->p_fixed_ccbs[fixed_cid - L2CAP_FIRST_FIXED_CHNL],
-                        p_buf);
+  p_buf->event = 0;
+  p_buf->layer_specific = L2CAP_FLUSHABLE_CH_BASED;
+
+  l2c_enqueue_peer_data(p_ccb, p_buf);
+
+  l2c_link_check_send_pkts(p_lcb, NULL, NULL);
+
+  // If there is no dynamic CCB on the link, restart the idle timer each time
+  // something is sent
+  if (p_lcb->in_use && p_lcb->link_state == LST_CONNECTED &&
+      !p_lcb->ccb_queue.p_first_ccb) {
+    l2cu_no_dynamic_ccbs(p_lcb);
+  }
+
+  if (p_ccb->cong_sent) return (L2CAP_DW_CONGESTED);
+
+  return (L2CAP_DW_SUCCESS);
+}
+
+/*******************************************************************************
+ *
+ *  Function        L2CA_SendFixedChnlDataBatch
+ *
+ *  Description     Write several buffers on a fixed channel. All buffers are
+ *                  queued before the link is scheduled, so that they go to the
+ *                  controller in one pass. Buffers are handed over to L2CAP in
+ *                  order until the channel is congested; the remaining
+ *                  buffers are not sent and stay owned by the caller.
+ *
+ *  Parameters:     Fixed CID
+ *                  BD Address of remote
+ *                  Array of pointers to buffers of type BT_HDR
+ *                  Number of buffers
+ *                  Number of buffers handed over to L2CAP, set on return
+ *
+ * Return value     L2CAP_DW_SUCCESS, if all buffers accepted
+ *                  L2CAP_DW_CONGESTED, if the channel is congested
+ *                  L2CAP_DW_FAILED,  if error, no buffer was accepted
+ *
+ ******************************************************************************/
+uint16_t L2CA_SendFixedChnlDataBatch(uint16_t fixed_cid,
+                                     const RawAddress& rem_bda,
+                                     BT_HDR** p_bufs, uint16_t num_bufs,
+                                     uint16_t* p_num_sent) {
+  *p_num_sent = 0;
+
+  if (bluetooth::shim::is_gd_shim_enabled()) {
+    uint16_t ret = L2CAP_DW_SUCCESS;
+    while (*p_num_sent < num_bufs && ret == L2CAP_DW_SUCCESS) {
+      ret = bluetooth::shim::L2CA_SendFixedChnlData(fixed_cid, rem_bda,
+                                                    p_bufs[(*p_num_sent)++]);
+    }
+    return ret;
+  }
+
+  tL2C_LCB* p_lcb;
+  tL2C_CCB* p_ccb = l2c_find_fixed_ccb_for_data(fixed_cid, rem_bda, &p_lcb);
+  if (p_ccb == NULL) return (L2CAP_DW_FAILED);
+
+  // If already congested, do not accept any more packets
+  if (p_ccb->cong_sent) return (L2CAP_DW_FAILED);
+
+  while (*p_num_sent < num_bufs) {
+    // The hold queue only drains when the link is scheduled: give the channel
+    // a chance to flush before giving up
+    if (p_ccb->cong_sent) {
+      l2c_link_check_send_pkts(p_lcb, NULL, NULL);
+      if (p_ccb->cong_sent) break;
+    }
+
+    BT_HDR* p_buf = p_bufs[*p_num_sent];
+    p_buf->event = 0;
+    p_buf->layer_specific = L2CAP_FLUSHABLE_CH_BASED;
+    l2c_enqueue_peer_data(p_ccb, p_buf);
+    (*p_num_sent)++;
+  }
 
   l2c_link_check_send_pkts(p_lcb, NULL, NULL);
 
@@ -1624,8 +1717,7 @@ uint16_t L2CA_SendFixedChnlData(uint16_t fixed_cid, const RawAddress& rem_bda,
     l2cu_no_dynamic_ccbs(p_lcb);
   }
 
-  if (p_lcb->p_fixed_ccbs[fixed_cid - L2CAP_FIRST_FIXED_CHNL]->cong_sent)
-    return (L2CAP_DW_CONGESTED);
+  if (p_ccb->cong_sent) return (L2CAP_DW_CONGESTED);
 
   return (L2CAP_DW_SUCCESS);
 }
@@ -1886,7 +1978,7 @@ uint16_t L2CA_FlushChannel(uint16_t lcid, uint16_t num_to_flush) {
   /* If needed, flush buffers in the CCB xmit hold queue */
   while ((num_to_flush != 0) && (!fixed_queue_is_empty(p_ccb->xmit_hold_q))) {
     BT_HDR* p_buf = (BT_HDR*)fixed_queue_try_dequeue(p_ccb->xmit_hold_q);
-    osi_free(p_buf);
+    l2c_fcr_free_xmit_sdu(p_ccb, p_buf);
     num_to_flush--;
     num_flushed2++;
   }
@@ -1915,3 +2007,97 @@ uint16_t L2CA_FlushChannel(uint16_t lcid, uint16_t num_to_flush) {
 
   return (num_left);
 }
+
+#if (L2CAP_CHANNEL_STATS == TRUE)
+/*******************************************************************************
+ *
+ * Function         l2c_dump_channel_stats
+ *
+ * Description      Dump the queue and traffic statistics of a channel to |fd|.
+ *
+ ******************************************************************************/
+static void l2c_dump_channel_stats(int fd, const tL2C_CCB* p_ccb,
+                                   uint64_t now_ms) {
+  const tL2C_CCB_STATS* p_stats = &p_ccb->stats;
+
+  dprintf(fd, "    Channel CID: 0x%04x PSM: 0x%04x open for: %" PRIu64 " ms\n",
+          p_ccb->local_cid, p_ccb->p_rcb ? p_ccb->p_rcb->real_psm : 0,
+          now_ms - p_stats->open_ms);
+  dprintf(fd, "      Queued: %zu quota: %d congested: %u times%s\n",
+          fixed_queue_length(p_ccb->xmit_hold_q), p_ccb->buff_quota,
+          p_stats->congestion_on, p_ccb->cong_sent ? " (now)" : "");
+  dprintf(fd,
+          "      TX: %" PRIu64 " bytes in %u SDUs RX: %" PRIu64
+          " bytes in %u PDUs dropped: %u PDUs\n",
+          p_stats->tx_bytes, p_stats->tx_pkts, p_stats->rx_bytes,
+          p_stats->rx_pkts, p_stats->rx_dropped);
+  dprintf(fd, "      Queue delay: max %u ms p99 <= %u ms histogram (ms):",
+          p_stats->max_delay_ms, l2cu_channel_delay_percentile(p_stats, 99));
+  for (int i = 0; i < L2C_CHNL_HIST_BUCKETS; i++)
+    dprintf(fd, " %u", p_stats->delay_hist[i]);
+  dprintf(fd, "\n");
+}
+#endif
+
+/*******************************************************************************
+ *
+ * Function         stack_debug_l2cap_api_dump
+ *
+ * Description      Dump the transmit quotas and statistics of the connected
+ *                  ACL links, the tuning of the LE ones and the statistics of
+ *                  their channels to |fd|.
+ *
+ ******************************************************************************/
+void stack_debug_l2cap_api_dump(int fd) {
+  dprintf(fd, "\nL2CAP Links:\n");
+  dprintf(fd, "  Controller window: BR/EDR %d LE %d\n",
+          l2cb.controller_xmit_window, l2cb.controller_le_xmit_window);
+  dprintf(fd, "  Round-robin: BR/EDR %d/%d LE %d/%d unacked/quota\n",
+          l2cb.round_robin_unacked, l2cb.round_robin_quota,
+          l2cb.ble_round_robin_unacked, l2cb.ble_round_robin_quota);
+
+  uint64_t now_ms = bluetooth::common::time_get_os_boottime_ms();
+  for (int xx = 0; xx < MAX_L2CAP_LINKS; xx++) {
+    const tL2C_LCB* p_lcb = &l2cb.lcb_pool[xx];
+    if (!p_lcb->in_use || p_lcb->link_state != LST_CONNECTED) continue;
+
+    const tL2C_LINK_STATS& stats = p_lcb->stats;
+    dprintf(fd, "\n  Link handle: 0x%04x peer: %s transport: %s priority: %s\n",
+            p_lcb->handle, p_lcb->remote_bd_addr.ToString().c_str(),
+            (p_lcb->transport == BT_TRANSPORT_LE) ? "LE" : "BR/EDR",
+            (p_lcb->acl_priority == L2CAP_PRIORITY_HIGH) ? "high" : "normal");
+    dprintf(fd, "    Quota: %d unacked: %d link queue: %zu\n",
+            p_lcb->link_xmit_quota, p_lcb->sent_not_acked,
+            list_length(p_lcb->link_xmit_data_q));
+    dprintf(fd, "    TX: %u packets in %u segments\n", stats.tx_pkts,
+            stats.tx_segs);
+    dprintf(fd, "    Stalls: %u max backlog: %d", stats.stalls,
+            stats.max_backlog);
+    if (stats.stalled_since_ms != 0)
+      dprintf(fd, " stalled for: %" PRIu64 " ms",
+              now_ms - stats.stalled_since_ms);
+    dprintf(fd, "\n");
+
+    /* Bucket n holds values in [2^(n-1), 2^n) */
+    dprintf(fd, "    Backlog histogram (packets):");
+    for (int i = 0; i < L2C_LINK_HIST_BUCKETS; i++)
+      dprintf(fd, " %u", stats.backlog_hist[i]);
+    dprintf(fd, "\n    Stall histogram (ms):");
+    for (int i = 0; i < L2C_LINK_HIST_BUCKETS; i++)
+      dprintf(fd, " %u", stats.wait_ms_hist[i]);
+    dprintf(fd, "\n");
+    if (p_lcb->transport == BT_TRANSPORT_LE) l2cble_tune_dump(fd, p_lcb);
+
+#if (L2CAP_CHANNEL_STATS == TRUE)
+    for (const tL2C_CCB* p_ccb = p_lcb->ccb_queue.p_first_ccb; p_ccb;
+         p_ccb = p_ccb->p_next_ccb)
+      l2c_dump_channel_stats(fd, p_ccb, now_ms);
+#if (L2CAP_NUM_FIXED_CHNLS > 0)
+    for (int i = 0; i < L2CAP_NUM_FIXED_CHNLS; i++) {
+      if (p_lcb->p_fixed_ccbs[i])
+        l2c_dump_channel_stats(fd, p_lcb->p_fixed_ccbs[i], now_ms);
+    }
+#endif
+#endif
+  }
+}
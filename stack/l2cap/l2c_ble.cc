@@ -122,6 +122,7 @@ bool L2CA_UpdateBleConnParams(const RawAddress& rem_bda, uint16_t min_int,
   p_lcb->conn_update_mask |= L2C_BLE_NEW_CONN_PARAM;
   p_lcb->min_ce_len = min_ce_len;
   p_lcb->max_ce_len = max_ce_len;
+  l2cble_tune_params_owned(p_lcb);
 
   l2cble_start_conn_update(p_lcb);
 
@@ -297,7 +298,7 @@ void l2cble_conn_comp(uint16_t handle, uint8_t role, const RawAddress& bda,
   if (role == HCI_ROLE_MASTER) alarm_cancel(p_lcb->l2c_lcb_timer);
 
   /* Save the handle */
-  p_lcb->handle = handle;
+  l2cu_set_lcb_handle(p_lcb, handle);
 
   /* Connected OK. Change state to connected, we were scanning so we are master
    */
@@ -309,6 +310,7 @@ void l2cble_conn_comp(uint16_t handle, uint8_t role, const RawAddress& bda,
   p_lcb->timeout = conn_timeout;
   p_lcb->latency = conn_latency;
   p_lcb->conn_update_mask = L2C_BLE_NOT_DEFAULT_PARAM;
+  l2cble_tune_link_up(p_lcb, conn_interval);
 
   /* Tell BTM Acl management about the link */
   tBTM_SEC_DEV_REC* p_dev_rec = btm_find_or_alloc_dev(bda);
@@ -421,6 +423,37 @@ static void l2cble_start_conn_update(tL2C_LCB* p_lcb) {
   }
 }
 
+/*******************************************************************************
+ *
+ *  Function        l2cble_tune_conn_params
+ *
+ *  Description     Asks for new connection parameters for the LE link
+ *                  |p_lcb| on behalf of the link tuning, see l2c_ble_tune.cc.
+ *                  Unlike L2CA_UpdateBleConnParams, the link stays tunable.
+ *
+ *  Return value:   none
+ *
+ ******************************************************************************/
+void l2cble_tune_conn_params(tL2C_LCB* p_lcb, uint16_t min_int,
+                             uint16_t max_int, uint16_t latency,
+                             uint16_t timeout) {
+  L2CA_AdjustConnectionIntervals(&min_int, &max_int, BTM_BLE_CONN_INT_MIN);
+  if (timeout == 0) timeout = BTM_BLE_CONN_TIMEOUT_DEF;
+
+  L2CAP_TRACE_DEBUG("%s: handle=%d min_int=%d max_int=%d latency=%d",
+                    __func__, p_lcb->handle, min_int, max_int, latency);
+
+  p_lcb->min_interval = min_int;
+  p_lcb->max_interval = max_int;
+  p_lcb->latency = latency;
+  p_lcb->timeout = timeout;
+  p_lcb->min_ce_len = 0;
+  p_lcb->max_ce_len = 0;
+  p_lcb->conn_update_mask |= L2C_BLE_NEW_CONN_PARAM;
+
+  l2cble_start_conn_update(p_lcb);
+}
+
 /*******************************************************************************
  *
  * Function         l2cble_process_conn_update_evt
@@ -448,6 +481,8 @@ void l2cble_process_conn_update_evt(uint16_t handle, uint8_t status,
 
   if (status != HCI_SUCCESS) {
     L2CAP_TRACE_WARNING("%s: Error status: %d", __func__, status);
+  } else {
+    l2cble_tune_conn_update(p_lcb, interval);
   }
 
   l2cble_start_conn_update(p_lcb);
@@ -543,6 +578,7 @@ void l2cble_process_sig_cmd(tL2C_LCB* p_lcb, uint8_t* p, uint16_t pkt_len) {
           p_lcb->latency = latency;
           p_lcb->timeout = timeout;
           p_lcb->conn_update_mask |= L2C_BLE_NEW_CONN_PARAM;
+          l2cble_tune_params_owned(p_lcb);
 
           l2cble_start_conn_update(p_lcb);
         }
@@ -936,6 +972,7 @@ void l2cble_process_rc_param_request_evt(uint16_t handle, uint16_t int_min,
 
     /* if update is enabled, always accept connection parameter update */
     if ((p_lcb->conn_update_mask & L2C_BLE_CONN_UPDATE_DISABLE) == 0) {
+      l2cble_tune_params_owned(p_lcb);
       btsnd_hcic_ble_rc_param_req_reply(handle, int_min, int_max, latency,
                                         timeout, 0, 0);
     } else {
@@ -977,6 +1014,9 @@ void l2cble_update_data_length(tL2C_LCB* p_lcb) {
     }
   }
 
+  /* the link has been tuned for its traffic */
+  if (p_lcb->ble_tune.data_len_requested) tx_mtu = BTM_BLE_DATA_SIZE_MAX;
+
   if (tx_mtu > BTM_BLE_DATA_SIZE_MAX) tx_mtu = BTM_BLE_DATA_SIZE_MAX;
 
   /* update TX data length if changed */
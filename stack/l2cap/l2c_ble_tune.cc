@@ -0,0 +1,321 @@
+/******************************************************************************
+ *
+ *  Copyright 2020 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This file contains the traffic driven tuning of the LE links. The bytes
+ *  sent and received on each link are sampled every L2C_BLE_TUNE_SAMPLE_MS:
+ *
+ *  - when a sample is over L2C_BLE_TUNE_ACTIVE_BPS, the link is sped up: the
+ *    maximum data length and the 2M PHY are asked for once, when both sides
+ *    support them, and the interval is lowered to the one of the latency
+ *    class of the link, faster for the LE credit based channels than for ATT;
+ *  - after L2C_BLE_TUNE_IDLE_SAMPLES samples in a row under
+ *    L2C_BLE_TUNE_IDLE_BPS, the interval goes back to the default one. The
+ *    data length and the PHY are kept, as they only shorten the air time.
+ *
+ *  The intervals are only changed when we are master, and never once a
+ *  profile, such as the hearing aid or a GATT connection priority request,
+ *  or the peer has asked for intervals of its own on the link.
+ *
+ ******************************************************************************/
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include <algorithm>
+
+#include "bt_target.h"
+#include "btm_api.h"
+#include "btm_ble_api.h"
+#include "btm_int.h"
+#include "common/time_util.h"
+#include "device/include/controller.h"
+#include "l2c_int.h"
+#include "osi/include/alarm.h"
+#include "osi/include/osi.h"
+
+/* Period of the traffic samples */
+#define L2C_BLE_TUNE_SAMPLE_MS 1000
+/* Throughput over which a link is sped up, in bytes/s */
+#define L2C_BLE_TUNE_ACTIVE_BPS 2000
+/* Throughput under which a link is counted as idle, in bytes/s */
+#define L2C_BLE_TUNE_IDLE_BPS 200
+/* Idle samples in a row after which a link is relaxed */
+#define L2C_BLE_TUNE_IDLE_SAMPLES 5
+
+/* Intervals of the sped up links, in 1.25 ms units */
+#define L2C_BLE_TUNE_STREAM_INT_MIN 6 /* 7.5 ms */
+#define L2C_BLE_TUNE_STREAM_INT_MAX 12
+#define L2C_BLE_TUNE_DEFAULT_INT_MIN 12 /* 15 ms */
+#define L2C_BLE_TUNE_DEFAULT_INT_MAX 24
+
+static void l2cble_tune_timer_timeout(void* data);
+
+static const char* l2cble_tune_decision_text(uint8_t decision) {
+  switch (decision) {
+    case L2C_BLE_TUNE_SPEED_UP:
+      return "speed up";
+    case L2C_BLE_TUNE_RELAX:
+      return "relax";
+    default:
+      return "none";
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         l2cble_tune_link_up
+ *
+ * Description      Starts the tuning of the LE link |p_lcb|, which has just
+ *                  been connected with |interval|.
+ *
+ ******************************************************************************/
+void l2cble_tune_link_up(tL2C_LCB* p_lcb, uint16_t interval) {
+  p_lcb->ble_tune.interval = interval;
+  p_lcb->ble_tune.sample_ms = bluetooth::common::time_get_os_boottime_ms();
+
+  if (l2cb.ble_tune_timer == NULL)
+    l2cb.ble_tune_timer = alarm_new_periodic("l2c.ble_tune_timer");
+  if (!alarm_is_scheduled(l2cb.ble_tune_timer))
+    alarm_set_on_mloop(l2cb.ble_tune_timer, L2C_BLE_TUNE_SAMPLE_MS,
+                       l2cble_tune_timer_timeout, NULL);
+}
+
+/*******************************************************************************
+ *
+ * Function         l2cble_tune_traffic
+ *
+ * Description      Counts |len| bytes sent, if |is_tx|, or received on the LE
+ *                  link |p_lcb|.
+ *
+ ******************************************************************************/
+void l2cble_tune_traffic(tL2C_LCB* p_lcb, uint16_t len, bool is_tx) {
+  if (is_tx)
+    p_lcb->ble_tune.tx_bytes += len;
+  else
+    p_lcb->ble_tune.rx_bytes += len;
+}
+
+/*******************************************************************************
+ *
+ * Function         l2cble_tune_sample
+ *
+ * Description      Closes the traffic sample of |p_tune| at |now_ms| and
+ *                  picks what the link needs.
+ *
+ * Returns          L2C_BLE_TUNE_SPEED_UP when the link turns busy,
+ *                  L2C_BLE_TUNE_RELAX when it has been idle long enough,
+ *                  L2C_BLE_TUNE_NONE otherwise.
+ *
+ ******************************************************************************/
+uint8_t l2cble_tune_sample(tL2C_BLE_TUNE* p_tune, uint64_t now_ms) {
+  uint64_t elapsed_ms = now_ms - p_tune->sample_ms;
+  if (p_tune->sample_ms == 0 || elapsed_ms == 0) {
+    p_tune->sample_ms = now_ms;
+    return L2C_BLE_TUNE_NONE;
+  }
+
+  uint64_t bytes = (uint64_t)p_tune->tx_bytes + p_tune->rx_bytes;
+  p_tune->last_bps = (uint32_t)(bytes * 1000 / elapsed_ms);
+  p_tune->peak_bps = std::max(p_tune->peak_bps, p_tune->last_bps);
+  p_tune->tx_bytes = 0;
+  p_tune->rx_bytes = 0;
+  p_tune->sample_ms = now_ms;
+
+  if (p_tune->last_bps >= L2C_BLE_TUNE_ACTIVE_BPS) {
+    p_tune->quiet_samples = 0;
+    if (p_tune->active) return L2C_BLE_TUNE_NONE;
+    p_tune->active = true;
+    return L2C_BLE_TUNE_SPEED_UP;
+  }
+
+  if (!p_tune->active) return L2C_BLE_TUNE_NONE;
+  if (p_tune->last_bps >= L2C_BLE_TUNE_IDLE_BPS) {
+    p_tune->quiet_samples = 0;
+    return L2C_BLE_TUNE_NONE;
+  }
+  if (++p_tune->quiet_samples < L2C_BLE_TUNE_IDLE_SAMPLES)
+    return L2C_BLE_TUNE_NONE;
+
+  p_tune->active = false;
+  p_tune->quiet_samples = 0;
+  return L2C_BLE_TUNE_RELAX;
+}
+
+/*******************************************************************************
+ *
+ * Function         l2cble_tune_latency_class
+ *
+ * Description      Picks the latency needs of the LE link |p_lcb| from its
+ *                  channels.
+ *
+ * Returns          L2C_BLE_LATENCY_STREAM if an LE credit based channel is
+ *                  open, L2C_BLE_LATENCY_DEFAULT otherwise.
+ *
+ ******************************************************************************/
+uint8_t l2cble_tune_latency_class(const tL2C_LCB* p_lcb) {
+  for (const tL2C_CCB* p_ccb = p_lcb->ccb_queue.p_first_ccb; p_ccb;
+       p_ccb = p_ccb->p_next_ccb) {
+    if (p_ccb->local_cid >= L2CAP_BASE_APPL_CID &&
+        p_ccb->chnl_state == CST_OPEN)
+      return L2C_BLE_LATENCY_STREAM;
+  }
+  return L2C_BLE_LATENCY_DEFAULT;
+}
+
+/*******************************************************************************
+ *
+ * Function         l2cble_tune_params_owned
+ *
+ * Description      Leaves the intervals of the LE link |p_lcb| to the profile
+ *                  or the peer that has just set them.
+ *
+ ******************************************************************************/
+void l2cble_tune_params_owned(tL2C_LCB* p_lcb) {
+  p_lcb->ble_tune.params_owned = true;
+}
+
+/*******************************************************************************
+ *
+ * Function         l2cble_tune_conn_update
+ *
+ * Description      Records the new |interval| of the LE link |p_lcb|.
+ *
+ ******************************************************************************/
+void l2cble_tune_conn_update(tL2C_LCB* p_lcb, uint16_t interval) {
+  p_lcb->ble_tune.interval = interval;
+}
+
+/*******************************************************************************
+ *
+ * Function         l2cble_process_phy_update_evt
+ *
+ * Description      Records the PHYs of the LE link of |handle| after an LE PHY
+ *                  Update Complete event.
+ *
+ ******************************************************************************/
+void l2cble_process_phy_update_evt(uint16_t handle, uint8_t status,
+                                   uint8_t tx_phy, uint8_t rx_phy) {
+  tL2C_LCB* p_lcb = l2cu_find_lcb_by_handle(handle);
+  if (p_lcb == NULL || status != HCI_SUCCESS) return;
+
+  p_lcb->ble_tune.tx_phy = tx_phy;
+  p_lcb->ble_tune.rx_phy = rx_phy;
+}
+
+static void l2cble_tune_speed_up(tL2C_LCB* p_lcb) {
+  tL2C_BLE_TUNE* p_tune = &p_lcb->ble_tune;
+  const controller_t* controller = controller_get_interface();
+  tACL_CONN* p_acl = btm_bda_to_acl(p_lcb->remote_bd_addr, BT_TRANSPORT_LE);
+  if (p_acl == NULL) return;
+
+  p_tune->speed_ups++;
+  p_tune->last_decision = L2C_BLE_TUNE_SPEED_UP;
+  p_tune->last_decision_ms = bluetooth::common::time_get_os_boottime_ms();
+
+  if (!p_tune->data_len_requested &&
+      p_lcb->tx_data_len < BTM_BLE_DATA_SIZE_MAX &&
+      controller->supports_ble_packet_extension() &&
+      HCI_LE_DATA_LEN_EXT_SUPPORTED(p_acl->peer_le_features)) {
+    p_tune->data_len_requested = true;
+    BTM_SetBleDataLength(p_lcb->remote_bd_addr, BTM_BLE_DATA_SIZE_MAX);
+  }
+
+  if (!p_tune->phy_requested && p_tune->tx_phy != PHY_LE_2M &&
+      controller->supports_ble_2m_phy() &&
+      HCI_LE_2M_PHY_SUPPORTED(p_acl->peer_le_features)) {
+    p_tune->phy_requested = true;
+    BTM_BleSetPhy(p_lcb->remote_bd_addr, PHY_LE_2M, PHY_LE_2M, 0);
+  }
+
+  if (p_tune->params_owned || p_lcb->link_role != HCI_ROLE_MASTER) return;
+
+  if (l2cble_tune_latency_class(p_lcb) == L2C_BLE_LATENCY_STREAM) {
+    l2cble_tune_conn_params(p_lcb, L2C_BLE_TUNE_STREAM_INT_MIN,
+                            L2C_BLE_TUNE_STREAM_INT_MAX, 0, p_lcb->timeout);
+  } else {
+    l2cble_tune_conn_params(p_lcb, L2C_BLE_TUNE_DEFAULT_INT_MIN,
+                            L2C_BLE_TUNE_DEFAULT_INT_MAX, 0, p_lcb->timeout);
+  }
+}
+
+static void l2cble_tune_relax(tL2C_LCB* p_lcb) {
+  tL2C_BLE_TUNE* p_tune = &p_lcb->ble_tune;
+
+  p_tune->relaxes++;
+  p_tune->last_decision = L2C_BLE_TUNE_RELAX;
+  p_tune->last_decision_ms = bluetooth::common::time_get_os_boottime_ms();
+
+  if (p_tune->params_owned || p_lcb->link_role != HCI_ROLE_MASTER) return;
+
+  l2cble_tune_conn_params(p_lcb, BTM_BLE_CONN_INT_MIN_DEF,
+                          BTM_BLE_CONN_INT_MAX_DEF,
+                          BTM_BLE_CONN_SLAVE_LATENCY_DEF, p_lcb->timeout);
+}
+
+static void l2cble_tune_timer_timeout(UNUSED_ATTR void* data) {
+  uint64_t now_ms = bluetooth::common::time_get_os_boottime_ms();
+  bool have_links = false;
+
+  for (int xx = 0; xx < MAX_L2CAP_LINKS; xx++) {
+    tL2C_LCB* p_lcb = &l2cb.lcb_pool[xx];
+    if (!p_lcb->in_use || p_lcb->transport != BT_TRANSPORT_LE ||
+        p_lcb->link_state != LST_CONNECTED)
+      continue;
+
+    have_links = true;
+    switch (l2cble_tune_sample(&p_lcb->ble_tune, now_ms)) {
+      case L2C_BLE_TUNE_SPEED_UP:
+        l2cble_tune_speed_up(p_lcb);
+        break;
+      case L2C_BLE_TUNE_RELAX:
+        l2cble_tune_relax(p_lcb);
+        break;
+    }
+  }
+
+  if (!have_links) alarm_cancel(l2cb.ble_tune_timer);
+}
+
+/*******************************************************************************
+ *
+ * Function         l2cble_tune_dump
+ *
+ * Description      Dump the traffic and the tuning of the LE link |p_lcb| to
+ *                  |fd|.
+ *
+ ******************************************************************************/
+void l2cble_tune_dump(int fd, const tL2C_LCB* p_lcb) {
+  const tL2C_BLE_TUNE* p_tune = &p_lcb->ble_tune;
+
+  dprintf(fd,
+          "    LE tuning: %s, throughput %u B/s (peak %u B/s), interval %u, "
+          "data length %u, PHY tx %u rx %u%s\n",
+          p_tune->active ? "active" : "relaxed", p_tune->last_bps,
+          p_tune->peak_bps, p_tune->interval, p_lcb->tx_data_len,
+          p_tune->tx_phy, p_tune->rx_phy,
+          p_tune->params_owned ? ", intervals set by profile or peer" : "");
+  dprintf(fd, "    Speed ups: %u relaxes: %u last: %s", p_tune->speed_ups,
+          p_tune->relaxes, l2cble_tune_decision_text(p_tune->last_decision));
+  if (p_tune->last_decision_ms != 0)
+    dprintf(fd, " %" PRIu64 " ms ago",
+            bluetooth::common::time_get_os_boottime_ms() -
+                p_tune->last_decision_ms);
+  dprintf(fd, "\n");
+}
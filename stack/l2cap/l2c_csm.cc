@@ -1357,6 +1357,10 @@ static const char* l2c_csm_get_event_name(uint16_t event) {
 void l2c_enqueue_peer_data(tL2C_CCB* p_ccb, BT_HDR* p_buf) {
   uint8_t* p;
 
+#if (L2CAP_CHANNEL_STATS == TRUE)
+  l2cu_channel_stats_tx(p_ccb, p_buf->len);
+#endif
+
   if (p_ccb->peer_cfg.fcr.mode != L2CAP_FCR_BASIC_MODE) {
     p_buf->event = 0;
   } else {
@@ -95,11 +95,30 @@ static void prepare_I_frame(tL2C_CCB* p_ccb, BT_HDR* p_buf,
 static void process_stream_frame(tL2C_CCB* p_ccb, BT_HDR* p_buf);
 static bool do_sar_reassembly(tL2C_CCB* p_ccb, BT_HDR* p_buf,
                               uint16_t ctrl_word);
+static void l2c_fcr_free_wack(void* p_data);
 
 #if (L2CAP_ERTM_STATS == TRUE)
 static void l2c_fcr_collect_ack_delay(tL2C_CCB* p_ccb, uint8_t num_bufs_acked);
 #endif
 
+/* Segments of an SDU waiting for an ack are kept as slices: the buffer holds
+ * the I-frame headers, preceded by a tL2C_FCR_SLICE that locates the payload
+ * in the SDU. The acking delay statistics expect a full copy of the frame. */
+#if (L2CAP_ERTM_STATS == TRUE)
+#define L2C_FCR_USE_SLICES FALSE
+#else
+#define L2C_FCR_USE_SLICES TRUE
+#endif
+
+/* Value of the event field of a waiting for ack buffer holding a slice */
+#define L2C_FCR_WACK_SLICE 0xFFFF
+
+typedef struct {
+  tL2C_FCR_TX_SDU* p_sdu; /* SDU holding the payload */
+  uint16_t offset;        /* Offset of the payload in the SDU buffer */
+  uint16_t len;           /* Length of the payload */
+} tL2C_FCR_SLICE;
+
 /*******************************************************************************
  *
  * Function         l2c_fcr_updcrc
@@ -218,9 +237,13 @@ void l2c_fcr_cleanup(tL2C_CCB* p_ccb) {
 
   osi_free_and_reset((void**)&p_fcrb->p_rx_sdu);
 
-  fixed_queue_free(p_fcrb->waiting_for_ack_q, osi_free);
+  fixed_queue_free(p_fcrb->waiting_for_ack_q, l2c_fcr_free_wack);
   p_fcrb->waiting_for_ack_q = NULL;
 
+  /* Without waiting for ack slices, a SDU being segmented is only referenced
+   * by the xmit_hold_q, which frees it */
+  osi_free_and_reset((void**)&p_fcrb->p_tx_sdu);
+
   fixed_queue_free(p_fcrb->srej_rcv_hold_q, osi_free);
   p_fcrb->srej_rcv_hold_q = NULL;
 
@@ -363,6 +386,149 @@ BT_HDR* l2c_fcr_clone_buf(BT_HDR* p_buf, uint16_t new_offset,
   return (p_buf2);
 }
 
+/*******************************************************************************
+ *
+ * Function         l2c_fcr_get_tx_sdu
+ *
+ * Description      Returns the reference counted holder of p_buf, the SDU at
+ *                  the head of the xmit_hold_q being segmented.
+ *
+ ******************************************************************************/
+static tL2C_FCR_TX_SDU* l2c_fcr_get_tx_sdu(tL2C_CCB* p_ccb, BT_HDR* p_buf) {
+  tL2C_FCR_TX_SDU* p_sdu = p_ccb->fcrb.p_tx_sdu;
+
+  if (p_sdu == NULL) {
+    p_sdu = (tL2C_FCR_TX_SDU*)osi_malloc(sizeof(tL2C_FCR_TX_SDU));
+    p_sdu->p_buf = p_buf;
+    p_sdu->ref_count = 0;
+    p_sdu->in_queue = true;
+    p_ccb->fcrb.p_tx_sdu = p_sdu;
+  }
+
+  return p_sdu;
+}
+
+/*******************************************************************************
+ *
+ * Function         l2c_fcr_release_tx_sdu
+ *
+ * Description      Releases a reference to a segmented SDU, and frees it with
+ *                  the last one once it has left the xmit_hold_q.
+ *
+ ******************************************************************************/
+static void l2c_fcr_release_tx_sdu(tL2C_FCR_TX_SDU* p_sdu) {
+  if (p_sdu->ref_count > 0) p_sdu->ref_count--;
+
+  if ((p_sdu->ref_count == 0) && (!p_sdu->in_queue)) {
+    osi_free(p_sdu->p_buf);
+    osi_free(p_sdu);
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         l2c_fcr_free_xmit_sdu
+ *
+ * Description      Frees an SDU dequeued from the xmit_hold_q without being
+ *                  sent. If its first segments are waiting for an ack, it is
+ *                  freed with them instead.
+ *
+ ******************************************************************************/
+void l2c_fcr_free_xmit_sdu(tL2C_CCB* p_ccb, BT_HDR* p_buf) {
+  tL2C_FCR_TX_SDU* p_sdu = p_ccb->fcrb.p_tx_sdu;
+
+  if ((p_sdu == NULL) || (p_sdu->p_buf != p_buf)) {
+    osi_free(p_buf);
+    return;
+  }
+
+  p_ccb->fcrb.p_tx_sdu = NULL;
+  p_sdu->in_queue = false;
+  if (p_sdu->ref_count == 0) {
+    osi_free(p_buf);
+    osi_free(p_sdu);
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         l2c_fcr_new_slice
+ *
+ * Description      Builds a waiting for ack buffer for p_xmit, an I-frame
+ *                  carrying len bytes at offset in the SDU.
+ *
+ * Returns          pointer to new buffer
+ *
+ ******************************************************************************/
+static BT_HDR* l2c_fcr_new_slice(BT_HDR* p_xmit, uint16_t hdr_len,
+                                 tL2C_FCR_TX_SDU* p_sdu, uint16_t offset,
+                                 uint16_t len) {
+  BT_HDR* p_wack =
+      (BT_HDR*)osi_malloc(sizeof(BT_HDR) + sizeof(tL2C_FCR_SLICE) + hdr_len);
+
+  p_wack->event = L2C_FCR_WACK_SLICE;
+  p_wack->offset = sizeof(tL2C_FCR_SLICE);
+  p_wack->len = hdr_len;
+  memcpy(((uint8_t*)(p_wack + 1)) + p_wack->offset,
+         ((uint8_t*)(p_xmit + 1)) + p_xmit->offset, hdr_len);
+
+  tL2C_FCR_SLICE* p_slice = (tL2C_FCR_SLICE*)(p_wack + 1);
+  p_slice->p_sdu = p_sdu;
+  p_slice->offset = offset;
+  p_slice->len = len;
+  p_sdu->ref_count++;
+
+  return p_wack;
+}
+
+/*******************************************************************************
+ *
+ * Function         l2c_fcr_clone_wack
+ *
+ * Description      Copies an I-frame waiting for an ack, to retransmit it.
+ *
+ * Returns          pointer to new buffer
+ *
+ ******************************************************************************/
+static BT_HDR* l2c_fcr_clone_wack(BT_HDR* p_wack) {
+  if (p_wack->event != L2C_FCR_WACK_SLICE)
+    return l2c_fcr_clone_buf(p_wack, p_wack->offset, p_wack->len);
+
+  const tL2C_FCR_SLICE* p_slice = (const tL2C_FCR_SLICE*)(p_wack + 1);
+  const BT_HDR* p_sdu = p_slice->p_sdu->p_buf;
+
+  /* Leave room for the FCS, as l2c_fcr_clone_buf() does */
+  BT_HDR* p_buf = (BT_HDR*)osi_malloc(sizeof(BT_HDR) + HCI_DATA_PREAMBLE_SIZE +
+                                      p_wack->len + p_slice->len +
+                                      L2CAP_FCS_LEN);
+  p_buf->offset = HCI_DATA_PREAMBLE_SIZE;
+  p_buf->len = p_wack->len + p_slice->len;
+
+  uint8_t* p = ((uint8_t*)(p_buf + 1)) + p_buf->offset;
+  memcpy(p, ((uint8_t*)(p_wack + 1)) + p_wack->offset, p_wack->len);
+  memcpy(p + p_wack->len, ((const uint8_t*)(p_sdu + 1)) + p_slice->offset,
+         p_slice->len);
+
+  return p_buf;
+}
+
+/*******************************************************************************
+ *
+ * Function         l2c_fcr_free_wack
+ *
+ * Description      Frees an I-frame waiting for an ack, and releases the SDU
+ *                  it refers to.
+ *
+ ******************************************************************************/
+static void l2c_fcr_free_wack(void* p_data) {
+  BT_HDR* p_wack = (BT_HDR*)p_data;
+
+  if (p_wack->event == L2C_FCR_WACK_SLICE)
+    l2c_fcr_release_tx_sdu(((tL2C_FCR_SLICE*)(p_wack + 1))->p_sdu);
+
+  osi_free(p_wack);
+}
+
 /*******************************************************************************
  *
  * Function         l2c_fcr_is_flow_controlled
@@ -824,10 +990,16 @@ void l2c_lcc_proc_pdu(tL2C_CCB* p_ccb, BT_HDR* p_buf) {
   uint8_t* p = (uint8_t*)(p_buf + 1) + p_buf->offset;
   uint16_t sdu_length;
   BT_HDR* p_data = NULL;
+#if (L2CAP_CHANNEL_STATS == TRUE)
+  uint16_t pdu_len = p_buf->len;
+#endif
 
   /* Buffer length should not exceed local mps */
   if (p_buf->len > p_ccb->local_conn_cfg.mps) {
     /* Discard the buffer */
+#if (L2CAP_CHANNEL_STATS == TRUE)
+    l2cu_channel_stats_rx_drop(p_ccb);
+#endif
     osi_free(p_buf);
     return;
   }
@@ -838,6 +1010,9 @@ void l2c_lcc_proc_pdu(tL2C_CCB* p_ccb, BT_HDR* p_buf) {
                         __func__, p_buf->len);
       android_errorWriteWithInfoLog(0x534e4554, "120665616", -1, NULL, 0);
       /* Discard the buffer */
+#if (L2CAP_CHANNEL_STATS == TRUE)
+      l2cu_channel_stats_rx_drop(p_ccb);
+#endif
       osi_free(p_buf);
       return;
     }
@@ -846,6 +1021,9 @@ void l2c_lcc_proc_pdu(tL2C_CCB* p_ccb, BT_HDR* p_buf) {
     /* Check the SDU Length with local MTU size */
     if (sdu_length > p_ccb->local_conn_cfg.mtu) {
       /* Discard the buffer */
+#if (L2CAP_CHANNEL_STATS == TRUE)
+      l2cu_channel_stats_rx_drop(p_ccb);
+#endif
       osi_free(p_buf);
       return;
     }
@@ -857,12 +1035,18 @@ void l2c_lcc_proc_pdu(tL2C_CCB* p_ccb, BT_HDR* p_buf) {
       L2CAP_TRACE_ERROR("%s: Invalid sdu_length: %d", __func__, sdu_length);
       android_errorWriteWithInfoLog(0x534e4554, "112321180", -1, NULL, 0);
       /* Discard the buffer */
+#if (L2CAP_CHANNEL_STATS == TRUE)
+      l2cu_channel_stats_rx_drop(p_ccb);
+#endif
       osi_free(p_buf);
       return;
     }
 
     p_data = (BT_HDR*)osi_malloc(BT_HDR_SIZE + sdu_length);
     if (p_data == NULL) {
+#if (L2CAP_CHANNEL_STATS == TRUE)
+      l2cu_channel_stats_rx_drop(p_ccb);
+#endif
       osi_free(p_buf);
       return;
     }
@@ -880,6 +1064,9 @@ void l2c_lcc_proc_pdu(tL2C_CCB* p_ccb, BT_HDR* p_buf) {
                         __func__, p_data->len,
                         (p_ccb->ble_sdu_length - p_data->len));
       android_errorWriteWithInfoLog(0x534e4554, "75298652", -1, NULL, 0);
+#if (L2CAP_CHANNEL_STATS == TRUE)
+      l2cu_channel_stats_rx_drop(p_ccb);
+#endif
       osi_free(p_buf);
 
       /* Throw away all pending fragments and disconnects */
@@ -892,6 +1079,10 @@ void l2c_lcc_proc_pdu(tL2C_CCB* p_ccb, BT_HDR* p_buf) {
     }
   }
 
+#if (L2CAP_CHANNEL_STATS == TRUE)
+  l2cu_channel_stats_rx(p_ccb, pdu_len);
+#endif
+
   memcpy((uint8_t*)(p_data + 1) + p_data->offset + p_data->len,
          (uint8_t*)(p_buf + 1) + p_buf->offset, p_buf->len);
   p_data->len += p_buf->len;
@@ -1039,7 +1230,7 @@ static bool process_reqseq(tL2C_CCB* p_ccb, uint16_t ctrl_word) {
       if ((ls == L2CAP_FCR_UNSEG_SDU) || (ls == L2CAP_FCR_END_SDU))
         full_sdus_xmitted++;
 
-      osi_free(p_tmp);
+      l2c_fcr_free_wack(p_tmp);
     }
 
     /* If we are still in a wait_ack state, do not mess with the timer */
@@ -1635,7 +1826,7 @@ static bool retransmit_i_frames(tL2C_CCB* p_ccb, uint8_t tx_seq) {
       p_buf = (BT_HDR*)list_node(node_ack);
       node_ack = list_next(node_ack);
 
-      BT_HDR* p_buf2 = l2c_fcr_clone_buf(p_buf, p_buf->offset, p_buf->len);
+      BT_HDR* p_buf2 = l2c_fcr_clone_wack(p_buf);
       if (p_buf2) {
         p_buf2->layer_specific = p_buf->layer_specific;
 
@@ -1676,6 +1867,12 @@ BT_HDR* l2c_fcr_get_next_xmit_sdu_seg(tL2C_CCB* p_ccb,
   BT_HDR *p_buf, *p_xmit;
   uint8_t* p;
   uint16_t max_pdu = p_ccb->tx_mps /* Needed? - L2CAP_MAX_HEADER_FCS*/;
+  uint16_t hdr_len = L2CAP_PKT_OVERHEAD + L2CAP_FCR_OVERHEAD;
+  /* In ERTM mode, the segments of an SDU refer to it until they are acked */
+  bool use_slices = (L2C_FCR_USE_SLICES == TRUE) &&
+                    (p_ccb->peer_cfg.fcr.mode == L2CAP_FCR_ERTM_MODE);
+  tL2C_FCR_TX_SDU* p_sdu = NULL;
+  uint16_t slice_offset = 0, slice_len = 0;
 
   /* If there is anything in the retransmit queue, that goes first
   */
@@ -1722,6 +1919,12 @@ BT_HDR* l2c_fcr_get_next_xmit_sdu_seg(tL2C_CCB* p_ccb,
       p_buf->event = p_ccb->local_cid;
       p_xmit->event = p_ccb->local_cid;
 
+      if (use_slices) {
+        p_sdu = l2c_fcr_get_tx_sdu(p_ccb, p_buf);
+        slice_offset = p_buf->offset;
+        slice_len = max_pdu;
+      }
+
       p_buf->len -= max_pdu;
       p_buf->offset += max_pdu;
 
@@ -1734,6 +1937,27 @@ BT_HDR* l2c_fcr_get_next_xmit_sdu_seg(tL2C_CCB* p_ccb,
           "L2CAP - cannot get buffer for segmentation, max_pdu: %u", max_pdu);
       return (NULL);
     }
+  } else if ((p_buf->event != 0) &&
+             (use_slices || (p_ccb->fcrb.p_tx_sdu != NULL))) {
+    /* Copy the last segment too, so that the SDU stays intact for the
+     * segments waiting for an ack */
+    p_xmit = l2c_fcr_clone_buf(p_buf, L2CAP_MIN_OFFSET + L2CAP_SDU_LEN_OFFSET,
+                               p_buf->len);
+    p_xmit->event = p_ccb->local_cid;
+    p_xmit->layer_specific = p_buf->layer_specific;
+    last_seg = true;
+
+    /* The SDU now belongs to its segments */
+    fixed_queue_try_dequeue(p_ccb->xmit_hold_q);
+    if (use_slices) {
+      p_sdu = l2c_fcr_get_tx_sdu(p_ccb, p_buf);
+      slice_offset = p_buf->offset;
+      slice_len = p_buf->len;
+      p_sdu->in_queue = false;
+      p_ccb->fcrb.p_tx_sdu = NULL;
+    } else {
+      l2c_fcr_free_xmit_sdu(p_ccb, p_buf);
+    }
   } else /* Use the original buffer if no segmentation, or the last segment */
   {
     p_xmit = (BT_HDR*)fixed_queue_try_dequeue(p_ccb->xmit_hold_q);
@@ -1750,6 +1974,7 @@ BT_HDR* l2c_fcr_get_next_xmit_sdu_seg(tL2C_CCB* p_ccb,
   if (first_seg) {
     p_xmit->offset -= L2CAP_SDU_LEN_OVERHEAD;
     p_xmit->len += L2CAP_SDU_LEN_OVERHEAD;
+    hdr_len += L2CAP_SDU_LEN_OVERHEAD;
   }
 
   /* Set the pointer to the beginning of the data */
@@ -1782,8 +2007,15 @@ BT_HDR* l2c_fcr_get_next_xmit_sdu_seg(tL2C_CCB* p_ccb,
   prepare_I_frame(p_ccb, p_xmit, false);
 
   if (p_ccb->peer_cfg.fcr.mode == L2CAP_FCR_ERTM_MODE) {
-    BT_HDR* p_wack =
-        l2c_fcr_clone_buf(p_xmit, HCI_DATA_PREAMBLE_SIZE, p_xmit->len);
+    BT_HDR* p_wack;
+
+    if (p_sdu != NULL) {
+      p_wack =
+          l2c_fcr_new_slice(p_xmit, hdr_len, p_sdu, slice_offset, slice_len);
+    } else {
+      p_wack = l2c_fcr_clone_buf(p_xmit, HCI_DATA_PREAMBLE_SIZE, p_xmit->len);
+      if (p_wack) p_wack->event = 0;
+    }
 
     if (!p_wack) {
       L2CAP_TRACE_ERROR(
@@ -1808,8 +2040,10 @@ BT_HDR* l2c_fcr_get_next_xmit_sdu_seg(tL2C_CCB* p_ccb,
       UINT32_TO_STREAM(p, static_cast<uint32_t>(
                               bluetooth::common::time_get_os_boottime_ms()));
 #endif
-      /* We will not save the FCS in case we reconfigure and change options */
-      if (p_ccb->bypass_fcs != L2CAP_BYPASS_FCS) p_wack->len -= L2CAP_FCS_LEN;
+      /* We will not save the FCS in case we reconfigure and change options.
+       * Slices only hold the headers. */
+      if ((p_ccb->bypass_fcs != L2CAP_BYPASS_FCS) && (p_sdu == NULL))
+        p_wack->len -= L2CAP_FCS_LEN;
 
       p_wack->layer_specific = p_xmit->layer_specific;
       fixed_queue_enqueue(p_ccb->fcrb.waiting_for_ack_q, p_wack);
@@ -74,6 +74,10 @@ static_assert(L2CAP_LE_CREDIT_THRESHOLD < L2CAP_LE_CREDIT_DEFAULT,
 #define L2CAP_BLE_LINK_CONNECT_TIMEOUT_MS (30 * 1000)  /* 30 seconds */
 #define L2CAP_FCR_ACK_TIMEOUT_MS 200                   /* 200 milliseconds */
 
+/* How late the link idle timeout may fire, to share a wakeup with another
+ * alarm */
+#define L2CAP_LINK_IDLE_TIMEOUT_SLACK_MS (1 * 1000) /* 1 second */
+
 /* Define the possible L2CAP channel states. The names of
  * the states may seem a bit strange, but they are taken from
  * the Bluetooth specification.
@@ -183,6 +187,15 @@ typedef enum {
 
 typedef uint8_t tL2C_BLE_FIXED_CHNLS_MASK;
 
+/* An SDU segmented for transmission in ERTM mode. The segments waiting for an
+ * ack keep a reference to it instead of a copy of their payload, and copy it
+ * back only if they are retransmitted. */
+typedef struct {
+  BT_HDR* p_buf;      /* The SDU, or what is left of it to segment */
+  uint16_t ref_count; /* Number of segments waiting for an ack */
+  bool in_queue;      /* The SDU is still owned by the xmit_hold_q */
+} tL2C_FCR_TX_SDU;
+
 typedef struct {
   uint8_t next_tx_seq;       /* Next sequence number to be Tx'ed */
   uint8_t last_rx_ack;       /* Last sequence number ack'ed by the peer */
@@ -203,6 +216,7 @@ typedef struct {
 
   uint16_t rx_sdu_len; /* Length of the SDU being received */
   BT_HDR* p_rx_sdu;    /* Buffer holding the SDU being received */
+  tL2C_FCR_TX_SDU* p_tx_sdu; /* SDU being segmented, in ERTM mode */
   fixed_queue_t*
       waiting_for_ack_q;          /* Buffers sent and waiting for peer to ack */
   fixed_queue_t* srej_rcv_hold_q; /* Buffers rcvd but held pending SREJ rsp */
@@ -264,6 +278,37 @@ typedef struct {
   void* p_ref_data;
 } tL2CAP_SEC_DATA;
 
+/* Number of buckets of the channel queue delay histogram, in ms. Bucket 0
+ * counts zero values, bucket n counts values in [2^(n-1), 2^n), and the last
+ * bucket counts everything above. */
+#define L2C_CHNL_HIST_BUCKETS 12
+
+/* Number of packets of a channel whose enqueue time is tracked. Packets queued
+ * behind a full ring are counted but not timed. */
+#define L2C_CHNL_TIMED_PKTS 32
+
+/* Per channel transmit and receive statistics, reported by
+ * stack_debug_l2cap_api_dump and logged to the metrics when the channel is
+ * released. Only updated when L2CAP_CHANNEL_STATS is TRUE. */
+typedef struct {
+  uint64_t open_ms;       /* Time the CCB was allocated */
+  uint64_t tx_bytes;      /* Payload bytes queued for transmission */
+  uint32_t tx_pkts;       /* SDUs queued for transmission */
+  uint64_t rx_bytes;      /* Payload bytes of the received PDUs */
+  uint32_t rx_pkts;       /* PDUs received */
+  uint32_t rx_dropped;    /* PDUs discarded, not counted in rx_pkts */
+  uint32_t congestion_on; /* Times the channel was reported congested */
+  uint32_t max_delay_ms;  /* Longest time an SDU waited in xmit_hold_q */
+  uint32_t delay_hist[L2C_CHNL_HIST_BUCKETS]; /* xmit_hold_q delay, in ms */
+
+  /* Enqueue times (low 32 bits of the boot time, in ms) of the oldest SDUs
+   * in xmit_hold_q, in queue order */
+  uint32_t enq_ms[L2C_CHNL_TIMED_PKTS];
+  uint8_t enq_first; /* Index of the oldest timed SDU */
+  uint8_t enq_count; /* Number of timed SDUs */
+  uint32_t untimed;  /* SDUs queued behind the timed ones */
+} tL2C_CCB_STATS;
+
 /* Define a channel control block (CCB). There may be many channel control
  * blocks between the same two Bluetooth devices (i.e. on the same link).
  * Each CCB has unique local and remote CIDs. All channel control blocks on
@@ -344,6 +389,8 @@ typedef struct t_l2c_ccb {
   /* Number of LE frames that the remote can send to us (credit count in
    * remote). Valid only for LE CoC */
   uint16_t remote_credit_count;
+
+  tL2C_CCB_STATS stats;
 } tL2C_CCB;
 
 /***********************************************************************
@@ -379,6 +426,56 @@ typedef struct {
 
 #endif /* (L2CAP_ROUND_ROBIN_CHANNEL_SERVICE == TRUE) */
 
+/* Number of buckets of the link statistics histograms. Bucket 0 counts
+ * zero values, bucket n counts values in [2^(n-1), 2^n), and the last bucket
+ * counts everything above. */
+#define L2C_LINK_HIST_BUCKETS 8
+
+/* Weight of a high priority link in the round-robin service of the links that
+ * have no quota of their own: number of packets it may send per turn */
+#define L2CAP_HIGH_PRI_RR_WEIGHT 2
+
+/* Per link transmit statistics, reported by stack_debug_l2cap_api_dump */
+typedef struct {
+  uint32_t tx_pkts;  /* Packets passed to the controller */
+  uint32_t tx_segs;  /* Controller buffers used by those packets */
+  uint32_t stalls;   /* Times the link had data but no controller buffer */
+  uint16_t max_backlog; /* Deepest backlog seen when stalled, in packets */
+  uint32_t backlog_hist[L2C_LINK_HIST_BUCKETS]; /* Backlog when stalled */
+  uint32_t wait_ms_hist[L2C_LINK_HIST_BUCKETS]; /* Stall duration, in ms */
+  uint64_t stalled_since_ms; /* Start of the current stall, 0 if none */
+} tL2C_LINK_STATS;
+
+/* Latency needs of the traffic of an LE link, see l2c_ble_tune.cc */
+#define L2C_BLE_LATENCY_DEFAULT 0 /* ATT requests and notifications */
+#define L2C_BLE_LATENCY_STREAM 1  /* Data on LE credit based channels */
+
+/* What the tuning of an LE link last asked for, see l2c_ble_tune.cc */
+#define L2C_BLE_TUNE_NONE 0
+#define L2C_BLE_TUNE_SPEED_UP 1 /* Data length, 2M PHY and a fast interval */
+#define L2C_BLE_TUNE_RELAX 2    /* Back to the default interval */
+
+/* Traffic and tuning state of an LE link, see l2c_ble_tune.cc */
+typedef struct {
+  uint32_t tx_bytes; /* Sent since the last sample */
+  uint32_t rx_bytes; /* Received since the last sample */
+  uint64_t sample_ms; /* Time of the last sample, 0 before the first */
+  uint32_t last_bps;  /* Throughput of the last sample, in bytes/s */
+  uint32_t peak_bps;
+  bool active;          /* Tuned for the traffic, not relaxed */
+  uint8_t quiet_samples; /* Samples under the idle threshold while active */
+  bool params_owned; /* The intervals were set by a profile or the peer */
+  bool data_len_requested; /* The maximum data length was asked for */
+  bool phy_requested;       /* The 2M PHY was asked for */
+  uint8_t tx_phy;           /* From the last PHY update, 0 if none */
+  uint8_t rx_phy;
+  uint16_t interval; /* Current interval, 1.25 ms units */
+  uint8_t last_decision; /* L2C_BLE_TUNE_* */
+  uint64_t last_decision_ms;
+  uint32_t speed_ups;
+  uint32_t relaxes;
+} tL2C_BLE_TUNE;
+
 /* Define a link control block. There is one link control block between
  * this device and any other device (i.e. BD ADDR).
 */
@@ -457,8 +554,16 @@ typedef struct t_l2c_linkcb {
   uint8_t rr_pri; /* current serving priority group */
 #endif
 
+  tL2C_LINK_STATS stats;
+  tL2C_BLE_TUNE ble_tune;
 } tL2C_LCB;
 
+/* ACL connection handles are 12 bits wide */
+#define L2C_LCB_HANDLE_TABLE_SIZE 0x1000
+
+static_assert(MAX_L2CAP_LINKS < 0xFF,
+              "lcb_by_handle entries must fit a 1-based LCB index");
+
 /* Define the L2CAP control structure
 */
 typedef struct {
@@ -468,6 +573,7 @@ typedef struct {
   uint16_t round_robin_quota;   /* Round-robin link quota */
   uint16_t round_robin_unacked; /* Round-robin unacked */
   bool check_round_robin;       /* Do a round robin check */
+  uint8_t round_robin_next;     /* Index of the next LCB to serve */
 
   bool is_cong_cback_context;
 
@@ -475,6 +581,10 @@ typedef struct {
   tL2C_CCB ccb_pool[MAX_L2CAP_CHANNELS]; /* Channel Control Block pool */
   tL2C_RCB rcb_pool[MAX_L2CAP_CLIENTS];  /* Registration info pool */
 
+  /* Handle to LCB map: 1-based index into lcb_pool, 0 if no LCB owns the
+   * handle. Maintained by l2cu_set_lcb_handle() and l2cu_release_lcb(). */
+  uint8_t lcb_by_handle[L2C_LCB_HANDLE_TABLE_SIZE];
+
   tL2C_CCB* p_free_ccb_first; /* Pointer to first free CCB */
   tL2C_CCB* p_free_ccb_last;  /* Pointer to last  free CCB */
 
@@ -507,6 +617,7 @@ typedef struct {
 #endif
 
   uint16_t num_ble_links_active; /* Number of LE links active */
+  alarm_t* ble_tune_timer; /* Samples the traffic of the LE links */
   uint16_t controller_le_xmit_window; /* Total ACL window for all links */
   tL2C_BLE_FIXED_CHNLS_MASK l2c_ble_fixed_chnls_mask;  // LE fixed channels mask
   uint16_t num_lm_ble_bufs;         /* # of ACL buffers on controller */
@@ -594,6 +705,7 @@ extern void l2cu_release_lcb(tL2C_LCB* p_lcb);
 extern tL2C_LCB* l2cu_find_lcb_by_bd_addr(const RawAddress& p_bd_addr,
                                           tBT_TRANSPORT transport);
 extern tL2C_LCB* l2cu_find_lcb_by_handle(uint16_t handle);
+extern void l2cu_set_lcb_handle(tL2C_LCB* p_lcb, uint16_t handle);
 extern void l2cu_update_lcb_4_bonding(const RawAddress& p_bd_addr,
                                       bool is_bonding);
 
@@ -620,7 +732,7 @@ extern void l2cu_send_peer_connect_rsp(tL2C_CCB* p_ccb, uint16_t result,
                                        uint16_t status);
 extern void l2cu_send_peer_config_req(tL2C_CCB* p_ccb, tL2CAP_CFG_INFO* p_cfg);
 extern void l2cu_send_peer_config_rsp(tL2C_CCB* p_ccb, tL2CAP_CFG_INFO* p_cfg);
-extern void l2cu_send_peer_config_rej(tL2C_CCB* p_ccb, uint8_t* p_data,
+extern void l2cu_send_peer_config_rej(tL2C_CCB* p_ccb, const uint8_t* p_data,
                                       uint16_t data_len, uint16_t rej_len);
 extern void l2cu_send_peer_disc_req(tL2C_CCB* p_ccb);
 extern void l2cu_send_peer_disc_rsp(tL2C_LCB* p_lcb, uint8_t remote_id,
@@ -628,7 +740,7 @@ extern void l2cu_send_peer_disc_rsp(tL2C_LCB* p_lcb, uint8_t remote_id,
 extern void l2cu_send_peer_echo_req(tL2C_LCB* p_lcb, uint8_t* p_data,
                                     uint16_t data_len);
 extern void l2cu_send_peer_echo_rsp(tL2C_LCB* p_lcb, uint8_t id,
-                                    uint8_t* p_data, uint16_t data_len);
+                                    const uint8_t* p_data, uint16_t data_len);
 extern void l2cu_send_peer_info_rsp(tL2C_LCB* p_lcb, uint8_t id,
                                     uint16_t info_type);
 extern void l2cu_reject_connection(tL2C_LCB* p_lcb, uint16_t remote_cid,
@@ -636,6 +748,14 @@ extern void l2cu_reject_connection(tL2C_LCB* p_lcb, uint16_t remote_cid,
 extern void l2cu_send_peer_info_req(tL2C_LCB* p_lcb, uint16_t info_type);
 extern void l2cu_set_acl_hci_header(BT_HDR* p_buf, tL2C_CCB* p_ccb);
 extern void l2cu_check_channel_congestion(tL2C_CCB* p_ccb);
+extern uint8_t l2cu_hist_bucket(uint64_t value, uint8_t num_buckets);
+#if (L2CAP_CHANNEL_STATS == TRUE)
+extern void l2cu_channel_stats_tx(tL2C_CCB* p_ccb, uint16_t len);
+extern void l2cu_channel_stats_rx(tL2C_CCB* p_ccb, uint16_t len);
+extern void l2cu_channel_stats_rx_drop(tL2C_CCB* p_ccb);
+#endif
+extern uint32_t l2cu_channel_delay_percentile(const tL2C_CCB_STATS* p_stats,
+                                              uint8_t percent);
 extern void l2cu_disconnect_chnl(tL2C_CCB* p_ccb);
 
 extern void l2cu_tx_complete(tL2C_TX_COMPLETE_CB_INFO* p_cbi);
@@ -758,6 +878,7 @@ extern void l2c_fcr_proc_tout(tL2C_CCB* p_ccb);
 extern void l2c_fcr_proc_ack_tout(tL2C_CCB* p_ccb);
 extern void l2c_fcr_send_S_frame(tL2C_CCB* p_ccb, uint16_t function_code,
                                  uint16_t pf_bit);
+extern void l2c_fcr_free_xmit_sdu(tL2C_CCB* p_ccb, BT_HDR* p_buf);
 extern BT_HDR* l2c_fcr_clone_buf(BT_HDR* p_buf, uint16_t new_offset,
                                  uint16_t no_of_bytes);
 extern bool l2c_fcr_is_flow_controlled(tL2C_CCB* p_ccb);
@@ -822,6 +943,23 @@ extern void l2cble_process_data_length_change_event(uint16_t handle,
                                                     uint16_t tx_data_len,
                                                     uint16_t rx_data_len);
 
+extern void l2cble_tune_conn_params(tL2C_LCB* p_lcb, uint16_t min_int,
+                                    uint16_t max_int, uint16_t latency,
+                                    uint16_t timeout);
+
+/* Functions provided by l2c_ble_tune.cc
+ ****************************************
+*/
+extern void l2cble_tune_link_up(tL2C_LCB* p_lcb, uint16_t interval);
+extern void l2cble_tune_traffic(tL2C_LCB* p_lcb, uint16_t len, bool is_tx);
+extern uint8_t l2cble_tune_sample(tL2C_BLE_TUNE* p_tune, uint64_t now_ms);
+extern uint8_t l2cble_tune_latency_class(const tL2C_LCB* p_lcb);
+extern void l2cble_tune_params_owned(tL2C_LCB* p_lcb);
+extern void l2cble_tune_conn_update(tL2C_LCB* p_lcb, uint16_t interval);
+extern void l2cble_process_phy_update_evt(uint16_t handle, uint8_t status,
+                                          uint8_t tx_phy, uint8_t rx_phy);
+extern void l2cble_tune_dump(int fd, const tL2C_LCB* p_lcb);
+
 extern void l2cu_process_fixed_disc_cback(tL2C_LCB* p_lcb);
 
 #endif
@@ -35,6 +35,8 @@
 #include "btm_api.h"
 #include "btm_int.h"
 #include "btu.h"
+#include "common/time_util.h"
+#include "common/trace.h"
 #include "device/include/controller.h"
 #include "hcimsgs.h"
 #include "l2c_api.h"
@@ -186,7 +188,7 @@ bool l2c_link_hci_conn_comp(uint8_t status, uint16_t handle,
   }
 
   /* Save the handle */
-  p_lcb->handle = handle;
+  l2cu_set_lcb_handle(p_lcb, handle);
 
   if (ci.status == HCI_SUCCESS) {
     /* Connected OK. Change state to connected */
@@ -238,7 +240,7 @@ bool l2c_link_hci_conn_comp(uint8_t status, uint16_t handle,
   else if ((ci.status == HCI_ERR_MAX_NUM_OF_CONNECTIONS) &&
            l2cu_lcb_disconnecting()) {
     p_lcb->link_state = LST_CONNECT_HOLDING;
-    p_lcb->handle = HCI_INVALID_HANDLE;
+    l2cu_set_lcb_handle(p_lcb, HCI_INVALID_HANDLE);
   } else {
     /* Just in case app decides to try again in the callback context */
     p_lcb->link_state = LST_DISCONNECTING;
@@ -959,6 +961,101 @@ bool l2c_link_check_power_mode(tL2C_LCB* p_lcb) {
 }
 #endif /* L2CAP_WAKE_PARKED_LINK == TRUE) */
 
+/*******************************************************************************
+ *
+ * Function         l2c_link_backlog
+ *
+ * Description      Returns the number of packets waiting to be sent on the
+ *                  link, in its link queue and in the queues of its channels.
+ *
+ ******************************************************************************/
+static uint16_t l2c_link_backlog(tL2C_LCB* p_lcb) {
+  size_t backlog = list_length(p_lcb->link_xmit_data_q);
+
+  for (tL2C_CCB* p_ccb = p_lcb->ccb_queue.p_first_ccb; p_ccb;
+       p_ccb = p_ccb->p_next_ccb)
+    backlog += fixed_queue_length(p_ccb->xmit_hold_q);
+
+#if (L2CAP_NUM_FIXED_CHNLS > 0)
+  for (int xx = 0; xx < L2CAP_NUM_FIXED_CHNLS; xx++) {
+    if (p_lcb->p_fixed_ccbs[xx])
+      backlog += fixed_queue_length(p_lcb->p_fixed_ccbs[xx]->xmit_hold_q);
+  }
+#endif
+
+  return (backlog > UINT16_MAX) ? UINT16_MAX : backlog;
+}
+
+/*******************************************************************************
+ *
+ * Function         l2c_link_check_stall
+ *
+ * Description      Called when the link can't send for lack of controller
+ *                  buffers. If it has data waiting, starts timing the stall;
+ *                  it ends when the link sends its next packet.
+ *
+ ******************************************************************************/
+static void l2c_link_check_stall(tL2C_LCB* p_lcb) {
+  tL2C_LINK_STATS* p_stats = &p_lcb->stats;
+
+  if (p_stats->stalled_since_ms != 0) return;
+
+  uint16_t backlog = l2c_link_backlog(p_lcb);
+  if (backlog == 0) return;
+
+  p_stats->stalled_since_ms = bluetooth::common::time_get_os_boottime_ms();
+  p_stats->stalls++;
+  p_stats->backlog_hist[l2cu_hist_bucket(backlog, L2C_LINK_HIST_BUCKETS)]++;
+  if (backlog > p_stats->max_backlog) p_stats->max_backlog = backlog;
+}
+
+/*******************************************************************************
+ *
+ * Function         l2c_link_rr_has_room
+ *
+ * Description      Returns true if the controller window and the round-robin
+ *                  quota of the transport of the link have room for a packet.
+ *
+ ******************************************************************************/
+static bool l2c_link_rr_has_room(const tL2C_LCB* p_lcb) {
+  if (p_lcb->transport == BT_TRANSPORT_LE)
+    return (l2cb.controller_le_xmit_window != 0) &&
+           (l2cb.ble_round_robin_unacked < l2cb.ble_round_robin_quota);
+
+  return (l2cb.controller_xmit_window != 0) &&
+         (l2cb.round_robin_unacked < l2cb.round_robin_quota);
+}
+
+/*******************************************************************************
+ *
+ * Function         l2c_link_send_next
+ *
+ * Description      Sends the next packet of the link, from the link queue or,
+ *                  unless link_queue_only is set, from its channels.
+ *
+ * Returns          true if a packet was sent
+ *
+ ******************************************************************************/
+static bool l2c_link_send_next(tL2C_LCB* p_lcb, bool link_queue_only) {
+  BT_HDR* p_buf;
+
+  /* See if we can send anything from the Link Queue */
+  if (!list_is_empty(p_lcb->link_xmit_data_q)) {
+    p_buf = (BT_HDR*)list_front(p_lcb->link_xmit_data_q);
+    list_remove(p_lcb->link_xmit_data_q, p_buf);
+    return l2c_link_send_to_lower(p_lcb, p_buf, NULL);
+  }
+
+  if (link_queue_only) return false;
+
+  /* If nothing on the link queue, check the channel queue */
+  tL2C_TX_COMPLETE_CB_INFO cbi;
+  p_buf = l2cu_get_next_buffer_to_send(p_lcb, &cbi);
+  if (p_buf == NULL) return false;
+
+  return l2c_link_send_to_lower(p_lcb, p_buf, &cbi);
+}
+
 /*******************************************************************************
  *
  * Function         l2c_link_check_send_pkts
@@ -971,6 +1068,7 @@ bool l2c_link_check_power_mode(tL2C_LCB* p_lcb) {
  *
  ******************************************************************************/
 void l2c_link_check_send_pkts(tL2C_LCB* p_lcb, tL2C_CCB* p_ccb, BT_HDR* p_buf) {
+  BT_TRACE_SCOPE("l2c_link_check_send_pkts", p_buf);
   int xx;
   bool single_write = false;
 
@@ -1004,7 +1102,7 @@ void l2c_link_check_send_pkts(tL2C_LCB* p_lcb, tL2C_CCB* p_ccb, BT_HDR* p_buf) {
   */
   if ((p_lcb == NULL) || (p_lcb->link_xmit_quota == 0)) {
     if (p_lcb == NULL)
-      p_lcb = l2cb.lcb_pool;
+      p_lcb = &l2cb.lcb_pool[l2cb.round_robin_next % MAX_L2CAP_LINKS];
     else if (!single_write)
       p_lcb++;
 
@@ -1014,36 +1112,36 @@ void l2c_link_check_send_pkts(tL2C_LCB* p_lcb, tL2C_CCB* p_ccb, BT_HDR* p_buf) {
       if (p_lcb == &l2cb.lcb_pool[MAX_L2CAP_LINKS]) p_lcb = &l2cb.lcb_pool[0];
 
       /* If controller window is full, nothing to do */
-      if (((l2cb.controller_xmit_window == 0 ||
-            (l2cb.round_robin_unacked >= l2cb.round_robin_quota)) &&
-           (p_lcb->transport == BT_TRANSPORT_BR_EDR)) ||
-          (p_lcb->transport == BT_TRANSPORT_LE &&
-           (l2cb.ble_round_robin_unacked >= l2cb.ble_round_robin_quota ||
-            l2cb.controller_le_xmit_window == 0)))
+      if (!l2c_link_rr_has_room(p_lcb)) {
+        if (p_lcb->in_use && (p_lcb->link_state == LST_CONNECTED) &&
+            (p_lcb->link_xmit_quota == 0))
+          l2c_link_check_stall(p_lcb);
         continue;
+      }
 
       if ((!p_lcb->in_use) || (p_lcb->partial_segment_being_sent) ||
           (p_lcb->link_state != LST_CONNECTED) ||
           (p_lcb->link_xmit_quota != 0) || (L2C_LINK_CHECK_POWER_MODE(p_lcb)))
         continue;
 
-      /* See if we can send anything from the Link Queue */
-      if (!list_is_empty(p_lcb->link_xmit_data_q)) {
-        p_buf = (BT_HDR*)list_front(p_lcb->link_xmit_data_q);
-        list_remove(p_lcb->link_xmit_data_q, p_buf);
-        l2c_link_send_to_lower(p_lcb, p_buf, NULL);
-      } else if (single_write) {
-        /* If only doing one write, break out */
-        break;
-      }
-      /* If nothing on the link queue, check the channel queue */
-      else {
-        tL2C_TX_COMPLETE_CB_INFO cbi;
-        p_buf = l2cu_get_next_buffer_to_send(p_lcb, &cbi);
-        if (p_buf != NULL) {
-          l2c_link_send_to_lower(p_lcb, p_buf, &cbi);
-        }
-      }
+      /* If only doing one write, break out once the link queues are empty */
+      if (single_write && list_is_empty(p_lcb->link_xmit_data_q)) break;
+
+      /* High priority links get a larger share of each turn */
+      int weight = (p_lcb->acl_priority == L2CAP_PRIORITY_HIGH)
+                       ? L2CAP_HIGH_PRI_RR_WEIGHT
+                       : 1;
+      int sent = 0;
+      while (sent < weight &&
+             (sent == 0 || (!p_lcb->partial_segment_being_sent &&
+                            l2c_link_rr_has_room(p_lcb))) &&
+             l2c_link_send_next(p_lcb, single_write))
+        sent++;
+
+      /* The next round starts after the last link served, rather than at
+       * the start of the pool, so that no link is always served first */
+      if (sent > 0)
+        l2cb.round_robin_next = (p_lcb - l2cb.lcb_pool + 1) % MAX_L2CAP_LINKS;
     }
 
     /* If we finished without using up our quota, no need for a safety check */
@@ -1092,6 +1190,12 @@ void l2c_link_check_send_pkts(tL2C_LCB* p_lcb, tL2C_CCB* p_ccb, BT_HDR* p_buf) {
       }
     }
 
+    if ((p_lcb->sent_not_acked >= p_lcb->link_xmit_quota) ||
+        ((p_lcb->transport == BT_TRANSPORT_LE)
+             ? (l2cb.controller_le_xmit_window == 0)
+             : (l2cb.controller_xmit_window == 0)))
+      l2c_link_check_stall(p_lcb);
+
     /* There is a special case where we have readjusted the link quotas and  */
     /* this link may have sent anything but some other link sent packets so  */
     /* so we may need a timer to kick off this link's transmissions.         */
@@ -1118,6 +1222,19 @@ static bool l2c_link_send_to_lower(tL2C_LCB* p_lcb, BT_HDR* p_buf,
   uint16_t num_segs;
   uint16_t xmit_window, acl_data_size;
   const controller_t* controller = controller_get_interface();
+  tL2C_LINK_STATS* p_stats = &p_lcb->stats;
+
+  if (p_stats->stalled_since_ms != 0) {
+    uint64_t wait_ms = bluetooth::common::time_get_os_boottime_ms() -
+                       p_stats->stalled_since_ms;
+    p_stats->wait_ms_hist[l2cu_hist_bucket(wait_ms, L2C_LINK_HIST_BUCKETS)]++;
+    p_stats->stalled_since_ms = 0;
+  }
+  p_stats->tx_pkts++;
+  if (p_lcb->transport == BT_TRANSPORT_BR_EDR)
+    btm_pm_policy_traffic(p_lcb->handle);
+  else
+    l2cble_tune_traffic(p_lcb, p_buf->len, true);
 
   if ((p_buf->len <= controller->get_acl_packet_size_classic() &&
        (p_lcb->transport == BT_TRANSPORT_BR_EDR)) ||
@@ -1130,6 +1247,7 @@ static bool l2c_link_send_to_lower(tL2C_LCB* p_lcb, BT_HDR* p_buf,
         l2cb.round_robin_unacked++;
     }
     p_lcb->sent_not_acked++;
+    p_stats->tx_segs++;
     p_buf->layer_specific = 0;
 
     if (p_lcb->transport == BT_TRANSPORT_LE) {
@@ -1180,6 +1298,7 @@ static bool l2c_link_send_to_lower(tL2C_LCB* p_lcb, BT_HDR* p_buf,
     }
 
     p_lcb->sent_not_acked += num_segs;
+    p_stats->tx_segs += num_segs;
     if (p_lcb->transport == BT_TRANSPORT_LE) {
       bte_main_hci_send(
           p_buf, (uint16_t)(BT_EVT_TO_LM_HCI_ACL | LOCAL_BLE_CONTROLLER_ID));
@@ -1221,10 +1340,13 @@ static bool l2c_link_send_to_lower(tL2C_LCB* p_lcb, BT_HDR* p_buf,
  *
  ******************************************************************************/
 void l2c_link_process_num_completed_pkts(uint8_t* p, uint8_t evt_len) {
-  uint8_t num_handles, xx;
+  uint8_t num_handles, xx, yy;
   uint16_t handle;
   uint16_t num_sent;
   tL2C_LCB* p_lcb;
+  tL2C_LCB* completed[MAX_L2CAP_LINKS];
+  uint8_t num_completed = 0;
+  uint8_t num_rr_completed = 0;
 
   if (evt_len > 0) {
     STREAM_TO_UINT8(num_handles, p);
@@ -1237,6 +1359,8 @@ void l2c_link_process_num_completed_pkts(uint8_t* p, uint8_t evt_len) {
     num_handles = evt_len / (2 * sizeof(uint16_t));
   }
 
+  /* Credit all the links first, so that the freed buffers are shared according
+   * to priority rather than to the order of the handles in the event */
   for (xx = 0; xx < num_handles; xx++) {
     STREAM_TO_UINT16(handle, p);
     STREAM_TO_UINT16(num_sent, p);
@@ -1280,19 +1404,11 @@ void l2c_link_process_num_completed_pkts(uint8_t* p, uint8_t evt_len) {
       else
         p_lcb->sent_not_acked = 0;
 
-      l2c_link_check_send_pkts(p_lcb, NULL, NULL);
-
-      /* If we were doing round-robin for low priority links, check 'em */
-      if ((p_lcb->acl_priority == L2CAP_PRIORITY_HIGH) &&
-          (l2cb.check_round_robin) &&
-          (l2cb.round_robin_unacked < l2cb.round_robin_quota)) {
-        l2c_link_check_send_pkts(NULL, NULL, NULL);
-      }
-      if ((p_lcb->transport == BT_TRANSPORT_LE) &&
-          (p_lcb->acl_priority == L2CAP_PRIORITY_HIGH) &&
-          ((l2cb.ble_check_round_robin) &&
-           (l2cb.ble_round_robin_unacked < l2cb.ble_round_robin_quota))) {
-        l2c_link_check_send_pkts(NULL, NULL, NULL);
+      for (yy = 0; yy < num_completed && completed[yy] != p_lcb; yy++)
+        ;
+      if (yy == num_completed) {
+        completed[num_completed++] = p_lcb;
+        if (p_lcb->link_xmit_quota == 0) num_rr_completed++;
       }
     }
 
@@ -1318,6 +1434,36 @@ void l2c_link_process_num_completed_pkts(uint8_t* p, uint8_t evt_len) {
     }
 #endif
   }
+
+  /* Serve the links with a quota of their own, high priority first. Each of
+   * them only looks at its own queues. */
+  for (int high_pri = 1; high_pri >= 0; high_pri--) {
+    for (yy = 0; yy < num_completed; yy++) {
+      p_lcb = completed[yy];
+      if ((p_lcb->acl_priority == L2CAP_PRIORITY_HIGH) != (high_pri == 1) ||
+          (p_lcb->link_xmit_quota == 0))
+        continue;
+
+      l2c_link_check_send_pkts(p_lcb, NULL, NULL);
+    }
+  }
+
+  /* The links in round-robin share the freed buffers: serve them all in one
+   * walk, rather than walking every link once per handle of the event. Serve
+   * them again, up to once per completed round-robin link, only as long as a
+   * walk sends something. */
+  bool rr_pending =
+      (num_rr_completed > 0) ||
+      (l2cb.check_round_robin &&
+       (l2cb.round_robin_unacked < l2cb.round_robin_quota)) ||
+      (l2cb.ble_check_round_robin &&
+       (l2cb.ble_round_robin_unacked < l2cb.ble_round_robin_quota));
+  for (yy = 0; rr_pending && (yy == 0 || yy < num_rr_completed); yy++) {
+    uint16_t unacked = l2cb.round_robin_unacked + l2cb.ble_round_robin_unacked;
+    l2c_link_check_send_pkts(NULL, NULL, NULL);
+    rr_pending =
+        (l2cb.round_robin_unacked + l2cb.ble_round_robin_unacked) != unacked;
+  }
 }
 
 /*******************************************************************************
@@ -30,7 +30,9 @@
 
 #include "bt_common.h"
 #include "bt_target.h"
+#include "btm_int.h"
 #include "btu.h"
+#include "common/trace.h"
 #include "device/include/controller.h"
 #include "hci/include/btsnoop.h"
 #include "hcimsgs.h"
@@ -39,6 +41,7 @@
 #include "l2cdefs.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
+#include "stream_reader.h"
 
 /******************************************************************************/
 /*            L O C A L    F U N C T I O N     P R O T O T Y P E S            */
@@ -61,6 +64,7 @@ tL2C_CB l2cb;
  *
  ******************************************************************************/
 void l2c_rcv_acl_data(BT_HDR* p_msg) {
+  BT_TRACE_SCOPE("l2c_rcv_acl_data", p_msg);
   uint8_t* p = (uint8_t*)(p_msg + 1) + p_msg->offset;
 
   /* Extract the handle */
@@ -148,6 +152,13 @@ void l2c_rcv_acl_data(BT_HDR* p_msg) {
     l2cble_notify_le_connection(p_lcb->remote_bd_addr);
   }
 
+  /* the power mode of BR/EDR links and the tuning of LE links follow their
+   * traffic */
+  if (p_lcb->transport == BT_TRANSPORT_BR_EDR)
+    btm_pm_policy_traffic(handle);
+  else
+    l2cble_tune_traffic(p_lcb, hci_len, false);
+
   /* Find the CCB for this CID */
   tL2C_CCB* p_ccb = NULL;
   if (rcv_cid >= L2CAP_BASE_APPL_CID) {
@@ -206,6 +217,9 @@ void l2c_rcv_acl_data(BT_HDR* p_msg) {
 
     /* If no CCB for this channel, allocate one */
     p_ccb = p_lcb->p_fixed_ccbs[rcv_cid - L2CAP_FIRST_FIXED_CHNL];
+#if (L2CAP_CHANNEL_STATS == TRUE)
+    l2cu_channel_stats_rx(p_ccb, p_msg->len);
+#endif
 
     if (p_ccb->peer_cfg.fcr.mode != L2CAP_FCR_BASIC_MODE)
       l2c_fcr_proc_pdu(p_ccb, p_msg);
@@ -236,6 +250,14 @@ void l2c_rcv_acl_data(BT_HDR* p_msg) {
       l2c_csm_execute(p_ccb, L2CEVT_L2CA_SEND_FLOW_CONTROL_CREDIT, &credits);
     }
   } else {
+#if (L2CAP_CHANNEL_STATS == TRUE)
+    /* Only a channel being configured or open takes data, in any mode */
+    if ((p_ccb->chnl_state == CST_OPEN) || (p_ccb->chnl_state == CST_CONFIG))
+      l2cu_channel_stats_rx(p_ccb, p_msg->len);
+    else
+      l2cu_channel_stats_rx_drop(p_ccb);
+#endif
+
     /* Basic mode packets go straight to the state machine */
     if (p_ccb->peer_cfg.fcr.mode == L2CAP_FCR_BASIC_MODE)
       l2c_csm_execute(p_ccb, L2CEVT_L2CAP_DATA, p_msg);
@@ -249,6 +271,115 @@ void l2c_rcv_acl_data(BT_HDR* p_msg) {
   }
 }
 
+/* Layouts of the values of the configuration options */
+using L2capCfgMtu = StreamLayout<uint16_t>;
+using L2capCfgFlushTout = StreamLayout<uint16_t>;
+using L2capCfgQos = StreamLayout<uint8_t, uint8_t, uint32_t, uint32_t,
+                                 uint32_t, uint32_t, uint32_t>;
+using L2capCfgFcr =
+    StreamLayout<uint8_t, uint8_t, uint8_t, uint16_t, uint16_t, uint16_t>;
+using L2capCfgFcs = StreamLayout<uint8_t>;
+using L2capCfgExtFlow =
+    StreamLayout<uint8_t, uint8_t, uint16_t, uint32_t, uint32_t, uint32_t>;
+
+static_assert(L2capCfgQos::kSize == 2 + 5 * 4, "bad QoS option layout");
+static_assert(L2capCfgFcr::kSize == 3 + 3 * 2, "bad FCR option layout");
+static_assert(L2capCfgExtFlow::kSize == 2 + 2 + 3 * 4,
+              "bad extended flow spec option layout");
+
+/*******************************************************************************
+ *
+ * Function         l2c_cfg_option_len
+ *
+ * Description      This function returns the length of the value of the
+ *                  configuration option of type |cfg_type|
+ *
+ * Returns          the length, or 0 if the option is not known
+ *
+ ******************************************************************************/
+static size_t l2c_cfg_option_len(uint8_t cfg_type) {
+  switch (cfg_type) {
+    case L2CAP_CFG_TYPE_MTU:
+      return L2capCfgMtu::kSize;
+    case L2CAP_CFG_TYPE_FLUSH_TOUT:
+      return L2capCfgFlushTout::kSize;
+    case L2CAP_CFG_TYPE_QOS:
+      return L2capCfgQos::kSize;
+    case L2CAP_CFG_TYPE_FCR:
+      return L2capCfgFcr::kSize;
+    case L2CAP_CFG_TYPE_FCS:
+      return L2capCfgFcs::kSize;
+    case L2CAP_CFG_TYPE_EXT_FLOW:
+      return L2capCfgExtFlow::kSize;
+    default:
+      return 0;
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         l2c_read_cfg_option
+ *
+ * Description      This function reads the value of the configuration option
+ *                  of type |cfg_type| from |value| into |p_cfg|, and marks it
+ *                  present. Options that are not known are ignored.
+ *
+ * Returns          false if the value is too short for the option
+ *
+ ******************************************************************************/
+static bool l2c_read_cfg_option(uint8_t cfg_type, StreamReader* value,
+                                tL2CAP_CFG_INFO* p_cfg) {
+  switch (cfg_type) {
+    case L2CAP_CFG_TYPE_MTU:
+      p_cfg->mtu_present = true;
+      return value->Read(&p_cfg->mtu);
+
+    case L2CAP_CFG_TYPE_FLUSH_TOUT:
+      p_cfg->flush_to_present = true;
+      return value->Read(&p_cfg->flush_to);
+
+    case L2CAP_CFG_TYPE_QOS: {
+      p_cfg->qos_present = true;
+      auto qos = value->Read<L2capCfgQos>();
+      if (!qos) return false;
+      std::tie(p_cfg->qos.qos_flags, p_cfg->qos.service_type,
+               p_cfg->qos.token_rate, p_cfg->qos.token_bucket_size,
+               p_cfg->qos.peak_bandwidth, p_cfg->qos.latency,
+               p_cfg->qos.delay_variation) = *qos;
+      return true;
+    }
+
+    case L2CAP_CFG_TYPE_FCR: {
+      p_cfg->fcr_present = true;
+      auto fcr = value->Read<L2capCfgFcr>();
+      if (!fcr) return false;
+      std::tie(p_cfg->fcr.mode, p_cfg->fcr.tx_win_sz, p_cfg->fcr.max_transmit,
+               p_cfg->fcr.rtrans_tout, p_cfg->fcr.mon_tout, p_cfg->fcr.mps) =
+          *fcr;
+      return true;
+    }
+
+    case L2CAP_CFG_TYPE_FCS:
+      p_cfg->fcs_present = true;
+      return value->Read(&p_cfg->fcs);
+
+    case L2CAP_CFG_TYPE_EXT_FLOW: {
+      p_cfg->ext_flow_spec_present = true;
+      auto ext_flow = value->Read<L2capCfgExtFlow>();
+      if (!ext_flow) return false;
+      std::tie(p_cfg->ext_flow_spec.id, p_cfg->ext_flow_spec.stype,
+               p_cfg->ext_flow_spec.max_sdu_size,
+               p_cfg->ext_flow_spec.sdu_inter_time,
+               p_cfg->ext_flow_spec.access_latency,
+               p_cfg->ext_flow_spec.flush_timeout) = *ext_flow;
+      return true;
+    }
+
+    default:
+      return true;
+  }
+}
+
 /*******************************************************************************
  *
  * Function         process_l2cap_cmd
@@ -277,8 +408,7 @@ static void process_l2cap_cmd(tL2C_LCB* p_lcb, uint8_t* p, uint16_t pkt_len) {
     L2CAP_TRACE_ERROR("L2CAP SIG MTU pkt_len=%d Exceeded 672", pkt_len);
   }
 
-  uint8_t* p_next_cmd = p;
-  uint8_t* p_pkt_end = p + pkt_len;
+  StreamReader pkt(p, pkt_len);
 
   tL2CAP_CFG_INFO cfg_info;
   memset(&cfg_info, 0, sizeof(cfg_info));
@@ -286,14 +416,9 @@ static void process_l2cap_cmd(tL2C_LCB* p_lcb, uint8_t* p, uint16_t pkt_len) {
   /* An L2CAP packet may contain multiple commands */
   while (true) {
     /* Smallest command is 4 bytes */
-    p = p_next_cmd;
-    if (p > (p_pkt_end - 4)) break;
-
     uint8_t cmd_code, id;
     uint16_t cmd_len;
-    STREAM_TO_UINT8(cmd_code, p);
-    STREAM_TO_UINT8(id, p);
-    STREAM_TO_UINT16(cmd_len, p);
+    if (!pkt.Read(&cmd_code, &id, &cmd_len)) break;
 
     if (cmd_len > BT_SMALL_BUFFER_SIZE) {
       L2CAP_TRACE_WARNING("L2CAP - Invalid MTU Size");
@@ -302,12 +427,12 @@ static void process_l2cap_cmd(tL2C_LCB* p_lcb, uint8_t* p, uint16_t pkt_len) {
     }
 
     /* Check command length does not exceed packet length */
-    p_next_cmd = p + cmd_len;
-    if (p_next_cmd > p_pkt_end) {
+    if (cmd_len > pkt.Remaining()) {
       L2CAP_TRACE_WARNING("Command len bad  pkt_len: %d  cmd_len: %d  code: %d",
                           pkt_len, cmd_len, cmd_code);
       break;
     }
+    StreamReader cmd = pkt.Sub(cmd_len);
 
     L2CAP_TRACE_DEBUG("cmd_code: %d, id:%d, cmd_len:%d", cmd_code, id, cmd_len);
 
@@ -323,12 +448,10 @@ static void process_l2cap_cmd(tL2C_LCB* p_lcb, uint8_t* p, uint16_t pkt_len) {
     switch (cmd_code) {
       case L2CAP_CMD_REJECT:
         uint16_t rej_reason;
-        if (p + 2 > p_next_cmd) return;
-        STREAM_TO_UINT16(rej_reason, p);
+        if (!cmd.Read(&rej_reason)) return;
         if (rej_reason == L2CAP_CMD_REJ_MTU_EXCEEDED) {
           uint16_t rej_mtu;
-          if (p + 2 > p_next_cmd) return;
-          STREAM_TO_UINT16(rej_mtu, p);
+          if (!cmd.Read(&rej_mtu)) return;
           /* What to do with the MTU reject ? We have negotiated an MTU. For now
            * we will ignore it and let a higher protocol timeout take care of it
            */
@@ -337,9 +460,7 @@ static void process_l2cap_cmd(tL2C_LCB* p_lcb, uint8_t* p, uint16_t pkt_len) {
         }
         if (rej_reason == L2CAP_CMD_REJ_INVALID_CID) {
           uint16_t lcid, rcid;
-          if (p + 4 > p_next_cmd) return;
-          STREAM_TO_UINT16(rcid, p);
-          STREAM_TO_UINT16(lcid, p);
+          if (!cmd.Read(&rcid, &lcid)) return;
 
           L2CAP_TRACE_WARNING(
               "L2CAP - rej with CID invalid, LCID: 0x%04x RCID: 0x%04x", lcid,
@@ -373,9 +494,7 @@ static void process_l2cap_cmd(tL2C_LCB* p_lcb, uint8_t* p, uint16_t pkt_len) {
 
       case L2CAP_CMD_CONN_REQ: {
         uint16_t rcid;
-        if (p + 4 > p_next_cmd) return;
-        STREAM_TO_UINT16(con_info.psm, p);
-        STREAM_TO_UINT16(rcid, p);
+        if (!cmd.Read(&con_info.psm, &rcid)) return;
         tL2C_RCB* p_rcb = l2cu_find_rcb_by_psm(con_info.psm);
         if (!p_rcb) {
           L2CAP_TRACE_WARNING("L2CAP - rcvd conn req for unknown PSM: %d",
@@ -415,11 +534,9 @@ static void process_l2cap_cmd(tL2C_LCB* p_lcb, uint8_t* p, uint16_t pkt_len) {
 
       case L2CAP_CMD_CONN_RSP: {
         uint16_t lcid;
-        if (p + 8 > p_next_cmd) return;
-        STREAM_TO_UINT16(con_info.remote_cid, p);
-        STREAM_TO_UINT16(lcid, p);
-        STREAM_TO_UINT16(con_info.l2cap_result, p);
-        STREAM_TO_UINT16(con_info.l2cap_status, p);
+        if (!cmd.Read(&con_info.remote_cid, &lcid, &con_info.l2cap_result,
+                      &con_info.l2cap_status))
+          return;
 
         tL2C_CCB* p_ccb = l2cu_find_ccb_by_cid(p_lcb, lcid);
         if (!p_ccb) {
@@ -453,139 +570,49 @@ static void process_l2cap_cmd(tL2C_LCB* p_lcb, uint8_t* p, uint16_t pkt_len) {
       }
 
       case L2CAP_CMD_CONFIG_REQ: {
-        uint8_t* p_cfg_end = p + cmd_len;
         bool cfg_rej = false;
         uint16_t cfg_rej_len = 0;
 
         uint16_t lcid;
-        if (p + 4 > p_next_cmd) return;
-        STREAM_TO_UINT16(lcid, p);
-        STREAM_TO_UINT16(cfg_info.flags, p);
+        if (!cmd.Read(&lcid, &cfg_info.flags)) return;
 
-        uint8_t* p_cfg_start = p;
+        const uint8_t* p_cfg_start = cmd.Data();
 
         cfg_info.flush_to_present = cfg_info.mtu_present =
             cfg_info.qos_present = cfg_info.fcr_present = cfg_info.fcs_present =
                 false;
 
-        while (p < p_cfg_end) {
+        while (cmd.Remaining() > 0) {
           uint8_t cfg_code, cfg_len;
-          if (p + 2 > p_next_cmd) return;
-          STREAM_TO_UINT8(cfg_code, p);
-          STREAM_TO_UINT8(cfg_len, p);
-
-          switch (cfg_code & 0x7F) {
-            case L2CAP_CFG_TYPE_MTU:
-              cfg_info.mtu_present = true;
-              if (cfg_len != 2) {
-                android_errorWriteLog(0x534e4554, "119870451");
-                return;
-              }
-              if (p + cfg_len > p_next_cmd) {
-                android_errorWriteLog(0x534e4554, "74202041");
-                return;
-              }
-              STREAM_TO_UINT16(cfg_info.mtu, p);
-              break;
-
-            case L2CAP_CFG_TYPE_FLUSH_TOUT:
-              cfg_info.flush_to_present = true;
-              if (cfg_len != 2) {
-                android_errorWriteLog(0x534e4554, "119870451");
-                return;
-              }
-              if (p + cfg_len > p_next_cmd) {
-                android_errorWriteLog(0x534e4554, "74202041");
-                return;
-              }
-              STREAM_TO_UINT16(cfg_info.flush_to, p);
-              break;
-
-            case L2CAP_CFG_TYPE_QOS:
-              cfg_info.qos_present = true;
-              if (cfg_len != 2 + 5 * 4) {
-                android_errorWriteLog(0x534e4554, "119870451");
-                return;
-              }
-              if (p + cfg_len > p_next_cmd) {
-                android_errorWriteLog(0x534e4554, "74202041");
-                return;
-              }
-              STREAM_TO_UINT8(cfg_info.qos.qos_flags, p);
-              STREAM_TO_UINT8(cfg_info.qos.service_type, p);
-              STREAM_TO_UINT32(cfg_info.qos.token_rate, p);
-              STREAM_TO_UINT32(cfg_info.qos.token_bucket_size, p);
-              STREAM_TO_UINT32(cfg_info.qos.peak_bandwidth, p);
-              STREAM_TO_UINT32(cfg_info.qos.latency, p);
-              STREAM_TO_UINT32(cfg_info.qos.delay_variation, p);
-              break;
+          if (!cmd.Read(&cfg_code, &cfg_len)) return;
 
-            case L2CAP_CFG_TYPE_FCR:
-              cfg_info.fcr_present = true;
-              if (cfg_len != 3 + 3 * 2) {
-                android_errorWriteLog(0x534e4554, "119870451");
-                return;
-              }
-              if (p + cfg_len > p_next_cmd) {
-                android_errorWriteLog(0x534e4554, "74202041");
-                return;
-              }
-              STREAM_TO_UINT8(cfg_info.fcr.mode, p);
-              STREAM_TO_UINT8(cfg_info.fcr.tx_win_sz, p);
-              STREAM_TO_UINT8(cfg_info.fcr.max_transmit, p);
-              STREAM_TO_UINT16(cfg_info.fcr.rtrans_tout, p);
-              STREAM_TO_UINT16(cfg_info.fcr.mon_tout, p);
-              STREAM_TO_UINT16(cfg_info.fcr.mps, p);
-              break;
-
-            case L2CAP_CFG_TYPE_FCS:
-              cfg_info.fcs_present = true;
-              if (cfg_len != 1) {
-                android_errorWriteLog(0x534e4554, "119870451");
-                return;
-              }
-              if (p + cfg_len > p_next_cmd) {
-                android_errorWriteLog(0x534e4554, "74202041");
-                return;
-              }
-              STREAM_TO_UINT8(cfg_info.fcs, p);
-              break;
-
-            case L2CAP_CFG_TYPE_EXT_FLOW:
-              cfg_info.ext_flow_spec_present = true;
-              if (cfg_len != 2 + 2 + 3 * 4) {
-                android_errorWriteLog(0x534e4554, "119870451");
-                return;
-              }
-              if (p + cfg_len > p_next_cmd) {
-                android_errorWriteLog(0x534e4554, "74202041");
-                return;
-              }
-              STREAM_TO_UINT8(cfg_info.ext_flow_spec.id, p);
-              STREAM_TO_UINT8(cfg_info.ext_flow_spec.stype, p);
-              STREAM_TO_UINT16(cfg_info.ext_flow_spec.max_sdu_size, p);
-              STREAM_TO_UINT32(cfg_info.ext_flow_spec.sdu_inter_time, p);
-              STREAM_TO_UINT32(cfg_info.ext_flow_spec.access_latency, p);
-              STREAM_TO_UINT32(cfg_info.ext_flow_spec.flush_timeout, p);
-              break;
-
-            default:
-              /* sanity check option length */
-              if ((cfg_len + L2CAP_CFG_OPTION_OVERHEAD) <= cmd_len) {
-                if (p + cfg_len > p_next_cmd) return;
-                p += cfg_len;
-                if ((cfg_code & 0x80) == 0) {
-                  cfg_rej_len += cfg_len + L2CAP_CFG_OPTION_OVERHEAD;
-                  cfg_rej = true;
-                }
-              }
+          uint8_t cfg_type = cfg_code & 0x7F;
+          size_t value_len = l2c_cfg_option_len(cfg_type);
+          if (value_len == 0) {
+            /* sanity check option length */
+            if ((cfg_len + L2CAP_CFG_OPTION_OVERHEAD) > cmd_len) {
               /* bad length; force loop exit */
-              else {
-                p = p_cfg_end;
-                cfg_rej = true;
-              }
+              cfg_rej = true;
               break;
+            }
+            if (cmd.Skip(cfg_len) == nullptr) return;
+            if ((cfg_code & 0x80) == 0) {
+              cfg_rej_len += cfg_len + L2CAP_CFG_OPTION_OVERHEAD;
+              cfg_rej = true;
+            }
+            continue;
+          }
+
+          if (cfg_len != value_len) {
+            android_errorWriteLog(0x534e4554, "119870451");
+            return;
+          }
+          StreamReader value = cmd.Sub(cfg_len);
+          if (!value.Ok()) {
+            android_errorWriteLog(0x534e4554, "74202041");
+            return;
           }
+          l2c_read_cfg_option(cfg_type, &value, &cfg_info);
         }
 
         tL2C_CCB* p_ccb = l2cu_find_ccb_by_cid(p_lcb, lcid);
@@ -606,76 +633,23 @@ static void process_l2cap_cmd(tL2C_LCB* p_lcb, uint8_t* p, uint16_t pkt_len) {
       }
 
       case L2CAP_CMD_CONFIG_RSP: {
-        uint8_t* p_cfg_end = p + cmd_len;
         uint16_t lcid;
-        if (p + 6 > p_next_cmd) return;
-        STREAM_TO_UINT16(lcid, p);
-        STREAM_TO_UINT16(cfg_info.flags, p);
-        STREAM_TO_UINT16(cfg_info.result, p);
+        if (!cmd.Read(&lcid, &cfg_info.flags, &cfg_info.result)) return;
 
         cfg_info.flush_to_present = cfg_info.mtu_present =
             cfg_info.qos_present = cfg_info.fcr_present = cfg_info.fcs_present =
                 false;
 
-        while (p < p_cfg_end) {
+        while (cmd.Remaining() > 0) {
           uint8_t cfg_code, cfg_len;
-          if (p + 2 > p_next_cmd) return;
-          STREAM_TO_UINT8(cfg_code, p);
-          STREAM_TO_UINT8(cfg_len, p);
-
-          switch (cfg_code & 0x7F) {
-            case L2CAP_CFG_TYPE_MTU:
-              cfg_info.mtu_present = true;
-              if (p + 2 > p_next_cmd) return;
-              STREAM_TO_UINT16(cfg_info.mtu, p);
-              break;
-
-            case L2CAP_CFG_TYPE_FLUSH_TOUT:
-              cfg_info.flush_to_present = true;
-              if (p + 2 > p_next_cmd) return;
-              STREAM_TO_UINT16(cfg_info.flush_to, p);
-              break;
-
-            case L2CAP_CFG_TYPE_QOS:
-              cfg_info.qos_present = true;
-              if (p + 2 + 5 * 4 > p_next_cmd) return;
-              STREAM_TO_UINT8(cfg_info.qos.qos_flags, p);
-              STREAM_TO_UINT8(cfg_info.qos.service_type, p);
-              STREAM_TO_UINT32(cfg_info.qos.token_rate, p);
-              STREAM_TO_UINT32(cfg_info.qos.token_bucket_size, p);
-              STREAM_TO_UINT32(cfg_info.qos.peak_bandwidth, p);
-              STREAM_TO_UINT32(cfg_info.qos.latency, p);
-              STREAM_TO_UINT32(cfg_info.qos.delay_variation, p);
-              break;
-
-            case L2CAP_CFG_TYPE_FCR:
-              cfg_info.fcr_present = true;
-              if (p + 3 + 3 * 2 > p_next_cmd) return;
-              STREAM_TO_UINT8(cfg_info.fcr.mode, p);
-              STREAM_TO_UINT8(cfg_info.fcr.tx_win_sz, p);
-              STREAM_TO_UINT8(cfg_info.fcr.max_transmit, p);
-              STREAM_TO_UINT16(cfg_info.fcr.rtrans_tout, p);
-              STREAM_TO_UINT16(cfg_info.fcr.mon_tout, p);
-              STREAM_TO_UINT16(cfg_info.fcr.mps, p);
-              break;
-
-            case L2CAP_CFG_TYPE_FCS:
-              cfg_info.fcs_present = true;
-              if (p + 1 > p_next_cmd) return;
-              STREAM_TO_UINT8(cfg_info.fcs, p);
-              break;
-
-            case L2CAP_CFG_TYPE_EXT_FLOW:
-              cfg_info.ext_flow_spec_present = true;
-              if (p + 2 + 2 + 3 * 4 > p_next_cmd) return;
-              STREAM_TO_UINT8(cfg_info.ext_flow_spec.id, p);
-              STREAM_TO_UINT8(cfg_info.ext_flow_spec.stype, p);
-              STREAM_TO_UINT16(cfg_info.ext_flow_spec.max_sdu_size, p);
-              STREAM_TO_UINT32(cfg_info.ext_flow_spec.sdu_inter_time, p);
-              STREAM_TO_UINT32(cfg_info.ext_flow_spec.access_latency, p);
-              STREAM_TO_UINT32(cfg_info.ext_flow_spec.flush_timeout, p);
-              break;
+          if (!cmd.Read(&cfg_code, &cfg_len)) return;
+          StreamReader value = cmd.Sub(cfg_len);
+          if (!value.Ok()) {
+            L2CAP_TRACE_WARNING("L2CAP - cfg rsp - option 0x%02x too long: %d",
+                                cfg_code, cfg_len);
+            return;
           }
+          if (!l2c_read_cfg_option(cfg_code & 0x7F, &value, &cfg_info)) return;
         }
 
         tL2C_CCB* p_ccb = l2cu_find_ccb_by_cid(p_lcb, lcid);
@@ -699,9 +673,7 @@ static void process_l2cap_cmd(tL2C_LCB* p_lcb, uint8_t* p, uint16_t pkt_len) {
 
       case L2CAP_CMD_DISC_REQ: {
         uint16_t lcid, rcid;
-        if (p + 4 > p_next_cmd) return;
-        STREAM_TO_UINT16(lcid, p);
-        STREAM_TO_UINT16(rcid, p);
+        if (!cmd.Read(&lcid, &rcid)) return;
 
         tL2C_CCB* p_ccb = l2cu_find_ccb_by_cid(p_lcb, lcid);
         if (p_ccb) {
@@ -717,9 +689,7 @@ static void process_l2cap_cmd(tL2C_LCB* p_lcb, uint8_t* p, uint16_t pkt_len) {
 
       case L2CAP_CMD_DISC_RSP: {
         uint16_t lcid, rcid;
-        if (p + 4 > p_next_cmd) return;
-        STREAM_TO_UINT16(rcid, p);
-        STREAM_TO_UINT16(lcid, p);
+        if (!cmd.Read(&rcid, &lcid)) return;
 
         tL2C_CCB* p_ccb = l2cu_find_ccb_by_cid(p_lcb, lcid);
         if (p_ccb) {
@@ -731,7 +701,7 @@ static void process_l2cap_cmd(tL2C_LCB* p_lcb, uint8_t* p, uint16_t pkt_len) {
       }
 
       case L2CAP_CMD_ECHO_REQ:
-        l2cu_send_peer_echo_rsp(p_lcb, id, p, cmd_len);
+        l2cu_send_peer_echo_rsp(p_lcb, id, cmd.Data(), cmd_len);
         break;
 
       case L2CAP_CMD_ECHO_RSP:
@@ -747,8 +717,7 @@ static void process_l2cap_cmd(tL2C_LCB* p_lcb, uint8_t* p, uint16_t pkt_len) {
 
       case L2CAP_CMD_INFO_REQ: {
         uint16_t info_type;
-        if (p + 2 > p_next_cmd) return;
-        STREAM_TO_UINT16(info_type, p);
+        if (!cmd.Read(&info_type)) return;
         l2cu_send_peer_info_rsp(p_lcb, id, info_type);
         break;
       }
@@ -761,16 +730,13 @@ static void process_l2cap_cmd(tL2C_LCB* p_lcb, uint8_t* p, uint16_t pkt_len) {
         }
 
         uint16_t info_type, result;
-        if (p + 4 > p_next_cmd) return;
-        STREAM_TO_UINT16(info_type, p);
-        STREAM_TO_UINT16(result, p);
+        if (!cmd.Read(&info_type, &result)) return;
 
         p_lcb->info_rx_bits |= (1 << info_type);
 
         if ((info_type == L2CAP_EXTENDED_FEATURES_INFO_TYPE) &&
             (result == L2CAP_INFO_RESP_RESULT_SUCCESS)) {
-          if (p + 4 > p_next_cmd) return;
-          STREAM_TO_UINT32(p_lcb->peer_ext_fea, p);
+          if (!cmd.Read(&p_lcb->peer_ext_fea)) return;
 
 #if (L2CAP_NUM_FIXED_CHNLS > 0)
           if (p_lcb->peer_ext_fea & L2CAP_EXTFEA_FIXED_CHNLS) {
@@ -785,11 +751,12 @@ static void process_l2cap_cmd(tL2C_LCB* p_lcb, uint8_t* p, uint16_t pkt_len) {
 #if (L2CAP_NUM_FIXED_CHNLS > 0)
         if (info_type == L2CAP_FIXED_CHANNELS_INFO_TYPE) {
           if (result == L2CAP_INFO_RESP_RESULT_SUCCESS) {
-            if (p + L2CAP_FIXED_CHNL_ARRAY_SIZE > p_next_cmd) {
+            const uint8_t* p_mask = cmd.Skip(L2CAP_FIXED_CHNL_ARRAY_SIZE);
+            if (p_mask == nullptr) {
               android_errorWriteLog(0x534e4554, "111215173");
               return;
             }
-            memcpy(p_lcb->peer_chnl_mask, p, L2CAP_FIXED_CHNL_ARRAY_SIZE);
+            memcpy(p_lcb->peer_chnl_mask, p_mask, L2CAP_FIXED_CHNL_ARRAY_SIZE);
           }
 
           l2cu_process_fixed_chnl_resp(p_lcb);
@@ -924,6 +891,8 @@ void l2c_init(void) {
 void l2c_free(void) {
   list_free(l2cb.rcv_pending_q);
   l2cb.rcv_pending_q = NULL;
+  alarm_free(l2cb.ble_tune_timer);
+  l2cb.ble_tune_timer = NULL;
 }
 
 void l2c_receive_hold_timer_timeout(UNUSED_ATTR void* data) {
@@ -32,6 +32,8 @@
 #include "btm_api.h"
 #include "btm_int.h"
 #include "btu.h"
+#include "common/metrics.h"
+#include "common/time_util.h"
 #include "device/include/controller.h"
 #include "hci/include/btsnoop.h"
 #include "hcidefs.h"
@@ -141,6 +143,7 @@ void l2cu_update_lcb_4_bonding(const RawAddress& p_bd_addr, bool is_bonding) {
 void l2cu_release_lcb(tL2C_LCB* p_lcb) {
   tL2C_CCB* p_ccb;
 
+  l2cu_set_lcb_handle(p_lcb, HCI_INVALID_HANDLE);
   p_lcb->in_use = false;
   p_lcb->is_bonding = false;
 
@@ -725,10 +728,11 @@ void l2cu_send_peer_config_rsp(tL2C_CCB* p_ccb, tL2CAP_CFG_INFO* p_cfg) {
  * Returns          void
  *
  ******************************************************************************/
-void l2cu_send_peer_config_rej(tL2C_CCB* p_ccb, uint8_t* p_data,
+void l2cu_send_peer_config_rej(tL2C_CCB* p_ccb, const uint8_t* p_data,
                                uint16_t data_len, uint16_t rej_len) {
   uint16_t len, cfg_len, buf_space, len1;
-  uint8_t *p, *p_hci_len, *p_data_end;
+  uint8_t *p, *p_hci_len;
+  const uint8_t* p_data_end;
   uint8_t cfg_code;
 
   L2CAP_TRACE_DEBUG("l2cu_send_peer_config_rej: data_len=%d, rej_len=%d",
@@ -965,8 +969,8 @@ void l2cu_send_peer_echo_req(tL2C_LCB* p_lcb, uint8_t* p_data,
  * Returns          void
  *
  ******************************************************************************/
-void l2cu_send_peer_echo_rsp(tL2C_LCB* p_lcb, uint8_t id, uint8_t* p_data,
-                             uint16_t data_len) {
+void l2cu_send_peer_echo_rsp(tL2C_LCB* p_lcb, uint8_t id,
+                             const uint8_t* p_data, uint16_t data_len) {
   BT_HDR* p_buf;
   uint8_t* p;
   uint16_t maxlen;
@@ -1482,6 +1486,9 @@ tL2C_CCB* l2cu_allocate_ccb(tL2C_LCB* p_lcb, uint16_t cid) {
   p_ccb->cong_sent = false;
   p_ccb->buff_quota = 2; /* This gets set after config */
 
+  memset(&p_ccb->stats, 0, sizeof(p_ccb->stats));
+  p_ccb->stats.open_ms = bluetooth::common::time_get_os_boottime_ms();
+
   /* If CCB was reserved Config_Done can already have some value */
   if (cid == 0)
     p_ccb->config_done = 0;
@@ -1549,6 +1556,37 @@ bool l2cu_start_post_bond_timer(uint16_t handle) {
   return (false);
 }
 
+#if (L2CAP_CHANNEL_STATS == TRUE)
+/*******************************************************************************
+ *
+ * Function         l2cu_log_channel_stats
+ *
+ * Description      Logs the statistics of a channel about to be released to
+ *                  the metrics.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void l2cu_log_channel_stats(const tL2C_CCB* p_ccb) {
+  const tL2C_CCB_STATS* p_stats = &p_ccb->stats;
+  bluetooth::common::L2capChannelMetrics stats;
+
+  stats.psm = p_ccb->p_rcb->real_psm;
+  stats.is_le = p_ccb->p_lcb && (p_ccb->p_lcb->transport == BT_TRANSPORT_LE);
+  stats.duration_ms =
+      bluetooth::common::time_get_os_boottime_ms() - p_stats->open_ms;
+  stats.tx_bytes = p_stats->tx_bytes;
+  stats.tx_packets = p_stats->tx_pkts;
+  stats.rx_bytes = p_stats->rx_bytes;
+  stats.rx_packets = p_stats->rx_pkts;
+  stats.congestion_count = p_stats->congestion_on;
+  stats.max_queue_delay_ms = p_stats->max_delay_ms;
+  stats.p99_queue_delay_ms = l2cu_channel_delay_percentile(p_stats, 99);
+  bluetooth::common::BluetoothMetricsLogger::GetInstance()
+      ->LogL2capChannelStats(stats);
+}
+#endif
+
 /*******************************************************************************
  *
  * Function         l2cu_release_ccb
@@ -1577,6 +1615,11 @@ void l2cu_release_ccb(tL2C_CCB* p_ccb) {
     btm_sec_clr_service_by_psm(p_rcb->psm);
   }
 
+#if (L2CAP_CHANNEL_STATS == TRUE)
+  if (p_rcb && (p_ccb->stats.tx_pkts != 0 || p_ccb->stats.rx_pkts != 0))
+    l2cu_log_channel_stats(p_ccb);
+#endif
+
   if (p_ccb->should_free_rcb) {
     osi_free(p_rcb);
     p_ccb->p_rcb = NULL;
@@ -2599,6 +2642,7 @@ bool l2cu_initialize_fixed_ccb(tL2C_LCB* p_lcb, uint16_t fixed_cid,
 void l2cu_no_dynamic_ccbs(tL2C_LCB* p_lcb) {
   tBTM_STATUS rc;
   uint64_t timeout_ms = p_lcb->idle_timeout * 1000;
+  uint64_t slack_ms = L2CAP_LINK_IDLE_TIMEOUT_SLACK_MS;
   bool start_timeout = true;
 
 #if (L2CAP_NUM_FIXED_CHNLS > 0)
@@ -2624,6 +2668,8 @@ void l2cu_no_dynamic_ccbs(tL2C_LCB* p_lcb) {
   if (timeout_ms == 0) {
     L2CAP_TRACE_DEBUG(
         "l2cu_no_dynamic_ccbs() IDLE timer 0, disconnecting link");
+    /* The timeouts below guard the disconnection, not an idle link */
+    slack_ms = 0;
 
     rc = btm_sec_disconnect(p_lcb->handle, HCI_ERR_PEER_USER);
     if (rc == BTM_CMD_STARTED) {
@@ -2649,8 +2695,8 @@ void l2cu_no_dynamic_ccbs(tL2C_LCB* p_lcb) {
 
   if (start_timeout) {
     L2CAP_TRACE_DEBUG("%s starting IDLE timeout: %d ms", __func__, timeout_ms);
-    alarm_set_on_mloop(p_lcb->l2c_lcb_timer, timeout_ms, l2c_lcb_timer_timeout,
-                       p_lcb);
+    alarm_set_on_mloop_with_slack(p_lcb->l2c_lcb_timer, timeout_ms, slack_ms,
+                                  l2c_lcb_timer_timeout, p_lcb);
   } else {
     alarm_cancel(p_lcb->l2c_lcb_timer);
   }
@@ -3042,6 +3088,15 @@ void l2cu_send_peer_ble_credit_based_disconn_req(tL2C_CCB* p_ccb) {
  *
  ******************************************************************************/
 tL2C_LCB* l2cu_find_lcb_by_handle(uint16_t handle) {
+  if (handle < L2C_LCB_HANDLE_TABLE_SIZE) {
+    uint8_t index = l2cb.lcb_by_handle[handle];
+    if (index == 0) return (NULL);
+
+    tL2C_LCB* p_lcb = &l2cb.lcb_pool[index - 1];
+    return (p_lcb->in_use && p_lcb->handle == handle) ? p_lcb : NULL;
+  }
+
+  /* Out of range handles (e.g. HCI_INVALID_HANDLE) are not indexed */
   int xx;
   tL2C_LCB* p_lcb = &l2cb.lcb_pool[0];
 
@@ -3055,6 +3110,29 @@ tL2C_LCB* l2cu_find_lcb_by_handle(uint16_t handle) {
   return (NULL);
 }
 
+/*******************************************************************************
+ *
+ * Function         l2cu_set_lcb_handle
+ *
+ * Description      Assign the HCI handle of an LCB, keeping the handle
+ *                  lookup table in sync. All writes to p_lcb->handle after
+ *                  allocation must go through this function.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void l2cu_set_lcb_handle(tL2C_LCB* p_lcb, uint16_t handle) {
+  uint8_t index = (p_lcb - &l2cb.lcb_pool[0]) + 1;
+
+  if (p_lcb->handle < L2C_LCB_HANDLE_TABLE_SIZE &&
+      l2cb.lcb_by_handle[p_lcb->handle] == index)
+    l2cb.lcb_by_handle[p_lcb->handle] = 0;
+
+  p_lcb->handle = handle;
+
+  if (handle < L2C_LCB_HANDLE_TABLE_SIZE) l2cb.lcb_by_handle[handle] = index;
+}
+
 /*******************************************************************************
  *
  * Function         l2cu_find_ccb_by_cid
@@ -3407,6 +3485,9 @@ void l2cu_set_acl_hci_header(BT_HDR* p_buf, tL2C_CCB* p_ccb) {
 static void send_congestion_status_to_all_clients(tL2C_CCB* p_ccb,
                                                   bool status) {
   p_ccb->cong_sent = status;
+#if (L2CAP_CHANNEL_STATS == TRUE)
+  if (status) p_ccb->stats.congestion_on++;
+#endif
 
   if (p_ccb->p_rcb && p_ccb->p_rcb->api.pL2CA_CongestionStatus_Cb) {
     L2CAP_TRACE_DEBUG(
@@ -3436,8 +3517,154 @@ static void send_congestion_status_to_all_clients(tL2C_CCB* p_ccb,
 #endif
 }
 
+/*******************************************************************************
+ *
+ * Function         l2cu_hist_bucket
+ *
+ * Description      Returns the histogram bucket of |value|: 0 for 0, n for
+ *                  values in [2^(n-1), 2^n), capped to the last of
+ *                  |num_buckets| buckets.
+ *
+ ******************************************************************************/
+uint8_t l2cu_hist_bucket(uint64_t value, uint8_t num_buckets) {
+  uint8_t bucket = 0;
+  while (value != 0 && bucket < num_buckets - 1) {
+    value >>= 1;
+    bucket++;
+  }
+  return bucket;
+}
+
+#if (L2CAP_CHANNEL_STATS == TRUE)
+/*******************************************************************************
+ *
+ * Function         l2cu_channel_stats_tx
+ *
+ * Description      Counts an SDU of |len| bytes about to be added to the
+ *                  xmit_hold_q of the channel, and records its enqueue time.
+ *
+ ******************************************************************************/
+void l2cu_channel_stats_tx(tL2C_CCB* p_ccb, uint16_t len) {
+  tL2C_CCB_STATS* p_stats = &p_ccb->stats;
+
+  p_stats->tx_bytes += len;
+  p_stats->tx_pkts++;
+
+  /* Keep the queue order: once an SDU was not timed, the following ones
+   * aren't either until it is sent */
+  if (p_stats->untimed != 0 || p_stats->enq_count == L2C_CHNL_TIMED_PKTS) {
+    p_stats->untimed++;
+    return;
+  }
+
+  uint8_t idx = (p_stats->enq_first + p_stats->enq_count) % L2C_CHNL_TIMED_PKTS;
+  p_stats->enq_ms[idx] =
+      (uint32_t)bluetooth::common::time_get_os_boottime_ms();
+  p_stats->enq_count++;
+}
+
+/*******************************************************************************
+ *
+ * Function         l2cu_channel_stats_rx
+ *
+ * Description      Counts a PDU of |len| bytes received on the channel and
+ *                  accepted by it.
+ *
+ ******************************************************************************/
+void l2cu_channel_stats_rx(tL2C_CCB* p_ccb, uint16_t len) {
+  p_ccb->stats.rx_bytes += len;
+  p_ccb->stats.rx_pkts++;
+}
+
+/*******************************************************************************
+ *
+ * Function         l2cu_channel_stats_rx_drop
+ *
+ * Description      Counts a PDU received on the channel and discarded before
+ *                  it was processed.
+ *
+ ******************************************************************************/
+void l2cu_channel_stats_rx_drop(tL2C_CCB* p_ccb) { p_ccb->stats.rx_dropped++; }
+
+/*******************************************************************************
+ *
+ * Function         l2cu_channel_stats_dequeue
+ *
+ * Description      Records the queue delay of the SDUs that left the
+ *                  xmit_hold_q since the last call. The queue is only ever
+ *                  consumed from its head, so the SDUs that left are the
+ *                  oldest ones.
+ *
+ ******************************************************************************/
+static void l2cu_channel_stats_dequeue(tL2C_CCB* p_ccb) {
+  tL2C_CCB_STATS* p_stats = &p_ccb->stats;
+  size_t queued = p_stats->enq_count + p_stats->untimed;
+  size_t q_count = fixed_queue_length(p_ccb->xmit_hold_q);
+  uint32_t now_ms = 0;
+
+  if (q_count >= queued) return;
+
+  now_ms = (uint32_t)bluetooth::common::time_get_os_boottime_ms();
+  for (; queued > q_count; queued--) {
+    if (p_stats->enq_count == 0) {
+      p_stats->untimed--;
+      continue;
+    }
+
+    uint32_t delay_ms = now_ms - p_stats->enq_ms[p_stats->enq_first];
+    p_stats->enq_first = (p_stats->enq_first + 1) % L2C_CHNL_TIMED_PKTS;
+    p_stats->enq_count--;
+
+    p_stats->delay_hist[l2cu_hist_bucket(delay_ms, L2C_CHNL_HIST_BUCKETS)]++;
+    if (delay_ms > p_stats->max_delay_ms) p_stats->max_delay_ms = delay_ms;
+  }
+
+  /* The ring drained while untimed SDUs are still queued: time them from now
+   * on, so that a long backlog doesn't stop the sampling */
+  if (p_stats->enq_count != 0) return;
+  while (p_stats->untimed != 0 && p_stats->enq_count < L2C_CHNL_TIMED_PKTS) {
+    p_stats->enq_ms[(p_stats->enq_first + p_stats->enq_count) %
+                    L2C_CHNL_TIMED_PKTS] = now_ms;
+    p_stats->enq_count++;
+    p_stats->untimed--;
+  }
+}
+#endif
+
+/*******************************************************************************
+ *
+ * Function         l2cu_channel_delay_percentile
+ *
+ * Description      Returns an upper bound of the |percent| percentile of the
+ *                  xmit_hold_q delay of the channel, in ms: the upper end of
+ *                  the histogram bucket it falls into.
+ *
+ ******************************************************************************/
+uint32_t l2cu_channel_delay_percentile(const tL2C_CCB_STATS* p_stats,
+                                       uint8_t percent) {
+  uint64_t total = 0;
+  for (int i = 0; i < L2C_CHNL_HIST_BUCKETS; i++)
+    total += p_stats->delay_hist[i];
+  if (total == 0) return 0;
+
+  uint64_t rank = (total * percent + 99) / 100;
+  uint64_t count = 0;
+  for (int i = 0; i < L2C_CHNL_HIST_BUCKETS - 1; i++) {
+    count += p_stats->delay_hist[i];
+    if (count >= rank) {
+      uint32_t bound = (i == 0) ? 0 : ((1u << i) - 1);
+      return (bound < p_stats->max_delay_ms) ? bound : p_stats->max_delay_ms;
+    }
+  }
+  return p_stats->max_delay_ms;
+}
+
 /* check if any change in congestion status */
 void l2cu_check_channel_congestion(tL2C_CCB* p_ccb) {
+#if (L2CAP_CHANNEL_STATS == TRUE)
+  l2cu_channel_stats_dequeue(p_ccb);
+#endif
+
   /* If the CCB queue limit is subject to a quota, check for congestion if this
    * channel has outgoing traffic */
   if (p_ccb->buff_quota == 0) return;
@@ -3449,8 +3676,11 @@ void l2cu_check_channel_congestion(tL2C_CCB* p_ccb) {
     if (q_count <= (p_ccb->buff_quota / 2))
       send_congestion_status_to_all_clients(p_ccb, false);
   } else {
-    /* if channel was not congested, but is congested now, tell the app */
-    if (q_count > p_ccb->buff_quota)
+    /* if channel was not congested, but is congested now, tell the app. Once
+     * the buffer budget is used up, a channel is congested at half its quota
+     */
+    if (q_count > p_ccb->buff_quota ||
+        (btu_budget_exhausted() && q_count > (p_ccb->buff_quota / 2)))
       send_congestion_status_to_all_clients(p_ccb, true);
   }
 }
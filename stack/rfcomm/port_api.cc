@@ -25,12 +25,16 @@
 #define LOG_TAG "bt_port_api"
 
 #include <base/logging.h>
+#include <inttypes.h>
+#include <stdio.h>
 #include <string.h>
+#include "common/time_util.h"
 
 #include "osi/include/log.h"
 #include "osi/include/mutex.h"
 
 #include "bt_common.h"
+#include "btu.h"
 #include "l2c_api.h"
 #include "port_api.h"
 #include "port_int.h"
@@ -716,6 +720,7 @@ int PORT_ReadData(uint16_t handle, char* p_data, uint16_t max_len,
       mutex_global_lock();
 
       p_port->rx.queue_size -= max_len;
+      btu_budget_release(BTU_BUDGET_RFCOMM_RX, max_len);
 
       mutex_global_unlock();
 
@@ -729,6 +734,7 @@ int PORT_ReadData(uint16_t handle, char* p_data, uint16_t max_len,
       mutex_global_lock();
 
       p_port->rx.queue_size -= p_buf->len;
+      btu_budget_release(BTU_BUDGET_RFCOMM_RX, p_buf->len);
 
       if (max_len) {
         p_data += p_buf->len;
@@ -805,6 +811,7 @@ static int port_write(tPORT* p_port, BT_HDR* p_buf) {
 
     fixed_queue_enqueue(p_port->tx.queue, p_buf);
     p_port->tx.queue_size += p_buf->len;
+    btu_budget_charge(BTU_BUDGET_RFCOMM_TX, p_buf->len);
 
     return (PORT_CMD_PENDING);
   } else {
@@ -895,6 +902,7 @@ int PORT_WriteDataCO(uint16_t handle, int* p_len) {
     // memcpy ((uint8_t *)(p_buf + 1) + p_buf->offset + p_buf->len, p_data,
     // max_len);
     p_port->tx.queue_size += (uint16_t)available;
+    btu_budget_charge(BTU_BUDGET_RFCOMM_TX, available);
 
     *p_len = available;
     p_buf->len += (uint16_t)available;
@@ -906,14 +914,13 @@ int PORT_WriteDataCO(uint16_t handle, int* p_len) {
 
   mutex_global_unlock();
 
-  // int max_read = length < p_port->peer_mtu ? length : p_port->peer_mtu;
-
-  // max_read = available < max_read ? available : max_read;
+  if (p_port->peer_mtu < length) length = p_port->peer_mtu;
 
   while (available) {
-    /* if we're over buffer high water mark, we're done */
+    /* if we're over buffer high water mark or budget, we're done */
     if ((p_port->tx.queue_size > PORT_TX_HIGH_WM) ||
-        (fixed_queue_length(p_port->tx.queue) > PORT_TX_BUF_HIGH_WM)) {
+        (fixed_queue_length(p_port->tx.queue) > PORT_TX_BUF_HIGH_WM) ||
+        btu_budget_exceeded(p_port->tx.queue_size)) {
       port_flow_control_user(p_port);
       event |= PORT_EV_FC;
       RFCOMM_TRACE_EVENT(
@@ -923,41 +930,65 @@ int PORT_WriteDataCO(uint16_t handle, int* p_len) {
       break;
     }
 
-    /* continue with rfcomm data write */
-    p_buf = (BT_HDR*)osi_malloc(RFCOMM_DATA_BUF_SIZE);
-    p_buf->offset = L2CAP_MIN_OFFSET + RFCOMM_MIN_OFFSET;
-    p_buf->layer_specific = handle;
-
-    if (p_port->peer_mtu < length) length = p_port->peer_mtu;
-    if (available < (int)length) length = (uint16_t)available;
-    p_buf->len = length;
-    p_buf->event = BT_EVT_TO_BTU_SP_DATA;
+    /* Fill as many buffers as the high water marks allow with a single call
+     * out, counting them as if none of them could be sent right away */
+    BT_HDR* p_bufs[PORT_TX_BUF_HIGH_WM + 1];
+    uint16_t num_bufs = 0;
+    int batch_len = 0;
+    uint32_t queue_size = p_port->tx.queue_size;
+    size_t queue_count = fixed_queue_length(p_port->tx.queue);
+    while (batch_len < available && num_bufs < PORT_TX_BUF_HIGH_WM + 1 &&
+           queue_size <= PORT_TX_HIGH_WM &&
+           queue_count <= PORT_TX_BUF_HIGH_WM &&
+           !btu_budget_exceeded(queue_size)) {
+      uint16_t buf_len = length;
+      if (available - batch_len < (int)buf_len)
+        buf_len = (uint16_t)(available - batch_len);
+
+      p_buf = (BT_HDR*)osi_malloc(RFCOMM_DATA_BUF_SIZE);
+      p_buf->offset = L2CAP_MIN_OFFSET + RFCOMM_MIN_OFFSET;
+      p_buf->layer_specific = handle;
+      p_buf->len = buf_len;
+      p_buf->event = BT_EVT_TO_BTU_SP_DATA;
+      p_bufs[num_bufs++] = p_buf;
+
+      batch_len += buf_len;
+      queue_size += buf_len;
+      queue_count++;
+    }
 
-    // memcpy ((uint8_t *)(p_buf + 1) + p_buf->offset, p_data, length);
-    // if(recv(fd, (uint8_t *)(p_buf + 1) + p_buf->offset, (int)length, 0) !=
-    // (int)length)
-    if (!p_port->p_data_co_callback(handle,
-                                    (uint8_t*)(p_buf + 1) + p_buf->offset,
-                                    length, DATA_CO_CALLBACK_TYPE_OUTGOING)) {
+    if (!p_port->p_data_co_callback(handle, (uint8_t*)p_bufs, num_bufs,
+                                    DATA_CO_CALLBACK_TYPE_OUTGOING_BUFFERS)) {
       error(
-          "p_data_co_callback DATA_CO_CALLBACK_TYPE_OUTGOING failed, length:%d",
-          length);
+          "p_data_co_callback DATA_CO_CALLBACK_TYPE_OUTGOING_BUFFERS failed, "
+          "length:%d",
+          batch_len);
+      for (uint16_t i = 0; i < num_bufs; i++) osi_free(p_bufs[i]);
       return (PORT_UNKNOWN_ERROR);
     }
 
-    RFCOMM_TRACE_EVENT("PORT_WriteData %d bytes", length);
+    for (uint16_t i = 0; i < num_bufs; i++) {
+      uint16_t buf_len = p_bufs[i]->len;
+      RFCOMM_TRACE_EVENT("PORT_WriteData %d bytes", buf_len);
 
-    rc = port_write(p_port, p_buf);
+      rc = port_write(p_port, p_bufs[i]);
 
-    /* If queue went below the threashold need to send flow control */
-    event |= port_flow_control_user(p_port);
+      /* If queue went below the threashold need to send flow control */
+      event |= port_flow_control_user(p_port);
 
-    if (rc == PORT_SUCCESS) event |= PORT_EV_TXCHAR;
+      if (rc == PORT_SUCCESS) event |= PORT_EV_TXCHAR;
 
-    if ((rc != PORT_SUCCESS) && (rc != PORT_CMD_PENDING)) break;
+      if ((rc != PORT_SUCCESS) && (rc != PORT_CMD_PENDING)) {
+        /* The port can't take data any more, drop the rest of the batch */
+        while (++i < num_bufs) osi_free(p_bufs[i]);
+        break;
+      }
 
-    *p_len += length;
-    available -= (int)length;
+      *p_len += buf_len;
+      available -= (int)buf_len;
+    }
+
+    if ((rc != PORT_SUCCESS) && (rc != PORT_CMD_PENDING)) break;
   }
   if (!available && (rc != PORT_CMD_PENDING) && (rc != PORT_TX_QUEUE_DISABLED))
     event |= PORT_EV_TXEMPTY;
@@ -1021,26 +1052,37 @@ int PORT_WriteData(uint16_t handle, const char* p_data, uint16_t max_len,
   /* data fits into the end of the queue */
   mutex_global_lock();
 
+  /* Frames are filled up to the peer MTU, each of them takes one credit */
+  if (p_port->peer_mtu < length) length = p_port->peer_mtu;
+
   p_buf = (BT_HDR*)fixed_queue_try_peek_last(p_port->tx.queue);
-  if ((p_buf != NULL) && ((p_buf->len + max_len) <= p_port->peer_mtu) &&
-      ((p_buf->len + max_len) <= length)) {
-    memcpy((uint8_t*)(p_buf + 1) + p_buf->offset + p_buf->len, p_data, max_len);
-    p_port->tx.queue_size += max_len;
+  if ((p_buf != NULL) && (p_buf->len < length)) {
+    uint16_t fill = length - p_buf->len;
+    if (max_len < fill) fill = max_len;
 
-    *p_len = max_len;
-    p_buf->len += max_len;
+    memcpy((uint8_t*)(p_buf + 1) + p_buf->offset + p_buf->len, p_data, fill);
+    p_port->tx.queue_size += fill;
+    btu_budget_charge(BTU_BUDGET_RFCOMM_TX, fill);
 
-    mutex_global_unlock();
+    *p_len = fill;
+    p_buf->len += fill;
+    max_len -= fill;
+    p_data += fill;
 
-    return (PORT_SUCCESS);
+    if (!max_len) {
+      mutex_global_unlock();
+
+      return (PORT_SUCCESS);
+    }
   }
 
   mutex_global_unlock();
 
   while (max_len) {
-    /* if we're over buffer high water mark, we're done */
+    /* if we're over buffer high water mark or budget, we're done */
     if ((p_port->tx.queue_size > PORT_TX_HIGH_WM) ||
-        (fixed_queue_length(p_port->tx.queue) > PORT_TX_BUF_HIGH_WM))
+        (fixed_queue_length(p_port->tx.queue) > PORT_TX_BUF_HIGH_WM) ||
+        btu_budget_exceeded(p_port->tx.queue_size))
       break;
 
     /* continue with rfcomm data write */
@@ -1048,7 +1090,6 @@ int PORT_WriteData(uint16_t handle, const char* p_data, uint16_t max_len,
     p_buf->offset = L2CAP_MIN_OFFSET + RFCOMM_MIN_OFFSET;
     p_buf->layer_specific = handle;
 
-    if (p_port->peer_mtu < length) length = p_port->peer_mtu;
     if (max_len < length) length = max_len;
     p_buf->len = length;
     p_buf->event = BT_EVT_TO_BTU_SP_DATA;
@@ -1136,3 +1177,46 @@ const char* PORT_GetResultString(const uint8_t result_code) {
 
   return result_code_strings[result_code];
 }
+
+/*******************************************************************************
+ *
+ * Function         stack_debug_rfcomm_api_dump
+ *
+ * Description      Dump the flow control state and traffic counters of the
+ *                  open RFCOMM ports to |fd|.
+ *
+ ******************************************************************************/
+void stack_debug_rfcomm_api_dump(int fd) {
+  dprintf(fd, "\nRFCOMM Ports:\n");
+
+  uint64_t now_ms = bluetooth::common::time_get_os_boottime_ms();
+  for (uint16_t i = 0; i < MAX_RFC_PORTS; i++) {
+    const tPORT* p_port = &rfc_cb.port.port[i];
+    if (!p_port->in_use || p_port->state != PORT_STATE_OPENED) continue;
+
+    const tPORT_STATS& stats = p_port->stats;
+    uint64_t elapsed_ms = now_ms - stats.open_time_ms;
+    if (elapsed_ms == 0) elapsed_ms = 1;
+
+    dprintf(fd, "\n  Port handle: %d peer: %s dlci: %d scn: %d\n",
+            p_port->handle, p_port->bd_addr.ToString().c_str(), p_port->dlci,
+            p_port->scn);
+    dprintf(fd, "    MTU: %d peer MTU: %d\n", p_port->mtu, p_port->peer_mtu);
+    dprintf(fd, "    TX credits: %d RX credits: %d/%d (initial %d, low %d)\n",
+            p_port->credit_tx, p_port->credit_rx, p_port->credit_rx_max,
+            p_port->credit_rx_base, p_port->credit_rx_low);
+    dprintf(fd, "    TX queue: %u bytes in %zu buffers\n",
+            p_port->tx.queue_size, fixed_queue_length(p_port->tx.queue));
+    dprintf(fd, "    RX queue: %u bytes in %zu buffers (budget %zu bytes)\n",
+            p_port->rx.queue_size, fixed_queue_length(p_port->rx.queue),
+            btu_budget_channel_quota());
+    dprintf(fd, "    TX: %" PRIu64 " bytes in %u frames, %" PRIu64 " bytes/s\n",
+            stats.tx_bytes, stats.tx_frames,
+            stats.tx_bytes * 1000 / elapsed_ms);
+    dprintf(fd, "    RX: %" PRIu64 " bytes in %u frames, %" PRIu64 " bytes/s\n",
+            stats.rx_bytes, stats.rx_frames,
+            stats.rx_bytes * 1000 / elapsed_ms);
+    dprintf(fd, "    Credits granted: %u TX credit stalls: %u\n",
+            stats.credits_granted, stats.tx_credit_stalls);
+  }
+}
@@ -39,6 +39,19 @@
 #define PORT_FC_TS710 1     /* use TS 07.10 flow control  */
 #define PORT_FC_CREDIT 2    /* use RFCOMM credit based flow control */
 
+/*
+ * Define per port traffic counters, reported by stack_debug_rfcomm_api_dump
+*/
+typedef struct {
+  uint64_t tx_bytes;
+  uint64_t rx_bytes;
+  uint32_t tx_frames;
+  uint32_t rx_frames;
+  uint32_t credits_granted;  /* Credits sent to the peer */
+  uint32_t tx_credit_stalls; /* Times the tx path ran out of peer credits */
+  uint64_t open_time_ms;     /* Time the port was opened */
+} tPORT_STATS;
+
 /*
  * Define Port Data Transfere control block
 */
@@ -182,7 +195,9 @@ typedef struct {
   uint16_t
       credit_rx_max; /* Max number of credits we will allow this guy to sent */
   uint16_t credit_rx_low;   /* Number of credits when we send credit update */
+  uint16_t credit_rx_base;  /* Initial credit_rx_max, before it is adapted */
   uint16_t rx_buf_critical; /* port receive queue critical watermark level */
+  tPORT_STATS stats;
   bool keep_port_handle;    /* true if port is not deallocated when closing */
   /* it is set to true for server when allocating port */
   uint16_t keep_mtu; /* Max MTU that port can receive by server */
@@ -195,6 +210,11 @@ typedef struct {
   tRFC_MCB rfc_mcb[MAX_BD_CONNECTIONS]; /* RFCOMM bd_connections pool */
 } tPORT_CB;
 
+/* Port handles, starting from 1, are kept in uint8_t for the per frame
+ * lookup in tRFC_MCB.port_handles */
+static_assert(MAX_RFC_PORTS <= UINT8_MAX,
+              "RFCOMM port handles must fit in tRFC_MCB.port_handles");
+
 /*
  * Functions provided by the port_utils.cc
 */
@@ -25,6 +25,7 @@
 #include <base/logging.h>
 #include <string.h>
 
+#include "common/time_util.h"
 #include "osi/include/mutex.h"
 #include "osi/include/osi.h"
 
@@ -33,6 +34,7 @@
 #include "bt_utils.h"
 #include "btm_api.h"
 #include "btm_int.h"
+#include "btu.h"
 #include "port_api.h"
 #include "port_int.h"
 #include "rfc_int.h"
@@ -453,6 +455,7 @@ void PORT_DlcEstablishInd(tRFC_MCB* p_mcb, uint8_t dlci, uint16_t mtu) {
     p_port->p_mgmt_callback(PORT_SUCCESS, p_port->handle);
 
   p_port->state = PORT_STATE_OPENED;
+  p_port->stats.open_time_ms = bluetooth::common::time_get_os_boottime_ms();
 }
 
 /*******************************************************************************
@@ -493,6 +496,7 @@ void PORT_DlcEstablishCnf(tRFC_MCB* p_mcb, uint8_t dlci, uint16_t mtu,
     p_port->p_mgmt_callback(PORT_SUCCESS, p_port->handle);
 
   p_port->state = PORT_STATE_OPENED;
+  p_port->stats.open_time_ms = bluetooth::common::time_get_os_boottime_ms();
 
   /* RPN is required only if we want to tell DTE how the port should be opened
    */
@@ -767,6 +771,8 @@ void PORT_DataInd(tRFC_MCB* p_mcb, uint8_t dlci, BT_HDR* p_buf) {
     osi_free(p_buf);
     return;
   }
+  p_port->stats.rx_frames++;
+  p_port->stats.rx_bytes += p_buf->len;
   /* If client registered callout callback with flow control we can just deliver
    * receive data */
   if (p_port->p_data_co_callback) {
@@ -814,6 +820,7 @@ void PORT_DataInd(tRFC_MCB* p_mcb, uint8_t dlci, BT_HDR* p_buf) {
 
   fixed_queue_enqueue(p_port->rx.queue, p_buf);
   p_port->rx.queue_size += p_buf->len;
+  btu_budget_charge(BTU_BUDGET_RFCOMM_RX, p_buf->len);
 
   mutex_global_unlock();
 
@@ -910,6 +917,7 @@ uint32_t port_rfc_send_tx_data(tPORT* p_port) {
       p_buf = (BT_HDR*)fixed_queue_try_dequeue(p_port->tx.queue);
       if (p_buf != NULL) {
         p_port->tx.queue_size -= p_buf->len;
+        btu_budget_release(BTU_BUDGET_RFCOMM_TX, p_buf->len);
 
         mutex_global_unlock();
 
@@ -73,6 +73,7 @@ tPORT* port_allocate_port(uint8_t dlci, const RawAddress& bd_addr) {
       // Assume that we already called port_release_port on this
       memset(p_port, 0, sizeof(tPORT));
       p_port->in_use = true;
+      btu_budget_add_channel();
       // handle is a port handle starting from 1
       p_port->handle = port_index + static_cast<uint8_t>(1);
       // During the open set default state for the port connection
@@ -117,6 +118,7 @@ void port_set_defaults(tPORT* p_port) {
   p_port->credit_tx = 0;
   p_port->credit_rx = 0;
 
+  memset(&p_port->stats, 0, sizeof(p_port->stats));
   memset(&p_port->local_ctrl, 0, sizeof(p_port->local_ctrl));
   memset(&p_port->peer_ctrl, 0, sizeof(p_port->peer_ctrl));
   memset(&p_port->rx, 0, sizeof(p_port->rx));
@@ -186,6 +188,7 @@ void port_select_mtu(tPORT* p_port) {
   p_port->rx_buf_critical = (PORT_RX_CRITICAL_WM / p_port->mtu);
   if (p_port->rx_buf_critical > PORT_RX_BUF_CRITICAL_WM)
     p_port->rx_buf_critical = PORT_RX_BUF_CRITICAL_WM;
+  p_port->credit_rx_base = p_port->credit_rx_max;
   RFCOMM_TRACE_DEBUG(
       "%s: credit_rx_max %d, credit_rx_low %d, rx_buf_critical %d", __func__,
       p_port->credit_rx_max, p_port->credit_rx_low, p_port->rx_buf_critical);
@@ -210,12 +213,14 @@ void port_release_port(tPORT* p_port) {
          nullptr) {
     osi_free(p_buf);
   }
+  btu_budget_release(BTU_BUDGET_RFCOMM_RX, p_port->rx.queue_size);
   p_port->rx.queue_size = 0;
 
   while ((p_buf = (BT_HDR*)fixed_queue_try_dequeue(p_port->tx.queue)) !=
          nullptr) {
     osi_free(p_buf);
   }
+  btu_budget_release(BTU_BUDGET_RFCOMM_TX, p_port->tx.queue_size);
   p_port->tx.queue_size = 0;
   mutex_global_unlock();
 
@@ -266,6 +271,7 @@ void port_release_port(tPORT* p_port) {
     } else {
       RFCOMM_TRACE_DEBUG("%s Clean-up handle: %d", __func__, p_port->handle);
       alarm_free(p_port->rfc.port_timer);
+      btu_budget_remove_channel();
       memset(p_port, 0, sizeof(tPORT));
     }
   }
@@ -388,7 +394,8 @@ uint32_t port_flow_control_user(tPORT* p_port) {
   bool fc = p_port->tx.peer_fc || !p_port->rfc.p_mcb ||
             !p_port->rfc.p_mcb->peer_ready ||
             (p_port->tx.queue_size > PORT_TX_HIGH_WM) ||
-            (fixed_queue_length(p_port->tx.queue) > PORT_TX_BUF_HIGH_WM);
+            (fixed_queue_length(p_port->tx.queue) > PORT_TX_BUF_HIGH_WM) ||
+            btu_budget_exceeded(p_port->tx.queue_size);
 
   if (p_port->tx.user_fc == fc) return (0);
 
@@ -439,6 +446,63 @@ uint32_t port_get_signal_changes(tPORT* p_port, uint8_t old_signals,
   return (p_port->ev_mask & events);
 }
 
+/*******************************************************************************
+ *
+ * Function         port_grow_credits
+ *
+ * Description      Called when the peer used up its credits down to the low
+ *                  watermark and is about to get new ones. If the data goes
+ *                  straight to the user, who kept up with it, widen the
+ *                  receive window by one credit so that it follows the
+ *                  throughput of the link. Ports queueing received data keep
+ *                  their window, which is bounded by rx_buf_critical.
+ *
+ * Returns          nothing
+ *
+ ******************************************************************************/
+static void port_grow_credits(tPORT* p_port) {
+  if (!p_port->p_data_callback && !p_port->p_data_co_callback) return;
+
+  if (p_port->credit_rx_max < PORT_RX_CREDIT_MAX) p_port->credit_rx_max++;
+}
+
+/*******************************************************************************
+ *
+ * Function         port_shrink_credits
+ *
+ * Description      Called when the user can't take more data. Halve the
+ *                  receive window, down to its initial size.
+ *
+ * Returns          nothing
+ *
+ ******************************************************************************/
+static void port_shrink_credits(tPORT* p_port) {
+  p_port->credit_rx_max /= 2;
+  if (p_port->credit_rx_max < p_port->credit_rx_base)
+    p_port->credit_rx_max = p_port->credit_rx_base;
+}
+
+/*******************************************************************************
+ *
+ * Function         port_credit_rx_limit
+ *
+ * Description      The receive window of the port, narrowed to the share of
+ *                  the buffer budget of the port so that the peer can't send
+ *                  more than that ahead of the user.
+ *
+ * Returns          the number of credits the peer may hold
+ *
+ ******************************************************************************/
+static uint16_t port_credit_rx_limit(const tPORT* p_port) {
+  size_t quota = btu_budget_channel_quota();
+  if (quota == 0 || p_port->mtu == 0) return p_port->credit_rx_max;
+
+  size_t credits = quota / p_port->mtu;
+  if (credits == 0) credits = 1;
+  if (credits < p_port->credit_rx_max) return (uint16_t)credits;
+  return p_port->credit_rx_max;
+}
+
 /*******************************************************************************
  *
  * Function         port_flow_control_peer
@@ -468,11 +532,14 @@ void port_flow_control_peer(tPORT* p_port, bool enable, uint16_t count) {
       /* did not force flow control, send a credit update */
       /* There might be a special case when we just adjusted rx_max */
       if ((p_port->credit_rx <= p_port->credit_rx_low) && !p_port->rx.user_fc &&
-          (p_port->credit_rx_max > p_port->credit_rx)) {
+          (port_credit_rx_limit(p_port) > p_port->credit_rx)) {
+        port_grow_credits(p_port);
+        uint16_t credit_limit = port_credit_rx_limit(p_port);
+        p_port->stats.credits_granted += credit_limit - p_port->credit_rx;
         rfc_send_credit(p_port->rfc.p_mcb, p_port->dlci,
-                        (uint8_t)(p_port->credit_rx_max - p_port->credit_rx));
+                        (uint8_t)(credit_limit - p_port->credit_rx));
 
-        p_port->credit_rx = p_port->credit_rx_max;
+        p_port->credit_rx = credit_limit;
 
         p_port->rx.peer_fc = false;
       }
@@ -482,6 +549,7 @@ void port_flow_control_peer(tPORT* p_port, bool enable, uint16_t count) {
       /* if client registered data callback, just do what they want */
       if (p_port->p_data_callback || p_port->p_data_co_callback) {
         p_port->rx.peer_fc = true;
+        port_shrink_credits(p_port);
       }
       /* if queue count reached credit rx max, set peer fc */
       else if (fixed_queue_length(p_port->rx.queue) >= p_port->credit_rx_max) {
@@ -496,7 +564,8 @@ void port_flow_control_peer(tPORT* p_port, bool enable, uint16_t count) {
       /* If rfcomm suspended traffic from the peer based on the rx_queue_size */
       /* check if it can be resumed now */
       if (p_port->rx.peer_fc && (p_port->rx.queue_size < PORT_RX_LOW_WM) &&
-          (fixed_queue_length(p_port->rx.queue) < PORT_RX_BUF_LOW_WM)) {
+          (fixed_queue_length(p_port->rx.queue) < PORT_RX_BUF_LOW_WM) &&
+          !btu_budget_exceeded(p_port->rx.queue_size)) {
         p_port->rx.peer_fc = false;
 
         /* If user did not force flow control allow traffic now */
@@ -514,7 +583,8 @@ void port_flow_control_peer(tPORT* p_port, bool enable, uint16_t count) {
       /* Check the size of the rx queue.  If it exceeds certain */
       /* level and flow control has not been sent to the peer do it now */
       else if (((p_port->rx.queue_size > PORT_RX_HIGH_WM) ||
-                (fixed_queue_length(p_port->rx.queue) > PORT_RX_BUF_HIGH_WM)) &&
+                (fixed_queue_length(p_port->rx.queue) > PORT_RX_BUF_HIGH_WM) ||
+                btu_budget_exceeded(p_port->rx.queue_size)) &&
                !p_port->rx.peer_fc) {
         RFCOMM_TRACE_EVENT("PORT_DataInd Data reached HW. Sending FC set.");
 
@@ -443,10 +443,14 @@ void rfc_port_sm_opened(tPORT* p_port, uint16_t event, void* p_data) {
           (p_port->credit_rx_max > p_port->credit_rx)) {
         ((BT_HDR*)p_data)->layer_specific =
             (uint8_t)(p_port->credit_rx_max - p_port->credit_rx);
+        p_port->stats.credits_granted +=
+            p_port->credit_rx_max - p_port->credit_rx;
         p_port->credit_rx = p_port->credit_rx_max;
       } else {
         ((BT_HDR*)p_data)->layer_specific = 0;
       }
+      p_port->stats.tx_frames++;
+      p_port->stats.tx_bytes += ((BT_HDR*)p_data)->len;
       rfc_send_buf_uih(p_port->rfc.p_mcb, p_port->dlci, (BT_HDR*)p_data);
       rfc_dec_credit(p_port);
       return;
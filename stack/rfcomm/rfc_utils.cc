@@ -399,7 +399,10 @@ void rfc_dec_credit(tPORT* p_port) {
   if (p_port->rfc.p_mcb->flow == PORT_FC_CREDIT) {
     if (p_port->credit_tx > 0) p_port->credit_tx--;
 
-    if (p_port->credit_tx == 0) p_port->tx.peer_fc = true;
+    if (p_port->credit_tx == 0) {
+      if (!p_port->tx.peer_fc) p_port->stats.tx_credit_stalls++;
+      p_port->tx.peer_fc = true;
+    }
   }
 }
 
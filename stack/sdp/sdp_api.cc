@@ -106,6 +106,8 @@ bool SDP_InitDiscoveryDb(tSDP_DISCOVERY_DB* p_db, uint32_t len,
  *
  ******************************************************************************/
 bool SDP_CancelServiceSearch(tSDP_DISCOVERY_DB* p_db) {
+  if (sdp_disc_cache_cancel(p_db)) return (true);
+
   tCONN_CB* p_ccb = sdpu_find_ccb_by_db(p_db);
   if (!p_ccb) return (false);
 
@@ -159,6 +161,8 @@ bool SDP_ServiceSearchAttributeRequest(const RawAddress& p_bd_addr,
                                        tSDP_DISC_CMPL_CB* p_cb) {
   tCONN_CB* p_ccb;
 
+  if (sdp_disc_cache_serve(p_bd_addr, p_db, p_cb, NULL, NULL)) return (true);
+
   /* Specific BD address */
   p_ccb = sdp_conn_originate(p_bd_addr);
 
@@ -192,6 +196,9 @@ bool SDP_ServiceSearchAttributeRequest2(const RawAddress& p_bd_addr,
                                         void* user_data) {
   tCONN_CB* p_ccb;
 
+  if (sdp_disc_cache_serve(p_bd_addr, p_db, NULL, p_cb2, user_data))
+    return (true);
+
   /* Specific BD address */
   p_ccb = sdp_conn_originate(p_bd_addr);
 
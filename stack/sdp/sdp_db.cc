@@ -25,6 +25,9 @@
 #include <stdio.h>
 #include <string.h>
 
+#include <set>
+#include <unordered_map>
+
 #include "bt_target.h"
 
 #include "bt_common.h"
@@ -36,8 +39,136 @@
 /******************************************************************************/
 /*            L O C A L    F U N C T I O N     P R O T O T Y P E S            */
 /******************************************************************************/
-static bool find_uuid_in_seq(uint8_t* p, uint32_t seq_len, uint8_t* p_his_uuid,
-                             uint16_t his_len, int nest_level);
+static void collect_uuids_in_seq(uint8_t* p, uint32_t seq_len, uint32_t handle,
+                                 int nest_level);
+
+/* Record handles by UUID, for every UUID found in the UUID attributes and the
+** data element sequences of the records. It saves re-parsing the attribute
+** values of every record on each service search.
+*/
+static std::unordered_map<bluetooth::Uuid, std::set<uint32_t>> sdp_uuid_index;
+
+/* Incremented on every change to the database, see sdp_db_get_generation */
+static uint32_t sdp_db_generation;
+
+/*******************************************************************************
+ *
+ * Function         sdp_db_uuid_from_array
+ *
+ * Description      This function converts a BE UUID of 2, 4 or 16 bytes to its
+ *                  128-bit form, the form the UUID index uses.
+ *
+ * Returns          true if the length is valid, else false
+ *
+ ******************************************************************************/
+static bool sdp_db_uuid_from_array(uint8_t* p_uuid, uint32_t len,
+                                   bluetooth::Uuid* p_out) {
+  switch (len) {
+    case bluetooth::Uuid::kNumBytes16:
+      *p_out = bluetooth::Uuid::From16Bit((p_uuid[0] << 8) | p_uuid[1]);
+      return true;
+    case bluetooth::Uuid::kNumBytes32:
+      *p_out = bluetooth::Uuid::From32Bit((p_uuid[0] << 24) |
+                                          (p_uuid[1] << 16) |
+                                          (p_uuid[2] << 8) | p_uuid[3]);
+      return true;
+    case bluetooth::Uuid::kNumBytes128:
+      *p_out = bluetooth::Uuid::From128BitBE(p_uuid);
+      return true;
+    default:
+      return false;
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         sdp_db_index_uuid
+ *
+ * Description      This function adds a record handle to the index entry of
+ *                  a UUID found in the record.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void sdp_db_index_uuid(uint8_t* p_uuid, uint32_t len, uint32_t handle) {
+  bluetooth::Uuid uuid;
+  if (sdp_db_uuid_from_array(p_uuid, len, &uuid))
+    sdp_uuid_index[uuid].insert(handle);
+}
+
+/*******************************************************************************
+ *
+ * Function         sdp_db_unindex_record
+ *
+ * Description      This function removes a record from the UUID index.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void sdp_db_unindex_record(uint32_t handle) {
+  for (auto it = sdp_uuid_index.begin(); it != sdp_uuid_index.end();) {
+    it->second.erase(handle);
+    if (it->second.empty())
+      it = sdp_uuid_index.erase(it);
+    else
+      it++;
+  }
+  sdp_db_generation++;
+}
+
+/*******************************************************************************
+ *
+ * Function         sdp_db_index_record
+ *
+ * Description      This function updates the UUID index after the attributes
+ *                  of a record have changed.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void sdp_db_index_record(tSDP_RECORD* p_rec) {
+  tSDP_ATTRIBUTE* p_attr = &p_rec->attribute[0];
+  uint16_t xx;
+
+  sdp_db_unindex_record(p_rec->record_handle);
+
+  for (xx = 0; xx < p_rec->num_attributes; xx++, p_attr++) {
+    if (p_attr->type == UUID_DESC_TYPE) {
+      sdp_db_index_uuid(p_attr->value_ptr, p_attr->len, p_rec->record_handle);
+    } else if (p_attr->type == DATA_ELE_SEQ_DESC_TYPE) {
+      collect_uuids_in_seq(p_attr->value_ptr, p_attr->len, p_rec->record_handle,
+                           0);
+    }
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         sdp_db_reset_index
+ *
+ * Description      This function empties the UUID index, when all the records
+ *                  of the database are deleted.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void sdp_db_reset_index(void) {
+  sdp_uuid_index.clear();
+  sdp_db_generation++;
+}
+
+/*******************************************************************************
+ *
+ * Function         sdp_db_get_generation
+ *
+ * Description      This function returns a number that changes whenever a
+ *                  record or an attribute is added or deleted, so that the
+ *                  server can tell whether a cached response is still valid.
+ *
+ * Returns          The database generation
+ *
+ ******************************************************************************/
+uint32_t sdp_db_get_generation(void) { return sdp_db_generation; }
 
 /*******************************************************************************
  *
@@ -51,9 +182,10 @@ static bool find_uuid_in_seq(uint8_t* p, uint32_t seq_len, uint8_t* p_his_uuid,
  *
  ******************************************************************************/
 tSDP_RECORD* sdp_db_service_search(tSDP_RECORD* p_rec, tSDP_UUID_SEQ* p_seq) {
-  uint16_t xx, yy;
-  tSDP_ATTRIBUTE* p_attr;
+  uint16_t yy;
   tSDP_RECORD* p_end = &sdp_cb.server_db.record[sdp_cb.server_db.num_records];
+  const std::set<uint32_t>* handles[MAX_UUIDS_PER_SEQ];
+  bluetooth::Uuid uuid;
 
   /* If NULL, start at the beginning, else start at the first specified record
    */
@@ -62,26 +194,23 @@ tSDP_RECORD* sdp_db_service_search(tSDP_RECORD* p_rec, tSDP_UUID_SEQ* p_seq) {
   else
     p_rec++;
 
+  /* Look up the records of each UUID. If a UUID is in no record, no record */
+  /* can match.                                                             */
+  for (yy = 0; yy < p_seq->num_uids; yy++) {
+    if (!sdp_db_uuid_from_array(&p_seq->uuid_entry[yy].value[0],
+                                p_seq->uuid_entry[yy].len, &uuid))
+      return (NULL);
+    auto entry = sdp_uuid_index.find(uuid);
+    if (entry == sdp_uuid_index.end()) return (NULL);
+    handles[yy] = &entry->second;
+  }
+
   /* Look through the records. The spec says that a match occurs if */
   /* the record contains all the passed UUIDs in it.                */
   for (; p_rec < p_end; p_rec++) {
     for (yy = 0; yy < p_seq->num_uids; yy++) {
-      p_attr = &p_rec->attribute[0];
-      for (xx = 0; xx < p_rec->num_attributes; xx++, p_attr++) {
-        if (p_attr->type == UUID_DESC_TYPE) {
-          if (sdpu_compare_uuid_arrays(p_attr->value_ptr, p_attr->len,
-                                       &p_seq->uuid_entry[yy].value[0],
-                                       p_seq->uuid_entry[yy].len))
-            break;
-        } else if (p_attr->type == DATA_ELE_SEQ_DESC_TYPE) {
-          if (find_uuid_in_seq(p_attr->value_ptr, p_attr->len,
-                               &p_seq->uuid_entry[yy].value[0],
-                               p_seq->uuid_entry[yy].len, 0))
-            break;
-        }
-      }
       /* If any UUID was not found,  on to the next record */
-      if (xx == p_rec->num_attributes) break;
+      if (handles[yy]->count(p_rec->record_handle) == 0) break;
     }
 
     /* If every UUID was found in the record, return the record */
@@ -94,21 +223,22 @@ tSDP_RECORD* sdp_db_service_search(tSDP_RECORD* p_rec, tSDP_UUID_SEQ* p_seq) {
 
 /*******************************************************************************
  *
- * Function         find_uuid_in_seq
+ * Function         collect_uuids_in_seq
  *
- * Description      This function searches a data element sequenct for a UUID.
+ * Description      This function adds the UUIDs of a data element sequence to
+ *                  the UUID index.
  *
- * Returns          true if found, else false
+ * Returns          void
  *
  ******************************************************************************/
-static bool find_uuid_in_seq(uint8_t* p, uint32_t seq_len, uint8_t* p_uuid,
-                             uint16_t uuid_len, int nest_level) {
+static void collect_uuids_in_seq(uint8_t* p, uint32_t seq_len, uint32_t handle,
+                                 int nest_level) {
   uint8_t* p_end = p + seq_len;
   uint8_t type;
   uint32_t len;
 
   /* A little safety check to avoid excessive recursion */
-  if (nest_level > 3) return (false);
+  if (nest_level > 3) return;
 
   while (p < p_end) {
     type = *p++;
@@ -119,16 +249,12 @@ static bool find_uuid_in_seq(uint8_t* p, uint32_t seq_len, uint8_t* p_uuid,
     }
     type = type >> 3;
     if (type == UUID_DESC_TYPE) {
-      if (sdpu_compare_uuid_arrays(p, len, p_uuid, uuid_len)) return (true);
+      sdp_db_index_uuid(p, len, handle);
     } else if (type == DATA_ELE_SEQ_DESC_TYPE) {
-      if (find_uuid_in_seq(p, len, p_uuid, uuid_len, nest_level + 1))
-        return (true);
+      collect_uuids_in_seq(p, len, handle, nest_level + 1);
     }
     p = p + len;
   }
-
-  /* If here, failed to match */
-  return (false);
 }
 
 /*******************************************************************************
@@ -305,6 +431,8 @@ bool SDP_DeleteRecord(uint32_t handle) {
     /* require new DI record to be created in SDP_SetLocalDiRecord */
     sdp_cb.server_db.di_primary_handle = 0;
 
+    sdp_db_reset_index();
+
     return (true);
   } else {
     /* Find the record in the database */
@@ -320,6 +448,7 @@ bool SDP_DeleteRecord(uint32_t handle) {
         }
 
         sdp_cb.server_db.num_records--;
+        sdp_db_unindex_record(handle);
 
         SDP_TRACE_DEBUG("SDP_DeleteRecord ok, num_records:%d",
                         sdp_cb.server_db.num_records);
@@ -445,9 +574,11 @@ bool SDP_AddAttribute(uint32_t handle, uint16_t attr_id, uint8_t attr_type,
             "SDP_AddAttribute fail, length exceed maximum: ID %d: attr_len:%d ",
             attr_id, attr_len);
         p_attr->id = p_attr->type = p_attr->len = 0;
+        sdp_db_index_record(p_rec);
         return (false);
       }
       p_rec->num_attributes++;
+      sdp_db_index_record(p_rec);
       return (true);
     }
   }
@@ -830,6 +961,7 @@ bool SDP_DeleteAttribute(uint32_t handle, uint16_t attr_id) {
             }
             p_rec->free_pad_ptr -= len;
           }
+          sdp_db_index_record(p_rec);
           return (true);
         }
       }
@@ -0,0 +1,525 @@
+/******************************************************************************
+ *
+ *  Copyright 2020 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This file contains the SDP client discovery cache. Peers rarely change
+ *  their records, so the attribute lists they sent for a service search
+ *  attribute request are kept per peer and request, and used to answer the
+ *  same request again without opening an L2CAP channel. The results of bonded
+ *  peers are saved in the config, so they survive a restart. Requests made
+ *  while the same request to the same peer is in progress wait for its result
+ *  instead of opening a channel of their own.
+ *
+ ******************************************************************************/
+
+#include <base/bind.h>
+#include <string.h>
+#include <time.h>
+
+#include <list>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "bt_common.h"
+#include "bt_types.h"
+#include "btif_config.h"
+#include "btm_int.h"
+#include "btu.h"
+#include "sdp_api.h"
+#include "sdpint.h"
+
+using bluetooth::Uuid;
+
+/* Version of the config entry format */
+#define SDP_DISC_CACHE_VERSION 1
+
+/* An attribute list a peer sent for a request */
+typedef struct {
+  uint32_t read_time; /* Seconds since the epoch */
+  std::vector<Uuid> uuid_filters;
+  std::vector<uint16_t> attr_filters;
+  std::vector<uint8_t> attr_list;
+} tSDP_DISC_RESULT;
+
+/* A request answered without an L2CAP channel of its own */
+typedef struct {
+  uint32_t id;
+  tCONN_CB* p_leader; /* Request in progress it waits for, NULL if served */
+  RawAddress bd_addr;
+  tSDP_DISCOVERY_DB* p_db;
+  tSDP_DISC_CMPL_CB* p_cb;
+  tSDP_DISC_CMPL_CB2* p_cb2;
+  void* user_data;
+  bool cancelled;
+} tSDP_DISC_PENDING;
+
+static std::unordered_map<RawAddress, std::vector<tSDP_DISC_RESULT>>
+    sdp_disc_results;
+/* Peers whose config entry has been read */
+static std::unordered_set<RawAddress> sdp_disc_loaded;
+static std::list<tSDP_DISC_PENDING> sdp_disc_pending;
+static uint32_t sdp_disc_next_id;
+
+/*******************************************************************************
+ *
+ * Function         result_matches
+ *
+ * Description      This function checks whether a result was read for the
+ *                  UUID and attribute filters of a discovery database.
+ *
+ * Returns          true if it was, else false
+ *
+ ******************************************************************************/
+static bool result_matches(const tSDP_DISC_RESULT& result,
+                           const tSDP_DISCOVERY_DB* p_db) {
+  if (result.uuid_filters.size() != p_db->num_uuid_filters ||
+      result.attr_filters.size() != p_db->num_attr_filters)
+    return false;
+
+  for (uint16_t xx = 0; xx < p_db->num_uuid_filters; xx++) {
+    if (result.uuid_filters[xx] != p_db->uuid_filters[xx]) return false;
+  }
+  for (uint16_t xx = 0; xx < p_db->num_attr_filters; xx++) {
+    if (result.attr_filters[xx] != p_db->attr_filters[xx]) return false;
+  }
+  return true;
+}
+
+/*******************************************************************************
+ *
+ * Function         same_filters
+ *
+ * Description      This function checks whether two discovery databases have
+ *                  the same UUID and attribute filters.
+ *
+ * Returns          true if they have, else false
+ *
+ ******************************************************************************/
+static bool same_filters(const tSDP_DISCOVERY_DB* p_db1,
+                         const tSDP_DISCOVERY_DB* p_db2) {
+  if (p_db1->num_uuid_filters != p_db2->num_uuid_filters ||
+      p_db1->num_attr_filters != p_db2->num_attr_filters)
+    return false;
+
+  for (uint16_t xx = 0; xx < p_db1->num_uuid_filters; xx++) {
+    if (p_db1->uuid_filters[xx] != p_db2->uuid_filters[xx]) return false;
+  }
+  for (uint16_t xx = 0; xx < p_db1->num_attr_filters; xx++) {
+    if (p_db1->attr_filters[xx] != p_db2->attr_filters[xx]) return false;
+  }
+  return true;
+}
+
+/*******************************************************************************
+ *
+ * Function         save_results
+ *
+ * Description      This function writes the results of a bonded peer to the
+ *                  config, as one binary entry:
+ *                    version (1 byte), then for each result
+ *                    read time (4), number of UUIDs (1), 128-bit BE UUIDs,
+ *                    number of attributes (1), attribute IDs (2 each),
+ *                    list length (2) and the attribute list.
+ *                  Multi-byte numbers are little endian.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void save_results(const RawAddress& bd_addr) {
+  if (!btm_sec_is_a_bonded_dev(bd_addr)) return;
+
+  std::vector<uint8_t> blob;
+  blob.push_back(SDP_DISC_CACHE_VERSION);
+  for (const tSDP_DISC_RESULT& result : sdp_disc_results[bd_addr]) {
+    for (int xx = 0; xx < 4; xx++)
+      blob.push_back((uint8_t)(result.read_time >> (8 * xx)));
+    blob.push_back((uint8_t)result.uuid_filters.size());
+    for (const Uuid& uuid : result.uuid_filters) {
+      const Uuid::UUID128Bit& uuid_bytes = uuid.To128BitBE();
+      blob.insert(blob.end(), uuid_bytes.begin(), uuid_bytes.end());
+    }
+    blob.push_back((uint8_t)result.attr_filters.size());
+    for (uint16_t attr_id : result.attr_filters) {
+      blob.push_back((uint8_t)attr_id);
+      blob.push_back((uint8_t)(attr_id >> 8));
+    }
+    blob.push_back((uint8_t)result.attr_list.size());
+    blob.push_back((uint8_t)(result.attr_list.size() >> 8));
+    blob.insert(blob.end(), result.attr_list.begin(), result.attr_list.end());
+  }
+
+  btif_config_set_bin(bd_addr.ToString(), BT_CONFIG_KEY_SDP_DISC_CACHE,
+                      blob.data(), blob.size());
+}
+
+/*******************************************************************************
+ *
+ * Function         load_results
+ *
+ * Description      This function reads the results of a peer from the config,
+ *                  the first time the peer is looked up.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void load_results(const RawAddress& bd_addr) {
+  if (!sdp_disc_loaded.insert(bd_addr).second) return;
+
+  std::string section = bd_addr.ToString();
+  size_t len = btif_config_get_bin_length(section, BT_CONFIG_KEY_SDP_DISC_CACHE);
+  if (len == 0) return;
+
+  std::vector<uint8_t> blob(len);
+  if (!btif_config_get_bin(section, BT_CONFIG_KEY_SDP_DISC_CACHE, blob.data(),
+                           &len) ||
+      len == 0 || blob[0] != SDP_DISC_CACHE_VERSION)
+    return;
+
+  std::vector<tSDP_DISC_RESULT> results;
+  uint8_t* p = blob.data() + 1;
+  uint8_t* p_end = blob.data() + len;
+  while (p < p_end) {
+    tSDP_DISC_RESULT result;
+    uint8_t num;
+    uint16_t list_len;
+
+    if (p + 5 > p_end) break;
+    STREAM_TO_UINT32(result.read_time, p);
+    STREAM_TO_UINT8(num, p);
+    if (num > SDP_MAX_UUID_FILTERS || p + num * Uuid::kNumBytes128 > p_end)
+      break;
+    for (uint8_t xx = 0; xx < num; xx++, p += Uuid::kNumBytes128)
+      result.uuid_filters.push_back(Uuid::From128BitBE(p));
+
+    if (p + 1 > p_end) break;
+    STREAM_TO_UINT8(num, p);
+    if (num > SDP_MAX_ATTR_FILTERS || p + num * 2 + 2 > p_end) break;
+    for (uint8_t xx = 0; xx < num; xx++) {
+      uint16_t attr_id;
+      STREAM_TO_UINT16(attr_id, p);
+      result.attr_filters.push_back(attr_id);
+    }
+
+    STREAM_TO_UINT16(list_len, p);
+    if (p + list_len > p_end) break;
+    result.attr_list.assign(p, p + list_len);
+    p += list_len;
+
+    results.push_back(std::move(result));
+  }
+
+  if (p != p_end) {
+    SDP_TRACE_WARNING("%s: bad cache entry for %s", __func__, section.c_str());
+    btif_config_remove(section, BT_CONFIG_KEY_SDP_DISC_CACHE);
+    return;
+  }
+  sdp_disc_results[bd_addr] = std::move(results);
+}
+
+/*******************************************************************************
+ *
+ * Function         find_result
+ *
+ * Description      This function looks for a result of a peer read recently
+ *                  enough for the filters of a discovery database.
+ *
+ * Returns          Pointer to the result, or NULL if not found
+ *
+ ******************************************************************************/
+static const tSDP_DISC_RESULT* find_result(const RawAddress& bd_addr,
+                                           const tSDP_DISCOVERY_DB* p_db) {
+  load_results(bd_addr);
+
+  auto results = sdp_disc_results.find(bd_addr);
+  if (results == sdp_disc_results.end()) return NULL;
+
+  uint32_t now = (uint32_t)time(NULL);
+  for (const tSDP_DISC_RESULT& result : results->second) {
+    if (!result_matches(result, p_db)) continue;
+    /* A clock moved backwards makes the result stale too */
+    if (result.read_time > now ||
+        now - result.read_time >= SDP_DISC_CACHE_TIMEOUT_S)
+      return NULL;
+    return &result;
+  }
+  return NULL;
+}
+
+/*******************************************************************************
+ *
+ * Function         add_result_to_db
+ *
+ * Description      This function adds the records of a result to a discovery
+ *                  database. The database is left unchanged on failure.
+ *
+ * Returns          true if all the records fit, else false
+ *
+ ******************************************************************************/
+static bool add_result_to_db(const RawAddress& bd_addr,
+                             const tSDP_DISC_RESULT& result,
+                             tSDP_DISCOVERY_DB* p_db) {
+  uint32_t mem_free = p_db->mem_free;
+  uint8_t* p_free_mem = p_db->p_free_mem;
+  tSDP_DISC_REC* p_first_rec = p_db->p_first_rec;
+
+  std::vector<uint8_t> attr_list = result.attr_list;
+  if (sdp_disc_add_attr_list(p_db, bd_addr, attr_list.data(),
+                             (uint16_t)attr_list.size()))
+    return true;
+
+  p_db->mem_free = mem_free;
+  p_db->p_free_mem = p_free_mem;
+  p_db->p_first_rec = p_first_rec;
+  return false;
+}
+
+/*******************************************************************************
+ *
+ * Function         call_user_cb
+ *
+ * Description      This function reports the result of a pending request.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void call_user_cb(const tSDP_DISC_PENDING& pending, uint16_t result) {
+  if (pending.cancelled) result = SDP_CANCEL;
+
+  if (pending.p_cb)
+    (*pending.p_cb)(result);
+  else if (pending.p_cb2)
+    (*pending.p_cb2)(result, pending.user_data);
+}
+
+/*******************************************************************************
+ *
+ * Function         deliver_cached_result
+ *
+ * Description      This function completes a request served from the cache,
+ *                  once the caller has returned.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void deliver_cached_result(uint32_t id) {
+  for (auto it = sdp_disc_pending.begin(); it != sdp_disc_pending.end();
+       it++) {
+    if (it->id == id) {
+      tSDP_DISC_PENDING pending = *it;
+      sdp_disc_pending.erase(it);
+      call_user_cb(pending, SDP_SUCCESS);
+      return;
+    }
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         find_leader
+ *
+ * Description      This function looks for a service search attribute request
+ *                  in progress to a peer, with the filters of a database.
+ *
+ * Returns          the CCB of the request, or NULL if not found
+ *
+ ******************************************************************************/
+static tCONN_CB* find_leader(const RawAddress& bd_addr,
+                             const tSDP_DISCOVERY_DB* p_db) {
+  tCONN_CB* p_ccb = &sdp_cb.ccb[0];
+
+  for (uint16_t xx = 0; xx < SDP_MAX_CONNECTIONS; xx++, p_ccb++) {
+    if (p_ccb->con_state != SDP_STATE_IDLE &&
+        (p_ccb->con_flags & SDP_FLAGS_IS_ORIG) && p_ccb->is_attr_search &&
+        p_ccb->disc_state != SDP_DISC_WAIT_CANCEL && p_ccb->p_db != NULL &&
+        p_ccb->disconnect_reason == 0 && p_ccb->device_address == bd_addr &&
+        same_filters(p_ccb->p_db, p_db))
+      return p_ccb;
+  }
+  return NULL;
+}
+
+/*******************************************************************************
+ *
+ * Function         sdp_disc_cache_serve
+ *
+ * Description      This function is called for a service search attribute
+ *                  request. It answers it from the cache, or makes it wait
+ *                  for the same request in progress to the same peer.
+ *
+ * Returns          true if the request needs no channel of its own, else
+ *                  false
+ *
+ ******************************************************************************/
+bool sdp_disc_cache_serve(const RawAddress& bd_addr, tSDP_DISCOVERY_DB* p_db,
+                          tSDP_DISC_CMPL_CB* p_cb, tSDP_DISC_CMPL_CB2* p_cb2,
+                          void* user_data) {
+#if (SDP_BROWSE_PLUS == TRUE)
+  /* Results are read one UUID at a time */
+  return false;
+#else
+#if (SDP_RAW_DATA_INCLUDED == TRUE)
+  /* The raw data can only be copied from the peer's responses */
+  if (p_db->raw_data) return false;
+#endif
+
+  tSDP_DISC_PENDING pending = {sdp_disc_next_id++, NULL, bd_addr, p_db, p_cb,
+                               p_cb2, user_data, false};
+
+  pending.p_leader = find_leader(bd_addr, p_db);
+  if (pending.p_leader) {
+    SDP_TRACE_EVENT("%s: waiting for the search in progress to %s", __func__,
+                    bd_addr.ToString().c_str());
+    sdp_disc_pending.push_back(pending);
+    return true;
+  }
+
+  if (p_db->skip_cache) return false;
+
+  const tSDP_DISC_RESULT* p_result = find_result(bd_addr, p_db);
+  if (p_result == NULL || !add_result_to_db(bd_addr, *p_result, p_db))
+    return false;
+
+  SDP_TRACE_EVENT("%s: answered from the cache for %s", __func__,
+                  bd_addr.ToString().c_str());
+  sdp_disc_pending.push_back(pending);
+  do_in_main_thread(FROM_HERE, base::Bind(&deliver_cached_result, pending.id));
+  return true;
+#endif
+}
+
+/*******************************************************************************
+ *
+ * Function         sdp_disc_cache_store
+ *
+ * Description      This function saves the attribute list received for a
+ *                  service search attribute request.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void sdp_disc_cache_store(tCONN_CB* p_ccb) {
+#if (SDP_BROWSE_PLUS != TRUE)
+  tSDP_DISCOVERY_DB* p_db = p_ccb->p_db;
+
+  load_results(p_ccb->device_address);
+
+  std::vector<tSDP_DISC_RESULT>& results =
+      sdp_disc_results[p_ccb->device_address];
+  for (auto it = results.begin(); it != results.end(); it++) {
+    if (result_matches(*it, p_db)) {
+      results.erase(it);
+      break;
+    }
+  }
+
+  tSDP_DISC_RESULT result;
+  result.read_time = (uint32_t)time(NULL);
+  result.uuid_filters.assign(p_db->uuid_filters,
+                             p_db->uuid_filters + p_db->num_uuid_filters);
+  result.attr_filters.assign(p_db->attr_filters,
+                             p_db->attr_filters + p_db->num_attr_filters);
+  result.attr_list.assign(p_ccb->rsp_list, p_ccb->rsp_list + p_ccb->list_len);
+
+  /* Most recent first, so the oldest is dropped when full */
+  results.insert(results.begin(), std::move(result));
+  if (results.size() > SDP_DISC_CACHE_MAX_RESULTS)
+    results.resize(SDP_DISC_CACHE_MAX_RESULTS);
+
+  save_results(p_ccb->device_address);
+#endif
+}
+
+/*******************************************************************************
+ *
+ * Function         sdp_disc_cache_complete
+ *
+ * Description      This function is called when a request with a channel of
+ *                  its own completes, and completes the requests waiting for
+ *                  it with the same result.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void sdp_disc_cache_complete(tCONN_CB* p_ccb, uint16_t result) {
+  /* The callbacks may start requests, which may wait for this one too */
+  while (true) {
+    auto it = sdp_disc_pending.begin();
+    while (it != sdp_disc_pending.end() && it->p_leader != p_ccb) it++;
+    if (it == sdp_disc_pending.end()) return;
+
+    tSDP_DISC_PENDING pending = *it;
+    sdp_disc_pending.erase(it);
+
+    uint16_t pending_result = result;
+    if (result == SDP_SUCCESS) {
+      const tSDP_DISC_RESULT* p_result =
+          find_result(pending.bd_addr, pending.p_db);
+      if (p_result == NULL)
+        pending_result = SDP_GENERIC_ERROR;
+      else if (!add_result_to_db(pending.bd_addr, *p_result, pending.p_db))
+        pending_result = SDP_DB_FULL;
+    } else if (result == SDP_CANCEL) {
+      /* Only the request in progress was cancelled */
+      pending_result = SDP_CONN_FAILED;
+    }
+    call_user_cb(pending, pending_result);
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         sdp_disc_cache_cancel
+ *
+ * Description      This function cancels a request that has no channel of its
+ *                  own. Its callback is still called, with SDP_CANCEL.
+ *
+ * Returns          true if the request was found, else false
+ *
+ ******************************************************************************/
+bool sdp_disc_cache_cancel(tSDP_DISCOVERY_DB* p_db) {
+  for (tSDP_DISC_PENDING& pending : sdp_disc_pending) {
+    if (pending.p_db != p_db || pending.cancelled) continue;
+
+    pending.cancelled = true;
+    if (pending.p_leader) {
+      pending.p_leader = NULL;
+      do_in_main_thread(FROM_HERE,
+                        base::Bind(&deliver_cached_result, pending.id));
+    }
+    return true;
+  }
+  return false;
+}
+
+/*******************************************************************************
+ *
+ * Function         sdp_disc_cache_init
+ *
+ * Description      This function drops the requests still pending, and the
+ *                  results read so that they are read again from the config.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void sdp_disc_cache_init(void) {
+  sdp_disc_pending.clear();
+  sdp_disc_results.clear();
+  sdp_disc_loaded.clear();
+}
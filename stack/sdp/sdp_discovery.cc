@@ -48,7 +48,9 @@ static void process_service_attr_rsp(tCONN_CB* p_ccb, uint8_t* p_reply,
                                      uint8_t* p_reply_end);
 static void process_service_search_attr_rsp(tCONN_CB* p_ccb, uint8_t* p_reply,
                                             uint8_t* p_reply_end);
-static uint8_t* save_attr_seq(tCONN_CB* p_ccb, uint8_t* p, uint8_t* p_msg_end);
+static uint8_t* save_attr_seq(tSDP_DISCOVERY_DB* p_db,
+                              const RawAddress& bd_addr, uint8_t* p,
+                              uint8_t* p_msg_end);
 static tSDP_DISC_REC* add_record(tSDP_DISCOVERY_DB* p_db,
                                  const RawAddress& p_bda);
 static uint8_t* add_attr(uint8_t* p, uint8_t* p_end, tSDP_DISCOVERY_DB* p_db,
@@ -442,7 +444,8 @@ static void process_service_attr_rsp(tCONN_CB* p_ccb, uint8_t* p_reply,
 #endif
 
       /* Save the response in the database. Stop on any error */
-      if (!save_attr_seq(p_ccb, &p_ccb->rsp_list[0],
+      if (!save_attr_seq(p_ccb->p_db, p_ccb->device_address,
+                         &p_ccb->rsp_list[0],
                          &p_ccb->rsp_list[p_ccb->list_len])) {
         sdp_disconnect(p_ccb, SDP_DB_FULL);
         return;
@@ -670,7 +673,8 @@ static void process_service_search_attr_rsp(tCONN_CB* p_ccb, uint8_t* p_reply,
   }
 
   while (p < p_end) {
-    p = save_attr_seq(p_ccb, p, &p_ccb->rsp_list[p_ccb->list_len]);
+    p = save_attr_seq(p_ccb->p_db, p_ccb->device_address, p,
+                      &p_ccb->rsp_list[p_ccb->list_len]);
     if (!p) {
       sdp_disconnect(p_ccb, SDP_DB_FULL);
       return;
@@ -679,9 +683,43 @@ static void process_service_search_attr_rsp(tCONN_CB* p_ccb, uint8_t* p_reply,
 
   /* Since we got everything we need, disconnect the call */
   sdpu_log_attribute_metrics(p_ccb->device_address, p_ccb->p_db);
+  sdp_disc_cache_store(p_ccb);
   sdp_disconnect(p_ccb, SDP_SUCCESS);
 }
 
+/*******************************************************************************
+ *
+ * Function         sdp_disc_add_attr_list
+ *
+ * Description      This function adds the records of a complete service
+ *                  search attribute response, a sequence of attribute
+ *                  sequences, to a discovery database.
+ *
+ * Returns          true if the list is valid and fits, else false
+ *
+ ******************************************************************************/
+bool sdp_disc_add_attr_list(tSDP_DISCOVERY_DB* p_db, const RawAddress& bd_addr,
+                            uint8_t* p_list, uint16_t list_len) {
+  uint8_t* p = p_list;
+  uint8_t* p_end = p_list + list_len;
+  uint8_t type;
+  uint32_t seq_len;
+
+  if (list_len == 0) return false;
+
+  type = *p++;
+  if ((type >> 3) != DATA_ELE_SEQ_DESC_TYPE) return false;
+
+  p = sdpu_get_len_from_type(p, p_end, type, &seq_len);
+  if (p == NULL || (p + seq_len) != p_end) return false;
+
+  while (p < p_end) {
+    p = save_attr_seq(p_db, bd_addr, p, p_end);
+    if (!p) return false;
+  }
+  return true;
+}
+
 /*******************************************************************************
  *
  * Function         save_attr_seq
@@ -692,7 +730,9 @@ static void process_service_search_attr_rsp(tCONN_CB* p_ccb, uint8_t* p_reply,
  * Returns          pointer to next byte or NULL if error
  *
  ******************************************************************************/
-static uint8_t* save_attr_seq(tCONN_CB* p_ccb, uint8_t* p, uint8_t* p_msg_end) {
+static uint8_t* save_attr_seq(tSDP_DISCOVERY_DB* p_db,
+                              const RawAddress& bd_addr, uint8_t* p,
+                              uint8_t* p_msg_end) {
   uint32_t seq_len, attr_len;
   uint16_t attr_id;
   uint8_t type, *p_seq_end;
@@ -711,7 +751,7 @@ static uint8_t* save_attr_seq(tCONN_CB* p_ccb, uint8_t* p, uint8_t* p_msg_end) {
   }
 
   /* Create a record */
-  p_rec = add_record(p_ccb->p_db, p_ccb->device_address);
+  p_rec = add_record(p_db, bd_addr);
   if (!p_rec) {
     SDP_TRACE_WARNING("SDP - DB full add_record");
     return (NULL);
@@ -735,7 +775,7 @@ static uint8_t* save_attr_seq(tCONN_CB* p_ccb, uint8_t* p, uint8_t* p_msg_end) {
     BE_STREAM_TO_UINT16(attr_id, p);
 
     /* Now, add the attribute value */
-    p = add_attr(p, p_seq_end, p_ccb->p_db, p_rec, attr_id, NULL, 0);
+    p = add_attr(p, p_seq_end, p_db, p_rec, attr_id, NULL, 0);
 
     if (!p) {
       SDP_TRACE_WARNING("SDP - DB full add_attr");
@@ -54,6 +54,7 @@ static void sdp_data_ind(uint16_t l2cap_cid, BT_HDR* p_msg);
 
 static void sdp_connect_cfm(uint16_t l2cap_cid, uint16_t result);
 static void sdp_disconnect_cfm(uint16_t l2cap_cid, uint16_t result);
+static void sdp_notify_user(tCONN_CB* p_ccb, uint16_t result);
 
 /*******************************************************************************
  *
@@ -67,6 +68,10 @@ static void sdp_disconnect_cfm(uint16_t l2cap_cid, uint16_t result);
 void sdp_init(void) {
   /* Clears all structures and local SDP database (if Server is enabled) */
   memset(&sdp_cb, 0, sizeof(tSDP_CB));
+#if (SDP_SERVER_ENABLED == TRUE)
+  sdp_db_reset_index();
+#endif
+  sdp_disc_cache_init();
 
   for (int i = 0; i < SDP_MAX_CONNECTIONS; i++) {
     sdp_cb.ccb[i].sdp_conn_timer = alarm_new("sdp.sdp_conn_timer");
@@ -250,10 +255,7 @@ static void sdp_connect_cfm(uint16_t l2cap_cid, uint16_t result) {
         err = SDP_CONN_REJECTED;
       else
         err = SDP_CONN_FAILED;
-      if (p_ccb->p_cb)
-        (*p_ccb->p_cb)(err);
-      else if (p_ccb->p_cb2)
-        (*p_ccb->p_cb2)(err, p_ccb->user_data);
+      sdp_notify_user(p_ccb, err);
     }
     sdpu_release_ccb(p_ccb);
   }
@@ -427,15 +429,10 @@ static void sdp_disconnect_ind(uint16_t l2cap_cid, bool ack_needed) {
 
   SDP_TRACE_EVENT("SDP - Rcvd L2CAP disc, CID: 0x%x", l2cap_cid);
   /* Tell the user if he has a callback */
-  if (p_ccb->p_cb)
-    (*p_ccb->p_cb)((uint16_t)((p_ccb->con_state == SDP_STATE_CONNECTED)
-                                  ? SDP_SUCCESS
-                                  : SDP_CONN_FAILED));
-  else if (p_ccb->p_cb2)
-    (*p_ccb->p_cb2)(
-        (uint16_t)((p_ccb->con_state == SDP_STATE_CONNECTED) ? SDP_SUCCESS
-                                                             : SDP_CONN_FAILED),
-        p_ccb->user_data);
+  sdp_notify_user(p_ccb,
+                  (uint16_t)((p_ccb->con_state == SDP_STATE_CONNECTED)
+                                 ? SDP_SUCCESS
+                                 : SDP_CONN_FAILED));
 
   sdpu_release_ccb(p_ccb);
 }
@@ -587,10 +584,7 @@ void sdp_disconnect(tCONN_CB* p_ccb, uint16_t reason) {
   /* Call user callback immediately */
   if (p_ccb->con_state == SDP_STATE_CONN_SETUP) {
     /* Tell the user if he has a callback */
-    if (p_ccb->p_cb)
-      (*p_ccb->p_cb)(reason);
-    else if (p_ccb->p_cb2)
-      (*p_ccb->p_cb2)(reason, p_ccb->user_data);
+    sdp_notify_user(p_ccb, reason);
 
     sdpu_release_ccb(p_ccb);
   }
@@ -620,15 +614,31 @@ static void sdp_disconnect_cfm(uint16_t l2cap_cid,
   SDP_TRACE_EVENT("SDP - Rcvd L2CAP disc cfm, CID: 0x%x", l2cap_cid);
 
   /* Tell the user if he has a callback */
-  if (p_ccb->p_cb)
-    (*p_ccb->p_cb)(p_ccb->disconnect_reason);
-  else if (p_ccb->p_cb2)
-    (*p_ccb->p_cb2)(p_ccb->disconnect_reason, p_ccb->user_data);
+  sdp_notify_user(p_ccb, p_ccb->disconnect_reason);
 
   sdpu_release_ccb(p_ccb);
 }
 
 
+/*******************************************************************************
+ *
+ * Function         sdp_notify_user
+ *
+ * Description      This function reports the result of a discovery to the
+ *                  user callback, and to the requests waiting for it.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void sdp_notify_user(tCONN_CB* p_ccb, uint16_t result) {
+  if (p_ccb->p_cb)
+    (*p_ccb->p_cb)(result);
+  else if (p_ccb->p_cb2)
+    (*p_ccb->p_cb2)(result, p_ccb->user_data);
+
+  sdp_disc_cache_complete(p_ccb, result);
+}
+
 /*******************************************************************************
  *
  * Function         sdp_conn_timer_timeout
@@ -647,9 +657,6 @@ void sdp_conn_timer_timeout(void* data) {
 
   L2CA_DisconnectReq(p_ccb->connection_id);
   /* Tell the user if he has a callback */
-  if (p_ccb->p_cb)
-    (*p_ccb->p_cb)(SDP_CONN_FAILED);
-  else if (p_ccb->p_cb2)
-    (*p_ccb->p_cb2)(SDP_CONN_FAILED, p_ccb->user_data);
+  sdp_notify_user(p_ccb, SDP_CONN_FAILED);
   sdpu_release_ccb(p_ccb);
 }
@@ -26,10 +26,14 @@
 #include <log/log.h>
 #include <string.h>
 
+#include <string>
+#include <vector>
+
 #include "bt_common.h"
 #include "bt_types.h"
 
 #include "avrc_defs.h"
+#include "common/lru.h"
 #include "device/include/interop.h"
 #include "osi/include/osi.h"
 #include "sdp_api.h"
@@ -42,6 +46,19 @@
 #define SDP_MAX_SERVATTR_RSPHDR_LEN 10
 #define SDP_MAX_ATTR_RSPHDR_LEN 10
 
+/* Number of service search attribute responses kept encoded */
+#ifndef SDP_RSP_CACHE_SIZE
+#define SDP_RSP_CACHE_SIZE 8
+#endif
+
+/* Encoded attribute lists of recent service search attribute requests. Peers
+** run the same queries on every connection, so a repeated request is answered
+** without walking the database again. Emptied when the database changes.
+*/
+static bluetooth::common::LruCache<std::string, std::vector<uint8_t>>
+    sdp_rsp_cache(SDP_RSP_CACHE_SIZE, "sdp_rsp_cache");
+static uint32_t sdp_rsp_cache_generation;
+
 /******************************************************************************/
 /*            L O C A L    F U N C T I O N     P R O T O T Y P E S            */
 /******************************************************************************/
@@ -530,6 +547,125 @@ static void process_service_attr_req(tCONN_CB* p_ccb, uint16_t trans_num,
   L2CA_DataWrite(p_ccb->connection_id, p_buf);
 }
 
+/*******************************************************************************
+ *
+ * Function         build_search_attr_list
+ *
+ * Description      This function encodes the attribute list of a service
+ *                  search attribute response: a data element sequence with
+ *                  the requested attributes of each record that matches the
+ *                  UUIDs.
+ *
+ * Returns          true if the list fits in a response, else false
+ *
+ ******************************************************************************/
+static bool build_search_attr_list(tSDP_UUID_SEQ* p_uid_seq,
+                                   tSDP_ATTR_SEQ* p_attr_seq,
+                                   bool avrcp_1_4_only,
+                                   std::vector<uint8_t>* p_list) {
+  std::vector<uint8_t> body;
+  tSDP_RECORD* p_rec;
+  tSDP_ATTRIBUTE* p_attr;
+  uint16_t xx, yy;
+
+  for (p_rec = sdp_db_service_search(NULL, p_uid_seq); p_rec;
+       p_rec = sdp_db_service_search(p_rec, p_uid_seq)) {
+    /* Leave space for the record sequence type and length */
+    size_t seq_start = body.size();
+    body.resize(seq_start + 3);
+
+    /* The attributes of a record are sorted, so each range is in order */
+    for (xx = 0; xx < p_attr_seq->num_attr; xx++) {
+      for (yy = 0, p_attr = &p_rec->attribute[0]; yy < p_rec->num_attributes;
+           yy++, p_attr++) {
+        if (p_attr->id < p_attr_seq->attr_entry[xx].start ||
+            p_attr->id > p_attr_seq->attr_entry[xx].end)
+          continue;
+
+        size_t attr_start = body.size();
+        body.resize(attr_start + sdpu_get_attrib_entry_len(p_attr));
+        sdpu_build_attrib_entry(&body[attr_start], p_attr);
+
+        // Check if the attribute contain AVRCP profile description list
+        uint16_t avrcp_version = sdpu_is_avrcp_profile_description_list(p_attr);
+        if (avrcp_version > AVRC_REV_1_4 && avrcp_1_4_only) {
+          SDP_TRACE_DEBUG("%s, reply AVRCP 1.4 instead.", __func__);
+          /* The version is the last byte of the attribute value */
+          body.back() = 0x04;
+        }
+      }
+    }
+
+    /* Go back and put the type and length into the buffer, or drop the */
+    /* record if none of its attributes were requested                  */
+    size_t seq_len = body.size() - seq_start - 3;
+    if (seq_len == 0) {
+      body.resize(seq_start);
+    } else if (seq_len > 0xFFFF) {
+      return false;
+    } else {
+      uint8_t* p_seq_start = &body[seq_start];
+      UINT8_TO_BE_STREAM(p_seq_start,
+                         (DATA_ELE_SEQ_DESC_TYPE << 3) | SIZE_IN_NEXT_WORD);
+      UINT16_TO_BE_STREAM(p_seq_start, seq_len);
+    }
+  }
+
+  /* Put in the sequence header (2 or 3 bytes) */
+  if (body.size() + 3 > 0xFFFF) return false;
+  p_list->clear();
+  if (body.size() + 3 > 255) {
+    p_list->push_back((DATA_ELE_SEQ_DESC_TYPE << 3) | SIZE_IN_NEXT_WORD);
+    p_list->push_back((uint8_t)(body.size() >> 8));
+    p_list->push_back((uint8_t)body.size());
+  } else {
+    p_list->push_back((DATA_ELE_SEQ_DESC_TYPE << 3) | SIZE_IN_NEXT_BYTE);
+    p_list->push_back((uint8_t)body.size());
+  }
+  p_list->insert(p_list->end(), body.begin(), body.end());
+  return true;
+}
+
+/*******************************************************************************
+ *
+ * Function         get_search_attr_list
+ *
+ * Description      This function returns the encoded attribute list of a
+ *                  service search attribute request, from the response cache
+ *                  if the same request was answered since the database last
+ *                  changed.
+ *
+ * Returns          Pointer to the list, or NULL if it does not fit in a
+ *                  response. Only valid until the next call.
+ *
+ ******************************************************************************/
+static const std::vector<uint8_t>* get_search_attr_list(
+    tSDP_UUID_SEQ* p_uid_seq, tSDP_ATTR_SEQ* p_attr_seq, bool avrcp_1_4_only) {
+  if (sdp_rsp_cache_generation != sdp_db_get_generation()) {
+    sdp_rsp_cache.Clear();
+    sdp_rsp_cache_generation = sdp_db_get_generation();
+  }
+
+  /* The request as found on the air, plus what depends on the peer */
+  std::string key(1, avrcp_1_4_only ? 1 : 0);
+  for (uint16_t xx = 0; xx < p_uid_seq->num_uids; xx++) {
+    key.push_back((char)p_uid_seq->uuid_entry[xx].len);
+    key.append((const char*)p_uid_seq->uuid_entry[xx].value,
+               p_uid_seq->uuid_entry[xx].len);
+  }
+  key.append((const char*)p_attr_seq->attr_entry,
+             p_attr_seq->num_attr * sizeof(tATT_ENT));
+
+  std::vector<uint8_t>* p_list = sdp_rsp_cache.Find(key);
+  if (p_list != NULL) return p_list;
+
+  std::vector<uint8_t> list;
+  if (!build_search_attr_list(p_uid_seq, p_attr_seq, avrcp_1_4_only, &list))
+    return NULL;
+  sdp_rsp_cache.Put(key, std::move(list));
+  return sdp_rsp_cache.Find(key);
+}
+
 /*******************************************************************************
  *
  * Function         process_service_search_attr_req
@@ -539,6 +675,11 @@ static void process_service_attr_req(tCONN_CB* p_ccb, uint16_t trans_num,
  *                  message with info from the database, and sends the reply
  *                  back to the client.
  *
+ *                  The whole attribute list is encoded on the first request
+ *                  and kept in the connection control block. Continuation
+ *                  requests are served by slicing it, so they see the same
+ *                  records even if the database changes in between.
+ *
  * Returns          void
  *
  ******************************************************************************/
@@ -546,18 +687,11 @@ static void process_service_search_attr_req(tCONN_CB* p_ccb, uint16_t trans_num,
                                             uint16_t param_len, uint8_t* p_req,
                                             uint8_t* p_req_end) {
   uint16_t max_list_len;
-  int16_t rem_len;
   uint16_t len_to_send, cont_offset;
   tSDP_UUID_SEQ uid_seq;
   uint8_t *p_rsp, *p_rsp_start, *p_rsp_param_len;
-  uint16_t rsp_param_len, xx;
-  tSDP_RECORD* p_rec;
-  tSDP_ATTR_SEQ attr_seq, attr_seq_sav;
-  tSDP_ATTRIBUTE* p_attr;
-  tSDP_ATTRIBUTE attr_sav;
-  bool maxxed_out = false, is_cont = false;
-  uint8_t* p_seq_start;
-  uint16_t seq_len, attr_len;
+  uint16_t rsp_param_len;
+  tSDP_ATTR_SEQ attr_seq;
 
   /* Extract the UUID sequence to search for */
   p_req = sdpu_extract_uid_seq(p_req, param_len, &uid_seq);
@@ -585,18 +719,12 @@ static void process_service_search_attr_req(tCONN_CB* p_ccb, uint16_t trans_num,
     return;
   }
 
-  memcpy(&attr_seq_sav, &attr_seq, sizeof(tSDP_ATTR_SEQ));
-
   if (max_list_len < 4) {
     sdpu_build_n_send_error(p_ccb, trans_num, SDP_ILLEGAL_PARAMETER, NULL);
     android_errorWriteLog(0x534e4554, "68817966");
     return;
   }
 
-  /* Free and reallocate buffer */
-  osi_free(p_ccb->rsp_list);
-  p_ccb->rsp_list = (uint8_t*)osi_malloc(max_list_len);
-
   /* Check if this is a continuation request */
   if (*p_req) {
     if (*p_req++ != SDP_CONTINUATION_LEN ||
@@ -607,202 +735,34 @@ static void process_service_search_attr_req(tCONN_CB* p_ccb, uint16_t trans_num,
     }
     BE_STREAM_TO_UINT16(cont_offset, p_req);
 
-    if (cont_offset != p_ccb->cont_offset) {
+    if (cont_offset != p_ccb->cont_offset || p_ccb->rsp_list == NULL ||
+        cont_offset >= p_ccb->list_len) {
       sdpu_build_n_send_error(p_ccb, trans_num, SDP_INVALID_CONT_STATE,
                               SDP_TEXT_BAD_CONT_INX);
       return;
     }
-    is_cont = true;
-
-    /* Initialise for continuation response */
-    p_rsp = &p_ccb->rsp_list[0];
-    attr_seq.attr_entry[p_ccb->cont_info.next_attr_index].start =
-        p_ccb->cont_info.next_attr_start_id;
   } else {
-    p_ccb->cont_offset = 0;
-    p_rsp = &p_ccb->rsp_list[3]; /* Leave space for data elem descr */
-
-    /* Reset continuation parameters in p_ccb */
-    p_ccb->cont_info.prev_sdp_rec = NULL;
-    p_ccb->cont_info.next_attr_index = 0;
-    p_ccb->cont_info.last_attr_seq_desc_sent = false;
-    p_ccb->cont_info.attr_offset = 0;
-  }
-
-  /* Get a list of handles that match the UUIDs given to us */
-  for (p_rec = sdp_db_service_search(p_ccb->cont_info.prev_sdp_rec, &uid_seq);
-       p_rec; p_rec = sdp_db_service_search(p_rec, &uid_seq)) {
-    /* Allow space for attribute sequence type and length */
-    p_seq_start = p_rsp;
-    if (!p_ccb->cont_info.last_attr_seq_desc_sent) {
-      /* See if there is enough room to include a new service in the current
-       * response */
-      rem_len = max_list_len - (int16_t)(p_rsp - &p_ccb->rsp_list[0]);
-      if (rem_len < 3) {
-        /* Not enough room. Update continuation info for next response */
-        p_ccb->cont_info.next_attr_index = 0;
-        p_ccb->cont_info.next_attr_start_id = attr_seq.attr_entry[0].start;
-        break;
-      }
-      p_rsp += 3;
-    }
-
-    /* Get a list of handles that match the UUIDs given to us */
-    for (xx = p_ccb->cont_info.next_attr_index; xx < attr_seq.num_attr; xx++) {
-      p_attr = sdp_db_find_attr_in_rec(p_rec, attr_seq.attr_entry[xx].start,
-                                       attr_seq.attr_entry[xx].end);
-
-      if (p_attr) {
-        // Check if the attribute contain AVRCP profile description list
-        uint16_t avrcp_version = sdpu_is_avrcp_profile_description_list(p_attr);
-        if (avrcp_version > AVRC_REV_1_4 &&
-            interop_match_addr(INTEROP_AVRCP_1_4_ONLY,
-                               &(p_ccb->device_address))) {
-          SDP_TRACE_DEBUG(
-              "%s, device=%s is only accept AVRCP 1.4, reply AVRCP 1.4 "
-              "instead.",
-              __func__, p_ccb->device_address.ToString().c_str());
-          memcpy(&attr_sav, p_attr, sizeof(tSDP_ATTRIBUTE));
-          attr_sav.value_ptr[attr_sav.len - 1] = 0x04;
-          p_attr = &attr_sav;
-        }
-        /* Check if attribute fits. Assume 3-byte value type/length */
-        rem_len = max_list_len - (int16_t)(p_rsp - &p_ccb->rsp_list[0]);
-
-        /* just in case */
-        if (rem_len <= 0) {
-          p_ccb->cont_info.next_attr_index = xx;
-          p_ccb->cont_info.next_attr_start_id = p_attr->id;
-          maxxed_out = true;
-          break;
-        }
-
-        attr_len = sdpu_get_attrib_entry_len(p_attr);
-        /* if there is a partial attribute pending to be sent */
-        if (p_ccb->cont_info.attr_offset) {
-          if (attr_len < p_ccb->cont_info.attr_offset) {
-            android_errorWriteLog(0x534e4554, "79217770");
-            LOG(ERROR) << "offset is bigger than attribute length";
-            sdpu_build_n_send_error(p_ccb, trans_num, SDP_INVALID_CONT_STATE,
-                                    SDP_TEXT_BAD_CONT_LEN);
-            return;
-          }
-          p_rsp = sdpu_build_partial_attrib_entry(
-              p_rsp, p_attr, rem_len, &p_ccb->cont_info.attr_offset);
-
-          /* If the partial attrib could not been fully added yet */
-          if (p_ccb->cont_info.attr_offset != attr_len) {
-            maxxed_out = true;
-            break;
-          } else /* If the partial attrib has been added in full by now */
-            p_ccb->cont_info.attr_offset = 0; /* reset attr_offset */
-        } else if (rem_len <
-                   attr_len) /* Not enough space for attr... so add partially */
-        {
-          if (attr_len >= SDP_MAX_ATTR_LEN) {
-            SDP_TRACE_ERROR("SDP attr too big: max_list_len=%d,attr_len=%d",
-                            max_list_len, attr_len);
-            sdpu_build_n_send_error(p_ccb, trans_num, SDP_NO_RESOURCES, NULL);
-            return;
-          }
-
-          /* add the partial attribute if possible */
-          p_rsp = sdpu_build_partial_attrib_entry(
-              p_rsp, p_attr, (uint16_t)rem_len, &p_ccb->cont_info.attr_offset);
-
-          p_ccb->cont_info.next_attr_index = xx;
-          p_ccb->cont_info.next_attr_start_id = p_attr->id;
-          maxxed_out = true;
-          break;
-        } else /* build the whole attribute */
-          p_rsp = sdpu_build_attrib_entry(p_rsp, p_attr);
-
-        /* If doing a range, stick with this one till no more attributes found
-         */
-        if (attr_seq.attr_entry[xx].start != attr_seq.attr_entry[xx].end) {
-          /* Update for next time through */
-          attr_seq.attr_entry[xx].start = p_attr->id + 1;
-
-          xx--;
-        }
-      }
-    }
-
-    /* Go back and put the type and length into the buffer */
-    if (!p_ccb->cont_info.last_attr_seq_desc_sent) {
-      seq_len = sdpu_get_attrib_seq_len(p_rec, &attr_seq_sav);
-      if (seq_len != 0) {
-        UINT8_TO_BE_STREAM(p_seq_start,
-                           (DATA_ELE_SEQ_DESC_TYPE << 3) | SIZE_IN_NEXT_WORD);
-        UINT16_TO_BE_STREAM(p_seq_start, seq_len);
-
-        if (maxxed_out) p_ccb->cont_info.last_attr_seq_desc_sent = true;
-      } else
-        p_rsp = p_seq_start;
+    bool avrcp_1_4_only =
+        interop_match_addr(INTEROP_AVRCP_1_4_ONLY, &(p_ccb->device_address));
+    const std::vector<uint8_t>* p_list =
+        get_search_attr_list(&uid_seq, &attr_seq, avrcp_1_4_only);
+    if (p_list == NULL) {
+      SDP_TRACE_ERROR("%s: attribute list too long", __func__);
+      sdpu_build_n_send_error(p_ccb, trans_num, SDP_NO_RESOURCES, NULL);
+      return;
     }
 
-    if (maxxed_out) break;
-
-    /* Restore the attr_seq to look for in the next sdp record */
-    memcpy(&attr_seq, &attr_seq_sav, sizeof(tSDP_ATTR_SEQ));
-
-    /* Reset the next attr index */
-    p_ccb->cont_info.next_attr_index = 0;
-    p_ccb->cont_info.prev_sdp_rec = p_rec;
-    p_ccb->cont_info.last_attr_seq_desc_sent = false;
+    /* Free and reallocate buffer */
+    osi_free(p_ccb->rsp_list);
+    p_ccb->rsp_list = (uint8_t*)osi_malloc(p_list->size());
+    memcpy(p_ccb->rsp_list, p_list->data(), p_list->size());
+    p_ccb->list_len = (uint16_t)p_list->size();
+    p_ccb->cont_offset = 0;
   }
 
   /* response length */
-  len_to_send = (uint16_t)(p_rsp - &p_ccb->rsp_list[0]);
-  cont_offset = 0;
-
-  // The current SDP server design has a critical flaw where it can run into
-  // an infinite request/response loop with the client. Here's the scenario:
-  // - client makes SDP request
-  // - server returns the first fragment of the response with a continuation
-  //   token
-  // - an SDP record is deleted from the server
-  // - client issues another request with previous continuation token
-  // - server has nothing to send back because the record is unavailable but
-  //   in the first fragment, it had specified more response bytes than are
-  //   now available
-  // - server sends back no additional response bytes and returns the same
-  //   continuation token
-  // - client issues another request with the continuation token, and the
-  //   process repeats
-  //
-  // We work around this design flaw here by checking if we will make forward
-  // progress (i.e. we will send > 0 response bytes) on a continued request.
-  // If not, we must have run into the above situation and we tell the peer an
-  // error occurred.
-  //
-  // TODO(sharvil): rewrite SDP server.
-  if (is_cont && len_to_send == 0) {
-    sdpu_build_n_send_error(p_ccb, trans_num, SDP_INVALID_CONT_STATE, NULL);
-    return;
-  }
-
-  /* If first response, insert sequence header */
-  if (!is_cont) {
-    /* Get the total list length for requested uid and attribute sequence */
-    p_ccb->list_len = sdpu_get_list_len(&uid_seq, &attr_seq_sav) + 3;
-    /* Put in the sequence header (2 or 3 bytes) */
-    if (p_ccb->list_len > 255) {
-      p_ccb->rsp_list[0] =
-          (uint8_t)((DATA_ELE_SEQ_DESC_TYPE << 3) | SIZE_IN_NEXT_WORD);
-      p_ccb->rsp_list[1] = (uint8_t)((p_ccb->list_len - 3) >> 8);
-      p_ccb->rsp_list[2] = (uint8_t)(p_ccb->list_len - 3);
-    } else {
-      cont_offset = 1;
-
-      p_ccb->rsp_list[1] =
-          (uint8_t)((DATA_ELE_SEQ_DESC_TYPE << 3) | SIZE_IN_NEXT_BYTE);
-      p_ccb->rsp_list[2] = (uint8_t)(p_ccb->list_len - 3);
-
-      p_ccb->list_len--;
-      len_to_send--;
-    }
-  }
+  len_to_send = p_ccb->list_len - p_ccb->cont_offset;
+  if (len_to_send > max_list_len) len_to_send = max_list_len;
 
   /* Get a buffer to use to build the response */
   BT_HDR* p_buf = (BT_HDR*)osi_malloc(SDP_DATA_BUF_SIZE);
@@ -821,15 +781,13 @@ static void process_service_search_attr_req(tCONN_CB* p_ccb, uint16_t trans_num,
   UINT16_TO_BE_STREAM(p_rsp, len_to_send);
 
   /* copy from rsp_list to the actual buffer to be sent */
-  memcpy(p_rsp, &p_ccb->rsp_list[cont_offset], len_to_send);
+  memcpy(p_rsp, &p_ccb->rsp_list[p_ccb->cont_offset], len_to_send);
   p_rsp += len_to_send;
 
   p_ccb->cont_offset += len_to_send;
 
   /* If anything left to send, continuation needed */
   if (p_ccb->cont_offset < p_ccb->list_len) {
-    is_cont = true;
-
     UINT8_TO_BE_STREAM(p_rsp, SDP_CONTINUATION_LEN);
     UINT16_TO_BE_STREAM(p_rsp, p_ccb->cont_offset);
   } else
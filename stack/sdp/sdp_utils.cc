@@ -380,6 +380,9 @@ void sdpu_release_ccb(tCONN_CB* p_ccb) {
   /* Ensure timer is stopped */
   alarm_cancel(p_ccb->sdp_conn_timer);
 
+  /* Requests still waiting for this one will get no result from it */
+  sdp_disc_cache_complete(p_ccb, SDP_CONN_FAILED);
+
   /* Drop any response pointer we may be holding */
   p_ccb->con_state = SDP_STATE_IDLE;
   p_ccb->is_attr_search = false;
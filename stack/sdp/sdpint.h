@@ -38,6 +38,16 @@
 /* Timeout definitions. */
 #define SDP_INACT_TIMEOUT_MS (30 * 1000) /* Inactivity timeout (in ms) */
 
+/* How long the discovery results of a peer are answered from the cache */
+#ifndef SDP_DISC_CACHE_TIMEOUT_S
+#define SDP_DISC_CACHE_TIMEOUT_S (24 * 60 * 60)
+#endif
+
+/* Number of discovery results kept per peer */
+#ifndef SDP_DISC_CACHE_MAX_RESULTS
+#define SDP_DISC_CACHE_MAX_RESULTS 8
+#endif
+
 /* Define the Protocol Data Unit (PDU) types.
  */
 #define SDP_PDU_ERROR_RESPONSE 0x01
@@ -245,6 +255,8 @@ extern tSDP_RECORD* sdp_db_find_record(uint32_t handle);
 extern tSDP_ATTRIBUTE* sdp_db_find_attr_in_rec(tSDP_RECORD* p_rec,
                                                uint16_t start_attr,
                                                uint16_t end_attr);
+extern void sdp_db_reset_index(void);
+extern uint32_t sdp_db_get_generation(void);
 
 /* Functions provided by sdp_server.cc
  */
@@ -258,5 +270,19 @@ extern void sdp_server_handle_client_req(tCONN_CB* p_ccb, BT_HDR* p_msg);
  */
 extern void sdp_disc_connected(tCONN_CB* p_ccb);
 extern void sdp_disc_server_rsp(tCONN_CB* p_ccb, BT_HDR* p_msg);
+extern bool sdp_disc_add_attr_list(tSDP_DISCOVERY_DB* p_db,
+                                   const RawAddress& bd_addr, uint8_t* p_list,
+                                   uint16_t list_len);
+
+/* Functions provided by sdp_disc_cache.cc
+ */
+extern bool sdp_disc_cache_serve(const RawAddress& bd_addr,
+                                 tSDP_DISCOVERY_DB* p_db,
+                                 tSDP_DISC_CMPL_CB* p_cb,
+                                 tSDP_DISC_CMPL_CB2* p_cb2, void* user_data);
+extern void sdp_disc_cache_store(tCONN_CB* p_ccb);
+extern void sdp_disc_cache_complete(tCONN_CB* p_ccb, uint16_t result);
+extern bool sdp_disc_cache_cancel(tSDP_DISCOVERY_DB* p_db);
+extern void sdp_disc_cache_init(void);
 
 #endif
@@ -0,0 +1,564 @@
+/******************************************************************************
+ *
+ *  Copyright 2020 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This file contains the constant time P-256 point multiplications used for
+ *  LE Secure Connections key generation and DHKey computation.
+ *
+ *  Field elements are kept in the Montgomery domain (R = 2^256), in four 64
+ *  bit limbs when the compiler has 128 bit integers and in eight 32 bit limbs
+ *  otherwise. P-256 is -1 modulo 2^64, so each reduction step needs no extra
+ *  multiplication. Points are in Jacobian coordinates with a = -3.
+ *
+ *  Nothing depends on the value of the scalar: there are no scalar dependent
+ *  branches or memory addresses. Table entries are read by scanning the whole
+ *  table, and the exceptional cases of the addition formulas (infinity,
+ *  doubling) are resolved with masks rather than branches.
+ *
+ ******************************************************************************/
+
+#include <string.h>
+#include "p_256_ecc_pp.h"
+
+namespace {
+
+/* P256_CONST builds the limbs of a constant from its 32 bit words, low word
+ * first */
+#if defined(__SIZEOF_INT128__)
+typedef uint64_t limb_t;
+typedef unsigned __int128 dlimb_t;
+#define P256_LIMB(lo, hi) (((uint64_t)(hi) << 32) | (lo))
+#define P256_CONST(w0, w1, w2, w3, w4, w5, w6, w7)                  \
+  {                                                                 \
+    P256_LIMB(w0, w1), P256_LIMB(w2, w3), P256_LIMB(w4, w5),        \
+        P256_LIMB(w6, w7)                                           \
+  }
+#else
+typedef uint32_t limb_t;
+typedef uint64_t dlimb_t;
+#define P256_CONST(w0, w1, w2, w3, w4, w5, w6, w7) \
+  { w0, w1, w2, w3, w4, w5, w6, w7 }
+#endif
+
+constexpr int LIMB_BITS = sizeof(limb_t) * 8;
+constexpr int P256_LIMBS = 256 / LIMB_BITS;
+
+typedef limb_t fe_t[P256_LIMBS];
+
+typedef struct {
+  fe_t x;
+  fe_t y;
+  fe_t z;
+} jacobian_point_t;
+
+typedef struct {
+  fe_t x;
+  fe_t y;
+} affine_point_t;
+
+/* Width in bits of the variable base window */
+constexpr int P256_WINDOW_BITS = 4;
+constexpr int P256_WINDOW_SIZE = 1 << P256_WINDOW_BITS;
+
+/* Number of teeth of the fixed base comb, and the distance between them */
+constexpr int P256_COMB_TEETH = 6;
+constexpr int P256_COMB_SIZE = 1 << P256_COMB_TEETH;
+constexpr int P256_COMB_SPACING = (256 + P256_COMB_TEETH - 1) / P256_COMB_TEETH;
+
+/* All words little endian */
+const fe_t p256_p =
+    P256_CONST(0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0x00000000,
+               0x00000000, 0x00000000, 0x00000001, 0xFFFFFFFF);
+
+/* R^2 mod p, to enter the Montgomery domain */
+const fe_t p256_rr =
+    P256_CONST(0x00000003, 0x00000000, 0xFFFFFFFF, 0xFFFFFFFB,
+               0xFFFFFFFE, 0xFFFFFFFF, 0xFFFFFFFD, 0x00000004);
+
+/* R mod p, one in the Montgomery domain */
+const fe_t p256_one =
+    P256_CONST(0x00000001, 0x00000000, 0x00000000, 0xFFFFFFFF,
+               0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFE, 0x00000000);
+
+const fe_t p256_b =
+    P256_CONST(0x27D2604B, 0x3BCE3C3E, 0xCC53B0F6, 0x651D06B0,
+               0x769886BC, 0xB3EBBD55, 0xAA3A93E7, 0x5AC635D8);
+
+const fe_t p256_gx =
+    P256_CONST(0xD898C296, 0xF4A13945, 0x2DEB33A0, 0x77037D81,
+               0x63A440F2, 0xF8BCE6E5, 0xE12C4247, 0x6B17D1F2);
+
+const fe_t p256_gy =
+    P256_CONST(0x37BF51F5, 0xCBB64068, 0x6B315ECE, 0x2BCE3357,
+               0x7C0F9E16, 0x8EE7EB4A, 0xFE1A7F9B, 0x4FE342E2);
+
+/* Returns all ones if |a| is zero, zero otherwise */
+limb_t ct_is_zero(limb_t a) { return ((a | (0 - a)) >> (LIMB_BITS - 1)) - 1; }
+
+/* Returns all ones if |a| equals |b|, zero otherwise */
+limb_t ct_eq(limb_t a, limb_t b) { return ct_is_zero(a ^ b); }
+
+void fe_copy(fe_t r, const fe_t a) { memcpy(r, a, sizeof(fe_t)); }
+
+/* Loads the little endian 32 bit words of a value into limbs, and back */
+void fe_from_words(fe_t r, const uint32_t* w) {
+  memset(r, 0, sizeof(fe_t));
+  for (int i = 0; i < KEY_LENGTH_DWORDS_P256; i++)
+    r[i * 32 / LIMB_BITS] |= (limb_t)w[i] << (i * 32 % LIMB_BITS);
+}
+
+void fe_to_words(uint32_t* w, const fe_t a) {
+  for (int i = 0; i < KEY_LENGTH_DWORDS_P256; i++)
+    w[i] = (uint32_t)(a[i * 32 / LIMB_BITS] >> (i * 32 % LIMB_BITS));
+}
+
+/* r = mask ? a : r */
+void fe_cmov(fe_t r, const fe_t a, limb_t mask) {
+  for (int i = 0; i < P256_LIMBS; i++) r[i] = (r[i] & ~mask) | (a[i] & mask);
+}
+
+/* Returns all ones if |a| is zero, zero otherwise. Field elements are fully
+ * reduced, so zero has a single representation. */
+limb_t fe_is_zero(const fe_t a) {
+  limb_t acc = 0;
+  for (int i = 0; i < P256_LIMBS; i++) acc |= a[i];
+  return ct_is_zero(acc);
+}
+
+/* d = a - p; returns the borrow, one if |a| is below p */
+limb_t fe_sub_p(fe_t d, const fe_t a) {
+  limb_t borrow = 0;
+  for (int i = 0; i < P256_LIMBS; i++) {
+    dlimb_t t = (dlimb_t)a[i] - p256_p[i] - borrow;
+    d[i] = (limb_t)t;
+    borrow = (limb_t)(t >> LIMB_BITS) & 1;
+  }
+  return borrow;
+}
+
+/* r = (hi * 2^256 + a) mod p, for a value below 2p */
+void fe_reduce_once(fe_t r, const fe_t a, limb_t hi) {
+  fe_t d;
+  limb_t borrow = fe_sub_p(d, a);
+  /* a - p is the result unless it went negative */
+  limb_t use_d = 0 - ((hi | (borrow ^ 1)) & 1);
+  for (int i = 0; i < P256_LIMBS; i++)
+    r[i] = (a[i] & ~use_d) | (d[i] & use_d);
+}
+
+void fe_add(fe_t r, const fe_t a, const fe_t b) {
+  fe_t t;
+  dlimb_t carry = 0;
+  for (int i = 0; i < P256_LIMBS; i++) {
+    carry += (dlimb_t)a[i] + b[i];
+    t[i] = (limb_t)carry;
+    carry >>= LIMB_BITS;
+  }
+  fe_reduce_once(r, t, (limb_t)carry);
+}
+
+void fe_sub(fe_t r, const fe_t a, const fe_t b) {
+  fe_t t;
+  limb_t borrow = 0;
+  for (int i = 0; i < P256_LIMBS; i++) {
+    dlimb_t d = (dlimb_t)a[i] - b[i] - borrow;
+    t[i] = (limb_t)d;
+    borrow = (limb_t)(d >> LIMB_BITS) & 1;
+  }
+  /* add p back if a < b */
+  limb_t mask = 0 - borrow;
+  dlimb_t carry = 0;
+  for (int i = 0; i < P256_LIMBS; i++) {
+    carry += (dlimb_t)t[i] + (p256_p[i] & mask);
+    r[i] = (limb_t)carry;
+    carry >>= LIMB_BITS;
+  }
+}
+
+/* r = a * b / R mod p */
+void fe_mul(fe_t r, const fe_t a, const fe_t b) {
+  limb_t t[P256_LIMBS + 2] = {0};
+  for (int i = 0; i < P256_LIMBS; i++) {
+    dlimb_t c = 0;
+    for (int j = 0; j < P256_LIMBS; j++) {
+      c += (dlimb_t)a[j] * b[i] + t[j];
+      t[j] = (limb_t)c;
+      c >>= LIMB_BITS;
+    }
+    c += t[P256_LIMBS];
+    t[P256_LIMBS] = (limb_t)c;
+    t[P256_LIMBS + 1] = (limb_t)(c >> LIMB_BITS);
+
+    /* -p^-1 mod 2^LIMB_BITS is 1, so m is the low limb */
+    limb_t m = t[0];
+    c = ((dlimb_t)m * p256_p[0] + t[0]) >> LIMB_BITS;
+    for (int j = 1; j < P256_LIMBS; j++) {
+      c += (dlimb_t)m * p256_p[j] + t[j];
+      t[j - 1] = (limb_t)c;
+      c >>= LIMB_BITS;
+    }
+    c += t[P256_LIMBS];
+    t[P256_LIMBS - 1] = (limb_t)c;
+    t[P256_LIMBS] = t[P256_LIMBS + 1] + (limb_t)(c >> LIMB_BITS);
+  }
+  fe_reduce_once(r, t, t[P256_LIMBS]);
+}
+
+void fe_sqr(fe_t r, const fe_t a) { fe_mul(r, a, a); }
+
+/* Enters the Montgomery domain from 32 bit words */
+void fe_to_mont(fe_t r, const uint32_t* w) {
+  fe_t a;
+  fe_from_words(a, w);
+  fe_mul(r, a, p256_rr);
+}
+
+/* Leaves the Montgomery domain into 32 bit words */
+void fe_from_mont(uint32_t* w, const fe_t a) {
+  const fe_t one = {1};
+  fe_t r;
+  fe_mul(r, a, one);
+  fe_to_words(w, r);
+}
+
+/* r = a^(p-2) = 1/a, or zero if a is zero. The exponent is public. */
+void fe_inv(fe_t r, const fe_t a) {
+  fe_t exp;
+  fe_copy(exp, p256_p);
+  exp[0] -= 2;
+
+  fe_t acc;
+  fe_copy(acc, p256_one);
+  for (int i = 255; i >= 0; i--) {
+    fe_sqr(acc, acc);
+    if ((exp[i / LIMB_BITS] >> (i % LIMB_BITS)) & 1) fe_mul(acc, acc, a);
+  }
+  fe_copy(r, acc);
+}
+
+void point_cmov(jacobian_point_t* r, const jacobian_point_t* a,
+                limb_t mask) {
+  fe_cmov(r->x, a->x, mask);
+  fe_cmov(r->y, a->y, mask);
+  fe_cmov(r->z, a->z, mask);
+}
+
+void point_set_infinity(jacobian_point_t* r) {
+  fe_copy(r->x, p256_one);
+  fe_copy(r->y, p256_one);
+  memset(r->z, 0, sizeof(fe_t));
+}
+
+/* r = 2a. Infinity stays infinity: its z stays zero. */
+void point_double(jacobian_point_t* r, const jacobian_point_t* a) {
+  fe_t delta, gamma, beta, alpha, t1, t2;
+
+  fe_sqr(delta, a->z);
+  fe_sqr(gamma, a->y);
+  fe_mul(beta, a->x, gamma);
+
+  /* alpha = 3 * (x - delta) * (x + delta) */
+  fe_sub(t1, a->x, delta);
+  fe_add(t2, a->x, delta);
+  fe_mul(t1, t1, t2);
+  fe_add(alpha, t1, t1);
+  fe_add(alpha, alpha, t1);
+
+  /* z3 = (y + z)^2 - gamma - delta */
+  fe_add(t1, a->y, a->z);
+  fe_sqr(t1, t1);
+  fe_sub(t1, t1, gamma);
+  fe_sub(r->z, t1, delta);
+
+  /* x3 = alpha^2 - 8 * beta */
+  fe_add(beta, beta, beta);
+  fe_add(beta, beta, beta);
+  fe_add(t2, beta, beta);
+  fe_sqr(r->x, alpha);
+  fe_sub(r->x, r->x, t2);
+
+  /* y3 = alpha * (4 * beta - x3) - 8 * gamma^2 */
+  fe_sub(t1, beta, r->x);
+  fe_mul(t1, alpha, t1);
+  fe_sqr(gamma, gamma);
+  fe_add(gamma, gamma, gamma);
+  fe_add(gamma, gamma, gamma);
+  fe_add(gamma, gamma, gamma);
+  fe_sub(r->y, t1, gamma);
+}
+
+/* r = a + b for any a and b, infinity and a == b included */
+void point_add(jacobian_point_t* r, const jacobian_point_t* a,
+               const jacobian_point_t* b) {
+  fe_t z1z1, z2z2, u1, u2, s1, s2, h, i, j, rr, v, t;
+  jacobian_point_t sum, dbl;
+
+  fe_sqr(z1z1, a->z);
+  fe_sqr(z2z2, b->z);
+  fe_mul(u1, a->x, z2z2);
+  fe_mul(u2, b->x, z1z1);
+  fe_mul(s1, a->y, b->z);
+  fe_mul(s1, s1, z2z2);
+  fe_mul(s2, b->y, a->z);
+  fe_mul(s2, s2, z1z1);
+
+  fe_sub(h, u2, u1);
+  fe_sub(rr, s2, s1);
+  limb_t same = fe_is_zero(h) & fe_is_zero(rr);
+  fe_add(rr, rr, rr);
+
+  /* i = (2h)^2, j = h * i, v = u1 * i */
+  fe_add(i, h, h);
+  fe_sqr(i, i);
+  fe_mul(j, h, i);
+  fe_mul(v, u1, i);
+
+  /* x3 = r^2 - j - 2v */
+  fe_sqr(sum.x, rr);
+  fe_sub(sum.x, sum.x, j);
+  fe_sub(sum.x, sum.x, v);
+  fe_sub(sum.x, sum.x, v);
+
+  /* y3 = r * (v - x3) - 2 * s1 * j */
+  fe_sub(t, v, sum.x);
+  fe_mul(t, rr, t);
+  fe_mul(s1, s1, j);
+  fe_add(s1, s1, s1);
+  fe_sub(sum.y, t, s1);
+
+  /* z3 = ((z1 + z2)^2 - z1z1 - z2z2) * h */
+  fe_add(t, a->z, b->z);
+  fe_sqr(t, t);
+  fe_sub(t, t, z1z1);
+  fe_sub(t, t, z2z2);
+  fe_mul(sum.z, t, h);
+
+  point_double(&dbl, a);
+  point_cmov(&sum, &dbl, same);
+  point_cmov(&sum, b, fe_is_zero(a->z));
+  point_cmov(&sum, a, fe_is_zero(b->z));
+  *r = sum;
+}
+
+/* r = a + b for an affine b, which is infinity if |b_is_infinity| is all
+ * ones */
+void point_add_affine(jacobian_point_t* r, const jacobian_point_t* a,
+                      const affine_point_t* b, limb_t b_is_infinity) {
+  fe_t z1z1, u2, s2, h, hh, i, j, rr, v, t;
+  jacobian_point_t sum, dbl, lifted;
+
+  fe_sqr(z1z1, a->z);
+  fe_mul(u2, b->x, z1z1);
+  fe_mul(s2, b->y, a->z);
+  fe_mul(s2, s2, z1z1);
+
+  fe_sub(h, u2, a->x);
+  fe_sub(rr, s2, a->y);
+  limb_t same = fe_is_zero(h) & fe_is_zero(rr);
+  fe_add(rr, rr, rr);
+
+  /* i = 4 * h^2, j = h * i, v = x1 * i */
+  fe_sqr(hh, h);
+  fe_add(i, hh, hh);
+  fe_add(i, i, i);
+  fe_mul(j, h, i);
+  fe_mul(v, a->x, i);
+
+  /* x3 = r^2 - j - 2v */
+  fe_sqr(sum.x, rr);
+  fe_sub(sum.x, sum.x, j);
+  fe_sub(sum.x, sum.x, v);
+  fe_sub(sum.x, sum.x, v);
+
+  /* y3 = r * (v - x3) - 2 * y1 * j */
+  fe_sub(t, v, sum.x);
+  fe_mul(t, rr, t);
+  fe_mul(j, a->y, j);
+  fe_add(j, j, j);
+  fe_sub(sum.y, t, j);
+
+  /* z3 = (z1 + h)^2 - z1z1 - hh */
+  fe_add(t, a->z, h);
+  fe_sqr(t, t);
+  fe_sub(t, t, z1z1);
+  fe_sub(sum.z, t, hh);
+
+  fe_copy(lifted.x, b->x);
+  fe_copy(lifted.y, b->y);
+  fe_copy(lifted.z, p256_one);
+
+  point_double(&dbl, a);
+  point_cmov(&sum, &dbl, same);
+  point_cmov(&sum, &lifted, fe_is_zero(a->z));
+  point_cmov(&sum, a, b_is_infinity);
+  *r = sum;
+}
+
+/* Converts |a| to affine coordinates out of the Montgomery domain */
+void point_to_affine(Point* q, const jacobian_point_t* a) {
+  fe_t zinv, zinv2, t;
+
+  fe_inv(zinv, a->z);
+  fe_sqr(zinv2, zinv);
+  fe_mul(t, a->x, zinv2);
+  fe_from_mont(q->x, t);
+  fe_mul(zinv2, zinv2, zinv);
+  fe_mul(t, a->y, zinv2);
+  fe_from_mont(q->y, t);
+
+  multiprecision_init(q->z);
+  q->z[0] = 1;
+}
+
+/* Returns bit |i| of the 256 bit scalar |n|, zero past the end */
+uint32_t scalar_bit(const uint32_t* n, int i) {
+  if (i >= 256) return 0;
+  return (n[i / 32] >> (i % 32)) & 1;
+}
+
+/* The comb table: entry v is the sum of 2^(k * P256_COMB_SPACING) * G over the
+ * bits k set in v, in affine coordinates. Entry 0, infinity, isn't used. */
+struct CombTable {
+  CombTable() {
+    jacobian_point_t teeth[P256_COMB_TEETH];
+    fe_mul(teeth[0].x, p256_gx, p256_rr);
+    fe_mul(teeth[0].y, p256_gy, p256_rr);
+    fe_copy(teeth[0].z, p256_one);
+    for (int k = 1; k < P256_COMB_TEETH; k++) {
+      teeth[k] = teeth[k - 1];
+      for (int i = 0; i < P256_COMB_SPACING; i++)
+        point_double(&teeth[k], &teeth[k]);
+    }
+
+    memset(&entries[0], 0, sizeof(entries[0]));
+    for (int v = 1; v < P256_COMB_SIZE; v++) {
+      jacobian_point_t sum;
+      point_set_infinity(&sum);
+      for (int k = 0; k < P256_COMB_TEETH; k++) {
+        if (v & (1 << k)) point_add(&sum, &sum, &teeth[k]);
+      }
+
+      fe_t zinv, zinv2;
+      fe_inv(zinv, sum.z);
+      fe_sqr(zinv2, zinv);
+      fe_mul(entries[v].x, sum.x, zinv2);
+      fe_mul(zinv2, zinv2, zinv);
+      fe_mul(entries[v].y, sum.y, zinv2);
+    }
+  }
+
+  affine_point_t entries[P256_COMB_SIZE];
+};
+
+const CombTable& comb_table() {
+  static const CombTable table;
+  return table;
+}
+
+/* Reads entry |index| of |table| without an index dependent address */
+void comb_lookup(affine_point_t* r, const affine_point_t* table,
+                 uint32_t index) {
+  memset(r, 0, sizeof(*r));
+  for (int v = 0; v < P256_COMB_SIZE; v++) {
+    limb_t mask = ct_eq(v, index);
+    fe_cmov(r->x, table[v].x, mask);
+    fe_cmov(r->y, table[v].y, mask);
+  }
+}
+
+void window_lookup(jacobian_point_t* r, const jacobian_point_t* table,
+                   uint32_t index) {
+  memset(r, 0, sizeof(*r));
+  for (int v = 0; v < P256_WINDOW_SIZE; v++)
+    point_cmov(r, &table[v], ct_eq(v, index));
+}
+
+}  // namespace
+
+// q = n * G, with a comb over the precomputed multiples of G
+void ECC_PointMult_Base(Point* q, const uint32_t* n) {
+  const CombTable& table = comb_table();
+  jacobian_point_t acc;
+  affine_point_t entry;
+
+  point_set_infinity(&acc);
+  for (int i = P256_COMB_SPACING - 1; i >= 0; i--) {
+    point_double(&acc, &acc);
+
+    uint32_t index = 0;
+    for (int k = 0; k < P256_COMB_TEETH; k++)
+      index |= scalar_bit(n, i + k * P256_COMB_SPACING) << k;
+
+    comb_lookup(&entry, table.entries, index);
+    point_add_affine(&acc, &acc, &entry, ct_is_zero(index));
+  }
+
+  point_to_affine(q, &acc);
+}
+
+// q = n * p, with a fixed window over multiples of p computed on the fly
+void ECC_PointMult_CT(Point* q, const Point* p, const uint32_t* n) {
+  jacobian_point_t table[P256_WINDOW_SIZE];
+  jacobian_point_t acc, entry;
+
+  point_set_infinity(&table[0]);
+  fe_to_mont(table[1].x, p->x);
+  fe_to_mont(table[1].y, p->y);
+  fe_copy(table[1].z, p256_one);
+  for (int v = 2; v < P256_WINDOW_SIZE; v++)
+    point_add(&table[v], &table[v - 1], &table[1]);
+
+  point_set_infinity(&acc);
+  for (int i = 256 / P256_WINDOW_BITS - 1; i >= 0; i--) {
+    for (int k = 0; k < P256_WINDOW_BITS; k++) point_double(&acc, &acc);
+
+    int bit = i * P256_WINDOW_BITS;
+    uint32_t index = (n[bit / 32] >> (bit % 32)) & (P256_WINDOW_SIZE - 1);
+    window_lookup(&entry, table, index);
+    point_add(&acc, &acc, &entry);
+  }
+
+  point_to_affine(q, &acc);
+}
+
+bool ECC_ValidatePoint(const Point& pt) {
+  // Coordinates must be reduced
+  fe_t x, y, t;
+  fe_from_words(x, pt.x);
+  fe_from_words(y, pt.y);
+  if (!fe_sub_p(t, x) || !fe_sub_p(t, y)) return false;
+
+  // Ensure y^2 = x^3 + a*x + b (mod p); a = -3
+  fe_t b, lhs, rhs;
+  fe_mul(x, x, p256_rr);
+  fe_mul(y, y, p256_rr);
+  fe_mul(b, p256_b, p256_rr);
+
+  fe_sqr(lhs, y);
+
+  fe_sqr(rhs, x);
+  fe_mul(rhs, rhs, x);
+  fe_add(t, x, x);
+  fe_add(t, t, x);
+  fe_sub(rhs, rhs, t);
+  fe_add(rhs, rhs, b);
+
+  fe_sub(t, lhs, rhs);
+  return fe_is_zero(t) != 0;
+}
@@ -239,24 +239,3 @@ void ECC_PointMult_Bin_NAF(Point* q, Point* p, uint32_t* n) {
   multiprecision_mersenns_mult_mod(q->z, q->z, minus_p.x);
   multiprecision_mersenns_mult_mod(q->y, q->y, q->z);
 }
-
-bool ECC_ValidatePoint(const Point& pt) {
-  p_256_init_curve();
-
-  // Ensure y^2 = x^3 + a*x + b (mod p); a = -3
-
-  // y^2 mod p
-  uint32_t y2_mod[KEY_LENGTH_DWORDS_P256] = {0};
-  multiprecision_mersenns_squa_mod(y2_mod, (uint32_t*)pt.y);
-
-  // Right hand side calculation
-  uint32_t rhs[KEY_LENGTH_DWORDS_P256] = {0};
-  multiprecision_mersenns_squa_mod(rhs, (uint32_t*)pt.x);
-  uint32_t three[KEY_LENGTH_DWORDS_P256] = {0};
-  three[0] = 3;
-  multiprecision_sub_mod(rhs, rhs, three);
-  multiprecision_mersenns_mult_mod(rhs, rhs, (uint32_t*)pt.x);
-  multiprecision_add_mod(rhs, rhs, curve_p256.b);
-
-  return multiprecision_compare(rhs, y2_mod) == 0;
-}
@@ -60,6 +60,11 @@ bool ECC_ValidatePoint(const Point& p);
 
 void ECC_PointMult_Bin_NAF(Point* q, Point* p, uint32_t* n);
 
-#define ECC_PointMult(q, p, n) ECC_PointMult_Bin_NAF(q, p, n)
+// Constant time point multiplications, in p_256_ecc_ct.cc. |n| is a 256 bit
+// scalar and |q| gets the affine result. Neither modifies its inputs.
+void ECC_PointMult_Base(Point* q, const uint32_t* n);  // q = n * G
+void ECC_PointMult_CT(Point* q, const Point* p, const uint32_t* n);
+
+#define ECC_PointMult(q, p, n) ECC_PointMult_CT(q, p, n)
 
 void p_256_init_curve();
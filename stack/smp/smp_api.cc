@@ -22,7 +22,9 @@
  *  applications that can run over an SMP.
  *
  ******************************************************************************/
+#include <base/bind.h>
 #include <base/logging.h>
+#include <stdio.h>
 #include <string.h>
 
 #include "bt_target.h"
@@ -63,6 +65,7 @@ void SMP_Init(void) {
   smp_l2cap_if_init();
   /* initialization of P-256 parameters */
   p_256_init_curve();
+  smp_key_pool_init();
 
   /* Initialize failure case for certification */
   smp_cb.cert_failure =
@@ -72,6 +75,32 @@ void SMP_Init(void) {
                     smp_cb.cert_failure);
 }
 
+/*******************************************************************************
+ *
+ * Function         SMP_Free
+ *
+ * Description      This function releases the resources of the SMP unit.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void SMP_Free(void) { smp_key_pool_free(); }
+
+/*******************************************************************************
+ *
+ * Function         SMP_RefillKeyPool
+ *
+ * Description      This function starts filling the pool of precomputed local
+ *                  key pairs, e.g. once the controller is ready. It may be
+ *                  called from any thread.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void SMP_RefillKeyPool(void) {
+  do_in_main_thread(FROM_HERE, base::Bind(&smp_key_pool_refill));
+}
+
 /*******************************************************************************
  *
  * Function         SMP_SetTraceLevel
@@ -602,3 +631,16 @@ bool SMP_CreateLocalSecureConnectionsOobData(tBLE_BD_ADDR* addr_to_send_to) {
 
   return true;
 }
+
+/*******************************************************************************
+ *
+ * Function         stack_debug_smp_api_dump
+ *
+ * Description      Dump the state of the pool of precomputed local key pairs
+ *                  to |fd|.
+ *
+ ******************************************************************************/
+void stack_debug_smp_api_dump(int fd) {
+  dprintf(fd, "\nSMP:\n");
+  smp_key_pool_dump(fd);
+}
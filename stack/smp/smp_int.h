@@ -466,6 +466,14 @@ extern void smp_calculate_f5_mackey_and_long_term_key(tSMP_CB* p_cb);
 extern void smp_remove_fixed_channel(tSMP_CB* p_cb);
 extern bool smp_request_oob_data(tSMP_CB* p_cb);
 
+/* smp_key_pool.cc */
+extern void smp_key_pool_init(void);
+extern void smp_key_pool_free(void);
+extern void smp_key_pool_refill(void);
+extern bool smp_key_pool_take(BT_OCTET32 private_key,
+                              tSMP_PUBLIC_KEY* p_public_key);
+extern void smp_key_pool_dump(int fd);
+
 /* smp_keys.cc */
 extern void smp_generate_srand_mrand_confirm(tSMP_CB* p_cb,
                                              tSMP_INT_DATA* p_data);
@@ -0,0 +1,211 @@
+/******************************************************************************
+ *
+ *  Copyright 2020 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This file contains the pool of precomputed local P-256 key pairs used by
+ *  LE Secure Connections pairing.
+ *
+ *  The private keys come from the controller, like the ones created during
+ *  pairing, and the public keys are computed on a low priority worker thread.
+ *  The pool itself is only accessed from the main thread. Each key pair is
+ *  handed out once and wiped from the pool; the pool is refilled when no
+ *  pairing is in progress.
+ *
+ ******************************************************************************/
+
+#define LOG_TAG "bt_smp_key_pool"
+
+#include <base/bind.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bt_target.h"
+#include "btu.h"
+#include "device/include/controller.h"
+#include "hcimsgs.h"
+#include "osi/include/allocator.h"
+#include "osi/include/log.h"
+#include "osi/include/thread.h"
+#include "p_256_ecc_pp.h"
+#include "smp_int.h"
+
+using base::Bind;
+
+/* Nice value of the worker thread, ANDROID_PRIORITY_BACKGROUND */
+#define SMP_KEY_POOL_THREAD_PRIORITY 10
+
+typedef struct {
+  BT_OCTET32 private_key;
+  tSMP_PUBLIC_KEY public_key;
+} tSMP_KEY_PAIR;
+
+typedef struct {
+  thread_t* thread;
+  tSMP_KEY_PAIR keys[SMP_KEY_POOL_SIZE];
+  uint8_t count;
+  bool refill_pending; /* a key pair is being generated */
+
+  /* Statistics, reported by stack_debug_smp_api_dump */
+  uint32_t generated;
+  uint32_t hits;
+  uint32_t misses;
+} tSMP_KEY_POOL;
+
+static tSMP_KEY_POOL smp_key_pool;
+
+static void smp_key_pool_add(tSMP_KEY_PAIR* p_pair);
+
+/* Runs on the worker thread */
+static void smp_key_pool_compute(void* context) {
+  tSMP_KEY_PAIR* p_pair = (tSMP_KEY_PAIR*)context;
+  Point public_key;
+
+  ECC_PointMult_Base(&public_key, (uint32_t*)p_pair->private_key);
+  memcpy(p_pair->public_key.x, public_key.x, BT_OCTET32_LEN);
+  memcpy(p_pair->public_key.y, public_key.y, BT_OCTET32_LEN);
+
+  if (do_in_main_thread(FROM_HERE, Bind(&smp_key_pool_add, p_pair)) !=
+      BT_STATUS_SUCCESS) {
+    memset(p_pair, 0, sizeof(*p_pair));
+    osi_free(p_pair);
+  }
+}
+
+/* Collects the private key from the controller, 8 octets at a time */
+static void smp_key_pool_rand_cback(tSMP_KEY_PAIR* p_pair, uint8_t offset,
+                                    BT_OCTET8 rand) {
+  memcpy(&p_pair->private_key[offset], rand, BT_OCTET8_LEN);
+  offset += BT_OCTET8_LEN;
+  if (offset < BT_OCTET32_LEN) {
+    btsnd_hcic_ble_rand(Bind(&smp_key_pool_rand_cback, p_pair, offset));
+    return;
+  }
+
+  if (smp_key_pool.thread == NULL ||
+      !thread_post(smp_key_pool.thread, smp_key_pool_compute, p_pair)) {
+    memset(p_pair, 0, sizeof(*p_pair));
+    osi_free(p_pair);
+    smp_key_pool.refill_pending = false;
+  }
+}
+
+static void smp_key_pool_add(tSMP_KEY_PAIR* p_pair) {
+  smp_key_pool.refill_pending = false;
+  if (smp_key_pool.thread != NULL && smp_key_pool.count < SMP_KEY_POOL_SIZE) {
+    smp_key_pool.keys[smp_key_pool.count++] = *p_pair;
+    smp_key_pool.generated++;
+  }
+  memset(p_pair, 0, sizeof(*p_pair));
+  osi_free(p_pair);
+
+  smp_key_pool_refill();
+}
+
+/*******************************************************************************
+ *
+ * Function         smp_key_pool_init
+ *
+ * Description      Starts the worker thread of the key pair pool. The pool is
+ *                  filled later, by smp_key_pool_refill().
+ *
+ ******************************************************************************/
+void smp_key_pool_init(void) {
+  memset(&smp_key_pool, 0, sizeof(smp_key_pool));
+  smp_key_pool.thread = thread_new("bt_smp_key_pool");
+  if (smp_key_pool.thread == NULL) {
+    LOG_ERROR(LOG_TAG, "%s unable to create the worker thread", __func__);
+    return;
+  }
+  thread_set_priority(smp_key_pool.thread, SMP_KEY_POOL_THREAD_PRIORITY);
+}
+
+/*******************************************************************************
+ *
+ * Function         smp_key_pool_free
+ *
+ * Description      Stops the worker thread and wipes the pooled key pairs.
+ *
+ ******************************************************************************/
+void smp_key_pool_free(void) {
+  thread_free(smp_key_pool.thread);
+  memset(&smp_key_pool, 0, sizeof(smp_key_pool));
+}
+
+/*******************************************************************************
+ *
+ * Function         smp_key_pool_refill
+ *
+ * Description      Starts generating a key pair if the pool isn't full. Does
+ *                  nothing while a pairing is in progress: the pool is then
+ *                  refilled when the pairing completes.
+ *
+ ******************************************************************************/
+void smp_key_pool_refill(void) {
+  if (smp_key_pool.thread == NULL || smp_key_pool.refill_pending ||
+      smp_key_pool.count >= SMP_KEY_POOL_SIZE)
+    return;
+
+  if (smp_cb.state != SMP_STATE_IDLE || smp_cb.br_state != SMP_BR_STATE_IDLE)
+    return;
+
+  const controller_t* controller = controller_get_interface();
+  if (!controller->get_is_ready() || !controller->supports_ble()) return;
+
+  smp_key_pool.refill_pending = true;
+  tSMP_KEY_PAIR* p_pair = (tSMP_KEY_PAIR*)osi_calloc(sizeof(tSMP_KEY_PAIR));
+  btsnd_hcic_ble_rand(Bind(&smp_key_pool_rand_cback, p_pair, 0));
+}
+
+/*******************************************************************************
+ *
+ * Function         smp_key_pool_take
+ *
+ * Description      Moves a precomputed key pair out of the pool.
+ *
+ * Returns          true if a key pair was stored in |private_key| and
+ *                  |p_public_key|, false if the pool is empty.
+ *
+ ******************************************************************************/
+bool smp_key_pool_take(BT_OCTET32 private_key, tSMP_PUBLIC_KEY* p_public_key) {
+  if (smp_key_pool.count == 0) {
+    smp_key_pool.misses++;
+    return false;
+  }
+
+  tSMP_KEY_PAIR* p_pair = &smp_key_pool.keys[--smp_key_pool.count];
+  memcpy(private_key, p_pair->private_key, BT_OCTET32_LEN);
+  *p_public_key = p_pair->public_key;
+  memset(p_pair, 0, sizeof(*p_pair));
+  smp_key_pool.hits++;
+  return true;
+}
+
+/*******************************************************************************
+ *
+ * Function         smp_key_pool_dump
+ *
+ * Description      Dumps the depth and statistics of the pool to |fd|.
+ *
+ ******************************************************************************/
+void smp_key_pool_dump(int fd) {
+  dprintf(fd, "  Key pair pool: %d/%d%s\n", smp_key_pool.count,
+          SMP_KEY_POOL_SIZE, smp_key_pool.refill_pending ? " (refilling)" : "");
+  dprintf(fd, "    Generated: %u hits: %u misses: %u\n", smp_key_pool.generated,
+          smp_key_pool.hits, smp_key_pool.misses);
+}
@@ -32,6 +32,7 @@
 #include "btm_ble_api.h"
 #include "btm_ble_int.h"
 #include "btm_int.h"
+#include "btu.h"
 #include "device/include/controller.h"
 #include "hcimsgs.h"
 #include "osi/include/osi.h"
@@ -51,6 +52,7 @@ using crypto_toolbox::aes_128;
 static void smp_process_stk(tSMP_CB* p_cb, Octet16* p);
 static Octet16 smp_calculate_legacy_short_term_key(tSMP_CB* p_cb);
 static void smp_process_private_key(tSMP_CB* p_cb);
+static void smp_process_local_key_pair(tSMP_CB* p_cb);
 
 #define SMP_PASSKEY_MASK 0xfff00000
 
@@ -604,8 +606,10 @@ Octet16 smp_calculate_legacy_short_term_key(tSMP_CB* p_cb) {
  *
  * Description      This function is called to create private key used to
  *                  calculate public key and DHKey.
- *                  The function starts private key creation requesting
- *                  for the controller to generate [0-7] octets of private key.
+ *                  A precomputed key pair is used when the pool has one.
+ *                  Otherwise the function starts private key creation
+ *                  requesting for the controller to generate [0-7] octets of
+ *                  private key.
  *
  * Returns          void
  *
@@ -613,6 +617,12 @@ Octet16 smp_calculate_legacy_short_term_key(tSMP_CB* p_cb) {
 void smp_create_private_key(tSMP_CB* p_cb, tSMP_INT_DATA* p_data) {
   SMP_TRACE_DEBUG("%s", __func__);
 
+  /* The key pair is reported asynchronously, like the one created below */
+  if (smp_key_pool_take(p_cb->private_key, &p_cb->loc_publ_key) &&
+      do_in_main_thread(FROM_HERE, Bind(&smp_process_local_key_pair, p_cb)) ==
+          BT_STATUS_SUCCESS)
+    return;
+
   btsnd_hcic_ble_rand(Bind(
       [](tSMP_CB* p_cb, BT_OCTET8 rand) {
         memcpy((void*)p_cb->private_key, rand, BT_OCTET8_LEN);
@@ -691,10 +701,24 @@ void smp_process_private_key(tSMP_CB* p_cb) {
   SMP_TRACE_DEBUG("%s", __func__);
 
   memcpy(private_key, p_cb->private_key, BT_OCTET32_LEN);
-  ECC_PointMult(&public_key, &(curve_p256.G), (uint32_t*)private_key);
+  ECC_PointMult_Base(&public_key, (uint32_t*)private_key);
   memcpy(p_cb->loc_publ_key.x, public_key.x, BT_OCTET32_LEN);
   memcpy(p_cb->loc_publ_key.y, public_key.y, BT_OCTET32_LEN);
 
+  smp_process_local_key_pair(p_cb);
+}
+
+/*******************************************************************************
+ *
+ * Function         smp_process_local_key_pair
+ *
+ * Description      This function notifies SM that the private key / public
+ *                  key pair in |p_cb| is created.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void smp_process_local_key_pair(tSMP_CB* p_cb) {
   smp_debug_print_nbyte_little_endian(p_cb->private_key, "private",
                                       BT_OCTET32_LEN);
   smp_debug_print_nbyte_little_endian(p_cb->loc_publ_key.x, "local public(x)",
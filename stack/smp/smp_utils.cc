@@ -951,6 +951,9 @@ void smp_proc_pairing_cmpl(tSMP_CB* p_cb) {
   smp_reset_control_value(p_cb);
 
   if (p_callback) (*p_callback)(SMP_COMPLT_EVT, pairing_bda, &evt_data);
+
+  /* Replace the key pair used by this pairing */
+  smp_key_pool_refill();
 }
 
 /*******************************************************************************
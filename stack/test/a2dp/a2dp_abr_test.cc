@@ -0,0 +1,135 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "a2dp_abr.h"
+
+namespace {
+
+constexpr uint64_t kStartMs = 10000;
+constexpr tA2DP_ABR_LINK_QUALITY kGoodLink = {.rssi = -50,
+                                              .retransmission_count = 1,
+                                              .no_rx_count = 0,
+                                              .nak_count = 0,
+                                              .flow_off_count = 0};
+constexpr tA2DP_ABR_LINK_QUALITY kWeakLink = {.rssi = -85,
+                                              .retransmission_count = 40,
+                                              .no_rx_count = 10,
+                                              .nak_count = 15,
+                                              .flow_off_count = 0};
+
+class A2dpAbrTest : public ::testing::Test {
+ protected:
+  void SetUp() override { abr_.Update(now_ms_); }
+
+  // Ends the current period with |fn| feeding it, returns whether the
+  // bitrate changed
+  template <typename Fn>
+  bool Period(Fn fn) {
+    fn();
+    now_ms_ += A2dpAbr::kEvaluationIntervalMs;
+    return abr_.Update(now_ms_);
+  }
+
+  bool QuietPeriod() {
+    return Period([this] { abr_.OnTransmitQueueLength(0); });
+  }
+
+  A2dpAbr abr_;
+  uint64_t now_ms_ = kStartMs;
+};
+
+TEST_F(A2dpAbrTest, starts_at_full_bitrate) {
+  EXPECT_EQ(abr_.GetBitratePercent(), 100);
+  EXPECT_FALSE(QuietPeriod());
+  EXPECT_EQ(abr_.GetBitratePercent(), 100);
+}
+
+TEST_F(A2dpAbrTest, waits_for_the_end_of_the_period) {
+  abr_.OnCongestion();
+  EXPECT_FALSE(abr_.Update(now_ms_ + A2dpAbr::kEvaluationIntervalMs - 1));
+  EXPECT_TRUE(abr_.Update(now_ms_ + A2dpAbr::kEvaluationIntervalMs));
+  EXPECT_EQ(abr_.GetBitratePercent(), 85);
+}
+
+TEST_F(A2dpAbrTest, steps_down_on_congestion) {
+  EXPECT_TRUE(Period([this] { abr_.OnCongestion(); }));
+  EXPECT_EQ(abr_.GetBitratePercent(), 85);
+  EXPECT_TRUE(Period([this] { abr_.OnTransmitQueueLength(5); }));
+  EXPECT_EQ(abr_.GetBitratePercent(), 70);
+}
+
+TEST_F(A2dpAbrTest, steps_down_on_weak_link) {
+  EXPECT_TRUE(Period([this] { abr_.OnLinkQuality(kWeakLink); }));
+  EXPECT_EQ(abr_.GetBitratePercent(), 85);
+}
+
+TEST_F(A2dpAbrTest, worst_report_of_the_period_counts) {
+  EXPECT_TRUE(Period([this] {
+    abr_.OnLinkQuality(kWeakLink);
+    abr_.OnLinkQuality(kGoodLink);
+  }));
+  EXPECT_EQ(abr_.GetBitratePercent(), 85);
+}
+
+TEST_F(A2dpAbrTest, stops_at_the_lowest_bitrate) {
+  for (size_t i = 0; i < A2dpAbr::kNumLevels + 2; i++) {
+    Period([this] { abr_.OnCongestion(); });
+  }
+  EXPECT_EQ(abr_.GetBitratePercent(),
+            A2dpAbr::kBitratePercents[A2dpAbr::kNumLevels - 1]);
+  EXPECT_FALSE(Period([this] { abr_.OnCongestion(); }));
+}
+
+TEST_F(A2dpAbrTest, steps_up_after_a_healthy_hold) {
+  Period([this] { abr_.OnCongestion(); });
+  Period([this] { abr_.OnCongestion(); });
+  ASSERT_EQ(abr_.GetBitratePercent(), 70);
+
+  size_t hold_periods = A2dpAbr::kStepUpHoldMs / A2dpAbr::kEvaluationIntervalMs;
+  for (size_t i = 0; i + 1 < hold_periods; i++) {
+    EXPECT_FALSE(Period([this] { abr_.OnLinkQuality(kGoodLink); }));
+  }
+  EXPECT_TRUE(Period([this] { abr_.OnLinkQuality(kGoodLink); }));
+  EXPECT_EQ(abr_.GetBitratePercent(), 85);
+
+  // The next step must wait for a full hold again
+  for (size_t i = 0; i + 1 < hold_periods; i++) EXPECT_FALSE(QuietPeriod());
+  EXPECT_TRUE(QuietPeriod());
+  EXPECT_EQ(abr_.GetBitratePercent(), 100);
+}
+
+TEST_F(A2dpAbrTest, fair_link_holds_the_bitrate) {
+  Period([this] { abr_.OnCongestion(); });
+  ASSERT_EQ(abr_.GetBitratePercent(), 85);
+
+  // Some packets wait in the queue: not bad enough to step down, not good
+  // enough to step up
+  for (int i = 0; i < 20; i++) {
+    EXPECT_FALSE(Period([this] { abr_.OnTransmitQueueLength(2); }));
+  }
+  EXPECT_EQ(abr_.GetBitratePercent(), 85);
+}
+
+TEST_F(A2dpAbrTest, reset_restores_full_bitrate) {
+  Period([this] { abr_.OnCongestion(); });
+  ASSERT_EQ(abr_.GetBitratePercent(), 85);
+  abr_.Reset();
+  EXPECT_EQ(abr_.GetBitratePercent(), 100);
+}
+
+}  // namespace
@@ -0,0 +1,162 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cstdint>
+#include <vector>
+
+#include "a2dp_pcm_convert.h"
+#include "a2dp_sbc_up_sample.h"
+
+namespace {
+
+// Sizes covering the vector blocks and the samples left to the scalar code
+constexpr size_t kSizes[] = {0, 1, 2, 3, 5, 7, 8, 15, 16, 17, 33, 129, 384};
+
+std::vector<uint8_t> Noise(size_t num_bytes) {
+  std::vector<uint8_t> data(num_bytes);
+  for (auto& b : data) b = rand() & 0xff;
+  return data;
+}
+
+// What a2dp_sbc_up_sample() makes of |src| when |ratio| is an integer
+std::vector<uint8_t> UpSample(const std::vector<uint8_t>& src, uint32_t ratio,
+                              uint8_t bits, uint8_t channels) {
+  std::vector<uint16_t> dst(src.size() * ratio * 4 + 2);
+  std::vector<uint8_t> in(src);
+  uint32_t src_used = 0;
+  a2dp_sbc_init_up_sample(8000, 8000 * ratio, bits, channels);
+  int dst_used =
+      a2dp_sbc_up_sample(in.data(), dst.data(), in.size(),
+                         dst.size() * sizeof(uint16_t), &src_used);
+  const uint8_t* p = (const uint8_t*)dst.data();
+  return std::vector<uint8_t>(p, p + dst_used);
+}
+
+TEST(A2dpPcmConvertTest, pcm_8_to_16) {
+  for (size_t n : kSizes) {
+    std::vector<uint8_t> src = Noise(n);
+    std::vector<uint8_t> buf(2 * n);
+    memcpy(buf.data(), src.data(), n);
+    a2dp_pcm_8_to_16(buf.data(), n);
+    for (size_t i = 0; i < n; i++) {
+      int16_t sample;
+      memcpy(&sample, &buf[2 * i], sizeof(sample));
+      ASSERT_EQ(sample, (src[i] - 0x80) * 256) << "n=" << n << " i=" << i;
+    }
+  }
+}
+
+TEST(A2dpPcmConvertTest, pcm_24_to_32) {
+  for (size_t n : kSizes) {
+    std::vector<uint8_t> src = Noise(3 * n);
+    std::vector<uint8_t> buf(4 * n);
+    memcpy(buf.data(), src.data(), 3 * n);
+    a2dp_pcm_24_to_32(buf.data(), n);
+    for (size_t i = 0; i < n; i++) {
+      int32_t expected = src[3 * i] | (src[3 * i + 1] << 8) |
+                         ((int8_t)src[3 * i + 2] * 65536);
+      int32_t sample;
+      memcpy(&sample, &buf[4 * i], sizeof(sample));
+      ASSERT_EQ(sample, expected) << "n=" << n << " i=" << i;
+    }
+  }
+}
+
+TEST(A2dpPcmConvertTest, mono_to_stereo_16) {
+  for (size_t n : kSizes) {
+    std::vector<uint8_t> src = Noise(2 * n);
+    std::vector<int16_t> buf(2 * n);
+    memcpy(buf.data(), src.data(), src.size());
+    a2dp_pcm_mono_to_stereo_16(buf.data(), n);
+    for (size_t i = 0; i < n; i++) {
+      int16_t expected;
+      memcpy(&expected, &src[2 * i], sizeof(expected));
+      ASSERT_EQ(buf[2 * i], expected) << "n=" << n << " i=" << i;
+      ASSERT_EQ(buf[2 * i + 1], expected) << "n=" << n << " i=" << i;
+    }
+  }
+}
+
+// The float conversions give exactly the scalar product of the sample with
+// the scale and gain factor, and write no further than |dst|
+TEST(A2dpPcmConvertTest, pcm_to_float) {
+  const float gain = 0.5f;
+  for (size_t n : kSizes) {
+    std::vector<uint8_t> src16 = Noise(2 * n);
+    std::vector<uint8_t> src24 = Noise(3 * n);
+    std::vector<uint8_t> src32 = Noise(4 * n);
+    std::vector<float> dst16(n + 1, 42.0f), dst24(n + 1, 42.0f),
+        dst32(n + 1, 42.0f);
+    a2dp_pcm_16_to_float(src16.data(), dst16.data(), n, gain);
+    a2dp_pcm_24_to_float(src24.data(), dst24.data(), n, gain);
+    a2dp_pcm_32_to_float(src32.data(), dst32.data(), n, gain);
+    for (size_t i = 0; i < n; i++) {
+      int16_t s16;
+      memcpy(&s16, &src16[2 * i], sizeof(s16));
+      ASSERT_EQ(dst16[i], s16 * (gain / 32768.0f)) << "n=" << n << " i=" << i;
+      int32_t s24 = src24[3 * i] | (src24[3 * i + 1] << 8) |
+                    ((int8_t)src24[3 * i + 2] * 65536);
+      ASSERT_EQ(dst24[i], s24 * (gain / 8388608.0f))
+          << "n=" << n << " i=" << i;
+      int32_t s32;
+      memcpy(&s32, &src32[4 * i], sizeof(s32));
+      ASSERT_EQ(dst32[i], s32 * (gain / 2147483648.0f))
+          << "n=" << n << " i=" << i;
+    }
+    EXPECT_EQ(dst16[n], 42.0f);
+    EXPECT_EQ(dst24[n], 42.0f);
+    EXPECT_EQ(dst32[n], 42.0f);
+  }
+}
+
+// The conversions the SBC encoder does when the SBC sampling rate is a
+// multiple of the feeding one give the PCM of the up-sampling engine.
+TEST(A2dpPcmConvertTest, matches_sbc_up_sample) {
+  const uint32_t ratios[] = {2, 3, 6};
+  const uint8_t bits[] = {8, 16};
+  const uint8_t channels[] = {1, 2};
+  for (uint32_t ratio : ratios) {
+    for (uint8_t bits_per_sample : bits) {
+      for (uint8_t channel_count : channels) {
+        for (size_t n : kSizes) {
+          if (n == 0) continue;
+          std::vector<uint8_t> src =
+              Noise(n * channel_count * bits_per_sample / 8);
+          std::vector<uint8_t> expected =
+              UpSample(src, ratio, bits_per_sample, channel_count);
+
+          std::vector<uint8_t> buf(n * ratio * 4);
+          memcpy(buf.data(), src.data(), src.size());
+          if (bits_per_sample == 8) {
+            a2dp_pcm_8_to_16(buf.data(), n * channel_count);
+          }
+          if (channel_count == 1) {
+            a2dp_pcm_mono_to_stereo_16((int16_t*)buf.data(), n);
+          }
+          a2dp_pcm_upsample_stereo_16((int16_t*)buf.data(), n, ratio);
+          ASSERT_EQ(buf, expected)
+              << "ratio=" << ratio << " bits=" << (int)bits_per_sample
+              << " channels=" << (int)channel_count << " n=" << n;
+        }
+      }
+    }
+  }
+}
+
+}  // namespace
@@ -0,0 +1,165 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <stdlib.h>
+#include <cstdint>
+#include <vector>
+
+#include "oi_codec_sbc.h"
+#include "oi_status.h"
+#include "sbc_encoder.h"
+
+namespace {
+
+constexpr int kFramesPerStream = 48;
+constexpr size_t kMaxPcmSamplesPerFrame = SBC_MAX_NUM_OF_BLOCKS *
+                                          SBC_MAX_NUM_OF_SUBBANDS *
+                                          SBC_MAX_NUM_OF_CHANNELS;
+// The decoder does not clear its filter buffers on reset, so the context data
+// is zero-initialized to make both decoders start from the same state.
+constexpr size_t kContextDataWords =
+    CODEC_DATA_WORDS(2, SBC_CODEC_FAST_FILTER_BUFFERS);
+// Larger than any frame produced with the bitpools below
+constexpr size_t kMaxFrameBytes = 1024;
+
+struct SbcConfig {
+  int16_t channel_mode;
+  int16_t num_of_subbands;
+  int16_t num_of_blocks;
+  int16_t allocation_method;
+  uint16_t bit_rate;
+};
+
+// Encodes noise of varying amplitude, including full scale square waves that
+// saturate the synthesis output.
+std::vector<uint8_t> EncodeStream(const SbcConfig& config) {
+  SBC_ENC_PARAMS params = {};
+  params.s16SamplingFreq = SBC_sf44100;
+  params.s16ChannelMode = config.channel_mode;
+  params.s16NumOfSubBands = config.num_of_subbands;
+  params.s16NumOfBlocks = config.num_of_blocks;
+  params.s16AllocationMethod = config.allocation_method;
+  params.u16BitRate = config.bit_rate;
+  SBC_Encoder_Init(&params);
+
+  const int samples = config.num_of_blocks * config.num_of_subbands *
+                      (config.channel_mode == SBC_MONO ? 1 : 2);
+  std::vector<uint8_t> stream;
+  int16_t pcm[kMaxPcmSamplesPerFrame];
+  uint8_t frame[kMaxFrameBytes];
+
+  srand(config.bit_rate + config.num_of_blocks);
+  for (int f = 0; f < kFramesPerStream; f++) {
+    const int amplitudes[] = {32767, 8000, 100, 0};
+    int amplitude = amplitudes[f % 4];
+    for (int i = 0; i < samples; i++) {
+      if (f % 7 == 6) {
+        pcm[i] = (i & 1) ? 32767 : -32768;
+      } else {
+        pcm[i] = amplitude ? (rand() % (2 * amplitude + 1)) - amplitude : 0;
+      }
+    }
+    uint32_t length = SBC_Encode(&params, pcm, frame);
+    stream.insert(stream.end(), frame, frame + length);
+  }
+  return stream;
+}
+
+std::vector<int16_t> DecodeStream(const std::vector<uint8_t>& stream,
+                                  OI_CODEC_SBC_BACKEND backend) {
+  OI_CODEC_SBC_DECODER_CONTEXT context;
+  uint32_t context_data[kContextDataWords] = {};
+  EXPECT_EQ(OI_OK, OI_CODEC_SBC_DecoderReset(&context, context_data,
+                                             sizeof(context_data), 2, 2,
+                                             false));
+  EXPECT_EQ(OI_OK, OI_CODEC_SBC_DecoderSetBackend(&context, backend));
+
+  std::vector<int16_t> pcm;
+  const OI_BYTE* data = stream.data();
+  uint32_t bytes = stream.size();
+  while (bytes > 0) {
+    int16_t frame_pcm[kMaxPcmSamplesPerFrame];
+    uint32_t pcm_bytes = sizeof(frame_pcm);
+    OI_STATUS status = OI_CODEC_SBC_DecodeFrame(&context, &data, &bytes,
+                                                frame_pcm, &pcm_bytes);
+    if (!OI_SUCCESS(status)) {
+      ADD_FAILURE() << "decoding failed with status " << status;
+      break;
+    }
+    pcm.insert(pcm.end(), frame_pcm,
+               frame_pcm + pcm_bytes / sizeof(frame_pcm[0]));
+  }
+  return pcm;
+}
+
+}  // namespace
+
+class A2dpSbcDecoderSimdTest : public ::testing::TestWithParam<SbcConfig> {
+ protected:
+  void SetUp() override {
+    OI_CODEC_SBC_DECODER_CONTEXT context;
+    uint32_t context_data[kContextDataWords] = {};
+    OI_CODEC_SBC_DecoderReset(&context, context_data, sizeof(context_data), 2,
+                              2, false);
+    simd_supported_ = OI_SUCCESS(
+        OI_CODEC_SBC_DecoderSetBackend(&context, OI_CODEC_SBC_BACKEND_SIMD));
+  }
+
+  bool simd_supported_ = false;
+};
+
+TEST_P(A2dpSbcDecoderSimdTest, simd_output_matches_c_output) {
+  if (!simd_supported_) {
+    GTEST_SKIP() << "No SIMD backend on this CPU";
+  }
+
+  std::vector<uint8_t> stream = EncodeStream(GetParam());
+  std::vector<int16_t> reference = DecodeStream(stream, OI_CODEC_SBC_BACKEND_C);
+  std::vector<int16_t> simd = DecodeStream(stream, OI_CODEC_SBC_BACKEND_SIMD);
+
+  ASSERT_FALSE(reference.empty());
+  ASSERT_EQ(reference.size(), simd.size());
+  for (size_t i = 0; i < reference.size(); i++) {
+    ASSERT_EQ(reference[i], simd[i]) << "at sample " << i;
+  }
+}
+
+TEST(A2dpSbcDecoderBackendTest, c_backend_always_available) {
+  OI_CODEC_SBC_DECODER_CONTEXT context;
+  uint32_t context_data[kContextDataWords] = {};
+  ASSERT_EQ(OI_OK, OI_CODEC_SBC_DecoderReset(&context, context_data,
+                                             sizeof(context_data), 2, 2,
+                                             false));
+  EXPECT_EQ(OI_OK,
+            OI_CODEC_SBC_DecoderSetBackend(&context, OI_CODEC_SBC_BACKEND_C));
+  EXPECT_EQ(OI_OK, OI_CODEC_SBC_DecoderSetBackend(&context,
+                                                  OI_CODEC_SBC_BACKEND_AUTO));
+}
+
+INSTANTIATE_TEST_CASE_P(
+    SbcConfigs, A2dpSbcDecoderSimdTest,
+    ::testing::Values(SbcConfig{SBC_MONO, SUB_BANDS_8, 16, SBC_LOUDNESS, 200},
+                      SbcConfig{SBC_MONO, SUB_BANDS_4, 8, SBC_SNR, 100},
+                      SbcConfig{SBC_DUAL, SUB_BANDS_8, 12, SBC_SNR, 300},
+                      SbcConfig{SBC_STEREO, SUB_BANDS_8, 16, SBC_LOUDNESS, 345},
+                      SbcConfig{SBC_STEREO, SUB_BANDS_4, 4, SBC_LOUDNESS, 229},
+                      SbcConfig{SBC_JOINT_STEREO, SUB_BANDS_8, 16,
+                                SBC_LOUDNESS, 328},
+                      SbcConfig{SBC_JOINT_STEREO, SUB_BANDS_4, 16, SBC_SNR,
+                                250},
+                      SbcConfig{SBC_JOINT_STEREO, SUB_BANDS_8, 4, SBC_SNR,
+                                500}));
@@ -0,0 +1,351 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+// SBC streams produced by the scalar encoder from the input of
+// a2dp_sbc_encoder_test.cc, one per configuration of kGoldenStreams.
+// Do not regenerate these from the current encoder: they catch changes to
+// its output.
+
+const uint8_t kSbcGoldenMono4[] = {
+    0x9c, 0x00, 0x14, 0xba, 0x9a, 0xaa, 0x83, 0xde, 0xe8, 0xb6, 0x10, 0xf4,
+    0x4e, 0x7b, 0x07, 0xdc, 0x9c, 0x00, 0x14, 0x84, 0xdd, 0xde, 0xc6, 0x04,
+    0xb7, 0xcf, 0x59, 0x0a, 0x2d, 0x49, 0x84, 0x50, 0x9c, 0x00, 0x14, 0xbe,
+    0xdd, 0xdc, 0x60, 0x77, 0x5d, 0xb3, 0x53, 0x05, 0x3b, 0x2d, 0x58, 0xdb,
+    0x9c, 0x00, 0x14, 0xcd, 0xcd, 0xbb, 0xf8, 0xd7, 0xd4, 0x22, 0xb5, 0x61,
+    0xa6, 0x98, 0x26, 0x4b, 0x9c, 0x00, 0x14, 0x37, 0xef, 0xcd, 0x35, 0x65,
+    0xca, 0x63, 0x5d, 0x6a, 0xe6, 0xc7, 0x8c, 0x3c, 0x9c, 0x00, 0x14, 0xa3,
+    0xdd, 0xdd, 0x2d, 0x6d, 0xcd, 0xb3, 0x95, 0xb9, 0x45, 0x9c, 0x5e, 0xf4,
+    0x9c, 0x00, 0x14, 0xa3, 0xdd, 0xdd, 0x6d, 0x65, 0xcf, 0x37, 0x53, 0x19,
+    0x59, 0x5e, 0xd8, 0xd9, 0x9c, 0x00, 0x14, 0x79, 0xdd, 0xbb, 0xbe, 0x56,
+    0xe5, 0xd1, 0xc5, 0x70, 0xc6, 0x98, 0x32, 0x4b,
+};
+
+const uint8_t kSbcGoldenMono8[] = {
+    0x9c, 0x73, 0x1c, 0xe0, 0xdd, 0xde, 0xdd, 0xdd, 0x77, 0x77, 0x6d, 0xb7,
+    0x77, 0x76, 0xdb, 0x77, 0x77, 0x6d, 0xb7, 0x68, 0x76, 0xdb, 0x9a, 0x87,
+    0x91, 0xc4, 0x98, 0x97, 0x8e, 0x94, 0x19, 0x92, 0x35, 0x85, 0x78, 0x1b,
+    0x68, 0x94, 0x49, 0x4d, 0x49, 0x88, 0x93, 0xa7, 0x77, 0xad, 0xc8, 0x6a,
+    0x4c, 0xcc, 0xa3, 0xa8, 0x94, 0x9a, 0x79, 0x65, 0x63, 0x19, 0x08, 0x75,
+    0xc4, 0x57, 0x34, 0x8d, 0x9c, 0x73, 0x1c, 0x23, 0xce, 0xdd, 0xdd, 0xcc,
+    0xad, 0x55, 0x9b, 0x29, 0x38, 0xa5, 0x99, 0x51, 0x5c, 0x8d, 0xad, 0x18,
+    0xac, 0x11, 0xcd, 0xc7, 0x79, 0xa1, 0x87, 0xb7, 0x81, 0x56, 0x94, 0x73,
+    0x95, 0x29, 0x27, 0xa1, 0x4b, 0x97, 0x68, 0x84, 0x59, 0xc7, 0x42, 0xa7,
+    0x64, 0x58, 0xa9, 0x05, 0x47, 0x34, 0x96, 0x6b, 0x7a, 0xa7, 0x97, 0xb7,
+    0x81, 0x77, 0x85, 0x73, 0x97, 0x29, 0x27, 0xa1, 0x9c, 0x73, 0x1c, 0x4a,
+    0xbe, 0xcd, 0xbc, 0xbc, 0x6b, 0xdc, 0x19, 0x14, 0x6c, 0xe9, 0x05, 0x46,
+    0x34, 0x9c, 0x92, 0xa9, 0x19, 0x8e, 0x51, 0xab, 0xa3, 0x39, 0x04, 0x39,
+    0x6b, 0x6f, 0xbb, 0xd6, 0xb6, 0xfb, 0xbd, 0x6b, 0x6f, 0xbb, 0xd6, 0xb6,
+    0xfb, 0xbd, 0x6b, 0x6f, 0xbb, 0xd6, 0xb6, 0xfb, 0xbd, 0x6b, 0x6f, 0xbb,
+    0xd6, 0xb6, 0xfb, 0xbd, 0x6b, 0x6f, 0xbb, 0xd6, 0xb6, 0xfb, 0xbd, 0x6b,
+    0x9c, 0x73, 0x1c, 0xdb, 0xcc, 0xfc, 0xa7, 0xad, 0x77, 0x7e, 0xea, 0xf7,
+    0x77, 0xee, 0xaf, 0x68, 0x81, 0x0b, 0x05, 0xb7, 0xd0, 0x91, 0x2c, 0x97,
+    0x55, 0x99, 0x4b, 0x67, 0x3b, 0x77, 0x2c, 0xcb, 0x97, 0x79, 0x52, 0xb9,
+    0x77, 0xba, 0xab, 0x97, 0x72, 0xcc, 0xb9, 0x77, 0x95, 0x2b, 0x97, 0x7b,
+    0xaa, 0xb9, 0x77, 0x2c, 0xcb, 0x97, 0x79, 0x52, 0xb9, 0x77, 0xba, 0xab,
+    0x97, 0x72, 0xcc, 0xb9, 0x9c, 0x73, 0x1c, 0x5c, 0xdd, 0xfd, 0xdd, 0xdd,
+    0x77, 0x94, 0x6d, 0xd7, 0x7b, 0x36, 0xdd, 0x77, 0x2b, 0x6d, 0xd7, 0x79,
+    0x56, 0xe5, 0x65, 0x98, 0x95, 0xa7, 0x47, 0xc7, 0x8d, 0x39, 0x85, 0x93,
+    0x34, 0x17, 0xd2, 0x9e, 0x2b, 0x83, 0x77, 0x39, 0x08, 0x37, 0x52, 0x9c,
+    0x5c, 0xad, 0x43, 0x67, 0x34, 0xa1, 0xa6, 0x6e, 0x8e, 0x2c, 0xa8, 0x97,
+    0x1b, 0x7a, 0x94, 0x4a, 0xb4, 0x78, 0x86, 0x93, 0x9c, 0x73, 0x1c, 0x41,
+    0xee, 0xdd, 0xcc, 0xdd, 0xab, 0x66, 0x96, 0xb6, 0x36, 0xa1, 0x59, 0xc3,
+    0xad, 0x92, 0x27, 0xc2, 0x64, 0x1b, 0x79, 0xd5, 0xd9, 0x98, 0x25, 0x09,
+    0x5d, 0x7c, 0x15, 0x11, 0xa7, 0xd9, 0xad, 0x9c, 0x7e, 0x5e, 0xd5, 0x27,
+    0xde, 0x15, 0x23, 0x74, 0xa4, 0x99, 0x37, 0x2e, 0x5d, 0x62, 0x71, 0xa3,
+    0x11, 0xc7, 0x19, 0xe5, 0x9a, 0x72, 0x98, 0x95, 0xc8, 0xd2, 0x62, 0x64,
+    0x9c, 0x73, 0x1c, 0xae, 0xce, 0xcd, 0xbd, 0xbb, 0xac, 0xde, 0xd8, 0x09,
+    0xbe, 0x95, 0x39, 0x99, 0x6c, 0x9a, 0x29, 0x5b, 0x60, 0x88, 0xd4, 0x6a,
+    0x95, 0x24, 0x7e, 0xdc, 0x79, 0x87, 0x9d, 0xd7, 0x57, 0x7d, 0xdd, 0x75,
+    0x77, 0xdd, 0xd7, 0x57, 0x7d, 0xdd, 0x75, 0x77, 0xdd, 0xd7, 0x57, 0x7d,
+    0xdd, 0x75, 0x77, 0xdd, 0xd7, 0x57, 0x7d, 0xdd, 0x75, 0x77, 0xdd, 0xd7,
+    0x57, 0x7d, 0xdd, 0x75, 0x9c, 0x73, 0x1c, 0xdb, 0xcc, 0xfc, 0xa7, 0xad,
+    0x77, 0x7e, 0xea, 0xf7, 0x77, 0xee, 0xaf, 0x68, 0x81, 0x0b, 0x05, 0xb7,
+    0xd0, 0x91, 0x2c, 0x97, 0x55, 0x99, 0x4b, 0x67, 0x3b, 0x77, 0x2c, 0xcb,
+    0x97, 0x79, 0x52, 0xb9, 0x77, 0xba, 0xab, 0x97, 0x72, 0xcc, 0xb9, 0x77,
+    0x95, 0x2b, 0x97, 0x7b, 0xaa, 0xb9, 0x77, 0x2c, 0xcb, 0x97, 0x79, 0x52,
+    0xb9, 0x77, 0xba, 0xab, 0x97, 0x72, 0xcc, 0xb9,
+};
+
+const uint8_t kSbcGoldenDual8[] = {
+    0x9c, 0xa5, 0x17, 0x27, 0xcd, 0xdd, 0xcd, 0xdd, 0xcd, 0xde, 0xdd, 0xdc,
+    0x7b, 0x6d, 0xb6, 0xf6, 0xdd, 0xb5, 0xed, 0xb6, 0xdb, 0xdb, 0x76, 0xd7,
+    0xb6, 0xdb, 0x70, 0x6d, 0xdb, 0x60, 0xe3, 0x6d, 0xc1, 0xb8, 0x6d, 0x8c,
+    0x44, 0x35, 0xd6, 0x9e, 0xd8, 0x7a, 0x39, 0x63, 0x8b, 0x87, 0x0c, 0x12,
+    0x4a, 0xa3, 0x69, 0x84, 0x52, 0x63, 0xa8, 0xae, 0x16, 0x85, 0xbc, 0x94,
+    0xa9, 0x77, 0x6d, 0xb7, 0x15, 0xc6, 0x9e, 0x1a, 0x74, 0x8c, 0x86, 0xdc,
+    0x76, 0x4d, 0xa3, 0x55, 0x14, 0x56, 0x4b, 0x5a, 0x82, 0x9c, 0xa5, 0x17,
+    0xa1, 0xdd, 0xde, 0xdd, 0xdd, 0xdd, 0xde, 0xde, 0xdd, 0x53, 0x70, 0x9c,
+    0x58, 0x95, 0xc5, 0x76, 0x2a, 0x6d, 0x63, 0x5c, 0xeb, 0xb8, 0xf5, 0xb3,
+    0x02, 0x65, 0x58, 0x8c, 0xa6, 0xe9, 0x28, 0x8d, 0xa9, 0x4c, 0x5b, 0x56,
+    0x98, 0xb5, 0xca, 0x32, 0x2b, 0x2c, 0x36, 0xd7, 0xa7, 0x8d, 0x2f, 0x8e,
+    0x5c, 0x5a, 0xdd, 0x3a, 0xb5, 0xbc, 0x69, 0x6c, 0x68, 0xd2, 0xd7, 0x1d,
+    0xb5, 0xf1, 0x24, 0x43, 0x13, 0x27, 0x1a, 0x25, 0x71, 0xb2, 0x76, 0x23,
+    0xa0, 0xdd, 0x3a, 0xc5, 0xcc, 0x68, 0x9c, 0xa5, 0x17, 0x2e, 0xbc, 0xbe,
+    0xac, 0xcc, 0xbc, 0xbe, 0xcd, 0xcd, 0x8d, 0x51, 0x34, 0xe6, 0x68, 0xa1,
+    0x99, 0x35, 0x02, 0x84, 0x9d, 0x25, 0x66, 0x5d, 0x28, 0x16, 0x49, 0x0f,
+    0x2c, 0x89, 0x11, 0x6e, 0x36, 0x83, 0x9a, 0x30, 0xd0, 0x92, 0xd6, 0x0c,
+    0x71, 0xac, 0x35, 0xd3, 0x57, 0xb5, 0xd6, 0xae, 0xd7, 0x6d, 0x5e, 0xd7,
+    0x5a, 0xbb, 0x5d, 0xb5, 0x7b, 0x5d, 0x6a, 0xed, 0x76, 0xd5, 0xed, 0x75,
+    0xab, 0xb5, 0xdb, 0x57, 0xb5, 0xd6, 0xae, 0xd7, 0x6d, 0x5e, 0xd7, 0x5a,
+    0xbb, 0x5d, 0xb5, 0x9c, 0xa5, 0x17, 0xd6, 0xdb, 0xcb, 0xdf, 0xbb, 0xdc,
+    0xbb, 0xdf, 0xca, 0x7d, 0xb5, 0xba, 0xfb, 0xab, 0x75, 0xf6, 0xd6, 0xeb,
+    0xee, 0xad, 0xd7, 0x1b, 0x5b, 0xb0, 0xc2, 0xb7, 0x5a, 0xac, 0x8e, 0xc2,
+    0xe9, 0x1d, 0x15, 0x58, 0xb1, 0x7d, 0xc0, 0x50, 0x92, 0xe7, 0x67, 0x2c,
+    0x56, 0x12, 0x9b, 0x53, 0x39, 0xba, 0xab, 0x4a, 0x6d, 0x66, 0xe8, 0xea,
+    0xc9, 0x29, 0xb5, 0xe3, 0xa3, 0xab, 0x84, 0xa6, 0xd4, 0xce, 0x8e, 0xae,
+    0xd2, 0x9b, 0x59, 0xba, 0x3a, 0xb2, 0x4a, 0x6d, 0x78, 0xe8, 0xeb, 0x21,
+    0x9c, 0xa5, 0x17, 0x7d, 0xdd, 0xdd, 0xdf, 0xdd, 0xde, 0xdd, 0xdf, 0xcd,
+    0x2b, 0x6d, 0x33, 0xa3, 0xb6, 0xec, 0xad, 0xb6, 0x6e, 0x8e, 0xdb, 0x22,
+    0xb6, 0xde, 0x38, 0xbb, 0x72, 0x0e, 0x9c, 0x2c, 0xe4, 0xed, 0xaa, 0x5b,
+    0x26, 0xaa, 0xbb, 0x37, 0x91, 0x16, 0x27, 0x13, 0x77, 0xa8, 0x7a, 0x94,
+    0x9b, 0xcd, 0xbc, 0xb9, 0xd6, 0xd3, 0x6e, 0x4f, 0x06, 0xb7, 0x40, 0x94,
+    0xbc, 0xbc, 0x39, 0x5e, 0x72, 0xd9, 0x03, 0xd2, 0xe2, 0x63, 0x26, 0xd3,
+    0x10, 0x23, 0x71, 0xe7, 0x61, 0x6f, 0x7c, 0xe9, 0xa7, 0x9c, 0xa5, 0x17,
+    0x80, 0xdd, 0xce, 0xdd, 0xdd, 0xdd, 0xde, 0xdc, 0xdd, 0x54, 0x6f, 0x52,
+    0x9b, 0x66, 0x34, 0xc7, 0x32, 0x74, 0x1c, 0x99, 0x83, 0x38, 0xca, 0x98,
+    0x69, 0xa3, 0x9b, 0xa5, 0xc8, 0xa9, 0xe7, 0xaa, 0x8b, 0xb1, 0x1b, 0x17,
+    0x61, 0xea, 0x4c, 0x53, 0xac, 0x5b, 0xb6, 0x17, 0xc6, 0x6d, 0x2f, 0x4d,
+    0xda, 0x5f, 0x59, 0xb6, 0xb9, 0x32, 0x79, 0x6c, 0x72, 0xea, 0xd2, 0xd9,
+    0x85, 0xb2, 0x63, 0x43, 0x53, 0xb6, 0x96, 0xaa, 0xd1, 0x4c, 0x6e, 0x9e,
+    0x66, 0xf1, 0xb8, 0x3e, 0x23, 0x89, 0x9c, 0xa5, 0x17, 0xa0, 0xac, 0xce,
+    0xad, 0xcc, 0xbc, 0xbe, 0xcd, 0xbd, 0xda, 0xe5, 0xb3, 0xa4, 0x52, 0xa2,
+    0x64, 0xc5, 0x13, 0xa3, 0x1a, 0x66, 0x51, 0xe7, 0x0c, 0xda, 0x74, 0x0c,
+    0x32, 0x29, 0x25, 0x11, 0xaa, 0x83, 0x5d, 0x70, 0x55, 0x5a, 0xd5, 0xdc,
+    0x79, 0xac, 0xb1, 0xe3, 0x57, 0x6d, 0xd6, 0xac, 0xd7, 0x6d, 0x5d, 0xb7,
+    0x5a, 0xbb, 0x5d, 0xb5, 0x76, 0xdd, 0x6a, 0xed, 0x76, 0xd5, 0xdb, 0x75,
+    0xab, 0xb5, 0xdb, 0x57, 0x6d, 0xd6, 0xae, 0xd7, 0x6d, 0x5d, 0xb7, 0x5a,
+    0xbb, 0x5d, 0xb5, 0x9c, 0xa5, 0x17, 0xd6, 0xdb, 0xcb, 0xdf, 0xbb, 0xdc,
+    0xbb, 0xdf, 0xca, 0x7d, 0xb5, 0xba, 0xfb, 0xab, 0x75, 0xf6, 0xd6, 0xeb,
+    0xee, 0xad, 0xd7, 0x1b, 0x5b, 0xb0, 0xc2, 0xb7, 0x5a, 0xac, 0x8e, 0xc2,
+    0xe9, 0x1d, 0x15, 0x58, 0xb1, 0x7d, 0xc0, 0x50, 0x92, 0xe7, 0x67, 0x2c,
+    0x56, 0x12, 0x9b, 0x53, 0x39, 0xba, 0xab, 0x4a, 0x6d, 0x66, 0xe8, 0xea,
+    0xc9, 0x29, 0xb5, 0xe3, 0xa3, 0xab, 0x84, 0xa6, 0xd4, 0xce, 0x8e, 0xae,
+    0xd2, 0x9b, 0x59, 0xba, 0x3a, 0xb2, 0x4a, 0x6d, 0x78, 0xe8, 0xeb, 0x21,
+};
+
+const uint8_t kSbcGoldenStereo4[] = {
+    0x9c, 0x9a, 0x0c, 0x5e, 0xcd, 0xdd, 0xdd, 0xee, 0x55, 0x55, 0x55, 0x55,
+    0x55, 0x55, 0x45, 0x54, 0x01, 0x15, 0x4a, 0xa8, 0x9c, 0x9a, 0x0c, 0x22,
+    0xde, 0xee, 0xce, 0xed, 0x55, 0x51, 0x45, 0x59, 0x59, 0x86, 0x95, 0x55,
+    0x99, 0x55, 0x58, 0x65, 0x9c, 0x9a, 0x0c, 0xe9, 0xce, 0xdd, 0xce, 0xdd,
+    0x2a, 0x44, 0x85, 0x60, 0x9a, 0xcc, 0x83, 0x06, 0xad, 0x6a, 0xd6, 0xad,
+    0x9c, 0x9a, 0x0c, 0x6d, 0xdc, 0xfd, 0xdc, 0xfc, 0x5d, 0x75, 0xd7, 0x5d,
+    0x75, 0xd7, 0x19, 0x82, 0xea, 0x1a, 0x20, 0xe8, 0x9c, 0x9a, 0x0c, 0x46,
+    0xdd, 0xfe, 0xdc, 0xfe, 0x2b, 0x51, 0x25, 0x0b, 0x12, 0xb1, 0x5a, 0xa5,
+    0xb0, 0x1c, 0x95, 0x2d, 0x9c, 0x9a, 0x0c, 0x75, 0xee, 0xed, 0xde, 0xed,
+    0x30, 0x58, 0x95, 0x6e, 0x48, 0xc5, 0x92, 0x57, 0x59, 0x75, 0x96, 0xd9,
+    0x9c, 0x9a, 0x0c, 0x45, 0xce, 0xcd, 0xde, 0xdd, 0x4a, 0xe3, 0x0a, 0x2a,
+    0x54, 0x05, 0x8a, 0x96, 0xad, 0x6a, 0xd6, 0xad, 0x9c, 0x9a, 0x0c, 0x6d,
+    0xdc, 0xfd, 0xdc, 0xfc, 0x5d, 0x75, 0xd7, 0x5d, 0x75, 0xd7, 0x19, 0x82,
+    0xea, 0x1a, 0x20, 0xe8,
+};
+
+const uint8_t kSbcGoldenStereo8[] = {
+    0x9c, 0xf9, 0x33, 0xb4, 0xdd, 0xdd, 0xed, 0xdd, 0xdd, 0xde, 0xdd, 0xdc,
+    0x7d, 0xb6, 0xed, 0xaf, 0x6d, 0xdb, 0x6f, 0xb6, 0xdd, 0xb5, 0xed, 0xbb,
+    0x6e, 0x06, 0xdb, 0xb6, 0xbd, 0xb7, 0x6d, 0xbc, 0xdb, 0x76, 0xd7, 0x36,
+    0xed, 0xaa, 0xa3, 0x4e, 0xd2, 0xc6, 0x99, 0x16, 0x43, 0x65, 0x59, 0x92,
+    0x64, 0x43, 0x5d, 0x66, 0xbb, 0x69, 0xd6, 0x73, 0x27, 0x8c, 0xa3, 0x10,
+    0xa3, 0xb5, 0x03, 0x8d, 0x22, 0xcd, 0x89, 0x28, 0xdd, 0x6c, 0x4b, 0x10,
+    0xa1, 0xce, 0x21, 0x6e, 0xe7, 0x1c, 0x42, 0x95, 0xc9, 0x09, 0x38, 0x93,
+    0x46, 0x65, 0x42, 0xc5, 0x43, 0x56, 0x70, 0xa1, 0x19, 0x0d, 0x06, 0xfb,
+    0x8e, 0x51, 0x6e, 0xe3, 0xb9, 0x24, 0x42, 0x3b, 0x8b, 0xeb, 0x74, 0x15,
+    0x59, 0x37, 0x70, 0xa2, 0x4a, 0x5d, 0x9c, 0xf9, 0x33, 0xdf, 0xdd, 0xce,
+    0xcd, 0xdd, 0xdd, 0xde, 0xdd, 0xdd, 0xae, 0x27, 0x09, 0x27, 0x6d, 0xf1,
+    0x95, 0x94, 0xf5, 0x26, 0xcc, 0xcc, 0x6d, 0x0a, 0x9e, 0xb8, 0x44, 0xb6,
+    0x4d, 0x9f, 0x5b, 0xcb, 0x29, 0x47, 0x05, 0x66, 0x28, 0x46, 0xaa, 0xe5,
+    0x1d, 0xb7, 0x1c, 0x29, 0x51, 0x56, 0xa1, 0x3a, 0xa8, 0x42, 0xe3, 0x94,
+    0xdd, 0x89, 0x2c, 0x2d, 0x53, 0xa8, 0x8b, 0x98, 0xd2, 0x82, 0x24, 0x6a,
+    0x4f, 0x4d, 0x9a, 0x8e, 0xd6, 0x6d, 0xa5, 0xc9, 0x93, 0xa9, 0xc8, 0xe5,
+    0xd8, 0xb9, 0x36, 0x69, 0xb9, 0x26, 0x34, 0x96, 0xa7, 0x6d, 0xb6, 0x95,
+    0x68, 0xa3, 0x16, 0xa5, 0x47, 0x43, 0xc6, 0xa1, 0x66, 0x99, 0x3a, 0xa2,
+    0x8e, 0x5d, 0x8c, 0x13, 0x66, 0x9c, 0x0e, 0x63, 0x49, 0x7a, 0x76, 0xdb,
+    0x9c, 0xf9, 0x33, 0xae, 0xbc, 0xbe, 0xcd, 0xbd, 0xbc, 0xce, 0xbd, 0xcd,
+    0x62, 0x47, 0x6e, 0x19, 0x0a, 0x9a, 0x88, 0x18, 0x4e, 0x92, 0x31, 0xa2,
+    0xa8, 0xc2, 0x99, 0x28, 0x3e, 0xa3, 0x58, 0x84, 0xdd, 0xc6, 0x48, 0xa9,
+    0x25, 0x96, 0xd0, 0x92, 0xd7, 0x0e, 0x24, 0x63, 0x28, 0x6e, 0x9a, 0xb6,
+    0x1b, 0x8d, 0x5c, 0xed, 0xdb, 0x58, 0x3b, 0x75, 0xab, 0xdd, 0xbb, 0x6a,
+    0xf7, 0x6e, 0xb5, 0x7b, 0xb7, 0x6d, 0x60, 0xed, 0xd6, 0xaf, 0x76, 0xed,
+    0xab, 0xdd, 0xba, 0xd5, 0xee, 0xdd, 0xb5, 0x7b, 0xb7, 0x5a, 0xbd, 0xdb,
+    0xb6, 0xaf, 0x76, 0xeb, 0x57, 0xbb, 0x76, 0xd5, 0xee, 0xdd, 0x6a, 0xf7,
+    0x6e, 0xda, 0xbd, 0xdb, 0xad, 0x5e, 0xed, 0xdb, 0x57, 0xbb, 0x75, 0xab,
+    0xdd, 0xbb, 0x6a, 0xf7, 0x6e, 0xb5, 0x9c, 0xf9, 0x33, 0xd1, 0xdb, 0xcb,
+    0xdf, 0xbb, 0xdc, 0xbb, 0xdf, 0xca, 0x7d, 0xbb, 0x77, 0x5f, 0x76, 0xdb,
+    0xaf, 0xb7, 0x6e, 0xeb, 0xee, 0xdb, 0x75, 0xc6, 0xed, 0x9d, 0x85, 0xdb,
+    0x6e, 0xb5, 0x58, 0xcb, 0xb0, 0xbc, 0x31, 0xd1, 0x55, 0xd2, 0x62, 0xfb,
+    0xc0, 0x28, 0x49, 0x7d, 0x16, 0x72, 0xc6, 0xd8, 0x4a, 0x6e, 0xd5, 0x9c,
+    0xdd, 0xb5, 0x69, 0x4d, 0xdc, 0x1b, 0xa3, 0xb6, 0xc9, 0x29, 0xbb, 0x7c,
+    0x74, 0x76, 0xdc, 0x25, 0x37, 0x6c, 0xce, 0x8e, 0xdb, 0xb4, 0xa6, 0xee,
+    0x0d, 0xd1, 0xdb, 0x64, 0x94, 0xdd, 0xbe, 0x3a, 0x3b, 0x72, 0x12, 0x9b,
+    0xb6, 0x67, 0x47, 0x6d, 0xda, 0x53, 0x77, 0x06, 0xe8, 0xed, 0xb2, 0x4a,
+    0x6e, 0xdf, 0x1d, 0x1d, 0xb9, 0x09, 0x4d, 0xdb, 0x33, 0xa3, 0xb6, 0xed,
+    0x9c, 0xf9, 0x33, 0xc6, 0xde, 0xdd, 0xef, 0xde, 0xdd, 0xdc, 0xdf, 0xde,
+    0x2b, 0xb6, 0xe6, 0xb9, 0x6d, 0xb2, 0xa5, 0x76, 0xdf, 0x17, 0x2d, 0xb9,
+    0x14, 0xae, 0xdb, 0x2a, 0xe1, 0xb6, 0xaa, 0x99, 0xdb, 0x84, 0x5b, 0xc6,
+    0x99, 0x16, 0xba, 0x27, 0x22, 0xa5, 0x1b, 0x6c, 0x96, 0x2e, 0x5c, 0x63,
+    0x13, 0x6d, 0x65, 0x79, 0xb3, 0xcb, 0x59, 0xa9, 0xc6, 0x62, 0x17, 0x71,
+    0x73, 0x6d, 0x35, 0x14, 0x22, 0xf0, 0x2b, 0x8b, 0x06, 0xb5, 0x59, 0x0d,
+    0xc6, 0x52, 0x1a, 0xd5, 0x71, 0x4b, 0xba, 0xe2, 0xad, 0x58, 0xc1, 0xc3,
+    0xa7, 0x56, 0x14, 0x93, 0x19, 0x2b, 0x8d, 0x03, 0x04, 0x73, 0x72, 0xd6,
+    0xd1, 0xdd, 0x0a, 0xda, 0x8e, 0x5f, 0x08, 0xbb, 0x8d, 0x4a, 0xad, 0xcd,
+    0x52, 0x26, 0x69, 0xa5, 0x4e, 0xb5, 0x9c, 0xf9, 0x33, 0x30, 0xdc, 0xde,
+    0xde, 0xdd, 0xdc, 0xde, 0xdd, 0xed, 0x96, 0x6d, 0x5a, 0x38, 0x2d, 0xec,
+    0x6d, 0x52, 0x34, 0xb9, 0x55, 0x32, 0x2e, 0xaf, 0x4b, 0x7a, 0x99, 0x37,
+    0x85, 0x6e, 0x37, 0xaf, 0x17, 0x46, 0x91, 0xba, 0x12, 0xd0, 0xda, 0xf2,
+    0x55, 0xab, 0x04, 0xed, 0x3c, 0xa5, 0x2b, 0xc7, 0x22, 0xdd, 0x39, 0x64,
+    0x63, 0xc6, 0x5b, 0xeb, 0x46, 0xd2, 0x7a, 0x6c, 0xd3, 0x7e, 0x66, 0xd9,
+    0x2e, 0x0c, 0x9d, 0x6e, 0xce, 0x5c, 0xc5, 0xc1, 0xb3, 0x4d, 0xd1, 0xe3,
+    0x64, 0xb4, 0xbb, 0x6d, 0xb5, 0x46, 0x8d, 0x16, 0x37, 0x4e, 0xb9, 0xc8,
+    0x6e, 0x0b, 0x08, 0x8e, 0x37, 0x0a, 0xe5, 0xcc, 0x64, 0x5a, 0xa4, 0xe1,
+    0x1e, 0x36, 0x4b, 0xd3, 0xc6, 0x9b, 0x93, 0x76, 0xf0, 0x7b, 0x74, 0xeb,
+    0x9c, 0xf9, 0x33, 0x61, 0xbc, 0xde, 0xbd, 0xdd, 0xcc, 0xce, 0xcc, 0xdc,
+    0x48, 0x64, 0xd5, 0x32, 0xb4, 0x62, 0x48, 0x0d, 0x94, 0xc6, 0x66, 0x6d,
+    0x20, 0x65, 0xe2, 0xdc, 0xd9, 0x29, 0x6a, 0xd2, 0xa9, 0x23, 0x6e, 0xcd,
+    0x6a, 0x89, 0xaa, 0x94, 0x2a, 0xab, 0x5a, 0x5a, 0xd6, 0xde, 0x6d, 0x8b,
+    0x4e, 0xdb, 0x5e, 0xdb, 0xad, 0xaf, 0x6d, 0xdb, 0x6b, 0xdb, 0x75, 0xb5,
+    0xed, 0xbb, 0x6d, 0x7b, 0x6e, 0xb6, 0xbd, 0xb7, 0x6d, 0xaf, 0x6d, 0xd6,
+    0xd7, 0xb6, 0xed, 0xb5, 0xed, 0xba, 0xda, 0xf6, 0xdd, 0xb6, 0xbd, 0xb7,
+    0x5b, 0x5e, 0xdb, 0xb6, 0xd7, 0xb6, 0xeb, 0x6b, 0xdb, 0x76, 0xda, 0xf6,
+    0xdd, 0x6d, 0x7b, 0x6e, 0xdb, 0x5e, 0xdb, 0xad, 0xaf, 0x6d, 0xdb, 0x6b,
+    0xdb, 0x75, 0xb5, 0xed, 0xbb, 0x6d, 0x9c, 0xf9, 0x33, 0xd1, 0xdb, 0xcb,
+    0xdf, 0xbb, 0xdc, 0xbb, 0xdf, 0xca, 0x7d, 0xbb, 0x77, 0x5f, 0x76, 0xdb,
+    0xaf, 0xb7, 0x6e, 0xeb, 0xee, 0xdb, 0x75, 0xc6, 0xed, 0x9d, 0x86, 0x1b,
+    0x6e, 0xb5, 0x58, 0xcb, 0xb0, 0xbc, 0x31, 0xd1, 0x55, 0xd2, 0x62, 0xfb,
+    0xc0, 0x28, 0x49, 0x7d, 0x16, 0x72, 0xc6, 0xd8, 0x4a, 0x6e, 0xd5, 0x9c,
+    0xdd, 0xb5, 0x69, 0x4d, 0xdc, 0x1b, 0xa3, 0xb6, 0xc9, 0x29, 0xbb, 0x7c,
+    0x74, 0x76, 0xdc, 0x25, 0x37, 0x6c, 0xce, 0x8e, 0xdb, 0xb4, 0xa6, 0xee,
+    0x0d, 0xd1, 0xdb, 0x64, 0x94, 0xdd, 0xbe, 0x3a, 0x3b, 0x72, 0x12, 0x9b,
+    0xb6, 0x67, 0x47, 0x6d, 0xda, 0x53, 0x77, 0x06, 0xe8, 0xed, 0xb2, 0x4a,
+    0x6e, 0xdf, 0x1d, 0x1d, 0xb9, 0x09, 0x4d, 0xdb, 0x33, 0xa3, 0xb6, 0xed,
+};
+
+const uint8_t kSbcGoldenJointStereo8[] = {
+    0x9c, 0xbd, 0x35, 0xff, 0xbc, 0xcc, 0xdd, 0xcc, 0xdd, 0xcd, 0xdd, 0xcd,
+    0xdd, 0x7d, 0xdb, 0x6d, 0xaf, 0xb6, 0xdb, 0x6b, 0xee, 0xdb, 0x6d, 0x7d,
+    0xb6, 0xdb, 0x61, 0x76, 0xdb, 0x6b, 0xed, 0xb6, 0xdb, 0x0a, 0xb6, 0xdb,
+    0x62, 0x6d, 0xb6, 0xdc, 0xd9, 0x26, 0xd0, 0xf3, 0x69, 0x36, 0xcd, 0x91,
+    0xd5, 0x55, 0x42, 0x6d, 0x95, 0xc9, 0x24, 0xc8, 0xe4, 0xcd, 0x48, 0xdd,
+    0x4c, 0x58, 0xb7, 0x46, 0xd3, 0x32, 0x71, 0x95, 0x4e, 0x2c, 0x98, 0xcc,
+    0x4c, 0x20, 0xdb, 0x61, 0x6b, 0x44, 0x99, 0x63, 0x3c, 0x46, 0x8f, 0x95,
+    0xb9, 0x40, 0xe6, 0x36, 0x94, 0xb0, 0x2d, 0xa2, 0x40, 0x66, 0x94, 0x59,
+    0x35, 0x90, 0xb6, 0xa8, 0x6d, 0x34, 0x96, 0xd2, 0x4e, 0xc6, 0xb4, 0x6a,
+    0xb9, 0x34, 0x53, 0xac, 0xb3, 0xbc, 0x4e, 0x32, 0xd5, 0x21, 0x81, 0x9c,
+    0xbd, 0x35, 0x46, 0xf6, 0xdc, 0xde, 0xcc, 0xdd, 0xbd, 0xdd, 0xcc, 0xcd,
+    0x61, 0xa3, 0x32, 0x96, 0x2c, 0xb2, 0x95, 0xcd, 0x98, 0xb8, 0xd9, 0x24,
+    0x68, 0x5a, 0x36, 0xe9, 0x82, 0x49, 0x58, 0x6c, 0x6d, 0xb7, 0x11, 0xb1,
+    0x04, 0x92, 0x48, 0x51, 0xb0, 0x72, 0x0d, 0x27, 0x04, 0xb6, 0xcc, 0xeb,
+    0x4e, 0xe5, 0xc8, 0x1a, 0x85, 0x73, 0x24, 0xa0, 0xca, 0xe4, 0x30, 0xc3,
+    0xb7, 0x10, 0xe7, 0x69, 0xe5, 0x82, 0x1a, 0xb3, 0x27, 0xcb, 0x51, 0x23,
+    0xae, 0xcd, 0xc4, 0xbe, 0x9b, 0x65, 0x9c, 0x76, 0xed, 0xc5, 0xd4, 0xea,
+    0xc8, 0xdb, 0x3c, 0x65, 0x30, 0x96, 0xda, 0x27, 0xdd, 0xbc, 0x91, 0x2b,
+    0x44, 0x0a, 0xce, 0xb0, 0x95, 0x2c, 0x21, 0xb6, 0x8a, 0x17, 0x70, 0xe4,
+    0x61, 0x4e, 0xac, 0x90, 0x33, 0xc6, 0x52, 0xf8, 0x6d, 0xa2, 0x9c, 0xbd,
+    0x35, 0xf2, 0xfc, 0xba, 0xce, 0xbc, 0xbd, 0xac, 0xac, 0xbc, 0xcd, 0x61,
+    0x78, 0xb9, 0x0f, 0x5c, 0x2c, 0xa2, 0x13, 0x99, 0xc2, 0x79, 0x44, 0x7a,
+    0x8c, 0xd9, 0x2c, 0xc3, 0x85, 0xea, 0x42, 0x57, 0x16, 0x70, 0x92, 0x66,
+    0xe9, 0x99, 0xd3, 0x98, 0x6a, 0x59, 0xcc, 0x60, 0xc2, 0xbb, 0xcb, 0x5a,
+    0x3a, 0x76, 0xd5, 0xed, 0x9e, 0xda, 0xb9, 0xdb, 0xb6, 0xaf, 0x6e, 0xf6,
+    0xd6, 0x0e, 0xdd, 0xb5, 0x7b, 0x77, 0xb6, 0xaf, 0x76, 0xed, 0xab, 0xdb,
+    0xbd, 0xb5, 0x7b, 0xb7, 0x6d, 0x5e, 0xdd, 0xed, 0xab, 0xdd, 0xbb, 0x6a,
+    0xf6, 0xef, 0x6d, 0x5e, 0xed, 0xdb, 0x57, 0xb7, 0x7b, 0x6a, 0xf7, 0x6e,
+    0xda, 0xbd, 0xbb, 0xdb, 0x57, 0xbb, 0x76, 0xd5, 0xed, 0xde, 0xda, 0xb9,
+    0xdb, 0xb6, 0xaf, 0x6e, 0xf6, 0xd5, 0xee, 0xdd, 0xb5, 0x9c, 0xbd, 0x35,
+    0xa3, 0xee, 0xba, 0xbb, 0xdf, 0xcb, 0xdb, 0xab, 0xbe, 0xaa, 0x7b, 0x6d,
+    0xde, 0xd7, 0xdb, 0x6d, 0xeb, 0xdb, 0x6e, 0xf6, 0xbe, 0xdb, 0x6f, 0x5c,
+    0xdb, 0x67, 0xb5, 0xd6, 0xdb, 0x7a, 0xca, 0xcc, 0xbd, 0xae, 0x42, 0x63,
+    0xe3, 0x6d, 0x45, 0x64, 0x28, 0xc1, 0x23, 0x4c, 0x2d, 0x35, 0x48, 0xee,
+    0xd1, 0x61, 0xcd, 0xb5, 0x93, 0x4a, 0x6d, 0xb2, 0xaf, 0x6d, 0xb9, 0x9a,
+    0x53, 0x6e, 0x49, 0x7b, 0x6e, 0x2a, 0xd2, 0x9b, 0x6a, 0xcb, 0xdb, 0x6d,
+    0x16, 0x94, 0xdb, 0x65, 0x5e, 0xdb, 0x73, 0x34, 0xa6, 0xdc, 0x92, 0xf6,
+    0xdc, 0x55, 0xa5, 0x36, 0xd5, 0x97, 0xb6, 0xda, 0x2d, 0x29, 0xb6, 0xca,
+    0xbd, 0xb6, 0xe6, 0x69, 0x4d, 0xb9, 0x25, 0xed, 0xb8, 0xab, 0x4a, 0x6d,
+    0xab, 0x2f, 0x6d, 0xb4, 0x5a, 0x53, 0x6d, 0x95, 0x9c, 0xbd, 0x35, 0x4e,
+    0x5e, 0xdc, 0xdd, 0xdf, 0xdd, 0xdd, 0xdd, 0xde, 0xcd, 0x29, 0xb6, 0xcd,
+    0xba, 0x36, 0xdc, 0x29, 0x4d, 0xb7, 0x4d, 0xd1, 0xb6, 0xed, 0x4d, 0x6d,
+    0xa8, 0x6e, 0x2d, 0xb6, 0x4a, 0x5b, 0x8d, 0x9a, 0x6f, 0x6d, 0xc9, 0x5a,
+    0x2d, 0x22, 0x0a, 0xdd, 0x2c, 0xcb, 0x3a, 0xab, 0x6c, 0xd3, 0x64, 0x8d,
+    0xe5, 0x0a, 0xa3, 0x76, 0xd4, 0xed, 0x70, 0x26, 0x42, 0x9b, 0xb4, 0xd7,
+    0x2a, 0x85, 0x86, 0xb7, 0x18, 0xaf, 0xb8, 0xdb, 0x2d, 0x49, 0x06, 0xe9,
+    0xdd, 0x16, 0xa0, 0x60, 0xba, 0x27, 0x71, 0xed, 0x38, 0xf2, 0xd5, 0x8a,
+    0x3b, 0x5c, 0x51, 0x26, 0x56, 0xb3, 0x8a, 0x11, 0x3b, 0xcd, 0xc4, 0xbc,
+    0xf4, 0x6e, 0xdd, 0x94, 0x6e, 0x2a, 0x95, 0x52, 0x74, 0xab, 0x54, 0x6f,
+    0x29, 0xe4, 0xa3, 0x30, 0x48, 0x53, 0x92, 0x9c, 0xbd, 0x35, 0x34, 0xbe,
+    0xcc, 0xde, 0xcc, 0xcd, 0xdd, 0xcd, 0xdc, 0xcd, 0x56, 0x1c, 0xb4, 0x34,
+    0x3d, 0x8a, 0x23, 0x4a, 0xe1, 0x55, 0xcd, 0xa2, 0xcd, 0x6b, 0x62, 0xd5,
+    0x29, 0xe8, 0x64, 0x83, 0xce, 0x37, 0x8e, 0x56, 0x71, 0x1c, 0x9a, 0x19,
+    0xa9, 0x6b, 0x08, 0x36, 0xd0, 0xcc, 0x72, 0xa3, 0xa8, 0xa0, 0x56, 0x86,
+    0x68, 0x76, 0xd8, 0x3c, 0xe9, 0x3c, 0xb0, 0xe3, 0x56, 0x69, 0xf5, 0x49,
+    0xa4, 0x77, 0x99, 0xb8, 0x2f, 0xa3, 0x6c, 0xb3, 0x38, 0xdd, 0xb9, 0x7d,
+    0x1d, 0x79, 0x18, 0xa7, 0x8c, 0xac, 0x0b, 0x1b, 0x44, 0xaa, 0x38, 0x91,
+    0x60, 0x78, 0x59, 0x8a, 0x61, 0x9b, 0x63, 0x1c, 0x66, 0xa0, 0xd3, 0x8d,
+    0xd3, 0x97, 0x52, 0x57, 0x92, 0x08, 0x78, 0xca, 0xc0, 0xd1, 0xb6, 0x4e,
+    0xa3, 0x87, 0x11, 0xf7, 0x89, 0x98, 0x9c, 0xbd, 0x35, 0xa9, 0xf6, 0xba,
+    0xce, 0xbc, 0xcd, 0xac, 0xbc, 0xcc, 0xcc, 0x4a, 0x73, 0x36, 0xcf, 0x28,
+    0x8f, 0x12, 0x1b, 0x25, 0x14, 0x70, 0xbc, 0x6a, 0x0e, 0x9e, 0xf2, 0x51,
+    0xd1, 0x5a, 0x23, 0xac, 0x74, 0x15, 0x49, 0x30, 0xf3, 0x85, 0xdb, 0x5d,
+    0x63, 0xe4, 0xcb, 0x68, 0xc1, 0x2b, 0xe4, 0x54, 0xbb, 0x86, 0xd5, 0xce,
+    0x1e, 0xda, 0xc1, 0xdb, 0xb6, 0xaf, 0x6e, 0xf6, 0xd5, 0xee, 0xdd, 0xb5,
+    0x7b, 0x77, 0xb6, 0xaf, 0x76, 0xed, 0xab, 0xdb, 0xbd, 0xb5, 0x7b, 0xb7,
+    0x6d, 0x5e, 0xdd, 0xed, 0xab, 0xdd, 0xbb, 0x6a, 0xf6, 0xef, 0x6d, 0x5e,
+    0xed, 0xdb, 0x57, 0xb7, 0x7b, 0x6a, 0xf7, 0x6e, 0xda, 0xbd, 0xbb, 0xdb,
+    0x57, 0xbb, 0x76, 0xd5, 0xed, 0xde, 0xda, 0xbd, 0xdb, 0xb6, 0xaf, 0x6e,
+    0xf6, 0xd5, 0xee, 0xdd, 0xb5, 0x9c, 0xbd, 0x35, 0xa3, 0xee, 0xba, 0xbb,
+    0xdf, 0xcb, 0xdb, 0xab, 0xbe, 0xaa, 0x7b, 0x6d, 0xde, 0xd7, 0xdb, 0x6d,
+    0xeb, 0xdb, 0x6e, 0xf6, 0xbe, 0xdb, 0x6f, 0x5c, 0xdb, 0x67, 0xb5, 0xd6,
+    0xdb, 0x7a, 0xca, 0xcc, 0xbd, 0xae, 0x42, 0x63, 0xe3, 0x6d, 0x45, 0x64,
+    0x28, 0xc1, 0x23, 0x4c, 0x2d, 0x35, 0x48, 0xee, 0xd1, 0x61, 0xcd, 0xb5,
+    0x93, 0x4a, 0x6d, 0xb2, 0xaf, 0x6d, 0xb9, 0x9a, 0x53, 0x6e, 0x49, 0x7b,
+    0x6e, 0x2a, 0xd2, 0x9b, 0x6a, 0xcb, 0xdb, 0x6d, 0x16, 0x94, 0xdb, 0x65,
+    0x5e, 0xdb, 0x73, 0x34, 0xa6, 0xdc, 0x92, 0xf6, 0xdc, 0x55, 0xa5, 0x36,
+    0xd5, 0x97, 0xb6, 0xda, 0x2d, 0x29, 0xb6, 0xca, 0xbd, 0xb6, 0xe6, 0x69,
+    0x4d, 0xb9, 0x25, 0xed, 0xb8, 0xab, 0x4a, 0x6d, 0xab, 0x2f, 0x6d, 0xb4,
+    0x5a, 0x53, 0x6d, 0x95,
+};
+
+const uint8_t kSbcGoldenJointStereo4[] = {
+    0x9c, 0xfe, 0x10, 0x90, 0xed, 0xdd, 0xed, 0xdd, 0xe5, 0x55, 0x55, 0x55,
+    0x55, 0x55, 0x55, 0x55, 0x55, 0x59, 0x52, 0x65, 0x59, 0x55, 0x59, 0x45,
+    0x55, 0xa6, 0x1a, 0x56, 0x95, 0x24, 0x51, 0x26, 0x61, 0x54, 0x55, 0x58,
+    0x15, 0x4a, 0x40, 0x58, 0x50, 0x9c, 0xfe, 0x10, 0x0d, 0xed, 0xed, 0xed,
+    0xdd, 0xd5, 0xb5, 0x59, 0x88, 0x46, 0x0d, 0x59, 0xd2, 0x06, 0x35, 0x46,
+    0xa9, 0x56, 0x29, 0x25, 0xcd, 0x55, 0x31, 0x04, 0xb0, 0x55, 0x29, 0x56,
+    0x31, 0xa6, 0xb1, 0x56, 0xad, 0x56, 0x29, 0x25, 0xcd, 0x50, 0x9c, 0xfe,
+    0x10, 0xbe, 0xcb, 0xed, 0xdc, 0xcc, 0xd4, 0x56, 0x12, 0x90, 0x63, 0x66,
+    0x96, 0x08, 0x89, 0x4d, 0x57, 0x6d, 0x57, 0x6d, 0x57, 0x6d, 0x57, 0x6d,
+    0x57, 0x6d, 0x57, 0x6d, 0x57, 0x6d, 0x57, 0x6d, 0x57, 0x6d, 0x57, 0x6d,
+    0x57, 0x6d, 0x50, 0x9c, 0xfe, 0x10, 0x1d, 0xac, 0xcf, 0xdd, 0xce, 0xc5,
+    0x75, 0xb5, 0x75, 0xb5, 0x75, 0xb6, 0x75, 0xb0, 0x70, 0xa4, 0xb4, 0x45,
+    0x44, 0xd5, 0x64, 0x95, 0xb4, 0xc5, 0x44, 0xd5, 0x64, 0x95, 0xb4, 0xc5,
+    0x44, 0xd5, 0x64, 0x95, 0xb4, 0xc5, 0x44, 0xd0, 0x9c, 0xfe, 0x10, 0x7e,
+    0x6e, 0xdf, 0xdd, 0xde, 0xe4, 0xa9, 0x14, 0xd9, 0x54, 0xa9, 0x94, 0xb9,
+    0x18, 0xc9, 0x46, 0x35, 0x55, 0x35, 0x59, 0x31, 0x48, 0xb0, 0x9c, 0xb1,
+    0x55, 0x34, 0x64, 0xb6, 0x18, 0xb6, 0x57, 0x26, 0x54, 0x35, 0x54, 0xb9,
+    0x50, 0x9c, 0xfe, 0x10, 0x22, 0x4d, 0xed, 0xdd, 0xdd, 0xd9, 0x11, 0x4a,
+    0xc0, 0x94, 0xc0, 0x5c, 0xca, 0x48, 0xc0, 0x64, 0x82, 0x89, 0x18, 0x87,
+    0x59, 0x57, 0x45, 0x57, 0x21, 0x04, 0xe5, 0x68, 0x88, 0x22, 0x55, 0x48,
+    0x50, 0x62, 0x81, 0x97, 0x5a, 0x50, 0x9c, 0xfe, 0x10, 0xdd, 0xec, 0xed,
+    0xdc, 0xdc, 0xda, 0xd5, 0x6a, 0x91, 0x15, 0xe5, 0x49, 0x1a, 0x19, 0x14,
+    0x61, 0xd5, 0x55, 0xd5, 0x55, 0xd5, 0x55, 0xd5, 0x55, 0xd5, 0x55, 0xd5,
+    0x55, 0xd5, 0x55, 0xd5, 0x55, 0xd5, 0x55, 0xd5, 0x55, 0xd5, 0x50, 0x9c,
+    0xfe, 0x10, 0x1d, 0xac, 0xcf, 0xdd, 0xce, 0xc5, 0x75, 0xb5, 0x75, 0xb5,
+    0x75, 0xb6, 0x75, 0xb0, 0x70, 0xa4, 0xb4, 0x45, 0x44, 0xd5, 0x64, 0x95,
+    0xb4, 0xc5, 0x44, 0xd5, 0x64, 0x95, 0xb4, 0xc5, 0x44, 0xd5, 0x64, 0x95,
+    0xb4, 0xc5, 0x44, 0xd0,
+};
@@ -0,0 +1,137 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <vector>
+
+#include "sbc_encoder.h"
+#include "stack/test/a2dp/a2dp_sbc_encoder_golden.h"
+
+namespace {
+
+constexpr int kFramesPerStream = 8;
+constexpr size_t kMaxPcmSamplesPerFrame = SBC_MAX_NUM_OF_BLOCKS *
+                                          SBC_MAX_NUM_OF_SUBBANDS *
+                                          SBC_MAX_NUM_OF_CHANNELS;
+// Larger than any frame produced with the bit rates below
+constexpr size_t kMaxFrameBytes = 1024;
+
+struct SbcConfig {
+  int16_t sampling_freq;
+  int16_t channel_mode;
+  int16_t num_of_subbands;
+  int16_t num_of_blocks;
+  int16_t allocation_method;
+  uint16_t bit_rate;
+};
+
+// Fills |pcm| for frame |frame| of a stream, cycling through full scale
+// noise, a ramp, quiet noise and a full scale square wave. The noise is a
+// fixed LCG, so that the input is the same with any C library.
+void MakePcm(int frame, int samples, int16_t* pcm, uint32_t* p_state) {
+  for (int i = 0; i < samples; i++) {
+    switch (frame % 4) {
+      case 0:
+        *p_state = *p_state * 1664525u + 1013904223u;
+        pcm[i] = (int16_t)(*p_state >> 16);
+        break;
+      case 1:
+        pcm[i] = (int16_t)((frame * samples + i) * 7217);
+        break;
+      case 2:
+        *p_state = *p_state * 1664525u + 1013904223u;
+        pcm[i] = (int16_t)(*p_state >> 16) >> 7;
+        break;
+      default:
+        pcm[i] = ((i / 3) & 1) ? 32767 : -32768;
+        break;
+    }
+  }
+}
+
+std::vector<uint8_t> EncodeStream(const SbcConfig& config) {
+  SBC_ENC_PARAMS params = {};
+  params.s16SamplingFreq = config.sampling_freq;
+  params.s16ChannelMode = config.channel_mode;
+  params.s16NumOfSubBands = config.num_of_subbands;
+  params.s16NumOfBlocks = config.num_of_blocks;
+  params.s16AllocationMethod = config.allocation_method;
+  params.u16BitRate = config.bit_rate;
+  SBC_Encoder_Init(&params);
+
+  const int samples = config.num_of_blocks * config.num_of_subbands *
+                      (config.channel_mode == SBC_MONO ? 1 : 2);
+  std::vector<uint8_t> stream;
+  int16_t pcm[kMaxPcmSamplesPerFrame];
+  uint8_t frame[kMaxFrameBytes];
+  uint32_t state = config.bit_rate;
+  for (int f = 0; f < kFramesPerStream; f++) {
+    MakePcm(f, samples, pcm, &state);
+    uint32_t length = SBC_Encode(&params, pcm, frame);
+    stream.insert(stream.end(), frame, frame + length);
+  }
+  return stream;
+}
+
+struct GoldenStream {
+  SbcConfig config;
+  const uint8_t* data;
+  size_t size;
+};
+
+const GoldenStream kGoldenStreams[] = {
+    {{SBC_sf16000, SBC_MONO, SUB_BANDS_4, 4, SBC_LOUDNESS, 128},
+     kSbcGoldenMono4,
+     sizeof(kSbcGoldenMono4)},
+    {{SBC_sf32000, SBC_MONO, SUB_BANDS_8, 16, SBC_SNR, 128},
+     kSbcGoldenMono8,
+     sizeof(kSbcGoldenMono8)},
+    {{SBC_sf44100, SBC_DUAL, SUB_BANDS_8, 12, SBC_LOUDNESS, 300},
+     kSbcGoldenDual8,
+     sizeof(kSbcGoldenDual8)},
+    {{SBC_sf44100, SBC_STEREO, SUB_BANDS_4, 8, SBC_SNR, 229},
+     kSbcGoldenStereo4,
+     sizeof(kSbcGoldenStereo4)},
+    {{SBC_sf48000, SBC_STEREO, SUB_BANDS_8, 16, SBC_LOUDNESS, 345},
+     kSbcGoldenStereo8,
+     sizeof(kSbcGoldenStereo8)},
+    {{SBC_sf44100, SBC_JOINT_STEREO, SUB_BANDS_8, 16, SBC_LOUDNESS, 328},
+     kSbcGoldenJointStereo8,
+     sizeof(kSbcGoldenJointStereo8)},
+    {{SBC_sf48000, SBC_JOINT_STEREO, SUB_BANDS_4, 16, SBC_SNR, 250},
+     kSbcGoldenJointStereo4,
+     sizeof(kSbcGoldenJointStereo4)},
+};
+
+}  // namespace
+
+class A2dpSbcEncoderTest : public ::testing::TestWithParam<GoldenStream> {};
+
+// The reference frames come from the scalar encoder, before the NEON and SSE2
+// analysis and bit allocation were added: both must encode the same bits.
+TEST_P(A2dpSbcEncoderTest, output_matches_reference_frames) {
+  const GoldenStream& golden = GetParam();
+  std::vector<uint8_t> stream = EncodeStream(golden.config);
+
+  ASSERT_EQ(golden.size, stream.size());
+  for (size_t i = 0; i < stream.size(); i++) {
+    ASSERT_EQ(golden.data[i], stream[i]) << "at byte " << i;
+  }
+}
+
+INSTANTIATE_TEST_CASE_P(SbcConfigs, A2dpSbcEncoderTest,
+                        ::testing::ValuesIn(kGoldenStreams));
@@ -129,6 +129,49 @@ TEST(AdvertiseDataParserTest, GetFieldByType) {
   EXPECT_EQ(0, p_length);
 }
 
+// This test makes sure that Fields walks every AD structure in order, and
+// stops at zero padding and at a structure with a bad length.
+TEST(AdvertiseDataParserTest, Fields) {
+  const std::vector<uint8_t> data0{0x02, 0x01, 0x06, 0x03, 0x19,
+                                   0x80, 0x00, 0x01, 0x09};
+
+  std::vector<AdvertiseDataParser::Field> fields;
+  for (const auto& field : AdvertiseDataParser::Fields(data0)) {
+    fields.push_back(field);
+  }
+  ASSERT_EQ(3U, fields.size());
+  EXPECT_EQ(0x01, fields[0].type);
+  EXPECT_EQ(data0.data() + 2, fields[0].data);
+  EXPECT_EQ(1, fields[0].length);
+  EXPECT_EQ(0x19, fields[1].type);
+  EXPECT_EQ(data0.data() + 5, fields[1].data);
+  EXPECT_EQ(2, fields[1].length);
+  EXPECT_EQ(0x09, fields[2].type);
+  EXPECT_EQ(0, fields[2].length);
+
+  // Zero padding after the first field.
+  const std::vector<uint8_t> data1{0x02, 0x01, 0x06, 0x00, 0x00};
+  size_t count = 0;
+  for (const auto& field : AdvertiseDataParser::Fields(data1)) {
+    EXPECT_EQ(0x01, field.type);
+    count++;
+  }
+  EXPECT_EQ(1U, count);
+
+  // Second field length too long.
+  const std::vector<uint8_t> data2{0x02, 0x02, 0x00, 0x03, 0x00};
+  count = 0;
+  for (const auto& field : AdvertiseDataParser::Fields(data2)) {
+    EXPECT_EQ(0x02, field.type);
+    count++;
+  }
+  EXPECT_EQ(1U, count);
+
+  // Empty data.
+  auto empty = AdvertiseDataParser::Fields(nullptr, 0);
+  EXPECT_FALSE(empty.begin() != empty.end());
+}
+
 // This test makes sure that RemoveTrailingZeros is working correctly. It does
 // run the RemoveTrailingZeros for ad data, then glue scan response at end of
 // it, and checks that the resulting data is good.
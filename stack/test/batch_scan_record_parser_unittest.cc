@@ -0,0 +1,113 @@
+/******************************************************************************
+ *
+ *  Copyright 2020 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+#include "batch_scan_record_parser.h"
+
+namespace {
+
+std::vector<uint8_t> TruncatedRecord(uint8_t last_address_byte, int8_t rssi) {
+  return {last_address_byte, 0x02, 0x03, 0x04, 0x05, 0x06,
+          0x01 /* addr_type */, 0xf6 /* tx_power */, (uint8_t)rssi,
+          0x34, 0x12 /* timestamp */};
+}
+
+std::vector<uint8_t> FullRecord(const std::vector<uint8_t>& adv_data,
+                                const std::vector<uint8_t>& scan_rsp) {
+  std::vector<uint8_t> record = TruncatedRecord(0x01, -40);
+  record.push_back(adv_data.size());
+  record.insert(record.end(), adv_data.begin(), adv_data.end());
+  record.push_back(scan_rsp.size());
+  record.insert(record.end(), scan_rsp.begin(), scan_rsp.end());
+  return record;
+}
+
+}  // namespace
+
+TEST(BatchScanRecordParserTest, TruncatedRecords) {
+  std::vector<uint8_t> data = TruncatedRecord(0x01, -40);
+  std::vector<uint8_t> second = TruncatedRecord(0x02, -80);
+  data.insert(data.end(), second.begin(), second.end());
+
+  std::vector<BatchScanRecordParser::Record> records;
+  for (const auto& record : BatchScanRecordParser::Records(
+           BatchScanRecordParser::kTruncated, data)) {
+    records.push_back(record);
+  }
+
+  ASSERT_EQ(records.size(), 2u);
+  EXPECT_EQ(records[0].address, data.data());
+  EXPECT_EQ(records[0].addr_type, 0x01);
+  EXPECT_EQ(records[0].tx_power, -10);
+  EXPECT_EQ(records[0].rssi, -40);
+  EXPECT_EQ(records[0].timestamp, 0x1234);
+  EXPECT_EQ(records[0].adv_data_len, 0);
+  EXPECT_EQ(records[1].address[0], 0x02);
+  EXPECT_EQ(records[1].rssi, -80);
+  EXPECT_EQ(records[1].length, BatchScanRecordParser::kTruncatedRecordLength);
+}
+
+TEST(BatchScanRecordParserTest, FullRecords) {
+  std::vector<uint8_t> data = FullRecord({0x02, 0x01, 0x06}, {});
+  std::vector<uint8_t> second = FullRecord({}, {0x03, 0x09, 'a', 'b'});
+  data.insert(data.end(), second.begin(), second.end());
+
+  std::vector<BatchScanRecordParser::Record> records;
+  for (const auto& record :
+       BatchScanRecordParser::Records(BatchScanRecordParser::kFull, data)) {
+    records.push_back(record);
+  }
+
+  ASSERT_EQ(records.size(), 2u);
+  EXPECT_EQ(records[0].adv_data_len, 3);
+  EXPECT_EQ(records[0].adv_data[2], 0x06);
+  EXPECT_EQ(records[0].scan_rsp_len, 0);
+  EXPECT_EQ(records[0].length, 16u);
+  EXPECT_EQ(records[1].adv_data_len, 0);
+  EXPECT_EQ(records[1].scan_rsp_len, 4);
+  EXPECT_EQ(records[1].scan_rsp[3], 'b');
+  EXPECT_EQ(records[1].data, data.data() + 16);
+}
+
+TEST(BatchScanRecordParserTest, StopsAtPartialRecord) {
+  std::vector<uint8_t> data = FullRecord({0x02, 0x01, 0x06}, {0x00});
+  std::vector<uint8_t> second = FullRecord({0x02, 0x01, 0x06}, {0x00});
+  /* The scan response of the second record is cut */
+  data.insert(data.end(), second.begin(), second.end() - 1);
+
+  size_t count = 0;
+  for (const auto& record :
+       BatchScanRecordParser::Records(BatchScanRecordParser::kFull, data)) {
+    EXPECT_EQ(record.length, 17u);
+    count++;
+  }
+  EXPECT_EQ(count, 1u);
+
+  std::vector<uint8_t> truncated = TruncatedRecord(0x01, -40);
+  truncated.pop_back();
+  EXPECT_EQ(BatchScanRecordParser::RecordLength(
+                BatchScanRecordParser::kTruncated, truncated.data(),
+                truncated.size()),
+            0u);
+}
+
+TEST(BatchScanRecordParserTest, UnknownFormat) {
+  std::vector<uint8_t> data = TruncatedRecord(0x01, -40);
+  EXPECT_EQ(BatchScanRecordParser::Records(3, data).begin(),
+            BatchScanRecordParser::Records(3, data).end());
+}
@@ -135,6 +135,12 @@ class AdvertiserHciMock : public BleAdvertiserHciInterface {
 
   bool QuirkAdvertiserZeroHandle() override { return false; }
 
+  bool SupportsMultipleSetEnable() override {
+    return multiple_set_enable_supported;
+  }
+
+  bool multiple_set_enable_supported = true;
+
  private:
   DISALLOW_COPY_AND_ASSIGN(AdvertiserHciMock);
 };
@@ -175,6 +181,35 @@ class BleAdvertisingManagerTest : public testing::Test {
     hci_mock.reset();
   }
 
+  // Registers |count| advertisers and enables them. The first
+  // |connectable_count| ones are connectable.
+  void RegisterAndEnableAdvertisers(int count, int connectable_count) {
+    EXPECT_CALL(*hci_mock, SetParameters1(_, _, _, _, _, _, _, _, _))
+        .Times(count);
+    EXPECT_CALL(*hci_mock, SetParameters2(_, _, _, _, _, _, _, _))
+        .Times(count);
+    EXPECT_CALL(*hci_mock, Enable(0x01 /* enable */, SizeIs(1), _))
+        .Times(count);
+
+    for (int i = 0; i < count; i++) {
+      BleAdvertisingManager::Get()->RegisterAdvertiser(Bind(
+          &BleAdvertisingManagerTest::RegistrationCb, base::Unretained(this)));
+      EXPECT_EQ(BTM_BLE_MULTI_ADV_SUCCESS, reg_status);
+
+      tBTM_BLE_ADV_PARAMS params = {};
+      params.advertising_event_properties = i < connectable_count ? 0x1 : 0x0;
+      BleAdvertisingManager::Get()->SetParameters(
+          reg_inst_id, &params,
+          Bind(&BleAdvertisingManagerTest::SetParametersCb,
+               base::Unretained(this)));
+      BleAdvertisingManager::Get()->Enable(
+          reg_inst_id, true,
+          Bind(&BleAdvertisingManagerTest::EnableCb, base::Unretained(this)),
+          0, 0, Bind(DoNothing));
+    }
+    ::testing::Mock::VerifyAndClearExpectations(hci_mock.get());
+  }
+
  public:
   void RegistrationCb(uint8_t inst_id, uint8_t status) {
     reg_inst_id = inst_id;
@@ -1105,6 +1140,53 @@ TEST_F(BleAdvertisingManagerTest, test_cleanup_during_execution) {
   ::testing::Mock::VerifyAndClearExpectations(hci_mock.get());
 }
 
+/* This test makes sure that the random addresses of all advertisers are
+ * updated together, with the connectable ones disabled by one command around
+ * the update */
+TEST_F(BleAdvertisingManagerTest, test_batched_address_update) {
+  RegisterAndEnableAdvertisers(4, 3);
+
+  {
+    ::testing::InSequence sequence;
+    EXPECT_CALL(
+        *hci_mock,
+        Enable(0x00 /* disable */,
+               AllOf(SizeIs(3), Contains(Field(&SetEnableData::handle, 0)),
+                     Contains(Field(&SetEnableData::handle, 1)),
+                     Contains(Field(&SetEnableData::handle, 2))),
+               _))
+        .Times(1);
+    EXPECT_CALL(*hci_mock, SetRandomAddress(_, _, _)).Times(4);
+    EXPECT_CALL(
+        *hci_mock,
+        Enable(0x01 /* enable */,
+               AllOf(SizeIs(3), Contains(Field(&SetEnableData::handle, 0)),
+                     Contains(Field(&SetEnableData::handle, 1)),
+                     Contains(Field(&SetEnableData::handle, 2))),
+               _))
+        .Times(1);
+  }
+
+  TriggerRandomAddressUpdate();
+  ::testing::Mock::VerifyAndClearExpectations(hci_mock.get());
+}
+
+/* Same as above, for controllers that take only one set per enable command */
+TEST_F(BleAdvertisingManagerTest, test_batched_address_update_single_set) {
+  hci_mock->multiple_set_enable_supported = false;
+  RegisterAndEnableAdvertisers(4, 3);
+
+  {
+    ::testing::InSequence sequence;
+    EXPECT_CALL(*hci_mock, Enable(0x00 /* disable */, SizeIs(1), _)).Times(3);
+    EXPECT_CALL(*hci_mock, SetRandomAddress(_, _, _)).Times(4);
+    EXPECT_CALL(*hci_mock, Enable(0x01 /* enable */, SizeIs(1), _)).Times(3);
+  }
+
+  TriggerRandomAddressUpdate();
+  ::testing::Mock::VerifyAndClearExpectations(hci_mock.get());
+}
+
 extern void testRecomputeTimeout1();
 extern void testRecomputeTimeout2();
 extern void testRecomputeTimeout3();
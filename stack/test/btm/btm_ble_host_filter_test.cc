@@ -0,0 +1,190 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <vector>
+
+#include "btm_ble_int.h"
+
+using bluetooth::Uuid;
+
+bool osi_property_get_bool(const char* key, bool default_value) {
+  return true;
+}
+
+namespace {
+
+const RawAddress kAddress({0x11, 0x22, 0x33, 0x44, 0x55, 0x66});
+const RawAddress kOtherAddress({0x11, 0x22, 0x33, 0x44, 0x55, 0x67});
+
+/* Filters with one selected feature, the conditions of a feature in OR */
+void SetParams(uint8_t filt_index, uint16_t feat_seln,
+               int8_t rssi_high_thres = -128) {
+  btgatt_filt_param_setup_t params = {};
+  params.feat_seln = feat_seln;
+  params.filt_logic_type = BTM_BLE_PF_LOGIC_AND;
+  params.rssi_high_thres = (uint8_t)rssi_high_thres;
+  btm_ble_host_filter_set_params(BTM_BLE_SCAN_COND_ADD, filt_index, &params);
+}
+
+ApcfCommand Command(uint8_t type) {
+  ApcfCommand cmd = {};
+  cmd.type = type;
+  return cmd;
+}
+
+bool Match(const std::vector<uint8_t>& data, int8_t rssi = -50,
+           const RawAddress& bda = kAddress) {
+  return btm_ble_host_filter_match(bda, rssi, data.data(), data.size());
+}
+
+class BtmBleHostFilterTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    btm_ble_host_filter_init();
+    btm_ble_host_filter_enable(true);
+  }
+};
+
+TEST_F(BtmBleHostFilterTest, everything_passes_until_enabled) {
+  btm_ble_host_filter_enable(false);
+  EXPECT_TRUE(Match({}));
+  btm_ble_host_filter_enable(true);
+  EXPECT_FALSE(Match({}));
+}
+
+TEST_F(BtmBleHostFilterTest, filter_without_features_passes_all) {
+  SetParams(1, 0);
+  EXPECT_TRUE(Match({0x02, 0x01, 0x06}));
+}
+
+TEST_F(BtmBleHostFilterTest, rssi_threshold) {
+  SetParams(1, 0, -70);
+  EXPECT_TRUE(Match({}, -60));
+  EXPECT_FALSE(Match({}, -80));
+}
+
+TEST_F(BtmBleHostFilterTest, address) {
+  ApcfCommand cmd = Command(BTM_BLE_PF_ADDR_FILTER);
+  cmd.address = kAddress;
+  btm_ble_host_filter_add(2, {cmd});
+  SetParams(2, 1 << BTM_BLE_PF_ADDR_FILTER);
+  EXPECT_TRUE(Match({}, -50, kAddress));
+  EXPECT_FALSE(Match({}, -50, kOtherAddress));
+}
+
+TEST_F(BtmBleHostFilterTest, service_uuid) {
+  ApcfCommand cmd = Command(BTM_BLE_PF_SRVC_UUID);
+  cmd.uuid = Uuid::From16Bit(0x180d);
+  btm_ble_host_filter_add(2, {cmd});
+  SetParams(2, 1 << BTM_BLE_PF_SRVC_UUID);
+  EXPECT_TRUE(Match({0x05, 0x03, 0x0f, 0x18, 0x0d, 0x18}));
+  EXPECT_FALSE(Match({0x03, 0x03, 0x0f, 0x18}));
+  /* A 32 bit UUID extending the 16 bit one is another UUID */
+  EXPECT_FALSE(Match({0x05, 0x05, 0x0d, 0x18, 0x01, 0x00}));
+}
+
+TEST_F(BtmBleHostFilterTest, masked_service_uuid) {
+  ApcfCommand cmd = Command(BTM_BLE_PF_SRVC_UUID);
+  cmd.uuid = Uuid::From16Bit(0x1800);
+  cmd.uuid_mask = Uuid::From16Bit(0xff00);
+  btm_ble_host_filter_add(2, {cmd});
+  SetParams(2, 1 << BTM_BLE_PF_SRVC_UUID);
+  EXPECT_TRUE(Match({0x03, 0x03, 0x0f, 0x18}));
+  EXPECT_FALSE(Match({0x03, 0x03, 0x0f, 0x19}));
+}
+
+TEST_F(BtmBleHostFilterTest, local_name) {
+  ApcfCommand cmd = Command(BTM_BLE_PF_LOCAL_NAME);
+  cmd.name = {'a', 'b', 'c'};
+  btm_ble_host_filter_add(2, {cmd});
+  SetParams(2, 1 << BTM_BLE_PF_LOCAL_NAME);
+  EXPECT_TRUE(Match({0x04, 0x09, 'a', 'b', 'c'}));
+  EXPECT_FALSE(Match({0x05, 0x09, 'a', 'b', 'c', 'd'}));
+  /* A shortened name is the start of the name */
+  EXPECT_TRUE(Match({0x03, 0x08, 'a', 'b'}));
+  EXPECT_FALSE(Match({0x03, 0x08, 'a', 'c'}));
+}
+
+TEST_F(BtmBleHostFilterTest, manufacturer_data) {
+  ApcfCommand cmd = Command(BTM_BLE_PF_MANU_DATA);
+  cmd.company = 0x00e0;
+  cmd.data = {0x01, 0x02};
+  cmd.data_mask = {0xff, 0x0f};
+  btm_ble_host_filter_add(2, {cmd});
+  SetParams(2, 1 << BTM_BLE_PF_MANU_DATA);
+  EXPECT_TRUE(Match({0x05, 0xff, 0xe0, 0x00, 0x01, 0xf2}));
+  EXPECT_FALSE(Match({0x05, 0xff, 0xe0, 0x00, 0x01, 0xf3}));
+  EXPECT_FALSE(Match({0x05, 0xff, 0xe1, 0x00, 0x01, 0x02}));
+  EXPECT_FALSE(Match({0x04, 0xff, 0xe0, 0x00, 0x01}));
+}
+
+TEST_F(BtmBleHostFilterTest, service_data_pattern) {
+  ApcfCommand cmd = Command(BTM_BLE_PF_SRVC_DATA_PATTERN);
+  cmd.data = {0xaa, 0xfe, 0x10};
+  cmd.data_mask = {0xff, 0xff, 0xff};
+  btm_ble_host_filter_add(2, {cmd});
+  SetParams(2, 1 << BTM_BLE_PF_SRVC_DATA_PATTERN);
+  EXPECT_TRUE(Match({0x05, 0x16, 0xaa, 0xfe, 0x10, 0x00}));
+  EXPECT_FALSE(Match({0x05, 0x16, 0xaa, 0xfe, 0x20, 0x00}));
+}
+
+TEST_F(BtmBleHostFilterTest, features_and_filters_combine) {
+  ApcfCommand uuid = Command(BTM_BLE_PF_SRVC_UUID);
+  uuid.uuid = Uuid::From16Bit(0x180d);
+  ApcfCommand name = Command(BTM_BLE_PF_LOCAL_NAME);
+  name.name = {'h', 'r'};
+  btm_ble_host_filter_add(2, {uuid, name});
+  SetParams(2, (1 << BTM_BLE_PF_SRVC_UUID) | (1 << BTM_BLE_PF_LOCAL_NAME));
+
+  /* Both features are needed */
+  EXPECT_TRUE(Match({0x03, 0x03, 0x0d, 0x18, 0x03, 0x09, 'h', 'r'}));
+  EXPECT_FALSE(Match({0x03, 0x03, 0x0d, 0x18}));
+
+  /* Any filter will do */
+  ApcfCommand address = Command(BTM_BLE_PF_ADDR_FILTER);
+  address.address = kAddress;
+  btm_ble_host_filter_add(3, {address});
+  SetParams(3, 1 << BTM_BLE_PF_ADDR_FILTER);
+  EXPECT_TRUE(Match({0x03, 0x03, 0x0d, 0x18}));
+
+  btm_ble_host_filter_set_params(BTM_BLE_SCAN_COND_DELETE, 3, nullptr);
+  EXPECT_FALSE(Match({0x03, 0x03, 0x0d, 0x18}));
+}
+
+TEST_F(BtmBleHostFilterTest, clear_drops_the_conditions) {
+  ApcfCommand cmd = Command(BTM_BLE_PF_ADDR_FILTER);
+  cmd.address = kAddress;
+  btm_ble_host_filter_add(2, {cmd});
+  SetParams(2, 1 << BTM_BLE_PF_ADDR_FILTER);
+  EXPECT_TRUE(Match({}));
+  btm_ble_host_filter_clear(2);
+  EXPECT_FALSE(Match({}));
+}
+
+TEST_F(BtmBleHostFilterTest, available_filters) {
+  btgatt_filt_param_setup_t params = {};
+  EXPECT_EQ(btm_ble_host_filter_set_params(BTM_BLE_SCAN_COND_ADD, 1, &params),
+            BTM_BLE_HOST_PF_MAX_FILTERS - 1);
+  EXPECT_EQ(btm_ble_host_filter_set_params(BTM_BLE_SCAN_COND_ADD, 2, &params),
+            BTM_BLE_HOST_PF_MAX_FILTERS - 2);
+  EXPECT_EQ(btm_ble_host_filter_set_params(BTM_BLE_SCAN_COND_CLEAR, 0, nullptr),
+            BTM_BLE_HOST_PF_MAX_FILTERS);
+  EXPECT_FALSE(btm_ble_host_filter_add(BTM_BLE_HOST_PF_MAX_FILTERS, {}));
+}
+
+}  // namespace
@@ -0,0 +1,175 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <string.h>
+#include <cstdint>
+#include <vector>
+
+#include "btm_iso_api.h"
+#include "btu.h"
+#include "osi/include/allocator.h"
+
+// The shard runs its tasks as they are posted
+bool btu_shard_is_threaded(tBTU_SHARD shard) { return false; }
+
+bt_status_t do_in_shard_thread(tBTU_SHARD shard,
+                               const base::Location& from_here,
+                               base::OnceClosure task) {
+  std::move(task).Run();
+  return BT_STATUS_SUCCESS;
+}
+
+namespace {
+
+constexpr uint16_t kHandle = 0x0061;
+constexpr uint8_t kPbFirst = 0x00;
+constexpr uint8_t kPbContinuation = 0x01;
+constexpr uint8_t kPbComplete = 0x02;
+constexpr uint8_t kPbLast = 0x03;
+
+// An HCI ISO data packet; the first and complete ones carry the SDU header
+void Receive(uint8_t pb_flag, const std::vector<uint8_t>& fragment,
+             uint16_t seq_num = 0, uint16_t sdu_len = 0,
+             uint32_t time_stamp = 0, uint8_t status = 0) {
+  std::vector<uint8_t> load;
+  bool has_sdu_hdr = pb_flag == kPbFirst || pb_flag == kPbComplete;
+  if (has_sdu_hdr && time_stamp != 0) {
+    for (int i = 0; i < 4; i++) load.push_back(time_stamp >> (8 * i));
+  }
+  if (has_sdu_hdr) {
+    uint16_t sdu_len_status = sdu_len | (status << 14);
+    load.push_back(seq_num);
+    load.push_back(seq_num >> 8);
+    load.push_back(sdu_len_status);
+    load.push_back(sdu_len_status >> 8);
+  }
+  load.insert(load.end(), fragment.begin(), fragment.end());
+
+  uint16_t handle_flags = kHandle | (pb_flag << 12);
+  if (has_sdu_hdr && time_stamp != 0) handle_flags |= 0x4000;
+  BT_HDR* p_msg = (BT_HDR*)osi_malloc(sizeof(BT_HDR) + 4 + load.size());
+  p_msg->event = BT_EVT_TO_BTU_HCI_ISO;
+  p_msg->offset = 0;
+  p_msg->len = 4 + load.size();
+  p_msg->data[0] = handle_flags;
+  p_msg->data[1] = handle_flags >> 8;
+  p_msg->data[2] = load.size();
+  p_msg->data[3] = load.size() >> 8;
+  memcpy(p_msg->data + 4, load.data(), load.size());
+  btm_iso_data_received(p_msg, 1);
+}
+
+class BtmIsoTest : public ::testing::Test {
+ protected:
+  void SetUp() override { stream_ = BTM_IsoStreamOpen(kHandle, 40, 4); }
+  void TearDown() override { BTM_IsoStreamClose(stream_); }
+
+  bool Read(tBTM_ISO_SDU* sdu, std::vector<uint8_t>* data) {
+    data->resize(40);
+    if (!BTM_IsoStreamRead(stream_, sdu, data->data(), data->size()))
+      return false;
+    data->resize(sdu->len);
+    return true;
+  }
+
+  tBTM_ISO_STREAM* stream_;
+};
+
+TEST_F(BtmIsoTest, complete_sdu_is_queued) {
+  Receive(kPbComplete, {1, 2, 3}, 7, 3, 0x12345678);
+
+  tBTM_ISO_SDU sdu;
+  std::vector<uint8_t> data;
+  ASSERT_TRUE(Read(&sdu, &data));
+  EXPECT_EQ(sdu.seq_num, 7);
+  EXPECT_EQ(sdu.time_stamp, 0x12345678u);
+  EXPECT_EQ(sdu.status, BTM_ISO_SDU_VALID);
+  EXPECT_EQ(data, std::vector<uint8_t>({1, 2, 3}));
+  EXPECT_FALSE(Read(&sdu, &data));
+}
+
+TEST_F(BtmIsoTest, fragments_are_reassembled) {
+  Receive(kPbFirst, {1, 2}, 1, 6);
+  Receive(kPbContinuation, {3, 4});
+  tBTM_ISO_SDU sdu;
+  std::vector<uint8_t> data;
+  EXPECT_FALSE(Read(&sdu, &data));
+
+  Receive(kPbLast, {5, 6});
+  ASSERT_TRUE(Read(&sdu, &data));
+  EXPECT_EQ(sdu.seq_num, 1);
+  EXPECT_EQ(data, std::vector<uint8_t>({1, 2, 3, 4, 5, 6}));
+}
+
+TEST_F(BtmIsoTest, missing_sdus_are_queued_as_lost) {
+  Receive(kPbComplete, {1}, 10, 1);
+  Receive(kPbComplete, {2}, 13, 1);
+
+  tBTM_ISO_SDU sdu;
+  std::vector<uint8_t> data;
+  ASSERT_TRUE(Read(&sdu, &data));
+  EXPECT_EQ(sdu.seq_num, 10);
+  for (uint16_t seq_num : {11, 12}) {
+    ASSERT_TRUE(Read(&sdu, &data));
+    EXPECT_EQ(sdu.seq_num, seq_num);
+    EXPECT_EQ(sdu.status, BTM_ISO_SDU_LOST);
+    EXPECT_TRUE(data.empty());
+  }
+  ASSERT_TRUE(Read(&sdu, &data));
+  EXPECT_EQ(sdu.seq_num, 13);
+  EXPECT_EQ(data, std::vector<uint8_t>({2}));
+}
+
+TEST_F(BtmIsoTest, stale_and_oversized_sdus_are_dropped) {
+  Receive(kPbComplete, {1}, 5, 1);
+  Receive(kPbComplete, {1}, 5, 1);
+  Receive(kPbComplete, {2}, 4, 1);
+  Receive(kPbComplete, std::vector<uint8_t>(41), 6, 41);
+
+  tBTM_ISO_SDU sdu;
+  std::vector<uint8_t> data;
+  ASSERT_TRUE(Read(&sdu, &data));
+  EXPECT_EQ(sdu.seq_num, 5);
+  EXPECT_FALSE(Read(&sdu, &data));
+}
+
+TEST_F(BtmIsoTest, full_queue_drops_new_sdus) {
+  for (uint16_t seq_num = 0; seq_num < 6; seq_num++) {
+    Receive(kPbComplete, std::vector<uint8_t>(40, seq_num), seq_num, 40);
+  }
+
+  tBTM_ISO_SDU sdu;
+  std::vector<uint8_t> data;
+  for (uint16_t seq_num = 0; seq_num < 4; seq_num++) {
+    ASSERT_TRUE(Read(&sdu, &data));
+    EXPECT_EQ(sdu.seq_num, seq_num);
+    EXPECT_EQ(data, std::vector<uint8_t>(40, seq_num));
+  }
+  EXPECT_FALSE(Read(&sdu, &data));
+}
+
+TEST_F(BtmIsoTest, other_handles_are_ignored) {
+  BTM_IsoStreamClose(stream_);
+  stream_ = BTM_IsoStreamOpen(kHandle + 1, 40, 4);
+  Receive(kPbComplete, {1}, 0, 1);
+
+  tBTM_ISO_SDU sdu;
+  std::vector<uint8_t> data;
+  EXPECT_FALSE(Read(&sdu, &data));
+}
+
+}  // namespace
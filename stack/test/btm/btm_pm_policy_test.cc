@@ -0,0 +1,132 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <string.h>
+
+#include "btm_int.h"
+#include "common/time_util.h"
+
+tBTM_CB btm_cb;
+
+namespace {
+uint64_t g_now_ms = 1000;
+}  // namespace
+
+namespace bluetooth {
+namespace common {
+uint64_t time_get_os_boottime_ms() { return g_now_ms; }
+}  // namespace common
+}  // namespace bluetooth
+
+uint8_t btm_handle_to_acl_index(uint16_t hci_handle) {
+  return hci_handle == 0x0040 ? 0 : MAX_L2CAP_LINKS;
+}
+tACL_CONN* btm_bda_to_acl(const RawAddress& bda, tBT_TRANSPORT transport) {
+  return nullptr;
+}
+
+namespace {
+
+/* |bursts| bursts of |packets| packets |gap_ms| apart, |idle_ms| apart */
+void Traffic(tBTM_PM_TRAFFIC* p_traffic, int bursts, int packets,
+             uint64_t gap_ms, uint64_t idle_ms) {
+  for (int burst = 0; burst < bursts; burst++) {
+    for (int packet = 0; packet < packets; packet++) {
+      btm_pm_traffic_record(p_traffic, g_now_ms);
+      g_now_ms += gap_ms;
+    }
+    g_now_ms += idle_ms;
+  }
+}
+
+class BtmPmPolicyTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    memset(&btm_cb, 0, sizeof(btm_cb));
+    memset(&traffic_, 0, sizeof(traffic_));
+  }
+
+  tBTM_PM_TRAFFIC traffic_;
+};
+
+TEST_F(BtmPmPolicyTest, defaults_until_enough_traffic) {
+  Traffic(&traffic_, 1, 8, 10, 0);
+  EXPECT_EQ(btm_pm_traffic_idle_timeout(&traffic_, 5000), 5000u);
+  EXPECT_EQ(btm_pm_traffic_sniff_max(&traffic_, 6, 800), 800);
+}
+
+TEST_F(BtmPmPolicyTest, bursts_longer_than_the_timeout_keep_the_link_active) {
+  /* 3 s bursts of packets 600 ms apart, then 20 s of silence */
+  Traffic(&traffic_, 8, 6, 600, 20000);
+  uint64_t timeout_ms = btm_pm_traffic_idle_timeout(&traffic_, 500);
+  EXPECT_GT(timeout_ms, 600u);
+  EXPECT_LE(timeout_ms, 2000u);
+}
+
+TEST_F(BtmPmPolicyTest, sparse_traffic_shortens_the_timeout) {
+  Traffic(&traffic_, 4, 10, 20, 30000);
+  EXPECT_EQ(btm_pm_traffic_idle_timeout(&traffic_, 5000), 1250u);
+}
+
+TEST_F(BtmPmPolicyTest, sniff_interval_follows_the_idle_periods) {
+  /* Bursts of 20 ms gaps, 800 ms of silence between them */
+  Traffic(&traffic_, 10, 10, 20, 800);
+  uint16_t max = btm_pm_traffic_sniff_max(&traffic_, 6, 800);
+  EXPECT_LT(max, 800);
+  EXPECT_GE(max, 6);
+  EXPECT_EQ(max % 2, 0);
+
+  /* Never below the minimum interval of the profile */
+  EXPECT_EQ(btm_pm_traffic_sniff_max(&traffic_, 400, 800), 400);
+}
+
+TEST_F(BtmPmPolicyTest, long_idle_periods_keep_the_profile_interval) {
+  Traffic(&traffic_, 10, 10, 20, 60000);
+  EXPECT_EQ(btm_pm_traffic_sniff_max(&traffic_, 6, 800), 800);
+}
+
+TEST_F(BtmPmPolicyTest, history_decays) {
+  Traffic(&traffic_, 1, 600, 5, 0);
+  EXPECT_LT(traffic_.gap_count, 300);
+  EXPECT_GE(traffic_.gap_count, 128);
+}
+
+TEST_F(BtmPmPolicyTest, mode_changes_and_wake_latency) {
+  btm_pm_policy_traffic(0x0040);
+  g_now_ms += 10;
+  btm_pm_policy_traffic(0x0040);
+  btm_pm_policy_traffic(0x0041);
+  EXPECT_EQ(btm_cb.pm_mode_db[0].traffic.gap_count, 1);
+
+  tBTM_PM_TRAFFIC* p_traffic = &btm_cb.pm_mode_db[0].traffic;
+  btm_pm_policy_mode_req(0);
+  btm_pm_policy_mode_cmd(0, BTM_PM_MD_SNIFF, BTM_PM_ST_ACTIVE);
+  btm_pm_policy_mode_change(0, BTM_PM_MD_SNIFF);
+  g_now_ms += 200;
+  btm_pm_policy_mode_cmd(0, BTM_PM_MD_ACTIVE, BTM_PM_ST_SNIFF);
+  g_now_ms += 15;
+  btm_pm_policy_mode_change(0, BTM_PM_MD_ACTIVE);
+
+  EXPECT_EQ(p_traffic->mode_reqs, 1u);
+  EXPECT_EQ(p_traffic->mode_cmds, 2u);
+  EXPECT_EQ(p_traffic->sniff_count, 1u);
+  EXPECT_EQ(p_traffic->short_sniff_count, 1u);
+  EXPECT_EQ(p_traffic->wake_count, 1u);
+  EXPECT_EQ(p_traffic->wake_max_ms, 15u);
+}
+
+}  // namespace
@@ -0,0 +1,233 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <string.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "btm_int.h"
+#include "btu.h"
+#include "common/time_util.h"
+
+tBTM_CB btm_cb;
+
+namespace {
+uint64_t g_now_ms = 1000;
+std::vector<RawAddress> g_started;
+std::vector<base::OnceClosure> g_tasks;
+std::vector<std::pair<RawAddress, std::string>> g_names;
+}  // namespace
+
+namespace bluetooth {
+namespace common {
+uint64_t time_get_os_boottime_ms() { return g_now_ms; }
+}  // namespace common
+}  // namespace bluetooth
+
+bt_status_t do_in_main_thread(const base::Location& from_here,
+                              base::OnceClosure task) {
+  g_tasks.push_back(std::move(task));
+  return BT_STATUS_SUCCESS;
+}
+
+tBTM_STATUS btm_initiate_rem_name(const RawAddress& remote_bda, uint8_t origin,
+                                  uint64_t timeout_ms, tBTM_CMPL_CB* p_cb) {
+  tBTM_INQUIRY_VAR_ST* p_inq = &btm_cb.btm_inq_vars;
+  if (p_inq->remname_active) return BTM_BUSY;
+  p_inq->remname_active = true;
+  p_inq->remname_bda = remote_bda;
+  p_inq->p_remname_cmpl_cb = p_cb;
+  g_started.push_back(remote_bda);
+  return BTM_CMD_STARTED;
+}
+
+namespace {
+
+RawAddress Address(uint8_t n) {
+  RawAddress bda;
+  memset(bda.address, 0x5a, sizeof(bda.address));
+  bda.address[5] = n;
+  return bda;
+}
+
+void RecordName(void* p) {
+  const tBTM_REMOTE_DEV_NAME* p_name = (const tBTM_REMOTE_DEV_NAME*)p;
+  g_names.emplace_back(p_name->bd_addr,
+                       p_name->status == BTM_SUCCESS
+                           ? std::string((const char*)p_name->remote_bd_name,
+                                         p_name->length)
+                           : std::string("<failed>"));
+}
+void NameCb1(void* p) { RecordName(p); }
+void NameCb2(void* p) { RecordName(p); }
+
+/* What btm_process_remote_name does for the request in progress */
+void Complete(const char* name) {
+  tBTM_INQUIRY_VAR_ST* p_inq = &btm_cb.btm_inq_vars;
+  tBTM_REMOTE_DEV_NAME rem_name = {};
+  rem_name.bd_addr = p_inq->remname_bda;
+  if (name) {
+    rem_name.status = BTM_SUCCESS;
+    rem_name.length = strlen(name);
+    memcpy(rem_name.remote_bd_name, name, rem_name.length);
+  } else {
+    rem_name.status = BTM_BAD_VALUE_RET;
+  }
+  tBTM_CMPL_CB* p_cb = p_inq->p_remname_cmpl_cb;
+  p_inq->remname_active = false;
+  p_inq->remname_bda = RawAddress::kEmpty;
+  p_inq->p_remname_cmpl_cb = NULL;
+  btm_rmt_name_complete(&rem_name, p_cb);
+}
+
+void RunTasks() {
+  std::vector<base::OnceClosure> tasks = std::move(g_tasks);
+  g_tasks.clear();
+  for (auto& task : tasks) std::move(task).Run();
+}
+
+class BtmRmtNameTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    memset(&btm_cb, 0, sizeof(btm_cb));
+    btm_rmt_name_init();
+    g_started.clear();
+    g_tasks.clear();
+    g_names.clear();
+    /* everything cached by the previous tests has expired */
+    g_now_ms += 2 * BTM_RMT_NAME_CACHE_TTL_MS;
+  }
+};
+
+TEST_F(BtmRmtNameTest, cached_name_is_answered_after_returning) {
+  const uint8_t name[] = "headset";
+  btm_rmt_name_cache_add_eir(Address(1), name, 7);
+
+  EXPECT_EQ(btm_rmt_name_request(Address(1), NameCb1,
+                                 BTM_RMT_NAME_PRIORITY_USER),
+            BTM_CMD_STARTED);
+  EXPECT_TRUE(g_started.empty());
+  EXPECT_TRUE(g_names.empty());
+
+  RunTasks();
+  ASSERT_EQ(g_names.size(), 1u);
+  EXPECT_EQ(g_names[0].first, Address(1));
+  EXPECT_EQ(g_names[0].second, "headset");
+}
+
+TEST_F(BtmRmtNameTest, cached_names_expire) {
+  const uint8_t name[] = "headset";
+  btm_rmt_name_cache_add(Address(1), name, 7);
+  g_now_ms += BTM_RMT_NAME_CACHE_TTL_MS;
+
+  tBTM_REMOTE_DEV_NAME rem_name;
+  EXPECT_FALSE(btm_rmt_name_cache_find(Address(1), &rem_name));
+  btm_rmt_name_request(Address(1), NameCb1, BTM_RMT_NAME_PRIORITY_USER);
+  ASSERT_EQ(g_started.size(), 1u);
+}
+
+TEST_F(BtmRmtNameTest, least_recently_used_name_is_replaced) {
+  const uint8_t name[] = "n";
+  tBTM_REMOTE_DEV_NAME rem_name;
+  for (int xx = 0; xx < BTM_RMT_NAME_CACHE_SIZE; xx++)
+    btm_rmt_name_cache_add(Address(xx), name, 1);
+  EXPECT_TRUE(btm_rmt_name_cache_find(Address(0), &rem_name));
+
+  btm_rmt_name_cache_add(Address(BTM_RMT_NAME_CACHE_SIZE), name, 1);
+  EXPECT_TRUE(btm_rmt_name_cache_find(Address(0), &rem_name));
+  EXPECT_FALSE(btm_rmt_name_cache_find(Address(1), &rem_name));
+  EXPECT_TRUE(
+      btm_rmt_name_cache_find(Address(BTM_RMT_NAME_CACHE_SIZE), &rem_name));
+}
+
+TEST_F(BtmRmtNameTest, requests_for_the_same_device_are_coalesced) {
+  btm_rmt_name_request(Address(1), NameCb1, BTM_RMT_NAME_PRIORITY_USER);
+  EXPECT_EQ(btm_rmt_name_request(Address(1), NameCb2,
+                                 BTM_RMT_NAME_PRIORITY_USER),
+            BTM_CMD_STARTED);
+  /* The security manager waits for the complete event of the same request */
+  EXPECT_EQ(
+      btm_rmt_name_request(Address(1), NULL, BTM_RMT_NAME_PRIORITY_USER),
+      BTM_CMD_STARTED);
+  EXPECT_EQ(g_started.size(), 1u);
+
+  Complete("speaker");
+  ASSERT_EQ(g_names.size(), 2u);
+  EXPECT_EQ(g_names[0].second, "speaker");
+  EXPECT_EQ(g_names[1].second, "speaker");
+
+  /* and the name is cached */
+  btm_rmt_name_request(Address(1), NameCb1, BTM_RMT_NAME_PRIORITY_USER);
+  EXPECT_EQ(g_started.size(), 1u);
+  EXPECT_EQ(g_tasks.size(), 1u);
+}
+
+TEST_F(BtmRmtNameTest, user_requests_run_first) {
+  btm_rmt_name_request(Address(1), NameCb1, BTM_RMT_NAME_PRIORITY_USER);
+  btm_rmt_name_request(Address(2), NameCb1, BTM_RMT_NAME_PRIORITY_BACKGROUND);
+  btm_rmt_name_request(Address(3), NameCb1, BTM_RMT_NAME_PRIORITY_BACKGROUND);
+  btm_rmt_name_request(Address(4), NameCb2, BTM_RMT_NAME_PRIORITY_USER);
+  EXPECT_EQ(g_started.size(), 1u);
+
+  Complete("a");
+  Complete("b");
+  Complete("c");
+  Complete("d");
+  ASSERT_EQ(g_started.size(), 4u);
+  EXPECT_EQ(g_started[1], Address(4));
+  EXPECT_EQ(g_started[2], Address(2));
+  EXPECT_EQ(g_started[3], Address(3));
+  EXPECT_FALSE(btm_cb.btm_inq_vars.remname_active);
+}
+
+TEST_F(BtmRmtNameTest, security_requests_are_not_queued) {
+  btm_rmt_name_request(Address(1), NameCb1, BTM_RMT_NAME_PRIORITY_USER);
+  EXPECT_EQ(
+      btm_rmt_name_request(Address(2), NULL, BTM_RMT_NAME_PRIORITY_USER),
+      BTM_BUSY);
+}
+
+TEST_F(BtmRmtNameTest, queue_full_is_busy) {
+  btm_rmt_name_request(Address(0), NameCb1, BTM_RMT_NAME_PRIORITY_USER);
+  for (int xx = 1; xx <= BTM_RMT_NAME_QUEUE_SIZE; xx++) {
+    EXPECT_EQ(btm_rmt_name_request(Address(xx), NameCb1,
+                                   BTM_RMT_NAME_PRIORITY_USER),
+              BTM_CMD_STARTED);
+  }
+  EXPECT_EQ(btm_rmt_name_request(Address(BTM_RMT_NAME_QUEUE_SIZE + 1),
+                                 NameCb1, BTM_RMT_NAME_PRIORITY_USER),
+            BTM_BUSY);
+}
+
+TEST_F(BtmRmtNameTest, cancel_fails_the_waiting_requests) {
+  btm_rmt_name_request(Address(1), NameCb1, BTM_RMT_NAME_PRIORITY_USER);
+  btm_rmt_name_request(Address(2), NameCb2, BTM_RMT_NAME_PRIORITY_USER);
+  btm_rmt_name_cancel();
+  Complete(NULL);
+
+  EXPECT_EQ(g_started.size(), 1u);
+  ASSERT_EQ(g_names.size(), 2u);
+  EXPECT_EQ(g_names[0].first, Address(2));
+  EXPECT_EQ(g_names[0].second, "<failed>");
+  EXPECT_EQ(g_names[1].first, Address(1));
+  EXPECT_EQ(g_names[1].second, "<failed>");
+  EXPECT_FALSE(btm_cb.btm_inq_vars.remname_active);
+}
+
+}  // namespace
@@ -0,0 +1,240 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <math.h>
+#include <cstdint>
+#include <vector>
+
+#include "btm_api.h"
+#include "btm_int.h"
+#include "osi/include/allocator.h"
+
+namespace {
+
+constexpr uint16_t kScoInx = 1;
+constexpr uint8_t kMsbcPacketLen = 60;
+constexpr size_t kMsbcFrameSamples = 120;
+constexpr uint8_t kCvsdPacketLen = 48;
+
+std::vector<std::vector<uint8_t>> sent_packets;
+
+// A 1 kHz tone, continuing from the sample |start|
+std::vector<int16_t> Tone(size_t start, size_t samples, uint32_t sample_rate) {
+  std::vector<int16_t> pcm(samples);
+  for (size_t i = 0; i < samples; i++) {
+    pcm[i] = 8000 * sin(2 * M_PI * 1000 * (start + i) / sample_rate);
+  }
+  return pcm;
+}
+
+double Energy(const std::vector<int16_t>& pcm) {
+  double energy = 0;
+  for (int16_t sample : pcm) energy += (double)sample * sample;
+  return pcm.empty() ? 0 : energy / pcm.size();
+}
+
+std::vector<int16_t> ReadPcm(size_t samples) {
+  std::vector<int16_t> pcm(samples);
+  uint16_t read = BTM_ReadScoPcm((uint8_t*)pcm.data(), samples * 2);
+  pcm.resize(read / 2);
+  return pcm;
+}
+
+uint16_t WritePcm(const std::vector<int16_t>& pcm) {
+  return BTM_WriteScoPcm((const uint8_t*)pcm.data(), pcm.size() * 2);
+}
+
+tBTM_SCO_HCI_STATS ReadStats() {
+  tBTM_SCO_HCI_STATS stats;
+  BTM_ReadScoHciStats(&stats);
+  return stats;
+}
+
+class BtmScoHciTest : public ::testing::Test {
+ protected:
+  void SetUp() override { sent_packets.clear(); }
+  void TearDown() override { btm_sco_hci_close(kScoInx); }
+
+  // Loops the microphone tone back to the speaker for |packets| packets, one
+  // mSBC frame each. The first packet received is empty.
+  void LoopbackMsbc(size_t packets) {
+    for (size_t i = 0; i < packets; i++) {
+      ASSERT_EQ(WritePcm(Tone(tone_samples_, kMsbcFrameSamples, 16000)),
+                kMsbcFrameSamples * 2);
+      tone_samples_ += kMsbcFrameSamples;
+      size_t sent = sent_packets.size();
+      btm_sco_hci_receive(kScoInx, loopback_.data(), loopback_.size(), 0);
+      ASSERT_EQ(sent_packets.size(), sent + 1);
+      loopback_ = sent_packets.back();
+    }
+  }
+
+  std::vector<uint8_t> loopback_ = std::vector<uint8_t>(kMsbcPacketLen, 0);
+  size_t tone_samples_ = 0;
+};
+
+TEST_F(BtmScoHciTest, msbc_packets_carry_h2_headers) {
+  btm_sco_hci_open(kScoInx, true);
+  LoopbackMsbc(8);
+
+  const uint8_t h2_header_1[] = {0x08, 0x38, 0xc8, 0xf8};
+  for (size_t i = 0; i < sent_packets.size(); i++) {
+    ASSERT_EQ(sent_packets[i].size(), kMsbcPacketLen);
+    EXPECT_EQ(sent_packets[i][0], 0x01);
+    EXPECT_EQ(sent_packets[i][1], h2_header_1[i % 4]);
+    EXPECT_EQ(sent_packets[i][2], 0xad);
+    EXPECT_EQ(sent_packets[i][kMsbcPacketLen - 1], 0);
+  }
+}
+
+TEST_F(BtmScoHciTest, msbc_loopback_decodes_the_microphone) {
+  btm_sco_hci_open(kScoInx, true);
+  double energy = 0;
+  for (int i = 0; i < 40; i++) {
+    LoopbackMsbc(1);
+    auto pcm = ReadPcm(kMsbcFrameSamples);
+    ASSERT_EQ(pcm.size(), kMsbcFrameSamples);
+    energy += Energy(pcm);
+  }
+
+  // The tone is 8000 in amplitude, its energy near 8000^2 / 2
+  EXPECT_GT(energy / 40, 8000.0 * 8000 / 4);
+
+  tBTM_SCO_HCI_STATS stats = ReadStats();
+  EXPECT_EQ(stats.sample_rate, 16000u);
+  EXPECT_EQ(stats.rx_packets, 40u);
+  EXPECT_EQ(stats.rx_frames, 40u);
+  // Only the first packet received, before anything was sent, is concealed
+  EXPECT_EQ(stats.plc_frames, 1u);
+  EXPECT_EQ(stats.rx_seq_errors, 0u);
+  EXPECT_EQ(stats.tx_packets, 40u);
+  EXPECT_EQ(stats.tx_underruns, 0u);
+  EXPECT_EQ(stats.rx_overrun_bytes, 0u);
+}
+
+TEST_F(BtmScoHciTest, msbc_frames_are_realigned_across_packets) {
+  btm_sco_hci_open(kScoInx, true);
+  LoopbackMsbc(20);
+  auto frames = sent_packets;
+  btm_sco_hci_close(kScoInx);
+
+  // Resend the frames in 24 byte packets, misaligned by a few bytes of noise
+  btm_sco_hci_open(kScoInx, true);
+  std::vector<uint8_t> stream = {0x11, 0x01, 0x22, 0x33, 0x44};
+  for (size_t i = 1; i < frames.size(); i++) {
+    stream.insert(stream.end(), frames[i].begin(), frames[i].end());
+  }
+  for (size_t offset = 0; offset + 24 <= stream.size(); offset += 24) {
+    btm_sco_hci_receive(kScoInx, stream.data() + offset, 24, 0);
+  }
+
+  tBTM_SCO_HCI_STATS stats = ReadStats();
+  EXPECT_EQ(stats.rx_sync_lost, 1u);
+  EXPECT_EQ(stats.rx_seq_errors, 0u);
+  EXPECT_GE(stats.rx_frames, frames.size() - 3);
+  EXPECT_EQ(stats.plc_frames, 0u);
+  EXPECT_EQ(sent_packets.size(), stats.rx_packets + 20);
+}
+
+TEST_F(BtmScoHciTest, msbc_damaged_and_missing_frames_are_concealed) {
+  btm_sco_hci_open(kScoInx, true);
+  LoopbackMsbc(12);
+  auto frames = sent_packets;
+  btm_sco_hci_close(kScoInx);
+
+  btm_sco_hci_open(kScoInx, true);
+  for (size_t i = 1; i < frames.size(); i++) {
+    if (i == 6) continue;
+    btm_sco_hci_receive(kScoInx, frames[i].data(), frames[i].size(),
+                        i == 3 ? 0x01 : 0x00);
+  }
+
+  tBTM_SCO_HCI_STATS stats = ReadStats();
+  EXPECT_EQ(stats.rx_erroneous, 1u);
+  EXPECT_EQ(stats.plc_frames, 1u);
+  EXPECT_EQ(stats.rx_seq_errors, 1u);
+  EXPECT_EQ(stats.rx_frames, frames.size() - 2);
+}
+
+TEST_F(BtmScoHciTest, cvsd_passes_pcm_through) {
+  btm_sco_hci_open(kScoInx, false);
+  auto mic = Tone(0, kCvsdPacketLen / 2, 8000);
+  auto speaker = Tone(1000, kCvsdPacketLen / 2, 8000);
+  WritePcm(mic);
+  btm_sco_hci_receive(kScoInx, (const uint8_t*)speaker.data(), kCvsdPacketLen,
+                      0);
+
+  EXPECT_EQ(ReadPcm(kCvsdPacketLen), speaker);
+  ASSERT_EQ(sent_packets.size(), 1u);
+  EXPECT_EQ(sent_packets[0],
+            std::vector<uint8_t>((const uint8_t*)mic.data(),
+                                 (const uint8_t*)mic.data() + kCvsdPacketLen));
+
+  // Nothing more was written, silence is sent
+  btm_sco_hci_receive(kScoInx, (const uint8_t*)speaker.data(), kCvsdPacketLen,
+                      0x02);
+  ASSERT_EQ(sent_packets.size(), 2u);
+  EXPECT_EQ(sent_packets[1], std::vector<uint8_t>(kCvsdPacketLen, 0));
+
+  tBTM_SCO_HCI_STATS stats = ReadStats();
+  EXPECT_EQ(stats.sample_rate, 8000u);
+  EXPECT_EQ(stats.plc_frames, 1u);
+  EXPECT_EQ(stats.tx_underruns, 1u);
+}
+
+TEST_F(BtmScoHciTest, speaker_latency_is_bounded_when_not_read) {
+  btm_sco_hci_open(kScoInx, false);
+  auto speaker = Tone(0, kCvsdPacketLen / 2, 8000);
+  for (int i = 0; i < 100; i++) {
+    btm_sco_hci_receive(kScoInx, (const uint8_t*)speaker.data(),
+                        kCvsdPacketLen, 0);
+  }
+
+  tBTM_SCO_HCI_STATS stats = ReadStats();
+  EXPECT_LE(stats.rx_latency_max_ms, 40u);
+  EXPECT_EQ(stats.rx_overrun_bytes, 100u * kCvsdPacketLen - 40 * 16);
+  EXPECT_EQ(ReadPcm(8000).size(), 40u * 8);
+}
+
+TEST_F(BtmScoHciTest, nothing_is_exchanged_after_close) {
+  btm_sco_hci_open(kScoInx, false);
+  auto speaker = Tone(0, kCvsdPacketLen / 2, 8000);
+  btm_sco_hci_receive(kScoInx, (const uint8_t*)speaker.data(), kCvsdPacketLen,
+                      0);
+  btm_sco_hci_close(kScoInx);
+
+  btm_sco_hci_receive(kScoInx, (const uint8_t*)speaker.data(), kCvsdPacketLen,
+                      0);
+  EXPECT_EQ(sent_packets.size(), 1u);
+  EXPECT_TRUE(ReadPcm(kCvsdPacketLen).empty());
+  EXPECT_EQ(WritePcm(speaker), 0u);
+
+  tBTM_SCO_HCI_STATS stats;
+  EXPECT_FALSE(BTM_ReadScoHciStats(&stats));
+  EXPECT_EQ(stats.rx_packets, 1u);
+}
+
+}  // namespace
+
+// Captures the packets sent on the link
+tBTM_STATUS BTM_WriteScoData(uint16_t sco_inx, BT_HDR* p_buf) {
+  EXPECT_EQ(sco_inx, kScoInx);
+  const uint8_t* p = (const uint8_t*)(p_buf + 1) + p_buf->offset;
+  sent_packets.emplace_back(p, p + p_buf->len);
+  osi_free(p_buf);
+  return BTM_SUCCESS;
+}
@@ -0,0 +1,99 @@
+/******************************************************************************
+ *
+ *  Copyright 2020 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+#include "eir_decoder.h"
+
+TEST(EirDecoderTest, Empty) {
+  const std::vector<uint8_t> eir(240, 0x00);
+  EirDecoder::Result result = EirDecoder::Decode(eir.data(), eir.size());
+  EXPECT_EQ(nullptr, result.name.data);
+  EXPECT_EQ(nullptr, result.uuids[EirDecoder::k16BitUuids].data);
+  EXPECT_FALSE(result.has_tx_power);
+  EXPECT_EQ(0u, result.length);
+  EXPECT_EQ(EirDecoder::Hash(nullptr, 0), result.hash);
+}
+
+TEST(EirDecoderTest, Fields) {
+  std::vector<uint8_t> eir{0x02, 0x0a, 0xf6,        // TX power -10
+                           0x04, 0x08, 'a',  'b',  'c',  // shortened name
+                           0x05, 0x03, 0x0b, 0x11, 0x0e, 0x11,  // 16 bits
+                           0x05, 0x09, 'a',  'b',  'c',  'd'};  // name
+  const size_t length = eir.size();
+  eir.resize(240, 0x00);
+
+  EirDecoder::Result result = EirDecoder::Decode(eir.data(), eir.size());
+  EXPECT_TRUE(result.has_tx_power);
+  EXPECT_EQ(-10, result.tx_power);
+
+  // The complete name wins over the shortened one found first
+  ASSERT_NE(nullptr, result.name.data);
+  EXPECT_EQ(eir.data() + 16, result.name.data);
+  EXPECT_EQ(4, result.name.length);
+  EXPECT_TRUE(result.name.complete);
+
+  const EirDecoder::Data& uuids16 = result.uuids[EirDecoder::k16BitUuids];
+  EXPECT_EQ(eir.data() + 10, uuids16.data);
+  EXPECT_EQ(4, uuids16.length);
+  EXPECT_TRUE(uuids16.complete);
+  EXPECT_EQ(nullptr, result.uuids[EirDecoder::k32BitUuids].data);
+  EXPECT_EQ(nullptr, result.uuids[EirDecoder::k128BitUuids].data);
+
+  // The padding is not part of the significant length nor of the hash
+  EXPECT_EQ(length, result.length);
+  EXPECT_EQ(EirDecoder::Hash(eir.data(), length), result.hash);
+}
+
+TEST(EirDecoderTest, SamePrecedenceAsGetFieldByType) {
+  const std::vector<uint8_t> eir{
+      0x03, 0x02, 0x01, 0x11,  // more 16 bits UUIDs
+      0x03, 0x02, 0x02, 0x11,  // more 16 bits UUIDs
+      0x02, 0x08, 'x',         // shortened name
+      0x02, 0x08, 'y',         // shortened name
+      0x05, 0x05, 0x00, 0x00, 0x0b, 0x11,  // complete 32 bits UUIDs
+      0x05, 0x05, 0x00, 0x00, 0x0e, 0x11,  // complete 32 bits UUIDs
+  };
+
+  EirDecoder::Result result = EirDecoder::Decode(eir.data(), eir.size());
+  uint8_t length;
+
+  const uint8_t* p_data = AdvertiseDataParser::GetFieldByType(
+      eir, EirDecoder::kShortenedName, &length);
+  EXPECT_EQ(p_data, result.name.data);
+  EXPECT_EQ(length, result.name.length);
+  EXPECT_FALSE(result.name.complete);
+
+  p_data = AdvertiseDataParser::GetFieldByType(
+      eir, EirDecoder::kMore16BitUuids, &length);
+  EXPECT_EQ(p_data, result.uuids[EirDecoder::k16BitUuids].data);
+  EXPECT_FALSE(result.uuids[EirDecoder::k16BitUuids].complete);
+
+  p_data = AdvertiseDataParser::GetFieldByType(
+      eir, EirDecoder::kComplete32BitUuids, &length);
+  EXPECT_EQ(p_data, result.uuids[EirDecoder::k32BitUuids].data);
+  EXPECT_TRUE(result.uuids[EirDecoder::k32BitUuids].complete);
+}
+
+TEST(EirDecoderTest, Malformed) {
+  // The second field runs past the end: only the first one is decoded
+  const std::vector<uint8_t> eir{0x02, 0x0a, 0x04, 0x09, 0x09, 'a'};
+  EirDecoder::Result result = EirDecoder::Decode(eir.data(), eir.size());
+  EXPECT_TRUE(result.has_tx_power);
+  EXPECT_EQ(nullptr, result.name.data);
+  EXPECT_EQ(3u, result.length);
+}
@@ -0,0 +1,299 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <base/logging.h>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "osi/test/AllocationTestHarness.h"
+#include "stack/gatt/gatt_int.h"
+#undef LOG_TAG
+#include "stack/gatt/att_protocol.cc"
+
+namespace {
+
+struct TestMutables {
+  struct {
+    // Op code of each PDU handed to L2CAP, in order
+    std::vector<uint8_t> op_codes_;
+    // Each PDU handed to L2CAP, in order
+    std::vector<std::vector<uint8_t>> pdus_;
+    uint16_t return_value_{L2CAP_DW_SUCCESS};
+  } l2cap;
+  struct {
+    int access_count_{0};
+    // Number of buffers taken before returning |return_value_|
+    uint16_t num_taken_{0xffff};
+    uint16_t return_value_{L2CAP_DW_SUCCESS};
+  } l2ca_send_fixed_chnl_data_batch;
+  struct {
+    int access_count_{0};
+  } gatt_cmd_enq;
+  struct {
+    int access_count_{0};
+  } gatt_start_rsp_timer;
+};
+
+TestMutables test_state_;
+
+void SavePdu(BT_HDR* p_buf) {
+  const uint8_t* p = (uint8_t*)(p_buf + 1) + p_buf->offset;
+  test_state_.l2cap.op_codes_.push_back(*p);
+  test_state_.l2cap.pdus_.emplace_back(p, p + p_buf->len);
+  osi_free(p_buf);
+}
+}  // namespace
+
+uint16_t L2CA_SendFixedChnlData(uint16_t fixed_cid, const RawAddress& rem_bda,
+                                BT_HDR* p_buf) {
+  SavePdu(p_buf);
+  return test_state_.l2cap.return_value_;
+}
+uint16_t L2CA_SendFixedChnlDataBatch(uint16_t fixed_cid,
+                                     const RawAddress& rem_bda,
+                                     BT_HDR** p_bufs, uint16_t num_bufs,
+                                     uint16_t* p_num_sent) {
+  auto& batch = test_state_.l2ca_send_fixed_chnl_data_batch;
+  batch.access_count_++;
+  *p_num_sent = std::min(num_bufs, batch.num_taken_);
+  for (uint16_t i = 0; i < *p_num_sent; i++) SavePdu(p_bufs[i]);
+  return batch.return_value_;
+}
+uint8_t L2CA_DataWrite(uint16_t cid, BT_HDR* p_data) {
+  SavePdu(p_data);
+  return test_state_.l2cap.return_value_;
+}
+uint8_t gatt_build_uuid_to_stream(uint8_t** p_dst, const Uuid& uuid) {
+  return 0;
+}
+void gatt_start_rsp_timer(tGATT_CLCB* p_clcb) {
+  test_state_.gatt_start_rsp_timer.access_count_++;
+}
+void gatt_cmd_enq(tGATT_TCB& tcb, tGATT_CLCB* p_clcb, bool to_send,
+                  uint8_t op_code, BT_HDR* p_buf) {
+  test_state_.gatt_cmd_enq.access_count_++;
+  tGATT_CMD_Q cmd;
+  cmd.to_send = to_send;
+  cmd.op_code = op_code;
+  cmd.p_cmd = p_buf;
+  cmd.p_clcb = p_clcb;
+  tcb.cl_cmd_q.push(cmd);
+}
+
+class AttProtocolTest : public AllocationTestHarness {
+ protected:
+  void SetUp() override {
+    AllocationTestHarness::SetUp();
+    test_state_ = TestMutables();
+    tcb_.att_lcid = L2CAP_ATT_CID;
+    tcb_.payload_size = GATT_DEF_BLE_MTU_SIZE;
+    clcb_[0].p_tcb = &tcb_;
+    clcb_[1].p_tcb = &tcb_;
+  }
+
+  void TearDown() override {
+    while (!tcb_.cl_cmd_q.empty()) {
+      osi_free(tcb_.cl_cmd_q.front().p_cmd);
+      tcb_.cl_cmd_q.pop();
+    }
+    AllocationTestHarness::TearDown();
+  }
+
+  tGATT_STATUS SendRead(tGATT_CLCB* p_clcb, uint16_t handle) {
+    tGATT_CL_MSG msg;
+    msg.handle = handle;
+    return attp_send_cl_msg(tcb_, p_clcb, GATT_REQ_READ, &msg);
+  }
+
+  tGATT_STATUS SendWrite(tGATT_CLCB* p_clcb, uint8_t op_code,
+                         uint16_t handle) {
+    tGATT_CL_MSG msg;
+    msg.attr_value.handle = handle;
+    msg.attr_value.offset = 0;
+    msg.attr_value.len = 1;
+    msg.attr_value.value[0] = 0x42;
+    return attp_send_cl_msg(tcb_, p_clcb, op_code, &msg);
+  }
+
+  tGATT_TCB tcb_;
+  tGATT_CLCB clcb_[2];
+};
+
+TEST_F(AttProtocolTest, request_is_sent_when_idle) {
+  EXPECT_EQ(GATT_SUCCESS, SendRead(&clcb_[0], 0x0010));
+
+  EXPECT_EQ(std::vector<uint8_t>({GATT_REQ_READ}),
+            test_state_.l2cap.op_codes_);
+  EXPECT_EQ(1, test_state_.gatt_start_rsp_timer.access_count_);
+  ASSERT_EQ(1u, tcb_.cl_cmd_q.size());
+  EXPECT_FALSE(tcb_.cl_cmd_q.front().to_send);
+}
+
+TEST_F(AttProtocolTest, request_waits_for_outstanding_request) {
+  EXPECT_EQ(GATT_SUCCESS, SendRead(&clcb_[0], 0x0010));
+  EXPECT_EQ(GATT_CMD_STARTED, SendRead(&clcb_[1], 0x0020));
+
+  EXPECT_EQ(std::vector<uint8_t>({GATT_REQ_READ}),
+            test_state_.l2cap.op_codes_);
+  ASSERT_EQ(2u, tcb_.cl_cmd_q.size());
+  EXPECT_TRUE(tcb_.cl_cmd_q.back().to_send);
+  EXPECT_EQ(&clcb_[1], tcb_.cl_cmd_q.back().p_clcb);
+}
+
+TEST_F(AttProtocolTest, write_command_overtakes_outstanding_request) {
+  EXPECT_EQ(GATT_SUCCESS, SendRead(&clcb_[0], 0x0010));
+  EXPECT_EQ(GATT_SUCCESS, SendWrite(&clcb_[1], GATT_CMD_WRITE, 0x0020));
+  EXPECT_EQ(GATT_SUCCESS, SendWrite(&clcb_[1], GATT_SIGN_CMD_WRITE, 0x0020));
+
+  EXPECT_EQ(std::vector<uint8_t>(
+                {GATT_REQ_READ, GATT_CMD_WRITE, GATT_SIGN_CMD_WRITE}),
+            test_state_.l2cap.op_codes_);
+  // Only the read waits for a response, and no timer runs for the writes
+  ASSERT_EQ(1u, tcb_.cl_cmd_q.size());
+  EXPECT_EQ(&clcb_[0], tcb_.cl_cmd_q.front().p_clcb);
+  EXPECT_EQ(1, test_state_.gatt_start_rsp_timer.access_count_);
+}
+
+TEST_F(AttProtocolTest, write_request_waits_for_outstanding_request) {
+  EXPECT_EQ(GATT_SUCCESS, SendRead(&clcb_[0], 0x0010));
+  EXPECT_EQ(GATT_CMD_STARTED, SendWrite(&clcb_[1], GATT_REQ_WRITE, 0x0020));
+
+  EXPECT_EQ(std::vector<uint8_t>({GATT_REQ_READ}),
+            test_state_.l2cap.op_codes_);
+  EXPECT_EQ(2u, tcb_.cl_cmd_q.size());
+}
+
+TEST_F(AttProtocolTest, write_command_reports_congestion) {
+  EXPECT_EQ(GATT_SUCCESS, SendRead(&clcb_[0], 0x0010));
+  test_state_.l2cap.return_value_ = L2CAP_DW_CONGESTED;
+  EXPECT_EQ(GATT_CONGESTED, SendWrite(&clcb_[1], GATT_CMD_WRITE, 0x0020));
+
+  test_state_.l2cap.return_value_ = L2CAP_DW_FAILED;
+  EXPECT_EQ(GATT_INTERNAL_ERROR,
+            SendWrite(&clcb_[1], GATT_CMD_WRITE, 0x0020));
+  EXPECT_EQ(1u, tcb_.cl_cmd_q.size());
+}
+
+class AttProtocolNotificationTest : public AttProtocolTest {
+ protected:
+  void SetUp() override {
+    AttProtocolTest::SetUp();
+    for (uint16_t i = 0; i < kNumNotifs; i++) {
+      values_[i] = {(uint8_t)i, (uint8_t)(i + 1)};
+      notifs_[i].conn_id = 0x0101;
+      notifs_[i].handle = 0x0010 + i;
+      notifs_[i].len = values_[i].size();
+      notifs_[i].p_value = values_[i].data();
+    }
+  }
+
+  static constexpr uint16_t kNumNotifs = 3;
+  std::vector<uint8_t> values_[kNumNotifs];
+  tGATT_NOTIFICATION notifs_[kNumNotifs];
+};
+
+TEST_F(AttProtocolNotificationTest, notifications_are_sent_in_one_batch) {
+  uint16_t num_sent = 0;
+  EXPECT_EQ(GATT_SUCCESS, attp_send_sr_notifications(tcb_, notifs_,
+                                                     kNumNotifs, &num_sent));
+
+  EXPECT_EQ(kNumNotifs, num_sent);
+  EXPECT_EQ(1, test_state_.l2ca_send_fixed_chnl_data_batch.access_count_);
+  ASSERT_EQ(kNumNotifs, test_state_.l2cap.pdus_.size());
+  for (uint16_t i = 0; i < kNumNotifs; i++) {
+    EXPECT_EQ(std::vector<uint8_t>({GATT_HANDLE_VALUE_NOTIF,
+                                    (uint8_t)(0x10 + i), 0x00, (uint8_t)i,
+                                    (uint8_t)(i + 1)}),
+              test_state_.l2cap.pdus_[i]);
+  }
+}
+
+TEST_F(AttProtocolNotificationTest, long_value_is_truncated_to_mtu) {
+  std::vector<uint8_t> value(tcb_.payload_size, 0x42);
+  notifs_[0].len = value.size();
+  notifs_[0].p_value = value.data();
+
+  uint16_t num_sent = 0;
+  EXPECT_EQ(GATT_SUCCESS,
+            attp_send_sr_notifications(tcb_, notifs_, 1, &num_sent));
+
+  EXPECT_EQ(1, num_sent);
+  ASSERT_EQ(1u, test_state_.l2cap.pdus_.size());
+  EXPECT_EQ(tcb_.payload_size, test_state_.l2cap.pdus_[0].size());
+}
+
+TEST_F(AttProtocolNotificationTest, congestion_stops_the_batch) {
+  test_state_.l2ca_send_fixed_chnl_data_batch.num_taken_ = 2;
+  test_state_.l2ca_send_fixed_chnl_data_batch.return_value_ =
+      L2CAP_DW_CONGESTED;
+
+  uint16_t num_sent = 0;
+  EXPECT_EQ(GATT_CONGESTED, attp_send_sr_notifications(tcb_, notifs_,
+                                                       kNumNotifs, &num_sent));
+
+  // The buffer L2CAP did not take is freed, or the harness reports a leak
+  EXPECT_EQ(2, num_sent);
+  ASSERT_EQ(2u, test_state_.l2cap.pdus_.size());
+  EXPECT_EQ(0x11, test_state_.l2cap.pdus_[1][1]);
+}
+
+TEST_F(AttProtocolNotificationTest, congestion_after_the_last_notification) {
+  test_state_.l2ca_send_fixed_chnl_data_batch.return_value_ =
+      L2CAP_DW_CONGESTED;
+
+  uint16_t num_sent = 0;
+  EXPECT_EQ(GATT_CONGESTED, attp_send_sr_notifications(tcb_, notifs_,
+                                                       kNumNotifs, &num_sent));
+  EXPECT_EQ(kNumNotifs, num_sent);
+}
+
+TEST_F(AttProtocolNotificationTest, failure_is_reported) {
+  test_state_.l2ca_send_fixed_chnl_data_batch.num_taken_ = 0;
+  test_state_.l2ca_send_fixed_chnl_data_batch.return_value_ = L2CAP_DW_FAILED;
+
+  uint16_t num_sent = kNumNotifs;
+  EXPECT_EQ(GATT_INTERNAL_ERROR, attp_send_sr_notifications(
+                                     tcb_, notifs_, kNumNotifs, &num_sent));
+  EXPECT_EQ(0, num_sent);
+  EXPECT_TRUE(test_state_.l2cap.pdus_.empty());
+}
+
+TEST_F(AttProtocolNotificationTest, dynamic_channel_sends_one_by_one) {
+  tcb_.att_lcid = 0x0040;
+
+  uint16_t num_sent = 0;
+  EXPECT_EQ(GATT_SUCCESS, attp_send_sr_notifications(tcb_, notifs_,
+                                                     kNumNotifs, &num_sent));
+
+  EXPECT_EQ(kNumNotifs, num_sent);
+  EXPECT_EQ(0, test_state_.l2ca_send_fixed_chnl_data_batch.access_count_);
+  EXPECT_EQ(kNumNotifs, test_state_.l2cap.pdus_.size());
+}
+
+TEST_F(AttProtocolNotificationTest, dynamic_channel_failure_drops_the_pdu) {
+  tcb_.att_lcid = 0x0040;
+  test_state_.l2cap.return_value_ = L2CAP_DW_FAILED;
+
+  uint16_t num_sent = kNumNotifs;
+  EXPECT_EQ(GATT_INTERNAL_ERROR, attp_send_sr_notifications(
+                                     tcb_, notifs_, kNumNotifs, &num_sent));
+
+  // The failed PDU is still handed to L2CAP, which drops it
+  EXPECT_EQ(0, num_sent);
+  EXPECT_EQ(1u, test_state_.l2cap.pdus_.size());
+}
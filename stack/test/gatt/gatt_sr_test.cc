@@ -87,6 +87,9 @@ tGATT_STATUS gatts_db_read_attr_value_by_type(
 }
 void gatt_set_ch_state(tGATT_TCB* p_tcb, tGATT_CH_STATE ch_state) {}
 Uuid* gatts_get_service_uuid(tGATT_SVC_DB* p_db) { return nullptr; }
+tGATT_ATTR* find_attr_by_handle(tGATT_SVC_DB* p_db, uint16_t handle) {
+  return nullptr;
+}
 tGATT_STATUS GATTS_HandleValueIndication(uint16_t conn_id, uint16_t attr_handle,
                                          uint16_t val_len, uint8_t* p_val) {
   return GATT_SUCCESS;
@@ -318,3 +321,96 @@ TEST_F(GattSrTest, gatts_process_write_req_request_write_typical) {
         false);
   CHECK(test_state_.application_request_callback.data_.write_req.len == length);
 }
+
+TEST_F(GattSrTest, gatt_sr_find_i_rcb_by_handle) {
+  std::list<tGATT_SRV_LIST_ELEM> srv_list(3);
+  auto it = srv_list.begin();
+  auto second = it;
+  second->s_hdl = 0x0020;
+  second->e_hdl = 0x002f;
+  auto first = ++it;
+  first->s_hdl = 0x0010;
+  first->e_hdl = 0x001f;
+  auto third = ++it;
+  third->s_hdl = 0x0040;
+  third->e_hdl = 0x004f;
+  gatt_cb.srv_list_info = &srv_list;
+  gatt_sr_update_handle_index();
+
+  CHECK(gatt_sr_find_i_rcb_by_handle(0x0001) == srv_list.end());
+  CHECK(gatt_sr_find_i_rcb_by_handle(0x0010) == first);
+  CHECK(gatt_sr_find_i_rcb_by_handle(0x001f) == first);
+  CHECK(gatt_sr_find_i_rcb_by_handle(0x0020) == second);
+  CHECK(gatt_sr_find_i_rcb_by_handle(0x0030) == srv_list.end());
+  CHECK(gatt_sr_find_i_rcb_by_handle(0x004f) == third);
+  CHECK(gatt_sr_find_i_rcb_by_handle(0x0050) == srv_list.end());
+
+  srv_list.erase(second);
+  gatt_sr_update_handle_index();
+  CHECK(gatt_sr_find_i_rcb_by_handle(0x0020) == srv_list.end());
+  CHECK(gatt_sr_find_i_rcb_by_handle(0x0040) == third);
+
+  gatt_cb.srv_list_info = nullptr;
+  gatt_sr_update_handle_index();
+}
+
+TEST_F(GattSrTest, process_read_multi_rsp_variable_len) {
+  tcb_.sr_cmd.op_code = GATT_REQ_READ_MULTI_VAR;
+  tcb_.sr_cmd.multi_req.num_handles = 2;
+  tcb_.sr_cmd.multi_req.handles[0] = 0x0010;
+  tcb_.sr_cmd.multi_req.handles[1] = 0x0012;
+
+  tGATTS_RSP rsp;
+  memset(&rsp, 0, sizeof(rsp));
+  rsp.attr_value.handle = 0x0010;
+  rsp.attr_value.len = 2;
+  rsp.attr_value.value[0] = 0x11;
+  rsp.attr_value.value[1] = 0x22;
+  CHECK(!process_read_multi_rsp(&tcb_.sr_cmd, GATT_SUCCESS, &rsp, 23));
+
+  rsp.attr_value.handle = 0x0012;
+  rsp.attr_value.len = 1;
+  rsp.attr_value.value[0] = 0x33;
+  CHECK(process_read_multi_rsp(&tcb_.sr_cmd, GATT_SUCCESS, &rsp, 23));
+
+  const uint8_t expected[] = {GATT_RSP_READ_MULTI_VAR, 0x02, 0x00, 0x11, 0x22,
+                              0x01, 0x00, 0x33};
+  BT_HDR* p_msg = tcb_.sr_cmd.p_rsp_msg;
+  CHECK(p_msg != nullptr);
+  CHECK(p_msg->len == sizeof(expected));
+  CHECK(memcmp((uint8_t*)(p_msg + 1) + p_msg->offset, expected,
+               sizeof(expected)) == 0);
+
+  gatt_dequeue_sr_cmd(tcb_);
+}
+
+TEST_F(GattSrTest, process_read_multi_rsp_variable_len_truncated) {
+  tcb_.sr_cmd.op_code = GATT_REQ_READ_MULTI_VAR;
+  tcb_.sr_cmd.multi_req.num_handles = 2;
+  tcb_.sr_cmd.multi_req.handles[0] = 0x0010;
+  tcb_.sr_cmd.multi_req.handles[1] = 0x0012;
+
+  tGATTS_RSP rsp;
+  memset(&rsp, 0, sizeof(rsp));
+  rsp.attr_value.handle = 0x0010;
+  rsp.attr_value.len = 2;
+  rsp.attr_value.value[0] = 0x11;
+  rsp.attr_value.value[1] = 0x22;
+  CHECK(!process_read_multi_rsp(&tcb_.sr_cmd, GATT_SUCCESS, &rsp, 8));
+
+  rsp.attr_value.handle = 0x0012;
+  rsp.attr_value.len = 4;
+  rsp.attr_value.value[0] = 0x33;
+  CHECK(process_read_multi_rsp(&tcb_.sr_cmd, GATT_SUCCESS, &rsp, 8));
+
+  // The last value is cut to fit the MTU, its length is the full one
+  const uint8_t expected[] = {GATT_RSP_READ_MULTI_VAR, 0x02, 0x00, 0x11, 0x22,
+                              0x04, 0x00, 0x33};
+  BT_HDR* p_msg = tcb_.sr_cmd.p_rsp_msg;
+  CHECK(p_msg != nullptr);
+  CHECK(p_msg->len == sizeof(expected));
+  CHECK(memcmp((uint8_t*)(p_msg + 1) + p_msg->offset, expected,
+               sizeof(expected)) == 0);
+
+  gatt_dequeue_sr_cmd(tcb_);
+}
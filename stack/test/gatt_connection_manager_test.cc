@@ -10,6 +10,7 @@
 #include "osi/test/alarm_mock.h"
 
 using testing::_;
+using testing::DoAll;
 using testing::Mock;
 using testing::Return;
 using testing::SaveArg;
@@ -26,14 +27,17 @@ class WhiteListMock {
   MOCK_METHOD0(WhiteListClear, void());
   MOCK_METHOD0(SetLeConnectionModeToFast, bool());
   MOCK_METHOD0(SetLeConnectionModeToSlow, void());
+  MOCK_METHOD0(SetLeConnectionModeToMedium, void());
   MOCK_METHOD2(OnConnectionTimedOut, void(uint8_t, const RawAddress&));
 };
 
 std::unique_ptr<WhiteListMock> localWhiteListMock;
+uint8_t white_list_size = 128;
 }  // namespace
 
 RawAddress address1{{0x01, 0x01, 0x01, 0x01, 0x01, 0x01}};
 RawAddress address2{{0x22, 0x22, 0x02, 0x22, 0x33, 0x22}};
+RawAddress address3{{0x33, 0x33, 0x03, 0x33, 0x44, 0x33}};
 
 constexpr tAPP_ID CLIENT1 = 1;
 constexpr tAPP_ID CLIENT2 = 2;
@@ -51,6 +55,8 @@ void BTM_WhiteListRemove(const RawAddress& address) {
 
 void BTM_WhiteListClear() { return localWhiteListMock->WhiteListClear(); }
 
+uint8_t BTM_GetWhiteListSize() { return white_list_size; }
+
 bool BTM_SetLeConnectionModeToFast() {
   return localWhiteListMock->SetLeConnectionModeToFast();
 }
@@ -59,6 +65,10 @@ void BTM_SetLeConnectionModeToSlow() {
   localWhiteListMock->SetLeConnectionModeToSlow();
 }
 
+void BTM_SetLeConnectionModeToMedium() {
+  localWhiteListMock->SetLeConnectionModeToMedium();
+}
+
 namespace connection_manager {
 class BleConnectionManager : public testing::Test {
   void SetUp() override {
@@ -69,6 +79,7 @@ class BleConnectionManager : public testing::Test {
     connection_manager::reset(true);
     AlarmMock::Reset();
     localWhiteListMock.reset();
+    white_list_size = 128;
   }
 };
 
@@ -271,4 +282,119 @@ TEST_F(BleConnectionManager, test_direct_and_background_connect) {
   Mock::VerifyAndClearExpectations(localWhiteListMock.get());
 }
 
+/** Verify that devices waiting for a white list slot get one in turn, when the
+ * devices holding the slots do not connect. */
+TEST_F(BleConnectionManager, test_background_connection_rotation) {
+  white_list_size = 1;
+
+  EXPECT_CALL(*localWhiteListMock, WhiteListAdd(address1))
+      .WillOnce(Return(true));
+  EXPECT_TRUE(background_connect_add(CLIENT1, address1));
+  Mock::VerifyAndClearExpectations(localWhiteListMock.get());
+
+  alarm_callback_t alarm_callback = nullptr;
+  void* alarm_data = nullptr;
+  EXPECT_CALL(*AlarmMock::Get(), AlarmNew(_)).Times(1);
+  EXPECT_CALL(*AlarmMock::Get(), AlarmSetOnMloop(_, _, _, _))
+      .WillOnce(DoAll(SaveArg<2>(&alarm_callback), SaveArg<3>(&alarm_data)));
+  EXPECT_CALL(*localWhiteListMock, WhiteListAdd(_)).Times(0);
+  // no slot left, the device waits for one
+  EXPECT_TRUE(background_connect_add(CLIENT1, address2));
+  EXPECT_EQ(get_apps_connecting_to(address2).count(CLIENT1), 1UL);
+  Mock::VerifyAndClearExpectations(localWhiteListMock.get());
+  Mock::VerifyAndClearExpectations(AlarmMock::Get());
+
+  EXPECT_CALL(*localWhiteListMock, WhiteListRemove(address1)).Times(1);
+  EXPECT_CALL(*localWhiteListMock, WhiteListAdd(address2))
+      .WillOnce(Return(true));
+  EXPECT_CALL(*AlarmMock::Get(), AlarmSetOnMloop(_, _, _, _))
+      .WillOnce(DoAll(SaveArg<2>(&alarm_callback), SaveArg<3>(&alarm_data)));
+  // rotation period passed without address1 connecting
+  alarm_callback(alarm_data);
+  Mock::VerifyAndClearExpectations(localWhiteListMock.get());
+  Mock::VerifyAndClearExpectations(AlarmMock::Get());
+
+  EXPECT_CALL(*localWhiteListMock, WhiteListRemove(address2)).Times(1);
+  EXPECT_CALL(*localWhiteListMock, WhiteListAdd(address1))
+      .WillOnce(Return(true));
+  EXPECT_CALL(*AlarmMock::Get(), AlarmSetOnMloop(_, _, _, _)).Times(1);
+  alarm_callback(alarm_data);
+  Mock::VerifyAndClearExpectations(localWhiteListMock.get());
+}
+
+/** Verify that a direct connection takes the slot of a background one. */
+TEST_F(BleConnectionManager, test_direct_connect_takes_background_slot) {
+  white_list_size = 1;
+
+  EXPECT_CALL(*localWhiteListMock, WhiteListAdd(address1))
+      .WillOnce(Return(true));
+  EXPECT_TRUE(background_connect_add(CLIENT1, address1));
+  Mock::VerifyAndClearExpectations(localWhiteListMock.get());
+
+  EXPECT_CALL(*localWhiteListMock, SetLeConnectionModeToFast()).Times(1);
+  EXPECT_CALL(*localWhiteListMock, WhiteListRemove(address1)).Times(1);
+  EXPECT_CALL(*localWhiteListMock, WhiteListAdd(address2))
+      .WillOnce(Return(true));
+  EXPECT_TRUE(direct_connect_add(CLIENT2, address2));
+  Mock::VerifyAndClearExpectations(localWhiteListMock.get());
+
+  // no slot for another direct connection
+  EXPECT_CALL(*localWhiteListMock, WhiteListAdd(_)).Times(0);
+  EXPECT_FALSE(direct_connect_add(CLIENT2, address3));
+  EXPECT_EQ(get_apps_connecting_to(address3).size(), 0UL);
+  Mock::VerifyAndClearExpectations(localWhiteListMock.get());
+
+  // the background connection gets its slot back
+  EXPECT_CALL(*localWhiteListMock, SetLeConnectionModeToSlow()).Times(1);
+  EXPECT_CALL(*localWhiteListMock, WhiteListRemove(address2)).Times(1);
+  EXPECT_CALL(*localWhiteListMock, WhiteListAdd(address1))
+      .WillOnce(Return(true));
+  EXPECT_TRUE(direct_connect_remove(CLIENT2, address2));
+  Mock::VerifyAndClearExpectations(localWhiteListMock.get());
+}
+
+/** Verify that the apps of higher priority get the slots first. */
+TEST_F(BleConnectionManager, test_background_connection_priority) {
+  white_list_size = 1;
+
+  EXPECT_CALL(*localWhiteListMock, WhiteListAdd(address1))
+      .WillOnce(Return(true));
+  EXPECT_TRUE(background_connect_add(CLIENT1, address1));
+  EXPECT_TRUE(background_connect_add(CLIENT2, address2));
+  Mock::VerifyAndClearExpectations(localWhiteListMock.get());
+
+  EXPECT_CALL(*localWhiteListMock, WhiteListRemove(address1)).Times(1);
+  EXPECT_CALL(*localWhiteListMock, WhiteListAdd(address2))
+      .WillOnce(Return(true));
+  set_app_priority(CLIENT2, 1);
+  Mock::VerifyAndClearExpectations(localWhiteListMock.get());
+}
+
+/** Verify that a connected device gives its slot away, and gets it back
+ * first when it disconnects. */
+TEST_F(BleConnectionManager, test_background_connection_reconnect) {
+  white_list_size = 1;
+
+  EXPECT_CALL(*localWhiteListMock, WhiteListAdd(address1))
+      .WillOnce(Return(true));
+  EXPECT_TRUE(background_connect_add(CLIENT1, address1));
+  EXPECT_TRUE(background_connect_add(CLIENT1, address2));
+  Mock::VerifyAndClearExpectations(localWhiteListMock.get());
+
+  EXPECT_CALL(*localWhiteListMock, WhiteListRemove(address1)).Times(1);
+  EXPECT_CALL(*localWhiteListMock, WhiteListAdd(address2))
+      .WillOnce(Return(true));
+  on_connection_complete(address1);
+  EXPECT_EQ(get_apps_connecting_to(address1).count(CLIENT1), 1UL);
+  Mock::VerifyAndClearExpectations(localWhiteListMock.get());
+
+  // raise the duty cycle while the device is expected back
+  EXPECT_CALL(*localWhiteListMock, SetLeConnectionModeToMedium()).Times(1);
+  EXPECT_CALL(*localWhiteListMock, WhiteListRemove(address2)).Times(1);
+  EXPECT_CALL(*localWhiteListMock, WhiteListAdd(address1))
+      .WillOnce(Return(true));
+  on_disconnection(address1);
+  Mock::VerifyAndClearExpectations(localWhiteListMock.get());
+}
+
 }  // namespace connection_manager
@@ -0,0 +1,223 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <string.h>
+
+#include "btm_int.h"
+#include "common/time_util.h"
+#include "device/include/controller.h"
+#include "l2c_int.h"
+#include "osi/include/alarm.h"
+
+tL2C_CB l2cb;
+
+namespace {
+uint64_t g_now_ms = 1000;
+alarm_callback_t g_alarm_cb = nullptr;
+tACL_CONN g_acl;
+int g_data_len_reqs = 0;
+int g_phy_reqs = 0;
+int g_conn_param_reqs = 0;
+uint16_t g_min_int = 0;
+uint16_t g_max_int = 0;
+
+bool supported() { return true; }
+controller_t g_controller;
+}  // namespace
+
+namespace bluetooth {
+namespace common {
+uint64_t time_get_os_boottime_ms() { return g_now_ms; }
+}  // namespace common
+}  // namespace bluetooth
+
+struct alarm_t {};
+alarm_t g_alarm;
+alarm_t* alarm_new_periodic(const char* name) { return &g_alarm; }
+bool alarm_is_scheduled(const alarm_t* alarm) { return g_alarm_cb != nullptr; }
+void alarm_set_on_mloop(alarm_t* alarm, uint64_t interval_ms,
+                        alarm_callback_t cb, void* data) {
+  g_alarm_cb = cb;
+}
+void alarm_cancel(alarm_t* alarm) { g_alarm_cb = nullptr; }
+
+const controller_t* controller_get_interface() { return &g_controller; }
+tACL_CONN* btm_bda_to_acl(const RawAddress& bda, tBT_TRANSPORT transport) {
+  return &g_acl;
+}
+tL2C_LCB* l2cu_find_lcb_by_handle(uint16_t handle) {
+  return handle == l2cb.lcb_pool[0].handle ? &l2cb.lcb_pool[0] : nullptr;
+}
+tBTM_STATUS BTM_SetBleDataLength(const RawAddress& bd_addr,
+                                 uint16_t tx_pdu_length) {
+  g_data_len_reqs++;
+  return BTM_SUCCESS;
+}
+void BTM_BleSetPhy(const RawAddress& bd_addr, uint8_t tx_phys, uint8_t rx_phys,
+                   uint16_t phy_options) {
+  g_phy_reqs++;
+}
+void l2cble_tune_conn_params(tL2C_LCB* p_lcb, uint16_t min_int,
+                             uint16_t max_int, uint16_t latency,
+                             uint16_t timeout) {
+  g_conn_param_reqs++;
+  g_min_int = min_int;
+  g_max_int = max_int;
+}
+
+namespace {
+
+class L2cBleTuneTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    memset(&l2cb, 0, sizeof(l2cb));
+    memset(&g_acl, 0, sizeof(g_acl));
+    memset(&g_controller, 0, sizeof(g_controller));
+    g_controller.supports_ble_packet_extension = supported;
+    g_controller.supports_ble_2m_phy = supported;
+    g_acl.peer_le_features[0] = 0x20; /* data length extension */
+    g_acl.peer_le_features[1] = 0x01; /* 2M PHY */
+    g_alarm_cb = nullptr;
+    g_data_len_reqs = g_phy_reqs = g_conn_param_reqs = 0;
+
+    p_lcb_ = &l2cb.lcb_pool[0];
+    p_lcb_->in_use = true;
+    p_lcb_->transport = BT_TRANSPORT_LE;
+    p_lcb_->link_state = LST_CONNECTED;
+    p_lcb_->link_role = HCI_ROLE_MASTER;
+    p_lcb_->handle = 0x0040;
+    p_lcb_->tx_data_len = 27;
+    l2cble_tune_link_up(p_lcb_, 36);
+  }
+
+  /* |seconds| samples of |bytes_per_second| */
+  void Traffic(int seconds, uint16_t bytes_per_second) {
+    for (int i = 0; i < seconds; i++) {
+      l2cble_tune_traffic(p_lcb_, bytes_per_second / 2, true);
+      l2cble_tune_traffic(p_lcb_, bytes_per_second - bytes_per_second / 2,
+                          false);
+      g_now_ms += 1000;
+      ASSERT_NE(g_alarm_cb, nullptr);
+      g_alarm_cb(nullptr);
+    }
+  }
+
+  tL2C_LCB* p_lcb_;
+};
+
+TEST_F(L2cBleTuneTest, sample_throughput_and_hysteresis) {
+  tL2C_BLE_TUNE tune;
+  memset(&tune, 0, sizeof(tune));
+  EXPECT_EQ(l2cble_tune_sample(&tune, 1000), L2C_BLE_TUNE_NONE);
+
+  tune.tx_bytes = 3000;
+  tune.rx_bytes = 1000;
+  EXPECT_EQ(l2cble_tune_sample(&tune, 3000), L2C_BLE_TUNE_SPEED_UP);
+  EXPECT_EQ(tune.last_bps, 2000u);
+  EXPECT_TRUE(tune.active);
+
+  /* Under the busy threshold but over the idle one keeps the link active */
+  for (int i = 0; i < 10; i++) {
+    tune.tx_bytes = 500;
+    EXPECT_EQ(l2cble_tune_sample(&tune, 4000 + i * 1000), L2C_BLE_TUNE_NONE);
+  }
+  EXPECT_TRUE(tune.active);
+
+  for (int i = 0; i < 4; i++)
+    EXPECT_EQ(l2cble_tune_sample(&tune, 14000 + i * 1000), L2C_BLE_TUNE_NONE);
+  EXPECT_EQ(l2cble_tune_sample(&tune, 18000), L2C_BLE_TUNE_RELAX);
+  EXPECT_FALSE(tune.active);
+  EXPECT_EQ(tune.peak_bps, 2000u);
+}
+
+TEST_F(L2cBleTuneTest, busy_link_is_sped_up_then_relaxed) {
+  Traffic(3, 100);
+  EXPECT_EQ(g_data_len_reqs, 0);
+  EXPECT_EQ(g_conn_param_reqs, 0);
+
+  Traffic(1, 10000);
+  EXPECT_EQ(g_data_len_reqs, 1);
+  EXPECT_EQ(g_phy_reqs, 1);
+  EXPECT_EQ(g_conn_param_reqs, 1);
+  EXPECT_EQ(g_min_int, 12);
+  EXPECT_EQ(g_max_int, 24);
+  EXPECT_EQ(p_lcb_->ble_tune.speed_ups, 1u);
+
+  /* Staying busy does not send more requests */
+  Traffic(5, 10000);
+  EXPECT_EQ(g_conn_param_reqs, 1);
+
+  Traffic(5, 0);
+  EXPECT_EQ(g_conn_param_reqs, 2);
+  EXPECT_EQ(g_min_int, BTM_BLE_CONN_INT_MIN_DEF);
+  EXPECT_EQ(g_max_int, BTM_BLE_CONN_INT_MAX_DEF);
+  EXPECT_EQ(p_lcb_->ble_tune.relaxes, 1u);
+
+  /* The data length and the PHY are only asked for once */
+  Traffic(1, 10000);
+  EXPECT_EQ(g_data_len_reqs, 1);
+  EXPECT_EQ(g_phy_reqs, 1);
+  EXPECT_EQ(g_conn_param_reqs, 3);
+}
+
+TEST_F(L2cBleTuneTest, credit_based_channel_gets_the_fast_interval) {
+  tL2C_CCB ccb;
+  memset(&ccb, 0, sizeof(ccb));
+  ccb.local_cid = L2CAP_BASE_APPL_CID;
+  ccb.chnl_state = CST_OPEN;
+  p_lcb_->ccb_queue.p_first_ccb = &ccb;
+  EXPECT_EQ(l2cble_tune_latency_class(p_lcb_), L2C_BLE_LATENCY_STREAM);
+
+  Traffic(1, 10000);
+  EXPECT_EQ(g_min_int, 6);
+  EXPECT_EQ(g_max_int, 12);
+  p_lcb_->ccb_queue.p_first_ccb = nullptr;
+}
+
+TEST_F(L2cBleTuneTest, intervals_set_by_a_profile_are_kept) {
+  l2cble_tune_params_owned(p_lcb_);
+  Traffic(1, 10000);
+  Traffic(5, 0);
+  EXPECT_EQ(g_conn_param_reqs, 0);
+  EXPECT_EQ(g_data_len_reqs, 1);
+  EXPECT_EQ(g_phy_reqs, 1);
+}
+
+TEST_F(L2cBleTuneTest, unsupported_features_are_not_asked_for) {
+  g_acl.peer_le_features[0] = 0;
+  g_acl.peer_le_features[1] = 0;
+  p_lcb_->link_role = HCI_ROLE_SLAVE;
+  Traffic(1, 10000);
+  EXPECT_EQ(g_data_len_reqs, 0);
+  EXPECT_EQ(g_phy_reqs, 0);
+  EXPECT_EQ(g_conn_param_reqs, 0);
+  EXPECT_EQ(p_lcb_->ble_tune.speed_ups, 1u);
+}
+
+TEST_F(L2cBleTuneTest, phy_update_is_recorded_and_idle_stops_the_timer) {
+  l2cble_process_phy_update_evt(0x0040, HCI_SUCCESS, PHY_LE_2M, PHY_LE_2M);
+  EXPECT_EQ(p_lcb_->ble_tune.tx_phy, PHY_LE_2M);
+  Traffic(1, 10000);
+  EXPECT_EQ(g_phy_reqs, 0);
+
+  p_lcb_->in_use = false;
+  g_now_ms += 1000;
+  g_alarm_cb(nullptr);
+  EXPECT_EQ(g_alarm_cb, nullptr);
+}
+
+}  // namespace
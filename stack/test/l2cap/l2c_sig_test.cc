@@ -0,0 +1,286 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <string.h>
+#include <vector>
+
+#include "bt_trace.h"
+#include "btm_int.h"
+#include "device/include/controller.h"
+#include "hci/include/btsnoop.h"
+#include "hcimsgs.h"
+#include "l2c_int.h"
+#include "l2cdefs.h"
+#include "osi/include/allocator.h"
+#include "stack/include/bt_types.h"
+#include "stack/include/btm_api.h"
+
+// The L2CAP sources under test are linked as is. Everything they call in the
+// neighbouring layers (BTM, HCI, controller) is stubbed out below.
+
+
+uint8_t appl_trace_level = BT_TRACE_LEVEL_WARNING;
+void LogMsg(uint32_t trace_set_mask, const char* fmt_str, ...) {}
+
+tBTM_SEC_DEV_REC* btm_find_dev(const RawAddress& bd_addr) { return nullptr; }
+tBTM_INQ_INFO* BTM_InqDbRead(const RawAddress& p_bda) { return nullptr; }
+tBTM_STATUS BTM_SwitchRole(const RawAddress& remote_bd_addr, uint8_t new_role,
+                           tBTM_CMPL_CB* p_cb) {
+  return BTM_SUCCESS;
+}
+void BTM_ReadDevInfo(const RawAddress& remote_bda, tBT_DEVICE_TYPE* p_dev_type,
+                     tBLE_ADDR_TYPE* p_addr_type) {}
+void btm_acl_removed(const RawAddress& bda, tBT_TRANSPORT transport) {}
+tBTM_STATUS BTM_SetPowerMode(uint8_t pm_id, const RawAddress& remote_bda,
+                             const tBTM_PM_PWR_MD* p_mode) {
+  return BTM_SUCCESS;
+}
+uint16_t BTM_GetNumAclLinks(void) { return 1; }
+tBTM_STATUS btm_sec_disconnect(uint16_t handle, uint8_t reason) {
+  return BTM_SUCCESS;
+}
+void btm_remove_sco_links(const RawAddress& bda) {}
+uint8_t* BTM_ReadLocalFeatures(void) { return nullptr; }
+uint16_t btm_get_max_packet_size(const RawAddress& addr) { return 1021; }
+void btm_pm_policy_traffic(uint16_t hci_handle) {}
+void l2cble_tune_traffic(tL2C_LCB* p_lcb, uint16_t len, bool is_tx) {}
+tBTM_STATUS btm_sec_l2cap_access_req(const RawAddress& bd_addr, uint16_t psm,
+                                     uint16_t handle, CONNECTION_TYPE conn_type,
+                                     tBTM_SEC_CALLBACK* p_callback,
+                                     void* p_ref_data) {
+  return BTM_SUCCESS;
+}
+void BTM_VendorSpecificCommand(uint16_t opcode, uint8_t param_len,
+                               uint8_t* p_param_buf, tBTM_VSC_CMPL_CB* p_cb) {}
+void btm_acl_update_busy_level(tBTM_BLI_EVENT event) {}
+uint8_t btm_sec_clr_service_by_psm(uint16_t psm) { return 0; }
+bool btm_is_sco_active_by_bdaddr(const RawAddress& remote_bda) { return false; }
+bool btm_acl_notif_conn_collision(const RawAddress& bda) { return false; }
+void btm_sec_clr_temp_auth_service(const RawAddress& bda) {}
+void btm_sec_abort_access_req(const RawAddress& bd_addr) {}
+
+void l2c_link_timeout(tL2C_LCB* p_lcb) {}
+void l2c_link_sec_comp(const RawAddress* p_bda, tBT_TRANSPORT trasnport,
+                       void* p_ref_data, uint8_t status) {}
+void l2c_link_sec_comp2(const RawAddress& p_bda, tBT_TRANSPORT trasnport,
+                        void* p_ref_data, uint8_t status) {}
+bool l2c_link_hci_disc_comp(uint16_t handle, uint8_t reason) { return false; }
+void l2c_link_check_send_pkts(tL2C_LCB* p_lcb, tL2C_CCB* p_ccb,
+                              BT_HDR* p_buf) {
+  osi_free(p_buf);
+}
+void l2c_link_adjust_allocation(void) {}
+void l2c_link_adjust_chnl_allocation(void) {}
+void l2c_ble_link_adjust_allocation(void) {}
+void l2c_info_resp_timer_timeout(void* data) {}
+
+void L2CA_FreeLePSM(uint16_t psm) {}
+bool l2cble_create_conn(tL2C_LCB* p_lcb) { return false; }
+tL2CAP_LE_RESULT_CODE l2ble_sec_access_req(const RawAddress& bd_addr,
+                                           uint16_t psm, bool is_originator,
+                                           tL2CAP_SEC_CBACK* p_callback,
+                                           void* p_ref_data) {
+  return L2CAP_LE_RESULT_CONN_OK;
+}
+void l2cble_process_sig_cmd(tL2C_LCB* p_lcb, uint8_t* p, uint16_t pkt_len) {}
+void l2cble_send_peer_disc_req(tL2C_CCB* p_ccb) {}
+void l2cble_notify_le_connection(const RawAddress& bda) {}
+void l2cble_credit_based_conn_req(tL2C_CCB* p_ccb) {}
+void l2cble_credit_based_conn_res(tL2C_CCB* p_ccb, uint16_t result) {}
+void l2cble_send_flow_control_credit(tL2C_CCB* p_ccb, uint16_t credit_value) {}
+
+void btsnd_hcic_disconnect(uint16_t handle, uint8_t reason) {}
+void btsnd_hcic_create_conn(const RawAddress& dest, uint16_t packet_types,
+                            uint8_t page_scan_rep_mode, uint8_t page_scan_mode,
+                            uint16_t clock_offset, uint8_t allow_switch) {}
+void btsnd_hcic_write_auto_flush_tout(uint16_t handle, uint16_t timeout) {}
+
+namespace {
+
+void clear_l2cap_whitelist(uint16_t conn_handle, uint16_t local_cid,
+                           uint16_t remote_cid) {}
+
+btsnoop_t fake_btsnoop;
+
+}  // namespace
+
+const btsnoop_t* btsnoop_get_interface(void) {
+  fake_btsnoop.clear_l2cap_whitelist = clear_l2cap_whitelist;
+  return &fake_btsnoop;
+}
+
+namespace {
+
+constexpr uint16_t kHandle = 0x0042;
+constexpr uint16_t kPsm = 0x1001;
+constexpr uint8_t kId = 0x07;
+const RawAddress kRemoteAddress({0x11, 0x22, 0x33, 0x44, 0x55, 0x66});
+
+uint16_t get_ble_default_data_packet_length() { return 27; }
+uint16_t get_acl_data_size_classic() { return 1021; }
+uint16_t get_acl_packet_size_classic() { return 1021 + HCI_DATA_PREAMBLE_SIZE; }
+
+controller_t fake_controller;
+
+int g_config_cfm_count = 0;
+
+void on_config_cfm(uint16_t cid, tL2CAP_CFG_INFO* p_cfg) {
+  g_config_cfm_count++;
+}
+
+int g_data_ind_count = 0;
+
+void on_data_ind(uint16_t cid, BT_HDR* p_buf) {
+  g_data_ind_count++;
+  osi_free(p_buf);
+}
+
+tL2C_RCB rcb;
+
+// Builds a complete ACL packet, as handed over by the packet fragmenter, that
+// carries |payload| on |cid|.
+BT_HDR* MakeAclPacket(uint16_t cid, const std::vector<uint8_t>& payload) {
+  size_t len = HCI_DATA_PREAMBLE_SIZE + L2CAP_PKT_OVERHEAD + payload.size();
+  BT_HDR* p_buf = static_cast<BT_HDR*>(osi_malloc(BT_HDR_SIZE + len));
+  p_buf->event = BT_EVT_TO_BTU_HCI_ACL;
+  p_buf->len = len;
+  p_buf->offset = 0;
+  p_buf->layer_specific = 0;
+  uint8_t* p = p_buf->data;
+  UINT16_TO_STREAM(p, kHandle | (L2CAP_PKT_START << L2CAP_PKT_TYPE_SHIFT));
+  UINT16_TO_STREAM(p, L2CAP_PKT_OVERHEAD + payload.size());
+  UINT16_TO_STREAM(p, payload.size());
+  UINT16_TO_STREAM(p, cid);
+  memcpy(p, payload.data(), payload.size());
+  return p_buf;
+}
+
+BT_HDR* MakeSignallingPacket(const std::vector<uint8_t>& commands) {
+  return MakeAclPacket(L2CAP_SIGNALLING_CID, commands);
+}
+
+// A configuration response to |lcid| that carries |options|
+std::vector<uint8_t> MakeConfigRsp(uint16_t lcid,
+                                   const std::vector<uint8_t>& options) {
+  std::vector<uint8_t> cmd(L2CAP_CMD_OVERHEAD + L2CAP_CONFIG_RSP_LEN);
+  uint8_t* p = cmd.data();
+  UINT8_TO_STREAM(p, L2CAP_CMD_CONFIG_RSP);
+  UINT8_TO_STREAM(p, kId);
+  UINT16_TO_STREAM(p, L2CAP_CONFIG_RSP_LEN + options.size());
+  UINT16_TO_STREAM(p, lcid);
+  UINT16_TO_STREAM(p, 0);
+  UINT16_TO_STREAM(p, L2CAP_CFG_OK);
+  cmd.insert(cmd.end(), options.begin(), options.end());
+  return cmd;
+}
+
+}  // namespace
+
+// Needed for linkage
+const controller_t* controller_get_interface() { return &fake_controller; }
+
+class L2capSignallingTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    fake_controller.get_ble_default_data_packet_length =
+        get_ble_default_data_packet_length;
+    fake_controller.get_acl_data_size_classic = get_acl_data_size_classic;
+    fake_controller.get_acl_packet_size_classic = get_acl_packet_size_classic;
+    g_config_cfm_count = 0;
+    g_data_ind_count = 0;
+
+    l2c_init();
+    p_lcb_ = l2cu_allocate_lcb(kRemoteAddress, false, BT_TRANSPORT_BR_EDR);
+    ASSERT_NE(p_lcb_, nullptr);
+    l2cu_set_lcb_handle(p_lcb_, kHandle);
+    p_lcb_->link_state = LST_CONNECTED;
+
+    memset(&rcb, 0, sizeof(rcb));
+    rcb.in_use = true;
+    rcb.psm = kPsm;
+    rcb.api.pL2CA_ConfigCfm_Cb = on_config_cfm;
+    rcb.api.pL2CA_DataInd_Cb = on_data_ind;
+    p_ccb_ = l2cu_allocate_ccb(p_lcb_, 0);
+    ASSERT_NE(p_ccb_, nullptr);
+    p_ccb_->p_rcb = &rcb;
+    p_ccb_->chnl_state = CST_CONFIG;
+    p_ccb_->local_id = kId;
+  }
+
+  void TearDown() override {
+    l2cu_release_lcb(p_lcb_);
+    l2c_free();
+  }
+
+  tL2C_LCB* p_lcb_ = nullptr;
+  tL2C_CCB* p_ccb_ = nullptr;
+};
+
+TEST_F(L2capSignallingTest, config_rsp_is_processed) {
+  std::vector<uint8_t> mtu{L2CAP_CFG_TYPE_MTU, 2, 0xf9, 0x03};
+  l2c_rcv_acl_data(MakeSignallingPacket(MakeConfigRsp(p_ccb_->local_cid, mtu)));
+  EXPECT_EQ(g_config_cfm_count, 1);
+  EXPECT_TRUE(p_ccb_->config_done & OB_CFG_DONE);
+}
+
+TEST_F(L2capSignallingTest, config_rsp_skips_unknown_option) {
+  std::vector<uint8_t> options{0x7e, 3, 0xaa, 0xbb, 0xcc,
+                               L2CAP_CFG_TYPE_MTU, 2, 0xf9, 0x03};
+  l2c_rcv_acl_data(
+      MakeSignallingPacket(MakeConfigRsp(p_ccb_->local_cid, options)));
+  EXPECT_EQ(g_config_cfm_count, 1);
+}
+
+TEST_F(L2capSignallingTest, config_rsp_with_oversized_unknown_option) {
+  // The option claims 16 bytes of value, but only 2 are left in the command
+  std::vector<uint8_t> options{L2CAP_CFG_TYPE_MTU, 2, 0xf9, 0x03,
+                               0x7e, 16, 0xaa, 0xbb};
+  l2c_rcv_acl_data(
+      MakeSignallingPacket(MakeConfigRsp(p_ccb_->local_cid, options)));
+  EXPECT_EQ(g_config_cfm_count, 0);
+  EXPECT_FALSE(p_ccb_->config_done & OB_CFG_DONE);
+}
+
+TEST_F(L2capSignallingTest, config_rsp_with_oversized_known_option) {
+  std::vector<uint8_t> options{L2CAP_CFG_TYPE_MTU, 4, 0xf9, 0x03};
+  l2c_rcv_acl_data(
+      MakeSignallingPacket(MakeConfigRsp(p_ccb_->local_cid, options)));
+  EXPECT_EQ(g_config_cfm_count, 0);
+}
+
+#if (L2CAP_CHANNEL_STATS == TRUE)
+TEST_F(L2capSignallingTest, data_is_counted_once_accepted) {
+  p_ccb_->chnl_state = CST_OPEN;
+  std::vector<uint8_t> payload(20, 0x5a);
+  l2c_rcv_acl_data(MakeAclPacket(p_ccb_->local_cid, payload));
+  EXPECT_EQ(g_data_ind_count, 1);
+  EXPECT_EQ(p_ccb_->stats.rx_pkts, 1u);
+  EXPECT_EQ(p_ccb_->stats.rx_bytes, payload.size());
+  EXPECT_EQ(p_ccb_->stats.rx_dropped, 0u);
+}
+
+TEST_F(L2capSignallingTest, dropped_data_is_counted_apart) {
+  // No data is taken before the channel is configured
+  p_ccb_->chnl_state = CST_W4_L2CAP_CONNECT_RSP;
+  l2c_rcv_acl_data(
+      MakeAclPacket(p_ccb_->local_cid, std::vector<uint8_t>(20, 0x5a)));
+  EXPECT_EQ(g_data_ind_count, 0);
+  EXPECT_EQ(p_ccb_->stats.rx_pkts, 0u);
+  EXPECT_EQ(p_ccb_->stats.rx_bytes, 0u);
+  EXPECT_EQ(p_ccb_->stats.rx_dropped, 1u);
+}
+#endif
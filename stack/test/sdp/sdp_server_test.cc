@@ -0,0 +1,590 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <base/logging.h>
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "btif/include/btif_config.h"
+#include "common/metrics.h"
+#include "osi/test/AllocationTestHarness.h"
+#include "stack/sdp/sdpint.h"
+#undef LOG_TAG
+#include "stack/sdp/sdp_server.cc"
+
+tSDP_CB sdp_cb;
+
+namespace {
+
+constexpr uint16_t kCid = 0x0040;
+constexpr uint16_t kTransNum = 0x1234;
+constexpr uint16_t kAudioSinkUuid = 0x110B;
+constexpr uint16_t kUnknownUuid = 0x1234;
+
+struct TestMutables {
+  struct {
+    // Each PDU sent to the peer, in order
+    std::vector<std::vector<uint8_t>> pdus_;
+  } l2ca_data_write;
+  struct {
+    bool return_value_{false};
+  } interop_match_addr;
+};
+
+TestMutables test_state_;
+}  // namespace
+
+void LogMsg(uint32_t trace_set_mask, const char* fmt_str, ...) {}
+uint8_t L2CA_DataWrite(uint16_t cid, BT_HDR* p_data) {
+  const uint8_t* p = (uint8_t*)(p_data + 1) + p_data->offset;
+  test_state_.l2ca_data_write.pdus_.emplace_back(p, p + p_data->len);
+  osi_free(p_data);
+  return L2CAP_DW_SUCCESS;
+}
+void alarm_set_on_mloop(alarm_t* alarm, uint64_t interval_ms,
+                        alarm_callback_t cb, void* data) {}
+void alarm_cancel(alarm_t* alarm) {}
+void sdp_conn_timer_timeout(void* data) {}
+void sdp_disc_cache_complete(tCONN_CB* p_ccb, uint16_t status) {}
+bool interop_match_addr(const interop_feature_t feature,
+                        const RawAddress* addr) {
+  return test_state_.interop_match_addr.return_value_;
+}
+tSDP_DISC_ATTR* SDP_FindAttributeInRec(tSDP_DISC_REC* p_rec, uint16_t attr_id) {
+  return nullptr;
+}
+bool SDP_FindProtocolListElemInRec(tSDP_DISC_REC* p_rec, uint16_t layer_uuid,
+                                   tSDP_PROTOCOL_ELEM* p_elem) {
+  return false;
+}
+uint16_t SDP_GetDiRecord(uint8_t getRecordIndex,
+                         tSDP_DI_GET_RECORD* device_info,
+                         tSDP_DISCOVERY_DB* p_db) {
+  return SDP_NO_RECS_MATCH;
+}
+bool btif_config_set_int(const std::string& section, const std::string& key,
+                         int value) {
+  return true;
+}
+namespace bluetooth {
+namespace common {
+void LogManufacturerInfo(const RawAddress& address,
+                         android::bluetooth::DeviceInfoSrcEnum source_type,
+                         const std::string& source_name,
+                         const std::string& manufacturer,
+                         const std::string& model,
+                         const std::string& hardware_version,
+                         const std::string& software_version) {}
+void LogSdpAttribute(const RawAddress& address, uint16_t protocol_uuid,
+                     uint16_t attribute_id, size_t attribute_size,
+                     const char* attribute_value) {}
+}  // namespace common
+}  // namespace bluetooth
+
+namespace {
+
+// A PDU of |pdu_id| carrying |params|
+std::vector<uint8_t> Pdu(uint8_t pdu_id, const std::vector<uint8_t>& params) {
+  std::vector<uint8_t> pdu = {pdu_id, kTransNum >> 8, kTransNum & 0xff,
+                              (uint8_t)(params.size() >> 8),
+                              (uint8_t)params.size()};
+  pdu.insert(pdu.end(), params.begin(), params.end());
+  return pdu;
+}
+
+void Append(std::vector<uint8_t>* p_dst, const std::vector<uint8_t>& src) {
+  p_dst->insert(p_dst->end(), src.begin(), src.end());
+}
+
+std::vector<uint8_t> Uint16(uint16_t value) {
+  return {(uint8_t)(value >> 8), (uint8_t)value};
+}
+
+// A data element sequence with a single 16-bit UUID
+std::vector<uint8_t> UuidSeq(uint16_t uuid) {
+  return {0x35, 0x03, 0x19, (uint8_t)(uuid >> 8), (uint8_t)uuid};
+}
+
+// A data element sequence with a single attribute ID range
+std::vector<uint8_t> AttrRangeSeq(uint16_t start, uint16_t end) {
+  std::vector<uint8_t> seq = {0x35, 0x05, 0x0a};
+  Append(&seq, Uint16(start));
+  Append(&seq, Uint16(end));
+  return seq;
+}
+
+// The continuation state field, empty if |offset| is 0
+std::vector<uint8_t> Cont(uint16_t offset) {
+  if (offset == 0) return {0x00};
+  return {SDP_CONTINUATION_LEN, (uint8_t)(offset >> 8), (uint8_t)offset};
+}
+
+std::vector<uint8_t> ServiceSearchReq(uint16_t uuid, uint16_t max_records,
+                                      uint16_t cont_offset) {
+  std::vector<uint8_t> params = UuidSeq(uuid);
+  Append(&params, Uint16(max_records));
+  Append(&params, Cont(cont_offset));
+  return Pdu(SDP_PDU_SERVICE_SEARCH_REQ, params);
+}
+
+std::vector<uint8_t> ServiceAttrReq(uint32_t handle, uint16_t max_list_len,
+                                    uint16_t cont_offset) {
+  std::vector<uint8_t> params = {(uint8_t)(handle >> 24),
+                                 (uint8_t)(handle >> 16),
+                                 (uint8_t)(handle >> 8), (uint8_t)handle};
+  Append(&params, Uint16(max_list_len));
+  Append(&params, AttrRangeSeq(0x0000, 0xffff));
+  Append(&params, Cont(cont_offset));
+  return Pdu(SDP_PDU_SERVICE_ATTR_REQ, params);
+}
+
+std::vector<uint8_t> SearchAttrReq(uint16_t uuid, uint16_t max_list_len,
+                                   uint16_t cont_offset) {
+  std::vector<uint8_t> params = UuidSeq(uuid);
+  Append(&params, Uint16(max_list_len));
+  Append(&params, AttrRangeSeq(0x0000, 0xffff));
+  Append(&params, Cont(cont_offset));
+  return Pdu(SDP_PDU_SERVICE_SEARCH_ATTR_REQ, params);
+}
+
+uint16_t ReadUint16(const std::vector<uint8_t>& pdu, size_t offset) {
+  return (pdu[offset] << 8) | pdu[offset + 1];
+}
+
+uint32_t ReadUint32(const std::vector<uint8_t>& pdu, size_t offset) {
+  return (ReadUint16(pdu, offset) << 16) | ReadUint16(pdu, offset + 2);
+}
+
+// An attribute list fragment of a (search) attribute response
+struct ListRsp {
+  std::vector<uint8_t> list;
+  uint16_t cont_offset;  // 0 if there is no continuation
+};
+
+class SdpServerTest : public AllocationTestHarness {
+ protected:
+  void SetUp() override {
+    AllocationTestHarness::SetUp();
+    test_state_ = TestMutables();
+    memset(&sdp_cb, 0, sizeof(sdp_cb));
+    sdp_db_reset_index();
+    p_ccb_ = &sdp_cb.ccb[0];
+    p_ccb_->connection_id = kCid;
+    p_ccb_->rem_mtu_size = SDP_MTU_SIZE;
+  }
+
+  void TearDown() override {
+    osi_free_and_reset((void**)&p_ccb_->rsp_list);
+    SDP_DeleteRecord(0);
+    AllocationTestHarness::TearDown();
+  }
+
+  // Adds a record of service class |uuid| and named |name|
+  uint32_t AddRecord(uint16_t uuid, const std::string& name) {
+    uint32_t handle = SDP_CreateRecord();
+    EXPECT_NE(0u, handle);
+    EXPECT_TRUE(SDP_AddServiceClassIdList(handle, 1, &uuid));
+    EXPECT_TRUE(SDP_AddAttribute(handle, ATTR_ID_SERVICE_NAME,
+                                 TEXT_STR_DESC_TYPE, name.size(),
+                                 (uint8_t*)name.data()));
+    return handle;
+  }
+
+  // Hands |pdu| to the server and returns its response
+  std::vector<uint8_t> Send(const std::vector<uint8_t>& pdu) {
+    BT_HDR* p_msg = (BT_HDR*)osi_malloc(sizeof(BT_HDR) + pdu.size());
+    p_msg->offset = 0;
+    p_msg->len = pdu.size();
+    memcpy(p_msg + 1, pdu.data(), pdu.size());
+    test_state_.l2ca_data_write.pdus_.clear();
+    sdp_server_handle_client_req(p_ccb_, p_msg);
+    osi_free(p_msg);
+
+    EXPECT_EQ(1u, test_state_.l2ca_data_write.pdus_.size());
+    if (test_state_.l2ca_data_write.pdus_.empty()) return {};
+    std::vector<uint8_t> rsp = test_state_.l2ca_data_write.pdus_[0];
+    EXPECT_LE(5u, rsp.size());
+    EXPECT_EQ(kTransNum, ReadUint16(rsp, 1));
+    EXPECT_EQ(rsp.size() - 5, ReadUint16(rsp, 3));
+    return rsp;
+  }
+
+  // Returns the error code of an error response, or 0 for another PDU
+  uint16_t ErrorCode(const std::vector<uint8_t>& rsp) {
+    if (rsp.size() < 7 || rsp[0] != SDP_PDU_ERROR_RESPONSE) return 0;
+    return ReadUint16(rsp, 5);
+  }
+
+  ListRsp ParseListRsp(const std::vector<uint8_t>& rsp, uint8_t pdu_id) {
+    ListRsp result = {{}, 0};
+    EXPECT_EQ(pdu_id, rsp[0]);
+    if (rsp[0] != pdu_id) return result;
+    uint16_t count = ReadUint16(rsp, 5);
+    result.list.assign(rsp.begin() + 7, rsp.begin() + 7 + count);
+    size_t cont = 7 + count;
+    if (rsp[cont] == SDP_CONTINUATION_LEN)
+      result.cont_offset = ReadUint16(rsp, cont + 1);
+    else
+      EXPECT_EQ(0, rsp[cont]);
+    return result;
+  }
+
+  // Runs a (search) attribute request to the end, following the
+  // continuations, and returns the whole attribute list
+  template <typename Req>
+  std::vector<uint8_t> ReadList(Req build_req, uint8_t rsp_pdu_id,
+                                size_t* p_num_rsps = nullptr) {
+    std::vector<uint8_t> list;
+    uint16_t cont_offset = 0;
+    size_t num_rsps = 0;
+    do {
+      ListRsp rsp = ParseListRsp(Send(build_req(cont_offset)), rsp_pdu_id);
+      Append(&list, rsp.list);
+      if (rsp.cont_offset != 0) EXPECT_EQ(list.size(), rsp.cont_offset);
+      cont_offset = rsp.cont_offset;
+      num_rsps++;
+    } while (cont_offset != 0 && num_rsps < 100);
+    if (p_num_rsps) *p_num_rsps = num_rsps;
+    return list;
+  }
+
+  std::vector<uint8_t> ReadSearchAttrList(uint16_t uuid, uint16_t max_list_len,
+                                          size_t* p_num_rsps = nullptr) {
+    return ReadList(
+        [=](uint16_t cont_offset) {
+          return SearchAttrReq(uuid, max_list_len, cont_offset);
+        },
+        SDP_PDU_SERVICE_SEARCH_ATTR_RSP, p_num_rsps);
+  }
+
+  tCONN_CB* p_ccb_;
+};
+
+TEST_F(SdpServerTest, service_search_finds_matching_records) {
+  uint32_t sink = AddRecord(kAudioSinkUuid, "sink");
+  AddRecord(0x110A, "source");
+  uint32_t sink2 = AddRecord(kAudioSinkUuid, "sink2");
+
+  std::vector<uint8_t> rsp = Send(ServiceSearchReq(kAudioSinkUuid, 10, 0));
+  ASSERT_EQ(SDP_PDU_SERVICE_SEARCH_RSP, rsp[0]);
+  EXPECT_EQ(2, ReadUint16(rsp, 5));  // total
+  ASSERT_EQ(2, ReadUint16(rsp, 7));  // in this PDU
+  EXPECT_EQ(sink, ReadUint32(rsp, 9));
+  EXPECT_EQ(sink2, ReadUint32(rsp, 13));
+  EXPECT_EQ(0, rsp[17]);
+
+  rsp = Send(ServiceSearchReq(kUnknownUuid, 10, 0));
+  ASSERT_EQ(SDP_PDU_SERVICE_SEARCH_RSP, rsp[0]);
+  EXPECT_EQ(0, ReadUint16(rsp, 5));
+}
+
+TEST_F(SdpServerTest, service_search_with_continuation) {
+  std::vector<uint32_t> handles;
+  for (int i = 0; i < 12; i++)
+    handles.push_back(AddRecord(kAudioSinkUuid, "s"));
+  // Room for (48 - SDP_MAX_SERVICE_RSPHDR_LEN) / 4 = 9 handles per PDU
+  p_ccb_->rem_mtu_size = 48;
+
+  std::vector<uint8_t> rsp = Send(ServiceSearchReq(kAudioSinkUuid, 20, 0));
+  ASSERT_EQ(SDP_PDU_SERVICE_SEARCH_RSP, rsp[0]);
+  EXPECT_EQ(12, ReadUint16(rsp, 5));
+  ASSERT_EQ(9, ReadUint16(rsp, 7));
+  for (int i = 0; i < 9; i++) EXPECT_EQ(handles[i], ReadUint32(rsp, 9 + 4 * i));
+  ASSERT_EQ(SDP_CONTINUATION_LEN, rsp[9 + 4 * 9]);
+  uint16_t cont_offset = ReadUint16(rsp, 10 + 4 * 9);
+  EXPECT_EQ(9, cont_offset);
+
+  rsp = Send(ServiceSearchReq(kAudioSinkUuid, 20, cont_offset));
+  ASSERT_EQ(SDP_PDU_SERVICE_SEARCH_RSP, rsp[0]);
+  EXPECT_EQ(12, ReadUint16(rsp, 5));
+  ASSERT_EQ(3, ReadUint16(rsp, 7));
+  for (int i = 0; i < 3; i++)
+    EXPECT_EQ(handles[9 + i], ReadUint32(rsp, 9 + 4 * i));
+  EXPECT_EQ(0, rsp[9 + 4 * 3]);
+}
+
+TEST_F(SdpServerTest, service_search_caps_max_records) {
+  for (int i = 0; i < 5; i++) AddRecord(kAudioSinkUuid, "s");
+
+  std::vector<uint8_t> rsp = Send(ServiceSearchReq(kAudioSinkUuid, 2, 0));
+  ASSERT_EQ(SDP_PDU_SERVICE_SEARCH_RSP, rsp[0]);
+  EXPECT_EQ(2, ReadUint16(rsp, 5));
+  EXPECT_EQ(2, ReadUint16(rsp, 7));
+}
+
+TEST_F(SdpServerTest, service_search_follows_record_changes) {
+  uint32_t handle = AddRecord(kAudioSinkUuid, "sink");
+  std::vector<uint8_t> rsp = Send(ServiceSearchReq(kAudioSinkUuid, 10, 0));
+  EXPECT_EQ(1, ReadUint16(rsp, 5));
+
+  // The UUID index forgets the record with its service class list
+  EXPECT_TRUE(SDP_DeleteAttribute(handle, ATTR_ID_SERVICE_CLASS_ID_LIST));
+  rsp = Send(ServiceSearchReq(kAudioSinkUuid, 10, 0));
+  EXPECT_EQ(0, ReadUint16(rsp, 5));
+
+  uint16_t uuid = kAudioSinkUuid;
+  EXPECT_TRUE(SDP_AddServiceClassIdList(handle, 1, &uuid));
+  rsp = Send(ServiceSearchReq(kAudioSinkUuid, 10, 0));
+  EXPECT_EQ(1, ReadUint16(rsp, 5));
+
+  EXPECT_TRUE(SDP_DeleteRecord(handle));
+  rsp = Send(ServiceSearchReq(kAudioSinkUuid, 10, 0));
+  EXPECT_EQ(0, ReadUint16(rsp, 5));
+}
+
+TEST_F(SdpServerTest, service_attr_returns_all_attributes) {
+  uint32_t handle = AddRecord(kAudioSinkUuid, "sink");
+
+  ListRsp rsp = ParseListRsp(Send(ServiceAttrReq(handle, 0xffff, 0)),
+                             SDP_PDU_SERVICE_ATTR_RSP);
+  EXPECT_EQ(0, rsp.cont_offset);
+  EXPECT_EQ(std::vector<uint8_t>({
+                0x35, 0x19,                          // attribute list
+                0x09, 0x00, 0x00,                    // record handle
+                0x0a, 0x00, 0x01, 0x00, 0x00,        //
+                0x09, 0x00, 0x01,                    // service class list
+                0x35, 0x03, 0x19, 0x11, 0x0b,        //
+                0x09, 0x01, 0x00,                    // service name
+                0x25, 0x04, 's', 'i', 'n', 'k',      //
+            }),
+            rsp.list);
+}
+
+TEST_F(SdpServerTest, service_attr_with_continuation) {
+  uint32_t handle = AddRecord(kAudioSinkUuid, std::string(100, 'n'));
+  ListRsp rsp = ParseListRsp(Send(ServiceAttrReq(handle, 0xffff, 0)),
+                             SDP_PDU_SERVICE_ATTR_RSP);
+  std::vector<uint8_t> whole = rsp.list;
+
+  size_t num_rsps = 0;
+  std::vector<uint8_t> list = ReadList(
+      [=](uint16_t cont_offset) {
+        return ServiceAttrReq(handle, 16, cont_offset);
+      },
+      SDP_PDU_SERVICE_ATTR_RSP, &num_rsps);
+  EXPECT_LT(1u, num_rsps);
+  EXPECT_EQ(whole, list);
+}
+
+TEST_F(SdpServerTest, search_attr_returns_matching_records) {
+  AddRecord(kAudioSinkUuid, "sink");
+  AddRecord(0x110A, "source");
+
+  ListRsp rsp = ParseListRsp(Send(SearchAttrReq(kAudioSinkUuid, 0xffff, 0)),
+                             SDP_PDU_SERVICE_SEARCH_ATTR_RSP);
+  EXPECT_EQ(0, rsp.cont_offset);
+  EXPECT_EQ(std::vector<uint8_t>({
+                0x35, 0x1c,                          // list of records
+                0x36, 0x00, 0x19,                    // attribute list
+                0x09, 0x00, 0x00,                    // record handle
+                0x0a, 0x00, 0x01, 0x00, 0x00,        //
+                0x09, 0x00, 0x01,                    // service class list
+                0x35, 0x03, 0x19, 0x11, 0x0b,        //
+                0x09, 0x01, 0x00,                    // service name
+                0x25, 0x04, 's', 'i', 'n', 'k',      //
+            }),
+            rsp.list);
+
+  rsp = ParseListRsp(Send(SearchAttrReq(kUnknownUuid, 0xffff, 0)),
+                     SDP_PDU_SERVICE_SEARCH_ATTR_RSP);
+  EXPECT_EQ(std::vector<uint8_t>({0x35, 0x00}), rsp.list);
+}
+
+TEST_F(SdpServerTest, search_attr_with_continuation) {
+  for (int i = 0; i < 4; i++) AddRecord(kAudioSinkUuid, std::string(50, 'n'));
+  std::vector<uint8_t> whole = ReadSearchAttrList(kAudioSinkUuid, 0xffff);
+
+  size_t num_rsps = 0;
+  EXPECT_EQ(whole, ReadSearchAttrList(kAudioSinkUuid, 32, &num_rsps));
+  EXPECT_EQ((whole.size() + 31) / 32, num_rsps);
+}
+
+TEST_F(SdpServerTest, search_attr_continuation_uses_the_first_answer) {
+  uint32_t first = AddRecord(kAudioSinkUuid, std::string(50, 'a'));
+  AddRecord(kAudioSinkUuid, std::string(50, 'b'));
+  std::vector<uint8_t> whole = ReadSearchAttrList(kAudioSinkUuid, 0xffff);
+
+  ListRsp rsp = ParseListRsp(Send(SearchAttrReq(kAudioSinkUuid, 32, 0)),
+                             SDP_PDU_SERVICE_SEARCH_ATTR_RSP);
+  ASSERT_EQ(32, rsp.cont_offset);
+  std::vector<uint8_t> list = rsp.list;
+
+  // A record deleted mid exchange does not corrupt the continuation
+  EXPECT_TRUE(SDP_DeleteRecord(first));
+  uint16_t cont_offset = rsp.cont_offset;
+  while (cont_offset != 0) {
+    rsp = ParseListRsp(Send(SearchAttrReq(kAudioSinkUuid, 32, cont_offset)),
+                       SDP_PDU_SERVICE_SEARCH_ATTR_RSP);
+    Append(&list, rsp.list);
+    cont_offset = rsp.cont_offset;
+  }
+  EXPECT_EQ(whole, list);
+}
+
+TEST_F(SdpServerTest, search_attr_repeated_request_is_cached) {
+  uint32_t handle = AddRecord(kAudioSinkUuid, "sink");
+  std::vector<uint8_t> first = ReadSearchAttrList(kAudioSinkUuid, 0xffff);
+  EXPECT_EQ(1, sdp_rsp_cache.Size());
+
+  // Change a value behind the back of the database: a cached answer does not
+  // see it
+  tSDP_ATTRIBUTE* p_attr = sdp_db_find_attr_in_rec(
+      sdp_db_find_record(handle), ATTR_ID_SERVICE_NAME, ATTR_ID_SERVICE_NAME);
+  ASSERT_NE(nullptr, p_attr);
+  p_attr->value_ptr[0] = 'S';
+
+  EXPECT_EQ(first, ReadSearchAttrList(kAudioSinkUuid, 0xffff));
+  EXPECT_EQ(1, sdp_rsp_cache.Size());
+
+  // Another request gets its own entry
+  ReadSearchAttrList(kUnknownUuid, 0xffff);
+  EXPECT_EQ(2, sdp_rsp_cache.Size());
+}
+
+TEST_F(SdpServerTest, search_attr_cache_is_emptied_when_a_record_changes) {
+  uint32_t handle = AddRecord(kAudioSinkUuid, "sink");
+  std::vector<uint8_t> before = ReadSearchAttrList(kAudioSinkUuid, 0xffff);
+
+  EXPECT_TRUE(SDP_AddAttribute(handle, ATTR_ID_SERVICE_NAME,
+                               TEXT_STR_DESC_TYPE, 4, (uint8_t*)"Sink"));
+  std::vector<uint8_t> after = ReadSearchAttrList(kAudioSinkUuid, 0xffff);
+  EXPECT_EQ(before.size(), after.size());
+  EXPECT_EQ('s', before[before.size() - 4]);
+  EXPECT_EQ('S', after[after.size() - 4]);
+  EXPECT_EQ(1, sdp_rsp_cache.Size());
+
+  EXPECT_TRUE(SDP_DeleteRecord(handle));
+  EXPECT_EQ(std::vector<uint8_t>({0x35, 0x00}),
+            ReadSearchAttrList(kAudioSinkUuid, 0xffff));
+}
+
+TEST_F(SdpServerTest, search_attr_cache_depends_on_avrcp_interop) {
+  // No service name, so that the profile version ends the list
+  uint32_t handle = SDP_CreateRecord();
+  uint16_t uuid = kAudioSinkUuid;
+  EXPECT_TRUE(SDP_AddServiceClassIdList(handle, 1, &uuid));
+  EXPECT_TRUE(SDP_AddProfileDescriptorList(
+      handle, UUID_SERVCLASS_AV_REMOTE_CONTROL, AVRC_REV_1_6));
+  std::vector<uint8_t> list = ReadSearchAttrList(kAudioSinkUuid, 0xffff);
+  EXPECT_EQ(0x06, list.back());
+
+  test_state_.interop_match_addr.return_value_ = true;
+  list = ReadSearchAttrList(kAudioSinkUuid, 0xffff);
+  EXPECT_EQ(0x04, list.back());
+  EXPECT_EQ(2, sdp_rsp_cache.Size());
+
+  // The database itself is left alone
+  test_state_.interop_match_addr.return_value_ = false;
+  list = ReadSearchAttrList(kAudioSinkUuid, 0xffff);
+  EXPECT_EQ(0x06, list.back());
+}
+
+TEST_F(SdpServerTest, truncated_header_is_rejected) {
+  EXPECT_EQ(SDP_INVALID_REQ_SYNTAX,
+            ErrorCode(Send({SDP_PDU_SERVICE_SEARCH_REQ, 0x12, 0x34, 0x00})));
+}
+
+TEST_F(SdpServerTest, wrong_parameter_length_is_rejected) {
+  std::vector<uint8_t> pdu = ServiceSearchReq(kAudioSinkUuid, 10, 0);
+  pdu.push_back(0x00);
+  EXPECT_EQ(SDP_INVALID_PDU_SIZE, ErrorCode(Send(pdu)));
+
+  pdu = ServiceSearchReq(kAudioSinkUuid, 10, 0);
+  pdu.pop_back();
+  EXPECT_EQ(SDP_INVALID_PDU_SIZE, ErrorCode(Send(pdu)));
+}
+
+TEST_F(SdpServerTest, unknown_pdu_is_rejected) {
+  EXPECT_EQ(SDP_INVALID_REQ_SYNTAX, ErrorCode(Send(Pdu(0x42, {}))));
+}
+
+TEST_F(SdpServerTest, truncated_requests_are_rejected) {
+  AddRecord(kAudioSinkUuid, "sink");
+
+  // UUID list cut short
+  EXPECT_EQ(SDP_INVALID_REQ_SYNTAX,
+            ErrorCode(Send(Pdu(SDP_PDU_SERVICE_SEARCH_REQ,
+                               {0x35, 0x03, 0x19, 0x11}))));
+  // No maximum record count
+  EXPECT_EQ(SDP_INVALID_REQ_SYNTAX,
+            ErrorCode(Send(Pdu(SDP_PDU_SERVICE_SEARCH_REQ,
+                               UuidSeq(kAudioSinkUuid)))));
+  // No record handle
+  EXPECT_EQ(SDP_INVALID_SERV_REC_HDL,
+            ErrorCode(Send(Pdu(SDP_PDU_SERVICE_ATTR_REQ, {0x00, 0x01}))));
+  // No attribute list
+  std::vector<uint8_t> params = UuidSeq(kAudioSinkUuid);
+  Append(&params, Uint16(0xffff));
+  EXPECT_EQ(SDP_INVALID_REQ_SYNTAX,
+            ErrorCode(Send(Pdu(SDP_PDU_SERVICE_SEARCH_ATTR_REQ, params))));
+  // Attribute list without continuation state
+  Append(&params, AttrRangeSeq(0x0000, 0xffff));
+  EXPECT_EQ(SDP_INVALID_REQ_SYNTAX,
+            ErrorCode(Send(Pdu(SDP_PDU_SERVICE_SEARCH_ATTR_REQ, params))));
+  // Continuation state cut short
+  Append(&params, {SDP_CONTINUATION_LEN, 0x00});
+  EXPECT_EQ(SDP_INVALID_CONT_STATE,
+            ErrorCode(Send(Pdu(SDP_PDU_SERVICE_SEARCH_ATTR_REQ, params))));
+}
+
+TEST_F(SdpServerTest, unknown_record_handle_is_rejected) {
+  EXPECT_EQ(SDP_INVALID_SERV_REC_HDL,
+            ErrorCode(Send(ServiceAttrReq(0x12345678, 0xffff, 0))));
+}
+
+TEST_F(SdpServerTest, tiny_max_list_len_is_rejected) {
+  uint32_t handle = AddRecord(kAudioSinkUuid, "sink");
+
+  EXPECT_EQ(SDP_ILLEGAL_PARAMETER,
+            ErrorCode(Send(ServiceAttrReq(handle, 3, 0))));
+  EXPECT_EQ(SDP_ILLEGAL_PARAMETER,
+            ErrorCode(Send(SearchAttrReq(kAudioSinkUuid, 3, 0))));
+}
+
+TEST_F(SdpServerTest, bad_continuation_is_rejected) {
+  for (int i = 0; i < 12; i++) AddRecord(kAudioSinkUuid, "s");
+  p_ccb_->rem_mtu_size = 48;
+
+  // Continuation without a previous request
+  EXPECT_EQ(SDP_INVALID_CONT_STATE,
+            ErrorCode(Send(SearchAttrReq(kAudioSinkUuid, 32, 32))));
+  EXPECT_EQ(SDP_INVALID_CONT_STATE,
+            ErrorCode(Send(ServiceSearchReq(kAudioSinkUuid, 20, 9))));
+
+  // Continuation state other than the one handed out
+  ListRsp rsp = ParseListRsp(Send(SearchAttrReq(kAudioSinkUuid, 32, 0)),
+                             SDP_PDU_SERVICE_SEARCH_ATTR_RSP);
+  ASSERT_EQ(32, rsp.cont_offset);
+  EXPECT_EQ(SDP_INVALID_CONT_STATE,
+            ErrorCode(Send(SearchAttrReq(kAudioSinkUuid, 32, 31))));
+
+  std::vector<uint8_t> search = Send(ServiceSearchReq(kAudioSinkUuid, 20, 0));
+  ASSERT_EQ(SDP_PDU_SERVICE_SEARCH_RSP, search[0]);
+  EXPECT_EQ(SDP_INVALID_CONT_STATE,
+            ErrorCode(Send(ServiceSearchReq(kAudioSinkUuid, 20, 8))));
+
+  // Continuation state of a length other than 2
+  std::vector<uint8_t> params = UuidSeq(kAudioSinkUuid);
+  Append(&params, Uint16(20));
+  Append(&params, {0x01, 0x09});
+  EXPECT_EQ(SDP_INVALID_CONT_STATE,
+            ErrorCode(Send(Pdu(SDP_PDU_SERVICE_SEARCH_REQ, params))));
+}
+
+}  // namespace
@@ -26,6 +26,7 @@
 #include "stack/include/a2dp_aac.h"
 #include "stack/include/a2dp_api.h"
 #include "stack/include/a2dp_codec_api.h"
+#include "stack/include/a2dp_codec_select.h"
 #include "stack/include/a2dp_sbc.h"
 #include "stack/include/a2dp_vendor.h"
 
@@ -1002,3 +1003,76 @@ TEST_F(A2dpCodecConfigTest, init) {
       codecs.orderedSinkCodecs();
   EXPECT_FALSE(orderedSinkCodecs.empty());
 }
+
+TEST(A2dpCodecSelectTest, field_values) {
+  const tA2DP_CODEC_FIELD_VALUE<btav_a2dp_codec_channel_mode_t> values[] = {
+      {0x02, BTAV_A2DP_CODEC_CHANNEL_MODE_STEREO},
+      {0x04, BTAV_A2DP_CODEC_CHANNEL_MODE_STEREO},
+      {0x01, BTAV_A2DP_CODEC_CHANNEL_MODE_MONO},
+  };
+
+  EXPECT_EQ(A2DP_FieldBtavValues(values, 0x05),
+            BTAV_A2DP_CODEC_CHANNEL_MODE_STEREO |
+                BTAV_A2DP_CODEC_CHANNEL_MODE_MONO);
+  EXPECT_EQ(A2DP_FieldBtavValues(values, 0x08),
+            BTAV_A2DP_CODEC_CHANNEL_MODE_NONE);
+
+  // The most preferred value set is selected
+  EXPECT_EQ(A2DP_SelectBestFieldValue(values, 0x07), &values[0]);
+  EXPECT_EQ(A2DP_SelectBestFieldValue(values, 0x05), &values[1]);
+  EXPECT_EQ(A2DP_SelectBestFieldValue(values, 0x08), nullptr);
+
+  EXPECT_EQ(A2DP_SelectFieldValue(values, 0x07,
+                                  BTAV_A2DP_CODEC_CHANNEL_MODE_MONO),
+            &values[2]);
+  EXPECT_EQ(A2DP_SelectFieldValue(values, 0x05,
+                                  BTAV_A2DP_CODEC_CHANNEL_MODE_STEREO),
+            &values[1]);
+  EXPECT_EQ(A2DP_SelectFieldValue(values, 0x06,
+                                  BTAV_A2DP_CODEC_CHANNEL_MODE_MONO),
+            nullptr);
+
+  EXPECT_TRUE(
+      A2DP_FieldHasBtavValue(values, BTAV_A2DP_CODEC_CHANNEL_MODE_MONO));
+  EXPECT_FALSE(A2DP_FieldHasBtavValue(
+      values, BTAV_A2DP_CODEC_CHANNEL_MODE_DUAL_CHANNEL));
+}
+
+TEST(A2dpCodecUserConfigTest, in_place) {
+  btav_a2dp_codec_config_t current = {
+      .codec_type = BTAV_A2DP_CODEC_INDEX_SOURCE_LDAC,
+      .sample_rate = BTAV_A2DP_CODEC_SAMPLE_RATE_96000,
+      .bits_per_sample = BTAV_A2DP_CODEC_BITS_PER_SAMPLE_32,
+      .channel_mode = BTAV_A2DP_CODEC_CHANNEL_MODE_STEREO,
+      .codec_specific_1 = 1000,
+  };
+  btav_a2dp_codec_config_t user = current;
+  EXPECT_TRUE(A2DP_IsCodecUserConfigInPlace(current, user, false));
+  EXPECT_TRUE(A2DP_IsCodecUserConfigInPlace(current, user, true));
+
+  // Changing the LDAC quality mode only needs the software encoder
+  user.codec_specific_1 = 1002;
+  EXPECT_TRUE(A2DP_IsCodecUserConfigInPlace(current, user, false));
+  EXPECT_FALSE(A2DP_IsCodecUserConfigInPlace(current, user, true));
+
+  // The unset fields keep the current value
+  user = current;
+  user.sample_rate = BTAV_A2DP_CODEC_SAMPLE_RATE_NONE;
+  user.bits_per_sample = BTAV_A2DP_CODEC_BITS_PER_SAMPLE_NONE;
+  EXPECT_TRUE(A2DP_IsCodecUserConfigInPlace(current, user, false));
+
+  user = current;
+  user.sample_rate = BTAV_A2DP_CODEC_SAMPLE_RATE_48000;
+  EXPECT_FALSE(A2DP_IsCodecUserConfigInPlace(current, user, false));
+
+  user = current;
+  user.codec_type = BTAV_A2DP_CODEC_INDEX_SOURCE_AAC;
+  EXPECT_FALSE(A2DP_IsCodecUserConfigInPlace(current, user, false));
+
+  // Other codecs use codec_specific_1 for the over the air config
+  current.codec_type = BTAV_A2DP_CODEC_INDEX_SOURCE_SBC;
+  user = current;
+  user.codec_specific_1 = 1;
+  EXPECT_FALSE(A2DP_IsCodecUserConfigInPlace(current, user, false));
+}
+
@@ -291,4 +291,153 @@ TEST(SmpEccValidationTest, test_invalid_points) {
 
   EXPECT_FALSE(ECC_ValidatePoint(p));
 }
+
+// Order of the P-256 base point, little endian
+const uint32_t kP256Order[KEY_LENGTH_DWORDS_P256] = {
+    0xfc632551, 0xf3b9cac2, 0xa7179e84, 0xbce6faad,
+    0xffffffff, 0xffffffff, 0x00000000, 0xffffffff};
+
+static void reference_point_mult(Point* q, const Point& p, const uint32_t* n) {
+  Point base = p;
+  uint32_t scalar[KEY_LENGTH_DWORDS_P256];
+  memcpy(scalar, n, sizeof(scalar));
+  ECC_PointMult_Bin_NAF(q, &base, scalar);
+}
+
+static std::vector<std::vector<uint32_t>> test_scalars() {
+  std::vector<std::vector<uint32_t>> scalars = {
+      {1, 0, 0, 0, 0, 0, 0, 0},
+      {2, 0, 0, 0, 0, 0, 0, 0},
+      {0x3c, 0, 0, 0, 0, 0, 0, 0x80000000},
+      {0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+       0xffffffff, 0x7fffffff},
+      std::vector<uint32_t>(kP256Order, kP256Order + KEY_LENGTH_DWORDS_P256),
+  };
+  // n - 1
+  scalars.back()[0]--;
+
+  uint32_t seed = 0x12345678;
+  for (int i = 0; i < 8; i++) {
+    std::vector<uint32_t> n(KEY_LENGTH_DWORDS_P256);
+    for (auto& word : n) {
+      seed = seed * 1103515245 + 12345;
+      word = seed ^ (seed >> 13) ^ (i * 0x9e3779b9);
+    }
+    scalars.push_back(n);
+  }
+  return scalars;
+}
+
+// Debug keys of the Core specification, Vol 3, Part H, 2.3.5.6.1
+TEST(SmpEccPointMultTest, test_debug_key) {
+  p_256_init_curve();
+  uint32_t private_key[KEY_LENGTH_DWORDS_P256] = {
+      0xcd3c1abd, 0x5899b8a6, 0xeb40b799, 0x4aff607b,
+      0xd2103f50, 0x74c9b3e3, 0xa3c55f38, 0x3f49f6d4};
+  uint32_t x[KEY_LENGTH_DWORDS_P256] = {0x0e359de6, 0xcc030148, 0xacf4fddb,
+                                        0xeff49111, 0xe9f9a5b9, 0x5e2c83a7,
+                                        0xf297be2c, 0x20b003d2};
+  uint32_t y[KEY_LENGTH_DWORDS_P256] = {0x1589d28b, 0x741c8ed0, 0x8fed3024,
+                                        0x766345c2, 0x5a52155c, 0x63329abf,
+                                        0x652aeb6d, 0xdc809c49};
+
+  Point q;
+  ECC_PointMult_Base(&q, private_key);
+  EXPECT_EQ(0, memcmp(q.x, x, sizeof(x)));
+  EXPECT_EQ(0, memcmp(q.y, y, sizeof(y)));
+
+  ECC_PointMult_CT(&q, &curve_p256.G, private_key);
+  EXPECT_EQ(0, memcmp(q.x, x, sizeof(x)));
+  EXPECT_EQ(0, memcmp(q.y, y, sizeof(y)));
+}
+
+// The constant time multiplications match the reference implementation
+TEST(SmpEccPointMultTest, test_matches_reference) {
+  p_256_init_curve();
+
+  Point p;
+  uint32_t k[KEY_LENGTH_DWORDS_P256] = {0xdeadbeef, 7, 0, 0x1234, 0, 0, 0, 0};
+  reference_point_mult(&p, curve_p256.G, k);
+  ASSERT_TRUE(ECC_ValidatePoint(p));
+
+  for (const auto& n : test_scalars()) {
+    Point expected, q;
+
+    reference_point_mult(&expected, curve_p256.G, n.data());
+    ECC_PointMult_Base(&q, n.data());
+    EXPECT_EQ(0, memcmp(q.x, expected.x, sizeof(q.x)));
+    EXPECT_EQ(0, memcmp(q.y, expected.y, sizeof(q.y)));
+
+    reference_point_mult(&expected, p, n.data());
+    ECC_PointMult_CT(&q, &p, n.data());
+    EXPECT_EQ(0, memcmp(q.x, expected.x, sizeof(q.x)));
+    EXPECT_EQ(0, memcmp(q.y, expected.y, sizeof(q.y)));
+  }
+}
+
+// Both sides of an ECDH exchange agree, and the public keys are valid
+TEST(SmpEccPointMultTest, test_dhkey_agreement) {
+  std::vector<std::vector<uint32_t>> scalars = test_scalars();
+  for (size_t i = 0; i + 1 < scalars.size(); i++) {
+    Point pub_a, pub_b, dh_a, dh_b;
+    ECC_PointMult_Base(&pub_a, scalars[i].data());
+    ECC_PointMult_Base(&pub_b, scalars[i + 1].data());
+    EXPECT_TRUE(ECC_ValidatePoint(pub_a));
+    EXPECT_TRUE(ECC_ValidatePoint(pub_b));
+
+    ECC_PointMult_CT(&dh_a, &pub_b, scalars[i].data());
+    ECC_PointMult_CT(&dh_b, &pub_a, scalars[i + 1].data());
+    EXPECT_EQ(0, memcmp(dh_a.x, dh_b.x, sizeof(dh_a.x)));
+    EXPECT_EQ(0, memcmp(dh_a.y, dh_b.y, sizeof(dh_a.y)));
+  }
+}
+
+// Scalars above the order of the base point are reduced. The reference
+// implementation overflows on this one.
+TEST(SmpEccPointMultTest, test_all_ones_scalar) {
+  uint32_t n[KEY_LENGTH_DWORDS_P256];
+  memset(n, 0xff, sizeof(n));
+  uint32_t x[KEY_LENGTH_DWORDS_P256] = {0x9db9d31a, 0x1a3d132b, 0x9c3677cc,
+                                        0x2c6102c4, 0x9586eb53, 0x1b102317,
+                                        0x0e26c0d2, 0xf72cbd24};
+  uint32_t y[KEY_LENGTH_DWORDS_P256] = {0xa83408a7, 0xe453d93f, 0xcdca831e,
+                                        0x23250ef0, 0xbfe7a5d2, 0xdc0dbd91,
+                                        0xe2a36621, 0x43e4ca77};
+
+  Point q;
+  ECC_PointMult_Base(&q, n);
+  EXPECT_EQ(0, memcmp(q.x, x, sizeof(x)));
+  EXPECT_EQ(0, memcmp(q.y, y, sizeof(y)));
+}
+
+// The order of the base point gives the point at infinity, reported as (0, 0)
+TEST(SmpEccPointMultTest, test_order) {
+  Point q;
+  ECC_PointMult_Base(&q, kP256Order);
+  uint32_t zero[KEY_LENGTH_DWORDS_P256] = {0};
+  EXPECT_EQ(0, memcmp(q.x, zero, sizeof(zero)));
+  EXPECT_EQ(0, memcmp(q.y, zero, sizeof(zero)));
+  EXPECT_FALSE(ECC_ValidatePoint(q));
+}
+
+// Coordinates that aren't reduced modulo p are rejected
+TEST(SmpEccValidationTest, test_unreduced_points) {
+  p_256_init_curve();
+
+  // (0, sqrt(b)) is on the curve, (p, sqrt(b)) is the same point unreduced
+  Point p;
+  multiprecision_init(p.x);
+  p.y[7] = 0x66485c78;
+  p.y[6] = 0x0e2f83d7;
+  p.y[5] = 0x2433bd5d;
+  p.y[4] = 0x84a06bb6;
+  p.y[3] = 0x541c2af3;
+  p.y[2] = 0x1dae8717;
+  p.y[1] = 0x28bf856a;
+  p.y[0] = 0x174f93f4;
+  EXPECT_TRUE(ECC_ValidatePoint(p));
+
+  multiprecision_copy(p.x, curve_p256.p);
+  EXPECT_FALSE(ECC_ValidatePoint(p));
+}
 }  // namespace testing
@@ -0,0 +1,126 @@
+/******************************************************************************
+ *
+ *  Copyright 2020 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+#include "stream_reader.h"
+
+#include <vector>
+
+TEST(StreamReaderTest, ReadsLikeTheStreamMacros) {
+  std::vector<uint8_t> data{0x01, 0x34, 0x12, 0x78, 0x56, 0x34, 0x12, 0xff,
+                            0x66, 0x55, 0x44, 0x33, 0x22, 0x11};
+  StreamReader reader(data.data(), data.size());
+
+  uint8_t u8;
+  uint16_t u16;
+  uint32_t u32;
+  int8_t s8;
+  RawAddress address;
+  EXPECT_TRUE(reader.Read(&u8, &u16, &u32, &s8, &address));
+  EXPECT_TRUE(reader.Ok());
+  EXPECT_EQ(0u, reader.Remaining());
+
+  uint8_t* p = data.data();
+  uint8_t expected_u8;
+  uint16_t expected_u16;
+  uint32_t expected_u32;
+  RawAddress expected_address;
+  STREAM_TO_UINT8(expected_u8, p);
+  STREAM_TO_UINT16(expected_u16, p);
+  STREAM_TO_UINT32(expected_u32, p);
+  p++;
+  STREAM_TO_BDADDR(expected_address, p);
+
+  EXPECT_EQ(expected_u8, u8);
+  EXPECT_EQ(expected_u16, u16);
+  EXPECT_EQ(expected_u32, u32);
+  EXPECT_EQ(-1, s8);
+  EXPECT_EQ(expected_address, address);
+  EXPECT_EQ(RawAddress({0x11, 0x22, 0x33, 0x44, 0x55, 0x66}), address);
+}
+
+TEST(StreamReaderTest, Layout) {
+  using Layout = StreamLayout<uint8_t, uint16_t, uint8_t>;
+  static_assert(Layout::kSize == 4, "bad layout size");
+
+  std::vector<uint8_t> data{0x01, 0x02, 0x03, 0x04, 0x05};
+  StreamReader reader(data.data(), data.size());
+  auto fields = reader.Read<Layout>();
+  ASSERT_TRUE(fields);
+  EXPECT_EQ(0x01, std::get<0>(*fields));
+  EXPECT_EQ(0x0302, std::get<1>(*fields));
+  EXPECT_EQ(0x04, std::get<2>(*fields));
+  EXPECT_EQ(1u, reader.Remaining());
+  EXPECT_EQ(data.data() + 4, reader.Data());
+
+  EXPECT_FALSE(reader.Read<Layout>());
+  EXPECT_FALSE(reader.Ok());
+}
+
+TEST(StreamReaderTest, FailedReadEmptiesTheReader) {
+  std::vector<uint8_t> data{0x01, 0x02, 0x03};
+  StreamReader reader(data.data(), data.size());
+
+  uint8_t u8 = 0;
+  uint32_t u32 = 0;
+  // Nothing is read when the fields do not all fit
+  EXPECT_FALSE(reader.Read(&u8, &u32));
+  EXPECT_EQ(0, u8);
+  EXPECT_EQ(0u, u32);
+  EXPECT_FALSE(reader.Ok());
+  EXPECT_EQ(0u, reader.Remaining());
+
+  // Even though there would be enough data left for the next read
+  EXPECT_FALSE(reader.Read(&u8));
+}
+
+TEST(StreamReaderTest, Skip) {
+  std::vector<uint8_t> data{0x01, 0x02, 0x03};
+  StreamReader reader(data.data(), data.size());
+  EXPECT_EQ(data.data(), reader.Skip(2));
+  EXPECT_EQ(data.data() + 2, reader.Skip(0));
+  EXPECT_EQ(nullptr, reader.Skip(2));
+  EXPECT_FALSE(reader.Ok());
+}
+
+TEST(StreamReaderTest, Sub) {
+  std::vector<uint8_t> data{0x02, 0x34, 0x12, 0x56};
+  StreamReader reader(data.data(), data.size());
+  uint8_t length;
+  ASSERT_TRUE(reader.Read(&length));
+
+  StreamReader sub = reader.Sub(length);
+  EXPECT_TRUE(sub.Ok());
+  EXPECT_EQ(1u, reader.Remaining());
+
+  // The sub reader does not read past its end, even if its parent could
+  uint16_t u16;
+  EXPECT_TRUE(sub.Read(&u16));
+  EXPECT_EQ(0x1234, u16);
+  uint8_t u8;
+  EXPECT_FALSE(sub.Read(&u8));
+  EXPECT_TRUE(reader.Read(&u8));
+  EXPECT_EQ(0x56, u8);
+
+  // Splitting off more than is left fails both readers
+  StreamReader empty(data.data(), data.size() - 1);
+  StreamReader bad = empty.Sub(data.size());
+  EXPECT_FALSE(bad.Ok());
+  EXPECT_EQ(0u, bad.Remaining());
+  EXPECT_FALSE(empty.Ok());
+}
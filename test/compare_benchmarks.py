@@ -0,0 +1,168 @@
+#!/usr/bin/env python
+#
+# Copyright 2020, The Android Open Source Project
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+from __future__ import print_function
+
+import argparse
+import glob
+import json
+import os
+import re
+import sys
+"""
+Compares the Google Benchmark JSON results written by run_benchmarks.sh -o
+against the results of a baseline run, and fails if a benchmark got slower by
+more than its threshold.
+
+Both directories hold one <binary>.<iteration>.json file per run of a
+benchmark binary. Each benchmark is compared on the median over the runs, so
+that a single noisy run does not fail the comparison. Benchmarks only found in
+one of the directories are reported, but don't fail the comparison.
+
+Example usage:
+  $ ./test/compare_benchmarks.py baseline/ current/ --threshold 5 \\
+        --threshold-for 'bluetooth_benchmark_gd/BM_Gatt.*=10'
+"""
+
+TIME_UNITS_NS = {
+    'ns': 1.0,
+    'us': 1e3,
+    'ms': 1e6,
+    's': 1e9,
+}
+
+
+def median(values):
+    values = sorted(values)
+    middle = len(values) // 2
+    if len(values) % 2:
+        return values[middle]
+    return (values[middle - 1] + values[middle]) / 2.0
+
+
+def load_results(directory, metric):
+    """ Returns the median |metric| in ns of every <binary>/<benchmark>. """
+    samples = {}
+    for path in sorted(glob.glob(os.path.join(directory, '*.json'))):
+        binary = os.path.basename(path).split('.')[0]
+        with open(path) as f:
+            try:
+                results = json.load(f)
+            except ValueError as e:
+                print('Skipping %s: %s' % (path, e), file=sys.stderr)
+                continue
+        for benchmark in results.get('benchmarks', []):
+            # Only compare the runs, the aggregates are computed from them
+            if benchmark.get('run_type', 'iteration') != 'iteration':
+                continue
+            if 'error_occurred' in benchmark:
+                continue
+            name = '%s/%s' % (binary, benchmark['name'])
+            unit = TIME_UNITS_NS[benchmark.get('time_unit', 'ns')]
+            samples.setdefault(name, []).append(benchmark[metric] * unit)
+    return dict((name, median(values)) for name, values in samples.items())
+
+
+def parse_threshold_override(argument):
+    pattern, separator, threshold = argument.rpartition('=')
+    if not separator or not pattern:
+        raise argparse.ArgumentTypeError(
+            'expected <regex>=<percent>, got %s' % argument)
+    return re.compile(pattern), float(threshold)
+
+
+def threshold_for(name, default_threshold, overrides):
+    for pattern, threshold in overrides:
+        if pattern.search(name):
+            return threshold
+    return default_threshold
+
+
+def format_time(time_ns):
+    for unit in ['ns', 'us', 'ms']:
+        if time_ns < 1e3:
+            return '%.1f %s' % (time_ns, unit)
+        time_ns /= 1e3
+    return '%.2f s' % time_ns
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Compare benchmark results against a baseline.')
+    parser.add_argument(
+        'baseline', help='directory of the JSON results of the baseline')
+    parser.add_argument(
+        'current', help='directory of the JSON results to compare')
+    parser.add_argument(
+        '--metric',
+        choices=['real_time', 'cpu_time'],
+        default='real_time',
+        help='time compared, real_time by default')
+    parser.add_argument(
+        '--threshold',
+        type=float,
+        default=5.0,
+        help='slowdown in percent that fails a benchmark, 5 by default')
+    parser.add_argument(
+        '--threshold-for',
+        type=parse_threshold_override,
+        action='append',
+        default=[],
+        metavar='REGEX=PERCENT',
+        help='threshold of the benchmarks whose <binary>/<benchmark> name ' +
+        'matches REGEX, the first match is used')
+    args = parser.parse_args()
+
+    baseline = load_results(args.baseline, args.metric)
+    current = load_results(args.current, args.metric)
+    if not current:
+        print('No results in %s' % args.current, file=sys.stderr)
+        return 2
+
+    regressions = []
+    print('%-70s %12s %12s %9s' % ('Benchmark', 'Baseline', 'Current',
+                                   'Change'))
+    for name in sorted(set(baseline) | set(current)):
+        if name not in current:
+            print('%-70s %12s %12s %9s' %
+                  (name, format_time(baseline[name]), '-', 'missing'))
+            continue
+        if name not in baseline:
+            print('%-70s %12s %12s %9s' %
+                  (name, '-', format_time(current[name]), 'new'))
+            continue
+        change = 0.0
+        if baseline[name] > 0:
+            change = (current[name] - baseline[name]) * 100.0 / baseline[name]
+        threshold = threshold_for(name, args.threshold, args.threshold_for)
+        status = ''
+        if change > threshold:
+            status = ' REGRESSION (threshold %.1f%%)' % threshold
+            regressions.append(name)
+        print('%-70s %12s %12s %+8.1f%%%s' %
+              (name, format_time(baseline[name]), format_time(current[name]),
+               change, status))
+
+    if regressions:
+        print('\n%d benchmark(s) regressed:' % len(regressions))
+        for name in regressions:
+            print('    %s' % name)
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
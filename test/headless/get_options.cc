@@ -27,7 +27,11 @@ namespace {
 constexpr struct option long_options[] = {
     {"device", required_argument, 0, 0}, {"loop", required_argument, 0, 0},
     {"uuid", required_argument, 0, 0},   {"msleep", required_argument, 0, 0},
-    {"stderr", no_argument, 0, 0},       {0, 0, 0, 0}};
+    {"stderr", no_argument, 0, 0},       {"mtu", required_argument, 0, 0},
+    {"window", required_argument, 0, 0}, {"count", required_argument, 0, 0},
+    {"size", required_argument, 0, 0},   {"psm", required_argument, 0, 0},
+    {"scn", required_argument, 0, 0},    {"le", no_argument, 0, 0},
+    {0, 0, 0, 0}};
 
 enum OptionType {
   kOptionDevice = 0,
@@ -35,6 +39,13 @@ enum OptionType {
   kOptionUuid = 2,
   kOptionMsleep = 3,
   kOptionStdErr = 4,
+  kOptionMtu = 5,
+  kOptionWindow = 6,
+  kOptionCount = 7,
+  kOptionSize = 8,
+  kOptionPsm = 9,
+  kOptionScn = 10,
+  kOptionLe = 11,
 };
 
 }  // namespace
@@ -49,6 +60,21 @@ void bluetooth::test::headless::GetOpt::Usage() const {
   fprintf(stdout, "%s  --loop=<loop>       Number of loops\n", name_);
   fprintf(stdout, "%s  --msleep=<msecs>    Sleep msec between loops\n", name_);
   fprintf(stdout, "%s  --stderr            Dump stderr to stdout\n", name_);
+  fprintf(stdout, "%s  --mtu=<mtu>         Local MTU of the perf channel\n",
+          name_);
+  fprintf(stdout, "%s  --window=<frames>   ERTM transmit window of the perf\n",
+          name_);
+  fprintf(stdout, "%s                      channel, basic mode if unset\n",
+          name_);
+  fprintf(stdout, "%s  --count=<count>     Number of packets to send\n",
+          name_);
+  fprintf(stdout, "%s  --size=<bytes>      Size of the packets, MTU if unset\n",
+          name_);
+  fprintf(stdout, "%s  --psm=<psm>         PSM of the perf L2CAP channel\n",
+          name_);
+  fprintf(stdout, "%s  --scn=<scn>         SCN of the perf RFCOMM channel\n",
+          name_);
+  fprintf(stdout, "%s  --le                Use the LE transport\n", name_);
   fflush(nullptr);
 }
 
@@ -103,6 +129,27 @@ void bluetooth::test::headless::GetOpt::ProcessOption(int option_index,
     case kOptionStdErr:
       close_stderr_ = false;
       break;
+    case kOptionMtu:
+      mtu_ = std::stoul(optarg, nullptr, 0);
+      break;
+    case kOptionWindow:
+      window_ = std::stoul(optarg, nullptr, 0);
+      break;
+    case kOptionCount:
+      count_ = std::stoul(optarg, nullptr, 0);
+      break;
+    case kOptionSize:
+      size_ = std::stoul(optarg, nullptr, 0);
+      break;
+    case kOptionPsm:
+      psm_ = std::stoul(optarg, nullptr, 0);
+      break;
+    case kOptionScn:
+      scn_ = std::stoul(optarg, nullptr, 0);
+      break;
+    case kOptionLe:
+      le_ = true;
+      break;
     default:
       fflush(nullptr);
       valid_ = false;
@@ -44,6 +44,15 @@ class GetOpt {
   unsigned long loop_{1};
   unsigned long msec_{0};
 
+  // Parameters of the perf channels, 0 for their default
+  unsigned long mtu_{0};
+  unsigned long window_{0};
+  unsigned long count_{1000};
+  unsigned long size_{0};
+  unsigned long psm_{0};
+  unsigned long scn_{0};
+  bool le_{false};
+
   bool close_stderr_{true};
 
   mutable std::list<std::string> non_options_;
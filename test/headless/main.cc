@@ -24,6 +24,7 @@
 #include "test/headless/headless.h"
 #include "test/headless/nop/nop.h"
 #include "test/headless/pairing/pairing.h"
+#include "test/headless/perf/perf.h"
 #include "test/headless/read/read.h"
 #include "test/headless/sdp/sdp.h"
 
@@ -40,6 +41,8 @@ class Main : public HeadlessTest<int> {
     test_nodes_.emplace(
         "pairing",
         std::make_unique<bluetooth::test::headless::Pairing>(options));
+    test_nodes_.emplace(
+        "perf", std::make_unique<bluetooth::test::headless::Perf>(options));
     test_nodes_.emplace(
         "read", std::make_unique<bluetooth::test::headless::Read>(options));
     test_nodes_.emplace(
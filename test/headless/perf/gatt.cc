@@ -0,0 +1,369 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define LOG_TAG "bt_headless_perf"
+
+#include "test/headless/perf/gatt.h"
+
+#include <base/bind.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <vector>
+
+#include "base/logging.h"     // LOG() stdout and android log
+#include "osi/include/log.h"  // android log only
+#include "stack/include/btu.h"
+#include "stack/include/gatt_api.h"
+#include "test/headless/get_options.h"
+#include "test/headless/headless.h"
+#include "test/headless/perf/perf.h"
+#include "test/headless/perf/perf_stats.h"
+#include "types/bluetooth/uuid.h"
+#include "types/raw_address.h"
+
+using bluetooth::Uuid;
+using namespace bluetooth::test::headless;
+
+namespace {
+
+const Uuid kPerfAppUuid =
+    Uuid::FromString("6a3c5c1e-52a4-4b43-9b6e-3c1f0d6f7e01");
+const Uuid kPerfServiceUuid =
+    Uuid::FromString("6a3c5c1e-52a4-4b43-9b6e-3c1f0d6f7e02");
+const Uuid kPerfCharUuid =
+    Uuid::FromString("6a3c5c1e-52a4-4b43-9b6e-3c1f0d6f7e03");
+// Header of the ATT write requests and notifications
+constexpr uint16_t kAttHeaderSize = 3;
+constexpr std::chrono::seconds kClientTimeout(120);
+
+using Clock = std::chrono::steady_clock;
+
+// The perf GATT client or server, only touched on the main thread once open
+struct Session {
+  bool is_server;
+  RawAddress address;
+  uint16_t mtu;
+  unsigned long count;
+  unsigned long size;
+
+  tGATT_IF gatt_if{0};
+  uint16_t conn_id{GATT_INVALID_CONN_ID};
+  uint16_t char_handle{0};
+  uint16_t att_mtu{GATT_DEF_BLE_MTU_SIZE};
+  bool finished{false};
+  unsigned long written{0};
+  unsigned long notified{0};
+  std::vector<Clock::time_point> write_times;
+  PerfStats write_stats;
+  PerfStats notify_stats;
+  std::promise<int> done;
+};
+
+Session* session = nullptr;
+
+void Finish(int rc) {
+  if (session->finished) return;
+  session->finished = true;
+  session->write_stats.Stop();
+  session->notify_stats.Stop();
+  session->done.set_value(rc);
+}
+
+std::chrono::microseconds Since(Clock::time_point time) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() -
+                                                               time);
+}
+
+// Writes the next value, carrying its sequence number in its first bytes
+void Write() {
+  uint32_t seq = session->written;
+  tGATT_VALUE value;
+  memset(&value, 0, sizeof(value));
+  value.conn_id = session->conn_id;
+  value.handle = session->char_handle;
+  value.len = session->size;
+  memset(value.value, 0x5a, value.len);
+  for (size_t i = 0; i < sizeof(seq) && i < value.len; i++) {
+    value.value[i] = seq >> (8 * i);
+  }
+  session->write_times[seq] = Clock::now();
+  tGATT_STATUS status = GATTC_Write(session->conn_id, GATT_WRITE, &value);
+  if (status != GATT_SUCCESS) {
+    LOG(ERROR) << "Unable to write the perf characteristic status:" << +status;
+    Finish(-2);
+  }
+}
+
+void StartWrites() {
+  uint16_t max_size = std::min<uint16_t>(session->att_mtu - kAttHeaderSize,
+                                         GATT_MAX_ATTR_LEN);
+  if (session->size == 0 || session->size > max_size) session->size = max_size;
+  fprintf(stdout, "Perf characteristic handle:0x%04hx att mtu:%hu size:%lu\n",
+          session->char_handle, session->att_mtu, session->size);
+  session->write_times.resize(session->count);
+  session->write_stats.Start();
+  session->notify_stats.Start();
+  Write();
+}
+
+void ConnCallback(tGATT_IF gatt_if, const RawAddress& bda, uint16_t conn_id,
+                  bool connected, tGATT_DISCONN_REASON reason,
+                  tBT_TRANSPORT transport) {
+  if (session == nullptr || session->gatt_if != gatt_if) return;
+  if (!connected) {
+    if (conn_id != session->conn_id) return;
+    session->conn_id = GATT_INVALID_CONN_ID;
+    // The server is done when the client disconnects
+    Finish(session->is_server ? 0 : -3);
+    return;
+  }
+  if (session->conn_id != GATT_INVALID_CONN_ID) return;
+  session->conn_id = conn_id;
+  fprintf(stdout, "Perf GATT connected mac:%s\n", bda.ToString().c_str());
+  if (session->is_server) return;
+
+  if (session->mtu != 0) {
+    GATTC_ConfigureMTU(conn_id, session->mtu);
+  } else {
+    GATTC_Discover(conn_id, GATT_DISC_CHAR, 0x0001, 0xffff);
+  }
+}
+
+void DiscoveryResultCallback(uint16_t conn_id, tGATT_DISC_TYPE disc_type,
+                             tGATT_DISC_RES* p_data) {
+  if (session == nullptr || disc_type != GATT_DISC_CHAR) return;
+  if (p_data->value.dclr_value.char_uuid == kPerfCharUuid) {
+    session->char_handle = p_data->value.dclr_value.val_handle;
+  }
+}
+
+void DiscoveryCompleteCallback(uint16_t conn_id, tGATT_DISC_TYPE disc_type,
+                               tGATT_STATUS status) {
+  if (session == nullptr || disc_type != GATT_DISC_CHAR) return;
+  if (session->char_handle == 0) {
+    fprintf(stdout, "No perf characteristic on the server status:%d\n",
+            status);
+    Finish(-1);
+    return;
+  }
+  StartWrites();
+}
+
+void CompleteCallback(uint16_t conn_id, tGATTC_OPTYPE op, tGATT_STATUS status,
+                      tGATT_CL_COMPLETE* p_data) {
+  if (session == nullptr || session->finished) return;
+  switch (op) {
+    case GATTC_OPTYPE_CONFIG:
+      if (status == GATT_SUCCESS) session->att_mtu = p_data->mtu;
+      GATTC_Discover(conn_id, GATT_DISC_CHAR, 0x0001, 0xffff);
+      break;
+    case GATTC_OPTYPE_WRITE:
+      if (status != GATT_SUCCESS) {
+        fprintf(stdout, "Perf write failed status:%d\n", status);
+        Finish(-2);
+        return;
+      }
+      session->write_stats.AddPacket(session->size);
+      session->write_stats.AddLatency(
+          Since(session->write_times[session->written]));
+      if (++session->written < session->count) Write();
+      break;
+    case GATTC_OPTYPE_NOTIFICATION: {
+      const tGATT_VALUE& value = p_data->att_value;
+      if (value.handle != session->char_handle) return;
+      uint32_t seq = 0;
+      for (size_t i = 0; i < sizeof(seq) && i < value.len; i++) {
+        seq |= value.value[i] << (8 * i);
+      }
+      session->notify_stats.AddPacket(value.len);
+      if (seq < session->count) {
+        session->notify_stats.AddLatency(Since(session->write_times[seq]));
+      }
+      if (++session->notified == session->count) Finish(0);
+    } break;
+    default:
+      break;
+  }
+}
+
+void RequestCallback(uint16_t conn_id, uint32_t trans_id, tGATTS_REQ_TYPE type,
+                     tGATTS_DATA* p_data) {
+  if (session == nullptr) return;
+  tGATTS_RSP rsp_msg;
+  memset(&rsp_msg, 0, sizeof(rsp_msg));
+  tGATT_STATUS status = GATT_SUCCESS;
+  bool ignore = false;
+
+  switch (type) {
+    case GATTS_REQ_TYPE_WRITE_CHARACTERISTIC: {
+      tGATT_WRITE_REQ& write = p_data->write_req;
+      ignore = !write.need_rsp;
+      if (write.handle != session->char_handle) {
+        status = GATT_NOT_FOUND;
+        break;
+      }
+      rsp_msg.handle = write.handle;
+      session->write_stats.AddPacket(write.len);
+      // Echo the value back before the response, so that it is queued first
+      if (GATTS_HandleValueNotification(conn_id, write.handle, write.len,
+                                        write.value) == GATT_SUCCESS) {
+        session->notify_stats.AddPacket(write.len);
+      }
+    } break;
+    case GATTS_REQ_TYPE_MTU:
+    case GATTS_REQ_TYPE_WRITE_EXEC:
+      ignore = true;
+      break;
+    default:
+      status = GATT_REQ_NOT_SUPPORTED;
+      break;
+  }
+
+  if (!ignore) GATTS_SendRsp(conn_id, trans_id, status, &rsp_msg);
+}
+
+tGATT_CBACK perf_cback = {ConnCallback,
+                          CompleteCallback,
+                          DiscoveryResultCallback,
+                          DiscoveryCompleteCallback,
+                          RequestCallback,
+                          NULL,
+                          NULL,
+                          NULL,
+                          NULL};
+
+void Open() {
+  session->gatt_if = GATT_Register(kPerfAppUuid, &perf_cback);
+  if (session->gatt_if == 0) {
+    fprintf(stdout, "Unable to register the perf GATT application\n");
+    Finish(-1);
+    return;
+  }
+  GATT_StartIf(session->gatt_if);
+
+  if (session->is_server) {
+    btgatt_db_element_t service[] = {
+        {
+            .uuid = kPerfServiceUuid,
+            .type = BTGATT_DB_PRIMARY_SERVICE,
+        },
+        {.uuid = kPerfCharUuid,
+         .type = BTGATT_DB_CHARACTERISTIC,
+         .properties = GATT_CHAR_PROP_BIT_WRITE | GATT_CHAR_PROP_BIT_NOTIFY,
+         .permissions = GATT_PERM_WRITE}};
+    if (GATTS_AddService(session->gatt_if, service,
+                         sizeof(service) / sizeof(btgatt_db_element_t)) !=
+        GATT_SERVICE_STARTED) {
+      fprintf(stdout, "Unable to add the perf GATT service\n");
+      Finish(-1);
+      return;
+    }
+    session->char_handle = service[1].attribute_handle;
+    return;
+  }
+
+  if (!GATT_Connect(session->gatt_if, session->address, true, BT_TRANSPORT_LE,
+                    false)) {
+    fprintf(stdout, "Unable to connect to mac:%s\n",
+            session->address.ToString().c_str());
+    Finish(-1);
+  }
+}
+
+void Close() {
+  if (session->gatt_if == 0) return;
+  if (session->conn_id != GATT_INVALID_CONN_ID) {
+    GATT_Disconnect(session->conn_id);
+  }
+  GATT_Deregister(session->gatt_if);
+  session->gatt_if = 0;
+}
+
+}  // namespace
+
+int bluetooth::test::headless::GattPerf::Run() {
+  if (options_.loop_ < 1) {
+    fprintf(stdout, "This test requires at least a single loop\n");
+    options_.Usage();
+    return -1;
+  }
+  if (options_.device_.size() > 1) {
+    fprintf(stdout, "This test requires at most a single device specified\n");
+    options_.Usage();
+    return -1;
+  }
+  if (options_.count_ == 0) {
+    fprintf(stdout, "This test requires at least a single packet\n");
+    options_.Usage();
+    return -1;
+  }
+  if (options_.mtu_ > GATT_MAX_MTU_SIZE) {
+    fprintf(stdout, "This test requires an MTU of at most %d bytes\n",
+            GATT_MAX_MTU_SIZE);
+    options_.Usage();
+    return -1;
+  }
+
+  return RunOnHeadlessStack<int>([this]() {
+    Session perf_session;
+    perf_session.is_server = options_.device_.empty();
+    if (!perf_session.is_server) {
+      perf_session.address = options_.device_.front();
+    }
+    perf_session.mtu = options_.mtu_;
+    perf_session.count = options_.count_;
+    perf_session.size = options_.size_;
+
+    if (perf_session.is_server) MakeConnectable(true);
+
+    auto future = perf_session.done.get_future();
+    DoInMainThreadAndWait(base::BindOnce(
+        [](Session* perf_session) {
+          session = perf_session;
+          Open();
+        },
+        &perf_session));
+
+    int rc;
+    if (perf_session.is_server) {
+      rc = future.get();
+    } else if (future.wait_for(kClientTimeout) == std::future_status::ready) {
+      rc = future.get();
+    } else {
+      fprintf(stdout, "Timeout with %lu/%lu values written\n",
+              perf_session.written, perf_session.count);
+      rc = -4;
+    }
+
+    DoInMainThreadAndWait(base::BindOnce([]() {
+      Close();
+      session = nullptr;
+    }));
+
+    if (perf_session.is_server) {
+      perf_session.write_stats.Print(stdout, "gatt writes received", "none");
+      perf_session.notify_stats.Print(stdout, "gatt notifications sent",
+                                      "none");
+    } else {
+      perf_session.write_stats.Print(stdout, "gatt writes", "rsp");
+      perf_session.notify_stats.Print(stdout, "gatt notifications", "rtt");
+    }
+    return rc;
+  });
+}
@@ -0,0 +1,40 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include "test/headless/get_options.h"
+#include "test/headless/headless.h"
+
+namespace bluetooth {
+namespace test {
+namespace headless {
+
+// Write and notification rate and latency over GATT on LE. The client writes
+// --count values of --size bytes to the perf characteristic of the server,
+// each once the previous one was acknowledged, and the server notifies each
+// of them back.
+class GattPerf : public HeadlessTest<int> {
+ public:
+  GattPerf(const bluetooth::test::headless::GetOpt& options)
+      : HeadlessTest<int>(options) {}
+  int Run() override;
+};
+
+}  // namespace headless
+}  // namespace test
+}  // namespace bluetooth
@@ -0,0 +1,361 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define LOG_TAG "bt_headless_perf"
+
+#include "test/headless/perf/l2cap.h"
+
+#include <base/bind.h>
+#include <string.h>
+#include <chrono>
+#include <future>
+
+#include "base/logging.h"     // LOG() stdout and android log
+#include "osi/include/allocator.h"
+#include "osi/include/log.h"  // android log only
+#include "stack/include/btm_api.h"
+#include "stack/include/btu.h"
+#include "stack/include/gap_api.h"
+#include "stack/include/l2c_api.h"
+#include "test/headless/get_options.h"
+#include "test/headless/headless.h"
+#include "test/headless/perf/perf.h"
+#include "test/headless/perf/perf_stats.h"
+#include "types/raw_address.h"
+
+using namespace bluetooth::test::headless;
+
+namespace {
+
+constexpr uint16_t kPerfPsm = 0x1001;
+constexpr uint16_t kPerfLeCocPsm = 0x0080;
+constexpr uint8_t kPerfSecServiceId = BTM_SEC_SERVICE_FIRST_EMPTY;
+constexpr uint16_t kPerfMtu = L2CAP_MTU_SIZE;
+// Largest window without the extended window size option
+constexpr unsigned long kMaxErtmWindow = 63;
+// Packets written to GAP in a row before letting the main thread run others
+constexpr unsigned long kMaxBurst = 8;
+constexpr std::chrono::seconds kClientTimeout(120);
+
+enum class Role { kSource, kSink, kPing, kEcho };
+
+// The perf channel, only touched on the main thread once opened
+struct Channel {
+  Role role;
+  RawAddress address;
+  bool le;
+  uint16_t psm;
+  uint16_t mtu;
+  uint8_t window;
+  unsigned long count;
+  unsigned long size;
+
+  uint16_t handle{GAP_INVALID_HANDLE};
+  bool congested{false};
+  bool finished{false};
+  unsigned long sent{0};
+  unsigned long received{0};
+  std::chrono::steady_clock::time_point last_time;
+  PerfStats stats;
+  std::promise<int> done;
+};
+
+Channel* channel = nullptr;
+
+bool IsServer(Role role) { return role == Role::kSink || role == Role::kEcho; }
+
+const char* RoleName(Role role) {
+  switch (role) {
+    case Role::kSource:
+      return "l2cap source";
+    case Role::kSink:
+      return "l2cap sink";
+    case Role::kPing:
+      return "l2cap ping";
+    case Role::kEcho:
+      return "l2cap echo";
+  }
+  return "l2cap";
+}
+
+void Finish(int rc) {
+  if (channel->finished) return;
+  channel->finished = true;
+  channel->stats.Stop();
+  channel->done.set_value(rc);
+}
+
+// A packet carrying its sequence number in its first bytes
+BT_HDR* AllocatePacket(uint32_t seq, size_t size) {
+  BT_HDR* p_buf = (BT_HDR*)osi_malloc(sizeof(BT_HDR) + L2CAP_MIN_OFFSET + size);
+  p_buf->offset = L2CAP_MIN_OFFSET;
+  p_buf->len = size;
+  p_buf->layer_specific = 0;
+  uint8_t* p = (uint8_t*)(p_buf + 1) + p_buf->offset;
+  memset(p, 0x5a, size);
+  for (size_t i = 0; i < sizeof(seq) && i < size; i++) p[i] = seq >> (8 * i);
+  return p_buf;
+}
+
+bool Write(BT_HDR* p_buf) {
+  uint16_t status = GAP_ConnWriteData(channel->handle, p_buf);
+  if (status != BT_PASS) {
+    LOG(ERROR) << "Unable to write to the perf channel status:" << status;
+    Finish(-2);
+    return false;
+  }
+  return true;
+}
+
+void Send() {
+  if (channel == nullptr || channel->finished) return;
+  unsigned long burst = 0;
+  while (!channel->congested && channel->sent < channel->count &&
+         burst++ < kMaxBurst) {
+    if (!Write(AllocatePacket(channel->sent, channel->size))) return;
+    channel->sent++;
+    channel->stats.AddPacket(channel->size);
+  }
+  // Completed on GAP_EVT_TX_EMPTY once all the packets are written
+  if (!channel->congested && channel->sent < channel->count) {
+    do_in_main_thread(FROM_HERE, base::BindOnce(&Send));
+  }
+}
+
+void SendPing() {
+  channel->last_time = std::chrono::steady_clock::now();
+  if (Write(AllocatePacket(channel->sent, channel->size))) channel->sent++;
+}
+
+void Receive(BT_HDR* p_buf) {
+  auto now = std::chrono::steady_clock::now();
+  channel->received++;
+  channel->stats.AddPacket(p_buf->len);
+  switch (channel->role) {
+    case Role::kSink:
+      // The gaps between the packets, the first one starts the clocks
+      if (channel->received > 1) {
+        channel->stats.AddLatency(
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                now - channel->last_time));
+      }
+      channel->last_time = now;
+      if (channel->received == channel->count) channel->stats.Stop();
+      break;
+    case Role::kEcho:
+      Write(AllocatePacket(channel->received - 1, p_buf->len));
+      break;
+    case Role::kPing:
+      channel->stats.AddLatency(
+          std::chrono::duration_cast<std::chrono::microseconds>(
+              now - channel->last_time));
+      if (channel->received == channel->count) {
+        Finish(0);
+      } else {
+        SendPing();
+      }
+      break;
+    case Role::kSource:
+      break;
+  }
+  osi_free(p_buf);
+}
+
+void ChannelCallback(uint16_t gap_handle, uint16_t event, tGAP_CB_DATA*) {
+  if (channel == nullptr || channel->handle != gap_handle) return;
+
+  switch (event) {
+    case GAP_EVT_CONN_OPENED: {
+      uint16_t rem_mtu = GAP_ConnGetRemMtuSize(gap_handle);
+      if (channel->size == 0 || channel->size > rem_mtu) {
+        channel->size = rem_mtu;
+      }
+      fprintf(stdout, "Perf channel opened psm:0x%04x remote mtu:%hu\n",
+              channel->psm, rem_mtu);
+      if (channel->role == Role::kSource) {
+        channel->stats.Start();
+        Send();
+      } else if (channel->role == Role::kPing) {
+        channel->stats.Start();
+        SendPing();
+      }
+    } break;
+    case GAP_EVT_CONN_DATA_AVAIL: {
+      BT_HDR* p_buf;
+      while (GAP_ConnBTRead(gap_handle, &p_buf) == BT_PASS) {
+        Receive(p_buf);
+        if (channel->finished) break;
+      }
+    } break;
+    case GAP_EVT_CONN_CONGESTED:
+      channel->congested = true;
+      break;
+    case GAP_EVT_CONN_UNCONGESTED:
+      channel->congested = false;
+      if (channel->role == Role::kSource) Send();
+      break;
+    case GAP_EVT_TX_EMPTY:
+      if (channel->role == Role::kSource && channel->sent == channel->count) {
+        Finish(0);
+      }
+      break;
+    case GAP_EVT_CONN_CLOSED:
+      // The server is done when the client closes the channel
+      channel->handle = GAP_INVALID_HANDLE;
+      Finish(IsServer(channel->role) ? 0 : -3);
+      break;
+  }
+}
+
+void Open() {
+  bool is_server = IsServer(channel->role);
+
+  tL2CAP_CFG_INFO cfg;
+  memset(&cfg, 0, sizeof(cfg));
+  cfg.mtu_present = true;
+  cfg.mtu = channel->mtu;
+
+  // The window is the one of the enhanced retransmission mode, so the LE CoCs
+  // run with the default credits of the stack
+  tL2CAP_ERTM_INFO ertm_info;
+  tL2CAP_ERTM_INFO* p_ertm_info = nullptr;
+  uint8_t chan_mode_mask = GAP_FCR_CHAN_OPT_BASIC;
+  if (channel->window != 0 && !channel->le) {
+    cfg.fcr_present = true;
+    cfg.fcr = {L2CAP_FCR_ERTM_MODE,
+               channel->window,
+               OBX_FCR_OPT_MAX_TX_B4_DISCNT,
+               OBX_FCR_OPT_RETX_TOUT,
+               OBX_FCR_OPT_MONITOR_TOUT,
+               OBX_FCR_OPT_MAX_PDU_SIZE};
+    ertm_info = {L2CAP_FCR_ERTM_MODE, L2CAP_FCR_CHAN_OPT_ERTM,
+                 OBX_USER_RX_BUF_SIZE, OBX_USER_TX_BUF_SIZE,
+                 OBX_FCR_RX_BUF_SIZE,  OBX_FCR_TX_BUF_SIZE};
+    p_ertm_info = &ertm_info;
+    chan_mode_mask = GAP_FCR_CHAN_OPT_ERTM;
+  }
+
+  uint16_t max_mps = 0xffff;  // Let GAP_ConnOpen set the max_mps.
+  channel->handle = GAP_ConnOpen(
+      "Perf", kPerfSecServiceId, is_server,
+      is_server ? nullptr : &channel->address, channel->psm, max_mps, &cfg,
+      p_ertm_info, BTM_SEC_NONE, chan_mode_mask, ChannelCallback,
+      channel->le ? BT_TRANSPORT_LE : BT_TRANSPORT_BR_EDR);
+  if (channel->handle == GAP_INVALID_HANDLE) {
+    fprintf(stdout, "Unable to open the perf channel psm:0x%04x\n",
+            channel->psm);
+    Finish(-1);
+  }
+}
+
+void Close() {
+  if (channel->handle != GAP_INVALID_HANDLE) GAP_ConnClose(channel->handle);
+  channel->handle = GAP_INVALID_HANDLE;
+}
+
+int RunChannel(const bluetooth::test::headless::GetOpt& options, Role role,
+               const char* latency_name) {
+  Channel perf_channel;
+  perf_channel.role = role;
+  if (!options.device_.empty()) perf_channel.address = options.device_.front();
+  perf_channel.le = options.le_;
+  perf_channel.psm = options.psm_;
+  if (perf_channel.psm == 0) {
+    perf_channel.psm = options.le_ ? kPerfLeCocPsm : kPerfPsm;
+  }
+  perf_channel.mtu = options.mtu_ ? options.mtu_ : kPerfMtu;
+  perf_channel.window = options.window_;
+  perf_channel.count = options.count_;
+  perf_channel.size = options.size_;
+
+  bool is_server = IsServer(role);
+  if (is_server) MakeConnectable(options.le_);
+
+  auto future = perf_channel.done.get_future();
+  DoInMainThreadAndWait(base::BindOnce(
+      [](Channel* perf_channel) {
+        channel = perf_channel;
+        Open();
+      },
+      &perf_channel));
+
+  int rc;
+  if (is_server) {
+    rc = future.get();
+  } else if (future.wait_for(kClientTimeout) == std::future_status::ready) {
+    rc = future.get();
+  } else {
+    fprintf(stdout, "Timeout with %lu/%lu packets sent\n", perf_channel.sent,
+            perf_channel.count);
+    rc = -4;
+  }
+
+  DoInMainThreadAndWait(base::BindOnce([]() {
+    Close();
+    channel = nullptr;
+  }));
+
+  perf_channel.stats.Print(stdout, RoleName(role), latency_name);
+  return rc;
+}
+
+bool CheckOptions(const bluetooth::test::headless::GetOpt& options) {
+  if (options.loop_ < 1) {
+    fprintf(stdout, "This test requires at least a single loop\n");
+    options.Usage();
+    return false;
+  }
+  if (options.device_.size() > 1) {
+    fprintf(stdout, "This test requires at most a single device specified\n");
+    options.Usage();
+    return false;
+  }
+  if (options.count_ == 0) {
+    fprintf(stdout, "This test requires at least a single packet\n");
+    options.Usage();
+    return false;
+  }
+  if (options.window_ > kMaxErtmWindow) {
+    fprintf(stdout, "This test requires a window of at most %lu frames\n",
+            kMaxErtmWindow);
+    options.Usage();
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+int bluetooth::test::headless::L2capPerf::Run() {
+  if (!CheckOptions(options_)) return -1;
+
+  return RunOnHeadlessStack<int>([this]() {
+    return RunChannel(options_,
+                      options_.device_.empty() ? Role::kSink : Role::kSource,
+                      "gap");
+  });
+}
+
+int bluetooth::test::headless::PingPerf::Run() {
+  if (!CheckOptions(options_)) return -1;
+
+  return RunOnHeadlessStack<int>([this]() {
+    return RunChannel(options_,
+                      options_.device_.empty() ? Role::kEcho : Role::kPing,
+                      "rtt");
+  });
+}
@@ -0,0 +1,47 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include "test/headless/get_options.h"
+#include "test/headless/headless.h"
+
+namespace bluetooth {
+namespace test {
+namespace headless {
+
+// Bulk throughput over an L2CAP channel, or an LE CoC with --le. The client
+// sends --count packets of --size bytes, the server sinks them.
+class L2capPerf : public HeadlessTest<int> {
+ public:
+  L2capPerf(const bluetooth::test::headless::GetOpt& options)
+      : HeadlessTest<int>(options) {}
+  int Run() override;
+};
+
+// Round trip time over the same channel. The client sends --count packets one
+// at a time, each once the server echoed the previous one.
+class PingPerf : public HeadlessTest<int> {
+ public:
+  PingPerf(const bluetooth::test::headless::GetOpt& options)
+      : HeadlessTest<int>(options) {}
+  int Run() override;
+};
+
+}  // namespace headless
+}  // namespace test
+}  // namespace bluetooth
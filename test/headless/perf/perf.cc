@@ -0,0 +1,73 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define LOG_TAG "bt_headless_perf"
+
+#include "test/headless/perf/perf.h"
+
+#include <base/bind.h>
+#include <future>
+
+#include "base/logging.h"     // LOG() stdout and android log
+#include "osi/include/log.h"  // android log only
+#include "stack/include/btm_api.h"
+#include "stack/include/btu.h"
+#include "test/headless/get_options.h"
+#include "test/headless/headless.h"
+#include "test/headless/perf/gatt.h"
+#include "test/headless/perf/l2cap.h"
+#include "test/headless/perf/rfcomm.h"
+
+using namespace bluetooth::test::headless;
+
+Perf::Perf(const bluetooth::test::headless::GetOpt& options)
+    : HeadlessTest<int>(options) {
+  test_nodes_.emplace(
+      "gatt", std::make_unique<bluetooth::test::headless::GattPerf>(options));
+  test_nodes_.emplace(
+      "l2cap", std::make_unique<bluetooth::test::headless::L2capPerf>(options));
+  test_nodes_.emplace(
+      "ping", std::make_unique<bluetooth::test::headless::PingPerf>(options));
+  test_nodes_.emplace(
+      "rfcomm",
+      std::make_unique<bluetooth::test::headless::RfcommPerf>(options));
+}
+
+void bluetooth::test::headless::DoInMainThreadAndWait(base::OnceClosure task) {
+  std::promise<void> promise;
+  auto future = promise.get_future();
+  do_in_main_thread(FROM_HERE, base::BindOnce(
+                                   [](base::OnceClosure task,
+                                      std::promise<void>* promise) {
+                                     std::move(task).Run();
+                                     promise->set_value();
+                                   },
+                                   std::move(task), &promise));
+  future.wait();
+}
+
+void bluetooth::test::headless::MakeConnectable(bool le) {
+  DoInMainThreadAndWait(base::BindOnce(
+      [](bool le) {
+        uint16_t mode = BTM_CONNECTABLE | (le ? BTM_BLE_CONNECTABLE : 0);
+        if (BTM_SetConnectability(mode, BTM_DEFAULT_CONN_WINDOW,
+                                  BTM_DEFAULT_CONN_INTERVAL) != BTM_SUCCESS) {
+          LOG(WARNING) << "Unable to make the local device connectable";
+        }
+      },
+      le));
+}
@@ -0,0 +1,46 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <base/callback.h>
+
+#include "test/headless/get_options.h"
+#include "test/headless/headless.h"
+
+namespace bluetooth {
+namespace test {
+namespace headless {
+
+// Load generators measuring the throughput and latency of the data paths of
+// the stack. Each test is a client when a device is given, and otherwise the
+// server the client of another headless instance connects to.
+class Perf : public HeadlessTest<int> {
+ public:
+  Perf(const bluetooth::test::headless::GetOpt& options);
+};
+
+// Runs |task| on the main thread of the stack and waits for it to be done
+void DoInMainThreadAndWait(base::OnceClosure task);
+
+// Makes the local device connectable on BR/EDR, and on LE if |le|, so that
+// the client of a perf test can reach its server
+void MakeConnectable(bool le);
+
+}  // namespace headless
+}  // namespace test
+}  // namespace bluetooth
@@ -0,0 +1,102 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define LOG_TAG "bt_headless_perf"
+
+#include "test/headless/perf/perf_stats.h"
+
+#include <algorithm>
+
+using namespace bluetooth::test::headless;
+
+namespace {
+
+constexpr double kMicrosPerSecond = 1000000.0;
+
+double TimevalToSeconds(const struct timeval& tv) {
+  return tv.tv_sec + tv.tv_usec / kMicrosPerSecond;
+}
+
+double CpuSeconds(const struct rusage& usage) {
+  return TimevalToSeconds(usage.ru_utime) + TimevalToSeconds(usage.ru_stime);
+}
+
+}  // namespace
+
+void PerfStats::Start() {
+  started_ = true;
+  start_ = std::chrono::steady_clock::now();
+  getrusage(RUSAGE_SELF, &start_usage_);
+}
+
+void PerfStats::Stop() {
+  if (!started_ || stopped_) return;
+  stopped_ = true;
+  stop_ = std::chrono::steady_clock::now();
+  getrusage(RUSAGE_SELF, &stop_usage_);
+}
+
+void PerfStats::AddPacket(size_t bytes) {
+  if (!started_) Start();
+  packets_++;
+  bytes_ += bytes;
+}
+
+void PerfStats::AddLatency(std::chrono::microseconds latency) {
+  latencies_.push_back(latency);
+}
+
+void PerfStats::Print(FILE* out, const char* name,
+                      const char* latency_name) const {
+  if (!started_) {
+    fprintf(out, "%s: no packets\n", name);
+    return;
+  }
+  std::chrono::steady_clock::time_point stop =
+      stopped_ ? stop_ : std::chrono::steady_clock::now();
+  double seconds =
+      std::chrono::duration_cast<std::chrono::microseconds>(stop - start_)
+          .count() /
+      kMicrosPerSecond;
+  if (seconds <= 0) seconds = 1 / kMicrosPerSecond;
+  fprintf(out,
+          "%s: packets:%llu bytes:%llu time:%.3fs rate:%.1f packets/s "
+          "throughput:%.1f kbit/s\n",
+          name, static_cast<unsigned long long>(packets_),
+          static_cast<unsigned long long>(bytes_), seconds, packets_ / seconds,
+          bytes_ * 8 / seconds / 1000);
+
+  if (!latencies_.empty()) {
+    std::vector<std::chrono::microseconds> sorted(latencies_);
+    std::sort(sorted.begin(), sorted.end());
+    auto percentile = [&sorted](size_t percent) {
+      return static_cast<long long>(
+          sorted[(sorted.size() - 1) * percent / 100].count());
+    };
+    fprintf(out,
+            "%s: %s samples:%zu min:%lldus p50:%lldus p90:%lldus p99:%lldus "
+            "max:%lldus\n",
+            name, latency_name, sorted.size(), percentile(0), percentile(50),
+            percentile(90), percentile(99), percentile(100));
+  }
+
+  if (stopped_) {
+    double cpu = CpuSeconds(stop_usage_) - CpuSeconds(start_usage_);
+    fprintf(out, "%s: cpu:%.3fs (%.1f%% of one core)\n", name, cpu,
+            cpu * 100 / seconds);
+  }
+}
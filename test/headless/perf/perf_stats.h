@@ -0,0 +1,62 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/resource.h>
+#include <chrono>
+#include <vector>
+
+namespace bluetooth {
+namespace test {
+namespace headless {
+
+// Throughput, latency and CPU use of one run of a perf test. It is only
+// updated from the stack callbacks, on the main thread, and printed once the
+// run is over.
+class PerfStats {
+ public:
+  // Starts the clocks, on the first packet of the run
+  void Start();
+  // Stops the clocks, on the last packet of the run
+  void Stop();
+  bool IsStarted() const { return started_; }
+
+  void AddPacket(size_t bytes);
+  void AddLatency(std::chrono::microseconds latency);
+
+  // Prints the rates of the packets and bytes, the percentiles of the
+  // latencies, named |latency_name|, and the CPU time the process took
+  void Print(FILE* out, const char* name, const char* latency_name) const;
+
+ private:
+  bool started_{false};
+  bool stopped_{false};
+  std::chrono::steady_clock::time_point start_;
+  std::chrono::steady_clock::time_point stop_;
+  struct rusage start_usage_ {};
+  struct rusage stop_usage_ {};
+  uint64_t packets_{0};
+  uint64_t bytes_{0};
+  std::vector<std::chrono::microseconds> latencies_;
+};
+
+}  // namespace headless
+}  // namespace test
+}  // namespace bluetooth
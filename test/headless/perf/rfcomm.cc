@@ -0,0 +1,261 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define LOG_TAG "bt_headless_perf"
+
+#include "test/headless/perf/rfcomm.h"
+
+#include <base/bind.h>
+#include <chrono>
+#include <future>
+#include <vector>
+
+#include "base/logging.h"     // LOG() stdout and android log
+#include "osi/include/log.h"  // android log only
+#include "stack/include/btm_api.h"
+#include "stack/include/btu.h"
+#include "stack/include/l2c_api.h"
+#include "stack/include/port_api.h"
+#include "stack/include/rfcdefs.h"
+#include "stack/include/sdpdefs.h"
+#include "test/headless/get_options.h"
+#include "test/headless/headless.h"
+#include "test/headless/perf/perf.h"
+#include "test/headless/perf/perf_stats.h"
+#include "types/raw_address.h"
+
+using namespace bluetooth::test::headless;
+
+namespace {
+
+constexpr uint8_t kPerfScn = 30;
+constexpr uint8_t kPerfSecServiceId = BTM_SEC_SERVICE_FIRST_EMPTY;
+constexpr uint16_t kPerfMtu = BTA_RFC_MTU_SIZE;
+constexpr uint32_t kPerfEventMask =
+    PORT_EV_RXCHAR | PORT_EV_TXEMPTY | PORT_EV_FC;
+// Writes to RFCOMM in a row before letting the main thread run others
+constexpr unsigned long kMaxBurst = 8;
+constexpr std::chrono::seconds kClientTimeout(120);
+
+// The perf port, only touched on the main thread once opened
+struct Port {
+  bool is_server;
+  RawAddress address;
+  uint8_t scn;
+  uint16_t mtu;
+  uint64_t total;
+  std::vector<char> packet;
+
+  uint16_t handle{0};
+  bool finished{false};
+  uint64_t sent{0};
+  uint64_t received{0};
+  unsigned long reads{0};
+  std::chrono::steady_clock::time_point last_time;
+  PerfStats stats;
+  std::promise<int> done;
+};
+
+Port* port = nullptr;
+
+void Finish(int rc) {
+  if (port->finished) return;
+  port->finished = true;
+  port->stats.Stop();
+  port->done.set_value(rc);
+}
+
+void Close() {
+  if (port->handle == 0) return;
+  if (port->is_server) {
+    RFCOMM_RemoveServer(port->handle);
+  } else {
+    RFCOMM_RemoveConnection(port->handle);
+  }
+  port->handle = 0;
+}
+
+void Send() {
+  if (port == nullptr || port->finished || port->sent == port->total) return;
+  unsigned long burst = 0;
+  while (port->sent < port->total && burst++ < kMaxBurst) {
+    size_t offset = port->sent % port->packet.size();
+    uint16_t len = port->packet.size() - offset;
+    if (port->total - port->sent < len) len = port->total - port->sent;
+    uint16_t written = 0;
+    int rc =
+        PORT_WriteData(port->handle, &port->packet[offset], len, &written);
+    if (rc != PORT_SUCCESS) {
+      LOG(ERROR) << "Unable to write to the perf port rc:" << rc;
+      Finish(-2);
+      return;
+    }
+    // Resumed on PORT_EV_TXEMPTY once the queue of the port drained
+    if (written == 0) return;
+    port->sent += written;
+    if (offset + written == port->packet.size() ||
+        port->sent == port->total) {
+      port->stats.AddPacket(offset + written);
+    }
+  }
+  if (port->sent < port->total) {
+    do_in_main_thread(FROM_HERE, base::BindOnce(&Send));
+  }
+}
+
+void Receive() {
+  std::vector<char> buffer(port->mtu);
+  uint16_t len = 0;
+  while (PORT_ReadData(port->handle, buffer.data(), buffer.size(), &len) ==
+             PORT_SUCCESS &&
+         len != 0) {
+    auto now = std::chrono::steady_clock::now();
+    // The gaps between the reads, the first one starts the clocks
+    if (port->reads++ != 0) {
+      port->stats.AddLatency(
+          std::chrono::duration_cast<std::chrono::microseconds>(
+              now - port->last_time));
+    }
+    port->last_time = now;
+    port->received += len;
+    port->stats.AddPacket(len);
+  }
+  if (port->received >= port->total) Finish(0);
+}
+
+void EventCallback(uint32_t code, uint16_t port_handle) {
+  if (port == nullptr || port->handle != port_handle) return;
+  if (code & PORT_EV_RXCHAR) Receive();
+  // TXEMPTY is also raised by PORT_WriteData itself, so resume from a task
+  if ((code & (PORT_EV_TXEMPTY | PORT_EV_FC)) && !port->is_server) {
+    do_in_main_thread(FROM_HERE, base::BindOnce(&Send));
+  }
+}
+
+void MgmtCallback(uint32_t code, uint16_t port_handle) {
+  if (port == nullptr || port->handle != port_handle) return;
+  if (code == PORT_SUCCESS) {
+    fprintf(stdout, "Perf port opened scn:%hhu\n", port->scn);
+    port->stats.Start();
+    if (!port->is_server) Send();
+    return;
+  }
+  // The client is done when the server closes the port
+  Finish(port->received >= port->total || port->sent == port->total ? 0 : -3);
+}
+
+void Open() {
+  if (!BTM_SetSecurityLevel(!port->is_server, "Perf", kPerfSecServiceId,
+                            BTM_SEC_NONE, BT_PSM_RFCOMM, BTM_SEC_PROTO_RFCOMM,
+                            port->scn)) {
+    fprintf(stdout, "Unable to set the security of the perf port\n");
+    Finish(-1);
+    return;
+  }
+  int rc;
+  if (port->is_server) {
+    rc = RFCOMM_CreateConnection(kPerfSecServiceId, port->scn, true, port->mtu,
+                                 RawAddress::kAny, &port->handle,
+                                 MgmtCallback);
+  } else {
+    rc = RFCOMM_CreateConnection(UUID_SERVCLASS_SERIAL_PORT, port->scn, false,
+                                 port->mtu, port->address, &port->handle,
+                                 MgmtCallback);
+  }
+  if (rc != PORT_SUCCESS) {
+    fprintf(stdout, "Unable to open the perf port scn:%hhu rc:%d\n", port->scn,
+            rc);
+    port->handle = 0;
+    Finish(-1);
+    return;
+  }
+  PORT_SetEventCallback(port->handle, EventCallback);
+  PORT_SetEventMask(port->handle, kPerfEventMask);
+}
+
+}  // namespace
+
+int bluetooth::test::headless::RfcommPerf::Run() {
+  if (options_.loop_ < 1) {
+    fprintf(stdout, "This test requires at least a single loop\n");
+    options_.Usage();
+    return -1;
+  }
+  if (options_.device_.size() > 1) {
+    fprintf(stdout, "This test requires at most a single device specified\n");
+    options_.Usage();
+    return -1;
+  }
+  if (options_.count_ == 0) {
+    fprintf(stdout, "This test requires at least a single packet\n");
+    options_.Usage();
+    return -1;
+  }
+  if (options_.size_ > UINT16_MAX) {
+    fprintf(stdout, "This test requires packets of at most %u bytes\n",
+            UINT16_MAX);
+    options_.Usage();
+    return -1;
+  }
+  if (options_.window_ != 0 || options_.le_) {
+    fprintf(stdout, "This test takes neither a window nor the LE transport\n");
+    options_.Usage();
+    return -1;
+  }
+
+  return RunOnHeadlessStack<int>([this]() {
+    Port perf_port;
+    perf_port.is_server = options_.device_.empty();
+    if (!perf_port.is_server) perf_port.address = options_.device_.front();
+    perf_port.scn = options_.scn_ ? options_.scn_ : kPerfScn;
+    perf_port.mtu = options_.mtu_ ? options_.mtu_ : kPerfMtu;
+    perf_port.packet.assign(options_.size_ ? options_.size_ : perf_port.mtu,
+                            0x5a);
+    perf_port.total = options_.count_ * perf_port.packet.size();
+
+    if (perf_port.is_server) MakeConnectable(false);
+
+    auto future = perf_port.done.get_future();
+    DoInMainThreadAndWait(base::BindOnce(
+        [](Port* perf_port) {
+          port = perf_port;
+          Open();
+        },
+        &perf_port));
+
+    int rc;
+    if (perf_port.is_server) {
+      rc = future.get();
+    } else if (future.wait_for(kClientTimeout) == std::future_status::ready) {
+      rc = future.get();
+    } else {
+      fprintf(stdout, "Timeout with %llu/%llu bytes sent\n",
+              static_cast<unsigned long long>(perf_port.sent),
+              static_cast<unsigned long long>(perf_port.total));
+      rc = -4;
+    }
+
+    DoInMainThreadAndWait(base::BindOnce([]() {
+      Close();
+      port = nullptr;
+    }));
+
+    perf_port.stats.Print(
+        stdout, perf_port.is_server ? "rfcomm sink" : "rfcomm source", "gap");
+    return rc;
+  });
+}
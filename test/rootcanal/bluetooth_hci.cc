@@ -44,6 +44,11 @@ bool BtTestConsoleEnabled() {
   return property_get_bool("bt.rootcanal_test_console", true);
 }
 
+bool BtVirtualTimeEnabled() {
+  // Timers expire as soon as nothing else is due, see AsyncManager.
+  return property_get_bool("bt.rootcanal_virtual_time", false);
+}
+
 }  // namespace
 
 class BluetoothDeathRecipient : public hidl_death_recipient {
@@ -94,6 +99,11 @@ Return<void> BluetoothHci::initialize_impl(
   auto link_ret = cb->linkToDeath(death_recipient_, 0);
   CHECK(link_ret.isOk()) << "Error calling linkToDeath.";
 
+  if (BtVirtualTimeEnabled()) {
+    LOG_INFO("%s: Using virtual time", __func__);
+    async_manager_.SetVirtualTime(true);
+  }
+
   test_channel_transport_.RegisterCommandHandler(
       [this](const std::string& name, const std::vector<std::string>& args) {
         async_manager_.ExecAsync(
@@ -236,6 +246,8 @@ Return<void> BluetoothHci::initialize_impl(
 
 Return<void> BluetoothHci::close() {
   LOG_INFO("%s", __func__);
+  LOG_INFO("%s: %s", __func__,
+           async_manager_.GetTaskStatistics().ToString().c_str());
   return Void();
 }
 
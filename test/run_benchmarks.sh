@@ -6,16 +6,41 @@
 # Example usage:
 #   $ cd system/bt
 #   $ ./test/run_benchmarks.sh bluetooth_benchmark_example
+#
+# Gate a change on the data path against a baseline:
+#   $ ./test/run_benchmarks.sh -c f0 -w 1 -i 5 -o baseline --all
+#   (apply the change, rebuild)
+#   $ ./test/run_benchmarks.sh -c f0 -w 1 -i 5 -b baseline -t 5 --all
+
+script_dir="$(cd "$(dirname "$0")" && pwd)"
+
+# Every cc_benchmark module of the tree, so that new suites are run without
+# having to be listed here
+discover_benchmarks() {
+  find "${script_dir}/.." -name Android.bp -print0 | xargs -0 awk '
+    /^cc_benchmark *{/ { in_benchmark = 1 }
+    in_benchmark && /^ *name *:/ {
+      gsub(/[",]/, "", $2)
+      print $2
+      in_benchmark = 0
+    }' | sort -u
+}
 
-known_benchmarks=(
-  bluetooth_benchmark_thread_performance
-  bluetooth_benchmark_timer_performance
-)
+known_benchmarks=( $(discover_benchmarks) )
 
 usage() {
   binary="$(basename "$0")"
   echo "Usage: ${binary} --help"
-  echo "       ${binary} [-i <iterations>] [-s <specific device>] [--all] [<benchmark name>[.<filter>] ...] [--<arg> ...]"
+  echo "       ${binary} [-i <iterations>] [-s <specific device>] [-c <cpu mask>] [-w <warmup runs>]"
+  echo "           [-o <output directory>] [-b <baseline directory> [-t <percent>] [-T <regex>=<percent> ...]]"
+  echo "           [--all] [<benchmark name>[.<filter>] ...] [--<arg> ...]"
+  echo
+  echo "  -c  Pin the benchmarks to the CPUs of the hexadecimal mask, e.g. f0 for CPUs 4 to 7"
+  echo "  -w  Runs of each benchmark before the measured iterations, whose results are dropped"
+  echo "  -o  Save the JSON results of every iteration there, as <benchmark>.<iteration>.json"
+  echo "  -b  Compare the results against those saved with -o by a baseline run, and fail on regressions"
+  echo "  -t  Slowdown in percent that fails a benchmark, 5 by default"
+  echo "  -T  Threshold of the benchmarks whose <benchmark name>/<case> matches the regex"
   echo
   echo "Unknown long arguments are passed to the benchmark."
   echo
@@ -29,6 +54,11 @@ usage() {
 
 iterations=1
 device=
+cpu_mask=
+warmup_runs=0
+output_dir=
+baseline_dir=
+compare_args=()
 benchmarks=()
 benchmark_args=()
 while [ $# -gt 0 ]
@@ -58,6 +88,66 @@ do
       device="$1"
       shift
       ;;
+    -c)
+      shift
+      if [ $# -eq 0 ]; then
+        echo "error: no cpu mask specified" 1>&2
+        usage
+        exit 2
+      fi
+      cpu_mask="$1"
+      shift
+      ;;
+    -w)
+      shift
+      if [ $# -eq 0 ]; then
+        echo "error: number of warmup runs expected" 1>&2
+        usage
+        exit 2
+      fi
+      warmup_runs=$(( $1 ))
+      shift
+      ;;
+    -o)
+      shift
+      if [ $# -eq 0 ]; then
+        echo "error: no output directory specified" 1>&2
+        usage
+        exit 2
+      fi
+      output_dir="$1"
+      shift
+      ;;
+    -b)
+      shift
+      if [ $# -eq 0 ]; then
+        echo "error: no baseline directory specified" 1>&2
+        usage
+        exit 2
+      fi
+      baseline_dir="$1"
+      shift
+      ;;
+    -t)
+      shift
+      if [ $# -eq 0 ]; then
+        echo "error: threshold expected" 1>&2
+        usage
+        exit 2
+      fi
+      compare_args+=( "--threshold" "$1" )
+      shift
+      ;;
+    -T)
+      shift
+      if [ $# -eq 0 ]; then
+        echo "error: <regex>=<percent> expected" 1>&2
+        usage
+        exit 2
+      fi
+      compare_args+=( "--threshold-for" "$1" )
+      shift
+      ;;
     --all)
       benchmarks+=( "${known_benchmarks[@]}" )
       shift
@@ -82,6 +172,18 @@ if [ -n "${device}" ]; then
   adb+=( "-s" "${device}" )
 fi
 
+if [ -n "${baseline_dir}" ] && [ ! -d "${baseline_dir}" ]; then
+  echo "error: baseline directory ${baseline_dir} not found" 1>&2
+  exit 2
+fi
+if [ -n "${baseline_dir}" ] && [ -z "${output_dir}" ]; then
+  output_dir="$(mktemp -d)"
+fi
+if [ -n "${output_dir}" ]; then
+  mkdir -p "${output_dir}"
+fi
+device_json="/data/local/tmp/bluetooth_benchmark.json"
+
 source ${ANDROID_BUILD_TOP}/build/envsetup.sh
 target_arch=$(gettargetarch)
 
@@ -96,7 +198,11 @@ do
   fi
 
   push_command=( "${adb[@]}" push {"${ANDROID_PRODUCT_OUT}",}"${binary}" )
-  benchmark_command=( "${adb[@]}" shell "${binary}" )
+  benchmark_command=( "${adb[@]}" shell )
+  if [ -n "${cpu_mask}" ]; then
+    benchmark_command+=( taskset "${cpu_mask}" )
+  fi
+  benchmark_command+=( "${binary}" )
   if [ "${name}" != "${spec}" ]; then
     filter="${spec#*.}"
     benchmark_command+=( "--benchmark_filter=${filter}" )
@@ -106,11 +212,24 @@ do
   echo "--- ${name} ---"
   echo "pushing..."
   "${push_command[@]}"
+  if [ "${warmup_runs}" -gt 0 ]; then
+    echo "warming up..."
+    for i in $(seq 1 ${warmup_runs})
+    do
+      "${benchmark_command[@]}" > /dev/null 2>&1
+    done
+  fi
   echo "running..."
   failed_count=0
   for i in $(seq 1 ${iterations})
   do
-    "${benchmark_command[@]}" || failed_count=$(( $failed_count + 1 ))
+    if [ -n "${output_dir}" ]; then
+      "${benchmark_command[@]}" "--benchmark_out=${device_json}" "--benchmark_out_format=json" &&
+        "${adb[@]}" pull "${device_json}" "${output_dir}/${name}.${i}.json" > /dev/null ||
+        failed_count=$(( $failed_count + 1 ))
+    else
+      "${benchmark_command[@]}" || failed_count=$(( $failed_count + 1 ))
+    fi
   done
 
   if [ $failed_count != 0 ]; then
@@ -118,12 +237,18 @@ do
   fi
 done
 
+result=0
+if [ -n "${baseline_dir}" ]; then
+  echo "--- comparing with ${baseline_dir} ---"
+  "${script_dir}/compare_benchmarks.py" "${compare_args[@]}" "${baseline_dir}" "${output_dir}" || result=1
+fi
+
 if [ "${#failed_benchmarks[@]}" -ne 0 ]; then
   for failed_benchmark in "${failed_benchmarks[@]}"
   do
     echo "!!! FAILED TEST: ${failed_benchmark} !!!"
   done
-  exit 1
+  result=1
 fi
 
-exit 0
+exit ${result}
@@ -36,28 +36,6 @@ constexpr Uuid kBase = Uuid::From128BitBE(
                 0x00, 0x80, 0x5f, 0x9b, 0x34, 0xfb}});
 }  // namespace
 
-size_t Uuid::GetShortestRepresentationSize() const {
-  if (memcmp(uu.data() + kNumBytes32, kBase.uu.data() + kNumBytes32,
-             kNumBytes128 - kNumBytes32) != 0) {
-    return kNumBytes128;
-  }
-
-  if (uu[0] == 0 && uu[1] == 0) return kNumBytes16;
-
-  return kNumBytes32;
-}
-
-bool Uuid::Is16Bit() const {
-  return GetShortestRepresentationSize() == kNumBytes16;
-}
-
-uint16_t Uuid::As16Bit() const { return (((uint16_t)uu[2]) << 8) + uu[3]; }
-
-uint32_t Uuid::As32Bit() const {
-  return (((uint32_t)uu[0]) << 24) + (((uint32_t)uu[1]) << 16) +
-         (((uint32_t)uu[2]) << 8) + uu[3];
-}
-
 Uuid Uuid::FromString(const std::string& uuid, bool* is_valid) {
   if (is_valid) *is_valid = false;
   Uuid ret = kBase;
@@ -159,10 +137,6 @@ bool Uuid::operator<(const Uuid& rhs) const {
                                       rhs.uu.end());
 }
 
-bool Uuid::operator==(const Uuid& rhs) const { return uu == rhs.uu; }
-
-bool Uuid::operator!=(const Uuid& rhs) const { return uu != rhs.uu; }
-
 std::string Uuid::ToString() const {
   return base::StringPrintf(
       "%02x%02x%02x%02x-%02x%02x-%02x%02x-%02x%02x-%02x%02x%02x%02x%02x%02x",
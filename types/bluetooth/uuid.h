@@ -19,6 +19,7 @@
 #pragma once
 
 #include <stdint.h>
+#include <string.h>
 #include <array>
 #include <string>
 
@@ -51,18 +52,24 @@ class Uuid final {
 
   // Returns the shortest possible representation of this UUID in bytes. Either
   // kNumBytes16, kNumBytes32, or kNumBytes128
-  size_t GetShortestRepresentationSize() const;
+  size_t GetShortestRepresentationSize() const {
+    if (!IsShort()) return kNumBytes128;
+    return (uu[0] == 0 && uu[1] == 0) ? kNumBytes16 : kNumBytes32;
+  }
 
   // Returns true if this UUID can be represented as 16 bit.
-  bool Is16Bit() const;
+  bool Is16Bit() const { return uu[0] == 0 && uu[1] == 0 && IsShort(); }
 
   // Returns 16 bit Little Endian representation of this UUID. Use
   // GetShortestRepresentationSize() or Is16Bit() before using this method.
-  uint16_t As16Bit() const;
+  uint16_t As16Bit() const { return (((uint16_t)uu[2]) << 8) + uu[3]; }
 
   // Returns 32 bit Little Endian representation of this UUID. Use
   // GetShortestRepresentationSize() before using this method.
-  uint32_t As32Bit() const;
+  uint32_t As32Bit() const {
+    return (((uint32_t)uu[0]) << 24) + (((uint32_t)uu[1]) << 16) +
+           (((uint32_t)uu[2]) << 8) + uu[3];
+  }
 
   // Converts string representing 128, 32, or 16 bit UUID in
   // xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx, xxxxxxxx, or xxxx format to UUID. If
@@ -106,13 +113,43 @@ class Uuid final {
   // Returns true if this UUID is equal to kEmpty
   bool IsEmpty() const;
 
+  // Returns a hash of this UUID, mixing all of its bits. Cheap enough to be
+  // computed on every lookup of a UUID keyed table.
+  size_t Hash() const {
+    uint64_t high, low;
+    memcpy(&high, uu.data(), sizeof(high));
+    memcpy(&low, uu.data() + sizeof(high), sizeof(low));
+    // The finalizer of MurmurHash3, so that the two bytes which tell 16 bit
+    // UUIDs apart reach the low bits used to pick buckets
+    uint64_t h = high ^ (low * 0x9e3779b97f4a7c15);
+    h = (h ^ (h >> 33)) * 0xff51afd7ed558ccd;
+    h = (h ^ (h >> 33)) * 0xc4ceb9fe1a85ec53;
+    return static_cast<size_t>(h ^ (h >> 33));
+  }
+
   bool operator<(const Uuid& rhs) const;
-  bool operator==(const Uuid& rhs) const;
-  bool operator!=(const Uuid& rhs) const;
+
+  // Inline, so that the fixed size memcmp becomes two word compares in the
+  // attribute type searches that compare a UUID against a whole table
+  bool operator==(const Uuid& rhs) const {
+    return memcmp(uu.data(), rhs.uu.data(), kNumBytes128) == 0;
+  }
+  bool operator!=(const Uuid& rhs) const { return !(*this == rhs); }
 
  private:
   constexpr Uuid(const UUID128Bit& val) : uu{val} {};
 
+  // Bytes 4 to 15 of the Bluetooth Base UUID,
+  // 00000000-0000-1000-8000-00805F9B34FB
+  static constexpr uint8_t kBaseTail[kNumBytes128 - kNumBytes32] = {
+      0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0x80, 0x5f, 0x9b, 0x34, 0xfb};
+
+  // Returns true if this UUID is derived from the Base UUID, i.e. has a 16 or
+  // 32 bit form
+  bool IsShort() const {
+    return memcmp(uu.data() + kNumBytes32, kBaseTail, sizeof(kBaseTail)) == 0;
+  }
+
   // Network-byte-ordered ID (Big Endian).
   UUID128Bit uu;
 };
@@ -130,10 +167,7 @@ namespace std {
 template <>
 struct hash<bluetooth::Uuid> {
   std::size_t operator()(const bluetooth::Uuid& key) const {
-    const auto& uuid_bytes = key.To128BitBE();
-    std::hash<std::string> hash_fn;
-    return hash_fn(std::string(reinterpret_cast<const char*>(uuid_bytes.data()),
-                               uuid_bytes.size()));
+    return key.Hash();
   }
 };
 
@@ -19,6 +19,8 @@
 #include <bluetooth/uuid.h>
 #include <gtest/gtest.h>
 
+#include <unordered_set>
+
 using bluetooth::Uuid;
 
 static const Uuid ONES = Uuid::From128BitBE(
@@ -68,6 +70,19 @@ TEST(UuidTest, Is16Bit) {
   EXPECT_TRUE(Uuid::FromString("1ae8").Is16Bit());
 }
 
+TEST(UuidTest, Hash) {
+  std::hash<Uuid> hash;
+  EXPECT_EQ(hash(Uuid::From16Bit(0x2a37)), hash(Uuid::FromString("2a37")));
+  EXPECT_NE(hash(ONES), hash(SEQUENTIAL));
+
+  // 16 bit UUIDs only differ in two bytes, the hash has to spread them
+  std::unordered_set<size_t> buckets;
+  for (uint16_t uuid16 = 0x2a00; uuid16 < 0x2b00; uuid16++) {
+    buckets.insert(hash(Uuid::From16Bit(uuid16)) % 64);
+  }
+  EXPECT_GT(buckets.size(), 48u);
+}
+
 TEST(UuidTest, From16Bit) {
   EXPECT_EQ(Uuid::From16Bit(0x0000), kBase);
 
@@ -20,6 +20,8 @@
 
 #include <mutex>
 
+#include "osi/include/shm_ring.h"
+
 #define UIPC_CH_ID_AV_CTRL 0
 #define UIPC_CH_ID_AV_AUDIO 1
 #define UIPC_CH_NUM 2
@@ -47,6 +49,7 @@ typedef enum {
 #define UIPC_REG_CBACK 2
 #define UIPC_REG_REMOVE_ACTIVE_READSET 3
 #define UIPC_SET_READ_POLL_TMO 4
+#define UIPC_SET_RING_CAPACITY 5
 
 typedef void(tUIPC_RCV_CBACK)(
     tUIPC_CH_ID ch_id,
@@ -63,6 +66,14 @@ typedef struct {
   int read_poll_tmo_ms;
   int task_evt_flags; /* event flags pending to be processed in read task */
   tUIPC_RCV_CBACK* cback;
+  /* audio data ring offered to the client, used once the client attaches */
+  shm_ring_t* ring;
+  /* ring UIPC_Read is reading without the lock, freed by it if closed */
+  shm_ring_t* ring_reader;
+  /* flush requested while the ring was being read, done by the reader */
+  bool ring_flush_pending;
+  /* capacity of the next ring offered, 0 for AUDIO_STREAM_OUTPUT_BUFFER_SZ */
+  uint32_t ring_capacity;
 } tUIPC_CHAN;
 
 struct tUIPC_STATE {
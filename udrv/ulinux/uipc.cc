@@ -172,12 +172,64 @@ static int accept_server_socket(int sfd) {
   return fd;
 }
 
+/* Offer a shared memory ring of |capacity| bytes for the audio data to the
+ * client connected on |fd|. A client that attaches writes the PCM data to the
+ * ring, without a syscall per write, and only keeps the socket to signal its
+ * disconnection. Clients that ignore the offer keep writing to the socket. */
+static shm_ring_t* offer_audio_ring(int fd, uint32_t capacity) {
+  if (capacity == 0) capacity = AUDIO_STREAM_OUTPUT_BUFFER_SZ;
+  shm_ring_t* ring = shm_ring_new(capacity);
+  if (ring == NULL) return NULL;
+
+  /* a stream socket needs at least one byte to carry the descriptor */
+  char offer = 0;
+  struct iovec iov;
+  iov.iov_base = &offer;
+  iov.iov_len = sizeof(offer);
+
+  char control_buf[CMSG_SPACE(sizeof(int))];
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control_buf;
+  msg.msg_controllen = sizeof(control_buf);
+
+  struct cmsghdr* header = CMSG_FIRSTHDR(&msg);
+  header->cmsg_level = SOL_SOCKET;
+  header->cmsg_type = SCM_RIGHTS;
+  header->cmsg_len = CMSG_LEN(sizeof(int));
+  *(int*)CMSG_DATA(header) = shm_ring_get_fd(ring);
+
+  ssize_t ret;
+  OSI_NO_INTR(ret = sendmsg(fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL));
+  if (ret != sizeof(offer)) {
+    BTIF_TRACE_ERROR("failed to offer audio ring (%s)", strerror(errno));
+    shm_ring_free(ring);
+    return NULL;
+  }
+
+  return ring;
+}
+
 /*****************************************************************************
  *
  *   uipc helper functions
  *
  ****************************************************************************/
 
+static void uipc_free_ring_locked(tUIPC_STATE& uipc, tUIPC_CH_ID ch_id) {
+  if (uipc.ch[ch_id].ring == NULL) return;
+
+  /* let a client blocked on a full ring see the disconnection, and wake up
+   * UIPC_Read if it waits on it: it frees the ring once it is done */
+  shm_ring_close(uipc.ch[ch_id].ring);
+  if (uipc.ch[ch_id].ring != uipc.ch[ch_id].ring_reader)
+    shm_ring_free(uipc.ch[ch_id].ring);
+  uipc.ch[ch_id].ring = NULL;
+  uipc.ch[ch_id].ring_flush_pending = false;
+}
+
 static int uipc_main_init(tUIPC_STATE& uipc) {
   int i;
 
@@ -205,6 +257,10 @@ static int uipc_main_init(tUIPC_STATE& uipc) {
     p->fd = UIPC_DISCONNECTED;
     p->task_evt_flags = 0;
     p->cback = NULL;
+    p->ring = NULL;
+    p->ring_reader = NULL;
+    p->ring_flush_pending = false;
+    p->ring_capacity = 0;
   }
 
   return 0;
@@ -252,6 +308,7 @@ static int uipc_check_fd_locked(tUIPC_STATE& uipc, tUIPC_CH_ID ch_id) {
       FD_CLR(uipc.ch[ch_id].fd, &uipc.active_set);
       uipc.ch[ch_id].fd = UIPC_DISCONNECTED;
     }
+    uipc_free_ring_locked(uipc, ch_id);
 
     uipc.ch[ch_id].fd = accept_server_socket(uipc.ch[ch_id].srvfd);
 
@@ -270,6 +327,10 @@ static int uipc_check_fd_locked(tUIPC_STATE& uipc, tUIPC_CH_ID ch_id) {
       return -1;
     }
 
+    if (ch_id == UIPC_CH_ID_AV_AUDIO)
+      uipc.ch[ch_id].ring = offer_audio_ring(uipc.ch[ch_id].fd,
+                                             uipc.ch[ch_id].ring_capacity);
+
     if (uipc.ch[ch_id].cback) uipc.ch[ch_id].cback(ch_id, UIPC_OPEN_EVT);
   }
 
@@ -342,6 +403,14 @@ static void uipc_flush_ch_locked(tUIPC_STATE& uipc, tUIPC_CH_ID ch_id) {
     return;
   }
 
+  if (uipc.ch[ch_id].ring != NULL) {
+    /* only the reader may flush the ring */
+    if (uipc.ch[ch_id].ring == uipc.ch[ch_id].ring_reader)
+      uipc.ch[ch_id].ring_flush_pending = true;
+    else
+      shm_ring_flush(uipc.ch[ch_id].ring);
+  }
+
   while (1) {
     int ret;
     OSI_NO_INTR(ret = poll(&pfd, 1, 1));
@@ -406,6 +475,8 @@ static int uipc_close_ch_locked(tUIPC_STATE& uipc, tUIPC_CH_ID ch_id) {
     wakeup = 1;
   }
 
+  uipc_free_ring_locked(uipc, ch_id);
+
   /* notify this connection is closed */
   if (uipc.ch[ch_id].cback) uipc.ch[ch_id].cback(ch_id, UIPC_CLOSE_EVT);
 
@@ -608,6 +679,53 @@ bool UIPC_Send(tUIPC_STATE& uipc, tUIPC_CH_ID ch_id,
   return false;
 }
 
+/* Read from the audio ring attached by the client. The socket carries no data
+ * then, it is only checked for the disconnection of the client. The read may
+ * wait for the client, so it is done without the lock; |ring| is only freed
+ * by the channel close once this function is done with it. */
+static uint32_t uipc_read_ring(tUIPC_STATE& uipc, tUIPC_CH_ID ch_id,
+                               shm_ring_t* ring, int timeout_ms,
+                               uint8_t* p_buf, uint32_t len) {
+  ssize_t n = shm_ring_read(ring, p_buf, len, timeout_ms);
+
+  std::lock_guard<std::recursive_mutex> lock(uipc.mutex);
+  tUIPC_CHAN* p = &uipc.ch[ch_id];
+  p->ring_reader = NULL;
+
+  if (p->ring != ring) {
+    /* the channel was closed during the read */
+    shm_ring_free(ring);
+    return (n > 0) ? n : 0;
+  }
+
+  if (p->ring_flush_pending) {
+    shm_ring_flush(ring);
+    p->ring_flush_pending = false;
+  }
+
+  if (n == (ssize_t)len) return n;
+
+  if (n < 0) {
+    BTIF_TRACE_WARNING("UIPC_Read : ring closed (%s)", strerror(errno));
+    uipc_close_locked(uipc, ch_id);
+    return 0;
+  }
+
+  struct pollfd pfd;
+  pfd.fd = p->fd;
+  pfd.events = POLLHUP;
+  int poll_ret;
+  OSI_NO_INTR(poll_ret = poll(&pfd, 1, 0));
+  if (poll_ret > 0 && (pfd.revents & (POLLHUP | POLLNVAL))) {
+    BTIF_TRACE_WARNING("poll : channel detached remotely");
+    uipc_close_locked(uipc, ch_id);
+    return 0;
+  }
+
+  BTIF_TRACE_WARNING("ring read timeout (%d ms)", timeout_ms);
+  return n;
+}
+
 /*******************************************************************************
  **
  ** Function         UIPC_Read
@@ -635,6 +753,22 @@ uint32_t UIPC_Read(tUIPC_STATE& uipc, tUIPC_CH_ID ch_id,
     return 0;
   }
 
+  if (ch_id == UIPC_CH_ID_AV_AUDIO) {
+    shm_ring_t* ring = NULL;
+    int timeout_ms = 0;
+    {
+      std::lock_guard<std::recursive_mutex> lock(uipc.mutex);
+      tUIPC_CHAN* p = &uipc.ch[ch_id];
+      if (p->ring != NULL && shm_ring_is_attached(p->ring)) {
+        ring = p->ring;
+        p->ring_reader = ring;
+        timeout_ms = p->read_poll_tmo_ms;
+      }
+    }
+    if (ring != NULL)
+      return uipc_read_ring(uipc, ch_id, ring, timeout_ms, p_buf, len);
+  }
+
   while (n_read < (int)len) {
     pfd.fd = fd;
     pfd.events = POLLIN | POLLHUP;
@@ -731,6 +865,13 @@ extern bool UIPC_Ioctl(tUIPC_STATE& uipc, tUIPC_CH_ID ch_id, uint32_t request,
                        uipc.ch[ch_id].read_poll_tmo_ms);
       break;
 
+    case UIPC_SET_RING_CAPACITY:
+      /* used by the next connection; a ring already offered is kept */
+      uipc.ch[ch_id].ring_capacity = (intptr_t)param;
+      BTIF_TRACE_EVENT("UIPC_SET_RING_CAPACITY : CH %d, %u bytes", ch_id,
+                       uipc.ch[ch_id].ring_capacity);
+      break;
+
     default:
       BTIF_TRACE_EVENT("UIPC_Ioctl : request not handled (%d)", request);
       break;
@@ -17,6 +17,7 @@
 #include "test_environment.h"
 
 #include <future>
+#include <string>
 
 #include "os/log.h"
 
@@ -31,14 +32,22 @@ int main(int argc, char** argv) {
   uint16_t test_port = kTestPort;
   uint16_t hci_server_port = kHciServerPort;
   uint16_t link_server_port = kLinkServerPort;
+  bool virtual_time = false;
 
+  // Ports are positional, flags can be anywhere
+  int positional = 0;
   for (int arg = 0; arg < argc; arg++) {
+    if (std::string(argv[arg]) == "--virtual_time") {
+      LOG_INFO("%d: %s", arg, argv[arg]);
+      virtual_time = true;
+      continue;
+    }
     int port = atoi(argv[arg]);
     LOG_INFO("%d: %s (%d)", arg, argv[arg], port);
     if (port < 0 || port > 0xffff) {
       LOG_WARN("%s out of range", argv[arg]);
     } else {
-      switch (arg) {
+      switch (positional) {
         case 0:  // executable name
           break;
         case 1:
@@ -54,9 +63,10 @@ int main(int argc, char** argv) {
           LOG_WARN("Ignored option %s", argv[arg]);
       }
     }
+    positional++;
   }
 
-  TestEnvironment root_canal(test_port, hci_server_port, link_server_port);
+  TestEnvironment root_canal(test_port, hci_server_port, link_server_port, virtual_time);
   std::promise<void> barrier;
   std::future<void> barrier_future = barrier.get_future();
   root_canal.initialize(std::move(barrier));
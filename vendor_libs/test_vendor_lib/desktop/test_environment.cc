@@ -38,6 +38,11 @@ void TestEnvironment::initialize(std::promise<void> barrier) {
 
   barrier_ = std::move(barrier);
 
+  if (virtual_time_) {
+    LOG_INFO("%s: Using virtual time", __func__);
+    async_manager_.SetVirtualTime(true);
+  }
+
   test_channel_transport_.RegisterCommandHandler([this](const std::string& name, const std::vector<std::string>& args) {
     async_manager_.ExecAsync(std::chrono::milliseconds(0),
                              [this, name, args]() { test_channel_.HandleCommand(name, args); });
@@ -59,6 +64,7 @@ void TestEnvironment::initialize(std::promise<void> barrier) {
 
 void TestEnvironment::close() {
   LOG_INFO("%s", __func__);
+  LOG_INFO("%s: %s", __func__, async_manager_.GetTaskStatistics().ToString().c_str());
 }
 
 void TestEnvironment::SetUpHciServer(const std::function<void(int)>& connection_callback) {
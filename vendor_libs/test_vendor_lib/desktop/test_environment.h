@@ -30,8 +30,13 @@ namespace root_canal {
 
 class TestEnvironment {
  public:
-  TestEnvironment(uint16_t test_port, uint16_t hci_server_port, uint16_t link_server_port)
-      : test_port_(test_port), hci_server_port_(hci_server_port), link_server_port_(link_server_port) {}
+  // With |virtual_time|, timers expire as soon as nothing else is due: simulations run faster than real time, and
+  // scenarios driven from the test channel replay the same way each time.
+  TestEnvironment(uint16_t test_port, uint16_t hci_server_port, uint16_t link_server_port, bool virtual_time = false)
+      : test_port_(test_port),
+        hci_server_port_(hci_server_port),
+        link_server_port_(link_server_port),
+        virtual_time_(virtual_time) {}
 
   void initialize(std::promise<void> barrier);
 
@@ -41,6 +46,7 @@ class TestEnvironment {
   uint16_t test_port_;
   uint16_t hci_server_port_;
   uint16_t link_server_port_;
+  bool virtual_time_;
   std::promise<void> barrier_;
 
   test_vendor_lib::AsyncManager async_manager_;
@@ -19,6 +19,7 @@
 #include <dlfcn.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <string.h>
 #include <sys/uio.h>
 #include <unistd.h>
 
@@ -36,6 +37,7 @@ constexpr size_t H4Packetizer::EVENT_PREAMBLE_SIZE;
 constexpr size_t H4Packetizer::EVENT_LENGTH_OFFSET;
 
 constexpr size_t H4Packetizer::PREAMBLE_SIZE_MAX;
+constexpr size_t H4Packetizer::READ_BUFFER_SIZE;
 
 size_t H4Packetizer::HciGetPacketLengthForType(hci::PacketType type, const uint8_t* preamble) {
   static const size_t packet_length_offset[static_cast<size_t>(hci::PacketType::EVENT) + 1] = {
@@ -51,10 +53,11 @@ size_t H4Packetizer::HciGetPacketLengthForType(hci::PacketType type, const uint8
   return (((preamble[offset + 1]) << 8) | preamble[offset]);
 }
 
-H4Packetizer::H4Packetizer(int fd, PacketReadCallback command_cb, PacketReadCallback event_cb,
-                           PacketReadCallback acl_cb, PacketReadCallback sco_cb, ClientDisconnectCallback disconnect_cb)
+H4Packetizer::H4Packetizer(int fd, PacketViewReadCallback command_cb, PacketViewReadCallback event_cb,
+                           PacketViewReadCallback acl_cb, PacketViewReadCallback sco_cb,
+                           ClientDisconnectCallback disconnect_cb)
     : uart_fd_(fd), command_cb_(command_cb), event_cb_(event_cb), acl_cb_(acl_cb), sco_cb_(sco_cb),
-      disconnect_cb_(disconnect_cb) {}
+      disconnect_cb_(disconnect_cb), read_buffer_(READ_BUFFER_SIZE) {}
 
 size_t H4Packetizer::Send(uint8_t type, const uint8_t* data, size_t length) {
   struct iovec iov[] = {{&type, sizeof(type)}, {const_cast<uint8_t*>(data), length}};
@@ -72,121 +75,85 @@ size_t H4Packetizer::Send(uint8_t type, const uint8_t* data, size_t length) {
   return ret;
 }
 
-void H4Packetizer::OnPacketReady() {
-  switch (hci_packet_type_) {
+void H4Packetizer::OnPacketReady(hci::PacketType type, const uint8_t* data, size_t length) {
+  switch (type) {
     case hci::PacketType::COMMAND:
-      command_cb_(packet_);
+      command_cb_(data, length);
       break;
     case hci::PacketType::ACL:
-      acl_cb_(packet_);
+      acl_cb_(data, length);
       break;
     case hci::PacketType::SCO:
-      sco_cb_(packet_);
+      sco_cb_(data, length);
       break;
     case hci::PacketType::EVENT:
-      event_cb_(packet_);
+      event_cb_(data, length);
       break;
     default:
-      LOG_ALWAYS_FATAL("%s: Unimplemented packet type %d", __func__, static_cast<int>(hci_packet_type_));
+      LOG_ALWAYS_FATAL("%s: Unimplemented packet type %d", __func__, static_cast<int>(type));
   }
-  // Get ready for the next type byte.
-  hci_packet_type_ = hci::PacketType::UNKNOWN;
 }
 
-void H4Packetizer::OnDataReady(int fd) {
-  if (hci_packet_type_ == hci::PacketType::UNKNOWN) {
-    uint8_t buffer[1] = {0};
-    ssize_t bytes_read = TEMP_FAILURE_RETRY(read(fd, buffer, 1));
-    if (bytes_read == 0) {
-      LOG_INFO("%s: remote disconnected!", __func__);
-      disconnect_cb_();
+void H4Packetizer::ParsePackets() {
+  static const size_t preamble_size[static_cast<size_t>(hci::PacketType::EVENT) + 1] = {
+      0,
+      H4Packetizer::COMMAND_PREAMBLE_SIZE,
+      H4Packetizer::ACL_PREAMBLE_SIZE,
+      H4Packetizer::SCO_PREAMBLE_SIZE,
+      H4Packetizer::EVENT_PREAMBLE_SIZE,
+  };
+
+  while (read_begin_ < read_end_) {
+    const uint8_t* packet = read_buffer_.data() + read_begin_;
+    size_t available = read_end_ - read_begin_;
+
+    auto type = static_cast<hci::PacketType>(packet[0]);
+    if (type != hci::PacketType::ACL && type != hci::PacketType::SCO && type != hci::PacketType::COMMAND &&
+        type != hci::PacketType::EVENT) {
+      LOG_ALWAYS_FATAL("%s: Unimplemented packet type %d", __func__, static_cast<int>(type));
+    }
+
+    size_t preamble_bytes = preamble_size[static_cast<size_t>(type)];
+    if (available < 1 + preamble_bytes) {
       return;
-    } else if (bytes_read < 0) {
-      if (errno == EAGAIN) {
-        // No data, try again later.
-        return;
-      } else if (errno == ECONNRESET) {
-        // They probably rejected our packet
-        return;
-      } else {
-        LOG_ALWAYS_FATAL("%s: Read packet type error: %s", __func__, strerror(errno));
-      }
-    } else if (bytes_read > 1) {
-      LOG_ALWAYS_FATAL("%s: More bytes read than expected (%u)!", __func__, static_cast<unsigned int>(bytes_read));
     }
-    hci_packet_type_ = static_cast<hci::PacketType>(buffer[0]);
-    if (hci_packet_type_ != hci::PacketType::ACL && hci_packet_type_ != hci::PacketType::SCO &&
-        hci_packet_type_ != hci::PacketType::COMMAND && hci_packet_type_ != hci::PacketType::EVENT) {
-      LOG_ALWAYS_FATAL("%s: Unimplemented packet type %d", __func__, static_cast<int>(hci_packet_type_));
+    size_t packet_length = preamble_bytes + HciGetPacketLengthForType(type, packet + 1);
+    if (available < 1 + packet_length) {
+      return;
     }
-  } else {
-    static const size_t preamble_size[static_cast<size_t>(hci::PacketType::EVENT) + 1] = {
-        0,
-        H4Packetizer::COMMAND_PREAMBLE_SIZE,
-        H4Packetizer::ACL_PREAMBLE_SIZE,
-        H4Packetizer::SCO_PREAMBLE_SIZE,
-        H4Packetizer::EVENT_PREAMBLE_SIZE,
-    };
-
-    switch (state_) {
-      case HCI_PREAMBLE: {
-        size_t preamble_bytes = preamble_size[static_cast<size_t>(hci_packet_type_)];
-        ssize_t bytes_read = TEMP_FAILURE_RETRY(read(fd, preamble_ + bytes_read_, preamble_bytes - bytes_read_));
-        if (bytes_read == 0) {
-          LOG_ERROR("%s: Will try again to read the header!", __func__);
-          return;
-        }
-        if (bytes_read < 0) {
-          // Ignore temporary failures.
-          if (errno == EAGAIN) {
-            return;
-          }
-          LOG_ALWAYS_FATAL("%s: Read header error: %s", __func__, strerror(errno));
-        }
-        bytes_read_ += bytes_read;
-        if (bytes_read_ == preamble_bytes) {
-          size_t packet_length = HciGetPacketLengthForType(hci_packet_type_, preamble_);
-          packet_.resize(preamble_bytes + packet_length);
-          memcpy(packet_.data(), preamble_, preamble_bytes);
-          bytes_remaining_ = packet_length;
-          if (bytes_remaining_ == 0) {
-            OnPacketReady();
-            state_ = HCI_PREAMBLE;
-            bytes_read_ = 0;
-          } else {
-            state_ = HCI_PAYLOAD;
-            bytes_read_ = 0;
-          }
-        }
-        break;
-      }
-
-      case HCI_PAYLOAD: {
-        size_t preamble_bytes = preamble_size[static_cast<size_t>(hci_packet_type_)];
-        ssize_t bytes_read =
-            TEMP_FAILURE_RETRY(read(fd, packet_.data() + preamble_bytes + bytes_read_, bytes_remaining_));
-        if (bytes_read == 0) {
-          LOG_INFO("%s: Will try again to read the payload!", __func__);
-          return;
-        }
-        if (bytes_read < 0) {
-          // Ignore temporary failures.
-          if (errno == EAGAIN) {
-            return;
-          }
-          LOG_ALWAYS_FATAL("%s: Read payload error: %s", __func__, strerror(errno));
-        }
-        bytes_remaining_ -= bytes_read;
-        bytes_read_ += bytes_read;
-        if (bytes_remaining_ == 0) {
-          OnPacketReady();
-          state_ = HCI_PREAMBLE;
-          bytes_read_ = 0;
-        }
-        break;
-      }
+
+    read_begin_ += 1 + packet_length;
+    OnPacketReady(type, packet + 1, packet_length);
+  }
+}
+
+void H4Packetizer::OnDataReady(int fd) {
+  // Move the start of an incomplete packet to the front of the buffer, so that the rest of it fits after it
+  if (read_begin_ > 0) {
+    memmove(read_buffer_.data(), read_buffer_.data() + read_begin_, read_end_ - read_begin_);
+    read_end_ -= read_begin_;
+    read_begin_ = 0;
+  }
+
+  ssize_t bytes_read = TEMP_FAILURE_RETRY(read(fd, read_buffer_.data() + read_end_, read_buffer_.size() - read_end_));
+  if (bytes_read == 0) {
+    LOG_INFO("%s: remote disconnected!", __func__);
+    disconnect_cb_();
+    return;
+  } else if (bytes_read < 0) {
+    if (errno == EAGAIN) {
+      // No data, try again later.
+      return;
+    } else if (errno == ECONNRESET) {
+      // They probably rejected our packet
+      return;
+    } else {
+      LOG_ALWAYS_FATAL("%s: Read error: %s", __func__, strerror(errno));
     }
   }
+
+  read_end_ += bytes_read;
+  ParsePackets();
 }
 
 }  // namespace hci
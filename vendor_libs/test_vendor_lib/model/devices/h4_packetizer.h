@@ -28,29 +28,31 @@ namespace hci {
 using HciPacketReadyCallback = std::function<void(void)>;
 using ClientDisconnectCallback = std::function<void()>;
 
+// A packet without its type byte, parsed in place in the read buffer of the packetizer. The data is only valid until
+// the callback returns.
+using PacketViewReadCallback = std::function<void(const uint8_t* data, size_t length)>;
+
 class H4Packetizer : public HciProtocol {
  public:
-  H4Packetizer(int fd, PacketReadCallback command_cb, PacketReadCallback event_cb, PacketReadCallback acl_cb,
-               PacketReadCallback sco_cb, ClientDisconnectCallback disconnect_cb);
+  H4Packetizer(int fd, PacketViewReadCallback command_cb, PacketViewReadCallback event_cb,
+               PacketViewReadCallback acl_cb, PacketViewReadCallback sco_cb, ClientDisconnectCallback disconnect_cb);
 
   size_t Send(uint8_t type, const uint8_t* data, size_t length);
 
-  void OnPacketReady();
-
+  // Reads as many bytes as are available, up to the size of the read buffer, and hands every complete packet to its
+  // callback. The bytes of a packet which is not complete yet are kept for the next call.
   void OnDataReady(int fd);
 
  private:
   int uart_fd_;
 
-  PacketReadCallback command_cb_;
-  PacketReadCallback event_cb_;
-  PacketReadCallback acl_cb_;
-  PacketReadCallback sco_cb_;
+  PacketViewReadCallback command_cb_;
+  PacketViewReadCallback event_cb_;
+  PacketViewReadCallback acl_cb_;
+  PacketViewReadCallback sco_cb_;
 
   ClientDisconnectCallback disconnect_cb_;
 
-  hci::PacketType hci_packet_type_{hci::PacketType::UNKNOWN};
-
   // 2 bytes for opcode, 1 byte for parameter length (Volume 2, Part E, 5.4.1)
   static constexpr size_t COMMAND_PREAMBLE_SIZE = 3;
   static constexpr size_t COMMAND_LENGTH_OFFSET = 2;
@@ -70,14 +72,19 @@ class H4Packetizer : public HciProtocol {
 
   static constexpr size_t PREAMBLE_SIZE_MAX = ACL_PREAMBLE_SIZE;
 
+  // The type byte and the largest packet, an ACL packet with 0xffff bytes of data, always fit in the buffer
+  static constexpr size_t READ_BUFFER_SIZE = 2 * (1 + ACL_PREAMBLE_SIZE + 0xffff);
+
   size_t HciGetPacketLengthForType(hci::PacketType type, const uint8_t* preamble);
 
-  enum State { HCI_PREAMBLE, HCI_PAYLOAD };
-  State state_{HCI_PREAMBLE};
-  uint8_t preamble_[PREAMBLE_SIZE_MAX];
-  std::vector<uint8_t> packet_;
-  size_t bytes_remaining_{0};
-  size_t bytes_read_{0};
+  void OnPacketReady(hci::PacketType type, const uint8_t* data, size_t length);
+
+  // Hands the complete packets in [read_begin_, read_end_) to their callbacks
+  void ParsePackets();
+
+  std::vector<uint8_t> read_buffer_;
+  size_t read_begin_{0};
+  size_t read_end_{0};
 };
 
 }  // namespace hci
@@ -73,18 +73,15 @@ HciSocketDevice::HciSocketDevice(int file_descriptor) : socket_file_descriptor_(
 
   h4_ = hci::H4Packetizer(
       socket_file_descriptor_,
-      [this](const std::vector<uint8_t>& raw_command) {
-        std::shared_ptr<std::vector<uint8_t>> packet_copy = std::make_shared<std::vector<uint8_t>>(raw_command);
-        HandleCommand(packet_copy);
+      [this](const uint8_t* data, size_t length) {
+        HandleCommand(std::make_shared<std::vector<uint8_t>>(data, data + length));
       },
-      [](const std::vector<uint8_t>&) { LOG_ALWAYS_FATAL("Unexpected Event in HciSocketDevice!"); },
-      [this](const std::vector<uint8_t>& raw_acl) {
-        std::shared_ptr<std::vector<uint8_t>> packet_copy = std::make_shared<std::vector<uint8_t>>(raw_acl);
-        HandleAcl(packet_copy);
+      [](const uint8_t*, size_t) { LOG_ALWAYS_FATAL("Unexpected Event in HciSocketDevice!"); },
+      [this](const uint8_t* data, size_t length) {
+        HandleAcl(std::make_shared<std::vector<uint8_t>>(data, data + length));
       },
-      [this](const std::vector<uint8_t>& raw_sco) {
-        std::shared_ptr<std::vector<uint8_t>> packet_copy = std::make_shared<std::vector<uint8_t>>(raw_sco);
-        HandleSco(packet_copy);
+      [this](const uint8_t* data, size_t length) {
+        HandleSco(std::make_shared<std::vector<uint8_t>>(data, data + length));
       },
       [this]() {
         LOG_INFO("HCI socket device disconnected");
@@ -108,16 +105,8 @@ void HciSocketDevice::SendHci(hci::PacketType packet_type, const std::shared_ptr
     LOG_INFO("socket_file_descriptor == -1");
     return;
   }
-  uint8_t type = static_cast<uint8_t>(packet_type);
-  int bytes_written;
-  bytes_written = write(socket_file_descriptor_, &type, sizeof(type));
-  if (bytes_written != sizeof(type)) {
-    LOG_WARN("bytes_written %d != sizeof(type)", bytes_written);
-  }
-  bytes_written = write(socket_file_descriptor_, packet->data(), packet->size());
-  if (static_cast<size_t>(bytes_written) != packet->size()) {
-    LOG_WARN("bytes_written %d != packet->size", bytes_written);
-  }
+  // The type byte and the packet go out in a single writev, so that the host never reads one without the other
+  h4_.Send(static_cast<uint8_t>(packet_type), packet->data(), packet->size());
 }
 
 void HciSocketDevice::RegisterCloseCallback(std::function<void()> close_callback) {
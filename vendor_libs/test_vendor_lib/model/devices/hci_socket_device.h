@@ -50,10 +50,10 @@ class HciSocketDevice : public DualModeController {
  private:
   int socket_file_descriptor_{-1};
   hci::H4Packetizer h4_{socket_file_descriptor_,
-                        [](const std::vector<uint8_t>&) {},
-                        [](const std::vector<uint8_t>&) {},
-                        [](const std::vector<uint8_t>&) {},
-                        [](const std::vector<uint8_t>&) {},
+                        [](const uint8_t*, size_t) {},
+                        [](const uint8_t*, size_t) {},
+                        [](const uint8_t*, size_t) {},
+                        [](const uint8_t*, size_t) {},
                         [] {}};
 
   std::function<void()> close_callback_;
@@ -30,12 +30,20 @@ LinkLayerSocketDevice::LinkLayerSocketDevice(int socket_fd, Phy::Type phy_type)
     : socket_(socket_fd), phy_type_(phy_type) {}
 
 void LinkLayerSocketDevice::TimerTick() {
+  for (size_t i = 0; i < kMaxPacketsPerTick; i++) {
+    if (!ReceivePacket()) {
+      return;
+    }
+  }
+}
+
+bool LinkLayerSocketDevice::ReceivePacket() {
   if (bytes_left_ == 0) {
     auto packet_size = std::make_shared<std::vector<uint8_t>>(kSizeBytes);
 
     size_t bytes_received = socket_.TryReceive(kSizeBytes, packet_size->data());
     if (bytes_received == 0) {
-      return;
+      return false;
     }
     ASSERT_LOG(bytes_received == kSizeBytes, "bytes_received == %d", static_cast<int>(bytes_received));
     bluetooth::packet::PacketView<bluetooth::packet::kLittleEndian> size(
@@ -46,33 +54,34 @@ void LinkLayerSocketDevice::TimerTick() {
   }
   size_t bytes_received = socket_.TryReceive(bytes_left_, received_->data() + offset_);
   if (bytes_received == 0) {
-    return;
+    return false;
   }
   bytes_left_ -= bytes_received;
   offset_ += bytes_received;
-  if (bytes_left_ == 0) {
-    bluetooth::packet::PacketView<bluetooth::packet::kLittleEndian> packet_view(
-        received_);
-    auto packet = model::packets::LinkLayerPacketView::Create(packet_view);
-    ASSERT(packet.IsValid());
-    SendLinkLayerPacket(packet, phy_type_);
-    offset_ = 0;
-    received_.reset();
+  if (bytes_left_ != 0) {
+    return false;
   }
+  bluetooth::packet::PacketView<bluetooth::packet::kLittleEndian> packet_view(
+      received_);
+  auto packet = model::packets::LinkLayerPacketView::Create(packet_view);
+  ASSERT(packet.IsValid());
+  SendLinkLayerPacket(packet, phy_type_);
+  offset_ = 0;
+  received_.reset();
+  return true;
 }
 
 void LinkLayerSocketDevice::IncomingPacket(
     model::packets::LinkLayerPacketView packet) {
   auto size_packet = bluetooth::packet::RawBuilder();
   size_packet.AddOctets4(packet.size());
-  std::vector<uint8_t> size_bytes;
-  bluetooth::packet::BitInserter bit_inserter(size_bytes);
+  std::vector<uint8_t> packet_bytes;
+  packet_bytes.reserve(kSizeBytes + packet.size());
+  bluetooth::packet::BitInserter bit_inserter(packet_bytes);
   size_packet.Serialize(bit_inserter);
-
-  if (socket_.TrySend(size_bytes) == kSizeBytes) {
-    std::vector<uint8_t> payload_bytes{packet.begin(), packet.end()};
-    socket_.TrySend(payload_bytes);
-  }
+  // One write for the size and the payload, instead of a system call for each
+  packet_bytes.insert(packet_bytes.end(), packet.begin(), packet.end());
+  socket_.TrySend(packet_bytes);
 }
 
 }  // namespace test_vendor_lib
@@ -48,8 +48,14 @@ class LinkLayerSocketDevice : public Device {
   virtual void TimerTick() override;
 
   static constexpr size_t kSizeBytes = sizeof(uint32_t);
+  // Packets forwarded per tick at most, so that one busy socket can't starve
+  // the other devices of its shard
+  static constexpr size_t kMaxPacketsPerTick = 32;
 
  private:
+  // Returns true when a whole packet was received and forwarded
+  bool ReceivePacket();
+
   net::PolledSocket socket_;
   Phy::Type phy_type_;
   size_t bytes_left_{0};
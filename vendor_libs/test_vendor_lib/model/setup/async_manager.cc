@@ -20,6 +20,7 @@
 #include <atomic>
 #include <condition_variable>
 #include <mutex>
+#include <sstream>
 #include <thread>
 #include <vector>
 
@@ -72,6 +73,12 @@ namespace test_vendor_lib {
 // cond var possibly forever if there are no tasks scheduled, efectively
 // causing a deadlock).
 
+// In virtual time the thread never waits for a task that is due in the
+// future: once there is nothing else to run it moves its clock to the time of
+// the next task instead. Tasks due at the same time run in the order they
+// were scheduled, so a scenario runs as fast as its tasks can be processed and
+// in the same order each time.
+
 // This number also states the maximum number of scheduled tasks we can handle
 // at a given time
 static const uint16_t kMaxTaskId = -1; /* 2^16 - 1, permisible ids are {1..2^16-1}*/
@@ -270,12 +277,45 @@ class AsyncManager::AsyncFdWatcher {
 class AsyncManager::AsyncTaskManager {
  public:
   AsyncTaskId ExecAsync(std::chrono::milliseconds delay, const TaskCallback& callback) {
-    return scheduleTask(std::make_shared<Task>(std::chrono::steady_clock::now() + delay, callback));
+    return scheduleTask(delay, std::make_shared<Task>(callback));
   }
 
   AsyncTaskId ExecAsyncPeriodically(std::chrono::milliseconds delay, std::chrono::milliseconds period,
                                     const TaskCallback& callback) {
-    return scheduleTask(std::make_shared<Task>(std::chrono::steady_clock::now() + delay, period, callback));
+    return scheduleTask(delay, std::make_shared<Task>(period, callback));
+  }
+
+  void SetVirtualTime(bool enabled) {
+    std::unique_lock<std::mutex> guard(internal_mutex_);
+    if (enabled == virtual_time_) {
+      return;
+    }
+    auto real_now = std::chrono::steady_clock::now();
+    if (enabled) {
+      virtual_now_ = real_now;
+    } else {
+      // Keep the delays of the pending tasks. The shift keeps their order.
+      auto offset = real_now - virtual_now_;
+      for (auto& task : task_queue_) {
+        task->time += offset;
+      }
+      statistics_start_task_time_ += offset;
+    }
+    virtual_time_ = enabled;
+    internal_cond_var_.notify_one();
+  }
+
+  std::chrono::steady_clock::time_point Now() {
+    std::unique_lock<std::mutex> guard(internal_mutex_);
+    return now();
+  }
+
+  AsyncManager::TaskStatistics GetTaskStatistics() {
+    std::unique_lock<std::mutex> guard(internal_mutex_);
+    AsyncManager::TaskStatistics statistics = statistics_;
+    statistics.task_time = now() - statistics_start_task_time_;
+    statistics.wall_time = std::chrono::steady_clock::now() - statistics_start_wall_time_;
+    return statistics;
   }
 
   bool CancelAsyncTask(AsyncTaskId async_task_id) {
@@ -317,14 +357,14 @@ class AsyncManager::AsyncTaskManager {
   // Holds the data for each task
   class Task {
    public:
-    Task(std::chrono::steady_clock::time_point time, std::chrono::milliseconds period, const TaskCallback& callback)
-        : time(time), periodic(true), period(period), callback(callback), task_id(kInvalidTaskId) {}
-    Task(std::chrono::steady_clock::time_point time, const TaskCallback& callback)
-        : time(time), periodic(false), callback(callback), task_id(kInvalidTaskId) {}
+    Task(std::chrono::milliseconds period, const TaskCallback& callback)
+        : periodic(true), period(period), callback(callback), task_id(kInvalidTaskId) {}
+    explicit Task(const TaskCallback& callback) : periodic(false), callback(callback), task_id(kInvalidTaskId) {}
 
-    // Operators needed to be in a collection
+    // Operators needed to be in a collection. The ids are reused, the
+    // sequence keeps the tasks due at the same time in scheduling order.
     bool operator<(const Task& another) const {
-      return std::make_pair(time, task_id) < std::make_pair(another.time, another.task_id);
+      return std::make_pair(time, sequence) < std::make_pair(another.time, another.sequence);
     }
 
     bool isPeriodic() const {
@@ -338,6 +378,7 @@ class AsyncManager::AsyncTaskManager {
     std::chrono::milliseconds period;
     TaskCallback callback;
     AsyncTaskId task_id;
+    uint64_t sequence{0};
   };
 
   // A comparator class to put shared pointers to tasks in an ordered set
@@ -350,7 +391,12 @@ class AsyncManager::AsyncTaskManager {
   AsyncTaskManager(const AsyncTaskManager&) = delete;
   AsyncTaskManager& operator=(const AsyncTaskManager&) = delete;
 
-  AsyncTaskId scheduleTask(const std::shared_ptr<Task>& task) {
+  // Must be called with the lock held
+  std::chrono::steady_clock::time_point now() const {
+    return virtual_time_ ? virtual_now_ : std::chrono::steady_clock::now();
+  }
+
+  AsyncTaskId scheduleTask(std::chrono::milliseconds delay, const std::shared_ptr<Task>& task) {
     AsyncTaskId task_id = kInvalidTaskId;
     {
       std::unique_lock<std::mutex> guard(internal_mutex_);
@@ -361,6 +407,10 @@ class AsyncManager::AsyncTaskManager {
         lastTaskId_ = NextAsyncTaskId(lastTaskId_);
       } while (isTaskIdInUse(lastTaskId_));
       task->task_id = lastTaskId_;
+      // The time is taken under the lock, so that the virtual clock can't
+      // move past it before the task is queued
+      task->time = now() + delay;
+      task->sequence = next_sequence_++;
       // add task to the queue and map
       tasks_by_id[lastTaskId_] = task;
       task_queue_.insert(task);
@@ -403,13 +453,19 @@ class AsyncManager::AsyncTaskManager {
     while (1) {
       TaskCallback callback;
       bool run_it = false;
+      std::chrono::steady_clock::time_point due_time;
       {
         std::unique_lock<std::mutex> guard(internal_mutex_);
         if (!task_queue_.empty()) {
           std::shared_ptr<Task> task_p = *(task_queue_.begin());
-          if (task_p->time < std::chrono::steady_clock::now()) {
+          if (virtual_time_ && task_p->time > virtual_now_) {
+            virtual_now_ = task_p->time;
+          }
+          bool due = virtual_time_ ? task_p->time <= virtual_now_ : task_p->time < std::chrono::steady_clock::now();
+          if (due) {
             run_it = true;
             callback = task_p->callback;
+            due_time = task_p->time;
             task_queue_.erase(task_p);  // need to remove and add again if
                                         // periodic to update order
             if (task_p->isPeriodic()) {
@@ -422,14 +478,28 @@ class AsyncManager::AsyncTaskManager {
         }
       }
       if (run_it) {
+        auto start = std::chrono::steady_clock::now();
         callback();
+        auto callback_time = std::chrono::steady_clock::now() - start;
+        std::unique_lock<std::mutex> guard(internal_mutex_);
+        auto lateness = virtual_time_ ? std::chrono::nanoseconds(0) : start - due_time;
+        statistics_.tasks_run++;
+        statistics_.busy_time += callback_time;
+        statistics_.max_callback_time = std::max<std::chrono::nanoseconds>(statistics_.max_callback_time, callback_time);
+        statistics_.total_lateness += lateness;
+        statistics_.max_lateness = std::max<std::chrono::nanoseconds>(statistics_.max_lateness, lateness);
       }
       {
         std::unique_lock<std::mutex> guard(internal_mutex_);
+        // the thread may have been stopped while the callback ran, after the
+        // notification was sent
+        if (!running_) break;
         // wait on condition variable with timeout just in time for next task if
-        // any
+        // any, in virtual time the next task is run right away
         if (task_queue_.size() > 0) {
-          internal_cond_var_.wait_until(guard, (*task_queue_.begin())->time);
+          if (!virtual_time_) {
+            internal_cond_var_.wait_until(guard, (*task_queue_.begin())->time);
+          }
         } else {
           internal_cond_var_.wait(guard);
         }
@@ -445,8 +515,16 @@ class AsyncManager::AsyncTaskManager {
   std::condition_variable internal_cond_var_;
 
   AsyncTaskId lastTaskId_ = kInvalidTaskId;
+  uint64_t next_sequence_ = 0;
   std::map<AsyncTaskId, std::shared_ptr<Task> > tasks_by_id;
   std::set<std::shared_ptr<Task>, task_p_comparator> task_queue_;
+
+  bool virtual_time_ = false;
+  std::chrono::steady_clock::time_point virtual_now_;
+
+  AsyncManager::TaskStatistics statistics_;
+  std::chrono::steady_clock::time_point statistics_start_task_time_ = std::chrono::steady_clock::now();
+  std::chrono::steady_clock::time_point statistics_start_wall_time_ = statistics_start_task_time_;
 };
 
 // Async Manager Implementation:
@@ -488,4 +566,37 @@ void AsyncManager::Synchronize(const CriticalCallback& critical) {
   std::unique_lock<std::mutex> guard(synchronization_mutex_);
   critical();
 }
+
+void AsyncManager::SetVirtualTime(bool enabled) {
+  taskManager_p_->SetVirtualTime(enabled);
+}
+
+std::chrono::steady_clock::time_point AsyncManager::Now() {
+  return taskManager_p_->Now();
+}
+
+AsyncManager::TaskStatistics AsyncManager::GetTaskStatistics() {
+  return taskManager_p_->GetTaskStatistics();
+}
+
+std::string AsyncManager::TaskStatistics::ToString() const {
+  using std::chrono::duration_cast;
+  using std::chrono::microseconds;
+  using std::chrono::milliseconds;
+  std::stringstream report;
+  report << "tasks: " << tasks_run;
+  report << ", task time: " << duration_cast<milliseconds>(task_time).count() << " ms";
+  report << ", wall time: " << duration_cast<milliseconds>(wall_time).count() << " ms";
+  if (wall_time.count() > 0) {
+    report << " (x" << static_cast<double>(task_time.count()) / wall_time.count() << ")";
+    report << ", throughput: " << tasks_run * 1000000000 / wall_time.count() << " tasks/s";
+  }
+  report << ", busy: " << duration_cast<milliseconds>(busy_time).count() << " ms";
+  report << ", max callback: " << duration_cast<microseconds>(max_callback_time).count() << " us";
+  if (tasks_run > 0) {
+    report << ", mean lateness: " << duration_cast<microseconds>(total_lateness).count() / tasks_run << " us";
+  }
+  report << ", max lateness: " << duration_cast<microseconds>(max_lateness).count() << " us";
+  return report.str();
+}
 }  // namespace test_vendor_lib
@@ -12,6 +12,7 @@
 #include <functional>
 #include <memory>
 #include <mutex>
+#include <string>
 #include <utility>
 
 namespace test_vendor_lib {
@@ -83,6 +84,34 @@ class AsyncManager {
   // have very simple CriticalCallbacks, preferably using lambda expressions.
   void Synchronize(const CriticalCallback&);
 
+  // In virtual time the tasks no longer wait for the wall clock: when no task
+  // is due, the clock of the tasks jumps to the next one. Tasks due at the
+  // same time run in the order they were scheduled, so long scenarios run as
+  // fast as their tasks can be processed and the same way every time. The
+  // delays of the pending tasks are kept when switching.
+  void SetVirtualTime(bool enabled);
+
+  // The current time of the tasks, which is virtual in virtual time
+  std::chrono::steady_clock::time_point Now();
+
+  struct TaskStatistics {
+    uint64_t tasks_run{0};
+    // How far the clock of the tasks moved, and how long that took
+    std::chrono::nanoseconds task_time{0};
+    std::chrono::nanoseconds wall_time{0};
+    // Wall clock time spent in the task callbacks
+    std::chrono::nanoseconds busy_time{0};
+    std::chrono::nanoseconds max_callback_time{0};
+    // How late the tasks started, always 0 in virtual time
+    std::chrono::nanoseconds total_lateness{0};
+    std::chrono::nanoseconds max_lateness{0};
+
+    std::string ToString() const;
+  };
+
+  // Returns the statistics of the tasks run since the construction
+  TaskStatistics GetTaskStatistics();
+
   AsyncManager();
 
   ~AsyncManager();
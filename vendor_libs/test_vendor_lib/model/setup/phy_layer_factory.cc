@@ -17,10 +17,14 @@
 #include "phy_layer_factory.h"
 #include <sstream>
 
+#include "simulation_engine.h"
+
 namespace test_vendor_lib {
 
 PhyLayerFactory::PhyLayerFactory(Phy::Type phy_type, uint32_t factory_id)
-    : phy_type_(phy_type), factory_id_(factory_id) {}
+    : phy_type_(phy_type),
+      receivers_(std::make_shared<const Receivers>()),
+      factory_id_(factory_id) {}
 
 Phy::Type PhyLayerFactory::GetType() {
   return phy_type_;
@@ -34,21 +38,51 @@ std::shared_ptr<PhyLayer> PhyLayerFactory::GetPhyLayer(
     const std::function<void(model::packets::LinkLayerPacketView)>&
         device_receive,
     uint32_t device_id) {
+  std::lock_guard<std::mutex> lock(mutex_);
   std::shared_ptr<PhyLayer> new_phy = std::make_shared<PhyLayerImpl>(
       phy_type_, next_id_++, device_receive, device_id,
       std::shared_ptr<PhyLayerFactory>(this));
   phy_layers_.push_back(new_phy);
+  UpdateReceivers();
   return new_phy;
 }
 
 void PhyLayerFactory::UnregisterPhyLayer(uint32_t id) {
+  // Phy layers unregister themselves when they are destroyed, so the last
+  // references are only released once |mutex_| is unlocked
+  std::vector<std::shared_ptr<PhyLayer>> removed;
+  std::shared_ptr<const Receivers> previous_receivers;
+  std::lock_guard<std::mutex> lock(mutex_);
   for (auto it = phy_layers_.begin(); it != phy_layers_.end();) {
     if ((*it)->GetId() == id) {
+      removed.push_back(std::move(*it));
       it = phy_layers_.erase(it);
     } else {
       it++;
     }
   }
+  previous_receivers = receivers_;
+  UpdateReceivers();
+}
+
+void PhyLayerFactory::SetSimulationEngine(SimulationEngine* engine) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  engine_ = engine;
+  UpdateReceivers();
+}
+
+void PhyLayerFactory::UpdateReceivers() {
+  auto receivers = std::make_shared<Receivers>();
+  receivers->engine = engine_;
+  receivers->all = phy_layers_;
+  if (engine_ != nullptr) {
+    receivers->by_shard.resize(engine_->GetNumShards());
+    for (const auto& phy : phy_layers_) {
+      receivers->by_shard[engine_->GetShard(phy->GetDeviceId())].push_back(
+          phy);
+    }
+  }
+  receivers_ = std::move(receivers);
 }
 
 void PhyLayerFactory::Send(
@@ -70,15 +104,41 @@ void PhyLayerFactory::Send(
 
 void PhyLayerFactory::Send(model::packets::LinkLayerPacketView packet,
                            uint32_t id) {
-  for (const auto& phy : phy_layers_) {
-    if (id != phy->GetId()) {
-      phy->Receive(packet);
+  std::shared_ptr<const Receivers> receivers;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    receivers = receivers_;
+  }
+  if (receivers->engine == nullptr) {
+    for (const auto& phy : receivers->all) {
+      if (id != phy->GetId()) {
+        phy->Receive(packet);
+      }
+    }
+    return;
+  }
+  for (size_t shard = 0; shard < receivers->by_shard.size(); shard++) {
+    if (receivers->by_shard[shard].empty()) {
+      continue;
     }
+    receivers->engine->Post(
+        shard, std::chrono::milliseconds(0), [receivers, shard, packet, id]() {
+          for (const auto& phy : receivers->by_shard[shard]) {
+            if (id != phy->GetId()) {
+              phy->Receive(packet);
+            }
+          }
+        });
   }
 }
 
 void PhyLayerFactory::TimerTick() {
-  for (auto& phy : phy_layers_) {
+  std::shared_ptr<const Receivers> receivers;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    receivers = receivers_;
+  }
+  for (auto& phy : receivers->all) {
     phy->TimerTick();
   }
 }
@@ -95,6 +155,7 @@ std::string PhyLayerFactory::ToString() const {
     default:
       factory << "Unknown: ";
   }
+  std::lock_guard<std::mutex> lock(mutex_);
   for (auto& phy : phy_layers_) {
     factory << phy->GetDeviceId();
     factory << ",";
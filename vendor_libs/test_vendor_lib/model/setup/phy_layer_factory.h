@@ -17,6 +17,7 @@
 #pragma once
 
 #include <memory>
+#include <mutex>
 #include <vector>
 
 #include "include/phy.h"
@@ -25,6 +26,8 @@
 
 namespace test_vendor_lib {
 
+class SimulationEngine;
+
 class PhyLayerFactory {
   friend class PhyLayerImpl;
 
@@ -44,6 +47,10 @@ class PhyLayerFactory {
 
   void UnregisterPhyLayer(uint32_t id);
 
+  // Delivers the packets on the shards of the receiving devices, one task per
+  // shard and packet. Without an engine the packets are delivered inline.
+  void SetSimulationEngine(SimulationEngine* engine);
+
   virtual void TimerTick();
 
   virtual std::string ToString() const;
@@ -55,8 +62,23 @@ class PhyLayerFactory {
   virtual void Send(model::packets::LinkLayerPacketView packet, uint32_t id);
 
  private:
+  // A copy of the phy layers, replaced on every change so that Send() does
+  // not hold |mutex_| while the devices receive
+  struct Receivers {
+    SimulationEngine* engine{nullptr};
+    std::vector<std::shared_ptr<PhyLayer>> all;
+    // |all| grouped by the shard of their device, when there is an engine
+    std::vector<std::vector<std::shared_ptr<PhyLayer>>> by_shard;
+  };
+
+  // Must be called with |mutex_| held
+  void UpdateReceivers();
+
   Phy::Type phy_type_;
+  mutable std::mutex mutex_;
   std::vector<std::shared_ptr<PhyLayer>> phy_layers_;
+  SimulationEngine* engine_{nullptr};
+  std::shared_ptr<const Receivers> receivers_;
   uint32_t next_id_{1};
   const uint32_t factory_id_;
 };
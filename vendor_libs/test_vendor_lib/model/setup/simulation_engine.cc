@@ -0,0 +1,171 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "simulation_engine.h"
+
+#include <algorithm>
+#include <future>
+
+#include "os/log.h"
+
+namespace test_vendor_lib {
+
+SimulationEngine::SimulationEngine(size_t num_shards) {
+  ASSERT_LOG(num_shards > 0, "A simulation needs at least one shard");
+  for (size_t i = 0; i < num_shards; i++) {
+    shards_.push_back(std::make_unique<Shard>());
+  }
+  for (auto& shard : shards_) {
+    Shard* raw_shard = shard.get();
+    shard->worker = std::thread([this, raw_shard]() { run(*raw_shard); });
+  }
+}
+
+SimulationEngine::~SimulationEngine() {
+  StopPeriodic();
+  for (auto& shard : shards_) {
+    {
+      std::lock_guard<std::mutex> lock(shard->mutex);
+      shard->running = false;
+    }
+    shard->wake_up.notify_one();
+  }
+  for (auto& shard : shards_) {
+    shard->worker.join();
+  }
+}
+
+size_t SimulationEngine::GetNumShards() const {
+  return shards_.size();
+}
+
+size_t SimulationEngine::GetShard(uint32_t device_id) const {
+  return device_id % shards_.size();
+}
+
+bool SimulationEngine::later(const Event& a, const Event& b) {
+  if (a.when != b.when) {
+    return a.when > b.when;
+  }
+  return a.sequence > b.sequence;
+}
+
+void SimulationEngine::push(Shard& shard, Clock::time_point when, Task task) {
+  shard.events.push_back(Event{when, shard.next_sequence++, std::move(task)});
+  std::push_heap(shard.events.begin(), shard.events.end(), later);
+}
+
+void SimulationEngine::Post(size_t shard, std::chrono::milliseconds delay, Task task) {
+  ASSERT(shard < shards_.size());
+  Shard& target = *shards_[shard];
+  {
+    std::lock_guard<std::mutex> lock(target.mutex);
+    push(target, Clock::now() + delay, std::move(task));
+  }
+  target.wake_up.notify_one();
+}
+
+void SimulationEngine::PostBatch(size_t shard, std::vector<Task> tasks) {
+  ASSERT(shard < shards_.size());
+  if (tasks.empty()) {
+    return;
+  }
+  Shard& target = *shards_[shard];
+  auto now = Clock::now();
+  {
+    std::lock_guard<std::mutex> lock(target.mutex);
+    for (auto& task : tasks) {
+      push(target, now, std::move(task));
+    }
+  }
+  target.wake_up.notify_one();
+}
+
+void SimulationEngine::run(Shard& shard) {
+  std::vector<Task> due_tasks;
+  std::unique_lock<std::mutex> lock(shard.mutex);
+  while (shard.running) {
+    if (shard.events.empty()) {
+      shard.wake_up.wait(lock);
+      continue;
+    }
+    auto now = Clock::now();
+    // A copy, the heap can be reallocated while waiting
+    Clock::time_point next_deadline = shard.events.front().when;
+    if (next_deadline > now) {
+      shard.wake_up.wait_until(lock, next_deadline);
+      continue;
+    }
+    // Take everything that is due at once, so that a burst of packets costs a single lock round trip
+    while (!shard.events.empty() && shard.events.front().when <= now) {
+      std::pop_heap(shard.events.begin(), shard.events.end(), later);
+      due_tasks.push_back(std::move(shard.events.back().task));
+      shard.events.pop_back();
+    }
+    lock.unlock();
+    for (auto& task : due_tasks) {
+      task();
+    }
+    due_tasks.clear();
+    lock.lock();
+  }
+}
+
+void SimulationEngine::StartPeriodic(std::chrono::milliseconds period, std::function<void(size_t shard)> tick) {
+  ASSERT_LOG(period.count() > 0, "The period must be positive");
+  uint64_t generation = ++periodic_generation_;
+  auto periodic = std::make_shared<const std::function<void(size_t shard)>>(std::move(tick));
+  auto now = Clock::now();
+  for (size_t shard = 0; shard < shards_.size(); shard++) {
+    std::lock_guard<std::mutex> lock(shards_[shard]->mutex);
+    push(*shards_[shard], now,
+         [this, shard, generation, period, now, periodic]() { this->tick(shard, generation, period, now, periodic); });
+  }
+  for (auto& shard : shards_) {
+    shard->wake_up.notify_one();
+  }
+}
+
+void SimulationEngine::StopPeriodic() {
+  periodic_generation_++;
+}
+
+void SimulationEngine::tick(size_t shard, uint64_t generation, std::chrono::milliseconds period,
+                            Clock::time_point when, std::shared_ptr<const std::function<void(size_t shard)>> periodic) {
+  if (generation != periodic_generation_) {
+    return;
+  }
+  (*periodic)(shard);
+  // Skip the ticks that were missed while the shard was busy, instead of running them back to back
+  auto next = std::max(when + period, Clock::now());
+  std::lock_guard<std::mutex> lock(shards_[shard]->mutex);
+  push(*shards_[shard], next,
+       [this, shard, generation, period, next, periodic]() { this->tick(shard, generation, period, next, periodic); });
+}
+
+void SimulationEngine::Flush() {
+  std::vector<std::future<void>> flushed;
+  for (size_t shard = 0; shard < shards_.size(); shard++) {
+    auto promise = std::make_shared<std::promise<void>>();
+    flushed.push_back(promise->get_future());
+    Post(shard, std::chrono::milliseconds(0), [promise]() { promise->set_value(); });
+  }
+  for (auto& future : flushed) {
+    future.wait();
+  }
+}
+
+}  // namespace test_vendor_lib
@@ -0,0 +1,96 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace test_vendor_lib {
+
+// Runs the simulated devices on a fixed number of shards, each with its own worker thread and event heap.
+//
+// A device always runs on the shard picked by GetShard(), so that its timer ticks and the link layer packets it
+// receives run on one thread, in the order they were posted, without any locking in the device itself.
+class SimulationEngine {
+ public:
+  using Clock = std::chrono::steady_clock;
+  using Task = std::function<void()>;
+
+  explicit SimulationEngine(size_t num_shards);
+
+  // Stops the workers, dropping the tasks that have not run yet
+  ~SimulationEngine();
+
+  size_t GetNumShards() const;
+
+  // Returns the shard that runs |device_id|
+  size_t GetShard(uint32_t device_id) const;
+
+  // Runs |task| on |shard| once |delay| has passed
+  void Post(size_t shard, std::chrono::milliseconds delay, Task task);
+
+  // Runs |tasks| on |shard| in order, with a single wake up of its worker
+  void PostBatch(size_t shard, std::vector<Task> tasks);
+
+  // Calls |tick| on every shard every |period|, replacing the previous periodic tick
+  void StartPeriodic(std::chrono::milliseconds period, std::function<void(size_t shard)> tick);
+
+  // Stops rescheduling the periodic tick, a tick which already started may still be running
+  void StopPeriodic();
+
+  // Waits until every shard ran the tasks that were due when it was called. Must not be called from a shard.
+  void Flush();
+
+ private:
+  struct Event {
+    Clock::time_point when;
+    uint64_t sequence;
+    Task task;
+  };
+
+  struct Shard {
+    std::mutex mutex;
+    std::condition_variable wake_up;
+    // A min-heap on (when, sequence), so that the tasks due at the same time run in the order they were posted
+    std::vector<Event> events;
+    uint64_t next_sequence{0};
+    bool running{true};
+    std::thread worker;
+  };
+
+  static bool later(const Event& a, const Event& b);
+  void push(Shard& shard, Clock::time_point when, Task task);
+  void run(Shard& shard);
+  void tick(size_t shard, uint64_t generation, std::chrono::milliseconds period, Clock::time_point when,
+            std::shared_ptr<const std::function<void(size_t shard)>> periodic);
+
+  std::vector<std::unique_ptr<Shard>> shards_;
+  // Incremented by StartPeriodic() and StopPeriodic(), so that the ticks of a previous period stop rescheduling
+  std::atomic<uint64_t> periodic_generation_{0};
+
+  SimulationEngine(const SimulationEngine&) = delete;
+  SimulationEngine& operator=(const SimulationEngine&) = delete;
+};
+
+}  // namespace test_vendor_lib
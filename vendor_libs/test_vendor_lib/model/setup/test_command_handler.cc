@@ -48,6 +48,7 @@ TestCommandHandler::TestCommandHandler(TestModel& test_model) : model_(test_mode
   SET_HANDLER("set_timer_period", SetTimerPeriod);
   SET_HANDLER("start_timer", StartTimer);
   SET_HANDLER("stop_timer", StopTimer);
+  SET_HANDLER("set_simulation_shards", SetSimulationShards);
 #undef SET_HANDLER
 }
 
@@ -251,4 +252,16 @@ void TestCommandHandler::StopTimer(const vector<std::string>& args) {
   model_.StopTimer();
 }
 
+void TestCommandHandler::SetSimulationShards(const vector<std::string>& args) {
+  if (args.size() != 1) {
+    response_string_ = "TestCommandHandler 'set_simulation_shards' takes an argument";
+    send_response_(response_string_);
+    return;
+  }
+  size_t num_shards = std::stoi(args[0]);
+  model_.SetSimulationShards(num_shards);
+  response_string_ = "TestCommandHandler 'set_simulation_shards' called with " + args[0] + " shards";
+  send_response_(response_string_);
+}
+
 }  // namespace test_vendor_lib
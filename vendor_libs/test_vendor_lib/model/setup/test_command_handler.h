@@ -79,6 +79,9 @@ class TestCommandHandler {
 
   void StopTimer(const std::vector<std::string>& args);
 
+  // Spread the devices over several simulation threads
+  void SetSimulationShards(const std::vector<std::string>& args);
+
   // For manual testing
   void AddDefaults();
 
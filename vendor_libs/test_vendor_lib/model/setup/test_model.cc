@@ -68,10 +68,17 @@ TestModel::TestModel(
   example_devices_.push_back(std::make_shared<RemoteLoopbackDevice>());
 }
 
+TestModel::~TestModel() {
+  // The phys can outlive the engine, when a device still holds one of their phy layers
+  for (auto& phy : phys_) {
+    phy.second->SetSimulationEngine(nullptr);
+  }
+}
+
 void TestModel::SetTimerPeriod(std::chrono::milliseconds new_period) {
   timer_period_ = new_period;
 
-  if (timer_tick_task_ == kInvalidTaskId) return;
+  if (!timer_running_) return;
 
   // Restart the timer with the new period
   StopTimer();
@@ -80,19 +87,74 @@ void TestModel::SetTimerPeriod(std::chrono::milliseconds new_period) {
 
 void TestModel::StartTimer() {
   LOG_INFO("StartTimer()");
+  timer_running_ = true;
+  if (engine_ != nullptr) {
+    engine_->StartPeriodic(timer_period_, [this](size_t shard) { ShardTimerTick(shard); });
+    return;
+  }
   timer_tick_task_ =
       schedule_periodic_task_(std::chrono::milliseconds(0), timer_period_, [this]() { TestModel::TimerTick(); });
 }
 
 void TestModel::StopTimer() {
   LOG_INFO("StopTimer()");
+  timer_running_ = false;
+  if (engine_ != nullptr) {
+    engine_->StopPeriodic();
+  }
   cancel_task_(timer_tick_task_);
   timer_tick_task_ = kInvalidTaskId;
 }
 
+void TestModel::SetSimulationShards(size_t num_shards) {
+  LOG_INFO("SetSimulationShards(%zu)", num_shards);
+  bool timer_running = timer_running_;
+  if (timer_running) {
+    StopTimer();
+  }
+  if (engine_ != nullptr) {
+    engine_->Flush();
+    for (auto& phy : phys_) {
+      phy.second->SetSimulationEngine(nullptr);
+    }
+    engine_.reset();
+  }
+  {
+    std::lock_guard<std::mutex> lock(shard_devices_mutex_);
+    shard_devices_.clear();
+    if (num_shards > 1) {
+      engine_ = std::make_unique<SimulationEngine>(num_shards);
+      shard_devices_.resize(num_shards);
+      for (auto& device : devices_) {
+        shard_devices_[engine_->GetShard(device.first)][device.first] = device.second;
+      }
+    }
+  }
+  if (engine_ != nullptr) {
+    for (auto& phy : phys_) {
+      phy.second->SetSimulationEngine(engine_.get());
+    }
+  }
+  if (timer_running) {
+    StartTimer();
+  }
+}
+
+void TestModel::RunOnDeviceShard(size_t device_index, std::function<void()> task) {
+  if (engine_ == nullptr) {
+    task();
+    return;
+  }
+  engine_->Post(engine_->GetShard(device_index), std::chrono::milliseconds(0), std::move(task));
+}
+
 size_t TestModel::Add(std::shared_ptr<Device> new_dev) {
   devices_counter_++;
   devices_[devices_counter_] = new_dev;
+  if (engine_ != nullptr) {
+    std::lock_guard<std::mutex> lock(shard_devices_mutex_);
+    shard_devices_[engine_->GetShard(devices_counter_)][devices_counter_] = new_dev;
+  }
   return devices_counter_;
 }
 
@@ -102,12 +164,17 @@ void TestModel::Del(size_t dev_index) {
     LOG_WARN("Del: can't find device!");
     return;
   }
+  if (engine_ != nullptr) {
+    std::lock_guard<std::mutex> lock(shard_devices_mutex_);
+    shard_devices_[engine_->GetShard(dev_index)].erase(dev_index);
+  }
   devices_.erase(dev_index);
 }
 
 size_t TestModel::AddPhy(Phy::Type phy_type) {
   phys_counter_++;
   std::shared_ptr<PhyLayerFactory> new_phy = std::make_shared<PhyLayerFactory>(phy_type, phys_counter_);
+  new_phy->SetSimulationEngine(engine_.get());
   phys_[phys_counter_] = new_phy;
   return phys_counter_;
 }
@@ -133,11 +200,12 @@ void TestModel::AddDeviceToPhy(size_t dev_index, size_t phy_index) {
     return;
   }
   auto dev = device->second;
-  dev->RegisterPhyLayer(phy->second->GetPhyLayer(
+  auto phy_layer = phy->second->GetPhyLayer(
       [dev](model::packets::LinkLayerPacketView packet) {
         dev->IncomingPacket(packet);
       },
-      device->first));
+      device->first);
+  RunOnDeviceShard(dev_index, [dev, phy_layer]() { dev->RegisterPhyLayer(phy_layer); });
 }
 
 void TestModel::DelDeviceFromPhy(size_t dev_index, size_t phy_index) {
@@ -151,7 +219,10 @@ void TestModel::DelDeviceFromPhy(size_t dev_index, size_t phy_index) {
     LOG_WARN("%s: can't find phy!", __func__);
     return;
   }
-  device->second->UnregisterPhyLayer(phy->second->GetType(), phy->second->GetFactoryId());
+  auto dev = device->second;
+  auto phy_type = phy->second->GetType();
+  auto factory_id = phy->second->GetFactoryId();
+  RunOnDeviceShard(dev_index, [dev, phy_type, factory_id]() { dev->UnregisterPhyLayer(phy_type, factory_id); });
 }
 
 void TestModel::AddLinkLayerConnection(int socket_fd, Phy::Type phy_type) {
@@ -203,8 +274,9 @@ void TestModel::OnHciConnectionClosed(int socket_fd, size_t index) {
   }
   int close_result = close(socket_fd);
   ASSERT_LOG(close_result == 0, "can't close: %s", strerror(errno));
-  device->second->UnregisterPhyLayers();
-  devices_.erase(index);
+  auto dev = device->second;
+  RunOnDeviceShard(index, [dev]() { dev->UnregisterPhyLayers(); });
+  Del(index);
 }
 
 void TestModel::SetDeviceAddress(size_t index, Address address) {
@@ -213,7 +285,8 @@ void TestModel::SetDeviceAddress(size_t index, Address address) {
     LOG_WARN("SetDeviceAddress can't find device!");
     return;
   }
-  device->second->SetAddress(address);
+  auto dev = device->second;
+  RunOnDeviceShard(index, [dev, address]() { dev->SetAddress(address); });
 }
 
 const std::string& TestModel::List() {
@@ -239,8 +312,28 @@ void TestModel::TimerTick() {
   }
 }
 
+void TestModel::ShardTimerTick(size_t shard) {
+  std::vector<std::shared_ptr<Device>> devices;
+  {
+    std::lock_guard<std::mutex> lock(shard_devices_mutex_);
+    for (auto& device : shard_devices_[shard]) {
+      devices.push_back(device.second);
+    }
+  }
+  for (auto& device : devices) {
+    device->TimerTick();
+  }
+}
+
 void TestModel::Reset() {
   StopTimer();
+  if (engine_ != nullptr) {
+    engine_->Flush();
+    std::lock_guard<std::mutex> lock(shard_devices_mutex_);
+    for (auto& devices : shard_devices_) {
+      devices.clear();
+    }
+  }
   devices_.clear();
   phys_.clear();
 }
@@ -19,6 +19,7 @@
 #include <unistd.h>
 #include <cstdint>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -26,6 +27,7 @@
 #include "async_manager.h"
 #include "model/devices/device.h"
 #include "phy_layer_factory.h"
+#include "simulation_engine.h"
 #include "test_channel_transport.h"
 
 namespace test_vendor_lib {
@@ -36,7 +38,7 @@ class TestModel {
             std::function<AsyncTaskId(std::chrono::milliseconds, std::chrono::milliseconds, const TaskCallback&)>
                 periodicEvtScheduler,
             std::function<void(AsyncTaskId)> cancel, std::function<int(const std::string&, int)> connect_to_remote);
-  ~TestModel() = default;
+  ~TestModel();
 
   // Commands:
 
@@ -78,6 +80,11 @@ class TestModel {
   void StopTimer();
   void SetTimerPeriod(std::chrono::milliseconds new_period);
 
+  // Runs the devices on |num_shards| threads, each with its own timer tick and
+  // link layer packet delivery. One shard keeps everything on the async
+  // manager, as before.
+  void SetSimulationShards(size_t num_shards);
+
   // List the devices that the test knows about
   const std::string& List();
 
@@ -91,6 +98,10 @@ class TestModel {
   size_t devices_counter_ = 0;
   std::string list_string_;
 
+  // Runs |task| on the shard of |device_index|, or right away without shards
+  void RunOnDeviceShard(size_t device_index, std::function<void()> task);
+  void ShardTimerTick(size_t shard);
+
   // Callbacks to schedule tasks.
   std::function<AsyncTaskId(std::chrono::milliseconds, const TaskCallback&)> schedule_task_;
   std::function<AsyncTaskId(std::chrono::milliseconds, std::chrono::milliseconds, const TaskCallback&)>
@@ -99,8 +110,15 @@ class TestModel {
   std::function<int(const std::string&, int)> connect_to_remote_;
 
   AsyncTaskId timer_tick_task_{kInvalidTaskId};
+  bool timer_running_{false};
   std::chrono::milliseconds timer_period_;
 
+  // The devices of each shard, ticked by its worker
+  std::mutex shard_devices_mutex_;
+  std::vector<std::map<size_t, std::shared_ptr<Device>>> shard_devices_;
+  // Destroyed first, so that no shard runs once the devices are gone
+  std::unique_ptr<SimulationEngine> engine_;
+
   TestModel(TestModel& model) = delete;
   TestModel& operator=(const TestModel& model) = delete;
 
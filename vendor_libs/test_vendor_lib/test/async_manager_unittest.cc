@@ -18,6 +18,7 @@
 #include <gtest/gtest.h>
 #include <cstdint>
 #include <cstring>
+#include <future>
 #include <vector>
 
 #include <netdb.h>
@@ -168,4 +169,68 @@ TEST_F(AsyncManagerSocketTest, TestMultipleConnections) {
   }
 }
 
+class AsyncManagerVirtualTimeTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    async_manager_.SetVirtualTime(true);
+  }
+
+  // Runs |task| on the task thread and waits until it's done. The clock can't move while it runs.
+  void RunOnTaskThread(std::chrono::milliseconds delay, const std::function<void()>& task) {
+    auto promise = std::make_shared<std::promise<void>>();
+    auto future = promise->get_future();
+    async_manager_.ExecAsync(delay, [task, promise]() {
+      task();
+      promise->set_value();
+    });
+    EXPECT_EQ(future.wait_for(std::chrono::seconds(10)), std::future_status::ready);
+  }
+
+  AsyncManager async_manager_;
+};
+
+TEST_F(AsyncManagerVirtualTimeTest, TestLongDelaysRunImmediately) {
+  std::chrono::steady_clock::time_point start;
+  std::chrono::steady_clock::time_point run_time;
+  RunOnTaskThread(std::chrono::milliseconds(0), [this, &start, &run_time]() {
+    start = async_manager_.Now();
+    async_manager_.ExecAsync(std::chrono::hours(1), [this, &run_time]() { run_time = async_manager_.Now(); });
+  });
+  RunOnTaskThread(std::chrono::hours(2), []() {});
+  EXPECT_EQ(run_time - start, std::chrono::hours(1));
+  EXPECT_GE(async_manager_.Now() - start, std::chrono::hours(2));
+}
+
+TEST_F(AsyncManagerVirtualTimeTest, TestTasksRunInScheduleOrder) {
+  std::vector<int> order;
+  RunOnTaskThread(std::chrono::milliseconds(0), [this, &order]() {
+    async_manager_.ExecAsync(std::chrono::milliseconds(20), [&order]() { order.push_back(3); });
+    async_manager_.ExecAsync(std::chrono::milliseconds(10), [&order]() { order.push_back(1); });
+    async_manager_.ExecAsync(std::chrono::milliseconds(10), [&order]() { order.push_back(2); });
+    async_manager_.ExecAsync(std::chrono::milliseconds(0), [&order]() { order.push_back(0); });
+  });
+  RunOnTaskThread(std::chrono::milliseconds(20), []() {});
+  EXPECT_EQ(order, (std::vector<int>{0, 1, 2, 3}));
+}
+
+TEST_F(AsyncManagerVirtualTimeTest, TestPeriodicTaskRunsOncePerPeriod) {
+  int ticks = 0;
+  RunOnTaskThread(std::chrono::milliseconds(0), [this, &ticks]() {
+    AsyncTaskId task_id = async_manager_.ExecAsyncPeriodically(
+        std::chrono::milliseconds(10), std::chrono::milliseconds(10), [&ticks]() { ticks++; });
+    async_manager_.ExecAsync(std::chrono::milliseconds(3600 * 1000 + 5),
+                             [this, task_id]() { async_manager_.CancelAsyncTask(task_id); });
+  });
+  // One hour of 10 ms ticks
+  RunOnTaskThread(std::chrono::milliseconds(3600 * 1000 + 10), []() {});
+  EXPECT_EQ(ticks, 360000);
+
+  auto statistics = async_manager_.GetTaskStatistics();
+  // The ticks, the cancellation and the first task of the test, the last one may still be counted
+  EXPECT_GE(statistics.tasks_run, 360002u);
+  EXPECT_GE(statistics.task_time, std::chrono::hours(1));
+  EXPECT_EQ(statistics.max_lateness.count(), 0);
+  EXPECT_FALSE(statistics.ToString().empty());
+}
+
 }  // namespace test_vendor_lib
@@ -0,0 +1,149 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "model/devices/h4_packetizer.h"
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+namespace test_vendor_lib {
+namespace hci {
+
+class H4PacketizerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds_));
+    ASSERT_EQ(0, fcntl(fds_[0], F_SETFL, O_NONBLOCK));
+    auto save = [this](PacketType type) {
+      return [this, type](const uint8_t* data, size_t length) {
+        received_.emplace_back(type, std::vector<uint8_t>(data, data + length));
+      };
+    };
+    h4_ = std::make_unique<H4Packetizer>(fds_[0], save(PacketType::COMMAND), save(PacketType::EVENT),
+                                         save(PacketType::ACL), save(PacketType::SCO),
+                                         [this]() { disconnected_ = true; });
+  }
+
+  void TearDown() override {
+    h4_.reset();
+    close(fds_[0]);
+    if (fds_[1] != -1) close(fds_[1]);
+  }
+
+  void Write(const std::vector<uint8_t>& bytes) {
+    ASSERT_EQ(static_cast<ssize_t>(bytes.size()), write(fds_[1], bytes.data(), bytes.size()));
+  }
+
+  int fds_[2];
+  std::unique_ptr<H4Packetizer> h4_;
+  std::vector<std::pair<PacketType, std::vector<uint8_t>>> received_;
+  bool disconnected_ = false;
+};
+
+TEST_F(H4PacketizerTest, SeveralPacketsInOneRead) {
+  Write({0x01, 0x03, 0x0c, 0x00,                          // HCI_Reset
+         0x02, 0x01, 0x20, 0x03, 0x00, 0xaa, 0xbb, 0xcc,  // ACL with 3 bytes of data
+         0x03, 0x02, 0x00, 0x01, 0xdd,                    // SCO with 1 byte of data
+         0x04, 0x0e, 0x01, 0x05});                        // Event with 1 parameter byte
+  h4_->OnDataReady(fds_[0]);
+
+  ASSERT_EQ(4u, received_.size());
+  EXPECT_EQ(PacketType::COMMAND, received_[0].first);
+  EXPECT_EQ(std::vector<uint8_t>({0x03, 0x0c, 0x00}), received_[0].second);
+  EXPECT_EQ(PacketType::ACL, received_[1].first);
+  EXPECT_EQ(std::vector<uint8_t>({0x01, 0x20, 0x03, 0x00, 0xaa, 0xbb, 0xcc}), received_[1].second);
+  EXPECT_EQ(PacketType::SCO, received_[2].first);
+  EXPECT_EQ(std::vector<uint8_t>({0x02, 0x00, 0x01, 0xdd}), received_[2].second);
+  EXPECT_EQ(PacketType::EVENT, received_[3].first);
+  EXPECT_EQ(std::vector<uint8_t>({0x0e, 0x01, 0x05}), received_[3].second);
+  EXPECT_FALSE(disconnected_);
+}
+
+TEST_F(H4PacketizerTest, PacketSplitAcrossReads) {
+  std::vector<uint8_t> acl{0x02, 0x01, 0x20, 0x00, 0x01};
+  std::vector<uint8_t> payload(0x100, 0x42);
+  acl.insert(acl.end(), payload.begin(), payload.end());
+  // Followed by the type byte and part of the header of the next packet
+  acl.insert(acl.end(), {0x01, 0x03});
+
+  const size_t kSplit = 3;
+  Write(std::vector<uint8_t>(acl.begin(), acl.begin() + kSplit));
+  h4_->OnDataReady(fds_[0]);
+  EXPECT_TRUE(received_.empty());
+
+  Write(std::vector<uint8_t>(acl.begin() + kSplit, acl.end()));
+  h4_->OnDataReady(fds_[0]);
+  ASSERT_EQ(1u, received_.size());
+  EXPECT_EQ(PacketType::ACL, received_[0].first);
+  EXPECT_EQ(acl.size() - 3, received_[0].second.size());
+  EXPECT_EQ(payload, std::vector<uint8_t>(received_[0].second.begin() + 4, received_[0].second.end()));
+
+  Write({0x0c, 0x00});
+  h4_->OnDataReady(fds_[0]);
+  ASSERT_EQ(2u, received_.size());
+  EXPECT_EQ(std::vector<uint8_t>({0x03, 0x0c, 0x00}), received_[1].second);
+}
+
+TEST_F(H4PacketizerTest, LargestAclPacket) {
+  std::vector<uint8_t> acl{0x02, 0x01, 0x00, 0xff, 0xff};
+  acl.resize(acl.size() + 0xffff, 0x17);
+  // Leave a partial packet in the buffer first, so that the large one has to be moved to fit
+  Write({0x04, 0x0e});
+  h4_->OnDataReady(fds_[0]);
+  Write({0x00});
+
+  size_t written = 0;
+  while (written < acl.size()) {
+    ssize_t ret = write(fds_[1], acl.data() + written, acl.size() - written);
+    ASSERT_GT(ret, 0);
+    written += ret;
+    h4_->OnDataReady(fds_[0]);
+  }
+  while (received_.size() < 2) {
+    h4_->OnDataReady(fds_[0]);
+  }
+
+  ASSERT_EQ(2u, received_.size());
+  EXPECT_EQ(std::vector<uint8_t>({0x0e, 0x00}), received_[0].second);
+  EXPECT_EQ(PacketType::ACL, received_[1].first);
+  EXPECT_EQ(std::vector<uint8_t>(acl.begin() + 1, acl.end()), received_[1].second);
+}
+
+TEST_F(H4PacketizerTest, SendWritesTheTypeAndThePacketTogether) {
+  std::vector<uint8_t> event{0x0e, 0x01, 0x05};
+  EXPECT_EQ(event.size() + 1, h4_->Send(static_cast<uint8_t>(PacketType::EVENT), event.data(), event.size()));
+
+  uint8_t buffer[16];
+  ASSERT_EQ(static_cast<ssize_t>(event.size() + 1), read(fds_[1], buffer, sizeof(buffer)));
+  EXPECT_EQ(static_cast<uint8_t>(PacketType::EVENT), buffer[0]);
+  EXPECT_EQ(event, std::vector<uint8_t>(buffer + 1, buffer + 1 + event.size()));
+}
+
+TEST_F(H4PacketizerTest, Disconnect) {
+  close(fds_[1]);
+  fds_[1] = -1;
+  h4_->OnDataReady(fds_[0]);
+  EXPECT_TRUE(disconnected_);
+}
+
+}  // namespace hci
+}  // namespace test_vendor_lib
@@ -0,0 +1,131 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "model/setup/simulation_engine.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace test_vendor_lib {
+
+class SimulationEngineTest : public ::testing::Test {
+ protected:
+  static constexpr size_t kNumShards = 4;
+
+  SimulationEngine engine_{kNumShards};
+};
+
+TEST_F(SimulationEngineTest, devicesAreSpreadOverShards) {
+  std::vector<size_t> devices_per_shard(kNumShards);
+  for (uint32_t device_id = 0; device_id < 100; device_id++) {
+    size_t shard = engine_.GetShard(device_id);
+    ASSERT_LT(shard, kNumShards);
+    devices_per_shard[shard]++;
+  }
+  for (auto devices : devices_per_shard) {
+    EXPECT_EQ(devices, 25u);
+  }
+}
+
+TEST_F(SimulationEngineTest, tasksRunInPostOrder) {
+  std::vector<int> order;
+  for (int i = 0; i < 100; i++) {
+    engine_.Post(1, std::chrono::milliseconds(0), [&order, i]() { order.push_back(i); });
+  }
+  std::vector<SimulationEngine::Task> batch;
+  for (int i = 100; i < 200; i++) {
+    batch.push_back([&order, i]() { order.push_back(i); });
+  }
+  engine_.PostBatch(1, std::move(batch));
+  engine_.Flush();
+  ASSERT_EQ(order.size(), 200u);
+  for (int i = 0; i < 200; i++) {
+    EXPECT_EQ(order[i], i);
+  }
+}
+
+TEST_F(SimulationEngineTest, delayedTasksRunByDeadline) {
+  std::vector<int> order;
+  std::promise<void> done;
+  engine_.Post(2, std::chrono::milliseconds(30), [&order, &done]() {
+    order.push_back(2);
+    done.set_value();
+  });
+  engine_.Post(2, std::chrono::milliseconds(10), [&order]() { order.push_back(1); });
+  engine_.Post(2, std::chrono::milliseconds(0), [&order]() { order.push_back(0); });
+  ASSERT_EQ(done.get_future().wait_for(std::chrono::seconds(1)), std::future_status::ready);
+  EXPECT_EQ(order, (std::vector<int>{0, 1, 2}));
+}
+
+TEST_F(SimulationEngineTest, tasksOfAShardRunOnOneThread) {
+  std::mutex mutex;
+  std::vector<std::thread::id> threads(kNumShards);
+  std::atomic<int> mismatches{0};
+  for (int round = 0; round < 10; round++) {
+    for (size_t shard = 0; shard < kNumShards; shard++) {
+      engine_.Post(shard, std::chrono::milliseconds(0), [&, shard]() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (threads[shard] == std::thread::id()) {
+          threads[shard] = std::this_thread::get_id();
+        } else if (threads[shard] != std::this_thread::get_id()) {
+          mismatches++;
+        }
+      });
+    }
+  }
+  engine_.Flush();
+  EXPECT_EQ(mismatches, 0);
+  for (size_t shard = 1; shard < kNumShards; shard++) {
+    EXPECT_NE(threads[shard], threads[0]);
+  }
+}
+
+TEST_F(SimulationEngineTest, periodicTickRunsOnEveryShardUntilStopped) {
+  std::vector<std::atomic<int>> ticks(kNumShards);
+  engine_.StartPeriodic(std::chrono::milliseconds(5), [&ticks](size_t shard) { ticks[shard]++; });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  engine_.StopPeriodic();
+  engine_.Flush();
+  std::vector<int> stopped_ticks;
+  for (auto& shard_ticks : ticks) {
+    EXPECT_GT(shard_ticks, 1);
+    stopped_ticks.push_back(shard_ticks);
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  for (size_t shard = 0; shard < kNumShards; shard++) {
+    EXPECT_EQ(ticks[shard], stopped_ticks[shard]);
+  }
+}
+
+TEST_F(SimulationEngineTest, restartingPeriodicTickReplacesIt) {
+  std::atomic<int> first_ticks{0};
+  std::atomic<int> second_ticks{0};
+  engine_.StartPeriodic(std::chrono::milliseconds(5), [&first_ticks](size_t) { first_ticks++; });
+  engine_.StartPeriodic(std::chrono::milliseconds(5), [&second_ticks](size_t) { second_ticks++; });
+  engine_.Flush();
+  int first_ticks_after_restart = first_ticks;
+  std::this_thread::sleep_for(std::chrono::milliseconds(30));
+  engine_.StopPeriodic();
+  engine_.Flush();
+  EXPECT_EQ(first_ticks, first_ticks_after_restart);
+  EXPECT_GT(second_ticks, 0);
+}
+
+}  // namespace test_vendor_lib